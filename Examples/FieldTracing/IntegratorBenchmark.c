@@ -0,0 +1,106 @@
+/*
+ *  Compare the field line integrators available through Lgm_MagStep()
+ *  (LGM_MAGSTEP_ODE_BS, LGM_MAGSTEP_ODE_RK5 and LGM_MAGSTEP_ODE_DP8).
+ *
+ *  A set of field lines is traced down to the (spherical) Earth with each
+ *  integrator over a range of (absolute) tolerances. For each case we print the number of B-field
+ *  evaluations per Re of arc length, the worst footpoint error (relative to
+ *  a very tight DP8 reference trace) and the run time.
+ */
+#include <stdio.h>
+#include <sys/time.h>
+#include <Lgm_MagModelInfo.h>
+
+#define NLINES  48
+
+static double WallTime( void ) {
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return( tv.tv_sec + 1e-6*tv.tv_usec );
+}
+
+/*
+ *  Trace all of the lines. Returns the total number of B-field evaluations
+ *  and the total arc length traced.
+ */
+static long int TraceAll( Lgm_Vector *u, Lgm_Vector *v, double *S, Lgm_MagModelInfo *m ) {
+
+    int         i;
+    long int    nEvals = 0;
+
+    *S = 0.0;
+    for ( i=0; i<NLINES; i++ ) {
+        if ( Lgm_TraceToSphericalEarth( &u[i], &v[i], 120.0, 1.0, 1e-10, m ) != 1 ) {
+            printf("Line %d did not reach the Earth\n", i );
+        }
+        nEvals += m->Lgm_nMagEvals;
+        *S     += m->Trace_s;
+    }
+
+    return( nEvals );
+
+}
+
+int main( ) {
+
+    int                 i, it, ii, Integrator[] = { LGM_MAGSTEP_ODE_BS, LGM_MAGSTEP_ODE_RK5, LGM_MAGSTEP_ODE_DP8 };
+    char                *Name[] = { "BS", "RK5", "DP8" };
+    double              Tol[] = { 1e-5, 1e-7, 1e-9, 1e-11 }, Phi, r, S, Err, MaxErr, t0, t;
+    long int            nEvals;
+    Lgm_Vector          u[NLINES], v[NLINES], vRef[NLINES];
+    Lgm_MagModelInfo    *m;
+
+    m = Lgm_InitMagInfo( );
+    Lgm_Set_Coord_Transforms( 20100203, 12.34567, m->c );
+    Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, LGM_EXTMODEL_T89, m );
+    m->Kp = 2;
+
+    /*
+     *  Start points in the equatorial plane between 3 Re and 8 Re.
+     */
+    for ( i=0; i<NLINES; i++ ) {
+        Phi = 2.0*M_PI*(i%12)/12.0;
+        r   = 3.0 + 5.0*(i/12)/3.0;
+        u[i].x = r*cos(Phi); u[i].y = r*sin(Phi); u[i].z = 0.0;
+    }
+
+    /*
+     *  Reference footpoints.
+     */
+    m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_DP8;
+    m->Lgm_MagStep_DP8_atol   = 1e-13;
+    m->Lgm_MagStep_DP8_rtol   = 0.0;
+    TraceAll( u, vRef, &S, m );
+
+    printf("Integrator      Tol     Evals/Re   Max Footpoint Err (km)   Time (s)\n");
+    for ( it=0; it<4; it++ ) {
+
+        m->Lgm_MagStep_BS_atol  = m->Lgm_MagStep_DP8_atol = Tol[it];
+        m->Lgm_MagStep_BS_rtol  = m->Lgm_MagStep_DP8_rtol = 0.0;
+        m->Lgm_MagStep_RK5_Eps  = Tol[it]; // RK5 has no atol/rtol; use the same number
+
+        for ( ii=0; ii<3; ii++ ) {
+
+            m->Lgm_MagStep_Integrator = Integrator[ii];
+
+            t0 = WallTime();
+            nEvals = TraceAll( u, v, &S, m );
+            t = WallTime() - t0;
+
+            for ( MaxErr=0.0, i=0; i<NLINES; i++ ) {
+                Err = Lgm_VecDiffMag( &v[i], &vRef[i] )*Re;
+                if ( Err > MaxErr ) MaxErr = Err;
+            }
+
+            printf("%10s  %7.0e  %11.2f  %23.3e  %9.4f\n", Name[ii], Tol[it], (double)nEvals/S, MaxErr, t );
+
+        }
+        printf("\n");
+
+    }
+
+    Lgm_FreeMagInfo( m );
+
+    return(0);
+
+}
@@ -16,6 +16,7 @@
 #include <Lgm_QinDenton.h>
 #include <Lgm_Misc.h>
 #include <Lgm_HDF5.h>
+#include <Lgm_Sink.h>
 
 void StringSplit( char *Str, char *StrArray[], int len, int *n );
 
@@ -189,6 +190,7 @@ int main( int argc, char *argv[] ){
     char             IntModel[20], ExtModel[20], CoordSystem[80], Line[5000];
     int              AppendMode, UseEop, Colorize, Force;
     FILE             *fp_in, *fp_MagEphem;
+    Lgm_Sink         *MagEphemSink;
     int              nBirds, iBird;
     char             **Birds, Bird[80];
     double           Inc, Alpha[1000], FootpointHeight, GeoLat, GeoLon, GeoRad;
@@ -499,9 +501,9 @@ exit(0);
 
 
                 /*
-                 * Open input file for reading
+                 * Open input file for reading (it can be gzip'ed)
                  */
-                if ( (fp_in = fopen( InFile, "r" ) ) == NULL ){
+                if ( (fp_in = Lgm_OpenSource( InFile ) ) == NULL ){
 
                     printf("\tCould not open file %s for reading\n", InFile );
 
@@ -511,9 +513,10 @@ exit(0);
 
 
                     /*
-                     * Open Mag Ephem file for writing
+                     * Open Mag Ephem file for writing (gzip'ed if OutFile ends in .gz)
                      */
-                    fp_MagEphem = fopen( OutFile, "w" );
+                    MagEphemSink = Lgm_Sink_Open( OutFile, "w", 0 );
+                    fp_MagEphem  = MagEphemSink->fp;
                     Lgm_WriteMagEphemHeader( fp_MagEphem, 999, "FIX ME", 99999, "FIX ME", NULL, 0, NULL, NULL, 0, NULL, NULL, MagEphemInfo );
                     printf("\t      Writing to file: %s\n", OutFile );
 
@@ -628,7 +631,7 @@ exit(0);
 
                     }
                     fclose(fp_in);
-                    fclose(fp_MagEphem);
+                    Lgm_Sink_Close( MagEphemSink );
 
 
                     // Create HDF5 file
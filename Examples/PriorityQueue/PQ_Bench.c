@@ -0,0 +1,117 @@
+/*
+ *  Insert/pop throughput of Lgm_pQueue (4-ary heap) compared to the binary
+ *  heap it replaced (reproduced below as BinHeap_*).
+ *
+ *      PQ_Bench [n] [nRep]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Lgm/Lgm_PriorityQueue.h"
+
+static double Seconds( void ) {
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return( t.tv_sec + 1e-9*t.tv_nsec );
+}
+
+/*
+ *  The old binary heap (index 1 is the root, children of i are 2i, 2i+1).
+ */
+static void BinHeap_Insert( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
+    long int i;
+    if ( p->HeapSize >= p->nHeapArray-1 ) Lgm_pQueue_Reserve( p->HeapSize+1, p );
+    for ( i = ++(p->HeapSize); (i > 1)&&( X->key < p->HeapArray[i/2].key); i /= 2 ) p->HeapArray[i] = p->HeapArray[i/2];
+    p->HeapArray[i] = *X;
+}
+
+static int BinHeap_Pop( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
+    long int        i, C;
+    Lgm_pQueue_Node t;
+    if ( p->HeapSize <= 0 ) return(0);
+    *X = p->HeapArray[1];
+    t = p->HeapArray[1] = p->HeapArray[ (p->HeapSize)-- ];
+    for ( i=1; 2*i <= p->HeapSize; i = C ) {
+        C = 2*i;
+        if ( (C != p->HeapSize) && ( p->HeapArray[C+1].key < p->HeapArray[C].key ) ) C++;
+        if ( p->HeapArray[C].key < t.key ) p->HeapArray[i] = p->HeapArray[C];
+        else break;
+    }
+    p->HeapArray[i] = t;
+    return(1);
+}
+
+/*
+ *  One round: insert the n keys (one at a time, or all at once with
+ *  Lgm_pQueue_InsertArray()) and pop them all off again.
+ */
+static double Round( int Which, long int n, Lgm_pQueue_Node *Arr, Lgm_pQueue *p, long int *nBad, double *Sum ) {
+    long int        i;
+    double          t0, Last;
+    Lgm_pQueue_Node X;
+
+    t0 = Seconds();
+    Lgm_pQueue_Reset( p );
+    if ( Which == 0 ) {
+        for ( i=0; i<n; i++ ) BinHeap_Insert( &Arr[i], p );
+        for ( Last=-1.0; BinHeap_Pop( &X, p ); Last = X.key ) { if ( X.key < Last ) ++(*nBad); *Sum += X.key; }
+    } else if ( Which == 1 ) {
+        for ( i=0; i<n; i++ ) Lgm_pQueue_Insert( &Arr[i], p );
+        for ( Last=-1.0; Lgm_pQueue_Pop( &X, p ); Last = X.key ) { if ( X.key < Last ) ++(*nBad); *Sum += X.key; }
+    } else {
+        Lgm_pQueue_InsertArray( Arr, n, p );
+        for ( Last=-1.0; Lgm_pQueue_Pop( &X, p ); Last = X.key ) { if ( X.key < Last ) ++(*nBad); *Sum += X.key; }
+    }
+    return( Seconds() - t0 );
+}
+
+int main( int argc, char *argv[] ) {
+
+    long int            n, nRep, nInner, nKeys, i, r, nBad;
+    int                 w;
+    double              t, tBest[3], Sum[3];
+    char                *Name[3] = { "binary heap, insert+pop", "4-ary heap,  insert+pop", "4-ary heap,  bulk+pop  " };
+    Lgm_pQueue          *p;
+    Lgm_pQueue_Node     *Arr;
+
+    n    = ( argc > 1 ) ? atol( argv[1] ) : 1000000;
+    nRep = ( argc > 2 ) ? atol( argv[2] ) : 5;
+
+    /*
+     * Each timing covers nInner rounds (so small heaps still take a
+     * measurable time). Report the best of nRep timings.
+     */
+    nInner = 1000000/n + 1;
+
+    /*
+     * Use a different set of keys for each round (so that the branch
+     * predictor cant learn the sequence).
+     */
+    nKeys = ( n < 1000000 ) ? 4000000 : 4*n;
+    Arr  = (Lgm_pQueue_Node *)calloc( nKeys, sizeof(Lgm_pQueue_Node) );
+    srand48( 1 );
+    for ( i=0; i<nKeys; i++ ) {
+        Arr[i].key = drand48(); Arr[i].index = i; Arr[i].Data = NULL;
+    }
+
+    p = Lgm_pQueue_Create( n+1 );
+    nBad = 0;
+
+    for ( w=0; w<3; w++ ) {
+        tBest[w] = 1e99; Sum[w] = 0.0;
+        for ( r=0; r<nRep; r++ ) {
+            for ( t=0.0, i=0; i<nInner; i++ ) t += Round( w, n, &Arr[ (i*n) % (nKeys-n) ], p, &nBad, &Sum[w] );
+            if ( t < tBest[w] ) tBest[w] = t;
+        }
+    }
+
+    printf( "n = %ld (best of %ld x %ld rounds)\n", n, nRep, nInner );
+    for ( w=0; w<3; w++ ) printf( "    %s: %8.4lf s  (%7.2lf Mops/s)\n", Name[w], tBest[w], 2e-6*n*nInner/tBest[w] );
+    printf( "    out of order pops: %ld  (checksums %.6lf %.6lf %.6lf)\n", nBad, Sum[0], Sum[1], Sum[2] );
+
+    Lgm_pQueue_Destroy( p );
+    free( Arr );
+
+    return( nBad != 0 );
+
+}
@@ -0,0 +1,132 @@
+/*
+ *  Fit a BATS-R-US mesh once, write the fits to a snapshot file, and then trace
+ *  field lines with the snapshot (LGM_EXTMODEL_RBF_SNAPSHOT).
+ *
+ *  The first run (or "RbfSnapshot -w") reads bats_r_us.txt (x y z Bx By Bz
+ *  B1x B1y B1z per line) and writes bats_r_us.rbf. Later runs just open
+ *  bats_r_us.rbf.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <Lgm_CTrans.h>
+#include <Lgm_MagModelInfo.h>
+#include <Lgm_DynamicMemory.h>
+#include <Lgm_ElapsedTime.h>
+#include <Lgm_KdTree.h>
+#include <Lgm_RBF_Snapshot.h>
+int main( int argc, char *argv[] ) {
+    Lgm_ElapsedTimeInfo t;
+    Lgm_MagModelInfo    *mInfo;
+    Lgm_KdTree          *KdTree;
+    Lgm_RBF_Snapshot    *s;
+    Lgm_Vector          v, w, Bvec;
+    double              **u, *B, Bx, By, Bz, B1x, B1y, B1z, x, y, z, Lat;
+    long int            Date, n, nMax;
+    int                 i, Gap;
+    char                *SnapFile = "bats_r_us.rbf";
+    FILE                *fp, *fp2;
+
+
+    t.ColorizeText = TRUE;
+
+    if ( ( argc > 1 && !strcmp( argv[1], "-w" ) ) || ( access( SnapFile, R_OK ) != 0 ) ) {
+
+        /*
+         * Read in a BATS-R-US mesh
+         */
+        nMax = 50000000;
+        LGM_ARRAY_2D( u, 3, nMax, double );
+        LGM_ARRAY_1D( B, 3*nMax, double );
+        n = 0;
+        Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+        if ( (fp = fopen( "bats_r_us.txt", "r" )) == NULL ) {
+            printf("Could not open bats_r_us.txt\n");
+            exit(-1);
+        }
+        while ( (n < nMax) && fscanf( fp, "%lf %lf %lf %lf %lf %lf %lf %lf %lf", &x, &y, &z, &Bx, &By, &Bz, &B1x, &B1y, &B1z ) == 9 ) {
+            u[0][n] = x; u[1][n] = y; u[2][n] = z;
+            B[3*n] = Bx; B[3*n+1] = By; B[3*n+2] = Bz;
+            ++n;
+        }
+        fclose(fp);
+        printf("Number of points in Mesh: %ld\n", n);
+        Lgm_PrintElapsedTime( &t );
+
+
+        /*
+         * Create KdTree. Each Object points at the B of its point.
+         */
+        printf("Creating KdTree\n");
+        Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+        {
+            void **Objects = (void **)calloc( n, sizeof(void *) );
+            for ( i=0; i<n; i++ ) Objects[i] = (void *)&B[3*i];
+            KdTree = Lgm_KdTree_Init( u, Objects, n, 3 );
+        }
+        Lgm_PrintElapsedTime( &t );
+
+
+        /*
+         * Fit the whole box (0.25 Re cells) and write the snapshot.
+         */
+        printf("Writing %s\n", SnapFile);
+        Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+        if ( !Lgm_RBF_Snapshot_Write( SnapFile, KdTree, FALSE, -30.0, 10.0, -20.0, 20.0, -20.0, 20.0, 0.25, 0.3, 1.5, 60, 4.0, LGM_RBF_GAUSSIAN ) ) {
+            exit(-1);
+        }
+        Lgm_PrintElapsedTime( &t );
+
+    }
+
+
+    /*
+     * Open the snapshot and use it as the field model.
+     */
+    if ( (s = Lgm_RBF_Snapshot_Open( SnapFile )) == NULL ) {
+        printf("Could not open %s\n", SnapFile);
+        exit(-1);
+    }
+    printf("%s: %ld cells, %ld centres\n", SnapFile, (long int)s->Header->nCells, (long int)s->Header->nCentres );
+
+    mInfo = Lgm_InitMagInfo( );
+    Date = 20020313;                        // March 3, 2002.
+    Lgm_Set_Coord_Transforms( Date, 12.001, mInfo->c );
+
+    Lgm_MagModelInfo_Set_MagModel( LGM_CDIP, LGM_EXTMODEL_RBF_SNAPSHOT, mInfo );
+    Lgm_MagModelInfo_Set_RBF_Snapshot( s, mInfo );
+    mInfo->Hmax = 0.1;
+    mInfo->Lgm_MagStep_BS_Eps  = 1e-4;
+    mInfo->Lgm_TraceLine_Tol   = 1e-6;
+
+    v.x = -6.6; v.y = 0.0; v.z = 0.0;
+    mInfo->Bfield( &v, &Bvec, mInfo );
+    printf("B at (%g, %g, %g) = %g %g %g\n", v.x, v.y, v.z, Bvec.x, Bvec.y, Bvec.z );
+
+
+    /*
+     * Trace some field lines
+     */
+    Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+    fp = fopen("line_xz.txt", "w");
+    fp2 = fopen("line_xz2.txt", "w");
+    for (Lat = 30.0; Lat<=90.0; Lat += 1.0){
+        v.x = -2.0*cos( Lat*RadPerDeg ); v.y = 0.0; v.z = 2.0*sin( Lat*RadPerDeg );
+        Lgm_TraceLine( &v, &w, 120.0, -1.0, 1e-7, FALSE, mInfo );
+        for (Gap = 3, i=0; i<mInfo->nPnts; i++){
+            fprintf( fp, "%g %g %d\n", mInfo->Px[i], mInfo->Pz[i], Gap );
+            fprintf( fp2, "%g %g\n", mInfo->Px[i], mInfo->Pz[i] );
+            Gap = 2;
+        }
+    }
+    fclose(fp);
+    fclose(fp2);
+    Lgm_PrintElapsedTime( &t );
+
+    Lgm_FreeMagInfo( mInfo );
+    Lgm_RBF_Snapshot_Close( s );
+
+    return(0);
+
+}
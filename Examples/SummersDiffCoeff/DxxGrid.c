@@ -0,0 +1,69 @@
+/*
+ *  Make a table of bounce-averaged chorus diffusion coefficients over
+ *  (L, Ek, Alpha0) with Lgm_DxxGrid. The first run computes the table and
+ *  writes Chorus.dxx; later runs (with the same wave model and grid) just
+ *  read it back.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Lgm_DxxGrid.h>
+#include <Lgm_ElapsedTime.h>
+
+
+double MyBwFunc( double Lat, void *Data ) {
+    double y = 0.75 + 0.04*fabs(Lat)*DegPerRad;
+    return( pow( 10.0, y )/1000.0 );   // nT
+}
+
+
+int main( ) {
+
+    Lgm_ElapsedTimeInfo t;
+    Lgm_DxxWaveModel    Wave;
+    Lgm_DxxGrid         *g;
+    double              Alpha0[40], Ek[20], L[5], aStarEq[5];
+    int                 i, j, k;
+
+    t.ColorizeText = TRUE;
+
+
+    /*
+     *  Grids.
+     */
+    for ( i=0; i<40; i++ ) Alpha0[i] = 2.0 + 86.0*i/39.0;          // Degrees
+    for ( j=0; j<20; j++ ) Ek[j] = pow( 10.0, -2.0 + 3.0*j/19.0 ); // MeV
+    for ( k=0; k<5; k++ ) {
+        L[k] = 3.5 + 0.5*k;
+        aStarEq[k] = 1.0/(3.8*3.8);
+    }
+
+
+    /*
+     *  Lower band chorus. Frequencies are fractions of the equatorial
+     *  electron gyro-frequency.
+     */
+    memset( &Wave, 0, sizeof(Lgm_DxxWaveModel) );
+    Wave.Version    = LGM_SUMMERS_2007;
+    Wave.WaveMode   = LGM_R_MODE_WAVE;
+    Wave.Species    = LGM_ELECTRONS;
+    Wave.Directions = LGM_FRWD_BKWD;
+    Wave.n1 = 1.0; Wave.n2 = 0.0; Wave.n3 = 0.0;
+    Wave.w1 = 0.1; Wave.w2 = 0.3; Wave.wm = 0.2; Wave.dw = 0.1;
+    Wave.MaxWaveLat = 15.0;
+
+
+    Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+    g = Lgm_DxxGrid_Create( &Wave, MyBwFunc, NULL, 40, Alpha0, 20, Ek, 5, L, aStarEq );
+    if ( !Lgm_DxxGrid_Compute( g, "Chorus.dxx" ) ) exit(-1);
+    Lgm_PrintElapsedTime( &t );
+
+    for ( i=0; i<40; i++ ) {
+        printf( "%8g %15g %15g %15g\n", Alpha0[i], g->Daa[2][10][i], g->Dap[2][10][i], g->Dpp[2][10][i] );
+    }
+
+    Lgm_DxxGrid_Free( g );
+
+    return(0);
+
+}
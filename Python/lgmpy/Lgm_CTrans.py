@@ -8,7 +8,7 @@ transformations in Lgm
 
 from __future__ import division
 
-from ctypes import pointer, c_double
+from ctypes import pointer, POINTER, c_double, c_long
 import datetime
 import itertools
 
@@ -19,7 +19,8 @@ import Lgm_MagModelInfo
 import Lgm_Vector
 from Lgm_Wrap import Lgm_CTrans, Lgm_ctransDefaults, Lgm_free_ctrans_children, Lgm_Convert_Coords, \
                 GSM_TO_WGS84, WGS84_TO_EDMAG, Lgm_Set_Coord_Transforms, Lgm_EDMAG_to_R_MLAT_MLON_MLT, \
-                Lgm_Dipole_Tilt
+                Lgm_Dipole_Tilt, Lgm_Set_CTrans_Options, Lgm_Set_CTrans_Tier, Lgm_Convert_Coords_AtTimes_Timeline, \
+                Lgm_CTransTimeline_Create, Lgm_CTransTimeline_Free, LGM_EPH_DE, LGM_PN_IAU76, LGM_CTRANS_TIMELINE_SLERP
 
 
 class Lgm_Coords(list):
@@ -73,6 +74,61 @@ class Lgm_CTrans(Lgm_CTrans):
     def __del__(self):
         Lgm_free_ctrans_children(pointer(self))
 
+def Convert_Coords_Array(pos, time, flag, de_eph=False, tier=None, timeline=None):
+    """
+    Convert an array of positions, each with its own time, in one C call
+
+    The points are handed to Lgm_Convert_Coords_AtTimes_Timeline(), which
+    puts them in time order, sets up the transforms once per distinct time
+    and does the conversions in parallel.
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) Cartesian positions
+    time : datetime or array_like
+        one time, or N of them (datetimes or numpy datetime64)
+    flag : int
+        the conversion, e.g. Lgm_Wrap.GSM_TO_SM
+    de_eph : bool, optional
+        use JPL DE421 for the Sun, etc.
+    tier : int, optional
+        accuracy preset for Lgm_Set_CTrans_Tier() (LGM_CTRANS_TIER_FULL,
+        LGM_CTRANS_TIER_FAST or LGM_CTRANS_TIER_FASTEST), default is to
+        evaluate everything
+    timeline : float, optional
+        if given, set up the transforms by interpolating on a timeline with
+        nodes this many seconds apart (e.g. 600) rather than evaluating them
+        at every time; good to ~1e-11 at 10 minutes
+
+    Returns
+    -------
+    out : ndarray
+        (N, 3) converted positions
+    """
+    from batch import _positions, _times, _vec_ptr
+    pos = _positions(pos)
+    n = len(pos)
+    Date, UTC = _times(time, n)
+    ct = Lgm_CTrans(0)
+    if de_eph:
+        Lgm_Set_CTrans_Options(LGM_EPH_DE, LGM_PN_IAU76, pointer(ct))
+    if tier is not None:
+        Lgm_Set_CTrans_Tier(tier, pointer(ct))
+    tl = None
+    if timeline is not None and n > 0:
+        i0 = numpy.lexsort((UTC, Date))[[0, -1]]
+        tl = Lgm_CTransTimeline_Create(int(Date[i0[0]]), float(UTC[i0[0]]), int(Date[i0[1]]), float(UTC[i0[1]]), float(timeline),
+                                       LGM_CTRANS_TIMELINE_SLERP, pointer(ct))
+    ans = numpy.empty_like(pos)
+    try:
+        Lgm_Convert_Coords_AtTimes_Timeline(n, Date.ctypes.data_as(POINTER(c_long)), UTC.ctypes.data_as(POINTER(c_double)),
+                                            _vec_ptr(pos), _vec_ptr(ans), flag, tl, pointer(ct))
+    finally:
+        if tl:
+            Lgm_CTransTimeline_Free(tl)
+    return ans
+
 def dateToDateLong(inval):
     """
     convert a python date or datetime object to a LanlGeoMag's (long int) date format
@@ -7,9 +7,17 @@ Lgm_MagModelInfo module, this contains the necessary code Mag Model Info
     -------
     Brian Larsen - LANL
 """
+import ctypes
 from ctypes import pointer
 
-from Lgm_Wrap import Lgm_MagEphemInfo, Lgm_InitMagEphemInfoDefaults
+import numpy as np
+
+from Lgm_Wrap import Lgm_MagEphemInfo, Lgm_InitMagEphemInfoDefaults, Lgm_FreeMagEphemInfo_Children, \
+    LGM_LSTARINFO_MAX_FL
+from utils import c_view
+
+# the saved shell lines, which are packed (see shell_line())
+_SHELL_LINES = ('s_gsm', 'Bmag', 'x_gsm', 'y_gsm', 'z_gsm')
 
 
 class Lgm_MagEphemInfo(Lgm_MagEphemInfo):
@@ -26,3 +34,60 @@ class Lgm_MagEphemInfo(Lgm_MagEphemInfo):
         Set the default values from Lgm
         """
         Lgm_InitMagEphemInfoDefaults(pointer(self), MaxPitchAngles, Verbosity)
+        self._owns_children = True
+
+    def __del__(self):
+        """
+        clean up memory that is allocated in C
+        """
+        self.free()
+
+    def free(self):
+        """
+        free the arrays allocated in C (any views of them must be gone)
+        """
+        if getattr(self, '_owns_children', False):
+            self._owns_children = False
+            Lgm_FreeMagEphemInfo_Children(pointer(self))
+
+    def view(self, name):
+        """
+        numpy array (no copy) of one of the result arrays, e.g. 'Lstar' (by
+        pitch angle) or 'ShellSphericalFootprint_Pn' (by pitch angle and
+        field line, with a trailing x,y,z dimension). The array holds a
+        reference to this object, so the C memory lives as long as it does.
+        The shell lines themselves are packed, use shell_line() for those.
+
+        The first dimension is the number of pitch angles allocated for,
+        use nAlpha and nShellPoints to pick out the part that was filled.
+        """
+        if name in _SHELL_LINES:
+            raise(ValueError('{0} is packed, use shell_line()'.format(name)))
+        ptr = getattr(self, name)
+        dims = [self.nAllocedAlpha, LGM_LSTARINFO_MAX_FL]
+        ndim = 1
+        ctype = ptr._type_
+        while issubclass(ctype, ctypes._Pointer):
+            ptr = ptr[0]
+            ctype = ctype._type_
+            ndim += 1
+        return c_view(self, ctypes.cast(ptr, ctypes.c_void_p).value, dims[:ndim], ctype)
+
+    def shell_line(self, i, n):
+        """
+        views (no copies) of shell line n of pitch angle i, as a dict of
+        float32 arrays 's_gsm', 'Bmag', 'x_gsm', 'y_gsm' and 'z_gsm'. The
+        lines are saved decimated to within ShellLineTol (Re) of the traced
+        ones, so the points are not evenly spaced in s_gsm.
+        """
+        if not self.nFieldPnts:
+            raise(ValueError('no shell lines were saved'))
+        off = self.ShellLineOffset[i][n]
+        npts = self.nFieldPnts[i][n]
+        ans = {}
+        if npts == 0:
+            return dict((name, np.zeros(0, np.float32)) for name in _SHELL_LINES)
+        for name in _SHELL_LINES:
+            addr = ctypes.cast(getattr(self, name)[i], ctypes.c_void_p).value
+            ans[name] = c_view(self, addr + off*ctypes.sizeof(ctypes.c_float), [npts], ctypes.c_float)
+        return ans
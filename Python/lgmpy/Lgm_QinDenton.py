@@ -7,9 +7,12 @@ Authors
 -------
 Brian Larsen - LANL
 """
-from ctypes import pointer
+from ctypes import pointer, POINTER, c_double
 
-from Lgm_Wrap import Lgm_QinDenton, Lgm_init_QinDentonDefaults, Lgm_destroy_QinDenton_children
+import numpy as np
+
+from Lgm_Wrap import Lgm_QinDenton, Lgm_init_QinDentonDefaults, Lgm_destroy_QinDenton_children, \
+    Lgm_QinDentonOne, Lgm_get_QinDenton_at_JD_Array
 
 
 class Lgm_QinDenton(Lgm_QinDenton):
@@ -31,4 +34,47 @@ class Lgm_QinDenton(Lgm_QinDenton):
         """
         clean up memory that is allocated in C
         """
-        Lgm_destroy_QinDenton_children(pointer(self))
\ No newline at end of file
+        Lgm_destroy_QinDenton_children(pointer(self))
+
+
+def get_QinDenton(time, Persistence=False, verbose=False):
+    """
+    QinDenton parameters at an array of times
+
+    The lookups are done in one call to Lgm_get_QinDenton_at_JD_Array(),
+    which goes through the library's day cache (each day is read once per
+    process) and builds the interpolating splines once per day, so this is
+    cheap even for a year of 1-minute times.
+
+    Parameters
+    ==========
+    time : datetime or array_like
+        a datetime, a list of datetimes or a numpy datetime64 array
+    Persistence : bool, optional
+        use the last values for times after the end of the data, default (False)
+    verbose : bool, optional
+        print the parameters for each time, default (False)
+
+    Returns
+    =======
+    out : dict
+        numpy arrays (one value per time) of each of the Lgm_QinDentonOne
+        fields, e.g. 'fKp', 'Dst', 'Pdyn', 'ByIMF', 'BzIMF', 'W1', ...
+
+    Examples
+    ========
+    >>> from lgmpy import Lgm_QinDenton
+    >>> import datetime
+    >>> t = [datetime.datetime(2005, 8, 31) + datetime.timedelta(minutes=i) for i in range(1440)]
+    >>> qd = Lgm_QinDenton.get_QinDenton(t)
+    >>> qd['Dst'].shape
+    (1440,)
+    """
+    t = np.atleast_1d(np.asarray(time, dtype='datetime64[us]'))
+    JD = (t - np.datetime64('1970-01-01T00:00:00', 'us')).astype(np.int64)/8.64e10 + 2440587.5
+    JD = np.ascontiguousarray(JD, dtype=np.float64)
+    n = len(JD)
+    p = (Lgm_QinDentonOne * n)()
+    Lgm_get_QinDenton_at_JD_Array(n, JD.ctypes.data_as(POINTER(c_double)), p, int(verbose), int(Persistence))
+    arr = np.ctypeslib.as_array(p)
+    return dict((name, arr[name].copy()) for name in arr.dtype.names if name != 'IsoTimeStr')
@@ -17,6 +17,7 @@ from Lgm_Wrap import LGM_CDIP, LGM_EDIP, LGM_IGRF, Lgm_Set_Coord_Transforms, \
 import Lgm_Vector
 import Lgm_CTrans
 import Lgm_MagModelInfo
+import batch
 from utils import pos2Lgm_Vector
 
 class Lgm_T89(MagData.MagData):
@@ -110,29 +111,20 @@ class Lgm_T89(MagData.MagData):
         #self['B'].attrs['System'] = 'GSM'
 
     def calc_B(self):
-        try:
-            ans = []
-            for v1, v2, v3 in zip(self._Vpos, self['Epoch'], self['Kp']):
-                date = Lgm_CTrans.dateToDateLong(v2)
-                utc = Lgm_CTrans.dateToFPHours(v2)
-                Lgm_Set_Coord_Transforms( date, utc, self._mmi.c) # dont need pointer as it is one
-                B = Lgm_Vector.Lgm_Vector()
-                self._mmi.Kp = v3
-                retval = Lgm_B_T89(pointer(v1), pointer(B), pointer(self._mmi))
-                if retval != 1:
-                    raise(RuntimeWarning('Odd return from Lgm_T89') )
-                ans.append(B)
-            return ans
-        except TypeError:
-            date = Lgm_CTrans.dateToDateLong(self['Epoch'])
-            utc = Lgm_CTrans.dateToFPHours(self['Epoch'])
-            Lgm_Set_Coord_Transforms( date, utc, self._mmi.c) # dont need pointer as it is one
-            B = Lgm_Vector.Lgm_Vector()
-            self._mmi.Kp = self['Kp']
-            retval = Lgm_B_T89(pointer(self._Vpos), pointer(B), pointer(self._mmi) )
-            if retval != 1:
-                raise(RuntimeWarning('Odd return from Lgm_T89') )
-            return B
+        if isinstance(self._Vpos, list):
+            # do the whole list in one call (see batch.py)
+            Bs = batch.B_mmi([val.tolist() for val in self._Vpos], self['Epoch'],
+                             self['Kp'], self._mmi)
+            return [Lgm_Vector.Lgm_Vector(*val) for val in Bs]
+        date = Lgm_CTrans.dateToDateLong(self['Epoch'])
+        utc = Lgm_CTrans.dateToFPHours(self['Epoch'])
+        Lgm_Set_Coord_Transforms( date, utc, self._mmi.c) # dont need pointer as it is one
+        B = Lgm_Vector.Lgm_Vector()
+        self._mmi.Kp = self['Kp']
+        retval = Lgm_B_T89(pointer(self._Vpos), pointer(B), pointer(self._mmi) )
+        if retval != 1:
+            raise(RuntimeWarning('Odd return from Lgm_T89') )
+        return B
 
 
 def T89(pos, time, Kp, coord_system = 'GSM', INTERNAL_MODEL='LGM_IGRF',):
@@ -28,7 +28,7 @@ import spacepy.toolbox as tb
 import Lgm_Wrap
 from Lgm_Wrap import Lgm_Set_Coord_Transforms, SM_TO_GSM, Lgm_Convert_Coords, \
     Lgm_SetLstarTolerances, RadPerDeg, GSM_TO_WGS84, WGS84_TO_EDMAG,\
-    LFromIBmM_Hilton, LFromIBmM_McIlwain, Lgm_EDMAG_to_R_MLAT_MLON_MLT, Lgm_FreeMagEphemInfo_Children, \
+    LFromIBmM_Hilton, LFromIBmM_McIlwain, Lgm_EDMAG_to_R_MLAT_MLON_MLT, \
     Lgm_ComputeLstarVersusPA, Lgm_B_TS04, Lgm_B_T96, Lgm_QinDentonOne, Lgm_set_QinDenton, Lgm_get_QinDenton_at_JD
 from Lgm_Wrap import Lstar as Lgm_Lstar
 import Lgm_Vector
@@ -72,6 +72,17 @@ class Lstar_Data(datamodel.SpaceData):
         self.tree(verbose=True, attrs=True)
         return ''
 
+def _shell_lines(arr, nlines):
+    """
+    copy one of the saved shell line arrays (s_gsm, Bmag, x_gsm, ...) out of
+    an Lgm_LstarInfo. These are only allocated when shell lines are saved, so
+    this returns None if there are none.
+    """
+    if not arr:
+        return None
+    return numpy.ctypeslib.as_array(arr, shape=(nlines,)).copy()
+
+
 def get_Lstar(pos, date, alpha = 90.,
                   Kp = 2, coord_system='GSM',
                   Bfield = 'Lgm_B_OP77',
@@ -467,35 +478,15 @@ def get_Lstar(pos, date, alpha = 90.,
                                             dtype=c_int,
                                             buffer=lstarinf.nFieldPnts).copy()
 
-                ans[pa]['s_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.s_gsm),
-                                             len(lstarinf.s_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.s_gsm).copy()
-                ans[pa]['Bmag'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.Bmag),
-                                             len(lstarinf.Bmag[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.Bmag).copy()
-                ans[pa]['x_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.x_gsm),
-                                             len(lstarinf.x_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.x_gsm).copy()
-                ans[pa]['y_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.y_gsm),
-                                             len(lstarinf.y_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.y_gsm).copy()
-                ans[pa]['z_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.z_gsm),
-                                             len(lstarinf.z_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.z_gsm).copy()
+                ans[pa]['s_gsm'] = _shell_lines(lstarinf.s_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['Bmag'] = _shell_lines(lstarinf.Bmag, len(lstarinf.nFieldPnts))
+                ans[pa]['x_gsm'] = _shell_lines(lstarinf.x_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['y_gsm'] = _shell_lines(lstarinf.y_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['z_gsm'] = _shell_lines(lstarinf.z_gsm, len(lstarinf.nFieldPnts))
                 delT = datetime.datetime.now() - tnow
                 ans[pa].attrs['Calc_Time'] = delT.seconds + delT.microseconds/1e6
 
-    Lgm_FreeMagEphemInfo_Children(pointer(MagEphemInfo))
+    MagEphemInfo.free()
     return ans
 
 def get_Lstar_General(pos, date, alpha = 90.,
@@ -896,35 +887,15 @@ def get_Lstar_General(pos, date, alpha = 90.,
                                             dtype=c_int,
                                             buffer=lstarinf.nFieldPnts)
 
-                ans[pa]['s_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.s_gsm),
-                                             len(lstarinf.s_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.s_gsm)
-                ans[pa]['Bmag'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.Bmag),
-                                             len(lstarinf.Bmag[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.Bmag)
-                ans[pa]['x_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.x_gsm),
-                                             len(lstarinf.x_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.x_gsm)
-                ans[pa]['y_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.y_gsm),
-                                             len(lstarinf.y_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.y_gsm)
-                ans[pa]['z_gsm'] = \
-                    numpy.ctypeslib.ndarray([len(lstarinf.z_gsm),
-                                             len(lstarinf.z_gsm[0])],
-                                            dtype=c_double,
-                                            buffer=lstarinf.z_gsm)
+                ans[pa]['s_gsm'] = _shell_lines(lstarinf.s_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['Bmag'] = _shell_lines(lstarinf.Bmag, len(lstarinf.nFieldPnts))
+                ans[pa]['x_gsm'] = _shell_lines(lstarinf.x_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['y_gsm'] = _shell_lines(lstarinf.y_gsm, len(lstarinf.nFieldPnts))
+                ans[pa]['z_gsm'] = _shell_lines(lstarinf.z_gsm, len(lstarinf.nFieldPnts))
                 delT = datetime.datetime.now() - tnow
                 ans[pa].attrs['Calc_Time'] = delT.seconds + delT.microseconds/1e6
 
-    Lgm_FreeMagEphemInfo_Children(pointer(MagEphemInfo))
+    MagEphemInfo.free()
     return ans
     
 
@@ -1049,22 +1020,71 @@ def get_Lstar2(pos, date, alpha = 90.,
         ans[pa]['LMcIlwain'] = MagEphemInfo.LMcIlwain[ii]
         ans[pa]['Lstar'] = MagEphemInfo.Lstar[ii]
 
-        # think in here, there are not owned by pyhton so there is no easy way to free the memory...
+        # these are views of the C arrays (no copies), they keep MagEphemInfo alive
         if extended_out:
-            ans[pa]['Bmin'] = dm.dmarray(np.zeros([MagEphemInfo.nShellPoints[ii], 3]))
-            ans[pa]['I'] = dm.dmarray(np.zeros([MagEphemInfo.nShellPoints[ii]]))
-            ans[pa]['Pmin'] = dm.dmarray(np.zeros([MagEphemInfo.nShellPoints[ii], 3]))
-            ans[pa]['Bmin'][:, 0] = [val.x for val in MagEphemInfo.Shell_Bmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
-            ans[pa]['Bmin'][:, 1] = [val.y for val in MagEphemInfo.Shell_Bmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
-            ans[pa]['Bmin'][:, 2] = [val.z for val in MagEphemInfo.Shell_Bmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
-            ans[pa]['I'][:] = [val for val in MagEphemInfo.ShellI[ii][0:MagEphemInfo.nShellPoints[ii]]]
-            ans[pa]['Pmin'][:, 0] = [val.x for val in MagEphemInfo.Shell_Pmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
-            ans[pa]['Pmin'][:, 1] = [val.y for val in MagEphemInfo.Shell_Pmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
-            ans[pa]['Pmin'][:, 2] = [val.z for val in MagEphemInfo.Shell_Pmin[ii][0:MagEphemInfo.nShellPoints[ii]]] 
+            n = MagEphemInfo.nShellPoints[ii]
+            ans[pa]['Bmin'] = dm.dmarray(MagEphemInfo.view('Shell_Bmin')[ii, :n])
+            ans[pa]['I'] = dm.dmarray(MagEphemInfo.view('ShellI')[ii, :n])
+            ans[pa]['Pmin'] = dm.dmarray(MagEphemInfo.view('Shell_Pmin')[ii, :n])
         
     return ans
 
 
+def get_Lstar_batch(positions, dates, alphas = 90., Bfield = 'Lgm_B_OP77',
+                    Kp = None, workers = None, coord_system = 'GSM',
+                    LstarThresh = 10.0, LstarQuality = 3):
+    """
+    L* for a whole array of positions and times in one call
+
+    The points are handed to the C library (Lgm_ComputeLstarVersusPA_AtTimes)
+    in one go, which spreads them and their pitch angles over its own thread
+    pool. The GIL is let go for the length of the call, so this uses all of
+    the cores from one python process (and with one copy of the models and
+    the Qin-Denton data), and other python threads keep running meanwhile.
+
+    Parameters
+    ==========
+    positions : array_like
+        (N, 3) positions in coord_system (Re)
+    dates : datetime or array_like
+        one datetime (or datetime64), or N of them
+    alphas : float or list, optional
+        local pitch angle(s) in degrees, default (90)
+    Bfield : str, optional
+        The Magnetic field model to use for the calculation, default (Lgm_B_OP77)
+    Kp : float or array_like, optional
+        one Kp, or N of them, default is the Lgm default
+    workers : int, optional
+        the number of threads to use, default is all of them (or OMP_NUM_THREADS)
+    coord_system : str, optional
+        The coordinate system of the input positions, default (GSM)
+    LstarThresh : float, optional
+        dont compute L* beyond this Lsimple, default (10)
+    LstarQuality : int, optional
+        The quality flag for the integrators, default (3)
+
+    Returns
+    =======
+    out : dict
+        'Lstar', 'I', 'K' and 'Bmirror' arrays, each (N, len(alphas)) with nan
+        where they couldnt be computed, and 'Alpha'
+
+    Examples
+    ========
+    >>> from lgmpy import Lstar
+    >>> import datetime
+    >>> ans = Lstar.get_Lstar_batch([[-4.2, 1, 1]]*100, datetime.datetime(2010, 10, 12),
+    ...                             [30, 90], workers=4)
+    >>> ans['Lstar'].shape
+    (100, 2)
+    """
+    import batch
+    if coord_system != 'GSM':
+        positions = batch.coordTrans(positions, dates, coord_system, 'GSM')
+    return batch.Lstar(positions, dates, alphas, Kp=Kp, Bfield=Bfield,
+                       LstarThresh=LstarThresh, LstarQuality=LstarQuality,
+                       workers=workers)
+
 if __name__ == '__main__':
     date = datetime.datetime(2010, 10, 12)
     ans = get_Lstar([-4.2, 1, 1], date, alpha = 90, Kp = 4, coord_system='SM', Bfield = 'Lgm_B_T89', LstarQuality = 1, extended_out=True)
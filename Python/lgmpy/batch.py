@@ -0,0 +1,333 @@
+# -*- coding: utf-8 -*-
+"""
+Overview
+--------
+NumPy (array) versions of the lgmpy calculations.
+
+The classes in lgmpy loop over points in python and make one ctypes call per
+point, which limits them to something like 10^4 points/s. The functions here
+hand whole arrays to the Lgm_*_AtTimes() routines in the C library (see
+Lgm_AtTimes.c), which loop (in parallel) in C. Positions are (N, 3) arrays
+of float64 in Re, times are a datetime, a list of datetimes or a numpy
+datetime64 array (a single time is used for every position), and Kp is a
+number or an array of N numbers.
+
+The C calls go through ctypes.CDLL, which lets go of the GIL for the length
+of the call, so other python threads keep running while the C library works
+on all of the cores.
+
+    Authors
+    -------
+    Brian Larsen, Mike Henderson - LANL
+"""
+from __future__ import division
+
+from ctypes import pointer, POINTER, cast, c_double, c_long, c_int
+import threading
+
+import numpy as np
+
+from Lgm_Wrap import Lgm_Vector as _Lgm_Vector
+from Lgm_Wrap import Lgm_MagModelInfo as _Lgm_MagModelInfo
+from Lgm_Wrap import Lgm_B_AtTimes, Lgm_B_Ensemble_AtTimes, Lgm_Trace_AtTimes, \
+    Lgm_ComputeLstarVersusPA_AtTimes, Lgm_SetMagEphemLstarQuality, \
+    Lgm_SetMaxThreads, \
+    Lgm_Set_Lgm_B_cdip_InternalModel, Lgm_Set_Lgm_B_edip_InternalModel, Lgm_Set_Lgm_B_IGRF_InternalModel, \
+    LGM_FILL_VALUE, LGM_OUT_LSTAR, LGM_OUT_K
+import Lgm_CTrans
+import Lgm_MagModelInfo
+import Lgm_MagEphemInfo
+from _Bfield_dict import Bfield_dict
+
+__all__ = ['B', 'B_ensemble', 'coordTrans', 'trace', 'Lstar']
+
+# Lgm_SetMaxThreads() is global in the C library, so calls that change it
+# (workers=N) take turns
+_threads_lock = threading.Lock()
+
+_internal_dict = {'LGM_CDIP': Lgm_Set_Lgm_B_cdip_InternalModel,
+                  'LGM_EDIP': Lgm_Set_Lgm_B_edip_InternalModel,
+                  'LGM_IGRF': Lgm_Set_Lgm_B_IGRF_InternalModel}
+
+
+def _positions(pos):
+    """(N, 3) contiguous float64 copy (or view) of pos"""
+    pos = np.ascontiguousarray(pos, dtype=np.float64)
+    if pos.size % 3 != 0:
+        raise(ValueError('Positions must be 3-vectors'))
+    return pos.reshape(-1, 3)
+
+def _vec_ptr(arr):
+    return arr.ctypes.data_as(POINTER(_Lgm_Vector))
+
+def _dbl_ptr(arr):
+    return arr.ctypes.data_as(POINTER(c_double))
+
+def _times(time, n):
+    """
+    Date (YYYYMMDD) and UTC (decimal hours) arrays of length n
+    """
+    t = np.atleast_1d(np.asarray(time, dtype='datetime64[us]'))
+    days = t.astype('datetime64[D]')
+    months = days.astype('datetime64[M]')
+    year = months.astype('datetime64[Y]').astype(np.int64) + 1970
+    month = months.astype(np.int64) % 12 + 1
+    day = (days - months).astype(np.int64) + 1
+    Date = np.ascontiguousarray(year*10000 + month*100 + day, dtype=c_long)
+    UTC = np.ascontiguousarray((t - days).astype(np.int64)/3.6e9, dtype=np.float64)
+    if len(Date) == 1 and n != 1:
+        Date, UTC = np.repeat(Date, n), np.repeat(UTC, n)
+    if len(Date) != n:
+        raise(ValueError('Inputs must be the same length, scalars or lists'))
+    return Date, UTC
+
+def _kp(Kp, n):
+    if Kp is None:
+        return None, None
+    Kp = np.ascontiguousarray(np.broadcast_to(np.asarray(Kp, dtype=np.float64), (n,)))
+    return Kp, _dbl_ptr(Kp)
+
+def _mag_model(mmi, Bfield, INTERNAL_MODEL):
+    try:
+        Bfield_dict[Bfield](mmi)
+    except KeyError:
+        raise(NotImplementedError("Only Bfield=%s currently supported" % Bfield_dict.keys()))
+    try:
+        _internal_dict[INTERNAL_MODEL](mmi)
+    except KeyError:
+        raise(ValueError('INTERNAL_MODEL must be LGM_CDIP, LGM_EDIP, or LGM_IGRF') )
+
+def _fill_to_nan(arr):
+    arr[arr == LGM_FILL_VALUE] = np.nan
+    return arr
+
+
+def B(pos, time, Kp=None, Bfield='Lgm_B_T89', INTERNAL_MODEL='LGM_IGRF'):
+    """
+    Magnetic field at an array of positions
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) positions in GSM (Re)
+    time : datetime or array_like
+        one time, or N of them
+    Kp : float or array_like, optional
+        one Kp, or N of them (default is the Lgm default)
+    Bfield : str, optional
+        the field model, one of the keys of _Bfield_dict.Bfield_dict
+    INTERNAL_MODEL : str, optional
+        LGM_CDIP, LGM_EDIP or LGM_IGRF (default)
+
+    Returns
+    -------
+    out : ndarray
+        (N, 3) field in GSM (nT)
+
+    Examples
+    --------
+    >>> from lgmpy import batch
+    >>> import datetime
+    >>> batch.B([[-6.6, 0, 0]]*2, datetime.datetime(2005, 8, 31, 9), [0, 1])
+    array([[-18.926..., -1.857...,  80.052...],
+           [-20.783..., -1.857...,  74.280...]])
+    """
+    mmi = Lgm_MagModelInfo.Lgm_MagModelInfo()
+    _mag_model(pointer(mmi), Bfield, INTERNAL_MODEL)
+    return B_mmi(pos, time, Kp, mmi)
+
+def B_mmi(pos, time, Kp, mmi):
+    """
+    Same as B() but with a Lgm_MagModelInfo that has already been set up
+    """
+    pos = _positions(pos)
+    n = len(pos)
+    Date, UTC = _times(time, n)
+    Kp, Kp_p = _kp(Kp, n)
+    ans = np.empty_like(pos)
+    if Lgm_B_AtTimes(n, Date.ctypes.data_as(POINTER(c_long)), _dbl_ptr(UTC), Kp_p,
+                     _vec_ptr(pos), _vec_ptr(ans), pointer(mmi)) != 1:
+        raise(RuntimeWarning('Odd return from Lgm_B_AtTimes') )
+    return ans
+
+
+def B_ensemble(pos, time, Bfields=('Lgm_B_T89', 'Lgm_B_T96'), Kp=None,
+               INTERNAL_MODEL='LGM_IGRF', QinDenton=False):
+    """
+    Magnetic field of several models at an array of positions
+
+    The transforms (and the Qin-Denton inputs) are set up once per time for
+    all of the models, and the internal field is shared by the models that
+    can be split up (see Lgm_B_Ensemble_AtTimes()), so this is quicker than
+    calling B() once per model.
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) positions in GSM (Re)
+    time : datetime or array_like
+        one time, or N of them
+    Bfields : list of str, optional
+        the field models, keys of _Bfield_dict.Bfield_dict
+    Kp : float, optional
+        Kp for all of the models (default is the Lgm default)
+    INTERNAL_MODEL : str, optional
+        LGM_CDIP, LGM_EDIP or LGM_IGRF (default)
+    QinDenton : bool, optional
+        set the model inputs from the Qin-Denton values at each time
+
+    Returns
+    -------
+    out : ndarray
+        (N, len(Bfields), 3) field in GSM (nT), the models side by side
+    """
+    pos = _positions(pos)
+    n = len(pos)
+    Date, UTC = _times(time, n)
+    mmis = []
+    for Bfield in Bfields:
+        mmi = Lgm_MagModelInfo.Lgm_MagModelInfo()
+        _mag_model(pointer(mmi), Bfield, INTERNAL_MODEL)
+        if Kp is not None:
+            mmi.fKp = float(Kp)
+            mmi.Kp = min(max(int(Kp+0.5), 0), 6)
+        mmis.append(mmi)
+    Models = (POINTER(_Lgm_MagModelInfo)*len(mmis))(*[cast(pointer(m), POINTER(_Lgm_MagModelInfo)) for m in mmis])
+    ans = np.empty((n, len(mmis), 3), dtype=np.float64)
+    if Lgm_B_Ensemble_AtTimes(n, Date.ctypes.data_as(POINTER(c_long)), _dbl_ptr(UTC), _vec_ptr(pos),
+                              len(mmis), Models, int(QinDenton), _vec_ptr(ans)) != 1:
+        raise(RuntimeWarning('Odd return from Lgm_B_Ensemble_AtTimes') )
+    return ans
+
+
+def coordTrans(pos, time, in_sys, out_sys, de_eph=False, tier=None, timeline=None):
+    """
+    Convert an array of positions between coordinate systems
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) positions in in_sys (Cartesian, even for WGS84)
+    time : datetime or array_like
+        one time, or N of them (in any order)
+    in_sys, out_sys : str
+        the acronyms of the coordinate systems (see magcoords.trans_dict)
+    de_eph : bool, optional
+        use JPL DE421 for the Sun, etc.
+    tier, timeline : optional
+        faster set up of the transforms, see Lgm_CTrans.Convert_Coords_Array
+
+    Returns
+    -------
+    out : ndarray
+        (N, 3) positions in out_sys
+    """
+    from magcoords import trans_dict
+    try:
+        conv_val = trans_dict[in_sys]*100 + trans_dict[out_sys]
+    except KeyError:
+        raise KeyError('One of the specified coordinate systems is not recognised')
+    return Lgm_CTrans.Convert_Coords_Array(pos, time, conv_val, de_eph, tier, timeline)
+
+
+def trace(pos, time, Kp=None, Bfield='Lgm_B_T89', INTERNAL_MODEL='LGM_IGRF', Height=120.):
+    """
+    Trace the field lines through an array of positions
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) positions in GSM (Re)
+    time : datetime or array_like
+        one time, or N of them
+    Kp : float or array_like, optional
+        one Kp, or N of them
+    Height : float, optional
+        footpoint height in km (default 120)
+
+    Returns
+    -------
+    out : dict
+        'Flag' (N,) field line types (LGM_CLOSED, ...), and 'South', 'North',
+        'Pmin' (N, 3) footpoints and minimum B points in GSM
+    """
+    mmi = Lgm_MagModelInfo.Lgm_MagModelInfo()
+    _mag_model(pointer(mmi), Bfield, INTERNAL_MODEL)
+    pos = _positions(pos)
+    n = len(pos)
+    Date, UTC = _times(time, n)
+    Kp, Kp_p = _kp(Kp, n)
+    ans = {'Flag': np.zeros(n, dtype=c_int),
+           'South': np.zeros_like(pos), 'North': np.zeros_like(pos), 'Pmin': np.zeros_like(pos)}
+    Lgm_Trace_AtTimes(n, Date.ctypes.data_as(POINTER(c_long)), _dbl_ptr(UTC), Kp_p, _vec_ptr(pos),
+                      Height, 0.0, 0.0, ans['Flag'].ctypes.data_as(POINTER(c_int)),
+                      _vec_ptr(ans['South']), _vec_ptr(ans['North']), _vec_ptr(ans['Pmin']), pointer(mmi))
+    return ans
+
+
+def Lstar(pos, time, alpha=90., Kp=None, Bfield='Lgm_B_OP77', LstarThresh=10.0,
+          LstarQuality=3, nFLsInDriftShell=24, workers=None):
+    """
+    L*, I, K and Bmirror for an array of positions (the array version of
+    Lstar.get_Lstar)
+
+    Parameters
+    ----------
+    pos : array_like
+        (N, 3) positions in GSM (Re)
+    time : datetime or array_like
+        one time, or N of them
+    alpha : float or list, optional
+        local pitch angle(s) in degrees (default 90)
+    Kp : float or array_like, optional
+        one Kp, or N of them
+    LstarThresh : float, optional
+        dont compute L* beyond this Lsimple (default 10)
+    workers : int, optional
+        number of threads the C library uses (default is all of them, or
+        OMP_NUM_THREADS)
+
+    Returns
+    -------
+    out : dict
+        'Lstar', 'I', 'K', 'Bmirror', each (N, nAlpha) with nan where they
+        couldnt be computed, and 'Alpha'
+    """
+    Alpha = np.ascontiguousarray(np.atleast_1d(alpha), dtype=np.float64)
+    nA = len(Alpha)
+    pos = _positions(pos)
+    n = len(pos)
+    Date, UTC = _times(time, n)
+    Kp, Kp_p = _kp(Kp, n)
+
+    MagEphemInfo = Lgm_MagEphemInfo.Lgm_MagEphemInfo(nA, 0)
+    Lgm_SetMagEphemLstarQuality(LstarQuality, nFLsInDriftShell, pointer(MagEphemInfo))
+    MagEphemInfo.SaveShellLines = False
+    # only L*, I and K are returned, so skip Sb and the per shell line traces
+    MagEphemInfo.Outputs = LGM_OUT_LSTAR | LGM_OUT_K
+    MagEphemInfo.LstarInfo.contents.LSimpleMax = LstarThresh
+    try:
+        Bfield_dict[Bfield](MagEphemInfo.LstarInfo.contents.mInfo)
+    except KeyError:
+        raise(NotImplementedError("Only Bfield=%s currently supported" % Bfield_dict.keys()))
+
+    ans = {'Alpha': Alpha}
+    for key in ('Lstar', 'I', 'K', 'Bmirror'):
+        ans[key] = np.zeros((n, nA), dtype=np.float64)
+    args = (n, Date.ctypes.data_as(POINTER(c_long)), _dbl_ptr(UTC), Kp_p,
+            _vec_ptr(pos), nA, _dbl_ptr(Alpha), _dbl_ptr(ans['Lstar']),
+            _dbl_ptr(ans['I']), _dbl_ptr(ans['K']), _dbl_ptr(ans['Bmirror']),
+            pointer(MagEphemInfo))
+    if workers is None:
+        Lgm_ComputeLstarVersusPA_AtTimes(*args)
+    else:
+        with _threads_lock:
+            Lgm_SetMaxThreads(int(workers))
+            try:
+                Lgm_ComputeLstarVersusPA_AtTimes(*args)
+            finally:
+                Lgm_SetMaxThreads(0)
+    MagEphemInfo.free()
+    for key in ('Lstar', 'I', 'K', 'Bmirror'):
+        _fill_to_nan(ans[key])
+    return ans
@@ -76,22 +76,27 @@ def _doConversion(pos_in, cdict, cTrans):
     return Pout
 
 
-def coordTrans(pos_in, time_in, in_sys, out_sys, de_eph=False):
+def coordTrans(pos_in, time_in, in_sys, out_sys, de_eph=False, tier=None, timeline=None):
     '''
     Convert coordinates between almost any system using LanlGeoMag
 
     Parameters
     ----------
     position : list
-        a three element vector of positions in input coord system
+        a three element vector of positions in input coord system (or a list
+        of them, one per time)
     time : datetime
         a datimetime object representing the time at the desired conversion
+        (or a list of them, which are done in one call, except for WGS84)
     system_in : str
         a string giving the acronym for the input coordinate system
     system_out : str
         a string giving the acronym for the desired output coordinate system
     de_eph : bool or int (optional)
         a boolean stating whether JPL DE421 is to be used for Sun, etc.
+    tier, timeline : (optional)
+        faster set up of the transforms for many times (only used with a
+        list of times), see Lgm_CTrans.Convert_Coords_Array
 
     Returns
     -------
@@ -111,6 +116,12 @@ def coordTrans(pos_in, time_in, in_sys, out_sys, de_eph=False):
     ----
     extend interface to get necessary args from a MagModel or cTrans structure
     '''
+    # many times at once (see batch.py)
+    if isinstance(time_in, (list, np.ndarray)) and \
+        'WGS84' not in in_sys and 'WGS84' not in out_sys:
+        from lgmpy import batch
+        return batch.coordTrans(pos_in, time_in, in_sys, out_sys, de_eph, tier, timeline).tolist()
+
     # change datetime to Lgm Datelong and UTC
     ct = Lgm_CTrans.Lgm_CTrans(0)
     if de_eph:
@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+"""
+Test suite for the Lgm_QinDenton file
+"""
+
+import unittest
+import datetime
+from ctypes import pointer
+
+import numpy
+
+from lgmpy import Lgm_QinDenton
+from lgmpy import Lgm_CTrans
+from lgmpy.Lgm_Wrap import Lgm_QinDentonOne, Lgm_get_QinDenton_at_JD, Lgm_Date_to_JD
+
+class Lgm_QinDenton_Tests(unittest.TestCase):
+    def setUp(self):
+        super(Lgm_QinDenton_Tests, self).setUp()
+        self.t = [datetime.datetime(2005, 8, 31, 23) + datetime.timedelta(minutes=17*i) for i in range(10)]
+
+    def tearDown(self):
+        super(Lgm_QinDenton_Tests, self).tearDown()
+
+    def test_get_QinDenton(self):
+        """get_QinDenton should match Lgm_get_QinDenton_at_JD one time at a time"""
+        qd = Lgm_QinDenton.get_QinDenton(self.t[::-1])
+        self.assertEqual(qd['Dst'].shape, (10,))
+        c = Lgm_CTrans.Lgm_CTrans(0)
+        for i, dt in enumerate(self.t[::-1]):
+            p = Lgm_QinDentonOne()
+            UTC = dt.hour + dt.minute/60. + dt.second/3600.
+            Lgm_get_QinDenton_at_JD(Lgm_Date_to_JD(dt.year*10000 + dt.month*100 + dt.day, UTC, pointer(c)), pointer(p), 0, 0)
+            self.assertEqual(qd['Date'][i], p.Date)
+            for key in ('fKp', 'Dst', 'Pdyn', 'BzIMF', 'W3'):
+                numpy.testing.assert_allclose(qd[key][i], getattr(p, key), rtol=1e-9)
+
+    def test_scalar(self):
+        """get_QinDenton takes a single datetime too"""
+        qd = Lgm_QinDenton.get_QinDenton(self.t[0])
+        self.assertEqual(qd['fKp'].shape, (1,))
+
+
+if __name__ == '__main__':
+    unittest.main()
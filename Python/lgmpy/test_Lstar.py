@@ -95,6 +95,17 @@ class Lstar_Tests(unittest.TestCase):
             ans = Lstar.get_Lstar([-rdist,0,0], self.date, alpha=9, coord_system='SM', Bfield='Lgm_B_cdip', LstarQuality=qlevel)
             numpy.testing.assert_allclose(ans[9]['Lstar'][...], rdist, atol=10**(-1*(qlevel-2)), rtol=10**(-1*(qlevel)))
 
+    def test_get_Lstar_batch(self):
+        """get_Lstar_batch should match get_Lstar point by point, whatever the workers"""
+        pos = [[-4.2, 1, 1], [-5, 0, 1], [-3, -1, 0]]
+        ans1 = Lstar.get_Lstar_batch(pos, self.date, [30, 90], coord_system='SM', workers=1, LstarQuality=1)
+        ans4 = Lstar.get_Lstar_batch(pos, self.date, [30, 90], coord_system='SM', workers=4, LstarQuality=1)
+        self.assertEqual(ans1['Lstar'].shape, (3, 2))
+        numpy.testing.assert_allclose(ans1['Lstar'], ans4['Lstar'], rtol=1e-6)
+        for i, p in enumerate(pos):
+            ans = Lstar.get_Lstar(p, self.date, alpha=90, coord_system='SM', LstarQuality=1)
+            numpy.testing.assert_allclose(ans1['Lstar'][i, 1], ans[90]['Lstar'][...], rtol=1e-4)
+
 class Lstar_Data_Tests(unittest.TestCase):
     def setUp(self):
         super(Lstar_Data_Tests, self).setUp()
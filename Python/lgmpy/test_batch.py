@@ -0,0 +1,78 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+"""
+Test suite for the array (batch) versions of the lgmpy calculations
+"""
+
+import unittest
+import datetime
+
+import numpy
+
+from lgmpy import batch
+from lgmpy import magcoords
+from lgmpy import Lgm_T89
+
+class batch_Tests(unittest.TestCase):
+    def setUp(self):
+        super(batch_Tests, self).setUp()
+        self.pos = [-6.6, 0, 0]
+        self.dt = datetime.datetime(2005, 8, 31, 9, 0, 0)
+
+    def tearDown(self):
+        super(batch_Tests, self).tearDown()
+
+    def test_B(self):
+        """batch.B should match the per point T89 (regression)"""
+        ans = [[-18.92608102838227, -1.8575154402941223, 80.05211611259763],
+            [-20.783024662565946, -1.8575154402941223, 74.2809609414084 ],
+            [-22.512615841596073, -1.8575154402941223, 70.18331903086782],
+            [-26.36648155861654, -1.8575154402941223,  64.30381088411946 ], ]
+        B = batch.B([self.pos]*4, self.dt, range(4))
+        self.assertEqual(B.shape, (4, 3))
+        numpy.testing.assert_allclose(B, ans, rtol=1e-6)
+
+    def test_B_times(self):
+        """batch.B with one time per point"""
+        dts = [self.dt + datetime.timedelta(hours=i) for i in range(3)]
+        B = batch.B([self.pos]*3, dts, 2)
+        for i, dt in enumerate(dts):
+            numpy.testing.assert_allclose(B[i], Lgm_T89.T89(self.pos, dt, 2), rtol=1e-6)
+
+    def test_B_ensemble(self):
+        """batch.B_ensemble should match batch.B for each model"""
+        pos = [self.pos, [-3, 1, 2], [5, -1, 0.5]]
+        Bfields = ['Lgm_B_T89', 'Lgm_B_cdip', 'Lgm_B_OP77']
+        B = batch.B_ensemble(pos, self.dt, Bfields, Kp=2)
+        self.assertEqual(B.shape, (3, 3, 3))
+        for k, Bfield in enumerate(Bfields):
+            numpy.testing.assert_allclose(B[:, k], batch.B(pos, self.dt, 2, Bfield=Bfield), rtol=1e-10)
+
+    def test_coordTrans(self):
+        """batch.coordTrans should match magcoords.coordTrans"""
+        pos = [[-4, 0, 0], [-3, 1, 2], [5, -1, 0.5]]
+        dts = [datetime.datetime(2009, 1, 1), datetime.datetime(2009, 1, 1, 6),
+               datetime.datetime(2010, 7, 4, 12, 30)]
+        ans = batch.coordTrans(pos, dts, 'SM', 'GSM')
+        for i in range(3):
+            numpy.testing.assert_allclose(ans[i], magcoords.coordTrans(pos[i], dts[i], 'SM', 'GSM'), atol=1e-8)
+
+    def test_coordTrans_unsorted(self):
+        """batch.coordTrans with times out of order, and with a timeline"""
+        n = 50
+        pos = numpy.column_stack([numpy.linspace(-7, 7, n), numpy.linspace(3, -2, n), numpy.ones(n)])
+        dts = [datetime.datetime(2009, 1, 1) + datetime.timedelta(minutes=(37*i) % n) for i in range(n)]
+        ans = batch.coordTrans(pos, dts, 'GSM', 'GEI2000')
+        for i in (0, 7, 31, 49):
+            numpy.testing.assert_allclose(ans[i], magcoords.coordTrans(pos[i].tolist(), dts[i], 'GSM', 'GEI2000'), atol=1e-8)
+        ans_tl = batch.coordTrans(pos, dts, 'GSM', 'GEI2000', timeline=600)
+        numpy.testing.assert_allclose(ans_tl, ans, atol=1e-8)
+
+    def test_bad_lengths(self):
+        """times and positions must have the same length"""
+        self.assertRaises(ValueError, batch.B, [self.pos]*3, [self.dt]*2, 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -14,6 +14,10 @@ Test suite for the Lgm_OP77 file
 import unittest
 import datetime
 import itertools
+import ctypes
+import gzip
+import os
+import tempfile
 
 import numpy as np
 
@@ -31,6 +35,41 @@ class Utils_Tests(unittest.TestCase):
         self.assertEqual(Lgm_Vector.Lgm_Vector(*a), utils.pos2Lgm_Vector(Lgm_Vector.Lgm_Vector(*a)))
         self.assertEqual(Lgm_Vector.Lgm_Vector(*a), utils.pos2Lgm_Vector(np.asarray(a)))
         self.assertEqual([Lgm_Vector.Lgm_Vector(*a)]*2, utils.pos2Lgm_Vector([a]*2))
+
+    def test_c_view(self):
+        """c_view should not copy"""
+        buf = (ctypes.c_double*4)(1, 2, 3, 4)
+        v = utils.c_view(buf, ctypes.addressof(buf), [2, 2])
+        np.testing.assert_equal(v, [[1, 2], [3, 4]])
+        v[1, 0] = 10
+        self.assertEqual(buf[2], 10)
+        self.assertTrue(v.base._owner is buf)
+
+    def test_struct_view(self):
+        """struct_view of an array of Lgm_Vectors has a trailing dimension of 3"""
+        class S(ctypes.Structure):
+            _fields_ = [('P', Lgm_Vector.Lgm_Vector*3), ('n', ctypes.c_int*3)]
+        s = S()
+        s.P[1] = Lgm_Vector.Lgm_Vector(1, 2, 3)
+        s.n[2] = 7
+        np.testing.assert_equal(utils.struct_view(s, s, 'P', 2), [[0, 0, 0], [1, 2, 3]])
+        np.testing.assert_equal(utils.struct_view(s, s, 'n'), [0, 0, 7])
+
+    def test_open_text(self):
+        """open_text should read plain and gzip'ed (multi-member) files the same"""
+        d = tempfile.mkdtemp()
+        plain, gz = os.path.join(d, 'a.txt'), os.path.join(d, 'a.txt.gz')
+        with open(plain, 'w') as f:
+            f.write('# header\n1 2 3\n')
+        with gzip.open(gz, 'wt') as f:
+            f.write('# header\n')
+        with gzip.open(gz, 'at') as f:
+            f.write('1 2 3\n')
+        for name in (plain, gz):
+            with utils.open_text(name) as f:
+                self.assertEqual(f.readlines(), ['# header\n', '1 2 3\n'])
+            os.remove(name)
+        os.rmdir(d)
         
                 
         
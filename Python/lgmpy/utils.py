@@ -3,12 +3,15 @@ from __future__ import division
 """
 collection of utility routines uses around lgmpy
 """
+import ctypes
+import gzip
+
 import numpy as np
 
 import Lgm_Vector
 
 
-all = ['pos2Lgm_Vector']
+all = ['pos2Lgm_Vector', 'c_view', 'struct_view', 'open_text']
 
 def pos2Lgm_Vector(pos):
     if isinstance(pos, Lgm_Vector.Lgm_Vector):
@@ -25,3 +28,54 @@ def pos2Lgm_Vector(pos):
 
 
 
+
+
+class _CBuffer(object):
+    """
+    numpy array interface to memory owned by C. Holds a reference to the
+    python object that owns the memory, so arrays made from it keep that
+    object (and so the memory) alive.
+    """
+    def __init__(self, owner, address, shape, typestr):
+        self._owner = owner
+        self.__array_interface__ = {'version': 3,
+                                    'data': (address, False),
+                                    'shape': tuple(shape),
+                                    'typestr': typestr}
+
+def c_view(owner, address, shape, ctype=ctypes.c_double):
+    """
+    numpy array (no copy) of the C array at address. ctype can be c_double,
+    c_int or Lgm_Vector (which adds a trailing dimension of 3). The array
+    keeps owner alive.
+    """
+    if not address:
+        raise(ValueError('NULL array'))
+    shape = list(shape)
+    if issubclass(ctype, ctypes.Structure): # Lgm_Vector
+        shape.append(3)
+        ctype = ctypes.c_double
+    return np.asarray(_CBuffer(owner, address, shape, np.dtype(ctype).str))
+
+def struct_view(owner, struct, name, n=None):
+    """
+    numpy array (no copy) of the fixed size array struct.name (e.g.
+    LstarInfo.I). Only the first n elements if n is given. The array keeps
+    owner alive.
+    """
+    arr = getattr(struct, name)
+    if n is None:
+        n = len(arr)
+    return c_view(owner, ctypes.addressof(arr), [n], arr._type_)
+
+def open_text(filename):
+    """
+    open one of the text output files (MagEphem, LCDS, ...) for reading,
+    decompressing it on the fly if it was written gzip'ed (with -g). Goes by
+    the contents, not the name.
+    """
+    with open(filename, 'rb') as f:
+        magic = f.read(2)
+    if magic == b'\x1f\x8b':
+        return gzip.open(filename, 'rt')
+    return open(filename, 'r')
@@ -0,0 +1,169 @@
+/*
+ *  Checkpoint/resume support for the tools.
+ *
+ *  The tools write their output a row (one epoch) at a time, into one file
+ *  per day (and bird). If a run is killed part way through a day, the file
+ *  it was writing is incomplete, and the only way to finish it used to be
+ *  to redo the whole day. Now, each time rows are known to be on disk, the
+ *  tool writes a small text file next to the output file,
+ *
+ *      <output>.ckpt
+ *
+ *  holding the number of completed rows, the size of the text output at
+ *  that point and the time of the last completed row. The checkpoint is
+ *  written to a temporary file that is then renamed, so it is never seen
+ *  half written. It is removed once the output file is complete, so a file
+ *  that still has a checkpoint is one that was interrupted.
+ *
+ *  When a tool is run again with its resume option, it reads the
+ *  checkpoint, cuts the text output back to the checkpointed size (rows
+ *  written after the last checkpoint may not have made it into the other
+ *  outputs), skips the epochs that are already done and carries on from
+ *  the next one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "Checkpoint.h"
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+
+/*
+ *  Set up a (not yet read or written) checkpoint for the given output file.
+ */
+void Checkpoint_Init( const char *Output, Checkpoint *k ) {
+
+    snprintf( k->Output, sizeof(k->Output), "%s", Output );
+    snprintf( k->File, sizeof(k->File), "%s.ckpt", Output );
+    k->nRows       = 0;
+    k->nTxtBytes   = -1;
+    k->LastTime[0] = '\0';
+
+}
+
+
+/*
+ *  Read the checkpoint file. Returns TRUE if there is one (i.e. the output
+ *  file is incomplete) and it is readable.
+ */
+int Checkpoint_Read( Checkpoint *k ) {
+
+    FILE    *fp;
+    char    Line[4096], Output[2048];
+    int     nFound = 0;
+    size_t  n;
+
+    if ( (fp = fopen( k->File, "r" )) == NULL ) return( FALSE );
+
+    Output[0] = '\0';
+    while ( fgets( Line, sizeof(Line), fp ) != NULL ) {
+        if ( Line[0] == '#' ) continue;
+        if ( !strncmp( Line, "Output: ", 8 ) ) {
+            // the rest of the line (file names may have blanks in them)
+            snprintf( Output, sizeof(Output), "%s", Line+8 );
+            n = strlen( Output );
+            if ( ( n > 0 ) && ( Output[n-1] == '\n' ) ) Output[n-1] = '\0';
+            ++nFound;
+        }
+        if ( sscanf( Line, "Rows: %ld", &k->nRows ) == 1 ) ++nFound;
+        if ( sscanf( Line, "TxtBytes: %ld", &k->nTxtBytes ) == 1 ) ++nFound;
+        if ( sscanf( Line, "LastTime: %79s", k->LastTime ) == 1 ) ++nFound;
+    }
+    fclose( fp );
+
+    if ( ( nFound < 3 ) || strcmp( Output, k->Output ) ) {
+        printf( "\tCheckpoint file %s is not usable, ignoring it.\n", k->File );
+        k->nRows     = 0;
+        k->nTxtBytes = -1;
+        return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Record that the first nRows rows of the output are on disk (and that the
+ *  text output, if there is one, is nTxtBytes long at that point).
+ */
+int Checkpoint_Write( long int nRows, long int nTxtBytes, const char *LastTime, Checkpoint *k ) {
+
+    FILE    *fp;
+    char    Tmp[2200];
+
+    k->nRows     = nRows;
+    k->nTxtBytes = nTxtBytes;
+    snprintf( k->LastTime, sizeof(k->LastTime), "%s", LastTime );
+
+    snprintf( Tmp, sizeof(Tmp), "%s.tmp", k->File );
+    if ( (fp = fopen( Tmp, "w" )) == NULL ) {
+        printf( "\tCould not write checkpoint file %s\n", Tmp );
+        return( FALSE );
+    }
+    fprintf( fp, "# Checkpoint of an unfinished output file (see Tools/Checkpoint.c).\n" );
+    fprintf( fp, "Output: %s\n", k->Output );
+    fprintf( fp, "Rows: %ld\n", k->nRows );
+    fprintf( fp, "TxtBytes: %ld\n", k->nTxtBytes );
+    fprintf( fp, "LastTime: %s\n", ( k->LastTime[0] != '\0' ) ? k->LastTime : "-" );
+    if ( ( fflush( fp ) != 0 ) || ( fsync( fileno( fp ) ) != 0 ) ) {
+        fclose( fp );
+        printf( "\tCould not write checkpoint file %s\n", Tmp );
+        return( FALSE );
+    }
+    fclose( fp );
+
+    if ( rename( Tmp, k->File ) != 0 ) {
+        printf( "\tCould not rename checkpoint file %s to %s\n", Tmp, k->File );
+        return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  The output is complete (or is being redone from scratch).
+ */
+void Checkpoint_Remove( Checkpoint *k ) {
+    unlink( k->File );
+}
+
+
+/*
+ *  Cut the text output back to what it was when the checkpoint was
+ *  written.
+ */
+int Checkpoint_TruncateTxt( const char *TxtFile, Checkpoint *k ) {
+
+    if ( k->nTxtBytes < 0 ) return( TRUE );
+    if ( truncate( TxtFile, (off_t)k->nTxtBytes ) != 0 ) {
+        printf( "\tCould not truncate %s to %ld bytes\n", TxtFile, k->nTxtBytes );
+        return( FALSE );
+    }
+    return( TRUE );
+
+}
+
+
+/*
+ *  Size of a file in bytes (-1 if it isn't there).
+ */
+long int Checkpoint_FileSize( const char *File ) {
+
+    struct stat StatBuf;
+
+    if ( stat( File, &StatBuf ) != 0 ) return( -1 );
+    return( (long int)StatBuf.st_size );
+
+}
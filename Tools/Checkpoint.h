@@ -0,0 +1,26 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ *  Checkpoints for the output files of the long running tools
+ *  (MagEphemFromTLE, MagEphemFromSpiceKernel, LastClosedDriftShell). While
+ *  an output file is being written, <file>.ckpt records how many of its
+ *  rows (epochs) are safely on disk, so that an interrupted run can be
+ *  resumed from there. See Checkpoint.c.
+ */
+typedef struct Checkpoint {
+    char        File[2100];     // the checkpoint file (<Output>.ckpt)
+    char        Output[2048];   // the output file it is for
+    long int    nRows;          // number of rows that are on disk
+    long int    nTxtBytes;      // size of the text output file after those rows (-1 if there isn't one)
+    char        LastTime[80];   // IsoTime of the last of them
+} Checkpoint;
+
+void Checkpoint_Init( const char *Output, Checkpoint *k );
+int  Checkpoint_Read( Checkpoint *k );
+int  Checkpoint_Write( long int nRows, long int nTxtBytes, const char *LastTime, Checkpoint *k );
+void Checkpoint_Remove( Checkpoint *k );
+int  Checkpoint_TruncateTxt( const char *TxtFile, Checkpoint *k );
+long int Checkpoint_FileSize( const char *File );
+
+#endif
@@ -11,10 +11,18 @@
 #include <Lgm_MagEphemInfo.h>
 #include <Lgm_QinDenton.h>
 #include <Lgm_Misc.h>
+#include <Lgm_MemoryUsage.h>
+#include <Lgm_Tasks.h>
+#include <Lgm_Prefetch.h>
+#include <Lgm_Sink.h>
+#include "Checkpoint.h"
 
 #define MAIN
 #define TRACE_TOL   1e-7
 #define KP_DEFAULT  1
+#define BRAC1       -3.5    // default search bracket (equatorial radius in Re)
+#define BRAC2       -13.0
+#define SEED_MARGIN 1.0     // how far (Re) either side of the last LCDSs to bracket the next time
 
 void StringSplit( char *Str, char *StrArray[], int len, int *n );
 
@@ -30,7 +38,10 @@ static char doc[] = "\nComputes last closed drift shell for given times, Ks and
                     " month.\n"
                     " Here is an example using time variables,\n\n \t./LastClosedDriftShell -S 20020901 -E 20020930\n"
                     " \t\t/home/jsmith/MagEphemData/%YYYY/%YYYY%MM%DD_LCDS_%EE.txt.\n\n Directories"
-                    " in the output file will be created if they don't already exist.\n\n";
+                    " in the output file will be created if they don't already exist.\n\n"
+                    " The times are done in parallel (set OMP_NUM_THREADS to limit it), and"
+                    " each is bracketed from the LCDS of the latest finished time. Rows are"
+                    " written as they are done, so an interrupted run can be resumed (-R).\n\n";
 
 
 // Mandatory arguments
@@ -61,6 +72,8 @@ static struct argp_option Options[] = {
     {"EndDate",         'E',    "yyyymmdd",                   0,        "EndDate "                                },
     {"UseEop",          'e',    0,                            0,        "Use Earth Orientation Parameters when computing ephemerii" },
     {"Force",           'F',    0,                            0,        "Overwrite output file even if it already exists" },
+    {"Gzip",            'g',    0,                            0,        "Write gzip'ed output (a .gz is added to the filename if it doesnt have one already). The compression is done on background threads while the LCDSs are computed." },
+    {"Resume",          'R',    0,                            0,        "Resume an interrupted run. Days whose files are complete are skipped, and a file that was interrupted (it still has a <file>.ckpt checkpoint next to it) is carried on from its last checkpointed time." },
     {"verbose",         'v',    "verbosity",                  0,        "Produce verbose output"                  },
     {"silent",          's',    0,                            OPTION_ARG_OPTIONAL | OPTION_ALIAS                                                },
     { 0 }
@@ -78,6 +91,8 @@ struct Arguments {
     int         Quality;
     int         nFLsInDriftShell;
     int         Force;
+    int         Resume;
+    int         Gzip;
     double      LT;
     double      FootPointHeight;
     double      Delta;
@@ -116,6 +131,12 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'F':
             arguments->Force = 1;
             break;
+        case 'R':
+            arguments->Resume = 1;
+            break;
+        case 'g':
+            arguments->Gzip = 1;
+            break;
         case 'f':
             sscanf( arg, "%lf", &arguments->FootPointHeight );
             break;
@@ -159,23 +180,171 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
 static struct argp argp = { Options, parse_opt, ArgsDoc, doc };
 
 
+/*
+ *  Brackets for the next time, SEED_MARGIN either side of the radii of the
+ *  LCDSs just found (the default ones if none were found).
+ */
+static void SeedBrackets( int nK, double *R, int *Flag, double *brac1, double *brac2 ) {
+
+    int     i, n;
+    double  Rmin = 0.0, Rmax = 0.0;
+
+    for ( n=0, i=0; i<nK; i++ ) {
+        if ( Flag[i] != 0 ) continue;
+        if ( ( n == 0 ) || ( fabs( R[i] ) < Rmin ) ) Rmin = fabs( R[i] );
+        if ( ( n == 0 ) || ( fabs( R[i] ) > Rmax ) ) Rmax = fabs( R[i] );
+        ++n;
+    }
+
+    if ( n == 0 ) {
+        *brac1 = BRAC1; *brac2 = BRAC2;
+    } else {
+        *brac1 = -( ( Rmin - SEED_MARGIN > 2.0 ) ? Rmin - SEED_MARGIN : 2.0 );
+        *brac2 = -( Rmax + SEED_MARGIN );
+    }
+
+}
+
+
+/*
+ *  Write the header of a (daily) output file.
+ */
+static void WriteHeader( FILE *fp, int nK, double *Kin ) {
+
+    int     i;
+    char    Str[128];
+
+    int nCol = 0;
+
+    fprintf( fp, "# {\n");
+    if ( nK > 0 ) {
+        fprintf( fp, "#  \"K\":            { \"DESCRIPTION\": \"Modified second adiabatic invariant, K (as specified)\",\n");
+        fprintf( fp, "#                               \"NAME\": \"Kin\",\n");
+        fprintf( fp, "#                              \"TITLE\": \"Kin\",\n");
+        fprintf( fp, "#                              \"LABEL\": \"Kin\",\n");
+        fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
+        fprintf( fp, "#                             \"VALUES\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "%g, ", Kin[i] );
+        fprintf(fp, "%g ],\n", Kin[i] ); 
+
+        fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"PA%d\", ", i );
+        fprintf(fp, "\"PA%d\" ],\n", i ); 
+
+        fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"%g R_E G^1/2\", ", Kin[i] );
+        fprintf(fp, "\"%g Deg.\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                              \"UNITS\": \"R_E G^1/2\",\n");
+        fprintf( fp, "#                          \"VALID_MIN\":  0.0,\n");
+        fprintf( fp, "#                          \"VALID_MAX\": 20.0,\n");
+        fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
+        fprintf( fp, "#\n");
+    }
+
+    fprintf( fp, "#  \"DateTime\":         { \"DESCRIPTION\": \"The date and time in ISO 8601 compliant format.\",\n");
+    fprintf( fp, "#                               \"NAME\": \"IsoDateTime\",\n");
+    fprintf( fp, "#                              \"TITLE\": \"ISO DateTime\",\n");
+    fprintf( fp, "#                              \"LABEL\": \"Time\",\n");
+    fprintf( fp, "#                              \"UNITS\": \"UTC\",\n");
+    fprintf( fp, "#                       \"START_COLUMN\": %d },\n", nCol++);
+    fprintf( fp, "#\n");
+
+    if ( nK > 0 ) {
+        fprintf( fp, "#  \"LCDS\":            { \"DESCRIPTION\": \"Last closed generalized Roederer L-shell value (also known as L*).\",\n");
+        fprintf( fp, "#                               \"NAME\": \"LCDS\",\n");
+        fprintf( fp, "#                              \"TITLE\": \"LCDS\",\n");
+        fprintf( fp, "#                              \"LABEL\": \"LCDS, Dimensionless\",\n");
+        fprintf( fp, "#                              \"UNITS\": \"Dimensionless\",\n");
+        fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
+        fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
+        fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"LCDS_%g\", ", Kin[i] );
+        fprintf(fp, "\"LCDS_%g\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"LCDS K=%g\", ", Kin[i] );
+        fprintf(fp, "\"LCDS %g!Eo!N\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
+        fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
+        fprintf( fp, "#                          \"VALID_MAX\": 1000.0,\n");
+        fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
+        fprintf( fp, "#\n");
+    }
+    if ( nK > 0 ) {
+        fprintf( fp, "#  \"Kcalc\":          { \"DESCRIPTION\": \"Modified second adiabatic invariant, K, calculated during drift shell trace\",\n");
+        fprintf( fp, "#                               \"NAME\": \"K\",\n");
+        fprintf( fp, "#                              \"TITLE\": \"K\",\n");
+        fprintf( fp, "#                              \"LABEL\": \"K, [R_E G^1/2]\",\n");
+        fprintf( fp, "#                              \"UNITS\": \"R_E G^1/2\",\n");
+        fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
+        fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
+        fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"K_%g\", ", Kin[i] );
+        fprintf(fp, "\"K_%g\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"K %g\", ", Kin[i] );
+        fprintf(fp, "\"K %g!Eo!N\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
+        fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
+        fprintf( fp, "#                          \"VALID_MAX\": 1000.0,\n");
+        fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
+        fprintf( fp, "#\n");
+    }
+    if ( nK > 0 ) {
+        fprintf( fp, "#  \"Bmirror\":        { \"DESCRIPTION\": \"Mirror magnetic field strength\",\n");
+        fprintf( fp, "#                               \"NAME\": \"Bm\",\n");
+        fprintf( fp, "#                              \"TITLE\": \"Bm\",\n");
+        fprintf( fp, "#                              \"LABEL\": \"Bm, [nT]\",\n");
+        fprintf( fp, "#                              \"UNITS\": \"nT\",\n");
+        fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
+        fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
+        fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"K_%g\", ", Kin[i] );
+        fprintf(fp, "\"Bm_%g\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
+        for (i=0; i<nK-1; i++) fprintf(fp, "\"Bm K=%g\", ", Kin[i] );
+        fprintf(fp, "\"K %g!Eo!N\" ],\n", Kin[i] ); 
+        fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
+        fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
+        fprintf( fp, "#                          \"VALID_MAX\": 10000.0,\n");
+        fprintf( fp, "#                         \"FILL_VALUE\": -1e31 }\n");
+        fprintf( fp, "#\n");
+    }
+    fprintf( fp, "# } end JSON\n");
+    fprintf( fp, "#\n");
+    // column header
+    fprintf( fp, "# %24s", "Time" );
+    for (i=0; i<nK; i++) { sprintf( Str, "L*%d", i ); fprintf(fp, " %8s", Str ); }
+    fprintf(fp, "    ");
+    for (i=0; i<nK; i++) { sprintf( Str, "K%d", i ); fprintf(fp, " %8s", Str ); }
+    fprintf(fp, "    ");
+    fprintf(fp, "%s", " \n");
+
+}
+
+
 int main( int argc, char *argv[] ){
 
     struct Arguments arguments;
     double           UTC, brac1, brac2, tol, sJD, eJD, JD, jDate, t_cadence;
-    double           K[500], LS[500], Kin[500], Bm[500];
+    double           Kin[500], Seed1, Seed2;
     double           Inc, FootpointHeight, LT;
-    int              Force, UseEop;
+    int              Force, Resume, Resuming, UseEop;
+    long int         iRow, nRows, nResume;
+    Checkpoint       Ckpt;
     long int         StartDate, EndDate, Date, currDate;
-    int              nK, i, Quality, nFLsInDriftShell, ans, aa, Year, Month, Day;
+    int              nK, i, Quality, nFLsInDriftShell, nThreads, Year, Month, Day;
     char             Str[128], NewStr[2048];
+    Lgm_IsoTimeFormatter IsoTimeFmt;
     char             IntModel[20], ExtModel[20];
     char             Filename[1024];
     Lgm_LstarInfo    *LstarInfo = InitLstarInfo(0);
-    Lgm_LstarInfo    *LstarInfo3;
+    Lgm_MemoryReport MemReport;
+    size_t           ThreadBytes = 0;
     FILE             *fp;
+    Lgm_Sink         *Sink;
     Lgm_DateTime     DT_UTC;
     Lgm_QinDentonOne qd;
+    Lgm_Prefetcher   *Prefetcher;
 
     tol = 0.001;
 
@@ -192,6 +361,8 @@ int main( int argc, char *argv[] ){
     arguments.nFLsInDriftShell = 24;
     arguments.Delta            = 30;
     arguments.Force            = 0;
+    arguments.Resume           = 0;
+    arguments.Gzip             = 0;
     arguments.LT               = 0.0;
     arguments.UseEop           = 0;
     arguments.StartDate        = -1;
@@ -227,6 +398,7 @@ int main( int argc, char *argv[] ){
     nFLsInDriftShell = arguments.nFLsInDriftShell;
     t_cadence        = arguments.Delta/1440.0; //needs to be in days
     Force            = arguments.Force;
+    Resume           = arguments.Resume;
     LT               = arguments.LT;
     UseEop           = arguments.UseEop;
     StartDate        = arguments.StartDate;
@@ -279,8 +451,19 @@ int main( int argc, char *argv[] ){
     sJD = Lgm_Date_to_JD( StartDate, 0.0, LstarInfo->mInfo->c);
     eJD = Lgm_Date_to_JD( EndDate, 23.9999, LstarInfo->mInfo->c);
 
+    nThreads = Lgm_GetMaxThreads();
+    Seed1 = BRAC1; Seed2 = BRAC2;
+
+    Prefetcher = Lgm_InitPrefetcher( LGM_PREFETCH_QINDENTON );
+    Lgm_Prefetch( Prefetcher, StartDate );
 
     for (jDate = sJD; jDate <= eJD; jDate+= 1.0 ) {
+
+        /*
+         *  Read the next day's QinDenton values in the background while this
+         *  day is done (see Lgm_Prefetch.c).
+         */
+        if ( jDate + 1.0 <= eJD ) Lgm_Prefetch( Prefetcher, Lgm_JD_to_Date( jDate + 1.0, &Year, &Month, &Day, &UTC ) );
     
         /*
          *  Set output filename, etc.
@@ -296,193 +479,150 @@ int main( int argc, char *argv[] ){
         sprintf( Str, "%02d", Month ); Lgm_ReplaceSubString( NewStr, Filename, "%MM", Str );   strcpy( Filename, NewStr );
         sprintf( Str, "%02d", Day );   Lgm_ReplaceSubString( NewStr, Filename, "%DD", Str );   strcpy( Filename, NewStr );
         sprintf( Str, "%s", ExtModel );   Lgm_ReplaceSubString( NewStr, Filename, "%EE", Str );   strcpy( Filename, NewStr );
-        fp = fopen(Filename, "w");
-    
-        // Bracket Position in GSM
-        brac1 = -3.5;
-        brac2 = -13.0;
-    
-    
+        if ( arguments.Gzip && !Lgm_Sink_IsGzipName( Filename ) ) strcat( Filename, ".gz" );
+
         /*
-         * Write Header
+         *  When resuming, skip the days that are done (their files have no
+         *  checkpoint left), and pick up the interrupted one where it left
+         *  off (see Checkpoint.c).
          */
-        int nCol = 0;
-    
-        fprintf( fp, "# {\n");
-        if ( nK > 0 ) {
-            fprintf( fp, "#  \"K\":            { \"DESCRIPTION\": \"Modified second adiabatic invariant, K (as specified)\",\n");
-            fprintf( fp, "#                               \"NAME\": \"Kin\",\n");
-            fprintf( fp, "#                              \"TITLE\": \"Kin\",\n");
-            fprintf( fp, "#                              \"LABEL\": \"Kin\",\n");
-            fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
-            fprintf( fp, "#                             \"VALUES\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "%g, ", Kin[i] );
-            fprintf(fp, "%g ],\n", Kin[i] ); 
-    
-            fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"PA%d\", ", i );
-            fprintf(fp, "\"PA%d\" ],\n", i ); 
-    
-            fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"%g R_E G^1/2\", ", Kin[i] );
-            fprintf(fp, "\"%g Deg.\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                              \"UNITS\": \"R_E G^1/2\",\n");
-            fprintf( fp, "#                          \"VALID_MIN\":  0.0,\n");
-            fprintf( fp, "#                          \"VALID_MAX\": 20.0,\n");
-            fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
-            fprintf( fp, "#\n");
+        Checkpoint_Init( Filename, &Ckpt );
+        Resuming = FALSE;
+        nResume  = 0;
+        if ( Resume && !Force ) {
+            if ( Checkpoint_Read( &Ckpt ) ) {
+                printf( "%s was interrupted after %ld times (%s). Resuming from there.\n", Filename, Ckpt.nRows, Ckpt.LastTime );
+                Resuming = TRUE;
+                nResume  = Ckpt.nRows;
+            } else if ( Checkpoint_FileSize( Filename ) > 0 ) {
+                printf( "%s is already done. Skipping it.\n", Filename );
+                continue;
+            }
         }
     
-        fprintf( fp, "#  \"DateTime\":         { \"DESCRIPTION\": \"The date and time in ISO 8601 compliant format.\",\n");
-        fprintf( fp, "#                               \"NAME\": \"IsoDateTime\",\n");
-        fprintf( fp, "#                              \"TITLE\": \"ISO DateTime\",\n");
-        fprintf( fp, "#                              \"LABEL\": \"Time\",\n");
-        fprintf( fp, "#                              \"UNITS\": \"UTC\",\n");
-        fprintf( fp, "#                       \"START_COLUMN\": %d },\n", nCol++);
-        fprintf( fp, "#\n");
-    
-        if ( nK > 0 ) {
-            fprintf( fp, "#  \"LCDS\":            { \"DESCRIPTION\": \"Last closed generalized Roederer L-shell value (also known as L*).\",\n");
-            fprintf( fp, "#                               \"NAME\": \"LCDS\",\n");
-            fprintf( fp, "#                              \"TITLE\": \"LCDS\",\n");
-            fprintf( fp, "#                              \"LABEL\": \"LCDS, Dimensionless\",\n");
-            fprintf( fp, "#                              \"UNITS\": \"Dimensionless\",\n");
-            fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
-            fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
-            fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"LCDS_%g\", ", Kin[i] );
-            fprintf(fp, "\"LCDS_%g\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"LCDS K=%g\", ", Kin[i] );
-            fprintf(fp, "\"LCDS %g!Eo!N\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
-            fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
-            fprintf( fp, "#                          \"VALID_MAX\": 1000.0,\n");
-            fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
-            fprintf( fp, "#\n");
+        /*
+         * Write Header. When resuming, the file already has it (and the
+         * rows up to the checkpoint), so just carry on at the end.
+         */
+        if ( Resuming ) {
+            Checkpoint_TruncateTxt( Filename, &Ckpt );
+            Sink = Lgm_Sink_Open( Filename, "a", 0 );
+        } else {
+            Checkpoint_Remove( &Ckpt );
+            Sink = Lgm_Sink_Open( Filename, "w", 0 );
         }
-        if ( nK > 0 ) {
-            fprintf( fp, "#  \"Kcalc\":          { \"DESCRIPTION\": \"Modified second adiabatic invariant, K, calculated during drift shell trace\",\n");
-            fprintf( fp, "#                               \"NAME\": \"K\",\n");
-            fprintf( fp, "#                              \"TITLE\": \"K\",\n");
-            fprintf( fp, "#                              \"LABEL\": \"K, [R_E G^1/2]\",\n");
-            fprintf( fp, "#                              \"UNITS\": \"R_E G^1/2\",\n");
-            fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
-            fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
-            fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"K_%g\", ", Kin[i] );
-            fprintf(fp, "\"K_%g\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"K %g\", ", Kin[i] );
-            fprintf(fp, "\"K %g!Eo!N\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
-            fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
-            fprintf( fp, "#                          \"VALID_MAX\": 1000.0,\n");
-            fprintf( fp, "#                         \"FILL_VALUE\": -1e31 },\n");
-            fprintf( fp, "#\n");
+        if ( Sink == NULL ) {
+            printf( "Could not open %s for writing. Skipping it.\n", Filename );
+            continue;
         }
-        if ( nK > 0 ) {
-            fprintf( fp, "#  \"Bmirror\":        { \"DESCRIPTION\": \"Mirror magnetic field strength\",\n");
-            fprintf( fp, "#                               \"NAME\": \"Bm\",\n");
-            fprintf( fp, "#                              \"TITLE\": \"Bm\",\n");
-            fprintf( fp, "#                              \"LABEL\": \"Bm, [nT]\",\n");
-            fprintf( fp, "#                              \"UNITS\": \"nT\",\n");
-            fprintf( fp, "#                          \"DIMENSION\": [ %d ],\n", nK );
-            fprintf( fp, "#                       \"START_COLUMN\": %d,\n", nCol); nCol += nK;
-            fprintf( fp, "#                      \"ELEMENT_NAMES\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"K_%g\", ", Kin[i] );
-            fprintf(fp, "\"Bm_%g\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                     \"ELEMENT_LABELS\": [ ");
-            for (i=0; i<nK-1; i++) fprintf(fp, "\"Bm K=%g\", ", Kin[i] );
-            fprintf(fp, "\"K %g!Eo!N\" ],\n", Kin[i] ); 
-            fprintf( fp, "#                           \"DEPEND_1\": \"K\",\n");
-            fprintf( fp, "#                          \"VALID_MIN\": 0.0,\n");
-            fprintf( fp, "#                          \"VALID_MAX\": 10000.0,\n");
-            fprintf( fp, "#                         \"FILL_VALUE\": -1e31 }\n");
-            fprintf( fp, "#\n");
+        fp = Sink->fp;
+        if ( !Resuming ) {
+            WriteHeader( fp, nK, Kin );
         }
-        fprintf( fp, "# } end JSON\n");
-        fprintf( fp, "#\n");
-        // column header
-        fprintf( fp, "# %24s", "Time" );
-        for (i=0; i<nK; i++) { sprintf( Str, "L*%d", i ); fprintf(fp, " %8s", Str ); }
-        fprintf(fp, "    ");
-        for (i=0; i<nK; i++) { sprintf( Str, "K%d", i ); fprintf(fp, " %8s", Str ); }
-        fprintf(fp, "    ");
-        fprintf(fp, "%s", " \n");
 
         Lgm_SetLstarTolerances( Quality, nFLsInDriftShell, LstarInfo );
-    
-        //loop over date/time at given cadence
-        for ( JD = jDate; JD < jDate+1.0; JD += t_cadence ) {
+
+        /*
+         *  Do the times in parallel (each one with Lgm_LCDS_MultiK_Radii(),
+         *  which does all of the K values together). To control how many
+         *  threads get run use the environment variable OMP_NUM_THREADS. The
+         *  rows are written (and checkpointed) in order as they finish.
+         */
+        for ( nRows = 0; jDate + nRows*t_cadence < jDate+1.0; ++nRows );
+        IsoTimeFmt.Valid = FALSE;
+        #pragma omp parallel for ordered schedule(static, 1) num_threads(nThreads) private(JD, Date, UTC, Year, Month, Day, brac1, brac2, qd, DT_UTC, Str, i)
+        for ( iRow = nResume; iRow < nRows; ++iRow ) {
+
+            double          LS[500], K[500], Bm[500], R[500];
+            int             Flag[500];
+            Lgm_LstarInfo   *l = Lgm_CopyLstarInfo( LstarInfo );
+
             //set date specific stuff
+            JD   = jDate + iRow*t_cadence;
             Date = Lgm_JD_to_Date( JD, &Year, &Month, &Day, &UTC );
-            Lgm_Set_Coord_Transforms( Date, UTC, LstarInfo->mInfo->c);
-        
+            Lgm_Set_Coord_Transforms( Date, UTC, l->mInfo->c );
+
             Lgm_get_QinDenton_at_JD( JD, &qd, 1, 1 );
-            Lgm_set_QinDenton( &qd, LstarInfo->mInfo );
+            Lgm_set_QinDenton( &qd, l->mInfo );
 
-        
             /*
-             * Compute L*s, Is, Bms, etc...
+             * Compute the LCDS for all of the Ks. Bracket it from the last
+             * time that was done, and if that bracket turns out to be bad for
+             * any K, do this time again from the default one.
              */
-        
-            { // ***** BEGIN PARALLEL EXECUTION *****
-        
-                /*
-                 *  Do all of the PAs in parallel. To control how many threads get run
-                 *  use the enironment variable OMP_NUM_THREADS. For example,
-                 *          setenv OMP_NUM_THREADS 8
-                 *  will use 8 threads to do the loop in parallel. Be very careful what gets 
-                 *  set private here -- the threads must not interfere with each other.
-                 */
-                #pragma omp parallel private(LstarInfo3,ans)
-                #pragma omp for schedule(dynamic, 1)
-        
-                for (aa=0; aa<nK; ++aa) {
-                    // make a local copy of LstarInfo structure -- needed for multi-threading
-                    LstarInfo3 = Lgm_CopyLstarInfo( LstarInfo );
-                    //LstarInfo3->PitchAngle = Alpha[aa];
-                    //printf("Date, UTC, aa, Alpha, tol = %ld, %g, %d, %g, %g\n", Date, UTC, aa, LstarInfo3->PitchAngle, tol);
-        
-                    ans = Lgm_LCDS( Date, UTC, brac1, brac2, Kin[aa], LT, tol, Quality, nFLsInDriftShell, &K[aa], LstarInfo3 );
-                    if (LstarInfo3->DriftOrbitType == 1) printf("K: %g; Drift Orbit Type: Closed; L* = %g \n", Kin[aa], LstarInfo3->LS);
-                    if (LstarInfo3->DriftOrbitType == 2) printf("Drift Orbit Type: Shebansky; L* = %g\n", LstarInfo3->LS);
-                    if (ans==0) {
-                        LS[aa] = LstarInfo3->LS;
-                        Bm[aa] = LstarInfo3->mInfo->Bm;
-                    }
-                    else {
-                        K[aa] = LGM_FILL_VALUE;
-                        LS[aa] = LGM_FILL_VALUE;
-                        Bm[aa] = LGM_FILL_VALUE;
-                        printf("**==**==**==** (K = %g) Return value: %d\n", Kin[aa], ans);
- 
-                    }
-        
-                    FreeLstarInfo( LstarInfo3 );
+            #pragma omp critical (LCDS_Seed)
+            {
+                brac1 = Seed1; brac2 = Seed2;
+            }
+            Lgm_LCDS_MultiK_Radii( Date, UTC, brac1, brac2, nK, Kin, LT, tol, Quality, nFLsInDriftShell, LS, K, Bm, R, Flag, l );
+            if ( ( brac1 != BRAC1 ) || ( brac2 != BRAC2 ) ) {
+                for ( i=0; ( i < nK ) && ( Flag[i] != -8 ) && ( Flag[i] != -9 ); ++i );
+                if ( i < nK ) {
+                    if ( arguments.verbose > 0 ) printf( "Brackets [%g, %g] from the previous time are bad for K = %g. Redoing it from [%g, %g]\n", brac1, brac2, Kin[i], BRAC1, BRAC2 );
+                    Lgm_LCDS_MultiK_Radii( Date, UTC, BRAC1, BRAC2, nK, Kin, LT, tol, Quality, nFLsInDriftShell, LS, K, Bm, R, Flag, l );
                 }
-        
-            } // ***** END PARALLEL EXECUTION *****
-            Lgm_Make_UTC( Date, UTC, &DT_UTC, LstarInfo->mInfo->c );
-            Lgm_DateTimeToString( Str, &DT_UTC, 0, 3);
-            fprintf(fp, "%24s",     Str );
-            for ( i=0; i<nK; ++i ) {
-                fprintf( fp, "     %13g", LS[i]);
             }
             for ( i=0; i<nK; ++i ) {
-                fprintf( fp, "     %13g", K[i] );
+                if ( Flag[i] != 0 ) {
+                    printf("**==**==**==** (K = %g) Return value: %d\n", Kin[i], Flag[i] );
+                    K[i] = LS[i] = Bm[i] = LGM_FILL_VALUE;
+                }
             }
-            for ( i=0; i<nK; ++i ) {
-                fprintf( fp, "     %13g", Bm[i] );
+
+            if ( Lgm_MemoryReportMode() ) {
+                size_t b = Lgm_LstarInfo_MemoryUsage( l );
+                #pragma omp critical (MemoryUsage)
+                if ( b > ThreadBytes ) ThreadBytes = b;
+            }
+            Lgm_Make_UTC( Date, UTC, &DT_UTC, l->mInfo->c );
+            FreeLstarInfo( l );
+
+            #pragma omp ordered
+            {
+                strcpy( Str, Lgm_IsoTimeFormatter_Put( &IsoTimeFmt, &DT_UTC, 3 ) );   // rows come through here in time order
+                fprintf(fp, "%24s",     Str );
+                for ( i=0; i<nK; ++i ) {
+                    fprintf( fp, "     %13g", LS[i]);
+                }
+                for ( i=0; i<nK; ++i ) {
+                    fprintf( fp, "     %13g", K[i] );
+                }
+                for ( i=0; i<nK; ++i ) {
+                    fprintf( fp, "     %13g", Bm[i] );
+                }
+                fprintf(fp, "%s", " \n");
+                Checkpoint_Write( iRow+1, Lgm_Sink_Flush( Sink ), Str, &Ckpt );
+
+                /*
+                 *  The next times to start get brackets around where the
+                 *  LCDSs are now (not in deterministic mode, where the
+                 *  answers mustnt depend on which times happen to be done).
+                 */
+                if ( !Lgm_GetDeterministic() ) {
+                    #pragma omp critical (LCDS_Seed)
+                    SeedBrackets( nK, R, Flag, &Seed1, &Seed2 );
+                }
             }
-            fprintf(fp, "%s", " \n");
-            fflush(fp);
-        
+
+        }
+        Lgm_Sink_Close( Sink );
+        Checkpoint_Remove( &Ckpt );
+    }
+
+    /*
+     * With LGM_MEMORY_REPORT set, say what the run held onto (each thread had
+     * its own copy of LstarInfo; the largest is reported).
+     */
+    if ( Lgm_MemoryReportMode() ) {
+        Lgm_MemoryReport_Init( &MemReport );
+        Lgm_MemoryReport_Add( "LstarInfo", Lgm_LstarInfo_MemoryUsage( LstarInfo ), &MemReport );
+        if ( ThreadBytes > 0 ) {
+            for ( i=0; i<nThreads; i++ ) Lgm_MemoryReport_Add( "Per thread copies", ThreadBytes, &MemReport );
         }
-        fclose(fp);
+        Lgm_MemoryReport_Write( &MemReport );
     }
     FreeLstarInfo( LstarInfo );
+    Lgm_FreePrefetcher( Prefetcher );
 
     return(0);
 
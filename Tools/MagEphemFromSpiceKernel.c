@@ -9,6 +9,9 @@
 #include <argp.h>
 #include <time.h>
 #include <libgen.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <Lgm_CTrans.h>
 #include <Lgm_Sgp.h>
 #include <Lgm_MagEphemInfo.h>
@@ -17,10 +20,16 @@
 #include <Lgm_QinDenton.h>
 #include <Lgm_Misc.h>
 #include <Lgm_HDF5.h>
+#include <Lgm_MagEphemCol.h>
 #include <Lgm_ElapsedTime.h>
 #include "SpiceUsr.h"
 #include <Lgm/qsort.h>
 #include <Lgm_Octree.h>
+#include <Lgm_MemoryUsage.h>
+#include <Lgm_Sink.h>
+#include "MagEphemWork.h"
+#include "Checkpoint.h"
+#include "SpiceStates.h"
 
 #define EARTH_ID     399
 #define MOON_ID      301
@@ -104,7 +113,9 @@ static char doc[] =
 "\t\t/home/jsmith/MagEphemStuff/%YYYY/%YYYY%MM%DD_1989-046_MagEphem.txt.  \n"
 "\n"
 
-"Directories in the output file will be created if they don't already exist.\n";
+"Directories in the output file will be created if they don't already exist.\n\n"
+
+"If built with MPI (configure --enable-mpi), the (date, bird) pairs can be spread over several processes, e.g. 'mpirun -np 8 MagEphemFromSpiceKernel ...'. Each pair is written to its own files, so OutFile should contain the time variables (and %B for more than one bird).\n";
 
 
 
@@ -148,8 +159,15 @@ static struct argp_option Options[] = {
 
     { 0, 0, 0, 0,   "Output Options:", 5},
     {"Force",           'F',    0,                            0,        "Overwrite output file even if it already exists" },
+    {"Resume",          'R',    0,                            0,        "Resume output files that were interrupted (they still have a <file>.h5.ckpt checkpoint next to them) from the last checkpointed time step, rather than skipping them." },
     {"Verbosity",       'v',    "verbosity",                  0,        "Verbosity level to use. (0-4)"      },
     {"DumpShellFiles",  'd',    0,                            0,        "Dump full binary shell files (for use in visualizing drift shells)." },
+    {"PreClassify",     'P',    0,                            0,        "Use a cheap pre-trace to skip full traces of the open ends of field lines (Lgm_ClassifyFieldLine())." },
+    {"SpiceStep",       'k',    "seconds",                    0,        "Spacing of the S/C states fetched from SPICE for each day (positions in between are Hermite interpolated from the positions and velocities). Use 0 to fetch every position from SPICE. Default is 60." },
+    {"Window",          'w',    "nsteps",                     0,        "Only hold this many time steps in memory, writing them out as they fill (bounds memory use on long runs). Default is 0 (hold a whole day)." },
+    {"Columnar",        'B',    0,                            0,        "Also write a columnar binary file (<outfile>.mec) that can be memory-mapped by readers (see Lgm_OpenMagEphemCol())." },
+    {"Gzip",            'g',    0,                            0,        "Write the text file gzip'ed (<outfile>.txt.gz). It is compressed on background threads as the rows are made (see Lgm_Sink.c). The ELAPSED_TIME and SPICE_KERNEL_FILES_LOADED header fields are then left unfilled." },
+    {"ResultsCache",    'r',    "file",                       0,        "Look up (and store) the L* results of each time in this results cache file (see Lgm_OpenResultsCache()), so that reruns with the same inputs only compute what is new. Not used with -d." },
     {"Colorize",        'c',    0,                            0,        "Colorize output"                         },
     {"silent",          's',    0,                            OPTION_ARG_OPTIONAL | OPTION_ALIAS                                                },
 
@@ -170,6 +188,7 @@ struct Arguments {
     double      Kp;
     int         Colorize;
     int         Force;
+    int         Resume;
     double      FootPointHeight;
 
     char        IntModel[80];
@@ -178,6 +197,12 @@ struct Arguments {
 
     int         UseEop;
     int         DumpShellFiles;
+    int         PreClassify;
+    int         Window;
+    double      SpiceStep;
+    int         Columnar;
+    int         Gzip;
+    char        ResultsCache[1024];
 
     char        Birds[4096];
 
@@ -259,12 +284,33 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'F':
             arguments->Force = 1;
             break;
+        case 'R':
+            arguments->Resume = 1;
+            break;
         case 'z':
             arguments->UseEop = 1;
             break;
         case 'd':
             arguments->DumpShellFiles = 1;
             break;
+        case 'P':
+            arguments->PreClassify = 1;
+            break;
+        case 'k':
+            sscanf( arg, "%lf", &arguments->SpiceStep );
+            break;
+        case 'w':
+            sscanf( arg, "%d", &arguments->Window );
+            break;
+        case 'B':
+            arguments->Columnar = 1;
+            break;
+        case 'g':
+            arguments->Gzip = 1;
+            break;
+        case 'r':
+            strncpy( arguments->ResultsCache, arg, 1023 );
+            break;
         case 'f':
             sscanf( arg, "%lf", &arguments->FootPointHeight );
             break;
@@ -324,6 +370,7 @@ typedef struct afInfo {
     int             Sgn;
     int             BODY;
     Lgm_CTrans      *c;
+    SpiceStates     *States;
 } afInfo;
 double ApogeeFunc( double T, double val, void *Info ){
 
@@ -331,14 +378,14 @@ double ApogeeFunc( double T, double val, void *Info ){
     Lgm_CTrans      *c;
     Lgm_DateTime    UTC;
     Lgm_Vector      U;
-    double          R, et, pos[3], lt;
+    double          R, et, pos[3];
 
     a = (afInfo *)Info;
     c = a->c;
 
     Lgm_Make_UTC( a->Date, T/3600.0, &UTC, c );
     et = Lgm_TDBSecSinceJ2000( &UTC, c );
-    spkezp_c( a->BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+    SpiceStates_Position( et, pos, a->States );
     U.x = pos[0]/WGS84_A; U.y = pos[1]/WGS84_A; U.z = pos[2]/WGS84_A;
     R = Lgm_Magnitude( &U );
 
@@ -356,6 +403,7 @@ typedef struct lfInfo {
     int             Sgn;
     int             BODY;
     Lgm_CTrans      *c;
+    SpiceStates     *States;
 } lfInfo;
 double LatitudeFunc( double T, double val, void *Info ){
 
@@ -363,7 +411,7 @@ double LatitudeFunc( double T, double val, void *Info ){
     Lgm_CTrans      *c;
     Lgm_DateTime    UTC;
     Lgm_Vector      U, V;
-    double          R, et, pos[3], lt;
+    double          R, et, pos[3];
 
     a = (lfInfo *)Info;
     c = a->c;
@@ -371,7 +419,7 @@ double LatitudeFunc( double T, double val, void *Info ){
     Lgm_Set_Coord_Transforms( a->Date, T/3600.0, c );
     Lgm_Make_UTC( a->Date, T/3600.0, &UTC, c );
     et = Lgm_TDBSecSinceJ2000( &UTC, c );
-    spkezp_c( a->BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+    SpiceStates_Position( et, pos, a->States );
     U.x = pos[0]/WGS84_A; U.y = pos[1]/WGS84_A; U.z = pos[2]/WGS84_A;
     Lgm_Convert_Coords( &U, &V, GEI2000_TO_TOD, c );
     R = Lgm_Magnitude( &V );
@@ -616,6 +664,8 @@ int main( int argc, char *argv[] ){
     char             IntDesig[10], CommonName[80];
 
     struct Arguments arguments;
+    MagEphemWork     Work;
+    long int         iUnit;
     Lgm_CTrans       *c = Lgm_init_ctrans( 0 );
     Lgm_Vector       Rgsm, Rgeo, W, U;
     Lgm_DateTime     UTC, ModelDateTime;
@@ -627,8 +677,15 @@ int main( int argc, char *argv[] ){
     char             InputFilename[1024];
     char             OutputFilename[1024];
     char             IntModel[20], ExtModel[20], CoordSystem[80];
-    int              DumpShellFiles, UseEop, Colorize, Force;
-    FILE             *fp_in, *fp_MagEphem;
+    int              DumpShellFiles, UseEop, Colorize, Force, Resume, Resuming, PreClassify, Window, Columnar, Gzip, nThreads;
+    Lgm_MemoryReport MemReport;
+    Lgm_ResultsCache *ResultsCache = NULL;
+    size_t           ThreadBytes = 0;
+    Checkpoint       Ckpt;
+    long int         nResume;
+    FILE             *fp_in;
+    Lgm_Sink         *TxtSink = NULL;
+    Lgm_MagEphemColWriter *ColFile = NULL;
     int              nBirds, iBird;
     char             **Birds, Bird[80];
     double           Inc, Alpha[1000], FootpointHeight;
@@ -654,7 +711,7 @@ int main( int argc, char *argv[] ){
     lfInfo          *lfi;
     double          La, Lb, Lmin;
     int             done, BODY;
-    long int        ss, es, Seconds, Ta, Tb, Tc;
+    long int        ss, es, Seconds, iRow, iBuf, Ta, Tb, Tc;
     double          R, Ra, Rb, Rc, Rmin, Tmin;
     BrentFuncInfo   bInfo;
     afInfo          *afi;
@@ -717,8 +774,15 @@ int main( int argc, char *argv[] ){
     arguments.Delta            = 60;     // 60s default cadence
     arguments.Colorize         = 0;
     arguments.Force            = 0;
+    arguments.Resume           = 0;
     arguments.UseEop           = 0;
     arguments.DumpShellFiles   = 0;
+    arguments.PreClassify      = 0;
+    arguments.Window           = 0;
+    arguments.ResultsCache[0]  = '\0';
+    arguments.SpiceStep        = 60.0;
+    arguments.Columnar         = 0;
+    arguments.Gzip             = 0;
     arguments.FixModelDateTime =  0;
     arguments.StartDate        = -1;
     arguments.EndDate          = -1;
@@ -742,6 +806,11 @@ int main( int argc, char *argv[] ){
 
 
 
+    /*
+     *  Start MPI (if we have it) before argp sees the command line.
+     */
+    MagEphemWork_Init( &argc, &argv, &Work );
+
     /*
      *  Parse CmdLine arguments and options
      */
@@ -773,8 +842,13 @@ int main( int argc, char *argv[] ){
     Verbosity        = arguments.Verbosity;
     Colorize         = arguments.Colorize;
     Force            = arguments.Force;
+    Resume           = arguments.Resume;
     UseEop           = arguments.UseEop;
     DumpShellFiles   = arguments.DumpShellFiles;
+    PreClassify      = arguments.PreClassify;
+    Window           = arguments.Window;
+    Columnar         = arguments.Columnar;
+    Gzip             = arguments.Gzip;
     Delta            = arguments.Delta;
     StartDate        = arguments.StartDate;
     EndDate          = arguments.EndDate;
@@ -823,6 +897,12 @@ int main( int argc, char *argv[] ){
         printf( "\t                  Force output: %s\n", Force ? "yes" : "no" );
         printf( "\t                       Use Eop: %s\n", UseEop ? "yes" : "no" );
         printf( "\t         Dump Full Shell Files: %s\n", DumpShellFiles ? "yes" : "no" );
+        printf( "\t          Pre-classify FL type: %s\n", PreClassify ? "yes" : "no" );
+        if ( Window > 0 ) printf( "\t     Time steps held in memory: %d\n", Window );
+        else              printf( "\t     Time steps held in memory: whole day\n" );
+        printf( "\t           Write Columnar File: %s\n", Columnar ? "yes" : "no" );
+        printf( "\t       SPICE state spacing [s]: %g\n", arguments.SpiceStep );
+        printf( "\t                 Results Cache: %s\n", ( arguments.ResultsCache[0] != '\0' ) ? arguments.ResultsCache : "none" );
         printf( "\t        Colorize Thread Output: %d\n", Colorize );
         printf( "\t               Verbosity Level: %d\n", Verbosity );
         printf( "\t                        Silent: %s\n", arguments.silent  ? "yes" : "no" );
@@ -854,7 +934,27 @@ int main( int argc, char *argv[] ){
     
     int NNN = (int)( (eJD-sJD+1)*86400.0/(double)Delta + 1.0);
     if (NNN > 86401 ) NNN = 86401;
-    med = Lgm_InitMagEphemData( NNN, 80 );
+
+    /*
+     *  With a Window, med only holds that many time steps. They are used as a
+     *  ring buffer (step iRow lives in row iRow % med->H5_nRows) and are
+     *  written to the hdf5 file in blocks as they fill, so memory use no
+     *  longer grows with the run length (the file itself is the same). A
+     *  row can only be reused once it has been written, i.e. the ring has
+     *  to hold one block (H5_nBuffer) plus the steps still being computed
+     *  (at most one per thread).
+     */
+    nThreads = 1;
+    #ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+    #endif
+    if ( ( Window > 0 ) && ( Window < NNN ) ) {
+        if ( Window < 2*nThreads ) Window = 2*nThreads;
+        med = Lgm_InitMagEphemData( Window, 80 );
+        if ( med->H5_nBuffer > Window - nThreads ) Lgm_SetMagEphemHdfOptions( med->H5_ChunkBytes, Window - nThreads, med->H5_Deflate, med->H5_Shuffle, med );
+    } else {
+        med = Lgm_InitMagEphemData( NNN, 80 );
+    }
 
 
 
@@ -863,6 +963,8 @@ int main( int argc, char *argv[] ){
 
     SpiceDouble et;
     SpiceDouble pos[3], lt;
+    SpiceStates States;
+    double      et0, et1;
 
 
     if ( nAlpha > 0 ){
@@ -876,12 +978,19 @@ int main( int argc, char *argv[] ){
 
     // Settings for Lstar calcs
     Lgm_SetMagEphemLstarQuality( Quality, nFLsInDriftShell, MagEphemInfo );
+    MagEphemInfo->LstarInfo->mInfo->PreClassifyFieldLines = PreClassify;
     MagEphemInfo->SaveShellLines = TRUE;
     MagEphemInfo->LstarInfo->LSimpleMax = 12.0;
     MagEphemInfo->LstarInfo->VerbosityLevel = Verbosity;
     MagEphemInfo->LstarInfo->mInfo->VerbosityLevel = Verbosity;
     MagEphemInfo->LstarInfo->mInfo->Lgm_LossConeHeight = FootpointHeight;
 
+    // The drift shell lines arent kept in the results cache
+    if ( ( arguments.ResultsCache[0] != '\0' ) && !DumpShellFiles ) {
+        ResultsCache = Lgm_OpenResultsCache( arguments.ResultsCache, FALSE );
+        Lgm_MagEphemInfo_SetResultsCache( ResultsCache, MagEphemInfo );
+    }
+
     // The default model is Lgm_B_T89c
     MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
 
@@ -966,6 +1075,7 @@ MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
     char *BaseDir, NewStr[2048], Str[24], Command[4096];
     char *OutFile    = (char *)calloc( 2056, sizeof( char ) );
     char *HdfOutFile = (char *)calloc( 2056, sizeof( char ) );
+    char *ColOutFile = (char *)calloc( 2056, sizeof( char ) );
     char *InFile     = (char *)calloc( 2056, sizeof( char ) );
     char *ShellFile  = (char *)calloc( 2056, sizeof( char ) );
 
@@ -1046,6 +1156,12 @@ MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
 
 
 
+
+    /*
+     * loop over all dates. Each (date, bird) pair is a work unit; with MPI
+     * the units are shared out over the ranks (see MagEphemWork.c).
+     */
+    iUnit = 0;
     for ( JD = sJD; JD <= eJD; JD += 1.0 ) {
 
         Date = Lgm_JD_to_Date( JD, &Year, &Month, &Day, &Time );
@@ -1057,6 +1173,8 @@ MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
          */
          for ( iBird = 0; iBird < nBirds; iBird++ ) {
 
+            if ( !MagEphemWork_IsMine( iUnit++, &Work ) ) continue;
+
 
             strcpy( InFile, InputFilename );
             strcpy( OutFile, OutputFilename );
@@ -1102,7 +1220,8 @@ MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
              * Then we need to add ".txt" and ".h5" to each
              */
             sprintf( HdfOutFile, "%s.h5", OutFile );
-            strcat( OutFile, ".txt" );
+            sprintf( ColOutFile, "%s.mec", OutFile );
+            strcat( OutFile, Gzip ? ".txt.gz" : ".txt" );
 
 
 
@@ -1114,7 +1233,9 @@ MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
             printf( "      -------------------------------------------------------------------------------------------\n");
             printf( "           Input File: %s\n", InFile);
             printf( "      TXT Output File: %s\n", OutFile);
-            printf( "     HDF5 Output File: %s\n\n", HdfOutFile);
+            printf( "     HDF5 Output File: %s\n", HdfOutFile);
+            if ( Columnar ) printf( " Columnar Output File: %s\n", ColOutFile);
+            printf( "\n" );
 
 
             // Create Base directory if it hasn't been created yet.
@@ -1158,7 +1279,7 @@ if (file >= 0 ){
     es = (Date == EndDate)   ?   EndSeconds : 86400;
     for ( Seconds=ss; Seconds<=es; Seconds += Delta ) {
         Lgm_Make_UTC( Date, Seconds/3600.0, &UTC, c );
-        Lgm_DateTimeToString( IsoTimeString, &UTC, 0, 0 );
+        Lgm_DateTimeToIsoString( IsoTimeString, &UTC, 0 );
         printf("IsoTimeString   = %s   Date = %ld\n", IsoTimeString, Date );
     }
     LGM_ARRAY_2D_FREE( HdfFileTimes );
@@ -1198,7 +1319,26 @@ if (file >= 0 ){
 
             }
 
-            if ( !FileExists || Force ) {
+            /*
+             *   A file that still has a checkpoint was interrupted. Carry on
+             *   from the checkpoint if asked to (see Checkpoint.c).
+             */
+            Checkpoint_Init( HdfOutFile, &Ckpt );
+            Resuming = FALSE;
+            nResume  = 0;
+            if ( FileExists && Checkpoint_Read( &Ckpt ) ) {
+                if ( Force ) {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Redoing it.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                } else if ( Resume && Checkpoint_TruncateTxt( OutFile, &Ckpt ) ) {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Resuming from there.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                    Resuming = TRUE;
+                    nResume  = Ckpt.nRows;
+                } else {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Use -R to resume it or -F to redo it.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                }
+            }
+
+            if ( !FileExists || Force || Resuming ) {
 
 
                 /*
@@ -1249,6 +1389,20 @@ if (file >= 0 ){
 
 
 
+                    /*
+                     * Fetch the states for the day (plus the half hour
+                     * either side that the searches below look at) in one
+                     * go. Everything below gets its positions from these.
+                     */
+                    SpiceStates_Init( BODY, EARTH_ID, arguments.SpiceStep, &States );
+                    Lgm_Make_UTC( Date, -0.5, &UTC, c );
+                    et0 = Lgm_TDBSecSinceJ2000( &UTC, c );
+                    Lgm_Make_UTC( Date, 24.5, &UTC, c );
+                    et1 = Lgm_TDBSecSinceJ2000( &UTC, c );
+                    SpiceStates_Load( et0, et1, &States );
+
+
+
                     /*
                      * Find Apogees.
                      * Pack aInfo structure with required info.
@@ -1262,6 +1416,7 @@ if (file >= 0 ){
                     afi->BODY = BODY;
                     afi->Sgn  = -1; // +1 => find min (perigee)   -1 => find max (apogee)
                     afi->c    = c;
+                    afi->States = &States;
                     bInfo.Val  = 0.0;
                     bInfo.Info = (void *)afi;
                     bInfo.func = ApogeeFunc;
@@ -1278,14 +1433,14 @@ if (file >= 0 ){
                             if ( (Tmin >=0) && (Tmin < 86400) ) {
                                 Lgm_Make_UTC( Date, Tmin/3600.0, &Apogee_UTC[nApogee], c );
                                 et = Lgm_TDBSecSinceJ2000( &Apogee_UTC[nApogee], c );
-                                spkezp_c( BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+                                SpiceStates_Position( et, pos, &States );
                                 Apogee_U[nApogee].x = pos[0]/WGS84_A; Apogee_U[nApogee].y = pos[1]/WGS84_A; Apogee_U[nApogee].z = pos[2]/WGS84_A;
 
                                 Lgm_Set_Coord_Transforms( Apogee_UTC[nApogee].Date, Apogee_UTC[nApogee].Time, c );
                                 Lgm_Convert_Coords( &Apogee_U[nApogee], &w, GEI2000_TO_WGS84, c );
                                 Lgm_WGS84_to_GEOD( &w, &med->H5_Apogee_Geod[nApogee][0], &med->H5_Apogee_Geod[nApogee][1], &med->H5_Apogee_Geod[nApogee][2] );
 
-                                Lgm_DateTimeToString( med->H5_Apogee_IsoTimes[nApogee], &Apogee_UTC[nApogee], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Apogee_IsoTimes[nApogee], &Apogee_UTC[nApogee], 3 );
                                 printf("nApogee: %d Bracket: T = %ld %ld %ld    R = %g %g %g    Tapogee, Rapogee = %s %g\n", nApogee, Ta, Tb, Tc, Ra, Rb, Rc, med->H5_Apogee_IsoTimes[nApogee], fabs(Rmin) );
                                 ApoPeriTimeList[nApoPeriTimeList].key = Apogee_UTC[nApogee].JD;
                                 ApoPeriTimeList[nApoPeriTimeList].val = 1; // because its apogee
@@ -1324,14 +1479,14 @@ if (file >= 0 ){
                             if ( (Tmin >=0) && (Tmin < 86400) ) {
                                 Lgm_Make_UTC( Date, Tmin/3600.0, &Perigee_UTC[nPerigee], c );
                                 et = Lgm_TDBSecSinceJ2000( &Perigee_UTC[nPerigee], c );
-                                spkezp_c( BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+                                SpiceStates_Position( et, pos, &States );
                                 Perigee_U[nPerigee].x = pos[0]/WGS84_A; Perigee_U[nPerigee].y = pos[1]/WGS84_A; Perigee_U[nPerigee].z = pos[2]/WGS84_A;
 
                                 Lgm_Set_Coord_Transforms( Perigee_UTC[nPerigee].Date, Perigee_UTC[nPerigee].Time, c );
                                 Lgm_Convert_Coords( &Perigee_U[nPerigee], &w, GEI2000_TO_WGS84, c );
                                 Lgm_WGS84_to_GEOD( &w, &med->H5_Perigee_Geod[nPerigee][0], &med->H5_Perigee_Geod[nPerigee][1], &med->H5_Perigee_Geod[nPerigee][2] );
 
-                                Lgm_DateTimeToString( med->H5_Perigee_IsoTimes[nPerigee], &Perigee_UTC[nPerigee], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Perigee_IsoTimes[nPerigee], &Perigee_UTC[nPerigee], 3 );
                                 printf("nPerigee: %d Bracket: T = %ld %ld %ld    R = %g %g %g    Tperigee, Rperigee = %s %g\n", nPerigee, Ta, Tb, Tc, Ra, Rb, Rc, med->H5_Perigee_IsoTimes[nPerigee], fabs(Rmin) );
 
                                 ApoPeriTimeList[nApoPeriTimeList].key = Perigee_UTC[nPerigee].JD;
@@ -1367,6 +1522,7 @@ if (file >= 0 ){
                     lfi->Date = Date;
                     lfi->BODY = BODY;
                     lfi->c    = c;
+                    lfi->States = &States;
                     bInfo.Val  = 0.0;
                     bInfo.Info = (void *)lfi;
                     bInfo.func = LatitudeFunc;
@@ -1382,14 +1538,14 @@ if (file >= 0 ){
                                 Lgm_Make_UTC( Date, Tmin/3600.0, &Ascend_UTC[nAscend], c );
 
                                 et = Lgm_TDBSecSinceJ2000( &Ascend_UTC[nAscend], c );
-                                spkezp_c( BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+                                SpiceStates_Position( et, pos, &States );
                                 Ascend_U[nAscend].x = pos[0]/WGS84_A; Ascend_U[nAscend].y = pos[1]/WGS84_A; Ascend_U[nAscend].z = pos[2]/WGS84_A;
 
                                 Lgm_Set_Coord_Transforms( Ascend_UTC[nAscend].Date, Ascend_UTC[nAscend].Time, c );
                                 Lgm_Convert_Coords( &Ascend_U[nAscend], &w, GEI2000_TO_WGS84, c );
                                 Lgm_WGS84_to_GEOD( &w, &med->H5_Ascend_Geod[nAscend][0], &med->H5_Ascend_Geod[nAscend][1], &med->H5_Ascend_Geod[nAscend][2] );
 
-                                Lgm_DateTimeToString( med->H5_Ascend_IsoTimes[nAscend], &Ascend_UTC[nAscend], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Ascend_IsoTimes[nAscend], &Ascend_UTC[nAscend], 3 );
                                 printf("nNode: %d Bracket: T = %ld %ld    L = %g %g    Tnode, Lnode = %s %g\n", nAscend, Ta, Tb, La, Lb, med->H5_Ascend_IsoTimes[nAscend], Lmin );
 
                                 ++nAscend;
@@ -1469,10 +1625,18 @@ int          N0, ii;
 
 
                     /*
-                     * Open MagEphem txt file for writing and write header.
+                     * Open MagEphem txt file for writing and write header
+                     * (or, when resuming, carry on at the end of it).
                      */
-                    fp_MagEphem = fopen( OutFile, "w" );
-                    Lgm_WriteMagEphemHeader( fp_MagEphem, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo );
+                    if ( Resuming ) {
+                        TxtSink = Lgm_Sink_Open( OutFile, "a", 0 );
+                        if ( !TxtSink->Compressed ) setvbuf( TxtSink->fp, NULL, _IOFBF, 1048576 );
+                    } else {
+                        Checkpoint_Remove( &Ckpt );
+                        TxtSink = Lgm_Sink_Open( OutFile, "w", 0 );
+                        if ( !TxtSink->Compressed ) setvbuf( TxtSink->fp, NULL, _IOFBF, 1048576 ); // rows are several kB each -- write them out in ~1MB blocks
+                        Lgm_WriteMagEphemHeader( TxtSink->fp, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo );
+                    }
                     printf("\t      Writing to file: %s\n", OutFile );
 
                     if ( UseEop ) {
@@ -1486,8 +1650,12 @@ int          N0, ii;
                      * Open MagEphem hdf5 file for writing and
                      * Create variables.
                      */
-                    file    = H5Fcreate( HdfOutFile, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
-                    Lgm_WriteMagEphemHeaderHdf( file, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo, med );
+                    if ( Resuming ) {
+                        file    = H5Fopen( HdfOutFile,  H5F_ACC_RDWR, H5P_DEFAULT );
+                    } else {
+                        file    = H5Fcreate( HdfOutFile, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+                        Lgm_WriteMagEphemHeaderHdf( file, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo, med );
+                    }
 
 
 
@@ -1497,15 +1665,49 @@ int          N0, ii;
                      */
                     ss = (Date == StartDate) ? StartSeconds : 0;
                     es = (Date == EndDate) ? EndSeconds : 86400;
+
+                    /*
+                     * Create the columnar file (with room for every step of the day).
+                     * It is not written when resuming.
+                     */
+                    if ( Columnar && !Resuming ) {
+                        ColFile = Lgm_CreateMagEphemCol( ColOutFile, (es-ss)/Delta + 1, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo, med );
+                    }
+
                     med->H5_nT = 0;
                     Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+
+                    /*
+                     *  The time steps are independent, so they are spread
+                     *  over threads (each with its own copies of c and
+                     *  MagEphemInfo). Rows are filled in directly at their
+                     *  own index (iBuf) in med, and the ordered block at the end of
+                     *  each step hands them to the (text and hdf5) writers in
+                     *  time order -- so threads keep computing while earlier
+                     *  rows are being written. Lgm_ComputeLstarVersusPA()'s
+                     *  own parallel loop over pitch angles runs serially
+                     *  within each thread here (unless nested parallelism is
+                     *  enabled).
+                     */
+                    #pragma omp parallel firstprivate( c, MagEphemInfo ) private( iRow, iBuf, UTC, IsoTimeString, et, pos, lt, U, eop, p, Rgsm, sclkch, W, Rgeo, GeodLat, GeodLong, GeodHeight, R, MLAT, MLON, MLT, Bsc_gsm, Bvec, Bvec2, Bmin_mag, Bsc_mag, Bfn_mag, Bfs_mag, i, Ek, E, p2c2, Beta2, Beta, vel, T, pp, rg, s, cl )
+                    {
+                    #ifdef _OPENMP
+                    c            = Lgm_CopyCTrans( c );
+                    MagEphemInfo = Lgm_CopyMagEphemInfo( MagEphemInfo, (nAlpha > 0) ? nAlpha : 1 );
+                    #endif
+
+                    #pragma omp for ordered schedule(dynamic, 1)
                     for ( Seconds=ss; Seconds<=es; Seconds += Delta ) {
 
+                        iRow = (Seconds-ss)/Delta;
+                        iBuf = iRow % med->H5_nRows;   // row of med that holds this step
+                        if ( iRow < nResume ) continue; // already in the files
+
                         Lgm_Make_UTC( Date, Seconds/3600.0, &UTC, c );
-                        Lgm_DateTimeToString( IsoTimeString, &UTC, 0, 0 );
+                        Lgm_DateTimeToIsoString( IsoTimeString, &UTC, 0 );
 
                         et = Lgm_TDBSecSinceJ2000( &UTC, c );
-                        spkezp_c( BODY,    et,   "J2000",  "NONE", EARTH_ID,  pos,  &lt );
+                        SpiceStates_Position( et, pos, &States );
 /*
 SpiceDouble  sclkdp;
 sce2c_c( BODY,    et, &sclkdp);
@@ -1559,6 +1761,7 @@ printf("sclkdp = %lf\n", sclkdp);
 
                         Lgm_Convert_Coords( &U, &Rgsm, GEI2000_TO_GSM, c );
 
+                        #pragma omp critical (Spice)
                         sce2s_c( BODY,    et, 30, sclkch );
 
                         /*
@@ -1575,140 +1778,122 @@ printf("sclkdp = %lf\n", sclkdp);
 
                         MagEphemInfo->InOut = InOutBound( ApoPeriTimeList, nApoPeriTimeList, UTC.JD );
 
-                        /*
-                         * Write a row of data into the txt file
-                         */
-                        Lgm_WriteMagEphemData( fp_MagEphem, IntModel, ExtModel, MagEphemInfo->LstarInfo->mInfo->fKp, MagEphemInfo->LstarInfo->mInfo->Dst, MagEphemInfo );
-
-
-
-
-                        if ( DumpShellFiles && (nAlpha > 0) ){
-
-                            sprintf( ShellFile, "%s_%ld.dat", OutFile, Seconds );
-                            printf( "Writing Full Shell File: %s\n", ShellFile );
-                            WriteMagEphemInfoStruct( ShellFile, nAlpha, MagEphemInfo );
-                        }
-
-
-
-
                         // Fill arrays for dumping out as HDF5 files
-                        strcpy( med->H5_IsoTimes[ med->H5_nT ], IsoTimeString );
-                        strcpy( med->H5_IntModel[ med->H5_nT ], IntModel );
-                        strcpy( med->H5_ExtModel[ med->H5_nT ], ExtModel );
+                        strcpy( med->H5_IsoTimes[ iBuf ], IsoTimeString );
+                        strcpy( med->H5_IntModel[ iBuf ], IntModel );
+                        strcpy( med->H5_ExtModel[ iBuf ], ExtModel );
                         switch ( MagEphemInfo->FieldLineType ) {
                             case LGM_OPEN_IMF:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_IMF" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_IMF" ); // FL Type
                                                 break;
                             case LGM_CLOSED:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_CLOSED" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_CLOSED" ); // FL Type
                                                 break;
                             case LGM_OPEN_N_LOBE:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_N_LOBE" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_N_LOBE" ); // FL Type
                                                 break;
                             case LGM_OPEN_S_LOBE:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_S_LOBE" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_S_LOBE" ); // FL Type
                                                 break;
                             case LGM_INSIDE_EARTH:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_INSIDE_EARTH" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_INSIDE_EARTH" ); // FL Type
                                                 break;
                             case LGM_TARGET_HEIGHT_UNREACHABLE:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
                                                 break;
                             default:
-                                                sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "UNKNOWN FIELD TYPE" ); // FL Type
+                                                sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "UNKNOWN FIELD TYPE" ); // FL Type
                                                 break;
                         }
-                        med->H5_Date[ med->H5_nT ]           = UTC.Date;
-                        med->H5_Doy[ med->H5_nT ]            = UTC.Doy;
-                        med->H5_UTC[ med->H5_nT ]            = UTC.Time;
-                        med->H5_JD[ med->H5_nT ]             = UTC.JD;
-                        med->H5_InOut[ med->H5_nT ]          = MagEphemInfo->InOut;
-                        med->H5_OrbitNumber[ med->H5_nT ]    = MagEphemInfo->OrbitNumber;
-                        med->H5_GpsTime[ med->H5_nT ]        = Lgm_UTC_to_GpsSeconds( &UTC, c );
-                        med->H5_TiltAngle[ med->H5_nT ]      = c->psi*DegPerRad;
-
-                        med->H5_Rgsm[ med->H5_nT ][0]        = Rgsm.x;
-                        med->H5_Rgsm[ med->H5_nT ][1]        = Rgsm.y;
-                        med->H5_Rgsm[ med->H5_nT ][2]        = Rgsm.z;
+                        med->H5_Date[ iBuf ]           = UTC.Date;
+                        med->H5_Doy[ iBuf ]            = UTC.Doy;
+                        med->H5_UTC[ iBuf ]            = UTC.Time;
+                        med->H5_JD[ iBuf ]             = UTC.JD;
+                        med->H5_InOut[ iBuf ]          = MagEphemInfo->InOut;
+                        med->H5_OrbitNumber[ iBuf ]    = MagEphemInfo->OrbitNumber;
+                        med->H5_GpsTime[ iBuf ]        = Lgm_UTC_to_GpsSeconds( &UTC, c );
+                        med->H5_TiltAngle[ iBuf ]      = c->psi*DegPerRad;
+
+                        med->H5_Rgsm[ iBuf ][0]        = Rgsm.x;
+                        med->H5_Rgsm[ iBuf ][1]        = Rgsm.y;
+                        med->H5_Rgsm[ iBuf ][2]        = Rgsm.z;
 
                         Lgm_Set_Coord_Transforms( UTC.Date, UTC.Time, c );
-                        Lgm_Convert_Coords( &Rgsm, &Rgeo, GSM_TO_GEO, c );      Lgm_VecToArr( &Rgeo, &med->H5_Rgeo[ med->H5_nT ][0] );
-                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_SM, c );       Lgm_VecToArr( &W,    &med->H5_Rsm[ med->H5_nT ][0] );
-                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GEI2000, c );  Lgm_VecToArr( &W,    &med->H5_Rgei[ med->H5_nT ][0] );
-                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GSE, c );      Lgm_VecToArr( &W,    &med->H5_Rgse[ med->H5_nT ][0] );
+                        Lgm_Convert_Coords( &Rgsm, &Rgeo, GSM_TO_GEO, c );      Lgm_VecToArr( &Rgeo, &med->H5_Rgeo[ iBuf ][0] );
+                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_SM, c );       Lgm_VecToArr( &W,    &med->H5_Rsm[ iBuf ][0] );
+                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GEI2000, c );  Lgm_VecToArr( &W,    &med->H5_Rgei[ iBuf ][0] );
+                        Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GSE, c );      Lgm_VecToArr( &W,    &med->H5_Rgse[ iBuf ][0] );
 
                         Lgm_WGS84_to_GEOD( &Rgeo, &GeodLat, &GeodLong, &GeodHeight );
-                        Lgm_SetArrElements3( &med->H5_Rgeod[ med->H5_nT ][0],        GeodLat, GeodLong, GeodHeight );
-                        Lgm_SetArrElements2( &med->H5_Rgeod_LatLon[ med->H5_nT ][0], GeodLat, GeodLong );
-                        med->H5_Rgeod_Height[ med->H5_nT ] = GeodHeight;
+                        Lgm_SetArrElements3( &med->H5_Rgeod[ iBuf ][0],        GeodLat, GeodLong, GeodHeight );
+                        Lgm_SetArrElements2( &med->H5_Rgeod_LatLon[ iBuf ][0], GeodLat, GeodLong );
+                        med->H5_Rgeod_Height[ iBuf ] = GeodHeight;
 
                         Lgm_Convert_Coords( &Rgsm, &W, GSM_TO_CDMAG, c );
                         Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                        med->H5_CDMAG_MLAT[ med->H5_nT ] = MLAT;
-                        med->H5_CDMAG_MLON[ med->H5_nT ] = MLON;
-                        med->H5_CDMAG_MLT[ med->H5_nT ]  = MLT;
-                        med->H5_CDMAG_R[ med->H5_nT ]    = R;
+                        med->H5_CDMAG_MLAT[ iBuf ] = MLAT;
+                        med->H5_CDMAG_MLON[ iBuf ] = MLON;
+                        med->H5_CDMAG_MLT[ iBuf ]  = MLT;
+                        med->H5_CDMAG_R[ iBuf ]    = R;
 
                         Lgm_Convert_Coords( &Rgsm, &W, GSM_TO_EDMAG, c );
                         Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                        med->H5_EDMAG_MLAT[ med->H5_nT ] = MLAT;
-                        med->H5_EDMAG_MLON[ med->H5_nT ] = MLON;
-                        med->H5_EDMAG_MLT[ med->H5_nT ]  = MLT;
-                        med->H5_EDMAG_R[ med->H5_nT ]    = R;
+                        med->H5_EDMAG_MLAT[ iBuf ] = MLAT;
+                        med->H5_EDMAG_MLON[ iBuf ] = MLON;
+                        med->H5_EDMAG_MLT[ iBuf ]  = MLT;
+                        med->H5_EDMAG_R[ iBuf ]    = R;
 
-                        med->H5_Kp[ med->H5_nT ]             = MagEphemInfo->LstarInfo->mInfo->fKp;
-                        med->H5_Dst[ med->H5_nT ]            = MagEphemInfo->LstarInfo->mInfo->Dst;
+                        med->H5_Kp[ iBuf ]             = MagEphemInfo->LstarInfo->mInfo->fKp;
+                        med->H5_Dst[ iBuf ]            = MagEphemInfo->LstarInfo->mInfo->Dst;
 
-                        med->H5_S_sc_to_pfn[ med->H5_nT ]    = (MagEphemInfo->Snorth > 0.0) ? MagEphemInfo->Snorth : LGM_FILL_VALUE;
-                        med->H5_S_sc_to_pfs[ med->H5_nT ]    = (MagEphemInfo->Ssouth > 0.0) ? MagEphemInfo->Ssouth : LGM_FILL_VALUE;
-                        med->H5_S_pfs_to_Bmin[ med->H5_nT ]  = (MagEphemInfo->Smin > 0.0) ? MagEphemInfo->Smin : LGM_FILL_VALUE;
-                        med->H5_S_Bmin_to_sc[ med->H5_nT ]   = ((MagEphemInfo->Ssouth>0.0)&&(MagEphemInfo->Smin > 0.0)) ? MagEphemInfo->Ssouth-MagEphemInfo->Smin : LGM_FILL_VALUE;
-                        med->H5_S_total[ med->H5_nT ]        = ((MagEphemInfo->Snorth > 0.0)&&(MagEphemInfo->Ssouth > 0.0)) ? MagEphemInfo->Snorth + MagEphemInfo->Ssouth : LGM_FILL_VALUE;
+                        med->H5_S_sc_to_pfn[ iBuf ]    = (MagEphemInfo->Snorth > 0.0) ? MagEphemInfo->Snorth : LGM_FILL_VALUE;
+                        med->H5_S_sc_to_pfs[ iBuf ]    = (MagEphemInfo->Ssouth > 0.0) ? MagEphemInfo->Ssouth : LGM_FILL_VALUE;
+                        med->H5_S_pfs_to_Bmin[ iBuf ]  = (MagEphemInfo->Smin > 0.0) ? MagEphemInfo->Smin : LGM_FILL_VALUE;
+                        med->H5_S_Bmin_to_sc[ iBuf ]   = ((MagEphemInfo->Ssouth>0.0)&&(MagEphemInfo->Smin > 0.0)) ? MagEphemInfo->Ssouth-MagEphemInfo->Smin : LGM_FILL_VALUE;
+                        med->H5_S_total[ iBuf ]        = ((MagEphemInfo->Snorth > 0.0)&&(MagEphemInfo->Ssouth > 0.0)) ? MagEphemInfo->Snorth + MagEphemInfo->Ssouth : LGM_FILL_VALUE;
 
-                        med->H5_d2B_ds2[ med->H5_nT ]        = MagEphemInfo->d2B_ds2;
-                        med->H5_Sb0[ med->H5_nT ]            = MagEphemInfo->Sb0;
-                        med->H5_RadiusOfCurv[ med->H5_nT ]   = MagEphemInfo->RofC;
+                        med->H5_d2B_ds2[ iBuf ]        = MagEphemInfo->d2B_ds2;
+                        med->H5_Sb0[ iBuf ]            = MagEphemInfo->Sb0;
+                        med->H5_RadiusOfCurv[ iBuf ]   = MagEphemInfo->RofC;
 
 
                         MagEphemInfo->LstarInfo->mInfo->Bfield( &Rgsm, &Bsc_gsm, MagEphemInfo->LstarInfo->mInfo );
-                        med->H5_Bsc_gsm[ med->H5_nT ][0] = Bsc_gsm.x;
-                        med->H5_Bsc_gsm[ med->H5_nT ][1] = Bsc_gsm.y;
-                        med->H5_Bsc_gsm[ med->H5_nT ][2] = Bsc_gsm.z;
-                        med->H5_Bsc_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bsc_gsm );
+                        med->H5_Bsc_gsm[ iBuf ][0] = Bsc_gsm.x;
+                        med->H5_Bsc_gsm[ iBuf ][1] = Bsc_gsm.y;
+                        med->H5_Bsc_gsm[ iBuf ][2] = Bsc_gsm.z;
+                        med->H5_Bsc_gsm[ iBuf ][3] = Lgm_Magnitude( &Bsc_gsm );
 
                         if ( MagEphemInfo->FieldLineType == LGM_CLOSED ) {
-                            med->H5_Pmin_gsm[ med->H5_nT ][0] = MagEphemInfo->Pmin.x;
-                            med->H5_Pmin_gsm[ med->H5_nT ][1] = MagEphemInfo->Pmin.y;
-                            med->H5_Pmin_gsm[ med->H5_nT ][2] = MagEphemInfo->Pmin.z;
+                            med->H5_Pmin_gsm[ iBuf ][0] = MagEphemInfo->Pmin.x;
+                            med->H5_Pmin_gsm[ iBuf ][1] = MagEphemInfo->Pmin.y;
+                            med->H5_Pmin_gsm[ iBuf ][2] = MagEphemInfo->Pmin.z;
 
                             MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Pmin, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                             Bmin_mag = Lgm_Magnitude( &Bvec );
-                            med->H5_Bmin_gsm[ med->H5_nT ][0] = Bvec.x;
-                            med->H5_Bmin_gsm[ med->H5_nT ][1] = Bvec.y;
-                            med->H5_Bmin_gsm[ med->H5_nT ][2] = Bvec.z;
-                            med->H5_Bmin_gsm[ med->H5_nT ][3] = Bmin_mag;
+                            med->H5_Bmin_gsm[ iBuf ][0] = Bvec.x;
+                            med->H5_Bmin_gsm[ iBuf ][1] = Bvec.y;
+                            med->H5_Bmin_gsm[ iBuf ][2] = Bvec.z;
+                            med->H5_Bmin_gsm[ iBuf ][3] = Bmin_mag;
 
                         } else {
-                            med->H5_Pmin_gsm[ med->H5_nT ][0] = LGM_FILL_VALUE ;
-                            med->H5_Pmin_gsm[ med->H5_nT ][1] = LGM_FILL_VALUE ;
-                            med->H5_Pmin_gsm[ med->H5_nT ][2] = LGM_FILL_VALUE ;
-
-                            med->H5_Bmin_gsm[ med->H5_nT ][0] = LGM_FILL_VALUE ;
-                            med->H5_Bmin_gsm[ med->H5_nT ][1] = LGM_FILL_VALUE ;
-                            med->H5_Bmin_gsm[ med->H5_nT ][2] = LGM_FILL_VALUE ;
-                            med->H5_Bmin_gsm[ med->H5_nT ][3] = LGM_FILL_VALUE ;
+                            med->H5_Pmin_gsm[ iBuf ][0] = LGM_FILL_VALUE ;
+                            med->H5_Pmin_gsm[ iBuf ][1] = LGM_FILL_VALUE ;
+                            med->H5_Pmin_gsm[ iBuf ][2] = LGM_FILL_VALUE ;
+
+                            med->H5_Bmin_gsm[ iBuf ][0] = LGM_FILL_VALUE ;
+                            med->H5_Bmin_gsm[ iBuf ][1] = LGM_FILL_VALUE ;
+                            med->H5_Bmin_gsm[ iBuf ][2] = LGM_FILL_VALUE ;
+                            med->H5_Bmin_gsm[ iBuf ][3] = LGM_FILL_VALUE ;
                             Bmin_mag = LGM_FILL_VALUE;
                         }
 
 
                         for (i=0; i<nAlpha; i++){
-                            med->H5_Lstar[ med->H5_nT ][i]          = MagEphemInfo->Lstar[i];
-                            med->H5_DriftShellType[ med->H5_nT ][i] = MagEphemInfo->DriftOrbitType[i];
-                            med->H5_Sb[ med->H5_nT ][i]             = MagEphemInfo->Sb[i];
-                            med->H5_I[ med->H5_nT ][i]              = MagEphemInfo->I[i];
-                            med->H5_Bm[ med->H5_nT ][i]             = MagEphemInfo->Bm[i];
+                            med->H5_Lstar[ iBuf ][i]          = MagEphemInfo->Lstar[i];
+                            med->H5_DriftShellType[ iBuf ][i] = MagEphemInfo->DriftOrbitType[i];
+                            med->H5_Sb[ iBuf ][i]             = MagEphemInfo->Sb[i];
+                            med->H5_I[ iBuf ][i]              = MagEphemInfo->I[i];
+                            med->H5_Bm[ iBuf ][i]             = MagEphemInfo->Bm[i];
 
                             Ek    = 1.0; // MeV
                             E     = Ek + LGM_Ee0; // total energy, MeV
@@ -1722,78 +1907,78 @@ printf("sclkdp = %lf\n", sclkdp);
                             pp    = sqrt(p2c2)*1.60217646e-13/LGM_c;  // mks
                             rg    = sin(MagEphemInfo->Alpha[i]*RadPerDeg)*pp/(LGM_e*Bmin_mag*1e-9); // m. Bmin_mag calced above
 
-                            med->H5_Tb[ med->H5_nT ][i]             = T;
-                            med->H5_Kappa[ med->H5_nT ][i]          = sqrt( MagEphemInfo->RofC*Re*1e3/rg );
+                            med->H5_Tb[ iBuf ][i]             = T;
+                            med->H5_Kappa[ iBuf ][i]          = sqrt( MagEphemInfo->RofC*Re*1e3/rg );
 
 
                             if ( (MagEphemInfo->Bm[i]>0.0)&&(MagEphemInfo->I[i]>=0.0) ) {
-                                med->H5_K[ med->H5_nT ][i] = 3.16227766e-3*MagEphemInfo->I[i]*sqrt(MagEphemInfo->Bm[i]);
+                                med->H5_K[ iBuf ][i] = 3.16227766e-3*MagEphemInfo->I[i]*sqrt(MagEphemInfo->Bm[i]);
                             } else {
-                                med->H5_K[ med->H5_nT ][i] = LGM_FILL_VALUE;
+                                med->H5_K[ iBuf ][i] = LGM_FILL_VALUE;
                             }
                             if (MagEphemInfo->I[i]>=0.0) {
-                                med->H5_L[ med->H5_nT ][i] = LFromIBmM_McIlwain(MagEphemInfo->I[i], MagEphemInfo->Bm[i], MagEphemInfo->Mused );
+                                med->H5_L[ iBuf ][i] = LFromIBmM_McIlwain(MagEphemInfo->I[i], MagEphemInfo->Bm[i], MagEphemInfo->Mused );
                             } else {
-                                med->H5_L[ med->H5_nT ][i] = LGM_FILL_VALUE;
+                                med->H5_L[ iBuf ][i] = LGM_FILL_VALUE;
                             }
                         }
 
                         /*
                          * Compute Lsimple
                          */
-                        med->H5_Lsimple[ med->H5_nT ] = ( Bmin_mag > 0.0) ? Lgm_Magnitude( &MagEphemInfo->Pmin ) : LGM_FILL_VALUE;
+                        med->H5_Lsimple[ iBuf ] = ( Bmin_mag > 0.0) ? Lgm_Magnitude( &MagEphemInfo->Pmin ) : LGM_FILL_VALUE;
 
                         /*
                          * Compute InvLat
                          */
-                        if (med->H5_Lsimple[ med->H5_nT ] > 0.0) {
-                            med->H5_InvLat[ med->H5_nT ] = DegPerRad*acos(sqrt(1.0/med->H5_Lsimple[ med->H5_nT ]));
+                        if (med->H5_Lsimple[ iBuf ] > 0.0) {
+                            med->H5_InvLat[ iBuf ] = DegPerRad*acos(sqrt(1.0/med->H5_Lsimple[ iBuf ]));
                         } else {
-                            med->H5_InvLat[ med->H5_nT ] = LGM_FILL_VALUE;
+                            med->H5_InvLat[ iBuf ] = LGM_FILL_VALUE;
                         }
 
                         /*
                          * Compute Lm_eq
                          */
-                        med->H5_Lm_eq[ med->H5_nT ] = (Bmin_mag > 0.0) ? LFromIBmM_McIlwain( 0.0, Bmin_mag, MagEphemInfo->Mcurr ) : LGM_FILL_VALUE;
+                        med->H5_Lm_eq[ iBuf ] = (Bmin_mag > 0.0) ? LFromIBmM_McIlwain( 0.0, Bmin_mag, MagEphemInfo->Mcurr ) : LGM_FILL_VALUE;
 
                         /*
                          * Compute InvLat_eq
                          */
-                        if (med->H5_Lm_eq[ med->H5_nT ] > 0.0) {
-                            med->H5_InvLat_eq[ med->H5_nT ] = DegPerRad*acos(sqrt(1.0/med->H5_Lm_eq[ med->H5_nT ]));
+                        if (med->H5_Lm_eq[ iBuf ] > 0.0) {
+                            med->H5_InvLat_eq[ iBuf ] = DegPerRad*acos(sqrt(1.0/med->H5_Lm_eq[ iBuf ]));
                         } else {
-                            med->H5_InvLat_eq[ med->H5_nT ] = LGM_FILL_VALUE;
+                            med->H5_InvLat_eq[ iBuf ] = LGM_FILL_VALUE;
                         }
 
                         /*
                          * Compute BoverBeq
                          */
                         Bsc_mag = Lgm_Magnitude( &Bsc_gsm );
-                        med->H5_BoverBeq[ med->H5_nT ] = ( Bmin_mag > 0.0) ? Bsc_mag / Bmin_mag : LGM_FILL_VALUE;
+                        med->H5_BoverBeq[ iBuf ] = ( Bmin_mag > 0.0) ? Bsc_mag / Bmin_mag : LGM_FILL_VALUE;
 
                         /*
                          * Compute MlatFromBoverBeq
                          */
-                        if ( med->H5_BoverBeq[ med->H5_nT ] > 0.0 ) {
-                            s = sqrt( 1.0/med->H5_BoverBeq[ med->H5_nT ] );
+                        if ( med->H5_BoverBeq[ iBuf ] > 0.0 ) {
+                            s = sqrt( 1.0/med->H5_BoverBeq[ iBuf ] );
                             cl = Lgm_CdipMirrorLat( s );
                             if ( fabs(cl) <= 1.0 ){
-                                med->H5_MlatFromBoverBeq[ med->H5_nT ] = DegPerRad*acos( cl );
-                                if (med->H5_S_Bmin_to_sc[ med->H5_nT ]<0.0) med->H5_MlatFromBoverBeq[ med->H5_nT ] *= -1.0;
+                                med->H5_MlatFromBoverBeq[ iBuf ] = DegPerRad*acos( cl );
+                                if (med->H5_S_Bmin_to_sc[ iBuf ]<0.0) med->H5_MlatFromBoverBeq[ iBuf ] *= -1.0;
                             } else {
-                                med->H5_MlatFromBoverBeq[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_MlatFromBoverBeq[ iBuf ] = LGM_FILL_VALUE;
                             }
                         } else {
-                            med->H5_MlatFromBoverBeq[ med->H5_nT ] = LGM_FILL_VALUE;
+                            med->H5_MlatFromBoverBeq[ iBuf ] = LGM_FILL_VALUE;
                         }
 
                         /*
                          * Save M values
                          */
-                        med->H5_M_used[ med->H5_nT ] = MagEphemInfo->Mused;
-                        med->H5_M_ref[ med->H5_nT ]  = MagEphemInfo->Mref;
-                        med->H5_M_igrf[ med->H5_nT ] = MagEphemInfo->Mcurr;
+                        med->H5_M_used[ iBuf ] = MagEphemInfo->Mused;
+                        med->H5_M_ref[ iBuf ]  = MagEphemInfo->Mref;
+                        med->H5_M_igrf[ iBuf ] = MagEphemInfo->Mcurr;
 
 
 
@@ -1805,29 +1990,29 @@ printf("sclkdp = %lf\n", sclkdp);
                             /*
                              * Save northern Footpoint position in different coord systems.
                              */
-                            Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Pn, med->H5_Pfn_gsm[ med->H5_nT ] );
+                            Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Pn, med->H5_Pfn_gsm[ iBuf ] );
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_GEO, c );
-                            Lgm_VecToArr( &W, med->H5_Pfn_geo[ med->H5_nT ] );
+                            Lgm_VecToArr( &W, med->H5_Pfn_geo[ iBuf ] );
 
                             Lgm_WGS84_to_GEOD( &W, &GeodLat, &GeodLong, &GeodHeight );
-                            Lgm_SetArrElements3( med->H5_Pfn_geod[ med->H5_nT ],        GeodLat, GeodLong, GeodHeight );
-                            Lgm_SetArrElements2( med->H5_Pfn_geod_LatLon[ med->H5_nT ], GeodLat, GeodLong );
-                            med->H5_Pfn_geod_Height[ med->H5_nT ]    = GeodHeight;
+                            Lgm_SetArrElements3( med->H5_Pfn_geod[ iBuf ],        GeodLat, GeodLong, GeodHeight );
+                            Lgm_SetArrElements2( med->H5_Pfn_geod_LatLon[ iBuf ], GeodLat, GeodLong );
+                            med->H5_Pfn_geod_Height[ iBuf ]    = GeodHeight;
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_CDMAG, c );
                             Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            Lgm_SetArrElements3( med->H5_Pfn_cdmag[ med->H5_nT ], MLAT, MLON, MLT );
-                            med->H5_Pfn_CD_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_Pfn_CD_MLON[ med->H5_nT ] = MLON;
-                            med->H5_Pfn_CD_MLT[ med->H5_nT ]  = MLT;
+                            Lgm_SetArrElements3( med->H5_Pfn_cdmag[ iBuf ], MLAT, MLON, MLT );
+                            med->H5_Pfn_CD_MLAT[ iBuf ] = MLAT;
+                            med->H5_Pfn_CD_MLON[ iBuf ] = MLON;
+                            med->H5_Pfn_CD_MLT[ iBuf ]  = MLT;
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_EDMAG, c );
                             Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            Lgm_SetArrElements3( med->H5_Pfn_edmag[ med->H5_nT ], MLAT, MLON, MLT );
-                            med->H5_Pfn_ED_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_Pfn_ED_MLON[ med->H5_nT ] = MLON;
-                            med->H5_Pfn_ED_MLT[ med->H5_nT ]  = MLT;
+                            Lgm_SetArrElements3( med->H5_Pfn_edmag[ iBuf ], MLAT, MLON, MLT );
+                            med->H5_Pfn_ED_MLAT[ iBuf ] = MLAT;
+                            med->H5_Pfn_ED_MLON[ iBuf ] = MLON;
+                            med->H5_Pfn_ED_MLT[ iBuf ]  = MLT;
 
 
 
@@ -1836,40 +2021,40 @@ printf("sclkdp = %lf\n", sclkdp);
                              */
                             MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Ellipsoid_Footprint_Pn, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                             Lgm_Convert_Coords( &Bvec, &Bvec2, GSM_TO_WGS84, c );
-                            Lgm_VecToArr( &Bvec,  &med->H5_Bfn_gsm[ med->H5_nT ][0] ); med->H5_Bfn_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec  );
-                            Lgm_VecToArr( &Bvec2, &med->H5_Bfn_geo[ med->H5_nT ][0] ); med->H5_Bfn_geo[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec2 );
+                            Lgm_VecToArr( &Bvec,  &med->H5_Bfn_gsm[ iBuf ][0] ); med->H5_Bfn_gsm[ iBuf ][3] = Lgm_Magnitude( &Bvec  );
+                            Lgm_VecToArr( &Bvec2, &med->H5_Bfn_geo[ iBuf ][0] ); med->H5_Bfn_geo[ iBuf ][3] = Lgm_Magnitude( &Bvec2 );
 
 
                             /*
                              * Save northern loss cone.
                              */
                             Bfn_mag = Lgm_Magnitude( &Bvec );
-                            med->H5_LossConeAngleN[ med->H5_nT ] = asin( sqrt( Bsc_mag/Bfn_mag ) )*DegPerRad;
+                            med->H5_LossConeAngleN[ iBuf ] = asin( sqrt( Bsc_mag/Bfn_mag ) )*DegPerRad;
 
 
 
                         } else {
 
-                            Lgm_SetArrVal3( med->H5_Pfn_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfn_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfn_geod[ med->H5_nT ],         LGM_FILL_VALUE );
-                            Lgm_SetArrVal2( med->H5_Pfn_geod_LatLon[ med->H5_nT ],   LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfn_gsm[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfn_geo[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfn_geod[ iBuf ],         LGM_FILL_VALUE );
+                            Lgm_SetArrVal2( med->H5_Pfn_geod_LatLon[ iBuf ],   LGM_FILL_VALUE );
 
-                            med->H5_Pfn_geod_Height[ med->H5_nT ]  = LGM_FILL_VALUE;
-                            med->H5_Pfn_CD_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfn_CD_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfn_CD_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
-                            med->H5_Pfn_ED_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfn_ED_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfn_ED_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
+                            med->H5_Pfn_geod_Height[ iBuf ]  = LGM_FILL_VALUE;
+                            med->H5_Pfn_CD_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfn_CD_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfn_CD_MLT[ iBuf ]       = LGM_FILL_VALUE;
+                            med->H5_Pfn_ED_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfn_ED_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfn_ED_MLT[ iBuf ]       = LGM_FILL_VALUE;
 
-                            Lgm_SetArrVal3( med->H5_Pfn_cdmag[ med->H5_nT ],        LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfn_edmag[ med->H5_nT ],        LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfn_cdmag[ iBuf ],        LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfn_edmag[ iBuf ],        LGM_FILL_VALUE );
 
-                            Lgm_SetArrVal4( med->H5_Bfn_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal4( med->H5_Bfn_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal4( med->H5_Bfn_geo[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal4( med->H5_Bfn_gsm[ iBuf ],          LGM_FILL_VALUE );
 
-                            med->H5_LossConeAngleN[ med->H5_nT ] = LGM_FILL_VALUE;
+                            med->H5_LossConeAngleN[ iBuf ] = LGM_FILL_VALUE;
 
                         }
 
@@ -1878,29 +2063,29 @@ printf("sclkdp = %lf\n", sclkdp);
                             /*
                              * Save southern Footpoint position in different coord systems.
                              */
-                            Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Ps, med->H5_Pfs_gsm[ med->H5_nT ] );
+                            Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Ps, med->H5_Pfs_gsm[ iBuf ] );
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_GEO, c );
-                            Lgm_VecToArr( &W, med->H5_Pfs_geo[ med->H5_nT ] );
+                            Lgm_VecToArr( &W, med->H5_Pfs_geo[ iBuf ] );
 
                             Lgm_WGS84_to_GEOD( &W, &GeodLat, &GeodLong, &GeodHeight );
-                            Lgm_SetArrElements3( med->H5_Pfs_geod[ med->H5_nT ],        GeodLat, GeodLong, GeodHeight );
-                            Lgm_SetArrElements2( med->H5_Pfs_geod_LatLon[ med->H5_nT ], GeodLat, GeodLong );
-                            med->H5_Pfs_geod_Height[ med->H5_nT ]    = GeodHeight;
+                            Lgm_SetArrElements3( med->H5_Pfs_geod[ iBuf ],        GeodLat, GeodLong, GeodHeight );
+                            Lgm_SetArrElements2( med->H5_Pfs_geod_LatLon[ iBuf ], GeodLat, GeodLong );
+                            med->H5_Pfs_geod_Height[ iBuf ]    = GeodHeight;
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_CDMAG, c );
                             Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            Lgm_SetArrElements3( med->H5_Pfs_cdmag[ med->H5_nT ], MLAT, MLON, MLT );
-                            med->H5_Pfs_CD_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_Pfs_CD_MLON[ med->H5_nT ] = MLON;
-                            med->H5_Pfs_CD_MLT[ med->H5_nT ]  = MLT;
+                            Lgm_SetArrElements3( med->H5_Pfs_cdmag[ iBuf ], MLAT, MLON, MLT );
+                            med->H5_Pfs_CD_MLAT[ iBuf ] = MLAT;
+                            med->H5_Pfs_CD_MLON[ iBuf ] = MLON;
+                            med->H5_Pfs_CD_MLT[ iBuf ]  = MLT;
 
                             Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_EDMAG, c );
                             Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            Lgm_SetArrElements3( med->H5_Pfs_edmag[ med->H5_nT ], MLAT, MLON, MLT );
-                            med->H5_Pfs_ED_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_Pfs_ED_MLON[ med->H5_nT ] = MLON;
-                            med->H5_Pfs_ED_MLT[ med->H5_nT ]  = MLT;
+                            Lgm_SetArrElements3( med->H5_Pfs_edmag[ iBuf ], MLAT, MLON, MLT );
+                            med->H5_Pfs_ED_MLAT[ iBuf ] = MLAT;
+                            med->H5_Pfs_ED_MLON[ iBuf ] = MLON;
+                            med->H5_Pfs_ED_MLT[ iBuf ]  = MLT;
 
 
 
@@ -1909,40 +2094,40 @@ printf("sclkdp = %lf\n", sclkdp);
                              */
                             MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Ellipsoid_Footprint_Ps, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                             Lgm_Convert_Coords( &Bvec, &Bvec2, GSM_TO_WGS84, c );
-                            Lgm_VecToArr( &Bvec,  &med->H5_Bfs_gsm[ med->H5_nT ][0] ); med->H5_Bfs_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec  );
-                            Lgm_VecToArr( &Bvec2, &med->H5_Bfs_geo[ med->H5_nT ][0] ); med->H5_Bfs_geo[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec2 );
+                            Lgm_VecToArr( &Bvec,  &med->H5_Bfs_gsm[ iBuf ][0] ); med->H5_Bfs_gsm[ iBuf ][3] = Lgm_Magnitude( &Bvec  );
+                            Lgm_VecToArr( &Bvec2, &med->H5_Bfs_geo[ iBuf ][0] ); med->H5_Bfs_geo[ iBuf ][3] = Lgm_Magnitude( &Bvec2 );
 
 
                             /*
                              * Save southern loss cone.
                              */
                             Bfs_mag = Lgm_Magnitude( &Bvec );
-                            med->H5_LossConeAngleS[ med->H5_nT ] = asin( sqrt( Bsc_mag/Bfs_mag ) )*DegPerRad;
+                            med->H5_LossConeAngleS[ iBuf ] = asin( sqrt( Bsc_mag/Bfs_mag ) )*DegPerRad;
 
 
 
                         } else {
 
-                            Lgm_SetArrVal3( med->H5_Pfs_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfs_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfs_geod[ med->H5_nT ],         LGM_FILL_VALUE );
-                            Lgm_SetArrVal2( med->H5_Pfs_geod_LatLon[ med->H5_nT ],   LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfs_gsm[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfs_geo[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfs_geod[ iBuf ],         LGM_FILL_VALUE );
+                            Lgm_SetArrVal2( med->H5_Pfs_geod_LatLon[ iBuf ],   LGM_FILL_VALUE );
 
-                            med->H5_Pfs_geod_Height[ med->H5_nT ]  = LGM_FILL_VALUE;
-                            med->H5_Pfs_CD_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfs_CD_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfs_CD_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
-                            med->H5_Pfs_ED_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfs_ED_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                            med->H5_Pfs_ED_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
+                            med->H5_Pfs_geod_Height[ iBuf ]  = LGM_FILL_VALUE;
+                            med->H5_Pfs_CD_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfs_CD_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfs_CD_MLT[ iBuf ]       = LGM_FILL_VALUE;
+                            med->H5_Pfs_ED_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfs_ED_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                            med->H5_Pfs_ED_MLT[ iBuf ]       = LGM_FILL_VALUE;
 
-                            Lgm_SetArrVal3( med->H5_Pfs_cdmag[ med->H5_nT ],        LGM_FILL_VALUE );
-                            Lgm_SetArrVal3( med->H5_Pfs_edmag[ med->H5_nT ],        LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfs_cdmag[ iBuf ],        LGM_FILL_VALUE );
+                            Lgm_SetArrVal3( med->H5_Pfs_edmag[ iBuf ],        LGM_FILL_VALUE );
 
-                            Lgm_SetArrVal4( med->H5_Bfs_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                            Lgm_SetArrVal4( med->H5_Bfs_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal4( med->H5_Bfs_geo[ iBuf ],          LGM_FILL_VALUE );
+                            Lgm_SetArrVal4( med->H5_Bfs_gsm[ iBuf ],          LGM_FILL_VALUE );
 
-                            med->H5_LossConeAngleS[ med->H5_nT ] = LGM_FILL_VALUE;
+                            med->H5_LossConeAngleS[ iBuf ] = LGM_FILL_VALUE;
 
                         }
 
@@ -1952,23 +2137,72 @@ printf("sclkdp = %lf\n", sclkdp);
 
 
 
+                        /*
+                         * Hand the row to the writers, in time order.
+                         */
+                        #pragma omp ordered
+                        {
+
+                        /*
+                         * Write a row of data into the txt file
+                         */
+                        Lgm_WriteMagEphemData( TxtSink->fp, IntModel, ExtModel, MagEphemInfo->LstarInfo->mInfo->fKp, MagEphemInfo->LstarInfo->mInfo->Dst, MagEphemInfo );
+
+                        if ( DumpShellFiles && (nAlpha > 0) ){
+
+                            sprintf( ShellFile, "%s_%ld.dat", OutFile, Seconds );
+                            printf( "Writing Full Shell File: %s\n", ShellFile );
+                            WriteMagEphemInfoStruct( ShellFile, nAlpha, MagEphemInfo );
+                        }
+
                         /*
                          * Write a row of data into the hdf5 file
                          */
-                        Lgm_WriteMagEphemDataHdf( file, med->H5_nT, med->H5_nT, med );
-                        ++(med->H5_nT);
+                        Lgm_WriteMagEphemDataHdf( file, iRow, iBuf, med );
+                        if ( ColFile ) Lgm_WriteMagEphemDataCol( ColFile, iRow, iBuf, med );
+                        med->H5_nT = iRow+1;
+
+                        /*
+                         * Once the hdf5 writer has flushed its rows, get
+                         * both files onto disk and checkpoint.
+                         */
+                        if ( med->H5_nBuffered == 0 ) {
+                            H5Fflush( file, H5F_SCOPE_LOCAL );
+                            Checkpoint_Write( iRow+1, Lgm_Sink_Flush( TxtSink ), IsoTimeString, &Ckpt );
+                        }
+
+                        }
+
 
+                    }
 
+                    #ifdef _OPENMP
+                    if ( Lgm_MemoryReportMode() ) {
+                        size_t b = Lgm_CTrans_MemoryUsage( c ) + Lgm_MagEphemInfo_MemoryUsage( MagEphemInfo );
+                        #pragma omp critical (MemoryUsage)
+                        if ( b > ThreadBytes ) ThreadBytes = b;
+                    }
+                    Lgm_free_ctrans( c );
+                    Lgm_FreeMagEphemInfo( MagEphemInfo );
+                    #endif
                     }
 
-                    fclose(fp_MagEphem);
+                    Lgm_Sink_Close( TxtSink );
+                    Lgm_FlushMagEphemDataHdf( file, med );
                     H5Fclose( file );
+                    Checkpoint_Remove( &Ckpt );
+                    if ( ColFile ) {
+                        Lgm_CloseMagEphemColWriter( ColFile, med );
+                        ColFile = NULL;
+                    }
 
                     printf("DONE.\n");
                     Lgm_PrintElapsedTime( &t );
                     Lgm_SetElapsedTimeStr( &t );
-                    sprintf( Command, "sed -i '/ELAPSED_TIME/s++%s+g' %s", t.ElapsedTimeStr, OutFile); system( Command );
-                    sprintf( Command, "sed -i '/SPICE_KERNEL_FILES_LOADED/s++%s+' %s", SpiceKernelFilesLoaded, OutFile); system( Command );
+                    if ( !Gzip ) {
+                        sprintf( Command, "sed -i '/ELAPSED_TIME/s++%s+g' %s", t.ElapsedTimeStr, OutFile); system( Command );
+                        sprintf( Command, "sed -i '/SPICE_KERNEL_FILES_LOADED/s++%s+' %s", SpiceKernelFilesLoaded, OutFile); system( Command );
+                    }
 
 
                     /*
@@ -1982,6 +2216,9 @@ printf("sclkdp = %lf\n", sclkdp);
 
 
 
+                    if ( Verbosity > 0 ) printf( "\t    SPICE states: %ld fetched, %ld positions from SPICE directly\n", States.nFetched, States.nMissed );
+                    SpiceStates_Free( &States );
+
                     /*
                      * Unload spice kernels
                      */
@@ -1998,8 +2235,28 @@ printf("sclkdp = %lf\n", sclkdp);
     free( ShellFile );
     free( OutFile );
     free( HdfOutFile );
+    free( ColOutFile );
     free( InFile );
 
+    /*
+     * With LGM_MEMORY_REPORT set, say what the run held onto. Each thread had
+     * its own CTrans and MagEphemInfo (the largest of these is reported).
+     */
+    if ( Lgm_MemoryReportMode() ) {
+        Lgm_MemoryReport_Init( &MemReport );
+        Lgm_MemoryReport_Add( "CTrans",       Lgm_CTrans_MemoryUsage( c ),                  &MemReport );
+        Lgm_MemoryReport_Add( "MagEphemInfo", Lgm_MagEphemInfo_MemoryUsage( MagEphemInfo ), &MemReport );
+        Lgm_MemoryReport_Add( "MagEphemData", Lgm_MagEphemData_MemoryUsage( med ),          &MemReport );
+        if ( ThreadBytes > 0 ) {
+            for ( i=0; i<nThreads; i++ ) Lgm_MemoryReport_Add( "Per thread copies", ThreadBytes, &MemReport );
+        }
+        Lgm_MemoryReport_Write( &MemReport );
+    }
+
+    if ( ResultsCache != NULL ) {
+        if ( Verbosity > 0 ) printf( "Results cache: %ld pitch angles found, %ld computed, %ld times with nothing to compute\n", ResultsCache->nHits, ResultsCache->nMisses, ResultsCache->nEpochHits );
+        Lgm_CloseResultsCache( ResultsCache );
+    }
     Lgm_free_ctrans( c );
     Lgm_destroy_eop( e );
     Lgm_FreeMagEphemInfo( MagEphemInfo );
@@ -2015,6 +2272,8 @@ printf("sclkdp = %lf\n", sclkdp);
     LGM_ARRAY_1D_FREE( Ascend_U );
     LGM_ARRAY_1D_FREE( ApoPeriTimeList );
 
+    MagEphemWork_Finalize( &Work );
+
 
 
     return(0);
@@ -9,6 +9,9 @@
 #include <argp.h>
 #include <time.h>
 #include <libgen.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include <Lgm_CTrans.h>
 #include <Lgm_Sgp.h>
 #include <Lgm_MagEphemInfo.h>
@@ -17,9 +20,16 @@
 #include <Lgm_QinDenton.h>
 #include <Lgm_Misc.h>
 #include <Lgm_HDF5.h>
+#include <Lgm_MagEphemCol.h>
 #include <Lgm_ElapsedTime.h>
 #include <Lgm/qsort.h>
 #include <Lgm_Octree.h>
+#include <Lgm_MemoryUsage.h>
+#include <Lgm_MagEphemKnots.h>
+#include <Lgm_Prefetch.h>
+#include <Lgm_Sink.h>
+#include "MagEphemWork.h"
+#include "Checkpoint.h"
 
 #define EARTH_ID     399
 #define MOON_ID      301
@@ -44,16 +54,47 @@ static void elt_qsort( struct TimeList *arr, unsigned n ) {
     QSORT( struct TimeList, arr, n, elt_lt );
 }
 
-int WeDontAlreadyHaveThisTime( char *IsoTime, int nIsoTimeArray, char **IsoTimeArray ) {
+/*
+ * The IsoTimes of an existing file are normally in time order (and ISO
+ * strings in one format sort lexically in time order), so we can binary
+ * search them. Set once, when the existing times are read in.
+ */
+static int ExistingIsoTimesSorted = FALSE;
+
+int IsoTimesAreSorted( int nIsoTimeArray, char **IsoTimeArray ) {
 
     int i;
 
-    for ( i=0; i<nIsoTimeArray; i++ ) {
-        if ( strcmp( IsoTime, IsoTimeArray[i] ) == 0 )  { 
-            // then we have this exact time
-            printf("************************************************ We have time: %s already\n", IsoTime);
-            return( 0 );
+    for ( i=1; i<nIsoTimeArray; i++ ) {
+        if ( strcmp( IsoTimeArray[i-1], IsoTimeArray[i] ) > 0 ) return( FALSE );
+    }
+    return( TRUE );
+
+}
+
+int WeDontAlreadyHaveThisTime( char *IsoTime, int nIsoTimeArray, char **IsoTimeArray ) {
+
+    int i, lo, hi, c, Found = FALSE;
+
+    if ( ExistingIsoTimesSorted ) {
+        lo = 0; hi = nIsoTimeArray-1;
+        while ( !Found && ( lo <= hi ) ) {
+            i = lo + (hi-lo)/2;
+            c = strcmp( IsoTime, IsoTimeArray[i] );
+            if ( c == 0 )     Found = TRUE;
+            else if ( c < 0 ) hi = i-1;
+            else              lo = i+1;
         }
+    } else {
+        for ( i=0; i<nIsoTimeArray; i++ ) {
+            if ( strcmp( IsoTime, IsoTimeArray[i] ) == 0 )  { Found = TRUE; break; }
+        }
+    }
+
+    if ( Found ) {
+        // then we have this exact time
+        printf("************************************************ We have time: %s already\n", IsoTime);
+        return( 0 );
     }
 
     // we didnt find this exact time in the existing array
@@ -98,6 +139,21 @@ int InOutBound( TimeList *a, int n, double JD ){
 
 void StringSplit( char *Str, char *StrArray[], int len, int *n );
 
+/*
+ * Substitute a date and bird into a filename (%YYYY, %MM, %DD and %B).
+ */
+static void SubstituteDateBird( char *Filename, int Year, int Month, int Day, char *Bird ) {
+
+    char    NewStr[2048], Str[24];
+
+    NewStr[0] = '\0';
+    sprintf( Str, "%4d", Year );   Lgm_ReplaceSubString( NewStr, Filename, "%YYYY", Str );  strcpy( Filename, NewStr );
+    sprintf( Str, "%02d", Month ); Lgm_ReplaceSubString( NewStr, Filename, "%MM", Str );   strcpy( Filename, NewStr );
+    sprintf( Str, "%02d", Day );   Lgm_ReplaceSubString( NewStr, Filename, "%DD", Str );   strcpy( Filename, NewStr );
+    Lgm_ReplaceSubString( NewStr, Filename, "%B", Bird );    strcpy( Filename, NewStr );
+
+}
+
 #define KP_DEFAULT 0
 
 const  char *ProgramName = "MagEphemFromTLE";
@@ -115,7 +171,9 @@ static char doc[] =
 "\t\t/home/jsmith/MagEphemStuff/%YYYY/%YYYY%MM%DD_1989-046_MagEphem.txt.  \n"
 "\n"
 
-"Directories in the output file will be created if they don't already exist.\n";
+"Directories in the output file will be created if they don't already exist.\n\n"
+
+"If built with MPI (configure --enable-mpi), the (date, bird) pairs can be spread over several processes, e.g. 'mpirun -np 8 MagEphemFromTLE ...'. Each pair is written to its own files, so OutFile should contain the time variables (and %B for more than one bird).\n";
 
 
 
@@ -160,12 +218,20 @@ static struct argp_option Options[] = {
 
     { 0, 0, 0, 0,   "Update Options:", 5},
     {"Update",          'U',    0,                            0,        "Update an existing file by adding missing lines. Can also force reprocessing of times using the -A option. (Experimental.)" },
+    {"Resume",          'R',    0,                            0,        "Resume output files that were interrupted (they still have a <file>.h5.ckpt checkpoint next to them) from the last checkpointed time step, rather than skipping them. Not used with -U." },
     {"UpdateAfterDateTime",  'A',    "yyyymmdd[Thh:mm:ss]",        0,        "Redo times that occur after this time. This allows user to force reprocessing of recent times that may now have updated mag model inputs (e.g. Kp may be changed, etc.) Seconds will be truncated to integers.", 0 },
 
     { 0, 0, 0, 0,   "Output Options:", 6},
     {"Force",           'F',    0,                            0,        "Overwrite output file even if it already exists" },
     {"Verbosity",       'v',    "verbosity",                  0,        "Verbosity level to use. (0-4)"      },
     {"DumpShellFiles",  'd',    0,                            0,        "Dump full binary shell files (for use in visualizing drift shells)." },
+    {"Jobs",            'j',    "njobs",                      0,        "Run this many bird-days (output files) at once, as separate processes sharing the threads. Default is 1." },
+    {"PreClassify",     'P',    0,                            0,        "Use a cheap pre-trace to skip full traces of the open ends of field lines (Lgm_ClassifyFieldLine())." },
+    {"Window",          'w',    "nsteps",                     0,        "Only hold this many time steps in memory, writing them out as they fill (bounds memory use on long runs). Default is 0 (hold a whole day)." },
+    {"Columnar",        'B',    0,                            0,        "Also write a columnar binary file (<outfile>.mec) that can be memory-mapped by readers (see Lgm_OpenMagEphemCol()). Not written in update mode." },
+    {"Gzip",            'g',    0,                            0,        "Write the text file gzip'ed (<outfile>.txt.gz). It is compressed on background threads as the rows are made (see Lgm_Sink.c). The ELAPSED_TIME header field is then left unfilled." },
+    {"Adaptive",        'a',    "\"maxgap, lstar_tol\"",        0,        "Adaptive cadence: only compute L* etc. at some of the time steps (never more than maxgap steps apart, and closer where needed to keep the interpolation error in L* under lstar_tol), and interpolate the rest. E.g. \"10, 0.01\". Interpolated rows are flagged in the Interpolated variable. Not used with -U, -R or -d." },
+    {"ResultsCache",    'r',    "file",                       0,        "Look up (and store) the L* results of each time in this results cache file (see Lgm_OpenResultsCache()), so that reruns with the same inputs only compute what is new. Not used with -d." },
     {"Colorize",        'c',    0,                            0,        "Colorize output"                         },
     {"silent",          's',    0,                            OPTION_ARG_OPTIONAL | OPTION_ALIAS                                                },
 
@@ -187,6 +253,7 @@ struct Arguments {
     int         Colorize;
     int         Force;
     int         Update;
+    int         Resume;
     double      FootPointHeight;
 
     char        IntModel[80];
@@ -195,6 +262,14 @@ struct Arguments {
 
     int         UseEop;
     int         DumpShellFiles;
+    int         PreClassify;
+    int         Window;
+    int         Columnar;
+    int         Gzip;
+    int         Jobs;
+    char        ResultsCache[1024];
+    long int    AdaptiveMaxGap;
+    double      AdaptiveLstarTol;
 
     char        Birds[4096];
 
@@ -287,6 +362,9 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'U':
             arguments->Update = 1;
             break;
+        case 'R':
+            arguments->Resume = 1;
+            break;
         case 'F':
             arguments->Force = 1;
             break;
@@ -296,6 +374,27 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
         case 'd':
             arguments->DumpShellFiles = 1;
             break;
+        case 'P':
+            arguments->PreClassify = 1;
+            break;
+        case 'w':
+            sscanf( arg, "%d", &arguments->Window );
+            break;
+        case 'j':
+            sscanf( arg, "%d", &arguments->Jobs );
+            break;
+        case 'B':
+            arguments->Columnar = 1;
+            break;
+        case 'g':
+            arguments->Gzip = 1;
+            break;
+        case 'r':
+            strncpy( arguments->ResultsCache, arg, 1023 );
+            break;
+        case 'a':
+            sscanf( arg, "%ld, %lf", &arguments->AdaptiveMaxGap, &arguments->AdaptiveLstarTol );
+            break;
         case 'f':
             sscanf( arg, "%lf", &arguments->FootPointHeight );
             break;
@@ -435,6 +534,56 @@ int GetOrbitNumber( Lgm_DateTime *UTC, int nPerigee, Lgm_DateTime *Perigee_UTC,
 
 }
 
+/*
+ *  Everything needed at a time step before Lgm_ComputeLstarVersusPA() can be
+ *  called: propagate the TLE to UTC, set up the transforms (and EOP) and the
+ *  mag model parameters, and get the S/C position in GSM.
+ */
+void SetUpTimeStep( Lgm_DateTime *UTC, _SgpTLE *tle, _SgpInfo *sgp, int UseEop, Lgm_Eop *e, int FixModelDateTime, Lgm_DateTime *ModelDateTime,
+                    double ForceKp, int Verbosity, Lgm_CTrans *c, Lgm_MagModelInfo *mInfo, Lgm_Vector *Rgsm ) {
+
+    double          tsince;
+    Lgm_Vector      Uteme, U;
+    Lgm_EopOne      eop;
+    Lgm_QinDentonOne p;
+
+    LgmSgp_SGP4_Init( sgp, tle );
+
+    // do the propagation
+    tsince = (UTC->JD - tle->JD)*1440.0;
+    LgmSgp_SGP4( tsince, sgp );
+
+    // Convert from TEME -> GEI2000
+    Uteme.x = sgp->X/WGS84_A; Uteme.y = sgp->Y/WGS84_A; Uteme.z = sgp->Z/WGS84_A; 
+    Lgm_Set_Coord_Transforms( UTC->Date, UTC->Time, c );
+    Lgm_Convert_Coords( &Uteme, &U, TEME_TO_GEI2000, c );
+
+    if ( UseEop ) {
+        // Get (interpolate) the EOP vals from the values in the file at the given Julian Date
+        Lgm_get_eop_at_JD( UTC->JD, &eop, e );
+
+        // Set the EOP vals in the CTrans structure.
+        Lgm_set_eop( &eop, c );
+    }
+
+    // Set mag model parameters
+    Lgm_get_QinDenton_at_JD( FixModelDateTime ? ModelDateTime->JD : UTC->JD, &p, (Verbosity > 0)? 1 : 0, 1 );
+    Lgm_set_QinDenton( &p, mInfo );
+
+    if ( ForceKp >= 0.0 ) {
+        mInfo->fKp = ForceKp;
+        mInfo->Kp  = (int)(ForceKp+0.5);
+        if (mInfo->Kp > 6) mInfo->Kp = 6;
+        if (mInfo->Kp < 0 ) mInfo->Kp = 0;
+    }
+
+    // Set up the trans matrices
+    Lgm_Set_Coord_Transforms( UTC->Date, UTC->Time, c );
+    Lgm_Convert_Coords( &U, Rgsm, GEI2000_TO_GSM, c );
+
+}
+
+
 void Lgm_WriteMagEphemDataKML( FILE *fp, int i, Lgm_MagEphemData *med ) {
 
     int j;
@@ -647,28 +796,36 @@ int main( int argc, char *argv[] ){
     double           et, pos[3];
 
     struct Arguments arguments;
+    MagEphemWork     Work;
+    long int         iUnit;
     Lgm_CTrans       *c = Lgm_init_ctrans( 0 );
-    Lgm_Vector       Rgsm, Rgeo, W, U;
+    Lgm_Vector       Rgsm, Rgeo, W;
     Lgm_DateTime     UTC, ModelDateTime;
-    Lgm_Eop          *e = Lgm_init_eop( 0 );
-    Lgm_EopOne       eop;
+    Lgm_Eop          *e = NULL;
     int              FixModelDateTime;
     int              i;
     char             IsoTimeString[1024];
     char             InputFilename[1024];
     char             OutputFilename[1024];
     char             IntModel[20], ExtModel[20], CoordSystem[80];
-    int              DumpShellFiles, UseEop, Colorize, Force, Update;
-    FILE             *fp_in, *fp_MagEphem;
+    int              DumpShellFiles, UseEop, Colorize, Force, Update, Resume, Resuming, PreClassify, Window, Columnar, Gzip, nThreads;
+    Lgm_MemoryReport MemReport;
+    Lgm_ResultsCache *ResultsCache = NULL;
+    size_t           ThreadBytes = 0;
+    Checkpoint       Ckpt;
+    long int         nResume;
+    FILE             *fp_in;
+    Lgm_Sink         *TxtSink = NULL;
+    Lgm_MagEphemColWriter *ColFile = NULL;
     int              nBirds, iBird;
     char             **Birds, Bird[512];
     double           Inc, Alpha[1000], FootpointHeight;
     int              nAlpha, Quality, nFLsInDriftShell, Verbosity;
-    long int         StartDate, EndDate, Date, Delta;
-    int              sYear, sMonth, sDay, sDoy, eYear, eMonth, eDay, eDoy, Year, Month, Day;
-    double           sJD, eJD, JD, Time, StartSeconds, EndSeconds, UpdateAfter_et;
+    long int         StartDate, EndDate, Date, NextDate, Delta;
+    int              sYear, sMonth, sDay, sDoy, eYear, eMonth, eDay, eDoy, Year, Month, Day, nYear, nMonth, nDay;
+    double           sJD, eJD, JD, Time, nTime, StartSeconds, EndSeconds, UpdateAfter_et;
+    Lgm_Prefetcher   *Prefetcher;
     Lgm_MagEphemInfo *MagEphemInfo;
-    Lgm_QinDentonOne p;
 
     hid_t           file;
     hid_t           space;
@@ -685,7 +842,10 @@ int main( int argc, char *argv[] ){
     lfInfo          *lfi;
     double          La, Lb, Lmin;
     int             done, BODY;
-    long int        ss, es, Seconds, Ta, Tb, Tc;
+    long int        ss, es, Seconds, iRow, iBuf, Ta, Tb, Tc;
+    long int        *KnotSteps, nKnotSteps, iKnot;
+    int             KnotResult;
+    Lgm_MagEphemKnots *Knots;
     double          R, Ra, Rb, Rc, Rmin, Tmin;
     BrentFuncInfo   bInfo;
     afInfo          *afi;
@@ -745,8 +905,17 @@ int main( int argc, char *argv[] ){
     arguments.Colorize         = 0;
     arguments.Force            = 0;
     arguments.Update           = 0;
+    arguments.Resume           = 0;
     arguments.UseEop           = 0;
     arguments.DumpShellFiles   = 0;
+    arguments.PreClassify      = 0;
+    arguments.Window           = 0;
+    arguments.ResultsCache[0]  = '\0';
+    arguments.AdaptiveMaxGap   = 0;      // 0 means compute every step
+    arguments.AdaptiveLstarTol = 0.01;
+    arguments.Columnar         = 0;
+    arguments.Gzip             = 0;
+    arguments.Jobs             = 1;
     arguments.FixModelDateTime =  0;
     arguments.StartDate        = -1;
     arguments.EndDate          = -1;
@@ -770,6 +939,11 @@ int main( int argc, char *argv[] ){
 
 
 
+    /*
+     *  Start MPI (if we have it) before argp sees the command line.
+     */
+    MagEphemWork_Init( &argc, &argv, &Work );
+
     /*
      *  Parse CmdLine arguments and options
      */
@@ -806,8 +980,13 @@ int main( int argc, char *argv[] ){
     Colorize           = arguments.Colorize;
     Force              = arguments.Force;
     Update             = arguments.Update;
+    Resume             = arguments.Resume;
     UseEop             = arguments.UseEop;
     DumpShellFiles     = arguments.DumpShellFiles;
+    PreClassify        = arguments.PreClassify;
+    Window             = arguments.Window;
+    Columnar           = arguments.Columnar;
+    Gzip               = arguments.Gzip;
     Delta              = arguments.Delta;
     StartDate          = arguments.StartDate;
     EndDate            = arguments.EndDate;
@@ -858,6 +1037,14 @@ int main( int argc, char *argv[] ){
         printf( "\t       Update to existing file: %s\n", Update ? "yes" : "no" );
         printf( "\t                       Use Eop: %s\n", UseEop ? "yes" : "no" );
         printf( "\t         Dump Full Shell Files: %s\n", DumpShellFiles ? "yes" : "no" );
+        printf( "\t          Pre-classify FL type: %s\n", PreClassify ? "yes" : "no" );
+        if ( Window > 0 ) printf( "\t     Time steps held in memory: %d\n", Window );
+        else              printf( "\t     Time steps held in memory: whole day\n" );
+        printf( "\t           Write Columnar File: %s\n", Columnar ? "yes" : "no" );
+        printf( "\t          Concurrent bird-days: %d\n", arguments.Jobs );
+        if ( arguments.AdaptiveMaxGap > 0 ) printf( "\t              Adaptive Cadence: max gap %ld steps, L* tolerance %g\n", arguments.AdaptiveMaxGap, arguments.AdaptiveLstarTol );
+        else                                printf( "\t              Adaptive Cadence: no\n" );
+        printf( "\t                 Results Cache: %s\n", ( arguments.ResultsCache[0] != '\0' ) ? arguments.ResultsCache : "none" );
         printf( "\t        Colorize Thread Output: %d\n", Colorize );
         printf( "\t               Verbosity Level: %d\n", Verbosity );
         printf( "\t                        Silent: %s\n", arguments.silent  ? "yes" : "no" );
@@ -890,7 +1077,29 @@ int main( int argc, char *argv[] ){
     
     int NNN = (int)( (eJD-sJD+1)*86400.0/(double)Delta + 1.0);
     if (NNN > 86401 ) NNN = 86401;
-    med = Lgm_InitMagEphemData( NNN, 80 );
+
+    /*
+     *  With a Window, med only holds that many time steps. They are used as a
+     *  ring buffer (step iRow lives in row iRow % med->H5_nRows) and are
+     *  written to the hdf5 file in blocks as they fill, so memory use no
+     *  longer grows with the run length (the file itself is the same). A
+     *  row can only be reused once it has been written, i.e. the ring has
+     *  to hold one block (H5_nBuffer) plus the steps still being computed
+     *  (at most one per thread).
+     */
+    MagEphemWork_StartJobs( arguments.Jobs, &Work );
+
+    nThreads = 1;
+    #ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+    #endif
+    if ( ( Window > 0 ) && ( Window < NNN ) ) {
+        if ( Window < 2*nThreads ) Window = 2*nThreads;
+        med = Lgm_InitMagEphemData( Window, 80 );
+        if ( med->H5_nBuffer > Window - nThreads ) Lgm_SetMagEphemHdfOptions( med->H5_ChunkBytes, Window - nThreads, med->H5_Deflate, med->H5_Shuffle, med );
+    } else {
+        med = Lgm_InitMagEphemData( NNN, 80 );
+    }
     
 
 
@@ -907,12 +1116,19 @@ int main( int argc, char *argv[] ){
 
     // Settings for Lstar calcs
     Lgm_SetMagEphemLstarQuality( Quality, nFLsInDriftShell, MagEphemInfo );
+    MagEphemInfo->LstarInfo->mInfo->PreClassifyFieldLines = PreClassify;
     MagEphemInfo->SaveShellLines = TRUE;
     MagEphemInfo->LstarInfo->LSimpleMax = 12.0;
     MagEphemInfo->LstarInfo->VerbosityLevel = Verbosity;
     MagEphemInfo->LstarInfo->mInfo->VerbosityLevel = Verbosity;
     MagEphemInfo->LstarInfo->mInfo->Lgm_LossConeHeight = FootpointHeight;
 
+    // The drift shell lines arent kept in the results cache
+    if ( ( arguments.ResultsCache[0] != '\0' ) && !DumpShellFiles ) {
+        ResultsCache = Lgm_OpenResultsCache( arguments.ResultsCache, FALSE );
+        Lgm_MagEphemInfo_SetResultsCache( ResultsCache, MagEphemInfo );
+    }
+
     // The default model is Lgm_B_T89c
     MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
 
@@ -993,10 +1209,12 @@ int main( int argc, char *argv[] ){
         SubstituteVars = FALSE;
     }
 
-    char *BaseDir, NewStr[2048], Str[24], Command[4096];
+    char *BaseDir, Command[4096];
     char *OutFile    = (char *)calloc( 2056, sizeof( char ) );
     char *HdfOutFile = (char *)calloc( 2056, sizeof( char ) );
+    char *ColOutFile = (char *)calloc( 2056, sizeof( char ) );
     char *InFile     = (char *)calloc( 2056, sizeof( char ) );
+    char *NextInFile = (char *)calloc( 2056, sizeof( char ) );
     char *ShellFile  = (char *)calloc( 2056, sizeof( char ) );
 
 
@@ -1005,15 +1223,36 @@ int main( int argc, char *argv[] ){
 
     sgp = (_SgpInfo *)calloc( 1, sizeof(_SgpInfo) );
 
+    Prefetcher = Lgm_InitPrefetcher( LGM_PREFETCH_QINDENTON | ( UseEop ? LGM_PREFETCH_EOP : 0 ) );
+
 
 
     /*
-     * loop over all dates
+     * loop over all dates. Each (date, bird) pair is a work unit; with MPI
+     * the units are shared out over the ranks, and with --jobs over local
+     * processes (see MagEphemWork.c).
      */
+    iUnit = 0;
+    if ( SubstituteVars ) Lgm_Prefetch( Prefetcher, StartDate );
     for ( JD = sJD; JD <= eJD; JD += 1.0 ) {
 
         Date = Lgm_JD_to_Date( JD, &Year, &Month, &Day, &Time );
 
+        /*
+         * Start reading the next day's inputs (QinDenton days and the TLE
+         * files) in the background while this day is being done (see
+         * Lgm_Prefetch.c).
+         */
+        if ( SubstituteVars && ( JD + 1.0 <= eJD ) ) {
+            NextDate = Lgm_JD_to_Date( JD + 1.0, &nYear, &nMonth, &nDay, &nTime );
+            for ( iBird = 0; iBird < nBirds; iBird++ ) {
+                strcpy( NextInFile, InputFilename );
+                SubstituteDateBird( NextInFile, nYear, nMonth, nDay, Birds[ iBird ] );
+                Lgm_Prefetcher_AddFile( Prefetcher, NextInFile );
+            }
+            Lgm_Prefetch( Prefetcher, NextDate );
+        }
+
 
 
         /*
@@ -1021,6 +1260,8 @@ int main( int argc, char *argv[] ){
          */
          for ( iBird = 0; iBird < nBirds; iBird++ ) {
 
+            if ( !MagEphemWork_IsMine( iUnit++, &Work ) ) continue;
+
 
             strcpy( InFile, InputFilename );
             strcpy( OutFile, OutputFilename );
@@ -1063,16 +1304,8 @@ if        ( !strcmp( Bird, "rbspa" ) ){
             if ( SubstituteVars ) {
 
                 // Substitute times in the files.
-                NewStr[0] = '\0';
-                sprintf( Str, "%4d", Year );   Lgm_ReplaceSubString( NewStr, InFile, "%YYYY", Str );  strcpy( InFile, NewStr );
-                sprintf( Str, "%02d", Month ); Lgm_ReplaceSubString( NewStr, InFile, "%MM", Str );   strcpy( InFile, NewStr );
-                sprintf( Str, "%02d", Day );   Lgm_ReplaceSubString( NewStr, InFile, "%DD", Str );   strcpy( InFile, NewStr );
-                Lgm_ReplaceSubString( NewStr, InFile, "%B", Bird );    strcpy( InFile, NewStr );
-
-                sprintf( Str, "%4d", Year );   Lgm_ReplaceSubString( NewStr, OutFile, "%YYYY", Str );  strcpy( OutFile, NewStr );
-                sprintf( Str, "%02d", Month ); Lgm_ReplaceSubString( NewStr, OutFile, "%MM", Str );   strcpy( OutFile, NewStr );
-                sprintf( Str, "%02d", Day );   Lgm_ReplaceSubString( NewStr, OutFile, "%DD", Str );   strcpy( OutFile, NewStr );
-                Lgm_ReplaceSubString( NewStr, OutFile, "%B", Bird );    strcpy( OutFile, NewStr );
+                SubstituteDateBird( InFile,  Year, Month, Day, Bird );
+                SubstituteDateBird( OutFile, Year, Month, Day, Bird );
 
             }
 
@@ -1081,7 +1314,8 @@ if        ( !strcmp( Bird, "rbspa" ) ){
              * Then we need to add ".txt" and ".h5" to each
              */
             sprintf( HdfOutFile, "%s.h5", OutFile );
-            strcat( OutFile, ".txt" );
+            sprintf( ColOutFile, "%s.mec", OutFile );
+            strcat( OutFile, Gzip ? ".txt.gz" : ".txt" );
 
 
 
@@ -1093,7 +1327,9 @@ if        ( !strcmp( Bird, "rbspa" ) ){
             printf( "      -------------------------------------------------------------------------------------------\n");
             printf( "           Input File: %s\n", InFile);
             printf( "      TXT Output File: %s\n", OutFile);
-            printf( "     HDF5 Output File: %s\n\n", HdfOutFile);
+            printf( "     HDF5 Output File: %s\n", HdfOutFile);
+            if ( Columnar ) printf( " Columnar Output File: %s\n", ColOutFile);
+            printf( "\n" );
 
 
 
@@ -1155,6 +1391,7 @@ if        ( !strcmp( Bird, "rbspa" ) ){
                     file = H5Fopen( HdfOutFile,  H5F_ACC_RDWR, H5P_DEFAULT );
                     Existing_H5_IsoTimes  = Get_StringDataset_1D( file, "/IsoTime", Dims );
                     nExisting_H5_IsoTimes = Dims[0];
+                    ExistingIsoTimesSorted = IsoTimesAreSorted( nExisting_H5_IsoTimes, Existing_H5_IsoTimes );
                     H5Fclose( file );
 printf("nExisting_H5_IsoTimes = %d\n", nExisting_H5_IsoTimes);
 for (i=0; i<nExisting_H5_IsoTimes; i++){
@@ -1184,7 +1421,26 @@ if ( Update ) {
 
 
 
-            if ( !FileExists || Force ) {
+            /*
+             *   A file that still has a checkpoint was interrupted. Carry on
+             *   from the checkpoint if asked to (see Checkpoint.c).
+             */
+            Checkpoint_Init( HdfOutFile, &Ckpt );
+            Resuming = FALSE;
+            nResume  = 0;
+            if ( FileExists && !Update && Checkpoint_Read( &Ckpt ) ) {
+                if ( Force ) {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Redoing it.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                } else if ( Resume && Checkpoint_TruncateTxt( OutFile, &Ckpt ) ) {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Resuming from there.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                    Resuming = TRUE;
+                    nResume  = Ckpt.nRows;
+                } else {
+                    printf("\t  Outfile was interrupted after %ld time steps (%s). Use -R to resume it or -F to redo it.\n\n", Ckpt.nRows, Ckpt.LastTime );
+                }
+            }
+
+            if ( !FileExists || Force || Resuming ) {
 
 
                 /*
@@ -1265,7 +1521,7 @@ afi->BODY = BODY;
                                 Lgm_Convert_Coords( &Apogee_U[nApogee], &w, GEI2000_TO_WGS84, c );
                                 Lgm_WGS84_to_GEOD( &w, &med->H5_Apogee_Geod[nApogee][0], &med->H5_Apogee_Geod[nApogee][1], &med->H5_Apogee_Geod[nApogee][2] );
 
-                                Lgm_DateTimeToString( med->H5_Apogee_IsoTimes[nApogee], &Apogee_UTC[nApogee], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Apogee_IsoTimes[nApogee], &Apogee_UTC[nApogee], 3 );
                                 printf("nApogee: %d Bracket: T = %8ld %8ld %8ld    R = %g %g %g    Tapogee, Rapogee = %s %g\n", nApogee, Ta, Tb, Tc, Ra, Rb, Rc, med->H5_Apogee_IsoTimes[nApogee], fabs(Rmin) );
                                 ApoPeriTimeList[nApoPeriTimeList].key = Apogee_UTC[nApogee].JD;
                                 ApoPeriTimeList[nApoPeriTimeList].val = 1; // because its apogee
@@ -1316,7 +1572,7 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
                                 Lgm_Convert_Coords( &Uteme, &Ugei, TEME_TO_GEI2000, c );
                                 Perigee_U[nPerigee].x = Ugei.x; Perigee_U[nPerigee].y = Ugei.y; Perigee_U[nPerigee].z = Ugei.z;
 
-                                Lgm_DateTimeToString( med->H5_Perigee_IsoTimes[nPerigee], &Perigee_UTC[nPerigee], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Perigee_IsoTimes[nPerigee], &Perigee_UTC[nPerigee], 3 );
                                 printf("nPerigee: %d Bracket: T = %8ld %8ld %8ld    R = %g %g %g    Tperigee, Rperigee = %s %g\n", nPerigee, Ta, Tb, Tc, Ra, Rb, Rc, med->H5_Perigee_IsoTimes[nPerigee], fabs(Rmin) );
 
                                 ApoPeriTimeList[nApoPeriTimeList].key = Perigee_UTC[nPerigee].JD;
@@ -1384,7 +1640,7 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
                                 Lgm_Convert_Coords( &Ascend_U[nAscend], &w, GEI2000_TO_WGS84, c );
                                 Lgm_WGS84_to_GEOD( &w, &med->H5_Ascend_Geod[nAscend][0], &med->H5_Ascend_Geod[nAscend][1], &med->H5_Ascend_Geod[nAscend][2] );
 
-                                Lgm_DateTimeToString( med->H5_Ascend_IsoTimes[nAscend], &Ascend_UTC[nAscend], 0, 3 );
+                                Lgm_DateTimeToIsoString( med->H5_Ascend_IsoTimes[nAscend], &Ascend_UTC[nAscend], 3 );
                                 printf("nNode: %d Bracket: T = %ld %ld    L = %g %g    Tnode, Lnode = %s %g\n", nAscend, Ta, Tb, La, Lb, med->H5_Ascend_IsoTimes[nAscend], Lmin );
 
                                 ++nAscend;
@@ -1405,18 +1661,22 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
 //BODY?
 
                     /*
-                     * Open MagEphem txt file for writing and write header.
+                     * Open MagEphem txt file for writing and write header
+                     * (or, when updating or resuming, carry on at the end
+                     * of it). It stays open for the day.
                      */
-                    if ( !Update ) {
+                    if ( !Update && !Resuming ) {
+                        Checkpoint_Remove( &Ckpt );
                         printf("\t      Writing Header to file: %s\n", OutFile );
-                        fp_MagEphem = fopen( OutFile, "w" );
-                        Lgm_WriteMagEphemHeader( fp_MagEphem, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo );
-                        fclose(fp_MagEphem);
+                        TxtSink = Lgm_Sink_Open( OutFile, "w", 0 );
+                        Lgm_WriteMagEphemHeader( TxtSink->fp, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, nAscend, Ascend_UTC, Ascend_U, nPerigee, Perigee_UTC, Perigee_U, nApogee, &Apogee_UTC[0], &Apogee_U[0], MagEphemInfo );
+                    } else {
+                        TxtSink = Lgm_Sink_Open( OutFile, "a", 0 );
                     }
 
                     if ( UseEop ) {
-                        // Read in the EOP vals
-                        Lgm_read_eop( e );
+                        // Get the EOP vals (read once, by the prefetcher)
+                        e = Lgm_Prefetch_GetEop( Prefetcher );
                     }
 
 
@@ -1430,7 +1690,7 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
 //PROBLEM AREA...
 //BODY?
 
-                    if ( !Update ) {
+                    if ( !Update && !Resuming ) {
                         file    = H5Fcreate( HdfOutFile, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
                         Lgm_WriteMagEphemHeaderHdf( file, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine, 
                                                 nAscend, Ascend_UTC, Ascend_U, 
@@ -1454,12 +1714,97 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
                     ss = (Date == StartDate) ? StartSeconds : 0;
                     es = (Date == EndDate) ? EndSeconds : 86400;
 
+                    /*
+                     * Create the columnar file (with room for every step of the day).
+                     * It is not written when updating or resuming.
+                     */
+                    if ( Columnar && !Update && !Resuming ) {
+                        ColFile = Lgm_CreateMagEphemCol( ColOutFile, (es-ss)/Delta + 1, argp_program_version, ExtModel, BODY, CommonName, IdNumber, IntDesig, CmdLine,
+                                                nAscend, Ascend_UTC, Ascend_U,
+                                                nPerigee, Perigee_UTC, Perigee_U,
+                                                nApogee, &Apogee_UTC[0], &Apogee_U[0],
+                                                MagEphemInfo, med );
+                    }
+
                     med->H5_nT = 0;
                     Lgm_ElapsedTimeInit( &t, 255, 150, 0 );
+
+                    /*
+                     *  In adaptive mode, first do the full calculations at
+                     *  the knots (see Lgm_MagEphemKnots.c). They come in
+                     *  rounds (each refining the last), and the steps of a
+                     *  round are spread over threads like the main loop
+                     *  below, which then fills in every step from them.
+                     *  Updates and resumes only do some of the steps, and
+                     *  shell files need the shells of every step, so these
+                     *  always compute every step.
+                     */
+                    Knots = NULL;
+                    if ( ( arguments.AdaptiveMaxGap > 0 ) && !Update && !Resuming && !DumpShellFiles ) {
+                        Knots     = Lgm_InitMagEphemKnots( (es-ss)/Delta + 1, nAlpha, arguments.AdaptiveMaxGap, arguments.AdaptiveLstarTol, -1.0 );
+                        KnotSteps = (long int *)calloc( (es-ss)/Delta + 1, sizeof(long int) );
+                        while ( ( nKnotSteps = Lgm_MagEphemKnots_Next( KnotSteps, Knots ) ) > 0 ) {
+
+                            if ( Verbosity > 0 ) printf( "\t\tAdaptive cadence: computing %ld more knots\n", nKnotSteps );
+
+                            #pragma omp parallel firstprivate( c, MagEphemInfo, sgp ) private( iKnot, UTC, Rgsm )
+                            {
+                            #ifdef _OPENMP
+                            c            = Lgm_CopyCTrans( c );
+                            MagEphemInfo = Lgm_CopyMagEphemInfo( MagEphemInfo, (nAlpha > 0) ? nAlpha : 1 );
+                            sgp          = (_SgpInfo *)calloc( 1, sizeof(_SgpInfo) );
+                            #endif
+
+                            #pragma omp for schedule(dynamic, 1)
+                            for ( iKnot=0; iKnot<nKnotSteps; iKnot++ ) {
+                                Lgm_Make_UTC( Date, (ss + KnotSteps[iKnot]*Delta)/3600.0, &UTC, c );
+                                SetUpTimeStep( &UTC, &tle[0], sgp, UseEop, e, FixModelDateTime, &ModelDateTime, ForceKp, Verbosity, c, MagEphemInfo->LstarInfo->mInfo, &Rgsm );
+                                Lgm_ComputeLstarVersusPA( UTC.Date, UTC.Time, &Rgsm, nAlpha, Alpha, Colorize, MagEphemInfo );
+                                Lgm_MagEphemKnots_Save( KnotSteps[iKnot], MagEphemInfo, Knots );
+                            }
+
+                            #ifdef _OPENMP
+                            Lgm_free_ctrans( c );
+                            Lgm_FreeMagEphemInfo( MagEphemInfo );
+                            free( sgp );
+                            #endif
+                            }
+
+                        }
+                        free( KnotSteps );
+                        if ( Verbosity > 0 ) printf( "\t\tAdaptive cadence: %ld of %ld steps computed\n", Knots->nKnots, Knots->nSteps );
+                    }
+
+                    /*
+                     *  The time steps are independent, so they are spread
+                     *  over threads (each with its own copies of c,
+                     *  MagEphemInfo and sgp). Each step fills in its own slot
+                     *  (iBuf) in med, and the ordered block at the end of the
+                     *  step hands it to the (text and hdf5) writers in time
+                     *  order -- so threads keep computing while earlier rows
+                     *  are being written. Rows of the file are still counted
+                     *  by med->H5_nT, since in update mode steps we already
+                     *  have are skipped. Lgm_ComputeLstarVersusPA()'s own
+                     *  parallel loop over pitch angles runs serially within
+                     *  each thread here (unless nested parallelism is
+                     *  enabled).
+                     */
+                    #pragma omp parallel firstprivate( c, MagEphemInfo, sgp ) private( iRow, iBuf, KnotResult, UTC, IsoTimeString, et, Rgsm, W, Rgeo, GeodLat, GeodLong, GeodHeight, R, MLAT, MLON, MLT, Bsc_gsm, Bvec, Bvec2, Bmin_mag, Bsc_mag, Bfn_mag, Bfs_mag, i, Ek, E, p2c2, Beta2, Beta, vel, T, pp, rg, s, cl )
+                    {
+                    #ifdef _OPENMP
+                    c            = Lgm_CopyCTrans( c );
+                    MagEphemInfo = Lgm_CopyMagEphemInfo( MagEphemInfo, (nAlpha > 0) ? nAlpha : 1 );
+                    sgp          = (_SgpInfo *)calloc( 1, sizeof(_SgpInfo) );
+                    #endif
+
+                    #pragma omp for ordered schedule(dynamic, 1)
                     for ( Seconds=ss; Seconds<=es; Seconds += Delta ) {
 
+                        iRow = (Seconds-ss)/Delta;
+                        iBuf = iRow % med->H5_nRows;   // row of med that holds this step
+
                         Lgm_Make_UTC( Date, Seconds/3600.0, &UTC, c );
-                        Lgm_DateTimeToString( IsoTimeString, &UTC, 0, 0 );
+                        Lgm_DateTimeToIsoString( IsoTimeString, &UTC, 0 );
             
                         /*
                          * If we are running in append mode, we need to check
@@ -1467,7 +1812,7 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
                          */
                         et = Lgm_TDBSecSinceJ2000( &UTC, c );
 //printf("et, UpdateAfter_et = %g %g\n", et, UpdateAfter_et);
-                        if ( !Update || WeDontAlreadyHaveThisTime( IsoTimeString, nExisting_H5_IsoTimes, Existing_H5_IsoTimes )  || ( et >= UpdateAfter_et ) ) {
+                        if ( ( iRow >= nResume ) && ( !Update || WeDontAlreadyHaveThisTime( IsoTimeString, nExisting_H5_IsoTimes, Existing_H5_IsoTimes )  || ( et >= UpdateAfter_et ) ) ) {
 
 
 
@@ -1477,208 +1822,145 @@ printf("nPerigee = %d, Date, Tmin = %ld %g\n", nPerigee, Date, Tmin );
 //int tiii = LgmSgp_FindTLEforGivenTime( nTle, tle, 1, UTC.JD, 1 );
 int tiii = 0;
 //if (tiii < 0 ) tiii = 0;
-//printf("tle index to use: %d  tsince = %g    (prev, next = %g %g)\n", tiii, (UTC.JD - tle[tiii].JD)*1440.0, (UTC.JD - tle[tiii-1].JD)*1440.0, (UTC.JD - tle[tiii+1].JD)*1440.0);
-//printf("Line0: %s\n", tle[tiii].Line0 );
-//printf("Line1: %s\n", tle[tiii].Line1 );
-//printf("Line2: %s\n", tle[tiii].Line2 );
-
-                            LgmSgp_SGP4_Init( sgp, &tle[tiii] );
-
-
-                            // do the propagation
-                            tsince = (UTC.JD - tle[tiii].JD)*1440.0;
-                            LgmSgp_SGP4( tsince, sgp );
-
-
-
-                            // Convert from TEME -> GEI2000
-                            Uteme.x = sgp->X/WGS84_A; Uteme.y = sgp->Y/WGS84_A; Uteme.z = sgp->Z/WGS84_A; 
-                            Lgm_Set_Coord_Transforms( UTC.Date, UTC.Time, c );
-                            Lgm_Convert_Coords( &Uteme, &U, TEME_TO_GEI2000, c );
-
-
-                            if ( UseEop ) {
-                                // Get (interpolate) the EOP vals from the values in the file at the given Julian Date
-                                Lgm_get_eop_at_JD( UTC.JD, &eop, e );
-
-                                // Set the EOP vals in the CTrans structure.
-                                Lgm_set_eop( &eop, c );
-                            }
 
-                            // Set mag model parameters
-                            if ( FixModelDateTime ) {
-                                Lgm_get_QinDenton_at_JD( ModelDateTime.JD, &p, (Verbosity > 0)? 1 : 0, 1 );
-                                Lgm_set_QinDenton( &p, MagEphemInfo->LstarInfo->mInfo );
-                            } else {
-                                Lgm_get_QinDenton_at_JD( UTC.JD, &p, (Verbosity > 0)? 1 : 0, 1 );
-                                Lgm_set_QinDenton( &p, MagEphemInfo->LstarInfo->mInfo );
-                            }
-
-
-                            if ( ForceKp >= 0.0 ) {
-                                MagEphemInfo->LstarInfo->mInfo->fKp = ForceKp;
-                                MagEphemInfo->LstarInfo->mInfo->Kp  = (int)(ForceKp+0.5);
-                                if (MagEphemInfo->LstarInfo->mInfo->Kp > 6) MagEphemInfo->LstarInfo->mInfo->Kp = 6;
-                                if (MagEphemInfo->LstarInfo->mInfo->Kp < 0 ) MagEphemInfo->LstarInfo->mInfo->Kp = 0;
-                            }
-
-
-                            // Set up the trans matrices
-                            Lgm_Set_Coord_Transforms( UTC.Date, UTC.Time, c );
+                            SetUpTimeStep( &UTC, &tle[tiii], sgp, UseEop, e, FixModelDateTime, &ModelDateTime, ForceKp, Verbosity, c, MagEphemInfo->LstarInfo->mInfo, &Rgsm );
                             MagEphemInfo->OrbitNumber = GetOrbitNumber( &UTC, nPerigee, Perigee_UTC, PerigeeOrbitNumber );
-                            Lgm_Convert_Coords( &U, &Rgsm, GEI2000_TO_GSM, c );
 
 
                             /*
                              * Compute L*s, Is, Bms, Footprints, etc...
                              * These quantities are stored in the MagEphemInfo Structure
+                             * (or filled in from the knots, in adaptive mode).
                              */
                             if ( Verbosity > 0 ) {
                                 printf("\t\t"); Lgm_PrintElapsedTime( &t ); printf("\n");
                                 printf("\n\n\t[ %s ]: %s  Bird: %s Kp: %g    Rgsm: %g %g %g Re\n", ProgramName, IsoTimeString, Bird, MagEphemInfo->LstarInfo->mInfo->fKp, Rgsm.x, Rgsm.y, Rgsm.z );
                                 printf("\t-------------------------------------------------------------------------------------------------------------------\n");
                             }
-                            Lgm_ComputeLstarVersusPA( UTC.Date, UTC.Time, &Rgsm, nAlpha, Alpha, Colorize, MagEphemInfo );
-
-                            MagEphemInfo->InOut = InOutBound( ApoPeriTimeList, nApoPeriTimeList, UTC.JD );
-
-                            /*
-                             * Open file in append mode.
-                             * Write a row of data into the txt file.
-                             */
-                            fp_MagEphem = fopen( OutFile, "a" );
-                            Lgm_WriteMagEphemData( fp_MagEphem, IntModel, ExtModel, MagEphemInfo->LstarInfo->mInfo->fKp, MagEphemInfo->LstarInfo->mInfo->Dst, MagEphemInfo );
-                            fclose(fp_MagEphem);
-
-
-
-
-                            if ( DumpShellFiles && (nAlpha > 0) ){
-
-                                sprintf( ShellFile, "%s_%ld.dat", OutFile, Seconds );
-                                printf( "Writing Full Shell File: %s\n", ShellFile );
-                                WriteMagEphemInfoStruct( ShellFile, nAlpha, MagEphemInfo );
+                            KnotResult = Lgm_MagEphemKnots_Fill( iRow, UTC.Date, UTC.Time, &Rgsm, nAlpha, Alpha, Knots, MagEphemInfo );
+                            if ( KnotResult == LGM_MEK_NONE ) {
+                                Lgm_ComputeLstarVersusPA( UTC.Date, UTC.Time, &Rgsm, nAlpha, Alpha, Colorize, MagEphemInfo );
                             }
 
-
-
+                            MagEphemInfo->InOut = InOutBound( ApoPeriTimeList, nApoPeriTimeList, UTC.JD );
 
                             // Fill arrays for dumping out as HDF5 files
-                            strcpy( med->H5_IsoTimes[ med->H5_nT ], IsoTimeString );
-                            strcpy( med->H5_IntModel[ med->H5_nT ], IntModel );
-                            strcpy( med->H5_ExtModel[ med->H5_nT ], ExtModel );
+                            strcpy( med->H5_IsoTimes[ iBuf ], IsoTimeString );
+                            strcpy( med->H5_IntModel[ iBuf ], IntModel );
+                            strcpy( med->H5_ExtModel[ iBuf ], ExtModel );
                             switch ( MagEphemInfo->FieldLineType ) {
                                 case LGM_OPEN_IMF:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_IMF" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_IMF" ); // FL Type
                                                     break;
                                 case LGM_CLOSED:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_CLOSED" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_CLOSED" ); // FL Type
                                                     break;
                                 case LGM_OPEN_N_LOBE:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_N_LOBE" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_N_LOBE" ); // FL Type
                                                     break;
                                 case LGM_OPEN_S_LOBE:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_OPEN_S_LOBE" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_OPEN_S_LOBE" ); // FL Type
                                                     break;
                                 case LGM_INSIDE_EARTH:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_INSIDE_EARTH" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_INSIDE_EARTH" ); // FL Type
                                                     break;
                                 case LGM_TARGET_HEIGHT_UNREACHABLE:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
                                                     break;
                                 default:
-                                                    sprintf( med->H5_FieldLineType[ med->H5_nT ], "%s",  "UNKNOWN FIELD TYPE" ); // FL Type
+                                                    sprintf( med->H5_FieldLineType[ iBuf ], "%s",  "UNKNOWN FIELD TYPE" ); // FL Type
                                                     break;
                             }
-                            med->H5_Date[ med->H5_nT ]           = UTC.Date;
-                            med->H5_Doy[ med->H5_nT ]            = UTC.Doy;
-                            med->H5_UTC[ med->H5_nT ]            = UTC.Time;
-                            med->H5_JD[ med->H5_nT ]             = UTC.JD;
-                            med->H5_InOut[ med->H5_nT ]          = MagEphemInfo->InOut;
-                            med->H5_OrbitNumber[ med->H5_nT ]    = MagEphemInfo->OrbitNumber;
-                            med->H5_GpsTime[ med->H5_nT ]        = Lgm_UTC_to_GpsSeconds( &UTC, c );
-                            med->H5_TiltAngle[ med->H5_nT ]      = c->psi*DegPerRad;
-
-                            med->H5_Rgsm[ med->H5_nT ][0]        = Rgsm.x;
-                            med->H5_Rgsm[ med->H5_nT ][1]        = Rgsm.y;
-                            med->H5_Rgsm[ med->H5_nT ][2]        = Rgsm.z;
+                            med->H5_Date[ iBuf ]           = UTC.Date;
+                            med->H5_Doy[ iBuf ]            = UTC.Doy;
+                            med->H5_UTC[ iBuf ]            = UTC.Time;
+                            med->H5_JD[ iBuf ]             = UTC.JD;
+                            med->H5_InOut[ iBuf ]          = MagEphemInfo->InOut;
+                            med->H5_OrbitNumber[ iBuf ]    = MagEphemInfo->OrbitNumber;
+                            med->H5_Interpolated[ iBuf ]   = ( KnotResult == LGM_MEK_INTERPOLATED );
+                            med->H5_GpsTime[ iBuf ]        = Lgm_UTC_to_GpsSeconds( &UTC, c );
+                            med->H5_TiltAngle[ iBuf ]      = c->psi*DegPerRad;
+
+                            med->H5_Rgsm[ iBuf ][0]        = Rgsm.x;
+                            med->H5_Rgsm[ iBuf ][1]        = Rgsm.y;
+                            med->H5_Rgsm[ iBuf ][2]        = Rgsm.z;
 
                             Lgm_Set_Coord_Transforms( UTC.Date, UTC.Time, c );
-                            Lgm_Convert_Coords( &Rgsm, &Rgeo, GSM_TO_GEO, c );      Lgm_VecToArr( &Rgeo, &med->H5_Rgeo[ med->H5_nT ][0] );
-                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_SM, c );       Lgm_VecToArr( &W,    &med->H5_Rsm[ med->H5_nT ][0] );
-                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GEI2000, c );  Lgm_VecToArr( &W,    &med->H5_Rgei[ med->H5_nT ][0] );
-                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GSE, c );      Lgm_VecToArr( &W,    &med->H5_Rgse[ med->H5_nT ][0] );
+                            Lgm_Convert_Coords( &Rgsm, &Rgeo, GSM_TO_GEO, c );      Lgm_VecToArr( &Rgeo, &med->H5_Rgeo[ iBuf ][0] );
+                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_SM, c );       Lgm_VecToArr( &W,    &med->H5_Rsm[ iBuf ][0] );
+                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GEI2000, c );  Lgm_VecToArr( &W,    &med->H5_Rgei[ iBuf ][0] );
+                            Lgm_Convert_Coords( &Rgsm, &W,    GSM_TO_GSE, c );      Lgm_VecToArr( &W,    &med->H5_Rgse[ iBuf ][0] );
 
                             Lgm_WGS84_to_GEOD( &Rgeo, &GeodLat, &GeodLong, &GeodHeight );
-                            Lgm_SetArrElements3( &med->H5_Rgeod[ med->H5_nT ][0],        GeodLat, GeodLong, GeodHeight );
-                            Lgm_SetArrElements2( &med->H5_Rgeod_LatLon[ med->H5_nT ][0], GeodLat, GeodLong );
-                            med->H5_Rgeod_Height[ med->H5_nT ] = GeodHeight;
+                            Lgm_SetArrElements3( &med->H5_Rgeod[ iBuf ][0],        GeodLat, GeodLong, GeodHeight );
+                            Lgm_SetArrElements2( &med->H5_Rgeod_LatLon[ iBuf ][0], GeodLat, GeodLong );
+                            med->H5_Rgeod_Height[ iBuf ] = GeodHeight;
 
                             Lgm_Convert_Coords( &Rgsm, &W, GSM_TO_CDMAG, c );
                             Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            med->H5_CDMAG_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_CDMAG_MLON[ med->H5_nT ] = MLON;
-                            med->H5_CDMAG_MLT[ med->H5_nT ]  = MLT;
-                            med->H5_CDMAG_R[ med->H5_nT ]    = R;
+                            med->H5_CDMAG_MLAT[ iBuf ] = MLAT;
+                            med->H5_CDMAG_MLON[ iBuf ] = MLON;
+                            med->H5_CDMAG_MLT[ iBuf ]  = MLT;
+                            med->H5_CDMAG_R[ iBuf ]    = R;
 
                             Lgm_Convert_Coords( &Rgsm, &W, GSM_TO_EDMAG, c );
                             Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                            med->H5_EDMAG_MLAT[ med->H5_nT ] = MLAT;
-                            med->H5_EDMAG_MLON[ med->H5_nT ] = MLON;
-                            med->H5_EDMAG_MLT[ med->H5_nT ]  = MLT;
-                            med->H5_EDMAG_R[ med->H5_nT ]    = R;
+                            med->H5_EDMAG_MLAT[ iBuf ] = MLAT;
+                            med->H5_EDMAG_MLON[ iBuf ] = MLON;
+                            med->H5_EDMAG_MLT[ iBuf ]  = MLT;
+                            med->H5_EDMAG_R[ iBuf ]    = R;
 
-                            med->H5_Kp[ med->H5_nT ]             = MagEphemInfo->LstarInfo->mInfo->fKp;
-                            med->H5_Dst[ med->H5_nT ]            = MagEphemInfo->LstarInfo->mInfo->Dst;
+                            med->H5_Kp[ iBuf ]             = MagEphemInfo->LstarInfo->mInfo->fKp;
+                            med->H5_Dst[ iBuf ]            = MagEphemInfo->LstarInfo->mInfo->Dst;
 
-                            med->H5_S_sc_to_pfn[ med->H5_nT ]    = (MagEphemInfo->Snorth > 0.0) ? MagEphemInfo->Snorth : LGM_FILL_VALUE;
-                            med->H5_S_sc_to_pfs[ med->H5_nT ]    = (MagEphemInfo->Ssouth > 0.0) ? MagEphemInfo->Ssouth : LGM_FILL_VALUE;
-                            med->H5_S_pfs_to_Bmin[ med->H5_nT ]  = (MagEphemInfo->Smin > 0.0) ? MagEphemInfo->Smin : LGM_FILL_VALUE;
-                            med->H5_S_Bmin_to_sc[ med->H5_nT ]   = ((MagEphemInfo->Ssouth>0.0)&&(MagEphemInfo->Smin > 0.0)) ? MagEphemInfo->Ssouth-MagEphemInfo->Smin : LGM_FILL_VALUE;
-                            med->H5_S_total[ med->H5_nT ]        = ((MagEphemInfo->Snorth > 0.0)&&(MagEphemInfo->Ssouth > 0.0)) ? MagEphemInfo->Snorth + MagEphemInfo->Ssouth : LGM_FILL_VALUE;
+                            med->H5_S_sc_to_pfn[ iBuf ]    = (MagEphemInfo->Snorth > 0.0) ? MagEphemInfo->Snorth : LGM_FILL_VALUE;
+                            med->H5_S_sc_to_pfs[ iBuf ]    = (MagEphemInfo->Ssouth > 0.0) ? MagEphemInfo->Ssouth : LGM_FILL_VALUE;
+                            med->H5_S_pfs_to_Bmin[ iBuf ]  = (MagEphemInfo->Smin > 0.0) ? MagEphemInfo->Smin : LGM_FILL_VALUE;
+                            med->H5_S_Bmin_to_sc[ iBuf ]   = ((MagEphemInfo->Ssouth>0.0)&&(MagEphemInfo->Smin > 0.0)) ? MagEphemInfo->Ssouth-MagEphemInfo->Smin : LGM_FILL_VALUE;
+                            med->H5_S_total[ iBuf ]        = ((MagEphemInfo->Snorth > 0.0)&&(MagEphemInfo->Ssouth > 0.0)) ? MagEphemInfo->Snorth + MagEphemInfo->Ssouth : LGM_FILL_VALUE;
 
-                            med->H5_d2B_ds2[ med->H5_nT ]        = MagEphemInfo->d2B_ds2;
-                            med->H5_Sb0[ med->H5_nT ]            = MagEphemInfo->Sb0;
-                            med->H5_RadiusOfCurv[ med->H5_nT ]   = MagEphemInfo->RofC;
+                            med->H5_d2B_ds2[ iBuf ]        = MagEphemInfo->d2B_ds2;
+                            med->H5_Sb0[ iBuf ]            = MagEphemInfo->Sb0;
+                            med->H5_RadiusOfCurv[ iBuf ]   = MagEphemInfo->RofC;
 
 
                             MagEphemInfo->LstarInfo->mInfo->Bfield( &Rgsm, &Bsc_gsm, MagEphemInfo->LstarInfo->mInfo );
-                            med->H5_Bsc_gsm[ med->H5_nT ][0] = Bsc_gsm.x;
-                            med->H5_Bsc_gsm[ med->H5_nT ][1] = Bsc_gsm.y;
-                            med->H5_Bsc_gsm[ med->H5_nT ][2] = Bsc_gsm.z;
-                            med->H5_Bsc_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bsc_gsm );
+                            med->H5_Bsc_gsm[ iBuf ][0] = Bsc_gsm.x;
+                            med->H5_Bsc_gsm[ iBuf ][1] = Bsc_gsm.y;
+                            med->H5_Bsc_gsm[ iBuf ][2] = Bsc_gsm.z;
+                            med->H5_Bsc_gsm[ iBuf ][3] = Lgm_Magnitude( &Bsc_gsm );
 
                             if ( MagEphemInfo->FieldLineType == LGM_CLOSED ) {
-                                med->H5_Pmin_gsm[ med->H5_nT ][0] = MagEphemInfo->Pmin.x;
-                                med->H5_Pmin_gsm[ med->H5_nT ][1] = MagEphemInfo->Pmin.y;
-                                med->H5_Pmin_gsm[ med->H5_nT ][2] = MagEphemInfo->Pmin.z;
+                                med->H5_Pmin_gsm[ iBuf ][0] = MagEphemInfo->Pmin.x;
+                                med->H5_Pmin_gsm[ iBuf ][1] = MagEphemInfo->Pmin.y;
+                                med->H5_Pmin_gsm[ iBuf ][2] = MagEphemInfo->Pmin.z;
 
                                 MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Pmin, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                                 Bmin_mag = Lgm_Magnitude( &Bvec );
-                                med->H5_Bmin_gsm[ med->H5_nT ][0] = Bvec.x;
-                                med->H5_Bmin_gsm[ med->H5_nT ][1] = Bvec.y;
-                                med->H5_Bmin_gsm[ med->H5_nT ][2] = Bvec.z;
-                                med->H5_Bmin_gsm[ med->H5_nT ][3] = Bmin_mag;
+                                med->H5_Bmin_gsm[ iBuf ][0] = Bvec.x;
+                                med->H5_Bmin_gsm[ iBuf ][1] = Bvec.y;
+                                med->H5_Bmin_gsm[ iBuf ][2] = Bvec.z;
+                                med->H5_Bmin_gsm[ iBuf ][3] = Bmin_mag;
 
                             } else {
-                                med->H5_Pmin_gsm[ med->H5_nT ][0] = LGM_FILL_VALUE ;
-                                med->H5_Pmin_gsm[ med->H5_nT ][1] = LGM_FILL_VALUE ;
-                                med->H5_Pmin_gsm[ med->H5_nT ][2] = LGM_FILL_VALUE ;
-
-                                med->H5_Bmin_gsm[ med->H5_nT ][0] = LGM_FILL_VALUE ;
-                                med->H5_Bmin_gsm[ med->H5_nT ][1] = LGM_FILL_VALUE ;
-                                med->H5_Bmin_gsm[ med->H5_nT ][2] = LGM_FILL_VALUE ;
-                                med->H5_Bmin_gsm[ med->H5_nT ][3] = LGM_FILL_VALUE ;
+                                med->H5_Pmin_gsm[ iBuf ][0] = LGM_FILL_VALUE ;
+                                med->H5_Pmin_gsm[ iBuf ][1] = LGM_FILL_VALUE ;
+                                med->H5_Pmin_gsm[ iBuf ][2] = LGM_FILL_VALUE ;
+
+                                med->H5_Bmin_gsm[ iBuf ][0] = LGM_FILL_VALUE ;
+                                med->H5_Bmin_gsm[ iBuf ][1] = LGM_FILL_VALUE ;
+                                med->H5_Bmin_gsm[ iBuf ][2] = LGM_FILL_VALUE ;
+                                med->H5_Bmin_gsm[ iBuf ][3] = LGM_FILL_VALUE ;
                                 Bmin_mag = LGM_FILL_VALUE;
                             }
 
 
                             for (i=0; i<nAlpha; i++){
-                                med->H5_Lstar[ med->H5_nT ][i]          = MagEphemInfo->Lstar[i];
-                                med->H5_DriftShellType[ med->H5_nT ][i] = MagEphemInfo->DriftOrbitType[i];
-                                med->H5_Sb[ med->H5_nT ][i]             = MagEphemInfo->Sb[i];
-                                med->H5_I[ med->H5_nT ][i]              = MagEphemInfo->I[i];
-                                med->H5_Bm[ med->H5_nT ][i]             = MagEphemInfo->Bm[i];
+                                med->H5_Lstar[ iBuf ][i]          = MagEphemInfo->Lstar[i];
+                                med->H5_DriftShellType[ iBuf ][i] = MagEphemInfo->DriftOrbitType[i];
+                                med->H5_Sb[ iBuf ][i]             = MagEphemInfo->Sb[i];
+                                med->H5_I[ iBuf ][i]              = MagEphemInfo->I[i];
+                                med->H5_Bm[ iBuf ][i]             = MagEphemInfo->Bm[i];
 
                                 Ek    = 1.0; // MeV
                                 E     = Ek + LGM_Ee0; // total energy, MeV
@@ -1692,78 +1974,78 @@ int tiii = 0;
                                 pp    = sqrt(p2c2)*1.60217646e-13/LGM_c;  // mks
                                 rg    = sin(MagEphemInfo->Alpha[i]*RadPerDeg)*pp/(LGM_e*Bmin_mag*1e-9); // m. Bmin_mag calced above
 
-                                med->H5_Tb[ med->H5_nT ][i]             = T;
-                                med->H5_Kappa[ med->H5_nT ][i]          = sqrt( MagEphemInfo->RofC*Re*1e3/rg );
+                                med->H5_Tb[ iBuf ][i]             = T;
+                                med->H5_Kappa[ iBuf ][i]          = sqrt( MagEphemInfo->RofC*Re*1e3/rg );
 
 
                                 if ( (MagEphemInfo->Bm[i]>0.0)&&(MagEphemInfo->I[i]>=0.0) ) {
-                                    med->H5_K[ med->H5_nT ][i] = 3.16227766e-3*MagEphemInfo->I[i]*sqrt(MagEphemInfo->Bm[i]);
+                                    med->H5_K[ iBuf ][i] = 3.16227766e-3*MagEphemInfo->I[i]*sqrt(MagEphemInfo->Bm[i]);
                                 } else {
-                                    med->H5_K[ med->H5_nT ][i] = LGM_FILL_VALUE;
+                                    med->H5_K[ iBuf ][i] = LGM_FILL_VALUE;
                                 }
                                 if (MagEphemInfo->I[i]>=0.0) {
-                                    med->H5_L[ med->H5_nT ][i] = LFromIBmM_McIlwain(MagEphemInfo->I[i], MagEphemInfo->Bm[i], MagEphemInfo->Mused );
+                                    med->H5_L[ iBuf ][i] = LFromIBmM_McIlwain(MagEphemInfo->I[i], MagEphemInfo->Bm[i], MagEphemInfo->Mused );
                                 } else {
-                                    med->H5_L[ med->H5_nT ][i] = LGM_FILL_VALUE;
+                                    med->H5_L[ iBuf ][i] = LGM_FILL_VALUE;
                                 }
                             }
 
                             /*
                              * Compute Lsimple
                              */
-                            med->H5_Lsimple[ med->H5_nT ] = ( Bmin_mag > 0.0) ? Lgm_Magnitude( &MagEphemInfo->Pmin ) : LGM_FILL_VALUE;
+                            med->H5_Lsimple[ iBuf ] = ( Bmin_mag > 0.0) ? Lgm_Magnitude( &MagEphemInfo->Pmin ) : LGM_FILL_VALUE;
 
                             /*
                              * Compute InvLat
                              */
-                            if (med->H5_Lsimple[ med->H5_nT ] > 0.0) {
-                                med->H5_InvLat[ med->H5_nT ] = DegPerRad*acos(sqrt(1.0/med->H5_Lsimple[ med->H5_nT ]));
+                            if (med->H5_Lsimple[ iBuf ] > 0.0) {
+                                med->H5_InvLat[ iBuf ] = DegPerRad*acos(sqrt(1.0/med->H5_Lsimple[ iBuf ]));
                             } else {
-                                med->H5_InvLat[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_InvLat[ iBuf ] = LGM_FILL_VALUE;
                             }
 
                             /*
                              * Compute Lm_eq
                              */
-                            med->H5_Lm_eq[ med->H5_nT ] = (Bmin_mag > 0.0) ? LFromIBmM_McIlwain( 0.0, Bmin_mag, MagEphemInfo->Mcurr ) : LGM_FILL_VALUE;
+                            med->H5_Lm_eq[ iBuf ] = (Bmin_mag > 0.0) ? LFromIBmM_McIlwain( 0.0, Bmin_mag, MagEphemInfo->Mcurr ) : LGM_FILL_VALUE;
 
                             /*
                              * Compute InvLat_eq
                              */
-                            if (med->H5_Lm_eq[ med->H5_nT ] > 0.0) {
-                                med->H5_InvLat_eq[ med->H5_nT ] = DegPerRad*acos(sqrt(1.0/med->H5_Lm_eq[ med->H5_nT ]));
+                            if (med->H5_Lm_eq[ iBuf ] > 0.0) {
+                                med->H5_InvLat_eq[ iBuf ] = DegPerRad*acos(sqrt(1.0/med->H5_Lm_eq[ iBuf ]));
                             } else {
-                                med->H5_InvLat_eq[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_InvLat_eq[ iBuf ] = LGM_FILL_VALUE;
                             }
 
                             /*
                              * Compute BoverBeq
                              */
                             Bsc_mag = Lgm_Magnitude( &Bsc_gsm );
-                            med->H5_BoverBeq[ med->H5_nT ] = ( Bmin_mag > 0.0) ? Bsc_mag / Bmin_mag : LGM_FILL_VALUE;
+                            med->H5_BoverBeq[ iBuf ] = ( Bmin_mag > 0.0) ? Bsc_mag / Bmin_mag : LGM_FILL_VALUE;
 
                             /*
                              * Compute MlatFromBoverBeq
                              */
-                            if ( med->H5_BoverBeq[ med->H5_nT ] > 0.0 ) {
-                                s = sqrt( 1.0/med->H5_BoverBeq[ med->H5_nT ] );
+                            if ( med->H5_BoverBeq[ iBuf ] > 0.0 ) {
+                                s = sqrt( 1.0/med->H5_BoverBeq[ iBuf ] );
                                 cl = Lgm_CdipMirrorLat( s );
                                 if ( fabs(cl) <= 1.0 ){
-                                    med->H5_MlatFromBoverBeq[ med->H5_nT ] = DegPerRad*acos( cl );
-                                    if (med->H5_S_Bmin_to_sc[ med->H5_nT ]<0.0) med->H5_MlatFromBoverBeq[ med->H5_nT ] *= -1.0;
+                                    med->H5_MlatFromBoverBeq[ iBuf ] = DegPerRad*acos( cl );
+                                    if (med->H5_S_Bmin_to_sc[ iBuf ]<0.0) med->H5_MlatFromBoverBeq[ iBuf ] *= -1.0;
                                 } else {
-                                    med->H5_MlatFromBoverBeq[ med->H5_nT ] = LGM_FILL_VALUE;
+                                    med->H5_MlatFromBoverBeq[ iBuf ] = LGM_FILL_VALUE;
                                 }
                             } else {
-                                med->H5_MlatFromBoverBeq[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_MlatFromBoverBeq[ iBuf ] = LGM_FILL_VALUE;
                             }
 
                             /*
                              * Save M values
                              */
-                            med->H5_M_used[ med->H5_nT ] = MagEphemInfo->Mused;
-                            med->H5_M_ref[ med->H5_nT ]  = MagEphemInfo->Mref;
-                            med->H5_M_igrf[ med->H5_nT ] = MagEphemInfo->Mcurr;
+                            med->H5_M_used[ iBuf ] = MagEphemInfo->Mused;
+                            med->H5_M_ref[ iBuf ]  = MagEphemInfo->Mref;
+                            med->H5_M_igrf[ iBuf ] = MagEphemInfo->Mcurr;
 
 
 
@@ -1775,29 +2057,29 @@ int tiii = 0;
                                 /*
                                  * Save northern Footpoint position in different coord systems.
                                  */
-                                Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Pn, med->H5_Pfn_gsm[ med->H5_nT ] );
+                                Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Pn, med->H5_Pfn_gsm[ iBuf ] );
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_GEO, c );
-                                Lgm_VecToArr( &W, med->H5_Pfn_geo[ med->H5_nT ] );
+                                Lgm_VecToArr( &W, med->H5_Pfn_geo[ iBuf ] );
 
                                 Lgm_WGS84_to_GEOD( &W, &GeodLat, &GeodLong, &GeodHeight );
-                                Lgm_SetArrElements3( med->H5_Pfn_geod[ med->H5_nT ],        GeodLat, GeodLong, GeodHeight );
-                                Lgm_SetArrElements2( med->H5_Pfn_geod_LatLon[ med->H5_nT ], GeodLat, GeodLong );
-                                med->H5_Pfn_geod_Height[ med->H5_nT ]    = GeodHeight;
+                                Lgm_SetArrElements3( med->H5_Pfn_geod[ iBuf ],        GeodLat, GeodLong, GeodHeight );
+                                Lgm_SetArrElements2( med->H5_Pfn_geod_LatLon[ iBuf ], GeodLat, GeodLong );
+                                med->H5_Pfn_geod_Height[ iBuf ]    = GeodHeight;
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_CDMAG, c );
                                 Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                                Lgm_SetArrElements3( med->H5_Pfn_cdmag[ med->H5_nT ], MLAT, MLON, MLT );
-                                med->H5_Pfn_CD_MLAT[ med->H5_nT ] = MLAT;
-                                med->H5_Pfn_CD_MLON[ med->H5_nT ] = MLON;
-                                med->H5_Pfn_CD_MLT[ med->H5_nT ]  = MLT;
+                                Lgm_SetArrElements3( med->H5_Pfn_cdmag[ iBuf ], MLAT, MLON, MLT );
+                                med->H5_Pfn_CD_MLAT[ iBuf ] = MLAT;
+                                med->H5_Pfn_CD_MLON[ iBuf ] = MLON;
+                                med->H5_Pfn_CD_MLT[ iBuf ]  = MLT;
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Pn, &W, GSM_TO_EDMAG, c );
                                 Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                                Lgm_SetArrElements3( med->H5_Pfn_edmag[ med->H5_nT ], MLAT, MLON, MLT );
-                                med->H5_Pfn_ED_MLAT[ med->H5_nT ] = MLAT;
-                                med->H5_Pfn_ED_MLON[ med->H5_nT ] = MLON;
-                                med->H5_Pfn_ED_MLT[ med->H5_nT ]  = MLT;
+                                Lgm_SetArrElements3( med->H5_Pfn_edmag[ iBuf ], MLAT, MLON, MLT );
+                                med->H5_Pfn_ED_MLAT[ iBuf ] = MLAT;
+                                med->H5_Pfn_ED_MLON[ iBuf ] = MLON;
+                                med->H5_Pfn_ED_MLT[ iBuf ]  = MLT;
 
 
 
@@ -1806,40 +2088,40 @@ int tiii = 0;
                                  */
                                 MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Ellipsoid_Footprint_Pn, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                                 Lgm_Convert_Coords( &Bvec, &Bvec2, GSM_TO_WGS84, c );
-                                Lgm_VecToArr( &Bvec,  &med->H5_Bfn_gsm[ med->H5_nT ][0] ); med->H5_Bfn_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec  );
-                                Lgm_VecToArr( &Bvec2, &med->H5_Bfn_geo[ med->H5_nT ][0] ); med->H5_Bfn_geo[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec2 );
+                                Lgm_VecToArr( &Bvec,  &med->H5_Bfn_gsm[ iBuf ][0] ); med->H5_Bfn_gsm[ iBuf ][3] = Lgm_Magnitude( &Bvec  );
+                                Lgm_VecToArr( &Bvec2, &med->H5_Bfn_geo[ iBuf ][0] ); med->H5_Bfn_geo[ iBuf ][3] = Lgm_Magnitude( &Bvec2 );
 
 
                                 /*
                                  * Save northern loss cone.
                                  */
                                 Bfn_mag = Lgm_Magnitude( &Bvec );
-                                med->H5_LossConeAngleN[ med->H5_nT ] = asin( sqrt( Bsc_mag/Bfn_mag ) )*DegPerRad;
+                                med->H5_LossConeAngleN[ iBuf ] = asin( sqrt( Bsc_mag/Bfn_mag ) )*DegPerRad;
 
 
 
                             } else {
 
-                                Lgm_SetArrVal3( med->H5_Pfn_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfn_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfn_geod[ med->H5_nT ],         LGM_FILL_VALUE );
-                                Lgm_SetArrVal2( med->H5_Pfn_geod_LatLon[ med->H5_nT ],   LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfn_gsm[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfn_geo[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfn_geod[ iBuf ],         LGM_FILL_VALUE );
+                                Lgm_SetArrVal2( med->H5_Pfn_geod_LatLon[ iBuf ],   LGM_FILL_VALUE );
 
-                                med->H5_Pfn_geod_Height[ med->H5_nT ]  = LGM_FILL_VALUE;
-                                med->H5_Pfn_CD_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfn_CD_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfn_CD_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
-                                med->H5_Pfn_ED_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfn_ED_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfn_ED_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
+                                med->H5_Pfn_geod_Height[ iBuf ]  = LGM_FILL_VALUE;
+                                med->H5_Pfn_CD_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfn_CD_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfn_CD_MLT[ iBuf ]       = LGM_FILL_VALUE;
+                                med->H5_Pfn_ED_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfn_ED_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfn_ED_MLT[ iBuf ]       = LGM_FILL_VALUE;
 
-                                Lgm_SetArrVal3( med->H5_Pfn_cdmag[ med->H5_nT ],        LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfn_edmag[ med->H5_nT ],        LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfn_cdmag[ iBuf ],        LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfn_edmag[ iBuf ],        LGM_FILL_VALUE );
 
-                                Lgm_SetArrVal4( med->H5_Bfn_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal4( med->H5_Bfn_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal4( med->H5_Bfn_geo[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal4( med->H5_Bfn_gsm[ iBuf ],          LGM_FILL_VALUE );
 
-                                med->H5_LossConeAngleN[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_LossConeAngleN[ iBuf ] = LGM_FILL_VALUE;
 
                             }
 
@@ -1848,29 +2130,29 @@ int tiii = 0;
                                 /*
                                  * Save southern Footpoint position in different coord systems.
                                  */
-                                Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Ps, med->H5_Pfs_gsm[ med->H5_nT ] );
+                                Lgm_VecToArr( &MagEphemInfo->Ellipsoid_Footprint_Ps, med->H5_Pfs_gsm[ iBuf ] );
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_GEO, c );
-                                Lgm_VecToArr( &W, med->H5_Pfs_geo[ med->H5_nT ] );
+                                Lgm_VecToArr( &W, med->H5_Pfs_geo[ iBuf ] );
 
                                 Lgm_WGS84_to_GEOD( &W, &GeodLat, &GeodLong, &GeodHeight );
-                                Lgm_SetArrElements3( med->H5_Pfs_geod[ med->H5_nT ],        GeodLat, GeodLong, GeodHeight );
-                                Lgm_SetArrElements2( med->H5_Pfs_geod_LatLon[ med->H5_nT ], GeodLat, GeodLong );
-                                med->H5_Pfs_geod_Height[ med->H5_nT ]    = GeodHeight;
+                                Lgm_SetArrElements3( med->H5_Pfs_geod[ iBuf ],        GeodLat, GeodLong, GeodHeight );
+                                Lgm_SetArrElements2( med->H5_Pfs_geod_LatLon[ iBuf ], GeodLat, GeodLong );
+                                med->H5_Pfs_geod_Height[ iBuf ]    = GeodHeight;
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_CDMAG, c );
                                 Lgm_CDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                                Lgm_SetArrElements3( med->H5_Pfs_cdmag[ med->H5_nT ], MLAT, MLON, MLT );
-                                med->H5_Pfs_CD_MLAT[ med->H5_nT ] = MLAT;
-                                med->H5_Pfs_CD_MLON[ med->H5_nT ] = MLON;
-                                med->H5_Pfs_CD_MLT[ med->H5_nT ]  = MLT;
+                                Lgm_SetArrElements3( med->H5_Pfs_cdmag[ iBuf ], MLAT, MLON, MLT );
+                                med->H5_Pfs_CD_MLAT[ iBuf ] = MLAT;
+                                med->H5_Pfs_CD_MLON[ iBuf ] = MLON;
+                                med->H5_Pfs_CD_MLT[ iBuf ]  = MLT;
 
                                 Lgm_Convert_Coords( &MagEphemInfo->Ellipsoid_Footprint_Ps, &W, GSM_TO_EDMAG, c );
                                 Lgm_EDMAG_to_R_MLAT_MLON_MLT( &W, &R, &MLAT, &MLON, &MLT, c );
-                                Lgm_SetArrElements3( med->H5_Pfs_edmag[ med->H5_nT ], MLAT, MLON, MLT );
-                                med->H5_Pfs_ED_MLAT[ med->H5_nT ] = MLAT;
-                                med->H5_Pfs_ED_MLON[ med->H5_nT ] = MLON;
-                                med->H5_Pfs_ED_MLT[ med->H5_nT ]  = MLT;
+                                Lgm_SetArrElements3( med->H5_Pfs_edmag[ iBuf ], MLAT, MLON, MLT );
+                                med->H5_Pfs_ED_MLAT[ iBuf ] = MLAT;
+                                med->H5_Pfs_ED_MLON[ iBuf ] = MLON;
+                                med->H5_Pfs_ED_MLT[ iBuf ]  = MLT;
 
 
 
@@ -1879,56 +2161,85 @@ int tiii = 0;
                                  */
                                 MagEphemInfo->LstarInfo->mInfo->Bfield( &MagEphemInfo->Ellipsoid_Footprint_Ps, &Bvec, MagEphemInfo->LstarInfo->mInfo );
                                 Lgm_Convert_Coords( &Bvec, &Bvec2, GSM_TO_WGS84, c );
-                                Lgm_VecToArr( &Bvec,  &med->H5_Bfs_gsm[ med->H5_nT ][0] ); med->H5_Bfs_gsm[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec  );
-                                Lgm_VecToArr( &Bvec2, &med->H5_Bfs_geo[ med->H5_nT ][0] ); med->H5_Bfs_geo[ med->H5_nT ][3] = Lgm_Magnitude( &Bvec2 );
+                                Lgm_VecToArr( &Bvec,  &med->H5_Bfs_gsm[ iBuf ][0] ); med->H5_Bfs_gsm[ iBuf ][3] = Lgm_Magnitude( &Bvec  );
+                                Lgm_VecToArr( &Bvec2, &med->H5_Bfs_geo[ iBuf ][0] ); med->H5_Bfs_geo[ iBuf ][3] = Lgm_Magnitude( &Bvec2 );
 
 
                                 /*
                                  * Save southern loss cone.
                                  */
                                 Bfs_mag = Lgm_Magnitude( &Bvec );
-                                med->H5_LossConeAngleS[ med->H5_nT ] = asin( sqrt( Bsc_mag/Bfs_mag ) )*DegPerRad;
+                                med->H5_LossConeAngleS[ iBuf ] = asin( sqrt( Bsc_mag/Bfs_mag ) )*DegPerRad;
 
 
 
                             } else {
 
-                                Lgm_SetArrVal3( med->H5_Pfs_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfs_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfs_geod[ med->H5_nT ],         LGM_FILL_VALUE );
-                                Lgm_SetArrVal2( med->H5_Pfs_geod_LatLon[ med->H5_nT ],   LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfs_gsm[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfs_geo[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfs_geod[ iBuf ],         LGM_FILL_VALUE );
+                                Lgm_SetArrVal2( med->H5_Pfs_geod_LatLon[ iBuf ],   LGM_FILL_VALUE );
 
-                                med->H5_Pfs_geod_Height[ med->H5_nT ]  = LGM_FILL_VALUE;
-                                med->H5_Pfs_CD_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfs_CD_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfs_CD_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
-                                med->H5_Pfs_ED_MLAT[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfs_ED_MLON[ med->H5_nT ]      = LGM_FILL_VALUE;
-                                med->H5_Pfs_ED_MLT[ med->H5_nT ]       = LGM_FILL_VALUE;
+                                med->H5_Pfs_geod_Height[ iBuf ]  = LGM_FILL_VALUE;
+                                med->H5_Pfs_CD_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfs_CD_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfs_CD_MLT[ iBuf ]       = LGM_FILL_VALUE;
+                                med->H5_Pfs_ED_MLAT[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfs_ED_MLON[ iBuf ]      = LGM_FILL_VALUE;
+                                med->H5_Pfs_ED_MLT[ iBuf ]       = LGM_FILL_VALUE;
 
-                                Lgm_SetArrVal3( med->H5_Pfs_cdmag[ med->H5_nT ],        LGM_FILL_VALUE );
-                                Lgm_SetArrVal3( med->H5_Pfs_edmag[ med->H5_nT ],        LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfs_cdmag[ iBuf ],        LGM_FILL_VALUE );
+                                Lgm_SetArrVal3( med->H5_Pfs_edmag[ iBuf ],        LGM_FILL_VALUE );
 
-                                Lgm_SetArrVal4( med->H5_Bfs_geo[ med->H5_nT ],          LGM_FILL_VALUE );
-                                Lgm_SetArrVal4( med->H5_Bfs_gsm[ med->H5_nT ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal4( med->H5_Bfs_geo[ iBuf ],          LGM_FILL_VALUE );
+                                Lgm_SetArrVal4( med->H5_Bfs_gsm[ iBuf ],          LGM_FILL_VALUE );
 
-                                med->H5_LossConeAngleS[ med->H5_nT ] = LGM_FILL_VALUE;
+                                med->H5_LossConeAngleS[ iBuf ] = LGM_FILL_VALUE;
 
                             }
 
 
 
+                            /*
+                             * Hand the row to the writers, in time order.
+                             */
+                            #pragma omp ordered
+                            {
+
+                            /*
+                             * Write a row of data into the txt file.
+                             */
+                            Lgm_WriteMagEphemData( TxtSink->fp, IntModel, ExtModel, MagEphemInfo->LstarInfo->mInfo->fKp, MagEphemInfo->LstarInfo->mInfo->Dst, MagEphemInfo );
+
+                            if ( DumpShellFiles && (nAlpha > 0) ){
+
+                                sprintf( ShellFile, "%s_%ld.dat", OutFile, Seconds );
+                                printf( "Writing Full Shell File: %s\n", ShellFile );
+                                WriteMagEphemInfoStruct( ShellFile, nAlpha, MagEphemInfo );
+                            }
+
                             /*
                              * Open existing HDF5 file in read/write mode.
                              * Write a row of data into the hdf5 file
                              */
 // The nOff
                             file = H5Fopen( HdfOutFile,  H5F_ACC_RDWR, H5P_DEFAULT );
-                            nOffset = ( Update ) ? nExisting_H5_IsoTimes : 0;
-                            Lgm_WriteMagEphemDataHdf( file, med->H5_nT + nOffset, med->H5_nT, med );
+                            nOffset = ( Update ) ? nExisting_H5_IsoTimes : nResume;
+                            Lgm_WriteMagEphemDataHdf( file, med->H5_nT + nOffset, iBuf, med );
                             H5Fclose( file );
+
+                            /*
+                             * The rows up to this one are on disk once the
+                             * hdf5 writer has flushed them. Checkpoint.
+                             */
+                            if ( !Update && ( med->H5_nBuffered == 0 ) ) {
+                                Checkpoint_Write( med->H5_nT + nOffset + 1, Lgm_Sink_Flush( TxtSink ), IsoTimeString, &Ckpt );
+                            }
+                            if ( ColFile ) Lgm_WriteMagEphemDataCol( ColFile, med->H5_nT, iBuf, med );
                             ++(med->H5_nT);
 
+                            }
+
                             // end if Update loop
 
                         } 
@@ -1936,11 +2247,38 @@ int tiii = 0;
 
                     }
 
+                    #ifdef _OPENMP
+                    if ( Lgm_MemoryReportMode() ) {
+                        size_t b = Lgm_CTrans_MemoryUsage( c ) + Lgm_MagEphemInfo_MemoryUsage( MagEphemInfo );
+                        #pragma omp critical (MemoryUsage)
+                        if ( b > ThreadBytes ) ThreadBytes = b;
+                    }
+                    Lgm_free_ctrans( c );
+                    Lgm_FreeMagEphemInfo( MagEphemInfo );
+                    free( sgp );
+                    #endif
+                    }
+
+                    Lgm_FreeMagEphemKnots( Knots );
+                    Lgm_Sink_Close( TxtSink );
+
+                    /*
+                     * Write out the rows still held in med.
+                     */
+                    file = H5Fopen( HdfOutFile,  H5F_ACC_RDWR, H5P_DEFAULT );
+                    Lgm_FlushMagEphemDataHdf( file, med );
+                    H5Fclose( file );
+                    if ( !Update ) Checkpoint_Remove( &Ckpt );
+                    if ( ColFile ) {
+                        Lgm_CloseMagEphemColWriter( ColFile, med );
+                        ColFile = NULL;
+                    }
+
 
                     printf("DONE.\n");
                     Lgm_PrintElapsedTime( &t );
                     Lgm_SetElapsedTimeStr( &t );
-                    sprintf( Command, "sed -i '/ELAPSED_TIME/s++%s+g' %s", t.ElapsedTimeStr, OutFile); system( Command );
+                    if ( !Gzip ) { sprintf( Command, "sed -i '/ELAPSED_TIME/s++%s+g' %s", t.ElapsedTimeStr, OutFile); system( Command ); }
 
 // PROBLEM AREA?
 //sprintf( Command, "sed -i '/SPICE_KERNEL_FILES_LOADED/s++%s+' %s", SpiceKernelFilesLoaded, OutFile); system( Command );
@@ -1982,10 +2320,31 @@ int tiii = 0;
     free( ShellFile );
     free( OutFile );
     free( HdfOutFile );
+    free( ColOutFile );
     free( InFile );
+    free( NextInFile );
+
+    /*
+     * With LGM_MEMORY_REPORT set, say what the run held onto. Each thread had
+     * its own CTrans and MagEphemInfo (the largest of these is reported).
+     */
+    if ( Lgm_MemoryReportMode() ) {
+        Lgm_MemoryReport_Init( &MemReport );
+        Lgm_MemoryReport_Add( "CTrans",       Lgm_CTrans_MemoryUsage( c ),                  &MemReport );
+        Lgm_MemoryReport_Add( "MagEphemInfo", Lgm_MagEphemInfo_MemoryUsage( MagEphemInfo ), &MemReport );
+        Lgm_MemoryReport_Add( "MagEphemData", Lgm_MagEphemData_MemoryUsage( med ),          &MemReport );
+        if ( ThreadBytes > 0 ) {
+            for ( i=0; i<nThreads; i++ ) Lgm_MemoryReport_Add( "Per thread copies", ThreadBytes, &MemReport );
+        }
+        Lgm_MemoryReport_Write( &MemReport );
+    }
 
+    if ( ResultsCache != NULL ) {
+        if ( Verbosity > 0 ) printf( "Results cache: %ld pitch angles found, %ld computed, %ld times with nothing to compute\n", ResultsCache->nHits, ResultsCache->nMisses, ResultsCache->nEpochHits );
+        Lgm_CloseResultsCache( ResultsCache );
+    }
     Lgm_free_ctrans( c );
-    Lgm_destroy_eop( e );
+    Lgm_FreePrefetcher( Prefetcher );
     Lgm_FreeMagEphemInfo( MagEphemInfo );
     Lgm_FreeMagEphemData( med );
 
@@ -1999,6 +2358,8 @@ int tiii = 0;
     LGM_ARRAY_1D_FREE( Ascend_U );
     LGM_ARRAY_1D_FREE( ApoPeriTimeList );
 
+    MagEphemWork_Finalize( &Work );
+
 
 
     return(0);
@@ -0,0 +1,468 @@
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <argp.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <Lgm_CTrans.h>
+#include <Lgm_MagModelInfo.h>
+#include <Lgm_LstarInfo.h>
+#include <Lgm_MagEphemInfo.h>
+#include <Lgm_QinDenton.h>
+#include "MagEphemServer.h"
+
+#define T89Q_KP  2.0
+#define OP77Q_KP 2.0
+
+/*
+ *  A long running nowcast server. The models, the Qin-Denton inputs and a
+ *  pool of MagEphemInfo structures (one per time in a chunk, each with its
+ *  own LstarInfo) are set up once at startup and then kept, so that a query
+ *  only pays for the field line tracing -- not for re-reading the inputs or
+ *  re-allocating everything as a fresh run of MagEphemFromTLE would. Queries
+ *  (see MagEphemServer.h for the wire format) come in over a Unix socket or
+ *  a TCP port (bound to localhost only). Connections are served one after
+ *  the other, and each may send any number of requests. The points of a
+ *  request are done in chunks with Lgm_ComputeLstarVersusPA_Multi(), which
+ *  spreads the (time, pitch angle) pairs over all of the threads.
+ */
+
+const  char *ProgramName = "MagEphemServer";
+const  char *argp_program_version     = "MagEphemServer_0.1";
+const  char *argp_program_bug_address = "<mgh@lanl.gov>";
+static char doc[] = "\nServes B, footpoints and L* for batches of (time, position, pitch angle) queries."
+                    " The models and input data are loaded once and kept in memory. Listens on a Unix socket"
+                    " (--Socket) or on a TCP port on localhost (--Port). See MagEphemServer.h for the protocol.\n\n";
+
+// Mandatory arguments
+#define     nArgs   0
+static char ArgsDoc[] = "";
+
+/*
+ *   Description of options accepted. The fields are as follows;
+ *
+ *   { NAME, KEY, ARG, FLAGS, DOC } where each of these have the following
+ *   meaning;
+ *      NAME - Name of option's long argument (can be zero).
+ *       KEY - Character used as key for the parser and it's short name.
+ *       ARG - Name of the option's argument (zero if there isnt one).
+ *     FLAGS - OPTION_ARG_OPTIONAL, OPTION_ALIAS, OPTION_HIDDEN, OPTION_DOC,
+ *             or OPTION_NO_USAGE
+ */
+static struct argp_option Options[] = {
+    {"IntModel",        'i',    "model",                0,      "Internal Magnetic Field Model to use. Can be CDIP, EDIP, IGRF. Default is IGRF." },
+    {"ExtModel",        'e',    "model",                0,      "External Magnetic Field Model to use. Can be OP77Q, T87Q, T89Q, T89D, T96, T02, T01S, TS04D. Default is T89D." },
+    {"Quality",         'q',    "quality",              0,      "Quality to use for L* calculations. Default is 3." },
+    {"nFLsInDriftShell",'n',    "nFLsInDriftShell",     0,      "Number of Field Lines to use in construction of drift shell. Use values in the range [6,240]. Default is 24." },
+    {"FootPointHeight", 'f',    "height",               0,      "Footpoint height in km. Default is 100km." },
+    {"Socket",          'S',    "path",                 0,      "Listen on a Unix socket at path." },
+    {"Port",            'p',    "port",                 0,      "Listen on this TCP port on localhost." },
+    {"Preload",         'l',    "\"yyyymmdd, yyyymmdd\"", 0,    "Load the Qin-Denton inputs for this range of dates at startup." },
+    {"Chunk",           'c',    "nTimes",               0,      "Number of times to compute together. Default is 4 per thread." },
+    {"verbose",         'v',    "verbosity",            0,      "Produce verbose output" },
+    { 0 }
+};
+
+struct Arguments {
+    char        *args[ 1 ];
+    int         Verbosity;
+    int         Quality;
+    int         nFLsInDriftShell;
+    double      FootPointHeight;
+    char        IntModel[80];
+    char        ExtModel[80];
+    char        Socket[108];
+    int         Port;
+    long int    PreloadStart;
+    long int    PreloadEnd;
+    int         nChunk;
+};
+
+/* Parse a single option. */
+static error_t parse_opt( int key, char *arg, struct argp_state *state ) {
+
+    struct Arguments *arguments = state->input;
+
+    switch( key ) {
+        case 'i':
+            strncpy( arguments->IntModel, arg, 79 );
+            break;
+        case 'e':
+            strncpy( arguments->ExtModel, arg, 79 );
+            break;
+        case 'q':
+            arguments->Quality = atoi( arg );
+            break;
+        case 'n':
+            arguments->nFLsInDriftShell = atoi( arg );
+            break;
+        case 'f':
+            sscanf( arg, "%lf", &arguments->FootPointHeight );
+            break;
+        case 'S':
+            strncpy( arguments->Socket, arg, 107 );
+            break;
+        case 'p':
+            arguments->Port = atoi( arg );
+            break;
+        case 'l':
+            sscanf( arg, "%ld, %ld", &arguments->PreloadStart, &arguments->PreloadEnd );
+            break;
+        case 'c':
+            arguments->nChunk = atoi( arg );
+            break;
+        case 'v':
+            arguments->Verbosity = atoi( arg );
+            break;
+        case ARGP_KEY_ARG:
+            argp_usage( state );
+            break;
+        case ARGP_KEY_END:
+            if ( ( arguments->Socket[0] == '\0' ) && ( arguments->Port <= 0 ) ) argp_error( state, "one of --Socket or --Port is needed" );
+            break;
+        default:
+            return( ARGP_ERR_UNKNOWN );
+    }
+    return( 0 );
+}
+
+/* Our argp parser. */
+static struct argp argp = { Options, parse_opt, ArgsDoc, doc };
+
+
+static volatile sig_atomic_t Done = 0;
+static void HandleSignal( int sig ) { (void)sig; Done = 1; }
+
+
+/*
+ *  read()/write() exactly n bytes. Return FALSE on EOF or error.
+ */
+static int ReadAll( int fd, void *Buf, size_t n ) {
+    char    *p = (char *)Buf;
+    ssize_t r;
+    while ( n > 0 ) {
+        r = read( fd, p, n );
+        if ( r < 0 && errno == EINTR && !Done ) continue;
+        if ( r <= 0 ) return( FALSE );
+        p += r; n -= r;
+    }
+    return( TRUE );
+}
+
+static int WriteAll( int fd, const void *Buf, size_t n ) {
+    const char  *p = (const char *)Buf;
+    ssize_t     r;
+    while ( n > 0 ) {
+        r = write( fd, p, n );
+        if ( r < 0 && errno == EINTR ) continue;
+        if ( r <= 0 ) return( FALSE );
+        p += r; n -= r;
+    }
+    return( TRUE );
+}
+
+static int SendStatus( int fd, int Status ) {
+    MagEphemServerReply h;
+    h.Magic = MAGEPHEM_SRV_REPLY_MAGIC; h.Status = Status; h.nPoints = 0; h.nValues = 0;
+    return( WriteAll( fd, &h, sizeof(h) ) );
+}
+
+
+/*
+ *  Everything that stays resident between queries.
+ */
+typedef struct ServerState {
+    int                 nChunk;
+    Lgm_MagEphemInfo    **MagEphemInfo;     // nChunk of them. [0] owns the LstarInfo pool.
+    long int            *Date;
+    double              *UTC;
+    Lgm_Vector          *u;
+    double              ForceKp;            // < 0 unless the model has a fixed Kp
+    int                 Verbosity;
+    long int            nQueries, nPoints;
+} ServerState;
+
+
+/*
+ *  Fills in v[] (nValues per point) for the n points in Pts[].
+ */
+static void DoChunk( int n, MagEphemServerPoint *Pts, int nAlpha, double *Alpha, int Outputs, int nValues, double *v, ServerState *s ) {
+
+    Lgm_MagEphemInfo    *mei;
+    Lgm_MagModelInfo    *m;
+    Lgm_QinDentonOne    p;
+    Lgm_Vector          B;
+    double              *vp;
+    int                 t, i, k, DoLstar;
+
+    DoLstar = ( Outputs & ( MAGEPHEM_SRV_FOOTPOINTS | MAGEPHEM_SRV_LSTAR ) ) ? TRUE : FALSE;
+
+    for ( t=0; t<n; t++ ) {
+        mei = s->MagEphemInfo[t];
+        m   = mei->LstarInfo->mInfo;
+
+        s->Date[t] = (long int)Pts[t].Date;
+        s->UTC[t]  = Pts[t].UTC;
+        s->u[t].x  = Pts[t].u[0]; s->u[t].y = Pts[t].u[1]; s->u[t].z = Pts[t].u[2];
+
+        // the Qin-Denton days stay in the process wide cache (see Lgm_QinDenton_Cache.c)
+        Lgm_Set_Coord_Transforms( s->Date[t], s->UTC[t], m->c );
+        Lgm_get_QinDenton_at_JD( m->c->UTC.JD, &p, (s->Verbosity > 1) ? 1 : 0, 1 );
+        Lgm_set_QinDenton( &p, m );
+        if ( s->ForceKp >= 0.0 ) {
+            m->fKp = s->ForceKp;
+            m->Kp  = (int)(s->ForceKp+0.5);
+        }
+
+        mei->nAlpha = nAlpha;
+        for ( i=0; i<nAlpha; i++ ) mei->Alpha[i] = Alpha[i];
+
+        vp = &v[ (size_t)t*nValues ];
+        if ( Outputs & MAGEPHEM_SRV_B ) {
+            m->Bfield( &s->u[t], &B, m );
+            *vp++ = B.x; *vp++ = B.y; *vp++ = B.z; *vp++ = Lgm_Magnitude( &B );
+        }
+    }
+
+    if ( DoLstar ) Lgm_ComputeLstarVersusPA_Multi( n, s->Date, s->UTC, s->u, nAlpha, Alpha, FALSE, s->MagEphemInfo );
+
+    for ( t=0; t<n; t++ ) {
+        mei = s->MagEphemInfo[t];
+        vp  = &v[ (size_t)t*nValues ];
+        if ( Outputs & MAGEPHEM_SRV_B ) vp += 4;
+        if ( Outputs & MAGEPHEM_SRV_FOOTPOINTS ) {
+            *vp++ = mei->FieldLineType;
+            *vp++ = mei->Ellipsoid_Footprint_Pn.x; *vp++ = mei->Ellipsoid_Footprint_Pn.y; *vp++ = mei->Ellipsoid_Footprint_Pn.z;
+            *vp++ = mei->Ellipsoid_Footprint_Ps.x; *vp++ = mei->Ellipsoid_Footprint_Ps.y; *vp++ = mei->Ellipsoid_Footprint_Ps.z;
+            *vp++ = mei->Pmin.x; *vp++ = mei->Pmin.y; *vp++ = mei->Pmin.z;
+            *vp++ = mei->Bmin;
+        }
+        if ( Outputs & MAGEPHEM_SRV_LSTAR ) {
+            for ( k=0; k<nAlpha; k++ ) {
+                *vp++ = mei->Lstar[k]; *vp++ = mei->I[k]; *vp++ = mei->K[k]; *vp++ = mei->Bm[k];
+            }
+        }
+    }
+
+}
+
+
+/*
+ *  Answers requests on fd until the client hangs up (or sends junk).
+ */
+static void Serve( int fd, ServerState *s ) {
+
+    MagEphemServerRequest   q;
+    MagEphemServerReply     h;
+    MagEphemServerPoint     *Pts;
+    double                  Alpha[ MAX_PITCH_ANGLES ], *v;
+    int                     nValues, i0, n, ok;
+
+    while ( !Done && ReadAll( fd, &q, sizeof(q) ) ) {
+
+        if ( ( q.Magic != MAGEPHEM_SRV_REQUEST_MAGIC ) || ( q.nPoints < 0 ) || ( q.nAlpha < 0 ) ) {
+            SendStatus( fd, MAGEPHEM_SRV_BAD_REQUEST );
+            return;     // cant tell where the next request starts
+        }
+        if ( ( q.nPoints > MAGEPHEM_SRV_MAX_POINTS ) || ( q.nAlpha > MAX_PITCH_ANGLES ) ) {
+            SendStatus( fd, MAGEPHEM_SRV_TOO_BIG );
+            return;
+        }
+
+        Pts = (MagEphemServerPoint *)malloc( ( q.nPoints > 0 ? q.nPoints : 1 )*sizeof(MagEphemServerPoint) );
+        if ( !ReadAll( fd, Alpha, q.nAlpha*sizeof(double) ) || !ReadAll( fd, Pts, q.nPoints*sizeof(MagEphemServerPoint) ) ) {
+            free( Pts );
+            return;
+        }
+
+        nValues = 0;
+        if ( q.Outputs & MAGEPHEM_SRV_B )          nValues += 4;
+        if ( q.Outputs & MAGEPHEM_SRV_FOOTPOINTS ) nValues += 11;
+        if ( q.Outputs & MAGEPHEM_SRV_LSTAR )      nValues += 4*q.nAlpha;
+        v = (double *)malloc( ( (size_t)q.nPoints*nValues > 0 ? (size_t)q.nPoints*nValues : 1 )*sizeof(double) );
+
+        for ( i0=0; ( i0 < q.nPoints ) && ( nValues > 0 ) && !Done; i0 += n ) {
+            n = ( q.nPoints - i0 < s->nChunk ) ? q.nPoints - i0 : s->nChunk;
+            DoChunk( n, &Pts[i0], q.nAlpha, Alpha, q.Outputs, nValues, &v[ (size_t)i0*nValues ], s );
+        }
+
+        if ( Done ) {
+            free( Pts ); free( v );
+            return;
+        }
+
+        h.Magic = MAGEPHEM_SRV_REPLY_MAGIC; h.Status = MAGEPHEM_SRV_OK; h.nPoints = q.nPoints; h.nValues = nValues;
+        ok = WriteAll( fd, &h, sizeof(h) ) && WriteAll( fd, v, (size_t)q.nPoints*nValues*sizeof(double) );
+        free( Pts ); free( v );
+        if ( !ok ) return;
+
+        ++s->nQueries; s->nPoints += q.nPoints;
+        if ( s->Verbosity > 0 ) printf("%s: query %ld: %d points, %d pitch angles, outputs %d\n", ProgramName, s->nQueries, q.nPoints, q.nAlpha, q.Outputs );
+    }
+
+}
+
+
+int main( int argc, char *argv[] ) {
+
+    struct Arguments    arguments;
+    struct sigaction    sa;
+    struct sockaddr_un  sun;
+    struct sockaddr_in  sin;
+    Lgm_MagEphemInfo    *MagEphemInfo;
+    ServerState         s;
+    int                 ls, fd, t, nThreads;
+
+    memset( &arguments, 0, sizeof(arguments) );
+    arguments.Quality          = 3;
+    arguments.nFLsInDriftShell = 24;
+    arguments.FootPointHeight  = 100.0;
+    strcpy( arguments.IntModel, "IGRF" );
+    strcpy( arguments.ExtModel, "T89D" );
+    argp_parse( &argp, argc, argv, 0, 0, &arguments );
+
+    nThreads = 1;
+    #ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+    #endif
+    memset( &s, 0, sizeof(s) );
+    s.Verbosity = arguments.Verbosity;
+    s.nChunk    = ( arguments.nChunk > 0 ) ? arguments.nChunk : 4*nThreads;
+    s.ForceKp   = -1.0;
+
+
+    /*
+     *  Set up the first MagEphemInfo the way MagEphemFromTLE does, then
+     *  copy it for the rest of the chunk.
+     */
+    MagEphemInfo = Lgm_InitMagEphemInfo( 0, MAX_PITCH_ANGLES );
+    Lgm_SetMagEphemLstarQuality( arguments.Quality, arguments.nFLsInDriftShell, MagEphemInfo );
+    MagEphemInfo->LstarInfo->ISearchMethod = 1;
+    MagEphemInfo->LstarInfo->LSimpleMax = 12.0;
+    MagEphemInfo->LstarInfo->mInfo->Lgm_LossConeHeight = arguments.FootPointHeight;
+
+    if ( !strcmp( arguments.ExtModel, "CDIP" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_cdip;
+    } else if ( !strcmp( arguments.ExtModel, "EDIP" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_edip;
+    } else if ( !strcmp( arguments.ExtModel, "IGRF" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_igrf;
+    } else if ( !strcmp( arguments.ExtModel, "OP77Q" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_OP77;
+        s.ForceKp = OP77Q_KP;
+    } else if ( !strcmp( arguments.ExtModel, "T87Q" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T87;
+        s.ForceKp = T89Q_KP;
+    } else if ( !strcmp( arguments.ExtModel, "T89Q" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
+        s.ForceKp = T89Q_KP;
+    } else if ( !strcmp( arguments.ExtModel, "T89D" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T89c;
+    } else if ( !strcmp( arguments.ExtModel, "T96" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T96;
+    } else if ( !strcmp( arguments.ExtModel, "T01S" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T01S;
+    } else if ( !strcmp( arguments.ExtModel, "T02" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_T02;
+    } else if ( !strcmp( arguments.ExtModel, "TS04D" ) ){
+        MagEphemInfo->LstarInfo->mInfo->Bfield = Lgm_B_TS04;
+    } else {
+        printf("Unknown model. ExtModel: %s\n", arguments.ExtModel );
+        exit(1);
+    }
+
+    if ( !strcmp( arguments.IntModel, "CDIP" ) ){
+        MagEphemInfo->LstarInfo->mInfo->InternalModel = LGM_CDIP;
+    } else if ( !strcmp( arguments.IntModel, "EDIP" ) ){
+        MagEphemInfo->LstarInfo->mInfo->InternalModel = LGM_EDIP;
+    } else {
+        MagEphemInfo->LstarInfo->mInfo->InternalModel = LGM_IGRF;
+    }
+
+    s.MagEphemInfo = (Lgm_MagEphemInfo **)calloc( s.nChunk, sizeof(Lgm_MagEphemInfo *) );
+    s.Date         = (long int *)calloc( s.nChunk, sizeof(long int) );
+    s.UTC          = (double *)calloc( s.nChunk, sizeof(double) );
+    s.u            = (Lgm_Vector *)calloc( s.nChunk, sizeof(Lgm_Vector) );
+    s.MagEphemInfo[0] = MagEphemInfo;
+    for ( t=1; t<s.nChunk; t++ ) s.MagEphemInfo[t] = Lgm_CopyMagEphemInfo( MagEphemInfo, MAX_PITCH_ANGLES );
+
+    if ( ( arguments.PreloadStart > 0 ) && ( arguments.PreloadEnd >= arguments.PreloadStart ) ) {
+        t = Lgm_QinDenton_LoadRange( arguments.PreloadStart, arguments.PreloadEnd );
+        if ( s.Verbosity > 0 ) printf("%s: preloaded %d days of Qin-Denton inputs\n", ProgramName, t );
+    }
+
+
+    /*
+     *  Listen
+     */
+    if ( arguments.Socket[0] != '\0' ) {
+        ls = socket( AF_UNIX, SOCK_STREAM, 0 );
+        memset( &sun, 0, sizeof(sun) );
+        sun.sun_family = AF_UNIX;
+        strncpy( sun.sun_path, arguments.Socket, sizeof(sun.sun_path)-1 );
+        unlink( arguments.Socket );
+        if ( ( ls < 0 ) || ( bind( ls, (struct sockaddr *)&sun, sizeof(sun) ) < 0 ) ) {
+            perror( arguments.Socket );
+            exit(1);
+        }
+    } else {
+        ls = socket( AF_INET, SOCK_STREAM, 0 );
+        t = 1; setsockopt( ls, SOL_SOCKET, SO_REUSEADDR, &t, sizeof(t) );
+        memset( &sin, 0, sizeof(sin) );
+        sin.sin_family      = AF_INET;
+        sin.sin_port        = htons( arguments.Port );
+        sin.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        if ( ( ls < 0 ) || ( bind( ls, (struct sockaddr *)&sin, sizeof(sin) ) < 0 ) ) {
+            perror( ProgramName );
+            exit(1);
+        }
+    }
+    if ( listen( ls, 8 ) < 0 ) {
+        perror( ProgramName );
+        exit(1);
+    }
+
+    // no SA_RESTART, so that accept() returns on a signal
+    memset( &sa, 0, sizeof(sa) );
+    sa.sa_handler = HandleSignal;
+    sigaction( SIGINT,  &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+    signal( SIGPIPE, SIG_IGN );
+
+    if ( s.Verbosity > 0 ) {
+        printf("%s: %s/%s, Quality %d, nFLsInDriftShell %d, %d times per chunk, listening on %s",
+                ProgramName, arguments.IntModel, arguments.ExtModel, arguments.Quality, arguments.nFLsInDriftShell, s.nChunk,
+                ( arguments.Socket[0] != '\0' ) ? arguments.Socket : "port" );
+        if ( arguments.Socket[0] == '\0' ) printf(" %d", arguments.Port );
+        printf("\n");
+    }
+
+    while ( !Done ) {
+        fd = accept( ls, NULL, NULL );
+        if ( fd < 0 ) {
+            if ( errno != EINTR ) perror( ProgramName );
+            continue;
+        }
+        Serve( fd, &s );
+        close( fd );
+    }
+
+    close( ls );
+    if ( arguments.Socket[0] != '\0' ) unlink( arguments.Socket );
+    if ( s.Verbosity > 0 ) printf("%s: served %ld queries (%ld points)\n", ProgramName, s.nQueries, s.nPoints );
+
+    for ( t=s.nChunk-1; t>=0; t-- ) Lgm_FreeMagEphemInfo( s.MagEphemInfo[t] );
+    free( s.MagEphemInfo ); free( s.Date ); free( s.UTC ); free( s.u );
+
+    return( 0 );
+
+}
@@ -0,0 +1,59 @@
+#ifndef MAGEPHEMSERVER_H
+#define MAGEPHEMSERVER_H
+
+#include <stdint.h>
+
+/*
+ *  Wire format of MagEphemServer (see MagEphemServer.c). Everything is in
+ *  the byte order of the machine the server runs on (it is meant for
+ *  clients on the same host or cluster).
+ *
+ *  A request is a MagEphemServerRequest, then nAlpha doubles (the pitch
+ *  angles in degrees), then nPoints MagEphemServerPoints.
+ *
+ *  The reply is a MagEphemServerReply, then nPoints*nValues doubles (the
+ *  values of point 0 first). The values of a point are, in this order and
+ *  only for the bits that were set in Outputs;
+ *
+ *      MAGEPHEM_SRV_B:          Bx, By, Bz (GSM, nT), |B|
+ *      MAGEPHEM_SRV_FOOTPOINTS: FieldLineType, Ellipsoid_Footprint_Pn (3),
+ *                               Ellipsoid_Footprint_Ps (3), Pmin (3), Bmin
+ *      MAGEPHEM_SRV_LSTAR:      Lstar, I, K, Bm for each pitch angle
+ *
+ *  Values that couldnt be computed are LGM_FILL_VALUE. If Status isnt
+ *  MAGEPHEM_SRV_OK, nValues is 0 and nothing follows.
+ */
+#define MAGEPHEM_SRV_REQUEST_MAGIC  0x51524d4cU     // "LMRQ"
+#define MAGEPHEM_SRV_REPLY_MAGIC    0x50524d4cU     // "LMRP"
+
+#define MAGEPHEM_SRV_B              1
+#define MAGEPHEM_SRV_FOOTPOINTS     2
+#define MAGEPHEM_SRV_LSTAR          4
+
+#define MAGEPHEM_SRV_OK             0
+#define MAGEPHEM_SRV_BAD_REQUEST    1
+#define MAGEPHEM_SRV_TOO_BIG        2
+
+#define MAGEPHEM_SRV_MAX_POINTS     100000
+
+typedef struct MagEphemServerRequest {
+    uint32_t    Magic;
+    int32_t     nPoints;
+    int32_t     nAlpha;
+    int32_t     Outputs;        // OR of the MAGEPHEM_SRV_B, etc. bits
+} MagEphemServerRequest;
+
+typedef struct MagEphemServerPoint {
+    double      Date;           // YYYYMMDD
+    double      UTC;            // decimal hours
+    double      u[3];           // position in GSM (Re)
+} MagEphemServerPoint;
+
+typedef struct MagEphemServerReply {
+    uint32_t    Magic;
+    int32_t     Status;
+    int32_t     nPoints;
+    int32_t     nValues;        // per point
+} MagEphemServerReply;
+
+#endif
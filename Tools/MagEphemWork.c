@@ -0,0 +1,224 @@
+/*
+ *  Work distribution for MagEphemFromTLE and MagEphemFromSpiceKernel.
+ *
+ *  The tools loop over dates and, for each date, over birds. Each (date,
+ *  bird) pair is a work unit, numbered in loop order, and writes its own
+ *  output files (the OutFile template should contain %YYYY, %MM, %DD and,
+ *  for more than one bird, %B), so units can be done by different processes
+ *  without any merging afterwards.
+ *
+ *  With MPI, rank 0 holds a unit counter in an RMA window. Each rank
+ *  atomically fetches-and-increments it (MPI_Fetch_and_op) to claim its
+ *  next unit, runs down the same loops skipping everything else, and
+ *  claims again once it has reached the unit it holds. The claims a rank
+ *  gets are increasing, so the loops never have to go back. There is no
+ *  master process; rank 0 works too. Within a rank, the L* calculations
+ *  still use OpenMP, so the usual setup is one rank per node (or socket)
+ *  with OMP_NUM_THREADS set to the cores it has.
+ *
+ *  Without MPI, MagEphemWork_StartJobs( N, ... ) forks the process into N
+ *  jobs on the one node. They share a unit counter in an anonymous shared
+ *  mapping (claimed with an atomic fetch-and-add) and otherwise work just
+ *  like ranks. The threads are split between them: each job gets
+ *  1/N of what OpenMP would have used, for both the tool's own loops
+ *  (omp_set_num_threads()) and the library's task pool
+ *  (Lgm_SetMaxThreads()), so N jobs never run more threads than one job
+ *  would have. A few concurrent bird-days keep a node busy when one
+ *  bird-day on its own cant (e.g. in the serial parts of each time step or
+ *  while a file is being written).
+ *
+ *  Typical use,
+ *
+ *      MagEphemWork_Init( &argc, &argv, &Work );
+ *      ...
+ *      iUnit = 0;
+ *      for ( JD = sJD; JD <= eJD; JD += 1.0 ) {
+ *          for ( iBird = 0; iBird < nBirds; iBird++ ) {
+ *              if ( !MagEphemWork_IsMine( iUnit++, &Work ) ) continue;
+ *              ...
+ *          }
+ *      }
+ *      MagEphemWork_Finalize( &Work );
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <Lgm/Lgm_Tasks.h>
+#include "MagEphemWork.h"
+
+
+/*
+ *  Claim the next unit.
+ */
+static long int Claim( MagEphemWork *w ) {
+
+    long int    i;
+#if USE_MPI
+    long int    One = 1;
+#endif
+
+    if ( w->Local != NULL ) return( __sync_fetch_and_add( w->Local, 1 ) );
+
+#if USE_MPI
+    MPI_Win_lock( MPI_LOCK_SHARED, 0, 0, w->Win );
+    MPI_Fetch_and_op( &One, &i, MPI_LONG, 0, 0, MPI_SUM, w->Win );
+    MPI_Win_unlock( 0, w->Win );
+#else
+    i = w->Counter++;
+#endif
+
+    return( i );
+
+}
+
+
+/*
+ *  Set up. Call this before the command line is parsed (MPI_Init() may
+ *  change argc and argv).
+ */
+void MagEphemWork_Init( int *argc, char ***argv, MagEphemWork *w ) {
+
+#if USE_MPI
+    int         Provided;
+#endif
+
+    w->Rank    = 0;
+    w->nRanks  = 1;
+    w->Next    = -1;
+    w->Counter = 0;
+    w->nDone   = 0;
+    w->Job      = 0;
+    w->nJobs    = 1;
+    w->Local    = NULL;
+    w->Children = NULL;
+
+#if USE_MPI
+    // Only the main thread of each rank makes MPI calls.
+    MPI_Init_thread( argc, argv, MPI_THREAD_FUNNELED, &Provided );
+    MPI_Comm_rank( MPI_COMM_WORLD, &w->Rank );
+    MPI_Comm_size( MPI_COMM_WORLD, &w->nRanks );
+
+    MPI_Win_allocate( ( w->Rank == 0 ) ? sizeof(long int) : 0, sizeof(long int), MPI_INFO_NULL, MPI_COMM_WORLD, &w->Shared, &w->Win );
+    if ( w->Rank == 0 ) {
+        MPI_Win_lock( MPI_LOCK_EXCLUSIVE, 0, 0, w->Win );
+        *w->Shared = 0;
+        MPI_Win_unlock( 0, w->Win );
+    }
+    MPI_Barrier( MPI_COMM_WORLD );
+#endif
+
+}
+
+
+/*
+ *  Split into nJobs local processes (see the notes at the top). Call this
+ *  after the command line has been parsed but before any work is done, and
+ *  in particular before anything has started an OpenMP team (forking a
+ *  process that has one isnt safe). Ignored with more than one MPI rank.
+ */
+void MagEphemWork_StartJobs( int nJobs, MagEphemWork *w ) {
+
+    int         nThreads = 1, nPerJob, j;
+    pid_t       pid;
+
+    if ( nJobs <= 1 ) return;
+    if ( w->nRanks > 1 ) {
+        printf( "Ignoring --jobs with %d MPI ranks (use more ranks instead).\n", w->nRanks );
+        return;
+    }
+
+    w->Local = (long int *)mmap( NULL, sizeof(long int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if ( w->Local == MAP_FAILED ) {
+        perror( "MagEphemWork_StartJobs: mmap" );
+        w->Local = NULL;
+        return;
+    }
+    *w->Local = 0;
+
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    nPerJob = nThreads/nJobs;
+    if ( nPerJob < 1 ) nPerJob = 1;
+
+    // otherwise anything still buffered gets written once per job
+    fflush( stdout );
+    fflush( stderr );
+
+    w->Children = (pid_t *)calloc( nJobs, sizeof(pid_t) );
+    for ( j=1; j<nJobs; j++ ) {
+        if ( (pid = fork()) == 0 ) {
+            w->Job   = j;
+            w->nJobs = nJobs;
+            break;
+        } else if ( pid < 0 ) {
+            perror( "MagEphemWork_StartJobs: fork" );
+            break;
+        }
+        w->Children[ w->nJobs++ ] = pid;
+    }
+
+#ifdef _OPENMP
+    omp_set_num_threads( nPerJob );
+#endif
+    Lgm_SetMaxThreads( nPerJob );
+
+}
+
+
+/*
+ *  Returns TRUE if work unit iUnit is to be done by this rank. Must be
+ *  called for every unit, in order.
+ */
+int MagEphemWork_IsMine( long int iUnit, MagEphemWork *w ) {
+
+    if ( w->Next < 0 ) w->Next = Claim( w );
+
+    if ( iUnit == w->Next ) {
+        w->Next = -1;
+        ++w->nDone;
+        return( 1 );
+    }
+
+    return( 0 );
+
+}
+
+
+/*
+ *  Wait for all ranks (and jobs) and shut down. The forked jobs exit here.
+ */
+void MagEphemWork_Finalize( MagEphemWork *w ) {
+
+    int         j, Status;
+
+    if ( w->Local != NULL ) {
+        printf( "\n\n      Job %d of %d did %ld work units.\n", w->Job, w->nJobs, w->nDone );
+        if ( w->Job > 0 ) {
+            fflush( stdout );
+            exit( 0 );
+        }
+        for ( j=1; j<w->nJobs; j++ ) {
+            if ( ( waitpid( w->Children[j], &Status, 0 ) < 0 ) || !WIFEXITED( Status ) || ( WEXITSTATUS( Status ) != 0 ) ) {
+                printf( "      Job %d (pid %ld) did not finish normally.\n", j, (long int)w->Children[j] );
+            }
+        }
+        munmap( w->Local, sizeof(long int) );
+        free( w->Children );
+        w->Local = NULL;
+    }
+
+    if ( w->nRanks > 1 ) printf( "\n\n      Rank %d of %d did %ld work units.\n", w->Rank, w->nRanks, w->nDone );
+
+#if USE_MPI
+    MPI_Barrier( MPI_COMM_WORLD );
+    MPI_Win_free( &w->Win );
+    MPI_Finalize( );
+#endif
+
+}
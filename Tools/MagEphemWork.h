@@ -0,0 +1,39 @@
+#ifndef MAGEPHEM_WORK_H
+#define MAGEPHEM_WORK_H
+
+#include <sys/types.h>
+#if USE_MPI
+#include <mpi.h>
+#endif
+
+/*
+ *  Hands out the (date x bird) work units of the MagEphem tools. Without
+ *  MPI every unit is done by the one process. With MPI (configure
+ *  --enable-mpi) the units are spread over the ranks dynamically: a rank
+ *  claims the next unnumbered unit whenever it finishes one, so ranks that
+ *  get expensive (e.g. storm) days simply do fewer of them. The same
+ *  sharing can be done between local processes (--jobs N, see
+ *  MagEphemWork_StartJobs()). See MagEphemWork.c.
+ */
+typedef struct MagEphemWork {
+    int         Rank;           // this process' rank (0 without MPI)
+    int         nRanks;         // number of ranks (1 without MPI)
+    long int    Next;           // unit claimed but not yet reached (-1 if none)
+    long int    Counter;        // the unit counter when there is no MPI
+    long int    nDone;          // number of units this rank did
+    int         Job;            // this process' job number (0 for the original process)
+    int         nJobs;          // number of local jobs (1 unless MagEphemWork_StartJobs() forked some)
+    long int    *Local;         // unit counter shared by the local jobs (NULL if there is only one)
+    pid_t       *Children;      // the jobs forked by job 0
+#if USE_MPI
+    MPI_Win     Win;            // window holding the shared unit counter (on rank 0)
+    long int    *Shared;
+#endif
+} MagEphemWork;
+
+void MagEphemWork_Init( int *argc, char ***argv, MagEphemWork *w );
+void MagEphemWork_StartJobs( int nJobs, MagEphemWork *w );
+int  MagEphemWork_IsMine( long int iUnit, MagEphemWork *w );
+void MagEphemWork_Finalize( MagEphemWork *w );
+
+#endif
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <argp.h>
+#include <Lgm_QinDenton.h>
+
+
+const  char *ProgramName = "PackQinDenton";
+const  char *argp_program_version     = "PackQinDenton_0.1";
+const  char *argp_program_bug_address = "<mghenderson@lanl.gov>";
+static char doc[] = "\nPacks the daily QinDenton files into a single binary archive."
+                    " \n\n The QinDenton_YYYYMMDD_1min.txt file (or the 1hr file if there is no 1min"
+                    " file) for every day between StartDate and EndDate is read from the QinDenton"
+                    " directory and written to OutFile. If OutFile is put in the QinDenton directory"
+                    " with the name QinDenton.bin (or the environment variable LGM_QIN_DENTON_ARCHIVE"
+                    " points at it), Lgm_get_QinDenton_at_JD() will memory-map it instead of reading"
+                    " the text files for days in that range.\n\n"
+                    " \t./PackQinDenton -S 20130101 -E 20131231 $QIN_DENTON_PATH/QinDenton.bin\n\n";
+
+
+// Mandatory arguments
+#define     nArgs   1
+static char ArgsDoc[] = "OutFile";
+
+/*
+ *   Description of options accepted. The fields are as follows;
+ *
+ *   { NAME, KEY, ARG, FLAGS, DOC } where each of these have the following
+ *   meaning;
+ *      NAME - Name of option's long argument (can be zero).
+ *       KEY - Character used as key for the parser and it's short name.
+ *       ARG - Name of the option's argument (zero if there isnt one).
+ *     FLAGS - OPTION_ARG_OPTIONAL, OPTION_ALIAS, OPTION_HIDDEN, OPTION_DOC,
+ *             or OPTION_NO_USAGE
+ */
+static struct argp_option Options[] = {
+    {"DataPath",        'p',    "path",                       0,        "QinDenton directory. Default is $QIN_DENTON_PATH (or the installed location)." },
+    {"StartDate",       'S',    "yyyymmdd",                   0,        "StartDate "                              },
+    {"EndDate",         'E',    "yyyymmdd",                   0,        "EndDate "                                },
+    { 0 }
+};
+
+struct Arguments {
+    char        *args[ nArgs ];       /* OutFile */
+    char        *DataPath;
+    long int    StartDate;
+    long int    EndDate;
+};
+
+/* Parse a single option. */
+static error_t parse_opt (int key, char *arg, struct argp_state *state) {
+
+    /* Get the input argument from argp_parse, which we
+      know is a pointer to our arguments structure. */
+    struct Arguments *arguments = state->input;
+    switch( key ) {
+        case 'p': // data path
+            arguments->DataPath = arg;
+            break;
+        case 'S': // start date
+            sscanf( arg, "%ld", &arguments->StartDate );
+            break;
+        case 'E': // end date
+            sscanf( arg, "%ld", &arguments->EndDate );
+            break;
+        case ARGP_KEY_ARG:
+            if (state->arg_num >= nArgs) {
+                /* Too many arguments. */
+                argp_usage (state);
+            }
+            arguments->args[state->arg_num] = arg;
+            break;
+        case ARGP_KEY_END:
+            if (state->arg_num < nArgs)
+            /* Not enough arguments. */
+            argp_usage (state);
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/* Our argp parser. */
+static struct argp argp = { Options, parse_opt, ArgsDoc, doc };
+
+
+int main( int argc, char *argv[] ){
+
+    struct Arguments arguments;
+    long int         n;
+
+    /*
+     * Default option values.
+     */
+    arguments.DataPath  = NULL;
+    arguments.StartDate = -1;
+    arguments.EndDate   = -1;
+
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    if ( (arguments.StartDate < 0) || (arguments.EndDate < 0) ) {
+        fprintf( stderr, "%s: Both StartDate and EndDate must be given (see %s --help).\n", ProgramName, ProgramName );
+        exit( 1 );
+    }
+
+    n = Lgm_QinDenton_BuildArchive( arguments.DataPath, arguments.StartDate, arguments.EndDate, arguments.args[0] );
+    if ( n < 0 ) exit( 1 );
+
+    printf( "%s: Wrote %ld records to %s\n", ProgramName, n, arguments.args[0] );
+
+    return( 0 );
+
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <argp.h>
+#include <Lgm_Tsyg2007.h>
+
+
+const  char *ProgramName = "PackTS07Coeffs";
+const  char *argp_program_version     = "PackTS07Coeffs_0.1";
+const  char *argp_program_bug_address = "<mghenderson@lanl.gov>";
+static char doc[] = "\nPacks the TS07D coefficient files into a single indexed binary archive."
+                    " \n\n The tail coefficients (TAIL_PAR/tail*.par) and all of the 5-minute"
+                    " coefficient files (Coeffs/YYYY_DDD/YYYY_DDD_HH_MM.par) between StartDate and"
+                    " EndDate are read from the TS07 data directory and written to OutFile. If"
+                    " OutFile is put in the TS07 data directory with the name TS07D_Coeffs.bin (or"
+                    " the environment variable LGM_TS07_ARCHIVE points at it), the TS07D model will"
+                    " memory-map it instead of reading the text files.\n\n"
+                    " \t./PackTS07Coeffs -S 20020101 -E 20021231 $TS07_DATA_PATH/TS07D_Coeffs.bin\n\n";
+
+
+// Mandatory arguments
+#define     nArgs   1
+static char ArgsDoc[] = "OutFile";
+
+/*
+ *   Description of options accepted. The fields are as follows;
+ *
+ *   { NAME, KEY, ARG, FLAGS, DOC } where each of these have the following
+ *   meaning;
+ *      NAME - Name of option's long argument (can be zero).
+ *       KEY - Character used as key for the parser and it's short name.
+ *       ARG - Name of the option's argument (zero if there isnt one).
+ *     FLAGS - OPTION_ARG_OPTIONAL, OPTION_ALIAS, OPTION_HIDDEN, OPTION_DOC,
+ *             or OPTION_NO_USAGE
+ */
+static struct argp_option Options[] = {
+    {"DataPath",        'p',    "path",                       0,        "TS07 data directory. Default is $TS07_DATA_PATH (or the installed location)." },
+    {"StartDate",       'S',    "yyyymmdd",                   0,        "StartDate "                              },
+    {"EndDate",         'E',    "yyyymmdd",                   0,        "EndDate "                                },
+    { 0 }
+};
+
+struct Arguments {
+    char        *args[ nArgs ];       /* OutFile */
+    char        *DataPath;
+    long int    StartDate;
+    long int    EndDate;
+};
+
+/* Parse a single option. */
+static error_t parse_opt (int key, char *arg, struct argp_state *state) {
+
+    /* Get the input argument from argp_parse, which we
+      know is a pointer to our arguments structure. */
+    struct Arguments *arguments = state->input;
+    switch( key ) {
+        case 'p': // data path
+            arguments->DataPath = arg;
+            break;
+        case 'S': // start date
+            sscanf( arg, "%ld", &arguments->StartDate );
+            break;
+        case 'E': // end date
+            sscanf( arg, "%ld", &arguments->EndDate );
+            break;
+        case ARGP_KEY_ARG:
+            if (state->arg_num >= nArgs) {
+                /* Too many arguments. */
+                argp_usage (state);
+            }
+            arguments->args[state->arg_num] = arg;
+            break;
+        case ARGP_KEY_END:
+            if (state->arg_num < nArgs)
+            /* Not enough arguments. */
+            argp_usage (state);
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+/* Our argp parser. */
+static struct argp argp = { Options, parse_opt, ArgsDoc, doc };
+
+
+int main( int argc, char *argv[] ){
+
+    struct Arguments arguments;
+    long int         n;
+
+    /*
+     * Default option values.
+     */
+    arguments.DataPath  = NULL;
+    arguments.StartDate = -1;
+    arguments.EndDate   = -1;
+
+    argp_parse (&argp, argc, argv, 0, 0, &arguments);
+
+    if ( (arguments.StartDate < 0) || (arguments.EndDate < 0) ) {
+        fprintf( stderr, "%s: Both StartDate and EndDate must be given (see %s --help).\n", ProgramName, ProgramName );
+        exit( 1 );
+    }
+
+    n = Lgm_TS07_BuildArchive( arguments.DataPath, arguments.StartDate, arguments.EndDate, arguments.args[0] );
+    if ( n < 0 ) exit( 1 );
+
+    printf( "%s: Wrote %ld epochs to %s\n", ProgramName, n, arguments.args[0] );
+
+    return( 0 );
+
+}
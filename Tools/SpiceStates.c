@@ -0,0 +1,118 @@
+/*
+ *  Block-fetched SPICE states for MagEphemFromSpiceKernel.
+ *
+ *  The tool needs the position of the S/C at every time step, and many more
+ *  times in the Brent searches for apogees, perigees and nodes. Fetching
+ *  each of them with spkezp_c() is slow at dense cadences and, since CSPICE
+ *  isnt thread safe, every fetch in the parallel time loop had to be done
+ *  inside a critical section.
+ *
+ *  Instead, SpiceStates_Load() fetches the states (position and velocity)
+ *  on a regular grid of ephemeris times covering the day, in one pass on one
+ *  thread, and SpiceStates_Position() interpolates between the two nodes
+ *  that bracket a time with a cubic Hermite polynomial. With the positions
+ *  and velocities at both ends the error is of order (h w)^4 r/384 for an
+ *  orbit of radius r and angular rate w, i.e. well under a meter at the
+ *  default 60s spacing even for LEO. Lookups are thread safe. Times outside
+ *  of the grid (and every time, if Step <= 0) go to spkezp_c() as before.
+ *
+ *  Typical use,
+ *
+ *      SpiceStates_Init( BODY, EARTH_ID, 60.0, &States );
+ *      for ( each day ) {
+ *          SpiceStates_Load( et_start, et_end, &States );
+ *          ...
+ *          SpiceStates_Position( et, pos, &States );
+ *          ...
+ *      }
+ *      SpiceStates_Free( &States );
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "SpiceUsr.h"
+#include "SpiceStates.h"
+
+
+void SpiceStates_Init( int Body, int Observer, double Step, SpiceStates *s ) {
+
+    s->Body     = Body;
+    s->Observer = Observer;
+    s->Step     = Step;
+    s->et0      = 0.0;
+    s->n        = 0;
+    s->X        = NULL;
+    s->nFetched = 0;
+    s->nMissed  = 0;
+
+}
+
+
+/*
+ *  Fetch the states from et0 to (at least) et1. Call this from one thread
+ *  only (i.e. outside of any parallel region).
+ */
+void SpiceStates_Load( double et0, double et1, SpiceStates *s ) {
+
+    long int    k;
+    double      lt;
+
+    free( s->X );
+    s->X = NULL;
+    s->n = 0;
+    if ( ( s->Step <= 0.0 ) || ( et1 <= et0 ) ) return;
+
+    s->et0 = et0;
+    s->n   = (long int)ceil( (et1-et0)/s->Step ) + 1;
+    s->X   = (double (*)[6])calloc( s->n, sizeof(double[6]) );
+    for ( k=0; k<s->n; k++ ) {
+        spkez_c( s->Body, et0 + k*s->Step, "J2000", "NONE", s->Observer, s->X[k], &lt );
+    }
+    s->nFetched += s->n;
+
+}
+
+
+/*
+ *  J2000 position (km) of the body at ephemeris time et.
+ */
+void SpiceStates_Position( double et, double pos[3], SpiceStates *s ) {
+
+    long int    k;
+    double      h, t, t2, t3, h00, h10, h01, h11, *a, *b, lt;
+    int         j;
+
+    if ( ( s->n > 1 ) && ( et >= s->et0 ) && ( et <= s->et0 + (s->n-1)*s->Step ) ) {
+
+        h = s->Step;
+        k = (long int)( (et - s->et0)/h );
+        if ( k > s->n-2 ) k = s->n-2;
+        t  = ( et - (s->et0 + k*h) )/h;
+        t2 = t*t; t3 = t2*t;
+        h00 =  2.0*t3 - 3.0*t2 + 1.0;
+        h10 =      t3 - 2.0*t2 + t;
+        h01 = -2.0*t3 + 3.0*t2;
+        h11 =      t3 -     t2;
+        a = s->X[k]; b = s->X[k+1];
+        for ( j=0; j<3; j++ ) pos[j] = h00*a[j] + h10*h*a[j+3] + h01*b[j] + h11*h*b[j+3];
+
+    } else {
+
+        #pragma omp critical (Spice)
+        {
+            spkezp_c( s->Body, et, "J2000", "NONE", s->Observer, pos, &lt );
+            ++s->nMissed;
+        }
+
+    }
+
+}
+
+
+void SpiceStates_Free( SpiceStates *s ) {
+
+    free( s->X );
+    s->X = NULL;
+    s->n = 0;
+
+}
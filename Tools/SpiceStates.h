@@ -0,0 +1,27 @@
+#ifndef SPICE_STATES_H
+#define SPICE_STATES_H
+
+/*
+ *  A day's worth of SPICE state vectors for one body, fetched in one pass
+ *  (on one thread -- CSPICE isnt thread safe) and then looked up with cubic
+ *  Hermite interpolation from the positions and velocities, so that the
+ *  time loop of MagEphemFromSpiceKernel never has to call SPICE. See
+ *  SpiceStates.c.
+ */
+typedef struct SpiceStates {
+    int         Body;           // NAIF ID of the body
+    int         Observer;       // NAIF ID of the observer (e.g. the Earth)
+    double      et0;            // TDB seconds past J2000 of node 0
+    double      Step;           // node spacing in seconds (<= 0 means dont interpolate, call SPICE every time)
+    long int    n;              // number of nodes
+    double      (*X)[6];        // J2000 position (km) and velocity (km/s) at the nodes
+    long int    nFetched;       // number of states fetched from SPICE
+    long int    nMissed;        // number of lookups that had to go to SPICE (outside of the nodes)
+} SpiceStates;
+
+void SpiceStates_Init( int Body, int Observer, double Step, SpiceStates *s );
+void SpiceStates_Load( double et0, double et1, SpiceStates *s );
+void SpiceStates_Position( double et, double pos[3], SpiceStates *s );
+void SpiceStates_Free( SpiceStates *s );
+
+#endif
@@ -1,46 +1,51 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
+#include <GL/glew.h>
 #include <GL/gl.h>
 #include <GL/glu.h>
-#include <Lgm/Lgm_DynamicMemory.h>
+#include "Vds_Mesh.h"
 
 
 
 #define MaxCurvePoints 5000
 
-void MakeTube(double *X, double *Y, double *Z, int NumCurvePoints, int NumCirclePoints, double TubeRadius ){
+/*
+ *  Add a tube of radius TubeRadius (with NumCirclePoints sides) around the
+ *  curve X, Y, Z to the mesh m. Only every Stride'th curve point is used
+ *  (the last one always is), which gives the coarser levels of detail.
+ */
+void MakeTubeMesh( double *X, double *Y, double *Z, int NumCurvePoints, int Stride, int NumCirclePoints, double TubeRadius, Vds_Mesh *m ){
 
 	double CurvePoint[MaxCurvePoints][3], TangentVector[MaxCurvePoints][3]; 
-	double a, b, c, L, Linv, min, AngInc, Angle;
+	double a, b, c, L, min, AngInc, Angle;
 	double x[MaxCurvePoints][3], y[MaxCurvePoints][3], z[MaxCurvePoints][3], tmp[3];
 	double CirclePoints[100][3], CirclePoints_p[100][3];
-	double ***Mesh, ***Normals;
-	double v1[3], v2[3], v3[3], n1[3], n2[3], n3[3];
+	double v[3], nv[3];
 	
-	int     i, j, k, n;
+	int     i, j, k, n, i0;
 
+    if ( Stride < 1 ) Stride = 1;
+    if ( NumCirclePoints > 99 ) NumCirclePoints = 99;
 
-    LGM_ARRAY_3D( Mesh,    MaxCurvePoints, 100, 3, double );
-    LGM_ARRAY_3D( Normals, MaxCurvePoints, 100, 3, double );
 
 	/*
 	 *  Read in the points
 	 */
-	for (n=0; n<NumCurvePoints; ++n){
-	    CurvePoint[n][0] = X[n];
-	    CurvePoint[n][1] = Y[n];
-	    CurvePoint[n][2] = Z[n];
+	for (n=0, i=0; i<NumCurvePoints; i += Stride){
+	    CurvePoint[n][0] = X[i];
+	    CurvePoint[n][1] = Y[i];
+	    CurvePoint[n][2] = Z[i];
+	    ++n;
 	}
-
-
-
-    //TubeRadius = 0.075/2.0;
-    //NumCirclePoints = 24;
-
-
-    //printf("NumCurvePoints = %d\n", NumCurvePoints);
-    //printf("NumCirclePoints = %d\n", NumCirclePoints);
-    //printf("TubeRadius = %f\n", TubeRadius);
+    if ( ( NumCurvePoints > 0 ) && ( (NumCurvePoints-1)%Stride != 0 ) ) {
+	    CurvePoint[n][0] = X[NumCurvePoints-1];
+	    CurvePoint[n][1] = Y[NumCurvePoints-1];
+	    CurvePoint[n][2] = Z[NumCurvePoints-1];
+	    ++n;
+    }
+    NumCurvePoints = n;
+    if ( NumCurvePoints < 4 ) return; // the tangents below need at least 4
 
 
 
@@ -200,9 +205,10 @@ void MakeTube(double *X, double *Y, double *Z, int NumCurvePoints, int NumCircle
 
 	/*
 	 * Now compute the CirclePoints_p vectors relative to the original coordinate
-	 * system. Dump results in the Mesh array.
-	 *      Mesh[curve point number][circle pointm number][component]
+	 * system. These (plus the curve point) are the vertices of the tubular
+	 * mesh, and the CirclePoints themselves (normalized) are the normals.
 	 */
+    i0 = m->nVerts;
 	for (i=0; i < NumCurvePoints; ++i){
 		for (j=0; j<NumCirclePoints+1; ++j){
 			CirclePoints[j][0] = CirclePoints_p[j][0] * x[i][0]
@@ -215,97 +221,45 @@ void MakeTube(double *X, double *Y, double *Z, int NumCurvePoints, int NumCircle
 					   + CirclePoints_p[j][1] * y[i][2]
 					   + CirclePoints_p[j][2] * z[i][2];
 			
-			Mesh[i][j][0] = CurvePoint[i][0] + CirclePoints[j][0];
-			Mesh[i][j][1] = CurvePoint[i][1] + CirclePoints[j][1];
-			Mesh[i][j][2] = CurvePoint[i][2] + CirclePoints[j][2];
-		}
+			v[0] = CurvePoint[i][0] + CirclePoints[j][0];
+			v[1] = CurvePoint[i][1] + CirclePoints[j][1];
+			v[2] = CurvePoint[i][2] + CirclePoints[j][2];
 
-	}
-	
+			a = CirclePoints[j][0], b = CirclePoints[j][1], c = CirclePoints[j][2];
+			L = sqrt(a*a + b*b +c*c);
+			nv[0] = a/L, nv[1] = b/L, nv[2] = c/L;
 
-	/*
-	 *  Now, Compute the normalized normals at each point on the Mesh.
-	 */
-	for (i=0; i < NumCurvePoints; ++i){
-		for (j=0; j<NumCirclePoints+1; ++j){
-			Normals[i][j][0] = Mesh[i][j][0] - CurvePoint[i][0];
-			Normals[i][j][1] = Mesh[i][j][1] - CurvePoint[i][1];
-			Normals[i][j][2] = Mesh[i][j][2] - CurvePoint[i][2];
-			a = Normals[i][j][0], b = Normals[i][j][1], c = Normals[i][j][2];
-			Linv = sqrt(a*a + b*b +c*c);
-			Normals[i][j][0] *= Linv;
-			Normals[i][j][1] *= Linv;
-			Normals[i][j][2] *= Linv;
+            Vds_Mesh_AddVertex( m, nv, v );
 		}
 	}
 
 
-
-
-	 
-
 	/*
-	 *  Now, Mesh should contain all the points on the tubluar mesh we plan
-	 *  to render with trinagles. And Normals should contain all the Normal vectors
-	 *  to the surface. So now all we need to do is to output the mesh in a form 
-	 *  that POVray (for example) can use. Use the smooth_triangle object....
+	 *  Two triangles for each quad of the mesh (same winding as the
+	 *  smooth_triangles this used to write out for POVray).
 	 */
-
-//	fp = fopen("Line.pov", "w");
-//	fprintf(fp, "mesh{\n");
-    glBegin( GL_TRIANGLES );
 	for (i=0; i < NumCurvePoints-1; ++i){
 		for (j=0; j<NumCirclePoints; ++j){
-
-			/* 1st trinagle */
-            v1[0] = Mesh[i][j][0],          v1[1] = Mesh[i][j][1],          v1[2] = Mesh[i][j][2];
-            n1[0] = Normals[i][j][0],       n1[1] = Normals[i][j][1],       n1[2] = Normals[i][j][2];
-
-            v2[0] = Mesh[i][j+1][0],        v2[1] = Mesh[i][j+1][1],        v2[2] = Mesh[i][j+1][2];
-            n2[0] = Normals[i][j+1][0],     n2[1] = Normals[i][j+1][1],     n2[2] = Normals[i][j+1][2];
-
-            v3[0] = Mesh[i+1][j+1][0],      v3[1] = Mesh[i+1][j+1][1],      v3[2] = Mesh[i+1][j+1][2];
-            n3[0] = Normals[i+1][j+1][0],   n3[1] = Normals[i+1][j+1][1],   n3[2] = Normals[i+1][j+1][2];
-
-
-
-            // In openGL, the normals come first. One normal for each vertex gives
-            // smoothly-shaded triangles.
-            glNormal3f( n1[0], n1[1], n1[2] ); glVertex3f( v1[0], v1[1], v1[2] );  
-            glNormal3f( n2[0], n2[1], n2[2] ); glVertex3f( v2[0], v2[1], v2[2] );  
-            glNormal3f( n3[0], n3[1], n3[2] ); glVertex3f( v3[0], v3[1], v3[2] );  
-
-//			fprintf(fp, "smooth_triangle { <%f, %f, %f>, <%f, %f, %f>,", v1[0], v1[1], v1[2], n1[0], n1[1], n1[2]);
-//			fprintf(fp, " <%f, %f, %f>, <%f, %f, %f>,", v2[0], v2[1], v2[2], n2[0], n2[1], n2[2]);
-//			fprintf(fp, " <%f, %f, %f>, <%f, %f, %f>}\n", v3[0], v3[1], v3[2], n3[0], n3[1], n3[2]);
-
-			/* 2nd trinagle */
-			v1[0] = Mesh[i][j][0],          v1[1] = Mesh[i][j][1],          v1[2] = Mesh[i][j][2];
-			n1[0] = Normals[i][j][0],       n1[1] = Normals[i][j][1],       n1[2] = Normals[i][j][2];
-
-			v2[0] = Mesh[i+1][j+1][0],      v2[1] = Mesh[i+1][j+1][1],      v2[2] = Mesh[i+1][j+1][2];
-			n2[0] = Normals[i+1][j+1][0],   n2[1] = Normals[i+1][j+1][1],   n2[2] = Normals[i+1][j+1][2];
-
-			v3[0] = Mesh[i+1][j][0],        v3[1] = Mesh[i+1][j][1],        v3[2] = Mesh[i+1][j][2];
-			n3[0] = Normals[i+1][j][0],     n3[1] = Normals[i+1][j][1],     n3[2] = Normals[i+1][j][2];
-
-            glNormal3f( n1[0], n1[1], n1[2] ); glVertex3f( v1[0], v1[1], v1[2] );  
-            glNormal3f( n2[0], n2[1], n2[2] ); glVertex3f( v2[0], v2[1], v2[2] );  
-            glNormal3f( n3[0], n3[1], n3[2] ); glVertex3f( v3[0], v3[1], v3[2] );  
-
-
-//			fprintf(fp, "smooth_triangle { <%f, %f, %f>, <%f, %f, %f>,", v1[0], v1[1], v1[2], n1[0], n1[1], n1[2]);
-//			fprintf(fp, " <%f, %f, %f>, <%f, %f, %f>,", v2[0], v2[1], v2[2], n2[0], n2[1], n2[2]);
-//			fprintf(fp, " <%f, %f, %f>, <%f, %f, %f>}\n", v3[0], v3[1], v3[2], n3[0], n3[1], n3[2]);
+            k = i0 + i*(NumCirclePoints+1) + j; // vertex (i, j)
+            Vds_Mesh_AddTriangle( m, k, k+1, k+NumCirclePoints+2 );
+            Vds_Mesh_AddTriangle( m, k, k+NumCirclePoints+2, k+NumCirclePoints+1 );
 		}
 	}
-    glEnd( );
-//	fprintf(fp, "}\n");
-//	fclose(fp);
 
+}
+
+
+/*
+ *  Draw a tube around the curve X, Y, Z in immediate mode (e.g. into a
+ *  display list).
+ */
+void MakeTube(double *X, double *Y, double *Z, int NumCurvePoints, int NumCirclePoints, double TubeRadius ){
 
+    Vds_Mesh    m;
 
-    LGM_ARRAY_3D_FREE( Mesh );
-    LGM_ARRAY_3D_FREE( Normals );
+    Vds_Mesh_Init( &m );
+    MakeTubeMesh( X, Y, Z, NumCurvePoints, 1, NumCirclePoints, TubeRadius, &m );
+    Vds_Mesh_DrawImmediate( &m );
+    Vds_Mesh_Free( &m );
 
 }
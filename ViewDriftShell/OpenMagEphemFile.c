@@ -1,4 +1,5 @@
 #include "ViewDriftShell.h"
+#include "Vds_MagEphemIndex.h"
 
 #define GLADE_HOOKUP_OBJECT(component,widget,name ) \
   g_object_set_data_full( G_OBJECT( component ), name, \
@@ -10,14 +11,32 @@
 
 gboolean OpenMyFile( GtkWidget *widget, gpointer data ) {
 
-    GError      *error = NULL;
-    gchar       *Filename;
-    gchar       *ExtText;
-    int         x, y, width, height, depth;
+    GError              *error = NULL;
+    gchar               *Filename;
+    gchar               *ExtText;
+    int                 x, y, width, height, depth;
+    Vds_MagEphemFile    *f;
+    static char         *Formats[] = { "Text", "HDF5", "Columnar" };
 
     if ( (Filename  = gtk_file_chooser_get_filename( GTK_FILE_CHOOSER( widget ) )) == NULL ) return( FALSE );
     printf( "Open Filename = %s\n", Filename);
 
+    /*
+     * Only the time index is built here. The records are read as the display
+     * time gets to them (see Vds_MagEphemIndex.c), so even long files open at
+     * once.
+     */
+    if ( nMagEphemFiles >= VDS_MEI_MAX_FILES ) {
+        printf( "    Already have %d MagEphem files open\n", nMagEphemFiles );
+    } else if ( (f = Vds_MagEphem_Open( Filename )) == NULL ) {
+        printf( "    Not a MagEphem file (or it has no times in it)\n" );
+    } else {
+        printf( "    %s MagEphem file: %ld records, JD %.6f to %.6f, %d pitch angles\n", Formats[f->Format], f->nRecs, f->JD[0], f->JD[f->nRecs-1], f->nAlpha );
+        MagEphemFiles[ nMagEphemFiles++ ] = f;
+        Vds_MagEphem_At( f, CurrentJD );
+        expose_event( drawing_area, NULL, NULL );
+    }
+
 
     gtk_widget_destroy( widget );
 
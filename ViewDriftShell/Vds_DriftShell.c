@@ -192,7 +192,8 @@ void Lgm_gl_draw_cone( gboolean solid, double base, double height, int slices, i
  */
 void CreateFieldLinesAndDriftShells( char *Filename, Vds_ObjectInfo *ObjInfo ){
 
-    int          i, tn, ns;
+    int          i, tn, ns, o;
+    float        *fs, *fB, *fx, *fy, *fz;
 
 
     /*
@@ -210,6 +211,10 @@ void CreateFieldLinesAndDriftShells( char *Filename, Vds_ObjectInfo *ObjInfo ){
     printf( "\t# Pitch Angles: %d\n", ObjInfo->MagEphemInfo->nAlpha );
 //return;
 
+    if ( ObjInfo->MagEphemInfo->ShellI == NULL ) {
+        printf( "\t  No drift shells in file\n" );
+        return;
+    }
 printf("%d %d %d\n", ObjInfo->nPitchAngles, ObjInfo->MagEphemInfo->nShellPoints[0], ObjInfo->MagEphemInfo->nFieldPnts[0][0]);
 
 
@@ -217,6 +222,13 @@ printf("%d %d %d\n", ObjInfo->nPitchAngles, ObjInfo->MagEphemInfo->nShellPoints[
 
         for ( ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]; ns++ ) { // Loop over Shell Field Lines
 
+            /*
+             *  The lines are packed one after the other (see Lgm_MagEphemShellLines.c)
+             */
+            o  = ObjInfo->MagEphemInfo->ShellLineOffset[i][ns];
+            fs = ObjInfo->MagEphemInfo->s_gsm[i] + o; fB = ObjInfo->MagEphemInfo->Bmag[i] + o;
+            fx = ObjInfo->MagEphemInfo->x_gsm[i] + o; fy = ObjInfo->MagEphemInfo->y_gsm[i] + o; fz = ObjInfo->MagEphemInfo->z_gsm[i] + o;
+
 
             /*
              *  Create arrays that include the entire field line from footpoint
@@ -224,10 +236,10 @@ printf("%d %d %d\n", ObjInfo->nPitchAngles, ObjInfo->MagEphemInfo->nShellPoints[
              */
             ObjInfo->nPnts[i][ns] = ObjInfo->MagEphemInfo->nFieldPnts[i][ns];
             for (tn=0; tn<ObjInfo->MagEphemInfo->nFieldPnts[i][ns]; tn++ ){
-                ObjInfo->s_gsm[i][ns][tn] = ObjInfo->MagEphemInfo->s_gsm[i][ns][tn];
-                ObjInfo->x_gsm[i][ns][tn] = ObjInfo->MagEphemInfo->x_gsm[i][ns][tn];
-                ObjInfo->y_gsm[i][ns][tn] = ObjInfo->MagEphemInfo->y_gsm[i][ns][tn];
-                ObjInfo->z_gsm[i][ns][tn] = ObjInfo->MagEphemInfo->z_gsm[i][ns][tn];
+                ObjInfo->s_gsm[i][ns][tn] = fs[tn];
+                ObjInfo->x_gsm[i][ns][tn] = fx[tn];
+                ObjInfo->y_gsm[i][ns][tn] = fy[tn];
+                ObjInfo->z_gsm[i][ns][tn] = fz[tn];
             }
 
 
@@ -238,11 +250,11 @@ printf("%d %d %d\n", ObjInfo->nPitchAngles, ObjInfo->MagEphemInfo->nShellPoints[
 ///*
 int kk;
             for (kk=0, tn=0; tn<ObjInfo->MagEphemInfo->nFieldPnts[i][ns]; tn++ ){
-                if ( ( ObjInfo->MagEphemInfo->Bmag[i][ns][tn] < ObjInfo->MagEphemInfo->Bm[i]-1e-6 ) && ( ObjInfo->MagEphemInfo->Bmag[i][ns][tn] > 0.0 ) ) {
-                    ObjInfo->s2_gsm[i][ns][kk] = ObjInfo->MagEphemInfo->s_gsm[i][ns][tn];
-                    ObjInfo->x2_gsm[i][ns][kk] = ObjInfo->MagEphemInfo->x_gsm[i][ns][tn];
-                    ObjInfo->y2_gsm[i][ns][kk] = ObjInfo->MagEphemInfo->y_gsm[i][ns][tn];
-                    ObjInfo->z2_gsm[i][ns][kk] = ObjInfo->MagEphemInfo->z_gsm[i][ns][tn];
+                if ( ( fB[tn] < ObjInfo->MagEphemInfo->Bm[i]-1e-6 ) && ( fB[tn] > 0.0 ) ) {
+                    ObjInfo->s2_gsm[i][ns][kk] = fs[tn];
+                    ObjInfo->x2_gsm[i][ns][kk] = fx[tn];
+                    ObjInfo->y2_gsm[i][ns][kk] = fy[tn];
+                    ObjInfo->z2_gsm[i][ns][kk] = fz[tn];
                     ++kk;
                 }
             }
@@ -598,185 +610,148 @@ nAddShellPoints = 10; // number of points to add in between each given Shell poi
 
 
 
+/*
+ *  Level of detail settings. Level 0 is what the display lists used to
+ *  have (except for the foot/mirror point spheres, which were 30x30).
+ */
+static int FL_Stride[VDS_NLOD]    = { 1, 4 };    // use every n'th point along the field lines
+static int FL_Sides[VDS_NLOD]     = { 12, 6 };   // sides of the field line tubes
+static int Sph_Slices[VDS_NLOD]   = { 16, 6 };   // foot/mirror point spheres
+static int Sph_Stacks[VDS_NLOD]   = { 12, 4 };
+static int Shell_Stride[VDS_NLOD] = { 1, 2 };    // use every n'th field line and field point of the shell surfaces
+
+
 void GenerateDriftShellLists( Vds_ObjectInfo *ObjInfo ){
 
-    int i, p, k;
+    int         i, p, k, lod, s, n, i0, nk, ni, ii, kk;
+    double      nv[3], v[3];
+    Vds_Mesh    *m;
 
 
     /*
-     *  Create List for the Drift Shell Surfaces
+     *  Meshes for the Drift Shell Surfaces (each quad of the old
+     *  GL_QUAD_STRIPs is two triangles)
      */
-    ObjInfo->DriftShellList4 = glGenLists( ObjInfo->MagEphemInfo->nAlpha );
-
-    // Drift Shell Surfaces
     for (p=0; p<ObjInfo->MagEphemInfo->nAlpha; p++){
-
-        glNewList( ObjInfo->DriftShellList4 + p, GL_COMPILE );
-            for (i=0;i<ObjInfo->nFieldPoints[p]-1;i++) {
-                glBegin(GL_QUAD_STRIP);
-                for (k=0;k<ObjInfo->nShellPoints4;k++) {
-                //for (k=0;k<ObjInfo->nShellPoints4*3/4;k++) {
-                    glNormal3f( ObjInfo->nx4_gsm[p][k][i], ObjInfo->ny4_gsm[p][k][i], ObjInfo->nz4_gsm[p][k][i] );
-                    glVertex3f( ObjInfo->x4_gsm[p][k][i], ObjInfo->y4_gsm[p][k][i], ObjInfo->z4_gsm[p][k][i] );
-                    glNormal3f( ObjInfo->nx4_gsm[p][k][i+1], ObjInfo->ny4_gsm[p][k][i+1], ObjInfo->nz4_gsm[p][k][i+1] );
-                    glVertex3f( ObjInfo->x4_gsm[p][k][i+1], ObjInfo->y4_gsm[p][k][i+1], ObjInfo->z4_gsm[p][k][i+1] );
+        for (lod=0; lod<VDS_NLOD; lod++){
+
+            m = &ObjInfo->DriftShellMesh4[p][lod];
+            s = Shell_Stride[lod];
+            nk = ( ObjInfo->nShellPoints4 > 0 ) ? (ObjInfo->nShellPoints4-1)/s + 1 : 0;
+            ni = ( ObjInfo->nFieldPoints[p] > 0 ) ? (ObjInfo->nFieldPoints[p]-1)/s + 1 : 0;
+            if ( (nk < 2) || (ni < 2) ) continue;
+
+            i0 = m->nVerts;
+            for (n=0; n<ni; n++) {
+                ii = ( n == ni-1 ) ? ObjInfo->nFieldPoints[p]-1 : n*s;
+                for (k=0; k<nk; k++) {
+                    kk = ( k == nk-1 ) ? ObjInfo->nShellPoints4-1 : k*s;
+                    nv[0] = ObjInfo->nx4_gsm[p][kk][ii]; nv[1] = ObjInfo->ny4_gsm[p][kk][ii]; nv[2] = ObjInfo->nz4_gsm[p][kk][ii];
+                    v[0]  = ObjInfo->x4_gsm[p][kk][ii];  v[1]  = ObjInfo->y4_gsm[p][kk][ii];  v[2]  = ObjInfo->z4_gsm[p][kk][ii];
+                    Vds_Mesh_AddVertex( m, nv, v );
+                }
+            }
+            for (i=0; i<ni-1; i++) {
+                for (k=0; k<nk-1; k++) {
+                    n = i0 + i*nk + k; // vertex (i, k)
+                    Vds_Mesh_AddTriangle( m, n, n+nk, n+nk+1 );
+                    Vds_Mesh_AddTriangle( m, n, n+nk+1, n+1 );
                 }
-                glEnd();
             }
-        glEndList( );
+            Vds_Mesh_Upload( m );
 
+        }
     }
 
 }
 void ReGenerateDriftShellLists( Vds_ObjectInfo *ObjInfo ){
-    glDeleteLists( ObjInfo->DriftShellList4, ObjInfo->MagEphemInfo->nAlpha );
+    int p, lod;
+    for (p=0; p<30; p++) for (lod=0; lod<VDS_NLOD; lod++) Vds_Mesh_Free( &ObjInfo->DriftShellMesh4[p][lod] );
     GenerateDriftShellLists( ObjInfo );
 }
 
 
-void GenerateFieldLineLists( Vds_ObjectInfo *ObjInfo ){
+/*
+ *  Add the foot points and mirror points of field line ns of pitch angle i
+ *  to m.
+ */
+static void AddShellPoints( Vds_ObjectInfo *ObjInfo, int i, int ns, int lod, Vds_Mesh *m ) {
 
-    int i, ns;
+    Lgm_MagEphemInfo *e = ObjInfo->MagEphemInfo;
 
-if (1==1){
-// dont think we get these anymore...
-    /*
-     *  Create List for the Full Field Lines
-     */
-    ObjInfo->DriftShellList2 = glGenLists( ObjInfo->MagEphemInfo->nAlpha );
+    // Foot Points
+    Vds_Mesh_AddSphere( m, e->ShellSphericalFootprint_Pn[i][ns].x, e->ShellSphericalFootprint_Pn[i][ns].y, e->ShellSphericalFootprint_Pn[i][ns].z, 0.01, Sph_Slices[lod], Sph_Stacks[lod] );
+    Vds_Mesh_AddSphere( m, e->ShellSphericalFootprint_Ps[i][ns].x, e->ShellSphericalFootprint_Ps[i][ns].y, e->ShellSphericalFootprint_Ps[i][ns].z, 0.01, Sph_Slices[lod], Sph_Stacks[lod] );
 
-    // Field Lines and Foot Points
-    for (i=0; i<ObjInfo->MagEphemInfo->nAlpha; i++){
+    // Mirror Points
+    Vds_Mesh_AddSphere( m, e->ShellMirror_Pn[i][ns].x, e->ShellMirror_Pn[i][ns].y, e->ShellMirror_Pn[i][ns].z, 0.10/4.0, Sph_Slices[lod], Sph_Stacks[lod] );
+    Vds_Mesh_AddSphere( m, e->ShellMirror_Ps[i][ns].x, e->ShellMirror_Ps[i][ns].y, e->ShellMirror_Ps[i][ns].z, 0.10/4.0, Sph_Slices[lod], Sph_Stacks[lod] );
 
-        if ( ObjInfo->MagEphemInfo->Lstar[i] > 1.0 ) {
+}
 
-            glNewList( ObjInfo->DriftShellList2 + i, GL_COMPILE );
 
-            //glMaterialfv( GL_FRONT, GL_DIFFUSE, colors[i] );
-            for (ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]; ns++){
+void GenerateFieldLineLists( Vds_ObjectInfo *ObjInfo ){
 
-                // North Foot Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.01, 30, 30 ); 
-                glPopMatrix();
+    int         i, ns, lod;
+    Vds_Mesh    *m;
 
-                // South Foot Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.01, 30, 30 ); 
-                glPopMatrix();
+    for (i=0; i<ObjInfo->MagEphemInfo->nAlpha; i++){
+        for (ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]; ns++){
+            for (lod=0; lod<VDS_NLOD; lod++){
 
+                /*
+                 *  Full Field Lines and Foot Points
+                 */
+                if ( ObjInfo->MagEphemInfo->Lstar[i] > 1.0 ) {
+                    m = &ObjInfo->FieldLineMesh2[i][ns][lod];
+                    AddShellPoints( ObjInfo, i, ns, lod, m );
+                    MakeTubeMesh( ObjInfo->x_gsm[i][ns], ObjInfo->y_gsm[i][ns], ObjInfo->z_gsm[i][ns], ObjInfo->nPnts[i][ns], FL_Stride[lod], FL_Sides[lod], 0.0375/4.0, m );
+                    Vds_Mesh_Upload( m );
+                }
 
-                // Field Lines -- What is the diff between these two lines here?
-MakeTube( ObjInfo->x_gsm[i][ns], ObjInfo->y_gsm[i][ns], ObjInfo->z_gsm[i][ns], ObjInfo->nPnts[i][ns], 12, 0.0375/4.0 );
-//int ppp;
-//for ( ppp=0; ppp<ObjInfo->nPnts[i][ns]; ++ppp){
-//printf("ObjInfo->x_gsm[i][ns][ppp], ObjInfo->z_gsm[i][ns][ppp] = %g %g\n", ObjInfo->x_gsm[i][ns][ppp], ObjInfo->z_gsm[i][ns][ppp]);
-//}
-//exit(0);
-//                MakeTube( ObjInfo->x2_gsm[i][ns], ObjInfo->y2_gsm[i][ns], ObjInfo->z2_gsm[i][ns], ObjInfo->nPnts2[i][ns], 12, 0.0375/2.0 );
-//                MakeTube( ObjInfo->x3_gsm[i][ns], ObjInfo->y3_gsm[i][ns], ObjInfo->z3_gsm[i][ns], ObjInfo->nFieldPoints[i], 12, 0.0375/2.0 );
-
-
-                // North Mirror Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.10/4.0, 30, 30 ); 
-                glPopMatrix();
-
-                // South Mirror Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.10/4.0, 30, 30 ); 
-                glPopMatrix();
+                /*
+                 *  Partial Field Lines
+                 *  (I think this is all we get now out of the MagEphem files... Correct?)
+                 */
+                m = &ObjInfo->FieldLineMesh3[i][ns][lod];
+                AddShellPoints( ObjInfo, i, ns, lod, m );
+                MakeTubeMesh( ObjInfo->x3_gsm[i][ns], ObjInfo->y3_gsm[i][ns], ObjInfo->z3_gsm[i][ns], ObjInfo->nFieldPoints[i], FL_Stride[lod], FL_Sides[lod], 0.0375/2.0, m );
+                Vds_Mesh_Upload( m );
 
             }
-            glEndList( );
-
         }
     }
 
 }
 
 
-
-
-    /*
-     *  Create List for the Partial Field Lines
-     *  (I think this is all we get now out of the MagEphem files... Correct?)
-     */
-    ObjInfo->DriftShellList3 = glGenLists( ObjInfo->MagEphemInfo->nAlpha );
-
-    // Field Lines and Foot Points
-    for (i=0; i<ObjInfo->MagEphemInfo->nAlpha; i++){
-        glNewList( ObjInfo->DriftShellList3 + i, GL_COMPILE );
-
-        for (ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]; ns++){
-        //for (ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]*3/4; ns++){
-
-                // North Foot Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Pn[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.01, 30, 30 ); 
-                glPopMatrix();
-
-
-                // South Foot Points
-                glPushMatrix(); glTranslatef(ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellSphericalFootprint_Ps[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.01, 30, 30 ); 
-                glPopMatrix();
-
-
-
-                // Field Lines
-                MakeTube( ObjInfo->x3_gsm[i][ns], ObjInfo->y3_gsm[i][ns], ObjInfo->z3_gsm[i][ns], ObjInfo->nFieldPoints[i], 12, 0.0375/2.0 );
-
-
-
-                // North Mirror Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Pn[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.10/4.0, 30, 30 ); 
-                glPopMatrix();
-
-
-                // South Mirror Points
-                glPushMatrix(); 
-                glTranslatef(ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].x, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].y, 
-                             ObjInfo->MagEphemInfo->ShellMirror_Ps[i][ns].z ); 
-                Lgm_gl_draw_sphere( TRUE, 0.10/4.0, 30, 30 ); 
-                glPopMatrix();
-
+void ReGenerateFieldLineLists( Vds_ObjectInfo *ObjInfo ){
+    int i, ns, lod;
+    for (i=0; i<30; i++) {
+        for (ns=0; ns<LGM_LSTARINFO_MAX_FL; ns++) {
+            for (lod=0; lod<VDS_NLOD; lod++) {
+                Vds_Mesh_Free( &ObjInfo->FieldLineMesh2[i][ns][lod] );
+                Vds_Mesh_Free( &ObjInfo->FieldLineMesh3[i][ns][lod] );
             }
-
-
-
-        glEndList( );
+        }
     }
-
+    GenerateFieldLineLists( ObjInfo );
 }
 
 
-void ReGenerateFieldLineLists( Vds_ObjectInfo *ObjInfo ){
-    glDeleteLists( ObjInfo->DriftShellList2, ObjInfo->MagEphemInfo->nAlpha );
-    glDeleteLists( ObjInfo->DriftShellList3, ObjInfo->MagEphemInfo->nAlpha );
-    GenerateFieldLineLists( ObjInfo );
+/*
+ *  Draw the field lines of pitch angle i (Full or Mirror-to-Mirror), and
+ *  its drift shell surface p. Anything out of the view is skipped, and
+ *  small things are drawn at the coarse level of detail.
+ */
+void DrawFieldLines( Vds_ObjectInfo *ObjInfo, int i, int Full ){
+    int ns;
+    for (ns=0; ns<ObjInfo->MagEphemInfo->nShellPoints[i]; ns++){
+        Vds_Mesh_DrawLod( Full ? ObjInfo->FieldLineMesh2[i][ns] : ObjInfo->FieldLineMesh3[i][ns] );
+    }
+}
+void DrawDriftShell( Vds_ObjectInfo *ObjInfo, int p ){
+    Vds_Mesh_DrawLod( ObjInfo->DriftShellMesh4[p] );
 }
 
 
@@ -2,6 +2,7 @@
 #define VDS_DRIFT_SHELL_H
 
 #include <Lgm_MagEphemInfo.h>
+#include "Vds_Mesh.h"
 
 #define GSL_INTERP  gsl_interp_akima
 
@@ -56,9 +57,15 @@ typedef struct Vds_ObjectInfo {
 
 
     GLuint               MiscFieldLines;         //!< OpenGL Display List for Misc Field Lines
-    GLuint               DriftShellList2;        //!< OpenGL Display List for Drift Shell Field Lines (Full)
-    GLuint               DriftShellList3;        //!< OpenGL Display List for Drift Shell Field Lines (Mirror-to-Miroor)
-    GLuint               DriftShellList4;        //!< OpenGL Display List for Drift Shell Surfaces
+
+    /*
+     *  Drift shell geometry, in buffer objects, at VDS_NLOD levels of detail
+     *  (see Vds_Mesh.c). The field lines (with their foot and mirror points)
+     *  are one mesh each so they can be culled separately.
+     */
+    Vds_Mesh             FieldLineMesh2[30][LGM_LSTARINFO_MAX_FL][VDS_NLOD];   //!< Drift Shell Field Lines (Full)
+    Vds_Mesh             FieldLineMesh3[30][LGM_LSTARINFO_MAX_FL][VDS_NLOD];   //!< Drift Shell Field Lines (Mirror-to-Mirror)
+    Vds_Mesh             DriftShellMesh4[30][VDS_NLOD];                         //!< Drift Shell Surfaces
 
 
 } Vds_ObjectInfo;
@@ -78,6 +85,8 @@ void GenerateDriftShellLists( Vds_ObjectInfo *ObjInfo );
 void ReGenerateDriftShellLists( Vds_ObjectInfo *ObjInfo );
 void GenerateFieldLineLists( Vds_ObjectInfo *ObjInfo );
 void ReGenerateFieldLineLists( Vds_ObjectInfo *ObjInfo );
+void DrawFieldLines( Vds_ObjectInfo *ObjInfo, int i, int Full );
+void DrawDriftShell( Vds_ObjectInfo *ObjInfo, int p );
 
 
 #define LGM_QUAD_OBJ_INIT() { if(!lgm_quadObj) Lgm_initQuadObj(); }
@@ -0,0 +1,493 @@
+/*
+ *  Vds_MagEphemIndex.c
+ *
+ *  Opening a MagEphem file used to mean reading all of it in, which for
+ *  month-long files (and several satellites at once) took minutes and
+ *  gigabytes before anything could be drawn. Now opening one only builds a
+ *  time index:
+ *
+ *      - text files: the JD and byte offset of every row (one pass through
+ *        the file, parsing only the JD column),
+ *
+ *      - HDF5 files: the JulianDate dataset (the other datasets are read
+ *        later as hyperslabs),
+ *
+ *      - columnar (.mec) files: nothing, the JulianDate column is used in
+ *        place.
+ *
+ *  The records themselves are loaded VDS_MEI_WINDOW at a time, only when
+ *  the display time gets to them, and at most VDS_MEI_NSLOTS windows per
+ *  file are kept. Whenever the time moves, the next window in the direction
+ *  it is moving is read ahead on a worker thread, so playing or scrubbing
+ *  through time doesnt stall at window boundaries. (If the display gets
+ *  there first, the window is just read right away.)
+ *
+ *  Only the S/C position and L* are loaded (what is drawn). gzip'ed text
+ *  files cant be seeked in, so they arent indexed (the .h5 or .mec versions
+ *  can be used instead).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Vds_MagEphemIndex.h"
+
+typedef struct Vds_MagEphemJob {
+    Vds_MagEphemFile    *f;
+    long int            iWin;
+} Vds_MagEphemJob;
+
+int                 nMagEphemFiles = 0;
+Vds_MagEphemFile    *MagEphemFiles[ VDS_MEI_MAX_FILES ];
+
+static GStaticMutex IoLock = G_STATIC_MUTEX_INIT;    // the HDF5 library (and each file) is only read by one thread at a time
+static GThreadPool  *Pool  = NULL;
+
+
+/*
+ *  In a text header, find the column that the quantity Name starts in (and
+ *  its dimension). Returns -1 if it isnt there.
+ */
+static int TextColumn( char *Header, char *Name, int *Dim ) {
+
+    char    Key[128], *p, *q, *e;
+    int     Col;
+
+    sprintf( Key, "\"NAME\": \"%.100s\"", Name );
+    if ( (p = strstr( Header, Key )) == NULL ) return( -1 );
+    q = strstr( p+1, "\"NAME\":" );  // start of the next quantity's block
+
+    if ( Dim != NULL ) {
+        *Dim = 1;
+        if ( ( (e = strstr( p, "\"DIMENSION\":" )) != NULL ) && ( ( q == NULL ) || ( e < q ) ) ) sscanf( e, "\"DIMENSION\": [ %d", Dim );
+    }
+    if ( ( (e = strstr( p, "\"START_COLUMN\":" )) == NULL ) || ( ( q != NULL ) && ( e > q ) ) ) return( -1 );
+    if ( sscanf( e, "\"START_COLUMN\": %d", &Col ) != 1 ) return( -1 );
+
+    return( Col );
+
+}
+
+/*
+ *  Pull columns Col[0..n-1] (in increasing order) out of a text row.
+ */
+static int TextFields( char *Line, int n, int *Col, double *v ) {
+
+    int     c, k;
+    char    *p = Line, *e;
+
+    for ( c=0, k=0; ( k<n ) && ( *p != '\0' ); c++ ) {
+        while ( ( *p == ' ' ) || ( *p == '\t' ) ) p++;
+        if ( ( *p == '\0' ) || ( *p == '\n' ) ) break;
+        if ( c == Col[k] ) {
+            v[k++] = strtod( p, &e );
+            if ( e == p ) return( FALSE );
+            p = e;
+        } else {
+            while ( ( *p != ' ' ) && ( *p != '\t' ) && ( *p != '\n' ) && ( *p != '\0' ) ) p++;
+        }
+    }
+
+    return( k == n );
+
+}
+
+static int OpenText( Vds_MagEphemFile *f ) {
+
+    char        *Line = NULL, *Header;
+    size_t      nLine = 0, nHeader = 0, MaxHeader = 1<<16;
+    ssize_t     len;
+    off_t       Pos;
+    long int    MaxRecs = 1024;
+    int         c, Col[1];
+    double      JD;
+    unsigned char Magic[2];
+
+    if ( (f->fp = fopen( f->Filename, "r" )) == NULL ) return( FALSE );
+    if ( ( fread( Magic, 1, 2, f->fp ) == 2 ) && ( Magic[0] == 0x1f ) && ( Magic[1] == 0x8b ) ) {
+        printf( "    %s is gzip'ed, so it cant be read lazily. Gunzip it (or use the .h5 or .mec file).\n", f->Filename );
+        return( FALSE );
+    }
+    rewind( f->fp );
+    setvbuf( f->fp, NULL, _IOFBF, 1<<20 );
+
+    /*
+     *  The header says where the columns are.
+     */
+    Header = (char *)calloc( MaxHeader, 1 );
+    Pos    = ftello( f->fp );
+    while ( ( (len = getline( &Line, &nLine, f->fp )) > 0 ) && ( Line[0] == '#' ) ) {
+        if ( nHeader + len + 1 > MaxHeader ) {
+            MaxHeader = 2*(nHeader + len + 1);
+            Header = (char *)realloc( Header, MaxHeader );
+        }
+        memcpy( Header + nHeader, Line, len ); nHeader += len; Header[nHeader] = '\0';
+        Pos = ftello( f->fp );
+    }
+    f->JDCol    = TextColumn( Header, "JulianDate", NULL );
+    f->RgsmCol  = TextColumn( Header, "Rgsm", NULL );
+    f->LstarCol = TextColumn( Header, "Lstar", &f->nAlpha );
+    free( Header );
+    if ( f->JDCol    < 0 ) f->JDCol   = 4;     // the layout of Lgm_WriteMagEphemData()
+    if ( f->RgsmCol  < 0 ) f->RgsmCol = 15;
+    if ( f->LstarCol < 0 ) f->nAlpha  = 0;
+
+    /*
+     *  The index. Only the JD of each row gets parsed.
+     */
+    f->JD     = (double *)malloc( MaxRecs*sizeof(double) );
+    f->Offset = (off_t *)malloc( MaxRecs*sizeof(off_t) );
+    Col[0]    = f->JDCol;
+    c         = 0;
+    while ( len > 0 ) {
+        if ( ( Line[0] != '#' ) && TextFields( Line, 1, Col, &JD ) ) {
+            if ( f->nRecs == MaxRecs ) {
+                MaxRecs *= 2;
+                f->JD     = (double *)realloc( f->JD, MaxRecs*sizeof(double) );
+                f->Offset = (off_t *)realloc( f->Offset, MaxRecs*sizeof(off_t) );
+            }
+            f->JD[f->nRecs]     = JD;
+            f->Offset[f->nRecs] = Pos;
+            ++f->nRecs;
+        } else if ( Line[0] != '#' ) {
+            ++c;
+        }
+        Pos = ftello( f->fp );
+        len = getline( &Line, &nLine, f->fp );
+    }
+    free( Line );
+    if ( ( c > 0 ) && ( f->nRecs > 0 ) ) printf( "    %d rows of %s couldnt be read\n", c, f->Filename );
+
+    return( TRUE );
+
+}
+
+static int OpenHdf5( Vds_MagEphemFile *f ) {
+
+    hsize_t     Dims[8];
+
+    if ( !H5Fis_hdf5( f->Filename ) ) return( FALSE );
+    if ( (f->H5 = H5Fopen( f->Filename, H5F_ACC_RDONLY, H5P_DEFAULT )) < 0 ) return( FALSE );
+
+    if ( ( H5Lexists( f->H5, "JulianDate", H5P_DEFAULT ) <= 0 ) || ( Lgm_HDF5_GetDims( f->H5, "JulianDate", Dims ) != 1 ) ) {
+        H5Fclose( f->H5 ); f->H5 = -1;
+        return( FALSE );
+    }
+    f->nRecs = (long int)Dims[0];
+    f->JD    = (double *)malloc( ( f->nRecs > 0 ? f->nRecs : 1 )*sizeof(double) );
+    if ( ( f->nRecs > 0 ) && !Lgm_HDF5_ReadDoubleHyperslab( f->H5, "JulianDate", 1, NULL, NULL, f->JD ) ) f->nRecs = 0;
+
+    f->nAlpha = 0;
+    if ( H5Lexists( f->H5, "Lstar", H5P_DEFAULT ) > 0 ) {
+        if ( Lgm_HDF5_GetDims( f->H5, "Lstar", Dims ) == 2 ) f->nAlpha = (int)Dims[1];
+    }
+
+    return( TRUE );
+
+}
+
+static int OpenMec( Vds_MagEphemFile *f ) {
+
+    int     Width;
+
+    if ( (f->mec = Lgm_OpenMagEphemCol( f->Filename )) == NULL ) return( FALSE );
+    if ( Lgm_GetMagEphemColumn( f->mec, "JulianDate", 'd', &Width ) == NULL ) {
+        Lgm_CloseMagEphemCol( f->mec ); f->mec = NULL;
+        return( FALSE );
+    }
+    if ( Lgm_GetMagEphemColumn( f->mec, "Lstar", 'd', &Width ) != NULL ) f->nAlpha = Width;
+    f->nRecs = f->mec->nRows;
+
+    return( TRUE );
+
+}
+
+static void FreeFile( Vds_MagEphemFile *f ) {
+
+    int     s;
+
+    if ( f->fp  != NULL ) fclose( f->fp );
+    if ( f->H5   > 0 )    H5Fclose( f->H5 );
+    if ( f->mec != NULL ) Lgm_CloseMagEphemCol( f->mec );
+    for ( s=0; s<VDS_MEI_NSLOTS; s++ ) {
+        free( f->Slot[s].Rgsm );
+        free( f->Slot[s].Lstar );
+    }
+    if ( f->Format != VDS_MEI_MEC ) free( f->JD );
+    free( f->Offset );
+    free( f->NowLstar );
+    free( f->Filename );
+    if ( f->Lock != NULL ) g_mutex_free( f->Lock );
+    free( f );
+
+}
+
+static void Unref( Vds_MagEphemFile *f ) {
+    if ( g_atomic_int_dec_and_test( &f->Refs ) ) FreeFile( f );
+}
+
+
+/*
+ *  Build the index of a MagEphem file (any of the three formats). Returns
+ *  NULL if it isnt one.
+ */
+Vds_MagEphemFile *Vds_MagEphem_Open( char *Filename ) {
+
+    int                 s, ok, Width;
+    Vds_MagEphemFile    *f = (Vds_MagEphemFile *)calloc( 1, sizeof(Vds_MagEphemFile) );
+
+    f->Filename = strdup( Filename );
+    f->H5       = -1;
+    f->Refs     = 1;
+    f->Pending  = -1;
+    for ( s=0; s<VDS_MEI_NSLOTS; s++ ) f->Slot[s].iWin = -1;
+
+    g_static_mutex_lock( &IoLock );
+    if      ( (ok = OpenMec( f )) )   f->Format = VDS_MEI_MEC;
+    else if ( (ok = OpenHdf5( f )) )  f->Format = VDS_MEI_HDF5;
+    else if ( (ok = OpenText( f )) )  f->Format = VDS_MEI_TEXT;
+    if ( ok && ( f->Format == VDS_MEI_MEC ) ) f->JD = (double *)Lgm_GetMagEphemColumn( f->mec, "JulianDate", 'd', &Width );
+    g_static_mutex_unlock( &IoLock );
+
+    if ( !ok || ( f->nRecs < 1 ) ) {
+        FreeFile( f );
+        return( NULL );
+    }
+
+    f->Lock     = g_mutex_new();
+    f->NowLstar = (double *)calloc( f->nAlpha > 0 ? f->nAlpha : 1, sizeof(double) );
+    f->LastJD   = f->JD[0];
+
+    return( f );
+
+}
+
+/*
+ *  The display is done with f. (It goes away once any read-ahead that is
+ *  still queued for it is finished.)
+ */
+void Vds_MagEphem_Close( Vds_MagEphemFile *f ) {
+    if ( f != NULL ) Unref( f );
+}
+
+
+/*
+ *  Read window iWin into Rgsm and Lstar (freshly allocated).
+ */
+static int ReadWindow( Vds_MagEphemFile *f, long int iWin, Lgm_Vector **pRgsm, double **pLstar ) {
+
+    long int    i0 = iWin*VDS_MEI_WINDOW, n = f->nRecs - i0, i, k;
+    int         a, Width, nCol, *Col, ok = TRUE;
+    hsize_t     Start[2], Count[2];
+    double      *v, *Src;
+    char        *Line = NULL;
+    size_t      nLine = 0;
+    Lgm_Vector  *Rgsm;
+    double      *Lstar;
+
+    if ( n > VDS_MEI_WINDOW ) n = VDS_MEI_WINDOW;
+    Rgsm  = (Lgm_Vector *)calloc( VDS_MEI_WINDOW, sizeof(Lgm_Vector) );
+    Lstar = (double *)calloc( VDS_MEI_WINDOW*( f->nAlpha > 0 ? f->nAlpha : 1 ), sizeof(double) );
+
+    g_static_mutex_lock( &IoLock );
+    switch ( f->Format ) {
+
+        case VDS_MEI_MEC:
+            if ( (Src = (double *)Lgm_GetMagEphemColumn( f->mec, "Rgsm", 'd', &Width )) != NULL ) memcpy( Rgsm, Src + i0*3, n*3*sizeof(double) );
+            if ( ( f->nAlpha > 0 ) && ( (Src = (double *)Lgm_GetMagEphemColumn( f->mec, "Lstar", 'd', &Width )) != NULL ) ) memcpy( Lstar, Src + i0*f->nAlpha, n*f->nAlpha*sizeof(double) );
+            break;
+
+        case VDS_MEI_HDF5:
+            Start[0] = i0; Start[1] = 0; Count[0] = n; Count[1] = 3;
+            ok = Lgm_HDF5_ReadDoubleHyperslab( f->H5, "Rgsm", 2, Start, Count, &Rgsm[0].x );
+            if ( ok && ( f->nAlpha > 0 ) ) {
+                Count[1] = f->nAlpha;
+                ok = Lgm_HDF5_ReadDoubleHyperslab( f->H5, "Lstar", 2, Start, Count, Lstar );
+            }
+            break;
+
+        case VDS_MEI_TEXT:
+            nCol = 3 + f->nAlpha;
+            Col  = (int *)malloc( nCol*sizeof(int) );
+            v    = (double *)malloc( nCol*sizeof(double) );
+            for ( a=0; a<3; a++ )         Col[a]   = f->RgsmCol + a;
+            for ( a=0; a<f->nAlpha; a++ ) Col[3+a] = f->LstarCol + a;
+            fseeko( f->fp, f->Offset[i0], SEEK_SET );
+            for ( i=0; i<n; i++ ) {
+                if ( ftello( f->fp ) != f->Offset[i0+i] ) fseeko( f->fp, f->Offset[i0+i], SEEK_SET ); // (skips the rows that werent indexed)
+                if ( getline( &Line, &nLine, f->fp ) <= 0 ) { ok = FALSE; break; }
+                if ( !TextFields( Line, nCol, Col, v ) ) continue;
+                Rgsm[i].x = v[0]; Rgsm[i].y = v[1]; Rgsm[i].z = v[2];
+                for ( k=0; k<f->nAlpha; k++ ) Lstar[i*f->nAlpha+k] = v[3+k];
+            }
+            free( Line ); free( Col ); free( v );
+            break;
+
+    }
+    g_static_mutex_unlock( &IoLock );
+    if ( !ok ) printf( "    Could not read records %ld-%ld of %s\n", i0, i0+n-1, f->Filename );
+
+    *pRgsm = Rgsm; *pLstar = Lstar;
+    return( ok );
+
+}
+
+/*
+ *  Slot holding window iWin, or -1. Call with f->Lock held.
+ */
+static int FindSlot( Vds_MagEphemFile *f, long int iWin ) {
+
+    int s;
+
+    for ( s=0; s<VDS_MEI_NSLOTS; s++ ) if ( f->Slot[s].iWin == iWin ) return( s );
+    return( -1 );
+
+}
+
+/*
+ *  Make sure window iWin is loaded. Returns its slot, with f->Lock held.
+ */
+static int LoadWindow( Vds_MagEphemFile *f, long int iWin ) {
+
+    int         s, v;
+    Lgm_Vector  *Rgsm;
+    double      *Lstar;
+
+    g_mutex_lock( f->Lock );
+    if ( (s = FindSlot( f, iWin )) >= 0 ) return( s );
+    g_mutex_unlock( f->Lock );
+
+    ReadWindow( f, iWin, &Rgsm, &Lstar );
+
+    g_mutex_lock( f->Lock );
+    if ( (s = FindSlot( f, iWin )) >= 0 ) { // someone else got it in the meantime
+        free( Rgsm ); free( Lstar );
+        return( s );
+    }
+    for ( s=0, v=1; v<VDS_MEI_NSLOTS; v++ ) if ( f->Slot[v].Used < f->Slot[s].Used ) s = v;   // least recently used
+    free( f->Slot[s].Rgsm ); free( f->Slot[s].Lstar );
+    f->Slot[s].iWin  = iWin;
+    f->Slot[s].Rgsm  = Rgsm;
+    f->Slot[s].Lstar = Lstar;
+    f->Slot[s].Used  = ++f->Tick;
+
+    return( s );
+
+}
+
+static void GetRecord( Vds_MagEphemFile *f, long int i, Lgm_Vector *Rgsm, double *Lstar ) {
+
+    int     s = LoadWindow( f, i/VDS_MEI_WINDOW );
+    long    k = i%VDS_MEI_WINDOW;
+
+    f->Slot[s].Used = ++f->Tick;
+    *Rgsm = f->Slot[s].Rgsm[k];
+    if ( f->nAlpha > 0 ) memcpy( Lstar, f->Slot[s].Lstar + k*f->nAlpha, f->nAlpha*sizeof(double) );
+    g_mutex_unlock( f->Lock );
+
+}
+
+
+static void Vds_MagEphem_Worker( gpointer data, gpointer user_data ) {
+
+    Vds_MagEphemJob *j = (Vds_MagEphemJob *)data;
+
+    if ( g_atomic_int_get( &j->f->Refs ) > 1 ) { // dont bother if the display is done with it
+        LoadWindow( j->f, j->iWin );
+        g_mutex_unlock( j->f->Lock );
+    }
+    g_atomic_int_set( &j->f->Pending, -1 );
+    Unref( j->f );
+    free( j );
+
+}
+
+static void ReadAhead( Vds_MagEphemFile *f, long int iWin ) {
+
+    int             Loaded;
+    Vds_MagEphemJob *j;
+
+    if ( ( iWin < 0 ) || ( iWin > (f->nRecs-1)/VDS_MEI_WINDOW ) ) return;
+    if ( g_atomic_int_get( &f->Pending ) >= 0 ) return;    // one at a time per file
+
+    g_mutex_lock( f->Lock );
+    Loaded = ( FindSlot( f, iWin ) >= 0 );
+    g_mutex_unlock( f->Lock );
+    if ( Loaded ) return;
+
+    if ( Pool == NULL ) Pool = g_thread_pool_new( Vds_MagEphem_Worker, NULL, 1, FALSE, NULL );
+    j = (Vds_MagEphemJob *)calloc( 1, sizeof(Vds_MagEphemJob) );
+    j->f = f; j->iWin = iWin;
+    g_atomic_int_inc( &f->Refs );
+    g_atomic_int_set( &f->Pending, (gint)iWin );
+    g_thread_pool_push( Pool, j, NULL );
+
+}
+
+
+/*
+ *  Set f->Now* to the values at JD (interpolated between the records on
+ *  either side). Returns FALSE (and sets f->NowValid FALSE) if JD is outside
+ *  the file.
+ */
+int Vds_MagEphem_At( Vds_MagEphemFile *f, double JD ) {
+
+    long int    i, lo, hi, n = f->nRecs;
+    int         a;
+    double      t, *L0, *L1;
+    Lgm_Vector  R0, R1;
+
+    f->NowValid = FALSE;
+    if ( ( JD < f->JD[0] ) || ( JD > f->JD[n-1] ) ) return( FALSE );
+
+    /*
+     *  JD[i] <= JD <= JD[i+1]. Start from where we were last time (the time
+     *  usually only moves a step), otherwise bisect.
+     */
+    i = f->iLast;
+    if ( ( i < n-1 ) && ( f->JD[i] <= JD ) && ( JD <= f->JD[i+1] ) ) {
+    } else if ( ( i+1 < n-1 ) && ( f->JD[i+1] <= JD ) && ( JD <= f->JD[i+2] ) ) {
+        ++i;
+    } else if ( ( i > 0 ) && ( i < n ) && ( f->JD[i-1] <= JD ) && ( JD <= f->JD[i] ) ) {
+        --i;
+    } else {
+        for ( lo=0, hi=n-1; hi-lo > 1; ) {
+            i = (lo+hi)/2;
+            if ( f->JD[i] <= JD ) lo = i; else hi = i;
+        }
+        i = lo;
+    }
+    if ( i > n-2 ) i = ( n > 1 ) ? n-2 : 0;
+    f->iLast = i;
+
+    L0 = (double *)malloc( 2*( f->nAlpha > 0 ? f->nAlpha : 1 )*sizeof(double) );
+    L1 = L0 + ( f->nAlpha > 0 ? f->nAlpha : 1 );
+    GetRecord( f, i, &R0, L0 );
+    if ( n > 1 ) {
+        GetRecord( f, i+1, &R1, L1 );
+        t = ( f->JD[i+1] > f->JD[i] ) ? ( JD - f->JD[i] )/( f->JD[i+1] - f->JD[i] ) : 0.0;
+    } else {
+        R1 = R0; memcpy( L1, L0, f->nAlpha*sizeof(double) );
+        t = 0.0;
+    }
+
+    f->NowJD     = JD;
+    f->NowRgsm.x = R0.x + t*(R1.x - R0.x);
+    f->NowRgsm.y = R0.y + t*(R1.y - R0.y);
+    f->NowRgsm.z = R0.z + t*(R1.z - R0.z);
+    for ( a=0; a<f->nAlpha; a++ ) {
+        // fill values (L* < 0) arent interpolated across
+        f->NowLstar[a] = ( ( L0[a] > 0.0 ) && ( L1[a] > 0.0 ) ) ? L0[a] + t*(L1[a] - L0[a]) : ( ( t < 0.5 ) ? L0[a] : L1[a] );
+    }
+    f->NowValid = TRUE;
+    free( L0 );
+
+    /*
+     *  Get the next window in the direction the time is going.
+     */
+    ReadAhead( f, i/VDS_MEI_WINDOW + ( ( JD >= f->LastJD ) ? 1 : -1 ) );
+    f->LastJD = JD;
+
+    return( TRUE );
+
+}
@@ -0,0 +1,81 @@
+#ifndef VDS_MAGEPHEM_INDEX_H
+#define VDS_MAGEPHEM_INDEX_H
+
+#include <glib.h>
+#include <Lgm/Lgm_Vec.h>
+#include <Lgm/Lgm_MagEphemInfo.h>
+#include <Lgm/Lgm_MagEphemCol.h>
+
+
+/*
+ *  MagEphem files (text, HDF5 or columnar) opened for display, with only the
+ *  records around the display time in memory. See Vds_MagEphemIndex.c.
+ */
+#define VDS_MEI_WINDOW      1024    //!< Records per window (the unit that gets loaded).
+#define VDS_MEI_NSLOTS      4       //!< Windows kept in memory per file.
+#define VDS_MEI_MAX_FILES   64      //!< Most MagEphem files that can be open at once.
+
+#define VDS_MEI_TEXT        0
+#define VDS_MEI_HDF5        1
+#define VDS_MEI_MEC         2
+
+
+typedef struct Vds_MagEphemWindow {
+
+    long int            iWin;       //!< Which window this is (records iWin*VDS_MEI_WINDOW on), or -1 if the slot is empty.
+    long int            Used;       //!< When it was last used (for picking which one to drop).
+    Lgm_Vector          *Rgsm;      //!< [VDS_MEI_WINDOW] S/C positions (GSM, Re).
+    double              *Lstar;     //!< [VDS_MEI_WINDOW][nAlpha] L* values.
+
+} Vds_MagEphemWindow;
+
+
+typedef struct Vds_MagEphemFile {
+
+    char                *Filename;
+    int                 Format;     //!< VDS_MEI_TEXT, VDS_MEI_HDF5 or VDS_MEI_MEC.
+    int                 nAlpha;
+
+    /*
+     *  The index (built on open).
+     */
+    long int            nRecs;
+    double              *JD;        //!< [nRecs] Julian Date of every record.
+    off_t               *Offset;    //!< [nRecs] Byte offset of every row (text only).
+    int                 JDCol, RgsmCol, LstarCol;  //!< Columns of the quantities in a text row.
+
+    FILE                *fp;        //!< text
+    hid_t               H5;         //!< HDF5
+    Lgm_MagEphemColFile *mec;       //!< columnar
+
+    /*
+     *  What is loaded, and what is coming.
+     */
+    GMutex              *Lock;      //!< Protects the slots.
+    Vds_MagEphemWindow  Slot[VDS_MEI_NSLOTS];
+    long int            Tick;
+    volatile gint       Pending;    //!< Window being read ahead (or -1).
+    volatile gint       Refs;       //!< The display plus any queued read-aheads.
+    long int            iLast;      //!< Record found last time (where the search starts).
+    double              LastJD;
+
+    /*
+     *  The values at the display time (see Vds_MagEphem_At()).
+     */
+    int                 NowValid;
+    double              NowJD;
+    Lgm_Vector          NowRgsm;
+    double              *NowLstar;  //!< [nAlpha]
+
+} Vds_MagEphemFile;
+
+
+Vds_MagEphemFile   *Vds_MagEphem_Open( char *Filename );
+void                Vds_MagEphem_Close( Vds_MagEphemFile *f );
+int                 Vds_MagEphem_At( Vds_MagEphemFile *f, double JD );
+
+extern int                  nMagEphemFiles;
+extern Vds_MagEphemFile     *MagEphemFiles[ VDS_MEI_MAX_FILES ];
+
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ *  Vds_Mesh.c
+ *
+ *  Geometry for the drift shells (field line tubes, foot/mirror point spheres
+ *  and shell surfaces) used to be compiled into display lists with
+ *  glBegin()/glVertex(). With lots of pitch angles that is millions of
+ *  vertices re-sent every frame. Here the geometry is built once into an
+ *  indexed triangle mesh, uploaded into buffer objects, and each frame only
+ *  the meshes that are in the view frustum are drawn -- at a coarser level
+ *  of detail when they are small on the screen (see Vds_Mesh_DrawLod()).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Vds_Mesh.h"
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+
+void Vds_Mesh_Init( Vds_Mesh *m ) {
+
+    m->nVerts   = m->nVertsAlloced   = 0; m->Verts   = NULL;
+    m->nIndices = m->nIndicesAlloced = 0; m->Indices = NULL;
+    m->VertBuf  = m->IndexBuf = 0;
+    m->Center[0] = m->Center[1] = m->Center[2] = 0.0;
+    m->Radius   = 0.0;
+
+}
+
+
+void Vds_Mesh_Free( Vds_Mesh *m ) {
+
+    if ( m->VertBuf )  glDeleteBuffers( 1, &m->VertBuf );
+    if ( m->IndexBuf ) glDeleteBuffers( 1, &m->IndexBuf );
+    free( m->Verts );
+    free( m->Indices );
+    Vds_Mesh_Init( m );
+
+}
+
+
+/*
+ *  Add a vertex (with normal n) and return its index.
+ */
+int Vds_Mesh_AddVertex( Vds_Mesh *m, double *n, double *v ) {
+
+    GLfloat *p;
+
+    if ( m->nVerts >= m->nVertsAlloced ) {
+        m->nVertsAlloced = ( m->nVertsAlloced > 0 ) ? 2*m->nVertsAlloced : 1024;
+        m->Verts = (GLfloat *)realloc( m->Verts, 6*m->nVertsAlloced*sizeof(GLfloat) );
+    }
+    p = &m->Verts[6*m->nVerts];
+    p[0] = n[0]; p[1] = n[1]; p[2] = n[2];
+    p[3] = v[0]; p[4] = v[1]; p[5] = v[2];
+
+    return( m->nVerts++ );
+
+}
+
+
+void Vds_Mesh_AddTriangle( Vds_Mesh *m, int a, int b, int c ) {
+
+    if ( m->nIndices+3 > m->nIndicesAlloced ) {
+        m->nIndicesAlloced = ( m->nIndicesAlloced > 0 ) ? 2*m->nIndicesAlloced : 3072;
+        m->Indices = (GLuint *)realloc( m->Indices, m->nIndicesAlloced*sizeof(GLuint) );
+    }
+    m->Indices[m->nIndices++] = a;
+    m->Indices[m->nIndices++] = b;
+    m->Indices[m->nIndices++] = c;
+
+}
+
+
+/*
+ *  Add a sphere of radius r centered on (x, y, z). (Replaces gluSphere()
+ *  calls, which cant go into a buffer object.)
+ */
+void Vds_Mesh_AddSphere( Vds_Mesh *m, double x, double y, double z, double r, int slices, int stacks ) {
+
+    int     i, j, k, i0;
+    double  Theta, Phi, n[3], v[3];
+
+    i0 = m->nVerts;
+    for ( i=0; i<=stacks; i++ ) {
+        Theta = M_PI*(double)i/(double)stacks;
+        for ( j=0; j<=slices; j++ ) {
+            Phi = 2.0*M_PI*(double)j/(double)slices;
+            n[0] = sin( Theta )*cos( Phi ); n[1] = sin( Theta )*sin( Phi ); n[2] = cos( Theta );
+            v[0] = x + r*n[0]; v[1] = y + r*n[1]; v[2] = z + r*n[2];
+            Vds_Mesh_AddVertex( m, n, v );
+        }
+    }
+
+    // counter-clockwise seen from outside
+    for ( i=0; i<stacks; i++ ) {
+        for ( j=0; j<slices; j++ ) {
+            k = i0 + i*(slices+1) + j;
+            Vds_Mesh_AddTriangle( m, k, k+slices+1, k+slices+2 );
+            Vds_Mesh_AddTriangle( m, k, k+slices+2, k+1 );
+        }
+    }
+
+}
+
+
+/*
+ *  Work out the bounding sphere and copy the mesh into buffer objects. The
+ *  client side copy isnt needed after that, so it is freed.
+ */
+void Vds_Mesh_Upload( Vds_Mesh *m ) {
+
+    int     i, k;
+    double  Min[3], Max[3], d, r2 = 0.0;
+
+    if ( m->nVerts == 0 ) return;
+
+    for ( k=0; k<3; k++ ) Min[k] = Max[k] = m->Verts[3+k];
+    for ( i=1; i<m->nVerts; i++ ) {
+        for ( k=0; k<3; k++ ) {
+            if ( m->Verts[6*i+3+k] < Min[k] ) Min[k] = m->Verts[6*i+3+k];
+            if ( m->Verts[6*i+3+k] > Max[k] ) Max[k] = m->Verts[6*i+3+k];
+        }
+    }
+    for ( k=0; k<3; k++ ) m->Center[k] = 0.5*( Min[k] + Max[k] );
+    for ( i=0; i<m->nVerts; i++ ) {
+        for ( d=0.0, k=0; k<3; k++ ) d += ( m->Verts[6*i+3+k] - m->Center[k] )*( m->Verts[6*i+3+k] - m->Center[k] );
+        if ( d > r2 ) r2 = d;
+    }
+    m->Radius = sqrt( r2 );
+
+    // without buffer objects (old GL), just keep drawing from the client arrays
+    if ( !GLEW_VERSION_1_5 ) return;
+
+    glGenBuffers( 1, &m->VertBuf );
+    glBindBuffer( GL_ARRAY_BUFFER, m->VertBuf );
+    glBufferData( GL_ARRAY_BUFFER, 6*m->nVerts*sizeof(GLfloat), m->Verts, GL_STATIC_DRAW );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    glGenBuffers( 1, &m->IndexBuf );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m->IndexBuf );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, m->nIndices*sizeof(GLuint), m->Indices, GL_STATIC_DRAW );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+    free( m->Verts );   m->Verts   = NULL; m->nVertsAlloced   = 0;
+    free( m->Indices ); m->Indices = NULL; m->nIndicesAlloced = 0;
+
+}
+
+
+void Vds_Mesh_Draw( Vds_Mesh *m ) {
+
+    if ( m->nIndices == 0 ) return;
+
+    glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT );
+    if ( m->VertBuf ) {
+        glBindBuffer( GL_ARRAY_BUFFER, m->VertBuf );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m->IndexBuf );
+        glInterleavedArrays( GL_N3F_V3F, 0, NULL );
+        glDrawElements( GL_TRIANGLES, m->nIndices, GL_UNSIGNED_INT, NULL );
+        glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    } else if ( m->Verts != NULL ) {
+        glInterleavedArrays( GL_N3F_V3F, 0, m->Verts );
+        glDrawElements( GL_TRIANGLES, m->nIndices, GL_UNSIGNED_INT, m->Indices );
+    }
+    glPopClientAttrib( );
+
+}
+
+
+/*
+ *  Draw a mesh that hasnt been uploaded with glBegin()/glEnd(), e.g. while
+ *  compiling a display list.
+ */
+void Vds_Mesh_DrawImmediate( Vds_Mesh *m ) {
+
+    int     i;
+    GLfloat *p;
+
+    if ( m->Verts == NULL ) return;
+
+    glBegin( GL_TRIANGLES );
+    for ( i=0; i<m->nIndices; i++ ) {
+        p = &m->Verts[6*m->Indices[i]];
+        glNormal3fv( p ); glVertex3fv( p+3 );
+    }
+    glEnd( );
+
+}
+
+
+/*
+ *  Is any of the mesh's bounding sphere inside the view frustum (with the
+ *  current modelview and projection matrices)? Also returns the distance
+ *  from the eye to the center of the sphere (in the mesh's units).
+ */
+int Vds_Mesh_Visible( Vds_Mesh *m, double *Distance ) {
+
+    int         i, j, k;
+    GLdouble    M[16], P[16], C[16];
+    double      e[3], Scale, Plane[4], d;
+
+    if ( m->nIndices == 0 ) return( FALSE );
+
+    glGetDoublev( GL_MODELVIEW_MATRIX,  M );
+    glGetDoublev( GL_PROJECTION_MATRIX, P );
+
+    // eye space center, and the scale of the modelview (if any)
+    for ( i=0; i<3; i++ ) e[i] = M[i]*m->Center[0] + M[4+i]*m->Center[1] + M[8+i]*m->Center[2] + M[12+i];
+    Scale = sqrt( M[0]*M[0] + M[1]*M[1] + M[2]*M[2] );
+    *Distance = sqrt( e[0]*e[0] + e[1]*e[1] + e[2]*e[2] )/Scale;
+
+    // clip = P*M (column major)
+    for ( j=0; j<4; j++ ) {
+        for ( i=0; i<4; i++ ) {
+            for ( C[4*j+i] = 0.0, k=0; k<4; k++ ) C[4*j+i] += P[4*k+i]*M[4*j+k];
+        }
+    }
+
+    // the six planes are row 3 +/- rows 0, 1 and 2 of the clip matrix
+    for ( k=0; k<6; k++ ) {
+        for ( j=0; j<4; j++ ) Plane[j] = C[4*j+3] + ( (k%2) ? -1.0 : 1.0 )*C[4*j+k/2];
+        d = sqrt( Plane[0]*Plane[0] + Plane[1]*Plane[1] + Plane[2]*Plane[2] );
+        if ( Plane[0]*m->Center[0] + Plane[1]*m->Center[1] + Plane[2]*m->Center[2] + Plane[3] < -m->Radius*d ) return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Draw one of the VDS_NLOD levels of detail in Lod[] (which all cover the
+ *  same thing), or nothing if it is out of the view.
+ */
+void Vds_Mesh_DrawLod( Vds_Mesh *Lod ) {
+
+    double  Distance;
+
+    if ( !Vds_Mesh_Visible( &Lod[0], &Distance ) ) return;
+    Vds_Mesh_Draw( &Lod[ ( Lod[0].Radius < VDS_LOD_RATIO*Distance ) ? VDS_NLOD-1 : 0 ] );
+
+}
@@ -0,0 +1,49 @@
+#ifndef VDS_MESH_H
+#define VDS_MESH_H
+
+#include <GL/glew.h>
+
+
+#define VDS_NLOD        2       //!< Number of levels of detail kept for the drift shell geometry (0 is the finest).
+#define VDS_LOD_RATIO   0.08    //!< Use the coarse level when an object's radius is less than this fraction of its distance from the eye.
+
+
+/*
+ *  Indexed triangle mesh that gets uploaded once into buffer objects and
+ *  then drawn from there (instead of being re-sent vertex by vertex from a
+ *  display list). See Vds_Mesh.c.
+ */
+typedef struct Vds_Mesh {
+
+    int         nVerts;                 //!< Number of vertices.
+    int         nVertsAlloced;          //!< Number of vertices there is room for in Verts.
+    GLfloat     *Verts;                 //!< Interleaved normals and vertices (GL_N3F_V3F), 6 floats per vertex. Freed once uploaded.
+
+    int         nIndices;               //!< Number of indices (3 per triangle).
+    int         nIndicesAlloced;        //!< Number of indices there is room for in Indices.
+    GLuint      *Indices;               //!< Triangle indices. Freed once uploaded.
+
+    GLuint      VertBuf;                //!< Vertex buffer object (0 until uploaded).
+    GLuint      IndexBuf;               //!< Index buffer object (0 until uploaded).
+
+    double      Center[3];              //!< Center of the bounding sphere (used for culling and LOD).
+    double      Radius;                 //!< Radius of the bounding sphere.
+
+} Vds_Mesh;
+
+
+void    Vds_Mesh_Init( Vds_Mesh *m );
+void    Vds_Mesh_Free( Vds_Mesh *m );
+int     Vds_Mesh_AddVertex( Vds_Mesh *m, double *n, double *v );
+void    Vds_Mesh_AddTriangle( Vds_Mesh *m, int a, int b, int c );
+void    Vds_Mesh_AddSphere( Vds_Mesh *m, double x, double y, double z, double r, int slices, int stacks );
+void    Vds_Mesh_Upload( Vds_Mesh *m );
+void    Vds_Mesh_Draw( Vds_Mesh *m );
+void    Vds_Mesh_DrawImmediate( Vds_Mesh *m );
+int     Vds_Mesh_Visible( Vds_Mesh *m, double *Distance );
+void    Vds_Mesh_DrawLod( Vds_Mesh *Lod );
+
+void    MakeTubeMesh( double *X, double *Y, double *Z, int NumCurvePoints, int Stride, int NumCirclePoints, double TubeRadius, Vds_Mesh *m );
+
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ *  Vds_SatTracks.c
+ *
+ *  Propagating the orbits and streaks of all of the drawn satellites (up to
+ *  10000 SGP4 steps and coordinate transforms each) used to be done on the
+ *  GUI thread every time the time changed, which froze the interface while
+ *  scrubbing through time. Now each request is handed to a small pool of
+ *  worker threads in two passes:
+ *
+ *      - a coarse one (about 8 times fewer points) which is done and shown
+ *        quickly, and
+ *
+ *      - the full one, which replaces it when it is done.
+ *
+ *  A request that is still waiting in the queue when a newer one comes in is
+ *  dropped, and a full pass that is superseded while it is running stops
+ *  early. The results are handed back to the GUI thread (which builds the
+ *  display list from them) with g_idle_add(), and only if nothing newer has
+ *  been shown already.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <Lgm/Lgm_CTrans.h>
+#include "Vds_SatTracks.h"
+
+#define VDS_MAX_ORBIT_PNTS      10000
+#define VDS_MAX_STREAK_PNTS     1000
+#define VDS_STREAK_FRAC         0.125   // streaks go back this fraction of an orbit
+#define VDS_COARSE_FACTOR       8.0     // coarse tracks use this much bigger steps
+
+
+static volatile gint    Generation      = 0;    // latest request
+static gint             ShownGeneration = -1;   // what the GUI has got (only touched on the GUI thread)
+static int              ShownCoarse     = FALSE;
+static GThreadPool      *Pool           = NULL;
+static void             (*ReadyFunc)( Vds_SatTracks * ) = NULL;
+
+
+/*
+ *  Copy what is needed of the satellites that have something to draw.
+ */
+static Vds_SatTracks *Vds_SatTracks_Snapshot( double JD, int ConvertFlag, int Coarse, gint Gen ) {
+
+    int             i, n;
+    _GroupNode      *g;
+    _SpaceObjectItem *Sat;
+    Vds_SatTracks   *t = (Vds_SatTracks *)calloc( 1, sizeof(Vds_SatTracks) );
+
+    t->Generation  = Gen;
+    t->Coarse      = Coarse;
+    t->JD          = JD;
+    t->ConvertFlag = ConvertFlag;
+
+    for ( n=0, g = SatSelectorInfo->SatGroupList; g != NULL; g = g->Next ) {
+        if ( g->Group->DrawGroup ) n += g->Group->nSat;
+    }
+    t->Track = (Vds_SatTrack *)calloc( n > 0 ? n : 1, sizeof(Vds_SatTrack) );
+
+    for ( g = SatSelectorInfo->SatGroupList; g != NULL; g = g->Next ) {
+        if ( !g->Group->DrawGroup ) continue;
+        for ( i=0; i<g->Group->nSat; i++ ) {
+            Sat = &g->Group->Sat[i];
+            if ( Sat->Draw && ( Sat->DrawOrbit || Sat->DrawGroundPathOfOrbit || Sat->DrawOrbitToGroundLines
+                                || Sat->DrawStreak || Sat->DrawGroundPathOfStreak || Sat->DrawStreakToGroundLines ) ) {
+                t->Track[t->n++].Sat = *Sat;
+            }
+        }
+    }
+
+    return( t );
+
+}
+
+
+void Vds_SatTracks_Free( Vds_SatTracks *t ) {
+
+    int i;
+
+    if ( t == NULL ) return;
+    for ( i=0; i<t->n; i++ ) {
+        free( t->Track[i].Orbit );
+        free( t->Track[i].Streak );
+    }
+    free( t->Track );
+    free( t );
+
+}
+
+
+/*
+ *  Propagate from dt = dt0 back to dt = dt1 (minutes from t->JD), with steps
+ *  that keep the angle between points (as seen from the Earth) between
+ *  ThetaMin and ThetaMax degrees.
+ */
+static int Vds_SatTracks_Propagate( Vds_SatTracks *t, _SgpInfo *s, Lgm_CTrans *c, _SgpTLE *TLE, double dt0, double dt1, double tinc,
+                                    double ThetaMin, double ThetaMax, int nMax, Lgm_Vector *U ) {
+
+    int         n, tYear, tMonth, tDay;
+    long int    tDate;
+    double      tsince0, dt, tJD, tUT, Theta;
+    Lgm_Vector  Ugei, aa, bb;
+
+    LgmSgp_SGP4_Init( s, TLE );
+    tsince0 = (t->JD - TLE->JD)*1440.0;
+
+    for ( n=0, dt=dt0; ( dt >= dt1 ) && ( n < nMax ); n++, dt -= tinc ) {
+        LgmSgp_SGP4( tsince0+dt, s );
+        Ugei.x = s->X/Re; Ugei.y = s->Y/Re; Ugei.z = s->Z/Re;
+        tJD = t->JD + dt/1440.0;
+        Lgm_jd_to_ymdh( tJD, &tDate, &tYear, &tMonth, &tDay, &tUT );
+        Lgm_Set_Coord_Transforms( tDate, tUT, c );
+        Lgm_Convert_Coords( &Ugei, &U[n], t->ConvertFlag, c );
+
+        bb = U[n]; Lgm_NormalizeVector( &bb );
+        if ( n > 0 ) {
+            Theta = DegPerRad * acos( fabs(Lgm_DotProduct( &aa, &bb )) );
+            if (Theta > ThetaMax) tinc *= 0.61803398875;
+            if (Theta < ThetaMin) tinc *= 1.61803398875;
+        }
+        aa = bb;
+    }
+
+    return( n );
+
+}
+
+
+/*
+ *  Work out the tracks. Returns FALSE if a full pass was superseded
+ *  part way through.
+ */
+static int Vds_SatTracks_Compute( Vds_SatTracks *t ) {
+
+    int             i, n;
+    double          period, f;
+    Lgm_Vector      *U = (Lgm_Vector *)calloc( VDS_MAX_ORBIT_PNTS+1, sizeof(Lgm_Vector) );
+    Lgm_CTrans      *c = Lgm_init_ctrans( 0 );
+    _SgpInfo        *s = (_SgpInfo *)calloc( 1, sizeof(_SgpInfo) );
+    _SpaceObjectItem *Sat;
+
+    f = t->Coarse ? VDS_COARSE_FACTOR : 1.0;
+
+    for ( i=0; i<t->n; i++ ) {
+
+        if ( !t->Coarse && ( t->Generation != g_atomic_int_get( &Generation ) ) ) break;
+
+        Sat    = &t->Track[i].Sat;
+        period = 1440.0/Sat->TLE.MeanMotion; // orbit period in minutes
+
+        /*
+         *  Orbits are from a half orbit ahead of the current time to a half
+         *  orbit behind (times oPeriodFrac).
+         */
+        if ( Sat->DrawOrbit || Sat->DrawGroundPathOfOrbit || Sat->DrawOrbitToGroundLines ) {
+            n = Vds_SatTracks_Propagate( t, s, c, &Sat->TLE, period*Sat->oPeriodFrac/200.0, -period*Sat->oPeriodFrac/200.0,
+                                         f*period*Sat->oPeriodFrac/100.0/1000.0, 0.5*f, 1.0*f, VDS_MAX_ORBIT_PNTS, U );
+            t->Track[i].Orbit  = (Lgm_Vector *)malloc( (n > 0 ? n : 1)*sizeof(Lgm_Vector) );
+            memcpy( t->Track[i].Orbit, U, n*sizeof(Lgm_Vector) );
+            t->Track[i].nOrbit = n;
+        }
+
+        /*
+         *  Streaks are from now back VDS_STREAK_FRAC of an orbit.
+         */
+        if ( Sat->DrawStreak || Sat->DrawGroundPathOfStreak || Sat->DrawStreakToGroundLines ) {
+            n = Vds_SatTracks_Propagate( t, s, c, &Sat->TLE, 0.0, -period*VDS_STREAK_FRAC, f*period/1000.0, 0.5*f, 1.0*f, VDS_MAX_STREAK_PNTS, U );
+            t->Track[i].Streak  = (Lgm_Vector *)malloc( (n > 0 ? n : 1)*sizeof(Lgm_Vector) );
+            memcpy( t->Track[i].Streak, U, n*sizeof(Lgm_Vector) );
+            t->Track[i].nStreak = n;
+        }
+
+    }
+
+    free( s );
+    free( U );
+    Lgm_free_ctrans( c );
+
+    return( i == t->n );
+
+}
+
+
+/*
+ *  On the GUI thread: hand the tracks over unless something newer (or the
+ *  full version of these) has been shown already.
+ */
+static gboolean Vds_SatTracks_Deliver( gpointer data ) {
+
+    Vds_SatTracks *t = (Vds_SatTracks *)data;
+
+    if ( ( t->Generation > ShownGeneration ) || ( ( t->Generation == ShownGeneration ) && ShownCoarse && !t->Coarse ) ) {
+        ShownGeneration = t->Generation;
+        ShownCoarse     = t->Coarse;
+        ReadyFunc( t );
+    } else {
+        Vds_SatTracks_Free( t );
+    }
+
+    return( FALSE );
+
+}
+
+
+static void Vds_SatTracks_Worker( gpointer data, gpointer user_data ) {
+
+    Vds_SatTracks *t = (Vds_SatTracks *)data;
+
+    // dont bother if a newer request came in while this one was queued
+    if ( ( t->Generation == g_atomic_int_get( &Generation ) ) && Vds_SatTracks_Compute( t ) ) {
+        g_idle_add( Vds_SatTracks_Deliver, t );
+    } else {
+        Vds_SatTracks_Free( t );
+    }
+
+}
+
+
+/*
+ *  Ask for the tracks at JD. Ready() gets them (on the GUI thread, and it
+ *  then owns them) -- first coarse ones and then the full ones. With Wait
+ *  set, the full tracks are worked out right here instead (e.g. when frames
+ *  are being saved and have to be complete).
+ */
+void Vds_SatTracks_Request( double JD, int ConvertFlag, int Wait, void (*Ready)( Vds_SatTracks * ) ) {
+
+    gint            Gen;
+    Vds_SatTracks   *t;
+
+    g_atomic_int_inc( &Generation );
+    Gen = g_atomic_int_get( &Generation );
+    ReadyFunc = Ready;
+
+    if ( Wait ) {
+        t = Vds_SatTracks_Snapshot( JD, ConvertFlag, FALSE, Gen );
+        Vds_SatTracks_Compute( t );
+        Vds_SatTracks_Deliver( t );
+        return;
+    }
+
+    if ( Pool == NULL ) Pool = g_thread_pool_new( Vds_SatTracks_Worker, NULL, 2, FALSE, NULL );
+    g_thread_pool_push( Pool, Vds_SatTracks_Snapshot( JD, ConvertFlag, TRUE, Gen ), NULL );
+    g_thread_pool_push( Pool, Vds_SatTracks_Snapshot( JD, ConvertFlag, FALSE, Gen ), NULL );
+
+}
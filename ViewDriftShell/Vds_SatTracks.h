@@ -0,0 +1,44 @@
+#ifndef VDS_SAT_TRACKS_H
+#define VDS_SAT_TRACKS_H
+
+#include <glib.h>
+#include <Lgm/Lgm_Vec.h>
+#include <Lgm/Lgm_Sgp.h>
+#include "SatSelector.h"
+
+
+/*
+ *  Orbits and streaks of the satellites, propagated (with SGP4) off the GUI
+ *  thread. See Vds_SatTracks.c.
+ */
+typedef struct Vds_SatTrack {
+
+    _SpaceObjectItem    Sat;        //!< Copy of the satellite (TLE, what to draw and in what colors) when the tracks were requested.
+
+    int                 nOrbit;     //!< Number of points in Orbit.
+    Lgm_Vector          *Orbit;     //!< Orbit from half an orbit (times oPeriodFrac) ahead to half an orbit behind.
+
+    int                 nStreak;    //!< Number of points in Streak.
+    Lgm_Vector          *Streak;    //!< Streak from now back to an eighth of an orbit ago.
+
+} Vds_SatTrack;
+
+
+typedef struct Vds_SatTracks {
+
+    gint                Generation; //!< Which request these are for (newer requests have larger numbers).
+    int                 Coarse;     //!< Quick, low resolution tracks (to show until the full ones are done).
+    double              JD;         //!< Time of the tracks.
+    int                 ConvertFlag;//!< Coordinate transform applied to the SGP4 positions (SatsConvertFlag).
+
+    int                 n;
+    Vds_SatTrack        *Track;
+
+} Vds_SatTracks;
+
+
+void    Vds_SatTracks_Request( double JD, int ConvertFlag, int Wait, void (*Ready)( Vds_SatTracks * ) );
+void    Vds_SatTracks_Free( Vds_SatTracks *t );
+
+
+#endif
@@ -21,6 +21,8 @@
 #include "ViewDriftShell.h"
 #include <Lgm_DynamicMemory.h>
 #include "Vds_DriftShell.h"
+#include "Vds_SatTracks.h"
+#include "Vds_MagEphemIndex.h"
 
 
 GtkWidget *PUKE_SATSEL_VBOX;
@@ -262,6 +264,10 @@ void UpdateTimeDepQuants( long int CurrentDate, double CurrentUT ) {
 
     Lgm_Vector  u, v;
     double      Q[4], Q2[4], Q3[4], A[3][3];
+    int         i;
+
+    // Values from the open MagEphem files at the new time (only the records near it are read in)
+    for ( i=0; i<nMagEphemFiles; i++ ) Vds_MagEphem_At( MagEphemFiles[i], CurrentJD );
 
     // Set transforms, get Tilt
     Lgm_Set_Coord_Transforms( CurrentDate, CurrentUT, mInfo->c );
@@ -2984,25 +2990,17 @@ void ReCreateSats( ) {
     CreateSats( );
 }
 
+/*
+ *  Build the display list for the sat orbits and streaks from the latest
+ *  tracks (which are worked out in the background, see Vds_SatTracks.c).
+ */
+static Vds_SatTracks *CurrentSatTracks = NULL;
+
 void CreateSatOrbits() {
 
-    double              tsince, tsince0, JD, dt;
-    double              tJD, tUT, period, tinc, OrbitFrac = 0.125, Theta;
-    long int            tDate;
-    int                 tYear, tMonth, tDay;
-    Lgm_Vector          Ugsm[10001], Ugei, aa, bb, uu;
     int                 i, j, n, nMax;
-    Lgm_CTrans          *c = Lgm_init_ctrans( 0 );
-    _GroupNode          *g;
-    _SpaceObjects       *Group;
-    _SgpInfo            *s = (_SgpInfo *)calloc( 1, sizeof(_SgpInfo) );
-
-    /*
-     * All the TLEs have their own epoch times in them. And the propagator (sgp4)
-     * uses the "time since (in minutes)". So for a given time of interest, we need to
-     * compute the tsince needed.
-     */
-    JD = CurrentJD;
+    Lgm_Vector          *Ugsm, uu;
+    _SpaceObjectItem    *Sat;
 
     SatOrbitsDL = glGenLists( 1 );
     glNewList( SatOrbitsDL, GL_COMPILE );
@@ -3013,219 +3011,123 @@ void CreateSatOrbits() {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);;
 
-        g = SatSelectorInfo->SatGroupList;
-        while ( g != NULL ) {
-            Group = g->Group;
-
-            if ( Group->DrawGroup ) {
-
-                /*
-                 *  DRAW ORBIT, ETC
-                 *  Orbits are drawn from a half orbit before current time to
-                 *  half orbit after.  (If oPeriodFrac is 100%. lengths of
-                 *  orbits are scaled appropriately for other values of
-                 *  oPeriodFrac)
-                 */
-                for (i=0; i<Group->nSat; i++){
-                    if ( Group->Sat[i].Draw ) {
-
-                        if ( (Group->Sat[i].DrawOrbit) || (Group->Sat[i].DrawGroundPathOfOrbit) || (Group->Sat[i].DrawOrbitToGroundLines) ){
-                            LgmSgp_SGP4_Init( s, &Group->Sat[i].TLE );
-                            tsince0 = (JD - Group->Sat[i].TLE.JD)*1440.0;
-                            period = 1440.0/Group->Sat[i].TLE.MeanMotion; // orbit period in minutes
-period *= Group->Sat[i].oPeriodFrac/100.0;
-
-                            // init n to zero and start half an orbit ahead of current time.
-                            n=0; dt = period/2.0;
+        for (i=0; (CurrentSatTracks != NULL) && (i<CurrentSatTracks->n); i++){
 
-                            // do first one to start
-                            tinc = period/1000.0; // start out with very small increment
-                            tsince = tsince0+dt;
-                            LgmSgp_SGP4( tsince, s );
-                            Ugei.x = s->X/Re; Ugei.y = s->Y/Re; Ugei.z = s->Z/Re;
-                            tJD = JD + dt/1440.0;
-                            Lgm_jd_to_ymdh( tJD, &tDate, &tYear, &tMonth, &tDay, &tUT );
-                            Lgm_Set_Coord_Transforms( tDate, tUT, c );
-                            Lgm_Convert_Coords( &Ugei, &Ugsm[n], SatsConvertFlag, c );
-                            aa = Ugsm[n]; Lgm_NormalizeVector( &aa );
-                            n++; dt -= tinc;
-
-                            while ( (dt >= -period/2.0) && (n<10000) ) {
-                                tsince = tsince0+dt;
-                                LgmSgp_SGP4( tsince, s );
-                                Ugei.x = s->X/Re; Ugei.y = s->Y/Re; Ugei.z = s->Z/Re;
-                                tJD = JD + dt/1440.0;
-                                Lgm_jd_to_ymdh( tJD, &tDate, &tYear, &tMonth, &tDay, &tUT );
-                                Lgm_Set_Coord_Transforms( tDate, tUT, c );
-                                Lgm_Convert_Coords( &Ugei, &Ugsm[n], SatsConvertFlag, c );
-
-
-                                bb = Ugsm[n]; Lgm_NormalizeVector( &bb );
-    //Lgm_VecSub( &cc, &bb, &aa );
-                                Theta = DegPerRad * acos( fabs(Lgm_DotProduct( &aa, &bb )) );
-                                if (Theta > 1.0) tinc *= 0.61803398875;
-                                if (Theta < 0.5) tinc *= 1.61803398875;
-    //                            DS = Lgm_Magnitude( &cc );
-    //                            if (DS > 1.0)  tinc *= 0.61803398875;
-    //                            if (DS < 0.5) tinc *= 1.61803398875;
-
-
-                                n++; dt -= tinc;
-                                aa = bb;
-                            }
-//printf("n = %d\n", n);
+            Sat = &CurrentSatTracks->Track[i].Sat;
 
+            /*
+             *  DRAW ORBIT, ETC
+             *  Orbits are drawn from a half orbit before current time to
+             *  half orbit after.  (If oPeriodFrac is 100%. lengths of
+             *  orbits are scaled appropriately for other values of
+             *  oPeriodFrac)
+             */
+            n    = CurrentSatTracks->Track[i].nOrbit;
+            Ugsm = CurrentSatTracks->Track[i].Orbit;
 
-                            // ORBIT
-                            if ( Group->Sat[i].DrawOrbit ) {
-                                glColor4f( Group->Sat[i].oRed, Group->Sat[i].oGrn, Group->Sat[i].oBlu, Group->Sat[i].oAlf );
+            // ORBIT
+            if ( Sat->DrawOrbit ) {
+                glColor4f( Sat->oRed, Sat->oGrn, Sat->oBlu, Sat->oAlf );
 glColor4f( 0.0, 0.0, 0.0, 0.8 );
-                                glBegin( GL_LINE_STRIP );
-                                    for (j=0; j<n; j++) glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
-                                glEnd();
-                            }
-                            // GROUND PATH
-                            if ( Group->Sat[i].DrawGroundPathOfOrbit ) {
-                                glColor4f( Group->Sat[i].ogpRed, Group->Sat[i].ogpGrn, Group->Sat[i].ogpBlu, Group->Sat[i].ogpAlf );
-                                glBegin( GL_LINE_STRIP );
-                                    for (j=0; j<n; j++) {
-                                        uu = Ugsm[j];
-                                        Lgm_ForceMagnitude( &uu, 1.001 );
-                                        glVertex3f( uu.x, uu.y, uu.z );
-                                    }
-                                glEnd();
-                            }
-                            // LINES BETWEEN ORBIT AND GROUND PATH
-                            if ( Group->Sat[i].DrawOrbitToGroundLines ) {
-                                nMax = 25;
-                                //glColor4f( Group->Sat[i].oglRed, Group->Sat[i].oglGrn, Group->Sat[i].oglBlu, Group->Sat[i].oglAlf*(double)n/(double)nMax );
-                                glColor4f( Group->Sat[i].oglRed, Group->Sat[i].oglGrn, Group->Sat[i].oglBlu, Group->Sat[i].oglAlf );
-                                glBegin( GL_LINES );
-                                    for (j=0; j<n; j += 1) {
-                                        uu = Ugsm[j];
-                                        Lgm_ForceMagnitude( &uu, 1.001 );
-                                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
-                                        glVertex3f( uu.x, uu.y, uu.z );
-                                    }
-                                glEnd();
-                            }
-
-                        }
+                glBegin( GL_LINE_STRIP );
+                    for (j=0; j<n; j++) glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
+                glEnd();
+            }
+            // GROUND PATH
+            if ( Sat->DrawGroundPathOfOrbit ) {
+                glColor4f( Sat->ogpRed, Sat->ogpGrn, Sat->ogpBlu, Sat->ogpAlf );
+                glBegin( GL_LINE_STRIP );
+                    for (j=0; j<n; j++) {
+                        uu = Ugsm[j];
+                        Lgm_ForceMagnitude( &uu, 1.001 );
+                        glVertex3f( uu.x, uu.y, uu.z );
                     }
-                }
-
-
-                /*
-                 *  DRAW STREAKS, ETC
-                 */
-                Group = g->Group;
-                for (i=0; i<Group->nSat; i++){
-                    if ( Group->Sat[i].Draw ) {
-
-                        if ( (Group->Sat[i].DrawStreak) || (Group->Sat[i].DrawGroundPathOfStreak) || (Group->Sat[i].DrawStreakToGroundLines) ){
-                            LgmSgp_SGP4_Init( s, &Group->Sat[i].TLE );
-                            tsince0 = (JD - Group->Sat[i].TLE.JD)*1440.0;
-                            period = 1440.0/Group->Sat[i].TLE.MeanMotion; // orbit period in minutes
-
-                            // init n to zero and start at current time
-                            n=0; dt = 0.0;
-
-                            // do first one to start
-                            tinc = period/1000.0; // start out with very small increment
-                            tsince = tsince0+dt;
-                            LgmSgp_SGP4( tsince, s );
-                            Ugei.x = s->X/Re; Ugei.y = s->Y/Re; Ugei.z = s->Z/Re;
-                            tJD = JD + dt/1440.0;
-                            Lgm_jd_to_ymdh( tJD, &tDate, &tYear, &tMonth, &tDay, &tUT );
-                            Lgm_Set_Coord_Transforms( tDate, tUT, c );
-                            Lgm_Convert_Coords( &Ugei, &Ugsm[n], SatsConvertFlag, c );
-                            aa = Ugsm[n]; Lgm_NormalizeVector( &aa );
-                            n++; dt -= tinc;
-
-                            // go until we've gone backwards OrbitFrac of an orbit
-                            while ( (dt >= -period*OrbitFrac) && (n<1000) ) {
-                                tsince = tsince0+dt;
-                                LgmSgp_SGP4( tsince, s );
-                                Ugei.x = s->X/Re; Ugei.y = s->Y/Re; Ugei.z = s->Z/Re;
-                                tJD = JD + dt/1440.0;
-                                Lgm_jd_to_ymdh( tJD, &tDate, &tYear, &tMonth, &tDay, &tUT );
-                                Lgm_Set_Coord_Transforms( tDate, tUT, c );
-                                Lgm_Convert_Coords( &Ugei, &Ugsm[n], SatsConvertFlag, c );
-
-
-                                bb = Ugsm[n]; Lgm_NormalizeVector( &bb );
-                                Theta = DegPerRad * acos( fabs(Lgm_DotProduct( &aa, &bb )) );
-                                if (Theta > 1.0) tinc *= 0.61803398875;
-                                if (Theta < 0.5) tinc *= 1.61803398875;
-
-
-                                n++; dt -= tinc;
-                                aa = bb;
-                            }
-
-                            nMax = n;
-    //printf("nMax = %d\n", nMax);
-
+                glEnd();
+            }
+            // LINES BETWEEN ORBIT AND GROUND PATH
+            if ( Sat->DrawOrbitToGroundLines ) {
+                glColor4f( Sat->oglRed, Sat->oglGrn, Sat->oglBlu, Sat->oglAlf );
+                glBegin( GL_LINES );
+                    for (j=0; j<n; j += 1) {
+                        uu = Ugsm[j];
+                        Lgm_ForceMagnitude( &uu, 1.001 );
+                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
+                        glVertex3f( uu.x, uu.y, uu.z );
+                    }
+                glEnd();
+            }
 
-                            // STREAK
-                            if ( Group->Sat[i].DrawStreak ) {
-                                glBegin( GL_LINE_STRIP );
-                                    for (j=0; j<n; j++) {
-                                        glColor4f( Group->Sat[i].sRed, Group->Sat[i].sGrn, Group->Sat[i].sBlu, Group->Sat[i].sAlf*(1.0-(double)j/(double)nMax) );
-                                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
-                                    }
-                                glEnd();
-                            }
-                            // STREAK GROUND PATH
-                            if ( Group->Sat[i].DrawGroundPathOfStreak ) {
-                                glBegin( GL_LINE_STRIP );
-                                    for (j=0; j<n; j++) {
-                                        uu = Ugsm[j];
-                                        Lgm_ForceMagnitude( &uu, 1.001 );
-                                        glColor4f( Group->Sat[i].sgpRed, Group->Sat[i].sgpGrn, Group->Sat[i].sgpBlu, Group->Sat[i].sgpAlf*(1.0-(double)j/(double)nMax) );
-                                        glVertex3f( uu.x, uu.y, uu.z );
-                                    }
-                                glEnd();
-                            }
-                            // LINES BETWEEN STREAK AND GROUND PATH
-                            if ( Group->Sat[i].DrawStreakToGroundLines ) {
-                                glBegin( GL_LINES );
-                                    for (j=0; j<n; j++) {
-                                        uu = Ugsm[j];
-                                        Lgm_ForceMagnitude( &uu, 1.001 );
-                                        glColor4f( Group->Sat[i].sglRed, Group->Sat[i].sglGrn, Group->Sat[i].sglBlu, Group->Sat[i].sglAlf*(1.0-(double)j/(double)nMax) );
-                                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
-                                        glVertex3f( uu.x, uu.y, uu.z );
-                                    }
-                                glEnd();
-                            }
 
-                        }
+            /*
+             *  DRAW STREAKS, ETC
+             */
+            n    = CurrentSatTracks->Track[i].nStreak;
+            Ugsm = CurrentSatTracks->Track[i].Streak;
+            nMax = n;
+
+            // STREAK
+            if ( Sat->DrawStreak ) {
+                glBegin( GL_LINE_STRIP );
+                    for (j=0; j<n; j++) {
+                        glColor4f( Sat->sRed, Sat->sGrn, Sat->sBlu, Sat->sAlf*(1.0-(double)j/(double)nMax) );
+                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
                     }
-                }
-
+                glEnd();
+            }
+            // STREAK GROUND PATH
+            if ( Sat->DrawGroundPathOfStreak ) {
+                glBegin( GL_LINE_STRIP );
+                    for (j=0; j<n; j++) {
+                        uu = Ugsm[j];
+                        Lgm_ForceMagnitude( &uu, 1.001 );
+                        glColor4f( Sat->sgpRed, Sat->sgpGrn, Sat->sgpBlu, Sat->sgpAlf*(1.0-(double)j/(double)nMax) );
+                        glVertex3f( uu.x, uu.y, uu.z );
+                    }
+                glEnd();
+            }
+            // LINES BETWEEN STREAK AND GROUND PATH
+            if ( Sat->DrawStreakToGroundLines ) {
+                glBegin( GL_LINES );
+                    for (j=0; j<n; j++) {
+                        uu = Ugsm[j];
+                        Lgm_ForceMagnitude( &uu, 1.001 );
+                        glColor4f( Sat->sglRed, Sat->sglGrn, Sat->sglBlu, Sat->sglAlf*(1.0-(double)j/(double)nMax) );
+                        glVertex3f( Ugsm[j].x, Ugsm[j].y, Ugsm[j].z );
+                        glVertex3f( uu.x, uu.y, uu.z );
+                    }
+                glEnd();
             }
 
-
-            g = g->Next;
         }
 
-
-
         glDisable(GL_BLEND);
         glEnable(GL_LIGHTING);
         glDepthMask( GL_TRUE );
 
     glEndList( );
 
-    free(s);
-    Lgm_free_ctrans( c ); // free the CTrans structure 
-
 }
 
-void ReCreateSatOrbits( ) {
+gboolean expose_event( GtkWidget *widget, GdkEventExpose *event, gpointer data);
+
+/*
+ *  New tracks are in (on the GUI thread). Swap them in and redraw.
+ */
+static void SatTracksReady( Vds_SatTracks *t ) {
+    Vds_SatTracks_Free( CurrentSatTracks );
+    CurrentSatTracks = t;
     glDeleteLists( SatOrbitsDL, 1 );
     CreateSatOrbits( );
+    expose_event( drawing_area, NULL, NULL );
+}
+
+/*
+ *  Ask for the tracks at the current time. The old ones stay up until the
+ *  new ones are ready, so this doesnt hold up the GUI. (When frames are being
+ *  dumped, wait for the full tracks so the frames are complete.)
+ */
+void ReCreateSatOrbits( ) {
+    Vds_SatTracks_Request( CurrentJD, SatsConvertFlag, DumpFrames, SatTracksReady );
 }
 
 
@@ -3544,6 +3446,7 @@ glClearColor( 0.8, 0.8, 0.8, 0.8 );
 //    LoadTLEs( );
     CreateSats();
     CreateSatOrbits();
+    ReCreateSatOrbits();
     CreateLogo();
 
 
@@ -3794,7 +3697,7 @@ ShowFullFieldLine = 1;
 //SurfaceColor[2] = gInfo->FieldLineMaterial[i].diffuse[2];
 //SurfaceColor[3] = gInfo->FieldLineMaterial[i].diffuse[3];
 //glUniform4fv( SurfaceColorLoc, 1, SurfaceColor );
-                glCallList( ObjInfo->DriftShellList2 + i );
+                DrawFieldLines( ObjInfo, i, TRUE );
             }
         } else {
             for (i=0; i<ObjInfo->MagEphemInfo->nAlpha; i++ ) {
@@ -3807,7 +3710,7 @@ ShowFullFieldLine = 1;
 //SurfaceColor[2] = gInfo->FieldLineMaterial[i].diffuse[2];
 //SurfaceColor[3] = gInfo->FieldLineMaterial[i].diffuse[3];
 //glUniform4fv( SurfaceColorLoc, 1, SurfaceColor );
-                glCallList( ObjInfo->DriftShellList3 + i );
+                DrawFieldLines( ObjInfo, i, FALSE );
             }
         }
 
@@ -3829,9 +3732,9 @@ ShowFullFieldLine = 1;
 //SurfaceColor[3] = gInfo->FieldLineMaterial[i].diffuse[3];
 //glUniform4fv( SurfaceColorLoc, 1, SurfaceColor );
                 if ( ShowFullFieldLine ){
-                    glCallList( ObjInfo->DriftShellList2 + i );
+                    DrawFieldLines( ObjInfo, i, TRUE );
                 } else {
-                    glCallList( ObjInfo->DriftShellList3 + i);
+                    DrawFieldLines( ObjInfo, i, FALSE );
                 }
             }
         }
@@ -4040,7 +3943,7 @@ glMaterialf(  GL_BACK, GL_SHININESS, gInfo->DriftShellMaterial[i].shininess*128.
                 glEnable( GL_BLEND );
                 glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
             }
-            glCallList( ObjInfo->DriftShellList4 + i );
+            DrawDriftShell( ObjInfo, i );
             if ( (int)(gInfo->DriftShellMaterial[i+1].diffuse[3]*128.0) < 128 ) {
                 glDisable( GL_BLEND );
             }
@@ -4052,6 +3955,20 @@ glFrontFace(GL_CCW);
 
 //    glCallList( ScPositionDL );
 
+    /*
+     *  S/C positions from the open MagEphem files (GSM, like the drift shells).
+     */
+    glDisable( GL_LIGHTING );
+    glColor4f( 0.9, 0.8, 0.2, 1.0 );
+    for ( i=0; i<nMagEphemFiles; i++ ) {
+        if ( !MagEphemFiles[i]->NowValid ) continue;
+        glPushMatrix();
+        glTranslatef( MagEphemFiles[i]->NowRgsm.x, MagEphemFiles[i]->NowRgsm.y, MagEphemFiles[i]->NowRgsm.z );
+        Lgm_gl_draw_sphere( TRUE, 0.08, 16, 16 );
+        glPopMatrix();
+    }
+    glEnable( GL_LIGHTING );
+
     //glUseProgram( 0 );
 
 
@@ -8242,6 +8159,9 @@ printf("nFramesLeft, nFrames = %ld %ld\n", nFramesLeft, nFrames);
     /*
      *  Initialize GTK
      */
+#if !GLIB_CHECK_VERSION(2,32,0)
+    if ( !g_thread_supported() ) g_thread_init( NULL ); // for the sat track workers (Vds_SatTracks.c)
+#endif
     gtk_set_locale( );
     gtk_init( &argc, &argv );
     //add_pixmap_directory( PACKAGE_DATA_DIR "/" PACKAGE "/pixmaps" );
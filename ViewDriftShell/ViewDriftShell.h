@@ -99,8 +99,11 @@ long int    nFrames, cFrame, nFramesLeft;
 extern GtkWidget   *drawing_area;
 extern GtkWidget   *ViewDriftShellWindow;
 extern long int    nFrames, cFrame, nFramesLeft;
+extern double      CurrentJD;
 #endif
 
+gboolean expose_event( GtkWidget *widget, GdkEventExpose *event, gpointer data );
+
 
 
 #endif
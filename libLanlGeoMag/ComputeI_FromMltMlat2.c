@@ -8,11 +8,11 @@
  */
 double ComputeI_FromMltMlat2( double Bm, double MLT, double mlat, double *r, double I0, Lgm_LstarInfo *LstarInfo ) {
 
-    int         reset=1, reset2, TraceFlag;
+    int         reset=1, reset2, TraceFlag, HaveLine=FALSE, nDivs;
 
     double      Bmin, I, Phi, cl, sl, rat, SS1, SS2, SS, Sn, Ss, Htry, Hdid, Hnext, Bs, Be, s, sgn;
     Lgm_Vector  w, u, Pmirror1, Pmirror2, v1, v2, v3, Bvec, P, Ps, u_scale, Bvectmp, Ptmp;
-    double      stmp, Btmp;
+    double      stmp, Btmp, Stot;
 
 
 
@@ -26,12 +26,46 @@ double ComputeI_FromMltMlat2( double Bm, double MLT, double mlat, double *r, dou
     cl = cos( mlat * RadPerDeg ); sl = sin( mlat * RadPerDeg );
     w.x = (*r)*cl*cos(Phi); w.y = (*r)*cl*sin(Phi); w.z = (*r)*sl;
 
-    Lgm_Convert_Coords( &w, &u, SM_TO_GSM, LstarInfo->mInfo->c );
-    TraceFlag = Lgm_Trace( &u, &v1, &v2, &v3, LstarInfo->mInfo->Lgm_LossConeHeight, TRACE_TOL, TRACE_TOL, LstarInfo->mInfo );
+    if ( (LstarInfo->FieldLineCache != NULL) && Lgm_FieldLineCache_Get( LstarInfo->FieldLineCache, MLT, mlat, &TraceFlag, &v3, &Bmin, LstarInfo->mInfo ) ) {
 
-    LstarInfo->mInfo->Bfield( &v3, &Bvec, LstarInfo->mInfo );
-    Bmin = Lgm_Magnitude( &Bvec );
-    //printf("Pmin = %g %g %g\n", v3.x, v3.y, v3.z);
+        /*
+         *  Another search (e.g. for a different pitch angle) already traced
+         *  this line. The footpoint-to-footpoint points are now in mInfo.
+         */
+        HaveLine = ( TraceFlag == LGM_CLOSED );
+
+    } else {
+
+        Lgm_Convert_Coords( &w, &u, SM_TO_GSM, LstarInfo->mInfo->c );
+        TraceFlag = Lgm_Trace( &u, &v1, &v2, &v3, LstarInfo->mInfo->Lgm_LossConeHeight, TRACE_TOL, TRACE_TOL, LstarInfo->mInfo );
+
+        LstarInfo->mInfo->Bfield( &v3, &Bvec, LstarInfo->mInfo );
+        Bmin = Lgm_Magnitude( &Bvec );
+        //printf("Pmin = %g %g %g\n", v3.x, v3.y, v3.z);
+
+        if ( LstarInfo->FieldLineCache != NULL ) {
+
+            /*
+             *  Trace the whole line (southern to northern footpoint) so that
+             *  it can be reused for any Bm. Use the spacing set in the
+             *  cache, but never fewer than nDivs points.
+             */
+            HaveLine = FALSE;
+            if ( TraceFlag == LGM_CLOSED ) {
+                Stot  = LstarInfo->mInfo->Stotal;
+                nDivs = Stot/LstarInfo->FieldLineCache->ds;
+                if ( nDivs < LstarInfo->mInfo->nDivs ) nDivs = LstarInfo->mInfo->nDivs;
+                if ( nDivs > LGM_MAX_INTERP_PNTS-1 ) nDivs = LGM_MAX_INTERP_PNTS-1;
+                LstarInfo->mInfo->Hmax = Stot/(double)nDivs;
+                HaveLine = ( Lgm_TraceLine3( &v1, Stot, nDivs, 1.0, TRACE_TOL, FALSE, LstarInfo->mInfo ) >= 0 );
+            }
+            if ( HaveLine || (TraceFlag != LGM_CLOSED) ) {
+                Lgm_FieldLineCache_Add( LstarInfo->FieldLineCache, MLT, mlat, TraceFlag, &v3, Bmin, LstarInfo->mInfo );
+            }
+
+        }
+
+    }
 
     if ( TraceFlag != LGM_CLOSED ) {
 
@@ -43,6 +77,19 @@ double ComputeI_FromMltMlat2( double Bm, double MLT, double mlat, double *r, dou
 
     } else if ( Bmin <= Bm ) {
 
+        /*
+         *  If we have the whole line, get the mirror points and I from it.
+         *  If that cant be done (mirror points too close together to be
+         *  resolved by the stored points, or not between the footpoints),
+         *  fall through and trace to the mirror points as usual.
+         */
+        if ( HaveLine && ( Lgm_FieldLineCache_Iinv( Bm, &I, LstarInfo->mInfo ) > 0 ) ) {
+            if (LstarInfo->VerbosityLevel > 1) {
+                printf("\t\t%s  mlat: %13.6g   I: %13.6g   I0: %13.6g   I-I0: %13.6g    [Sa,Sb]: %.8g  %.8g  (nCalls = %d, stored line)%s\n",  LstarInfo->PreStr, mlat, I, I0, I-I0, LstarInfo->mInfo->Sm_South, LstarInfo->mInfo->Sm_North, LstarInfo->mInfo->Lgm_n_I_integrand_Calls, LstarInfo->PostStr );
+            }
+            return( I );
+        }
+
         /*
          * From the minimum B point, attempt to trace along the field to get the northern mirror point.
          */
@@ -108,7 +155,6 @@ double ComputeI_FromMltMlat2( double Bm, double MLT, double mlat, double *r, dou
          *  reduce the number of divisions to avoid this in cases where
          *  the total distance to trace is very small.
          */
-        int nDivs;
         if ( SS/LstarInfo->mInfo->nDivs < 1e-6 ) {
             nDivs = SS/1e-6;
             if (nDivs < 10) nDivs = 10;
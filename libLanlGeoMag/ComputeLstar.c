@@ -3,15 +3,26 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <math.h>
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
 #include "Lgm/Lgm_QuadPack.h"
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_LstarInfo.h"
+#include "Lgm/Lgm_Tasks.h"
+#include "Lgm/Lgm_Profile.h"
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_spline.h>
 #include <string.h>
 
 #define TRACE_TOL   1e-7
+#define LGM_LSTAR_CONT_DELTA        0.5     // Widest first bracket (+/- degrees of mlat) when predicting from the last shell (see Lgm_ShellHistory.c)
+#define LGM_LSTAR_NESTED_MAXSHIFT   5.0     // A neighbouring pitch angle's shell (LstarInfo->NestedShell) is only used if it is within this many degrees of mlat
+#define LGM_LSTAR_CONT_MIN_DELTA    0.02    // Narrowest
 
 void PredictMlat1( double *MirrorMLT, double *MirrorMlat, int k, double MLT, double *pred_mlat, double *pred_delta_mlat, double *delta );
 void PredictMlat2( double *MirrorMLT, double *MirrorMlat, int k, double MLT, double *pred_mlat, double *pred_delta_mlat, double *delta, Lgm_LstarInfo *LstarInfo );
@@ -211,7 +222,8 @@ Type = nBounceRegions;
 
 /*
  * There are many tolerances involved in an Lstar calculation.  Here we try and
- * set them qualitatively given a single "quality" value.
+ * set them qualitatively given a single "quality" value. If s->TolProfile is
+ * set, its tolerances (and nFLsInDriftShell) are used instead.
  */
 void Lgm_SetLstarTolerances( int Quality, int nFLsInDriftShell, Lgm_LstarInfo *s ) {
 
@@ -429,6 +441,17 @@ void Lgm_SetLstarTolerances( int Quality, int nFLsInDriftShell, Lgm_LstarInfo *s
 
     }
 
+    /*
+     *  The DP8 integrator uses the same tolerances as BS.
+     */
+    s->mInfo->Lgm_MagStep_DP8_atol = s->mInfo->Lgm_MagStep_BS_atol;
+    s->mInfo->Lgm_MagStep_DP8_rtol = s->mInfo->Lgm_MagStep_BS_rtol;
+
+    /*
+     *  A tuned profile (see Lgm_LstarTuner.c) overrides all of the above.
+     */
+    if ( s->TolProfile != NULL ) Lgm_ApplyLstarTolProfile( s->TolProfile, s );
+
 
     return;
 
@@ -460,6 +483,28 @@ Lgm_LstarInfo *InitLstarInfo( int VerbosityLevel ) {
 }
 
 
+/*
+ *  Bound the cost of each Lstar() call, for when a late L* is no use (e.g. a
+ *  nowcast). MaxTime is in seconds of wall clock time and MaxMagEvals is a
+ *  number of field evaluations (as counted by the tracers); either can be 0
+ *  for no limit. A call that runs out stops where it is: if the drift shell
+ *  is complete but still being refined (AdaptiveLstarTol > 0) the L* of the
+ *  shell so far is used, otherwise McIlwain's L of the starting field line,
+ *  scaled as L* is. Either way Lstar() returns LGM_LSTAR_APPROXIMATE and
+ *  sets LSApproximate. The budget is looked at before each shell line
+ *  search, so a call can go over by about one search.
+ */
+void Lgm_SetLstarBudget( double MaxTime, long int MaxMagEvals, Lgm_LstarInfo *LstarInfo ) {
+    LstarInfo->MaxLstarTime     = ( MaxTime > 0.0 ) ? MaxTime : 0.0;
+    LstarInfo->MaxLstarMagEvals = ( MaxMagEvals > 0 ) ? MaxMagEvals : 0;
+}
+
+static int Lstar_OverBudget( Lgm_LstarInfo *LstarInfo ) {
+    if ( ( LstarInfo->MaxLstarMagEvals > 0 ) && ( LGM_NMAGEVALS_TOTAL( LstarInfo->mInfo ) > LstarInfo->BudgetMagEvals ) ) return( TRUE );
+    if ( ( LstarInfo->MaxLstarTime > 0.0 ) && ( Lgm_StageHooks_Now() > LstarInfo->BudgetDeadline ) ) return( TRUE );
+    return( FALSE );
+}
+
 void Lgm_InitLstarInfoDefaults( Lgm_LstarInfo	*LstarInfo ) {
     /*
      *  Default Settings
@@ -467,12 +512,30 @@ void Lgm_InitLstarInfoDefaults( Lgm_LstarInfo	*LstarInfo ) {
     LstarInfo->VerbosityLevel = 2;
     LstarInfo->LSimpleMax     = 10.0;
     LstarInfo->ISearchMethod  = 1;
+    LstarInfo->UseFieldLineCache = FALSE;
+    LstarInfo->FieldLineCache    = NULL;
+    LstarInfo->UseBmRadiusCache  = FALSE;
+    LstarInfo->BmRadiusCache     = NULL;
+    LstarInfo->MinBMap           = NULL;
+    LstarInfo->ParallelDriftShell = FALSE;
+    LstarInfo->ShellHistory      = NULL;
+    LstarInfo->NestedShell       = NULL;
+    LstarInfo->FluxMap           = NULL;
+    LstarInfo->TolProfile        = NULL;
+    LstarInfo->AdaptiveLstarTol  = 0.0;
+    LstarInfo->AdaptiveMaxFLs    = 96;
+    LstarInfo->MaxLstarTime      = 0.0;
+    LstarInfo->MaxLstarMagEvals  = 0;
+    LstarInfo->LSApproximate     = FALSE;
+    LstarInfo->NewtonShellLine   = FALSE;
+    LstarInfo->dIdMlat           = 0.0;
 
     LstarInfo->PreStr[0]  = '\0';
     LstarInfo->PostStr[0] = '\0';
     LstarInfo->ComputeVgc = FALSE;
 
     LstarInfo->ComputeSbIntegral = TRUE;
+    LstarInfo->Outputs = LGM_OUT_ALL;
     LstarInfo->mInfo->ComputeSb0 = TRUE;
 
 }
@@ -482,11 +545,64 @@ void Lgm_InitLstarInfoDefaults( Lgm_LstarInfo	*LstarInfo ) {
 void FreeLstarInfo( Lgm_LstarInfo *s ) {
 
     Lgm_FreeMagInfo( s->mInfo );
+    Lgm_LstarInfo_FreeShellLines( s );
     free( s );
 
 }
 
 
+/*
+ *  Allocate the arrays that saved shell lines go in (s_gsm, Bmag, x_gsm,
+ *  y_gsm, z_gsm), if they arent already. Returns TRUE on success.
+ */
+int Lgm_LstarInfo_AllocShellLines( Lgm_LstarInfo *s ) {
+
+    if ( s->s_gsm != NULL ) return( TRUE );
+
+    s->s_gsm = calloc( LGM_LSTARINFO_MAX_FL, sizeof( *s->s_gsm ) );
+    s->Bmag  = calloc( LGM_LSTARINFO_MAX_FL, sizeof( *s->Bmag ) );
+    s->x_gsm = calloc( LGM_LSTARINFO_MAX_FL, sizeof( *s->x_gsm ) );
+    s->y_gsm = calloc( LGM_LSTARINFO_MAX_FL, sizeof( *s->y_gsm ) );
+    s->z_gsm = calloc( LGM_LSTARINFO_MAX_FL, sizeof( *s->z_gsm ) );
+
+    if ( !s->s_gsm || !s->Bmag || !s->x_gsm || !s->y_gsm || !s->z_gsm ) {
+        printf("%sLgm_LstarInfo_AllocShellLines: Error, could not allocate memory for shell lines%s\n", s->PreStr, s->PostStr);
+        Lgm_LstarInfo_FreeShellLines( s );
+        return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+void Lgm_LstarInfo_FreeShellLines( Lgm_LstarInfo *s ) {
+
+    free( s->s_gsm ); free( s->Bmag );
+    free( s->x_gsm ); free( s->y_gsm ); free( s->z_gsm );
+    s->s_gsm = s->Bmag = s->x_gsm = s->y_gsm = s->z_gsm = NULL;
+
+}
+
+
+/*
+ *  Copy the points of saved shell line k from Src to Dst (both must have
+ *  their shell line arrays allocated).
+ */
+static void Lgm_LstarInfo_CopyShellLinePnts( int k, Lgm_LstarInfo *Dst, Lgm_LstarInfo *Src ) {
+
+    int n;
+
+    n = Dst->nFieldPnts[k] = Src->nFieldPnts[k];
+    memcpy( Dst->s_gsm[k], Src->s_gsm[k], n*sizeof(double) );
+    memcpy( Dst->Bmag[k],  Src->Bmag[k],  n*sizeof(double) );
+    memcpy( Dst->x_gsm[k], Src->x_gsm[k], n*sizeof(double) );
+    memcpy( Dst->y_gsm[k], Src->y_gsm[k], n*sizeof(double) );
+    memcpy( Dst->z_gsm[k], Src->z_gsm[k], n*sizeof(double) );
+
+}
+
+
 
 /*
  *  The Lgm_LstarInfo structure has pointers in it, so simple
@@ -496,8 +612,7 @@ void FreeLstarInfo( Lgm_LstarInfo *s ) {
 Lgm_LstarInfo *Lgm_CopyLstarInfo( Lgm_LstarInfo *s ) {
 
     Lgm_LstarInfo       *t;
-    Lgm_MagModelInfo *m;
-    Lgm_CTrans       *c;
+    int                 k;
 
     if ( s == NULL) {
         printf("%sLgm_CopyLstarInfo: Error, source structure is NULL%s\n", s->PreStr, s->PostStr);
@@ -517,64 +632,1301 @@ Lgm_LstarInfo *Lgm_CopyLstarInfo( Lgm_LstarInfo *s ) {
 
 
     /*
-     *  Copy MagInfo struct
+     *  Copy MagInfo struct
+     */
+    t->mInfo = Lgm_CopyMagInfo( s->mInfo );
+
+
+    t->mInfo->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
+    t->mInfo->Lgm_MagStep_BS_FirstTimeThrough = TRUE;
+    t->mInfo->Lgm_MagStep_BS_eps_old = -1.0;
+
+
+    /*
+     *  Shell lines get their own arrays, but only the lines that are
+     *  actually defined are copied over.
+     */
+    t->s_gsm = t->Bmag = t->x_gsm = t->y_gsm = t->z_gsm = NULL;
+    if ( ( s->s_gsm != NULL ) && Lgm_LstarInfo_AllocShellLines( t ) ) {
+        for ( k=0; k<s->nPnts; k++ ) Lgm_LstarInfo_CopyShellLinePnts( k, t, s );
+    }
+
+
+    return( t );
+}
+
+
+/*
+ *  Lgm_CopyLstarInfo() allocates (and fills) a new structure every time it
+ *  is called. Codes that make a copy for every L* calculation can instead
+ *  keep a pool and reuse the same structures over and over.
+ */
+Lgm_LstarInfoPool *Lgm_InitLstarInfoPool( int n ) {
+
+    Lgm_LstarInfoPool *Pool;
+
+    Pool = (Lgm_LstarInfoPool *)calloc( 1, sizeof(Lgm_LstarInfoPool) );
+    Pool->n     = n;
+    Pool->Slots = (Lgm_LstarInfo **)calloc( n, sizeof(Lgm_LstarInfo *) );
+    Pool->Busy  = (int *)calloc( n, sizeof(int) );
+    Pool->Node  = (int *)calloc( n, sizeof(int) );
+
+    return( Pool );
+
+}
+
+
+/*
+ *  Reset slot i of the pool to be a copy of s and return it. The structure
+ *  is reused in place (its mInfo too, see Lgm_CopyMagInfoInto()), and so
+ *  are its shell line arrays, if it has any. Unlike Lgm_CopyLstarInfo(),
+ *  saved shell lines are *not* copied over from s -- whatever is in the
+ *  slot's arrays is left there to be overwritten by the next Lstar() call.
+ *
+ *  The returned structure belongs to the pool, so dont free it. Each slot
+ *  must only be used by one thread at a time (either index the slots by
+ *  thread, or get them from Lgm_LstarInfoPool_Acquire()).
+ */
+Lgm_LstarInfo *Lgm_LstarInfoPool_Get( int i, Lgm_LstarInfo *s, Lgm_LstarInfoPool *Pool ) {
+
+    Lgm_LstarInfo   *t;
+    Lgm_MagModelInfo *mInfo;
+    double          (*s_gsm)[1000], (*Bmag)[1000], (*x_gsm)[1000], (*y_gsm)[1000], (*z_gsm)[1000];
+
+    if ( ( i < 0 ) || ( i >= Pool->n ) ) {
+        printf("%sLgm_LstarInfoPool_Get: Error, slot %d out of range (pool has %d slots)%s\n", s->PreStr, i, Pool->n, s->PostStr);
+        return( NULL );
+    }
+
+    /*
+     *  Lgm_LstarInfoPool_Acquire() may move the Slots array while it grows the
+     *  pool, so only look at it inside the same critical section.
+     */
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LstarInfoPool)
+#endif
+    {
+        t = Pool->Slots[i];
+    }
+    if ( t == NULL ) {
+        t = Lgm_CopyLstarInfo( s );     // on this thread, so its pages end up on this thread's node
+#if USE_OPENMP
+        #pragma omp critical (Lgm_LstarInfoPool)
+#endif
+        {
+            Pool->Slots[i] = t;
+            Pool->Node[i]  = Lgm_NumaHome();
+        }
+        return( t );
+    }
+
+    mInfo = t->mInfo;
+    s_gsm = t->s_gsm; Bmag = t->Bmag; x_gsm = t->x_gsm; y_gsm = t->y_gsm; z_gsm = t->z_gsm;
+
+    memcpy( t, s, sizeof(*s) );
+
+    t->s_gsm = s_gsm; t->Bmag = Bmag; t->x_gsm = x_gsm; t->y_gsm = y_gsm; t->z_gsm = z_gsm;
+
+    if ( Lgm_CopyMagInfoInto( mInfo, s->mInfo, TRUE ) ) {
+        t->mInfo = mInfo;
+    } else {
+        Lgm_FreeMagInfo( mInfo );
+        t->mInfo = Lgm_CopyMagInfo( s->mInfo );
+    }
+    t->mInfo->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
+    t->mInfo->Lgm_MagStep_BS_FirstTimeThrough = TRUE;
+    t->mInfo->Lgm_MagStep_BS_eps_old = -1.0;
+
+    return( t );
+
+}
+
+
+void Lgm_FreeLstarInfoPool( Lgm_LstarInfoPool *Pool ) {
+
+    int i;
+
+    if ( Pool == NULL ) return;
+    for ( i=0; i<Pool->n; i++ ) if ( Pool->Slots[i] != NULL ) FreeLstarInfo( Pool->Slots[i] );
+    free( Pool->Slots );
+    free( Pool->Busy );
+    free( Pool->Node );
+    free( Pool );
+
+}
+
+
+/*
+ *  Hand out a slot that nobody else holds, for code that cant tie slots to
+ *  threads (e.g. Lgm_ParallelFor() tasks -- see Lgm_Tasks.c). If every slot
+ *  is held the pool grows by one. Give the slot back with
+ *  Lgm_LstarInfoPool_Release() when done with it.
+ *
+ *  With Lgm_SetNumaAware( TRUE ), only slots made on the calling thread's
+ *  NUMA node (or not made yet) are handed out (see Lgm_Numa.c).
+ */
+int Lgm_LstarInfoPool_Acquire( Lgm_LstarInfoPool *Pool ) {
+
+    int i, Home;
+
+    Home = Lgm_NumaHome();
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LstarInfoPool)
+#endif
+    {
+        for ( i=0; i<Pool->n; i++ ) if ( !Pool->Busy[i] && ( ( Pool->Slots[i] == NULL ) || ( Pool->Node[i] == Home ) ) ) break;
+        if ( i == Pool->n ) {
+            Pool->Slots = (Lgm_LstarInfo **)realloc( Pool->Slots, (Pool->n+1)*sizeof(Lgm_LstarInfo *) );
+            Pool->Busy  = (int *)realloc( Pool->Busy, (Pool->n+1)*sizeof(int) );
+            Pool->Node  = (int *)realloc( Pool->Node, (Pool->n+1)*sizeof(int) );
+            Pool->Slots[i] = NULL;
+            Pool->Node[i]  = Home;
+            ++Pool->n;
+        }
+        Pool->Busy[i] = TRUE;
+    }
+
+    return( i );
+
+}
+
+void Lgm_LstarInfoPool_Release( int i, Lgm_LstarInfoPool *Pool ) {
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LstarInfoPool)
+#endif
+    {
+        if ( ( i >= 0 ) && ( i < Pool->n ) ) Pool->Busy[i] = FALSE;
+    }
+
+}
+
+
+
+
+
+
+
+
+void NewTimeLstarInfo( long int Date, double UT, double PitchAngle, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_LstarInfo *LstarInfo ){
+
+
+    /*
+     *  Set coord transforms for given data and time
+     */
+    Lgm_Set_Coord_Transforms( Date, UT, LstarInfo->mInfo->c );
+
+
+    /*
+     *  Set mag field model
+     */
+    LstarInfo->mInfo->Bfield = Mag;
+
+
+    /*
+     *  Set Pitch Angle
+     */
+    LstarInfo->PitchAngle = PitchAngle;
+
+
+}
+
+
+
+
+/*
+ *  Find the line of the drift shell at MLT (FL number k). The search starts
+ *  around pred_mlat, +/- *delta, and is widened (up to MaxCount times, 3
+ *  being the widest) if nothing is found, just as it always has in Lstar().
+ *  For k == 0 the line is the one through the
+ *  starting point, and LstarInfo->mInfo must already hold its mirror points.
+ *
+ *  On success the k'th slots in LstarInfo (I, Mirror_*, footprints, MLT,
+ *  mlat, Pmin, Bmin, ...) are filled in, *mlat is the mlat found and 0 is
+ *  returned. -3 means no line could be found (shell not closed) and -4 means
+ *  the trace to the Earth failed.
+ */
+static int Lstar_ShellLine( int k, int nLines, int MaxCount, double MLT, double I, double pred_mlat, double *delta_io, double *mlat_io, double *PredMinusActualMlat_io, int *nIts_io, Lgm_LstarInfo *LstarInfo ) {
+
+    Lgm_Vector  v, w, v2, Bvec, uu, vEn;
+    int         i, tkk, nfp, nnn, done2, Count, FoundShellLine, nIts, Type, FlagEn = 0;
+    double      B, smax, Hmax, Ifound, mlat, r=0.0, Phi, mlat_try, mlat0, mlat1, delta, res, PredMinusActualMlat, t0, sSn, dSn = 0.0;
+    char        *PreStr, *PostStr;
+    Lgm_MagModelInfo    *mInfo2;
+
+    PreStr  = LstarInfo->PreStr;
+    PostStr = LstarInfo->PostStr;
+    Ifound  = I;
+    delta   = *delta_io;
+    mlat    = *mlat_io;
+    nIts    = *nIts_io;
+    PredMinusActualMlat = *PredMinusActualMlat_io;
+
+    done2 = FALSE; FoundShellLine = FALSE; Count = 0;
+    LstarInfo->nImI0 = 0;
+    while ( !done2 && (k > 0) ) {
+
+            if ( Lstar_OverBudget( LstarInfo ) ) return( LGM_LSTAR_OVER_BUDGET );
+
+            if ( Count == 0 ) {
+
+            /*
+             *  First time through -- lets use the predicted range.
+             */
+            //mlat0 = ((pred_mlat-delta) <  0.0) ?  0.0 : (pred_mlat-delta);
+            if (delta > 20.0) delta = 20.0;
+
+            mlat0 = pred_mlat-delta;
+            mlat_try = pred_mlat;
+            mlat1 = pred_mlat+delta;
+
+            /*
+             *  If other searches have left lines at this MLT in the
+             *  cache, see if they bracket the line we want.
+             */
+            if ( LstarInfo->FieldLineCache != NULL ) {
+                Lgm_FieldLineCache_Bracket( LstarInfo->FieldLineCache, MLT, LstarInfo->mInfo->Bm, I, pred_mlat, &mlat0, &mlat_try, &mlat1, LstarInfo );
+            }
+
+        } else if ( Count == 1 ) {
+
+            /*
+             * Perhaps our bracket was no good -- too narrow. Enlarge it.
+             * Try double what we had.
+             */
+            delta *= 2;
+            if (delta < 1.0) delta = 1.0;
+            mlat0 = pred_mlat-delta;
+            mlat_try = pred_mlat;
+            mlat1 = pred_mlat+delta;
+
+            if ( LstarInfo->nImI0 > 2 ) {
+                for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
+                //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
+                //FitLineAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
+                FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
+                if (LstarInfo->VerbosityLevel > 1){
+                    printf("\t\t\t1> Fitting to available values. Predicted mlat: %g\n", res );
+                }
+                if ( fabs(res) < 90.0 ){
+                    mlat_try = res;
+                    mlat0 = res-1.0;
+                    mlat1 = res+1.0;
+                }
+            }
+
+
+        } else if ( Count == 2 ) {
+
+                /*
+                 * Hmmm... This ones stuborn! Lets be more conservative now.
+                * Try +1/-5 around the returned mlat
+                */
+
+            //if ( FoundShellLine == -3 ) {
+            //    mlat0 = ((mlat-5.0) >  -10.0) ?  -10.0 : (mlat-5.0);
+            //    mlat1 = ((mlat+1.0) > 90.0) ? 90.0 : (mlat+1.0);
+            //} else {
+            //    mlat0 = ((mlat-1.0) >  -10.0) ?  -10.0 : (mlat-1.0);
+            //    mlat1 = ((mlat+5.0) > 90.0) ? 90.0 : (mlat+5.0);
+           //// }
+            mlat_try = pred_mlat;
+            mlat0 = mlat_try-5.0;
+            mlat1 = mlat_try+1.0;
+
+            if ( LstarInfo->nImI0 > 3 ) {
+                for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
+                //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
+                FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
+                if (LstarInfo->VerbosityLevel > 1){
+                    printf("\t\t\t2> Fitting to available values. Predicted mlat: %g\n", res );
+                }
+                if ( fabs(res) < 90.0 ){
+                    mlat_try = res;
+                    mlat0 = res-5.0;
+                    mlat1 = res+5.0;
+                }
+            }
+
+
+        } else {
+
+            /*
+             * OK, there may not be a good line -- i.e. drift shell may not be closed.
+             * To make sure, lets try 0->90 deg.
+             */
+            //mlat0 = 0.0;
+            mlat_try = pred_mlat;
+            mlat0 = -60.0;
+//mlat0 = 0.0;
+            mlat1 = 90.0;
+//mlat1 = 45.0;
+//mlat1 = 23.855537644144878;
+
+
+
+//printf("?? LstarInfo->nImI0 = %d\n", LstarInfo->nImI0);
+            if ( (LstarInfo->nImI0 > 3) && (LstarInfo->nImI0%4 == 0) ){
+                for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
+                //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
+                FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
+                if (LstarInfo->VerbosityLevel > 1){
+                    printf("\t\t\t3> Fitting to available values. Predicted mlat: %g\n", res );
+                }
+                if ( fabs(res) < 90.0 ){
+                    mlat_try = res;
+                    mlat0 = res-45.0;
+                    mlat1 = res+45.0;
+                }
+            }
+
+
+        }
+
+
+        if (LstarInfo->VerbosityLevel > 1) {
+            printf("\n\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
+            printf("\t\t%s             Field Line %02d of %02d   MLT: %g  (Predicted mlat: %g %g %g  delta: %g)   Count: %d          %s\n", PreStr, k+1, nLines, MLT, mlat0, pred_mlat, mlat1, delta, Count, PostStr );
+            printf("\t\t%s________________________________________________________________________________________________________________________________%s\n", PreStr, PostStr );
+        }
+
+        t0 = LGM_STAGE_NOW( LstarInfo->mInfo );
+        FoundShellLine = FindShellLine( I, &Ifound, LstarInfo->mInfo->Bm, MLT, &mlat, &r, mlat0, mlat_try, mlat1, &nIts, LstarInfo );
+        if ( LGM_STAGE_FIRE( LstarInfo->mInfo, LGM_STAGE_FINDSHELLLINE, k, t0, Ifound ) ) return( LGM_LSTAR_CANCELLED );
+
+
+
+
+
+
+
+v = LstarInfo->mInfo->Pm_North;
+LstarInfo->mInfo->Hmax = 0.1;
+if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-9, LstarInfo->mInfo ) ){ return(-4); }
+LstarInfo->Spherical_Footprint_Pn[k] = w;
+LstarInfo->mInfo->Hmax = 0.05;
+//Lgm_Vector puke;
+//Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_North, &puke, GSM_TO_SM, LstarInfo->mInfo->c );
+//printf("LstarInfo->mInfo->Pm_North (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
+//Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_South, &puke, GSM_TO_SM, LstarInfo->mInfo->c );
+//printf("LstarInfo->mInfo->Pm_South (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
+//Lgm_Convert_Coords( &LstarInfo->Spherical_Footprint_Pn[k], &puke, GSM_TO_SM, LstarInfo->mInfo->c );
+//printf("LstarInfo->Spherical_Footprint_Pn[k] (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
+if (LstarInfo->VerbosityLevel > 1) {
+printf("\t\t%sTracing Full FL so that we can classify it. Starting at Spherical_Footprint_Pn[%d] = %g %g %g%s\n", PreStr, k, LstarInfo->Spherical_Footprint_Pn[k].x, LstarInfo->Spherical_Footprint_Pn[k].y, LstarInfo->Spherical_Footprint_Pn[k].z, PostStr );
+}
+Lgm_TraceLine( &LstarInfo->Spherical_Footprint_Pn[k], &v2, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-8, FALSE, LstarInfo->mInfo );
+if (LstarInfo->VerbosityLevel > 1) {
+printf("\t\t%sTraced Full FL so that we can classify it. Step size along FL: %g. Number of points: %d.%s\n", PreStr, LstarInfo->mInfo->Hmax, LstarInfo->mInfo->nPnts, PostStr );
+}
+LstarInfo->Spherical_Footprint_Ps[k] = v2;
+//Lgm_Convert_Coords( &LstarInfo->Spherical_Footprint_Ps[k], &puke, GSM_TO_SM, LstarInfo->mInfo->c );
+//printf("LstarInfo->Spherical_Footprint_Ps[k] (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
+
+        Type = ClassifyFL( k, LstarInfo );
+        if (LstarInfo->VerbosityLevel > 1) {
+            printf("\t\t%sClassifying FL: Type = %d. %s\n", PreStr, Type, PostStr );
+        }
+
+// CRAP
+//for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) if ( LstarInfo->nMinima[i] > 2 ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
+        if ( (Type > 1) && (0==1) ){
+            if (LstarInfo->VerbosityLevel > 1) {
+                printf("\t\t\t%sShabansky orbit. Re-doing FL. Target I adjusted to: %g . (Original is: %g) %s\n", PreStr, I/2.0, I, PostStr );
+            }
+
+            FoundShellLine = FindShellLine( I/2.0, &Ifound, LstarInfo->mInfo->Bm, MLT, &mlat, &r, mlat0, mlat_try, mlat1, &nIts, LstarInfo );
+
+            PredMinusActualMlat = pred_mlat - mlat;
+            if (LstarInfo->VerbosityLevel > 1) {
+                printf("\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
+                printf("\t\t%s  >>  Pred/Actual/Diff mlat:  %g/%g/%g  MLT/MLAT: %g %g  I0: %g I: %g I-I0/2: %g (SHABANSKY)%s\n", PreStr, pred_mlat, mlat, PredMinusActualMlat, MLT, mlat, I, Ifound, Ifound-I/2.0, PostStr );
+                printf("\t\t%s________________________________________________________________________________________________________________________________ %s\n\n\n", PreStr, PostStr );
+            }
+
+        } else {
+
+            PredMinusActualMlat = pred_mlat - mlat;
+            if (LstarInfo->VerbosityLevel > 1) {
+                printf("\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
+                printf("\t\t%s  >>  Pred/Actual/Diff mlat:  %g/%g/%g  MLT/MLAT: %g %g  I0: %g I: %g I-I0: %g %s\n", PreStr, pred_mlat, mlat, PredMinusActualMlat, MLT, mlat, I, Ifound, Ifound-I, PostStr );
+                printf("\t\t%s________________________________________________________________________________________________________________________________ %s\n\n\n", PreStr, PostStr );
+            }
+
+
+        }
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+        if ( FoundShellLine > 0 ) {
+            done2 = TRUE;
+        } else if ( Count >= MaxCount ) {
+            done2 =  TRUE;
+            if ( (LstarInfo->VerbosityLevel >1) && (MaxCount > 2) ) { printf(" \t%sNo valid I - Drift Shell not closed: L* = undefined  (FoundShellLine = %d)%s\n", PreStr, FoundShellLine, PostStr); fflush(stdout); }
+            FoundShellLine = 0;
+            return(-3);
+        } else {
+            ++Count;
+        }
+        }
+
+
+    if (LstarInfo->VerbosityLevel > 2) { printf("\t\t%sActual mlat = %g  MLT = %g   r = %g Ifound = %g\t Count = %d%s", PreStr, mlat, MLT, r, Ifound, Count, PostStr ); fflush(stdout); }
+
+
+
+    /*
+     *  Note that FindShellLine() takes in MLT and returns mlat, rad. The three
+     *  values  (MLT, mlat, rad) are notionally supposed to represent the
+     *  position of the northern mirror point.  However, if we are close to the
+     *  equator, we may have initially confused the north and south mirror
+     *  points. We end up sorting the confusion out, but we really need to make
+     *  sure that as we proceed, we refer to the correct values.
+     *
+     *
+     *
+     */
+//        u = LstarInfo->mInfo->Pm_North;
+//        Lgm_Convert_Coords( &u, &v, GSM_TO_SM, LstarInfo->mInfo->c );
+//        r    = Lgm_Magnitude( &v );
+//        mlat = asin( v.z/r )*DegPerRad;
+
+
+
+
+    /*
+     * Save individual I values
+     */
+    LstarInfo->I[k] = Ifound;
+
+
+
+
+    /*
+     *  convert mirror point to GSM.
+     */
+//why are we doing this?
+// why does this seem to change?
+//        Phi = 15.0*(MLT-12.0)*RadPerDeg;
+//        cl = cos( mlat * RadPerDeg ); sl = sin( mlat * RadPerDeg );
+//        u.x = r*cl*cos(Phi); u.y = r*cl*sin(Phi); u.z = r*sl;
+//        Lgm_Convert_Coords( &u, &v, SM_TO_GSM, LstarInfo->mInfo->c );
+
+    /*
+     * Save GSM cartesian as well...
+     */
+    v = LstarInfo->mInfo->Pm_North;
+    LstarInfo->Mirror_Pn[k] = v;
+    LstarInfo->Mirror_Sn[k] = LstarInfo->mInfo->Sm_North;
+
+    LstarInfo->Mirror_Ps[k] = LstarInfo->mInfo->Pm_South;
+    LstarInfo->Mirror_Ss[k] = LstarInfo->mInfo->Sm_South;
+
+    /*
+     *  Trace to earth to get the footpoint. Note that we are trying to
+     *  compute L* here, and to do that, we eventually need to integrate B
+     *  dot dA to get magnetic flux. We could trace down to the ellipsoid,
+     *  but that would complicate the integral. Its much easier to do the
+     *  integral on a sphere. So, instead of tracing to ellipsoid, we will
+     *  trace to the spherical approx to the Earth instead. There is no
+     *  loss of generality in doing this when calculating L*, but we need
+     *  to take note that the footpoints obtained are not relative to the
+     *  elipsoid.
+     */
+    LstarInfo->mInfo->Hmax = 0.1;
+//        if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-7, LstarInfo->mInfo ) ){ return(-4); }
+    if ( LstarInfo->SaveShellLines && ( LstarInfo->Outputs & LGM_OUT_FOOTPOINTS ) ) {
+        /*
+         *  We will want the ellipsoid footpoint as well below. Both come out
+         *  of the same trace down, so get them together.
+         */
+        if ( !(FlagEn = Lgm_TraceToEarthAndSphere( &v, &vEn, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-11, &sSn, LstarInfo->mInfo )) ){ return(-4); }
+        dSn = LstarInfo->mInfo->Trace_s - sSn;
+    } else {
+        if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-11, LstarInfo->mInfo ) ){ return(-4); }
+    }
+    LstarInfo->Spherical_Footprint_Pn[k] = w;
+
+    /*
+     *  convert footpoint back to SM
+     */
+    Lgm_Convert_Coords( &w, &v, GSM_TO_SM, LstarInfo->mInfo->c );
+    Phi = atan2( v.y, v.x );
+    LstarInfo->MLT[k]  = Phi*DegPerRad/15.0 + 12.0;
+    LstarInfo->mlat[k] = asin( v.z/Lgm_Magnitude(&v) )*DegPerRad;
+    if (LstarInfo->VerbosityLevel > 2)  { printf(" \t\t\t%sMLT_foot, mlat_foot = %g %g%s\n\n", PreStr, LstarInfo->MLT[k], LstarInfo->mlat[k], PostStr); fflush(stdout); }
+
+
+    /*
+     * If SaveShellLines is set true, then retrace the FL and save the
+     * whole FL.  Note that since we appear to only have the north
+     * footpoint, we start there and trace to south. So lets pack them in
+     * the saved arrays backwards so that they go from south to north.
+     */
+    if ( ( LstarInfo->Outputs & LGM_OUT_PMIN ) || LstarInfo->ComputeVgc ) {
+        //Lgm_TraceToMinBSurf( &LstarInfo->Spherical_Footprint_Pn[k], &v2, 0.1, 1e-8, LstarInfo->mInfo );
+        Lgm_TraceToMinBSurf( &LstarInfo->Spherical_Footprint_Pn[k], &v2, 0.1, 1e-8, LstarInfo->mInfo );
+        LstarInfo->mInfo->Bfield( &v2, &LstarInfo->Bmin[k], LstarInfo->mInfo );
+        LstarInfo->Pmin[k] = v2;
+    }
+
+    /*
+     * Compute the gradient of I, Sb and Vgc
+     */
+    if ( LstarInfo->ComputeVgc ) {
+        // Lgm_Grad_I() and other rotuines may modify mInfo in undesirable ways, so give it a copy.
+        mInfo2 = Lgm_CopyMagInfo( LstarInfo->mInfo );
+
+        mInfo2->FirstCall = TRUE;
+        mInfo2->Lgm_n_Sb_integrand_Calls = 0;
+        mInfo2->Lgm_Sb_Integrator_epsabs = 0.0;
+        mInfo2->Lgm_Sb_Integrator_epsrel = 1e-3;
+        double Sb = SbIntegral( mInfo2 );
+Sb = 1.0;
+
+        Lgm_Grad_I( &LstarInfo->Pmin[k], &LstarInfo->GradI[k], mInfo2 );
+
+        LstarInfo->mInfo->Bfield( &LstarInfo->Pmin[k], &Bvec, LstarInfo->mInfo );
+        printf("\t\tB = %g %g %g\n", Bvec.x, Bvec.y, Bvec.z);
+        B = Lgm_NormalizeVector( &Bvec );   // nT
+        B *= 1e-9;                          // T
+        printf("\t\tB = %g T\n", B);
+
+        Lgm_FreeMagInfo( mInfo2 );
+
+        double K = LstarInfo->KineticEnergy;       // keV
+K = 1000.0; //keV
+        K *= 1e3*LGM_e;                        // Joules
+        double M = LstarInfo->Mass;                // kg
+M = ELECTRON_MASS; // kg
+
+
+        /*
+         * Note: Kinetic energy is difference between total E and rest Energy
+         * In non-rel. limit, the factor g=2. So ration of Non Rel to Rel velocity is
+         * (2Eta+2)/(Eta+2)
+         */
+        double Eta = K/(M*CC*CC);
+        double g = K*(2.0+Eta)/(1.0+Eta);
+
+
+        double q = 1.0;            // units of elementary charge
+        q *= 1.6021e-19;    // Coulombs
+        Sb *= 6371e3;       // m
+        double f = g/(q*Sb*B)/1000.0;
+
+        Lgm_Vector Vcg;
+        Lgm_CrossProduct( &LstarInfo->GradI[k], &Bvec, &Vcg );
+        Vcg.x *= f; Vcg.y *= f; Vcg.z *= f;
+        printf("\t\tEta = %g    <Vcg>_non./<vcg>_rel. = %g (%g)\n", Eta, (2.0*Eta+2.0)/(Eta+2.0), (Eta+2.0)/(2.0*Eta+2.0));
+        printf("\t\t<Vcg> = %g, %g, %g    km/s\n\n\n", Vcg.x, Vcg.y, Vcg.z);
+        LstarInfo->Vgc[k] = Vcg;
+
+    }
+
+    if ( LstarInfo->SaveShellLines ) {
+
+        Lgm_TraceLine( &LstarInfo->Spherical_Footprint_Pn[k], &v2, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-8, FALSE, LstarInfo->mInfo );
+        LstarInfo->Spherical_Footprint_Ps[k] = v2;
+//FILE *fppp;
+//double AlphaEq;
+//fppp = fopen("FL.txt","a");
+//AlphaEq = asin( sqrt( Lgm_Magnitude( &LstarInfo->Bmin[k]) /LstarInfo->mInfo->Bm ) );
+//for (i=0; i<LstarInfo->mInfo->nPnts; i++){
+////fprintf(fppp, "%g %g\n", LstarInfo->mInfo->s[i], LstarInfo->mInfo->Bmag[i]);
+//fprintf(fppp, "%g:     %g %g %g %g\n", LstarInfo->MLT[k], LstarInfo->mInfo->Px[i], LstarInfo->mInfo->Py[i], LstarInfo->mInfo->Pz[i], AlphaEq*DegPerRad );
+//}
+//fclose(fppp);
+
+//Type = ClassifyFL( k, LstarInfo );
+//printf("k, Type = %d %d\n", k, Type);
+        LstarInfo->nMinMax = k;
+
+        nnn = LstarInfo->mInfo->nPnts; smax = LstarInfo->mInfo->s[nnn-1];
+        for (tkk=0, nfp=nnn-1; nfp>=0; nfp--){
+            if ( LstarInfo->mInfo->Bmag[nfp] > 0.0 ) {
+                LstarInfo->s_gsm[k][tkk] = smax - LstarInfo->mInfo->s[nfp];
+                LstarInfo->Bmag[k][tkk]  = LstarInfo->mInfo->Bmag[nfp];
+                LstarInfo->x_gsm[k][tkk] = LstarInfo->mInfo->Px[nfp];
+                LstarInfo->y_gsm[k][tkk] = LstarInfo->mInfo->Py[nfp];
+                LstarInfo->z_gsm[k][tkk] = LstarInfo->mInfo->Pz[nfp];
+                ++tkk;
+            }
+        }
+        LstarInfo->nFieldPnts[k] = tkk;
+
+
+
+        LstarInfo->Spherical_Footprint_Ss[k] = LstarInfo->s_gsm[k][0];
+        LstarInfo->Spherical_Footprint_Sn[k] = smax;
+
+
+        /*
+         * Find true footpoints (i.e. relative to ellipsoid), we may want to do an additional trace here...
+         */
+        Hmax = LstarInfo->mInfo->Hmax;
+        LstarInfo->mInfo->Hmax = 0.001;
+        //if ( Lgm_TraceToEarth( &LstarInfo->Spherical_Footprint_Ps[k], &LstarInfo->Ellipsoid_Footprint_Ps[k], LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
+        if ( ( LstarInfo->Outputs & LGM_OUT_FOOTPOINTS ) && Lgm_TraceToEarth( &LstarInfo->Spherical_Footprint_Ps[k], &LstarInfo->Ellipsoid_Footprint_Ps[k], LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
+
+            LstarInfo->Ellipsoid_Footprint_Ss[k] = LstarInfo->Spherical_Footprint_Ss[k] - LstarInfo->mInfo->Trace_s; // should be slightly negative
+
+            // the northern one came from the trace to the spherical footpoint above
+            if ( FlagEn == 1 ) {
+
+                LstarInfo->Ellipsoid_Footprint_Pn[k] = vEn;
+                LstarInfo->Ellipsoid_Footprint_Sn[k] = LstarInfo->Spherical_Footprint_Sn[k] + dSn;
+
+            }
+
+        }
+        LstarInfo->mInfo->Hmax = Hmax;
+
+        /*
+         *  So far, the way we have done this, we have never really needed
+         *  to know the distance of the mirror points from the footpoints.
+         *  To compute these, trace from Pm_south back to southern
+         *  spherical footpoint. Then add this distance to Sm_South and
+         *  Sm_North. That should give the distance of both mirror points
+         *  rtelativen to the southern spherical footpoint -- which is how
+         *  the field line is defined that we are trying to save.
+         */
+        //if ( Lgm_TraceToSphericalEarth( &LstarInfo->Mirror_Ps[k], &uu, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ){
+         if ( ( LstarInfo->Outputs & LGM_OUT_MIRROR ) && Lgm_TraceToSphericalEarth( &LstarInfo->Mirror_Ps[k], &uu, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
+            LstarInfo->Mirror_Ss[k] += LstarInfo->mInfo->Trace_s;
+            LstarInfo->Mirror_Sn[k] += LstarInfo->mInfo->Trace_s;
+        }
+
+
+
+
+
+    }
+
+    *delta_io = delta;
+    *mlat_io  = mlat;
+    *nIts_io  = nIts;
+    *PredMinusActualMlat_io = PredMinusActualMlat;
+
+    return( 0 );
+
+}
+
+
+
+#if USE_OPENMP
+/*
+ *  Copy the results for shell line k from Src (a per-thread copy of the
+ *  LstarInfo structure) back into Dst.
+ */
+static void Lstar_CopyShellLine( int k, Lgm_LstarInfo *Dst, Lgm_LstarInfo *Src ) {
+
+    Dst->I[k]         = Src->I[k];
+    Dst->Mirror_Pn[k] = Src->Mirror_Pn[k]; Dst->Mirror_Sn[k] = Src->Mirror_Sn[k];
+    Dst->Mirror_Ps[k] = Src->Mirror_Ps[k]; Dst->Mirror_Ss[k] = Src->Mirror_Ss[k];
+
+    Dst->Spherical_Footprint_Pn[k] = Src->Spherical_Footprint_Pn[k]; Dst->Spherical_Footprint_Sn[k] = Src->Spherical_Footprint_Sn[k];
+    Dst->Spherical_Footprint_Ps[k] = Src->Spherical_Footprint_Ps[k]; Dst->Spherical_Footprint_Ss[k] = Src->Spherical_Footprint_Ss[k];
+    Dst->Ellipsoid_Footprint_Pn[k] = Src->Ellipsoid_Footprint_Pn[k]; Dst->Ellipsoid_Footprint_Sn[k] = Src->Ellipsoid_Footprint_Sn[k];
+    Dst->Ellipsoid_Footprint_Ps[k] = Src->Ellipsoid_Footprint_Ps[k]; Dst->Ellipsoid_Footprint_Ss[k] = Src->Ellipsoid_Footprint_Ss[k];
+
+    Dst->MLT[k]   = Src->MLT[k];   Dst->mlat[k] = Src->mlat[k];
+    Dst->Pmin[k]  = Src->Pmin[k];  Dst->Bmin[k] = Src->Bmin[k];
+    Dst->GradI[k] = Src->GradI[k]; Dst->Vgc[k]  = Src->Vgc[k];
+    Dst->nMinima[k] = Src->nMinima[k]; Dst->nMaxima[k] = Src->nMaxima[k];
+
+    if ( Src->SaveShellLines ) Lgm_LstarInfo_CopyShellLinePnts( k, Dst, Src );
+
+}
+
+
+/*
+ *  Find shell lines Lines[0..nTasks-1] in parallel, each searched for
+ *  around pred_mlat[n] +/- delta[n]. Every thread works on its own copy of
+ *  LstarInfo (the structure is big, so it is one copy per thread, not per
+ *  line) and the results are copied back into LstarInfo as they are found.
+ *  Found[k] is set for the lines that were found and MirrorMlat[k] gets
+ *  their mlats.
+ *
+ *  A line that cant be found isnt an error here (see Lstar_ParallelShell()),
+ *  but a failed trace to the Earth is. Returns 0 or -4.
+ */
+static int Lstar_ShellLines_Parallel( int nTasks, int *Lines, double *MLT, double I, double *pred_mlat, double *delta, int *Found, double *MirrorMlat, Lgm_LstarInfo *LstarInfo ) {
+
+    int             n, k, rc, nIts, Error = 0;
+    double          mlat, d, PredMinusActualMlat;
+    Lgm_LstarInfo   *LstarInfo2;
+
+    #pragma omp parallel private(LstarInfo2,n,k,rc,nIts,mlat,d,PredMinusActualMlat)
+    {
+
+        LstarInfo2 = Lgm_CopyLstarInfo( LstarInfo );
+        LstarInfo2->mInfo->Lgm_nMagEvals = 0;
+        Lgm_MagModelInfo_ResetStats( LstarInfo2->mInfo );
+
+        #pragma omp for schedule(dynamic, 1)
+        for ( n=0; n<nTasks; n++ ) {
+
+            if ( Error ) continue;
+
+            /*
+             *  Start each line from the same integrator state, so the
+             *  answer doesnt depend on which thread did what before.
+             */
+            LstarInfo2->mInfo->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
+            LstarInfo2->mInfo->Lgm_MagStep_BS_FirstTimeThrough  = TRUE;
+            LstarInfo2->mInfo->Lgm_MagStep_BS_eps_old = -1.0;
+            if ( Lgm_GetDeterministic() ) Lgm_MagStep_ResetState( LstarInfo2->mInfo );
+
+            k    = Lines[n];
+            d    = delta[n];
+            mlat = pred_mlat[n];
+            nIts = 0; PredMinusActualMlat = 0.0;
+            rc = Lstar_ShellLine( k, LstarInfo->nFLsInDriftShell, 1, MLT[k], I, pred_mlat[n], &d, &mlat, &PredMinusActualMlat, &nIts, LstarInfo2 );
+            if ( ( rc == -4 ) || ( rc == LGM_LSTAR_CANCELLED ) || ( rc == LGM_LSTAR_OVER_BUDGET ) ) {
+                Error = rc;
+            } else if ( rc >= 0 ) {
+                Lstar_CopyShellLine( k, LstarInfo, LstarInfo2 );
+                MirrorMlat[k] = mlat;
+                Found[k]      = TRUE;
+            }
+
+        }
+
+        #pragma omp critical (Lstar_ShellLines_Parallel)
+        {
+            LstarInfo->mInfo->Lgm_nMagEvals += LstarInfo2->mInfo->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( LstarInfo->mInfo, LstarInfo2->mInfo );
+        }
+        FreeLstarInfo( LstarInfo2 );
+
+    }
+
+    return( Error );
+
+}
+
+
+/*
+ *  Predict the mlat of line k by interpolating in MLT between the nearest
+ *  lines either side of it that have been found (line 0 always has been).
+ *  *Spread is the difference in mlat between those two lines.
+ */
+static void Lstar_InterpShellMlat( int k, int nLines, double *MLT, int *Found, double *MirrorMlat, double *pred_mlat, double *Spread ) {
+
+    int     ka, kb;
+    double  MLTa, MLTb;
+
+    for ( ka=k-1; !Found[ka]; ka-- );
+    for ( kb=k+1; ( kb < nLines ) && !Found[kb]; kb++ );
+
+    MLTa = MLT[ka];
+    if ( kb < nLines ) {
+        MLTb = MLT[kb];
+    } else {
+        kb = 0; MLTb = MLT[0] + 24.0;
+    }
+
+    *pred_mlat = MirrorMlat[ka] + ( MLT[k] - MLTa )/( MLTb - MLTa )*( MirrorMlat[kb] - MirrorMlat[ka] );
+    *Spread    = fabs( MirrorMlat[kb] - MirrorMlat[ka] );
+
+}
+
+
+/*
+ *  Parallel version of the MLT loop in Lstar() (used when
+ *  LstarInfo->ParallelDriftShell is set). The serial loop seeds each line
+ *  with the ones before it, which doesnt parallelize. Here line 0 (the one
+ *  through the starting point) is done first, then a coarse set of about
+ *  LGM_LSTAR_NCOARSE lines spread over all MLTs is done in parallel, seeded
+ *  only by line 0 (and by the last shell, PrevShell, or the min-B map if
+ *  there is one). The remaining
+ *  lines are then all done in parallel, seeded by interpolating between
+ *  the lines found either side of them.
+ *
+ *  Near the edge of the closed drift shells the searches are touchy, and
+ *  seeds from a few hours of MLT away may not be good enough. Any lines
+ *  that werent found are retried one at a time, in order, seeded from
+ *  their neighbours (which by then are mostly known). Only if that fails
+ *  too is the shell taken to be open.
+ *
+ *  Returns 0 on success or the error that Lstar() should return.
+ */
+#define LGM_LSTAR_NCOARSE   8
+static int Lstar_ParallelShell( int nLines, double *MLT, double I, double mlat, double Bmin0, int UseMinBMap, Lgm_ShellHistoryEntry *PrevShell, double *MirrorMLT, double *MirrorMlat, Lgm_LstarInfo *LstarInfo ) {
+
+    int     k, nTasks, Stride, rc, Prev, nIts = 0;
+    int     Lines[LGM_LSTARINFO_MAX_FL], Found[LGM_LSTARINFO_MAX_FL];
+    double  pred_mlat[LGM_LSTARINFO_MAX_FL], delta[LGM_LSTARINFO_MAX_FL];
+    double  d, Spread, pred_delta_mlat, map_mlat, map_mlat0, PredMinusActualMlat = 0.0;
+
+    for ( k=0; k<nLines; k++ ) {
+        MirrorMLT[k] = MLT[k];
+        Found[k]     = FALSE;
+    }
+
+    /*
+     *  Line 0 is the one through the starting point.
+     */
+    d  = 0.001;
+    rc = Lstar_ShellLine( 0, nLines, 3, MLT[0], I, mlat, &d, &mlat, &PredMinusActualMlat, &nIts, LstarInfo );
+    if ( rc < 0 ) return( rc );
+    MirrorMlat[0] = mlat;
+    Found[0]      = TRUE;
+
+    /*
+     *  Coarse pass.
+     */
+    Stride = nLines/LGM_LSTAR_NCOARSE;
+    if ( Stride < 1 ) Stride = 1;
+    for ( nTasks=0, k=Stride; k<nLines; k += Stride ) {
+        Lines[nTasks]     = k;
+        pred_mlat[nTasks] = MirrorMlat[0];
+        delta[nTasks]     = 3.0;
+        if ( PrevShell != NULL ) {
+            pred_mlat[nTasks] += Lgm_ShellHistory_Mlat( PrevShell, MLT[k] ) - Lgm_ShellHistory_Mlat( PrevShell, MLT[0] );
+            delta[nTasks]      = LGM_LSTAR_CONT_DELTA;
+        } else if ( UseMinBMap && Lgm_MinBMap_FootMlat( LstarInfo->MinBMap, MLT[k], Bmin0, &map_mlat )
+                               && Lgm_MinBMap_FootMlat( LstarInfo->MinBMap, MLT[0], Bmin0, &map_mlat0 ) ) {
+            pred_mlat[nTasks] += map_mlat - map_mlat0;
+            delta[nTasks]      = 1.0;
+        }
+        ++nTasks;
+    }
+    if ( ( rc = Lstar_ShellLines_Parallel( nTasks, Lines, MLT, I, pred_mlat, delta, Found, MirrorMlat, LstarInfo ) ) < 0 ) return( rc );
+
+    /*
+     *  Everything else, seeded from the lines we have.
+     */
+    for ( nTasks=0, k=1; k<nLines; k++ ) {
+        if ( Found[k] || ( k%Stride == 0 ) ) continue;
+        Lines[nTasks] = k;
+        Lstar_InterpShellMlat( k, nLines, MLT, Found, MirrorMlat, &pred_mlat[nTasks], &Spread );
+        delta[nTasks] = 0.5 + 0.5*Spread;
+        ++nTasks;
+    }
+    if ( ( rc = Lstar_ShellLines_Parallel( nTasks, Lines, MLT, I, pred_mlat, delta, Found, MirrorMlat, LstarInfo ) ) < 0 ) return( rc );
+
+    /*
+     *  Mop up any we missed. These are done in order, so everything before
+     *  line k is known by the time we get to it and it can be predicted the
+     *  same way the serial loop does it.
+     */
+    for ( Prev=FALSE, k=1; k<nLines; k++ ) {
+        if ( Found[k] ) { Prev = FALSE; continue; }
+        PredictMlat2( MirrorMLT, MirrorMlat, k, MLT[k], &pred_mlat[0], &pred_delta_mlat, &d, LstarInfo );
+        d = ( ( k < 3 ) || !Prev ) ? 3.0 : 1.5*fabs( PredMinusActualMlat );
+        mlat = pred_mlat[0];
+        if ( ( rc = Lstar_ShellLine( k, nLines, 3, MLT[k], I, pred_mlat[0], &d, &mlat, &PredMinusActualMlat, &nIts, LstarInfo ) ) < 0 ) return( rc );
+        MirrorMlat[k] = mlat;
+        Found[k]      = TRUE;
+        Prev          = TRUE;
+    }
+
+    if ( LstarInfo->SaveShellLines ) LstarInfo->nMinMax = nLines-1;
+
+    return( 0 );
+
+}
+#endif
+
+
+
+/*
+ *  Periodic (in 24h of MLT) cubic spline through the n points (x[i], y[i]),
+ *  leaving out point Skip (-1 to use them all), evaluated at X. The x[]
+ *  must be increasing and span less than 24h.
+ */
+static double Lstar_PeriodicSpline( int n, double *x, double *y, int Skip, double X ) {
+
+    int                 i, j, m;
+    double              xa[3*LGM_LSTARINFO_MAX_FL], ya[3*LGM_LSTARINFO_MAX_FL], f;
+    gsl_interp_accel    *acc;
+    gsl_interp          *pspline;
+
+    for ( m=0, j=-1; j<=1; j++ ) {
+        for ( i=0; i<n; i++ ) {
+            if ( i == Skip ) continue;
+            xa[m] = x[i] + 24.0*j; ya[m] = y[i]; ++m;
+        }
+    }
+
+    X = x[0] + fmod( X - x[0], 24.0 ); if ( X < x[0] ) X += 24.0;
+
+    acc     = gsl_interp_accel_alloc( );
+    pspline = gsl_interp_alloc( gsl_interp_cspline_periodic, m );
+    gsl_interp_init( pspline, xa, ya, m );
+    f = gsl_interp_eval( pspline, xa, ya, X, acc );
+    gsl_interp_free( pspline );
+    gsl_interp_accel_free( acc );
+
+    return( f );
+
+}
+
+
+/*
+ *  Add lines to a drift shell until L* is good to LstarInfo->AdaptiveLstarTol
+ *  (used instead of a fixed nFLsInDriftShell when that is > 0).
+ *
+ *  The shell starts with the nLines (coarse) lines Lstar() found, in MLT
+ *  order from the starting point. Each round, every footpoint is left out
+ *  in turn and predicted from the spline through the others. That miss is
+ *  the spline error for twice the local spacing, so a sixteenth of it (the
+ *  error goes as h^4) is taken as the error of the spline between the
+ *  footpoint and its neighbours. The error in mlat is turned into an error in L* with the
+ *  dipole flux, Phi ~ Int cos^2(mlat) dphi (so dL/L = dPhi/Phi), and the
+ *  intervals that add up to the most error are split at their mid-MLT
+ *  until what is left is under half the tolerance. Quiet shells stop after
+ *  the coarse pass, distorted ones get lines only where they bend.
+ *
+ *  New lines are appended (line k = nLines, nLines+1, ...), so the lines
+ *  are no longer in MLT order when this returns. Returns the number of
+ *  lines in the shell, or the error that Lstar() should return.
+ */
+#define LGM_LSTAR_ADAPTIVE_NFL0     8       // Lines in the first (coarse) drift shell when refining (twice this for ISearchMethod 2, whose predictions need closer lines)
+#define LGM_LSTAR_ADAPTIVE_LOO      16.0    // Leave-one-out miss / spline error at the full spacing
+static int Lstar_RefineShell( int nLines, double I, int ParallelShell, double *MirrorMLT, double *MirrorMlat, Lgm_LstarInfo *LstarInfo ) {
+
+    int     i, j, k, a, n, nNew, nMax, rc, nIts = 0;
+    int     Order[LGM_LSTARINFO_MAX_FL], NewOrder[LGM_LSTARINFO_MAX_FL], Split[LGM_LSTARINFO_MAX_FL], Done[LGM_LSTARINFO_MAX_FL], Lines[LGM_LSTARINFO_MAX_FL];
+    double  X[LGM_LSTARINFO_MAX_FL], Y[LGM_LSTARINFO_MAX_FL], Xs[LGM_LSTARINFO_MAX_FL], Ys[LGM_LSTARINFO_MAX_FL];
+    double  Res[LGM_LSTARINFO_MAX_FL], dL[LGM_LSTARINFO_MAX_FL], pred_mlat[LGM_LSTARINFO_MAX_FL], delta[LGM_LSTARINFO_MAX_FL];
+    double  Tol, Sum, D, L, r, h, c, Err, x0, x1, mlat, d, PredMinusActualMlat = 0.0;
+
+    Tol  = LstarInfo->AdaptiveLstarTol;
+    nMax = LstarInfo->AdaptiveMaxFLs;
+    if ( nMax > LGM_LSTARINFO_MAX_FL ) nMax = LGM_LSTARINFO_MAX_FL;
+    r    = 1.0 + LstarInfo->mInfo->Lgm_LossConeHeight/WGS84_A;
+
+    for ( n=0; n<nLines; n++ ) Order[n] = n;
+
+    while ( n < nMax ) {
+
+        /*
+         *  Footpoints in shell order, with the MLTs unwrapped. If they dont
+         *  come out in order, fall back to the MLTs the lines were found at.
+         */
+        for ( i=0; i<n; i++ ) {
+            k = Order[i];
+            Xs[i] = MirrorMLT[k]; Ys[i] = MirrorMlat[k];
+            X[i]  = LstarInfo->MLT[k]; Y[i] = LstarInfo->mlat[k];
+            if ( i > 0 ) while ( X[i] < X[i-1] ) X[i] += 24.0;
+        }
+        if ( X[n-1] - X[0] >= 24.0 ) for ( i=0; i<n; i++ ) X[i] = Xs[i];
+
+        for ( i=0; i<n; i++ ) Res[i] = fabs( Y[i] - Lstar_PeriodicSpline( n, X, Y, i, X[i] ) );
+
+        for ( D=0.0, i=0; i<n; i++ ) {
+            j = (i+1)%n; h = ( ( j > 0 ) ? X[j] : X[0]+24.0 ) - X[i];
+            c = cos( 0.5*( Y[i]+Y[j] )*RadPerDeg );
+            D += c*c*h*15.0*RadPerDeg;
+        }
+        L = 2.0*M_PI*r/D;
+
+        for ( Sum=0.0, i=0; i<n; i++ ) {
+            j   = (i+1)%n; h = ( ( j > 0 ) ? X[j] : X[0]+24.0 ) - X[i];
+            Err = ( ( Res[i] > Res[j] ) ? Res[i] : Res[j] )/LGM_LSTAR_ADAPTIVE_LOO;
+            dL[i] = 0.5*L*fabs( sin( ( Y[i]+Y[j] )*RadPerDeg ) )*Err*RadPerDeg*h*15.0*RadPerDeg/D;
+            Sum  += dL[i];
+        }
+
+        if (LstarInfo->VerbosityLevel > 1) printf("\t\t%sRefining drift shell: %d lines, estimated error in L* = %g (tolerance %g)%s\n", LstarInfo->PreStr, n, Sum, Tol, LstarInfo->PostStr );
+        if ( Sum <= Tol ) break;
+
+        /*
+         *  Out of budget -- settle for the shell we have.
+         */
+        if ( Lstar_OverBudget( LstarInfo ) ) {
+            LstarInfo->LSApproximate = TRUE;
+            break;
+        }
+
+        /*
+         *  Split the worst intervals until what is left would add up to
+         *  less than Tol/2.
+         */
+        for ( i=0; i<n; i++ ) Split[i] = FALSE;
+        for ( nNew=0; ( Sum > 0.5*Tol ) && ( n+nNew < nMax ); nNew++ ) {
+            for ( a=-1, i=0; i<n; i++ ) if ( !Split[i] && ( ( a < 0 ) || ( dL[i] > dL[a] ) ) ) a = i;
+            if ( a < 0 ) break;
+            Split[a] = TRUE;
+            Sum    -= dL[a];
+        }
+
+        for ( nNew=0, i=0; i<n; i++ ) {
+            if ( !Split[i] ) continue;
+            j  = (i+1)%n;
+            k  = n + nNew;
+            x0 = Xs[i]; x1 = ( j > 0 ) ? Xs[j] : Xs[0]+24.0;
+            MirrorMLT[k] = 0.5*( x0 + x1 );
+            pred_mlat[nNew] = Lstar_PeriodicSpline( n, Xs, Ys, -1, MirrorMLT[k] );
+            d = 4.0*( ( Res[i] > Res[j] ) ? Res[i] : Res[j] )/LGM_LSTAR_ADAPTIVE_LOO;
+            if ( d > LGM_LSTAR_CONT_DELTA )     d = LGM_LSTAR_CONT_DELTA;
+            if ( d < LGM_LSTAR_CONT_MIN_DELTA ) d = LGM_LSTAR_CONT_MIN_DELTA;
+            delta[nNew] = d;
+            Lines[nNew] = k;
+            ++nNew;
+        }
+
+        /*
+         *  Find the new lines. In parallel (if we are doing that) first, then
+         *  any that werent found are retried with the usual widening.
+         */
+        for ( i=0; i<nNew; i++ ) Done[i] = FALSE;
+#if USE_OPENMP
+        if ( ParallelShell ) {
+            int Found[LGM_LSTARINFO_MAX_FL];
+            for ( i=0; i<nNew; i++ ) Found[Lines[i]] = FALSE;
+            rc = Lstar_ShellLines_Parallel( nNew, Lines, MirrorMLT, I, pred_mlat, delta, Found, MirrorMlat, LstarInfo );
+            if ( rc == LGM_LSTAR_OVER_BUDGET ) {
+                LstarInfo->LSApproximate = TRUE;
+                break;
+            } else if ( rc < 0 ) {
+                return( rc );
+            }
+            for ( i=0; i<nNew; i++ ) Done[i] = Found[Lines[i]];
+        }
+#endif
+        for ( i=0; i<nNew; i++ ) {
+            if ( Done[i] ) continue;
+            k = Lines[i]; d = delta[i]; mlat = pred_mlat[i];
+            rc = Lstar_ShellLine( k, nMax, 3, MirrorMLT[k], I, pred_mlat[i], &d, &mlat, &PredMinusActualMlat, &nIts, LstarInfo );
+            if ( rc == LGM_LSTAR_OVER_BUDGET ) {
+                LstarInfo->LSApproximate = TRUE;
+                break;
+            } else if ( rc < 0 ) {
+                return( rc );
+            }
+            MirrorMlat[k] = mlat;
+        }
+
+        /*
+         *  The new lines are all past line n-1, so if we ran out of budget
+         *  finding them, just leave them out.
+         */
+        if ( LstarInfo->LSApproximate ) break;
+
+        /*
+         *  Slot the new lines in after the lines they split (line 0 is always
+         *  first, so nothing wraps).
+         */
+        for ( nNew=0, j=0, i=0; i<n; i++ ) {
+            NewOrder[j++] = Order[i];
+            if ( Split[i] ) NewOrder[j++] = n + nNew++;
+        }
+        for ( i=0; i<j; i++ ) Order[i] = NewOrder[i];
+        n = j;
+
+    }
+
+    if ( LstarInfo->SaveShellLines ) LstarInfo->nMinMax = n-1;
+
+    return( n );
+
+}
+
+
+
+/*
+ *  Lstar() for a pure dipole (see Lgm_Dipole.c). Every line of the drift
+ *  shell is the same L shell, so L* = L M_cd_2010/M_cd exactly and nothing
+ *  needs to be traced or searched for. The shell lines are still filled in
+ *  (mirror points, I, northern spherical footpoints, Pmin, Bmin, MLT and
+ *  mlat) so that callers find what Lstar() normally leaves behind.
+ */
+static int Lstar_Dipole( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ) {
+
+    int                 k, nLines, rc;
+    double              I, Sb, SS, Lat, Phi, Phi1;
+    Lgm_MagModelInfo    *m = LstarInfo->mInfo;
+    Lgm_DipoleFL        f, g;
+    Lgm_Vector          v1, v2, v3, w, v;
+    char                *PreStr, *PostStr;
+
+    PreStr  = LstarInfo->PreStr;
+    PostStr = LstarInfo->PostStr;
+
+    if ( Lgm_Dipole_Trace( vin, &v1, &v2, &v3, m->Lgm_LossConeHeight, m ) != LGM_CLOSED ) {
+        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sOpen Field Line%s\n", PreStr, PostStr );
+        return(-5);
+    }
+    LstarInfo->Sb0     = m->Sb0;
+    LstarInfo->d2B_ds2 = m->d2B_ds2;
+    LstarInfo->RofC    = m->RofC;
+
+    Lgm_Dipole_Line( &m->Pmin, &f, m );
+    if ( ( rc = Lgm_Dipole_MirrorPoints( m->Bm, &f, &m->Pm_South, &m->Pm_North, &SS, m ) ) < 0 ) {
+        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sMirror point below %g km in %s Hemisphere%s\n", PreStr, m->Lgm_LossConeHeight, ( rc == -2 ) ? "Southern" : "Northern", PostStr );
+        return( rc );
+    }
+    m->Sm_South = 0.0;
+    m->Sm_North = SS;
+    Lgm_Dipole_Integrals( m->Bm, &f, &I, &Sb );
+    LstarInfo->I0          = I;
+    LstarInfo->SbIntegral0 = ( LstarInfo->ComputeSbIntegral ) ? Sb : LGM_FILL_VALUE;
+    if (LstarInfo->VerbosityLevel > 1) printf("\t\t  %sIntegral Invariant, I (dipole):        %g%s\n",  PreStr, I, PostStr );
+
+
+    /*
+     *  The shell lines, evenly spaced in longitude about the dipole axis.
+     */
+    nLines = LstarInfo->nFLsInDriftShell;
+    if ( nLines < 4 ) nLines = 4;
+    if ( nLines > LGM_LSTARINFO_MAX_FL ) nLines = LGM_LSTARINFO_MAX_FL;
+    g = f;
+    for ( k=0; k<nLines; k++ ) {
+
+        g.Phi = f.Phi + 2.0*M_PI*(double)k/(double)nLines;
+        if ( ( rc = Lgm_Dipole_MirrorPoints( m->Bm, &g, &LstarInfo->Mirror_Ps[k], &LstarInfo->Mirror_Pn[k], &SS, m ) ) < 0 ) return( rc );
+        LstarInfo->Mirror_Ss[k] = 0.0;
+        LstarInfo->Mirror_Sn[k] = SS;
+        LstarInfo->I[k]         = I;
+
+        if ( !Lgm_Dipole_FootLat( m->Lgm_LossConeHeight, TRUE, 1.0, &g, &Lat, m ) ) return( -4 );
+        Lgm_Dipole_Point( Lat, &g, &w, m );
+        LstarInfo->Spherical_Footprint_Pn[k] = w;
+        Lgm_Convert_Coords( &w, &v, GSM_TO_SM, m->c );
+        Phi = atan2( v.y, v.x );
+        LstarInfo->MLT[k]  = Phi*DegPerRad/15.0 + 12.0;
+        LstarInfo->mlat[k] = asin( v.z/Lgm_Magnitude(&v) )*DegPerRad;
+
+        Lgm_Dipole_Point( 0.0, &g, &LstarInfo->Pmin[k], m );
+        m->Bfield( &LstarInfo->Pmin[k], &LstarInfo->Bmin[k], m );
+        LstarInfo->nMinima[k] = 1;
+        LstarInfo->nMaxima[k] = 0;
+
+    }
+    LstarInfo->nPnts = nLines;
+    quicksort2( LstarInfo->nPnts, LstarInfo->MLT-1, LstarInfo->mlat-1 );
+
+
+    /*
+     *  The dipole approximation still comes from the footpoint curve (for an
+     *  eccentric dipole it isnt exact).
      */
-    t->mInfo = Lgm_CopyMagInfo( s->mInfo );
+    for ( k=0; k<nLines; ++k ){
+        LstarInfo->xa[k]          = LstarInfo->MLT[k]-24.0; LstarInfo->ya[k]          = LstarInfo->mlat[k];
+        LstarInfo->xa[k+nLines]   = LstarInfo->MLT[k];      LstarInfo->ya[k+nLines]   = LstarInfo->mlat[k];
+        LstarInfo->xa[k+2*nLines] = LstarInfo->MLT[k]+24.0; LstarInfo->ya[k+2*nLines] = LstarInfo->mlat[k];
+    }
+    LstarInfo->nSplnPnts = 3*nLines;
+    LstarInfo->acc     = gsl_interp_accel_alloc( );
+    LstarInfo->pspline = gsl_interp_alloc( gsl_interp_cspline_periodic, LstarInfo->nSplnPnts );
+    gsl_interp_init( LstarInfo->pspline, LstarInfo->xa, LstarInfo->ya, LstarInfo->nSplnPnts );
+    Phi1 = MagFlux( LstarInfo );
+    gsl_interp_free( LstarInfo->pspline );
+    gsl_interp_accel_free( LstarInfo->acc );
 
+    LstarInfo->LS_dip_approx  = -2.0*M_PI*m->c->M_cd_2010/Phi1;
+    LstarInfo->LS             = f.L*m->c->M_cd_2010/f.M;
+    LstarInfo->LS_McIlwain_M  = f.L*m->c->M_cd_McIllwain/f.M;
+    LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED;
 
-    t->mInfo->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
-    t->mInfo->Lgm_MagStep_BS_FirstTimeThrough = TRUE;
-    t->mInfo->Lgm_MagStep_BS_eps_old = -1.0;
+    if (LstarInfo->VerbosityLevel > 1) {
+        printf("\n\t\t%sL*, Dipole Approximation.\n%s", PreStr, PostStr );
+        printf("\t\t%s  L*:                                    %.15lf%s\n", PreStr, LstarInfo->LS_dip_approx, PostStr );
+        printf("\n\t\t%sL*, Pure Dipole Field (L = %.15lf).%s\n", PreStr, f.L, PostStr );
+        printf("\t\t%s  L*:                                    %.15lf%s\n", PreStr, LstarInfo->LS, PostStr );
+        printf("\t\t%s  L* (Using McIllwain M):                %.15lf%s\n", PreStr, LstarInfo->LS_McIlwain_M, PostStr );
+        printf("\n\t\t%sDrift Orbit Type: CLOSED%s\n\n\n\n", PreStr, PostStr );
+    }
 
+    return( 1 );
 
-    return( t );
 }
 
 
 
+/*
+ *  What Lstar() settles for when the budget (see Lgm_SetLstarBudget()) runs
+ *  out before the drift shell is complete: McIlwain's L from the I and Bm of
+ *  the starting line, scaled to the reference moments the way L* is (so it
+ *  is exact in a dipole, and usually within some 10% in quiet fields).
+ */
+static int Lstar_Approximate( Lgm_LstarInfo *LstarInfo ) {
 
+    double  L, M;
 
+    if ( ( LstarInfo->I0 == LGM_FILL_VALUE ) || ( LstarInfo->I0 < 0.0 ) ) {
+        LstarInfo->LS = LGM_FILL_VALUE;
+        return( -1 );
+    }
 
+    M = LstarInfo->mInfo->c->M_cd;
+    L = LFromIBmM_McIlwain( LstarInfo->I0, LstarInfo->mInfo->Bm, M );
+    LstarInfo->LS             = L*LstarInfo->mInfo->c->M_cd_2010/M;
+    LstarInfo->LS_McIlwain_M  = L*LstarInfo->mInfo->c->M_cd_McIllwain/M;
+    LstarInfo->LS_dip_approx  = LstarInfo->LS;
+    LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED;
+    LstarInfo->LSApproximate  = TRUE;
+    if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sOut of L* budget: using McIlwain L (L* ~ %g)%s\n", LstarInfo->PreStr, LstarInfo->LS, LstarInfo->PostStr );
 
+    return( LGM_LSTAR_APPROXIMATE );
 
-void NewTimeLstarInfo( long int Date, double UT, double PitchAngle, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_LstarInfo *LstarInfo ){
-
-
-    /*
-     *  Set coord transforms for given data and time
-     */
-    Lgm_Set_Coord_Transforms( Date, UT, LstarInfo->mInfo->c );
+}
 
 
-    /*
-     *  Set mag field model
-     */
-    LstarInfo->mInfo->Bfield = Mag;
+/*
+ *  If a stage callback cancels (see Lgm_StageHooks.c), whatever the body was
+ *  doing fails and we return LGM_LSTAR_CANCELLED instead of its error code.
+ *  If the budget runs out, an approximate L* is returned (see
+ *  Lgm_SetLstarBudget()).
+ */
+static int Lstar_Body( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo );
+int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
 
+    int     rc;
 
-    /*
-     *  Set Pitch Angle
-     */
-    LstarInfo->PitchAngle = PitchAngle;
+    LstarInfo->LSApproximate = FALSE;
+    if ( LGM_STAGE_CANCELLED( LstarInfo->mInfo ) ) {
+        LstarInfo->LS = LGM_FILL_VALUE;
+        return( LGM_LSTAR_CANCELLED );
+    }
+    if ( LstarInfo->MaxLstarTime > 0.0 ) LstarInfo->BudgetDeadline = Lgm_StageHooks_Now() + LstarInfo->MaxLstarTime;
+    if ( LstarInfo->MaxLstarMagEvals > 0 ) LstarInfo->BudgetMagEvals = LGM_NMAGEVALS_TOTAL( LstarInfo->mInfo ) + LstarInfo->MaxLstarMagEvals;
+
+    rc = Lstar_Body( vin, LstarInfo );
+    if ( ( rc < 0 ) && LGM_STAGE_CANCELLED( LstarInfo->mInfo ) ) {
+        LstarInfo->LS = LGM_FILL_VALUE;
+        rc = LGM_LSTAR_CANCELLED;
+    } else if ( rc == LGM_LSTAR_OVER_BUDGET ) {
+        rc = Lstar_Approximate( LstarInfo );
+    } else if ( ( rc > 0 ) && LstarInfo->LSApproximate ) {
+        rc = LGM_LSTAR_APPROXIMATE;
+    }
 
+    return( rc );
 
 }
 
+static int Lstar_Body( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
 
 
-
-int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
-
-
-    Lgm_Vector	u, v, w, v1, v2, v3, Bvec, uu;
-    int		i, j, k, nk, nLines, koffset, tkk, nfp, nnn;
-    int		done2, Count, FoundShellLine, nIts, Type;
-    double	rat, B, dSa, dSb, smax, SS, L, Hmax, epsabs, epsrel;
-    double	I=-999.9, Ifound, M, MLT0, MLT, DeltaMLT, mlat, r;
-    double	Phi, Phi1, Phi2, sl, cl, MirrorMLT[3*LGM_LSTARINFO_MAX_FL], MirrorMlat[3*LGM_LSTARINFO_MAX_FL], pred_mlat, mlat_try, pred_delta_mlat=0.0, mlat0, mlat1, delta;
-    double	MirrorMLT_Old[3*LGM_LSTARINFO_MAX_FL], MirrorMlat_Old[3*LGM_LSTARINFO_MAX_FL], res;
+    Lgm_Vector	u, v1, v2, v3, Bvec;
+    int		i, j, k, nk, nLines, koffset, rc;
+    int		nIts;
+    double	rat, B, dSa, dSb, SS, L, epsabs, epsrel;
+    double	I=-999.9, M, MLT0, MLT, DeltaMLT, mlat;
+    double	Phi1, Phi2, sl, cl, MirrorMLT[3*LGM_LSTARINFO_MAX_FL], MirrorMlat[3*LGM_LSTARINFO_MAX_FL], pred_mlat, pred_delta_mlat=0.0, delta;
+    double	Bmin0=-1.0, map_mlat, map_mlat_prev, t0;
+    int		UseMinBMap, ParallelShell, UsePrev;
+    Lgm_ShellHistoryEntry   Prev;
     char    *PreStr, *PostStr;
-    Lgm_MagModelInfo    *mInfo2;
 //    FILE	*fp;
 
     PreStr = LstarInfo->PreStr;
@@ -604,6 +1956,22 @@ int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
 
     for (k=0; k<LGM_LSTARINFO_MAX_FL; k++){
         LstarInfo->I[k] = LGM_FILL_VALUE;
+        LstarInfo->nFieldPnts[k] = 0;
+    }
+
+    /*
+     *  Storage for the shell lines is only allocated if we need it.
+     */
+    if ( LstarInfo->SaveShellLines && !Lgm_LstarInfo_AllocShellLines( LstarInfo ) ) {
+        LstarInfo->SaveShellLines = FALSE;
+    }
+
+    /*
+     *  A pure dipole has a closed-form answer (unless the whole shell lines
+     *  or drift velocities were asked for).
+     */
+    if ( Lgm_Dipole_IsPure( LstarInfo->mInfo ) && !LstarInfo->SaveShellLines && !LstarInfo->ComputeVgc ) {
+        return( Lstar_Dipole( vin, LstarInfo ) );
     }
 
 
@@ -621,6 +1989,7 @@ int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
     }
     if ( Lgm_Trace( &u, &v1, &v2, &v3, LstarInfo->mInfo->Lgm_LossConeHeight, TRACE_TOL, TRACE_TOL, LstarInfo->mInfo ) == LGM_CLOSED ) {
 
+        Bmin0              = LstarInfo->mInfo->Bmin;
         LstarInfo->Sb0     = LstarInfo->mInfo->Sb0; // Equatorial value of Sb Integral.
         LstarInfo->d2B_ds2 = LstarInfo->mInfo->d2B_ds2; // second derivative of B wrt s at equator.
         LstarInfo->RofC    = LstarInfo->mInfo->d2B_ds2; // radius of curvature at Bmin point.
@@ -694,7 +2063,6 @@ int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
 
                 //LstarInfo->mInfo->Hmax = SS/200.0;
                 LstarInfo->mInfo->Hmax = SS/(double)LstarInfo->mInfo->nDivs;
-                r  = Lgm_Magnitude( &LstarInfo->mInfo->Pm_North );
                 LstarInfo->mInfo->Sm_South = 0.0;
                 LstarInfo->mInfo->Sm_North = SS;
 
@@ -717,655 +2085,310 @@ int Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo ){
 
                     //ReplaceFirstPoint( 0.0, LstarInfo->mInfo->Bm, &LstarInfo->mInfo->Pm_South, LstarInfo->mInfo );
                     //AddNewPoint( SS,  LstarInfo->mInfo->Bm, &LstarInfo->mInfo->Pm_North, LstarInfo->mInfo );
-                    //ReplaceLastPoint( SS,  LstarInfo->mInfo->Bm, &LstarInfo->mInfo->Pm_North, LstarInfo->mInfo );
-                    if ( InitSpline( LstarInfo->mInfo ) ) {
-
-                        /*
-                         *  Do interped I integral.
-                         */
-//                        epsabs = LstarInfo->mInfo->Lgm_I_Integrator_epsabs;
-//                        epsrel = LstarInfo->mInfo->Lgm_I_Integrator_epsrel;
-//                        LstarInfo->mInfo->Lgm_I_Integrator_epsabs /= 10.0;
-//                        LstarInfo->mInfo->Lgm_I_Integrator_epsrel /= 10.0;
-                        I = Iinv_interped( LstarInfo->mInfo  );
-                        if (LstarInfo->VerbosityLevel > 1) {
-                            printf("\t\t  %sIntegral Invariant, I (interped):      %g%s\n",  PreStr, I, PostStr );
-                        }
-//                        LstarInfo->mInfo->Lgm_I_Integrator_epsabs = epsabs;
-//                        LstarInfo->mInfo->Lgm_I_Integrator_epsrel = epsrel;
-
-                        /*
-                         *  Do interped Sb integral if desired. Note this is
-                         *  just for the initial FL (which is why we call it
-                         *  SbIntegral0). Can also add for each MLT if we want
-                         *  to (then we should probably add an array called
-                         *  SbIntegral[]).
-                         */
-                        LstarInfo->SbIntegral0 = LGM_FILL_VALUE;
-                        if ( LstarInfo->ComputeSbIntegral ) {
-                            LstarInfo->SbIntegral0 = SbIntegral_interped( LstarInfo->mInfo  );
-                            if (LstarInfo->VerbosityLevel > 1) {
-                                printf("\t\t  %sSb Integral Equatorially Mirroring:      %g%s\n",  PreStr, LstarInfo->Sb0, PostStr );
-                                printf("\t\t  %sSb Integral, (interped):      %g%s\n",  PreStr, LstarInfo->SbIntegral0, PostStr );
-                            }
-                        }
-
-
-
-                        FreeSpline( LstarInfo->mInfo );
-
-                    } else {
-
-                        I = LGM_FILL_VALUE;
-
-                    }
-
-
-
-                } else {
-
-                    /*
-                     *  Do full blown I integral. (Integrand is evaluated by tracing to required s-values.)
-                     *  (This strategy isnt used very much anymore - 20120524, MGH)
-                     */
-                    I = Iinv( LstarInfo->mInfo  );
-                    if (LstarInfo->VerbosityLevel > 1) printf("\t\t  %sIntegral Invariant, I (full integral): %g%s\n",  PreStr, I, PostStr );
-
-                }
-                LstarInfo->I0 = I; // save initial I in LstarInfo structure.
-                Ifound = I;
-
-
-
-                if (LstarInfo->VerbosityLevel > 1) {
-                    // sort this out. FIX User should decide what M they want to use.
-                    //M = LstarInfo->mInfo->c->M_cd;
-                    //M = LstarInfo->mInfo->c->M_cd_McIllwain;
-                    M = LstarInfo->mInfo->c->M_cd_2010;
-                    printf("\t\t  %sLgm_n_I_integrand_Calls:               %d%s\n\n", PreStr, LstarInfo->mInfo->Lgm_n_I_integrand_Calls, PostStr );
-                    printf("\t\t%sCurrent Dipole Moment, M_cd:             %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd, PostStr);
-                    printf("\t\t%sReference Dipole Moment, M_cd_McIllwain: %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd_McIllwain, PostStr);
-                    printf("\t\t%sReference Dipole Moment, M_cd_2010:      %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd_2010, PostStr);
-                    printf("\t\t%sDipole Moment Used, Mused:               %g%s\n", PreStr, M, PostStr);
-                    printf("\t\t%sMcIlwain L (Hilton):                     %.15g%s\n", PreStr, L = LFromIBmM_Hilton( I, LstarInfo->mInfo->Bm, M ), PostStr );
-                    printf("\t\t%sMcIlwain L (McIlwain):                   %.15g%s\n", PreStr, L = LFromIBmM_McIlwain( I, LstarInfo->mInfo->Bm, M ), PostStr );
-                }
-
-            } else {
-
-	            if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sMirror point below %g km in Northern Hemisphere%s\n", PreStr, LstarInfo->mInfo->Lgm_LossConeHeight, PostStr );
-	            return(-1);
-
-	        }
-
-        } else {
-
-	        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sMirror point below %g km in Southern Hemisphere%s\n", PreStr, LstarInfo->mInfo->Lgm_LossConeHeight, PostStr );
-	        return(-2);
-
-        }
-
-    } else {
-
-	        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sOpen Field Line%s\n", PreStr, PostStr );
-	        return(-5);
-
-    }
-
-
-
-
-
-
-    /*
-     *  If we get here, then the field line going through our starting point is
-     *  closed and we could find the required mirror points.
-     */
-
-
-
-
-    // initialize DriftOrbitType as open
-    //for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) if ( LstarInfo->nMinima[i] > 1 ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
-    //for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
-
-
-
-    /*
-     *  Construct drift shell. Get a good initial estimate for mlat
-     */
-    if        ( LstarInfo->ISearchMethod  == 1 ) {
-        // this method uses the mlat as the mlat of the mirror point.
-        Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_North, &u, GSM_TO_SM, LstarInfo->mInfo->c );
-   
-    } else if ( LstarInfo->ISearchMethod  == 2 ) {
-
-        // this method uses the mlat as the mlat of the footpoint.
-        Lgm_Convert_Coords( &v2, &u, GSM_TO_SM, LstarInfo->mInfo->c );
-
-    } else {
-
-        printf("Unrecognized value for LstarInfo->ISearchMethod ( = %d)\n", LstarInfo->ISearchMethod );
-
-    }
-    mlat = DegPerRad*asin(u.z/Lgm_Magnitude( &u ));
-
-
-    MLT0 = atan2( u.y, u.x )*DegPerRad/15.0 + 12.0;
-    if (LstarInfo->VerbosityLevel > 2) printf("\t\t%smlat = %g%s\n", PreStr, mlat, PostStr );
-    LstarInfo->nPnts = 0;
-    pred_delta_mlat  = 0.0;
-    for (k=0; k<3*LGM_LSTARINFO_MAX_FL; ++k){
-	    MirrorMLT[k]  = 0.0;
-	    MirrorMlat[k] = 0.0;
-    }
-
-
-
-    nLines = LstarInfo->nFLsInDriftShell;
-    DeltaMLT = 24.0/((double)nLines);
-
-    delta = 3.0; // default
-    for ( k=0, MLT=MLT0; MLT<(MLT0+24.0-1e-10); MLT += DeltaMLT){
-
-	    /*
-	     *  Try to predict what the next mlat should be so we can really
-	     *  narrow down the bracket.
-	     */
-	    if (k == 0 ){
-
-	        pred_mlat 	    = mlat;
-	        pred_delta_mlat = 0.001;
-	        delta           = 0.001;
-	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat1 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
-
-	    } else if ( k > 0 ) {
-
-	        PredictMlat2( MirrorMLT, MirrorMlat, k, MLT, &pred_mlat, &pred_delta_mlat, &delta, LstarInfo );
-	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat2 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
-
-	    } else {
-
-	        PredictMlat1( MirrorMLT, MirrorMlat, k, MLT, &pred_mlat, &pred_delta_mlat, &delta );
-	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat3 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
-
-	    }
-
-
-        /*
-         * Set the range to search over. If this turns out to be too small,
-         * it'll get expanded in subsequent attempts.
-         */
-        if ( k == 0 ){
-            delta           = 0.001;
-        } else if ( k < 3 ){
-            delta = 3.0;
-        } else {
-            if (nIts > 1) delta = 1.5*fabs( PredMinusActualMlat );
-        }
-
-
-
-        /*
-         * Loop until we are done. We will be done when we have either;
-         *
-         *    1) found I to the requested tolerance or
-         *    2) I cannot be found after several attempts.
-         *
-         *  Each attempt is kept track of by the 'Count' variable.  The
-         *  strategy is to make a reasonable estimate for the search range on
-         *  mlat. If this doesnt work, we expand the size of the range.
-         *
-         */
-	    done2 = FALSE; FoundShellLine = FALSE; Count = 0;
-        LstarInfo->nImI0 = 0;
-	    while ( !done2 && (k > 0) ) {
-
-	        if ( Count == 0 ) {
-
-                /*
-                 *  First time through -- lets use the predicted range.
-                 */
-                //mlat0 = ((pred_mlat-delta) <  0.0) ?  0.0 : (pred_mlat-delta);
-                if (delta > 20.0) delta = 20.0;
-
-                mlat0 = pred_mlat-delta;
-                mlat_try = pred_mlat;
-                mlat1 = pred_mlat+delta;
-
-    	    } else if ( Count == 1 ) {
-
-                /*
-                 * Perhaps our bracket was no good -- too narrow. Enlarge it.
-                 * Try double what we had.
-                 */
-                delta *= 2;
-                if (delta < 1.0) delta = 1.0;
-                mlat0 = pred_mlat-delta;
-                mlat_try = pred_mlat;
-                mlat1 = pred_mlat+delta;
-
-                if ( LstarInfo->nImI0 > 2 ) {
-                    for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
-                    //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
-                    //FitLineAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
-                    FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
-                    if (LstarInfo->VerbosityLevel > 1){
-                        printf("\t\t\t1> Fitting to available values. Predicted mlat: %g\n", res );
-                    }
-                    if ( fabs(res) < 90.0 ){
-                        mlat_try = res;
-                        mlat0 = res-1.0;
-                        mlat1 = res+1.0;
-                    }
-                }
-
-
-            } else if ( Count == 2 ) {
-
-	            /*
-	             * Hmmm... This ones stuborn! Lets be more conservative now.
-	            * Try +1/-5 around the returned mlat
-	            */
-
-                //if ( FoundShellLine == -3 ) {
-                //    mlat0 = ((mlat-5.0) >  -10.0) ?  -10.0 : (mlat-5.0);
-                //    mlat1 = ((mlat+1.0) > 90.0) ? 90.0 : (mlat+1.0);
-                //} else {
-                //    mlat0 = ((mlat-1.0) >  -10.0) ?  -10.0 : (mlat-1.0);
-                //    mlat1 = ((mlat+5.0) > 90.0) ? 90.0 : (mlat+5.0);
-               //// }
-                mlat_try = pred_mlat;
-                mlat0 = mlat_try-5.0;
-                mlat1 = mlat_try+1.0;
-
-                if ( LstarInfo->nImI0 > 3 ) {
-                    for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
-                    //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
-                    FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
-                    if (LstarInfo->VerbosityLevel > 1){ 
-                        printf("\t\t\t2> Fitting to available values. Predicted mlat: %g\n", res ); 
-                    }
-                    if ( fabs(res) < 90.0 ){
-                        mlat_try = res;
-                        mlat0 = res-5.0;
-                        mlat1 = res+5.0;
-                    }
-                }
-
-
-    	    } else {
-
-                /*
-                 * OK, there may not be a good line -- i.e. drift shell may not be closed.
-                 * To make sure, lets try 0->90 deg.
-                 */
-                //mlat0 = 0.0;
-                mlat_try = pred_mlat;
-                mlat0 = -60.0;
-//mlat0 = 0.0;
-                mlat1 = 90.0;
-//mlat1 = 45.0;
-//mlat1 = 23.855537644144878;
-
-
-
-//printf("?? LstarInfo->nImI0 = %d\n", LstarInfo->nImI0);
-                if ( (LstarInfo->nImI0 > 3) && (LstarInfo->nImI0%4 == 0) ){
-                    for (i=0; i<LstarInfo->nImI0; i++) LstarInfo->Earr[i] = 1.0;
-                    //FitQuadAndFindZero2( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, 4, &res );
-                    FitQuadAndFindZero( LstarInfo->MLATarr, LstarInfo->ImI0arr, LstarInfo->Earr, LstarInfo->nImI0, &res );
-                    if (LstarInfo->VerbosityLevel > 1){
-                        printf("\t\t\t3> Fitting to available values. Predicted mlat: %g\n", res );
-                    }
-                    if ( fabs(res) < 90.0 ){
-                        mlat_try = res;
-                        mlat0 = res-45.0;
-                        mlat1 = res+45.0;
-                    }
-                }
-
+                    //ReplaceLastPoint( SS,  LstarInfo->mInfo->Bm, &LstarInfo->mInfo->Pm_North, LstarInfo->mInfo );
+                    if ( InitSpline( LstarInfo->mInfo ) ) {
 
-            }
+                        /*
+                         *  Do interped I integral. If the Sb integral (see
+                         *  below) is wanted too, get both from one pass over
+                         *  the line (see Lgm_BounceIntegrals.c).
+                         */
+//                        epsabs = LstarInfo->mInfo->Lgm_I_Integrator_epsabs;
+//                        epsrel = LstarInfo->mInfo->Lgm_I_Integrator_epsrel;
+//                        LstarInfo->mInfo->Lgm_I_Integrator_epsabs /= 10.0;
+//                        LstarInfo->mInfo->Lgm_I_Integrator_epsrel /= 10.0;
+                        LstarInfo->SbIntegral0 = LGM_FILL_VALUE;
+                        if ( LstarInfo->ComputeSbIntegral ) {
+                            Lgm_BounceIntegrals_interped( LstarInfo->mInfo, &I, &LstarInfo->SbIntegral0, NULL );
+                        } else {
+                            I = Iinv_interped( LstarInfo->mInfo  );
+                        }
+                        if (LstarInfo->VerbosityLevel > 1) {
+                            printf("\t\t  %sIntegral Invariant, I (interped):      %g%s\n",  PreStr, I, PostStr );
+                        }
+//                        LstarInfo->mInfo->Lgm_I_Integrator_epsabs = epsabs;
+//                        LstarInfo->mInfo->Lgm_I_Integrator_epsrel = epsrel;
 
+                        /*
+                         *  Sb integral (done above) if desired. Note this is
+                         *  just for the initial FL (which is why we call it
+                         *  SbIntegral0). Can also add for each MLT if we want
+                         *  to (then we should probably add an array called
+                         *  SbIntegral[]).
+                         */
+                        if ( LstarInfo->ComputeSbIntegral ) {
+                            if (LstarInfo->VerbosityLevel > 1) {
+                                printf("\t\t  %sSb Integral Equatorially Mirroring:      %g%s\n",  PreStr, LstarInfo->Sb0, PostStr );
+                                printf("\t\t  %sSb Integral, (interped):      %g%s\n",  PreStr, LstarInfo->SbIntegral0, PostStr );
+                            }
+                        }
 
-            if (LstarInfo->VerbosityLevel > 1) {
-                printf("\n\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
-                printf("\t\t%s             Field Line %02d of %02d   MLT: %g  (Predicted mlat: %g %g %g  delta: %g)   Count: %d          %s\n", PreStr, k+1, nLines, MLT, mlat0, pred_mlat, mlat1, delta, Count, PostStr );
-                printf("\t\t%s________________________________________________________________________________________________________________________________%s\n", PreStr, PostStr );
-            }
 
-            FoundShellLine = FindShellLine( I, &Ifound, LstarInfo->mInfo->Bm, MLT, &mlat, &r, mlat0, mlat_try, mlat1, &nIts, LstarInfo );
 
+                        FreeSpline( LstarInfo->mInfo );
 
+                    } else {
 
+                        I = LGM_FILL_VALUE;
 
+                    }
 
 
 
-v = LstarInfo->mInfo->Pm_North;
-LstarInfo->mInfo->Hmax = 0.1;
-if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-9, LstarInfo->mInfo ) ){ return(-4); }
-LstarInfo->Spherical_Footprint_Pn[k] = w;
-LstarInfo->mInfo->Hmax = 0.05;
-//Lgm_Vector puke;
-//Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_North, &puke, GSM_TO_SM, LstarInfo->mInfo->c );
-//printf("LstarInfo->mInfo->Pm_North (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
-//Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_South, &puke, GSM_TO_SM, LstarInfo->mInfo->c );
-//printf("LstarInfo->mInfo->Pm_South (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
-//Lgm_Convert_Coords( &LstarInfo->Spherical_Footprint_Pn[k], &puke, GSM_TO_SM, LstarInfo->mInfo->c );
-//printf("LstarInfo->Spherical_Footprint_Pn[k] (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
-if (LstarInfo->VerbosityLevel > 1) {
-    printf("\t\t%sTracing Full FL so that we can classify it. Starting at Spherical_Footprint_Pn[%d] = %g %g %g%s\n", PreStr, k, LstarInfo->Spherical_Footprint_Pn[k].x, LstarInfo->Spherical_Footprint_Pn[k].y, LstarInfo->Spherical_Footprint_Pn[k].z, PostStr );
-}
-Lgm_TraceLine( &LstarInfo->Spherical_Footprint_Pn[k], &v2, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-8, FALSE, LstarInfo->mInfo );
-if (LstarInfo->VerbosityLevel > 1) {
-    printf("\t\t%sTraced Full FL so that we can classify it. Step size along FL: %g. Number of points: %d.%s\n", PreStr, LstarInfo->mInfo->Hmax, LstarInfo->mInfo->nPnts, PostStr );
-}
-LstarInfo->Spherical_Footprint_Ps[k] = v2;
-//Lgm_Convert_Coords( &LstarInfo->Spherical_Footprint_Ps[k], &puke, GSM_TO_SM, LstarInfo->mInfo->c );
-//printf("LstarInfo->Spherical_Footprint_Ps[k] (SM Coords) = %g %g %g\n", puke.x, puke.y, puke.z );
+                } else {
 
-            Type = ClassifyFL( k, LstarInfo );
-            if (LstarInfo->VerbosityLevel > 1) {
-                printf("\t\t%sClassifying FL: Type = %d. %s\n", PreStr, Type, PostStr );
-            }
+                    /*
+                     *  Do full blown I integral. (Integrand is evaluated by tracing to required s-values.)
+                     *  (This strategy isnt used very much anymore - 20120524, MGH)
+                     */
+                    I = Iinv( LstarInfo->mInfo  );
+                    if (LstarInfo->VerbosityLevel > 1) printf("\t\t  %sIntegral Invariant, I (full integral): %g%s\n",  PreStr, I, PostStr );
 
-// CRAP
-//for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) if ( LstarInfo->nMinima[i] > 2 ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
-            if ( (Type > 1) && (0==1) ){
-                if (LstarInfo->VerbosityLevel > 1) {
-                    printf("\t\t\t%sShabansky orbit. Re-doing FL. Target I adjusted to: %g . (Original is: %g) %s\n", PreStr, I/2.0, I, PostStr );
                 }
+                LstarInfo->I0 = I; // save initial I in LstarInfo structure.
 
-                FoundShellLine = FindShellLine( I/2.0, &Ifound, LstarInfo->mInfo->Bm, MLT, &mlat, &r, mlat0, mlat_try, mlat1, &nIts, LstarInfo );
-
-                PredMinusActualMlat = pred_mlat - mlat;
-                if (LstarInfo->VerbosityLevel > 1) {
-                    printf("\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
-                    printf("\t\t%s  >>  Pred/Actual/Diff mlat:  %g/%g/%g  MLT/MLAT: %g %g  I0: %g I: %g I-I0/2: %g (SHABANSKY)%s\n", PreStr, pred_mlat, mlat, PredMinusActualMlat, MLT, mlat, I, Ifound, Ifound-I/2.0, PostStr );
-                    printf("\t\t%s________________________________________________________________________________________________________________________________ %s\n\n\n", PreStr, PostStr );
-                }
 
-            } else {
 
-                PredMinusActualMlat = pred_mlat - mlat;
                 if (LstarInfo->VerbosityLevel > 1) {
-                    printf("\t\t%s________________________________________________________________________________________________________________________________%s\n\n", PreStr, PostStr );
-                    printf("\t\t%s  >>  Pred/Actual/Diff mlat:  %g/%g/%g  MLT/MLAT: %g %g  I0: %g I: %g I-I0: %g %s\n", PreStr, pred_mlat, mlat, PredMinusActualMlat, MLT, mlat, I, Ifound, Ifound-I, PostStr );
-                    printf("\t\t%s________________________________________________________________________________________________________________________________ %s\n\n\n", PreStr, PostStr );
+                    // sort this out. FIX User should decide what M they want to use.
+                    //M = LstarInfo->mInfo->c->M_cd;
+                    //M = LstarInfo->mInfo->c->M_cd_McIllwain;
+                    M = LstarInfo->mInfo->c->M_cd_2010;
+                    printf("\t\t  %sLgm_n_I_integrand_Calls:               %d%s\n\n", PreStr, LstarInfo->mInfo->Lgm_n_I_integrand_Calls, PostStr );
+                    printf("\t\t%sCurrent Dipole Moment, M_cd:             %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd, PostStr);
+                    printf("\t\t%sReference Dipole Moment, M_cd_McIllwain: %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd_McIllwain, PostStr);
+                    printf("\t\t%sReference Dipole Moment, M_cd_2010:      %g%s\n", PreStr, LstarInfo->mInfo->c->M_cd_2010, PostStr);
+                    printf("\t\t%sDipole Moment Used, Mused:               %g%s\n", PreStr, M, PostStr);
+                    printf("\t\t%sMcIlwain L (Hilton):                     %.15g%s\n", PreStr, L = LFromIBmM_Hilton( I, LstarInfo->mInfo->Bm, M ), PostStr );
+                    printf("\t\t%sMcIlwain L (McIlwain):                   %.15g%s\n", PreStr, L = LFromIBmM_McIlwain( I, LstarInfo->mInfo->Bm, M ), PostStr );
                 }
 
+            } else {
 
-            }
-
-
-
-
-
-
-
-
+	            if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sMirror point below %g km in Northern Hemisphere%s\n", PreStr, LstarInfo->mInfo->Lgm_LossConeHeight, PostStr );
+	            return(-1);
 
+	        }
 
+        } else {
 
+	        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sMirror point below %g km in Southern Hemisphere%s\n", PreStr, LstarInfo->mInfo->Lgm_LossConeHeight, PostStr );
+	        return(-2);
 
+        }
 
+    } else {
 
+	        if (LstarInfo->VerbosityLevel > 0) printf("\t\t%sOpen Field Line%s\n", PreStr, PostStr );
+	        return(-5);
 
+    }
 
-            if ( FoundShellLine > 0 ) {
-                done2 = TRUE;
-            } else if ( Count > 2 ) {
-                done2 =  TRUE;
-                if (LstarInfo->VerbosityLevel >1) { printf(" \t%sNo valid I - Drift Shell not closed: L* = undefined  (FoundShellLine = %d)%s\n", PreStr, FoundShellLine, PostStr); fflush(stdout); }
-                FoundShellLine = 0;
-                return(-3);
-            } else {
-                ++Count;
-            }
-	    }
 
 
-        if (LstarInfo->VerbosityLevel > 2) { printf("\t\t%sActual mlat = %g  MLT = %g   r = %g Ifound = %g\t Count = %d%s", PreStr, mlat, MLT, r, Ifound, Count, PostStr ); fflush(stdout); }
 
 
 
-        /*
-         *  Note that FindShellLine() takes in MLT and returns mlat, rad. The three
-         *  values  (MLT, mlat, rad) are notionally supposed to represent the
-         *  position of the northern mirror point.  However, if we are close to the
-         *  equator, we may have initially confused the north and south mirror
-         *  points. We end up sorting the confusion out, but we really need to make
-         *  sure that as we proceed, we refer to the correct values.
-         *
-         *
-         *
-         */
-//        u = LstarInfo->mInfo->Pm_North;
-//        Lgm_Convert_Coords( &u, &v, GSM_TO_SM, LstarInfo->mInfo->c );
-//        r    = Lgm_Magnitude( &v );
-//        mlat = asin( v.z/r )*DegPerRad;
+    /*
+     *  If we get here, then the field line going through our starting point is
+     *  closed and we could find the required mirror points.
+     */
 
 
 
 
-        /*
-         * Save individual I values
-         */
-        LstarInfo->I[k] = Ifound;
+    // initialize DriftOrbitType as open
+    //for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) if ( LstarInfo->nMinima[i] > 1 ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
+    //for ( i=0; i<LGM_LSTARINFO_MAX_FL; ++i ) LstarInfo->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
 
 
-        MirrorMLT[k]  = MLT;
-        MirrorMlat[k] = mlat;
 
+    /*
+     *  Construct drift shell. Get a good initial estimate for mlat
+     */
+    if        ( LstarInfo->ISearchMethod  == 1 ) {
+        // this method uses the mlat as the mlat of the mirror point.
+        Lgm_Convert_Coords( &LstarInfo->mInfo->Pm_North, &u, GSM_TO_SM, LstarInfo->mInfo->c );
+   
+    } else if ( LstarInfo->ISearchMethod  == 2 ) {
 
-        /*
-         *  convert mirror point to GSM.
-         */
-//why are we doing this?
-// why does this seem to change?
-//        Phi = 15.0*(MLT-12.0)*RadPerDeg;
-//        cl = cos( mlat * RadPerDeg ); sl = sin( mlat * RadPerDeg );
-//        u.x = r*cl*cos(Phi); u.y = r*cl*sin(Phi); u.z = r*sl;
-//        Lgm_Convert_Coords( &u, &v, SM_TO_GSM, LstarInfo->mInfo->c );
+        // this method uses the mlat as the mlat of the footpoint.
+        Lgm_Convert_Coords( &v2, &u, GSM_TO_SM, LstarInfo->mInfo->c );
 
-        /*
-         * Save GSM cartesian as well...
-         */
-        v = LstarInfo->mInfo->Pm_North;
-        LstarInfo->Mirror_Pn[k] = v;
-        LstarInfo->Mirror_Sn[k] = LstarInfo->mInfo->Sm_North;
+    } else {
 
-        LstarInfo->Mirror_Ps[k] = LstarInfo->mInfo->Pm_South;
-        LstarInfo->Mirror_Ss[k] = LstarInfo->mInfo->Sm_South;
+        printf("Unrecognized value for LstarInfo->ISearchMethod ( = %d)\n", LstarInfo->ISearchMethod );
 
-        /*
-         *  Trace to earth to get the footpoint. Note that we are trying to
-         *  compute L* here, and to do that, we eventually need to integrate B
-         *  dot dA to get magnetic flux. We could trace down to the ellipsoid,
-         *  but that would complicate the integral. Its much easier to do the
-         *  integral on a sphere. So, instead of tracing to ellipsoid, we will
-         *  trace to the spherical approx to the Earth instead. There is no
-         *  loss of generality in doing this when calculating L*, but we need
-         *  to take note that the footpoints obtained are not relative to the
-         *  elipsoid.
-         */
-        LstarInfo->mInfo->Hmax = 0.1;
-//        if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-7, LstarInfo->mInfo ) ){ return(-4); }
-        if ( !Lgm_TraceToSphericalEarth( &v, &w, LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-11, LstarInfo->mInfo ) ){ return(-4); }
-        LstarInfo->Spherical_Footprint_Pn[k] = w;
+    }
+    mlat = DegPerRad*asin(u.z/Lgm_Magnitude( &u ));
 
-        /*
-         *  convert footpoint back to SM
-         */
-        Lgm_Convert_Coords( &w, &v, GSM_TO_SM, LstarInfo->mInfo->c );
-        Phi = atan2( v.y, v.x );
-        LstarInfo->MLT[k]  = Phi*DegPerRad/15.0 + 12.0;
-        LstarInfo->mlat[k] = asin( v.z/Lgm_Magnitude(&v) )*DegPerRad;
-        if (LstarInfo->VerbosityLevel > 2)  { printf(" \t\t\t%sMLT_foot, mlat_foot = %g %g%s\n\n", PreStr, LstarInfo->MLT[k], LstarInfo->mlat[k], PostStr); fflush(stdout); }
 
+    MLT0 = atan2( u.y, u.x )*DegPerRad/15.0 + 12.0;
+    if (LstarInfo->VerbosityLevel > 2) printf("\t\t%smlat = %g%s\n", PreStr, mlat, PostStr );
+    LstarInfo->nPnts = 0;
+    pred_delta_mlat  = 0.0;
+    for (k=0; k<3*LGM_LSTARINFO_MAX_FL; ++k){
+	    MirrorMLT[k]  = 0.0;
+	    MirrorMlat[k] = 0.0;
+    }
 
-        /*
-         * If SaveShellLines is set true, then retrace the FL and save the
-         * whole FL.  Note that since we appear to only have the north
-         * footpoint, we start there and trace to south. So lets pack them in
-         * the saved arrays backwards so that they go from south to north.
-         */
-LstarInfo->FindShellPmin = TRUE;
-        if ( LstarInfo->FindShellPmin || LstarInfo->ComputeVgc ) {
-            //Lgm_TraceToMinBSurf( &LstarInfo->Spherical_Footprint_Pn[k], &v2, 0.1, 1e-8, LstarInfo->mInfo );
-            Lgm_TraceToMinBSurf( &LstarInfo->Spherical_Footprint_Pn[k], &v2, 0.1, 1e-8, LstarInfo->mInfo );
-            LstarInfo->mInfo->Bfield( &v2, &LstarInfo->Bmin[k], LstarInfo->mInfo );
-            LstarInfo->Pmin[k] = v2;
-        }
 
-        /*
-         * Compute the gradient of I, Sb and Vgc
-         */
-        if ( LstarInfo->ComputeVgc ) {
-            // Lgm_Grad_I() and other rotuines may modify mInfo in undesirable ways, so give it a copy.
-            mInfo2 = Lgm_CopyMagInfo( LstarInfo->mInfo );
-
-            mInfo2->FirstCall = TRUE;
-            mInfo2->Lgm_n_Sb_integrand_Calls = 0;
-            mInfo2->Lgm_Sb_Integrator_epsabs = 0.0;
-            mInfo2->Lgm_Sb_Integrator_epsrel = 1e-3;
-            double Sb = SbIntegral( mInfo2 );
-Sb = 1.0;
 
-            Lgm_Grad_I( &LstarInfo->Pmin[k], &LstarInfo->GradI[k], mInfo2 );
+    /*
+     *  With an L* tolerance set, start with a coarse shell and refine it
+     *  where it needs it (see Lstar_RefineShell()).
+     */
+    if ( LstarInfo->AdaptiveLstarTol > 0.0 ) {
+        nLines = ( LstarInfo->ISearchMethod == 2 ) ? 2*LGM_LSTAR_ADAPTIVE_NFL0 : LGM_LSTAR_ADAPTIVE_NFL0;
+    } else {
+        nLines = LstarInfo->nFLsInDriftShell;
+    }
+    DeltaMLT = 24.0/((double)nLines);
 
-            LstarInfo->mInfo->Bfield( &LstarInfo->Pmin[k], &Bvec, LstarInfo->mInfo );
-            printf("\t\tB = %g %g %g\n", Bvec.x, Bvec.y, Bvec.z);
-            B = Lgm_NormalizeVector( &Bvec );   // nT
-            B *= 1e-9;                          // T
-            printf("\t\tB = %g T\n", B);
+    /*
+     *  If a min-B map is attached, the shift in mlat from one shell line to
+     *  the next is predicted from the constant-Bmin contour through the map
+     *  (see Lgm_MinBMap_FootMlat()).
+     */
+    UseMinBMap = ( LstarInfo->ISearchMethod == 2 ) && ( LstarInfo->MinBMap != NULL ) && ( Bmin0 > 0.0 );
 
-            Lgm_FreeMagInfo( mInfo2 );
+    /*
+     *  If we found a shell for this pitch angle last time (e.g. at the last
+     *  epoch of an orbit) and it is close to this one, use it to predict
+     *  where the lines are (see Lgm_ShellHistory.c).
+     */
+    UsePrev = Lgm_ShellHistory_Get( LstarInfo->ShellHistory, LstarInfo->PitchAngle, LstarInfo->ISearchMethod, &Prev )
+                && ( fabs( Lgm_ShellHistory_Mlat( &Prev, MLT0 ) - mlat ) < LstarInfo->ShellHistory->MaxShift );
 
-            double K = LstarInfo->KineticEnergy;       // keV
-K = 1000.0; //keV
-            K *= 1e3*LGM_e;                        // Joules
-            double M = LstarInfo->Mass;                // kg
-M = ELECTRON_MASS; // kg
+    /*
+     *  Otherwise, the shell of the neighbouring pitch angle (see
+     *  Lgm_ComputeLstarVersusPA()) is nested inside or around this one and
+     *  nearly the same shape, so it predicts the lines just as well.
+     */
+    if ( !UsePrev && ( LstarInfo->NestedShell != NULL ) && ( LstarInfo->NestedShell->nPnts >= 2 )
+                  && ( LstarInfo->NestedShell->ISearchMethod == LstarInfo->ISearchMethod )
+                  && ( fabs( Lgm_ShellHistory_Mlat( LstarInfo->NestedShell, MLT0 ) - mlat ) < LGM_LSTAR_NESTED_MAXSHIFT ) ) {
+        Prev    = *LstarInfo->NestedShell;
+        UsePrev = TRUE;
+    }
 
+    /*
+     *  Optionally find the lines in parallel (see Lstar_ParallelShell()).
+     *  Not if we are already in a parallel region (e.g. one PA of
+     *  Lgm_ComputeLstarVersusPA()) though.
+     */
+#if USE_OPENMP
+    ParallelShell = LstarInfo->ParallelDriftShell && !omp_in_parallel();
+#else
+    ParallelShell = FALSE;
+#endif
 
-            /*
-             * Note: Kinetic energy is difference between total E and rest Energy
-             * In non-rel. limit, the factor g=2. So ration of Non Rel to Rel velocity is
-             * (2Eta+2)/(Eta+2)
-             */
-            double Eta = K/(M*CC*CC);
-            double g = K*(2.0+Eta)/(1.0+Eta);
+    if ( ParallelShell ) {
 
+#if USE_OPENMP
+        double  ShellMLT[LGM_LSTARINFO_MAX_FL];
+        for ( k=0, MLT=MLT0; MLT<(MLT0+24.0-1e-10); MLT += DeltaMLT ) ShellMLT[k++] = MLT;
+        if ( ( rc = Lstar_ParallelShell( k, ShellMLT, I, mlat, Bmin0, UseMinBMap, UsePrev ? &Prev : NULL, MirrorMLT, MirrorMlat, LstarInfo ) ) < 0 ) return( rc );
+#endif
 
-            double q = 1.0;            // units of elementary charge
-            q *= 1.6021e-19;    // Coulombs
-            Sb *= 6371e3;       // m
-            double f = g/(q*Sb*B)/1000.0;
+    } else {
 
-            Lgm_Vector Vcg;
-            Lgm_CrossProduct( &LstarInfo->GradI[k], &Bvec, &Vcg );
-            Vcg.x *= f; Vcg.y *= f; Vcg.z *= f;
-            printf("\t\tEta = %g    <Vcg>_non./<vcg>_rel. = %g (%g)\n", Eta, (2.0*Eta+2.0)/(Eta+2.0), (Eta+2.0)/(2.0*Eta+2.0));
-            printf("\t\t<Vcg> = %g, %g, %g    km/s\n\n\n", Vcg.x, Vcg.y, Vcg.z);
-            LstarInfo->Vgc[k] = Vcg;
+        delta = 3.0; // default
+        for ( k=0, MLT=MLT0; MLT<(MLT0+24.0-1e-10); MLT += DeltaMLT){
 
-        }
+    	    /*
+    	     *  Try to predict what the next mlat should be so we can really
+    	     *  narrow down the bracket.
+    	     */
+    	    if (k == 0 ){
 
-        if ( LstarInfo->SaveShellLines ) {
+    	        pred_mlat 	    = mlat;
+    	        pred_delta_mlat = 0.001;
+    	        delta           = 0.001;
+    	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat1 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
 
-            Lgm_TraceLine( &LstarInfo->Spherical_Footprint_Pn[k], &v2, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-8, FALSE, LstarInfo->mInfo );
-            LstarInfo->Spherical_Footprint_Ps[k] = v2;
-//FILE *fppp;
-//double AlphaEq;
-//fppp = fopen("FL.txt","a");
-//AlphaEq = asin( sqrt( Lgm_Magnitude( &LstarInfo->Bmin[k]) /LstarInfo->mInfo->Bm ) );
-//for (i=0; i<LstarInfo->mInfo->nPnts; i++){
-////fprintf(fppp, "%g %g\n", LstarInfo->mInfo->s[i], LstarInfo->mInfo->Bmag[i]);
-//fprintf(fppp, "%g:     %g %g %g %g\n", LstarInfo->MLT[k], LstarInfo->mInfo->Px[i], LstarInfo->mInfo->Py[i], LstarInfo->mInfo->Pz[i], AlphaEq*DegPerRad );
-//}
-//fclose(fppp);
+    	    } else if ( k > 0 ) {
 
-//Type = ClassifyFL( k, LstarInfo );
-//printf("k, Type = %d %d\n", k, Type);
-            LstarInfo->nMinMax = k;
-
-            nnn = LstarInfo->mInfo->nPnts; smax = LstarInfo->mInfo->s[nnn-1];
-            for (tkk=0, nfp=nnn-1; nfp>=0; nfp--){
-                if ( LstarInfo->mInfo->Bmag[nfp] > 0.0 ) {
-                    LstarInfo->s_gsm[k][tkk] = smax - LstarInfo->mInfo->s[nfp];
-                    LstarInfo->Bmag[k][tkk]  = LstarInfo->mInfo->Bmag[nfp];
-                    LstarInfo->x_gsm[k][tkk] = LstarInfo->mInfo->Px[nfp];
-                    LstarInfo->y_gsm[k][tkk] = LstarInfo->mInfo->Py[nfp];
-                    LstarInfo->z_gsm[k][tkk] = LstarInfo->mInfo->Pz[nfp];
-                    ++tkk;
-                }
-            }
-            LstarInfo->nFieldPnts[k] = tkk;
+    	        PredictMlat2( MirrorMLT, MirrorMlat, k, MLT, &pred_mlat, &pred_delta_mlat, &delta, LstarInfo );
+    	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat2 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
 
+    	    } else {
 
+    	        PredictMlat1( MirrorMLT, MirrorMlat, k, MLT, &pred_mlat, &pred_delta_mlat, &delta );
+    	        if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat3 = %g ( %g : %g )%s ", PreStr, pred_mlat, pred_delta_mlat, delta, PostStr ); fflush(stdout);
 
-            LstarInfo->Spherical_Footprint_Ss[k] = LstarInfo->s_gsm[k][0];
-            LstarInfo->Spherical_Footprint_Sn[k] = smax;
+    	    }
 
 
             /*
-             * Find true footpoints (i.e. relative to ellipsoid), we may want to do an additional trace here...
+             * Set the range to search over. If this turns out to be too small,
+             * it'll get expanded in subsequent attempts.
              */
-            Hmax = LstarInfo->mInfo->Hmax;
-            LstarInfo->mInfo->Hmax = 0.001;
-            //if ( Lgm_TraceToEarth( &LstarInfo->Spherical_Footprint_Ps[k], &LstarInfo->Ellipsoid_Footprint_Ps[k], LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
-            if ( Lgm_TraceToEarth( &LstarInfo->Spherical_Footprint_Ps[k], &LstarInfo->Ellipsoid_Footprint_Ps[k], LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
-
-                LstarInfo->Ellipsoid_Footprint_Ss[k] = LstarInfo->Spherical_Footprint_Ss[k] - LstarInfo->mInfo->Trace_s; // should be slightly negative
-
-                LstarInfo->mInfo->Hmax = 0.001;
-                if ( Lgm_TraceToEarth( &LstarInfo->Spherical_Footprint_Pn[k], &LstarInfo->Ellipsoid_Footprint_Pn[k], LstarInfo->mInfo->Lgm_LossConeHeight, 1.0, 1e-7, LstarInfo->mInfo ) ) {
-
-                    LstarInfo->Ellipsoid_Footprint_Sn[k] = LstarInfo->Spherical_Footprint_Sn[k] + LstarInfo->mInfo->Trace_s;
-
-                }
+            if ( k == 0 ){
+                delta           = 0.001;
+            } else if ( k < 3 ){
+                delta = 3.0;
+            } else {
+                if (nIts > 1) delta = 1.5*fabs( PredMinusActualMlat );
+            }
 
+            if ( UseMinBMap && ( k > 0 ) && Lgm_MinBMap_FootMlat( LstarInfo->MinBMap, MLT, Bmin0, &map_mlat )
+                                         && Lgm_MinBMap_FootMlat( LstarInfo->MinBMap, MirrorMLT[k-1], Bmin0, &map_mlat_prev ) ) {
+                pred_mlat = MirrorMlat[k-1] + map_mlat - map_mlat_prev;
+                if ( delta > 1.0 ) delta = 1.0;
+                if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat from MinBMap = %g%s\n", PreStr, pred_mlat, PostStr );
             }
-            LstarInfo->mInfo->Hmax = Hmax;
 
             /*
-             *  So far, the way we have done this, we have never really needed
-             *  to know the distance of the mirror points from the footpoints.
-             *  To compute these, trace from Pm_south back to southern
-             *  spherical footpoint. Then add this distance to Sm_South and
-             *  Sm_North. That should give the distance of both mirror points
-             *  rtelativen to the southern spherical footpoint -- which is how
-             *  the field line is defined that we are trying to save.
+             *  The last shell, shifted to go through the line we just found,
+             *  is better than any of the above. The bracket only needs to be
+             *  a bit wider than the last miss.
              */
-            //if ( Lgm_TraceToSphericalEarth( &LstarInfo->Mirror_Ps[k], &uu, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ){
-             if ( Lgm_TraceToSphericalEarth( &LstarInfo->Mirror_Ps[k], &uu, LstarInfo->mInfo->Lgm_LossConeHeight, -1.0, 1e-7, LstarInfo->mInfo ) ) {
-                LstarInfo->Mirror_Ss[k] += LstarInfo->mInfo->Trace_s;
-                LstarInfo->Mirror_Sn[k] += LstarInfo->mInfo->Trace_s;
+            if ( UsePrev && ( k > 0 ) ) {
+                pred_mlat = MirrorMlat[k-1] + Lgm_ShellHistory_Mlat( &Prev, MLT ) - Lgm_ShellHistory_Mlat( &Prev, MirrorMLT[k-1] );
+                delta     = ( k == 1 ) ? LGM_LSTAR_CONT_DELTA : 3.0*fabs( PredMinusActualMlat );
+                if ( delta > LGM_LSTAR_CONT_DELTA )     delta = LGM_LSTAR_CONT_DELTA;
+                if ( delta < LGM_LSTAR_CONT_MIN_DELTA ) delta = LGM_LSTAR_CONT_MIN_DELTA;
+                if (LstarInfo->VerbosityLevel > 2) printf("\t\t%sPredicted mlat from last shell = %g%s\n", PreStr, pred_mlat, PostStr );
             }
 
 
 
+            /*
+             * Loop until we are done. We will be done when we have either;
+             *
+             *    1) found I to the requested tolerance or
+             *    2) I cannot be found after several attempts.
+             *
+             *  Each attempt is kept track of by the 'Count' variable.  The
+             *  strategy is to make a reasonable estimate for the search range on
+             *  mlat. If this doesnt work, we expand the size of the range.
+             *
+             */
+            rc = Lstar_ShellLine( k, nLines, 3, MLT, I, pred_mlat, &delta, &mlat, &PredMinusActualMlat, &nIts, LstarInfo );
+            if ( rc < 0 ) return( rc );
 
+            MirrorMLT[k]  = MLT;
+            MirrorMlat[k] = mlat;
+            ++k;
 
-        }
-
-
+        } // end MLT for loop
 
-        ++k;
+    }
 
-    } // end MLT for loop
+    if ( LstarInfo->AdaptiveLstarTol > 0.0 ) {
+        if ( ( rc = Lstar_RefineShell( k, I, ParallelShell, MirrorMLT, MirrorMlat, LstarInfo ) ) < 0 ) return( rc );
+        k = rc;
+    }
     LstarInfo->nPnts = k;
 
 
     /*
      *  Save drift shell -- it will help us predict the next one.
      */
-    for (i=0; i<LstarInfo->nPnts; ++i){
-	    MirrorMLT_Old[i]  = MirrorMLT[i];
-	    MirrorMlat_Old[i] = MirrorMlat[i];
+    Lgm_ShellHistory_Save( LstarInfo->ShellHistory, LstarInfo->PitchAngle, LstarInfo->ISearchMethod, LstarInfo->nPnts, MirrorMLT, MirrorMlat );
+    if ( LstarInfo->NestedShell != NULL ) {
+        Lgm_ShellHistory_SetEntry( LstarInfo->NestedShell, LstarInfo->PitchAngle, LstarInfo->ISearchMethod, LstarInfo->nPnts, MirrorMLT, MirrorMlat );
     }
 
     /*
@@ -1427,11 +2450,22 @@ FIX
 //}
 
 
+    t0 = LGM_STAGE_NOW( LstarInfo->mInfo );
+    if ( LGM_STAGE_FIRE( LstarInfo->mInfo, LGM_STAGE_MAGFLUX_BEGIN, -1, 0.0, 0.0 ) ) {
+        gsl_interp_free( LstarInfo->pspline );
+        gsl_interp_accel_free( LstarInfo->acc );
+        return( LGM_LSTAR_CANCELLED );
+    }
     Phi1 = MagFlux( LstarInfo );
     LstarInfo->LS_dip_approx = -2.0*M_PI*LstarInfo->mInfo->c->M_cd_2010 /Phi1;
     Phi2 = MagFlux2( LstarInfo );
     LstarInfo->LS = -2.0*M_PI*LstarInfo->mInfo->c->M_cd_2010 /Phi2;
     LstarInfo->LS_McIlwain_M = -2.0*M_PI*LstarInfo->mInfo->c->M_cd_McIllwain /Phi2;
+    if ( LGM_STAGE_FIRE( LstarInfo->mInfo, LGM_STAGE_MAGFLUX_END, -1, t0, LstarInfo->LS ) ) {
+        gsl_interp_free( LstarInfo->pspline );
+        gsl_interp_accel_free( LstarInfo->acc );
+        return( LGM_LSTAR_CANCELLED );
+    }
 
 
 
@@ -1498,14 +2532,49 @@ double MagFluxIntegrand( double Phi, _qpInfo *qpInfo ) {
 
 }
 
+/*
+ *  MagFluxIntegrand() at the n points Phi[] in one call (the batch integrand
+ *  for dqagsv()).
+ */
+void MagFluxIntegrand_v( int n, const double *Phi, double *f, _qpInfo *qpInfo ) {
+
+    int             i;
+    double          c;
+    Lgm_LstarInfo   *LstarInfo;
+
+    LstarInfo = (Lgm_LstarInfo *)qpInfo;
+
+    for ( i=0; i<n; i++ ) {
+        f[i] = gsl_interp_eval( LstarInfo->pspline, LstarInfo->xa, LstarInfo->ya, Phi[i]*DegPerRad/15.0, LstarInfo->acc );
+    }
+    for ( i=0; i<n; i++ ) {
+        c = cos( f[i]*RadPerDeg );
+        f[i] = c*c;
+    }
+
+}
+
 
 
+static double MagFlux_Body( Lgm_LstarInfo *LstarInfo );
 double MagFlux( Lgm_LstarInfo *LstarInfo ) {
 
+    double r;
+
+    LGM_PROFILE_BEGIN( LGM_PROF_MAGFLUX );
+    r = MagFlux_Body( LstarInfo );
+    LGM_PROFILE_END( LGM_PROF_MAGFLUX );
+
+    return( r );
+
+}
+
+static double MagFlux_Body( Lgm_LstarInfo *LstarInfo ) {
+
     double      a, b, r;
     double      epsabs, epsrel, result, abserr;
-    int         key, neval, ier, limit, lenw, last, iwork[502];
-    double      work[2002];
+    int         key, neval, ier, limit, lenw, last;
+    Lgm_QuadPackWork *qw;
     _qpInfo     *qpInfo;
 
 
@@ -1536,12 +2605,13 @@ double MagFlux( Lgm_LstarInfo *LstarInfo ) {
 
 
 
-    limit = 500; lenw = 4*limit; key = 6;
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, LstarInfo->mInfo )) == NULL ) return( LGM_FILL_VALUE );
+    limit = qw->Limit; lenw = 4*limit; key = 6;
 /*
     iwork  = (int *) calloc( limit+1, sizeof(int) );
     work   = (double *) calloc( lenw+1, sizeof(double) );
 */
-    dqags(MagFluxIntegrand, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, LstarInfo->mInfo->VerbosityLevel );
+    dqagsv(MagFluxIntegrand_v, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, qw->iwork, qw->work, LstarInfo->mInfo->VerbosityLevel );
 /*
     free( iwork );
     free( work );
@@ -1608,8 +2678,9 @@ double LambdaIntegral( Lgm_LstarInfo *LstarInfo ) {
 
     double      a, b;
     double      epsabs, epsrel, result, abserr;
-    int         key, neval, ier, limit, lenw, last, iwork[502];
-    double      work[2002], MLT, mlat;
+    int         key, neval, ier, limit, lenw, last;
+    double      MLT, mlat;
+    Lgm_QuadPackWork *qw;
     _qpInfo     *qpInfo;
 
 
@@ -1649,13 +2720,14 @@ double LambdaIntegral( Lgm_LstarInfo *LstarInfo ) {
     epsabs = LstarInfo->mInfo->Lgm_MagFlux_Integrator_epsabs;
     epsrel = LstarInfo->mInfo->Lgm_MagFlux_Integrator_epsrel;
 
-    limit = 500; lenw = 4*limit; key = 6;
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_INNER, LstarInfo->mInfo )) == NULL ) return( LGM_FILL_VALUE );
+    limit = qw->Limit; lenw = 4*limit; key = 6;
 /*
     iwork  = (int *) calloc( limit+1, sizeof(int) );
     work   = (double *) calloc( lenw+1, sizeof(double) );
 */
 //printf("a, b = %g %g\n", a, b);
-    dqags(LambdaIntegrand, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, LstarInfo->mInfo->VerbosityLevel );
+    dqags(LambdaIntegrand, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, qw->iwork, qw->work, LstarInfo->mInfo->VerbosityLevel );
 /*
     free( iwork );
     free( work );
@@ -1685,12 +2757,35 @@ double MagFluxIntegrand2( double Phi, _qpInfo *qpInfo ) {
 
 }
 
+/*
+ *  LambdaIntegral() looked up in LstarInfo->FluxMap instead (see
+ *  Lgm_FluxMap.c).
+ */
+double MagFluxIntegrand_Map( double Phi, _qpInfo *qpInfo ) {
+
+    double	MLT, mlat, f;
+    Lgm_LstarInfo  *LstarInfo;
+
+    LstarInfo = (Lgm_LstarInfo *)qpInfo;
+
+    MLT  = Phi*DegPerRad/15.0;
+    mlat = gsl_interp_eval( LstarInfo->pspline, LstarInfo->xa, LstarInfo->ya, MLT, LstarInfo->acc );
+    if ( !Lgm_FluxMap_Eval( LstarInfo->FluxMap, MLT, mlat, &f ) ) {
+        // (MagFlux2() checks the footpoints are on the map, but the spline could overshoot a little)
+        LstarInfo->Phi = Phi;
+        f = LambdaIntegral( LstarInfo );
+    }
+
+    return( f );
+
+}
+
 double MagFlux2( Lgm_LstarInfo *LstarInfo ) {
 
-    double      a, b, r;
+    double      a, b, r, mlat_min;
     double      epsabs, epsrel, result, abserr;
-    int         key, neval, ier, limit, lenw, last, iwork[502];
-    double      work[2002];
+    int         key, neval, ier, limit, lenw, last, i, UseMap;
+    Lgm_QuadPackWork *qw;
     _qpInfo     *qpInfo;
 
 
@@ -1721,12 +2816,23 @@ double MagFlux2( Lgm_LstarInfo *LstarInfo ) {
     epsabs = LstarInfo->mInfo->Lgm_LambdaIntegral_Integrator_epsabs;
     epsrel = LstarInfo->mInfo->Lgm_LambdaIntegral_Integrator_epsrel;
 
-    limit = 500; lenw = 4*limit; key = 6;
+    /*
+     *  If there is a flux map for this model state, and the drift shell
+     *  footpoints are on it, the inner (lambda) integrals are just lookups.
+     */
+    UseMap = FALSE;
+    if ( Lgm_FluxMap_Matches( LstarInfo->FluxMap, LstarInfo->mInfo ) ) {
+        for ( mlat_min = 90.0, i=0; i<LstarInfo->nSplnPnts; i++ ) if ( LstarInfo->ya[i] < mlat_min ) mlat_min = LstarInfo->ya[i];
+        UseMap = ( mlat_min > LstarInfo->FluxMap->MlatMin + 1.0 );
+    }
+
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, LstarInfo->mInfo )) == NULL ) return( LGM_FILL_VALUE );
+    limit = qw->Limit; lenw = 4*limit; key = 6;
 /*
     iwork  = (int *) calloc( limit+1, sizeof(int) );
     work   = (double *) calloc( lenw+1, sizeof(double) );
 */
-    dqags(MagFluxIntegrand2, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, LstarInfo->mInfo->VerbosityLevel );
+    dqags( UseMap ? MagFluxIntegrand_Map : MagFluxIntegrand2, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, qw->iwork, qw->work, LstarInfo->mInfo->VerbosityLevel );
 /*
     free( iwork );
     free( work );
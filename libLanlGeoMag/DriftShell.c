@@ -1,5 +1,6 @@
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_LstarInfo.h"
+#include "Lgm/Lgm_Profile.h"
 #include "Lgm/qsort.h"
 #include <gsl/gsl_multifit.h>
 #define MAX_ITS 100
@@ -30,6 +31,96 @@ int FitQuadAndFindZero( double *x, double *y, double *dy, int n, double *res );
 int FitQuadAndFindZero2( double *x, double *y, double *dy, int n, int nmax, double *res );
 int BracketZero( double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, BracketType *Bracket, Lgm_LstarInfo *LstarInfo );
 
+
+/*
+ *  Safeguarded secant search for the shell line (used by FindShellLine()
+ *  when LstarInfo->NewtonShellLine is set).
+ *
+ *  I(mlat) is smooth and close to linear over the range a good prediction
+ *  puts us in, so Newton steps converge in a few probes where the bracketing
+ *  in BracketZero() and the bisection after it take several more. The
+ *  derivative comes from the probes themselves (the secant through the last
+ *  two). The slope from the last line that was found (LstarInfo->dIdMlat)
+ *  makes the first step a Newton step, so no probe is spent just to get
+ *  the slope. Lgm_Grad_I() would give the derivative directly, but it costs
+ *  more I evaluations than it saves.
+ *
+ *  Every probe has to stay in [mlat0, mlat2], and every secant step has to
+ *  at least halve |I-I0|. If not, or if I is undefined (open line), we give up and FindShellLine()
+ *  carries on with the usual bracketing, keeping everything learned so far.
+ *  Probes are added to the MLATarr/ImI0arr fitting arrays as usual.
+ *
+ *  Returns 2 if the line was found (*mlat, *rad, *Ifound are set), 1 if a
+ *  zero bracket was found (in Bracket->a, b), and -1 otherwise.
+ */
+#define LGM_SHELLLINE_MAX_SECANT    6
+static int FindShellLine_Secant( double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, BracketType *Bracket, int *nProbes, Lgm_LstarInfo *LstarInfo ) {
+
+    int     n;
+    double  x, xp, D, Dp, I, r, s, Tol;
+
+    Tol = LstarInfo->mInfo->Lgm_FindShellLine_I_Tol;
+    *nProbes = 0;
+
+    x = mlat1; xp = 0.0; Dp = 0.0;
+    for ( n=0; n<LGM_SHELLLINE_MAX_SECANT; n++ ) {
+
+        I = ComputeI_FromMltMlat( Bm, MLT, x, &r, I0, LstarInfo );
+        ++(*nProbes);
+        if ( I > 1e6 ) return( -1 );
+        D = I - I0;
+
+        LstarInfo->MLATarr[LstarInfo->nImI0]   = x;
+        LstarInfo->ImI0arr[LstarInfo->nImI0++] = D;
+        if ( fabs( D ) < Bracket->Dmin ) { Bracket->Dmin = fabs( D ); Bracket->mlat_min = x; }
+
+        if ( fabs( D ) < Tol ) {
+            if ( n > 0 ) LstarInfo->dIdMlat = ( D - Dp )/( x - xp );
+            if (LstarInfo->VerbosityLevel > 1) printf( "\t\t\t> Secant search converged in %d probes: |I-I0|=%g < %g\n", n+1, fabs( D ), Tol );
+            *rad    = r;
+            *Ifound = I;
+            *mlat   = x;
+            return( 2 );
+        }
+
+        if ( ( n > 0 ) && ( D*Dp < 0.0 ) ) {
+            /*
+             *  Straddled the root -- let the bracketed search finish it.
+             */
+            Bracket->a = xp; Bracket->Da = Dp; Bracket->Ia = Dp + I0;
+            Bracket->b = x;  Bracket->Db = D;  Bracket->Ib = I;
+            Bracket->FoundZeroBracket = TRUE;
+            if ( ( n > 1 ) && ( fabs( D ) > 0.5*fabs( Dp ) ) ) return( 1 );
+        } else if ( ( n > 1 ) && ( fabs( D ) > 0.5*fabs( Dp ) ) ) {
+            if (LstarInfo->VerbosityLevel > 1) printf( "\t\t\t> Secant search not converging (|I-I0| = %g after %g). Falling back to bracketing.\n", fabs( D ), fabs( Dp ) );
+            return( Bracket->FoundZeroBracket ? 1 : -1 );
+        }
+
+        /*
+         *  Next probe.
+         */
+        if ( n > 0 ) {
+            s = ( D - Dp )/( x - xp );
+        } else if ( LstarInfo->dIdMlat != 0.0 ) {
+            s = LstarInfo->dIdMlat;
+        } else {
+            s = 0.0;
+        }
+
+        xp = x; Dp = D;
+        if ( s != 0.0 ) {
+            x -= D/s;
+        } else {
+            x += ( x + 0.1*( mlat2 - mlat0 ) <= mlat2 ) ? 0.1*( mlat2 - mlat0 ) : -0.1*( mlat2 - mlat0 );
+        }
+        if ( ( x < mlat0 ) || ( x > mlat2 ) || ( x == xp ) ) return( Bracket->FoundZeroBracket ? 1 : -1 );
+
+    }
+
+    return( Bracket->FoundZeroBracket ? 1 : -1 );
+
+}
+
 /*
  *   FindShellLine
  *   -------------
@@ -50,7 +141,20 @@ int BracketZero( double I0, double *Ifound, double Bm, double MLT, double *mlat,
  *            \return 0 - no field line could be found
  *
  */
-int FindShellLine(  double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, int *Iterations, Lgm_LstarInfo *LstarInfo) {
+static int FindShellLine_Body( double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, int *Iterations, Lgm_LstarInfo *LstarInfo );
+int FindShellLine( double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, int *Iterations, Lgm_LstarInfo *LstarInfo ) {
+
+    int r;
+
+    LGM_PROFILE_BEGIN( LGM_PROF_FINDSHELLLINE );
+    r = FindShellLine_Body( I0, Ifound, Bm, MLT, mlat, rad, mlat0, mlat1, mlat2, Iterations, LstarInfo );
+    LGM_PROFILE_END( LGM_PROF_FINDSHELLLINE );
+
+    return( r );
+
+}
+
+static int FindShellLine_Body( double I0, double *Ifound, double Bm, double MLT, double *mlat, double *rad, double mlat0, double mlat1, double mlat2, int *Iterations, Lgm_LstarInfo *LstarInfo ) {
     Lgm_Vector      u, w, Pm_North, Pmirror, v1, v2, v3;
     double          F, F0, F1, rat, a, b, c, d, d0, d1, Da, Db, Dc, De, I, r, Phi, cl, sl;
     double          SS, Sn, Ss, mlat_min=0.0, Dmin=9e99, e, D, D0, D1, D2, Sign, Dbest, mlatbest, res;
@@ -119,7 +223,12 @@ int FindShellLine(  double I0, double *Ifound, double Bm, double MLT, double *ml
      * often the case for large eq. pitch angles.
      */
     Bracket.Dmin = 9e99;
-    Flag = BracketZero( I0, Ifound, Bm, MLT, mlat, rad, mlat0, mlat1, mlat2, &Bracket, LstarInfo );
+    Flag = -1;
+    if ( LstarInfo->NewtonShellLine ) {
+        Flag = FindShellLine_Secant( I0, Ifound, Bm, MLT, mlat, rad, mlat0, mlat1, mlat2, &Bracket, Iterations, LstarInfo );
+        if ( Flag == 2 ) return( TRUE );
+    }
+    if ( Flag != 1 ) Flag = BracketZero( I0, Ifound, Bm, MLT, mlat, rad, mlat0, mlat1, mlat2, &Bracket, LstarInfo );
     if ( Flag < 0 )  {
         if (LstarInfo->VerbosityLevel > 1){
             printf("\t\t\t> No zero bracket found: (mlat0, mlat1, mlat2) = %g %g %g  (a,b,c) = %g %g %g  (Da,Db,Dc) = %g %g %g\n\n",
@@ -771,10 +880,64 @@ typedef struct MinBracketType {
     double a, b, c;
     double Da, Db, Dc;
 } MinBracketType;
+
+/*
+ *  Brent's method on the bracket [a0, c0] (B-Bm is Da0 >= 0 at a0 and
+ *  Dc0 <= 0 at c0) along the radial line with direction (f, g, sl).
+ */
+static int FindBmRadius_Polish( double Bm, double f, double g, double sl, double a0, double c0, double Da0, double Dc0, double tol, double *r, Lgm_LstarInfo *LstarInfo ) {
+
+    int             Flag;
+    double          D;
+    BrentFuncInfo   bfi;
+
+    LstarInfo->mInfo->Ptmp.x = f;
+    LstarInfo->mInfo->Ptmp.y = g;
+    LstarInfo->mInfo->Ptmp.z = sl;
+    bfi.Info    = (void *)LstarInfo->mInfo;
+    bfi.func    = &RadBmFunc;
+    bfi.Val     = Bm;
+    Flag = Lgm_zBrent( a0, c0, Da0, Dc0, &bfi, tol, r, &D );
+
+    if (LstarInfo->VerbosityLevel > 4) { printf("%sFindBmRadius: Final r = %.15lf  (B-Bm = %g nFunc = %ld)%s\n", LstarInfo->PreStr, *r, D, LstarInfo->mInfo->nFunc, LstarInfo->PostStr ); }
+
+    return( ( Flag ) ? TRUE : FALSE );
+
+}
+
+/*
+ *  Check (and if need be widen by a step or two) a bracket predicted by
+ *  Lgm_BmRadiusCache_Bracket(). Returns TRUE if [*a0, *c0] now holds a
+ *  zero of B-Bm with the signs FindBmRadius_Polish() wants.
+ */
+static int FindBmRadius_CheckBracket( double Bm, double rmin, double *a0, double *c0, double *Da0, double *Dc0, Lgm_LstarInfo *LstarInfo ) {
+
+    int i;
+
+    *Da0 = RadBmFunc( *a0, Bm, (void *)LstarInfo->mInfo );
+    for ( i=0; ( i < 3 ) && ( *Da0 < 0.0 ) && ( *a0 - 0.1 >= rmin - 1e-12 ); i++ ) {
+        *c0 = *a0; *Dc0 = *Da0;
+        *a0 -= 0.1;
+        *Da0 = RadBmFunc( *a0, Bm, (void *)LstarInfo->mInfo );
+    }
+    if ( *Da0 < 0.0 ) return( FALSE );
+    if ( i > 0 ) return( TRUE );    // c0 was the old a0, already known to be below Bm
+
+    *Dc0 = RadBmFunc( *c0, Bm, (void *)LstarInfo->mInfo );
+    for ( i=0; ( i < 3 ) && ( *Dc0 > 0.0 ); i++ ) {
+        *a0 = *c0; *Da0 = *Dc0;
+        *c0 += 0.1;
+        *Dc0 = RadBmFunc( *c0, Bm, (void *)LstarInfo->mInfo );
+    }
+
+    return( *Dc0 <= 0.0 );
+
+}
+
 int FindBmRadius( double Bm, double MLT, double mlat, double *r, double tol, Lgm_LstarInfo *LstarInfo ) {
 
     Lgm_Vector  u, v, Bvec;
-    int         i, done, FoundValidBm, Flag, FoundZeroBracket, nMinima;
+    int         i, done, Flag, FoundZeroBracket, nMinima;
     double      Phi, D, a0, b0, c0, Da0, Db0, Dc0;
     double      a, b, c, d, B, cl, sl, cp, sp, lat, f, g;
     MinBracketType MinBracket[50];
@@ -786,6 +949,20 @@ int FindBmRadius( double Bm, double MLT, double mlat, double *r, double tol, Lgm
     cp = cos( Phi ); sp = sin( Phi );
     f = cl*cp; g = cl*sp;
 
+    /*
+     *  If there is a radial |B| cache (see Lgm_BmRadiusCache.c), the bracket
+     *  can usually be had from it with two field evaluations.
+     */
+    if ( ( LstarInfo->BmRadiusCache != NULL ) && Lgm_BmRadiusCache_Bracket( LstarInfo->BmRadiusCache, Bm, MLT, mlat, &a0, &c0, LstarInfo->mInfo ) ) {
+        LstarInfo->mInfo->Ptmp.x = f;
+        LstarInfo->mInfo->Ptmp.y = g;
+        LstarInfo->mInfo->Ptmp.z = sl;
+        if ( FindBmRadius_CheckBracket( Bm, 1.0 + LstarInfo->mInfo->Lgm_LossConeHeight/Re, &a0, &c0, &Da0, &Dc0, LstarInfo ) ) {
+            if (LstarInfo->VerbosityLevel > 4) { printf( "%sFindBmRadius: Cached Bracket, a0, c0 = %g %g   Da0, Dc0 = %g %g%s\n", LstarInfo->PreStr, a0, c0, Da0, Dc0, LstarInfo->PostStr  ); }
+            return( FindBmRadius_Polish( Bm, f, g, sl, a0, c0, Da0, Dc0, tol, r, LstarInfo ) );
+        }
+    }
+
 
     /*
      *  Get bracket on r.
@@ -988,24 +1165,7 @@ int FindBmRadius( double Bm, double MLT, double mlat, double *r, double tol, Lgm
      */
     if ( ( Da0 < 0.0 ) || ( Dc0 > 0.0 ) ) return( FALSE ); // bracket not found
 
-    /*
-     * We have a bracket. Use brent's method to find root.
-     */
-    LstarInfo->mInfo->Ptmp.x = f;
-    LstarInfo->mInfo->Ptmp.y = g;
-    LstarInfo->mInfo->Ptmp.z = sl;
-    BrentFuncInfo bfi;
-    bfi.Info    = (void *)LstarInfo->mInfo;
-    bfi.func    = &RadBmFunc;
-    bfi.Val     = Bm;
-    Flag = Lgm_zBrent( a0, c0, Da0, Dc0, &bfi, tol, r, &D );
-    FoundValidBm = ( Flag ) ? TRUE : FALSE;
-
-    if (LstarInfo->VerbosityLevel > 4) { printf("%sFindBmRadius: Final r = %.15lf  (B-Bm = %g nFunc = %ld)%s\n", LstarInfo->PreStr, *r, D, LstarInfo->mInfo->nFunc, LstarInfo->PostStr ); }
-
-    return( FoundValidBm );
-
-
+    return( FindBmRadius_Polish( Bm, f, g, sl, a0, c0, Da0, Dc0, tol, r, LstarInfo ) );
 
 }
 
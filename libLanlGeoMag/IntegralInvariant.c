@@ -1,4 +1,5 @@
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_Profile.h"
 //#include "MagStep.h"
 
 #define JUMP_METHOD	    0
@@ -73,15 +74,42 @@
  *
  */
 
+static double Iinv_Body( Lgm_MagModelInfo *mInfo );
+static int Lgm_Grad_I_FD( Lgm_Vector *v0, Lgm_Vector *GradI, Lgm_MagModelInfo *mInfo );
 double Iinv( Lgm_MagModelInfo *mInfo ) {
 
+    double r;
+
+    LGM_PROFILE_BEGIN( LGM_PROF_IINTEGRAL );
+    r = Iinv_Body( mInfo );
+    LGM_PROFILE_END( LGM_PROF_IINTEGRAL );
+
+    return( r );
+
+}
+
+static double Iinv_Body( Lgm_MagModelInfo *mInfo ) {
+
 
     double	a, b;
     double	epsabs, epsrel, result, abserr;
     double  resabs, resasc;
-    int		key, neval, ier, limit, lenw, last, iwork[501];
-    double	work[2002];
+    int		key, neval, ier, limit, lenw, last;
+    Lgm_QuadPackWork *qw;
     _qpInfo	*qpInfo;
+    Lgm_DipoleFL    f;
+
+
+    /*
+     *  For a pure dipole, I is known in closed form on the line through the
+     *  mirror points (see Lgm_Dipole.c).
+     */
+    if ( Lgm_Dipole_IsPure( mInfo ) ) {
+        mInfo->Lgm_n_I_integrand_Calls = 0;
+        Lgm_Dipole_Line( &mInfo->Pm_South, &f, mInfo );
+        Lgm_Dipole_Integrals( mInfo->Bm, &f, &result, NULL );
+        return( result );
+    }
 
 
     /*
@@ -125,8 +153,9 @@ double Iinv( Lgm_MagModelInfo *mInfo ) {
         /*
          *  Use DQAGS
          */
-        limit = 500; lenw = 4*limit; key = 6;
-        dqags(I_integrand, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, mInfo->VerbosityLevel );
+        if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, mInfo )) == NULL ) return( LGM_FILL_VALUE );
+        limit = qw->Limit; lenw = 4*limit; key = 6;
+        dqags(I_integrand, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, qw->iwork, qw->work, mInfo->VerbosityLevel );
 
     } else if ( mInfo->Lgm_I_Integrator == DQK21 ) {
 
@@ -174,13 +203,26 @@ double Iinv( Lgm_MagModelInfo *mInfo ) {
  *
  *
  */
+static double Iinv_interped_Body( Lgm_MagModelInfo *mInfo );
 double Iinv_interped( Lgm_MagModelInfo *mInfo ) {
 
+    double r;
+
+    LGM_PROFILE_BEGIN( LGM_PROF_IINTEGRAL );
+    r = Iinv_interped_Body( mInfo );
+    LGM_PROFILE_END( LGM_PROF_IINTEGRAL );
+
+    return( r );
+
+}
+
+static double Iinv_interped_Body( Lgm_MagModelInfo *mInfo ) {
+
     double	a, b;
     double	epsabs, epsrel, result, abserr, resabs, resasc;
     int		key, limit, lenw;
-    int     iwork[501], last, ier, neval;
-    double	work[2002];
+    int     last, ier, neval;
+    Lgm_QuadPackWork *qw;
     _qpInfo	*qpInfo;
 
 
@@ -220,15 +262,16 @@ double Iinv_interped( Lgm_MagModelInfo *mInfo ) {
         /*
          *  Use DQAGS
          */
-        limit = 500; lenw = 4*limit; key = 6;
-        dqags(I_integrand_interped, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, mInfo->VerbosityLevel );
+        if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, mInfo )) == NULL ) return( LGM_FILL_VALUE );
+        limit = qw->Limit; lenw = 4*limit; key = 6;
+        dqagsv(I_integrand_interped_v, qpInfo, a, b, epsabs, epsrel, &result, &abserr, &neval, &ier, limit, lenw, &last, qw->iwork, qw->work, mInfo->VerbosityLevel );
 
     } else if ( mInfo->Lgm_I_Integrator == DQK21 ) {
 
         /*
          *  Use DQK21
          */
-        dqk21(I_integrand_interped, qpInfo, a, b, &result, &abserr, &resabs, &resasc);
+        dqk21v(I_integrand_interped_v, qpInfo, a, b, &result, &abserr, &resabs, &resasc);
 
     } else {
 
@@ -273,6 +316,218 @@ double I_integrand_interped( double s, _qpInfo *qpInfo ) {
 
 }
 
+/*
+ *  I_integrand_interped() at the n points s[] in one call (the batch
+ *  integrand for dqagsv() and dqk21v()). B comes from BofS_N().
+ */
+void I_integrand_interped_v( int n, const double *s, double *f, _qpInfo *qpInfo ) {
+
+    int                 i;
+    double              g;
+    Lgm_MagModelInfo    *mInfo;
+
+    mInfo = (Lgm_MagModelInfo *)qpInfo;
+
+    BofS_N( n, s, f, mInfo );
+    for ( i=0; i<n; i++ ) {
+        g = 1.0 - f[i]/mInfo->Bm;
+        f[i] = (g > 0.0) ? sqrt( g ) : 0.0;
+    }
+
+    mInfo->Lgm_n_I_integrand_Calls += n;
+
+}
+
+
+
+/*
+ *  Gauss-Legendre nodes and weights on [-1,1]: 3 points for the knot
+ *  intervals of the splined line and 8 points on each of
+ *  LGM_IINV_END_PANELS panels for the ends (next to the mirror points).
+ */
+#define LGM_IINV_END_PANELS     4
+
+static const double Lgm_GL3_x[3] = { -0.774596669241483377, 0.0, 0.774596669241483377 };
+static const double Lgm_GL3_w[3] = { 0.555555555555555556, 0.888888888888888889, 0.555555555555555556 };
+static const double Lgm_GL8_x[8] = { -0.960289856497536232, -0.796666477413626740, -0.525532409916328986, -0.183434642495649805,
+                                      0.183434642495649805,  0.525532409916328986,  0.796666477413626740,  0.960289856497536232 };
+static const double Lgm_GL8_w[8] = {  0.101228536290376259,  0.222381034453374471,  0.313706645877887287,  0.362683783378361983,
+                                      0.362683783378361983,  0.313706645877887287,  0.222381034453374471,  0.101228536290376259 };
+
+
+/*
+ *  Mirror point on the splined line between knots a and b, where B(a) >= Bm
+ *  > B(b) (Fa and Fb are B-Bm there). Regula falsi with the Illinois fix.
+ */
+static double Iinv_MirrorS( double a, double Fa, double b, double Fb, double Bm, double tol, Lgm_MagModelInfo *mInfo ) {
+
+    int     n, Side = 0;
+    double  c, Fc;
+
+    c = b;
+    for ( n=0; n<100; n++ ) {
+        c  = ( Fa != Fb ) ? ( a*Fb - b*Fa )/( Fb - Fa ) : 0.5*( a + b );
+        Fc = BofS( c, mInfo ) - Bm;
+        if ( ( fabs( Fc ) < 1e-10*Bm ) || ( fabs( b - a ) < tol ) ) break;
+        if ( Fc*Fb > 0.0 ) {
+            b = c; Fb = Fc;
+            if ( Side == -1 ) Fa *= 0.5;
+            Side = -1;
+        } else {
+            a = c; Fa = Fc;
+            if ( Side == 1 ) Fb *= 0.5;
+            Side = 1;
+        }
+    }
+
+    return( c );
+
+}
+
+
+/*
+ *  Integral of (1-B/Bm)^(1/2) from the mirror point Sm to Se (either side of
+ *  it). With s = Sm + (Se-Sm) t^2 the square root end point becomes smooth.
+ */
+static double Iinv_EndPiece( double Sm, double Se, double Bm, Lgm_MagModelInfo *mInfo ) {
+
+    int     p, k;
+    double  t, g, L = Se - Sm, Sum = 0.0;
+
+    for ( p=0; p<LGM_IINV_END_PANELS; p++ ) {
+        for ( k=0; k<8; k++ ) {
+            t = ( p + 0.5*( Lgm_GL8_x[k] + 1.0 ) )/(double)LGM_IINV_END_PANELS;
+            g = 1.0 - BofS( Sm + L*t*t, mInfo )/Bm;
+            if ( g > 0.0 ) Sum += Lgm_GL8_w[k]*sqrt( g )*t;
+        }
+    }
+
+    return( fabs( L )*Sum/(double)LGM_IINV_END_PANELS );    // 0.5 (for t on [0,1]) x 2 L t dt, per panel
+
+}
+
+
+/**
+ *   Evaluates the integral invariant, I, for several mirror field strengths
+ *   on one pre-traced field line (see Iinv_interped()). This is what you
+ *   want when many pitch angles share a line, e.g. local pitch angle runs or
+ *   tabulating K(alpha).
+ *
+ *   The Bm values are done in increasing order, so the mirror points move
+ *   out along the line and each search starts from the last one. |B| is
+ *   computed once at fixed Gauss points in every knot interval of the
+ *   splined line, and the sums for all of the Bm share those values. Only
+ *   the two end pieces next to the mirror points need new BofS() calls. The
+ *   end pieces are done with a change of variable that removes the square
+ *   root singularity.
+ *
+ *   The line must have been traced footpoint to footpoint (s[0] is the
+ *   southern footpoint) with InitSpline() done. mInfo->Bm, mInfo->Sm_South
+ *   and mInfo->Sm_North are not used (and are left as they were).
+ *
+ *      \param[in]      nBm     Number of mirror field strengths.
+ *      \param[in]      Bm      Mirror field strengths (nT), in any order.
+ *      \param[out]     I       I for each Bm (Re). 0 if Bm is at or below
+ *                              the minimum |B| on the line, LGM_FILL_VALUE
+ *                              if the line does not reach Bm before a footpoint.
+ *      \param[in,out]  mInfo   A properly initialized Lgm_MagModelInfo structure (with the line splined).
+ *
+ *      \return         The number of I values that are not LGM_FILL_VALUE.
+ *
+ */
+int Iinv_interped_multi( int nBm, double *Bm, double *I, Lgm_MagModelInfo *mInfo ) {
+
+    int     i, j, k, n, imin, iS, iN, *Order, *Have, nGood = 0;
+    double  *Bnode, Sa, Sb, g, Sum, h, s0, B, Bm0, Sm_South0, Sm_North0;
+
+    n = mInfo->nPnts;
+    if ( ( nBm < 1 ) || ( n < 3 ) || !mInfo->AllocedSplines ) {
+        for ( i=0; i<nBm; i++ ) I[i] = LGM_FILL_VALUE;
+        return( 0 );
+    }
+
+    Bm0 = mInfo->Bm; Sm_South0 = mInfo->Sm_South; Sm_North0 = mInfo->Sm_North;
+    Order = (int *) calloc( nBm, sizeof( int ) );
+    Have  = (int *) calloc( n, sizeof( int ) );
+    Bnode = (double *) calloc( 3*n, sizeof( double ) );
+
+    /*
+     *  Bm in increasing order (insertion sort -- nBm is small).
+     */
+    for ( i=0; i<nBm; i++ ) {
+        for ( j=i; ( j > 0 ) && ( Bm[Order[j-1]] > Bm[i] ); j-- ) Order[j] = Order[j-1];
+        Order[j] = i;
+    }
+
+    for ( imin=0, i=1; i<n; ++i ) if ( mInfo->Bmag[i] < mInfo->Bmag[imin] ) imin = i;
+    iS = imin; iN = imin;
+
+    for ( k=0; k<nBm; k++ ) {
+
+        i = Order[k];
+        if ( Bm[i] <= mInfo->Bmag[imin] ) { I[i] = 0.0; ++nGood; continue; }
+
+        /*
+         *  Knots either side of the mirror points: B(s[iS]) >= Bm > B(s[iS+1])
+         *  and B(s[iN-1]) < Bm <= B(s[iN]).
+         */
+        while ( ( iS >= 0 ) && ( mInfo->Bmag[iS] < Bm[i] ) ) --iS;
+        while ( ( iN < n )  && ( mInfo->Bmag[iN] < Bm[i] ) ) ++iN;
+        if ( ( iS < 0 ) || ( iN >= n ) ) {
+            // and so for all of the larger Bm too
+            for ( ; k<nBm; k++ ) I[Order[k]] = LGM_FILL_VALUE;
+            break;
+        }
+
+        Sa = Iinv_MirrorS( mInfo->s[iS], mInfo->Bmag[iS]-Bm[i], mInfo->s[iS+1], mInfo->Bmag[iS+1]-Bm[i], Bm[i], mInfo->Lgm_TraceToMirrorPoint_Tol, mInfo );
+        Sb = Iinv_MirrorS( mInfo->s[iN], mInfo->Bmag[iN]-Bm[i], mInfo->s[iN-1], mInfo->Bmag[iN-1]-Bm[i], Bm[i], mInfo->Lgm_TraceToMirrorPoint_Tol, mInfo );
+
+        if ( iN - iS < 4 ) {
+
+            /*
+             *  Too few knots between the mirror points for the end pieces to
+             *  be clear of each other.
+             */
+            mInfo->Sm_South = Sa; mInfo->Sm_North = Sb; mInfo->Bm = Bm[i];
+            I[i] = Iinv_interped( mInfo );
+
+        } else {
+
+            /*
+             *  The end pieces run from the mirror points to the second knot
+             *  in, so they are never shorter than one knot interval.
+             */
+            Sum = Iinv_EndPiece( Sa, mInfo->s[iS+2], Bm[i], mInfo ) + Iinv_EndPiece( Sb, mInfo->s[iN-2], Bm[i], mInfo );
+
+            for ( j=iS+2; j<iN-2; j++ ) {
+                h  = 0.5*( mInfo->s[j+1] - mInfo->s[j] );
+                s0 = 0.5*( mInfo->s[j+1] + mInfo->s[j] );
+                if ( !Have[j] ) {
+                    Bnode[3*j]   = BofS( s0 + h*Lgm_GL3_x[0], mInfo );
+                    Bnode[3*j+1] = BofS( s0, mInfo );
+                    Bnode[3*j+2] = BofS( s0 + h*Lgm_GL3_x[2], mInfo );
+                    Have[j] = TRUE;
+                }
+                B = Bnode[3*j];   g = 1.0 - B/Bm[i]; if ( g > 0.0 ) Sum += h*Lgm_GL3_w[0]*sqrt( g );
+                B = Bnode[3*j+1]; g = 1.0 - B/Bm[i]; if ( g > 0.0 ) Sum += h*Lgm_GL3_w[1]*sqrt( g );
+                B = Bnode[3*j+2]; g = 1.0 - B/Bm[i]; if ( g > 0.0 ) Sum += h*Lgm_GL3_w[2]*sqrt( g );
+            }
+            I[i] = Sum;
+
+        }
+        ++nGood;
+
+    }
+
+    mInfo->Bm = Bm0; mInfo->Sm_South = Sm_South0; mInfo->Sm_North = Sm_North0;
+    free( Order );
+    free( Have );
+    free( Bnode );
+
+    return( nGood );
+
+}
+
 
 
 
@@ -398,11 +653,205 @@ double I_integrand( double s, _qpInfo *qpInfo ) {
 
 
 
+/*
+ *  Gradient of I from the first variation of I along the base line.
+ *
+ *  If the field line through v0 is displaced by delta(s), I changes by
+ *
+ *                     / sm_north
+ *                    |    [      grad_perp B                 ]
+ *      dI   =   -    |    [ -------------------  +  f kappa  ] . delta(s) ds,     f = ( 1 - B/Bm )^(1/2)
+ *                    |    [    2 Bm f                        ]
+ *                   / sm_south
+ *
+ *  (kappa is the curvature vector b.grad b; the ends dont contribute since
+ *  f vanishes there). Moving v0 by delta0 moves the point a distance s
+ *  along the line by delta(s) = M(s) delta0, where
+ *
+ *      dr/ds = b,     dM/ds = ( I - b b^T ) J M / B,     M(0) = I
+ *
+ *  with J the Jacobian of B. So all three components of grad I come from
+ *  integrating r and M (RK4) out from v0 along the one base line, using
+ *  Lgm_B_Jacobian() (analytic for most models). The 1/f singularity at the
+ *  mirror points is taken out with s = c + h sin(theta), and the integral
+ *  is done with Gauss-Legendre in theta.
+ *
+ *  This takes a few hundred field+Jacobian evaluations, rather than the 6
+ *  (or up to 18) full I computations (each with its own mirror point
+ *  searches and trace) of the difference scheme.
+ */
+#define LGM_GRAD_I_NGL  48
+
+static void Lgm_GradI_GaussLegendre( int n, double *x, double *w ) {
+
+    int     i, j;
+    double  z, z1, p1, p2, p3, pp;
+
+    for ( i=0; i<(n+1)/2; i++ ) {
+        z = cos( M_PI*(i+0.75)/(n+0.5) );
+        do {
+            for ( p1=1.0, p2=0.0, j=1; j<=n; j++ ) {
+                p3 = p2; p2 = p1;
+                p1 = ( (2.0*j-1.0)*z*p2 - (j-1.0)*p3 )/j;
+            }
+            pp = n*( z*p1 - p2 )/( z*z - 1.0 );
+            z1 = z; z = z1 - p1/pp;
+        } while ( fabs( z-z1 ) > 1e-15 );
+        x[i] = -z; x[n-1-i] = z;        // ascending
+        w[i] = w[n-1-i] = 2.0/( (1.0-z*z)*pp*pp );
+    }
+
+}
+
+static void Lgm_GradI_Deriv( Lgm_Vector *r, double M[3][3], Lgm_Vector *dr, double dM[3][3], Lgm_MagModelInfo *m ) {
+
+    int         i, k;
+    double      J[3][3], JM[3][3], B, b[3], bJM;
+    Lgm_Vector  Bvec;
+
+    Lgm_B_Jacobian( r, &Bvec, J, LGM_DERIV_SIX_POINT, 1e-3, m );
+    B = Lgm_Magnitude( &Bvec );
+    b[0] = Bvec.x/B; b[1] = Bvec.y/B; b[2] = Bvec.z/B;
+    dr->x = b[0]; dr->y = b[1]; dr->z = b[2];
+
+    for ( i=0; i<3; i++ ) {
+        for ( k=0; k<3; k++ ) JM[i][k] = J[i][0]*M[0][k] + J[i][1]*M[1][k] + J[i][2]*M[2][k];
+    }
+    for ( k=0; k<3; k++ ) {
+        bJM = b[0]*JM[0][k] + b[1]*JM[1][k] + b[2]*JM[2][k];
+        for ( i=0; i<3; i++ ) dM[i][k] = ( JM[i][k] - b[i]*bJM )/B;
+    }
+
+}
+
+static void Lgm_GradI_RK4( Lgm_Vector *r, double M[3][3], double h, Lgm_MagModelInfo *m ) {
+
+    int         i, k, q;
+    double      Mt[3][3], dM[4][3][3];
+    Lgm_Vector  rt, dr[4];
+    double      c[4] = { 0.0, 0.5, 0.5, 1.0 };
+
+    for ( q=0; q<4; q++ ) {
+        rt = *r;
+        for ( i=0; i<3; i++ ) for ( k=0; k<3; k++ ) Mt[i][k] = M[i][k];
+        if ( q > 0 ) {
+            rt.x += c[q]*h*dr[q-1].x; rt.y += c[q]*h*dr[q-1].y; rt.z += c[q]*h*dr[q-1].z;
+            for ( i=0; i<3; i++ ) for ( k=0; k<3; k++ ) Mt[i][k] += c[q]*h*dM[q-1][i][k];
+        }
+        Lgm_GradI_Deriv( &rt, Mt, &dr[q], dM[q], m );
+    }
+
+    r->x += h/6.0*( dr[0].x + 2.0*dr[1].x + 2.0*dr[2].x + dr[3].x );
+    r->y += h/6.0*( dr[0].y + 2.0*dr[1].y + 2.0*dr[2].y + dr[3].y );
+    r->z += h/6.0*( dr[0].z + 2.0*dr[1].z + 2.0*dr[2].z + dr[3].z );
+    for ( i=0; i<3; i++ ) for ( k=0; k<3; k++ ) M[i][k] += h/6.0*( dM[0][i][k] + 2.0*dM[1][i][k] + 2.0*dM[2][i][k] + dM[3][i][k] );
+
+}
+
+/*
+ *  Add -w ( grad_perp B/(2 Bm f) + f kappa ) . M to G.
+ */
+static void Lgm_GradI_Integrand( Lgm_Vector *r, double M[3][3], double w, double *G, Lgm_MagModelInfo *m ) {
+
+    int         i, k;
+    double      J[3][3], B, b[3], gB[3], Jb[3], gBb, bJb, g, f, F[3];
+    Lgm_Vector  Bvec;
+
+    Lgm_B_Jacobian( r, &Bvec, J, LGM_DERIV_SIX_POINT, 1e-3, m );
+    B = Lgm_Magnitude( &Bvec );
+    g = 1.0 - B/m->Bm;
+    if ( g <= 0.0 ) return;     // (only just past a mirror point)
+    f = sqrt( g );
+    b[0] = Bvec.x/B; b[1] = Bvec.y/B; b[2] = Bvec.z/B;
+
+    for ( k=0; k<3; k++ ) {
+        gB[k] = b[0]*J[0][k] + b[1]*J[1][k] + b[2]*J[2][k];     // grad B
+        Jb[k] = J[k][0]*b[0] + J[k][1]*b[1] + J[k][2]*b[2];     // B kappa + b db/ds
+    }
+    gBb = gB[0]*b[0] + gB[1]*b[1] + gB[2]*b[2];
+    bJb = Jb[0]*b[0] + Jb[1]*b[1] + Jb[2]*b[2];
+    for ( i=0; i<3; i++ ) F[i] = ( gB[i] - gBb*b[i] )/( 2.0*m->Bm*f ) + f*( Jb[i] - bJb*b[i] )/B;
+
+    for ( k=0; k<3; k++ ) G[k] -= w*( F[0]*M[0][k] + F[1]*M[1][k] + F[2]*M[2][k] );
+
+}
+
+static int Lgm_Grad_I_Perturb( Lgm_Vector *v0, Lgm_Vector *GradI, Lgm_MagModelInfo *mInfo ) {
+
+    int         j, k, n, Dir, N = LGM_GRAD_I_NGL;
+    double      x[LGM_GRAD_I_NGL], w[LGM_GRAD_I_NGL], Ss, Sn, c, h, Hmax, s, sj, ds, th, M[3][3], G[3];
+    Lgm_Vector  Ps, Pn, r;
+
+    if ( Lgm_TraceToMirrorPoints( v0, 1, &mInfo->Bm, &Ss, &Sn, &Ps, &Pn, mInfo ) != 1 ) return( FALSE );
+    if ( Ss + Sn <= 1e-5 ) {
+        // v0 is (about) at the mirror points
+        GradI->x = GradI->y = GradI->z = 0.0;
+        return( TRUE );
+    }
+
+    // s runs along b from v0, so the mirror points are at -Ss and Sn.
+    c    = 0.5*( Sn - Ss );
+    h    = 0.5*( Sn + Ss );
+    Hmax = ( Sn + Ss )/(double)( mInfo->nDivs > 0 ? mInfo->nDivs : 200 );
+    Lgm_GradI_GaussLegendre( N, x, w );
+
+    G[0] = G[1] = G[2] = 0.0;
+    for ( Dir=1; Dir>=-1; Dir-=2 ) {
+
+        r = *v0; s = 0.0;
+        M[0][0] = 1.0; M[0][1] = 0.0; M[0][2] = 0.0;
+        M[1][0] = 0.0; M[1][1] = 1.0; M[1][2] = 0.0;
+        M[2][0] = 0.0; M[2][1] = 0.0; M[2][2] = 1.0;
+
+        for ( k=0; k<N; k++ ) {
+
+            j  = ( Dir > 0 ) ? k : N-1-k;   // nodes going away from v0
+            th = 0.5*M_PI*x[j];
+            sj = c + h*sin( th );
+            if ( ( Dir > 0 ) ? ( sj < 0.0 ) : ( sj >= 0.0 ) ) continue;
+
+            n  = (int)ceil( fabs( sj - s )/Hmax );
+            if ( n > 0 ) {
+                ds = ( sj - s )/(double)n;
+                while ( n-- > 0 ) Lgm_GradI_RK4( &r, M, ds, mInfo );
+                s = sj;
+            }
+
+            Lgm_GradI_Integrand( &r, M, w[j]*0.5*M_PI*h*cos( th ), G, mInfo );
+
+        }
+
+    }
+
+    GradI->x = G[0]; GradI->y = G[1]; GradI->z = G[2];
+
+    return( TRUE );
+
+}
+
+
 /*
  *  Compute Gradient of I
+ *
+ *  With mInfo->Lgm_GradI_Method = LGM_GRAD_I_PERTURB (the default) this is
+ *  done along the one field line through v0 (see Lgm_Grad_I_Perturb()
+ *  above). With LGM_GRAD_I_FD (or if the mirror points of the line through
+ *  v0 cant be found) I is computed on displaced lines and differenced.
  */
 int Lgm_Grad_I( Lgm_Vector *v0, Lgm_Vector *GradI, Lgm_MagModelInfo *mInfo ) {
 
+    if ( ( mInfo->Lgm_GradI_Method == LGM_GRAD_I_PERTURB ) && Lgm_Grad_I_Perturb( v0, GradI, mInfo ) ) return( 0 );
+
+    return( Lgm_Grad_I_FD( v0, GradI, mInfo ) );
+
+}
+
+
+/*
+ *  Gradient of I by differencing I computed on displaced lines.
+ */
+static int Lgm_Grad_I_FD( Lgm_Vector *v0, Lgm_Vector *GradI, Lgm_MagModelInfo *mInfo ) {
+
     Lgm_Vector  u, Pa, Pb;
     double  rat, H, h, a, b, SS, Sa, Sb, I, f[6], r;
     int     i, N;
@@ -487,7 +936,6 @@ int Lgm_Grad_I( Lgm_Vector *v0, Lgm_Vector *GradI, Lgm_MagModelInfo *mInfo ) {
                         } else {
                             // Eqn 2.66b in Roederer
                             I = SS*sqrt(1.0 - rat);
-printf("HEREEEEEEEEEEEEEEEEEEEEEEe\n");
                         }
                     } else {
                         I = Iinv_interped( mInfo  );
@@ -12,6 +12,8 @@
  */
 #include <EXTERN.h>
 #include <perl.h>
+#include <ctype.h>
+#include <string.h>
 #include "Lgm/Lgm_CTrans.h"
 
 /*
@@ -88,14 +90,107 @@
 
 static PerlInterpreter *my_perl;
 
-int IsoTimeStringToDateTime( char *TimeString, Lgm_DateTime *d, Lgm_CTrans *c ) {
 
-    long int    Date;
-    double      Offset, Time;
-    int         tyear, tday, tmonth, sgn;
-    int         Year, wYear, Month, Day, Hours, Minutes, TZD_sgn, TZD_hh, TZD_mm, Week, DayOfWeek, DayOfYear;
-    int         ISOFormat, TZDError=FALSE, MaxWeek, InvalidDate=FALSE, IsLeapSecondDay;
-    double      Seconds;
+/*
+ *  Parses n decimal digits at s. Returns -1 if they aren't all digits.
+ */
+static int Lgm_IsoTime_Digits( const char *s, int n ) {
+
+    int i, v = 0;
+
+    for ( i=0; i<n; i++ ) {
+        if ( ( s[i] < '0' ) || ( s[i] > '9' ) ) return( -1 );
+        v = 10*v + ( s[i] - '0' );
+    }
+    return( v );
+
+}
+
+
+/*
+ *  Fast path for the fixed formats that nearly all of our data files use,
+ *
+ *      YYYY-MM-DDThh:mm:ss[.sss...][Z | +-hh[[:]mm]]
+ *      YYYY-DDDThh:mm:ss[.sss...][Z | +-hh[[:]mm]]
+ *
+ *  (with 'T' or a space between the date and time, and leading or trailing
+ *  white space allowed). Returns the same fields the Perl parser would, and
+ *  TRUE; or FALSE if the string is not exactly one of these, in which case
+ *  the general parser has to be used. Only the format is checked here --
+ *  the values are range checked by Lgm_IsoTime_Finish() either way.
+ */
+static int Lgm_IsoTime_FastParse( const char *s, int *ISOFormat, int *Year, int *Month, int *Day, int *DayOfYear, int *Hours, int *Minutes,
+                                    double *Seconds, int *TZD_sgn, int *TZD_hh, int *TZD_mm ) {
+
+    const char  *p, *q;
+    char        Sec[64];
+    int         n;
+
+    p = s;
+    while ( isspace( (unsigned char)*p ) ) ++p;
+
+    // date
+    if ( ( (*Year = Lgm_IsoTime_Digits( p, 4 )) < 0 ) || ( p[4] != '-' ) ) return( FALSE );
+    p += 5;
+    if ( ( p[2] == '-' ) && ( (*Month = Lgm_IsoTime_Digits( p, 2 )) >= 0 ) && ( (*Day = Lgm_IsoTime_Digits( p+3, 2 )) >= 0 ) ) {
+        *DayOfYear = -9999;
+        *ISOFormat = ISO_YYYYMMDDTHHMMSS;
+        p += 5;
+    } else if ( (*DayOfYear = Lgm_IsoTime_Digits( p, 3 )) >= 0 ) {
+        *Month = *Day = -9999;
+        *ISOFormat = ISO_YYYYDDDTHHMMSS;
+        p += 3;
+    } else {
+        return( FALSE );
+    }
+
+    // time
+    if ( ( *p != 'T' ) && ( *p != ' ' ) ) return( FALSE );
+    ++p;
+    if ( ( (*Hours = Lgm_IsoTime_Digits( p, 2 )) < 0 ) || ( p[2] != ':' ) ) return( FALSE );
+    if ( ( (*Minutes = Lgm_IsoTime_Digits( p+3, 2 )) < 0 ) || ( p[5] != ':' ) ) return( FALSE );
+    p += 6;
+    q = p;
+    if ( Lgm_IsoTime_Digits( p, 2 ) < 0 ) return( FALSE );
+    p += 2;
+    if ( *p == '.' ) {
+        ++p;
+        while ( ( *p >= '0' ) && ( *p <= '9' ) ) ++p;
+    }
+    if ( ( n = (int)(p - q) ) > 63 ) return( FALSE );
+    memcpy( Sec, q, n ); Sec[n] = '\0';
+    *Seconds = atof( Sec );
+
+    // time zone
+    *TZD_sgn = +1; *TZD_hh = 0; *TZD_mm = 0;
+    if ( *p == 'Z' ) {
+        ++p;
+    } else if ( ( *p == '+' ) || ( *p == '-' ) ) {
+        *TZD_sgn = ( *p == '+' ) ? +1 : -1;
+        if ( (*TZD_hh = Lgm_IsoTime_Digits( p+1, 2 )) < 0 ) return( FALSE );
+        p += 3;
+        if ( *p == ':' ) ++p;
+        if ( ( *p >= '0' ) && ( *p <= '9' ) ) {
+            if ( (*TZD_mm = Lgm_IsoTime_Digits( p, 2 )) < 0 ) return( FALSE );
+            p += 2;
+        } else if ( p[-1] == ':' ) {
+            return( FALSE );
+        }
+    }
+
+    while ( isspace( (unsigned char)*p ) ) ++p;
+
+    return( *p == '\0' );
+
+}
+
+
+/*
+ *  The general (Perl regex based) parser.
+ */
+static void Lgm_IsoTime_PerlParse( char *TimeString, int *ISOFormat, int *Year, int *Month, int *Day, int *DayOfYear, int *Hours, int *Minutes,
+                                    double *Seconds, int *TZD_sgn, int *TZD_hh, int *TZD_mm, int *Week, int *DayOfWeek, int *TZDError ) {
+
     STRLEN      n_a;
     char        *embedding[] = { "", "-e", "0" };
     char        Str[6000];
@@ -570,27 +665,38 @@ int IsoTimeStringToDateTime( char *TimeString, Lgm_DateTime *d, Lgm_CTrans *c )
 
     eval_pv( Str, TRUE );
 
-    Year      = SvIV(get_sv("oYear", FALSE));
-    DayOfYear = SvIV(get_sv("oDayOfYear", FALSE));
-    Month     = SvIV(get_sv("oMonth", FALSE));
-    Day       = SvIV(get_sv("oDay", FALSE));
-    Hours     = SvIV(get_sv("oHour", FALSE));
-    Minutes   = SvIV(get_sv("oMinute", FALSE));
-    Seconds   = atof(SvPV(get_sv("oSecond", FALSE), n_a));
-    TZD_sgn   = SvIV(get_sv("oTZD_sgn", FALSE));
-    TZD_hh    = SvIV(get_sv("oTZD_hh", FALSE));
-    TZD_mm    = SvIV(get_sv("oTZD_mm", FALSE));
-    Week      = SvIV(get_sv("oWeek", FALSE));
-    DayOfWeek = SvIV(get_sv("oDayOfWeek", FALSE));
-    TZDError  = SvIV(get_sv("oTZDError", FALSE));
-    ISOFormat = SvIV(get_sv("oISOFormat", FALSE));
+    *Year      = SvIV(get_sv("oYear", FALSE));
+    *DayOfYear = SvIV(get_sv("oDayOfYear", FALSE));
+    *Month     = SvIV(get_sv("oMonth", FALSE));
+    *Day       = SvIV(get_sv("oDay", FALSE));
+    *Hours     = SvIV(get_sv("oHour", FALSE));
+    *Minutes   = SvIV(get_sv("oMinute", FALSE));
+    *Seconds   = atof(SvPV(get_sv("oSecond", FALSE), n_a));
+    *TZD_sgn   = SvIV(get_sv("oTZD_sgn", FALSE));
+    *TZD_hh    = SvIV(get_sv("oTZD_hh", FALSE));
+    *TZD_mm    = SvIV(get_sv("oTZD_mm", FALSE));
+    *Week      = SvIV(get_sv("oWeek", FALSE));
+    *DayOfWeek = SvIV(get_sv("oDayOfWeek", FALSE));
+    *TZDError  = SvIV(get_sv("oTZDError", FALSE));
+    *ISOFormat = SvIV(get_sv("oISOFormat", FALSE));
 
     perl_destruct(my_perl);
     perl_free(my_perl);
 
+}
 
 
+/*
+ *  Fills d from the parsed fields, and checks them. Returns 1 if the time is
+ *  valid, -1 otherwise.
+ */
+static int Lgm_IsoTime_Finish( int ISOFormat, int Year, int Month, int Day, int DayOfYear, int Hours, int Minutes, double Seconds,
+                                int TZD_sgn, int TZD_hh, int TZD_mm, int Week, int DayOfWeek, int TZDError, Lgm_DateTime *d, Lgm_CTrans *c ) {
 
+    long int    Date;
+    double      Offset, Time;
+    int         tyear, tday, tmonth;
+    int         MaxWeek, InvalidDate=FALSE, IsLeapSecondDay;
 
 
     // Assume time is UTC for now...
@@ -774,6 +880,157 @@ int IsoTimeStringToDateTime( char *TimeString, Lgm_DateTime *d, Lgm_CTrans *c )
 
 
 
+int IsoTimeStringToDateTime( char *TimeString, Lgm_DateTime *d, Lgm_CTrans *c ) {
+
+    int         Year, Month, Day, Hours, Minutes, TZD_sgn, TZD_hh, TZD_mm, Week = 0, DayOfWeek = 0, DayOfYear;
+    int         ISOFormat, TZDError = FALSE;
+    double      Seconds;
+
+    if ( !Lgm_IsoTime_FastParse( TimeString, &ISOFormat, &Year, &Month, &Day, &DayOfYear, &Hours, &Minutes, &Seconds, &TZD_sgn, &TZD_hh, &TZD_mm ) ) {
+        Lgm_IsoTime_PerlParse( TimeString, &ISOFormat, &Year, &Month, &Day, &DayOfYear, &Hours, &Minutes, &Seconds, &TZD_sgn, &TZD_hh, &TZD_mm, &Week, &DayOfWeek, &TZDError );
+    }
+
+    return( Lgm_IsoTime_Finish( ISOFormat, Year, Month, Day, DayOfYear, Hours, Minutes, Seconds, TZD_sgn, TZD_hh, TZD_mm, Week, DayOfWeek, TZDError, d, c ) );
+
+}
+
+
+
+/*
+ *  Memo of the last day seen by the batch parsers. d0 is the fully
+ *  processed record for 00:00:00 UTC on that day, so a time on the same day
+ *  only needs its time-of-day fields filled in.
+ */
+typedef struct Lgm_IsoTimeMemo {
+    int             Valid;
+    int             ISOFormat, Year, Month, Day, DayOfYear;
+    Lgm_DateTime    d0;
+    double          TaiSeconds0;
+} Lgm_IsoTimeMemo;
+
+
+/*
+ *  IsoTimeStringToDateTime() with the per-day memo. Fast-path UTC times that
+ *  fall on the memoised day (and are not within a millisecond of midnight or
+ *  in a leap second) are done without any calendar work; they give the same
+ *  result as IsoTimeStringToDateTime().
+ */
+static int Lgm_IsoTime_ParseMemo( char *TimeString, Lgm_DateTime *d, Lgm_IsoTimeMemo *m, Lgm_CTrans *c ) {
+
+    int         Year, Month, Day, Hours, Minutes, TZD_sgn, TZD_hh, TZD_mm, DayOfYear, ISOFormat;
+    double      Seconds, Time;
+
+    if ( !Lgm_IsoTime_FastParse( TimeString, &ISOFormat, &Year, &Month, &Day, &DayOfYear, &Hours, &Minutes, &Seconds, &TZD_sgn, &TZD_hh, &TZD_mm ) ) {
+        return( IsoTimeStringToDateTime( TimeString, d, c ) );
+    }
+
+    if ( ( TZD_hh != 0 ) || ( TZD_mm != 0 ) || ( Hours > 23 ) || ( Minutes > 59 ) || ( Seconds >= 60.0 )
+            || ( ( Hours == 23 ) && ( Minutes == 59 ) && ( Seconds >= 59.999 ) ) ) {
+        return( Lgm_IsoTime_Finish( ISOFormat, Year, Month, Day, DayOfYear, Hours, Minutes, Seconds, TZD_sgn, TZD_hh, TZD_mm, 0, 0, FALSE, d, c ) );
+    }
+
+    if ( ( m->ISOFormat != ISOFormat ) || ( m->Year != Year ) || ( m->Month != Month ) || ( m->Day != Day ) || ( m->DayOfYear != DayOfYear ) ) {
+        m->ISOFormat = ISOFormat; m->Year = Year; m->Month = Month; m->Day = Day; m->DayOfYear = DayOfYear;
+        m->Valid = ( Lgm_IsoTime_Finish( ISOFormat, Year, Month, Day, DayOfYear, 0, 0, 0.0, +1, 0, 0, 0, 0, FALSE, &m->d0, c ) == 1 );
+        m->TaiSeconds0 = ( m->Valid ) ? Lgm_UTC_to_TaiSeconds( &m->d0, c ) : 0.0;
+    }
+    if ( !m->Valid ) {
+        return( Lgm_IsoTime_Finish( ISOFormat, Year, Month, Day, DayOfYear, Hours, Minutes, Seconds, TZD_sgn, TZD_hh, TZD_mm, 0, 0, FALSE, d, c ) );
+    }
+
+    // Same arithmetic as Lgm_IsoTime_Finish() and Lgm_JD()
+    Time      = Hours + Minutes/60.0 + Seconds/3600.0;
+    *d        = m->d0;
+    d->JD     = m->d0.JD + Time*3600.0/m->d0.DaySeconds;
+    d->Hour   = Hours;
+    d->Minute = Minutes;
+    d->Second = Seconds;
+    d->Time   = (double)d->Hour + (double)d->Minute/60.0 + d->Second/3600.0;
+    d->T      = (d->JD - 2451545.0)/36525.0;
+    d->fYear  = (double)d->Year + ((double)d->Doy - 1.0 + d->Time/24.0)/(365.0 + (double)Lgm_LeapYear(d->Year));
+
+    return( 1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Parse an array of ISO 8601 time strings.
+ *
+ *  \details
+ *      Equivalent to calling IsoTimeStringToDateTime() on each string, but
+ *      strings in the common YYYY-MM-DDThh:mm:ss[.sss]Z and
+ *      YYYY-DDDThh:mm:ss[.sss]Z forms that fall on the same day as the
+ *      previous one re-use its date processing (week number, day of week,
+ *      leap second check, Julian Date of midnight).
+ *
+ *      \param[in]      n               Number of strings.
+ *      \param[in]      TimeStrings     The strings.
+ *      \param[out]     d               Array of n Lgm_DateTime records. Invalid strings get d[i].Date = -1.
+ *      \param[in,out]  c               Lgm_CTrans structure.
+ *
+ *      \return         The number of strings that were parsed successfully.
+ *
+ */
+long int Lgm_IsoTimeStringsToDateTimes( long int n, char **TimeStrings, Lgm_DateTime *d, Lgm_CTrans *c ) {
+
+    Lgm_IsoTimeMemo m;
+    long int        i, nGood = 0;
+
+    m.ISOFormat = ISO_ERROR;
+    for ( i=0; i<n; i++ ) {
+        if ( Lgm_IsoTime_ParseMemo( TimeStrings[i], &d[i], &m, c ) == 1 ) ++nGood;
+    }
+
+    return( nGood );
+
+}
+
+
+/**
+ *  \brief
+ *      Parse an array of ISO 8601 UTC time strings directly into TaiSeconds.
+ *
+ *  \details
+ *      As Lgm_IsoTimeStringsToDateTimes() followed by
+ *      Lgm_UTC_to_TaiSeconds() on each result (to round-off), but the leap
+ *      second lookup is also only done once per day.
+ *
+ *      \param[in]      n               Number of strings.
+ *      \param[in]      TimeStrings     The strings.
+ *      \param[out]     TaiSeconds      Array of n SI seconds since 0h Jan 1, 1958. Invalid strings give LGM_FILL_VALUE.
+ *      \param[in,out]  c               Lgm_CTrans structure.
+ *
+ *      \return         The number of strings that were parsed successfully.
+ *
+ */
+long int Lgm_IsoTimeStringsToTaiSeconds( long int n, char **TimeStrings, double *TaiSeconds, Lgm_CTrans *c ) {
+
+    Lgm_IsoTimeMemo m;
+    Lgm_DateTime    d;
+    long int        i, nGood = 0;
+
+    m.ISOFormat = ISO_ERROR;
+    for ( i=0; i<n; i++ ) {
+        if ( Lgm_IsoTime_ParseMemo( TimeStrings[i], &d, &m, c ) == 1 ) {
+            if ( m.Valid && ( d.Date == m.d0.Date ) && ( d.Second < 60.0 ) ) {
+                TaiSeconds[i] = m.TaiSeconds0 + d.Time*3600.0;
+            } else {
+                TaiSeconds[i] = Lgm_UTC_to_TaiSeconds( &d, c );
+            }
+            ++nGood;
+        } else {
+            TaiSeconds[i] = LGM_FILL_VALUE;
+        }
+    }
+
+    return( nGood );
+
+}
+
+
+
 //int main (int argc, char **argv, char **env) {
 //
 //    int     Flag;
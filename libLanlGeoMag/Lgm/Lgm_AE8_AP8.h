@@ -24,11 +24,35 @@
 #define LGM_DIFFERENTIAL_FLUX 2
 
 
+/*
+ *  A model MAP decoded into fixed size rows (see Lgm_AE8_AP8_GetTable()).
+ *  Row[e][n][1..Row[e][n][1]] is the n'th L block of the map for energy E[e]
+ *  (block length, scaled L, scaled log flux, then the scaled B/B0
+ *  increments), and Ls[e][n] is its scaled L. Each energy has nL[e] blocks
+ *  including the final L = 32767 one.
+ */
+typedef struct Lgm_AE8_AP8_Table {
+    int     MODEL;
+    int     nE;             // Number of energy maps
+    int     nNodes;         // Most L blocks in any energy map
+    int     nRow;           // Row length (longest block + 1)
+    double  *E;             // Energies of the maps (MeV)
+    int     *nL;            // Number of L blocks in each map
+    int     ***Row;         // Row[nE][nNodes][nRow]
+    int     **Ls;           // Ls[nE][nNodes]
+    double  FISTEP, ESCALE, FSCALE;
+    int     LSCALE, BSCALE;
+} Lgm_AE8_AP8_Table;
+
+
 
 void    TRARA1( int DESCR[], int MAP[], double FL, double BB0, double E[], double F[], int N );
 double  TRARA2( int MAP[], int IL, int IB, double FISTEP );
 double  Lgm_AE8_AP8_Flux( double L, double BB0, int MODEL, int FLUXTYPE, double E1, double E2 );
 double  Lgm_AE8_AP8_FluxFromPos( Lgm_Vector *u, int MODEL, int FLUXTYPE, double E1, double E2, Lgm_MagModelInfo *m );
+Lgm_AE8_AP8_Table *Lgm_AE8_AP8_GetTable( int MODEL );
+int     Lgm_AE8_AP8_Flux_Grid( int MODEL, int FLUXTYPE, int nE, double *E, int nPts, double *L, double *BB0, double **Flux );
+int     Lgm_AE8_AP8_FluxFromPos_Orbit( int n, long int *Date, double *UTC, Lgm_Vector *u, int MODEL, int FLUXTYPE, int nE, double *E, double **Flux, double *L, double *BB0, Lgm_MagModelInfo *m );
 
 
 
@@ -1,9 +1,35 @@
+#ifndef LGM_AE_INDEX_H
+#define LGM_AE_INDEX_H
+
 #include "Lgm/Lgm_CTrans.h"
 
+#ifndef LGM_AE_DATA_DIR
+#define LGM_AE_DATA_DIR     "/n/projects/lanl/geo/Data/AE"
+#endif
+
 /* This is where I store the date */
-Lgm_DateTime AEdatetime[4096] ;
-int AE_index[4096], AL_index[4096], AU_index[4096], AO_index[4096], index_length ;
-char AEfilename[1024] ;
+extern Lgm_DateTime AEdatetime[4096] ;
+extern int AE_index[4096], AL_index[4096], AU_index[4096], AO_index[4096], index_length ;
+extern char AEfilename[1024] ;
+
+/*
+ *  Minute resolution store of the AE, AL, AU and AO indices over a range of
+ *  days (see Lgm_AE_LoadRange()). Element k of each array is minute k since
+ *  0 UT of StartDate; minutes with no data are LGM_FILL_VALUE.
+ */
+#define LGM_AE_AE     0
+#define LGM_AE_AL     1
+#define LGM_AE_AU     2
+#define LGM_AE_AO     3
+
+typedef struct Lgm_AE_Store {
+    long int    StartDate;      //!< First day in the store (YYYYMMDD)
+    long int    EndDate;        //!< Last day in the store (YYYYMMDD)
+    long int    StartJDN;       //!< Julian Day Number of StartDate
+    long int    nMinutes;       //!< Number of minutes in the store (1440 per day)
+    int         nDaysMissing;   //!< Days in the range for which there was no file
+    float       *Index[4];      //!< Index[LGM_AE_AE][k], etc.
+} Lgm_AE_Store;
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +43,14 @@ double Lgm_get_AO(int,int,int,int,int,int) ;
 double Lgm_get_index(int,int,int,int,int,int,int*) ;
 void Lgm_Read_AEfile(int,int,int) ;
 
+Lgm_AE_Store *Lgm_AE_LoadRange( long int StartDate, long int EndDate ) ;
+void   Lgm_AE_FreeStore( Lgm_AE_Store *s ) ;
+long int Lgm_AE_StoreMinute( Lgm_AE_Store *s, int Year, int Month, int Day, double Time ) ;
+double Lgm_AE_StoreGet( Lgm_AE_Store *s, int Which, Lgm_DateTime *UTC ) ;
+int    Lgm_AE_StoreGetArray( Lgm_AE_Store *s, int Which, int n, Lgm_DateTime *UTC, double *Val ) ;
+
 #ifdef __cplusplus
 }
 #endif
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef LGM_ARENA_H
+#define LGM_ARENA_H
+
+#include <stddef.h>
+
+/*
+ *  A simple bump allocator. Memory is handed out from large blocks and is
+ *  only given back all at once (Lgm_FreeArena() or Lgm_Arena_Reset()). See
+ *  Lgm_Arena.c, and the LGM_ARRAY_nD_ARENA() macros in Lgm_DynamicMemory.h.
+ */
+#define LGM_ARENA_ALIGN         64              // every allocation starts on a cache line
+#define LGM_ARENA_BLOCK_SIZE    (1024*1024)     // default block size [bytes]
+
+typedef struct Lgm_ArenaBlock {
+    struct Lgm_ArenaBlock   *Next;
+    size_t                  Size;   // usable bytes in this block
+    size_t                  Used;   // bytes handed out so far
+    char                    *Data;  // aligned start of the usable bytes
+} Lgm_ArenaBlock;
+
+typedef struct Lgm_Arena {
+    size_t          BlockSize;      // size of new blocks (bigger requests get a block of their own)
+    Lgm_ArenaBlock  *First;         // list of blocks
+    Lgm_ArenaBlock  *Cur;           // block being filled (the ones after it are empty)
+    size_t          nBytes;         // total bytes handed out
+    long int        nBlocks;        // number of blocks malloc'd
+} Lgm_Arena;
+
+Lgm_Arena  *Lgm_CreateArena( size_t BlockSize );
+void       *Lgm_Arena_Calloc( Lgm_Arena *a, size_t n, size_t size );
+void        Lgm_Arena_Reset( Lgm_Arena *a );
+void        Lgm_FreeArena( Lgm_Arena *a );
+
+#endif
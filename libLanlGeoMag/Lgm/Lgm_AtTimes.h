@@ -0,0 +1,25 @@
+#ifndef LGM_ATTIMES_H
+#define LGM_ATTIMES_H
+
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+/*
+ *  Array versions of the per point routines, where every point has its own
+ *  time (and optionally its own Kp). Positions are n Lgm_Vectors, i.e. a
+ *  contiguous n x 3 array of doubles, so these can be handed NumPy buffers
+ *  directly (see lgmpy/batch.py). Kp can be NULL, in which case the Kp
+ *  already in the Lgm_MagModelInfo is used. See Lgm_AtTimes.c.
+ */
+void    Lgm_Convert_Coords_AtTimes( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c );
+void    Lgm_Convert_Coords_AtTimes_Timeline( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag,
+                                             Lgm_CTransTimeline *tl, Lgm_CTrans *c );
+int     Lgm_B_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, Lgm_Vector *B, Lgm_MagModelInfo *mInfo );
+int     Lgm_B_Ensemble_AtTimes( long int n, long int *Date, double *UTC, Lgm_Vector *u, int nModels, Lgm_MagModelInfo **Models, int QinDenton, Lgm_Vector *B );
+int     Lgm_Trace_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, double Height, double TOL1, double TOL2,
+                           int *Flag, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, Lgm_MagModelInfo *mInfo );
+int     Lgm_ComputeLstarVersusPA_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, int nAlpha, double *Alpha,
+                                          double *Lstar, double *I, double *K, double *Bm, Lgm_MagEphemInfo *MagEphemInfo );
+
+#endif
@@ -76,6 +76,14 @@
 #define LGM_EPH_DE              2
 #define LGM_PN_IAU76            12
 #define LGM_PN_IAU06            12
+#define LGM_PN_IAU76_CACHED     13  // IAU76 with dPsi/dEps from per-day Chebyshev fits (see Lgm_Nutation_Cached())
+
+#define LGM_CTRANS_TIER_FULL    0   // Option presets for Lgm_Set_CTrans_Tier(): everything evaluated exactly
+#define LGM_CTRANS_TIER_FAST    1   //  cached fits and a 1 hour slow tier; sub-arcsec, sub-km at GEO
+#define LGM_CTRANS_TIER_FASTEST 2   //  low accuracy Sun/Moon and a 6 hour slow tier
+
+#define LGM_NUTATION_MAX_COEFFS 16  // Largest number of Chebyshev coefficients in a Lgm_NutationCache fit
+#define LGM_EPHEM_CACHE_MAX_COEFFS 16   // Largest number of Chebyshev coefficients in a Lgm_EphemCache fit
 
 
 /*
@@ -88,6 +96,8 @@
 #define LGM_TIME_SYS_TDB    4
 #define LGM_TIME_SYS_UT1    5
 
+#define LGM_UNIX_EPOCH_UTCSECONDS   378691200.0 // 0h Jan 1, 1970 UTC in the UTC seconds of Lgm_ConvertTimeSeconds() (i.e. Unix time = UtcSeconds - this)
+
 
 
 /*
@@ -497,6 +507,8 @@ typedef struct Lgm_LeapSeconds {
 
     double      *LeapSeconds;       //!< The actual number of leap seconds that  went into effect on the given date
 
+    int         Cursor;             //!< Index found by the last Lgm_GetLeapSeconds() (each Lgm_CTrans has its own)
+
 
 } Lgm_LeapSeconds;
 
@@ -547,12 +559,87 @@ typedef struct Lgm_DateTime {
 } Lgm_DateTime;
 
 
+/*
+ * Fixed width ISO 8601 time strings for the output writers (see
+ * Lgm_IsoTimeFormatter_Put()). A zeroed structure is ready to use. It
+ * remembers the last string it made, so a run of times on the same day only
+ * has the digits that changed rewritten.
+ */
+#define LGM_ISOTIME_MAXLEN  32
+typedef struct Lgm_IsoTimeFormatter {
+    char        Str[LGM_ISOTIME_MAXLEN];    //!< The last string made
+    int         Len;                        //!< strlen( Str )
+    int         Valid;                      //!< TRUE if the fields below go with Str
+    int         p;                          //!< Decimals on the seconds
+    long int    Date;
+    int         TimeSystem;
+    int         HH, MM, SS;
+    long int    Frac;                       //!< Seconds fraction in units of 10^-p
+} Lgm_IsoTimeFormatter;
+
+
+/*
+ *  One day (TT) of dPsi and dEps fitted with Chebyshev polynomials. See
+ *  Lgm_Nutation_Cached().
+ */
+typedef struct Lgm_NutationCache {
+
+    int         nTerms;                             //!< Number of series terms the fit is for (0 if nothing is cached)
+    int         nCoeffs;                            //!< Number of Chebyshev coefficients used
+    double      Tolerance;                          //!< Fit error budget for nTerms (arcsec)
+    double      T0;                                 //!< Start of the cached day (Julian centuries TT since J2000)
+    double      T1;                                 //!< End of the cached day (Julian centuries TT since J2000)
+    double      cPsi[LGM_NUTATION_MAX_COEFFS];      //!< Chebyshev coefficients of dPsi (arcsec)
+    double      cEps[LGM_NUTATION_MAX_COEFFS];      //!< Chebyshev coefficients of dEps (arcsec)
+
+} Lgm_NutationCache;
+
+
+/*
+ *  One day (TT) of Sun and Moon positions fitted with Chebyshev polynomials.
+ *  For LGM_EPH_HIGH_ACCURACY the series are the l, r, b of Lgm_SunPosition()
+ *  (l unwrapped across the day). For LGM_EPH_DE they are the geocentric Sun
+ *  and Moon vectors in GCRF (km). See Lgm_EphemCache_SunPosition().
+ */
+typedef struct Lgm_EphemCache {
+
+    int         ephModel;                           //!< Model the fit is for (LGM_EPH_LOW_ACCURACY if nothing is cached)
+    int         DEnum;                              //!< DE version for LGM_EPH_DE fits
+    int         nSeries;                            //!< Number of fitted series (3 or 6)
+    int         nCoeffs;                            //!< Number of Chebyshev coefficients used
+    double      JD0;                                //!< Start of the cached day (TT Julian Date)
+    double      JD1;                                //!< End of the cached day (TT Julian Date)
+    double      Coeffs[6][LGM_EPHEM_CACHE_MAX_COEFFS];  //!< Chebyshev coefficients of each series
+
+} Lgm_EphemCache;
+
+
+/*
+ *  Slowly varying quantities saved at a refresh node of the tiered
+ *  Lgm_Set_Coord_Transforms() update. See Lgm_Set_CTrans_SlowTierCadence().
+ */
+typedef struct Lgm_CTrans_SlowTierNode {
+
+    double      JD;                 //!< UTC Julian Date of the node
+    double      dPsi;               //!< Nutation in longitude, without the EOP correction (arcsec)
+    double      dEps;               //!< Nutation in obliquity, without the EOP correction (arcsec)
+    Lgm_Vector  D;                  //!< Centered dipole axis (unit vector in WGS84)
+    double      M_cd;               //!< Centered dipole moment (nT Re^3)
+    Lgm_Vector  ED;                 //!< Eccentric dipole offset (ED_x0, ED_y0, ED_z0) in Re
+    Lgm_Vector  Moon;               //!< Direction of Moon in MOD (unit vector)
+    Lgm_Vector  MoonJ2000;          //!< Direction of Moon in GEI2000 (unit vector)
+    double      EarthMoonDistance;  //!< Distance between the Earth and Moon (in earth-radii)
+    double      MoonPhase;          //!< The Phase of the Moon
+
+} Lgm_CTrans_SlowTierNode;
+
+
 
 typedef struct Lgm_CTrans {
 
     int               Verbose;
 
-    Lgm_LeapSeconds   l;            //!< Structure containing Leap Second Info
+    Lgm_LeapSeconds   l;            //!< Structure containing Leap Second Info (points at a shared, read-only table; see Lgm_LoadLeapSeconds())
 
     Lgm_JPLephemInfo *jpl;          //!< Structure containing JPL Ephem info
     int              jpl_initialized;  //!< Flag to indicate jpl has been initialized
@@ -701,6 +788,8 @@ typedef struct Lgm_CTrans {
 
     int         ephModel;           /**< Model to use for Sun and Moon positions */
     int         pnModel;            /**< Precession-nutation model */
+    int         UseEphemCache;      /**< If TRUE, take Sun/Moon positions from the shared per-day fits (see Lgm_Set_CTrans_EphemCache()) */
+    Lgm_EphemCache EphemCache;      /**< This structure's copy of the fit for the current day */
 
     /*
      *  The following are various important parameters derived from
@@ -728,6 +817,7 @@ typedef struct Lgm_CTrans {
      * Some things for nutation reduction
      */
     int         nNutationTerms; /**< number of terms to usek in the dPsi/dEps Nutation series. */
+    Lgm_NutationCache NutationCache; /**< per-day fit of the series used when pnModel is LGM_PN_IAU76_CACHED */
     double      dPsi;
     double      dEps;
     double      dPsiCosEps;
@@ -780,6 +870,9 @@ typedef struct Lgm_CTrans {
      */
     int         Lgm_IGRF_FirstCall;
     double      Lgm_IGRF_OldYear;
+    double      Lgm_IGRF_CacheTol;      // Tolerance (in years) used to key the IGRF coefficient cache. <= 0 means no caching.
+    double      Lgm_IGRF_TruncTol;      // Allowed error (in nT) when truncating the IGRF sums by radius. <= 0 means always sum to full degree.
+    double      Lgm_IGRF_Spectrum[14];  // Per-degree amplitudes (in nT at r = IGRF_Re) used to pick the truncation degree.
     double      Lgm_IGRF_g[14][14];
     double      Lgm_IGRF_h[14][14];
     double      Lgm_IGRF_R[14][14];
@@ -791,14 +884,83 @@ typedef struct Lgm_CTrans {
     double      Lgm_IGRF_SqrtNM2[14][14];
 
 
+    /*
+     *  Tiered update of the slowly varying quantities (nutation, IGRF dipole
+     *  and Moon). See Lgm_Set_CTrans_SlowTierCadence().
+     */
+    double                  SlowTierCadence;            // Refresh cadence in seconds. <= 0 means evaluate everything on every call.
+    int                     SlowTier_nNodes;            // Number of valid nodes in SlowTier[] (0 or 2).
+    double                  SlowTier_k;                 // Index of node 0 on the refresh grid (JD*86400/SlowTierCadence).
+    int                     SlowTier_nNutationTerms;    // Settings the nodes were computed with.
+    int                     SlowTier_ephModel;
+    Lgm_CTrans_SlowTierNode SlowTier[2];                // Nodes bracketing the current time.
+
+
 
 } Lgm_CTrans;
 
 
+
+/*
+ *  Transform timeline. See Lgm_CTransTimeline_Create().
+ */
+#define LGM_CTRANS_TIMELINE_SLERP       0   // Spherical linear interpolation between nodes
+#define LGM_CTRANS_TIMELINE_SQUAD       1   // Spherical spline (SQUAD) interpolation between nodes
+
+#define LGM_CTL_GEI_TO_MOD              0   // Indices of the rotations kept (as quaternions) at each node
+#define LGM_CTL_MOD_TO_TOD              1
+#define LGM_CTL_PEF_TO_WGS84            2
+#define LGM_CTL_MOD_TO_GSE              3
+#define LGM_CTL_GEI_TO_GSE2000          4
+#define LGM_CTL_NQUAT                   5
+
+typedef struct Lgm_CTransTimelineNode {
+
+    double      JD;                         //!< UTC Julian Date of the node
+    double      Q[LGM_CTL_NQUAT][4];        //!< Quaternions of the rotations (indexed by LGM_CTL_*)
+    double      S[LGM_CTL_NQUAT][4];        //!< SQUAD auxiliary points for the quaternions
+    double      W[LGM_CTL_NQUAT][3];        //!< log( Q^-1 Q_next ), so that slerp to the next node is Q exp( h W )
+    double      WS[LGM_CTL_NQUAT][3];       //!< log( S^-1 S_next )
+
+    double      EQ_Eq;                      //!< Equation of the equinoxes (arcsec)
+    double      dPsi, dEps;                 //!< Nutation (arcsec, with the EOP corrections)
+    double      epsilon, epsilon_true;      //!< Mean and true obliquity of the ecliptic (arcsec)
+    double      OmegaMoon;                  //!< Ascending node of Moon (deg.)
+    double      Zeta, Zee, Theta;           //!< Precession angles (deg.)
+    double      eccentricity;               //!< Eccentricity of Earth-Sun orbit
+    double      mean_anomaly, true_anomaly; //!< Anomalies of Earth-Sun orbit (radians)
+    double      lambda_sun, beta_sun;       //!< Ecliptic long. and lat. of Sun (radians)
+    double      earth_sun_dist;             //!< Earth-Sun distance (Re)
+
+    Lgm_Vector  D;                          //!< Centered dipole axis (unit vector in WGS84)
+    double      M_cd;                       //!< Centered dipole moment (nT Re^3)
+    Lgm_Vector  ED;                         //!< Eccentric dipole offset (Re)
+
+    Lgm_Vector  Moon;                       //!< Direction of Moon in MOD (unit vector)
+    Lgm_Vector  MoonJ2000;                  //!< Direction of Moon in GEI2000 (unit vector)
+    double      EarthMoonDistance;          //!< Distance between the Earth and Moon (Re)
+    double      MoonPhase;                  //!< The Phase of the Moon
+
+} Lgm_CTransTimelineNode;
+
+typedef struct Lgm_CTransTimeline {
+
+    long int                n;              //!< Number of nodes
+    double                  JD0;            //!< UTC Julian Date of node 0
+    double                  dJD;            //!< Node spacing (days)
+    int                     Method;         //!< LGM_CTRANS_TIMELINE_SLERP or LGM_CTRANS_TIMELINE_SQUAD
+    double                  M_cd_McIllwain; //!< Constant dipole moments (copied into Lgm_CTrans)
+    double                  M_cd_2010;
+    Lgm_CTransTimelineNode *Node;           //!< The nodes
+
+} Lgm_CTransTimeline;
+
+
 void        Lgm_free_ctrans( Lgm_CTrans *c );
 void        Lgm_free_ctrans_children( Lgm_CTrans *c );
 Lgm_CTrans  *Lgm_init_ctrans( int );
 Lgm_CTrans  *Lgm_CopyCTrans( Lgm_CTrans *s );
+void        Lgm_CopyCTransInto( Lgm_CTrans *t, Lgm_CTrans *s );
 void        Lgm_ctransDefaults(Lgm_CTrans *, int);
 
 
@@ -824,10 +986,21 @@ double      Lgm_hour24( double );
 double      Lgm_kepler( double, double );
 double      Lgm_Dipole_Tilt(long int date, double UTC);
 void        Lgm_Set_CTrans_Options( int ephModel, int pnModel, Lgm_CTrans *c );
+void        Lgm_Set_CTrans_SlowTierCadence( double Cadence, Lgm_CTrans *c );
+void        Lgm_Set_CTrans_EphemCache( int Flag, Lgm_CTrans *c );
+void        Lgm_Set_CTrans_Tier( int Tier, Lgm_CTrans *c );
+void        Lgm_Set_CTrans_Times( long int date, double UTC, Lgm_CTrans *c );
 void        Lgm_Set_Coord_Transforms( long int, double, Lgm_CTrans * );
 void        Lgm_ComputeSun( Lgm_CTrans *c );
 void        Lgm_ComputeMoon( Lgm_CTrans *c );
 void        Lgm_Convert_Coords(Lgm_Vector *, Lgm_Vector *, int, Lgm_CTrans * );
+void        Lgm_Convert_Coords_Matrix( int flag, double A[3][3], Lgm_Vector *b, Lgm_CTrans *c );
+void        Lgm_Convert_Coords_Array( long int n, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c );
+void        Lgm_Convert_Coords_SoA( long int n, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo, int flag, Lgm_CTrans *c );
+void        Lgm_Convert_Coords_TimeSeries( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c );
+Lgm_CTransTimeline *Lgm_CTransTimeline_Create( long int StartDate, double StartUTC, long int EndDate, double EndUTC, double Spacing, int Method, Lgm_CTrans *c );
+void        Lgm_CTransTimeline_Free( Lgm_CTransTimeline *tl );
+int         Lgm_Set_Coord_Transforms_FromTimeline( long int Date, double UTC, Lgm_CTransTimeline *tl, Lgm_CTrans *c );
 int         Lgm_IsValidDate( long int );
 int         Lgm_Doy( long int, int *, int *, int *, int * );
 void        Lgm_UT_to_hmsms( double UT, int *HH, int *MM, int *SS, int *MilliSec );
@@ -852,8 +1025,19 @@ void        Lgm_R_MLAT_MLT_to_EDMAG( double R, double MLAT, double MLT, Lgm_Vect
 void        Lgm_WGS84_to_GEOD( Lgm_Vector *uin, double *GeodLat, double *GeodLong, double *GeodHieght );
 void        Lgm_WGS84_to_GeodHeight( Lgm_Vector *uin, double *GeodHieght );
 void        Lgm_GEOD_to_WGS84( double GeodLat, double GeodLong, double GeodHieght, Lgm_Vector *v );
+void        Lgm_WGS84_to_GEOD_Array( long int n, double *x, double *y, double *z, double *GeodLat, double *GeodLong, double *GeodHeight );
+void        Lgm_WGS84_to_GeodHeight_Array( long int n, double *x, double *y, double *z, double *GeodHeight );
+void        Lgm_GEOD_to_WGS84_Array( long int n, double *GeodLat, double *GeodLong, double *GeodHeight, double *x, double *y, double *z );
 void        Lgm_Nutation( double T_TT, double nTerms, double *dPSi, double *dEps );
+double      Lgm_Nutation_TruncationError( int nTerms );
+void        Lgm_Nutation_Cached( double T_TT, int nTerms, Lgm_NutationCache *nc, double *dPsi, double *dEps );
+int         Lgm_EphemCache_SunPosition( double JD_TT, Lgm_EphemCache *ec, double *l, double *r, double *b );
+int         Lgm_EphemCache_JPL( double JD_TT, Lgm_JPLephemInfo *jpl, Lgm_EphemCache *ec, Lgm_Vector *Sun, Lgm_Vector *Moon );
+void        Lgm_EphemCache_Clear( );
+void        Lgm_EphemCache_Stats( long int *nHits, long int *nMisses );
 int         IsoTimeStringToDateTime( char *TimeString, Lgm_DateTime *d, Lgm_CTrans *c );
+long int    Lgm_IsoTimeStringsToDateTimes( long int n, char **TimeStrings, Lgm_DateTime *d, Lgm_CTrans *c );
+long int    Lgm_IsoTimeStringsToTaiSeconds( long int n, char **TimeStrings, double *TaiSeconds, Lgm_CTrans *c );
 int         MonthStrToNum( char *str );
 char       *Lgm_StrToLower( char *str, int nmax );
 char       *Lgm_StrToUpper( char *str, int nmax );
@@ -865,6 +1049,7 @@ Lgm_DateTime *Lgm_DateTime_Create( int Year, int Month, int Day, double Time, in
 void          Lgm_DateTime_Destroy( Lgm_DateTime *d );
 int           Lgm_Make_UTC( long int Date, double Time, Lgm_DateTime *UTC, Lgm_CTrans *c );
 int           Lgm_LoadLeapSeconds( Lgm_CTrans *c );
+void          Lgm_ReleaseLeapSeconds( Lgm_CTrans *c );
 double        Lgm_GetLeapSeconds( double JD, Lgm_CTrans *c );
 int           Lgm_IsLeapSecondDay( long int Date, double *SecondsInDay, Lgm_CTrans *c );
 void          Lgm_UTC_to_TAI( Lgm_DateTime *UTC, Lgm_DateTime *TAI, Lgm_CTrans *c );
@@ -881,6 +1066,8 @@ void          Lgm_UTC_to_GPS( Lgm_DateTime *UTC, Lgm_DateTime *GPS, Lgm_CTrans *
 void          Lgm_GPS_to_UTC( Lgm_DateTime *GPS, Lgm_DateTime *UTC, Lgm_CTrans *c );
 void          Lgm_Print_DateTime( Lgm_DateTime *DT, int Style, int p );
 void          Lgm_DateTimeToString( char *Str, Lgm_DateTime *DT, int Style, int p );
+char         *Lgm_IsoTimeFormatter_Put( Lgm_IsoTimeFormatter *f, Lgm_DateTime *DT, int p );
+int           Lgm_DateTimeToIsoString( char *Str, Lgm_DateTime *DT, int p );
 void          Lgm_Print_SimpleTime( Lgm_DateTime *DT, int p, char * );
 //int         Lgm_DayofWeek( int, int, int, char *, Lgm_CTrans *c );
 int           Lgm_DayOfWeek( int Year, int Month, int Day, char *dowstr );
@@ -907,6 +1094,8 @@ void          Lgm_TdbSecSinceJ2000_to_UTC( double TdbSeconds, Lgm_DateTime *UTC,
 double        Lgm_UTC_to_TdbSecSinceJ2000( Lgm_DateTime *UTC, Lgm_CTrans *c );
 
 
+int           Lgm_ConvertTimeSeconds( long int n, const double *In, int InSys, double *Out, int OutSys, Lgm_CTrans *c );
+
 double        TAISecondsSinceJ2000( double UTCDaysSinceJ2000, Lgm_CTrans *c );
 double        UTCDaysSinceJ2000( double TAI, Lgm_CTrans *c );
 
@@ -953,8 +1142,15 @@ void    Lgm_B_JensenCain1960_ctrans(Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c)
 /*
  *  IGRF prototypes
  */
+#define LGM_IGRF_VLEN   8   // number of points per SIMD block in Lgm_IGRF_Multi()
+
 double  Lgm_Factorial( int );
 void    Lgm_InitIGRF( double g[14][14], double h[14][14], int N, int Flag, Lgm_CTrans *c );
+void    Lgm_Set_IGRF_CacheTolerance( double dYear, Lgm_CTrans *c );
+void    Lgm_Set_IGRF_Truncation( double Tol, Lgm_CTrans *c );
+int     Lgm_IGRF_TruncDegree( double r, int N, Lgm_CTrans *c );
+void    Lgm_IGRF_ClearCache( );
+void    Lgm_IGRF_CacheStats( long int *nHits, long int *nMisses );
 void    Lgm_InitPnm( double ct, double st, double R[14][14], double P[14][14], double dP[14][14], int N, Lgm_CTrans *c );
 void    Lgm_InitTrigmp( double , double , double *, double *, int );
 void    Lgm_PolFunInt( double *, double *, int, double, double *, double * );
@@ -964,6 +1160,8 @@ void    _Lgm_IGRF( Lgm_Vector *, Lgm_Vector *, Lgm_CTrans * );
 void    _Lgm_IGRF2( Lgm_Vector *, Lgm_Vector *, Lgm_CTrans * );
 void    _Lgm_IGRF3( Lgm_Vector *, Lgm_Vector *, Lgm_CTrans * );
 void    _Lgm_IGRF4( Lgm_Vector *, Lgm_Vector *, Lgm_CTrans * );
+void    Lgm_IGRF_Multi( int n, Lgm_Vector *vin, Lgm_Vector *B, Lgm_CTrans *c );
+int     Lgm_IGRF_Derivs( Lgm_Vector *vin, Lgm_Vector *B, double dB[3][3], Lgm_CTrans *c );
 
 void   Lgm_InitdPnm( double P[14][14], double dP[14][14], int N, Lgm_CTrans *c );
 void   Lgm_InitSqrtFuncs( double SqrtNM1[14][14], double SqrtNM2[14][14], int N );
@@ -0,0 +1,52 @@
+#ifndef LGM_CONJUNCTION_H
+#define LGM_CONJUNCTION_H
+
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_MagModelInfo.h"
+
+/*
+ *  Magnetic conjunctions between spacecraft, and between spacecraft and
+ *  ground stations. See Lgm_Conjunction.c.
+ */
+#define LGM_CONJ_NORTH      1       // Northern footpoints within FootTol
+#define LGM_CONJ_SOUTH      2       // Southern footpoints within FootTol
+#define LGM_CONJ_EQUATOR    3       // Min-B points within EqTol
+
+typedef struct Lgm_Conjunction {
+    long int    Date;               // Epoch of the samples
+    double      UTC;
+    int         Id1;                // Spacecraft Id
+    int         Id2;                // The other spacecraft's Id, or the station's Id (if Station is TRUE)
+    int         Station;            // TRUE if Id2 is a ground station
+    int         Where;              // LGM_CONJ_NORTH, LGM_CONJ_SOUTH or LGM_CONJ_EQUATOR
+    double      Dist;               // Distance between the footpoints (km) or between the min-B points (Re)
+    Lgm_Vector  P1, P2;             // The two footpoints or min-B points (GSM, Re)
+} Lgm_Conjunction;
+
+typedef struct Lgm_ConjunctionFinder {
+    double          Height;         // Footpoint height (km above the WGS84 ellipsoid)
+    double          FootTol;        // Footpoints closer than this (km) are a conjunction
+    double          EqTol;          // Min-B points closer than this (Re) are a conjunction (<= 0 to not look for these)
+    double          TOL1, TOL2;     // Lgm_Trace() tolerances (<= 0 for the Lgm_Trace_AtTimes() defaults)
+
+    int             nStations;      // Ground stations (see Lgm_ConjunctionFinder_AddStation())
+    int             *StationId;
+    double          *StationLat;    // Geodetic latitude and longitude (deg)
+    double          *StationLon;
+
+    long int        nConj;          // Conjunctions found so far (by all calls)
+    long int        nAlloced;
+    Lgm_Conjunction *Conj;
+
+    long int        nTraces;        // Field lines traced
+    long int        nCandidates;    // Neighbours the KdTree searches looked at
+} Lgm_ConjunctionFinder;
+
+
+Lgm_ConjunctionFinder *Lgm_InitConjunctionFinder( double Height, double FootTol, double EqTol );
+void    Lgm_FreeConjunctionFinder( Lgm_ConjunctionFinder *cf );
+void    Lgm_ConjunctionFinder_AddStation( Lgm_ConjunctionFinder *cf, int Id, double GeodLat, double GeodLon );
+void    Lgm_ConjunctionFinder_Clear( Lgm_ConjunctionFinder *cf );
+long int Lgm_FindConjunctions( Lgm_ConjunctionFinder *cf, long int n, long int *Date, double *UTC, int *Id, Lgm_Vector *u, Lgm_MagModelInfo *m );
+
+#endif
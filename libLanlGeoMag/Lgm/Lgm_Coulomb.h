@@ -6,6 +6,7 @@
  * Function prototypes
  */
 double Lgm_MottScattering( double Z, double beta, double Theta );
+void   Lgm_MottScattering_Array( double Z, double beta, int nTheta, double *Theta, double *d_sigma_d_Omega );
 
 
 #endif
@@ -0,0 +1,65 @@
+#ifndef LGM_DRIFT_ENSEMBLE_H
+#define LGM_DRIFT_ENSEMBLE_H
+
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_VelStepInfo.h"
+
+/*
+ *  Guiding-center drift of an ensemble of particles. See
+ *  Lgm_DriftEnsemble.c.
+ *
+ *  Each particle is pushed with Lgm_VelStep() (Bulirsch-Stoer) and keeps its
+ *  own step size and extrapolation order between steps and between calls to
+ *  Lgm_DriftEnsemble_Advance(). Positions are GSM [Re], times are [s].
+ */
+#define LGM_DRIFT_ACTIVE        0   // Still being followed
+#define LGM_DRIFT_LOST_INNER    1   // Went inside RInner
+#define LGM_DRIFT_LOST_OUTER    2   // Went outside ROuter
+#define LGM_DRIFT_FAILED        3   // Lgm_VelStep() (or the velocity) failed
+
+
+typedef struct Lgm_DriftEnsemble {
+
+    long int    n;              // Number of particles
+
+    Lgm_Vector  *u;             // Positions (GSM) [Re]
+    double      *t;             // Time each particle has been followed to [s]
+    double      *T;             // Kinetic energies [MeV]
+    double      *Bm;            // Mirror point field strengths [nT]
+    int         *Status;        // LGM_DRIFT_ACTIVE, LGM_DRIFT_LOST_INNER, etc.
+
+    double      *h;             // Next step to try [s] (negative before the first step)
+    double      *s;             // Lgm_VelStep() running step sum
+    int         *kopt;          // Lgm_VelStep() optimal tableau row
+
+    double      q;              // Charge [C]
+    double      E0;             // Rest energy [MeV]
+
+    double      Tol;            // Absolute error allowed per step [Re]
+    double      h0;             // First step to try [s]
+    double      hMax;           // Largest step allowed [s]
+    double      RInner;         // A particle is lost if it goes inside this radius [Re]
+    double      ROuter;         // or outside this one [Re]
+
+    int         DerivScheme;    // Used if the field model has no Jacobian of its own (see Lgm_B_Jacobian())
+    double      DerivH;         // Grid spacing for DerivScheme [Re]
+
+    /*
+     *  Guiding-center velocity [Re/s] at u, with the particle's T and Bm in
+     *  m->Lgm_VelStep_T and m->Lgm_VelStep_Bm (and q, E0, DerivScheme and
+     *  DerivH in m->Lgm_VelStep_q, etc.). Lgm_GradAndCurvDriftVel() by
+     *  default.
+     */
+    int         (*Velocity)( Lgm_Vector *u, Lgm_Vector *v, Lgm_MagModelInfo *m );
+
+    long int    nVelEvals;      // Velocity evaluations so far
+
+} Lgm_DriftEnsemble;
+
+
+Lgm_DriftEnsemble  *Lgm_DriftEnsemble_Create( long int n, double q, double E0 );
+void                Lgm_DriftEnsemble_Free( Lgm_DriftEnsemble *e );
+int                 Lgm_DriftEnsemble_Init( Lgm_DriftEnsemble *e, Lgm_Vector *u, double *T, double *Alpha, Lgm_MagModelInfo *m );
+long int            Lgm_DriftEnsemble_Advance( Lgm_DriftEnsemble *e, double tEnd, Lgm_MagModelInfo *m );
+
+#endif
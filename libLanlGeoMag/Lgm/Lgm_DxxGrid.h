@@ -0,0 +1,102 @@
+#ifndef LGM_DXXGRID_H
+#define LGM_DXXGRID_H
+
+#include <stdint.h>
+#include "Lgm/Lgm_SummersDiffCoeff.h"
+
+/*
+ *  Tables of bounce-averaged diffusion coefficients, Daa, Dap and Dpp, on an
+ *  (L, Ek, Alpha0) grid. See Lgm_DxxGrid.c.
+ *
+ *  The table can be saved to (and picked back up from) a file. The file is
+ *
+ *      Lgm_DxxGridHeader                   (including the Lgm_DxxWaveModel)
+ *      double Alpha0[ nAlpha ]
+ *      double Ek[ nE ]
+ *      double L[ nL ]
+ *      double aStarEq[ nL ]
+ *      double Nw[ nNw*nPlasmaParameters ]  (only for LGM_GLAUERT_AND_HORNE_HIGH_FREQ)
+ *      double Daa[ nL ][ nE ][ nAlpha ]
+ *      double Dap[ nL ][ nE ][ nAlpha ]
+ *      double Dpp[ nL ][ nE ][ nAlpha ]
+ *
+ *  in native byte order. A file is only used if its wave model and grid are
+ *  exactly the ones asked for.
+ */
+#define LGM_DXXGRID_MAGIC       "LGMDXX01"
+#define LGM_DXXGRID_VERSION     1
+#define LGM_DXXGRID_MAX_WNA     4       // Most wave normal angle distributions (Glauert and Horne)
+#define LGM_DXXGRID_NBW         32      // Number of samples of BwFunc() kept in the wave model
+
+
+/*
+ *  The wave model. Frequencies are given as fractions of the equatorial
+ *  electron gyro-frequency, |Omega_e|/2pi, so that one model applies at all
+ *  L. Bw[] is filled in by Lgm_DxxGrid_Create() (it is BwFunc() at
+ *  LGM_DXXGRID_NBW latitudes from 0 to MaxWaveLat) so that the file key
+ *  depends on the wave amplitudes too.
+ */
+typedef struct Lgm_DxxWaveModel {
+    int32_t     Version;            // LGM_SUMMERS_2005, LGM_SUMMERS_2007 or LGM_GLAUERT_AND_HORNE_HIGH_FREQ
+    int32_t     WaveMode;           // LGM_R_MODE_WAVE or LGM_L_MODE_WAVE
+    int32_t     Species;            // LGM_ELECTRONS or LGM_PROTONS
+    int32_t     Directions;         // LGM_FRWD, LGM_BKWD or LGM_FRWD_BKWD
+    double      n1, n2, n3;         // H+, He+ and O+ fractions (LGM_SUMMERS_2007)
+    double      w1, w2, wm, dw;     // Lower and upper cutoffs, frequency of max power and width (fractions of the equatorial gyro-frequency)
+    double      MaxWaveLat;         // Waves exist up to +/- this latitude [Degrees]
+
+    // Glauert and Horne only.
+    int32_t     nWna;               // Number of wave normal angle distributions
+    int32_t     nNw;                // Number of normalized frequencies in N(w)
+    int32_t     nPlasmaParameters;  // Number of aStar values in N(w)
+    int32_t     Pad;
+    double      x1, x2;             // Cutoffs in tan(wave normal angle)
+    double      xm[LGM_DXXGRID_MAX_WNA], dx[LGM_DXXGRID_MAX_WNA], Weights[LGM_DXXGRID_MAX_WNA];
+    double      aStarMin, aStarMax; // Range of aStar that N(w) is computed over
+
+    double      Bw[LGM_DXXGRID_NBW];
+} Lgm_DxxWaveModel;
+
+typedef struct Lgm_DxxGridHeader {
+    char                Magic[8];   // LGM_DXXGRID_MAGIC (not nul terminated)
+    uint32_t            Version;    // LGM_DXXGRID_VERSION
+    int32_t             nAlpha, nE, nL;
+    Lgm_DxxWaveModel    Wave;
+} Lgm_DxxGridHeader;
+
+
+typedef struct Lgm_DxxGrid {
+
+    Lgm_DxxWaveModel    Wave;
+
+    void                *BwFuncData;    // Passed to BwFunc()
+    double              (*BwFunc)( double, void * );   // Wave amplitude [nT] versus latitude [radians]
+
+    int                 nAlpha;
+    double              *Alpha0;        // Equatorial pitch angles [Degrees]
+    int                 nE;
+    double              *Ek;            // Kinetic energies [MeV]
+    int                 nL;
+    double              *L;             // Dipole L-shells
+    double              *aStarEq;       // Equatorial aStar at each L
+
+    double              *Nw;            // Wave normal angle normalization N(w) (Glauert and Horne only)
+
+    double              ***Daa;         // Daa[iL][iE][iAlpha]
+    double              ***Dap;
+    double              ***Dpp;
+
+    double              ***dDaa;        // dDaa/dAlpha0 and dDap/dAlpha0 (per Degree). NULL until Lgm_DxxGrid_Derivs() is called.
+    double              ***dDap;
+
+} Lgm_DxxGrid;
+
+
+Lgm_DxxGrid *Lgm_DxxGrid_Create( Lgm_DxxWaveModel *Wave, double (*BwFunc)( double, void * ), void *BwFuncData, int nAlpha, double *Alpha0, int nE, double *Ek, int nL, double *L, double *aStarEq );
+int          Lgm_DxxGrid_Compute( Lgm_DxxGrid *g, char *Filename );
+int          Lgm_DxxGrid_Write( Lgm_DxxGrid *g, char *Filename );
+int          Lgm_DxxGrid_Read( Lgm_DxxGrid *g, char *Filename );
+int          Lgm_DxxGrid_Derivs( Lgm_DxxGrid *g );
+void         Lgm_DxxGrid_Free( Lgm_DxxGrid *g );
+
+#endif
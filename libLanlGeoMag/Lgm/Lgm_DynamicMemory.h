@@ -107,6 +107,26 @@
  *                  LGM_ARRAY_FROM_DATA_2D( A, pdata, n1, n2, double );
  *              
  *
+ *      4) Versions of the allocating macros that take everything (data and
+ *         pointer tables) from an Lgm_Arena (see Lgm_Arena.h) instead of
+ *         calloc'ing it. The memory is zeroed as with calloc. Arrays made this
+ *         way must NOT be given to the FREE macros -- they all go away
+ *         together with Lgm_FreeArena( arena ).
+ *
+ *              LGM_ARRAY_1D_ARENA( A, n1, type, arena );
+ *              LGM_ARRAY_2D_ARENA( A, n1, n2, type, arena );
+ *              LGM_ARRAY_3D_ARENA( A, n1, n2, n3, type, arena );
+ *              LGM_ARRAY_4D_ARENA( A, n1, n2, n3, n4, type, arena );
+ *              LGM_ARRAY_5D_ARENA( A, n1, n2, n3, n4, n5, type, arena );
+ *
+ *          A typical use would be:
+ *
+ *              Lgm_Arena *arena = Lgm_CreateArena( 0 );
+ *              LGM_ARRAY_1D_ARENA( x, n, double, arena );
+ *              LGM_ARRAY_2D_ARENA( A, n1, n2, double, arena );
+ *                  ... do stuff ...
+ *              Lgm_FreeArena( arena );    // frees x and A
+ *
  */
 
 
@@ -115,6 +135,7 @@
 #if !defined(__APPLE__)
 #include <malloc.h>
 #endif
+#include "Lgm/Lgm_Arena.h"
 
 /*
  * Macros for dynamically allocating/freeing 1D arrays of any type
@@ -332,6 +353,116 @@
 
 
 
+/*
+ * Arena versions of the allocating macros. Everything comes from the arena
+ * and is freed along with it (dont use the FREE macros on these).
+ */
+#define LGM_ARENA_GET( p, n, type, arena, name, what ) {\
+    p = (type *)Lgm_Arena_Calloc( (arena), (size_t)(n), sizeof( type ) );\
+    if ( p == (type *)NULL ) {\
+        fprintf(stderr, name " Macro: Could not allocate space for " what "\n");\
+        exit(1);\
+    }\
+}\
+
+#define LGM_ARRAY_1D_ARENA( prow, col, type, arena ) {\
+    type *pdata;\
+    if ( col < 1 ) { fprintf( stderr, "LGM_ARRAY_1D_ARENA Macro: Trying to allocate less than one element (col = %d)\n", (int)(col) ); exit(1); }\
+    LGM_ARENA_GET( pdata, (col), type, arena, "LGM_ARRAY_1D_ARENA", "data" );\
+    prow = pdata;\
+}\
+
+#define LGM_ARRAY_2D_ARENA( prow, row, col, type, arena ) {\
+    type *pdata;\
+    long int mi;\
+    if ( row < 1 ) { fprintf( stderr, "LGM_ARRAY_2D_ARENA Macro: Trying to allocate less than one element (row = %d)\n", (int)(row) ); exit(1); }\
+    if ( col < 1 ) { fprintf( stderr, "LGM_ARRAY_2D_ARENA Macro: Trying to allocate less than one element (col = %d)\n", (int)(col) ); exit(1); }\
+    LGM_ARENA_GET( pdata, (row)*(col), type, arena, "LGM_ARRAY_2D_ARENA", "data" );\
+    LGM_ARENA_GET( prow, (row), type *, arena, "LGM_ARRAY_2D_ARENA", "row pointers" );\
+    for (mi=0; mi<(row); mi++){\
+        prow[mi] = pdata;\
+        pdata += (col);\
+    }\
+}\
+
+#define LGM_ARRAY_3D_ARENA( pgrid, grid, row, col, type, arena ) {\
+    type **prow, *pdata;\
+    long int mi;\
+    if ( row < 1 )  { fprintf( stderr, "LGM_ARRAY_3D_ARENA Macro: Trying to allocate less than one element (row = %d)\n", (int)(row) ); exit(1); }\
+    if ( col < 1 )  { fprintf( stderr, "LGM_ARRAY_3D_ARENA Macro: Trying to allocate less than one element (col = %d)\n", (int)(col) ); exit(1); }\
+    if ( grid < 1 ) { fprintf( stderr, "LGM_ARRAY_3D_ARENA Macro: Trying to allocate less than one element (grid = %d)\n", (int)(grid) ); exit(1); }\
+    LGM_ARENA_GET( pdata, (grid)*(row)*(col), type, arena, "LGM_ARRAY_3D_ARENA", "data" );\
+    LGM_ARENA_GET( prow, (grid)*(row), type *, arena, "LGM_ARRAY_3D_ARENA", "row pointers" );\
+    LGM_ARENA_GET( pgrid, (grid), type **, arena, "LGM_ARRAY_3D_ARENA", "grid pointers" );\
+    for (mi=0; mi<(grid)*(row); mi++){\
+        prow[mi] = pdata;\
+        pdata += (col);\
+    }\
+    for (mi=0; mi<(grid); mi++){\
+        pgrid[mi] = prow;\
+        prow += (row);\
+    }\
+}\
+
+#define LGM_ARRAY_4D_ARENA( pn4, n4, n3, n2, n1, type, arena ) {\
+    type ***pn3, **pn2, *pdata;\
+    long int mi;\
+    if ( n1 < 1 )  { fprintf( stderr, "LGM_ARRAY_4D_ARENA Macro: Trying to allocate less than one element (n1 = %d)\n", (int)(n1) ); exit(1); }\
+    if ( n2 < 1 )  { fprintf( stderr, "LGM_ARRAY_4D_ARENA Macro: Trying to allocate less than one element (n2 = %d)\n", (int)(n2) ); exit(1); }\
+    if ( n3 < 1 )  { fprintf( stderr, "LGM_ARRAY_4D_ARENA Macro: Trying to allocate less than one element (n3 = %d)\n", (int)(n3) ); exit(1); }\
+    if ( n4 < 1 )  { fprintf( stderr, "LGM_ARRAY_4D_ARENA Macro: Trying to allocate less than one element (n4 = %d)\n", (int)(n4) ); exit(1); }\
+    LGM_ARENA_GET( pdata, (n4)*(n3)*(n2)*(n1), type, arena, "LGM_ARRAY_4D_ARENA", "data" );\
+    LGM_ARENA_GET( pn2, (n4)*(n3)*(n2), type *, arena, "LGM_ARRAY_4D_ARENA", "n2 pointers" );\
+    LGM_ARENA_GET( pn3, (n4)*(n3), type **, arena, "LGM_ARRAY_4D_ARENA", "n3 pointers" );\
+    LGM_ARENA_GET( pn4, (n4), type ***, arena, "LGM_ARRAY_4D_ARENA", "n4 pointers" );\
+    for (mi=0; mi<(n4)*(n3)*(n2); mi++){\
+        pn2[mi] = pdata;\
+        pdata += (n1);\
+    }\
+    for (mi=0; mi<(n4)*(n3); mi++){\
+        pn3[mi] = pn2;\
+        pn2 += (n2);\
+    }\
+    for (mi=0; mi<(n4); mi++){\
+        pn4[mi] = pn3;\
+        pn3 += (n3);\
+    }\
+}\
+
+#define LGM_ARRAY_5D_ARENA( pn5, n5, n4, n3, n2, n1, type, arena ) {\
+    type ****pn4, ***pn3, **pn2, *pdata;\
+    long int mi;\
+    if ( n1 < 1 )  { fprintf( stderr, "LGM_ARRAY_5D_ARENA Macro: Trying to allocate less than one element (n1 = %d)\n", (int)(n1) ); exit(1); }\
+    if ( n2 < 1 )  { fprintf( stderr, "LGM_ARRAY_5D_ARENA Macro: Trying to allocate less than one element (n2 = %d)\n", (int)(n2) ); exit(1); }\
+    if ( n3 < 1 )  { fprintf( stderr, "LGM_ARRAY_5D_ARENA Macro: Trying to allocate less than one element (n3 = %d)\n", (int)(n3) ); exit(1); }\
+    if ( n4 < 1 )  { fprintf( stderr, "LGM_ARRAY_5D_ARENA Macro: Trying to allocate less than one element (n4 = %d)\n", (int)(n4) ); exit(1); }\
+    if ( n5 < 1 )  { fprintf( stderr, "LGM_ARRAY_5D_ARENA Macro: Trying to allocate less than one element (n5 = %d)\n", (int)(n5) ); exit(1); }\
+    LGM_ARENA_GET( pdata, (n5)*(n4)*(n3)*(n2)*(n1), type, arena, "LGM_ARRAY_5D_ARENA", "data" );\
+    LGM_ARENA_GET( pn2, (n5)*(n4)*(n3)*(n2), type *, arena, "LGM_ARRAY_5D_ARENA", "n2 pointers" );\
+    LGM_ARENA_GET( pn3, (n5)*(n4)*(n3), type **, arena, "LGM_ARRAY_5D_ARENA", "n3 pointers" );\
+    LGM_ARENA_GET( pn4, (n5)*(n4), type ***, arena, "LGM_ARRAY_5D_ARENA", "n4 pointers" );\
+    LGM_ARENA_GET( pn5, (n5), type ****, arena, "LGM_ARRAY_5D_ARENA", "n5 pointers" );\
+    for (mi=0; mi<(n5)*(n4)*(n3)*(n2); mi++){\
+        pn2[mi] = pdata;\
+        pdata += (n1);\
+    }\
+    for (mi=0; mi<(n5)*(n4)*(n3); mi++){\
+        pn3[mi] = pn2;\
+        pn2 += (n2);\
+    }\
+    for (mi=0; mi<(n5)*(n4); mi++){\
+        pn4[mi] = pn3;\
+        pn3 += (n3);\
+    }\
+    for (mi=0; mi<(n5); mi++){\
+        pn5[mi] = pn4;\
+        pn4 += (n4);\
+    }\
+}\
+
+
+
+
 
 /*
  *   More macros for dynamically allocating/freeing 1D arrays of any type.
@@ -594,6 +725,17 @@
 }\
 
 
+/*
+ * Number of bytes taken by arrays made with the allocating macros above (the
+ * data block plus the pointer tables). Used by the Lgm_*_MemoryUsage()
+ * routines (see Lgm_MemoryUsage.c).
+ */
+#define LGM_ARRAY_1D_BYTES( n1, type )              ( (size_t)(n1)*sizeof( type ) )
+#define LGM_ARRAY_2D_BYTES( n1, n2, type )          ( (size_t)(n1)*(n2)*sizeof( type ) + (size_t)(n1)*sizeof( type * ) )
+#define LGM_ARRAY_3D_BYTES( n1, n2, n3, type )      ( (size_t)(n1)*(n2)*(n3)*sizeof( type ) + ( (size_t)(n1)*(n2) + (n1) )*sizeof( type * ) )
+#define LGM_ARRAY_4D_BYTES( n1, n2, n3, n4, type )  ( (size_t)(n1)*(n2)*(n3)*(n4)*sizeof( type ) + ( (size_t)(n1)*(n2)*(n3) + (size_t)(n1)*(n2) + (n1) )*sizeof( type * ) )
+
+
 
 #endif
 
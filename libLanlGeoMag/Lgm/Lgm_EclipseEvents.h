@@ -0,0 +1,46 @@
+#ifndef LGM_ECLIPSE_EVENTS_H
+#define LGM_ECLIPSE_EVENTS_H
+
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_Vec.h"
+#include "Lgm/Lgm_Sgp.h"
+
+/*
+ *  Earth shadow entry and exit times along a trajectory. See
+ *  Lgm_EclipseEvents.c.
+ *
+ *  The trajectory is given as a function that returns the position (in Re)
+ *  at a Julian Date (UTC), in some quasi-inertial system (MOD_COORDS,
+ *  TOD_COORDS, TEME_COORDS or GEI2000_COORDS). It returns FALSE if there is
+ *  no position at that time. Two are provided; Lgm_EclipseOrbit_Sgp4() (Data
+ *  is a Lgm_EclipseSgp4, positions are TEME) and Lgm_EclipseOrbit_Table()
+ *  (Data is a Lgm_EclipseTable).
+ */
+typedef int (*Lgm_EclipseOrbitFunc)( double JD, Lgm_Vector *u, void *Data );
+
+typedef struct Lgm_EclipseSgp4 {
+    _SgpInfo    *s;         // Set up with LgmSgp_SGP4_Init( s, t )
+    _SgpTLE     *t;
+} Lgm_EclipseSgp4;
+
+typedef struct Lgm_EclipseTable {
+    int         n;          // Number of samples (at least 4)
+    double      *JD;        // Julian Dates (UTC), increasing
+    Lgm_Vector  *u;         // Positions [Re]
+    int         i;          // Last interval used (start it at 0)
+} Lgm_EclipseTable;
+
+
+typedef struct Lgm_EclipseEvent {
+    double      JD;         // Julian Date (UTC) of the transition
+    int         Type;       // LGM_PENUMBRAL_ECLIPSE (penumbra boundary) or LGM_UMBRAL_ECLIPSE (umbra boundary)
+    int         Entry;      // TRUE going into the shadow, FALSE coming out
+} Lgm_EclipseEvent;
+
+
+int Lgm_EclipseOrbit_Sgp4( double JD, Lgm_Vector *u, void *Data );
+int Lgm_EclipseOrbit_Table( double JD, Lgm_Vector *u, void *Data );
+int Lgm_EarthEclipse_Events( double JD0, double JD1, double Step, double Tol, int Coords, Lgm_EclipseOrbitFunc Pos, void *Data,
+                             int nMax, Lgm_EclipseEvent *Events, Lgm_CTrans *c );
+
+#endif
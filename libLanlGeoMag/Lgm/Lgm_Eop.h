@@ -65,6 +65,8 @@ typedef struct Lgm_EopOne {
 Lgm_Eop *Lgm_init_eop( int Verbose );
 void    Lgm_destroy_eop( Lgm_Eop *e );
 void    Lgm_read_eop( Lgm_Eop *e );
+Lgm_Eop *Lgm_get_shared_eop( void );
+void    Lgm_release_shared_eop( Lgm_Eop *e );
 void    Lgm_NgaEoppPred( double JD, Lgm_EopOne *eop, Lgm_NgaEopp *e );
 int     Lgm_ReadNgaEopp( Lgm_NgaEopp *e, int Verbosity );
 void    Lgm_get_eop_at_JD( double JD, Lgm_EopOne *eop, Lgm_Eop *e );
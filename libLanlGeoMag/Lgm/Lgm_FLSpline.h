@@ -0,0 +1,109 @@
+#ifndef LGM_FLSPLINE_H
+#define LGM_FLSPLINE_H
+
+#include <stddef.h>
+
+/*
+ *  Interpolants for a traced field line. All of the curves share the same
+ *  abscissae (the distance along the FL, s), so one interval lookup does for
+ *  all of them. The coefficients are kept curve by curve (y[k][], b[k][],
+ *  ...) in one block of memory. See Lgm_FLSpline.c.
+ *
+ *  The results are the same as gsl's linear and akima (non-periodic)
+ *  interpolants, to the last bit.
+ */
+#define LGM_FLSPLINE_LINEAR     0
+#define LGM_FLSPLINE_AKIMA      1
+
+#define LGM_FLSPLINE_NY         4       // number of curves (BminusBcdip, Px, Py, Pz)
+
+typedef struct Lgm_FLSpline {
+    int     Type;                       // LGM_FLSPLINE_LINEAR or LGM_FLSPLINE_AKIMA
+    int     n;                          // number of points
+    int     nAlloc;                     // the arrays below can hold this many points
+    size_t  nWork;                      // size of Work [doubles]
+    double  *Work;                      // the one block that all the arrays live in
+
+    double  *x;                         // abscissae (a copy)
+    double  *y[LGM_FLSPLINE_NY];        // ordinates (copies)
+    double  *b[LGM_FLSPLINE_NY];        // Akima coefficients. y(x) = y[j] + dx*(b[j] + dx*(c[j] + dx*d[j]))
+    double  *c[LGM_FLSPLINE_NY];        //   (NULL for LGM_FLSPLINE_LINEAR)
+    double  *d[LGM_FLSPLINE_NY];
+
+    int     Uniform;                    // x is evenly spaced (except maybe for the last interval)
+    double  x0, InvDx;                  // x[0] and 1/(x[1]-x[0]), used to guess the interval
+    int     Last;                       // interval found by the last lookup
+} Lgm_FLSpline;
+
+void Lgm_FLSpline_Init( Lgm_FLSpline *f );
+int  Lgm_FLSpline_Set( Lgm_FLSpline *f, int Type, int n, const double *x, const double **y );
+int  Lgm_FLSpline_Copy( Lgm_FLSpline *t, const Lgm_FLSpline *s );
+void Lgm_FLSpline_Free( Lgm_FLSpline *f );
+
+
+
+/*
+ *  Index j of the interval holding xx, i.e. x[j] <= xx < x[j+1] (and the
+ *  last interval for xx = x[n-1]). This is the same interval that
+ *  gsl_interp_accel_find() picks. For evenly spaced points the guess is
+ *  right (or off by one from round-off) and there is no search.
+ */
+static inline int Lgm_FLSpline_Find( Lgm_FLSpline *f, double xx ) {
+
+    int     j, lo, hi, mid, nm2 = f->n-2;
+    double  *x = f->x;
+
+    if ( f->Uniform ) {
+        j = (int)( (xx - f->x0)*f->InvDx );
+        if ( j < 0 ) j = 0; else if ( j > nm2 ) j = nm2;
+    } else {
+        j = f->Last;
+    }
+
+    if ( (j > 0) && (xx < x[j]) ) {
+        if ( (j > 1) && (xx < x[j-1]) ) {
+            lo = 0; hi = j-1;
+            while ( hi > lo+1 ) { mid = (lo+hi)/2; if ( x[mid] > xx ) hi = mid; else lo = mid; }
+            j = lo;
+        } else {
+            --j;
+        }
+    } else if ( (j < nm2) && (xx >= x[j+1]) ) {
+        if ( (j < nm2-1) && (xx >= x[j+2]) ) {
+            lo = j+2; hi = nm2+1;
+            while ( hi > lo+1 ) { mid = (lo+hi)/2; if ( x[mid] > xx ) hi = mid; else lo = mid; }
+            j = lo;
+        } else {
+            ++j;
+        }
+    }
+
+    f->Last = j;
+    return( j );
+
+}
+
+/*
+ *  Value of curve k at xx, which is in interval j (from Lgm_FLSpline_Find()).
+ */
+static inline double Lgm_FLSpline_EvalAt( const Lgm_FLSpline *f, int k, int j, double xx ) {
+
+    double  dx = xx - f->x[j];
+    const double *y = f->y[k];
+
+    if ( f->Type == LGM_FLSPLINE_AKIMA ) {
+        return( y[j] + dx*( f->b[k][j] + dx*( f->c[k][j] + f->d[k][j]*dx ) ) );
+    } else {
+        return( y[j] + dx/( f->x[j+1] - f->x[j] )*( y[j+1] - y[j] ) );
+    }
+
+}
+
+/*
+ *  Value of curve k at xx.
+ */
+static inline double Lgm_FLSpline_Eval( Lgm_FLSpline *f, int k, double xx ) {
+    return( Lgm_FLSpline_EvalAt( f, k, Lgm_FLSpline_Find( f, xx ), xx ) );
+}
+
+#endif
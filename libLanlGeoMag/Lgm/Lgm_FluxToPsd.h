@@ -94,6 +94,12 @@ typedef unsigned char byte; // needed for gif writer
 #define         LGM_F2P_SPLINE                           0
 #define         LGM_F2P_MAXWELLIAN                       1
 
+#define         LGM_F2P_MAX_MAXWELLIANS                  4      //!< Most maxwellians the Levenberg-Marquardt fitter handles (more fall back to praxis).
+
+#define         LGM_F2P_FIT_NONE                         0      //!< FitState: no fit in this bin.
+#define         LGM_F2P_FIT_OLD                          1      //!< FitState: fit to earlier data (only used as a starting guess).
+#define         LGM_F2P_FIT_CURRENT                      2      //!< FitState: fit to the current data.
+
 typedef struct Lgm_FluxToPsd {
 
 
@@ -163,6 +169,18 @@ typedef struct Lgm_FluxToPsd {
     int          UseModelB;          //!< If true, use b-field model to compute |B| for converting between Mu and E, otherwise use the B_obs value.
 
 
+    /*
+     * Maxwellian fits (FitType LGM_F2P_MAXWELLIAN). Every Mu in a bin is fit
+     * to the same data, so the fit is done once per bin and kept. Fits to
+     * earlier data are kept too, as starting guesses.
+     */
+    int          nFit;               //!< Number of bins in FitParams, FitKey and FitState.
+    int          FitnMaxwellians;    //!< nMaxwellians the fits were made with.
+    double       **FitParams;        //!< Fit in each K bin, FitParams[k][1..2*nMaxwellians] (laid out like the x[] of Model()).
+    double       *FitKey;            //!< Pitch angle the fit in each bin was made at.
+    int          *FitState;          //!< LGM_F2P_FIT_NONE, LGM_F2P_FIT_OLD or LGM_F2P_FIT_CURRENT.
+
+
 
 } Lgm_FluxToPsd;
 
@@ -241,6 +259,18 @@ typedef struct Lgm_PsdToFlux {
     int          FitType;            //!< Approach to use in fitting (e.g. Maxwellians, spline)
 
 
+    /*
+     * Maxwellian fits (FitType LGM_F2P_MAXWELLIAN). Every E in a bin is fit
+     * to the same data, so the fit is done once per bin and kept. Fits to
+     * earlier data are kept too, as starting guesses.
+     */
+    int          nFit;               //!< Number of bins in FitParams, FitKey and FitState.
+    int          FitnMaxwellians;    //!< nMaxwellians the fits were made with.
+    double       **FitParams;        //!< Fit in each A bin, FitParams[k][1..2*nMaxwellians] (laid out like the x[] of Model()).
+    double       *FitKey;            //!< Pitch angle the fit in each bin was made at.
+    int          *FitState;          //!< LGM_F2P_FIT_NONE, LGM_F2P_FIT_OLD or LGM_F2P_FIT_CURRENT.
+
+
 
 } Lgm_PsdToFlux;
 
@@ -262,6 +292,7 @@ void            Lgm_P2F_FreePsdToFlux( Lgm_PsdToFlux *p );
 void            Lgm_P2F_SetDateTimeAndPos( Lgm_DateTime *d, Lgm_Vector *u, Lgm_PsdToFlux *p );
 void            Lgm_P2F_SetPsd( double ***P, double *L, int nL, double *Mu, int nMu, double *K, int nK, Lgm_PsdToFlux *p );
 void            Lgm_P2F_GetFluxAtConstEsAndAs( double *E, int nE, double *A, int nA, double *Larr, double *Karr, double *Aarr, int narr, Lgm_MagModelInfo *mInfo, Lgm_PsdToFlux *p );
+void            Lgm_P2F_GetFluxAtConstEsAndAsMulti( int nPos, Lgm_DateTime *d, Lgm_Vector *u, double *E, int nE, double *A, int nA, double **Larr, double **Karr, double *Aarr, int narr, Lgm_MagModelInfo *mInfo, Lgm_PsdToFlux *p, double ***Flux );
 double          Lgm_P2F_GetPsdAtMuAndK( double Mu, double K, double A, Lgm_PsdToFlux *p );
 
 
@@ -280,6 +311,7 @@ double  Lgm_DiffFluxToPsd( double j, double p2c2 );
 int     Lgm_GeometricSeq( double a, double b, int n, double *G );
 int     Lgm_InterpArr( double *xa, double *ya, int n, double x, double *y );
 double  Model( double *x, int n, double E );
+void    Model_Array( double *x, int n, int nE, double *E, double *g );
 
 
 
@@ -0,0 +1,51 @@
+#ifndef LGM_FLUXTOPSDHDF_H
+#define LGM_FLUXTOPSDHDF_H
+
+#include "Lgm/Lgm_FluxToPsd.h"
+#include "Lgm/Lgm_HDF5.h"
+
+/*
+ *  Streams Lgm_FluxToPsd results (PSD versus Mu and K, one slab per time
+ *  step) to a chunked HDF5 file. Time steps are held in memory and written
+ *  nBuffer at a time, so memory use does not grow with the length of the
+ *  run. See Lgm_F2P_CreateHdf().
+ */
+#define LGM_F2P_HDF_ISOTIME_LEN     32
+
+typedef struct Lgm_FluxToPsdHdf {
+
+    hid_t       File;
+
+    int         nMu;            //!< Number of Mu values (fixed for the file)
+    int         nK;             //!< Number of K values (fixed for the file)
+
+    size_t      ChunkBytes;     //!< Target chunk size
+    int         Deflate;        //!< gzip level (0 for none)
+    int         Shuffle;        //!< If true, add the shuffle filter
+
+    int         nBuffer;        //!< Number of time steps held before they are written as one block
+    int         nBuffered;      //!< Number of time steps held
+    hsize_t     nRows;          //!< Number of time steps written to the file
+
+    int         DiagEvery;      //!< If > 0, dump the GIF diagnostics for every DiagEvery'th time step (see Lgm_F2P_DumpDiagnostics())
+
+    /*
+     *  Buffers, nBuffer time steps each.
+     */
+    char        **IsoTime;      //!< [nBuffer][LGM_F2P_HDF_ISOTIME_LEN]
+    double      *JulianDate;    //!< [nBuffer]
+    double      *Position;      //!< [nBuffer][3]
+    double      *B;             //!< [nBuffer]
+    double      *PSD;           //!< [nBuffer][nMu][nK]
+    double      *EofMu;         //!< [nBuffer][nMu][nK]
+    double      *AofK;          //!< [nBuffer][nK]
+
+} Lgm_FluxToPsdHdf;
+
+Lgm_FluxToPsdHdf   *Lgm_F2P_CreateHdf( char *Filename, double *Mu, int nMu, double *K, int nK, size_t ChunkBytes, int nBuffer, int Deflate, int Shuffle );
+int                 Lgm_F2P_WriteHdf( Lgm_FluxToPsdHdf *h, Lgm_FluxToPsd *f );
+int                 Lgm_F2P_FlushHdf( Lgm_FluxToPsdHdf *h );
+int                 Lgm_F2P_CloseHdf( Lgm_FluxToPsdHdf *h );
+void                Lgm_F2P_DumpDiagnostics( char *Suffix, Lgm_FluxToPsd *f );
+
+#endif
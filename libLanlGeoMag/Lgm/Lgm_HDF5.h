@@ -12,6 +12,15 @@
 #define H5_NO_DEPRECATED_SYMBOLS
 #include <hdf5.h>
 
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define LGM_HDF5_CHUNK_BYTES    1048576     // Default target chunk size for block-written datasets (bytes)
+
 
 
 /*
@@ -240,12 +249,25 @@ double   **Get_DoubleDataset_2D( hid_t file, char *Str, hsize_t *Dims );
 double  ***Get_DoubleDataset_3D( hid_t file, char *Str, hsize_t *Dims );
 double ****Get_DoubleDataset_4D( hid_t file, char *Str, hsize_t *Dims );
 
+int     Lgm_HDF5_GetDims( hid_t file, char *DataSet, hsize_t *Dims );
+int     Lgm_HDF5_ReadHyperslab( hid_t file, char *DataSet, hid_t MemType, int Rank, hsize_t *Start, hsize_t *Count, void *buf );
+int     Lgm_HDF5_ReadDoubleHyperslab( hid_t file, char *DataSet, int Rank, hsize_t *Start, hsize_t *Count, double *buf );
+int     Lgm_HDF5_ReadIntHyperslab( hid_t file, char *DataSet, int Rank, hsize_t *Start, hsize_t *Count, int *buf );
+size_t  Lgm_HDF5_GetStringSize( hid_t file, char *DataSet );
+int     Lgm_HDF5_ReadStringHyperslab( hid_t file, char *DataSet, hsize_t Start, hsize_t Count, size_t StrLen, char *buf );
+int     Lgm_HDF5_FindIsoTimeRange( hid_t file, char *DataSet, char *IsoTime0, char *IsoTime1, hsize_t *i0, hsize_t *n );
+
 void Lgm_WriteStringAttr( hid_t DataSet, char *AttrNAme, char *Str );
 void Lgm_WriteDoubleAttr( hid_t DataSet, char *AttrNAme, double Val );
 
 hid_t   CreateExtendableRank1DataSet( hid_t File, char *DataSetName, hid_t Type, hid_t *DataSpace );
 hid_t   CreateExtendableRank2DataSet( hid_t File, char *DataSetName, int Cols, hid_t Type, hid_t *DataSpace );
 hid_t   CreateExtendableRank3DataSet( hid_t File, char *DataSetName, int nCol, int nDepth, hid_t Type, hid_t *DataSpace );
+hid_t   CreateChunkedRank1DataSet( hid_t File, char *DataSetName, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace );
+hid_t   CreateChunkedRank2DataSet( hid_t File, char *DataSetName, int Cols, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace );
+hid_t   CreateChunkedRank3DataSet( hid_t File, char *DataSetName, int nCol, int nDepth, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace );
+int     Lgm_HDF5_AppendRows( hid_t File, char *DataSetName, hsize_t iRow, hsize_t nRows, hid_t MemType, void *buf );
+int     Lgm_HDF5_AppendRowsStrided( hid_t File, char *DataSetName, hsize_t iRow, hsize_t nRows, hid_t MemType, hsize_t MemCols, void *buf );
 hid_t   CreateStrType( int StrLength );
 
 hid_t   CreateSimpleRank1DataSet( hid_t File, char *DataSetName, int n, hid_t Type, hid_t *DataSpace );
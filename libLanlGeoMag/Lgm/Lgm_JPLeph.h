@@ -16,6 +16,8 @@
  * The nutations and librations are stored in units of radians.
  */
 
+#include <stddef.h>
+
 #ifndef TRUE
 #define TRUE 1
 #endif
@@ -49,6 +51,9 @@
 #define LGM_DE_NUTATION       112
 #define LGM_DE_MOON_ICRF      113
 
+#define LGM_DE_NRECORDS       13    //!< Number of coefficient datasets (slots in Lgm_JPLephemInfo::Rec)
+#define LGM_DE_MAX_COEFFS     32    //!< Largest number of Chebyshev coefficients per axis handled
+
 
 /*
  *  Constants for DE421 - how many of these do we need???
@@ -287,6 +292,29 @@
 
 
 
+/*
+ *  Per-dataset access to the Chebyshev records. Data points at the whole
+ *  [ SetIndex ][ AxisIndex ][ CoefficientIndex ] block, either in the
+ *  memory-mapped file (Lgm_OpenJPLephem()) or in the arrays read by
+ *  Lgm_ReadJPLephem(). If the dataset can't be mapped (e.g. it is chunked or
+ *  not stored as native doubles), Data is NULL and single records are read
+ *  from DataSet into Buf as they are needed.  The last record used is kept
+ *  (Index, Coeffs) so sequential calls don't have to look it up again.
+ */
+typedef struct Lgm_JPLephemRecord {
+    int             nSets;
+    int             nAxes;
+    int             nCoeffs;
+    const double    *Data;          //!< [ SetIndex ][ AxisIndex ][ CoefficientIndex ], or NULL
+    long long       DataSet;        //!< HDF5 dataset id (hid_t) when records are read one at a time, else 0
+    double          *Buf;           //!< Storage for one record when it is read from DataSet
+
+    int             Index;          //!< Set index of the cached record (-1 if none)
+    double          v0;             //!< Start of the cached record (days since jalpha)
+    const double    *Coeffs;        //!< Cached record, [ AxisIndex ][ CoefficientIndex ]
+} Lgm_JPLephemRecord;
+
+
 typedef struct Lgm_JPLephemInfo {
     //set DE version
     int         DEnum;              //!< e.g. 421 for DE421 ephemerides
@@ -369,6 +397,13 @@ typedef struct Lgm_JPLephemInfo {
     double      jdelta;         //!< Julian Date delta for DE
     int         verbosity;
 
+    //record access (see Lgm_OpenJPLephem())
+    int                 Mapped;                     //!< TRUE if opened with Lgm_OpenJPLephem()
+    void                *MapBase;                   //!< Start of the memory-mapped file (or NULL)
+    size_t              MapSize;                    //!< Size of the mapping
+    long long           File;                       //!< HDF5 file id (hid_t) if any dataset is read by record, else 0
+    Lgm_JPLephemRecord  Rec[LGM_DE_NRECORDS];
+
 } Lgm_JPLephemInfo;
 
 
@@ -393,6 +428,7 @@ Lgm_JPLephemInfo   *Lgm_InitJPLephemInfo( int DEnum, int getBodies, int Verbosit
 void                Lgm_InitJPLephDefaults (int DEnum, int getBodies, int verbosity, Lgm_JPLephemInfo *jpl );
 void                Lgm_FreeJPLephemInfo( Lgm_JPLephemInfo  *jpl );
 void                Lgm_ReadJPLephem( Lgm_JPLephemInfo *jpl );
+int                 Lgm_OpenJPLephem( Lgm_JPLephemInfo *jpl );
 
 Lgm_JPLephemBundle *Lgm_InitJPLephemBundle( double tdb );
 void                Lgm_FreeJPLephemBundle( Lgm_JPLephemBundle *bundle );
@@ -403,5 +439,6 @@ int                 Lgm_JPL_getNAxes( int objName, Lgm_JPLephemInfo *jpl);
 int                 Lgm_JPL_getNSets( int objName, Lgm_JPLephemInfo *jpl);
 
 void                Lgm_JPLephem_position( double tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_Vector *position);
+void                Lgm_JPLephem_position_array( long int n, double *tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_Vector *position);
 void                Lgm_JPLephem_velocity( double tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_Vector *velocity);
 void                Lgm_JPL_getSunVector ( double tdb, Lgm_JPLephemInfo *jpl, Lgm_Vector *position );
@@ -1,6 +1,8 @@
 #ifndef LGM_KDTREE
 #define LGM_KDTREE
 
+#include <stddef.h>
+#include <stdint.h>
 #include "Lgm_PriorityQueue.h"
 
 #define     KDTREE_MAX_LEVEL            1000    // Maximum depth of the tree
@@ -94,9 +96,67 @@ typedef struct _Lgm_KdTree {
 
     Lgm_KdTreeNode   *Root;          //<! Pointer to the Root node of the KdTree
 
+    /*
+     * For trees from Lgm_KdTree_Init() or Lgm_KdTree_Load(), all the nodes
+     * and data items are in two arrays, and their Min/Max/Diff and Position
+     * arrays point into Pool (built trees) or the file mapping (loaded ones).
+     */
+    unsigned long int nNodes;        //<! Number of nodes in NodePool
+    Lgm_KdTreeNode   *NodePool;      //<! All of the nodes (NodePool[0] is the Root)
+    Lgm_KdTreeData   *DataPool;      //<! All of the leaf data items
+    double           *Pool;          //<! Node bounds (nNodes*3*D) then leaf positions (n*D)
+    unsigned char    *Mapping;       //<! The mapped (or read in) file
+    size_t            MappingSize;
+
 } Lgm_KdTree;
 
 
+
+/*
+ *  KdTree files (see Lgm_KdTree_Save()). The file is
+ *
+ *      Lgm_KdTreeFileHeader
+ *      Lgm_KdTreeFileNode[ nNodes ]    (depth first, so a node's children come after it)
+ *      Bounds[ nNodes ][ 3 ][ D ]      (Min, Max and Diff of each node)
+ *      Positions[ n ][ D ]             (the leaf data, leaf by leaf)
+ *      Ids[ n ]
+ *      Objects[ n ][ ObjectSize ]      (if ObjectSize > 0)
+ *
+ *  with each section starting on a LGM_KDTREE_FILE_ALIGN boundary. Nodes
+ *  refer to each other and to their data by index, so the file can be
+ *  mapped anywhere. Everything is in native byte order.
+ */
+#define LGM_KDTREE_FILE_MAGIC       "LGMKDT01"
+#define LGM_KDTREE_FILE_VERSION     1
+#define LGM_KDTREE_FILE_ALIGN       64
+
+typedef struct Lgm_KdTreeFileHeader {
+    char        Magic[8];           // LGM_KDTREE_FILE_MAGIC (not nul terminated)
+    uint32_t    Version;            // LGM_KDTREE_FILE_VERSION
+    uint32_t    D;
+    uint64_t    n;                  // Number of points
+    uint64_t    nNodes;
+    uint64_t    ObjectSize;         // Bytes stored per Object (0 if Objects werent saved)
+    int32_t     SplitStrategy;
+    int32_t     Pad;
+    double      Min, Max, Diff;     // Lgm_KdTree scaling values
+    uint64_t    NodeOffset;         // File offsets of the sections
+    uint64_t    BoundsOffset;
+    uint64_t    PosOffset;
+    uint64_t    IdOffset;
+    uint64_t    ObjOffset;
+} Lgm_KdTreeFileHeader;
+
+typedef struct Lgm_KdTreeFileNode {
+    int64_t     Left, Right;        // Indices of the children (-1 if none)
+    uint32_t    Level, d;
+    double      CutVal;
+    uint64_t    nDataBelow;
+    uint64_t    nData;              // Number of data items (leaves only)
+    uint64_t    iData;              // Index of the first data item (leaves only)
+} Lgm_KdTreeFileNode;
+
+
 /**
  *
  * This structure holds the "Priority Queue" node information that is used as part
@@ -119,6 +179,27 @@ typedef struct _Lgm_KdTree_pQueue_Node {
 
 
 
+/**
+ *
+ * Per-thread state for kNN queries (see Lgm_KdTree_CreateQuery()). The
+ * point heap is sized for K neighbors up front, so a query does no
+ * allocation, and since nothing is written into the Lgm_KdTree, any number
+ * of threads can query the same tree at once, each with its own
+ * Lgm_KdTreeQuery.
+ *
+ */
+typedef struct _Lgm_KdTreeQuery {
+
+    int             K;              //<! Max number of neighbors this context can be used for
+    int             D;              //<! Dimension of the tree
+    Lgm_pQueue      PQP;            //<! Heap-based priority queue for points (K+2 entries, never grown)
+    double          *q;             //<! Scratch query vector (D elements)
+    long int        kNN_Lookups;    //<! Number of lookups done with this context
+
+} Lgm_KdTreeQuery;
+
+
+
 void                Lgm_KdTree_SubDivideVolume( Lgm_KdTreeNode *t, Lgm_KdTree *kt );
 
 /*! Store given N-dimensional data into a D-dimensional KD-tree data structure. */
@@ -138,4 +219,13 @@ void                Lgm_KdTree_DepthFirstSearch( Lgm_KdTreeNode *Node, Lgm_pQueu
 int                 Lgm_KdTree_kNN2( double *q_in, int D, Lgm_KdTree *KdTree, int K, int *Kgot, double MaxDist2, Lgm_KdTreeData *kNN );
 void                Lgm_KdTree_DescendTowardClosestLeaf2( Lgm_KdTreeNode *Node, Lgm_pQueue *PQN, Lgm_pQueue *PQP, int K, double *q, double *MaxDist2 );
 
+Lgm_KdTreeQuery    *Lgm_KdTree_CreateQuery( Lgm_KdTree *KdTree, int K );
+void                Lgm_KdTree_FreeQuery( Lgm_KdTreeQuery *Q );
+int                 Lgm_KdTree_kNN_Query( double *q, Lgm_KdTree *KdTree, int K, int *Kgot, double MaxDist2, Lgm_KdTreeData *kNN, Lgm_KdTreeQuery *Q );
+long int            Lgm_KdTree_kNN_Batch( Lgm_KdTree *KdTree, long int nq, double **Queries, int K, double MaxDist2, int *Kgot, Lgm_KdTreeData *kNN );
+
+int                 Lgm_KdTree_Save( Lgm_KdTree *KdTree, char *Filename, size_t ObjectSize );
+Lgm_KdTree         *Lgm_KdTree_Load( char *Filename, void **Objects );
+void                Lgm_FreeKdTree( Lgm_KdTree *KdTree );
+
 #endif
@@ -2,6 +2,7 @@
 #define LGM_LSTAR_INFO_H
 
 #include <math.h>
+#include <stdint.h>
 #include "Lgm_QuadPack.h"
 #include "Lgm_MagModelInfo.h"
 #include <gsl/gsl_errno.h>
@@ -19,20 +20,173 @@
 #define LGM_DRIFT_ORBIT_OPEN                3
 #define LGM_DRIFT_ORBIT_OPEN_SHABANSKY      4
 
+#define LGM_LSTAR_APPROXIMATE       2       // returned by Lstar() when the L* budget ran out (see Lgm_SetLstarBudget())
+#define LGM_LSTAR_OVER_BUDGET       -11     // (internal: a drift shell line search ran out of budget)
+
 
 #define LGM_LSTARINFO_MAX_FL        300
 #define LGM_LSTARINFO_MAX_MINIMA    300
 
+/*
+ *  Bits of LstarInfo->Outputs (and MagEphemInfo->Outputs): what Lstar() and
+ *  Lgm_ComputeLstarVersusPA() compute besides L* and I. The traces and
+ *  integrals that only feed outputs that arent asked for are skipped. K, Sb
+ *  and Tb are then fill values, and the drift shell arrays that werent asked
+ *  for are left alone (and not even allocated if none of them were). E.g.
+ *  LGM_OUT_LSTAR | LGM_OUT_K for just L* and K.
+ */
+#define LGM_OUT_LSTAR           0x0001  // L* and I (always computed)
+#define LGM_OUT_K               0x0002  // K
+#define LGM_OUT_SB              0x0004  // Sb and Tb
+#define LGM_OUT_FOOTPOINTS      0x0008  // Spherical and ellipsoid footpoints of the drift shell lines
+#define LGM_OUT_MIRROR          0x0010  // Mirror points (and their distances along the lines) of the drift shell lines
+#define LGM_OUT_SHELL_LINES     0x0020  // The drift shell lines themselves
+#define LGM_OUT_PMIN            0x0040  // Pmin and Bmin of the drift shell lines
+#define LGM_OUT_VGC             0x0080  // GradI and Vgc of the drift shell lines (ComputeVgc has to be set as well)
+#define LGM_OUT_ALL             0xffff
+#define LGM_OUT_SHELL_TRACE     ( LGM_OUT_FOOTPOINTS | LGM_OUT_MIRROR | LGM_OUT_SHELL_LINES )  // the ones that need each shell line traced in full
+#define LGM_OUT_SHELL           ( LGM_OUT_SHELL_TRACE | LGM_OUT_PMIN | LGM_OUT_VGC )            // the ones that go in the MagEphemInfo shell arrays
+
+
+/*
+ *  Cache of field lines traced from the Earth at a given (MLT, mlat). The
+ *  stored lines run from the southern to the northern footpoint, so they do
+ *  not depend on Bm and can be reused by drift shell searches for any pitch
+ *  angle (see ComputeI_FromMltMlat2() and Lgm_ComputeLstarVersusPA()).
+ */
+typedef struct Lgm_FieldLineCacheEntry {
+
+    long int        iMLT, imlat;        //!< Quantized footpoint (MLT in degrees of longitude, mlat in degrees)
+    double          MLT, mlat;          //!< Footpoint the line was actually traced from
+    unsigned long   ModelHash;          //!< Lgm_FieldLineCache_ModelHash() of the model that traced it
+    int             TraceFlag;          //!< Flag returned by Lgm_Trace()
+    Lgm_Vector      Pmin;               //!< Location of min-B
+    double          Bmin;               //!< Value of min-B
+    int             nPnts;              //!< Number of points stored (0 for lines that are not closed)
+    double          *s, *Px, *Py, *Pz, *Bmag, *BminusBcdip;
+
+} Lgm_FieldLineCacheEntry;
+
+typedef struct Lgm_FieldLineCache {
+
+    double                      Quantum;    //!< Size (in degrees) of the cells used to quantize footpoints.
+    double                      ds;         //!< Spacing (in Re) of the points stored along each line.
+    int                         MaxEntries; //!< Stop adding lines once there are this many.
+    int                         nEntries, nAlloced;
+    Lgm_FieldLineCacheEntry     *Entries;
+    long int                    nHits, nMisses;
+
+} Lgm_FieldLineCache;
+
+
+/*
+ *  |B| along radial lines from the Earth at (MLT, mlat) nodes, so that
+ *  FindBmRadius() can bracket the mirror radius without stepping out along
+ *  the line again (see Lgm_BmRadiusCache.c).
+ */
+#define LGM_BMRCACHE_NR     200     // Most radial samples kept per node (0.1 Re apart)
+
+typedef struct Lgm_BmRadiusCacheEntry {
+
+    long int        iMLT, imlat;        //!< Quantized MLT (degrees of longitude) and index of the mlat node
+    unsigned long   ModelHash;          //!< Lgm_FieldLineCache_ModelHash() of the model the profile is for
+    int             nR;                 //!< Number of samples so far
+    double          B[LGM_BMRCACHE_NR]; //!< |B| at r = r0 + 0.1 k (r0 is the loss cone radius)
+
+} Lgm_BmRadiusCacheEntry;
+
+typedef struct Lgm_BmRadiusCache {
+
+    double                  dMlat;      //!< Spacing (degrees) of the mlat nodes.
+    int                     MaxEntries; //!< Stop adding nodes once there are this many.
+    int                     nEntries, nAlloced;
+    Lgm_BmRadiusCacheEntry  *Entries;
+    long int                nHits, nMisses;
+
+} Lgm_BmRadiusCache;
+
+
+/*
+ *  The last converged drift shell for each pitch angle, so that the next
+ *  Lstar() for the same pitch angle (e.g. the next epoch of an orbit) can
+ *  start its searches from it (see Lgm_ShellHistory.c).
+ */
+typedef struct Lgm_ShellHistoryEntry {
+
+    double          PitchAngle;         //!< LstarInfo->PitchAngle the shell was found for
+    int             ISearchMethod;      //!< What mlat means (mirror point or footpoint mlat)
+    int             nPnts;              //!< Number of shell lines
+    double          MLT[LGM_LSTARINFO_MAX_FL], mlat[LGM_LSTARINFO_MAX_FL];   //!< Shell lines, sorted by MLT (0-24h)
+
+} Lgm_ShellHistoryEntry;
+
+typedef struct Lgm_ShellHistory {
+
+    double                  MaxShift;   //!< A saved shell is only used if it is within this many degrees of mlat of the new one at the starting MLT.
+    int                     nEntries, nAlloced;
+    Lgm_ShellHistoryEntry   *Entries;
+    long int                nHits, nMisses;
+
+} Lgm_ShellHistory;
+
+
+/*
+ *  Flux poleward of each (MLT, mlat) on the Earth for one model state, so
+ *  that MagFlux2() doesnt have to do nested integrals (see Lgm_FluxMap.c).
+ */
+typedef struct Lgm_FluxMap {
+
+    int         nMLT;               //!< Number of MLTs (evenly spaced over 0-24h, starting at 0)
+    int         nMlat;              //!< Number of mlats (evenly spaced from MlatMin to 90 degrees)
+    double      MlatMin, dMlat;     //!< First mlat and mlat spacing (degrees)
+    double      *F;                 //!< F[i*nMlat+j] is the integral of Br cos(mlat) from mlat j to the pole at MLT i (nT)
+    double      *D;                 //!< dF/dmlat at the same nodes (nT/radian)
+
+    int         Computed;           //!< TRUE once F and D are filled in
+    double      JD;                 //!< Model state the map was computed for (see Lgm_FluxMap_Matches())
+    int         InternalModel, ExternalModel, Kp;
+    double      fKp, Dst, P, By, Bz, W[6];
+
+} Lgm_FluxMap;
+
+
+/*
+ *  A named set of L* tolerances, e.g. one found by Lgm_TuneLstarTolerances()
+ *  for an L* error budget (see Lgm_LstarTuner.c).
+ */
+typedef struct Lgm_LstarTolProfile {
+    char        Name[64];                       //!< Name of the profile
+    double      TargetError;                    //!< L* error it was tuned for
+    double      MaxError;                       //!< Largest L* error on the calibration set
+    double      Cost;                           //!< Field evaluations per L* on the calibration set
+    double      RefCost;                        //!< The same for the reference (Quality 8) settings
+    int         nFLsInDriftShell;
+    int         nDivs;
+    int         I_Integrator;                   //!< DQAGS or DQK21
+    double      I_eps;                          //!< Lgm_I_Integrator_epsrel and _epsabs
+    double      MagFlux_eps;                    //!< Lgm_MagFlux_Integrator_eps* and Lgm_LambdaIntegral_Integrator_eps*
+    double      FindShellLine_I_Tol;
+    double      MagStep_atol;                   //!< Lgm_MagStep_BS_atol (and DP8)
+} Lgm_LstarTolProfile;
+
 
 typedef struct Lgm_LstarInfo {
 
     int         nFLsInDriftShell;   //!< Number of Field Lines to use when constructing Drift Shell.
+    double      AdaptiveLstarTol;   //!< If > 0, Lstar() ignores nFLsInDriftShell and adds lines where they are needed until L* is good to this (see Lstar_RefineShell()).
+    int         AdaptiveMaxFLs;     //!< Most lines Lstar() will use in a refined drift shell (at most LGM_LSTARINFO_MAX_FL).
     int         LstarQuality;       //!< Quality factor to use [0,8] -- higher gives more precise results.
+    Lgm_LstarTolProfile *TolProfile; //!< If not NULL, Lgm_SetLstarTolerances() uses it instead of LstarQuality. Shared (not copied) by Lgm_CopyLstarInfo().
 
     double      KineticEnergy;      //!< Particle kinetic energy (only for energy dep. quantities.)
     double      Mass;               //!< Particle mass
     double      PitchAngle;         //!< Particle Pitch Angle
     double      LSimpleMax;         //!< Threshold for doing drift-shell calculation.
+    double      MaxLstarTime;       //!< If > 0, seconds an Lstar() call may take before it settles for an approximate L* (see Lgm_SetLstarBudget()).
+    long int    MaxLstarMagEvals;   //!< If > 0, the same for the number of field evaluations made by the tracers.
+    int         LSApproximate;      //!< Set by Lstar(): TRUE if the budget ran out and LS is only an approximation.
+    double      BudgetDeadline;     //   (monotonic clock time that this Lstar() call has to finish by)
+    long int    BudgetMagEvals;     //   (LGM_NMAGEVALS_TOTAL() that it has to finish by)
 
 
     Lgm_MagModelInfo	*mInfo;
@@ -40,15 +194,22 @@ typedef struct Lgm_LstarInfo {
     /*
      *  Variables to hold info on field lines defining the Drift Shell
      */
-    int         FindShellPmin;      //!< Find the Bmin location on each FL
+    int         FindShellPmin;      //!< (Not used -- the Bmin location on each FL is found if Outputs has LGM_OUT_PMIN.)
     int         ComputeVgc;         //!< Compute the gradient of I and Vgc
     int         SaveShellLines;     //!< only save them if this is true
+    int         Outputs;            //!< LGM_OUT_* bits of what to compute (LGM_OUT_ALL by default).
     int         nFieldPnts[ LGM_LSTARINFO_MAX_FL ];    //!< number of points in each FL.
-    double      s_gsm[ LGM_LSTARINFO_MAX_FL ][1000];   //!< distance along FL.
-    double      Bmag[ LGM_LSTARINFO_MAX_FL ][1000];    //!< Field magnitude
-    double      x_gsm[ LGM_LSTARINFO_MAX_FL ][1000];
-    double      y_gsm[ LGM_LSTARINFO_MAX_FL ][1000];
-    double      z_gsm[ LGM_LSTARINFO_MAX_FL ][1000];
+
+    /*
+     *  The saved FLs themselves are about 12 MB, so they are only allocated
+     *  (with LGM_LSTARINFO_MAX_FL rows each, by Lgm_LstarInfo_AllocShellLines())
+     *  when Lstar() is called with SaveShellLines set. They are NULL until then.
+     */
+    double      (*s_gsm)[1000];     //!< distance along FL.
+    double      (*Bmag)[1000];      //!< Field magnitude
+    double      (*x_gsm)[1000];
+    double      (*y_gsm)[1000];
+    double      (*z_gsm)[1000];
 
 
     /*
@@ -118,6 +279,17 @@ typedef struct Lgm_LstarInfo {
     int		            VerbosityLevel;
     char                PreStr[64], PostStr[64];
     int                 ISearchMethod;
+    int                 NewtonShellLine;    //!< If TRUE, FindShellLine() tries a safeguarded secant search before bracketing.
+    double              dIdMlat;            //!< Slope of I versus mlat at the last shell line the secant search found (0 if none yet).
+    int                 UseFieldLineCache;  //!< If TRUE (and ISearchMethod is 2), Lgm_ComputeLstarVersusPA() shares traced lines between pitch angles.
+    Lgm_FieldLineCache  *FieldLineCache;    //!< Shared (not copied) by Lgm_CopyLstarInfo(). Owned by whoever created it.
+    int                 UseBmRadiusCache;   //!< If TRUE, Lgm_ComputeLstarVersusPA() shares radial |B| profiles between pitch angles (see FindBmRadius()).
+    Lgm_BmRadiusCache   *BmRadiusCache;     //!< Shared (not copied) by Lgm_CopyLstarInfo(). Owned by whoever created it.
+    Lgm_MinBMap         *MinBMap;           //!< If not NULL (and ISearchMethod is 2), used to predict where the next shell line is. Shared (not copied) by Lgm_CopyLstarInfo().
+    int                 ParallelDriftShell; //!< If TRUE (OpenMP builds), Lstar() finds the lines of the drift shell in parallel. Ignored when Lstar() is called from inside a parallel region.
+    Lgm_ShellHistory    *ShellHistory;      //!< If not NULL, Lstar() starts from (and saves) the last shell found for the same pitch angle. Shared (not copied) by Lgm_CopyLstarInfo().
+    Lgm_ShellHistoryEntry *NestedShell;     //!< If not NULL, a shell (e.g. for the neighbouring pitch angle) that Lstar() predicts the lines from when ShellHistory has none; Lstar() then overwrites it with the shell it found. Set per task by Lgm_ComputeLstarVersusPA().
+    Lgm_FluxMap         *FluxMap;           //!< If not NULL and computed for the current model state, MagFlux2() uses it instead of LambdaIntegral(). Shared (not copied) by Lgm_CopyLstarInfo().
 
     double	            LS;
     double	            LS_dip_approx;
@@ -149,13 +321,98 @@ typedef struct Lgm_LstarInfo {
 } Lgm_LstarInfo;
 
 
+/*
+ *  A set of reusable Lgm_LstarInfo structures, e.g. one or two per thread for
+ *  codes that would otherwise make fresh copies for every L* calculation (see
+ *  Lgm_LstarInfoPool_Get()).
+ */
+typedef struct Lgm_LstarInfoPool {
+
+    int             n;          //!< Number of slots.
+    Lgm_LstarInfo   **Slots;    //!< Slots[i] is NULL until it is first used.
+    int             *Busy;      //!< Busy[i] is TRUE while slot i is held by Lgm_LstarInfoPool_Acquire().
+    int             *Node;      //!< Node[i] is the NUMA node slot i was made on (see Lgm_NumaHome()).
+
+} Lgm_LstarInfoPool;
+
+
+/*
+ *  Precomputed table of L* versus (K, Bm, MLT) for one model state (see
+ *  Lgm_LstarTable.c). The header is also the header of the saved file.
+ */
+#define LGM_LSTARTABLE_MAGIC        "LGMLSTB1"
+#define LGM_LSTARTABLE_VERSION      1
+
+typedef struct Lgm_LstarTableHeader {
+    char        Magic[8];           //!< LGM_LSTARTABLE_MAGIC
+    int32_t     Version;            //!< LGM_LSTARTABLE_VERSION
+    int32_t     nMLT;               //!< Number of MLTs (evenly spaced over 0-24h, starting at 0)
+    int32_t     nBm;                //!< Number of Bm values (evenly spaced in log(Bm) from Bm0 to Bm1)
+    int32_t     nR;                 //!< Number of radii each column started with (evenly spaced from R0 to R1)
+    double      ByteOrder;          //!< 1.0 (used to detect files written on a machine with a different byte order)
+    double      Bm0, Bm1;           //!< Range of Bm (nT)
+    double      R0, R1;             //!< Range of the starting radii (Re, in the SM equatorial plane)
+    double      dRmin;              //!< Refinement never splits an interval narrower than this (Re)
+
+    int64_t     Date;               //!< Model state the table was built for (see Lgm_LstarTable_Matches())
+    double      UTC, JD;
+    int32_t     InternalModel, ExternalModel;
+    int32_t     Kp, Pad;
+    double      fKp, Dst, P, By, Bz, W[6];
+    double      LossConeHeight;
+} Lgm_LstarTableHeader;
+
+/*
+ *  The nodes of one (MLT, Bm) column, sorted by R. Node k is the field line
+ *  through radius R[k] in the SM equatorial plane at the columns MLT; K and
+ *  Lstar are LGM_FILL_VALUE if the node has no L* (Bmin >= Bm, or the drift
+ *  shell is not closed).
+ */
+typedef struct Lgm_LstarTableColumn {
+    int         n, nAlloced;
+    double      *R, *K, *Lstar;
+    double      *D;                 //!< dL*/dK at each node (monotone cubic slopes)
+    double      *Err;               //!< Err[k] is the error estimate for the interval from node k to k+1 (< 0 if it cant be interpolated)
+} Lgm_LstarTableColumn;
+
+typedef struct Lgm_LstarTable {
+    Lgm_LstarTableHeader    h;
+    Lgm_LstarTableColumn    *Col;   //!< Column for MLT i and Bm j is Col[i*h.nBm + j]
+} Lgm_LstarTable;
+
+
+
+
 void        Lgm_SetLstarTolerances( int Quality, int nFLsInDriftShell, Lgm_LstarInfo *LstarInfo );
+void        Lgm_ApplyLstarTolProfile( Lgm_LstarTolProfile *p, Lgm_LstarInfo *LstarInfo );
+int         Lgm_TuneLstarTolerances( double TargetError, int n, Lgm_Vector *u, double *Alpha, char *Name, Lgm_LstarInfo *LstarInfo, Lgm_LstarTolProfile *p );
+int         Lgm_WriteLstarTolProfile( char *Filename, Lgm_LstarTolProfile *p );
+int         Lgm_ReadLstarTolProfile( char *Filename, Lgm_LstarTolProfile *p );
+unsigned long Lgm_LstarTolProfile_Hash( unsigned long h, Lgm_LstarTolProfile *p );
 Lgm_LstarInfo  *InitLstarInfo( int VerbosityLevel );
 //void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  * );
 void Lgm_InitLstarInfoDefaults( Lgm_LstarInfo   *LstarInfo );
 
 void FreeLstarInfo( Lgm_LstarInfo *LstarInfo );
 Lgm_LstarInfo *Lgm_CopyLstarInfo( Lgm_LstarInfo *s );
+int         Lgm_LstarInfo_AllocShellLines( Lgm_LstarInfo *s );
+void        Lgm_LstarInfo_FreeShellLines( Lgm_LstarInfo *s );
+Lgm_LstarInfoPool *Lgm_InitLstarInfoPool( int n );
+Lgm_LstarInfo *Lgm_LstarInfoPool_Get( int i, Lgm_LstarInfo *s, Lgm_LstarInfoPool *Pool );
+void        Lgm_FreeLstarInfoPool( Lgm_LstarInfoPool *Pool );
+int         Lgm_LstarInfoPool_Acquire( Lgm_LstarInfoPool *Pool );
+void        Lgm_LstarInfoPool_Release( int i, Lgm_LstarInfoPool *Pool );
+void        Lgm_LstarInfo_SetStageHooks( Lgm_StageHooks *Hooks, Lgm_LstarInfo *LstarInfo );
+void        Lgm_SetLstarBudget( double MaxTime, long int MaxMagEvals, Lgm_LstarInfo *LstarInfo );
+Lgm_LstarTable *Lgm_InitLstarTable( int nMLT, int nBm, double Bm0, double Bm1, int nR, double R0, double R1 );
+void        Lgm_FreeLstarTable( Lgm_LstarTable *t );
+int         Lgm_ComputeLstarTable( Lgm_LstarTable *t, Lgm_LstarInfo *LstarInfo );
+int         Lgm_LstarTable_Refine( Lgm_LstarTable *t, double Tol, Lgm_LstarInfo *LstarInfo );
+int         Lgm_LstarTable_Lookup( Lgm_LstarTable *t, double K, double Bm, double MLT, double *Lstar, double *Err );
+int         Lgm_LstarTable_LookupRefine( Lgm_LstarTable *t, double K, double Bm, double MLT, double Tol, Lgm_LstarInfo *LstarInfo, double *Lstar, double *Err );
+int         Lgm_LstarTable_Matches( Lgm_LstarTable *t, Lgm_MagModelInfo *m );
+int         Lgm_WriteLstarTable( Lgm_LstarTable *t, const char *Filename );
+Lgm_LstarTable *Lgm_ReadLstarTable( const char *Filename );
 
 int         Grad_I( Lgm_Vector *vin, Lgm_Vector *GradI, Lgm_LstarInfo *LstarInfo );
 int         ComputeVcg( Lgm_Vector *vin, Lgm_Vector *Vcg, Lgm_LstarInfo *LstarInfo );
@@ -164,6 +421,28 @@ int 	    FindShellLine( double I0, double *Ifound, double Bm, double MLT, double
 double      ComputeI_FromMltMlat(  double Bm, double MLT, double mlat, double *r, double I0, Lgm_LstarInfo *LstarInfo );
 double      ComputeI_FromMltMlat1( double Bm, double MLT, double mlat, double *r, double I0, Lgm_LstarInfo *LstarInfo );
 double      ComputeI_FromMltMlat2( double Bm, double MLT, double mlat, double *r, double I0, Lgm_LstarInfo *LstarInfo );
+Lgm_FieldLineCache *Lgm_InitFieldLineCache( double Quantum, int MaxEntries );
+void        Lgm_FreeFieldLineCache( Lgm_FieldLineCache *c );
+Lgm_ShellHistory *Lgm_InitShellHistory( double MaxShift );
+void        Lgm_FreeShellHistory( Lgm_ShellHistory *h );
+void        Lgm_ResetShellHistory( Lgm_ShellHistory *h );
+int         Lgm_ShellHistory_Get( Lgm_ShellHistory *h, double PitchAngle, int ISearchMethod, Lgm_ShellHistoryEntry *e );
+void        Lgm_ShellHistory_Save( Lgm_ShellHistory *h, double PitchAngle, int ISearchMethod, int nPnts, double *MLT, double *mlat );
+void        Lgm_ShellHistory_SetEntry( Lgm_ShellHistoryEntry *e, double PitchAngle, int ISearchMethod, int nPnts, double *MLT, double *mlat );
+double      Lgm_ShellHistory_Mlat( Lgm_ShellHistoryEntry *e, double MLT );
+Lgm_FluxMap *Lgm_InitFluxMap( int nMLT, int nMlat, double MlatMin );
+void        Lgm_FreeFluxMap( Lgm_FluxMap *f );
+void        Lgm_FluxMap_Compute( Lgm_FluxMap *f, Lgm_MagModelInfo *m );
+int         Lgm_FluxMap_Matches( Lgm_FluxMap *f, Lgm_MagModelInfo *m );
+int         Lgm_FluxMap_Eval( Lgm_FluxMap *f, double MLT, double mlat, double *F );
+unsigned long Lgm_FieldLineCache_ModelHash( Lgm_MagModelInfo *m );
+int         Lgm_FieldLineCache_Get( Lgm_FieldLineCache *c, double MLT, double mlat, int *TraceFlag, Lgm_Vector *Pmin, double *Bmin, Lgm_MagModelInfo *m );
+void        Lgm_FieldLineCache_Add( Lgm_FieldLineCache *c, double MLT, double mlat, int TraceFlag, Lgm_Vector *Pmin, double Bmin, Lgm_MagModelInfo *m );
+int         Lgm_FieldLineCache_Iinv( double Bm, double *I, Lgm_MagModelInfo *m );
+int         Lgm_FieldLineCache_Bracket( Lgm_FieldLineCache *c, double MLT, double Bm, double I0, double pred_mlat, double *mlat0, double *mlat_try, double *mlat1, Lgm_LstarInfo *LstarInfo );
+Lgm_BmRadiusCache *Lgm_InitBmRadiusCache( double dMlat, int MaxEntries );
+void        Lgm_FreeBmRadiusCache( Lgm_BmRadiusCache *c );
+int         Lgm_BmRadiusCache_Bracket( Lgm_BmRadiusCache *c, double Bm, double MLT, double mlat, double *a, double *b, Lgm_MagModelInfo *m );
 void 	    spline( double *x, double *y, int n, double yp1, double ypn, double *y2);
 void 	    splint( double *xa, double *ya, double *y2a, int n, double x, double *y);
 void 	    quicksort( unsigned long n, double *arr );
@@ -175,11 +454,15 @@ int         Lstar( Lgm_Vector *vin, Lgm_LstarInfo *LstarInfo );
 double      MagFlux( Lgm_LstarInfo *LstarInfo );
 double      MagFlux2( Lgm_LstarInfo *LstarInfo );
 double      MagFluxIntegrand( double Phi, _qpInfo *qpInfo ) ;
+void        MagFluxIntegrand_v( int n, const double *Phi, double *f, _qpInfo *qpInfo );
 double      MagFluxIntegrand2( double Phi, _qpInfo *qpInfo ) ;
+double      MagFluxIntegrand_Map( double Phi, _qpInfo *qpInfo ) ;
 double      LambdaIntegrand( double Lambda, _qpInfo *qpInfo ) ;
 double      LambdaIntegral( Lgm_LstarInfo *LstarInfo ) ;
 double      AngVelInv( double Phi );
 int         Lgm_LCDS( long int Date, double UTC, double brac1, double brac2, double Alpha, double LT, double tol, int Quality, int nFLsInDriftShell, double *K, Lgm_LstarInfo *LstarInfo );
+int         Lgm_LCDS_MultiK( long int Date, double UTC, double brac1, double brac2, int nK, double *Kin, double LT, double tol, int Quality, int nFLsInDriftShell, double *LCDS, double *K, int *Flag, Lgm_LstarInfo *LstarInfo );
+int         Lgm_LCDS_MultiK_Radii( long int Date, double UTC, double brac1, double brac2, int nK, double *Kin, double LT, double tol, int Quality, int nFLsInDriftShell, double *LCDS, double *K, double *Bm, double *Rlcds, int *Flag, Lgm_LstarInfo *LstarInfo );
  
 
 #endif
@@ -0,0 +1,91 @@
+#ifndef LGM_MAGEPHEMCOL_H
+#define LGM_MAGEPHEMCOL_H
+
+#include <stdint.h>
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+/*
+ *  Columnar binary MagEphem files.
+ *
+ *  A third output format (next to the text and HDF5 ones) meant for fast
+ *  loading rather than for archiving. The file is
+ *
+ *      Lgm_MagEphemColHeader
+ *      Lgm_MagEphemColColumn[ nColumns ]     (the column directory)
+ *      JSON schema (nul terminated, made with Lgm_metadata_JSONheader())
+ *      column 0, column 1, ...               (each starts on a LGM_MEC_ALIGN boundary)
+ *
+ *  Every column is a plain array of MaxRows fixed-width rows in native byte
+ *  order, so a reader can mmap the file and use the columns in place (see
+ *  Lgm_OpenMagEphemCol() and Lgm_GetMagEphemColumn()). Only the first nRows
+ *  rows hold data. Column types are 'd' (double), 'i' (int32_t), 'l'
+ *  (int64_t) and 's' (fixed length, nul padded string).
+ */
+#define LGM_MEC_MAGIC           "LGMMEC01"
+#define LGM_MEC_VERSION         1
+#define LGM_MEC_ALIGN           4096
+#define LGM_MEC_NAME_LEN        32
+
+typedef struct Lgm_MagEphemColHeader {
+    char        Magic[8];       // LGM_MEC_MAGIC (not nul terminated)
+    uint32_t    Version;        // LGM_MEC_VERSION
+    uint32_t    nColumns;
+    uint64_t    nRows;          // Number of rows written
+    uint64_t    MaxRows;        // Number of rows each column has room for
+    uint64_t    SchemaOffset;   // File offset of the JSON schema
+    uint64_t    SchemaBytes;    // Length of the schema (not counting the nul)
+    uint64_t    DirOffset;      // File offset of the column directory
+} Lgm_MagEphemColHeader;
+
+typedef struct Lgm_MagEphemColColumn {
+    char        Name[LGM_MEC_NAME_LEN];
+    char        Type;           // 'd', 'i', 'l' or 's'
+    char        Pad[3];
+    uint32_t    Width;          // Elements per row (characters per row for 's')
+    uint32_t    ElemBytes;      // Bytes per element
+    uint32_t    Pad2;
+    uint64_t    RowBytes;       // Width*ElemBytes
+    uint64_t    Offset;         // File offset of row 0
+} Lgm_MagEphemColColumn;
+
+
+/*
+ *  Writer. One of these per file being written.
+ */
+typedef struct Lgm_MagEphemColWriter {
+    int                     fd;
+    Lgm_MagEphemColHeader   Header;
+    Lgm_MagEphemColColumn   *Columns;
+    int                     *Spec;          // Index into the writer's table of med members, per column
+    int                     nBuffered;      // Rows held (see Lgm_WriteMagEphemDataCol())
+    int                     iRow0;
+    int                     i0;
+    char                    *Tmp;           // Staging area for packing a block of one column
+    size_t                  nTmp;
+} Lgm_MagEphemColWriter;
+
+/*
+ *  Reader. Column pointers point straight into the mapping.
+ */
+typedef struct Lgm_MagEphemColFile {
+    unsigned char           *Base;          // The mapped (or read in) file
+    size_t                  Size;
+    Lgm_MagEphemColHeader   *Header;
+    Lgm_MagEphemColColumn   *Columns;
+    long int                nRows;
+    int                     nColumns;
+    char                    *Schema;        // JSON schema (nul terminated)
+} Lgm_MagEphemColFile;
+
+
+Lgm_MagEphemColWriter *Lgm_CreateMagEphemCol( const char *Filename, long int MaxRows, const char *CodeVersion, const char *ExtModel, int SpiceBody,  const char *Spacecraft, int IdNumber, const char *IntDesig, const char *CmdLine, int nAscend, Lgm_DateTime *Ascend_UTC, Lgm_Vector *Ascend_U, int nPerigee, Lgm_DateTime *Perigee_UTC, Lgm_Vector *Perigee_U, int nApogee, Lgm_DateTime *Apogee_UTC, Lgm_Vector *Apogee_U, Lgm_MagEphemInfo *m, Lgm_MagEphemData *med );
+int     Lgm_WriteMagEphemDataCol( Lgm_MagEphemColWriter *w, int iRow, int i, Lgm_MagEphemData *med );
+int     Lgm_FlushMagEphemDataCol( Lgm_MagEphemColWriter *w, Lgm_MagEphemData *med );
+int     Lgm_CloseMagEphemColWriter( Lgm_MagEphemColWriter *w, Lgm_MagEphemData *med );
+
+Lgm_MagEphemColFile *Lgm_OpenMagEphemCol( char *Filename );
+void   *Lgm_GetMagEphemColumn( Lgm_MagEphemColFile *f, char *Name, char Type, int *Width );
+int     Lgm_FindMagEphemColumn( Lgm_MagEphemColFile *f, char *Name );
+void    Lgm_CloseMagEphemCol( Lgm_MagEphemColFile *f );
+
+#endif
@@ -5,14 +5,17 @@
 #include "Lgm/Lgm_LstarInfo.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include "Lgm/Lgm_HDF5.h"
+#include "Lgm/Lgm_ResultsCache.h"
 
 
 #define MAX_PITCH_ANGLES 90
+#define LGM_MAGEPHEM_MIN_EVENTS 256     // minimum room for apogees, perigees and ascending nodes in a Lgm_MagEphemData
 
 // Propagator Types
 #define SPICE   1
@@ -28,12 +31,15 @@
 typedef struct Lgm_MagEphemInfo {
 
     Lgm_LstarInfo   *LstarInfo;
+    Lgm_LstarInfoPool *LstarInfoPool; //!< Scratch copies of LstarInfo reused by Lgm_ComputeLstarVersusPA() (two per running task). Created on first use.
+    Lgm_ResultsCache  *ResultsCache;  //!< If not NULL, Lgm_ComputeLstarVersusPA() looks up (and stores) its results here (see Lgm_ResultsCache.c). Shared by copies. Not owned.
 
     int             PropagatorType;   //!< Orbit Propagator: Either SPICE or SGP4. This just keeps track of what we are using - it doesnt force one or the other.
     int             nFLsInDriftShell; //!< Number of Field Lines to use when constructing Drift Shell.
     int             LstarQuality;     //!< Quality factor to use [0,8] -- higher gives more precise results.
 
     int             SaveShellLines;
+    int             Outputs;        //!< LGM_OUT_* bits of what Lgm_ComputeLstarVersusPA() should compute (LGM_OUT_ALL by default). See Lgm_LstarInfo.h.
 
     long int        Date;           //!< Date in YYYYMMDD format
     double          UTC;            //!< UTC in decimal hours
@@ -83,6 +89,7 @@ typedef struct Lgm_MagEphemInfo {
      * Array of PAs we need to compute things for...
      */
     int         nAlpha;     //!< Number of Pitch Angles
+    int         nAllocedAlpha; //!< Number of Pitch Angles the arrays below have room for (the MaxPitchAngles they were allocated with)
     double      *Alpha;     //!< Pitch Angles (Degrees).
                             //!< 1D array (dynamically allocated). Access as follows: Alpha[ PitchAngleIndex ]
     Lgm_Vector  *Pmn_gsm;   //!< 1D array (dynamically allocated). Access as follows: Pmn_gsm[ PitchAngleIndex ]  position of northern |Bmirror|
@@ -96,6 +103,11 @@ typedef struct Lgm_MagEphemInfo {
     int         *nShellPoints; //!<  1D array. Access as follows: nShellPoints[ PitchAngleIndex ] # of point (i.e. FLs) in a shell calculation)
 
     /*
+     * The Shell* arrays, nMinima, nMaxima and the shell lines (the
+     * [ PitchAngleIndex ][ FieldLineIndex ] arrays below) are NULL until
+     * Lgm_ComputeLstarVersusPA() is called with SaveShellLines set. See
+     * Lgm_MagEphemShellLines.c.
+     *
      * Footpoints XXXkm above spherical Earth defined as sphere with
      * radius==WGS84_A (i.e. equatorial radius of WGS84 model)
      */
@@ -134,14 +146,23 @@ typedef struct Lgm_MagEphemInfo {
 
     /*
      * these are like the variables in the LstarInfo structure. Except they have an extra
-     * dimension to hold pitch angle as well.
+     * dimension to hold pitch angle as well, are decimated to within ShellLineTol of the
+     * traced lines, and are floats packed one line after the other. Point tk of
+     * line nn for pitch angle i is
+     *
+     *      s_gsm[i][ ShellLineOffset[i][nn] + tk ],    tk < nFieldPnts[i][nn]
+     *
+     * (and the same for Bmag, x_gsm, y_gsm and z_gsm).
      */
-    int         **nFieldPnts;   //!< [ PitchAngleIndex ][ FieldLineIndex ]
-    double      ***s_gsm;       //!< [ PitchAngleIndex ][ FieldLineIndex ][ FieldLinePointIndex ]
-    double      ***Bmag;        //!< [ PitchAngleIndex ][ FieldLineIndex ][ FieldLinePointIndex ]
-    double      ***x_gsm;       //!< [ PitchAngleIndex ][ FieldLineIndex ][ FieldLinePointIndex ]
-    double      ***y_gsm;       //!< [ PitchAngleIndex ][ FieldLineIndex ][ FieldLinePointIndex ]
-    double      ***z_gsm;       //!< [ PitchAngleIndex ][ FieldLineIndex ][ FieldLinePointIndex ]
+    double      ShellLineTol;           //!< Max distance (Re) of a traced shell line from the saved one (0 saves every point).
+    int         **nFieldPnts;           //!< [ PitchAngleIndex ][ FieldLineIndex ] # of points saved for the line
+    int         **ShellLineOffset;      //!< [ PitchAngleIndex ][ FieldLineIndex ] where the line starts in s_gsm[ PitchAngleIndex ] etc.
+    int         *nShellLinePntsAlloced; //!< [ PitchAngleIndex ] room in s_gsm[ PitchAngleIndex ] etc.
+    float       **s_gsm;                //!< [ PitchAngleIndex ][ packed FieldLinePointIndex ]
+    float       **Bmag;                 //!< [ PitchAngleIndex ][ packed FieldLinePointIndex ]
+    float       **x_gsm;                //!< [ PitchAngleIndex ][ packed FieldLinePointIndex ]
+    float       **y_gsm;                //!< [ PitchAngleIndex ][ packed FieldLinePointIndex ]
+    float       **z_gsm;                //!< [ PitchAngleIndex ][ packed FieldLinePointIndex ]
 
     double      Mcurr;
     double      Mref;
@@ -152,6 +173,9 @@ typedef struct Lgm_MagEphemInfo {
     double      *Hmin_GeodLat; //!< Hmin[ PitchAngleIndex ]
     double      *Hmin_GeodLon; //!< Hmin[ PitchAngleIndex ]
     double      *Lstar;        //!< Lstar[ PitchAngleIndex ]
+    int         *LstarApprox;  //!< TRUE where Lstar[] is only approximate (the L* budget ran out, see Lgm_SetLstarBudget())
+
+    Lgm_IsoTimeFormatter IsoTimeFmt;   //!< Time string of the last row Lgm_WriteMagEphemData() wrote
 
     int         *DriftOrbitType;     // e.g. Open, Closed, Shabansky
     int         **nMinima;           // # of minima on FL
@@ -180,7 +204,21 @@ typedef struct Lgm_MagEphemData {
     double      **H5_Ascend_Geod;
 
     int         H5_nT;
+    int         H5_nRows;           // Number of time steps the per-time H5_* arrays hold (see Lgm_InitMagEphemData())
     int         H5_nAlpha;
+    int         H5_nPA;             // Row length of the per-pitch-angle H5_* arrays (nPA in Lgm_InitMagEphemData())
+
+    /*
+     *  HDF5 output settings and the rows not yet written. See
+     *  Lgm_SetMagEphemHdfOptions() and Lgm_WriteMagEphemDataHdf().
+     */
+    size_t      H5_ChunkBytes;      // Target chunk size of the per-time datasets (bytes)
+    int         H5_nBuffer;         // Number of rows held before they are written as one block
+    int         H5_Deflate;         // Deflate level (0 for none)
+    int         H5_Shuffle;         // If TRUE, apply the shuffle filter
+    int         H5_nBuffered;       // Number of rows held
+    int         H5_iRow0;           // File row of the first row held
+    int         H5_i0;              // Index (in the H5_* arrays) of the first row held
 
     double      *H5_Alpha;
 
@@ -197,6 +235,7 @@ typedef struct Lgm_MagEphemData {
     double      *H5_TiltAngle;
     int         *H5_InOut;
     int         *H5_OrbitNumber;
+    int         *H5_Interpolated;
 
     double      **H5_Rgeo;
     double      **H5_Rgeod;
@@ -293,14 +332,91 @@ typedef struct Lgm_MagEphemData {
 } Lgm_MagEphemData;
 
 
+/*
+ *  Packed (binary) Lgm_MagEphemInfo records, for sending the results for an
+ *  epoch from one process to another (see Lgm_MagEphemInfoPack.c). A record
+ *  is a Lgm_MagEphemPackHeader followed by the arrays, each starting on an
+ *  8 byte boundary.
+ */
+#define LGM_MAGEPHEM_PACK_MAGIC     "LgmMEpk"   // 8 bytes with the NUL
+#define LGM_MAGEPHEM_PACK_VERSION   1
+#define LGM_MAGEPHEM_PACK_BYTEORDER 0x01020304
+
+typedef struct Lgm_MagEphemPackHeader {
+
+    char        Magic[8];
+    uint32_t    Version;
+    uint32_t    ByteOrder;      // LGM_MAGEPHEM_PACK_BYTEORDER as the writer saw it
+    uint64_t    Size;           // Bytes in the whole record (this header included)
+
+    int32_t     nAlpha;
+    int32_t     Outputs;        // LGM_OUT_* bits of the arrays in the record
+    int32_t     HaveShell;      // TRUE if the drift shell arrays are in the record
+    int32_t     nShellTotal;    // Sum of nShellPoints[] (the length of each drift shell array)
+    int32_t     nLinePntsTotal; // Number of shell line points (the length of each shell line array)
+    int32_t     FieldLineType;
+    int32_t     InOut;
+    int32_t     OrbitNumber;
+    int64_t     Date;
+
+    double      UTC, Lat, Lon, Rad;
+    Lgm_Vector  P;
+    double      S, B, d2B_ds2, RofC, Sb0;
+    Lgm_Vector  Pmin;
+    double      Bmin, Smin, Snorth, Ssouth;
+    Lgm_Vector  Spherical_Footprint_Pn, Spherical_Footprint_Ps, Ellipsoid_Footprint_Pn, Ellipsoid_Footprint_Ps;
+    double      Spherical_Footprint_Sn, Spherical_Footprint_Bn, Spherical_Footprint_Ss, Spherical_Footprint_Bs;
+    double      Ellipsoid_Footprint_Sn, Ellipsoid_Footprint_Bn, Ellipsoid_Footprint_Ss, Ellipsoid_Footprint_Bs;
+    double      Mcurr, Mref, Mused, ShellLineTol;
+
+} Lgm_MagEphemPackHeader;
+
+/*
+ *  Pointers straight into a packed record (see Lgm_MagEphemInfo_PackView()).
+ *  The per pitch angle arrays have nAlpha entries. The drift shell arrays
+ *  hold nShellPoints[0] entries for the first pitch angle, then
+ *  nShellPoints[1] for the second, and so on; the shell line arrays likewise
+ *  hold nLinePnts[0] points for the first pitch angle and so on (with
+ *  ShellLineOffset[] relative to the start of each pitch angle's points, as
+ *  in Lgm_MagEphemInfo). Arrays that arent in the record are NULL.
+ */
+typedef struct Lgm_MagEphemPackView {
+
+    const Lgm_MagEphemPackHeader *h;
+
+    const double        *Alpha, *Bm, *I, *Lstar, *LHilton, *LMcIlwain, *Hmin, *Hmin_GeodLat, *Hmin_GeodLon, *K, *Sb, *Tb;
+    const Lgm_Vector    *Pmn_gsm, *Pms_gsm;
+    const int           *nShellPoints, *LstarApprox, *DriftOrbitType;
+
+    const double        *ShellI;
+    const int           *nMinima, *nMaxima;
+    const Lgm_Vector    *ShellSphericalFootprint_Pn, *ShellSphericalFootprint_Ps, *ShellEllipsoidFootprint_Pn, *ShellEllipsoidFootprint_Ps;
+    const double        *ShellSphericalFootprint_Sn, *ShellSphericalFootprint_Bn, *ShellSphericalFootprint_Ss, *ShellSphericalFootprint_Bs;
+    const double        *ShellEllipsoidFootprint_Sn, *ShellEllipsoidFootprint_Bn, *ShellEllipsoidFootprint_Ss, *ShellEllipsoidFootprint_Bs;
+    const Lgm_Vector    *ShellMirror_Pn, *ShellMirror_Ps;
+    const double        *ShellMirror_Sn, *ShellMirror_Ss;
+    const Lgm_Vector    *Shell_Pmin, *Shell_Bmin, *Shell_GradI, *Shell_Vgc;
+
+    const int           *nLinePnts, *nFieldPnts, *ShellLineOffset;
+    const float         *s_gsm, *Bmag, *x_gsm, *y_gsm, *z_gsm;
+
+} Lgm_MagEphemPackView;
+
+
 /*
  * Function Prototypes
  */
 void    Lgm_SetMagEphemLstarQuality( int Quality, int nFLsInDriftShell, Lgm_MagEphemInfo *MagEphemInfo );
 Lgm_MagEphemInfo *Lgm_InitMagEphemInfo( int Verbosity, int MaxPitchAngles );
 void    Lgm_InitMagEphemInfoDefaults(Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchAngles, int Verbosity);
+Lgm_MagEphemInfo *Lgm_CopyMagEphemInfo( Lgm_MagEphemInfo *s, int MaxPitchAngles );
 void    Lgm_FreeMagEphemInfo( Lgm_MagEphemInfo  *Info );
 void    Lgm_FreeMagEphemInfo_Children( Lgm_MagEphemInfo  *MagEphemInfo );
+void    Lgm_MagEphemInfo_AllocShellArrays( Lgm_MagEphemInfo *m );
+void    Lgm_MagEphemInfo_FreeShellArrays( Lgm_MagEphemInfo *m );
+int     Lgm_MagEphemInfo_PutShellLines( int i, Lgm_LstarInfo *LstarInfo, Lgm_MagEphemInfo *m );
+int     Lgm_MagEphemInfo_nShellLinePnts( int i, Lgm_MagEphemInfo *m );
+int     Lgm_DouglasPeucker3D( int n, double *x, double *y, double *z, double Tol, int *Keep, int *Stack );
 
 double  j_to_fp_1( double j, double Ek );
 double  j_to_fp_2( double j, double Ek0, double Ek1 );
@@ -308,13 +424,31 @@ double  k_to_mu_1( double Ek, double alpha, double B );
 double  k_to_mu_2( double Ek0, double Ek1, double alpha, double B );
 double  Ek_to_v( double Ek, int Species );
 void    Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo *MagEphemInfo );
+void    Lgm_ComputeLstarVersusPA_Multi( int nT, long int *Date, double *UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo **MagEphemInfo );
+void    Lgm_MagEphemInfo_SetStageHooks( Lgm_StageHooks *Hooks, Lgm_MagEphemInfo *MagEphemInfo );
+void    Lgm_MagEphemInfo_SetResultsCache( Lgm_ResultsCache *rc, Lgm_MagEphemInfo *MagEphemInfo );
+unsigned long Lgm_ResultsCache_Key( Lgm_Vector *u, Lgm_MagEphemInfo *MagEphemInfo );
+int     Lgm_ResultsCache_GetAll( unsigned long Key, Lgm_MagEphemInfo *MagEphemInfo );
+int     Lgm_ResultsCache_GetPA( unsigned long Key, int i, Lgm_MagEphemInfo *MagEphemInfo );
+void    Lgm_ResultsCache_PutEpoch( unsigned long Key, double LSimple, Lgm_MagEphemInfo *MagEphemInfo );
+void    Lgm_ResultsCache_PutPA( unsigned long Key, int i, Lgm_MagEphemInfo *MagEphemInfo );
 
 void    ReadMagEphemInfoStruct( char *Filename, int *nPitchAngles, Lgm_MagEphemInfo *MagEphemInfo );
 void    WriteMagEphemInfoStruct( char *Filename, int nPitchAngles, Lgm_MagEphemInfo *MagEphemInfo );
+size_t  Lgm_MagEphemInfo_PackedSize( int nPitchAngles, Lgm_MagEphemInfo *m );
+size_t  Lgm_MagEphemInfo_Pack( int nPitchAngles, Lgm_MagEphemInfo *m, void *Buf, size_t BufSize );
+int     Lgm_MagEphemInfo_Unpack( const void *Buf, size_t Size, int *nPitchAngles, Lgm_MagEphemInfo *m );
+int     Lgm_MagEphemInfo_PackView( const void *Buf, size_t Size, Lgm_MagEphemPackView *v );
+int     Lgm_MagEphemInfo_WritePacked( int fd, int nPitchAngles, Lgm_MagEphemInfo *m );
+int     Lgm_MagEphemInfo_ReadPacked( int fd, int *nPitchAngles, Lgm_MagEphemInfo *m );
 void    Lgm_WriteMagEphemHeader( FILE *fp, char *CodeVersion, char *ExtModel, int SpiceBody,  char *Spacecraft, int IdNumber, char *IntDesig, char *CmdLine, int nAscend, Lgm_DateTime *Ascend_UTC, Lgm_Vector *Ascend_U, int nPerigee, Lgm_DateTime *Perigee_UTC, Lgm_Vector *Perigee_U, int nApogee, Lgm_DateTime *Apogee_UTC, Lgm_Vector *Apogee_U, Lgm_MagEphemInfo *m );
 void    Lgm_WriteMagEphemHeaderHdf( hid_t file, char *argp_program_version, char *ExtModel, int SpiceBody,  char *Spacecraft, int IdNumber, char *IntDesig, char *CmdLine, int nAscend, Lgm_DateTime *Ascend_UTC, Lgm_Vector *Ascend_U, int nPerigee, Lgm_DateTime *Perigee_UTC, Lgm_Vector *Perigee_U, int nApogee, Lgm_DateTime *Apogee_UTC, Lgm_Vector *Apogee_U, Lgm_MagEphemInfo *m, Lgm_MagEphemData *med  );
 void    Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp, double Dst, Lgm_MagEphemInfo *m );
+int     Lgm_MagEphemFormat_f( char *Str, size_t n, int Width, int Prec, double x );
+int     Lgm_MagEphemFormat_g( char *Str, size_t n, int Width, double x );
 void    Lgm_WriteMagEphemDataHdf( hid_t file, int iRow, int iii, Lgm_MagEphemData *m );
+void    Lgm_FlushMagEphemDataHdf( hid_t file, Lgm_MagEphemData *m );
+void    Lgm_SetMagEphemHdfOptions( size_t ChunkBytes, int nBuffer, int Deflate, int Shuffle, Lgm_MagEphemData *m );
 
 
 Lgm_MagEphemData *Lgm_InitMagEphemData( int nRows, int nPA );                                                                                                                                                                              
@@ -0,0 +1,45 @@
+#ifndef LGM_MAGEPHEM_KNOTS_H
+#define LGM_MAGEPHEM_KNOTS_H
+
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+/*
+ *  Adaptive cadence for MagEphem runs (see Lgm_MagEphemKnots.c). The results
+ *  of Lgm_ComputeLstarVersusPA() are only computed at some of the time steps
+ *  (the knots), chosen so that the steps in between can be interpolated.
+ */
+#define LGM_MEK_NONE            0   // step isnt covered (compute it)
+#define LGM_MEK_KNOT            1   // step is a knot (results copied)
+#define LGM_MEK_INTERPOLATED    2   // step was interpolated from the knots around it
+
+#define LGM_MEK_NSCALAR         19  // Pmin, Ellipsoid_Footprint_Pn, Ellipsoid_Footprint_Ps (3 each), Snorth, Ssouth, Smin, Bmin, Sb0, d2B_ds2, RofC, Mref, Mcurr, Mused
+#define LGM_MEK_NPA             5   // Lstar, I, K, Sb, Tb for each pitch angle
+
+typedef struct Lgm_MagEphemKnots {
+
+    long int    nSteps;             //!< Number of time steps (0..nSteps-1) in the run.
+    int         nAlpha;             //!< Number of pitch angles.
+    int         nV;                 //!< Values kept per knot (LGM_MEK_NSCALAR + LGM_MEK_NPA*nAlpha).
+    long int    MaxGap;             //!< Knots are never more than this many steps apart.
+    double      LstarTol;           //!< Interpolation error allowed in L*.
+    double      MlatTol;            //!< Interpolation error allowed in footpoint latitude (degrees).
+    double      RadiusTol;          //!< Intervals over which the S/C radius changes by more than this fraction are split (refines around perigee).
+
+    char        *IsKnot;            //!< IsKnot[i] is TRUE once step i has been saved.
+    int         *FieldLineType;     //!< [nSteps]
+    int         *DriftOrbitType;    //!< [nSteps*nAlpha]
+    double      *R;                 //!< [nSteps] S/C radius (Re)
+    double      *V;                 //!< [nSteps*nV] the values themselves
+
+    int         Started;            //!< FALSE until the first (regular) knots have been handed out.
+    long int    nKnots;             //!< Number of knots saved.
+
+} Lgm_MagEphemKnots;
+
+Lgm_MagEphemKnots  *Lgm_InitMagEphemKnots( long int nSteps, int nAlpha, long int MaxGap, double LstarTol, double MlatTol );
+void                Lgm_FreeMagEphemKnots( Lgm_MagEphemKnots *k );
+long int            Lgm_MagEphemKnots_Next( long int *Steps, Lgm_MagEphemKnots *k );
+void                Lgm_MagEphemKnots_Save( long int iStep, Lgm_MagEphemInfo *MagEphemInfo, Lgm_MagEphemKnots *k );
+int                 Lgm_MagEphemKnots_Fill( long int iStep, long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, Lgm_MagEphemKnots *k, Lgm_MagEphemInfo *MagEphemInfo );
+
+#endif
@@ -8,6 +8,9 @@
 #include "Lgm/Lgm_KdTree.h"
 #include "Lgm/Lgm_Constants.h"
 #include "Lgm/Lgm_RBF.h"
+#include "Lgm/Lgm_RBF_Snapshot.h"
+#include "Lgm/Lgm_FLSpline.h"
+#include "Lgm/Lgm_StageHooks.h"
 #include "Lgm/Lgm_Tsyg1996.h"
 #include "Lgm/Lgm_Tsyg2001.h"
 #include "Lgm/Lgm_Tsyg2004.h"
@@ -35,6 +38,18 @@
 #define		LGM_INSIDE_EARTH           	  -1
 #define     LGM_TARGET_HEIGHT_UNREACHABLE -2
 #define     LGM_BAD_TRACE                 -3
+#define     LGM_FIELD_LINE_UNKNOWN        -4    // Lgm_ClassifyFieldLine() could not tell
+#define     LGM_YZPLANE_INTERPOLATED       2    // Lgm_TraceToYZPlane_Grid() filled the cell in from its neighbours
+
+/*
+ * Outputs Lgm_Trace() should find (Info->TraceOutputs). Segments that arent
+ * needed arent traced. 0 is the same as LGM_TRACE_ALL.
+ */
+#define     LGM_TRACE_SOUTH                1    // Southern footpoint (v1, Ssouth, Ellipsoid_Footprint_*s)
+#define     LGM_TRACE_NORTH                2    // Northern footpoint (v2, Snorth, Ellipsoid_Footprint_*n)
+#define     LGM_TRACE_BMIN                 4    // Min-B point (v3, Pmin, Bmin, ...)
+#define     LGM_TRACE_TYPE                 8    // Trace both ends, so that the field line type returned is exact
+#define     LGM_TRACE_ALL                 15
 
 
 //#define 	LGM_MAGSTEP_KMAX	16
@@ -79,6 +94,23 @@
 #define LGM_DUNGEY      3
 
 #define LGM_MAX_INTERP_PNTS 10000
+#define LGM_ADAPTIVE_DIV_TOL 1e-5   // Default AdaptiveDivTol (see Lgm_TraceLine3())
+
+/*
+ * Number of pitch angles in the K(alpha) table made by Lgm_Setup_AlphaOfK()
+ */
+#define LGM_ALPHAOFK_NTAB   64
+
+/*
+ * Make sure the FL arrays in a Lgm_MagModelInfo can hold at least n points.
+ * Cheap when the capacity is already there; otherwise calls
+ * Lgm_MagModelInfo_ReservePnts() to grow them. Evaluates to TRUE on success.
+ */
+#define LGM_QUADPACK_WORK_OUTER     0
+#define LGM_QUADPACK_WORK_INNER     1
+#define LGM_QUADPACK_NWORK          2
+
+#define LGM_RESERVE_FL_PNTS( Info, n )  ( ((n) <= (Info)->nAllocedPnts) || Lgm_MagModelInfo_ReservePnts( (n), (Info) ) )
 
 #define LGM_RELATIVE_JUMP_METHOD 0
 #define LGM_ABSOLUTE_JUMP_METHOD 1
@@ -101,6 +133,19 @@
 #define LGM_EXTMODEL_SCATTERED_DATA5    13
 #define LGM_EXTMODEL_TU82               14
 #define LGM_EXTMODEL_OP88               15
+#define LGM_EXTMODEL_GRIDDED            16
+#define LGM_EXTMODEL_RBF_SNAPSHOT       17
+#define LGM_EXTMODEL_RBF_SNAPSHOT_PAIR  18
+
+// Precision of the external field in the batched kernels (Info->ExternalPrecision)
+#define LGM_PRECISION_DOUBLE            0
+#define LGM_PRECISION_SINGLE            1
+
+// Number of per-epoch T89 constants filled in by Lgm_T89_Params()
+#define LGM_T89_NPARAMS                 49
+
+// Info->OffloadDevice value for "dont offload" (see Lgm_B_Offload.c)
+#define LGM_OFFLOAD_NONE                -1
 
 
 
@@ -125,6 +170,9 @@
 #ifndef LGM_MAGSTEP_ODE_RK5
 #define LGM_MAGSTEP_ODE_RK5     1
 #endif
+#ifndef LGM_MAGSTEP_ODE_DP8
+#define LGM_MAGSTEP_ODE_DP8     2
+#endif
 
 typedef struct CircularBuffer {
 
@@ -138,11 +186,326 @@ typedef struct CircularBuffer {
 
 } CircularBuffer;
 
+/*
+ *  Batched (structure-of-arrays) B-field routines. See Lgm_B_Batch.c
+ */
+struct Lgm_MagModelInfo;
+typedef int (*Lgm_BfieldBatchFunc)( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, struct Lgm_MagModelInfo *Info );
+
+/*
+ *  Integrator kernels (Lgm_ModMid(), Lgm_RKCK() and their per-model instances, see Lgm_MagStepKernels.h)
+ */
+typedef int (*Lgm_ModMidFunc)( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn,
+                               int (*Mag)(Lgm_Vector *, Lgm_Vector *, struct Lgm_MagModelInfo *), struct Lgm_MagModelInfo *Info );
+typedef int (*Lgm_RKCKFunc)( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr,
+                             int (*Mag)(Lgm_Vector *, Lgm_Vector *, struct Lgm_MagModelInfo *), struct Lgm_MagModelInfo *Info );
+
+/*
+ *  B-field routines that also return the Jacobian J[i][j] = dB_i/dx_j (GSM, nT/Re). See Lgm_B_Jacobian.c
+ */
+typedef int (*Lgm_BfieldJacobianFunc)( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], struct Lgm_MagModelInfo *Info );
+
+/*
+ *  Dense output for Lgm_MagStep(). Each accepted step is kept as a cubic
+ *  Hermite segment built from the end points and the unit tangents there.
+ *  See Lgm_MagStep_DenseEval() in MagStep.c
+ */
+#ifndef LGM_MAGSTEP_NDENSE
+#define LGM_MAGSTEP_NDENSE      16          // Number of accepted steps kept in the dense output history
+#endif
+typedef struct Lgm_MagStep_DenseSeg {
+    Lgm_Vector  u0, u1;     // start and end points of the step
+    Lgm_Vector  f0, f1;     // du/dH at u0 and u1 (i.e. sgn*Bhat)
+    double      h;          // step taken (signed as Htry was)
+    double      sgn;        // sgn used for the step
+    double      Err;        // leading order estimate of the max interpolation error (Re)
+    int         Have_f1;    // f1 (and Err) are only filled in once Bhat(u1) is known
+} Lgm_MagStep_DenseSeg;
+
+/*
+ *  Gridded field cache (LGM_EXTMODEL_GRIDDED). See Lgm_B_Gridded.c
+ */
+#ifndef LGM_GRIDDED_MAX_NODES
+#define LGM_GRIDDED_MAX_NODES   4000000     // Dont refine grids beyond this many nodes (each node is 24 bytes)
+#endif
+#ifndef LGM_GRIDDED_RMIN
+#define LGM_GRIDDED_RMIN        0.05        // Nodes closer to the origin than this (in Re) are not used
+#endif
+typedef struct Lgm_GriddedField {
+
+    int             (*Bsrc)();          // Model that was gridded (also used outside of the grid)
+    int             InternalModel;      // Internal model used by Bsrc when the grid was built
+    long int        Date;               // Date the grid is valid for
+    double          UTC;                // Time the grid is valid for
+    unsigned long   ParamsHash;         // Info->ParamsHash the grid was built with (the grid isnt used once that changes)
+    double          MaxErr;             // Requested error bound (nT)
+
+    double          xmin, xmax;         // Extent of the gridded box (GSM, Re)
+    double          ymin, ymax;
+    double          zmin, zmax;
+    double          h, ih;              // Grid spacing (Re) and its inverse
+
+    int             ncx, ncy, ncz;      // Number of cells in the box in each direction
+    int             nx, ny, nz;         // Number of nodes in each direction (cells+3. I.e. includes one layer of nodes outside the box)
+    double          *R;                 // Residual field (B - Bcdip) at the nodes. Stored as x,y,z triples.
+    unsigned char   *Bad;               // Flags cells that didnt meet the error bound
+    long int        nBad;               // Number of such cells
+    void            *Shm;               // Shared memory segment R and Bad are in (see Lgm_ShmCache.c), or NULL if they are our own
+
+} Lgm_GriddedField;
+
+/*
+ *  Grids at successive model input epochs, blended in time (see
+ *  Lgm_B_GriddedSeries_Set()).
+ */
+typedef struct Lgm_GriddedFieldSeries {
+
+    int                 (*Bsrc)();          // Model that is gridded
+    double              xmin, xmax;         // Box to grid (GSM, Re)
+    double              ymin, ymax;
+    double              zmin, zmax;
+    double              h0, hmin, MaxErr;   // Grid parameters (see Lgm_B_Gridded_Build())
+    double              Cadence;            // Spacing of the input epochs (minutes)
+    int                 Persistence;        // Passed on to Lgm_get_QinDenton_at_JD()
+
+    double              JD[2];              // Epochs of G[0] and G[1]
+    Lgm_GriddedField    *G[2];              // Grids at the epochs either side of the current time
+    Lgm_GriddedField    *Blend;             // Node by node blend of G[0] and G[1] for the current time (what Info->Gridded points at)
+    long int            nBlendBad;          // Cells where the blend failed the check at the midpoint time
+
+    long int            nBuilds;            // Grids built
+    long int            nSets;              // Times blended for
+
+} Lgm_GriddedFieldSeries;
+
+
+/*
+ *  Optional evaluation counters and timers.
+ *
+ *  The Stats block below is always part of Lgm_MagModelInfo (so that the
+ *  structure layout doesnt depend on how the library was configured), but it
+ *  is only filled in when the library is configured with
+ *  --enable-instrumentation (which defines LGM_INSTRUMENT in config.h). The
+ *  LGM_STATS_* macros are what the library uses internally; they compile to
+ *  nothing unless LGM_INSTRUMENT is non-zero. Times are cumulative and in
+ *  nanoseconds. The internal model time is not included in the external model
+ *  times. See Lgm_MagModelInfo_ResetStats() and Lgm_MagModelInfo_DumpStats().
+ */
+#define LGM_STATS_NINTERNAL     4           // LGM_CDIP ... LGM_DUNGEY
+#define LGM_STATS_NEXTERNAL     19          // LGM_EXTMODEL_T87 ... LGM_EXTMODEL_RBF_SNAPSHOT_PAIR
+
+/*
+ *  Step statistics of the integrators, kept separately for each of them
+ *  (indexed by LGM_MAGSTEP_ODE_BS, _RK5, _DP8) and for each of the trace
+ *  routines below (the one that was running when the step was taken; steps
+ *  taken from anywhere else count as LGM_STATS_TRACE_OTHER).
+ */
+#define LGM_STATS_NINTEGRATORS          3
+#define LGM_STATS_TRACE_OTHER           0
+#define LGM_STATS_TRACE_TO_EARTH        1   // Lgm_TraceToEarth()
+#define LGM_STATS_TRACE_TO_SPHERICAL    2   // Lgm_TraceToSphericalEarth()
+#define LGM_STATS_TRACE_TO_MINB         3   // Lgm_TraceToMinBSurf()
+#define LGM_STATS_TRACE_TO_MIRROR       4   // Lgm_TraceToMirrorPoint(), Lgm_TraceToMirrorPoints()
+#define LGM_STATS_TRACE_LINE            5   // Lgm_TraceLine(), Lgm_TraceLine2(), 3 and 4
+#define LGM_STATS_NTRACE                6
+#define LGM_STATS_NSTEPBINS             24  // |h| bins, one per power of 2 from 2^-16 Re up (the ends collect the rest)
+#define LGM_STATS_STEPBIN0              (-16)
+typedef struct Lgm_StepStats {
+
+    long int        nAccepted;
+    long int        nRejected;
+    long int        nEvals;                 // Bfield evaluations, over the accepted steps (including their rejected tries)
+    double          SumH;                   // Sum of the accepted |h| (Re)
+    long int        hHist[LGM_STATS_NSTEPBINS];     // Accepted |h|, by power of 2
+    long int        kHist[LGM_MAGSTEP_KMAX+2];      // Extrapolation order (k) of the accepted Lgm_MagStep_BS() steps
+
+} Lgm_StepStats;
+
+typedef struct Lgm_MagModelStats {
+
+    long int        nInternal[LGM_STATS_NINTERNAL];   // Calls to each internal model
+    double          tInternal[LGM_STATS_NINTERNAL];   // Time spent in each internal model
+
+    long int        nExternal[LGM_STATS_NEXTERNAL];   // Calls to each external model
+    double          tExternal[LGM_STATS_NEXTERNAL];   // Time spent in each external model (excluding its internal part)
+
+    long int        nRBF;                   // RBF evaluations (Lgm_B_FromScatteredData*())
+    double          tRBF;
+
+    long int        nInterp;                // Interpolated evaluations (BofS() and Lgm_B_Gridded())
+    double          tInterp;
+
+    long int        nBS_Accepted;           // Steps accepted/rejected by Lgm_MagStep_BS()
+    long int        nBS_Rejected;
+    long int        nRK5_Accepted;          // Steps accepted/rejected by Lgm_MagStep_RK5()
+    long int        nRK5_Rejected;
+    long int        nDP8_Accepted;          // Steps accepted/rejected by Lgm_MagStep_DP8()
+    long int        nDP8_Rejected;
+
+    Lgm_StepStats   Steps[LGM_STATS_NINTEGRATORS][LGM_STATS_NTRACE];
+
+} Lgm_MagModelStats;
+
+/*
+ *  History of the traces done along one trajectory (e.g. a MagEphem time
+ *  series). See Lgm_TraceHistory.c. Each record remembers where a trace that
+ *  started near u ended up, so that the same trace at the next epoch can
+ *  start with a sensible step size and try a narrow bracket first.
+ */
+#define LGM_TRACEHIST_TO_EARTH      0       // Lgm_TraceToEarth()
+#define LGM_TRACEHIST_TO_MINB       1       // Lgm_TraceToMinBSurf()
+#define LGM_TRACEHIST_TO_MIRROR     2       // Lgm_TraceToMirrorPoint()
+
+typedef struct Lgm_TraceHistoryRecord {
+    int             Kind;                   // LGM_TRACEHIST_TO_EARTH, etc.
+    double          sgn;                    // Direction of the trace
+    double          Bm;                     // Mirror field (only used for LGM_TRACEHIST_TO_MIRROR)
+    Lgm_Vector      u;                      // Start point of the last trace
+    double          H0;                     // Step size the integrator asked for after the first bracketing step
+    double          S;                      // Arc length (Re) from u to where the trace ended
+    double          dS;                     // Change in S since the trace before (valid if nS > 1)
+    double          Err;                    // Error in the last linear prediction of S (valid if nS > 2)
+    int             nS;                     // Number of traces folded into this record
+    long int        Stamp;                  // Last time the record was used (oldest gets replaced)
+} Lgm_TraceHistoryRecord;
+
+typedef struct Lgm_TraceHistory {
+    double                  MaxShift;       // Start points farther apart than this (Re) are never matched
+    double                  Width;          // Smallest half width (Re) of a seeded bracket
+    int                     nRecords;
+    int                     MaxRecords;
+    long int                Stamp;
+    Lgm_TraceHistoryRecord  *Records;
+    long int                nSeeded;        // Number of traces that were given a seed
+    long int                nHits;          // Number of those whose answer was inside the seeded bracket
+} Lgm_TraceHistory;
+
+typedef struct Lgm_TraceSeed {
+    int             Valid;                  // FALSE if no matching record was found
+    double          H0;                     // First step size to try in the bracketing loop
+    double          S;                      // Predicted arc length
+    double          Width;                  // Half width of the bracket to try around S
+} Lgm_TraceSeed;
+
+/*
+ *  Min-B points over an (MLT, r) grid in the SM equatorial plane. See
+ *  Lgm_MinBMap.c. The per-point arrays are indexed by iMLT*nR + iR.
+ */
+typedef struct Lgm_MinBMap {
+    int             nMLT, nR;
+    double          *MLT;                   // [nMLT] Magnetic local times (hours)
+    double          *R;                     // [nR] Radii (Re) of the start points
+    int             *FieldLineType;         // What Lgm_Trace() returned for each point
+    Lgm_Vector      *Pmin;                  // Min-B point (GSM)
+    double          *Bmin;                  // |B| at Pmin (nT)
+    double          *FootMlat;              // SM latitude (deg) of the northern footpoint at Lgm_LossConeHeight
+} Lgm_MinBMap;
+
+/*
+ *  Precomputed CGM conversions over lat/lon grids at a set of radii, for one
+ *  epoch and field model. See Lgm_CgmGrid.c. Map arrays are [iR][iLat][iLon],
+ *  with node (i, j) at latitude Lat0 + i*dLat and longitude j*dLon.
+ */
+typedef struct Lgm_CgmGridMap {
+    int             nLat, nLon;
+    double          Lat0, dLat, dLon;       // Degrees
+    int             PoleLo, PoleHi;         // The first/last row is a pole (so the grid can be reflected across it)
+    double          ***A, ***B;             // Output latitude and longitude (deg) at the nodes (LGM_FILL_VALUE if tracing failed)
+    double          ***Err;                 // Estimated error (deg) of cell (i..i+1, j..j+1) (LGM_FILL_VALUE if it cant be interpolated)
+} Lgm_CgmGridMap;
+
+typedef struct Lgm_CgmGrid {
+    long int        Date;                   // Epoch the grid was made for
+    double          UTC;
+    int             nR;
+    double          *R;                     // [nR] Radii of the levels (Re)
+    double          MaxErr;                 // Cells with a larger estimated error (deg) are traced exactly
+    Lgm_CgmGridMap  Fwd;                    // (geo lat, lon) -> (CgmLat, CgmLon)
+    Lgm_CgmGridMap  Inv;                    // (CgmLat, CgmLon) -> (geo lat, lon)
+} Lgm_CgmGrid;
+
+/*
+ *  A field line of a pure centered (or eccentric) dipole. See Lgm_Dipole.c.
+ *  Latitudes along the line are measured in the dipole's own frame (SM
+ *  axes, origin at the dipole center).
+ */
+typedef struct Lgm_DipoleFL {
+    double          L;                      // Equatorial radius of the line (Re)
+    double          Phi;                    // SM longitude of the line about the dipole axis (radians)
+    double          M;                      // Dipole moment (nT Re^3)
+    double          Beq;                    // |B| at the equator, M/L^3 (nT)
+    Lgm_Vector      O;                      // SM position of the dipole center (Re)
+} Lgm_DipoleFL;
+
+/*
+ *  A field line of the Dungey field (dipole plus constant SM Bz). See
+ *  Lgm_Dungey.c. Each line lies on a surface of constant flux function Psi.
+ */
+typedef struct Lgm_DungeyFL {
+    double          M;                      // Dipole moment (nT Re^3)
+    double          dB;                     // Constant SM Bz (nT)
+    double          rN;                     // Radius of the equatorial neutral ring, (-M/dB)^(1/3) (Re)
+    double          PsiX;                   // Psi on the separatrix, 3M/(2rN) (nT Re)
+    double          Psi;                    // Flux function of the line, cos^2(Lat) (M/r - dB r^2/2) (nT Re)
+    double          Phi;                    // SM longitude of the line (radians)
+} Lgm_DungeyFL;
+
+typedef struct Lgm_StatsTraceScope { struct Lgm_MagModelInfo *Info; int Saved; } Lgm_StatsTraceScope;
+void Lgm_MagModelInfo_StatsTraceEnd( Lgm_StatsTraceScope *Scope );
+
+#if defined(LGM_INSTRUMENT) && LGM_INSTRUMENT
+#include <time.h>
+static inline double Lgm_Stats_Clock( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( 1e9*(double)ts.tv_sec + (double)ts.tv_nsec );
+}
+#define LGM_STATS_START( t0 )                       double t0 = Lgm_Stats_Clock()
+#define LGM_STATS_STOP( Info, What, t0 )            { ++(Info)->Stats.n##What; (Info)->Stats.t##What += Lgm_Stats_Clock() - (t0); }
+#define LGM_STATS_STOP_MODEL( Info, What, k, t0 )   { if ( ((k)>=0) && ((k)<(int)(sizeof((Info)->Stats.n##What)/sizeof(long int))) ) { ++(Info)->Stats.n##What[k]; (Info)->Stats.t##What[k] += Lgm_Stats_Clock() - (t0); } }
+#define LGM_STATS_COUNT( Info, What )               ++(Info)->Stats.n##What
+#define LGM_STATS_STEP_BEGIN( Info, n0 )            long int n0 = (Info)->Lgm_nMagEvals
+#define LGM_STATS_STEP_ACCEPT( Info, Ode, h, k, n0 ) Lgm_MagModelInfo_StepStats( Info, Ode, h, k, (Info)->Lgm_nMagEvals - (n0) )
+#define LGM_STATS_STEP_REJECT( Info, Ode )          ++(Info)->Stats.Steps[Ode][(Info)->StatsTrace].nRejected
+/*
+ *  Put at the end of the declarations of a trace routine: steps taken until
+ *  it returns are counted under Which (and the previous routine is restored
+ *  when it returns, however it does so).
+ */
+#define LGM_STATS_TRACE( Info, Which ) \
+    Lgm_StatsTraceScope Lgm_StatsTrace_ __attribute__((cleanup(Lgm_MagModelInfo_StatsTraceEnd))) = { (Info), (Info)->StatsTrace }; \
+    (Info)->StatsTrace = (Which)
+#else
+#define LGM_STATS_START( t0 )
+#define LGM_STATS_STOP( Info, What, t0 )
+#define LGM_STATS_STOP_MODEL( Info, What, k, t0 )
+#define LGM_STATS_COUNT( Info, What )
+#define LGM_STATS_STEP_BEGIN( Info, n0 )
+#define LGM_STATS_STEP_ACCEPT( Info, Ode, h, k, n0 )
+#define LGM_STATS_STEP_REJECT( Info, Ode )
+#define LGM_STATS_TRACE( Info, Which )
+#endif
+
+/*
+ *  Model data that is read-only once it has been set up, so that every copy
+ *  of a Lgm_MagModelInfo (in particular the per-thread contexts made by
+ *  Lgm_NewMagContext()) can share one instance of it instead of holding its
+ *  own. Reference counted; the last Lgm_FreeMagInfo() frees it.
+ */
+typedef struct Lgm_MagModelConfig {
+    int         nRef;               // Number of Lgm_MagModelInfo structures sharing this
+    double      **TS07_TSS;         // TS07D tail coeffs [81][6]    (TS07_Info.TSS points here)
+    double      ***TS07_TSO;        // TS07D tail coeffs [81][6][5] (TS07_Info.TSO points here)
+    double      ***TS07_TSE;        // TS07D tail coeffs [81][6][5] (TS07_Info.TSE points here)
+} Lgm_MagModelConfig;
+
 typedef struct Lgm_MagModelInfo {
 
     Lgm_CTrans  *c;                 /* This contains all time info and a bunch more stuff */
     long int	nFunc;
     int 		(*Bfield)();
+    Lgm_BfieldBatchFunc BfieldBatch; /* Optional batched version of Bfield. If NULL, Lgm_B_Batch() picks the native one for Bfield (if any). */
+    Lgm_BfieldJacobianFunc BfieldWithJacobian; /* Optional B + dB/dx version of Bfield. If NULL, Lgm_B_Jacobian() picks the native one for Bfield (if any) or differences Bfield. */
     int			SavePoints;
     double		Hmax;
     FILE	    *fp;
@@ -153,6 +516,8 @@ typedef struct Lgm_MagModelInfo {
     double      V, Den, P;
     double      Bx, By, Bz;
     double      T96MOD_V[11];       /* free params for T96_MOD */
+    unsigned long ParamsHash;       // Lgm_ModelParamsHash() as of the last Lgm_set_QinDenton() (or Lgm_B_Gridded_Build()). 0 if never set.
+    long int    ParamsGeneration;   // Bumped by Lgm_set_QinDenton() each time ParamsHash changes
 
     double      Trace_s;
 
@@ -166,6 +531,8 @@ typedef struct Lgm_MagModelInfo {
      */
     int         InternalModel;          // Can be LGM_CDIP, LGM_EDIP or LGM_IGRF
     int         ExternalModel;          // Can be from list above (e.g. LGM_EXTMODEL_T89)
+    int         ExternalPrecision;      // LGM_PRECISION_DOUBLE (default) or LGM_PRECISION_SINGLE (float external field in the batched kernels that have it, see Lgm_T89_External_Batch_f32())
+    int         OffloadDevice;          // OpenMP target device for the batched kernels and Lgm_TraceToEarth_Multi(), or LGM_OFFLOAD_NONE (default). See Lgm_B_Offload.c
 
     /*
      * Temporary variable to hold a generic position
@@ -184,20 +551,37 @@ typedef struct Lgm_MagModelInfo {
     Lgm_Vector          Pm_North;
     double              Bm, Sm_South, Sm_North, Blocal;
     int                 FirstCall;
+
+    /*
+     *  K(alpha) on the line set up by Lgm_Setup_AlphaOfK(), which
+     *  Lgm_AlphaOfK() inverts (see Lgm_AlphaOfK.c). The arrays are fixed
+     *  size so that copies get their own table.
+     */
+    int                 AlphaOfK_nTab;                      // Number of nodes (0 if there is no table)
+    double              AlphaOfK_SqrtK[LGM_ALPHAOFK_NTAB];  // sqrt(K) at the nodes, increasing  (K in Re G^(1/2))
+    double              AlphaOfK_Alpha[LGM_ALPHAOFK_NTAB];  // Equatorial pitch angle at the nodes (Degrees)
+    double              AlphaOfK_D[LGM_ALPHAOFK_NTAB];      // dAlpha/dsqrt(K) at the nodes
+    double              AlphaOfK_Err[LGM_ALPHAOFK_NTAB];    // Error estimate of each interval (Degrees)
 //    double              epsabs, epsrel;
 
     /*
-     * Arrays containing FL vals
+     * Arrays containing FL vals. These are allocated on demand and grown as
+     * needed (see Lgm_MagModelInfo_ReservePnts()); nAllocedPnts is their
+     * current capacity. LGM_MAX_INTERP_PNTS is still the upper limit on the
+     * number of points a FL trace will store.
      */
-    double              s[LGM_MAX_INTERP_PNTS];    // distance along FL
-    double              Px[LGM_MAX_INTERP_PNTS];   // Px along FL  (in GSM)
-    double              Py[LGM_MAX_INTERP_PNTS];   // Py along FL  (in GSM)
-    double              Pz[LGM_MAX_INTERP_PNTS];   // Pz along FL  (in GSM)
-    Lgm_Vector          Bvec[LGM_MAX_INTERP_PNTS]; // 3D B-field vector   (in GSM)
-    double              Bmag[LGM_MAX_INTERP_PNTS]; // magnitude of B
-    double              BminusBcdip[LGM_MAX_INTERP_PNTS]; // magnitude of B minus magnitude of Cent. Dipole
+    double              *s;             // distance along FL
+    double              *Px;            // Px along FL  (in GSM)
+    double              *Py;            // Py along FL  (in GSM)
+    double              *Pz;            // Pz along FL  (in GSM)
+    Lgm_Vector          *Bvec;          // 3D B-field vector   (in GSM)
+    double              *Bmag;          // magnitude of B
+    double              *BminusBcdip;   // magnitude of B minus magnitude of Cent. Dipole
+    int                 nAllocedPnts;   // number of points the FL arrays can currently hold
     double              MaxDiv;     // Dont subdivide the FL length with steps bigger than this.
     int                 nDivs;      // Number of divisions of FL length to try to make (actual number of points defined may be different as MAxDiv mux be respected.)
+    int                 AdaptiveDivs;   // If TRUE, Lgm_TraceLine3() spaces its points by a bound on the interpolation error of B(s) rather than evenly.
+    double              AdaptiveDivTol; // The bound for AdaptiveDivs, as a fraction of the largest B on the line.
     int                 nPnts;      // actual number of points defined
     double              ds;         // spacing in s (dist. along FL)
                                     // this will help in seacrhing the
@@ -255,17 +639,11 @@ typedef struct Lgm_MagModelInfo {
 
 
     /*
-     *  GSL defs for spline interpolation
+     *  Interpolants of BminusBcdip, Px, Py and Pz along the stored FL (see
+     *  InitSpline() and Lgm_FLSpline.c)
      */
-    int                 AllocedSplines;     // Flag to indicate that we have alloced splines (via gsl)
-    gsl_interp_accel    *acc;               // accelerator
-    gsl_interp_accel    *accPx;             // accelerator
-    gsl_interp_accel    *accPy;             // accelerator
-    gsl_interp_accel    *accPz;             // accelerator
-    gsl_spline          *spline;            // spline object
-    gsl_spline          *splinePx;          // spline object
-    gsl_spline          *splinePy;          // spline object
-    gsl_spline          *splinePz;          // spline object
+    int                 AllocedSplines;     // Flag to indicate that FLSpline is set up for the current FL points
+    Lgm_FLSpline        FLSpline;
 
 
     /*
@@ -273,10 +651,18 @@ typedef struct Lgm_MagModelInfo {
      */
     int                 VerbosityLevel;
     int                 UseInterpRoutines; // whether to use fast I and Sb routines.
+    int                 UseDipoleFastPath; // if TRUE, closed-form results are used for pure dipole and Dungey fields (see Lgm_Dipole.c, Lgm_Dungey.c)
+    int                 ConcurrentTrace;   // if TRUE, Lgm_Trace() does its north/south/Bmin traces as parallel tasks (OpenMP builds only)
+    int                 PreClassifyFieldLines; // if TRUE, Lgm_Trace() uses Lgm_ClassifyFieldLine() to skip full traces of open ends
+    int                 TraceOutputs;      // OR of LGM_TRACE_* flags. What Lgm_Trace() should find (LGM_TRACE_ALL by default)
 
 
     long int    Lgm_nMagEvals;          // records number of Bfield evals between resets
-    int         Lgm_MagStep_Integrator; // ODE solver to use ( LGM_MAGSTEP_ODE_BS or LGM_MAGSTEP_ODE_RK5)
+    long int    Lgm_nMagEvalsTotal;     // evals before the last reset (so LGM_NMAGEVALS_TOTAL() keeps counting across traces)
+    Lgm_MagModelStats   Stats;      // per-model counters and timers (only filled in when built with LGM_INSTRUMENT)
+    int         StatsTrace;             // trace routine that Stats.Steps[][] are being counted under (LGM_STATS_TRACE_*)
+    Lgm_StageHooks      *Hooks;     // stage callbacks (see Lgm_StageHooks.c), shared by copies; NULL if none. Not owned.
+    int         Lgm_MagStep_Integrator; // ODE solver to use ( LGM_MAGSTEP_ODE_BS, LGM_MAGSTEP_ODE_RK5 or LGM_MAGSTEP_ODE_DP8)
 
     /*
      *  Vars for Bulirsch-Stoer ODE solver. Some of these variables are needed
@@ -326,6 +712,46 @@ typedef struct Lgm_MagModelInfo {
     double      Lgm_MagStep_RK5_ErrCon;
     double      Lgm_MagStep_RK5_Eps;        // Eps parameter used in RK5 method. Influences speed greatly.
 
+    /*
+     *  Vars for the Dormand-Prince 8(5,3) solver, Lgm_MagStep_DP8().
+     */
+    double      Lgm_MagStep_DP8_atol;       // absolute/relative tolerances (as for BS)
+    double      Lgm_MagStep_DP8_rtol;
+    double      Lgm_MagStep_DP8_Safety;
+    double      Lgm_MagStep_DP8_Beta;       // PI controller parameter (0.0 gives a plain I controller)
+    double      Lgm_MagStep_DP8_FacMin;     // limits on h_new/h
+    double      Lgm_MagStep_DP8_FacMax;
+    int         Lgm_MagStep_DP8_MaxCount;   // max number of tries per step
+    double      Lgm_MagStep_DP8_ErrOld;     // error of the last accepted step (for the PI controller)
+    Lgm_Vector  Lgm_MagStep_DP8_P;          // point and unit tangent of the last first stage (FSAL reuse)
+    Lgm_Vector  Lgm_MagStep_DP8_b;
+    int         Lgm_MagStep_DP8_bValid;
+    int         (*Lgm_MagStep_DP8_Mag)();
+
+    /*
+     *  Dense output for Lgm_MagStep(). Off by default. When on, each
+     *  accepted step is saved as an interpolant and the unit tangent at the
+     *  start of a step is shared with the end of the step before it.
+     */
+    int                  Lgm_MagStep_DenseOutput;                       // If TRUE, keep dense output history (see Lgm_MagStep_DenseEval())
+    double               Lgm_MagStep_DenseTol;                          // Dont use a segment whose estimated interpolation error (Re) is bigger than this
+    int                  Lgm_MagStep_nDense;                            // Number of valid segments in the history
+    int                  Lgm_MagStep_iDense;                            // Index of most recent segment
+    Lgm_MagStep_DenseSeg Lgm_MagStep_DenseSegs[LGM_MAGSTEP_NDENSE];    // Ring buffer of accepted steps
+    int                  Lgm_MagStep_Dense_bValid;                      // TRUE if Lgm_MagStep_Dense_b holds Bhat at Lgm_MagStep_Dense_P
+    Lgm_Vector           Lgm_MagStep_Dense_P;
+    Lgm_Vector           Lgm_MagStep_Dense_b;
+    int                  (*Lgm_MagStep_Dense_Mag)();                    // Field routine Lgm_MagStep_Dense_b was computed with
+
+    /*
+     *  Integrator kernels for the field routine Lgm_MagStep_Kernel_Mag (and
+     *  internal model Lgm_MagStep_Kernel_Internal). See Lgm_MagStep_SelectKernels().
+     */
+    int                  (*Lgm_MagStep_Kernel_Mag)();
+    int                  Lgm_MagStep_Kernel_Internal;
+    Lgm_ModMidFunc       Lgm_MagStep_ModMid;
+    Lgm_RKCKFunc         Lgm_MagStep_RKCK;
+
     /*
      *  These variables are needed to make Lgm_MagStep2() reentrant/thread-safe.
      *  They basically used to be static declarations within Lgm_MagStep2()
@@ -365,6 +791,7 @@ typedef struct Lgm_MagModelInfo {
 
     double      Lgm_I_Integrator_epsrel;        // Quadpack epsrel tolerance for I_integrator
     double      Lgm_I_Integrator_epsabs;        // Quadpack epsabs tolerance for I_integrator
+    int         Lgm_GradI_Method;               // LGM_GRAD_I_PERTURB (default) or LGM_GRAD_I_FD. See Lgm_Grad_I().
 
     /*
      *  These variables are needed to make Sb_integrand() reentrant/thread-safe.
@@ -401,6 +828,18 @@ typedef struct Lgm_MagModelInfo {
     double      Lgm_LambdaIntegral_Integrator_epsabs;
 
 
+    /*
+     *  QuadPack work space used by Iinv(), SbIntegral(), MagFlux(), etc. (see
+     *  Lgm_MagModelInfo_QuadPackWork()). Allocated the first time it is needed
+     *  and reused after that. Lgm_QuadPack_Limit is the max number of
+     *  subintervals the integrators may use. Slot LGM_QUADPACK_WORK_INNER is
+     *  for integrals done inside the integrand of another (LambdaIntegral()
+     *  inside MagFlux2()).
+     */
+    int                 Lgm_QuadPack_Limit;
+    Lgm_QuadPackWork    Lgm_QuadPack_Work[LGM_QUADPACK_NWORK];
+
+
     /*
      * Some other tolerances
      */
@@ -435,25 +874,67 @@ typedef struct Lgm_MagModelInfo {
     Lgm_KdTreeData *KdTree_kNN;
     int             KdTree_kNN_Alloced; // number of elements allocated. (0 if unallocated).
 
+    /*
+     * Gridded field cache used by Lgm_B_Gridded() (not owned by this structure)
+     */
+    Lgm_GriddedField *Gridded;
+
+    /*
+     * Precomputed RBF fits used by Lgm_B_FromRBF_Snapshot() (not owned by this structure)
+     */
+    Lgm_RBF_Snapshot *RBF_Snapshot;
+
+    /*
+     * Pair of snapshots used by Lgm_B_FromRBF_SnapshotPair() (not owned by this structure)
+     */
+    Lgm_RBF_SnapshotPair *RBF_SnapshotPair;
+
+    /*
+     * Trace history used to warm start Lgm_TraceToEarth(),
+     * Lgm_TraceToMinBSurf() and Lgm_TraceToMirrorPoint() (not owned by this
+     * structure, and not inherited by copies -- see Lgm_TraceHistory.c)
+     */
+    Lgm_TraceHistory *TraceHistory;
+
+    /*
+     * Read-only model data shared with all copies (see Lgm_MagModelConfig above)
+     */
+    Lgm_MagModelConfig *Config;
+
 
     /*
      *  hash table, etc.  used in Lgm_B_FromScatteredData*()
      */
     Lgm_DFI_RBF_Info   *rbf_ht;             // hash table (uthash)
 
-    Lgm_Vec_RBF_Info   *vec_rbf_ht;         // hash table (uthash)
+    Lgm_Vec_RBF_Info   *vec_rbf_ht;         // hash table (uthash). The E fits hang off the B ones (rbf->rbf_e).
     double             vec_rbf_ht_size;     // hash table size in MB
     double             vec_rbf_ht_maxsize;  // hash table max size in MB
     CircularBuffer     RBF_CB;
 
-    Lgm_Vec_RBF_Info   *vec_rbf_e_ht;       // hash table (uthash)
-    double             vec_rbf_e_ht_size;   // hash table size in MB
-    double             vec_rbf_e_ht_maxsize;// hash table max size in MB
-    CircularBuffer     RBF_E_CB;
-
     int                 rbf_ht_alloced;     // Flag to indicate whether or not rbf_ht is allocated with data.
     long int            RBF_nHashFinds;     // Number of HASH_FIND()'s performed.
     long int            RBF_nHashAdds;      // Number of HASH_ADD_KEYPTR()'s performed.
+    Lgm_RBF_Cache       *RBF_Cache;         // If set, used instead of vec_rbf_ht. Shared by copies, not owned (see Lgm_RBF_Cache.c).
+
+    /*
+     *  The last kNN set (and its fits) found by Lgm_B_FromScatteredData5().
+     *  It is reused without searching the KdTree while the query point stays
+     *  within RBF_Last_Slack of RBF_Last_q (see
+     *  Lgm_B_FromScatteredData_ResetLast()). Not inherited by copies.
+     */
+    int                 RBF_Last_Valid;
+    double              RBF_Last_q[3];      // Point the last kNN search was done at
+    double              RBF_Last_Slack;     // Half the gap between the K-th and (K+1)-th neighbor distances
+    int                 RBF_Last_K;         // KdTree_kNN_k, KdTree_kNN_MaxDist2, KdTree and RBF_Cache used for the last search
+    double              RBF_Last_MaxDist2;
+    Lgm_KdTree          *RBF_Last_KdTree;
+    Lgm_RBF_Cache       *RBF_Last_Cache;
+    Lgm_Vec_RBF_Info    *RBF_Last_rbf;
+    Lgm_Vec_RBF_Info    *RBF_Last_rbf_e;
+    Lgm_RBF_CacheEntry  *RBF_Last_Entry;    // Held (not released) while it is the last set, if RBF_Cache is used
+    long int            RBF_nReuses;        // Number of calls that reused the last kNN set.
+
     Lgm_Vector          RBF_dBdx;           // deriv of B-vec wrt x computed using RBF.
     Lgm_Vector          RBF_dBdy;           // deriv of B-vec wrt y computed using RBF.
     Lgm_Vector          RBF_dBdz;           // deriv of B-vec wrt z computed using RBF.
@@ -489,6 +970,12 @@ typedef struct Lgm_MagModelInfo {
     double OP77_TILTL;
     double OP77_A[65], OP77_B[65], OP77_C[45], OP77_D[45], OP77_E[65], OP77_F[65], OP77_TT[5];
 
+    /*
+     *  OP88 dynamic scalings, and the Den, V and Dst they were computed for
+     */
+    double OP88_DEN, OP88_VEL, OP88_DST;
+    double OP88_SCL, OP88_STRMAG, OP88_STRRIN, OP88_STRTAI;
+
 
     /*
      *  Info structure for T96
@@ -526,6 +1013,12 @@ typedef struct Lgm_MagModelInfo {
 
 } Lgm_MagModelInfo;
 
+/*
+ *  Field evaluations made by the tracers since Info was made (Lgm_nMagEvals
+ *  alone starts again at every trace).
+ */
+#define LGM_NMAGEVALS_TOTAL( Info )     ( (Info)->Lgm_nMagEvalsTotal + (Info)->Lgm_nMagEvals )
+
 typedef struct BrentFuncInfoP {
 
     Lgm_Vector          u_scale;
@@ -556,17 +1049,48 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo );
 void Lgm_FreeMagInfo_children( Lgm_MagModelInfo  *Info );
 void Lgm_FreeMagInfo( Lgm_MagModelInfo  *Info );
 Lgm_MagModelInfo *Lgm_CopyMagInfo( Lgm_MagModelInfo *s );
+Lgm_MagModelInfo *Lgm_CloneMagInfo( Lgm_MagModelInfo *s );
+Lgm_MagModelInfo *Lgm_NewMagContext( Lgm_MagModelInfo *s );
+int  Lgm_CopyMagInfoInto( Lgm_MagModelInfo *t, Lgm_MagModelInfo *s, int CopyPnts );
+Lgm_MagModelConfig *Lgm_MagModelConfig_Retain( Lgm_MagModelConfig *Config );
+void Lgm_MagModelConfig_Release( Lgm_MagModelConfig *Config );
+int  Lgm_MagModelInfo_ReservePnts( int n, Lgm_MagModelInfo *Info );
+void Lgm_MagModelInfo_FreePnts( Lgm_MagModelInfo *Info );
+Lgm_QuadPackWork *Lgm_MagModelInfo_QuadPackWork( int k, Lgm_MagModelInfo *Info );
+void Lgm_MagModelInfo_ResetStats( Lgm_MagModelInfo *Info );
+void Lgm_MagModelInfo_DumpStats( FILE *fp, Lgm_MagModelInfo *Info );
+void Lgm_MagModelInfo_AddStats( Lgm_MagModelInfo *Dst, Lgm_MagModelInfo *Src );
+void Lgm_MagModelInfo_StepStats( Lgm_MagModelInfo *Info, int Ode, double h, int k, long int nEvals );
+
+Lgm_TraceHistory *Lgm_InitTraceHistory( double MaxShift, int MaxRecords );
+void Lgm_FreeTraceHistory( Lgm_TraceHistory *h );
+void Lgm_ResetTraceHistory( Lgm_TraceHistory *h );
+void Lgm_MagModelInfo_Set_TraceHistory( Lgm_TraceHistory *h, Lgm_MagModelInfo *m );
+int  Lgm_TraceHistory_Get( int Kind, double sgn, double Bm, Lgm_Vector *u, Lgm_TraceSeed *Seed, Lgm_MagModelInfo *Info );
+void Lgm_TraceHistory_Put( int Kind, double sgn, double Bm, Lgm_Vector *u, double H0, double S, Lgm_TraceSeed *Seed, Lgm_MagModelInfo *Info );
+double Lgm_TraceSeed_Step( Lgm_TraceSeed *Seed, double S, double Htry );
+
+Lgm_MinBMap *Lgm_InitMinBMap( int nMLT, int nR, double R0, double R1 );
+void Lgm_FreeMinBMap( Lgm_MinBMap *Map );
+int  Lgm_ComputeMinBMap( Lgm_MinBMap *Map, Lgm_MagModelInfo *m );
+int  Lgm_MinBMap_FootMlat( Lgm_MinBMap *Map, double MLT, double Bmin, double *mlat );
 
 int  Lgm_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, double TOL1, double TOL2, Lgm_MagModelInfo *Info );
+int  Lgm_ClassifyFieldLine( Lgm_Vector *u, double Height, int *OpenNorth, int *OpenSouth, Lgm_Vector *vNorth, Lgm_Vector *vSouth, Lgm_MagModelInfo *Info );
 int  Lgm_TraceToMinBSurf( Lgm_Vector *, Lgm_Vector *, double, double, Lgm_MagModelInfo * );
 int  Lgm_TraceToSMEquat(  Lgm_Vector *, Lgm_Vector *, double, Lgm_MagModelInfo * );
 int  Lgm_TraceToEarth(  Lgm_Vector *, Lgm_Vector *, double, double, double, Lgm_MagModelInfo * );
 int  Lgm_TraceToSphericalEarth(  Lgm_Vector *, Lgm_Vector *, double, double, double, Lgm_MagModelInfo * );
+int  Lgm_TraceToEarthAndSphere(  Lgm_Vector *, Lgm_Vector *, Lgm_Vector *, double, double, double, double *, Lgm_MagModelInfo * );
+int  Lgm_TraceToEarth_Multi( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int *Flag, double *S, Lgm_MagModelInfo *Info );
+int  Lgm_TraceToSphericalEarth_Multi( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int *Flag, double *S, Lgm_MagModelInfo *Info );
 int  Lgm_TraceLine(  Lgm_Vector *, Lgm_Vector *, double, double, double, int, Lgm_MagModelInfo * );
 int  Lgm_TraceLine2(  Lgm_Vector *, Lgm_Vector *, double, double, double, double, int, Lgm_MagModelInfo * );
 int  Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int AddBminPoint, Lgm_MagModelInfo *Info );
 int  Lgm_TraceLine4( Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, double dSa, double dSb, int N, int AddBminPoint, Lgm_MagModelInfo *Info );
 int   Lgm_TraceToYZPlane( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn_in, double tol, Lgm_MagModelInfo *Info );
+int   Lgm_TraceToYZPlane_Seeded( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn_in, double tol, Lgm_TraceSeed *Seed, double *S, Lgm_MagModelInfo *Info );
+int   Lgm_TraceToYZPlane_Grid( int nRows, int nCols, Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn, double tol, int Interp, int *Flag, Lgm_MagModelInfo *Info );
 
 int  ReplaceFirstPoint( double s, double B, Lgm_Vector *P, Lgm_MagModelInfo *Info );
 int  ReplaceLastPoint( double s, double B, Lgm_Vector *P, Lgm_MagModelInfo *Info );
@@ -576,6 +1100,7 @@ int  FreeSpline( Lgm_MagModelInfo *Info );
 int  Lgm_TraceToMinRdotB( Lgm_Vector *, Lgm_Vector *, double, Lgm_MagModelInfo * );
 int  Lgm_TraceIDL( int, void *argv[] );
 int  Lgm_TraceToMirrorPoint( Lgm_Vector *u, Lgm_Vector *v, double *Sm, double Bm, double sgn, double tol, Lgm_MagModelInfo *Info );
+int  Lgm_TraceToMirrorPoints( Lgm_Vector *u, int n, double *Bm, double *Sm_s, double *Sm_n, Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, Lgm_MagModelInfo *Info );
 
 
 int  Lgm_MagStep( Lgm_Vector *, Lgm_Vector *, double, double *, double *, double, double *, int *,
@@ -584,6 +1109,15 @@ int  Lgm_MagStep_BS( Lgm_Vector *, Lgm_Vector *, double, double *, double *, dou
               int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo * );
 int  Lgm_MagStep_RK5( Lgm_Vector *, Lgm_Vector *, double, double *, double *, double, double, double *, int *,
               int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo * );
+int  Lgm_MagStep_DP8( Lgm_Vector *, Lgm_Vector *, double, double *, double *, double, double, double *, int *,
+              int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo * );
+void Lgm_MagStep_SetDenseOutput( int Flag, Lgm_MagModelInfo *Info );
+void Lgm_MagStep_ClearDense( Lgm_MagModelInfo *Info );
+void Lgm_MagStep_ResetState( Lgm_MagModelInfo *Info );
+int  Lgm_MagStep_DenseLast( Lgm_MagStep_DenseSeg *Seg, Lgm_MagModelInfo *Info );
+int  Lgm_MagStep_DenseSegEval( Lgm_MagStep_DenseSeg *Seg, double ds, Lgm_Vector *u );
+int  Lgm_MagStep_DenseEval( Lgm_Vector *P0, double ds, double sgn, Lgm_Vector *u, Lgm_MagModelInfo *Info );
+int  Lgm_MagStep_TangentAt( Lgm_Vector *u, Lgm_Vector *b, int reset, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
 
 /*
  * For Bulirsch-Stoer FL tracer
@@ -608,6 +1142,19 @@ void Lgm_PolFunExt( int, double, Lgm_Vector *, Lgm_Vector *, Lgm_Vector *, Lgm_M
 int Lgm_RKCK( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr,
         int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
 
+/*
+ *  Model-specific instances of Lgm_ModMid() and Lgm_RKCK() (see Lgm_MagStepKernels.h)
+ */
+void Lgm_MagStep_SelectKernels( int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_ModMid_T89_IGRF( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_RKCK_T89_IGRF( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_ModMid_T96_IGRF( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_RKCK_T96_IGRF( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_ModMid_TS04_IGRF( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_RKCK_TS04_IGRF( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_ModMid_CDIP( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+int Lgm_RKCK_CDIP( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info );
+
 
 
 /*
@@ -621,6 +1168,93 @@ int Lgm_B_edip(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *);
 int Lgm_B_JensenCain1960(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *);
 
 
+/*
+ *  Batched (structure-of-arrays) field evaluation
+ */
+int Lgm_B_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_Generic_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_igrf_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_cdip_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_edip_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_T89_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_T96_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_TS04_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_OP77_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int Lgm_B_OP88_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+Lgm_BfieldBatchFunc Lgm_Native_BfieldBatch( int (*Bfield)() );
+int Lgm_B_SeparableInternalModel( Lgm_MagModelInfo *Info );
+int Lgm_B_AddExternal_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+
+
+/*
+ *  Batched field evaluation and field line tracing on an OpenMP target device (see Lgm_B_Offload.c)
+ */
+int  Lgm_Offload_nDevices( void );
+int  Lgm_MagModelInfo_Set_Offload( int Device, Lgm_MagModelInfo *m );
+int  Lgm_B_Offload_Supported( Lgm_MagModelInfo *Info );
+int  Lgm_B_Offload_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
+int  Lgm_TraceToEarth_Offload( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int Spherical, int *Flag, double *S, Lgm_MagModelInfo *Info );
+
+
+/*
+ *  Field evaluation with Jacobian
+ */
+int Lgm_B_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], int DerivScheme, double h, Lgm_MagModelInfo *Info );
+int Lgm_B_Jacobian_FD( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], int DerivScheme, double h, Lgm_MagModelInfo *Info );
+int Lgm_B_Internal_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+int Lgm_B_igrf_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+int Lgm_B_cdip_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+int Lgm_B_edip_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+int Lgm_B_Dungey_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+int Lgm_B_T89_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info );
+Lgm_BfieldJacobianFunc Lgm_Native_BfieldWithJacobian( int (*Bfield)() );
+
+
+/*
+ *  Gridded field cache
+ */
+Lgm_GriddedField *Lgm_B_Gridded_Build( int (*Bsrc)(), double xmin, double xmax, double ymin, double ymax, double zmin, double zmax, double h0, double hmin, double MaxErr, Lgm_MagModelInfo *Info );
+void Lgm_FreeGriddedField( Lgm_GriddedField *G );
+void Lgm_MagModelInfo_Set_Gridded( Lgm_GriddedField *G, Lgm_MagModelInfo *m );
+int  Lgm_B_Gridded( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+Lgm_GriddedFieldSeries *Lgm_B_GriddedSeries_Init( int (*Bsrc)(), double xmin, double xmax, double ymin, double ymax, double zmin, double zmax, double h0, double hmin, double MaxErr, double Cadence, int Persistence );
+void Lgm_FreeGriddedFieldSeries( Lgm_GriddedFieldSeries *S );
+int  Lgm_B_GriddedSeries_Set( Lgm_GriddedFieldSeries *S, Lgm_MagModelInfo *Info );
+
+/*
+ *  Keys of the model state for caches (see Lgm_ModelState.c)
+ */
+#define LGM_MODELSTATE_INPUTS   1       // The model and the inputs it uses
+#define LGM_MODELSTATE_TIME     2       // The time (tilt, IGRF coefficients, ...)
+#define LGM_MODELSTATE_TOLS     4       // Tracing tolerances and the loss cone height
+#define LGM_MODELSTATE_PORTABLE 8       // Same key in every process (null key for unknown models)
+#define LGM_MODELSTATE_ALL      ( LGM_MODELSTATE_INPUTS | LGM_MODELSTATE_TIME | LGM_MODELSTATE_TOLS )
+#ifndef LGM_MODELSTATE_BITS
+#define LGM_MODELSTATE_BITS     40      // Significant bits doubles are rounded to before they are hashed
+#endif
+typedef struct Lgm_ModelKey {
+    unsigned long   Lo, Hi;
+} Lgm_ModelKey;
+#define Lgm_ModelKey_IsNull( k )        ( ( (k).Lo == 0 ) && ( (k).Hi == 0 ) )
+#define Lgm_ModelKey_Equal( a, b )      ( ( (a).Lo == (b).Lo ) && ( (a).Hi == (b).Hi ) )
+Lgm_ModelKey  Lgm_ModelKey_Init( void );
+void          Lgm_ModelKey_Add( Lgm_ModelKey *k, const void *p, size_t n );
+void          Lgm_ModelKey_AddDouble( Lgm_ModelKey *k, double x );
+unsigned long Lgm_ModelKey_Fold( Lgm_ModelKey k );
+Lgm_ModelKey  Lgm_ModelState_Key( int (*Bfield)(), int Flags, Lgm_MagModelInfo *m );
+int           Lgm_ModelState_Changed( Lgm_ModelKey *Key, int Flags, Lgm_MagModelInfo *m );
+unsigned long Lgm_ModelParamsHash( int (*Bfield)(), Lgm_MagModelInfo *m );
+unsigned long Lgm_ModelFingerprint( int (*Bfield)(), Lgm_MagModelInfo *m );
+
+/*
+ *  Precomputed RBF fits to scattered data (see Lgm/Lgm_RBF_Snapshot.h)
+ */
+void Lgm_MagModelInfo_Set_RBF_Snapshot( Lgm_RBF_Snapshot *s, Lgm_MagModelInfo *m );
+int  Lgm_B_FromRBF_Snapshot( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void Lgm_MagModelInfo_Set_RBF_SnapshotPair( Lgm_RBF_SnapshotPair *p, Lgm_MagModelInfo *m );
+int  Lgm_B_FromRBF_SnapshotPair( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+
+
 
 /*
  *
@@ -629,6 +1263,7 @@ int Lgm_B_JensenCain1960(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *);
  */
 int Lgm_B_OP77( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
 void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo *m );
+void Lgm_OP77_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *m );
 
 
 /*
@@ -644,6 +1279,8 @@ void    Lgm_OP88_BFTAIL( double *XX,  double *BB );
 void    Lgm_OP88_BFRING( double *XX,  double *BB );
 double  Lgm_OP88_RINGST( double SOFFD,  double DST );
 double  Lgm_OP88_STDOFF( double VEL,  double DEN );
+int     Lgm_OP88_External( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void    Lgm_OP88_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
 
 
 
@@ -678,6 +1315,9 @@ int Lgm_BT_T89( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
 int Lgm_BRC_T89( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
 int Lgm_BC_T89( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
 int Lgm_B_T89( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
+int Lgm_T89_External( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
+void Lgm_T89_Params( double *q, Lgm_MagModelInfo *Info );
+void Lgm_T89_External_Batch_f32( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info );
 
 
 /*
@@ -707,6 +1347,7 @@ void lgm_field_t96mod_( int *, int *, int *, int *, double *, double *, double *
  *  Function Prototypes for T96 model
  */
 int  Lgm_B_T96( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void Lgm_T96_Prepare( Lgm_MagModelInfo *Info );
 void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg1996_Info *tInfo );
 
 /*
@@ -715,6 +1356,7 @@ void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
  *  Function Prototypes for TS04 model
  */
 int  Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void Lgm_TS04_Prepare( Lgm_MagModelInfo *Info );
 void Tsyg_TS04( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2004_Info *tInfo );
 
 /*
@@ -735,8 +1377,10 @@ void Tsyg_TS07( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
 double mypow( double, double );
 void   Lgm_Init_T01S( LgmTsyg2001_Info *t );
 int    Lgm_B_T01S( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void   Lgm_T01S_Prepare( Lgm_MagModelInfo *Info );
 void   Tsyg_T01S( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2001_Info *tInfo );
 int    Lgm_B_T02( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info );
+void   Lgm_T02_Prepare( Lgm_MagModelInfo *Info );
 void   Tsyg_T02( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2001_Info *tInfo );
 
 /*
@@ -756,6 +1400,12 @@ void Lgm_B_FromScatteredData4_TearDown( Lgm_MagModelInfo *Info ); // unify the s
 void Lgm_B_FromScatteredData5_SetUp( Lgm_MagModelInfo *Info );
 void Lgm_B_FromScatteredData5_TearDown( Lgm_MagModelInfo *Info ); // I dont like this proliferation of routines here..
 
+/*
+ *  Preparing large scattered data sets (e.g. MHD meshes)
+ */
+long int Lgm_PointCloud_VoxelSimplify( double **u, long int n, double h, long int *Keep );
+double   Lgm_PointCloud_GridRes( Lgm_KdTree *KdTree, double **u, long int n, long int nSamples, double Quantile );
+
 
 /*
  * Simplified Mead field.
@@ -775,12 +1425,16 @@ int Lgm_B_Dungey(Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info);
 double      Iinv( Lgm_MagModelInfo *fInfo );
 double      I_integrand( double s, _qpInfo *qpInfo );
 double      Iinv_interped( Lgm_MagModelInfo *fInfo );
+int         Iinv_interped_multi( int nBm, double *Bm, double *I, Lgm_MagModelInfo *fInfo );
 double      I_integrand_interped( double s, _qpInfo *qpInfo );
+void        I_integrand_interped_v( int n, const double *s, double *f, _qpInfo *qpInfo );
 double      SbIntegral( Lgm_MagModelInfo *fInfo );
 double      Sb_integrand( double s, _qpInfo *qpInfo );
 double      SbIntegral_interped( Lgm_MagModelInfo *fInfo );
 double      SbIntegral_interped2( Lgm_MagModelInfo *fInfo, double a , double b );
 double      Sb_integrand_interped( double s, _qpInfo *qpInfo );
+void        Sb_integrand_interped_v( int n, const double *s, double *f, _qpInfo *qpInfo );
+int         Lgm_BounceIntegrals_interped( Lgm_MagModelInfo *mInfo, double *I, double *Sb, double *K );
 void        ratint( double *xa, double *ya, int n, double x, double *y, double *dy );
 void        polint(double *xa, double *ya, int n, double x, double *y, double *dy);
 void        Interp( double xa[],  double ya[], long int n, double x, double *y);
@@ -790,15 +1444,43 @@ double      IFromLBmM_Hilton( double L, double Bm, double M );
 double      LFromIBmM_McIlwain( double I, double Bm, double M );
 double      IFromLBmM_McIlwain( double L, double Bm, double M );
 double      Lgm_McIlwain_L( long int Date, double UTC, Lgm_Vector *u, double Alpha, int Type, double *I, double *Bm, double *M, Lgm_MagModelInfo *mInfo );
+int         Lgm_McIlwain_L_Batch( int n, long int *Date, double *UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Type, double *L, double *I, double *Bm, double *M, Lgm_MagModelInfo *mInfo );
 
 
 double      BofS( double s, Lgm_MagModelInfo *Info );
+void        BofS_N( int n, const double *s, double *B, Lgm_MagModelInfo *Info );
 int         SofBm( double Bm, double *ss, double *sn, Lgm_MagModelInfo *Info );
 double      Lgm_AlphaOfK( double K, Lgm_MagModelInfo *Info );
 double      Lgm_KofAlpha( double Alpha, Lgm_MagModelInfo *Info );
 int         Lgm_Setup_AlphaOfK( Lgm_DateTime *d, Lgm_Vector *u, Lgm_MagModelInfo *m );
 void        Lgm_TearDown_AlphaOfK( Lgm_MagModelInfo *m );
+#define     LGM_GRAD_I_PERTURB  0       // Lgm_Grad_I() from the first variation of I along the base line
+#define     LGM_GRAD_I_FD       1       // Lgm_Grad_I() by differencing I on displaced lines
 int         Lgm_Grad_I( Lgm_Vector *vin, Lgm_Vector *GradI, Lgm_MagModelInfo *Info );
+
+/*
+ * Closed-form field line geometry and invariants for pure dipole fields.
+ */
+int         Lgm_Dipole_IsPure( Lgm_MagModelInfo *m );
+double      Lgm_Dipole_Line( Lgm_Vector *u, Lgm_DipoleFL *f, Lgm_MagModelInfo *m );
+void        Lgm_Dipole_Point( double Lat, Lgm_DipoleFL *f, Lgm_Vector *u, Lgm_MagModelInfo *m );
+double      Lgm_Dipole_B( double Lat, Lgm_DipoleFL *f );
+double      Lgm_Dipole_S( double Lat, Lgm_DipoleFL *f );
+double      Lgm_Dipole_MirrorLat( double Bm, Lgm_DipoleFL *f );
+int         Lgm_Dipole_FootLat( double Height, int Spherical, double sgn, Lgm_DipoleFL *f, double *Lat, Lgm_MagModelInfo *m );
+int         Lgm_Dipole_MirrorPoints( double Bm, Lgm_DipoleFL *f, Lgm_Vector *Ps, Lgm_Vector *Pn, double *SS, Lgm_MagModelInfo *m );
+void        Lgm_Dipole_Integrals( double Bm, Lgm_DipoleFL *f, double *I, double *Sb );
+int         Lgm_Dipole_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, Lgm_MagModelInfo *m );
+int         Lgm_Dipole_SampleLine( int nDivs, Lgm_MagModelInfo *m );
+double      Lgm_Dipole_AlphaOfK( double K, Lgm_MagModelInfo *m );
+
+/*
+ * Field line topology, footpoints and Bmin for the Dungey field without tracing.
+ */
+int         Lgm_Dungey_IsPure( Lgm_MagModelInfo *m );
+double      Lgm_Dungey_Line( Lgm_Vector *u, Lgm_DungeyFL *f, Lgm_MagModelInfo *m );
+int         Lgm_Dungey_Topology( Lgm_Vector *u, Lgm_MagModelInfo *m );
+int         Lgm_Dungey_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, Lgm_MagModelInfo *m );
 //int         ComputeVcg( Lgm_Vector *vin, Lgm_Vector *Vcg, Lgm_LstarInfo *LstarInfo );
 
 
@@ -820,6 +1502,8 @@ void Lgm_Set_LossConeHeight( Lgm_MagModelInfo *m, double LossConeHeight );
 void Lgm_MagModelInfo_Set_MagModel( int InternalModel, int ExternalModel, Lgm_MagModelInfo *m );
 
 void Lgm_B_FromScatteredData_SetRbf( Lgm_MagModelInfo *Info, double eps, int RbfType );
+void Lgm_B_FromScatteredData_SetCache( Lgm_MagModelInfo *Info, Lgm_RBF_Cache *c );
+void Lgm_B_FromScatteredData_ResetLast( Lgm_MagModelInfo *Info );
 
 /*
  * Added for Python wrapping, the function pointer is hard to impossible to
@@ -842,6 +1526,7 @@ void Lgm_Set_Lgm_B_OP77(Lgm_MagModelInfo *MagInfo);
 void Lgm_Set_Lgm_B_cdip_InternalModel(Lgm_MagModelInfo *MagInfo);
 void Lgm_Set_Lgm_B_edip_InternalModel(Lgm_MagModelInfo *MagInfo);
 void Lgm_Set_Lgm_B_IGRF_InternalModel(Lgm_MagModelInfo *MagInfo);
+void Lgm_Set_Lgm_B_IGRF_Truncated_InternalModel(Lgm_MagModelInfo *MagInfo, double Tol);
 
 
 /*
@@ -851,6 +1536,10 @@ int  Lgm_GSM_TO_CBM( Lgm_Vector *u, double *CgmLat, double *CgmLon, double *CgmR
 int  Lgm_CBM_TO_GSM( double CgmLat, double CgmLon, double CgmRad, Lgm_Vector *u, Lgm_MagModelInfo *m );
 int  Lgm_GEOD_TO_CGM( double geoLat, double geoLon, double geoAlt, double *CgmLat, double *CgmLon, double *CgmRad, Lgm_MagModelInfo *m );
 int  Lgm_CGM_TO_GEOD( double CgmLat, double CgmLon, double CgmRadi, double *geoLat, double *geoLon, double *geoAlt, Lgm_MagModelInfo *m );
+Lgm_CgmGrid *Lgm_CgmGrid_Create( int nR, double *R, double dLat, double dLon, double MaxErr, Lgm_MagModelInfo *m );
+void Lgm_CgmGrid_Free( Lgm_CgmGrid *g );
+int  Lgm_CgmGrid_GEOD_TO_CGM( double geoLat, double geoLon, double geoAlt, double *CgmLat, double *CgmLon, double *CgmRad, double *Err, Lgm_CgmGrid *g, Lgm_MagModelInfo *m );
+int  Lgm_CgmGrid_CGM_TO_GEOD( double CgmLat, double CgmLon, double CgmRad, double *geoLat, double *geoLon, double *geoAlt, double *Err, Lgm_CgmGrid *g, Lgm_MagModelInfo *m );
 
 
 
@@ -0,0 +1,337 @@
+#ifndef LGM_MAGSTEPKERNELS_H
+#define LGM_MAGSTEPKERNELS_H
+
+#include <stdio.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_VecInline.h"
+
+/*
+ *  The inner kernels of the field line integrators -- the modified midpoint
+ *  sequence of Lgm_MagStep_BS() and the Cash-Karp step of Lgm_MagStep_RK5()
+ *  -- as inline functions, so that they can be compiled against a particular
+ *  field routine. Lgm_ModMid() and Lgm_RKCK() (MagStep.c) are these with the
+ *  field routine passed in as a pointer, as always.
+ *
+ *  LGM_MAGSTEP_KERNELS( Tag, Bfield ) defines Lgm_ModMid_<Tag>() and
+ *  Lgm_RKCK_<Tag>(), which have the same arguments but call Bfield directly
+ *  (their Mag argument is ignored). Done in the file that defines Bfield
+ *  (e.g. T89.c), this lets the compiler inline the model (external and
+ *  internal parts together) into the integrator instead of going through a
+ *  pointer for every evaluation. Lgm_MagStep_SelectKernels() (MagStep.c)
+ *  keeps a table of the instances and picks the one for the current field.
+ *
+ *  Not included by Lgm_MagModelInfo.h.
+ */
+
+
+
+static inline int Lgm_ModMid_Inline( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn,
+                                    int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+    int            m;
+    double        h2, h, Bmag;
+    Lgm_Vector    z0, z1, z2, B;
+
+
+    /*
+     *  Set stepsize, h and 2*h.
+     */
+    h  = sgn * H/(double)n;
+    h2 = 2.0 * h;
+//printf("h=%g\n", h);
+
+
+    /*
+     *  Set initial point, z0.
+     */
+    z0 = *u;
+
+
+    /*
+     *  Do initial Euler step to get z1. We get b0 from the arg list (its computed once).
+     */
+    z1.x = z0.x + h*b0->x;
+    z1.y = z0.y + h*b0->y;
+    z1.z = z0.z + h*b0->z;
+
+
+    /*
+     *  Do general step to get z2 -> zn. This is midpoint formula.
+     */
+    for ( m = 1; m < n; ++m ) {
+
+        if ( (*Mag)(&z1, &B, Info) == 0 ) {
+            // bail if B-field eval had issues.
+            printf("Lgm_ModMid(): B-field evaluation during midpoint phase (m = %d and z1 = %g %g %g) returned with errors (returning with 0)\n", m, z1.x, z1.y, z1.z );
+            return(0);
+        }
+        ++(Info->Lgm_nMagEvals);
+        Bmag = Lgm_NormalizeVector(&B);
+        if ( Bmag < 1e-16 ) {
+            // bail if B-field magnitude is too small
+            printf("Lgm_ModMid(): Bmag too small during midpoint phase (m = %d and z1 = %g %g %g Bmag = %g) is too small (returning with 0).\n", m, z1.x, z1.y, z1.z, Bmag );
+            return(0);
+        }
+        z2.x = z0.x + h2*B.x;
+        z2.y = z0.y + h2*B.y;
+        z2.z = z0.z + h2*B.z;
+        z0 = z1;
+        z1 = z2;
+
+    }
+
+
+    /*
+     *  Do final Euler step to get z(n+1).
+     */
+    if ( (*Mag)(&z1, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_ModMid(): B-field evaluation during final Euler step (z1 = %g %g %g) returned with errors (returning with 0)\n", z1.x, z1.y, z1.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_ModMid(): Bmag too small during final Euler step (z1 = %g %g %g B = %g %g %g Bmag = %g) is too small (returning with 0).\n", z1.x, z1.y, z1.z, B.x, B.y, B.z, Bmag );
+//printf("z0, z1 = %g %g %g    %g %g %g   z2 = %g %g %g\n", z0.x, z0.y, z0.z, z1.x, z1.y, z1.z, z2.x, z2.y, z2.z );
+
+        return(0);
+    }
+    z2.x = z1.x + h*B.x;
+    z2.y = z1.y + h*B.y;
+    z2.z = z1.z + h*B.z;
+
+
+
+    /*
+     *   The final answer for zn is the average of z(n-1) and z(n+1).
+     */
+    v->x = 0.5 * (z0.x + z2.x);
+    v->y = 0.5 * (z0.y + z2.y);
+    v->z = 0.5 * (z0.z + z2.z);
+//printf("z0, z1 = %g %g %g    %g %g %g   v = %g %g %g\n", z0.x, z0.y, z0.z, z2.x, z2.y, z2.z, v->x, v->y, v->z );
+
+
+    return(1);
+
+}
+
+
+
+static inline int Lgm_RKCK_Inline( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr,
+                                   int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+
+    int i;
+
+    double  b21 = 0.2;
+
+    // b31=3.0/40.0, b32=9.0/40.0;
+    double  b31 = 0.075;
+    double  b32 = 0.225;
+
+    // b41=3.0/10.0, b42=-9.0/10.0, b43=6.0/5.0;
+    double  b41 =  0.3;
+    double  b42 = -0.9;
+    double  b43 =  1.2;
+
+    //double  b51=-11.0/54.0, b52=2.5, b53=-70.0/27.0, b54=35.0/27.0;
+    double  b51 = -0.20370370370370370370;
+    double  b52 =  2.5;
+    double  b53 = -2.59259259259259259259;
+    double  b54 =  1.29629629629629629629;
+
+    //double  b61=1631.0/55296.0, b62=175.0/512.0, b63=575.0/13824.0, b64=44275.0/110592.0, b65=253.0/4096.0;
+    double  b61 = .02949580439814814814;
+    double  b62 = .341796875;
+    double  b63 = .04159432870370370370;
+    double  b64 = .40034541377314814814;
+    double  b65 = .061767578125;
+
+    //double  c1=37.0/378.0, c3=250.0/621.0, c4=125.0/594.0, c6=512.0/1771.0;
+    double  c1  = 0.09788359788359788359;
+    double  c3  = 0.40257648953301127214;
+    double  c4  = 0.21043771043771043771;
+    double  c6  = 0.28910220214568040654;
+
+    //double  dc1 = c1-2825.0/27648.0, dc3 = c3-18575.0/48384.0, dc4 = c4-13525.0/55296.0, dc5 = -277.00/14336.0, dc6 = c6-0.25;
+    double  dc1 = -0.00429377480158730159;
+    double  dc3 =  0.01866858609385783299; 
+    double  dc4 = -0.03415502683080808080;
+    double  dc5 = -0.01932198660714285714;
+    double  dc6 =  0.03910220214568040654;
+
+    double  ak1[3], ak2[3], ak3[3], ak4[3], ak5[3], ak6[3], y[3], yout[3], ytemp[3];
+
+    Lgm_Vector  u, B;
+    double      Bmag, H;
+
+
+    y[0]    = u0->x;
+    y[1]    = u0->y;
+    y[2]    = u0->z;
+
+
+    H = sgn*h;
+
+//printf("    In cash-karp step: H = %g\n", H);
+
+    // 1st step
+    ak1[0] = b0->x; ak1[1] = b0->y; ak1[2] = b0->z;
+    for ( i=0; i<3; i++ ) {
+        ytemp[i] = y[i] + b21*H*ak1[i];
+    }
+
+
+
+    // 2nd step
+    u.x = ytemp[0];
+    u.y = ytemp[1];
+    u.z = ytemp[2];
+    if ( (*Mag)(&u, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
+        return(0);
+    }
+    ak2[0] = B.x; ak2[1] = B.y; ak2[2] = B.z;
+    for ( i=0; i<3; i++ ) {
+        ytemp[i] = y[i] + H*(b31*ak1[i] + b32*ak2[i]);
+    }
+
+
+
+
+    // 3rd step
+    u.x = ytemp[0];
+    u.y = ytemp[1];
+    u.z = ytemp[2];
+    if ( (*Mag)(&u, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
+        return(0);
+    }
+    ak3[0] = B.x; ak3[1] = B.y; ak3[2] = B.z;
+    for ( i=0; i<3; i++ ) {
+        ytemp[i] = y[i] + H*(b41*ak1[i] + b42*ak2[i] + b43*ak3[i]);
+    }
+
+
+
+
+    // 4th step
+    u.x = ytemp[0];
+    u.y = ytemp[1];
+    u.z = ytemp[2];
+    if ( (*Mag)(&u, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
+        return(0);
+    }
+    ak4[0] = B.x; ak4[1] = B.y; ak4[2] = B.z;
+    for ( i=0; i<3; i++ ) {
+        ytemp[i] = y[i] + H*(b51*ak1[i] + b52*ak2[i] + b53*ak3[i] + b54*ak4[i]);
+    }
+
+
+
+
+
+    // 5th step
+    u.x = ytemp[0];
+    u.y = ytemp[1];
+    u.z = ytemp[2];
+    if ( (*Mag)(&u, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
+        return(0);
+    }
+    ak5[0] = B.x; ak5[1] = B.y; ak5[2] = B.z;
+    for ( i=0; i<3; i++ ) {
+        ytemp[i] = y[i] + H*(b61*ak1[i] + b62*ak2[i] + b63*ak3[i] + b64*ak4[i] + b65*ak5[i]);
+    }
+
+
+
+
+
+    // 6th step
+    u.x = ytemp[0];
+    u.y = ytemp[1];
+    u.z = ytemp[2];
+    if ( (*Mag)(&u, &B, Info) == 0 ) {
+        // bail if B-field eval had issues.
+        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
+        return(0);
+    }
+    ++(Info->Lgm_nMagEvals);
+    Bmag = Lgm_NormalizeVector(&B);
+    if ( Bmag < 1e-16 ) {
+        // bail if B-field magnitude is too small
+        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
+        return(0);
+    }
+    ak6[0] = B.x; ak6[1] = B.y; ak6[2] = B.z;
+    for ( i=0; i<3; i++ ) {
+        yout[i] = y[i] + H*(c1*ak1[i] + c3*ak3[i] + c4*ak4[i] + c6*ak6[i]);
+    }
+    v->x = yout[0];
+    v->y = yout[1];
+    v->z = yout[2];
+
+
+
+
+
+    // compute yerr
+    for ( i=0; i<3; i++ ) {
+        yerr[i] = H*(dc1*ak1[i] + dc3*ak3[i] + dc4*ak4[i] + dc5*ak5[i] + dc6*ak6[i]);
+    }
+
+
+
+    return(1);
+
+}
+
+
+
+#define LGM_MAGSTEP_KERNELS( Tag, Bfield ) \
+int Lgm_ModMid_##Tag( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn, \
+                      int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) { \
+    return( Lgm_ModMid_Inline( u, b0, v, H, n, sgn, Bfield, Info ) ); \
+} \
+int Lgm_RKCK_##Tag( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr, \
+                    int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) { \
+    return( Lgm_RKCK_Inline( u0, b0, v, h, sgn, yerr, Bfield, Info ) ); \
+}
+
+#endif
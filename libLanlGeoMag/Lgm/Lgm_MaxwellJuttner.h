@@ -12,6 +12,8 @@
 
 double  Lgm_MaxJut( double n, double T, double Ek, double E0 );
 double  Lgm_Maxwellian( double n, double T, double Ek, double E0 );
+void    Lgm_MaxJut_Array( double n, double T, int nE, double *Ek, double E0, double *f );
+void    Lgm_Maxwellian_Array( double n, double T, int nE, double *Ek, double E0, double *f );
 
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef LGM_MEMORY_USAGE_H
+#define LGM_MEMORY_USAGE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+/*
+ *  How much memory the library's main structures are holding (see
+ *  Lgm_MemoryUsage.c). Each Lgm_*_MemoryUsage() returns the bytes of the
+ *  structure itself plus everything it owns, i.e. what its Free routine
+ *  would give back. Things it only points at (e.g. a Lgm_MagModelInfo's
+ *  Octree, KdTree, Gridded field or RBF_Cache) are not counted -- report
+ *  those separately. Read-only data shared by copies (the TS07 tail
+ *  coefficients in Lgm_MagModelConfig) is split evenly between them, so
+ *  adding up all the copies counts it once.
+ *
+ *  The sizes are of what was asked for from malloc(); its own overhead,
+ *  and pages that are allocated but never touched, make the RSS differ.
+ */
+size_t  Lgm_CTrans_MemoryUsage( Lgm_CTrans *c );
+size_t  Lgm_MagModelInfo_MemoryUsage( Lgm_MagModelInfo *Info );
+size_t  Lgm_LstarInfo_MemoryUsage( Lgm_LstarInfo *LstarInfo );
+size_t  Lgm_LstarInfoPool_MemoryUsage( Lgm_LstarInfoPool *Pool );
+size_t  Lgm_MagEphemInfo_MemoryUsage( Lgm_MagEphemInfo *MagEphemInfo );
+size_t  Lgm_MagEphemData_MemoryUsage( Lgm_MagEphemData *med );
+size_t  Lgm_Octree_MemoryUsage( Lgm_Octree *Octree );
+size_t  Lgm_KdTree_MemoryUsage( Lgm_KdTree *KdTree );
+size_t  Lgm_RBF_Cache_MemoryUsage( Lgm_RBF_Cache *c );
+size_t  Lgm_PeakRSS( void );
+
+
+/*
+ *  A report of the memory held by a run, e.g. at the end of a tool:
+ *
+ *      Lgm_MemoryReport r;
+ *      Lgm_MemoryReport_Init( &r );
+ *      Lgm_MemoryReport_Add( "MagEphemInfo", Lgm_MagEphemInfo_MemoryUsage( m ), &r );
+ *      Lgm_MemoryReport_Add( "CTrans",       Lgm_CTrans_MemoryUsage( c ), &r );
+ *      Lgm_MemoryReport_Write( &r );
+ *
+ *  Entries added under the same name are summed (and counted), so per
+ *  thread structures can all go under one name. Lgm_MemoryReport_Write()
+ *  prints the report the way the environment variable LGM_MEMORY_REPORT
+ *  says ("text" or "json", nothing if it isnt set) to LGM_MEMORY_REPORT_FILE
+ *  (or stderr).
+ */
+#define LGM_MEMORY_REPORT_TEXT      1
+#define LGM_MEMORY_REPORT_JSON      2
+#define LGM_MEMORY_REPORT_MAX       32
+
+typedef struct Lgm_MemoryReport {
+    int         n;
+    char        Name[LGM_MEMORY_REPORT_MAX][64];
+    long int    Count[LGM_MEMORY_REPORT_MAX];     // number of structures added under Name
+    size_t      Bytes[LGM_MEMORY_REPORT_MAX];
+} Lgm_MemoryReport;
+
+int     Lgm_MemoryReportMode( void );
+void    Lgm_MemoryReport_Init( Lgm_MemoryReport *r );
+void    Lgm_MemoryReport_Add( const char *Name, size_t Bytes, Lgm_MemoryReport *r );
+size_t  Lgm_MemoryReport_Total( Lgm_MemoryReport *r );
+void    Lgm_MemoryReport_Print( FILE *fp, int Mode, Lgm_MemoryReport *r );
+void    Lgm_MemoryReport_Write( Lgm_MemoryReport *r );
+
+#endif
@@ -20,11 +20,34 @@ typedef struct Lgm_metadata_variable {
   long start_column;
   int dimension;
   long n_attrs;
+  long max_attrs; // allocated length of attributes (set by Lgm_metadata_initvar)
   int data;
   char* name;
   Lgm_metadata_attr *attributes;
 } Lgm_metadata_variable;
 
+/*
+ *  A rendered JSON header whose attribute values can be swapped out without
+ *  building the header again (see Lgm_metadata_JSONtemplate()).
+ */
+typedef struct Lgm_metadata_field {
+  int var;        // index of the variable in the template
+  long attr;      // index of the attribute in that variable
+  size_t offset;  // where the rendered value starts in the template text
+  size_t len;     // length of the rendered value
+  char *value;    // patched value as it will be rendered (NULL = unchanged)
+} Lgm_metadata_field;
+
+typedef struct Lgm_metadata_template {
+  char *text;     // header as rendered when the template was made
+  size_t len;
+  int n_vars;
+  Lgm_metadata_variable **vars;
+  long n_fields;
+  long max_fields;
+  Lgm_metadata_field *fields; // in the order they appear in text
+} Lgm_metadata_template;
+
 
 #include <stdarg.h>
 #include <stdlib.h>
@@ -42,8 +65,18 @@ void Lgm_metadata_initvar(Lgm_metadata_variable *var, int dimension, int data, c
 
 char *Lgm_metadata_JSONheader(int n_vars, ...);
 
+char *Lgm_metadata_JSONheaderArray(int n_vars, Lgm_metadata_variable **vars);
+
 char* Lgm_metadata_toJSON(Lgm_metadata_variable *var, short last, char comment);
 
+Lgm_metadata_template *Lgm_metadata_JSONtemplate(int n_vars, ...);
+
+int Lgm_metadata_PatchTemplate(Lgm_metadata_template *tmpl, char *var_name, char *attr_name, char *value);
+
+char *Lgm_metadata_TemplateToString(Lgm_metadata_template *tmpl);
+
+void Lgm_metadata_FreeTemplate(Lgm_metadata_template *tmpl);
+
 char *Lgm_metadata_stringArrayToString(int len, char** instring);
 
 char *Lgm_metadata_intArrayToString(int len, int* invals);
@@ -61,6 +94,8 @@ int Lgm_metadata_addStringAttrArray2(Lgm_metadata_variable *var, char *name, int
 int Lgm_metadata_addStringAttr(Lgm_metadata_variable *var, char *name, char * value, int array);
 
 int Lgm_metadata_AttrInVar(Lgm_metadata_variable *var, char *name);
+
+void Lgm_metadata_freevar(Lgm_metadata_variable *var);
   
 
 
@@ -10,12 +10,40 @@
 #define AMIN1(A,B) ( ((A<B)?(A):(B)) )
 #define AMAX1(A,B) ( ((A>B)?(A):(B)) )
 
+/*
+ *  The NRLMSISE-00 coefficient tables (see Lgm_Msis00_LoadModel()). These are
+ *  read-only once loaded and can be shared by many Lgm_Msis00Info's.
+ */
+typedef struct Lgm_Msis00Model {
+
+    // PARM7
+    double   *PT, **PD, *PS, **PDL, **PTL, **PMA, *SAM;
+    double   **PD_rc, **PTL_rc, **PMA_rc;
+
+    // MAVG7
+    double   *PAVGM;
+
+    // LOWER7
+    double   *PTM, **PDM;
+
+} Lgm_Msis00Model;
+
+
+/*
+ *  Switches, cached intermediate values and work space for the model. One of
+ *  these must not be used by more than one thread at a time (see
+ *  Lgm_Msis00_CopyInfo()).
+ */
 typedef struct Lgm_Msis00Info {
 
     char    NAME[80];
     char    ISDATE[80];
     char    ISTIME[80];
 
+    // The coefficient tables. The PARM7, MAVG7 and LOWER7 arrays below point into these.
+    Lgm_Msis00Model *Model;
+    int      OwnModel;              // Lgm_FreeMsis00() frees Model too
+
     // PARM7 COMMON BLOCK VARS
     double   *PT, **PD, *PS, **PDL, **PTL, **PMA, *SAM;
     double   **PD_rc, **PTL_rc, **PMA_rc;
@@ -72,11 +100,38 @@ typedef struct Lgm_Msis00Info {
     double  GLOBE7_CD14, GLOBE7_CD18, GLOBE7_CD32, GLOBE7_CD39;
     double  GLOB7S_CD14, GLOB7S_CD18, GLOB7S_CD32, GLOB7S_CD39;
 
+    // The Lgm_Msis00State whose GLOBE7() call last set PLG, DAY, DFA, APDF, etc. (which GLOB7S() uses)
+    void    *Msis00_Context;
+
 
 } Lgm_Msis00Info;
 
 
+/*
+ *  The horizontal (time, location and geophysics) part of a GTD7() evaluation.
+ *  The GLOBE7() and GLOB7S() terms do not depend on altitude, so a state keeps
+ *  each one the first time it is needed and reuses it for any number of
+ *  altitudes (see GTD7_State(), GTD7_Profile() and GTD7_Grid()). Set one up
+ *  with Lgm_Msis00_InitState(); it is only good for the switches (TSELEC())
+ *  in effect when it was filled in.
+ */
+#define LGM_MSIS00_NG7      11  // GLOBE7() terms: PT, PS and PD(1..9)
+#define LGM_MSIS00_NG7S     14  // GLOB7S() terms: PTL(1..4) and PMA(1..10)
+
+typedef struct Lgm_Msis00State {
+    double          IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP[8];
+    unsigned int    HaveG7, HaveG7S;        // Bit k is set once G7[k] (G7S[k]) is known
+    double          G7[LGM_MSIS00_NG7];
+    double          G7S[LGM_MSIS00_NG7S];
+} Lgm_Msis00State;
+
+
 // Function prototypes
+void   Lgm_Msis00_InitState( int IYD, double SEC, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, Lgm_Msis00State *s );
+void   GTD7_State( double ALT, double MASS, double *D, double *T, Lgm_Msis00State *s, Lgm_Msis00Info *p );
+void   GTS7_State( double ALT, double MASS, double *D, double *T, Lgm_Msis00State *s, Lgm_Msis00Info *p );
+void   GTD7_Profile( int IYD, double SEC, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, int nAlt, double *ALT, double MASS, double **D, double **T, Lgm_Msis00Info *p );
+void   GTD7_Grid( int IYD, double SEC, int nPts, double *GLAT, double *GLONG, double *STL, double F107A, double F107, double *AP, int nAlt, double *ALT, double MASS, double **D, double **T, Lgm_Msis00Info *p );
 void   GTD7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p );
 void   GTD7D( int IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p );
 void   GHP7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double *D, double *T, double PRESS, Lgm_Msis00Info *p );
@@ -99,6 +154,12 @@ double DNET( double DD, double DM, double ZHM, double XMM, double XM );
 double CCOR( double ALT, double R, double H1, double ZH );
 double CCOR2( double ALT, double R, double H1, double ZH, double H2 );
 Lgm_Msis00Info *InitMsis00( );
+Lgm_Msis00Model *Lgm_Msis00_LoadModel( );
+void   Lgm_Msis00_FreeModel( Lgm_Msis00Model *m );
+Lgm_Msis00Info *Lgm_Msis00_InitInfo( Lgm_Msis00Model *m );
+Lgm_Msis00Info *Lgm_Msis00_CopyInfo( Lgm_Msis00Info *p );
+void   GTD7_Batch( int n, int *IYD, double *SEC, double *ALT, double *GLAT, double *GLONG, double *STL, double *F107A, double *F107, double **AP, double MASS, double **D, double **T, Lgm_Msis00Info *p );
+void   GTD7D_Batch( int n, int *IYD, double *SEC, double *ALT, double *GLAT, double *GLONG, double *STL, double *F107A, double *F107, double **AP, double MASS, double **D, double **T, Lgm_Msis00Info *p );
 void   Lgm_FreeMsis00( Lgm_Msis00Info *p );
 
 
@@ -1,6 +1,8 @@
 #ifndef LGM_OCTREE
 #define LGM_OCTREE
 
+#include <stddef.h>
+#include <stdint.h>
 #include "Lgm_Vec.h"
 
 #define     OCTREE_MAX_LEVELS           16
@@ -37,7 +39,11 @@ typedef struct _Lgm_OctreeData {
 /**
  *
  * This structure contains all the information needed to represent a node of
- * the Octree.
+ * the Octree. The Octree is "linear": the nodes live in one flat array
+ * (Lgm_Octree.Cells) and refer to each other by index, and the data points
+ * are stored sorted by their Morton (Z-order) code, so the points under any
+ * node are the contiguous range [iData, iData+nDataBelow) of the point
+ * arrays.
  *
  */
 typedef struct _Lgm_OctreeCell {
@@ -51,13 +57,12 @@ typedef struct _Lgm_OctreeCell {
     Lgm_Vector          Center;         //<! Center of cube
     double              h;              //<! half width of cube face
 
-    struct _Lgm_OctreeCell  *Parent;    //<! points to parent cell
-    struct _Lgm_OctreeCell  *Octant;    //<! points to block of 8 children cells
+    long int            Parent;         //<! index of parent cell (-1 for the root)
+    long int            Octant;         //<! index of the first of the 8 children cells (-1 for a leaf)
 
-
-    unsigned long int   nDataBelow;     //<! Keeps track of data contained in all children below.
+    unsigned long int   nDataBelow;     //<! Number of data points in this cell and all children below.
     unsigned long int   nData;          //<! Number of data items in this cell. (0 for non-leaf nodes)
-    Lgm_OctreeData      *Data;          //<! Cell data. This will be NULL except for the leafs.
+    unsigned long int   iData;          //<! Index of the first data point in this cell (in Morton order).
 
 } Lgm_OctreeCell;
 
@@ -74,6 +79,9 @@ typedef struct _Lgm_OctreeCell {
  *
  * The scaling values are needed to convert back to un-scaled positions.
  *
+ * The data points are held as separate arrays (structure of arrays), sorted
+ * in Morton order.
+ *
  */
 typedef struct _Lgm_Octree {
 
@@ -83,51 +91,66 @@ typedef struct _Lgm_Octree {
     double            Diff;         //<! Max-Min
     long int          kNN_Lookups;  //<! Numbenr of kNN lookups performed
 
-    Lgm_OctreeCell   *Root;         //<! Pointer to the Root node of the Octree
+    long int          nCells;       //<! Number of cells in Cells
+    Lgm_OctreeCell   *Cells;        //<! The cells. Cells[0] is the Root.
 
-} Lgm_Octree;
+    double           *x;            //<! Scaled positions, x[n], y[n], z[n]
+    double           *y;
+    double           *z;
+    double           *Bx;           //<! Data vectors, Bx[n], By[n], Bz[n]
+    double           *By;
+    double           *Bz;
+    unsigned long int *Id;          //<! Index of each point in the arrays given to Lgm_InitOctree() (or Lgm_InitOctree_SoA())
 
+    unsigned char    *Mapping;      //<! For octrees from Lgm_LoadOctree(): the mapped file (the arrays above point into it)
+    size_t            MappingSize;
 
-/**
- *
- * This structure holds the "Priority Queue" information that is used as part
- * of the kNN (k Nearest Neighbor) search algorithm.
- *
- */
-typedef struct _pQueue {
-
-    Lgm_OctreeCell  *Obj;
-    double          MinDist2;   //<! Minimum possible distance^2 between object and query point.
-                                //<! If the object is a point, then its the actual distance^2.
+} Lgm_Octree;
 
-    int             IsPoint;    //<! If this is TRUE, then a data point is stored in Obj.Data[j] Else its a non-leaf node.
-    int             j;          //<! Index where data point is stored.
 
-    struct _pQueue *Prev;       //<! Next node in linked list
-    struct _pQueue *Next;       //<! Prev node in linked list
 
-} pQueue;
+/*
+ *  Octree files (see Lgm_SaveOctree()). The file is the header followed by
+ *  the Cells array and the x, y, z, Bx, By, Bz and Id arrays, each starting
+ *  on a LGM_OCTREE_FILE_ALIGN boundary, exactly as they are held in memory
+ *  (native byte order and structure layout -- CellSize and IdSize are
+ *  checked when the file is loaded).
+ */
+#define LGM_OCTREE_FILE_MAGIC       "LGMOCT01"
+#define LGM_OCTREE_FILE_VERSION     1
+#define LGM_OCTREE_FILE_ALIGN       64
+
+typedef struct Lgm_OctreeFileHeader {
+    char        Magic[8];           // LGM_OCTREE_FILE_MAGIC (not nul terminated)
+    uint32_t    Version;            // LGM_OCTREE_FILE_VERSION
+    uint32_t    CellSize;           // sizeof( Lgm_OctreeCell )
+    uint32_t    IdSize;             // sizeof( unsigned long int )
+    uint32_t    Pad;
+    uint64_t    n;                  // Number of points
+    uint64_t    nCells;
+    double      Min, Max, Diff;     // Lgm_Octree scaling values
+    uint64_t    CellOffset;         // File offsets of the arrays
+    uint64_t    Offset[7];          // x, y, z, Bx, By, Bz, Id
+} Lgm_OctreeFileHeader;
 
 
 void            Binary( unsigned int n, char *Str );
-void            Lgm_OctreeFreeBranch( Lgm_OctreeCell *Cell );
 void            Lgm_FreeOctree( Lgm_Octree *ot );
-Lgm_OctreeCell  *Lgm_CreateOctreeRoot( );
-Lgm_OctreeCell  *Lgm_OctreeTraverseToLocCode( Lgm_OctreeCell *Cell, unsigned int ChildLevel, unsigned int xLocationCode, unsigned int yLocationCode, unsigned int zLocationCode );
-Lgm_OctreeCell  *Lgm_LocateNearestCell( Lgm_OctreeCell *Root, Lgm_Vector *q );
-double          MinDist( Lgm_OctreeCell *Cell, Lgm_Vector *q );
-double          InsertCell( Lgm_OctreeCell *Cell, Lgm_Vector *q, pQueue **PQ, double MaxDist2 );
-void            InsertPoint( Lgm_OctreeCell *Cell, int j, Lgm_Vector *q, pQueue **PQ );
-Lgm_OctreeCell  *DescendTowardClosestLeaf( Lgm_OctreeCell *Node, pQueue **PQ, Lgm_Vector *q, double MaxDist2 );
-pQueue          *PopObj( pQueue **PQ );
+unsigned long   Lgm_OctreeMortonCode( unsigned int xLocationCode, unsigned int yLocationCode, unsigned int zLocationCode );
+long int        Lgm_OctreeLocateLeaf( Lgm_Vector *q, Lgm_Octree *Octree );
 int             Lgm_Octree_kNN( Lgm_Vector *q, Lgm_Octree *Octree, int K, int *Kgot, double MaxDist2, Lgm_OctreeData *kNN );
-Lgm_OctreeCell  *CreateNewOctants( Lgm_OctreeCell *Parent );
-void            SubDivideVolume( Lgm_OctreeCell *Vol );
+long int        Lgm_Octree_Radius( Lgm_Vector *q, Lgm_Octree *Octree, double Radius2, long int nMax, Lgm_OctreeData *Out );
+long int        Lgm_Octree_Box( Lgm_Vector *BoxMin, Lgm_Vector *BoxMax, Lgm_Octree *Octree, long int nMax, Lgm_OctreeData *Out );
+long int        Lgm_Octree_Radius_Batch( long int nq, Lgm_Vector *q, Lgm_Octree *Octree, double Radius2, long int nMax, long int *Count, Lgm_OctreeData *Out );
 Lgm_Octree      *Lgm_InitOctree( Lgm_Vector *ObjectPoints, Lgm_Vector *ObjectData, unsigned long int N );
+Lgm_Octree      *Lgm_InitOctree_SoA( const void *x, const void *y, const void *z, const void *Bx, const void *By, const void *Bz,
+                                     int IsFloat, unsigned long int N );
 void            Lgm_OctreeScalePosition( Lgm_Vector *u, Lgm_Vector *v, Lgm_Octree *Octree);
 void            Lgm_OctreeUnScalePosition( Lgm_Vector *v, Lgm_Vector *u, Lgm_Octree *Octree);
 void            Lgm_OctreeScaleDistance( double u, double *v, Lgm_Octree *Octree);
 void            Lgm_OctreeUnScaleDistance( double v, double *u, Lgm_Octree *Octree);
+int             Lgm_SaveOctree( Lgm_Octree *Octree, char *Filename );
+Lgm_Octree      *Lgm_LoadOctree( char *Filename );
 
 
 
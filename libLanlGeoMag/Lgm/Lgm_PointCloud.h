@@ -0,0 +1,52 @@
+#ifndef LGM_POINTCLOUD_H
+#define LGM_POINTCLOUD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Lgm/Lgm_Octree.h"
+
+/*
+ *  Point cloud files (e.g. an MHD snapshot) for the scattered data models.
+ *  The file is the header followed by the x, y, z, Bx, By, Bz (and
+ *  optionally E) arrays, each n floats or doubles in native byte order and
+ *  starting on a LGM_POINTCLOUD_FILE_ALIGN boundary. Lgm_OpenPointCloud()
+ *  maps the file read only and the arrays point straight into it, and
+ *  Lgm_PointCloud_InitOctree() builds the octree from the mapped arrays
+ *  directly. The octree's Id[] of a point is its index in the file, so
+ *  other quantities (e.g. E) can be looked up for the kNN points.
+ */
+#define LGM_POINTCLOUD_FILE_MAGIC   "LGMPCL01"
+#define LGM_POINTCLOUD_FILE_VERSION 1
+#define LGM_POINTCLOUD_FILE_ALIGN   64
+
+#define LGM_POINTCLOUD_HAS_E        1       // Flags
+
+typedef struct Lgm_PointCloudFileHeader {
+    char        Magic[8];           // LGM_POINTCLOUD_FILE_MAGIC (not nul terminated)
+    uint32_t    Version;            // LGM_POINTCLOUD_FILE_VERSION
+    uint32_t    ElemSize;           // 4 (float) or 8 (double)
+    uint32_t    Flags;              // LGM_POINTCLOUD_HAS_E
+    uint32_t    Pad;
+    uint64_t    n;                  // Number of points
+    uint64_t    Offset[9];          // File offsets of x, y, z, Bx, By, Bz, Ex, Ey, Ez
+} Lgm_PointCloudFileHeader;
+
+typedef struct Lgm_PointCloud {
+    uint64_t        n;
+    int             IsFloat;        // TRUE if the arrays are floats
+    int             HasE;
+    const void      *x, *y, *z;     // Point into the mapping
+    const void      *Bx, *By, *Bz;
+    const void      *Ex, *Ey, *Ez;  // NULL if the file has no E
+    unsigned char   *Mapping;
+    size_t          MappingSize;
+} Lgm_PointCloud;
+
+Lgm_PointCloud  *Lgm_OpenPointCloud( char *Filename );
+void            Lgm_ClosePointCloud( Lgm_PointCloud *pc );
+Lgm_Octree      *Lgm_PointCloud_InitOctree( Lgm_PointCloud *pc );
+void            Lgm_PointCloud_Get( Lgm_PointCloud *pc, unsigned long int j, Lgm_Vector *u, Lgm_Vector *B, Lgm_Vector *E );
+int             Lgm_SavePointCloud( char *Filename, unsigned long int n, int IsFloat, const void *x, const void *y, const void *z,
+                                    const void *Bx, const void *By, const void *Bz, const void *Ex, const void *Ey, const void *Ez );
+
+#endif
@@ -13,6 +13,7 @@ int     Lgm_CubicRoots( double b, double c, double d, double *z1, complex double
 double  Lgm_CubicRealRoot( double b, double c, double d );
 int     Lgm_QuarticRoots( double b, double c, double d, double e, double complex *z1, double complex *z2, double complex *z3, double complex *z4 );
 int     Lgm_QuarticRootsSorted( double b, double c, double d, double e, int *nReal, double *RealRoots, int *nComplex, double complex *ComplexRoots );
+void    Lgm_QuarticRealRoots_N( int n, double *b, double *c, double *d, double *e, double *x );
 
 int     Lgm_PolyRoots( double *a, int n, double complex *z );
 int     Lgm_PolyRoots_Roots( double *a, int n, double *wr, double *wi );
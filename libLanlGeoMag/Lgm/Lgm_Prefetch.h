@@ -0,0 +1,37 @@
+#ifndef LGM_PREFETCH_H
+#define LGM_PREFETCH_H
+
+#include "Lgm/Lgm_Eop.h"
+
+/*
+ *  Background prefetch of the next day's input data. See Lgm_Prefetch.c.
+ */
+#define LGM_PREFETCH_QINDENTON  1       // Qin-Denton days (into the Lgm_read_QinDenton() day cache)
+#define LGM_PREFETCH_TS07       2       // TS07D coefficient files (into the Lgm_SetCoeffs_TS07() day cache)
+#define LGM_PREFETCH_EOP        4       // The shared EOP series (see Lgm_get_shared_eop())
+#define LGM_PREFETCH_ALL        7
+
+#define LGM_PREFETCH_MAX_FILES  64      // Other files (e.g. TLE files) read ahead per day
+
+typedef struct Lgm_Prefetcher {
+    int         What;                               // LGM_PREFETCH_* flags
+    long int    Date;                               // Day being (or last) prefetched
+    int         nFiles;                             // Files to read ahead with the next day (see Lgm_Prefetcher_AddFile())
+    char        *Files[LGM_PREFETCH_MAX_FILES];
+    int         nJobFiles;                          // The ones the running job is reading
+    char        *JobFiles[LGM_PREFETCH_MAX_FILES];
+    Lgm_Eop     *Eop;                               // Reference to the shared EOP series (held until Lgm_FreePrefetcher())
+    int         Running;                            // TRUE while a background job is going
+    void        *Thread;                            // Its thread (a pthread_t)
+    long int    nDays;                              // Days prefetched
+    long int    nBackground;                        // ... of which on a background thread
+} Lgm_Prefetcher;
+
+Lgm_Prefetcher *Lgm_InitPrefetcher( int What );
+void            Lgm_FreePrefetcher( Lgm_Prefetcher *p );
+int             Lgm_Prefetcher_AddFile( Lgm_Prefetcher *p, const char *Filename );
+int             Lgm_Prefetch( Lgm_Prefetcher *p, long int Date );
+void            Lgm_Prefetch_Wait( Lgm_Prefetcher *p );
+Lgm_Eop        *Lgm_Prefetch_GetEop( Lgm_Prefetcher *p );
+
+#endif
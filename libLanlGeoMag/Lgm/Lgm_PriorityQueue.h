@@ -1,6 +1,9 @@
 #ifndef LGM_PRIORITYQUEUE
 #define LGM_PRIORITYQUEUE
 
+#define LGM_PQUEUE_PARENT(i)        (((i)+2)>>2)
+#define LGM_PQUEUE_FIRSTCHILD(i)    (4*(i)-2)
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -23,13 +26,16 @@ typedef struct Lgm_pQueue_Node {
  *
  * This structure stores info needed to represent a heap-based "Priority Queue". 
  * The HeapArray is dynamically sized via both at creation via Lgm_pQueue_Create() and 
- * potentially when an insert needs a bigger array via Lgm_pQueue_Insert().
+ * potentially when an insert needs a bigger array via Lgm_pQueue_Insert() (or
+ * ahead of time with Lgm_pQueue_Reserve()).
  *
- *  The HeapArray stores the heap tree in standard order -- I.e., index 0 is
- *  not used, the root node (highest priority node) is stored at index 1.
- *  Nodes are stored as follows;
+ *  The heap is 4-ary (each node has up to four children). That halves the
+ *  depth of the tree compared to a binary heap, and the four children of a
+ *  node are adjacent in memory, so a pop touches fewer cache lines.
+ *  Index 0 of the HeapArray is not used, the root node (highest priority
+ *  node) is stored at index 1. Nodes are stored as follows;
  *  
- *      Parent(i) = i/2, LeftChild(i) = 2i, RightChild(i) = 2i+1
+ *      Parent(i) = (i+2)/4, Children(i) = 4i-2, 4i-1, 4i, 4i+1
  *
  */
 typedef struct Lgm_pQueue {
@@ -47,6 +53,9 @@ void        Lgm_pQueue_Insert( Lgm_pQueue_Node *X, Lgm_pQueue *p );
 void        Lgm_pQueue_PercolateDown( long int i, Lgm_pQueue *p );
 int         Lgm_pQueue_Pop( Lgm_pQueue_Node *X, Lgm_pQueue *p );
 int         Lgm_pQueue_Peek( Lgm_pQueue_Node *X, Lgm_pQueue *p );
+void        Lgm_pQueue_Reserve( long int n, Lgm_pQueue *p );
+void        Lgm_pQueue_Reset( Lgm_pQueue *p );
+void        Lgm_pQueue_InsertArray( Lgm_pQueue_Node *X, long int n, Lgm_pQueue *p );
 
 
 
@@ -0,0 +1,49 @@
+#ifndef LGM_PROFILE_H
+#define LGM_PROFILE_H
+
+#include <stdio.h>
+
+/*
+ *  A low-overhead region profiler (see Lgm_Profile.c). Turned on at run time
+ *  by setting the environment variable LGM_PROFILE (to "text" or "json");
+ *  when it is off each region costs one test of Lgm_ProfileOn.
+ *
+ *  Regions nest, and time is kept per path (e.g. Lstar > FindShellLine >
+ *  Trace), per thread, and merged when the report is made. Times are from
+ *  the monotonic clock, in nanoseconds.
+ */
+#define LGM_PROF_TRACE              0       // Lgm_Trace()
+#define LGM_PROF_FINDSHELLLINE      1       // FindShellLine()
+#define LGM_PROF_IINTEGRAL          2       // Iinv(), Iinv_interped()
+#define LGM_PROF_MAGFLUX            3       // MagFlux()
+#define LGM_PROF_CTRANS             4       // Lgm_Set_Coord_Transforms()
+#define LGM_PROF_IO                 5       // MagEphem txt/hdf5 output
+#define LGM_PROF_NBUILTIN           6
+
+#define LGM_PROF_MAXREGIONS         64      // built-in plus named regions
+#define LGM_PROF_MAXDEPTH           32      // deepest nesting that is recorded
+#define LGM_PROF_MAXNODES           512     // distinct paths per thread
+
+#define LGM_PROFILE_TEXT            1
+#define LGM_PROFILE_JSON            2
+#define LGM_PROFILE_QUIET           3       // record, but dont report at exit
+
+/*
+ *  -1 until LGM_PROFILE has been looked at, then 0 (off), LGM_PROFILE_TEXT or
+ *  LGM_PROFILE_JSON. Only the macros below should need to look at it.
+ */
+extern int Lgm_ProfileOn;
+
+#define LGM_PROFILE_BEGIN( Region )     { if ( Lgm_ProfileOn ) Lgm_ProfileBegin( Region ); }
+#define LGM_PROFILE_END( Region )       { if ( Lgm_ProfileOn ) Lgm_ProfileEnd( Region ); }
+
+int     Lgm_ProfileInit( void );
+void    Lgm_ProfileEnable( int Mode );
+int     Lgm_ProfileRegion( const char *Name );
+void    Lgm_ProfileBegin( int Region );
+void    Lgm_ProfileEnd( int Region );
+void    Lgm_ProfileReport( FILE *fp, int Mode );
+void    Lgm_ProfileReset( void );
+long int Lgm_ProfileCalls( int Region, double *Seconds );
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef LGM_QINDENTON_H
 #define LGM_QINDENTON_H
 #include <math.h>
+#include <stdint.h>
 #include <Lgm/Lgm_MagModelInfo.h>
+#include <Lgm/Lgm_Arena.h>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_spline.h>
 
@@ -15,6 +17,8 @@
  * Structures to contain Earth Observing parameters from various sources.
  */
 
+#define LGM_QINDENTON_NMAX      (3*1440)        // capacity of the arrays in a Lgm_QinDenton (3 days of 1-minute values)
+
 
 typedef struct Lgm_QinDenton {
 
@@ -34,6 +38,8 @@ typedef struct Lgm_QinDenton {
     double      *W1, *W2, *W3, *W4, *W5, *W6;
     int         *W1_status, *W2_status, *W3_status, *W4_status, *W5_status, *W6_status;
 
+    Lgm_Arena   *Arena;         // all of the arrays above live here
+
 } Lgm_QinDenton;
 
 typedef struct Lgm_QinDentonOne {
@@ -57,14 +63,107 @@ typedef struct Lgm_QinDentonOne {
 
 } Lgm_QinDentonOne;
 
+
+/*
+ *  Per-day cache and packed binary archive of Qin-Denton values (see Lgm_QinDenton_Cache.c)
+ */
+#define LGM_QD_ARCHIVE_MAGIC    "LGMQD01"
+#define LGM_QD_ARCHIVE_VERSION  1
+#define LGM_QD_ARCHIVE_NAME     "QinDenton.bin"
+#define LGM_QD_CACHE_DAYS       32              // default number of days kept in memory
+#define LGM_QD_ISOLEN           32              // length of IsoTimeStr in an archive record
+
+typedef struct Lgm_QinDentonArchiveHeader {
+    char        Magic[8];           // LGM_QD_ARCHIVE_MAGIC
+    int32_t     Version;            // LGM_QD_ARCHIVE_VERSION
+    int32_t     RecordSize;         // sizeof(Lgm_QinDentonArchiveRecord)
+    double      ByteOrder;          // 1.0 (used to detect archives written on a machine with a different byte order)
+    int64_t     StartDate;          // first and last dates (YYYYMMDD) covered by the archive
+    int64_t     EndDate;
+    int64_t     nRecords;           // number of records
+    int64_t     DataOffset;         // byte offset of the records
+} Lgm_QinDentonArchiveHeader;
+
+typedef struct Lgm_QinDentonArchiveRecord {
+    int32_t     FileDate;           // date (YYYYMMDD) of the file the record came from. Records are sorted on this.
+    int32_t     Year, Month, Day, Hour, Minute, Second;
+    int32_t     ByIMF_status, BzIMF_status, V_SW_status, Den_P_status, Pdyn_status;
+    int32_t     G1_status, G2_status, G3_status;
+    int32_t     W1_status, W2_status, W3_status, W4_status, W5_status, W6_status;
+    int32_t     Pad;
+    double      MJD;
+    double      ByIMF, BzIMF, V_SW, Den_P, Pdyn;
+    double      G1, G2, G3;
+    double      fKp, akp3, Dst;
+    double      Bz1, Bz2, Bz3, Bz4, Bz5, Bz6;
+    double      W1, W2, W3, W4, W5, W6;
+    char        IsoTimeStr[LGM_QD_ISOLEN];
+} Lgm_QinDentonArchiveRecord;
+
+typedef struct Lgm_QinDentonArchive {
+    unsigned char                       *Base;      // start of mapped file
+    size_t                              Size;       // size of mapped file
+    const Lgm_QinDentonArchiveHeader    *Header;
+    const Lgm_QinDentonArchiveRecord    *Records;
+} Lgm_QinDentonArchive;
+
+/*
+ *  TS04/T01 driving parameters (W1..W6, G1..G3) kept up to date from a live
+ *  solar wind feed, one sample at a time (see Lgm_SolarWindState.c).
+ */
+#define LGM_SW_GWINDOW          60.0            // minutes of history averaged into G1..G3
+#define LGM_SW_NOMINAL_DT       5.0             // minutes a sample stands for when there is no previous one (the 5-min cadence TS04 was fit with)
+#define LGM_SW_MAX_DT           15.0            // most minutes of driving a single sample is allowed to stand for (across data gaps)
+
+typedef struct Lgm_SolarWindState {
+
+    long int    nSamples;           // number of samples taken so far
+    double      JD0;                // time of the first sample
+    double      JD;                 // time of the latest sample
+    double      N, V, By, Bz;       // latest valid solar wind values (cm^-3, km/s, nT GSM)
+    int         Held;               // TRUE if the latest sample was bad and the previous values were held
+
+    double      W[6];               // TS04 W1..W6 (exponentially weighted sums of the driving)
+
+    /*
+     *  Ring of the last LGM_SW_GWINDOW minutes of G1..G3 terms, with their
+     *  running sums.
+     */
+    int         nRing, MaxRing, iRing;
+    double      *tRing, *g1Ring, *g2Ring, *g3Ring;
+    double      Sum[3];
+    long int    nSinceResum;
+
+} Lgm_SolarWindState;
+
 Lgm_QinDenton   *Lgm_init_QinDenton( int Verbose );
 void            Lgm_init_QinDentonDefaults( Lgm_QinDenton *q, int Verbose );
 void            Lgm_destroy_QinDenton( Lgm_QinDenton *q );
 void            Lgm_destroy_QinDenton_children( Lgm_QinDenton *q );
 void            Lgm_read_QinDenton( long int Date, Lgm_QinDenton *q );
 void            Lgm_get_QinDenton_at_JD( double JD, Lgm_QinDentonOne *p, int Verbose, int Persistence );
+void            Lgm_get_QinDenton_at_JD_Array( long int n, double *JD, Lgm_QinDentonOne *p, int Verbose, int Persistence );
 void            Lgm_set_QinDenton( Lgm_QinDentonOne *p, Lgm_MagModelInfo *m );
 
+int             Lgm_QinDentonPath( char *QinDentonPath, int n );
+void            Lgm_QinDenton_SetCacheSize( int nDays );
+void            Lgm_QinDenton_ClearCache( );
+int             Lgm_QinDenton_LoadRange( long int StartDate, long int EndDate );
+int             Lgm_QinDenton_PrefetchDay( long int Date );
+
+void                    Lgm_QinDenton_ArchiveFilename( char *Filename, int n );
+Lgm_QinDentonArchive   *Lgm_QinDenton_OpenArchive( const char *Filename );
+void                    Lgm_QinDenton_CloseArchive( Lgm_QinDentonArchive *a );
+Lgm_QinDentonArchive   *Lgm_QinDenton_GetArchive( );
+long int                Lgm_QinDenton_ArchiveDay( Lgm_QinDentonArchive *a, long int Date, long int *i0 );
+long int                Lgm_QinDenton_BuildArchive( const char *Path, long int StartDate, long int EndDate, const char *ArchiveFile );
+
+Lgm_SolarWindState     *Lgm_InitSolarWindState( );
+void                    Lgm_FreeSolarWindState( Lgm_SolarWindState *s );
+int                     Lgm_SolarWindState_Update( Lgm_SolarWindState *s, double JD, double N, double V, double By, double Bz );
+void                    Lgm_SolarWindState_Get( Lgm_SolarWindState *s, Lgm_QinDentonOne *p );
+void                    Lgm_ComputeW( double W[], int i, double Nk[], double Vk[], double Bsk[], int nk );
+
 
 
 
@@ -20,8 +20,22 @@
 typedef int _qpInfo;
 #endif
 
+/*
+ *  Work space for dqags() and dqagp() (and their fv variants), so that the
+ *  iwork and work arrays can be allocated once and reused. It is big enough
+ *  for limit = Limit (dqags) or leniw = Limit (dqagp), with lenw = 4*Limit.
+ */
+typedef struct Lgm_QuadPackWork {
+    int     Limit;
+    int     *iwork;     // Limit+2 ints
+    double  *work;      // 4*Limit+2 doubles
+} Lgm_QuadPackWork;
+
 double d1mach( int i );
 
+int  Lgm_QuadPackWork_Reserve( int Limit, Lgm_QuadPackWork *w );
+void Lgm_QuadPackWork_Free( Lgm_QuadPackWork *w );
+
 int dqags(double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
 	double epsabs, double epsrel, double *result, double *abserr, int *neval, 
 	int *ier, int limit, int lenw, int *last, int *iwork, double *work, int verbosity );
@@ -47,6 +61,41 @@ int dqagpe(double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b,
 int dqk21(double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
 	double *result, double *abserr, double *resabs, double *resasc);
 
+/*
+ *  Batch-integrand versions. The integrand fv( n, x, y, qpInfo ) sets
+ *  y[i] = f(x[i]) for i = 0..n-1, and is called once per interval with all
+ *  n = 21 Kronrod nodes. Results are identical to the versions above.
+ */
+int dqagsv(void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
+	double epsabs, double epsrel, double *result, double *abserr, int *neval, 
+	int *ier, int limit, int lenw, int *last, int *iwork, double *work, int verbosity );
+
+int dqagsev(void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
+	double epsabs, double epsrel, int limit, double *result, double *abserr, 
+	int *neval, int *ier, double *alist, double *blist, double *rlist, 
+	double *elist, int *iord, int *last);
+
+int dqagpv(void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
+    int npts2, double   *points, double epsabs, double epsrel, double *result, 
+    double *abserr, int *neval, int *ier, int leniw, int lenw, int *last, 
+    int *iwork, double *work, int verbosity );
+
+int dqagpev(void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
+    int npts2, double  *points, double epsabs, double epsrel, int limit, 
+    double *result, double *abserr, int *neval, int *ier, double *alist, 
+    double *blist, double *rlist, double *elist, double *pts, int *iord, 
+    int  *level, int  *ndin, int *last);
+
+int dqk21v(void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b, 
+	double *result, double *abserr, double *resabs, double *resasc);
+
+/*
+ *  Used by the adaptive routines: the 21-point rule with fv if there is one,
+ *  otherwise with f.
+ */
+#define LGM_QK21( f, fv, qpInfo, a, b, result, abserr, resabs, resasc )  ( (fv) ? dqk21v( (fv), (qpInfo), (a), (b), (result), (abserr), (resabs), (resasc) ) \
+                                                                              : dqk21( (f), (qpInfo), (a), (b), (result), (abserr), (resabs), (resasc) ) )
+
 int dqelg(int n, double epstab[], double *result, double *abserr, double res3la[], 
 	int *nres);
 
@@ -44,5 +44,13 @@ void     Lgm_QuatSquadComputeAuxPoint( double Qim1[4], double Qi[4], double Qip1
 long int Lgm_QuatFindTimeIndex( double *T, long int N, double t );
 int      Lgm_QuatSquadInterp( double *T,   double *Q[4], long int N,   double *t, double *q[4], long int n );
 
+/*
+ *  Array versions (see Lgm_Quat.c). Quaternion arrays are n x 4.
+ */
+void     Lgm_QuatRotateVectors( double Q[4], long int n, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo );
+void     Lgm_QuatRotateVectors_n( long int n, double *Q, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo );
+int      Lgm_QuatSlerpSeries( double *T, double *Q, long int N, double *t, double *q, long int n );
+int      Lgm_QuatSquadSeries( double *T, double *Q, long int N, double *t, double *q, long int n );
+
 
 #endif
@@ -11,6 +11,13 @@
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_linalg.h>
 
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
 #define LGM_CHOLESKY_DECOMP 0
 #define LGM_PLU_DECOMP      1    
 #define LGM_SVD             2    
@@ -38,6 +45,13 @@ typedef struct _Lgm_DFI_RBF_Info {
     Lgm_Vector          *v;
     Lgm_Vector          *c;
     double              eps;
+
+    double              *vx;        // v and c again, stored as separate arrays (SoA) for
+    double              *vy;        // the evaluation kernels.
+    double              *vz;
+    double              *cx;
+    double              *cy;
+    double              *cz;
 //NOTE
     UT_hash_handle      hh; // Make structure hashable via uthash
 
@@ -75,13 +89,106 @@ typedef struct _Lgm_Vec_RBF_Info {
     double              *eps_y;
     double              *eps_z;
 
+    double              *vx;        // v again, stored as separate arrays (SoA) for the
+    double              *vy;        // evaluation kernels.
+    double              *vz;
+
     double              size;       // Size of memory consumed in MB
 
+    struct _Lgm_Vec_RBF_Info *rbf_e;    // Fit to E made with the same points (see Lgm_Vec_RBF_Init2()), when the two are kept
+                                        // together (e.g. in Lgm_B_FromScatteredData5()'s hash table). Not freed by Lgm_Vec_RBF_Free().
+
     UT_hash_handle      hh;         // Make structure hashable via uthash
 
 } Lgm_Vec_RBF_Info;
 
 
+/*
+ * Workspace for Lgm_Vec_RBF_Fit(). Holds the last factorization so that it
+ * can be reused or updated by the next fit.
+ */
+typedef struct _Lgm_Vec_RBF_Work {
+
+    int                 nMax;       // Max number of points
+    int                 n;          // Number of points in the current factorization (0 if none)
+    int                 Cholesky;   // L holds a Cholesky factor (TRUE) or LU factors (FALSE)
+    int                 RadialBasisFunction;
+    double              eps_x;      // (uniform) eps's of the Cholesky factorization
+    double              eps_y;
+    double              eps_z;
+    Lgm_Vector          *v;         // points of the Cholesky factorization (factorization order)
+    int                 *Map;       // Map[i] is where point i of the last fit is in factorization order
+    int                 *Perm;      // LU pivots
+    double              *L;         // nMax x nMax, row major
+    double              *b;         // nMax x 3 right hand sides / solutions
+    double              *Col;       // nMax scratch
+
+    long int            nFull;      // Number of full factorizations done
+    long int            nUpdates;   // Number of one-point Cholesky updates done
+    long int            nReuses;    // Number of times the factorization was reused as is
+
+} Lgm_Vec_RBF_Work;
+
+
+/*
+ * Symmetric matrix stored by its envelope (lower triangle), for the sparse
+ * solves done with the compactly supported (Wendland) kernels (see
+ * Lgm_RBF_Sparse.c). Row i holds columns First[i] ... i.
+ */
+typedef struct _Lgm_RBF_Skyline {
+
+    int                 n;          // Number of rows
+    int                 *First;     // First column stored in each row
+    long int            *Start;     // Where each row starts in Val (n+1 of them)
+    long int            nVal;
+    double              *Val;
+
+} Lgm_RBF_Skyline;
+
+#define LGM_SKYLINE( m, i, j )  ( (m)->Val[ (m)->Start[i] + (j) - (m)->First[i] ] )
+
+
+/*
+ * Cache of fitted Lgm_Vec_RBF_Info's that can be shared by all threads (see
+ * Lgm_RBF_Cache.c). Entries are keyed on the sorted Id's of the neighbors
+ * the fit was done with.
+ */
+#define LGM_RBF_CACHE_NSHARDS   64
+
+typedef struct _Lgm_RBF_CacheEntry {
+
+    Lgm_Vec_RBF_Info    *rbf;       // fit to B (owns the key, rbf->LookUpKey)
+    Lgm_Vec_RBF_Info    *rbf_e;     // fit to E done with the same neighbors (may be NULL)
+    int                 KeyLength;  // length of the key in bytes
+    double              size;       // memory used by rbf and rbf_e in MB
+    int                 nUsers;     // number of Lgm_RBF_Cache_Get()/Add()'s not yet Release()'d
+    int                 Referenced; // used since the eviction clock last passed it
+    int                 Evicted;    // no longer in the table -- free on last Release()
+    UT_hash_handle      hh;
+
+} Lgm_RBF_CacheEntry;
+
+typedef struct _Lgm_RBF_CacheShard {
+
+    Lgm_RBF_CacheEntry  *ht;        // hash table (uthash). Insertion order is the eviction clock order.
+    void                *Lock;      // lock for this shard
+    long int            nEntries;
+    double              size;       // MB
+    long int            nHits;
+    long int            nMisses;
+    long int            nAdds;
+    long int            nEvictions;
+
+} Lgm_RBF_CacheShard;
+
+typedef struct _Lgm_RBF_Cache {
+
+    double              MaxSize;    // Max size in MB (each shard gets MaxSize/LGM_RBF_CACHE_NSHARDS)
+    Lgm_RBF_CacheShard  Shard[ LGM_RBF_CACHE_NSHARDS ];
+
+} Lgm_RBF_Cache;
+
+
 Lgm_DFI_RBF_Info *Lgm_DFI_RBF_Init( unsigned long int *I, Lgm_Vector *v, Lgm_Vector *B, int n, double eps, int RadialBasisFunction );
 void    Lgm_DFI_RBF_Free( Lgm_DFI_RBF_Info *rbf );
 void    Lgm_DFI_RBF_Phi( Lgm_Vector *v, Lgm_Vector *v0, double Phi[3][3], Lgm_DFI_RBF_Info *rbf );
@@ -90,9 +197,11 @@ void    Lgm_DFI_RBF_dPhi_dx( Lgm_Vector *v, Lgm_Vector *v0, double dPdx[3][3], L
 void    Lgm_DFI_RBF_dPhi_dy( Lgm_Vector *v, Lgm_Vector *v0, double dPdy[3][3], Lgm_DFI_RBF_Info *rbf  );
 void    Lgm_DFI_RBF_dPhi_dz( Lgm_Vector *v, Lgm_Vector *v0, double dPdz[3][3], Lgm_DFI_RBF_Info *rbf  );
 void    Lgm_DFI_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_DFI_RBF_Info *rbf );
+void    Lgm_DFI_RBF_EvalAll( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_DFI_RBF_Info *rbf );
 
 
 Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction );
+Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init2( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *E, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction, Lgm_Vec_RBF_Info **rbf_e );
 void    Lgm_Vec_RBF_Free( Lgm_Vec_RBF_Info *rbf );
 void    Lgm_Vec_RBF_Psi( Lgm_Vector *v, Lgm_Vector *v0, double eps, double *Psi, int RbfType  );
 void    Lgm_Vec_RBF_Psi2( Lgm_Vector *v, Lgm_Vector *v0, double eps_x, double eps_y, double eps_z, double *Psi, int RbfType  );
@@ -100,6 +209,25 @@ void    Lgm_Vec_RBF_Derivs( Lgm_Vector *v, Lgm_Vector *v0, double eps, double *d
 void    Lgm_Vec_RBF_Derivs2( Lgm_Vector *v, Lgm_Vector *v0, double eps_x, double eps_y, double eps_z, double *dPdx, double *dPdy, double *dPdz, int RbfType  );
 void    Lgm_Vec_RBF_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vec_RBF_Info *rbf );
 void    Lgm_Vec_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_Vec_RBF_Info *rbf );
+void    Lgm_Vec_RBF_EvalAll( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_Vec_RBF_Info *rbf );
+
+Lgm_Vec_RBF_Work *Lgm_Vec_RBF_AllocWork( int nMax );
+void    Lgm_Vec_RBF_FreeWork( Lgm_Vec_RBF_Work *w );
+Lgm_Vec_RBF_Info *Lgm_Vec_RBF_AllocInfo( int nMax );
+int     Lgm_Vec_RBF_Fit( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, double *eps_x, double *eps_y, double *eps_z, int n, int RadialBasisFunction, Lgm_Vec_RBF_Info *rbf, Lgm_Vec_RBF_Work *w );
+
+long int            Lgm_RBF_SupportOrder( int n, Lgm_Vector *v, double ex, double ey, double ez, int *Perm, int *First );
+Lgm_RBF_Skyline    *Lgm_RBF_Skyline_Alloc( int n, int *First );
+void                Lgm_RBF_Skyline_Free( Lgm_RBF_Skyline *m );
+int                 Lgm_RBF_Skyline_Cholesky( Lgm_RBF_Skyline *m );
+void                Lgm_RBF_Skyline_Solve( Lgm_RBF_Skyline *m, double *b );
+
+Lgm_RBF_Cache      *Lgm_InitRBFCache( double MaxSize );
+void                Lgm_FreeRBFCache( Lgm_RBF_Cache *c );
+Lgm_RBF_CacheEntry *Lgm_RBF_Cache_Get( Lgm_RBF_Cache *c, unsigned long int *Key, int nKey );
+Lgm_RBF_CacheEntry *Lgm_RBF_Cache_Add( Lgm_RBF_Cache *c, Lgm_Vec_RBF_Info *rbf, Lgm_Vec_RBF_Info *rbf_e );
+void                Lgm_RBF_Cache_Release( Lgm_RBF_Cache *c, Lgm_RBF_CacheEntry *e );
+void                Lgm_RBF_Cache_Stats( Lgm_RBF_Cache *c, long int *nHits, long int *nMisses, long int *nAdds, long int *nEvictions, long int *nEntries, double *size );
 
 
 
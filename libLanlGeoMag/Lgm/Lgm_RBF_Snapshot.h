@@ -0,0 +1,120 @@
+#ifndef LGM_RBF_SNAPSHOT_H
+#define LGM_RBF_SNAPSHOT_H
+
+#include <stdint.h>
+#include "Lgm/Lgm_Vec.h"
+#include "Lgm/Lgm_RBF.h"
+#include "Lgm/Lgm_KdTree.h"
+
+/*
+ *  Precomputed (partition of unity) RBF fits to a scattered-data field,
+ *  stored in a file that can be mmap'd and evaluated in place. See
+ *  Lgm_RBF_Snapshot.c.
+ *
+ *  The box [Min, Min + h*(nx,ny,nz)] is cut into cubic cells of side h. Each
+ *  cell holds a Lgm_Vec_RBF fit (to B, and optionally E) made with the K
+ *  data points nearest its center, and the field at a point is the blend of
+ *  the fits of the cells whose centers are within R of it. The file is
+ *
+ *      Lgm_RBF_SnapshotHeader
+ *      Lgm_RBF_SnapshotSlab[ nz ]          (one per layer of cells in z)
+ *      Lgm_RBF_SnapshotCell[ nx*ny*nz ]    (cell (i,j,k) is at (k*ny + j)*nx + i)
+ *      slab 0, slab 1, ...                 (each starts on a LGM_RBFS_ALIGN boundary)
+ *
+ *  A slab holds nArrays arrays of nCentres doubles each (x, y, z, eps_x,
+ *  eps_y, eps_z, then the B weights and, if HaveE, the E weights) for all of
+ *  the centres of the cells in its layer. A cell's centres are the n
+ *  consecutive entries starting at First. Everything is in native byte order.
+ */
+#define LGM_RBFS_MAGIC          "LGMRBFS1"
+#define LGM_RBFS_VERSION        1
+#define LGM_RBFS_ALIGN          64
+
+#define LGM_RBFS_X              0
+#define LGM_RBFS_Y              1
+#define LGM_RBFS_Z              2
+#define LGM_RBFS_EPS_X          3
+#define LGM_RBFS_EPS_Y          4
+#define LGM_RBFS_EPS_Z          5
+#define LGM_RBFS_CBX            6
+#define LGM_RBFS_CBY            7
+#define LGM_RBFS_CBZ            8
+#define LGM_RBFS_CEX            9
+#define LGM_RBFS_CEY            10
+#define LGM_RBFS_CEZ            11
+#define LGM_RBFS_NARRAYS        12
+
+typedef struct Lgm_RBF_SnapshotHeader {
+    char        Magic[8];               // LGM_RBFS_MAGIC (not nul terminated)
+    uint32_t    Version;                // LGM_RBFS_VERSION
+    int32_t     RadialBasisFunction;    // LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC or LGM_RBF_INV_MULTIQUADRIC
+    int32_t     HaveE;                  // E was fit too
+    int32_t     nArrays;                // Arrays per slab (9, or 12 with E)
+    int32_t     K;                      // Max centres per cell
+    int32_t     nx, ny, nz;             // Number of cells in each direction
+    double      Min[3];                 // Corner of the box
+    double      h;                      // Cell size
+    double      R;                      // Radius of the blending weights
+    double      Rmin;                   // Cells with centers inside this radius have no fit
+    uint64_t    nCells;
+    uint64_t    nCentres;               // Total over all slabs
+    uint64_t    SlabOffset;             // File offset of the slab table
+    uint64_t    CellOffset;             // File offset of the cell table
+} Lgm_RBF_SnapshotHeader;
+
+typedef struct Lgm_RBF_SnapshotSlab {
+    uint64_t    Offset;                 // File offset of the slab's first array
+    uint64_t    nCentres;               // Length of each of its arrays
+} Lgm_RBF_SnapshotSlab;
+
+typedef struct Lgm_RBF_SnapshotCell {
+    uint32_t    First;                  // Index of the cell's first centre in its slab
+    uint32_t    n;                      // Number of centres (0 if the cell has no fit)
+} Lgm_RBF_SnapshotCell;
+
+
+/*
+ *  An open snapshot. The pointers are into the mapping.
+ */
+typedef struct Lgm_RBF_Snapshot {
+    unsigned char           *Base;      // The mapped (or read in) file
+    size_t                  Size;
+    Lgm_RBF_SnapshotHeader  *Header;
+    Lgm_RBF_SnapshotSlab    *Slabs;
+    Lgm_RBF_SnapshotCell    *Cells;
+    double                  ih;         // 1/h
+    double                  R2;         // R*R
+    double                  iR2;        // 1/(R*R)
+} Lgm_RBF_Snapshot;
+
+
+int                 Lgm_RBF_Snapshot_Write( char *Filename, Lgm_KdTree *KdTree, int HaveE, double xmin, double xmax, double ymin, double ymax, double zmin, double zmax,
+                                            double h, double R, double Rmin, int K, double MaxDist2, int RadialBasisFunction );
+Lgm_RBF_Snapshot   *Lgm_RBF_Snapshot_Open( char *Filename );
+void                Lgm_RBF_Snapshot_Close( Lgm_RBF_Snapshot *s );
+int                 Lgm_RBF_Snapshot_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz,
+                                           Lgm_Vector *E, Lgm_Vector *dEdx, Lgm_Vector *dEdy, Lgm_Vector *dEdz, Lgm_RBF_Snapshot *s );
+void                Lgm_RBF_Snapshot_Prefetch( Lgm_RBF_Snapshot *s );
+
+
+/*
+ *  Two snapshots of a time dependent run, blended linearly in time (see
+ *  Lgm_RBF_Snapshot.c). Both are resident, and the one after them can be
+ *  queued (and prefetched) while they are in use. The snapshots are owned by
+ *  the pair.
+ */
+typedef struct Lgm_RBF_SnapshotPair {
+    Lgm_RBF_Snapshot    *s0, *s1;       // Snapshots at JD0 and JD1
+    double              JD0, JD1;       // Their times (Julian Dates)
+    Lgm_RBF_Snapshot    *Next;          // Queued by Lgm_RBF_SnapshotPair_Queue() (NULL if none); becomes s1 on Lgm_RBF_SnapshotPair_Advance()
+    double              JDNext;
+} Lgm_RBF_SnapshotPair;
+
+Lgm_RBF_SnapshotPair   *Lgm_RBF_SnapshotPair_Open( char *Filename0, double JD0, char *Filename1, double JD1 );
+int                     Lgm_RBF_SnapshotPair_Queue( Lgm_RBF_SnapshotPair *p, char *Filename, double JD );
+int                     Lgm_RBF_SnapshotPair_Advance( Lgm_RBF_SnapshotPair *p );
+void                    Lgm_RBF_SnapshotPair_Close( Lgm_RBF_SnapshotPair *p );
+int                     Lgm_RBF_SnapshotPair_Eval( double JD, Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz,
+                                                   Lgm_Vector *E, Lgm_Vector *dEdx, Lgm_Vector *dEdy, Lgm_Vector *dEdz, Lgm_RBF_SnapshotPair *p );
+
+#endif
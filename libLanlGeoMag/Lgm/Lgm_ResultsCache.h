@@ -0,0 +1,52 @@
+#ifndef LGM_RESULTS_CACHE_H
+#define LGM_RESULTS_CACHE_H
+
+#include "Lgm/uthash.h"
+
+/*
+ *  A persistent cache of the per time results of Lgm_ComputeLstarVersusPA()
+ *  (see Lgm_ResultsCache.c). It is a file of fixed size records, each keyed
+ *  by a hash of everything that went into it. A cache is opened with
+ *  Lgm_OpenResultsCache() and attached with
+ *  Lgm_MagEphemInfo_SetResultsCache(); copies of the MagEphemInfo share it.
+ *  The cache belongs to the caller.
+ */
+#define LGM_RESULTS_CACHE_MAGIC     0x3130304352474d4cUL    // "LGMRC001"
+#define LGM_RESULTS_CACHE_VERSION   2
+#define LGM_RESULTS_CACHE_NV        20
+
+#define LGM_RESULTS_CACHE_EPOCH     1       // the trace through the S/C position
+#define LGM_RESULTS_CACHE_PA        2       // the L* of one pitch angle
+
+/*
+ *  For a LGM_RESULTS_CACHE_EPOCH record v[] holds Ellipsoid_Footprint_Ps,
+ *  Ellipsoid_Footprint_Pn and Pmin (x,y,z each), Snorth, Ssouth, Smin, Bmin,
+ *  Mref, Mcurr, Mused, Sb0, d2B_ds2, RofC and LSimple, and Flag is the
+ *  FieldLineType. For a LGM_RESULTS_CACHE_PA record v[] holds Alpha, Lstar,
+ *  I, K, Sb and Tb, and Flag is the DriftOrbitType.
+ */
+typedef struct Lgm_ResultsCacheRecord {
+    unsigned long   Key;
+    int             Kind;
+    int             Flag;
+    double          v[LGM_RESULTS_CACHE_NV];
+} Lgm_ResultsCacheRecord;
+
+typedef struct Lgm_ResultsCacheEntry {
+    Lgm_ResultsCacheRecord  r;
+    UT_hash_handle          hh;
+} Lgm_ResultsCacheEntry;
+
+typedef struct Lgm_ResultsCache {
+    char                    Path[1024];
+    int                     fd;             // -1 if the cache is read only
+    Lgm_ResultsCacheEntry   *ht;            // hash table (uthash) of every record in the file
+    long int                nEntries;
+    long int                nHits, nMisses; // pitch angles found / not found
+    long int                nEpochHits;     // times with nothing left to compute
+} Lgm_ResultsCache;
+
+Lgm_ResultsCache    *Lgm_OpenResultsCache( char *Path, int ReadOnly );
+void                Lgm_CloseResultsCache( Lgm_ResultsCache *rc );
+
+#endif
@@ -105,6 +105,33 @@ typedef struct _SgpTLE {
 
 
 
+/*
+ *  A growable store of TLEs, for whole catalogs (or long histories) of
+ *  element sets. See LgmSgp_TleStore_Create() etc. in Lgm_Sgp.c.
+ */
+typedef struct _SgpTleStore {
+
+    int     nTLEs;      // Number of TLEs in TLEs[]
+    int     nAlloc;     // Number allocated
+    _SgpTLE *TLEs;      // In the order read
+
+    int     nIds;       // If > 0, only keep TLEs for the objects in Ids[] (sorted)
+    int     *Ids;
+
+    // Index (built by LgmSgp_TleStore_Index())
+    int     Indexed;    // FALSE if TLEs have been added since the index was made
+    int     *Order;     // TLE indices sorted by IdNumber and then epoch
+    double  *JD;        // JD[i] = TLEs[ Order[i] ].JD
+    int     nSats;      // Number of distinct objects
+    int     *SatId;     // Their IdNumbers (sorted)
+    int     *First;     // The TLEs of SatId[k] are Order[ First[k] ... First[k]+Count[k]-1 ]
+    int     *Count;
+    int     *Cursor;    // Where the last lookup for SatId[k] ended up
+
+} _SgpTleStore;
+
+
+
 
 
 typedef struct {
@@ -222,6 +249,12 @@ int     LgmSgp_ReadTlesFromFile( char *Filename, int *nTLEs, _SgpTLE *TLEs, int
 int     LgmSgp_ReadTlesFromStrings( char *Line0, char *Line1, char *Line2, int *nTLEs, _SgpTLE *TLEs, int Verbosity );
 int     LgmSgp_FindTLEforGivenTime( int nTLEs, _SgpTLE *TLEs, int SortOrder, double JD, int Verbosity );
 
+_SgpTleStore *LgmSgp_TleStore_Create( int nIds, int *Ids );
+void    LgmSgp_TleStore_Free( _SgpTleStore *st );
+int     LgmSgp_TleStore_ReadFile( _SgpTleStore *st, char *Filename, int Verbosity );
+void    LgmSgp_TleStore_Index( _SgpTleStore *st );
+int     LgmSgp_TleStore_Find( _SgpTleStore *st, int IdNumber, double JD );
+
 
 
 /*
@@ -240,6 +273,10 @@ int LgmSgp_SDP8_STR3( double TSINCE, _SgpInfo *s );
 int LgmSgp_SGP4( double TSINCE, _SgpInfo *s );
 
 int LgmSgp_SGP4_Init( _SgpInfo *s, _SgpTLE *t );
+int LgmSgp_SGP4_Times( _SgpInfo *s, int n, double *tsince, double *X, double *Y, double *Z,
+                    double *VX, double *VY, double *VZ, int *Error );
+int LgmSgp_SGP4_Batch( int nSat, _SgpInfo *s, _SgpTLE *t, int nTimes, double *JD,
+                    double **X, double **Y, double **Z, double **VX, double **VY, double **VZ, int **Error );
 
 void LgmSgp_GetGravConst( int whichconst, double *tumin, double *radiusearthkm,
                     double *xke, double *j2, double *j3, double *j4, double *j3oj2 );
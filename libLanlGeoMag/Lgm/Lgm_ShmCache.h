@@ -0,0 +1,23 @@
+#ifndef LGM_SHMCACHE_H
+#define LGM_SHMCACHE_H
+
+#include <stddef.h>
+
+/*
+ *  Cross-process cache of built tables in POSIX shared memory. See
+ *  Lgm_ShmCache.c.
+ */
+#define LGM_SHM_GRIDDED     1       // Lgm_GriddedField grids (Lgm_B_Gridded_Build())
+#define LGM_SHM_LSTARTABLE  2       // L* tables (Lgm_ComputeLstarTable())
+
+#define LGM_SHM_HEADER_SIZE 64      // Bytes in front of the data in each segment (keeps the data 64-byte aligned)
+
+void    Lgm_SetShmCache( int Flag );
+int     Lgm_GetShmCache( void );
+unsigned long Lgm_ShmCache_Key( unsigned long h, const void *p, size_t n );
+void   *Lgm_ShmCache_Find( int Kind, unsigned long Key, size_t *Size );
+void   *Lgm_ShmCache_Publish( int Kind, unsigned long Key, const void *Data, size_t Size );
+void    Lgm_ShmCache_Release( void *Data );
+int     Lgm_ShmCache_Remove( int Kind, unsigned long Key );
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef LGM_SIMDMATH_H
+#define LGM_SIMDMATH_H
+
+#include <math.h>
+#include <stdint.h>
+
+/*
+ *  Inline versions of a few libm functions for use inside "omp simd" loops.
+ *  The compiler can only vectorize a loop that calls exp() etc. if it has
+ *  vector versions of them, which (with gcc/glibc) only happens with
+ *  -ffast-math (or -fno-math-errno for sqrt). These are plain C (no
+ *  intrinsics) so they vectorize on anything, and they are accurate to about
+ *  2 ulp.
+ *
+ *  They are forced inline (a loop with a call in it doesnt vectorize, and at
+ *  -O2 gcc wont inline the bigger ones if they are used more than once).
+ */
+#if defined(__GNUC__)
+#define LGM_SIMD_INLINE static inline __attribute__((always_inline))
+#else
+#define LGM_SIMD_INLINE static inline
+#endif
+
+
+/*
+ *  exp(x). Range reduction x = n ln2 + r with |r| <= ln2/2 (ln2 split in two
+ *  so n ln2 is exact), exp(r) from its Taylor series through r^12 (the
+ *  truncation error is below 2e-16), and 2^n put straight into the exponent
+ *  bits. Rounding is done by adding and subtracting 1.5*2^52, and n goes into
+ *  the exponent by adding 2^52 (so that it ends up in the low mantissa bits)
+ *  and shifting; floor(), fmin() and double -> int64 conversions all keep gcc
+ *  from vectorizing unless -ffast-math is on. x is clamped to [-708, 709],
+ *  so very negative x gives ~1e-308 instead of 0 or a denormal.
+ */
+LGM_SIMD_INLINE double Lgm_SimdExp( double x ) {
+
+    union { double d; int64_t i; } u;
+    double  n, r, p;
+
+    x = ( x < -708.0 ) ? -708.0 : x;
+    x = ( x >  709.0 ) ?  709.0 : x;
+    n = ( x*1.4426950408889634074 + 6755399441055744.0 ) - 6755399441055744.0;  // round to nearest
+    r = x - n*6.93147180369123816490e-01;
+    r = r - n*1.90821492927058770002e-10;
+
+    p = 1.0/479001600.0;
+    p = p*r + 1.0/39916800.0;
+    p = p*r + 1.0/3628800.0;
+    p = p*r + 1.0/362880.0;
+    p = p*r + 1.0/40320.0;
+    p = p*r + 1.0/5040.0;
+    p = p*r + 1.0/720.0;
+    p = p*r + 1.0/120.0;
+    p = p*r + 1.0/24.0;
+    p = p*r + 1.0/6.0;
+    p = p*r + 0.5;
+    p = p*r + 1.0;
+    p = p*r + 1.0;
+
+    u.d = (n + 1023.0) + 4503599627370496.0;   // 2^52 + (n+1023), so the low bits hold n+1023
+    u.i <<= 52;                                 // move them into the exponent field
+
+    return( p*u.d );
+
+}
+
+/*
+ *  sqrt(x) for x >= 0. sqrt() itself is a single instruction, but since it
+ *  has to set errno for x < 0, gcc wont vectorize it unless -fno-math-errno
+ *  is on. Here 1/sqrt(x) is started off from the usual bit trick, refined
+ *  with four Newton steps (good to ~1e-20 after the fourth), and the last
+ *  step is done on sqrt(x) = x/sqrt(x) itself. Gives 0 for x = 0.
+ */
+LGM_SIMD_INLINE double Lgm_SimdSqrt( double x ) {
+
+    union { double d; int64_t i; } u;
+    double  y, s;
+
+    u.d = x;
+    u.i = 0x5fe6eb50c7b537a9 - ( u.i >> 1 );
+    y = u.d;
+    y = y*( 1.5 - 0.5*x*y*y );
+    y = y*( 1.5 - 0.5*x*y*y );
+    y = y*( 1.5 - 0.5*x*y*y );
+    y = y*( 1.5 - 0.5*x*y*y );
+    s = x*y;
+
+    return( s + 0.5*y*( x - s*s ) );
+
+}
+
+/*
+ *  sin(x) for |x| <= pi only (e.g. the sin(h theta) of a slerp, theta in
+ *  [0, pi]). |x| > pi/2 is folded back with sin(x) = sin(+-pi - x) and the
+ *  odd Taylor series is summed through x^21 (truncation error ~1e-18 at
+ *  pi/2).
+ */
+LGM_SIMD_INLINE double Lgm_SimdSin( double x ) {
+
+    double  x2, p;
+
+    x  = ( x >  1.57079632679489661923 ) ?  3.14159265358979323846 - x : x;
+    x  = ( x < -1.57079632679489661923 ) ? -3.14159265358979323846 - x : x;
+    x2 = x*x;
+
+    p = -1.0/51090942171709440000.0;
+    p = p*x2 + 1.0/121645100408832000.0;
+    p = p*x2 - 1.0/355687428096000.0;
+    p = p*x2 + 1.0/1307674368000.0;
+    p = p*x2 - 1.0/6227020800.0;
+    p = p*x2 + 1.0/39916800.0;
+    p = p*x2 - 1.0/362880.0;
+    p = p*x2 + 1.0/5040.0;
+    p = p*x2 - 1.0/120.0;
+    p = p*x2 + 1.0/6.0;
+
+    return( x - x*x2*p );
+
+}
+
+/*
+ *  tanh(x) = 1 - 2/(exp(2x)+1). Good to a couple of ulp of 1 (i.e. in
+ *  absolute terms); for |x| << 1 the relative error is larger than libm's.
+ */
+LGM_SIMD_INLINE double Lgm_SimdTanh( double x ) {
+
+    return( 1.0 - 2.0/( Lgm_SimdExp( 2.0*x ) + 1.0 ) );
+
+}
+
+/*
+ *  sin(x) and cos(x) together, for any |x| up to ~1e5. x = n pi/2 + r with
+ *  |r| <= pi/4 (pi/2 split in three so n pi/2 is exact enough), the Taylor
+ *  series of sin(r) through r^17 and cos(r) through r^18 (truncation errors
+ *  below 1e-19), and then the quadrant n mod 4 picks which is which. n mod 4
+ *  is n - 4*round(n/4 - 3/8), since floor() wont vectorize.
+ */
+LGM_SIMD_INLINE void Lgm_SimdSinCos( double x, double *s, double *c ) {
+
+    double  n, q, r, r2, ps, pc, sr, cr;
+
+    n = ( x*0.63661977236758134308 + 6755399441055744.0 ) - 6755399441055744.0;
+    r = x - n*1.57079632673412561417e+00;
+    r = r - n*6.07710050630396597660e-11;
+    r = r - n*2.02226624871116645580e-21;
+    r2 = r*r;
+
+    ps = 1.0/355687428096000.0;
+    ps = ps*r2 - 1.0/1307674368000.0;
+    ps = ps*r2 + 1.0/6227020800.0;
+    ps = ps*r2 - 1.0/39916800.0;
+    ps = ps*r2 + 1.0/362880.0;
+    ps = ps*r2 - 1.0/5040.0;
+    ps = ps*r2 + 1.0/120.0;
+    ps = ps*r2 - 1.0/6.0;
+    sr = r + r*r2*ps;
+
+    pc = 1.0/6402373705728000.0;
+    pc = pc*r2 - 1.0/20922789888000.0;
+    pc = pc*r2 + 1.0/87178291200.0;
+    pc = pc*r2 - 1.0/479001600.0;
+    pc = pc*r2 + 1.0/3628800.0;
+    pc = pc*r2 - 1.0/40320.0;
+    pc = pc*r2 + 1.0/720.0;
+    pc = pc*r2 - 1.0/24.0;
+    pc = pc*r2 + 0.5;
+    cr = 1.0 - r2*pc;
+
+    q = ( ( 0.25*n - 0.375 ) + 6755399441055744.0 ) - 6755399441055744.0;
+    q = n - 4.0*q;     // 0, 1, 2 or 3
+    *s = ( q == 0.0 ) ? sr : ( q == 1.0 ) ? cr : ( q == 2.0 ) ? -sr : -cr;
+    *c = ( q == 0.0 ) ? cr : ( q == 1.0 ) ? -sr : ( q == 2.0 ) ? -cr : sr;
+
+}
+
+/*
+ *  1.0 if the sign bit of x is set (x < 0, or -0), 0.0 if not. Done on the
+ *  bits (with the 2^52 trick of Lgm_SimdExp()) rather than with a test.
+ */
+LGM_SIMD_INLINE double Lgm_SimdSignBit( double x ) {
+
+    union { double d; uint64_t i; } u;
+
+    u.d = x;
+    u.i = ( u.i >> 63 ) | 0x4330000000000000;
+
+    return( u.d - 4503599627370496.0 );
+
+}
+
+/*
+ *  atan2(y, x). With t = min(|x|,|y|)/max(|x|,|y|) in [0, 1], atan(t) is
+ *  pi/4 + atan( (t-1)/(t+1) ) when t > tan(pi/8) (both done in one division),
+ *  which leaves an argument of at most tan(pi/8) ~ 0.414 for the Taylor
+ *  series, summed through t^41 (truncation error ~1e-18). Then a -> pi/2 - a
+ *  if |y| > |x|, pi - a if x < 0, and the sign of y goes on last (so, like
+ *  atan2(), y = -0 and x < 0 gives -pi). Good to a few ulp; gives +-0 for
+ *  x = y = 0.
+ */
+LGM_SIMD_INLINE double Lgm_SimdAtan2( double y, double x ) {
+
+    double  ax, ay, mx, mn, sw, sx, b, sg, f, t, t2, p;
+
+    ax = fabs( x );
+    ay = fabs( y );
+    mx = ( ay > ax ) ? ay : ax;
+    mn = ( ay > ax ) ? ax : ay;
+    // The answer is b + sg*a, worked out from 0/1 flags. The flags come from
+    // sign bits rather than tests, since gcc turns arithmetic on the result
+    // of a test into branches (and then wont vectorize the loop).
+    sw = Lgm_SimdSignBit( ax - ay );                        // |y| > |x|
+    sx = Lgm_SimdSignBit( x );                              // x < 0 (or -0)
+    b  = sw*1.57079632679489661923 + ( 1.0 - sw )*sx*3.14159265358979323846;
+    sg = 1.0 - 2.0*( sw - sx )*( sw - sx );
+    f  = Lgm_SimdSignBit( 0.41421356237309504880*mx - mn ); // t > tan(pi/8)
+    t  = ( mn - f*mx )/( mx + f*mn + Lgm_SimdSignBit( mx - 2.2250738585072014e-308 ) );   // (0/1 if x = y = 0)
+    t2 = t*t;
+
+    p = 1.0/41.0;
+    p = p*t2 - 1.0/39.0;
+    p = p*t2 + 1.0/37.0;
+    p = p*t2 - 1.0/35.0;
+    p = p*t2 + 1.0/33.0;
+    p = p*t2 - 1.0/31.0;
+    p = p*t2 + 1.0/29.0;
+    p = p*t2 - 1.0/27.0;
+    p = p*t2 + 1.0/25.0;
+    p = p*t2 - 1.0/23.0;
+    p = p*t2 + 1.0/21.0;
+    p = p*t2 - 1.0/19.0;
+    p = p*t2 + 1.0/17.0;
+    p = p*t2 - 1.0/15.0;
+    p = p*t2 + 1.0/13.0;
+    p = p*t2 - 1.0/11.0;
+    p = p*t2 + 1.0/9.0;
+    p = p*t2 - 1.0/7.0;
+    p = p*t2 + 1.0/5.0;
+    p = p*t2 - 1.0/3.0;
+    p = p*t2 + 1.0;
+
+    return( copysign( b + sg*( f*0.78539816339744830962 + t*p ), y ) );
+
+}
+
+/*
+ *  cbrt(x) for (normal) x > 0. x = 2^(3k) m with k = round(e/3) (e the
+ *  exponent of x, taken from the bits with the same 2^52 trick as
+ *  Lgm_SimdExp()) so that m is in [1/2, 4), cbrt(m) from a quartic fit (to
+ *  0.5%) and two Halley steps y -> y (y^3 + 2m)/(2y^3 + m) (the error
+ *  cubes at each one), and then 2^k put back in.
+ */
+LGM_SIMD_INLINE double Lgm_SimdCbrt( double x ) {
+
+    union { double d; int64_t i; } u;
+    double  k, m, y, y3;
+
+    u.d = x;
+    u.i = ( u.i >> 52 ) | 0x4330000000000000;       // 2^52 + biased exponent
+    k = ( ( u.d - 4503599627370496.0 - 1023.0 )*0.33333333333333333333 + 6755399441055744.0 ) - 6755399441055744.0;
+    u.d = (1023.0 - 3.0*k) + 4503599627370496.0;
+    u.i <<= 52;
+    m = x*u.d;
+
+    y = -0.0036601650194092485;
+    y = y*m + 0.04437845996234109;
+    y = y*m - 0.21580018957752176;
+    y = y*m + 0.654297311720155;
+    y = y*m + 0.5189978361037294;
+    y3 = y*y*y; y = y*( y3 + 2.0*m )/( 2.0*y3 + m );
+    y3 = y*y*y; y = y*( y3 + 2.0*m )/( 2.0*y3 + m );
+
+    u.d = (k + 1023.0) + 4503599627370496.0;
+    u.i <<= 52;
+
+    return( y*u.d );
+
+}
+
+#endif
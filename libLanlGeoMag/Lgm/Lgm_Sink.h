@@ -0,0 +1,27 @@
+#ifndef LGM_SINK_H
+#define LGM_SINK_H
+
+#include <stdio.h>
+
+/*
+ *  Output files for the text writers that can be gzip'ed on the fly. See
+ *  Lgm_Sink.c.
+ */
+#define LGM_SINK_BLOCK_SIZE     (1<<20)     // Bytes of text per compressed block (gzip member)
+#define LGM_SINK_THREADS        2           // Default number of compressor threads
+
+typedef struct Lgm_Sink {
+    FILE        *fp;                        // What the writers fprintf() into
+    char        *Filename;
+    int         Compressed;                 // TRUE if the file is being gzip'ed
+    long int    nBytes;                     // Size of the file as of the last Lgm_Sink_Flush()
+    void        *Gz;                        // The compressor (if Compressed)
+} Lgm_Sink;
+
+int         Lgm_Sink_IsGzipName( const char *Filename );
+Lgm_Sink   *Lgm_Sink_Open( const char *Filename, const char *Mode, int nThreads );
+long int    Lgm_Sink_Flush( Lgm_Sink *s );
+int         Lgm_Sink_Close( Lgm_Sink *s );
+FILE       *Lgm_OpenSource( const char *Filename );
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LGM_STAGE_HOOKS_H
+#define LGM_STAGE_HOOKS_H
+
+/*
+ *  Callbacks at the stage boundaries of the L* and MagEphem calculations (see
+ *  Lgm_StageHooks.c). A table is made with Lgm_InitStageHooks(), filled in
+ *  with Lgm_StageHooks_Set() and attached with Lgm_LstarInfo_SetStageHooks()
+ *  or Lgm_MagEphemInfo_SetStageHooks(). The table belongs to the caller.
+ *
+ *  A callback that returns non-zero cancels the calculation: Lstar() returns
+ *  LGM_LSTAR_CANCELLED with LS set to LGM_FILL_VALUE, and the pitch angles of
+ *  Lgm_ComputeLstarVersusPA() that are not done yet get fill values.
+ */
+#define LGM_STAGE_TRACE_BEGIN       0       // Lgm_Trace() started
+#define LGM_STAGE_TRACE_END         1       // Lgm_Trace() finished
+#define LGM_STAGE_FINDSHELLLINE     2       // one FindShellLine() search of a drift shell line finished
+#define LGM_STAGE_MAGFLUX_BEGIN     3       // the flux integrals of Lstar() started
+#define LGM_STAGE_MAGFLUX_END       4       // the flux integrals of Lstar() finished
+#define LGM_STAGE_PITCHANGLE_DONE   5       // one pitch angle of Lgm_ComputeLstarVersusPA() finished
+#define LGM_STAGE_N                 6
+
+#define LGM_LSTAR_CANCELLED         -10     // returned by Lstar() when a stage callback cancelled it
+
+/*
+ *  What a callback is told. The counts are totals (over all threads) since
+ *  the table was attached or last reset.
+ */
+typedef struct Lgm_StageEvent {
+    int         Stage;          // LGM_STAGE_*
+    int         Index;          // drift shell line (FINDSHELLLINE) or pitch angle (PITCHANGLE_DONE) number, else -1
+    double      Elapsed;        // seconds since the table was attached or last reset
+    double      StageTime;      // seconds spent in the stage (the _END and _DONE stages), else 0
+    double      Value;          // L* (PITCHANGLE_DONE), field line type (TRACE_END), I found (FINDSHELLLINE), else 0
+    long int    nMagEvals;      // Lgm_nMagEvals of the calling thread's Lgm_MagModelInfo
+    long int    nTraces;        // Lgm_Trace() calls finished
+    long int    nFindShellLine; // FindShellLine() searches finished
+    long int    nMagFlux;       // flux integrals finished
+    long int    nPitchAngles;   // pitch angles finished
+} Lgm_StageEvent;
+
+typedef int (*Lgm_StageHookFunc)( Lgm_StageEvent *Event, void *Data );
+
+typedef struct Lgm_StageHooks {
+    Lgm_StageHookFunc   Hook[LGM_STAGE_N];  // NULL for stages nobody wants to hear about
+    void                *Data;              // handed to every callback
+
+    double              t0;
+    long int            nTraces;
+    long int            nFindShellLine;
+    long int            nMagFlux;
+    long int            nPitchAngles;
+    volatile int        Cancelled;          // set once a callback has returned non-zero
+} Lgm_StageHooks;
+
+/*
+ *  For the library code (Info is a Lgm_MagModelInfo *). With no table
+ *  attached these cost one test. LGM_STAGE_FIRE() is TRUE if the
+ *  calculation has been cancelled.
+ */
+#define LGM_STAGE_NOW( Info )               ( ( (Info)->Hooks != NULL ) ? Lgm_StageHooks_Now() : 0.0 )
+#define LGM_STAGE_FIRE( Info, Stage, Index, t0, Value )     ( ( (Info)->Hooks != NULL ) && Lgm_StageHooks_Fire( (Info)->Hooks, (Stage), (Index), (t0), (Value), (Info)->Lgm_nMagEvals ) )
+#define LGM_STAGE_CANCELLED( Info )         ( ( (Info)->Hooks != NULL ) && (Info)->Hooks->Cancelled )
+
+Lgm_StageHooks  *Lgm_InitStageHooks( void *Data );
+void            Lgm_FreeStageHooks( Lgm_StageHooks *Hooks );
+void            Lgm_StageHooks_Set( int Stage, Lgm_StageHookFunc Func, Lgm_StageHooks *Hooks );
+void            Lgm_StageHooks_Reset( Lgm_StageHooks *Hooks );
+double          Lgm_StageHooks_Now( void );
+int             Lgm_StageHooks_Fire( Lgm_StageHooks *Hooks, int Stage, int Index, double t0, double Value, long int nMagEvals );
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef LGM_TASKS_H
+#define LGM_TASKS_H
+
+/*
+ *  One shared pool for the library's parallel loops. See Lgm_Tasks.c.
+ *
+ *  Routines that have independent pieces of work (pitch angles in
+ *  Lgm_ComputeLstarVersusPA(), K's in Lgm_F2P_GetPsdAtConstMusAndKs(), times
+ *  in a caller's own loop, ...) hand them to Lgm_ParallelFor() as n calls of
+ *  Task( i, Data ), i = 0..n-1. The executor decides where they run. The
+ *  default one turns them into OpenMP tasks, so a Lgm_ParallelFor() that is
+ *  called from inside another one (or from inside any OpenMP parallel region)
+ *  adds its tasks to the threads that are already running instead of
+ *  starting a nested team.
+ *
+ *  A Task must not depend on which thread it runs on (omp_get_thread_num()
+ *  is not a safe index for scratch space -- a thread waiting on its own
+ *  subtasks may pick up other tasks in the meantime).
+ */
+typedef void (*Lgm_TaskFunc)( long int i, void *Data );
+
+/*
+ *  An executor must call Task( i, Data ) exactly once for each i = 0..n-1,
+ *  in any order and on any threads, and return only when all of them are
+ *  done. ExecData is whatever was given to Lgm_SetExecutor().
+ */
+typedef void (*Lgm_ExecutorFunc)( long int n, Lgm_TaskFunc Task, void *Data, void *ExecData );
+
+void    Lgm_ParallelFor( long int n, Lgm_TaskFunc Task, void *Data );
+void    Lgm_SetExecutor( Lgm_ExecutorFunc Executor, void *ExecData );
+void    Lgm_DefaultExecutor( long int n, Lgm_TaskFunc Task, void *Data, void *ExecData );
+void    Lgm_SerialExecutor( long int n, Lgm_TaskFunc Task, void *Data, void *ExecData );
+
+/*
+ *  Deterministic mode. When it is on, the routines that hand work out as
+ *  tasks start every task from the same (canonical) state and leave out the
+ *  shortcuts whose results depend on which thread got there first, so the
+ *  answers are the same bit for bit whatever the number of threads or the
+ *  order the tasks ran in. Off by default. See Lgm_Tasks.c.
+ */
+void    Lgm_SetDeterministic( int Flag );
+int     Lgm_GetDeterministic( void );
+
+/*
+ *  Cap on the number of threads used by the parallel loops (n <= 0 means no
+ *  cap, i.e. use the OpenMP default). Lgm_GetMaxThreads() gives the number
+ *  a loop started now would get.
+ */
+void    Lgm_SetMaxThreads( int n );
+int     Lgm_GetMaxThreads( void );
+
+/*
+ *  NUMA placement and thread pinning. See Lgm_Numa.c. Per-node copies of
+ *  things are indexed by Lgm_NumaHome(), which is always 0 unless
+ *  Lgm_SetNumaAware( TRUE ) has been called.
+ */
+#define LGM_NUMA_MAX_NODES  16
+
+int     Lgm_NumaNodes( void );
+int     Lgm_NumaNode( void );
+int     Lgm_NumaHome( void );
+void    Lgm_SetNumaAware( int Flag );
+int     Lgm_GetNumaAware( void );
+void    Lgm_SetThreadPinning( int Flag );
+int     Lgm_GetThreadPinning( void );
+int     Lgm_PinThread( int k );
+
+#endif
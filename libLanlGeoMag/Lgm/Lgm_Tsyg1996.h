@@ -30,6 +30,15 @@ typedef struct _CB_T96_WARP       { double  CPSS, SPSS, DPSRR, RPS, WARP, D, XS,
                                             DDZETADX, DDZETADY, DDZETADZ, ZSWW;         } _CB_T96_WARP;
 
 
+/*
+ * Point-independent quantities of the T96 model (they depend only on
+ * PARMOD[1-4] and the tilt). Filled in by Lgm_Prepare_T96().
+ */
+typedef struct _T96_PREP          { double  PARMOD[5], PS, BYIMF, BZIMF, CT, ST,
+                                            RCAMPL, TAMPL2, TAMPL3, B1AMPL, B2AMPL,
+                                            RECONN, RIMFAMPL, XAPPA, XAPPA3, X0, AM, ASQ; } _T96_PREP;
+
+
 
 /*
  * Define a structure to hold all of the info needed in TS04
@@ -60,6 +69,16 @@ typedef struct LgmTsyg1996_Info {
     double      OLD_PDYN;
 
 
+    /*
+     *  Per-epoch state. Tsyg_T96() compares its PARMOD and PS against the
+     *  values held in Prep and calls Lgm_Prepare_T96() again only when they
+     *  differ, so changing the solar wind inputs or the time is picked up
+     *  automatically.
+     */
+    int         Prepared;
+    _T96_PREP   Prep;
+
+
     int         INTERCON_M_FLAG;
     double      P[4], R[4], RP[4], RR[4], SQPR[4][4];
 
@@ -108,6 +127,7 @@ typedef struct LgmTsyg1996_Info {
  *  Function declarations
  */
 void    Lgm_Init_T96( LgmTsyg1996_Info *t );
+void    Lgm_Prepare_T96( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg1996_Info *t );
 void    Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg1996_Info *tInfo ) ;
 void    DIPSHLD_T96( double PS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg1996_Info *tInfo ) ;
 void    CYLHARM_T96( double A[], double X, double Y, double Z, double *BX, double *BY, double *BZ ) ;
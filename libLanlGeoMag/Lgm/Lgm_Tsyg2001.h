@@ -32,6 +32,17 @@ typedef struct _CB_T01S_MODENUM     { int    M;                              } _
 typedef struct _CB_T01S_DTHETA      { double DTHETA;                         } _CB_T01S_DTHETA;
 
 
+/*
+ * Point-independent quantities of the T01S and T02 models (they depend only
+ * on the EXTALL inputs A, PDYN, DST, BYIMF, BZIMF, G1-G3 and PS). Filled in by
+ * T01S_PREPARE() or T02_PREPARE(). The two models share the info structure;
+ * they use different coefficient arrays, so A tells them apart.
+ */
+typedef struct _T01_PREP            { double *A, PDYN, DST, BYIMF, BZIMF, G1, G2, G3, PS;
+                                      double SPS, XAPPA, XAPPA3, X0, AM, ASQ, STHETAH, OIMFY, OIMFZ;
+                                      double TAMP1, TAMP2, A_SRC, A_PRC, A_R11, A_R12, A_R21, A_R22; } _T01_PREP;
+
+
 
 /*
  * Define a structure to hold all of the info needed in TS04
@@ -76,6 +87,16 @@ typedef struct LgmTsyg2001_Info {
     double      SQPR[4][4][4], SQQS[4][4][4], EPR[4][4][4], EQS[4][4][4];
 
 
+    /*
+     *  Per-epoch state. T01S_EXTALL()/T02_EXTALL() compare their inputs
+     *  against the values held in Prep and re-prepare only when they differ,
+     *  so changing the solar wind inputs or the time is picked up
+     *  automatically.
+     */
+    int         Prepared;
+    _T01_PREP   Prep;
+
+
 
 
 } LgmTsyg2001_Info;
@@ -89,6 +110,9 @@ typedef struct LgmTsyg2001_Info {
 /*
  *  Function declarations for T01S (aka TSK03)
  */
+void Lgm_Prepare_T01S( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2001_Info *t );
+void T01S_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double G1, double G2, double G3,
+                    double PS, LgmTsyg2001_Info *t );
 void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT, double PDYN, double DST, double BYIMF,
                     double BZIMF, double G1, double G2, double G3, double PS, double X, double Y, double Z,
                     double *BXCF, double *BYCF, double *BZCF, double *BXT1, double *BYT1, double *BZT1,
@@ -136,6 +160,9 @@ void    T01S_DIPOLE( double PS, double X, double Y, double Z, double *BX, double
 /*
  *  Function declarations for T02 (aka T01_01)
  */
+void Lgm_Prepare_T02( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2001_Info *t );
+void T02_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double VBIMF1, double VBIMF2,
+                    double PS, LgmTsyg2001_Info *t );
 void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT, double PDYN, double DST, double BYIMF,
                     double BZIMF, double G1, double G2, double PS, double X, double Y, double Z,
                     double *BXCF, double *BYCF, double *BZCF, double *BXT1, double *BYT1, double *BZT1,
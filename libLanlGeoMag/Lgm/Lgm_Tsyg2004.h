@@ -36,6 +36,16 @@ typedef struct _CB_MODENUM     { int    M;                              } _CB_MO
 typedef struct _CB_DTHETA      { double DTHETA;                         } _CB_DTHETA;
 
 
+/*
+ * Point-independent quantities of the TS04 model (they depend only on the
+ * TS04_EXTERN() inputs A, PDYN, DST, BYIMF, BZIMF and W1-W6). Filled in by
+ * TS04_PREPARE().
+ */
+typedef struct _TS04_PREP      { double *A, PDYN, DST, BYIMF, BZIMF, W1, W2, W3, W4, W5, W6;
+                                 double XAPPA, XAPPA3, X0, AM, ASQ, OIMFY, OIMFZ;
+                                 double TAMP1, TAMP2, A_SRC, A_PRC, A_R11, A_R21;  } _TS04_PREP;
+
+
 /*
  * Define a structure to hold all of the info needed in TS04
  */
@@ -82,6 +92,17 @@ typedef struct LgmTsyg2004_Info {
     double      SQPR[4][4][4], SQQS[4][4][4], EPR[4][4][4], EQS[4][4][4];
     double      XAPPA;
 
+
+    /*
+     *  Per-epoch state. TS04_EXTERN() compares its inputs against the values
+     *  held in Prep and calls TS04_PREPARE() again only when they differ, so
+     *  changing the solar wind inputs is picked up automatically. (The
+     *  tilt-dependent parts are cached separately by the individual field
+     *  routines.)
+     */
+    int         Prepared;
+    _TS04_PREP  Prep;
+
     /*
      * variable to capture the "region" we are in. Can be;
      *      LGM_TS04_MAGNETOSPHERE
@@ -104,6 +125,9 @@ typedef struct LgmTsyg2004_Info {
  *  Function declarations
  */
 void Lgm_Init_TS04( LgmTsyg2004_Info *t );
+void Lgm_Prepare_TS04( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2004_Info *t );
+void TS04_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double W1, double W2, double W3,
+                double W4, double W5, double W6, LgmTsyg2004_Info *tInfo );
 void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT, double PDYN, double DST, double BXIMF, double BYIMF,
                 double BZIMF, double W1, double W2, double W3, double W4, double W5, double W6, double PS,
                 double X, double Y, double Z, double *BXCF, double *BYCF, double *BZCF, double *BXT1, double *BYT1,
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <math.h>
 
 /*
@@ -47,7 +48,8 @@ typedef struct LgmTsyg2007_Info {
     _CB7_DTHETA       CB_DTHETA;
 
 
-    int     ArraysAlloced;
+    int     ArraysAlloced;  // A is ours to free
+    int     TailAlloced;    // TSS, TSO and TSE are ours to free (FALSE if they belong to a Lgm_MagModelConfig)
     double  *A;
     double  **TSS;    //[81][6];
     double  ***TSO;   //[81][6][5];
@@ -96,6 +98,43 @@ typedef struct LgmTsyg2007_Info {
 
 
 
+/*
+ *  Packed binary archive of TS07D coefficients (see Lgm_TS07_Archive.c)
+ */
+#define LGM_TS07_ARCHIVE_MAGIC      "LGMTS07"
+#define LGM_TS07_ARCHIVE_VERSION    1
+#define LGM_TS07_ARCHIVE_NAME       "TS07D_Coeffs.bin"
+#define LGM_TS07_NA                 101             // number of per-epoch coeffs
+#define LGM_TS07_NTAIL              (80*5 + 2*80*5*4) // number of tail coeffs (TSS, TSO and TSE)
+#define LGM_TS07_SLOTS_PER_DAY      288             // 5-minute epochs per day
+
+typedef struct Lgm_TS07_ArchiveHeader {
+    char        Magic[8];           // LGM_TS07_ARCHIVE_MAGIC
+    int32_t     Version;            // LGM_TS07_ARCHIVE_VERSION
+    int32_t     nA;                 // LGM_TS07_NA
+    int32_t     nTail;              // LGM_TS07_NTAIL
+    int32_t     Pad;
+    double      ByteOrder;          // 1.0 (used to detect archives written on a machine with a different byte order)
+    int64_t     JDN0;               // Julian day number of the first day in the archive
+    int64_t     nSlots;             // number of 5-minute slots in the index
+    int64_t     nRecords;           // number of coefficient records
+    int64_t     TailOffset;         // byte offsets of the sections
+    int64_t     IndexOffset;
+    int64_t     DataOffset;
+} Lgm_TS07_ArchiveHeader;
+
+typedef struct Lgm_TS07_Archive {
+    unsigned char               *Base;      // start of mapped file
+    size_t                      Size;       // size of mapped file
+    const Lgm_TS07_ArchiveHeader *Header;
+    const double                *Tail;
+    const int32_t               *Index;
+    const double                *Data;
+    int64_t                     Slot0;      // slot number of Index[0]
+} Lgm_TS07_Archive;
+
+
+
 
 
 
@@ -105,6 +144,18 @@ typedef struct LgmTsyg2007_Info {
  */
 void Lgm_Init_TS07( LgmTsyg2007_Info *t );
 void Lgm_SetCoeffs_TS07( long int Date, double UTC, LgmTsyg2007_Info *t );
+int  Lgm_Read_TS07_TailPar( const char *Path, LgmTsyg2007_Info *t );
+int  Lgm_Read_TS07_CoeffFile( const char *Filename, double *A );
+
+void              Lgm_TS07_ArchiveFilename( char *Filename, int n );
+Lgm_TS07_Archive *Lgm_TS07_OpenArchive( const char *Filename );
+void              Lgm_TS07_CloseArchive( Lgm_TS07_Archive *a );
+Lgm_TS07_Archive *Lgm_TS07_GetArchive( );
+const double     *Lgm_TS07_ArchiveCoeffs( Lgm_TS07_Archive *a, long int Date, double UTC );
+void              Lgm_TS07_ArchiveTailPar( Lgm_TS07_Archive *a, LgmTsyg2007_Info *t );
+long int          Lgm_TS07_BuildArchive( const char *Path, long int StartDate, long int EndDate, const char *ArchiveFile );
+int               Lgm_TS07_PrefetchDay( long int Date );
+int               Lgm_TS07_CachedCoeffs( long int Date, double UTC, double *A );
 
 void Tsyg_TS07( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z,
                 double *BX, double *BY, double *BZ, LgmTsyg2007_Info *tInfo );
@@ -136,6 +187,7 @@ void TS07D_SHTBNORM_E( int K, int L, double X, double Y, double Z, double *FX, d
 double  bessj0( double x );
 double  bessj1( double x );
 double  bessj( int n, double x );
+void    bessj_array( int M, double x, double *J );
 void     TS07D_BIRK_TOT( double PS, double X, double Y, double Z,
         double *BX11, double *BY11, double *BZ11, double *BX12, double *BY12, double *BZ12,
         double *BX21, double *BY21, double *BZ21, double *BX22, double *BY22, double *BZ22, LgmTsyg2007_Info *tInfo );
@@ -0,0 +1,159 @@
+#ifndef LGM_VECINLINE_H
+#define LGM_VECINLINE_H
+
+#include <math.h>
+#include "Lgm/Lgm_Vec.h"
+
+/*
+ *  Inline versions of the small Lgm_Vector routines in Lgm_Vec.c, for the
+ *  hot loops (integrator steps, RBF sums, coordinate transforms) where a call
+ *  costs more than the three or so flops it does. Including this header
+ *  (after config.h) redirects calls like Lgm_DotProduct( &a, &b ) to the
+ *  inline versions; taking the address of one still gets the routine in
+ *  Lgm_Vec.c, which stays exported as before. The arithmetic is done in the
+ *  same order as in Lgm_Vec.c (including what happens when an output
+ *  overlaps an input), so results are bit for bit the same.
+ *
+ *  It is not included by Lgm_Vec.h, so the public headers (and the Python
+ *  wrappers generated from them) are unchanged.
+ *
+ *  The _SoA routines do the same operations on n vectors held as separate
+ *  x, y, z arrays, for the batched paths.
+ */
+
+#if USE_OPENMP
+#define LGM_VEC_SIMD    _Pragma( "omp simd" )
+#else
+#define LGM_VEC_SIMD
+#endif
+
+
+static inline void Lgm_CrossProduct_Inline( Lgm_Vector *a, Lgm_Vector *b, Lgm_Vector *c ) {
+    c->x = (a->y * b->z) - (a->z * b->y);
+    c->y = (a->z * b->x) - (a->x * b->z);
+    c->z = (a->x * b->y) - (a->y * b->x);
+}
+
+static inline double Lgm_DotProduct_Inline( Lgm_Vector *a, Lgm_Vector *b ) {
+    return( a->x * b->x + a->y * b->y + a->z * b->z );
+}
+
+static inline double Lgm_Magnitude_Inline( Lgm_Vector *a ) {
+    return( sqrt( (a->x * a->x) + (a->y * a->y) + (a->z * a->z) ) );
+}
+
+static inline double Lgm_NormalizeVector_Inline( Lgm_Vector *a ) {
+    double  magnitude, inv;
+    magnitude = Lgm_Magnitude_Inline( a );
+    if ( magnitude > 0.0 ) {
+        inv = 1.0/magnitude;
+        a->x *= inv; a->y *= inv; a->z *= inv;
+        return( magnitude );
+    }
+    return( -1.0 );
+}
+
+static inline void Lgm_ScaleVector_Inline( Lgm_Vector *a, double value ) {
+    a->x *= value; a->y *= value; a->z *= value;
+}
+
+static inline void Lgm_VecSub_Inline( Lgm_Vector *c, Lgm_Vector *a, Lgm_Vector *b ) {
+    c->x = a->x - b->x; c->y = a->y - b->y; c->z = a->z - b->z;
+}
+
+static inline void Lgm_VecAdd_Inline( Lgm_Vector *c, Lgm_Vector *a, Lgm_Vector *b ) {
+    c->x = a->x + b->x; c->y = a->y + b->y; c->z = a->z + b->z;
+}
+
+static inline double Lgm_VecDiffMag_Inline( Lgm_Vector *a, Lgm_Vector *b ) {
+    Lgm_Vector  c;
+    Lgm_VecSub_Inline( &c, a, b );
+    return( Lgm_Magnitude_Inline( &c ) );
+}
+
+static inline void Lgm_ForceMagnitude_Inline( Lgm_Vector *a, double mag ) {
+    Lgm_NormalizeVector_Inline( a );
+    Lgm_ScaleVector_Inline( a, mag );
+}
+
+// Same (transposed) indexing as Lgm_MatTimesVec().
+static inline void Lgm_MatTimesVec_Inline( double A[3][3], Lgm_Vector *V, Lgm_Vector *Result ) {
+    Result->x = A[0][0]*V->x + A[1][0]*V->y + A[2][0]*V->z;
+    Result->y = A[0][1]*V->x + A[1][1]*V->y + A[2][1]*V->z;
+    Result->z = A[0][2]*V->x + A[1][2]*V->y + A[2][2]*V->z;
+}
+
+#define Lgm_CrossProduct( a, b, c )         Lgm_CrossProduct_Inline( a, b, c )
+#define Lgm_DotProduct( a, b )              Lgm_DotProduct_Inline( a, b )
+#define Lgm_Magnitude( a )                  Lgm_Magnitude_Inline( a )
+#define Lgm_NormalizeVector( a )            Lgm_NormalizeVector_Inline( a )
+#define Lgm_ScaleVector( a, v )             Lgm_ScaleVector_Inline( a, v )
+#define Lgm_VecSub( c, a, b )               Lgm_VecSub_Inline( c, a, b )
+#define Lgm_VecAdd( c, a, b )               Lgm_VecAdd_Inline( c, a, b )
+#define Lgm_VecDiffMag( a, b )              Lgm_VecDiffMag_Inline( a, b )
+#define Lgm_ForceMagnitude( a, m )          Lgm_ForceMagnitude_Inline( a, m )
+#define Lgm_MatTimesVec( A, V, R )          Lgm_MatTimesVec_Inline( A, V, R )
+
+
+
+/*
+ *  d[i] = a[i] . b[i]
+ */
+static inline void Lgm_DotProduct_SoA( long int n, const double *ax, const double *ay, const double *az,
+                                       const double *bx, const double *by, const double *bz, double *d ) {
+    long int    i;
+    LGM_VEC_SIMD
+    for ( i=0; i<n; i++ ) d[i] = ax[i]*bx[i] + ay[i]*by[i] + az[i]*bz[i];
+}
+
+/*
+ *  c[i] = a[i] x b[i]. c must not overlap a or b.
+ */
+static inline void Lgm_CrossProduct_SoA( long int n, const double *ax, const double *ay, const double *az,
+                                         const double *bx, const double *by, const double *bz,
+                                         double *cx, double *cy, double *cz ) {
+    long int    i;
+    LGM_VEC_SIMD
+    for ( i=0; i<n; i++ ) {
+        cx[i] = (ay[i] * bz[i]) - (az[i] * by[i]);
+        cy[i] = (az[i] * bx[i]) - (ax[i] * bz[i]);
+        cz[i] = (ax[i] * by[i]) - (ay[i] * bx[i]);
+    }
+}
+
+/*
+ *  Normalizes the n vectors in place. Mag[i] (if Mag is not NULL) gets the
+ *  magnitude, or -1 (and the vector is left alone) for a zero vector, as
+ *  Lgm_NormalizeVector() returns.
+ */
+static inline void Lgm_NormalizeVector_SoA( long int n, double *x, double *y, double *z, double *Mag ) {
+    long int    i;
+    LGM_VEC_SIMD
+    for ( i=0; i<n; i++ ) {
+        double  m, inv;
+        m   = sqrt( x[i]*x[i] + y[i]*y[i] + z[i]*z[i] );
+        inv = ( m > 0.0 ) ? 1.0/m : 1.0;
+        x[i] *= inv; y[i] *= inv; z[i] *= inv;
+        if ( Mag ) Mag[i] = ( m > 0.0 ) ? m : -1.0;
+    }
+}
+
+/*
+ *  r[i] = A v[i], with the same indexing as Lgm_MatTimesVec(). r may be v.
+ */
+static inline void Lgm_MatTimesVec_SoA( long int n, double A[3][3], const double *vx, const double *vy, const double *vz,
+                                        double *rx, double *ry, double *rz ) {
+    long int    i;
+    double      a00 = A[0][0], a01 = A[0][1], a02 = A[0][2];
+    double      a10 = A[1][0], a11 = A[1][1], a12 = A[1][2];
+    double      a20 = A[2][0], a21 = A[2][1], a22 = A[2][2];
+    LGM_VEC_SIMD
+    for ( i=0; i<n; i++ ) {
+        double  x = vx[i], y = vy[i], z = vz[i];
+        rx[i] = a00*x + a10*y + a20*z;
+        ry[i] = a01*x + a11*y + a21*z;
+        rz[i] = a02*x + a12*y + a22*z;
+    }
+}
+
+#endif
@@ -12,13 +12,19 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_DynamicMemory.h"
 #include "Lgm/Lgm_AE8_AP8.h"
+#include "Lgm/Lgm_Tasks.h"
 
 static int AE8MIN_IHEAD[] = { 0,      8,      4,   1964,   6400,   2100,   1024,   1024,  13168 };
 static int AE8MIN_MAP[] = { 0,
@@ -5579,10 +5585,14 @@ double  TRARA2( int MAP[], int IL, int IB, double FISTEP ) {
                         flag4 = 1;
                     } else {
                         FKB1 = 0.0;
+                        done = 1;
                     }
                 }
+            } else if ( flag5 ) {
+                // second pass (after the swap) found the B/B0 block; start at J2 = 4 (label 30 of the fortran)
+                done = 1;
             }
-            if ( (flag == 0) && (flag3 == 0) && (flag4 == 0) ) FKB2 = 0.0;
+            if ( (flag3 == 0) && (flag4 == 0) ) FKB2 = 0.0;
         } else {
             done = 1;
         }
@@ -5701,6 +5711,479 @@ double  TRARA2( int MAP[], int IL, int IB, double FISTEP ) {
 }
 
 
+/*
+ *  Decoded (dense) versions of the model MAPs, made the first time they are
+ *  needed by Lgm_AE8_AP8_GetTable(). One set per NUMA node if
+ *  Lgm_SetNumaAware( TRUE ) (otherwise only [0] is used).
+ */
+static Lgm_AE8_AP8_Table *Lgm_AE8_AP8_Tables[LGM_NUMA_MAX_NODES][LGM_AE8MIN+1];
+
+
+/*
+ *  Decode the MAP of a model into a Lgm_AE8_AP8_Table. Each energy sub-map is
+ *  a chain of variable length L blocks; here every block gets a fixed size
+ *  row, Row[e][n][], holding the same numbers (Row[e][n][1] = block length,
+ *  [2] = scaled L, [3] = scaled log flux, [4..length] = B/B0 increments). The
+ *  last block of each energy is the L = 32767 sentinel.
+ */
+static Lgm_AE8_AP8_Table *Lgm_AE8_AP8_DecodeMap( int MODEL ) {
+
+    Lgm_AE8_AP8_Table   *t;
+    int                 *MAP, *IHEAD, ***Row, **Ls;
+    int                 I, J, e, n, k, nE, nNodes, nRow;
+
+    switch ( MODEL ) {
+        case LGM_AP8MAX: MAP = AP8MAX_MAP; IHEAD = AP8MAX_IHEAD; break;
+        case LGM_AP8MIN: MAP = AP8MIN_MAP; IHEAD = AP8MIN_IHEAD; break;
+        case LGM_AE8MAX: MAP = AE8MAX_MAP; IHEAD = AE8MAX_IHEAD; break;
+        case LGM_AE8MIN: MAP = AE8MIN_MAP; IHEAD = AE8MIN_IHEAD; break;
+        default:
+            printf( "Lgm_AE8_AP8_DecodeMap: Unknown model. MODEL = %d\n", MODEL);
+            return( NULL );
+    }
+
+
+    /*
+     *  Sizes. The energy sub-maps are chained by their lengths (MAP[I+1])
+     *  and end with a zero length.
+     */
+    nE = nNodes = nRow = 0;
+    for ( I=0; MAP[I+1] != 0; I += MAP[I+1] ) {
+        n = 0;
+        J = I+2;
+        while ( 1 ) {
+            ++n;
+            if ( MAP[J+1] > nRow ) nRow = MAP[J+1];
+            if ( MAP[J+2] == 32767 ) break;
+            J += MAP[J+1];
+        }
+        if ( n > nNodes ) nNodes = n;
+        ++nE;
+    }
+    ++nRow;
+
+
+    t = (Lgm_AE8_AP8_Table *)calloc( 1, sizeof(Lgm_AE8_AP8_Table) );
+    t->MODEL  = MODEL;
+    t->nE     = nE;
+    t->nNodes = nNodes;
+    t->nRow   = nRow;
+    t->FISTEP = (double)IHEAD[7]/(double)IHEAD[2];
+    t->ESCALE = (double)IHEAD[4];
+    t->FSCALE = (double)IHEAD[7];
+    t->LSCALE = IHEAD[5];
+    t->BSCALE = IHEAD[6];
+    LGM_ARRAY_1D( t->E, nE, double );
+    LGM_ARRAY_1D( t->nL, nE, int );
+    LGM_ARRAY_3D( Row, nE, nNodes, nRow, int );
+    LGM_ARRAY_2D( Ls, nE, nNodes, int );
+    t->Row = Row;
+    t->Ls  = Ls;
+
+    for ( e=0, I=0; e<nE; e++, I += MAP[I+1] ) {
+        t->E[e] = MAP[I+2]/t->ESCALE;
+        n = 0;
+        J = I+2;
+        while ( 1 ) {
+            for ( k=1; k<=MAP[J+1]; k++ ) Row[e][n][k] = MAP[J+k];
+            Ls[e][n] = MAP[J+2];
+            ++n;
+            if ( MAP[J+2] == 32767 ) break;
+            J += MAP[J+1];
+        }
+        t->nL[e] = n;
+    }
+
+    return( t );
+
+}
+
+
+/*
+ *  The decoded table for a model (LGM_AP8MAX, LGM_AP8MIN, LGM_AE8MAX or
+ *  LGM_AE8MIN). It is made on the first call and kept; callers must not free
+ *  it. With NUMA aware placement on, each node gets its own copy, decoded by
+ *  (so placed on the node of) the first thread there to ask for it. Returns
+ *  NULL for an unknown model.
+ */
+Lgm_AE8_AP8_Table *Lgm_AE8_AP8_GetTable( int MODEL ) {
+
+    Lgm_AE8_AP8_Table   *t;
+    int                 Node;
+
+    if ( (MODEL != LGM_AP8MAX) && (MODEL != LGM_AP8MIN) && (MODEL != LGM_AE8MAX) && (MODEL != LGM_AE8MIN) ) {
+        printf( "Lgm_AE8_AP8_GetTable: Unknown model. MODEL = %d\n", MODEL);
+        return( NULL );
+    }
+
+    Node = Lgm_NumaHome();
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_AE8_AP8_GetTable)
+#endif
+    {
+        if ( Lgm_AE8_AP8_Tables[Node][MODEL] == NULL ) Lgm_AE8_AP8_Tables[Node][MODEL] = Lgm_AE8_AP8_DecodeMap( MODEL );
+        t = Lgm_AE8_AP8_Tables[Node][MODEL];
+    }
+
+    return( t );
+
+}
+
+
+/*
+ *  TRARA2() for energy map e of a decoded table. This is the same algorithm
+ *  (and arithmetic) as TRARA2(), but the L blocks are rows of t->Row[e]
+ *  rather than offsets into MAP, so the bracketing blocks are found by
+ *  scanning t->Ls[e] instead of walking the chain.
+ */
+static double Lgm_AE8_AP8_Trara2( Lgm_AE8_AP8_Table *t, int e, int IL, int IB ) {
+
+    int     done, flag, flag3, flag4, flag5;
+    int     ITIME, J1, J2, L1, L2, n, *R1, *R2, *RT, *Ls;
+    double  FINCR1, FKBJ1, FLOGM, FLOG, FKBM, FKB, FKBJ2, Result, FISTEP;
+    double  FNL, FNB, FLL1, FLL2, DFL, FLOG1, FLOG2, FKB1, FKB2, FINCR2, SL2, SL1;
+
+    FISTEP = t->FISTEP;
+    FNL    = (double)IL;
+    FNB    = (double)IB;
+    ITIME  = 0;
+
+
+    /*
+     *  Consecutive blocks R1, R2 with Ls(R1) <= IL < Ls(R2). (The first
+     *  block always has Ls = 0.)
+     */
+    Ls = t->Ls[e];
+    for ( n=1; Ls[n] <= IL; n++ );
+    R1 = t->Row[e][n-1]; L1 = R1[1];
+    R2 = t->Row[e][n];   L2 = R2[1];
+
+
+    if ( (L1<4) && (L2<4)) {
+        return( 0.0 );
+    }
+
+    flag  = 0;
+    flag3 = 0;
+    flag4 = 0;
+    flag5 = 0;
+    done  = 0;
+    while (!done) {
+
+        if ( (flag==1) || (R2[3]<=R1[3]) ) {
+            RT = R1; R1 = R2; R2 = RT; n = L1; L1 = L2; L2 = n;
+        }
+
+        FLL1  = R1[2]; FLL2 = R2[2];
+        DFL   = (FNL-FLL1)/(FLL2-FLL1);
+        FLOG1 = R1[3]; FLOG2 = R2[3];
+        FKB1  = 0.0; FKB2  = 0.0;
+
+        if (L1>=4) {
+
+            for (J2=4; J2<=L2; J2++){
+                FINCR2 = R2[J2];
+                if ( (FKB2+FINCR2) > FNB) { flag5 = 1; break; }
+                FKB2  = FKB2+FINCR2; FLOG2 = FLOG2-FISTEP;
+            }
+
+            if ( flag5 == 0 ){
+                ++ITIME;
+                if (ITIME == 1) { flag = 1; }
+                else {
+                    return(0.0);
+                }
+            }
+
+            if ( ITIME != 1 ) {
+                if ( J2 == 4 ) {
+                    done  = 1;
+                    flag3 = 1;
+                } else {
+                    SL2 = FLOG2/FKB2;
+                    for ( J1=4; J1<=L1; J1++ ) {
+                        FINCR1 = R1[J1];
+                        FKB1   = FKB1+FINCR1;
+                        FLOG1  = FLOG1-FISTEP;
+                        FKBJ1  = ((FLOG1/FISTEP)*FINCR1+FKB1)/((FINCR1/FISTEP)*SL2+1.0);
+                        if ( FKBJ1 <= FKB1 ) break;
+                    }
+
+                    if ( (FKBJ1 > FKB1) && (FKBJ1 <= FKB2) ) {
+                        return(0.0);
+                    }
+
+                    if ( FKBJ1 <= FKB2 ) {
+                        FKBM  = FKBJ1+(FKB2-FKBJ1)*DFL;
+                        FLOGM = FKBM*SL2;
+                        FLOG2 = FLOG2-FISTEP;
+                        FKB2  = FKB2+FINCR2;
+                        SL1   = FLOG1/FKB1;
+                        SL2   = FLOG2/FKB2;
+
+                        done  = 1;
+                        flag4 = 1;
+                    } else {
+                        FKB1 = 0.0;
+                        done = 1;
+                    }
+                }
+            } else if ( flag5 ) {
+                // second pass (after the swap) found the B/B0 block; start at J2 = 4 (label 30 of the fortran)
+                done = 1;
+            }
+            if ( (flag3 == 0) && (flag4 == 0) ) FKB2 = 0.0;
+        } else {
+            done = 1;
+        }
+    }
+
+    if (flag4 == 0 ){
+        if ( flag3 == 0 ){
+            J2 = 4;
+            FINCR2 = R2[J2];
+            FLOG2  = R2[3];
+            FLOG1  = R1[3];
+        }
+
+        FLOGM = FLOG1+(FLOG2-FLOG1)*DFL;
+        FKBM  = 0.0;
+        FKB2  = FKB2+FINCR2;
+        FLOG2 = FLOG2-FISTEP;
+        SL2   = FLOG2/FKB2;
+        if ( L1 < 4 ) {
+            FINCR1 = 0.0;
+            SL1    = -900000.0;
+            FKBJ1  = ((FLOG1/FISTEP)*FINCR1+FKB1)/((FINCR1/FISTEP)*SL2+1.0);
+            FKB    = FKBJ1+(FKB2-FKBJ1)*DFL;
+            FLOG   = FKB*SL2;
+            if ( FKB >= FNB ) {
+                if ( FKB < (FKBM+1e-10) ) {
+                    return(0.0);
+                } else {
+                    Result = FLOGM+(FLOG-FLOGM)*((FNB-FKBM)/(FKB-FKBM));
+                    Result = AMAX1(Result,0.0);
+                    return( Result );
+                }
+            }
+            FKBM  = FKB;
+            FLOGM = FLOG;
+            if ( J2 >= L2 ) {
+                return(0.0);
+            }
+            ++J2;
+            FINCR2 = R2[J2];
+            FLOG2  = FLOG2-FISTEP;
+            FKB2   = FKB2+FINCR2;
+            SL2    = FLOG2/FKB2;
+        } else {
+            J1 = 4;
+            FINCR1 = R1[J1];
+            FKB1   = FKB1+FINCR1;
+            FLOG1  = FLOG1-FISTEP;
+            SL1    = FLOG1/FKB1;
+        }
+    }
+
+
+    while (1){
+        if ( SL1 < SL2 ) {
+            FKBJ1 = ((FLOG1/FISTEP)*FINCR1+FKB1)/((FINCR1/FISTEP)*SL2+1.0);
+            FKB   = FKBJ1+(FKB2-FKBJ1)*DFL;
+            FLOG  = FKB*SL2;
+            if ( FKB >= FNB ) {
+                if ( FKB < (FKBM+1e-10) ) {
+                    return(0.0);
+                } else {
+                    Result = FLOGM+(FLOG-FLOGM)*((FNB-FKBM)/(FKB-FKBM));
+                    Result = AMAX1(Result,0.0);
+                    return( Result );
+                }
+            }
+            FKBM  = FKB;
+            FLOGM = FLOG;
+            if ( J2 >= L2 ) {
+                return(0.0);
+            }
+            ++J2;
+            FINCR2 = R2[J2];
+            FLOG2  = FLOG2-FISTEP;
+            FKB2   = FKB2+FINCR2;
+            SL2    = FLOG2/FKB2;
+        } else {
+            FKBJ2 = ((FLOG2/FISTEP)*FINCR2+FKB2)/((FINCR2/FISTEP)*SL1+1.0);
+            FKB   = FKB1+(FKBJ2-FKB1)*DFL;
+            FLOG  = FKB*SL1;
+            if ( FKB >= FNB) {
+                if ( FKB < (FKBM+1e-10) ) {
+                    return(0.0);
+                } else {
+                    Result = FLOGM+(FLOG-FLOGM)*((FNB-FKBM)/(FKB-FKBM));
+                    Result = AMAX1(Result,0.0);
+                    return( Result );
+                }
+            }
+            FKBM  = FKB;
+            FLOGM = FLOG;
+            if ( J1 >= L1 ) {
+                return(0.0);
+            }
+            ++J1;
+            FINCR1 = R1[J1];
+            FLOG1  = FLOG1-FISTEP;
+            FKB1   = FKB1+FINCR1;
+            SL1    = FLOG1/FKB1;
+        }
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      AE8/AP8 fluxes for many energies and (L, B/B0) points at once.
+ *
+ *  \details
+ *      Gives the same numbers as Lgm_AE8_AP8_Flux(), but works from the
+ *      decoded tables of Lgm_AE8_AP8_GetTable(). The model map interpolation
+ *      (TRARA2) is done once per point for each energy sub-map that is
+ *      actually needed, and the energy interpolation (TRARA1) is then a
+ *      simple loop over the points. The energies E[] must be increasing.
+ *
+ *      \param[in]      MODEL       LGM_AP8MAX, LGM_AP8MIN, LGM_AE8MAX or LGM_AE8MIN.
+ *      \param[in]      FLUXTYPE    LGM_INTEGRAL_FLUX or LGM_DIFFERENTIAL_FLUX.
+ *      \param[in]      nE          Number of energies.
+ *      \param[in]      E           Energies (MeV).
+ *      \param[in]      nPts        Number of points.
+ *      \param[in]      L           L-shell of each point.
+ *      \param[in]      BB0         B/B0 of each point.
+ *      \param[out]     Flux        Flux[i][j] is the flux at point j. For
+ *                                  LGM_INTEGRAL_FLUX it is the integral flux
+ *                                  above E[i] (i = 0..nE-1, #/cm^2/s), for
+ *                                  LGM_DIFFERENTIAL_FLUX the differential
+ *                                  flux between E[i] and E[i+1] (i =
+ *                                  0..nE-2, #/cm^2/s/MeV).
+ *
+ *      \return         TRUE, or FALSE if the MODEL or FLUXTYPE is unknown.
+ *
+ */
+int Lgm_AE8_AP8_Flux_Grid( int MODEL, int FLUXTYPE, int nE, double *E, int nPts, double *L, double *BB0, double **Flux ) {
+
+    Lgm_AE8_AP8_Table   *t;
+    double              **G, **AF, *g0, *g1, *g2, *af, E0, E1, E2, F, F0, F1, F2, x;
+    int                 *IL, *IB, *e1, *Need, i, j, e;
+
+    if ( (FLUXTYPE != LGM_INTEGRAL_FLUX) && (FLUXTYPE != LGM_DIFFERENTIAL_FLUX) ) {
+        printf( "Lgm_AE8_AP8_Flux_Grid: Unknown flux type. FLUXTYPE = %d\n", FLUXTYPE);
+        return( FALSE );
+    }
+    if ( (t = Lgm_AE8_AP8_GetTable( MODEL )) == NULL ) return( FALSE );
+    if ( (nE < 1) || (nPts < 1) ) return( TRUE );
+
+    LGM_ARRAY_1D( IL, nPts, int );
+    LGM_ARRAY_1D( IB, nPts, int );
+    LGM_ARRAY_1D( e1, nE, int );
+    LGM_ARRAY_1D( Need, t->nE, int );
+
+
+    /*
+     *  Scaled L and B/B0 (as in TRARA1).
+     */
+    for ( j=0; j<nPts; j++ ) {
+        x     = AMIN1( 15.6, fabs(L[j]) );
+        IL[j] = (int)(x*t->LSCALE);
+        x     = ( BB0[j] < 1.0 ) ? 1.0 : BB0[j];
+        IB[j] = (int)((x-1.0)*t->BSCALE);
+    }
+
+
+    /*
+     *  The energy sub-maps e1[i], e1[i]+1 that bracket each E[i] (and e1[i]-1
+     *  for the special interpolation of TRARA1).
+     */
+    for ( i=0; i<nE; i++ ) {
+        e = 0;
+        while ( (E[i] > t->E[e+1]) && (e+2 < t->nE) ) ++e;
+        e1[i] = e;
+        Need[e] = Need[e+1] = TRUE;
+        if ( e > 0 ) Need[e-1] = TRUE;
+    }
+
+
+    /*
+     *  Log fluxes in the needed sub-maps.
+     */
+    G = (double **)calloc( t->nE, sizeof(double *) );
+    for ( e=0; e<t->nE; e++ ) {
+        if ( Need[e] ) LGM_ARRAY_1D( G[e], nPts, double );
+    }
+#if USE_OPENMP
+    #pragma omp parallel for private(e) schedule(static) if(nPts>256)
+#endif
+    for ( j=0; j<nPts; j++ ) {
+        for ( e=0; e<t->nE; e++ ) {
+            if ( Need[e] ) G[e][j] = Lgm_AE8_AP8_Trara2( t, e, IL[j], IB[j] )/t->FSCALE;
+        }
+    }
+
+
+    /*
+     *  Interpolate in energy and convert to integral fluxes.
+     */
+    if ( FLUXTYPE == LGM_INTEGRAL_FLUX ) {
+        AF = Flux;
+    } else {
+        LGM_ARRAY_2D( AF, nE, nPts, double );
+    }
+    for ( i=0; i<nE; i++ ) {
+        e  = e1[i];
+        E1 = t->E[e]; E2 = t->E[e+1];
+        g1 = G[e]; g2 = G[e+1];
+        g0 = ( e > 0 ) ? G[e-1] : NULL;
+        E0 = ( e > 0 ) ? t->E[e-1] : 0.0;
+        af = AF[i];
+        for ( j=0; j<nPts; j++ ) {
+            F1 = g1[j]; F2 = g2[j];
+            F  = F1 + (F2-F1)*(E[i]-E1)/(E2-E1);
+            if ( (F2 <= 0.0) && (e != 0) ) {
+                F0 = g0[j];
+                F  = AMIN1( F, F0 + (F1-F0)*(E[i]-E0)/(E1-E0) );
+            }
+            F = AMAX1( F, 0.0 );
+            af[j] = ( F > 0.0 ) ? pow( 10.0, F ) : 0.0;
+        }
+    }
+
+
+    /*
+     *  Differential fluxes.
+     */
+    if ( FLUXTYPE == LGM_DIFFERENTIAL_FLUX ) {
+        for ( i=0; i<nE-1; i++ ) {
+            for ( j=0; j<nPts; j++ ) {
+                Flux[i][j] = ( AF[i+1][j] <= 0.0 ) ? 0.0 : fabs( AF[i+1][j]-AF[i][j] )/(E[i+1]-E[i]);
+            }
+        }
+        LGM_ARRAY_2D_FREE( AF );
+    }
+
+
+    for ( e=0; e<t->nE; e++ ) {
+        if ( Need[e] ) LGM_ARRAY_1D_FREE( G[e] );
+    }
+    free( G );
+    LGM_ARRAY_1D_FREE( IL );
+    LGM_ARRAY_1D_FREE( IB );
+    LGM_ARRAY_1D_FREE( e1 );
+    LGM_ARRAY_1D_FREE( Need );
+
+    return( TRUE );
+
+}
+
+
+
 /*
  * Need to init Lgm_MagModelInfo structure first...
  */
@@ -5738,3 +6221,107 @@ double  Lgm_AE8_AP8_FluxFromPos( Lgm_Vector *u, int MODEL, int FLUXTYPE, double
 }
 
 
+
+
+
+
+/**
+ *  \brief
+ *      AE8/AP8 fluxes along an orbit.
+ *
+ *  \details
+ *      For each sample (Date[i], UTC[i], u[i]) this computes the McIlwain L
+ *      (for locally mirroring particles) and B/B0 = B*L^3/M, the usual B-L
+ *      coordinates of the AE8/AP8 maps, with Lgm_McIlwain_L_Batch(). It then
+ *      evaluates the model at all of the samples at once with
+ *      Lgm_AE8_AP8_Flux_Grid(). Samples on field lines that are not closed
+ *      get zero flux (as in Lgm_AE8_AP8_FluxFromPos()).
+ *
+ *      The samples are traced in parallel, in runs of consecutive samples per
+ *      thread. With a slow tier cadence set on m->c (see
+ *      Lgm_Set_CTrans_SlowTierCadence()) consecutive samples therefore share
+ *      the slowly varying parts of the coordinate transformation updates.
+ *
+ *      \param[in]      n           Number of samples.
+ *      \param[in]      Date        Dates (e.g. 20101231), one per sample.
+ *      \param[in]      UTC         Universal Times in decimal hours, one per sample.
+ *      \param[in]      u           Positions (in GSM).
+ *      \param[in]      MODEL       LGM_AP8MAX, LGM_AP8MIN, LGM_AE8MAX or LGM_AE8MIN.
+ *      \param[in]      FLUXTYPE    LGM_INTEGRAL_FLUX or LGM_DIFFERENTIAL_FLUX.
+ *      \param[in]      nE          Number of energies.
+ *      \param[in]      E           Energies (MeV), increasing.
+ *      \param[out]     Flux        Flux[k][i] is the flux for energy k (or
+ *                                  energy interval k for
+ *                                  LGM_DIFFERENTIAL_FLUX, see
+ *                                  Lgm_AE8_AP8_Flux_Grid()) at sample i.
+ *      \param[out]     L           McIlwain L of each sample (LGM_FILL_VALUE if undefined). May be NULL.
+ *      \param[out]     BB0         B/B0 of each sample (LGM_FILL_VALUE if undefined). May be NULL.
+ *      \param[in,out]  m           Properly initialized Lgm_MagModelInfo structure.
+ *
+ *      \return         The number of samples with a defined L, or -1 if the
+ *                      MODEL or FLUXTYPE is unknown.
+ *
+ */
+int Lgm_AE8_AP8_FluxFromPos_Orbit( int n, long int *Date, double *UTC, Lgm_Vector *u, int MODEL, int FLUXTYPE, int nE, double *E, double **Flux, double *L, double *BB0, Lgm_MagModelInfo *m ) {
+
+    double  *Li, *I, *Bm, *M, *Lg, *BB0g, **Fg, Alpha = 90.0;
+    int     *Idx, i, k, nK, nGood;
+
+    if ( (FLUXTYPE != LGM_INTEGRAL_FLUX) && (FLUXTYPE != LGM_DIFFERENTIAL_FLUX) ) {
+        printf( "Lgm_AE8_AP8_FluxFromPos_Orbit: Unknown flux type. FLUXTYPE = %d\n", FLUXTYPE);
+        return( -1 );
+    }
+    if ( Lgm_AE8_AP8_GetTable( MODEL ) == NULL ) return( -1 );
+    if ( (n < 1) || (nE < 1) ) return( 0 );
+    nK = ( FLUXTYPE == LGM_INTEGRAL_FLUX ) ? nE : nE-1;
+
+    LGM_ARRAY_1D( Li, n, double );
+    LGM_ARRAY_1D( I,  n, double );
+    LGM_ARRAY_1D( Bm, n, double );
+    LGM_ARRAY_1D( M,  n, double );
+    Lgm_McIlwain_L_Batch( n, Date, UTC, u, 1, &Alpha, 0, Li, I, Bm, M, m );
+
+
+    /*
+     *  Pack the samples with a defined L (and B/B0).
+     */
+    LGM_ARRAY_1D( Idx,  n, int );
+    LGM_ARRAY_1D( Lg,   n, double );
+    LGM_ARRAY_1D( BB0g, n, double );
+    for ( nGood=0, i=0; i<n; i++ ) {
+        if ( L   != NULL ) L[i]   = LGM_FILL_VALUE;
+        if ( BB0 != NULL ) BB0[i] = LGM_FILL_VALUE;
+        for ( k=0; k<nK; k++ ) Flux[k][i] = 0.0;
+        if ( (Li[i] == LGM_FILL_VALUE) || (Li[i] <= 0.0) || (M[i] <= 0.0) ) continue;
+        Idx[nGood]  = i;
+        Lg[nGood]   = Li[i];
+        BB0g[nGood] = Bm[i]*Li[i]*Li[i]*Li[i]/M[i];
+        if ( L   != NULL ) L[i]   = Lg[nGood];
+        if ( BB0 != NULL ) BB0[i] = BB0g[nGood];
+        ++nGood;
+    }
+
+
+    /*
+     *  Evaluate the model at the good samples and unpack.
+     */
+    if ( (nGood > 0) && (nK > 0) ) {
+        LGM_ARRAY_2D( Fg, nE, nGood, double );
+        Lgm_AE8_AP8_Flux_Grid( MODEL, FLUXTYPE, nE, E, nGood, Lg, BB0g, Fg );
+        for ( k=0; k<nK; k++ ) {
+            for ( i=0; i<nGood; i++ ) Flux[k][Idx[i]] = Fg[k][i];
+        }
+        LGM_ARRAY_2D_FREE( Fg );
+    }
+
+    LGM_ARRAY_1D_FREE( Li );
+    LGM_ARRAY_1D_FREE( I );
+    LGM_ARRAY_1D_FREE( Bm );
+    LGM_ARRAY_1D_FREE( M );
+    LGM_ARRAY_1D_FREE( Idx );
+    LGM_ARRAY_1D_FREE( Lg );
+    LGM_ARRAY_1D_FREE( BB0g );
+
+    return( nGood );
+
+}
@@ -15,6 +15,10 @@
 #include <gsl/gsl_statistics_double.h>
 #include "Lgm/Lgm_AE_index.h"
 
+Lgm_DateTime AEdatetime[4096] ;
+int AE_index[4096], AL_index[4096], AU_index[4096], AO_index[4096], index_length ;
+char AEfilename[1024] ;
+
 /**
  * \brief
  * Return the AE index at a given year, month, day, hour, minute and sec.
@@ -210,7 +214,7 @@ void Lgm_Read_AEfile(int year, int month, int day) {
   char buffer[1024], UTC[1024] ;
   int cntr,hold_second ;
 
-  sprintf(AEfilename,"/n/projects/lanl/geo/Data/AE/%4.4d/AE_%4.4d%2.2d%2.2d.dat", year, year, month, day) ;
+  sprintf(AEfilename,"%s/%4.4d/AE_%4.4d%2.2d%2.2d.dat", LGM_AE_DATA_DIR, year, year, month, day) ;
 
   /* Open file */
 
@@ -271,3 +275,194 @@ void Lgm_Read_AEfile(int year, int month, int day) {
 
   fclose(fp) ;
 }
+
+
+/*
+ * Read one day's file into the store. Returns 0 if there was no file for
+ * that day.
+ */
+static int AE_ReadDay( Lgm_AE_Store *s, int year, int month, int day ) {
+
+  FILE *fp ;
+  char Filename[1024], buffer[1024], UTC[1024] ;
+  int k, Year, Month, Dom, Hour, Minute, Val[4] ;
+  long int m ;
+
+  sprintf(Filename,"%s/%4.4d/AE_%4.4d%2.2d%2.2d.dat", LGM_AE_DATA_DIR, year, year, month, day) ;
+  if( (fp = fopen(Filename, "r")) == NULL ) return(0) ;
+
+  while(fgets(buffer,1024,fp) != NULL) {
+
+    if(buffer[0]=='#') continue ;
+    if( sscanf( buffer, "%s %d %d %d %d", UTC, &Val[0], &Val[1], &Val[2], &Val[3] ) != 5 ) continue ;
+    if( sscanf( UTC, "%d-%d-%dT%d:%d", &Year, &Month, &Dom, &Hour, &Minute ) != 5 ) continue ;
+
+    /* a file should only hold its own day, but key on the time stamp anyway */
+    m = (Lgm_JDN(Year, Month, Dom) - s->StartJDN)*1440 + Hour*60 + Minute ;
+    if( (m < 0) || (m >= s->nMinutes) ) continue ;
+
+    /* 99999 etc. are the usual missing-value flags */
+    for(k=0; k<4; k++) s->Index[k][m] = ( abs(Val[k]) >= 99999 ) ? LGM_FILL_VALUE : (float)Val[k] ;
+
+  }
+
+  fclose(fp) ;
+  return(1) ;
+}
+
+/**
+ * \brief
+ * Load the AE, AL, AU and AO indices for a range of days into memory.
+ *
+ * \details
+ * Lgm_get_AE() and friends re-read three daily files on every call. For runs
+ * that need the indices at many times, load the whole range once with this
+ * and then look values up with Lgm_AE_StoreGet() or Lgm_AE_StoreGetArray().
+ * Values are kept at one minute resolution (as floats), indexed by minute
+ * since 0 UT on StartDate, so a lookup is a few integer operations. A
+ * year of data takes about 8MB.
+ *
+ * Days whose files are missing are counted in nDaysMissing and left as
+ * LGM_FILL_VALUE (unlike Lgm_Read_AEfile(), this does not exit).
+ *
+ * \param[in] StartDate first day to load (YYYYMMDD)
+ * \param[in] EndDate last day to load (YYYYMMDD)
+ *
+ * \return A pointer to the store (free with Lgm_AE_FreeStore()), or NULL if
+ * the range is empty or no file in it could be read.
+ *
+ */
+Lgm_AE_Store *Lgm_AE_LoadRange( long int StartDate, long int EndDate ) {
+
+  Lgm_AE_Store *s ;
+  int year, month, day, doy, k, nRead=0 ;
+  long int Day, nDays, JDN, EndJDN ;
+  double UT ;
+  long int Date ;
+
+  Lgm_Doy( StartDate, &year, &month, &day, &doy ) ;
+  JDN = Lgm_JDN( year, month, day ) ;
+  Lgm_Doy( EndDate, &year, &month, &day, &doy ) ;
+  EndJDN = Lgm_JDN( year, month, day ) ;
+  nDays = EndJDN - JDN + 1 ;
+  if( nDays < 1 ) {
+    printf("Lgm_AE_LoadRange: EndDate (%ld) is before StartDate (%ld)\n", EndDate, StartDate) ;
+    return(NULL) ;
+  }
+
+  s = (Lgm_AE_Store *)calloc( 1, sizeof(Lgm_AE_Store) ) ;
+  s->StartDate = StartDate ;
+  s->EndDate   = EndDate ;
+  s->StartJDN  = JDN ;
+  s->nMinutes  = nDays*1440 ;
+  for(k=0; k<4; k++) {
+    if( (s->Index[k] = (float *)malloc( s->nMinutes*sizeof(float) )) == NULL ) {
+      printf("Lgm_AE_LoadRange: could not allocate %ld minutes\n", s->nMinutes) ;
+      Lgm_AE_FreeStore( s ) ;
+      return(NULL) ;
+    }
+  }
+  for(k=0; k<4; k++) for(Day=0; Day<s->nMinutes; Day++) s->Index[k][Day] = LGM_FILL_VALUE ;
+
+  for(Day=0; Day<nDays; Day++) {
+    /* MJD JDN-2400000 is noon of the day with that Julian Day Number */
+    Lgm_mjd_to_ymdh( (double)(JDN+Day) - 2400000.0, &Date, &year, &month, &day, &UT ) ;
+    if( AE_ReadDay( s, year, month, day ) ) ++nRead ;
+    else ++s->nDaysMissing ;
+  }
+
+  if( nRead == 0 ) {
+    printf("Lgm_AE_LoadRange: no AE files found for %ld - %ld in %s\n", StartDate, EndDate, LGM_AE_DATA_DIR) ;
+    Lgm_AE_FreeStore( s ) ;
+    return(NULL) ;
+  }
+
+  return(s) ;
+}
+
+/*
+ * \brief
+ * Free a store made by Lgm_AE_LoadRange()
+ */
+void Lgm_AE_FreeStore( Lgm_AE_Store *s ) {
+
+  int k ;
+
+  if( s == NULL ) return ;
+  for(k=0; k<4; k++) free( s->Index[k] ) ;
+  free( s ) ;
+
+}
+
+/*
+ * \brief
+ * Minute of the store that a time falls in (can be outside [0, nMinutes)).
+ * Time is in decimal hours.
+ */
+long int Lgm_AE_StoreMinute( Lgm_AE_Store *s, int Year, int Month, int Day, double Time ) {
+  return( (Lgm_JDN(Year, Month, Day) - s->StartJDN)*1440 + (long int)floor(Time*60.0) ) ;
+}
+
+/**
+ * \brief
+ * Return an index from the store at a given time.
+ *
+ * \details
+ * The value is linearly interpolated between the two minutes that bracket
+ * the time (or is the one that has data, if only one does), which is what
+ * Lgm_get_index() does.
+ *
+ * \param[in] s a store made by Lgm_AE_LoadRange()
+ * \param[in] Which LGM_AE_AE, LGM_AE_AL, LGM_AE_AU or LGM_AE_AO
+ * \param[in] UTC the time (only Year, Month, Day and Time are used)
+ *
+ * \return The index, or LGM_FILL_VALUE if the time is outside the store or
+ * has no data.
+ *
+ */
+double Lgm_AE_StoreGet( Lgm_AE_Store *s, int Which, Lgm_DateTime *UTC ) {
+
+  long int m ;
+  double x, f, v0, v1 ;
+  float *v ;
+
+  if( (Which < 0) || (Which > 3) ) return(LGM_FILL_VALUE) ;
+  v = s->Index[Which] ;
+
+  x = UTC->Time*60.0 ;
+  m = (Lgm_JDN(UTC->Year, UTC->Month, UTC->Day) - s->StartJDN)*1440 + (long int)floor(x) ;
+  f = x - floor(x) ;
+  if( (m < 0) || (m >= s->nMinutes) ) return(LGM_FILL_VALUE) ;
+
+  v0 = v[m] ;
+  v1 = ( m+1 < s->nMinutes ) ? v[m+1] : LGM_FILL_VALUE ;
+  if( v1 <= 0.1*LGM_FILL_VALUE ) return( v0 ) ;
+  if( v0 <= 0.1*LGM_FILL_VALUE ) return( v1 ) ;
+
+  return( v0 + f*(v1-v0) ) ;
+}
+
+/**
+ * \brief
+ * Lgm_AE_StoreGet() for an array of times.
+ *
+ * \param[in] s a store made by Lgm_AE_LoadRange()
+ * \param[in] Which LGM_AE_AE, LGM_AE_AL, LGM_AE_AU or LGM_AE_AO
+ * \param[in] n number of times
+ * \param[in] UTC the times
+ * \param[out] Val the n index values
+ *
+ * \return The number of values that are not LGM_FILL_VALUE.
+ *
+ */
+int Lgm_AE_StoreGetArray( Lgm_AE_Store *s, int Which, int n, Lgm_DateTime *UTC, double *Val ) {
+
+  int i, nGood=0 ;
+
+  for(i=0; i<n; i++) {
+    Val[i] = Lgm_AE_StoreGet( s, Which, &UTC[i] ) ;
+    if( Val[i] > 0.1*LGM_FILL_VALUE ) ++nGood ;
+  }
+
+  return(nGood) ;
+}
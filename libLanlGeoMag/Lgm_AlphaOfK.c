@@ -20,16 +20,145 @@
 
 #define TRACE_TOL   1e-7
 #define GOLD        0.38197
+#define TAB_TOL     1e-3        // Degrees. Table intervals with larger error estimates get a polish step.
 
 
 
 double Lgm_AlphaOfK_Func( double Kt, double Alpha, Lgm_MagModelInfo *m );
 
 
+/*
+ *  Tabulate K(alpha) on the splined line for LGM_ALPHAOFK_NTAB equatorial
+ *  pitch angles from 90 Deg. down to the lower bracket that Lgm_AlphaOfK()
+ *  uses, with a single Iinv_interped_multi() call. The pitch angles bunch up
+ *  towards the loss cone, where K(alpha) is steepest. The table keeps nodes
+ *  for as long as K increases (it stops at a FILL value or a turnover) and
+ *  gets monotone (Fritsch-Carlson) slopes of Alpha as a function of sqrt(K)
+ *  (K goes like (90-alpha)^2 near 90 Deg., so Alpha(sqrt(K)) is smooth
+ *  there), so that Lgm_AlphaOfK() can invert it directly.
+ */
+static void Lgm_AlphaOfK_MakeTable( Lgm_MagModelInfo *m ) {
+
+    int     j, n, Left, Right;
+    double  B, a0, sa, t, Bm[LGM_ALPHAOFK_NTAB], I[LGM_ALPHAOFK_NTAB], *Q, *A, *D;
+    double  h0, h1, d0, d1, w0, w1;
+
+    m->AlphaOfK_nTab = 0;
+    Q = m->AlphaOfK_SqrtK; A = m->AlphaOfK_Alpha; D = m->AlphaOfK_D;
+
+    B  = ( m->Ellipsoid_Footprint_Bs < m->Ellipsoid_Footprint_Bn ) ? m->Ellipsoid_Footprint_Bs : m->Ellipsoid_Footprint_Bn;
+    a0 = 0.5 + DegPerRad*asin( sqrt( m->Bmin/B ) );
+    if ( !( a0 < 90.0 ) ) return;
+
+    for ( j=0; j<LGM_ALPHAOFK_NTAB; j++ ) {
+        t     = (double)j/(double)(LGM_ALPHAOFK_NTAB-1);
+        A[j]  = 90.0 - (90.0-a0)*t*(2.0-t);
+        sa    = sin( A[j]*RadPerDeg );
+        Bm[j] = m->Bmin/(sa*sa);
+    }
+    Iinv_interped_multi( LGM_ALPHAOFK_NTAB-1, Bm+1, I+1, m );
+
+    /*
+     *  (Pitch angles near 90 Deg. can give I = 0 if the splined line dips a
+     *  little below m->Bmin. Those nodes are just dropped.)
+     */
+    Q[0] = 0.0;
+    for ( n=1, j=1; j<LGM_ALPHAOFK_NTAB; j++ ) {
+        if ( I[j] == LGM_FILL_VALUE ) break;
+        Q[n] = sqrt( 3.16227766e-3*I[j]*sqrt(Bm[j]) );
+        A[n] = A[j];
+        if ( Q[n] > Q[n-1] ) {
+            ++n;
+        } else if ( Q[n] > 0.0 ) {
+            break;
+        }
+    }
+    if ( n < 4 ) return;
+
+    for ( j=0; j<n; j++ ) {
+
+        Left  = ( j > 0 );
+        Right = ( j < n-1 );
+        if ( Left )  { h0 = Q[j] - Q[j-1]; d0 = ( A[j] - A[j-1] )/h0; }
+        if ( Right ) { h1 = Q[j+1] - Q[j]; d1 = ( A[j+1] - A[j] )/h1; }
+
+        if ( Left && Right ) {
+            w0 = 2.0*h1 + h0;
+            w1 = h1 + 2.0*h0;
+            D[j] = ( w0 + w1 )/( w0/d0 + w1/d1 );  // (d0 and d1 are both < 0)
+        } else if ( Left ) {
+            D[j] = d0;
+        } else {
+            D[j] = d1;
+        }
+
+    }
+
+    /*
+     *  At the middle of an interval the cubic differs from the straight line
+     *  by h*(D0 - D1)/8.
+     */
+    for ( j=0; j<n-1; j++ ) m->AlphaOfK_Err[j] = fabs( ( Q[j+1] - Q[j] )*( D[j] - D[j+1] ) )/8.0;
+    m->AlphaOfK_nTab = n;
+
+}
+
+
+/*
+ *  Alpha(K) from the table made by Lgm_AlphaOfK_MakeTable(). Intervals whose
+ *  error estimate is above TAB_TOL get one Newton step, with K(Alpha) from
+ *  Iinv_interped_multi() (so no field line tracing is done). Returns FALSE
+ *  if K is past the end of the table.
+ */
+static int Lgm_AlphaOfK_FromTable( double Kt, double *Alpha, Lgm_MagModelInfo *m ) {
+
+    int     j, lo, hi, n;
+    double  *Q, *A, *D, q, h, t, t2, t3, a, dadq, sa, Bm, I, qp;
+
+    n = m->AlphaOfK_nTab;
+    Q = m->AlphaOfK_SqrtK; A = m->AlphaOfK_Alpha; D = m->AlphaOfK_D;
+    if ( ( n < 2 ) || !( Kt >= 0.0 ) ) return( FALSE );
+    q = sqrt( Kt );
+    if ( q > Q[n-1] ) return( FALSE );
+
+    lo = 0; hi = n-1;
+    while ( hi - lo > 1 ) {
+        j = (lo + hi)/2;
+        if ( Q[j] > q ) hi = j; else lo = j;
+    }
+    j = lo;
+
+    h  = Q[j+1] - Q[j];
+    t  = ( q - Q[j] )/h; t2 = t*t; t3 = t2*t;
+    a  = ( 2.0*t3 - 3.0*t2 + 1.0 )*A[j] + ( t3 - 2.0*t2 + t )*h*D[j] + ( -2.0*t3 + 3.0*t2 )*A[j+1] + ( t3 - t2 )*h*D[j+1];
+
+    if ( m->AlphaOfK_Err[j] > TAB_TOL ) {
+
+        dadq = ( 6.0*t2 - 6.0*t )*( A[j] - A[j+1] )/h + ( 3.0*t2 - 4.0*t + 1.0 )*D[j] + ( 3.0*t2 - 2.0*t )*D[j+1];
+        sa   = sin( a*RadPerDeg );
+        Bm   = m->Bmin/(sa*sa);
+        if ( ( Iinv_interped_multi( 1, &Bm, &I, m ) == 1 ) && ( dadq < 0.0 ) ) {
+            qp = sqrt( 3.16227766e-3*I*sqrt(Bm) );
+            a += dadq*( q - qp );
+            // stay inside the interval (A[j] > A[j+1])
+            if ( a > A[j] ) a = A[j];
+            if ( a < A[j+1] ) a = A[j+1];
+        }
+
+    }
+
+    *Alpha = a;
+    return( TRUE );
+
+}
+
+
 
 /**
  *  Do initial setup for AlphaOfK(). This involves setting time and doing an
- *  initial field trace to get m->Pmin set up properly.
+ *  initial field trace to get m->Pmin set up properly. With
+ *  m->UseInterpRoutines the line is also splined and K(alpha) is tabulated
+ *  on it (in m->AlphaOfK_SqrtK etc.).
  *
  *      \param[in]      d   Date/Time to use.
  *      \param[in]      u   Position (in GSM) to use.
@@ -47,6 +176,7 @@ int  Lgm_Setup_AlphaOfK( Lgm_DateTime *d, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
     int         TraceFlag, nDivs;
     Lgm_Vector  v1, v2, v3, v4, Bvec;
 
+    m->AlphaOfK_nTab = 0;
 
     /*
      * Set the coordinate transformations for the gievn date/time
@@ -59,6 +189,32 @@ int  Lgm_Setup_AlphaOfK( Lgm_DateTime *d, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
     m->Bfield( u, &Bvec, m );
     m->Blocal = Lgm_Magnitude( &Bvec );
 
+    /*
+     *  For a pure dipole the line is known in closed form (see
+     *  Lgm_Dipole.c). The splined line is still made for anyone who wants
+     *  it, but Lgm_AlphaOfK() and Lgm_KofAlpha() dont use it, so there is
+     *  no table either.
+     */
+    if ( Lgm_Dipole_IsPure( m ) ) {
+
+        if ( ( TraceFlag = Lgm_Dipole_Trace( u, &v1, &v2, &v3, m->Lgm_LossConeHeight, m ) ) != LGM_CLOSED ) {
+            if (m->VerbosityLevel >= 2) printf("Lgm_Setup_AlphaOfK(): Field line not closed?\n");
+            return(-5);
+        }
+        if ( m->UseInterpRoutines ) {
+            nDivs = m->Trace_s/0.1;
+            if ( nDivs < 200 ) nDivs = 200;
+            if ( nDivs > LGM_MAX_INTERP_PNTS ) nDivs = LGM_MAX_INTERP_PNTS-1;
+            if ( !Lgm_Dipole_SampleLine( nDivs, m ) ) {
+                if (m->VerbosityLevel >= 2) printf("Lgm_Setup_AlphaOfK(): Could not initialize spline curve\n");
+                return(-5);
+            }
+        }
+        return( TraceFlag );
+
+    }
+
+
     /*
      * Trace the field line for the given position. This should be a fast
      * adaptive trace. I.e. -- no points are saved.
@@ -98,6 +254,12 @@ int  Lgm_Setup_AlphaOfK( Lgm_DateTime *d, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
             return(-5);
         }
 
+        /*
+         * Tabulate K(alpha) once, so that Lgm_AlphaOfK() doesnt have to
+         * search for each K.
+         */
+        Lgm_AlphaOfK_MakeTable( m );
+
     } 
     
     return( TraceFlag );
@@ -118,6 +280,7 @@ int  Lgm_Setup_AlphaOfK( Lgm_DateTime *d, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
 void  Lgm_TearDown_AlphaOfK( Lgm_MagModelInfo *m ) {
 
     if ( m->AllocedSplines ) FreeSpline( m );
+    m->AlphaOfK_nTab = 0;
 
 }
 
@@ -138,6 +301,12 @@ void  Lgm_TearDown_AlphaOfK( Lgm_MagModelInfo *m ) {
  *                      properly first. Then you need to call Lgm_Setup_AlphaOfK() before you
  *                      call this routine.
  *
+ *      \note           If Lgm_Setup_AlphaOfK() made a K(alpha) table and K is
+ *                      in it, the table is inverted (at most one Iinv_interped_multi()
+ *                      call, and no tracing), and m->Bm, m->Pm_South, etc. are
+ *                      left alone. Otherwise the pitch angle is found with a
+ *                      bracketing search on Lgm_KofAlpha().
+ *
  */
 double  Lgm_AlphaOfK( double K, Lgm_MagModelInfo *m ) {
 
@@ -146,6 +315,19 @@ double  Lgm_AlphaOfK( double K, Lgm_MagModelInfo *m ) {
     int     done;
 
 
+    /*
+     *  If Lgm_Setup_AlphaOfK() made a table of K(alpha), and K is in it,
+     *  just invert the table.
+     */
+    if ( ( m->AlphaOfK_nTab > 0 ) && Lgm_AlphaOfK_FromTable( K, &a, m ) ) return( a );
+
+    /*
+     *  Pure dipole; K(alpha) is cheap to evaluate exactly, so invert it
+     *  directly.
+     */
+    if ( Lgm_Dipole_IsPure( m ) ) return( Lgm_Dipole_AlphaOfK( K, m ) );
+
+
     /*
      *  Set up low side of bracket. The footpoints are at 100-ish km (or
      *  whatever), but the integral invariant is from mirror point to mirror
@@ -278,10 +460,23 @@ printf("%s: no alpha value found for K=%g!\n", __func__, K);
 double Lgm_KofAlpha( double Alpha, Lgm_MagModelInfo *m ) {
 
     double  rat, sa, sa2, Sma, Smb, I, K;
+    Lgm_DipoleFL    f;
 
     m->PitchAngle = Alpha;
     sa = sin( Alpha*RadPerDeg ); sa2 = sa*sa;
     m->Bm = m->Bmin/sa2; 
+
+    /*
+     *  Pure dipole; mirror points and I in closed form.
+     */
+    if ( Lgm_Dipole_IsPure( m ) ) {
+        Lgm_Dipole_Line( &m->Pmin, &f, m );
+        if ( Lgm_Dipole_MirrorPoints( m->Bm, &f, &m->Pm_South, &m->Pm_North, &Smb, m ) < 0 ) return( LGM_FILL_VALUE );
+        m->Sm_South = m->Smin - 0.5*Smb;
+        m->Sm_North = m->Sm_South + Smb;
+        Lgm_Dipole_Integrals( m->Bm, &f, &I, NULL );
+        return( 3.16227766e-3*I*sqrt(m->Bm) );
+    }
 //printf("Bmirror = %lf\n", m->Bm );
 
 
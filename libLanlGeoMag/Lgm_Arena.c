@@ -0,0 +1,138 @@
+/*! \file Lgm_Arena.c
+ *
+ *  \brief Bump (arena) allocator for objects made of many arrays.
+ *
+ *  \details
+ *      Structures like Lgm_QinDenton allocate dozens of arrays when they are
+ *      set up and free them all together when they are destroyed. Getting
+ *      all of those from an arena turns them into a few large mallocs (and a
+ *      few frees), and keeps the arrays next to each other in memory.
+ *
+ *      Lgm_Arena_Calloc() returns zeroed memory aligned to LGM_ARENA_ALIGN
+ *      bytes. Nothing from an arena is freed on its own -- use
+ *      Lgm_Arena_Reset() to reuse the memory or Lgm_FreeArena() to give it
+ *      back. An arena must not be used by several threads at once.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "Lgm/Lgm_Arena.h"
+
+
+static Lgm_ArenaBlock *NewBlock( size_t Size ) {
+
+    Lgm_ArenaBlock  *b;
+    uintptr_t       p;
+
+    b = (Lgm_ArenaBlock *)malloc( sizeof(Lgm_ArenaBlock) + Size + LGM_ARENA_ALIGN );
+    if ( b == NULL ) return( NULL );
+
+    p = (uintptr_t)( (char *)b + sizeof(Lgm_ArenaBlock) );
+    p = ( p + LGM_ARENA_ALIGN - 1 ) & ~( (uintptr_t)LGM_ARENA_ALIGN - 1 );
+    b->Data = (char *)p;
+    b->Size = Size;
+    b->Used = 0;
+    b->Next = NULL;
+
+    return( b );
+
+}
+
+
+/**
+ *  Create an empty arena. BlockSize is the size of the blocks it gets from
+ *  malloc (LGM_ARENA_BLOCK_SIZE if BlockSize is 0). If the total size of
+ *  what will be put in it is known, using that as the BlockSize gives a
+ *  single block.
+ */
+Lgm_Arena *Lgm_CreateArena( size_t BlockSize ) {
+
+    Lgm_Arena   *a;
+
+    a = (Lgm_Arena *)calloc( 1, sizeof(Lgm_Arena) );
+    if ( a == NULL ) return( NULL );
+    a->BlockSize = ( BlockSize > 0 ) ? BlockSize : LGM_ARENA_BLOCK_SIZE;
+
+    return( a );
+
+}
+
+
+/**
+ *  Get room for n objects of the given size, zeroed (like calloc()).
+ *  Returns NULL if n*size is zero or no memory could be had.
+ */
+void *Lgm_Arena_Calloc( Lgm_Arena *a, size_t n, size_t size ) {
+
+    Lgm_ArenaBlock  *b;
+    size_t          nBytes;
+    char            *p;
+
+    if ( ( a == NULL ) || ( n == 0 ) || ( size == 0 ) ) return( NULL );
+    nBytes = n*size;
+    nBytes = ( nBytes + LGM_ARENA_ALIGN - 1 ) & ~( (size_t)LGM_ARENA_ALIGN - 1 );
+
+    b = a->Cur;
+    if ( ( b == NULL ) || ( b->Size - b->Used < nBytes ) ) {
+        if ( ( b != NULL ) && ( b->Next != NULL ) && ( b->Next->Size >= nBytes ) ) {
+            // left over from before a Lgm_Arena_Reset()
+            b = b->Next;
+        } else {
+            b = NewBlock( ( nBytes > a->BlockSize ) ? nBytes : a->BlockSize );
+            if ( b == NULL ) return( NULL );
+            ++a->nBlocks;
+            if ( a->Cur == NULL ) {
+                a->First = b;
+            } else {
+                b->Next = a->Cur->Next;
+                a->Cur->Next = b;
+            }
+        }
+        a->Cur = b;
+    }
+
+    p = b->Data + b->Used;
+    b->Used   += nBytes;
+    a->nBytes += nBytes;
+    memset( p, 0, n*size );
+
+    return( (void *)p );
+
+}
+
+
+/**
+ *  Forget everything that has been handed out, but keep the blocks so they
+ *  can be filled again.
+ */
+void Lgm_Arena_Reset( Lgm_Arena *a ) {
+
+    Lgm_ArenaBlock  *b;
+
+    if ( a == NULL ) return;
+    for ( b=a->First; b!=NULL; b=b->Next ) b->Used = 0;
+    a->Cur    = a->First;
+    a->nBytes = 0;
+
+}
+
+
+/**
+ *  Free the arena and everything that was allocated from it.
+ */
+void Lgm_FreeArena( Lgm_Arena *a ) {
+
+    Lgm_ArenaBlock  *b, *Next;
+
+    if ( a == NULL ) return;
+    for ( b=a->First; b!=NULL; b=Next ) {
+        Next = b->Next;
+        free( b );
+    }
+    free( a );
+
+}
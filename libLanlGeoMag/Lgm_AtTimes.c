@@ -0,0 +1,490 @@
+/*! \file Lgm_AtTimes.c
+ *
+ *  \brief Array versions of the per point routines, one time per point.
+ *
+ *  The python wrappers (lgmpy) used to loop over points in python, setting
+ *  up the transforms and calling (e.g.) Lgm_B_T89() through ctypes once per
+ *  point. The routines here take the whole arrays at once (positions as a
+ *  contiguous n x 3 array, times as Date[] and UTC[] arrays) and do the loop
+ *  in C. Runs of points at the same time (and Kp) share one
+ *  Lgm_Set_Coord_Transforms() and are handed to the array routines
+ *  (Lgm_Convert_Coords_Array(), Lgm_B_Batch()). The runs are done in
+ *  parallel (OpenMP builds), each thread working on its own copy of the
+ *  CTrans or MagModelInfo structure. The number of threads can be capped
+ *  with Lgm_SetMaxThreads().
+ *
+ */
+#include "Lgm/Lgm_AtTimes.h"
+#include "Lgm/Lgm_Tasks.h"
+#include "Lgm/Lgm_QinDenton.h"
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LGM_ATTIMES_TRACE_TOL   1e-7
+#define LGM_ATTIMES_TRACE_TOL2  1e-3
+
+
+/*
+ *  Splits the n points into runs that have the same Date, UTC (and Kp if
+ *  it was given). Run r is points Start[r] through Start[r+1]-1. Returns the
+ *  number of runs (Start[] needs room for n+1 values).
+ */
+static long int Lgm_AtTimes_Runs( long int n, long int *Date, double *UTC, double *Kp, long int *Start ) {
+
+    long int    i, nRuns = 0;
+
+    for ( i=0; i<n; i++ ) {
+        if ( ( i == 0 ) || ( Date[i] != Date[i-1] ) || ( UTC[i] != UTC[i-1] ) || ( ( Kp != NULL ) && ( Kp[i] != Kp[i-1] ) ) ) Start[nRuns++] = i;
+    }
+    Start[nRuns] = n;
+
+    return( nRuns );
+
+}
+
+/*
+ *  Same clamping as the MagEphem tools use for their ForceKp option.
+ */
+static void Lgm_AtTimes_SetKp( double Kp, Lgm_MagModelInfo *m ) {
+
+    m->fKp = Kp;
+    m->Kp  = (int)(Kp+0.5);
+    if ( m->Kp > 6 ) m->Kp = 6;
+    if ( m->Kp < 0 ) m->Kp = 0;
+
+}
+
+
+/*
+ *  Time order for Lgm_Convert_Coords_AtTimes_Timeline().
+ */
+typedef struct Lgm_AtTimes_Key {
+    long int    Date;
+    double      UTC;
+    long int    i;
+} Lgm_AtTimes_Key;
+
+static int Lgm_AtTimes_CompareKeys( const void *a, const void *b ) {
+
+    const Lgm_AtTimes_Key *ka = (const Lgm_AtTimes_Key *)a;
+    const Lgm_AtTimes_Key *kb = (const Lgm_AtTimes_Key *)b;
+
+    if ( ka->Date != kb->Date ) return( ( ka->Date < kb->Date ) ? -1 : 1 );
+    if ( ka->UTC  != kb->UTC  ) return( ( ka->UTC  < kb->UTC  ) ? -1 : 1 );
+    return( ( ka->i < kb->i ) ? -1 : ( ka->i > kb->i ) );
+
+}
+
+
+/**
+ *  \brief
+ *      Lgm_Convert_Coords_Array() for points that each have their own time.
+ *
+ *      \param[in]      n       Number of vectors.
+ *      \param[in]      Date    Dates (e.g. 20101231), one per vector.
+ *      \param[in]      UTC     Universal Times in decimal hours, one per vector.
+ *      \param[in]      u       Array of n input vectors.
+ *      \param[out]     v       Array of n output vectors (may be the same as u).
+ *      \param[in]      flag    Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[in]      c       Lgm_CTrans structure with the options to use (it isnt changed).
+ *
+ */
+void Lgm_Convert_Coords_AtTimes( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c ) {
+    Lgm_Convert_Coords_AtTimes_Timeline( n, Date, UTC, u, v, flag, NULL, c );
+}
+
+
+/**
+ *  \brief
+ *      Same as Lgm_Convert_Coords_AtTimes(), optionally using a transform timeline.
+ *
+ *  \details
+ *      The times dont have to be in order. If they arent, the points are
+ *      put in time order first (and the results put back in the original
+ *      order), so that all of the points at a given time share one set up of
+ *      the transforms, and so that each thread walks forward in time (which
+ *      is what the slow tier update, see Lgm_Set_CTrans_Tier(), needs in
+ *      order to reuse its nodes).
+ *
+ *      If tl isnt NULL the transforms are set up with
+ *      Lgm_Set_Coord_Transforms_FromTimeline() (times outside of the
+ *      timeline fall back to Lgm_Set_Coord_Transforms()). For telemetry at
+ *      a 1 s cadence that makes the set up of the transforms cheaper than
+ *      the conversions themselves.
+ *
+ *      \param[in]      n       Number of vectors.
+ *      \param[in]      Date    Dates (e.g. 20101231), one per vector.
+ *      \param[in]      UTC     Universal Times in decimal hours, one per vector.
+ *      \param[in]      u       Array of n input vectors.
+ *      \param[out]     v       Array of n output vectors (may be the same as u).
+ *      \param[in]      flag    Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[in]      tl      Timeline from Lgm_CTransTimeline_Create() made with c's options (or NULL).
+ *      \param[in]      c       Lgm_CTrans structure with the options to use (it isnt changed).
+ *
+ */
+void Lgm_Convert_Coords_AtTimes_Timeline( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag,
+                                          Lgm_CTransTimeline *tl, Lgm_CTrans *c ) {
+
+    long int        *Start, nRuns, r, i, *sDate;
+    double          *sUTC;
+    int             Sorted;
+    Lgm_Vector      *su, *sv;
+    Lgm_AtTimes_Key *Key = NULL;
+    Lgm_CTrans      *cc;
+
+    if ( n < 1 ) return;
+
+    for ( Sorted=TRUE, i=1; Sorted && (i<n); i++ ) {
+        if ( ( Date[i] < Date[i-1] ) || ( ( Date[i] == Date[i-1] ) && ( UTC[i] < UTC[i-1] ) ) ) Sorted = FALSE;
+    }
+    if ( Sorted ) {
+        sDate = Date; sUTC = UTC; su = u; sv = v;
+    } else {
+        Key   = (Lgm_AtTimes_Key *)calloc( n, sizeof(Lgm_AtTimes_Key) );
+        for ( i=0; i<n; i++ ) { Key[i].Date = Date[i]; Key[i].UTC = UTC[i]; Key[i].i = i; }
+        qsort( Key, n, sizeof(Lgm_AtTimes_Key), Lgm_AtTimes_CompareKeys );
+        sDate = (long int *)calloc( n, sizeof(long int) );
+        sUTC  = (double *)calloc( n, sizeof(double) );
+        su    = (Lgm_Vector *)calloc( 2*n, sizeof(Lgm_Vector) );
+        sv    = su + n;
+        for ( i=0; i<n; i++ ) { sDate[i] = Key[i].Date; sUTC[i] = Key[i].UTC; su[i] = u[ Key[i].i ]; }
+    }
+
+    Start = (long int *)calloc( n+1, sizeof(long int) );
+    nRuns = Lgm_AtTimes_Runs( n, sDate, sUTC, NULL, Start );
+
+#if USE_OPENMP
+    #pragma omp parallel private(cc,r) num_threads(Lgm_GetMaxThreads())
+#endif
+    {
+        cc = Lgm_CopyCTrans( c );
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 8)
+#endif
+        for ( r=0; r<nRuns; r++ ) {
+            if ( tl != NULL ) {
+                Lgm_Set_Coord_Transforms_FromTimeline( sDate[ Start[r] ], sUTC[ Start[r] ], tl, cc );
+            } else {
+                Lgm_Set_Coord_Transforms( sDate[ Start[r] ], sUTC[ Start[r] ], cc );
+            }
+            Lgm_Convert_Coords_Array( Start[r+1]-Start[r], &su[ Start[r] ], &sv[ Start[r] ], flag, cc );
+        }
+        Lgm_free_ctrans( cc );
+    }
+
+    if ( !Sorted ) {
+        for ( i=0; i<n; i++ ) v[ Key[i].i ] = sv[i];
+        free( Key ); free( sDate ); free( sUTC ); free( su );
+    }
+    free( Start );
+
+}
+
+
+/**
+ *  \brief
+ *      Evaluate the field model at points that each have their own time.
+ *
+ *      \param[in]      n       Number of points.
+ *      \param[in]      Date    Dates (e.g. 20101231), one per point.
+ *      \param[in]      UTC     Universal Times in decimal hours, one per point.
+ *      \param[in]      Kp      Kp values, one per point (or NULL).
+ *      \param[in]      u       Positions (in GSM).
+ *      \param[out]     B       The field (in GSM, nT).
+ *      \param[in,out]  mInfo   Properly initialized Lgm_MagModelInfo structure (only its stats are changed).
+ *
+ *      \return         1 if every run evaluated OK, 0 otherwise.
+ */
+int Lgm_B_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, Lgm_Vector *B, Lgm_MagModelInfo *mInfo ) {
+
+    long int            *Start, nRuns, r, i, j, nr, nMax;
+    double              *x, *y, *z, *bx, *by, *bz;
+    int                 Flag = 1;
+    Lgm_MagModelInfo    *m;
+
+    if ( n < 1 ) return( 1 );
+    Start = (long int *)calloc( n+1, sizeof(long int) );
+    nRuns = Lgm_AtTimes_Runs( n, Date, UTC, Kp, Start );
+    for ( nMax=0, r=0; r<nRuns; r++ ) if ( Start[r+1]-Start[r] > nMax ) nMax = Start[r+1]-Start[r];
+
+#if USE_OPENMP
+    #pragma omp parallel private(m,r,i,j,nr,x,y,z,bx,by,bz) reduction(&&:Flag) num_threads(Lgm_GetMaxThreads())
+#endif
+    {
+        m = Lgm_NewMagContext( mInfo );
+        x = (double *)malloc( 6*nMax*sizeof(double) );
+        y = x + nMax; z = y + nMax; bx = z + nMax; by = bx + nMax; bz = by + nMax;
+
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 8)
+#endif
+        for ( r=0; r<nRuns; r++ ) {
+            i  = Start[r];
+            nr = Start[r+1] - i;
+            Lgm_Set_Coord_Transforms( Date[i], UTC[i], m->c );
+            if ( Kp != NULL ) Lgm_AtTimes_SetKp( Kp[i], m );
+            for ( j=0; j<nr; j++ ) { x[j] = u[i+j].x; y[j] = u[i+j].y; z[j] = u[i+j].z; }
+            if ( Lgm_B_Batch( nr, x, y, z, bx, by, bz, m ) != 1 ) Flag = 0;
+            for ( j=0; j<nr; j++ ) { B[i+j].x = bx[j]; B[i+j].y = by[j]; B[i+j].z = bz[j]; }
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_AtTimes)
+#endif
+        {
+            mInfo->Lgm_nMagEvals += m->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( mInfo, m );
+        }
+        free( x );
+        Lgm_FreeMagInfo( m );
+    }
+
+    free( Start );
+
+    return( Flag );
+
+}
+
+
+/**
+ *  \brief
+ *      Evaluate an ensemble of field models at points that each have their own time.
+ *
+ *  \details
+ *      Gives the same results as calling Lgm_B_AtTimes() once per model,
+ *      but everything that doesnt depend on the external model is done once
+ *      per time for the whole ensemble: the transforms are set up once and
+ *      copied into every model, the Qin-Denton inputs (if QinDenton is set)
+ *      are looked up once, and the internal field is evaluated once for all
+ *      of the models that share an internal model and can be split into
+ *      internal and external parts (T89, T96, TS04 and the internal models
+ *      on their own, see Lgm_B_SeparableInternalModel()). Any other model
+ *      (e.g. TS07D) is just evaluated with Lgm_B_Batch().
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      Date        Dates (e.g. 20101231), one per point.
+ *      \param[in]      UTC         Universal Times in decimal hours, one per point.
+ *      \param[in]      u           Positions (in GSM).
+ *      \param[in]      nModels     Number of models in the ensemble.
+ *      \param[in,out]  Models      nModels properly initialized Lgm_MagModelInfo structures (only their stats are changed).
+ *      \param[in]      QinDenton   If TRUE, set every model's inputs from the Qin-Denton values at each time (Lgm_get_QinDenton_at_JD()). Otherwise the inputs already in the models are used.
+ *      \param[out]     B           n*nModels fields (in GSM, nT), side by side: B[i*nModels + k] is model k at point i.
+ *
+ *      \return         1 if every run evaluated OK, 0 otherwise.
+ */
+int Lgm_B_Ensemble_AtTimes( long int n, long int *Date, double *UTC, Lgm_Vector *u, int nModels, Lgm_MagModelInfo **Models, int QinDenton, Lgm_Vector *B ) {
+
+    long int            *Start, nRuns, r, i, j, nr, nMax;
+    double              *x, *y, *z, *bx, *by, *bz, *ib;
+    int                 k, Int, Done[3], Flag = 1;
+    Lgm_MagModelInfo    **m;
+    Lgm_QinDentonOne    p;
+
+    if ( ( n < 1 ) || ( nModels < 1 ) ) return( 1 );
+    Start = (long int *)calloc( n+1, sizeof(long int) );
+    nRuns = Lgm_AtTimes_Runs( n, Date, UTC, NULL, Start );
+    for ( nMax=0, r=0; r<nRuns; r++ ) if ( Start[r+1]-Start[r] > nMax ) nMax = Start[r+1]-Start[r];
+
+#if USE_OPENMP
+    #pragma omp parallel private(m,r,i,j,k,nr,x,y,z,bx,by,bz,ib,Int,Done,p) reduction(&&:Flag) num_threads(Lgm_GetMaxThreads())
+#endif
+    {
+        m = (Lgm_MagModelInfo **)calloc( nModels, sizeof(Lgm_MagModelInfo *) );
+        for ( k=0; k<nModels; k++ ) m[k] = Lgm_NewMagContext( Models[k] );
+        x  = (double *)malloc( 15*nMax*sizeof(double) );
+        y  = x + nMax; z = y + nMax; bx = z + nMax; by = bx + nMax; bz = by + nMax;
+        ib = bz + nMax;     // internal fields (x, y and z) for CDIP, EDIP and IGRF
+
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 8)
+#endif
+        for ( r=0; r<nRuns; r++ ) {
+
+            i  = Start[r];
+            nr = Start[r+1] - i;
+
+            Lgm_Set_Coord_Transforms( Date[i], UTC[i], m[0]->c );
+            if ( QinDenton ) Lgm_get_QinDenton_at_JD( m[0]->c->UTC.JD, &p, 0, 1 );
+            for ( k=0; k<nModels; k++ ) {
+                Lgm_CopyCTransInto( m[k]->c, m[0]->c );
+                if ( QinDenton ) Lgm_set_QinDenton( &p, m[k] );
+            }
+
+            for ( j=0; j<nr; j++ ) { x[j] = u[i+j].x; y[j] = u[i+j].y; z[j] = u[i+j].z; }
+            Done[LGM_CDIP] = Done[LGM_EDIP] = Done[LGM_IGRF] = FALSE;
+
+            for ( k=0; k<nModels; k++ ) {
+                Int = Lgm_B_SeparableInternalModel( m[k] );
+                if ( ( Int == LGM_CDIP ) || ( Int == LGM_EDIP ) || ( Int == LGM_IGRF ) ) {
+                    if ( !Done[Int] ) {
+                        if      ( Int == LGM_CDIP ) Lgm_B_cdip_Batch( nr, x, y, z, ib + 3*Int*nMax, ib + (3*Int+1)*nMax, ib + (3*Int+2)*nMax, m[k] );
+                        else if ( Int == LGM_EDIP ) Lgm_B_edip_Batch( nr, x, y, z, ib + 3*Int*nMax, ib + (3*Int+1)*nMax, ib + (3*Int+2)*nMax, m[k] );
+                        else                        Lgm_B_igrf_Batch( nr, x, y, z, ib + 3*Int*nMax, ib + (3*Int+1)*nMax, ib + (3*Int+2)*nMax, m[k] );
+                        Done[Int] = TRUE;
+                    }
+                    for ( j=0; j<nr; j++ ) { bx[j] = ib[3*Int*nMax+j]; by[j] = ib[(3*Int+1)*nMax+j]; bz[j] = ib[(3*Int+2)*nMax+j]; }
+                    Lgm_B_AddExternal_Batch( nr, x, y, z, bx, by, bz, m[k] );
+                } else if ( Lgm_B_Batch( nr, x, y, z, bx, by, bz, m[k] ) != 1 ) {
+                    Flag = 0;
+                }
+                for ( j=0; j<nr; j++ ) { B[(i+j)*nModels+k].x = bx[j]; B[(i+j)*nModels+k].y = by[j]; B[(i+j)*nModels+k].z = bz[j]; }
+            }
+
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_AtTimes)
+#endif
+        {
+            for ( k=0; k<nModels; k++ ) {
+                Models[k]->Lgm_nMagEvals += m[k]->Lgm_nMagEvals;
+                Lgm_MagModelInfo_AddStats( Models[k], m[k] );
+            }
+        }
+        free( x );
+        for ( k=0; k<nModels; k++ ) Lgm_FreeMagInfo( m[k] );
+        free( m );
+    }
+
+    free( Start );
+
+    return( Flag );
+
+}
+
+
+/**
+ *  \brief
+ *      Lgm_Trace() for points that each have their own time.
+ *
+ *      \param[in]      n       Number of points.
+ *      \param[in]      Date    Dates (e.g. 20101231), one per point.
+ *      \param[in]      UTC     Universal Times in decimal hours, one per point.
+ *      \param[in]      Kp      Kp values, one per point (or NULL).
+ *      \param[in]      u       Positions (in GSM).
+ *      \param[in]      Height  Footpoint height in km (see Lgm_Trace()).
+ *      \param[in]      TOL1    Tolerance for the footpoints (<= 0 for the default).
+ *      \param[in]      TOL2    Tolerance for Pmin (<= 0 for the default).
+ *      \param[out]     Flag    The field line types (LGM_CLOSED, etc.).
+ *      \param[out]     v1      Southern footpoints (GSM).
+ *      \param[out]     v2      Northern footpoints (GSM).
+ *      \param[out]     v3      Minimum B points (GSM).
+ *      \param[in,out]  mInfo   Properly initialized Lgm_MagModelInfo structure (only its stats are changed).
+ *
+ *      \return         The number of closed field lines.
+ */
+int Lgm_Trace_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, double Height, double TOL1, double TOL2,
+                       int *Flag, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, Lgm_MagModelInfo *mInfo ) {
+
+    long int            i;
+    int                 nClosed = 0;
+    Lgm_MagModelInfo    *m;
+
+    if ( TOL1 <= 0.0 ) TOL1 = LGM_ATTIMES_TRACE_TOL;
+    if ( TOL2 <= 0.0 ) TOL2 = LGM_ATTIMES_TRACE_TOL2;
+
+#if USE_OPENMP
+    #pragma omp parallel private(m,i) reduction(+:nClosed) num_threads(Lgm_GetMaxThreads())
+#endif
+    {
+        m = Lgm_NewMagContext( mInfo );
+
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 4)
+#endif
+        for ( i=0; i<n; i++ ) {
+            Lgm_Set_Coord_Transforms( Date[i], UTC[i], m->c );
+            if ( Kp != NULL ) Lgm_AtTimes_SetKp( Kp[i], m );
+            Flag[i] = Lgm_Trace( &u[i], &v1[i], &v2[i], &v3[i], Height, TOL1, TOL2, m );
+            if ( Flag[i] == LGM_CLOSED ) ++nClosed;
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_AtTimes)
+#endif
+        {
+            mInfo->Lgm_nMagEvals += m->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( mInfo, m );
+        }
+        Lgm_FreeMagInfo( m );
+    }
+
+    return( nClosed );
+
+}
+
+
+/**
+ *  \brief
+ *      L*, I, K and Bm versus pitch angle for points that each have their own time.
+ *
+ *  \details
+ *      The points are done in chunks with Lgm_ComputeLstarVersusPA_Multi()
+ *      (so all of the (time, pitch angle) pairs of a chunk share the threads).
+ *      MagEphemInfo is set up as for Lgm_ComputeLstarVersusPA() and is used for
+ *      the first time of each chunk; the others use copies of it. Results for
+ *      point i and pitch angle j are at index i*nAlpha + j (LGM_FILL_VALUE
+ *      where they couldnt be computed). Any of the outputs can be NULL.
+ *
+ *      \param[in]      n               Number of points.
+ *      \param[in]      Date            Dates (e.g. 20101231), one per point.
+ *      \param[in]      UTC             Universal Times in decimal hours, one per point.
+ *      \param[in]      Kp              Kp values, one per point (or NULL).
+ *      \param[in]      u               Positions (in GSM).
+ *      \param[in]      nAlpha          Number of pitch angles (at most MagEphemInfo->nAllocedAlpha).
+ *      \param[in]      Alpha           Local pitch angles in degrees.
+ *      \param[out]     Lstar           n*nAlpha values.
+ *      \param[out]     I               n*nAlpha values.
+ *      \param[out]     K               n*nAlpha values.
+ *      \param[out]     Bm              n*nAlpha values.
+ *      \param[in,out]  MagEphemInfo    Properly initialized Lgm_MagEphemInfo structure.
+ *
+ *      \return         The number of L* values that are defined, or -1 if nAlpha is too big.
+ */
+int Lgm_ComputeLstarVersusPA_AtTimes( long int n, long int *Date, double *UTC, double *Kp, Lgm_Vector *u, int nAlpha, double *Alpha,
+                                      double *Lstar, double *I, double *K, double *Bm, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_MagEphemInfo    **mei;
+    long int            i0, k;
+    int                 nChunk, nThreads, nt, t, j, nGood = 0;
+
+    if ( nAlpha > MagEphemInfo->nAllocedAlpha ) return( -1 );
+    if ( n < 1 ) return( 0 );
+
+    nThreads = Lgm_GetMaxThreads();
+    nChunk = ( n < 4*nThreads ) ? (int)n : 4*nThreads;
+
+    mei = (Lgm_MagEphemInfo **)calloc( nChunk, sizeof(Lgm_MagEphemInfo *) );
+    mei[0] = MagEphemInfo;
+    for ( t=1; t<nChunk; t++ ) mei[t] = Lgm_CopyMagEphemInfo( MagEphemInfo, ( nAlpha > 0 ) ? nAlpha : 1 );
+
+    for ( i0=0; i0<n; i0 += nt ) {
+        nt = ( n - i0 < nChunk ) ? (int)(n - i0) : nChunk;
+        if ( Kp != NULL ) {
+            for ( t=0; t<nt; t++ ) Lgm_AtTimes_SetKp( Kp[i0+t], mei[t]->LstarInfo->mInfo );
+        }
+        Lgm_ComputeLstarVersusPA_Multi( nt, &Date[i0], &UTC[i0], &u[i0], nAlpha, Alpha, FALSE, mei );
+        for ( t=0; t<nt; t++ ) {
+            for ( j=0; j<nAlpha; j++ ) {
+                k = (i0+t)*nAlpha + j;
+                if ( Lstar != NULL ) Lstar[k] = mei[t]->Lstar[j];
+                if ( I     != NULL ) I[k]     = mei[t]->I[j];
+                if ( K     != NULL ) K[k]     = mei[t]->K[j];
+                if ( Bm    != NULL ) Bm[k]    = mei[t]->Bm[j];
+                if ( mei[t]->Lstar[j] > 0.0 ) ++nGood;
+            }
+        }
+    }
+
+    for ( t=1; t<nChunk; t++ ) Lgm_FreeMagEphemInfo( mei[t] );
+    free( mei );
+
+    return( nGood );
+
+}
@@ -0,0 +1,647 @@
+/*! \file Lgm_B_Batch.c
+ *
+ *  \brief Structure-of-arrays (batched) versions of the B-field models.
+ *
+ *  The scalar models are all reached through the Info->Bfield() function
+ *  pointer, one point per call. When a large number of points have to be
+ *  evaluated at a single epoch (e.g. field maps, conjunction searches) most of
+ *  the per-point work in the scalar routines is actually per-epoch setup
+ *  (selecting the internal model, building the GSM->GEO rotation, loading the
+ *  PARMOD array, etc.). The routines here hoist that work out of the loop and
+ *  evaluate the field over whole arrays of positions.
+ *
+ *  All positions are in GSM (in Re) and all fields are returned in GSM (in nT),
+ *  exactly as in the scalar routines. Results agree with the scalar routines
+ *  to within round-off.
+ *
+ *  The general entry point is Lgm_B_Batch(). It uses Info->BfieldBatch if the
+ *  user has installed one, otherwise it picks the native batch kernel that
+ *  corresponds to Info->Bfield, and if there is none it just loops over
+ *  Info->Bfield.
+ *
+ *
+ */
+#include "Lgm/Lgm_MagModelInfo.h"
+
+/*
+ *  Number of points handed to the multi-point IGRF kernel at a time.
+ */
+#define LGM_B_BATCH_CHUNK   (8*LGM_IGRF_VLEN)
+
+
+
+/*
+ *  Compute the centered dipole field for an array of points. This is done
+ *  directly in cartesian SM coords, so no trig functions are needed at all.
+ *
+ *      B = M/r^5 ( -3 x z, -3 y z, r^2 - 3 z^2 )   (in SM, M = c->M_cd)
+ */
+static void Lgm_B_dip_Batch( long int n, const double *x, const double *y, const double *z,
+                             double *bx, double *by, double *bz, double x0, double y0, double z0, Lgm_CTrans *c ) {
+
+    long int    i;
+    double      M, cp, sp, x_sm, y_sm, z_sm, r2, r, f, Bx_sm, By_sm, Bz_sm;
+
+    M  = c->M_cd;
+    cp = c->cos_psi;
+    sp = c->sin_psi;
+
+    for ( i=0; i<n; ++i ) {
+
+        /*
+         *  GSM -> SM (and offset dipole if needed)
+         */
+        x_sm = x[i]*cp - z[i]*sp - x0;
+        y_sm = y[i]             - y0;
+        z_sm = x[i]*sp + z[i]*cp - z0;
+
+        r2 = x_sm*x_sm + y_sm*y_sm + z_sm*z_sm;
+        r  = sqrt( r2 );
+        f  = M/(r2*r2*r);
+
+        Bx_sm = -3.0*f*x_sm*z_sm;
+        By_sm = -3.0*f*y_sm*z_sm;
+        Bz_sm = f*(r2 - 3.0*z_sm*z_sm);
+
+        /*
+         *  SM -> GSM
+         */
+        bx[i] =  Bx_sm*cp + Bz_sm*sp;
+        by[i] =  By_sm;
+        bz[i] = -Bx_sm*sp + Bz_sm*cp;
+
+    }
+
+}
+
+/**
+ *  \brief
+ *      Batched centered dipole field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_cdip().
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_cdip_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+    Lgm_B_dip_Batch( n, x, y, z, bx, by, bz, 0.0, 0.0, 0.0, Info->c );
+    return(1);
+}
+
+/**
+ *  \brief
+ *      Batched eccentric dipole field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_edip(). The eccentric dipole
+ *      offset is converted to SM once for the whole batch.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_edip_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector  ED_geo, ED_sm;
+
+    ED_geo.x = Info->c->ED_x0; ED_geo.y = Info->c->ED_y0; ED_geo.z = Info->c->ED_z0;
+    Lgm_Convert_Coords( &ED_geo, &ED_sm, WGS84_TO_SM, Info->c );
+    Lgm_B_dip_Batch( n, x, y, z, bx, by, bz, ED_sm.x, ED_sm.y, ED_sm.z, Info->c );
+
+    return(1);
+
+}
+
+/**
+ *  \brief
+ *      Batched IGRF field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_igrf(). The GSM<->WGS84 rotation
+ *      is composed once for the whole batch instead of being re-derived
+ *      through MOD/TOD/PEF for every point, and the spherical harmonic
+ *      sums are done by the multi-point SIMD kernel Lgm_IGRF_Multi().
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_igrf_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int    i0, i;
+    int         k, nc;
+    double      A[3][3], r, theta, phi, st, ct, sp, cp;
+    Lgm_Vector  u, w, Bgeo, Sph[LGM_B_BATCH_CHUNK], Bsph[LGM_B_BATCH_CHUNK];
+    Lgm_CTrans  *c = Info->c;
+
+    /*
+     *  Agsm_to_wgs84 = Amod_to_wgs84 * Agsm_to_mod
+     */
+    Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, A );
+
+    for ( i0=0; i0<n; i0 += LGM_B_BATCH_CHUNK ) {
+
+        nc = ( n-i0 < LGM_B_BATCH_CHUNK ) ? (int)(n-i0) : LGM_B_BATCH_CHUNK;
+
+        /*
+         *  GSM -> WGS84 and then to geocentric spherical coords (theta is colat)
+         */
+        for ( k=0; k<nc; ++k ) {
+            i = i0+k;
+            u.x = x[i]; u.y = y[i]; u.z = z[i];
+            Lgm_MatTimesVec( A, &u, &w );
+            r     = sqrt( w.x*w.x + w.y*w.y + w.z*w.z );
+            Sph[k].x = r;
+            Sph[k].y = acos( w.z/r );
+            Sph[k].z = atan2( w.y, w.x );
+        }
+
+        Lgm_IGRF_Multi( nc, Sph, Bsph, c );
+
+        /*
+         *  Spherical -> cartesian (still WGS84), then back to GSM.
+         *  (Transpose of A is the WGS84 -> GSM rotation.)
+         */
+        for ( k=0; k<nc; ++k ) {
+            i = i0+k;
+            theta = Sph[k].y; phi = Sph[k].z;
+            st    = sin( theta ); ct = cos( theta );
+            sp    = sin( phi );   cp = cos( phi );
+
+            Bgeo.x = Bsph[k].x*st*cp + Bsph[k].y*ct*cp - Bsph[k].z*sp;
+            Bgeo.y = Bsph[k].x*st*sp + Bsph[k].y*ct*sp + Bsph[k].z*cp;
+            Bgeo.z = Bsph[k].x*ct    - Bsph[k].y*st;
+
+            bx[i] = A[0][0]*Bgeo.x + A[0][1]*Bgeo.y + A[0][2]*Bgeo.z;
+            by[i] = A[1][0]*Bgeo.x + A[1][1]*Bgeo.y + A[1][2]*Bgeo.z;
+            bz[i] = A[2][0]*Bgeo.x + A[2][1]*Bgeo.y + A[2][2]*Bgeo.z;
+        }
+
+    }
+
+    return(1);
+
+}
+
+
+/*
+ *  Evaluate the internal field selected by Info->InternalModel into (bx, by, bz).
+ *  Used by all of the batched external models.
+ */
+static int Lgm_B_Internal_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info, char *Caller ) {
+
+    long int i;
+
+    switch ( Info->InternalModel ){
+
+        case LGM_CDIP:
+                        Lgm_B_cdip_Batch( n, x, y, z, bx, by, bz, Info );
+                        break;
+        case LGM_EDIP:
+                        Lgm_B_edip_Batch( n, x, y, z, bx, by, bz, Info );
+                        break;
+        case LGM_IGRF:
+                        Lgm_B_igrf_Batch( n, x, y, z, bx, by, bz, Info );
+                        break;
+        default:
+                        fprintf(stderr, "%s: Unknown internal model (%d)\n", Caller, Info->InternalModel );
+                        for ( i=0; i<n; ++i ) bx[i] = by[i] = bz[i] = 0.0;
+                        break;
+
+    }
+
+    return(1);
+
+}
+
+
+/*
+ *  The external parts of the batched models. These add the external field
+ *  into (bx, by, bz), so the internal field can be computed once and shared
+ *  (see Lgm_B_AddExternal_Batch()).
+ */
+static void Lgm_T89_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int    i;
+    Lgm_Vector  v, B1;
+
+    if ( Info->ExternalPrecision == LGM_PRECISION_SINGLE ) {
+        Lgm_T89_External_Batch_f32( n, x, y, z, bx, by, bz, Info );
+        return;
+    }
+
+    for ( i=0; i<n; ++i ) {
+        v.x = x[i]; v.y = y[i]; v.z = z[i];
+        Lgm_T89_External( &v, &B1, Info );
+        bx[i] += B1.x;
+        by[i] += B1.y;
+        bz[i] += B1.z;
+    }
+
+}
+
+static void Lgm_T96_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int    i;
+    int         iopt = 0;
+    double      parmod[11], ps, sps, cps, Bx, By, Bz;
+
+    parmod[1]  = Info->P;   // Pressure in nPa
+    parmod[2]  = Info->Dst; // Dst in nPa
+    parmod[3]  = Info->By;  // IMF By in nT
+    parmod[4]  = Info->Bz;  // IMF Bz in nT
+
+    ps  = Info->c->psi;
+    sps = Info->c->sin_psi;
+    cps = Info->c->cos_psi;
+
+    for ( i=0; i<n; ++i ) {
+        Tsyg_T96( iopt, parmod, ps, sps, cps, x[i], y[i], z[i], &Bx, &By, &Bz, &Info->T96_Info );
+        bx[i] += Bx; by[i] += By; bz[i] += Bz;
+    }
+
+}
+
+static void Lgm_TS04_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int    i;
+    int         iopt = 0;
+    double      parmod[11], ps, sps, cps, Bx, By, Bz;
+
+    parmod[1]  = Info->P;       // Pressure in nPa
+    parmod[2]  = Info->Dst;     // Dst in nPa
+    parmod[3]  = Info->By;      // IMF By in nT
+    parmod[4]  = Info->Bz;      // IMF Bz in nT
+    parmod[5]  = Info->W[0];    // W1
+    parmod[6]  = Info->W[1];    // W2
+    parmod[7]  = Info->W[2];    // W3
+    parmod[8]  = Info->W[3];    // W4
+    parmod[9]  = Info->W[4];    // W5
+    parmod[10] = Info->W[5];    // W6
+
+    ps  = Info->c->psi;
+    sps = Info->c->sin_psi;
+    cps = Info->c->cos_psi;
+
+    for ( i=0; i<n; ++i ) {
+        Tsyg_TS04( iopt, parmod, ps, sps, cps, x[i], y[i], z[i], &Bx, &By, &Bz, &Info->TS04_Info );
+        bx[i] += Bx; by[i] += By; bz[i] += Bz;
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Batched T89 field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_T89(). The internal field is
+ *      evaluated with the batched internal kernels and the four T89 current
+ *      systems (see Lgm_T89_External()) are then added in point by point.
+ *      With Info->ExternalPrecision set to LGM_PRECISION_SINGLE the external
+ *      part is done in float instead (see Lgm_T89_External_Batch_f32()).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_T89_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_B_Internal_Batch( n, x, y, z, bx, by, bz, Info, "Lgm_B_T89_Batch" );
+    Lgm_T89_External_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Info->nFunc += n;
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Batched T96 field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_T96(). PARMOD and the tilt
+ *      quantities are set up once for the whole batch.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_T96_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_B_Internal_Batch( n, x, y, z, bx, by, bz, Info, "Lgm_B_T96_Batch" );
+    Lgm_T96_External_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Info->nFunc += n;
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Batched TS04 field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_TS04(). PARMOD and the tilt
+ *      quantities are set up once for the whole batch.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_TS04_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_B_Internal_Batch( n, x, y, z, bx, by, bz, Info, "Lgm_B_TS04_Batch" );
+    Lgm_TS04_External_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Info->nFunc += n;
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Batched OP77 field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_OP77(). The tilt dependent
+ *      coefficients are set up once for the whole batch and the external
+ *      field is vectorized (see Lgm_OP77_External_Batch()).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_OP77_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_B_Internal_Batch( n, x, y, z, bx, by, bz, Info, "Lgm_B_OP77_Batch" );
+    Lgm_OP77_External_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Info->nFunc += n;
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Batched OP88 field.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_B_OP88(). The dynamic scalings
+ *      (from Info->Den, Info->V and Info->Dst) are set up once for the whole
+ *      batch and the external field is vectorized (see
+ *      Lgm_OP88_External_Batch()).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_OP88_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_B_Internal_Batch( n, x, y, z, bx, by, bz, Info, "Lgm_B_OP88_Batch" );
+    Lgm_OP88_External_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Info->nFunc += n;
+
+    return(1);
+
+}
+
+
+/*
+ *  The internal model (LGM_IGRF, LGM_CDIP or LGM_EDIP) whose field
+ *  Lgm_B_AddExternal_Batch() adds to, or -1 if Info->Bfield cant be split
+ *  into internal and external parts.
+ */
+int Lgm_B_SeparableInternalModel( Lgm_MagModelInfo *Info ) {
+
+    if      ( Info->Bfield == Lgm_B_igrf ) return( LGM_IGRF );
+    else if ( Info->Bfield == Lgm_B_cdip ) return( LGM_CDIP );
+    else if ( Info->Bfield == Lgm_B_edip ) return( LGM_EDIP );
+    else if ( ( Info->Bfield == Lgm_B_T89 ) || ( Info->Bfield == Lgm_B_T96 ) || ( Info->Bfield == Lgm_B_TS04 )
+              || ( Info->Bfield == Lgm_B_OP77 ) || ( Info->Bfield == Lgm_B_OP88 ) ) return( Info->InternalModel );
+
+    return( -1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Add the external part of the selected field model to a precomputed internal field.
+ *
+ *  \details
+ *      For models made of an internal model plus an external model with a
+ *      native batch kernel (T89, T96, TS04, OP77 and OP88, and the internal models on
+ *      their own), (bx, by, bz) should hold the internal field given by
+ *      Lgm_B_SeparableInternalModel() at the points on input, and holds the
+ *      full field on output. That way
+ *      several models (e.g. an ensemble of external models, see
+ *      Lgm_B_Ensemble_AtTimes()) can share one evaluation of the internal
+ *      field. Other models are left alone (use Lgm_B_Batch() for them).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[in,out]  bx          Array of n GSM Bx values (in nT).
+ *      \param[in,out]  by          Array of n GSM By values (in nT).
+ *      \param[in,out]  bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1 if the external part was added, 0 if Info->Bfield cant be split up this way.
+ *
+ */
+int Lgm_B_AddExternal_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    if      ( Info->Bfield == Lgm_B_T89  ) Lgm_T89_External_Batch( n, x, y, z, bx, by, bz, Info );
+    else if ( Info->Bfield == Lgm_B_T96  ) Lgm_T96_External_Batch( n, x, y, z, bx, by, bz, Info );
+    else if ( Info->Bfield == Lgm_B_TS04 ) Lgm_TS04_External_Batch( n, x, y, z, bx, by, bz, Info );
+    else if ( Info->Bfield == Lgm_B_OP77 ) Lgm_OP77_External_Batch( n, x, y, z, bx, by, bz, Info );
+    else if ( Info->Bfield == Lgm_B_OP88 ) Lgm_OP88_External_Batch( n, x, y, z, bx, by, bz, Info );
+    else if ( Lgm_B_SeparableInternalModel( Info ) < 0 ) return( 0 );
+
+    Info->nFunc += n;
+
+    return( 1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Generic batched field evaluation.
+ *
+ *  \details
+ *      Loops over the scalar Info->Bfield() routine. This is what gets used
+ *      for models that do not (yet) have a native batch kernel.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_Generic_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int    i;
+    Lgm_Vector  v, B;
+
+    for ( i=0; i<n; ++i ) {
+        v.x = x[i]; v.y = y[i]; v.z = z[i];
+        Info->Bfield( &v, &B, Info );
+        bx[i] = B.x; by[i] = B.y; bz[i] = B.z;
+    }
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Return the native batch kernel that corresponds to a scalar field routine.
+ *
+ *      \param[in]      Bfield      A scalar field routine (e.g. Lgm_B_T89).
+ *
+ *      \return         The matching batch routine, or NULL if there is no native one.
+ *
+ */
+Lgm_BfieldBatchFunc Lgm_Native_BfieldBatch( int (*Bfield)() ) {
+
+    if      ( Bfield == Lgm_B_igrf ) return( Lgm_B_igrf_Batch );
+    else if ( Bfield == Lgm_B_cdip ) return( Lgm_B_cdip_Batch );
+    else if ( Bfield == Lgm_B_edip ) return( Lgm_B_edip_Batch );
+    else if ( Bfield == Lgm_B_T89  ) return( Lgm_B_T89_Batch );
+    else if ( Bfield == Lgm_B_T96  ) return( Lgm_B_T96_Batch );
+    else if ( Bfield == Lgm_B_TS04 ) return( Lgm_B_TS04_Batch );
+    else if ( Bfield == Lgm_B_OP77 ) return( Lgm_B_OP77_Batch );
+    else if ( Bfield == Lgm_B_OP88 ) return( Lgm_B_OP88_Batch );
+
+    return( NULL );
+
+}
+
+
+/**
+ *  \brief
+ *      Evaluate the currently selected field model over arrays of positions.
+ *
+ *  \details
+ *      If Info->BfieldBatch is non-NULL, it is used. Otherwise the native
+ *      batch kernel for Info->Bfield is used (see
+ *      Lgm_Native_BfieldBatch()), and if there isn't one we fall back on
+ *      Lgm_B_Generic_Batch(). This means that code which sets Info->Bfield
+ *      directly automatically gets the fast path.
+ *
+ *      If Info->OffloadDevice is set and the model can be done there, the
+ *      points are done on that device instead (see Lgm_B_Offload_Batch()).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         Whatever the underlying batch routine returns.
+ *
+ */
+int Lgm_B_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    Lgm_BfieldBatchFunc f;
+
+    if ( n <= 0 ) return(1);
+
+    if ( ( Info->OffloadDevice != LGM_OFFLOAD_NONE ) && Lgm_B_Offload_Batch( n, x, y, z, bx, by, bz, Info ) ) return(1);
+
+    if ( (f = Info->BfieldBatch) == NULL ) {
+        if ( (f = Lgm_Native_BfieldBatch( Info->Bfield )) == NULL ) f = Lgm_B_Generic_Batch;
+    }
+
+    return( f( n, x, y, z, bx, by, bz, Info ) );
+
+}
@@ -5,6 +5,11 @@
  *
  */
 
+#include <config.h>
+#include <stdint.h>
+#if USE_OPENMP
+#include <omp.h>
+#endif
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_Octree.h"
 #include "Lgm/Lgm_KdTree.h"
@@ -89,10 +94,13 @@ int Lgm_B_FromScatteredData( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Inf
     /*
      *  Evaluate Divergence Free Interpolation
      */
+    LGM_STATS_START( tRBF );
     Lgm_DFI_RBF_Eval( v, B, rbf );
 
 
 
+    LGM_STATS_STOP( Info, RBF, tRBF );
+
 
     /*
      *  Cleanup. Free rbf, kNN, etc..
@@ -118,6 +126,36 @@ void Lgm_B_FromScatteredData_SetRbf( Lgm_MagModelInfo *Info, double eps, int Rbf
 
 }
 
+/*
+ *  Have Lgm_B_FromScatteredData4() and Lgm_B_FromScatteredData5() keep their
+ *  fits in c (from Lgm_InitRBFCache()) rather than in Info's own hash tables.
+ *  Copies of Info made after this share c, so threads share fits. c is not
+ *  freed by the TearDown routines; free it with Lgm_FreeRBFCache() once no
+ *  Lgm_MagModelInfo is using it. NULL goes back to the per-Info tables.
+ */
+void Lgm_B_FromScatteredData_SetCache( Lgm_MagModelInfo *Info, Lgm_RBF_Cache *c ) {
+
+    Lgm_B_FromScatteredData_ResetLast( Info );
+    Info->RBF_Cache = c;
+
+}
+
+/*
+ *  Forget the last kNN set of Lgm_B_FromScatteredData5() (and hand its
+ *  entry back to Info->RBF_Cache). The TearDown routines and
+ *  Lgm_B_FromScatteredData_SetCache() do this; call it yourself before
+ *  changing the KdTree's data in place or freeing the cache.
+ */
+void Lgm_B_FromScatteredData_ResetLast( Lgm_MagModelInfo *Info ) {
+
+    if ( Info->RBF_Last_Entry ) Lgm_RBF_Cache_Release( Info->RBF_Last_Cache, Info->RBF_Last_Entry );
+    Info->RBF_Last_Entry = NULL;
+    Info->RBF_Last_rbf   = NULL;
+    Info->RBF_Last_rbf_e = NULL;
+    Info->RBF_Last_Valid = FALSE;
+
+}
+
 
 /*
  *  Setup the hash table used in Lgm_B_FromScatteredData().
@@ -165,6 +203,8 @@ void Lgm_B_FromScatteredData4_TearDown( Lgm_MagModelInfo *Info ) {
 
     Lgm_Vec_RBF_Info *rbf, *rbf_tmp;
 
+    Lgm_B_FromScatteredData_ResetLast( Info );
+
     HASH_ITER( hh, Info->vec_rbf_ht, rbf, rbf_tmp ) {
         HASH_DELETE( hh, Info->vec_rbf_ht, rbf );
         Lgm_Vec_RBF_Free( rbf );
@@ -190,11 +230,12 @@ void Lgm_B_FromScatteredData5_SetUp( Lgm_MagModelInfo *Info ) {
 Lgm_Vec_RBF_Info ***b;
 
     if ( Info->rbf_ht_alloced ) Lgm_B_FromScatteredData5_TearDown( Info );
+    Lgm_B_FromScatteredData_ResetLast( Info );
     Info->vec_rbf_ht     = NULL;
-    Info->vec_rbf_e_ht   = NULL;
     Info->rbf_ht_alloced = FALSE;
     Info->RBF_nHashFinds = 0;
     Info->RBF_nHashAdds  = 0;
+    Info->RBF_nReuses    = 0;
 
 
     Info->RBF_CB.n           = 0;
@@ -221,15 +262,12 @@ void Lgm_B_FromScatteredData5_TearDown( Lgm_MagModelInfo *Info ) {
 
     Lgm_Vec_RBF_Info *rbf, *rbf_tmp;
 
-    // free the B-field RBFs
+    Lgm_B_FromScatteredData_ResetLast( Info );
+
+    // free the RBFs (the E-field ones hang off the B-field ones)
     HASH_ITER( hh, Info->vec_rbf_ht, rbf, rbf_tmp ) {
         HASH_DELETE( hh, Info->vec_rbf_ht, rbf );
-        Lgm_Vec_RBF_Free( rbf );
-    }
-
-    // free the E-field RBFs
-    HASH_ITER( hh, Info->vec_rbf_e_ht, rbf, rbf_tmp ) {
-        HASH_DELETE( hh, Info->vec_rbf_e_ht, rbf );
+        if ( rbf->rbf_e ) Lgm_Vec_RBF_Free( rbf->rbf_e );
         Lgm_Vec_RBF_Free( rbf );
     }
 
@@ -415,13 +453,15 @@ int Lgm_B_FromScatteredData2( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
         /*
          *  Evaluate Divergence Free Interpolation
          */
-        Lgm_DFI_RBF_Eval( v, &B1, rbf );
+        LGM_STATS_START( tRBF );
 
         /*
-         *  Evaluate derivatives of Divergence Free Interpolation 
-         *  put in the Info structure.
+         *  (B and its derivatives are done together. The derivatives are put
+         *  in the Info structure.)
          */
-        Lgm_DFI_RBF_Derivs_Eval( v, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        Lgm_DFI_RBF_EvalAll( v, &B1, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+
+        LGM_STATS_STOP( Info, RBF, tRBF );
 
 
         /*
@@ -670,17 +710,19 @@ Info->RBF_Eps = 1.0/(d2min);
         /*
          *  Evaluate Divergence Free Interpolation
          */
-        Lgm_DFI_RBF_Eval( v, &B1, rbf );
-        //printf("Evaluating with rbf = %p  at v = %g %g %g   B1 = %g %g %g\n\n\n", rbf, v->x, v->y, v->z, B1.x, B1.y, B1.z);
+        LGM_STATS_START( tRBF );
 
         /*
-         *  Evaluate derivatives of Divergence Free Interpolation 
-         *  put in the Info structure.
+         *  (B and its derivatives are done together. The derivatives are put
+         *  in the Info structure.)
          */
-            Lgm_DFI_RBF_Derivs_Eval( v, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        Lgm_DFI_RBF_EvalAll( v, &B1, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        //printf("Evaluating with rbf = %p  at v = %g %g %g   B1 = %g %g %g\n\n\n", rbf, v->x, v->y, v->z, B1.x, B1.y, B1.z);
         if ( Info->RBF_CompGradAndCurl ) {
         }
 
+        LGM_STATS_STOP( Info, RBF, tRBF );
+
 
         /*
          *  Cleanup. Free rbf, kNN, etc..
@@ -886,6 +928,7 @@ int Lgm_B_FromScatteredData4( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
     double              *eps, d;
     Lgm_KdTreeData     *kNN;
     Lgm_Vec_RBF_Info   *rbf;                      // single structure.
+    Lgm_RBF_CacheEntry *Entry = NULL;             // if fit came from Info->RBF_Cache
     Lgm_Vector         *v_data, *B_data, B1, B2;
     Lgm_Vector          b, Grad_B1, GradB_dipole; 
     unsigned long int  *I_data;
@@ -971,7 +1014,12 @@ int Lgm_B_FromScatteredData4( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
         //for(i=0;i<Kgot; i++) printf(" %ld ", LookUpKey[i] );
         //printf("    (KeyLength = %d)\n", KeyLength);
         rbf = NULL;
-        HASH_FIND( hh, Info->vec_rbf_ht, LookUpKey, KeyLength, rbf );
+        if ( Info->RBF_Cache ) {
+            Entry = Lgm_RBF_Cache_Get( Info->RBF_Cache, LookUpKey, Kgot );
+            if ( Entry ) rbf = Entry->rbf;
+        } else {
+            HASH_FIND( hh, Info->vec_rbf_ht, LookUpKey, KeyLength, rbf );
+        }
         ++(Info->RBF_nHashFinds);
 
 
@@ -1050,7 +1098,12 @@ Info->RBF_Eps = 1.0/(d2min*10.0);
             LGM_ARRAY_1D_FREE( B_data );
 
             //printf("Adding item to hash table\n");
-            HASH_ADD_KEYPTR( hh, Info->vec_rbf_ht, rbf->LookUpKey, KeyLength, rbf );
+            if ( Info->RBF_Cache ) {
+                Entry = Lgm_RBF_Cache_Add( Info->RBF_Cache, rbf, NULL );
+                rbf   = Entry->rbf;
+            } else {
+                HASH_ADD_KEYPTR( hh, Info->vec_rbf_ht, rbf->LookUpKey, KeyLength, rbf );
+            }
             ++(Info->RBF_nHashAdds);
 
         } else {
@@ -1068,21 +1121,24 @@ Info->RBF_Eps = 1.0/(d2min*10.0);
         /*
          *  Evaluate Divergence Free Interpolation
          */
-        Lgm_Vec_RBF_Eval( v, &B1, rbf );
-        //printf("Evaluating with rbf = %p  at v = %g %g %g   B1 = %g %g %g\n\n\n", rbf, v->x, v->y, v->z, B1.x, B1.y, B1.z);
+        LGM_STATS_START( tRBF );
 
         /*
-         *  Evaluate derivatives of Divergence Free Interpolation 
-         *  put in the Info structure.
+         *  (B and its derivatives are done together. The derivatives are put
+         *  in the Info structure.)
          */
-            Lgm_Vec_RBF_Derivs_Eval( v, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        Lgm_Vec_RBF_EvalAll( v, &B1, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        //printf("Evaluating with rbf = %p  at v = %g %g %g   B1 = %g %g %g\n\n\n", rbf, v->x, v->y, v->z, B1.x, B1.y, B1.z);
         if ( Info->RBF_CompGradAndCurl ) {
         }
 
+        LGM_STATS_STOP( Info, RBF, tRBF );
+
 
         /*
          *  Cleanup. Free rbf, kNN, etc..
          */
+        Lgm_RBF_Cache_Release( Info->RBF_Cache, Entry );
         LGM_ARRAY_1D_FREE( LookUpKey );
 
     } else {
@@ -1290,12 +1346,15 @@ int Lgm_B_FromScatteredData5( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
     double              *eps_x, *eps_y, *eps_z;
     Lgm_KdTreeData     *kNN;
     Lgm_Vec_RBF_Info   *rbf, *rbf_e;               // single structure.
+    Lgm_RBF_CacheEntry *Entry = NULL;              // if fits came from Info->RBF_Cache
     Lgm_Vector         *v_data, *B_data, *E_data, B1, B2;
     Lgm_Vector          b, Grad_B1, GradB_dipole; 
     unsigned long int  *I_data;
     unsigned long int  *LookUpKey;                // key comprised of an array of unsigned long int Id's
     int                 KeyLength;                // length (in bytes) of LookUpKey
     int                 (*Dipole)();              // tmp Pointer to Bfield function
+    int                 Reused;                   // the last kNN set (and its fits) was reused
+    double              q[3], r_K, r_K1;
 
 
     
@@ -1307,7 +1366,7 @@ int Lgm_B_FromScatteredData5( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
     if ( Lgm_Magnitude( v ) > 1.5 ) {
 
         /*
-         *  Allocate space for the K Nearest Neighbors.
+         *  Allocate space for the K Nearest Neighbors (plus one, see below).
          *  This is probably a bit wasteful...
          *  Should cache this array.
          */
@@ -1316,19 +1375,19 @@ int Lgm_B_FromScatteredData5( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *In
 
             if ( Info->KdTree_kNN_Alloced == 0 ) {
 
-                LGM_ARRAY_1D( Info->KdTree_kNN, K, Lgm_KdTreeData );
-                Info->KdTree_kNN_Alloced = K;
+                LGM_ARRAY_1D( Info->KdTree_kNN, K+1, Lgm_KdTreeData );
+                Info->KdTree_kNN_Alloced = K+1;
 
-            } else if ( K != Info->KdTree_kNN_Alloced ) {
+            } else if ( K+1 != Info->KdTree_kNN_Alloced ) {
 
                 /*
                  * kNN is allocated but K has changed. Realloc.
                  */
                 LGM_ARRAY_1D_FREE( Info->KdTree_kNN );
-                LGM_ARRAY_1D( Info->KdTree_kNN, K, Lgm_KdTreeData );
+                LGM_ARRAY_1D( Info->KdTree_kNN, K+1, Lgm_KdTreeData );
 
             }
-            Info->KdTree_kNN_Alloced = K;
+            Info->KdTree_kNN_Alloced = K+1;
 
         } else {
 
@@ -1349,57 +1408,110 @@ double GridRes = EstimateGridRes( v );
 
 
         /*
-         *  Find the K Nearest Neighbors.
+         *  Successive calls during a trace are usually only a small step
+         *  apart and would find the same K nearest neighbors. If we are still
+         *  inside the safe ball of the last search, reuse its set and fits
+         *  without touching the KdTree or the hash table.
          */
-        double q[3];
         q[0] = v->x; q[1] = v->y; q[2] = v->z;
-        Lgm_KdTree_kNN( q, 3, Info->KdTree, K, &Kgot, Info->KdTree_kNN_MaxDist2, Info->KdTree_kNN );
-        //printf("K, Kgot = %d %d    q = %g %g %g  Info->KdTree_kNN_MaxDist2 = %g GridRes = %g\n", K, Kgot, q[0], q[1], q[2], Info->KdTree_kNN_MaxDist2, GridRes );
+        Reused    = FALSE;
+        LookUpKey = NULL;
+        if ( Info->RBF_Last_Valid && ( Info->RBF_Last_K == K ) && ( Info->RBF_Last_MaxDist2 == Info->KdTree_kNN_MaxDist2 )
+                && ( Info->RBF_Last_KdTree == Info->KdTree ) && ( Info->RBF_Last_Cache == Info->RBF_Cache ) ) {
+            dx = q[0] - Info->RBF_Last_q[0];
+            dy = q[1] - Info->RBF_Last_q[1];
+            dz = q[2] - Info->RBF_Last_q[2];
+            Reused = ( dx*dx + dy*dy + dz*dz < Info->RBF_Last_Slack*Info->RBF_Last_Slack );
+        }
 
+        if ( Reused ) {
 
+            rbf   = Info->RBF_Last_rbf;
+            rbf_e = Info->RBF_Last_rbf_e;
+            Entry = Info->RBF_Last_Entry;
+            ++(Info->RBF_nReuses);
 
+        } else {
 
+            /*
+             *  Find the K Nearest Neighbors.
+             */
+            Lgm_KdTree_kNN( q, 3, Info->KdTree, K+1, &Kgot, Info->KdTree_kNN_MaxDist2, Info->KdTree_kNN );
+            //printf("K, Kgot = %d %d    q = %g %g %g  Info->KdTree_kNN_MaxDist2 = %g GridRes = %g\n", K, Kgot, q[0], q[1], q[2], Info->KdTree_kNN_MaxDist2, GridRes );
+
+            /*
+             *  The (K+1)-th neighbor is only used to see how far we can move
+             *  before the set of K nearest can change. Every one of the K is
+             *  within r_K of q and every other point is at least r_K1 away, so
+             *  from any point within (r_K1 - r_K)/2 of q the K nearest are the
+             *  same K points. If fewer than K+1 points were within MaxDist2 we
+             *  dont know how close the next one is, so nothing gets reused.
+             */
+            Info->RBF_Last_Slack = 0.0;
+            if ( Kgot > K ) {
+
+                // drop the farthest one (keeping the others in the order they came back in)
+                for ( j=0, i=1; i<Kgot; i++ ) if ( Info->KdTree_kNN[i].Dist2 > Info->KdTree_kNN[j].Dist2 ) j = i;
+                r_K1 = sqrt( Info->KdTree_kNN[j].Dist2 );
+                for ( i=j; i<K; i++ ) Info->KdTree_kNN[i] = Info->KdTree_kNN[i+1];
+                Kgot = K;
+
+                for ( d2 = 0.0, i=0; i<Kgot; i++ ) if ( Info->KdTree_kNN[i].Dist2 > d2 ) d2 = Info->KdTree_kNN[i].Dist2;
+                r_K = sqrt( d2 );
+                Info->RBF_Last_Slack = 0.5*(r_K1 - r_K) - 1e-12*r_K1; // (a little margin for roundoff)
 
-        // not needed? Put under verbosity setting?
-        for ( i=0; i<Kgot; i++ ) {
-            if ( Info->KdTree_kNN[i].Dist2 > Info->KdTree_kNN_MaxDist2){
-                printf("Lgm_B_FromScatteredData5(): ERROR - Info->KdTree_kNN[i].Dist2 = %g\n", Info->KdTree_kNN[i].Dist2);
             }
-        }
 
 
-        /*
-         *  From the K nearest neighbors, construct a key for the hash-table.
-         *  Probably should sort them so that different permutations of the same k
-         *  NN's will be identified as the same set. But lets worry about that
-         *  later.
-         *
-         */
-        LGM_ARRAY_1D( LookUpKey, Kgot, unsigned long int );
-        for ( i=0; i<Kgot; i++ ) LookUpKey[i] = Info->KdTree_kNN[i].Id;
-        KeyLength = Kgot*sizeof( unsigned long int );
-        QSORT( unsigned long int, LookUpKey, Kgot, int_lt );
-        //quicksort_uli( (long int)Kgot, LookUpKey-1 );
 
 
 
-        /*
-         *  Look up the key in the hash-table to see if its already there.
-         *  If it exists, we bypass refitting the RBF weights.
-         */
-        //printf("Searching for: " );
-        //for(i=0;i<Kgot; i++) printf(" %ld ", LookUpKey[i] );
-        //printf("    (KeyLength = %d)\n", KeyLength);
-        rbf   = NULL;
-        HASH_FIND( hh, Info->vec_rbf_ht,   LookUpKey, KeyLength, rbf );
-        ++(Info->RBF_nHashFinds);
+            // not needed? Put under verbosity setting?
+            for ( i=0; i<Kgot; i++ ) {
+                if ( Info->KdTree_kNN[i].Dist2 > Info->KdTree_kNN_MaxDist2){
+                    printf("Lgm_B_FromScatteredData5(): ERROR - Info->KdTree_kNN[i].Dist2 = %g\n", Info->KdTree_kNN[i].Dist2);
+                }
+            }
 
-        rbf_e = NULL;
-        HASH_FIND( hh, Info->vec_rbf_e_ht, LookUpKey, KeyLength, rbf_e );
-        ++(Info->RBF_nHashFinds);
+
+            /*
+             *  From the K nearest neighbors, construct a key for the hash-table.
+             *  Probably should sort them so that different permutations of the same k
+             *  NN's will be identified as the same set. But lets worry about that
+             *  later.
+             *
+             */
+            LGM_ARRAY_1D( LookUpKey, Kgot, unsigned long int );
+            for ( i=0; i<Kgot; i++ ) LookUpKey[i] = Info->KdTree_kNN[i].Id;
+            KeyLength = Kgot*sizeof( unsigned long int );
+            QSORT( unsigned long int, LookUpKey, Kgot, int_lt );
+            //quicksort_uli( (long int)Kgot, LookUpKey-1 );
 
 
 
+            /*
+             *  Look up the key in the hash-table to see if its already there.
+             *  If it exists, we bypass refitting the RBF weights.
+             */
+            //printf("Searching for: " );
+            //for(i=0;i<Kgot; i++) printf(" %ld ", LookUpKey[i] );
+            //printf("    (KeyLength = %d)\n", KeyLength);
+            rbf   = NULL;
+            rbf_e = NULL;
+            if ( Info->RBF_Cache ) {
+                Entry = Lgm_RBF_Cache_Get( Info->RBF_Cache, LookUpKey, Kgot );
+                if ( Entry ) { rbf = Entry->rbf; rbf_e = Entry->rbf_e; }
+                ++(Info->RBF_nHashFinds);
+            } else {
+                // the E fit hangs off the B one (they are one entry)
+                HASH_FIND( hh, Info->vec_rbf_ht, LookUpKey, KeyLength, rbf );
+                if ( rbf ) rbf_e = rbf->rbf_e;
+                ++(Info->RBF_nHashFinds);
+            }
+
+        }
+
+
 
         /*
          * If key didnt exist in hash-table, we need to compute RBF weights, package up info
@@ -1609,8 +1721,7 @@ ff = d2min_max[3];
 //    d2 = d2min[2][i]*8.0*8.0; if ( d2 < 64.0 ) d2 = 64.0; eps_z[i] = 1.0/d2;
 //}
 
-    rbf   = Lgm_Vec_RBF_Init( I_data, v_data2, B_data2, eps_x, eps_y, eps_z, n_data2, Info->RBF_DoPoly, Info->RBF_Type ); 
-    rbf_e = Lgm_Vec_RBF_Init( I_data, v_data2, E_data2, eps_x, eps_y, eps_z, n_data2, Info->RBF_DoPoly, Info->RBF_Type ); 
+    rbf = Lgm_Vec_RBF_Init2( I_data, v_data2, B_data2, E_data2, eps_x, eps_y, eps_z, n_data2, Info->RBF_DoPoly, Info->RBF_Type, &rbf_e ); 
 } else {
 
 
@@ -1623,9 +1734,11 @@ ff = d2min_max[3];
              *  table is done with. Note that the hash table will be the only
              *  reference to the pointer.  To free, use
              *  Lgm_B_FromScatteredData_TearDown().
+             *
+             *  B and E are fit together, so the RBF matrix is only filled in
+             *  and factored once.
              */
-            rbf   = Lgm_Vec_RBF_Init( I_data, v_data, B_data, eps_x, eps_y, eps_z, n_data, Info->RBF_DoPoly, Info->RBF_Type ); 
-            rbf_e = Lgm_Vec_RBF_Init( I_data, v_data, E_data, eps_x, eps_y, eps_z, n_data, Info->RBF_DoPoly, Info->RBF_Type ); 
+            rbf = Lgm_Vec_RBF_Init2( I_data, v_data, B_data, E_data, eps_x, eps_y, eps_z, n_data, Info->RBF_DoPoly, Info->RBF_Type, &rbf_e ); 
 }
 
 
@@ -1643,99 +1756,106 @@ LGM_ARRAY_1D_FREE( E_data2 );
 
 
 
-            //printf("Adding item to hash table\n");
-            HASH_ADD_KEYPTR( hh, Info->vec_rbf_ht,   rbf->LookUpKey, KeyLength, rbf );
-            HASH_ADD_KEYPTR( hh, Info->vec_rbf_e_ht, rbf->LookUpKey, KeyLength, rbf_e );
-            ++(Info->RBF_nHashAdds);
+            if ( Info->RBF_Cache ) {
 
-            //printf("Info->vec_rbf_ht_maxsize, Info->vec_rbf_ht_size = %g %g    nEntries = %ld\n", Info->vec_rbf_ht_maxsize, Info->vec_rbf_ht_size, Info->RBF_CB.nEntries );
+                // the shared cache does its own evictions
+                Entry = Lgm_RBF_Cache_Add( Info->RBF_Cache, rbf, rbf_e );
+                rbf   = Entry->rbf;
+                rbf_e = Entry->rbf_e;
+                ++(Info->RBF_nHashAdds);
 
-            int              oldest_i, newest_i;
-            double           size, size_e; // memory size in MB
-            Lgm_Vec_RBF_Info *oldest_rbf, *tmp_rbf;
-            Lgm_Vec_RBF_Info *oldest_rbf_e, *tmp_rbf_e;
+            } else {
 
-            /*
-             * Remove rbfs if addition of new ones would exceed memory threshold. Dont try to remove if there arent any there.
-             */
-            while ( ( (rbf->size + Info->vec_rbf_ht_size) > Info->vec_rbf_ht_maxsize ) && (Info->RBF_CB.nEntries > 0) ) {
-
-                // locate oldest entry
-                oldest_i     = Info->RBF_CB.oldest_i;
-                oldest_rbf   = Info->RBF_CB.Buf1[ oldest_i ];
-                oldest_rbf_e = Info->RBF_CB.Buf2[ oldest_i ];
-                if ( oldest_rbf != NULL ) {
-
-                    // there is something there, so delete it from HT
-                    // (there should always be something there)
-                    HASH_DELETE( hh, Info->vec_rbf_ht,   oldest_rbf   );
-                    HASH_DELETE( hh, Info->vec_rbf_e_ht, oldest_rbf_e );
-
-                    // find its size, free it and update Info->vec_rbf_ht_size
-                    size   = oldest_rbf->size;
-                    size_e = oldest_rbf->size;
-                    Lgm_Vec_RBF_Free( oldest_rbf );
-                    Lgm_Vec_RBF_Free( oldest_rbf_e );
-                    Info->RBF_CB.Buf1[ oldest_i ] = NULL;
-                    Info->RBF_CB.Buf2[ oldest_i ] = NULL;
-                    Info->vec_rbf_ht_size -= size;
-                    Info->vec_rbf_ht_size -= size_e;
-                    --Info->RBF_CB.nEntries;
-
-                    // oldest will now be next element in the buffer. "n-1" is the max index slot defined so far.
-                    ++oldest_i; if ( oldest_i > Info->RBF_CB.n-1 ) oldest_i = 0; // increment and wrap if necessary
-                    Info->RBF_CB.oldest_i = oldest_i;
+                //printf("Adding item to hash table\n");
+                rbf->rbf_e = rbf_e;
+                HASH_ADD_KEYPTR( hh, Info->vec_rbf_ht, rbf->LookUpKey, KeyLength, rbf );
+                ++(Info->RBF_nHashAdds);
+
+                //printf("Info->vec_rbf_ht_maxsize, Info->vec_rbf_ht_size = %g %g    nEntries = %ld\n", Info->vec_rbf_ht_maxsize, Info->vec_rbf_ht_size, Info->RBF_CB.nEntries );
+
+                int              oldest_i, newest_i;
+                double           size, size_e; // memory size in MB
+                Lgm_Vec_RBF_Info *oldest_rbf, *tmp_rbf;
+                Lgm_Vec_RBF_Info *oldest_rbf_e, *tmp_rbf_e;
+
+                /*
+                 * Remove rbfs if addition of new ones would exceed memory threshold. Dont try to remove if there arent any there.
+                 */
+                while ( ( (rbf->size + Info->vec_rbf_ht_size) > Info->vec_rbf_ht_maxsize ) && (Info->RBF_CB.nEntries > 0) ) {
+
+                    // locate oldest entry
+                    oldest_i     = Info->RBF_CB.oldest_i;
+                    oldest_rbf   = Info->RBF_CB.Buf1[ oldest_i ];
+                    oldest_rbf_e = Info->RBF_CB.Buf2[ oldest_i ];
+                    if ( oldest_rbf != NULL ) {
+
+                        // there is something there, so delete it from HT
+                        // (there should always be something there)
+                        HASH_DELETE( hh, Info->vec_rbf_ht, oldest_rbf );
+
+                        // find its size, free it and update Info->vec_rbf_ht_size
+                        size   = oldest_rbf->size;
+                        size_e = oldest_rbf_e->size;
+                        Lgm_Vec_RBF_Free( oldest_rbf );
+                        Lgm_Vec_RBF_Free( oldest_rbf_e );
+                        Info->RBF_CB.Buf1[ oldest_i ] = NULL;
+                        Info->RBF_CB.Buf2[ oldest_i ] = NULL;
+                        Info->vec_rbf_ht_size -= size;
+                        Info->vec_rbf_ht_size -= size_e;
+                        --Info->RBF_CB.nEntries;
+
+                        // oldest will now be next element in the buffer. "n-1" is the max index slot defined so far.
+                        ++oldest_i; if ( oldest_i > Info->RBF_CB.n-1 ) oldest_i = 0; // increment and wrap if necessary
+                        Info->RBF_CB.oldest_i = oldest_i;
+
+                    }
 
                 }
 
-            }
 
+                /*
+                 * We now have enough space to add the new entry. Add it to the index just "above" the newest.
+                 * "N-1" is the max index slot of the whole buf.
+                 */
+                newest_i = Info->RBF_CB.newest_i;
+                ++newest_i; if ( newest_i > Info->RBF_CB.N-1 ) newest_i = 0; // increment and wrap if necessary
+                tmp_rbf   = Info->RBF_CB.Buf1[ newest_i ];
+                tmp_rbf_e = Info->RBF_CB.Buf2[ newest_i ];
+
+                if ( tmp_rbf == NULL ) {
+                    //printf("appned...\n");
+                    // open slot -- just add it
+                    Info->RBF_CB.Buf1[ newest_i ] = rbf;
+                    Info->RBF_CB.Buf2[ newest_i ] = rbf_e;
+                    Info->RBF_CB.newest_i = newest_i;
+                    ++Info->RBF_CB.nEntries;
+                    if ( newest_i >= Info->RBF_CB.n ) Info->RBF_CB.n = newest_i+1;
+                    //printf("oldest_1, newest_i = %d %d\n", Info->RBF_CB.oldest_i, Info->RBF_CB.newest_i );
+                    //printf("\n\n");
+
+                } else {
+                    // occupied slot -- this must the oldest delete what's there first and then add it
+                    //printf("replace...\n");
+                    HASH_DELETE( hh, Info->vec_rbf_ht, tmp_rbf );
+                    Info->vec_rbf_ht_size -= tmp_rbf->size;
+                    Info->vec_rbf_ht_size -= tmp_rbf_e->size;
+                    Lgm_Vec_RBF_Free( tmp_rbf );
+                    Lgm_Vec_RBF_Free( tmp_rbf_e );
+
+                    Info->RBF_CB.Buf1[ newest_i ] = rbf;
+                    Info->RBF_CB.Buf2[ newest_i ] = rbf_e;
+                    Info->RBF_CB.newest_i = newest_i;
+
+                    oldest_i = newest_i+1; if ( oldest_i > Info->RBF_CB.N-1 ) oldest_i = 0;
+                    Info->RBF_CB.oldest_i = oldest_i;
+                    //printf("oldest_1, newest_i = %d %d\n", Info->RBF_CB.oldest_i, Info->RBF_CB.newest_i );
+                    //printf("\n\n");
+                }
 
-            /*
-             * We now have enough space to add the new entry. Add it to the index just "above" the newest.
-             * "N-1" is the max index slot of the whole buf.
-             */
-            newest_i = Info->RBF_CB.newest_i;
-            ++newest_i; if ( newest_i > Info->RBF_CB.N-1 ) newest_i = 0; // increment and wrap if necessary
-            tmp_rbf   = Info->RBF_CB.Buf1[ newest_i ];
-            tmp_rbf_e = Info->RBF_CB.Buf2[ newest_i ];
-
-            if ( tmp_rbf == NULL ) {
-                //printf("appned...\n");
-                // open slot -- just add it
-                Info->RBF_CB.Buf1[ newest_i ] = rbf;
-                Info->RBF_CB.Buf2[ newest_i ] = rbf_e;
-                Info->RBF_CB.newest_i = newest_i;
-                ++Info->RBF_CB.nEntries;
-                if ( newest_i >= Info->RBF_CB.n ) Info->RBF_CB.n = newest_i+1;
-                //printf("oldest_1, newest_i = %d %d\n", Info->RBF_CB.oldest_i, Info->RBF_CB.newest_i );
-                //printf("\n\n");
+                Info->vec_rbf_ht_size += rbf->size; // increment size
+                Info->vec_rbf_ht_size += rbf_e->size; // increment size
 
-            } else {
-                // occupied slot -- this must the oldest delete what's there first and then add it
-                //printf("replace...\n");
-                size = tmp_rbf->size;
-                HASH_DELETE( hh, Info->vec_rbf_ht, tmp_rbf );
-                Info->vec_rbf_ht_size -= size;
-                Lgm_Vec_RBF_Free( tmp_rbf );
-
-                size = tmp_rbf->size;
-                HASH_DELETE( hh, Info->vec_rbf_e_ht, tmp_rbf_e );
-                Info->vec_rbf_ht_size -= size;
-                Lgm_Vec_RBF_Free( tmp_rbf_e );
-
-                Info->RBF_CB.Buf1[ newest_i ] = rbf;
-                Info->RBF_CB.Buf2[ newest_i ] = rbf_e;
-                Info->RBF_CB.newest_i = newest_i;
-
-                oldest_i = newest_i+1; if ( oldest_i > Info->RBF_CB.N-1 ) oldest_i = 0;
-                Info->RBF_CB.oldest_i = oldest_i;
-                //printf("oldest_1, newest_i = %d %d\n", Info->RBF_CB.oldest_i, Info->RBF_CB.newest_i );
-                //printf("\n\n");
             }
-
-            Info->vec_rbf_ht_size += rbf->size; // increment size
-            Info->vec_rbf_ht_size += rbf_e->size; // increment size
             
 
 
@@ -1775,25 +1895,50 @@ LGM_ARRAY_1D_FREE( E_data2 );
 
 
         /*
-         *  Evaluate Divergence Free Interpolation
+         *  Remember this set (and its fits) for the next call. The cache
+         *  entry is held until the set is replaced, so it cant be freed from
+         *  under us. (Without RBF_Cache, fits are only evicted when new ones
+         *  are added, and that only happens when the set is replaced anyway.)
          */
-        Lgm_Vec_RBF_Eval( v, &B1, rbf );
-        Lgm_Vec_RBF_Eval( v, &Info->RBF_E, rbf_e );
-        //printf("Evaluating with rbf = %p rbf_e = %p  at v = %g %g %g   B1 = %g %g %g   E = %g %g %g\n\n\n", rbf, rbf_e, v->x, v->y, v->z, B1.x, B1.y, B1.z, Info->RBF_E.x, Info->RBF_E.y, Info->RBF_E.z );
+        if ( !Reused ) {
+            if ( Info->RBF_Last_Entry ) Lgm_RBF_Cache_Release( Info->RBF_Last_Cache, Info->RBF_Last_Entry );
+            Info->RBF_Last_Entry    = Entry;
+            Info->RBF_Last_rbf      = rbf;
+            Info->RBF_Last_rbf_e    = rbf_e;
+            Info->RBF_Last_Cache    = Info->RBF_Cache;
+            Info->RBF_Last_KdTree   = Info->KdTree;
+            Info->RBF_Last_K        = K;
+            Info->RBF_Last_MaxDist2 = Info->KdTree_kNN_MaxDist2;
+            Info->RBF_Last_q[0]     = q[0];
+            Info->RBF_Last_q[1]     = q[1];
+            Info->RBF_Last_q[2]     = q[2];
+            Info->RBF_Last_Valid    = ( Info->RBF_Last_Slack > 0.0 );
+        }
+
+
 
 
         /*
-         *  Evaluate derivatives of Divergence Free Interpolation 
-         *  put in the Info structure.
+         *  Evaluate Divergence Free Interpolation
+         */
+        LGM_STATS_START( tRBF );
+
+        /*
+         *  (B, E and their derivatives are done together. The derivatives
+         *  are put in the Info structure.)
          */
-            Lgm_Vec_RBF_Derivs_Eval( v, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf   );
-            Lgm_Vec_RBF_Derivs_Eval( v, &Info->RBF_dEdx, &Info->RBF_dEdy, &Info->RBF_dEdz, rbf_e );
+        Lgm_Vec_RBF_EvalAll( v, &B1, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz, rbf );
+        Lgm_Vec_RBF_EvalAll( v, &Info->RBF_E, &Info->RBF_dEdx, &Info->RBF_dEdy, &Info->RBF_dEdz, rbf_e );
+        //printf("Evaluating with rbf = %p rbf_e = %p  at v = %g %g %g   B1 = %g %g %g   E = %g %g %g\n\n\n", rbf, rbf_e, v->x, v->y, v->z, B1.x, B1.y, B1.z, Info->RBF_E.x, Info->RBF_E.y, Info->RBF_E.z );
+
         if ( Info->RBF_CompGradAndCurl ) {
         }
 
+        LGM_STATS_STOP( Info, RBF, tRBF );
+
 
         /*
-         *  Cleanup. Free rbf, kNN, etc..
+         *  Cleanup. (Entry is now held as the last set.)
          */
         LGM_ARRAY_1D_FREE( LookUpKey );
 
@@ -1985,31 +2130,92 @@ dBdz.z = Info->RBF_dBdz.z;
 
 
 /*
- * Input a point cloud (With data). Output a simplified cloud.
+ *  Small open addressing hash table keyed on packed voxel coordinates (used
+ *  by the point cloud routines below). Each coordinate gets
+ *  LGM_PC_VOXEL_BITS bits.
  */
-void SimplifyPointCloud( Lgm_Vector *v_data, Lgm_Vector *B_data, Lgm_Vector *E_data, int n_data,
-                            Lgm_Vector *v_data2, Lgm_Vector *B_data2, Lgm_Vector *E_data2, int *n_data2, double s2min_min, double R, double nR ) {
+#define LGM_PC_VOXEL_BITS   21
+#define LGM_PC_VOXEL_MAX    ( (1L<<LGM_PC_VOXEL_BITS) - 1 )
+#define LGM_PC_EMPTY        0xffffffffffffffffULL
+
+typedef struct PC_VoxelHash {
+    uint64_t    *Key;
+    long int    *Val;
+    long int    Mask;
+    long int    Alloced;
+} PC_VoxelHash;
+
+static inline uint64_t PC_VoxelKey( long int ix, long int iy, long int iz ) {
+    return( ((uint64_t)ix << (2*LGM_PC_VOXEL_BITS)) | ((uint64_t)iy << LGM_PC_VOXEL_BITS) | (uint64_t)iz );
+}
 
+static inline uint64_t PC_Mix( uint64_t k ) {
+    k ^= k >> 33; k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33; k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return( k );
+}
 
-    int         i, j, n2;
-    double      xsum, ysum, zsum, x, y, z, x2, y2, z2, r2, min, max;
-    double      u, v, w, u2, v2, w2, s2, s2min, ro, ri, ro2, ri2, rInc;
-    Lgm_Vector  c0;
+/*
+ *  Make the table empty, with room for at least n keys.
+ */
+static void PC_HashReset( PC_VoxelHash *h, long int n ) {
+    long int    Size, i;
+    for ( Size = 16; Size < 2*n; Size *= 2 );
+    if ( Size > h->Alloced ) {
+        free( h->Key ); free( h->Val );
+        h->Key = (uint64_t *)malloc( Size*sizeof(uint64_t) );
+        h->Val = (long int *)malloc( Size*sizeof(long int) );
+        h->Alloced = Size;
+    }
+    h->Mask = Size-1;
+    for ( i=0; i<Size; i++ ) h->Key[i] = LGM_PC_EMPTY;
+}
 
-    /*
-     * Compute centroid of point cloud.
-     */
 /*
-    xsum = ysum = zsum = 0.0;
-    for ( i=0; i<n_data; i++){
-        xsum += v_data[i].x;
-        ysum += v_data[i].y;
-        zsum += v_data[i].z;
+ *  Returns the value slot for Key (NULL if it isnt there). If Insert is set a
+ *  missing key is added with a value of -1.
+ */
+static inline long int *PC_HashSlot( PC_VoxelHash *h, uint64_t Key, int Insert ) {
+    long int    j = (long int)( PC_Mix( Key ) & (uint64_t)h->Mask );
+    while ( h->Key[j] != Key ) {
+        if ( h->Key[j] == LGM_PC_EMPTY ) {
+            if ( !Insert ) return( NULL );
+            h->Key[j] = Key; h->Val[j] = -1;
+            break;
+        }
+        j = (j+1) & h->Mask;
     }
-    c0.x = xsum/(double)n_data;
-    c0.y = ysum/(double)n_data;
-    c0.z = zsum/(double)n_data;
-*/
+    return( &h->Val[j] );
+}
+
+static void PC_HashFree( PC_VoxelHash *h ) {
+    free( h->Key ); free( h->Val );
+    h->Key = NULL; h->Val = NULL; h->Alloced = 0;
+}
+
+
+
+/*
+ * Input a point cloud (With data). Output a simplified cloud.
+ *
+ * Points are taken shell by shell (concentric spherical shells of width R/nR
+ * about the center of the bounding box, working outward), and a point is
+ * kept only if it is more than sqrt(s2min_min) away from all of the points
+ * kept so far. The kept points are held in a voxel hash (voxels at least
+ * sqrt(s2min_min) on a side), so each candidate only has to be checked
+ * against the kept points in the 27 voxels around it.
+ */
+void SimplifyPointCloud( Lgm_Vector *v_data, Lgm_Vector *B_data, Lgm_Vector *E_data, int n_data,
+                            Lgm_Vector *v_data2, Lgm_Vector *B_data2, Lgm_Vector *E_data2, int *n_data2, double s2min_min, double R, double nR ) {
+
+
+    int             i, j, k, n2, s, s0, nShells, *Shell, *Count, *Order, *Next, OK;
+    long int        ix, iy, iz, jx, jy, jz, *Head;
+    double          x, y, z, r2, min, max, ro, ri, rInc, c, ic, u, v, w, s2;
+    double          *ro2, *ri2;
+    Lgm_Vector      c0, Corner;
+    PC_VoxelHash    Hash = { NULL, NULL, 0, 0 };
 
 
     /*
@@ -2038,76 +2244,102 @@ void SimplifyPointCloud( Lgm_Vector *v_data, Lgm_Vector *B_data, Lgm_Vector *E_d
 
 
 
+    /*
+     * The shells (with their edges computed the same way as they always
+     * have been, so that points on the edges land in the same shell).
+     */
     rInc = R/(double)nR;
+    for ( nShells=0, ro = rInc; ro <= R; ro += rInc ) ++nShells;
+    *n_data2 = 0;
+    if ( (nShells == 0) || (n_data <= 0) ) return;
+    LGM_ARRAY_1D( ro2, nShells, double );
+    LGM_ARRAY_1D( ri2, nShells, double );
+    for ( s=0, ro = rInc; ro <= R; ro += rInc, s++ ) {
+        ri = ro - rInc;
+        ro2[s] = ro*ro; ri2[s] = ri*ri;
+    }
 
 
     /*
-     * Test point cloud simplification in areas where mesh changes resolution.
-     *
-     * Loop over concentric speherical shells and only add points in that are
-     * not too close to those that are already there. Start with largest shell
-     * and work your way in towards the centroid.
-     *
+     * Put each point in the first shell it falls in (-1 if none), and order
+     * the points by shell (keeping their order within a shell).
      */
-    n2 = 0;
-    //for ( ro = R; ro >= 0.0; ro -= rInc ){
-    for ( ro = rInc; ro <= R; ro += rInc ){
-
-        ro2 = ro*ro;
-
-        ri = ro - rInc;
-        ri2 = ri*ri;
-
-        for ( i=0; i<n_data; i++){
+    LGM_ARRAY_1D( Shell, n_data, int );
+    LGM_ARRAY_1D( Order, n_data, int );
+    LGM_ARRAY_1D( Count, nShells+1, int );
+    for ( i=0; i<n_data; i++){
+        x = v_data[i].x - c0.x; y = v_data[i].y - c0.y; z = v_data[i].z - c0.z;
+        r2 = x*x + y*y + z*z; // dist squared between centroid and current point
+        s0 = (int)( sqrt( r2 )/rInc ) - 2; if ( s0 < 0 ) s0 = 0;
+        for ( Shell[i] = -1, s=s0; (s<nShells) && (s<=s0+4); s++ ) {
+            if ( (r2 <= ro2[s]) && (r2 > ri2[s]) ) { Shell[i] = s; break; }
+        }
+        if ( Shell[i] >= 0 ) ++Count[ Shell[i]+1 ];
+    }
+    for ( s=0; s<nShells; s++ ) Count[s+1] += Count[s];
+    for ( i=0; i<n_data; i++) if ( Shell[i] >= 0 ) Order[ Count[ Shell[i] ]++ ] = i;
+    n2 = Count[nShells-1]; // number of points in any shell
 
-            x = v_data[i].x - c0.x; x2 = x*x;
-            y = v_data[i].y - c0.y; y2 = y*y;
-            z = v_data[i].z - c0.z; z2 = z*z;
-            r2 = x2 + y2 + z2; // dist squared between centroid and current point
 
-            if ( (r2 <= ro2) && (r2 > ri2) ) {
+    /*
+     * Voxels big enough that only the 27 around a point can hold kept points
+     * within sqrt(s2min_min) of it (and few enough to fit in the keys).
+     */
+    c = ( s2min_min > 0.0 ) ? sqrt( s2min_min ) : 0.0;
+    if ( c < 2.0*R/(double)(LGM_PC_VOXEL_MAX-3) ) c = 2.0*R/(double)(LGM_PC_VOXEL_MAX-3);
+    ic = 1.0/c;
+    Corner.x = c0.x - R; Corner.y = c0.y - R; Corner.z = c0.z - R;
+    PC_HashReset( &Hash, n2 );
+    LGM_ARRAY_1D( Next, n_data, int );
 
-                /*
-                 * it is a candidate for inclusion because it is  in the shell,
-                 * but check to see if its far enough away from all the other
-                 * points (if any) we have so far.
-                 */
-                s2min = 1e31;
-                for ( j=0; j<n2; j++ ) {
-                    u = v_data[i].x - v_data2[j].x; u2 = u*u;
-                    v = v_data[i].y - v_data2[j].y; v2 = v*v;
-                    w = v_data[i].z - v_data2[j].z; w2 = w*w;
-                    s2 = u2 + v2 + w2;
-                    if ( s2 < s2min ) s2min = s2;
-                }
 
-                if ( s2min > s2min_min ) {
-                    // add point to list.
-                    v_data2[n2].x = v_data[i].x;
-                    v_data2[n2].y = v_data[i].y;
-                    v_data2[n2].z = v_data[i].z;
-                    B_data2[n2].x = B_data[i].x;
-                    B_data2[n2].y = B_data[i].y;
-                    B_data2[n2].z = B_data[i].z;
-                    E_data2[n2].x = E_data[i].x;
-                    E_data2[n2].y = E_data[i].y;
-                    E_data2[n2].z = E_data[i].z;
-                    ++n2;
+    /*
+     * Loop over the candidates shell by shell, and only add points in that are
+     * not too close to those that are already there.
+     */
+    for ( k=0, n2=0; k<Count[nShells-1]; k++ ){
+
+        i = Order[k];
+        ix = (long int)( (v_data[i].x - Corner.x)*ic ) + 1;
+        iy = (long int)( (v_data[i].y - Corner.y)*ic ) + 1;
+        iz = (long int)( (v_data[i].z - Corner.z)*ic ) + 1;
+
+        for ( OK = TRUE, jx=ix-1; OK && (jx<=ix+1); jx++ ) {
+            for ( jy=iy-1; OK && (jy<=iy+1); jy++ ) {
+                for ( jz=iz-1; OK && (jz<=iz+1); jz++ ) {
+                    if ( (Head = PC_HashSlot( &Hash, PC_VoxelKey( jx, jy, jz ), FALSE )) == NULL ) continue;
+                    for ( j = (int)*Head; j >= 0; j = Next[j] ) {
+                        u = v_data[i].x - v_data2[j].x;
+                        v = v_data[i].y - v_data2[j].y;
+                        w = v_data[i].z - v_data2[j].z;
+                        s2 = u*u + v*v + w*w;
+                        if ( s2 <= s2min_min ) { OK = FALSE; break; }
+                    }
                 }
-
-
             }
+        }
 
-
+        if ( OK ) {
+            // add point to list.
+            v_data2[n2] = v_data[i];
+            B_data2[n2] = B_data[i];
+            E_data2[n2] = E_data[i];
+            Head = PC_HashSlot( &Hash, PC_VoxelKey( ix, iy, iz ), TRUE );
+            Next[n2] = (int)*Head; *Head = n2;
+            ++n2;
         }
 
     }
     *n_data2 = n2;
 
-    printf("\n\n\n-------------------------------------------\n");
-    for ( i=0; i<n_data; i++) printf("Original Point: %g %g %g\n", v_data[i].x, v_data[i].y, v_data[i].z);
-    printf("\n");
-    for ( i=0; i<*n_data2; i++) printf("Included Point: %g %g %g\n", v_data2[i].x, v_data2[i].y, v_data2[i].z);
+    PC_HashFree( &Hash );
+    LGM_ARRAY_1D_FREE( ro2 );
+    LGM_ARRAY_1D_FREE( ri2 );
+    LGM_ARRAY_1D_FREE( Shell );
+    LGM_ARRAY_1D_FREE( Order );
+    LGM_ARRAY_1D_FREE( Count );
+    LGM_ARRAY_1D_FREE( Next );
+
     printf("Original number of points: %d  Final number of points: %d\n\n\n", n_data, *n_data2 );
 
 }
@@ -2171,3 +2403,236 @@ double EstimateGridRes( Lgm_Vector *v ){
 
 
 
+
+
+#define LGM_PC_NBUCKETS     1024                    // Buckets the voxels are spread over in Lgm_PointCloud_VoxelSimplify()
+#define LGM_PC_NSAMPLE_BLK  65536                   // Samples per kNN batch in Lgm_PointCloud_GridRes()
+#define gr_lt(a,b) ((*a)<(*b))
+
+/**
+ *  \brief
+ *      Thin a (large) point cloud down to at most one point per voxel.
+ *
+ *  \details
+ *      Space is cut into cubic voxels of side h (aligned with the bounding
+ *      box of the points), and in each voxel that has points in it, the
+ *      point closest to the center of the voxel is kept (the lowest index
+ *      wins ties). This is meant for cutting an MHD mesh with 10^7 - 10^8
+ *      cells down before it goes into a KdTree (e.g. for
+ *      Lgm_B_FromScatteredData5()), where the mesh is much finer than
+ *      needed.
+ *
+ *      The voxels are hashed into buckets, and with OpenMP the points are
+ *      sorted into the buckets and the buckets are reduced in parallel. The
+ *      result does not depend on the number of threads.
+ *
+ *      \param[in]      u       Positions, in the same layout as Lgm_KdTree_Init() takes (u[d][i] is the dth component of the ith point).
+ *      \param[in]      n       Number of points.
+ *      \param[in]      h       Voxel size.
+ *      \param[out]     Keep    Indices of the points kept, in increasing order (room for n).
+ *
+ *      \return         The number of points kept, or -1 if h is too small for the extent of the points (more than 2^21 voxels along an axis).
+ *
+ */
+long int Lgm_PointCloud_VoxelSimplify( double **u, long int n, double h, long int *Keep ) {
+
+    long int        i, b, m, nThreads, *Start, nv[3], *Idx;
+    double          Min[3], Max[3], ih;
+    uint64_t        *Key;
+    unsigned char   *Flag;
+    int             d;
+
+    if ( n <= 0 ) return( 0 );
+    if ( h <= 0.0 ) {
+        fprintf( stderr, "Lgm_PointCloud_VoxelSimplify(): h must be > 0 (got %g).\n", h );
+        return( -1 );
+    }
+    ih = 1.0/h;
+
+    /*
+     * Bounding box and grid size
+     */
+    for ( d=0; d<3; d++ ) {
+        double lo = 1e31, hi = -1e31;
+#if USE_OPENMP
+        #pragma omp parallel for reduction(min:lo) reduction(max:hi)
+#endif
+        for ( i=0; i<n; i++ ) {
+            if ( u[d][i] < lo ) lo = u[d][i];
+            if ( u[d][i] > hi ) hi = u[d][i];
+        }
+        Min[d] = lo; Max[d] = hi;
+        nv[d] = (long int)( (Max[d]-Min[d])*ih ) + 1;
+        if ( nv[d] > LGM_PC_VOXEL_MAX ) {
+            fprintf( stderr, "Lgm_PointCloud_VoxelSimplify(): h = %g is too small for the extent of the points (%g to %g).\n", h, Min[d], Max[d] );
+            return( -1 );
+        }
+    }
+
+
+    /*
+     * Voxel of each point
+     */
+    LGM_ARRAY_1D( Key, n, uint64_t );
+    LGM_ARRAY_1D( Idx, n, long int );
+    LGM_ARRAY_1D( Flag, n, unsigned char );
+#if USE_OPENMP
+    #pragma omp parallel for
+#endif
+    for ( i=0; i<n; i++ ) {
+        Key[i] = PC_VoxelKey( (long int)( (u[0][i]-Min[0])*ih ), (long int)( (u[1][i]-Min[1])*ih ), (long int)( (u[2][i]-Min[2])*ih ) );
+    }
+
+
+    /*
+     * Sort the points into buckets by voxel (a counting sort -- each thread
+     * counts and then places its own contiguous range of points).
+     */
+#if USE_OPENMP
+    nThreads = omp_get_max_threads();
+#else
+    nThreads = 1;
+#endif
+    LGM_ARRAY_1D( Start, nThreads*LGM_PC_NBUCKETS+1, long int );
+#if USE_OPENMP
+    #pragma omp parallel num_threads(nThreads) private(i,b,d)
+#endif
+    {
+        long int    t = 0, T = 1, i0, i1, *Cnt;
+#if USE_OPENMP
+        t = omp_get_thread_num(); T = omp_get_num_threads();
+#endif
+        i0 = n*t/T; i1 = n*(t+1)/T;
+
+        // Start[b*T + t] counts thread t's points in bucket b
+        for ( i=i0; i<i1; i++ ) ++Start[ (long int)(PC_Mix( Key[i] ) >> 54)*T + t + 1 ];
+#if USE_OPENMP
+        #pragma omp barrier
+        #pragma omp single
+#endif
+        for ( b=0; b<T*LGM_PC_NBUCKETS; b++ ) Start[b+1] += Start[b];
+
+        Cnt = (long int *)malloc( LGM_PC_NBUCKETS*sizeof(long int) );
+        for ( b=0; b<LGM_PC_NBUCKETS; b++ ) Cnt[b] = Start[b*T + t];
+        for ( i=i0; i<i1; i++ ) Idx[ Cnt[ PC_Mix( Key[i] ) >> 54 ]++ ] = i;
+        free( Cnt );
+
+#if USE_OPENMP
+        #pragma omp barrier
+#endif
+
+        /*
+         * Reduce each bucket: the closest point to the voxel center wins.
+         */
+        PC_VoxelHash    Hash = { NULL, NULL, 0, 0 };
+        long int        j, k, *Best;
+        double          c, dx, dd, d2, d2b;
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic,4)
+#endif
+        for ( b=0; b<LGM_PC_NBUCKETS; b++ ) {
+            long int j0 = Start[b*T], j1 = Start[(b+1)*T];
+            if ( j1 == j0 ) continue;
+            PC_HashReset( &Hash, j1-j0 );
+            for ( j=j0; j<j1; j++ ) {
+                i = Idx[j];
+                Best = PC_HashSlot( &Hash, Key[i], TRUE );
+                if ( *Best < 0 ) { *Best = i; continue; }
+                for ( d2 = d2b = 0.0, d=0; d<3; d++ ) {
+                    c  = Min[d] + ( (long int)( (u[d][i]-Min[d])*ih ) + 0.5 )*h;
+                    dx = u[d][i] - c; dd = u[d][*Best] - c;
+                    d2 += dx*dx; d2b += dd*dd;
+                }
+                if ( (d2 < d2b) || ( (d2 == d2b) && (i < *Best) ) ) *Best = i;
+            }
+            for ( k=0; k<=Hash.Mask; k++ ) if ( Hash.Key[k] != LGM_PC_EMPTY ) Flag[ Hash.Val[k] ] = 1;
+        }
+        PC_HashFree( &Hash );
+    }
+
+    for ( m=0, i=0; i<n; i++ ) if ( Flag[i] ) Keep[m++] = i;
+
+    LGM_ARRAY_1D_FREE( Key );
+    LGM_ARRAY_1D_FREE( Idx );
+    LGM_ARRAY_1D_FREE( Flag );
+    LGM_ARRAY_1D_FREE( Start );
+
+    return( m );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Estimate the resolution of a point cloud from the distances between nearest neighbors.
+ *
+ *  \details
+ *      nSamples points, evenly spread through the index range, are looked up
+ *      in the KdTree (with Lgm_KdTree_kNN_Batch(), so the lookups are
+ *      spread over threads), and the given quantile of the distances to
+ *      their nearest (distinct) neighbors is returned. Quantile = 0.5 gives
+ *      the median spacing, a small Quantile the spacing of the finest part
+ *      of the mesh. The result does not depend on the number of threads.
+ *
+ *      \param[in]      KdTree      KdTree made from the points (with Lgm_KdTree_Init()).
+ *      \param[in]      u           Positions, as given to Lgm_KdTree_Init().
+ *      \param[in]      n           Number of points.
+ *      \param[in]      nSamples    Number of points to sample (<= 0 or more than n means use them all).
+ *      \param[in]      Quantile    Quantile (0 to 1) of the distances to return.
+ *
+ *      \return         The estimated resolution, or -1.0 if it couldnt be estimated.
+ *
+ */
+double Lgm_PointCloud_GridRes( Lgm_KdTree *KdTree, double **u, long int n, long int nSamples, double Quantile ) {
+
+    long int        s, s0, ns, m, i, d;
+    int             K = 8, *Kgot, k;
+    double          *Q[3], *Dist, Res;
+    Lgm_KdTreeData  *kNN;
+
+    if ( (n < 2) || (KdTree == NULL) ) return( -1.0 );
+    if ( (nSamples <= 0) || (nSamples > n) ) nSamples = n;
+    if ( Quantile < 0.0 ) Quantile = 0.0;
+    if ( Quantile > 1.0 ) Quantile = 1.0;
+    if ( n < K ) K = (int)n;
+
+    ns = ( nSamples < LGM_PC_NSAMPLE_BLK ) ? nSamples : LGM_PC_NSAMPLE_BLK;
+    for ( d=0; d<3; d++ ) LGM_ARRAY_1D( Q[d], ns, double );
+    LGM_ARRAY_1D( Kgot, ns, int );
+    LGM_ARRAY_1D( kNN, ns*K, Lgm_KdTreeData );
+    LGM_ARRAY_1D( Dist, nSamples, double );
+
+    /*
+     * Nearest neighbor distances, a block of samples at a time. (The first
+     * NN is the point itself, or a duplicate of it.)
+     */
+    for ( m=0, s0=0; s0<nSamples; s0 += ns ) {
+        if ( ns > nSamples-s0 ) ns = nSamples-s0;
+        for ( s=0; s<ns; s++ ) {
+            i = (long int)( (double)(s0+s)*(double)n/(double)nSamples );
+            for ( d=0; d<3; d++ ) Q[d][s] = u[d][i];
+        }
+        if ( Lgm_KdTree_kNN_Batch( KdTree, ns, Q, K, 1e31, Kgot, kNN ) < 0 ) break;
+        for ( s=0; s<ns; s++ ) {
+            for ( k=0; k<Kgot[s]; k++ ) {
+                if ( kNN[s*K+k].Dist2 > 0.0 ) { Dist[m++] = sqrt( kNN[s*K+k].Dist2 ); break; }
+            }
+        }
+    }
+
+    if ( m > 0 ) {
+        QSORT( double, Dist, m, gr_lt );
+        Res = Dist[ (long int)( Quantile*(m-1) + 0.5 ) ];
+    } else {
+        Res = -1.0;
+    }
+
+    for ( d=0; d<3; d++ ) LGM_ARRAY_1D_FREE( Q[d] );
+    LGM_ARRAY_1D_FREE( Kgot );
+    LGM_ARRAY_1D_FREE( kNN );
+    LGM_ARRAY_1D_FREE( Dist );
+
+    return( Res );
+
+}
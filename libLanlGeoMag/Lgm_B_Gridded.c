@@ -0,0 +1,920 @@
+/*! \file Lgm_B_Gridded.c
+ *
+ *  \brief Gridded "field cache" model (LGM_EXTMODEL_GRIDDED).
+ *
+ *  For a fixed snapshot (time, Kp, solar wind inputs, etc.) the external
+ *  models are smooth over the inner magnetosphere, yet tracing routines (e.g.
+ *  drift shell tracing for L*) re-evaluate them from scratch at every step,
+ *  sweeping through the same volume many hundreds of times. Here we sample
+ *  an existing field model on a uniform 3D grid once, and then answer field
+ *  requests with tricubic (Catmull-Rom, i.e. cubic Hermite with centered
+ *  difference slopes) interpolation.
+ *
+ *  What gets put on the grid is the model field minus the centered dipole
+ *  (i.e. B_model - B_cdip) and the dipole is added back analytically. This
+ *  takes out the 1/r^3 behaviour, which would otherwise dominate the
+ *  interpolation error close to the Earth, but still leaves the (expensive)
+ *  non-dipole part of IGRF on the grid along with the external field. Close
+ *  to the Earth, where the higher order IGRF terms are not smooth on the
+ *  scale of the grid, the cells fail the error check and get answered by the
+ *  analytic model.
+ *
+ *  The grid is built with Lgm_B_Gridded_Build(). Starting from spacing h0, the
+ *  interpolant is checked against the model at a couple of points inside
+ *  every cell, and the grid is refined by
+ *  factors of two for as long as that is paying off. Cells that still do not
+ *  meet the bound (e.g. cells that straddle the magnetopause, or whose stencil
+ *  reaches the singularity at the center of the Earth) are flagged and points
+ *  in them are answered by the analytic model, as are points outside the grid
+ *  and points requested at a different time (or with different model inputs,
+ *  see Lgm_ModelParamsHash()) than the one the grid was built for.
+ *
+ *  Once built, a Lgm_GriddedField is read-only and can be shared by any
+ *  number of Lgm_MagModelInfo structures (and threads). Lgm_CopyMagInfo()
+ *  copies the pointer, not the grid. With Lgm_SetShmCache( TRUE ) grids are
+ *  also shared between processes: a grid built by one process is found by
+ *  the others in shared memory and used from there (see Lgm_ShmCache.c).
+ *
+ *  Usage:
+ *
+ *      Lgm_Set_Coord_Transforms( Date, UTC, mInfo->c );
+ *      Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, LGM_EXTMODEL_T89, mInfo );
+ *      G = Lgm_B_Gridded_Build( Lgm_B_T89, -12.0, 12.0, -12.0, 12.0, -12.0, 12.0, 0.5, 0.25, 1.0, mInfo );
+ *      Lgm_MagModelInfo_Set_Gridded( G, mInfo ); // also sets mInfo->Bfield = Lgm_B_Gridded
+ *      ...
+ *      Lgm_FreeGriddedField( G );
+ *
+ */
+#include <config.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_QinDenton.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+#include "Lgm/Lgm_ShmCache.h"
+
+
+
+/*
+ *  Index of node (i,j,k) and cell (i,j,k).
+ */
+#define LGM_GRID_NODE( G, i, j, k )  ( ((long int)(k)*(G)->ny + (j))*(G)->nx + (i) )
+#define LGM_GRID_CELL( G, i, j, k )  ( ((long int)(k)*(G)->ncy + (j))*(G)->ncx + (i) )
+
+
+
+/*
+ *  Compute the residual field (B_src - B_cdip) at n points.
+ */
+static void Lgm_B_Gridded_Residual( long int n, double *x, double *y, double *z, double *bx, double *by, double *bz,
+                                    double *ix, double *iy, double *iz, Lgm_GriddedField *G, Lgm_MagModelInfo *Info ) {
+
+    long int            i;
+    int                 (*Bfield_save)();
+    Lgm_BfieldBatchFunc BfieldBatch_save;
+    int                 InternalModel_save;
+
+    /*
+     *  Temporarily point Info at the source model so that we can use the
+     *  batched kernels.
+     */
+    Bfield_save        = Info->Bfield;
+    BfieldBatch_save   = Info->BfieldBatch;
+    InternalModel_save = Info->InternalModel;
+    Info->Bfield        = G->Bsrc;
+    Info->BfieldBatch   = NULL;
+    Info->InternalModel = G->InternalModel;
+
+    Lgm_B_Batch( n, x, y, z, bx, by, bz, Info );
+
+    Lgm_B_cdip_Batch( n, x, y, z, ix, iy, iz, Info );
+
+    for ( i=0; i<n; ++i ) {
+        bx[i] -= ix[i];
+        by[i] -= iy[i];
+        bz[i] -= iz[i];
+    }
+
+    Info->Bfield        = Bfield_save;
+    Info->BfieldBatch   = BfieldBatch_save;
+    Info->InternalModel = InternalModel_save;
+
+}
+
+
+
+/*
+ *  Catmull-Rom weights for fractional position t in [0,1].
+ */
+static inline void Lgm_B_Gridded_Weights( double t, double *w ) {
+    double t2 = t*t;
+    w[0] = 0.5*t*( (2.0-t)*t - 1.0 );
+    w[1] = 0.5*( t2*(3.0*t - 5.0) + 2.0 );
+    w[2] = 0.5*t*( (4.0-3.0*t)*t + 1.0 );
+    w[3] = 0.5*(t-1.0)*t2;
+}
+
+
+
+/*
+ *  Locate the cell containing (x,y,z) and return the fractional positions
+ *  within it. Returns FALSE if the point is outside of the gridded box.
+ */
+static inline int Lgm_B_Gridded_Locate( double x, double y, double z, Lgm_GriddedField *G,
+                                        int *ci, int *cj, int *ck, double *tx, double *ty, double *tz ) {
+
+    double  fx, fy, fz;
+
+    fx = (x - G->xmin)*G->ih;
+    fy = (y - G->ymin)*G->ih;
+    fz = (z - G->zmin)*G->ih;
+    if ( (fx < 0.0) || (fy < 0.0) || (fz < 0.0) ) return( FALSE );
+    if ( (fx > (double)G->ncx) || (fy > (double)G->ncy) || (fz > (double)G->ncz) ) return( FALSE );
+
+    *ci = (int)fx; if ( *ci == G->ncx ) --(*ci);
+    *cj = (int)fy; if ( *cj == G->ncy ) --(*cj);
+    *ck = (int)fz; if ( *ck == G->ncz ) --(*ck);
+
+    *tx = fx - *ci;
+    *ty = fy - *cj;
+    *tz = fz - *ck;
+
+    return( TRUE );
+
+}
+
+
+
+/*
+ *  Tricubic interpolation of the residual in cell (ci,cj,ck). The 4x4x4
+ *  stencil is made up of nodes ci..ci+3, etc. (The node grid has an extra
+ *  layer of nodes all around the box so this never runs off the end.)
+ */
+static void Lgm_B_Gridded_Interp( int ci, int cj, int ck, double tx, double ty, double tz, Lgm_GriddedField *G, Lgm_Vector *B ) {
+
+    int         i, j, k;
+    long int    n;
+    double      wx[4], wy[4], wz[4], w, wjk;
+    double      bx, by, bz;
+    double      *R;
+
+    Lgm_B_Gridded_Weights( tx, wx );
+    Lgm_B_Gridded_Weights( ty, wy );
+    Lgm_B_Gridded_Weights( tz, wz );
+
+    bx = by = bz = 0.0;
+    for ( k=0; k<4; ++k ) {
+        for ( j=0; j<4; ++j ) {
+            wjk = wz[k]*wy[j];
+            n = LGM_GRID_NODE( G, ci, cj+j, ck+k );
+            R = &G->R[3*n];
+            for ( i=0; i<4; ++i ) {
+                w   = wjk*wx[i];
+                bx += w*R[3*i];
+                by += w*R[3*i+1];
+                bz += w*R[3*i+2];
+            }
+        }
+    }
+
+    B->x = bx; B->y = by; B->z = bz;
+
+}
+
+
+
+/*
+ *  Fill all nodes of G with the residual field. If Old is non-NULL, it is a
+ *  grid with twice the spacing (aligned with G) and its nodes are re-used.
+ */
+static void Lgm_B_Gridded_FillNodes( Lgm_GriddedField *G, Lgm_GriddedField *Old, Lgm_MagModelInfo *Info ) {
+
+    int         i, j, k, io, jo, ko, Reuse;
+    long int    n, no, m;
+    double      *x, *y, *z, *bx, *by, *bz, *ix, *iy, *iz;
+
+    LGM_ARRAY_1D( x,  G->nx, double ); LGM_ARRAY_1D( y,  G->nx, double ); LGM_ARRAY_1D( z,  G->nx, double );
+    LGM_ARRAY_1D( bx, G->nx, double ); LGM_ARRAY_1D( by, G->nx, double ); LGM_ARRAY_1D( bz, G->nx, double );
+    LGM_ARRAY_1D( ix, G->nx, double ); LGM_ARRAY_1D( iy, G->nx, double ); LGM_ARRAY_1D( iz, G->nx, double );
+
+    for ( k=0; k<G->nz; ++k ) {
+        for ( j=0; j<G->ny; ++j ) {
+
+            /*
+             *  Node i of the new grid coincides with node (i+1)/2 of the old
+             *  one when i is odd (see Lgm_B_Gridded_Build()).
+             */
+            jo = (j+1)/2; ko = (k+1)/2;
+            Reuse = ( Old != NULL ) && (j%2) && (k%2) && (jo < Old->ny) && (ko < Old->nz);
+
+            for ( m=0, i=0; i<G->nx; ++i ) {
+                io = (i+1)/2;
+                n  = LGM_GRID_NODE( G, i, j, k );
+                if ( Reuse && (i%2) && (io < Old->nx) ) {
+                    no = LGM_GRID_NODE( Old, io, jo, ko );
+                    G->R[3*n]   = Old->R[3*no];
+                    G->R[3*n+1] = Old->R[3*no+1];
+                    G->R[3*n+2] = Old->R[3*no+2];
+                } else {
+                    x[m] = G->xmin + (i-1)*G->h;
+                    y[m] = G->ymin + (j-1)*G->h;
+                    z[m] = G->zmin + (k-1)*G->h;
+                    ++m;
+                }
+            }
+
+            if ( m > 0 ) {
+                Lgm_B_Gridded_Residual( m, x, y, z, bx, by, bz, ix, iy, iz, G, Info );
+                for ( m=0, i=0; i<G->nx; ++i ) {
+                    io = (i+1)/2;
+                    if ( Reuse && (i%2) && (io < Old->nx) ) continue;
+                    n = LGM_GRID_NODE( G, i, j, k );
+                    if ( x[m]*x[m] + y[m]*y[m] + z[m]*z[m] < LGM_GRIDDED_RMIN*LGM_GRIDDED_RMIN ) {
+                        /*
+                         *  Too close to the dipole singularity for B-Bcdip to
+                         *  mean anything. The NaN gets any cell that uses this
+                         *  node flagged as bad in Lgm_B_Gridded_CheckCells().
+                         */
+                        G->R[3*n] = G->R[3*n+1] = G->R[3*n+2] = NAN;
+                    } else {
+                        G->R[3*n]   = bx[m];
+                        G->R[3*n+1] = by[m];
+                        G->R[3*n+2] = bz[m];
+                    }
+                    ++m;
+                }
+            }
+
+        }
+    }
+
+    LGM_ARRAY_1D_FREE( x );  LGM_ARRAY_1D_FREE( y );  LGM_ARRAY_1D_FREE( z );
+    LGM_ARRAY_1D_FREE( bx ); LGM_ARRAY_1D_FREE( by ); LGM_ARRAY_1D_FREE( bz );
+    LGM_ARRAY_1D_FREE( ix ); LGM_ARRAY_1D_FREE( iy ); LGM_ARRAY_1D_FREE( iz );
+
+}
+
+
+
+/*
+ *  Points (in fractional cell coords) at which the interpolant is checked.
+ *  Note that the cell center is a poor choice; there the Catmull-Rom weights
+ *  reduce to 4-point Lagrange weights, which are more accurate than the
+ *  interpolant is elsewhere in the cell.
+ */
+#define LGM_GRIDDED_NCHECK  2
+static const double Lgm_B_Gridded_CheckPnts[LGM_GRIDDED_NCHECK][3] = { { 0.25, 0.25, 0.25 }, { 0.75, 0.75, 0.75 } };
+
+/*
+ *  Check the interpolant against the model in every cell. Flags cells that do
+ *  not meet the error bound (in Bad) and returns the number of them. nSing is
+ *  the number of those that are bad only because their stencil has singular
+ *  nodes. If G1 is non-NULL (a grid with the same layout), the interpolant
+ *  checked is the average of G's and G1's (see Lgm_B_GriddedSeries_Set()).
+ */
+static long int Lgm_B_Gridded_CheckCells( Lgm_GriddedField *G, Lgm_GriddedField *G1, unsigned char *Bad, double *MaxErr, long int *nSing, Lgm_MagModelInfo *Info ) {
+
+    int         i, j, k, p;
+    long int    nBad, n;
+    double      *x, *y, *z, *bx, *by, *bz, *ix, *iy, *iz, *Err, dx, dy, dz, d;
+    const double *t;
+    Lgm_Vector  Bi, Bi1;
+
+    LGM_ARRAY_1D( x,  G->ncx, double ); LGM_ARRAY_1D( y,  G->ncx, double ); LGM_ARRAY_1D( z,  G->ncx, double );
+    LGM_ARRAY_1D( bx, G->ncx, double ); LGM_ARRAY_1D( by, G->ncx, double ); LGM_ARRAY_1D( bz, G->ncx, double );
+    LGM_ARRAY_1D( ix, G->ncx, double ); LGM_ARRAY_1D( iy, G->ncx, double ); LGM_ARRAY_1D( iz, G->ncx, double );
+    LGM_ARRAY_1D( Err, G->ncx, double );
+
+    *MaxErr = 0.0;
+    nBad   = 0;
+    *nSing = 0;
+    for ( k=0; k<G->ncz; ++k ) {
+        for ( j=0; j<G->ncy; ++j ) {
+
+            for ( i=0; i<G->ncx; ++i ) Err[i] = 0.0;
+
+            for ( p=0; p<LGM_GRIDDED_NCHECK; ++p ) {
+
+                t = Lgm_B_Gridded_CheckPnts[p];
+                for ( i=0; i<G->ncx; ++i ) {
+                    x[i] = G->xmin + (i+t[0])*G->h;
+                    y[i] = G->ymin + (j+t[1])*G->h;
+                    z[i] = G->zmin + (k+t[2])*G->h;
+                }
+                Lgm_B_Gridded_Residual( G->ncx, x, y, z, bx, by, bz, ix, iy, iz, G, Info );
+
+                for ( i=0; i<G->ncx; ++i ) {
+                    Lgm_B_Gridded_Interp( i, j, k, t[0], t[1], t[2], G, &Bi );
+                    if ( G1 != NULL ) {
+                        Lgm_B_Gridded_Interp( i, j, k, t[0], t[1], t[2], G1, &Bi1 );
+                        Bi.x = 0.5*(Bi.x + Bi1.x); Bi.y = 0.5*(Bi.y + Bi1.y); Bi.z = 0.5*(Bi.z + Bi1.z);
+                    }
+                    dx = Bi.x - bx[i]; dy = Bi.y - by[i]; dz = Bi.z - bz[i];
+                    d  = sqrt( dx*dx + dy*dy + dz*dz );
+                    if ( isnan( d ) || ( d > Err[i] ) ) Err[i] = d;
+                }
+
+            }
+
+            for ( i=0; i<G->ncx; ++i ) {
+                n = LGM_GRID_CELL( G, i, j, k );
+                if ( !( Err[i] <= 0.5*G->MaxErr ) ) { // factor of 2 safety margin. Also catches NaNs.
+                    Bad[n] = 1;
+                    ++nBad;
+                    if ( isnan( Err[i] ) ) ++(*nSing);
+                } else {
+                    Bad[n] = 0;
+                    if ( Err[i] > *MaxErr ) *MaxErr = Err[i];
+                }
+            }
+
+        }
+    }
+
+    LGM_ARRAY_1D_FREE( x );  LGM_ARRAY_1D_FREE( y );  LGM_ARRAY_1D_FREE( z );
+    LGM_ARRAY_1D_FREE( bx ); LGM_ARRAY_1D_FREE( by ); LGM_ARRAY_1D_FREE( bz );
+    LGM_ARRAY_1D_FREE( ix ); LGM_ARRAY_1D_FREE( iy ); LGM_ARRAY_1D_FREE( iz );
+    LGM_ARRAY_1D_FREE( Err );
+
+    return( nBad );
+
+}
+
+
+
+/*
+ *  Allocate a grid with spacing h and ncx x ncy x ncz cells.
+ */
+static Lgm_GriddedField *Lgm_B_Gridded_Alloc( double h, int ncx, int ncy, int ncz ) {
+
+    Lgm_GriddedField *G;
+
+    G = (Lgm_GriddedField *)calloc( 1, sizeof(Lgm_GriddedField) );
+    G->h   = h;
+    G->ih  = 1.0/h;
+    G->ncx = ncx;  G->ncy = ncy;  G->ncz = ncz;
+    G->nx  = ncx+3; G->ny = ncy+3; G->nz = ncz+3;
+    G->R   = (double *)calloc( 3*(long int)G->nx*G->ny*G->nz, sizeof(double) );
+    G->Bad = (unsigned char *)calloc( (long int)ncx*ncy*ncz, sizeof(unsigned char) );
+
+    if ( (G->R == NULL) || (G->Bad == NULL) ) {
+        Lgm_FreeGriddedField( G );
+        return( (Lgm_GriddedField *)NULL );
+    }
+
+    return( G );
+
+}
+
+
+
+
+/*
+ *  Shared memory copies of grids (see Lgm_ShmCache.c). A segment is the
+ *  Lgm_GriddedField followed by R and Bad. The key is made from the model
+ *  fingerprint, the time and the grid parameters p[]; it is 0 (dont share)
+ *  if the cache is off or the model has no fingerprint.
+ */
+static unsigned long Lgm_B_Gridded_ShmKey( int (*Bsrc)(), double *p, int n, Lgm_MagModelInfo *Info ) {
+
+    unsigned long   Key;
+    long int        Date = Info->c->UTC.Date, MaxNodes = LGM_GRIDDED_MAX_NODES;
+    double          UTC = Info->c->UTC.Time, RMin = LGM_GRIDDED_RMIN;
+
+    if ( !Lgm_GetShmCache() || !(Key = Lgm_ModelFingerprint( Bsrc, Info )) ) return( 0 );
+    Key = Lgm_ShmCache_Key( Key, &Date, sizeof(Date) );
+    Key = Lgm_ShmCache_Key( Key, &UTC, sizeof(UTC) );
+    Key = Lgm_ShmCache_Key( Key, &MaxNodes, sizeof(MaxNodes) );
+    Key = Lgm_ShmCache_Key( Key, &RMin, sizeof(RMin) );
+    Key = Lgm_ShmCache_Key( Key, p, n*sizeof(double) );
+
+    return( Key ? Key : 1 );
+
+}
+
+static Lgm_GriddedField *Lgm_B_Gridded_FromShm( unsigned long Key, int (*Bsrc)(), Lgm_MagModelInfo *Info ) {
+
+    Lgm_GriddedField    *G;
+    void                *p;
+    size_t              Size;
+    long int            nNodes, nCells;
+
+    if ( !Key || ( (p = Lgm_ShmCache_Find( LGM_SHM_GRIDDED, Key, &Size )) == NULL ) ) return( (Lgm_GriddedField *)NULL );
+
+    G = (Lgm_GriddedField *)calloc( 1, sizeof(Lgm_GriddedField) );
+    memcpy( G, p, sizeof(Lgm_GriddedField) );
+    nNodes = (long int)G->nx*G->ny*G->nz;
+    nCells = (long int)G->ncx*G->ncy*G->ncz;
+    if ( Size != sizeof(Lgm_GriddedField) + 3*nNodes*sizeof(double) + nCells ) {
+        Lgm_ShmCache_Release( p );
+        free( G );
+        return( (Lgm_GriddedField *)NULL );
+    }
+    G->Shm = p;
+    G->R   = (double *)( (char *)p + sizeof(Lgm_GriddedField) );
+    G->Bad = (unsigned char *)( G->R + 3*nNodes );
+
+    // these are addresses, so they are only good in the process that made the grid
+    G->Bsrc       = Bsrc;
+    G->ParamsHash = Lgm_ModelParamsHash( Bsrc, Info );
+
+    if ( Info->VerbosityLevel > 1 ) {
+        printf("Lgm_B_Gridded_Build: using shared grid (h = %g Re, %d x %d x %d cells, %ld bad)\n", G->h, G->ncx, G->ncy, G->ncz, G->nBad );
+    }
+
+    return( G );
+
+}
+
+static void Lgm_B_Gridded_ToShm( unsigned long Key, Lgm_GriddedField *G ) {
+
+    char        *b;
+    void        *p;
+    size_t      Size, nR;
+    long int    nCells;
+
+    if ( !Key || ( G == NULL ) || ( G->Shm != NULL ) ) return;
+
+    nR     = 3*(size_t)G->nx*G->ny*G->nz*sizeof(double);
+    nCells = (long int)G->ncx*G->ncy*G->ncz;
+    Size   = sizeof(Lgm_GriddedField) + nR + nCells;
+    if ( (b = (char *)malloc( Size )) == NULL ) return;
+    memcpy( b, G, sizeof(Lgm_GriddedField) );
+    memcpy( b + sizeof(Lgm_GriddedField), G->R, nR );
+    memcpy( b + sizeof(Lgm_GriddedField) + nR, G->Bad, nCells );
+    p = Lgm_ShmCache_Publish( LGM_SHM_GRIDDED, Key, b, Size );
+    free( b );
+
+    if ( p != NULL ) {
+        // use the shared copy from now on
+        free( G->R );
+        free( G->Bad );
+        G->Shm = p;
+        G->R   = (double *)( (char *)p + sizeof(Lgm_GriddedField) );
+        G->Bad = (unsigned char *)p + sizeof(Lgm_GriddedField) + nR;
+    }
+
+}
+
+
+/*
+ *  Set the box, source model and snapshot of G (whose cells are already
+ *  allocated).
+ */
+static void Lgm_B_Gridded_SetHeader( Lgm_GriddedField *G, int (*Bsrc)(), double xmin, double ymin, double zmin, double MaxErr, Lgm_MagModelInfo *Info ) {
+
+    G->xmin = xmin; G->ymin = ymin; G->zmin = zmin;
+    G->xmax = xmin + G->ncx*G->h;
+    G->ymax = ymin + G->ncy*G->h;
+    G->zmax = zmin + G->ncz*G->h;
+    G->Bsrc          = Bsrc;
+    G->InternalModel = Info->InternalModel;
+    G->MaxErr        = MaxErr;
+    G->Date          = Info->c->UTC.Date;
+    G->UTC           = Info->c->UTC.Time;
+    G->ParamsHash    = Lgm_ModelParamsHash( Bsrc, Info );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Build a gridded field cache of a B-field model for the current snapshot.
+ *
+ *  \details
+ *      The grid covers the box [xmin,xmax]x[ymin,ymax]x[zmin,zmax] (GSM, Re).
+ *      The box is expanded slightly (if needed) so that it is an integral
+ *      number of cells of size h0 on a side. The grid is refined (h -> h/2)
+ *      until all cells meet the error bound, until refinement stops reducing
+ *      the volume of cells that dont, or until h would drop below hmin or the
+ *      grid would have more than LGM_GRIDDED_MAX_NODES nodes. The time,
+ *      model parameters, etc. are all taken from Info as it is when this
+ *      routine is called.
+ *
+ *      \param[in]      Bsrc        Source field model (e.g. Lgm_B_T89). Must include the internal field, as all the Lgm_B_* models do.
+ *      \param[in]      xmin        Minimum GSM X of box (Re).
+ *      \param[in]      xmax        Maximum GSM X of box (Re).
+ *      \param[in]      ymin        Minimum GSM Y of box (Re).
+ *      \param[in]      ymax        Maximum GSM Y of box (Re).
+ *      \param[in]      zmin        Minimum GSM Z of box (Re).
+ *      \param[in]      zmax        Maximum GSM Z of box (Re).
+ *      \param[in]      h0          Initial grid spacing (Re).
+ *      \param[in]      hmin        Smallest grid spacing to refine to (Re).
+ *      \param[in]      MaxErr      Error bound (nT) on the interpolated field.
+ *      \param[in,out]  Info        Lgm_MagModelInfo structure (defines the snapshot).
+ *
+ *      \return         Pointer to the grid, or NULL on failure. Free with Lgm_FreeGriddedField().
+ *
+ */
+Lgm_GriddedField *Lgm_B_Gridded_Build( int (*Bsrc)(), double xmin, double xmax, double ymin, double ymax, double zmin, double zmax,
+                                       double h0, double hmin, double MaxErr, Lgm_MagModelInfo *Info ) {
+
+    Lgm_GriddedField    *G, *Old;
+    long int            nNodes, nSing;
+    unsigned long       Key;
+    double              Err, BadVol, BadVol_old, p[10];
+
+    if ( (Bsrc == NULL) || (Bsrc == Lgm_B_Gridded) ) {
+        fprintf(stderr, "Lgm_B_Gridded_Build: Source model must be an existing (non-gridded) B-field model.\n");
+        return( (Lgm_GriddedField *)NULL );
+    }
+    if ( (h0 <= 0.0) || (xmax <= xmin) || (ymax <= ymin) || (zmax <= zmin) ) {
+        fprintf(stderr, "Lgm_B_Gridded_Build: Invalid grid ( h0 = %g, box = [%g,%g]x[%g,%g]x[%g,%g] ).\n", h0, xmin, xmax, ymin, ymax, zmin, zmax );
+        return( (Lgm_GriddedField *)NULL );
+    }
+
+    p[0] = 0.0; // (not Lgm_B_Gridded_BuildLike())
+    p[1] = xmin; p[2] = xmax; p[3] = ymin; p[4] = ymax; p[5] = zmin; p[6] = zmax;
+    p[7] = h0; p[8] = hmin; p[9] = MaxErr;
+    Key = Lgm_B_Gridded_ShmKey( Bsrc, p, 10, Info );
+    if ( (G = Lgm_B_Gridded_FromShm( Key, Bsrc, Info )) != NULL ) return( G );
+
+    G = Lgm_B_Gridded_Alloc( h0, (int)ceil( (xmax-xmin)/h0 - 1e-9 ), (int)ceil( (ymax-ymin)/h0 - 1e-9 ), (int)ceil( (zmax-zmin)/h0 - 1e-9 ) );
+    if ( G == NULL ) return( G );
+
+    Old        = NULL;
+    BadVol_old = -1.0;
+    while ( TRUE ) {
+
+        Lgm_B_Gridded_SetHeader( G, Bsrc, xmin, ymin, zmin, MaxErr, Info );
+
+        Lgm_B_Gridded_FillNodes( G, Old, Info );
+        Lgm_FreeGriddedField( Old );
+        Old = NULL;
+
+        G->nBad = Lgm_B_Gridded_CheckCells( G, NULL, G->Bad, &Err, &nSing, Info );
+        BadVol  = (G->nBad-nSing)*G->h*G->h*G->h;
+
+        if ( Info->VerbosityLevel > 1 ) {
+            printf("Lgm_B_Gridded_Build: h = %g Re, %d x %d x %d cells, max error in good cells = %g nT, %ld cells exceed bound of %g nT (%ld near origin)\n",
+                        G->h, G->ncx, G->ncy, G->ncz, Err, G->nBad, MaxErr, nSing );
+        }
+
+        /*
+         *  Stop when all cells are good, when we hit the limits, or when
+         *  refinement has stopped paying off. Under-resolved (but smooth)
+         *  regions shrink rapidly with refinement (the scheme is 3rd order),
+         *  but the volume of bad cells along a discontinuity only halves. The
+         *  cells around the singular nodes at the origin are ignored here
+         *  since no amount of refinement will get rid of them.
+         */
+        nNodes = (long int)(2*G->ncx+3)*(2*G->ncy+3)*(2*G->ncz+3);
+        if ( (G->nBad == nSing) || (0.5*G->h < hmin) || (nNodes > LGM_GRIDDED_MAX_NODES) ) break;
+        if ( (BadVol_old > 0.0) && (BadVol > 0.4*BadVol_old) ) break;
+        BadVol_old = BadVol;
+
+        Old = G;
+        G = Lgm_B_Gridded_Alloc( 0.5*Old->h, 2*Old->ncx, 2*Old->ncy, 2*Old->ncz );
+        if ( G == NULL ) {
+            // couldnt get the memory. Just keep the coarser grid.
+            G = Old;
+            break;
+        }
+
+    }
+
+    Lgm_B_Gridded_ToShm( Key, G );
+
+    return( G );
+
+}
+
+
+/**
+ *  \brief
+ *      Free a grid built with Lgm_B_Gridded_Build().
+ */
+void Lgm_FreeGriddedField( Lgm_GriddedField *G ) {
+    if ( G == NULL ) return;
+    if ( G->Shm != NULL ) {
+        Lgm_ShmCache_Release( G->Shm );
+    } else {
+        free( G->R );
+        free( G->Bad );
+    }
+    free( G );
+}
+
+
+/**
+ *  \brief
+ *      Attach a grid to a Lgm_MagModelInfo structure and select it as the B-field model.
+ *
+ *  \details
+ *      The grid is not copied; it must not be freed while mInfo is still using it.
+ */
+void Lgm_MagModelInfo_Set_Gridded( Lgm_GriddedField *G, Lgm_MagModelInfo *m ) {
+    m->Gridded       = G;
+    m->ExternalModel = LGM_EXTMODEL_GRIDDED;
+    m->Bfield        = Lgm_B_Gridded;
+    m->BfieldBatch   = NULL;
+    m->BfieldWithJacobian = NULL;
+    m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+    m->ParamsHash    = Lgm_ModelParamsHash( G->Bsrc, m ); // so the grid is only used if m has the inputs it was built with
+}
+
+
+/**
+ *  \brief
+ *      B-field from the gridded field cache.
+ *
+ *  \details
+ *      Points inside the grid (and in cells that met the error bound) are
+ *      answered by tricubic interpolation of the gridded residual plus the
+ *      analytic centered dipole field. All other points, and all points if the time
+ *      in Info->c is not the time the grid was built for (or Info->ParamsHash
+ *      has changed since), are answered by the source model itself.
+ *
+ *      \param[in]      v           Position (GSM, Re).
+ *      \param[out]     B           Field (GSM, nT).
+ *      \param[in,out]  Info        Lgm_MagModelInfo structure.
+ *
+ */
+int Lgm_B_Gridded( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+
+    Lgm_GriddedField    *G = Info->Gridded;
+    Lgm_Vector          Bdip, Bres;
+    double              tx, ty, tz;
+    int                 ci, cj, ck;
+    LGM_STATS_START( t0 );
+
+    if ( G == NULL ) {
+        fprintf(stderr, "Lgm_B_Gridded: No grid has been set (see Lgm_B_Gridded_Build() and Lgm_MagModelInfo_Set_Gridded()).\n");
+        B->x = B->y = B->z = 0.0;
+        return(0);
+    }
+
+    if ( (Info->c->UTC.Date != G->Date) || (Info->c->UTC.Time != G->UTC) || (Info->ParamsHash != G->ParamsHash)
+            || !Lgm_B_Gridded_Locate( v->x, v->y, v->z, G, &ci, &cj, &ck, &tx, &ty, &tz )
+            || G->Bad[ LGM_GRID_CELL( G, ci, cj, ck ) ] ) {
+        return( G->Bsrc( v, B, Info ) );
+    }
+
+    Lgm_B_Gridded_Interp( ci, cj, ck, tx, ty, tz, G, &Bres );
+    Lgm_B_cdip( v, &Bdip, Info );
+
+    B->x = Bres.x + Bdip.x;
+    B->y = Bres.y + Bdip.y;
+    B->z = Bres.z + Bdip.z;
+
+    ++Info->nFunc;
+    LGM_STATS_STOP( Info, Interp, t0 );
+
+    return(1);
+
+}
+
+
+
+
+/*
+ *  Time series of grids.
+ *
+ *  Between Qin-Denton epochs (5 min or 1 hour apart) the model inputs are
+ *  just interpolated (or held), but a run at a 1-minute cadence would still
+ *  need a new grid (or the analytic model) at every time. A
+ *  Lgm_GriddedFieldSeries builds a grid at each input epoch (once), and for
+ *  a time in between blends the nodes of the grids at the two epochs either
+ *  side of it linearly in time. The blend is checked against the model at
+ *  the midpoint time (which is where the error of a linear blend is largest)
+ *  when the pair of grids is made, and cells that dont meet the error bound
+ *  there are answered by the model.
+ *
+ *  Usage:
+ *
+ *      S = Lgm_B_GriddedSeries_Init( Lgm_B_T89, -12.0, 12.0, -12.0, 12.0, -12.0, 12.0, 0.5, 0.25, 1.0, 60.0, 0 );
+ *      for ( each time ) {
+ *          Lgm_Set_Coord_Transforms( Date, UTC, mInfo->c );
+ *          Lgm_get_QinDenton_at_JD( JD, &p, 0, 0 );
+ *          Lgm_set_QinDenton( &p, mInfo );
+ *          Lgm_B_GriddedSeries_Set( S, mInfo );  // sets mInfo->Bfield = Lgm_B_Gridded
+ *          ...
+ *      }
+ *      Lgm_FreeGriddedFieldSeries( S );
+ *
+ *  The grids at the epochs are built with the model inputs from
+ *  Lgm_get_QinDenton_at_JD() at the epochs, so the blend only makes sense
+ *  if mInfo gets its inputs the same way. (If they dont match, e.g. because
+ *  Kp was set by hand, the grid isnt used -- see Lgm_B_Gridded().) The
+ *  blended grid is rewritten by each Lgm_B_GriddedSeries_Set(), so it
+ *  shouldnt be called while other threads are still using the last time.
+ */
+
+
+/*
+ *  Set up m for the epoch JD (time and Qin-Denton inputs).
+ */
+static void Lgm_B_GriddedSeries_AtEpoch( double JD, Lgm_GriddedFieldSeries *S, Lgm_MagModelInfo *m ) {
+
+    Lgm_QinDentonOne    p;
+    long int            Date;
+    int                 Year, Month, Day;
+    double              UT;
+
+    Lgm_jd_to_ymdh( JD, &Date, &Year, &Month, &Day, &UT );
+    Lgm_Set_Coord_Transforms( Date, UT, m->c );
+    Lgm_get_QinDenton_at_JD( JD, &p, 0, S->Persistence );
+    Lgm_set_QinDenton( &p, m );
+
+}
+
+
+/*
+ *  Build a grid with the same layout as T for the snapshot in Info (no
+ *  refinement, so the two can be blended node by node).
+ */
+static Lgm_GriddedField *Lgm_B_Gridded_BuildLike( Lgm_GriddedField *T, Lgm_MagModelInfo *Info ) {
+
+    Lgm_GriddedField    *G;
+    long int            nSing;
+    unsigned long       Key;
+    double              Err, p[9];
+
+    p[0] = 1.0; p[1] = T->h; p[2] = T->ncx; p[3] = T->ncy; p[4] = T->ncz;
+    p[5] = T->xmin; p[6] = T->ymin; p[7] = T->zmin; p[8] = T->MaxErr;
+    Key = Lgm_B_Gridded_ShmKey( T->Bsrc, p, 9, Info );
+    if ( (G = Lgm_B_Gridded_FromShm( Key, T->Bsrc, Info )) != NULL ) return( G );
+
+    if ( (G = Lgm_B_Gridded_Alloc( T->h, T->ncx, T->ncy, T->ncz )) == NULL ) return( G );
+    Lgm_B_Gridded_SetHeader( G, T->Bsrc, T->xmin, T->ymin, T->zmin, T->MaxErr, Info );
+    Lgm_B_Gridded_FillNodes( G, NULL, Info );
+    G->nBad = Lgm_B_Gridded_CheckCells( G, NULL, G->Bad, &Err, &nSing, Info );
+    Lgm_B_Gridded_ToShm( Key, G );
+
+    return( G );
+
+}
+
+
+/**
+ *  \brief
+ *      Make a time series of gridded field caches (see the notes above).
+ *
+ *  \details
+ *      The grid parameters are the same as for Lgm_B_Gridded_Build(). The
+ *      grid at the first epoch is refined as usual, and the later ones get
+ *      the same layout.
+ *
+ *      \param[in]      Bsrc        Source field model (e.g. Lgm_B_T89).
+ *      \param[in]      xmin..zmax  Box to grid (GSM, Re).
+ *      \param[in]      h0          Initial grid spacing (Re).
+ *      \param[in]      hmin        Smallest grid spacing to refine to (Re).
+ *      \param[in]      MaxErr      Error bound (nT) on the interpolated field (and on the blend).
+ *      \param[in]      Cadence     Spacing of the input epochs (minutes, e.g. 5 or 60). Epochs are at multiples of this from 0 UT.
+ *      \param[in]      Persistence Passed on to Lgm_get_QinDenton_at_JD().
+ *
+ *      \return         The series. Free it with Lgm_FreeGriddedFieldSeries().
+ */
+Lgm_GriddedFieldSeries *Lgm_B_GriddedSeries_Init( int (*Bsrc)(), double xmin, double xmax, double ymin, double ymax, double zmin, double zmax,
+                                                  double h0, double hmin, double MaxErr, double Cadence, int Persistence ) {
+
+    Lgm_GriddedFieldSeries *S;
+
+    if ( (Bsrc == NULL) || (Bsrc == Lgm_B_Gridded) || (Cadence <= 0.0) ) {
+        fprintf(stderr, "Lgm_B_GriddedSeries_Init: Need an existing (non-gridded) B-field model and Cadence > 0.\n");
+        return( (Lgm_GriddedFieldSeries *)NULL );
+    }
+
+    S = (Lgm_GriddedFieldSeries *)calloc( 1, sizeof(Lgm_GriddedFieldSeries) );
+    S->Bsrc = Bsrc;
+    S->xmin = xmin; S->xmax = xmax;
+    S->ymin = ymin; S->ymax = ymax;
+    S->zmin = zmin; S->zmax = zmax;
+    S->h0 = h0; S->hmin = hmin; S->MaxErr = MaxErr;
+    S->Cadence     = Cadence;
+    S->Persistence = Persistence;
+    S->JD[0] = S->JD[1] = -1.0;
+
+    return( S );
+
+}
+
+
+/**
+ *  \brief
+ *      Free a series made with Lgm_B_GriddedSeries_Init() (and its grids).
+ */
+void Lgm_FreeGriddedFieldSeries( Lgm_GriddedFieldSeries *S ) {
+    if ( S == NULL ) return;
+    Lgm_FreeGriddedField( S->G[0] );
+    Lgm_FreeGriddedField( S->G[1] );
+    Lgm_FreeGriddedField( S->Blend );
+    free( S );
+}
+
+
+/**
+ *  \brief
+ *      Point Info at the series' grid for the time (and inputs) now in Info.
+ *
+ *  \details
+ *      Builds the grids at the epochs either side of the time if they arent
+ *      there yet (moving on by one epoch keeps the later grid), blends them
+ *      for the time, and attaches the blend to Info with
+ *      Lgm_MagModelInfo_Set_Gridded().
+ *
+ *      \param[in,out]  S       The series.
+ *      \param[in,out]  Info    Lgm_MagModelInfo structure, with the time and model inputs set.
+ *
+ *      \return         TRUE if the grid is in use, FALSE if a grid couldnt be built (Info->Bfield is then set to the source model).
+ */
+int Lgm_B_GriddedSeries_Set( Lgm_GriddedFieldSeries *S, Lgm_MagModelInfo *Info ) {
+
+    Lgm_MagModelInfo    *m;
+    Lgm_GriddedField    *B, *G0, *G1;
+    long int            n, nNodes, nCells, nSing;
+    double              JD, Cd, JD0, w, Err;
+
+    Cd  = S->Cadence/1440.0;
+    JD  = Lgm_Date_to_JD( Info->c->UTC.Date, Info->c->UTC.Time, Info->c );
+    JD0 = floor( (JD - 0.5)/Cd + 1e-7 )*Cd + 0.5;   // epochs are from 0 UT
+
+    /*
+     *  Keep what we can of the last pair.
+     */
+    if ( (S->G[0] == NULL) || (S->G[1] == NULL) || (fabs( JD0 - S->JD[0] ) > 1e-8) ) {
+        if ( (S->G[1] != NULL) && (fabs( JD0 - S->JD[1] ) < 1e-8) ) {
+            Lgm_FreeGriddedField( S->G[0] );
+            S->G[0] = S->G[1]; S->JD[0] = S->JD[1];
+        } else {
+            Lgm_FreeGriddedField( S->G[0] );
+            Lgm_FreeGriddedField( S->G[1] );
+            S->G[0] = NULL;
+        }
+        S->G[1] = NULL;
+        Lgm_FreeGriddedField( S->Blend );
+        S->Blend = NULL;
+    }
+
+    if ( S->Blend == NULL ) {
+
+        m = Lgm_CloneMagInfo( Info );
+        m->Bfield      = S->Bsrc;
+        m->BfieldBatch = NULL;
+        m->Gridded     = NULL;
+
+        if ( S->G[0] == NULL ) {
+            Lgm_B_GriddedSeries_AtEpoch( JD0, S, m );
+            S->G[0]  = Lgm_B_Gridded_Build( S->Bsrc, S->xmin, S->xmax, S->ymin, S->ymax, S->zmin, S->zmax, S->h0, S->hmin, S->MaxErr, m );
+            S->JD[0] = JD0;
+            ++S->nBuilds;
+        }
+        if ( S->G[0] != NULL ) {
+            Lgm_B_GriddedSeries_AtEpoch( JD0+Cd, S, m );
+            S->G[1]  = Lgm_B_Gridded_BuildLike( S->G[0], m );
+            S->JD[1] = JD0+Cd;
+            ++S->nBuilds;
+        }
+
+        if ( (S->G[0] != NULL) && (S->G[1] != NULL) ) {
+
+            /*
+             *  The blended grid. Its cells are bad if they are in either
+             *  grid, or if the blend doesnt meet the bound at the midpoint.
+             */
+            G0 = S->G[0]; G1 = S->G[1];
+            B  = S->Blend = Lgm_B_Gridded_Alloc( G0->h, G0->ncx, G0->ncy, G0->ncz );
+            if ( B != NULL ) {
+                Lgm_B_GriddedSeries_AtEpoch( JD0+0.5*Cd, S, m );
+                Lgm_B_Gridded_SetHeader( B, S->Bsrc, G0->xmin, G0->ymin, G0->zmin, S->MaxErr, m );
+                S->nBlendBad = Lgm_B_Gridded_CheckCells( G0, G1, B->Bad, &Err, &nSing, m );
+                nCells = (long int)B->ncx*B->ncy*B->ncz;
+                for ( B->nBad=0, n=0; n<nCells; ++n ) {
+                    B->Bad[n] |= G0->Bad[n] | G1->Bad[n];
+                    if ( B->Bad[n] ) ++B->nBad;
+                }
+                if ( Info->VerbosityLevel > 1 ) {
+                    printf("Lgm_B_GriddedSeries_Set: grids at JD = %.6f and %.6f, %ld of %ld cells fail the blend check (%ld bad in total)\n",
+                                S->JD[0], S->JD[1], S->nBlendBad, nCells, B->nBad );
+                }
+            }
+
+        }
+
+        Lgm_FreeMagInfo( m );
+
+    }
+
+    if ( S->Blend == NULL ) {
+        Info->Bfield      = S->Bsrc;
+        Info->BfieldBatch = NULL;
+        return( FALSE );
+    }
+
+    /*
+     *  Blend the nodes for this time.
+     */
+    B  = S->Blend; G0 = S->G[0]; G1 = S->G[1];
+    w  = (JD - S->JD[0])/Cd;
+    if ( w < 0.0 ) w = 0.0; else if ( w > 1.0 ) w = 1.0;
+    nNodes = 3*(long int)B->nx*B->ny*B->nz;
+    for ( n=0; n<nNodes; ++n ) B->R[n] = (1.0-w)*G0->R[n] + w*G1->R[n];
+    B->Date       = Info->c->UTC.Date;
+    B->UTC        = Info->c->UTC.Time;
+    B->ParamsHash = Lgm_ModelParamsHash( S->Bsrc, Info );
+    ++S->nSets;
+
+    Lgm_MagModelInfo_Set_Gridded( B, Info );
+
+    return( TRUE );
+
+}
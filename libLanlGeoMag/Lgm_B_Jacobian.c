@@ -0,0 +1,463 @@
+/*! \file Lgm_B_Jacobian.c
+ *
+ *  \brief B-field models that also return the Jacobian of the field.
+ *
+ *  Quantities like grad|B|, curl B and div B (and the gradient/curvature
+ *  drift velocity that is built from them) only need the 3x3 matrix of
+ *  first derivatives of B,
+ *
+ *          J[i][j] = dB_i/dx_j     (GSM, nT/Re)
+ *
+ *  Differencing Info->Bfield costs 6 to 18 extra field evaluations for each
+ *  point. For the models here the derivatives are computed analytically
+ *  along with B for roughly the cost of one or two field evaluations.
+ *
+ *  The general entry point is Lgm_B_Jacobian(). It uses
+ *  Info->BfieldWithJacobian if the user has installed one, otherwise it picks
+ *  the native routine that corresponds to Info->Bfield (see
+ *  Lgm_Native_BfieldWithJacobian()), and if there is none (or the native
+ *  routine cannot handle the point) it differences Info->Bfield with the
+ *  requested stencil (Lgm_B_Jacobian_FD()).
+ *
+ *
+ */
+#include "Lgm/Lgm_MagModelInfo.h"
+
+
+
+/*
+ *  Transform a Jacobian from SM to GSM. With R the SM->GSM rotation
+ *  (B_gsm = R B_sm and x_sm = R^T x_gsm) we have J_gsm = R J_sm R^T.
+ */
+static void Lgm_Jacobian_SM_to_GSM( double Jsm[3][3], double J[3][3], Lgm_CTrans *c ) {
+
+    double  cp, sp, T[3][3];
+    int     j;
+
+    cp = c->cos_psi;
+    sp = c->sin_psi;
+
+    // T = R Jsm
+    for ( j=0; j<3; ++j ) {
+        T[0][j] =  Jsm[0][j]*cp + Jsm[2][j]*sp;
+        T[1][j] =  Jsm[1][j];
+        T[2][j] = -Jsm[0][j]*sp + Jsm[2][j]*cp;
+    }
+
+    // J = T R^T
+    for ( j=0; j<3; ++j ) {
+        J[j][0] =  T[j][0]*cp + T[j][2]*sp;
+        J[j][1] =  T[j][1];
+        J[j][2] = -T[j][0]*sp + T[j][2]*cp;
+    }
+
+}
+
+
+/*
+ *  Dipole field and its Jacobian in cartesian SM coords (dipole at
+ *  (x0,y0,z0) in SM, moment M = c->M_cd).
+ *
+ *      B = f ( -3 x z, -3 y z, r^2 - 3 z^2 ),  f = M/r^5
+ *
+ *  so that with df/dx_j = -5 f x_j/r^2,
+ *
+ *      dBx/dx_j = -3 ( df/dx_j x z + f ( delta_xj z + x delta_zj ) )
+ *      dBy/dx_j = -3 ( df/dx_j y z + f ( delta_yj z + y delta_zj ) )
+ *      dBz/dx_j =      df/dx_j (r^2 - 3 z^2) + f ( 2 x_j - 6 z delta_zj )
+ */
+static void Lgm_B_dip_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], double x0, double y0, double z0, Lgm_CTrans *c ) {
+
+    double      M, cp, sp, u[3], x, y, z, r2, r, f, df, Jsm[3][3];
+    Lgm_Vector  Bsm;
+    int         j;
+
+    M  = c->M_cd;
+    cp = c->cos_psi;
+    sp = c->sin_psi;
+
+    /*
+     *  GSM -> SM (and offset dipole if needed)
+     */
+    u[0] = x = v->x*cp - v->z*sp - x0;
+    u[1] = y = v->y              - y0;
+    u[2] = z = v->x*sp + v->z*cp - z0;
+
+    r2 = x*x + y*y + z*z;
+    r  = sqrt( r2 );
+    f  = M/(r2*r2*r);
+
+    Bsm.x = -3.0*f*x*z;
+    Bsm.y = -3.0*f*y*z;
+    Bsm.z = f*(r2 - 3.0*z*z);
+
+    for ( j=0; j<3; ++j ) {
+        df = -5.0*f*u[j]/r2;
+        Jsm[0][j] = -3.0*( df*x*z + f*( ((j==0) ? z : 0.0) + ((j==2) ? x : 0.0) ) );
+        Jsm[1][j] = -3.0*( df*y*z + f*( ((j==1) ? z : 0.0) + ((j==2) ? y : 0.0) ) );
+        Jsm[2][j] = df*(r2 - 3.0*z*z) + f*( 2.0*u[j] - ((j==2) ? 6.0*z : 0.0) );
+    }
+
+    /*
+     *  SM -> GSM
+     */
+    B->x =  Bsm.x*cp + Bsm.z*sp;
+    B->y =  Bsm.y;
+    B->z = -Bsm.x*sp + Bsm.z*cp;
+    Lgm_Jacobian_SM_to_GSM( Jsm, J, c );
+
+}
+
+
+/**
+ *  \brief
+ *      Centered dipole field and its Jacobian.
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_cdip_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+    Lgm_B_dip_Jacobian( v, B, J, 0.0, 0.0, 0.0, Info->c );
+    return(1);
+}
+
+
+/**
+ *  \brief
+ *      Eccentric dipole field and its Jacobian.
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_edip_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector  ED_geo, ED_sm;
+
+    ED_geo.x = Info->c->ED_x0; ED_geo.y = Info->c->ED_y0; ED_geo.z = Info->c->ED_z0;
+    Lgm_Convert_Coords( &ED_geo, &ED_sm, WGS84_TO_SM, Info->c );
+    Lgm_B_dip_Jacobian( v, B, J, ED_sm.x, ED_sm.y, ED_sm.z, Info->c );
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      "Dungey" field (dipole + constant SM Bz) and its Jacobian.
+ *
+ *  \details
+ *      Uses the same moment and Delta-B as Lgm_B_Dungey() (and, like it,
+ *      sets Info->c->M_cd to the Dungey moment). The constant part doesn't
+ *      contribute to the Jacobian.
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_Dungey_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+
+    Info->M_Dungey  = 30500.0;
+    Info->dB_Dungey = -14.474;
+    Info->c->M_cd   = Info->M_Dungey;
+
+    Lgm_B_dip_Jacobian( v, B, J, 0.0, 0.0, 0.0, Info->c );
+
+    // add Delta-B in the SM z-direction (transformed to GSM)
+    B->x += Info->dB_Dungey*Info->c->sin_psi;
+    B->z += Info->dB_Dungey*Info->c->cos_psi;
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      IGRF field and its Jacobian.
+ *
+ *  \details
+ *      The spherical components of B and their derivatives with respect to
+ *      (r, theta, phi) come from Lgm_IGRF_Derivs(). These are turned into
+ *      the cartesian gradient with the usual spherical-basis expressions
+ *      (which account for the rotation of the unit vectors), and then
+ *      rotated from GEO (WGS84) to GSM.
+ *
+ *      Very close to the geographic poles the spherical expressions are
+ *      singular; there 0 is returned and nothing is computed (Lgm_B_Jacobian()
+ *      then falls back on finite differences).
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1 on success, 0 if too close to a pole.
+ *
+ */
+int Lgm_B_igrf_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+
+    double      r, theta, phi, st, ct, sp, cp, cot, dB[3][3], G[3][3], E[3][3], T[3][3];
+    double      B_r, B_theta, B_phi;
+    Lgm_Vector  w, Bsph, Bgeo, u, U;
+    int         i, j, k;
+
+    /*
+     *  GSM -> GEO (WGS84) spherical coords (theta is colat)
+     */
+    Lgm_Convert_Coords( v, &w, GSM_TO_WGS84, Info->c );
+    r     = sqrt( w.x*w.x + w.y*w.y + w.z*w.z );
+    theta = acos( w.z / r );
+    phi   = atan2( w.y, w.x );
+
+    u.x = r; u.y = theta; u.z = phi;
+    if ( !Lgm_IGRF_Derivs( &u, &Bsph, dB, Info->c ) ) return(0);
+    B_r = Bsph.x; B_theta = Bsph.y; B_phi = Bsph.z;
+
+    st  = sin( theta ); ct = cos( theta );
+    sp  = sin( phi );   cp = cos( phi );
+    cot = ct/st;
+
+    /*
+     *  Gradient of B in the local (e_r, e_theta, e_phi) basis.
+     *  G[i][j] = i-th component of the derivative of B along e_j.
+     */
+    G[0][0] = dB[0][0];
+    G[1][0] = dB[1][0];
+    G[2][0] = dB[2][0];
+
+    G[0][1] = ( dB[0][1] - B_theta )/r;
+    G[1][1] = ( dB[1][1] + B_r )/r;
+    G[2][1] =   dB[2][1]/r;
+
+    G[0][2] = ( dB[0][2]/st - B_phi )/r;
+    G[1][2] = ( dB[1][2]/st - B_phi*cot )/r;
+    G[2][2] = ( dB[2][2]/st + B_r + B_theta*cot )/r;
+
+    /*
+     *  Columns of E are e_r, e_theta, e_phi in cartesian GEO. Jgeo = E G E^T
+     */
+    E[0][0] = st*cp; E[0][1] = ct*cp; E[0][2] = -sp;
+    E[1][0] = st*sp; E[1][1] = ct*sp; E[1][2] =  cp;
+    E[2][0] = ct;    E[2][1] = -st;   E[2][2] = 0.0;
+
+    for ( i=0; i<3; ++i ) {
+        for ( j=0; j<3; ++j ) {
+            for ( T[i][j]=0.0, k=0; k<3; ++k ) T[i][j] += E[i][k]*G[k][j];
+        }
+    }
+    for ( i=0; i<3; ++i ) {
+        for ( j=0; j<3; ++j ) {
+            for ( G[i][j]=0.0, k=0; k<3; ++k ) G[i][j] += T[i][k]*E[j][k];
+        }
+    }
+
+    /*
+     *  Convert Bgeo to cartesian and then GEO -> GSM.
+     */
+    Bgeo.x = B_r*st*cp + B_theta*ct*cp - B_phi*sp;
+    Bgeo.y = B_r*st*sp + B_theta*ct*sp + B_phi*cp;
+    Bgeo.z = B_r*ct    - B_theta*st;
+    Lgm_Convert_Coords( &Bgeo, B, WGS84_TO_GSM, Info->c );
+
+    /*
+     *  Jgsm = A Jgeo A^T (A is the WGS84->GSM rotation). First rotate the
+     *  columns, then the rows.
+     */
+    for ( j=0; j<3; ++j ) {
+        u.x = G[0][j]; u.y = G[1][j]; u.z = G[2][j];
+        Lgm_Convert_Coords( &u, &U, WGS84_TO_GSM, Info->c );
+        T[0][j] = U.x; T[1][j] = U.y; T[2][j] = U.z;
+    }
+    for ( i=0; i<3; ++i ) {
+        u.x = T[i][0]; u.y = T[i][1]; u.z = T[i][2];
+        Lgm_Convert_Coords( &u, &U, WGS84_TO_GSM, Info->c );
+        J[i][0] = U.x; J[i][1] = U.y; J[i][2] = U.z;
+    }
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Internal field (selected by Info->InternalModel) and its Jacobian.
+ *
+ *  \details
+ *      This is what the external models that have a Jacobian version use for
+ *      their internal part.
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1 on success, 0 if the Jacobian could not be computed analytically.
+ *
+ */
+int Lgm_B_Internal_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+
+    switch ( Info->InternalModel ){
+
+        case LGM_CDIP:
+                        return( Lgm_B_cdip_Jacobian( v, B, J, Info ) );
+        case LGM_EDIP:
+                        return( Lgm_B_edip_Jacobian( v, B, J, Info ) );
+        case LGM_IGRF:
+                        return( Lgm_B_igrf_Jacobian( v, B, J, Info ) );
+        default:
+                        fprintf(stderr, "Lgm_B_Internal_Jacobian: Unknown internal model (%d)\n", Info->InternalModel );
+                        return(0);
+
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Return the native Jacobian routine that corresponds to a field routine.
+ *
+ *      \param[in]      Bfield      A scalar field routine (e.g. Lgm_B_T89).
+ *
+ *      \return         The matching Jacobian routine, or NULL if there is no native one.
+ *
+ */
+Lgm_BfieldJacobianFunc Lgm_Native_BfieldWithJacobian( int (*Bfield)() ) {
+
+    if      ( Bfield == Lgm_B_igrf   ) return( Lgm_B_igrf_Jacobian );
+    else if ( Bfield == Lgm_B_cdip   ) return( Lgm_B_cdip_Jacobian );
+    else if ( Bfield == Lgm_B_edip   ) return( Lgm_B_edip_Jacobian );
+    else if ( Bfield == Lgm_B_Dungey ) return( Lgm_B_Dungey_Jacobian );
+    else if ( Bfield == Lgm_B_T89    ) return( Lgm_B_T89_Jacobian );
+
+    return( NULL );
+
+}
+
+
+/**
+ *  \brief
+ *      Compute B and its Jacobian by differencing Info->Bfield.
+ *
+ *  \details
+ *      Each displaced evaluation gives a column of J, so this costs 6, 12 or
+ *      18 field evaluations (for LGM_DERIV_TWO_POINT, LGM_DERIV_FOUR_POINT and
+ *      LGM_DERIV_SIX_POINT respectively) plus one for B itself. The stencils
+ *      are the same ones that Lgm_GradB() etc. have always used;
+ *
+ *          f_0^(1) = 1/(60h)  ( f_3 - 9f_2 + 45f_1  - 45f_-1 + 9f_-2 - f_-3 )
+ *
+ *      (see page 450 of CRC standard Math tables 28th edition).
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in]      DerivScheme Derivative scheme to use (can be one of LGM_DERIV_SIX_POINT, LGM_DERIV_FOUR_POINT, or LGM_DERIV_TWO_POINT).
+ *      \param[in]      h           The delta (in Re) to use for grid spacing in the derivative scheme.
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_Jacobian_FD( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], int DerivScheme, double h, Lgm_MagModelInfo *Info ) {
+
+    double      fx[7], fy[7], fz[7], *q;
+    int         i, j, N;
+    Lgm_Vector  u, Bvec;
+
+    switch ( DerivScheme ) {
+        case LGM_DERIV_SIX_POINT:
+            N = 3;
+            break;
+        case LGM_DERIV_FOUR_POINT:
+            N = 2;
+            break;
+        case LGM_DERIV_TWO_POINT:
+        default:
+            N = 1;
+            break;
+    }
+
+    Info->Bfield( v, B, Info );
+
+    for ( j=0; j<3; ++j ) {
+
+        for ( i=-N; i<=N; ++i ) {
+            if ( i != 0 ) {
+                u = *v;
+                q = (j==0) ? &u.x : ( (j==1) ? &u.y : &u.z );
+                *q += (double)i*h;
+                Info->Bfield( &u, &Bvec, Info );
+                fx[i+N] = Bvec.x; fy[i+N] = Bvec.y; fz[i+N] = Bvec.z;
+            }
+        }
+
+        if ( N == 3 ) {
+            J[0][j] = (fx[6] - 9.0*fx[5] + 45.0*fx[4] - 45.0*fx[2] + 9.0*fx[1] - fx[0])/(60.0*h);
+            J[1][j] = (fy[6] - 9.0*fy[5] + 45.0*fy[4] - 45.0*fy[2] + 9.0*fy[1] - fy[0])/(60.0*h);
+            J[2][j] = (fz[6] - 9.0*fz[5] + 45.0*fz[4] - 45.0*fz[2] + 9.0*fz[1] - fz[0])/(60.0*h);
+        } else if ( N == 2 ) {
+            J[0][j] = (-fx[4] + 8.0*fx[3] - 8.0*fx[1] + fx[0])/(12.0*h);
+            J[1][j] = (-fy[4] + 8.0*fy[3] - 8.0*fy[1] + fy[0])/(12.0*h);
+            J[2][j] = (-fz[4] + 8.0*fz[3] - 8.0*fz[1] + fz[0])/(12.0*h);
+        } else {
+            J[0][j] = (fx[2] - fx[0])/(2.0*h);
+            J[1][j] = (fy[2] - fy[0])/(2.0*h);
+            J[2][j] = (fz[2] - fz[0])/(2.0*h);
+        }
+
+    }
+
+    return(1);
+
+}
+
+
+/**
+ *  \brief
+ *      Compute B and its Jacobian for the currently selected field model.
+ *
+ *  \details
+ *      If Info->BfieldWithJacobian is non-NULL, it is used. Otherwise the
+ *      native Jacobian routine for Info->Bfield is used (see
+ *      Lgm_Native_BfieldWithJacobian()). If there isn't one, or if it returns
+ *      0 (e.g. IGRF right at the poles), Info->Bfield is differenced with
+ *      Lgm_B_Jacobian_FD(). DerivScheme and h are only used in that last case.
+ *
+ *      \param[in]      v           Position (GSM, in Re).
+ *      \param[out]     B           Field (GSM, in nT).
+ *      \param[out]     J           Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in]      DerivScheme Derivative scheme to use for finite differences (can be one of LGM_DERIV_SIX_POINT, LGM_DERIV_FOUR_POINT, or LGM_DERIV_TWO_POINT).
+ *      \param[in]      h           The delta (in Re) to use for grid spacing in the derivative scheme.
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_B_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], int DerivScheme, double h, Lgm_MagModelInfo *Info ) {
+
+    Lgm_BfieldJacobianFunc f;
+
+    if ( (f = Info->BfieldWithJacobian) == NULL ) f = Lgm_Native_BfieldWithJacobian( Info->Bfield );
+
+    if ( (f != NULL) && f( v, B, J, Info ) ) return(1);
+
+    return( Lgm_B_Jacobian_FD( v, B, J, DerivScheme, h, Info ) );
+
+}
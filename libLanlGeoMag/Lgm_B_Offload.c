@@ -0,0 +1,876 @@
+/*! \file Lgm_B_Offload.c
+ *
+ *  \brief Batched field evaluation and field line tracing on an OpenMP target device (e.g. a GPU).
+ *
+ *  The batched kernels (Lgm_B_Batch.c) and the multi-line tracer
+ *  (Lgm_TraceToEarth_Multi.c) do the same arithmetic independently for
+ *  thousands of points or lines, which is what a GPU is good at. The
+ *  routines here do that work in "omp target" regions instead, so they run
+ *  on whatever device the compiler was set up to offload to (nvptx, amdgcn,
+ *  ...). There is no CUDA/HIP code to maintain; the device code is plain C.
+ *
+ *  Offloading is only compiled in with --enable-offload (which defines
+ *  LGM_USE_OFFLOAD and adds OFFLOAD_CFLAGS, e.g. -foffload=nvptx-none, to
+ *  the library's flags). It is turned on per Lgm_MagModelInfo by setting
+ *  Info->OffloadDevice to a device number with
+ *  Lgm_MagModelInfo_Set_Offload(). Lgm_InitMagInfo() sets it from the
+ *  LGM_OFFLOAD_DEVICE environment variable (if set), and otherwise to
+ *  LGM_OFFLOAD_NONE.
+ *
+ *  What is done on the device:
+ *
+ *      - Lgm_B_cdip, Lgm_B_edip, Lgm_B_igrf and Lgm_B_T89 (with any of the
+ *        three internal models). The per-epoch setup (rotation matrices,
+ *        IGRF coefficients, the T89 constants from Lgm_T89_Params()) is done
+ *        on the host and copied over with each call. Everything is in
+ *        double, so results agree with the host kernels to round-off (T89
+ *        is the double version of T89_External_f32()).
+ *
+ *      - Lgm_TraceToEarth_Multi() and Lgm_TraceToSphericalEarth_Multi()
+ *        with one of those models. Each device thread traces one line all
+ *        the way down (same Cash-Karp steps, bracketing and bisection as
+ *        Lgm_TraceToEarth_Lockstep(), and the same Flag codes), so the only
+ *        transfers are the starting points in and the footpoints out.
+ *
+ *  Everything else (T96, TS04, TS07D, user-installed BfieldBatch routines,
+ *  Info->SavePoints, lines that start at or below the target height, small
+ *  batches) stays on the host: Lgm_B_Offload_Batch() and
+ *  Lgm_TraceToEarth_Offload() just return FALSE / -1 and the callers carry
+ *  on as before. The same happens if the library was built without offload
+ *  support or the device isnt there.
+ *
+ *  omp_get_initial_device() is accepted as a device number too. That runs
+ *  the device code on the host, which is only useful for testing it.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_WGS84.h"
+#include "Lgm/Lgm_IGRF.h"
+
+#ifndef LGM_USE_OFFLOAD
+#define LGM_USE_OFFLOAD 0
+#endif
+
+#if LGM_USE_OFFLOAD
+#include <omp.h>
+#endif
+
+/*
+ *  Batches smaller than this arent worth the transfers.
+ */
+#define LGM_OFFLOAD_MIN_BATCH   1024
+#define LGM_OFFLOAD_MIN_LINES   64
+
+
+/**
+ *  \brief
+ *      Number of OpenMP target devices available for offloading.
+ *
+ *      \return         The number of devices (0 if the library was built without --enable-offload).
+ *
+ */
+int Lgm_Offload_nDevices( void ) {
+#if LGM_USE_OFFLOAD
+    return( omp_get_num_devices() );
+#else
+    return( 0 );
+#endif
+}
+
+/*
+ *  Is Device something we can offload to?
+ */
+static int Lgm_Offload_DeviceOK( int Device ) {
+#if LGM_USE_OFFLOAD
+    if ( Device < 0 ) return( FALSE );
+    return( ( Device < omp_get_num_devices() ) || ( Device == omp_get_initial_device() ) );
+#else
+    return( FALSE );
+#endif
+}
+
+/**
+ *  \brief
+ *      Select the OpenMP target device for the batched kernels and the multi-line tracers.
+ *
+ *  \details
+ *      With Device >= 0, Lgm_B_Batch(), Lgm_TraceToEarth_Multi() and
+ *      Lgm_TraceToSphericalEarth_Multi() do their work on that device when
+ *      the model allows it (see Lgm_B_Offload_Supported()).
+ *      LGM_OFFLOAD_NONE turns offloading off.
+ *
+ *      \param[in]      Device      Device number, or LGM_OFFLOAD_NONE.
+ *      \param[in,out]  m           Lgm_MagModelInfo structure.
+ *
+ *      \return         TRUE if the device can be used. Otherwise
+ *                      Info->OffloadDevice is set to LGM_OFFLOAD_NONE and
+ *                      FALSE is returned (also for Device = LGM_OFFLOAD_NONE).
+ *
+ */
+int Lgm_MagModelInfo_Set_Offload( int Device, Lgm_MagModelInfo *m ) {
+
+    if ( !Lgm_Offload_DeviceOK( Device ) ) {
+        m->OffloadDevice = LGM_OFFLOAD_NONE;
+        return( FALSE );
+    }
+    m->OffloadDevice = Device;
+    return( TRUE );
+
+}
+
+/**
+ *  \brief
+ *      Can the currently selected field model be evaluated on the device?
+ *
+ *      \param[in]      Info        Lgm_MagModelInfo structure.
+ *
+ *      \return         TRUE if Info->OffloadDevice is usable and Info->Bfield is
+ *                      Lgm_B_cdip, Lgm_B_edip, Lgm_B_igrf or Lgm_B_T89 (with
+ *                      a dipole or IGRF internal field) and no BfieldBatch
+ *                      routine has been installed.
+ *
+ */
+int Lgm_B_Offload_Supported( Lgm_MagModelInfo *Info ) {
+
+    if ( !Lgm_Offload_DeviceOK( Info->OffloadDevice ) ) return( FALSE );
+    if ( Info->BfieldBatch != NULL ) return( FALSE );
+
+    if ( ( Info->Bfield == Lgm_B_cdip ) || ( Info->Bfield == Lgm_B_edip ) || ( Info->Bfield == Lgm_B_igrf ) ) return( TRUE );
+    if ( Info->Bfield == Lgm_B_T89 ) {
+        return( ( Info->InternalModel == LGM_CDIP ) || ( Info->InternalModel == LGM_EDIP ) || ( Info->InternalModel == LGM_IGRF ) );
+    }
+
+    return( FALSE );
+
+}
+
+
+
+#if LGM_USE_OFFLOAD
+
+/*
+ *  Everything the device needs to evaluate the model, set up on the host
+ *  once per call by Lgm_Offload_SetupModel().
+ */
+typedef struct Lgm_OffloadModel {
+
+    int     Internal;               // LGM_CDIP, LGM_EDIP or LGM_IGRF
+    int     T89;                    // add the T89 external field?
+    double  cp, sp;                 // cos and sin of the tilt angle
+    double  M;                      // c->M_cd
+    double  x0, y0, z0;             // dipole offset (SM, Re). 0 for LGM_CDIP.
+    double  A[3][3];                // GSM -> WGS84 (same indexing as Lgm_MatTimesVec())
+    double  rScale;                 // Re/IGRF_Re (see Lgm_IGRF())
+    double  TruncTol;               // see Lgm_IGRF_TruncDegree()
+    double  Spectrum[14];
+    double  g[14][14], h[14][14], K[14][14], S[14][14];
+    double  q[LGM_T89_NPARAMS];     // see Lgm_T89_Params()
+
+} Lgm_OffloadModel;
+
+/*
+ *  Per-call tracing settings (from Lgm_TraceToEarth_Lockstep()).
+ */
+typedef struct Lgm_OffloadTrace {
+
+    int     Spherical, MaxCount;
+    double  TargetHeight, sgn, tol, Hmin, Hmax;
+    double  Eps, Safety, pShrnk, pGrow, ErrCon;
+    double  xMin, xMax, yMin, yMax, zMin, zMax;
+
+} Lgm_OffloadTrace;
+
+
+static void Lgm_Offload_SetupModel( Lgm_OffloadModel *m, Lgm_MagModelInfo *Info ) {
+
+    Lgm_CTrans  *c = Info->c;
+    Lgm_Vector  ED_geo, ED_sm;
+    int         n, k;
+
+    m->Internal = ( Info->Bfield == Lgm_B_cdip ) ? LGM_CDIP
+                : ( Info->Bfield == Lgm_B_edip ) ? LGM_EDIP
+                : ( Info->Bfield == Lgm_B_igrf ) ? LGM_IGRF : Info->InternalModel;
+    m->T89 = ( Info->Bfield == Lgm_B_T89 );
+
+    m->cp = c->cos_psi; m->sp = c->sin_psi;
+    m->M  = c->M_cd;
+    m->x0 = m->y0 = m->z0 = 0.0;
+    if ( m->Internal == LGM_EDIP ) {
+        ED_geo.x = c->ED_x0; ED_geo.y = c->ED_y0; ED_geo.z = c->ED_z0;
+        Lgm_Convert_Coords( &ED_geo, &ED_sm, WGS84_TO_SM, c );
+        m->x0 = ED_sm.x; m->y0 = ED_sm.y; m->z0 = ED_sm.z;
+    }
+
+    Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, m->A );
+
+    if ( m->Internal == LGM_IGRF ) {
+        // same setup as Lgm_IGRF_Multi()
+        Lgm_InitIGRF( c->Lgm_IGRF_g, c->Lgm_IGRF_h, 13, c->Lgm_IGRF_FirstCall, c );
+        if ( c->Lgm_IGRF_FirstCall ) {
+            Lgm_InitK( c->Lgm_IGRF_K, 13 );
+            Lgm_InitS( c->Lgm_IGRF_S, 13 );
+            c->Lgm_IGRF_FirstCall = FALSE;
+        }
+        for ( n=0; n<14; n++ ) {
+            for ( k=0; k<14; k++ ) {
+                m->g[n][k] = c->Lgm_IGRF_g[n][k]; m->h[n][k] = c->Lgm_IGRF_h[n][k];
+                m->K[n][k] = c->Lgm_IGRF_K[n][k]; m->S[n][k] = c->Lgm_IGRF_S[n][k];
+            }
+            m->Spectrum[n] = c->Lgm_IGRF_Spectrum[n];
+        }
+        m->TruncTol = c->Lgm_IGRF_TruncTol;
+        m->rScale   = Re/IGRF_Re;
+    }
+
+    if ( m->T89 ) Lgm_T89_Params( m->q, Info );
+
+}
+
+
+
+#pragma omp declare target
+
+/*
+ *  Dipole (centered or eccentric), as in Lgm_B_dip_Batch().
+ */
+static void Lgm_Offload_dip( double x, double y, double z, double *bx, double *by, double *bz, const Lgm_OffloadModel *m ) {
+
+    double  cp = m->cp, sp = m->sp, x_sm, y_sm, z_sm, r2, r, f, Bx_sm, By_sm, Bz_sm;
+
+    x_sm = x*cp - z*sp - m->x0;
+    y_sm = y           - m->y0;
+    z_sm = x*sp + z*cp - m->z0;
+
+    r2 = x_sm*x_sm + y_sm*y_sm + z_sm*z_sm;
+    r  = sqrt( r2 );
+    f  = m->M/(r2*r2*r);
+
+    Bx_sm = -3.0*f*x_sm*z_sm;
+    By_sm = -3.0*f*y_sm*z_sm;
+    Bz_sm = f*(r2 - 3.0*z_sm*z_sm);
+
+    *bx =  Bx_sm*cp + Bz_sm*sp;
+    *by =  By_sm;
+    *bz = -Bx_sm*sp + Bz_sm*cp;
+
+}
+
+/*
+ *  Lgm_IGRF_TruncDegree()
+ */
+static int Lgm_Offload_TruncDegree( double r, const Lgm_OffloadModel *m ) {
+
+    double  rinv, f, Err;
+    int     n;
+
+    if ( m->TruncTol <= 0.0 ) return( 13 );
+
+    rinv = 1.0/r;
+    for ( f=rinv*rinv, n=1; n<=13; ++n ) f *= rinv;
+    for ( Err=0.0, n=13; n>1; --n ) {
+        Err += m->Spectrum[n]*f;
+        if ( Err > m->TruncTol ) return( n );
+        f *= r;
+    }
+
+    return( 1 );
+
+}
+
+/*
+ *  The IGRF sums of _Lgm_IGRF4() at one point (r in IGRF_Re, colatitude
+ *  Theta, longitude Phi, both in radians). Returns (B_r, B_theta, B_phi).
+ */
+static void Lgm_Offload_IGRF_Sph( double r, double Theta, double Phi, double *Br, double *Bt, double *Bp, const Lgm_OffloadModel *m ) {
+
+    double  st, ct, sp, cp, rinv, t, f2[14], Cmp[14], Smp[14], Pnn[14], dPnn[14];
+    double  P_n_m, P_nm1_m, P_nm1_mm1, P_nm2_m, dP_n_m, dP_nm1_m, dP_nm1_mm1, dP_nm2_m;
+    double  Knm, gnm, hnm, val, val2, val3, B_r, B_theta, B_phi;
+    int     n, k, Nmax;
+
+    Nmax = Lgm_Offload_TruncDegree( r, m );
+
+    st = sin( Theta ); ct = cos( Theta );
+    sp = sin( Phi );   cp = cos( Phi );
+
+    Cmp[0] = 1.0; Smp[0] = 0.0;
+    for ( k=1; k<=Nmax; ++k ) {
+        Cmp[k] = Cmp[k-1]*cp - Smp[k-1]*sp;
+        Smp[k] = Smp[k-1]*cp + Cmp[k-1]*sp;
+    }
+
+    rinv  = 1.0/r;
+    f2[0] = t = rinv*rinv;
+    for ( n=1; n<=Nmax; ++n ) { t *= rinv; f2[n] = t; }
+
+    Pnn[0] = P_nm1_mm1 = 1.0; dPnn[0] = dP_nm1_mm1 = 0.0;
+    for ( k=1; k<=Nmax; ++k ) {
+        Pnn[k]  = st*P_nm1_mm1;
+        dPnn[k] = st*dP_nm1_mm1 + ct*P_nm1_mm1;
+        P_nm1_mm1 = Pnn[k]; dP_nm1_mm1 = dPnn[k];
+    }
+
+    B_r = B_theta = B_phi = 0.0;
+    for ( k=0; k<=Nmax; ++k ) {
+
+        P_n_m    = Pnn[k];  dP_n_m   = dPnn[k];
+        P_nm1_m  = P_n_m;   P_nm2_m  = 0.0;
+        dP_nm1_m = dP_n_m;  dP_nm2_m = 0.0;
+
+        for ( n=k; n<=Nmax; ++n ) {
+
+            gnm = m->g[n][k];
+            hnm = m->h[n][k];
+
+            if ( n != k ) {
+                Knm = m->K[n][k];
+                P_n_m  = ct*P_nm1_m - Knm*P_nm2_m;
+                dP_n_m = ct*dP_nm1_m - st*P_nm1_m - Knm*dP_nm2_m;
+                P_nm2_m  = P_nm1_m;  P_nm1_m  = P_n_m;
+                dP_nm2_m = dP_nm1_m; dP_nm1_m = dP_n_m;
+            }
+
+            if ( n > 0 ) {
+                val  = gnm*Cmp[k] + hnm*Smp[k];
+                val2 = m->S[n][k]*f2[n];
+                val3 = val2*val;
+                B_r     += val3*(n+1)*P_n_m;
+                B_theta += val3*dP_n_m;
+                B_phi   += val2*k*(-gnm*Smp[k] + hnm*Cmp[k])*P_n_m;
+            }
+
+        }
+    }
+
+    *Br =  B_r;
+    *Bt = -B_theta;
+    *Bp = -B_phi/st;
+
+}
+
+/*
+ *  IGRF at a GSM point, as in Lgm_B_igrf_Batch(). Near the poles (same test
+ *  as Lgm_IGRF()) B_phi/sin(theta) is 0/0, so the spherical components are
+ *  interpolated linearly between theta = -+1e-4 instead (they are smooth
+ *  through the pole, so this is good to ~1e-8 of |B|).
+ */
+static void Lgm_Offload_igrf( double x, double y, double z, double *bx, double *by, double *bz, const Lgm_OffloadModel *m ) {
+
+    const double    (*A)[3] = m->A;
+    double          wx, wy, wz, r, rI, Theta, Phi, Br, Bt, Bp, Br2, Bt2, Bp2, f;
+    double          st, ct, sp, cp, Gx, Gy, Gz;
+
+    wx = A[0][0]*x + A[1][0]*y + A[2][0]*z;
+    wy = A[0][1]*x + A[1][1]*y + A[2][1]*z;
+    wz = A[0][2]*x + A[1][2]*y + A[2][2]*z;
+    r     = sqrt( wx*wx + wy*wy + wz*wz );
+    Theta = acos( wz/r );
+    Phi   = atan2( wy, wx );
+    rI    = r*m->rScale;
+
+    if ( fabs( Theta*RadPerDeg ) < 1e-4 ) {
+        Lgm_Offload_IGRF_Sph( rI, -1e-4, Phi, &Br,  &Bt,  &Bp,  m );
+        Lgm_Offload_IGRF_Sph( rI,  1e-4, Phi, &Br2, &Bt2, &Bp2, m );
+        f  = 0.5*(Theta + 1e-4)/1e-4;
+        Br += f*(Br2-Br); Bt += f*(Bt2-Bt); Bp += f*(Bp2-Bp);
+    } else {
+        Lgm_Offload_IGRF_Sph( rI, Theta, Phi, &Br, &Bt, &Bp, m );
+    }
+
+    st = sin( Theta ); ct = cos( Theta );
+    sp = sin( Phi );   cp = cos( Phi );
+    Gx = Br*st*cp + Bt*ct*cp - Bp*sp;
+    Gy = Br*st*sp + Bt*ct*sp + Bp*cp;
+    Gz = Br*ct    - Bt*st;
+
+    *bx = A[0][0]*Gx + A[0][1]*Gy + A[0][2]*Gz;
+    *by = A[1][0]*Gx + A[1][1]*Gy + A[1][2]*Gz;
+    *bz = A[2][0]*Gx + A[2][1]*Gy + A[2][2]*Gz;
+
+}
+
+/*
+ *  The T89 external field. This is T89_External_f32() (T89.c) in double;
+ *  keep the two in step.
+ */
+static void Lgm_Offload_T89( double x, double y, double z, double *Bx, double *By, double *Bz, const double *q ) {
+
+    const double *p = q;
+    double  sin_psi = q[39], cos_psi = q[40], tan_psi = q[41];
+    double  p28_4 = q[42], p26_2 = q[43], p29_2 = q[44], p31_2 = q[45], p30_2 = q[46], p38_2 = q[47], oop19 = q[48];
+    double  x_sm, y_sm, z_sm, x_sm_2, y_sm_2, y_sm_3, y_sm_4, rho2, gg, ee, hh, z_s, z_sx, z_sy, z_r, aa, tt12, tt32;
+    double  h_1, uu12, uu32, h_T, D_T, D_Tx, D_Ty, oonn, cc, ss12, ss32, W, W_x, W_y, xi_T, bb, S_T, ooS_T, ooS_T_2, ooP, Q_T;
+    double  D_RC, D_RCx, xi_RC, ff, ff2, S_RC, S_RC2, S_RC_5, Q_RC;
+    double  Bxsm, Bysm, Bzsm, t, exod_x, y2, z2;
+    double  W_c, W_cx, W_cy, S_p, S_m, zpp35, zmp35, x2py2, ffcc, ggdd, F_px, F_mx, F_py, F_my, F_pz, F_mz, psp;
+
+    x_sm = x*cos_psi - z*sin_psi;
+    y_sm = y;
+    z_sm = x*sin_psi + z*cos_psi;
+
+    x_sm_2 = x_sm*x_sm;
+    y_sm_2 = y_sm*y_sm;
+    y_sm_3 = y_sm_2*y_sm;
+    y_sm_4 = y_sm_2*y_sm_2;
+    rho2   = x_sm_2 + y_sm_2;
+
+    // warping of the current sheet (common to BT and BRC)
+    gg   = y_sm_4 + p28_4;
+    ee   = x_sm + p[23];
+    hh   = sqrt( ee*ee + 16.0 );
+    z_s  = 0.5*tan_psi*(ee-hh) - p[24]*sin_psi*y_sm_4/gg;
+    z_sx = 0.5*(1.0 - ee/hh)*tan_psi;
+    z_sy = -4.0*p[24]*y_sm_3*p28_4*sin_psi/(gg*gg);
+    z_r  = z_sm - z_s;
+    aa   = x_sm + 16.0;
+    tt12 = sqrt( aa*aa + 36.0 );
+    tt32 = tt12*(aa*aa + 36.0);
+    h_1  = 0.5*(1.0 - aa/tt12);
+
+    // tail (BT)
+    uu12  = sqrt( x_sm_2 + p31_2 );
+    uu32  = uu12*(x_sm_2 + p31_2);
+    h_T   = 0.5*(1.0 + x_sm/uu12);
+    D_T   = p[21] + p[33]*y_sm_2 + p[32]*h_T + p[34]*h_1;
+    D_Tx  = p[32]*p31_2/(2.0*uu32) - 18.0*p[34]/tt32;
+    D_Ty  = 2.0*p[33]*y_sm;
+    oonn  = 1.0/(1.0 + y_sm_2/p26_2);
+    cc    = x_sm - p[27];
+    ss12  = sqrt( cc*cc + p29_2 );
+    ss32  = ss12*(cc*cc + p29_2);
+    W     = 0.5*(1.0 - cc/ss12)*oonn;
+    W_x   = -0.5*p29_2*oonn/ss32;
+    W_y   = -2.0*y_sm*W/(y_sm_2 + p26_2);
+    xi_T  = sqrt( z_r*z_r + D_T*D_T );
+    bb    = p[25] + xi_T;
+    S_T   = sqrt( rho2 + bb*bb );
+    ooS_T = 1.0/S_T;
+    ooS_T_2 = ooS_T*ooS_T;
+    ooP   = 1.0/(S_T + bb);
+    Q_T   = W/(xi_T*S_T)*(p[0]*ooP + p[1]*ooS_T_2);
+    t     = Q_T*z_r;
+    Bxsm  = t*x_sm;
+    Bysm  = t*y_sm;
+    Bzsm  = W*ooS_T*(p[0] + p[1]*bb*ooS_T_2) + (x_sm*W_x + y_sm*W_y)*ooP*(p[0] + p[1]*ooS_T)
+            + Bxsm*z_sx + Bysm*z_sy - Q_T*D_T*(x_sm*D_Tx + y_sm*D_Ty);
+
+    // ring current (BRC)
+    uu12   = sqrt( x_sm_2 + p30_2 );
+    uu32   = uu12*(x_sm_2 + p30_2);
+    D_RC   = p[21] + p[22]*0.5*(1.0 + x_sm/uu12) + p[34]*h_1;
+    D_RCx  = 0.5*p[22]*p30_2/uu32 - 18.0*p[34]/tt32;
+    xi_RC  = sqrt( z_r*z_r + D_RC*D_RC );
+    ff     = p[20] + xi_RC; ff2 = ff*ff;
+    S_RC   = sqrt( rho2 + ff2 );
+    S_RC2  = S_RC*S_RC; S_RC_5 = S_RC2*S_RC2*S_RC;
+    Q_RC   = 3.0*p[4]/(xi_RC*S_RC_5)*ff;
+    t      = Q_RC*z_r;
+    Bxsm  += t*x_sm;
+    Bysm  += t*y_sm;
+    Bzsm  += p[4]*(2.0*ff2 - rho2)/S_RC_5 + t*x_sm*z_sx + t*y_sm*z_sy - Q_RC*D_RC*x_sm*D_RCx;
+
+    *Bx =  Bxsm*cos_psi + Bzsm*sin_psi;
+    *By =  Bysm;
+    *Bz = -Bxsm*sin_psi + Bzsm*cos_psi;
+
+    // magnetopause (BM)
+    y2 = y*y; z2 = z*z;
+    exod_x = exp( x*oop19 );
+    *Bx += exod_x*(p[5]*z*cos_psi + (p[6] + p[7]*y2 + p[8]*z2)*sin_psi);
+    *By += exod_x*(p[9]*y*z*cos_psi + (p[10]*y + p[11]*y*y2 + p[12]*y*z2)*sin_psi);
+    *Bz += exod_x*((p[13] + p[14]*y2 + p[15]*z2)*cos_psi + (p[16]*z + p[17]*z*y2 + p[18]*z*z2)*sin_psi);
+
+    // closure currents (BC)
+    x2py2 = x*x + y2;
+    aa    = x - p[36];
+    ss12  = sqrt( aa*aa + p[37] );
+    ss32  = ss12*(aa*aa + p[37]);
+    ee    = 1.0/(1.0 + y2/p38_2);
+    W_c   = 0.5*(1.0 - aa/ss12)*ee;
+    W_cx  = -0.5*p[37]*ee/ss32;
+    W_cy  = -2.0*y*W_c/(y2 + p38_2);
+    zpp35 = z + p[35];
+    zmp35 = z - p[35];
+    S_p   = sqrt( zpp35*zpp35 + x2py2 );
+    S_m   = sqrt( zmp35*zmp35 + x2py2 );
+    ffcc  = 1.0/((S_p + zpp35)*S_p);
+    ggdd  = 1.0/((S_m - zmp35)*S_m);
+    t     = x*W_cx + y*W_cy;
+    F_px  =  W_c*x*ffcc;
+    F_mx  = -W_c*x*ggdd;
+    F_py  =  W_c*y*ffcc;
+    F_my  = -W_c*y*ggdd;
+    F_pz  =  W_c/S_p + t/(S_p + zpp35);
+    F_mz  =  W_c/S_m + t/(S_m - zmp35);
+    psp   = p[3]*sin_psi;
+    *Bx  += p[2]*(F_px + F_mx) + psp*(F_px - F_mx);
+    *By  += p[2]*(F_py + F_my) + psp*(F_py - F_my);
+    *Bz  += p[2]*(F_pz + F_mz) + psp*(F_pz - F_mz);
+
+}
+
+/*
+ *  The whole model at one GSM point.
+ */
+static void Lgm_Offload_B( double x, double y, double z, double *bx, double *by, double *bz, const Lgm_OffloadModel *m ) {
+
+    double  Bx, By, Bz;
+
+    if ( m->Internal == LGM_IGRF ) Lgm_Offload_igrf( x, y, z, bx, by, bz, m );
+    else                           Lgm_Offload_dip(  x, y, z, bx, by, bz, m );
+
+    if ( m->T89 ) {
+        Lgm_Offload_T89( x, y, z, &Bx, &By, &Bz, m->q );
+        *bx += Bx; *by += By; *bz += Bz;
+    }
+
+}
+
+/*
+ *  Unit B at P. Returns FALSE if |B| is too small (as in Lgm_TTEM_Bhat()).
+ */
+static int Lgm_Offload_Bhat( const double *P, double *b, const Lgm_OffloadModel *m ) {
+
+    double  Bmag;
+
+    Lgm_Offload_B( P[0], P[1], P[2], &b[0], &b[1], &b[2], m );
+    Bmag = sqrt( b[0]*b[0] + b[1]*b[1] + b[2]*b[2] );
+    if ( Bmag < 1e-16 ) return( FALSE );
+    b[0] /= Bmag; b[1] /= Bmag; b[2] /= Bmag;
+
+    return( TRUE );
+
+}
+
+/*
+ *  Height (km) above the spherical Earth or the WGS84 ellipsoid, as in
+ *  Lgm_TTEM_Height() (the ellipsoid case is Lgm_WGS84_to_GeodHeight()).
+ */
+static double Lgm_Offload_Height( const double *P, int Spherical, const Lgm_OffloadModel *m ) {
+
+    const double    (*A)[3] = m->A;
+    double          ux, uy, uz, r, r2, z2, F, G, G2, G3, c, s, tt, tt2, Pp, Q, ro, U, V;
+
+    if ( Spherical ) return( WGS84_A*( sqrt( P[0]*P[0] + P[1]*P[1] + P[2]*P[2] ) - 1.0 ) );
+
+    ux = WGS84_A*( A[0][0]*P[0] + A[1][0]*P[1] + A[2][0]*P[2] );
+    uy = WGS84_A*( A[0][1]*P[0] + A[1][1]*P[1] + A[2][1]*P[2] );
+    uz = WGS84_A*( A[0][2]*P[0] + A[1][2]*P[1] + A[2][2]*P[2] );
+
+    r2 = ux*ux + uy*uy;
+    r  = sqrt( r2 );
+    z2 = uz*uz;
+    F  = 54.0*WGS84_B2*z2;
+    G  = r2 + WGS84_1mE2*z2 - WGS84_E2*WGS84_A2mB2;
+    G2 = G*G; G3 = G2*G;
+    c  = (WGS84_E4*F*r2)/G3;
+    s  = pow( 1.0 + c + sqrt(c*c + 2.0*c), M_OneThird );
+    tt = s + 1.0/s + 1.0; tt2 = tt*tt;
+    Pp = F/( 3.0*tt2*G2 );
+
+    Q  = sqrt( 1.0 + 2.0*WGS84_E4*Pp );
+    ro = -(WGS84_E2*Pp*r)/(1.0+Q) + sqrt( (0.5*WGS84_A2)*(1.0+1.0/Q) - (WGS84_1mE2*Pp*z2)/(Q*(1.0+Q)) - 0.5*Pp*r2 );
+
+    tt = (r - WGS84_E2*ro); tt2 = tt*tt;
+    U  = sqrt( tt2 + z2 );
+    V  = sqrt( tt2 + WGS84_1mE2*z2 );
+
+    return( U*( 1.0 - WGS84_B2/(WGS84_A*V) ) );
+
+}
+
+/*
+ *  Trace one line from P0 (which is above the target height) down to the
+ *  target height. This is one lane of Lgm_TraceToEarth_Lockstep() run to the
+ *  end: the same Cash-Karp tableau, step control, bracketing, bisection and
+ *  Flag codes (but no messages -- the caller prints those).
+ */
+static int Lgm_Offload_TraceLine( const double *P0, double *Pout, double *Sout, const Lgm_OffloadTrace *t, const Lgm_OffloadModel *m ) {
+
+    const double    b[6][5] = { {  0.0,                     0.0,         0.0,                     0.0,                     0.0            },
+                                {  0.2,                     0.0,         0.0,                     0.0,                     0.0            },
+                                {  0.075,                   0.225,       0.0,                     0.0,                     0.0            },
+                                {  0.3,                    -0.9,         1.2,                     0.0,                     0.0            },
+                                { -0.20370370370370370370,  2.5,        -2.59259259259259259259,  1.29629629629629629629,  0.0            },
+                                {  0.02949580439814814814,  0.341796875, 0.04159432870370370370,  0.40034541377314814814,  0.061767578125 } };
+    const double    cc[6] = { 0.09788359788359788359, 0.0, 0.40257648953301127214, 0.21043771043771043771, 0.0, 0.28910220214568040654 };
+    const double    dc[6] = { -0.00429377480158730159, 0.0, 0.01866858609385783299, -0.03415502683080808080, -0.01932198660714285714, 0.03910220214568040654 };
+    double          Pa[3], Pc[3], Q[3], X[3], k[6][3], err[3];
+    double          Sa, Sc, h, H, Hdid, Hnext, Htry, ErrMax, e, Height, F;
+    int             Refine, HaveB0, Count, nRej, l, j, d;
+
+    Pa[0] = P0[0]; Pa[1] = P0[1]; Pa[2] = P0[2];
+    Pout[0] = Pa[0]; Pout[1] = Pa[1]; Pout[2] = Pa[2];
+    Sa = Sc = 0.0; *Sout = 0.0;
+    Height = Lgm_Offload_Height( Pa, t->Spherical, m );
+    h      = 0.9*Height; if ( h > ( t->Spherical ? t->Hmax : 0.1 ) ) h = t->Spherical ? t->Hmax : 0.1;
+    Refine = HaveB0 = FALSE;
+    Count  = nRej = 0;
+
+    while ( 1 ) {
+
+        if ( !HaveB0 ) {
+            if ( !Lgm_Offload_Bhat( Pa, k[0], m ) ) { Pout[0] = Pa[0]; Pout[1] = Pa[1]; Pout[2] = Pa[2]; return( -1 ); }
+            HaveB0 = TRUE;
+        }
+
+        H = t->sgn*h;
+        for ( l=1; l<6; ++l ) {
+            for ( d=0; d<3; ++d ) {
+                X[d] = Pa[d];
+                for ( j=0; j<l; ++j ) X[d] += H*b[l][j]*k[j][d];
+            }
+            if ( !Lgm_Offload_Bhat( X, k[l], m ) ) { Pout[0] = Pa[0]; Pout[1] = Pa[1]; Pout[2] = Pa[2]; return( -1 ); }
+        }
+
+        for ( d=0; d<3; ++d ) {
+            Q[d] = Pa[d]; err[d] = 0.0;
+            for ( l=0; l<6; ++l ) { Q[d] += H*cc[l]*k[l][d]; err[d] += H*dc[l]*k[l][d]; }
+        }
+        ErrMax = sqrt( err[0]*err[0] + err[1]*err[1] + err[2]*err[2] )/t->Eps;
+
+        if ( ErrMax > 1.0 ) {
+            e = t->Safety*h*pow( ErrMax, t->pShrnk );
+            h = ( e > 0.1*h ) ? e : 0.1*h;
+            if ( ( Sa + h == Sa ) || ( ++nRej > t->MaxCount ) ) { Pout[0] = Pa[0]; Pout[1] = Pa[1]; Pout[2] = Pa[2]; return( -1 ); }
+            continue;
+        }
+
+        nRej   = 0;
+        Hdid   = h;
+        Hnext  = ( ErrMax > t->ErrCon ) ? t->Safety*Hdid*pow( ErrMax, t->pGrow ) : 5.0*Hdid;
+        Height = Lgm_Offload_Height( Q, t->Spherical, m );
+        F      = Height - t->TargetHeight;
+
+        if ( !Refine ) {
+
+            if (   (Q[0] > t->xMax) || (Q[0] < t->xMin) || (Q[1] > t->yMax) || (Q[1] < t->yMin)
+                || (Q[2] > t->zMax) || (Q[2] < t->zMin) || ( Sa+Hdid > 1000.0 ) ) {
+                // open FL
+                if ( t->Spherical ) { Pout[0] = Pout[1] = Pout[2] = 0.0; } else { Pout[0] = Q[0]; Pout[1] = Q[1]; Pout[2] = Q[2]; }
+                return( 0 );
+            } else if ( F < 0.0 ) {
+                Pc[0] = Q[0]; Pc[1] = Q[1]; Pc[2] = Q[2]; Sc = Sa + Hdid;
+                Refine = TRUE;
+            } else {
+                Pa[0] = Q[0]; Pa[1] = Q[1]; Pa[2] = Q[2]; Sa += Hdid; HaveB0 = FALSE;
+                Htry = ( Hnext < 0.9*Height ) ? Hnext : 0.9*Height;
+                if      ( Htry < t->Hmin ) Htry = t->Hmin;
+                else if ( Htry > t->Hmax ) Htry = t->Hmax;
+                h = Htry;
+            }
+
+            if ( t->Spherical && ( ++Count > 1000 ) ) { Pout[0] = Pa[0]; Pout[1] = Pa[1]; Pout[2] = Pa[2]; return( -1 ); }
+
+        } else {
+
+            if ( F >= 0.0 ) {
+                Pa[0] = Q[0]; Pa[1] = Q[1]; Pa[2] = Q[2]; Sa += Hdid; HaveB0 = FALSE;
+            } else {
+                Pc[0] = Q[0]; Pc[1] = Q[1]; Pc[2] = Q[2]; Sc = Sa + Hdid;
+            }
+
+        }
+
+        if ( Refine ) {
+            if ( fabs( Sc - Sa ) < t->tol ) {
+                for ( d=0; d<3; ++d ) Pout[d] = 0.5*(Pa[d] + Pc[d]);
+                *Sout = 0.5*(Sa + Sc);
+                return( 1 );
+            }
+            h = 0.5*fabs( Sc - Sa );
+        }
+
+    }
+
+}
+
+#pragma omp end declare target
+
+#endif
+
+
+
+/**
+ *  \brief
+ *      Evaluate the field model over arrays of positions on the offload device.
+ *
+ *  \details
+ *      Same arguments and results as Lgm_B_Batch(). Lgm_B_Batch() calls
+ *      this first when Info->OffloadDevice is set.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[out]     bx          Array of n GSM Bx values (in nT).
+ *      \param[out]     by          Array of n GSM By values (in nT).
+ *      \param[out]     bz          Array of n GSM Bz values (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         TRUE if the field was computed on the device, FALSE if
+ *                      it wasnt (nothing is touched and the caller should use
+ *                      the host kernels).
+ *
+ */
+int Lgm_B_Offload_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+#if LGM_USE_OFFLOAD
+
+    Lgm_OffloadModel    *m;
+    long int            i;
+    int                 Device = Info->OffloadDevice;
+
+    if ( ( n < LGM_OFFLOAD_MIN_BATCH ) || !Lgm_B_Offload_Supported( Info ) ) return( FALSE );
+
+    m = (Lgm_OffloadModel *) calloc( 1, sizeof( *m ) );
+    Lgm_Offload_SetupModel( m, Info );
+
+    #pragma omp target teams distribute parallel for device( Device ) map( to: m[0:1], x[0:n], y[0:n], z[0:n] ) map( from: bx[0:n], by[0:n], bz[0:n] )
+    for ( i=0; i<n; ++i ) {
+        Lgm_Offload_B( x[i], y[i], z[i], &bx[i], &by[i], &bz[i], m );
+    }
+
+    free( m );
+    Info->nFunc += n;
+
+    return( TRUE );
+
+#else
+
+    return( FALSE );
+
+#endif
+
+}
+
+
+/**
+ *  \brief
+ *      Trace a set of field lines to the Earth on the offload device.
+ *
+ *  \details
+ *      Does what Lgm_TraceToEarth_Multi() (Spherical = FALSE) or
+ *      Lgm_TraceToSphericalEarth_Multi() (Spherical = TRUE) do, with each
+ *      line traced by one device thread. Lines that start inside the Earth
+ *      or at or below the target height are dealt with on the host, as in
+ *      the lockstep tracer.
+ *
+ *      \param[in]       n           Number of field lines.
+ *      \param[in]       u           Array of n starting positions in GSM coordinates.
+ *      \param[out]      v           Array of n final points.
+ *      \param[in]      TargetHeight The target altitude (in km).
+ *      \param[in]      sgn          Direction for trace. +1.0 is with the field, -1.0 is against the field.
+ *      \param[in]      tol          Tolerance for converging on footpoint location.
+ *      \param[in]      Spherical    TRUE for the spherical Earth, FALSE for the WGS84 ellipsoid.
+ *      \param[out]     Flag         Array of n return codes.
+ *      \param[out]     S            Array of n distances (in Re) along the FL from u[i] to v[i]. May be NULL.
+ *      \param[in,out]  Info         Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *  \return         The number of lines for which Flag[i] is 1, or -1 if
+ *                  nothing was done (offloading is off, the model isnt
+ *                  supported, Info->SavePoints is set or n is small).
+ *
+ */
+int Lgm_TraceToEarth_Offload( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int Spherical, int *Flag, double *S, Lgm_MagModelInfo *Info ) {
+
+#if LGM_USE_OFFLOAD
+
+    Lgm_OffloadModel    *m;
+    Lgm_OffloadTrace    t;
+    double              *P0, *P1, *s, R, Height;
+    int                 *Idx, *f, i, j, nDev, nGood, Device = Info->OffloadDevice;
+
+    if ( ( n < LGM_OFFLOAD_MIN_LINES ) || Info->SavePoints || !Lgm_B_Offload_Supported( Info ) ) return( -1 );
+
+    m = (Lgm_OffloadModel *) calloc( 1, sizeof( *m ) );
+    Lgm_Offload_SetupModel( m, Info );
+
+    t.Spherical    = Spherical;
+    t.TargetHeight = TargetHeight;
+    t.sgn          = sgn;
+    t.tol          = tol;
+    t.Hmax         = ( Spherical ) ? 1.0  : Info->Hmax;
+    t.Hmin         = ( Spherical ) ? 1e-8 : 0.001;
+    t.Eps          = Info->Lgm_MagStep_RK5_Eps;
+    t.Safety       = Info->Lgm_MagStep_RK5_Safety;
+    t.pShrnk       = Info->Lgm_MagStep_RK5_pShrnk;
+    t.pGrow        = Info->Lgm_MagStep_RK5_pGrow;
+    t.ErrCon       = Info->Lgm_MagStep_RK5_ErrCon;
+    t.MaxCount     = Info->Lgm_MagStep_RK5_MaxCount;
+    t.xMin = Info->OpenLimit_xMin; t.xMax = Info->OpenLimit_xMax;
+    t.yMin = Info->OpenLimit_yMin; t.yMax = Info->OpenLimit_yMax;
+    t.zMin = Info->OpenLimit_zMin; t.zMax = Info->OpenLimit_zMax;
+
+    LGM_ARRAY_1D( Idx, n, int );
+    LGM_ARRAY_1D( f,   n, int );
+    LGM_ARRAY_1D( P0,  3*n, double );
+    LGM_ARRAY_1D( P1,  3*n, double );
+    LGM_ARRAY_1D( s,   n, double );
+
+    /*
+     *  Check the starting points (as in Lgm_TraceToEarth_Lockstep()).
+     */
+    for ( nDev=0, i=0; i<n; ++i ) {
+
+        if ( S ) S[i] = 0.0;
+
+        R = WGS84_A*Lgm_Magnitude( &u[i] );
+        if ( R < WGS84_B ) { v[i] = u[i]; Flag[i] = LGM_INSIDE_EARTH; continue; }
+        Height = Lgm_Offload_Height( &u[i].x, FALSE, m );
+        if ( Height < 0.0 ) { v[i] = u[i]; Flag[i] = LGM_INSIDE_EARTH; continue; }
+        if ( Spherical ) Height = R - WGS84_A;
+
+        if ( Height <= TargetHeight ) {
+            Flag[i] = ( Spherical ) ? Lgm_TraceToSphericalEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info )
+                                    : Lgm_TraceToEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info );
+            if ( S ) S[i] = Info->Trace_s;
+            continue;
+        }
+
+        P0[3*nDev] = u[i].x; P0[3*nDev+1] = u[i].y; P0[3*nDev+2] = u[i].z;
+        Idx[nDev++] = i;
+
+    }
+
+    if ( nDev > 0 ) {
+
+        #pragma omp target teams distribute parallel for device( Device ) map( to: m[0:1], t, P0[0:3*nDev] ) map( from: P1[0:3*nDev], s[0:nDev], f[0:nDev] )
+        for ( j=0; j<nDev; ++j ) {
+            f[j] = Lgm_Offload_TraceLine( &P0[3*j], &P1[3*j], &s[j], &t, m );
+        }
+
+        for ( j=0; j<nDev; ++j ) {
+            i = Idx[j];
+            v[i].x = P1[3*j]; v[i].y = P1[3*j+1]; v[i].z = P1[3*j+2];
+            Flag[i] = f[j];
+            if ( S ) S[i] = s[j];
+            if ( f[j] == -1 ) printf("Lgm_TraceToEarth_Offload(): Bmag too small or too many steps (line %d returning with -1).\n", i );
+        }
+
+    }
+
+    for ( nGood=0, i=0; i<n; ++i ) if ( Flag[i] == 1 ) ++nGood;
+
+    LGM_ARRAY_1D_FREE( Idx );
+    LGM_ARRAY_1D_FREE( f );
+    LGM_ARRAY_1D_FREE( P0 );
+    LGM_ARRAY_1D_FREE( P1 );
+    LGM_ARRAY_1D_FREE( s );
+    free( m );
+
+    return( nGood );
+
+#else
+
+    return( -1 );
+
+#endif
+
+}
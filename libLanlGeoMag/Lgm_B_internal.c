@@ -6,20 +6,31 @@
  *
  *
  */
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_MagStepKernels.h"
 
 int Lgm_B_igrf(Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *MagInfo) {
+    LGM_STATS_START( t0 );
     Lgm_B_igrf_ctrans( v, B, MagInfo->c );
+    LGM_STATS_STOP_MODEL( MagInfo, Internal, LGM_IGRF, t0 );
     return(1);
 }
 
 int Lgm_B_cdip(Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *MagInfo) {
+    LGM_STATS_START( t0 );
     Lgm_B_cdip_ctrans( v, B, MagInfo->c );
+    LGM_STATS_STOP_MODEL( MagInfo, Internal, LGM_CDIP, t0 );
     return(1);
 }
 
+// integrator kernels compiled against the centered dipole (see Lgm_MagStepKernels.h)
+LGM_MAGSTEP_KERNELS( CDIP, Lgm_B_cdip )
+
 int Lgm_B_edip(Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *MagInfo) {
+    LGM_STATS_START( t0 );
     Lgm_B_edip_ctrans( v, B, MagInfo->c );
+    LGM_STATS_STOP_MODEL( MagInfo, Internal, LGM_EDIP, t0 );
     return(1);
 }
 
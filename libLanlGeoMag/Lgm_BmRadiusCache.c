@@ -0,0 +1,201 @@
+/*! \file Lgm_BmRadiusCache.c
+ *
+ *  \brief Cache of radial |B| profiles that FindBmRadius() can bracket from.
+ *
+ *  FindBmRadius() finds the radius where |B| = Bm along the radial line at
+ *  (MLT, mlat) by stepping out from the loss cone height in 0.1 Re steps
+ *  until B-Bm changes sign, and then polishing with Brent. The stepping is
+ *  most of the cost (often 20-50 field evaluations) and it does not depend
+ *  on Bm at all. FindShellLine() calls it over and over for nearby mlats at
+ *  the same MLT, and in Lgm_ComputeLstarVersusPA() every pitch angle uses
+ *  the same MLTs again.
+ *
+ *  So the |B| samples are kept here, for radial lines at mlat nodes dMlat
+ *  apart (0.5 degrees by default) and at the MLTs that were asked for. A
+ *  node is only sampled out as far as the smallest Bm wanted so far.
+ *  Lgm_BmRadiusCache_Bracket() interpolates log|B| linearly in mlat between
+ *  the two nodes either side of mlat and returns the 0.1 Re step in which
+ *  the interpolated profile first drops below Bm. FindBmRadius() checks that
+ *  bracket with two real evaluations (widening it a little if need be) and
+ *  polishes as before; if the check fails, or the profile never gets down
+ *  to Bm (e.g. fields with a minimum along the line), it does its usual
+ *  search.
+ *
+ *  Entries are keyed on the MLT, the mlat node and the model state
+ *  (Lgm_FieldLineCache_ModelHash()), so a cache can be kept from one epoch
+ *  to the next, though Lgm_ComputeLstarVersusPA() makes a fresh one for
+ *  each call if LstarInfo->UseBmRadiusCache is set. The samples are plain
+ *  field evaluations, so what is in the cache doesnt depend on which thread
+ *  put it there. Entries are only read or written inside the
+ *  Lgm_BmRadiusCache critical section (and are copied out), so all of the
+ *  copies of an Lgm_LstarInfo can share one cache.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+
+#define LGM_BMRCACHE_DR         0.1     // Radial spacing (Re) of the samples (the same as FindBmRadius()'s steps)
+#define LGM_BMRCACHE_QUANTUM    1e-8    // MLTs (in degrees) closer than this are the same
+
+
+/*
+ *  Allocate an empty cache. dMlat (<= 0 gives 0.5) is the spacing of the
+ *  mlat nodes in degrees and MaxEntries (<= 0 gives 8192) caps the number of
+ *  nodes kept.
+ */
+Lgm_BmRadiusCache *Lgm_InitBmRadiusCache( double dMlat, int MaxEntries ) {
+
+    Lgm_BmRadiusCache *c;
+
+    c = (Lgm_BmRadiusCache *) calloc( 1, sizeof( *c ) );
+    c->dMlat      = ( dMlat > 0.0 ) ? dMlat : 0.5;
+    c->MaxEntries = ( MaxEntries > 0 ) ? MaxEntries : 8192;
+
+    return( c );
+
+}
+
+
+void Lgm_FreeBmRadiusCache( Lgm_BmRadiusCache *c ) {
+
+    if ( c == NULL ) return;
+    free( c->Entries );
+    free( c );
+
+}
+
+
+static int Lgm_BmRadiusCache_Find( Lgm_BmRadiusCache *c, long int iMLT, long int imlat, unsigned long Hash ) {
+
+    int i;
+
+    for ( i=0; i<c->nEntries; ++i ) {
+        if ( ( c->Entries[i].imlat == imlat ) && ( c->Entries[i].iMLT == iMLT ) && ( c->Entries[i].ModelHash == Hash ) ) return( i );
+    }
+
+    return( -1 );
+
+}
+
+
+/*
+ *  The profile at (MLT, node imlat), sampled (if it wasnt already) until it
+ *  has at least nMin samples and the last one is below Bm, or until it is
+ *  full. e gets a copy. Returns the number of samples.
+ */
+static int Lgm_BmRadiusCache_Profile( Lgm_BmRadiusCache *c, double MLT, long int imlat, unsigned long Hash, double Bm, int nMin, Lgm_BmRadiusCacheEntry *e, Lgm_MagModelInfo *m ) {
+
+    Lgm_Vector  u, v, Bvec;
+    long int    iMLT;
+    int         i, n0;
+    double      r0, Phi, lat, f, g, sl;
+
+    iMLT = lround( 15.0*MLT/LGM_BMRCACHE_QUANTUM );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_BmRadiusCache)
+#endif
+    {
+        if ( ( i = Lgm_BmRadiusCache_Find( c, iMLT, imlat, Hash ) ) >= 0 ) {
+            e->nR = c->Entries[i].nR;
+            memcpy( e->B, c->Entries[i].B, e->nR*sizeof(double) );
+            ++c->nHits;
+        } else {
+            e->nR = 0;
+            ++c->nMisses;
+        }
+    }
+    e->iMLT = iMLT; e->imlat = imlat; e->ModelHash = Hash;
+
+    if ( ( e->nR == LGM_BMRCACHE_NR ) || ( ( e->nR >= nMin ) && ( e->nR > 0 ) && ( e->B[e->nR-1] < Bm ) ) ) return( e->nR );
+
+    /*
+     *  Sample some more of it (outside of the critical section).
+     */
+    r0  = 1.0 + m->Lgm_LossConeHeight/Re;
+    Phi = 15.0*(MLT-12.0)*RadPerDeg; lat = imlat*c->dMlat*RadPerDeg;
+    f = cos( lat )*cos( Phi ); g = cos( lat )*sin( Phi ); sl = sin( lat );
+    n0 = e->nR;
+    while ( ( e->nR < LGM_BMRCACHE_NR ) && ( ( e->nR < nMin ) || ( e->nR == 0 ) || ( e->B[e->nR-1] >= Bm ) ) ) {
+        double r = r0 + LGM_BMRCACHE_DR*e->nR;
+        u.x = r*f; u.y = r*g; u.z = r*sl;
+        Lgm_Convert_Coords( &u, &v, SM_TO_GSM, m->c );
+        m->Bfield( &v, &Bvec, m );
+        e->B[e->nR++] = Lgm_Magnitude( &Bvec );
+    }
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_BmRadiusCache)
+#endif
+    {
+        if ( ( i = Lgm_BmRadiusCache_Find( c, iMLT, imlat, Hash ) ) >= 0 ) {
+            if ( c->Entries[i].nR < e->nR ) {
+                memcpy( c->Entries[i].B + n0, e->B + n0, ( e->nR - n0 )*sizeof(double) );
+                c->Entries[i].nR = e->nR;
+            }
+        } else if ( c->nEntries < c->MaxEntries ) {
+            if ( c->nEntries >= c->nAlloced ) {
+                c->nAlloced = ( c->nAlloced > 0 ) ? 2*c->nAlloced : 64;
+                c->Entries  = (Lgm_BmRadiusCacheEntry *) realloc( c->Entries, c->nAlloced*sizeof(Lgm_BmRadiusCacheEntry) );
+            }
+            c->Entries[ c->nEntries++ ] = *e;
+        }
+    }
+
+    return( e->nR );
+
+}
+
+
+/*
+ *  Bracket [*a, *b] (0.1 Re wide) on the radius at which |B| = Bm along the
+ *  radial line at (MLT, mlat), from the cached profiles at the mlat nodes
+ *  either side. It is only a prediction; the caller has to check it. Returns
+ *  FALSE if the interpolated profile starts out below Bm or never gets down
+ *  to it.
+ */
+int Lgm_BmRadiusCache_Bracket( Lgm_BmRadiusCache *c, double Bm, double MLT, double mlat, double *a, double *b, Lgm_MagModelInfo *m ) {
+
+    Lgm_BmRadiusCacheEntry  E[2], *e0 = &E[0], *e1 = &E[1];
+    unsigned long           Hash;
+    long int                j0;
+    int                     k, n, n0, n1, Found = FALSE;
+    double                  w, r0, lBm, L;
+
+    if ( ( c == NULL ) || ( Bm <= 0.0 ) ) return( FALSE );
+
+    Hash = Lgm_FieldLineCache_ModelHash( m );
+    j0   = (long int)floor( mlat/c->dMlat );
+    w    = mlat/c->dMlat - j0;
+
+    n0 = Lgm_BmRadiusCache_Profile( c, MLT, j0,   Hash, Bm, 0, e0, m );
+    n1 = Lgm_BmRadiusCache_Profile( c, MLT, j0+1, Hash, Bm, 0, e1, m );
+    // the node that got below Bm first has to go as far as the other one
+    if ( n0 < n1 ) n0 = Lgm_BmRadiusCache_Profile( c, MLT, j0,   Hash, Bm, n1, e0, m );
+    if ( n1 < n0 ) n1 = Lgm_BmRadiusCache_Profile( c, MLT, j0+1, Hash, Bm, n0, e1, m );
+    n = ( n0 < n1 ) ? n0 : n1;
+
+    lBm = log( Bm );
+    r0  = 1.0 + m->Lgm_LossConeHeight/Re;
+    for ( k=0; k<n; k++ ) {
+        if ( ( e0->B[k] <= 0.0 ) || ( e1->B[k] <= 0.0 ) ) break;
+        L = (1.0-w)*log( e0->B[k] ) + w*log( e1->B[k] );
+        if ( L <= lBm ) {
+            if ( k > 0 ) {
+                *a = r0 + LGM_BMRCACHE_DR*(k-1);
+                *b = r0 + LGM_BMRCACHE_DR*k;
+                Found = TRUE;
+            }
+            break;
+        }
+    }
+
+    return( Found );
+
+}
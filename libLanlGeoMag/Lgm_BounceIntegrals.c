@@ -0,0 +1,210 @@
+/*! \file Lgm_BounceIntegrals.c
+ *
+ *  \brief Compute I, Sb and K together in one pass over a splined field line.
+ *
+ *  Iinv_interped() and SbIntegral_interped() each do their own QuadPack
+ *  integration between the same two mirror points, and both integrands are
+ *  built from the same kernel, f = sqrt( 1 - B/Bm ):
+ *
+ *      I  = \int_{Sm_South}^{Sm_North} f ds
+ *      Sb = \int_{Sm_South}^{Sm_North} 1/f ds
+ *
+ *  Lgm_BounceIntegrals_interped() evaluates B (and f) once per node and
+ *  accumulates both sums on one adaptive mesh. K follows from I directly (K =
+ *  I sqrt(Bm)) and the bounce period from Sb (Tb = 2 Sb/v), so nothing else
+ *  has to be integrated.
+ *
+ *  The integration variable is theta, with
+ *
+ *      s = ( Sm_South + Sm_North )/2 - ( Sm_North - Sm_South )/2 cos( theta ),   0 <= theta <= pi.
+ *
+ *  Near a mirror point s - Sm ~ theta^2, so f ~ theta and ds ~ theta dtheta,
+ *  which takes out the square root end point of I and the inverse square
+ *  root singularity of Sb. The theta interval is then done with an adaptive
+ *  7-15 point Gauss-Kronrod scheme (like QuadPack's dqage()), always
+ *  bisecting the interval with the largest error in either integral. It
+ *  starts from 16 equal intervals, since with fewer the K15-G7 estimate can
+ *  call a result converged when it isn't (BofS() is only piecewise smooth).
+ *
+ */
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_BOUNCE_INITIAL_INTERVALS    16      // Kronrod error estimates on the spline are not trusted below this
+#define LGM_BOUNCE_MAX_INTERVALS        200
+
+
+/*
+ *  Kronrod nodes (xk) on [0,1] (the (-1,0) side is symmetric) with the 15
+ *  point Kronrod (wk) and 7 point Gauss (wg) weights. The Gauss nodes are
+ *  xk[1], xk[3], xk[5] and xk[7].
+ */
+static const double Lgm_K15_xk[8] = { 0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+                                      0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+                                      0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+                                      0.207784955007898467600689403773245, 0.000000000000000000000000000000000 };
+static const double Lgm_K15_wk[8] = { 0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+                                      0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+                                      0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+                                      0.204432940075298892414161999234649, 0.209482141084727828012999174891714 };
+static const double Lgm_G7_wg[4]  = { 0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+                                      0.381830050505118944950369775488975, 0.417959183673469387755102040816327 };
+
+
+/*
+ *  The two integrands at theta, sharing one BofS() call. g <= 0 (past a
+ *  mirror point, or over a local maximum of B above Bm on a Shabansky-type
+ *  line) contributes nothing to either, as in I_integrand_interped() and
+ *  Sb_integrand_interped().
+ */
+static void Lgm_Bounce_Integrands( double theta, double c, double h, Lgm_MagModelInfo *mInfo, double *fI, double *fSb ) {
+
+    double  g, f, dsdt;
+
+    dsdt = h*sin( theta );
+    g    = 1.0 - BofS( c - h*cos( theta ), mInfo )/mInfo->Bm;
+    ++mInfo->Lgm_n_I_integrand_Calls;
+
+    if ( g > 0.0 ) {
+        f    = sqrt( g );
+        *fI  = f*dsdt;
+        *fSb = dsdt/f;
+    } else {
+        *fI = *fSb = 0.0;
+    }
+
+}
+
+
+/*
+ *  15 point Kronrod estimates (and |K15-G7| errors) of both integrals over [t0, t1].
+ */
+static void Lgm_Bounce_K15( double t0, double t1, double c, double h, Lgm_MagModelInfo *mInfo, double *I, double *eI, double *Sb, double *eSb ) {
+
+    int     j;
+    double  tc, ht, fI1, fI2, fS1, fS2, kI, kS, gI, gS;
+
+    tc = 0.5*( t0 + t1 );
+    ht = 0.5*( t1 - t0 );
+
+    Lgm_Bounce_Integrands( tc, c, h, mInfo, &fI1, &fS1 );
+    kI = Lgm_K15_wk[7]*fI1; kS = Lgm_K15_wk[7]*fS1;
+    gI = Lgm_G7_wg[3]*fI1;  gS = Lgm_G7_wg[3]*fS1;
+
+    for ( j=0; j<7; j++ ) {
+        Lgm_Bounce_Integrands( tc - ht*Lgm_K15_xk[j], c, h, mInfo, &fI1, &fS1 );
+        Lgm_Bounce_Integrands( tc + ht*Lgm_K15_xk[j], c, h, mInfo, &fI2, &fS2 );
+        kI += Lgm_K15_wk[j]*( fI1 + fI2 );
+        kS += Lgm_K15_wk[j]*( fS1 + fS2 );
+        if ( j%2 == 1 ) {
+            gI += Lgm_G7_wg[j/2]*( fI1 + fI2 );
+            gS += Lgm_G7_wg[j/2]*( fS1 + fS2 );
+        }
+    }
+
+    *I  = ht*kI; *eI  = fabs( ht*( kI - gI ) );
+    *Sb = ht*kS; *eSb = fabs( ht*( kS - gS ) );
+
+}
+
+
+/**
+ *  \brief
+ *      Compute I, Sb and K between the mirror points in one pass over a splined field line.
+ *
+ *  \details
+ *      This gives what Iinv_interped() and SbIntegral_interped() would, but
+ *      B is only evaluated once per node for both, on a mesh that is refined
+ *      until both integrals are converged. The tolerances used are the
+ *      tightest of mInfo->Lgm_I_Integrator_epsabs/epsrel and
+ *      mInfo->Lgm_Sb_Integrator_epsabs/epsrel (a tolerance of zero is not
+ *      used), applied to each of I and Sb.
+ *
+ *      As for Iinv_interped(), the line must have been splined (InitSpline())
+ *      and mInfo->Bm, mInfo->Sm_South and mInfo->Sm_North must be set. The
+ *      number of BofS() calls is left in mInfo->Lgm_n_I_integrand_Calls.
+ *
+ *      \param[in,out]  mInfo   A properly initialized Lgm_MagModelInfo structure (with the line splined).
+ *      \param[out]     I       The integral invariant, I (Re). May be NULL.
+ *      \param[out]     Sb      The Sb integral (Re). May be NULL.
+ *      \param[out]     K       The second invariant, K = I sqrt(Bm) (Re G^1/2). May be NULL.
+ *
+ *      \return         TRUE if both integrals converged, FALSE if the
+ *                      interval limit was hit (the best estimates are still
+ *                      returned) or the limits are bad (LGM_FILL_VALUEs are
+ *                      returned).
+ *
+ */
+int Lgm_BounceIntegrals_interped( Lgm_MagModelInfo *mInfo, double *I, double *Sb, double *K ) {
+
+    int     n, j, jmax, Converged = FALSE;
+    double  c, h, epsabs, epsrel, ResI, ResSb, ErrI, ErrSb, eI, eSb, tm, w, wmax;
+    double  t0[LGM_BOUNCE_MAX_INTERVALS], t1[LGM_BOUNCE_MAX_INTERVALS];
+    double  rI[LGM_BOUNCE_MAX_INTERVALS], rSb[LGM_BOUNCE_MAX_INTERVALS];
+    double  erI[LGM_BOUNCE_MAX_INTERVALS], erSb[LGM_BOUNCE_MAX_INTERVALS];
+
+    mInfo->Lgm_n_I_integrand_Calls = 0;
+
+    if ( I )  *I  = LGM_FILL_VALUE;
+    if ( Sb ) *Sb = LGM_FILL_VALUE;
+    if ( K )  *K  = LGM_FILL_VALUE;
+    if ( ( mInfo->Bm <= 0.0 ) || !( mInfo->Sm_North > mInfo->Sm_South ) ) return( FALSE );
+
+    /*
+     *  Tightest of the two sets of tolerances.
+     */
+    epsabs = mInfo->Lgm_I_Integrator_epsabs;
+    if ( ( mInfo->Lgm_Sb_Integrator_epsabs > 0.0 ) && ( ( epsabs <= 0.0 ) || ( mInfo->Lgm_Sb_Integrator_epsabs < epsabs ) ) ) epsabs = mInfo->Lgm_Sb_Integrator_epsabs;
+    epsrel = mInfo->Lgm_I_Integrator_epsrel;
+    if ( ( mInfo->Lgm_Sb_Integrator_epsrel > 0.0 ) && ( ( epsrel <= 0.0 ) || ( mInfo->Lgm_Sb_Integrator_epsrel < epsrel ) ) ) epsrel = mInfo->Lgm_Sb_Integrator_epsrel;
+
+    c = 0.5*( mInfo->Sm_North + mInfo->Sm_South );
+    h = 0.5*( mInfo->Sm_North - mInfo->Sm_South );
+
+    n = LGM_BOUNCE_INITIAL_INTERVALS;
+    for ( j=0; j<n; j++ ) {
+        t0[j] = M_PI*j/(double)n; t1[j] = M_PI*(j+1)/(double)n;
+        Lgm_Bounce_K15( t0[j], t1[j], c, h, mInfo, &rI[j], &erI[j], &rSb[j], &erSb[j] );
+    }
+
+    while ( 1 ) {
+
+        ResI = ResSb = ErrI = ErrSb = 0.0;
+        for ( j=0; j<n; j++ ) {
+            ResI += rI[j]; ErrI  += erI[j];
+            ResSb += rSb[j]; ErrSb += erSb[j];
+        }
+
+        eI  = ( epsrel > 0.0 ) ? fmax( epsabs, epsrel*fabs( ResI ) )  : epsabs;
+        eSb = ( epsrel > 0.0 ) ? fmax( epsabs, epsrel*fabs( ResSb ) ) : epsabs;
+        if ( ( ErrI <= eI ) && ( ErrSb <= eSb ) ) { Converged = TRUE; break; }
+        if ( n >= LGM_BOUNCE_MAX_INTERVALS ) break;
+
+        /*
+         *  Bisect the interval that contributes most to whichever error is
+         *  furthest from its tolerance.
+         */
+        for ( jmax=0, wmax=-1.0, j=0; j<n; j++ ) {
+            w = fmax( erI[j]/( eI > 0.0 ? eI : 1.0 ), erSb[j]/( eSb > 0.0 ? eSb : 1.0 ) );
+            if ( w > wmax ) { wmax = w; jmax = j; }
+        }
+        tm = 0.5*( t0[jmax] + t1[jmax] );
+        t0[n] = tm; t1[n] = t1[jmax]; t1[jmax] = tm;
+        Lgm_Bounce_K15( t0[jmax], t1[jmax], c, h, mInfo, &rI[jmax], &erI[jmax], &rSb[jmax], &erSb[jmax] );
+        Lgm_Bounce_K15( t0[n], t1[n], c, h, mInfo, &rI[n], &erI[n], &rSb[n], &erSb[n] );
+        ++n;
+
+    }
+
+    if ( ( mInfo->VerbosityLevel > 1 ) && !Converged ) {
+        printf("Lgm_BounceIntegrals_interped: Not converged after %d intervals (I = %g +/- %g, Sb = %g +/- %g)\n", n, ResI, ErrI, ResSb, ErrSb );
+    }
+
+    if ( I )  *I  = ResI;
+    if ( Sb ) *Sb = ResSb;
+    if ( K )  *K  = ResI*sqrt( mInfo->Bm*1e-5 );
+
+    return( Converged );
+
+}
@@ -57,8 +57,11 @@
  *           6) This schem works in general and is pretty easy to implement on a case-by-case basis....
  */
 #include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_Profile.h"
 #include "Lgm/Lgm_Quat.h"
 #include "config.h"
+#include "Lgm/Lgm_VecInline.h"
+#include "Lgm/Lgm_SimdMath.h"
 
 #include <ctype.h>
 #include <time.h>
@@ -80,9 +83,7 @@ void Lgm_free_ctrans_children( Lgm_CTrans *c ) {
         Lgm_FreeJPLephemInfo( c->jpl );
     }
 
-    free( c->l.LeapSecondDates );
-    free( c->l.LeapSecondJDs );
-    free( c->l.LeapSeconds );
+    Lgm_ReleaseLeapSeconds( c );
 }
 
 void Lgm_free_ctrans( Lgm_CTrans *c ) {
@@ -101,9 +102,12 @@ void Lgm_ctransDefaults(Lgm_CTrans *c, int Verbose) {
     /* Set Number of Nutation series terms to 106 */
     c->pnModel = LGM_PN_IAU76;
     c->nNutationTerms = 106;
+    memset( &c->NutationCache, 0, sizeof(Lgm_NutationCache) );
 
     /* Set method to use for calculating Sun/Moon position */
     c->ephModel = LGM_EPH_LOW_ACCURACY;
+    c->UseEphemCache = FALSE;
+    memset( &c->EphemCache, 0, sizeof(Lgm_EphemCache) );
 
     /*
      *  Initialize Earth Orientation Parameters to defaults They can be
@@ -117,6 +121,25 @@ void Lgm_ctransDefaults(Lgm_CTrans *c, int Verbose) {
     c->ddPsi = 0.0; // radians
     c->ddEps = 0.0; // radians
 
+    /*
+     *  By default, dont use the IGRF coefficient cache (i.e. interpolate
+     *  coefficients to the exact time). See Lgm_Set_IGRF_CacheTolerance().
+     */
+    c->Lgm_IGRF_CacheTol = 0.0;
+
+    /*
+     *  By default, sum IGRF to full degree at all radii. See
+     *  Lgm_Set_IGRF_Truncation().
+     */
+    c->Lgm_IGRF_TruncTol = 0.0;
+
+    /*
+     *  By default, evaluate everything on every call to
+     *  Lgm_Set_Coord_Transforms(). See Lgm_Set_CTrans_SlowTierCadence().
+     */
+    c->SlowTierCadence = 0.0;
+    c->SlowTier_nNodes = 0;
+
 }
 
 
@@ -140,7 +163,6 @@ Lgm_CTrans *Lgm_init_ctrans( int Verbose ) {
 Lgm_CTrans *Lgm_CopyCTrans( Lgm_CTrans *s ) {
 
     Lgm_CTrans *t;
-    int         n;
 
 
     if ( s == NULL) {
@@ -156,29 +178,49 @@ Lgm_CTrans *Lgm_CopyCTrans( Lgm_CTrans *s ) {
     /*
      * Do memcpy. Note that for things that are dynamically allocated in
      * Lgm_CTrans structure, this will copy pointers to to memory that belong
-     * to the source. Currently, the LeapSecond stuff is dynamically allocated,
-     * so we need to allocate our own memory for those and then do a memcpy on
-     * the contents.
+     * to the source. The leap second table is shared (read-only) by all
+     * Lgm_CTrans structures, so the copy just needs its own reference on it.
+     * The JPL ephemeris info holds per-body record caches, so the copy gets
+     * its own; it is (cheaply) re-opened by Lgm_Set_Coord_Transforms() when
+     * it is needed.
      */
     memcpy( t, s, sizeof(Lgm_CTrans) );
-
-    /*
-     *  Now, copy the LeapSeconds stuff properly (they were dyn. allocated).
-     *  (memcpy's args are (dest, src, size))
-     */
-    n = t->l.nLeapSecondDates = s->l.nLeapSecondDates;
-    t->l.LeapSecondDates  = (long int *) malloc( n*sizeof(long int) );
-    t->l.LeapSecondJDs    = (double *)   malloc( n*sizeof(double) );
-    t->l.LeapSeconds      = (double *)   malloc( n*sizeof(double) );
-    memcpy( t->l.LeapSecondDates, s->l.LeapSecondDates, n*sizeof(long int) );
-    memcpy( t->l.LeapSecondJDs,   s->l.LeapSecondJDs, n*sizeof(double) );
-    memcpy( t->l.LeapSeconds,     s->l.LeapSeconds, n*sizeof(double) );
+    t->l.LeapSeconds = NULL;
+    Lgm_LoadLeapSeconds( t );
+    t->jpl             = NULL;
+    t->jpl_initialized = FALSE;
 
     return( t );
 
 }
 
 
+/*
+ *  Same as Lgm_CopyCTrans(), but into an existing structure t (e.g. one that
+ *  belongs to a scratch copy that is being reused). t keeps its own
+ *  reference on the leap second table and its own JPL ephemeris info.
+ */
+void Lgm_CopyCTransInto( Lgm_CTrans *t, Lgm_CTrans *s ) {
+
+    Lgm_LeapSeconds     l;
+    Lgm_JPLephemInfo    *jpl;
+    int                 jpl_initialized;
+
+    if ( ( s == NULL ) || ( t == NULL ) || ( s == t ) ) return;
+
+    l               = t->l;
+    jpl             = t->jpl;
+    jpl_initialized = t->jpl_initialized;
+
+    memcpy( t, s, sizeof(Lgm_CTrans) );
+
+    t->l               = l;
+    t->jpl             = jpl;
+    t->jpl_initialized = jpl_initialized;
+
+}
+
+
 
 /**
  *  \brief
@@ -353,56 +395,298 @@ void Lgm_Set_CTrans_Options( int ephModel, int pnModel, Lgm_CTrans *c ) {
 
     }
 
-    c->pnModel = LGM_PN_IAU76; //precession and nutation model : LGM_PN_IAU76, LGM_PN_IAU06 (not impl.)
+    //precession and nutation model : LGM_PN_IAU76, LGM_PN_IAU76_CACHED (per-day fit of the nutation series), LGM_PN_IAU06 (not impl.)
+    switch (pnModel) {
+
+        case LGM_PN_IAU76_CACHED:
+            c->pnModel = pnModel;
+            break;
+        case LGM_PN_IAU76:
+        default:
+            c->pnModel = LGM_PN_IAU76;
+            break;
+
+    }
 }
 
-/** 
+/**
+ *  \brief
+ *      Set the refresh cadence of the slowly varying quantities in Lgm_Set_Coord_Transforms().
+ *
+ *  \details
+ *      When Cadence > 0, Lgm_Set_Coord_Transforms() splits its work into two
+ *      tiers. The slow tier (the nutation series, the IGRF-derived dipole
+ *      quantities and the Moon) is evaluated exactly only at refresh nodes on
+ *      a fixed grid of UTC times spaced Cadence seconds apart, and linearly
+ *      interpolated between the two nodes that bracket the requested time.
+ *      Moving forward through a time series costs one full evaluation per
+ *      grid interval (the later node is carried over). Everything else is
+ *      evaluated exactly on every call: the time systems, Earth rotation
+ *      (gmst/gast), precession (a short polynomial), the Sun and all of the
+ *      matrices built from them. When Cadence is <= 0 (the default) every
+ *      quantity is evaluated exactly on every call as before.
+ *
+ *      Worst-case errors of the interpolated quantities relative to a
+ *      non-tiered call (measured over two days at 37 s spacing; they grow as
+ *      the square of the cadence);
+ *
+ *          Cadence   dPsi, dEps (nutation)   Moon direction   Matrices (e.g. Agei_to_wgs84)
+ *          -------   ---------------------   --------------   -----------------------------
+ *           600 s    < 5e-7 arcsec           < 5e-6 deg       < 1e-12
+ *          3600 s    < 2e-5 arcsec           < 1e-4 deg       < 5e-11
+ *         21600 s    < 1e-3 arcsec           < 3e-3 deg       < 2e-9
+ *
+ *      The nutation error is what gets into the MOD <-> TOD <-> PEF matrices
+ *      (and so into WGS84 etc.), and even at 6 hours it is far below the
+ *      accuracy of the IAU-76/FK5 reduction itself. The IGRF-derived dipole
+ *      axis, moment and eccentric dipole offset only change through secular
+ *      variation, which is linear in time between IGRF epochs, so they (and
+ *      the tilt angle and GSM/SM/CDMAG) are exact to roundoff at any
+ *      cadence. Quantities in the exact tier are identical to a non-tiered
+ *      call.
+ *
+ *      The nodes are re-evaluated if the number of nutation terms or the
+ *      ephemeris model changes. The EOP corrections ddPsi/ddEps are applied
+ *      on every call, so they may change freely.
+ *
+ *      \param[in]      Cadence     Refresh cadence in seconds (<= 0 disables the tiered update).
+ *      \param[in,out]  c           Lgm_CTrans structure.
+ *
+ */
+void Lgm_Set_CTrans_SlowTierCadence( double Cadence, Lgm_CTrans *c ) {
+    c->SlowTierCadence = Cadence;
+    c->SlowTier_nNodes = 0; // force the nodes to be re-evaluated
+}
+
+
+/**
+ *  \brief
+ *      Take the Sun and Moon positions from shared per-day fits of the ephemeris.
+ *
+ *  \details
+ *      When Flag is TRUE, Lgm_ComputeSun() and Lgm_ComputeMoon() get the
+ *      Lgm_SunPosition() series (LGM_EPH_HIGH_ACCURACY) or the JPL Sun and
+ *      Moon (LGM_EPH_DE) from Chebyshev fits that are made once per TT day
+ *      and shared by all Lgm_CTrans structures and threads. The fits agree
+ *      with the direct evaluation to well below the accuracy of the
+ *      ephemerides themselves (see Lgm_EphemCache.c). LGM_EPH_LOW_ACCURACY is
+ *      not affected. The default is FALSE.
+ *
+ *      \param[in]      Flag        TRUE to use the cached fits, FALSE to evaluate directly.
+ *      \param[in,out]  c           Lgm_CTrans structure.
+ *
+ */
+void Lgm_Set_CTrans_EphemCache( int Flag, Lgm_CTrans *c ) {
+    c->UseEphemCache = Flag;
+}
+
+
+/**
+ *  \brief
+ *      Set the speed/accuracy options of Lgm_Set_Coord_Transforms() all at once.
+ *
+ *  \details
+ *      Picks one of a few tested combinations of Lgm_Set_CTrans_Options(),
+ *      Lgm_Set_CTrans_EphemCache() and Lgm_Set_CTrans_SlowTierCadence();
+ *
+ *          Tier                     Ephemeris               Nutation              Ephem cache   Slow tier
+ *          -----------------------  ----------------------  --------------------  -----------   ---------
+ *          LGM_CTRANS_TIER_FULL     LGM_EPH_HIGH_ACCURACY   LGM_PN_IAU76          no            off
+ *          LGM_CTRANS_TIER_FAST     LGM_EPH_HIGH_ACCURACY   LGM_PN_IAU76_CACHED   yes           3600 s
+ *          LGM_CTRANS_TIER_FASTEST  LGM_EPH_LOW_ACCURACY    LGM_PN_IAU76_CACHED   yes           21600 s
+ *
+ *      If c is already using LGM_EPH_DE, FULL and FAST keep it. The number
+ *      of nutation terms and the EOP corrections are left alone.
+ *
+ *      Worst-case differences from LGM_CTRANS_TIER_FULL over all of the
+ *      Lgm_Convert_Coords() flags, for the three axes at GEO distance (6.61
+ *      Re), over two days at 127 s spacing, and the cost of a call stepping
+ *      through a time series at 10 s spacing (tests/bench_CTrans);
+ *
+ *          Tier                     Angle           Position at GEO   Cost
+ *          -----------------------  --------------  ---------------   ------
+ *          LGM_CTRANS_TIER_FULL     0               0                 1
+ *          LGM_CTRANS_TIER_FAST     < 2e-5 arcsec   < 3e-6 km         ~0.25
+ *          LGM_CTRANS_TIER_FASTEST  < 35 arcsec     < 7 km            ~0.2
+ *
+ *      The FASTEST error is all in the systems that depend on the Sun
+ *      direction (GSE, GSM, SM, GSE2000); between the others it is the same
+ *      as for a 21600 s slow tier (< 5e-4 arcsec). For comparison, leaving
+ *      out the EOP corrections (see Lgm_set_eop()) is a difference of ~10
+ *      arcsec (~2 km at GEO), and LGM_EPH_HIGH_ACCURACY differs from
+ *      LGM_EPH_DE by ~2 arcsec (~0.4 km at GEO) in the Sun direction. So
+ *      FAST costs nothing measurable in accuracy, and FASTEST is good enough
+ *      wherever the EOP corrections are not applied anyway.
+ *
+ *      \param[in]      Tier        LGM_CTRANS_TIER_FULL, LGM_CTRANS_TIER_FAST or LGM_CTRANS_TIER_FASTEST.
+ *      \param[in,out]  c           Lgm_CTrans structure.
+ *
+ */
+void Lgm_Set_CTrans_Tier( int Tier, Lgm_CTrans *c ) {
+
+    int     ephModel;
+
+    ephModel = ( c->ephModel == LGM_EPH_DE ) ? LGM_EPH_DE : LGM_EPH_HIGH_ACCURACY;
+
+    switch ( Tier ) {
+
+        case LGM_CTRANS_TIER_FAST:
+            Lgm_Set_CTrans_Options( ephModel, LGM_PN_IAU76_CACHED, c );
+            Lgm_Set_CTrans_EphemCache( TRUE, c );
+            Lgm_Set_CTrans_SlowTierCadence( 3600.0, c );
+            break;
+
+        case LGM_CTRANS_TIER_FASTEST:
+            Lgm_Set_CTrans_Options( LGM_EPH_LOW_ACCURACY, LGM_PN_IAU76_CACHED, c );
+            Lgm_Set_CTrans_EphemCache( TRUE, c );
+            Lgm_Set_CTrans_SlowTierCadence( 21600.0, c );
+            break;
+
+        default:
+            printf("Lgm_Set_CTrans_Tier(): Unknown tier %d, using LGM_CTRANS_TIER_FULL\n", Tier );
+        case LGM_CTRANS_TIER_FULL:
+            Lgm_Set_CTrans_Options( ephModel, LGM_PN_IAU76, c );
+            Lgm_Set_CTrans_EphemCache( FALSE, c );
+            Lgm_Set_CTrans_SlowTierCadence( 0.0, c );
+            break;
+
+    }
+
+}
+
+
+/*
+ *  Evaluate the slow tier at UTC Julian Date JD. This is just a full
+ *  (non-tiered) Lgm_Set_Coord_Transforms() on a scratch copy of c. The copy is
+ *  shallow (it shares the leap second tables and JPL ephemeris with c), which
+ *  is fine here because it is never freed and does not outlive this routine.
+ */
+static void Lgm_CTrans_SlowTierNodeEval( double JD, Lgm_CTrans_SlowTierNode *n, Lgm_CTrans *c ) {
+
+    long int    Date;
+    int         Year, Month, Day;
+    double      UT, gclat, glon;
+    Lgm_CTrans  t;
+
+    Lgm_jd_to_ymdh( JD, &Date, &Year, &Month, &Day, &UT );
+
+    t = *c;
+    t.Verbose         = FALSE;
+    t.SlowTierCadence = 0.0;
+    Lgm_Set_Coord_Transforms( Date, UT, &t );
+
+    n->JD   = t.UTC.JD;
+    n->dPsi = t.dPsi - t.ddPsi;
+    n->dEps = t.dEps - t.ddEps;
+
+    gclat = t.CD_gcolat*RadPerDeg; glon = t.CD_glon*RadPerDeg;
+    n->D.x  = cos(glon)*sin(gclat);
+    n->D.y  = sin(glon)*sin(gclat);
+    n->D.z  = cos(gclat);
+    n->M_cd = t.M_cd;
+    n->ED.x = t.ED_x0; n->ED.y = t.ED_y0; n->ED.z = t.ED_z0;
+
+    Lgm_Radec_to_Cart( t.RA_moon, t.DEC_moon, &n->Moon );
+    n->MoonJ2000         = t.MoonJ2000;
+    n->EarthMoonDistance = t.EarthMoonDistance;
+    n->MoonPhase         = t.MoonPhase;
+
+    // these are constants, but c may not have seen an Lgm_InitIGRF() call yet.
+    c->M_cd_McIllwain = t.M_cd_McIllwain;
+    c->M_cd_2010      = t.M_cd_2010;
+
+}
+
+
+/*
+ *  Make sure c->SlowTier[0] and c->SlowTier[1] bracket the current UTC and
+ *  return the interpolation weight of node 1.
+ */
+static double Lgm_CTrans_SlowTierUpdate( Lgm_CTrans *c ) {
+
+    double  dt, k, f;
+
+    dt = c->SlowTierCadence/86400.0; // days
+    k  = floor( c->UTC.JD/dt );
+
+    if ( ( c->SlowTier_nNodes < 2 ) || ( c->SlowTier_nNutationTerms != c->nNutationTerms ) || ( c->SlowTier_ephModel != c->ephModel ) ) {
+        Lgm_CTrans_SlowTierNodeEval( k*dt, &c->SlowTier[0], c );
+        Lgm_CTrans_SlowTierNodeEval( (k+1.0)*dt, &c->SlowTier[1], c );
+    } else if ( k == c->SlowTier_k + 1.0 ) {
+        c->SlowTier[0] = c->SlowTier[1];
+        Lgm_CTrans_SlowTierNodeEval( (k+1.0)*dt, &c->SlowTier[1], c );
+    } else if ( k != c->SlowTier_k ) {
+        Lgm_CTrans_SlowTierNodeEval( k*dt, &c->SlowTier[0], c );
+        Lgm_CTrans_SlowTierNodeEval( (k+1.0)*dt, &c->SlowTier[1], c );
+    }
+    c->SlowTier_nNodes         = 2;
+    c->SlowTier_k              = k;
+    c->SlowTier_nNutationTerms = c->nNutationTerms;
+    c->SlowTier_ephModel       = c->ephModel;
+
+    f = ( c->UTC.JD - c->SlowTier[0].JD )/( c->SlowTier[1].JD - c->SlowTier[0].JD );
+    return( f );
+
+}
+
+
+/*
+ *  Linearly interpolate a vector between the two nodes and renormalize it
+ *  (unless it vanishes).
+ */
+static void Lgm_CTrans_SlowTierInterpDir( double f, Lgm_Vector *u0, Lgm_Vector *u1, Lgm_Vector *u ) {
+
+    double  mag;
+
+    u->x = (1.0-f)*u0->x + f*u1->x;
+    u->y = (1.0-f)*u0->y + f*u1->y;
+    u->z = (1.0-f)*u0->z + f*u1->z;
+    mag  = Lgm_Magnitude( u );
+    if ( mag > 0.0 ) Lgm_ScaleVector( u, 1.0/mag );
+
+}
+
+
+/*
+ *  Interpolated Moon quantities (replaces Lgm_ComputeMoon() in the tiered mode).
+ */
+static void Lgm_CTrans_SlowTierMoon( double f, Lgm_CTrans *c ) {
+
+    double                  RA, Dec, r;
+    Lgm_Vector              u;
+    Lgm_CTrans_SlowTierNode *n0 = &c->SlowTier[0], *n1 = &c->SlowTier[1];
+
+    Lgm_CTrans_SlowTierInterpDir( f, &n0->Moon, &n1->Moon, &u );
+    Lgm_CartToSphCoords( &u, &Dec, &RA, &r );
+    c->RA_moon  = Lgm_angle360( RA );
+    c->DEC_moon = Dec;
+
+    Lgm_CTrans_SlowTierInterpDir( f, &n0->MoonJ2000, &n1->MoonJ2000, &c->MoonJ2000 );
+
+    c->EarthMoonDistance = (1.0-f)*n0->EarthMoonDistance + f*n1->EarthMoonDistance;
+    c->MoonPhase = ( ( n0->MoonPhase == LGM_FILL_VALUE ) || ( n1->MoonPhase == LGM_FILL_VALUE ) ) ? LGM_FILL_VALUE : (1.0-f)*n0->MoonPhase + f*n1->MoonPhase;
+
+}
+
+/**
  *   \brief
- *      This routine takes date and time and sets up all the transformation
- *      matrices to do coord transformations.
+ *      Set the time systems (UTC, UT1, TAI, TT and TDB) and the Greenwich Mean Sidereal Time in an Lgm_CTrans structure.
  *
  *   \details
- *      This routine computes many quantities required for coordinate
- *      transformations and stores them in the Lgm_CTrans structure pointed to
- *      by \a c. The date can be given as an 8-digit long int of the form
- *      YYYYMMDD or a 7-digit long int of the form YYYYDDD (Year/DayOfYear).
- *      To discriminate between these two formats, the routine assumes the
- *      following ranges of validity;
- *          - yyyyddd   (where yyyy is assumed to be between 1000 A.D. and 9999 A.D.)
- *          - yyyymmdd  (where yyyy is assumed to be between 1000 A.D. and 9999 A.D.)
+ *      This is the first part of Lgm_Set_Coord_Transforms(). Nothing else in
+ *      \a c is changed, so it can be used on its own by routines that get
+ *      the rest of the transformation state some other way (e.g.
+ *      Lgm_Set_Coord_Transforms_FromTimeline()).
  *
  *   \param[in]      date   The date represented as an 8-digit long int in the form YYYYMMDD (or a 7-digit date in the form YYYYDDD.)
  *   \param[in]      UTC    The UTC time of the day in decimal hours.
  *   \param[in,out]  c      Pointer to an Lgm_CTrans structure.
  *
- *
- *   \returns        void
- *
- *   \author         Mike Henderson
- *   \date           2013
- *
  */
-void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
+void Lgm_Set_CTrans_Times( long int date, double UTC, Lgm_CTrans *c ) {
 
     int    	    year, month, day, doy;
-    double 	    TU, gmst, gast, sn, cs, Time;
-    double 	    varep, varpi, spsi;
-    double 	    eccen, epsilon;
-    double 	    days, M, E, nu, lambnew;
-    double 	    RA, DEC;
-    double 	    gclat, glon, psi;
-    double	    g[14][14], h[14][14], Tmp[3][3];
-    double  	    varep90, varpi90;
-    double  	    Zeta, Theta, Zee;
-    double  	    SinZee, CosZee, SinZeta, CosZeta, SinTheta, CosTheta;
-    Lgm_Vector 	    S, K, Y, Z, D, Dmod, Dgsm, u_mod, u_tod, u_gei, Zgeo, X;
-    double          RA_tod, DEC_tod;
-    double          RA_gei, DEC_gei;
-    double	    sxp, cxp, syp, cyp;
-    double          sdp, cdp, se, ce, set, cet;
-    double          T_UT1, T2_UT1, T3_UT1, T_TT, T2_TT, T3_TT, T4_TT, T5_TT;
-    double          cos_epsilon, sin_epsilon, sin_lambnew, sin_b, cos_b, sin_l, tmp;
-    int 	    i, j, N;
+    double 	    Time, T_UT1, T2_UT1, T3_UT1;
 
 
     /*
@@ -459,19 +743,97 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     c->TT.Date  = Lgm_JD_to_Date( c->TT.JD, &c->TT.Year, &c->TT.Month, &c->TT.Day, &Time );
     c->TT.Time  = Lgm_hour24( c->TT.Time ); // Keep the time we had rather than gettingm it back from Lgm_JD_to_Date(). This limits roundoff error
     c->TT.T     = (c->TT.JD - 2451545.0)/36525.0;
+    Lgm_TT_to_TDB( &c->TT, &c->TDB, c );
+
+    /*
+     *  Compute Greenwich Mean Sidereal Time (gmst)
+     *  T0 = number of Julian centuries since 2000 January 1.5 to 0h on the date we are interested in.
+     *  T  = number of Julian centuries since 2000 January 1.5 to the UT on the date we are interested in.
+     *  (See Astronomical Almanac or e.g. Vallado.)
+     */
+    c->gmst = fmod( (67310.54841 + (876600.0*3600.0 + 8640184.812866)*T_UT1  + 0.093104*T2_UT1 - 6.2e-6*T3_UT1)/3600.0, 24.0);
+
+}
+
+
+/** 
+ *   \brief
+ *      This routine takes date and time and sets up all the transformation
+ *      matrices to do coord transformations.
+ *
+ *   \details
+ *      This routine computes many quantities required for coordinate
+ *      transformations and stores them in the Lgm_CTrans structure pointed to
+ *      by \a c. The date can be given as an 8-digit long int of the form
+ *      YYYYMMDD or a 7-digit long int of the form YYYYDDD (Year/DayOfYear).
+ *      To discriminate between these two formats, the routine assumes the
+ *      following ranges of validity;
+ *          - yyyyddd   (where yyyy is assumed to be between 1000 A.D. and 9999 A.D.)
+ *          - yyyymmdd  (where yyyy is assumed to be between 1000 A.D. and 9999 A.D.)
+ *
+ *      For high-cadence time series, see Lgm_Set_CTrans_SlowTierCadence()
+ *      to refresh the slowly varying quantities less often.
+ *
+ *   \param[in]      date   The date represented as an 8-digit long int in the form YYYYMMDD (or a 7-digit date in the form YYYYDDD.)
+ *   \param[in]      UTC    The UTC time of the day in decimal hours.
+ *   \param[in,out]  c      Pointer to an Lgm_CTrans structure.
+ *
+ *
+ *   \returns        void
+ *
+ *   \author         Mike Henderson
+ *   \date           2013
+ *
+ */
+static void Lgm_Set_Coord_Transforms_Body( long int date, double UTC, Lgm_CTrans *c );
+void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
+
+    LGM_PROFILE_BEGIN( LGM_PROF_CTRANS );
+    Lgm_Set_Coord_Transforms_Body( date, UTC, c );
+    LGM_PROFILE_END( LGM_PROF_CTRANS );
+
+}
+
+static void Lgm_Set_Coord_Transforms_Body( long int date, double UTC, Lgm_CTrans *c ) {
+
+    double 	    TU, gmst, gast, sn, cs;
+    double 	    varep, varpi, spsi;
+    double 	    eccen, epsilon;
+    double 	    days, M, E, nu, lambnew;
+    double 	    RA, DEC;
+    double 	    gclat, glon, psi;
+    double	    g[14][14], h[14][14], Tmp[3][3];
+    double  	    varep90, varpi90;
+    double  	    Zeta, Theta, Zee;
+    double  	    SinZee, CosZee, SinZeta, CosZeta, SinTheta, CosTheta;
+    Lgm_Vector 	    S, K, Y, Z, D, Dmod, Dgsm, u_mod, u_tod, u_gei, Zgeo, X;
+    double          RA_tod, DEC_tod;
+    double          RA_gei, DEC_gei;
+    double	    sxp, cxp, syp, cyp;
+    double          sdp, cdp, se, ce, set, cet;
+    double          T_TT, T2_TT, T3_TT, T4_TT, T5_TT;
+    double          cos_epsilon, sin_epsilon, sin_lambnew, sin_b, cos_b, sin_l, tmp;
+    double          f;
+    int 	    i, j, N, Tiered;
+    Lgm_CTrans_SlowTierNode *n0, *n1;
+
+
+    /*
+     * Set UTC, UT1, TAI, TT, TDB and gmst
+     */
+    Lgm_Set_CTrans_Times( date, UTC, c );
     T_TT        = c->TT.T;
     T2_TT       = T_TT*T_TT;
     T3_TT       = T_TT*T2_TT;
     T4_TT       = T2_TT*T2_TT;
     T5_TT       = T3_TT*T2_TT;
 
-    Lgm_TT_to_TDB( &c->TT, &c->TDB, c );
-
     /* Test here for LGM_EPH_DE - if set, make a JPLephemInfo */
     if ( ( c->ephModel == LGM_EPH_DE ) && ( !(c->jpl_initialized) ) ){
 
+        // map the file and page in records as needed; fall back to reading it all
         c->jpl = Lgm_InitJPLephemInfo( 421, LGM_DE_SUN|LGM_DE_EARTHMOON, 1);
-        Lgm_ReadJPLephem( c->jpl );
+        if ( !Lgm_OpenJPLephem( c->jpl ) ) Lgm_ReadJPLephem( c->jpl );
         c->jpl_initialized = TRUE;
 
 
@@ -484,12 +846,14 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     }
 
     /*
-     *  Compute Greenwich Mean Sidereal Time (gmst)
-     *  T0 = number of Julian centuries since 2000 January 1.5 to 0h on the date we are interested in.
-     *  T  = number of Julian centuries since 2000 January 1.5 to the UT on the date we are interested in.
-     *  (See Astronomical Almanac or e.g. Vallado.)
+     *  In the tiered mode, get the nodes that bracket this time and the
+     *  interpolation weight. See Lgm_Set_CTrans_SlowTierCadence().
      */
-    c->gmst = fmod( (67310.54841 + (876600.0*3600.0 + 8640184.812866)*T_UT1  + 0.093104*T2_UT1 - 6.2e-6*T3_UT1)/3600.0, 24.0);
+    Tiered = ( c->SlowTierCadence > 0.0 );
+    f      = ( Tiered ) ? Lgm_CTrans_SlowTierUpdate( c ) : 0.0;
+    n0     = &c->SlowTier[0];
+    n1     = &c->SlowTier[1];
+
     gmst    = c->gmst*15.0*RadPerDeg; // convert to radians for ease later on
 
 
@@ -596,7 +960,14 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     c->OmegaMoon = fmod( 125.04455501 - (5.0*360.0    + 134.1361851)*T_TT + 0.0020756*T2_TT +  2.139e-6*T3_TT, 360.0); // degrees
 
     // Get dPSi and dEps in arcsec
-    Lgm_Nutation( c->TT.T, c->nNutationTerms, &(c->dPsi), &(c->dEps) ); // does 106-term nutation series
+    if ( Tiered ) {
+        c->dPsi = (1.0-f)*n0->dPsi + f*n1->dPsi;
+        c->dEps = (1.0-f)*n0->dEps + f*n1->dEps;
+    } else if ( c->pnModel == LGM_PN_IAU76_CACHED ) {
+        Lgm_Nutation_Cached( c->TT.T, c->nNutationTerms, &(c->NutationCache), &(c->dPsi), &(c->dEps) ); // per-day fit of the same series
+    } else {
+        Lgm_Nutation( c->TT.T, c->nNutationTerms, &(c->dPsi), &(c->dEps) ); // does 106-term nutation series
+    }
     c->dPsi += c->ddPsi;    // apply EOP corrections (arcsec)
     c->dEps += c->ddEps;    // apply EOP corrections (arcsec)
     // Equation of the equinoxes EQ_Eq
@@ -728,9 +1099,19 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     N = 10;
 //    c->UTC.fYear = (double)c->year + ((double)c->doy + c->UTC/24.0)/(365.0 + (double)Lgm_LeapYear(c->year));
     c->Lgm_IGRF_FirstCall = TRUE;
-    Lgm_InitIGRF( g, h, N, 1, c );
-    gclat = c->CD_gcolat;
-    glon  = c->CD_glon;
+    if ( Tiered ) {
+        Lgm_CTrans_SlowTierInterpDir( f, &n0->D, &n1->D, &D );
+        gclat    = acos( D.z );
+        glon     = atan2( D.y, D.x );
+        c->M_cd  = (1.0-f)*n0->M_cd + f*n1->M_cd;
+        c->ED_x0 = (1.0-f)*n0->ED.x + f*n1->ED.x;
+        c->ED_y0 = (1.0-f)*n0->ED.y + f*n1->ED.y;
+        c->ED_z0 = (1.0-f)*n0->ED.z + f*n1->ED.z;
+    } else {
+        Lgm_InitIGRF( g, h, N, 1, c );
+        gclat = c->CD_gcolat;
+        glon  = c->CD_glon;
+    }
 
 
     /*
@@ -822,14 +1203,6 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     Lgm_Transpose( c->Agsm_to_gse, c->Agse_to_gsm);
 
 
-    /*  Construct transformation matrix from GSM to WGS84 and vice versa ;
-     * 	Agsm_to_wgs84 = Amod_to_wgs84 * Agsm_to_mod
-     * 	Awgs84_to_gsm = Transpose( Agsm_to_wgs84 )
-     */
-    Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, c->Agsm_to_wgs84 );
-    Lgm_Transpose( c->Agsm_to_wgs84, c->Awgs84_to_gsm );
-
-
     /*
      *  Construct Transformation Matricies between  WGS84 and MOD
      *  and between WGS84 and GEI
@@ -841,8 +1214,20 @@ void Lgm_Set_Coord_Transforms( long int date, double UTC, Lgm_CTrans *c ) {
     Lgm_Transpose( c->Awgs84_to_gei, c->Agei_to_wgs84 );
 
 
+    /*  Construct transformation matrix from GSM to WGS84 and vice versa ;
+     * 	Agsm_to_wgs84 = Amod_to_wgs84 * Agsm_to_mod
+     * 	Awgs84_to_gsm = Transpose( Agsm_to_wgs84 )
+     */
+    Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, c->Agsm_to_wgs84 );
+    Lgm_Transpose( c->Agsm_to_wgs84, c->Awgs84_to_gsm );
+
+
     /* Compute Moon RA, Dec, distance and phase */
-    Lgm_ComputeMoon( c );
+    if ( Tiered ) {
+        Lgm_CTrans_SlowTierMoon( f, c );
+    } else {
+        Lgm_ComputeMoon( c );
+    }
 
 
     if ( c->Verbose ) {
@@ -1063,7 +1448,8 @@ void Lgm_ComputeSun( Lgm_CTrans *c  ) {
 
     switch (c->ephModel) {
         case LGM_EPH_DE:
-            Lgm_JPL_getSunVector( c->TT.JD, c->jpl, &SunICRF);
+            if ( c->UseEphemCache ) Lgm_EphemCache_JPL( c->TT.JD, c->jpl, &c->EphemCache, &SunICRF, NULL );
+            else                    Lgm_JPL_getSunVector( c->TT.JD, c->jpl, &SunICRF);
             c->earth_sun_dist = Lgm_Magnitude( &SunICRF )/Re;
             Lgm_NormalizeVector(&SunICRF);
             c->SunJ2000 = SunICRF;
@@ -1082,7 +1468,8 @@ void Lgm_ComputeSun( Lgm_CTrans *c  ) {
             break;
         case LGM_EPH_HIGH_ACCURACY:
             sin_lambnew = sin(lambnew);
-            Lgm_SunPosition( c->TT.T, &l, &r, &b );
+            if ( c->UseEphemCache ) Lgm_EphemCache_SunPosition( c->TT.JD, &c->EphemCache, &l, &r, &b );
+            else                    Lgm_SunPosition( c->TT.T, &l, &r, &b );
             c->lambda_sun = l;            // high accuracy values
             c->beta_sun   = b;            // high accuracy values
             sin_b = sin(b); cos_b = cos(b); sin_l = sin(l);
@@ -1144,7 +1531,8 @@ void Lgm_ComputeMoon( Lgm_CTrans *c ) {
     switch (ephModel) {
         case LGM_EPH_DE:
             /* Compute Right Ascension and Declination of the Moon */
-            Lgm_JPLephem_position( JD, LGM_DE_MOON, c->jpl, &MoonGCRF );
+            if ( c->UseEphemCache ) Lgm_EphemCache_JPL( JD, c->jpl, &c->EphemCache, NULL, &MoonGCRF );
+            else                    Lgm_JPLephem_position( JD, LGM_DE_MOON, c->jpl, &MoonGCRF );
             c->MoonJ2000 = MoonGCRF; // mgh - should this be GCRF or ICRF?
             Lgm_NormalizeVector( &(c->MoonJ2000) );
             Lgm_Convert_Coords( &MoonGCRF, &Moonmod, GEI2000_TO_MOD, c );        
@@ -1450,6 +1838,169 @@ void Lgm_Convert_Coords( Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c )
 }
 
 
+/**
+ *  \brief
+ *      Get the single (affine) transformation that Lgm_Convert_Coords() applies for a given flag.
+ *
+ *  \details
+ *      Lgm_Convert_Coords() goes through MOD and may apply up to six matrix
+ *      products per vector. For a fixed Lgm_CTrans state the whole chain is
+ *      just v = A u + b, where b is zero except for conversions into or out of
+ *      EDMAG (the eccentric dipole offset). This routine composes the chain
+ *      by pushing the origin and the three basis vectors through
+ *      Lgm_Convert_Coords(), so it always agrees with it.
+ *
+ *      The matrix is in the same layout as the other matrices in Lgm_CTrans
+ *      (i.e. it can be used directly with Lgm_MatTimesVec()).
+ *
+ *      \param[in]      flag    Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[out]     A       The composed 3x3 transformation matrix.
+ *      \param[out]     b       The offset vector (in the output system).
+ *      \param[in,out]  c       Lgm_CTrans structure set up by Lgm_Set_Coord_Transforms().
+ *
+ */
+void Lgm_Convert_Coords_Matrix( int flag, double A[3][3], Lgm_Vector *b, Lgm_CTrans *c ) {
+
+    Lgm_Vector  u, v;
+    int         j;
+
+    u.x = u.y = u.z = 0.0;
+    Lgm_Convert_Coords( &u, b, flag, c );
+
+    for ( j=0; j<3; ++j ) {
+        u.x = ( j == 0 ) ? 1.0 : 0.0;
+        u.y = ( j == 1 ) ? 1.0 : 0.0;
+        u.z = ( j == 2 ) ? 1.0 : 0.0;
+        Lgm_Convert_Coords( &u, &v, flag, c );
+        A[j][0] = v.x - b->x;
+        A[j][1] = v.y - b->y;
+        A[j][2] = v.z - b->z;
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Transform an array of vectors from one coordinate system to another.
+ *
+ *  \details
+ *      Same as calling Lgm_Convert_Coords() on each of the n vectors, but the
+ *      transformation chain is composed into one matrix (and offset) once,
+ *      see Lgm_Convert_Coords_Matrix(), and then applied in a tight loop.
+ *      The output array may be the same as the input array.
+ *
+ *      \param[in]      n       Number of vectors.
+ *      \param[in]      u       Array of n input vectors.
+ *      \param[out]     v       Array of n output vectors.
+ *      \param[in]      flag    Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[in,out]  c       Lgm_CTrans structure set up by Lgm_Set_Coord_Transforms().
+ *
+ */
+void Lgm_Convert_Coords_Array( long int n, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c ) {
+
+    long int    i;
+    double      A[3][3], x, y, z;
+    double      a00, a01, a02, a10, a11, a12, a20, a21, a22, bx, by, bz;
+    Lgm_Vector  b;
+
+    Lgm_Convert_Coords_Matrix( flag, A, &b, c );
+    a00 = A[0][0]; a01 = A[0][1]; a02 = A[0][2];
+    a10 = A[1][0]; a11 = A[1][1]; a12 = A[1][2];
+    a20 = A[2][0]; a21 = A[2][1]; a22 = A[2][2];
+    bx  = b.x; by = b.y; bz = b.z;
+
+    for ( i=0; i<n; ++i ) {
+        x = u[i].x; y = u[i].y; z = u[i].z;
+        v[i].x = a00*x + a10*y + a20*z + bx;
+        v[i].y = a01*x + a11*y + a21*z + by;
+        v[i].z = a02*x + a12*y + a22*z + bz;
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Transform vectors given as separate x, y and z arrays from one coordinate system to another.
+ *
+ *  \details
+ *      Structure-of-arrays version of Lgm_Convert_Coords_Array() (the same
+ *      layout as Lgm_B_igrf_Batch() uses). Each output component is one
+ *      unit-stride loop over the input arrays, which the compiler can
+ *      vectorize. The output arrays may be the same as the input arrays.
+ *
+ *      \param[in]      n           Number of vectors.
+ *      \param[in]      x, y, z     Components of the n input vectors.
+ *      \param[out]     xo, yo, zo  Components of the n output vectors.
+ *      \param[in]      flag        Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[in,out]  c           Lgm_CTrans structure set up by Lgm_Set_Coord_Transforms().
+ *
+ */
+void Lgm_Convert_Coords_SoA( long int n, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo, int flag, Lgm_CTrans *c ) {
+
+    long int    i;
+    double      A[3][3];
+    Lgm_Vector  b;
+
+    Lgm_Convert_Coords_Matrix( flag, A, &b, c );
+    Lgm_MatTimesVec_SoA( n, A, x, y, z, xo, yo, zo );
+
+    // Most conversions have no offset.
+    if ( ( b.x != 0.0 ) || ( b.y != 0.0 ) || ( b.z != 0.0 ) ) {
+        for ( i=0; i<n; ++i ) {
+            xo[i] += b.x; yo[i] += b.y; zo[i] += b.z;
+        }
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Transform a time series of vectors (one time per vector) from one coordinate system to another.
+ *
+ *  \details
+ *      For each sample, c is set up for Date[i]/UTC[i] with
+ *      Lgm_Set_Coord_Transforms() and the vector converted with the composed
+ *      transformation (see Lgm_Convert_Coords_Matrix()). The set up is only
+ *      redone when the time changes, so runs of samples at the same time
+ *      (e.g. a grid at one epoch) cost one set up.
+ *
+ *      For high-cadence series, set a refresh cadence with
+ *      Lgm_Set_CTrans_SlowTierCadence() first. The slowly varying
+ *      quantities are then interpolated between refresh nodes for each
+ *      sample instead of being evaluated from scratch (see that routine for
+ *      the error bounds). On return c is left set up for the last sample.
+ *
+ *      \param[in]      n       Number of samples.
+ *      \param[in]      Date    Array of n dates (YYYYMMDD or YYYYDDD).
+ *      \param[in]      UTC     Array of n UTC times (decimal hours).
+ *      \param[in]      u       Array of n input vectors.
+ *      \param[out]     v       Array of n output vectors (may be the same as u).
+ *      \param[in]      flag    Conversion flag (e.g. GSM_TO_WGS84). See Lgm_Convert_Coords().
+ *      \param[in,out]  c       Lgm_CTrans structure.
+ *
+ */
+void Lgm_Convert_Coords_TimeSeries( long int n, long int *Date, double *UTC, Lgm_Vector *u, Lgm_Vector *v, int flag, Lgm_CTrans *c ) {
+
+    long int    i, OldDate = -1;
+    double      A[3][3], OldUTC = LGM_FILL_VALUE;
+    Lgm_Vector  b, w;
+
+    for ( i=0; i<n; ++i ) {
+        if ( ( Date[i] != OldDate ) || ( UTC[i] != OldUTC ) ) {
+            Lgm_Set_Coord_Transforms( Date[i], UTC[i], c );
+            Lgm_Convert_Coords_Matrix( flag, A, &b, c );
+            OldDate = Date[i]; OldUTC = UTC[i];
+        }
+        Lgm_MatTimesVec( A, &u[i], &w );
+        v[i].x = w.x + b.x; v[i].y = w.y + b.y; v[i].z = w.z + b.z;
+    }
+
+}
+
+
 /*
  * Input:
  *          GeodLat:    in degrees
@@ -1543,6 +2094,127 @@ void Lgm_WGS84_to_GeodHeight( Lgm_Vector *uin, double *GeodHeight ) {
 }
 
 
+#if USE_OPENMP
+#define LGM_GEOD_SIMD   _Pragma( "omp simd" )
+#else
+#define LGM_GEOD_SIMD
+#endif
+
+/*
+ *  The closed form of Lgm_WGS84_to_GEOD() for point i of x, y, z (in Re),
+ *  with the Lgm_SimdMath.h versions of sqrt() and pow( , 1/3) so that it
+ *  vectorizes. Gives r, U, V and zo.
+ */
+#define LGM_WGS84_TO_GEOD_KERNEL \
+        double  ux = x[i]*WGS84_A, uy = y[i]*WGS84_A, uz = z[i]*WGS84_A;                         \
+        double  r, r2, z2, F, G, G2, G3, c, s, tt, tt2, P, Q, ro, U, V, zo;                      \
+        r2 = ux*ux + uy*uy;                                                                      \
+        r  = Lgm_SimdSqrt( r2 );                                                                 \
+        z2 = uz*uz;                                                                              \
+        F  = 54.0*WGS84_B2*z2;                                                                   \
+        G  = r2 + WGS84_1mE2*z2 - WGS84_E2*WGS84_A2mB2;                                          \
+        G2 = G*G; G3 = G2*G;                                                                     \
+        c  = (WGS84_E4*F*r2)/G3;                                                                 \
+        s  = Lgm_SimdCbrt( 1.0 + c + Lgm_SimdSqrt( c*c + 2.0*c ) );                              \
+        tt = s + 1.0/s + 1.0; tt2 = tt*tt;                                                       \
+        P  = F/( 3.0*tt2*G2 );                                                                   \
+        Q  = Lgm_SimdSqrt( 1.0 + 2.0*WGS84_E4*P );                                               \
+        ro = -(WGS84_E2*P*r)/(1.0+Q) + Lgm_SimdSqrt( (0.5*WGS84_A2)*(1.0+1.0/Q) - (WGS84_1mE2*P*z2)/(Q*(1.0+Q)) - 0.5*P*r2 ); \
+        tt = (r - WGS84_E2*ro); tt2 = tt*tt;                                                     \
+        U  = Lgm_SimdSqrt( tt2 + z2 );                                                           \
+        V  = Lgm_SimdSqrt( tt2 + WGS84_1mE2*z2 );                                                \
+        zo = (WGS84_B2*uz)/(WGS84_A*V);
+
+/**
+ *  \brief
+ *      Lgm_WGS84_to_GEOD() for n points at once.
+ *
+ *  \details
+ *      The points come in (and go out) as separate arrays of coordinates, so
+ *      that the loop vectorizes; the sqrt(), pow(), atan() and atan2() calls
+ *      are done with the inline versions in Lgm_SimdMath.h. Compared with
+ *      Lgm_WGS84_to_GEOD() the heights agree to well under a micron and the
+ *      latitudes and longitudes to ~1e-12 deg (from the ground out to
+ *      lunar distances), far inside the mm / microdegree that anything
+ *      here needs. Points on the polar axis give a longitude of 0 (atan2(0,0)),
+ *      as does the scalar version.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x, y, z     WGS84 (i.e. GEO) coordinates of the points, in Re.
+ *      \param[out]     GeodLat     Geodetic latitudes, in degrees.
+ *      \param[out]     GeodLong    Geodetic longitudes, in degrees.
+ *      \param[out]     GeodHeight  Geodetic heights, in km.
+ */
+void Lgm_WGS84_to_GEOD_Array( long int n, double *x, double *y, double *z, double *GeodLat, double *GeodLong, double *GeodHeight ) {
+
+    long int    i;
+
+    LGM_GEOD_SIMD
+    for ( i=0; i<n; i++ ) {
+        LGM_WGS84_TO_GEOD_KERNEL
+        GeodLat[i]    = DegPerRad*Lgm_SimdAtan2( uz + WGS84_EP2*zo, r );
+        GeodLong[i]   = DegPerRad*Lgm_SimdAtan2( uy, ux );
+        GeodHeight[i] = U*( 1.0 - WGS84_B2/(WGS84_A*V) );
+    }
+
+}
+
+/**
+ *  \brief
+ *      Lgm_WGS84_to_GeodHeight() for n points at once (see Lgm_WGS84_to_GEOD_Array()).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x, y, z     WGS84 (i.e. GEO) coordinates of the points, in Re.
+ *      \param[out]     GeodHeight  Geodetic heights, in km.
+ */
+void Lgm_WGS84_to_GeodHeight_Array( long int n, double *x, double *y, double *z, double *GeodHeight ) {
+
+    long int    i;
+
+    LGM_GEOD_SIMD
+    for ( i=0; i<n; i++ ) {
+        LGM_WGS84_TO_GEOD_KERNEL
+        (void)zo;
+        GeodHeight[i] = U*( 1.0 - WGS84_B2/(WGS84_A*V) );
+    }
+
+}
+
+/**
+ *  \brief
+ *      Lgm_GEOD_to_WGS84() for n points at once.
+ *
+ *  \details
+ *      As for Lgm_WGS84_to_GEOD_Array(), the sin() and cos() calls are done
+ *      with Lgm_SimdSinCos(); the positions agree with Lgm_GEOD_to_WGS84() to
+ *      a few parts in 1e16.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      GeodLat     Geodetic latitudes, in degrees.
+ *      \param[in]      GeodLong    Geodetic longitudes, in degrees.
+ *      \param[in]      GeodHeight  Geodetic heights, in km.
+ *      \param[out]     x, y, z     WGS84 (i.e. GEO) coordinates of the points, in Re.
+ */
+void Lgm_GEOD_to_WGS84_Array( long int n, double *GeodLat, double *GeodLong, double *GeodHeight, double *x, double *y, double *z ) {
+
+    long int    i;
+
+    LGM_GEOD_SIMD
+    for ( i=0; i<n; i++ ) {
+        double  CosPhi, SinPhi, CosLam, SinLam, Chi, h = GeodHeight[i];
+
+        Lgm_SimdSinCos( GeodLat[i]*RadPerDeg, &SinLam, &CosLam );
+        Lgm_SimdSinCos( GeodLong[i]*RadPerDeg, &SinPhi, &CosPhi );
+        Chi = Lgm_SimdSqrt( 1.0 - WGS84_E2*SinLam*SinLam );
+
+        x[i] = (WGS84_A/Chi + h)*CosLam*CosPhi/WGS84_A;
+        y[i] = (WGS84_A/Chi + h)*CosLam*SinPhi/WGS84_A;
+        z[i] = (WGS84_A*(1.0-WGS84_E2)/Chi + h)*SinLam/WGS84_A;
+    }
+
+}
+
+
 
 /*
  *  These rotuines are included here, just because its trivial
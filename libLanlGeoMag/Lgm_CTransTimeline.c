@@ -0,0 +1,542 @@
+/*! \file Lgm_CTransTimeline.c
+ *
+ *  \brief Quaternion-interpolated timeline of the coordinate transformations.
+ *
+ *  \details
+ *      For long, high-cadence time series even a tiered
+ *      Lgm_Set_Coord_Transforms() (see Lgm_Set_CTrans_SlowTierCadence()) does
+ *      more work per sample than is needed. The rotations involved change
+ *      smoothly, so a timeline keeps them as quaternions on a coarse grid of
+ *      nodes (each evaluated exactly) and Lgm_Set_Coord_Transforms_FromTimeline()
+ *      rebuilds the Lgm_CTrans state at any time in between in O(1) by SLERP or
+ *      SQUAD.
+ *
+ *      Earth rotation is not interpolated. The time systems and gmst are set
+ *      exactly (Lgm_Set_CTrans_Times()), and TOD <-> PEF and TEME <-> PEF are
+ *      built from gmst/gast directly (that is cheaper than a slerp). The
+ *      rotations that are interpolated are GEI2000 -> MOD (precession), MOD ->
+ *      TOD (nutation), PEF -> WGS84 (polar motion), MOD -> GSE and GEI2000 ->
+ *      GSE2000. Scalars (nutation angles, Sun and Moon distances, the dipole
+ *      moment etc.) are interpolated linearly, and directions (dipole axis,
+ *      Moon) as renormalized vectors.
+ *
+ *      The systems tied to the dipole (GSM, SM, CDMAG) are not interpolated
+ *      either. They turn with the Earth, so their rotations are far from
+ *      uniform (a slerp of MOD -> GSM at a 10 minute spacing is only good to
+ *      about 4e-5), but they are fixed by two slowly varying directions (the
+ *      Sun and the dipole axis in WGS84) and Earth rotation. So they are
+ *      rebuilt from those with the same cross products that
+ *      Lgm_Set_Coord_Transforms() uses, which is both cheaper and exact to
+ *      within the interpolation error of the two directions.
+ *
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_Quat.h"
+
+
+/*
+ *  Reduce an angle to [0, Period).
+ */
+static double Lgm_CTL_Wrap( double a, double Period ) {
+    a = fmod( a, Period );
+    return( ( a < 0.0 ) ? a + Period : a );
+}
+
+
+/*
+ *  Linear interpolation of an angle with the given period, taking the short
+ *  way around. The node values are in [0, Period), and so is the result.
+ */
+static double Lgm_CTL_InterpAngle( double h, double a0, double a1, double Period ) {
+
+    double  d, a;
+
+    d = a1 - a0;
+    if ( d >  0.5*Period ) d -= Period;
+    if ( d < -0.5*Period ) d += Period;
+    a = a0 + h*d;
+    if ( a < 0.0 ) a += Period;
+    else if ( a >= Period ) a -= Period;
+
+    return( a );
+
+}
+
+
+/*
+ *  Linearly interpolate a direction and renormalize it (unless it vanishes).
+ */
+static void Lgm_CTL_InterpDir( double h, Lgm_Vector *u0, Lgm_Vector *u1, Lgm_Vector *u ) {
+
+    double  mag;
+
+    u->x = (1.0-h)*u0->x + h*u1->x;
+    u->y = (1.0-h)*u0->y + h*u1->y;
+    u->z = (1.0-h)*u0->z + h*u1->z;
+    mag  = Lgm_Magnitude( u );
+    if ( mag > 0.0 ) Lgm_ScaleVector( u, 1.0/mag );
+
+}
+
+
+/*
+ *  Q = Q0 exp( h W ), i.e. a slerp from Q0 towards the next node with the log
+ *  precomputed (W = log( Q0^-1 Q1 )). Only one sin/cos per call, and none at
+ *  all for the small steps that are typical here (below 1e-2 rad the series
+ *  are good to well under 1e-16).
+ */
+static void Lgm_CTL_SlerpW( double Q0[4], double W[3], double h, double Q[4] ) {
+
+    double  Theta2, Theta, x, x2, s, E[4];
+
+    Theta2 = W[0]*W[0] + W[1]*W[1] + W[2]*W[2];
+    if ( Theta2 > 0.0 ) {
+        x2 = h*h*Theta2;
+        if ( x2 < 1e-4 ) {
+            s    = h*( 1.0 - x2/6.0*( 1.0 - x2/20.0*( 1.0 - x2/42.0 ) ) );
+            E[3] = 1.0 - x2/2.0*( 1.0 - x2/12.0*( 1.0 - x2/30.0 ) );
+        } else {
+            Theta = sqrt( Theta2 );
+            x     = h*Theta;
+            s     = sin( x )/Theta;
+            E[3]  = cos( x );
+        }
+        E[0] = s*W[0]; E[1] = s*W[1]; E[2] = s*W[2];
+        Lgm_QuatMultiply( Q0, E, Q );
+    } else {
+        Q[0] = Q0[0]; Q[1] = Q0[1]; Q[2] = Q0[2]; Q[3] = Q0[3];
+    }
+
+}
+
+
+/*
+ *  Q = slerp( A, B, h ), for the nearby A and B of the SQUAD step. The same as
+ *  Lgm_QuatSlerp(), but with the log done by a series when the angle between A
+ *  and B is small.
+ */
+static void Lgm_CTL_Slerp( double A[4], double B[4], double h, double Q[4] ) {
+
+    double  Ainv[4], R[4], s2, s, f, W[3];
+
+    Lgm_QuatInverse( A, Ainv );
+    Lgm_QuatMultiply( Ainv, B, R );
+    s2 = R[0]*R[0] + R[1]*R[1] + R[2]*R[2];
+    if ( ( s2 < 1e-4 ) && ( R[3] > 0.0 ) ) {
+        f = 1.0 + s2*( 1.0/6.0 + s2*( 3.0/40.0 + s2*5.0/112.0 ) ); // asin(s)/s
+    } else {
+        s = sqrt( s2 );
+        f = ( s > 0.0 ) ? atan2( s, R[3] )/s : 0.0;
+    }
+    W[0] = f*R[0]; W[1] = f*R[1]; W[2] = f*R[2];
+    Lgm_CTL_SlerpW( A, W, h, Q );
+
+}
+
+
+/*
+ *  W = log( Q0^-1 Q1 ) (the vector part)
+ */
+static void Lgm_CTL_LogStep( double Q0[4], double Q1[4], double W[3] ) {
+
+    double  Q0inv[4], A[4], logA[4];
+
+    Lgm_QuatInverse( Q0, Q0inv );
+    Lgm_QuatMultiply( Q0inv, Q1, A );
+    Lgm_QuatLog( A, logA );
+    W[0] = logA[0]; W[1] = logA[1]; W[2] = logA[2];
+
+}
+
+
+/*
+ *  Evaluate one node exactly (t is a scratch Lgm_CTrans).
+ */
+static void Lgm_CTL_NodeEval( double JD, Lgm_CTransTimelineNode *n, Lgm_CTrans *t ) {
+
+    long int    Date;
+    int         Year, Month, Day;
+    double      UT, gclat, glon;
+
+    Lgm_jd_to_ymdh( JD, &Date, &Year, &Month, &Day, &UT );
+    Lgm_Set_Coord_Transforms( Date, UT, t );
+
+    n->JD = t->UTC.JD;
+
+    Lgm_MatrixToQuat( t->Agei_to_mod,     n->Q[LGM_CTL_GEI_TO_MOD] );
+    Lgm_MatrixToQuat( t->Amod_to_tod,     n->Q[LGM_CTL_MOD_TO_TOD] );
+    Lgm_MatrixToQuat( t->Apef_to_wgs84,   n->Q[LGM_CTL_PEF_TO_WGS84] );
+    Lgm_MatrixToQuat( t->Amod_to_gse,     n->Q[LGM_CTL_MOD_TO_GSE] );
+    Lgm_MatrixToQuat( t->Agei_to_gse2000, n->Q[LGM_CTL_GEI_TO_GSE2000] );
+
+    n->EQ_Eq          = t->EQ_Eq;
+    n->dPsi           = t->dPsi;
+    n->dEps           = t->dEps;
+    n->epsilon        = t->epsilon;
+    n->epsilon_true   = t->epsilon_true;
+    n->OmegaMoon      = Lgm_CTL_Wrap( t->OmegaMoon, 360.0 );
+    n->Zeta           = t->Zeta;
+    n->Zee            = t->Zee;
+    n->Theta          = t->Theta;
+    n->eccentricity   = t->eccentricity;
+    n->mean_anomaly   = Lgm_CTL_Wrap( t->mean_anomaly, M_2PI );
+    n->true_anomaly   = Lgm_CTL_Wrap( t->true_anomaly, M_2PI );
+    n->lambda_sun     = Lgm_CTL_Wrap( t->lambda_sun, M_2PI );
+    n->beta_sun       = t->beta_sun;
+    n->earth_sun_dist = t->earth_sun_dist;
+
+    gclat = t->CD_gcolat*RadPerDeg; glon = t->CD_glon*RadPerDeg;
+    n->D.x  = cos(glon)*sin(gclat);
+    n->D.y  = sin(glon)*sin(gclat);
+    n->D.z  = cos(gclat);
+    n->M_cd = t->M_cd;
+    n->ED.x = t->ED_x0; n->ED.y = t->ED_y0; n->ED.z = t->ED_z0;
+
+    Lgm_Radec_to_Cart( t->RA_moon, t->DEC_moon, &n->Moon );
+    n->MoonJ2000         = t->MoonJ2000;
+    n->EarthMoonDistance = t->EarthMoonDistance;
+    n->MoonPhase         = t->MoonPhase;
+
+}
+
+
+/**
+ *  \brief
+ *      Build a timeline of the coordinate transformations over a time range.
+ *
+ *  \details
+ *      Nodes are placed every Spacing seconds from (just before) the start
+ *      time to (just after) the end time, with one extra node on each side
+ *      so that SQUAD can be used over the whole range. Each node is a full
+ *      Lgm_Set_Coord_Transforms() evaluation on a copy of \a c, so all of the
+ *      options in \a c (ephemeris model, nutation terms, EOP values, IGRF
+ *      settings) carry over. The tiered update is not used for the nodes.
+ *
+ *      SLERP errors grow as the square of the spacing and SQUAD's roughly as
+ *      the cube. Compared with Lgm_Set_Coord_Transforms() over several days,
+ *      the largest matrix element errors (in GSM -> WGS84, which is the worst
+ *      of them, mostly through the Sun direction) are:
+ *
+ *          Spacing     SLERP       SQUAD
+ *          10 min      6e-11       1e-11
+ *          1 h         2e-9        3e-11
+ *          3 h         2e-8        3e-10
+ *
+ *      The Moon direction is only interpolated linearly (about 4e-5 deg at
+ *      a 1 hour spacing). SLERP is the cheaper of the two per call, and at a 1
+ *      hour spacing is already well below the accuracy of the underlying
+ *      models.
+ *
+ *      \param[in]      StartDate   Start date (YYYYMMDD or YYYYDDD).
+ *      \param[in]      StartUTC    Start UTC (decimal hours).
+ *      \param[in]      EndDate     End date (YYYYMMDD or YYYYDDD).
+ *      \param[in]      EndUTC      End UTC (decimal hours).
+ *      \param[in]      Spacing     Node spacing in seconds.
+ *      \param[in]      Method      LGM_CTRANS_TIMELINE_SLERP or LGM_CTRANS_TIMELINE_SQUAD.
+ *      \param[in]      c           Lgm_CTrans structure holding the options to use (it is not changed).
+ *
+ *      \return         A pointer to the new timeline (free with
+ *                      Lgm_CTransTimeline_Free()), or NULL on bad input.
+ *
+ */
+Lgm_CTransTimeline *Lgm_CTransTimeline_Create( long int StartDate, double StartUTC, long int EndDate, double EndUTC, double Spacing, int Method, Lgm_CTrans *c ) {
+
+    Lgm_CTransTimeline      *tl;
+    Lgm_CTransTimelineNode  *Node;
+    Lgm_CTrans              *t;
+    double                  JD_start, JD_end, dJD, k0, k1;
+    long int                i, n;
+    int                     k;
+
+    JD_start = Lgm_Date_to_JD( StartDate, StartUTC, c );
+    JD_end   = Lgm_Date_to_JD( EndDate, EndUTC, c );
+    if ( ( Spacing <= 0.0 ) || ( JD_end < JD_start ) ) {
+        printf("Lgm_CTransTimeline_Create: Bad input (Spacing = %g s, start JD = %.8lf, end JD = %.8lf)\n", Spacing, JD_start, JD_end );
+        return( NULL );
+    }
+
+    /*
+     *  Nodes on the grid k*dJD, from one node before the start to one node
+     *  after the end.
+     */
+    dJD = Spacing/86400.0;
+    k0  = floor( JD_start/dJD ) - 1.0;
+    k1  = ceil( JD_end/dJD ) + 1.0;
+    n   = (long int)( k1 - k0 + 0.5 ) + 1;
+
+    tl = (Lgm_CTransTimeline *)calloc( 1, sizeof(Lgm_CTransTimeline) );
+    tl->Node   = (Lgm_CTransTimelineNode *)calloc( n, sizeof(Lgm_CTransTimelineNode) );
+    tl->n      = n;
+    tl->JD0    = k0*dJD;
+    tl->dJD    = dJD;
+    tl->Method = ( Method == LGM_CTRANS_TIMELINE_SQUAD ) ? LGM_CTRANS_TIMELINE_SQUAD : LGM_CTRANS_TIMELINE_SLERP;
+    Node = tl->Node;
+
+    /*
+     *  Evaluate the nodes on a copy of c. If the copy shares c's JPL
+     *  ephemeris, make sure freeing the copy doesnt free it.
+     */
+    t = Lgm_CopyCTrans( c );
+    t->Verbose         = FALSE;
+    t->SlowTierCadence = 0.0;
+    for ( i=0; i<n; ++i ) {
+        Lgm_CTL_NodeEval( (k0+(double)i)*dJD, &Node[i], t );
+
+        // keep the quaternions in one hemisphere so that the slerps take the short way
+        if ( i > 0 ) {
+            for ( k=0; k<LGM_CTL_NQUAT; ++k ) {
+                if ( Node[i].Q[k][0]*Node[i-1].Q[k][0] + Node[i].Q[k][1]*Node[i-1].Q[k][1] + Node[i].Q[k][2]*Node[i-1].Q[k][2] + Node[i].Q[k][3]*Node[i-1].Q[k][3] < 0.0 ) {
+                    Lgm_QuatScale( Node[i].Q[k], -1.0 );
+                }
+            }
+        }
+    }
+    tl->M_cd_McIllwain = t->M_cd_McIllwain;
+    tl->M_cd_2010      = t->M_cd_2010;
+    Lgm_free_ctrans( t );
+
+    /*
+     *  SQUAD auxiliary points (the end nodes just use the node itself) and
+     *  the per-interval logs.
+     */
+    for ( k=0; k<LGM_CTL_NQUAT; ++k ) {
+        for ( i=0; i<n; ++i ) {
+            if ( ( i == 0 ) || ( i == n-1 ) ) {
+                Node[i].S[k][0] = Node[i].Q[k][0]; Node[i].S[k][1] = Node[i].Q[k][1];
+                Node[i].S[k][2] = Node[i].Q[k][2]; Node[i].S[k][3] = Node[i].Q[k][3];
+            } else {
+                Lgm_QuatSquadComputeAuxPoint( Node[i-1].Q[k], Node[i].Q[k], Node[i+1].Q[k], Node[i].S[k] );
+            }
+        }
+        for ( i=0; i<n-1; ++i ) {
+            Lgm_CTL_LogStep( Node[i].Q[k], Node[i+1].Q[k], Node[i].W[k] );
+            Lgm_CTL_LogStep( Node[i].S[k], Node[i+1].S[k], Node[i].WS[k] );
+        }
+    }
+
+    return( tl );
+
+}
+
+
+/**
+ *  \brief
+ *      Free a timeline made by Lgm_CTransTimeline_Create().
+ */
+void Lgm_CTransTimeline_Free( Lgm_CTransTimeline *tl ) {
+    if ( tl == NULL ) return;
+    free( tl->Node );
+    free( tl );
+}
+
+
+/**
+ *  \brief
+ *      Set up an Lgm_CTrans structure for a given time from a timeline.
+ *
+ *  \details
+ *      This is a fast stand-in for Lgm_Set_Coord_Transforms(). The time
+ *      systems and Earth rotation are set exactly, and the rest of the state
+ *      is rebuilt from the two timeline nodes that bracket the time (see
+ *      Lgm_CTransTimeline_Create() for the accuracy). The cost does not
+ *      depend on where in the timeline the time falls.
+ *
+ *      If the time is outside the timeline, c is set up with
+ *      Lgm_Set_Coord_Transforms() instead and FALSE is returned.
+ *
+ *      \param[in]      Date    Date (YYYYMMDD or YYYYDDD).
+ *      \param[in]      UTC     UTC (decimal hours).
+ *      \param[in]      tl      Timeline from Lgm_CTransTimeline_Create().
+ *      \param[in,out]  c       Lgm_CTrans structure to set up (it should have the same options the timeline was made with).
+ *
+ *      \return         TRUE if the state came from the timeline, FALSE otherwise.
+ *
+ */
+int Lgm_Set_Coord_Transforms_FromTimeline( long int Date, double UTC, Lgm_CTransTimeline *tl, Lgm_CTrans *c ) {
+
+    long int                i;
+    int                     k;
+    double                  x, h, hh, gmst, gast, sn, cs, epsilon, spsi;
+    double                  Q[4], A[4], B[4], Tmp[3][3], R[LGM_CTL_NQUAT][3][3];
+    Lgm_Vector              D, Dmod, Dgsm, X, Y, Z, Zgeo, u;
+    Lgm_CTransTimelineNode  *n0, *n1;
+
+    Lgm_Set_CTrans_Times( Date, UTC, c );
+
+    x = ( c->UTC.JD - tl->JD0 )/tl->dJD;
+    i = (long int)floor( x );
+    if ( i == tl->n-1 ) --i; // right on the last node
+    if ( ( x < 0.0 ) || ( i < 0 ) || ( i > tl->n-2 ) ) {
+        if ( c->Verbose ) printf("Lgm_Set_Coord_Transforms_FromTimeline: time (JD = %.8lf) is outside the timeline. Using Lgm_Set_Coord_Transforms()\n", c->UTC.JD );
+        Lgm_Set_Coord_Transforms( Date, UTC, c );
+        return( FALSE );
+    }
+    n0 = &tl->Node[i];
+    n1 = &tl->Node[i+1];
+    h  = ( c->UTC.JD - n0->JD )/( n1->JD - n0->JD );
+
+
+    /*
+     *  Interpolated rotations
+     */
+    hh = 2.0*h*(1.0-h);
+    for ( k=0; k<LGM_CTL_NQUAT; ++k ) {
+        if ( tl->Method == LGM_CTRANS_TIMELINE_SQUAD ) {
+            Lgm_CTL_SlerpW( n0->Q[k], n0->W[k],  h, A );
+            Lgm_CTL_SlerpW( n0->S[k], n0->WS[k], h, B );
+            Lgm_CTL_Slerp( A, B, hh, Q );
+        } else {
+            Lgm_CTL_SlerpW( n0->Q[k], n0->W[k], h, Q );
+        }
+        Lgm_NormalizeQuat( Q );
+        Lgm_Quat_To_Matrix( Q, R[k] );
+    }
+    memcpy( c->Agei_to_mod,     R[LGM_CTL_GEI_TO_MOD],     sizeof(Tmp) );
+    memcpy( c->Amod_to_tod,     R[LGM_CTL_MOD_TO_TOD],     sizeof(Tmp) );
+    memcpy( c->Apef_to_wgs84,   R[LGM_CTL_PEF_TO_WGS84],   sizeof(Tmp) );
+    memcpy( c->Amod_to_gse,     R[LGM_CTL_MOD_TO_GSE],     sizeof(Tmp) );
+    memcpy( c->Agei_to_gse2000, R[LGM_CTL_GEI_TO_GSE2000], sizeof(Tmp) );
+    Lgm_Transpose( c->Agei_to_mod,     c->Amod_to_gei );
+    Lgm_Transpose( c->Amod_to_tod,     c->Atod_to_mod );
+    Lgm_Transpose( c->Apef_to_wgs84,   c->Awgs84_to_pef );
+    Lgm_Transpose( c->Amod_to_gse,     c->Agse_to_mod );
+    Lgm_Transpose( c->Agei_to_gse2000, c->Agse2000_to_gei );
+
+
+    /*
+     *  Interpolated scalars
+     */
+    c->EQ_Eq          = (1.0-h)*n0->EQ_Eq          + h*n1->EQ_Eq;
+    c->dPsi           = (1.0-h)*n0->dPsi           + h*n1->dPsi;
+    c->dEps           = (1.0-h)*n0->dEps           + h*n1->dEps;
+    c->epsilon        = (1.0-h)*n0->epsilon        + h*n1->epsilon;
+    c->epsilon_true   = (1.0-h)*n0->epsilon_true   + h*n1->epsilon_true;
+    c->Zeta           = (1.0-h)*n0->Zeta           + h*n1->Zeta;
+    c->Zee            = (1.0-h)*n0->Zee            + h*n1->Zee;
+    c->Theta          = (1.0-h)*n0->Theta          + h*n1->Theta;
+    c->eccentricity   = (1.0-h)*n0->eccentricity   + h*n1->eccentricity;
+    c->beta_sun       = (1.0-h)*n0->beta_sun       + h*n1->beta_sun;
+    c->earth_sun_dist = (1.0-h)*n0->earth_sun_dist + h*n1->earth_sun_dist;
+    c->OmegaMoon      = Lgm_CTL_InterpAngle( h, n0->OmegaMoon,    n1->OmegaMoon,    360.0 );
+    c->mean_anomaly   = Lgm_CTL_InterpAngle( h, n0->mean_anomaly, n1->mean_anomaly, M_2PI );
+    c->true_anomaly   = Lgm_CTL_InterpAngle( h, n0->true_anomaly, n1->true_anomaly, M_2PI );
+    c->lambda_sun     = Lgm_CTL_InterpAngle( h, n0->lambda_sun,   n1->lambda_sun,   M_2PI );
+
+
+    /*
+     *  Sun direction (the GSE and GSE2000 X axes) and ecliptic pole
+     */
+    c->Sun.x      = c->Amod_to_gse[0][0];     c->Sun.y      = c->Amod_to_gse[1][0];     c->Sun.z      = c->Amod_to_gse[2][0];
+    c->SunJ2000.x = c->Agei_to_gse2000[0][0]; c->SunJ2000.y = c->Agei_to_gse2000[1][0]; c->SunJ2000.z = c->Agei_to_gse2000[2][0];
+    c->RA_sun     = Lgm_angle360( atan2( c->Sun.y, c->Sun.x )*DegPerRad );
+    c->DEC_sun    = asin( c->Sun.z )*DegPerRad;
+    epsilon = c->epsilon*RadPerArcSec;
+    c->EcPole.x = 0.0; c->EcPole.y = -sin(epsilon); c->EcPole.z = cos(epsilon);
+
+
+    /*
+     *  Earth rotation (exact)
+     */
+    gmst = c->gmst*15.0*RadPerDeg;
+    c->gast = c->gmst*15.0 + c->EQ_Eq/3600.0;
+    gast = c->gast*RadPerDeg; cs = cos( gast ); sn = sin( gast );
+    c->Atod_to_pef[0][0] =  cs; c->Atod_to_pef[1][0] =  sn; c->Atod_to_pef[2][0] = 0.0;
+    c->Atod_to_pef[0][1] = -sn; c->Atod_to_pef[1][1] =  cs; c->Atod_to_pef[2][1] = 0.0;
+    c->Atod_to_pef[0][2] = 0.0; c->Atod_to_pef[1][2] = 0.0; c->Atod_to_pef[2][2] = 1.0;
+    Lgm_Transpose( c->Atod_to_pef, c->Apef_to_tod );
+
+    sn = sin( gmst ); cs = cos( gmst );
+    c->Ateme_to_pef[0][0] =  cs; c->Ateme_to_pef[1][0] =  sn; c->Ateme_to_pef[2][0] = 0.0;
+    c->Ateme_to_pef[0][1] = -sn; c->Ateme_to_pef[1][1] =  cs; c->Ateme_to_pef[2][1] = 0.0;
+    c->Ateme_to_pef[0][2] = 0.0; c->Ateme_to_pef[1][2] = 0.0; c->Ateme_to_pef[2][2] = 1.0;
+    Lgm_Transpose( c->Ateme_to_pef, c->Apef_to_teme );
+
+
+    /*
+     *  WGS84 <-> MOD and WGS84 <-> GEI
+     */
+    Lgm_MatTimesMat( c->Apef_to_tod, c->Awgs84_to_pef, Tmp );
+    Lgm_MatTimesMat( c->Atod_to_mod, Tmp, c->Awgs84_to_mod );
+    Lgm_MatTimesMat( c->Amod_to_gei, c->Awgs84_to_mod, c->Awgs84_to_gei );
+    Lgm_Transpose( c->Awgs84_to_mod, c->Amod_to_wgs84 );
+    Lgm_Transpose( c->Awgs84_to_gei, c->Agei_to_wgs84 );
+
+
+    /*
+     *  IGRF-derived quantities
+     */
+    Lgm_CTL_InterpDir( h, &n0->D, &n1->D, &D );
+    c->CD_gcolat      = acos( D.z )*DegPerRad;
+    c->CD_glon        = atan2( D.y, D.x )*DegPerRad;
+    c->M_cd           = (1.0-h)*n0->M_cd + h*n1->M_cd;
+    c->M_cd_McIllwain = tl->M_cd_McIllwain;
+    c->M_cd_2010      = tl->M_cd_2010;
+    c->ED_x0          = (1.0-h)*n0->ED.x + h*n1->ED.x;
+    c->ED_y0          = (1.0-h)*n0->ED.y + h*n1->ED.y;
+    c->ED_z0          = (1.0-h)*n0->ED.z + h*n1->ED.z;
+    c->Lgm_IGRF_FirstCall = TRUE;
+
+
+    /*
+     *  MOD <-> GSM, the dipole tilt, GSM <-> SM and WGS84 <-> CDMAG (as in
+     *  Lgm_Set_Coord_Transforms()).
+     */
+    Dmod.x = cs*D.x - sn*D.y;
+    Dmod.y = sn*D.x + cs*D.y;
+    Dmod.z = D.z;
+    Lgm_CrossProduct( &Dmod, &c->Sun, &Y );
+    Lgm_NormalizeVector( &Y );
+    Lgm_CrossProduct( &c->Sun, &Y, &Z );
+    c->Amod_to_gsm[0][0] = c->Sun.x, c->Amod_to_gsm[1][0] = c->Sun.y, c->Amod_to_gsm[2][0] = c->Sun.z;
+    c->Amod_to_gsm[0][1] = Y.x, c->Amod_to_gsm[1][1] = Y.y, c->Amod_to_gsm[2][1] = Y.z;
+    c->Amod_to_gsm[0][2] = Z.x, c->Amod_to_gsm[1][2] = Z.y, c->Amod_to_gsm[2][2] = Z.z;
+    Lgm_Transpose( c->Amod_to_gsm, c->Agsm_to_mod );
+
+    Lgm_MatTimesVec( c->Amod_to_gsm, &Dmod, &Dgsm );
+    spsi       = ( Dgsm.x > 1.0 ) ? 1.0 : ( ( Dgsm.x < -1.0 ) ? -1.0 : Dgsm.x );
+    c->psi     = asin( spsi );
+    c->sin_psi = spsi;
+    c->cos_psi = sqrt( 1.0 - spsi*spsi );
+    c->tan_psi = c->sin_psi/c->cos_psi;
+
+    c->Agsm_to_sm[0][0] = c->cos_psi, c->Agsm_to_sm[1][0] = 0.0, c->Agsm_to_sm[2][0] = -c->sin_psi;
+    c->Agsm_to_sm[0][1] = 0.0,        c->Agsm_to_sm[1][1] = 1.0, c->Agsm_to_sm[2][1] =  0.0;
+    c->Agsm_to_sm[0][2] = c->sin_psi, c->Agsm_to_sm[1][2] = 0.0, c->Agsm_to_sm[2][2] =  c->cos_psi;
+    Lgm_Transpose( c->Agsm_to_sm, c->Asm_to_gsm );
+
+    Zgeo.x = 0.0; Zgeo.y = 0.0; Zgeo.z = 1.0;
+    Lgm_CrossProduct( &Zgeo, &D, &Y );
+    Lgm_NormalizeVector( &Y );
+    Lgm_CrossProduct( &Y, &D, &X );
+    Lgm_NormalizeVector( &X );
+    c->Awgs84_to_cdmag[0][0] = X.x, c->Awgs84_to_cdmag[1][0] = X.y, c->Awgs84_to_cdmag[2][0] =  X.z;
+    c->Awgs84_to_cdmag[0][1] = Y.x, c->Awgs84_to_cdmag[1][1] = Y.y, c->Awgs84_to_cdmag[2][1] =  Y.z;
+    c->Awgs84_to_cdmag[0][2] = D.x, c->Awgs84_to_cdmag[1][2] = D.y, c->Awgs84_to_cdmag[2][2] =  D.z;
+    Lgm_Transpose( c->Awgs84_to_cdmag, c->Acdmag_to_wgs84 );
+
+
+    /*
+     *  Remaining composites
+     */
+    Lgm_MatTimesMat( c->Amod_to_gse, c->Agsm_to_mod, c->Agsm_to_gse );
+    Lgm_Transpose( c->Agsm_to_gse, c->Agse_to_gsm );
+    Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, c->Agsm_to_wgs84 );
+    Lgm_Transpose( c->Agsm_to_wgs84, c->Awgs84_to_gsm );
+
+
+    /*
+     *  Moon
+     */
+    Lgm_CTL_InterpDir( h, &n0->Moon, &n1->Moon, &u );
+    Lgm_CartToSphCoords( &u, &c->DEC_moon, &c->RA_moon, &x );
+    c->RA_moon = Lgm_angle360( c->RA_moon );
+    Lgm_CTL_InterpDir( h, &n0->MoonJ2000, &n1->MoonJ2000, &c->MoonJ2000 );
+    c->EarthMoonDistance = (1.0-h)*n0->EarthMoonDistance + h*n1->EarthMoonDistance;
+    c->MoonPhase = ( ( n0->MoonPhase == LGM_FILL_VALUE ) || ( n1->MoonPhase == LGM_FILL_VALUE ) ) ? LGM_FILL_VALUE : (1.0-h)*n0->MoonPhase + h*n1->MoonPhase;
+
+    return( TRUE );
+
+}
@@ -202,14 +202,12 @@ Lgm_SphToCartCoords( geoLat , geoLon, geoAlt, &wgsVec );
     * First, we can compute L bsed on the known point v3_cdmag.
     */
 
-printf("v3_cdmag-> = %.15lf %.15lf %.15lf %.15lf\n", v3_cdmag.x, v3_cdmag.y, v3_cdmag.z, Lgm_Magnitude( &v3_cdmag)  );
     R   = Lgm_Magnitude( &v3_cdmag );
 
     SinLat = v3_cdmag.z/R;
     SinLat2 = SinLat*SinLat;
     CosLat2 = 1.0 - SinLat2;
     L = R/CosLat2;
-printf("L-> = %.15lf\n", L);
 
     /*
      * CgmLon should be the same as the longitude of v3_cdmag.
@@ -239,27 +237,22 @@ R = CgmRad;
     SinLat2 = SinLat*SinLat;
     CosLat2 = 1.0 - SinLat2;
     L = R/CosLat2;
-printf("L<- = %.15lf\n", L);
 //printf("R: %g, L: %g\n", R, L );
     //construct location of Pmin (for dipole FL)
 //    Lgm_SphToCartCoords( 0.0 , CgmLon, L, &v3_cdmag); //Is this right??
     Lgm_SphToCartCoords( 0.0 , CgmLon, L, &v3_cdmag); //Is this right??
     Lgm_Convert_Coords( &v3_cdmag, &vSME, CDMAG_TO_GSM, m->c );
 
-printf("v3_cdmag<- = %.15lf %.15lf %.15lf     %.15lf\n", v3_cdmag.x, v3_cdmag.y, v3_cdmag.z, Lgm_Magnitude( &v3_cdmag)  );
 
     
     //Now trace from vSME to requested altitude
 //Lgm_TraceToEarth( &vSME, &gsmVec, CgmAlt, 1, TRACE_TOL, m );
-    Lgm_TraceToSphericalEarth( &vSME, &gsmVec, (CgmRad-1.0)*WGS84_A, 1, TRACE_TOL, m );
+    if ( Lgm_TraceToSphericalEarth( &vSME, &gsmVec, (CgmRad-1.0)*WGS84_A, 1, TRACE_TOL, m ) < 1 ) return( -1 );
 Lgm_Vector vSME2;
     if ( Lgm_TraceToSMEquat( &gsmVec, &vSME2, TRACE_TOL, m)  < 1) return( -1 );
-printf("vSME  = %g %g %g\n", vSME.x, vSME.y, vSME.z);
-printf("vSME2 = %g %g %g\n", vSME2.x, vSME2.y, vSME2.z);
     //Lgm_TraceToSphericalEarth( &vSME, &gsmVec, 1.0+CgmRad/WGS84_A, 1, TRACE_TOL, m );
     //Lgm_TraceToSphericalEarth( &vSME, &gsmVec, 100.0, 1, TRACE_TOL, m );
 //printf("GSM  x %g, y %g, z %g\n", gsmVec.x, gsmVec.y, gsmVec.z );
-printf("HHHHHH = %g   (CgmRad-1.0)*WGS84_A = %g\n", (Lgm_Magnitude( &gsmVec ) -1.0)*WGS84_A, (CgmRad-1.0)*WGS84_A);
     
     //Get coords of trace point in WGS84
     Lgm_Convert_Coords( &gsmVec, &wgsVec, GSM_TO_WGS84, m->c );
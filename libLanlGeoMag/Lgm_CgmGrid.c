@@ -0,0 +1,380 @@
+/*! \file Lgm_CgmGrid.c
+ *
+ *  \brief Precomputed (per epoch and field model) grids for fast CGM conversions.
+ *
+ *  Lgm_GEOD_TO_CGM() and Lgm_CGM_TO_GEOD() trace a field line for every
+ *  conversion, which is far too slow for whole magnetometer networks or
+ *  auroral images. A Lgm_CgmGrid does the tracing once, on a regular
+ *  lat/lon grid at each of a set of radii, for both directions;
+ *
+ *      Fwd     -- nodes in geographic (spherical) lat/lon, holding CgmLat, CgmLon
+ *      Inv     -- nodes in CgmLat/CgmLon (CgmLat >= 0), holding geographic lat, lon
+ *
+ *  The conversions then use bicubic (Catmull-Rom) interpolation in lat/lon
+ *  and linear interpolation in radius. The arguments mean the same as those
+ *  of Lgm_GEOD_TO_CGM() and Lgm_CGM_TO_GEOD(), and so do the results.
+ *
+ *  The error of each cell is estimated when the grid is made, by tracing the
+ *  cell center exactly and comparing with the interpolated value. Cells with
+ *  an estimated error above MaxErr, and cells whose interpolation stencil
+ *  has a node where tracing failed (open field lines, the fold at the CGM
+ *  equator and so on), are done by exact tracing instead (if a
+ *  Lgm_MagModelInfo is given to the conversion routine).
+ *
+ *  For the interpolation, the grid is reflected across the poles (so the
+ *  forward grid has no edges) and the longitudes are unwrapped around the
+ *  stencil.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+
+#define LGM_CGMGRID_DEFAULT_MAXERR  0.01    // degrees
+#define LGM_CGMGRID_MAX_L           50.0    // Same cutoff as Lgm_CBM_TO_GSM() (further out, the traces get very long)
+
+
+/*
+ *  Difference of two longitudes (deg), in [-180, 180).
+ */
+static double Lgm_CgmGrid_dLon( double a, double b ) {
+    double d = fmod( a - b + 540.0, 360.0 );
+    if ( d < 0.0 ) d += 360.0;
+    return( d - 180.0 );
+}
+
+
+/*
+ *  Exact conversion at a node. Which = 0 is Fwd, 1 is Inv. Returns FALSE if
+ *  tracing failed.
+ */
+static int Lgm_CgmGrid_Exact( int Which, double Lat, double Lon, double r, double *A, double *B, Lgm_MagModelInfo *m ) {
+
+    double  Rad, c;
+
+    if ( Which == 0 ) {
+        if ( Lgm_GEOD_TO_CGM( Lat, Lon, r, A, B, &Rad, m ) < 1 ) return( FALSE );
+    } else {
+        c = cos( Lat*RadPerDeg );
+        if ( r > LGM_CGMGRID_MAX_L*c*c ) return( FALSE );
+        if ( Lgm_CGM_TO_GEOD( Lat, Lon, r, A, B, &Rad, m ) < 1 ) return( FALSE );
+    }
+
+    return( isfinite( *A ) && isfinite( *B ) );
+
+}
+
+
+/*
+ *  Node (i, j) of level k, reflected across the poles when i is outside of
+ *  the grid. Returns FALSE if the node doesnt exist (or has no value).
+ */
+static int Lgm_CgmGrid_Node( Lgm_CgmGridMap *g, int k, int i, int j, double *A, double *B ) {
+
+    int     top = g->nLat-1;
+
+    if ( i < 0 ) {
+        if ( !g->PoleLo ) return( FALSE );
+        i = -i; j += g->nLon/2;
+    } else if ( i > top ) {
+        if ( !g->PoleHi ) return( FALSE );
+        i = 2*top - i; j += g->nLon/2;
+    }
+    if ( ( i < 0 ) || ( i > top ) ) return( FALSE );
+    j %= g->nLon; if ( j < 0 ) j += g->nLon;
+
+    *A = g->A[k][i][j];
+    *B = g->B[k][i][j];
+
+    return( *A != LGM_FILL_VALUE );
+
+}
+
+
+/*
+ *  Catmull-Rom weights.
+ */
+static void Lgm_CgmGrid_Weights( double t, double w[4] ) {
+    double t2 = t*t, t3 = t2*t;
+    w[0] = 0.5*( -t3 + 2.0*t2 - t );
+    w[1] = 0.5*( 3.0*t3 - 5.0*t2 + 2.0 );
+    w[2] = 0.5*( -3.0*t3 + 4.0*t2 + t );
+    w[3] = 0.5*( t3 - t2 );
+}
+
+
+/*
+ *  Bicubic interpolation on level k. Sets *i0, *j0 to the cell. Returns
+ *  FALSE if any node of the stencil is missing.
+ */
+static int Lgm_CgmGrid_Interp2( Lgm_CgmGridMap *g, int k, double Lat, double Lon, double *A, double *B, int *i0, int *j0 ) {
+
+    double  x, y, wx[4], wy[4], a, b, Bref=0.0, SumA, SumB;
+    int     i, j, p, q;
+
+    x = ( Lat - g->Lat0 )/g->dLat;
+    y = fmod( Lon, 360.0 ); if ( y < 0.0 ) y += 360.0;
+    y /= g->dLon;
+    i = (int)floor( x ); if ( i > g->nLat-2 ) i = g->nLat-2; if ( i < 0 ) i = 0;
+    j = (int)floor( y ); if ( j > g->nLon-1 ) j = g->nLon-1;
+    *i0 = i; *j0 = j;
+
+    Lgm_CgmGrid_Weights( x - i, wx );
+    Lgm_CgmGrid_Weights( y - j, wy );
+
+    SumA = SumB = 0.0;
+    for ( p=0; p<4; p++ ) {
+        for ( q=0; q<4; q++ ) {
+            if ( !Lgm_CgmGrid_Node( g, k, i-1+p, j-1+q, &a, &b ) ) return( FALSE );
+            if ( ( p == 0 ) && ( q == 0 ) ) Bref = b;
+            SumA += wx[p]*wy[q]*a;
+            SumB += wx[p]*wy[q]*( Bref + Lgm_CgmGrid_dLon( b, Bref ) );
+        }
+    }
+    *A = SumA;
+    *B = SumB;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Fill in one map (nodes first, then the cell error estimates).
+ */
+static void Lgm_CgmGrid_Fill( int Which, Lgm_CgmGrid *c, Lgm_CgmGridMap *g, Lgm_MagModelInfo *m ) {
+
+    long int            n, N, i, j, k, Plane;
+    int                 i0, j0;
+    double              Lat, Lon, A, B, Ai, Bi, e;
+    Lgm_MagModelInfo    *m2;
+
+    Plane = (long int)g->nLat*g->nLon;
+    N     = c->nR*Plane;
+
+    /*
+     *  Nodes.
+     */
+    #if USE_OPENMP
+    #pragma omp parallel private(m2,n,i,j,k,Lat,Lon,A,B)
+    #endif
+    {
+        m2 = Lgm_NewMagContext( m );
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic, 16)
+        #endif
+        for ( n=0; n<N; n++ ) {
+            k = n/Plane; i = (n%Plane)/g->nLon; j = n%g->nLon;
+            Lat = g->Lat0 + i*g->dLat; Lon = j*g->dLon;
+            if ( Lgm_CgmGrid_Exact( Which, Lat, Lon, c->R[k], &A, &B, m2 ) ) {
+                g->A[k][i][j] = A; g->B[k][i][j] = B;
+            } else {
+                g->A[k][i][j] = g->B[k][i][j] = LGM_FILL_VALUE;
+            }
+        }
+        #if USE_OPENMP
+        #pragma omp critical (Lgm_CgmGrid)
+        #endif
+        {
+            m->Lgm_nMagEvals += m2->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( m, m2 );
+        }
+        Lgm_FreeMagInfo( m2 );
+    }
+
+    /*
+     *  Cell errors, from an exact trace at each cell center.
+     */
+    #if USE_OPENMP
+    #pragma omp parallel private(m2,n,i,j,k,i0,j0,Lat,Lon,A,B,Ai,Bi,e)
+    #endif
+    {
+        m2 = Lgm_NewMagContext( m );
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic, 16)
+        #endif
+        for ( n=0; n<N; n++ ) {
+            k = n/Plane; i = (n%Plane)/g->nLon; j = n%g->nLon;
+            e = LGM_FILL_VALUE;
+            if ( i < g->nLat-1 ) {
+                Lat = g->Lat0 + (i+0.5)*g->dLat; Lon = (j+0.5)*g->dLon;
+                if ( Lgm_CgmGrid_Interp2( g, k, Lat, Lon, &Ai, &Bi, &i0, &j0 )
+                        && Lgm_CgmGrid_Exact( Which, Lat, Lon, c->R[k], &A, &B, m2 ) ) {
+                    e = fabs( Lgm_CgmGrid_dLon( Bi, B ) )*cos( A*RadPerDeg );
+                    if ( fabs( Ai - A ) > e ) e = fabs( Ai - A );
+                }
+            }
+            g->Err[k][i][j] = e;
+        }
+        #if USE_OPENMP
+        #pragma omp critical (Lgm_CgmGrid)
+        #endif
+        {
+            m->Lgm_nMagEvals += m2->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( m, m2 );
+        }
+        Lgm_FreeMagInfo( m2 );
+    }
+
+}
+
+
+static void Lgm_CgmGrid_AllocMap( Lgm_CgmGridMap *g, int nR, double Lat0, double Lat1, double dLat, double dLon ) {
+
+    g->dLat   = dLat;
+    g->dLon   = 360.0/floor( 360.0/dLon + 0.5 );
+    g->nLon   = (int)floor( 360.0/g->dLon + 0.5 );
+    g->nLat   = (int)floor( (Lat1-Lat0)/dLat + 0.5 ) + 1;
+    g->Lat0   = Lat0;
+    g->dLat   = (Lat1-Lat0)/(g->nLat-1);
+    g->PoleLo = ( Lat0 == -90.0 ) && ( g->nLon%2 == 0 );
+    g->PoleHi = ( Lat1 ==  90.0 ) && ( g->nLon%2 == 0 );
+    LGM_ARRAY_3D( g->A,   nR, g->nLat, g->nLon, double );
+    LGM_ARRAY_3D( g->B,   nR, g->nLat, g->nLon, double );
+    LGM_ARRAY_3D( g->Err, nR, g->nLat, g->nLon, double );
+
+}
+
+
+/*
+ *  Make the grids for the epoch and field model set up in m.
+ *
+ *      nR, R       -- radii (Re, increasing) of the grid levels.
+ *      dLat, dLon  -- grid spacings (deg). dLon is adjusted to divide 360
+ *                     evenly, and dLat to divide the latitude ranges evenly.
+ *      MaxErr      -- cells with a larger estimated error (deg) are traced
+ *                     exactly (<= 0 for 0.01 deg).
+ *
+ *  m is used as a template for per-thread copies. Returns NULL on bad input.
+ */
+Lgm_CgmGrid *Lgm_CgmGrid_Create( int nR, double *R, double dLat, double dLon, double MaxErr, Lgm_MagModelInfo *m ) {
+
+    Lgm_CgmGrid *g;
+    int         k;
+
+    if ( ( nR < 1 ) || ( dLat <= 0.0 ) || ( dLon <= 0.0 ) ) {
+        printf("Lgm_CgmGrid_Create: Invalid grid (nR = %d, dLat = %g, dLon = %g)\n", nR, dLat, dLon );
+        return( NULL );
+    }
+    for ( k=1; k<nR; k++ ) {
+        if ( R[k] <= R[k-1] ) {
+            printf("Lgm_CgmGrid_Create: Radii must be increasing\n");
+            return( NULL );
+        }
+    }
+
+    g = (Lgm_CgmGrid *)calloc( 1, sizeof(Lgm_CgmGrid) );
+    g->Date   = m->c->UTC.Date;
+    g->UTC    = m->c->UTC.Time;
+    g->MaxErr = ( MaxErr > 0.0 ) ? MaxErr : LGM_CGMGRID_DEFAULT_MAXERR;
+    g->nR     = nR;
+    LGM_ARRAY_1D( g->R, nR, double );
+    for ( k=0; k<nR; k++ ) g->R[k] = R[k];
+
+    Lgm_CgmGrid_AllocMap( &g->Fwd, nR, -90.0, 90.0, dLat, dLon );
+    Lgm_CgmGrid_AllocMap( &g->Inv, nR,   0.0, 90.0, dLat, dLon );
+
+    Lgm_CgmGrid_Fill( 0, g, &g->Fwd, m );
+    Lgm_CgmGrid_Fill( 1, g, &g->Inv, m );
+
+    return( g );
+
+}
+
+
+void Lgm_CgmGrid_Free( Lgm_CgmGrid *g ) {
+
+    if ( g == NULL ) return;
+    LGM_ARRAY_1D_FREE( g->R );
+    LGM_ARRAY_3D_FREE( g->Fwd.A ); LGM_ARRAY_3D_FREE( g->Fwd.B ); LGM_ARRAY_3D_FREE( g->Fwd.Err );
+    LGM_ARRAY_3D_FREE( g->Inv.A ); LGM_ARRAY_3D_FREE( g->Inv.B ); LGM_ARRAY_3D_FREE( g->Inv.Err );
+    free( g );
+
+}
+
+
+/*
+ *  Interpolate one map at (Lat, Lon, r). Returns FALSE if the point has to be
+ *  traced exactly.
+ */
+static int Lgm_CgmGrid_Interp( Lgm_CgmGrid *c, Lgm_CgmGridMap *g, double Lat, double Lon, double r, double *A, double *B, double *Err ) {
+
+    double  A0, B0, A1, B1, h;
+    int     k, i0, j0;
+
+    if ( c->nR == 1 ) {
+        if ( fabs( r - c->R[0] ) > 1e-9*c->R[0] ) return( FALSE );
+        k = 0; h = 0.0;
+    } else {
+        if ( ( r < c->R[0] ) || ( r > c->R[c->nR-1] ) ) return( FALSE );
+        for ( k=0; ( k < c->nR-2 ) && ( r > c->R[k+1] ); k++ );
+        h = ( r - c->R[k] )/( c->R[k+1] - c->R[k] );
+    }
+
+    if ( !Lgm_CgmGrid_Interp2( g, k, Lat, Lon, &A0, &B0, &i0, &j0 ) ) return( FALSE );
+    *Err = g->Err[k][i0][j0];
+    if ( ( *Err == LGM_FILL_VALUE ) || ( *Err > c->MaxErr ) ) return( FALSE );
+
+    if ( h > 0.0 ) {
+        if ( !Lgm_CgmGrid_Interp2( g, k+1, Lat, Lon, &A1, &B1, &i0, &j0 ) ) return( FALSE );
+        if ( ( g->Err[k+1][i0][j0] == LGM_FILL_VALUE ) || ( g->Err[k+1][i0][j0] > c->MaxErr ) ) return( FALSE );
+        if ( g->Err[k+1][i0][j0] > *Err ) *Err = g->Err[k+1][i0][j0];
+        A0 += h*( A1 - A0 );
+        B0 += h*Lgm_CgmGrid_dLon( B1, B0 );
+    }
+
+    *A = A0;
+    *B = B0;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Same as Lgm_GEOD_TO_CGM(), from the grid. *Err is the estimated error
+ *  (deg), or 0 if the point was traced exactly. Points that cant be
+ *  interpolated are traced with m (if m is NULL, -1 is returned for them).
+ *  m is only used for those, so threads can share g (each with its own m).
+ */
+int Lgm_CgmGrid_GEOD_TO_CGM( double geoLat, double geoLon, double geoAlt, double *CgmLat, double *CgmLon, double *CgmRad, double *Err, Lgm_CgmGrid *g, Lgm_MagModelInfo *m ) {
+
+    if ( Lgm_CgmGrid_Interp( g, &g->Fwd, geoLat, geoLon, geoAlt, CgmLat, CgmLon, Err ) ) {
+        *CgmLon = fmod( *CgmLon, 360.0 );
+        if ( *CgmLon < 0.0 ) *CgmLon += 360.0;
+        *CgmRad = geoAlt;
+        return( 1 );
+    }
+
+    *Err = 0.0;
+    if ( m == NULL ) return( -1 );
+    return( Lgm_GEOD_TO_CGM( geoLat, geoLon, geoAlt, CgmLat, CgmLon, CgmRad, m ) );
+
+}
+
+
+/*
+ *  Same as Lgm_CGM_TO_GEOD(), from the grid (see Lgm_CgmGrid_GEOD_TO_CGM()).
+ */
+int Lgm_CgmGrid_CGM_TO_GEOD( double CgmLat, double CgmLon, double CgmRad, double *geoLat, double *geoLon, double *geoAlt, double *Err, Lgm_CgmGrid *g, Lgm_MagModelInfo *m ) {
+
+    if ( ( CgmLat >= 0.0 ) && Lgm_CgmGrid_Interp( g, &g->Inv, CgmLat, CgmLon, CgmRad, geoLat, geoLon, Err ) ) {
+        *geoLon = Lgm_CgmGrid_dLon( *geoLon, 0.0 );
+        if ( *geoLon == -180.0 ) *geoLon = 180.0;
+        *geoAlt = (CgmRad-1.0)*WGS84_A;
+        return( 1 );
+    }
+
+    *Err = 0.0;
+    if ( ( m == NULL ) || !Lgm_CgmGrid_Exact( 1, CgmLat, CgmLon, CgmRad, geoLat, geoLon, m ) ) return( -1 );
+    *geoAlt = (CgmRad-1.0)*WGS84_A;
+    return( 1 );
+
+}
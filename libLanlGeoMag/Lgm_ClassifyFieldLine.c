@@ -0,0 +1,145 @@
+/*! \file Lgm_ClassifyFieldLine.c
+ *
+ *  \brief Cheap guess at whether a field line is open or closed before doing a full trace.
+ *
+ *  On the nightside at high L, and in storm-time fields in general, many
+ *  lines are open. Lgm_Trace() only discovers that after tracing all the
+ *  way out to the OpenLimit_* box with steps of at most 0.1 Re, which is
+ *  the most expensive trace it ever does. Lgm_ClassifyFieldLine() walks the
+ *  line in each direction with a loose tolerance and steps that grow with
+ *  distance from the Earth, so the walk costs a small fraction of a real
+ *  trace.
+ *
+ *  The answer is conservative. A direction only counts as open if the walk
+ *  leaves the box and a second walk at a tighter tolerance leaves it too.
+ *  If either walk comes back to the Earth, or the two disagree, the
+ *  direction has to be traced properly.
+ *
+ */
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_CLASSIFY_TOL        1e-3    // Integrator tolerance for the first walk (the second uses a tenth of this)
+#define LGM_CLASSIFY_MAXSTEPS   2000
+
+
+/*
+ *  Walk from u in direction sgn. Returns TRUE if we got (close to) the
+ *  Earth, FALSE if we left the OpenLimit_* box, and -1 if we couldnt tell.
+ *  *v is where the walk ended.
+ */
+static int Lgm_ClassifyFieldLine_Walk( Lgm_Vector *u, double sgn, double Height, double tol, Lgm_Vector *v, Lgm_MagModelInfo *Info ) {
+
+    int         reset=TRUE, n, Result=-1, DenseOutput;
+    double      Htry, Hdid, Hnext, s=0.0, R, Rearth;
+    double      BS_atol, BS_rtol, RK5_Eps, DP8_atol, DP8_rtol;
+    Lgm_Vector  P, u_scale;
+
+    /*
+     *  Loosen the integrator tolerances while we are in here.
+     */
+    BS_atol  = Info->Lgm_MagStep_BS_atol;   BS_rtol  = Info->Lgm_MagStep_BS_rtol;
+    DP8_atol = Info->Lgm_MagStep_DP8_atol;  DP8_rtol = Info->Lgm_MagStep_DP8_rtol;
+    RK5_Eps  = Info->Lgm_MagStep_RK5_Eps;
+    DenseOutput = Info->Lgm_MagStep_DenseOutput;
+    Info->Lgm_MagStep_BS_atol  = Info->Lgm_MagStep_BS_rtol  = tol;
+    Info->Lgm_MagStep_DP8_atol = Info->Lgm_MagStep_DP8_rtol = tol;
+    Info->Lgm_MagStep_RK5_Eps  = tol;
+    Info->Lgm_MagStep_DenseOutput = FALSE;
+
+    /*
+     *  A line that comes back down to here is attached to the Earth (the real
+     *  trace will do the rest). Open lines dont come back anywhere near the
+     *  Earth, so there is no point walking closed ones all the way down.
+     */
+    Rearth = 0.8*Lgm_Magnitude( u );
+    if ( Rearth > 2.0 ) Rearth = 2.0;
+    if ( Rearth < 1.0 + ( Height + 100.0 )/WGS84_A ) Rearth = 1.0 + ( Height + 100.0 )/WGS84_A;
+
+    u_scale.x = u_scale.y = u_scale.z = 1.0;
+    P    = *u;
+    Htry = 0.1;
+    for ( n=0; n<LGM_CLASSIFY_MAXSTEPS; n++ ) {
+
+        if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) break;
+
+        if ( ( P.x > Info->OpenLimit_xMax ) || ( P.x < Info->OpenLimit_xMin ) || ( P.y > Info->OpenLimit_yMax ) || ( P.y < Info->OpenLimit_yMin )
+                || ( P.z > Info->OpenLimit_zMax ) || ( P.z < Info->OpenLimit_zMin ) || ( s > 1000.0 ) ) {
+            Result = FALSE;
+            break;
+        }
+
+        R = Lgm_Magnitude( &P );
+        if ( R < Rearth ) {
+            Result = TRUE;
+            break;
+        }
+
+        /*
+         *  Let the steps grow with distance, but dont step into the Earth.
+         */
+        Htry = Hnext;
+        if ( Htry > 0.25*R )        Htry = 0.25*R;
+        if ( Htry > 0.5*(R - 1.0) ) Htry = 0.5*(R - 1.0);
+        if ( Htry < 1e-3 )          Htry = 1e-3;
+
+    }
+
+    Info->Lgm_MagStep_BS_atol  = BS_atol;   Info->Lgm_MagStep_BS_rtol  = BS_rtol;
+    Info->Lgm_MagStep_DP8_atol = DP8_atol;  Info->Lgm_MagStep_DP8_rtol = DP8_rtol;
+    Info->Lgm_MagStep_RK5_Eps  = RK5_Eps;
+    Info->Lgm_MagStep_DenseOutput = DenseOutput;
+
+    *v = P;
+    return( Result );
+
+}
+
+
+/*
+ *  TRUE if the line through u is (confidently) open in direction sgn. *v is
+ *  where the last walk ended.
+ */
+static int Lgm_ClassifyFieldLine_Open( Lgm_Vector *u, double sgn, double Height, Lgm_Vector *v, Lgm_MagModelInfo *Info ) {
+
+    if ( Lgm_ClassifyFieldLine_Walk( u, sgn, Height, LGM_CLASSIFY_TOL, v, Info ) != FALSE ) return( FALSE );
+    if ( Lgm_ClassifyFieldLine_Walk( u, sgn, Height, 0.1*LGM_CLASSIFY_TOL, v, Info ) != FALSE ) return( FALSE );
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Cheaply decide which ends of the field line through u are open.
+ *
+ *  \details
+ *      Each direction is walked with loose tolerances (see the notes at the
+ *      top of this file). A direction is reported as open only if two walks
+ *      at different tolerances both leave the OpenLimit_* box, so a FALSE
+ *      flag means "attached or not sure", never "known to be attached".
+ *
+ *      Lgm_Trace() uses this (when Info->PreClassifyFieldLines is TRUE) to
+ *      skip the full trace in directions that are open.
+ *
+ *      \param[in]      u           Start point (GSM).
+ *      \param[in]      Height      Height (km) the footpoint traces go down to.
+ *      \param[out]     OpenNorth   TRUE if the line is open in the +B direction (the direction Lgm_Trace() traces to find v2).
+ *      \param[out]     OpenSouth   TRUE if the line is open in the -B direction (the direction Lgm_Trace() traces to find v1).
+ *      \param[out]     vNorth      Where the +B walk ended (outside the box if *OpenNorth is TRUE).
+ *      \param[out]     vSouth      Where the -B walk ended (outside the box if *OpenSouth is TRUE).
+ *      \param[in,out]  Info        Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *      \return LGM_OPEN_IMF if both directions are open, LGM_FIELD_LINE_UNKNOWN otherwise.
+ *
+ */
+int Lgm_ClassifyFieldLine( Lgm_Vector *u, double Height, int *OpenNorth, int *OpenSouth, Lgm_Vector *vNorth, Lgm_Vector *vSouth, Lgm_MagModelInfo *Info ) {
+
+    *OpenNorth = Lgm_ClassifyFieldLine_Open( u,  1.0, Height, vNorth, Info );
+    *OpenSouth = Lgm_ClassifyFieldLine_Open( u, -1.0, Height, vSouth, Info );
+
+    return( ( *OpenNorth && *OpenSouth ) ? LGM_OPEN_IMF : LGM_FIELD_LINE_UNKNOWN );
+
+}
@@ -7,6 +7,7 @@
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_LstarInfo.h"
 #include "Lgm/Lgm_MagEphemInfo.h"
+#include "Lgm/Lgm_Tasks.h"
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
@@ -24,34 +25,302 @@
 #define TRACE_TOL2   1e-10
 #define KP_DEFAULT  1
 
+// Speed (m/s) of a 1 MeV electron, for the bounce periods Tb = 2 Sb/v
+#define LGM_TB_ELECTRON_V   ( LGM_c*sqrt( 1.0 - 1.0/( ( 1.0 + 1.0/LGM_Ee0 )*( 1.0 + 1.0/LGM_Ee0 ) ) ) )
+
 // For colorizing text ...
 //int Colors[8] = { 26, 202, 77, 63, 185, 207, 124, 46 };
 int Colors[9] = { 224, 209, 21, 46, 55, 104, 22, 185, 23 };
 
 
+/*
+ *  What each pitch angle task needs (see Lgm_ComputeLstarVersusPA()).
+ */
+typedef struct Lgm_LstarVersusPA_Data {
+    long int            Date;
+    double              UTC;
+    double              LSimple;
+    int                 Colorize;
+    Lgm_Vector          v3;
+    Lgm_LstarInfo       *LstarInfo;
+    Lgm_MagEphemInfo    *MagEphemInfo;
+    Lgm_LstarInfoPool   *Pool;          // where the scratch copies of LstarInfo come from
+    unsigned long       ResultsCacheKey;    // Lgm_ResultsCache_Key() of the time, or 0 if there is no cache
+    int                 nChains;        // pitch angles are done in this many chains (see Lgm_ComputeLstarVersusPA())
+    int                 *Order;         // PA indices, from 90 degrees down; chain c is Order[ c*nAlpha/nChains ... (c+1)*nAlpha/nChains-1 ]
+    Lgm_ShellHistoryEntry *Nested;      // last shell found by each chain
+} Lgm_LstarVersusPA_Data;
+
+
+/*
+ *  L* (and the drift shell details) for pitch angle i. Run through
+ *  Lgm_ParallelFor(), so it gets its scratch copies of LstarInfo from the
+ *  pool by slot rather than by thread number. If Nested is not NULL, it is
+ *  the shell of the pitch angle done just before this one (if any) and gets
+ *  this one's shell (see LstarInfo->NestedShell).
+ */
+static void Lgm_LstarVersusPA_DoPA( int i, Lgm_LstarVersusPA_Data *d, Lgm_ShellHistoryEntry *Nested ) {
 
-/**
- *      Input Variables:
- *
- *                      Date:
- *                       UTC:
- *                         u:  Input position vector in GSM
- *                    nAlpha:  Number of Pitch Angles to compute
- *                     Alpha:  Pitch Angles to compute
- *
- *      Input/OutPut Variables:
- *
- *              MagEphemInfo:  Structure used to input and output parameters/settings/results to/from routine.
- *
+    Lgm_LstarInfo           *LstarInfo = d->LstarInfo, *LstarInfo2, *LstarInfo3;
+    Lgm_MagEphemInfo        *MagEphemInfo = d->MagEphemInfo;
+    Lgm_Vector              v3 = d->v3;
+    long int                Date = d->Date;
+    double                  UTC = d->UTC, LSimple = d->LSimple;
+    int                     Colorize = d->Colorize;
+    int                     k, LS_Flag = -1, nn, slot2 = -1, slot3, Out = MagEphemInfo->Outputs;
+    double                  t0;
+    char                    *PreStr, *PostStr;
+
+
+    /*
+     *  Once a stage callback has cancelled (see Lgm_StageHooks.c) the
+     *  pitch angles that havent started yet just get fill values.
+     */
+    if ( LGM_STAGE_CANCELLED( LstarInfo->mInfo ) ) {
+        MagEphemInfo->Lstar[i] = LGM_FILL_VALUE;
+        MagEphemInfo->LstarApprox[i] = FALSE;
+        MagEphemInfo->I[i]     = LGM_FILL_VALUE;
+        MagEphemInfo->K[i]     = LGM_FILL_VALUE;
+        MagEphemInfo->Sb[i]    = LGM_FILL_VALUE;
+        MagEphemInfo->Tb[i]    = LGM_FILL_VALUE;
+        MagEphemInfo->nShellPoints[i] = 0;
+        if ( Nested != NULL ) Nested->nPnts = 0;
+        return;
+    }
+    t0 = LGM_STAGE_NOW( LstarInfo->mInfo );
+
+    /*
+     *  Pitch angles already in the results cache (see Lgm_ResultsCache.c)
+     *  are done.
+     */
+    if ( ( d->ResultsCacheKey != 0 ) && ( LSimple < LstarInfo->LSimpleMax ) && Lgm_ResultsCache_GetPA( d->ResultsCacheKey, i, MagEphemInfo ) ) {
+        if ( Nested != NULL ) Nested->nPnts = 0;
+        (void)LGM_STAGE_FIRE( LstarInfo->mInfo, LGM_STAGE_PITCHANGLE_DONE, i, t0, MagEphemInfo->Lstar[i] );
+        return;
+    }
+
+    /*
+     * make a local copy of LstarInfo structure -- needed for multi-threading
+     */
+    slot3 = Lgm_LstarInfoPool_Acquire( d->Pool );
+    LstarInfo3 = Lgm_LstarInfoPool_Get( slot3, LstarInfo, d->Pool );
+
+    /*
+     *  In deterministic mode, start from a clean integrator state and dont
+     *  use the shell history (other times' tasks for this pitch angle may be
+     *  reading and writing it in any order).
+     */
+    if ( Lgm_GetDeterministic() ) {
+        Lgm_MagStep_ResetState( LstarInfo3->mInfo );
+        LstarInfo3->ShellHistory = NULL;
+    }
+
+    /*
+     *  Only do the stages whose outputs were asked for (see LGM_OUT_* in
+     *  Lgm_LstarInfo.h).
+     */
+    LstarInfo3->Outputs            = Out;
+    LstarInfo3->SaveShellLines     = LstarInfo3->SaveShellLines && ( Out & LGM_OUT_SHELL_TRACE );
+    LstarInfo3->ComputeVgc         = LstarInfo3->ComputeVgc && ( Out & LGM_OUT_VGC );
+    LstarInfo3->ComputeSbIntegral  = LstarInfo3->ComputeSbIntegral && ( Out & LGM_OUT_SB );
+
+    /*
+     * colorize the diagnostic messages.
+     */
+    if ( Colorize ){
+        sprintf( LstarInfo3->PreStr, "\033[38;5;%dm", Colors[i%9]); sprintf( LstarInfo3->PostStr, "\033[0m");
+    } else {
+        LstarInfo3->PreStr[0] = '\0'; LstarInfo3->PostStr[0] = '\0';
+    }
+    PreStr = LstarInfo3->PreStr; PostStr = LstarInfo3->PostStr;
+
+    /*
+     *  Set Bmirror
+     */
+    LstarInfo3->mInfo->Bm = MagEphemInfo->Bm[i];
+    NewTimeLstarInfo( Date, UTC, MagEphemInfo->Alpha[i], LstarInfo3->mInfo->Bfield, LstarInfo3 );
+
+    /*
+     *  Compute L*
+     */
+    if ( LSimple < LstarInfo3->LSimpleMax ){
+
+        slot2 = Lgm_LstarInfoPool_Acquire( d->Pool );
+        LstarInfo2 = Lgm_LstarInfoPool_Get( slot2, LstarInfo3, d->Pool );
+        if ( Lgm_GetDeterministic() ) Lgm_MagStep_ResetState( LstarInfo2->mInfo );
+        LstarInfo2->NestedShell = Nested;
+
+        LstarInfo2->mInfo->Bm = LstarInfo3->mInfo->Bm;
+        if (LstarInfo3->VerbosityLevel >= 2 ) {
+            printf("\n\n\t\t%sComputing L* for: UTC = %g  (Local) PA = %d  (%g)%s\n", PreStr, UTC, i, MagEphemInfo->Alpha[i], PostStr );
+            //printf("    \t\t%s                  I   = %g PA = %d  (%g)%s\n", PreStr, MagEphemInfo->I[i], i, MagEphemInfo->Alpha[i], PostStr );
+        }
+//////////////////////////////NOTE
+//////////////////////////////NOTE   We are giving Lstar the Min B point ALREADY!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+//////////////////////////////NOTE
+//////////////////////////////NOTE
+//////////////////////////////NOTE
+
+//printf("LstarInfo2->mInfo->Bm = %g\n", LstarInfo2->mInfo->Bm);
+        LS_Flag = Lstar( &v3, LstarInfo2);
+
+        if (LstarInfo3->VerbosityLevel >= 2 ) {
+            printf("\t\t%sUTC, L*          = %g %g%s\n", PreStr, UTC, LstarInfo2->LS, PostStr );
+            printf("\t\t%sUTC, L*_McIlwain = %g %g%s\n", PreStr, UTC, LstarInfo2->LS_McIlwain_M, PostStr );
+            printf("\t\t%sUTC, LSimple     = %g %g%s\n\n\n", PreStr, UTC, LSimple, PostStr );
+        }
+        MagEphemInfo->Lstar[i] = ( LS_Flag >= 0 ) ? LstarInfo2->LS : LGM_FILL_VALUE;
+        MagEphemInfo->LstarApprox[i] = ( LS_Flag == LGM_LSTAR_APPROXIMATE );
+        MagEphemInfo->I[i]  = LstarInfo2->I[0]; // I[0] is I for the FL that the sat is on.
+        MagEphemInfo->K[i]  = ( Out & LGM_OUT_K ) ? LstarInfo2->I[0]*sqrt(MagEphemInfo->Bm[i]*1e-5) : LGM_FILL_VALUE; // Second invariant
+        MagEphemInfo->Sb[i] = LstarInfo2->SbIntegral0; // SbIntegral0 is Sb for the FL that the sat is on.
+        MagEphemInfo->Tb[i] = ( LstarInfo2->SbIntegral0 != LGM_FILL_VALUE ) ? 2.0*LstarInfo2->SbIntegral0*Re*1e3/LGM_TB_ELECTRON_V : LGM_FILL_VALUE; // Bounce period of a 1 MeV electron (s)
+        /*
+         *  Determine the type of the orbit
+         */
+        if ( LS_Flag >= 0 )  {
+            LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED;
+            for ( k=0; k<LstarInfo2->nMinMax; ++k ) {
+                if ( LstarInfo2->nMinima[k] > 1 ) LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED_SHABANSKY;
+            }
+        } else {
+            LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
+            for ( k=0; k<LstarInfo2->nMinMax; ++k ) {
+                if ( LstarInfo2->nMinima[k] > 1 ) LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN_SHABANSKY;
+            }
+        }
+        MagEphemInfo->DriftOrbitType[i] = LstarInfo2->DriftOrbitType;
+
+
+        //printf("\t    %sL* [ %g Deg. ]: Date: %ld   UTC: %g   Lsimple:%g   L*:%.15g%s\n", PreStr, MagEphemInfo->Alpha[i], Date, UTC, LSimple, LstarInfo2->LS, PostStr );
+        if (LstarInfo3->VerbosityLevel > 0 ) {
+		                printf("\t    %sL* [ %g\u00b0 ]: Date: %ld   UTC: %g   Lsimple:%g   L*:%.15g%s\n", PreStr, MagEphemInfo->Alpha[i], Date, UTC, LSimple, LstarInfo2->LS, PostStr );
+		            }
+
+
+
+
+        /*
+         * Save detailed results to the MagEphemInfo structure.
+         */
+        MagEphemInfo->nShellPoints[i] = LstarInfo2->nPnts;
+        for (nn=0; (MagEphemInfo->ShellI != NULL) && (nn<LstarInfo2->nPnts); nn++ ){
+            if ( Out & LGM_OUT_PMIN ) {
+                MagEphemInfo->Shell_Pmin[i][nn]  = LstarInfo2->Pmin[nn];
+                MagEphemInfo->Shell_Bmin[i][nn]  = LstarInfo2->Bmin[nn];
+            }
+            if ( Out & LGM_OUT_VGC ) {
+                MagEphemInfo->Shell_GradI[i][nn] = LstarInfo2->GradI[nn];
+                MagEphemInfo->Shell_Vgc[i][nn]   = LstarInfo2->Vgc[nn];
+            }
+
+            MagEphemInfo->ShellI[i][nn] = LstarInfo2->I[nn];
+
+            if ( Out & LGM_OUT_FOOTPOINTS ) {
+                MagEphemInfo->ShellSphericalFootprint_Pn[i][nn] = LstarInfo2->Spherical_Footprint_Pn[nn];
+                MagEphemInfo->ShellSphericalFootprint_Sn[i][nn] = LstarInfo2->Spherical_Footprint_Sn[nn];
+                MagEphemInfo->ShellSphericalFootprint_Bn[i][nn] = LstarInfo2->Spherical_Footprint_Bn[nn];
+                MagEphemInfo->ShellSphericalFootprint_Ps[i][nn] = LstarInfo2->Spherical_Footprint_Ps[nn];
+                MagEphemInfo->ShellSphericalFootprint_Ss[i][nn] = LstarInfo2->Spherical_Footprint_Ss[nn];
+                MagEphemInfo->ShellSphericalFootprint_Bs[i][nn] = LstarInfo2->Spherical_Footprint_Bs[nn];
+
+                MagEphemInfo->ShellEllipsoidFootprint_Pn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Pn[nn];
+                MagEphemInfo->ShellEllipsoidFootprint_Sn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Sn[nn];
+                MagEphemInfo->ShellEllipsoidFootprint_Bn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Bn[nn];
+                MagEphemInfo->ShellEllipsoidFootprint_Ps[i][nn] = LstarInfo2->Ellipsoid_Footprint_Ps[nn];
+                MagEphemInfo->ShellEllipsoidFootprint_Ss[i][nn] = LstarInfo2->Ellipsoid_Footprint_Ss[nn];
+                MagEphemInfo->ShellEllipsoidFootprint_Bs[i][nn] = LstarInfo2->Ellipsoid_Footprint_Bs[nn];
+            }
+
+            if ( Out & LGM_OUT_MIRROR ) {
+                MagEphemInfo->ShellMirror_Pn[i][nn]    = LstarInfo2->Mirror_Pn[nn];
+                //MagEphemInfo->ShellMirror_Sn[i][nn]    = LstarInfo2->mInfo->Sm_North;
+                MagEphemInfo->ShellMirror_Sn[i][nn]    = LstarInfo2->Mirror_Sn[nn];
+
+                MagEphemInfo->ShellMirror_Ps[i][nn]    = LstarInfo2->Mirror_Ps[nn];
+                //MagEphemInfo->ShellMirror_Ss[i][nn]    = LstarInfo2->mInfo->Sm_South;
+                MagEphemInfo->ShellMirror_Ss[i][nn]    = LstarInfo2->Mirror_Ss[nn];
+            }
+
+            MagEphemInfo->nMinima[i][nn] = LstarInfo2->nMinima[nn];
+            MagEphemInfo->nMaxima[i][nn] = LstarInfo2->nMaxima[nn];
+
+        }
+
+        /*
+         *  Save all of the drift shell FLs in MagEphemInfo structure
+         *  (decimated, see Lgm_MagEphemShellLines.c)
+         */
+        if ( ( MagEphemInfo->ShellI != NULL ) && ( Out & LGM_OUT_SHELL_LINES ) && LstarInfo2->SaveShellLines ) Lgm_MagEphemInfo_PutShellLines( i, LstarInfo2, MagEphemInfo );
+
+        /*
+         *  Approximate and cancelled L*'s depend on how long things took, so
+         *  they dont go in the results cache.
+         */
+        if ( ( d->ResultsCacheKey != 0 ) && ( LS_Flag != LGM_LSTAR_APPROXIMATE ) && ( LS_Flag != LGM_LSTAR_CANCELLED ) ) {
+            Lgm_ResultsCache_PutPA( d->ResultsCacheKey, i, MagEphemInfo );
+        }
+
+    } else {
+        printf(" Lsimple >= %g  ( Not doing L* calculation )\n", LstarInfo3->LSimpleMax );
+        MagEphemInfo->Lstar[i] = LGM_FILL_VALUE;
+        MagEphemInfo->LstarApprox[i] = FALSE;
+//printf("Bm = %g\n", MagEphemInfo->Bm[i]);
+        MagEphemInfo->I[i]     = LGM_FILL_VALUE;
+        MagEphemInfo->K[i]     = LGM_FILL_VALUE;
+        MagEphemInfo->Tb[i]    = LGM_FILL_VALUE;
+        MagEphemInfo->nShellPoints[i] = 0;
+
+    }
+
+    // a shell that didnt close is no use to the next pitch angle
+    if ( ( Nested != NULL ) && ( LS_Flag < 0 ) ) Nested->nPnts = 0;
+
+    if ( slot2 >= 0 ) Lgm_LstarInfoPool_Release( slot2, d->Pool );
+    Lgm_LstarInfoPool_Release( slot3, d->Pool );
+
+    (void)LGM_STAGE_FIRE( LstarInfo->mInfo, LGM_STAGE_PITCHANGLE_DONE, i, t0, MagEphemInfo->Lstar[i] );
+
+}
+
+static void Lgm_LstarVersusPA_Task( long int i, void *Data ) {
+    Lgm_LstarVersusPA_DoPA( (int)i, (Lgm_LstarVersusPA_Data *)Data, NULL );
+}
+
+/*
+ *  The pitch angles of chain c, one after the other, each one starting from
+ *  the shell of the one before.
  */
-void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo *MagEphemInfo ) {
+static void Lgm_LstarVersusPA_ChainTask( long int c, void *Data ) {
+
+    Lgm_LstarVersusPA_Data  *d = (Lgm_LstarVersusPA_Data *)Data;
+    int                     j, nAlpha = d->MagEphemInfo->nAlpha;
+
+    d->Nested[c].nPnts = 0;
+    for ( j = (int)( c*nAlpha/d->nChains ); j < (int)( (c+1)*nAlpha/d->nChains ); j++ ) {
+        Lgm_LstarVersusPA_DoPA( d->Order[j], d, &d->Nested[c] );
+    }
+
+}
+
+
+
+
+
+/*
+ *  Everything that Lgm_ComputeLstarVersusPA() does for one time before the
+ *  pitch angle tasks can run: the coordinate transforms, Bm for each pitch
+ *  angle, the trace through u and the fill values if the FL isnt closed.
+ *  d is filled in for the tasks. Returns TRUE if there are pitch angle tasks
+ *  to run (i.e. the FL is closed).
+ */
+static int Lgm_LstarVersusPA_Setup( long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo *MagEphemInfo, Lgm_LstarVersusPA_Data *d ) {
 
-    Lgm_LstarInfo 	*LstarInfo, *LstarInfo2, *LstarInfo3;
+    Lgm_LstarInfo 	*LstarInfo;
     Lgm_Vector      v1, v2, v3, vv1, Bvec;
     double          sa, sa2, Blocal;
     double          Lam, CosLam, LSimple;
-    int             i, k, LS_Flag, nn, tk, TraceFlag;
-    char            *PreStr, *PostStr;
+    int             i, TraceFlag;
 
     /* These should be set by the user in the setup up MagEphemInfo no in here */
     //MagEphemInfo->LstarInfo->SaveShellLines = FALSE;
@@ -60,6 +329,9 @@ void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAl
     //MagEphemInfo->LstarInfo->ComputeVgc     = FALSE;
     LstarInfo = MagEphemInfo->LstarInfo;
 
+    // The drift shell arrays are only allocated once they are wanted
+    if ( MagEphemInfo->SaveShellLines && ( MagEphemInfo->Outputs & LGM_OUT_SHELL ) ) Lgm_MagEphemInfo_AllocShellArrays( MagEphemInfo );
+
     // Save Date, UTC to MagEphemInfo structure
     MagEphemInfo->Date   = Date;
     MagEphemInfo->UTC    = UTC;
@@ -75,6 +347,9 @@ void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAl
     // set coord transformation
     Lgm_Set_Coord_Transforms( Date, UTC, LstarInfo->mInfo->c );
 
+    // in deterministic mode every time starts from the same integrator state
+    if ( Lgm_GetDeterministic() ) Lgm_MagStep_ResetState( LstarInfo->mInfo );
+
     /*
      *  Blocal at sat location.
      */
@@ -90,6 +365,16 @@ void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAl
 //printf("Bm[%d] = %g\n", i, MagEphemInfo->Bm[i] );
     }
 
+    /*
+     *  If everything for this time is in the results cache, there is
+     *  nothing to compute.
+     */
+    d->ResultsCacheKey = 0;
+    if ( MagEphemInfo->ResultsCache != NULL ) {
+        d->ResultsCacheKey = Lgm_ResultsCache_Key( u, MagEphemInfo );
+        if ( Lgm_ResultsCache_GetAll( d->ResultsCacheKey, MagEphemInfo ) ) return( FALSE );
+    }
+
 
 
 
@@ -123,196 +408,347 @@ void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAl
          */
         for ( i=0; i<MagEphemInfo->nAlpha; i++ ){
             MagEphemInfo->Lstar[i] = LGM_FILL_VALUE;
+            MagEphemInfo->LstarApprox[i] = FALSE;
             MagEphemInfo->I[i]     = LGM_FILL_VALUE;
             MagEphemInfo->K[i]     = LGM_FILL_VALUE;
             MagEphemInfo->Sb[i]    = LGM_FILL_VALUE;
+            MagEphemInfo->Tb[i]    = LGM_FILL_VALUE;
         }
         MagEphemInfo->Sb0     = LGM_FILL_VALUE;
         MagEphemInfo->d2B_ds2 = LGM_FILL_VALUE;
         MagEphemInfo->RofC    = LGM_FILL_VALUE;
+        if ( d->ResultsCacheKey != 0 ) Lgm_ResultsCache_PutEpoch( d->ResultsCacheKey, LGM_FILL_VALUE, MagEphemInfo );
+        return( FALSE );
     }
-    if ( TraceFlag == 1 ) {
-
-           MagEphemInfo->Sb0     = LstarInfo->mInfo->Sb0;     // Sb Integral for equatorially mirroring particles.
-           MagEphemInfo->d2B_ds2 = LstarInfo->mInfo->d2B_ds2; // second deriv of B wrt s at equator.
-           MagEphemInfo->RofC    = LstarInfo->mInfo->RofC;    // radius of curvature at Bmin point.
-
-            /*
-             *  Get a simple measure of how big L is
-             */
-            Lgm_Convert_Coords( &v1, &vv1, GSM_TO_SM, LstarInfo->mInfo->c );
-            Lam = asin( vv1.z/Lgm_Magnitude( &vv1 ) );
-            CosLam = cos( Lam );
-            //LSimple = (1.0+LstarInfo->mInfo->Lgm_LossConeHeight/WGS84_A)/( CosLam*CosLam );
-            LSimple = Lgm_Magnitude( &LstarInfo->mInfo->Pmin );
-
-            { // ***** BEGIN PARALLEL EXECUTION *****
-
-            /*
-             *  Do all of the PAs in parallel. To control how many threads get run
-             *  use the enironment variable OMP_NUM_THREADS. For example,
-             *          setenv OMP_NUM_THREADS 8
-             *  will use 8 threads to do the loop in parallel. Be very careful what gets
-             *  set private here -- the threads must not interfere with each other.
-             */
-#if USE_OPENMP
-            #pragma omp parallel private(LstarInfo2,LstarInfo3,sa,sa2,LS_Flag,nn,tk,PreStr,PostStr)
-            #pragma omp for schedule(dynamic, 1)
-#endif
-            for ( i=0; i<MagEphemInfo->nAlpha; i++ ){  // LOOP OVER PITCH ANGLES
-
-                /*
-                 * make a local copy of LstarInfo structure -- needed for multi-threading
-                 */
-                LstarInfo3 = Lgm_CopyLstarInfo( LstarInfo );
-
-                /*
-                 * colorize the diagnostic messages.
-                 */
-                if ( Colorize ){
-                    sprintf( LstarInfo3->PreStr, "\033[38;5;%dm", Colors[i%9]); sprintf( LstarInfo3->PostStr, "\033[0m");
-                } else {
-                    LstarInfo3->PreStr[0] = '\0'; LstarInfo3->PostStr[0] = '\0';
-                }
-                PreStr = LstarInfo3->PreStr; PostStr = LstarInfo3->PostStr;
-
-                /*
-                 *  Set Bmirror
-                 */
-                LstarInfo3->mInfo->Bm = MagEphemInfo->Bm[i];
-                NewTimeLstarInfo( Date, UTC, MagEphemInfo->Alpha[i], LstarInfo3->mInfo->Bfield, LstarInfo3 );
-
-                /*
-                 *  Compute L*
-                 */
-                if ( LSimple < LstarInfo3->LSimpleMax ){
-
-                    LstarInfo2 = Lgm_CopyLstarInfo( LstarInfo3 );
-
-                    LstarInfo2->mInfo->Bm = LstarInfo3->mInfo->Bm;
-                    if (LstarInfo3->VerbosityLevel >= 2 ) {
-                        printf("\n\n\t\t%sComputing L* for: UTC = %g  (Local) PA = %d  (%g)%s\n", PreStr, UTC, i, MagEphemInfo->Alpha[i], PostStr );
-                        //printf("    \t\t%s                  I   = %g PA = %d  (%g)%s\n", PreStr, MagEphemInfo->I[i], i, MagEphemInfo->Alpha[i], PostStr );
-                    }
-//////////////////////////////NOTE
-//////////////////////////////NOTE   We are giving Lstar the Min B point ALREADY!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-//////////////////////////////NOTE
-//////////////////////////////NOTE
-//////////////////////////////NOTE
 
-//printf("LstarInfo2->mInfo->Bm = %g\n", LstarInfo2->mInfo->Bm);
-                    LS_Flag = Lstar( &v3, LstarInfo2);
-
-                    if (LstarInfo3->VerbosityLevel >= 2 ) {
-                        printf("\t\t%sUTC, L*          = %g %g%s\n", PreStr, UTC, LstarInfo2->LS, PostStr );
-                        printf("\t\t%sUTC, L*_McIlwain = %g %g%s\n", PreStr, UTC, LstarInfo2->LS_McIlwain_M, PostStr );
-                        printf("\t\t%sUTC, LSimple     = %g %g%s\n\n\n", PreStr, UTC, LSimple, PostStr );
-                    }
-                    MagEphemInfo->Lstar[i] = ( LS_Flag >= 0 ) ? LstarInfo2->LS : LGM_FILL_VALUE;
-                    MagEphemInfo->I[i]  = LstarInfo2->I[0]; // I[0] is I for the FL that the sat is on.
-                    MagEphemInfo->K[i]  = LstarInfo2->I[0]*sqrt(MagEphemInfo->Bm[i]*1e-5); // Second invariant
-                    MagEphemInfo->Sb[i] = LstarInfo2->SbIntegral0; // SbIntegral0 is Sb for the FL that the sat is on.
-                    /*
-                     *  Determine the type of the orbit
-                     */
-                    if ( LS_Flag >= 0 )  {
-                        LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED;
-                        for ( k=0; k<LstarInfo2->nMinMax; ++k ) {
-                            if ( LstarInfo2->nMinima[k] > 1 ) LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_CLOSED_SHABANSKY;
-                        }
-                    } else {
-                        LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN;
-                        for ( k=0; k<LstarInfo2->nMinMax; ++k ) {
-                            if ( LstarInfo2->nMinima[k] > 1 ) LstarInfo2->DriftOrbitType = LGM_DRIFT_ORBIT_OPEN_SHABANSKY;
-                        }
-                    }
-                    MagEphemInfo->DriftOrbitType[i] = LstarInfo2->DriftOrbitType;
-
-
-                    //printf("\t    %sL* [ %g Deg. ]: Date: %ld   UTC: %g   Lsimple:%g   L*:%.15g%s\n", PreStr, MagEphemInfo->Alpha[i], Date, UTC, LSimple, LstarInfo2->LS, PostStr );
-                    if (LstarInfo3->VerbosityLevel > 0 ) {
-		                printf("\t    %sL* [ %g\u00b0 ]: Date: %ld   UTC: %g   Lsimple:%g   L*:%.15g%s\n", PreStr, MagEphemInfo->Alpha[i], Date, UTC, LSimple, LstarInfo2->LS, PostStr );
-		            }
+    MagEphemInfo->Sb0     = LstarInfo->mInfo->Sb0;     // Sb Integral for equatorially mirroring particles.
+    MagEphemInfo->d2B_ds2 = LstarInfo->mInfo->d2B_ds2; // second deriv of B wrt s at equator.
+    MagEphemInfo->RofC    = LstarInfo->mInfo->RofC;    // radius of curvature at Bmin point.
 
+    /*
+     *  Get a simple measure of how big L is
+     */
+    Lgm_Convert_Coords( &v1, &vv1, GSM_TO_SM, LstarInfo->mInfo->c );
+    Lam = asin( vv1.z/Lgm_Magnitude( &vv1 ) );
+    CosLam = cos( Lam );
+    //LSimple = (1.0+LstarInfo->mInfo->Lgm_LossConeHeight/WGS84_A)/( CosLam*CosLam );
+    LSimple = Lgm_Magnitude( &LstarInfo->mInfo->Pmin );
+    if ( d->ResultsCacheKey != 0 ) Lgm_ResultsCache_PutEpoch( d->ResultsCacheKey, LSimple, MagEphemInfo );
 
+    /*
+     *  With ISearchMethod 2 the shell lines are traced from (MLT,
+     *  mlat) footpoints that dont depend on the pitch angle, and the
+     *  MLTs are the same for every pitch angle. So let all of the
+     *  searches share the lines that have been traced. The copies
+     *  made below all point at this one cache. (Not in deterministic
+     *  mode: a cached line is whatever the first pitch angle to get
+     *  there traced, from whatever state its integrator was in.)
+     */
+    if ( LstarInfo->UseFieldLineCache && ( LstarInfo->ISearchMethod == 2 ) && !Lgm_GetDeterministic() ) {
+        LstarInfo->FieldLineCache = Lgm_InitFieldLineCache( -1.0, -1 );
+    }
 
+    /*
+     *  Likewise, FindBmRadius() steps out along the same radial lines for
+     *  every pitch angle, so let them share the |B| profiles (see
+     *  Lgm_BmRadiusCache.c).
+     */
+    if ( LstarInfo->UseBmRadiusCache ) LstarInfo->BmRadiusCache = Lgm_InitBmRadiusCache( -1.0, -1 );
 
-                    /*
-                     * Save detailed results to the MagEphemInfo structure.
-                     */
-                    MagEphemInfo->nShellPoints[i] = LstarInfo2->nPnts;
-                    for (nn=0; nn<LstarInfo2->nPnts; nn++ ){
-                        MagEphemInfo->Shell_Pmin[i][nn]  = LstarInfo2->Pmin[nn];
-                        MagEphemInfo->Shell_Bmin[i][nn]  = LstarInfo2->Bmin[nn];
-                        MagEphemInfo->Shell_GradI[i][nn] = LstarInfo2->GradI[nn];
-                        MagEphemInfo->Shell_Vgc[i][nn]   = LstarInfo2->Vgc[nn];
+    /*
+     *  The flux map (if there is one) has to be for this epoch before the
+     *  pitch angle tasks start using it.
+     */
+    if ( LstarInfo->FluxMap != NULL ) Lgm_FluxMap_Compute( LstarInfo->FluxMap, LstarInfo->mInfo );
 
-                        MagEphemInfo->ShellI[i][nn] = LstarInfo2->I[nn];
+    d->Date         = Date;
+    d->UTC          = UTC;
+    d->LSimple      = LSimple;
+    d->Colorize     = Colorize;
+    d->v3           = v3;
+    d->LstarInfo    = LstarInfo;
+    d->MagEphemInfo = MagEphemInfo;
+    d->Pool         = MagEphemInfo->LstarInfoPool;
 
-                        MagEphemInfo->ShellSphericalFootprint_Pn[i][nn] = LstarInfo2->Spherical_Footprint_Pn[nn];
-                        MagEphemInfo->ShellSphericalFootprint_Sn[i][nn] = LstarInfo2->Spherical_Footprint_Sn[nn];
-                        MagEphemInfo->ShellSphericalFootprint_Bn[i][nn] = LstarInfo2->Spherical_Footprint_Bn[nn];
-                        MagEphemInfo->ShellSphericalFootprint_Ps[i][nn] = LstarInfo2->Spherical_Footprint_Ps[nn];
-                        MagEphemInfo->ShellSphericalFootprint_Ss[i][nn] = LstarInfo2->Spherical_Footprint_Ss[nn];
-                        MagEphemInfo->ShellSphericalFootprint_Bs[i][nn] = LstarInfo2->Spherical_Footprint_Bs[nn];
+    return( TRUE );
 
-                        MagEphemInfo->ShellEllipsoidFootprint_Pn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Pn[nn];
-                        MagEphemInfo->ShellEllipsoidFootprint_Sn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Sn[nn];
-                        MagEphemInfo->ShellEllipsoidFootprint_Bn[i][nn] = LstarInfo2->Ellipsoid_Footprint_Bn[nn];
-                        MagEphemInfo->ShellEllipsoidFootprint_Ps[i][nn] = LstarInfo2->Ellipsoid_Footprint_Ps[nn];
-                        MagEphemInfo->ShellEllipsoidFootprint_Ss[i][nn] = LstarInfo2->Ellipsoid_Footprint_Ss[nn];
-                        MagEphemInfo->ShellEllipsoidFootprint_Bs[i][nn] = LstarInfo2->Ellipsoid_Footprint_Bs[nn];
+}
 
 
-                        MagEphemInfo->ShellMirror_Pn[i][nn]    = LstarInfo2->Mirror_Pn[nn];
-                        //MagEphemInfo->ShellMirror_Sn[i][nn]    = LstarInfo2->mInfo->Sm_North;
-                        MagEphemInfo->ShellMirror_Sn[i][nn]    = LstarInfo2->Mirror_Sn[nn];
+/*
+ *  Clean up after the pitch angle tasks of one time.
+ */
+static void Lgm_LstarVersusPA_Finish( Lgm_MagEphemInfo *MagEphemInfo ) {
 
-                        MagEphemInfo->ShellMirror_Ps[i][nn]    = LstarInfo2->Mirror_Ps[nn];
-                        //MagEphemInfo->ShellMirror_Ss[i][nn]    = LstarInfo2->mInfo->Sm_South;
-                        MagEphemInfo->ShellMirror_Ss[i][nn]    = LstarInfo2->Mirror_Ss[nn];
+    Lgm_LstarInfo   *LstarInfo = MagEphemInfo->LstarInfo;
 
-                        /*
-                         *  Save all of the drift shell FLs in MagEphemInfo structure
-                         */
-                        MagEphemInfo->nFieldPnts[i][nn] = LstarInfo2->nFieldPnts[nn];
-                        for (tk=0; tk<LstarInfo2->nFieldPnts[nn]; tk++){    // loop over points in a FL
-                            MagEphemInfo->s_gsm[i][nn][tk] = LstarInfo2->s_gsm[nn][tk];
-                            MagEphemInfo->Bmag[i][nn][tk]  = LstarInfo2->Bmag[nn][tk];
-                            MagEphemInfo->x_gsm[i][nn][tk] = LstarInfo2->x_gsm[nn][tk];
-                            MagEphemInfo->y_gsm[i][nn][tk] = LstarInfo2->y_gsm[nn][tk];
-                            MagEphemInfo->z_gsm[i][nn][tk] = LstarInfo2->z_gsm[nn][tk];
-                        }
-//printf("LstarInfo2->nFieldPnts[%d] = %d\n", nn, LstarInfo2->nFieldPnts[nn]);
+    if ( LstarInfo->FieldLineCache != NULL ) {
+        if (LstarInfo->VerbosityLevel > 1 ) {
+            printf("\t\tField line cache: %d lines stored, %ld hits, %ld misses\n", LstarInfo->FieldLineCache->nEntries, LstarInfo->FieldLineCache->nHits, LstarInfo->FieldLineCache->nMisses );
+        }
+        Lgm_FreeFieldLineCache( LstarInfo->FieldLineCache );
+        LstarInfo->FieldLineCache = NULL;
+    }
 
+    if ( LstarInfo->BmRadiusCache != NULL ) {
+        if (LstarInfo->VerbosityLevel > 1 ) {
+            printf("\t\tBm radius cache: %d radial profiles stored, %ld hits, %ld misses\n", LstarInfo->BmRadiusCache->nEntries, LstarInfo->BmRadiusCache->nHits, LstarInfo->BmRadiusCache->nMisses );
+        }
+        Lgm_FreeBmRadiusCache( LstarInfo->BmRadiusCache );
+        LstarInfo->BmRadiusCache = NULL;
+    }
 
-                        MagEphemInfo->nMinima[i][nn] = LstarInfo2->nMinima[nn];
-                        MagEphemInfo->nMaxima[i][nn] = LstarInfo2->nMaxima[nn];
+}
 
-                    }
 
-                    FreeLstarInfo( LstarInfo2 );
+/*
+ *  The pitch angle tasks get their two scratch copies of LstarInfo from the
+ *  pool (reused from call to call, rather than allocated and freed for every
+ *  pitch angle). Start it off with two per thread; it grows if more tasks
+ *  than that are running at once.
+ */
+static void Lgm_LstarVersusPA_InitPool( Lgm_MagEphemInfo *MagEphemInfo ) {
 
-                } else {
-                    printf(" Lsimple >= %g  ( Not doing L* calculation )\n", LstarInfo3->LSimpleMax );
-                    MagEphemInfo->Lstar[i] = LGM_FILL_VALUE;
-//printf("Bm = %g\n", MagEphemInfo->Bm[i]);
-                    MagEphemInfo->I[i]     = LGM_FILL_VALUE;
-                    MagEphemInfo->K[i]     = LGM_FILL_VALUE;
-                    MagEphemInfo->nShellPoints[i] = 0;
+    if ( MagEphemInfo->LstarInfoPool == NULL ) {
+        MagEphemInfo->LstarInfoPool = Lgm_InitLstarInfoPool( 2*Lgm_GetMaxThreads() );
+    }
+
+}
+
+
+
+
+
+/**
+ *      Input Variables:
+ *
+ *                      Date:
+ *                       UTC:
+ *                         u:  Input position vector in GSM
+ *                    nAlpha:  Number of Pitch Angles to compute
+ *                     Alpha:  Pitch Angles to compute
+ *
+ *      Input/OutPut Variables:
+ *
+ *              MagEphemInfo:  Structure used to input and output parameters/settings/results to/from routine.
+ *
+ */
+void Lgm_ComputeLstarVersusPA( long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo *MagEphemInfo ) {
 
-                }
+    Lgm_LstarVersusPA_Data  TaskData;
+    int                     i, j, n;
+    double                  sa;
 
+    Lgm_LstarVersusPA_InitPool( MagEphemInfo );
 
-                FreeLstarInfo( LstarInfo3 );
+    if ( Lgm_LstarVersusPA_Setup( Date, UTC, u, nAlpha, Alpha, Colorize, MagEphemInfo, &TaskData ) ) {
+
+        /*
+         *  The drift shells of neighbouring pitch angles are nested and
+         *  nearly the same shape, so each PA's shell is a good prediction
+         *  of where the next one's lines are (see LstarInfo->NestedShell).
+         *  Split the PAs, sorted from 90 degrees down, into one chain per
+         *  thread; each chain does its PAs in order, passing the shell
+         *  along. (Not in deterministic mode, where the answers shouldnt
+         *  depend on the number of threads.)
+         */
+        n = MagEphemInfo->nAlpha;
+        TaskData.nChains = Lgm_GetMaxThreads();
+        if ( TaskData.nChains > n ) TaskData.nChains = n;
+        TaskData.Order  = NULL;
+        TaskData.Nested = NULL;
+        if ( !Lgm_GetDeterministic() && ( TaskData.nChains < n ) ) {
+            TaskData.Order  = (int *)malloc( n*sizeof(int) );
+            TaskData.Nested = (Lgm_ShellHistoryEntry *)malloc( TaskData.nChains*sizeof(Lgm_ShellHistoryEntry) );
+            for ( i=0; i<n; i++ ) {
+                sa = fabs( sin( MagEphemInfo->Alpha[i]*RadPerDeg ) );
+                for ( j=i; ( j > 0 ) && ( fabs( sin( MagEphemInfo->Alpha[TaskData.Order[j-1]]*RadPerDeg ) ) < sa ); j-- ) TaskData.Order[j] = TaskData.Order[j-1];
+                TaskData.Order[j] = i;
             }
+        }
 
+        // ***** BEGIN PARALLEL EXECUTION *****
+
+        /*
+         *  Do the PAs (or chains of them) in parallel. They go to the shared
+         *  task pool (see Lgm_Tasks.c), so if this is called from inside a
+         *  parallel loop (e.g. over times) the PA tasks are spread over the
+         *  threads that are already running. To control how many threads get
+         *  run use the enironment variable OMP_NUM_THREADS. For example,
+         *          setenv OMP_NUM_THREADS 8
+         *  will use 8 threads.
+         */
+        if ( TaskData.Order != NULL ) {
+            Lgm_ParallelFor( TaskData.nChains, Lgm_LstarVersusPA_ChainTask, (void *)&TaskData );
+        } else {
+            Lgm_ParallelFor( MagEphemInfo->nAlpha, Lgm_LstarVersusPA_Task, (void *)&TaskData );
         }
+
         // ***** END PARALLEL EXECUTION *****
 
+        free( TaskData.Order );
+        free( TaskData.Nested );
+
+        Lgm_LstarVersusPA_Finish( MagEphemInfo );
+
+    }
+
+
+    return;
+
+}
+
+
+
+
+/*
+ *  The (time, pitch angle) jobs of Lgm_ComputeLstarVersusPA_Multi().
+ */
+typedef struct Lgm_LstarVersusPA_Job {
+    int     t;          // index of the time
+    int     i;          // index of the pitch angle
+    double  Cost;       // rough relative cost, for the ordering
+} Lgm_LstarVersusPA_Job;
+
+typedef struct Lgm_LstarVersusPA_MultiData {
+    long int                *Date;
+    double                  *UTC;
+    Lgm_Vector              *u;
+    int                     nAlpha;
+    double                  *Alpha;
+    int                     Colorize;
+    Lgm_MagEphemInfo        **MagEphemInfo;
+    Lgm_LstarVersusPA_Data  *TimeData;      // one per time
+    int                     *Closed;        // Closed[t] is TRUE if time t has pitch angle tasks
+    Lgm_LstarVersusPA_Job   *Jobs;
+} Lgm_LstarVersusPA_MultiData;
+
+static void Lgm_LstarVersusPA_SetupTask( long int t, void *Data ) {
+
+    Lgm_LstarVersusPA_MultiData *m = (Lgm_LstarVersusPA_MultiData *)Data;
+
+    m->Closed[t] = Lgm_LstarVersusPA_Setup( m->Date[t], m->UTC[t], &m->u[t], m->nAlpha, m->Alpha, m->Colorize, m->MagEphemInfo[t], &m->TimeData[t] );
+
+}
+
+static void Lgm_LstarVersusPA_JobTask( long int j, void *Data ) {
+
+    Lgm_LstarVersusPA_MultiData *m = (Lgm_LstarVersusPA_MultiData *)Data;
+
+    Lgm_LstarVersusPA_Task( m->Jobs[j].i, (void *)&m->TimeData[ m->Jobs[j].t ] );
+
+}
+
+/*
+ *  Most expensive first; ties stay in (time, pitch angle) order.
+ */
+static int Lgm_LstarVersusPA_CompareJobs( const void *a, const void *b ) {
+
+    const Lgm_LstarVersusPA_Job *ja = (const Lgm_LstarVersusPA_Job *)a;
+    const Lgm_LstarVersusPA_Job *jb = (const Lgm_LstarVersusPA_Job *)b;
+
+    if ( ja->Cost > jb->Cost ) return( -1 );
+    if ( ja->Cost < jb->Cost ) return(  1 );
+    if ( ja->t != jb->t ) return( ( ja->t < jb->t ) ? -1 : 1 );
+    return( ( ja->i < jb->i ) ? -1 : ( ja->i > jb->i ) );
+
+}
+
+
+/**
+ *  Lgm_ComputeLstarVersusPA() for nT times at once.
+ *
+ *  Lgm_ComputeLstarVersusPA() only has nAlpha tasks to hand out, so with more
+ *  threads than pitch angles some of them sit idle, and the call takes as
+ *  long as its slowest pitch angle. Here all of the (time, pitch angle)
+ *  pairs go into one Lgm_ParallelFor(), most expensive first, so the long
+ *  ones start right away and the short ones fill in the gaps at the end.
+ *  The cost of a pair is guessed from the size of the FL (LSimple) and the
+ *  pitch angle -- shells of near-equatorially mirroring particles (sin(Alpha)
+ *  close to 1) take the longest. Pairs that arent computed at all (LSimple
+ *  over LSimpleMax) go last.
+ *
+ *  The results are the same as calling Lgm_ComputeLstarVersusPA() for each
+ *  time.
+ *
+ *      Input Variables:
+ *
+ *                        nT:  Number of times
+ *                   Date[t]:
+ *                    UTC[t]:
+ *                      u[t]:  Input position vectors in GSM
+ *                    nAlpha:  Number of Pitch Angles to compute (the same for every time)
+ *                     Alpha:  Pitch Angles to compute
+ *
+ *      Input/OutPut Variables:
+ *
+ *           MagEphemInfo[t]:  One structure per time (each with its own
+ *                             LstarInfo), set up the same way as for
+ *                             Lgm_ComputeLstarVersusPA(). The results for
+ *                             time t end up in MagEphemInfo[t]. The scratch
+ *                             copies of LstarInfo all come from
+ *                             MagEphemInfo[0]'s pool.
+ *
+ */
+void Lgm_ComputeLstarVersusPA_Multi( int nT, long int *Date, double *UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Colorize, Lgm_MagEphemInfo **MagEphemInfo ) {
+
+    Lgm_LstarVersusPA_MultiData m;
+    Lgm_LstarInfoPool           *Pool;
+    double                      sa;
+    int                         t, i, nJobs;
+
+    if ( nT < 1 ) return;
+
+    Lgm_LstarVersusPA_InitPool( MagEphemInfo[0] );
+    Pool = MagEphemInfo[0]->LstarInfoPool;
+
+    m.Date         = Date;
+    m.UTC          = UTC;
+    m.u            = u;
+    m.nAlpha       = nAlpha;
+    m.Alpha        = Alpha;
+    m.Colorize     = Colorize;
+    m.MagEphemInfo = MagEphemInfo;
+    m.TimeData     = (Lgm_LstarVersusPA_Data *)calloc( nT, sizeof(Lgm_LstarVersusPA_Data) );
+    m.Closed       = (int *)calloc( nT, sizeof(int) );
+    m.Jobs         = (Lgm_LstarVersusPA_Job *)calloc( (size_t)nT*( nAlpha > 0 ? nAlpha : 1 ), sizeof(Lgm_LstarVersusPA_Job) );
+    if ( ( m.TimeData == NULL ) || ( m.Closed == NULL ) || ( m.Jobs == NULL ) ) {
+        printf("Lgm_ComputeLstarVersusPA_Multi: Could not allocate memory for %d times x %d pitch angles.\n", nT, nAlpha );
+        free( m.TimeData ); free( m.Closed ); free( m.Jobs );
+        return;
+    }
+
+    /*
+     *  The initial traces (one per time) are independent too.
+     */
+    Lgm_ParallelFor( nT, Lgm_LstarVersusPA_SetupTask, (void *)&m );
+
+    for ( nJobs=0, t=0; t<nT; t++ ) {
+        if ( !m.Closed[t] ) continue;
+        m.TimeData[t].Pool = Pool;
+        for ( i=0; i<nAlpha; i++ ) {
+            m.Jobs[nJobs].t = t;
+            m.Jobs[nJobs].i = i;
+            if ( m.TimeData[t].LSimple < m.TimeData[t].LstarInfo->LSimpleMax ) {
+                sa = fabs( sin( Alpha[i]*RadPerDeg ) );
+                m.Jobs[nJobs].Cost = m.TimeData[t].LSimple*( 1.0 + sa );
+            } else {
+                m.Jobs[nJobs].Cost = 0.0;
+            }
+            ++nJobs;
+        }
+    }
+    qsort( m.Jobs, nJobs, sizeof(Lgm_LstarVersusPA_Job), Lgm_LstarVersusPA_CompareJobs );
+
+    Lgm_ParallelFor( nJobs, Lgm_LstarVersusPA_JobTask, (void *)&m );
 
+    for ( t=0; t<nT; t++ ) {
+        if ( m.Closed[t] ) Lgm_LstarVersusPA_Finish( MagEphemInfo[t] );
     }
 
+    free( m.TimeData );
+    free( m.Closed );
+    free( m.Jobs );
 
     return;
 
@@ -0,0 +1,371 @@
+/*! \file Lgm_Conjunction.c
+ *
+ *  \brief Find magnetic conjunctions between spacecraft and ground stations.
+ *
+ *  Two things are in conjunction when they are on the same (or nearby)
+ *  field lines, i.e. when their footpoints are close together in the same
+ *  hemisphere, or (for two spacecraft) when their field lines cross the
+ *  magnetic equator close together. Doing this by hand means tracing every
+ *  sample and then comparing every footpoint with every other one.
+ *
+ *  Lgm_FindConjunctions() takes spacecraft samples (any number of
+ *  spacecraft, in any order) and groups them by epoch (samples only pair up
+ *  with samples at exactly the same time, so ephemerides should be put on a
+ *  common time grid first). Every sample, and every ground station at every
+ *  epoch, is traced once, all in one Lgm_Trace_AtTimes() call (so in
+ *  parallel). Then for each epoch the northern footpoints, the southern
+ *  footpoints and the min-B points each go into a Lgm_KdTree, and each
+ *  spacecraft's point is looked up in them with a search radius of the
+ *  tolerance. So the cost of the comparisons goes like N log N rather than
+ *  N^2, and is small next to the tracing.
+ *
+ *  Footpoints are compared by the straight line distance between them (in
+ *  km, at the footpoint height), which is the great circle distance to well
+ *  under a meter for any sensible tolerance. A station counts as having a
+ *  footpoint in its own hemisphere only (at the station). Min-B points are
+ *  only compared for closed field lines, and not for stations (what a
+ *  station has over it is already in its footpoint).
+ *
+ *  The conjunctions found are added to cf->Conj; one per pair, per place
+ *  (north, south, equator) and per epoch.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_Conjunction.h"
+#include "Lgm/Lgm_AtTimes.h"
+#include "Lgm/Lgm_KdTree.h"
+#include "Lgm/Lgm_WGS84.h"
+
+#define LGM_CONJ_K0     16      // Neighbours asked for in the first search (doubled until they are all in the radius)
+
+
+typedef struct Lgm_ConjEpochKey {
+    long int    Date;
+    double      UTC;
+    long int    i;
+} Lgm_ConjEpochKey;
+
+static int Lgm_ConjEpochKey_Cmp( const void *a, const void *b ) {
+
+    const Lgm_ConjEpochKey *p = (const Lgm_ConjEpochKey *)a, *q = (const Lgm_ConjEpochKey *)b;
+
+    if ( p->Date != q->Date ) return( ( p->Date < q->Date ) ? -1 : 1 );
+    if ( p->UTC  != q->UTC  ) return( ( p->UTC  < q->UTC  ) ? -1 : 1 );
+    return( ( p->i < q->i ) ? -1 : ( p->i > q->i ) );
+
+}
+
+
+/*
+ *  Allocate a finder. Height is the footpoint height (km), FootTol the
+ *  footpoint tolerance (km) and EqTol the min-B tolerance (Re, <= 0 to skip
+ *  the equatorial comparisons).
+ */
+Lgm_ConjunctionFinder *Lgm_InitConjunctionFinder( double Height, double FootTol, double EqTol ) {
+
+    Lgm_ConjunctionFinder *cf;
+
+    cf = (Lgm_ConjunctionFinder *) calloc( 1, sizeof( *cf ) );
+    cf->Height  = Height;
+    cf->FootTol = FootTol;
+    cf->EqTol   = EqTol;
+
+    return( cf );
+
+}
+
+
+void Lgm_FreeConjunctionFinder( Lgm_ConjunctionFinder *cf ) {
+
+    if ( cf == NULL ) return;
+    free( cf->StationId );
+    free( cf->StationLat );
+    free( cf->StationLon );
+    free( cf->Conj );
+    free( cf );
+
+}
+
+
+/*
+ *  Add a ground station (geodetic latitude and longitude in degrees).
+ */
+void Lgm_ConjunctionFinder_AddStation( Lgm_ConjunctionFinder *cf, int Id, double GeodLat, double GeodLon ) {
+
+    int n = cf->nStations + 1;
+
+    cf->StationId  = (int *) realloc( cf->StationId, n*sizeof(int) );
+    cf->StationLat = (double *) realloc( cf->StationLat, n*sizeof(double) );
+    cf->StationLon = (double *) realloc( cf->StationLon, n*sizeof(double) );
+    cf->StationId[n-1]  = Id;
+    cf->StationLat[n-1] = GeodLat;
+    cf->StationLon[n-1] = GeodLon;
+    cf->nStations = n;
+
+}
+
+
+/*
+ *  Forget the conjunctions found so far (the stations are kept).
+ */
+void Lgm_ConjunctionFinder_Clear( Lgm_ConjunctionFinder *cf ) {
+
+    cf->nConj = 0;
+    cf->nTraces = cf->nCandidates = 0;
+
+}
+
+
+static void Lgm_ConjunctionFinder_Add( Lgm_ConjunctionFinder *cf, Lgm_Conjunction *c ) {
+
+    if ( cf->nConj >= cf->nAlloced ) {
+        cf->nAlloced = ( cf->nAlloced > 0 ) ? 2*cf->nAlloced : 256;
+        cf->Conj     = (Lgm_Conjunction *) realloc( cf->Conj, cf->nAlloced*sizeof(Lgm_Conjunction) );
+    }
+    cf->Conj[ cf->nConj++ ] = *c;
+
+}
+
+
+/*
+ *  Join one set of points (Use[j] = trace index of point j, q[j] its
+ *  position in the units of Tol) with itself. Traces >= nSamples are
+ *  stations; only pairs with at least one spacecraft are reported, and each
+ *  pair once.
+ */
+static void Lgm_Conj_Join( Lgm_ConjunctionFinder *cf, int Where, double Tol, long int nPts, long int *Use, double **q, long int nSamples,
+                           long int *Sample, int *Id, Lgm_Vector *P, long int Date, double UTC ) {
+
+    Lgm_KdTree          *kt;
+    Lgm_KdTreeQuery     *Q;
+    Lgm_KdTreeData      *kNN;
+    Lgm_Conjunction     c;
+    void                **Obj;
+    double              x[3];
+    long int            j, a, b;
+    int                 k, K, Kgot, Kmax;
+
+    if ( nPts < 2 ) return;
+
+    LGM_ARRAY_1D( Obj, nPts, void * );
+    kt   = Lgm_KdTree_Init( q, Obj, nPts, 3 );
+    Kmax = ( nPts < LGM_CONJ_K0 ) ? (int)nPts : LGM_CONJ_K0;
+    Q    = Lgm_KdTree_CreateQuery( kt, Kmax );
+    kNN  = (Lgm_KdTreeData *) calloc( Kmax, sizeof( Lgm_KdTreeData ) );
+
+    c.Date = Date; c.UTC = UTC; c.Where = Where;
+
+    for ( j=0; j<nPts; j++ ) {
+
+        a = Use[j];
+        if ( a >= nSamples ) continue;      // stations only get found
+        x[0] = q[0][j]; x[1] = q[1][j]; x[2] = q[2][j];
+
+        /*
+         *  Ask for more neighbours until the farthest one we got is outside
+         *  the radius (or we have them all).
+         */
+        K = ( nPts < LGM_CONJ_K0 ) ? (int)nPts : LGM_CONJ_K0;
+        while ( 1 ) {
+            if ( K > Kmax ) {
+                Lgm_KdTree_FreeQuery( Q ); free( kNN );
+                Kmax = K;
+                Q    = Lgm_KdTree_CreateQuery( kt, Kmax );
+                kNN  = (Lgm_KdTreeData *) calloc( Kmax, sizeof( Lgm_KdTreeData ) );
+            }
+            Lgm_KdTree_kNN_Query( x, kt, K, &Kgot, Tol*Tol, kNN, Q );
+            if ( ( Kgot < K ) || ( K == nPts ) ) break;
+            K = ( 2*K < nPts ) ? 2*K : (int)nPts;
+        }
+        cf->nCandidates += Kgot;
+
+        for ( k=0; k<Kgot; k++ ) {
+            b = Use[ kNN[k].Id ];
+            if ( ( b == a ) || ( ( b < nSamples ) && ( b < a ) ) ) continue;   // self, or found from b already
+            c.Id1     = Id[ Sample[a] ];
+            c.Station = ( b >= nSamples );
+            c.Id2     = ( c.Station ) ? cf->StationId[ (b-nSamples)%cf->nStations ] : Id[ Sample[b] ];
+            c.Dist    = sqrt( kNN[k].Dist2 );
+            c.P1      = P[a];
+            c.P2      = P[b];
+            Lgm_ConjunctionFinder_Add( cf, &c );
+        }
+
+    }
+
+    free( kNN );
+    Lgm_KdTree_FreeQuery( Q );
+    Lgm_FreeKdTree( kt );
+    LGM_ARRAY_1D_FREE( Obj );
+
+}
+
+
+/**
+ *  \brief
+ *      Find the magnetic conjunctions among a set of spacecraft samples and the ground stations.
+ *
+ *  \detail
+ *      Samples at the same epoch (exactly the same Date and UTC) are
+ *      compared with each other and with every station; see the top of
+ *      this file. The conjunctions are added to cf->Conj (sorted by epoch).
+ *      A pair can be reported for the north, the south and the equator at
+ *      the same epoch.
+ *
+ *      \param[in,out]  cf      A Lgm_ConjunctionFinder from Lgm_InitConjunctionFinder().
+ *      \param[in]      n       Number of samples.
+ *      \param[in]      Date    Dates of the samples (e.g. 20150317).
+ *      \param[in]      UTC     Times of the samples (decimal hours).
+ *      \param[in]      Id      Which spacecraft each sample is from.
+ *      \param[in]      u       Positions of the samples (GSM, Re).
+ *      \param[in,out]  m       Properly initialized Lgm_MagModelInfo structure (the field model to use; only its stats are changed).
+ *
+ *      \return         The number of conjunctions found by this call.
+ */
+long int Lgm_FindConjunctions( Lgm_ConjunctionFinder *cf, long int n, long int *Date, double *UTC, int *Id, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
+
+    Lgm_ConjEpochKey    *Key;
+    Lgm_CTrans          *c;
+    Lgm_Vector          w, *U, *v1, *v2, *v3, *F;
+    long int            i, j, e, s, nE, N, nPts, e0, e1, nConj0, *Sample, *Use, *Dates, *Epoch0;
+    int                 *Flag, Where, North;
+    double              *UTCs, *q[3], *Sx, *Sy, *Sz, *Sh, Tol;
+
+    if ( n < 1 ) return( 0 );
+    nConj0 = cf->nConj;
+
+
+    /*
+     *  Group the samples by epoch.
+     */
+    LGM_ARRAY_1D( Key, n, Lgm_ConjEpochKey );
+    for ( i=0; i<n; i++ ) { Key[i].Date = Date[i]; Key[i].UTC = UTC[i]; Key[i].i = i; }
+    qsort( Key, n, sizeof( Lgm_ConjEpochKey ), Lgm_ConjEpochKey_Cmp );
+    LGM_ARRAY_1D( Epoch0, n+1, long int );
+    for ( nE=0, i=0; i<n; i++ ) {
+        if ( ( i == 0 ) || ( Key[i].Date != Key[i-1].Date ) || ( Key[i].UTC != Key[i-1].UTC ) ) Epoch0[nE++] = i;
+    }
+    Epoch0[nE] = n;
+
+
+    /*
+     *  Everything to trace: the samples (in epoch order) and then the
+     *  stations at each epoch (trace n + e*nStations + k is station k at
+     *  epoch e).
+     */
+    N = n + nE*cf->nStations;
+    LGM_ARRAY_1D( Sample, N, long int );
+    LGM_ARRAY_1D( Dates,  N, long int );
+    LGM_ARRAY_1D( UTCs,   N, double );
+    LGM_ARRAY_1D( U,      N, Lgm_Vector );
+    LGM_ARRAY_1D( v1,     N, Lgm_Vector );
+    LGM_ARRAY_1D( v2,     N, Lgm_Vector );
+    LGM_ARRAY_1D( v3,     N, Lgm_Vector );
+    LGM_ARRAY_1D( Flag,   N, int );
+    LGM_ARRAY_1D( F,      N, Lgm_Vector );
+    c = Lgm_init_ctrans( 0 );
+
+    for ( i=0; i<n; i++ ) {
+        Sample[i] = Key[i].i;
+        Dates[i]  = Key[i].Date; UTCs[i] = Key[i].UTC;
+        U[i]      = u[ Key[i].i ];
+    }
+    // the stations dont move in WGS84, so they only need converting once
+    LGM_ARRAY_1D( Sx, cf->nStations+1, double );
+    LGM_ARRAY_1D( Sy, cf->nStations+1, double );
+    LGM_ARRAY_1D( Sz, cf->nStations+1, double );
+    LGM_ARRAY_1D( Sh, cf->nStations+1, double );
+    for ( s=0; s<cf->nStations; s++ ) Sh[s] = cf->Height;
+    Lgm_GEOD_to_WGS84_Array( cf->nStations, cf->StationLat, cf->StationLon, Sh, Sx, Sy, Sz );
+    for ( e=0; e<nE; e++ ) {
+        Lgm_Set_Coord_Transforms( Key[ Epoch0[e] ].Date, Key[ Epoch0[e] ].UTC, c );
+        for ( s=0; s<cf->nStations; s++ ) {
+            i = n + e*cf->nStations + s;
+            Sample[i] = -1;
+            Dates[i]  = Key[ Epoch0[e] ].Date; UTCs[i] = Key[ Epoch0[e] ].UTC;
+            w.x = Sx[s]; w.y = Sy[s]; w.z = Sz[s];
+            Lgm_Convert_Coords( &w, &U[i], WGS84_TO_GSM, c );
+        }
+    }
+
+    Lgm_Trace_AtTimes( N, Dates, UTCs, NULL, U, cf->Height, cf->TOL1, cf->TOL2, Flag, v1, v2, v3, m );
+    cf->nTraces += N;
+
+
+    /*
+     *  Join, epoch by epoch.
+     */
+    LGM_ARRAY_1D( Use, N, long int );
+    LGM_ARRAY_1D( q[0], N, double );
+    LGM_ARRAY_1D( q[1], N, double );
+    LGM_ARRAY_1D( q[2], N, double );
+    for ( e=0; e<nE; e++ ) {
+
+        e0 = Epoch0[e]; e1 = Epoch0[e+1];
+        Lgm_Set_Coord_Transforms( Key[e0].Date, Key[e0].UTC, c );
+
+        for ( Where=LGM_CONJ_NORTH; Where<=LGM_CONJ_EQUATOR; Where++ ) {
+
+            if ( ( Where == LGM_CONJ_EQUATOR ) && ( cf->EqTol <= 0.0 ) ) continue;
+            Tol = ( Where == LGM_CONJ_EQUATOR ) ? cf->EqTol : cf->FootTol;
+
+            nPts = 0;
+            for ( j=0; j<(e1-e0)+cf->nStations; j++ ) {
+
+                i = ( j < e1-e0 ) ? e0 + j : n + e*cf->nStations + (j-(e1-e0));
+
+                if ( Where == LGM_CONJ_EQUATOR ) {
+                    if ( ( i >= n ) || ( Flag[i] != LGM_CLOSED ) ) continue;
+                    F[i] = v3[i];
+                    q[0][nPts] = F[i].x; q[1][nPts] = F[i].y; q[2][nPts] = F[i].z;
+                } else {
+                    North = ( Where == LGM_CONJ_NORTH );
+                    if ( i >= n ) {
+                        if ( ( cf->StationLat[ (i-n)%cf->nStations ] >= 0.0 ) != North ) continue;
+                    }
+                    if ( North ) {
+                        if ( ( Flag[i] != LGM_CLOSED ) && ( Flag[i] != LGM_OPEN_N_LOBE ) ) continue;
+                        F[i] = v2[i];
+                    } else {
+                        if ( ( Flag[i] != LGM_CLOSED ) && ( Flag[i] != LGM_OPEN_S_LOBE ) ) continue;
+                        F[i] = v1[i];
+                    }
+                    Lgm_Convert_Coords( &F[i], &w, GSM_TO_GEO, c );
+                    q[0][nPts] = w.x*WGS84_A; q[1][nPts] = w.y*WGS84_A; q[2][nPts] = w.z*WGS84_A;
+                }
+                Use[nPts++] = i;
+
+            }
+
+            Lgm_Conj_Join( cf, Where, Tol, nPts, Use, q, n, Sample, Id, F, Key[e0].Date, Key[e0].UTC );
+
+        }
+
+    }
+
+
+    Lgm_free_ctrans( c );
+    LGM_ARRAY_1D_FREE( Key );
+    LGM_ARRAY_1D_FREE( Epoch0 );
+    LGM_ARRAY_1D_FREE( Sample );
+    LGM_ARRAY_1D_FREE( Dates );
+    LGM_ARRAY_1D_FREE( UTCs );
+    LGM_ARRAY_1D_FREE( U );
+    LGM_ARRAY_1D_FREE( v1 );
+    LGM_ARRAY_1D_FREE( v2 );
+    LGM_ARRAY_1D_FREE( v3 );
+    LGM_ARRAY_1D_FREE( Flag );
+    LGM_ARRAY_1D_FREE( F );
+    LGM_ARRAY_1D_FREE( Sx );
+    LGM_ARRAY_1D_FREE( Sy );
+    LGM_ARRAY_1D_FREE( Sz );
+    LGM_ARRAY_1D_FREE( Sh );
+    LGM_ARRAY_1D_FREE( Use );
+    LGM_ARRAY_1D_FREE( q[0] );
+    LGM_ARRAY_1D_FREE( q[1] );
+    LGM_ARRAY_1D_FREE( q[2] );
+
+    return( cf->nConj - nConj0 );
+
+}
@@ -64,6 +64,44 @@ double  Lgm_MottScattering( double Z, double beta, double Theta ) {
 }
 
 
+/**
+ *  \brief
+ *     Lgm_MottScattering() over an array of scattering angles.
+ *  \details
+ *     The factors that only depend on Z and beta are computed once. Gives the
+ *     same values as calling Lgm_MottScattering() at each angle.
+ *
+ *      \param[in]      Z                   Atomic mass of the scattering nucleus. Z/137 must be << 1.
+ *      \param[in]      beta                v/c.
+ *      \param[in]      nTheta              Number of scattering angles.
+ *      \param[in]      Theta               Scattering angles.  <b>( radians )</b>
+ *      \param[out]     d_sigma_d_Omega     Differential scattering cross section at each angle.      <b>( m )</b>
+ *
+ */
+void  Lgm_MottScattering_Array( double Z, double beta, int nTheta, double *Theta, double *d_sigma_d_Omega ) {
+
+    int     i;
+    double  beta2, beta4, gamma2, a, b;
+    double  SinThetaOver2, SinThetaOver2_2, SinThetaOver2_4;
+
+    beta2  = beta*beta;         // beta^2
+    beta4  = beta2*beta2;       // beta^4
+    gamma2 = 1.0/(1.0-beta2);   // gamma^2
+    a      = Z*Z*LGM_ELECTRON_RADIUS*LGM_ELECTRON_RADIUS;
+    b      = 4.0*gamma2*beta4;
+
+    for ( i=0; i<nTheta; i++ ) {
+        SinThetaOver2   = sin( Theta[i]/2.0 );
+        SinThetaOver2_2 = SinThetaOver2*SinThetaOver2;
+        SinThetaOver2_4 = SinThetaOver2_2*SinThetaOver2_2;
+        d_sigma_d_Omega[i] = a/(b*SinThetaOver2_4) * ( 1.0 - beta2*SinThetaOver2_2 );
+    }
+
+    return;
+
+}
+
+
 
 
 //void Lgm_MottInit( Lgm_MottInfo *m ) {
@@ -105,6 +105,26 @@
  *
  *
  *
+ *  The compactly supported Wendland RBFs LGM_RBF_WENDLAND32 (\f$C^4\f$) and
+ *  LGM_RBF_WENDLAND33 (\f$C^6\f$),
+ *
+ *      \f[
+ *          \psi(r) = (1-s)_+^6 (35 s^2 + 18 s + 3), \qquad
+ *          \psi(r) = (1-s)_+^8 (32 s^3 + 25 s^2 + 8 s + 1), \qquad s = \sqrt{\epsilon}\, r
+ *      \f]
+ *
+ *  can also be used (the lower order ones arent smooth enough for
+ *  \f$\Phi\f$ to be continuous). Both give
+ *  \f$\Phi = \epsilon^2 a(s)\, \vec{x}\vec{x}^T + \epsilon\, b(s) I\f$ (see
+ *  DFI_Wendland32() and DFI_Wendland33()), which vanishes for
+ *  \f$r \ge 1/\sqrt{\epsilon}\f$, so \f$\epsilon = 1/R^2\f$ gives a support
+ *  radius of R. The matrix below then only has blocks for pairs of points
+ *  closer than R, and it is solved with a sparse (envelope) Cholesky
+ *  factorization (see Lgm_RBF_Sparse.c) rather than a dense LU. The cost
+ *  then grows with the number of points within R of each other rather than
+ *  with \f$n^3\f$, so much bigger neighbourhoods can be used.
+ *
+ *
  *  To find the weighting vectors \f$\vec{c}_j\f$, we make sure that the
  *  interpolation agrees with all the data that we have. This leads to a linear
  *  set of equations to solve; 
@@ -227,11 +247,78 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "Lgm/Lgm_RBF.h"
+#include "Lgm/Lgm_VecInline.h"
 
 //#define LGM_DFI_RBF_SOLVER  LGM_CHOLESKY_DECOMP
 #define LGM_DFI_RBF_SOLVER  LGM_PLU_DECOMP
 
+#define DFI_RBF_IS_WENDLAND( t )    ( ( (t) == LGM_RBF_WENDLAND32 ) || ( (t) == LGM_RBF_WENDLAND33 ) )
+
+
+/*
+ *  The Wendland kernels. With s = sqrt(e)*r and x = v - v0,
+ *
+ *      Phi         = a x x^T + b I
+ *      dPhi_ij/dxm = da xm xi xj + a ( dim xj + djm xi ) + db xm dij
+ *
+ *  where (for psi(s)) a = e^2 (psi''-psi'/s)/s^2, b = -e (psi''+psi'/s),
+ *  da = e/s da/ds and db = e/s db/ds. Everything is zero for s >= 1. (The
+ *  1/s in W32's da is harmless; it multiplies xm xi xj.) Written without
+ *  branches so that the kernel loops vectorize.
+ */
+static inline __attribute__((always_inline)) void DFI_Wendland32( double e, double r2, double *a, double *b, double *da, double *db ) {
+    double s = sqrt( e*r2 ), omr = 1.0 - s, sg, o3, o4;
+    omr = ( omr > 0.0 ) ? omr : 0.0;
+    sg  = ( s > 1e-150 ) ? s : 1e-150;
+    o3  = omr*omr*omr; o4 = o3*omr;
+    *a  = 1680.0*e*e*o4;
+    *b  = 112.0*e*o4*( 1.0 + s*( 4.0 - 20.0*s ) );
+    *da = -6720.0*e*e*e*o3/sg;
+    *db = -6720.0*e*e*o3*( 1.0 - 2.0*s );
+}
+
+static inline __attribute__((always_inline)) void DFI_Wendland33( double e, double r2, double *a, double *b, double *da, double *db ) {
+    double s = sqrt( e*r2 ), omr = 1.0 - s, o5, o6;
+    omr = ( omr > 0.0 ) ? omr : 0.0;
+    o5  = omr*omr; o5 = o5*o5*omr; o6 = o5*omr;
+    *a  = 528.0*e*e*o6*( 1.0 + 6.0*s );
+    *b  = 44.0*e*o6*( 1.0 + s*( 6.0 - s*( 3.0 + 88.0*s ) ) );
+    *da = -22176.0*e*e*e*o5;
+    *db = -1056.0*e*e*o5*( 2.0 + s*( 10.0 - 33.0*s ) );
+}
+
+static void DFI_Wendland( int Type, double e, double r2, double *a, double *b, double *da, double *db ) {
+    if ( Type == LGM_RBF_WENDLAND32 ) DFI_Wendland32( e, r2, a, b, da, db );
+    else                              DFI_Wendland33( e, r2, a, b, da, db );
+}
+
+/*
+ *  dPhi/dx_m for the Wendland kernels (m = 0, 1, 2 for x, y, z).
+ */
+static void DFI_Wendland_dPhi( int m, Lgm_Vector *v, Lgm_Vector *v0, double dP[3][3], Lgm_DFI_RBF_Info *rbf ) {
+
+    int     p, q;
+    double  X[3], a, b, da, db;
+
+    X[0] = v->x - v0->x; X[1] = v->y - v0->y; X[2] = v->z - v0->z;
+    DFI_Wendland( rbf->RadialBasisFunction, rbf->eps, X[0]*X[0] + X[1]*X[1] + X[2]*X[2], &a, &b, &da, &db );
+
+    for ( p=0; p<3; p++ ) {
+        for ( q=0; q<3; q++ ) {
+            dP[p][q] = da*X[m]*X[p]*X[q];
+            if ( p == q ) dP[p][q] += db*X[m];
+            if ( p == m ) dP[p][q] += a*X[q];
+            if ( q == m ) dP[p][q] += a*X[p];
+        }
+    }
+
+}
+
 
 /** Given \f$\vec{v} = (x, y, z)\f$ and \f$\vec{v}_0 = (x_0, y_0, z_0)\f$ this
  *  routine computes the matrix elements \f$\Phi_{ij}(x-x_0, y-y_0, z-z_0)\f$,
@@ -328,6 +415,22 @@ void    Lgm_DFI_RBF_Phi( Lgm_Vector *v, Lgm_Vector *v0, double Phi[3][3], Lgm_DF
         Phi[2][2] = -( Eps2*(x2+y2-2.0*z2) - TwoEps) *g;
         
 
+    } else if ( DFI_RBF_IS_WENDLAND( rbf->RadialBasisFunction ) ) {
+
+        DFI_Wendland( rbf->RadialBasisFunction, eps, r2, &f, &g, &psi, &psi2 );
+
+        Phi[0][0] = f*x2 + g;
+        Phi[0][1] = f*x*y;
+        Phi[0][2] = f*x*z;
+
+        Phi[1][0] = Phi[0][1];
+        Phi[1][1] = f*y2 + g;
+        Phi[1][2] = f*y*z;
+
+        Phi[2][0] = Phi[0][2];
+        Phi[2][1] = Phi[1][2];
+        Phi[2][2] = f*z2 + g;
+
     } else {
         printf("Unknown value for rbf->RadialBasisFunction. (Got %d)\n", rbf->RadialBasisFunction );
     }
@@ -415,6 +518,10 @@ void    Lgm_DFI_RBF_dPhi_dx( Lgm_Vector *v, Lgm_Vector *v0, double dPdx[3][3], L
         dPdx[2][1] = dPdx[1][2];
         dPdx[2][2] = 3.0*e2*x*( -4.0 + e*(x2+y2-4.0*z2) ) / g;
 
+    } else if ( DFI_RBF_IS_WENDLAND( rbf->RadialBasisFunction ) ) {
+
+        DFI_Wendland_dPhi( 0, v, v0, dPdx, rbf );
+
     } else {
         printf("Lgm_DFI_RBF_dPhi_dx: Unknown value for rbf->RadialBasisFunction. (Got %d)\n", rbf->RadialBasisFunction );
     }
@@ -490,6 +597,10 @@ void    Lgm_DFI_RBF_dPhi_dy( Lgm_Vector *v, Lgm_Vector *v0, double dPdy[3][3], L
         dPdy[2][1] = dPdy[1][2];
         dPdy[2][2] = 3.0*e2*y*( -4.0 + e*(x2+y2-4.0*z2) ) / g;
 
+    } else if ( DFI_RBF_IS_WENDLAND( rbf->RadialBasisFunction ) ) {
+
+        DFI_Wendland_dPhi( 1, v, v0, dPdy, rbf );
+
     } else {
         printf("Lgm_DFI_RBF_dPhi_dy: Unknown value for rbf->RadialBasisFunction. (Got %d)\n", rbf->RadialBasisFunction );
     }
@@ -565,6 +676,10 @@ void    Lgm_DFI_RBF_dPhi_dz( Lgm_Vector *v, Lgm_Vector *v0, double dPdz[3][3], L
         dPdz[2][1] = dPdz[1][2];
         dPdz[2][2] = 3.0*e2*z*( -2.0 + e*(3.0*(x2+y2)-2.0*z2) ) / g;
 
+    } else if ( DFI_RBF_IS_WENDLAND( rbf->RadialBasisFunction ) ) {
+
+        DFI_Wendland_dPhi( 2, v, v0, dPdz, rbf );
+
     } else {
         printf("Lgm_DFI_RBF_dPhi_dz: Unknown value for rbf->RadialBasisFunction. (Got %d)\n", rbf->RadialBasisFunction );
     }
@@ -576,6 +691,64 @@ void    Lgm_DFI_RBF_dPhi_dz( Lgm_Vector *v, Lgm_Vector *v0, double dPdz[3][3], L
 
 
 
+/*
+ *  Sparse solve for the Wendland kernels (see Lgm_RBF_Sparse.c). Point k (in
+ *  RCM order) gets rows 3k ... 3k+2. Fills in rbf->c and returns TRUE, or
+ *  returns FALSE if the factorization fails (e.g. repeated points), in
+ *  which case the dense solve is done instead.
+ */
+static int DFI_RBF_SparseSolve( Lgm_Vector *v, Lgm_Vector *B, Lgm_DFI_RBF_Info *rbf ) {
+
+    int             i, k, l, p, q, n = rbf->n, *Perm, *First, *First3, Ok;
+    double          Phi[3][3], *b;
+    Lgm_RBF_Skyline *m;
+
+    LGM_ARRAY_1D( Perm,   n,   int );
+    LGM_ARRAY_1D( First,  n,   int );
+    LGM_ARRAY_1D( First3, 3*n, int );
+    Lgm_RBF_SupportOrder( n, v, rbf->eps, rbf->eps, rbf->eps, Perm, First );
+    for ( k=0; k<n; k++ ) First3[3*k] = First3[3*k+1] = First3[3*k+2] = 3*First[k];
+
+    m = Lgm_RBF_Skyline_Alloc( 3*n, First3 );
+    for ( k=0; k<n; k++ ) {
+        for ( l=First[k]; l<=k; l++ ) {
+            Lgm_DFI_RBF_Phi( &v[Perm[k]], &v[Perm[l]], Phi, rbf );
+            for ( p=0; p<3; p++ ) {
+                for ( q=0; q<3; q++ ) {
+                    if ( 3*l+q <= 3*k+p ) LGM_SKYLINE( m, 3*k+p, 3*l+q ) = Phi[p][q];
+                }
+            }
+        }
+    }
+
+    if ( (Ok = Lgm_RBF_Skyline_Cholesky( m )) ) {
+        LGM_ARRAY_1D( b, 3*n, double );
+        for ( k=0; k<n; k++ ) {
+            i = Perm[k];
+            b[3*k]   = B[i].x - rbf->Bx0;
+            b[3*k+1] = B[i].y - rbf->By0;
+            b[3*k+2] = B[i].z - rbf->Bz0;
+        }
+        Lgm_RBF_Skyline_Solve( m, b );
+        for ( k=0; k<n; k++ ) {
+            i = Perm[k];
+            rbf->c[i].x = rbf->cx[i] = b[3*k];
+            rbf->c[i].y = rbf->cy[i] = b[3*k+1];
+            rbf->c[i].z = rbf->cz[i] = b[3*k+2];
+        }
+        LGM_ARRAY_1D_FREE( b );
+    }
+
+    Lgm_RBF_Skyline_Free( m );
+    LGM_ARRAY_1D_FREE( First3 );
+    LGM_ARRAY_1D_FREE( First );
+    LGM_ARRAY_1D_FREE( Perm );
+
+    return( Ok );
+
+}
+
+
 /** From a vector-field dataset, compute the vector-valued weighting factors,
  *  \f$\vec{c}_j\f$. Info is returned in the rbf structure.
  *
@@ -584,10 +757,14 @@ void    Lgm_DFI_RBF_dPhi_dz( Lgm_Vector *v, Lgm_Vector *v0, double dPdz[3][3], L
  *  \param[in]                       B   -   pointer to array of corresponding field vectors.
  *  \param[in]                       n   -   number of (v, B) pairs defined.
  *  \param[in]                     eps   -   smoothing factor in scalar RBF.
- *  \param[in]      RadialBasisFunction  -   RBF to use. Can be LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC
+ *  \param[in]      RadialBasisFunction  -   RBF to use. Can be LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC,
+ *                                           LGM_RBF_INV_MULTIQUADRIC, LGM_RBF_WENDLAND32 or LGM_RBF_WENDLAND33.
+ *                                           (For the Wendlands the support radius is 1/sqrt(eps), and the
+ *                                           system is solved sparsely.)
  *
  *  \return  pointer to structure containing info for RBF interpolation. User
- *           is responsible for freeing with Lgm_DFI_RBF_Free().
+ *           is responsible for freeing with Lgm_DFI_RBF_Free(). NULL if
+ *           RadialBasisFunction cant be used for div-free interpolation.
  *
  *  \author  M. G. Henderson
  *  date    January 24, 2012
@@ -602,11 +779,12 @@ Lgm_DFI_RBF_Info *Lgm_DFI_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
     gsl_vector       *D, *c, *S, *Work;
     Lgm_DFI_RBF_Info *rbf;
 
-    n3 = 3*n;
-    A = gsl_matrix_calloc( n3, n3 );
-    c = gsl_vector_alloc( n3 );
-    D = gsl_vector_calloc( n3 );
+    if ( ( RadialBasisFunction == LGM_RBF_WENDLAND30 ) || ( RadialBasisFunction == LGM_RBF_WENDLAND31 ) ) {
+        printf("Lgm_DFI_RBF_Init: LGM_RBF_WENDLAND30 and LGM_RBF_WENDLAND31 arent smooth enough for div-free interpolation. Use LGM_RBF_WENDLAND32 or LGM_RBF_WENDLAND33.\n" );
+        return( NULL );
+    }
 
+    n3 = 3*n;
 
     /*
      * Save info needed to do an evaluation.
@@ -619,9 +797,18 @@ Lgm_DFI_RBF_Info *Lgm_DFI_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
     LGM_ARRAY_1D( rbf->LookUpKey, n, unsigned long int);
     LGM_ARRAY_1D( rbf->v, n, Lgm_Vector);
     LGM_ARRAY_1D( rbf->c, n, Lgm_Vector);
+    LGM_ARRAY_1D( rbf->vx, n, double);
+    LGM_ARRAY_1D( rbf->vy, n, double);
+    LGM_ARRAY_1D( rbf->vz, n, double);
+    LGM_ARRAY_1D( rbf->cx, n, double);
+    LGM_ARRAY_1D( rbf->cy, n, double);
+    LGM_ARRAY_1D( rbf->cz, n, double);
     for ( i=0; i<n; i++ ) {
         rbf->LookUpKey[i] = I_data[i];
         rbf->v[i] = v[i];
+        rbf->vx[i] = v[i].x;
+        rbf->vy[i] = v[i].y;
+        rbf->vz[i] = v[i].z;
     }
     // This subtraction doesntm seem to work out very well...
 //    rbf->Bx0 = B[0].x;
@@ -635,6 +822,12 @@ for ( Bbkg = 0.0, i=0; i<n; i++ ) Bbkg += B[i].z; rbf->Bz0 = Bbkg/(double)n;
     rbf->Bx0 = 0.0;
     rbf->By0 = 0.0;
     rbf->Bz0 = 0.0;
+
+    if ( DFI_RBF_IS_WENDLAND( RadialBasisFunction ) && DFI_RBF_SparseSolve( v, B, rbf ) ) return( rbf );
+
+    A = gsl_matrix_calloc( n3, n3 );
+    c = gsl_vector_alloc( n3 );
+    D = gsl_vector_calloc( n3 );
     
     /*
      * Fill d array. (Subtract off the field at the nearest point v[0] -- See
@@ -722,6 +915,9 @@ for ( Bbkg = 0.0, i=0; i<n; i++ ) Bbkg += B[i].z; rbf->Bz0 = Bbkg/(double)n;
         rbf->c[i].x = gsl_vector_get( c, 3*i+0 );
         rbf->c[i].y = gsl_vector_get( c, 3*i+1 );
         rbf->c[i].z = gsl_vector_get( c, 3*i+2 );
+        rbf->cx[i] = rbf->c[i].x;
+        rbf->cy[i] = rbf->c[i].y;
+        rbf->cz[i] = rbf->c[i].z;
     }
 
 
@@ -750,6 +946,12 @@ void    Lgm_DFI_RBF_Free( Lgm_DFI_RBF_Info *rbf ) {
     LGM_ARRAY_1D_FREE( rbf->LookUpKey );
     LGM_ARRAY_1D_FREE( rbf->v );
     LGM_ARRAY_1D_FREE( rbf->c );
+    LGM_ARRAY_1D_FREE( rbf->vx );
+    LGM_ARRAY_1D_FREE( rbf->vy );
+    LGM_ARRAY_1D_FREE( rbf->vz );
+    LGM_ARRAY_1D_FREE( rbf->cx );
+    LGM_ARRAY_1D_FREE( rbf->cy );
+    LGM_ARRAY_1D_FREE( rbf->cz );
     free( rbf );
     return;
 }
@@ -760,6 +962,220 @@ void    Lgm_DFI_RBF_Free( Lgm_DFI_RBF_Info *rbf ) {
 
 
 
+/*
+ *  Evaluation kernels.
+ *
+ *  These sum Phi c_j (and, if DoDerivs is set, dPhi/dx c_j, dPhi/dy c_j and
+ *  dPhi/dz c_j) over all of the centres in one pass, working from the SoA
+ *  copies of the centres and weights (rbf->vx, ... rbf->cz). The exp() or
+ *  sqrt() is done once per centre and shared by Phi and its derivatives, and
+ *  the (symmetric) matrices are never formed. The expressions are the same
+ *  as in Lgm_DFI_RBF_Phi(), Lgm_DFI_RBF_dPhi_dx(), etc.
+ *
+ *  S[0..2] gets B and S[3..11] gets dB/dx, dB/dy, dB/dz (x, y and z comps of
+ *  each).
+ */
+#define DFI_SYM_MV( a00, a01, a02, a11, a12, a22, Sx, Sy, Sz ) {                 \
+            Sx += (a00)*cx[j] + (a01)*cy[j] + (a02)*cz[j];                      \
+            Sy += (a01)*cx[j] + (a11)*cy[j] + (a12)*cz[j];                      \
+            Sz += (a02)*cx[j] + (a12)*cy[j] + (a22)*cz[j]; }
+
+/*
+ *  Loops for the Wendland kernels (W is DFI_Wendland32 or DFI_Wendland33).
+ *  Centres out of reach give zeros, they arent skipped.
+ */
+#define DFI_WENDLAND_LOOPS( W ) {                                                                       \
+        if ( !DoDerivs ) {                                                                              \
+            LGM_DFI_RBF_SIMD                                                                            \
+            for ( j=0; j<n; j++ ){                                                                      \
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j], a, b, da, db;                   \
+                W( e, x*x + y*y + z*z, &a, &b, &da, &db );                                              \
+                DFI_SYM_MV( a*x*x + b, a*x*y, a*x*z, a*y*y + b, a*y*z, a*z*z + b, Bx, By, Bz );         \
+            }                                                                                           \
+        } else {                                                                                        \
+            LGM_DFI_RBF_SIMD                                                                            \
+            for ( j=0; j<n; j++ ){                                                                      \
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j], a, b, da, db;                   \
+                W( e, x*x + y*y + z*z, &a, &b, &da, &db );                                              \
+                DFI_SYM_MV( a*x*x + b, a*x*y, a*x*z, a*y*y + b, a*y*z, a*z*z + b, Bx, By, Bz );         \
+                double xx = da*x*x, yy = da*y*y, zz = da*z*z, xyz = da*x*y*z;                           \
+                DFI_SYM_MV( (xx + 2.0*a + db)*x, (xx + a)*y, (xx + a)*z,                                \
+                            (yy + db)*x, xyz, (zz + db)*x, Bxx, Byx, Bzx );                             \
+                DFI_SYM_MV( (xx + db)*y, (yy + a)*x, xyz,                                               \
+                            (yy + 2.0*a + db)*y, (yy + a)*z, (zz + db)*y, Bxy, Byy, Bzy );              \
+                DFI_SYM_MV( (xx + db)*z, xyz, (zz + a)*x,                                               \
+                            (yy + db)*z, (zz + a)*y, (zz + 2.0*a + db)*z, Bxz, Byz, Bzz );              \
+            }                                                                                           \
+        } }
+
+#if USE_OPENMP
+#define LGM_DFI_RBF_SIMD    _Pragma( "omp simd reduction(+:Bx,By,Bz,Bxx,Byx,Bzx,Bxy,Byy,Bzy,Bxz,Byz,Bzz)" )
+#else
+#define LGM_DFI_RBF_SIMD
+#endif
+
+static inline void DFI_RBF_Kernel( double x0, double y0, double z0, Lgm_DFI_RBF_Info *rbf, int DoDerivs, double *S ) {
+
+    int             j, n, Type;
+    const double    *vx, *vy, *vz, *cx, *cy, *cz;
+    double          e, e2, e3, Bx, By, Bz, Bxx, Byx, Bzx, Bxy, Byy, Bzy, Bxz, Byz, Bzz;
+
+    n  = rbf->n; Type = rbf->RadialBasisFunction;
+    vx = rbf->vx; vy = rbf->vy; vz = rbf->vz;
+    cx = rbf->cx; cy = rbf->cy; cz = rbf->cz;
+    e  = rbf->eps; e2 = e*e; e3 = e2*e;
+
+    Bx = By = Bz = 0.0;
+    Bxx = Byx = Bzx = Bxy = Byy = Bzy = Bxz = Byz = Bzz = 0.0;
+
+    if ( Type == LGM_RBF_GAUSSIAN ) {
+
+        double f = 4.0*e, g = f*e, h = 8.0*e2;
+
+        if ( !DoDerivs ) {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z;
+                double psi = exp( -e*(x2 + y2 + z2) );
+                DFI_SYM_MV( ( f - g*(y2 + z2) ) * psi, g*x*y*psi, g*x*z*psi,
+                            ( f - g*(x2 + z2) ) * psi, g*y*z*psi,
+                            ( f - g*(x2 + y2) ) * psi, Bx, By, Bz );
+            }
+        } else {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z;
+                double psi = exp( -e*(x2 + y2 + z2) );
+                DFI_SYM_MV( ( f - g*(y2 + z2) ) * psi, g*x*y*psi, g*x*z*psi,
+                            ( f - g*(x2 + z2) ) * psi, g*y*z*psi,
+                            ( f - g*(x2 + y2) ) * psi, Bx, By, Bz );
+                double xyz = -8.0*e3*x*y*z * psi;
+                DFI_SYM_MV( h*x*( e*(y2 + z2) - 1.0 ) * psi, g*y*(1.0 - 2.0*e*x2) * psi, g*z*(1.0 - 2.0*e*x2) * psi,
+                            h*x*( e*(x2 + z2) - 2.0 ) * psi, xyz,
+                            h*x*( e*(x2 + y2) - 2.0 ) * psi, Bxx, Byx, Bzx );
+                DFI_SYM_MV( h*y*( e*(y2 + z2) - 2.0 ) * psi, g*x*(1.0 - 2.0*e*y2) * psi, xyz,
+                            h*y*( e*(x2 + z2) - 1.0 ) * psi, g*z*(1.0 - 2.0*e*y2) * psi,
+                            h*y*( e*(x2 + y2) - 2.0 ) * psi, Bxy, Byy, Bzy );
+                DFI_SYM_MV( h*z*( e*(y2 + z2) - 2.0 ) * psi, xyz, g*x*(1.0 - 2.0*e*z2) * psi,
+                            h*z*( e*(x2 + z2) - 2.0 ) * psi, g*y*(1.0 - 2.0*e*z2) * psi,
+                            h*z*( e*(x2 + y2) - 1.0 ) * psi, Bxz, Byz, Bzz );
+            }
+        }
+
+    } else if ( Type == LGM_RBF_MULTIQUADRIC ) {
+
+        double TwoEps = 2.0*e;
+
+        if ( !DoDerivs ) {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z, r2 = x2 + y2 + z2;
+                double f = 1.0 + e*r2, psi = sqrt( f );
+                double g = 1.0/(psi*f);     // 1/f^(3/2)
+                DFI_SYM_MV( -( e2*(r2+x2) + TwoEps )*g, -e2*x*y*g, -e2*x*z*g,
+                            -( e2*(r2+y2) + TwoEps )*g, -e2*y*z*g,
+                            -( e2*(r2+z2) + TwoEps )*g, Bx, By, Bz );
+            }
+        } else {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z, r2 = x2 + y2 + z2;
+                double f = 1.0 + e*r2, psi = sqrt( f );
+                double g = 1.0/(psi*f);     // 1/f^(3/2)
+                DFI_SYM_MV( -( e2*(r2+x2) + TwoEps )*g, -e2*x*y*g, -e2*x*z*g,
+                            -( e2*(r2+y2) + TwoEps )*g, -e2*y*z*g,
+                            -( e2*(r2+z2) + TwoEps )*g, Bx, By, Bz );
+                double h = g/f;         // 1/f^(5/2)
+                double xyz = 3.0*e3*x*y*z*h;
+                double a = e*(y2+z2-2.0*x2), b = e*(x2-2.0*y2+z2), c = e*(x2+y2-2.0*z2);
+                DFI_SYM_MV( e2*x*(2.0 - a)*h, -e2*y*(1.0 + a)*h, -e2*z*(1.0 + a)*h,
+                            e2*x*(4.0 + e*(x2+4.0*y2+z2))*h, xyz,
+                            e2*x*(4.0 + e*(x2+y2+4.0*z2))*h, Bxx, Byx, Bzx );
+                DFI_SYM_MV( e2*y*(4.0 + e*(4.0*x2+y2+z2))*h, -e2*x*(1.0 + b)*h, xyz,
+                            e2*y*(2.0 - b)*h, -e2*z*(1.0 + b)*h,
+                            e2*y*(4.0 + e*(x2+y2+4.0*z2))*h, Bxy, Byy, Bzy );
+                DFI_SYM_MV( e2*z*(4.0 + e*(4.0*x2+y2+z2))*h, xyz, -e2*x*(1.0 + c)*h,
+                            e2*z*(4.0 + e*(x2+4.0*y2+z2))*h, -e2*y*(1.0 + c)*h,
+                            e2*z*(2.0 - c)*h, Bxz, Byz, Bzz );
+            }
+        }
+
+    } else if ( Type == LGM_RBF_WENDLAND32 ) {
+
+        DFI_WENDLAND_LOOPS( DFI_Wendland32 );
+
+    } else if ( Type == LGM_RBF_WENDLAND33 ) {
+
+        DFI_WENDLAND_LOOPS( DFI_Wendland33 );
+
+    } else { // LGM_RBF_INV_MULTIQUADRIC
+
+        double TwoEps = 2.0*e;
+
+        if ( !DoDerivs ) {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z, r2 = x2 + y2 + z2;
+                double f = 1.0 + e*r2, psi = sqrt( f );
+                double g = 1.0/(psi*f);     // 1/f^(3/2)
+                DFI_SYM_MV( -( e2*(-2.0*x2+y2+z2) - TwoEps )*g, 3.0*e2*x*y*g, 3.0*e2*x*z*g,
+                            -( e2*(x2-2.0*y2+z2) - TwoEps )*g, 3.0*e2*y*z*g,
+                            -( e2*(x2+y2-2.0*z2) - TwoEps )*g, Bx, By, Bz );
+            }
+        } else {
+            LGM_DFI_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double x = x0 - vx[j], y = y0 - vy[j], z = z0 - vz[j];
+                double x2 = x*x, y2 = y*y, z2 = z*z, r2 = x2 + y2 + z2;
+                double f = 1.0 + e*r2, psi = sqrt( f );
+                double g = 1.0/(psi*f);     // 1/f^(3/2)
+                DFI_SYM_MV( -( e2*(-2.0*x2+y2+z2) - TwoEps )*g, 3.0*e2*x*y*g, 3.0*e2*x*z*g,
+                            -( e2*(x2-2.0*y2+z2) - TwoEps )*g, 3.0*e2*y*z*g,
+                            -( e2*(x2+y2-2.0*z2) - TwoEps )*g, Bx, By, Bz );
+                double q = g/(f*f);     // 1/f^(7/2)
+                double h = 3.0*e2*q;
+                double xyz = -15.0*e3*x*y*z*q;
+                DFI_SYM_MV( h*x*( -2.0 + e*(-2.0*x2+3.0*(y2+z2)) ), h*y*( 1.0 + e*(-4.0*x2+y2+z2) ), h*z*( 1.0 + e*(-4.0*x2+y2+z2) ),
+                            h*x*( -4.0 + e*(x2-4.0*y2+z2) ), xyz,
+                            h*x*( -4.0 + e*(x2+y2-4.0*z2) ), Bxx, Byx, Bzx );
+                DFI_SYM_MV( h*y*( -4.0 + e*(-4.0*x2+y2+z2) ), h*x*( 1.0 + e*(x2-4.0*y2+z2) ), xyz,
+                            h*y*( -2.0 + e*(3.0*(x2+z2)-2.0*y2) ), h*z*( 1.0 + e*(x2-4.0*y2+z2) ),
+                            h*y*( -4.0 + e*(x2+y2-4.0*z2) ), Bxy, Byy, Bzy );
+                DFI_SYM_MV( h*z*( -4.0 + e*(-4.0*x2+y2+z2) ), xyz, h*x*( 1.0 + e*(x2+y2-4.0*z2) ),
+                            h*z*( -4.0 + e*(x2-4.0*y2+z2) ), h*y*( 1.0 + e*(x2+y2-4.0*z2) ),
+                            h*z*( -2.0 + e*(3.0*(x2+y2)-2.0*z2) ), Bxz, Byz, Bzz );
+            }
+        }
+
+    }
+
+    S[0] = Bx;  S[1]  = By;  S[2]  = Bz;
+    S[3] = Bxx; S[4]  = Byx; S[5]  = Bzx;
+    S[6] = Bxy; S[7]  = Byy; S[8]  = Bzy;
+    S[9] = Bxz; S[10] = Byz; S[11] = Bzz;
+
+    return;
+
+}
+
+/*
+ *  Returns TRUE if rbf can be evaluated with DFI_RBF_Kernel().
+ */
+static inline int DFI_RBF_HaveKernel( Lgm_DFI_RBF_Info *rbf ) {
+    return( ( rbf->vx != NULL ) && (    ( rbf->RadialBasisFunction == LGM_RBF_GAUSSIAN )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_MULTIQUADRIC )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_INV_MULTIQUADRIC )
+                                     || DFI_RBF_IS_WENDLAND( rbf->RadialBasisFunction ) ) );
+}
+
+
+
+
 /**  Compute Divergence Free interpolant at the specified position vector. The
  *   weights given in \f$\vec{c}\f$ must have been pre-computed with
  *   Lgm_DFI_RBF_Init().
@@ -780,8 +1196,16 @@ void    Lgm_DFI_RBF_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_DFI_RBF_Info *rbf )
 
     int         j;
     Lgm_Vector  W;
-    double      Phi[3][3];
+    double      Phi[3][3], S[12];
+
 
+    if ( DFI_RBF_HaveKernel( rbf ) ) {
+        DFI_RBF_Kernel( v->x, v->y, v->z, rbf, FALSE, S );
+        B->x = S[0] + rbf->Bx0;
+        B->y = S[1] + rbf->By0;
+        B->z = S[2] + rbf->Bz0;
+        return;
+    }
 
     B->x = B->y = B->z = 0.0;
     for ( j=0; j<rbf->n; j++ ){
@@ -831,8 +1255,16 @@ void    Lgm_DFI_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dB
 
     int         j;
     Lgm_Vector  W;
-    double      P[3][3];
+    double      P[3][3], S[12];
+
 
+    if ( DFI_RBF_HaveKernel( rbf ) ) {
+        DFI_RBF_Kernel( v->x, v->y, v->z, rbf, TRUE, S );
+        dBdx->x = S[3]; dBdx->y = S[4];  dBdx->z = S[5];
+        dBdy->x = S[6]; dBdy->y = S[7];  dBdy->z = S[8];
+        dBdz->x = S[9]; dBdz->y = S[10]; dBdz->z = S[11];
+        return;
+    }
 
     dBdx->x = dBdx->y = dBdx->z = 0.0;
     dBdy->x = dBdy->y = dBdy->z = 0.0;
@@ -859,3 +1291,45 @@ void    Lgm_DFI_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dB
 }
 
 
+
+
+
+/**  Compute the Divergence Free interpolant and its derivatives at the
+ *   specified position vector. Gives the same results as Lgm_DFI_RBF_Eval()
+ *   followed by Lgm_DFI_RBF_Derivs_Eval(), but does it in a single pass over
+ *   the centres.
+ *
+ *
+ *  \param[in]         v   -   position vector to compute B at.
+ *  \param[out]        B   -   interpolated value of B at v.
+ *  \param[out]     dBdx   -   interpolated value of dB/dx at v.
+ *  \param[out]     dBdy   -   interpolated value of dB/dy at v.
+ *  \param[out]     dBdz   -   interpolated value of dB/dz at v.
+ *  \param[in]       rbf   -   pointer to initialized Lgm_DFI_RBF_Info structure.
+ *
+ *  \return  void
+ *
+ */
+void    Lgm_DFI_RBF_EvalAll( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_DFI_RBF_Info *rbf ) {
+
+    double      S[12];
+
+    if ( !DFI_RBF_HaveKernel( rbf ) ) {
+        Lgm_DFI_RBF_Eval( v, B, rbf );
+        Lgm_DFI_RBF_Derivs_Eval( v, dBdx, dBdy, dBdz, rbf );
+        return;
+    }
+
+    DFI_RBF_Kernel( v->x, v->y, v->z, rbf, TRUE, S );
+    B->x    = S[0] + rbf->Bx0;
+    B->y    = S[1] + rbf->By0;
+    B->z    = S[2] + rbf->Bz0;
+    dBdx->x = S[3]; dBdx->y = S[4];  dBdx->z = S[5];
+    dBdy->x = S[6]; dBdy->y = S[7];  dBdy->z = S[8];
+    dBdz->x = S[9]; dBdz->y = S[10]; dBdz->z = S[11];
+
+    return;
+
+}
+
+
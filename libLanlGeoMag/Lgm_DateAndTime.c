@@ -35,6 +35,7 @@ int Lgm_LeapYear(int year) {
  * Lgm_GetLeapSeconds()
  * Lgm_IsLeapSecondDay()
  * Lgm_LoadLeapSeconds()
+ * Lgm_ReleaseLeapSeconds()
  *
  *
  * Leap seconds are added when necessary. First preference is given to
@@ -75,22 +76,33 @@ int Lgm_LeapYear(int year) {
 double Lgm_GetLeapSeconds( double JD, Lgm_CTrans *c ) {
 
     Lgm_LeapSeconds *l;
-    int             i;
+    int             i, lo, hi, n;
     double          MJD, TAI_Minus_UTC = 0.0;
 
     l = &(c->l);
+    n = l->nLeapSecondDates;
 
     /*
      * For dates 1972 to present, leap seconds are stored in the
-     * Lgm_LeapSeconds structure.
-     * Parse list in reverse order.
+     * Lgm_LeapSeconds structure. We want the last entry with JD >=
+     * LeapSecondJDs[i]. Time series are usually monotone, so try the entry
+     * found last time first, then fall back to a binary search.
      */
-    for (i=l->nLeapSecondDates-1; i>=0; i--) {
-        // do > and not >= here because the 86400th second is still before the leap second
-        if ( JD >= l->LeapSecondJDs[i] ) {
-            TAI_Minus_UTC = l->LeapSeconds[i];
-            return( TAI_Minus_UTC );
+    if ( ( n > 0 ) && ( JD >= l->LeapSecondJDs[0] ) ) {
+        i = l->Cursor;
+        if ( ( i < 0 ) || ( i >= n ) || ( JD < l->LeapSecondJDs[i] ) || ( ( i < n-1 ) && ( JD >= l->LeapSecondJDs[i+1] ) ) ) {
+            lo = 0; hi = n;     // LeapSecondJDs[lo] <= JD < LeapSecondJDs[hi]  (hi == n means +infinity)
+            while ( hi - lo > 1 ) {
+                i = ( lo + hi )/2;
+                // do >= here because the 86400th second is still before the leap second
+                if ( JD >= l->LeapSecondJDs[i] ) lo = i;
+                else                             hi = i;
+            }
+            i = lo;
+            l->Cursor = i;
         }
+        TAI_Minus_UTC = l->LeapSeconds[i];
+        return( TAI_Minus_UTC );
     }
 
     /*
@@ -126,16 +138,20 @@ double Lgm_GetLeapSeconds( double JD, Lgm_CTrans *c ) {
 int Lgm_IsLeapSecondDay( long int Date, double *SecondsInDay, Lgm_CTrans *c ) {
 
     Lgm_LeapSeconds *l;
-    int             i;
+    int             i, lo, hi;
 
     l = &(c->l);
 
     /*
-     * Parse list in reverse order.
+     * Binary search of the (ascending) list of dates.
      */
     *SecondsInDay = 86400.0;
-    for (i=l->nLeapSecondDates-1; i>=0; i--) {
-        if ( Date == l->LeapSecondDates[i] ) {
+    lo = 0; hi = l->nLeapSecondDates-1;
+    while ( lo <= hi ) {
+        i = ( lo + hi )/2;
+        if      ( Date > l->LeapSecondDates[i] ) lo = i+1;
+        else if ( Date < l->LeapSecondDates[i] ) hi = i-1;
+        else {
             if (i > 0) {
                 if ( (l->LeapSeconds[i] - l->LeapSeconds[i-1]) > 0.0) {
                     *SecondsInDay = 86401.0;
@@ -153,20 +169,28 @@ int Lgm_IsLeapSecondDay( long int Date, double *SecondsInDay, Lgm_CTrans *c ) {
 
 
 
+/*
+ *  The leap second table is the same for every Lgm_CTrans, so it is read only
+ *  once and shared (read-only) by all of them. Each Lgm_CTrans that points at
+ *  it holds a reference; the table is freed when the last one is released.
+ *  The table and its reference count are only touched inside the
+ *  Lgm_LeapSecondTable critical section.
+ */
+static Lgm_LeapSeconds  Lgm_LeapSecondTable;
+static int              Lgm_LeapSecondTable_nRefs = 0;
+
+
 /*
  * Reads in the file containing leap second info and packs the results into a
- * Lgm_LeapSeconds Structure contained in the Lgm_CTrans structure.
+ * Lgm_LeapSeconds Structure.
  */
-int Lgm_LoadLeapSeconds( Lgm_CTrans  *c ) {
+static int Lgm_ReadLeapSecondTable( Lgm_LeapSeconds *l ) {
 
-    Lgm_LeapSeconds *l;
     int              i, n=0, N=50, Year, Month, Day;
     char             Line[513], LeapSecondFile[512];
     double           JD, Time;
     FILE             *fp;
 
-    l = &(c->l);
-
     sprintf( LeapSecondFile, "%s/%s", LGM_EOP_DATA_DIR, "/Lgm_LeapSecondDates.dat");
     //printf("File = %s\n", LeapSecondFile );
     
@@ -245,6 +269,7 @@ int Lgm_LoadLeapSeconds( Lgm_CTrans  *c ) {
         l->LeapSecondDates[24] = 20090101, l->LeapSecondJDs[24] = 2454832.5, l->LeapSeconds[24] = 34.0;
         l->LeapSecondDates[25] = 20120701, l->LeapSecondJDs[25] = 2456109.5, l->LeapSeconds[25] = 35.0;
         l->LeapSecondDates[26] = 20150701, l->LeapSecondJDs[26] = 2457204.5, l->LeapSeconds[26] = 36.0;
+        n = N;
         printf("Lgm_LoadLeapSeconds: Could not open Lgm_LeapSecondDates.dat file!\n");
         printf("                     Setting the leap second values that I know about\n");
         printf("                     (latest leap second I know about was introduced on\n");
@@ -269,6 +294,71 @@ int Lgm_LoadLeapSeconds( Lgm_CTrans  *c ) {
 }
 
 
+/*
+ *  Points c->l at the process-wide leap second table (reading it on first
+ *  use) and takes a reference on it. Every Lgm_LoadLeapSeconds() should be
+ *  matched by a Lgm_ReleaseLeapSeconds() (Lgm_free_ctrans() does this).
+ *  Calling it again on a Lgm_CTrans that already holds the table does nothing.
+ */
+int Lgm_LoadLeapSeconds( Lgm_CTrans  *c ) {
+
+    int     Status = TRUE;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LeapSecondTable)
+#endif
+    {
+        if ( ( Lgm_LeapSecondTable_nRefs == 0 ) || ( c->l.LeapSeconds != Lgm_LeapSecondTable.LeapSeconds ) ) {
+            if ( Lgm_LeapSecondTable_nRefs == 0 ) {
+                Status = Lgm_ReadLeapSecondTable( &Lgm_LeapSecondTable );
+            }
+            if ( Status == TRUE ) {
+                ++Lgm_LeapSecondTable_nRefs;
+                c->l = Lgm_LeapSecondTable;
+            } else {
+                c->l.nLeapSecondDates = 0;
+                c->l.LeapSecondDates  = NULL;
+                c->l.LeapSecondJDs    = NULL;
+                c->l.LeapSeconds      = NULL;
+            }
+        }
+    }
+
+    return( Status );
+
+}
+
+
+/*
+ *  Drops c's reference on the shared leap second table (freeing the table if
+ *  it was the last one) and clears c->l.
+ */
+void Lgm_ReleaseLeapSeconds( Lgm_CTrans  *c ) {
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LeapSecondTable)
+#endif
+    {
+        if ( ( Lgm_LeapSecondTable_nRefs > 0 ) && ( c->l.LeapSeconds != NULL ) && ( c->l.LeapSeconds == Lgm_LeapSecondTable.LeapSeconds ) ) {
+            if ( --Lgm_LeapSecondTable_nRefs == 0 ) {
+                free( Lgm_LeapSecondTable.LeapSecondDates );
+                free( Lgm_LeapSecondTable.LeapSecondJDs );
+                free( Lgm_LeapSecondTable.LeapSeconds );
+                Lgm_LeapSecondTable.nLeapSecondDates = 0;
+                Lgm_LeapSecondTable.LeapSecondDates  = NULL;
+                Lgm_LeapSecondTable.LeapSecondJDs    = NULL;
+                Lgm_LeapSecondTable.LeapSeconds      = NULL;
+            }
+        }
+        c->l.nLeapSecondDates = 0;
+        c->l.LeapSecondDates  = NULL;
+        c->l.LeapSecondJDs    = NULL;
+        c->l.LeapSeconds      = NULL;
+    }
+
+}
+
+
 
 
 /*
@@ -1084,6 +1174,161 @@ void Lgm_DateTimeToString( char *Str, Lgm_DateTime *DT, int Style, int p ){
 }
 
 
+/*
+ *  "00" ... "99"
+ */
+static const char Lgm_IsoTime_Digits2[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const long int Lgm_IsoTime_Pow10[] = { 1L, 10L, 100L, 1000L, 10000L, 100000L, 1000000L, 10000000L, 100000000L, 1000000000L };
+
+#define LGM_ISOTIME_PUT2( s, n )    { (s)[0] = Lgm_IsoTime_Digits2[2*(n)]; (s)[1] = Lgm_IsoTime_Digits2[2*(n)+1]; }
+
+/*
+ *  The fields Lgm_DateTimeToString() would print (rounding, leap second and
+ *  all). FALSE if they dont fit the fixed width layout.
+ */
+static int Lgm_IsoTime_Fields( Lgm_DateTime *DT, int p, int *HH, int *MM, int *SS, long int *Frac ) {
+
+    int         leapsec;
+    double      S, SFRAC, Seconds, TotalSeconds;
+
+    if ( ( p > 9 ) || ( DT->Date < 10000000L ) || ( DT->Date > 99991231L ) ) return( FALSE );
+
+    leapsec = (int)(DT->DaySeconds - 86400.0);
+
+    Seconds = TotalSeconds = DT->Time*3600.0;
+    *HH = (int)(Seconds/3600.0); Seconds -= *HH*3600.0;
+    *MM = (int)(Seconds/60.0);   Seconds -= *MM*60.0;
+
+    S     = fabs(Seconds)+pow(10.0, -1.0-p );
+    *SS   = (int)S;
+    SFRAC = S-(double)*SS;
+    *Frac = 0;
+    if ( p <= 0 ) {
+        if ( SFRAC >= 0.5 ) *SS += 1;
+    } else {
+        // Lgm_DateTimeToString() prints the fraction with %.*lf and doesnt carry out of it
+        *Frac = (long int)rint( SFRAC*Lgm_IsoTime_Pow10[p] ) % Lgm_IsoTime_Pow10[p];
+    }
+
+    if ( leapsec && (TotalSeconds>=86400.0) && (TotalSeconds<86401.0) ){
+        *HH = 23; *MM = 59; *SS = 60;
+    } else {
+        if ( *SS == 60 ) { *SS = 0; ++*MM; }
+        if ( *MM == 60 ) { *MM = 0; ++*HH; }
+    }
+
+    return( ( *HH >= 0 ) && ( *HH <= 99 ) && ( *MM >= 0 ) && ( *SS >= 0 ) && ( *SS <= 99 ) );
+
+}
+
+/**
+ *  \brief
+ *      ISO 8601 time string for DT without any sprintf()'ing.
+ *
+ *  \details
+ *      Gives the same string as Lgm_DateTimeToString( Str, DT, 0, p ) (i.e.
+ *      YYYY-MM-DDTHH:MM:SS[.fff][Z]), but builds it from a digit table in
+ *      f->Str. f remembers the last time it was given, so for a run of times
+ *      on the same day (the usual case for the writers) only the seconds
+ *      (and minutes, etc. when they roll over) digits get rewritten. Times
+ *      that dont fit the fixed layout (p > 9, years outside 1000-9999) are
+ *      handed to Lgm_DateTimeToString().
+ *
+ *      A zeroed Lgm_IsoTimeFormatter is ready to use. It holds no pointers,
+ *      so each thread can have its own copy.
+ *
+ *      \param[in,out]  f       Formatter.
+ *      \param[in]      DT      The time.
+ *      \param[in]      p       Number of decimals on the seconds.
+ *
+ *      \return         f->Str
+ */
+char *Lgm_IsoTimeFormatter_Put( Lgm_IsoTimeFormatter *f, Lgm_DateTime *DT, int p ) {
+
+    int         HH, MM, SS, Year, Month, Day, i, n;
+    long int    Frac, OldFrac;
+    char        *s = f->Str;
+
+    if ( p < 0 ) p = 0;
+    if ( !Lgm_IsoTime_Fields( DT, p, &HH, &MM, &SS, &Frac ) ) {
+        Lgm_DateTimeToString( s, DT, 0, p );
+        f->Len   = strlen( s );
+        f->Valid = FALSE;
+        return( s );
+    }
+
+    if ( !f->Valid || ( f->p != p ) || ( f->Date != DT->Date ) || ( f->TimeSystem != DT->TimeSystem ) ) {
+
+        Year = DT->Date/10000; Month = (DT->Date/100)%100; Day = DT->Date%100;
+        LGM_ISOTIME_PUT2( s,   Year/100 );
+        LGM_ISOTIME_PUT2( s+2, Year%100 ); s[4] = '-';
+        LGM_ISOTIME_PUT2( s+5, Month );    s[7] = '-';
+        LGM_ISOTIME_PUT2( s+8, Day );      s[10] = 'T';
+        LGM_ISOTIME_PUT2( s+11, HH );      s[13] = ':';
+        LGM_ISOTIME_PUT2( s+14, MM );      s[16] = ':';
+        LGM_ISOTIME_PUT2( s+17, SS );
+        n = 19;
+        if ( p > 0 ) {
+            s[n++] = '.';
+            for ( OldFrac = Frac, i=p-1; i>=0; i--, OldFrac /= 10 ) s[n+i] = '0' + OldFrac%10;
+            n += p;
+        }
+        if ( DT->TimeSystem == LGM_TIME_SYS_UTC ) s[n++] = 'Z';
+        s[n] = '\0';
+
+        f->Len        = n;
+        f->Valid      = TRUE;
+        f->p          = p;
+        f->Date       = DT->Date;
+        f->TimeSystem = DT->TimeSystem;
+
+    } else {
+
+        if ( HH != f->HH ) LGM_ISOTIME_PUT2( s+11, HH );
+        if ( MM != f->MM ) LGM_ISOTIME_PUT2( s+14, MM );
+        if ( SS != f->SS ) LGM_ISOTIME_PUT2( s+17, SS );
+        // fraction digits from the right, stopping once the rest are the same
+        for ( OldFrac = f->Frac, n=Frac, i=19+p; n != OldFrac; i--, n /= 10, OldFrac /= 10 ) {
+            if ( n%10 != OldFrac%10 ) s[i] = '0' + n%10;
+        }
+
+    }
+
+    f->HH = HH; f->MM = MM; f->SS = SS; f->Frac = Frac;
+
+    return( s );
+
+}
+
+/**
+ *  \brief
+ *      Write the ISO 8601 time string for DT into Str.
+ *
+ *  \details
+ *      Same string as Lgm_DateTimeToString( Str, DT, 0, p ), without the
+ *      sprintf()'s. Str needs LGM_ISOTIME_MAXLEN chars. Writers that go
+ *      through times in order should keep a Lgm_IsoTimeFormatter and use
+ *      Lgm_IsoTimeFormatter_Put() instead.
+ *
+ *      \return         strlen( Str )
+ */
+int Lgm_DateTimeToIsoString( char *Str, Lgm_DateTime *DT, int p ) {
+
+    Lgm_IsoTimeFormatter    f;
+
+    f.Valid = FALSE;
+    Lgm_IsoTimeFormatter_Put( &f, DT, p );
+    memcpy( Str, f.Str, f.Len+1 );
+
+    return( f.Len );
+
+}
+
+
 void Lgm_Print_SimpleTime( Lgm_DateTime *DT, int p, char *Str ){
     int         HH, MM, SS, sgn, leapsec;
     int         Year, Month, d;
@@ -1637,3 +1882,174 @@ void Lgm_MJD_to_DateTime( double MJD, Lgm_DateTime *UTC, Lgm_CTrans *c ) {
     JD = MJD + 2400000.5;
     Lgm_JD_to_DateTime( JD, UTC, c );
 }
+
+
+
+
+/*
+ * Array conversions between the seconds-since-epoch time scales
+ * -------------------------------------------------------------
+ */
+
+// Offsets from TaiSeconds to the other continuous scales (x = TaiSeconds + offset)
+#define LGM_TSEC_GPS_OFFSET     ( -19.0 - (LGM_JD_GPS0 - LGM_JD_TAI0)*86400.0 )
+#define LGM_TSEC_TT_OFFSET      ( 32.184 - (LGM_JD_J2000 - LGM_JD_TAI0)*86400.0 - 43200.0 )
+
+/*
+ *  TDB - TT (seconds) at TT seconds since J2000, as in Lgm_TT_to_TDB().
+ */
+static double Lgm_TdbMinusTT( double TTSeconds ) {
+    double  Mearth;
+    Mearth = (357.53 + 35999.050*TTSeconds/(86400.0*36525.0))*RadPerDeg;
+    return( 0.001658*sin(Mearth) + 0.000014*sin(2.0*Mearth) );
+}
+
+/*
+ *  Index i of the segment with Start[i] <= x < Start[i+1] (or -1 if x <
+ *  Start[0]). Starts from *Cursor and walks to the neighbouring segments,
+ *  which for a time ordered array means the boundaries are merged in a single
+ *  pass; a binary search is only needed after a jump.
+ */
+static int Lgm_LeapSegment( double x, const double *Start, int n, int *Cursor ) {
+
+    int i, lo, hi;
+
+    i = *Cursor;
+    if ( ( i >= 0 ) && ( i < n ) && ( x >= Start[i] ) ) {
+        if ( ( i == n-1 ) || ( x < Start[i+1] ) ) return( i );
+        if ( ( i+1 == n-1 ) || ( x < Start[i+2] ) ) return( *Cursor = i+1 );
+    }
+
+    if ( ( n < 1 ) || ( x < Start[0] ) ) return( -1 );
+    lo = 0; hi = n;
+    while ( hi - lo > 1 ) {
+        i = ( lo + hi )/2;
+        if ( x >= Start[i] ) lo = i;
+        else                 hi = i;
+    }
+    return( *Cursor = lo );
+
+}
+
+
+/**
+ *  \brief
+ *      Convert an array of times between time scales, each given as seconds since an epoch.
+ *
+ *  \details
+ *      The representation used for each scale is the one the scalar routines
+ *      already use:
+ *
+ *          InSys/OutSys        Seconds since
+ *          ----------------    ------------------------------------------------------
+ *          LGM_TIME_SYS_TAI    0h Jan 1, 1958 TAI    (Lgm_UTC_to_TaiSeconds())
+ *          LGM_TIME_SYS_GPS    0h Jan 6, 1980 GPS    (Lgm_UTC_to_GpsSeconds())
+ *          LGM_TIME_SYS_TT     12h Jan 1, 2000 TT    (Lgm_UTC_to_TTSecSinceJ2000())
+ *          LGM_TIME_SYS_TDB    12h Jan 1, 2000 TDB   (Lgm_UTC_to_TdbSecSinceJ2000())
+ *          LGM_TIME_SYS_UTC    0h Jan 1, 1958 UTC, counting 86400 seconds per day
+ *
+ *      The UTC seconds don't count leap seconds (like Unix time, which is
+ *      UtcSeconds - LGM_UNIX_EPOCH_UTCSECONDS), so they can't represent a
+ *      time inside an inserted leap second; those TAI times map to the start
+ *      of the following day.
+ *
+ *      Everything goes through TAI. The TAI, GPS and TT conversions are just
+ *      constant offsets; TT -> TDB adds the same periodic term as
+ *      Lgm_TT_to_TDB() (TDB -> TT inverts it by iteration). For UTC, the leap
+ *      second table is turned into segment boundaries once per call, and
+ *      each time is placed by stepping on from the segment of the previous
+ *      one, so a sorted array crosses each leap second boundary only once and
+ *      the per-element cost is a comparison and an add.  (Unsorted arrays
+ *      work too.) Pre-1972 UTC uses Lgm_GetLeapSeconds() element by element.
+ *
+ *      In and Out may be the same array.
+ *
+ *      \param[in]      n       Number of times.
+ *      \param[in]      In      Times in the InSys scale (seconds).
+ *      \param[in]      InSys   Time scale of In (LGM_TIME_SYS_TAI, _GPS, _TT, _TDB or _UTC).
+ *      \param[out]     Out     Times in the OutSys scale (seconds).
+ *      \param[in]      OutSys  Time scale of Out.
+ *      \param[in,out]  c       Lgm_CTrans structure (for the leap second table).
+ *
+ *      \return         TRUE, or FALSE if a time scale isn't supported (Out is not touched).
+ */
+int Lgm_ConvertTimeSeconds( long int n, const double *In, int InSys, double *Out, int OutSys, Lgm_CTrans *c ) {
+
+    Lgm_LeapSeconds *l = &(c->l);
+    long int        k;
+    int             i, j, nl, Cursor = 0, InPivot, OutPivot;
+    double          x, U, DAT, Offset, Off[LGM_TIME_SYS_TDB+1];
+    double          *UStart = NULL, *TStart = NULL;
+
+    if ( ( InSys  < LGM_TIME_SYS_UTC ) || ( InSys  > LGM_TIME_SYS_TDB )
+      || ( OutSys < LGM_TIME_SYS_UTC ) || ( OutSys > LGM_TIME_SYS_TDB ) ) {
+        printf("Lgm_ConvertTimeSeconds: unsupported time system (InSys = %d, OutSys = %d)\n", InSys, OutSys );
+        return( FALSE );
+    }
+
+    /*
+     *  UTC is first taken to TAI and TDB to TT; what is left between them is
+     *  a constant offset.
+     */
+    Off[LGM_TIME_SYS_UTC] = Off[LGM_TIME_SYS_TAI] = 0.0;
+    Off[LGM_TIME_SYS_GPS] = LGM_TSEC_GPS_OFFSET;
+    Off[LGM_TIME_SYS_TT]  = Off[LGM_TIME_SYS_TDB] = LGM_TSEC_TT_OFFSET;
+    InPivot  = ( InSys  == LGM_TIME_SYS_UTC ) ? LGM_TIME_SYS_TAI : ( InSys  == LGM_TIME_SYS_TDB ) ? LGM_TIME_SYS_TT : InSys;
+    OutPivot = ( OutSys == LGM_TIME_SYS_UTC ) ? LGM_TIME_SYS_TAI : ( OutSys == LGM_TIME_SYS_TDB ) ? LGM_TIME_SYS_TT : OutSys;
+    Offset   = Off[OutPivot] - Off[InPivot];
+
+    /*
+     *  Leap second segments: from UStart[i] (UTC seconds), or equivalently
+     *  TStart[i] (TaiSeconds), TAI-UTC is l->LeapSeconds[i].
+     */
+    nl = l->nLeapSecondDates;
+    if ( ( ( InSys == LGM_TIME_SYS_UTC ) || ( OutSys == LGM_TIME_SYS_UTC ) ) && ( InSys != OutSys ) && ( nl > 0 ) ) {
+        UStart = (double *)malloc( 2*nl*sizeof(double) );
+        TStart = UStart + nl;
+        for ( i=0; i<nl; i++ ) {
+            UStart[i] = (l->LeapSecondJDs[i] - (LGM_JD_TAI0 - 0.5))*86400.0;
+            TStart[i] = UStart[i] + l->LeapSeconds[i];
+        }
+    }
+
+    for ( k=0; k<n; k++ ) {
+
+        x = In[k];
+        if ( InSys == OutSys ) { Out[k] = x; continue; }
+
+        // to the pivot scale (TAI or TT)
+        if ( InSys == LGM_TIME_SYS_UTC ) {
+            i = ( UStart ) ? Lgm_LeapSegment( x, UStart, nl, &Cursor ) : -1;
+            DAT = ( i >= 0 ) ? l->LeapSeconds[i] : Lgm_GetLeapSeconds( (LGM_JD_TAI0 - 0.5) + x/86400.0, c );
+            x += DAT;
+        } else if ( InSys == LGM_TIME_SYS_TDB ) {
+            U = x - Lgm_TdbMinusTT( x );
+            x = x - Lgm_TdbMinusTT( U );
+        }
+
+        x += Offset;
+
+        // from the pivot scale
+        if ( OutSys == LGM_TIME_SYS_UTC ) {
+            i = ( TStart ) ? Lgm_LeapSegment( x, TStart, nl, &Cursor ) : -1;
+            if ( i >= 0 ) {
+                U = x - l->LeapSeconds[i];
+                if ( ( i < nl-1 ) && ( U > UStart[i+1] ) ) U = UStart[i+1]; // inside an inserted leap second
+            } else {
+                // pre-1972 (TAI-UTC is a slowly varying function of UTC)
+                for ( U = x, j=0; j<3; j++ ) U = x - Lgm_GetLeapSeconds( (LGM_JD_TAI0 - 0.5) + U/86400.0, c );
+            }
+            x = U;
+        } else if ( OutSys == LGM_TIME_SYS_TDB ) {
+            x += Lgm_TdbMinusTT( x );
+        }
+
+        Out[k] = x;
+
+    }
+
+    free( UStart );
+
+    return( TRUE );
+
+}
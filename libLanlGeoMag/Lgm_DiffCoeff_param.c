@@ -3,8 +3,22 @@
  *  \brief  Parameterized version of Summers (2005) bounce-averaged pitch-angle diffusion coefficients.
  *
  */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <math.h>
+#if USE_OPENMP
+#include <omp.h>
+#endif
 #include "Lgm/Lgm_SummersDiffCoeff.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+
+#if USE_OPENMP
+#define LGM_DAA_PARAM_SIMD  _Pragma( "omp simd" )
+#else
+#define LGM_DAA_PARAM_SIMD
+#endif
 /*
  * Lgm_DaaBounceAvg_param()
  */
@@ -141,3 +155,117 @@ double get_fcrit(double alpha, double E_MeV, double L, double gamma)
   
   return(fcrit) ;
 }
+
+
+/**
+ *
+ *\brief
+ *    Lgm_DaaBounceAvg_param() over a whole (L, E, alpha) grid.
+ *
+ *    Gives the same values as calling Lgm_DaaBounceAvg_param( dB, Alpha[i],
+ *    f_cen, E_MeV[j], L[k], gamma ) for every point, but the factors that
+ *    depend only on alpha (most of the transcendental functions) are computed
+ *    once per call, the ones that depend only on E and L once per (E, L), and
+ *    the loop over alpha has no branches (both branches of the fcrit test are
+ *    evaluated and one is selected) so that it can be vectorized.
+ *
+ *      dB = hiss amplitude (Tesla)
+ *      f_cen = frequency center of hiss (Hz)
+ *      gamma = density power law index
+ *      nAlpha, Alpha = equatorial pitch angles (Radians)
+ *      nE, E_MeV = electron energies (MeV)
+ *      nL, L = L-Shells
+ *      Daa = Daa[k][j][i] is for L[k], E_MeV[j], Alpha[i] (radians^2/s). Must
+ *            be allocated by the caller (e.g. with LGM_ARRAY_3D( Daa, nL, nE, nAlpha, double )).
+ *
+ */
+void Lgm_DaaBounceAvg_param_Grid( double dB, double f_cen, double gamma, int nAlpha, double *Alpha, int nE, double *E_MeV, int nL, double *L, double ***Daa )
+{
+
+  /*
+    The fitting parameters (see Lgm_DaaBounceAvg_param() and get_fcrit())
+  */
+
+  static const double a1_L = 1.3 ;
+  static const double a1_mu = 2.7 ;
+  static const double a1_fcrit = -2.6 ;
+  static const double a2_fcrit = -1.4 ;
+  static const double a1_asmp = 1.2 ;
+
+  static const double a1_fit = 2.5e17 ;
+  static const double a1_mu_f = 0.7 ;
+  static const double a2_mu_f = 0.35 ;
+  static const double a1_const = 1.5 ;
+
+  static const double a1_sig = 0.016 ;
+  static const double a1_exp_mu = 0.5 ;
+  static const double a1_exp_f = 0.26 ;
+  static const double a1_exp_E = 0.47 ;
+
+  static const double c1_beta = -7.5 ;
+  static const double c2_beta = 0.8 ;
+  static const double c1_alpha = 400 ;
+
+  double f_0 = 550. ;
+  double *MuFac, *MuCrit, *MuExpnt, *MuSig ;
+  long int n, nLE ;
+  int i ;
+
+  if ( ( nAlpha < 1 ) || ( nE < 1 ) || ( nL < 1 ) ) return ;
+
+  /*
+    Factors that depend only on alpha.
+      MuFac = exp(-a1_mu*|mu-0.2|^1.5) * (f_0/f_cen)^(a1_mu_f - a2_mu_f*mu)
+      MuCrit = (mu^1.6)^(1/0.9), so that fnorm = f_cen/fcrit = MuCrit*(f_cen/f_0)/K(E,L)^(1/0.9)
+      MuExpnt = exponent for f_cen >= fcrit
+      MuSig = 1/exp(a1_exp_mu*(1-mu)) (the mu part of 1/fcrit_sig)
+  */
+  LGM_ARRAY_1D( MuFac, nAlpha, double ) ;
+  LGM_ARRAY_1D( MuCrit, nAlpha, double ) ;
+  LGM_ARRAY_1D( MuExpnt, nAlpha, double ) ;
+  LGM_ARRAY_1D( MuSig, nAlpha, double ) ;
+  for ( i=0; i<nAlpha; i++ )
+    {
+      double mu = cos(Alpha[i]) ;
+      MuFac[i] = exp(-a1_mu*pow(fabs(mu-0.2),1.5))*pow(f_0/f_cen,a1_mu_f - a2_mu_f*mu) ;
+      MuCrit[i] = pow(pow(mu,1.6),1/0.9) ;
+      MuExpnt[i] = a1_fcrit*exp(a2_fcrit*mu)/a1_asmp ;
+      MuSig[i] = exp(-a1_exp_mu*(1-mu)) ;
+    }
+
+  nLE = (long int)nL*nE ;
+
+#if USE_OPENMP
+#pragma omp parallel for schedule(static) if ( nLE*nAlpha > 4096 )
+#endif
+  for ( n=0; n<nLE; n++ )
+    {
+      int k = (int)(n/nE), j = (int)(n%nE), ii ;
+      double E, Fac, FnormFac, SigFac, *D = Daa[k][j] ;
+
+      /*
+        Factors that depend only on E and L.
+      */
+      E = E_MeV[j]*LGM_e*1e6/(LGM_ELECTRON_MASS*LGM_c*LGM_c) ;  // dimensionless particle energy
+      Fac = pow(dB,2.)*a1_fit*pow(L[k],a1_L)/pow(E+1,2.) ;
+      FnormFac = f_cen/(f_0*pow((c1_alpha/pow(gamma,2.))/E_MeV[j]*pow(L[k],c1_beta + c2_beta*gamma),1/0.9)) ;
+      SigFac = 1.0/(a1_sig*exp(a1_exp_f*(f_cen/f_0) + a1_exp_E*(E_MeV[j]-1.))) ;
+
+      LGM_DAA_PARAM_SIMD
+      for ( ii=0; ii<nAlpha; ii++ )
+        {
+          double fnorm, fm1, Hi, Lo ;
+          fnorm = FnormFac*MuCrit[ii] ;
+          fm1 = fnorm-1 ;
+          Hi = pow(1 + a1_const*pow(fabs(fm1),a1_asmp),MuExpnt[ii]) ;
+          Lo = exp(-fm1*fm1*fm1*fm1*SigFac*MuSig[ii]) ;
+          D[ii] = Fac*MuFac[ii]*( ( fnorm >= 1.0 ) ? Hi : Lo ) ;
+        }
+    }
+
+  LGM_ARRAY_1D_FREE( MuFac ) ;
+  LGM_ARRAY_1D_FREE( MuCrit ) ;
+  LGM_ARRAY_1D_FREE( MuExpnt ) ;
+  LGM_ARRAY_1D_FREE( MuSig ) ;
+
+}
@@ -0,0 +1,536 @@
+/*! \file Lgm_Dipole.c
+ *
+ *  \brief Closed-form field line geometry and adiabatic invariants for pure dipole fields.
+ *
+ *  \details
+ *      When the field model is just a centered (Lgm_B_cdip()) or eccentric
+ *      (Lgm_B_edip()) dipole there is no need to trace anything. In the
+ *      dipole's own frame (SM axes with the origin moved to the dipole
+ *      center) a field line is
+ *
+ *          \f[ r = L\cos^2\lambda, \qquad B = {M\over L^3}{(1+3\sin^2\lambda)^{1/2}\over\cos^6\lambda}, \f]
+ *
+ *      and the arc length from the equator is
+ *
+ *          \f[ s(\lambda) = {L\over 2}\left[ \sin\lambda(1+3\sin^2\lambda)^{1/2}
+ *                              + {1\over\sqrt{3}}\sinh^{-1}(\sqrt{3}\sin\lambda) \right]. \f]
+ *
+ *      Mirror latitudes start from Lgm_CdipMirrorLat(), footpoints are 1D
+ *      root finds in latitude, and I and Sb are Gauss-Legendre sums in a
+ *      variable that removes the square root singularities at the mirror
+ *      points, so they are good to near machine precision with only a few
+ *      field evaluations.
+ *
+ *      Lgm_McIlwain_L(), Lgm_McIlwain_L_Batch(), Lgm_Setup_AlphaOfK(),
+ *      Lgm_AlphaOfK(), Lgm_KofAlpha(), Iinv() and Lstar() all use these
+ *      when Lgm_Dipole_IsPure() is TRUE. Setting m->UseDipoleFastPath to
+ *      FALSE makes them trace as usual.
+ *
+ *  \author M.G. Henderson
+ *  \date   2011
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LC_TOL  0.99    // Same loss cone height tolerance as Lgm_TraceToMirrorPoint()
+#define SQRT3   1.7320508075688772935
+
+/*
+ *  Positive nodes and weights of 16-point Gauss-Legendre on [-1, 1]. The
+ *  integrands below are even in t, so these alone give the integral over
+ *  [0, 1].
+ */
+static const double GL_x[8] = { 0.0950125098376374401853193, 0.2816035507792589132304605, 0.4580167776572273863424194, 0.6178762444026437484466718,
+                                0.7554044083550030338951012, 0.8656312023878317438804679, 0.9445750230732325760779884, 0.9894009349916499325961542 };
+static const double GL_w[8] = { 0.1894506104550684962853967, 0.1826034150449235888667637, 0.1691565193950025381893121, 0.1495959888165767320815017,
+                                0.1246289712555338720524763, 0.0951585116824927848099251, 0.0622535239386478928628438, 0.0271524594117540948517806 };
+
+
+/**
+ *  TRUE if m->Bfield is a pure dipole (and m->UseDipoleFastPath is set), so
+ *  that the closed-form routines in this file can be used in place of
+ *  tracing.
+ */
+int Lgm_Dipole_IsPure( Lgm_MagModelInfo *m ) {
+
+    return( m->UseDipoleFastPath && ( ( m->Bfield == Lgm_B_cdip ) || ( m->Bfield == Lgm_B_edip ) ) );
+
+}
+
+
+/**
+ *  Set up the field line that goes through u.
+ *
+ *      \param[in]      u   Position (GSM) [Re].
+ *      \param[out]     f   The field line.
+ *      \param[in]      m   A properly initialized and configured Lgm_MagModelInfo structure (coordinate transformations set).
+ *
+ *      \return         Latitude of u on the line [radians].
+ */
+double Lgm_Dipole_Line( Lgm_Vector *u, Lgm_DipoleFL *f, Lgm_MagModelInfo *m ) {
+
+    Lgm_CTrans  *c = m->c;
+    Lgm_Vector  ED_geo;
+    double      x, y, z, r, sl, cl2;
+
+    f->M = c->M_cd;
+    if ( m->Bfield == Lgm_B_edip ) {
+        ED_geo.x = c->ED_x0; ED_geo.y = c->ED_y0; ED_geo.z = c->ED_z0;
+        Lgm_Convert_Coords( &ED_geo, &f->O, WGS84_TO_SM, c );
+    } else {
+        f->O.x = f->O.y = f->O.z = 0.0;
+    }
+
+    // GSM -> SM the same way Lgm_B_cdip_ctrans() does it.
+    x = u->x*c->cos_psi - u->z*c->sin_psi - f->O.x;
+    y = u->y                              - f->O.y;
+    z = u->x*c->sin_psi + u->z*c->cos_psi - f->O.z;
+
+    r   = sqrt( x*x + y*y + z*z );
+    sl  = z/r;
+    cl2 = 1.0 - sl*sl;
+    f->L   = r/cl2;
+    f->Phi = atan2( y, x );
+    f->Beq = f->M/(f->L*f->L*f->L);
+
+    return( asin( sl ) );
+
+}
+
+
+/**
+ *  GSM position [Re] of the point at latitude Lat [radians] on the line.
+ */
+void Lgm_Dipole_Point( double Lat, Lgm_DipoleFL *f, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
+
+    Lgm_CTrans  *c = m->c;
+    double      cl, r, x, y, z;
+
+    cl = cos( Lat );
+    r  = f->L*cl*cl;
+    x  = r*cl*cos( f->Phi ) + f->O.x;
+    y  = r*cl*sin( f->Phi ) + f->O.y;
+    z  = r*sin( Lat )       + f->O.z;
+
+    u->x =  x*c->cos_psi + z*c->sin_psi;
+    u->y =  y;
+    u->z = -x*c->sin_psi + z*c->cos_psi;
+
+}
+
+
+/**
+ *  |B| [nT] at latitude Lat [radians] on the line.
+ */
+double Lgm_Dipole_B( double Lat, Lgm_DipoleFL *f ) {
+
+    double  sl, cl2;
+
+    sl  = sin( Lat );
+    cl2 = 1.0 - sl*sl;
+    return( f->Beq*sqrt( 1.0 + 3.0*sl*sl )/(cl2*cl2*cl2) );
+
+}
+
+
+/**
+ *  Arc length [Re] from the equator to latitude Lat [radians] (negative in
+ *  the south).
+ */
+double Lgm_Dipole_S( double Lat, Lgm_DipoleFL *f ) {
+
+    double  sl;
+
+    sl = sin( Lat );
+    return( 0.5*f->L*( sl*sqrt( 1.0 + 3.0*sl*sl ) + asinh( SQRT3*sl )/SQRT3 ) );
+
+}
+
+
+/**
+ *  Latitude [radians] (>= 0) where |B| = Bm. Zero if Bm is not above the
+ *  equatorial field.
+ */
+double Lgm_Dipole_MirrorLat( double Bm, Lgm_DipoleFL *f ) {
+
+    int     i;
+    double  Lat, sl, cl, F, dF;
+
+    if ( !( Bm > f->Beq ) ) return( 0.0 );
+
+    /*
+     *  Lgm_CdipMirrorLat() gets cos(Lat) to about 1e-10. A couple of Newton
+     *  steps on log(B(Lat)/Bm) take it the rest of the way.
+     */
+    Lat = acos( Lgm_CdipMirrorLat( sqrt( f->Beq/Bm ) ) );
+    for ( i=0; i<2; i++ ) {
+        sl = sin( Lat ); cl = cos( Lat );
+        F  = log( Lgm_Dipole_B( Lat, f )/Bm );
+        dF = 3.0*sl*cl/( 1.0 + 3.0*sl*sl ) + 6.0*sl/cl;
+        if ( dF > 0.0 ) Lat -= F/dF;
+    }
+
+    return( Lat );
+
+}
+
+
+/*
+ *  Height [km] of the point at Lat, above the sphere (measured the way
+ *  Lgm_TraceToSphericalEarth() does it) or the WGS84 ellipsoid.
+ */
+static double Dipole_Height( double Lat, int Spherical, Lgm_DipoleFL *f, Lgm_MagModelInfo *m ) {
+
+    Lgm_Vector  u, w;
+    double      H;
+
+    Lgm_Dipole_Point( Lat, f, &u, m );
+    if ( Spherical ) return( WGS84_A*( Lgm_Magnitude( &u ) - 1.0 ) );
+
+    Lgm_Convert_Coords( &u, &w, GSM_TO_WGS84, m->c );
+    Lgm_WGS84_to_GeodHeight( &w, &H );
+    return( H );
+
+}
+
+/**
+ *  Latitude [radians] where the line comes down to Height [km], in the
+ *  northern (sgn > 0) or southern (sgn < 0) hemisphere.
+ *
+ *      \param[in]      Height      Height above the Earth [km].
+ *      \param[in]      Spherical   If TRUE height is above the sphere of radius WGS84_A, otherwise it is the geodetic height.
+ *      \param[in]      sgn         +1 for the northern footpoint, -1 for the southern one.
+ *      \param[in]      f           The field line.
+ *      \param[out]     Lat         The footpoint latitude.
+ *      \param[in]      m           A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         TRUE, or FALSE if the whole line is below Height.
+ */
+int Lgm_Dipole_FootLat( double Height, int Spherical, double sgn, Lgm_DipoleFL *f, double *Lat, Lgm_MagModelInfo *m ) {
+
+    int     i, Side = 0;
+    double  a, b, c, Fa, Fb, Fc, r;
+
+    sgn = ( sgn < 0.0 ) ? -1.0 : 1.0;
+
+    a  = 0.0;
+    Fa = Dipole_Height( a, Spherical, f, m ) - Height;
+    if ( Fa < 0.0 ) return( FALSE );
+
+    /*
+     *  Start with a tight bracket about the centered dipole answer (widened
+     *  if need be; the height drops monotonically towards the pole).
+     */
+    r = 1.0 + Height/WGS84_A;
+    b = ( r < f->L ) ? acos( sqrt( r/f->L ) ) : 0.0;
+    c = b - 0.01;
+    if ( c > 0.0 ) {
+        Fc = Dipole_Height( sgn*c, Spherical, f, m ) - Height;
+        if ( Fc >= 0.0 ) { a = c; Fa = Fc; }
+    }
+    for ( b += 0.01; ; b = 0.5*( b + 0.5*M_PI ) ) {
+        if ( b > 0.5*M_PI - 1e-9 ) b = 0.5*M_PI - 1e-9;
+        Fb = Dipole_Height( sgn*b, Spherical, f, m ) - Height;
+        if ( ( Fb <= 0.0 ) || ( b >= 0.5*M_PI - 1e-9 ) ) break;
+        a = b; Fa = Fb;
+    }
+    if ( Fb > 0.0 ) return( FALSE );
+
+
+    /*
+     *  Illinois false position.
+     */
+    c = a;
+    for ( i=0; i<100; i++ ) {
+
+        c  = ( Fa*b - Fb*a )/( Fa - Fb );
+        Fc = Dipole_Height( sgn*c, Spherical, f, m ) - Height;
+
+        if ( ( fabs( Fc ) < 1e-9 ) || ( fabs( b - a ) < 1e-14 ) ) break;
+        if ( Fc > 0.0 ) {
+            a = c; Fa = Fc;
+            if ( Side == 1 ) Fb *= 0.5;
+            Side = 1;
+        } else {
+            b = c; Fb = Fc;
+            if ( Side == -1 ) Fa *= 0.5;
+            Side = -1;
+        }
+
+    }
+
+    *Lat = sgn*c;
+    return( TRUE );
+
+}
+
+
+/**
+ *  Mirror points for mirror field Bm.
+ *
+ *      \param[in]      Bm      Mirror field strength [nT].
+ *      \param[in]      f       The field line.
+ *      \param[out]     Ps      Southern mirror point (GSM) [Re].
+ *      \param[out]     Pn      Northern mirror point (GSM) [Re].
+ *      \param[out]     SS      Arc length between them [Re].
+ *      \param[in]      m       A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1, or -2 (-1) if the southern (northern) mirror point is below the loss cone height.
+ */
+int Lgm_Dipole_MirrorPoints( double Bm, Lgm_DipoleFL *f, Lgm_Vector *Ps, Lgm_Vector *Pn, double *SS, Lgm_MagModelInfo *m ) {
+
+    Lgm_Vector  w;
+    double      Lat, H;
+
+    Lat = Lgm_Dipole_MirrorLat( Bm, f );
+    Lgm_Dipole_Point( -Lat, f, Ps, m );
+    Lgm_Dipole_Point(  Lat, f, Pn, m );
+    *SS = 2.0*Lgm_Dipole_S( Lat, f );
+
+    Lgm_Convert_Coords( Ps, &w, GSM_TO_WGS84, m->c );
+    Lgm_WGS84_to_GeodHeight( &w, &H );
+    if ( H < LC_TOL*m->Lgm_LossConeHeight ) return( -2 );
+
+    Lgm_Convert_Coords( Pn, &w, GSM_TO_WGS84, m->c );
+    Lgm_WGS84_to_GeodHeight( &w, &H );
+    if ( H < LC_TOL*m->Lgm_LossConeHeight ) return( -1 );
+
+    return( 1 );
+
+}
+
+
+/**
+ *  Bounce integrals from mirror point to mirror point,
+ *
+ *      \f[ I = \int \left[1-{B\over B_m}\right]^{1/2} ds, \qquad S_b = \int \left[1-{B\over B_m}\right]^{-1/2} ds. \f]
+ *
+ *  With \f$\lambda = \lambda_m(1-t^2)\f$ both integrands are smooth and
+ *  even in t.
+ *
+ *      \param[in]      Bm      Mirror field strength [nT].
+ *      \param[in]      f       The field line.
+ *      \param[out]     I       I [Re] (can be NULL).
+ *      \param[out]     Sb      Sb [Re] (can be NULL). The equatorial limit is returned if Bm is at or below the equatorial field.
+ */
+void Lgm_Dipole_Integrals( double Bm, Lgm_DipoleFL *f, double *I, double *Sb ) {
+
+    int     i;
+    double  Latm, t, Lat, sl, cl, cl2, ds, g, SumI, SumS;
+
+    Latm = Lgm_Dipole_MirrorLat( Bm, f );
+    if ( Latm <= 0.0 ) {
+        if ( I  != NULL ) *I  = 0.0;
+        if ( Sb != NULL ) *Sb = M_PI*M_SQRT2*f->L/3.0;
+        return;
+    }
+
+    SumI = SumS = 0.0;
+    for ( i=0; i<8; i++ ) {
+        t   = GL_x[i];
+        Lat = Latm*( 1.0 - t*t );
+        sl  = sin( Lat ); cl = cos( Lat ); cl2 = cl*cl;
+        ds  = f->L*cl*sqrt( 1.0 + 3.0*sl*sl )*2.0*Latm*t;  // ds/dt
+        g   = 1.0 - f->Beq*sqrt( 1.0 + 3.0*sl*sl )/( cl2*cl2*cl2*Bm );
+        if ( g < 0.0 ) g = 0.0;
+        g   = sqrt( g );
+        SumI += GL_w[i]*ds*g;
+        if ( g > 0.0 ) SumS += GL_w[i]*ds/g;
+    }
+
+    if ( I  != NULL ) *I  = 2.0*SumI;
+    if ( Sb != NULL ) *Sb = 2.0*SumS;
+
+}
+
+
+/**
+ *  Closed-form stand-in for Lgm_Trace(). The same things are set in m
+ *  (Pmin, Bmin, footpoints and their fields, Snorth, Ssouth, Stotal, Smin,
+ *  Trace_s and, if m->ComputeSb0 is set, d2B_ds2, Sb0, Kappa and RofC).
+ *
+ *      \param[in]      u       Position (GSM) [Re].
+ *      \param[out]     v1      Southern footpoint at Height (GSM) [Re].
+ *      \param[out]     v2      Northern footpoint at Height (GSM) [Re].
+ *      \param[out]     v3      Min-B point (GSM) [Re].
+ *      \param[in]      Height  Geodetic height of the footpoints [km].
+ *      \param[in,out]  m       A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         LGM_CLOSED, or LGM_OPEN_N_LOBE/LGM_OPEN_S_LOBE if the whole line is below Height.
+ */
+int Lgm_Dipole_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, Lgm_MagModelInfo *m ) {
+
+    Lgm_DipoleFL    f;
+    Lgm_Vector      Bvec;
+    double          Lat, LatS, LatN, Su;
+
+    m->Smin   = LGM_FILL_VALUE;
+    m->Snorth = LGM_FILL_VALUE;
+    m->Ssouth = LGM_FILL_VALUE;
+    m->Stotal = LGM_FILL_VALUE;
+    m->Bmin   = LGM_FILL_VALUE;
+
+    Lat = Lgm_Dipole_Line( u, &f, m );
+    if ( !Lgm_Dipole_FootLat( Height, FALSE, -1.0, &f, &LatS, m ) || !Lgm_Dipole_FootLat( Height, FALSE, 1.0, &f, &LatN, m ) ) {
+        return( ( Lat > 0.0 ) ? LGM_OPEN_N_LOBE : LGM_OPEN_S_LOBE );
+    }
+
+    Lgm_Dipole_Point( LatS, &f, v1, m );
+    Lgm_Dipole_Point( LatN, &f, v2, m );
+    Lgm_Dipole_Point( 0.0, &f, v3, m );
+
+    m->v3_final = *v3;
+    m->Pmin     = *v3;
+    m->Bfield( v3, &Bvec, m );
+    m->Bvecmin  = Bvec;
+    m->Bmin     = Lgm_Magnitude( &Bvec );
+
+    Su = Lgm_Dipole_S( Lat, &f );
+    m->Snorth  = Lgm_Dipole_S( LatN, &f ) - Su;
+    m->Ssouth  = Su - Lgm_Dipole_S( LatS, &f );
+    m->Stotal  = m->Snorth + m->Ssouth;
+    m->Smin    = -Lgm_Dipole_S( LatS, &f );    // south foot to Pmin
+    m->Trace_s = m->Stotal;
+
+    m->Ellipsoid_Footprint_Pn = *v2;
+    m->Bfield( v2, &Bvec, m );
+    m->Ellipsoid_Footprint_Bvecn = Bvec;
+    m->Ellipsoid_Footprint_Bn    = Lgm_Magnitude( &Bvec );
+
+    m->Ellipsoid_Footprint_Ps = *v1;
+    m->Bfield( v1, &Bvec, m );
+    m->Ellipsoid_Footprint_Bvecs = Bvec;
+    m->Ellipsoid_Footprint_Bs    = Lgm_Magnitude( &Bvec );
+
+    /*
+     *  Near the equator B = Beq(1 + 9s^2/(2L^2)) and the radius of curvature
+     *  is L/3.
+     */
+    if ( m->ComputeSb0 ) {
+        m->d2B_ds2 = 9.0*f.Beq/(f.L*f.L);
+        m->Sb0     = M_PI*M_SQRT2*sqrt( m->Bmin/m->d2B_ds2 );
+        m->Kappa   = 3.0/f.L;
+        m->RofC    = 1.0/m->Kappa;
+    }
+
+    return( LGM_CLOSED );
+
+}
+
+
+/**
+ *  Fill m->s, m->Px, etc. with nDivs+1 points from the southern to the
+ *  northern footpoint of the line through m->Pmin (as left by
+ *  Lgm_Dipole_Trace()) and set up the splines, like Lgm_TraceLine3() and
+ *  InitSpline() would. The points are evenly spaced in latitude.
+ *
+ *      \return         TRUE, or FALSE if the points could not be allocated or the spline set up.
+ */
+int Lgm_Dipole_SampleLine( int nDivs, Lgm_MagModelInfo *m ) {
+
+    int             n;
+    double          LatS, LatN, Lat;
+    Lgm_DipoleFL    f;
+    Lgm_Vector      P, Bvec, Bcdip;
+
+    Lgm_Dipole_Line( &m->Pmin, &f, m );
+    if ( !Lgm_Dipole_FootLat( m->Lgm_LossConeHeight, FALSE, -1.0, &f, &LatS, m ) ) return( FALSE );
+    if ( !Lgm_Dipole_FootLat( m->Lgm_LossConeHeight, FALSE,  1.0, &f, &LatN, m ) ) return( FALSE );
+
+    if ( nDivs < 2 ) nDivs = 2;
+    if ( !LGM_RESERVE_FL_PNTS( m, nDivs+1 ) ) return( FALSE );
+
+    for ( n=0; n<=nDivs; n++ ) {
+        Lat = LatS + ( LatN - LatS )*(double)n/(double)nDivs;
+        Lgm_Dipole_Point( Lat, &f, &P, m );
+        m->Bfield( &P, &Bvec, m );
+        m->s[n]    = Lgm_Dipole_S( Lat, &f ) - Lgm_Dipole_S( LatS, &f );
+        m->Px[n]   = P.x;
+        m->Py[n]   = P.y;
+        m->Pz[n]   = P.z;
+        m->Bvec[n] = Bvec;
+        m->Bmag[n] = Lgm_Magnitude( &Bvec );
+        Lgm_B_cdip( &P, &Bcdip, m );
+        m->BminusBcdip[n] = m->Bmag[n] - Lgm_Magnitude( &Bcdip );
+    }
+    m->nPnts = nDivs+1;
+
+    return( InitSpline( m ) );
+
+}
+
+
+/*
+ *  K(Alpha) [Re G^(1/2)] for equatorial pitch angle Alpha [Degrees].
+ */
+static double Dipole_KofAlpha( double Alpha, Lgm_DipoleFL *f ) {
+
+    double  sa, Bm, I;
+
+    sa = sin( Alpha*RadPerDeg );
+    Bm = f->Beq/(sa*sa);
+    Lgm_Dipole_Integrals( Bm, f, &I, NULL );
+    return( 3.16227766e-3*I*sqrt( Bm ) );
+
+}
+
+/**
+ *  Lgm_AlphaOfK() for a pure dipole. Needs m->Pmin and the footpoint fields
+ *  from Lgm_Setup_AlphaOfK(). K(Alpha) goes from zero at 90 Deg. up to its
+ *  largest value at the loss cone, and is inverted to about 1e-10 Deg.
+ *
+ *      \param[in]      K   The value of the second invariant, K        <b> ( Re G^(1/2) )</b>
+ *      \param[in]      m   A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \returns        Equatorial pitch angle [Degrees], or LGM_FILL_VALUE if K is out of range.
+ */
+double Lgm_Dipole_AlphaOfK( double K, Lgm_MagModelInfo *m ) {
+
+    int             i, Side = 0;
+    double          B, a, b, c, Fa, Fb, Fc;
+    Lgm_DipoleFL    f;
+
+    if ( !( K >= 0.0 ) ) return( LGM_FILL_VALUE );
+    if ( K == 0.0 ) return( 90.0 );
+
+    Lgm_Dipole_Line( &m->Pmin, &f, m );
+    B = ( m->Ellipsoid_Footprint_Bs < m->Ellipsoid_Footprint_Bn ) ? m->Ellipsoid_Footprint_Bs : m->Ellipsoid_Footprint_Bn;
+    if ( !( B > f.Beq ) ) return( LGM_FILL_VALUE );
+
+    a  = DegPerRad*asin( sqrt( f.Beq/B ) );
+    Fa = Dipole_KofAlpha( a, &f ) - K;
+    if ( Fa < 0.0 ) return( LGM_FILL_VALUE );
+    b  = 90.0;
+    Fb = -K;
+
+    /*
+     *  Illinois false position in sqrt(K) would be better behaved near 90
+     *  Deg., but K itself is fine everywhere else and this is cheap anyway.
+     */
+    c = a;
+    for ( i=0; i<200; i++ ) {
+
+        c  = ( Fa*b - Fb*a )/( Fa - Fb );
+        Fc = Dipole_KofAlpha( c, &f ) - K;
+
+        if ( ( fabs( Fc ) <= 1e-13*K ) || ( fabs( b - a ) < 1e-10 ) ) break;
+        if ( Fc > 0.0 ) {
+            a = c; Fa = Fc;
+            if ( Side == 1 ) Fb *= 0.5;
+            Side = 1;
+        } else {
+            b = c; Fb = Fc;
+            if ( Side == -1 ) Fa *= 0.5;
+            Side = -1;
+        }
+
+    }
+
+    return( c );
+
+}
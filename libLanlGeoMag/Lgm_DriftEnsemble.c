@@ -0,0 +1,277 @@
+/*! \file Lgm_DriftEnsemble.c
+ *
+ *  \brief Push an ensemble of guiding-center particles through the field.
+ *
+ *  \details
+ *      Lgm_VelStep() advances a single point along a velocity field with a
+ *      Bulirsch-Stoer step. Most of what it keeps in its Lgm_VelStepInfo
+ *      (the work estimates and Deuflhard correction factors) only depends on
+ *      the tolerance, so one Lgm_VelStepInfo per thread is enough for any
+ *      number of particles. The few things that do belong to a particle (its
+ *      next step, the running step sum and the optimal row of the tableau)
+ *      are kept in the Lgm_DriftEnsemble and swapped into the thread's
+ *      Lgm_VelStepInfo before each of its steps. That way every particle
+ *      keeps its own step control while costing only a few doubles.
+ *
+ *      The particles are done in parallel (OpenMP builds), each thread
+ *      working on its own copy of the Lgm_MagModelInfo. The default
+ *      velocity, Lgm_GradAndCurvDriftVel(), gets B and its gradients from a
+ *      single Lgm_B_Jacobian() call, and the mirror fields of a new ensemble
+ *      come from one Lgm_B_Batch() call over all of the starting positions.
+ *
+ *      Typical use is,
+ *
+ *          e = Lgm_DriftEnsemble_Create( n, -LGM_e, LGM_Ee0 );
+ *          Lgm_DriftEnsemble_Init( e, u, T, Alpha, mInfo );
+ *          for ( t=dt; t<=tMax; t += dt ) {
+ *              Lgm_DriftEnsemble_Advance( e, t, mInfo );
+ *              ... look at e->u[], e->Status[] ...
+ *          }
+ *          Lgm_DriftEnsemble_Free( e );
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include "Lgm/Lgm_DriftEnsemble.h"
+
+
+/*
+ *  What the velocity wrapper needs. Carried in Lgm_VelStepInfo->data.
+ */
+typedef struct Lgm_DriftVelData {
+    Lgm_MagModelInfo    *m;
+    int                 (*Velocity)( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * );
+} Lgm_DriftVelData;
+
+static int Lgm_DriftEnsemble_Velocity( Lgm_Vector *u, Lgm_Vector *v, Lgm_VelStepInfo *Info ) {
+    Lgm_DriftVelData *d = (Lgm_DriftVelData *)Info->data;
+    return( d->Velocity( u, v, d->m ) );
+}
+
+
+
+/**
+ *  Allocate an ensemble of n particles of charge q [C] and rest energy E0
+ *  [MeV]. The particles still have to be set up with
+ *  Lgm_DriftEnsemble_Init() (or by filling in u, T and Bm directly). The
+ *  step control settings get defaults that can be changed afterwards.
+ */
+Lgm_DriftEnsemble *Lgm_DriftEnsemble_Create( long int n, double q, double E0 ) {
+
+    long int            i;
+    Lgm_DriftEnsemble   *e;
+
+    if ( n < 1 ) return( NULL );
+
+    e = (Lgm_DriftEnsemble *) calloc( 1, sizeof( *e ) );
+    e->n      = n;
+    e->u      = (Lgm_Vector *) calloc( n, sizeof( Lgm_Vector ) );
+    e->t      = (double *) calloc( n, sizeof( double ) );
+    e->T      = (double *) calloc( n, sizeof( double ) );
+    e->Bm     = (double *) calloc( n, sizeof( double ) );
+    e->Status = (int *) calloc( n, sizeof( int ) );
+    e->h      = (double *) calloc( n, sizeof( double ) );
+    e->s      = (double *) calloc( n, sizeof( double ) );
+    e->kopt   = (int *) calloc( n, sizeof( int ) );
+    for ( i=0; i<n; i++ ) e->h[i] = -1.0;
+
+    e->q           = q;
+    e->E0          = E0;
+    e->Tol         = 1e-7;
+    e->h0          = 1e-2;
+    e->hMax        = 60.0;
+    e->RInner      = 1.0 + 100.0/Re;
+    e->ROuter      = 20.0;
+    e->DerivScheme = LGM_DERIV_SIX_POINT;
+    e->DerivH      = 1e-3;
+    e->Velocity    = Lgm_GradAndCurvDriftVel;
+    e->nVelEvals   = 0;
+
+    return( e );
+
+}
+
+void Lgm_DriftEnsemble_Free( Lgm_DriftEnsemble *e ) {
+
+    if ( e == NULL ) return;
+    free( e->u );
+    free( e->t );
+    free( e->T );
+    free( e->Bm );
+    free( e->Status );
+    free( e->h );
+    free( e->s );
+    free( e->kopt );
+    free( e );
+
+}
+
+
+
+/**
+ *  Start all of the particles off. The mirror field of each is found from
+ *  its local pitch angle and the field at its starting point (one batched
+ *  field evaluation for the whole ensemble).
+ *
+ *      \param[in,out]  e       The ensemble.
+ *      \param[in]      u       Starting positions (GSM) [Re], e->n of them.
+ *      \param[in]      T       Kinetic energies [MeV].
+ *      \param[in]      Alpha   Local pitch angles at u [Degrees].
+ *      \param[in]      m       A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         TRUE, or FALSE if the field could not be evaluated.
+ */
+int Lgm_DriftEnsemble_Init( Lgm_DriftEnsemble *e, Lgm_Vector *u, double *T, double *Alpha, Lgm_MagModelInfo *m ) {
+
+    long int    i, n;
+    double      *x, *y, *z, *bx, *by, *bz, B, sa;
+
+    n = e->n;
+    LGM_ARRAY_1D( x, 6*n, double );
+    y = x+n; z = y+n; bx = z+n; by = bx+n; bz = by+n;
+
+    for ( i=0; i<n; i++ ) { x[i] = u[i].x; y[i] = u[i].y; z[i] = u[i].z; }
+    if ( !Lgm_B_Batch( n, x, y, z, bx, by, bz, m ) ) {
+        printf("Lgm_DriftEnsemble_Init(): Field evaluation failed.\n");
+        LGM_ARRAY_1D_FREE( x );
+        return( FALSE );
+    }
+
+    for ( i=0; i<n; i++ ) {
+        B  = sqrt( bx[i]*bx[i] + by[i]*by[i] + bz[i]*bz[i] );
+        sa = sin( Alpha[i]*RadPerDeg );
+        e->u[i]      = u[i];
+        e->t[i]      = 0.0;
+        e->T[i]      = T[i];
+        e->Bm[i]     = ( sa > 0.0 ) ? B/(sa*sa) : LGM_FILL_VALUE;
+        e->Status[i] = ( sa > 0.0 ) ? LGM_DRIFT_ACTIVE : LGM_DRIFT_FAILED;
+        e->h[i]      = -1.0;
+        e->s[i]      = 0.0;
+        e->kopt[i]   = 0;
+    }
+
+    LGM_ARRAY_1D_FREE( x );
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  Follow every active particle up to time tEnd [s]. Particles that leave
+ *  the RInner/ROuter shell, or whose step fails, are marked and stopped
+ *  where they are. Particles that make it to tEnd stay active and can be
+ *  advanced further by another call.
+ *
+ *      \param[in,out]  e       The ensemble.
+ *      \param[in]      tEnd    Time to advance the particles to [s].
+ *      \param[in,out]  m       A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         The number of particles that are still active.
+ */
+long int Lgm_DriftEnsemble_Advance( Lgm_DriftEnsemble *e, double tEnd, Lgm_MagModelInfo *m ) {
+
+    long int            i, nActive = 0;
+    int                 reset, Last;
+    double              t, s, Htry, Hdid, Hnext, hKeep, r, tEps;
+    Lgm_Vector          u, u_scale;
+    Lgm_MagModelInfo    *mm;
+    Lgm_VelStepInfo     *v;
+    Lgm_DriftVelData    d;
+
+    u_scale.x = u_scale.y = u_scale.z = 1.0;
+    tEps = 1e-12*( fabs( tEnd ) > 1.0 ? fabs( tEnd ) : 1.0 );
+
+#if USE_OPENMP
+    #pragma omp parallel private(i,reset,Last,t,s,Htry,Hdid,Hnext,hKeep,r,u,mm,v,d) reduction(+:nActive)
+#endif
+    {
+        mm = Lgm_NewMagContext( m );
+        mm->Lgm_VelStep_q           = e->q;
+        mm->Lgm_VelStep_E0          = e->E0;
+        mm->Lgm_VelStep_DerivScheme = e->DerivScheme;
+        mm->Lgm_VelStep_h           = e->DerivH;
+
+        d.m        = mm;
+        d.Velocity = ( e->Velocity != NULL ) ? e->Velocity : Lgm_GradAndCurvDriftVel;
+        v = Lgm_InitVelInfo( );
+        v->data = (void *)&d;
+        v->VerbosityLevel = m->VerbosityLevel;
+
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 16)
+#endif
+        for ( i=0; i<e->n; i++ ) {
+
+            if ( e->Status[i] != LGM_DRIFT_ACTIVE ) continue;
+
+            mm->Lgm_VelStep_T  = e->T[i];
+            mm->Lgm_VelStep_Bm = e->Bm[i];
+
+            u = e->u[i]; t = e->t[i]; s = e->s[i]; Hnext = e->h[i];
+
+            /*
+             *  Put back this particle's step control. Before its first step
+             *  Hnext is negative, so Lgm_VelStep() starts the tableau
+             *  afresh.
+             */
+            v->Lgm_VelStep_kopt = e->kopt[i];
+            v->Lgm_VelStep_snew = s;
+            v->Lgm_VelStep_FirstTimeThrough = ( Hnext < 0.0 );
+
+            while ( tEnd - t > tEps ) {
+
+                Htry = ( Hnext > 0.0 ) ? Hnext : e->h0;
+                if ( Htry > e->hMax ) Htry = e->hMax;
+                hKeep = Htry;
+                Last = FALSE;
+                if ( t + Htry >= tEnd ) { Htry = tEnd - t; Last = TRUE; }
+
+                reset = FALSE;
+                if ( Lgm_VelStep( &u, &u_scale, Htry, &Hdid, &Hnext, e->Tol, 1.0, &s, &reset, Lgm_DriftEnsemble_Velocity, v ) < 0 ) {
+                    e->Status[i] = LGM_DRIFT_FAILED;
+                    break;
+                }
+                if ( Last && ( Hdid == Htry ) ) {
+                    // Only cut short to land on tEnd, so don't let it shrink the next step.
+                    t = tEnd;
+                    if ( Hnext < hKeep ) Hnext = hKeep;
+                } else {
+                    t += Hdid;
+                }
+
+                r = Lgm_Magnitude( &u );
+                if ( r < e->RInner ) { e->Status[i] = LGM_DRIFT_LOST_INNER; break; }
+                if ( r > e->ROuter ) { e->Status[i] = LGM_DRIFT_LOST_OUTER; break; }
+
+            }
+
+            e->u[i] = u; e->t[i] = t; e->s[i] = s; e->h[i] = Hnext;
+            e->kopt[i] = v->Lgm_VelStep_kopt;
+            if ( e->Status[i] == LGM_DRIFT_ACTIVE ) ++nActive;
+
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_DriftEnsemble_Advance)
+#endif
+        {
+            e->nVelEvals    += v->Lgm_nVelEvals;
+            m->Lgm_nMagEvals += mm->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( m, mm );
+        }
+        Lgm_FreeVelInfo( v );
+        Lgm_FreeMagInfo( mm );
+    }
+
+    return( nActive );
+
+}
@@ -0,0 +1,441 @@
+/*! \file Lgm_Dungey.c
+ *
+ *  \brief Field line topology, footpoints and Bmin for the Dungey field without tracing.
+ *
+ *  \details
+ *      The Dungey field (Lgm_B_Dungey()) is a centered dipole of moment M
+ *      plus a constant dB along SM z. It is axisymmetric about the SM z
+ *      axis, so every field line stays in its SM meridian plane and lies on
+ *      a surface of constant flux function
+ *
+ *          \f[ \Psi = \cos^2\lambda \left( {M\over r} - {dB\over 2} r^2 \right) \equiv \cos^2\lambda\, g(r), \f]
+ *
+ *      (lambda is SM latitude). For southward dB the equatorial B vanishes
+ *      on the neutral ring \f$ r_N = (-M/dB)^{1/3} \f$ and \f$ g \f$ has its
+ *      minimum there, \f$ \Psi_X = g(r_N) = 3M/(2r_N) \f$. This settles the
+ *      topology of the line through any point straight away,
+ *
+ *          - \f$ \Psi > \Psi_X, r < r_N \f$ : closed,
+ *          - \f$ \Psi > \Psi_X, r > r_N \f$ : IMF (never reaches the Earth),
+ *          - \f$ \Psi \le \Psi_X \f$        : open, attached in the hemisphere the point is in,
+ *
+ *      and along a line \f$ r(\lambda) \f$ is just the root of \f$ g(r) =
+ *      \Psi/\cos^2\lambda \f$. Footpoints are then 1D root finds in r, the
+ *      min-B point of a closed line is its equatorial crossing, and arc
+ *      lengths are 1D quadratures. None of this needs the field model, so
+ *      Lgm_Dungey_Trace() only calls m->Bfield to fill in the B vectors at
+ *      the points it returns (instead of the thousands of calls a traced
+ *      Lgm_Trace() makes).
+ *
+ *      Lgm_Trace() uses Lgm_Dungey_Trace() when Lgm_Dungey_IsPure() is TRUE.
+ *      Setting m->UseDipoleFastPath to FALSE makes it trace as usual.
+ *
+ *  \author M.G. Henderson
+ *  \date   2011
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_WGS84.h"
+
+#define DUNGEY_S_TOL    1e-9    // Absolute tolerance on arc lengths (Re)
+#define DUNGEY_S_DEPTH  40      // Max recursion depth for arc lengths
+
+
+/**
+ *  TRUE if m->Bfield is the Dungey field (and m->UseDipoleFastPath is set),
+ *  so that Lgm_Trace() can use Lgm_Dungey_Trace().
+ */
+int Lgm_Dungey_IsPure( Lgm_MagModelInfo *m ) {
+
+    return( m->UseDipoleFastPath && ( m->Bfield == Lgm_B_Dungey ) );
+
+}
+
+
+/*
+ *  g(r) = M/r - dB r^2/2 and its derivative.
+ */
+static double Dungey_g( double r, Lgm_DungeyFL *f ) {
+    return( f->M/r - 0.5*f->dB*r*r );
+}
+static double Dungey_gp( double r, Lgm_DungeyFL *f ) {
+    return( -f->M/(r*r) - f->dB*r );
+}
+
+
+/**
+ *  Set up the field line that goes through u.
+ *
+ *      \param[in]      u   Position (GSM) [Re].
+ *      \param[out]     f   The field line.
+ *      \param[in]      m   A properly initialized and configured Lgm_MagModelInfo structure (coordinate transformations set).
+ *
+ *      \return         SM latitude of u [radians].
+ */
+double Lgm_Dungey_Line( Lgm_Vector *u, Lgm_DungeyFL *f, Lgm_MagModelInfo *m ) {
+
+    Lgm_CTrans  *c = m->c;
+    double      x, y, z, r, sl;
+
+    // Same (fixed) parameters as Lgm_B_Dungey().
+    m->M_Dungey  = 30500.0;
+    m->dB_Dungey = -14.474;
+    f->M  = m->M_Dungey;
+    f->dB = m->dB_Dungey;
+    f->rN = ( f->dB < 0.0 ) ? cbrt( -f->M/f->dB ) : LGM_FILL_VALUE;
+    f->PsiX = ( f->dB < 0.0 ) ? 1.5*f->M/f->rN : 0.0;
+
+    x = u->x*c->cos_psi - u->z*c->sin_psi;
+    y = u->y;
+    z = u->x*c->sin_psi + u->z*c->cos_psi;
+
+    r  = sqrt( x*x + y*y + z*z );
+    sl = z/r;
+    f->Phi = atan2( y, x );
+    f->Psi = ( 1.0 - sl*sl )*Dungey_g( r, f );
+
+    return( asin( sl ) );
+
+}
+
+
+/**
+ *  Topology of the field line through u, without tracing it.
+ *
+ *      \return         LGM_CLOSED, LGM_OPEN_N_LOBE, LGM_OPEN_S_LOBE or LGM_OPEN_IMF.
+ */
+int Lgm_Dungey_Topology( Lgm_Vector *u, Lgm_MagModelInfo *m ) {
+
+    Lgm_DungeyFL    f;
+    double          Lat;
+
+    Lat = Lgm_Dungey_Line( u, &f, m );
+    if ( f.dB >= 0.0 ) return( LGM_CLOSED );
+    if ( f.Psi > f.PsiX ) return( ( Lgm_Magnitude( u ) < f.rN ) ? LGM_CLOSED : LGM_OPEN_IMF );
+    return( ( Lat > 0.0 ) ? LGM_OPEN_N_LOBE : LGM_OPEN_S_LOBE );
+
+}
+
+
+/*
+ *  Radius of the inner (r < rN) part of the line at latitude Lat. g is
+ *  convex and decreasing there, so Newton's method started on the left of
+ *  the root (the dipole answer is) closes in on it monotonically.
+ */
+static double Dungey_rOfLat( double Lat, Lgm_DungeyFL *f ) {
+
+    int     i;
+    double  cl, G, r, dr;
+
+    cl = cos( Lat );
+    G  = f->Psi/(cl*cl);
+    if ( G <= f->PsiX ) return( f->rN );
+
+    r = f->M/G;
+    for ( i=0; i<100; i++ ) {
+        dr = -( Dungey_g( r, f ) - G )/Dungey_gp( r, f );
+        r += dr;
+        if ( fabs( dr ) < 1e-14*r ) break;
+    }
+    return( ( r < f->rN ) ? r : f->rN );
+
+}
+
+
+/*
+ *  Latitude at radius r on the part of the line in hemisphere sgn.
+ */
+static double Dungey_LatOfr( double r, double sgn, Lgm_DungeyFL *f ) {
+
+    double  cl2;
+
+    cl2 = f->Psi/Dungey_g( r, f );
+    if ( cl2 > 1.0 ) cl2 = 1.0;
+    return( sgn*acos( sqrt( cl2 ) ) );
+
+}
+
+
+/*
+ *  GSM position of the point (r, Lat) on the line.
+ */
+static void Dungey_Point( double r, double Lat, Lgm_DungeyFL *f, Lgm_Vector *u, Lgm_MagModelInfo *m ) {
+
+    Lgm_CTrans  *c = m->c;
+    double      cl, x, y, z;
+
+    cl = cos( Lat );
+    x  = r*cl*cos( f->Phi );
+    y  = r*cl*sin( f->Phi );
+    z  = r*sin( Lat );
+
+    u->x =  x*c->cos_psi + z*c->sin_psi;
+    u->y =  y;
+    u->z = -x*c->sin_psi + z*c->cos_psi;
+
+}
+
+
+/*
+ *  ds/dLat on a closed line and ds/dr on an open one.
+ */
+static double Dungey_dSdLat( double Lat, Lgm_DungeyFL *f ) {
+
+    double  r, rp;
+
+    r  = Dungey_rOfLat( Lat, f );
+    rp = 2.0*tan( Lat )*Dungey_g( r, f )/Dungey_gp( r, f );
+    return( sqrt( r*r + rp*rp ) );
+
+}
+static double Dungey_dSdr( double r, Lgm_DungeyFL *f ) {
+
+    double  g, gp, cl2;
+
+    g   = Dungey_g( r, f );
+    gp  = Dungey_gp( r, f );
+    cl2 = f->Psi/g;
+    return( sqrt( 1.0 + r*r*gp*gp*cl2/( 4.0*g*g*( 1.0 - cl2 ) ) ) );
+
+}
+
+
+/*
+ *  Adaptive Simpson. Lines close to the separatrix turn sharply near the
+ *  neutral ring, so a fixed rule is not good enough there.
+ */
+static double Dungey_Simpson( double (*ds)( double, Lgm_DungeyFL * ), Lgm_DungeyFL *f, double a, double b,
+                              double fa, double fm, double fb, double S, double eps, int depth ) {
+
+    double  m, lm, rm, flm, frm, Sl, Sr;
+
+    m   = 0.5*( a + b );
+    lm  = 0.5*( a + m );
+    rm  = 0.5*( m + b );
+    flm = ds( lm, f );
+    frm = ds( rm, f );
+    Sl  = ( m - a )*( fa + 4.0*flm + fm )/6.0;
+    Sr  = ( b - m )*( fm + 4.0*frm + fb )/6.0;
+
+    if ( ( depth <= 0 ) || ( fabs( Sl + Sr - S ) <= 15.0*eps ) ) return( Sl + Sr + ( Sl + Sr - S )/15.0 );
+    return( Dungey_Simpson( ds, f, a, m, fa, flm, fm, Sl, 0.5*eps, depth-1 )
+          + Dungey_Simpson( ds, f, m, b, fm, frm, fb, Sr, 0.5*eps, depth-1 ) );
+
+}
+
+static double Dungey_ArcLength( double (*ds)( double, Lgm_DungeyFL * ), Lgm_DungeyFL *f, double a, double b ) {
+
+    double  fa, fm, fb;
+
+    if ( a == b ) return( 0.0 );
+    fa = ds( a, f );
+    fm = ds( 0.5*( a + b ), f );
+    fb = ds( b, f );
+    return( fabs( Dungey_Simpson( ds, f, a, b, fa, fm, fb, ( b - a )*( fa + 4.0*fm + fb )/6.0, DUNGEY_S_TOL, DUNGEY_S_DEPTH ) ) );
+
+}
+
+
+/*
+ *  Geodetic height [km] of the point at radius r in hemisphere sgn.
+ */
+static double Dungey_Height( double r, double sgn, Lgm_DungeyFL *f, Lgm_MagModelInfo *m ) {
+
+    Lgm_Vector  u, w;
+    double      H;
+
+    Dungey_Point( r, Dungey_LatOfr( r, sgn, f ), f, &u, m );
+    Lgm_Convert_Coords( &u, &w, GSM_TO_WGS84, m->c );
+    Lgm_WGS84_to_GeodHeight( &w, &H );
+    return( H );
+
+}
+
+
+/*
+ *  Radius where the line comes down to geodetic height Height [km] in the
+ *  northern (sgn > 0) or southern (sgn < 0) hemisphere. rMax is the largest
+ *  radius the near-Earth part of the line gets to (its equatorial radius if
+ *  it is closed). FALSE if the line doesn't get up to Height.
+ */
+static int Dungey_FootR( double Height, double sgn, double rMax, Lgm_DungeyFL *f, double *rf, Lgm_MagModelInfo *m ) {
+
+    int     i, Side = 0;
+    double  a, b, c, Fa, Fb, Fc;
+
+    a = ( WGS84_B + Height )/WGS84_A - 1e-3;
+    b = ( WGS84_A + Height )/WGS84_A + 1e-3;
+    if ( b > rMax ) b = rMax;
+    if ( a >= b ) return( FALSE );
+
+    Fa = Dungey_Height( a, sgn, f, m ) - Height;
+    Fb = Dungey_Height( b, sgn, f, m ) - Height;
+    if ( ( Fa > 0.0 ) || ( Fb < 0.0 ) ) return( FALSE );
+
+    /*
+     *  Illinois false position.
+     */
+    c = a;
+    for ( i=0; i<100; i++ ) {
+
+        c  = ( Fa*b - Fb*a )/( Fa - Fb );
+        Fc = Dungey_Height( c, sgn, f, m ) - Height;
+
+        if ( ( fabs( Fc ) < 1e-9 ) || ( fabs( b - a ) < 1e-14 ) ) break;
+        if ( Fc < 0.0 ) {
+            a = c; Fa = Fc;
+            if ( Side == 1 ) Fb *= 0.5;
+            Side = 1;
+        } else {
+            b = c; Fb = Fc;
+            if ( Side == -1 ) Fa *= 0.5;
+            Side = -1;
+        }
+
+    }
+
+    *rf = c;
+    return( TRUE );
+
+}
+
+
+/**
+ *  The Dungey field counterpart of Lgm_Trace(). Takes the same arguments
+ *  (less the tolerances, which it doesn't need), returns the same codes and
+ *  sets the same members of m.
+ *
+ *  For an open line only the attached end is found; the other footpoint and
+ *  v3 are set to LGM_FILL_VALUE.
+ */
+int Lgm_Dungey_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, Lgm_MagModelInfo *m ) {
+
+    Lgm_DungeyFL    f;
+    Lgm_Vector      w, Bvec;
+    double          Lat, r, H, sgn, req, rS, rN, LatS, LatN, S, b0, a0, q, r2;
+    int             Type;
+
+    m->Smin   = LGM_FILL_VALUE;
+    m->Snorth = LGM_FILL_VALUE;
+    m->Ssouth = LGM_FILL_VALUE;
+    m->Stotal = LGM_FILL_VALUE;
+    m->Bmin   = LGM_FILL_VALUE;
+
+    Lgm_Convert_Coords( u, &w, GSM_TO_WGS84, m->c );
+    Lgm_WGS84_to_GeodHeight( &w, &H );
+    if ( H < 0.0 ) return( LGM_INSIDE_EARTH );
+
+    Lat = Lgm_Dungey_Line( u, &f, m );
+    if ( f.dB >= 0.0 ) {
+        // Lgm_B_Dungey() always has dB < 0. A northward dB would put the
+        // neutral points on the axis and Bmin need not be at the equator.
+        printf("Lgm_Dungey_Trace(): Only southward dB is handled (dB = %g).\n", f.dB );
+        return( LGM_BAD_TRACE );
+    }
+
+    r    = Lgm_Magnitude( u );
+    Type = Lgm_Dungey_Topology( u, m );
+    if ( Type == LGM_OPEN_IMF ) return( LGM_OPEN_IMF );
+
+    v1->x = v1->y = v1->z = LGM_FILL_VALUE;
+    v2->x = v2->y = v2->z = LGM_FILL_VALUE;
+    v3->x = v3->y = v3->z = LGM_FILL_VALUE;
+
+    if ( Type != LGM_CLOSED ) {
+
+        /*
+         *  Open. r increases monotonically away from the Earth along the
+         *  line, so use r as the variable.
+         */
+        sgn = ( Type == LGM_OPEN_N_LOBE ) ? 1.0 : -1.0;
+        if ( !Dungey_FootR( Height, sgn, 1e30, &f, &rS, m ) ) return( LGM_TARGET_HEIGHT_UNREACHABLE );
+        S = Dungey_ArcLength( Dungey_dSdr, &f, rS, r );
+        m->v3_final = *v3;
+
+        if ( sgn > 0.0 ) {
+            Dungey_Point( rS, Dungey_LatOfr( rS, sgn, &f ), &f, v2, m );
+            m->Snorth = S;
+            m->v2_final = *v2;
+            m->Ellipsoid_Footprint_Pn = *v2;
+            m->Bfield( v2, &Bvec, m );
+            m->Ellipsoid_Footprint_Bvecn = Bvec;
+            m->Ellipsoid_Footprint_Bn    = Lgm_Magnitude( &Bvec );
+        } else {
+            Dungey_Point( rS, Dungey_LatOfr( rS, sgn, &f ), &f, v1, m );
+            m->Ssouth = S;
+            m->v1_final = *v1;
+            m->Ellipsoid_Footprint_Ps = *v1;
+            m->Bfield( v1, &Bvec, m );
+            m->Ellipsoid_Footprint_Bvecs = Bvec;
+            m->Ellipsoid_Footprint_Bs    = Lgm_Magnitude( &Bvec );
+        }
+
+        return( Type );
+
+    }
+
+
+    /*
+     *  Closed. Latitude increases monotonically from the southern to the
+     *  northern footpoint, so use it as the variable.
+     */
+    req = Dungey_rOfLat( 0.0, &f );
+    if ( !Dungey_FootR( Height, -1.0, req, &f, &rS, m ) || !Dungey_FootR( Height, 1.0, req, &f, &rN, m ) ) {
+        return( LGM_TARGET_HEIGHT_UNREACHABLE );
+    }
+    LatS = Dungey_LatOfr( rS, -1.0, &f );
+    LatN = Dungey_LatOfr( rN,  1.0, &f );
+
+    Dungey_Point( rS, LatS, &f, v1, m );
+    Dungey_Point( rN, LatN, &f, v2, m );
+    Dungey_Point( req, 0.0, &f, v3, m );
+    m->v1_final = *v1;
+    m->v2_final = *v2;
+
+    m->v3_final = *v3;
+    m->Pmin     = *v3;
+    m->Bfield( v3, &Bvec, m );
+    m->Bvecmin  = Bvec;
+    m->Bmin     = Lgm_Magnitude( &Bvec );
+
+    m->Snorth  = Dungey_ArcLength( Dungey_dSdLat, &f, Lat, LatN );
+    m->Ssouth  = Dungey_ArcLength( Dungey_dSdLat, &f, LatS, Lat );
+    m->Stotal  = m->Snorth + m->Ssouth;
+    m->Smin    = Dungey_ArcLength( Dungey_dSdLat, &f, LatS, 0.0 );    // south foot to Pmin
+    m->Trace_s = m->Stotal;
+
+    m->Ellipsoid_Footprint_Pn = *v2;
+    m->Bfield( v2, &Bvec, m );
+    m->Ellipsoid_Footprint_Bvecn = Bvec;
+    m->Ellipsoid_Footprint_Bn    = Lgm_Magnitude( &Bvec );
+
+    m->Ellipsoid_Footprint_Ps = *v1;
+    m->Bfield( v1, &Bvec, m );
+    m->Ellipsoid_Footprint_Bvecs = Bvec;
+    m->Ellipsoid_Footprint_Bs    = Lgm_Magnitude( &Bvec );
+
+    /*
+     *  At the equator r' = 0, r'' = 2g/g' and ds/dLat = r. Expanding B^2 =
+     *  cos^2(Lat) (M/r^3 + dB)^2 + sin^2(Lat) (2M/r^3 - dB)^2 to second order
+     *  in Lat gives d2B/ds2, and the curvature is (r - r'')/r^2 (which are
+     *  9Beq/L^2 and 3/L for dB = 0).
+     */
+    if ( m->ComputeSb0 ) {
+        q  = f.M/(req*req*req);
+        b0 = q + f.dB;
+        a0 = f.dB - 2.0*q;
+        r2 = 2.0*Dungey_g( req, &f )/Dungey_gp( req, &f );
+        m->d2B_ds2 = ( a0*a0 - b0*b0 - 3.0*b0*q*r2/req )/( b0*req*req );
+        m->Sb0     = M_PI*M_SQRT2*sqrt( m->Bmin/m->d2B_ds2 );
+        m->Kappa   = ( req - r2 )/( req*req );
+        m->RofC    = 1.0/m->Kappa;
+    }
+
+    return( LGM_CLOSED );
+
+}
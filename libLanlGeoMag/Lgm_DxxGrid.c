@@ -0,0 +1,420 @@
+/*! \file Lgm_DxxGrid.c
+ *
+ *  \brief Tables of bounce-averaged diffusion coefficients on an (L, Ek, Alpha0) grid.
+ *
+ *  Lgm_SummersDxxBounceAvg() and Lgm_GlauertAndHorneDxxBounceAvg() give the
+ *  bounce-averaged Daa, Dap and Dpp for one (Alpha0, Ek, L). A diffusion code
+ *  needs them on a whole grid, and every caller ends up writing the same
+ *  loops, computing the wave normal angle normalization N(w) for the Glauert
+ *  and Horne model itself, and recomputing the table every run.
+ *
+ *  Lgm_DxxGrid_Compute() does all of that once:
+ *
+ *      - N(w) (which depends only on the wave normal angle distribution and
+ *        aStar) is computed once for the whole table, with
+ *        computeNormalizerForWavePowerSpectrumFunctionForRangeOfPlasmaParameters(),
+ *        and shared by every cell.
+ *      - The cells (these are independent) are spread over threads.
+ *      - The table is written to a file, and a later call with the same file
+ *        name picks it up instead of recomputing, provided the wave model
+ *        (including BwFunc() sampled along the field line) and the grid are
+ *        exactly the same.
+ *
+ *  Lgm_DxxGrid_Derivs() then gives dDaa/dAlpha0 and dDap/dAlpha0 on the grid
+ *  by differencing along the grid's own pitch angles, so the derivatives
+ *  cost no more bounce averages (Lgm_SummersDxxDerivsBounceAvg() needs 2 to
+ *  6 of them for every point).
+ *
+ *  Frequencies in the Lgm_DxxWaveModel are fractions of the equatorial
+ *  electron gyro-frequency, so one model covers all L. (They are turned into
+ *  Hz at each L before calling the bounce-average routines.)
+ *
+ *  Usage:
+ *
+ *      Lgm_DxxWaveModel    Wave;
+ *      memset( &Wave, 0, sizeof(Lgm_DxxWaveModel) );
+ *      Wave.Version = LGM_SUMMERS_2007; Wave.WaveMode = LGM_R_MODE_WAVE; ...
+ *      g = Lgm_DxxGrid_Create( &Wave, BwFunc, NULL, nA, Alpha0, nE, Ek, nL, L, aStarEq );
+ *      Lgm_DxxGrid_Compute( g, "chorus.dxx" );
+ *      Lgm_DxxGrid_Derivs( g );        // if dDaa/dAlpha0, dDap/dAlpha0 are wanted
+ *      ... g->Daa[iL][iE][iA], g->dDaa[iL][iE][iA] ...
+ *      Lgm_DxxGrid_Free( g );
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include "Lgm/Lgm_DxxGrid.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+
+
+static int DxxGrid_FWrite( void *p, size_t n, FILE *fp ) {
+    return( fwrite( p, 1, n, fp ) == n );
+}
+
+static int DxxGrid_FRead( void *p, size_t n, FILE *fp ) {
+    return( fread( p, 1, n, fp ) == n );
+}
+
+/*
+ *  Length of N(w) (0 if the model doesnt use it).
+ */
+static long int DxxGrid_nNw( Lgm_DxxWaveModel *Wave ) {
+    if ( Wave->Version != LGM_GLAUERT_AND_HORNE_HIGH_FREQ ) return( 0 );
+    return( (long int)Wave->nNw*(long int)Wave->nPlasmaParameters );
+}
+
+
+/**
+ *  Create a Lgm_DxxGrid. The wave model and the grids are copied. Nothing is
+ *  computed until Lgm_DxxGrid_Compute() is called.
+ *
+ *      \param[in]      Wave        The wave model.
+ *      \param[in]      BwFunc      Wave amplitude [nT] versus magnetic latitude [radians].
+ *      \param[in]      BwFuncData  Passed to BwFunc().
+ *      \param[in]      nAlpha      Number of equatorial pitch angles.
+ *      \param[in]      Alpha0      Equatorial pitch angles [Degrees].
+ *      \param[in]      nE          Number of energies.
+ *      \param[in]      Ek          Kinetic energies [MeV].
+ *      \param[in]      nL          Number of L-shells.
+ *      \param[in]      L           Dipole L-shells.
+ *      \param[in]      aStarEq     Equatorial aStar (Omega_e^2/omega_pe^2) at each L.
+ *
+ *      \return         A new Lgm_DxxGrid (free with Lgm_DxxGrid_Free()), or NULL.
+ *
+ */
+Lgm_DxxGrid *Lgm_DxxGrid_Create( Lgm_DxxWaveModel *Wave, double (*BwFunc)( double, void * ), void *BwFuncData, int nAlpha, double *Alpha0, int nE, double *Ek, int nL, double *L, double *aStarEq ) {
+
+    Lgm_DxxGrid *g;
+    long int    n;
+    int         i;
+
+    if ( ( nAlpha < 1 ) || ( nE < 1 ) || ( nL < 1 ) ) {
+        printf("Lgm_DxxGrid_Create: grid must have at least one point in each direction (nAlpha, nE, nL = %d, %d, %d)\n", nAlpha, nE, nL );
+        return( NULL );
+    }
+    if ( Wave->Version == LGM_GLAUERT_AND_HORNE_HIGH_FREQ ) {
+        if ( ( Wave->nWna < 1 ) || ( Wave->nWna > LGM_DXXGRID_MAX_WNA ) ) {
+            printf("Lgm_DxxGrid_Create: nWna must be between 1 and %d (got %d)\n", LGM_DXXGRID_MAX_WNA, Wave->nWna );
+            return( NULL );
+        }
+        if ( ( Wave->nNw < 1 ) || ( Wave->nPlasmaParameters < 1 ) || ( Wave->aStarMin <= 0.0 ) || ( Wave->aStarMax <= Wave->aStarMin ) ) {
+            printf("Lgm_DxxGrid_Create: bad N(w) parameters (nNw = %d, nPlasmaParameters = %d, aStarMin = %g, aStarMax = %g)\n", Wave->nNw, Wave->nPlasmaParameters, Wave->aStarMin, Wave->aStarMax );
+            return( NULL );
+        }
+    }
+
+    g = (Lgm_DxxGrid *)calloc( 1, sizeof(Lgm_DxxGrid) );
+
+    /*
+     *  Keep the wave model (with BwFunc() sampled into it, so that files made
+     *  with different amplitudes dont match).
+     */
+    memcpy( &g->Wave, Wave, sizeof(Lgm_DxxWaveModel) );
+    g->Wave.Pad = 0;
+    for ( i=0; i<LGM_DXXGRID_NBW; i++ ) {
+        g->Wave.Bw[i] = BwFunc( Wave->MaxWaveLat*RadPerDeg*(double)i/(double)(LGM_DXXGRID_NBW-1), BwFuncData );
+    }
+    g->BwFunc     = BwFunc;
+    g->BwFuncData = BwFuncData;
+
+    g->nAlpha = nAlpha;
+    g->nE     = nE;
+    g->nL     = nL;
+    LGM_ARRAY_1D( g->Alpha0,  nAlpha, double );
+    LGM_ARRAY_1D( g->Ek,      nE,     double );
+    LGM_ARRAY_1D( g->L,       nL,     double );
+    LGM_ARRAY_1D( g->aStarEq, nL,     double );
+    memcpy( g->Alpha0,  Alpha0,  nAlpha*sizeof(double) );
+    memcpy( g->Ek,      Ek,      nE*sizeof(double) );
+    memcpy( g->L,       L,       nL*sizeof(double) );
+    memcpy( g->aStarEq, aStarEq, nL*sizeof(double) );
+
+    if ( (n = DxxGrid_nNw( &g->Wave )) > 0 ) {
+        LGM_ARRAY_1D( g->Nw, n, double );
+    }
+
+    LGM_ARRAY_3D( g->Daa, nL, nE, nAlpha, double );
+    LGM_ARRAY_3D( g->Dap, nL, nE, nAlpha, double );
+    LGM_ARRAY_3D( g->Dpp, nL, nE, nAlpha, double );
+
+    return( g );
+
+}
+
+
+/**
+ *  Fill in Daa, Dap and Dpp.
+ *
+ *  If Filename is not NULL and holds a table made with the same wave model
+ *  and grid, it is read instead. Otherwise the table is computed and (if
+ *  Filename is not NULL) written to Filename.
+ *
+ *      \param[in,out]  g           The grid.
+ *      \param[in]      Filename    Table file (or NULL).
+ *
+ *      \return         TRUE if the table was read or computed, FALSE otherwise.
+ *
+ */
+int Lgm_DxxGrid_Compute( Lgm_DxxGrid *g, char *Filename ) {
+
+    Lgm_DxxWaveModel    *W = &g->Wave;
+    long int            nCells, n;
+    int                 nFail;
+
+    if ( ( Filename != NULL ) && Lgm_DxxGrid_Read( g, Filename ) ) return( TRUE );
+
+    /*
+     *  N(w) depends on aStar and the wave normal angle distribution only, so
+     *  one table serves every cell. (The Glauert and Horne routines index it
+     *  assuming it spans normalized frequencies of [0,1].)
+     */
+    if ( W->Version == LGM_GLAUERT_AND_HORNE_HIGH_FREQ ) {
+        computeNormalizerForWavePowerSpectrumFunctionForRangeOfPlasmaParameters( 0.0, 1.0, W->x1, W->x2, W->nWna, W->xm, W->dx, W->Weights, W->nNw, W->nPlasmaParameters, W->aStarMin, W->aStarMax, g->Nw );
+    }
+
+    nCells = (long int)g->nL*(long int)g->nE*(long int)g->nAlpha;
+    nFail  = 0;
+
+    /*
+     *  The cells are independent. Their cost varies a lot (cells near the
+     *  loss cone or near 90 degrees are cheap), so hand them out dynamically.
+     */
+    #if USE_OPENMP
+    #pragma omp parallel for schedule(dynamic,1) reduction(+:nFail)
+    #endif
+    for ( n=0; n<nCells; n++ ) {
+
+        int     iL, iE, iA, Status;
+        double  L, Beq, fce, Daa, Dap, Dpp;
+
+        iA = (int)( n % g->nAlpha );
+        iE = (int)( ( n / g->nAlpha ) % g->nE );
+        iL = (int)( n / ( (long int)g->nAlpha*g->nE ) );
+
+        L   = g->L[iL];
+        Beq = M_CDIP/(L*L*L);
+        fce = fabs( Lgm_GyroFreq( -LGM_e, Beq, LGM_ELECTRON_MASS ) )/M_2PI;   // equatorial electron gyro-frequency [Hz]
+
+        Daa = Dap = Dpp = 0.0;
+        if ( W->Version == LGM_GLAUERT_AND_HORNE_HIGH_FREQ ) {
+            Status = Lgm_GlauertAndHorneDxxBounceAvg( W->Version, g->Alpha0[iA], g->Ek[iE], L, g->BwFuncData, g->BwFunc, W->n1, W->n2, W->n3, g->aStarEq[iL], W->Directions,
+                                                      W->w1*fce, W->w2*fce, W->wm*fce, W->dw*fce, W->x1, W->x2, W->nWna, W->xm, W->dx, W->Weights,
+                                                      W->WaveMode, W->Species, W->MaxWaveLat, W->nNw, W->nPlasmaParameters, W->aStarMin, W->aStarMax, g->Nw, &Daa, &Dap, &Dpp );
+        } else {
+            Status = Lgm_SummersDxxBounceAvg( W->Version, g->Alpha0[iA], g->Ek[iE], L, g->BwFuncData, g->BwFunc, W->n1, W->n2, W->n3, g->aStarEq[iL], W->Directions,
+                                              W->w1*fce, W->w2*fce, W->wm*fce, W->dw*fce, W->WaveMode, W->Species, W->MaxWaveLat, &Daa, &Dap, &Dpp );
+        }
+        if ( Status < 0 ) ++nFail;
+
+        g->Daa[iL][iE][iA] = Daa;
+        g->Dap[iL][iE][iA] = Dap;
+        g->Dpp[iL][iE][iA] = Dpp;
+
+    }
+
+    if ( nFail > 0 ) {
+        printf("Lgm_DxxGrid_Compute: %d of %ld cells failed\n", nFail, nCells );
+        return( FALSE );
+    }
+
+    if ( Filename != NULL ) Lgm_DxxGrid_Write( g, Filename );
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  Write a computed table to a file (see Lgm/Lgm_DxxGrid.h for the layout).
+ *
+ *      \param[in]      g           The grid.
+ *      \param[in]      Filename    File to write.
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_DxxGrid_Write( Lgm_DxxGrid *g, char *Filename ) {
+
+    Lgm_DxxGridHeader   h;
+    size_t              nD;
+    int                 Ok;
+    FILE                *fp;
+
+    if ( (fp = fopen( Filename, "wb" )) == NULL ) {
+        printf("Lgm_DxxGrid_Write: could not open %s for writing\n", Filename );
+        return( FALSE );
+    }
+
+    memset( &h, 0, sizeof(Lgm_DxxGridHeader) );
+    memcpy( h.Magic, LGM_DXXGRID_MAGIC, 8 );
+    h.Version = LGM_DXXGRID_VERSION;
+    h.nAlpha  = g->nAlpha;
+    h.nE      = g->nE;
+    h.nL      = g->nL;
+    memcpy( &h.Wave, &g->Wave, sizeof(Lgm_DxxWaveModel) );
+
+    nD = (size_t)g->nL*g->nE*g->nAlpha*sizeof(double);
+    Ok = DxxGrid_FWrite( &h, sizeof(Lgm_DxxGridHeader), fp )
+      && DxxGrid_FWrite( g->Alpha0,  g->nAlpha*sizeof(double), fp )
+      && DxxGrid_FWrite( g->Ek,      g->nE*sizeof(double), fp )
+      && DxxGrid_FWrite( g->L,       g->nL*sizeof(double), fp )
+      && DxxGrid_FWrite( g->aStarEq, g->nL*sizeof(double), fp )
+      && ( ( g->Nw == NULL ) || DxxGrid_FWrite( g->Nw, DxxGrid_nNw( &g->Wave )*sizeof(double), fp ) )
+      && DxxGrid_FWrite( &g->Daa[0][0][0], nD, fp )
+      && DxxGrid_FWrite( &g->Dap[0][0][0], nD, fp )
+      && DxxGrid_FWrite( &g->Dpp[0][0][0], nD, fp );
+
+    if ( ( fclose( fp ) != 0 ) || !Ok ) {
+        printf("Lgm_DxxGrid_Write: error writing %s\n", Filename );
+        remove( Filename );
+        return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  Read a table written by Lgm_DxxGrid_Write() into g. The file is only used
+ *  if its wave model and grid are exactly those of g (so a missing or stale
+ *  file just returns FALSE, quietly).
+ *
+ *      \param[in,out]  g           The grid.
+ *      \param[in]      Filename    File to read.
+ *
+ *      \return         TRUE if Daa, Dap, Dpp (and N(w)) were read, FALSE otherwise.
+ *
+ */
+int Lgm_DxxGrid_Read( Lgm_DxxGrid *g, char *Filename ) {
+
+    Lgm_DxxGridHeader   h;
+    double              *Tmp;
+    size_t              nD, nMax;
+    int                 Ok;
+    FILE                *fp;
+
+    if ( (fp = fopen( Filename, "rb" )) == NULL ) return( FALSE );
+
+    if ( !DxxGrid_FRead( &h, sizeof(Lgm_DxxGridHeader), fp )
+        || memcmp( h.Magic, LGM_DXXGRID_MAGIC, 8 ) || ( h.Version != LGM_DXXGRID_VERSION )
+        || ( h.nAlpha != g->nAlpha ) || ( h.nE != g->nE ) || ( h.nL != g->nL )
+        || memcmp( &h.Wave, &g->Wave, sizeof(Lgm_DxxWaveModel) ) ) {
+        fclose( fp );
+        return( FALSE );
+    }
+
+    /*
+     *  Compare the grids.
+     */
+    nMax = ( g->nAlpha > g->nE ) ? g->nAlpha : g->nE;
+    if ( g->nL > nMax ) nMax = g->nL;
+    LGM_ARRAY_1D( Tmp, nMax, double );
+    Ok = DxxGrid_FRead( Tmp, g->nAlpha*sizeof(double), fp ) && !memcmp( Tmp, g->Alpha0,  g->nAlpha*sizeof(double) )
+      && DxxGrid_FRead( Tmp, g->nE*sizeof(double), fp )     && !memcmp( Tmp, g->Ek,      g->nE*sizeof(double) )
+      && DxxGrid_FRead( Tmp, g->nL*sizeof(double), fp )     && !memcmp( Tmp, g->L,       g->nL*sizeof(double) )
+      && DxxGrid_FRead( Tmp, g->nL*sizeof(double), fp )     && !memcmp( Tmp, g->aStarEq, g->nL*sizeof(double) );
+    LGM_ARRAY_1D_FREE( Tmp );
+
+    nD = (size_t)g->nL*g->nE*g->nAlpha*sizeof(double);
+    Ok = Ok
+      && ( ( g->Nw == NULL ) || DxxGrid_FRead( g->Nw, DxxGrid_nNw( &g->Wave )*sizeof(double), fp ) )
+      && DxxGrid_FRead( &g->Daa[0][0][0], nD, fp )
+      && DxxGrid_FRead( &g->Dap[0][0][0], nD, fp )
+      && DxxGrid_FRead( &g->Dpp[0][0][0], nD, fp );
+
+    fclose( fp );
+
+    return( Ok );
+
+}
+
+
+/**
+ *  Fill in dDaa/dAlpha0 and dDap/dAlpha0 (per Degree) from a computed table.
+ *
+ *  The derivatives are taken along each pitch angle column with the three
+ *  point (second order) formulas for uneven spacing, centered inside and one
+ *  sided at the ends. They are only as good as the pitch angle grid is fine
+ *  (and neither formula sees across a jump, e.g. at the edge of the loss
+ *  cone, any better than the grid does); where that isnt good enough use
+ *  Lgm_SummersDxxDerivsBounceAvg() at the points that need it.
+ *
+ *      \param[in,out]  g           The grid (after Lgm_DxxGrid_Compute()).
+ *
+ *      \return         TRUE, or FALSE if the grid has fewer than two pitch angles.
+ *
+ */
+int Lgm_DxxGrid_Derivs( Lgm_DxxGrid *g ) {
+
+    int     iL, iE, i, i0, n = g->nAlpha;
+    double  *a = g->Alpha0, *f, *df, h1, h2, c0, c1, c2;
+
+    if ( n < 2 ) return( FALSE );
+
+    if ( g->dDaa == NULL ) LGM_ARRAY_3D( g->dDaa, g->nL, g->nE, n, double );
+    if ( g->dDap == NULL ) LGM_ARRAY_3D( g->dDap, g->nL, g->nE, n, double );
+
+    for ( iL=0; iL<g->nL; iL++ ) {
+        for ( iE=0; iE<g->nE; iE++ ) {
+            for ( i=0; i<n; i++ ) {
+
+                if ( n == 2 ) {
+                    c0 = -1.0/(a[1]-a[0]); c1 = -c0; c2 = 0.0; i0 = 0;
+                } else {
+                    // stencil i0, i0+1, i0+2 and where i is in it
+                    i0 = ( i == 0 ) ? 0 : ( i == n-1 ) ? n-3 : i-1;
+                    h1 = a[i0+1] - a[i0];
+                    h2 = a[i0+2] - a[i0+1];
+                    if ( i == i0 ) {
+                        c0 = -(2.0*h1+h2)/(h1*(h1+h2)); c1 = (h1+h2)/(h1*h2);   c2 = -h1/(h2*(h1+h2));
+                    } else if ( i == i0+1 ) {
+                        c0 = -h2/(h1*(h1+h2));          c1 = (h2-h1)/(h1*h2);   c2 = h1/(h2*(h1+h2));
+                    } else {
+                        c0 = h2/(h1*(h1+h2));           c1 = -(h1+h2)/(h1*h2);  c2 = (h1+2.0*h2)/(h2*(h1+h2));
+                    }
+                }
+
+                f = g->Daa[iL][iE]; df = g->dDaa[iL][iE];
+                df[i] = c0*f[i0] + c1*f[i0+1] + ( ( n > 2 ) ? c2*f[i0+2] : 0.0 );
+                f = g->Dap[iL][iE]; df = g->dDap[iL][iE];
+                df[i] = c0*f[i0] + c1*f[i0+1] + ( ( n > 2 ) ? c2*f[i0+2] : 0.0 );
+
+            }
+        }
+    }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  Free a Lgm_DxxGrid made by Lgm_DxxGrid_Create().
+ */
+void Lgm_DxxGrid_Free( Lgm_DxxGrid *g ) {
+
+    if ( g == NULL ) return;
+
+    LGM_ARRAY_1D_FREE( g->Alpha0 );
+    LGM_ARRAY_1D_FREE( g->Ek );
+    LGM_ARRAY_1D_FREE( g->L );
+    LGM_ARRAY_1D_FREE( g->aStarEq );
+    if ( g->Nw != NULL ) LGM_ARRAY_1D_FREE( g->Nw );
+    LGM_ARRAY_3D_FREE( g->Daa );
+    LGM_ARRAY_3D_FREE( g->Dap );
+    LGM_ARRAY_3D_FREE( g->Dpp );
+    if ( g->dDaa != NULL ) LGM_ARRAY_3D_FREE( g->dDaa );
+    if ( g->dDap != NULL ) LGM_ARRAY_3D_FREE( g->dDap );
+    free( g );
+
+}
@@ -0,0 +1,297 @@
+/*! \file Lgm_EclipseEvents.c
+ *
+ *  \brief Find Earth shadow (penumbra and umbra) entry and exit times along a
+ *  trajectory.
+ *
+ *  \details
+ *      Lgm_EarthEclipse() only classifies a single position, using the Sun in
+ *      the current Lgm_CTrans. Finding the eclipses over an orbit with it
+ *      means sampling densely, with a Lgm_Set_Coord_Transforms() for every
+ *      sample. Here the same angles are used as two continuous shadow
+ *      functions,
+ *
+ *          Fp = Theta - (ThetaE + ThetaS)      (< 0 inside the penumbra or umbra)
+ *          Fu = Theta - (ThetaE - ThetaS)      (< 0 inside the umbra)
+ *
+ *      where Theta is the angle between the Earth and the Sun as seen from the
+ *      S/C and ThetaE, ThetaS are their angular radii (see Lgm_Eclipse.c).
+ *      These are sampled at a coarse step, and every sign change is refined
+ *      with an Illinois (modified regula falsi) iteration.
+ *
+ *      The only thing used from the coordinate transformations is the Sun
+ *      vector, which changes by only about a degree a day. So it is computed
+ *      exactly on an hourly grid of nodes (converted into the coordinate
+ *      system of the trajectory) and interpolated linearly in between. The
+ *      resulting error in the Sun direction is below 1e-7 rad, a small
+ *      fraction of a millisecond in the event times for any Earth orbit.
+ *
+ *      An eclipse that both starts and ends between two coarse samples is
+ *      missed, so the step should be shorter than the shortest shadow pass of
+ *      interest (the default of 60s is fine for LEO and beyond, apart from
+ *      grazing passes).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include "Lgm/Lgm_EclipseEvents.h"
+
+#define LGM_ECLIPSE_SUN_NODE_SPACING    (1.0/24.0)  // Spacing of the exact Sun vectors [days]
+#define LGM_ECLIPSE_DEFAULT_STEP        60.0        // [s]
+#define LGM_ECLIPSE_DEFAULT_TOL         1e-3        // [s]
+#define LGM_ECLIPSE_MAX_ITS             60
+
+
+typedef struct Lgm_EclipseSun {
+    double                  JD0;    // Origin of the node grid
+    int                     Coords; // Coordinate system of the trajectory
+    long int                k;      // Nodes k and k+1 are in S[], d[] (k < 0 means none yet)
+    Lgm_Vector              S[2];   // Unit Sun vectors at the two nodes
+    double                  d[2];   // Earth-Sun distances at the two nodes [Re]
+    Lgm_EclipseOrbitFunc    Pos;
+    void                    *Data;
+    Lgm_CTrans              *c;
+} Lgm_EclipseSun;
+
+
+/*
+ *  Exact Sun vector at node k.
+ */
+static void Lgm_EclipseSun_Node( long int k, Lgm_Vector *S, double *d, Lgm_EclipseSun *e ) {
+
+    long int    Date;
+    int         Year, Month, Day;
+    double      UT;
+
+    Lgm_jd_to_ymdh( e->JD0 + k*LGM_ECLIPSE_SUN_NODE_SPACING, &Date, &Year, &Month, &Day, &UT );
+    Lgm_Set_Coord_Transforms( Date, UT, e->c );
+
+    if ( e->Coords == MOD_COORDS ) *S = e->c->Sun;
+    else Lgm_Convert_Coords( &e->c->Sun, S, 100*MOD_COORDS + e->Coords, e->c );
+    *d = e->c->earth_sun_dist;
+
+}
+
+
+/*
+ *  Evaluate the two shadow functions at time t [s] from JD0. Returns FALSE if
+ *  there is no position at that time.
+ */
+static int Lgm_EclipseSun_Shadow( double t, double *Fp, double *Fu, Lgm_EclipseSun *e ) {
+
+    Lgm_Vector  u, S, Psc, Psun;
+    double      x, h, d, Psc_mag, Psun_mag, Theta, ThetaE, ThetaS;
+    long int    k;
+
+    if ( !e->Pos( e->JD0 + t/86400.0, &u, e->Data ) ) return( FALSE );
+
+    /*
+     *  Interpolated Sun vector.
+     */
+    x = t/86400.0/LGM_ECLIPSE_SUN_NODE_SPACING;
+    k = (long int)floor( x );
+    if ( k != e->k ) {
+        if ( k == e->k+1 ) {
+            e->S[0] = e->S[1]; e->d[0] = e->d[1];
+        } else {
+            Lgm_EclipseSun_Node( k, &e->S[0], &e->d[0], e );
+        }
+        Lgm_EclipseSun_Node( k+1, &e->S[1], &e->d[1], e );
+        e->k = k;
+    }
+    h   = x - k;
+    S.x = (1.0-h)*e->S[0].x + h*e->S[1].x;
+    S.y = (1.0-h)*e->S[0].y + h*e->S[1].y;
+    S.z = (1.0-h)*e->S[0].z + h*e->S[1].z;
+    d   = ( (1.0-h)*e->d[0] + h*e->d[1] )*Re;
+    Lgm_ScaleVector( &S, d/Lgm_Magnitude( &S ) ); // Earth to Sun vector [km]
+
+    /*
+     *  Same angles as Lgm_EarthEclipse().
+     */
+    Psc.x = Re*u.x; Psc.y = Re*u.y; Psc.z = Re*u.z;
+    Psc_mag = Lgm_Magnitude( &Psc );
+    Psun.x = S.x - Psc.x; Psun.y = S.y - Psc.y; Psun.z = S.z - Psc.z;
+    Psun_mag = Lgm_Magnitude( &Psun );
+
+    Theta  = acos( Lgm_DotProduct( &Psun, &Psc )/(Psun_mag*Psc_mag) );
+    ThetaE = asin( Re/Psc_mag );
+    ThetaS = asin( SOLAR_RADIUS/Psun_mag );
+
+    *Fp = Theta - (ThetaE + ThetaS);
+    *Fu = Theta - (ThetaE - ThetaS);    // always > 0 if ThetaE < ThetaS (no umbra)
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Refine a sign change of Fp (Which = 0) or Fu (Which = 1) in [t0, t1] with
+ *  the Illinois method.
+ */
+static double Lgm_EclipseSun_Root( int Which, double t0, double f0, double t1, double f1, double Tol, Lgm_EclipseSun *e ) {
+
+    double  t2, f2, Fp, Fu;
+    int     n;
+
+    for ( n=0; ( n < LGM_ECLIPSE_MAX_ITS ) && ( fabs( t1 - t0 ) > Tol ); n++ ) {
+
+        t2 = (f1 != f0) ? ( t0*f1 - t1*f0 )/( f1 - f0 ) : 0.5*(t0+t1);
+        if ( !Lgm_EclipseSun_Shadow( t2, &Fp, &Fu, e ) ) return( 0.5*(t0+t1) );
+        f2 = ( Which == 0 ) ? Fp : Fu;
+        if ( f2 == 0.0 ) return( t2 );
+
+        if ( f2*f1 < 0.0 ) {
+            t0 = t1; f0 = f1;
+        } else {
+            f0 *= 0.5;
+        }
+        t1 = t2; f1 = f2;
+
+    }
+
+    return( t1 );
+
+}
+
+
+/*
+ *  Find the penumbra and umbra boundary crossings between JD0 and JD1 (UTC).
+ *
+ *      Step    - coarse sampling step [s] (<= 0 for 60s).
+ *      Tol     - accuracy of the event times [s] (<= 0 for 1ms).
+ *      Coords  - coordinate system of the positions from Pos().
+ *      Pos     - the trajectory (e.g. Lgm_EclipseOrbit_Sgp4()), with Data
+ *                passed to it.
+ *
+ *  Up to nMax events are returned in Events[] in time order, and the return
+ *  value is the number found (to tell whether JD0 itself is in shadow, use
+ *  Lgm_EarthEclipse()). No crossings are looked for across samples where Pos()
+ *  fails. c is used (and changed) for the Sun vectors.
+ */
+int Lgm_EarthEclipse_Events( double JD0, double JD1, double Step, double Tol, int Coords, Lgm_EclipseOrbitFunc Pos, void *Data,
+                             int nMax, Lgm_EclipseEvent *Events, Lgm_CTrans *c ) {
+
+    Lgm_EclipseSun      e;
+    Lgm_EclipseEvent    ev[2], tmp;
+    double              T, t, tp=0.0, Fp, Fu, Fpp=0.0, Fup=0.0, tr;
+    long int            i, nSteps;
+    int                 n, ne, j, Ok, OkPrev;
+
+    if ( Step <= 0.0 ) Step = LGM_ECLIPSE_DEFAULT_STEP;
+    if ( Tol <= 0.0 )  Tol  = LGM_ECLIPSE_DEFAULT_TOL;
+
+    e.JD0    = JD0;
+    e.Coords = Coords;
+    e.k      = -2;
+    e.Pos    = Pos;
+    e.Data   = Data;
+    e.c      = c;
+
+    T = (JD1 - JD0)*86400.0;
+    if ( T <= 0.0 ) return( 0 );
+    nSteps = (long int)ceil( T/Step );
+
+    n = 0;
+    OkPrev = FALSE;
+    for ( i=0; ( i <= nSteps ) && ( n < nMax ); i++ ) {
+
+        t  = ( i < nSteps ) ? i*Step : T;
+        Ok = Lgm_EclipseSun_Shadow( t, &Fp, &Fu, &e );
+
+        if ( Ok && OkPrev ) {
+
+            ne = 0;
+            if ( ( Fpp >= 0.0 ) != ( Fp >= 0.0 ) ) {
+                tr = Lgm_EclipseSun_Root( 0, tp, Fpp, t, Fp, Tol, &e );
+                ev[ne].JD = JD0 + tr/86400.0; ev[ne].Type = LGM_PENUMBRAL_ECLIPSE; ev[ne].Entry = ( Fp < 0.0 ); ++ne;
+            }
+            if ( ( Fup >= 0.0 ) != ( Fu >= 0.0 ) ) {
+                tr = Lgm_EclipseSun_Root( 1, tp, Fup, t, Fu, Tol, &e );
+                ev[ne].JD = JD0 + tr/86400.0; ev[ne].Type = LGM_UMBRAL_ECLIPSE; ev[ne].Entry = ( Fu < 0.0 ); ++ne;
+            }
+            if ( ( ne == 2 ) && ( ev[1].JD < ev[0].JD ) ) {
+                tmp = ev[0]; ev[0] = ev[1]; ev[1] = tmp;
+            }
+            for ( j=0; ( j < ne ) && ( n < nMax ); j++ ) Events[n++] = ev[j];
+
+        }
+
+        tp = t; Fpp = Fp; Fup = Fu; OkPrev = Ok;
+
+    }
+
+    return( n );
+
+}
+
+
+/*
+ *  Trajectory from SGP4 (TEME_COORDS).
+ */
+int Lgm_EclipseOrbit_Sgp4( double JD, Lgm_Vector *u, void *Data ) {
+
+    Lgm_EclipseSgp4 *a = (Lgm_EclipseSgp4 *)Data;
+
+    if ( !LgmSgp_SGP4( (JD - a->t->JD)*1440.0, a->s ) ) return( FALSE );
+    u->x = a->s->X/Re; u->y = a->s->Y/Re; u->z = a->s->Z/Re;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Trajectory from a table of positions, interpolated with 4-point Lagrange
+ *  polynomials. The coordinate system is whatever the table is in.
+ */
+int Lgm_EclipseOrbit_Table( double JD, Lgm_Vector *u, void *Data ) {
+
+    Lgm_EclipseTable    *a = (Lgm_EclipseTable *)Data;
+    double              *x, w[4];
+    int                 i, il, ih, im, j, k;
+
+    x = a->JD;
+    if ( ( a->n < 4 ) || ( JD < x[0] ) || ( JD > x[a->n-1] ) ) return( FALSE );
+
+    /*
+     *  Find i with x[i] <= JD < x[i+1] (starting from the last one).
+     */
+    i = a->i;
+    if ( ( i < 0 ) || ( i > a->n-2 ) ) i = 0;
+    if ( ( x[i] > JD ) || ( x[i+1] <= JD ) ) {
+        if ( ( i+2 < a->n ) && ( x[i+1] <= JD ) && ( JD < x[i+2] ) ) {
+            ++i;
+        } else {
+            il = 0; ih = a->n-1;
+            while ( ih - il > 1 ) {
+                im = (il+ih)/2;
+                if ( x[im] <= JD ) il = im;
+                else               ih = im;
+            }
+            i = il;
+        }
+    }
+    a->i = i;
+
+    k = i-1;
+    if ( k < 0 ) k = 0;
+    if ( k > a->n-4 ) k = a->n-4;
+    for ( j=0; j<4; j++ ) {
+        w[j] = 1.0;
+        for ( im=0; im<4; im++ ) if ( im != j ) w[j] *= ( JD - x[k+im] )/( x[k+j] - x[k+im] );
+    }
+    u->x = u->y = u->z = 0.0;
+    for ( j=0; j<4; j++ ) {
+        u->x += w[j]*a->u[k+j].x;
+        u->y += w[j]*a->u[k+j].y;
+        u->z += w[j]*a->u[k+j].z;
+    }
+
+    return( TRUE );
+
+}
@@ -10,11 +10,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_Eop.h"
 
 #define JD1962 2437665.5
 
+#define LGM_EOP_CACHE_MAGIC     0x32504f454d474c00LL    // "\0LGMEOP2"
+#define LGM_EOP_CACHE_DIR       "LanlGeoMag"
+#define LGM_EOP_CACHE_NAME      "LgmEop.bin"
+
+
+/*
+ *  Header of the binary cache of LgmEop.dat. It is followed by the eleven
+ *  arrays of Lgm_Eop (Date as int64, the rest as doubles), each nEopVals
+ *  long, in the order they appear in the structure. The text file the cache
+ *  was made from (device, inode, size and mtime) is kept so that a stale
+ *  cache, or one made from some other install's LgmEop.dat, is never used.
+ */
+typedef struct Lgm_EopCacheHeader {
+    int64_t     Magic;
+    int64_t     TextDev;
+    int64_t     TextIno;
+    int64_t     TextSize;
+    int64_t     TextMtime;
+    int64_t     nEopVals;
+} Lgm_EopCacheHeader;
+
 
 Lgm_Eop *Lgm_init_eop( int Verbose ) {
 
@@ -77,49 +102,316 @@ void  Lgm_destroy_eop( Lgm_Eop *e ) {
 }
 
 
+/*
+ *  Make sure the arrays in e hold at least N values.
+ */
+static void Lgm_eop_grow( Lgm_Eop *e, long int N ) {
+
+    if ( N <= e->Size ) return;
+    e->Date = realloc( e->Date, N*sizeof(long int) );
+    e->MJD  = realloc( e->MJD, N*sizeof(double) );
+    e->xp   = realloc( e->xp, N*sizeof(double) );
+    e->yp   = realloc( e->yp, N*sizeof(double) );
+    e->DUT1 = realloc( e->DUT1, N*sizeof(double) );
+    e->LOD  = realloc( e->LOD, N*sizeof(double) );
+    e->dPsi = realloc( e->dPsi, N*sizeof(double) );
+    e->dEps = realloc( e->dEps, N*sizeof(double) );
+    e->dX   = realloc( e->dX, N*sizeof(double) );
+    e->dY   = realloc( e->dY, N*sizeof(double) );
+    e->DAT  = realloc( e->DAT, N*sizeof(double) );
+    e->Size = N;
+
+}
+
+
+/*
+ *  Name of the binary cache file. This is $LGM_EOP_CACHE if that is set
+ *  (setting it to "" turns the cache off), otherwise LgmEop.bin in the
+ *  user's cache directory ($XDG_CACHE_HOME/LanlGeoMag, or
+ *  ~/.cache/LanlGeoMag). The data directory is never written to -- it is
+ *  usually part of an install (or of the source tree). If MakeDir is set the
+ *  per-user directory gets created. Returns FALSE if there is no cache.
+ */
+static int Lgm_eop_cache_filename( char *Filename, int n, int MakeDir ) {
+
+    const char  *Path = getenv( "LGM_EOP_CACHE" );
+    const char  *Home;
+    char        Dir[1024];
+
+    if ( Path != NULL ) {
+        snprintf( Filename, n, "%s", Path );
+        return( Path[0] != '\0' );
+    }
+
+    if ( ( (Path = getenv( "XDG_CACHE_HOME" )) != NULL ) && ( Path[0] == '/' ) ) {
+        snprintf( Dir, 1024, "%s/%s", Path, LGM_EOP_CACHE_DIR );
+    } else if ( ( (Home = getenv( "HOME" )) != NULL ) && ( Home[0] != '\0' ) ) {
+        snprintf( Dir, 1024, "%s/.cache", Home );
+        if ( MakeDir ) mkdir( Dir, 0700 );
+        snprintf( Dir, 1024, "%s/.cache/%s", Home, LGM_EOP_CACHE_DIR );
+    } else {
+        return( FALSE );
+    }
+    if ( MakeDir ) mkdir( Dir, 0700 );
+    snprintf( Filename, n, "%s/%s", Dir, LGM_EOP_CACHE_NAME );
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Load e from the binary cache if there is one that was made from the text
+ *  file described by st. Returns TRUE if it was loaded.
+ */
+static int Lgm_read_eop_cache( Lgm_Eop *e, struct stat *st ) {
+
+    FILE                *fp;
+    char                Filename[1024];
+    Lgm_EopCacheHeader  h;
+    int64_t             *Date;
+    long int            i, n;
+    int                 Ok;
+
+    if ( !Lgm_eop_cache_filename( Filename, 1024, FALSE ) ) return( FALSE );
+    if ( (fp = fopen( Filename, "rb" )) == NULL ) return( FALSE );
+
+    if ( ( fread( &h, sizeof(h), 1, fp ) != 1 ) || ( h.Magic != LGM_EOP_CACHE_MAGIC )
+            || ( h.TextDev != (int64_t)st->st_dev ) || ( h.TextIno != (int64_t)st->st_ino )
+            || ( h.TextSize != (int64_t)st->st_size ) || ( h.TextMtime != (int64_t)st->st_mtime ) || ( h.nEopVals < 0 ) ) {
+        fclose( fp );
+        return( FALSE );
+    }
+
+    n = (long int)h.nEopVals;
+    Lgm_eop_grow( e, n );
+    Date = (int64_t *)malloc( (n > 0 ? n : 1)*sizeof(int64_t) );
+    Ok =   ( fread( Date,    sizeof(int64_t), n, fp ) == (size_t)n )
+        && ( fread( e->MJD,  sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->xp,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->yp,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->DUT1, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->LOD,  sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->dPsi, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->dEps, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->dX,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->dY,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fread( e->DAT,  sizeof(double),  n, fp ) == (size_t)n );
+    fclose( fp );
+
+    if ( Ok ) {
+        for ( i=0; i<n; i++ ) e->Date[i] = (long int)Date[i];
+        e->nEopVals = n;
+    }
+    free( Date );
+
+    return( Ok );
+
+}
+
+
+/*
+ *  Write e to the binary cache. The cache is written to a temporary file and
+ *  renamed into place, so concurrent readers never see a partial file.
+ *  Failure (e.g. no writable cache directory) is not an error -- the text
+ *  file just gets parsed again next time.
+ */
+static void Lgm_write_eop_cache( Lgm_Eop *e, struct stat *st ) {
+
+    FILE                *fp;
+    char                Filename[1024], TmpFile[1100];
+    Lgm_EopCacheHeader  h;
+    int64_t             *Date;
+    long int            i, n = e->nEopVals;
+    int                 Ok;
+
+    if ( !Lgm_eop_cache_filename( Filename, 1024, TRUE ) ) return;
+    snprintf( TmpFile, 1100, "%s.%ld.tmp", Filename, (long int)getpid() );
+    if ( (fp = fopen( TmpFile, "wb" )) == NULL ) return;
+
+    memset( &h, 0, sizeof(h) );
+    h.Magic     = LGM_EOP_CACHE_MAGIC;
+    h.TextDev   = (int64_t)st->st_dev;
+    h.TextIno   = (int64_t)st->st_ino;
+    h.TextSize  = (int64_t)st->st_size;
+    h.TextMtime = (int64_t)st->st_mtime;
+    h.nEopVals  = (int64_t)n;
+
+    Date = (int64_t *)malloc( (n > 0 ? n : 1)*sizeof(int64_t) );
+    for ( i=0; i<n; i++ ) Date[i] = (int64_t)e->Date[i];
+    Ok =   ( fwrite( &h,      sizeof(h),       1, fp ) == 1 )
+        && ( fwrite( Date,    sizeof(int64_t), n, fp ) == (size_t)n )
+        && ( fwrite( e->MJD,  sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->xp,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->yp,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->DUT1, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->LOD,  sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->dPsi, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->dEps, sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->dX,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->dY,   sizeof(double),  n, fp ) == (size_t)n )
+        && ( fwrite( e->DAT,  sizeof(double),  n, fp ) == (size_t)n );
+    free( Date );
+
+    if ( ( fclose( fp ) != 0 ) || !Ok || ( rename( TmpFile, Filename ) != 0 ) ) {
+        remove( TmpFile );
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Read the EOP series from LgmEop.dat.
+ *
+ *  \details
+ *      The parsed series is also kept in a binary cache (LgmEop.bin in
+ *      $XDG_CACHE_HOME/LanlGeoMag or ~/.cache/LanlGeoMag, or wherever
+ *      $LGM_EOP_CACHE says; LGM_EOP_CACHE="" turns it off), and later reads
+ *      use the cache as long as it was made from the same LgmEop.dat with the
+ *      same size and modification time. If the cache can't be written the
+ *      text file is simply parsed each time.
+ *
+ *      \param[in,out]  e   Lgm_Eop structure from Lgm_init_eop().
+ *
+ */
 void Lgm_read_eop( Lgm_Eop *e ) {
 
     FILE        *fp;
-    long int    n, N;
+    long int    n;
     char        *Line, *Filename;
+    struct stat st;
+    int         HaveStat;
 
     Filename = (char *)calloc( 512, sizeof(char) );
     sprintf( Filename, "%s/LgmEop.dat", LGM_EOP_DATA_DIR );
+
+    HaveStat = ( stat( Filename, &st ) == 0 );
+    if ( HaveStat && ( e->nEopVals == 0 ) && Lgm_read_eop_cache( e, &st ) ) {
+        free( Filename );
+        return;
+    }
+
     if ( (fp = fopen( Filename, "r" )) != NULL ) {
 
         Line = (char *)calloc( 260, sizeof(char) );
         while( fgets( Line, 256, fp ) != NULL ) {
             if ( Line[0] != '#' ) {
                 n = e->nEopVals;
-                N = e->Size;
-                if ( n == N ) {
-                    // Out array sizes need to be increased  (try adding another years worth)
-                    N += 365;
-                    e->Date = realloc( e->Date, N );
-                    e->MJD  = realloc( e->MJD, N );
-                    e->xp   = realloc( e->xp, N );
-                    e->yp   = realloc( e->yp, N );
-                    e->DUT1 = realloc( e->DUT1, N );
-                    e->LOD  = realloc( e->LOD, N );
-                    e->dPsi = realloc( e->dPsi, N );
-                    e->dEps = realloc( e->dEps, N );
-                    e->dX   = realloc( e->dX, N );
-                    e->dY   = realloc( e->dY, N );
-                    e->DAT  = realloc( e->DAT, N );
-                    e->Size = N;
-                }
+                // Out array sizes need to be increased  (try adding another years worth)
+                if ( n == e->Size ) Lgm_eop_grow( e, e->Size + 365 );
                 sscanf( Line, "%ld %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf", &e->Date[n], &e->MJD[n], &e->xp[n],
                     &e->yp[n], &e->DUT1[n], &e->LOD[n], &e->dPsi[n], &e->dEps[n], &e->dX[n], &e->dY[n], &e->DAT[n]);
                 ++(e->nEopVals);
             }
         }
-        free(Filename);
         free(Line);
         fclose( fp );
 
+        if ( HaveStat ) Lgm_write_eop_cache( e, &st );
+
     } else {
         printf("Cannot open LgmEop.dat file\n");
     }
+    free(Filename);
+
+}
+
+
+/*
+ *  Process-wide, read-only copy of the LgmEop.dat series (see
+ *  Lgm_get_shared_eop()). Only touched inside the Lgm_SharedEop critical
+ *  section.
+ */
+static Lgm_Eop  *Lgm_SharedEop       = NULL;
+static int      Lgm_SharedEop_nRefs = 0;
+
+
+/**
+ *  \brief
+ *      Get a reference to the process-wide EOP series.
+ *
+ *  \details
+ *      The first call reads LgmEop.dat (as Lgm_init_eop() followed by
+ *      Lgm_read_eop() would); later calls return the same series, so
+ *      threads that each need the EOP values can share one copy rather than
+ *      reading the file for themselves. The series must be treated as
+ *      read-only (Lgm_get_eop_at_JD() only reads it). Each call must be
+ *      matched by a Lgm_release_shared_eop().
+ *
+ *      \return  A pointer to the shared series.
+ *
+ */
+Lgm_Eop *Lgm_get_shared_eop( void ) {
+
+    Lgm_Eop *e;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_SharedEop)
+#endif
+    {
+        if ( Lgm_SharedEop == NULL ) {
+            Lgm_SharedEop = Lgm_init_eop( 0 );
+            Lgm_read_eop( Lgm_SharedEop );
+        }
+        ++Lgm_SharedEop_nRefs;
+        e = Lgm_SharedEop;
+    }
+
+    return( e );
+
+}
+
+
+/**
+ *  \brief
+ *      Release a reference obtained from Lgm_get_shared_eop().
+ *
+ *  \details
+ *      The series is freed when the last reference is released.
+ *
+ *      \param[in]      e   The pointer returned by Lgm_get_shared_eop().
+ *
+ */
+void Lgm_release_shared_eop( Lgm_Eop *e ) {
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_SharedEop)
+#endif
+    {
+        if ( ( e != NULL ) && ( e == Lgm_SharedEop ) && ( Lgm_SharedEop_nRefs > 0 ) ) {
+            if ( --Lgm_SharedEop_nRefs == 0 ) {
+                Lgm_destroy_eop( Lgm_SharedEop );
+                Lgm_SharedEop = NULL;
+            }
+        }
+    }
+
+}
+
+
+/*
+ *  Index q of the last EOP value with MJD[q] <= MJD (0 if MJD is before the
+ *  first one). The values are daily from 1962, so the index is normally
+ *  just the day number; that guess is checked, and a binary search is only
+ *  needed if the series has gaps.
+ */
+static long int Lgm_eop_index( double MJD, Lgm_Eop *e ) {
+
+    long int    q, lo, hi, mid, n = e->nEopVals;
+
+    q = (long int)( MJD + 2400000.5 - JD1962 );
+    if ( ( q >= 0 ) && ( q < n ) && ( e->MJD[q] <= MJD ) && ( ( q == n-1 ) || ( MJD < e->MJD[q+1] ) ) ) return( q );
+
+    if ( MJD < e->MJD[0] ) return( 0 );
+    lo = 0; hi = n-1;
+    while ( hi - lo > 1 ) {
+        mid = ( lo + hi )/2;
+        if ( e->MJD[mid] <= MJD ) lo = mid;
+        else                      hi = mid;
+    }
+
+    return( ( e->MJD[hi] <= MJD ) ? hi : lo );
 
 }
 
@@ -152,11 +444,11 @@ void Lgm_get_eop_at_JD( double JD, Lgm_EopOne *eop, Lgm_Eop *e ) {
 
     } else {
 
-        q = (int)( JD-JD1962 ); // approximate index where JD is found in the LgmEop.dat file
+        q = Lgm_eop_index( MJD, e ); // index where JD is found in the LgmEop.dat file
         ql = q-7; // set low index to -7days
         qh = q+7; // set high index to +7days
         if (ql < 0 ) ql = 0;
-        if (qh >= e->nEopVals ) qh = e->nEopVals;
+        if (qh >= e->nEopVals ) qh = e->nEopVals-1;
         nq = qh-ql+1;
         x = (double *)calloc( nq, sizeof(double) );
         y = (double *)calloc( nq, sizeof(double) );
@@ -0,0 +1,275 @@
+/*! \file Lgm_EphemCache.c
+ *
+ *  \brief Shared per-day Chebyshev fits of the Sun and Moon ephemerides.
+ *
+ *  Lgm_ComputeSun() and Lgm_ComputeMoon() are called on every
+ *  Lgm_Set_Coord_Transforms(). With LGM_EPH_HIGH_ACCURACY that means a full
+ *  evaluation of the Lgm_SunPosition() series, and with LGM_EPH_DE five
+ *  record lookups and Chebyshev evaluations in the JPL file (Sun, Earth-Moon
+ *  barycenter and Moon, twice over for the Sun). Over a day all of these are
+ *  very smooth functions of time, so here each one is fitted once per TT day
+ *  (on Chebyshev nodes) and every query on that day is a short Clenshaw sum.
+ *
+ *  The fits live in a small process-wide table keyed on (ephModel, DEnum,
+ *  day), so every Lgm_CTrans (and every thread) working on the same day
+ *  shares one fit. The table is only read or written inside the
+ *  Lgm_EphemCache critical section. Hits are copied into an Lgm_EphemCache
+ *  owned by the caller (c->EphemCache), and later queries on the same day
+ *  never go near the table. Misses are fitted outside the critical section,
+ *  with the caller's own JPL ephemeris.
+ *
+ *  Worst-case errors of the fits relative to the direct evaluation (over
+ *  1990-2030);
+ *
+ *          LGM_EPH_HIGH_ACCURACY  Sun        < 2e-6 arcsec (l, b), < 1e-13 AU (r)
+ *          LGM_EPH_DE             Sun        < 1e-3 km
+ *                                 Moon       < 1e-4 km
+ *
+ *  These are at the noise level of the direct evaluations (round-off in the
+ *  Lgm_SunPosition() arguments, and the small steps between JPL records
+ *  when a day straddles a record boundary), so more coefficients do not
+ *  help.
+ *
+ *  LGM_EPH_LOW_ACCURACY and the analytic Moon used with it (and with
+ *  LGM_EPH_HIGH_ACCURACY) are a handful of trig calls on quantities
+ *  Lgm_Set_Coord_Transforms() already has, so they are not cached.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <math.h>
+#include "Lgm/Lgm_CTrans.h"
+
+#define LGM_EPHEM_CACHE_SIZE        16  // Number of days kept in the shared table
+#define LGM_EPHEM_CACHE_NCOEFFS_SUN 10  // Chebyshev coefficients per series for LGM_EPH_HIGH_ACCURACY
+#define LGM_EPHEM_CACHE_NCOEFFS_DE  12  // Chebyshev coefficients per series for LGM_EPH_DE
+
+
+static Lgm_EphemCache   Lgm_EphemCache_Shared[LGM_EPHEM_CACHE_SIZE];
+static int              Lgm_EphemCache_nEntries = 0;
+static int              Lgm_EphemCache_Next     = 0;
+static long int         Lgm_EphemCache_nHits    = 0;
+static long int         Lgm_EphemCache_nMisses  = 0;
+
+
+/*
+ *  Fit the TT day starting at JD0 for ephModel into ec.
+ */
+static void Lgm_EphemCache_Fit( double JD0, int ephModel, Lgm_JPLephemInfo *jpl, Lgm_EphemCache *ec ) {
+
+    int         i, j, k, n;
+    double      x, JD, l, r, b, s, f[6][LGM_EPHEM_CACHE_MAX_COEFFS];
+    Lgm_Vector  Sun, Moon;
+
+    ec->ephModel = ephModel;
+    ec->DEnum    = ( ephModel == LGM_EPH_DE ) ? jpl->DEnum : 0;
+    ec->JD0      = JD0;
+    ec->JD1      = JD0 + 1.0;
+    ec->nSeries  = ( ephModel == LGM_EPH_DE ) ? 6 : 3;
+    ec->nCoeffs  = n = ( ephModel == LGM_EPH_DE ) ? LGM_EPHEM_CACHE_NCOEFFS_DE : LGM_EPHEM_CACHE_NCOEFFS_SUN;
+
+    for ( k=0; k<n; k++ ) {
+        x  = cos( M_PI*(k+0.5)/n );
+        JD = JD0 + 0.5 + 0.5*x;
+        if ( ephModel == LGM_EPH_DE ) {
+            Lgm_JPL_getSunVector( JD, jpl, &Sun );
+            Lgm_JPLephem_position( JD, LGM_DE_MOON, jpl, &Moon );
+            f[0][k] = Sun.x;  f[1][k] = Sun.y;  f[2][k] = Sun.z;
+            f[3][k] = Moon.x; f[4][k] = Moon.y; f[5][k] = Moon.z;
+        } else {
+            Lgm_SunPosition( (JD - 2451545.0)/36525.0, &l, &r, &b );
+            // l is reduced to [0, 2pi); keep it continuous across the day
+            if ( k > 0 ) l += M_2PI*floor( ( f[0][k-1] - l )/M_2PI + 0.5 );
+            f[0][k] = l; f[1][k] = r; f[2][k] = b;
+        }
+    }
+
+    for ( i=0; i<ec->nSeries; i++ ) {
+        for ( j=0; j<n; j++ ) {
+            for ( s=0.0, k=0; k<n; k++ ) s += f[i][k]*cos( M_PI*j*(k+0.5)/n );
+            ec->Coeffs[i][j] = 2.0*s/n;
+        }
+        ec->Coeffs[i][0] *= 0.5;
+    }
+
+}
+
+
+/*
+ *  Make sure ec holds the fit for the day containing JD (TT). The caller's
+ *  own copy is tried first, then the shared table. On a miss the day is
+ *  fitted and added to the table (replacing the oldest entry when it is
+ *  full).
+ */
+static void Lgm_EphemCache_Get( double JD, int ephModel, Lgm_JPLephemInfo *jpl, Lgm_EphemCache *ec ) {
+
+    int     i, DEnum, Found = FALSE;
+    double  JD0;
+
+    DEnum = ( ephModel == LGM_EPH_DE ) ? jpl->DEnum : 0;
+    if ( ( ec->ephModel == ephModel ) && ( ec->DEnum == DEnum ) && ( JD >= ec->JD0 ) && ( JD < ec->JD1 ) ) return;
+
+    // TT days run from JD x.5 (0h TT)
+    JD0 = floor( JD - 0.5 ) + 0.5;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_EphemCache)
+#endif
+    {
+        for ( i=0; i<Lgm_EphemCache_nEntries; ++i ) {
+            if ( ( Lgm_EphemCache_Shared[i].ephModel == ephModel ) && ( Lgm_EphemCache_Shared[i].DEnum == DEnum ) && ( Lgm_EphemCache_Shared[i].JD0 == JD0 ) ) {
+                *ec = Lgm_EphemCache_Shared[i];
+                Found = TRUE;
+                break;
+            }
+        }
+        if ( Found ) ++Lgm_EphemCache_nHits;
+        else         ++Lgm_EphemCache_nMisses;
+    }
+    if ( Found ) return;
+
+    Lgm_EphemCache_Fit( JD0, ephModel, jpl, ec );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_EphemCache)
+#endif
+    {
+        // another thread may have fitted the same day in the meantime
+        for ( Found = FALSE, i=0; i<Lgm_EphemCache_nEntries; ++i ) {
+            if ( ( Lgm_EphemCache_Shared[i].ephModel == ephModel ) && ( Lgm_EphemCache_Shared[i].DEnum == DEnum ) && ( Lgm_EphemCache_Shared[i].JD0 == JD0 ) ) Found = TRUE;
+        }
+        if ( !Found ) {
+            Lgm_EphemCache_Shared[ Lgm_EphemCache_Next ] = *ec;
+            Lgm_EphemCache_Next = (Lgm_EphemCache_Next+1)%LGM_EPHEM_CACHE_SIZE;
+            if ( Lgm_EphemCache_nEntries < LGM_EPHEM_CACHE_SIZE ) ++Lgm_EphemCache_nEntries;
+        }
+    }
+
+}
+
+
+/*
+ *  Evaluate all of the series in ec at JD (Clenshaw recurrence).
+ */
+static void Lgm_EphemCache_Eval( double JD, Lgm_EphemCache *ec, double *v ) {
+
+    int     i, j;
+    double  x, x2, b0, b1, b2;
+
+    x  = ( 2.0*JD - ( ec->JD0 + ec->JD1 ) )/( ec->JD1 - ec->JD0 );
+    x2 = 2.0*x;
+    for ( i=0; i<ec->nSeries; i++ ) {
+        b1 = b2 = 0.0;
+        for ( j=ec->nCoeffs-1; j>=1; j-- ) {
+            b0 = x2*b1 - b2 + ec->Coeffs[i][j]; b2 = b1; b1 = b0;
+        }
+        v[i] = x*b1 - b2 + ec->Coeffs[i][0];
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Cached equivalent of Lgm_SunPosition().
+ *
+ *  \details
+ *      Returns the same quantities as Lgm_SunPosition() (to the accuracy
+ *      given at the top of Lgm_EphemCache.c) from the shared per-day fit.
+ *      Note that the time argument is a TT Julian Date rather than Julian
+ *      centuries.
+ *
+ *      \param[in]      JD_TT   TT Julian Date.
+ *      \param[in,out]  ec      Caller's copy of the fit (zero it before first use; c->EphemCache in an Lgm_CTrans).
+ *      \param[out]     l       Ecliptic longitude of the Sun (radians, 0 to 2pi).
+ *      \param[out]     r       Earth-Sun distance (AU).
+ *      \param[out]     b       Ecliptic latitude of the Sun (radians).
+ *
+ *      \return         TRUE.
+ *
+ */
+int Lgm_EphemCache_SunPosition( double JD_TT, Lgm_EphemCache *ec, double *l, double *r, double *b ) {
+
+    double  v[6];
+
+    Lgm_EphemCache_Get( JD_TT, LGM_EPH_HIGH_ACCURACY, NULL, ec );
+    Lgm_EphemCache_Eval( JD_TT, ec, v );
+
+    *l = Lgm_angle2pi( v[0] );
+    *r = v[1];
+    *b = v[2];
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Cached equivalent of Lgm_JPL_getSunVector() and Lgm_JPLephem_position( ..., LGM_DE_MOON, ... ).
+ *
+ *  \details
+ *      Gives the geocentric Sun and Moon vectors (GCRF, km) from the shared
+ *      per-day fit of the JPL ephemeris in \a jpl. The fits are shared
+ *      between all ephemerides with the same DE number.
+ *
+ *      \param[in]      JD_TT   TT Julian Date.
+ *      \param[in]      jpl     An initialized JPL ephemeris (with at least the Sun and Earth-Moon records).
+ *      \param[in,out]  ec      Caller's copy of the fit (zero it before first use; c->EphemCache in an Lgm_CTrans).
+ *      \param[out]     Sun     Earth to Sun vector (km). May be NULL.
+ *      \param[out]     Moon    Earth to Moon vector (km). May be NULL.
+ *
+ *      \return         TRUE, or FALSE if jpl is NULL.
+ *
+ */
+int Lgm_EphemCache_JPL( double JD_TT, Lgm_JPLephemInfo *jpl, Lgm_EphemCache *ec, Lgm_Vector *Sun, Lgm_Vector *Moon ) {
+
+    double  v[6];
+
+    if ( jpl == NULL ) return( FALSE );
+
+    Lgm_EphemCache_Get( JD_TT, LGM_EPH_DE, jpl, ec );
+    Lgm_EphemCache_Eval( JD_TT, ec, v );
+
+    if ( Sun )  { Sun->x  = v[0]; Sun->y  = v[1]; Sun->z  = v[2]; }
+    if ( Moon ) { Moon->x = v[3]; Moon->y = v[4]; Moon->z = v[5]; }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Empty the process-wide Sun/Moon ephemeris cache.
+ *
+ *  \details
+ *      Copies already held by Lgm_CTrans structures stay valid for their day.
+ */
+void Lgm_EphemCache_Clear( ) {
+#if USE_OPENMP
+    #pragma omp critical (Lgm_EphemCache)
+#endif
+    {
+        Lgm_EphemCache_nEntries = 0;
+        Lgm_EphemCache_Next     = 0;
+        Lgm_EphemCache_nHits    = 0;
+        Lgm_EphemCache_nMisses  = 0;
+    }
+}
+
+
+/**
+ *  \brief
+ *      Return the number of hits and misses in the shared Sun/Moon ephemeris cache.
+ */
+void Lgm_EphemCache_Stats( long int *nHits, long int *nMisses ) {
+#if USE_OPENMP
+    #pragma omp critical (Lgm_EphemCache)
+#endif
+    {
+        *nHits   = Lgm_EphemCache_nHits;
+        *nMisses = Lgm_EphemCache_nMisses;
+    }
+}
@@ -0,0 +1,226 @@
+/*! \file Lgm_FLSpline.c
+ *
+ *  \brief Interpolation along a traced field line.
+ *
+ *  \details
+ *      InitSpline() used to set up four gsl splines over Info->s (for
+ *      BminusBcdip, Px, Py and Pz) and BofS() evaluated each of them with its
+ *      own accelerator, i.e. four interval searches and four calls through
+ *      gsl's function pointers for every B(s). An Lgm_FLSpline keeps all
+ *      four curves over one copy of the abscissae, so a single lookup does
+ *      for all of them, and the evaluation is inlined (see Lgm_FLSpline.h).
+ *      The lines from Lgm_TraceLine() and friends are resampled on an even
+ *      ds, and for those the interval comes straight from (s-s0)/ds.
+ *
+ *      The linear and Akima interpolants use the same arithmetic as gsl's
+ *      gsl_interp_linear and gsl_interp_akima, so the results are the same.
+ *      Akima needs at least 5 points; with fewer, linear is used.
+ *
+ *      The arrays are kept between calls and only grown, so re-using an
+ *      Lgm_FLSpline for many lines does not allocate.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_FLSpline.h"
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+
+
+/*
+ *  Start out empty.
+ */
+void Lgm_FLSpline_Init( Lgm_FLSpline *f ) {
+    memset( f, 0, sizeof(*f) );
+}
+
+void Lgm_FLSpline_Free( Lgm_FLSpline *f ) {
+    free( f->Work );
+    Lgm_FLSpline_Init( f );
+}
+
+
+
+/*
+ *  Make room for n points of the given type, and point the arrays into the
+ *  work block.
+ */
+static int Reserve( Lgm_FLSpline *f, int Type, int n ) {
+
+    int     k, nArrays;
+    size_t  nWork;
+    double  *w;
+
+    nArrays = ( Type == LGM_FLSPLINE_AKIMA ) ? 1+4*LGM_FLSPLINE_NY : 1+LGM_FLSPLINE_NY;
+    if ( n > f->nAlloc ) f->nAlloc = n;
+    nWork = (size_t)nArrays*f->nAlloc;
+
+    if ( nWork > f->nWork ) {
+        free( f->Work );
+        if ( (f->Work = (double *)malloc( nWork*sizeof(double) )) == NULL ) {
+            printf("Lgm_FLSpline: Could not allocate memory for %d points.\n", n );
+            Lgm_FLSpline_Init( f );
+            return( FALSE );
+        }
+        f->nWork = nWork;
+    }
+
+    w = f->Work;
+    f->x = w; w += f->nAlloc;
+    for ( k=0; k<LGM_FLSPLINE_NY; k++ ) { f->y[k] = w; w += f->nAlloc; }
+    for ( k=0; k<LGM_FLSPLINE_NY; k++ ) {
+        if ( Type == LGM_FLSPLINE_AKIMA ) {
+            f->b[k] = w; w += f->nAlloc;
+            f->c[k] = w; w += f->nAlloc;
+            f->d[k] = w; w += f->nAlloc;
+        } else {
+            f->b[k] = f->c[k] = f->d[k] = NULL;
+        }
+    }
+    f->Type = Type;
+    f->n    = n;
+
+    return( TRUE );
+
+}
+
+
+
+/*
+ *  Akima coefficients of one curve. This is gsl's akima_init()/akima_calc()
+ *  (non-periodic end conditions), with m[] offset by 2 so that m[-2] and
+ *  m[-1] can be addressed.
+ */
+static void Akima( int n, const double *x, const double *y, double *b, double *c, double *d, double *m ) {
+
+    int     i;
+    double  NE, NE_next, h, alpha, alpha_next, tL_next;
+
+    for ( i=0; i<=n-2; i++ ) m[i] = (y[i+1] - y[i])/(x[i+1] - x[i]);
+
+    m[-2]  = 3.0*m[0] - 2.0*m[1];
+    m[-1]  = 2.0*m[0] - m[1];
+    m[n-1] = 2.0*m[n-2] - m[n-3];
+    m[n]   = 3.0*m[n-2] - 2.0*m[n-3];
+
+    for ( i=0; i<n-1; i++ ) {
+        NE = fabs( m[i+1] - m[i] ) + fabs( m[i-1] - m[i-2] );
+        if ( NE == 0.0 ) {
+            b[i] = m[i];
+            c[i] = 0.0;
+            d[i] = 0.0;
+        } else {
+            h       = x[i+1] - x[i];
+            NE_next = fabs( m[i+2] - m[i+1] ) + fabs( m[i] - m[i-1] );
+            alpha   = fabs( m[i-1] - m[i-2] )/NE;
+            if ( NE_next == 0.0 ) {
+                tL_next = m[i];
+            } else {
+                alpha_next = fabs( m[i] - m[i-1] )/NE_next;
+                tL_next    = (1.0 - alpha_next)*m[i] + alpha_next*m[i+1];
+            }
+            b[i] = (1.0 - alpha)*m[i-1] + alpha*m[i];
+            c[i] = (3.0*m[i] - 2.0*b[i] - tL_next)/h;
+            d[i] = (b[i] + tL_next - 2.0*m[i])/(h*h);
+        }
+    }
+
+}
+
+
+
+/*
+ *  Set up the interpolants of the LGM_FLSPLINE_NY curves y[k][0..n-1] over
+ *  x[0..n-1] (which must be increasing). x and y are copied.
+ *
+ *      \param[in,out]  f       The Lgm_FLSpline.
+ *      \param[in]      Type    LGM_FLSPLINE_LINEAR or LGM_FLSPLINE_AKIMA.
+ *      \param[in]      n       Number of points (at least 2).
+ *      \param[in]      x       The abscissae.
+ *      \param[in]      y       The LGM_FLSPLINE_NY ordinate arrays.
+ *
+ *      \return         TRUE, or FALSE if there are too few points or no memory.
+ */
+int Lgm_FLSpline_Set( Lgm_FLSpline *f, int Type, int n, const double *x, const double **y ) {
+
+    int     i, k;
+    double  dx, *m;
+
+    if ( n < 2 ) return( FALSE );
+    if ( n < 5 ) Type = LGM_FLSPLINE_LINEAR;
+
+    if ( !Reserve( f, Type, n ) ) return( FALSE );
+
+    memcpy( f->x, x, n*sizeof(double) );
+    for ( k=0; k<LGM_FLSPLINE_NY; k++ ) memcpy( f->y[k], y[k], n*sizeof(double) );
+
+    if ( Type == LGM_FLSPLINE_AKIMA ) {
+        m = (double *)malloc( (n+3)*sizeof(double) );
+        if ( m == NULL ) {
+            printf("Lgm_FLSpline_Set: Could not allocate memory for %d points.\n", n );
+            return( FALSE );
+        }
+        for ( k=0; k<LGM_FLSPLINE_NY; k++ ) Akima( n, f->x, f->y[k], f->b[k], f->c[k], f->d[k], m+2 );
+        free( m );
+    }
+
+    /*
+     *  Evenly spaced? The last interval is allowed to be shorter (the lines
+     *  usually end at a footpoint).
+     */
+    dx = x[1] - x[0];
+    f->Uniform = ( dx > 0.0 );
+    for ( i=1; f->Uniform && (i<n-2); i++ ) {
+        if ( fabs( (x[i+1] - x[i]) - dx ) > 1e-6*dx ) f->Uniform = FALSE;
+    }
+    f->x0    = x[0];
+    f->InvDx = ( dx > 0.0 ) ? 1.0/dx : 0.0;
+    f->Last  = 0;
+
+    return( TRUE );
+
+}
+
+
+
+/*
+ *  Make t an independent copy of s (t's arrays are re-used if they are big
+ *  enough).
+ */
+int Lgm_FLSpline_Copy( Lgm_FLSpline *t, const Lgm_FLSpline *s ) {
+
+    int     k, n = s->n;
+
+    if ( n < 1 ) {
+        t->n = 0;
+        return( TRUE );
+    }
+    if ( !Reserve( t, s->Type, n ) ) return( FALSE );
+
+    memcpy( t->x, s->x, n*sizeof(double) );
+    for ( k=0; k<LGM_FLSPLINE_NY; k++ ) {
+        memcpy( t->y[k], s->y[k], n*sizeof(double) );
+        if ( s->Type == LGM_FLSPLINE_AKIMA ) {
+            memcpy( t->b[k], s->b[k], n*sizeof(double) );
+            memcpy( t->c[k], s->c[k], n*sizeof(double) );
+            memcpy( t->d[k], s->d[k], n*sizeof(double) );
+        }
+    }
+    t->Uniform = s->Uniform;
+    t->x0      = s->x0;
+    t->InvDx   = s->InvDx;
+    t->Last    = s->Last;
+
+    return( TRUE );
+
+}
@@ -0,0 +1,394 @@
+/*! \file Lgm_FieldLineCache.c
+ *
+ *  \brief Cache of traced field lines that can be shared between drift shell searches.
+ *
+ *  Lgm_ComputeLstarVersusPA() runs a full drift shell search for each pitch
+ *  angle. With LstarInfo->ISearchMethod == 2, every trial line in
+ *  FindShellLine() is traced from the Earth at some (MLT, mlat), and the
+ *  MLTs used are the same for every pitch angle. The line traced from a given
+ *  footpoint does not depend on Bm -- only the mirror points and the I
+ *  integral do. So if the whole line (footpoint to footpoint) is stored, any
+ *  other pitch angle that asks about the same footpoint can get its mirror
+ *  points and I from the stored points without tracing again.
+ *
+ *  Entries are keyed on the footpoint quantized to c->Quantum degrees and on a
+ *  hash of the model state (Lgm_FieldLineCache_ModelHash()). The default
+ *  quantum is very small, so only footpoints that are (to round-off) the same
+ *  ever hit. Lgm_FieldLineCache_Bracket() is what makes that useful: it uses
+ *  the lines already in the cache at a given MLT to hand FindShellLine() a
+ *  bracket whose end points are cached lines.
+ *
+ *  Entries are only read or written inside the Lgm_FieldLineCache critical
+ *  section and hits are copied out, so one cache can be shared by all of the
+ *  threads in Lgm_ComputeLstarVersusPA().
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+
+#define LGM_FLCACHE_MIN_DIVS    20      // Min # of stored intervals between mirror points for the stored line to be used.
+#define LGM_FLCACHE_MAX_TRIES   16      // Max # of cached lines Lgm_FieldLineCache_Bracket() will evaluate.
+
+
+/*
+ *  Allocate an empty cache. Quantum is the cell size (degrees) used to
+ *  quantize footpoints (<= 0 gives 1e-8), and MaxEntries (<= 0 gives 4096)
+ *  caps the number of lines kept. Lines are stored with a spacing of c->ds
+ *  (0.05 Re by default; smaller values are more accurate but cost more per
+ *  trace).
+ */
+Lgm_FieldLineCache *Lgm_InitFieldLineCache( double Quantum, int MaxEntries ) {
+
+    Lgm_FieldLineCache *c;
+
+    c = (Lgm_FieldLineCache *) calloc( 1, sizeof( *c ) );
+    c->Quantum    = ( Quantum > 0.0 ) ? Quantum : 1e-8;
+    c->MaxEntries = ( MaxEntries > 0 ) ? MaxEntries : 4096;
+    c->ds         = 0.05;
+
+    return( c );
+
+}
+
+
+void Lgm_FreeFieldLineCache( Lgm_FieldLineCache *c ) {
+
+    int i;
+
+    if ( c == NULL ) return;
+
+    for ( i=0; i<c->nEntries; ++i ) free( c->Entries[i].s );
+    free( c->Entries );
+    free( c );
+
+}
+
+
+/*
+ *  Hash of everything in m that changes the shape of a traced field line:
+ *  the field model, its parameters, the time, the tolerances and the
+ *  footpoint height (see Lgm_ModelState.c).
+ */
+unsigned long Lgm_FieldLineCache_ModelHash( Lgm_MagModelInfo *m ) {
+
+    return( Lgm_ModelKey_Fold( Lgm_ModelState_Key( m->Bfield, LGM_MODELSTATE_ALL, m ) ) );
+
+}
+
+
+/*
+ *  Look up the line traced from (MLT, mlat). On a hit, TraceFlag, Pmin and
+ *  Bmin are set and (for closed lines) the stored points are copied into
+ *  m->s[], m->Px[], etc. Returns TRUE on a hit.
+ */
+int Lgm_FieldLineCache_Get( Lgm_FieldLineCache *c, double MLT, double mlat, int *TraceFlag, Lgm_Vector *Pmin, double *Bmin, Lgm_MagModelInfo *m ) {
+
+    Lgm_FieldLineCacheEntry *e;
+    unsigned long           Hash;
+    long int                iMLT, imlat;
+    int                     i, n, Found = FALSE;
+
+    Hash  = Lgm_FieldLineCache_ModelHash( m );
+    iMLT  = lround( 15.0*MLT/c->Quantum );
+    imlat = lround( mlat/c->Quantum );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_FieldLineCache)
+#endif
+    {
+        for ( i=0; i<c->nEntries; ++i ) {
+            e = &c->Entries[i];
+            if ( (e->imlat == imlat) && (e->iMLT == iMLT) && (e->ModelHash == Hash) ) {
+                n = ( LGM_RESERVE_FL_PNTS( m, e->nPnts ) ) ? e->nPnts : 0;
+                *TraceFlag = e->TraceFlag;
+                *Pmin      = e->Pmin;
+                *Bmin      = e->Bmin;
+                if ( n > 0 ) {
+                    memcpy( m->s,           e->s,           n*sizeof(double) );
+                    memcpy( m->Px,          e->Px,          n*sizeof(double) );
+                    memcpy( m->Py,          e->Py,          n*sizeof(double) );
+                    memcpy( m->Pz,          e->Pz,          n*sizeof(double) );
+                    memcpy( m->Bmag,        e->Bmag,        n*sizeof(double) );
+                    memcpy( m->BminusBcdip, e->BminusBcdip, n*sizeof(double) );
+                }
+                m->nPnts = n;
+                Found = TRUE;
+                break;
+            }
+        }
+        if ( Found ) ++c->nHits;
+        else         ++c->nMisses;
+    }
+
+    return( Found );
+
+}
+
+
+/*
+ *  Store the line traced from (MLT, mlat). For closed lines, the points
+ *  currently in m->s[], m->Px[], etc. (i.e. m->nPnts of them) are copied in;
+ *  these must run from the southern to the northern footpoint. Lines that
+ *  are not closed are stored with no points so that they are not re-traced
+ *  either.
+ */
+void Lgm_FieldLineCache_Add( Lgm_FieldLineCache *c, double MLT, double mlat, int TraceFlag, Lgm_Vector *Pmin, double Bmin, Lgm_MagModelInfo *m ) {
+
+    Lgm_FieldLineCacheEntry e;
+    int                     n;
+
+    n = ( TraceFlag == LGM_CLOSED ) ? m->nPnts : 0;
+
+    e.iMLT      = lround( 15.0*MLT/c->Quantum );
+    e.imlat     = lround( mlat/c->Quantum );
+    e.MLT       = MLT;
+    e.mlat      = mlat;
+    e.ModelHash = Lgm_FieldLineCache_ModelHash( m );
+    e.TraceFlag = TraceFlag;
+    e.Pmin      = *Pmin;
+    e.Bmin      = Bmin;
+    e.nPnts     = n;
+    e.s = e.Px = e.Py = e.Pz = e.Bmag = e.BminusBcdip = NULL;
+    if ( n > 0 ) {
+        // one block holds all six arrays
+        e.s           = (double *) malloc( 6*n*sizeof(double) );
+        e.Px          = e.s  + n;
+        e.Py          = e.Px + n;
+        e.Pz          = e.Py + n;
+        e.Bmag        = e.Pz + n;
+        e.BminusBcdip = e.Bmag + n;
+        memcpy( e.s,           m->s,           n*sizeof(double) );
+        memcpy( e.Px,          m->Px,          n*sizeof(double) );
+        memcpy( e.Py,          m->Py,          n*sizeof(double) );
+        memcpy( e.Pz,          m->Pz,          n*sizeof(double) );
+        memcpy( e.Bmag,        m->Bmag,        n*sizeof(double) );
+        memcpy( e.BminusBcdip, m->BminusBcdip, n*sizeof(double) );
+    }
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_FieldLineCache)
+#endif
+    {
+        if ( c->nEntries < c->MaxEntries ) {
+            if ( c->nEntries >= c->nAlloced ) {
+                c->nAlloced = ( c->nAlloced > 0 ) ? 2*c->nAlloced : 64;
+                c->Entries  = (Lgm_FieldLineCacheEntry *) realloc( c->Entries, c->nAlloced*sizeof(Lgm_FieldLineCacheEntry) );
+            }
+            c->Entries[ c->nEntries++ ] = e;
+            e.s = NULL;
+        }
+    }
+
+    free( e.s );    // non-NULL only if the cache was full
+
+}
+
+
+/*
+ *  Find s in [a,b] where B(s) = Bm on the splined line (B(a)-Bm and B(b)-Bm
+ *  must have opposite signs).
+ */
+static double Lgm_FieldLineCache_MirrorS( double a, double b, double Bm, double tol, Lgm_MagModelInfo *m ) {
+
+    double  c, Fa, Fc;
+
+    Fa = BofS( a, m ) - Bm;
+    while ( fabs(b-a) > tol ) {
+        c  = 0.5*(a+b);
+        Fc = BofS( c, m ) - Bm;
+        if ( Fc*Fa > 0.0 ) { a = c; Fa = Fc; }
+        else               { b = c; }
+    }
+
+    return( 0.5*(a+b) );
+
+}
+
+/*
+ *  Compute I for mirror field Bm using the footpoint-to-footpoint line that
+ *  is loaded in m->s[], m->Bmag[], etc. The mirror points are found on the
+ *  interpolated line (no tracing), and m->Pm_South, m->Pm_North, m->Sm_South
+ *  and m->Sm_North are set as they would be by ComputeI_FromMltMlat2().
+ *
+ *  Returns 1 if I was computed, 0 if the mirror points are too close
+ *  together to be resolved by the stored points (the caller should trace
+ *  instead), and -1 if B does not reach Bm before the footpoints.
+ */
+int Lgm_FieldLineCache_Iinv( double Bm, double *I, Lgm_MagModelInfo *m ) {
+
+    int     i, imin, iS, iN;
+    double  Sa, Sb;
+
+    if ( m->nPnts < 3 ) return( 0 );
+
+    for ( imin=0, i=1; i<m->nPnts; ++i ) if ( m->Bmag[i] < m->Bmag[imin] ) imin = i;
+    if ( m->Bmag[imin] >= Bm ) return( 0 );
+
+    for ( iS=imin-1; (iS >= 0) && (m->Bmag[iS] < Bm); --iS );
+    for ( iN=imin+1; (iN < m->nPnts) && (m->Bmag[iN] < Bm); ++iN );
+    if ( (iS < 0) || (iN >= m->nPnts) ) return( -1 );
+    if ( iN-iS < LGM_FLCACHE_MIN_DIVS ) return( 0 );
+
+    if ( !InitSpline( m ) ) return( 0 );
+
+    Sa = Lgm_FieldLineCache_MirrorS( m->s[iS], m->s[iS+1], Bm, m->Lgm_TraceToMirrorPoint_Tol, m );
+    Sb = Lgm_FieldLineCache_MirrorS( m->s[iN], m->s[iN-1], Bm, m->Lgm_TraceToMirrorPoint_Tol, m );
+
+    m->Sm_South = Sa;
+    m->Sm_North = Sb;
+    m->Pm_South.x = Lgm_FLSpline_Eval( &m->FLSpline, 1, Sa );
+    m->Pm_South.y = Lgm_FLSpline_Eval( &m->FLSpline, 2, Sa );
+    m->Pm_South.z = Lgm_FLSpline_Eval( &m->FLSpline, 3, Sa );
+    m->Pm_North.x = Lgm_FLSpline_Eval( &m->FLSpline, 1, Sb );
+    m->Pm_North.y = Lgm_FLSpline_Eval( &m->FLSpline, 2, Sb );
+    m->Pm_North.z = Lgm_FLSpline_Eval( &m->FLSpline, 3, Sb );
+
+    *I = Iinv_interped( m );
+    FreeSpline( m );
+
+    return( 1 );
+
+}
+
+
+/*
+ *  Evaluate D = I-I0 for the cached line at (MLT, mlat) without tracing.
+ *  Returns 1 if D was computed. Returns 0 if the line is too short to reach
+ *  Bm (or its mirror points are too close together to resolve); I is then
+ *  essentially zero and D is set to -I0, which is only good for its sign.
+ *  Returns -1 if nothing useful can be said.
+ */
+static int Lgm_FieldLineCache_D( Lgm_FieldLineCache *c, double MLT, double mlat, double Bm, double I0, double *D, Lgm_LstarInfo *LstarInfo ) {
+
+    int         TraceFlag, Flag;
+    double      Bmin, I;
+    Lgm_Vector  Pmin;
+
+    if ( !Lgm_FieldLineCache_Get( c, MLT, mlat, &TraceFlag, &Pmin, &Bmin, LstarInfo->mInfo ) ) return( -1 );
+    if ( TraceFlag != LGM_CLOSED ) return( -1 );
+    if ( Bmin > Bm ) { *D = -I0; return( 0 ); }
+    if ( (Flag = Lgm_FieldLineCache_Iinv( Bm, &I, LstarInfo->mInfo )) < 0 ) return( -1 );
+    if ( Flag == 0 ) { *D = -I0; return( 0 ); }
+
+    *D = I - I0;
+    if ( LstarInfo->nImI0 < 3*LGM_LSTARINFO_MAX_FL ) {
+        LstarInfo->MLATarr[LstarInfo->nImI0]   = mlat;
+        LstarInfo->ImI0arr[LstarInfo->nImI0++] = *D;
+    }
+
+    return( 1 );
+
+}
+
+/*
+ *  Use the lines already cached at this MLT to bracket the mlat where I = I0.
+ *  Starting from the two cached lines either side of pred_mlat, we step
+ *  (with doubling strides) through the sorted lines towards the zero until
+ *  I-I0 changes sign, and then bisect down to two neighbouring lines. At most
+ *  LGM_FLCACHE_MAX_TRIES lines are looked at. On success mlat0 and mlat1 are
+ *  set to the footpoints of those two lines (so BracketZero() gets them from
+ *  the cache), mlat_try to the secant estimate between them, and TRUE is
+ *  returned. The I-I0 values found are also added to LstarInfo->MLATarr[]
+ *  and LstarInfo->ImI0arr[] for later fits.
+ */
+int Lgm_FieldLineCache_Bracket( Lgm_FieldLineCache *c, double MLT, double Bm, double I0, double pred_mlat, double *mlat0, double *mlat_try, double *mlat1, Lgm_LstarInfo *LstarInfo ) {
+
+    double          mlat[ 3*LGM_LSTARINFO_MAX_FL ], t, Dlo, Dhi, Dmid;
+    unsigned long   Hash;
+    long int        iMLT;
+    int             i, j, n, lo, hi, mid, step, nTries, Flo, Fhi, Fmid;
+
+    /*
+     *  Collect (and sort) the mlats of the closed lines at this MLT.
+     */
+    Hash = Lgm_FieldLineCache_ModelHash( LstarInfo->mInfo );
+    iMLT = lround( 15.0*MLT/c->Quantum );
+    n = 0;
+#if USE_OPENMP
+    #pragma omp critical (Lgm_FieldLineCache)
+#endif
+    {
+        for ( i=0; (i<c->nEntries) && (n < 3*LGM_LSTARINFO_MAX_FL); ++i ) {
+            if ( (c->Entries[i].iMLT == iMLT) && (c->Entries[i].ModelHash == Hash) && (c->Entries[i].TraceFlag == LGM_CLOSED) ) {
+                mlat[n++] = c->Entries[i].mlat;
+            }
+        }
+    }
+    if ( n < 2 ) return( FALSE );
+
+    for ( i=1; i<n; ++i ) {
+        t = mlat[i];
+        for ( j=i-1; (j >= 0) && (mlat[j] > t); --j ) mlat[j+1] = mlat[j];
+        mlat[j+1] = t;
+    }
+
+
+    /*
+     *  Start with the pair that straddles pred_mlat and step outwards.
+     */
+    for ( hi=0; (hi < n-1) && (mlat[hi] < pred_mlat); ++hi );
+    if ( hi == 0 ) hi = 1;
+    lo = hi-1;
+
+    if ( (Flo = Lgm_FieldLineCache_D( c, MLT, mlat[lo], Bm, I0, &Dlo, LstarInfo )) < 0 ) return( FALSE );
+    if ( (Fhi = Lgm_FieldLineCache_D( c, MLT, mlat[hi], Bm, I0, &Dhi, LstarInfo )) < 0 ) return( FALSE );
+    nTries = 2;
+
+    step = 1;
+    while ( Dlo*Dhi > 0.0 ) {
+
+        if ( nTries >= LGM_FLCACHE_MAX_TRIES ) return( FALSE );
+
+        if ( Dlo > 0.0 ) {
+            // I increases with mlat, so the zero is below mlat[lo]
+            if ( lo == 0 ) return( FALSE );
+            hi = lo; Dhi = Dlo; Fhi = Flo;
+            lo = ( lo-step > 0 ) ? lo-step : 0;
+            if ( (Flo = Lgm_FieldLineCache_D( c, MLT, mlat[lo], Bm, I0, &Dlo, LstarInfo )) < 0 ) return( FALSE );
+        } else {
+            // zero is above mlat[hi]
+            if ( hi == n-1 ) return( FALSE );
+            lo = hi; Dlo = Dhi; Flo = Fhi;
+            hi = ( hi+step < n-1 ) ? hi+step : n-1;
+            if ( (Fhi = Lgm_FieldLineCache_D( c, MLT, mlat[hi], Bm, I0, &Dhi, LstarInfo )) < 0 ) return( FALSE );
+        }
+        ++nTries;
+        step *= 2;
+
+    }
+
+
+    /*
+     *  Bisect down to neighbouring lines.
+     */
+    while ( hi-lo > 1 ) {
+
+        if ( nTries >= LGM_FLCACHE_MAX_TRIES ) return( FALSE );
+
+        mid = (lo+hi)/2;
+        if ( (Fmid = Lgm_FieldLineCache_D( c, MLT, mlat[mid], Bm, I0, &Dmid, LstarInfo )) < 0 ) return( FALSE );
+        if ( Dmid*Dlo > 0.0 ) { lo = mid; Dlo = Dmid; Flo = Fmid; }
+        else                  { hi = mid; Dhi = Dmid; Fhi = Fmid; }
+        ++nTries;
+
+    }
+
+    // the end points need real values of I, or BracketZero() will end up tracing them.
+    if ( (Flo != 1) || (Fhi != 1) ) return( FALSE );
+
+    *mlat0    = mlat[lo];
+    *mlat1    = mlat[hi];
+    *mlat_try = ( Dhi != Dlo ) ? mlat[lo] - Dlo*(mlat[hi]-mlat[lo])/(Dhi-Dlo) : 0.5*(mlat[lo]+mlat[hi]);
+
+    if (LstarInfo->VerbosityLevel > 1) {
+        printf("\t\t%sLgm_FieldLineCache_Bracket: cached lines at MLT = %g give bracket [%g, %g] (D = %g, %g), mlat_try = %g%s\n", LstarInfo->PreStr, MLT, *mlat0, *mlat1, Dlo, Dhi, *mlat_try, LstarInfo->PostStr );
+    }
+
+    return( TRUE );
+
+}
@@ -0,0 +1,271 @@
+/*! \file Lgm_FluxMap.c
+ *
+ *  \brief Per-epoch map of the magnetic flux poleward of each point on the Earth.
+ *
+ *  L* comes from the magnetic flux through the polar cap bounded by the
+ *  footpoints of the drift shell (MagFlux2()). That flux is an integral over
+ *  MLT of LambdaIntegral(), which is itself an integral of Br cos(mlat) from
+ *  the footpoint mlat up to the pole. So every Lstar() call does a nested
+ *  integral (and every evaluation of the inner integrand is a field
+ *  evaluation) even though, at one epoch, the field on the Earth is the
+ *  same for every pitch angle and every position.
+ *
+ *  An Lgm_FluxMap holds that inner integral,
+ *
+ *                          pi/2
+ *      F( MLT, mlat ) =  int     Br( MLT, lambda ) cos( lambda ) d lambda,
+ *                          mlat
+ *
+ *  on an (MLT, mlat) grid for one model state, along with its derivative in
+ *  mlat (which is just -Br cos( mlat )). Between the nodes it is a cubic
+ *  Hermite spline in mlat and a 4-point (periodic) cubic in MLT. Once a map
+ *  has been computed, MagFlux2() is a 1D quadrature over MLT of map lookups.
+ *
+ *  Both interpolants are fourth order, so on the default grid (96 MLTs by
+ *  0.5 degrees of mlat) the interpolation error is far below the default
+ *  LambdaIntegral tolerance (1e-3). Use a finer MLT grid if the higher
+ *  order terms of the internal field matter at the level wanted.
+ *
+ *  A map is only used when Lgm_FluxMap_Matches() says it was computed for
+ *  the model state in use (otherwise MagFlux2() does the nested integral as
+ *  before), and it is never changed by MagFlux2(), so any number of threads
+ *  can use it. Attach it to the Lgm_LstarInfo structure (copies share it):
+ *
+ *      LstarInfo->FluxMap = Lgm_InitFluxMap( -1, -1, -1.0 );
+ *      for ( each epoch ) {
+ *          ...  Lgm_Set_Coord_Transforms( Date, UTC, LstarInfo->mInfo->c ); etc.
+ *          Lgm_FluxMap_Compute( LstarInfo->FluxMap, LstarInfo->mInfo );
+ *          ...  Lstar( ... ) for all of the positions and pitch angles
+ *      }
+ *      Lgm_FreeFluxMap( LstarInfo->FluxMap );
+ *
+ *  Lgm_ComputeLstarVersusPA() recomputes the map of its LstarInfo itself
+ *  when the epoch changes. A map must not be recomputed while other threads
+ *  are using it, so threads working on different epochs at the same time
+ *  need maps of their own.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+#include "Lgm/Lgm_Tasks.h"
+
+#define LGM_FLUXMAP_NGAUSS  5       // Gauss-Legendre points per mlat interval
+
+static const double Lgm_FluxMap_x[LGM_FLUXMAP_NGAUSS] = { -0.906179845938664, -0.538469310105683, 0.0, 0.538469310105683, 0.906179845938664 };
+static const double Lgm_FluxMap_w[LGM_FLUXMAP_NGAUSS] = {  0.236926885056189,  0.478628670499366, 0.568888888888889, 0.478628670499366, 0.236926885056189 };
+
+
+/*
+ *  Allocate a map with nMLT MLTs (evenly spaced from 0h) and nMlat mlats
+ *  (evenly spaced from MlatMin to 90 degrees). Values <= 0 give the
+ *  defaults (96, 181 and 0.0). It has to be computed (Lgm_FluxMap_Compute())
+ *  before it is used.
+ */
+Lgm_FluxMap *Lgm_InitFluxMap( int nMLT, int nMlat, double MlatMin ) {
+
+    Lgm_FluxMap *f;
+
+    f = (Lgm_FluxMap *) calloc( 1, sizeof( *f ) );
+    f->nMLT    = ( nMLT  > 3 ) ? nMLT  : 96;
+    f->nMlat   = ( nMlat > 1 ) ? nMlat : 181;
+    f->MlatMin = ( ( MlatMin > 0.0 ) && ( MlatMin < 90.0 ) ) ? MlatMin : 0.0;
+    f->dMlat   = ( 90.0 - f->MlatMin )/(double)( f->nMlat-1 );
+    f->F       = (double *) calloc( f->nMLT*f->nMlat, sizeof(double) );
+    f->D       = (double *) calloc( f->nMLT*f->nMlat, sizeof(double) );
+    f->Computed = FALSE;
+
+    return( f );
+
+}
+
+
+void Lgm_FreeFluxMap( Lgm_FluxMap *f ) {
+
+    if ( f == NULL ) return;
+    free( f->F );
+    free( f->D );
+    free( f );
+
+}
+
+
+/*
+ *  Br cos( mlat ) on the Earth (r = 1) at the SM longitude phi (radians).
+ */
+static double Lgm_FluxMap_Integrand( double phi, double Lambda, Lgm_MagModelInfo *m ) {
+
+    double      cl;
+    Lgm_Vector  u, w, B;
+
+    cl = cos( Lambda );
+    u.x = cl*cos( phi ); u.y = cl*sin( phi ); u.z = sin( Lambda );
+    Lgm_Convert_Coords( &u, &w, SM_TO_GSM, m->c );
+    m->Bfield( &w, &B, m );
+
+    // w is the radial unit vector (in GSM), so Br is just w.B
+    return( Lgm_DotProduct( &w, &B )*cl );
+
+}
+
+
+typedef struct Lgm_FluxMap_Data {
+    Lgm_FluxMap         *f;
+    Lgm_MagModelInfo    *m;
+} Lgm_FluxMap_Data;
+
+/*
+ *  One MLT column of the map, integrated down from the pole.
+ */
+static void Lgm_FluxMap_ColumnTask( long int i, void *Data ) {
+
+    Lgm_FluxMap_Data    *d = (Lgm_FluxMap_Data *)Data;
+    Lgm_FluxMap         *f = d->f;
+    Lgm_MagModelInfo    *m;
+    double              phi, a, b, h, s;
+    double              *F = &f->F[i*f->nMlat], *D = &f->D[i*f->nMlat];
+    int                 j, k;
+
+    m   = Lgm_CloneMagInfo( d->m );
+    phi = 15.0*( 24.0*i/(double)f->nMLT - 12.0 )*RadPerDeg;
+    h   = f->dMlat*RadPerDeg;
+
+    F[f->nMlat-1] = 0.0;
+    D[f->nMlat-1] = 0.0;    // cos( 90 ) = 0
+    for ( j=f->nMlat-2; j>=0; j-- ) {
+        a = ( f->MlatMin + j*f->dMlat )*RadPerDeg;
+        b = a + h;
+        for ( s=0.0, k=0; k<LGM_FLUXMAP_NGAUSS; k++ ) {
+            s += Lgm_FluxMap_w[k]*Lgm_FluxMap_Integrand( phi, 0.5*(a+b) + 0.5*h*Lgm_FluxMap_x[k], m );
+        }
+        F[j] = F[j+1] + 0.5*h*s;
+        D[j] = -Lgm_FluxMap_Integrand( phi, a, m );
+    }
+
+    Lgm_FreeMagInfo( m );
+
+}
+
+
+/**
+ *  \brief
+ *      Compute a flux map for the model state in m.
+ *
+ *  \details
+ *      Integrates Br cos( mlat ) down each MLT column of the map (in
+ *      parallel over the columns), using m->Bfield at the epoch that m->c is
+ *      set up for. The model state is saved for Lgm_FluxMap_Matches(). Does
+ *      nothing if the map is already for this state. Costs about
+ *      6*nMLT*nMlat field evaluations.
+ *
+ *      \param[in,out]  f   Map from Lgm_InitFluxMap().
+ *      \param[in]      m   Model to use.
+ *
+ */
+void Lgm_FluxMap_Compute( Lgm_FluxMap *f, Lgm_MagModelInfo *m ) {
+
+    Lgm_FluxMap_Data    d;
+
+    if ( ( f == NULL ) || ( m == NULL ) || Lgm_FluxMap_Matches( f, m ) ) return;
+
+    f->Computed = FALSE;
+    d.f = f;
+    d.m = m;
+    Lgm_ParallelFor( f->nMLT, Lgm_FluxMap_ColumnTask, (void *)&d );
+
+    f->JD            = m->c->UTC.JD;
+    f->InternalModel = m->InternalModel;
+    f->ExternalModel = m->ExternalModel;
+    f->Kp            = m->Kp;
+    f->fKp           = m->fKp;
+    f->Dst           = m->Dst;
+    f->P             = m->P;
+    f->By            = m->By;
+    f->Bz            = m->Bz;
+    memcpy( f->W, m->W, sizeof( f->W ) );
+    f->Computed      = TRUE;
+
+}
+
+
+/*
+ *  Was the map computed for the model state in m? (Same checks as
+ *  Lgm_LstarTable_Matches(), less the loss cone height, which the map
+ *  doesnt depend on.)
+ */
+int Lgm_FluxMap_Matches( Lgm_FluxMap *f, Lgm_MagModelInfo *m ) {
+
+    if ( ( f == NULL ) || ( m == NULL ) || !f->Computed ) return( FALSE );
+
+    if ( fabs( f->JD - m->c->UTC.JD ) > 1e-8 ) return( FALSE );
+    if ( ( f->InternalModel != m->InternalModel ) || ( f->ExternalModel != m->ExternalModel ) ) return( FALSE );
+    if ( ( f->Kp != m->Kp ) || ( f->fKp != m->fKp ) || ( f->Dst != m->Dst ) || ( f->P != m->P ) ) return( FALSE );
+    if ( ( f->By != m->By ) || ( f->Bz != m->Bz ) || memcmp( f->W, m->W, sizeof( f->W ) ) ) return( FALSE );
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Flux poleward of (MLT, mlat) at column i (Hermite cubic in mlat).
+ */
+static double Lgm_FluxMap_Column( Lgm_FluxMap *f, int i, int j, double s ) {
+
+    double  *F = &f->F[i*f->nMlat], *D = &f->D[i*f->nMlat];
+    double  h = f->dMlat*RadPerDeg, s2 = s*s, s3 = s2*s;
+
+    return( (2.0*s3 - 3.0*s2 + 1.0)*F[j] + (s3 - 2.0*s2 + s)*h*D[j] + (3.0*s2 - 2.0*s3)*F[j+1] + (s3 - s2)*h*D[j+1] );
+
+}
+
+
+/**
+ *  \brief
+ *      Look up the flux poleward of (MLT, mlat).
+ *
+ *  \details
+ *      Gives the same thing as LambdaIntegral() (the integral of
+ *      Br cos( mlat ) from mlat to the pole, in nT, with r = 1) from the
+ *      map. Read-only.
+ *
+ *      \param[in]  f       Computed map.
+ *      \param[in]  MLT     Magnetic local time (hours).
+ *      \param[in]  mlat    Magnetic (SM) latitude (degrees).
+ *      \param[out] F       The flux.
+ *
+ *      \return TRUE, or FALSE if mlat is outside of the map (or it hasnt been computed).
+ *
+ */
+int Lgm_FluxMap_Eval( Lgm_FluxMap *f, double MLT, double mlat, double *F ) {
+
+    int     i, j, k;
+    double  x, t, s, w[4];
+
+    if ( ( f == NULL ) || !f->Computed || ( mlat < f->MlatMin ) || ( mlat > 90.0 ) ) return( FALSE );
+
+    x = MLT/24.0*f->nMLT;
+    i = (int)floor( x );
+    t = x - i;
+    i = ( (i % f->nMLT) + f->nMLT ) % f->nMLT;
+
+    s = ( mlat - f->MlatMin )/f->dMlat;
+    j = (int)s;
+    if ( j > f->nMlat-2 ) j = f->nMlat-2;
+    s -= j;
+
+    // 4-point Lagrange cubic in MLT through columns i-1, i, i+1 and i+2
+    w[0] = -t*(t-1.0)*(t-2.0)/6.0;
+    w[1] = (t+1.0)*(t-1.0)*(t-2.0)/2.0;
+    w[2] = -(t+1.0)*t*(t-2.0)/2.0;
+    w[3] = (t+1.0)*t*(t-1.0)/6.0;
+    for ( *F=0.0, k=0; k<4; k++ ) {
+        *F += w[k]*Lgm_FluxMap_Column( f, ( i+k-1+f->nMLT ) % f->nMLT, j, s );
+    }
+
+    return( TRUE );
+
+}
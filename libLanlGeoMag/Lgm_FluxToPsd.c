@@ -10,6 +10,7 @@
 #include <omp.h>
 #endif
 #include "Lgm/Lgm_FluxToPsd.h"
+#include "Lgm/Lgm_Tasks.h"
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_DynamicMemory.h"
@@ -33,6 +34,11 @@ typedef struct _FitData {
 
 } _FitData;
 
+static void   FreeFits( int *nFit, double ***FitParams, double **FitKey, int **FitState );
+static void   AgeFits( int nFit, int *FitState );
+static void   SizeFits( int nBins, int nMaxwellians, int *nFit, int *FitnMaxwellians, double ***FitParams, double **FitKey, int **FitState );
+static double P2F_GetPsdAtMuAndK( int iA, double Mu, double K, double A, Lgm_PsdToFlux *p );
+
 
 
 // Routines for converting between Flux and Phase Space Density
@@ -386,6 +392,8 @@ void Lgm_F2P_FreeFluxToPsd( Lgm_FluxToPsd *f ) {
         LGM_ARRAY_2D_FREE( f->PSD_MK );
     }
 
+    FreeFits( &(f->nFit), &(f->FitParams), &(f->FitKey), &(f->FitState) );
+
     free( f );
 
     return;
@@ -469,6 +477,11 @@ void Lgm_F2P_SetFlux( double **J, double *E, int nE, double *A, int nA, Lgm_Flux
         LGM_ARRAY_2D_FREE( f->PSD_EA );
     }
 
+    /*
+     * Any Maxwellian fits we have are now only good as starting guesses.
+     */
+    AgeFits( f->nFit, f->FitState );
+
 
     /*
      * Add Flux array to f structure. Alloc arrays appropriately.
@@ -537,6 +550,50 @@ void Lgm_F2P_SetFlux( double **J, double *E, int nE, double *A, int nA, Lgm_Flux
 
 
 
+/*
+ *  What each K task of Lgm_F2P_GetPsdAtConstMusAndKs() needs.
+ */
+typedef struct Lgm_F2P_AofK_Data {
+    double              *K;
+    Lgm_FluxToPsd       *f;
+    Lgm_MagModelInfo    *m;
+} Lgm_F2P_AofK_Data;
+
+/*
+ *  Local pitch angle at the S/C for K[k]. Uses the caller's mInfo if
+ *  Lgm_AlphaOfK() is just a table lookup, and a private copy otherwise.
+ */
+static void Lgm_F2P_AofK_Task( long int kk, void *Data ) {
+
+    Lgm_F2P_AofK_Data   *d = (Lgm_F2P_AofK_Data *)Data;
+    Lgm_FluxToPsd       *f = d->f;
+    Lgm_MagModelInfo    *mInfo = d->m, *mInfo2;
+    double              AlphaEq, SinA;
+    int                 k = (int)kk;
+
+    mInfo2 = ( mInfo->AlphaOfK_nTab > 0 ) ? mInfo : Lgm_CopyMagInfo( mInfo );  // make a private (per-task) copy of mInfo if we need one
+    if ( Lgm_GetDeterministic() ) Lgm_MagStep_ResetState( mInfo2 );            // every K starts from the same state
+
+    f->K[k]    = d->K[k];
+    AlphaEq    = Lgm_AlphaOfK( f->K[k], mInfo2 ); // Lgm_AlphaOfK() returns equatorial pitch angle.
+    SinA       = sqrt( mInfo2->Blocal/mInfo2->Bmin ) * sin( RadPerDeg*AlphaEq );
+    if ( AlphaEq > 0.0 ) {
+        if ( SinA <= 1.0 ) {
+            f->AofK[k] = DegPerRad*asin( SinA );
+        } else {
+            f->AofK[k] = LGM_FILL_VALUE;
+            printf("Particles with Eq. PA of %g mirror below us. (I.e. S/C does not see K's this low).\n", AlphaEq);
+        }
+    } else {
+        f->AofK[k] = LGM_FILL_VALUE;
+        printf("Particles mirror below LC height. (I.e. S/C does not see K's this high).\n");
+    }
+
+    if ( mInfo2 != mInfo ) Lgm_FreeMagInfo( mInfo2 ); // free mInfo2
+
+}
+
+
 /**
  *  \brief
  *      Computes Phase Space Density at user-supplied constant values of \f$\mu\f$
@@ -585,8 +642,7 @@ void Lgm_F2P_SetFlux( double **J, double *E, int nE, double *A, int nA, Lgm_Flux
 void Lgm_F2P_GetPsdAtConstMusAndKs( double *Mu, int nMu, double *K, int nK, Lgm_MagModelInfo *mInfo, Lgm_FluxToPsd *f ) {
 
     int                 k, m, DoIt;
-    double              AlphaEq, SinA;
-    Lgm_MagModelInfo    *mInfo2;
+    Lgm_F2P_AofK_Data   TaskData;
 
 
     /*
@@ -621,39 +677,21 @@ void Lgm_F2P_GetPsdAtConstMusAndKs( double *Mu, int nMu, double *K, int nK, Lgm_
 
         f->B = mInfo->Blocal;
 
-        { // start parallel
-
-#if USE_OPENMP
-            #pragma omp parallel private(mInfo2,AlphaEq,SinA)
-            #pragma omp for schedule(dynamic, 1)
-#endif
-            for ( k=0; k<nK; k++ ){
-
-                mInfo2 = Lgm_CopyMagInfo( mInfo );  // make a private (per-thread) copy of mInfo
-
-                f->K[k]    = K[k];
-                //printf("\n\nK[%d] = %g   f->DateTime.UTC = %g f->Position = %g %g %g\n", k, K[k], f->DateTime.Time, f->Position.x, f->Position.y, f->Position.z);
-                AlphaEq    = Lgm_AlphaOfK( f->K[k], mInfo2 ); // Lgm_AlphaOfK() returns equatorial pitch angle.
-                SinA       = sqrt( mInfo2->Blocal/mInfo2->Bmin ) * sin( RadPerDeg*AlphaEq );
-                if ( AlphaEq > 0.0 ) {
-                    if ( SinA <= 1.0 ) {
-                        f->AofK[k] = DegPerRad*asin( SinA );
-                    } else {
-                        f->AofK[k] = LGM_FILL_VALUE;
-                        printf("Particles with Eq. PA of %g mirror below us. (I.e. S/C does not see K's this low).\n", AlphaEq);
-                    }
-                } else {
-                    f->AofK[k] = LGM_FILL_VALUE;
-                    printf("Particles mirror below LC height. (I.e. S/C does not see K's this high).\n");
-                }
-                //printf("f->K[k] = %g   AlphaEq = %g SinA = %g f->AofK[k] = %g\n", f->K[k], AlphaEq, SinA, f->AofK[k]);
-
-                Lgm_FreeMagInfo( mInfo2 ); // free mInfo2
-
-
-            }
-
-        } // end parallel
+        /*
+         * If Lgm_Setup_AlphaOfK() tabulated K(alpha), each Lgm_AlphaOfK() is
+         * just a table lookup (plus maybe a spline integral), so do them
+         * here with mInfo. Otherwise each one is a search with many traces;
+         * do those as parallel tasks (see Lgm_Tasks.c) with a private copy of
+         * mInfo per K.
+         */
+        TaskData.K    = K;
+        TaskData.f    = f;
+        TaskData.m    = mInfo;
+        if ( mInfo->AlphaOfK_nTab > 0 ) {
+            Lgm_SerialExecutor( nK, Lgm_F2P_AofK_Task, (void *)&TaskData, NULL );
+        } else {
+            Lgm_ParallelFor( nK, Lgm_F2P_AofK_Task, (void *)&TaskData );
+        }
 
 
 
@@ -696,6 +734,9 @@ assumes electrons -- generalize this...
      * The result will be the same as PSD at the given Mu's and K's
      */
     LGM_ARRAY_2D( f->PSD_MK, f->nMu,  f->nK,  double );
+    if ( f->FitType == LGM_F2P_MAXWELLIAN ) {
+        SizeFits( nK, f->nMaxwellians, &(f->nFit), &(f->FitnMaxwellians), &(f->FitParams), &(f->FitKey), &(f->FitState) );
+    }
     for ( m=0; m<nMu; m++ ){
         for ( k=0; k<nK; k++ ){
             DoIt = FALSE;
@@ -755,11 +796,37 @@ double  Model( double *x, int n, double E ) {
 
 }
 
+/*
+ *  Model() at each of the nE energies in E[]. Each maxwellian's
+ *  normalization is done once for the whole array (see Lgm_MaxJut_Array()).
+ *  Gives the same values as calling Model() at each energy.
+ */
+void  Model_Array( double *x, int n, int nE, double *E, double *g ) {
+
+    int     i, j;
+    double  nn, TT, *f;
+
+    for ( j=0; j<nE; j++ ) g[j] = 0.0;
+    if ( n < 1 ) return;
+
+    LGM_ARRAY_1D( f, nE, double );
+    for ( i=0; i<n; i++){
+        nn = pow( 10.0,  x[2*i+1] );
+        TT = fabs( x[2*i+2] );
+        Lgm_MaxJut_Array( nn, TT, nE, E, LGM_Ee0, f );
+        for ( j=0; j<nE; j++ ) g[j] += f[j];
+    }
+    LGM_ARRAY_1D_FREE( f );
+
+    return;
+
+}
+
 double Cost( double *x, void *data ){
 
     _FitData    *FitData;
     int         i;
-    double      g_model, d, sum;
+    double      *g_model, d, sum;
 
     FitData = (_FitData *)data;
 
@@ -773,33 +840,459 @@ double Cost( double *x, void *data ){
     }
 */
 
+    if ( FitData->n < 1 ) return( 0.0 );
 
+    // Evaluate the model over all of the energies at once.
+    LGM_ARRAY_1D( g_model, FitData->n, double );
+    Model_Array( x, FitData->nMaxwellians, FitData->n, FitData->E, g_model );
 
+    for ( sum = 0.0, i=0; i<FitData->n; ++i ){
+        d = log10( FitData->g[i]) - log10( g_model[i] );
+        sum += d*d;
+    }
+    LGM_ARRAY_1D_FREE( g_model );
 
+    // An inf or nan anywhere in the sum leaves it inf or nan.
+    if ( isinf(sum) || isnan(sum) ) return( 9e99 );
 
-    for ( sum = 0.0, i=0; i<FitData->n; ++i ){
+    return( sum );
+
+}
 
-        g_model = Model( x, FitData->nMaxwellians, FitData->E[i] ) ;
-        d = log10( FitData->g[i]) - log10( g_model);
 
+
+/*
+ *  Levenberg-Marquardt fitter for the sum of Maxwell-Juttners in Model().
+ *
+ *  It minimizes the same thing Cost() does (the sum of the squared log10
+ *  residuals) but uses the closed-form derivatives of the model. For one
+ *  maxwellian,
+ *
+ *      ln f = ln n + c(T) - Theta*gamma,   Theta = 1000 E0/T,  gamma = (Ek+E0)/E0
+ *
+ *  with c = ln Theta - ln( 4pi E0^3 ) - ln K2( Theta ) (or its low temperature
+ *  form when Theta >= 100, as in Lgm_MaxJut()), and the K2 term only depends
+ *  on T. So each iteration needs one K1 and one K2 per maxwellian rather than
+ *  one K2 per maxwellian per energy.
+ *
+ *  The amplitudes are not linear in a log space objective, so they are not
+ *  eliminated exactly. Instead, for a given set of temperatures the amplitudes
+ *  come in closed form from the linearized (relative residual) problem, and
+ *  that is where the iterations start from. The parameter layout is the x[]
+ *  of Model(): x[2i+1] = log10( n_i ), x[2i+2] = T_i (keV), x[0] unused.
+ */
+#define LGM_F2P_LM_MAXITS   200
+#define LGM_F2P_LM_NSTARTS  4       // Sets of starting temperatures tried when fitting from scratch (see T0[] and r[] in FitMaxwellians()).
+#define LGM_F2P_REFIT_COST  1e-2    // Refit from scratch if a warm start does worse than this (mean squared log10 residual).
+
+
+/*
+ *  For each maxwellian, c (with n = 1) and dc/dTheta at the temperatures in x.
+ */
+static void MaxJutTerms( double *x, int nm, double *Theta, double *c, double *dc ) {
+
+    int     k;
+    double  E0, T, Th, K1, K2;
+
+    E0 = LGM_Ee0;
+    for ( k=0; k<nm; k++ ) {
+        T  = fabs( x[2*k+2] );
+        Th = 1000.0*E0/T;
+        Theta[k] = Th;
+        if ( Th < 100.0 ) {
+            K2 = gsl_sf_bessel_Kn( 2, Th );
+            K1 = gsl_sf_bessel_K1( Th );
+            c[k]  = log( Th/( 4.0*M_PI*E0*E0*E0*K2 ) );
+            dc[k] = 3.0/Th + K1/K2;     // uses K2' = -K1 - 2K2/Theta
+        } else {
+            c[k]  = log( Th/( 4.0*M_PI*E0*E0*E0*sqrt( 0.5*M_PI/Th ) ) ) + Th;
+            dc[k] = 1.5/Th + 1.0;
+        }
+    }
+
+}
+
+
+/*
+ *  Log of the model at each energy, plus the share w[k*n+i] of maxwellian k
+ *  in the model at energy i. Returns the cost.
+ */
+static double MaxJutLogModel( double *x, int nm, int n, double *lng, double *gam, double *Theta, double *c, double *lnm, double *w ) {
+
+    int     i, k;
+    double  s, mx, d, sum;
+
+    for ( sum=0.0, i=0; i<n; i++ ) {
+        for ( mx=-1e300, k=0; k<nm; k++ ) {
+            w[k*n+i] = M_LN10*x[2*k+1] + c[k] - Theta[k]*gam[i];
+            if ( w[k*n+i] > mx ) mx = w[k*n+i];
+        }
+        for ( s=0.0, k=0; k<nm; k++ ) {
+            w[k*n+i] = exp( w[k*n+i] - mx );
+            s += w[k*n+i];
+        }
+        for ( k=0; k<nm; k++ ) w[k*n+i] /= s;
+        lnm[i] = mx + log( s );
+        d = (lng[i] - lnm[i])/M_LN10;
         sum += d*d;
-        //sum += fabs(d);
-        ///d = (d >= 0.0) ? d : -d;
-        ///sum += d;
-if (isinf(sum)) {
-//    printf("Cost, INF: g_model, g = %g %g %g     x[1], x[2] = %g %g\n", g_model, FitData->g[i], log10( FitData->g[i] ), x[1], x[2]);
-    return( 9e99 );
+    }
+
+    return( sum );
+
 }
-if (isnan(sum)) {
-//    printf("Cost, NaN: g_model, g = %g %g %g     x[1], x[2] = %g %g\n", g_model, FitData->g[i], log10( FitData->g[i] ), x[1], x[2]);
-//    printf("FitData->n = %d\n", FitData->n);
-    return( 9e99 );
+
+
+/*
+ *  Solve A y = b (A is np x np, symmetric positive definite) by Cholesky. A
+ *  is overwritten. Returns FALSE if A is not positive definite.
+ */
+static int MaxJutSolve( int np, double *A, double *b, double *y ) {
+
+    int     i, j, k;
+    double  s;
+
+    for ( j=0; j<np; j++ ) {
+        for ( s=A[j*np+j], k=0; k<j; k++ ) s -= A[j*np+k]*A[j*np+k];
+        if ( !(s > 0.0) ) return( FALSE );
+        A[j*np+j] = sqrt( s );
+        for ( i=j+1; i<np; i++ ) {
+            for ( s=A[i*np+j], k=0; k<j; k++ ) s -= A[i*np+k]*A[j*np+k];
+            A[i*np+j] = s/A[j*np+j];
+        }
+    }
+    for ( i=0; i<np; i++ ) {
+        for ( s=b[i], k=0; k<i; k++ ) s -= A[i*np+k]*y[k];
+        y[i] = s/A[i*np+i];
+    }
+    for ( i=np-1; i>=0; i-- ) {
+        for ( s=y[i], k=i+1; k<np; k++ ) s -= A[k*np+i]*y[k];
+        y[i] = s/A[i*np+i];
+    }
+
+    return( TRUE );
+
 }
 
+
+/*
+ *  Amplitudes for the temperatures in x. Minimizes sum_i ( (m_i - g_i)/g_i )^2
+ *  (which is the log objective to first order) in closed form. If that gives
+ *  a non-positive amplitude, each maxwellian gets the log space best fit
+ *  amplitude on its own, shared equally.
+ */
+static void MaxJutProject( double *x, int nm, int n, double *lng, double *gam, double *Theta, double *c, double *w ) {
+
+    int     i, k, l, ok;
+    double  A[LGM_F2P_MAX_MAXWELLIANS*LGM_F2P_MAX_MAXWELLIANS], b[LGM_F2P_MAX_MAXWELLIANS], y[LGM_F2P_MAX_MAXWELLIANS];
+    double  sk[LGM_F2P_MAX_MAXWELLIANS], mx, d;
+
+    // w[k*n+i] = phi_k(E_i)/g_i, scaled by exp(-sk[k]) so that its largest value is 1.
+    for ( k=0; k<nm; k++ ) {
+        for ( mx=-1e300, i=0; i<n; i++ ) {
+            w[k*n+i] = c[k] - Theta[k]*gam[i] - lng[i];
+            if ( w[k*n+i] > mx ) mx = w[k*n+i];
+        }
+        sk[k] = mx;
+        for ( i=0; i<n; i++ ) w[k*n+i] = exp( w[k*n+i] - mx );
     }
 
+    for ( k=0; k<nm; k++ ) {
+        for ( b[k]=0.0, i=0; i<n; i++ ) b[k] += w[k*n+i];
+        for ( l=0; l<nm; l++ ) {
+            for ( A[k*nm+l]=0.0, i=0; i<n; i++ ) A[k*nm+l] += w[k*n+i]*w[l*n+i];
+        }
+    }
 
-    return( sum );
+    ok = MaxJutSolve( nm, A, b, y );
+    for ( k=0; ok && k<nm; k++ ) if ( !(y[k] > 0.0) ) ok = FALSE;
+
+    for ( k=0; k<nm; k++ ) {
+        if ( ok ) {
+            x[2*k+1] = ( log( y[k] ) - sk[k] )/M_LN10;
+        } else {
+            for ( d=0.0, i=0; i<n; i++ ) d += lng[i] - c[k] + Theta[k]*gam[i];
+            x[2*k+1] = ( d/(double)n - log( (double)nm ) )/M_LN10;
+        }
+    }
+
+}
+
+
+/*
+ *  One Levenberg-Marquardt minimization starting at x. Returns the cost (or
+ *  a huge number if it broke down).
+ */
+static double MaxJutLM( double *x, int nm, int n, double *lng, double *gam, double *lnm, double *w ) {
+
+    int     i, j, k, it, np, Accepted;
+    double  Theta[LGM_F2P_MAX_MAXWELLIANS], c[LGM_F2P_MAX_MAXWELLIANS], dc[LGM_F2P_MAX_MAXWELLIANS];
+    double  J[2*LGM_F2P_MAX_MAXWELLIANS], JtJ[4*LGM_F2P_MAX_MAXWELLIANS*LGM_F2P_MAX_MAXWELLIANS];
+    double  A[4*LGM_F2P_MAX_MAXWELLIANS*LGM_F2P_MAX_MAXWELLIANS], Jtr[2*LGM_F2P_MAX_MAXWELLIANS], rhs[2*LGM_F2P_MAX_MAXWELLIANS], dx[2*LGM_F2P_MAX_MAXWELLIANS];
+    double  xt[2*LGM_F2P_MAX_MAXWELLIANS+1], r, T, Lambda, Cost0, Cost1, Dmax;
+
+    np = 2*nm;
+    for ( k=0; k<nm; k++ ) x[2*k+2] = fabs( x[2*k+2] );
+    MaxJutTerms( x, nm, Theta, c, dc );
+    Cost0 = MaxJutLogModel( x, nm, n, lng, gam, Theta, c, lnm, w );
+    if ( !isfinite( Cost0 ) ) return( 9e99 );
+
+    Lambda = 1e-3;
+    Accepted = TRUE;
+    for ( it=0; it<LGM_F2P_LM_MAXITS; it++ ) {
+
+        if ( Accepted ) {
+            /*
+             *  Normal equations. r_i = log10 g_i - log10 m_i, so
+             *      dr_i/dlog10(n_k) = -w_ki
+             *      dr_i/dT_k        = w_ki (Theta_k/T_k) (dc_k/dTheta - gamma_i)/ln(10)
+             */
+            for ( j=0; j<np*np; j++ ) JtJ[j] = 0.0;
+            for ( j=0; j<np; j++ ) Jtr[j] = 0.0;
+            for ( i=0; i<n; i++ ) {
+                r = (lng[i] - lnm[i])/M_LN10;
+                for ( k=0; k<nm; k++ ) {
+                    T = x[2*k+2];
+                    J[2*k]   = -w[k*n+i];
+                    J[2*k+1] = w[k*n+i]*Theta[k]/T*( dc[k] - gam[i] )/M_LN10;
+                }
+                for ( j=0; j<np; j++ ) {
+                    Jtr[j] += J[j]*r;
+                    for ( k=0; k<=j; k++ ) JtJ[j*np+k] += J[j]*J[k];
+                }
+            }
+            for ( Dmax=0.0, j=0; j<np; j++ ) {
+                for ( k=0; k<j; k++ ) JtJ[k*np+j] = JtJ[j*np+k];
+                if ( JtJ[j*np+j] > Dmax ) Dmax = JtJ[j*np+j];
+            }
+            if ( !(Dmax > 0.0) ) break;
+        }
+
+        for ( j=0; j<np*np; j++ ) A[j] = JtJ[j];
+        for ( j=0; j<np; j++ ) A[j*np+j] += Lambda*( (JtJ[j*np+j] > 1e-12*Dmax) ? JtJ[j*np+j] : 1e-12*Dmax );
+        for ( j=0; j<np; j++ ) rhs[j] = -Jtr[j];
+        i = MaxJutSolve( np, A, rhs, dx );
+
+        Accepted = FALSE;
+        if ( i ) {
+            xt[0] = x[0];
+            for ( j=0; j<np; j++ ) xt[j+1] = x[j+1] + dx[j];
+            for ( k=0; k<nm; k++ ) if ( !(xt[2*k+2] > 0.0) ) i = FALSE; // keep T > 0
+        }
+        if ( i ) {
+            MaxJutTerms( xt, nm, Theta, c, dc );
+            Cost1 = MaxJutLogModel( xt, nm, n, lng, gam, Theta, c, lnm, w );
+            if ( isfinite( Cost1 ) && ( Cost1 <= Cost0 ) ) {
+                for ( j=1; j<=np; j++ ) x[j] = xt[j];
+                Accepted = TRUE;
+                Lambda = ( Lambda > 1e-12 ) ? 0.1*Lambda : Lambda;
+                if ( Cost0 - Cost1 <= 1e-12*Cost0 + 1e-30 ) {
+                    Cost0 = Cost1;
+                    break;
+                }
+                Cost0 = Cost1;
+            }
+        }
+        if ( !Accepted ) {
+            Lambda *= 10.0;
+            if ( Lambda > 1e12 ) break;
+        }
+
+    }
+
+    /*
+     * Leave w and lnm consistent with x (a rejected step overwrote them).
+     */
+    if ( !Accepted ) {
+        MaxJutTerms( x, nm, Theta, c, dc );
+        Cost0 = MaxJutLogModel( x, nm, n, lng, gam, Theta, c, lnm, w );
+    }
+
+    return( Cost0 );
+
+}
+
+
+/*
+ *  Fit the maxwellians to FitData. If HaveGuess is true, x holds a starting
+ *  guess (e.g. the fit in the neighbouring bin, or in the same bin for the
+ *  previous data). Otherwise (or if the guess leads somewhere poor) fits
+ *  start from temperatures of T0, T0*r, T0*r^2, ... for a few (T0, r) and
+ *  the best one is kept (the first is 25 keV, 200 keV, ... which is where
+ *  praxis used to start). Falls back on praxis (which is what used to be
+ *  used) if the fitter breaks down. The result is left in x.
+ */
+static void FitMaxwellians( _FitData *FitData, double *x, int HaveGuess ) {
+
+    int     i, j, k, nm, n;
+    double  T0[] = { 25.0, 5.0, 50.0, 10.0 }, r[] = { 8.0, 10.0, 10.0, 100.0 };
+    double  *lng, *gam, *lnm, *w, Theta[LGM_F2P_MAX_MAXWELLIANS], c[LGM_F2P_MAX_MAXWELLIANS], dc[LGM_F2P_MAX_MAXWELLIANS];
+    double  x0[2*LGM_F2P_MAX_MAXWELLIANS+1], x1[2*LGM_F2P_MAX_MAXWELLIANS+1], Cost0, Cost1, Cost2;
+    double  in[10], out[7];
+
+    nm = FitData->nMaxwellians;
+    n  = FitData->n;
+
+    if ( nm <= LGM_F2P_MAX_MAXWELLIANS ) {
+
+        LGM_ARRAY_1D( lng, n, double );
+        LGM_ARRAY_1D( gam, n, double );
+        LGM_ARRAY_1D( lnm, n, double );
+        LGM_ARRAY_1D( w, nm*n, double );
+        for ( i=0; i<n; i++ ) {
+            lng[i] = log( FitData->g[i] );
+            gam[i] = 1.0 + FitData->E[i]/LGM_Ee0;
+        }
+
+        Cost0 = 9e99;
+        if ( HaveGuess ) {
+            /*
+             * Start from the guess, or from the guess's temperatures with
+             * amplitudes refit, whichever is better.
+             */
+            for ( i=0; i<=2*nm; i++ ) x0[i] = x1[i] = x[i];
+            for ( k=0; k<nm; k++ ) x0[2*k+2] = x1[2*k+2] = fabs( x[2*k+2] );
+            MaxJutTerms( x1, nm, Theta, c, dc );
+            MaxJutProject( x1, nm, n, lng, gam, Theta, c, w );
+            Cost1 = MaxJutLogModel( x1, nm, n, lng, gam, Theta, c, lnm, w );
+            MaxJutTerms( x0, nm, Theta, c, dc );
+            Cost2 = MaxJutLogModel( x0, nm, n, lng, gam, Theta, c, lnm, w );
+            if ( Cost1 < Cost2 ) for ( i=0; i<=2*nm; i++ ) x0[i] = x1[i];
+            Cost0 = MaxJutLM( x0, nm, n, lng, gam, lnm, w );
+        }
+
+        /*
+         * From scratch. There can be several local minima (e.g. with one
+         * maxwellian switched off), so try a few sets of temperatures and
+         * keep the best.
+         */
+        for ( j=0; ( j<LGM_F2P_LM_NSTARTS ) && !( HaveGuess && ( Cost0 <= LGM_F2P_REFIT_COST*n ) ); j++ ) {
+            x1[0] = 0.0;
+            for ( k=0; k<nm; k++ ) x1[2*k+2] = T0[j]*pow( r[j], (double)k );
+            MaxJutTerms( x1, nm, Theta, c, dc );
+            MaxJutProject( x1, nm, n, lng, gam, Theta, c, w );
+            Cost1 = MaxJutLM( x1, nm, n, lng, gam, lnm, w );
+            if ( Cost1 < Cost0 ) {
+                for ( i=0; i<=2*nm; i++ ) x0[i] = x1[i];
+                Cost0 = Cost1;
+            }
+        }
+
+        LGM_ARRAY_1D_FREE( lng );
+        LGM_ARRAY_1D_FREE( gam );
+        LGM_ARRAY_1D_FREE( lnm );
+        LGM_ARRAY_1D_FREE( w );
+
+        if ( Cost0 < 9e99 ) {
+            for ( i=0; i<=2*nm; i++ ) x[i] = x0[i];
+            return;
+        }
+
+    }
+
+    in[0] = 1e-8;
+    in[1] = in[2] = 1e-9; //Info->Praxis_Tolerance;
+    in[5] = 30000.0; //(double)Info->Praxis_Max_Function_Evals;
+    in[6] = 10.0; //Info->Praxis_Maximum_Step_Size;
+    in[7] = 10.0; //Info->Praxis_Bad_Scale_Paramater;
+    in[8] = 4.0; //(double)Info->Praxis_Max_Its_Without_Improvement;
+    in[9] = 1.0; //(double)Info->Praxis_Ill_Conditioned_Problem;
+    x[0] = 0.0;
+    for ( k=0; k<nm; k++ ) {
+        x[2*k+1] = -1.0 - (double)k;
+        x[2*k+2] = 25.0*pow( 8.0, (double)k );
+    }
+    praxis( 2*nm, x, (void *)FitData, Cost, in, out);
+
+    return;
+
+}
+
+
+/*
+ *  Bookkeeping for the per-bin fits kept in Lgm_FluxToPsd and Lgm_PsdToFlux.
+ *  SizeFits() makes room for nBins bins (keeping the old fits as guesses if
+ *  the size and nMaxwellians have not changed), AgeFits() turns the current
+ *  fits into guesses (i.e. when the data change) and FreeFits() frees them.
+ */
+static void FreeFits( int *nFit, double ***FitParams, double **FitKey, int **FitState ) {
+
+    double  **Params, *Key;
+    int     *State;
+
+    if ( *nFit > 0 ) {
+        Params = *FitParams; Key = *FitKey; State = *FitState;
+        LGM_ARRAY_2D_FREE( Params );
+        LGM_ARRAY_1D_FREE( Key );
+        LGM_ARRAY_1D_FREE( State );
+    }
+    *nFit = 0;
+
+}
+
+static void AgeFits( int nFit, int *FitState ) {
+
+    int k;
+
+    for ( k=0; k<nFit; k++ ) {
+        if ( FitState[k] == LGM_F2P_FIT_CURRENT ) FitState[k] = LGM_F2P_FIT_OLD;
+    }
+
+}
+
+static void SizeFits( int nBins, int nMaxwellians, int *nFit, int *FitnMaxwellians, double ***FitParams, double **FitKey, int **FitState ) {
+
+    double  **Params, *Key;
+    int     *State;
+
+    if ( ( *nFit == nBins ) && ( *FitnMaxwellians == nMaxwellians ) ) {
+        AgeFits( *nFit, *FitState );
+        return;
+    }
+
+    FreeFits( nFit, FitParams, FitKey, FitState );
+    if ( nBins > 0 ) {
+        LGM_ARRAY_2D( Params, nBins, 2*nMaxwellians+1, double );
+        LGM_ARRAY_1D( Key, nBins, double );
+        LGM_ARRAY_1D( State, nBins, int );  // calloc'd, so all LGM_F2P_FIT_NONE
+        *FitParams = Params; *FitKey = Key; *FitState = State;
+        *nFit = nBins;
+    }
+    *FitnMaxwellians = nMaxwellians;
+
+}
+
+
+/*
+ *  Maxwellian fit for bin k (k < 0 or k >= nFit for no bin). Reuses the
+ *  current fit in the bin if there is one for this Key, otherwise fits
+ *  starting from the old fit in the bin or the current one in bin k-1.
+ */
+static void FitMaxwelliansInBin( _FitData *FitData, double *x, int k, double Key, int nFit, double **FitParams, double *FitKey, int *FitState ) {
+
+    int i, nx, HaveGuess;
+
+    nx = 2*FitData->nMaxwellians+1;
+    HaveGuess = FALSE;
+    if ( ( k >= 0 ) && ( k < nFit ) ) {
+        if ( ( FitState[k] == LGM_F2P_FIT_CURRENT ) && ( FitKey[k] == Key ) ) {
+            for ( i=0; i<nx; i++ ) x[i] = FitParams[k][i];
+            return;
+        } else if ( FitState[k] != LGM_F2P_FIT_NONE ) {
+            for ( i=0; i<nx; i++ ) x[i] = FitParams[k][i];
+            HaveGuess = TRUE;
+        } else if ( ( k > 0 ) && ( FitState[k-1] == LGM_F2P_FIT_CURRENT ) ) {
+            for ( i=0; i<nx; i++ ) x[i] = FitParams[k-1][i];
+            HaveGuess = TRUE;
+        }
+    }
+
+    FitMaxwellians( FitData, x, HaveGuess );
+
+    if ( ( k >= 0 ) && ( k < nFit ) ) {
+        for ( i=0; i<nx; i++ ) FitParams[k][i] = x[i];
+        FitKey[k]   = Key;
+        FitState[k] = LGM_F2P_FIT_CURRENT;
+    }
 
 }
 
@@ -1017,56 +1510,16 @@ double  Lgm_F2P_GetPsdAtEandAlpha( int iMu, int iK, double E, double a, Lgm_Flux
             // interpolate/fit E
             // for now just do a linear interp.
             // no lets try a fit...
-            double  in[10], out[7], x[10];
-            in[0] = 1e-8;
-            in[1] = in[2] = 1e-9; //Info->Praxis_Tolerance;
-            in[5] = 30000.0; //(double)Info->Praxis_Max_Function_Evals;
-            in[6] = 10.0; //Info->Praxis_Maximum_Step_Size;
-            in[7] = 10.0; //Info->Praxis_Bad_Scale_Paramater;
-            in[8] = 4.0; //(double)Info->Praxis_Max_Its_Without_Improvement;
-            in[9] = 1.0; //(double)Info->Praxis_Ill_Conditioned_Problem;
-            x[0] = 0.0;
-            x[1] = -1.0;
-            x[2] = 25.0;
-            x[3] = -2.0;
-            x[4] = 200.0;
-            praxis( 2*FitData->nMaxwellians, x, (void *)FitData, Cost, in, out);
-            /*
-            printf("out[0] = %g\n", out[0]);
-            printf("out[1] = %g\n", out[1]);
-            printf("out[2] = %g\n", out[2]);
-            printf("out[3] = %g\n", out[3]);
-            printf("out[4] = %g\n", out[4]);
-            printf("out[5] = %g\n", out[5]);
-            printf("out[6] = %g\n", out[6]);
-            */
-            //printf("x[1] = %g   x[2] = %g   Cost = %g\n", x[1], x[2], out[6]);
- //           FILE *fp;
- //           printf("E = %g\n", E);
- //           fp = fopen("data.txt", "w");
- //           for (j=0; j<FitData->n; ++j){
- //               fprintf(fp, "%g %g\n", log10(f->E[j]), log10(FitData->g[j]));
- //           }
- //           fclose(fp);
-
- //           fp = fopen("fit.txt", "w");
- //           for (j=0; j<FitData->n; ++j){
- //               psd = Model( x,  FitData->nMaxwellians, f->E[j] );
- //               fprintf(fp, "%g %g\n", log10(f->E[j]), log10( psd ) );
- //           }
- //           fclose(fp);
-
-//            exit(0);
-            /*
-            */
+            // The fit only depends on a, so it is done once per K bin (see FitMaxwelliansInBin()).
+            double  *x;
+            LGM_ARRAY_1D( x, 2*FitData->nMaxwellians+1, double );
+            FitMaxwelliansInBin( FitData, x, iK, a, f->nFit, f->FitParams, f->FitKey, f->FitState );
 
-
-            //x[2] = 200.0;
-            //printf("x - %g %g %g %g\n", x[1], x[2], x[3], x[4]);
             psd = Model( x,  FitData->nMaxwellians, E );
             //psd = (double)a;
 
             //printf("E, a = %g %g  x = %g %g psd = %g\n", E, a, x[1], x[2], psd);
+            LGM_ARRAY_1D_FREE( x );
         } else {
 
             psd = LGM_FILL_VALUE;
@@ -1154,6 +1607,8 @@ void Lgm_P2F_FreePsdToFlux( Lgm_PsdToFlux *p ) {
         LGM_ARRAY_2D_FREE( p->FLUX_EA );
     }
 
+    FreeFits( &(p->nFit), &(p->FitParams), &(p->FitKey), &(p->FitState) );
+
     free( p );
 
     return;
@@ -1217,6 +1672,11 @@ void Lgm_P2F_SetPsd( double ***P, double *L, int nL, double *Mu, int nMu, double
         LGM_ARRAY_2D_FREE( p->PSD_MK );
     }
 
+    /*
+     * Any Maxwellian fits we have are now only good as starting guesses.
+     */
+    AgeFits( p->nFit, p->FitState );
+
 
     /*
      * Add Psd array to p structure. Alloc arrays appropriately.
@@ -1295,7 +1755,6 @@ void Lgm_P2F_GetFluxAtConstEsAndAs( double *E, int nE, double *A, int nA, double
 
     int                 k, m, DoIt, i, iL, iMu, iK, done;
     double              SinAlphaEq, AlphaEq, p2c2, Lstar;
-    Lgm_MagModelInfo    *mInfo2;
     Lgm_Vector          Bvec;
 
 
@@ -1339,16 +1798,15 @@ void Lgm_P2F_GetFluxAtConstEsAndAs( double *E, int nE, double *A, int nA, double
     mInfo->Blocal = Lgm_Magnitude( &Bvec );
     p->B = mInfo->Blocal;
     {   // start parallel
+        // (mInfo is only read in here, so the threads can share it.)
 #if USE_OPENMP
-        #pragma omp parallel private(mInfo2,SinAlphaEq,AlphaEq)
+        #pragma omp parallel private(SinAlphaEq,AlphaEq)
         #pragma omp for schedule(dynamic, 1)
 #endif
         for ( k=0; k<nA; k++ ){
 
-            mInfo2 = Lgm_CopyMagInfo( mInfo );  // make a private (per-thread) copy of mInfo
-
             p->A[k]    = A[k]; // A is local Pitch Angle
-            SinAlphaEq = sqrt( mInfo2->Bmin/mInfo2->Blocal ) * sin( RadPerDeg*p->A[k] );
+            SinAlphaEq = sqrt( mInfo->Bmin/mInfo->Blocal ) * sin( RadPerDeg*p->A[k] );
             AlphaEq    = DegPerRad*asin( SinAlphaEq );
 
 // REALLY SHOULD ASSUME WE HAVE THESE ALREADY. I.E. from MahEphemInfo pre-processing.
@@ -1362,9 +1820,6 @@ void Lgm_P2F_GetFluxAtConstEsAndAs( double *E, int nE, double *A, int nA, double
             Lgm_InterpArr( Aarr, Karr, narr,   A[k], &p->KofA[k] );
             Lgm_InterpArr( Aarr, Larr, narr,   A[k], &p->LstarOfA[k] );
 
-
-            Lgm_FreeMagInfo( mInfo2 ); // free mInfo2
-
         }
     }   // end parallel
 //    Lgm_TearDown_AlphaOfK( mInfo );
@@ -1397,6 +1852,7 @@ assumes electrons -- generalize this...
      */
     LGM_ARRAY_2D( p->PSD_EA,  p->nE,  p->nA,  double );
     LGM_ARRAY_2D( p->FLUX_EA, p->nE,  p->nA,  double );
+    SizeFits( nA, p->nMaxwellians, &(p->nFit), &(p->FitnMaxwellians), &(p->FitParams), &(p->FitKey), &(p->FitState) );
     for ( k=0; k<nA; k++ ){ // loop over pitch angles
 
 
@@ -1453,7 +1909,7 @@ assumes electrons -- generalize this...
             }
 
             if (DoIt) {
-                p->PSD_EA[m][k]  = Lgm_P2F_GetPsdAtMuAndK( p->MuofE[m][k], p->KofA[k], p->A[k], p );
+                p->PSD_EA[m][k]  = P2F_GetPsdAtMuAndK( k, p->MuofE[m][k], p->KofA[k], p->A[k], p );
                 // Now do conversion from units of PSD to Flux
                 if ( p->PSD_EA[m][k] < 0.0 ) {
 //printf("p->PSD_EA[%d][%d] = %g\n", m, k, p->PSD_EA[m][k]);
@@ -1486,6 +1942,99 @@ assumes electrons -- generalize this...
 
 
 
+/**
+ *  \brief
+ *      Computes Flux at user-supplied constant values of E and \f$\alpha\f$
+ *      for many positions (and times) at once.
+ *  \details
+ *      This is Lgm_P2F_GetFluxAtConstEsAndAs() applied to each of nPos
+ *      positions (e.g. a swarm of virtual spacecraft flying through the PSD
+ *      of a diffusion code). All positions share the PSD(L*, Mu, K) set in p
+ *      with Lgm_P2F_SetPsd(), and the same E and \f$\alpha\f$ grids.
+ *
+ *      The positions are done in parallel. Each thread gets one copy of
+ *      mInfo and a private work structure that points at (but does not
+ *      copy) the PSD arrays in p. The Maxwellian fits in a thread carry over
+ *      as starting guesses from one position to the next. p itself is not
+ *      changed.
+ *
+ *      \param[in]      nPos        Number of positions.
+ *      \param[in]      d           Date/Times of the positions. Size is nPos.
+ *      \param[in]      u           Positions (in GSM). Size is nPos.
+ *      \param[in]      E           1-D array of E values
+ *      \param[in]      nE          Number of E values
+ *      \param[in]      A           1-D array of (local) Alpha values
+ *      \param[in]      nA          Number of Alpha values
+ *      \param[in]      Larr        Precomputed L* versus Alpha at each position, Larr[nPos][narr].
+ *      \param[in]      Karr        Precomputed K versus Alpha at each position, Karr[nPos][narr].
+ *      \param[in]      Aarr        Array of Alpha values for Larr and Karr (the same for all positions).
+ *      \param[in]      narr        Number of values in Aarr (and in each row of Larr and Karr).
+ *      \param[in]      mInfo       Magnetic field model info.
+ *      \param[in]      p           A Lgm_PsdToFlux structure with the PSD set (see Lgm_P2F_SetPsd()).
+ *      \param[out]     Flux        Flux[nPos][nE][nA] (allocated by the caller, e.g. with LGM_ARRAY_3D()).
+ *
+ */
+void Lgm_P2F_GetFluxAtConstEsAndAsMulti( int nPos, Lgm_DateTime *d, Lgm_Vector *u, double *E, int nE, double *A, int nA, double **Larr, double **Karr, double *Aarr, int narr, Lgm_MagModelInfo *mInfo, Lgm_PsdToFlux *p, double ***Flux ) {
+
+    int                 i, k, m;
+    Lgm_MagModelInfo    *mInfo2;
+    Lgm_PsdToFlux       *p2;
+
+    if ( !p->Alloced1 ) {
+        printf("Lgm_P2F_GetFluxAtConstEsAndAsMulti: No PSD has been set (see Lgm_P2F_SetPsd()).\n");
+        return;
+    }
+
+    { // start parallel
+
+#if USE_OPENMP
+        #pragma omp parallel private(i,k,m,mInfo2,p2)
+#endif
+        {
+
+            /*
+             * Per-thread copy of mInfo, and a work structure that shares the
+             * PSD versus L*, Mu, K in p (Alloced1 stays FALSE so freeing it
+             * leaves those alone) but has its own PSD_MK and fits.
+             */
+            mInfo2 = Lgm_NewMagContext( mInfo );
+            p2 = Lgm_P2F_CreatePsdToFlux( FALSE );
+            p2->Extrapolate  = p->Extrapolate;
+            p2->nMaxwellians = p->nMaxwellians;
+            p2->FitType      = p->FitType;
+            p2->nL = p->nL; p2->L  = p->L;
+            p2->nMu = p->nMu; p2->Mu = p->Mu;
+            p2->nK = p->nK; p2->K  = p->K;
+            p2->PSD_LMK = p->PSD_LMK;
+            LGM_ARRAY_2D( p2->PSD_MK, p2->nMu, p2->nK, double );
+
+#if USE_OPENMP
+            #pragma omp for schedule(dynamic, 1)
+#endif
+            for ( i=0; i<nPos; i++ ) {
+
+                Lgm_P2F_SetDateTimeAndPos( &d[i], &u[i], p2 );
+                Lgm_P2F_GetFluxAtConstEsAndAs( E, nE, A, nA, Larr[i], Karr[i], Aarr, narr, mInfo2, p2 );
+                for ( m=0; m<nE; m++ ) {
+                    for ( k=0; k<nA; k++ ) Flux[i][m][k] = p2->FLUX_EA[m][k];
+                }
+
+            }
+
+            LGM_ARRAY_2D_FREE( p2->PSD_MK );
+            Lgm_P2F_FreePsdToFlux( p2 );
+            Lgm_FreeMagInfo( mInfo2 );
+
+        }
+
+    } // end parallel
+
+    return;
+
+}
+
+
+
 /**
  *  \brief
  *      Computes PSD at a given mu and K
@@ -1505,7 +2054,7 @@ assumes electrons -- generalize this...
  *     In this routine, we assume we have already done the iL step to reduce the 3D
  *     array down to a PSD[Mu][K] array.
  */
-double  Lgm_P2F_GetPsdAtMuAndK( double Mu, double K, double A, Lgm_PsdToFlux *p ) {
+static double P2F_GetPsdAtMuAndK( int iA, double Mu, double K, double A, Lgm_PsdToFlux *p ) {
 
     int         j, i, i0, i1;
     double      K0, K1, y0, y1, slp, psd, E, g;
@@ -1569,49 +2118,17 @@ double  Lgm_P2F_GetPsdAtMuAndK( double Mu, double K, double A, Lgm_PsdToFlux *p
         // interpolate/fit E
         // for now just do a linear interp.
         // no lets try a fit...
-        double  in[10], out[7], x[5];
-        in[0] = 1e-8;
-        in[1] = in[2] = 1e-9; //Info->Praxis_Tolerance;
-        in[5] = 30000.0; //(double)Info->Praxis_Max_Function_Evals;
-        in[6] = 10.0; //Info->Praxis_Maximum_Step_Size;
-        in[7] = 10.0; //Info->Praxis_Bad_Scale_Paramater;
-        in[8] = 4.0; //(double)Info->Praxis_Max_Its_Without_Improvement;
-        in[9] = 1.0; //(double)Info->Praxis_Ill_Conditioned_Problem;
-        x[0] = 0.0;
-        x[1] = -1.0;
-        x[2] = 25.0;
-        x[3] = -2.0;
-        x[4] = 200.0;
-        praxis( 2*FitData->nMaxwellians, x, (void *)FitData, Cost, in, out);
-    /*
-    printf("out[0] = %g\n", out[0]);
-    printf("out[1] = %g\n", out[1]);
-    printf("out[2] = %g\n", out[2]);
-    printf("out[3] = %g\n", out[3]);
-    printf("out[4] = %g\n", out[4]);
-    printf("out[5] = %g\n", out[5]);
-    printf("out[6] = %g\n", out[6]);
-    printf("x[1] = %g   x[2] = %g   Cost = %g\n", x[1], x[2], out[6]);
-
-    FILE *fp;
-    printf("E = %g\n", E);
-    fp = fopen("data.txt", "w");
-    for (j=0; j<f->nE; ++j){
-    fprintf(fp, "%g %g\n", f->E[j], FitData->g[j]);
-    }
-    fclose(fp);
-
-    exit(0);
-    */
+        // The fit only depends on A (K is a function of A here), so it is done once per A bin (see FitMaxwelliansInBin()).
+        double  *x;
+        LGM_ARRAY_1D( x, 2*FitData->nMaxwellians+1, double );
+        FitMaxwelliansInBin( FitData, x, iA, A, p->nFit, p->FitParams, p->FitKey, p->FitState );
 
-
-    //x[2] = 200.0;
-        //printf("PSD_TO_FLUX: x - %g %g %g %g\n", x[1], x[2], x[3], x[4]);
         E = Lgm_Mu_to_Ek( Mu, A, p->B, LGM_Ee0 );
         psd = Model( x,  FitData->nMaxwellians, E );
         //psd = (double)a;
 
         //printf("E, A = %g %g  x = %g %g psd = %g\n", E, A, x[1], x[2], psd);
+        LGM_ARRAY_1D_FREE( x );
     } else {
 
         psd = LGM_FILL_VALUE;
@@ -1629,6 +2146,16 @@ double  Lgm_P2F_GetPsdAtMuAndK( double Mu, double K, double A, Lgm_PsdToFlux *p
 
 }
 
+/**
+ *  Computes PSD at a given mu and K (see P2F_GetPsdAtMuAndK() above). The
+ *  Maxwellian fit is not kept.
+ */
+double  Lgm_P2F_GetPsdAtMuAndK( double Mu, double K, double A, Lgm_PsdToFlux *p ) {
+
+    return( P2F_GetPsdAtMuAndK( -1, Mu, K, A, p ) );
+
+}
+
 
 
 
@@ -0,0 +1,313 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Lgm/Lgm_FluxToPsdHdf.h"
+
+/**
+ *  \file
+ *      Routines to write Lgm_FluxToPsd results to HDF5 files.
+ *
+ *      The file has the (static) Mu and K grids, and chunked, extendible
+ *      datasets with one row per time step;
+ *
+ *          IsoTime[t], JulianDate[t], Position[t][3], B[t]
+ *          PSD[t][nMu][nK], EofMu[t][nMu][nK], AofK[t][nK]
+ *
+ *      A typical calling sequence would be;
+ *
+ *          \code
+ *          h = Lgm_F2P_CreateHdf( "Psd.h5", Mu, nMu, K, nK, 0, 0, 1, TRUE );
+ *          for ( each time ) {
+ *              Lgm_F2P_SetDateTimeAndPos( &d, &u, f );
+ *              Lgm_F2P_SetFlux( J, E, nE, A, nA, f );
+ *              Lgm_F2P_GetPsdAtConstMusAndKs( Mu, nMu, K, nK, mInfo, f );
+ *              Lgm_F2P_WriteHdf( h, f );
+ *          }
+ *          Lgm_F2P_CloseHdf( h );
+ *          \endcode
+ *
+ */
+
+
+/*
+ *  Create a chunked dataset with DESCRIPTION/UNITS etc. attributes, and close it.
+ */
+static int F2P_CreateDataSet( Lgm_FluxToPsdHdf *h, char *Name, int Rank, int n1, int n2, hid_t Type, char *Desc, char *Units ) {
+
+    hid_t   DataSet, space;
+
+    if ( Rank == 1 ) {
+        DataSet = CreateChunkedRank1DataSet( h->File, Name, Type, h->ChunkBytes, h->nBuffer, h->Deflate, h->Shuffle, &space );
+    } else if ( Rank == 2 ) {
+        DataSet = CreateChunkedRank2DataSet( h->File, Name, n1, Type, h->ChunkBytes, h->nBuffer, h->Deflate, h->Shuffle, &space );
+    } else {
+        DataSet = CreateChunkedRank3DataSet( h->File, Name, n1, n2, Type, h->ChunkBytes, h->nBuffer, h->Deflate, h->Shuffle, &space );
+    }
+    if ( DataSet < 0 ) {
+        printf("Lgm_F2P_CreateHdf: could not create dataset %s\n", Name );
+        return( FALSE );
+    }
+    Lgm_WriteStringAttr( DataSet, "DESCRIPTION", Desc );
+    if ( strcmp( Name, "IsoTime" ) ) Lgm_WriteStringAttr( DataSet, "DEPEND_0", "IsoTime" );
+    Lgm_WriteStringAttr( DataSet, "UNITS",       Units );
+    Lgm_WriteStringAttr( DataSet, "FILLVAL",     "-1E31" );
+    Lgm_WriteStringAttr( DataSet, "VAR_TYPE",    "data" );
+    H5Sclose( space );
+    H5Dclose( DataSet );
+
+    return( TRUE );
+
+}
+
+static void F2P_FreeBuffers( Lgm_FluxToPsdHdf *h ) {
+
+    if ( h->IsoTime ) LGM_ARRAY_2D_FREE( h->IsoTime );
+    free( h->JulianDate );
+    free( h->Position );
+    free( h->B );
+    free( h->PSD );
+    free( h->EofMu );
+    free( h->AofK );
+
+}
+
+/**
+ *  \brief
+ *      Create an HDF5 file for streaming Lgm_FluxToPsd results into.
+ *
+ *  \details
+ *      The Mu and K grids are fixed for the file (every Lgm_FluxToPsd
+ *      written with Lgm_F2P_WriteHdf() must have been computed on them).
+ *      Time steps are buffered and written nBuffer at a time; this is also
+ *      the chunk length along the time axis, so it bounds both the memory
+ *      used (about nBuffer*nMu*nK*16 bytes) and the unit of compression.
+ *
+ *      \param[in]      Filename    File to create (it is overwritten if it exists).
+ *      \param[in]      Mu          The Mu values.
+ *      \param[in]      nMu         Number of Mu values.
+ *      \param[in]      K           The K values.
+ *      \param[in]      nK          Number of K values.
+ *      \param[in]      ChunkBytes  Target chunk size in bytes (0 for LGM_HDF5_CHUNK_BYTES).
+ *      \param[in]      nBuffer     Time steps per block (0 to size blocks from ChunkBytes).
+ *      \param[in]      Deflate     gzip level 0-9 (0 for none).
+ *      \param[in]      Shuffle     If true, add the shuffle filter (helps gzip with doubles).
+ *
+ *      \return         A writer (close with Lgm_F2P_CloseHdf()), or NULL on error.
+ *
+ */
+Lgm_FluxToPsdHdf *Lgm_F2P_CreateHdf( char *Filename, double *Mu, int nMu, double *K, int nK, size_t ChunkBytes, int nBuffer, int Deflate, int Shuffle ) {
+
+    Lgm_FluxToPsdHdf    *h;
+    hid_t               DataSet, space;
+    int                 Flag;
+
+    if ( ( nMu < 1 ) || ( nK < 1 ) ) {
+        printf("Lgm_F2P_CreateHdf: need at least one Mu and one K (nMu, nK = %d, %d)\n", nMu, nK );
+        return( NULL );
+    }
+
+    h = (Lgm_FluxToPsdHdf *)calloc( 1, sizeof( Lgm_FluxToPsdHdf ) );
+    h->nMu        = nMu;
+    h->nK         = nK;
+    h->ChunkBytes = ( ChunkBytes > 0 ) ? ChunkBytes : LGM_HDF5_CHUNK_BYTES;
+    h->Deflate    = Deflate;
+    h->Shuffle    = Shuffle;
+    h->nBuffer    = ( nBuffer > 0 ) ? nBuffer : (int)( h->ChunkBytes / ( nMu*nK*sizeof(double) ) );
+    if ( h->nBuffer < 1 ) h->nBuffer = 1;
+
+    if ( ( h->File = H5Fcreate( Filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_F2P_CreateHdf: could not create %s\n", Filename );
+        free( h );
+        return( NULL );
+    }
+
+    /*
+     *  The (static) grids.
+     */
+    DataSet = CreateSimpleRank1DataSet( h->File, "Mu", nMu, H5T_NATIVE_DOUBLE, &space );
+    Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "First adiabatic invariant, Mu." );
+    Lgm_WriteStringAttr( DataSet, "UNITS",       "MeV/G" );
+    H5Dwrite( DataSet, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, Mu );
+    H5Sclose( space ); H5Dclose( DataSet );
+
+    DataSet = CreateSimpleRank1DataSet( h->File, "K", nK, H5T_NATIVE_DOUBLE, &space );
+    Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Second invariant, K." );
+    Lgm_WriteStringAttr( DataSet, "UNITS",       "G^1/2 Re" );
+    H5Dwrite( DataSet, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, K );
+    H5Sclose( space ); H5Dclose( DataSet );
+
+    /*
+     *  The per time step datasets.
+     */
+    hid_t atype = CreateStrType( LGM_F2P_HDF_ISOTIME_LEN );
+    Flag = F2P_CreateDataSet( h, "IsoTime",    1, 0,   0,  atype,             "The date and time in ISO 8601 compliant format.", "UTC" )
+        && F2P_CreateDataSet( h, "JulianDate", 1, 0,   0,  H5T_NATIVE_DOUBLE, "Julian Date.", "days" )
+        && F2P_CreateDataSet( h, "Position",   2, 3,   0,  H5T_NATIVE_DOUBLE, "Position of the measurement (GSM).", "Re" )
+        && F2P_CreateDataSet( h, "B",          1, 0,   0,  H5T_NATIVE_DOUBLE, "Magnetic field strength used to convert between Mu and E.", "nT" )
+        && F2P_CreateDataSet( h, "PSD",        3, nMu, nK, H5T_NATIVE_DOUBLE, "Phase space density at constant Mu and K, PSD[t][Mu][K].", "(c/cm/MeV)^3" )
+        && F2P_CreateDataSet( h, "EofMu",      3, nMu, nK, H5T_NATIVE_DOUBLE, "Energy implied by Mu, K and B.", "MeV" )
+        && F2P_CreateDataSet( h, "AofK",       2, nK,  0,  H5T_NATIVE_DOUBLE, "Pitch angle implied by K.", "Degrees" );
+    H5Tclose( atype );
+    if ( !Flag ) {
+        H5Fclose( h->File );
+        free( h );
+        return( NULL );
+    }
+
+    LGM_ARRAY_2D( h->IsoTime, h->nBuffer, LGM_F2P_HDF_ISOTIME_LEN, char );
+    h->JulianDate = (double *)calloc( h->nBuffer, sizeof(double) );
+    h->Position   = (double *)calloc( h->nBuffer*3, sizeof(double) );
+    h->B          = (double *)calloc( h->nBuffer, sizeof(double) );
+    h->PSD        = (double *)calloc( (size_t)h->nBuffer*nMu*nK, sizeof(double) );
+    h->EofMu      = (double *)calloc( (size_t)h->nBuffer*nMu*nK, sizeof(double) );
+    h->AofK       = (double *)calloc( h->nBuffer*nK, sizeof(double) );
+    if ( !h->JulianDate || !h->Position || !h->B || !h->PSD || !h->EofMu || !h->AofK ) {
+        printf("Lgm_F2P_CreateHdf: could not allocate buffers for %d time steps\n", h->nBuffer );
+        F2P_FreeBuffers( h );
+        H5Fclose( h->File );
+        free( h );
+        return( NULL );
+    }
+
+    return( h );
+
+}
+
+/**
+ *  \brief
+ *      Add the results held in an Lgm_FluxToPsd structure as the next time step.
+ *
+ *  \details
+ *      f must have been through Lgm_F2P_GetPsdAtConstMusAndKs() with the Mu
+ *      and K grids given to Lgm_F2P_CreateHdf(). The values are copied, so
+ *      f can be reused right away; they reach the file when nBuffer time
+ *      steps have accumulated (or on Lgm_F2P_FlushHdf()/Lgm_F2P_CloseHdf()).
+ *
+ *      Rather than setting f->DumpDiagnostics (which rewrites the GIF images
+ *      at every stage of every time step), set h->DiagEvery to get the
+ *      images for a sample of the time steps written.
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_F2P_WriteHdf( Lgm_FluxToPsdHdf *h, Lgm_FluxToPsd *f ) {
+
+    int     i, m, k;
+    double  *p, *e;
+    char    Str[80];
+
+    if ( !f->Alloced2 || ( f->nMu != h->nMu ) || ( f->nK != h->nK ) ) {
+        printf("Lgm_F2P_WriteHdf: no PSD_MK, or its size (%d x %d) does not match the file's (%d x %d)\n", f->nMu, f->nK, h->nMu, h->nK );
+        return( FALSE );
+    }
+
+    i = h->nBuffered;
+    Lgm_DateTimeToIsoString( h->IsoTime[i], &f->DateTime, 0 );     // LGM_F2P_HDF_ISOTIME_LEN == LGM_ISOTIME_MAXLEN
+    h->JulianDate[i]    = f->DateTime.JD;
+    h->Position[3*i]    = f->Position.x;
+    h->Position[3*i+1]  = f->Position.y;
+    h->Position[3*i+2]  = f->Position.z;
+    h->B[i]             = f->B;
+
+    p = &h->PSD[ (size_t)i*h->nMu*h->nK ];
+    e = &h->EofMu[ (size_t)i*h->nMu*h->nK ];
+    for ( m=0; m<h->nMu; m++ ) {
+        memcpy( &p[m*h->nK], f->PSD_MK[m], h->nK*sizeof(double) );
+        memcpy( &e[m*h->nK], f->EofMu[m],  h->nK*sizeof(double) );
+    }
+    for ( k=0; k<h->nK; k++ ) h->AofK[i*h->nK+k] = f->AofK[k];
+
+    if ( ( h->DiagEvery > 0 ) && ( ( ( h->nRows + i ) % h->DiagEvery ) == 0 ) ) {
+        sprintf( Str, "_%06lu", (unsigned long)( h->nRows + i ) );
+        Lgm_F2P_DumpDiagnostics( Str, f );
+    }
+
+    if ( ++h->nBuffered >= h->nBuffer ) return( Lgm_F2P_FlushHdf( h ) );
+    return( TRUE );
+
+}
+
+/**
+ *  \brief
+ *      Write out any buffered time steps.
+ *
+ *  \return         TRUE on success, FALSE otherwise.
+ */
+int Lgm_F2P_FlushHdf( Lgm_FluxToPsdHdf *h ) {
+
+    hsize_t n = h->nBuffered, i0 = h->nRows;
+    hid_t   atype;
+    int     Flag;
+
+    if ( n < 1 ) return( TRUE );
+
+    atype = CreateStrType( LGM_F2P_HDF_ISOTIME_LEN );
+    Flag = Lgm_HDF5_AppendRows( h->File, "IsoTime",    i0, n, atype,             &h->IsoTime[0][0] )
+        && Lgm_HDF5_AppendRows( h->File, "JulianDate", i0, n, H5T_NATIVE_DOUBLE, h->JulianDate )
+        && Lgm_HDF5_AppendRows( h->File, "Position",   i0, n, H5T_NATIVE_DOUBLE, h->Position )
+        && Lgm_HDF5_AppendRows( h->File, "B",          i0, n, H5T_NATIVE_DOUBLE, h->B )
+        && Lgm_HDF5_AppendRows( h->File, "PSD",        i0, n, H5T_NATIVE_DOUBLE, h->PSD )
+        && Lgm_HDF5_AppendRows( h->File, "EofMu",      i0, n, H5T_NATIVE_DOUBLE, h->EofMu )
+        && Lgm_HDF5_AppendRows( h->File, "AofK",       i0, n, H5T_NATIVE_DOUBLE, h->AofK );
+    H5Tclose( atype );
+
+    h->nRows    += n;
+    h->nBuffered = 0;
+
+    return( Flag );
+
+}
+
+/**
+ *  \brief
+ *      Flush, close the file and free the writer.
+ *
+ *  \return         TRUE if the last flush succeeded, FALSE otherwise.
+ */
+int Lgm_F2P_CloseHdf( Lgm_FluxToPsdHdf *h ) {
+
+    int Flag;
+
+    if ( h == NULL ) return( FALSE );
+    Flag = Lgm_F2P_FlushHdf( h );
+    H5Fclose( h->File );
+    F2P_FreeBuffers( h );
+    free( h );
+
+    return( Flag );
+
+}
+
+/**
+ *  \brief
+ *      Dump the GIF images of FLUX_EA, PSD_EA and PSD_MK for the current state of f.
+ *
+ *  \details
+ *      These are the images that f->DumpDiagnostics makes as
+ *      Lgm_F2P_SetFlux() and Lgm_F2P_GetPsdAtConstMusAndKs() run. Doing it
+ *      here instead lets a caller make them only when wanted. The file
+ *      names are e.g. "Lgm_FluxToPsd_PSD_MK<Suffix>".
+ *
+ *      \param[in]      Suffix      Appended to the image file names (can be "").
+ *      \param[in]      f           A Lgm_FluxToPsd structure.
+ *
+ */
+void Lgm_F2P_DumpDiagnostics( char *Suffix, Lgm_FluxToPsd *f ) {
+
+    char    Filename[1024];
+
+    if ( f->Alloced1 ) {
+        sprintf( Filename, "Lgm_FluxToPsd_FLUX_EA%s", Suffix );
+        DumpGif( Filename, f->nA, f->nE, f->FLUX_EA );
+        sprintf( Filename, "Lgm_FluxToPsd_PSD_EA%s", Suffix );
+        DumpGif( Filename, f->nA, f->nE, f->PSD_EA );
+    }
+    if ( f->Alloced2 ) {
+        sprintf( Filename, "Lgm_FluxToPsd_PSD_MK%s", Suffix );
+        DumpGif( Filename, f->nK, f->nMu, f->PSD_MK );
+    }
+
+}
@@ -3,6 +3,57 @@
 #include "Lgm/Lgm_MagModelInfo.h"
 
 
+/*
+ *  All of the routines below get B and its Jacobian, J[i][j] = dB_i/dx_j,
+ *  from a single Lgm_B_Jacobian() call. That uses an analytic Jacobian for
+ *  the models that have one, and otherwise differences m->Bfield with the
+ *  DerivScheme/h stencil (once for all nine derivatives).
+ */
+
+/*
+ *  grad|B|_j = sum_i (B_i/|B|) dB_i/dx_j
+ */
+static void Lgm_GradB_FromJacobian( Lgm_Vector *Bvec, double J[3][3], Lgm_Vector *GradB ) {
+
+    double  B;
+
+    B = Lgm_Magnitude( Bvec );
+    GradB->x = ( Bvec->x*J[0][0] + Bvec->y*J[1][0] + Bvec->z*J[2][0] )/B;
+    GradB->y = ( Bvec->x*J[0][1] + Bvec->y*J[1][1] + Bvec->z*J[2][1] )/B;
+    GradB->z = ( Bvec->x*J[0][2] + Bvec->y*J[1][2] + Bvec->z*J[2][2] )/B;
+
+}
+
+static void Lgm_CurlB_FromJacobian( double J[3][3], Lgm_Vector *CurlB ) {
+
+    CurlB->x = J[2][1] - J[1][2];
+    CurlB->y = J[0][2] - J[2][0];
+    CurlB->z = J[1][0] - J[0][1];
+
+}
+
+/*
+ *  Split A into components parallel and perpendicular to Bvec.
+ */
+static void Lgm_ParaPerp( Lgm_Vector *Bvec, Lgm_Vector *A, Lgm_Vector *A_para, Lgm_Vector *A_perp ) {
+
+    double      g;
+    Lgm_Vector  b;
+
+    b = *Bvec;
+    Lgm_NormalizeVector( &b );
+
+    // Compute parallel component of A
+    g = Lgm_DotProduct( &b, A );
+    *A_para = b;
+    Lgm_ScaleVector( A_para, g );
+
+    // Compute perpendicular component of A (A_perp = A - A_para)
+    Lgm_VecSub( A_perp, A, A_para );
+
+}
+
+
 /**
  *  \brief
  *      Compute the gradient of B at a given point.
@@ -24,69 +75,12 @@
  */
 void Lgm_GradB( Lgm_Vector *u0, Lgm_Vector *GradB, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      B, H, fx[7], fy[7], fz[7];
-    int         i, N;
-    Lgm_Vector  u, Bvec;
-
-
-
-    /*
-     * Select the derivative scheme to use.
-     *      f_0^(1) = 1/(60h)  ( f_3 - 9f_2 + 45f_1  - 45f_-1 + 9f_-2 - f_-3 )
-     * See page 450 of CRC standard Math tables 28th edition.
-     */
-    switch ( DerivScheme ) {
-        case LGM_DERIV_SIX_POINT:
-            N = 3;
-            break;
-        case LGM_DERIV_FOUR_POINT:
-            N = 2;
-            break;
-        case LGM_DERIV_TWO_POINT:
-            N = 1;
-            break;
-    }
+    double      J[3][3];
+    Lgm_Vector  Bvec;
 
     if (m->VerbosityLevel > 0) printf("\t\tLgm_GradB: Computing GradB with DerivScheme = %d,  h = %g", DerivScheme, h);
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.x += H;
-            m->Bfield( &u, &Bvec, m );
-            B = Lgm_Magnitude( &Bvec );
-            fx[i+N] = B;
-        }
-    }
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.y += H;
-            m->Bfield( &u, &Bvec, m );
-            B = Lgm_Magnitude( &Bvec );
-            fy[i+N] = B;
-        }
-    }
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.z += H;
-            m->Bfield( &u, &Bvec, m );
-            B = Lgm_Magnitude( &Bvec );
-            fz[i+N] = B;
-        }
-    }
-
-
-    if (DerivScheme == LGM_DERIV_SIX_POINT){
-        GradB->x = (fx[6] - 9.0*fx[5] + 45.0*fx[4] - 45.0*fx[2] + 9.0*fx[1] - fx[0])/(60.0*h);
-        GradB->y = (fy[6] - 9.0*fy[5] + 45.0*fy[4] - 45.0*fy[2] + 9.0*fy[1] - fy[0])/(60.0*h);
-        GradB->z = (fz[6] - 9.0*fz[5] + 45.0*fz[4] - 45.0*fz[2] + 9.0*fz[1] - fz[0])/(60.0*h);
-    } else if (DerivScheme == LGM_DERIV_FOUR_POINT){
-        GradB->x = (-fx[4] + 8.0*fx[3] - 8.0*fx[1] + fx[0])/(12.0*h);
-        GradB->y = (-fy[4] + 8.0*fy[3] - 8.0*fy[1] + fy[0])/(12.0*h);
-        GradB->z = (-fz[4] + 8.0*fz[3] - 8.0*fz[1] + fz[0])/(12.0*h);
-    } else if (DerivScheme == LGM_DERIV_TWO_POINT){
-        GradB->x = (fx[2] - fx[0])/(2.0*h);
-        GradB->y = (fy[2] - fy[0])/(2.0*h);
-        GradB->z = (fz[2] - fz[0])/(2.0*h);
-    }
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    Lgm_GradB_FromJacobian( &Bvec, J, GradB );
     if (m->VerbosityLevel > 0) printf("   GradB = (%g %g %g)\n", GradB->x, GradB->y, GradB->z );
 
     return;
@@ -117,25 +111,16 @@ void Lgm_GradB( Lgm_Vector *u0, Lgm_Vector *GradB, int DerivScheme, double h, Lg
  */
 void Lgm_GradB2( Lgm_Vector *u0, Lgm_Vector *GradB, Lgm_Vector *GradB_para, Lgm_Vector *GradB_perp, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      g;
+    double      J[3][3];
     Lgm_Vector  Bvec;
 
+    if (m->VerbosityLevel > 0) printf("\t\tLgm_GradB2: Computing GradB with DerivScheme = %d,  h = %g", DerivScheme, h);
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    Lgm_GradB_FromJacobian( &Bvec, J, GradB );
+    if (m->VerbosityLevel > 0) printf("   GradB = (%g %g %g)\n", GradB->x, GradB->y, GradB->z );
 
-    Lgm_GradB( u0, GradB, DerivScheme, h, m );
-
-
-    m->Bfield( u0, &Bvec, m );
-    Lgm_NormalizeVector( &Bvec );
-
-    // Compute parallel component of GradB
-    g = Lgm_DotProduct( &Bvec, GradB );
-    *GradB_para = *GradB;
-    Lgm_ScaleVector( GradB_para, g );
-
-
-    // Compute perpendicular component of GradB (GradB_perp = GradB - GradB_para)
-    Lgm_VecSub( GradB_perp, GradB, GradB_para );
-
+    // Parallel and perpendicular components of GradB
+    Lgm_ParaPerp( &Bvec, GradB, GradB_para, GradB_perp );
 
     return;
 
@@ -144,16 +129,14 @@ void Lgm_GradB2( Lgm_Vector *u0, Lgm_Vector *GradB, Lgm_Vector *GradB_para, Lgm_
 
 void Lgm_B_Cross_GradB_Over_B( Lgm_Vector *u0, Lgm_Vector *A, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      B;
+    double      J[3][3];
     Lgm_Vector  GradB, Bvec;
 
-    m->Bfield( u0, &Bvec, m );
-    B = Lgm_Magnitude( &Bvec );
-
-    Lgm_GradB( u0, &GradB, DerivScheme, h, m );
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    Lgm_GradB_FromJacobian( &Bvec, J, &GradB );
     Lgm_CrossProduct( &Bvec, &GradB, A );
-    Lgm_ScaleVector( A, 1.0/B );
-    
+    Lgm_ScaleVector( A, 1.0/Lgm_Magnitude( &Bvec ) );
+
 }
 
 
@@ -178,114 +161,12 @@ void Lgm_B_Cross_GradB_Over_B( Lgm_Vector *u0, Lgm_Vector *A, int DerivScheme, d
  */
 void Lgm_CurlB( Lgm_Vector *u0, Lgm_Vector *CurlB, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      B, H;
-    double      fxy[7], fxz[7], fyx[7], fyz[7], fzx[7], fzy[7];
-    double      dBxdy, dBxdz, dBydx, dBydz, dBzdx, dBzdy;
-    int         i, N;
-    Lgm_Vector  u, Bvec;
-
-
-
-    /*
-     * Select the derivative scheme to use.
-     *      f_0^(1) = 1/(60h)  ( f_3 - 9f_2 + 45f_1  - 45f_-1 + 9f_-2 - f_-3 )
-     * See page 450 of CRC standard Math tables 28th edition.
-     */
-    switch ( DerivScheme ) {
-        case LGM_DERIV_SIX_POINT:
-            N = 3;
-            break;
-        case LGM_DERIV_FOUR_POINT:
-            N = 2;
-            break;
-        case LGM_DERIV_TWO_POINT:
-            N = 1;
-            break;
-    }
+    double      J[3][3];
+    Lgm_Vector  Bvec;
 
     if (m->VerbosityLevel > 0) printf("\t\tLgm_CurlB: Computing CurlB with DerivScheme = %d,  h = %g", DerivScheme, h);
-    // dBx/dy and dBx/dz
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.y += H;
-            m->Bfield( &u, &Bvec, m );
-            fxy[i+N] = Bvec.x;
-        }
-    }
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.z += H;
-            m->Bfield( &u, &Bvec, m );
-            fxz[i+N] = Bvec.x;
-        }
-    }
-
-    // dBy/dx and dBy/dz
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.x += H;
-            m->Bfield( &u, &Bvec, m );
-            fyx[i+N] = Bvec.y;
-        }
-    }
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.z += H;
-            m->Bfield( &u, &Bvec, m );
-            fyz[i+N] = Bvec.y;
-        }
-    }
-
-    // dBz/dx and dBz/dy
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.x += H;
-            m->Bfield( &u, &Bvec, m );
-            fzx[i+N] = Bvec.z;
-        }
-    }
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.y += H;
-            m->Bfield( &u, &Bvec, m );
-            fzy[i+N] = Bvec.z;
-        }
-    }
-
-    if (DerivScheme == LGM_DERIV_SIX_POINT){
-        dBxdy = (fxy[6] - 9.0*fxy[5] + 45.0*fxy[4] - 45.0*fxy[2] + 9.0*fxy[1] - fxy[0])/(60.0*h);
-        dBxdz = (fxz[6] - 9.0*fxz[5] + 45.0*fxz[4] - 45.0*fxz[2] + 9.0*fxz[1] - fxz[0])/(60.0*h);
-
-        dBydx = (fyx[6] - 9.0*fyx[5] + 45.0*fyx[4] - 45.0*fyx[2] + 9.0*fyx[1] - fyx[0])/(60.0*h);
-        dBydz = (fyz[6] - 9.0*fyz[5] + 45.0*fyz[4] - 45.0*fyz[2] + 9.0*fyz[1] - fyz[0])/(60.0*h);
-
-        dBzdx = (fzx[6] - 9.0*fzx[5] + 45.0*fzx[4] - 45.0*fzx[2] + 9.0*fzx[1] - fzx[0])/(60.0*h);
-        dBzdy = (fzy[6] - 9.0*fzy[5] + 45.0*fzy[4] - 45.0*fzy[2] + 9.0*fzy[1] - fzy[0])/(60.0*h);
-    } else if (DerivScheme == LGM_DERIV_FOUR_POINT){
-        dBxdy = (-fxy[4] + 8.0*fxy[3] - 8.0*fxy[1] + fxy[0])/(12.0*h);
-        dBxdz = (-fxz[4] + 8.0*fxz[3] - 8.0*fxz[1] + fxz[0])/(12.0*h);
-
-        dBydx = (-fyx[4] + 8.0*fyx[3] - 8.0*fyx[1] + fyx[0])/(12.0*h);
-        dBydz = (-fyz[4] + 8.0*fyz[3] - 8.0*fyz[1] + fyz[0])/(12.0*h);
-
-        dBzdx = (-fzx[4] + 8.0*fzx[3] - 8.0*fzx[1] + fzx[0])/(12.0*h);
-        dBzdy = (-fzy[4] + 8.0*fzy[3] - 8.0*fzy[1] + fzy[0])/(12.0*h);
-    } else if (DerivScheme == LGM_DERIV_TWO_POINT){
-        dBxdy = (fxy[2] - fxy[0])/(2.0*h);
-        dBxdz = (fxz[2] - fxz[0])/(2.0*h);
-
-        dBydx = (fyx[2] - fyx[0])/(2.0*h);
-        dBydz = (fyz[2] - fyz[0])/(2.0*h);
-
-        dBzdx = (fzx[2] - fzx[0])/(2.0*h);
-        dBzdy = (fzy[2] - fzy[0])/(2.0*h);
-    }
-    CurlB->x = dBzdy - dBydz;
-    CurlB->y = dBxdz - dBzdx;
-    CurlB->z = dBydx - dBxdy;
-//printf("NRM dBdx = %g %g %g\n", -999.0, dBydx, dBzdx );
-//printf("NRM dBdy = %g %g %g\n", dBxdy, -999.0, dBzdy );
-//printf("NRM dBdz = %g %g %g\n", dBxdz, dBydz, -999.0 );
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    Lgm_CurlB_FromJacobian( J, CurlB );
     if (m->VerbosityLevel > 0) printf("   CurlB = (%g %g %g)\n", CurlB->x, CurlB->y, CurlB->z );
 
     return;
@@ -316,25 +197,16 @@ void Lgm_CurlB( Lgm_Vector *u0, Lgm_Vector *CurlB, int DerivScheme, double h, Lg
  */
 void Lgm_CurlB2( Lgm_Vector *u0, Lgm_Vector *CurlB, Lgm_Vector *CurlB_para, Lgm_Vector *CurlB_perp, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      g;
+    double      J[3][3];
     Lgm_Vector  Bvec;
 
+    if (m->VerbosityLevel > 0) printf("\t\tLgm_CurlB2: Computing CurlB with DerivScheme = %d,  h = %g", DerivScheme, h);
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    Lgm_CurlB_FromJacobian( J, CurlB );
+    if (m->VerbosityLevel > 0) printf("   CurlB = (%g %g %g)\n", CurlB->x, CurlB->y, CurlB->z );
 
-    Lgm_CurlB( u0, CurlB, DerivScheme, h, m );
-
-
-    m->Bfield( u0, &Bvec, m );
-    Lgm_NormalizeVector( &Bvec );
-
-    // Compute parallel component of CurlB
-    g = Lgm_DotProduct( &Bvec, CurlB );
-    *CurlB_para = *CurlB;
-    Lgm_ScaleVector( CurlB_para, g );
-
-
-    // Compute perpendicular component of CurlB (CurlB_perp = CurlB - CurlB_para)
-    Lgm_VecSub( CurlB_perp, CurlB, CurlB_para );
-
+    // Parallel and perpendicular components of CurlB
+    Lgm_ParaPerp( &Bvec, CurlB, CurlB_para, CurlB_perp );
 
     return;
 
@@ -368,74 +240,13 @@ void Lgm_CurlB2( Lgm_Vector *u0, Lgm_Vector *CurlB, Lgm_Vector *CurlB_para, Lgm_
  */
 void Lgm_DivB( Lgm_Vector *u0, double *DivB, int DerivScheme, double h, Lgm_MagModelInfo *m ) {
 
-    double      B, H;
-    double      fxx[7], fyy[7], fzz[7];
-    double      dBxdx, dBydy, dBzdz;
-    int         i, N;
-    Lgm_Vector  u, Bvec;
-
-
-
-    /*
-     * Select the derivative scheme to use.
-     *      f_0^(1) = 1/(60h)  ( f_3 - 9f_2 + 45f_1  - 45f_-1 + 9f_-2 - f_-3 )
-     * See page 450 of CRC standard Math tables 28th edition.
-     */
-    switch ( DerivScheme ) {
-        case LGM_DERIV_SIX_POINT:
-            N = 3;
-            break;
-        case LGM_DERIV_FOUR_POINT:
-            N = 2;
-            break;
-        case LGM_DERIV_TWO_POINT:
-            N = 1;
-            break;
-    }
+    double      J[3][3];
+    Lgm_Vector  Bvec;
 
     if (m->VerbosityLevel > 0) printf("\t\tLgm_DivB: Computing DivB with DerivScheme = %d,  h = %g", DerivScheme, h);
-    // dBx/dx
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.x += H;
-            m->Bfield( &u, &Bvec, m );
-            fxx[i+N] = Bvec.x;
-        }
-    }
-
-    // dBy/dy
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.y += H;
-            m->Bfield( &u, &Bvec, m );
-            fyy[i+N] = Bvec.y;
-        }
-    }
-
-    // dBz/dz
-    for (i=-N; i<=N; ++i){
-        if ( N != 0 ) {
-            u = *u0; H = (double)i*h; u.z += H;
-            m->Bfield( &u, &Bvec, m );
-            fzz[i+N] = Bvec.z;
-        }
-    }
-
-    if (DerivScheme == LGM_DERIV_SIX_POINT){
-        dBxdx = (fxx[6] - 9.0*fxx[5] + 45.0*fxx[4] - 45.0*fxx[2] + 9.0*fxx[1] - fxx[0])/(60.0*h);
-        dBydy = (fyy[6] - 9.0*fyy[5] + 45.0*fyy[4] - 45.0*fyy[2] + 9.0*fyy[1] - fyy[0])/(60.0*h);
-        dBzdz = (fzz[6] - 9.0*fzz[5] + 45.0*fzz[4] - 45.0*fzz[2] + 9.0*fzz[1] - fzz[0])/(60.0*h);
-    } else if (DerivScheme == LGM_DERIV_FOUR_POINT){
-        dBxdx = (-fxx[4] + 8.0*fxx[3] - 8.0*fxx[1] + fxx[0])/(12.0*h);
-        dBydy = (-fyy[4] + 8.0*fyy[3] - 8.0*fyy[1] + fyy[0])/(12.0*h);
-        dBzdz = (-fzz[4] + 8.0*fzz[3] - 8.0*fzz[1] + fzz[0])/(12.0*h);
-    } else if (DerivScheme == LGM_DERIV_TWO_POINT){
-        dBxdx = (fxx[2] - fxx[0])/(2.0*h);
-        dBydy = (fyy[2] - fyy[0])/(2.0*h);
-        dBzdz = (fzz[2] - fzz[0])/(2.0*h);
-    }
-    *DivB = dBxdx + dBydy + dBzdz;
-    if (m->VerbosityLevel > 0) printf("   dBxdx, dBydy, dBzdz, DivB = %g %g %g %g\n", dBxdx, dBydy, dBzdz, *DivB );
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
+    *DivB = J[0][0] + J[1][1] + J[2][2];
+    if (m->VerbosityLevel > 0) printf("   dBxdx, dBydy, dBzdz, DivB = %g %g %g %g\n", J[0][0], J[1][1], J[2][2], *DivB );
 
     return;
 
@@ -485,7 +296,7 @@ void Lgm_DivB( Lgm_Vector *u0, double *DivB, int DerivScheme, double h, Lgm_MagM
  */
 int Lgm_GradAndCurvDriftVel( Lgm_Vector *u0, Lgm_Vector *Vel, Lgm_MagModelInfo *m ) {
 
-    double      B, BoverBm, g, eta, h, Beta, Beta2, Gamma;
+    double      B, BoverBm, g, eta, h, Beta, Beta2, Gamma, J[3][3];
     double      q, T, E0, Bm;
     int         DerivScheme;
     Lgm_Vector  CurlB, CurlB_para, CurlB_perp, GradB, Bvec, Q, R, S, W, Z;
@@ -499,7 +310,10 @@ int Lgm_GradAndCurvDriftVel( Lgm_Vector *u0, Lgm_Vector *Vel, Lgm_MagModelInfo *
     DerivScheme = m->Lgm_VelStep_DerivScheme;
 
 //printf("Lgm_GradAndCurvDriftVel: u0 = %g %g %g\n", u0->x, u0->y, u0->z);
-    m->Bfield( u0, &Bvec, m );
+    /*
+     * B and its Jacobian from a single call.
+     */
+    Lgm_B_Jacobian( u0, &Bvec, J, DerivScheme, h, m );
     B = Lgm_Magnitude( &Bvec );
     BoverBm = B/Bm;
 //printf("BoverBm = %g\n", BoverBm);
@@ -508,14 +322,15 @@ int Lgm_GradAndCurvDriftVel( Lgm_Vector *u0, Lgm_Vector *Vel, Lgm_MagModelInfo *
     /*
      * Compute B cross GradB  [nT/Re]
      */
-    Lgm_GradB( u0, &GradB, DerivScheme, h, m );
+    Lgm_GradB_FromJacobian( &Bvec, J, &GradB );
     Lgm_CrossProduct( &Bvec, &GradB, &B_Cross_GradB );
 
 
     /*
      * Compute (curl B)_perp [nT/Re]
      */
-    Lgm_CurlB2( u0, &CurlB, &CurlB_para, &CurlB_perp, DerivScheme, h, m );
+    Lgm_CurlB_FromJacobian( J, &CurlB );
+    Lgm_ParaPerp( &Bvec, &CurlB, &CurlB_para, &CurlB_perp );
 
 
     /*
@@ -339,28 +339,359 @@ double ****Get_DoubleDataset_4D( hid_t file, char *DataSet, hsize_t *Dims ) {
 }
 
 
+/**
+ *  \brief
+ *      Gets the rank and dimensions of an HDF5 dataset without reading it.
+ *
+ *  \details
+ *      Useful for sizing the caller-provided buffers given to
+ *      Lgm_HDF5_ReadHyperslab() and friends.
+ *
+ *      \param[in]      file       An hdf5 file handle.
+ *      \param[in]      DataSet    The dataset in the HDF5 file (e.g. "/IsoTime" ).
+ *      \param[out]     Dims       The size in each dimension (room for 8 is enough).
+ *
+ *      \return         The rank of the dataset, or -1 if it could not be opened.
+ *
+ */
+int Lgm_HDF5_GetDims( hid_t file, char *DataSet, hsize_t *Dims ) {
+
+    hid_t   dataset, dataspace;
+    int     rank;
+
+    if ( ( dataset = H5Dopen( file, DataSet, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_HDF5_GetDims: could not open dataset %s\n", DataSet );
+        return( -1 );
+    }
+    dataspace = H5Dget_space( dataset );
+    rank      = H5Sget_simple_extent_ndims( dataspace );
+    if ( ( rank >= 0 ) && ( rank <= 8 ) ) H5Sget_simple_extent_dims( dataspace, Dims, NULL );
+    H5Sclose( dataspace );
+    H5Dclose( dataset );
+
+    return( rank );
+
+}
+
 /*
- *  Creates an extendible dataset (with zero "rows"). Returns handle to
- *  dataset. Also returns handle to the dataspace.  Both of these need to be
- *  closed by user when done. (E.g. H5Sclose( DataSpace ); and H5Dclose( DataSet ); )
+ *  Selects the hyperslab Start/Count of dataspace (NULL Start means the
+ *  origin, NULL Count means everything from Start to the end). On return
+ *  SlabSize holds the count actually selected.
  */
-hid_t   CreateExtendableRank1DataSet( hid_t File, char *DataSetName, hid_t Type, hid_t *DataSpace ){
+static int SelectHyperslab( hid_t dataspace, int rank, hsize_t *Start, hsize_t *Count, hsize_t *SlabSize, char *Caller, char *DataSet ) {
+
+    int     i;
+    hsize_t Dims[8], Offset[8];
+
+    H5Sget_simple_extent_dims( dataspace, Dims, NULL );
+    for ( i=0; i<rank; i++ ) {
+        Offset[i]   = ( Start ) ? Start[i] : 0;
+        SlabSize[i] = ( Count ) ? Count[i] : ( ( Offset[i] < Dims[i] ) ? Dims[i] - Offset[i] : 0 );
+        if ( Offset[i] + SlabSize[i] > Dims[i] ) {
+            printf("%s: hyperslab [%llu, %llu) is outside dimension %d (%llu) of dataset %s\n", Caller,
+                    (unsigned long long)Offset[i], (unsigned long long)(Offset[i]+SlabSize[i]), i, (unsigned long long)Dims[i], DataSet );
+            return( FALSE );
+        }
+    }
+    return( H5Sselect_hyperslab( dataspace, H5S_SELECT_SET, Offset, NULL, SlabSize, NULL ) >= 0 );
 
-    int             Rank;
-    hsize_t         Dims[4], MaxDims[4], ChunkDims[4];
+}
+
+/**
+ *  \brief
+ *      Reads part of an HDF5 dataset into a caller-provided buffer.
+ *
+ *  \details
+ *      The Get_*Dataset_*D() routines read a whole dataset into freshly
+ *      allocated memory. This reads only the hyperslab that starts at
+ *      Start[] and is Count[] long in each dimension, into buf, which is
+ *      contiguous, in row-major order, and must have room for the product
+ *      of the Count[]'s. For example, to get rows 1000-1099 of a rank 2
+ *      dataset of doubles;
+ *
+ *          \code
+ *          hsize_t Start[2] = { 1000, 0 }, Count[2] = { 100, 3 };
+ *          double  Rgsm[100][3];
+ *          Lgm_HDF5_ReadHyperslab( file, "/Rgsm", H5T_NATIVE_DOUBLE, 2, Start, Count, &Rgsm[0][0] );
+ *          \endcode
+ *
+ *      \param[in]      file       An hdf5 file handle.
+ *      \param[in]      DataSet    The dataset in the HDF5 file.
+ *      \param[in]      MemType    HDF5 type of the elements in buf (e.g. H5T_NATIVE_DOUBLE).
+ *      \param[in]      Rank       Expected rank of the dataset.
+ *      \param[in]      Start      First element in each dimension (NULL for all zeros).
+ *      \param[in]      Count      Number of elements in each dimension (NULL for "to the end").
+ *      \param[out]     buf        Where to put the data.
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_HDF5_ReadHyperslab( hid_t file, char *DataSet, hid_t MemType, int Rank, hsize_t *Start, hsize_t *Count, void *buf ) {
+
+    hid_t   dataset, dataspace, memspace;
+    hsize_t SlabSize[8];
+    herr_t  status;
+    int     rank;
+
+    if ( ( dataset = H5Dopen( file, DataSet, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_HDF5_ReadHyperslab: could not open dataset %s\n", DataSet );
+        return( FALSE );
+    }
+    dataspace = H5Dget_space( dataset );
+    rank      = H5Sget_simple_extent_ndims( dataspace );
+    if ( ( rank != Rank ) || ( rank < 1 ) || ( rank > 8 ) ) {
+        printf("Lgm_HDF5_ReadHyperslab: dataset %s is not rank %d. Rank = %d\n", DataSet, Rank, rank );
+        H5Sclose( dataspace ); H5Dclose( dataset );
+        return( FALSE );
+    }
+    if ( !SelectHyperslab( dataspace, rank, Start, Count, SlabSize, "Lgm_HDF5_ReadHyperslab", DataSet ) ) {
+        H5Sclose( dataspace ); H5Dclose( dataset );
+        return( FALSE );
+    }
+
+    memspace = H5Screate_simple( rank, SlabSize, NULL );
+    status   = H5Dread( dataset, MemType, memspace, dataspace, H5P_DEFAULT, buf );
+
+    H5Sclose( memspace );
+    H5Sclose( dataspace );
+    H5Dclose( dataset );
+
+    return( ( status < 0 ) ? FALSE : TRUE );
+
+}
+
+/**
+ *  \brief
+ *      Lgm_HDF5_ReadHyperslab() for datasets of doubles.
+ */
+int Lgm_HDF5_ReadDoubleHyperslab( hid_t file, char *DataSet, int Rank, hsize_t *Start, hsize_t *Count, double *buf ) {
+    return( Lgm_HDF5_ReadHyperslab( file, DataSet, H5T_NATIVE_DOUBLE, Rank, Start, Count, (void *)buf ) );
+}
+
+/**
+ *  \brief
+ *      Lgm_HDF5_ReadHyperslab() for datasets of ints.
+ */
+int Lgm_HDF5_ReadIntHyperslab( hid_t file, char *DataSet, int Rank, hsize_t *Start, hsize_t *Count, int *buf ) {
+    return( Lgm_HDF5_ReadHyperslab( file, DataSet, H5T_NATIVE_INT, Rank, Start, Count, (void *)buf ) );
+}
+
+/**
+ *  \brief
+ *      Gets the fixed string length of a rank 1 string dataset.
+ *
+ *  \return         The length of each string in the file (not counting a
+ *                  nul term), or 0 on error. Buffers for
+ *                  Lgm_HDF5_ReadStringHyperslab() need one more than this per string.
+ */
+size_t Lgm_HDF5_GetStringSize( hid_t file, char *DataSet ) {
+
+    hid_t   dataset, datatype;
+    size_t  size;
+
+    if ( ( dataset = H5Dopen( file, DataSet, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_HDF5_GetStringSize: could not open dataset %s\n", DataSet );
+        return( 0 );
+    }
+    datatype = H5Dget_type( dataset );
+    size     = ( H5Tget_class( datatype ) == H5T_STRING ) ? H5Tget_size( datatype ) : 0;
+    H5Tclose( datatype );
+    H5Dclose( dataset );
+
+    return( size );
+
+}
+
+/**
+ *  \brief
+ *      Reads strings Start to Start+Count-1 of a rank 1 string dataset into a caller-provided buffer.
+ *
+ *  \details
+ *      The strings go into buf, StrLen bytes apart, and each is nul
+ *      terminated (and truncated if StrLen is not more than the length in
+ *      the file). So for the "/IsoTime" dataset of a MagEphem file;
+ *
+ *          \code
+ *          size_t n = Lgm_HDF5_GetStringSize( file, "/IsoTime" ) + 1;
+ *          char   *buf = (char *)calloc( 100*n, 1 );
+ *          Lgm_HDF5_ReadStringHyperslab( file, "/IsoTime", 500, 100, n, buf );
+ *          // string k is &buf[k*n]
+ *          \endcode
+ *
+ *      \param[in]      file       An hdf5 file handle.
+ *      \param[in]      DataSet    The dataset in the HDF5 file (e.g. "/IsoTime" ).
+ *      \param[in]      Start      First string to read.
+ *      \param[in]      Count      Number of strings to read.
+ *      \param[in]      StrLen     Bytes set aside in buf for each string (including the nul).
+ *      \param[out]     buf        Where to put the strings (room for Count*StrLen chars).
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_HDF5_ReadStringHyperslab( hid_t file, char *DataSet, hsize_t Start, hsize_t Count, size_t StrLen, char *buf ) {
+
+    hid_t   dataset, dataspace, memspace, datatype, atype;
+    hsize_t SlabSize[1];
+    herr_t  status;
+    int     rank;
+
+    if ( ( Count < 1 ) || ( StrLen < 1 ) ) return( TRUE );
+
+    if ( ( dataset = H5Dopen( file, DataSet, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_HDF5_ReadStringHyperslab: could not open dataset %s\n", DataSet );
+        return( FALSE );
+    }
+    dataspace = H5Dget_space( dataset );
+    rank      = H5Sget_simple_extent_ndims( dataspace );
+    if ( rank != 1 ) {
+        printf("Lgm_HDF5_ReadStringHyperslab: dataset %s is not rank 1. Rank = %d\n", DataSet, rank );
+        H5Sclose( dataspace ); H5Dclose( dataset );
+        return( FALSE );
+    }
+    if ( !SelectHyperslab( dataspace, 1, &Start, &Count, SlabSize, "Lgm_HDF5_ReadStringHyperslab", DataSet ) ) {
+        H5Sclose( dataspace ); H5Dclose( dataset );
+        return( FALSE );
+    }
+
+    /*
+     *  Read with a memory type StrLen-1 wide and nul terminated, so the
+     *  library does the padding/truncation for us.
+     */
+    datatype = H5Dget_type( dataset );
+    atype    = H5Tcopy( H5T_C_S1 );
+    H5Tset_size( atype, StrLen );
+    H5Tset_strpad( atype, H5T_STR_NULLTERM );
+    H5Tset_cset( atype, H5Tget_cset( datatype ) );
+
+    memspace = H5Screate_simple( 1, SlabSize, NULL );
+    status   = H5Dread( dataset, atype, memspace, dataspace, H5P_DEFAULT, buf );
+
+    H5Tclose( atype );
+    H5Tclose( datatype );
+    H5Sclose( memspace );
+    H5Sclose( dataspace );
+    H5Dclose( dataset );
+
+    return( ( status < 0 ) ? FALSE : TRUE );
+
+}
+
+/*
+ *  Index of the first string in the (sorted) rank 1 string dataset that is
+ *  not less than Key (or greater than Key if Upper is set), found with a
+ *  binary search that reads one string per probe.
+ */
+static int IsoTimeBound( hid_t file, char *DataSet, hsize_t n, size_t StrLen, char *Key, int Upper, char *Str, hsize_t *Index ) {
+
+    hsize_t lo = 0, hi = n, mid;
+    int     c;
+
+    while ( lo < hi ) {
+        mid = lo + (hi-lo)/2;
+        if ( !Lgm_HDF5_ReadStringHyperslab( file, DataSet, mid, 1, StrLen, Str ) ) return( FALSE );
+        c = strcmp( Str, Key );
+        if ( ( c < 0 ) || ( Upper && ( c == 0 ) ) ) lo = mid+1;
+        else hi = mid;
+    }
+    *Index = lo;
+    return( TRUE );
+
+}
+
+/**
+ *  \brief
+ *      Finds the rows of a time-ordered ISO time dataset that lie in a time range, without reading the whole dataset.
+ *
+ *  \details
+ *      The IsoTime dataset of a MagEphem file is written in time order, and
+ *      ISO 8601 strings of one format sort lexically in time order, so the
+ *      range can be found with two binary searches that each read only
+ *      O(log n) single strings from the file. The rows with IsoTime0 <= t
+ *      <= IsoTime1 are *i0 to *i0+*n-1; these can then be read with
+ *      Lgm_HDF5_ReadHyperslab() from any of the other datasets. Set
+ *      IsoTime1 to NULL to just find IsoTime0 (*n is 1 if the file has that
+ *      exact time, 0 otherwise).
+ *
+ *      The times given must be in the same format as those in the file
+ *      (e.g. as made by Lgm_DateTimeToString( Str, &UTC, 0, 0 ) for MagEphem files).
+ *
+ *      \param[in]      file       An hdf5 file handle.
+ *      \param[in]      DataSet    The dataset in the HDF5 file (e.g. "/IsoTime" ).
+ *      \param[in]      IsoTime0   Start of the range.
+ *      \param[in]      IsoTime1   End of the range (inclusive), or NULL.
+ *      \param[out]     i0         First row in the range (the insertion point if the range is empty).
+ *      \param[out]     n          Number of rows in the range.
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_HDF5_FindIsoTimeRange( hid_t file, char *DataSet, char *IsoTime0, char *IsoTime1, hsize_t *i0, hsize_t *n ) {
+
+    hsize_t Dims[8], i1;
+    size_t  StrLen;
+    char    *Str;
+    int     Flag;
+
+    *i0 = 0; *n = 0;
+    if ( Lgm_HDF5_GetDims( file, DataSet, Dims ) != 1 ) {
+        printf("Lgm_HDF5_FindIsoTimeRange: dataset %s is missing or not rank 1\n", DataSet );
+        return( FALSE );
+    }
+    if ( ( StrLen = Lgm_HDF5_GetStringSize( file, DataSet ) ) < 1 ) {
+        printf("Lgm_HDF5_FindIsoTimeRange: dataset %s is not a string dataset\n", DataSet );
+        return( FALSE );
+    }
+    ++StrLen;
+    Str = (char *)calloc( StrLen, sizeof(char) );
+
+    if ( IsoTime1 == NULL ) IsoTime1 = IsoTime0;
+    Flag = IsoTimeBound( file, DataSet, Dims[0], StrLen, IsoTime0, FALSE, Str, i0 )
+        && IsoTimeBound( file, DataSet, Dims[0], StrLen, IsoTime1, TRUE,  Str, &i1 );
+    if ( Flag ) *n = ( i1 > *i0 ) ? i1 - *i0 : 0;
+
+    free( Str );
+    return( Flag );
+
+}
+
+
+/*
+ *  Creates an extendible dataset (zero "rows" of Dims[1..Rank-1]) chunked
+ *  along the rows. See CreateChunkedRank1DataSet().
+ */
+static hid_t CreateChunkedDataSet( hid_t File, char *DataSetName, int Rank, hsize_t *Dims, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace ){
+
+    int             i;
+    size_t          RowBytes;
+    hsize_t         MaxDims[4], ChunkDims[4], ChunkRows;
     hid_t           cparms, status, DataSet;
 
+    RowBytes = H5Tget_size( Type );
+    for ( i=1; i<Rank; i++ ) RowBytes *= Dims[i];
+
+    ChunkRows = ( RowBytes > 0 ) ? ChunkBytes/RowBytes : 1;
+    if ( ( MaxChunkRows > 0 ) && ( ChunkRows > MaxChunkRows ) ) ChunkRows = MaxChunkRows;
+    if ( ChunkRows < 1 ) ChunkRows = 1;
 
-    Rank         = 1;
     Dims[0]      = 0;
     MaxDims[0]   = H5S_UNLIMITED;
-    ChunkDims[0] = 1;
+    ChunkDims[0] = ChunkRows;
+    for ( i=1; i<Rank; i++ ) { MaxDims[i] = ChunkDims[i] = Dims[i]; }
     *DataSpace   = H5Screate_simple( Rank, Dims, MaxDims );
 
     cparms  = H5Pcreate( H5P_DATASET_CREATE );
     status  = H5Pset_chunk( cparms, Rank, ChunkDims );
+    if ( ( Deflate > 0 ) || Shuffle ) {
+        if ( H5Zfilter_avail( H5Z_FILTER_DEFLATE ) <= 0 ) {
+            printf("CreateChunkedDataSet: deflate filter not available, writing %s uncompressed.\n", DataSetName );
+        } else {
+            if ( Shuffle )     status = H5Pset_shuffle( cparms );
+            if ( Deflate > 0 ) status = H5Pset_deflate( cparms, ( Deflate > 9 ) ? 9 : Deflate );
+        }
+    }
 
     DataSet = H5Dcreate( File, DataSetName, Type, *DataSpace, H5P_DEFAULT, cparms, H5P_DEFAULT );
+    status  = H5Pclose( cparms );
 
 
     return( DataSet );
@@ -368,50 +699,168 @@ hid_t   CreateExtendableRank1DataSet( hid_t File, char *DataSetName, hid_t Type,
 }
 
 
-hid_t   CreateExtendableRank2DataSet( hid_t File, char *DataSetName, int Cols, hid_t Type, hid_t *DataSpace ){
+/**
+ *  \brief
+ *      Creates an extendible rank 1 dataset (with zero "rows") chunked and (optionally) compressed.
+ *
+ *  \details
+ *      The chunks hold as many rows as fit in ChunkBytes (but no more than
+ *      MaxChunkRows if that is > 0, and at least one). Datasets that are
+ *      written a row at a time with the LGM_HDF5_EXTEND_RANK*_DATASET()
+ *      macros should keep to one row per chunk (as
+ *      CreateExtendableRank1DataSet() does), since each write rewrites the
+ *      whole chunk. Datasets written in blocks of rows (e.g. with
+ *      Lgm_HDF5_AppendRows()) should use chunks of about a block. The
+ *      filters (if any) are transparent to readers such as
+ *      Get_DoubleDataset_1D().
+ *
+ *      \param[in]      File            An hdf5 file (or group) handle.
+ *      \param[in]      DataSetName     Name of the dataset to create.
+ *      \param[in]      Type            HDF5 type of the elements.
+ *      \param[in]      ChunkBytes      Target chunk size in bytes.
+ *      \param[in]      MaxChunkRows    Largest number of rows in a chunk (<= 0 for no limit).
+ *      \param[in]      Deflate         Deflate (gzip) level, 1-9. 0 for no compression.
+ *      \param[in]      Shuffle         If TRUE, apply the shuffle filter (before deflate).
+ *      \param[out]     DataSpace       Handle to the dataspace.
+ *
+ *      \return         Handle to the dataset. The user must close both the
+ *                      dataset and the dataspace handles when done.
+ *
+ */
+hid_t   CreateChunkedRank1DataSet( hid_t File, char *DataSetName, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace ){
+    hsize_t Dims[4];
+    return( CreateChunkedDataSet( File, DataSetName, 1, Dims, Type, ChunkBytes, MaxChunkRows, Deflate, Shuffle, DataSpace ) );
+}
 
-    int             Rank;
-    hsize_t         Dims[4], MaxDims[4], ChunkDims[4];
-    hid_t           cparms, status, DataSet;
+/**
+ *  \brief
+ *      Rank 2 (rows of Cols) version of CreateChunkedRank1DataSet().
+ */
+hid_t   CreateChunkedRank2DataSet( hid_t File, char *DataSetName, int Cols, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace ){
+    hsize_t Dims[4];
+    Dims[1] = Cols;
+    return( CreateChunkedDataSet( File, DataSetName, 2, Dims, Type, ChunkBytes, MaxChunkRows, Deflate, Shuffle, DataSpace ) );
+}
 
+/**
+ *  \brief
+ *      Rank 3 (rows of nCol x nDepth) version of CreateChunkedRank1DataSet().
+ */
+hid_t   CreateChunkedRank3DataSet( hid_t File, char *DataSetName, int nCol, int nDepth, hid_t Type, size_t ChunkBytes, hsize_t MaxChunkRows, int Deflate, int Shuffle, hid_t *DataSpace ){
+    hsize_t Dims[4];
+    Dims[1] = nCol; Dims[2] = nDepth;
+    return( CreateChunkedDataSet( File, DataSetName, 3, Dims, Type, ChunkBytes, MaxChunkRows, Deflate, Shuffle, DataSpace ) );
+}
 
-    Rank         = 2;
-    Dims[0]      = 0;               Dims[1]      = Cols;
-    MaxDims[0]   = H5S_UNLIMITED;   MaxDims[1]   = Cols;
-    ChunkDims[0] = 1;               ChunkDims[1] = Cols;
-    *DataSpace   = H5Screate_simple( Rank, Dims, MaxDims );
 
-    cparms  = H5Pcreate( H5P_DATASET_CREATE );
-    status  = H5Pset_chunk( cparms, Rank, ChunkDims );
+/*
+ *  Creates an extendible dataset (with zero "rows"). Returns handle to
+ *  dataset. Also returns handle to the dataspace.  Both of these need to be
+ *  closed by user when done. (E.g. H5Sclose( DataSpace ); and H5Dclose( DataSet ); )
+ *  These use one row per chunk (suited to writing a row at a time with the
+ *  LGM_HDF5_EXTEND_RANK*_DATASET() macros).
+ */
+hid_t   CreateExtendableRank1DataSet( hid_t File, char *DataSetName, hid_t Type, hid_t *DataSpace ){
+    return( CreateChunkedRank1DataSet( File, DataSetName, Type, 0, 1, 0, FALSE, DataSpace ) );
+}
 
-    DataSet = H5Dcreate( File, DataSetName, Type, *DataSpace, H5P_DEFAULT, cparms, H5P_DEFAULT );
 
+hid_t   CreateExtendableRank2DataSet( hid_t File, char *DataSetName, int Cols, hid_t Type, hid_t *DataSpace ){
+    return( CreateChunkedRank2DataSet( File, DataSetName, Cols, Type, 0, 1, 0, FALSE, DataSpace ) );
+}
 
-    return( DataSet );
 
+hid_t   CreateExtendableRank3DataSet( hid_t File, char *DataSetName, int nCol, int nDepth, hid_t Type, hid_t *DataSpace ){
+    return( CreateChunkedRank3DataSet( File, DataSetName, nCol, nDepth, Type, 0, 1, 0, FALSE, DataSpace ) );
 }
 
 
-hid_t   CreateExtendableRank3DataSet( hid_t File, char *DataSetName, int nCol, int nDepth, hid_t Type, hid_t *DataSpace ){
+/**
+ *  \brief
+ *      Write a block of rows into an extendible dataset, extending it as needed.
+ *
+ *  \details
+ *      Rows iRow to iRow+nRows-1 of the dataset are written from buf (nRows
+ *      contiguous rows of the dataset's row shape in MemType). This is the
+ *      block version of the LGM_HDF5_EXTEND_RANK*_DATASET() macros, and it
+ *      works for a dataset of any rank.
+ *
+ *      \param[in]      File            An hdf5 file (or group) handle.
+ *      \param[in]      DataSetName     Name of an existing extendible dataset.
+ *      \param[in]      iRow            First row to write.
+ *      \param[in]      nRows           Number of rows to write.
+ *      \param[in]      MemType         HDF5 type of the elements in buf.
+ *      \param[in]      buf             The rows to write.
+ *
+ *      \return         TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_HDF5_AppendRows( hid_t File, char *DataSetName, hsize_t iRow, hsize_t nRows, hid_t MemType, void *buf ) {
+    return( Lgm_HDF5_AppendRowsStrided( File, DataSetName, iRow, nRows, MemType, 0, buf ) );
+}
 
-    int             Rank;
-    hsize_t         Dims[4], MaxDims[4], ChunkDims[4];
-    hid_t           cparms, status, DataSet;
+/**
+ *  \brief
+ *      Lgm_HDF5_AppendRows() for rank 2 rows that are wider in memory than in the file.
+ *
+ *  \details
+ *      The rows in buf are MemCols elements apart, and only the first Cols
+ *      (the dataset's second dimension) of each are written. This is the
+ *      case for the per-pitch-angle arrays of Lgm_MagEphemData, which hold
+ *      room for more pitch angles than are used. MemCols <= Cols (or a
+ *      dataset other than rank 2) is the same as Lgm_HDF5_AppendRows().
+ *
+ *      \param[in]      MemCols         Row length of buf (elements).
+ *
+ */
+int Lgm_HDF5_AppendRowsStrided( hid_t File, char *DataSetName, hsize_t iRow, hsize_t nRows, hid_t MemType, hsize_t MemCols, void *buf ) {
 
+    int         i, Rank;
+    hsize_t     Dims[8], Offset[8], SlabSize[8];
+    hid_t       DataSet, DataSpace, MemSpace;
+    herr_t      status;
 
-    Rank         = 3;
-    Dims[0]      = 0;               Dims[1]      = nCol;   Dims[2]      = nDepth;
-    MaxDims[0]   = H5S_UNLIMITED;   MaxDims[1]   = nCol;   MaxDims[2]   = nDepth;
-    ChunkDims[0] = 1;               ChunkDims[1] = nCol;   ChunkDims[2] = nDepth;
-    *DataSpace   = H5Screate_simple( Rank, Dims, MaxDims );
+    if ( nRows < 1 ) return( TRUE );
 
-    cparms  = H5Pcreate( H5P_DATASET_CREATE );
-    status  = H5Pset_chunk( cparms, Rank, ChunkDims );
+    if ( ( DataSet = H5Dopen( File, DataSetName, H5P_DEFAULT ) ) < 0 ) {
+        printf("Lgm_HDF5_AppendRows: could not open dataset %s\n", DataSetName );
+        return( FALSE );
+    }
+    DataSpace = H5Dget_space( DataSet );
+    Rank      = H5Sget_simple_extent_ndims( DataSpace );
+    if ( ( Rank < 1 ) || ( Rank > 8 ) ) {
+        printf("Lgm_HDF5_AppendRows: dataset %s has unsupported rank %d\n", DataSetName, Rank );
+        H5Sclose( DataSpace ); H5Dclose( DataSet );
+        return( FALSE );
+    }
+    H5Sget_simple_extent_dims( DataSpace, Dims, NULL );
+    H5Sclose( DataSpace );
 
-    DataSet = H5Dcreate( File, DataSetName, Type, *DataSpace, H5P_DEFAULT, cparms, H5P_DEFAULT );
+    if ( Dims[0] < iRow+nRows ) {
+        Dims[0] = iRow+nRows;
+        status  = H5Dset_extent( DataSet, Dims );
+    }
 
+    Offset[0] = iRow; SlabSize[0] = nRows;
+    for ( i=1; i<Rank; i++ ) { Offset[i] = 0; SlabSize[i] = Dims[i]; }
+
+    DataSpace = H5Dget_space( DataSet );
+    status    = H5Sselect_hyperslab( DataSpace, H5S_SELECT_SET, Offset, NULL, SlabSize, NULL );
+    if ( ( Rank == 2 ) && ( MemCols > Dims[1] ) ) {
+        hsize_t MemDims[2], MemOffset[2] = { 0, 0 };
+        MemDims[0] = nRows; MemDims[1] = MemCols;
+        MemSpace  = H5Screate_simple( Rank, MemDims, NULL );
+        status    = H5Sselect_hyperslab( MemSpace, H5S_SELECT_SET, MemOffset, NULL, SlabSize, NULL );
+    } else {
+        MemSpace  = H5Screate_simple( Rank, SlabSize, NULL );
+    }
+    status    = H5Dwrite( DataSet, MemType, MemSpace, DataSpace, H5P_DEFAULT, buf );
 
-    return( DataSet );
+    H5Sclose( MemSpace );
+    H5Sclose( DataSpace );
+    H5Dclose( DataSet );
+
+    return( ( status < 0 ) ? FALSE : TRUE );
 
 }
 
@@ -560,7 +560,7 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
     double          r, Theta, Phi, B_r, B_theta, B_phi;
     double          st, ct, sp, cp, t, gnm, hnm, Knm;
     double          val, val2, val3, Cmp_m, Smp_m, Cmp[14], Smp[14], f2[14], rinv, Pnn[14], dPnn[14];
-    int             N;
+    int             N, Nmax;
     register double P_n_m, P_nm1_m, P_nm1_mm1, P_nm2_m;
     register double dP_n_m, dP_nm1_m, dP_nm1_mm1, dP_nm2_m;
     register int    n, m;
@@ -571,6 +571,12 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
     N = 13;
     Lgm_InitIGRF( c->Lgm_IGRF_g, c->Lgm_IGRF_h, N, c->Lgm_IGRF_FirstCall, c);
 
+    /*
+     *  Highest degree we actually need to sum to at this radius (this is
+     *  just N unless truncation has been turned on).
+     */
+    Nmax = Lgm_IGRF_TruncDegree( v->x, N, c );
+
 
 
     /*
@@ -592,7 +598,7 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
      */
     st = sin( v->y ); ct = cos( v->y);
     sp = sin( v->z ); cp = cos( v->z );
-    Lgm_InitTrigmp( cp, sp, Cmp, Smp, N );
+    Lgm_InitTrigmp( cp, sp, Cmp, Smp, Nmax );
 
 
 
@@ -602,7 +608,7 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
     rinv = 1.0/v->x;
     f2[0] = t = rinv*rinv; // f2[0] is never used(?)
 
-    for (n=1; n<=N; ++n){
+    for (n=1; n<=Nmax; ++n){
         t *= rinv;
         f2[n] = t;
     }
@@ -653,7 +659,7 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
     // precompute P_n_n's and dP_n_n's
     Pnn[0] = P_nm1_mm1 = 1.0;
     dPnn[0] = dP_nm1_mm1 = 0.0;
-    for ( m=1; m<= N; ++m ) {
+    for ( m=1; m<= Nmax; ++m ) {
         Pnn[m] = st*P_nm1_mm1;
         dPnn[m] = st*dP_nm1_mm1 + ct*P_nm1_mm1;
         P_nm1_mm1  = Pnn[m]; dP_nm1_mm1 = dPnn[m];
@@ -663,14 +669,14 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
     // initialize sums
     B_r = B_theta = B_phi = 0.0;
 
-    for ( m=0; m<= N; ++m ) {
+    for ( m=0; m<= Nmax; ++m ) {
 
         P_n_m    = Pnn[m];
         dP_n_m   = dPnn[m];
         P_nm1_m  = P_n_m;  P_nm2_m   = 0.0;
         dP_nm1_m = dP_n_m; dP_nm2_m  = 0.0;
 
-        for ( n=m; n<= N; ++n ) {
+        for ( n=m; n<= Nmax; ++n ) {
 
             gnm = c->Lgm_IGRF_g[n][m];
             hnm = c->Lgm_IGRF_h[n][m];
@@ -711,6 +717,362 @@ void    _Lgm_IGRF4( Lgm_Vector *v, Lgm_Vector *B, Lgm_CTrans *c ) {
 
 
 
+/*
+ *  Multi-point version of _Lgm_IGRF4. The recurrences are identical, but they
+ *  are run on LGM_IGRF_VLEN points at once with the point index innermost so
+ *  that the compiler can map each lane onto a SIMD register. The operations
+ *  are done in the same order as in _Lgm_IGRF4, so (without -ffast-math) the
+ *  results are the same to the last bit. (If IGRF truncation is on, the
+ *  degree is picked from the innermost point of the block, so it can differ
+ *  from the scalar routine by up to the truncation tolerance.)
+ *
+ *  On x86_64 Linux with gcc we let the compiler build AVX-512, AVX2 and
+ *  generic clones of the kernel and pick one at load time based on the CPU.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) && defined(__x86_64__) && defined(__linux__)
+#define LGM_IGRF_TARGET_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define LGM_IGRF_TARGET_CLONES
+#endif
+
+LGM_IGRF_TARGET_CLONES
+static void _Lgm_IGRF4_Block( const double *r, const double *st, const double *ct, const double *sp, const double *cp,
+                              double *B_r, double *B_theta, double *B_phi, int N, Lgm_CTrans *c ) {
+
+    double          Cmp[14][LGM_IGRF_VLEN], Smp[14][LGM_IGRF_VLEN], f2[14][LGM_IGRF_VLEN];
+    double          Pnn[14][LGM_IGRF_VLEN], dPnn[14][LGM_IGRF_VLEN];
+    double          P_n_m[LGM_IGRF_VLEN], P_nm1_m[LGM_IGRF_VLEN], P_nm2_m[LGM_IGRF_VLEN];
+    double          dP_n_m[LGM_IGRF_VLEN], dP_nm1_m[LGM_IGRF_VLEN], dP_nm2_m[LGM_IGRF_VLEN];
+    double          Br[LGM_IGRF_VLEN], Bt[LGM_IGRF_VLEN], Bp[LGM_IGRF_VLEN];
+    double          b, t, rinv, gnm, hnm, Knm, Snm, val, val2, val3, fm, fnp1;
+    int             n, m, k;
+
+
+    /*
+     *  cos(m phi), sin(m phi) via the same recurrences as Lgm_InitTrigmp()
+     *  and f2_n = (1/r)^(n+2).
+     */
+    for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+        Cmp[0][k] = 1.0; Cmp[1][k] = cp[k];
+        Smp[0][k] = 0.0; Smp[1][k] = sp[k];
+        rinv = 1.0/r[k];
+        f2[0][k] = t = rinv*rinv;
+        for ( n=1; n<=N; ++n ) { t *= rinv; f2[n][k] = t; }
+    }
+    for ( m=2; m<=N; ++m ) {
+        for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+            b = 2.0*cp[k];
+            Cmp[m][k] = b*Cmp[m-1][k] - Cmp[m-2][k];
+            Smp[m][k] = b*Smp[m-1][k] - Smp[m-2][k];
+        }
+    }
+
+    /*
+     *  P_n_n's and dP_n_n's
+     */
+    for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+        Pnn[0][k] = 1.0; dPnn[0][k] = 0.0;
+        Br[k] = Bt[k] = Bp[k] = 0.0;
+    }
+    for ( m=1; m<=N; ++m ) {
+        for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+            Pnn[m][k]  = st[k]*Pnn[m-1][k];
+            dPnn[m][k] = st[k]*dPnn[m-1][k] + ct[k]*Pnn[m-1][k];
+        }
+    }
+
+
+    /*
+     *  Same sums as in _Lgm_IGRF4, but with the n == m term peeled off so
+     *  that the lane loops have no branches in them.
+     */
+    for ( m=0; m<=N; ++m ) {
+
+        fm = (double)m;
+
+        for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+            P_nm1_m[k]  = Pnn[m][k];  P_nm2_m[k]  = 0.0;
+            dP_nm1_m[k] = dPnn[m][k]; dP_nm2_m[k] = 0.0;
+        }
+
+        if ( m > 0 ) {
+            gnm = c->Lgm_IGRF_g[m][m];
+            hnm = c->Lgm_IGRF_h[m][m];
+            Snm = c->Lgm_IGRF_S[m][m];
+            fnp1 = (double)(m+1);
+            for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+                val  = gnm*Cmp[m][k] + hnm*Smp[m][k];
+                val2 = Snm*f2[m][k];
+                val3 = val2 * val;
+                Br[k] += (val3*fnp1*Pnn[m][k]);
+                Bt[k] += (val3*dPnn[m][k]);
+                Bp[k] += (val2 * fm*(-gnm*Smp[m][k] + hnm*Cmp[m][k])*Pnn[m][k]);
+            }
+        }
+
+        for ( n=m+1; n<=N; ++n ) {
+
+            gnm = c->Lgm_IGRF_g[n][m];
+            hnm = c->Lgm_IGRF_h[n][m];
+            Knm = c->Lgm_IGRF_K[n][m];
+            Snm = c->Lgm_IGRF_S[n][m];
+            fnp1 = (double)(n+1);
+
+            for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+
+                P_n_m[k]  = ct[k]*P_nm1_m[k] - Knm*P_nm2_m[k];
+                dP_n_m[k] = ct[k]*dP_nm1_m[k] - st[k]*P_nm1_m[k] - Knm*dP_nm2_m[k];
+                P_nm2_m[k]  = P_nm1_m[k];  P_nm1_m[k]  = P_n_m[k];
+                dP_nm2_m[k] = dP_nm1_m[k]; dP_nm1_m[k] = dP_n_m[k];
+
+                val  = gnm*Cmp[m][k] + hnm*Smp[m][k];
+                val2 = Snm*f2[n][k];
+                val3 = val2 * val;
+
+                Br[k] += (val3*fnp1*P_n_m[k]);
+                Bt[k] += (val3*dP_n_m[k]);
+                Bp[k] += (val2 * fm*(-gnm*Smp[m][k] + hnm*Cmp[m][k])*P_n_m[k]);
+
+            }
+
+        }
+    }
+
+    for ( k=0; k<LGM_IGRF_VLEN; ++k ) {
+        B_r[k]     =  Br[k];
+        B_theta[k] = -Bt[k];
+        B_phi[k]   = -Bp[k]/st[k];
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Evaluate the IGRF field at many points.
+ *
+ *  \details
+ *      Multi-point version of Lgm_IGRF(). Inputs and outputs are the same as
+ *      for Lgm_IGRF() (i.e. spherical geocentric (r, theta, phi) in, and
+ *      spherical components (B_r, B_theta, B_phi) out), but for arrays of
+ *      points. The points are evaluated LGM_IGRF_VLEN at a time by a SIMD
+ *      kernel. Points very close to the poles are handed to Lgm_IGRF() so
+ *      that they get the same pole treatment as the scalar routine.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      vin         Array of n positions (r in Re, theta and phi in radians).
+ *      \param[out]     B           Array of n field values (B_r, B_theta, B_phi) in nT.
+ *      \param[in,out]  c           A properly initialized Lgm_CTrans structure.
+ *
+ */
+void Lgm_IGRF_Multi( int n, Lgm_Vector *vin, Lgm_Vector *B, Lgm_CTrans *c ) {
+
+    double      r[LGM_IGRF_VLEN], st[LGM_IGRF_VLEN], ct[LGM_IGRF_VLEN], sp[LGM_IGRF_VLEN], cp[LGM_IGRF_VLEN];
+    double      Br[LGM_IGRF_VLEN], Bt[LGM_IGRF_VLEN], Bp[LGM_IGRF_VLEN], rmin;
+    int         idx[LGM_IGRF_VLEN], i, k, nb;
+
+    if ( n <= 0 ) return;
+
+    /*
+     *  Do the same coefficient setup that _Lgm_IGRF4 does on every call.
+     */
+    Lgm_InitIGRF( c->Lgm_IGRF_g, c->Lgm_IGRF_h, 13, c->Lgm_IGRF_FirstCall, c);
+    if ( c->Lgm_IGRF_FirstCall ) {
+        Lgm_InitK( c->Lgm_IGRF_K, 13 );
+        Lgm_InitS( c->Lgm_IGRF_S, 13 );
+        c->Lgm_IGRF_FirstCall = FALSE;
+    }
+
+    for ( nb=0, i=0; i<n; ++i ) {
+
+        if ( fabs( vin[i].y*RadPerDeg ) < 1e-4 ) {
+            // near the pole -- let the scalar routine deal with it
+            Lgm_IGRF( &vin[i], &B[i], c );
+        } else {
+            // rescale r to units of IGRF_Re (see comments in Lgm_IGRF())
+            r[nb]  = vin[i].x*Re/IGRF_Re;
+            st[nb] = sin( vin[i].y ); ct[nb] = cos( vin[i].y );
+            sp[nb] = sin( vin[i].z ); cp[nb] = cos( vin[i].z );
+            idx[nb++] = i;
+        }
+
+        if ( (nb == LGM_IGRF_VLEN) || ((i == n-1) && (nb > 0)) ) {
+
+            // pad out a partial block with copies of the last point
+            for ( k=nb; k<LGM_IGRF_VLEN; ++k ) {
+                r[k] = r[nb-1]; st[k] = st[nb-1]; ct[k] = ct[nb-1]; sp[k] = sp[nb-1]; cp[k] = cp[nb-1];
+            }
+
+            // if truncating, the innermost point of the block sets the degree
+            for ( rmin=r[0], k=1; k<nb; ++k ) if ( r[k] < rmin ) rmin = r[k];
+
+            _Lgm_IGRF4_Block( r, st, ct, sp, cp, Br, Bt, Bp, Lgm_IGRF_TruncDegree( rmin, 13, c ), c );
+
+            for ( k=0; k<nb; ++k ) {
+                B[idx[k]].x = Br[k]; B[idx[k]].y = Bt[k]; B[idx[k]].z = Bp[k];
+            }
+            nb = 0;
+
+        }
+
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Evaluate the IGRF field and its partial derivatives.
+ *
+ *  \details
+ *      Same inputs and outputs as Lgm_IGRF() (spherical geocentric (r, theta,
+ *      phi) in, and spherical components (B_r, B_theta, B_phi) out), but
+ *      the derivatives of the spherical components with respect to the
+ *      spherical coordinates are also returned. I.e.
+ *
+ *          dB[i][j] = d B_i / d q_j,   B = (B_r, B_theta, B_phi),  q = (r, theta, phi)
+ *
+ *      with r in Re. The sums are the same as in _Lgm_IGRF4(). The second
+ *      theta derivatives of the associated Legendre functions come from
+ *      Legendre's equation,
+ *
+ *          d2P/dtheta2 = -cot(theta) dP/dtheta - ( n(n+1) - m^2/sin^2(theta) ) P
+ *
+ *      which is singular at the poles. So very close to the poles nothing is
+ *      computed and FALSE is returned; callers should fall back on
+ *      differencing Lgm_IGRF() there.
+ *
+ *      \param[in]      vin         Position (r in Re, theta and phi in radians).
+ *      \param[out]     B           Field (B_r, B_theta, B_phi) in nT.
+ *      \param[out]     dB          Partial derivatives (nT/Re, nT/rad).
+ *      \param[in,out]  c           A properly initialized Lgm_CTrans structure.
+ *
+ *      \return         TRUE on success, FALSE if too close to a pole.
+ *
+ */
+int Lgm_IGRF_Derivs( Lgm_Vector *vin, Lgm_Vector *B, double dB[3][3], Lgm_CTrans *c ) {
+
+    double          st, ct, sp, cp, cot, oost2, t, f, rinv, gnm, hnm, Knm;
+    double          val, valp, val2, fr, ddP, Cmp[14], Smp[14], f2[14], Pnn[14], dPnn[14];
+    double          Br, St, Sp, Br_r, Br_t, Br_p, St_r, St_t, St_p, Sp_r, Sp_t, Sp_p;
+    double          P_n_m, P_nm1_m, P_nm1_mm1, P_nm2_m;
+    double          dP_n_m, dP_nm1_m, dP_nm1_mm1, dP_nm2_m;
+    int             N, Nmax, n, m;
+
+    st = sin( vin->y ); ct = cos( vin->y );
+    if ( fabs( st ) < 1e-4 ) return( FALSE );
+    sp = sin( vin->z ); cp = cos( vin->z );
+    cot   = ct/st;
+    oost2 = 1.0/(st*st);
+
+    N = 13;
+    Lgm_InitIGRF( c->Lgm_IGRF_g, c->Lgm_IGRF_h, N, c->Lgm_IGRF_FirstCall, c);
+    if ( c->Lgm_IGRF_FirstCall ) {
+        Lgm_InitK( c->Lgm_IGRF_K, N );
+        Lgm_InitS( c->Lgm_IGRF_S, N );
+    }
+
+
+    /*
+     *  f2_n = (1/r)^(n+2) with r in units of IGRF_Re (see comments in Lgm_IGRF())
+     */
+    rinv = IGRF_Re/(vin->x*Re);
+    Nmax = Lgm_IGRF_TruncDegree( 1.0/rinv, N, c );
+    Lgm_InitTrigmp( cp, sp, Cmp, Smp, Nmax );
+    f2[0] = t = rinv*rinv;
+    for (n=1; n<=Nmax; ++n){
+        t *= rinv;
+        f2[n] = t;
+    }
+
+
+    // precompute P_n_n's and dP_n_n's
+    Pnn[0] = P_nm1_mm1 = 1.0;
+    dPnn[0] = dP_nm1_mm1 = 0.0;
+    for ( m=1; m<= Nmax; ++m ) {
+        Pnn[m] = st*P_nm1_mm1;
+        dPnn[m] = st*dP_nm1_mm1 + ct*P_nm1_mm1;
+        P_nm1_mm1  = Pnn[m]; dP_nm1_mm1 = dPnn[m];
+    }
+
+
+    /*
+     *  Br = B_r, St = -B_theta, Sp = -B_phi*sin(theta), and their derivatives
+     *  (the _r derivatives are with respect to r in units of IGRF_Re).
+     */
+    Br = St = Sp = 0.0;
+    Br_r = Br_t = Br_p = 0.0;
+    St_r = St_t = St_p = 0.0;
+    Sp_r = Sp_t = Sp_p = 0.0;
+
+    for ( m=0; m<= Nmax; ++m ) {
+
+        P_n_m    = Pnn[m];
+        dP_n_m   = dPnn[m];
+        P_nm1_m  = P_n_m;  P_nm2_m   = 0.0;
+        dP_nm1_m = dP_n_m; dP_nm2_m  = 0.0;
+
+        for ( n=m; n<= Nmax; ++n ) {
+
+            gnm = c->Lgm_IGRF_g[n][m];
+            hnm = c->Lgm_IGRF_h[n][m];
+
+            if ( n != m ) {
+                Knm = c->Lgm_IGRF_K[n][m];
+                P_n_m = ct*P_nm1_m - Knm*P_nm2_m;
+                dP_n_m = ct*dP_nm1_m - st*P_nm1_m - Knm*dP_nm2_m;
+                P_nm2_m  = P_nm1_m;  P_nm1_m  = P_n_m;
+                dP_nm2_m = dP_nm1_m; dP_nm1_m = dP_n_m;
+            }
+
+            if ( n > 0 ){
+                val  = gnm*Cmp[m] + hnm*Smp[m];
+                valp = m*(-gnm*Smp[m] + hnm*Cmp[m]);    // d(val)/dphi
+                val2 = c->Lgm_IGRF_S[n][m]*f2[n];
+                fr   = -(n+2)*rinv;                     // d(f2_n)/dr / f2_n
+                ddP  = -cot*dP_n_m - (n*(n+1) - m*m*oost2)*P_n_m;
+
+                t     = val2*(n+1)*val*P_n_m;
+                Br   += t;
+                Br_r += fr*t;
+                Br_t += val2*(n+1)*val*dP_n_m;
+                Br_p += val2*(n+1)*valp*P_n_m;
+
+                t     = val2*val*dP_n_m;
+                St   += t;
+                St_r += fr*t;
+                St_t += val2*val*ddP;
+                St_p += val2*valp*dP_n_m;
+
+                t     = val2*valp*P_n_m;
+                Sp   += t;
+                Sp_r += fr*t;
+                Sp_t += val2*valp*dP_n_m;
+                Sp_p -= val2*m*m*val*P_n_m;
+            }
+
+        }
+    }
+
+    c->Lgm_IGRF_FirstCall = FALSE;
+
+    B->x = Br;
+    B->y = -St;
+    B->z = -Sp/st;
+
+    f = Re/IGRF_Re; // d/dr (r in Re) = f d/dr (r in IGRF_Re)
+    dB[0][0] =  f*Br_r;    dB[0][1] =  Br_t;                 dB[0][2] =  Br_p;
+    dB[1][0] = -f*St_r;    dB[1][1] = -St_t;                 dB[1][2] = -St_p;
+    dB[2][0] = -f*Sp_r/st; dB[2][1] = (Sp*cot - Sp_t)/st;    dB[2][2] = -Sp_p/st;
+
+    return( TRUE );
+
+}
+
+
+
+
+
 void Lgm_InitPnm( double ct, double st, double R[14][14], double P[14][14], double dP[14][14], int N, Lgm_CTrans *c ) {
 
     double         Pmm, Pmp1m, Pnm, Pnm1m, Pnm2m, a, b, f, x, x2;
@@ -1016,12 +1378,239 @@ void Lgm_InitK( double K[14][14], int N ) {
 }
 
 
+/*
+ *  Process-wide cache of time-interpolated IGRF coefficients.
+ *
+ *  Entries are keyed on (Year, N) where Year is the decimal year after it has
+ *  been rounded to the tolerance c->Lgm_IGRF_CacheTol. Each entry also holds
+ *  the quantities that Lgm_InitIGRF() derives from the coefficients (dipole
+ *  moment, CD pole location and ED offset), so a hit replaces all of the work
+ *  in Lgm_InitIGRF(). Entries are only ever read or written inside the
+ *  Lgm_IGRF_Cache critical section, and hits are copied out, so the cache can
+ *  be shared by any number of threads.
+ */
+#define LGM_IGRF_CACHE_SIZE 64
+typedef struct Lgm_IGRF_CacheEntry {
+    double  Year;
+    int     N;
+    double  g[14][14];
+    double  h[14][14];
+    double  M_cd, CD_gcolat, CD_glon;
+    double  ED_x0, ED_y0, ED_z0;
+} Lgm_IGRF_CacheEntry;
+
+static Lgm_IGRF_CacheEntry  Lgm_IGRF_Cache[LGM_IGRF_CACHE_SIZE];
+static int                  Lgm_IGRF_Cache_nEntries = 0;
+static int                  Lgm_IGRF_Cache_Next     = 0;
+static long int             Lgm_IGRF_Cache_nHits    = 0;
+static long int             Lgm_IGRF_Cache_nMisses  = 0;
+
+
+/*
+ *  Look for (Year, N) in the cache. If found, copy it into g, h and c and return TRUE.
+ */
+static int Lgm_IGRF_CacheFind( double Year, int N, double g[14][14], double h[14][14], Lgm_CTrans *c ) {
+
+    int i, Found = FALSE;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_IGRF_Cache)
+#endif
+    {
+        for ( i=0; i<Lgm_IGRF_Cache_nEntries; ++i ) {
+            if ( (Lgm_IGRF_Cache[i].N == N) && (Lgm_IGRF_Cache[i].Year == Year) ) {
+                memcpy( g, Lgm_IGRF_Cache[i].g, 14*14*sizeof(double) );
+                memcpy( h, Lgm_IGRF_Cache[i].h, 14*14*sizeof(double) );
+                c->M_cd      = Lgm_IGRF_Cache[i].M_cd;
+                c->M_cd_McIllwain = 31165.3;
+                c->M_cd_2010      = 29950.1686985232;
+                c->CD_gcolat = Lgm_IGRF_Cache[i].CD_gcolat;
+                c->CD_glon   = Lgm_IGRF_Cache[i].CD_glon;
+                c->ED_x0     = Lgm_IGRF_Cache[i].ED_x0;
+                c->ED_y0     = Lgm_IGRF_Cache[i].ED_y0;
+                c->ED_z0     = Lgm_IGRF_Cache[i].ED_z0;
+                Found = TRUE;
+                break;
+            }
+        }
+        if ( Found ) ++Lgm_IGRF_Cache_nHits;
+        else         ++Lgm_IGRF_Cache_nMisses;
+    }
+
+    return( Found );
+
+}
+
+/*
+ *  Add (Year, N) to the cache. When the cache is full the oldest entry is replaced.
+ */
+static void Lgm_IGRF_CacheAdd( double Year, int N, double g[14][14], double h[14][14], Lgm_CTrans *c ) {
+
+    Lgm_IGRF_CacheEntry *e;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_IGRF_Cache)
+#endif
+    {
+        e = &Lgm_IGRF_Cache[ Lgm_IGRF_Cache_Next ];
+        e->Year      = Year;
+        e->N         = N;
+        memcpy( e->g, g, 14*14*sizeof(double) );
+        memcpy( e->h, h, 14*14*sizeof(double) );
+        e->M_cd      = c->M_cd;
+        e->CD_gcolat = c->CD_gcolat;
+        e->CD_glon   = c->CD_glon;
+        e->ED_x0     = c->ED_x0;
+        e->ED_y0     = c->ED_y0;
+        e->ED_z0     = c->ED_z0;
+        Lgm_IGRF_Cache_Next = (Lgm_IGRF_Cache_Next+1)%LGM_IGRF_CACHE_SIZE;
+        if ( Lgm_IGRF_Cache_nEntries < LGM_IGRF_CACHE_SIZE ) ++Lgm_IGRF_Cache_nEntries;
+    }
+
+}
+
+/**
+ *  \brief
+ *      Set the time tolerance used to key the IGRF coefficient cache.
+ *
+ *  \details
+ *      When dYear > 0, Lgm_InitIGRF() rounds the decimal year to the nearest
+ *      multiple of dYear, and re-uses the interpolated coefficients (from a
+ *      process-wide cache) for every time that rounds to the same value. E.g.
+ *      dYear = 1.0/365.25 gives one set of coefficients per day. When dYear
+ *      is <= 0 (the default) the cache is not used and the coefficients are
+ *      interpolated to the exact time as before.
+ *
+ *      \param[in]      dYear       Tolerance in years.
+ *      \param[in,out]  c           Lgm_CTrans structure.
+ *
+ */
+void Lgm_Set_IGRF_CacheTolerance( double dYear, Lgm_CTrans *c ) {
+    c->Lgm_IGRF_CacheTol = dYear;
+    c->Lgm_IGRF_FirstCall = TRUE; // force coefficients to be re-evaluated
+}
+
+/**
+ *  \brief
+ *      Empty the process-wide IGRF coefficient cache.
+ */
+void Lgm_IGRF_ClearCache( ) {
+#if USE_OPENMP
+    #pragma omp critical (Lgm_IGRF_Cache)
+#endif
+    {
+        Lgm_IGRF_Cache_nEntries = 0;
+        Lgm_IGRF_Cache_Next     = 0;
+        Lgm_IGRF_Cache_nHits    = 0;
+        Lgm_IGRF_Cache_nMisses  = 0;
+    }
+}
+
+/**
+ *  \brief
+ *      Return the number of hits and misses in the IGRF coefficient cache.
+ */
+void Lgm_IGRF_CacheStats( long int *nHits, long int *nMisses ) {
+#if USE_OPENMP
+    #pragma omp critical (Lgm_IGRF_Cache)
+#endif
+    {
+        *nHits   = Lgm_IGRF_Cache_nHits;
+        *nMisses = Lgm_IGRF_Cache_nMisses;
+    }
+}
+
+
+/*
+ *  Per-degree amplitudes of the field at r = IGRF_Re,
+ *
+ *      A_n = sqrt( (2n+1) R_n ),   R_n = (n+1) sum_m ( g_nm^2 + h_nm^2 )
+ *
+ *  R_n is the Lowes-Mauersberger spectrum (the mean square field of degree n
+ *  over the sphere). The extra (2n+1) turns the rms value into a
+ *  conservative bound on the field of degree n at any point. At radius r
+ *  it falls off as A_n (1/r)^(n+2).
+ */
+static void Lgm_IGRF_InitSpectrum( double g[14][14], double h[14][14], int N, Lgm_CTrans *c ) {
+
+    double  s;
+    int     n, m;
+
+    c->Lgm_IGRF_Spectrum[0] = 0.0;
+    for ( n=1; n<14; ++n ) {
+        for ( s=0.0, m=0; (m<=n) && (n<=N); ++m ) s += g[n][m]*g[n][m] + h[n][m]*h[n][m];
+        c->Lgm_IGRF_Spectrum[n] = sqrt( (2.0*n+1.0)*(n+1.0)*s );
+    }
+
+}
+
+/**
+ *  \brief
+ *      Turn radius-adaptive truncation of the IGRF sums on or off.
+ *
+ *  \details
+ *      When Tol > 0, the IGRF routines only sum to the highest degree that is
+ *      needed to keep the (estimated) error in |B| below Tol nT at the radius
+ *      of each point (see Lgm_IGRF_TruncDegree()). Since the degree n terms
+ *      fall off as r^-(n+2), this gets close to dipole cost in the outer
+ *      magnetosphere. When Tol <= 0 (the default) the sums always go to full
+ *      degree.
+ *
+ *      \param[in]      Tol         Allowed error in nT.
+ *      \param[in,out]  c           Lgm_CTrans structure.
+ *
+ */
+void Lgm_Set_IGRF_Truncation( double Tol, Lgm_CTrans *c ) {
+    c->Lgm_IGRF_TruncTol = Tol;
+}
+
+/**
+ *  \brief
+ *      Return the IGRF degree needed at a given radius.
+ *
+ *  \details
+ *      Returns the smallest degree Nmax <= N such that the sum of the
+ *      per-degree bounds A_n (1/r)^(n+2) for Nmax < n <= N is no more than
+ *      c->Lgm_IGRF_TruncTol. Returns N if truncation is off. The
+ *      coefficients must already have been set up with Lgm_InitIGRF().
+ *
+ *      \param[in]      r           Radius in units of IGRF_Re.
+ *      \param[in]      N           Full degree of the model.
+ *      \param[in]      c           Lgm_CTrans structure.
+ *
+ *      \return         Degree to sum to.
+ *
+ */
+int Lgm_IGRF_TruncDegree( double r, int N, Lgm_CTrans *c ) {
+
+    double  rinv, f, Err;
+    int     n;
+
+    if ( c->Lgm_IGRF_TruncTol <= 0.0 ) return( N );
+
+    /*
+     *  Add up the bounds from the top down and stop at the first degree that
+     *  would push us past the tolerance.
+     */
+    rinv = 1.0/r;
+    for ( f=rinv*rinv, n=1; n<=N; ++n ) f *= rinv;  // f = (1/r)^(N+2)
+    for ( Err=0.0, n=N; n>1; --n ) {
+        Err += c->Lgm_IGRF_Spectrum[n]*f;
+        if ( Err > c->Lgm_IGRF_TruncTol ) return( n );
+        f *= r;
+    }
+
+    return( 1 );
+
+}
+
+
 void Lgm_InitIGRF( double g[14][14], double h[14][14], int N, int Flag, Lgm_CTrans *c ){
 
     double          Year;
     double          g0, g1, h0, h1, gs, hs, y0, y1;
     double          H0, H02, Lx, Ly, Lz, E;
-    int             j, j0, j1, n, m;
+    int             j, j0, j1, n, m, UseCache;
 
 
     /* Get Year from Lgm_CTrans structure */
@@ -1031,12 +1620,24 @@ void Lgm_InitIGRF( double g[14][14], double h[14][14], int N, int Flag, Lgm_CTra
         exit(-1);
     }
 
+    /*
+     *  If we are caching, snap Year to the cache grid.
+     */
+    UseCache = ( c->Lgm_IGRF_CacheTol > 0.0 );
+    if ( UseCache ) Year = floor( Year/c->Lgm_IGRF_CacheTol + 0.5 )*c->Lgm_IGRF_CacheTol;
+
 
     /*
      *  Set IGRF Model based on the current epoch.
      */
     if ( (fabs(Year - c->Lgm_IGRF_OldYear) > 0.0) || Flag ) {
 
+        if ( UseCache && Lgm_IGRF_CacheFind( Year, N, g, h, c ) ) {
+            Lgm_IGRF_InitSpectrum( g, h, N, c );
+            c->Lgm_IGRF_OldYear = Year;
+            return;
+        }
+
 
         if ((Year >= IGRF_epoch[0])&&(Year <= IGRF_epoch[IGRF_nModels-1])) {
 
@@ -1118,6 +1719,10 @@ void Lgm_InitIGRF( double g[14][14], double h[14][14], int N, int Flag, Lgm_CTra
         c->ED_y0 = (Ly-h[1][1]*E)/(3.0*H02); // in units of Re
         c->ED_z0 = (Lz-g[1][0]*E)/(3.0*H02); // in units of Re
 
+        Lgm_IGRF_InitSpectrum( g, h, N, c );
+
+        if ( UseCache ) Lgm_IGRF_CacheAdd( Year, N, g, h, c );
+
     } 
 
     c->Lgm_IGRF_OldYear = Year;
@@ -34,17 +34,36 @@ void Lgm_SetMagEphemLstarQuality( int Quality, int nFLsInDriftShell, Lgm_MagEphe
 
 
 
-void Lgm_InitMagEphemInfoDefaults( Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchAngles, int Verbosity ) {
+/*
+ *  Set the pointers to the drift shell arrays to NULL (without freeing
+ *  anything).
+ */
+static void ClearShellPointers( Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    MagEphemInfo->ShellSphericalFootprint_Pn = MagEphemInfo->ShellSphericalFootprint_Ps = NULL;
+    MagEphemInfo->ShellEllipsoidFootprint_Pn = MagEphemInfo->ShellEllipsoidFootprint_Ps = NULL;
+    MagEphemInfo->ShellSphericalFootprint_Sn = MagEphemInfo->ShellSphericalFootprint_Ss = NULL;
+    MagEphemInfo->ShellSphericalFootprint_Bn = MagEphemInfo->ShellSphericalFootprint_Bs = NULL;
+    MagEphemInfo->ShellEllipsoidFootprint_Sn = MagEphemInfo->ShellEllipsoidFootprint_Ss = NULL;
+    MagEphemInfo->ShellEllipsoidFootprint_Bn = MagEphemInfo->ShellEllipsoidFootprint_Bs = NULL;
+    MagEphemInfo->ShellMirror_Pn = MagEphemInfo->ShellMirror_Ps = NULL;
+    MagEphemInfo->ShellMirror_Sn = MagEphemInfo->ShellMirror_Ss = MagEphemInfo->ShellI = NULL;
+    MagEphemInfo->Shell_Bmin = MagEphemInfo->Shell_Pmin = MagEphemInfo->Shell_GradI = MagEphemInfo->Shell_Vgc = NULL;
+    MagEphemInfo->nMinima = MagEphemInfo->nMaxima = MagEphemInfo->nFieldPnts = MagEphemInfo->ShellLineOffset = NULL;
+    MagEphemInfo->nShellLinePntsAlloced = NULL;
+    MagEphemInfo->s_gsm = MagEphemInfo->Bmag = MagEphemInfo->x_gsm = MagEphemInfo->y_gsm = MagEphemInfo->z_gsm = NULL;
 
-    int i;
+}
 
-    MagEphemInfo->LstarInfo = InitLstarInfo( Verbosity );
 
-    MagEphemInfo->LstarInfo->SaveShellLines = TRUE;
-    MagEphemInfo->SaveShellLines = TRUE;
 
-    Lgm_SetMagEphemLstarQuality( 3, 24, MagEphemInfo ); // quality 3, with 24 field lines in a drift shell.
+/*
+ *  Allocates (and fills with LGM_FILL_VALUE) the arrays that depend on the
+ *  number of pitch angles.
+ */
+static void AllocMagEphemInfoArrays( Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchAngles ) {
 
+    int i;
 
     /*
      * Allocate Arrays that depend on # of pitch angles.
@@ -65,6 +84,8 @@ void Lgm_InitMagEphemInfoDefaults( Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchA
     LGM_ARRAY_1D( MagEphemInfo->Hmin_GeodLon,   MaxPitchAngles, double );
     LGM_ARRAY_1D( MagEphemInfo->Lstar,          MaxPitchAngles, double );
     LGM_ARRAY_1D( MagEphemInfo->DriftOrbitType, MaxPitchAngles, int );
+    LGM_ARRAY_1D( MagEphemInfo->LstarApprox,    MaxPitchAngles, int );
+    MagEphemInfo->nAllocedAlpha = MaxPitchAngles;
 
 
     for ( i=0; i<MaxPitchAngles; ++i ){
@@ -84,40 +105,66 @@ void Lgm_InitMagEphemInfoDefaults( Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchA
         MagEphemInfo->Hmin_GeodLon[i]   = LGM_FILL_VALUE;
         MagEphemInfo->Lstar[i]          = LGM_FILL_VALUE;
         MagEphemInfo->DriftOrbitType[i] = LGM_DRIFT_ORBIT_OPEN;
+        MagEphemInfo->LstarApprox[i]    = FALSE;
     }
 
-// These 100 values should probably be replaced with  LGM_LSTARINFO_MAX_FL -- BUT CHECK FIRST....
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Pn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Sn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Bn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Ps, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Ss, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellSphericalFootprint_Bs, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Ps, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Ss, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Bs, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Pn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Sn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellEllipsoidFootprint_Bn, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellMirror_Pn,             MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellMirror_Sn,             MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellMirror_Ps,             MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->ShellMirror_Ss,             MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->ShellI,                     MaxPitchAngles, LGM_LSTARINFO_MAX_FL, double );
-    LGM_ARRAY_2D( MagEphemInfo->Shell_Bmin,                 MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->Shell_Pmin,                 MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->Shell_GradI,                MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->Shell_Vgc,                  MaxPitchAngles, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-    LGM_ARRAY_2D( MagEphemInfo->nMinima,                    MaxPitchAngles, LGM_LSTARINFO_MAX_FL, int );
-    LGM_ARRAY_2D( MagEphemInfo->nMaxima,                    MaxPitchAngles, LGM_LSTARINFO_MAX_FL, int );
-
-    LGM_ARRAY_2D( MagEphemInfo->nFieldPnts, MaxPitchAngles, LGM_LSTARINFO_MAX_FL, int );
-    LGM_ARRAY_3D( MagEphemInfo->s_gsm,      MaxPitchAngles, LGM_LSTARINFO_MAX_FL, 1000, double );
-    LGM_ARRAY_3D( MagEphemInfo->Bmag,       MaxPitchAngles, LGM_LSTARINFO_MAX_FL, 1000, double );
-    LGM_ARRAY_3D( MagEphemInfo->x_gsm,      MaxPitchAngles, LGM_LSTARINFO_MAX_FL, 1000, double );
-    LGM_ARRAY_3D( MagEphemInfo->y_gsm,      MaxPitchAngles, LGM_LSTARINFO_MAX_FL, 1000, double );
-    LGM_ARRAY_3D( MagEphemInfo->z_gsm,      MaxPitchAngles, LGM_LSTARINFO_MAX_FL, 1000, double );
+    /*
+     *  The drift shell arrays are only needed if SaveShellLines is set.
+     *  Lgm_ComputeLstarVersusPA() allocates them then (see
+     *  Lgm_MagEphemShellLines.c). (These may be pointers copied from
+     *  another structure, so dont free them.)
+     */
+    ClearShellPointers( MagEphemInfo );
 
+}
+
+
+void Lgm_InitMagEphemInfoDefaults( Lgm_MagEphemInfo *MagEphemInfo, int MaxPitchAngles, int Verbosity ) {
+
+    MagEphemInfo->LstarInfo = InitLstarInfo( Verbosity );
+    MagEphemInfo->ResultsCache = NULL;
+
+    MagEphemInfo->LstarInfo->SaveShellLines = TRUE;
+    MagEphemInfo->SaveShellLines = TRUE;
+    MagEphemInfo->Outputs        = LGM_OUT_ALL;
+    MagEphemInfo->ShellLineTol   = 1e-4;    // Re (i.e. ~0.6km)
+
+    Lgm_SetMagEphemLstarQuality( 3, 24, MagEphemInfo ); // quality 3, with 24 field lines in a drift shell.
+
+    AllocMagEphemInfoArrays( MagEphemInfo, MaxPitchAngles );
+
+}
+
+
+/*
+ *  The Lgm_MagEphemInfo structure has pointers in it, so simple asignments
+ *  (e.g. *t = *s) are dangerous. Here the target gets all of the settings of
+ *  the source (quality, model parameters, Alpha[], ...), its own copy of
+ *  LstarInfo (see Lgm_CopyLstarInfo()) and its own (fill-valued) result
+ *  arrays sized for MaxPitchAngles. The LstarInfoPool is not shared; the copy
+ *  creates its own on first use. Copies can therefore be used concurrently,
+ *  e.g. one per thread when time steps are computed in parallel.
+ */
+Lgm_MagEphemInfo *Lgm_CopyMagEphemInfo( Lgm_MagEphemInfo *s, int MaxPitchAngles ) {
+
+    Lgm_MagEphemInfo  *t;
+    int               i;
+
+    if ( s == NULL ) {
+        printf("Lgm_CopyMagEphemInfo: Error, source structure is NULL\n");
+        return( NULL );
+    }
+
+    t = (Lgm_MagEphemInfo *)calloc( 1, sizeof(Lgm_MagEphemInfo) );
+    memcpy( t, s, sizeof(*s) );
+
+    t->LstarInfo     = Lgm_CopyLstarInfo( s->LstarInfo );
+    t->LstarInfoPool = NULL;
+
+    AllocMagEphemInfoArrays( t, MaxPitchAngles );
+    for ( i=0; (i<s->nAlpha)&&(i<MaxPitchAngles); ++i ) t->Alpha[i] = s->Alpha[i];
+
+    return( t );
 
 }
 
@@ -133,36 +180,7 @@ void Lgm_FreeMagEphemInfo_Children( Lgm_MagEphemInfo  *MagEphemInfo ) {
     LGM_ARRAY_1D_FREE( MagEphemInfo->K );
     LGM_ARRAY_1D_FREE( MagEphemInfo->nShellPoints );
 
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Pn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Sn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Bn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Ps );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Ss );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellSphericalFootprint_Bs );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Ps );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Ss );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Bs );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Pn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Sn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellEllipsoidFootprint_Bn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellMirror_Pn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellMirror_Sn );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellMirror_Ps );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellMirror_Ss );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->ShellI );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->Shell_Bmin );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->Shell_Pmin );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->Shell_GradI );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->Shell_Vgc );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->nMinima );
-    LGM_ARRAY_2D_FREE( MagEphemInfo->nMaxima );
-
-    LGM_ARRAY_2D_FREE( MagEphemInfo->nFieldPnts );
-    LGM_ARRAY_3D_FREE( MagEphemInfo->s_gsm );
-    LGM_ARRAY_3D_FREE( MagEphemInfo->Bmag );
-    LGM_ARRAY_3D_FREE( MagEphemInfo->x_gsm );
-    LGM_ARRAY_3D_FREE( MagEphemInfo->y_gsm );
-    LGM_ARRAY_3D_FREE( MagEphemInfo->z_gsm );
+    Lgm_MagEphemInfo_FreeShellArrays( MagEphemInfo );
 
     LGM_ARRAY_1D_FREE( MagEphemInfo->LHilton );
     LGM_ARRAY_1D_FREE( MagEphemInfo->LMcIlwain );
@@ -171,8 +189,11 @@ void Lgm_FreeMagEphemInfo_Children( Lgm_MagEphemInfo  *MagEphemInfo ) {
     LGM_ARRAY_1D_FREE( MagEphemInfo->Hmin_GeodLat );
     LGM_ARRAY_1D_FREE( MagEphemInfo->Hmin_GeodLon );
     LGM_ARRAY_1D_FREE( MagEphemInfo->DriftOrbitType );
+    LGM_ARRAY_1D_FREE( MagEphemInfo->LstarApprox );
 
     FreeLstarInfo( MagEphemInfo->LstarInfo );
+    Lgm_FreeLstarInfoPool( MagEphemInfo->LstarInfoPool );
+    MagEphemInfo->LstarInfoPool = NULL;
 }
 
 void Lgm_FreeMagEphemInfo( Lgm_MagEphemInfo  *MagEphemInfo ) {
@@ -189,6 +210,7 @@ void Lgm_FreeMagEphemInfo( Lgm_MagEphemInfo  *MagEphemInfo ) {
 
 void WriteMagEphemInfoStruct( char *Filename, int nPitchAngles, Lgm_MagEphemInfo *MagEphemInfo ) {
 
+    int      i, n, HaveShell;
     long int fd;
     size_t dum __attribute__ ((unused));
 
@@ -206,32 +228,49 @@ void WriteMagEphemInfoStruct( char *Filename, int nPitchAngles, Lgm_MagEphemInfo
     dum = write( fd, MagEphemInfo->K,            nPitchAngles*sizeof( double ) );
     dum = write( fd, MagEphemInfo->nShellPoints, nPitchAngles*sizeof( int ) );
 
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Pn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Sn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Bn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Ps[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Ss[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Bs[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Ps[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Ss[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Bs[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Pn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Sn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Bn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellMirror_Pn[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    dum = write( fd, &MagEphemInfo->ShellMirror_Sn[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellMirror_Ps[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    dum = write( fd, &MagEphemInfo->ShellMirror_Ss[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->ShellI[0][0],                     nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-
-
-    dum = write( fd, &MagEphemInfo->nFieldPnts[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
-    dum = write( fd, &MagEphemInfo->s_gsm[0][0][0],      nPitchAngles*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->Bmag[0][0][0],       nPitchAngles*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->x_gsm[0][0][0],      nPitchAngles*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->y_gsm[0][0][0],      nPitchAngles*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    dum = write( fd, &MagEphemInfo->z_gsm[0][0][0],      nPitchAngles*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
+    /*
+     *  The drift shells (if there are any). The shell lines go out as they
+     *  are held, packed floats (see Lgm_MagEphemShellLines.c).
+     */
+    HaveShell = ( MagEphemInfo->ShellI != NULL );
+    dum = write( fd, &HaveShell, sizeof( HaveShell ) );
+    if ( HaveShell ) {
+
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Pn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Sn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Bn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Ps[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Ss[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellSphericalFootprint_Bs[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Ps[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Ss[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Bs[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Pn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Sn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellEllipsoidFootprint_Bn[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellMirror_Pn[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        dum = write( fd, &MagEphemInfo->ShellMirror_Sn[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellMirror_Ps[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        dum = write( fd, &MagEphemInfo->ShellMirror_Ss[0][0],             nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        dum = write( fd, &MagEphemInfo->ShellI[0][0],                     nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+
+
+        dum = write( fd, &MagEphemInfo->nFieldPnts[0][0],      nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
+        dum = write( fd, &MagEphemInfo->ShellLineOffset[0][0], nPitchAngles*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
+        for ( i=0; i<nPitchAngles; i++ ) {
+            n = Lgm_MagEphemInfo_nShellLinePnts( i, MagEphemInfo );
+            dum = write( fd, &n, sizeof( n ) );
+            if ( n > 0 ) {
+                dum = write( fd, MagEphemInfo->s_gsm[i], n*sizeof( float ) );
+                dum = write( fd, MagEphemInfo->Bmag[i],  n*sizeof( float ) );
+                dum = write( fd, MagEphemInfo->x_gsm[i], n*sizeof( float ) );
+                dum = write( fd, MagEphemInfo->y_gsm[i], n*sizeof( float ) );
+                dum = write( fd, MagEphemInfo->z_gsm[i], n*sizeof( float ) );
+            }
+        }
+
+    }
 
     dum = write( fd, &MagEphemInfo->LHilton[0],      nPitchAngles*sizeof( double ) );
     dum = write( fd, &MagEphemInfo->LMcIlwain[0],    nPitchAngles*sizeof( double ) );
@@ -251,7 +290,7 @@ void ReadMagEphemInfoStruct( char *Filename, int *nPitchAngles, Lgm_MagEphemInfo
     double      *ddata;
     Lgm_Vector  *vdata;
     int         *idata;
-    int      n;
+    int      i, n, np, HaveShell;
     long int fd;
     ssize_t dum __attribute__ ((unused));
 
@@ -298,99 +337,114 @@ void ReadMagEphemInfoStruct( char *Filename, int *nPitchAngles, Lgm_MagEphemInfo
     LGM_ARRAY_FROM_DATA_1D( MagEphemInfo->nShellPoints, idata, n, int );
 
 
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Bn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Bs, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Bs, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Bn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
-    dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellI, ddata, n, LGM_LSTARINFO_MAX_FL, double );
-
-
-
-    idata = (int *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(int) );
-    dum = read( fd, idata, n*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
-    LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->nFieldPnts, idata, n, LGM_LSTARINFO_MAX_FL, int );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL*1000, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_3D( MagEphemInfo->s_gsm, ddata, n, LGM_LSTARINFO_MAX_FL, 1000, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL*1000, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_3D( MagEphemInfo->Bmag, ddata, n, LGM_LSTARINFO_MAX_FL, 1000, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL*1000, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_3D( MagEphemInfo->x_gsm, ddata, n, LGM_LSTARINFO_MAX_FL, 1000, double );
-
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL*1000, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_3D( MagEphemInfo->y_gsm, ddata, n, LGM_LSTARINFO_MAX_FL, 1000, double );
+    /*
+     *  The drift shells, if they were written (see WriteMagEphemInfoStruct()).
+     *  The structure read above came with the writer's pointers to them in
+     *  it, so start from none.
+     */
+    MagEphemInfo->nAllocedAlpha = n;
+    ClearShellPointers( MagEphemInfo );
+    dum = read( fd, &HaveShell, sizeof( HaveShell ) );
+    if ( HaveShell ) {
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Bn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellSphericalFootprint_Bs, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Bs, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellEllipsoidFootprint_Bn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Pn, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Sn, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        vdata = (Lgm_Vector *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(Lgm_Vector) );
+        dum = read( fd, vdata, n*LGM_LSTARINFO_MAX_FL*sizeof( Lgm_Vector ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Ps, vdata, n, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellMirror_Ss, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+        ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL, sizeof(double) );
+        dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*sizeof( double ) );
+        LGM_ARRAY_FROM_DATA_2D( MagEphemInfo->ShellI, ddata, n, LGM_LSTARINFO_MAX_FL, double );
+
+
+        LGM_ARRAY_2D( MagEphemInfo->nFieldPnts,      n, LGM_LSTARINFO_MAX_FL, int );
+        LGM_ARRAY_2D( MagEphemInfo->ShellLineOffset, n, LGM_LSTARINFO_MAX_FL, int );
+        LGM_ARRAY_1D( MagEphemInfo->nShellLinePntsAlloced, n, int );
+        MagEphemInfo->s_gsm = (float **)calloc( n, sizeof(float *) );
+        MagEphemInfo->Bmag  = (float **)calloc( n, sizeof(float *) );
+        MagEphemInfo->x_gsm = (float **)calloc( n, sizeof(float *) );
+        MagEphemInfo->y_gsm = (float **)calloc( n, sizeof(float *) );
+        MagEphemInfo->z_gsm = (float **)calloc( n, sizeof(float *) );
+
+        dum = read( fd, &MagEphemInfo->nFieldPnts[0][0],      n*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
+        dum = read( fd, &MagEphemInfo->ShellLineOffset[0][0], n*LGM_LSTARINFO_MAX_FL*sizeof( int ) );
+        for ( i=0; i<n; i++ ) {
+            dum = read( fd, &np, sizeof( np ) );
+            if ( np > 0 ) {
+                MagEphemInfo->s_gsm[i] = (float *)calloc( np, sizeof(float) );
+                MagEphemInfo->Bmag[i]  = (float *)calloc( np, sizeof(float) );
+                MagEphemInfo->x_gsm[i] = (float *)calloc( np, sizeof(float) );
+                MagEphemInfo->y_gsm[i] = (float *)calloc( np, sizeof(float) );
+                MagEphemInfo->z_gsm[i] = (float *)calloc( np, sizeof(float) );
+                dum = read( fd, MagEphemInfo->s_gsm[i], np*sizeof( float ) );
+                dum = read( fd, MagEphemInfo->Bmag[i],  np*sizeof( float ) );
+                dum = read( fd, MagEphemInfo->x_gsm[i], np*sizeof( float ) );
+                dum = read( fd, MagEphemInfo->y_gsm[i], np*sizeof( float ) );
+                dum = read( fd, MagEphemInfo->z_gsm[i], np*sizeof( float ) );
+                MagEphemInfo->nShellLinePntsAlloced[i] = np;
+            }
+        }
 
-    ddata = (double *)calloc( n*LGM_LSTARINFO_MAX_FL*1000, sizeof(double) );
-    dum = read( fd, ddata, n*LGM_LSTARINFO_MAX_FL*1000*sizeof( double ) );
-    LGM_ARRAY_FROM_DATA_3D( MagEphemInfo->z_gsm, ddata, n, LGM_LSTARINFO_MAX_FL, 1000, double );
+    }
 
 
 
@@ -429,22 +483,37 @@ void ReadMagEphemInfoStruct( char *Filename, int *nPitchAngles, Lgm_MagEphemInfo
 
 /*
  * This allocates/initializes memory for a MagEphemData structure.
+ *
+ * nRows is the number of time steps held in the per-time H5_* arrays. It
+ * need not cover the whole run -- the tools can use the arrays as a ring
+ * buffer (row iRow of the run is kept at iRow % H5_nRows) and let
+ * Lgm_WriteMagEphemDataHdf() write the rows out as they fill, so that memory
+ * use does not depend on the length of the run.
  */
 Lgm_MagEphemData *Lgm_InitMagEphemData( int nRows, int nPA ) {
 
 
     Lgm_MagEphemData  *MagEphemData = (Lgm_MagEphemData *) calloc (1, sizeof(*MagEphemData));
+    int               nEvents = ( nRows < LGM_MAGEPHEM_MIN_EVENTS ) ? LGM_MAGEPHEM_MIN_EVENTS : nRows; // room for apogees, perigees and nodes
 
     MagEphemData->H5_nPerigee = 0;
     MagEphemData->H5_nApogee  = 0;
     MagEphemData->H5_nAscend  = 0;
 
-    LGM_ARRAY_2D( MagEphemData->H5_Perigee_IsoTimes,  nRows, 80,      char   );
-    LGM_ARRAY_2D( MagEphemData->H5_Apogee_IsoTimes,   nRows, 80,      char   );
-    LGM_ARRAY_2D( MagEphemData->H5_Ascend_IsoTimes,   nRows, 80,      char   );
-    LGM_ARRAY_2D( MagEphemData->H5_Perigee_Geod,      nRows, 3,       double );
-    LGM_ARRAY_2D( MagEphemData->H5_Apogee_Geod,       nRows, 3,       double );
-    LGM_ARRAY_2D( MagEphemData->H5_Ascend_Geod,       nRows, 3,       double );
+    MagEphemData->H5_ChunkBytes = LGM_HDF5_CHUNK_BYTES;
+    MagEphemData->H5_nBuffer    = 1024;
+    MagEphemData->H5_Deflate    = 0;
+    MagEphemData->H5_Shuffle    = FALSE;
+    MagEphemData->H5_nBuffered  = 0;
+    MagEphemData->H5_nRows      = nRows;
+    MagEphemData->H5_nPA        = nPA;
+
+    LGM_ARRAY_2D( MagEphemData->H5_Perigee_IsoTimes,  nEvents, 80,    char   );
+    LGM_ARRAY_2D( MagEphemData->H5_Apogee_IsoTimes,   nEvents, 80,    char   );
+    LGM_ARRAY_2D( MagEphemData->H5_Ascend_IsoTimes,   nEvents, 80,    char   );
+    LGM_ARRAY_2D( MagEphemData->H5_Perigee_Geod,      nEvents, 3,     double );
+    LGM_ARRAY_2D( MagEphemData->H5_Apogee_Geod,       nEvents, 3,     double );
+    LGM_ARRAY_2D( MagEphemData->H5_Ascend_Geod,       nEvents, 3,     double );
                                              
     LGM_ARRAY_1D( MagEphemData->H5_Alpha,             nPA,            double );
 
@@ -461,6 +530,7 @@ Lgm_MagEphemData *Lgm_InitMagEphemData( int nRows, int nPA ) {
     LGM_ARRAY_1D( MagEphemData->H5_TiltAngle,         nRows,          double );
     LGM_ARRAY_1D( MagEphemData->H5_InOut,             nRows,          int    );
     LGM_ARRAY_1D( MagEphemData->H5_OrbitNumber,       nRows,          int    );
+    LGM_ARRAY_1D( MagEphemData->H5_Interpolated,      nRows,          int    );
 
 
     LGM_ARRAY_2D( MagEphemData->H5_Rgeo,              nRows, 3,       double );
@@ -589,6 +659,7 @@ void Lgm_FreeMagEphemData( Lgm_MagEphemData *MagEphemData ) {
     LGM_ARRAY_1D_FREE( MagEphemData->H5_TiltAngle );
     LGM_ARRAY_1D_FREE( MagEphemData->H5_InOut );
     LGM_ARRAY_1D_FREE( MagEphemData->H5_OrbitNumber );
+    LGM_ARRAY_1D_FREE( MagEphemData->H5_Interpolated );
 
 
     LGM_ARRAY_2D_FREE( MagEphemData->H5_Rgeo );
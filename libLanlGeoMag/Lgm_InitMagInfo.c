@@ -1,3 +1,6 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include "Lgm/Lgm_MagModelInfo.h"
 
 
@@ -17,10 +20,22 @@ Lgm_MagModelInfo *Lgm_InitMagInfo( ) {
 
 void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
 
+    int     k;
+    char    *Env;
+
     MagInfo->AllocedSplines = FALSE;
 
     MagInfo->Bfield = Lgm_B_T89;
+    MagInfo->BfieldBatch = NULL; // use native batch kernel for Bfield (see Lgm_B_Batch())
+    MagInfo->BfieldWithJacobian = NULL; // use native Jacobian routine for Bfield (see Lgm_B_Jacobian())
     MagInfo->InternalModel = LGM_IGRF;
+    MagInfo->ExternalPrecision = LGM_PRECISION_DOUBLE; // see Lgm_T89_External_Batch_f32()
+
+    /*
+     *  No offloading (see Lgm_B_Offload.c) unless LGM_OFFLOAD_DEVICE names a usable device.
+     */
+    MagInfo->OffloadDevice = LGM_OFFLOAD_NONE;
+    if ( ( Env = getenv( "LGM_OFFLOAD_DEVICE" ) ) != NULL ) Lgm_MagModelInfo_Set_Offload( atoi( Env ), MagInfo );
 
     MagInfo->c     = Lgm_init_ctrans( 0 );
     MagInfo->fKp   = 2.0;
@@ -28,6 +43,8 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->P     = 2.1; // SW pressure in nPa
     MagInfo->nFunc = 0;
     MagInfo->Dst   = -5.0;
+    MagInfo->ParamsHash       = 0;    // see Lgm_set_QinDenton()
+    MagInfo->ParamsGeneration = 0;
 
     MagInfo->B0    = 1.00;   // Should nominally be 1.0 See page 30 of Schultz and Lanzerotti, [1974]
     MagInfo->B1    = 0.8100; // See page 30 of Schultz and Lanzerotti, [1974]
@@ -36,16 +53,38 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->SavePoints = 0;
     MagInfo->Hmax       = 1.0;
 
+    /*
+     *  FL arrays are allocated on first use (see Lgm_MagModelInfo_ReservePnts()).
+     */
+    MagInfo->s            = NULL;
+    MagInfo->Px           = NULL;
+    MagInfo->Py           = NULL;
+    MagInfo->Pz           = NULL;
+    MagInfo->Bvec         = NULL;
+    MagInfo->Bmag         = NULL;
+    MagInfo->BminusBcdip  = NULL;
+    MagInfo->nAllocedPnts = 0;
+    MagInfo->nPnts        = 0;
+
+    /*
+     *  No FL interpolants yet (InitSpline() sets them up, FreeSpline() keeps the arrays).
+     */
+    Lgm_FLSpline_Init( &MagInfo->FLSpline );
+
     MagInfo->ComputeSb0 = FALSE;
 
     MagInfo->UseInterpRoutines = TRUE;
+    MagInfo->UseDipoleFastPath = TRUE;
+    MagInfo->ConcurrentTrace   = FALSE;
+    MagInfo->PreClassifyFieldLines = FALSE;
+    MagInfo->TraceOutputs      = LGM_TRACE_ALL;
     Lgm_Set_Open_Limits( MagInfo, -80.0, 30.0, -40.0, 40.0, -40.0, 40.0 );
 
     MagInfo->Lgm_I_integrand_JumpMethod = LGM_ABSOLUTE_JUMP_METHOD;
 
     /*
      * Default to Bulirsch-Stoer ODE method for FL tracing (i.e. LGM_MAGSTEP_ODE_BS)
-     * Could also use LGM_MAGSTEP_ODE_RK5
+     * Could also use LGM_MAGSTEP_ODE_RK5 or LGM_MAGSTEP_ODE_DP8
      */
     MagInfo->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
 
@@ -78,6 +117,35 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->Lgm_MagStep_RK5_ErrCon           = pow( 5.0/MagInfo->Lgm_MagStep_RK5_Safety, 1.0/MagInfo->Lgm_MagStep_RK5_pGrow);
     MagInfo->Lgm_MagStep_RK5_Eps              = 1e-5;
 
+    /*
+     *  Some inits for MagStep_DP8
+     */
+    MagInfo->Lgm_MagStep_DP8_atol     = 1e-5;
+    MagInfo->Lgm_MagStep_DP8_rtol     = 1e-5;
+    MagInfo->Lgm_MagStep_DP8_Safety   = 0.9;
+    MagInfo->Lgm_MagStep_DP8_Beta     = 0.04;
+    MagInfo->Lgm_MagStep_DP8_FacMin   = 0.333;
+    MagInfo->Lgm_MagStep_DP8_FacMax   = 6.0;
+    MagInfo->Lgm_MagStep_DP8_MaxCount = 50;
+    MagInfo->Lgm_MagStep_DP8_ErrOld   = 1e-4;
+    MagInfo->Lgm_MagStep_DP8_bValid   = FALSE;
+    MagInfo->Lgm_MagStep_DP8_Mag      = NULL;
+
+    /*
+     *  Dense output for MagStep (off by default)
+     */
+    MagInfo->Lgm_MagStep_DenseOutput  = FALSE;
+    MagInfo->Lgm_MagStep_DenseTol     = 1e-5;     // about the local error of a BS step with the default atol/rtol
+    MagInfo->Lgm_MagStep_nDense       = 0;
+    MagInfo->Lgm_MagStep_iDense       = 0;
+    MagInfo->Lgm_MagStep_Dense_bValid = FALSE;
+    MagInfo->Lgm_MagStep_Dense_Mag    = NULL;
+
+    /*
+     *  Integrator kernels for the default field (see Lgm_MagStep_SelectKernels()).
+     */
+    Lgm_MagStep_SelectKernels( MagInfo->Bfield, MagInfo );
+
 //    gsl_set_error_handler_off(); // Turn off gsl default error handler
 
     /*
@@ -92,11 +160,22 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->Lgm_I_Integrator_epsrel = 0.0;
     MagInfo->Lgm_I_Integrator_epsabs = 1e-3;
     MagInfo->Lgm_I_Integrator = DQAGS;
+    MagInfo->Lgm_GradI_Method = LGM_GRAD_I_PERTURB;
 
     MagInfo->Lgm_Sb_Integrator_epsrel = 0.0;
     MagInfo->Lgm_Sb_Integrator_epsabs = 1e-4;
     MagInfo->Lgm_Sb_Integrator = DQAGP; // not changeable (yet...)
 
+    /*
+     *  QuadPack work space (allocated when first needed)
+     */
+    MagInfo->Lgm_QuadPack_Limit = 500;
+    for ( k=0; k<LGM_QUADPACK_NWORK; k++ ) {
+        MagInfo->Lgm_QuadPack_Work[k].Limit = 0;
+        MagInfo->Lgm_QuadPack_Work[k].iwork = NULL;
+        MagInfo->Lgm_QuadPack_Work[k].work  = NULL;
+    }
+
     MagInfo->Lgm_FindBmRadius_Tol = 1e-10;
     MagInfo->Lgm_FindShellLine_I_Tol = 1e-3;
     MagInfo->Lgm_TraceToMirrorPoint_Tol = 1e-7;
@@ -112,6 +191,8 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
      */
     MagInfo->MaxDiv = 0.1;
     MagInfo->nDivs  = 200;
+    MagInfo->AdaptiveDivs   = FALSE;
+    MagInfo->AdaptiveDivTol = LGM_ADAPTIVE_DIV_TOL;
 
     /*
      * Bounce Loss Cone Height
@@ -123,6 +204,11 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
      */
     MagInfo->OP77_TILTL = 99.0;
 
+    /*
+     * Inits for OP88 (forces the scalings to be computed on first use)
+     */
+    MagInfo->OP88_DEN = -1.0;
+
 
     /*
      * Inits for T96
@@ -141,9 +227,16 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
 
 
     /*
-     * Inits for TS07
+     * Inits for TS07. The tail coeffs never change once read, so hand them
+     * over to the (shared) Config.
      */
     Lgm_Init_TS07( &MagInfo->TS07_Info );
+    MagInfo->Config = (Lgm_MagModelConfig *) calloc( 1, sizeof( Lgm_MagModelConfig ) );
+    MagInfo->Config->nRef     = 1;
+    MagInfo->Config->TS07_TSS = MagInfo->TS07_Info.TSS;
+    MagInfo->Config->TS07_TSO = MagInfo->TS07_Info.TSO;
+    MagInfo->Config->TS07_TSE = MagInfo->TS07_Info.TSE;
+    MagInfo->TS07_Info.TailAlloced = FALSE;
 
 
     /*
@@ -154,6 +247,25 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->Octree_kNN_MaxDist2 = 1.0*1.0;
     MagInfo->Octree_kNN_Alloced = 0;
 
+    /*
+     *  No gridded field cache yet (see Lgm_B_Gridded_Build())
+     */
+    MagInfo->Gridded = NULL;
+    MagInfo->RBF_Snapshot = NULL;
+    MagInfo->RBF_SnapshotPair = NULL;
+    MagInfo->TraceHistory = NULL;
+    MagInfo->Hooks        = NULL;
+
+    /*
+     *  No K(alpha) table yet (see Lgm_Setup_AlphaOfK())
+     */
+    MagInfo->AlphaOfK_nTab = 0;
+
+    /*
+     *  Zero the (optional) evaluation counters and timers.
+     */
+    Lgm_MagModelInfo_ResetStats( MagInfo );
+
 
     /*
      *  Initialize hash table used in Lgm_B_FromScatteredData*()
@@ -162,6 +274,12 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
     MagInfo->rbf_ht_alloced      = FALSE;
     MagInfo->RBF_nHashFinds      = 0;
     MagInfo->RBF_nHashAdds       = 0;
+    MagInfo->RBF_Cache           = NULL;
+    MagInfo->RBF_Last_Valid      = FALSE;
+    MagInfo->RBF_Last_rbf        = NULL;
+    MagInfo->RBF_Last_rbf_e      = NULL;
+    MagInfo->RBF_Last_Entry      = NULL;
+    MagInfo->RBF_nReuses         = 0;
     MagInfo->RBF_CompGradAndCurl = FALSE;
     MagInfo->RBF_Type            = LGM_RBF_MULTIQUADRIC;
     MagInfo->RBF_Eps             = 1.0/(4.0*4.0);
@@ -181,8 +299,15 @@ void Lgm_InitMagInfoDefaults( Lgm_MagModelInfo  *MagInfo ) {
 
 void Lgm_FreeMagInfo_children( Lgm_MagModelInfo  *Info ) {
 
+    int k;
+
     Lgm_DeAllocate_TS07( &(Info->TS07_Info) );
+    Lgm_MagModelConfig_Release( Info->Config );
+    Info->Config = NULL;
     Lgm_free_ctrans( Info->c );
+    Lgm_MagModelInfo_FreePnts( Info );
+    Lgm_FLSpline_Free( &Info->FLSpline );
+    for ( k=0; k<LGM_QUADPACK_NWORK; k++ ) Lgm_QuadPackWork_Free( &Info->Lgm_QuadPack_Work[k] );
 
 
 
@@ -201,23 +326,117 @@ void Lgm_FreeMagInfo( Lgm_MagModelInfo  *Info ) {
 
 
 
+/*
+ *  Make sure the FL arrays (s, Px, Py, Pz, Bvec, Bmag, BminusBcdip) can hold
+ *  at least n points. Capacity grows geometrically so that a trace that adds
+ *  points one at a time only reallocs a handful of times. Existing contents
+ *  are preserved. Returns TRUE on success, FALSE if the allocation fails (the
+ *  old arrays are left intact in that case).
+ */
+int Lgm_MagModelInfo_ReservePnts( int n, Lgm_MagModelInfo *Info ) {
+
+    int         nNew;
+    double      *s, *Px, *Py, *Pz, *Bmag, *BminusBcdip;
+    Lgm_Vector  *Bvec;
+
+    if ( n <= Info->nAllocedPnts ) return( TRUE );
+
+    /*
+     *  Geometric growth is capped at LGM_MAX_INTERP_PNTS (the tracers stop
+     *  saving points near there), but an explicit request for more is
+     *  honored since the tracers may store a few points past the limit.
+     */
+    nNew = ( Info->nAllocedPnts < 256 ) ? 256 : 2*Info->nAllocedPnts;
+    if ( nNew > LGM_MAX_INTERP_PNTS ) nNew = LGM_MAX_INTERP_PNTS;
+    if ( nNew < n ) nNew = n;
+
+    /*
+     *  realloc() each array in turn, storing the result back as we go so that
+     *  nothing is lost if a later one fails.
+     */
+    if ( (s = (double *)realloc( Info->s, nNew*sizeof(double) )) != NULL ) Info->s = s;
+    if ( (Px = (double *)realloc( Info->Px, nNew*sizeof(double) )) != NULL ) Info->Px = Px;
+    if ( (Py = (double *)realloc( Info->Py, nNew*sizeof(double) )) != NULL ) Info->Py = Py;
+    if ( (Pz = (double *)realloc( Info->Pz, nNew*sizeof(double) )) != NULL ) Info->Pz = Pz;
+    if ( (Bvec = (Lgm_Vector *)realloc( Info->Bvec, nNew*sizeof(Lgm_Vector) )) != NULL ) Info->Bvec = Bvec;
+    if ( (Bmag = (double *)realloc( Info->Bmag, nNew*sizeof(double) )) != NULL ) Info->Bmag = Bmag;
+    if ( (BminusBcdip = (double *)realloc( Info->BminusBcdip, nNew*sizeof(double) )) != NULL ) Info->BminusBcdip = BminusBcdip;
+
+    if ( !s || !Px || !Py || !Pz || !Bvec || !Bmag || !BminusBcdip ) {
+        printf("Lgm_MagModelInfo_ReservePnts: Error, could not allocate FL arrays for %d points\n", nNew );
+        return( FALSE );
+    }
+
+    Info->nAllocedPnts = nNew;
+
+    return( TRUE );
+
+}
+
 
 /*
- *  The Lgm_MagModelInfo structure has pointers in it, so simple
- *  asignments (e.g. *t = *s) are dangerous. Here we make sure that
- *  the target gets an independent copy of the structure.
+ *  Release the FL arrays.
  */
-Lgm_MagModelInfo *Lgm_CopyMagInfo( Lgm_MagModelInfo *s ) {
+void Lgm_MagModelInfo_FreePnts( Lgm_MagModelInfo *Info ) {
 
-    Lgm_MagModelInfo *t;
+    free( Info->s );            Info->s           = NULL;
+    free( Info->Px );           Info->Px          = NULL;
+    free( Info->Py );           Info->Py          = NULL;
+    free( Info->Pz );           Info->Pz          = NULL;
+    free( Info->Bvec );         Info->Bvec        = NULL;
+    free( Info->Bmag );         Info->Bmag        = NULL;
+    free( Info->BminusBcdip );  Info->BminusBcdip = NULL;
+    Info->nAllocedPnts = 0;
 
+}
 
-    if ( s == NULL) {
-        printf("Lgm_CopyMagInfo: Error, source structure is NULL\n");
-        return((Lgm_MagModelInfo *) NULL);
+
+
+/*
+ *  The QuadPack work space in slot k (LGM_QUADPACK_WORK_OUTER or
+ *  LGM_QUADPACK_WORK_INNER), made big enough for Info->Lgm_QuadPack_Limit
+ *  subintervals. Returns NULL if it could not be allocated.
+ */
+Lgm_QuadPackWork *Lgm_MagModelInfo_QuadPackWork( int k, Lgm_MagModelInfo *Info ) {
+
+    if ( ( k < 0 ) || ( k >= LGM_QUADPACK_NWORK ) ) {
+        printf("Lgm_MagModelInfo_QuadPackWork: Error, no work space slot %d\n", k );
+        return( NULL );
     }
 
-    t = (Lgm_MagModelInfo *)calloc( 1, sizeof(Lgm_MagModelInfo) );
+    if ( !Lgm_QuadPackWork_Reserve( Info->Lgm_QuadPack_Limit, &Info->Lgm_QuadPack_Work[k] ) ) return( NULL );
+
+    return( &Info->Lgm_QuadPack_Work[k] );
+
+}
+
+
+
+/*
+ *  Does the work for Lgm_CopyMagInfo(), Lgm_CloneMagInfo() and
+ *  Lgm_CopyMagInfoInto(). If CopyPnts is FALSE the copy starts out with no
+ *  FL points. Whatever t already owns (its Lgm_CTrans, FL arrays, QuadPack
+ *  work space, FL interpolant arrays and TS07 coeff array) is reused rather
+ *  than reallocated; for a freshly calloc'd t these are all NULL.
+ */
+static void Lgm_CopyMagInfo_Body( Lgm_MagModelInfo *t, Lgm_MagModelInfo *s, int CopyPnts ) {
+
+    Lgm_CTrans              *c;
+    double                  *ss, *Px, *Py, *Pz, *Bmag, *BminusBcdip, *A;
+    Lgm_Vector              *Bvec;
+    int                     k, nAllocedPnts;
+    Lgm_QuadPackWork        Work[LGM_QUADPACK_NWORK];
+    Lgm_FLSpline            FLSpline;
+
+    /*
+     *  Hang on to what t owns.
+     */
+    c  = t->c;
+    ss = t->s; Px = t->Px; Py = t->Py; Pz = t->Pz; Bmag = t->Bmag; BminusBcdip = t->BminusBcdip; Bvec = t->Bvec;
+    nAllocedPnts = t->nAllocedPnts;
+    for ( k=0; k<LGM_QUADPACK_NWORK; k++ ) Work[k] = t->Lgm_QuadPack_Work[k];
+    FLSpline = t->FLSpline;
+    A = ( t->TS07_Info.ArraysAlloced ) ? t->TS07_Info.A : NULL;
 
     // memcpy's args are (dest, src, size)
     memcpy( t, s, sizeof(Lgm_MagModelInfo) );
@@ -227,19 +446,46 @@ Lgm_MagModelInfo *Lgm_CopyMagInfo( Lgm_MagModelInfo *s ) {
      *  t->c and s->c now point at the same thing. We dont want that.
      *  Now, copy the Lgm_CTrans struct properly.
      */
-    t->c = Lgm_CopyCTrans( s->c );
+    if ( c != NULL ) {
+        Lgm_CopyCTransInto( c, s->c );
+        t->c = c;
+    } else {
+        t->c = Lgm_CopyCTrans( s->c );
+    }
+
+
+    /*
+     *  The FL arrays are also pointers. Give the copy its own arrays, sized to
+     *  hold just the points currently defined (they will grow again if the
+     *  copy is used for tracing).
+     */
+    t->s = ss; t->Px = Px; t->Py = Py; t->Pz = Pz; t->Bmag = Bmag; t->BminusBcdip = BminusBcdip;
+    t->Bvec = Bvec;
+    t->nAllocedPnts = nAllocedPnts;
+    if ( !CopyPnts ) {
+        t->nPnts = 0;
+    } else if ( ( s->nPnts > 0 ) && Lgm_MagModelInfo_ReservePnts( s->nPnts, t ) ) {
+        memcpy( t->s,           s->s,           s->nPnts*sizeof(double) );
+        memcpy( t->Px,          s->Px,          s->nPnts*sizeof(double) );
+        memcpy( t->Py,          s->Py,          s->nPnts*sizeof(double) );
+        memcpy( t->Pz,          s->Pz,          s->nPnts*sizeof(double) );
+        memcpy( t->Bvec,        s->Bvec,        s->nPnts*sizeof(Lgm_Vector) );
+        memcpy( t->Bmag,        s->Bmag,        s->nPnts*sizeof(double) );
+        memcpy( t->BminusBcdip, s->BminusBcdip, s->nPnts*sizeof(double) );
+    }
 
 
 
 
     /*
-     *  Lets also assume that GSL interp stuff should be NULL
-     *  This routine wont yet properly copy over the spline stuff.
-     *  Need to be careful if you want an independent copy of that stuff...
-     *  BE careful free these things in copies -- it'll free them for all other copies too.
+     *  The FL interpolants go with the points. t keeps its own arrays and
+     *  gets a copy of s's interpolants if it has s's points.
      */
-    //t->acc    = (gsl_interp_accel *)NULL;
-    //t->spline = (gsl_spline *)NULL;
+    t->FLSpline = FLSpline;
+    t->AllocedSplines = FALSE;
+    if ( CopyPnts && s->AllocedSplines && ( t->nPnts > 0 ) ) {
+        t->AllocedSplines = Lgm_FLSpline_Copy( &t->FLSpline, &s->FLSpline );
+    }
 
     // octree stuff is also not copied correctly...
 
@@ -252,11 +498,166 @@ Lgm_MagModelInfo *Lgm_CopyMagInfo( Lgm_MagModelInfo *s ) {
         t->Octree_Alloced = FALSE;
     }
 
+    // the gridded field cache is read-only, so copies can just share it.
+    t->Gridded = s->Gridded;
+    t->RBF_Snapshot = s->RBF_Snapshot;
+    t->RBF_SnapshotPair = s->RBF_SnapshotPair;
+
+    // a trace history belongs to one (serial) sequence of traces, so copies dont get it.
+    t->TraceHistory = NULL;
+
+    // nor do they get the last kNN set of Lgm_B_FromScatteredData5() (the cache entry it holds is s's).
+    t->RBF_Last_Valid = FALSE;
+    t->RBF_Last_rbf   = NULL;
+    t->RBF_Last_rbf_e = NULL;
+    t->RBF_Last_Entry = NULL;
+    t->RBF_nReuses    = 0;
+
+    // nor s's QuadPack work space (each copy has its own, allocated when it needs it).
+    for ( k=0; k<LGM_QUADPACK_NWORK; k++ ) t->Lgm_QuadPack_Work[k] = Work[k];
+
+    // copies start with their own (empty) evaluation statistics.
+    Lgm_MagModelInfo_ResetStats( t );
+
+    // the read-only model data is shared,
+    t->Config = Lgm_MagModelConfig_Retain( s->Config );
+    t->TS07_Info.TailAlloced = FALSE;
+
+    // but the per-epoch TS07 coeffs are not (so that Lgm_SetCoeffs_TS07() on a copy leaves s alone).
+    if ( s->TS07_Info.ArraysAlloced ) {
+        if ( A == NULL ) LGM_ARRAY_1D( A, 102, double );
+        t->TS07_Info.A = A;
+        memcpy( t->TS07_Info.A, s->TS07_Info.A, 102*sizeof(double) );
+    } else if ( A != NULL ) {
+        LGM_ARRAY_1D_FREE( A );
+    }
 
+}
 
-    // TEMP KLUDGE
-    t->TS07_Info.ArraysAlloced = FALSE;
 
+static Lgm_MagModelInfo *Lgm_CopyMagInfo_Pnts( Lgm_MagModelInfo *s, int CopyPnts ) {
+
+    Lgm_MagModelInfo *t;
+
+    if ( s == NULL) {
+        printf("Lgm_CopyMagInfo: Error, source structure is NULL\n");
+        return((Lgm_MagModelInfo *) NULL);
+    }
+
+    t = (Lgm_MagModelInfo *)calloc( 1, sizeof(Lgm_MagModelInfo) );
+    Lgm_CopyMagInfo_Body( t, s, CopyPnts );
+
+    return( t );
+
+}
+
+
+/*
+ *  Make t (an earlier copy made by Lgm_CopyMagInfo(), Lgm_CloneMagInfo() or
+ *  Lgm_NewMagContext()) into a copy of s again, reusing t's allocations
+ *  instead of freeing t and making a new copy. This is what pools of scratch
+ *  structures (e.g. Lgm_LstarInfoPool_Get()) should use. t must not be an
+ *  original -- one that owns a trace history or the TS07 tail arrays.
+ *  Returns TRUE, or FALSE (leaving t alone) if it cant be done.
+ */
+int Lgm_CopyMagInfoInto( Lgm_MagModelInfo *t, Lgm_MagModelInfo *s, int CopyPnts ) {
+
+    if ( ( s == NULL ) || ( t == NULL ) || ( t == s ) ) {
+        printf("Lgm_CopyMagInfoInto: Error, bad source or target structure\n");
+        return( FALSE );
+    }
+    if ( ( t->TraceHistory != NULL ) || t->TS07_Info.TailAlloced ) {
+        printf("Lgm_CopyMagInfoInto: Error, target is not a copy\n");
+        return( FALSE );
+    }
+
+    Lgm_MagModelConfig_Release( t->Config );
+    t->Config = NULL;
+    Lgm_CopyMagInfo_Body( t, s, CopyPnts );
+
+    return( TRUE );
+
+}
+
+
+
+/*
+ *  Add a reference to Config (which may be NULL). Returns Config.
+ */
+Lgm_MagModelConfig *Lgm_MagModelConfig_Retain( Lgm_MagModelConfig *Config ) {
+
+    if ( Config == NULL ) return( NULL );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_MagModelConfig)
+#endif
+    ++Config->nRef;
+
+    return( Config );
+
+}
+
+/*
+ *  Drop a reference to Config, freeing it when the last one goes.
+ */
+void Lgm_MagModelConfig_Release( Lgm_MagModelConfig *Config ) {
+
+    int nRef;
+
+    if ( Config == NULL ) return;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_MagModelConfig)
+#endif
+    nRef = --Config->nRef;
+
+    if ( nRef > 0 ) return;
+
+    if ( Config->TS07_TSS ) LGM_ARRAY_2D_FREE( Config->TS07_TSS );
+    if ( Config->TS07_TSO ) LGM_ARRAY_3D_FREE( Config->TS07_TSO );
+    if ( Config->TS07_TSE ) LGM_ARRAY_3D_FREE( Config->TS07_TSE );
+    free( Config );
+
+}
+
+
+/*
+ *  The Lgm_MagModelInfo structure has pointers in it, so simple
+ *  asignments (e.g. *t = *s) are dangerous. Here we make sure that
+ *  the target gets an independent copy of the structure.
+ */
+Lgm_MagModelInfo *Lgm_CopyMagInfo( Lgm_MagModelInfo *s ) {
+    return( Lgm_CopyMagInfo_Pnts( s, TRUE ) );
+}
+
+
+/*
+ *  Same as Lgm_CopyMagInfo() except that the FL points (s, Px, Py, ...) are
+ *  not copied. This is cheaper and is all that is needed for a scratch copy
+ *  that is only going to be used for tracing.
+ */
+Lgm_MagModelInfo *Lgm_CloneMagInfo( Lgm_MagModelInfo *s ) {
+    return( Lgm_CopyMagInfo_Pnts( s, FALSE ) );
+}
+
+
+/*
+ *  A scratch context for one thread (e.g. in an OpenMP parallel region).
+ *  Like Lgm_CloneMagInfo() it has the same model settings as s but no FL
+ *  points (so no splines either), and it shares s->Config rather than
+ *  copying it. Its evaluation counters start at zero, so that
+ *  they can be folded back into s with Lgm_MagModelInfo_AddStats() when the
+ *  thread is done. Free it with Lgm_FreeMagInfo().
+ */
+Lgm_MagModelInfo *Lgm_NewMagContext( Lgm_MagModelInfo *s ) {
+
+    Lgm_MagModelInfo *t;
+
+    if ( (t = Lgm_CopyMagInfo_Pnts( s, FALSE )) == NULL ) return( NULL );
+
+    t->AllocedSplines = FALSE;
+
+    t->Lgm_nMagEvals = 0;
 
     return( t );
 
@@ -279,6 +680,8 @@ void Lgm_MagModelInfo_Set_MagModel( int InternalModel, int ExternalModel, Lgm_Ma
 
     m->InternalModel = InternalModel;
     m->ExternalModel = ExternalModel;
+    m->BfieldBatch   = NULL; // Lgm_B_Batch() will pick the native batch kernel for m->Bfield
+    m->BfieldWithJacobian = NULL; // Lgm_B_Jacobian() will pick the native Jacobian routine for m->Bfield
 
     switch ( m->ExternalModel ) {
 
@@ -381,6 +784,36 @@ m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
 m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
                                 break;
 
+        case LGM_EXTMODEL_GRIDDED:
+                                /*
+                                 * The grid itself has to be built with
+                                 * Lgm_B_Gridded_Build() and attached with
+                                 * Lgm_MagModelInfo_Set_Gridded().
+                                 */
+                                m->Bfield = Lgm_B_Gridded;
+                                m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+                                break;
+
+        case LGM_EXTMODEL_RBF_SNAPSHOT:
+                                /*
+                                 * The snapshot has to be opened with
+                                 * Lgm_RBF_Snapshot_Open() and attached with
+                                 * Lgm_MagModelInfo_Set_RBF_Snapshot().
+                                 */
+                                m->Bfield = Lgm_B_FromRBF_Snapshot;
+                                m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+                                break;
+
+        case LGM_EXTMODEL_RBF_SNAPSHOT_PAIR:
+                                /*
+                                 * The snapshots have to be opened with
+                                 * Lgm_RBF_SnapshotPair_Open() and attached with
+                                 * Lgm_MagModelInfo_Set_RBF_SnapshotPair().
+                                 */
+                                m->Bfield = Lgm_B_FromRBF_SnapshotPair;
+                                m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+                                break;
+
 
         default:
                                 printf("Lgm_MagModelInfo_Set_MagModel(): No such B field model.\n");
@@ -390,6 +823,9 @@ m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
 
     }
 
+    // integrator kernels compiled for this model (if there are any)
+    Lgm_MagStep_SelectKernels( m->Bfield, m );
+
 }
 
 /*
@@ -510,3 +946,13 @@ void Lgm_Set_Lgm_B_IGRF_InternalModel(Lgm_MagModelInfo *MagInfo) {
     MagInfo->InternalModel = LGM_IGRF;
 }
 
+/*
+ *  Same as Lgm_Set_Lgm_B_IGRF_InternalModel(), but the IGRF sums are
+ *  truncated by radius to keep the error below Tol nT (see
+ *  Lgm_Set_IGRF_Truncation()). Tol <= 0 turns truncation back off.
+ */
+void Lgm_Set_Lgm_B_IGRF_Truncated_InternalModel(Lgm_MagModelInfo *MagInfo, double Tol) {
+    MagInfo->InternalModel = LGM_IGRF;
+    Lgm_Set_IGRF_Truncation( Tol, MagInfo->c );
+}
+
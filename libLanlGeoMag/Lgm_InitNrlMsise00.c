@@ -3,57 +3,52 @@
 #include "Lgm/Lgm_DynamicMemory.h"
 
 
-Lgm_Msis00Info *InitMsis00( ) {
+/*
+ *  Load the NRLMSISE-00 coefficient tables. A Lgm_Msis00Model is never
+ *  changed once loaded, so one can be shared by any number of
+ *  Lgm_Msis00Info structures (see Lgm_Msis00_InitInfo()), and threads.
+ */
+Lgm_Msis00Model *Lgm_Msis00_LoadModel( ) {
 
     int             i, j;
-    Lgm_Msis00Info *p;
+    Lgm_Msis00Model *m;
 
-    p = (Lgm_Msis00Info *)calloc( 1, sizeof(*p) );
-    
-
-    /*
-     * Set Name, DATE andm TIME identifiers...
-     */
-//    strcpy( p->NAME,   NAME );
-//    strcpy( p->ISDATE, ISDATE );
-//    strcpy( p->ISTIME, ISTIME );
-
-    p->IMR = 0;
+    m = (Lgm_Msis00Model *)calloc( 1, sizeof(*m) );
 
 
     /*
      * Copy over PT array
      */
-    //LGM_ARRAY_1D( p->PT, 150+2, double );
-    LGM_ARRAY_1D( p->PT, 152, double );
-    for ( i=1; i<=150; i++ ) p->PT[i] = PT[i];
+    //LGM_ARRAY_1D( m->PT, 150+2, double );
+    LGM_ARRAY_1D( m->PT, 152, double );
+    for ( i=1; i<=150; i++ ) m->PT[i] = PT[i];
 
 
     /*
      * Set up the PD array in correct order.
      */
-    //LGM_ARRAY_2D( p->PD, 150+2, 9+2, double );
-    LGM_ARRAY_2D( p->PD, 152, 11, double );
+    //LGM_ARRAY_2D( m->PD, 150+2, 9+2, double );
+    LGM_ARRAY_2D( m->PD, 152, 11, double );
     for ( i=1; i<=150; i++ ) {
-        p->PD[i][1] = PA[i];
-//printf("p->PD[%d][1] = %g  PA[%d] = %g\n", i, p->PD[i][1], i, PA[i]);
+        m->PD[i][1] = PA[i];
+//printf("m->PD[%d][1] = %g  PA[%d] = %g\n", i, m->PD[i][1], i, PA[i]);
     }
 
-    for ( i=1; i<=150; i++ ) p->PD[i][1] = PA[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][2] = PB[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][3] = PC[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][4] = PD[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][5] = PE[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][6] = PF[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][7] = PG[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][8] = PH[i];
-    for ( i=1; i<=150; i++ ) p->PD[i][9] = PI[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][1] = PA[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][2] = PB[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][3] = PC[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][4] = PD[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][5] = PE[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][6] = PF[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][7] = PG[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][8] = PH[i];
+    for ( i=1; i<=150; i++ ) m->PD[i][9] = PI[i];
     // Also set up a C-style row-major version of this array.
-    //LGM_ARRAY_2D( p->PMA, 9+2, 150+2, double );
-    LGM_ARRAY_2D( p->PD_rc, 9+2, 150+2, double );
+    //LGM_ARRAY_2D( m->PMA, 9+2, 150+2, double );
+    LGM_ARRAY_2D( m->PD_rc, 9+2, 150+2, double );
     for ( i=1; i<=150; i++ ) {
         for ( j=1; j<=9; j++ ) {
-            p->PD_rc[j][i] = p->PD[i][j];
+            m->PD_rc[j][i] = m->PD[i][j];
         }
     }
 
@@ -61,32 +56,32 @@ Lgm_Msis00Info *InitMsis00( ) {
     /*
      * Copy over PS array
      */
-    LGM_ARRAY_1D( p->PS, 150+2, double );
-    for ( i=1; i<=150; i++ ) p->PS[i] = PJ[i];
+    LGM_ARRAY_1D( m->PS, 150+2, double );
+    for ( i=1; i<=150; i++ ) m->PS[i] = PJ[i];
 
 
 
     /*
      * Set up the PDL array in correct order.
      */
-    LGM_ARRAY_2D( p->PDL, 25+1, 2+1, double );
-    for ( i=1; i<=25; i++ ) p->PDL[i][1] = PK1[i];
-    for ( i=1; i<=25; i++ ) p->PDL[i][2] = PK1[i+25];
+    LGM_ARRAY_2D( m->PDL, 25+1, 2+1, double );
+    for ( i=1; i<=25; i++ ) m->PDL[i][1] = PK1[i];
+    for ( i=1; i<=25; i++ ) m->PDL[i][2] = PK1[i+25];
 
 
     /*
      * Set up the PD array in correct order.
      */
-    LGM_ARRAY_2D( p->PTL, 150+1, 9+1, double );
-    for ( i=1; i<=150; i++ ) p->PTL[i][1] = PL[i];
-    for ( i=1; i<=150; i++ ) p->PTL[i][2] = PM[i];
-    for ( i=1; i<=150; i++ ) p->PTL[i][3] = PN[i];
-    for ( i=1; i<=150; i++ ) p->PTL[i][4] = PO[i];
+    LGM_ARRAY_2D( m->PTL, 150+1, 9+1, double );
+    for ( i=1; i<=150; i++ ) m->PTL[i][1] = PL[i];
+    for ( i=1; i<=150; i++ ) m->PTL[i][2] = PM[i];
+    for ( i=1; i<=150; i++ ) m->PTL[i][3] = PN[i];
+    for ( i=1; i<=150; i++ ) m->PTL[i][4] = PO[i];
     // Also set up a C-style row-major version of this array.
-    LGM_ARRAY_2D( p->PTL_rc, 9+1, 150+1, double );
+    LGM_ARRAY_2D( m->PTL_rc, 9+1, 150+1, double );
     for ( i=1; i<=150; i++ ) {
         for ( j=1; j<=9; j++ ) {
-            p->PTL_rc[j][i] = p->PTL[i][j];
+            m->PTL_rc[j][i] = m->PTL[i][j];
         }
     }
 
@@ -94,22 +89,22 @@ Lgm_Msis00Info *InitMsis00( ) {
     /*
      * Set up the PD array in correct order.
      */
-    LGM_ARRAY_2D( p->PMA, 100+1, 10+1, double );
-    for ( i=1; i<=100; i++ ) p->PMA[i][1]  = PP[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][2]  = PQ[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][3]  = PR[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][4]  = PS[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][5]  = PU[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][6]  = PV[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][7]  = PW[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][8]  = PX[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][9]  = PY[i];
-    for ( i=1; i<=100; i++ ) p->PMA[i][10] = PZ[i];
+    LGM_ARRAY_2D( m->PMA, 100+1, 10+1, double );
+    for ( i=1; i<=100; i++ ) m->PMA[i][1]  = PP[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][2]  = PQ[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][3]  = PR[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][4]  = PS[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][5]  = PU[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][6]  = PV[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][7]  = PW[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][8]  = PX[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][9]  = PY[i];
+    for ( i=1; i<=100; i++ ) m->PMA[i][10] = PZ[i];
     // Also set up a C-style row-major version of this array.
-    LGM_ARRAY_2D( p->PMA_rc, 10+1, 100+1, double );
+    LGM_ARRAY_2D( m->PMA_rc, 10+1, 100+1, double );
     for ( i=1; i<=100; i++ ) {
         for ( j=1; j<=10; j++ ) {
-            p->PMA_rc[j][i] = p->PMA[i][j];
+            m->PMA_rc[j][i] = m->PMA[i][j];
         }
     }
     
@@ -119,36 +114,117 @@ Lgm_Msis00Info *InitMsis00( ) {
     /*
      * Copy over SAM array
      */
-    LGM_ARRAY_1D( p->SAM, 100+1, double );
-    for ( i=1; i<=100; i++ ) p->SAM[i] = PAA[i];
+    LGM_ARRAY_1D( m->SAM, 100+1, double );
+    for ( i=1; i<=100; i++ ) m->SAM[i] = PAA[i];
 
 
     /*
      * Copy over PAVGM array
      */
-    LGM_ARRAY_1D( p->PAVGM, 10+1, double );
-    for ( i=1; i<=10; i++ ) p->PAVGM[i] = PAVGM[i];
+    LGM_ARRAY_1D( m->PAVGM, 10+1, double );
+    for ( i=1; i<=10; i++ ) m->PAVGM[i] = PAVGM[i];
 
 
     /*
      * Copy over PTM array
      */
-    LGM_ARRAY_1D( p->PTM, 100+1, double );
-    for ( i=1; i<=100; i++ ) p->PTM[i] = PTM[i];
+    LGM_ARRAY_1D( m->PTM, 100+1, double );
+    for ( i=1; i<=100; i++ ) m->PTM[i] = PTM[i];
 
 
     /*
      * Set up the PDM array in correct order.
      */
-    LGM_ARRAY_2D( p->PDM, 10+1, 8+1, double );
-    for ( i=1; i<=10; i++ ) p->PDM[i][1] = PDM[1][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][2] = PDM[2][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][3] = PDM[3][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][4] = PDM[4][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][5] = PDM[5][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][6] = PDM[6][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][7] = PDM[7][i];
-    for ( i=1; i<=10; i++ ) p->PDM[i][8] = PDM[8][i];
+    LGM_ARRAY_2D( m->PDM, 10+1, 8+1, double );
+    for ( i=1; i<=10; i++ ) m->PDM[i][1] = PDM[1][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][2] = PDM[2][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][3] = PDM[3][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][4] = PDM[4][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][5] = PDM[5][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][6] = PDM[6][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][7] = PDM[7][i];
+    for ( i=1; i<=10; i++ ) m->PDM[i][8] = PDM[8][i];
+
+
+    /*
+     *  GLOB7S() sets P(100) of its parameter sets to 2 if it is 0, and
+     *  GLOBE7() raises P(25) of its sets to at least 1e-4 (when it is used).
+     *  Do that here, once, so that the tables are really read-only.
+     */
+    for ( j=1; j<=9; j++ )  if ( m->PTL_rc[j][100] == 0.0 ) m->PTL_rc[j][100] = 2.0;
+    for ( j=1; j<=10; j++ ) if ( m->PMA_rc[j][100] == 0.0 ) m->PMA_rc[j][100] = 2.0;
+    if ( m->PT[25] < 1.0e-4 ) m->PT[25] = 1.0e-4;
+    if ( m->PS[25] < 1.0e-4 ) m->PS[25] = 1.0e-4;
+    for ( j=1; j<=9; j++ )  if ( m->PD_rc[j][25] < 1.0e-4 ) m->PD_rc[j][25] = 1.0e-4;
+
+    return( m );
+
+}
+
+
+void Lgm_Msis00_FreeModel( Lgm_Msis00Model *m ) {
+
+    LGM_ARRAY_1D_FREE( m->PT );
+    LGM_ARRAY_2D_FREE( m->PD );
+    LGM_ARRAY_2D_FREE( m->PD_rc );
+    LGM_ARRAY_1D_FREE( m->PS );
+    LGM_ARRAY_2D_FREE( m->PDL );
+    LGM_ARRAY_2D_FREE( m->PTL );
+    LGM_ARRAY_2D_FREE( m->PTL_rc );
+    LGM_ARRAY_2D_FREE( m->PMA );
+    LGM_ARRAY_2D_FREE( m->PMA_rc );
+    LGM_ARRAY_1D_FREE( m->SAM );
+    LGM_ARRAY_1D_FREE( m->PAVGM );
+    LGM_ARRAY_1D_FREE( m->PTM );
+    LGM_ARRAY_2D_FREE( m->PDM );
+
+    free( m );
+
+    return;
+}
+
+
+/*
+ *  A Lgm_Msis00Info (switches, cached intermediate values and work space)
+ *  that uses the tables of m. This is cheap, so each thread can have its own.
+ *  m must outlive it.
+ */
+Lgm_Msis00Info *Lgm_Msis00_InitInfo( Lgm_Msis00Model *m ) {
+
+    int             i, j;
+    Lgm_Msis00Info *p;
+
+    p = (Lgm_Msis00Info *)calloc( 1, sizeof(*p) );
+
+
+    /*
+     * Set Name, DATE andm TIME identifiers...
+     */
+//    strcpy( p->NAME,   NAME );
+//    strcpy( p->ISDATE, ISDATE );
+//    strcpy( p->ISTIME, ISTIME );
+
+    p->IMR = 0;
+
+
+    /*
+     * The coefficient tables
+     */
+    p->Model    = m;
+    p->OwnModel = 0;
+    p->PT     = m->PT;
+    p->PD     = m->PD;
+    p->PD_rc  = m->PD_rc;
+    p->PS     = m->PS;
+    p->PDL    = m->PDL;
+    p->PTL    = m->PTL;
+    p->PTL_rc = m->PTL_rc;
+    p->PMA    = m->PMA;
+    p->PMA_rc = m->PMA_rc;
+    p->SAM    = m->SAM;
+    p->PAVGM  = m->PAVGM;
+    p->PTM    = m->PTM;
+    p->PDM    = m->PDM;
 
 
     // SWITCH Arrays and vars
@@ -235,35 +311,52 @@ Lgm_Msis00Info *InitMsis00( ) {
 }
 
 
-void Lgm_FreeMsis00( Lgm_Msis00Info *p ) {
+/*
+ *  A Lgm_Msis00Info like p (same model, switches and units) but with its own
+ *  work space, e.g. for another thread.
+ */
+Lgm_Msis00Info *Lgm_Msis00_CopyInfo( Lgm_Msis00Info *p ) {
 
-    LGM_ARRAY_1D_FREE( p->PT );
-    LGM_ARRAY_2D_FREE( p->PD );
-    LGM_ARRAY_2D_FREE( p->PD_rc );
-    LGM_ARRAY_1D_FREE( p->PS );
-    LGM_ARRAY_2D_FREE( p->PDL );
-    LGM_ARRAY_2D_FREE( p->PTL );
-    LGM_ARRAY_2D_FREE( p->PTL_rc );
-    LGM_ARRAY_2D_FREE( p->PMA );
-    LGM_ARRAY_2D_FREE( p->PMA_rc );
-    LGM_ARRAY_1D_FREE( p->SAM );
-    LGM_ARRAY_1D_FREE( p->PAVGM );
-    LGM_ARRAY_1D_FREE( p->PTM );
-    LGM_ARRAY_2D_FREE( p->PDM );
-    LGM_ARRAY_1D_FREE( p->SW );
-    LGM_ARRAY_1D_FREE( p->SWC );
+    int             i;
+    Lgm_Msis00Info *q;
 
-    free( p );
+    q = Lgm_Msis00_InitInfo( p->Model );
+    q->IMR = p->IMR;
+    q->ISW = p->ISW;
+    for ( i=1; i<=25; i++ ) {
+        q->SV[i]  = p->SV[i];
+        q->SAV[i] = p->SAV[i];
+        q->SW[i]  = p->SW[i];
+        q->SWC[i] = p->SWC[i];
+    }
+
+    return( q );
 
-    return;
 }
 
 
+/*
+ *  Load the model and set up a Lgm_Msis00Info that uses (and owns) it.
+ */
+Lgm_Msis00Info *InitMsis00( ) {
+
+    Lgm_Msis00Info *p;
 
+    p = Lgm_Msis00_InitInfo( Lgm_Msis00_LoadModel( ) );
+    p->OwnModel = 1;
 
+    return( p );
 
+}
 
 
+void Lgm_FreeMsis00( Lgm_Msis00Info *p ) {
 
+    LGM_ARRAY_1D_FREE( p->SW );
+    LGM_ARRAY_1D_FREE( p->SWC );
+    if ( p->OwnModel ) Lgm_Msis00_FreeModel( p->Model );
 
+    free( p );
 
+    return;
+}
@@ -6,6 +6,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 #include "Lgm/Lgm_Vec.h"
 #include "Lgm/Lgm_HDF5.h"
 #include "Lgm/Lgm_JPLeph.h"
@@ -16,6 +22,118 @@
 #endif
 
 
+/*
+ *  Objects (and their datasets in the HDF5 file) for each slot of jpl->Rec[].
+ */
+static const int Lgm_JPL_Objects[LGM_DE_NRECORDS] = { LGM_DE_SUN, LGM_DE_EARTHMOON, LGM_DE_MOON, LGM_DE_MERCURY, LGM_DE_VENUS,
+                                                      LGM_DE_MARS, LGM_DE_JUPITER, LGM_DE_SATURN, LGM_DE_URANUS, LGM_DE_NEPTUNE,
+                                                      LGM_DE_PLUTO, LGM_DE_LIBRATION, LGM_DE_NUTATION };
+static const char *Lgm_JPL_DataSetNames[LGM_DE_NRECORDS] = { "/Sun", "/EarthMoon", "/Moon", "/Mercury", "/Venus",
+                                                             "/Mars", "/Jupiter", "/Saturn", "/Uranus", "/Neptune",
+                                                             "/Pluto", "/Librations", "/Nutations" };
+
+static int Lgm_JPL_Slot( int objName ) {
+    int Slot;
+    for (Slot=0; Slot<LGM_DE_NRECORDS; Slot++) {
+        if ( Lgm_JPL_Objects[Slot] == objName ) return( Slot );
+        }
+    return( -1 );
+    }
+
+static int Lgm_JPL_Wanted( int Slot, Lgm_JPLephemInfo *jpl ) {
+    switch (Slot) {
+        case 0:                         return( jpl->getSun );
+        case 1: case 2:                 return( jpl->getEarth );
+        case 3: case 4: case 5:         return( jpl->getInnerPlanets );
+        case 6: case 7: case 8:
+        case 9: case 10:                return( jpl->getOuterPlanets );
+        case 11: case 12:               return( jpl->getLibrationNutation );
+        default:                        return( FALSE );
+        }
+    }
+
+/*
+ *  Keep the per-object dimension fields in step with jpl->Rec[] (they are
+ *  what Lgm_JPL_getNSets() etc. return).
+ */
+static void Lgm_JPL_SetDims( int Slot, int nSets, int nAxes, int nCoeffs, Lgm_JPLephemInfo *jpl ) {
+    int *d[3];
+    switch (Slot) {
+        case 0:  d[0] = &jpl->sun_nvals;            d[1] = &jpl->sun_naxes;            d[2] = &jpl->sun_ncoeffs;            break;
+        case 1:  d[0] = &jpl->earthmoon_nvals;      d[1] = &jpl->earthmoon_naxes;      d[2] = &jpl->earthmoon_ncoeffs;      break;
+        case 2:  d[0] = &jpl->moon_wrt_earth_nvals; d[1] = &jpl->moon_wrt_earth_naxes; d[2] = &jpl->moon_wrt_earth_ncoeffs; break;
+        case 3:  d[0] = &jpl->mercury_nvals;        d[1] = &jpl->mercury_naxes;        d[2] = &jpl->mercury_ncoeffs;        break;
+        case 4:  d[0] = &jpl->venus_nvals;          d[1] = &jpl->venus_naxes;          d[2] = &jpl->venus_ncoeffs;          break;
+        case 5:  d[0] = &jpl->mars_nvals;           d[1] = &jpl->mars_naxes;           d[2] = &jpl->mars_ncoeffs;           break;
+        case 6:  d[0] = &jpl->jupiter_nvals;        d[1] = &jpl->jupiter_naxes;        d[2] = &jpl->jupiter_ncoeffs;        break;
+        case 7:  d[0] = &jpl->saturn_nvals;         d[1] = &jpl->saturn_naxes;         d[2] = &jpl->saturn_ncoeffs;         break;
+        case 8:  d[0] = &jpl->uranus_nvals;         d[1] = &jpl->uranus_naxes;         d[2] = &jpl->uranus_ncoeffs;         break;
+        case 9:  d[0] = &jpl->neptune_nvals;        d[1] = &jpl->neptune_naxes;        d[2] = &jpl->neptune_ncoeffs;        break;
+        case 10: d[0] = &jpl->pluto_nvals;          d[1] = &jpl->pluto_naxes;          d[2] = &jpl->pluto_ncoeffs;          break;
+        case 11: d[0] = &jpl->libration_nvals;      d[1] = &jpl->libration_naxes;      d[2] = &jpl->libration_ncoeffs;      break;
+        case 12: d[0] = &jpl->nutation_nvals;       d[1] = &jpl->nutation_naxes;       d[2] = &jpl->nutation_ncoeffs;       break;
+        default: return;
+        }
+    *d[0] = nSets; *d[1] = nAxes; *d[2] = nCoeffs;
+    }
+
+/*
+ *  Release whatever Lgm_OpenJPLephem() set up.
+ */
+static void Lgm_JPL_CloseRecords( Lgm_JPLephemInfo *jpl ) {
+    int Slot;
+    for (Slot=0; Slot<LGM_DE_NRECORDS; Slot++) {
+        if ( jpl->Rec[Slot].DataSet > 0 ) { H5Dclose( (hid_t)jpl->Rec[Slot].DataSet ); }
+        if ( jpl->Rec[Slot].Buf != NULL ) { LGM_ARRAY_1D_FREE( jpl->Rec[Slot].Buf ); }
+        }
+    if ( jpl->File > 0 ) { H5Fclose( (hid_t)jpl->File ); }
+#ifdef HAVE_SYS_MMAN_H
+    if ( jpl->MapBase != NULL ) { munmap( jpl->MapBase, jpl->MapSize ); }
+#endif
+    memset( jpl->Rec, 0, sizeof(jpl->Rec) );
+    jpl->File    = 0;
+    jpl->MapBase = NULL;
+    jpl->MapSize = 0;
+    jpl->Mapped  = FALSE;
+    }
+
+/*
+ *  Full name of the DE file (from $JPL_EPHEM_PATH, or LGM_INDEX_DATA_DIR/DE_FILES).
+ */
+static void Lgm_JPLephemFilename( Lgm_JPLephemInfo *jpl, char *JPLephemFile ) {
+
+    char        *Path, JPLephemPath[2048];
+    char        eph_num[14];
+
+    Path = getenv( "JPL_EPHEM_PATH" );
+    if ( Path == NULL ) {
+
+        strcpy( JPLephemPath, LGM_INDEX_DATA_DIR );
+        strcat( JPLephemPath, "/DE_FILES" );
+
+    } else {
+        /*
+         * Test for existence
+         */
+        struct stat sts;
+        if ( ( stat( Path, &sts ) ) == -1 ) {
+            strcpy( JPLephemPath, LGM_INDEX_DATA_DIR );
+            strcat( JPLephemPath, "/DE_FILES" );
+            printf("Environment variable JPL_EPHEM_PATH points to a non-existent directory: %s. Setting JPLephemPath to: %s \n", Path, JPLephemPath );
+        } else {
+            strcpy( JPLephemPath, Path );
+        }
+
+    }
+
+    // jpl structure has member DEnum that should be cast to a string
+    sprintf( eph_num, "/jpl_de%d.h5", jpl->DEnum );
+    strcpy( JPLephemFile, JPLephemPath );
+    strcat( JPLephemFile, eph_num );
+
+}
+
+
 Lgm_JPLephemInfo *Lgm_InitJPLephemInfo( int DEnum, int getBodies, int verbosity ) {
 
     Lgm_JPLephemInfo  *jpl = (Lgm_JPLephemInfo *) calloc (1, sizeof(Lgm_JPLephemInfo));
@@ -41,6 +159,8 @@ void Lgm_InitJPLephDefaults( int DEnum, int getBodies, int verbosity, Lgm_JPLeph
 
 void Lgm_FreeJPLephemInfo( Lgm_JPLephemInfo *jpl ) {
 
+    Lgm_JPL_CloseRecords( jpl );
+
     if ( jpl->SunAlloced ) { 
         LGM_ARRAY_3D_FREE( jpl->sun );
     }
@@ -76,10 +196,9 @@ void Lgm_FreeJPLephemInfo( Lgm_JPLephemInfo *jpl ) {
 
 void Lgm_ReadJPLephem( Lgm_JPLephemInfo *jpl ) {
 
-    double      *JDparams;
-    char        *Path, JPLephemPath[2048];
-    char        eph_num[14], JPLephemFile[2048];
-    int         StatError, InFileExists;
+    double      *JDparams, ***cheby;
+    char        JPLephemFile[2048];
+    int         StatError, InFileExists, Slot, objName;
     struct stat StatBuf;
     herr_t      status;
     hid_t       file;
@@ -88,31 +207,7 @@ void Lgm_ReadJPLephem( Lgm_JPLephemInfo *jpl ) {
     /*
      * read from HDF5 file
      */
-    Path = getenv( "JPL_EPHEM_PATH" );
-    if ( Path == NULL ) {
-
-        strcpy( JPLephemPath, LGM_INDEX_DATA_DIR );
-        strcat( JPLephemPath, "/DE_FILES" );
-
-    } else {
-        /*
-         * Test for existence
-         */
-        struct stat sts;
-        if ( ( stat( Path, &sts ) ) == -1 ) {
-            strcpy( JPLephemPath, LGM_INDEX_DATA_DIR );
-            strcat( JPLephemPath, "/DE_FILES" );
-            printf("Environment variable JPL_EPHEM_PATH points to a non-existent directory: %s. Setting JPLephemPath to: %s \n", Path, JPLephemPath );
-        } else {
-            strcpy( JPLephemPath, Path );
-        }
-
-    }
-
-    // jpl structure has member DEnum that should be cast to a string
-    sprintf( eph_num, "/jpl_de%d.h5", jpl->DEnum );
-    strcpy( JPLephemFile, JPLephemPath );
-    strcat( JPLephemFile, eph_num );
+    Lgm_JPLephemFilename( jpl, JPLephemFile );
 
     InFileExists = ( (StatError = stat( JPLephemFile, &StatBuf )) != -1 ) ? TRUE : FALSE;
 
@@ -177,6 +272,19 @@ void Lgm_ReadJPLephem( Lgm_JPLephemInfo *jpl ) {
         //now close up
         status = H5Fclose( file );
 
+        // point the record table at the arrays
+        for (Slot=0; Slot<LGM_DE_NRECORDS; Slot++) {
+            objName = Lgm_JPL_Objects[Slot];
+            cheby   = Lgm_JPL_getCoeffSet( objName, jpl );
+            if ( ( cheby != NULL ) && ( Lgm_JPL_getNCoeffs( objName, jpl ) <= LGM_DE_MAX_COEFFS ) ) {
+                jpl->Rec[Slot].nSets   = Lgm_JPL_getNSets( objName, jpl );
+                jpl->Rec[Slot].nAxes   = Lgm_JPL_getNAxes( objName, jpl );
+                jpl->Rec[Slot].nCoeffs = Lgm_JPL_getNCoeffs( objName, jpl );
+                jpl->Rec[Slot].Data    = &cheby[0][0][0];
+                jpl->Rec[Slot].Index   = -1;
+            }
+        }
+
     } else {
 
         printf("Problem encountered finding/opening the specified definitive ephemeris file (%s)\n", JPLephemFile);
@@ -187,88 +295,255 @@ void Lgm_ReadJPLephem( Lgm_JPLephemInfo *jpl ) {
 }
 
 
-void Lgm_JPLephem_setup_object( int objName, Lgm_JPLephemInfo *jpl, Lgm_JPLephemBundle *bundle ) {
-    
-    double days_per_set, offset, tdb;
-    int    index, number_of_sets, number_of_axes, coefficient_count;
-    int    ii, jj, omegas;
-    double vx, wx, div, mod, floordiv, t1, twot1;
-    double *T, ***cheby, **coefficients;
-
-    tdb = bundle->tdb;
-    if ((tdb < jpl->jalpha) || (tdb > jpl->jomega)) { 
-        printf("Time (JD) is %15.8lf but must be between %15.8lf and %15.8lf\n", tdb, jpl->jalpha, jpl->jomega);
-        exit(-1);
+/**
+ *  \brief
+ *      Open a DE ephemeris file for lazy, record-by-record access.
+ *
+ *  \details
+ *      This is an alternative to Lgm_ReadJPLephem(). Rather than reading every
+ *      coefficient set of every requested body into memory up front, the file
+ *      is memory-mapped and each body's Chebyshev records are used in place,
+ *      so only the pages holding the records that are actually evaluated ever
+ *      get read (a year of Sun/Earth/Moon positions touches well under 1% of
+ *      a DE421 file).  This requires the datasets to be stored contiguously as
+ *      native doubles, which is how the DE_FILES are written. Any dataset that
+ *      isn't (or all of them, if mmap() isn't available) is instead read one
+ *      record at a time with an HDF5 hyperslab read.
+ *
+ *      In both cases the last record used for each body is cached in
+ *      jpl->Rec[], which makes runs of nearby times cheap. The cache lives in
+ *      the Lgm_JPLephemInfo, so one of these shouldn't be shared between
+ *      threads (each Lgm_CTrans has its own).
+ *
+ *      Lgm_JPL_getCoeffSet() returns NULL for an info structure opened this
+ *      way; everything else (Lgm_JPLephem_position(), Lgm_JPL_getNSets(),
+ *      etc.) works the same as after Lgm_ReadJPLephem().
+ *
+ *      \param[in,out]  jpl     Structure from Lgm_InitJPLephemInfo().
+ *
+ *      \return         TRUE on success, FALSE if the file (or a requested dataset) could not be opened.
+ */
+int Lgm_OpenJPLephem( Lgm_JPLephemInfo *jpl ) {
+
+    double              *JDparams;
+    char                JPLephemFile[2048];
+    int                 Slot, Rank, nMapped = 0, nRead = 0;
+    struct stat         StatBuf;
+    hid_t               file, DataSet, DataSpace, Type, Plist;
+    hsize_t             dims[4], UserBlock = 0;
+    haddr_t             Addr;
+    size_t              Size;
+    Lgm_JPLephemRecord  *r;
+#ifdef HAVE_SYS_MMAN_H
+    int                 fd;
+    void                *p;
+#endif
+
+    Lgm_JPL_CloseRecords( jpl );
+    Lgm_JPLephemFilename( jpl, JPLephemFile );
+
+    if ( ( stat( JPLephemFile, &StatBuf ) == -1 ) || ( H5Fis_hdf5( JPLephemFile ) <= 0 )
+            || ( ( file = H5Fopen( JPLephemFile, H5F_ACC_RDONLY, H5P_DEFAULT ) ) < 0 ) ) {
+        printf("Problem encountered finding/opening the specified definitive ephemeris file (%s)\n", JPLephemFile);
+        return( FALSE );
+    }
+
+    // dataset addresses are relative to the end of the user block (if any)
+    Plist = H5Fget_create_plist( file );
+    H5Pget_userblock( Plist, &UserBlock );
+    H5Pclose( Plist );
+
+#ifdef HAVE_SYS_MMAN_H
+    if ( ( fd = open( JPLephemFile, O_RDONLY ) ) >= 0 ) {
+        p = mmap( NULL, (size_t)StatBuf.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( p != MAP_FAILED ) {
+            jpl->MapBase = p;
+            jpl->MapSize = (size_t)StatBuf.st_size;
         }
+    }
+#endif
 
-    /* get DEXXX specific info */
-    number_of_sets = Lgm_JPL_getNSets( objName, jpl);
-    number_of_axes = Lgm_JPL_getNAxes( objName, jpl);
-    coefficient_count = Lgm_JPL_getNCoeffs( objName, jpl);
+    JDparams = Get_DoubleDataset_1D( file, "/JDparams", dims);
+    jpl->jalpha = JDparams[0];
+    jpl->jomega = JDparams[1];
+    jpl->jdelta = JDparams[2];
+    LGM_ARRAY_1D_FREE( JDparams );
 
-    if ((number_of_sets == -1) || (number_of_axes == -1) || (coefficient_count == -1)) {
-        printf("Invalid number of sets (%d), axes (%d) or coeffs (%d) for object %d\n", number_of_sets, number_of_axes, coefficient_count, objName);
-        exit(-1);
+    for (Slot=0; Slot<LGM_DE_NRECORDS; Slot++) {
+
+        if ( !Lgm_JPL_Wanted( Slot, jpl ) ) continue;
+        r = &jpl->Rec[Slot];
+
+        if ( ( DataSet = H5Dopen( file, Lgm_JPL_DataSetNames[Slot], H5P_DEFAULT ) ) < 0 ) {
+            printf("Lgm_OpenJPLephem: dataset %s not found in %s\n", Lgm_JPL_DataSetNames[Slot], JPLephemFile );
+            H5Fclose( file );
+            Lgm_JPL_CloseRecords( jpl );
+            return( FALSE );
         }
-    days_per_set = (jpl->jomega - jpl->jalpha) / number_of_sets;
-    cheby = Lgm_JPL_getCoeffSet(objName, jpl);
-
-    /* borrow divmod implementation from Python to get index and offset */
-    vx = tdb - jpl->jalpha;
-    wx = days_per_set;
-    mod = fmod(vx, wx);
-    div = (vx - mod) / wx;
-    if (mod) {
-        /* ensure the remainder has the same sign as the denominator */
-        if ((wx < 0) != (mod < 0)) {
-            mod += wx;
-            div -= 1.0;
+        DataSpace = H5Dget_space( DataSet );
+        Rank      = H5Sget_simple_extent_ndims( DataSpace );
+        if ( Rank == 3 ) H5Sget_simple_extent_dims( DataSpace, dims, NULL );
+        H5Sclose( DataSpace );
+        if ( ( Rank != 3 ) || ( dims[1] < 1 ) || ( dims[2] < 2 ) || ( dims[2] > LGM_DE_MAX_COEFFS ) ) {
+            printf("Lgm_OpenJPLephem: dataset %s in %s has an unexpected shape\n", Lgm_JPL_DataSetNames[Slot], JPLephemFile );
+            H5Dclose( DataSet );
+            H5Fclose( file );
+            Lgm_JPL_CloseRecords( jpl );
+            return( FALSE );
         }
+        r->nSets   = (int)dims[0];
+        r->nAxes   = (int)dims[1];
+        r->nCoeffs = (int)dims[2];
+        r->Index   = -1;
+        Lgm_JPL_SetDims( Slot, r->nSets, r->nAxes, r->nCoeffs, jpl );
+
+        /*
+         *  Use the data in place if it is a contiguous block of native doubles
+         *  inside the mapping.
+         */
+        Type  = H5Dget_type( DataSet );
+        Plist = H5Dget_create_plist( DataSet );
+        Addr  = H5Dget_offset( DataSet );
+        Size  = (size_t)dims[0]*dims[1]*dims[2]*sizeof(double);
+        if ( ( jpl->MapBase != NULL ) && ( H5Tequal( Type, H5T_NATIVE_DOUBLE ) > 0 ) && ( H5Pget_layout( Plist ) == H5D_CONTIGUOUS )
+                && ( Addr != HADDR_UNDEF ) && ( (UserBlock + Addr) % sizeof(double) == 0 ) && ( UserBlock + Addr + Size <= jpl->MapSize ) ) {
+            r->Data = (const double *)( (const char *)jpl->MapBase + UserBlock + Addr );
+            H5Dclose( DataSet );
+            ++nMapped;
+        } else {
+            r->DataSet = (long long)DataSet;
+            LGM_ARRAY_1D( r->Buf, r->nAxes*r->nCoeffs, double );
+            ++nRead;
+        }
+        H5Tclose( Type );
+        H5Pclose( Plist );
+
     }
-    else {
-        mod *= mod;  /* hide "mod = +0" from optimizer */
-        if (wx < 0.0)
-            mod = -mod;
+
+    if ( nRead > 0 ) {
+        jpl->File = (long long)file;
+    } else {
+        H5Fclose( file );
     }
-    /* snap quotient to nearest integral value */
-    if (div) {
-        floordiv = floor(div);
-        if (div - floordiv > 0.5)
-            floordiv += 1.0;
+#ifdef HAVE_SYS_MMAN_H
+    if ( ( nMapped == 0 ) && ( jpl->MapBase != NULL ) ) {
+        munmap( jpl->MapBase, jpl->MapSize );
+        jpl->MapBase = NULL;
+        jpl->MapSize = 0;
     }
-    else {
-        /* div is zero - get the same sign as the true quotient */
-        div *= div;             /* hide "div = +0" from optimizers */
-        floordiv = div * vx / wx; /* zero w/ sign of vx/wx */
+#endif
+    jpl->Mapped = TRUE;
+
+    if (jpl->verbosity > 1) {
+        printf("Opened JPL definitive ephemeris %s (%d datasets mapped, %d read by record)\n", JPLephemFile, nMapped, nRead);
     }
-    index = (int)floordiv;
-    offset = mod;
 
-    /* extract right set of Chebyshev coefficients */
-    omegas = (index==number_of_sets) ? 1 : 0;
-    /* if at the end of the interval, roll back to the last set of coefficients and add offset */
-    index = (omegas) ? index-1 : index;
-    offset = (omegas) ? offset+days_per_set : offset;
-    
-    /* TODO: Check whether this can just be done with a straight assignment like
-     * coefficients = cheby[index];
-     */
-    LGM_ARRAY_2D( coefficients, number_of_axes, coefficient_count, double );
-    for (ii=0; ii<number_of_axes; ii++) {
-        for (jj=0; jj<coefficient_count; jj++) {
-                coefficients[ii][jj] = cheby[index][ii][jj];
-            }
+    return( TRUE );
+
+}
+
+
+/*
+ *  Return the record of Chebyshev coefficients ([ AxisIndex ][ CoefficientIndex ])
+ *  for objName that covers tdb, along with the offset of tdb into it. The
+ *  record last used for each object is cached, so this only has to find (and
+ *  possibly read) a new one when tdb moves out of it.
+ */
+static const double *Lgm_JPL_Record( int objName, double tdb, Lgm_JPLephemInfo *jpl, double *Offset, double *DaysPerSet, int *nAxes, int *nCoeffs ) {
+
+    int                 Slot, Index;
+    double              v, days_per_set;
+    hid_t               DataSpace, MemSpace;
+    hsize_t             Start[3], Count[3];
+    Lgm_JPLephemRecord  *r;
+
+    if ((tdb < jpl->jalpha) || (tdb > jpl->jomega)) {
+        printf("Time (JD) is %15.8lf but must be between %15.8lf and %15.8lf\n", tdb, jpl->jalpha, jpl->jomega);
+        exit(-1);
         }
-    
-    /* Chebyshev recurrence */
-    LGM_ARRAY_1D( T, coefficient_count, double );
+
+    Slot = Lgm_JPL_Slot( objName );
+    r    = ( Slot >= 0 ) ? &jpl->Rec[Slot] : NULL;
+    if ( ( r == NULL ) || ( r->nSets <= 0 ) || ( ( r->Data == NULL ) && ( r->DataSet <= 0 ) ) ) {
+        printf("Invalid number of sets (%d), axes (%d) or coeffs (%d) for object %d\n", Lgm_JPL_getNSets( objName, jpl ),
+                    Lgm_JPL_getNAxes( objName, jpl ), Lgm_JPL_getNCoeffs( objName, jpl ), objName);
+        exit(-1);
+        }
+
+    days_per_set = (jpl->jomega - jpl->jalpha) / r->nSets;
+    v = tdb - jpl->jalpha;
+
+    if ( ( r->Index < 0 ) || ( v < r->v0 ) || ( ( v >= r->v0 + days_per_set ) && ( r->Index < r->nSets-1 ) ) ) {
+
+        /* if at the end of the interval, roll back to the last set of coefficients */
+        Index = (int)floor( v / days_per_set );
+        if ( Index < 0 ) Index = 0;
+        if ( Index > r->nSets-1 ) Index = r->nSets-1;
+
+        if ( r->Data != NULL ) {
+            r->Coeffs = r->Data + (size_t)Index*r->nAxes*r->nCoeffs;
+        } else {
+            Start[0] = Index;   Start[1] = 0;           Start[2] = 0;
+            Count[0] = 1;       Count[1] = r->nAxes;    Count[2] = r->nCoeffs;
+            DataSpace = H5Dget_space( (hid_t)r->DataSet );
+            H5Sselect_hyperslab( DataSpace, H5S_SELECT_SET, Start, NULL, Count, NULL );
+            MemSpace  = H5Screate_simple( 3, Count, NULL );
+            if ( H5Dread( (hid_t)r->DataSet, H5T_NATIVE_DOUBLE, MemSpace, DataSpace, H5P_DEFAULT, r->Buf ) < 0 ) {
+                printf("Could not read coefficient set %d for object %d\n", Index, objName);
+                exit(-1);
+                }
+            H5Sclose( MemSpace );
+            H5Sclose( DataSpace );
+            r->Coeffs = r->Buf;
+        }
+        r->Index = Index;
+        r->v0    = Index*days_per_set;
+
+    }
+
+    *Offset     = v - r->v0;
+    *DaysPerSet = days_per_set;
+    *nAxes      = r->nAxes;
+    *nCoeffs    = r->nCoeffs;
+
+    return( r->Coeffs );
+
+}
+
+
+/*
+ *  Chebyshev polynomials T[0..n-1] at offset days into a set.
+ */
+static double Lgm_JPL_ChebyT( double offset, double days_per_set, int n, double *T ) {
+    int     ii;
+    double  t1, twot1;
     T[0] = 1.0;
     t1 = 2.0 * offset / days_per_set - 1.0;
     twot1 = t1 + t1;
     T[1] = t1;
-    for (ii=2; ii<coefficient_count; ii++) {
+    for (ii=2; ii<n; ii++) {
         T[ii] = twot1 * T[ii-1] - T[ii-2];
         }
+    return( twot1 );
+    }
+
+
+void Lgm_JPLephem_setup_object( int objName, Lgm_JPLephemInfo *jpl, Lgm_JPLephemBundle *bundle ) {
+    
+    double days_per_set, offset, twot1;
+    int    number_of_axes, coefficient_count;
+    const double *rec;
+    double *T, **coefficients;
+
+    /* extract right set of Chebyshev coefficients */
+    rec = Lgm_JPL_Record( objName, bundle->tdb, jpl, &offset, &days_per_set, &number_of_axes, &coefficient_count );
+    LGM_ARRAY_2D( coefficients, number_of_axes, coefficient_count, double );
+    memcpy( &coefficients[0][0], rec, number_of_axes*coefficient_count*sizeof(double) );
+    
+    /* Chebyshev recurrence */
+    LGM_ARRAY_1D( T, coefficient_count, double );
+    twot1 = Lgm_JPL_ChebyT( offset, days_per_set, coefficient_count, T );
 
     /* Stuff into a small struct */
     bundle->coeffs = coefficients;
@@ -300,9 +575,9 @@ void Lgm_FreeJPLephemBundle( Lgm_JPLephemBundle *bundle ) {
 
 
 void Lgm_JPLephem_position( double tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_Vector *position) {
-    int i, j;
-    double dum;
-    Lgm_JPLephemBundle *bundle = Lgm_InitJPLephemBundle( tdb );
+    int i, naxes, ncoeffs;
+    double dum, offset, days_per_set, T[LGM_DE_MAX_COEFFS];
+    const double *a;
 
     //if Earth (recursive)
     if (objName==LGM_DE_EARTH) {
@@ -328,32 +603,51 @@ void Lgm_JPLephem_position( double tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_
         position->z = EMbary.z + MoonGCRF.z * moon_fac;
         }
     else {
-        //precalculate
-        Lgm_JPLephem_setup_object( objName, jpl, bundle );
+        //precalculate (uses the coefficients in place, no copies)
+        a = Lgm_JPL_Record( objName, tdb, jpl, &offset, &days_per_set, &naxes, &ncoeffs );
+        Lgm_JPL_ChebyT( offset, days_per_set, ncoeffs, T );
 
         //calculate positions
         dum = 0;
-        for (i=0; i<bundle->coefficient_count; i++) {
-            dum += bundle->T[i] * bundle->coeffs[0][i];
+        for (i=0; i<ncoeffs; i++) {
+            dum += T[i] * a[i];
             }
         position->x = dum;
 
         dum = 0;
-        for (i=0; i<bundle->coefficient_count; i++) {
-            dum += bundle->T[i] * bundle->coeffs[1][i];
+        for (i=0; i<ncoeffs; i++) {
+            dum += T[i] * a[ncoeffs+i];
             }
         position->y = dum;
 
         dum = 0;
-        for (i=0; i<bundle->coefficient_count; i++) {
-            dum += bundle->T[i] * bundle->coeffs[2][i];
+        if ( naxes > 2 ) {
+            for (i=0; i<ncoeffs; i++) {
+                dum += T[i] * a[2*ncoeffs+i];
+                }
             }
         position->z = dum;
 
         }
-    Lgm_FreeJPLephemBundle( bundle );
     }
 
+/**
+ *  \brief
+ *      Lgm_JPLephem_position() for an array of times.
+ *
+ *  \details
+ *      position[i] is the position of objName at tdb[i]. Times that fall in
+ *      the same coefficient set reuse it, so this is cheapest when the times
+ *      are sorted.
+ */
+void Lgm_JPLephem_position_array( long int n, double *tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_Vector *position) {
+    long int i;
+    for (i=0; i<n; i++) {
+        Lgm_JPLephem_position( tdb[i], objName, jpl, &position[i] );
+        }
+    }
+
+
 void Lgm_JPL_getSunVector ( double tdb, Lgm_JPLephemInfo *jpl, Lgm_Vector *position ) {
     Lgm_Vector EarthICRF, SunICRF;
     // get positions of Sun & Earth
@@ -426,10 +720,13 @@ void Lgm_JPLephem_velocity( double tdb, int objName, Lgm_JPLephemInfo *jpl, Lgm_
         velocity->y = dum;
 
         dum = 0;
-        for (i=0; i<bundle->coefficient_count; i++) {
-            dum += dT[i] * bundle->coeffs[2][i];
+        if ( Lgm_JPL_getNAxes( objName, jpl ) > 2 ) {
+            for (i=0; i<bundle->coefficient_count; i++) {
+                dum += dT[i] * bundle->coeffs[2][i];
+                }
             }
         velocity->z = dum;
+        LGM_ARRAY_1D_FREE( dT );
 
         }
     Lgm_FreeJPLephemBundle( bundle );
@@ -477,6 +774,9 @@ int Lgm_JPL_getNSets( int objName, Lgm_JPLephemInfo *jpl) {
         case LGM_DE_NUTATION:
             nvals = (jpl->getLibrationNutation) ? jpl->nutation_nvals: -1;
             break;
+        default:
+            nvals = -1 ;
+            break;
         }
     return nvals;
     }
@@ -7,18 +7,160 @@
 #pragma GCC push_options
 #pragma GCC optimize ("O3")
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include "Lgm/Lgm_KdTree.h"
 #include "Lgm/quicksort.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <unistd.h>
 #include <sys/timeb.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
 
 
 
+#define KDTREE_PARALLEL_MIN     32768   // Subtrees smaller than this are built on the current thread
+
+
+/*
+ * Number of nodes in a (sub)tree of n points whose root is at Level. This
+ * only depends on n, since every split puts n - n/2 points on the left and
+ * n/2 on the right.
+ */
+static unsigned long int KdTree_nNodes( unsigned long int n, int Level ) {
+    if ( ( Level >= KDTREE_MAX_LEVEL ) || ( n <= KDTREE_MAX_DATA_PER_NODE ) ) return( 1 );
+    return( 1 + KdTree_nNodes( n - n/2, Level+1 ) + KdTree_nNodes( n/2, Level+1 ) );
+}
+
+/*
+ * Partially sorts Perm[lo..hi] (inclusive) by x[Perm[]] so that Perm[k] is
+ * where it would be if fully sorted, with nothing larger before it and
+ * nothing smaller after it (Hoare partitioning around a median of three).
+ */
+static void KdTree_Select( unsigned long int *Perm, const double *x, long int lo, long int hi, long int k ) {
+
+    long int            i, j;
+    unsigned long int   t;
+    double              a, b, c, v;
+
+    while ( hi > lo ) {
+        a = x[ Perm[lo] ]; b = x[ Perm[lo + (hi-lo)/2] ]; c = x[ Perm[hi] ];
+        v = ( a < b ) ? ( ( b < c ) ? b : ( ( a < c ) ? c : a ) ) : ( ( a < c ) ? a : ( ( b < c ) ? c : b ) );
+        i = lo; j = hi;
+        while ( i <= j ) {
+            while ( x[ Perm[i] ] < v ) ++i;
+            while ( x[ Perm[j] ] > v ) --j;
+            if ( i <= j ) {
+                t = Perm[i]; Perm[i] = Perm[j]; Perm[j] = t;
+                ++i; --j;
+            }
+        }
+        if      ( k <= j ) hi = j;
+        else if ( k >= i ) lo = i;
+        else break;
+    }
+
+}
+
+/*
+ * Builds the subtree of the points Perm[lo..lo+n) into NodePool[iNode...]
+ * (depth first, so the left child is at iNode+1 and the right one follows
+ * the whole left subtree). A leaf's data items are DataPool[lo..lo+n) and
+ * their positions are copied out of the (structure of arrays) Positions.
+ * Splits are the same as Lgm_KdTree_SubDivideVolume() makes, but the median
+ * is found by selection on the one permutation array rather than by sorting
+ * copies of each node's data.
+ */
+static void KdTree_Build( Lgm_KdTree *kt, unsigned long int iNode, Lgm_KdTreeNode *Parent, int Level, unsigned long int lo, unsigned long int n,
+                          unsigned long int *Perm, double **Positions, void **Objects ) {
+
+    int                 D, d, q;
+    unsigned long int   j, k, nLeft, nRight, iRight;
+    double              c, MaxDiff, *Bounds;
+    Lgm_KdTreeNode      *t = &kt->NodePool[iNode];
+    Lgm_KdTreeData      *Data;
+
+    D = kt->Root->D;
+    Bounds = kt->Pool + iNode*3*D;
+    t->Level      = Level;
+    t->D          = D;
+    t->d          = ( Parent == NULL ) ? -1 : 0;
+    t->Parent     = Parent;
+    t->Min        = Bounds;
+    t->Max        = Bounds + D;
+    t->Diff       = Bounds + 2*D;
+    t->nDataBelow = n;
+
+    for ( d=0; d<D; d++ ) {
+        t->Min[d] =  9e99;
+        t->Max[d] = -9e99;
+        for ( j=lo; j<lo+n; j++ ) {
+            c = Positions[d][ Perm[j] ];
+            if ( c < t->Min[d] ) t->Min[d] = c;
+            if ( c > t->Max[d] ) t->Max[d] = c;
+        }
+        t->Diff[d] = t->Max[d] - t->Min[d];
+    }
+
+    if ( ( Level >= KDTREE_MAX_LEVEL ) || ( n <= KDTREE_MAX_DATA_PER_NODE ) ) {
+        t->nData = n;
+        t->Data  = Data = &kt->DataPool[lo];
+        for ( j=0; j<n; j++ ) {
+            k = Perm[lo+j];
+            Data[j].Id       = k;
+            Data[j].D        = D;
+            Data[j].Position = kt->Pool + kt->nNodes*3*D + (lo+j)*D;
+            for ( d=0; d<D; d++ ) Data[j].Position[d] = Positions[d][k];
+            Data[j].Object   = Objects[k];
+        }
+        return;
+    }
+
+    if ( kt->SplitStrategy == LGM_KDTREE_SPLIT_SEQUENTIAL ) {
+        q = Level%D;
+    } else if ( kt->SplitStrategy == LGM_KDTREE_SPLIT_RANDOM ) {
+        q = (int)( rand()/(double)RAND_MAX*D );
+    } else {
+        MaxDiff = -1.0; q = 0;
+        for ( d=0; d<D; d++ ) {
+            if ( t->Diff[d] > MaxDiff ) { MaxDiff = t->Diff[d]; q = d; }
+        }
+    }
+
+    nRight = n/2;
+    nLeft  = n - nRight;
+    KdTree_Select( Perm, Positions[q], (long int)lo, (long int)(lo+n-1), (long int)(lo+nLeft) );
+    t->d      = q;
+    t->CutVal = Positions[q][ Perm[lo+nLeft] ];
+    t->nData  = 0;
+
+    iRight   = iNode + 1 + KdTree_nNodes( nLeft, Level+1 );
+    t->Left  = &kt->NodePool[iNode+1];
+    t->Right = &kt->NodePool[iRight];
+
+#if USE_OPENMP
+    #pragma omp task if( nLeft >= KDTREE_PARALLEL_MIN )
+#endif
+    KdTree_Build( kt, iNode+1, t, Level+1, lo, nLeft, Perm, Positions, Objects );
+    KdTree_Build( kt, iRight,  t, Level+1, lo+nLeft, nRight, Perm, Positions, Objects );
+#if USE_OPENMP
+    #pragma omp taskwait
+#endif
+
+}
+
+
 /** 
  *   \brief
  *      Store given N-dimensional data into a D-dimensional KD-tree data structure.
@@ -27,6 +169,13 @@
  *      Given arrays of positions and data, this routine recursively partitions
  *      the data into a kdtree data structure. 
  *
+ *      Each node is split at the median of the points in it (along the
+ *      dimension with the largest range), found by selection on a single
+ *      permutation array. Left and right subtrees of large nodes are built
+ *      as separate OpenMP tasks. The number of nodes is known up front, so
+ *      the nodes, leaf data items, and node bounds and leaf positions are
+ *      each allocated as one block.
+ *
  *   \param[in]      Points      An array of position vectors in D-dimensional space. ObjectPoints[d][n] is the dth component of the nth point.
  *
  *   \param[in]      Objects     An array of objects in D-dimensional space. Objects[n] is the nth pointer to an object.
@@ -46,53 +195,32 @@
  */
 Lgm_KdTree *Lgm_KdTree_Init( double **Positions, void **Objects, unsigned long int N, int D ) {
 
-
-    int                 d;
-    unsigned long int   j;
-    Lgm_KdTreeNode      *t;
+    unsigned long int   j, *Perm;
     Lgm_KdTree          *kt;
 
-    /*
-     * Initially dump all of the data into a single node.
-     */
-    t = Lgm_CreateKdTreeRoot( D );
-
-    t->nData      = N;
-    t->nDataBelow = t->nData;
-    t->Data       = (Lgm_KdTreeData *) calloc( t->nData, sizeof( Lgm_KdTreeData ) );
-
-
-    /*
-     *  Loop over number of data points. Also keep track of ranges in each dimension.
-     */
-    for (j=0; j<t->nData; j++){
-
-        t->Data[j].Position = (double *) calloc( D, sizeof(double) );
-
-        t->Data[j].Id = j;
-        for (d=0; d<D; d++) {
-            if (Positions[d][j] < t->Min[d] ) t->Min[d] = Positions[d][j];
-            if (Positions[d][j] > t->Max[d] ) t->Max[d] = Positions[d][j];
-            t->Data[j].Position[d] = Positions[d][j];
-        }
-        t->Data[j].Object = Objects[j];
-        //double *bbb;
-        //bbb = (double *)Objects[j];
-        //printf("bbb = %g %g %g\n", bbb[0], bbb[1], bbb[2]);
-
-    }
-    for (d=0; d<D; d++) t->Diff[d] = t->Max[d] - t->Min[d];
+    kt = (Lgm_KdTree *) calloc( 1, sizeof( Lgm_KdTree) );
 
+    kt->n             = N;
+    kt->kNN_Lookups   = 0;
+    kt->SplitStrategy = LGM_KDTREE_SPLIT_MAXRANGE;
 
+    kt->nNodes   = KdTree_nNodes( N, KDTREE_ROOT_LEVEL );
+    kt->NodePool = (Lgm_KdTreeNode *) calloc( kt->nNodes, sizeof( Lgm_KdTreeNode ) );
+    kt->DataPool = (Lgm_KdTreeData *) calloc( N + 1, sizeof( Lgm_KdTreeData ) );
+    kt->Pool     = (double *) malloc( ( kt->nNodes*3 + N )*D*sizeof( double ) + 1 );
+    kt->Root     = &kt->NodePool[0];
+    kt->Root->D  = D;
 
+    Perm = (unsigned long int *) malloc( ( N + 1 )*sizeof( unsigned long int ) );
+    for ( j=0; j<N; j++ ) Perm[j] = j;
 
-    kt = (Lgm_KdTree *) calloc( 1, sizeof( Lgm_KdTree) );
+#if USE_OPENMP
+    #pragma omp parallel if( N >= KDTREE_PARALLEL_MIN )
+    #pragma omp single
+#endif
+    KdTree_Build( kt, 0, NULL, KDTREE_ROOT_LEVEL, 0, N, Perm, Positions, Objects );
 
-    kt->kNN_Lookups   = 0;
-    kt->SplitStrategy = LGM_KDTREE_SPLIT_MAXRANGE;
-    
-    Lgm_KdTree_SubDivideVolume( t, kt );
-    kt->Root = t;
+    free( Perm );
 
     kt->PQN = Lgm_pQueue_Create( 5000 );
     kt->PQP = Lgm_pQueue_Create( 5000 );
@@ -419,7 +547,7 @@ int Lgm_KdTree_kNN( double *q, int D, Lgm_KdTree *KdTree, int K, int *Kgot, doub
 
     // reset priority queue heap for points
     PQP = KdTree->PQP;
-    PQP->HeapSize = 0;
+    Lgm_pQueue_Reset( PQP );
 
     Root = KdTree->Root;
     *Kgot = 0;
@@ -868,11 +996,11 @@ int Lgm_KdTree_kNN2( double *q_in, int D, Lgm_KdTree *KdTree, int K, int *Kgot,
 
     // reset priority queue heap for nodes
     PQN = KdTree->PQN;
-    PQN->HeapSize = 0;
+    Lgm_pQueue_Reset( PQN );
 
     // reset priority queue heap for points
     PQP = KdTree->PQP;
-    PQP->HeapSize = 0;
+    Lgm_pQueue_Reset( PQP );
 
 
 
@@ -984,4 +1112,564 @@ int Lgm_KdTree_kNN2( double *q_in, int D, Lgm_KdTree *KdTree, int K, int *Kgot,
         }
 
 }
+/**
+ *  \brief
+ *      Create a context for doing kNN queries on a KdTree.
+ *
+ *  \details
+ *      Lgm_KdTree_kNN() and Lgm_KdTree_kNN2() use priority queues that live
+ *      in the Lgm_KdTree, so only one thread at a time can use a tree with
+ *      them. Lgm_KdTree_kNN_Query() keeps its queue and scratch space in an
+ *      Lgm_KdTreeQuery instead, and leaves the tree untouched. Make one of
+ *      these per thread, e.g.;
+ *
+ *          \code
+ *          #pragma omp parallel private(Q)
+ *          {
+ *              Q = Lgm_KdTree_CreateQuery( KdTree, K );
+ *              #pragma omp for
+ *              for ( i=0; i<n; i++ ) Lgm_KdTree_kNN_Query( q[i], KdTree, K, &Kgot[i], MaxDist2, &kNN[i*K], Q );
+ *              Lgm_KdTree_FreeQuery( Q );
+ *          }
+ *          \endcode
+ *
+ *   \param[in]      KdTree     The tree the context will be used with.
+ *   \param[in]      K          The largest number of neighbors that will be asked for.
+ *
+ *   \returns        A query context. Free with Lgm_KdTree_FreeQuery().
+ *
+ */
+Lgm_KdTreeQuery *Lgm_KdTree_CreateQuery( Lgm_KdTree *KdTree, int K ) {
+
+    Lgm_KdTreeQuery *Q;
+
+    if ( K < 1 ) K = 1;
+    Q = (Lgm_KdTreeQuery *) calloc( 1, sizeof( Lgm_KdTreeQuery ) );
+    Q->K = K;
+    Q->D = KdTree->Root->D;
+
+    /*
+     * The point heap never holds more than K entries, so it is never grown.
+     */
+    Lgm_pQueue_Reserve( K, &Q->PQP );
+    Q->q              = (double *) calloc( Q->D, sizeof( double ) );
+
+    return( Q );
+
+}
+
+/**
+ *  \brief
+ *      Free a context made by Lgm_KdTree_CreateQuery().
+ */
+void Lgm_KdTree_FreeQuery( Lgm_KdTreeQuery *Q ) {
+    if ( Q == NULL ) return;
+    free( Q->PQP.HeapArray );
+    free( Q->q );
+    free( Q );
+}
+
+/**
+ *  \brief
+ *      Finds the k Nearest Neighbors (kNN) of a query point, using a query context.
+ *
+ *  \details
+ *      The same depth-first search as Lgm_KdTree_kNN(), but the search state
+ *      is in Q, so the tree is only read (and no memory is allocated). Unlike
+ *      Lgm_KdTree_kNN(), the neighbors come back closest first.
+ *
+ *    \param[in]     q          Query position (D-dimensional).
+ *    \param[in]     KdTree     The KdTree.
+ *    \param[in]     K          Number of NNs to find (no more than Q->K).
+ *    \param[out]    Kgot       Number of NNs (within MaxDist2) that we actually found.
+ *    \param[in]     MaxDist2   Threshold distance^2 beyond which we give up on finding NNs.
+ *    \param[out]    kNN        List of kNN Data items. Sorted (closest first).
+ *    \param[in,out] Q          A query context from Lgm_KdTree_CreateQuery().
+ *
+ *    \returns       KDTREE_KNN_SUCCESS         Search succeeded.
+ *                   KDTREE_KNN_TOO_FEW_NNS     Search terminated because we couldnt find K NNs that were close enough.
+ *                   KDTREE_KNN_NOT_ENOUGH_DATA KdTree doesnt contain enough data points (or K > Q->K).
+ *
+ */
+int Lgm_KdTree_kNN_Query( double *q, Lgm_KdTree *KdTree, int K, int *Kgot, double MaxDist2, Lgm_KdTreeData *kNN, Lgm_KdTreeQuery *Q ) {
+
+    int                 k, n;
+    double              dist, maxd2;
+    Lgm_KdTreeNode      *p;
+    Lgm_pQueue_Node     FarthestPoint;
+
+    *Kgot = 0;
+    if ( ( KdTree->Root->nDataBelow < K ) || ( K > Q->K ) ) return( KDTREE_KNN_NOT_ENOUGH_DATA );
+
+    maxd2 = MaxDist2;
+    Lgm_pQueue_Reset( &Q->PQP );
+    Lgm_KdTree_DepthFirstSearch( KdTree->Root, &Q->PQP, K, q, &maxd2 );
+
+    /*
+     * The heap pops farthest first. Drop any beyond MaxDist2 (the first K
+     * points found go in regardless) and fill kNN in from the back.
+     */
+    while ( ( Q->PQP.HeapSize > 0 ) && ( -Q->PQP.HeapArray[1].key > MaxDist2 ) ) Lgm_pQueue_Pop( &FarthestPoint, &Q->PQP );
+    n = Q->PQP.HeapSize;
+    for ( k=n-1; k>=0; k-- ) {
+        Lgm_pQueue_Pop( &FarthestPoint, &Q->PQP );
+        dist   = -FarthestPoint.key;
+        p      = (Lgm_KdTreeNode *)FarthestPoint.Data;
+        kNN[k] = p->Data[ FarthestPoint.index ];
+        kNN[k].Dist2 = dist;
+    }
+    *Kgot = n;
+    ++(Q->kNN_Lookups);
+
+    return( ( n == K ) ? KDTREE_KNN_SUCCESS : KDTREE_KNN_TOO_FEW_NNS );
+
+}
+
+/*
+ * Sort key of a query point: the left(0)/right(1) path taken down the tree
+ * to the leaf the point falls in, left justified in 64 bits. Points with
+ * nearby keys fall in nearby leaves, so queries done in key order reuse
+ * the same parts of the tree.
+ */
+typedef struct _KdTree_QueryKey {
+    unsigned long long  Key;
+    long int            i;
+} KdTree_QueryKey;
+
+static unsigned long long KdTree_PathKey( Lgm_KdTreeNode *Node, double *q ) {
+
+    unsigned long long  Key = 0;
+    int                 nBits = 0, Bit;
+
+    while ( ( Node->Left || Node->Right ) && ( nBits < 64 ) ) {
+        if ( Node->Left && Node->Right ) Bit = ( q[ Node->d ] < Node->CutVal ) ? 0 : 1;
+        else                             Bit = ( Node->Left ) ? 0 : 1;
+        Key = (Key << 1) | Bit;
+        Node = ( Bit ) ? Node->Right : Node->Left;
+        ++nBits;
+    }
+
+    return( ( nBits < 64 ) ? Key << (64-nBits) : Key );
+
+}
+
+static int KdTree_CompareKeys( const void *a, const void *b ) {
+    const KdTree_QueryKey *x = (const KdTree_QueryKey *)a, *y = (const KdTree_QueryKey *)b;
+    if ( x->Key < y->Key ) return( -1 );
+    if ( x->Key > y->Key ) return(  1 );
+    return( ( x->i < y->i ) ? -1 : ( x->i > y->i ) );
+}
+
+/**
+ *  \brief
+ *      Finds the k Nearest Neighbors of many query points.
+ *
+ *  \details
+ *      The queries are done in the order of the leaves they fall in (rather
+ *      than the order given), which keeps the parts of the tree being
+ *      searched in cache, and, with OpenMP, are spread over threads (each
+ *      with its own Lgm_KdTreeQuery). The results are stored in the order
+ *      the queries were given.
+ *
+ *    \param[in]     KdTree     The KdTree.
+ *    \param[in]     nq         Number of query points.
+ *    \param[in]     Queries    The query points, in the same layout as Lgm_KdTree_Init() takes (Queries[d][i] is the dth component of the ith point).
+ *    \param[in]     K          Number of NNs to find for each query.
+ *    \param[in]     MaxDist2   Threshold distance^2 beyond which we give up on finding NNs.
+ *    \param[out]    Kgot       Kgot[i] is the number of NNs found for query i.
+ *    \param[out]    kNN        kNN[i*K], ..., kNN[i*K+Kgot[i]-1] are the NNs of query i, closest first (room for nq*K).
+ *
+ *    \returns       The number of queries for which K NNs were found (or -1 if the tree has fewer than K points).
+ *
+ */
+long int Lgm_KdTree_kNN_Batch( Lgm_KdTree *KdTree, long int nq, double **Queries, int K, double MaxDist2, int *Kgot, Lgm_KdTreeData *kNN ) {
+
+    long int            i, nGood = 0, nLookups = 0;
+    int                 d, D;
+    KdTree_QueryKey     *Order;
+
+    if ( KdTree->Root->nDataBelow < K ) {
+        for ( i=0; i<nq; i++ ) Kgot[i] = 0;
+        return( -1 );
+    }
+    if ( nq < 1 ) return( 0 );
+    D = KdTree->Root->D;
+
+    /*
+     * Put the queries in tree order.
+     */
+    Order = (KdTree_QueryKey *) calloc( nq, sizeof( KdTree_QueryKey ) );
+#if USE_OPENMP
+    #pragma omp parallel private(d)
+#endif
+    {
+        double  *q = (double *) calloc( D, sizeof( double ) );
+        long int j;
+#if USE_OPENMP
+        #pragma omp for
+#endif
+        for ( j=0; j<nq; j++ ) {
+            for ( d=0; d<D; d++ ) q[d] = Queries[d][j];
+            Order[j].Key = KdTree_PathKey( KdTree->Root, q );
+            Order[j].i   = j;
+        }
+        free( q );
+    }
+    qsort( Order, nq, sizeof( KdTree_QueryKey ), KdTree_CompareKeys );
+
+    /*
+     * Do them. Contiguous runs of the sorted queries go to each thread.
+     */
+#if USE_OPENMP
+    #pragma omp parallel private(d) reduction(+:nGood,nLookups)
+#endif
+    {
+        Lgm_KdTreeQuery *Q = Lgm_KdTree_CreateQuery( KdTree, K );
+        long int        j, ii;
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic,64)
+#endif
+        for ( j=0; j<nq; j++ ) {
+            ii = Order[j].i;
+            for ( d=0; d<D; d++ ) Q->q[d] = Queries[d][ii];
+            if ( Lgm_KdTree_kNN_Query( Q->q, KdTree, K, &Kgot[ii], MaxDist2, &kNN[ii*K], Q ) == KDTREE_KNN_SUCCESS ) ++nGood;
+        }
+        nLookups += Q->kNN_Lookups;
+        Lgm_KdTree_FreeQuery( Q );
+    }
+
+    KdTree->kNN_Lookups += nLookups;
+    free( Order );
+
+    return( nGood );
+
+}
+
+
+/*
+ *  Helpers for Lgm_KdTree_Save()
+ */
+static uint64_t KdTree_Align( uint64_t n ) {
+    return( ( n + LGM_KDTREE_FILE_ALIGN - 1 )/LGM_KDTREE_FILE_ALIGN*LGM_KDTREE_FILE_ALIGN );
+}
+
+static int KdTree_PWrite( int fd, const void *buf, size_t n, uint64_t Offset ) {
+    const char  *p = (const char *)buf;
+    ssize_t     k;
+    while ( n > 0 ) {
+        if ( (k = pwrite( fd, p, n, (off_t)Offset )) <= 0 ) return( FALSE );
+        p += k; n -= (size_t)k; Offset += (uint64_t)k;
+    }
+    return( TRUE );
+}
+
+static void KdTree_CountNodes( Lgm_KdTreeNode *Node, uint64_t *nNodes ) {
+    ++(*nNodes);
+    if ( Node->Left )  KdTree_CountNodes( Node->Left, nNodes );
+    if ( Node->Right ) KdTree_CountNodes( Node->Right, nNodes );
+}
+
+/*
+ *  Flatten the tree depth first. Returns the index given to Node.
+ */
+static int64_t KdTree_Flatten( Lgm_KdTreeNode *Node, Lgm_KdTreeFileNode *Nodes, double *Bounds, double *Pos, uint64_t *Ids,
+                               unsigned char *Obj, size_t ObjectSize, uint64_t *iNode, uint64_t *iData ) {
+
+    int64_t             i = (int64_t)(*iNode)++;
+    unsigned long int   j;
+    int                 d, D = Node->D;
+    Lgm_KdTreeFileNode  *f = &Nodes[i];
+
+    f->Level      = Node->Level;
+    f->d          = Node->d;
+    f->CutVal     = Node->CutVal;
+    f->nDataBelow = Node->nDataBelow;
+    f->nData      = Node->nData;
+    f->iData      = *iData;
+    for ( d=0; d<D; d++ ) {
+        Bounds[ (i*3    )*D + d ] = Node->Min[d];
+        Bounds[ (i*3 + 1)*D + d ] = Node->Max[d];
+        Bounds[ (i*3 + 2)*D + d ] = Node->Diff[d];
+    }
+
+    for ( j=0; j<Node->nData; j++, (*iData)++ ) {
+        for ( d=0; d<D; d++ ) Pos[ (*iData)*D + d ] = Node->Data[j].Position[d];
+        Ids[ *iData ] = Node->Data[j].Id;
+        if ( ObjectSize > 0 ) {
+            if ( Node->Data[j].Object ) memcpy( Obj + (*iData)*ObjectSize, Node->Data[j].Object, ObjectSize );
+            else                        memset( Obj + (*iData)*ObjectSize, 0, ObjectSize );
+        }
+    }
+
+    f->Left  = ( Node->Left )  ? KdTree_Flatten( Node->Left,  Nodes, Bounds, Pos, Ids, Obj, ObjectSize, iNode, iData ) : -1;
+    f->Right = ( Node->Right ) ? KdTree_Flatten( Node->Right, Nodes, Bounds, Pos, Ids, Obj, ObjectSize, iNode, iData ) : -1;
+
+    return( i );
+
+}
+
+/**
+ *  \brief
+ *      Save a KdTree to a file that Lgm_KdTree_Load() can map straight back in.
+ *
+ *  \details
+ *      Building a big tree (e.g. from an MHD mesh) takes a while; loading a
+ *      saved one takes about as long as it takes to touch the pages. The
+ *      layout is described in Lgm_KdTree.h.
+ *
+ *      Objects are pointers, so they cant be saved as they are. If
+ *      ObjectSize > 0, ObjectSize bytes are copied from each Object into the
+ *      file, and the Objects of the loaded tree point at these copies (the
+ *      right thing when each Object is, say, an array of doubles, as for
+ *      Lgm_B_FromScatteredData5()). Otherwise only the Ids are saved, and
+ *      the Objects can be supplied again when the tree is loaded.
+ *
+ *   \param[in]      KdTree      The tree.
+ *   \param[in]      Filename    File to write (overwritten if it exists).
+ *   \param[in]      ObjectSize  Bytes to save per Object (0 for none).
+ *
+ *   \returns        TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_KdTree_Save( Lgm_KdTree *KdTree, char *Filename, size_t ObjectSize ) {
+
+    int                     fd, Status, D;
+    uint64_t                nNodes = 0, iNode = 0, iData = 0, n;
+    Lgm_KdTreeFileHeader    h;
+    Lgm_KdTreeFileNode      *Nodes;
+    double                  *Bounds, *Pos;
+    uint64_t                *Ids;
+    unsigned char           *Obj = NULL;
+
+    if ( (KdTree == NULL) || (KdTree->Root == NULL) ) return( FALSE );
+    D = KdTree->Root->D;
+    n = KdTree->Root->nDataBelow;
+    KdTree_CountNodes( KdTree->Root, &nNodes );
+
+    Nodes  = (Lgm_KdTreeFileNode *) calloc( nNodes, sizeof( Lgm_KdTreeFileNode ) );
+    Bounds = (double *) calloc( nNodes*3*D, sizeof( double ) );
+    Pos    = (double *) calloc( n*D + 1, sizeof( double ) );
+    Ids    = (uint64_t *) calloc( n + 1, sizeof( uint64_t ) );
+    if ( ObjectSize > 0 ) Obj = (unsigned char *) calloc( n + 1, ObjectSize );
+    KdTree_Flatten( KdTree->Root, Nodes, Bounds, Pos, Ids, Obj, ObjectSize, &iNode, &iData );
+
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.Magic, LGM_KDTREE_FILE_MAGIC, 8 );
+    h.Version       = LGM_KDTREE_FILE_VERSION;
+    h.D             = D;
+    h.n             = n;
+    h.nNodes        = nNodes;
+    h.ObjectSize    = ObjectSize;
+    h.SplitStrategy = KdTree->SplitStrategy;
+    h.Min = KdTree->Min; h.Max = KdTree->Max; h.Diff = KdTree->Diff;
+    h.NodeOffset    = KdTree_Align( sizeof(h) );
+    h.BoundsOffset  = KdTree_Align( h.NodeOffset   + nNodes*sizeof(Lgm_KdTreeFileNode) );
+    h.PosOffset     = KdTree_Align( h.BoundsOffset + nNodes*3*D*sizeof(double) );
+    h.IdOffset      = KdTree_Align( h.PosOffset    + n*D*sizeof(double) );
+    h.ObjOffset     = KdTree_Align( h.IdOffset     + n*sizeof(uint64_t) );
+
+    Status = FALSE;
+    if ( (iData == n) && ((fd = open( Filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) >= 0) ) {
+        Status = KdTree_PWrite( fd, &h, sizeof(h), 0 )
+                    && KdTree_PWrite( fd, Nodes,  nNodes*sizeof(Lgm_KdTreeFileNode), h.NodeOffset )
+                    && KdTree_PWrite( fd, Bounds, nNodes*3*D*sizeof(double), h.BoundsOffset )
+                    && KdTree_PWrite( fd, Pos,    n*D*sizeof(double), h.PosOffset )
+                    && KdTree_PWrite( fd, Ids,    n*sizeof(uint64_t), h.IdOffset )
+                    && ( (ObjectSize == 0) || KdTree_PWrite( fd, Obj, n*ObjectSize, h.ObjOffset ) );
+        Status = ( close( fd ) == 0 ) && Status;
+    }
+    if ( !Status ) fprintf( stderr, "Lgm_KdTree_Save(): Could not write %s\n", Filename );
+
+    free( Nodes ); free( Bounds ); free( Pos ); free( Ids ); free( Obj );
+
+    return( Status );
+
+}
+
+/**
+ *  \brief
+ *      Load a KdTree saved with Lgm_KdTree_Save().
+ *
+ *  \details
+ *      The file is memory mapped (read only) and used in place: the
+ *      positions and node bounds are not copied, and the nodes and data
+ *      items are set up in two arrays (rather than being allocated one by
+ *      one), so a tree loads in a small fraction of the time it takes to
+ *      build one. The tree can be used with all of the kNN routines. Dont
+ *      write into its nodes or data items.
+ *
+ *   \param[in]      Filename    File written by Lgm_KdTree_Save().
+ *   \param[in]      Objects     If the file has no Objects in it, and this is not NULL,
+ *                               the Object of the point with Id i is set to Objects[i]
+ *                               (i.e. pass the Objects given to Lgm_KdTree_Init()).
+ *
+ *   \returns        The tree (free with Lgm_FreeKdTree()), or NULL if the file
+ *                   could not be read or is not a valid KdTree file.
+ *
+ */
+Lgm_KdTree *Lgm_KdTree_Load( char *Filename, void **Objects ) {
+
+    int                     fd, Ok, D;
+    uint64_t                i, j, n, nNodes;
+    size_t                  Size;
+    struct stat             sb;
+    unsigned char           *Base;
+    Lgm_KdTreeFileHeader    *h;
+    Lgm_KdTreeFileNode      *f;
+    Lgm_KdTreeNode          *Node;
+    Lgm_KdTree              *kt;
+    double                  *Bounds, *Pos;
+    uint64_t                *Ids;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_KdTreeFileHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     * Validate the header and node table
+     */
+    h  = (Lgm_KdTreeFileHeader *)Base;
+    D  = (int)h->D; n = h->n; nNodes = h->nNodes;
+    Ok = (memcmp( h->Magic, LGM_KDTREE_FILE_MAGIC, 8 ) == 0) && (h->Version == LGM_KDTREE_FILE_VERSION) && (D > 0) && (nNodes > 0)
+            && (h->NodeOffset   + nNodes*sizeof(Lgm_KdTreeFileNode) <= Size)
+            && (h->BoundsOffset + nNodes*3*D*sizeof(double) <= Size)
+            && (h->PosOffset    + n*D*sizeof(double) <= Size)
+            && (h->IdOffset     + n*sizeof(uint64_t) <= Size)
+            && (h->ObjOffset    + n*h->ObjectSize <= Size)
+            && (h->BoundsOffset % 8 == 0) && (h->PosOffset % 8 == 0) && (h->IdOffset % 8 == 0);
+    f = (Lgm_KdTreeFileNode *)(Base + h->NodeOffset);
+    for ( i=0; Ok && (i<nNodes); i++ ) {
+        Ok = ( (f[i].Left  < 0) || ((uint64_t)f[i].Left  > i && (uint64_t)f[i].Left  < nNodes) )
+          && ( (f[i].Right < 0) || ((uint64_t)f[i].Right > i && (uint64_t)f[i].Right < nNodes) )
+          && ( f[i].iData <= n ) && ( f[i].nData <= n - f[i].iData );
+    }
+    if ( !Ok ) {
+        fprintf( stderr, "Lgm_KdTree_Load(): %s is not a valid KdTree file.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+    Bounds = (double *)(Base + h->BoundsOffset);
+    Pos    = (double *)(Base + h->PosOffset);
+    Ids    = (uint64_t *)(Base + h->IdOffset);
+
+
+    /*
+     * Set up the nodes and data items. Their arrays point into the mapping.
+     */
+    kt = (Lgm_KdTree *) calloc( 1, sizeof( Lgm_KdTree ) );
+    kt->n             = n;
+    kt->Min           = h->Min;
+    kt->Max           = h->Max;
+    kt->Diff          = h->Diff;
+    kt->SplitStrategy = h->SplitStrategy;
+    kt->Mapping       = Base;
+    kt->MappingSize   = Size;
+    kt->nNodes        = nNodes;
+    kt->NodePool      = (Lgm_KdTreeNode *) calloc( nNodes, sizeof( Lgm_KdTreeNode ) );
+    kt->DataPool      = (Lgm_KdTreeData *) calloc( n + 1, sizeof( Lgm_KdTreeData ) );
+
+    for ( j=0; j<n; j++ ) {
+        kt->DataPool[j].Id       = Ids[j];
+        kt->DataPool[j].D        = D;
+        kt->DataPool[j].Position = Pos + j*D;
+        if      ( h->ObjectSize > 0 )                     kt->DataPool[j].Object = (void *)(Base + h->ObjOffset + j*h->ObjectSize);
+        else if ( Objects != NULL )                       kt->DataPool[j].Object = Objects[ Ids[j] ];
+    }
+
+    for ( i=0; i<nNodes; i++ ) {
+        Node = &kt->NodePool[i];
+        Node->Level      = f[i].Level;
+        Node->D          = D;
+        Node->d          = f[i].d;
+        Node->CutVal     = f[i].CutVal;
+        Node->Min        = Bounds + (i*3    )*D;
+        Node->Max        = Bounds + (i*3 + 1)*D;
+        Node->Diff       = Bounds + (i*3 + 2)*D;
+        Node->nDataBelow = f[i].nDataBelow;
+        Node->nData      = f[i].nData;
+        Node->Data       = ( f[i].nData > 0 ) ? &kt->DataPool[ f[i].iData ] : NULL;
+        Node->Left       = ( f[i].Left  >= 0 ) ? &kt->NodePool[ f[i].Left ]  : NULL;
+        Node->Right      = ( f[i].Right >= 0 ) ? &kt->NodePool[ f[i].Right ] : NULL;
+        if ( Node->Left )  Node->Left->Parent  = Node;
+        if ( Node->Right ) Node->Right->Parent = Node;
+    }
+    kt->Root = &kt->NodePool[0];
+
+    kt->PQN = Lgm_pQueue_Create( 5000 );
+    kt->PQP = Lgm_pQueue_Create( 5000 );
+
+    return( kt );
+
+}
+
+static void KdTree_FreeNode( Lgm_KdTreeNode *Node ) {
+    unsigned long int   j;
+    if ( Node == NULL ) return;
+    KdTree_FreeNode( Node->Left );
+    KdTree_FreeNode( Node->Right );
+    if ( Node->Data ) {
+        for ( j=0; j<Node->nData; j++ ) free( Node->Data[j].Position );
+        free( Node->Data );
+    }
+    free( Node->Min ); free( Node->Max ); free( Node->Diff );
+    free( Node );
+}
+
+/**
+ *  \brief
+ *      Free a KdTree made by Lgm_KdTree_Init() or Lgm_KdTree_Load().
+ *
+ *  \details
+ *      The Objects given to Lgm_KdTree_Init() (or Lgm_KdTree_Load()) are
+ *      not freed.
+ */
+void Lgm_FreeKdTree( Lgm_KdTree *KdTree ) {
+
+    if ( KdTree == NULL ) return;
+
+    if ( KdTree->NodePool ) {
+        free( KdTree->NodePool );
+        free( KdTree->DataPool );
+        free( KdTree->Pool );
+        if ( KdTree->Mapping ) {
+#ifdef HAVE_SYS_MMAN_H
+            munmap( KdTree->Mapping, KdTree->MappingSize );
+#else
+            free( KdTree->Mapping );
+#endif
+        }
+    } else {
+        KdTree_FreeNode( KdTree->Root );
+    }
+    Lgm_pQueue_Destroy( KdTree->PQN );
+    Lgm_pQueue_Destroy( KdTree->PQP );
+    free( KdTree );
+
+}
+
+
 #pragma GCC pop_options
@@ -0,0 +1,370 @@
+/*! \file Lgm_LCDS_MultiK.c
+ *
+ *  \brief Find the last closed drift shell (LCDS) for several K values at once.
+ *
+ *  Lgm_LCDS() bisects in equatorial radius for one K at a time, and every
+ *  step traces the field line at the test radius, sets up Lgm_AlphaOfK() on
+ *  it and then runs Lstar(). When the LCDS is wanted for many K values (10-20
+ *  per epoch for boundary products), most of that is repeated. Only the
+ *  Lstar() call really depends on K.
+ *
+ *  Lgm_LCDS_MultiK() runs all of the bisections together, one round at a
+ *  time:
+ *
+ *      - The test radii of all the K values are collected, and each
+ *        distinct radius is traced (and set up for Lgm_AlphaOfK()) only
+ *        once, with the pitch angle of every K that wants it. At the start
+ *        all of the brackets are the same, so the first rounds cost one
+ *        trace each no matter how many K values there are.
+ *
+ *      - A radius whose field line is not closed is kept, and it narrows
+ *        the outer bracket of every K whose bracket contains it (an open
+ *        field line means an open drift shell for any K). No new
+ *        trace is needed for that.
+ *
+ *      - The traces of a round and then the Lstar() calls of a round are
+ *        each done in parallel (OpenMP builds), over radii and over K
+ *        values respectively.
+ *
+ *  The bisection points are at magnetic local time LT in the SM equatorial
+ *  plane, i.e. at SM longitude (LT-12)*15 degrees. To give the same answers
+ *  as Lgm_LCDS(), the two bracket end points are checked where Lgm_LCDS()
+ *  checks them, at SM longitude LT*15 degrees (MLT LT+12).
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+
+#define LGM_LCDS_TRACE_TOL      1e-7
+#define LGM_LCDS_MAXITER        20
+#define LGM_LCDS_SAME_R         1e-10   // test radii closer than this (Re) are the same one
+
+
+/*
+ *  Trace the field line through radius R at the given MLT and, if it is
+ *  closed, work out the equatorial pitch angle of each K[k] with Want[k]
+ *  set. Returns TRUE if the line is closed and could be set up for
+ *  Lgm_AlphaOfK(), FALSE otherwise.
+ */
+static int Lgm_LCDS_Probe( Lgm_DateTime *d, double R, double MLT, int nK, double *Kin, int *Want, double *Alpha, Lgm_Vector *Pmin, double *Bmin, Lgm_MagModelInfo *m ) {
+
+    int         k, Closed = FALSE;
+    double      Phi;
+    Lgm_Vector  u, u_sm, v1, v2, v3;
+
+    Phi = ( MLT - 12.0 )*15.0*RadPerDeg;
+    u_sm.x = R*cos( Phi ); u_sm.y = R*sin( Phi ); u_sm.z = 0.0;
+    Lgm_Convert_Coords( &u_sm, &u, SM_TO_GSM, m->c );
+
+    if ( Lgm_Trace( &u, &v1, &v2, &v3, 120.0, 0.01, LGM_LCDS_TRACE_TOL, m ) == LGM_CLOSED ) {
+        *Pmin = v3;
+        *Bmin = m->Bmin;
+        if ( Lgm_Setup_AlphaOfK( d, &v3, m ) > 0 ) {
+            for ( k=0; k<nK; k++ ) if ( Want[k] ) Alpha[k] = Lgm_AlphaOfK( Kin[k], m );
+            Lgm_TearDown_AlphaOfK( m );
+            Closed = TRUE;
+        }
+    }
+
+    return( Closed );
+
+}
+
+
+/*
+ *  Run Lstar() from Pmin for equatorial pitch angle Alpha. Returns TRUE if
+ *  the drift shell is defined (and sets LS and K), FALSE if it is not.
+ */
+static int Lgm_LCDS_ShellDefined( Lgm_Vector *Pmin, double Bmin, double Alpha, double *LS, double *K, Lgm_LstarInfo *l ) {
+
+    int     LS_Flag;
+    double  sa;
+
+    if ( ( Alpha <= 0.0 ) || ( Alpha > 90.0 ) ) return( FALSE );
+
+    sa = sin( Alpha*RadPerDeg );
+    l->PitchAngle = Alpha;
+    l->mInfo->Bm  = Bmin/( sa*sa );
+    LS_Flag = Lstar( Pmin, l );
+    if ( ( LS_Flag > 0 ) || ( l->LS != LGM_FILL_VALUE ) ) {
+        *LS = l->LS;
+        *K  = l->I[0]*sqrt( l->mInfo->Bm*1e-5 );
+        return( TRUE );
+    }
+
+    return( FALSE );
+
+}
+
+
+/*
+ *  Do the Lstar() calls for the K values with Want[k] set, in parallel.
+ *  iR[k] indexes the probe (radius) each K is being tested at.
+ */
+static void Lgm_LCDS_Shells( int nK, int *Want, int *iR, int *Closed, double *Alpha, Lgm_Vector *Pmin, double *Bmin, int *Defined, double *LS, double *K, Lgm_LstarInfo *l0, Lgm_LstarInfoPool *Pool ) {
+
+    int             k, tid;
+    Lgm_LstarInfo   *l;
+
+#if USE_OPENMP
+    #pragma omp parallel private(l,tid)
+    #pragma omp for schedule(dynamic, 1)
+#endif
+    for ( k=0; k<nK; k++ ) {
+        if ( !Want[k] ) continue;
+        Defined[k] = FALSE;
+        if ( !Closed[iR[k]] ) continue;
+#if USE_OPENMP
+        tid = omp_get_thread_num();
+#else
+        tid = 0;
+#endif
+        l = Lgm_LstarInfoPool_Get( tid, l0, Pool );
+        Defined[k] = Lgm_LCDS_ShellDefined( &Pmin[iR[k]], Bmin[iR[k]], Alpha[k], &LS[k], &K[k], l );
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Find the last closed drift shell for several K values at once.
+ *
+ *  \details
+ *      This does what Lgm_LCDS() does for each of the Kin[] values (a
+ *      bisection in equatorial radius between brac1 and brac2 at local time
+ *      LT until the bracket is narrower than tol), but shares the field
+ *      line traces and open/closed results between the K values and does
+ *      the work of each bisection round in parallel (see
+ *      Lgm_LCDS_MultiK.c).
+ *
+ *      The brackets are checked as in Lgm_LCDS(): the drift shell must be
+ *      defined at brac1 (Flag -8 otherwise), and if it is also defined at
+ *      brac2 the outer bracket is moved out to 1.7*brac2 (Flag -9 if it
+ *      is still defined there).
+ *
+ *      \param[in]      Date                Date (yyyymmdd).
+ *      \param[in]      UTC                 Universal time (hours).
+ *      \param[in]      brac1               Inner edge of the search bracket (Re).
+ *      \param[in]      brac2               Outer edge of the search bracket (Re).
+ *      \param[in]      nK                  Number of K values.
+ *      \param[in]      Kin                 K values (Re G^1/2).
+ *      \param[in]      LT                  Magnetic local time to search along (hours).
+ *      \param[in]      tol                 Bracket width (Re) to stop at.
+ *      \param[in]      Quality             Quality factor (0-8) for the L* calculations.
+ *      \param[in]      nFLsInDriftShell    Number of field lines per drift shell.
+ *      \param[out]     LCDS                L* of the last closed drift shell found for each K.
+ *      \param[out]     K                   K on that drift shell (from its I and Bm) for each K.
+ *      \param[out]     Flag                0 if the LCDS was found, -8 (bad inner bracket), -9 (bad outer bracket) or -2 (too many iterations).
+ *      \param[in,out]  LstarInfo           LstarInfo structure that sets the B-field model etc.
+ *
+ *      \return The number of K values for which the LCDS was found.
+ *
+ */
+int Lgm_LCDS_MultiK( long int Date, double UTC, double brac1, double brac2, int nK, double *Kin, double LT, double tol, int Quality, int nFLsInDriftShell, double *LCDS, double *K, int *Flag, Lgm_LstarInfo *LstarInfo ) {
+
+    return( Lgm_LCDS_MultiK_Radii( Date, UTC, brac1, brac2, nK, Kin, LT, tol, Quality, nFLsInDriftShell, LCDS, K, NULL, NULL, Flag, LstarInfo ) );
+
+}
+
+
+/**
+ *  \brief
+ *      Same as Lgm_LCDS_MultiK(), but also return where each LCDS was found.
+ *
+ *  \details
+ *      Rlcds[k] is the equatorial radius (signed like brac1 and brac2) of the
+ *      last closed drift shell found for Kin[k], and Bm[k] is the mirror
+ *      field on it. Rlcds is handy for bracketing the next time of a time
+ *      series tightly (see Tools/LastClosedDriftShell.c). Either can be NULL.
+ *
+ *      \param[out]     Bm                  Mirror field (nT) on the last closed drift shell for each K (or NULL).
+ *      \param[out]     Rlcds               Equatorial radius (Re) of the last closed drift shell for each K (or NULL).
+ *
+ *      The other arguments and the return value are as for Lgm_LCDS_MultiK().
+ *
+ */
+int Lgm_LCDS_MultiK_Radii( long int Date, double UTC, double brac1, double brac2, int nK, double *Kin, double LT, double tol, int Quality, int nFLsInDriftShell, double *LCDS, double *K, double *Bm, double *Rlcds, int *Flag, Lgm_LstarInfo *LstarInfo ) {
+
+    int                 i, j, k, nR, nThreads, nActive, nFound = 0, Iter;
+    int                 *Want, *iR, *Defined, *Active, *Closed, nOpen = 0;
+    double              *Rin, *Rout, *Alpha, *LS, *Ks, *Bms, *R, *Bmin, *Open, r, sa;
+    Lgm_Vector          *Pmin;
+    Lgm_DateTime        DT_UTC;
+    Lgm_LstarInfo       *l0;
+    Lgm_LstarInfoPool   *Pool;
+
+    if ( nK < 1 ) return( 0 );
+
+    /*
+     *  One copy of LstarInfo set up for the L* calculations, and the
+     *  per-thread scratch copies made from it.
+     */
+    l0 = Lgm_CopyLstarInfo( LstarInfo );
+    Lgm_SetLstarTolerances( Quality, nFLsInDriftShell, l0 );
+    Lgm_Set_Coord_Transforms( Date, UTC, l0->mInfo->c );
+    Lgm_Make_UTC( Date, UTC, &DT_UTC, l0->mInfo->c );
+#if USE_OPENMP
+    nThreads = omp_get_max_threads();
+#else
+    nThreads = 1;
+#endif
+    Pool = Lgm_InitLstarInfoPool( nThreads );
+
+    Want    = (int *) calloc( nK, sizeof( int ) );
+    iR      = (int *) calloc( nK, sizeof( int ) );
+    Defined = (int *) calloc( nK, sizeof( int ) );
+    Active  = (int *) calloc( nK, sizeof( int ) );
+    Closed  = (int *) calloc( nK, sizeof( int ) );
+    Rin     = (double *) calloc( nK, sizeof( double ) );
+    Rout    = (double *) calloc( nK, sizeof( double ) );
+    Alpha   = (double *) calloc( nK, sizeof( double ) );
+    LS      = (double *) calloc( nK, sizeof( double ) );
+    Ks      = (double *) calloc( nK, sizeof( double ) );
+    Bms     = (double *) calloc( nK, sizeof( double ) );
+    R       = (double *) calloc( nK, sizeof( double ) );
+    Bmin    = (double *) calloc( nK, sizeof( double ) );
+    Pmin    = (Lgm_Vector *) calloc( nK, sizeof( Lgm_Vector ) );
+    Open    = (double *) calloc( 2*LGM_LCDS_MAXITER*nK + 2, sizeof( double ) );
+
+    for ( k=0; k<nK; k++ ) {
+        LCDS[k] = K[k] = Bms[k] = LGM_FILL_VALUE;
+        Flag[k] = 0;
+        Rin[k]  = brac1; Rout[k] = brac2;
+        Want[k] = TRUE; iR[k] = 0;
+    }
+
+
+    /*
+     *  Inner bracket. One trace for all of the K values.
+     */
+    R[0] = brac1;
+    Closed[0] = Lgm_LCDS_Probe( &DT_UTC, brac1, LT+12.0, nK, Kin, Want, Alpha, &Pmin[0], &Bmin[0], l0->mInfo );
+    Lgm_LCDS_Shells( nK, Want, iR, Closed, Alpha, Pmin, Bmin, Defined, LS, Ks, l0, Pool );
+    for ( k=0; k<nK; k++ ) {
+        if ( Defined[k] ) {
+            LCDS[k] = LS[k]; K[k] = Ks[k];
+            sa = sin( Alpha[k]*RadPerDeg ); Bms[k] = Bmin[0]/( sa*sa );
+            Active[k] = TRUE;
+        } else {
+            if ( LstarInfo->VerbosityLevel > 0 ) printf("Lgm_LCDS_MultiK: Undefined DS at inner bracket for K = %g (R = %g)\n", Kin[k], brac1 );
+            Flag[k] = -8;
+        }
+        Want[k] = Active[k];
+    }
+
+
+    /*
+     *  Outer bracket. If the shell is defined there too, move it out and try
+     *  once more.
+     */
+    for ( i=0; i<2; i++ ) {
+        r = ( i == 0 ) ? brac2 : 1.7*brac2;
+        Closed[0] = Lgm_LCDS_Probe( &DT_UTC, r, LT+12.0, nK, Kin, Want, Alpha, &Pmin[0], &Bmin[0], l0->mInfo );
+        if ( !Closed[0] ) break;
+        Lgm_LCDS_Shells( nK, Want, iR, Closed, Alpha, Pmin, Bmin, Defined, LS, Ks, l0, Pool );
+        for ( nActive=0, k=0; k<nK; k++ ) {
+            if ( !Want[k] ) continue;
+            if ( Defined[k] ) {
+                if ( i == 0 ) {
+                    Rout[k] = 1.7*brac2;
+                    ++nActive;
+                } else {
+                    if ( LstarInfo->VerbosityLevel > 0 ) printf("Lgm_LCDS_MultiK: DS still defined at outer bracket for K = %g (R = %g)\n", Kin[k], r );
+                    Flag[k] = -9; Active[k] = FALSE;
+                }
+            }
+            Want[k] = ( i == 0 ) && Defined[k];
+        }
+        if ( nActive == 0 ) break;
+    }
+
+
+    /*
+     *  Bisect all of the K values together.
+     */
+    for ( Iter=0; ; Iter++ ) {
+
+        /*
+         *  Known open field lines inside a bracket narrow it for free.
+         *  Then pick the test radii and merge identical ones.
+         */
+        for ( nR=0, nActive=0, k=0; k<nK; k++ ) {
+            Want[k] = FALSE;
+            if ( !Active[k] ) continue;
+            for ( j=0; j<nOpen; j++ ) if ( ( Open[j] > Rin[k] ) && ( Open[j] < Rout[k] ) ) Rout[k] = Open[j];
+            if ( Rout[k] - Rin[k] <= tol ) { Active[k] = FALSE; continue; }
+            if ( Iter >= LGM_LCDS_MAXITER ) {
+                printf("Lgm_LCDS_MultiK: ********* EXCEEDED MAXITER for K = %g\n", Kin[k] );
+                Flag[k] = -2; Active[k] = FALSE;
+                continue;
+            }
+            r = 0.5*( Rin[k] + Rout[k] );
+            for ( j=0; ( j < nR ) && ( fabs( R[j] - r ) > LGM_LCDS_SAME_R ); j++ );
+            if ( j == nR ) R[nR++] = r;
+            iR[k] = j; Want[k] = TRUE; ++nActive;
+        }
+        if ( nActive == 0 ) break;
+        if ( LstarInfo->VerbosityLevel > 2 ) printf("Lgm_LCDS_MultiK: Iteration %d, %d K values left, %d field lines to trace\n", Iter, nActive, nR );
+
+        /*
+         *  Trace the distinct radii (in parallel), each for the K values
+         *  that are testing it.
+         */
+#if USE_OPENMP
+        #pragma omp parallel private(k)
+        #pragma omp for schedule(dynamic, 1)
+#endif
+        for ( j=0; j<nR; j++ ) {
+            int                 *WantR = (int *) calloc( nK, sizeof( int ) );
+            Lgm_MagModelInfo    *m     = Lgm_NewMagContext( l0->mInfo );
+            for ( k=0; k<nK; k++ ) WantR[k] = Want[k] && ( iR[k] == j );
+            Closed[j] = Lgm_LCDS_Probe( &DT_UTC, R[j], LT, nK, Kin, WantR, Alpha, &Pmin[j], &Bmin[j], m );
+            Lgm_FreeMagInfo( m );
+            free( WantR );
+        }
+        for ( j=0; j<nR; j++ ) if ( !Closed[j] ) Open[nOpen++] = R[j];
+
+        /*
+         *  L* at each test radius (in parallel over K).
+         */
+        Lgm_LCDS_Shells( nK, Want, iR, Closed, Alpha, Pmin, Bmin, Defined, LS, Ks, l0, Pool );
+        for ( k=0; k<nK; k++ ) {
+            if ( !Want[k] ) continue;
+            if ( Defined[k] ) {
+                Rin[k]  = R[iR[k]];
+                LCDS[k] = LS[k]; K[k] = Ks[k];
+                sa = sin( Alpha[k]*RadPerDeg ); Bms[k] = Bmin[iR[k]]/( sa*sa );
+                if ( LstarInfo->VerbosityLevel > 1 ) printf("Lgm_LCDS_MultiK: K = %g, current LCDS, K = %g, %g (R = %g)\n", Kin[k], LCDS[k], K[k], Rin[k] );
+            } else {
+                Rout[k] = R[iR[k]];
+            }
+        }
+
+    }
+
+    for ( k=0; k<nK; k++ ) {
+        if ( Flag[k] == 0 ) ++nFound;
+        if ( Bm != NULL ) Bm[k] = Bms[k];
+        if ( Rlcds != NULL ) Rlcds[k] = ( Flag[k] == 0 ) ? Rin[k] : LGM_FILL_VALUE;
+        if ( LstarInfo->VerbosityLevel > 0 ) printf("Lgm_LCDS_MultiK: K = %g, Final LCDS, K is %g, %g (Flag = %d)\n", Kin[k], LCDS[k], K[k], Flag[k] );
+    }
+
+    free( Want ); free( iR ); free( Defined ); free( Active ); free( Closed );
+    free( Rin ); free( Rout ); free( Alpha ); free( LS ); free( Ks ); free( Bms ); free( R );
+    free( Bmin ); free( Pmin ); free( Open );
+    Lgm_FreeLstarInfoPool( Pool );
+    FreeLstarInfo( l0 );
+
+    return( nFound );
+
+}
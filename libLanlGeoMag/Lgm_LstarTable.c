@@ -0,0 +1,898 @@
+/*! \file Lgm_LstarTable.c
+ *
+ *  \brief Precomputed L* versus (K, Bm, MLT) for one model state.
+ *
+ *  A nowcast that answers many L* queries for the same magnetic state can
+ *  build one of these once (per cadence) and then answer each query with a
+ *  few table lookups instead of a full drift shell calculation.
+ *
+ *  The table is made of columns, one for every (MLT, Bm) pair on the grid.
+ *  Column (i, j) holds nodes along the SM equatorial radius at MLT[i]: node k
+ *  is the field line through R[k], and for it Lstar() is run with Bm[j],
+ *  giving K and L*. At fixed Bm both K and L* grow with R, so a column is a
+ *  monotone curve L*(K) and it can be interpolated in K directly (no
+ *  inversion is needed to build the table). The interpolation in K is a
+ *  monotone (Fritsch-Carlson) cubic, and the columns are then combined
+ *  bilinearly in MLT and log(Bm).
+ *
+ *  Every interval between two nodes carries an error estimate: the
+ *  difference, at the middle of the interval, between the cubic and the
+ *  straight line through the two nodes. Lookups add to that an estimate of
+ *  the error of the bilinear part, from the second differences across the
+ *  next column out in Bm and in MLT. Lgm_LstarTable_Refine() splits every
+ *  interval whose estimate is too big, and Lgm_LstarTable_LookupRefine()
+ *  does the same on demand, only for the columns a particular query lands
+ *  in. Refinement only adds nodes in R, so it cant do anything about the
+ *  Bm and MLT part of the error; if that is too big the table needs a
+ *  finer Bm (or MLT) grid. Lookups are read-only and can be done from any
+ *  number of threads; refinement changes the columns, so it must not run at
+ *  the same time as lookups on the same table.
+ *
+ *  Tables can be saved (Lgm_WriteLstarTable()) and loaded
+ *  (Lgm_ReadLstarTable()). The file is the Lgm_LstarTableHeader followed by
+ *  each column in turn (an int32 node count, then R, K and L* for each
+ *  node), in native byte order. With Lgm_SetShmCache( TRUE ) the same image
+ *  is also kept in shared memory, so that other processes computing the
+ *  same table (same model state, grid and L* quality settings) just copy it
+ *  (see Lgm_ShmCache.c).
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+#include "Lgm/Lgm_ShmCache.h"
+
+#define LGM_LSTARTABLE_TRACE_TOL    1e-7
+#define LGM_LSTARTABLE_TRACE_TOL2   1e-10
+#define LGM_LSTARTABLE_MAX_LEVELS   6       // intervals are never split more than this many times
+
+
+static double Lgm_LstarTable_MLT( Lgm_LstarTable *t, int i ) {
+    return( 24.0*i/(double)t->h.nMLT );
+}
+
+static double Lgm_LstarTable_Bm( Lgm_LstarTable *t, int j ) {
+    return( t->h.Bm0*pow( t->h.Bm1/t->h.Bm0, j/(double)(t->h.nBm-1) ) );
+}
+
+
+static void Lgm_LstarTable_AllocColumn( Lgm_LstarTableColumn *c, int n ) {
+
+    c->nAlloced = n;
+    c->R     = (double *) realloc( c->R,     n*sizeof( double ) );
+    c->K     = (double *) realloc( c->K,     n*sizeof( double ) );
+    c->Lstar = (double *) realloc( c->Lstar, n*sizeof( double ) );
+    c->D     = (double *) realloc( c->D,     n*sizeof( double ) );
+    c->Err   = (double *) realloc( c->Err,   n*sizeof( double ) );
+
+}
+
+
+/*
+ *  Work out the slopes and the interval error estimates of a column. An
+ *  interval can be interpolated if both of its nodes have an L* and K
+ *  increases across it.
+ */
+static void Lgm_LstarTable_PrepareColumn( Lgm_LstarTableColumn *c ) {
+
+    int     k, Left, Right;
+    double  h0, h1, d0, d1, w0, w1;
+
+    for ( k=0; k<c->n-1; k++ ) {
+        c->Err[k] = ( ( c->Lstar[k] != LGM_FILL_VALUE ) && ( c->Lstar[k+1] != LGM_FILL_VALUE ) && ( c->K[k+1] > c->K[k] ) ) ? 0.0 : -1.0;
+    }
+    if ( c->n > 0 ) c->Err[c->n-1] = -1.0;
+
+    for ( k=0; k<c->n; k++ ) {
+
+        Left  = ( k > 0 ) && ( c->Err[k-1] >= 0.0 );
+        Right = ( k < c->n-1 ) && ( c->Err[k] >= 0.0 );
+
+        if ( Left ) {
+            h0 = c->K[k] - c->K[k-1];
+            d0 = ( c->Lstar[k] - c->Lstar[k-1] )/h0;
+        }
+        if ( Right ) {
+            h1 = c->K[k+1] - c->K[k];
+            d1 = ( c->Lstar[k+1] - c->Lstar[k] )/h1;
+        }
+
+        if ( Left && Right ) {
+            if ( d0*d1 <= 0.0 ) {
+                c->D[k] = 0.0;
+            } else {
+                w0 = 2.0*h1 + h0;
+                w1 = h1 + 2.0*h0;
+                c->D[k] = ( w0 + w1 )/( w0/d0 + w1/d1 );
+            }
+        } else if ( Left ) {
+            c->D[k] = d0;
+        } else if ( Right ) {
+            c->D[k] = d1;
+        } else {
+            c->D[k] = 0.0;
+        }
+
+    }
+
+    /*
+     *  At the middle of an interval the cubic differs from the straight line
+     *  by h*(D0 - D1)/8.
+     */
+    for ( k=0; k<c->n-1; k++ ) {
+        if ( c->Err[k] >= 0.0 ) c->Err[k] = fabs( ( c->K[k+1] - c->K[k] )*( c->D[k] - c->D[k+1] ) )/8.0;
+    }
+
+}
+
+
+/*
+ *  Put a new node into a column (keeping it sorted by R).
+ */
+static void Lgm_LstarTable_InsertNode( Lgm_LstarTableColumn *c, double R, double K, double Lstar ) {
+
+    int k, m;
+
+    if ( c->n >= c->nAlloced ) Lgm_LstarTable_AllocColumn( c, 2*c->nAlloced + 8 );
+
+    for ( k=0; ( k < c->n ) && ( c->R[k] < R ); k++ );
+    for ( m=c->n; m>k; m-- ) {
+        c->R[m]     = c->R[m-1];
+        c->K[m]     = c->K[m-1];
+        c->Lstar[m] = c->Lstar[m-1];
+    }
+    c->R[k]     = R;
+    c->K[k]     = K;
+    c->Lstar[k] = Lstar;
+    ++c->n;
+
+}
+
+
+/*
+ *  Compute K and L* for the line through radius R (SM equatorial plane) at
+ *  MLT, for mirror field Bm. Returns 1 if L* was found, 0 if particles with
+ *  this Bm cant be on the line (Bmin >= Bm) and -1 if the line or its drift
+ *  shell is not closed.
+ */
+static int Lgm_LstarTable_Node( double MLT, double R, double Bm, double *K, double *Lstar_out, Lgm_LstarInfo *LstarInfo ) {
+
+    double      Phi, Bmin;
+    Lgm_Vector  u, u_sm, v1, v2, v3;
+
+    *K = *Lstar_out = LGM_FILL_VALUE;
+
+    Phi = ( MLT - 12.0 )*15.0*RadPerDeg;
+    u_sm.x = R*cos( Phi ); u_sm.y = R*sin( Phi ); u_sm.z = 0.0;
+    Lgm_Convert_Coords( &u_sm, &u, SM_TO_GSM, LstarInfo->mInfo->c );
+
+    if ( Lgm_Trace( &u, &v1, &v2, &v3, LstarInfo->mInfo->Lgm_LossConeHeight, LGM_LSTARTABLE_TRACE_TOL, LGM_LSTARTABLE_TRACE_TOL2, LstarInfo->mInfo ) != LGM_CLOSED ) return( -1 );
+
+    Bmin = LstarInfo->mInfo->Bmin;
+    if ( Bmin >= Bm ) return( 0 );
+    if ( Lgm_Magnitude( &v3 ) >= LstarInfo->LSimpleMax ) return( -1 );
+
+    LstarInfo->mInfo->Bm  = Bm;
+    LstarInfo->PitchAngle = DegPerRad*asin( sqrt( Bmin/Bm ) );
+    if ( Lstar( &v3, LstarInfo ) < 0 ) return( -1 );
+
+    *K         = LstarInfo->I[0]*sqrt( Bm*1e-5 );
+    *Lstar_out = LstarInfo->LS;
+
+    return( 1 );
+
+}
+
+
+/*
+ *  Copy of LstarInfo for one column's worth of work (and folding its
+ *  evaluation counts back in when it is done).
+ */
+static Lgm_LstarInfo *Lgm_LstarTable_GetLstarInfo( Lgm_LstarInfo *LstarInfo ) {
+
+    Lgm_LstarInfo *l;
+
+    l = Lgm_CopyLstarInfo( LstarInfo );
+    l->SaveShellLines = FALSE;
+    l->mInfo->Lgm_nMagEvals = 0;
+    Lgm_MagModelInfo_ResetStats( l->mInfo );
+
+    return( l );
+
+}
+
+static void Lgm_LstarTable_PutLstarInfo( Lgm_LstarInfo *l, Lgm_LstarInfo *LstarInfo ) {
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_LstarTable)
+#endif
+    {
+        LstarInfo->mInfo->Lgm_nMagEvals += l->mInfo->Lgm_nMagEvals;
+        Lgm_MagModelInfo_AddStats( LstarInfo->mInfo, l->mInfo );
+    }
+    FreeLstarInfo( l );
+
+}
+
+
+/*
+ *  Fill in column (i, j) on the starting radii. Once a drift shell has been
+ *  found, the first one that isnt closed ends the column (the rest are
+ *  further out).
+ */
+static int Lgm_LstarTable_ComputeColumn( Lgm_LstarTable *t, int i, int j, Lgm_LstarInfo *LstarInfo ) {
+
+    int                     k, Flag, nValid = 0, Done = FALSE;
+    double                  MLT, Bm;
+    Lgm_LstarTableColumn    *c = &t->Col[i*t->h.nBm + j];
+
+    MLT = Lgm_LstarTable_MLT( t, i );
+    Bm  = Lgm_LstarTable_Bm( t, j );
+
+    c->n = 0;
+    for ( k=0; k<t->h.nR; k++ ) {
+        c->R[k] = t->h.R0 + ( t->h.R1 - t->h.R0 )*k/(double)(t->h.nR-1);
+        c->K[k] = c->Lstar[k] = LGM_FILL_VALUE;
+        if ( !Done ) {
+            Flag = Lgm_LstarTable_Node( MLT, c->R[k], Bm, &c->K[k], &c->Lstar[k], LstarInfo );
+            if ( Flag > 0 ) ++nValid;
+            else if ( ( Flag < 0 ) && ( nValid > 0 ) ) Done = TRUE;
+        }
+        ++c->n;
+    }
+    Lgm_LstarTable_PrepareColumn( c );
+
+    return( nValid );
+
+}
+
+
+/*
+ *  Split interval k of column (i, j) in two. Returns TRUE if a node was added.
+ */
+static int Lgm_LstarTable_SplitInterval( Lgm_LstarTable *t, int i, int j, int k, Lgm_LstarInfo *LstarInfo ) {
+
+    double                  R, K, Lstar;
+    Lgm_LstarTableColumn    *c = &t->Col[i*t->h.nBm + j];
+
+    if ( ( k < 0 ) || ( k >= c->n-1 ) || ( c->R[k+1] - c->R[k] < 2.0*t->h.dRmin ) ) return( FALSE );
+
+    R = 0.5*( c->R[k] + c->R[k+1] );
+    Lgm_LstarTable_Node( Lgm_LstarTable_MLT( t, i ), R, Lgm_LstarTable_Bm( t, j ), &K, &Lstar, LstarInfo );
+    Lgm_LstarTable_InsertNode( c, R, K, Lstar );
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Evaluate a column at K. Returns FALSE if K isnt inside an interval that
+ *  can be interpolated.
+ */
+static int Lgm_LstarTable_ColumnEval( Lgm_LstarTableColumn *c, double K, double *Lstar, double *Err ) {
+
+    int     k;
+    double  h, s, s2, s3;
+
+    for ( k=0; k<c->n-1; k++ ) {
+        if ( ( c->Err[k] >= 0.0 ) && ( K >= c->K[k] ) && ( K <= c->K[k+1] ) ) {
+            h  = c->K[k+1] - c->K[k];
+            s  = ( K - c->K[k] )/h; s2 = s*s; s3 = s2*s;
+            *Lstar = ( 2.0*s3 - 3.0*s2 + 1.0 )*c->Lstar[k] + ( s3 - 2.0*s2 + s )*h*c->D[k]
+                   + ( -2.0*s3 + 3.0*s2 )*c->Lstar[k+1] + ( s3 - s2 )*h*c->D[k+1];
+            *Err   = c->Err[k];
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+
+}
+
+
+/*
+ *  Which interval of a column should be split to get a better answer at K?
+ *  Either the one K is in (if its error is above Tol), or, if K is off the
+ *  end of the nodes that have an L*, the interval just past them. Returns -1
+ *  if there isnt one.
+ */
+static int Lgm_LstarTable_ColumnWhere( Lgm_LstarTableColumn *c, double K, double Tol ) {
+
+    int     k, kMin = -1, kMax = -1;
+
+    for ( k=0; k<c->n-1; k++ ) {
+        if ( ( c->Err[k] >= 0.0 ) && ( K >= c->K[k] ) && ( K <= c->K[k+1] ) ) return( ( c->Err[k] > Tol ) ? k : -1 );
+    }
+
+    for ( k=0; k<c->n; k++ ) {
+        if ( c->Lstar[k] == LGM_FILL_VALUE ) continue;
+        if ( ( kMin < 0 ) || ( c->K[k] < c->K[kMin] ) ) kMin = k;
+        if ( ( kMax < 0 ) || ( c->K[k] > c->K[kMax] ) ) kMax = k;
+    }
+    if ( kMax < 0 ) return( -1 );
+
+    if ( K > c->K[kMax] ) return( ( kMax < c->n-1 ) ? kMax : -1 );
+    if ( K < c->K[kMin] ) return( kMin-1 );
+
+    return( -1 );
+
+}
+
+
+/*
+ *  Where (MLT, Bm) falls on the grid. Returns FALSE if Bm is off the grid.
+ */
+static int Lgm_LstarTable_Cell( Lgm_LstarTable *t, double MLT, double Bm, int *i0, int *i1, double *fx, int *j0, double *fy ) {
+
+    double  x, y;
+
+    if ( Bm <= 0.0 ) return( FALSE );
+    y = log( Bm/t->h.Bm0 )/log( t->h.Bm1/t->h.Bm0 )*( t->h.nBm - 1 );
+    if ( ( y < -1e-9 ) || ( y > t->h.nBm - 1 + 1e-9 ) ) return( FALSE );
+    if ( y < 0.0 ) y = 0.0;
+    *j0 = (int)y; if ( *j0 > t->h.nBm-2 ) *j0 = t->h.nBm-2;
+    *fy = y - *j0;
+
+    x  = fmod( MLT, 24.0 ); if ( x < 0.0 ) x += 24.0;
+    x *= t->h.nMLT/24.0;
+    *i0 = (int)x; if ( *i0 >= t->h.nMLT ) *i0 = t->h.nMLT-1;
+    *i1 = ( *i0 + 1 )%t->h.nMLT;
+    *fx = x - *i0;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  The table as one block (the same layout as the file), for the shared
+ *  memory cache.
+ */
+static void *Lgm_LstarTable_Pack( Lgm_LstarTable *t, size_t *Size ) {
+
+    int     n;
+    int32_t nNodes;
+    char    *b, *p;
+
+    *Size = sizeof( t->h );
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) *Size += sizeof( int32_t ) + 3*t->Col[n].n*sizeof( double );
+    if ( (b = (char *) malloc( *Size )) == NULL ) return( NULL );
+
+    memcpy( b, &t->h, sizeof( t->h ) );
+    p = b + sizeof( t->h );
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) {
+        nNodes = t->Col[n].n;
+        memcpy( p, &nNodes, sizeof( nNodes ) );                    p += sizeof( nNodes );
+        memcpy( p, t->Col[n].R, nNodes*sizeof( double ) );         p += nNodes*sizeof( double );
+        memcpy( p, t->Col[n].K, nNodes*sizeof( double ) );         p += nNodes*sizeof( double );
+        memcpy( p, t->Col[n].Lstar, nNodes*sizeof( double ) );     p += nNodes*sizeof( double );
+    }
+
+    return( b );
+
+}
+
+/*
+ *  Fill in the columns of t from a block made by Lgm_LstarTable_Pack().
+ *  Returns the number of nodes that have an L*, or -1 if the block doesnt
+ *  fit t.
+ */
+static int Lgm_LstarTable_Unpack( Lgm_LstarTable *t, const char *b, size_t Size ) {
+
+    int                     n, k, nValid = 0;
+    int32_t                 nNodes;
+    const char              *p = b + sizeof( t->h ), *e = b + Size;
+    Lgm_LstarTableColumn    *c;
+
+    if ( ( Size < sizeof( t->h ) ) || memcmp( b, &t->h, sizeof( t->h ) ) ) return( -1 );
+
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) {
+        c = &t->Col[n];
+        if ( p + sizeof( nNodes ) > e ) return( -1 );
+        memcpy( &nNodes, p, sizeof( nNodes ) ); p += sizeof( nNodes );
+        if ( ( nNodes < 0 ) || ( p + 3*nNodes*sizeof( double ) > e ) ) return( -1 );
+        if ( nNodes > c->nAlloced ) Lgm_LstarTable_AllocColumn( c, nNodes );
+        c->n = nNodes;
+        memcpy( c->R, p, nNodes*sizeof( double ) );         p += nNodes*sizeof( double );
+        memcpy( c->K, p, nNodes*sizeof( double ) );         p += nNodes*sizeof( double );
+        memcpy( c->Lstar, p, nNodes*sizeof( double ) );     p += nNodes*sizeof( double );
+        Lgm_LstarTable_PrepareColumn( c );
+        for ( k=0; k<nNodes; k++ ) if ( c->Lstar[k] != LGM_FILL_VALUE ) ++nValid;
+    }
+
+    return( nValid );
+
+}
+
+/*
+ *  Shared memory key of the table for the model state in its header (0 if
+ *  it shouldnt be shared).
+ */
+static unsigned long Lgm_LstarTable_ShmKey( Lgm_LstarTable *t, Lgm_LstarInfo *LstarInfo ) {
+
+    unsigned long   Key;
+
+    if ( !Lgm_GetShmCache() || !(Key = Lgm_ModelFingerprint( LstarInfo->mInfo->Bfield, LstarInfo->mInfo )) ) return( 0 );
+    Key = Lgm_ShmCache_Key( Key, &t->h, sizeof( t->h ) );
+    Key = Lgm_ShmCache_Key( Key, &LstarInfo->LstarQuality, sizeof( LstarInfo->LstarQuality ) );
+    Key = Lgm_ShmCache_Key( Key, &LstarInfo->nFLsInDriftShell, sizeof( LstarInfo->nFLsInDriftShell ) );
+    Key = Lgm_ShmCache_Key( Key, &LstarInfo->LSimpleMax, sizeof( LstarInfo->LSimpleMax ) );
+    Key = Lgm_LstarTolProfile_Hash( Key, LstarInfo->TolProfile );
+
+    return( Key ? Key : 1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Allocate an (empty) L* table.
+ *
+ *  \details
+ *      The grid has nMLT MLTs evenly spaced over 0-24h (starting at 0) and
+ *      nBm values of Bm evenly spaced in log(Bm) from Bm0 to Bm1. Each
+ *      column starts with nR radii evenly spaced from R0 to R1 (SM
+ *      equatorial plane). The table must be filled in with
+ *      Lgm_ComputeLstarTable().
+ *
+ *      \return The table, or NULL if the grid is invalid.
+ *
+ */
+Lgm_LstarTable *Lgm_InitLstarTable( int nMLT, int nBm, double Bm0, double Bm1, int nR, double R0, double R1 ) {
+
+    int             n;
+    Lgm_LstarTable  *t;
+
+    if ( ( nMLT < 1 ) || ( nBm < 2 ) || ( nR < 2 ) || ( Bm0 <= 0.0 ) || ( Bm1 <= Bm0 ) || ( R0 <= 0.0 ) || ( R1 <= R0 ) ) {
+        printf("Lgm_InitLstarTable: Invalid grid (nMLT = %d, nBm = %d, Bm = %g - %g, nR = %d, R = %g - %g)\n", nMLT, nBm, Bm0, Bm1, nR, R0, R1 );
+        return( NULL );
+    }
+
+    t = (Lgm_LstarTable *) calloc( 1, sizeof( *t ) );
+    memcpy( t->h.Magic, LGM_LSTARTABLE_MAGIC, 8 );
+    t->h.Version   = LGM_LSTARTABLE_VERSION;
+    t->h.ByteOrder = 1.0;
+    t->h.nMLT      = nMLT;
+    t->h.nBm       = nBm;
+    t->h.nR        = nR;
+    t->h.Bm0       = Bm0;
+    t->h.Bm1       = Bm1;
+    t->h.R0        = R0;
+    t->h.R1        = R1;
+    t->h.dRmin     = ( R1 - R0 )/(double)(nR-1)/pow( 2.0, LGM_LSTARTABLE_MAX_LEVELS );
+
+    t->Col = (Lgm_LstarTableColumn *) calloc( nMLT*nBm, sizeof( Lgm_LstarTableColumn ) );
+    for ( n=0; n<nMLT*nBm; n++ ) Lgm_LstarTable_AllocColumn( &t->Col[n], nR );
+
+    return( t );
+
+}
+
+
+void Lgm_FreeLstarTable( Lgm_LstarTable *t ) {
+
+    int n;
+
+    if ( t == NULL ) return;
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) {
+        free( t->Col[n].R );
+        free( t->Col[n].K );
+        free( t->Col[n].Lstar );
+        free( t->Col[n].D );
+        free( t->Col[n].Err );
+    }
+    free( t->Col );
+    free( t );
+
+}
+
+
+/**
+ *  \brief
+ *      Fill in an L* table for the current model state.
+ *
+ *  \details
+ *      L* is computed with Lstar() for every node, using the settings (and
+ *      model) in LstarInfo, which should be set up as it would be for
+ *      Lgm_ComputeLstarVersusPA() (e.g. with Lgm_SetLstarTolerances() and
+ *      the coordinate transformations for the epoch wanted). The columns are
+ *      done in parallel (OpenMP builds) on copies of LstarInfo. The model
+ *      state is recorded in the table header (see Lgm_LstarTable_Matches()).
+ *      If the shared memory cache is on (Lgm_SetShmCache()) and another
+ *      process has already computed the same table, it is copied from there
+ *      instead.
+ *
+ *      \param[in,out]  t           Table from Lgm_InitLstarTable().
+ *      \param[in,out]  LstarInfo   Properly initialized/configured Lgm_LstarInfo structure.
+ *
+ *      \return The number of nodes that have an L*.
+ *
+ */
+int Lgm_ComputeLstarTable( Lgm_LstarTable *t, Lgm_LstarInfo *LstarInfo ) {
+
+    int                 n, nn, nValid = 0;
+    unsigned long       Key;
+    size_t              Size;
+    void                *p;
+    Lgm_MagModelInfo    *m = LstarInfo->mInfo;
+    Lgm_LstarInfo       *l;
+
+    if ( t == NULL ) return( 0 );
+
+    t->h.Date           = m->c->UTC.Date;
+    t->h.UTC            = m->c->UTC.Time;
+    t->h.JD             = m->c->UTC.JD;
+    t->h.InternalModel  = m->InternalModel;
+    t->h.ExternalModel  = m->ExternalModel;
+    t->h.Kp             = m->Kp;
+    t->h.fKp            = m->fKp;
+    t->h.Dst            = m->Dst;
+    t->h.P              = m->P;
+    t->h.By             = m->By;
+    t->h.Bz             = m->Bz;
+    memcpy( t->h.W, m->W, sizeof( t->h.W ) );
+    t->h.LossConeHeight = m->Lgm_LossConeHeight;
+
+    Key = Lgm_LstarTable_ShmKey( t, LstarInfo );
+    if ( Key && ( (p = Lgm_ShmCache_Find( LGM_SHM_LSTARTABLE, Key, &Size )) != NULL ) ) {
+        nValid = Lgm_LstarTable_Unpack( t, (char *)p, Size );
+        Lgm_ShmCache_Release( p );
+        if ( nValid >= 0 ) return( nValid );
+        nValid = 0;
+    }
+
+#if USE_OPENMP
+    #pragma omp parallel private(l,nn)
+    #pragma omp for schedule(dynamic, 1) reduction(+:nValid)
+#endif
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) {
+
+        l  = Lgm_LstarTable_GetLstarInfo( LstarInfo );
+        nn = Lgm_LstarTable_ComputeColumn( t, n/t->h.nBm, n%t->h.nBm, l );
+        nValid += nn;
+        Lgm_LstarTable_PutLstarInfo( l, LstarInfo );
+
+    }
+
+    if ( Key && ( (p = Lgm_LstarTable_Pack( t, &Size )) != NULL ) ) {
+        Lgm_ShmCache_Release( Lgm_ShmCache_Publish( LGM_SHM_LSTARTABLE, Key, p, Size ) );
+        free( p );
+    }
+
+    return( nValid );
+
+}
+
+
+/**
+ *  \brief
+ *      Refine an L* table until no interval has an error estimate above Tol.
+ *
+ *  \details
+ *      Intervals are split at their middle radius (down to a width of
+ *      h.dRmin, i.e. LGM_LSTARTABLE_MAX_LEVELS times). Only intervals that
+ *      can already be interpolated are refined; the edges of the columns
+ *      are left to Lgm_LstarTable_LookupRefine().
+ *
+ *      \param[in,out]  t           Table filled in by Lgm_ComputeLstarTable() (or read with Lgm_ReadLstarTable()).
+ *      \param[in]      Tol         Largest acceptable error estimate (in L*).
+ *      \param[in,out]  LstarInfo   Same setup that the table was made with.
+ *
+ *      \return The number of nodes added, or -1 if LstarInfo is not for the tables model state.
+ *
+ */
+int Lgm_LstarTable_Refine( Lgm_LstarTable *t, double Tol, Lgm_LstarInfo *LstarInfo ) {
+
+    int             n, k, nAdded = 0, nSplit;
+    Lgm_LstarInfo   *l;
+
+    if ( t == NULL ) return( 0 );
+    if ( !Lgm_LstarTable_Matches( t, LstarInfo->mInfo ) ) {
+        printf("Lgm_LstarTable_Refine: LstarInfo is not set up for the model state the table was made for\n");
+        return( -1 );
+    }
+
+#if USE_OPENMP
+    #pragma omp parallel private(l,k,nSplit)
+    #pragma omp for schedule(dynamic, 1) reduction(+:nAdded)
+#endif
+    for ( n=0; n<t->h.nMLT*t->h.nBm; n++ ) {
+
+        l = Lgm_LstarTable_GetLstarInfo( LstarInfo );
+        do {
+            nSplit = 0;
+            for ( k=t->Col[n].n-2; k>=0; k-- ) { // backwards, so inserting doesnt move the intervals still to do
+                if ( t->Col[n].Err[k] > Tol ) nSplit += Lgm_LstarTable_SplitInterval( t, n/t->h.nBm, n%t->h.nBm, k, l );
+            }
+            Lgm_LstarTable_PrepareColumn( &t->Col[n] );
+            nAdded += nSplit;
+        } while ( nSplit > 0 );
+        Lgm_LstarTable_PutLstarInfo( l, LstarInfo );
+
+    }
+
+    return( nAdded );
+
+}
+
+
+/**
+ *  \brief
+ *      Look up L* in a table.
+ *
+ *  \details
+ *      The four columns around (MLT, Bm) are each interpolated at K, and
+ *      the results are combined bilinearly in MLT and log(Bm). Nothing is
+ *      changed, so any number of threads can look up in the same table.
+ *      Both outputs are LGM_FILL_VALUE if the table doesnt cover the query.
+ *
+ *      \param[in]      t       Table.
+ *      \param[in]      K       Second invariant (G^1/2 Re, as in MagEphemInfo->K).
+ *      \param[in]      Bm      Mirror field (nT).
+ *      \param[in]      MLT     Magnetic local time (hours) of the drift shell line the particle is on.
+ *      \param[out]     Lstar   Interpolated L*.
+ *      \param[out]     Err     Error estimate for Lstar.
+ *
+ *      \return TRUE if the table covers the query, FALSE otherwise (use Lstar() instead).
+ *
+ */
+int Lgm_LstarTable_Lookup( Lgm_LstarTable *t, double K, double Bm, double MLT, double *Lstar, double *Err ) {
+
+    int     a, b, i[2], j0, i0m, i1p;
+    double  fx, fy, w, E, Lx, d2, wx[2], wy[2], L[2][2];
+
+    *Lstar = *Err = LGM_FILL_VALUE;
+    if ( t == NULL ) return( FALSE );
+    if ( !Lgm_LstarTable_Cell( t, MLT, Bm, &i[0], &i[1], &fx, &j0, &fy ) ) return( FALSE );
+    wx[0] = 1.0 - fx; wx[1] = fx;
+    wy[0] = 1.0 - fy; wy[1] = fy;
+
+    *Lstar = *Err = 0.0;
+    for ( a=0; a<2; a++ ) {
+        for ( b=0; b<2; b++ ) {
+            if ( ( w = wx[a]*wy[b] ) == 0.0 ) continue;
+            if ( !Lgm_LstarTable_ColumnEval( &t->Col[i[a]*t->h.nBm + j0 + b], K, &L[a][b], &E ) ) {
+                *Lstar = *Err = LGM_FILL_VALUE;
+                return( FALSE );
+            }
+            *Lstar += w*L[a][b];
+            *Err   += w*E;
+        }
+    }
+
+    /*
+     *  Error of the linear interpolation in log(Bm), from the second
+     *  difference with the next column out (on whichever side covers K).
+     */
+    if ( ( fy > 0.0 ) && ( fy < 1.0 ) ) {
+        for ( a=0; a<2; a++ ) {
+            if ( wx[a] == 0.0 ) continue;
+            if ( ( j0 > 0 ) && Lgm_LstarTable_ColumnEval( &t->Col[i[a]*t->h.nBm + j0-1], K, &Lx, &E ) ) {
+                d2 = Lx - 2.0*L[a][0] + L[a][1];
+            } else if ( ( j0+2 < t->h.nBm ) && Lgm_LstarTable_ColumnEval( &t->Col[i[a]*t->h.nBm + j0+2], K, &Lx, &E ) ) {
+                d2 = L[a][0] - 2.0*L[a][1] + Lx;
+            } else {
+                continue;
+            }
+            *Err += wx[a]*0.5*fy*( 1.0 - fy )*fabs( d2 );
+        }
+    }
+
+    /*
+     *  Same for MLT.
+     */
+    if ( ( t->h.nMLT >= 3 ) && ( fx > 0.0 ) && ( fx < 1.0 ) ) {
+        i0m = ( i[0] + t->h.nMLT - 1 )%t->h.nMLT;
+        i1p = ( i[1] + 1 )%t->h.nMLT;
+        for ( b=0; b<2; b++ ) {
+            if ( wy[b] == 0.0 ) continue;
+            if ( Lgm_LstarTable_ColumnEval( &t->Col[i0m*t->h.nBm + j0 + b], K, &Lx, &E ) ) {
+                d2 = Lx - 2.0*L[0][b] + L[1][b];
+            } else if ( Lgm_LstarTable_ColumnEval( &t->Col[i1p*t->h.nBm + j0 + b], K, &Lx, &E ) ) {
+                d2 = L[0][b] - 2.0*L[1][b] + Lx;
+            } else {
+                continue;
+            }
+            *Err += wy[b]*0.5*fx*( 1.0 - fx )*fabs( d2 );
+        }
+    }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Look up L* in a table, refining the table first where the query needs it.
+ *
+ *  \details
+ *      Like Lgm_LstarTable_Lookup(), but if the answer isnt good to Tol (or
+ *      K is just past the edge of a column), the intervals the query uses
+ *      are split and the lookup is tried again. This changes the table, so
+ *      it must not be done while other threads are using it.
+ *
+ *      \param[in,out]  t           Table.
+ *      \param[in]      K           Second invariant (G^1/2 Re).
+ *      \param[in]      Bm          Mirror field (nT).
+ *      \param[in]      MLT         Magnetic local time (hours).
+ *      \param[in]      Tol         Largest acceptable error estimate (in L*).
+ *      \param[in,out]  LstarInfo   Same setup that the table was made with.
+ *      \param[out]     Lstar       Interpolated L*.
+ *      \param[out]     Err         Error estimate for Lstar.
+ *
+ *      \return TRUE if the table covers the query, FALSE otherwise. Note
+ *      that Err can still be above Tol if it is the Bm or MLT part of the
+ *      estimate that is too big.
+ *
+ */
+int Lgm_LstarTable_LookupRefine( Lgm_LstarTable *t, double K, double Bm, double MLT, double Tol, Lgm_LstarInfo *LstarInfo, double *Lstar, double *Err ) {
+
+    int             a, b, i[2], j0, n, it, nSplit, Found;
+    double          fx, fy;
+    Lgm_LstarInfo   *l;
+
+    if ( t == NULL ) return( FALSE );
+    Found = Lgm_LstarTable_Lookup( t, K, Bm, MLT, Lstar, Err );
+    if ( ( Found && ( *Err <= Tol ) ) || !Lgm_LstarTable_Cell( t, MLT, Bm, &i[0], &i[1], &fx, &j0, &fy ) ) return( Found );
+    if ( !Lgm_LstarTable_Matches( t, LstarInfo->mInfo ) ) {
+        printf("Lgm_LstarTable_LookupRefine: LstarInfo is not set up for the model state the table was made for\n");
+        return( Found );
+    }
+
+    l = Lgm_LstarTable_GetLstarInfo( LstarInfo );
+    for ( it=0; it<2*LGM_LSTARTABLE_MAX_LEVELS; it++ ) {
+
+        nSplit = 0;
+        for ( a=0; a<2; a++ ) {
+            if ( ( a == 1 ) && ( i[1] == i[0] ) ) break;
+            for ( b=0; b<2; b++ ) {
+                n = i[a]*t->h.nBm + j0 + b;
+                if ( Lgm_LstarTable_SplitInterval( t, i[a], j0+b, Lgm_LstarTable_ColumnWhere( &t->Col[n], K, Tol ), l ) ) {
+                    Lgm_LstarTable_PrepareColumn( &t->Col[n] );
+                    ++nSplit;
+                }
+            }
+        }
+
+        Found = Lgm_LstarTable_Lookup( t, K, Bm, MLT, Lstar, Err );
+        if ( ( nSplit == 0 ) || ( Found && ( *Err <= Tol ) ) ) break;
+
+    }
+    Lgm_LstarTable_PutLstarInfo( l, LstarInfo );
+
+    return( Found );
+
+}
+
+
+/**
+ *  \brief
+ *      Is a table for the model state in m?
+ *
+ *  \details
+ *      Compares the epoch, the model choices (InternalModel, ExternalModel),
+ *      the model parameters (Kp, Dst, P, By, Bz, W) and the loss cone height
+ *      with the ones the table was made with. Models set up by assigning
+ *      m->Bfield directly should also set InternalModel and ExternalModel
+ *      (see Lgm_MagModelInfo_Set_MagModel()) for this to mean anything.
+ *
+ *      \return TRUE if they all match, FALSE otherwise.
+ *
+ */
+int Lgm_LstarTable_Matches( Lgm_LstarTable *t, Lgm_MagModelInfo *m ) {
+
+    if ( ( t == NULL ) || ( m == NULL ) ) return( FALSE );
+
+    if ( fabs( t->h.JD - m->c->UTC.JD ) > 1e-8 ) return( FALSE );
+    if ( ( t->h.InternalModel != m->InternalModel ) || ( t->h.ExternalModel != m->ExternalModel ) ) return( FALSE );
+    if ( ( t->h.Kp != m->Kp ) || ( t->h.fKp != m->fKp ) || ( t->h.Dst != m->Dst ) || ( t->h.P != m->P ) ) return( FALSE );
+    if ( ( t->h.By != m->By ) || ( t->h.Bz != m->Bz ) || memcmp( t->h.W, m->W, sizeof( t->h.W ) ) ) return( FALSE );
+    if ( t->h.LossConeHeight != m->Lgm_LossConeHeight ) return( FALSE );
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Save an L* table.
+ *
+ *      \return TRUE if the table was written, FALSE otherwise.
+ *
+ */
+int Lgm_WriteLstarTable( Lgm_LstarTable *t, const char *Filename ) {
+
+    int             n, Ok = TRUE;
+    int32_t         nNodes;
+    FILE            *fp;
+
+    if ( (fp = fopen( Filename, "wb" )) == NULL ) {
+        printf("Lgm_WriteLstarTable: Could not open %s for writing\n", Filename );
+        return( FALSE );
+    }
+
+    if ( fwrite( &t->h, sizeof( t->h ), 1, fp ) != 1 ) Ok = FALSE;
+    for ( n=0; Ok && ( n<t->h.nMLT*t->h.nBm ); n++ ) {
+        nNodes = t->Col[n].n;
+        if ( ( fwrite( &nNodes, sizeof( nNodes ), 1, fp ) != 1 )
+                || ( fwrite( t->Col[n].R, sizeof( double ), nNodes, fp ) != nNodes )
+                || ( fwrite( t->Col[n].K, sizeof( double ), nNodes, fp ) != nNodes )
+                || ( fwrite( t->Col[n].Lstar, sizeof( double ), nNodes, fp ) != nNodes ) ) Ok = FALSE;
+    }
+
+    if ( ( fclose( fp ) != 0 ) || !Ok ) {
+        printf("Lgm_WriteLstarTable: Error writing %s\n", Filename );
+        return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Load an L* table saved with Lgm_WriteLstarTable().
+ *
+ *      \return The table, or NULL if the file cant be read (or was written on a machine with a different byte order).
+ *
+ */
+Lgm_LstarTable *Lgm_ReadLstarTable( const char *Filename ) {
+
+    int                     n, Ok = TRUE;
+    int32_t                 nNodes;
+    FILE                    *fp;
+    Lgm_LstarTableHeader    h;
+    Lgm_LstarTable          *t;
+    Lgm_LstarTableColumn    *c;
+
+    if ( (fp = fopen( Filename, "rb" )) == NULL ) {
+        printf("Lgm_ReadLstarTable: Could not open %s\n", Filename );
+        return( NULL );
+    }
+
+    if ( ( fread( &h, sizeof( h ), 1, fp ) != 1 ) || memcmp( h.Magic, LGM_LSTARTABLE_MAGIC, 8 ) || ( h.Version != LGM_LSTARTABLE_VERSION ) || ( h.ByteOrder != 1.0 ) ) {
+        printf("Lgm_ReadLstarTable: %s is not an L* table (or is from an incompatible version or machine)\n", Filename );
+        fclose( fp );
+        return( NULL );
+    }
+
+    if ( (t = Lgm_InitLstarTable( h.nMLT, h.nBm, h.Bm0, h.Bm1, h.nR, h.R0, h.R1 )) == NULL ) {
+        fclose( fp );
+        return( NULL );
+    }
+    t->h = h;
+
+    for ( n=0; Ok && ( n<h.nMLT*h.nBm ); n++ ) {
+        c = &t->Col[n];
+        if ( ( fread( &nNodes, sizeof( nNodes ), 1, fp ) != 1 ) || ( nNodes < 0 ) ) { Ok = FALSE; break; }
+        if ( nNodes > c->nAlloced ) Lgm_LstarTable_AllocColumn( c, nNodes );
+        c->n = nNodes;
+        if ( ( fread( c->R, sizeof( double ), nNodes, fp ) != nNodes )
+                || ( fread( c->K, sizeof( double ), nNodes, fp ) != nNodes )
+                || ( fread( c->Lstar, sizeof( double ), nNodes, fp ) != nNodes ) ) Ok = FALSE;
+        else Lgm_LstarTable_PrepareColumn( c );
+    }
+    fclose( fp );
+
+    if ( !Ok ) {
+        printf("Lgm_ReadLstarTable: %s is truncated\n", Filename );
+        Lgm_FreeLstarTable( t );
+        return( NULL );
+    }
+
+    return( t );
+
+}
@@ -0,0 +1,400 @@
+/*! \file Lgm_LstarTuner.c
+ *
+ *  \brief Find the cheapest L* tolerances that meet an L* error budget.
+ *
+ *  \details
+ *      Lgm_SetLstarTolerances() maps a Quality of 0-8 onto a fixed set of
+ *      tolerances. Those arent tied to any stated L* accuracy, so in practice
+ *      people pick a high Quality to be safe and pay for it.
+ *      Lgm_TuneLstarTolerances() instead takes a target L* error and a
+ *      calibration set (positions and pitch angles, in the model and at the
+ *      time already set in LstarInfo) and looks for the cheapest settings
+ *      that keep L* within the target of the Quality 8 values on every point
+ *      of the set.
+ *
+ *      Each of the tolerances (the field line step tolerance, the I tolerance
+ *      of the shell line search, the I and flux integrator tolerances and
+ *      integrator, nDivs and the number of lines in the drift shell) has a
+ *      ladder of settings from the Quality 8 one to something looser than
+ *      Quality 0. Starting with all of them at Quality 8, each step tries
+ *      loosening each tolerance by one rung and takes the one that is
+ *      cheapest while still meeting the target. It stops when none of them
+ *      can be loosened any more. Loosening a tolerance only makes the errors
+ *      bigger, so a tolerance that couldnt be loosened isnt tried again.
+ *      The cost is the number of field evaluations, so it doesnt depend on
+ *      what else the machine is doing.
+ *
+ *      The result is a named Lgm_LstarTolProfile. It can be written out
+ *      (Lgm_WriteLstarTolProfile()) and read back in production
+ *      (Lgm_ReadLstarTolProfile()). Setting LstarInfo->TolProfile to point at
+ *      it makes Lgm_SetLstarTolerances() (and so Lgm_ComputeLstarVersusPA())
+ *      use it instead of the Quality table.
+ *
+ *      The budget only holds for positions and pitch angles like the ones in
+ *      the calibration set, so the set should cover the range the profile is
+ *      going to be used for. Tuning costs a few tens of L* calculations per
+ *      calibration point.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_LstarInfo.h"
+
+#define LGM_TUNE_NKNOBS         7
+#define LGM_TUNE_TRACE_TOL      1e-7
+
+/*
+ *  The ladders. The first rung of each is what Quality 8 uses.
+ */
+static double TuneAtol[]    = { 1e-7, 1e-6, 1e-5, 1e-4, 1e-3 };
+static double TuneShellI[]  = { 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 5e-3, 1e-2, 1e-1 };
+static double TuneIeps[]    = { 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 1e-2 };
+static double TuneFluxEps[] = { 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 5e-4, 1e-3 };
+static double TunenDivs[]   = { 500, 400, 300, 200, 100, 50 };
+static double TuneInteg[]   = { DQAGS, DQK21 };
+static double TunenFLs[]    = { 240, 192, 144, 120, 96, 72, 48, 36, 24, 18, 12, 8 };
+
+static char *KnobNames[LGM_TUNE_NKNOBS] = { "MagStep_atol", "FindShellLine_I_Tol", "I_eps", "MagFlux_eps", "nDivs", "I_Integrator", "nFLsInDriftShell" };
+
+
+/**
+ *  Set the tolerances in p (and nFLsInDriftShell) in LstarInfo.
+ */
+void Lgm_ApplyLstarTolProfile( Lgm_LstarTolProfile *p, Lgm_LstarInfo *s ) {
+
+    s->nFLsInDriftShell = p->nFLsInDriftShell;
+
+    s->mInfo->Lgm_MagFlux_Integrator_epsabs        = p->MagFlux_eps;
+    s->mInfo->Lgm_MagFlux_Integrator_epsrel        = p->MagFlux_eps;
+    s->mInfo->Lgm_LambdaIntegral_Integrator_epsabs = p->MagFlux_eps;
+    s->mInfo->Lgm_LambdaIntegral_Integrator_epsrel = p->MagFlux_eps;
+
+    s->mInfo->Lgm_I_Integrator        = p->I_Integrator;
+    s->mInfo->Lgm_I_Integrator_epsrel = p->I_eps;
+    s->mInfo->Lgm_I_Integrator_epsabs = p->I_eps;
+
+    s->mInfo->Lgm_FindShellLine_I_Tol = p->FindShellLine_I_Tol;
+    s->mInfo->nDivs                   = p->nDivs;
+
+    s->mInfo->Lgm_MagStep_BS_atol  = p->MagStep_atol;
+    s->mInfo->Lgm_MagStep_BS_rtol  = 0.0;
+    s->mInfo->Lgm_MagStep_DP8_atol = p->MagStep_atol;
+    s->mInfo->Lgm_MagStep_DP8_rtol = 0.0;
+
+}
+
+/*
+ *  Rung i of ladder k.
+ */
+static double Lgm_LstarTuner_Rung( int k, int i, double *nFLs ) {
+
+    switch ( k ) {
+        case 0:  return( TuneAtol[i] );
+        case 1:  return( TuneShellI[i] );
+        case 2:  return( TuneIeps[i] );
+        case 3:  return( TuneFluxEps[i] );
+        case 4:  return( TunenDivs[i] );
+        case 5:  return( TuneInteg[i] );
+        default: return( nFLs[i] );
+    }
+
+}
+
+/*
+ *  The profile for rungs Idx[] of the ladders.
+ */
+static void Lgm_LstarTuner_Profile( int *Idx, double *nFLs, Lgm_LstarTolProfile *p ) {
+
+    p->MagStep_atol        = Lgm_LstarTuner_Rung( 0, Idx[0], nFLs );
+    p->FindShellLine_I_Tol = Lgm_LstarTuner_Rung( 1, Idx[1], nFLs );
+    p->I_eps               = Lgm_LstarTuner_Rung( 2, Idx[2], nFLs );
+    p->MagFlux_eps         = Lgm_LstarTuner_Rung( 3, Idx[3], nFLs );
+    p->nDivs               = (int)Lgm_LstarTuner_Rung( 4, Idx[4], nFLs );
+    p->I_Integrator        = (int)Lgm_LstarTuner_Rung( 5, Idx[5], nFLs );
+    p->nFLsInDriftShell    = (int)Lgm_LstarTuner_Rung( 6, Idx[6], nFLs );
+
+}
+
+/*
+ *  L* for each of the calibration points with the settings in p. *Cost is
+ *  the number of field evaluations per L* and *MaxErr the largest
+ *  difference from Lref (if Lref isnt NULL). Points whose L* couldnt be
+ *  found count as an infinite error (or get LGM_FILL_VALUE when there is no
+ *  Lref).
+ */
+static void Lgm_LstarTuner_Eval( Lgm_LstarTolProfile *p, int n, Lgm_Vector *v3, double *Bm, double *PA, double *Lref, double *L,
+                                 double *MaxErr, double *Cost, Lgm_LstarInfo *LstarInfo ) {
+
+    Lgm_LstarInfo   *t;
+    long int        n0, nEvals = 0;
+    int             i, nDone = 0;
+
+    *MaxErr = 0.0;
+    for ( i=0; i<n; i++ ) {
+
+        L[i] = LGM_FILL_VALUE;
+        if ( ( Bm[i] <= 0.0 ) || ( ( Lref != NULL ) && ( Lref[i] == LGM_FILL_VALUE ) ) ) continue;
+
+        /*
+         *  A clean copy, without any of the caches (they would carry results
+         *  from one setting over to the next) or the time budgets.
+         */
+        t = Lgm_CopyLstarInfo( LstarInfo );
+        t->FieldLineCache = NULL; t->UseFieldLineCache = FALSE;
+        t->BmRadiusCache  = NULL; t->UseBmRadiusCache  = FALSE;
+        t->MinBMap        = NULL;
+        t->ShellHistory   = NULL;
+        t->NestedShell    = NULL;
+        t->FluxMap        = NULL;
+        t->MaxLstarTime   = 0.0;
+        t->MaxLstarMagEvals = 0;
+        t->VerbosityLevel = 0;
+        Lgm_ApplyLstarTolProfile( p, t );
+        t->mInfo->Bm   = Bm[i];
+        t->PitchAngle  = PA[i];
+
+        n0 = LGM_NMAGEVALS_TOTAL( t->mInfo );
+        if ( Lstar( &v3[i], t ) >= 0 ) L[i] = t->LS;
+        nEvals += LGM_NMAGEVALS_TOTAL( t->mInfo ) - n0;
+        ++nDone;
+
+        if ( Lref != NULL ) {
+            if ( L[i] == LGM_FILL_VALUE ) {
+                *MaxErr = HUGE_VAL;
+            } else if ( fabs( L[i] - Lref[i] ) > *MaxErr ) {
+                *MaxErr = fabs( L[i] - Lref[i] );
+            }
+        }
+
+        FreeLstarInfo( t );
+
+    }
+
+    *Cost = ( nDone > 0 ) ? (double)nEvals/(double)nDone : 0.0;
+
+}
+
+
+/**
+ *  \brief
+ *      Find the cheapest L* tolerances that keep L* within TargetError of
+ *      the Quality 8 values on a calibration set.
+ *
+ *  \details
+ *      See the notes at the top of the file. The model, its inputs and the
+ *      time have to be set in LstarInfo->mInfo already. The reference uses
+ *      LstarInfo->nFLsInDriftShell lines (that is also the most any profile
+ *      uses). Points that arent on closed lines, or whose reference L*
+ *      cant be found, are left out.
+ *
+ *      \param[in]      TargetError     Largest allowed L* error.
+ *      \param[in]      n               Number of calibration points.
+ *      \param[in]      u               Calibration positions (GSM, Re).
+ *      \param[in]      Alpha           Local pitch angles (degrees) at u.
+ *      \param[in]      Name            Name for the profile.
+ *      \param[in]      LstarInfo       Settings to tune (not changed).
+ *      \param[out]     p               The profile.
+ *
+ *      \return         TRUE if the target was met. FALSE if it couldnt be
+ *                      (then p is the Quality 8 settings) or none of the
+ *                      points could be used.
+ */
+int Lgm_TuneLstarTolerances( double TargetError, int n, Lgm_Vector *u, double *Alpha, char *Name, Lgm_LstarInfo *LstarInfo, Lgm_LstarTolProfile *p ) {
+
+    Lgm_MagModelInfo    *m = LstarInfo->mInfo;
+    Lgm_LstarTolProfile Try;
+    Lgm_Vector          v1, v2, Bvec, *v3;
+    double              *Bm, *PA, *Lref, *L, nFLs[ sizeof(TunenFLs)/sizeof(double) + 1 ];
+    double              Err, Cost, BestErr, BestCost, sa;
+    int                 i, k, Best, nUsed, Idx[LGM_TUNE_NKNOBS], Len[LGM_TUNE_NKNOBS], Frozen[LGM_TUNE_NKNOBS];
+
+    memset( p, 0, sizeof(*p) );
+    snprintf( p->Name, sizeof(p->Name), "%s", ( Name != NULL ) ? Name : "Tuned" );
+    p->TargetError = TargetError;
+    if ( n < 1 ) return( FALSE );
+
+    /*
+     *  The nFLsInDriftShell ladder starts at the reference number.
+     */
+    nFLs[0] = ( LstarInfo->nFLsInDriftShell > 0 ) ? LstarInfo->nFLsInDriftShell : 24;
+    for ( Len[6]=1, i=0; i<(int)(sizeof(TunenFLs)/sizeof(double)); i++ ) if ( TunenFLs[i] < nFLs[0] ) nFLs[ Len[6]++ ] = TunenFLs[i];
+    Len[0] = sizeof(TuneAtol)/sizeof(double);
+    Len[1] = sizeof(TuneShellI)/sizeof(double);
+    Len[2] = sizeof(TuneIeps)/sizeof(double);
+    Len[3] = sizeof(TuneFluxEps)/sizeof(double);
+    Len[4] = sizeof(TunenDivs)/sizeof(double);
+    Len[5] = sizeof(TuneInteg)/sizeof(double);
+
+    LGM_ARRAY_1D( v3,   n, Lgm_Vector );
+    LGM_ARRAY_1D( Bm,   n, double );
+    LGM_ARRAY_1D( PA,   n, double );
+    LGM_ARRAY_1D( Lref, n, double );
+    LGM_ARRAY_1D( L,    n, double );
+
+    /*
+     *  Min-B points and mirror fields of the calibration points (these dont
+     *  depend on the tolerances being tuned).
+     */
+    for ( i=0; i<n; i++ ) {
+        Bm[i] = -1.0;
+        sa = sin( Alpha[i]*RadPerDeg );
+        if ( sa*sa < 1e-12 ) continue;
+        if ( Lgm_Trace( &u[i], &v1, &v2, &v3[i], m->Lgm_LossConeHeight, LGM_TUNE_TRACE_TOL, LGM_TUNE_TRACE_TOL, m ) != LGM_CLOSED ) continue;
+        m->Bfield( &u[i], &Bvec, m );
+        Bm[i] = Lgm_Magnitude( &Bvec )/( sa*sa );
+        if ( m->Bmin >= Bm[i] ) { Bm[i] = -1.0; continue; }
+        PA[i] = DegPerRad*asin( sqrt( m->Bmin/Bm[i] ) );   // equatorial pitch angle
+    }
+
+    /*
+     *  Reference (Quality 8) L*'s.
+     */
+    for ( k=0; k<LGM_TUNE_NKNOBS; k++ ) Idx[k] = Frozen[k] = 0;
+    Lgm_LstarTuner_Profile( Idx, nFLs, &Try );
+    Lgm_LstarTuner_Eval( &Try, n, v3, Bm, PA, NULL, Lref, &Err, &Cost, LstarInfo );
+    for ( nUsed=0, i=0; i<n; i++ ) if ( Lref[i] != LGM_FILL_VALUE ) ++nUsed;
+    Lgm_LstarTuner_Profile( Idx, nFLs, p );
+    p->RefCost = p->Cost = Cost;
+    p->MaxError = 0.0;
+    if ( LstarInfo->VerbosityLevel > 0 ) {
+        printf("%sLgm_TuneLstarTolerances: %d of %d calibration points usable. Reference cost: %g evals/L*%s\n", LstarInfo->PreStr, nUsed, n, Cost, LstarInfo->PostStr );
+    }
+
+    if ( nUsed > 0 ) {
+
+        while ( 1 ) {
+
+            Best = -1; BestCost = p->Cost; BestErr = 0.0;
+            for ( k=0; k<LGM_TUNE_NKNOBS; k++ ) {
+                if ( Frozen[k] || ( Idx[k]+1 >= Len[k] ) ) continue;
+                ++Idx[k];
+                Lgm_LstarTuner_Profile( Idx, nFLs, &Try );
+                Lgm_LstarTuner_Eval( &Try, n, v3, Bm, PA, Lref, L, &Err, &Cost, LstarInfo );
+                --Idx[k];
+                if ( LstarInfo->VerbosityLevel > 1 ) {
+                    printf("%s\tLgm_TuneLstarTolerances: %s -> %g: max error = %g, cost = %g%s\n", LstarInfo->PreStr, KnobNames[k],
+                            Lgm_LstarTuner_Rung( k, Idx[k]+1, nFLs ), Err, Cost, LstarInfo->PostStr );
+                }
+                if ( Err > TargetError ) {
+                    Frozen[k] = TRUE;
+                } else if ( Cost <= BestCost ) {
+                    Best = k; BestCost = Cost; BestErr = Err;
+                }
+            }
+            if ( Best < 0 ) break;
+
+            ++Idx[Best];
+            Lgm_LstarTuner_Profile( Idx, nFLs, p );
+            p->Cost     = BestCost;
+            p->MaxError = BestErr;
+            if ( LstarInfo->VerbosityLevel > 0 ) {
+                printf("%sLgm_TuneLstarTolerances: loosened %s. Max error = %g, cost = %g evals/L*%s\n", LstarInfo->PreStr, KnobNames[Best], BestErr, BestCost, LstarInfo->PostStr );
+            }
+
+        }
+
+    }
+
+    LGM_ARRAY_1D_FREE( v3 );
+    LGM_ARRAY_1D_FREE( Bm );
+    LGM_ARRAY_1D_FREE( PA );
+    LGM_ARRAY_1D_FREE( Lref );
+    LGM_ARRAY_1D_FREE( L );
+
+    return( ( nUsed > 0 ) && ( p->MaxError <= TargetError ) );
+
+}
+
+
+/**
+ *  Write a profile as "Key = Value" lines.
+ *
+ *      \return         FALSE if the file couldnt be written.
+ */
+int Lgm_WriteLstarTolProfile( char *Filename, Lgm_LstarTolProfile *p ) {
+
+    FILE    *fp;
+
+    if ( (fp = fopen( Filename, "w" )) == NULL ) return( FALSE );
+
+    fprintf( fp, "# L* tolerance profile (see Lgm_LstarTuner.c)\n" );
+    fprintf( fp, "Name                = %s\n",    p->Name );
+    fprintf( fp, "TargetError         = %.17g\n", p->TargetError );
+    fprintf( fp, "MaxError            = %.17g\n", p->MaxError );
+    fprintf( fp, "Cost                = %.17g\n", p->Cost );
+    fprintf( fp, "RefCost             = %.17g\n", p->RefCost );
+    fprintf( fp, "nFLsInDriftShell    = %d\n",    p->nFLsInDriftShell );
+    fprintf( fp, "nDivs               = %d\n",    p->nDivs );
+    fprintf( fp, "I_Integrator        = %d\n",    p->I_Integrator );
+    fprintf( fp, "I_eps               = %.17g\n", p->I_eps );
+    fprintf( fp, "MagFlux_eps         = %.17g\n", p->MagFlux_eps );
+    fprintf( fp, "FindShellLine_I_Tol = %.17g\n", p->FindShellLine_I_Tol );
+    fprintf( fp, "MagStep_atol        = %.17g\n", p->MagStep_atol );
+
+    return( ( fclose( fp ) == 0 ) ? TRUE : FALSE );
+
+}
+
+
+/**
+ *  Read a profile written by Lgm_WriteLstarTolProfile().
+ *
+ *      \return         FALSE if the file couldnt be read, or any of the
+ *                      tolerances were missing.
+ */
+int Lgm_ReadLstarTolProfile( char *Filename, Lgm_LstarTolProfile *p ) {
+
+    FILE    *fp;
+    char    Line[256], Key[64], Val[128];
+    int     nSet = 0;
+
+    if ( (fp = fopen( Filename, "r" )) == NULL ) return( FALSE );
+
+    memset( p, 0, sizeof(*p) );
+    while ( fgets( Line, sizeof(Line), fp ) != NULL ) {
+        if ( ( Line[0] == '#' ) || ( sscanf( Line, "%63s = %127s", Key, Val ) != 2 ) ) continue;
+        if      ( !strcmp( Key, "Name" ) )                { snprintf( p->Name, sizeof(p->Name), "%.63s", Val ); }
+        else if ( !strcmp( Key, "TargetError" ) )         { p->TargetError = atof( Val ); }
+        else if ( !strcmp( Key, "MaxError" ) )            { p->MaxError = atof( Val ); }
+        else if ( !strcmp( Key, "Cost" ) )                { p->Cost = atof( Val ); }
+        else if ( !strcmp( Key, "RefCost" ) )             { p->RefCost = atof( Val ); }
+        else if ( !strcmp( Key, "nFLsInDriftShell" ) )    { p->nFLsInDriftShell = atoi( Val ); ++nSet; }
+        else if ( !strcmp( Key, "nDivs" ) )               { p->nDivs = atoi( Val ); ++nSet; }
+        else if ( !strcmp( Key, "I_Integrator" ) )        { p->I_Integrator = atoi( Val ); ++nSet; }
+        else if ( !strcmp( Key, "I_eps" ) )               { p->I_eps = atof( Val ); ++nSet; }
+        else if ( !strcmp( Key, "MagFlux_eps" ) )         { p->MagFlux_eps = atof( Val ); ++nSet; }
+        else if ( !strcmp( Key, "FindShellLine_I_Tol" ) ) { p->FindShellLine_I_Tol = atof( Val ); ++nSet; }
+        else if ( !strcmp( Key, "MagStep_atol" ) )        { p->MagStep_atol = atof( Val ); ++nSet; }
+    }
+    fclose( fp );
+
+    return( ( nSet == 7 ) ? TRUE : FALSE );
+
+}
+
+
+/**
+ *  Fold the tolerances of p (if it isnt NULL) into the cache key h, so that
+ *  results made with different profiles dont get mixed up.
+ */
+unsigned long Lgm_LstarTolProfile_Hash( unsigned long h, Lgm_LstarTolProfile *p ) {
+
+    Lgm_ModelKey    k = { h, 0 };
+
+    if ( p == NULL ) return( h );
+
+    Lgm_ModelKey_Add( &k, &p->nFLsInDriftShell, sizeof(p->nFLsInDriftShell) );
+    Lgm_ModelKey_Add( &k, &p->nDivs, sizeof(p->nDivs) );
+    Lgm_ModelKey_Add( &k, &p->I_Integrator, sizeof(p->I_Integrator) );
+    Lgm_ModelKey_AddDouble( &k, p->I_eps );
+    Lgm_ModelKey_AddDouble( &k, p->MagFlux_eps );
+    Lgm_ModelKey_AddDouble( &k, p->FindShellLine_I_Tol );
+    Lgm_ModelKey_AddDouble( &k, p->MagStep_atol );
+
+    return( k.Lo );
+
+}
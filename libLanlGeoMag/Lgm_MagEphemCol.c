@@ -0,0 +1,661 @@
+/*! \file Lgm_MagEphemCol.c
+ *
+ *  \brief Writer and memory-mapped reader for columnar binary MagEphem files.
+ *
+ *  The layout is described in Lgm/Lgm_MagEphemCol.h. The writer has the
+ *  same shape as the HDF5 one (Lgm_WriteMagEphemHeaderHdf(),
+ *  Lgm_WriteMagEphemDataHdf(), Lgm_FlushMagEphemDataHdf()): rows are taken
+ *  from the H5_* arrays of a Lgm_MagEphemData and written a block at a time.
+ *  Because the number of rows (MaxRows) is fixed when the file is made,
+ *  every column can be given its final place up front and each block is a
+ *  single pwrite() per column. Unwritten rows are holes in the file.
+ *
+ *  The reader maps the file and hands out pointers into the mapping, so
+ *  opening a file costs a few system calls no matter how big it is and
+ *  only the columns actually touched are read from disk.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include "Lgm/Lgm_MagEphemCol.h"
+#include "Lgm/Lgm_Metadata.h"
+
+
+/*
+ *  The per-time members of Lgm_MagEphemData that go in the file, in the
+ *  order (and with the names and units) of the HDF5 files. Width is the
+ *  number of elements per row in the file and Stride the number per row in
+ *  memory; 0 means the number of pitch angles (m->nAlpha in the file,
+ *  med->H5_nPA in memory). Rank2 members are type ** arrays (one block of
+ *  memory, see LGM_ARRAY_2D), the others are type *.
+ */
+typedef struct MEC_Spec {
+    char        *Name;
+    char        Type;
+    int         Rank2;
+    int         Width;
+    int         Stride;
+    size_t      Offset;
+    char        *Units;
+} MEC_Spec;
+
+#define MEC_1D( Name, Type, Member, Units )                  { Name, Type, 0, 1, 1, offsetof( Lgm_MagEphemData, Member ), Units }
+#define MEC_2D( Name, Type, Member, Width, Stride, Units )   { Name, Type, 1, Width, Stride, offsetof( Lgm_MagEphemData, Member ), Units }
+
+static MEC_Spec MEC_Specs[] = {
+    MEC_2D( "IsoTime",           's', H5_IsoTimes,           32, 80, "UTC"            ),
+    MEC_2D( "FieldLineType",     's', H5_FieldLineType,      32, 80, ""               ),
+    MEC_2D( "IntModel",          's', H5_IntModel,           32, 80, ""               ),
+    MEC_2D( "ExtModel",          's', H5_ExtModel,           32, 80, ""               ),
+    MEC_1D( "Date",              'l', H5_Date,               "YYYYMMDD"               ),
+    MEC_1D( "Doy",               'i', H5_Doy,                "DDD"                    ),
+    MEC_1D( "UTC",               'd', H5_UTC,                "Hours"                  ),
+    MEC_1D( "JulianDate",        'd', H5_JD,                 "Days"                   ),
+    MEC_1D( "GpsTime",           'd', H5_GpsTime,            "Seconds"                ),
+    MEC_1D( "DipoleTiltAngle",   'd', H5_TiltAngle,          "Degrees"                ),
+    MEC_1D( "InOut",             'i', H5_InOut,              "dimless"                ),
+    MEC_1D( "OrbitNumber",       'i', H5_OrbitNumber,        "dimless"                ),
+    MEC_1D( "Interpolated",      'i', H5_Interpolated,       "dimless"                ),
+    MEC_2D( "Rgsm",              'd', H5_Rgsm,                3,  3, "Re"               ),
+    MEC_2D( "Rgeo",              'd', H5_Rgeo,                3,  3, "Re"               ),
+    MEC_2D( "Rsm",               'd', H5_Rsm,                 3,  3, "Re"               ),
+    MEC_2D( "Rgei",              'd', H5_Rgei,                3,  3, "Re"               ),
+    MEC_2D( "Rgse",              'd', H5_Rgse,                3,  3, "Re"               ),
+    MEC_2D( "Rgeod_LatLon",      'd', H5_Rgeod_LatLon,        2,  2, "Deg."             ),
+    MEC_1D( "Rgeod_Height",      'd', H5_Rgeod_Height,       "km"                     ),
+    MEC_1D( "CDMAG_MLAT",        'd', H5_CDMAG_MLAT,         "Deg."                   ),
+    MEC_1D( "CDMAG_MLON",        'd', H5_CDMAG_MLON,         "Deg."                   ),
+    MEC_1D( "CDMAG_MLT",         'd', H5_CDMAG_MLT,          "Deg."                   ),
+    MEC_1D( "CDMAG_R",           'd', H5_CDMAG_R,            "Deg."                   ),
+    MEC_1D( "EDMAG_MLAT",        'd', H5_EDMAG_MLAT,         "Deg."                   ),
+    MEC_1D( "EDMAG_MLON",        'd', H5_EDMAG_MLON,         "Deg."                   ),
+    MEC_1D( "EDMAG_MLT",         'd', H5_EDMAG_MLT,          "Deg."                   ),
+    MEC_1D( "EDMAG_R",           'd', H5_EDMAG_R,            "Deg."                   ),
+    MEC_1D( "Kp",                'd', H5_Kp,                 "Dimensionless"          ),
+    MEC_1D( "Dst",               'd', H5_Dst,                "nT"                     ),
+    MEC_2D( "Bsc_gsm",           'd', H5_Bsc_gsm,             4,  4, "nT"               ),
+    MEC_1D( "S_sc_to_pfn",       'd', H5_S_sc_to_pfn,        "Re"                     ),
+    MEC_1D( "S_sc_to_pfs",       'd', H5_S_sc_to_pfs,        "Re"                     ),
+    MEC_1D( "S_pfs_to_Bmin",     'd', H5_S_pfs_to_Bmin,      "Re"                     ),
+    MEC_1D( "S_Bmin_to_sc",      'd', H5_S_Bmin_to_sc,       "Re"                     ),
+    MEC_1D( "S_total",           'd', H5_S_total,            "Re"                     ),
+    MEC_1D( "d2B_ds2",           'd', H5_d2B_ds2,            "nT^2/Re^2"              ),
+    MEC_1D( "Sb0",               'd', H5_Sb0,                "Re"                     ),
+    MEC_1D( "RadiusOfCurv",      'd', H5_RadiusOfCurv,       "Re"                     ),
+    MEC_2D( "Pfn_geo",           'd', H5_Pfn_geo,             3,  3, "Re"               ),
+    MEC_2D( "Pfn_gsm",           'd', H5_Pfn_gsm,             3,  3, "Re"               ),
+    MEC_2D( "Pfn_geod_LatLon",   'd', H5_Pfn_geod_LatLon,     2,  2, "Deg."             ),
+    MEC_1D( "Pfn_geod_Height",   'd', H5_Pfn_geod_Height,    "km"                     ),
+    MEC_1D( "Pfn_CD_MLAT",       'd', H5_Pfn_CD_MLAT,        "Deg."                   ),
+    MEC_1D( "Pfn_CD_MLON",       'd', H5_Pfn_CD_MLON,        "Deg."                   ),
+    MEC_1D( "Pfn_CD_MLT",        'd', H5_Pfn_CD_MLT,         "Hours"                  ),
+    MEC_1D( "Pfn_ED_MLAT",       'd', H5_Pfn_ED_MLAT,        "Deg."                   ),
+    MEC_1D( "Pfn_ED_MLON",       'd', H5_Pfn_ED_MLON,        "Deg."                   ),
+    MEC_1D( "Pfn_ED_MLT",        'd', H5_Pfn_ED_MLT,         "Hours"                  ),
+    MEC_2D( "Bfn_geo",           'd', H5_Bfn_geo,             4,  4, "nT"               ),
+    MEC_2D( "Bfn_gsm",           'd', H5_Bfn_gsm,             4,  4, "nT"               ),
+    MEC_1D( "Loss_Cone_Alpha_n", 'd', H5_LossConeAngleN,     "Deg."                   ),
+    MEC_2D( "Pfs_geo",           'd', H5_Pfs_geo,             3,  3, "Re"               ),
+    MEC_2D( "Pfs_gsm",           'd', H5_Pfs_gsm,             3,  3, "Re"               ),
+    MEC_2D( "Pfs_geod_LatLon",   'd', H5_Pfs_geod_LatLon,     2,  2, "Deg."             ),
+    MEC_1D( "Pfs_geod_Height",   'd', H5_Pfs_geod_Height,    "km"                     ),
+    MEC_1D( "Pfs_CD_MLAT",       'd', H5_Pfs_CD_MLAT,        "Deg."                   ),
+    MEC_1D( "Pfs_CD_MLON",       'd', H5_Pfs_CD_MLON,        "Deg."                   ),
+    MEC_1D( "Pfs_CD_MLT",        'd', H5_Pfs_CD_MLT,         "Hours"                  ),
+    MEC_1D( "Pfs_ED_MLAT",       'd', H5_Pfs_ED_MLAT,        "Deg."                   ),
+    MEC_1D( "Pfs_ED_MLON",       'd', H5_Pfs_ED_MLON,        "Deg."                   ),
+    MEC_1D( "Pfs_ED_MLT",        'd', H5_Pfs_ED_MLT,         "Hours"                  ),
+    MEC_2D( "Bfs_geo",           'd', H5_Bfs_geo,             4,  4, "nT"               ),
+    MEC_2D( "Bfs_gsm",           'd', H5_Bfs_gsm,             4,  4, "nT"               ),
+    MEC_1D( "Loss_Cone_Alpha_s", 'd', H5_LossConeAngleS,     "Deg."                   ),
+    MEC_2D( "Pmin_gsm",          'd', H5_Pmin_gsm,            3,  3, "Re"               ),
+    MEC_2D( "Bmin_gsm",          'd', H5_Bmin_gsm,            4,  4, "Re"               ),
+    MEC_1D( "Lsimple",           'd', H5_Lsimple,            "Dimless"                ),
+    MEC_1D( "InvLat",            'd', H5_InvLat,             "Deg."                   ),
+    MEC_1D( "Lm_eq",             'd', H5_Lm_eq,              "Dimless"                ),
+    MEC_1D( "InvLat_eq",         'd', H5_InvLat_eq,          "Deg."                   ),
+    MEC_1D( "BoverBeq",          'd', H5_BoverBeq,           "Dimless"                ),
+    MEC_1D( "MlatFromBoverBeq",  'd', H5_MlatFromBoverBeq,   "Deg."                   ),
+    MEC_1D( "M_used",            'd', H5_M_used,             "nT"                     ),
+    MEC_1D( "M_ref",             'd', H5_M_ref,              "nT"                     ),
+    MEC_1D( "M_igrf",            'd', H5_M_igrf,             "nT"                     ),
+    MEC_2D( "Lstar",             'd', H5_Lstar,               0,  0, ""                 ),
+    MEC_2D( "Sb",                'd', H5_Sb,                  0,  0, "Re"               ),
+    MEC_2D( "Tb",                'd', H5_Tb,                  0,  0, "s"                ),
+    MEC_2D( "Kappa",             'd', H5_Kappa,               0,  0, "dimlesss"         ),
+    MEC_2D( "DriftShellType",    'i', H5_DriftShellType,      0,  0, "dimlesss"         ),
+    MEC_2D( "L",                 'd', H5_L,                   0,  0, "Dimensionless"    ),
+    MEC_2D( "Bm",                'd', H5_Bm,                  0,  0, "nT"               ),
+    MEC_2D( "I",                 'd', H5_I,                   0,  0, "Re"               ),
+    MEC_2D( "K",                 'd', H5_K,                   0,  0, "Re G^.5"          )
+};
+#define MEC_NSPECS  ( (int)(sizeof(MEC_Specs)/sizeof(MEC_Spec)) )
+
+
+/*
+ *  Size of an element in the file and in memory.
+ */
+static uint32_t MEC_FileElemBytes( char Type ) {
+    switch ( Type ) {
+        case 'd': return( 8 );
+        case 'i': return( 4 );
+        case 'l': return( 8 );
+        default:  return( 1 );
+    }
+}
+
+static size_t MEC_MemElemBytes( char Type ) {
+    switch ( Type ) {
+        case 'd': return( sizeof(double) );
+        case 'i': return( sizeof(int) );
+        case 'l': return( sizeof(long int) );
+        default:  return( 1 );
+    }
+}
+
+static uint64_t MEC_Align( uint64_t n ) {
+    return( ( n + LGM_MEC_ALIGN - 1 )/LGM_MEC_ALIGN*LGM_MEC_ALIGN );
+}
+
+/*
+ *  pwrite() all of it (pwrite() may write less than asked for).
+ */
+static int MEC_PWrite( int fd, const void *buf, size_t n, uint64_t Offset ) {
+    const char  *p = (const char *)buf;
+    ssize_t     k;
+    while ( n > 0 ) {
+        if ( (k = pwrite( fd, p, n, (off_t)Offset )) <= 0 ) return( FALSE );
+        p += k; n -= (size_t)k; Offset += (uint64_t)k;
+    }
+    return( TRUE );
+}
+
+/*
+ *  Copy a string into the schema with the characters that would break the
+ *  JSON (Lgm_metadata_* does no escaping) replaced.
+ */
+static void MEC_SafeString( char *Dst, const char *Src, size_t n ) {
+    size_t  i;
+    for ( i=0; (i<n-1) && Src && Src[i]; i++ ) {
+        Dst[i] = ( Src[i] == '"' ) ? '\'' : ( Src[i] == '\\' ) ? '/' : ( (unsigned char)Src[i] < ' ' ) ? ' ' : Src[i];
+    }
+    Dst[i] = '\0';
+}
+
+/*
+ *  Build the JSON schema. Returns a malloc'd string.
+ */
+static char *MEC_Schema( Lgm_MagEphemColWriter *w, const char *CodeVersion, const char *ExtModel, int SpiceBody, const char *Spacecraft, int IdNumber, const char *IntDesig, const char *CmdLine, Lgm_MagEphemInfo *m, Lgm_MagEphemData *med ) {
+
+    int                     j, k, n;
+    char                    Str[4096], **Times;
+    char                    *Schema;
+    Lgm_metadata_variable   *v, **vp;
+
+    n  = w->Header.nColumns + 5;
+    v  = (Lgm_metadata_variable *)calloc( n, sizeof(Lgm_metadata_variable) );
+    vp = (Lgm_metadata_variable **)calloc( n, sizeof(Lgm_metadata_variable *) );
+    for ( j=0; j<n; j++ ) vp[j] = &v[j];
+
+    k = 0;
+    Lgm_metadata_initvar( &v[k], 1, 0, "MagEphem" );
+    MEC_SafeString( Str, CodeVersion, 4096 ); Lgm_metadata_addStringAttr( &v[k], "CODE_VERSION", Str, 0 );
+    MEC_SafeString( Str, Spacecraft,  4096 ); Lgm_metadata_addStringAttr( &v[k], "SPACECRAFT", Str, 0 );
+    Lgm_metadata_addIntAttr( &v[k], "ID_NUMBER", 1, &IdNumber );
+    MEC_SafeString( Str, IntDesig,    4096 ); Lgm_metadata_addStringAttr( &v[k], "INT_DESIG", Str, 0 );
+    Lgm_metadata_addIntAttr( &v[k], "SPICE_BODY", 1, &SpiceBody );
+    MEC_SafeString( Str, ExtModel,    4096 ); Lgm_metadata_addStringAttr( &v[k], "EXT_MODEL", Str, 0 );
+    MEC_SafeString( Str, CmdLine,     4096 ); Lgm_metadata_addStringAttr( &v[k], "COMMAND_LINE", Str, 0 );
+    ++k;
+
+    Lgm_metadata_initvar( &v[k], m->nAlpha, 0, "Alpha" );
+    Lgm_metadata_addStringAttr( &v[k], "UNITS", "Degrees", 0 );
+    if ( m->nAlpha > 0 ) Lgm_metadata_addDoubleAttr( &v[k], "VALUES", m->nAlpha, med->H5_Alpha );
+    ++k;
+
+    // the orbital events (as in the AscendTimes, PerigeeTimes and ApogeeTimes HDF5 datasets)
+    Lgm_metadata_initvar( &v[k], med->H5_nAscend, 0, "AscendTimes" );
+    Times = med->H5_Ascend_IsoTimes;
+    if ( med->H5_nAscend > 0 ) Lgm_metadata_addStringAttrArray( &v[k], "VALUES", med->H5_nAscend, Times );
+    ++k;
+    Lgm_metadata_initvar( &v[k], med->H5_nPerigee, 0, "PerigeeTimes" );
+    Times = med->H5_Perigee_IsoTimes;
+    if ( med->H5_nPerigee > 0 ) Lgm_metadata_addStringAttrArray( &v[k], "VALUES", med->H5_nPerigee, Times );
+    ++k;
+    Lgm_metadata_initvar( &v[k], med->H5_nApogee, 0, "ApogeeTimes" );
+    Times = med->H5_Apogee_IsoTimes;
+    if ( med->H5_nApogee > 0 ) Lgm_metadata_addStringAttrArray( &v[k], "VALUES", med->H5_nApogee, Times );
+    ++k;
+
+    // one variable per column
+    for ( j=0; j<(int)w->Header.nColumns; j++, k++ ) {
+        Lgm_MagEphemColColumn *c = &w->Columns[j];
+        char T[2] = { c->Type, '\0' };
+        Lgm_metadata_initvar( &v[k], c->Width, 0, c->Name );
+        Lgm_metadata_addStringAttr( &v[k], "TYPE", T, 0 );
+        Lgm_metadata_addStringAttr( &v[k], "DEPEND_0", "IsoTime", 0 );
+        if ( MEC_Specs[ w->Spec[j] ].Units[0] != '\0' ) Lgm_metadata_addStringAttr( &v[k], "UNITS", MEC_Specs[ w->Spec[j] ].Units, 0 );
+        Lgm_metadata_addStringAttr( &v[k], "FILLVAL", "-1E31", 0 );
+    }
+
+    Schema = Lgm_metadata_JSONheaderArray( k, vp );
+
+    for ( j=0; j<k; j++ ) Lgm_metadata_freevar( &v[j] );
+    free( vp );
+    free( v );
+
+    return( Schema );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Create a columnar binary MagEphem file and write its header.
+ *
+ *  \details
+ *      The columnar counterpart of Lgm_WriteMagEphemHeaderHdf() (same
+ *      arguments, plus the file name and the number of rows). The file gets
+ *      one column for each per-time HDF5 dataset, each with room for
+ *      MaxRows rows, and a JSON schema describing the run. Rows are then
+ *      added with Lgm_WriteMagEphemDataCol() and the file is finished with
+ *      Lgm_CloseMagEphemColWriter().
+ *
+ *      \param[in]      Filename    File to create (overwritten if it exists).
+ *      \param[in]      MaxRows     Largest number of rows that will be written (e.g. the number of time steps in the day).
+ *      \param[in]      m           Lgm_MagEphemInfo structure (only m->nAlpha is used).
+ *      \param[in]      med         Lgm_MagEphemData structure (H5_Alpha and the orbital events must be set).
+ *
+ *      \return         A writer handle, or NULL if the file could not be created.
+ *
+ */
+Lgm_MagEphemColWriter *Lgm_CreateMagEphemCol( const char *Filename, long int MaxRows, const char *CodeVersion, const char *ExtModel, int SpiceBody,  const char *Spacecraft, int IdNumber, const char *IntDesig, const char *CmdLine, int nAscend, Lgm_DateTime *Ascend_UTC, Lgm_Vector *Ascend_U, int nPerigee, Lgm_DateTime *Perigee_UTC, Lgm_Vector *Perigee_U, int nApogee, Lgm_DateTime *Apogee_UTC, Lgm_Vector *Apogee_U, Lgm_MagEphemInfo *m, Lgm_MagEphemData *med ) {
+
+    int                     j, n, Width;
+    uint64_t                Offset;
+    char                    *Schema;
+    Lgm_MagEphemColWriter   *w;
+    Lgm_MagEphemColColumn   *c;
+
+    if ( MaxRows < 1 ) {
+        printf("Lgm_CreateMagEphemCol: MaxRows must be at least 1 (got %ld)\n", MaxRows );
+        return( NULL );
+    }
+
+    w = (Lgm_MagEphemColWriter *)calloc( 1, sizeof(Lgm_MagEphemColWriter) );
+    w->Columns = (Lgm_MagEphemColColumn *)calloc( MEC_NSPECS, sizeof(Lgm_MagEphemColColumn) );
+    w->Spec    = (int *)calloc( MEC_NSPECS, sizeof(int) );
+
+    /*
+     *  Column directory. Pitch angle columns are left out if there are no
+     *  pitch angles.
+     */
+    for ( n=0, j=0; j<MEC_NSPECS; j++ ) {
+        Width = ( MEC_Specs[j].Width > 0 ) ? MEC_Specs[j].Width : m->nAlpha;
+        if ( Width < 1 ) continue;
+        c = &w->Columns[n];
+        strncpy( c->Name, MEC_Specs[j].Name, LGM_MEC_NAME_LEN-1 );
+        c->Type      = MEC_Specs[j].Type;
+        c->Width     = (uint32_t)Width;
+        c->ElemBytes = MEC_FileElemBytes( c->Type );
+        c->RowBytes  = (uint64_t)c->Width*c->ElemBytes;
+        w->Spec[n]   = j;
+        ++n;
+    }
+
+    memcpy( w->Header.Magic, LGM_MEC_MAGIC, 8 );
+    w->Header.Version      = LGM_MEC_VERSION;
+    w->Header.nColumns     = (uint32_t)n;
+    w->Header.nRows        = 0;
+    w->Header.MaxRows      = (uint64_t)MaxRows;
+    w->Header.DirOffset    = sizeof(Lgm_MagEphemColHeader);
+    w->Header.SchemaOffset = w->Header.DirOffset + n*sizeof(Lgm_MagEphemColColumn);
+
+    Schema = MEC_Schema( w, CodeVersion, ExtModel, SpiceBody, Spacecraft, IdNumber, IntDesig, CmdLine, m, med );
+    w->Header.SchemaBytes  = strlen( Schema );
+
+    Offset = MEC_Align( w->Header.SchemaOffset + w->Header.SchemaBytes + 1 );
+    for ( j=0; j<n; j++ ) {
+        w->Columns[j].Offset = Offset;
+        Offset = MEC_Align( Offset + w->Header.MaxRows*w->Columns[j].RowBytes );
+    }
+
+    if ( ( (w->fd = open( Filename, O_RDWR | O_CREAT | O_TRUNC, 0644 )) < 0 )
+            || ( ftruncate( w->fd, (off_t)Offset ) != 0 )
+            || !MEC_PWrite( w->fd, &w->Header, sizeof(Lgm_MagEphemColHeader), 0 )
+            || !MEC_PWrite( w->fd, w->Columns, n*sizeof(Lgm_MagEphemColColumn), w->Header.DirOffset )
+            || !MEC_PWrite( w->fd, Schema, w->Header.SchemaBytes + 1, w->Header.SchemaOffset ) ) {
+        printf("Lgm_CreateMagEphemCol: could not create %s\n", Filename );
+        if ( w->fd >= 0 ) close( w->fd );
+        free( Schema ); free( w->Columns ); free( w->Spec ); free( w );
+        return( NULL );
+    }
+    free( Schema );
+
+    return( w );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Queue row \a i of the H5_* arrays in \a med for writing as row \a iRow of a columnar MagEphem file.
+ *
+ *  \details
+ *      Works like Lgm_WriteMagEphemDataHdf(): runs of consecutive rows are
+ *      held until med->H5_nBuffer of them have accumulated (or a row does
+ *      not follow on) and are then written together, so the rows in med
+ *      must be left alone until Lgm_FlushMagEphemDataCol() (or
+ *      Lgm_CloseMagEphemColWriter()) has written them. The writer keeps its
+ *      own count of held rows, so a HDF5 file can be written from the same
+ *      med at the same time.
+ *
+ *      \param[in,out]  w           Writer from Lgm_CreateMagEphemCol().
+ *      \param[in]      iRow        Row of the file to write to (0 to MaxRows-1).
+ *      \param[in]      i           Row of the H5_* arrays to write.
+ *      \param[in]      med         Lgm_MagEphemData structure.
+ *
+ *      \return         TRUE, or FALSE if iRow is out of range or a write failed.
+ *
+ */
+int Lgm_WriteMagEphemDataCol( Lgm_MagEphemColWriter *w, int iRow, int i, Lgm_MagEphemData *med ) {
+
+    int     Status = TRUE;
+
+    if ( ( iRow < 0 ) || ( (uint64_t)iRow >= w->Header.MaxRows ) ) {
+        printf("Lgm_WriteMagEphemDataCol: row %d is outside the file (MaxRows = %ld)\n", iRow, (long int)w->Header.MaxRows );
+        return( FALSE );
+    }
+
+    if ( ( w->nBuffered > 0 ) && ( ( iRow != w->iRow0 + w->nBuffered ) || ( i != w->i0 + w->nBuffered ) ) ) {
+        Status = Lgm_FlushMagEphemDataCol( w, med );
+    }
+
+    if ( w->nBuffered == 0 ) {
+        w->iRow0 = iRow;
+        w->i0    = i;
+    }
+    ++(w->nBuffered);
+
+    if ( w->nBuffered >= med->H5_nBuffer ) Status = Lgm_FlushMagEphemDataCol( w, med ) && Status;
+
+    return( Status );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Write the rows held by Lgm_WriteMagEphemDataCol().
+ *
+ *      \param[in,out]  w           Writer from Lgm_CreateMagEphemCol().
+ *      \param[in]      med         Lgm_MagEphemData structure.
+ *
+ *      \return         TRUE, or FALSE if a write failed.
+ *
+ */
+int Lgm_FlushMagEphemDataCol( Lgm_MagEphemColWriter *w, Lgm_MagEphemData *med ) {
+
+    int                     j, r, e, n, Status = TRUE;
+    size_t                  MemRow, Need;
+    const char              *Src, *Base;
+    MEC_Spec                *s;
+    Lgm_MagEphemColColumn   *c;
+
+    if ( ( n = w->nBuffered ) < 1 ) return( TRUE );
+    w->nBuffered = 0;
+
+    for ( j=0; j<(int)w->Header.nColumns; j++ ) {
+
+        c = &w->Columns[j];
+        s = &MEC_Specs[ w->Spec[j] ];
+
+        Base   = s->Rank2 ? **(char ***)((char *)med + s->Offset) : *(char **)((char *)med + s->Offset);
+        MemRow = ( ( s->Stride > 0 ) ? (size_t)s->Stride : (size_t)med->H5_nPA ) * MEC_MemElemBytes( c->Type );
+        Src    = Base + w->i0*MemRow;
+
+        if ( ( MemRow == c->RowBytes ) && ( MEC_MemElemBytes( c->Type ) == c->ElemBytes ) ) {
+
+            // rows are laid out the same in memory and in the file
+            Status = MEC_PWrite( w->fd, Src, n*c->RowBytes, c->Offset + w->iRow0*c->RowBytes ) && Status;
+
+        } else {
+
+            // pack them first
+            Need = n*c->RowBytes;
+            if ( w->nTmp < Need ) {
+                w->Tmp  = (char *)realloc( w->Tmp, Need );
+                w->nTmp = Need;
+            }
+            for ( r=0; r<n; r++ ) {
+                const char  *pm = Src + r*MemRow;
+                char        *pf = w->Tmp + r*c->RowBytes;
+                switch ( c->Type ) {
+                    case 'd':
+                        memcpy( pf, pm, c->RowBytes );
+                        break;
+                    case 'i':
+                        for ( e=0; e<(int)c->Width; e++ ) ((int32_t *)pf)[e] = (int32_t)((const int *)pm)[e];
+                        break;
+                    case 'l':
+                        for ( e=0; e<(int)c->Width; e++ ) ((int64_t *)pf)[e] = (int64_t)((const long int *)pm)[e];
+                        break;
+                    default:
+                        strncpy( pf, pm, c->Width );
+                        pf[c->Width-1] = '\0';
+                        break;
+                }
+            }
+            Status = MEC_PWrite( w->fd, w->Tmp, Need, c->Offset + w->iRow0*c->RowBytes ) && Status;
+
+        }
+    }
+
+    if ( (uint64_t)(w->iRow0 + n) > w->Header.nRows ) w->Header.nRows = (uint64_t)(w->iRow0 + n);
+
+    if ( !Status ) printf("Lgm_FlushMagEphemDataCol: write of rows %d-%d failed\n", w->iRow0, w->iRow0+n-1 );
+    return( Status );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Write any rows still held, record the number of rows and close the file.
+ *
+ *      \param[in,out]  w           Writer from Lgm_CreateMagEphemCol(). Freed.
+ *      \param[in]      med         Lgm_MagEphemData structure.
+ *
+ *      \return         TRUE, or FALSE if a write failed.
+ *
+ */
+int Lgm_CloseMagEphemColWriter( Lgm_MagEphemColWriter *w, Lgm_MagEphemData *med ) {
+
+    int Status;
+
+    if ( w == NULL ) return( FALSE );
+
+    Status = Lgm_FlushMagEphemDataCol( w, med );
+    Status = MEC_PWrite( w->fd, &w->Header, sizeof(Lgm_MagEphemColHeader), 0 ) && Status;
+    Status = ( close( w->fd ) == 0 ) && Status;
+
+    free( w->Tmp );
+    free( w->Columns );
+    free( w->Spec );
+    free( w );
+
+    return( Status );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Open a columnar MagEphem file for reading.
+ *
+ *  \details
+ *      The file is memory-mapped and checked; nothing else is read until a
+ *      column is used. Columns are found with Lgm_GetMagEphemColumn().
+ *
+ *      \param[in]      Filename    File written by Lgm_CreateMagEphemCol().
+ *
+ *      \return         A handle (close with Lgm_CloseMagEphemCol()), or NULL if the
+ *                      file could not be opened or is not a columnar MagEphem file.
+ *
+ */
+Lgm_MagEphemColFile *Lgm_OpenMagEphemCol( char *Filename ) {
+
+    int                     fd, j, Ok;
+    struct stat             sb;
+    size_t                  Size;
+    unsigned char           *Base;
+    Lgm_MagEphemColHeader   *h;
+    Lgm_MagEphemColColumn   *c;
+    Lgm_MagEphemColFile     *f;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_MagEphemColHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     *  Validate the header, directory and schema
+     */
+    h  = (Lgm_MagEphemColHeader *)Base;
+    Ok = (memcmp( h->Magic, LGM_MEC_MAGIC, 8 ) == 0) && (h->Version == LGM_MEC_VERSION) && (h->nRows <= h->MaxRows)
+            && (h->DirOffset + h->nColumns*sizeof(Lgm_MagEphemColColumn) <= Size)
+            && (h->SchemaOffset + h->SchemaBytes < Size) && (Base[h->SchemaOffset + h->SchemaBytes] == '\0');
+    if ( Ok ) {
+        c = (Lgm_MagEphemColColumn *)(Base + h->DirOffset);
+        for ( j=0; Ok && (j<(int)h->nColumns); j++ ) {
+            Ok = (c[j].RowBytes == (uint64_t)c[j].Width*c[j].ElemBytes) && (c[j].Offset % 8 == 0)
+                    && (c[j].Offset + h->MaxRows*c[j].RowBytes <= Size);
+        }
+    }
+    if ( !Ok ) {
+        fprintf( stderr, "Lgm_OpenMagEphemCol(): %s is not a valid columnar MagEphem file.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+
+    f = (Lgm_MagEphemColFile *)calloc( 1, sizeof(Lgm_MagEphemColFile) );
+    f->Base     = Base;
+    f->Size     = Size;
+    f->Header   = h;
+    f->Columns  = (Lgm_MagEphemColColumn *)(Base + h->DirOffset);
+    f->nRows    = (long int)h->nRows;
+    f->nColumns = (int)h->nColumns;
+    f->Schema   = (char *)(Base + h->SchemaOffset);
+
+    return( f );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Return the index of a column in the directory of a columnar MagEphem file, or -1.
+ */
+int Lgm_FindMagEphemColumn( Lgm_MagEphemColFile *f, char *Name ) {
+
+    int j;
+
+    for ( j=0; j<f->nColumns; j++ ) {
+        if ( strncmp( f->Columns[j].Name, Name, LGM_MEC_NAME_LEN ) == 0 ) return( j );
+    }
+    return( -1 );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Return a pointer to the data of a column of a columnar MagEphem file.
+ *
+ *  \details
+ *      The pointer is into the file mapping (nothing is copied) and is
+ *      valid until Lgm_CloseMagEphemCol(). Row r of the column starts at
+ *      element r*Width; only rows 0 to f->nRows-1 hold data. Types are 'd'
+ *      (double), 'i' (int32_t), 'l' (int64_t, e.g. "Date") and 's'
+ *      (Width-character nul padded strings, e.g. "IsoTime").
+ *
+ *      \param[in]      f           Handle from Lgm_OpenMagEphemCol().
+ *      \param[in]      Name        Column name (the HDF5 dataset name, e.g. "Lstar").
+ *      \param[in]      Type        Expected type, or 0 to accept any.
+ *      \param[out]     Width       Elements per row (may be NULL).
+ *
+ *      \return         Pointer to row 0, or NULL if there is no such column (or it has another type).
+ *
+ */
+void *Lgm_GetMagEphemColumn( Lgm_MagEphemColFile *f, char *Name, char Type, int *Width ) {
+
+    int j;
+
+    if ( (j = Lgm_FindMagEphemColumn( f, Name )) < 0 ) return( NULL );
+    if ( ( Type != 0 ) && ( f->Columns[j].Type != Type ) ) return( NULL );
+    if ( Width ) *Width = (int)f->Columns[j].Width;
+
+    return( (void *)(f->Base + f->Columns[j].Offset) );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Close a file opened with Lgm_OpenMagEphemCol(). Column pointers become invalid.
+ */
+void Lgm_CloseMagEphemCol( Lgm_MagEphemColFile *f ) {
+
+    if ( f == NULL ) return;
+#ifdef HAVE_SYS_MMAN_H
+    munmap( f->Base, f->Size );
+#else
+    free( f->Base );
+#endif
+    free( f );
+
+}
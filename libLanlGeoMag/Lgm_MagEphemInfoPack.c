@@ -0,0 +1,473 @@
+/*! \file Lgm_MagEphemInfoPack.c
+ *
+ *  \brief Packed binary records of a Lgm_MagEphemInfo, for moving the results
+ *  for an epoch between processes (over a pipe, a socket or shared memory).
+ *
+ *  \details
+ *      WriteMagEphemInfoStruct() dumps the structure itself (pointers and
+ *      all) followed by some of the arrays, and only the reader compiled
+ *      alongside it can make sense of it. A packed record instead has:
+ *
+ *          - a Lgm_MagEphemPackHeader (magic, version, byte order, the
+ *            total size, the array lengths and the per epoch scalars),
+ *          - the per pitch angle arrays (nAlpha entries each),
+ *          - if the drift shells were saved, the drift shell arrays with
+ *            only the nShellPoints[i] entries in use for each pitch angle,
+ *            and the decimated shell lines, again only the points in use.
+ *
+ *      Arrays for outputs that werent asked for (the LGM_OUT_* bits in
+ *      MagEphemInfo->Outputs) are left out, and the header says which are
+ *      there. Every array starts on an 8 byte boundary, so the record can
+ *      be used where it lies: Lgm_MagEphemInfo_PackView() just points into
+ *      it. Lgm_MagEphemInfo_Unpack() copies it into an existing
+ *      Lgm_MagEphemInfo instead.
+ *
+ *      Records are in the byte order of the machine that wrote them (they
+ *      are meant for workers and writers on the same cluster), and one with
+ *      a different byte order or version is rejected.
+ *
+ *      The order of the arrays is set out once, in PackWalk(), which is used
+ *      for all of sizing, packing, unpacking and viewing.
+ *
+ */
+#include <string.h>
+#include <errno.h>
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+#define PACK_ALIGN( n )     ( ( (n) + 7 ) & ~((size_t)7) )
+
+enum { PACK_SIZE, PACK_PUT, PACK_GET, PACK_VIEW };
+
+typedef struct PackState {
+    int                     Mode;
+    unsigned char           *Buf;       // the record (PACK_PUT, PACK_GET, PACK_VIEW)
+    size_t                  Size;       // its size
+    size_t                  Off;        // where the next array goes
+    int                     Ok;
+    Lgm_MagEphemInfo        *m;         // PACK_SIZE, PACK_PUT, PACK_GET
+    Lgm_MagEphemPackView    *v;         // PACK_VIEW
+    int                     nAlpha;
+    const int               *nShell;    // nShellPoints[] (from m or from the record)
+    const int               *nLine;     // shell line points per pitch angle (likewise)
+} PackState;
+
+
+/*
+ *  One array of Bytes bytes. Rows is NULL for a 1D array at Data, otherwise
+ *  Data is a (T **) and the array is Count[i]*Elem bytes from row i, for
+ *  i < nAlpha. View gets a pointer to it in PACK_VIEW mode.
+ */
+static void PackArray( PackState *ps, void *Data, const int *Count, size_t Elem, size_t Bytes, const void **View ) {
+
+    int             i;
+    size_t          b;
+    unsigned char   *p;
+
+    if ( !ps->Ok ) return;
+
+    if ( ( ps->Mode != PACK_SIZE ) && ( ( ps->Off > ps->Size ) || ( Bytes > ps->Size - ps->Off ) ) ) {
+        ps->Ok = FALSE;
+        return;
+    }
+
+    p = ps->Buf + ps->Off;
+    switch ( ps->Mode ) {
+        case PACK_PUT:
+        case PACK_GET:
+            if ( Count == NULL ) {
+                if ( ps->Mode == PACK_PUT ) memcpy( p, Data, Bytes ); else memcpy( Data, p, Bytes );
+            } else {
+                for ( i=0; i<ps->nAlpha; i++ ) {
+                    b = (size_t)Count[i]*Elem;
+                    if ( b == 0 ) continue;
+                    if ( ps->Mode == PACK_PUT ) memcpy( p, ((void **)Data)[i], b ); else memcpy( ((void **)Data)[i], p, b );
+                    p += b;
+                }
+            }
+            break;
+        case PACK_VIEW:
+            *View = p;
+            break;
+    }
+
+    ps->Off += PACK_ALIGN( Bytes );
+
+}
+
+/*
+ *  Sum of Count[0..nAlpha-1] (-1 if any are out of range).
+ */
+static long int PackTotal( const int *Count, int nAlpha, int Max ) {
+    long int    n = 0;
+    int         i;
+    for ( i=0; i<nAlpha; i++ ) {
+        if ( ( Count[i] < 0 ) || ( Count[i] > Max ) ) return( -1 );
+        n += Count[i];
+    }
+    return( n );
+}
+
+/*
+ *  Make sure the shell line arrays of m have room for nLine[i] points.
+ */
+static int PackGrowLines( Lgm_MagEphemInfo *m, int nAlpha, const int *nLine ) {
+
+    int     i, k;
+    float   **a[5], *p;
+
+    a[0] = m->s_gsm; a[1] = m->Bmag; a[2] = m->x_gsm; a[3] = m->y_gsm; a[4] = m->z_gsm;
+    for ( i=0; i<nAlpha; i++ ) {
+        if ( nLine[i] <= m->nShellLinePntsAlloced[i] ) continue;
+        for ( k=0; k<5; k++ ) {
+            if ( ( p = (float *)realloc( a[k][i], nLine[i]*sizeof(float) ) ) == NULL ) return( FALSE );
+            a[k][i] = p;
+        }
+        m->nShellLinePntsAlloced[i] = nLine[i];
+    }
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  All of the arrays of a record, in order. h is the header (already filled
+ *  in for PACK_SIZE and PACK_PUT, already checked for PACK_GET and
+ *  PACK_VIEW).
+ */
+#define V(f)    ( ps->v ? (const void **)&ps->v->f : NULL )
+#define P1(f, T)            PackArray( ps, m ? (void *)m->f : NULL, NULL, sizeof(T), (size_t)n*sizeof(T), V(f) )
+#define P2(f, T, Cnt, Tot)  PackArray( ps, m ? (void *)m->f : NULL, Cnt, sizeof(T), (size_t)(Tot)*sizeof(T), V(f) )
+static void PackWalk( PackState *ps, const Lgm_MagEphemPackHeader *h ) {
+
+    Lgm_MagEphemInfo    *m = ps->m;
+    int                 n = h->nAlpha, Out = h->Outputs, *tmp = NULL;
+    long int            nS = h->nShellTotal, nL = h->nLinePntsTotal;
+
+    ps->nAlpha = n;
+    ps->Off    = PACK_ALIGN( sizeof( Lgm_MagEphemPackHeader ) );
+
+    /*
+     *  Per pitch angle.
+     */
+    P1( Alpha, double ); P1( Bm, double ); P1( I, double ); P1( Lstar, double );
+    P1( LHilton, double ); P1( LMcIlwain, double );
+    P1( Hmin, double ); P1( Hmin_GeodLat, double ); P1( Hmin_GeodLon, double );
+    P1( Pmn_gsm, Lgm_Vector ); P1( Pms_gsm, Lgm_Vector );
+    P1( nShellPoints, int ); P1( LstarApprox, int ); P1( DriftOrbitType, int );
+    if ( Out & LGM_OUT_K ) { P1( K, double ); }
+    if ( Out & LGM_OUT_SB ) { P1( Sb, double ); P1( Tb, double ); }
+    if ( !ps->Ok || !h->HaveShell ) return;
+
+    /*
+     *  Drift shells (nShellPoints[i] entries for pitch angle i).
+     */
+    if ( ps->Mode == PACK_VIEW ) ps->nShell = ps->v->nShellPoints;
+    else                         ps->nShell = m->nShellPoints;
+    if ( PackTotal( ps->nShell, n, LGM_LSTARINFO_MAX_FL ) != nS ) { ps->Ok = FALSE; return; }
+
+    P2( ShellI, double, ps->nShell, nS ); P2( nMinima, int, ps->nShell, nS ); P2( nMaxima, int, ps->nShell, nS );
+    if ( Out & LGM_OUT_FOOTPOINTS ) {
+        P2( ShellSphericalFootprint_Pn, Lgm_Vector, ps->nShell, nS ); P2( ShellSphericalFootprint_Sn, double, ps->nShell, nS ); P2( ShellSphericalFootprint_Bn, double, ps->nShell, nS );
+        P2( ShellSphericalFootprint_Ps, Lgm_Vector, ps->nShell, nS ); P2( ShellSphericalFootprint_Ss, double, ps->nShell, nS ); P2( ShellSphericalFootprint_Bs, double, ps->nShell, nS );
+        P2( ShellEllipsoidFootprint_Pn, Lgm_Vector, ps->nShell, nS ); P2( ShellEllipsoidFootprint_Sn, double, ps->nShell, nS ); P2( ShellEllipsoidFootprint_Bn, double, ps->nShell, nS );
+        P2( ShellEllipsoidFootprint_Ps, Lgm_Vector, ps->nShell, nS ); P2( ShellEllipsoidFootprint_Ss, double, ps->nShell, nS ); P2( ShellEllipsoidFootprint_Bs, double, ps->nShell, nS );
+    }
+    if ( Out & LGM_OUT_MIRROR ) {
+        P2( ShellMirror_Pn, Lgm_Vector, ps->nShell, nS ); P2( ShellMirror_Sn, double, ps->nShell, nS );
+        P2( ShellMirror_Ps, Lgm_Vector, ps->nShell, nS ); P2( ShellMirror_Ss, double, ps->nShell, nS );
+    }
+    if ( Out & LGM_OUT_PMIN ) { P2( Shell_Pmin, Lgm_Vector, ps->nShell, nS ); P2( Shell_Bmin, Lgm_Vector, ps->nShell, nS ); }
+    if ( Out & LGM_OUT_VGC )  { P2( Shell_GradI, Lgm_Vector, ps->nShell, nS ); P2( Shell_Vgc, Lgm_Vector, ps->nShell, nS ); }
+    if ( !( Out & LGM_OUT_SHELL_LINES ) ) return;
+
+    /*
+     *  Shell lines. The points per pitch angle go first; there is no array
+     *  for them in Lgm_MagEphemInfo, so they are worked out (PACK_SIZE,
+     *  PACK_PUT) or read into a scratch array (PACK_GET).
+     */
+    if ( ps->Mode != PACK_VIEW ) {
+        int i;
+        tmp = (int *)calloc( n > 0 ? n : 1, sizeof(int) );
+        if ( ps->Mode != PACK_GET ) for ( i=0; i<n; i++ ) tmp[i] = Lgm_MagEphemInfo_nShellLinePnts( i, m );
+    }
+    PackArray( ps, tmp, NULL, sizeof(int), (size_t)n*sizeof(int), V(nLinePnts) );
+    ps->nLine = ( ps->Mode == PACK_VIEW ) ? ps->v->nLinePnts : tmp;
+    if ( ps->Ok && ( PackTotal( ps->nLine, n, 0x7fffffff ) != nL ) ) ps->Ok = FALSE;
+    if ( ps->Ok && ( ps->Mode == PACK_GET ) && !PackGrowLines( m, n, ps->nLine ) ) ps->Ok = FALSE;
+
+    P2( nFieldPnts, int, ps->nShell, nS ); P2( ShellLineOffset, int, ps->nShell, nS );
+    P2( s_gsm, float, ps->nLine, nL ); P2( Bmag, float, ps->nLine, nL );
+    P2( x_gsm, float, ps->nLine, nL ); P2( y_gsm, float, ps->nLine, nL ); P2( z_gsm, float, ps->nLine, nL );
+
+    free( tmp );
+    ps->nLine = NULL;
+
+}
+#undef V
+#undef P1
+#undef P2
+
+
+/*
+ *  Header for pitch angles [0, nPitchAngles) of m (Size not filled in).
+ */
+static void PackHeader( int nPitchAngles, Lgm_MagEphemInfo *m, Lgm_MagEphemPackHeader *h ) {
+
+    int i;
+
+    memset( h, 0, sizeof( *h ) );
+    memcpy( h->Magic, LGM_MAGEPHEM_PACK_MAGIC, 8 );
+    h->Version   = LGM_MAGEPHEM_PACK_VERSION;
+    h->ByteOrder = LGM_MAGEPHEM_PACK_BYTEORDER;
+
+    h->nAlpha    = nPitchAngles;
+    h->HaveShell = ( m->ShellI != NULL );
+    h->Outputs   = m->Outputs & ( h->HaveShell ? LGM_OUT_ALL : ~LGM_OUT_SHELL );
+    if ( h->HaveShell ) {
+        for ( i=0; i<nPitchAngles; i++ ) h->nShellTotal += m->nShellPoints[i];
+        if ( h->Outputs & LGM_OUT_SHELL_LINES ) {
+            for ( i=0; i<nPitchAngles; i++ ) h->nLinePntsTotal += Lgm_MagEphemInfo_nShellLinePnts( i, m );
+        }
+    }
+
+    h->FieldLineType = m->FieldLineType;
+    h->InOut         = m->InOut;
+    h->OrbitNumber   = m->OrbitNumber;
+    h->Date          = m->Date;
+    h->UTC = m->UTC; h->Lat = m->Lat; h->Lon = m->Lon; h->Rad = m->Rad;
+    h->P = m->P; h->S = m->S; h->B = m->B; h->d2B_ds2 = m->d2B_ds2; h->RofC = m->RofC; h->Sb0 = m->Sb0;
+    h->Pmin = m->Pmin; h->Bmin = m->Bmin; h->Smin = m->Smin; h->Snorth = m->Snorth; h->Ssouth = m->Ssouth;
+    h->Spherical_Footprint_Pn = m->Spherical_Footprint_Pn; h->Spherical_Footprint_Sn = m->Spherical_Footprint_Sn; h->Spherical_Footprint_Bn = m->Spherical_Footprint_Bn;
+    h->Spherical_Footprint_Ps = m->Spherical_Footprint_Ps; h->Spherical_Footprint_Ss = m->Spherical_Footprint_Ss; h->Spherical_Footprint_Bs = m->Spherical_Footprint_Bs;
+    h->Ellipsoid_Footprint_Pn = m->Ellipsoid_Footprint_Pn; h->Ellipsoid_Footprint_Sn = m->Ellipsoid_Footprint_Sn; h->Ellipsoid_Footprint_Bn = m->Ellipsoid_Footprint_Bn;
+    h->Ellipsoid_Footprint_Ps = m->Ellipsoid_Footprint_Ps; h->Ellipsoid_Footprint_Ss = m->Ellipsoid_Footprint_Ss; h->Ellipsoid_Footprint_Bs = m->Ellipsoid_Footprint_Bs;
+    h->Mcurr = m->Mcurr; h->Mref = m->Mref; h->Mused = m->Mused; h->ShellLineTol = m->ShellLineTol;
+
+}
+
+static void UnpackHeader( const Lgm_MagEphemPackHeader *h, Lgm_MagEphemInfo *m ) {
+
+    m->nAlpha        = h->nAlpha;
+    m->Outputs       = h->Outputs;
+    m->FieldLineType = h->FieldLineType;
+    m->InOut         = h->InOut;
+    m->OrbitNumber   = h->OrbitNumber;
+    m->Date          = h->Date;
+    m->UTC = h->UTC; m->Lat = h->Lat; m->Lon = h->Lon; m->Rad = h->Rad;
+    m->P = h->P; m->S = h->S; m->B = h->B; m->d2B_ds2 = h->d2B_ds2; m->RofC = h->RofC; m->Sb0 = h->Sb0;
+    m->Pmin = h->Pmin; m->Bmin = h->Bmin; m->Smin = h->Smin; m->Snorth = h->Snorth; m->Ssouth = h->Ssouth;
+    m->Spherical_Footprint_Pn = h->Spherical_Footprint_Pn; m->Spherical_Footprint_Sn = h->Spherical_Footprint_Sn; m->Spherical_Footprint_Bn = h->Spherical_Footprint_Bn;
+    m->Spherical_Footprint_Ps = h->Spherical_Footprint_Ps; m->Spherical_Footprint_Ss = h->Spherical_Footprint_Ss; m->Spherical_Footprint_Bs = h->Spherical_Footprint_Bs;
+    m->Ellipsoid_Footprint_Pn = h->Ellipsoid_Footprint_Pn; m->Ellipsoid_Footprint_Sn = h->Ellipsoid_Footprint_Sn; m->Ellipsoid_Footprint_Bn = h->Ellipsoid_Footprint_Bn;
+    m->Ellipsoid_Footprint_Ps = h->Ellipsoid_Footprint_Ps; m->Ellipsoid_Footprint_Ss = h->Ellipsoid_Footprint_Ss; m->Ellipsoid_Footprint_Bs = h->Ellipsoid_Footprint_Bs;
+    m->Mcurr = h->Mcurr; m->Mref = h->Mref; m->Mused = h->Mused; m->ShellLineTol = h->ShellLineTol;
+
+}
+
+/*
+ *  TRUE if Buf starts with a header we can read and is at least as long as
+ *  it says the record is.
+ */
+static int CheckHeader( const void *Buf, size_t Size ) {
+
+    const Lgm_MagEphemPackHeader *h = (const Lgm_MagEphemPackHeader *)Buf;
+
+    if ( ( Buf == NULL ) || ( Size < sizeof( *h ) ) ) return( FALSE );
+    if ( ( (uintptr_t)Buf & 7 ) != 0 ) return( FALSE );
+    if ( memcmp( h->Magic, LGM_MAGEPHEM_PACK_MAGIC, 8 ) != 0 ) return( FALSE );
+    if ( ( h->Version != LGM_MAGEPHEM_PACK_VERSION ) || ( h->ByteOrder != LGM_MAGEPHEM_PACK_BYTEORDER ) ) return( FALSE );
+    if ( ( h->Size < sizeof( *h ) ) || ( h->Size > Size ) ) return( FALSE );
+    if ( ( h->nAlpha < 0 ) || ( h->nShellTotal < 0 ) || ( h->nLinePntsTotal < 0 ) ) return( FALSE );
+
+    return( TRUE );
+
+}
+
+
+
+
+/**
+ *   The number of bytes Lgm_MagEphemInfo_Pack() needs for pitch angles
+ *   [0, nPitchAngles) of m.
+ */
+size_t Lgm_MagEphemInfo_PackedSize( int nPitchAngles, Lgm_MagEphemInfo *m ) {
+
+    Lgm_MagEphemPackHeader  h;
+    PackState               ps;
+
+    PackHeader( nPitchAngles, m, &h );
+    memset( &ps, 0, sizeof( ps ) );
+    ps.Mode = PACK_SIZE; ps.Ok = TRUE; ps.m = m;
+    PackWalk( &ps, &h );
+
+    return( ps.Ok ? ps.Off : 0 );
+
+}
+
+/**
+ *   Packs pitch angles [0, nPitchAngles) of m (and the per epoch values)
+ *   into Buf. Only the arrays for the outputs in m->Outputs go in, and the
+ *   drift shells only if they were saved (see Lgm_MagEphemShellLines.c).
+ *
+ *      \param[in]      nPitchAngles    Number of pitch angles to pack.
+ *      \param[in]      m               The results.
+ *      \param[out]     Buf             Where to put the record (8 byte aligned).
+ *      \param[in]      BufSize         Room in Buf (see Lgm_MagEphemInfo_PackedSize()).
+ *
+ *      \returns        The size of the record, or 0 if it didnt fit.
+ *
+ */
+size_t Lgm_MagEphemInfo_Pack( int nPitchAngles, Lgm_MagEphemInfo *m, void *Buf, size_t BufSize ) {
+
+    Lgm_MagEphemPackHeader  h;
+    PackState               ps;
+    size_t                  Size;
+
+    if ( ( (uintptr_t)Buf & 7 ) != 0 ) return( 0 );
+    if ( ( Size = Lgm_MagEphemInfo_PackedSize( nPitchAngles, m ) ) == 0 || ( Size > BufSize ) ) return( 0 );
+
+    PackHeader( nPitchAngles, m, &h );
+    h.Size = Size;
+    memset( Buf, 0, Size );     // so the padding doesnt carry whatever was there
+    memcpy( Buf, &h, sizeof( h ) );
+
+    memset( &ps, 0, sizeof( ps ) );
+    ps.Mode = PACK_PUT; ps.Ok = TRUE; ps.m = m; ps.Buf = (unsigned char *)Buf; ps.Size = Size;
+    PackWalk( &ps, &h );
+
+    return( ps.Ok ? Size : 0 );
+
+}
+
+/**
+ *   Copies a packed record into m, which has to have room for the record's
+ *   pitch angles (m->nAllocedAlpha). The drift shell arrays are allocated if
+ *   the record has them and m doesnt. m->nAlpha and m->Outputs are set from
+ *   the record; arrays that arent in the record are left as they were.
+ *
+ *      \returns        TRUE, or FALSE if the record is bad, is from a
+ *                      different version or byte order, or doesnt fit m.
+ *
+ */
+int Lgm_MagEphemInfo_Unpack( const void *Buf, size_t Size, int *nPitchAngles, Lgm_MagEphemInfo *m ) {
+
+    const Lgm_MagEphemPackHeader    *h = (const Lgm_MagEphemPackHeader *)Buf;
+    PackState                       ps;
+
+    if ( !CheckHeader( Buf, Size ) || ( h->nAlpha > m->nAllocedAlpha ) ) return( FALSE );
+    if ( h->HaveShell ) Lgm_MagEphemInfo_AllocShellArrays( m );
+
+    UnpackHeader( h, m );
+    memset( &ps, 0, sizeof( ps ) );
+    ps.Mode = PACK_GET; ps.Ok = TRUE; ps.m = m; ps.Buf = (unsigned char *)Buf; ps.Size = h->Size;
+    PackWalk( &ps, h );
+    if ( ps.Ok ) *nPitchAngles = h->nAlpha;
+
+    return( ps.Ok );
+
+}
+
+/**
+ *   Points v at the arrays of a packed record, without copying anything.
+ *   The pointers are only good for as long as Buf is.
+ *
+ *      \returns        TRUE, or FALSE if the record is bad (or is from a
+ *                      different version or byte order).
+ *
+ */
+int Lgm_MagEphemInfo_PackView( const void *Buf, size_t Size, Lgm_MagEphemPackView *v ) {
+
+    const Lgm_MagEphemPackHeader    *h = (const Lgm_MagEphemPackHeader *)Buf;
+    PackState                       ps;
+
+    memset( v, 0, sizeof( *v ) );
+    if ( !CheckHeader( Buf, Size ) ) return( FALSE );
+
+    v->h = h;
+    memset( &ps, 0, sizeof( ps ) );
+    ps.Mode = PACK_VIEW; ps.Ok = TRUE; ps.v = v; ps.Buf = (unsigned char *)Buf; ps.Size = h->Size;
+    PackWalk( &ps, h );
+    if ( !ps.Ok ) memset( v, 0, sizeof( *v ) );
+
+    return( ps.Ok );
+
+}
+
+
+
+
+static int WriteAll( int fd, const unsigned char *p, size_t n ) {
+    ssize_t k;
+    while ( n > 0 ) {
+        if ( ( k = write( fd, p, n ) ) < 0 ) {
+            if ( errno == EINTR ) continue;
+            return( FALSE );
+        }
+        p += k; n -= (size_t)k;
+    }
+    return( TRUE );
+}
+
+static int ReadAll( int fd, unsigned char *p, size_t n ) {
+    ssize_t k;
+    while ( n > 0 ) {
+        if ( ( k = read( fd, p, n ) ) < 0 ) {
+            if ( errno == EINTR ) continue;
+            return( FALSE );
+        }
+        if ( k == 0 ) return( FALSE );  // EOF part way through
+        p += k; n -= (size_t)k;
+    }
+    return( TRUE );
+}
+
+/**
+ *   Writes a packed record of pitch angles [0, nPitchAngles) of m to fd (a
+ *   pipe, socket or file). Records can be written one after the other and
+ *   read back with Lgm_MagEphemInfo_ReadPacked().
+ *
+ *      \returns        TRUE, or FALSE if the write failed.
+ *
+ */
+int Lgm_MagEphemInfo_WritePacked( int fd, int nPitchAngles, Lgm_MagEphemInfo *m ) {
+
+    size_t  Size;
+    double  *Buf;   // (for the alignment)
+    int     Status;
+
+    if ( ( Size = Lgm_MagEphemInfo_PackedSize( nPitchAngles, m ) ) == 0 ) return( FALSE );
+    if ( ( Buf = (double *)malloc( Size ) ) == NULL ) return( FALSE );
+    Status = ( Lgm_MagEphemInfo_Pack( nPitchAngles, m, Buf, Size ) == Size ) && WriteAll( fd, (unsigned char *)Buf, Size );
+    free( Buf );
+
+    return( Status );
+
+}
+
+/**
+ *   Reads the next record written by Lgm_MagEphemInfo_WritePacked() from fd
+ *   into m (see Lgm_MagEphemInfo_Unpack()).
+ *
+ *      \returns        TRUE, or FALSE at the end of the stream or if the
+ *                      record is bad.
+ *
+ */
+int Lgm_MagEphemInfo_ReadPacked( int fd, int *nPitchAngles, Lgm_MagEphemInfo *m ) {
+
+    Lgm_MagEphemPackHeader  h;
+    double                  *Buf;
+    int                     Status;
+
+    if ( !ReadAll( fd, (unsigned char *)&h, sizeof( h ) ) ) return( FALSE );
+    if ( !CheckHeader( &h, sizeof( h ) + ( ( h.Size > sizeof( h ) ) ? h.Size - sizeof( h ) : 0 ) ) ) return( FALSE );
+    if ( ( Buf = (double *)malloc( h.Size ) ) == NULL ) return( FALSE );
+
+    memcpy( Buf, &h, sizeof( h ) );
+    Status = ReadAll( fd, (unsigned char *)Buf + sizeof( h ), h.Size - sizeof( h ) )
+                && Lgm_MagEphemInfo_Unpack( Buf, h.Size, nPitchAngles, m );
+    free( Buf );
+
+    return( Status );
+
+}
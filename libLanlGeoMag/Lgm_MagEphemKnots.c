@@ -0,0 +1,446 @@
+/*! \file Lgm_MagEphemKnots.c
+ *
+ *  \brief Adaptive cadence for MagEphem runs: full calculations at knots, interpolation in between.
+ *
+ *  \details
+ *      MagEphem files are usually made at a fixed (e.g. 1 minute) cadence,
+ *      and every step gets a full Lgm_ComputeLstarVersusPA() even though
+ *      along most of an orbit (all of it at GEO, and the outer parts of a
+ *      HEO) L*, the footpoints and Bmin change slowly and smoothly. With an
+ *      Lgm_MagEphemKnots the full calculation is only done at some of the
+ *      steps (the knots), and the rest are filled in by monotone
+ *      (Fritsch-Carlson) cubic interpolation between the knots around them.
+ *
+ *      The knots are chosen in rounds with Lgm_MagEphemKnots_Next(). The
+ *      first round is every MaxGap steps (and the last step). After that,
+ *      each interval between neighboring knots is split in two (by a new
+ *      knot in the middle) if
+ *
+ *          - the knots at its ends are different kinds of thing: the field
+ *            line type, the drift orbit type of any pitch angle or which
+ *            values are fill values differ (so the FL type changes get
+ *            bracketed down to single steps),
+ *
+ *          - the S/C radius changes by more than RadiusTol over it (this
+ *            is what refines around perigee), or
+ *
+ *          - the interpolation error estimate for L* (any pitch angle) or
+ *            the latitude of either footpoint is over LstarTol or MlatTol.
+ *            The estimate is h^2/8 |f''|, with f'' from the second
+ *            divided differences through the knots on either side.
+ *
+ *      The rounds end when no interval needs splitting. The knots of a
+ *      round are independent, so they can be computed in parallel (each
+ *      thread calls Lgm_MagEphemKnots_Save() for its own steps).
+ *      Lgm_MagEphemKnots_Fill() then fills a Lgm_MagEphemInfo for any step,
+ *      as Lgm_ComputeLstarVersusPA() would have, and says whether it was a
+ *      knot or interpolated. The local field (B and Bm) is always computed,
+ *      and the drift shell lines are not kept (nShellPoints is 0).
+ *
+ *          k = Lgm_InitMagEphemKnots( nSteps, nAlpha, 10, 0.01, 0.05 );
+ *          while ( ( n = Lgm_MagEphemKnots_Next( Steps, k ) ) > 0 ) {
+ *              for ( j=0; j<n; j++ ) {
+ *                  ...  set up step Steps[j]
+ *                  Lgm_ComputeLstarVersusPA( Date, UTC, &u, nAlpha, Alpha, 0, MagEphemInfo );
+ *                  Lgm_MagEphemKnots_Save( Steps[j], MagEphemInfo, k );
+ *              }
+ *          }
+ *          for ( i=0; i<nSteps; i++ ) {
+ *              ...  set up step i
+ *              Lgm_MagEphemKnots_Fill( i, Date, UTC, &u, nAlpha, Alpha, k, MagEphemInfo );
+ *          }
+ *          Lgm_FreeMagEphemKnots( k );
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_MagEphemKnots.h"
+
+#define LGM_MEK_RADIUS_TOL  0.05    // default RadiusTol
+
+#define V(k,i)  ( &(k)->V[ (long int)(i)*(k)->nV ] )
+
+
+/*
+ *  Allocate the knots for a run of nSteps steps and nAlpha pitch angles.
+ *  MaxGap (<= 0 gives 10) is the largest number of steps between knots.
+ *  LstarTol and MlatTol (<= 0 give 0.01 and 0.05 degrees) are the
+ *  interpolation errors allowed in L* and in footpoint latitude.
+ */
+Lgm_MagEphemKnots *Lgm_InitMagEphemKnots( long int nSteps, int nAlpha, long int MaxGap, double LstarTol, double MlatTol ) {
+
+    Lgm_MagEphemKnots *k;
+
+    if ( nSteps < 1 ) return( NULL );
+
+    k = (Lgm_MagEphemKnots *) calloc( 1, sizeof( *k ) );
+    k->nSteps    = nSteps;
+    k->nAlpha    = ( nAlpha > 0 ) ? nAlpha : 0;
+    k->nV        = LGM_MEK_NSCALAR + LGM_MEK_NPA*k->nAlpha;
+    k->MaxGap    = ( MaxGap > 0 ) ? MaxGap : 10;
+    k->LstarTol  = ( LstarTol > 0.0 ) ? LstarTol : 0.01;
+    k->MlatTol   = ( MlatTol > 0.0 ) ? MlatTol : 0.05;
+    k->RadiusTol = LGM_MEK_RADIUS_TOL;
+
+    k->IsKnot         = (char *) calloc( nSteps, sizeof(char) );
+    k->FieldLineType  = (int *) calloc( nSteps, sizeof(int) );
+    k->DriftOrbitType = (int *) calloc( nSteps*( k->nAlpha > 0 ? k->nAlpha : 1 ), sizeof(int) );
+    k->R              = (double *) calloc( nSteps, sizeof(double) );
+    k->V              = (double *) calloc( nSteps*k->nV, sizeof(double) );
+    if ( ( k->IsKnot == NULL ) || ( k->FieldLineType == NULL ) || ( k->DriftOrbitType == NULL ) || ( k->R == NULL ) || ( k->V == NULL ) ) {
+        printf("Lgm_InitMagEphemKnots: Could not allocate memory for %ld steps\n", nSteps );
+        Lgm_FreeMagEphemKnots( k );
+        return( NULL );
+    }
+
+    return( k );
+
+}
+
+
+void Lgm_FreeMagEphemKnots( Lgm_MagEphemKnots *k ) {
+
+    if ( k == NULL ) return;
+    free( k->IsKnot );
+    free( k->FieldLineType );
+    free( k->DriftOrbitType );
+    free( k->R );
+    free( k->V );
+    free( k );
+
+}
+
+
+/*
+ *  Save the results of the Lgm_ComputeLstarVersusPA() just done for step
+ *  iStep. Different threads can save different steps at the same time.
+ */
+void Lgm_MagEphemKnots_Save( long int iStep, Lgm_MagEphemInfo *MagEphemInfo, Lgm_MagEphemKnots *k ) {
+
+    int     i;
+    double  *v;
+
+    if ( ( k == NULL ) || ( iStep < 0 ) || ( iStep >= k->nSteps ) ) return;
+
+    v = V( k, iStep );
+    v[0]  = MagEphemInfo->Pmin.x;                   v[1]  = MagEphemInfo->Pmin.y;                   v[2]  = MagEphemInfo->Pmin.z;
+    v[3]  = MagEphemInfo->Ellipsoid_Footprint_Pn.x; v[4]  = MagEphemInfo->Ellipsoid_Footprint_Pn.y; v[5]  = MagEphemInfo->Ellipsoid_Footprint_Pn.z;
+    v[6]  = MagEphemInfo->Ellipsoid_Footprint_Ps.x; v[7]  = MagEphemInfo->Ellipsoid_Footprint_Ps.y; v[8]  = MagEphemInfo->Ellipsoid_Footprint_Ps.z;
+    v[9]  = MagEphemInfo->Snorth;
+    v[10] = MagEphemInfo->Ssouth;
+    v[11] = MagEphemInfo->Smin;
+    v[12] = MagEphemInfo->Bmin;
+    v[13] = MagEphemInfo->Sb0;
+    v[14] = MagEphemInfo->d2B_ds2;
+    v[15] = MagEphemInfo->RofC;
+    v[16] = MagEphemInfo->Mref;
+    v[17] = MagEphemInfo->Mcurr;
+    v[18] = MagEphemInfo->Mused;
+    for ( i=0; i<k->nAlpha; i++ ) {
+        v[LGM_MEK_NSCALAR + LGM_MEK_NPA*i    ] = MagEphemInfo->Lstar[i];
+        v[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 1] = MagEphemInfo->I[i];
+        v[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 2] = MagEphemInfo->K[i];
+        v[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 3] = MagEphemInfo->Sb[i];
+        v[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 4] = MagEphemInfo->Tb[i];
+        k->DriftOrbitType[ iStep*k->nAlpha + i ] = MagEphemInfo->DriftOrbitType[i];
+    }
+    k->FieldLineType[iStep] = MagEphemInfo->FieldLineType;
+    k->R[iStep]             = Lgm_Magnitude( &MagEphemInfo->P );
+
+    if ( !k->IsKnot[iStep] ) {
+        k->IsKnot[iStep] = TRUE;
+#if USE_OPENMP
+        #pragma omp atomic
+#endif
+        ++k->nKnots;
+    }
+
+}
+
+
+/*
+ *  Can the steps between knots a and b be interpolated at all? (The same
+ *  kind of FL, the same drift orbit types and fill values in the same
+ *  places.)
+ */
+static int Lgm_MagEphemKnots_Compatible( long int a, long int b, Lgm_MagEphemKnots *k ) {
+
+    int     i;
+    double  *va = V( k, a ), *vb = V( k, b );
+
+    if ( k->FieldLineType[a] != k->FieldLineType[b] ) return( FALSE );
+    for ( i=0; i<k->nAlpha; i++ ) {
+        if ( k->DriftOrbitType[ a*k->nAlpha + i ] != k->DriftOrbitType[ b*k->nAlpha + i ] ) return( FALSE );
+    }
+    for ( i=0; i<k->nV; i++ ) {
+        if ( ( va[i] == LGM_FILL_VALUE ) != ( vb[i] == LGM_FILL_VALUE ) ) return( FALSE );
+    }
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Latitude (degrees, GSM) of the footpoint whose x component is at v[j].
+ */
+static double Lgm_MagEphemKnots_Lat( double *v, int j ) {
+
+    double r = sqrt( v[j]*v[j] + v[j+1]*v[j+1] + v[j+2]*v[j+2] );
+
+    return( ( r > 0.0 ) ? asin( v[j+2]/r )*DegPerRad : 0.0 );
+
+}
+
+
+/*
+ *  Estimate of |f''| at the a-b interval from the knots p, a, b and q (p or
+ *  q are -1 if they cant be used). f is the j'th value, or the latitude of
+ *  the footpoint starting at j if Lat is set.
+ */
+static double Lgm_MagEphemKnots_D2( long int p, long int a, long int b, long int q, int j, int Lat, Lgm_MagEphemKnots *k ) {
+
+    double  fp, fa, fb, fq, d, D2 = 0.0;
+
+    fa = Lat ? Lgm_MagEphemKnots_Lat( V(k,a), j ) : V(k,a)[j];
+    fb = Lat ? Lgm_MagEphemKnots_Lat( V(k,b), j ) : V(k,b)[j];
+    if ( p >= 0 ) {
+        fp = Lat ? Lgm_MagEphemKnots_Lat( V(k,p), j ) : V(k,p)[j];
+        d  = 2.0*( (fb-fa)/(double)(b-a) - (fa-fp)/(double)(a-p) )/(double)(b-p);
+        if ( fabs( d ) > D2 ) D2 = fabs( d );
+    }
+    if ( q >= 0 ) {
+        fq = Lat ? Lgm_MagEphemKnots_Lat( V(k,q), j ) : V(k,q)[j];
+        d  = 2.0*( (fq-fb)/(double)(q-b) - (fb-fa)/(double)(b-a) )/(double)(q-a);
+        if ( fabs( d ) > D2 ) D2 = fabs( d );
+    }
+
+    return( D2 );
+
+}
+
+
+/*
+ *  Does the interval between knots a and b (with p and q the knots before
+ *  and after it, or -1) need another knot?
+ */
+static int Lgm_MagEphemKnots_NeedsSplit( long int p, long int a, long int b, long int q, Lgm_MagEphemKnots *k ) {
+
+    int     i, j;
+    double  h2_8;
+
+    if ( b - a < 2 ) return( FALSE );
+    if ( !Lgm_MagEphemKnots_Compatible( a, b, k ) ) return( TRUE );
+    if ( fabs( k->R[b] - k->R[a] ) > k->RadiusTol*( ( k->R[a] < k->R[b] ) ? k->R[a] : k->R[b] ) ) return( TRUE );
+
+    if ( ( p >= 0 ) && !Lgm_MagEphemKnots_Compatible( p, a, k ) ) p = -1;
+    if ( ( q >= 0 ) && !Lgm_MagEphemKnots_Compatible( b, q, k ) ) q = -1;
+    if ( ( p < 0 ) && ( q < 0 ) ) return( TRUE ); // nothing to estimate the error from
+
+    h2_8 = (double)(b-a)*(double)(b-a)/8.0;
+    for ( i=0; i<k->nAlpha; i++ ) {
+        j = LGM_MEK_NSCALAR + LGM_MEK_NPA*i;
+        if ( V(k,a)[j] == LGM_FILL_VALUE ) continue;
+        if ( h2_8*Lgm_MagEphemKnots_D2( p, a, b, q, j, FALSE, k ) > k->LstarTol ) return( TRUE );
+    }
+    for ( j=3; j<=6; j+=3 ) {
+        if ( V(k,a)[j] == LGM_FILL_VALUE ) continue;
+        if ( h2_8*Lgm_MagEphemKnots_D2( p, a, b, q, j, TRUE, k ) > k->MlatTol ) return( TRUE );
+    }
+
+    return( FALSE );
+
+}
+
+
+/**
+ *  \brief
+ *      The next round of knots to compute.
+ *
+ *  \details
+ *      The first round is every MaxGap steps (and the last one). After that
+ *      it is the middles of the intervals that need splitting (see the top
+ *      of this file), so it must only be called once all of the knots of
+ *      the last round have been saved.
+ *
+ *      \param[out]     Steps   The steps to compute (room for nSteps).
+ *      \param[in,out]  k       Knots.
+ *
+ *      \return The number of steps in Steps[] (0 once there is nothing left to refine).
+ *
+ */
+long int Lgm_MagEphemKnots_Next( long int *Steps, Lgm_MagEphemKnots *k ) {
+
+    long int    i, n = 0, p, a, b, q;
+
+    if ( k == NULL ) return( 0 );
+
+    if ( !k->Started ) {
+        k->Started = TRUE;
+        for ( i=0; i<k->nSteps; i += k->MaxGap ) {
+            if ( !k->IsKnot[i] ) Steps[n++] = i;
+        }
+        if ( !k->IsKnot[k->nSteps-1] && ( ( k->nSteps-1 ) % k->MaxGap ) ) Steps[n++] = k->nSteps-1;
+        return( n );
+    }
+
+    p = a = b = -1;
+    for ( q=0; q<k->nSteps; q++ ) {
+        if ( !k->IsKnot[q] ) continue;
+        if ( ( a >= 0 ) && Lgm_MagEphemKnots_NeedsSplit( p, a, b, q, k ) ) Steps[n++] = (a+b)/2;
+        p = a; a = b; b = q;
+    }
+    if ( ( a >= 0 ) && Lgm_MagEphemKnots_NeedsSplit( p, a, b, -1, k ) ) Steps[n++] = (a+b)/2;
+
+    return( n );
+
+}
+
+
+/*
+ *  Fritsch-Carlson slope at a knot with secants dl and dr on intervals of
+ *  length hl and hr to its left and right.
+ */
+static double Lgm_MagEphemKnots_Slope( double hl, double dl, double hr, double dr ) {
+
+    double w1, w2;
+
+    if ( dl*dr <= 0.0 ) return( 0.0 );
+    w1 = 2.0*hr + hl;
+    w2 = hr + 2.0*hl;
+
+    return( ( w1 + w2 )/( w1/dl + w2/dr ) );
+
+}
+
+
+/*
+ *  Monotone cubic for value j at step i, between knots a and b (p and q are
+ *  the knots either side to get the slopes from, or -1).
+ */
+static double Lgm_MagEphemKnots_Interp( long int i, long int p, long int a, long int b, long int q, int j, Lgm_MagEphemKnots *k ) {
+
+    double  fa = V(k,a)[j], fb = V(k,b)[j], h = (double)(b-a), d, ma, mb, t, t2, t3;
+
+    d  = ( fb - fa )/h;
+    ma = ( ( p >= 0 ) && ( V(k,p)[j] != LGM_FILL_VALUE ) ) ? Lgm_MagEphemKnots_Slope( (double)(a-p), ( fa - V(k,p)[j] )/(double)(a-p), h, d ) : d;
+    mb = ( ( q >= 0 ) && ( V(k,q)[j] != LGM_FILL_VALUE ) ) ? Lgm_MagEphemKnots_Slope( h, d, (double)(q-b), ( V(k,q)[j] - fb )/(double)(q-b) ) : d;
+
+    t = (double)(i-a)/h; t2 = t*t; t3 = t2*t;
+
+    return( (2.0*t3 - 3.0*t2 + 1.0)*fa + (t3 - 2.0*t2 + t)*h*ma + (3.0*t2 - 2.0*t3)*fb + (t3 - t2)*h*mb );
+
+}
+
+
+/**
+ *  \brief
+ *      Fill MagEphemInfo for step iStep from the knots.
+ *
+ *  \details
+ *      Sets what Lgm_ComputeLstarVersusPA() would: the time, position,
+ *      local B and Bm's (these are computed, so the model must be set up
+ *      for the step), and then the FL and L* results, copied from the knot
+ *      or interpolated between the knots around the step. Interpolated
+ *      footpoints are scaled back to the (interpolated) distance of the
+ *      footpoints from the center of the Earth.
+ *
+ *      \return LGM_MEK_KNOT, LGM_MEK_INTERPOLATED, or LGM_MEK_NONE if the
+ *              step isnt covered by the knots (MagEphemInfo is then left
+ *              alone, and the step has to be computed).
+ *
+ */
+int Lgm_MagEphemKnots_Fill( long int iStep, long int Date, double UTC, Lgm_Vector *u, int nAlpha, double *Alpha, Lgm_MagEphemKnots *k, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    long int    p, a, b, q;
+    int         i, j, Result;
+    double      v[LGM_MEK_NSCALAR + LGM_MEK_NPA*MAX_PITCH_ANGLES], *s, ra, rb, r, sa;
+    Lgm_Vector  Bvec;
+
+    if ( ( k == NULL ) || ( iStep < 0 ) || ( iStep >= k->nSteps ) || ( nAlpha != k->nAlpha ) || ( nAlpha > MAX_PITCH_ANGLES ) ) return( LGM_MEK_NONE );
+
+    /*
+     *  The knots around the step (and the ones either side of those).
+     */
+    if ( k->IsKnot[iStep] ) {
+        a = b = iStep;
+        p = q = -1;
+        s = V( k, iStep );
+        Result = LGM_MEK_KNOT;
+    } else {
+        for ( a=iStep-1; ( a >= 0 ) && !k->IsKnot[a]; a-- );
+        for ( b=iStep+1; ( b < k->nSteps ) && !k->IsKnot[b]; b++ );
+        if ( ( a < 0 ) || ( b >= k->nSteps ) || !Lgm_MagEphemKnots_Compatible( a, b, k ) ) return( LGM_MEK_NONE );
+        for ( p=a-1; ( p >= 0 ) && !k->IsKnot[p]; p-- );
+        for ( q=b+1; ( q < k->nSteps ) && !k->IsKnot[q]; q++ );
+        if ( ( p >= 0 ) && !Lgm_MagEphemKnots_Compatible( p, a, k ) ) p = -1;
+        if ( ( q >= k->nSteps ) || !Lgm_MagEphemKnots_Compatible( b, q, k ) ) q = -1;
+
+        for ( j=0; j<k->nV; j++ ) {
+            v[j] = ( V(k,a)[j] == LGM_FILL_VALUE ) ? LGM_FILL_VALUE : Lgm_MagEphemKnots_Interp( iStep, p, a, b, q, j, k );
+        }
+        for ( j=3; j<=6; j+=3 ) {
+            if ( v[j] == LGM_FILL_VALUE ) continue;
+            ra = sqrt( V(k,a)[j]*V(k,a)[j] + V(k,a)[j+1]*V(k,a)[j+1] + V(k,a)[j+2]*V(k,a)[j+2] );
+            rb = sqrt( V(k,b)[j]*V(k,b)[j] + V(k,b)[j+1]*V(k,b)[j+1] + V(k,b)[j+2]*V(k,b)[j+2] );
+            r  = sqrt( v[j]*v[j] + v[j+1]*v[j+1] + v[j+2]*v[j+2] );
+            if ( r > 0.0 ) {
+                r = ( ra + ( rb - ra )*(double)(iStep-a)/(double)(b-a) )/r;
+                v[j] *= r; v[j+1] *= r; v[j+2] *= r;
+            }
+        }
+        s = v;
+        Result = LGM_MEK_INTERPOLATED;
+    }
+
+    /*
+     *  What Lgm_ComputeLstarVersusPA() sets up before it gets going.
+     */
+    MagEphemInfo->Date   = Date;
+    MagEphemInfo->UTC    = UTC;
+    MagEphemInfo->nAlpha = nAlpha;
+    MagEphemInfo->P      = *u;
+    MagEphemInfo->LstarInfo->mInfo->Bfield( u, &Bvec, MagEphemInfo->LstarInfo->mInfo );
+    MagEphemInfo->B      = Lgm_Magnitude( &Bvec );
+    for ( i=0; i<nAlpha; i++ ) {
+        MagEphemInfo->Alpha[i] = Alpha[i];
+        sa = sin( Alpha[i]*RadPerDeg );
+        MagEphemInfo->Bm[i] = MagEphemInfo->B/(sa*sa);
+    }
+
+    /*
+     *  And its results.
+     */
+    MagEphemInfo->FieldLineType = k->FieldLineType[a];
+    MagEphemInfo->Pmin.x = s[0]; MagEphemInfo->Pmin.y = s[1]; MagEphemInfo->Pmin.z = s[2];
+    MagEphemInfo->Ellipsoid_Footprint_Pn.x = s[3]; MagEphemInfo->Ellipsoid_Footprint_Pn.y = s[4]; MagEphemInfo->Ellipsoid_Footprint_Pn.z = s[5];
+    MagEphemInfo->Ellipsoid_Footprint_Ps.x = s[6]; MagEphemInfo->Ellipsoid_Footprint_Ps.y = s[7]; MagEphemInfo->Ellipsoid_Footprint_Ps.z = s[8];
+    MagEphemInfo->Snorth  = s[9];
+    MagEphemInfo->Ssouth  = s[10];
+    MagEphemInfo->Smin    = s[11];
+    MagEphemInfo->Bmin    = s[12];
+    MagEphemInfo->Sb0     = s[13];
+    MagEphemInfo->d2B_ds2 = s[14];
+    MagEphemInfo->RofC    = s[15];
+    MagEphemInfo->Mref    = s[16];
+    MagEphemInfo->Mcurr   = s[17];
+    MagEphemInfo->Mused   = s[18];
+    for ( i=0; i<nAlpha; i++ ) {
+        MagEphemInfo->Lstar[i]          = s[LGM_MEK_NSCALAR + LGM_MEK_NPA*i    ];
+        MagEphemInfo->I[i]              = s[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 1];
+        MagEphemInfo->K[i]              = s[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 2];
+        MagEphemInfo->Sb[i]             = s[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 3];
+        MagEphemInfo->Tb[i]             = s[LGM_MEK_NSCALAR + LGM_MEK_NPA*i + 4];
+        MagEphemInfo->DriftOrbitType[i] = k->DriftOrbitType[ a*k->nAlpha + i ];
+        MagEphemInfo->LstarApprox[i]    = FALSE;
+        MagEphemInfo->nShellPoints[i]   = 0;
+    }
+
+    return( Result );
+
+}
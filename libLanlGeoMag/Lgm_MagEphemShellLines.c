@@ -0,0 +1,266 @@
+/*! \file Lgm_MagEphemShellLines.c
+ *
+ *  \brief Storage of the drift shell field lines in a Lgm_MagEphemInfo.
+ *
+ *  \details
+ *      For every pitch angle, Lgm_ComputeLstarVersusPA() can keep the drift
+ *      shell (its footpoints, mirror points, I's, ... and the field lines
+ *      themselves). Held as fixed size [PitchAngle][FieldLine][1000] double
+ *      arrays the lines alone come to about a GB for 90 pitch angles, and
+ *      nearly all of it is empty or redundant (the points are as close
+ *      together as the tracer needed them to be, not as close as anyone
+ *      needs to look at them). So the Shell* arrays are only allocated when
+ *      Lgm_ComputeLstarVersusPA() is asked to save the shells (SaveShellLines)
+ *      and the lines are kept:
+ *
+ *          - decimated with the Douglas-Peucker algorithm (in 3D), so that
+ *            no point of the full line is more than ShellLineTol from the
+ *            kept one,
+ *          - as floats, and
+ *          - packed one after the other for each pitch angle, with
+ *            ShellLineOffset[][] saying where each one starts.
+ *
+ *      That takes the shell lines down to a few MB.
+ *
+ */
+#include "Lgm/Lgm_MagEphemInfo.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+
+
+/*
+ *  Allocate the Shell* arrays, nMinima, nMaxima and the shell line index
+ *  arrays for nAllocedAlpha pitch angles. Does nothing if they are already
+ *  there. The packed line arrays themselves are grown as needed by
+ *  Lgm_MagEphemInfo_PutShellLines().
+ */
+void Lgm_MagEphemInfo_AllocShellArrays( Lgm_MagEphemInfo *m ) {
+
+    int     nPA = m->nAllocedAlpha;
+
+    if ( m->ShellI != NULL ) return;
+
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Pn, nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Sn, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Bn, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Ps, nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Ss, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellSphericalFootprint_Bs, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Ps, nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Ss, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Bs, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Pn, nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Sn, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellEllipsoidFootprint_Bn, nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellMirror_Pn,             nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellMirror_Sn,             nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->ShellMirror_Ps,             nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->ShellMirror_Ss,             nPA, LGM_LSTARINFO_MAX_FL, double );
+    LGM_ARRAY_2D( m->Shell_Bmin,                 nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->Shell_Pmin,                 nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->Shell_GradI,                nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->Shell_Vgc,                  nPA, LGM_LSTARINFO_MAX_FL, Lgm_Vector );
+    LGM_ARRAY_2D( m->nMinima,                    nPA, LGM_LSTARINFO_MAX_FL, int );
+    LGM_ARRAY_2D( m->nMaxima,                    nPA, LGM_LSTARINFO_MAX_FL, int );
+
+    LGM_ARRAY_2D( m->nFieldPnts,                 nPA, LGM_LSTARINFO_MAX_FL, int );
+    LGM_ARRAY_2D( m->ShellLineOffset,            nPA, LGM_LSTARINFO_MAX_FL, int );
+    LGM_ARRAY_1D( m->nShellLinePntsAlloced,      nPA, int );
+    m->s_gsm = (float **)calloc( nPA, sizeof(float *) );
+    m->Bmag  = (float **)calloc( nPA, sizeof(float *) );
+    m->x_gsm = (float **)calloc( nPA, sizeof(float *) );
+    m->y_gsm = (float **)calloc( nPA, sizeof(float *) );
+    m->z_gsm = (float **)calloc( nPA, sizeof(float *) );
+
+    // this one goes last (its the one that says the rest are there)
+    LGM_ARRAY_2D( m->ShellI,                     nPA, LGM_LSTARINFO_MAX_FL, double );
+
+}
+
+
+/*
+ *  Free what Lgm_MagEphemInfo_AllocShellArrays() (and
+ *  Lgm_MagEphemInfo_PutShellLines()) allocated. Arrays that arent there are
+ *  skipped.
+ */
+#define SHELL_2D_FREE( p ) { if ( (p) != NULL ) { LGM_ARRAY_2D_FREE( (p) ); (p) = NULL; } }
+void Lgm_MagEphemInfo_FreeShellArrays( Lgm_MagEphemInfo *m ) {
+
+    int     i;
+
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Pn );
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Sn );
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Bn );
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Ps );
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Ss );
+    SHELL_2D_FREE( m->ShellSphericalFootprint_Bs );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Ps );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Ss );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Bs );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Pn );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Sn );
+    SHELL_2D_FREE( m->ShellEllipsoidFootprint_Bn );
+    SHELL_2D_FREE( m->ShellMirror_Pn );
+    SHELL_2D_FREE( m->ShellMirror_Sn );
+    SHELL_2D_FREE( m->ShellMirror_Ps );
+    SHELL_2D_FREE( m->ShellMirror_Ss );
+    SHELL_2D_FREE( m->ShellI );
+    SHELL_2D_FREE( m->Shell_Bmin );
+    SHELL_2D_FREE( m->Shell_Pmin );
+    SHELL_2D_FREE( m->Shell_GradI );
+    SHELL_2D_FREE( m->Shell_Vgc );
+    SHELL_2D_FREE( m->nMinima );
+    SHELL_2D_FREE( m->nMaxima );
+
+    SHELL_2D_FREE( m->nFieldPnts );
+    SHELL_2D_FREE( m->ShellLineOffset );
+    if ( m->s_gsm != NULL ) {
+        for ( i=0; i<m->nAllocedAlpha; i++ ) {
+            free( m->s_gsm[i] ); free( m->Bmag[i] );
+            free( m->x_gsm[i] ); free( m->y_gsm[i] ); free( m->z_gsm[i] );
+        }
+    }
+    free( m->s_gsm ); free( m->Bmag ); free( m->x_gsm ); free( m->y_gsm ); free( m->z_gsm );
+    free( m->nShellLinePntsAlloced );
+    m->s_gsm = m->Bmag = m->x_gsm = m->y_gsm = m->z_gsm = NULL;
+    m->nShellLinePntsAlloced = NULL;
+
+}
+
+
+/*
+ *  Douglas-Peucker decimation of the n point line (x[], y[], z[]) in 3D.
+ *  The indices of the points kept (always including the two ends, in
+ *  order) go into Keep[] (which needs room for n) and the number of them is
+ *  returned. Every point dropped is within Tol of the segment between the
+ *  kept points on either side of it. Tol <= 0 keeps every point.
+ *
+ *  The usual recursion (split at the farthest point from the chord of a
+ *  piece if it is farther than Tol) is done with a stack of pieces, and
+ *  Stack[] needs room for n ints as well.
+ */
+int Lgm_DouglasPeucker3D( int n, double *x, double *y, double *z, double Tol, int *Keep, int *Stack ) {
+
+    int     i, i0, i1, iMax, nKeep, nStack, *Flag;
+    double  dx, dy, dz, L2, t, ex, ey, ez, d2, d2Max, Tol2;
+
+    if ( n <= 2 || Tol <= 0.0 ) {
+        for ( i=0; i<n; i++ ) Keep[i] = i;
+        return( n );
+    }
+
+    /*
+     *  Keep[] doubles as the flags of the points kept until the end.
+     */
+    Flag = Keep;
+    for ( i=0; i<n; i++ ) Flag[i] = 0;
+    Flag[0] = Flag[n-1] = 1;
+    Tol2 = Tol*Tol;
+
+    nStack = 0;
+    Stack[nStack++] = 0; Stack[nStack++] = n-1;
+    while ( nStack > 0 ) {
+
+        i1 = Stack[--nStack]; i0 = Stack[--nStack];
+
+        dx = x[i1]-x[i0]; dy = y[i1]-y[i0]; dz = z[i1]-z[i0];
+        L2 = dx*dx + dy*dy + dz*dz;
+
+        d2Max = -1.0; iMax = -1;
+        for ( i=i0+1; i<i1; i++ ) {
+            // distance to the segment (not the line through it)
+            t = ( L2 > 0.0 ) ? ( (x[i]-x[i0])*dx + (y[i]-y[i0])*dy + (z[i]-z[i0])*dz )/L2 : 0.0;
+            if ( t < 0.0 ) t = 0.0; else if ( t > 1.0 ) t = 1.0;
+            ex = x[i0] + t*dx - x[i]; ey = y[i0] + t*dy - y[i]; ez = z[i0] + t*dz - z[i];
+            d2 = ex*ex + ey*ey + ez*ez;
+            if ( d2 > d2Max ) { d2Max = d2; iMax = i; }
+        }
+
+        if ( d2Max > Tol2 ) {
+            Flag[iMax] = 1;
+            // each piece pushed has at least one interior point, so there are never more than n entries
+            if ( iMax - i0 > 1 ) { Stack[nStack++] = i0;   Stack[nStack++] = iMax; }
+            if ( i1 - iMax > 1 ) { Stack[nStack++] = iMax; Stack[nStack++] = i1;   }
+        }
+
+    }
+
+    for ( nKeep=0, i=0; i<n; i++ ) if ( Flag[i] ) Keep[nKeep++] = i;
+
+    return( nKeep );
+
+}
+
+
+/*
+ *  Copy the shell lines that Lstar() saved in LstarInfo into pitch angle i
+ *  of m, decimated to m->ShellLineTol and packed into the float arrays.
+ *  Different pitch angles dont share anything here, so the pitch angle
+ *  tasks of Lgm_ComputeLstarVersusPA() can do this at the same time.
+ *  Returns the total number of points kept, or -1 if memory ran out.
+ */
+int Lgm_MagEphemInfo_PutShellLines( int i, Lgm_LstarInfo *LstarInfo, Lgm_MagEphemInfo *m ) {
+
+    int     nn, tk, n, nKeep, nTotal, nNeed, *Keep, *Stack;
+    float   *p;
+
+    if ( ( m->ShellI == NULL ) || ( i < 0 ) || ( i >= m->nAllocedAlpha ) ) return( 0 );
+
+    Keep  = (int *)malloc( 2*1000*sizeof(int) );
+    if ( Keep == NULL ) return( -1 );
+    Stack = Keep + 1000;
+
+    nTotal = 0;
+    for ( nn=0; nn<LstarInfo->nPnts; nn++ ) {
+
+        n = ( LstarInfo->s_gsm != NULL ) ? LstarInfo->nFieldPnts[nn] : 0;
+        if ( n > 1000 ) n = 1000;
+        nKeep = ( n > 0 ) ? Lgm_DouglasPeucker3D( n, LstarInfo->x_gsm[nn], LstarInfo->y_gsm[nn], LstarInfo->z_gsm[nn], m->ShellLineTol, Keep, Stack ) : 0;
+
+        /*
+         *  Make room (grow by half again, so a whole shell only takes a few
+         *  reallocs).
+         */
+        nNeed = nTotal + nKeep;
+        if ( nNeed > m->nShellLinePntsAlloced[i] ) {
+            nNeed += nNeed/2;
+            if ( ( p = (float *)realloc( m->s_gsm[i], nNeed*sizeof(float) ) ) == NULL ) { free( Keep ); return( -1 ); } m->s_gsm[i] = p;
+            if ( ( p = (float *)realloc( m->Bmag[i],  nNeed*sizeof(float) ) ) == NULL ) { free( Keep ); return( -1 ); } m->Bmag[i]  = p;
+            if ( ( p = (float *)realloc( m->x_gsm[i], nNeed*sizeof(float) ) ) == NULL ) { free( Keep ); return( -1 ); } m->x_gsm[i] = p;
+            if ( ( p = (float *)realloc( m->y_gsm[i], nNeed*sizeof(float) ) ) == NULL ) { free( Keep ); return( -1 ); } m->y_gsm[i] = p;
+            if ( ( p = (float *)realloc( m->z_gsm[i], nNeed*sizeof(float) ) ) == NULL ) { free( Keep ); return( -1 ); } m->z_gsm[i] = p;
+            m->nShellLinePntsAlloced[i] = nNeed;
+        }
+
+        m->ShellLineOffset[i][nn] = nTotal;
+        m->nFieldPnts[i][nn]      = nKeep;
+        for ( tk=0; tk<nKeep; tk++ ) {
+            m->s_gsm[i][nTotal+tk] = (float)LstarInfo->s_gsm[nn][ Keep[tk] ];
+            m->Bmag[i][nTotal+tk]  = (float)LstarInfo->Bmag[nn][ Keep[tk] ];
+            m->x_gsm[i][nTotal+tk] = (float)LstarInfo->x_gsm[nn][ Keep[tk] ];
+            m->y_gsm[i][nTotal+tk] = (float)LstarInfo->y_gsm[nn][ Keep[tk] ];
+            m->z_gsm[i][nTotal+tk] = (float)LstarInfo->z_gsm[nn][ Keep[tk] ];
+        }
+        nTotal += nKeep;
+
+    }
+
+    free( Keep );
+
+    return( nTotal );
+
+}
+
+
+/*
+ *  The number of shell line points held for pitch angle i (i.e. how many of
+ *  s_gsm[i][], Bmag[i][], ... are in use).
+ */
+int Lgm_MagEphemInfo_nShellLinePnts( int i, Lgm_MagEphemInfo *m ) {
+
+    int n;
+
+    if ( ( m->ShellI == NULL ) || ( m->nShellPoints[i] <= 0 ) ) return( 0 );
+    n = m->nShellPoints[i] - 1;
+    return( m->ShellLineOffset[i][n] + m->nFieldPnts[i][n] );
+
+}
@@ -3,6 +3,7 @@
 #endif
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_MagEphemInfo.h"
+#include "Lgm/Lgm_Profile.h"
 #include "Lgm/Lgm_IGRF.h"
 
 #ifndef LGM_INDEX_DATA_DIR
@@ -71,10 +72,10 @@ void Lgm_WriteMagEphemHeader( FILE *fp, char *CodeVersion, char *ExtModel, int S
 
         fprintf( fp, "#                              \"VALUES\": [ ");
         for (i=0; i<nAscend-1; i++) {
-            Lgm_DateTimeToString( IsoTimeString, &Ascend_UTC[i], 0, 3 );
+            Lgm_DateTimeToIsoString( IsoTimeString, &Ascend_UTC[i], 3 );
             fprintf(fp, "\"%s\", ", IsoTimeString );
         }
-        Lgm_DateTimeToString( IsoTimeString, &Ascend_UTC[i], 0, 3 );
+        Lgm_DateTimeToIsoString( IsoTimeString, &Ascend_UTC[i], 3 );
         fprintf(fp, "\"%s\" ],\n", IsoTimeString ); 
 
 
@@ -122,10 +123,10 @@ void Lgm_WriteMagEphemHeader( FILE *fp, char *CodeVersion, char *ExtModel, int S
 
         fprintf( fp, "#                             \"VALUES\": [ ");
         for (i=0; i<nPerigee-1; i++) {
-            Lgm_DateTimeToString( IsoTimeString, &Perigee_UTC[i], 0, 3 );
+            Lgm_DateTimeToIsoString( IsoTimeString, &Perigee_UTC[i], 3 );
             fprintf(fp, "\"%s\", ", IsoTimeString );
         }
-        Lgm_DateTimeToString( IsoTimeString, &Perigee_UTC[i], 0, 3 );
+        Lgm_DateTimeToIsoString( IsoTimeString, &Perigee_UTC[i], 3 );
         fprintf(fp, "\"%s\" ],\n", IsoTimeString ); 
 
 
@@ -174,10 +175,10 @@ void Lgm_WriteMagEphemHeader( FILE *fp, char *CodeVersion, char *ExtModel, int S
 
         fprintf( fp, "#                             \"VALUES\": [ ");
         for (i=0; i<nApogee-1; i++) {
-            Lgm_DateTimeToString( IsoTimeString, &Apogee_UTC[i], 0, 3 );
+            Lgm_DateTimeToIsoString( IsoTimeString, &Apogee_UTC[i], 3 );
             fprintf(fp, "\"%s\", ", IsoTimeString );
         }
-        Lgm_DateTimeToString( IsoTimeString, &Apogee_UTC[i], 0, 3 );
+        Lgm_DateTimeToIsoString( IsoTimeString, &Apogee_UTC[i], 3 );
         fprintf(fp, "\"%s\" ],\n", IsoTimeString ); 
 
 
@@ -2013,10 +2014,230 @@ void Lgm_WriteMagEphemHeader( FILE *fp, char *CodeVersion, char *ExtModel, int S
 }
 
 
-void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp, double Dst, Lgm_MagEphemInfo *m ){
+/*
+ *  Lgm_WriteMagEphemData() builds each row in a line buffer with the routines
+ *  below and writes it out with a single fwrite(). Each Put_*() appends a
+ *  blank followed by one field and gives exactly what fprintf() gives for
+ *  the corresponding format (" %W.Pf", " %Wg", " %Wd" and " %Ws"), but
+ *  without interpreting a format string for every field.
+ *
+ *  The rounding of doubles is done by scaling with powers of ten. The
+ *  scaled value is then within a few ulps of the exact one, so the rounding
+ *  (and hence the digits) is the same as printf's unless the value lies
+ *  right at a rounding tie; in that case (and for NaN, Inf or values out of
+ *  range) the field is handed to snprintf() instead.
+ */
+typedef struct MagEphemLineBuf {
+    char    *Buf;
+    size_t  n;
+    size_t  Size;
+    int     Failed;     // ran out of memory -- the row is dropped
+} MagEphemLineBuf;
+
+static const double             MagEphem_Pow10[]  = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+static const unsigned long long MagEphem_iPow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+                                                      10000000ULL, 100000000ULL, 1000000000ULL };
+
+/*
+ *  Make room for n more chars (plus a '\0'). Returns FALSE (and leaves the
+ *  buffer as it was) if it cant.
+ */
+static int LineBuf_Reserve( MagEphemLineBuf *b, size_t n ) {
+    char    *p;
+    size_t  Size;
+    if ( b->Failed ) return( FALSE );
+    if ( b->n + n + 1 > b->Size ) {
+        Size = 2*b->Size + n + 1;
+        if ( (p = (char *)realloc( b->Buf, Size )) == NULL ) {
+            b->Failed = TRUE;
+            return( FALSE );
+        }
+        b->Buf  = p;
+        b->Size = Size;
+    }
+    return( TRUE );
+}
+
+/*
+ *  x*10^k. The powers up to 1e22 are exact; past that the scaling is done in
+ *  steps of 1e22 (each adds at most an ulp or so of error).
+ */
+static double Scale10( double x, int k ) {
+    while ( k > 22 )  { x *= 1e22; k -= 22; }
+    while ( k < -22 ) { x /= 1e22; k += 22; }
+    return( ( k >= 0 ) ? x*MagEphem_Pow10[k] : x/MagEphem_Pow10[-k] );
+}
+
+/*
+ *  Round y (>= 0, < 1e15) to the nearest integer. Returns FALSE if y is too
+ *  close to a tie to be sure which way the exact value rounds.
+ */
+static int RoundScaled( double y, unsigned long long *n ) {
+    double  f, fl;
+    fl = floor( y );
+    f  = y - fl;
+    if ( fabs( f - 0.5 ) <= 1e-14*y ) return( FALSE );
+    *n = (unsigned long long)fl + ( (f > 0.5) ? 1 : 0 );
+    return( TRUE );
+}
+
+/*
+ *  Append the characters s[0..len-1] right-justified in a field of Width.
+ */
+static void Put_Field( MagEphemLineBuf *b, int Width, const char *s, int len ) {
+    char    *p;
+    if ( !LineBuf_Reserve( b, Width + len + 1 ) ) return;
+    p = b->Buf + b->n;
+    *p++ = ' ';
+    while ( Width-- > len ) *p++ = ' ';
+    memcpy( p, s, len ); p += len;
+    b->n = p - b->Buf;
+}
+
+static void Put_Raw( MagEphemLineBuf *b, const char *s ) {
+    size_t  len = strlen( s );
+    if ( !LineBuf_Reserve( b, len ) ) return;
+    memcpy( b->Buf + b->n, s, len );
+    b->n += len;
+}
+
+static void Put_s( MagEphemLineBuf *b, int Width, const char *s ) {
+    Put_Field( b, Width, s, strlen( s ) );
+}
+
+static void Put_d( MagEphemLineBuf *b, int Width, long int x ) {
+    char                Str[32], *p = Str + sizeof(Str);
+    unsigned long int   u = ( x < 0 ) ? -(unsigned long int)x : (unsigned long int)x;
+    do { *--p = '0' + u%10; u /= 10; } while ( u );
+    if ( x < 0 ) *--p = '-';
+    Put_Field( b, Width, p, Str + sizeof(Str) - p );
+}
+
+/*
+ *  Same as fprintf( fp, " %*.*f", Width, Prec, x ) (for Prec <= 9).
+ */
+static void Put_f( MagEphemLineBuf *b, int Width, int Prec, double x ) {
+    char                Str[40], *p = Str + sizeof(Str);
+    double              y;
+    unsigned long long  n, ip, fp;
+    int                 i, len;
+
+    y = fabs( x )*MagEphem_Pow10[Prec];
+    if ( !isfinite( x ) || ( y >= 1e15 ) || !RoundScaled( y, &n ) ) {
+        len = snprintf( NULL, 0, " %*.*f", Width, Prec, x );
+        if ( !LineBuf_Reserve( b, len ) ) return;
+        b->n += snprintf( b->Buf + b->n, len+1, " %*.*f", Width, Prec, x );
+        return;
+    }
+
+    ip = n / MagEphem_iPow10[Prec];
+    fp = n % MagEphem_iPow10[Prec];
+    if ( Prec > 0 ) {
+        for ( i=0; i<Prec; i++ ) { *--p = '0' + fp%10; fp /= 10; }
+        *--p = '.';
+    }
+    do { *--p = '0' + ip%10; ip /= 10; } while ( ip );
+    if ( signbit( x ) ) *--p = '-';
+    Put_Field( b, Width, p, Str + sizeof(Str) - p );
+}
+
+/*
+ *  Same as fprintf( fp, " %*g", Width, x ). I.e. 6 significant digits, in
+ *  the shorter of the plain and exponential styles, with trailing zeros
+ *  removed.
+ */
+static void Put_g( MagEphemLineBuf *b, int Width, double x ) {
+    char                Str[40], D[6], *p = Str;
+    double              ax, y = 0.0;
+    unsigned long long  n;
+    int                 i, e, nd, len;
+
+    ax = fabs( x );
+    if ( ax == 0.0 ) {
+        Put_Field( b, Width, signbit( x ) ? "-0" : "0", signbit( x ) ? 2 : 1 );
+        return;
+    }
+
+    if ( isfinite( x ) && ( ax > 1e-300 ) && ( ax < 1e300 ) ) {
+        e = (int)floor( log10( ax ) );
+        y = Scale10( ax, 5-e );
+        if ( y < 1e5 )       { --e; y = Scale10( ax, 5-e ); }
+        else if ( y >= 1e6 ) { ++e; y = Scale10( ax, 5-e ); }
+    }
+    if ( !isfinite( x ) || ( ax <= 1e-300 ) || ( ax >= 1e300 ) || ( y < 1e5 ) || ( y >= 1e6 ) || !RoundScaled( y, &n ) ) {
+        len = snprintf( NULL, 0, " %*g", Width, x );
+        if ( !LineBuf_Reserve( b, len ) ) return;
+        b->n += snprintf( b->Buf + b->n, len+1, " %*g", Width, x );
+        return;
+    }
+    if ( n >= 1000000ULL ) { n /= 10; ++e; }
+
+    for ( i=5; i>=0; i-- ) { D[i] = '0' + n%10; n /= 10; }
+    for ( nd=6; D[nd-1] == '0'; nd-- ); // significant digits left once trailing zeros go
+
+    if ( signbit( x ) ) *p++ = '-';
+    if ( ( e < -4 ) || ( e >= 6 ) ) {
+        *p++ = D[0];
+        if ( nd > 1 ) { *p++ = '.'; for ( i=1; i<nd; i++ ) *p++ = D[i]; }
+        *p++ = 'e';
+        *p++ = ( e < 0 ) ? '-' : '+';
+        if ( e < 0 ) e = -e;
+        if ( e >= 100 ) *p++ = '0' + e/100;
+        *p++ = '0' + (e/10)%10;
+        *p++ = '0' + e%10;
+    } else if ( e >= 0 ) {
+        for ( i=0; i<=e; i++ ) *p++ = D[i];
+        if ( nd > e+1 ) { *p++ = '.'; for ( i=e+1; i<nd; i++ ) *p++ = D[i]; }
+    } else {
+        *p++ = '0'; *p++ = '.';
+        for ( i=-1; i>e; i-- ) *p++ = '0';
+        for ( i=0; i<nd; i++ ) *p++ = D[i];
+    }
+    Put_Field( b, Width, Str, p - Str );
+}
+
+/*
+ *  A single field the way Lgm_WriteMagEphemData() writes it, i.e. what
+ *  snprintf( Str, n, " %*.*f", Width, Prec, x ) (or " %*g") would give. These
+ *  are only here so that the formatters can be checked against printf
+ *  (tests/check_MagEphemWrite.c). Returns the length of the field, or -1 if
+ *  it couldnt be formatted.
+ */
+static int LineBuf_CopyOut( MagEphemLineBuf *b, char *Str, size_t n ) {
+    int len = ( b->Failed ) ? -1 : (int)b->n;
+    if ( ( len >= 0 ) && ( n > 0 ) ) {
+        if ( (size_t)len >= n ) b->n = n-1;
+        memcpy( Str, b->Buf, b->n ); Str[b->n] = '\0';
+    }
+    free( b->Buf );
+    return( len );
+}
+int Lgm_MagEphemFormat_f( char *Str, size_t n, int Width, int Prec, double x ) {
+    MagEphemLineBuf b = { NULL, 0, 0, FALSE };
+    Put_f( &b, Width, Prec, x );
+    return( LineBuf_CopyOut( &b, Str, n ) );
+}
+int Lgm_MagEphemFormat_g( char *Str, size_t n, int Width, double x ) {
+    MagEphemLineBuf b = { NULL, 0, 0, FALSE };
+    Put_g( &b, Width, x );
+    return( LineBuf_CopyOut( &b, Str, n ) );
+}
+
+
+static void Lgm_WriteMagEphemData_Body( FILE *fp, char *IntModel, char *ExtModel, double Kp, double Dst, Lgm_MagEphemInfo *m );
+void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp, double Dst, Lgm_MagEphemInfo *m ) {
+
+    LGM_PROFILE_BEGIN( LGM_PROF_IO );
+    Lgm_WriteMagEphemData_Body( fp, IntModel, ExtModel, Kp, Dst, m );
+    LGM_PROFILE_END( LGM_PROF_IO );
+
+}
+
+static void Lgm_WriteMagEphemData_Body( FILE *fp, char *IntModel, char *ExtModel, double Kp, double Dst, Lgm_MagEphemInfo *m ) {
 
     int             i;
-    char            Str[128];
+    char            *Str;
     double          GeodLat, GeodLong, GeodHeight, L;
     double          Bsc_mag, Bfn_mag, Bfs_mag, Bmin_mag, Alpha_Loss_Cone_n, Alpha_Loss_Cone_s;
     double          R, MLAT, MLON, MLT;
@@ -2025,202 +2246,213 @@ void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp,
     Lgm_DateTime    DT_UTC;
     Lgm_CTrans      *c = Lgm_init_ctrans(0);
     Lgm_Vector      v, vv, Bsc, Bfn, Bfn_geo, Bfs, Bfs_geo, Bmin;
+    MagEphemLineBuf b;
+
+    b.Size   = 4096 + 14*16*m->nAlpha; // room for the whole row (grows if needed)
+    b.Buf    = (char *)malloc( b.Size );
+    b.n      = 0;
+    b.Failed = FALSE;
+    if ( b.Buf == NULL ) {
+        fprintf( stderr, "Lgm_WriteMagEphemData: couldnt allocate a line buffer. Row not written.\n" );
+        Lgm_free_ctrans( c );
+        return;
+    }
 
     Lgm_Set_Coord_Transforms( m->Date, m->UTC, c );
     Lgm_Make_UTC( m->Date, m->UTC, &DT_UTC, c );
-    Lgm_DateTimeToString( Str, &DT_UTC, 0, 4 );
-    
+    Str = Lgm_IsoTimeFormatter_Put( &m->IsoTimeFmt, &DT_UTC, 4 );    // only the digits that changed since the last row get redone
 
-    fprintf( fp, "%25s",     Str );          // Date+Time in ISO 8601 format
-    fprintf( fp, "   %10ld", c->UTC.Date );  // Date
-    fprintf( fp, " %5d",     c->UTC.Doy );   // DOY
-    fprintf( fp, " %13.8lf", c->UTC.Time );  // UTC
-    fprintf( fp, " %16.8lf", c->UTC.JD );    // Julian Date
-    fprintf( fp, " %15.3lf", Lgm_UTC_to_GpsSeconds( &c->UTC, c ) ); // GpsTime
-    fprintf( fp, " %13.8lf", c->psi*DegPerRad ); // DipoleTiltAngle
-    fprintf( fp, " %11d", m->InOut );        // InOut
-    fprintf( fp, " %11d", m->OrbitNumber );        // InOut
+    while ( b.n < 25 - m->IsoTimeFmt.Len ) b.Buf[b.n++] = ' ';          // Date+Time in ISO 8601 format (%25s)
+    memcpy( b.Buf + b.n, Str, m->IsoTimeFmt.Len ); b.n += m->IsoTimeFmt.Len;
+    Put_Raw( &b, "  " ); Put_d( &b, 10, c->UTC.Date );                 // Date
+    Put_d( &b, 5, c->UTC.Doy );   // DOY
+    Put_f( &b, 13, 8, c->UTC.Time );  // UTC
+    Put_f( &b, 16, 8, c->UTC.JD );    // Julian Date
+    Put_f( &b, 15, 3, Lgm_UTC_to_GpsSeconds( &c->UTC, c ) ); // GpsTime
+    Put_f( &b, 13, 8, c->psi*DegPerRad ); // DipoleTiltAngle
+    Put_d( &b, 11, m->InOut );        // InOut
+    Put_d( &b, 11, m->OrbitNumber );        // InOut
 
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_GEO, c );
-    fprintf( fp, " %13.6lf", v.x );     // Xgeo
-    fprintf( fp, " %13.6lf", v.y );     // Ygeo
-    fprintf( fp, " %13.6lf", v.z );     // Zgeo
+    Put_f( &b, 13, 6, v.x );     // Xgeo
+    Put_f( &b, 13, 6, v.y );     // Ygeo
+    Put_f( &b, 13, 6, v.z );     // Zgeo
 
     Lgm_WGS84_to_GEOD( &v, &GeodLat, &GeodLong, &GeodHeight );
-    fprintf( fp, " %13.6lf", GeodLat );                // Geod Lat   of SC
-    fprintf( fp, " %13.6lf", GeodLong );               // Geod Long
-    fprintf( fp, " %13.4lf", GeodHeight );             // Geod Height
+    Put_f( &b, 13, 6, GeodLat );                // Geod Lat   of SC
+    Put_f( &b, 13, 6, GeodLong );               // Geod Long
+    Put_f( &b, 13, 4, GeodHeight );             // Geod Height
 
-    fprintf( fp, " %13.6lf", m->P.x );  // Xgsm
-    fprintf( fp, " %13.6lf", m->P.y );  // Ygsm
-    fprintf( fp, " %13.6lf", m->P.z );  // Zgsm
+    Put_f( &b, 13, 6, m->P.x );  // Xgsm
+    Put_f( &b, 13, 6, m->P.y );  // Ygsm
+    Put_f( &b, 13, 6, m->P.z );  // Zgsm
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_SM, c );
-    fprintf( fp, " %13.6lf", v.x );        // Xsm
-    fprintf( fp, " %13.6lf", v.y );        // Ysm
-    fprintf( fp, " %13.6lf", v.z );        // Zsm
+    Put_f( &b, 13, 6, v.x );        // Xsm
+    Put_f( &b, 13, 6, v.y );        // Ysm
+    Put_f( &b, 13, 6, v.z );        // Zsm
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_GEI2000, c );
-    fprintf( fp, " %13.6lf", v.x );        // Xgei
-    fprintf( fp, " %13.6lf", v.y );        // Ygei
-    fprintf( fp, " %13.6lf", v.z );        // Zgei
+    Put_f( &b, 13, 6, v.x );        // Xgei
+    Put_f( &b, 13, 6, v.y );        // Ygei
+    Put_f( &b, 13, 6, v.z );        // Zgei
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_GSE, c );
-    fprintf( fp, " %13.6lf", v.x );        // Xgse
-    fprintf( fp, " %13.6lf", v.y );        // Ygse
-    fprintf( fp, " %13.6lf", v.z );        // Zgse
+    Put_f( &b, 13, 6, v.x );        // Xgse
+    Put_f( &b, 13, 6, v.y );        // Ygse
+    Put_f( &b, 13, 6, v.z );        // Zgse
 
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_CDMAG, c );   // Convert to cartesian CDMAG coords.
     Lgm_CDMAG_to_R_MLAT_MLON_MLT( &v, &R, &MLAT, &MLON, &MLT, c );
-    fprintf( fp, " %13.6lf", MLAT );                    // CD MLAT
-    fprintf( fp, " %13.6lf", MLON );                    // CD MLON
-    fprintf( fp, " %13.6lf", MLT );                     // CD MLT
-    fprintf( fp, " %13.6lf", R );                       // CD R (since CDMAG is geocentric, this should be same as |v| )
+    Put_f( &b, 13, 6, MLAT );                    // CD MLAT
+    Put_f( &b, 13, 6, MLON );                    // CD MLON
+    Put_f( &b, 13, 6, MLT );                     // CD MLT
+    Put_f( &b, 13, 6, R );                       // CD R (since CDMAG is geocentric, this should be same as |v| )
 
     Lgm_Convert_Coords( &m->P, &v, GSM_TO_EDMAG, c );   // Convert to cartesian EDMAG coords.
     Lgm_EDMAG_to_R_MLAT_MLON_MLT( &v, &R, &MLAT, &MLON, &MLT, c );
-    fprintf( fp, " %13.6lf", MLAT );                    // ED MLAT
-    fprintf( fp, " %13.6lf", MLON );                    // ED MLON
-    fprintf( fp, " %13.6lf", MLT );                     // ED MLT
-    fprintf( fp, " %13.6lf", R );                       // ED R (since EDMAG is NOT geocentric, this should NOT be same as |v| (in general))
+    Put_f( &b, 13, 6, MLAT );                    // ED MLAT
+    Put_f( &b, 13, 6, MLON );                    // ED MLON
+    Put_f( &b, 13, 6, MLT );                     // ED MLT
+    Put_f( &b, 13, 6, R );                       // ED R (since EDMAG is NOT geocentric, this should NOT be same as |v| (in general))
 
 
 
     if ( !strcmp( ExtModel, "IGRF" ) || !strcmp( ExtModel, "CDIP" ) || !strcmp( ExtModel, "EDIP" ) ) {
         // If our "external model is just a dipole or igrf, then "internal doesnt really mean anything...)
-        fprintf( fp, " %14s", "N/A" );       // Int model is Not applicable
+        Put_s( &b, 14, "N/A" );       // Int model is Not applicable
     } else {
-        fprintf( fp, " %14s", IntModel );    // Int Model
+        Put_s( &b, 14, IntModel );    // Int Model
     }
-    fprintf( fp, " %14s", ExtModel );        // Ext Model
-    fprintf( fp, " %7.1f",  Kp );            // Kp
-    fprintf( fp, " %8.3lf",  Dst );             // Dst
+    Put_s( &b, 14, ExtModel );        // Ext Model
+    Put_f( &b, 7, 1, Kp );            // Kp
+    Put_f( &b, 8, 3, Dst );             // Dst
     
     m->LstarInfo->mInfo->Bfield( &m->P, &Bsc, m->LstarInfo->mInfo );
-    fprintf( fp, " %12g", Bsc.x );  // Bsc_x_gsm
-    fprintf( fp, " %12g", Bsc.y );  // Bsc_y_gsm
-    fprintf( fp, " %12g", Bsc.z );  // Bsc_z_gsm
-    fprintf( fp, " %12g", (Bsc_mag = Lgm_Magnitude( &Bsc )) );    // |B|
+    Put_g( &b, 12, Bsc.x );  // Bsc_x_gsm
+    Put_g( &b, 12, Bsc.y );  // Bsc_y_gsm
+    Put_g( &b, 12, Bsc.z );  // Bsc_z_gsm
+    Put_g( &b, 12, (Bsc_mag = Lgm_Magnitude( &Bsc )) );    // |B|
 
     switch ( m->FieldLineType ) {
         case LGM_OPEN_IMF:
-                            fprintf( fp, " %29s",  "LGM_OPEN_IMF" ); // FL Type
+                            Put_s( &b, 29, "LGM_OPEN_IMF" ); // FL Type
                             break;
         case LGM_CLOSED:
-                            fprintf( fp, " %29s",  "LGM_CLOSED" ); // FL Type
+                            Put_s( &b, 29, "LGM_CLOSED" ); // FL Type
                             break;
         case LGM_OPEN_N_LOBE:
-                            fprintf( fp, " %29s",  "LGM_OPEN_N_LOBE" ); // FL Type
+                            Put_s( &b, 29, "LGM_OPEN_N_LOBE" ); // FL Type
                             break;
         case LGM_OPEN_S_LOBE:
-                            fprintf( fp, " %29s",  "LGM_OPEN_S_LOBE" ); // FL Type
+                            Put_s( &b, 29, "LGM_OPEN_S_LOBE" ); // FL Type
                             break;
         case LGM_INSIDE_EARTH:
-                            fprintf( fp, " %29s",  "LGM_INSIDE_EARTH" ); // FL Type
+                            Put_s( &b, 29, "LGM_INSIDE_EARTH" ); // FL Type
                             break;
         case LGM_TARGET_HEIGHT_UNREACHABLE:
-                            fprintf( fp, " %29s",  "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
+                            Put_s( &b, 29, "LGM_TARGET_HEIGHT_UNREACHABLE" ); // FL Type
                             break;
         default:
-                            fprintf( fp, " %29s",  "UNKNOWN FIELD TYPE" ); // FL Type
+                            Put_s( &b, 29, "UNKNOWN FIELD TYPE" ); // FL Type
                             break;
     }
 
 
-    fprintf( fp, " %16g", (m->Snorth > 0.0) ? m->Snorth : LGM_FILL_VALUE ); // S_sc_to_pfn
-    fprintf( fp, " %16g", (m->Ssouth > 0.0) ? m->Ssouth : LGM_FILL_VALUE ); // S_sc_to_pfs
-    fprintf( fp, " %16g", (m->Smin > 0.0) ? m->Smin : LGM_FILL_VALUE ); // S_pfs_to_Bmin
+    Put_g( &b, 16, (m->Snorth > 0.0) ? m->Snorth : LGM_FILL_VALUE ); // S_sc_to_pfn
+    Put_g( &b, 16, (m->Ssouth > 0.0) ? m->Ssouth : LGM_FILL_VALUE ); // S_sc_to_pfs
+    Put_g( &b, 16, (m->Smin > 0.0) ? m->Smin : LGM_FILL_VALUE ); // S_pfs_to_Bmin
     S_Bmin_to_sc = ((m->Ssouth>0.0)&&(m->Smin > 0.0)) ? m->Ssouth-m->Smin : LGM_FILL_VALUE;
-    fprintf( fp, " %16g", S_Bmin_to_sc ); // S_Bmin_to_sc
-    fprintf( fp, " %16g", ((m->Snorth > 0.0)&&(m->Ssouth > 0.0)) ? m->Snorth + m->Ssouth : LGM_FILL_VALUE ); // S_total
+    Put_g( &b, 16, S_Bmin_to_sc ); // S_Bmin_to_sc
+    Put_g( &b, 16, ((m->Snorth > 0.0)&&(m->Ssouth > 0.0)) ? m->Snorth + m->Ssouth : LGM_FILL_VALUE ); // S_total
 
 
-    fprintf( fp, " %16g", m->d2B_ds2 ); // d2B_ds2
-    fprintf( fp, " %16g", m->Sb0 );     // Sb0
-    fprintf( fp, " %16g", m->RofC );    // Radius of curvature at Bmin point
+    Put_g( &b, 16, m->d2B_ds2 ); // d2B_ds2
+    Put_g( &b, 16, m->Sb0 );     // Sb0
+    Put_g( &b, 16, m->RofC );    // Radius of curvature at Bmin point
 
 
     if ( (m->FieldLineType == LGM_CLOSED) || (m->FieldLineType == LGM_OPEN_N_LOBE) ) {
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Pn, &v, GSM_TO_GEO, c );
-        fprintf( fp, " %12g", v.x );                    // Xgeo   North Foot
-        fprintf( fp, " %12g", v.y );                    // Ygeo
-        fprintf( fp, " %12g", v.z );                    // Zgeo
+        Put_g( &b, 12, v.x );                    // Xgeo   North Foot
+        Put_g( &b, 12, v.y );                    // Ygeo
+        Put_g( &b, 12, v.z );                    // Zgeo
 
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Pn.x );     // Xgsm   North Foot
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Pn.y );     // Ygsm
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Pn.z );     // Zgsm
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Pn.x );     // Xgsm   North Foot
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Pn.y );     // Ygsm
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Pn.z );     // Zgsm
 
         Lgm_WGS84_to_GEOD( &v, &GeodLat, &GeodLong, &GeodHeight );
-        fprintf( fp, " %12g", GeodLat );                // Geod Lat   North Foot
-        fprintf( fp, " %12g", GeodLong );               // Geod Long
-        fprintf( fp, " %12g", GeodHeight );             // Geod Height
+        Put_g( &b, 12, GeodLat );                // Geod Lat   North Foot
+        Put_g( &b, 12, GeodLong );               // Geod Long
+        Put_g( &b, 12, GeodHeight );             // Geod Height
 
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Pn, &vv, GSM_TO_CDMAG, c );   // Convert to cartesian CDMAG coords.
         Lgm_CDMAG_to_R_MLAT_MLON_MLT( &vv, &R, &MLAT, &MLON, &MLT, c );
-        fprintf( fp, " %12g", MLAT );                    // CD MLAT
-        fprintf( fp, " %12g", MLON );                    // CD MLON
-        fprintf( fp, " %12g", MLT );                     // CD MLT
+        Put_g( &b, 12, MLAT );                    // CD MLAT
+        Put_g( &b, 12, MLON );                    // CD MLON
+        Put_g( &b, 12, MLT );                     // CD MLT
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Pn, &vv, GSM_TO_EDMAG, c );   // Convert to cartesian EDMAG coords.
         Lgm_EDMAG_to_R_MLAT_MLON_MLT( &vv, &R, &MLAT, &MLON, &MLT, c );
-        fprintf( fp, " %12g", MLAT );                    // ED MLAT
-        fprintf( fp, " %12g", MLON );                    // ED MLON
-        fprintf( fp, " %12g", MLT );                     // ED MLT
+        Put_g( &b, 12, MLAT );                    // ED MLAT
+        Put_g( &b, 12, MLON );                    // ED MLON
+        Put_g( &b, 12, MLT );                     // ED MLT
 
 
         m->LstarInfo->mInfo->Bfield( &m->Ellipsoid_Footprint_Pn, &Bfn, m->LstarInfo->mInfo );
         Lgm_Convert_Coords( &Bfn, &Bfn_geo, GSM_TO_WGS84, c );
-        fprintf( fp, " %12g", Bfn_geo.x );                                  // Bfn_x_geo
-        fprintf( fp, " %12g", Bfn_geo.y );                                  // Bfn_y_geo
-        fprintf( fp, " %12g", Bfn_geo.z );                                  // Bfn_z_geo
-        fprintf( fp, " %12g", (Bfn_mag = Lgm_Magnitude( &Bfn_geo )) );      // |B|
+        Put_g( &b, 12, Bfn_geo.x );                                  // Bfn_x_geo
+        Put_g( &b, 12, Bfn_geo.y );                                  // Bfn_y_geo
+        Put_g( &b, 12, Bfn_geo.z );                                  // Bfn_z_geo
+        Put_g( &b, 12, (Bfn_mag = Lgm_Magnitude( &Bfn_geo )) );      // |B|
 
-        fprintf( fp, " %12g", Bfn.x );                                  // Bfn_x_gsm
-        fprintf( fp, " %12g", Bfn.y );                                  // Bfn_y_gsm
-        fprintf( fp, " %12g", Bfn.z );                                  // Bfn_z_gsm
-        fprintf( fp, " %12g", (Bfn_mag = Lgm_Magnitude( &Bfn )) );      // |B|
+        Put_g( &b, 12, Bfn.x );                                  // Bfn_x_gsm
+        Put_g( &b, 12, Bfn.y );                                  // Bfn_y_gsm
+        Put_g( &b, 12, Bfn.z );                                  // Bfn_z_gsm
+        Put_g( &b, 12, (Bfn_mag = Lgm_Magnitude( &Bfn )) );      // |B|
 
         Alpha_Loss_Cone_n = asin( sqrt( Bsc_mag/Bfn_mag ) )*DegPerRad;
-        fprintf( fp, " %12g", Alpha_Loss_Cone_n );                      // Northern Loss Cone Angle
+        Put_g( &b, 12, Alpha_Loss_Cone_n );                      // Northern Loss Cone Angle
 
 
     } else {
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE ); 
-        fprintf( fp, " %12g", LGM_FILL_VALUE ); 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE ); 
+        Put_g( &b, 12, LGM_FILL_VALUE ); 
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
     }
 
@@ -2228,130 +2460,131 @@ void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp,
     if ( (m->FieldLineType == LGM_CLOSED) || (m->FieldLineType == LGM_OPEN_S_LOBE) ) {
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Ps, &v, GSM_TO_GEO, c );
-        fprintf( fp, " %12g", v.x );                    // Xgeo   South Foot
-        fprintf( fp, " %12g", v.y );                    // Ygeo
-        fprintf( fp, " %12g", v.z );                    // Zgeo
+        Put_g( &b, 12, v.x );                    // Xgeo   South Foot
+        Put_g( &b, 12, v.y );                    // Ygeo
+        Put_g( &b, 12, v.z );                    // Zgeo
 
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Ps.x );     // Xgsm   South Foot
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Ps.y );     // Ygsm
-        fprintf( fp, " %12g", m->Ellipsoid_Footprint_Ps.z );     // Zgsm
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Ps.x );     // Xgsm   South Foot
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Ps.y );     // Ygsm
+        Put_g( &b, 12, m->Ellipsoid_Footprint_Ps.z );     // Zgsm
 
         Lgm_WGS84_to_GEOD( &v, &GeodLat, &GeodLong, &GeodHeight );
-        fprintf( fp, " %12g", GeodLat );                // Geod Lat   South Foot
-        fprintf( fp, " %12g", GeodLong );               // Geod Long
-        fprintf( fp, " %12g", GeodHeight );             // Geod Height
+        Put_g( &b, 12, GeodLat );                // Geod Lat   South Foot
+        Put_g( &b, 12, GeodLong );               // Geod Long
+        Put_g( &b, 12, GeodHeight );             // Geod Height
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Ps, &vv, GSM_TO_CDMAG, c );   // Convert to cartesian CDMAG coords.
         Lgm_CDMAG_to_R_MLAT_MLON_MLT( &vv, &R, &MLAT, &MLON, &MLT, c );
-        fprintf( fp, " %12g", MLAT );                    // CD MLAT
-        fprintf( fp, " %12g", MLON );                    // CD MLON
-        fprintf( fp, " %12g", MLT );                     // CD MLT
+        Put_g( &b, 12, MLAT );                    // CD MLAT
+        Put_g( &b, 12, MLON );                    // CD MLON
+        Put_g( &b, 12, MLT );                     // CD MLT
 
         Lgm_Convert_Coords( &m->Ellipsoid_Footprint_Ps, &vv, GSM_TO_EDMAG, c );   // Convert to cartesian EDMAG coords.
         Lgm_EDMAG_to_R_MLAT_MLON_MLT( &vv, &R, &MLAT, &MLON, &MLT, c );
-        fprintf( fp, " %12g", MLAT );                    // ED MLAT
-        fprintf( fp, " %12g", MLON );                    // ED MLON
-        fprintf( fp, " %12g", MLT );                     // ED MLT
+        Put_g( &b, 12, MLAT );                    // ED MLAT
+        Put_g( &b, 12, MLON );                    // ED MLON
+        Put_g( &b, 12, MLT );                     // ED MLT
 
         m->LstarInfo->mInfo->Bfield( &m->Ellipsoid_Footprint_Ps, &Bfs, m->LstarInfo->mInfo );
         Lgm_Convert_Coords( &Bfs, &Bfs_geo, GSM_TO_WGS84, c );
-        fprintf( fp, " %12g", Bfs_geo.x );                                  // Bfs_x_geo
-        fprintf( fp, " %12g", Bfs_geo.y );                                  // Bfs_y_geo
-        fprintf( fp, " %12g", Bfs_geo.z );                                  // Bfs_z_geo
-        fprintf( fp, " %12g", (Bfs_mag = Lgm_Magnitude( &Bfs_geo )) );      // |B|
+        Put_g( &b, 12, Bfs_geo.x );                                  // Bfs_x_geo
+        Put_g( &b, 12, Bfs_geo.y );                                  // Bfs_y_geo
+        Put_g( &b, 12, Bfs_geo.z );                                  // Bfs_z_geo
+        Put_g( &b, 12, (Bfs_mag = Lgm_Magnitude( &Bfs_geo )) );      // |B|
 
-        fprintf( fp, " %12g", Bfs.x );                                  // Bfs_x_gsm
-        fprintf( fp, " %12g", Bfs.y );                                  // Bfs_y_gsm
-        fprintf( fp, " %12g", Bfs.z );                                  // Bfs_z_gsm
-        fprintf( fp, " %12g", (Bfs_mag = Lgm_Magnitude( &Bfs )) );      // |B|
+        Put_g( &b, 12, Bfs.x );                                  // Bfs_x_gsm
+        Put_g( &b, 12, Bfs.y );                                  // Bfs_y_gsm
+        Put_g( &b, 12, Bfs.z );                                  // Bfs_z_gsm
+        Put_g( &b, 12, (Bfs_mag = Lgm_Magnitude( &Bfs )) );      // |B|
 
         Alpha_Loss_Cone_s = asin( sqrt( Bsc_mag/Bfs_mag ) )*DegPerRad;
-        fprintf( fp, " %12g", Alpha_Loss_Cone_s );                      // Southern Loss Cone Angle
+        Put_g( &b, 12, Alpha_Loss_Cone_s );                      // Southern Loss Cone Angle
 
 
     } else {
-        fprintf( fp, " %12g", LGM_FILL_VALUE ); 
-        fprintf( fp, " %12g", LGM_FILL_VALUE ); 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE ); 
+        Put_g( &b, 12, LGM_FILL_VALUE ); 
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
 
     }
 
     
 
     if ( m->FieldLineType == LGM_CLOSED ) {
-        fprintf( fp, " %12g", m->Pmin.x );          // Xgsm  Pmin
-        fprintf( fp, " %12g", m->Pmin.y );          // Ygsm
-        fprintf( fp, " %12g", m->Pmin.z );          // Zgsm
+        Put_g( &b, 12, m->Pmin.x );          // Xgsm  Pmin
+        Put_g( &b, 12, m->Pmin.y );          // Ygsm
+        Put_g( &b, 12, m->Pmin.z );          // Zgsm
 
         m->LstarInfo->mInfo->Bfield( &m->Pmin, &Bmin, m->LstarInfo->mInfo );
-        fprintf( fp, " %12g", Bmin.x );  // Bmin_x_gsm
-        fprintf( fp, " %12g", Bmin.y );  // Bmin_y_gsm
-        fprintf( fp, " %12g", Bmin.z );  // Bmin_z_gsm
-        fprintf( fp, " %12g", (Bmin_mag = Lgm_Magnitude( &Bmin )) );    // |B|
+        Put_g( &b, 12, Bmin.x );  // Bmin_x_gsm
+        Put_g( &b, 12, Bmin.y );  // Bmin_y_gsm
+        Put_g( &b, 12, Bmin.z );  // Bmin_z_gsm
+        Put_g( &b, 12, (Bmin_mag = Lgm_Magnitude( &Bmin )) );    // |B|
     } else {
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
-        fprintf( fp, " %12g", LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Put_g( &b, 12, LGM_FILL_VALUE );
+        Bmin_mag = LGM_FILL_VALUE;
     }
 
     Lsimple = (Bmin_mag > 0.0) ? Lgm_Magnitude( &m->Pmin ) : LGM_FILL_VALUE;
-    fprintf( fp, " %12g", Lsimple );      // Lsimple (equatorial distance to Bmin point)
+    Put_g( &b, 12, Lsimple );      // Lsimple (equatorial distance to Bmin point)
     if (Lsimple > 0.0) {
         InvLat = DegPerRad*acos(sqrt(1.0/Lsimple));
         //if (S_Bmin_to_sc<0.0) InvLat *= -1.0;
     } else {
         InvLat = LGM_FILL_VALUE;
     }
-    fprintf( fp, " %12g", InvLat );   // InvLat
+    Put_g( &b, 12, InvLat );   // InvLat
 
 
     
     Lm_eq = (Bmin_mag > 0.0) ? LFromIBmM_McIlwain( 0.0, Bmin_mag, m->Mcurr ) : LGM_FILL_VALUE;
-    fprintf( fp, " %12g", Lm_eq );      // Lm_eq
+    Put_g( &b, 12, Lm_eq );      // Lm_eq
     if (Lm_eq > 0.0) {
         InvLat_eq = DegPerRad*acos(sqrt(1.0/Lm_eq));
         //if (S_Bmin_to_sc<0.0) InvLat_eq *= -1.0;
     } else {
         InvLat_eq = LGM_FILL_VALUE;
     }
-    fprintf( fp, " %12g", InvLat_eq );   // InvLat_eq
+    Put_g( &b, 12, InvLat_eq );   // InvLat_eq
 
     
     BoverBeq = ( Bmin_mag > 0.0) ? Bsc_mag / Bmin_mag : LGM_FILL_VALUE;
-    fprintf( fp, " %12g", BoverBeq );   // BoverBeq
+    Put_g( &b, 12, BoverBeq );   // BoverBeq
 
     
     
@@ -2373,66 +2606,66 @@ void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp,
     } else {
         MagLatFromBoverBeq = LGM_FILL_VALUE;
     }
-    fprintf( fp, " %12g", MagLatFromBoverBeq );   // MagLatFromBoverBeq
+    Put_g( &b, 12, MagLatFromBoverBeq );   // MagLatFromBoverBeq
 
 
-    fprintf( fp, " %12g", m->Mused );   // M_Used
-    fprintf( fp, " %12g", m->Mref );    // M_Ref
-    fprintf( fp, " %12g", m->Mcurr );   // M_IGRF
+    Put_g( &b, 12, m->Mused );   // M_Used
+    Put_g( &b, 12, m->Mref );    // M_Ref
+    Put_g( &b, 12, m->Mcurr );   // M_IGRF
 
 
     // Hmin's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Hmin[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Hmin[i] ); }
 
     // Hmin_GeodLat's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Hmin_GeodLat[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Hmin_GeodLat[i] ); }
 
     // Hmin_GeodLon's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Hmin_GeodLon[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Hmin_GeodLon[i] ); }
 
 
     // L*'s
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Lstar[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Lstar[i] ); }
 
     // Drift Shell Types
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12d", m->DriftOrbitType[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_d( &b, 12, m->DriftOrbitType[i] ); }
 
     // McIlwain L (computed from I, Bm, M)
-    fprintf(fp, "    ");
+    Put_Raw( &b, "    " );
     for (i=0; i<m->nAlpha; i++) { 
         L = ( m->I[i] >= 0.0 ) ? LFromIBmM_McIlwain(m->I[i], m->Bm[i], m->Mused ) : LGM_FILL_VALUE;
-        fprintf(fp, " %12g", L);
+        Put_g( &b, 12, L );
     }
 
     // Bms's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Bm[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Bm[i] ); }
 
     // I's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->I[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->I[i] ); }
 
     // K's
-    fprintf(fp, "    ");
+    Put_Raw( &b, "    " );
     for (i=0; i<m->nAlpha; i++) { 
         if ( (m->I[i] > 0.0) && (m->Bm[i] > 0.0) ) {
-            fprintf(fp, " %12g", m->I[i]*sqrt(m->Bm[i]*1e-5) ); 
+            Put_g( &b, 12, m->I[i]*sqrt(m->Bm[i]*1e-5) ); 
         } else {
-            fprintf(fp, " %12g", LGM_FILL_VALUE ); 
+            Put_g( &b, 12, LGM_FILL_VALUE ); 
         }
     }
 
     // Sb's
-    fprintf(fp, "    ");
-    for (i=0; i<m->nAlpha; i++) { fprintf(fp, " %12g", m->Sb[i] ); }
+    Put_Raw( &b, "    " );
+    for (i=0; i<m->nAlpha; i++) { Put_g( &b, 12, m->Sb[i] ); }
 
     // Tb's
-    fprintf(fp, "    ");
+    Put_Raw( &b, "    " );
     for (i=0; i<m->nAlpha; i++) { 
 
 
@@ -2445,11 +2678,11 @@ void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp,
         vel  /= (Re*1000.0); // Re/s
         T     = ( m->Sb[i] > 0.0 ) ? 2.0*m->Sb[i]/vel : LGM_FILL_VALUE;
 
-        fprintf(fp, " %12g", T ); 
+        Put_g( &b, 12, T ); 
     }
 
     // Kappa's
-    fprintf(fp, "    ");
+    Put_Raw( &b, "    " );
     for (i=0; i<m->nAlpha; i++) { 
 
 
@@ -2461,11 +2694,18 @@ void Lgm_WriteMagEphemData( FILE *fp, char *IntModel, char *ExtModel, double Kp,
 
         Kappa = sqrt( m->RofC*Re*1e3/rg );
 
-        fprintf(fp, " %12g", Kappa ); 
+        Put_g( &b, 12, Kappa ); 
     }
 
 
-    fprintf(fp, "\n");
+    Put_Raw( &b, "\n" );
+
+    if ( b.Failed ) {
+        fprintf( stderr, "Lgm_WriteMagEphemData: ran out of memory building the row. Row not written.\n" );
+    } else {
+        fwrite( b.Buf, 1, b.n, fp );
+    }
+    free( b.Buf );
 
     
     Lgm_free_ctrans( c );
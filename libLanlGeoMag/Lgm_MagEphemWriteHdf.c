@@ -1,5 +1,6 @@
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_MagEphemInfo.h"
+#include "Lgm/Lgm_Profile.h"
 #include "Lgm/Lgm_HDF5.h"
 //const char *sMonth[] = { "", "January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December" };
 
@@ -110,7 +111,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
     // Create IsoTime Dataset
     atype = CreateStrType( 32 );
-    DataSet = CreateExtendableRank1DataSet( file, "IsoTime", atype, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "IsoTime", atype, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "The date and time in ISO 8601 compliant format." );
     Lgm_WriteStringAttr( DataSet, "UNITS",       "UTC" );
     Lgm_WriteStringAttr( DataSet, "SCALETYP",    "linear" );
@@ -121,7 +122,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Date Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Date", H5T_NATIVE_LONG, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Date", H5T_NATIVE_LONG, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "The date. In YYYMMDD format." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "YYYYMMDD" );
@@ -133,7 +134,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Doy Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Doy", H5T_NATIVE_INT, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Doy", H5T_NATIVE_INT, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Ordinal Day of Year." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "DDD" );
@@ -145,7 +146,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create UTC (hours) Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "UTC", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "UTC", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Universal Time (Coordinated). In decimal hours." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Hours" );
@@ -157,7 +158,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create JD Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "JulianDate", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "JulianDate", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Julian Date. In decimal days." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Days" );
@@ -169,7 +170,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create GpsTime Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "GpsTime", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "GpsTime", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Number of SI seconds since 0h Jan 6, 1980 UTC." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Seconds" );
@@ -181,7 +182,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create DipoleTiltAngle Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "DipoleTiltAngle", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "DipoleTiltAngle", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Angle between Zgsm and Zsm (i.e. between Zgsm and dipole axis direction)." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Degrees" );
@@ -193,7 +194,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create InOut Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "InOut", H5T_NATIVE_INT, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "InOut", H5T_NATIVE_INT, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Flag indicating whether we are inbound (-1) or outbound (+1)" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "dimless" );
@@ -204,7 +205,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create OrbitNumber Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "OrbitNumber", H5T_NATIVE_INT, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "OrbitNumber", H5T_NATIVE_INT, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Orbit Number" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "dimless" );
@@ -214,9 +215,20 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Sclose( space );
     status  = H5Dclose( DataSet );
 
+    // Create Interpolated Dataset
+    DataSet = CreateChunkedRank1DataSet( file, "Interpolated", H5T_NATIVE_INT, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
+    Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Flag indicating whether the L* and field line quantities were computed (0) or interpolated between computed times (1) (adaptive cadence runs)" );
+    Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
+    Lgm_WriteStringAttr( DataSet, "UNITS",      "dimless" );
+    Lgm_WriteStringAttr( DataSet, "SCALETYP",   "linear" );
+    Lgm_WriteStringAttr( DataSet, "FILLVAL",    "-1E31" );
+    Lgm_WriteStringAttr( DataSet, "VAR_TYPE",   "data" );
+    status  = H5Sclose( space );
+    status  = H5Dclose( DataSet );
+
 
     // Create Rgeo Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rgeo", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rgeo", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric Geographic position vector of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -227,7 +239,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Rgeod_LatLon Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rgeod_LatLon", 2, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rgeod_LatLon", 2, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Geographic Latitude and Longitude of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -238,7 +250,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Rgeod_Height Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Rgeod_Height", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Rgeod_Height", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Geographic Height (Above WGS84 Ellipsoid) of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "km" );
@@ -250,7 +262,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Rgsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rgsm", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rgsm", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric Solar Magnetospheric position vector of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -261,7 +273,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Rsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rsm", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rsm", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric Solar Magnetic position vector of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -272,7 +284,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Rgei Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rgei", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rgei", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric Equatorial Inertial position vector of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -283,7 +295,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Rgse Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Rgse", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Rgse", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric Solar Ecliptic position vector of S/C." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -296,7 +308,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create CDMAG_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "CDMAG_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "CDMAG_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of S/C in Centerted Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -307,7 +319,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create CDMAG_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "CDMAG_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "CDMAG_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of S/C in Centerted Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -318,7 +330,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create CDMAG_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "CDMAG_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "CDMAG_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of S/C in Centerted Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -329,7 +341,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create CDMAG_R Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "CDMAG_R", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "CDMAG_R", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Radial distance of S/C from center of CDMAG coordinate system." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -341,7 +353,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create EDMAG_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "EDMAG_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "EDMAG_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of S/C in Eccentric Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -352,7 +364,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create EDMAG_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "EDMAG_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "EDMAG_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of S/C in Eccentric Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -363,7 +375,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create EDMAG_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "EDMAG_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "EDMAG_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of S/C in Eccentric Dipole Coordinates." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -374,7 +386,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create EDMAG_R Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "EDMAG_R", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "EDMAG_R", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Radial distance of S/C from center of EDMAG coordinate system." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -389,7 +401,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
     // Create IntModel Dataset
     atype = CreateStrType( 32 );
-    DataSet = CreateExtendableRank1DataSet( file, "IntModel", atype, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "IntModel", atype, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Internal magnetic field model." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "FILLVAL",    "-1E31" );
@@ -401,7 +413,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
     // Create ExtModel Dataset
     atype = CreateStrType( 32 );
-    DataSet = CreateExtendableRank1DataSet( file, "ExtModel", atype, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "ExtModel", atype, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "External magnetic field model." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "FILLVAL",    "-1E31" );
@@ -413,7 +425,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Kp Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Kp", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Kp", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Kp index value." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Dimensionless" );
@@ -424,7 +436,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Dst Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Dst", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Dst", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Dst index value." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -436,7 +448,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Bsc_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bsc_gsm", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bsc_gsm", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field vector at S/C (in GSM coords)." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -451,7 +463,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
     // Create FieldLineType Dataset
     atype = CreateStrType( 32 );
-    DataSet = CreateExtendableRank1DataSet( file, "FieldLineType", atype, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "FieldLineType", atype, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Description of the type of field line the S/C is on., Can be one of 4 types: LGM_CLOSED      - FL hits Earth at both ends. LGM_OPEN_N_LOBE - FL is an OPEN field line rooted in the Northern polar cap. LGM_OPEN_S_LOBE - FL is an OPEN field line rooted in the Southern polar cap. LGM_OPEN_IMF    - FL does not hit Earth at eitrher end." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "FILLVAL",    "-1E31" );
@@ -462,7 +474,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create S_sc_to_pfn Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "S_sc_to_pfn", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "S_sc_to_pfn", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Distance between S/C and Northern Footpoint along field line." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -473,7 +485,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create S_sc_to_pfs Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "S_sc_to_pfs", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "S_sc_to_pfs", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Distance between S/C and Southern Footpoint along field line." );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -484,7 +496,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create S_pfs_to_Bmin Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "S_pfs_to_Bmin", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "S_pfs_to_Bmin", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Distance between Southern Footpoint and Bmin point along field line.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -495,7 +507,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create S_Bmin_to_sc Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "S_Bmin_to_sc", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "S_Bmin_to_sc", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Distance between Bmin point and S/C along field line (positive if north of Bmin).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -506,7 +518,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create S_total Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "S_total", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "S_total", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Total Field Line length (along field line).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -517,7 +529,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create d2B_ds2 Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "d2B_ds2", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "d2B_ds2", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Second derivative of |B| with respect to s (dist along FL) at minimum |B| point.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT^2/Re^2" );
@@ -528,7 +540,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Sb0 Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Sb0", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Sb0", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Value of the 'Sb Integral' for equatorially mirroring particles (not generally zero).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -539,7 +551,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create RadiusOfCurv Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "RadiusOfCurv", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "RadiusOfCurv", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Field line radius of curvature at minimum |B| point.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -554,7 +566,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfn_geo Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfn_geo", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfn_geo", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Location of Northern Footpoint (in GEO coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -565,7 +577,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfn_gsm", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfn_gsm", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Location of Northern Footpoint (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -578,7 +590,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfn_geod_LatLon Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfn_geod_LatLon", 2, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfn_geod_LatLon", 2, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Latitude and Longitude of Northern Footpoint.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -589,7 +601,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_geod_Height Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_geod_Height", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_geod_Height", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Height of Northern Footpoint.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "km" );
@@ -601,7 +613,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfn_CD_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_CD_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_CD_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of Northern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -612,7 +624,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_CD_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_CD_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_CD_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of Northern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -623,7 +635,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_CD_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_CD_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_CD_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of Northern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Hours" );
@@ -634,7 +646,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_ED_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_ED_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_ED_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of Northern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -645,7 +657,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_ED_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_ED_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_ED_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of Northern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -656,7 +668,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfn_ED_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfn_ED_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfn_ED_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of Northern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Hours" );
@@ -667,7 +679,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bfn_geo Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bfn_geo", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bfn_geo", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field vector at Northern Footpoint (in GEO coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -678,7 +690,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bfn_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bfn_gsm", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bfn_gsm", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field vector at Northern Footpoint (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -689,7 +701,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Loss_Cone_Alpha_n Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Loss_Cone_Alpha_n", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Loss_Cone_Alpha_n", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Value of Northern Loss Cone angle. asin( sqrt(Bsc/Bfn) ).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -706,7 +718,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfs_geo Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfs_geo", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfs_geo", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Location of Southern Footpoint (in GEO coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -717,7 +729,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfs_gsm", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfs_gsm", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Location of Southern Footpoint (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -730,7 +742,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfs_geod_LatLon Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pfs_geod_LatLon", 2, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pfs_geod_LatLon", 2, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Latitude and Longitude of Southern Footpoint.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -741,7 +753,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_geod_Height Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_geod_Height", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_geod_Height", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geodetic Height of Southern Footpoint.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "km" );
@@ -753,7 +765,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pfs_CD_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_CD_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_CD_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of Southern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -764,7 +776,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_CD_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_CD_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_CD_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of Southern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -775,7 +787,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_CD_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_CD_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_CD_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of Southern Footpoint in Centerted Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Hours" );
@@ -786,7 +798,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_ED_MLAT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_ED_MLAT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_ED_MLAT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Latitude of Southern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -797,7 +809,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_ED_MLON Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_ED_MLON", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_ED_MLON", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Longitude of Southern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -808,7 +820,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Pfs_ED_MLT Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Pfs_ED_MLT", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Pfs_ED_MLT", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic Local Time of Southern Footpoint in Eccentric Dipole Coordinates.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Hours" );
@@ -819,7 +831,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bfs_geo Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bfs_geo", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bfs_geo", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field vector at Southern Footpoint (in GEO coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -830,7 +842,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bfs_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bfs_gsm", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bfs_gsm", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field vector at Southern Footpoint (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -841,7 +853,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Loss_Cone_Alpha_s Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Loss_Cone_Alpha_s", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Loss_Cone_Alpha_s", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Value of Southern Loss Cone angle. asin( sqrt(Bsc/Bfs) ).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -853,7 +865,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Pmin_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Pmin_gsm", 3, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Pmin_gsm", 3, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Location of minimum-|B| point (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -864,7 +876,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bmin_gsm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bmin_gsm", 4, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bmin_gsm", 4, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "B-field at minimum-|B| point (in GSM coords).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Re" );
@@ -877,7 +889,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Lsimple Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Lsimple", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Lsimple", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Geocentric distance to Bmin point for FL threading vehicle (i.e. |Pmin|).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Dimless" );
@@ -888,7 +900,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create InvLat Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "InvLat", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "InvLat", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Invariant latitude of vehicle computed from Lambda=acos(sqrt(1/Lsimple)).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -900,7 +912,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Lm_eq Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "Lm_eq", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "Lm_eq", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "McIlwain L of an eq. mirroring particle on same FL as vehicle (computed from L=Lm_eq, I=0, and Bm=|Bmin_gsm|, M=M_igrf).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Dimless" );
@@ -911,7 +923,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create InvLat_eq Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "InvLat_eq", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "InvLat_eq", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Invariant latitude of vehicle computed from Lambda=acos(sqrt(1.0/Lm_eq)).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -923,7 +935,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create BoverBeq Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "BoverBeq", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "BoverBeq", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magntiude of Bsc over magnitude of Bmin.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Dimless" );
@@ -934,7 +946,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create MlatFromBoverBeq Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "MlatFromBoverBeq", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "MlatFromBoverBeq", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Dipole latitude where (B/Beq)_dipole == BoverBeq.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "Deg." );
@@ -947,7 +959,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create M_used Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "M_used", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "M_used", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "The magnetic dipole moment that was used to convert magnetic flux to L*. In units of nT.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -958,7 +970,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create M_ref Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "M_ref", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "M_ref", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "The fixed reference magnetic dipole moment for converting magnetic flux to L*. In units of nT.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -969,7 +981,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create M_igrf Dataset
-    DataSet = CreateExtendableRank1DataSet( file, "M_igrf", H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank1DataSet( file, "M_igrf", H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Time-dependant magnetic dipole moment (probably shouldn't be used for converting magnetic flux to L*, but it sometimes is). In units of nT.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "UNITS",      "nT" );
@@ -981,7 +993,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Lstar Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Lstar", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Lstar", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Generalized Roederer L-shell value (also known as L*).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",       "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",       "Alpha" );
@@ -998,7 +1010,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create L Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "L", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "L", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "McIlwain L-shell value.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1010,7 +1022,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Bm Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Bm", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Bm", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Magnetic field strength at mirror points for each pitch angle.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1022,7 +1034,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create I Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "I", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "I", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Integral invariant for each pitch angle.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1034,7 +1046,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create K Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "K", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "K", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Second Invariant ( I*sqrt(Bm) ) for each pitch angle.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1047,7 +1059,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Sb Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Sb", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Sb", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Value of the 'Sb Integral' for equatorially mirroring particles (not generally zero).");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1059,7 +1071,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create Tb Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Tb", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Tb", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Bounce period for 1 MeV electrons.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1072,7 +1084,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 
 
     // Create Kappa Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "Kappa", m->nAlpha, H5T_NATIVE_DOUBLE, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "Kappa", m->nAlpha, H5T_NATIVE_DOUBLE, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", "Kappa parameter for 1MeV electrons -- sqrt( (Minimum Radius of Curvature)/Maximum gyroradius)) (see Büchner, J., and L. M. Zelenyi (1989), Regular and Chaotic Charged Particle Motion in Magnetotaillike Field Reversals, 1. Basic Theory of Trapped Motion, J. Geophys. Res., 94(A9), 11,821-11,842, doi:10.1029/JA094iA09p11821.");
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
     Lgm_WriteStringAttr( DataSet, "DEPEND_1",   "Alpha" );
@@ -1084,7 +1096,7 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
     status  = H5Dclose( DataSet );
 
     // Create DriftShellType Dataset
-    DataSet = CreateExtendableRank2DataSet( file, "DriftShellType", m->nAlpha, H5T_NATIVE_INT, &space );
+    DataSet = CreateChunkedRank2DataSet( file, "DriftShellType", m->nAlpha, H5T_NATIVE_INT, med->H5_ChunkBytes, med->H5_nBuffer, med->H5_Deflate, med->H5_Shuffle, &space );
     sprintf( TmpStr, "Type of Drift Shell (e.g. %d=CLOSED, %d=CLOSED_SHABANSKY, %d=OPEN, %d=OPEN_SHABANSKY)", LGM_DRIFT_ORBIT_CLOSED, LGM_DRIFT_ORBIT_CLOSED_SHABANSKY, LGM_DRIFT_ORBIT_OPEN, LGM_DRIFT_ORBIT_OPEN_SHABANSKY);
     Lgm_WriteStringAttr( DataSet, "DESCRIPTION", TmpStr );
     Lgm_WriteStringAttr( DataSet, "DEPEND_0",   "IsoTime" );
@@ -1100,104 +1112,197 @@ void Lgm_WriteMagEphemHeaderHdf( hid_t file, char *CodeVersion, char *ExtModel,
 }
 
 
+/**
+ *  \brief
+ *      Set how the per-time datasets of a MagEphem HDF5 file are laid out and written.
+ *
+ *  \details
+ *      Must be called before Lgm_WriteMagEphemHeaderHdf() (which creates the
+ *      datasets). The defaults (set in Lgm_InitMagEphemData()) are ChunkBytes
+ *      = LGM_HDF5_CHUNK_BYTES, nBuffer = 1024 and no filters.
+ *
+ *      \param[in]      ChunkBytes  Target chunk size (bytes). Chunks never hold more than nBuffer rows.
+ *      \param[in]      nBuffer     Number of rows Lgm_WriteMagEphemDataHdf() holds before writing them
+ *                                  as one block. 1 writes every row as it comes (with ChunkBytes = 0 this
+ *                                  gives the old one-row-per-chunk layout).
+ *      \param[in]      Deflate     Deflate (gzip) level, 1-9. 0 for no compression.
+ *      \param[in]      Shuffle     If TRUE, apply the shuffle filter (improves compression of numeric data).
+ *      \param[in,out]  med         Lgm_MagEphemData structure.
+ *
+ */
+void Lgm_SetMagEphemHdfOptions( size_t ChunkBytes, int nBuffer, int Deflate, int Shuffle, Lgm_MagEphemData *med ) {
+    med->H5_ChunkBytes = ChunkBytes;
+    med->H5_nBuffer    = ( nBuffer < 1 ) ? 1 : nBuffer;
+    med->H5_Deflate    = Deflate;
+    med->H5_Shuffle    = Shuffle;
+}
+
+
+/**
+ *  \brief
+ *      Queue row \a i of the H5_* arrays in \a med for writing as row \a iRow of the MagEphem HDF5 file.
+ *
+ *  \details
+ *      Rows are not written one at a time. They are left in the H5_* arrays
+ *      and written as a block of rows into each dataset once med->H5_nBuffer
+ *      consecutive rows have accumulated (or when a row does not follow on
+ *      from the ones held). So the rows must not be overwritten until they
+ *      have been written, and Lgm_FlushMagEphemDataHdf() must be called
+ *      before the file is closed to write whatever is left. The file may be
+ *      closed and re-opened between calls as long as every call is for the
+ *      same file.
+ *
+ *      \param[in]      file        Handle of the file (as set up by Lgm_WriteMagEphemHeaderHdf()).
+ *      \param[in]      iRow        Row of the file datasets to write to.
+ *      \param[in]      i           Row of the H5_* arrays to write.
+ *      \param[in,out]  med         Lgm_MagEphemData structure.
+ *
+ */
+static void Lgm_WriteMagEphemDataHdf_Body( hid_t file, int iRow, int i, Lgm_MagEphemData *med );
 void Lgm_WriteMagEphemDataHdf( hid_t file, int iRow, int i, Lgm_MagEphemData *med ) {
 
-    hid_t   atype;
-    herr_t  status;
+    LGM_PROFILE_BEGIN( LGM_PROF_IO );
+    Lgm_WriteMagEphemDataHdf_Body( file, iRow, i, med );
+    LGM_PROFILE_END( LGM_PROF_IO );
 
+}
 
+static void Lgm_WriteMagEphemDataHdf_Body( hid_t file, int iRow, int i, Lgm_MagEphemData *med ) {
 
+    if ( ( med->H5_nBuffered > 0 ) && ( ( iRow != med->H5_iRow0 + med->H5_nBuffered ) || ( i != med->H5_i0 + med->H5_nBuffered ) ) ) {
+        Lgm_FlushMagEphemDataHdf( file, med );
+    }
 
+    if ( med->H5_nBuffered == 0 ) {
+        med->H5_iRow0 = iRow;
+        med->H5_i0    = i;
+    }
+    ++(med->H5_nBuffered);
 
-    // Write String variables
-    atype = CreateStrType( 32 );
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "IsoTime",           iRow,                  atype,             &med->H5_IsoTimes[i][0] );         // Write IsoTime
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "FieldLineType",     iRow,                  atype,             &med->H5_FieldLineType[i][0] );    // Write H5_FieldLineType
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "IntModel",          iRow,                  atype,             &med->H5_IntModel[i][0] );         // Write IntModel
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "ExtModel",          iRow,                  atype,             &med->H5_ExtModel[i][0] );         // Write ExtModel
+    if ( med->H5_nBuffered >= med->H5_nBuffer ) Lgm_FlushMagEphemDataHdf( file, med );
+
+}
+
+
+/**
+ *  \brief
+ *      Write the rows held by Lgm_WriteMagEphemDataHdf() into the MagEphem HDF5 file.
+ *
+ *      \param[in]      file        Handle of the file (as set up by Lgm_WriteMagEphemHeaderHdf()).
+ *      \param[in,out]  med         Lgm_MagEphemData structure.
+ *
+ */
+static void Lgm_FlushMagEphemDataHdf_Body( hid_t file, Lgm_MagEphemData *med );
+void Lgm_FlushMagEphemDataHdf( hid_t file, Lgm_MagEphemData *med ) {
+
+    LGM_PROFILE_BEGIN( LGM_PROF_IO );
+    Lgm_FlushMagEphemDataHdf_Body( file, med );
+    LGM_PROFILE_END( LGM_PROF_IO );
+
+}
+
+static void Lgm_FlushMagEphemDataHdf_Body( hid_t file, Lgm_MagEphemData *med ) {
+
+    int     i, iRow0, n;
+    hid_t   atype;
+    herr_t  status;
+
+    if ( ( n = med->H5_nBuffered ) < 1 ) return;
+    i     = med->H5_i0;
+    iRow0 = med->H5_iRow0;
+    med->H5_nBuffered = 0;
+
+
+    // Write String variables (the rows in memory are 80 chars apart)
+    atype = CreateStrType( 80 );
+    Lgm_HDF5_AppendRows( file, "IsoTime",           iRow0, n,  atype,             &med->H5_IsoTimes[i][0] );         // Write IsoTime
+    Lgm_HDF5_AppendRows( file, "FieldLineType",     iRow0, n,  atype,             &med->H5_FieldLineType[i][0] );    // Write H5_FieldLineType
+    Lgm_HDF5_AppendRows( file, "IntModel",          iRow0, n,  atype,             &med->H5_IntModel[i][0] );         // Write IntModel
+    Lgm_HDF5_AppendRows( file, "ExtModel",          iRow0, n,  atype,             &med->H5_ExtModel[i][0] );         // Write ExtModel
     status  = H5Tclose( atype );
 
     // Write Non-String variables
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Date",              iRow,                  H5T_NATIVE_LONG,   &med->H5_Date[i] );                // Write Date
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Doy",               iRow,                  H5T_NATIVE_INT,    &med->H5_Doy[i] );                 // Write Doy
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "UTC",               iRow,                  H5T_NATIVE_DOUBLE, &med->H5_UTC[i] );                 // Write UTC (hours)
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "JulianDate",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_JD[i] );                  // Write JD
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "GpsTime",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_GpsTime[i] );             // Write GpsTime
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "DipoleTiltAngle",   iRow,                  H5T_NATIVE_DOUBLE, &med->H5_TiltAngle[i] );           // Write DipoleTiltAngle
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "InOut",             iRow,                  H5T_NATIVE_INT,    &med->H5_InOut[i] );               // Write InOut
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "OrbitNumber",       iRow,                  H5T_NATIVE_INT,    &med->H5_OrbitNumber[i] );         // Write OrbitNumber
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rgsm",              iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Rgsm[i][0] );             // Write Rgsm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rgeo",              iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Rgeo[i][0] );             // Write Rgeo
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rsm",               iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Rsm[i][0] );              // Write Rsm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rgei",              iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Rgei[i][0] );             // Write Rgei
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rgse",              iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Rgse[i][0] );             // Write Rgse
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Rgeod_LatLon",      iRow, 2,               H5T_NATIVE_DOUBLE, &med->H5_Rgeod_LatLon[i][0] );     // Write Rgeod_LatLon
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Rgeod_Height",      iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Rgeod_Height[i] );        // Write Rgeod_Height
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "CDMAG_MLAT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLAT[i] );          // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "CDMAG_MLON",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLON[i] );          // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "CDMAG_MLT",         iRow,                  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLT[i] );           // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "CDMAG_R",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_R[i] );             // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "EDMAG_MLAT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLAT[i] );          // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "EDMAG_MLON",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLON[i] );          // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "EDMAG_MLT",         iRow,                  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLT[i] );           // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "EDMAG_R",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_R[i] );             // Write CDMAG_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Kp",                iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Kp[i] );                  // Write Kp
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Dst",               iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Dst[i] );                 // Write Dst
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bsc_gsm",           iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bsc_gsm[i][0] );          // Write Bsc_gsm
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "S_sc_to_pfn",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_S_sc_to_pfn[i] );         // Write S_sc_to_pfn
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "S_sc_to_pfs",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_S_sc_to_pfs[i] );         // Write S_sc_to_pfs
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "S_pfs_to_Bmin",     iRow,                  H5T_NATIVE_DOUBLE, &med->H5_S_pfs_to_Bmin[i] );       // Write S_pfs_to_Bmin
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "S_Bmin_to_sc",      iRow,                  H5T_NATIVE_DOUBLE, &med->H5_S_Bmin_to_sc[i] );        // Write S_Bmin_to_sc
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "S_total",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_S_total[i] );             // Write S_total
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "d2B_ds2",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_d2B_ds2[i] );             // Write d2B_ds2
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Sb0",               iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Sb0[i] );                 // Write Sb0
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "RadiusOfCurv",      iRow,                  H5T_NATIVE_DOUBLE, &med->H5_RadiusOfCurv[i] );        // Write RadiusOfCurv
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfn_geo",           iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Pfn_geo[i][0] );          // Write Pfn_geo
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfn_gsm",           iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Pfn_gsm[i][0] );          // Write Pfn_gsm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfn_geod_LatLon",   iRow, 2,               H5T_NATIVE_DOUBLE, &med->H5_Pfn_geod_LatLon[i][0] );  // Write Pfn_geod_LatLon
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_geod_Height",   iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_geod_Height[i] );     // Write Pfn_geod_Height
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_CD_MLAT",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLAT[i] );         // Write Pfn_CD_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_CD_MLON",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLON[i] );         // Write Pfn_CD_MLON
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_CD_MLT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLT[i] );          // Write Pfn_CD_MLT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_ED_MLAT",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLAT[i] );         // Write Pfn_ED_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_ED_MLON",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLON[i] );         // Write Pfn_ED_MLON
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfn_ED_MLT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLT[i] );          // Write Pfn_ED_MLT
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bfn_geo",           iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bfn_geo[i][0] );          // Write Bfn_geo
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bfn_gsm",           iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bfn_gsm[i][0] );          // Write Bfn_gsm
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Loss_Cone_Alpha_n", iRow,                  H5T_NATIVE_DOUBLE, &med->H5_LossConeAngleN[i] );      // Write Loss_Cone_Alpha_n
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfs_geo",           iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Pfs_geo[i][0] );          // Write Pfs_geo
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfs_gsm",           iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Pfs_gsm[i][0] );          // Write Pfs_gsm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pfs_geod_LatLon",   iRow, 2,               H5T_NATIVE_DOUBLE, &med->H5_Pfs_geod_LatLon[i][0] );  // Write Pfs_geod_LatLon
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_geod_Height",   iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_geod_Height[i] );     // Write Pfs_geod_Height
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_CD_MLAT",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLAT[i] );         // Write Pfs_CD_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_CD_MLON",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLON[i] );         // Write Pfs_CD_MLON
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_CD_MLT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLT[i] );          // Write Pfs_CD_MLT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_ED_MLAT",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLAT[i] );         // Write Pfs_ED_MLAT
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_ED_MLON",       iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLON[i] );         // Write Pfs_ED_MLON
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Pfs_ED_MLT",        iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLT[i] );          // Write Pfs_ED_MLT
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bfs_geo",           iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bfs_geo[i][0] );          // Write Bfs_geo
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bfs_gsm",           iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bfs_gsm[i][0] );          // Write Bfs_gsm
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Loss_Cone_Alpha_s", iRow,                  H5T_NATIVE_DOUBLE, &med->H5_LossConeAngleS[i] );      // Write Loss_Cone_Alpha_s
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Pmin_gsm",          iRow, 3,               H5T_NATIVE_DOUBLE, &med->H5_Pmin_gsm[i][0] );         // Write Pmin_gsm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bmin_gsm",          iRow, 4,               H5T_NATIVE_DOUBLE, &med->H5_Bmin_gsm[i][0] );         // Write Bmin_gsm
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Lsimple",           iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Lsimple[i] );             // Write Lsimple
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "InvLat",            iRow,                  H5T_NATIVE_DOUBLE, &med->H5_InvLat[i] );              // Write InvLat
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "Lm_eq",             iRow,                  H5T_NATIVE_DOUBLE, &med->H5_Lm_eq[i] );               // Write Lm_eq
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "InvLat_eq",         iRow,                  H5T_NATIVE_DOUBLE, &med->H5_InvLat_eq[i] );           // Write InvLat_eq
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "BoverBeq",          iRow,                  H5T_NATIVE_DOUBLE, &med->H5_BoverBeq[i] );            // Write BoverBeq
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "MlatFromBoverBeq",  iRow,                  H5T_NATIVE_DOUBLE, &med->H5_MlatFromBoverBeq[i] );    // Write MlatFromBoverBeq
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "M_used",            iRow,                  H5T_NATIVE_DOUBLE, &med->H5_M_used[i] );              // Write M_used
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "M_ref",             iRow,                  H5T_NATIVE_DOUBLE, &med->H5_M_ref[i] );               // Write M_ref
-    LGM_HDF5_EXTEND_RANK1_DATASET( file, "M_igrf",            iRow,                  H5T_NATIVE_DOUBLE, &med->H5_M_igrf[i] );              // Write M_igrf
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Lstar",             iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_Lstar[i][0] );            // Write Lstar
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Sb",                iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_Sb[i][0] );               // Write Sb
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Tb",                iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_Tb[i][0] );               // Write Tb
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Kappa",             iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_Kappa[i][0] );            // Write Kappa
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "DriftShellType",    iRow, med->H5_nAlpha,  H5T_NATIVE_INT,    &med->H5_DriftShellType[i][0] );   // Write DriftShellType
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "L",                 iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_L[i][0] );                // Write L
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "Bm",                iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_Bm[i][0] );               // Write Bm
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "I",                 iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_I[i][0] );                // Write I
-    LGM_HDF5_EXTEND_RANK2_DATASET( file, "K",                 iRow, med->H5_nAlpha,  H5T_NATIVE_DOUBLE, &med->H5_K[i][0] );                // Write K
+    Lgm_HDF5_AppendRows( file, "Date",              iRow0, n,  H5T_NATIVE_LONG,   &med->H5_Date[i] );                // Write Date
+    Lgm_HDF5_AppendRows( file, "Doy",               iRow0, n,  H5T_NATIVE_INT,    &med->H5_Doy[i] );                 // Write Doy
+    Lgm_HDF5_AppendRows( file, "UTC",               iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_UTC[i] );                 // Write UTC (hours)
+    Lgm_HDF5_AppendRows( file, "JulianDate",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_JD[i] );                  // Write JD
+    Lgm_HDF5_AppendRows( file, "GpsTime",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_GpsTime[i] );             // Write GpsTime
+    Lgm_HDF5_AppendRows( file, "DipoleTiltAngle",   iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_TiltAngle[i] );           // Write DipoleTiltAngle
+    Lgm_HDF5_AppendRows( file, "InOut",             iRow0, n,  H5T_NATIVE_INT,    &med->H5_InOut[i] );               // Write InOut
+    Lgm_HDF5_AppendRows( file, "OrbitNumber",       iRow0, n,  H5T_NATIVE_INT,    &med->H5_OrbitNumber[i] );         // Write OrbitNumber
+    Lgm_HDF5_AppendRows( file, "Interpolated",      iRow0, n,  H5T_NATIVE_INT,    &med->H5_Interpolated[i] );        // Write Interpolated
+    Lgm_HDF5_AppendRows( file, "Rgsm",              iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgsm[i][0] );             // Write Rgsm
+    Lgm_HDF5_AppendRows( file, "Rgeo",              iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgeo[i][0] );             // Write Rgeo
+    Lgm_HDF5_AppendRows( file, "Rsm",               iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rsm[i][0] );              // Write Rsm
+    Lgm_HDF5_AppendRows( file, "Rgei",              iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgei[i][0] );             // Write Rgei
+    Lgm_HDF5_AppendRows( file, "Rgse",              iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgse[i][0] );             // Write Rgse
+    Lgm_HDF5_AppendRows( file, "Rgeod_LatLon",      iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgeod_LatLon[i][0] );     // Write Rgeod_LatLon
+    Lgm_HDF5_AppendRows( file, "Rgeod_Height",      iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Rgeod_Height[i] );        // Write Rgeod_Height
+    Lgm_HDF5_AppendRows( file, "CDMAG_MLAT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLAT[i] );          // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "CDMAG_MLON",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLON[i] );          // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "CDMAG_MLT",         iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_MLT[i] );           // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "CDMAG_R",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_CDMAG_R[i] );             // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "EDMAG_MLAT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLAT[i] );          // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "EDMAG_MLON",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLON[i] );          // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "EDMAG_MLT",         iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_MLT[i] );           // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "EDMAG_R",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_EDMAG_R[i] );             // Write CDMAG_MLAT
+    Lgm_HDF5_AppendRows( file, "Kp",                iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Kp[i] );                  // Write Kp
+    Lgm_HDF5_AppendRows( file, "Dst",               iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Dst[i] );                 // Write Dst
+    Lgm_HDF5_AppendRows( file, "Bsc_gsm",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bsc_gsm[i][0] );          // Write Bsc_gsm
+    Lgm_HDF5_AppendRows( file, "S_sc_to_pfn",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_S_sc_to_pfn[i] );         // Write S_sc_to_pfn
+    Lgm_HDF5_AppendRows( file, "S_sc_to_pfs",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_S_sc_to_pfs[i] );         // Write S_sc_to_pfs
+    Lgm_HDF5_AppendRows( file, "S_pfs_to_Bmin",     iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_S_pfs_to_Bmin[i] );       // Write S_pfs_to_Bmin
+    Lgm_HDF5_AppendRows( file, "S_Bmin_to_sc",      iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_S_Bmin_to_sc[i] );        // Write S_Bmin_to_sc
+    Lgm_HDF5_AppendRows( file, "S_total",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_S_total[i] );             // Write S_total
+    Lgm_HDF5_AppendRows( file, "d2B_ds2",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_d2B_ds2[i] );             // Write d2B_ds2
+    Lgm_HDF5_AppendRows( file, "Sb0",               iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Sb0[i] );                 // Write Sb0
+    Lgm_HDF5_AppendRows( file, "RadiusOfCurv",      iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_RadiusOfCurv[i] );        // Write RadiusOfCurv
+    Lgm_HDF5_AppendRows( file, "Pfn_geo",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_geo[i][0] );          // Write Pfn_geo
+    Lgm_HDF5_AppendRows( file, "Pfn_gsm",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_gsm[i][0] );          // Write Pfn_gsm
+    Lgm_HDF5_AppendRows( file, "Pfn_geod_LatLon",   iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_geod_LatLon[i][0] );  // Write Pfn_geod_LatLon
+    Lgm_HDF5_AppendRows( file, "Pfn_geod_Height",   iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_geod_Height[i] );     // Write Pfn_geod_Height
+    Lgm_HDF5_AppendRows( file, "Pfn_CD_MLAT",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLAT[i] );         // Write Pfn_CD_MLAT
+    Lgm_HDF5_AppendRows( file, "Pfn_CD_MLON",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLON[i] );         // Write Pfn_CD_MLON
+    Lgm_HDF5_AppendRows( file, "Pfn_CD_MLT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_CD_MLT[i] );          // Write Pfn_CD_MLT
+    Lgm_HDF5_AppendRows( file, "Pfn_ED_MLAT",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLAT[i] );         // Write Pfn_ED_MLAT
+    Lgm_HDF5_AppendRows( file, "Pfn_ED_MLON",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLON[i] );         // Write Pfn_ED_MLON
+    Lgm_HDF5_AppendRows( file, "Pfn_ED_MLT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfn_ED_MLT[i] );          // Write Pfn_ED_MLT
+    Lgm_HDF5_AppendRows( file, "Bfn_geo",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bfn_geo[i][0] );          // Write Bfn_geo
+    Lgm_HDF5_AppendRows( file, "Bfn_gsm",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bfn_gsm[i][0] );          // Write Bfn_gsm
+    Lgm_HDF5_AppendRows( file, "Loss_Cone_Alpha_n", iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_LossConeAngleN[i] );      // Write Loss_Cone_Alpha_n
+    Lgm_HDF5_AppendRows( file, "Pfs_geo",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_geo[i][0] );          // Write Pfs_geo
+    Lgm_HDF5_AppendRows( file, "Pfs_gsm",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_gsm[i][0] );          // Write Pfs_gsm
+    Lgm_HDF5_AppendRows( file, "Pfs_geod_LatLon",   iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_geod_LatLon[i][0] );  // Write Pfs_geod_LatLon
+    Lgm_HDF5_AppendRows( file, "Pfs_geod_Height",   iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_geod_Height[i] );     // Write Pfs_geod_Height
+    Lgm_HDF5_AppendRows( file, "Pfs_CD_MLAT",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLAT[i] );         // Write Pfs_CD_MLAT
+    Lgm_HDF5_AppendRows( file, "Pfs_CD_MLON",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLON[i] );         // Write Pfs_CD_MLON
+    Lgm_HDF5_AppendRows( file, "Pfs_CD_MLT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_CD_MLT[i] );          // Write Pfs_CD_MLT
+    Lgm_HDF5_AppendRows( file, "Pfs_ED_MLAT",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLAT[i] );         // Write Pfs_ED_MLAT
+    Lgm_HDF5_AppendRows( file, "Pfs_ED_MLON",       iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLON[i] );         // Write Pfs_ED_MLON
+    Lgm_HDF5_AppendRows( file, "Pfs_ED_MLT",        iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pfs_ED_MLT[i] );          // Write Pfs_ED_MLT
+    Lgm_HDF5_AppendRows( file, "Bfs_geo",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bfs_geo[i][0] );          // Write Bfs_geo
+    Lgm_HDF5_AppendRows( file, "Bfs_gsm",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bfs_gsm[i][0] );          // Write Bfs_gsm
+    Lgm_HDF5_AppendRows( file, "Loss_Cone_Alpha_s", iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_LossConeAngleS[i] );      // Write Loss_Cone_Alpha_s
+    Lgm_HDF5_AppendRows( file, "Pmin_gsm",          iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Pmin_gsm[i][0] );         // Write Pmin_gsm
+    Lgm_HDF5_AppendRows( file, "Bmin_gsm",          iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Bmin_gsm[i][0] );         // Write Bmin_gsm
+    Lgm_HDF5_AppendRows( file, "Lsimple",           iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Lsimple[i] );             // Write Lsimple
+    Lgm_HDF5_AppendRows( file, "InvLat",            iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_InvLat[i] );              // Write InvLat
+    Lgm_HDF5_AppendRows( file, "Lm_eq",             iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_Lm_eq[i] );               // Write Lm_eq
+    Lgm_HDF5_AppendRows( file, "InvLat_eq",         iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_InvLat_eq[i] );           // Write InvLat_eq
+    Lgm_HDF5_AppendRows( file, "BoverBeq",          iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_BoverBeq[i] );            // Write BoverBeq
+    Lgm_HDF5_AppendRows( file, "MlatFromBoverBeq",  iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_MlatFromBoverBeq[i] );    // Write MlatFromBoverBeq
+    Lgm_HDF5_AppendRows( file, "M_used",            iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_M_used[i] );              // Write M_used
+    Lgm_HDF5_AppendRows( file, "M_ref",             iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_M_ref[i] );               // Write M_ref
+    Lgm_HDF5_AppendRows( file, "M_igrf",            iRow0, n,  H5T_NATIVE_DOUBLE, &med->H5_M_igrf[i] );              // Write M_igrf
+    Lgm_HDF5_AppendRowsStrided( file, "Lstar",             iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_Lstar[i][0] );            // Write Lstar
+    Lgm_HDF5_AppendRowsStrided( file, "Sb",                iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_Sb[i][0] );               // Write Sb
+    Lgm_HDF5_AppendRowsStrided( file, "Tb",                iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_Tb[i][0] );               // Write Tb
+    Lgm_HDF5_AppendRowsStrided( file, "Kappa",             iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_Kappa[i][0] );            // Write Kappa
+    Lgm_HDF5_AppendRowsStrided( file, "DriftShellType",    iRow0, n,  H5T_NATIVE_INT,    med->H5_nPA, &med->H5_DriftShellType[i][0] );   // Write DriftShellType
+    Lgm_HDF5_AppendRowsStrided( file, "L",                 iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_L[i][0] );                // Write L
+    Lgm_HDF5_AppendRowsStrided( file, "Bm",                iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_Bm[i][0] );               // Write Bm
+    Lgm_HDF5_AppendRowsStrided( file, "I",                 iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_I[i][0] );                // Write I
+    Lgm_HDF5_AppendRowsStrided( file, "K",                 iRow0, n,  H5T_NATIVE_DOUBLE, med->H5_nPA, &med->H5_K[i][0] );                // Write K
 
 
 
@@ -0,0 +1,212 @@
+/*! \file Lgm_MagModelStats.c
+ *
+ *  \brief Reset and report the optional per-model evaluation counters and timers.
+ *
+ *  The counters live in Info->Stats and are updated by the LGM_STATS_* macros
+ *  (see Lgm_MagModelInfo.h) in the B-field models, the field line
+ *  integrators and the interpolating routines. They are only compiled in when
+ *  the library is configured with --enable-instrumentation. Otherwise the
+ *  counters just stay at zero.
+ *
+ *  The integrators also keep step statistics (accepted and rejected steps,
+ *  field evaluations per step, histograms of the step sizes and of the BS
+ *  extrapolation order) for each integrator and for each of the trace
+ *  routines, which is what is needed to tune Lgm_MagStep_BS_Eps, _atol and
+ *  _rtol for a given workload.
+ *
+ */
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#if LGM_INSTRUMENT
+static const char *Lgm_Stats_InternalNames[LGM_STATS_NINTERNAL] = { "CDIP", "EDIP", "IGRF", "DUNGEY" };
+
+static const char *Lgm_Stats_ExternalNames[LGM_STATS_NEXTERNAL] = { "T87", "T89", "T89c", "T96", "T01S", "T02", "TS04", "TS07",
+                                                                     "OP77", "SCATTERED_DATA", "SCATTERED_DATA2", "SCATTERED_DATA3",
+                                                                     "SCATTERED_DATA4", "SCATTERED_DATA5", "TU82", "OP88", "GRIDDED",
+                                                                     "RBF_SNAPSHOT", "RBF_SNAPSHOT_PAIR" };
+
+static const char *Lgm_Stats_IntegratorNames[LGM_STATS_NINTEGRATORS] = { "BS", "RK5", "DP8" };
+
+static const char *Lgm_Stats_TraceNames[LGM_STATS_NTRACE] = { "Other", "TraceToEarth", "TraceToSphericalEarth", "TraceToMinBSurf",
+                                                              "TraceToMirrorPoint", "TraceLine" };
+
+static void Lgm_Stats_PrintLine( FILE *fp, const char *Name, long int n, double t ) {
+    fprintf( fp, "    %-18s %14ld %16.6f %12.4f\n", Name, n, 1e-9*t, (n > 0) ? 1e-3*t/(double)n : 0.0 );
+}
+
+static void Lgm_Stats_PrintSteps( FILE *fp, int Ode, int Trace, Lgm_StepStats *S ) {
+
+    int     i, k0, k1;
+
+    fprintf( fp, "    %-4s %-22s %12ld %10ld %10.2f %12.4e\n", Lgm_Stats_IntegratorNames[Ode], Lgm_Stats_TraceNames[Trace],
+                S->nAccepted, S->nRejected, (double)S->nEvals/(double)S->nAccepted, S->SumH/(double)S->nAccepted );
+
+    for ( k0=0; (k0<LGM_STATS_NSTEPBINS) && !S->hHist[k0]; k0++ );
+    for ( k1=LGM_STATS_NSTEPBINS-1; (k1>k0) && !S->hHist[k1]; k1-- );
+    fprintf( fp, "        |h| (Re) from 2^%d:", LGM_STATS_STEPBIN0+k0 );
+    for ( i=k0; i<=k1; i++ ) fprintf( fp, " %ld", S->hHist[i] );
+    fprintf( fp, "\n" );
+
+    if ( Ode == LGM_MAGSTEP_ODE_BS ) {
+        fprintf( fp, "        k from 0:" );
+        for ( i=0; i<LGM_MAGSTEP_KMAX+2; i++ ) fprintf( fp, " %ld", S->kHist[i] );
+        fprintf( fp, "\n" );
+    }
+
+}
+#endif
+
+
+/**
+ *  \brief
+ *      Zero the evaluation counters and timers held in Info->Stats.
+ *
+ *  \param[in,out]  Info    Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_MagModelInfo_ResetStats( Lgm_MagModelInfo *Info ) {
+    memset( &Info->Stats, 0, sizeof(Lgm_MagModelStats) );
+}
+
+
+/**
+ *  \brief
+ *      Print a summary of the evaluation counters and timers held in Info->Stats.
+ *
+ *  \details
+ *      Only models that were actually called are listed. Times are given as
+ *      the total in seconds and the average per call in microseconds. If the
+ *      library was built without instrumentation a one line note is printed
+ *      instead.
+ *
+ *  \param[in]      fp      Stream to write to (e.g. stdout).
+ *  \param[in]      Info    Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_MagModelInfo_DumpStats( FILE *fp, Lgm_MagModelInfo *Info ) {
+
+#if LGM_INSTRUMENT
+    Lgm_MagModelStats   *S = &Info->Stats;
+    int                 i, j;
+
+    fprintf( fp, "Lgm_MagModelInfo evaluation statistics:\n" );
+    fprintf( fp, "    %-18s %14s %16s %12s\n", "Model", "Calls", "Total (s)", "Avg (us)" );
+    for ( i=0; i<LGM_STATS_NINTERNAL; i++ ) {
+        if ( S->nInternal[i] > 0 ) Lgm_Stats_PrintLine( fp, Lgm_Stats_InternalNames[i], S->nInternal[i], S->tInternal[i] );
+    }
+    for ( i=0; i<LGM_STATS_NEXTERNAL; i++ ) {
+        if ( S->nExternal[i] > 0 ) Lgm_Stats_PrintLine( fp, Lgm_Stats_ExternalNames[i], S->nExternal[i], S->tExternal[i] );
+    }
+    if ( S->nRBF > 0 )    Lgm_Stats_PrintLine( fp, "RBF", S->nRBF, S->tRBF );
+    if ( S->nInterp > 0 ) Lgm_Stats_PrintLine( fp, "Interp", S->nInterp, S->tInterp );
+    fprintf( fp, "    Lgm_MagStep_BS  steps accepted/rejected: %ld / %ld\n", S->nBS_Accepted, S->nBS_Rejected );
+    fprintf( fp, "    Lgm_MagStep_RK5 steps accepted/rejected: %ld / %ld\n", S->nRK5_Accepted, S->nRK5_Rejected );
+    fprintf( fp, "    Lgm_MagStep_DP8 steps accepted/rejected: %ld / %ld\n", S->nDP8_Accepted, S->nDP8_Rejected );
+    fprintf( fp, "    %-4s %-22s %12s %10s %10s %12s\n", "ODE", "Trace routine", "Accepted", "Rejected", "Evals/step", "Mean |h|" );
+    for ( i=0; i<LGM_STATS_NINTEGRATORS; i++ ) {
+        for ( j=0; j<LGM_STATS_NTRACE; j++ ) {
+            if ( S->Steps[i][j].nAccepted > 0 ) Lgm_Stats_PrintSteps( fp, i, j, &S->Steps[i][j] );
+        }
+    }
+#else
+    fprintf( fp, "Lgm_MagModelInfo_DumpStats: library was built without instrumentation (configure with --enable-instrumentation).\n" );
+#endif
+
+}
+
+
+/**
+ *  \brief
+ *      Add the evaluation counters and timers of Src into those of Dst.
+ *
+ *  \details
+ *      Used to fold the statistics of a temporary copy of an
+ *      Lgm_MagModelInfo structure (e.g. one made for a parallel task) back
+ *      into the original before the copy is freed.
+ *
+ *  \param[in,out]  Dst     Lgm_MagModelInfo structure to add to.
+ *  \param[in]      Src     Lgm_MagModelInfo structure to add from.
+ *
+ */
+void Lgm_MagModelInfo_AddStats( Lgm_MagModelInfo *Dst, Lgm_MagModelInfo *Src ) {
+
+    Lgm_MagModelStats   *D = &Dst->Stats, *S = &Src->Stats;
+    Lgm_StepStats       *d, *s;
+    int                 i, j, k;
+
+    for ( i=0; i<LGM_STATS_NINTERNAL; i++ ) {
+        D->nInternal[i] += S->nInternal[i];
+        D->tInternal[i] += S->tInternal[i];
+    }
+    for ( i=0; i<LGM_STATS_NEXTERNAL; i++ ) {
+        D->nExternal[i] += S->nExternal[i];
+        D->tExternal[i] += S->tExternal[i];
+    }
+    D->nRBF          += S->nRBF;            D->tRBF    += S->tRBF;
+    D->nInterp       += S->nInterp;         D->tInterp += S->tInterp;
+    D->nBS_Accepted  += S->nBS_Accepted;    D->nBS_Rejected  += S->nBS_Rejected;
+    D->nRK5_Accepted += S->nRK5_Accepted;   D->nRK5_Rejected += S->nRK5_Rejected;
+    D->nDP8_Accepted += S->nDP8_Accepted;   D->nDP8_Rejected += S->nDP8_Rejected;
+    for ( i=0; i<LGM_STATS_NINTEGRATORS; i++ ) {
+        for ( j=0; j<LGM_STATS_NTRACE; j++ ) {
+            d = &D->Steps[i][j]; s = &S->Steps[i][j];
+            d->nAccepted += s->nAccepted;
+            d->nRejected += s->nRejected;
+            d->nEvals    += s->nEvals;
+            d->SumH      += s->SumH;
+            for ( k=0; k<LGM_STATS_NSTEPBINS; k++ ) d->hHist[k] += s->hHist[k];
+            for ( k=0; k<LGM_MAGSTEP_KMAX+2; k++ ) d->kHist[k] += s->kHist[k];
+        }
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Record an accepted integrator step in Info->Stats.Steps[][].
+ *
+ *  \details
+ *      Called through LGM_STATS_STEP_ACCEPT() by Lgm_MagStep_BS(),
+ *      Lgm_MagStep_RK5() and Lgm_MagStep_DP8(). The step is counted under
+ *      the trace routine that is running (see LGM_STATS_TRACE()).
+ *
+ *  \param[in,out]  Info    Lgm_MagModelInfo structure.
+ *  \param[in]      Ode     LGM_MAGSTEP_ODE_BS, LGM_MAGSTEP_ODE_RK5 or LGM_MAGSTEP_ODE_DP8.
+ *  \param[in]      h       The step taken (Re).
+ *  \param[in]      k       The extrapolation order used (BS only; -1 otherwise).
+ *  \param[in]      nEvals  Bfield evaluations the step took, rejected tries included.
+ *
+ */
+void Lgm_MagModelInfo_StepStats( Lgm_MagModelInfo *Info, int Ode, double h, int k, long int nEvals ) {
+
+    Lgm_StepStats   *S;
+    int             b;
+
+    if ( ( Ode < 0 ) || ( Ode >= LGM_STATS_NINTEGRATORS ) ) return;
+    if ( ( Info->StatsTrace < 0 ) || ( Info->StatsTrace >= LGM_STATS_NTRACE ) ) Info->StatsTrace = LGM_STATS_TRACE_OTHER;
+    S = &Info->Stats.Steps[Ode][Info->StatsTrace];
+
+    ++S->nAccepted;
+    S->nEvals += nEvals;
+    h = fabs( h );
+    S->SumH += h;
+    b = ( h > 0.0 ) ? (int)floor( log2( h ) ) - LGM_STATS_STEPBIN0 : 0;
+    if ( b < 0 ) b = 0; else if ( b >= LGM_STATS_NSTEPBINS ) b = LGM_STATS_NSTEPBINS-1;
+    ++S->hHist[b];
+    if ( k >= 0 ) ++S->kHist[ ( k < LGM_MAGSTEP_KMAX+2 ) ? k : LGM_MAGSTEP_KMAX+1 ];
+
+}
+
+
+/*
+ *  Cleanup handler of LGM_STATS_TRACE(); puts back the trace routine that was
+ *  running before.
+ */
+void Lgm_MagModelInfo_StatsTraceEnd( Lgm_StatsTraceScope *Scope ) {
+    Scope->Info->StatsTrace = Scope->Saved;
+}
@@ -154,3 +154,62 @@ double  Lgm_Maxwellian( double n, double T, double Ek, double E0 ) {
 
 }
 
+
+/*
+ *  Lgm_MaxJut() over an array of energies. The normalization (which needs a
+ *  Bessel function) only depends on n, T and E0, so it is done once rather
+ *  than at every energy. The loop over energies is then just an exp() per
+ *  point and gives the same values as Lgm_MaxJut().
+ *
+ *  Inputs:
+ *          n  -- Density.        (#/cm^3)
+ *          T  -- Temperature.    (keV)
+ *          nE -- Number of energies.
+ *          Ek -- Kinetic Energies. (MeV)
+ *          E0 -- particle rest energy. (MeV)
+ *
+ *  Outputs:
+ *          f  -- PSD at each energy.
+ */
+void  Lgm_MaxJut_Array( double n, double T, int nE, double *Ek, double E0, double *f ) {
+
+    int     i;
+    double  Theta, K2, E03, f0;
+
+    E03 = E0*E0*E0;   // MeV^3
+
+    Theta = 1000.0*E0/T;  // dimensionless (MeV/MeV)
+    if ( Theta < 100.0 ) {
+        K2 = gsl_sf_bessel_Kn( 2, Theta ); // dimensionless
+        f0 = n*Theta/( 4.0*M_PI * E03 * K2);    // units of c^3 cm^-3 MeV^-3
+        for ( i=0; i<nE; i++ ) f[i] = f0*exp( -Theta*(Ek[i]+E0)/E0 );
+    } else {
+        // Low temperature limit. K2 ~ sqrt( pi/(2*Theta) ) exp(-Theta)
+        K2 = sqrt( 0.5*M_PI/Theta );
+        f0 = n*Theta/( 4.0*M_PI * E03 * K2);    // units of c^3 cm^-3 MeV^-3
+        for ( i=0; i<nE; i++ ) f[i] = f0*exp( Theta*(1.0-(Ek[i]+E0)/E0) );
+    }
+
+    return;
+
+}
+
+
+/*
+ *  Lgm_Maxwellian() over an array of energies. Inputs and outputs are as for
+ *  Lgm_MaxJut_Array().
+ */
+void  Lgm_Maxwellian_Array( double n, double T, int nE, double *Ek, double E0, double *f ) {
+
+    int     i;
+    double  f0;
+
+    T /= 1000.0; // keV -> MeV
+
+    f0 = n*pow( 1.0/(2.0*M_PI*E0*T), 1.5);
+    for ( i=0; i<nE; i++ ) f[i] = f0 * exp( -Ek[i]/T ); // units of c^3 / (cm^3 MeV^3)
+
+    return;
+
+}
+
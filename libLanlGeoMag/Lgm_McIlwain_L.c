@@ -11,6 +11,12 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
 #include "Lgm/Lgm_MagModelInfo.h"                                                                                                                                                                                
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +52,7 @@ double Lgm_McIlwain_L( long int Date, double UTC, Lgm_Vector *u, double Alpha, i
     int             reset;
     Lgm_Vector      v1, v2, v3, Bvec, Bvectmp, Ptmp, u_scale;
     double          rat, B, sa, sa2, Blocal, dSa, dSb, r, SS, L, stmp, Hdid, Hnext, Btmp;
+    Lgm_DipoleFL    f;
 
     u_scale.x = u_scale.y = u_scale.z = 1.0;
 
@@ -76,6 +83,38 @@ double Lgm_McIlwain_L( long int Date, double UTC, Lgm_Vector *u, double Alpha, i
     mInfo->Bm = Blocal/sa2;
 
 
+    /*
+     *  For a pure dipole nothing needs to be traced (see Lgm_Dipole.c).
+     */
+    if ( Lgm_Dipole_IsPure( mInfo ) ) {
+
+        if ( Lgm_Dipole_Trace( u, &v1, &v2, &v3, mInfo->Lgm_LossConeHeight, mInfo ) != LGM_CLOSED ) return( L );
+
+        Lgm_Dipole_Line( &mInfo->Pmin, &f, mInfo );
+        if ( Lgm_Dipole_MirrorPoints( mInfo->Bm, &f, &mInfo->Pm_South, &mInfo->Pm_North, &SS, mInfo ) > 0 ) {
+            mInfo->Sm_South = 0.0;
+            mInfo->Sm_North = SS;
+            Lgm_Dipole_Integrals( mInfo->Bm, &f, I, NULL );
+            if (mInfo->VerbosityLevel > 0) printf("Lgm_McIlwain_L: Integral Invariant, I (dipole):      %g\n",  *I );
+        } else {
+            if (mInfo->VerbosityLevel > 0) printf("Mirror point below loss cone height.\n");
+        }
+
+        *M  = mInfo->c->M_cd;
+        *Bm = mInfo->Bm;
+        if ( *I < 0.0 ){
+            L = LGM_FILL_VALUE;
+        } else if ( Type == 0 ) {
+            L = LFromIBmM_McIlwain( *I, *Bm, *M );
+        } else {
+            L = LFromIBmM_Hilton( *I, *Bm, *M );
+        }
+
+        return( L );
+
+    }
+
+
 
     /*
      *  First do a trace to identify the FL type and some of its critical points.
@@ -251,3 +290,125 @@ double Lgm_McIlwain_L( long int Date, double UTC, Lgm_Vector *u, double Alpha, i
 }
 
 
+
+
+/*
+ *   Lgm_McIlwain_L_Batch
+ *   --------------------
+ */
+
+
+//! Compute McIlwain L for many positions, each at several pitch angles.
+/**
+ *  Each field line is traced only once (footpoint to footpoint and splined,
+ *  as Lgm_Setup_AlphaOfK() does) and I is then found for all of the pitch
+ *  angles on it at once with Iinv_interped_multi(), rather than re-tracing
+ *  to the mirror points for every pitch angle as Lgm_McIlwain_L() does. The
+ *  positions are done in parallel (OpenMP builds), each thread working on
+ *  its own copy of mInfo (only the evaluation counts and stats of mInfo
+ *  itself are changed). Results for position i and pitch angle j are at
+ *  index i*nAlpha + j.
+ *
+ *            \param[in]        n           Number of positions.
+ *            \param[in]        Date        Dates (e.g. 20101231), one per position.
+ *            \param[in]        UTC         Universal Times in decimal hours, one per position.
+ *            \param[in]        u           Positions (in GSM).
+ *            \param[in]        nAlpha      Number of pitch angles.
+ *            \param[in]        Alpha       Local pitch angles to compute L for. In degrees.
+ *            \param[in]        Type        Flag to indicate which alogorithm to use (0=original McIlwain; else use Hilton's formula).
+ *            \param[out]       L           McIlwain L (n*nAlpha values, LGM_FILL_VALUE where undefined).
+ *            \param[out]       I           The integral invariants (n*nAlpha values).
+ *            \param[out]       Bm          The mirror magnetic field values (n*nAlpha values).
+ *            \param[out]       M           The dipole magnetic moments used (n values).
+ *            \param[in,out]    mInfo       Properly initialized Lgm_MagModelInfo structure.
+ *
+ *            \return           The number of L values that are defined.
+ *
+ */
+int Lgm_McIlwain_L_Batch( int n, long int *Date, double *UTC, Lgm_Vector *u, int nAlpha, double *Alpha, int Type, double *L, double *I, double *Bm, double *M, Lgm_MagModelInfo *mInfo ) {
+
+    int                 i, j, k, nGood = 0;
+    double              sa, *sa2, SS;
+    Lgm_DateTime        d;
+    Lgm_MagModelInfo    *m;
+    Lgm_Vector          v1, v2, v3, Bvec;
+    Lgm_DipoleFL        f;
+
+    if ( ( n < 1 ) || ( nAlpha < 1 ) ) return( 0 );
+
+    sa2 = (double *) calloc( nAlpha, sizeof( double ) );
+    for ( j=0; j<nAlpha; j++ ) { sa = sin( Alpha[j]*RadPerDeg ); sa2[j] = sa*sa; }
+
+#if USE_OPENMP
+    #pragma omp parallel private(m,i,j,k,d,SS,v1,v2,v3,Bvec,f) reduction(+:nGood)
+#endif
+    {
+        m = Lgm_NewMagContext( mInfo );
+        m->UseInterpRoutines = TRUE;
+
+#if USE_OPENMP
+        #pragma omp for schedule(dynamic, 8)
+#endif
+        for ( i=0; i<n; i++ ) {
+
+            k = i*nAlpha;
+            for ( j=0; j<nAlpha; j++ ) L[k+j] = I[k+j] = Bm[k+j] = LGM_FILL_VALUE;
+            M[i] = LGM_FILL_VALUE;
+
+            d.Date = Date[i]; d.Time = UTC[i];
+
+            /*
+             *  Pure dipole; mirror points and I in closed form.
+             */
+            if ( Lgm_Dipole_IsPure( m ) ) {
+                Lgm_Set_Coord_Transforms( d.Date, d.Time, m->c );
+                if ( Lgm_Dipole_Trace( &u[i], &v1, &v2, &v3, m->Lgm_LossConeHeight, m ) != LGM_CLOSED ) continue;
+                m->Bfield( &u[i], &Bvec, m );
+                m->Blocal = Lgm_Magnitude( &Bvec );
+                Lgm_Dipole_Line( &m->Pmin, &f, m );
+                M[i] = m->c->M_cd;
+                for ( j=0; j<nAlpha; j++ ) {
+                    if ( !( sa2[j] > 0.0 ) ) continue;
+                    Bm[k+j] = m->Blocal/sa2[j];
+                    if ( Lgm_Dipole_MirrorPoints( Bm[k+j], &f, &v1, &v2, &SS, m ) < 0 ) continue;
+                    Lgm_Dipole_Integrals( Bm[k+j], &f, &I[k+j], NULL );
+                    L[k+j] = ( Type == 0 ) ? LFromIBmM_McIlwain( I[k+j], Bm[k+j], M[i] ) : LFromIBmM_Hilton( I[k+j], Bm[k+j], M[i] );
+                    ++nGood;
+                }
+                continue;
+            }
+
+            if ( Lgm_Setup_AlphaOfK( &d, &u[i], m ) != LGM_CLOSED ) {
+                if ( m->AllocedSplines ) FreeSpline( m );
+                continue;
+            }
+            m->P_gsm = u[i];
+
+            for ( j=0; j<nAlpha; j++ ) Bm[k+j] = ( sa2[j] > 0.0 ) ? m->Blocal/sa2[j] : LGM_FILL_VALUE;
+            Iinv_interped_multi( nAlpha, &Bm[k], &I[k], m );
+            Lgm_TearDown_AlphaOfK( m );
+
+            M[i] = m->c->M_cd;
+            for ( j=0; j<nAlpha; j++ ) {
+                if ( ( I[k+j] < 0.0 ) || ( I[k+j] == LGM_FILL_VALUE ) || ( Bm[k+j] == LGM_FILL_VALUE ) ) continue;
+                L[k+j] = ( Type == 0 ) ? LFromIBmM_McIlwain( I[k+j], Bm[k+j], M[i] ) : LFromIBmM_Hilton( I[k+j], Bm[k+j], M[i] );
+                ++nGood;
+            }
+
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_McIlwain_L_Batch)
+#endif
+        {
+            mInfo->Lgm_nMagEvals += m->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( mInfo, m );
+        }
+        Lgm_FreeMagInfo( m );
+    }
+
+    free( sa2 );
+
+    return( nGood );
+
+}
@@ -0,0 +1,485 @@
+/*! \file Lgm_MemoryUsage.c
+ *
+ *  \brief Reports of how much memory the library's structures are holding.
+ *
+ *  \details
+ *      A batch job's memory is mostly in a few places: the shell line arrays
+ *      of the Lgm_MagEphemInfo (which grow with the number of pitch angles),
+ *      the Lgm_LstarInfo copies each thread has, the FL arrays of their
+ *      Lgm_MagModelInfo's, the DE ephemeris, and for the scattered data
+ *      models the Octree or KdTree and the RBF hash tables or cache. The
+ *      Lgm_*_MemoryUsage() routines add all of that up, from the sizes the
+ *      structures already keep (nAllocedPnts, vec_rbf_ht_size, nCells, ...),
+ *      so that a scheduler can be told what a job will need instead of
+ *      finding out from the OOM killer.
+ *
+ *      With LGM_MEMORY_REPORT=text (or json) set, the MagEphem and LCDS
+ *      tools print a Lgm_MemoryReport of their structures, and the peak RSS,
+ *      at the end of a run.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "Lgm/Lgm_MemoryUsage.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *  The bucket table and bookkeeping of a uthash table. The per-item handles
+ *  are inside the items, so they are left out here.
+ */
+#define LGM_HASH_TABLE_BYTES( head )    ( ( (head) != NULL ) ? HASH_OVERHEAD( hh, (head) ) - HASH_COUNT( head )*sizeof( UT_hash_handle ) : 0 )
+
+
+/*
+ *  A Lgm_JPLephemInfo (the coefficient arrays read in, the per-record
+ *  buffers, and the file mapping if there is one).
+ */
+static size_t Lgm_JPLephem_MemoryUsage( Lgm_JPLephemInfo *jpl ) {
+
+    size_t  Bytes = sizeof( Lgm_JPLephemInfo );
+    int     k;
+
+    #define JPL_3D( a )     LGM_ARRAY_3D_BYTES( jpl->a##_nvals, jpl->a##_naxes, jpl->a##_ncoeffs, double )
+    if ( jpl->SunAlloced )          Bytes += JPL_3D( sun );
+    if ( jpl->EarthMoonAlloced )    Bytes += JPL_3D( earthmoon ) + JPL_3D( moon_wrt_earth );
+    if ( jpl->InnerPlanetsAlloced ) Bytes += JPL_3D( mercury ) + JPL_3D( venus ) + JPL_3D( mars );
+    if ( jpl->OuterPlanetsAlloced ) Bytes += JPL_3D( jupiter ) + JPL_3D( saturn ) + JPL_3D( uranus ) + JPL_3D( neptune ) + JPL_3D( pluto );
+    if ( jpl->LibrNutAlloced )      Bytes += JPL_3D( libration ) + JPL_3D( nutation );
+    #undef JPL_3D
+
+    for ( k=0; k<LGM_DE_NRECORDS; k++ ) {
+        if ( jpl->Rec[k].Buf != NULL ) Bytes += LGM_ARRAY_1D_BYTES( jpl->Rec[k].nAxes*jpl->Rec[k].nCoeffs, double );
+    }
+    Bytes += jpl->MapSize;
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The Lgm_CTrans, and its DE ephemeris if it has one. The leap second table
+ *  is shared by all of them and is not counted.
+ */
+size_t Lgm_CTrans_MemoryUsage( Lgm_CTrans *c ) {
+
+    size_t  Bytes;
+
+    if ( c == NULL ) return( 0 );
+
+    Bytes = sizeof( Lgm_CTrans );
+    if ( c->jpl_initialized && ( c->jpl != NULL ) ) Bytes += Lgm_JPLephem_MemoryUsage( c->jpl );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The Lgm_MagModelInfo, its Lgm_CTrans, FL arrays and interpolants,
+ *  QuadPack work space, TS07 arrays, kNN buffers and RBF hash tables. Its
+ *  share of the Config is Config/nRef. The Octree, KdTree, Gridded field,
+ *  RBF_Snapshot(Pair), RBF_Cache, TraceHistory and stage hooks belong to the
+ *  caller and are not counted.
+ */
+size_t Lgm_MagModelInfo_MemoryUsage( Lgm_MagModelInfo *Info ) {
+
+    size_t              Bytes, ConfigBytes;
+    Lgm_DFI_RBF_Info    *rbf, *tmp;
+    int                 k, Limit;
+
+    if ( Info == NULL ) return( 0 );
+
+    Bytes  = sizeof( Lgm_MagModelInfo );
+    Bytes += Lgm_CTrans_MemoryUsage( Info->c );
+
+    /*
+     *  FL arrays and interpolants
+     */
+    Bytes += (size_t)Info->nAllocedPnts*( 6*sizeof( double ) + sizeof( Lgm_Vector ) );
+    Bytes += Info->FLSpline.nWork*sizeof( double );
+
+    for ( k=0; k<LGM_QUADPACK_NWORK; k++ ) {
+        if ( ( Limit = Info->Lgm_QuadPack_Work[k].Limit ) > 0 ) Bytes += (Limit+2)*sizeof( int ) + (4*Limit+2)*sizeof( double );
+    }
+
+    /*
+     *  TS07
+     */
+    if ( Info->TS07_Info.ArraysAlloced ) Bytes += LGM_ARRAY_1D_BYTES( 102, double );
+    if ( Info->TS07_Info.TailAlloced )   Bytes += LGM_ARRAY_2D_BYTES( 81, 6, double ) + 2*LGM_ARRAY_3D_BYTES( 81, 6, 5, double );
+    if ( Info->Config != NULL ) {
+        ConfigBytes = sizeof( Lgm_MagModelConfig );
+        if ( Info->Config->TS07_TSS ) ConfigBytes += LGM_ARRAY_2D_BYTES( 81, 6, double );
+        if ( Info->Config->TS07_TSO ) ConfigBytes += LGM_ARRAY_3D_BYTES( 81, 6, 5, double );
+        if ( Info->Config->TS07_TSE ) ConfigBytes += LGM_ARRAY_3D_BYTES( 81, 6, 5, double );
+        Bytes += ConfigBytes/( ( Info->Config->nRef > 0 ) ? Info->Config->nRef : 1 );
+    }
+
+    /*
+     *  Scattered data. vec_rbf_ht_size keeps the size (in MB) of both the B
+     *  and E fits; the DFI table has to be walked.
+     */
+    Bytes += (size_t)Info->Octree_kNN_Alloced*sizeof( Lgm_OctreeData );
+    Bytes += (size_t)Info->KdTree_kNN_Alloced*sizeof( Lgm_KdTreeData );
+    if ( Info->RBF_CB.Buf1 ) Bytes += (size_t)Info->RBF_CB.N*sizeof( Lgm_Vec_RBF_Info * );
+    if ( Info->RBF_CB.Buf2 ) Bytes += (size_t)Info->RBF_CB.N*sizeof( Lgm_Vec_RBF_Info * );
+
+    if ( Info->vec_rbf_ht != NULL ) {
+        Bytes += (size_t)( Info->vec_rbf_ht_size*1.0e6 );
+        Bytes += LGM_HASH_TABLE_BYTES( Info->vec_rbf_ht );
+    }
+    HASH_ITER( hh, Info->rbf_ht, rbf, tmp ) {
+        Bytes += sizeof( Lgm_DFI_RBF_Info ) + (size_t)rbf->n*( sizeof( unsigned long int ) + 2*sizeof( Lgm_Vector ) + 6*sizeof( double ) );
+    }
+    Bytes += LGM_HASH_TABLE_BYTES( Info->rbf_ht );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The Lgm_LstarInfo, its Lgm_MagModelInfo and saved shell lines. The
+ *  FieldLineCache, MinBMap and ShellHistory are the caller's.
+ */
+size_t Lgm_LstarInfo_MemoryUsage( Lgm_LstarInfo *LstarInfo ) {
+
+    size_t  Bytes;
+
+    if ( LstarInfo == NULL ) return( 0 );
+
+    Bytes  = sizeof( Lgm_LstarInfo );
+    Bytes += Lgm_MagModelInfo_MemoryUsage( LstarInfo->mInfo );
+    if ( LstarInfo->s_gsm ) Bytes += LGM_LSTARINFO_MAX_FL*sizeof( *LstarInfo->s_gsm );
+    if ( LstarInfo->Bmag )  Bytes += LGM_LSTARINFO_MAX_FL*sizeof( *LstarInfo->Bmag );
+    if ( LstarInfo->x_gsm ) Bytes += LGM_LSTARINFO_MAX_FL*sizeof( *LstarInfo->x_gsm );
+    if ( LstarInfo->y_gsm ) Bytes += LGM_LSTARINFO_MAX_FL*sizeof( *LstarInfo->y_gsm );
+    if ( LstarInfo->z_gsm ) Bytes += LGM_LSTARINFO_MAX_FL*sizeof( *LstarInfo->z_gsm );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The pool and every slot that has been used.
+ */
+size_t Lgm_LstarInfoPool_MemoryUsage( Lgm_LstarInfoPool *Pool ) {
+
+    size_t  Bytes;
+    int     i;
+
+    if ( Pool == NULL ) return( 0 );
+
+    Bytes = sizeof( Lgm_LstarInfoPool ) + (size_t)Pool->n*( sizeof( Lgm_LstarInfo * ) + sizeof( int ) );
+    for ( i=0; i<Pool->n; i++ ) Bytes += Lgm_LstarInfo_MemoryUsage( Pool->Slots[i] );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The Lgm_MagEphemInfo, its per pitch angle arrays, LstarInfo and
+ *  LstarInfoPool.
+ */
+size_t Lgm_MagEphemInfo_MemoryUsage( Lgm_MagEphemInfo *m ) {
+
+    size_t  Bytes, nPA, nFL, i;
+
+    if ( m == NULL ) return( 0 );
+
+    nPA = m->nAllocedAlpha;
+    nFL = LGM_LSTARINFO_MAX_FL;
+
+    Bytes  = sizeof( Lgm_MagEphemInfo );
+
+    // Alpha, Bm, I, Sb, Tb, K, LHilton, LMcIlwain, Hmin, Hmin_GeodLat, Hmin_GeodLon, Lstar
+    Bytes += 12*LGM_ARRAY_1D_BYTES( nPA, double );
+    // Pmn_gsm, Pms_gsm
+    Bytes +=  2*LGM_ARRAY_1D_BYTES( nPA, Lgm_Vector );
+    // nShellPoints, DriftOrbitType, LstarApprox
+    Bytes +=  3*LGM_ARRAY_1D_BYTES( nPA, int );
+
+    /*
+     *  The drift shell arrays (only there once SaveShellLines has been used,
+     *  see Lgm_MagEphemShellLines.c).
+     */
+    if ( m->ShellI != NULL ) {
+        // Shell{Spherical,Ellipsoid}Footprint_P{n,s}, ShellMirror_P{n,s}, Shell_{Bmin,Pmin,GradI,Vgc}
+        Bytes += 10*LGM_ARRAY_2D_BYTES( nPA, nFL, Lgm_Vector );
+        // Shell{Spherical,Ellipsoid}Footprint_{S,B}{n,s}, ShellMirror_S{n,s}, ShellI
+        Bytes += 11*LGM_ARRAY_2D_BYTES( nPA, nFL, double );
+        // nMinima, nMaxima, nFieldPnts, ShellLineOffset
+        Bytes +=  4*LGM_ARRAY_2D_BYTES( nPA, nFL, int );
+
+        // s_gsm, Bmag, x_gsm, y_gsm, z_gsm (packed floats) and nShellLinePntsAlloced
+        Bytes +=  5*nPA*sizeof( float * ) + LGM_ARRAY_1D_BYTES( nPA, int );
+        for ( i=0; i<nPA; i++ ) Bytes += 5*(size_t)m->nShellLinePntsAlloced[i]*sizeof( float );
+    }
+
+    Bytes += Lgm_LstarInfo_MemoryUsage( m->LstarInfo );
+    Bytes += Lgm_LstarInfoPool_MemoryUsage( m->LstarInfoPool );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The per time step arrays of a Lgm_MagEphemData (H5_nRows of them, which
+ *  is the ring size when the tools run with a Window) and the event arrays.
+ */
+size_t Lgm_MagEphemData_MemoryUsage( Lgm_MagEphemData *med ) {
+
+    size_t  Bytes, nRows, nPA, nEvents;
+
+    if ( med == NULL ) return( 0 );
+
+    nRows   = med->H5_nRows;
+    nPA     = med->H5_nPA;
+    nEvents = ( nRows < LGM_MAGEPHEM_MIN_EVENTS ) ? LGM_MAGEPHEM_MIN_EVENTS : nRows;
+
+    Bytes  = sizeof( Lgm_MagEphemData );
+
+    // Perigee, Apogee and Ascend times and positions
+    Bytes +=  3*LGM_ARRAY_2D_BYTES( nEvents, 80, char ) + 3*LGM_ARRAY_2D_BYTES( nEvents, 3, double );
+    Bytes +=    LGM_ARRAY_1D_BYTES( nPA, double );
+
+    // IsoTimes, FieldLineType, IntModel, ExtModel
+    Bytes +=  4*LGM_ARRAY_2D_BYTES( nRows, 80, char );
+    Bytes +=    LGM_ARRAY_1D_BYTES( nRows, long int ) + 3*LGM_ARRAY_1D_BYTES( nRows, int );
+    Bytes += 48*LGM_ARRAY_1D_BYTES( nRows, double );
+    Bytes +=  3*LGM_ARRAY_2D_BYTES( nRows, 2, double ) + 17*LGM_ARRAY_2D_BYTES( nRows, 3, double ) + 6*LGM_ARRAY_2D_BYTES( nRows, 4, double );
+
+    // per pitch angle quantities
+    Bytes += 11*LGM_ARRAY_2D_BYTES( nRows, nPA, double ) + LGM_ARRAY_2D_BYTES( nRows, nPA, int );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  An Octree. One loaded with Lgm_LoadOctree() is all in its mapping.
+ */
+size_t Lgm_Octree_MemoryUsage( Lgm_Octree *Octree ) {
+
+    size_t  Bytes;
+
+    if ( Octree == NULL ) return( 0 );
+
+    Bytes = sizeof( Lgm_Octree );
+    if ( Octree->Mapping ) {
+        Bytes += Octree->MappingSize;
+    } else {
+        Bytes += (size_t)Octree->nCells*sizeof( Lgm_OctreeCell );
+        if ( Octree->x ) Bytes += (size_t)( Octree->n + 1 )*( 6*sizeof( double ) + sizeof( unsigned long int ) );
+    }
+
+    return( Bytes );
+
+}
+
+
+static size_t Lgm_pQueue_MemoryUsage( Lgm_pQueue *q ) {
+    return( ( q != NULL ) ? sizeof( Lgm_pQueue ) + (size_t)q->nHeapArray*sizeof( Lgm_pQueue_Node ) : 0 );
+}
+
+/*
+ *  The nodes at and below Node. For a tree put together node by node each
+ *  has its own Min, Max and Diff, data items and positions; for one from
+ *  Lgm_KdTree_Init() or Lgm_KdTree_Load() (Pooled) those are in the pools
+ *  (or the mapping), so only the nodes are counted.
+ */
+static size_t KdTree_NodeBytes( Lgm_KdTreeNode *Node, int Pooled, long int *nNodes ) {
+
+    size_t  Bytes = 0;
+
+    if ( Node == NULL ) return( 0 );
+
+    ++(*nNodes);
+    if ( !Pooled ) {
+        Bytes += sizeof( Lgm_KdTreeNode ) + 3*(size_t)Node->D*sizeof( double );
+        if ( Node->Data ) Bytes += (size_t)Node->nData*( sizeof( Lgm_KdTreeData ) + Node->D*sizeof( double ) );
+    }
+    Bytes += KdTree_NodeBytes( Node->Left, Pooled, nNodes );
+    Bytes += KdTree_NodeBytes( Node->Right, Pooled, nNodes );
+
+    return( Bytes );
+
+}
+
+/*
+ *  A KdTree: its nodes, data items and priority queues (and for a pooled
+ *  tree, the node, data and bounds/position pools or the mapping).
+ */
+size_t Lgm_KdTree_MemoryUsage( Lgm_KdTree *KdTree ) {
+
+    size_t      Bytes;
+    long int    nNodes = 0;
+    int         Pooled;
+
+    if ( KdTree == NULL ) return( 0 );
+
+    Pooled = ( KdTree->NodePool != NULL );
+
+    Bytes  = sizeof( Lgm_KdTree );
+    Bytes += KdTree_NodeBytes( KdTree->Root, Pooled, &nNodes );
+    if ( Pooled ) {
+        Bytes += (size_t)nNodes*sizeof( Lgm_KdTreeNode );
+        Bytes += (size_t)( KdTree->n + 1 )*sizeof( Lgm_KdTreeData );
+        Bytes += KdTree->MappingSize;
+        if ( KdTree->Pool ) Bytes += ( (size_t)nNodes*3 + KdTree->n )*KdTree->Root->D*sizeof( double );
+    }
+    Bytes += Lgm_pQueue_MemoryUsage( KdTree->PQN );
+    Bytes += Lgm_pQueue_MemoryUsage( KdTree->PQP );
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  A Lgm_RBF_Cache: the shards, their entries and the fits they hold.
+ */
+size_t Lgm_RBF_Cache_MemoryUsage( Lgm_RBF_Cache *c ) {
+
+    size_t      Bytes;
+    long int    nEntries;
+    double      Size;
+    int         i;
+
+    if ( c == NULL ) return( 0 );
+
+    Lgm_RBF_Cache_Stats( c, NULL, NULL, NULL, NULL, &nEntries, &Size );
+    Bytes = sizeof( Lgm_RBF_Cache ) + (size_t)nEntries*sizeof( Lgm_RBF_CacheEntry ) + (size_t)( Size*1.0e6 );
+    for ( i=0; i<LGM_RBF_CACHE_NSHARDS; i++ ) {
+#if USE_OPENMP
+        Bytes += sizeof( omp_lock_t );
+#endif
+        Bytes += LGM_HASH_TABLE_BYTES( c->Shard[i].ht );
+    }
+
+    return( Bytes );
+
+}
+
+
+/*
+ *  The high water mark of the process's resident set, in bytes (0 if it
+ *  isnt known).
+ */
+size_t Lgm_PeakRSS( void ) {
+
+    struct rusage   ru;
+
+    if ( getrusage( RUSAGE_SELF, &ru ) != 0 ) return( 0 );
+#if defined(__APPLE__)
+    return( (size_t)ru.ru_maxrss );         // bytes
+#else
+    return( (size_t)ru.ru_maxrss*1024 );    // kB
+#endif
+
+}
+
+
+
+/*
+ *  0 if LGM_MEMORY_REPORT isnt set, else LGM_MEMORY_REPORT_JSON (for "json")
+ *  or LGM_MEMORY_REPORT_TEXT.
+ */
+int Lgm_MemoryReportMode( void ) {
+
+    char    *Env = getenv( "LGM_MEMORY_REPORT" );
+
+    if ( ( Env == NULL ) || ( Env[0] == '\0' ) || !strcmp( Env, "0" ) ) return( 0 );
+    return( strcmp( Env, "json" ) ? LGM_MEMORY_REPORT_TEXT : LGM_MEMORY_REPORT_JSON );
+
+}
+
+void Lgm_MemoryReport_Init( Lgm_MemoryReport *r ) {
+    r->n = 0;
+}
+
+void Lgm_MemoryReport_Add( const char *Name, size_t Bytes, Lgm_MemoryReport *r ) {
+
+    int     i;
+
+    for ( i=0; i<r->n; i++ ) if ( !strcmp( r->Name[i], Name ) ) break;
+    if ( i == r->n ) {
+        if ( r->n >= LGM_MEMORY_REPORT_MAX ) {
+            printf("Lgm_MemoryReport_Add(): Too many entries, %s not added\n", Name );
+            return;
+        }
+        strncpy( r->Name[i], Name, 63 ); r->Name[i][63] = '\0';
+        r->Count[i] = 0;
+        r->Bytes[i] = 0;
+        ++r->n;
+    }
+    ++r->Count[i];
+    r->Bytes[i] += Bytes;
+
+}
+
+size_t Lgm_MemoryReport_Total( Lgm_MemoryReport *r ) {
+
+    size_t  Total = 0;
+    int     i;
+
+    for ( i=0; i<r->n; i++ ) Total += r->Bytes[i];
+    return( Total );
+
+}
+
+/*
+ *  Print the entries, their total and the peak RSS as a table (Mode
+ *  LGM_MEMORY_REPORT_TEXT) or as JSON (LGM_MEMORY_REPORT_JSON).
+ */
+void Lgm_MemoryReport_Print( FILE *fp, int Mode, Lgm_MemoryReport *r ) {
+
+    int     i;
+
+    if ( Mode == LGM_MEMORY_REPORT_JSON ) {
+        fprintf( fp, "{ \"Structures\": [" );
+        for ( i=0; i<r->n; i++ ) {
+            fprintf( fp, "%s\n  { \"Name\": \"%s\", \"Count\": %ld, \"Bytes\": %zu }", ( i > 0 ) ? "," : "", r->Name[i], r->Count[i], r->Bytes[i] );
+        }
+        fprintf( fp, "\n], \"TotalBytes\": %zu, \"PeakRSSBytes\": %zu }\n", Lgm_MemoryReport_Total( r ), Lgm_PeakRSS() );
+    } else {
+        fprintf( fp, "Lgm memory usage:\n" );
+        fprintf( fp, "    %-28s %8s %14s\n", "Structure", "Count", "MB" );
+        for ( i=0; i<r->n; i++ ) {
+            fprintf( fp, "    %-28s %8ld %14.3f\n", r->Name[i], r->Count[i], r->Bytes[i]/1.0e6 );
+        }
+        fprintf( fp, "    %-28s %8s %14.3f\n", "Total", "", Lgm_MemoryReport_Total( r )/1.0e6 );
+        fprintf( fp, "    %-28s %8s %14.3f\n", "Peak RSS", "", Lgm_PeakRSS()/1.0e6 );
+    }
+    fflush( fp );
+
+}
+
+/*
+ *  Print the report as LGM_MEMORY_REPORT says, to LGM_MEMORY_REPORT_FILE (or
+ *  stderr). Does nothing if LGM_MEMORY_REPORT isnt set.
+ */
+void Lgm_MemoryReport_Write( Lgm_MemoryReport *r ) {
+
+    char    *Path = getenv( "LGM_MEMORY_REPORT_FILE" );
+    FILE    *fp = NULL;
+    int     Mode;
+
+    if ( (Mode = Lgm_MemoryReportMode()) == 0 ) return;
+    if ( Path != NULL ) fp = fopen( Path, "w" );
+    Lgm_MemoryReport_Print( ( fp != NULL ) ? fp : stderr, Mode, r );
+    if ( fp != NULL ) fclose( fp );
+
+}
@@ -13,207 +13,431 @@
 
 /******************************************************************************/
 
+/*
+ *  Growable string used to build all of the headers below. Appends are
+ *  amortized O(1) (the capacity doubles) so building a header is linear in
+ *  its length, and the caller gets a single right-sized allocation at the
+ *  end from Lgm_metadata_sbFinish().
+ */
+typedef struct Lgm_metadata_sb {
+  char   *s;
+  size_t len;
+  size_t cap;
+} Lgm_metadata_sb;
+
+static void Lgm_metadata_sbInit( Lgm_metadata_sb *sb, size_t cap ) {
+  sb->cap = (cap < 64) ? 64 : cap;
+  sb->s = malloc( sb->cap*sizeof(char) );
+  sb->len = 0;
+  sb->s[0] = '\0';
+}
+
+static void Lgm_metadata_sbGrow( Lgm_metadata_sb *sb, size_t need ) {
+  if (sb->len + need + 1 <= sb->cap) return;
+  while (sb->len + need + 1 > sb->cap) sb->cap *= 2;
+  sb->s = realloc( sb->s, sb->cap*sizeof(char) );
+}
+
+static void Lgm_metadata_sbAppend( Lgm_metadata_sb *sb, const char *str, size_t n ) {
+  Lgm_metadata_sbGrow( sb, n );
+  memcpy( sb->s + sb->len, str, n );
+  sb->len += n;
+  sb->s[sb->len] = '\0';
+}
+
+static void Lgm_metadata_sbPuts( Lgm_metadata_sb *sb, const char *str ) {
+  Lgm_metadata_sbAppend( sb, str, strlen(str) );
+}
+
+static void Lgm_metadata_sbPrintf( Lgm_metadata_sb *sb, const char *fmt, ... ) {
+  va_list ap;
+  int     n;
+
+  va_start( ap, fmt );
+  n = vsnprintf( sb->s + sb->len, sb->cap - sb->len, fmt, ap );
+  va_end( ap );
+  if ( n < 0 ) return;
+  if ( (size_t)n >= sb->cap - sb->len ) {
+    // didnt fit, grow and redo it
+    Lgm_metadata_sbGrow( sb, (size_t)n );
+    va_start( ap, fmt );
+    vsnprintf( sb->s + sb->len, sb->cap - sb->len, fmt, ap );
+    va_end( ap );
+  }
+  sb->len += n;
+}
+
+static char *Lgm_metadata_sbFinish( Lgm_metadata_sb *sb ) {
+  char *outstr = realloc( sb->s, (sb->len + 1)*sizeof(char) );
+  return ( outstr ? outstr : sb->s );
+}
+
+/******************************************************************************/
+
 void Lgm_metadata_initvar( Lgm_metadata_variable *var, int dimension, int data, char* name ) {
 
   int dm[] = {dimension};
+  char *dimstr;
   var->dimension = dimension;
   var->name = name;
   var->n_attrs = 0;
+  var->max_attrs = 0;
   var->attributes = NULL;
   var->data = data;
   //Lgm_metadata_addIntAttr(var, "DIMENSION", 1, &dimension); // the & since it wants a pointer
-  Lgm_metadata_addStringAttr( var, "DIMENSION", Lgm_metadata_intArrayToString(1, dm), 1 );
+  dimstr = Lgm_metadata_intArrayToString(1, dm);
+  Lgm_metadata_addStringAttr( var, "DIMENSION", dimstr, 1 );
+  free(dimstr);
 
 }
 
 /******************************************************************************/
 
-char *Lgm_metadata_JSONheader(int n_vars, ...) {
-  va_list hv;
-  char Buffer[Lgm_metadata_MAXHEADERLEN];
-  char *outstr;
-  size_t L;
+/*
+ *  TRUE if value is a number or a comma separated list of numbers (as made
+ *  by Lgm_metadata_intArrayToString() etc.). Only a leading number is not
+ *  enough, so e.g. a date like 2012-01-01 is still a string.
+ */
+static int Lgm_metadata_isNumeric( const char *value ) {
+  const char *p = value;
+  char *end;
+
+  while (1) {
+    strtod(p, &end);
+    if (end == p) return (0);
+    p = end;
+    while (*p == ' ') p++;
+    if (*p == '\0') return (1);
+    if (*p++ != ',') return (0);
+  }
+}
 
-  va_start(hv, n_vars);
-  
-  // loop over n_vars vars making them all into JSON headers
-  {
-    int i;
-    char *p;
-    char *tmp_str;
-    Lgm_metadata_variable* var_tmp;
-    int current_col=0;
-    char int_str[80]; 
-
-    // start the block
-    p = Buffer;
-    p += sprintf(p, "%c {\n", '#');
-    
-    for (i=0; i<n_vars; i++) {
-      var_tmp = va_arg(hv, Lgm_metadata_variable* );
-      if (var_tmp->data) {
-	Lgm_metadata_addIntAttr(var_tmp, "START_COLUMN", 1, &current_col); // the & since it wants a pointer
-	current_col += var_tmp->dimension;
+/*
+ *  Append one attribute value the way the JSON header wants it: bare if it
+ *  is numeric, quoted otherwise.
+ */
+static void Lgm_metadata_appendValue( Lgm_metadata_sb *sb, const char *value ) {
+  if (Lgm_metadata_isNumeric(value))
+    Lgm_metadata_sbPrintf(sb, "%s  ", value);
+  else
+    Lgm_metadata_sbPrintf(sb, "\"%s\"  ", value);
+}
+
+/*
+ *  Append the JSON for one variable. If tmpl is not NULL the position of
+ *  each attribute value is recorded in it as variable ivar.
+ */
+static void Lgm_metadata_appendVar( Lgm_metadata_sb *sb, Lgm_metadata_variable *var, char comment,
+                                    Lgm_metadata_template *tmpl, int ivar ) {
+  int i;
+
+  // add the name and start attrs
+  Lgm_metadata_sbPrintf(sb, "%c  \"%s\":%s{ ", comment, var->name, Lgm_metadata_TABCHAR);
+  // go through each attribute and add it to the string
+  for (i=0;i<var->n_attrs;i++) {
+    // add the name
+    Lgm_metadata_sbPrintf(sb, " \"%s\": ", (var->attributes)[i].name);
+    // if an array need a [
+    if ((var->attributes)[i].array)
+      Lgm_metadata_sbPuts(sb, "[ ");
+    // add the value
+    if (tmpl) {
+      Lgm_metadata_field *f;
+      if (tmpl->n_fields >= tmpl->max_fields) {
+        tmpl->max_fields = (tmpl->max_fields > 0) ? 2*tmpl->max_fields : 64;
+        tmpl->fields = realloc( tmpl->fields, tmpl->max_fields*sizeof(Lgm_metadata_field) );
       }
+      f = &tmpl->fields[tmpl->n_fields++];
+      f->var    = ivar;
+      f->attr   = i;
+      f->offset = sb->len;
+      f->value  = NULL;
+      Lgm_metadata_appendValue(sb, (var->attributes)[i].value);
+      f->len    = sb->len - f->offset;
+    } else {
+      Lgm_metadata_appendValue(sb, (var->attributes)[i].value);
+    }
+    // if an array need a ]
+    if ((var->attributes)[i].array)
+      Lgm_metadata_sbPuts(sb, "]");
+
+    // what ending do I need?
+    if (i+1 < var->n_attrs)
+      Lgm_metadata_sbPrintf(sb, ",\n%c %s%s", comment, Lgm_metadata_TABCHAR, Lgm_metadata_TABCHAR );
+    else
+      Lgm_metadata_sbPuts(sb, "}");
+  }
+}
+
+/*
+ *  Build the whole header for the n_vars variables in vars. Shared by
+ *  Lgm_metadata_JSONheader(), Lgm_metadata_JSONheaderArray() and
+ *  Lgm_metadata_JSONtemplate().
+ */
+static char *Lgm_metadata_buildHeader( int n_vars, Lgm_metadata_variable **vars, Lgm_metadata_template *tmpl, size_t *len ) {
+  Lgm_metadata_sb sb;
+  Lgm_metadata_variable* var_tmp;
+  int i;
+  int current_col=0;
 
-      tmp_str = Lgm_metadata_toJSON(var_tmp, i == (n_vars-1), '#');
-      p += sprintf(p, "%s", tmp_str);
-      if (i < n_vars-1)
-	p += sprintf(p, ",\n");
-      else 
-	p += sprintf(p, "\n");
-	
+  Lgm_metadata_sbInit(&sb, 1024);
+
+  // start the block
+  Lgm_metadata_sbPrintf(&sb, "%c {\n", '#');
+
+  // loop over n_vars vars making them all into JSON headers
+  for (i=0; i<n_vars; i++) {
+    var_tmp = vars[i];
+    if (var_tmp->data) {
+      Lgm_metadata_addIntAttr(var_tmp, "START_COLUMN", 1, &current_col); // the & since it wants a pointer
+      current_col += var_tmp->dimension;
     }
-    p += sprintf(p, "%c } # ENDJSON\n", '#');
+
+    Lgm_metadata_appendVar(&sb, var_tmp, '#', tmpl, i);
+    if (i < n_vars-1)
+      Lgm_metadata_sbPuts(&sb, ",\n");
+    else
+      Lgm_metadata_sbPuts(&sb, "\n");
   }
+  Lgm_metadata_sbPrintf(&sb, "%c } # ENDJSON\n", '#');
+
+  if (len) *len = sb.len;
+  return (Lgm_metadata_sbFinish(&sb));
+}
+
+/******************************************************************************/
+
+char *Lgm_metadata_JSONheader(int n_vars, ...) {
+  va_list hv;
+  Lgm_metadata_variable **vars;
+  char *outstr;
+  int i;
+
+  vars = (Lgm_metadata_variable **) calloc( (n_vars > 0) ? n_vars : 1, sizeof(Lgm_metadata_variable *) );
+  va_start(hv, n_vars);
+  for (i=0; i<n_vars; i++) vars[i] = va_arg(hv, Lgm_metadata_variable* );
   va_end(hv);
-  L = strlen(Buffer);
-  outstr = malloc( (L + 1)*sizeof(char));
-  strncpy(outstr, Buffer, L);
-  outstr[L] = '\0';
+
+  outstr = Lgm_metadata_buildHeader(n_vars, vars, NULL, NULL);
+  free(vars);
   return (outstr);
 }
 
 /******************************************************************************/
 
+/*
+ *  Same as Lgm_metadata_JSONheader() but with the variables in an array,
+ *  for when the number of variables is not known at compile time.
+ */
+char *Lgm_metadata_JSONheaderArray(int n_vars, Lgm_metadata_variable **vars) {
+  return (Lgm_metadata_buildHeader(n_vars, vars, NULL, NULL));
+}
+
+/******************************************************************************/
+
 char* Lgm_metadata_toJSON(Lgm_metadata_variable *var, short last, char comment) {
-  char Buffer[Lgm_metadata_MAXSINGLEVARHEADER]; 
-  char *outstr;
-  size_t L;
-  char *p;
+  Lgm_metadata_sb sb;
 
-  p = Buffer;
+  Lgm_metadata_sbInit(&sb, 256);
+  Lgm_metadata_appendVar(&sb, var, comment, NULL, 0);
+  return (Lgm_metadata_sbFinish(&sb));
+}
 
-  // add the name and start attrs
-  p += sprintf(p, "%c  \"%s\":%s{ ", comment, var->name, Lgm_metadata_TABCHAR);
-  // go through each attribute and add it to the string
-  {
-    int i;
-    double tmp;
-    for (i=0;i<var->n_attrs;i++) {
-      // add the name
-      p += sprintf(p, " \"%s\": ", (var->attributes)[i].name);
-      // if an array need a [
-      if ((var->attributes)[i].array) 
-	p += sprintf(p, "[ ");     
-      // add the value
-      if (sscanf((var->attributes)[i].value, "%lf", &tmp)) // returns 1 if the string can be a double
-	p += sprintf(p, "%s  ", (var->attributes)[i].value);
-      else
-	p += sprintf(p, "\"%s\"  ", (var->attributes)[i].value);
-      // if an array need a ]
-      if ((var->attributes)[i].array) 
-	p += sprintf(p, "]");     
-
-      // what ending do I need?
-      if (i+1 < var->n_attrs)
-	p += sprintf(p, ",\n%c %s%s", comment, Lgm_metadata_TABCHAR, Lgm_metadata_TABCHAR );
-      else
-	p += sprintf(p, "}");
+/******************************************************************************/
+
+/**
+ *  \brief
+ *      Render a JSON header once so that individual attribute values can
+ *      later be changed without rebuilding it.
+ *
+ *  \details
+ *      Takes the same arguments as Lgm_metadata_JSONheader() and renders the
+ *      header the same way, but also remembers where each attribute value
+ *      sits in the text. Use Lgm_metadata_PatchTemplate() to change values
+ *      (e.g. a file name or creation time that differs from file to file)
+ *      and Lgm_metadata_TemplateToString() to get the finished header. The
+ *      variables must stay alive for as long as the template is in use.
+ *
+ *      \param[in]      n_vars  Number of Lgm_metadata_variable pointers that follow.
+ *
+ *      \return         A new template; free with Lgm_metadata_FreeTemplate().
+ */
+Lgm_metadata_template *Lgm_metadata_JSONtemplate(int n_vars, ...) {
+  va_list hv;
+  Lgm_metadata_template *tmpl;
+  int i;
+
+  tmpl = (Lgm_metadata_template *) calloc( 1, sizeof(Lgm_metadata_template) );
+  tmpl->n_vars = n_vars;
+  tmpl->vars = (Lgm_metadata_variable **) calloc( (n_vars > 0) ? n_vars : 1, sizeof(Lgm_metadata_variable *) );
+
+  va_start(hv, n_vars);
+  for (i=0; i<n_vars; i++) tmpl->vars[i] = va_arg(hv, Lgm_metadata_variable* );
+  va_end(hv);
+  tmpl->text = Lgm_metadata_buildHeader(n_vars, tmpl->vars, tmpl, &tmpl->len);
+
+  return (tmpl);
+}
+
+/******************************************************************************/
+
+/**
+ *  \brief
+ *      Replace one attribute value in a template made by Lgm_metadata_JSONtemplate().
+ *
+ *  \details
+ *      The value is quoted (or not) by the same rule the full header uses.
+ *      The template text itself is left alone; the new value is spliced in
+ *      by Lgm_metadata_TemplateToString().
+ *
+ *      \param[in,out]  tmpl        The template.
+ *      \param[in]      var_name    Name of the variable the attribute belongs to.
+ *      \param[in]      attr_name   Name of the attribute.
+ *      \param[in]      value       New value (as a string, like all attributes).
+ *
+ *      \return         Lgm_metadata_SUCCESS, or Lgm_metadata_FAILURE if the
+ *                      attribute is not in the template.
+ */
+int Lgm_metadata_PatchTemplate( Lgm_metadata_template *tmpl, char *var_name, char *attr_name, char *value ) {
+  long i;
+  Lgm_metadata_field *f;
+  Lgm_metadata_variable *var;
+  Lgm_metadata_sb sb;
+
+  for (i=0; i<tmpl->n_fields; i++) {
+    f = &tmpl->fields[i];
+    var = tmpl->vars[f->var];
+    if ( (strcmp(var->name, var_name) == 0) && (strcmp(var->attributes[f->attr].name, attr_name) == 0) ) {
+      Lgm_metadata_sbInit(&sb, strlen(value) + 4);
+      Lgm_metadata_appendValue(&sb, value);
+      free(f->value);
+      f->value = Lgm_metadata_sbFinish(&sb);
+      return (Lgm_metadata_SUCCESS);
     }
   }
+  return (Lgm_metadata_FAILURE);
+}
 
-  L = strlen(Buffer);
-  outstr = malloc( (L + 1)*sizeof(char));
-  strncpy(outstr, Buffer, L);
-  outstr[L] = '\0';
-  return (outstr);
+/******************************************************************************/
+
+/**
+ *  \brief
+ *      Return the header text of a template with all patched values spliced in.
+ *
+ *      \param[in]      tmpl    The template.
+ *
+ *      \return         A newly allocated string; the caller frees it.
+ */
+char *Lgm_metadata_TemplateToString( Lgm_metadata_template *tmpl ) {
+  Lgm_metadata_sb sb;
+  Lgm_metadata_field *f;
+  size_t pos = 0;
+  long i;
+
+  Lgm_metadata_sbInit(&sb, tmpl->len + 1);
+  for (i=0; i<tmpl->n_fields; i++) {
+    f = &tmpl->fields[i];
+    if (f->value == NULL) continue;
+    Lgm_metadata_sbAppend(&sb, tmpl->text + pos, f->offset - pos);
+    Lgm_metadata_sbPuts(&sb, f->value);
+    pos = f->offset + f->len;
+  }
+  Lgm_metadata_sbAppend(&sb, tmpl->text + pos, tmpl->len - pos);
+
+  return (Lgm_metadata_sbFinish(&sb));
+}
+
+/******************************************************************************/
+
+void Lgm_metadata_FreeTemplate( Lgm_metadata_template *tmpl ) {
+  long i;
+  if (tmpl == NULL) return;
+  for (i=0; i<tmpl->n_fields; i++) free(tmpl->fields[i].value);
+  free(tmpl->fields);
+  free(tmpl->vars);
+  free(tmpl->text);
+  free(tmpl);
 }
 
 /******************************************************************************/
 
 char *Lgm_metadata_stringArrayToString(int len, char** instring) {
-  char Buffer[Lgm_metadata_MAXHEADERLEN];
-  char *outstr;
-  char *p;
-  size_t L;
+  Lgm_metadata_sb sb;
   int i;
 
-  // TODO in here there is no " at the start or stop of an array, feels odd
- 
-  p = Buffer;
-  for (i=0; i<len-1; i++){
-    p += sprintf(p, "%s\", ", instring[i]);
-  }
-  p += sprintf(p, "\"%s", instring[i]);  // i should have the right value in it
+  // there is no " at the start or stop of the array, the caller (Lgm_metadata_appendValue()) quotes the whole thing
 
-  L = strlen(Buffer);
-  outstr = malloc( (L + 1)*sizeof(char));
-  strncpy(outstr, Buffer, L);
-  outstr[L] = '\0';                                                                                     
-  return (outstr);
+  Lgm_metadata_sbInit(&sb, 80);
+  for (i=0; i<len; i++){
+    if (i > 0) Lgm_metadata_sbPuts(&sb, "\", \"");
+    Lgm_metadata_sbPuts(&sb, instring[i]);
+  }
+  return (Lgm_metadata_sbFinish(&sb));
 }
 
 /******************************************************************************/
 
 char *Lgm_metadata_intArrayToString(int len, int *invals ) {
-
-  char Buffer[Lgm_metadata_MAXHEADERLEN];
-  char *outstr;
-  char *p;
-  size_t L;
+  Lgm_metadata_sb sb;
   int i;
 
-  p = Buffer;
-  for (i=0; i<len-1; i++){
-    p += sprintf(p, "%d, ", invals[i]);
+  Lgm_metadata_sbInit(&sb, 16*len);
+  if (len > 0) {
+    for (i=0; i<len-1; i++){
+      Lgm_metadata_sbPrintf(&sb, "%d, ", invals[i]);
+    }
+    Lgm_metadata_sbPrintf(&sb, "%d ", invals[i]);  // i should have the right value in it
   }
-  p += sprintf(p, "%d ", invals[i]);  // i should have the right value in it
-
-  L = strlen(Buffer);
-  outstr = malloc( (L + 1)*sizeof(char));
-  strncpy(outstr, Buffer, L);
-  outstr[L] = '\0';  
-  return (outstr);
+  return (Lgm_metadata_sbFinish(&sb));
 
 }
 
 /******************************************************************************/
 
 char *Lgm_metadata_doubleArrayToString(int len, double* invals) {
-  char Buffer[Lgm_metadata_MAXHEADERLEN];
-  char *outstr;
-  char *p;
-  size_t L;
+  Lgm_metadata_sb sb;
   int i;
 
-  p = Buffer;
-  for (i=0; i<len-1; i++){
-    p += sprintf(p, "%lf, ", invals[i]);
+  Lgm_metadata_sbInit(&sb, 16*len);
+  if (len > 0) {
+    for (i=0; i<len-1; i++){
+      Lgm_metadata_sbPrintf(&sb, "%lf, ", invals[i]);
+    }
+    Lgm_metadata_sbPrintf(&sb, "%lf ", invals[i]);  // i should have the right value in it
   }
-  p += sprintf(p, "%lf ", invals[i]);  // i should have the right value in it
-
-  L = strlen(Buffer);
-  outstr = malloc( (L + 1)*sizeof(char));
-  strncpy(outstr, Buffer, L);
-  outstr[L] = '\0';                                                                                     
-  return (outstr);
+  return (Lgm_metadata_sbFinish(&sb));
 }
 
 /******************************************************************************/
 
 int Lgm_metadata_addIntAttr(Lgm_metadata_variable *var, char *name, int len, int *invals) {
   char *outstr;
+  int status;
   // make sure the name is not already there, if it is ignore it
   if (Lgm_metadata_AttrInVar(var, name))
     return (Lgm_metadata_FAILURE); // it is there we are done
 
   outstr = Lgm_metadata_intArrayToString(len,invals);
+  status = Lgm_metadata_addStringAttr(var, name, outstr, len>1);
+  free(outstr);
 
-  return (Lgm_metadata_addStringAttr(var, name, outstr, len>1) );
+  return (status);
 }
 
 /******************************************************************************/
 
 int Lgm_metadata_addDoubleAttr(Lgm_metadata_variable *var, char *name, int len, double *invals) {
   char *outstr;
+  int status;
   // make sure the name is not already there, if it is ignore it
   if (Lgm_metadata_AttrInVar(var, name))
     return (Lgm_metadata_FAILURE); // it is there we are done
 
   outstr = Lgm_metadata_doubleArrayToString(len,invals);
+  status = Lgm_metadata_addStringAttr(var, name, outstr, len>1);
+  free(outstr);
 
-  return (Lgm_metadata_addStringAttr(var, name, outstr, len>1) );
+  return (status);
 }
 
 
@@ -221,13 +445,16 @@ int Lgm_metadata_addDoubleAttr(Lgm_metadata_variable *var, char *name, int len,
 
 int Lgm_metadata_addStringAttrArray(Lgm_metadata_variable *var, char *name, int len, char **invals ) {
   char *outstr;
+  int status;
 
   // make sure the name is not already there, if it is ignore it
   if (Lgm_metadata_AttrInVar(var, name))
     return (Lgm_metadata_FAILURE); // it is there we are done
 
   outstr = Lgm_metadata_stringArrayToString(len, invals);
-  return (Lgm_metadata_addStringAttr(var, name, outstr, len>1) );
+  status = Lgm_metadata_addStringAttr(var, name, outstr, len>1);
+  free(outstr);
+  return (status);
 }
 
 /******************************************************************************/
@@ -235,7 +462,7 @@ int Lgm_metadata_addStringAttrArray(Lgm_metadata_variable *var, char *name, int
 int Lgm_metadata_addStringAttrArray2(Lgm_metadata_variable *var, char *name, int len, ... ) {
   char **outstrarr;
   va_list hv;
-  int i;
+  int i, status;
 
   // make sure the name is not already there, if it is ignore it
   if (Lgm_metadata_AttrInVar(var, name))
@@ -243,56 +470,63 @@ int Lgm_metadata_addStringAttrArray2(Lgm_metadata_variable *var, char *name, int
 
   va_start(hv, len);
 
-  LGM_ARRAY_2D( outstrarr,len, 80, char ); // this 80 is a limitiation here!!!
+  // only the pointers are needed, the strings are copied when the attr is added
+  outstrarr = (char **) calloc( (len > 0) ? len : 1, sizeof(char *) );
   for (i=0;i<len;i++) {
     outstrarr[i] = va_arg(hv, char*);
   }
   va_end(hv);
-  
-  return (Lgm_metadata_addStringAttrArray(var, name, len, outstrarr));
+
+  status = Lgm_metadata_addStringAttrArray(var, name, len, outstrarr);
+  free(outstrarr);
+  return (status);
 }
 
 /******************************************************************************/
 
 int Lgm_metadata_addStringAttr( Lgm_metadata_variable *var, char *name, char * value, int array ) {
 
-  Lgm_metadata_attr atr;
-  Lgm_metadata_variable newvar;
-  Lgm_metadata_attr* old_attr;
+  Lgm_metadata_attr *atr;
 
   // make sure the name is not already there, if it is ignore this call
   if (Lgm_metadata_AttrInVar(var, name))
     return (Lgm_metadata_FAILURE); // it is there we are done
 
-  atr.name = name;
-  atr.value = value;
-  atr.array = array;
- 
-  old_attr = var->attributes;
-
-  var->n_attrs++;
-  var->attributes = (Lgm_metadata_attr*) calloc(var->n_attrs, sizeof(Lgm_metadata_attr));
-  // put the ones back that were there
-  {
-    int i;
-    for (i=0; i<var->n_attrs-1;i++) { // the -1 is since we have a ++ above
-      var->attributes[i].name = old_attr[i].name;
-      var->attributes[i].value = old_attr[i].value;
-      var->attributes[i].array = old_attr[i].array;
-    }
+  // grow the attribute list by doubling so adding n attrs is O(n) not O(n^2)
+  if (var->n_attrs >= var->max_attrs) {
+    var->max_attrs = (var->max_attrs > 0) ? 2*var->max_attrs : 8;
+    var->attributes = (Lgm_metadata_attr*) realloc(var->attributes, var->max_attrs*sizeof(Lgm_metadata_attr));
   }
-  var->attributes[var->n_attrs - 1].name = malloc((1+strlen(name))*sizeof(char));
-  strcpy(var->attributes[var->n_attrs - 1].name, name);
-  var->attributes[var->n_attrs - 1].value = malloc((1+strlen(value))*sizeof(char));
-  strcpy(var->attributes[var->n_attrs - 1].value, value);
-  var->attributes[var->n_attrs - 1].array = array;
-
-  /* Lgm_metadata_initvar(var->start_column, var->dimension, var->name,  newvar); */
- free(old_attr);
- return (Lgm_metadata_SUCCESS);
+
+  atr = &var->attributes[var->n_attrs++];
+  atr->name = malloc((1+strlen(name))*sizeof(char));
+  strcpy(atr->name, name);
+  atr->value = malloc((1+strlen(value))*sizeof(char));
+  strcpy(atr->value, value);
+  atr->array = array;
+  atr->string = 0;
+
+  return (Lgm_metadata_SUCCESS);
 }
 
 
+/******************************************************************************/
+
+/*
+ *  Free the attributes of a variable (the variable itself and its name
+ *  belong to the caller).
+ */
+void Lgm_metadata_freevar( Lgm_metadata_variable *var ) {
+  long i;
+  for (i=0; i<var->n_attrs; i++) {
+    free(var->attributes[i].name);
+    free(var->attributes[i].value);
+  }
+  free(var->attributes);
+  var->attributes = NULL;
+  var->n_attrs = var->max_attrs = 0;
+}
+
 /******************************************************************************/
 
 int Lgm_metadata_AttrInVar(Lgm_metadata_variable *var, char *name) {
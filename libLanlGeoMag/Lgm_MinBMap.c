@@ -0,0 +1,260 @@
+/*! \file Lgm_MinBMap.c
+ *
+ *  \brief Trace a whole (MLT, r) grid of field lines to the min-B surface at once.
+ *
+ *  Equatorial maps, LCDS searches and drift shell plots all want Pmin, Bmin
+ *  and the field line type over an MLT x radius grid. Done point by point,
+ *  each trace starts from scratch. Lgm_ComputeMinBMap() instead does each
+ *  MLT in parallel (OpenMP builds) and sweeps outward in radius with a
+ *  Lgm_TraceHistory attached, so every trace is seeded with the step sizes
+ *  and arc lengths of the neighbour that was just done (see
+ *  Lgm_TraceHistory.c).
+ *
+ *  Grid point (i, j) is the field line through the point at MLT[i] and
+ *  radius R[j] in the SM equatorial plane. The results are kept as separate
+ *  arrays indexed by i*nR + j:
+ *
+ *      FieldLineType   -- what Lgm_Trace() returned (LGM_CLOSED, ...)
+ *      Pmin, Bmin      -- min-B point (GSM) and |B| there (LGM_FILL_VALUE if not closed)
+ *      FootMlat        -- magnetic (SM) latitude of the northern footpoint at
+ *                         Lgm_LossConeHeight (LGM_FILL_VALUE if not closed)
+ *
+ *  FootMlat is the same footpoint latitude that FindShellLine() searches on
+ *  with ISearchMethod 2, so a map can be attached to an Lgm_LstarInfo
+ *  structure (LstarInfo->MinBMap) and Lstar() will use it to predict how far
+ *  in mlat each shell line is from the one before (see
+ *  Lgm_MinBMap_FootMlat()).
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_MINBMAP_TRACE_TOL   1e-7
+
+
+/*
+ *  Allocate a map with nMLT MLTs evenly spaced over 0-24h (starting at 0)
+ *  and nR radii evenly spaced from R0 to R1 (Re). Everything is set to
+ *  LGM_FILL_VALUE until Lgm_ComputeMinBMap() is called.
+ */
+Lgm_MinBMap *Lgm_InitMinBMap( int nMLT, int nR, double R0, double R1 ) {
+
+    int         i, n;
+    Lgm_MinBMap *Map;
+
+    if ( ( nMLT < 1 ) || ( nR < 1 ) ) {
+        printf("Lgm_InitMinBMap: Invalid grid size (nMLT = %d, nR = %d)\n", nMLT, nR );
+        return( NULL );
+    }
+
+    Map = (Lgm_MinBMap *) calloc( 1, sizeof( *Map ) );
+    Map->nMLT = nMLT;
+    Map->nR   = nR;
+    n         = nMLT*nR;
+
+    Map->MLT           = (double *) calloc( nMLT, sizeof( double ) );
+    Map->R             = (double *) calloc( nR, sizeof( double ) );
+    Map->FieldLineType = (int *) calloc( n, sizeof( int ) );
+    Map->Pmin          = (Lgm_Vector *) calloc( n, sizeof( Lgm_Vector ) );
+    Map->Bmin          = (double *) calloc( n, sizeof( double ) );
+    Map->FootMlat      = (double *) calloc( n, sizeof( double ) );
+
+    for ( i=0; i<nMLT; i++ ) Map->MLT[i] = 24.0*i/(double)nMLT;
+    for ( i=0; i<nR; i++ )   Map->R[i]   = ( nR > 1 ) ? R0 + (R1-R0)*i/(double)(nR-1) : R0;
+
+    for ( i=0; i<n; i++ ) {
+        Map->FieldLineType[i] = LGM_OPEN_IMF;
+        Map->Pmin[i].x = Map->Pmin[i].y = Map->Pmin[i].z = LGM_FILL_VALUE;
+        Map->Bmin[i]     = LGM_FILL_VALUE;
+        Map->FootMlat[i] = LGM_FILL_VALUE;
+    }
+
+    return( Map );
+
+}
+
+
+void Lgm_FreeMinBMap( Lgm_MinBMap *Map ) {
+
+    if ( Map == NULL ) return;
+    free( Map->MLT );
+    free( Map->R );
+    free( Map->FieldLineType );
+    free( Map->Pmin );
+    free( Map->Bmin );
+    free( Map->FootMlat );
+    free( Map );
+
+}
+
+
+/*
+ *  Do one MLT of the map, sweeping outward in R.
+ */
+static int Lgm_ComputeMinBMap_Row( Lgm_MinBMap *Map, int i, Lgm_MagModelInfo *m ) {
+
+    int                 j, k, nClosed = 0;
+    double              Phi, MaxShift;
+    Lgm_Vector          u, u_sm, v1, v2, v3, w;
+    Lgm_TraceHistory    *h;
+
+    /*
+     *  Radial neighbours have to count as "the same trace" for the seeds to
+     *  be used.
+     */
+    MaxShift = ( Map->nR > 1 ) ? 1.5*fabs( Map->R[1] - Map->R[0] ) : -1.0;
+    h = Lgm_InitTraceHistory( MaxShift, 8 );
+    Lgm_MagModelInfo_Set_TraceHistory( h, m );
+
+    Phi = ( Map->MLT[i] - 12.0 )*15.0*RadPerDeg;
+    for ( j=0; j<Map->nR; j++ ) {
+
+        k = i*Map->nR + j;
+
+        u_sm.x = Map->R[j]*cos( Phi ); u_sm.y = Map->R[j]*sin( Phi ); u_sm.z = 0.0;
+        Lgm_Convert_Coords( &u_sm, &u, SM_TO_GSM, m->c );
+
+        Map->FieldLineType[k] = Lgm_Trace( &u, &v1, &v2, &v3, m->Lgm_LossConeHeight, LGM_MINBMAP_TRACE_TOL, LGM_MINBMAP_TRACE_TOL, m );
+        if ( Map->FieldLineType[k] == LGM_CLOSED ) {
+            Map->Pmin[k] = v3;
+            Map->Bmin[k] = m->Bmin;
+            Lgm_Convert_Coords( &v2, &w, GSM_TO_SM, m->c );
+            Map->FootMlat[k] = DegPerRad*asin( w.z/Lgm_Magnitude( &w ) );
+            ++nClosed;
+        } else {
+            // an open line says nothing useful about its neighbour
+            Lgm_ResetTraceHistory( h );
+        }
+
+    }
+
+    Lgm_MagModelInfo_Set_TraceHistory( NULL, m );
+    Lgm_FreeTraceHistory( h );
+
+    return( nClosed );
+
+}
+
+
+/**
+ *  \brief
+ *      Fill in an Lgm_MinBMap for the current model and time.
+ *
+ *  \details
+ *      Each grid point is traced with Lgm_Trace() down to
+ *      m->Lgm_LossConeHeight in both hemispheres and to the min-B surface.
+ *      The MLTs are done in parallel (OpenMP builds) on copies of m; within
+ *      an MLT the radii are done in order, each seeded by the one before.
+ *
+ *      \param[in,out]  Map     Map from Lgm_InitMinBMap().
+ *      \param[in,out]  m       Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *      \return The number of grid points that are on closed field lines.
+ *
+ */
+int Lgm_ComputeMinBMap( Lgm_MinBMap *Map, Lgm_MagModelInfo *m ) {
+
+    int                 i, n, nClosed = 0;
+    Lgm_MagModelInfo    *m2;
+
+    if ( Map == NULL ) return( 0 );
+
+#if USE_OPENMP
+    #pragma omp parallel private(m2,n)
+    #pragma omp for schedule(dynamic, 1) reduction(+:nClosed)
+#endif
+    for ( i=0; i<Map->nMLT; i++ ) {
+
+        m2 = Lgm_NewMagContext( m );
+        n  = Lgm_ComputeMinBMap_Row( Map, i, m2 );
+        nClosed += n;
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_ComputeMinBMap)
+#endif
+        {
+            m->Lgm_nMagEvals += m2->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( m, m2 );
+        }
+        Lgm_FreeMagInfo( m2 );
+
+    }
+
+    return( nClosed );
+
+}
+
+
+/*
+ *  Footpoint mlat where Bmin crosses the given value along row i (searching
+ *  outward from the Earth). Returns FALSE if it doesnt.
+ */
+static int Lgm_MinBMap_RowFootMlat( Lgm_MinBMap *Map, int i, double Bmin, double *mlat ) {
+
+    int     j, k;
+    double  a, b, f;
+
+    for ( j=1; j<Map->nR; j++ ) {
+        k = i*Map->nR + j;
+        if ( ( Map->FieldLineType[k-1] != LGM_CLOSED ) || ( Map->FieldLineType[k] != LGM_CLOSED ) ) continue;
+        a = log( Map->Bmin[k-1] ); b = log( Map->Bmin[k] );
+        if ( ( ( a - log( Bmin ) )*( b - log( Bmin ) ) <= 0.0 ) && ( a != b ) ) {
+            f = ( log( Bmin ) - a )/( b - a );
+            *mlat = Map->FootMlat[k-1] + f*( Map->FootMlat[k] - Map->FootMlat[k-1] );
+            return( TRUE );
+        }
+    }
+
+    return( FALSE );
+
+}
+
+
+/**
+ *  \brief
+ *      Estimate the footpoint mlat of the line at a given MLT whose min-B value is Bmin.
+ *
+ *  \details
+ *      Lines of constant Bmin are the drift shell of equatorially mirroring
+ *      particles, so this is a good first guess for the shell lines that
+ *      FindShellLine() looks for (it is only exact at 90 degrees). The two
+ *      MLTs of the map either side of MLT are each searched in R for the
+ *      Bmin crossing, and the footpoint mlats found are interpolated in MLT.
+ *
+ *      \param[in]      Map     Map filled in by Lgm_ComputeMinBMap().
+ *      \param[in]      MLT     Magnetic local time (hours).
+ *      \param[in]      Bmin    Value of Bmin (nT).
+ *      \param[out]     mlat    Estimated mlat (degrees) of the northern footpoint at Lgm_LossConeHeight.
+ *
+ *      \return TRUE if an estimate could be made, FALSE otherwise (e.g. the contour is not closed there).
+ *
+ */
+int Lgm_MinBMap_FootMlat( Lgm_MinBMap *Map, double MLT, double Bmin, double *mlat ) {
+
+    int     i0, i1;
+    double  f, x, mlat0, mlat1;
+
+    if ( ( Map == NULL ) || ( Bmin <= 0.0 ) ) return( FALSE );
+
+    x  = fmod( MLT, 24.0 ); if ( x < 0.0 ) x += 24.0;
+    x *= Map->nMLT/24.0;
+    i0 = (int)x; if ( i0 >= Map->nMLT ) i0 = Map->nMLT-1;
+    i1 = ( i0 + 1 )%Map->nMLT;
+    f  = x - i0;
+
+    if ( !Lgm_MinBMap_RowFootMlat( Map, i0, Bmin, &mlat0 ) ) return( FALSE );
+    if ( !Lgm_MinBMap_RowFootMlat( Map, i1, Bmin, &mlat1 ) ) return( FALSE );
+
+    *mlat = mlat0 + f*( mlat1 - mlat0 );
+
+    return( TRUE );
+
+}
@@ -0,0 +1,276 @@
+/*! \file Lgm_ModelState.c
+ *
+ *  \brief Keys for "the same magnetic state", shared by all of the caches.
+ *
+ *  \details
+ *      The field line cache, the Bm radius cache, gridded fields, L* tables,
+ *      the MagEphem results cache and the shared memory cache all need to
+ *      know whether the state they were built for is the one in effect now.
+ *      That state is spread over the Lgm_MagModelInfo (the models and their
+ *      inputs), its Lgm_CTrans (the time, which sets the tilt and the IGRF
+ *      coefficients) and the tracing tolerances. Lgm_ModelState_Key() makes
+ *      a 128-bit key from just the parts of that that matter for the model
+ *      in use (e.g. Kp for T89, but P, Dst, By, Bz and W[] for TS04), and the
+ *      Flags say which of the three groups to take in:
+ *
+ *          LGM_MODELSTATE_INPUTS   The model and the inputs it uses.
+ *          LGM_MODELSTATE_TIME     The time.
+ *          LGM_MODELSTATE_TOLS     Tolerances that change traced results
+ *                                  (and the loss cone height).
+ *          LGM_MODELSTATE_PORTABLE Identify the model by name rather than by
+ *                                  address, so the key is the same in every
+ *                                  process. Models that arent known (e.g.
+ *                                  user supplied ones) then get a null key,
+ *                                  which means "dont share".
+ *
+ *      Doubles are rounded to LGM_MODELSTATE_BITS significant bits before
+ *      they are hashed (and -0 is taken as 0), so values that differ only in
+ *      round-off (e.g. from being interpolated a slightly different way)
+ *      give the same key.
+ *
+ *      The two halves of the key are independent 64-bit hashes (FNV-1a and
+ *      a multiply-xorshift one). Caches that only keep an unsigned long use
+ *      Lgm_ModelKey_Fold(). Callers can add whatever else their tables
+ *      depend on with Lgm_ModelKey_Add() / Lgm_ModelKey_AddDouble().
+ *
+ *      Lgm_ModelState_Changed() is the "has anything changed since" check.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_MODELSTATE_LO0  14695981039346656037UL  // FNV-1a offset basis
+#define LGM_MODELSTATE_HI0  0x6a09e667f3bcc909UL
+
+
+/**
+ *  A key with nothing in it yet.
+ */
+Lgm_ModelKey Lgm_ModelKey_Init( void ) {
+
+    Lgm_ModelKey    k;
+
+    k.Lo = LGM_MODELSTATE_LO0;
+    k.Hi = LGM_MODELSTATE_HI0;
+
+    return( k );
+
+}
+
+/**
+ *  Fold n bytes at p into the key.
+ */
+void Lgm_ModelKey_Add( Lgm_ModelKey *k, const void *p, size_t n ) {
+
+    const unsigned char *b = (const unsigned char *)p;
+    unsigned long       Lo = k->Lo, Hi = k->Hi;
+    size_t              i;
+
+    for ( i=0; i<n; ++i ) {
+        Lo ^= b[i];
+        Lo *= 1099511628211UL;
+        Hi ^= b[i];
+        Hi *= 0x9e3779b97f4a7c15UL;
+        Hi ^= Hi >> 29;
+    }
+
+    k->Lo = Lo; k->Hi = Hi;
+
+}
+
+/**
+ *  Fold a double into the key, rounded to LGM_MODELSTATE_BITS significant
+ *  bits.
+ */
+void Lgm_ModelKey_AddDouble( Lgm_ModelKey *k, double x ) {
+
+    int     e;
+    double  f;
+
+    if ( x == 0.0 ) {
+        x = 0.0;        // -0
+    } else if ( x != x ) {
+        x = LGM_FILL_VALUE;
+    } else if ( isfinite( x ) ) {
+        f = frexp( x, &e );
+        x = ldexp( rint( ldexp( f, LGM_MODELSTATE_BITS ) ), e - LGM_MODELSTATE_BITS );
+    }
+    Lgm_ModelKey_Add( k, &x, sizeof(x) );
+
+}
+
+static void Lgm_ModelKey_AddInt( Lgm_ModelKey *k, int i ) {
+    Lgm_ModelKey_Add( k, &i, sizeof(i) );
+}
+
+/**
+ *  64-bit version of a key (never 0, unless the key is null).
+ */
+unsigned long Lgm_ModelKey_Fold( Lgm_ModelKey k ) {
+
+    unsigned long   h;
+
+    if ( Lgm_ModelKey_IsNull( k ) ) return( 0 );
+    h = k.Lo ^ ( k.Hi*0xbf58476d1ce4e5b9UL );
+
+    return( h ? h : 1 );
+
+}
+
+
+/*
+ *  Add the inputs in m that Bfield uses. Models that arent listed get all of
+ *  them.
+ */
+static void Lgm_ModelState_Inputs( Lgm_ModelKey *k, int (*Bfield)(), Lgm_MagModelInfo *m ) {
+
+    int i;
+
+    if ( ( Bfield == Lgm_B_igrf ) || ( Bfield == Lgm_B_cdip ) || ( Bfield == Lgm_B_edip ) || ( Bfield == Lgm_B_OP77 ) ) {
+        // no inputs
+    } else if ( ( Bfield == Lgm_B_T89 ) || ( Bfield == Lgm_B_T89c ) || ( Bfield == Lgm_B_T87 ) ) {
+        Lgm_ModelKey_AddInt( k, m->Kp );
+    } else if ( Bfield == Lgm_B_TU82 ) {
+        Lgm_ModelKey_AddInt( k, m->Kp );
+        Lgm_ModelKey_AddDouble( k, m->fKp );
+    } else if ( Bfield == Lgm_B_OP88 ) {
+        Lgm_ModelKey_AddDouble( k, m->Den );
+        Lgm_ModelKey_AddDouble( k, m->V );
+        Lgm_ModelKey_AddDouble( k, m->Dst );
+    } else if ( Bfield == Lgm_B_TS07 ) {
+        Lgm_ModelKey_AddDouble( k, m->P );
+    } else {
+        Lgm_ModelKey_AddDouble( k, m->P );
+        Lgm_ModelKey_AddDouble( k, m->Dst );
+        Lgm_ModelKey_AddDouble( k, m->By );
+        Lgm_ModelKey_AddDouble( k, m->Bz );
+        if ( Bfield != Lgm_B_T96 ) {
+            Lgm_ModelKey_AddDouble( k, m->G1 );
+            Lgm_ModelKey_AddDouble( k, m->G2 );
+            Lgm_ModelKey_AddDouble( k, m->G3 );
+            for ( i=0; i<6; i++ ) Lgm_ModelKey_AddDouble( k, m->W[i] );
+            if ( ( Bfield != Lgm_B_TS04 ) && ( Bfield != Lgm_B_T01S ) && ( Bfield != Lgm_B_T02 ) ) {
+                Lgm_ModelKey_AddDouble( k, m->Bx );
+                Lgm_ModelKey_AddDouble( k, m->V );
+                Lgm_ModelKey_AddDouble( k, m->Den );
+                Lgm_ModelKey_AddInt( k, m->Kp );
+                Lgm_ModelKey_AddDouble( k, m->fKp );
+                Lgm_ModelKey_AddInt( k, m->aKp3 );
+            }
+        }
+    }
+
+}
+
+/*
+ *  Add the identity of the model. FALSE if it has to be portable and it
+ *  isnt one we know.
+ */
+static int Lgm_ModelState_Model( Lgm_ModelKey *k, int (*Bfield)(), int Flags, Lgm_MagModelInfo *m ) {
+
+    static int      (*Models[])() = { Lgm_B_T89, Lgm_B_T89c, Lgm_B_T87, Lgm_B_T96, Lgm_B_T01S, Lgm_B_T02, Lgm_B_TS04, Lgm_B_TS07,
+                                      Lgm_B_OP77, Lgm_B_OP88, Lgm_B_TU82, Lgm_B_igrf, Lgm_B_cdip, Lgm_B_edip };
+    int             i, n = sizeof(Models)/sizeof(Models[0]);
+
+    if ( Flags & LGM_MODELSTATE_PORTABLE ) {
+        for ( i=0; ( i<n ) && ( Models[i] != Bfield ); ++i );
+        if ( i == n ) return( FALSE );
+        Lgm_ModelKey_AddInt( k, i );
+    } else {
+        Lgm_ModelKey_Add( k, &Bfield, sizeof(Bfield) );
+    }
+    Lgm_ModelKey_AddInt( k, m->InternalModel );
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Key of the magnetic state Bfield sees in m.
+ *
+ *  \details
+ *      See the notes at the top of the file. If Bfield is Lgm_B_Gridded the
+ *      key is that of the gridded model plus the grid's spacing, extent and
+ *      error bound, so a grid and the model it was made from get different
+ *      keys (callers that want them to be the same pass Gridded->Bsrc).
+ *
+ *      \param[in]      Bfield      Field model routine.
+ *      \param[in]      Flags       OR of LGM_MODELSTATE_* flags.
+ *      \param[in]      m           Model settings (and m->c for the time).
+ *
+ *      \return         The key. Null (see Lgm_ModelKey_IsNull()) if
+ *                      LGM_MODELSTATE_PORTABLE was asked for and the model
+ *                      isnt a known one.
+ */
+Lgm_ModelKey Lgm_ModelState_Key( int (*Bfield)(), int Flags, Lgm_MagModelInfo *m ) {
+
+    Lgm_ModelKey        k = Lgm_ModelKey_Init(), Null = { 0, 0 };
+    Lgm_GriddedField    *G;
+
+    if ( Flags & LGM_MODELSTATE_INPUTS ) {
+
+        if ( ( Bfield == Lgm_B_Gridded ) && ( (G = m->Gridded) != NULL ) ) {
+            Lgm_ModelKey_AddInt( &k, -1 );     // marks a grid
+            Lgm_ModelKey_AddDouble( &k, G->h );
+            Lgm_ModelKey_AddDouble( &k, G->MaxErr );
+            Lgm_ModelKey_AddDouble( &k, G->xmin ); Lgm_ModelKey_AddDouble( &k, G->xmax );
+            Lgm_ModelKey_AddDouble( &k, G->ymin ); Lgm_ModelKey_AddDouble( &k, G->ymax );
+            Lgm_ModelKey_AddDouble( &k, G->zmin ); Lgm_ModelKey_AddDouble( &k, G->zmax );
+            Bfield = G->Bsrc;
+        }
+
+        if ( !Lgm_ModelState_Model( &k, Bfield, Flags, m ) ) return( Null );
+        Lgm_ModelState_Inputs( &k, Bfield, m );
+
+    }
+
+    if ( Flags & LGM_MODELSTATE_TIME ) {
+        Lgm_ModelKey_AddDouble( &k, m->c->UTC.JD );
+    }
+
+    if ( Flags & LGM_MODELSTATE_TOLS ) {
+        Lgm_ModelKey_AddDouble( &k, m->Lgm_LossConeHeight );
+        Lgm_ModelKey_AddInt(    &k, m->Lgm_MagStep_Integrator );
+        Lgm_ModelKey_AddDouble( &k, m->Lgm_TraceToMirrorPoint_Tol );
+        Lgm_ModelKey_AddDouble( &k, m->Lgm_TraceToEarth_Tol );
+        Lgm_ModelKey_AddDouble( &k, m->Lgm_TraceToBmin_Tol );
+        Lgm_ModelKey_AddDouble( &k, m->Lgm_TraceLine_Tol );
+        if ( m->InternalModel == LGM_IGRF ) {
+            Lgm_ModelKey_AddDouble( &k, m->c->Lgm_IGRF_CacheTol );
+            Lgm_ModelKey_AddDouble( &k, m->c->Lgm_IGRF_TruncTol );
+        }
+    }
+
+    return( k );
+
+}
+
+
+/**
+ *  \brief
+ *      Has the state changed since Key was made?
+ *
+ *  \details
+ *      Compares Key with Lgm_ModelState_Key( m->Bfield, Flags, m ) and then
+ *      sets Key to that. A null Key (e.g. one that is all zeros because the
+ *      structure it is in was calloc()'ed) always counts as changed.
+ *
+ *      \return         TRUE if the state is different from the one in Key.
+ */
+int Lgm_ModelState_Changed( Lgm_ModelKey *Key, int Flags, Lgm_MagModelInfo *m ) {
+
+    Lgm_ModelKey    k = Lgm_ModelState_Key( m->Bfield, Flags, m );
+    int             Changed;
+
+    Changed = Lgm_ModelKey_IsNull( *Key ) || !Lgm_ModelKey_Equal( k, *Key );
+    *Key = k;
+
+    return( Changed );
+
+}
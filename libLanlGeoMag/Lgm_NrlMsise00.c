@@ -1,9 +1,87 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "Lgm/Lgm_NrlMsise00.h"
 
 static const double RGAS = 831.4;
 
 #define ZETA(ZZ,ZL,p) ( (ZZ-ZL)*(p->RE+ZL)/(p->RE+ZZ) )
 
+/*
+ *  Slots of the GLOBE7() and GLOB7S() terms in a Lgm_Msis00State.
+ */
+#define LGM_MSIS00_PT       0
+#define LGM_MSIS00_PS       1
+#define LGM_MSIS00_PD(i)    (1+(i))
+#define LGM_MSIS00_PTL(i)   ((i)-1)
+#define LGM_MSIS00_PMA(i)   (3+(i))
+
+
+/*
+ *  GLOBE7() with parameters P for the state s (slot k), computed only the
+ *  first time.
+ */
+static double Msis00_GLOBE7( int k, double *P, Lgm_Msis00State *s, Lgm_Msis00Info *p ) {
+
+    if ( !(s->HaveG7 & (1U<<k)) ) {
+        s->G7[k] = GLOBE7( s->IYD, s->SEC, s->GLAT, s->GLONG, s->STL, s->F107A, s->F107, s->AP, P, p );
+        s->HaveG7 |= (1U<<k);
+        p->Msis00_Context = (void *)s;
+    }
+    return( s->G7[k] );
+
+}
+
+
+/*
+ *  GLOB7S() with parameters P for the state s (slot k), computed only the
+ *  first time. GLOB7S() works from the Legendre polynomials, local time and
+ *  Ap terms left in p by GLOBE7(), so those are redone first if the last
+ *  GLOBE7() call was for some other state.
+ */
+static double Msis00_GLOB7S( int k, double *P, Lgm_Msis00State *s, Lgm_Msis00Info *p ) {
+
+    if ( !(s->HaveG7S & (1U<<k)) ) {
+        if ( p->Msis00_Context != (void *)s ) {
+            s->G7[LGM_MSIS00_PT] = GLOBE7( s->IYD, s->SEC, s->GLAT, s->GLONG, s->STL, s->F107A, s->F107, s->AP, p->PT, p );
+            s->HaveG7 |= (1U<<LGM_MSIS00_PT);
+            p->Msis00_Context = (void *)s;
+        }
+        s->G7S[k] = GLOB7S( P, p );
+        s->HaveG7S |= (1U<<k);
+    }
+    return( s->G7S[k] );
+
+}
+
+
+/*
+ *  Set up a Lgm_Msis00State for the given time, location and geophysical
+ *  inputs (see GTD7() for what they are). Nothing is computed until the state
+ *  is used.
+ */
+void Lgm_Msis00_InitState( int IYD, double SEC, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, Lgm_Msis00State *s ) {
+
+    int I;
+
+    s->IYD   = IYD;
+    s->SEC   = SEC;
+    s->GLAT  = GLAT;
+    s->GLONG = GLONG;
+    s->STL   = STL;
+    s->F107A = F107A;
+    s->F107  = F107;
+    s->AP[0] = 0.0;
+    for ( I=1; I<=7; I++ ) s->AP[I] = AP[I];
+    s->HaveG7  = 0;
+    s->HaveG7S = 0;
+
+    return;
+
+}
+
+
 /*----------------------------------------------------------------------
  *    SUBROUTINE GTD7(IYD,SEC,ALT,GLAT,GLONG,STL,F107A,F107,AP,MASS,D,T)
  *
@@ -138,7 +216,7 @@ static const double RGAS = 831.4;
  *
  *       To get current values of SW: CALL TRETRV(SW)
  */
-void GTD7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p ) {
+void GTD7_State( double ALT, double MASS, double *D, double *T, Lgm_Msis00State *s, Lgm_Msis00Info *p ) {
 
     int     J, V1;
 //    double  DS[10], TS[3];
@@ -166,13 +244,13 @@ void GTD7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double ST
     /*
      * Test for changed input
      */
-    V1 = VTST7( IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, 1, p );
+    V1 = VTST7( s->IYD, s->SEC, s->GLAT, s->GLONG, s->STL, s->F107A, s->F107, s->AP, 1, p );
 V1 =1;
 
     /*
      * Latitude variation of gravity (none for SW(2)=0)
      */
-    XLAT = GLAT;
+    XLAT = s->GLAT;
     if ( p->SW[2] == 0 ) XLAT = 45.0;
     GLATF( XLAT, &p->GSURF, &p->RE );
 
@@ -197,7 +275,7 @@ V1 =1;
      * or altitude above ZN2(1) in mesosphere
      */
     if ( (V1 == 1) || (ALT > ZN2[1]) || (p->GTD7_ALAST > ZN2[1]) || (MSS != p->GTD7_MSSL) ) { 
-        GTS7( IYD, SEC, ALTT, GLAT, GLONG, STL, F107A, F107, AP, MSS, p->DS, p->TS, p );
+        GTS7_State( ALTT, MSS, p->DS, p->TS, s, p );
         DM28M = p->DM28;
         if (p->IMR == 1 ) DM28M = p->DM28*1.0e6; // metric adjustment
         p->GTD7_MSSL = MSS;
@@ -221,11 +299,11 @@ V1 =1;
     if ( (V1 == 1) || (p->GTD7_ALAST >= ZN2[1]) ) {
         p->TGN2[1] = p->TGN1[2];
         p->TN2[1]  = p->TN1[5];
-        p->TN2[2]  = p->PMA[1][1]*p->PAVGM[1]/(1.-p->SW[20]*GLOB7S(p->PMA_rc[1], p));
-        p->TN2[3]  = p->PMA[1][2]*p->PAVGM[2]/(1.-p->SW[20]*GLOB7S(p->PMA_rc[2], p));
-        p->TN2[4]  = p->PMA[1][3]*p->PAVGM[3]/(1.-p->SW[20]*p->SW[22]* GLOB7S( p->PMA_rc[3], p) );
+        p->TN2[2]  = p->PMA[1][1]*p->PAVGM[1]/(1.-p->SW[20]*Msis00_GLOB7S( LGM_MSIS00_PMA(1), p->PMA_rc[1], s, p ));
+        p->TN2[3]  = p->PMA[1][2]*p->PAVGM[2]/(1.-p->SW[20]*Msis00_GLOB7S( LGM_MSIS00_PMA(2), p->PMA_rc[2], s, p ));
+        p->TN2[4]  = p->PMA[1][3]*p->PAVGM[3]/(1.-p->SW[20]*p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(3), p->PMA_rc[3], s, p ) );
         g = p->PMA[1][3]*p->PAVGM[3]; g2 = g*g;
-        p->TGN2[2] = p->PAVGM[9]*p->PMA[1][10]*(1.0+p->SW[20]*p->SW[22]* GLOB7S( p->PMA_rc[10], p ) )*p->TN2[4]*p->TN2[4]/g2;
+        p->TGN2[2] = p->PAVGM[9]*p->PMA[1][10]*(1.0+p->SW[20]*p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(10), p->PMA_rc[10], s, p ) )*p->TN2[4]*p->TN2[4]/g2;
         p->TN3[1]  = p->TN2[4];
     }
 
@@ -241,12 +319,12 @@ V1 =1;
          */
         if ( (V1 == 1) || (p->GTD7_ALAST >= ZN3[1]) ) {
             p->TGN3[1] = p->TGN2[2];
-            p->TN3[2]  = p->PMA[1][4]*p->PAVGM[4]/(1.-p->SW[22]* GLOB7S( p->PMA_rc[4], p ) );
-            p->TN3[3]  = p->PMA[1][5]*p->PAVGM[5]/(1.-p->SW[22]* GLOB7S( p->PMA_rc[5], p ) );
-            p->TN3[4]  = p->PMA[1][6]*p->PAVGM[6]/(1.-p->SW[22]* GLOB7S( p->PMA_rc[6], p ) );
-            p->TN3[5]  = p->PMA[1][7]*p->PAVGM[7]/(1.-p->SW[22]* GLOB7S( p->PMA_rc[7], p ) );
+            p->TN3[2]  = p->PMA[1][4]*p->PAVGM[4]/(1.-p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(4), p->PMA_rc[4], s, p ) );
+            p->TN3[3]  = p->PMA[1][5]*p->PAVGM[5]/(1.-p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(5), p->PMA_rc[5], s, p ) );
+            p->TN3[4]  = p->PMA[1][6]*p->PAVGM[6]/(1.-p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(6), p->PMA_rc[6], s, p ) );
+            p->TN3[5]  = p->PMA[1][7]*p->PAVGM[7]/(1.-p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(7), p->PMA_rc[7], s, p ) );
             g = p->PMA[1][7]*p->PAVGM[7]; g2 = g*g;
-            p->TGN3[2] = p->PMA[1][8]*p->PAVGM[8]*(1.+p->SW[22]* GLOB7S( p->PMA_rc[1], p ) ) *p->TN3[5]*p->TN3[5]/g2;
+            p->TGN3[2] = p->PMA[1][8]*p->PAVGM[8]*(1.+p->SW[22]* Msis00_GLOB7S( LGM_MSIS00_PMA(1), p->PMA_rc[1], s, p ) ) *p->TN3[5]*p->TN3[5]/g2;
         }
 
     }
@@ -329,6 +407,116 @@ V1 =1;
 
 
 
+/*
+ *  GTD7() at a single point.
+ */
+void GTD7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p ) {
+
+    Lgm_Msis00State s;
+
+    Lgm_Msis00_InitState( IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, &s );
+    GTD7_State( ALT, MASS, D, T, &s, p );
+
+    return;
+
+}
+
+
+/*
+ *  GTD7() at the altitudes ALT[0..nAlt-1] (km) of one (time, location)
+ *  profile. The GLOBE7()/GLOB7S() terms are only evaluated once for the whole
+ *  profile. D[i] (at least 10 long) and T[i] (at least 3 long) get the D and
+ *  T outputs of GTD7() for ALT[i], including their index offset of 1.
+ */
+void GTD7_Profile( int IYD, double SEC, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, int nAlt, double *ALT, double MASS, double **D, double **T, Lgm_Msis00Info *p ) {
+
+    int             i;
+    Lgm_Msis00State s;
+
+    Lgm_Msis00_InitState( IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, &s );
+    for ( i=0; i<nAlt; i++ ) GTD7_State( ALT[i], MASS, D[i], T[i], &s, p );
+
+    return;
+
+}
+
+
+/*
+ *  GTD7() profiles at the altitudes ALT[0..nAlt-1] (km) over nPts locations
+ *  (GLAT[j], GLONG[j], STL[j]) at one time. The output for location j and
+ *  altitude i is in D[j*nAlt + i] and T[j*nAlt + i] (as in GTD7_Profile()).
+ */
+void GTD7_Grid( int IYD, double SEC, int nPts, double *GLAT, double *GLONG, double *STL, double F107A, double F107, double *AP, int nAlt, double *ALT, double MASS, double **D, double **T, Lgm_Msis00Info *p ) {
+
+    int j;
+
+    for ( j=0; j<nPts; j++ ) {
+        GTD7_Profile( IYD, SEC, GLAT[j], GLONG[j], STL[j], F107A, F107, AP, nAlt, ALT, MASS, &D[j*nAlt], &T[j*nAlt], p );
+    }
+
+    return;
+
+}
+
+
+
+/*
+ *  GTD7() (or GTD7D() if Drag is set) at n independent points.
+ */
+static void GTD7_Batch_( int Drag, int n, int *IYD, double *SEC, double *ALT, double *GLAT, double *GLONG, double *STL, double *F107A, double *F107, double **AP, double MASS, double **D, double **T, Lgm_Msis00Info *p ) {
+
+    int             i;
+    Lgm_Msis00Info  *q;
+
+#if USE_OPENMP
+    #pragma omp parallel private(q,i) if(n>16)
+#endif
+    {
+        q = Lgm_Msis00_CopyInfo( p );
+
+#if USE_OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for ( i=0; i<n; i++ ) {
+            if ( Drag ) {
+                GTD7D( IYD[i], SEC[i], ALT[i], GLAT[i], GLONG[i], STL[i], F107A[i], F107[i], AP[i], MASS, D[i], T[i], q );
+            } else {
+                GTD7( IYD[i], SEC[i], ALT[i], GLAT[i], GLONG[i], STL[i], F107A[i], F107[i], AP[i], MASS, D[i], T[i], q );
+            }
+        }
+
+        Lgm_FreeMsis00( q );
+    }
+
+    return;
+
+}
+
+
+/*
+ *  GTD7() at the n points (IYD[i], SEC[i], ALT[i], GLAT[i], GLONG[i], STL[i],
+ *  F107A[i], F107[i], AP[i]), e.g. the samples of an orbit. D[i] and T[i]
+ *  get the outputs for point i (as in GTD7_Profile()). The points are done in
+ *  parallel (OpenMP builds), each thread with its own copy of p that shares
+ *  p's coefficient tables; p itself is not changed.
+ */
+void GTD7_Batch( int n, int *IYD, double *SEC, double *ALT, double *GLAT, double *GLONG, double *STL, double *F107A, double *F107, double **AP, double MASS, double **D, double **T, Lgm_Msis00Info *p ) {
+    GTD7_Batch_( 0, n, IYD, SEC, ALT, GLAT, GLONG, STL, F107A, F107, AP, MASS, D, T, p );
+    return;
+}
+
+
+/*
+ *  As GTD7_Batch(), but with GTD7D() (D[i][6] is the effective mass density
+ *  for drag, including anomalous oxygen).
+ */
+void GTD7D_Batch( int n, int *IYD, double *SEC, double *ALT, double *GLAT, double *GLONG, double *STL, double *F107A, double *F107, double **AP, double MASS, double **D, double **T, Lgm_Msis00Info *p ) {
+    GTD7_Batch_( 1, n, IYD, SEC, ALT, GLAT, GLONG, STL, F107A, F107, AP, MASS, D, T, p );
+    return;
+}
+
+
+
 
 
 /*
@@ -456,6 +644,7 @@ void GHP7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double ST
 
     int     L, done, IDAY;
     double  PL, ZI, CL, CL2, CD, CA, Z, g, g2, XN, P, DIFF, XM, G, SH;
+    Lgm_Msis00State s;
 
 /*
     static double BM    = 1.3806E-19;
@@ -502,13 +691,14 @@ void GHP7( int IYD, double SEC, double ALT, double GLAT, double GLONG, double ST
 
     }
 
-    //  ITERATION LOOP
+    //  ITERATION LOOP (only the altitude changes)
+    Lgm_Msis00_InitState( IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, &s );
     L = 0;
     
     done = 0;
     while ( !done ) {
         ++L;
-        GTD7( IYD, SEC, Z, GLAT, GLONG, STL, F107A, F107, AP, 48, D, T, p );
+        GTD7_State( Z, 48, D, T, &s, p );
         XN = D[1] + D[2] + D[3] + D[4] + D[5] + D[7] + D[8];
         P = BM*XN*T[2];
         if ( p->IMR == 1) P *= 1.e-6;
@@ -694,7 +884,7 @@ int VTST7( double IYD, double SEC, double GLAT, double GLONG, double STL, double
  *       T(1) - EXOSPHERIC TEMPERATURE
  *       T(2) - TEMPERATURE AT ALT
  */
-void GTS7( double IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p ) {
+void GTS7_State( double ALT, double MASS, double *D, double *T, Lgm_Msis00State *s, Lgm_Msis00Info *p ) {
 
 /*
     static int      MN1     = 5;
@@ -731,10 +921,10 @@ double  G16H, DB16H, THO, T2, ZSHT, ZMHO, ZSHO;
     /*
      * Test for changed input
      */
-    V2 = VTST7( IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, 2, p );
+    V2 = VTST7( s->IYD, s->SEC, s->GLAT, s->GLONG, s->STL, s->F107A, s->F107, s->AP, 2, p );
 V2 =1;
 
-    YRD    = IYD;
+    YRD    = s->IYD;
     p->ZA     = p->PDL[16][2];
     ZN1[1] = p->ZA;
     for ( J=1; J<=9; J++ ) D[J] = 0.0;
@@ -743,7 +933,7 @@ V2 =1;
      * TINF VARIATIONS NOT IMPORTANT BELOW ZA OR ZN1(1)
      */
     if ( ALT > ZN1[1] ) {
-        if( (V2 == 1) || (p->GTS7_ALAST <= ZN1[1]) ) TINF = p->PTM[1]*p->PT[1]*( 1.0 + p->SW[16]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PT, p ) );
+        if( (V2 == 1) || (p->GTS7_ALAST <= ZN1[1]) ) TINF = p->PTM[1]*p->PT[1]*( 1.0 + p->SW[16]*Msis00_GLOBE7( LGM_MSIS00_PT, p->PT, s, p ) );
     } else {
         TINF = p->PTM[1]*p->PT[1];
     }
@@ -753,7 +943,7 @@ V2 =1;
      * GRADIENT VARIATIONS NOT IMPORTANT BELOW ZN1(5)
      */
     if ( ALT > ZN1[5] ) {
-        if( (V2 == 1) || (p->GTS7_ALAST <= ZN1[5]) ) p->G0 = p->PTM[4]*p->PS[1]*(1.0 + p->SW[19]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PS, p ));
+        if( (V2 == 1) || (p->GTS7_ALAST <= ZN1[5]) ) p->G0 = p->PTM[4]*p->PS[1]*(1.0 + p->SW[19]*Msis00_GLOBE7( LGM_MSIS00_PS, p->PS, s, p ));
     } else {
         p->G0 = p->PTM[4]*p->PS[1];
     }
@@ -763,7 +953,7 @@ V2 =1;
      * Calculate these temperatures only if input changed
      */
     if ( (V2 == 1) || (ALT < 300.0) ) {
-        p->TLB = p->PTM[2]*(1.0 + p->SW[17]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[4], p ))*p->PD[1][4];
+        p->TLB = p->PTM[2]*(1.0 + p->SW[17]*Msis00_GLOBE7( LGM_MSIS00_PD(4), p->PD_rc[4], s, p ))*p->PD[1][4];
         S = p->G0/(TINF-p->TLB);
     }
 
@@ -774,12 +964,12 @@ V2 =1;
      */
     if ( ALT < 300.0 ) {
         if ( (V2 == 1.0) || (p->GTS7_ALAST >= 300.0) ) {
-            p->TN1[2]  = p->PTM[7]*p->PTL[1][1]/(1.0 - p->SW[18]*GLOB7S( p->PTL_rc[1], p ));
-            p->TN1[3]  = p->PTM[3]*p->PTL[1][2]/(1.0 - p->SW[18]*GLOB7S( p->PTL_rc[2], p ));
-            p->TN1[4]  = p->PTM[8]*p->PTL[1][3]/(1.0 - p->SW[18]*GLOB7S( p->PTL_rc[3], p ));
-            p->TN1[5]  = p->PTM[5]*p->PTL[1][4]/(1.0 - p->SW[18]*p->SW[20]*GLOB7S( p->PTL_rc[4], p ));
+            p->TN1[2]  = p->PTM[7]*p->PTL[1][1]/(1.0 - p->SW[18]*Msis00_GLOB7S( LGM_MSIS00_PTL(1), p->PTL_rc[1], s, p ));
+            p->TN1[3]  = p->PTM[3]*p->PTL[1][2]/(1.0 - p->SW[18]*Msis00_GLOB7S( LGM_MSIS00_PTL(2), p->PTL_rc[2], s, p ));
+            p->TN1[4]  = p->PTM[8]*p->PTL[1][3]/(1.0 - p->SW[18]*Msis00_GLOB7S( LGM_MSIS00_PTL(3), p->PTL_rc[3], s, p ));
+            p->TN1[5]  = p->PTM[5]*p->PTL[1][4]/(1.0 - p->SW[18]*p->SW[20]*Msis00_GLOB7S( LGM_MSIS00_PTL(4), p->PTL_rc[4], s, p ));
             g = p->PTM[5]*p->PTL[1][4]; g2 = g*g;
-            p->TGN1[2] = p->PTM[9]*p->PMA[1][9]*(1.0 + p->SW[18]*p->SW[20]*GLOB7S( p->PMA_rc[9], p ))*p->TN1[5]*p->TN1[5]/g2;
+            p->TGN1[2] = p->PTM[9]*p->PMA[1][9]*(1.0 + p->SW[18]*p->SW[20]*Msis00_GLOB7S( LGM_MSIS00_PMA(9), p->PMA_rc[9], s, p ))*p->TN1[5]*p->TN1[5]/g2;
         }
     } else {
         p->TN1[2] = p->PTM[7]*p->PTL[1][1];
@@ -800,12 +990,12 @@ V2 =1;
     if ( MASS != 0 ) {
 
         // N2 variation factor at Zlb
-        G28 = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[3], p );
+        G28 = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(3), p->PD_rc[3], s, p );
         DAY = AMOD(YRD,1000);
 
         // VARIATION OF TURBOPAUSE HEIGHT
-        ZHF  = p->PDL[25][2]*(1.0 + p->SW[5]*p->PDL[25][1]*sin(DGTR*GLAT)*cos(DR*(DAY-p->PT[14])));
-        YRD  = IYD;
+        ZHF  = p->PDL[25][2]*(1.0 + p->SW[5]*p->PDL[25][1]*sin(DGTR*s->GLAT)*cos(DR*(DAY-p->PT[14])));
+        YRD  = s->IYD;
         T[1] = TINF;
         XMM  = p->PDM[5][3];
         Z    = ALT;
@@ -869,7 +1059,7 @@ V2 =1;
                          */
 
                         // Density variation factor at Zlb
-                        G4 = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[1], p );
+                        G4 = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(1), p->PD_rc[1], s, p );
 
                         // Diffusive density at Zlb
                         p->DB04 = p->PDM[1][1]*exp(G4)*p->PD[1][1];
@@ -911,7 +1101,7 @@ V2 =1;
                          */
 
                         // Density variation factor at Zlb
-                        G16 = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[2], p );
+                        G16 = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(2), p->PD_rc[2], s, p );
 
                         // Diffusive density at Zlb
                         p->DB16 =  p->PDM[1][2]*exp(G16)*p->PD[1][2];
@@ -939,7 +1129,7 @@ V2 =1;
                             //  3/16/99 Change form to match O2 departure from diff equil near 150
                             //  km and add dependence on F10.7
                             //  RL=ALOG(B28*PDM(2,2)*fabs(PDL(17,2))/B16)
-                            p->RL = p->PDM[2][2]*p->PDL[17][2]*( 1.0 + p->SW[1]*p->PDL[24][1]*(F107A-150.0) );
+                            p->RL = p->PDM[2][2]*p->PDL[17][2]*( 1.0 + p->SW[1]*p->PDL[24][1]*(s->F107A-150.0) );
                             HC16  = p->PDM[6][2]*p->PDL[4][2];
                             ZC16  = p->PDM[5][2]*p->PDL[3][2];
                             HC216 = p->PDM[6][2]*p->PDL[5][2];
@@ -962,7 +1152,7 @@ V2 =1;
                          */
 
                         //  Density variation factor at Zlb
-                        G32= p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[5], p );
+                        G32= p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(5), p->PD_rc[5], s, p );
 
                         //  Diffusive density at Zlb
                         p->DB32 = p->PDM[1][4]*exp(G32)*p->PD[1][5];
@@ -998,7 +1188,7 @@ V2 =1;
                             HCC32  = p->PDM[8][4]*p->PDL[23][2];
                             HCC232 = p->PDM[8][4]*p->PDL[23][1];
                             ZCC32  = p->PDM[7][4]*p->PDL[22][2];
-                            RC32   = p->PDM[4][4]*p->PDL[24][2]*( 1.0 + p->SW[1]*p->PDL[24][1]*(F107A-150.0) );
+                            RC32   = p->PDM[4][4]*p->PDL[24][2]*( 1.0 + p->SW[1]*p->PDL[24][1]*(s->F107A-150.0) );
 
                             //  Net density corrected at Alt
                             D[4] *= CCOR2( Z, RC32, HCC32, ZCC32, HCC232 );
@@ -1012,7 +1202,7 @@ V2 =1;
                          */
 
                         // Density variation factor at Zlb
-                        G40= p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[6], p );
+                        G40= p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(6), p->PD_rc[6], s, p );
 
                         // Diffusive density at Zlb
                         p->DB40 = p->PDM[1][5]*exp(G40)*p->PD[1][6];
@@ -1053,7 +1243,7 @@ V2 =1;
                          */
 
                         //  Density variation factor at Zlb
-                        G1 = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[7], p );
+                        G1 = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(7), p->PD_rc[7], s, p );
 
                         //  Diffusive density at Zlb
                         p->DB01 = p->PDM[1][6]*exp(G1)*p->PD[1][7];
@@ -1100,7 +1290,7 @@ V2 =1;
                          */
 
                         //  Density variation factor at Zlb
-                        G14 = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[8], p );
+                        G14 = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(8), p->PD_rc[8], s, p );
 
                         //  Diffusive density at Zlb
                         p->DB14 = p->PDM[1][7]*exp(G14)*p->PD[1][8];
@@ -1146,7 +1336,7 @@ V2 =1;
                         /* 
                          *  **** Anomalous OXYGEN DENSITY ****
                          */
-                        G16H  = p->SW[21]*GLOBE7( YRD, SEC, GLAT, GLONG, STL, F107A, F107, AP, p->PD_rc[9], p );
+                        G16H  = p->SW[21]*Msis00_GLOBE7( LGM_MSIS00_PD(9), p->PD_rc[9], s, p );
                         DB16H = p->PDM[1][8]*exp(G16H)*p->PD[1][9];
                         THO   = p->PDM[10][8]*p->PDL[7][1];
                         p->DD    = DENSU( Z, DB16H, THO, THO, 16.0, ALPHA[9], &T2, p->PTM[6], S, MN1, ZN1, p->TN1, p->TGN1, p );
@@ -1193,6 +1383,22 @@ V2 =1;
 
 
 
+/*
+ *  GTS7() at a single point.
+ */
+void GTS7( double IYD, double SEC, double ALT, double GLAT, double GLONG, double STL, double F107A, double F107, double *AP, double MASS, double *D, double *T, Lgm_Msis00Info *p ) {
+
+    Lgm_Msis00State s;
+
+    Lgm_Msis00_InitState( (int)IYD, SEC, GLAT, GLONG, STL, F107A, F107, AP, &s );
+    GTS7_State( ALT, MASS, D, T, &s, p );
+
+    return;
+
+}
+
+
+
 
 
 
@@ -1302,6 +1508,7 @@ double GLOBE7( double YRD, double SEC, double LAT, double LONG, double TLOC, dou
 
     if ( p->ISW != 64999 ) TSELEC( p->SV, p );
     for ( J=1; J<=14; J++ ) p->T[J] = 0;
+    p->Msis00_Context = NULL;   // (Msis00_GLOBE7() sets this after the call)
 
     if ( p->SW[9] > 0) SW9 =  1.0;
     if ( p->SW[9] < 0) SW9 = -1.0;
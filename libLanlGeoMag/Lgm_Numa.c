@@ -0,0 +1,203 @@
+/*! \file Lgm_Numa.c
+ *
+ *  \brief NUMA node lookup and thread pinning for the library's thread pool.
+ *
+ *  \details
+ *      On a multi-socket machine memory is local to one NUMA node, and a
+ *      thread that works on memory on another node pays for every cache miss
+ *      twice over. Linux puts a page on the node of the thread that first
+ *      touches it, so what matters is which thread allocates (and fills)
+ *      things:
+ *
+ *          - Worker contexts. Lgm_LstarInfoPool_Get() already makes a slot's
+ *            Lgm_LstarInfo (and its Lgm_MagModelInfo) on the thread that
+ *            first asks for it. With Lgm_SetNumaAware( TRUE ),
+ *            Lgm_LstarInfoPool_Acquire() also remembers which node each slot
+ *            was made on and only hands a thread slots from its own node
+ *            (making a new one if need be), so contexts dont wander across
+ *            sockets.
+ *
+ *          - Read-only tables. With Lgm_SetNumaAware( TRUE ) the decoded
+ *            AE8/AP8 maps (Lgm_AE8_AP8_GetTable()) are made once per node,
+ *            by the first thread on that node that needs them.
+ *
+ *      None of this helps if the OS keeps moving threads between nodes, so
+ *      Lgm_SetThreadPinning( TRUE ) has the threads of the team started by
+ *      Lgm_DefaultExecutor() pin themselves, thread k to the kth CPU the
+ *      process is allowed to run on. (OMP_PROC_BIND / OMP_PLACES do the same
+ *      for the whole program; this is for when the library shouldnt change
+ *      the binding of the rest of it.) The pinning sticks to the OpenMP
+ *      threads after the loop is done, and that includes the thread that
+ *      called Lgm_ParallelFor() (it is thread 0 of the team).
+ *
+ *      The node of a CPU is read from /sys/devices/system/node. Where that
+ *      (or sched_getcpu()/sched_setaffinity()) isnt there, everything is on
+ *      node 0 and pinning does nothing, so the settings are always safe to
+ *      use.
+ */
+#define _GNU_SOURCE
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_SCHED_GETCPU) || defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
+#include "Lgm/Lgm_Tasks.h"
+
+#define LGM_NUMA_MAX_CPUS   4096
+
+static int              Lgm_NumaAware      = 0;
+static int              Lgm_ThreadPinning  = 0;
+static volatile int     Lgm_NumaInitDone   = 0;
+static int              Lgm_nNumaNodes     = 1;
+static short            Lgm_CpuNode[LGM_NUMA_MAX_CPUS];    // (dense) node of each CPU
+
+
+/*
+ *  Read the CPU lists of the nodes. Nodes are renumbered 0, 1, 2, ... in
+ *  the order found (the kernel's numbers can have gaps).
+ */
+static void Lgm_NumaInit( void ) {
+
+    FILE    *fp;
+    char    Filename[128], Line[8192], *p, *q;
+    int     d, Node, n, a, b, k;
+
+    if ( Lgm_NumaInitDone ) return;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Numa)
+#endif
+    {
+        if ( !Lgm_NumaInitDone ) {
+
+            memset( Lgm_CpuNode, 0, sizeof( Lgm_CpuNode ) );
+            Node = 0;
+            for ( d=0; d<1024; d++ ) {
+                snprintf( Filename, 128, "/sys/devices/system/node/node%d/cpulist", d );
+                if ( (fp = fopen( Filename, "r" )) == NULL ) continue;
+                n = ( Node < LGM_NUMA_MAX_NODES ) ? Node : LGM_NUMA_MAX_NODES-1;
+                if ( fgets( Line, 8192, fp ) != NULL ) {
+                    // e.g. "0-31,64-95"
+                    for ( p = strtok_r( Line, ",\n", &q ); p != NULL; p = strtok_r( NULL, ",\n", &q ) ) {
+                        if ( sscanf( p, "%d-%d", &a, &b ) == 2 ) ;
+                        else if ( sscanf( p, "%d", &a ) == 1 ) b = a;
+                        else continue;
+                        for ( k=a; k<=b; k++ ) if ( ( k >= 0 ) && ( k < LGM_NUMA_MAX_CPUS ) ) Lgm_CpuNode[k] = n;
+                    }
+                }
+                fclose( fp );
+                ++Node;
+            }
+            Lgm_nNumaNodes   = ( Node < 1 ) ? 1 : ( Node > LGM_NUMA_MAX_NODES ) ? LGM_NUMA_MAX_NODES : Node;
+            Lgm_NumaInitDone = 1;
+
+        }
+    }
+
+}
+
+
+/**
+ *  Number of NUMA nodes (1 if it cant be found out, or if there are more
+ *  than LGM_NUMA_MAX_NODES, the rest are lumped in with the last one).
+ */
+int Lgm_NumaNodes( void ) {
+    Lgm_NumaInit();
+    return( Lgm_nNumaNodes );
+}
+
+
+/**
+ *  NUMA node (0 .. Lgm_NumaNodes()-1) of the CPU the calling thread is on
+ *  right now. Unless the thread is pinned, it may not still be there later.
+ */
+int Lgm_NumaNode( void ) {
+#if defined(HAVE_SCHED_GETCPU)
+    int cpu;
+    Lgm_NumaInit();
+    if ( Lgm_nNumaNodes < 2 ) return( 0 );
+    cpu = sched_getcpu();
+    return( ( ( cpu >= 0 ) && ( cpu < LGM_NUMA_MAX_CPUS ) ) ? Lgm_CpuNode[cpu] : 0 );
+#else
+    return( 0 );
+#endif
+}
+
+
+/**
+ *  Turn the NUMA aware placement of worker contexts and read-only tables on
+ *  or off (see the notes at the top of the file). Off by default. Like
+ *  Lgm_SetExecutor() this is a global setting.
+ */
+void Lgm_SetNumaAware( int Flag ) {
+    Lgm_NumaAware = ( Flag != 0 );
+}
+
+int Lgm_GetNumaAware( void ) {
+    return( Lgm_NumaAware );
+}
+
+/*
+ *  The node to put (or look up) per-node things for the calling thread.
+ *  Always 0 unless NUMA aware placement is on.
+ */
+int Lgm_NumaHome( void ) {
+    return( ( Lgm_NumaAware ) ? Lgm_NumaNode() : 0 );
+}
+
+
+/**
+ *  Have the threads of Lgm_DefaultExecutor()'s team pin themselves to CPUs
+ *  (see the notes at the top of the file). Off by default. Like
+ *  Lgm_SetExecutor() this is a global setting.
+ */
+void Lgm_SetThreadPinning( int Flag ) {
+    Lgm_ThreadPinning = ( Flag != 0 );
+}
+
+int Lgm_GetThreadPinning( void ) {
+    return( Lgm_ThreadPinning );
+}
+
+
+/**
+ *  Pin the calling thread to the kth (mod the number of them) CPU that the
+ *  process is allowed to run on. The allowed set is the one the process
+ *  started with, so pinning one thread doesnt shrink it for the others.
+ *  Returns the CPU, or -1 if the thread wasnt pinned.
+ */
+int Lgm_PinThread( int k ) {
+#if defined(HAVE_SCHED_SETAFFINITY)
+    static cpu_set_t    Allowed;
+    static int          nAllowed = -1;
+    cpu_set_t           Set;
+    int                 cpu, j;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Numa)
+#endif
+    {
+        if ( nAllowed < 0 ) {
+            if ( sched_getaffinity( 0, sizeof( cpu_set_t ), &Allowed ) == 0 ) nAllowed = CPU_COUNT( &Allowed );
+            else nAllowed = 0;
+        }
+    }
+    if ( ( nAllowed < 1 ) || ( k < 0 ) ) return( -1 );
+
+    k %= nAllowed;
+    for ( j=0, cpu=0; cpu<CPU_SETSIZE; cpu++ ) {
+        if ( CPU_ISSET( cpu, &Allowed ) && ( j++ == k ) ) break;
+    }
+    if ( cpu == CPU_SETSIZE ) return( -1 );
+
+    CPU_ZERO( &Set );
+    CPU_SET( cpu, &Set );
+    return( ( sched_setaffinity( 0, sizeof( cpu_set_t ), &Set ) == 0 ) ? cpu : -1 );
+#else
+    return( -1 );
+#endif
+}
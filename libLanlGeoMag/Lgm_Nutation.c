@@ -248,3 +248,164 @@ void Lgm_Nutation( double T_TT, double nTerms, double *dPsi, double *dEps ) {
     *dEps = EpsSum*0.0001;
 
 }
+
+
+/**
+ *  \brief
+ *      Bound on the error from truncating the IAU 1980 nutation series to its first nTerms terms.
+ *
+ *  \details
+ *      This is the sum of the amplitudes (with the T_TT rates evaluated at
+ *      one century from J2000) of the terms that are left out, taking the
+ *      larger of the dPsi and dEps sums. The terms are stored in order of
+ *      decreasing amplitude, so this falls off quickly with nTerms. For
+ *      example:
+ *
+ *          nTerms      error bound (arcsec)
+ *          ------      --------------------
+ *             106              0
+ *              60          6.1e-3
+ *              30          2.5e-2
+ *              13          8.8e-2
+ *               4          4.9e-1
+ *
+ *      \param[in]      nTerms  Number of series terms used.
+ *
+ *      \return         Error bound in arcsec.
+ */
+double Lgm_Nutation_TruncationError( int nTerms ) {
+
+    int     i;
+    double  ePsi, eEps;
+
+    if ( nTerms < 0 ) nTerms = 0;
+    for ( ePsi = eEps = 0.0, i=nTerms; i<106; i++ ) {
+        ePsi += labs( A[i][0] ) + 0.1*labs( A[i][1] );
+        eEps += labs( A[i][2] ) + 0.1*labs( A[i][3] );
+    }
+
+    return( ( ( ePsi > eEps ) ? ePsi : eEps )*0.0001 );
+
+}
+
+
+/*
+ *  Number of Chebyshev coefficients needed to fit one day of the nTerms
+ *  series to within Tol (arcsec). For a term of amplitude A and angular rate
+ *  W, the degree N Chebyshev interpolant over a half-width h is in error by
+ *  at most A (W h)^(N+1) / ( 2^N (N+1)! ).
+ */
+static int Lgm_Nutation_nCoeffs( int nTerms, double Tol ) {
+
+    int     i, N;
+    double  h, w, Amp, Err, f;
+
+    // rates of the fundamental arguments (rad/day)
+    const double Rate[5] = { (1325.0*360.0 + 198.8675605)*RadPerDeg/36525.0, (99.0*360.0 + 359.0502911)*RadPerDeg/36525.0,
+                             (1342.0*360.0 + 82.0174577)*RadPerDeg/36525.0,  (1236.0*360.0 + 307.1114469)*RadPerDeg/36525.0,
+                             -(5.0*360.0 + 134.1361851)*RadPerDeg/36525.0 };
+
+    h = 0.5;
+    for ( N=1; N<LGM_NUTATION_MAX_COEFFS-1; N++ ) {
+        f = 1.0; for ( i=1; i<=N+1; i++ ) f *= 2.0*i; f *= 0.5; // 2^N (N+1)!
+        for ( Err = 0.0, i=0; i<nTerms; i++ ) {
+            w   = fabs( a[i][0]*Rate[0] + a[i][1]*Rate[1] + a[i][2]*Rate[2] + a[i][3]*Rate[3] + a[i][4]*Rate[4] );
+            Amp = ( labs( A[i][0] ) + 0.1*labs( A[i][1] ) + labs( A[i][2] ) + 0.1*labs( A[i][3] ) )*0.0001;
+            Err += Amp*pow( w*h, N+1 )/f;
+        }
+        if ( Err <= Tol ) break;
+    }
+
+    return( N+1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Lgm_Nutation() evaluated from a per-day Chebyshev fit.
+ *
+ *  \details
+ *      The first call on a given TT day (0h to 24h TT) fits dPsi and dEps
+ *      from the nTerms series with Chebyshev polynomials and saves the fit in
+ *      nc; later calls within the same day just evaluate it (a short
+ *      Clenshaw recurrence rather than nTerms sin/cos pairs). This is what
+ *      Lgm_Set_Coord_Transforms() uses when the pnModel set with
+ *      Lgm_Set_CTrans_Options() is LGM_PN_IAU76_CACHED.
+ *
+ *      The fit is made only as accurate as the series it stands in for: its
+ *      error is kept below 1e-3 of Lgm_Nutation_TruncationError( nTerms )
+ *      (and below 1e-8 arcsec for the full series), so it is never the
+ *      dominant error. That takes 7 coefficients for the full series and
+ *      3-5 for truncated ones. Refitting costs that many series
+ *      evaluations, so this only pays off when there are several calls per
+ *      day (high-cadence runs); for sparse times use Lgm_Nutation().
+ *
+ *      \param[in]      T_TT    Julian centuries of TT since J2000.
+ *      \param[in]      nTerms  Number of series terms (at most 106).
+ *      \param[in,out]  nc      Cache (zero it before first use).
+ *      \param[out]     dPsi    Nutation in longitude (arcsec).
+ *      \param[out]     dEps    Nutation in obliquity (arcsec).
+ */
+void Lgm_Nutation_Cached( double T_TT, int nTerms, Lgm_NutationCache *nc, double *dPsi, double *dEps ) {
+
+    int     j, k, n;
+    double  d, x, x2, b0, b1, b2, e0, e1, e2, Tk, fPsi[LGM_NUTATION_MAX_COEFFS], fEps[LGM_NUTATION_MAX_COEFFS];
+
+    if ( nTerms > 106 ) nTerms = 106;
+    if ( nTerms < 1 ) {
+        *dPsi = *dEps = 0.0;
+        return;
+    }
+
+    /*
+     *  (Re)fit if this is a different day or series.
+     */
+    if ( ( nc->nTerms != nTerms ) || ( T_TT < nc->T0 ) || ( T_TT >= nc->T1 ) ) {
+
+        if ( nc->nTerms != nTerms ) {
+            nc->Tolerance = 1e-3*Lgm_Nutation_TruncationError( nTerms );
+            if ( nc->Tolerance < 1e-8 ) nc->Tolerance = 1e-8;
+            nc->nCoeffs   = Lgm_Nutation_nCoeffs( nTerms, nc->Tolerance );
+            nc->nTerms    = nTerms;
+        }
+        n = nc->nCoeffs;
+
+        // TT days run from JD x.5 (0h TT), i.e. J2000 + k - 0.5 days
+        d = floor( T_TT*36525.0 + 0.5 );
+        nc->T0 = ( d - 0.5 )/36525.0;
+        nc->T1 = ( d + 0.5 )/36525.0;
+
+        for ( k=0; k<n; k++ ) {
+            x  = cos( M_PI*(k+0.5)/n );
+            Tk = 0.5*( nc->T0 + nc->T1 ) + 0.5*( nc->T1 - nc->T0 )*x;
+            Lgm_Nutation( Tk, nTerms, &fPsi[k], &fEps[k] );
+        }
+        for ( j=0; j<n; j++ ) {
+            for ( b0 = e0 = 0.0, k=0; k<n; k++ ) {
+                x   = cos( M_PI*j*(k+0.5)/n );
+                b0 += fPsi[k]*x;
+                e0 += fEps[k]*x;
+            }
+            nc->cPsi[j] = 2.0*b0/n;
+            nc->cEps[j] = 2.0*e0/n;
+        }
+        nc->cPsi[0] *= 0.5;
+        nc->cEps[0] *= 0.5;
+
+    }
+
+    /*
+     *  Clenshaw recurrence.
+     */
+    x  = ( 2.0*T_TT - ( nc->T0 + nc->T1 ) )/( nc->T1 - nc->T0 );
+    x2 = 2.0*x;
+    b1 = b2 = e1 = e2 = 0.0;
+    for ( j=nc->nCoeffs-1; j>=1; j-- ) {
+        b0 = x2*b1 - b2 + nc->cPsi[j]; b2 = b1; b1 = b0;
+        e0 = x2*e1 - e2 + nc->cEps[j]; e2 = e1; e1 = e0;
+    }
+    *dPsi = x*b1 - b2 + nc->cPsi[0];
+    *dEps = x*e1 - e2 + nc->cEps[0];
+
+}
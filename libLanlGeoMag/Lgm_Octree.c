@@ -1,7 +1,15 @@
 /*! \file Lgm_Octree.c
  *
- *  \brief Set of routines for creating octrees (3D trees) and find k Nearest Neighbors.
+ *  \brief Set of routines for creating octrees (3D trees) and find k Nearest Neighbors
+ *  (or all of the points within a radius or a box).
  *
+ *  The octree is a "linear" octree. The points are sorted by the Morton
+ *  (Z-order) code formed by interleaving the bits of their x, y and z
+ *  location codes, which puts the points of every octree cell next to each
+ *  other. The cells are then built breadth first into a single array, each
+ *  one holding the range of sorted points it covers. No pointers are
+ *  followed during a search, and the point data are kept as separate x, y,
+ *  z, Bx, ... arrays so a leaf's points are contiguous in memory.
  *
  *
  *  \author M.G. Henderson
@@ -11,677 +19,719 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include "Lgm/Lgm_Octree.h"
+#include "Lgm/Lgm_PriorityQueue.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
-#include <sys/timeb.h>
-#include <sys/types.h>
-#include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#define OCTREE_RADIX_BITS       8
+#define OCTREE_RADIX_BUCKETS    (1<<OCTREE_RADIX_BITS)
+#define OCTREE_MORTON_BITS      (3*OCTREE_MAX_LEVELS)    // bits needed for a Morton code
+#define OCTREE_PARALLEL_MIN     65536                   // Below this many points, sort/build on one thread
+
 
-struct timeb  StartTime;
-double ElapsedTime2( struct timeb StartTime );
-//int total_callocs=0;
-//int total_frees=0;
+
+/*
+ * Spread the low 16 bits of x out so that there are two zero bits between each.
+ */
+static uint64_t Octree_Part1By2( uint64_t x ) {
+    x &= 0xffff;
+    x = (x | (x << 32)) & 0x1f00000000ffffULL;
+    x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+    x = (x | (x << 8))  & 0x100f00f00f00f00fULL;
+    x = (x | (x << 4))  & 0x10c30c30c30c30c3ULL;
+    x = (x | (x << 2))  & 0x1249249249249249ULL;
+    return( x );
+}
 
 /**
- *   Store given 3D data into an octree data structure.
- *
- *   Given 1D arrays of vector positions and vector data (e.g. B-field), this
- *   routine recursively partitions the data into an octree data structure. The
- *   octree can be used to very efficiently find nearest neighbors (using
- *   Lgm_Octree_kNN() ).
+ *   Morton (Z-order) code of a set of x, y and z location codes.
  *
- *      \param[in]      ObjectPoints   An array of position vectors
- *      \param[in]      ObjectData     An array of data vectors (e.g. B-field)
- *      \param[in]      N              Number of ObjectPoints
+ *   The bits are interleaved so that bits 3L, 3L+1 and 3L+2 of the code are
+ *   bit L of the x, y and z location codes. So (Code>>3L)&7 is the index
+ *   (x + 2y + 4z) of the octant a point is in below a cell at level L+1.
  *
- *      \returns        returns a pointer to the an Octree structure. User is
- *                      responsible to freeing this with Lgm_FreeOctree( )
+ *      \param[in]      xLocationCode   x location code.
+ *      \param[in]      yLocationCode   y location code.
+ *      \param[in]      zLocationCode   z location code.
  *
- *      \author         Mike Henderson
- *      \date           2009-2012
+ *      \returns        The Morton code.
  *
  */
-Lgm_Octree *Lgm_InitOctree( Lgm_Vector *ObjectPoints, Lgm_Vector *ObjectData, unsigned long int N ) {
-
-    double              Min, Max, Diff;
-    unsigned long int   j;
-    Lgm_OctreeCell      *t;
-    Lgm_Octree          *ot;
-
-    t = Lgm_CreateOctreeRoot();
-    t->nData      = N;
-    t->nDataBelow = t->nData;
-    t->Data       = (Lgm_OctreeData *) calloc( t->nData, sizeof( Lgm_OctreeData ) );
-    Max = -9e99;
-    Min = 9e99;
-    for (j=0; j<t->nData; j++){
-        t->Data[j].Id = j;
-        t->Data[j].Position.x = ObjectPoints[j].x;
-        t->Data[j].Position.y = ObjectPoints[j].y;
-        t->Data[j].Position.z = ObjectPoints[j].z;
-        t->Data[j].B.x = ObjectData[j].x;
-        t->Data[j].B.y = ObjectData[j].y;
-        t->Data[j].B.z = ObjectData[j].z;
-        /*
-         * Find scaling for data
-         */
-        if ( ObjectPoints[j].x > Max ) Max = ObjectPoints[j].x;
-        if ( ObjectPoints[j].y > Max ) Max = ObjectPoints[j].y;
-        if ( ObjectPoints[j].z > Max ) Max = ObjectPoints[j].z;
-        if ( ObjectPoints[j].x < Min ) Min = ObjectPoints[j].x;
-        if ( ObjectPoints[j].y < Min ) Min = ObjectPoints[j].y;
-        if ( ObjectPoints[j].z < Min ) Min = ObjectPoints[j].z;
-    }
+unsigned long Lgm_OctreeMortonCode( unsigned int xLocationCode, unsigned int yLocationCode, unsigned int zLocationCode ) {
+    return( (unsigned long)( Octree_Part1By2( xLocationCode ) | ( Octree_Part1By2( yLocationCode ) << 1 ) | ( Octree_Part1By2( zLocationCode ) << 2 ) ) );
+}
 
-    /*
-     * Scale Data (positions need to be in range of [0-1]
-     */
-    Diff = Max - Min;
-    for (j=0; j<t->nData; j++){
-        t->Data[j].Position.x = (t->Data[j].Position.x - Min)/Diff;
-        t->Data[j].Position.y = (t->Data[j].Position.y - Min)/Diff;
-        t->Data[j].Position.z = (t->Data[j].Position.z - Min)/Diff;
-    }
+/*
+ * Location code of a scaled coordinate. A coordinate of exactly 1.0 (the
+ * largest value after scaling) is put in the last cell rather than wrapping.
+ */
+static unsigned int Octree_LocationCode( double u ) {
+    double  v = u*OCTREE_MAX_VAL;
+    if ( v < 0.0 ) return( 0 );
+    if ( v >= OCTREE_MAX_VAL ) return( (unsigned int)OCTREE_MAX_VAL - 1 );
+    return( (unsigned int)v );
+}
 
+/*
+ * Sort Key[] (and carry Idx[] along) with an LSD radix sort. Each pass
+ * histograms the digit per thread, turns the histograms into per-thread
+ * output offsets and scatters, so a pass is stable and the result does not
+ * depend on the number of threads. Passes over digits that are the same for
+ * every key are skipped.
+ */
+static void Octree_RadixSort( uint64_t *Key, uint32_t *Idx, unsigned long int N ) {
 
-    SubDivideVolume( t );
+    uint64_t            *Key2, *ks, *kd, *kt;
+    uint32_t            *Idx2, *is, *id, *it;
+    unsigned long int   *Hist, Sum, c;
+    int                 nT, Shift, d, t, Skip;
 
-    ot = (Lgm_Octree *) calloc( 1, sizeof( Lgm_Octree) );
-    ot->Min  = Min;
-    ot->Max  = Max;
-    ot->Diff = Diff;
-    ot->Root = t;
+    if ( N < 2 ) return;
 
-    ot->kNN_Lookups = 0;
+    nT = 1;
+#if USE_OPENMP
+    if ( N >= OCTREE_PARALLEL_MIN ) nT = omp_get_max_threads();
+#endif
 
+    Key2 = (uint64_t *)malloc( N*sizeof(uint64_t) );
+    Idx2 = (uint32_t *)malloc( N*sizeof(uint32_t) );
+    Hist = (unsigned long int *)malloc( nT*OCTREE_RADIX_BUCKETS*sizeof(unsigned long int) );
 
-    return( ot );
+    ks = Key; is = Idx; kd = Key2; id = Idx2;
+    for ( Shift=0; Shift<OCTREE_MORTON_BITS; Shift += OCTREE_RADIX_BITS ) {
 
-}
+        memset( Hist, 0, nT*OCTREE_RADIX_BUCKETS*sizeof(unsigned long int) );
 
+#if USE_OPENMP
+        #pragma omp parallel for schedule(static,1) num_threads(nT)
+#endif
+        for ( t=0; t<nT; t++ ) {
+            unsigned long int   i, lo = (N*t)/nT, hi = (N*(t+1))/nT;
+            unsigned long int   *h = &Hist[t*OCTREE_RADIX_BUCKETS];
+            for ( i=lo; i<hi; i++ ) ++h[ (ks[i] >> Shift) & (OCTREE_RADIX_BUCKETS-1) ];
+        }
 
+        /*
+         * Offsets: all of digit 0 (thread 0, then thread 1, ...), then all of digit 1, ...
+         */
+        Skip = FALSE;
+        for ( Sum=0, d=0; d<OCTREE_RADIX_BUCKETS; d++ ) {
+            for ( c=0, t=0; t<nT; t++ ) c += Hist[t*OCTREE_RADIX_BUCKETS+d];
+            if ( c == N ) { Skip = TRUE; break; }
+            for ( t=0; t<nT; t++ ) {
+                c = Hist[t*OCTREE_RADIX_BUCKETS+d];
+                Hist[t*OCTREE_RADIX_BUCKETS+d] = Sum;
+                Sum += c;
+            }
+        }
+        if ( Skip ) continue;
+
+#if USE_OPENMP
+        #pragma omp parallel for schedule(static,1) num_threads(nT)
+#endif
+        for ( t=0; t<nT; t++ ) {
+            unsigned long int   i, j, lo = (N*t)/nT, hi = (N*(t+1))/nT;
+            unsigned long int   *h = &Hist[t*OCTREE_RADIX_BUCKETS];
+            for ( i=lo; i<hi; i++ ) {
+                j = h[ (ks[i] >> Shift) & (OCTREE_RADIX_BUCKETS-1) ]++;
+                kd[j] = ks[i];
+                id[j] = is[i];
+            }
+        }
 
+        kt = ks; ks = kd; kd = kt;
+        it = is; is = id; id = it;
 
-/**
- *   Creates a binary string representation of an unsigned int.
- *
- *      \param[in]      n       An unsigned int
- *      \param[out]     Str     Pointer to a string (i.e. an array of chars)
- *
- *      \returns        void
- *
- *      \author         Mike Henderson
- *      \date           2009-2012
- *
- */
-void Binary( unsigned int n, char *Str ) {
-    int             i, j;
-    unsigned int    mask;
-    for (j=0, i=15; i>=0; i--, j++){
-        mask = 1<<i;
-        Str[j] = ( n & mask ) ? '1' : '0';
-        if (j==7) Str[++j] = ' ';
     }
-    Str[j] = '\0';
-}
 
+    if ( ks != Key ) {
+        memcpy( Key, ks, N*sizeof(uint64_t) );
+        memcpy( Idx, is, N*sizeof(uint32_t) );
+    }
 
+    free( Key2 );
+    free( Idx2 );
+    free( Hist );
 
+}
 
-/**
- *  Recursively free all nodes below the given node.
- *
- *      \param[in]      n       Pointer to a cell in an octree.
- *
- *      \returns        void
- *
- *      \author         Mike Henderson
- *      \date           2009-2012
- *
+/*
+ * First index in [lo, hi) whose octant digit at Level is >= Digit. The
+ * digits are non-decreasing over the points of a cell because the points
+ * are in Morton order.
  */
-void Lgm_OctreeFreeBranch( Lgm_OctreeCell *Cell ){
-
-    int i;
+static unsigned long int Octree_LowerBound( uint64_t *Code, unsigned long int lo, unsigned long int hi, int Level, unsigned int Digit ) {
+    unsigned long int   mid;
+    while ( lo < hi ) {
+        mid = lo + (hi-lo)/2;
+        if ( ( (Code[mid] >> (3*Level)) & 7 ) < Digit ) lo = mid+1;
+        else hi = mid;
+    }
+    return( lo );
+}
 
-    if ( Cell->Octant == NULL ) {
+/*
+ * Fill in the 8 children of cell p (at Cells[c0..c0+7]) from the sorted codes.
+ */
+static void Octree_Split( Lgm_OctreeCell *Cells, long int p, long int c0, uint64_t *Code ) {
 
-        /*
-         *  Then this is a leaf. Free its contents then return.
-         */
-        if ( Cell->Data ) {
-            free( Cell->Data );
-            Cell->Data = NULL;
-        }
+    Lgm_OctreeCell      *Parent = &Cells[p], *Cell;
+    unsigned long int   b[9];
+    unsigned int        BranchBit;
+    int                 i, Level;
 
-    } else {
+    Level     = Parent->Level - 1;
+    BranchBit = 1<<Level;
 
-        for (i=0; i<8; ++i) Lgm_OctreeFreeBranch( &(Cell->Octant[i]) );
-        free( Cell->Octant );
-        Cell->Octant = NULL;
+    b[0] = Parent->iData;
+    b[8] = Parent->iData + Parent->nDataBelow;
+    for ( i=1; i<8; i++ ) b[i] = Octree_LowerBound( Code, b[i-1], b[8], Level, i );
 
+    for ( i=0; i<8; i++ ) {
+        Cell = &Cells[c0+i];
+        Cell->xLocationCode = ( i&1 )      ? Parent->xLocationCode + BranchBit : Parent->xLocationCode;
+        Cell->yLocationCode = ( (i&2)>>1 ) ? Parent->yLocationCode + BranchBit : Parent->yLocationCode;
+        Cell->zLocationCode = ( (i&4)>>2 ) ? Parent->zLocationCode + BranchBit : Parent->zLocationCode;
+        Cell->Level      = Level;
+        Cell->h          = 0.5*Parent->h;
+        Cell->Center.x   = (double)Cell->xLocationCode/(double)OCTREE_MAX_VAL + Cell->h;
+        Cell->Center.y   = (double)Cell->yLocationCode/(double)OCTREE_MAX_VAL + Cell->h;
+        Cell->Center.z   = (double)Cell->zLocationCode/(double)OCTREE_MAX_VAL + Cell->h;
+        Cell->Parent     = p;
+        Cell->Octant     = -1;
+        Cell->iData      = b[i];
+        Cell->nDataBelow = b[i+1] - b[i];
+        Cell->nData      = Cell->nDataBelow;
     }
 
+    Parent->Octant = c0;
+    Parent->nData  = 0;
 
-    return;
-
+}
 
+/*
+ * Element j of one component of the input. The components are either
+ * doubles or floats, Stride elements apart (3 for arrays of Lgm_Vectors, 1
+ * for plain arrays).
+ */
+static inline double Octree_Get( const void *p, unsigned long int j, int Stride, int IsFloat ) {
+    return( IsFloat ? (double)((const float *)p)[j*Stride] : ((const double *)p)[j*Stride] );
 }
 
+/*
+ * Builds the octree from the components Pos[3] (positions) and Dat[3] (data
+ * vectors). The inputs are only read (once for the scaling, once for the
+ * Morton codes and once, through the sort permutation, to fill the octree's
+ * own Morton ordered arrays), so they can be a read-only mapping.
+ */
+static Lgm_Octree *Octree_Build( const void **Pos, const void **Dat, int Stride, int IsFloat, unsigned long int N ) {
 
+    double              Min, Max, Diff, u;
+    long int            j, f0, f1, nSplit, nAlloc, *Base;
+    int                 d;
+    uint64_t            *Code;
+    uint32_t            *Idx;
+    Lgm_OctreeCell      *t;
+    Lgm_Octree          *ot;
 
-/**
- *   Destroys an octree.
- *
- *   Given a pointer to an octree, this routine destroys the structure by
- *   freeing up all allocated memory.
- *
- *      \param[in]      ot   Pointer to an initialized octree
- *
- *      \returns        void
- *
- *      \author         Mike Henderson
- *      \date           2009-2012
- *
- */
-void Lgm_FreeOctree( Lgm_Octree *ot ) {
-    Lgm_OctreeFreeBranch( ot->Root );
-    free( ot->Root );
-    free( ot );
-}
+    if ( N > 0x7ffffffeUL ) {
+        printf("Lgm_InitOctree: too many points (%lu)\n", N );
+        return( NULL );
+    }
 
+    /*
+     * Find scaling for data
+     */
+    Max = -9e99;
+    Min = 9e99;
+    for (j=0; j<(long int)N; j++){
+        for ( d=0; d<3; d++ ) {
+            u = Octree_Get( Pos[d], j, Stride, IsFloat );
+            if ( u > Max ) Max = u;
+            if ( u < Min ) Min = u;
+        }
+    }
+    Diff = Max - Min;
+    if ( !( Diff > 0.0 ) ) Diff = 1.0;
 
-/**
- *  Create a root-level node for an octree.
- *
- *
- *      \returns        Pointer to Lgm_OctreeCell
- *
- *      \author         Mike Henderson
- *      \date           2009-2012
- *
- */
-Lgm_OctreeCell *Lgm_CreateOctreeRoot( ) {
+    ot = (Lgm_Octree *) calloc( 1, sizeof( Lgm_Octree) );
+    ot->n    = N;
+    ot->Min  = Min;
+    ot->Max  = Max;
+    ot->Diff = Diff;
+    ot->kNN_Lookups = 0;
+
+    /*
+     * Scale positions (need to be in range of [0-1]), get the Morton codes and sort.
+     */
+    Code = (uint64_t *)malloc( (N+1)*sizeof(uint64_t) );
+    Idx  = (uint32_t *)malloc( (N+1)*sizeof(uint32_t) );
+#if USE_OPENMP
+    #pragma omp parallel for if(N >= OCTREE_PARALLEL_MIN)
+#endif
+    for (j=0; j<(long int)N; j++){
+        Code[j] = Lgm_OctreeMortonCode( Octree_LocationCode( (Octree_Get( Pos[0], j, Stride, IsFloat ) - Min)/Diff ),
+                                        Octree_LocationCode( (Octree_Get( Pos[1], j, Stride, IsFloat ) - Min)/Diff ),
+                                        Octree_LocationCode( (Octree_Get( Pos[2], j, Stride, IsFloat ) - Min)/Diff ) );
+        Idx[j]  = (uint32_t)j;
+    }
+    Octree_RadixSort( Code, Idx, N );
 
-    char            Str[20];
-    Lgm_OctreeCell  *Cell;
+    /*
+     * Copy the data, in Morton order, into the point arrays.
+     */
+    ot->x  = (double *)malloc( (N+1)*sizeof(double) );
+    ot->y  = (double *)malloc( (N+1)*sizeof(double) );
+    ot->z  = (double *)malloc( (N+1)*sizeof(double) );
+    ot->Bx = (double *)malloc( (N+1)*sizeof(double) );
+    ot->By = (double *)malloc( (N+1)*sizeof(double) );
+    ot->Bz = (double *)malloc( (N+1)*sizeof(double) );
+    ot->Id = (unsigned long int *)malloc( (N+1)*sizeof(unsigned long int) );
+#if USE_OPENMP
+    #pragma omp parallel for if(N >= OCTREE_PARALLEL_MIN)
+#endif
+    for (j=0; j<(long int)N; j++){
+        unsigned long int   k = Idx[j];
+        ot->x[j]  = (Octree_Get( Pos[0], k, Stride, IsFloat ) - Min)/Diff;
+        ot->y[j]  = (Octree_Get( Pos[1], k, Stride, IsFloat ) - Min)/Diff;
+        ot->z[j]  = (Octree_Get( Pos[2], k, Stride, IsFloat ) - Min)/Diff;
+        ot->Bx[j] = Octree_Get( Dat[0], k, Stride, IsFloat );
+        ot->By[j] = Octree_Get( Dat[1], k, Stride, IsFloat );
+        ot->Bz[j] = Octree_Get( Dat[2], k, Stride, IsFloat );
+        ot->Id[j] = k;
+    }
+    free( Idx );
 
     /*
-     * allocate
+     * Root Cell has cube with face half-width = 0.5, centered at (0.5, 0.5, 0.5)
      */
-    Cell = (Lgm_OctreeCell *) calloc( 1, sizeof( Lgm_OctreeCell ) );
-    Cell->nData = 0;
-    Cell->Parent = NULL;
-    Cell->Octant = NULL;
-    Cell->xLocationCode = 0;
-    Cell->yLocationCode = 0;
-    Cell->zLocationCode = 0;
-    Cell->Level = OCTREE_ROOT_LEVEL;
-    Cell->h = 0.5;          // Root Cell has cube with face half-width = 0.5
-    Cell->Center.x = 0.5;   // Center is at (0.5, 0.5, 0.5)
-    Cell->Center.y = 0.5;
-    Cell->Center.z = 0.5;
-
-//    Binary( Cell->xLocationCode, Str ); printf("Root  xLocationCode = %s\n", Str);
-//    Binary( Cell->yLocationCode, Str ); printf("Root  yLocationCode = %s\n", Str);
-//    Binary( Cell->zLocationCode, Str ); printf("Root  zLocationCode = %s\n\n", Str);
-
-    return( Cell );
+    nAlloc = 8*( N/OCTREE_MAX_DATA_PER_OCTANT + 1 ) + 1;
+    ot->Cells  = (Lgm_OctreeCell *) calloc( nAlloc, sizeof( Lgm_OctreeCell ) );
+    t = &ot->Cells[0];
+    t->Level      = OCTREE_ROOT_LEVEL;
+    t->h          = 0.5;
+    t->Center.x   = 0.5;
+    t->Center.y   = 0.5;
+    t->Center.z   = 0.5;
+    t->Parent     = -1;
+    t->Octant     = -1;
+    t->iData      = 0;
+    t->nDataBelow = N;
+    t->nData      = N;
+    ot->nCells    = 1;
 
-}
+    /*
+     * Build the cells breadth first. Cells [f0, f1) are the current
+     * level; the children of those that get split are appended in order.
+     */
+    Base = NULL;
+    f0 = 0; f1 = 1;
+    while ( f1 > f0 ) {
+
+        Base = (long int *)realloc( Base, (f1-f0)*sizeof(long int) );
+        for ( nSplit=0, j=f0; j<f1; j++ ) {
+            t = &ot->Cells[j];
+            if ( ( t->Level > 0 ) && ( t->nDataBelow > OCTREE_MAX_DATA_PER_OCTANT ) ) {
+                Base[j-f0] = ot->nCells + 8*nSplit++;
+            } else {
+                Base[j-f0] = -1;
+            }
+        }
+        if ( nSplit == 0 ) break;
 
+        if ( ot->nCells + 8*nSplit > nAlloc ) {
+            nAlloc = 2*nAlloc + 8*nSplit;
+            ot->Cells = (Lgm_OctreeCell *) realloc( ot->Cells, nAlloc*sizeof( Lgm_OctreeCell ) );
+        }
+
+#if USE_OPENMP
+        #pragma omp parallel for schedule(dynamic,256) if(f1-f0 >= 1024)
+#endif
+        for ( j=f0; j<f1; j++ ) {
+            if ( Base[j-f0] >= 0 ) Octree_Split( ot->Cells, j, Base[j-f0], Code );
+        }
 
+        f0 = ot->nCells;
+        ot->nCells += 8*nSplit;
+        f1 = ot->nCells;
 
+    }
+    free( Base );
+    free( Code );
 
+    ot->Cells = (Lgm_OctreeCell *) realloc( ot->Cells, ot->nCells*sizeof( Lgm_OctreeCell ) );
 
+    return( ot );
 
+}
 
 /**
- *   Find the cell in the octree that is identified by the given x, y, and z Location Codes.
+ *   Store given 3D data into an octree data structure.
+ *
+ *   Given 1D arrays of vector positions and vector data (e.g. B-field), this
+ *   routine partitions the data into an octree data structure. The octree
+ *   can be used to very efficiently find nearest neighbors (using
+ *   Lgm_Octree_kNN() ).
  *
- *      \param[in]      Cell            Pointer to a node in the octree
- *      \param[in]      ChildLevel      XXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
- *      \param[in]      xLocationCode   unsigned int representation of the binary x location code to find.
- *      \param[in]      yLocationCode   unsigned int representation of the binary y location code to find.
- *      \param[in]      zLocationCode   unsigned int representation of the binary z location code to find.
+ *   The points are sorted by Morton code with a (parallel, if OpenMP is
+ *   enabled) radix sort, and the cells are then made one level at a time.
+ *   A cell is split into 8 octants while it has more than
+ *   OCTREE_MAX_DATA_PER_OCTANT points (and is not at the finest level).
  *
- *      \returns        Pointer to the cell that was found.
+ *      \param[in]      ObjectPoints   An array of position vectors
+ *      \param[in]      ObjectData     An array of data vectors (e.g. B-field)
+ *      \param[in]      N              Number of ObjectPoints
+ *
+ *      \returns        returns a pointer to the an Octree structure. User is
+ *                      responsible to freeing this with Lgm_FreeOctree( )
  *
  *      \author         Mike Henderson
  *      \date           2009-2012
  *
  */
-Lgm_OctreeCell *Lgm_OctreeTraverseToLocCode( Lgm_OctreeCell *Cell, unsigned int ChildLevel, unsigned int xLocationCode, unsigned int yLocationCode, unsigned int zLocationCode ) {
-
-    unsigned int    BranchBit, Index;
-
-    while( Cell->Octant ) { // loop until we reach a leaf (i.e. until Octant is NULL)
-
-        // set branch bit for the children of Cell
-        BranchBit  = 1<<ChildLevel;
-
-        // determine which octant to enter
-        Index = (((xLocationCode & BranchBit) >> ChildLevel)
-                        + 2*( ((yLocationCode & BranchBit) >> ChildLevel)
-                            + 2*((zLocationCode & BranchBit) >> ChildLevel) ) );
-
-        Cell = &(Cell->Octant[Index]);
-        --ChildLevel;
+Lgm_Octree *Lgm_InitOctree( Lgm_Vector *ObjectPoints, Lgm_Vector *ObjectData, unsigned long int N ) {
 
-    }
+    const void  *Pos[3] = { &ObjectPoints[0].x, &ObjectPoints[0].y, &ObjectPoints[0].z };
+    const void  *Dat[3] = { &ObjectData[0].x,   &ObjectData[0].y,   &ObjectData[0].z };
 
-    return( Cell );
+    return( Octree_Build( Pos, Dat, 3, FALSE, N ) );
 
 }
 
-
-
 /**
- *   Returns a pointer to the cell that contains the query point
+ *   Same as Lgm_InitOctree(), but the positions and data are given as
+ *   separate x, y, z, Bx, By, Bz arrays of either doubles or floats (e.g. as
+ *   they come out of an MHD code, or straight from a mapped file -- see
+ *   Lgm_PointCloud.h). No Lgm_Vector copies of the input are needed.
  *
- *      \param[in]      Root    Pointer to the root node of the octree
- *      \param[in]      q       The 3D query point.
+ *      \param[in]      x, y, z        Position components (N each).
+ *      \param[in]      Bx, By, Bz     Data vector components (N each).
+ *      \param[in]      IsFloat        TRUE if the arrays are float, FALSE if double.
+ *      \param[in]      N              Number of points.
  *
- *      \returns        Pointer to the cell that was found.
- *
- *      \author         Mike Henderson
- *      \date           2009-2012
+ *      \returns        The octree (free with Lgm_FreeOctree()), or NULL.
  *
  */
-Lgm_OctreeCell *Lgm_LocateNearestCell( Lgm_OctreeCell *Root, Lgm_Vector *q ){
-
-    unsigned int    xLocationCode = (unsigned int)(q->x * OCTREE_MAX_VAL);
-    unsigned int    yLocationCode = (unsigned int)(q->y * OCTREE_MAX_VAL);
-    unsigned int    zLocationCode = (unsigned int)(q->z * OCTREE_MAX_VAL);
-    unsigned int    ChildLevel;
-    Lgm_OctreeCell  *Cell, *Result;
+Lgm_Octree *Lgm_InitOctree_SoA( const void *x, const void *y, const void *z, const void *Bx, const void *By, const void *Bz,
+                                int IsFloat, unsigned long int N ) {
 
-    Cell       = Root;
-    ChildLevel = Cell->Level - 1;
-    Result     = Lgm_OctreeTraverseToLocCode( Cell, ChildLevel, xLocationCode, yLocationCode, zLocationCode );
+    const void  *Pos[3] = { x, y, z };
+    const void  *Dat[3] = { Bx, By, Bz };
 
-    return( Result );
+    return( Octree_Build( Pos, Dat, 1, IsFloat, N ) );
 
 }
 
 
 
 
-
-
-
-
-
-
-
-
-
-
-
 /**
- *  This routine computes the minimum distance between a point and an octree
- *  cell (i.e. cube).  The dimensions and center of the cube are stored in the
- *  Lgm_OctreeCell structure.
+ *   Creates a binary string representation of an unsigned int.
  *
- *      \param[in]      Cell    Pointer to a cell (i.e. node) in the octree
- *      \param[in]      q       The 3D query point.
+ *      \param[in]      n       An unsigned int
+ *      \param[out]     Str     Pointer to a string (i.e. an array of chars)
  *
- *      \returns        The minimum distance between the point and the cell in
- *                      normalized coordinates.
+ *      \returns        void
  *
  *      \author         Mike Henderson
  *      \date           2009-2012
  *
  */
-double  MinDist( Lgm_OctreeCell *Cell, Lgm_Vector *q ) {
-
-    double  px, py, pz, d, ph, mh, distance2 = 0.0;
-
-    ph  = Cell->h;  // + half width of a cube face
-    mh  = -ph;      // - half width of a cube face
-
-    // assume cube is centered at origin, by shifting query point.
-    // i.e. transform point into frame where cube is centered at origin
-    px = q->x - Cell->Center.x;
-    py = q->y - Cell->Center.y;
-    pz = q->z - Cell->Center.z;
-//printf("MinDist(): q = %g %g %g\n", q->x, q->y, q->z );
-
-    if      ( px < mh ) { d = px+ph; distance2 += d*d; }
-    else if ( px > ph ) { d = px-ph; distance2 += d*d; }
-
-    if      ( py < mh ) { d = py+ph; distance2 += d*d; }
-    else if ( py > ph ) { d = py-ph; distance2 += d*d; }
-
-    if      ( pz < mh ) { d = pz+ph; distance2 += d*d; }
-    else if ( pz > ph ) { d = pz-ph; distance2 += d*d; }
-
-//printf("MinDist(): distance2 = %g\n", distance2);
-    return( distance2 );
-
+void Binary( unsigned int n, char *Str ) {
+    int             i, j;
+    unsigned int    mask;
+    for (j=0, i=15; i>=0; i--, j++){
+        mask = 1<<i;
+        Str[j] = ( n & mask ) ? '1' : '0';
+        if (j==7) Str[++j] = ' ';
+    }
+    Str[j] = '\0';
 }
 
 
 
 
 /**
- *  Insert a Cell object into the Priority Queue (PQ). This computes distance
- *  and puts it into the PQ at the right place to maintain a `mindist' order
- *  (the top object of the queue. This routine is used by Lgm_Octree_kNN().
+ *   Destroys an octree.
+ *
+ *   Given a pointer to an octree, this routine destroys the structure by
+ *   freeing up all allocated memory.
  *
- *      \param[in]      Cell        Pointer to a cell (i.e. node) in the octree
- *      \param[in]      q           The 3D query point.
- *      \param[in,out]  PQ          The "priority queue"3D query point.
- *      \param[in]      MaxDist2    The maximum distance (squared) to care
- *                                  about. Square distances beyond this value are ignored.
+ *      \param[in]      ot   Pointer to an initialized octree
  *
- *      \returns        The distance between the point and the cell in
- *                      normalized coordinates.
+ *      \returns        void
  *
  *      \author         Mike Henderson
  *      \date           2009-2012
  *
  */
-double InsertCell( Lgm_OctreeCell *Cell, Lgm_Vector *q, pQueue **PQ, double MaxDist2 ) {
-
-    int     done, InsertAtEnd;
-    double  dist;
-    pQueue  *new, *p;
-
+void Lgm_FreeOctree( Lgm_Octree *ot ) {
+    if ( ot == NULL ) return;
+    if ( ot->Mapping ) {
+#ifdef HAVE_SYS_MMAN_H
+        munmap( ot->Mapping, ot->MappingSize );
+#else
+        free( ot->Mapping );
+#endif
+        free( ot );
+        return;
+    }
+    free( ot->Cells );
+    free( ot->x );  free( ot->y );  free( ot->z );
+    free( ot->Bx ); free( ot->By ); free( ot->Bz );
+    free( ot->Id );
+    free( ot );
+}
 
-    /*
-     * If the cell's MinDist2 > MaxDist2, then we should just ignore
-     * the entire cell becuase none of its contents can possibly have points
-     * that are < MaxDist2
-     */
-    dist = MinDist( Cell, q );
-    if ( dist > MaxDist2 ) return(9e99);
-
-
-
-    // Allocate an element for the PQ
-    new = (pQueue *) calloc( 1, sizeof(pQueue) );
-//++total_callocs;
-//printf("InsertCell_callocs = %d    MinDist2 = %g\n", total_callocs, dist);
-
-    // Add Info
-    new->Obj      = Cell;
-    new->MinDist2 = dist;
-//printf("InsertCell: MinDist2 = %g   Level = %d\n", dist, Cell->Level);
-    new->IsPoint  = FALSE;
-
-    if ( *PQ == NULL ) {
-        // nothing in the Priority Queue.
-        *PQ = new;
-	    new->Prev = NULL;
-	    new->Next = NULL;
-        return( dist );
-    } else {
-
-        // find where to add the new element
-        p = *PQ;
-        done = FALSE;
-        InsertAtEnd = FALSE; // always insert new object before the object pointed at by p unless this is true
-			                 // then it goes at the end.
-        while ( !done ) {
-            if ( new->MinDist2 <= p->MinDist2 ) {
-                done = TRUE;
-            } else if ( p->Next == NULL ) {
-                done = TRUE;
-                InsertAtEnd = TRUE;
-            } else {
-                p = p->Next;
-            }
-        }
 
 
-        //if ( p == NULL ) {
-        if ( InsertAtEnd ) {
-            // Insert at bottom (i.e. as last element)
-            p->Next   = new;
-            new->Next = NULL;
-            new->Prev = p;
-        } else {
-            if ( p->Prev == NULL ) {
-                // Insert at top (i.e. as first element)
-                new->Next = p;
-                new->Prev = NULL;
-                p->Prev   = new;
-                *PQ        = new;
-            } else {
-                // Insert before p
-                new->Next     = p;
-                new->Prev     = p->Prev;
-                p->Prev->Next = new;
-                p->Prev       = new;
-            }
-        }
+static uint64_t Octree_Align( uint64_t n ) {
+    return( ( n + LGM_OCTREE_FILE_ALIGN - 1 )/LGM_OCTREE_FILE_ALIGN*LGM_OCTREE_FILE_ALIGN );
+}
 
+static int Octree_PWrite( int fd, const void *buf, size_t n, uint64_t Offset ) {
+    const char  *p = (const char *)buf;
+    ssize_t     k;
+    while ( n > 0 ) {
+        if ( (k = pwrite( fd, p, n, (off_t)Offset )) <= 0 ) return( FALSE );
+        p += k; n -= (size_t)k; Offset += (uint64_t)k;
     }
-
-    return( dist );
-
-
+    return( TRUE );
 }
 
 /**
- *  Insert a point object into the priority queue. This computes distance and
- *  puts it into the priority queue at the right place.  This routine is used
- *  by Lgm_Octree_kNN().
+ *   Saves an octree to a file that Lgm_LoadOctree() can map straight back in.
  *
- *      \param[in]      Cell        Pointer to the cell (i.e. node) in the octree that contains the data point to add.
- *      \param[in]      j           array index of the data point (contained within the given cell) to add.
- *      \param[in]      q           The 3D query point.
- *      \param[in,out]  PQ          The "priority queue"3D query point.
+ *   The octree is already flat (cell indices rather than pointers, and
+ *   plain arrays of point data), so the arrays are written as they are.
  *
- *      \returns        void
+ *      \param[in]      Octree      Pointer to an initialized octree
+ *      \param[in]      Filename    File to write (overwritten if it exists).
  *
- *      \author         Mike Henderson
- *      \date           2009-2012
+ *      
+eturns        TRUE on success, FALSE otherwise.
  *
  */
-void InsertPoint( Lgm_OctreeCell *Cell, int j, Lgm_Vector *q, pQueue **PQ ) {
-
-    pQueue  *new, *p;
-    double  x, y, z, dx, dy, dz, MinDist2;
-
-    MinDist2 = 0.0;
-
-    // compute distance^2 between point and query point
-    x = Cell->Data[j].Position.x; dx = q->x-x; MinDist2 += dx*dx;
-    y = Cell->Data[j].Position.y; dy = q->y-y; MinDist2 += dy*dy;
-    z = Cell->Data[j].Position.z; dz = q->z-z; MinDist2 += dz*dz;
-
-
-
-
-    // Allocate an element for the PQ
-    new = (pQueue *) calloc( 1, sizeof(pQueue) );
-//++total_callocs;
-//printf("InsertPoint_callocs = %d\n", total_callocs);
-//printf("MinDist2 = %g\n", MinDist2);
-
-    // Add Info
-    new->Obj      = Cell;
-    new->MinDist2 = MinDist2;
-//printf("InsertPoint: MinDist2 = %g\n", MinDist2);
-    new->IsPoint  = TRUE;
-    new->j        = j;
-
-    if ( *PQ == NULL ) {
-        // nothing in the Priority Queue.
-        *PQ = new;
-        new->Next = NULL;
-        new->Prev = NULL;
-//printf("1.\n"); //PrintPQ( PQ ); //only for debugging
-        return;
-    } else {
-
-        // find where to add the new element
-        p = *PQ;
-        while ( p ) {
-
-            if ( (new->MinDist2 <= p->MinDist2) && (p->Prev != NULL) ) {
-                // Insert before p
-                new->Next     = p;
-                new->Prev     = p->Prev;
-                p->Prev->Next = new;
-                p->Prev       = new;
-//printf("2.\n"); //PrintPQ( PQ ); //only for debugging
-                return;
-            } else if ( (new->MinDist2 <= p->MinDist2) && (p->Prev == NULL) ) {
-                // Insert at top (i.e. as first element)
-                new->Next = p;
-                new->Prev = NULL;
-                p->Prev   = new;
-                *PQ        = new;
-//printf("3.\n"); //PrintPQ( PQ ); //only for debugging
-                return;
-            } else if ( (new->MinDist2 > p->MinDist2) && (p->Next == NULL) ) {
-                // Insert at bottom (i.e. as last element)
-                p->Next   = new;
-                new->Next = NULL;
-                new->Prev = p;
-//printf("4.\n"); //PrintPQ( PQ ); //only for debugging
-                return;
-            } 
-            p = p->Next;
-        }
+int Lgm_SaveOctree( Lgm_Octree *Octree, char *Filename ) {
+
+    int                     fd, k, Status;
+    Lgm_OctreeFileHeader    h;
+    uint64_t                n = Octree->n, Bytes;
+    const void              *Arr[7];
+
+    Arr[0] = Octree->x;  Arr[1] = Octree->y;  Arr[2] = Octree->z;
+    Arr[3] = Octree->Bx; Arr[4] = Octree->By; Arr[5] = Octree->Bz;
+    Arr[6] = Octree->Id;
+
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.Magic, LGM_OCTREE_FILE_MAGIC, 8 );
+    h.Version    = LGM_OCTREE_FILE_VERSION;
+    h.CellSize   = sizeof( Lgm_OctreeCell );
+    h.IdSize     = sizeof( unsigned long int );
+    h.n          = n;
+    h.nCells     = Octree->nCells;
+    h.Min = Octree->Min; h.Max = Octree->Max; h.Diff = Octree->Diff;
+    h.CellOffset = Octree_Align( sizeof(h) );
+    h.Offset[0]  = Octree_Align( h.CellOffset + h.nCells*sizeof(Lgm_OctreeCell) );
+    for ( k=1; k<7; k++ ) h.Offset[k] = Octree_Align( h.Offset[k-1] + n*sizeof(double) );
+
+    if ( (fd = open( Filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) < 0 ) {
+        fprintf( stderr, "Lgm_SaveOctree(): Could not open %s for writing.\n", Filename );
+        return( FALSE );
     }
+    Status = Octree_PWrite( fd, &h, sizeof(h), 0 ) && Octree_PWrite( fd, Octree->Cells, h.nCells*sizeof(Lgm_OctreeCell), h.CellOffset );
+    for ( k=0; Status && (k<7); k++ ) {
+        Bytes  = n*( (k<6) ? sizeof(double) : sizeof(unsigned long int) );
+        Status = Octree_PWrite( fd, Arr[k], Bytes, h.Offset[k] );
+    }
+    Status = ( close( fd ) == 0 ) && Status;
+    if ( !Status ) fprintf( stderr, "Lgm_SaveOctree(): Error writing %s.\n", Filename );
 
+    return( Status );
 
 }
 
-
-
 /**
- *   Descend toward the leaf node that is closest to the query point. This routine
- *   is used by Lgm_Octree_kNN().
+ *   Loads an octree saved with Lgm_SaveOctree().
  *
- *      \param[in]      Node        Pointer to a node (cell) in thge octree
- *      \param[in]      PQ          The "priority queue"3D query point.
- *      \param[in]      q           The 3D query point.
- *      \param[in]      MaxDist2    The maximum distance (squared) to care
- *                                  about. Square distances beyond this value are ignored.
+ *   The file is memory mapped (read only) and the octree's arrays point
+ *   straight into it, so nothing is built or copied. Free it with
+ *   Lgm_FreeOctree() as usual.
  *
- *      \returns        pointer to node one level closer to leaf node that is closest to query point.
+ *      \param[in]      Filename    File written by Lgm_SaveOctree().
  *
- *      \author         Mike Henderson
- *      \date           2009-2012
+ *      
+eturns        The octree, or NULL if the file could not be read or is
+ *                      not a valid octree file (or was written on a machine
+ *                      with a different structure layout).
  *
  */
-Lgm_OctreeCell *DescendTowardClosestLeaf( Lgm_OctreeCell *Node, pQueue **PQ, Lgm_Vector *q, double MaxDist2 ) {
-
-    unsigned long int   j;
-    double              dist, min_dist;
-    int                 i, min_i;
-    unsigned int        ChildLevel, BranchBit, Index;
-    Lgm_OctreeCell     *Cell, *Result;
-
-    Cell = Node;
-    ChildLevel = Cell->Level - 1;
-
-
-//    while( Cell->Octant ) { // loop until we reach a leaf (i.e. until Octant is NULL)
-    if ( Cell->Octant ) { 
-
-        min_dist = 9e99;
-        min_i    = 0;
-        for (i=0; i<8; i++){
-
-            // Add Cell to Priority Queue
-            dist = InsertCell( &(Cell->Octant[i]), q, PQ, MaxDist2 );
-
-            // keep track of closest octant
-            if (dist <= min_dist) {
-                min_dist = dist;
-//printf("HHHHHHH: min_dist = %g\n", min_dist);
-                min_i    = i;
-            }
-
-        }
-
-        Cell = &(Cell->Octant[min_i]);
-
-    } else {
-
-        // Add point(s) (if any) to Priority Queue
-        for (j=0; j<Cell->nData; j++){
-            InsertPoint( Cell, j, q, PQ );
-        }
+Lgm_Octree *Lgm_LoadOctree( char *Filename ) {
+
+    int                     fd, k, Ok;
+    uint64_t                i, n;
+    size_t                  Size;
+    struct stat             sb;
+    unsigned char           *Base;
+    Lgm_OctreeFileHeader    *h;
+    Lgm_OctreeCell          *c;
+    Lgm_Octree              *ot;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_OctreeFileHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
 
+    /*
+     * Validate the header and cells
+     */
+    h  = (Lgm_OctreeFileHeader *)Base;
+    n  = h->n;
+    Ok = (memcmp( h->Magic, LGM_OCTREE_FILE_MAGIC, 8 ) == 0) && (h->Version == LGM_OCTREE_FILE_VERSION)
+            && (h->CellSize == sizeof( Lgm_OctreeCell )) && (h->IdSize == sizeof( unsigned long int ))
+            && (h->nCells > 0) && (h->CellOffset % 8 == 0) && (h->CellOffset + h->nCells*sizeof(Lgm_OctreeCell) <= Size);
+    for ( k=0; Ok && (k<7); k++ ) Ok = (h->Offset[k] % 8 == 0) && (h->Offset[k] + n*8 <= Size);
+    c = (Lgm_OctreeCell *)(Base + h->CellOffset);
+    for ( i=0; Ok && (i<h->nCells); i++ ) {
+        Ok = ( (c[i].Octant < 0) || ((uint64_t)c[i].Octant > i && (uint64_t)c[i].Octant + 8 <= h->nCells) )
+          && ( c[i].iData <= n ) && ( c[i].nDataBelow <= n - c[i].iData );
     }
+    if ( !Ok ) {
+        fprintf( stderr, "Lgm_LoadOctree(): %s is not a valid octree file.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+
+    ot = (Lgm_Octree *) calloc( 1, sizeof( Lgm_Octree ) );
+    ot->n           = n;
+    ot->Min         = h->Min;
+    ot->Max         = h->Max;
+    ot->Diff        = h->Diff;
+    ot->kNN_Lookups = 0;
+    ot->nCells      = (long int)h->nCells;
+    ot->Cells       = c;
+    ot->x  = (double *)(Base + h->Offset[0]);
+    ot->y  = (double *)(Base + h->Offset[1]);
+    ot->z  = (double *)(Base + h->Offset[2]);
+    ot->Bx = (double *)(Base + h->Offset[3]);
+    ot->By = (double *)(Base + h->Offset[4]);
+    ot->Bz = (double *)(Base + h->Offset[5]);
+    ot->Id = (unsigned long int *)(Base + h->Offset[6]);
+    ot->Mapping     = Base;
+    ot->MappingSize = Size;
 
-    return( Cell );
+    return( ot );
 
 }
 
+
 /**
- *   Prints the contents of the priority queue. For dubugging only. This routine
- *   is used by Lgm_Octree_kNN().
+ *   Returns the index of the leaf cell that contains the (scaled) query point
  *
- *      \param[in]  PQ          The "priority queue"3D query point.
+ *      \param[in]      q       The 3D query point (in scaled coordinates, see Lgm_OctreeScalePosition()).
+ *      \param[in]      Octree  The octree.
  *
- *      \returns        void
+ *      \returns        Index of the cell that was found (in Octree->Cells).
  *
  *      \author         Mike Henderson
  *      \date           2009-2012
  *
  */
-void PrintPQ( pQueue **PQ ) {
-
-    long int    i=0;
-    pQueue      *p;
+long int Lgm_OctreeLocateLeaf( Lgm_Vector *q, Lgm_Octree *Octree ){
 
-    p = *PQ;
+    unsigned long int   Code;
+    long int            c = 0;
+    Lgm_OctreeCell      *Cells = Octree->Cells;
 
-    printf("---- Contents of Priority Queue  ---------\n");
-    while ( p != NULL ) {
+    Code = Lgm_OctreeMortonCode( Octree_LocationCode( q->x ), Octree_LocationCode( q->y ), Octree_LocationCode( q->z ) );
+    while ( Cells[c].Octant >= 0 ) {
+        c = Cells[c].Octant + ( ( Code >> (3*(Cells[c].Level-1)) ) & 7 );
+    }
 
-	if ( p->IsPoint ) {
-	    printf("Item # %03ld  Point: MinDist2 = %g\n", i++, p->MinDist2);
-	} else {
-	    printf("Item # %03ld   Cell: MinDist2 = %g\n", i++, p->MinDist2);
-	}
-	p = p->Next;
+    return( c );
 
-    }
-    printf("\n\n");
 }
 
+
 /**
- *  Pop an Object off the top of the PQ. This routine
- *  is used by Lgm_Octree_kNN().
+ *  This routine computes the minimum distance between a point and an octree
+ *  cell (i.e. cube).  The dimensions and center of the cube are stored in the
+ *  Lgm_OctreeCell structure.
  *
- *      \param[in,out]  PQ          The "priority queue"3D query point.
+ *      \param[in]      Cell    Pointer to a cell (i.e. node) in the octree
+ *      \param[in]      q       The 3D query point.
  *
- *      \returns        pointer to item popped off the priority queue.
+ *      \returns        The minimum distance between the point and the cell in
+ *                      normalized coordinates.
  *
  *      \author         Mike Henderson
  *      \date           2009-2012
  *
  */
-pQueue *PopObj( pQueue **PQ ) {
+static double Octree_MinDist( Lgm_OctreeCell *Cell, Lgm_Vector *q ) {
 
-    pQueue *p;
+    double  px, py, pz, d, ph, mh, distance2 = 0.0;
 
-    p = *PQ;
+    ph  = Cell->h;  // + half width of a cube face
+    mh  = -ph;      // - half width of a cube face
 
-    if ( p != NULL ) {
-        if ( p->Next != NULL ) {
-            *PQ = p->Next;
-            (*PQ)->Prev = NULL;
-        } else {
-            *PQ = NULL;
-        }
-    }
+    // assume cube is centered at origin, by shifting query point.
+    // i.e. transform point into frame where cube is centered at origin
+    px = q->x - Cell->Center.x;
+    py = q->y - Cell->Center.y;
+    pz = q->z - Cell->Center.z;
 
-    return( p );
+    if      ( px < mh ) { d = px+ph; distance2 += d*d; }
+    else if ( px > ph ) { d = px-ph; distance2 += d*d; }
 
-}
+    if      ( py < mh ) { d = py+ph; distance2 += d*d; }
+    else if ( py > ph ) { d = py-ph; distance2 += d*d; }
+
+    if      ( pz < mh ) { d = pz+ph; distance2 += d*d; }
+    else if ( pz > ph ) { d = pz-ph; distance2 += d*d; }
 
+    return( distance2 );
+
+}
 
 
 /**
@@ -689,8 +739,17 @@ pQueue *PopObj( pQueue **PQ ) {
  *  of data is stored as an Octree. All distances are in the normalized units
  *  (i.e. scaled from [0.0-1.0] ).
  *
+ *  This is a best-first search. Cells and points go on a heap-based
+ *  priority queue (see Lgm_PriorityQueue.h) ordered by their (minimum)
+ *  distance^2 to the query point; popping a cell pushes its 8 children (or
+ *  the points of a leaf), and popping a point gives the next nearest
+ *  neighbor. Cells and points farther than MaxDist2 are never queued. Cell
+ *  entries carry the cell index in the node's `index' and point entries
+ *  carry -(j+1), where j is the index into the (Morton ordered) point
+ *  arrays.
+ *
  *    \param[in]     q          Query position. I.e. the point we want to find NNs for.
- *    \param[in]     Root       Root node of Octree.
+ *    \param[in]     Octree     The Octree.
  *    \param[in]     K          Number of NNs to find.
  *    \param[in]     MaxDist2   Threshold distance^2 beyond which we give up on finding
  *                              NNs.  (i.e. could find them, but we arent interested
@@ -709,304 +768,349 @@ pQueue *PopObj( pQueue **PQ ) {
  */
 int Lgm_Octree_kNN( Lgm_Vector *q_in, Lgm_Octree *Octree, int K, int *Kgot, double MaxDist2, Lgm_OctreeData *kNN ) {
 
-    int             k, done;
-    pQueue          *PQ, *p;
-    Lgm_OctreeCell  *Root;
-    Lgm_Vector      q;
-static int count=0;
-
+    int                 k, i;
+    long int            c, j;
+    unsigned long int   jj, j1;
+    double              d, dx, dy, dz;
+    Lgm_OctreeCell      *Cells, *Cell;
+    Lgm_pQueue          *PQ;
+    Lgm_pQueue_Node     New, Kids[8], p;
+    Lgm_Vector          q;
+    int                 nKids;
 
-    Root = Octree->Root;
     *Kgot = 0;
-
-
-//MaxDist2 = .05;
+    if ( Octree == NULL ) return( OCTREE_IS_NULL );
 
     /*
      * Check to see if there are enough points.
      * Bailout with error flag -1 if not.
      */
-    if (Root->nDataBelow < K ) return( OCTREE_KNN_NOT_ENOUGH_DATA );
+    if ( Octree->n < K ) return( OCTREE_KNN_NOT_ENOUGH_DATA );
 
+    Cells = Octree->Cells;
+    Lgm_OctreeScalePosition( q_in, &q, Octree );
 
     /*
      *  Add Root Node to the Priority Queue.
      */
-    PQ = NULL;
-    Lgm_OctreeScalePosition( q_in, &q, Octree );
-    InsertCell( Root, &q, &PQ, MaxDist2 );
+    PQ = Lgm_pQueue_Create( 8*K + 64 );
+    New.Data = NULL;
+    New.key  = Octree_MinDist( &Cells[0], &q );
+    if ( New.key <= MaxDist2 ) {
+        New.index = 0;
+        Lgm_pQueue_Insert( &New, PQ );
+    }
 
     /*
-     *  Process items on the Priority Queue until we are done.
+     *  Process items on the Priority Queue until we are done. The
+     *  highest priority item is the closest object to the query point.
      */
-    k    = 0;       // havent found any NNs yet.
-    done = FALSE;
-    while( !done ) {
+    k = 0;
+    while ( ( k < K ) && Lgm_pQueue_Pop( &p, PQ ) ) {
+
+        if ( p.index < 0 ) {
+
+            /*
+             * Since a point is now the closest object, it must be the next NN.
+             */
+            j = -(long int)p.index - 1;
+            kNN[k].Id         = Octree->Id[j];
+            kNN[k].Position.x = Octree->x[j];
+            kNN[k].Position.y = Octree->y[j];
+            kNN[k].Position.z = Octree->z[j];
+            kNN[k].B.x        = Octree->Bx[j];
+            kNN[k].B.y        = Octree->By[j];
+            kNN[k].B.z        = Octree->Bz[j];
+            kNN[k].Dist2      = p.key;
+            ++k;
 
-	    //PrintPQ( &PQ ); //only for debugging
+        } else {
 
-        /*
-         * Pop the highest priority item off of the Priority Queue.
-         * This is the closest object to the query point. Note that
-         * it could be a cell or it could be a point.
-         */
-        p = PopObj( &PQ );
-
-        if ( p ) {
-
-            if ( p->IsPoint ) {
-                /*
-                 * Since a point is now the closest object, it must be one of
-                 * the kNN.  But, if its too far away, then we are done with
-                 * the search -- we couldnt find K NNs close enough to the
-                 * query point
-                 */
-                if ( p->MinDist2 > MaxDist2 ) {
-                    while ( (p = PopObj(&PQ)) ) {free( p );}
-                    return( OCTREE_KNN_TOO_FEW_NNS );
+            Cell = &Cells[p.index];
+            if ( Cell->Octant >= 0 ) {
+                // Add the (non-empty) children that are close enough.
+                for ( nKids=0, i=0; i<8; i++ ) {
+                    c = Cell->Octant + i;
+                    if ( Cells[c].nDataBelow == 0 ) continue;
+                    d = Octree_MinDist( &Cells[c], &q );
+                    if ( d <= MaxDist2 ) {
+                        Kids[nKids].key   = d;
+                        Kids[nKids].index = (int)c;
+                        Kids[nKids].Data  = NULL;
+                        ++nKids;
+                    }
                 }
-
-                /*
-                 * Otherwise, add this point as the next NN and continue.
-                 */
-                kNN[ k   ]       = p->Obj->Data[p->j];
-                kNN[ k++ ].Dist2 = p->MinDist2; // save the dist2 into the data struct
-                *Kgot = k;
-
+                Lgm_pQueue_InsertArray( Kids, nKids, PQ );
             } else {
+                // Add the leaf's points that are close enough.
+                Lgm_pQueue_Reserve( PQ->HeapSize + Cell->nData, PQ );
+                j1 = Cell->iData + Cell->nData;
+                for ( jj=Cell->iData; jj<j1; jj++ ) {
+                    dx = q.x - Octree->x[jj];
+                    dy = q.y - Octree->y[jj];
+                    dz = q.z - Octree->z[jj];
+                    d  = dx*dx + dy*dy + dz*dz;
+                    if ( d <= MaxDist2 ) {
+                        New.key   = d;
+                        New.index = -(int)jj - 1;
+                        Lgm_pQueue_Insert( &New, PQ );
+                    }
+                }
+            }
 
-                /*
-                 * If the object is cell, then descend one level closer to
-                 * the leaf node that is closest to the query point. This also
-                 * adds all cells we encounter along the way to the PQ. Ignore
-                 * Any cell that is farther than MaxDist2 away from query point.
-                 */
-                DescendTowardClosestLeaf( p->Obj, &PQ, &q, MaxDist2 );
+        }
 
-            }
+    }
 
+    Lgm_pQueue_Destroy( PQ );
+    *Kgot = k;
+    ++(Octree->kNN_Lookups);
 
-        } else {
+    /*
+     *  If we ran out of things to search before finding K, there arent K
+     *  points within MaxDist2.
+     */
+    return( ( k < K ) ? OCTREE_KNN_TOO_FEW_NNS : OCTREE_KNN_SUCCESS );
 
-            // The priority queue is empy -- there is nothing more to search.
-            done = TRUE;
+}
 
-        }
 
-        /*
-         * object is no longer needed so free up the space we allocated for it.
-         */
-        free( p ); 
+/*
+ *  Largest distance^2 between q and any point of the cell.
+ */
+static double Octree_MaxDist( Lgm_OctreeCell *Cell, Lgm_Vector *q ) {
 
-        if ( k >= K ) done = TRUE;
+    double  dx, dy, dz;
 
+    dx = fabs( q->x - Cell->Center.x ) + Cell->h;
+    dy = fabs( q->y - Cell->Center.y ) + Cell->h;
+    dz = fabs( q->z - Cell->Center.z ) + Cell->h;
 
-	    //PrintPQ( &PQ ); //only for debugging
+    return( dx*dx + dy*dy + dz*dz );
 
-    }
+}
 
-    /*
-     * Free all remaining objects on the PQ
-     */
-    while ( (p = PopObj(&PQ)) ) {free( p );}
+/*
+ *  Copy point j into Out[n] (if there is room).
+ */
+static inline void Octree_PutData( Lgm_Octree *Octree, unsigned long int j, double Dist2, long int n, long int nMax, Lgm_OctreeData *Out ) {
+
+    if ( n >= nMax ) return;
+    Out[n].Id         = Octree->Id[j];
+    Out[n].Position.x = Octree->x[j];
+    Out[n].Position.y = Octree->y[j];
+    Out[n].Position.z = Octree->z[j];
+    Out[n].B.x        = Octree->Bx[j];
+    Out[n].B.y        = Octree->By[j];
+    Out[n].B.z        = Octree->Bz[j];
+    Out[n].Dist2      = Dist2;
 
+}
 
-//PrintPQ( &PQ ); //only for debugging  
 
-    ++(Octree->kNN_Lookups);
-    
+/*
+ *  Radius search with q already scaled. Cells are visited depth first with
+ *  an explicit stack (at most 7 pending siblings per level). Cells that
+ *  are entirely inside the sphere are taken whole, without looking at the
+ *  distances of their points one by one (their points are one contiguous
+ *  range).
+ */
+static long int Octree_Radius( Lgm_Vector *q, Lgm_Octree *Octree, double Radius2, long int nMax, Lgm_OctreeData *Out ) {
 
-    /*
-     *  return success
-     */
-    return( OCTREE_KNN_SUCCESS );
+    long int            Stack[8*OCTREE_MAX_LEVELS+8], c, n = 0;
+    unsigned long int   j, j1;
+    double              d, dx, dy, dz;
+    Lgm_OctreeCell      *Cells = Octree->Cells, *Cell;
+    int                 nStack = 0, i, All;
 
-}
+    if ( ( Cells[0].nDataBelow > 0 ) && ( Octree_MinDist( &Cells[0], q ) <= Radius2 ) ) Stack[nStack++] = 0;
 
+    while ( nStack > 0 ) {
 
+        Cell = &Cells[ Stack[--nStack] ];
+        All  = ( Octree_MaxDist( Cell, q ) <= Radius2 );
 
+        if ( ( Cell->Octant >= 0 ) && !All ) {
+            for ( i=7; i>=0; i-- ) {
+                c = Cell->Octant + i;
+                if ( ( Cells[c].nDataBelow > 0 ) && ( Octree_MinDist( &Cells[c], q ) <= Radius2 ) ) Stack[nStack++] = c;
+            }
+        } else {
+            j1 = Cell->iData + Cell->nDataBelow;
+            for ( j=Cell->iData; j<j1; j++ ) {
+                dx = q->x - Octree->x[j];
+                dy = q->y - Octree->y[j];
+                dz = q->z - Octree->z[j];
+                d  = dx*dx + dy*dy + dz*dz;
+                if ( All || ( d <= Radius2 ) ) Octree_PutData( Octree, j, d, n++, nMax, Out );
+            }
+        }
 
+    }
+
+    return( n );
 
+}
 
 
 /**
- *  Allocate 8 new octants in a parent cell.
+ *  Finds all of the points within a given distance of a query point.
  *
- *    \param[in]     Parent     Cell in which new octants are to be created.
+ *  Unlike Lgm_Octree_kNN() this doesnt need to know how many points there
+ *  will be, and since whole cells inside the sphere are taken without
+ *  testing their points, it is also a lot cheaper than a kNN search for a
+ *  large K. As with Lgm_Octree_kNN(), q is in the original coordinates and
+ *  distances (Radius2 and the Dist2's returned) are in the normalized ones
+ *  (see Lgm_OctreeScaleDistance()).
  *
- *    \returns       pointer to array of 8 newly allocated octants.
+ *    \param[in]     q          Query position.
+ *    \param[in]     Octree     The Octree.
+ *    \param[in]     Radius2    Distance^2 (normalized) of the points wanted.
+ *    \param[in]     nMax       Size of Out.
+ *    \param[out]    Out        The first nMax of the points found (in Morton order, not sorted by distance).
  *
- *    \author        Mike Henderson
- *    \date          2009-2012
+ *    \returns       The number of points within the radius. If this is more
+ *                   than nMax, only nMax of them are in Out. -1 if Octree is NULL.
  *
  */
-Lgm_OctreeCell *CreateNewOctants( Lgm_OctreeCell *Parent ) {
+long int Lgm_Octree_Radius( Lgm_Vector *q_in, Lgm_Octree *Octree, double Radius2, long int nMax, Lgm_OctreeData *Out ) {
 
-    int             i;
-    unsigned int    xMask, yMask, zMask, BranchBit;
-    unsigned int    xParentCode, yParentCode, zParentCode;
-    unsigned int    xRight, yRight, zRight, Level;
-    char            Str[20];
-    double          xMin, yMin, zMin;
-    Lgm_OctreeCell  *Cell;
+    Lgm_Vector  q;
 
-    Level     = Parent->Level - 1;
-    BranchBit = 1<<Level;
-
-    /*
-     * allocate 8 cells at once
-     */
-    Cell = (Lgm_OctreeCell *) calloc( 8, sizeof( Lgm_OctreeCell ) );
-
-    /*
-     * For each cell, set nData = 0
-     * Set Parent
-     * Set Octant to NULL
-     * And determine the x,y,z Location Codes.
-     */
-    xMask = 1; yMask = 1<<1; zMask = 1<<2;
-    xParentCode = Parent->xLocationCode;
-    yParentCode = Parent->yLocationCode;
-    zParentCode = Parent->zLocationCode;
-//    printf("Parent: Center, h = %g %g %g  %g\n", Parent->Center.x, Parent->Center.y, Parent->Center.z, Parent->h);
-    for (i=0; i<8; i++){
-        Cell[i].nData = 0;
-        Cell[i].Parent = Parent;
-        Cell[i].Octant = NULL;
-
-        /*
-         * determine if this octant is left or right (i.e. in each coord)
-         */
-        xRight = i&xMask;
-        yRight = (i&yMask)>>1;
-        zRight = (i&zMask)>>2;
-
-        Cell[i].xLocationCode = ( xRight ) ? xParentCode + BranchBit : xParentCode;
-        Cell[i].yLocationCode = ( yRight ) ? yParentCode + BranchBit : yParentCode;
-        Cell[i].zLocationCode = ( zRight ) ? zParentCode + BranchBit : zParentCode;
-        Cell[i].Level = Level;
-
-        /*
-         * Determine center of cell and width/2 (h=half face width)
-         */
-        Cell[i].h = 0.5*Parent->h;
-        Cell[i].Center.x = (double)Cell[i].xLocationCode/(double)OCTREE_MAX_VAL + Cell[i].h;
-        Cell[i].Center.y = (double)Cell[i].yLocationCode/(double)OCTREE_MAX_VAL + Cell[i].h;
-        Cell[i].Center.z = (double)Cell[i].zLocationCode/(double)OCTREE_MAX_VAL + Cell[i].h;
-//    	printf("Child: Center, h = %g %g %g  %g\n", Cell[i].Center.x, Cell[i].Center.y, Cell[i].Center.z, Cell[i].h);
-
-
-
-//        printf("Cell[%d].Center = %g %g %g    h = %g\n", i, Cell[i].Center.x, Cell[i].Center.y, Cell[i].Center.z, Cell[i].h);
-//        Binary( Cell[i].xLocationCode, Str ); printf("Index = %d  xLocationCode = %s\n", i, Str);
-//        Binary( Cell[i].yLocationCode, Str ); printf("Index = %d  yLocationCode = %s\n", i, Str);
-//        Binary( Cell[i].zLocationCode, Str ); printf("Index = %d  zLocationCode = %s\n\n", i, Str);
-
-    }
+    if ( Octree == NULL ) return( -1 );
+    Lgm_OctreeScalePosition( q_in, &q, Octree );
 
-    return( Cell );
+    return( Octree_Radius( &q, Octree, Radius2, nMax, Out ) );
 
 }
 
 
 /**
- *  Recursively subdivide volume. Stop when the number of data points ber cell
- *  is lower than the threshold given by OCTREE_MAX_DATA_PER_OCTANT.
+ *  Finds all of the points inside an axis aligned box.
  *
- *    \param[in]     Node in the octree to subdivide.
+ *  The box is given by its lower and upper corners in the original
+ *  coordinates (boundary points are inside). Cells that are entirely inside
+ *  the box are taken whole and cells outside of it are skipped. The Dist2's
+ *  returned are 0.
  *
- *    \returns       void
+ *    \param[in]     BoxMin     Lower corner of the box.
+ *    \param[in]     BoxMax     Upper corner of the box.
+ *    \param[in]     Octree     The Octree.
+ *    \param[in]     nMax       Size of Out.
+ *    \param[out]    Out        The first nMax of the points found (in Morton order).
  *
- *    \author        Mike Henderson
- *    \date          2009-2012
+ *    \returns       The number of points in the box. If this is more than
+ *                   nMax, only nMax of them are in Out. -1 if Octree is NULL.
  *
  */
-void SubDivideVolume( Lgm_OctreeCell *Vol ) {
+long int Lgm_Octree_Box( Lgm_Vector *BoxMin, Lgm_Vector *BoxMax, Lgm_Octree *Octree, long int nMax, Lgm_OctreeData *Out ) {
 
-    int                 Level;
-    unsigned int        i, j, BranchBit, xLocationCode, yLocationCode, zLocationCode;
-    unsigned long int   ii;
-    unsigned int        *Octant;
-    char                Str[20];
+    long int            Stack[8*OCTREE_MAX_LEVELS+8], c, n = 0;
+    unsigned long int   j, j1;
+    Lgm_OctreeCell      *Cells, *Cell;
+    Lgm_Vector          a, b;
+    int                 nStack = 0, i, All;
 
+    if ( Octree == NULL ) return( -1 );
+    Cells = Octree->Cells;
+    Lgm_OctreeScalePosition( BoxMin, &a, Octree );
+    Lgm_OctreeScalePosition( BoxMax, &b, Octree );
 
-    /*
-     *  Create 8 new Octant cells
-     *  CreateNewOctant() should make nData = 0 as initial value.
-     */
-    Vol->Octant  = CreateNewOctants( Vol );
+    if ( Cells[0].nDataBelow > 0 ) Stack[nStack++] = 0;
 
-    /*
-     * Loop through the Data and figure out which
-     * octant they belong to. Do this first so we know
-     * how much memory we need to allocate to each child's
-     * data field.
-     */
-    Octant = (unsigned int *) calloc( Vol->nData, sizeof( unsigned int ) );
-    Level = Vol->Level-1;
-    BranchBit = 1<<Level;
-//printf("Level = %d\n", Level);
-//printf("BranchBit = %d\n", BranchBit);
-//Binary( BranchBit, Str );
-//printf("BranchBit = %s\n", Str);
-    for ( ii=0; ii<Vol->nData; ii++ ){
-
-        // code to find what octant the object is in. Call it j
-        xLocationCode = (unsigned int)(Vol->Data[ii].Position.x*OCTREE_MAX_VAL);
-        yLocationCode = (unsigned int)(Vol->Data[ii].Position.y*OCTREE_MAX_VAL);
-        zLocationCode = (unsigned int)(Vol->Data[ii].Position.z*OCTREE_MAX_VAL);
-//printf("Vol->Data[ii].Position.x, Vol->Data[ii].Position.y, Vol->Data[ii].Position.z = %g %g %g\n", Vol->Data[ii].Position.x, Vol->Data[ii].Position.y, Vol->Data[ii].Position.z);
-        j = (((xLocationCode & BranchBit) >> Level) + 2*( ((yLocationCode & BranchBit) >> Level) + 2*((zLocationCode & BranchBit) >> Level) ) );
-        Octant[ii] = j;
-        ++(Vol->Octant[j].nData);
-//printf("%4d: j = %d\n", ii, j);
+    while ( nStack > 0 ) {
 
-    }
+        Cell = &Cells[ Stack[--nStack] ];
 
-    /*
-     *  Alloc mem to hold the data in each child cell
-     */
-    for ( i=0; i<8; i++ ) {
-//        printf("nData = %d\n", Vol->Octant[i].nData);
-        Vol->Octant[i].Data = calloc( Vol->Octant[i].nData, sizeof( Lgm_OctreeData ) );
-        Vol->Octant[i].nData = 0; // reset to zero (will recount below)
-    }
+        if (   ( Cell->Center.x + Cell->h < a.x ) || ( Cell->Center.x - Cell->h > b.x )
+            || ( Cell->Center.y + Cell->h < a.y ) || ( Cell->Center.y - Cell->h > b.y )
+            || ( Cell->Center.z + Cell->h < a.z ) || ( Cell->Center.z - Cell->h > b.z ) ) continue;
 
-    /*
-     *  Copy the data into the children cells
-     */
-    for ( ii=0; ii<Vol->nData; ii++ ){
-        j = Octant[ii];
-        Vol->Octant[j].Data[ (Vol->Octant[j].nData)++ ] = Vol->Data[ii];
+        All =  ( Cell->Center.x - Cell->h >= a.x ) && ( Cell->Center.x + Cell->h <= b.x )
+            && ( Cell->Center.y - Cell->h >= a.y ) && ( Cell->Center.y + Cell->h <= b.y )
+            && ( Cell->Center.z - Cell->h >= a.z ) && ( Cell->Center.z + Cell->h <= b.z );
 
-    }
+        if ( ( Cell->Octant >= 0 ) && !All ) {
+            for ( i=7; i>=0; i-- ) {
+                c = Cell->Octant + i;
+                if ( Cells[c].nDataBelow > 0 ) Stack[nStack++] = c;
+            }
+        } else {
+            j1 = Cell->iData + Cell->nDataBelow;
+            for ( j=Cell->iData; j<j1; j++ ) {
+                if ( All || (    ( Octree->x[j] >= a.x ) && ( Octree->x[j] <= b.x )
+                              && ( Octree->y[j] >= a.y ) && ( Octree->y[j] <= b.y )
+                              && ( Octree->z[j] >= a.z ) && ( Octree->z[j] <= b.z ) ) ) {
+                    Octree_PutData( Octree, j, 0.0, n++, nMax, Out );
+                }
+            }
+        }
 
+    }
 
-    /*
-     * Zero the Data count in this cell.
-     * Free Octant -- not needed anymore.
-     * Free memory allocated to Parent data field -- its not a leaf anymore.
-     */
-    Vol->nDataBelow = Vol->nData;
-    Vol->nData = 0;
-    free( Octant ); Octant = NULL;
-    free( Vol->Data ); Vol->Data = NULL;
+    return( n );
 
+}
 
 
-    /*
-     *  Subdivide if there are too many objects in an octant cell
-     */
-    for ( i=0; i<8; i++ ) {
-        if ( (Vol->Octant[i].Level > 0 ) && (Vol->Octant[i].nData > OCTREE_MAX_DATA_PER_OCTANT ) ) SubDivideVolume( &(Vol->Octant[i]) );
+/**
+ *  Lgm_Octree_Radius() for many query points.
+ *
+ *  The queries are done in the Morton order of their positions (so that
+ *  consecutive queries go down the same parts of the tree and touch the same
+ *  points), split over threads in contiguous runs of that order. The
+ *  results still go where the query's own index says.
+ *
+ *    \param[in]     nq         Number of query points.
+ *    \param[in]     q          Query positions (original coordinates).
+ *    \param[in]     Octree     The Octree.
+ *    \param[in]     Radius2    Distance^2 (normalized) of the points wanted.
+ *    \param[in]     nMax       Room for each query's points in Out.
+ *    \param[out]    Count      Count[i] is what Lgm_Octree_Radius() would return for q[i].
+ *    \param[out]    Out        Out[i*nMax .. i*nMax+nMax-1] gets the points of q[i].
+ *
+ *    \returns       The total number of points found (over all queries). -1 if Octree is NULL.
+ *
+ */
+long int Lgm_Octree_Radius_Batch( long int nq, Lgm_Vector *q, Lgm_Octree *Octree, double Radius2, long int nMax, long int *Count, Lgm_OctreeData *Out ) {
+
+    uint64_t    *Key;
+    uint32_t    *Idx;
+    long int    k, i, Total = 0;
+    Lgm_Vector  s;
+
+    if ( Octree == NULL ) return( -1 );
+    if ( nq <= 0 ) return( 0 );
+
+    Key = (uint64_t *) malloc( nq*sizeof( uint64_t ) );
+    Idx = (uint32_t *) malloc( nq*sizeof( uint32_t ) );
+    for ( k=0; k<nq; k++ ) {
+        Lgm_OctreeScalePosition( &q[k], &s, Octree );
+        Key[k] = Lgm_OctreeMortonCode( Octree_LocationCode( s.x ), Octree_LocationCode( s.y ), Octree_LocationCode( s.z ) );
+        Idx[k] = (uint32_t)k;
+    }
+    Octree_RadixSort( Key, Idx, nq );
+
+#if USE_OPENMP
+    #pragma omp parallel for private(i,s) reduction(+:Total) schedule(static) if( nq >= 256 )
+#endif
+    for ( k=0; k<nq; k++ ) {
+        i = Idx[k];
+        Lgm_OctreeScalePosition( &q[i], &s, Octree );
+        Count[i] = Octree_Radius( &s, Octree, Radius2, nMax, &Out[ i*nMax ] );
+        Total   += Count[i];
     }
 
+    free( Key );
+    free( Idx );
 
-    return;
-
+    return( Total );
 
 }
 
+
+
+
 /**
  *  Scale an input vector position. E.g., \f$ v = (u-Min)/ (Max-Min)\f$.
  *
@@ -0,0 +1,231 @@
+/*! \file Lgm_PointCloud.c
+ *
+ *  \brief Memory mapped point cloud files (e.g. MHD snapshots) for the scattered data B-field models.
+ *
+ *  A point cloud file holds the positions and field vectors as separate
+ *  float or double arrays (see Lgm_PointCloud.h). The file is mapped rather
+ *  than read, and the octree is built straight from the mapped arrays, so
+ *  a large snapshot is never copied into Lgm_Vector arrays first; the only
+ *  copy made is the octree's own (Morton ordered, scaled) point arrays.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include "Lgm/Lgm_PointCloud.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+
+static void PointCloud_Unmap( unsigned char *Base, size_t Size ) {
+#ifdef HAVE_SYS_MMAN_H
+    munmap( Base, Size );
+#else
+    free( Base );
+#endif
+}
+
+/**
+ *   Opens a point cloud file written by Lgm_SavePointCloud() (or by anything
+ *   else that writes the same layout).
+ *
+ *   The file is memory mapped (read only) and the arrays in the returned
+ *   structure point straight into it. Close it with Lgm_ClosePointCloud()
+ *   once any octree made from it is no longer needed (the octree has its
+ *   own copy of the positions and B, but E is only in the mapping).
+ *
+ *      \param[in]      Filename    The point cloud file.
+ *
+ *      \returns        The point cloud, or NULL if the file could not be read
+ *                      or is not a valid point cloud file.
+ *
+ */
+Lgm_PointCloud *Lgm_OpenPointCloud( char *Filename ) {
+
+    int                         fd, k, nArr, Ok;
+    uint64_t                    n;
+    size_t                      Size;
+    struct stat                 sb;
+    unsigned char               *Base;
+    Lgm_PointCloudFileHeader    *h;
+    Lgm_PointCloud              *pc;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_PointCloudFileHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+    // Building the octree reads every array front to back.
+    madvise( Base, Size, MADV_SEQUENTIAL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     * Validate the header
+     */
+    h    = (Lgm_PointCloudFileHeader *)Base;
+    n    = h->n;
+    nArr = ( h->Flags & LGM_POINTCLOUD_HAS_E ) ? 9 : 6;
+    Ok = (memcmp( h->Magic, LGM_POINTCLOUD_FILE_MAGIC, 8 ) == 0) && (h->Version == LGM_POINTCLOUD_FILE_VERSION)
+            && ( (h->ElemSize == 4) || (h->ElemSize == 8) ) && (n > 0) && (n <= Size/h->ElemSize);
+    for ( k=0; Ok && (k<nArr); k++ ) Ok = (h->Offset[k] % h->ElemSize == 0) && (h->Offset[k] <= Size) && (n*h->ElemSize <= Size - h->Offset[k]);
+    if ( !Ok ) {
+        fprintf( stderr, "Lgm_OpenPointCloud(): %s is not a valid point cloud file.\n", Filename );
+        PointCloud_Unmap( Base, Size );
+        return( NULL );
+    }
+
+    pc = (Lgm_PointCloud *) calloc( 1, sizeof( Lgm_PointCloud ) );
+    pc->n       = n;
+    pc->IsFloat = ( h->ElemSize == 4 );
+    pc->HasE    = ( nArr == 9 );
+    pc->x  = Base + h->Offset[0];
+    pc->y  = Base + h->Offset[1];
+    pc->z  = Base + h->Offset[2];
+    pc->Bx = Base + h->Offset[3];
+    pc->By = Base + h->Offset[4];
+    pc->Bz = Base + h->Offset[5];
+    if ( pc->HasE ) {
+        pc->Ex = Base + h->Offset[6];
+        pc->Ey = Base + h->Offset[7];
+        pc->Ez = Base + h->Offset[8];
+    }
+    pc->Mapping     = Base;
+    pc->MappingSize = Size;
+
+    return( pc );
+
+}
+
+void Lgm_ClosePointCloud( Lgm_PointCloud *pc ) {
+    if ( pc == NULL ) return;
+    PointCloud_Unmap( pc->Mapping, pc->MappingSize );
+    free( pc );
+}
+
+/**
+ *   Builds an octree from a point cloud. The Morton codes are computed from
+ *   the mapped arrays and the sort permutation is then used to gather them
+ *   into the octree (see Lgm_InitOctree_SoA()). Hand the result to
+ *   Lgm_MagModelInfo_Set_Octree() as usual.
+ *
+ *      \param[in]      pc      An open point cloud.
+ *
+ *      \returns        The octree (free with Lgm_FreeOctree()), or NULL.
+ *
+ */
+Lgm_Octree *Lgm_PointCloud_InitOctree( Lgm_PointCloud *pc ) {
+    if ( pc == NULL ) return( NULL );
+    return( Lgm_InitOctree_SoA( pc->x, pc->y, pc->z, pc->Bx, pc->By, pc->Bz, pc->IsFloat, (unsigned long int)pc->n ) );
+}
+
+static double PointCloud_Val( const void *p, unsigned long int j, int IsFloat ) {
+    return( IsFloat ? (double)((const float *)p)[j] : ((const double *)p)[j] );
+}
+
+/**
+ *   Gets point j (e.g. the Id of a kNN point) of a point cloud. Any of u, B
+ *   and E can be NULL. E is set to zero if the file has no E.
+ */
+void Lgm_PointCloud_Get( Lgm_PointCloud *pc, unsigned long int j, Lgm_Vector *u, Lgm_Vector *B, Lgm_Vector *E ) {
+
+    int f = pc->IsFloat;
+
+    if ( u ) {
+        u->x = PointCloud_Val( pc->x, j, f ); u->y = PointCloud_Val( pc->y, j, f ); u->z = PointCloud_Val( pc->z, j, f );
+    }
+    if ( B ) {
+        B->x = PointCloud_Val( pc->Bx, j, f ); B->y = PointCloud_Val( pc->By, j, f ); B->z = PointCloud_Val( pc->Bz, j, f );
+    }
+    if ( E ) {
+        if ( pc->HasE ) {
+            E->x = PointCloud_Val( pc->Ex, j, f ); E->y = PointCloud_Val( pc->Ey, j, f ); E->z = PointCloud_Val( pc->Ez, j, f );
+        } else {
+            E->x = E->y = E->z = 0.0;
+        }
+    }
+
+}
+
+static int PointCloud_PWrite( int fd, const void *buf, size_t n, uint64_t Offset ) {
+    const char  *p = (const char *)buf;
+    ssize_t     k;
+    while ( n > 0 ) {
+        if ( (k = pwrite( fd, p, n, (off_t)Offset )) <= 0 ) return( FALSE );
+        p += k; n -= (size_t)k; Offset += (uint64_t)k;
+    }
+    return( TRUE );
+}
+
+/**
+ *   Writes a point cloud file that Lgm_OpenPointCloud() can map.
+ *
+ *      \param[in]      Filename    File to write (overwritten if it exists).
+ *      \param[in]      n           Number of points.
+ *      \param[in]      IsFloat     TRUE if the arrays are floats, FALSE if doubles.
+ *      \param[in]      x, y, z     Positions.
+ *      \param[in]      Bx, By, Bz  B-field.
+ *      \param[in]      Ex, Ey, Ez  E-field, or all NULL for none.
+ *
+ *      \returns        TRUE on success, FALSE otherwise.
+ *
+ */
+int Lgm_SavePointCloud( char *Filename, unsigned long int n, int IsFloat, const void *x, const void *y, const void *z,
+                        const void *Bx, const void *By, const void *Bz, const void *Ex, const void *Ey, const void *Ez ) {
+
+    int                         fd, k, nArr, Status;
+    Lgm_PointCloudFileHeader    h;
+    const void                  *Arr[9];
+    uint64_t                    Bytes;
+
+    Arr[0] = x;  Arr[1] = y;  Arr[2] = z;
+    Arr[3] = Bx; Arr[4] = By; Arr[5] = Bz;
+    Arr[6] = Ex; Arr[7] = Ey; Arr[8] = Ez;
+    nArr = ( Ex && Ey && Ez ) ? 9 : 6;
+
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.Magic, LGM_POINTCLOUD_FILE_MAGIC, 8 );
+    h.Version  = LGM_POINTCLOUD_FILE_VERSION;
+    h.ElemSize = IsFloat ? 4 : 8;
+    h.Flags    = ( nArr == 9 ) ? LGM_POINTCLOUD_HAS_E : 0;
+    h.n        = n;
+    Bytes      = (uint64_t)n*h.ElemSize;
+    h.Offset[0] = ( sizeof(h) + LGM_POINTCLOUD_FILE_ALIGN - 1 )/LGM_POINTCLOUD_FILE_ALIGN*LGM_POINTCLOUD_FILE_ALIGN;
+    for ( k=1; k<nArr; k++ ) h.Offset[k] = ( h.Offset[k-1] + Bytes + LGM_POINTCLOUD_FILE_ALIGN - 1 )/LGM_POINTCLOUD_FILE_ALIGN*LGM_POINTCLOUD_FILE_ALIGN;
+
+    if ( (fd = open( Filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) < 0 ) {
+        fprintf( stderr, "Lgm_SavePointCloud(): Could not open %s for writing.\n", Filename );
+        return( FALSE );
+    }
+    Status = PointCloud_PWrite( fd, &h, sizeof(h), 0 );
+    for ( k=0; Status && (k<nArr); k++ ) Status = PointCloud_PWrite( fd, Arr[k], Bytes, h.Offset[k] );
+    Status = ( close( fd ) == 0 ) && Status;
+    if ( !Status ) fprintf( stderr, "Lgm_SavePointCloud(): Error writing %s.\n", Filename );
+
+    return( Status );
+
+}
@@ -350,6 +350,124 @@ int Lgm_QuarticRootsSorted( double b, double c, double d, double e, int *nReal,
 }
 
 
+/**
+ *  \brief
+ *      Returns the real roots of many quartic equations with real coefficients.
+ *
+ *  \details
+ *      For each i = 0, ..., n-1 finds the real roots of
+ *
+ *              \f[z^4 + b_i z^3 + c_i z^2 + d_i z + e_i = 0.\f]
+ *
+ *      This is Ferrari's method (as in Lgm_QuarticRoots()) done in real
+ *      arithmetic. The largest real root, y1, of the resolvent cubic makes
+ *      \f$R^2 = b^2/4 - c + y_1 \ge 0\f$, so the quartic splits into the two
+ *      real quadratics
+ *
+ *              \f[z^2 + (b/2 \mp R) z + (y_1/2 \mp m) = 0,\f]
+ *
+ *      where \f$m = (b y_1/2 - d)/(2R)\f$ (or \f$\sqrt{y_1^2/4 - e}\f$ for
+ *      small R). Both the Cardano and the trigonometric forms of the cubic
+ *      root are evaluated, and all choices are made with selects, so the
+ *      loop has no branches and can be vectorized by the compiler.
+ *
+ *      As in Lgm_QuarticRoots(), a root counts as real if its imaginary part
+ *      would be less than 1e-10 in magnitude.
+ *
+ *      \param[in]      n   Number of quartics.
+ *      \param[in]      b   Real coefficients of the \f$z^3\f$ terms (n of them).
+ *      \param[in]      c   Real coefficients of the \f$z^2\f$ terms.
+ *      \param[in]      d   Real coefficients of the \f$z\f$ terms.
+ *      \param[in]      e   Real constant terms.
+ *      \param[out]     x   The roots. x[4*i], ..., x[4*i+3] are the roots of
+ *                          the i'th quartic, with NAN in place of complex roots.
+ *
+ */
+void Lgm_QuarticRealRoots_N( int n, double *b, double *c, double *d, double *e, double *x ){
+
+    int     i;
+
+    for ( i=0; i<n; i++ ) {
+
+        int     Small, Big1, Ok;
+        double  qBig, pBig, qSm, pSm;
+        double  bi, ci, di, ei, p, q, r, p2, Q, Rc, D2, SqD, Cardano, SqrtNQ, Den, Arg, Trig, y1;
+        double  R2, R, m, mR, mS, p1, q1, p3, q3, Disc1, Disc3, t1, t3;
+
+        bi = b[i]; ci = c[i]; di = d[i]; ei = e[i];
+
+        /*
+         * Largest real root of the resolvent cubic, y^3 + p y^2 + q y + r = 0.
+         */
+        p  = -ci;
+        q  = bi*di - 4.0*ei;
+        r  = 4.0*ci*ei - bi*bi*ei - di*di;
+        p2 = p*p;
+        Q  = (3.0*q - p2)/9.0;
+        Rc = (9.0*p*q - 27.0*r - 2.0*p2*p)/54.0;
+        D2 = Q*Q*Q + Rc*Rc;
+
+        SqD     = sqrt( fmax( D2, 0.0 ) );
+        Cardano = cbrt( Rc + SqD ) + cbrt( Rc - SqD );
+
+        SqrtNQ  = sqrt( fmax( -Q, 0.0 ) );
+        Den     = SqrtNQ*fabs(Q);
+        Arg     = Rc/( ( Den > 0.0 ) ? Den : 1.0 );
+        Arg     = fmin( fmax( Arg, -1.0 ), 1.0 );
+        Trig    = 2.0*SqrtNQ*cos( acos( Arg )/3.0 );
+
+        y1 = ( ( D2 >= 0.0 ) ? Cardano : Trig ) - p/3.0;
+
+        /*
+         * Split into two real quadratics.
+         */
+        R2    = fmax( 0.25*bi*bi - ci + y1, 0.0 );
+        R     = sqrt( R2 );
+        Small = ( R2 < 1e-7 );
+        mR    = ( 0.5*bi*y1 - di )/( Small ? 1.0 : 2.0*R );
+        mS    = sqrt( fmax( 0.25*y1*y1 - ei, 0.0 ) );
+        m     = Small ? mS : mR;
+
+        p1 = 0.5*bi - R; q1 = 0.5*y1 - m;
+        p3 = 0.5*bi + R; q3 = 0.5*y1 + m;
+
+        /*
+         * The smaller of q1, q3 suffers from cancellation. Get it from q1*q3 =
+         * e instead, and then its p from p1*q3 + p3*q1 = d. (Otherwise, e.g.,
+         * a pair of tiny real roots of opposite sign can come out complex.)
+         */
+        Big1  = ( fabs(q1) >= fabs(q3) );
+        qBig  = Big1 ? q1 : q3;
+        pBig  = Big1 ? p1 : p3;
+        Ok    = ( qBig != 0.0 );
+        qBig  = Ok ? qBig : 1.0;
+        qSm   = Ok ? ei/qBig : ( Big1 ? q3 : q1 );
+        pSm   = Ok ? ( di - pBig*qSm )/qBig : ( Big1 ? p3 : p1 );
+        q3    = Big1 ? qSm : q3;
+        p3    = Big1 ? pSm : p3;
+        q1    = Big1 ? q1 : qSm;
+        p1    = Big1 ? p1 : pSm;
+
+        /*
+         * Roots of the quadratics. Take the larger one from the formula and
+         * the other from the product of the roots (the small roots would be
+         * lost to cancellation otherwise).
+         */
+        Disc1 = p1*p1 - 4.0*q1;
+        Disc3 = p3*p3 - 4.0*q3;
+        t1    = -0.5*( p1 + copysign( sqrt( fmax( Disc1, 0.0 ) ), p1 ) );
+        t3    = -0.5*( p3 + copysign( sqrt( fmax( Disc3, 0.0 ) ), p3 ) );
+
+        x[4*i]   = ( Disc1 > -4e-20 ) ? t1 : NAN;
+        x[4*i+1] = ( Disc1 > -4e-20 ) ? ( ( t1 != 0.0 ) ? q1/t1 : 0.0 ) : NAN;
+        x[4*i+2] = ( Disc3 > -4e-20 ) ? t3 : NAN;
+        x[4*i+3] = ( Disc3 > -4e-20 ) ? ( ( t3 != 0.0 ) ? q3/t3 : 0.0 ) : NAN;
+
+    }
+
+}
+
+
 
 /*
  *  An arbitrary polynomial root solver written by C. Bond (see
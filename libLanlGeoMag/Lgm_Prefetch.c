@@ -0,0 +1,232 @@
+/*! \file Lgm_Prefetch.c
+ *
+ *  \brief Read the next day's input data on a background thread.
+ *
+ *  Day-by-day programs (MagEphemFromTLE, LastClosedDriftShell, ...) used to
+ *  stall at every day boundary: the first time step of the new day found
+ *  the Qin-Denton day cache empty and parsed the files inside the cache's
+ *  critical section (holding up every other thread that wanted it), the
+ *  TS07D coefficients were read one 5-minute file at a time from the
+ *  compute threads, and so on. A Lgm_Prefetcher reads day D+1 while day D
+ *  is being computed:
+ *
+ *      Lgm_Prefetcher *p = Lgm_InitPrefetcher( LGM_PREFETCH_QINDENTON | LGM_PREFETCH_TS07 );
+ *      Lgm_Prefetch( p, StartDate );
+ *      for ( each Date ) {
+ *          Lgm_Prefetch( p, Date+1 );      // waits for Date's, starts Date+1's
+ *          ... compute Date ...
+ *      }
+ *      Lgm_FreePrefetcher( p );
+ *
+ *  The data goes into the same caches the on-demand paths use (see
+ *  Lgm_QinDenton_PrefetchDay() and Lgm_TS07_PrefetchDay()), and those only
+ *  lock the cache to put a finished day in, so the compute threads never
+ *  wait on the parsing. Nothing else changes: anything that wasnt
+ *  prefetched (or couldnt be) is still read when it is needed, so a
+ *  prefetch is only ever a hint.
+ *
+ *  With LGM_PREFETCH_EOP the shared EOP series (Lgm_get_shared_eop()) is read
+ *  by the first job, and the prefetcher holds on to it until it is freed
+ *  (get it with Lgm_Prefetch_GetEop()). Other files (e.g. the next day's TLE
+ *  files) can be added with Lgm_Prefetcher_AddFile(); these are just read
+ *  through once, so that they come from the page cache rather than from
+ *  (possibly network) disk when the program opens them.
+ *
+ *  Only one job runs at a time, on its own thread. Without pthreads
+ *  Lgm_Prefetch() does nothing.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_QinDenton.h"
+#include "Lgm/Lgm_Tsyg2007.h"
+#include "Lgm/Lgm_Prefetch.h"
+
+
+/*
+ *  Read a file through once (to get it into the page cache).
+ */
+static void Lgm_Prefetch_ReadFile( const char *Filename ) {
+
+    int     fd;
+    char    Buf[65536];
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return;
+    while ( read( fd, Buf, 65536 ) > 0 );
+    close( fd );
+
+}
+
+
+/*
+ *  The job: everything for p->Date.
+ */
+static void *Lgm_Prefetch_Job( void *Data ) {
+
+    Lgm_Prefetcher  *p = (Lgm_Prefetcher *)Data;
+    int             Year, Month, Day, Doy, k;
+    long int        JDN, Date;
+    double          UT;
+
+    if ( ( p->What & LGM_PREFETCH_EOP ) && ( p->Eop == NULL ) ) p->Eop = Lgm_get_shared_eop( );
+
+    if ( p->What & LGM_PREFETCH_QINDENTON ) {
+        // Lgm_read_QinDenton() wants the days either side too
+        Lgm_Doy( p->Date, &Year, &Month, &Day, &Doy );
+        JDN = Lgm_JDN( Year, Month, Day );
+        for ( k=-1; k<=1; k++ ) {
+            Lgm_jd_to_ymdh( (double)(JDN+k), &Date, &Year, &Month, &Day, &UT );
+            Lgm_QinDenton_PrefetchDay( Date );
+        }
+    }
+
+    if ( p->What & LGM_PREFETCH_TS07 ) Lgm_TS07_PrefetchDay( p->Date );
+
+    for ( k=0; k<p->nJobFiles; k++ ) Lgm_Prefetch_ReadFile( p->JobFiles[k] );
+
+    return( NULL );
+
+}
+
+
+/**
+ *  \brief
+ *      Make a prefetcher.
+ *
+ *      \param[in]      What    LGM_PREFETCH_* flags (or'ed together) saying what to read.
+ *
+ *      \return         The prefetcher. Free it with Lgm_FreePrefetcher().
+ */
+Lgm_Prefetcher *Lgm_InitPrefetcher( int What ) {
+
+    Lgm_Prefetcher *p = (Lgm_Prefetcher *)calloc( 1, sizeof(Lgm_Prefetcher) );
+
+    p->What = What;
+    p->Date = -1;
+#ifdef HAVE_PTHREAD_H
+    p->Thread = calloc( 1, sizeof(pthread_t) );
+#endif
+
+    return( p );
+
+}
+
+
+/**
+ *  \brief
+ *      Free a prefetcher (after waiting for its job, if one is running).
+ */
+void Lgm_FreePrefetcher( Lgm_Prefetcher *p ) {
+
+    int k;
+
+    if ( p == NULL ) return;
+
+    Lgm_Prefetch_Wait( p );
+    if ( p->Eop != NULL ) Lgm_release_shared_eop( p->Eop );
+    for ( k=0; k<p->nFiles; k++ )    free( p->Files[k] );
+    for ( k=0; k<p->nJobFiles; k++ ) free( p->JobFiles[k] );
+    free( p->Thread );
+    free( p );
+
+}
+
+
+/**
+ *  \brief
+ *      Add a file to be read ahead with the next day.
+ *
+ *  \details
+ *      The files added since the last Lgm_Prefetch() go with the next one.
+ *
+ *      \return         FALSE if there are already LGM_PREFETCH_MAX_FILES files waiting.
+ */
+int Lgm_Prefetcher_AddFile( Lgm_Prefetcher *p, const char *Filename ) {
+
+    if ( p->nFiles >= LGM_PREFETCH_MAX_FILES ) return( FALSE );
+    p->Files[ p->nFiles++ ] = strdup( Filename );
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  \brief
+ *      Start reading the input data for a day in the background.
+ *
+ *  \details
+ *      Waits for the previous day's job (if it is still going) and then
+ *      starts one for Date, and returns straight away.
+ *
+ *      \param[in]      p       The prefetcher.
+ *      \param[in]      Date    Date in YYYYMMDD format.
+ *
+ *      \return         TRUE if the job was started, FALSE if it couldnt be (the data will then just be read when it is needed).
+ */
+int Lgm_Prefetch( Lgm_Prefetcher *p, long int Date ) {
+
+    int k;
+
+    Lgm_Prefetch_Wait( p );
+
+    for ( k=0; k<p->nJobFiles; k++ ) free( p->JobFiles[k] );
+    memcpy( p->JobFiles, p->Files, p->nFiles*sizeof(char *) );
+    p->nJobFiles = p->nFiles;
+    p->nFiles    = 0;
+    p->Date      = Date;
+    ++p->nDays;
+
+#ifdef HAVE_PTHREAD_H
+    if ( pthread_create( (pthread_t *)p->Thread, NULL, Lgm_Prefetch_Job, (void *)p ) == 0 ) {
+        p->Running = TRUE;
+        ++p->nBackground;
+        return( TRUE );
+    }
+#endif
+
+    return( FALSE );
+
+}
+
+
+/**
+ *  \brief
+ *      Wait for the job in progress (if there is one) to finish.
+ */
+void Lgm_Prefetch_Wait( Lgm_Prefetcher *p ) {
+
+#ifdef HAVE_PTHREAD_H
+    if ( p->Running ) pthread_join( *(pthread_t *)p->Thread, NULL );
+#endif
+    p->Running = FALSE;
+
+}
+
+
+/**
+ *  \brief
+ *      The shared EOP series held by the prefetcher.
+ *
+ *  \details
+ *      Waits for the job in progress, and reads the series now if no job
+ *      has (e.g. LGM_PREFETCH_EOP wasnt set). It stays valid until
+ *      Lgm_FreePrefetcher() and must be treated as read-only.
+ */
+Lgm_Eop *Lgm_Prefetch_GetEop( Lgm_Prefetcher *p ) {
+
+    Lgm_Prefetch_Wait( p );
+    if ( p->Eop == NULL ) p->Eop = Lgm_get_shared_eop( );
+
+    return( p->Eop );
+
+}
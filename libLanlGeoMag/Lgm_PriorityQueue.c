@@ -15,6 +15,7 @@ Lgm_pQueue *Lgm_pQueue_Create( long int n ) {
      * Allocate memory for the heap array. Here we create an array of pointers
      * to void so that they can point to anything.
      */
+    if ( n < 2 ) n = 2;
     p->nHeapArray = n;
     p->HeapArray  = (Lgm_pQueue_Node *)calloc( n, sizeof(Lgm_pQueue_Node) );
 
@@ -38,24 +39,50 @@ void Lgm_pQueue_Destroy( Lgm_pQueue *p ) {
 }
 
 
-void Lgm_pQueue_Insert( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
-    int i, n;
-
-    if ( p->HeapSize >= p->nHeapArray-1 ) {
-        n = 2*p->nHeapArray;
-        p->HeapArray  = (Lgm_pQueue_Node *)realloc( p->HeapArray, n*sizeof(Lgm_pQueue_Node) );
-        if ( !p->HeapArray ) {
-            printf("Lgm_pQueue_Insert: Memory allocation failure. Trying to realloc %d elements\n", n);
-            exit(1);
-        } else {
-            p->nHeapArray = n;
-            //printf("Realloced HeapArray. Size = %d\n", p->nHeapArray);
-        }
-        
+/**
+ *  Make sure the heap has room for at least n elements without having to
+ *  realloc. (Works on a zeroed Lgm_pQueue too, so a queue can be embedded in
+ *  another struct.)
+ */
+void Lgm_pQueue_Reserve( long int n, Lgm_pQueue *p ) {
+
+    long int            nNew;
+    Lgm_pQueue_Node     *h;
+
+    if ( n < p->nHeapArray ) return;
+
+    nNew = ( p->nHeapArray > 1 ) ? p->nHeapArray : 2;
+    while ( nNew <= n ) nNew *= 2;
+    h = (Lgm_pQueue_Node *)realloc( p->HeapArray, nNew*sizeof(Lgm_pQueue_Node) );
+    if ( !h ) {
+        printf("Lgm_pQueue_Reserve: Memory allocation failure. Trying to realloc %ld elements\n", nNew);
+        exit(1);
     }
+    p->HeapArray  = h;
+    p->nHeapArray = nNew;
+
+    return;
+}
+
+
+/**
+ *  Empty the queue, keeping its memory for reuse.
+ */
+void Lgm_pQueue_Reset( Lgm_pQueue *p ) {
+    p->HeapSize = 0;
+    return;
+}
+
+
+void Lgm_pQueue_Insert( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
+    long int    i, Parent;
+
+    if ( p->HeapSize >= p->nHeapArray-1 ) Lgm_pQueue_Reserve( p->HeapSize+1, p );
 
-    for ( i = ++(p->HeapSize); (i > 1)&&( X->key < p->HeapArray[i/2].key); i /= 2 ) {
-        p->HeapArray[i] = p->HeapArray[i/2];
+    for ( i = ++(p->HeapSize); i > 1; i = Parent ) {
+        Parent = LGM_PQUEUE_PARENT( i );
+        if ( !( X->key < p->HeapArray[Parent].key ) ) break;
+        p->HeapArray[i] = p->HeapArray[Parent];
     }
     p->HeapArray[i] = *X;
 
@@ -63,37 +90,94 @@ void Lgm_pQueue_Insert( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
 }
 
 
+/**
+ *  Insert n nodes at once. When the batch is big compared to what is
+ *  already in the heap, the nodes are appended and the heap is rebuilt
+ *  bottom up (which is O(N) rather than O(n log N)); otherwise they are
+ *  inserted one by one.
+ */
+void Lgm_pQueue_InsertArray( Lgm_pQueue_Node *X, long int n, Lgm_pQueue *p ) {
+    long int    i;
+
+    if ( n <= 0 ) return;
+    Lgm_pQueue_Reserve( p->HeapSize+n, p );
+
+    if ( n < p->HeapSize ) {
+        for ( i=0; i<n; i++ ) Lgm_pQueue_Insert( &X[i], p );
+    } else {
+        for ( i=0; i<n; i++ ) p->HeapArray[ p->HeapSize+1+i ] = X[i];
+        p->HeapSize += n;
+        for ( i = LGM_PQUEUE_PARENT( p->HeapSize ); i >= 1; i-- ) Lgm_pQueue_PercolateDown( i, p );
+    }
+
+    return;
+}
+
+
+/*
+ *  Index of the smallest of the children starting at C (there are four of
+ *  them unless C+3 > n).
+ */
+static inline long int SmallestChild( long int C, long int n, Lgm_pQueue_Node *h ) {
+    long int    a, b;
+    if ( C+3 <= n ) {
+        // (written so the compiler can do this without branches)
+        a = C   + ( h[C+1].key < h[C].key   );
+        b = C+2 + ( h[C+3].key < h[C+2].key );
+        return( ( h[b].key < h[a].key ) ? b : a );
+    }
+    for ( a=C, b=C+1; b<=n; b++ ) if ( h[b].key < h[a].key ) a = b;
+    return( a );
+}
+
 void Lgm_pQueue_PercolateDown( long int i, Lgm_pQueue *p ) {
-    int             C;
-    Lgm_pQueue_Node t;
-
-    t = p->HeapArray[i];
-    for ( ; 2*i <= p->HeapSize; i = C ) {
-        C = 2*i;
-        if ( (C != p->HeapSize) && ( p->HeapArray[C+1].key  < p->HeapArray[C].key ) )  C++;
-        if ( p->HeapArray[C].key < t.key ) {
-            p->HeapArray[i] = p->HeapArray[C];
+    long int        C, n;
+    Lgm_pQueue_Node t, *h;
+
+    h = p->HeapArray;
+    n = p->HeapSize;
+    t = h[i];
+    for ( ; (C = LGM_PQUEUE_FIRSTCHILD( i )) <= n; i = C ) {
+        C = SmallestChild( C, n, h );
+        if ( h[C].key < t.key ) {
+            h[i] = h[C];
         } else {
             break;
         }
     }
-    p->HeapArray[i] = t;
+    h[i] = t;
     return;
 }
 
 int Lgm_pQueue_Pop( Lgm_pQueue_Node *X, Lgm_pQueue *p ) {
 
+    long int        i, C, n, Parent;
+    Lgm_pQueue_Node t, *h;
 
     if ( p->HeapSize <= 0 ) return(0);
 
     // return the first element
-    *X = p->HeapArray[1];
+    h  = p->HeapArray;
+    *X = h[1];
 
-    // move last element to top
-    p->HeapArray[1] = p->HeapArray[ (p->HeapSize)-- ];
-
-    // reorder tree
-    Lgm_pQueue_PercolateDown( 1, p );
+    /*
+     * Take the last element out, and move the hole at the root all the way
+     * down along the smallest children. The last element nearly always
+     * belongs near the bottom, so putting it in the hole and moving it back
+     * up takes fewer comparisons than percolating it down from the top.
+     */
+    t = h[ (p->HeapSize)-- ];
+    n = p->HeapSize;
+    for ( i=1; (C = LGM_PQUEUE_FIRSTCHILD( i )) <= n; i = C ) {
+        C = SmallestChild( C, n, h );
+        h[i] = h[C];
+    }
+    for ( ; i > 1; i = Parent ) {
+        Parent = LGM_PQUEUE_PARENT( i );
+        if ( !( t.key < h[Parent].key ) ) break;
+        h[i] = h[Parent];
+    }
+    h[i] = t;
     
     return(1);
 
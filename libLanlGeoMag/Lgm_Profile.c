@@ -0,0 +1,443 @@
+/*! \file Lgm_Profile.c
+ *
+ *  \brief A region profiler for finding out where a run spends its time.
+ *
+ *  \details
+ *      Lgm_ElapsedTime.c only tells us how long a whole run took, to the
+ *      second. This keeps nanosecond totals for named regions of the code,
+ *      nested, so that a production run can say how much of its time went
+ *      into e.g. tracing, the shell line searches, the I integrals and the
+ *      output, without recompiling or running under an external profiler.
+ *
+ *      The library's main stages are already marked (see the LGM_PROF_*
+ *      regions in Lgm_Profile.h). Other code can add its own with
+ *
+ *          static int r = -1;
+ *          if ( r < 0 ) r = Lgm_ProfileRegion( "MyStage" );
+ *          LGM_PROFILE_BEGIN( r );
+ *              ...
+ *          LGM_PROFILE_END( r );
+ *
+ *      Nothing is recorded unless the environment variable LGM_PROFILE is
+ *      set (or Lgm_ProfileEnable() is called):
+ *
+ *          LGM_PROFILE=text    print a tree of the regions at exit
+ *          LGM_PROFILE=json    print the same thing as JSON
+ *          LGM_PROFILE_FILE    write the report here instead of to stderr
+ *
+ *      Each thread keeps its own tree of (region, parent) nodes with a call
+ *      count and the total time, so Begin/End dont need any locking. The
+ *      trees are merged path by path in Lgm_ProfileReport(). The times of
+ *      the threads are added, so with N threads busy the top level totals
+ *      can be up to N times the wall clock time. Self time is a region's
+ *      total less that of the regions inside it.
+ *
+ *      A thread that waits on tasks (see Lgm_Tasks.c) may run other tasks
+ *      while one of its regions is open; their regions are then counted
+ *      under that one as well.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Lgm/Lgm_Profile.h"
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+int Lgm_ProfileOn = -1;
+
+typedef struct Lgm_ProfileNode {
+    int         Region;
+    int         Parent;             // index of the parent node (-1 at the top)
+    long int    n;                  // number of times the region was entered
+    long long   t;                  // total time in it (ns)
+} Lgm_ProfileNode;
+
+typedef struct Lgm_ProfileThread {
+    int                         nNodes;
+    Lgm_ProfileNode             Nodes[LGM_PROF_MAXNODES];
+    int                         Depth;
+    int                         Stack[LGM_PROF_MAXDEPTH];   // node of each open region (-1 if it wasnt recorded)
+    long long                   Start[LGM_PROF_MAXDEPTH];
+    struct Lgm_ProfileThread    *Next;
+} Lgm_ProfileThread;
+
+static const char *Lgm_ProfileBuiltin[LGM_PROF_NBUILTIN] = { "Trace", "FindShellLine", "IIntegral", "MagFlux", "CTrans", "IO" };
+
+static char                 *Lgm_ProfileNames[LGM_PROF_MAXREGIONS];
+static int                  Lgm_ProfileNRegions = 0;
+static Lgm_ProfileThread    *Lgm_ProfileThreads = NULL;     // every thread that has recorded anything
+static __thread Lgm_ProfileThread *Lgm_ProfileMine = NULL;
+
+
+static long long Lgm_ProfileClock( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( 1000000000LL*(long long)ts.tv_sec + (long long)ts.tv_nsec );
+}
+
+
+static void Lgm_ProfileAtExit( void ) {
+
+    char    *Path = getenv( "LGM_PROFILE_FILE" );
+    FILE    *fp = NULL;
+
+    if ( ( Lgm_ProfileOn <= 0 ) || ( Lgm_ProfileOn == LGM_PROFILE_QUIET ) ) return;
+    if ( Path != NULL ) fp = fopen( Path, "w" );
+    Lgm_ProfileReport( ( fp != NULL ) ? fp : stderr, Lgm_ProfileOn );
+    if ( fp != NULL ) fclose( fp );
+
+}
+
+
+static void Lgm_ProfileNamesInit( void ) {
+
+    int     i;
+
+    if ( Lgm_ProfileNRegions > 0 ) return;
+    for ( i=0; i<LGM_PROF_NBUILTIN; i++ ) Lgm_ProfileNames[i] = (char *)Lgm_ProfileBuiltin[i];
+    Lgm_ProfileNRegions = LGM_PROF_NBUILTIN;
+
+}
+
+
+/**
+ *  Look at LGM_PROFILE (once) and set Lgm_ProfileOn. If profiling is on, the
+ *  report is printed at exit. Returns Lgm_ProfileOn. Called by the first
+ *  LGM_PROFILE_BEGIN(), so there is normally no need to call it.
+ */
+int Lgm_ProfileInit( void ) {
+
+    char    *Env;
+    int     Mode;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        if ( Lgm_ProfileOn < 0 ) {
+            Env  = getenv( "LGM_PROFILE" );
+            Mode = FALSE;
+            if ( ( Env != NULL ) && ( Env[0] != '\0' ) && strcmp( Env, "0" ) ) {
+                Mode = strcmp( Env, "json" ) ? LGM_PROFILE_TEXT : LGM_PROFILE_JSON;
+            }
+            Lgm_ProfileNamesInit();
+            if ( Mode ) atexit( Lgm_ProfileAtExit );
+            Lgm_ProfileOn = Mode;
+        }
+    }
+
+    return( Lgm_ProfileOn );
+
+}
+
+
+/**
+ *  Turn profiling on (LGM_PROFILE_TEXT or LGM_PROFILE_JSON, the format of the
+ *  report made at exit, or LGM_PROFILE_QUIET for no report) or off (0) from
+ *  code, whatever LGM_PROFILE says. Dont call it while regions are open.
+ */
+void Lgm_ProfileEnable( int Mode ) {
+
+    int     First;
+
+    Lgm_ProfileInit();
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        First = ( Lgm_ProfileOn == 0 ) && Mode;
+        Lgm_ProfileOn = Mode;
+    }
+    if ( First ) atexit( Lgm_ProfileAtExit );
+
+}
+
+
+/**
+ *  Region number for Name (a new one if Name hasnt been seen before), for
+ *  use with LGM_PROFILE_BEGIN()/LGM_PROFILE_END(). Returns -1 if there are
+ *  already LGM_PROF_MAXREGIONS regions; such a region is not recorded.
+ */
+int Lgm_ProfileRegion( const char *Name ) {
+
+    int     i, r = -1;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        Lgm_ProfileNamesInit();
+        for ( i=0; i<Lgm_ProfileNRegions; i++ ) {
+            if ( !strcmp( Lgm_ProfileNames[i], Name ) ) { r = i; break; }
+        }
+        if ( ( r < 0 ) && ( Lgm_ProfileNRegions < LGM_PROF_MAXREGIONS ) ) {
+            r = Lgm_ProfileNRegions;
+            Lgm_ProfileNames[r] = strdup( Name );
+            ++Lgm_ProfileNRegions;
+        }
+    }
+
+    return( r );
+
+}
+
+
+static Lgm_ProfileThread *Lgm_ProfileThisThread( void ) {
+
+    Lgm_ProfileThread   *p;
+
+    if ( Lgm_ProfileMine != NULL ) return( Lgm_ProfileMine );
+
+    if ( (p = (Lgm_ProfileThread *)calloc( 1, sizeof(Lgm_ProfileThread) )) == NULL ) return( NULL );
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        p->Next = Lgm_ProfileThreads;
+        Lgm_ProfileThreads = p;
+    }
+    Lgm_ProfileMine = p;
+
+    return( p );
+
+}
+
+
+/**
+ *  Enter a region. Use LGM_PROFILE_BEGIN() rather than calling this.
+ */
+void Lgm_ProfileBegin( int Region ) {
+
+    Lgm_ProfileThread   *p;
+    int                 i, Parent, Node = -1;
+
+    if ( ( Lgm_ProfileOn < 0 ) && !Lgm_ProfileInit() ) return;
+    if ( !Lgm_ProfileOn || ( (p = Lgm_ProfileThisThread()) == NULL ) ) return;
+    if ( p->Depth >= LGM_PROF_MAXDEPTH ) { ++p->Depth; return; }
+
+    Parent = ( p->Depth > 0 ) ? p->Stack[p->Depth-1] : -1;
+    if ( ( Region >= 0 ) && ( ( p->Depth == 0 ) || ( Parent >= 0 ) ) ) {
+        for ( i=p->nNodes-1; i>=0; i-- ) {
+            if ( ( p->Nodes[i].Region == Region ) && ( p->Nodes[i].Parent == Parent ) ) { Node = i; break; }
+        }
+        if ( ( Node < 0 ) && ( p->nNodes < LGM_PROF_MAXNODES ) ) {
+            Node = p->nNodes++;
+            p->Nodes[Node].Region = Region;
+            p->Nodes[Node].Parent = Parent;
+            p->Nodes[Node].n      = 0;
+            p->Nodes[Node].t      = 0;
+        }
+    }
+
+    p->Stack[p->Depth] = Node;
+    p->Start[p->Depth] = Lgm_ProfileClock();
+    ++p->Depth;
+
+}
+
+
+/**
+ *  Leave a region. Use LGM_PROFILE_END() rather than calling this.
+ */
+void Lgm_ProfileEnd( int Region ) {
+
+    Lgm_ProfileThread   *p = Lgm_ProfileMine;
+    int                 Node;
+
+    if ( ( p == NULL ) || ( p->Depth <= 0 ) ) return;
+    --p->Depth;
+    if ( p->Depth >= LGM_PROF_MAXDEPTH ) return;
+
+    Node = p->Stack[p->Depth];
+    if ( Node >= 0 ) {
+        ++p->Nodes[Node].n;
+        p->Nodes[Node].t += Lgm_ProfileClock() - p->Start[p->Depth];
+    }
+
+}
+
+
+/*
+ *  The merged tree. Children of a node are in the order they were merged.
+ */
+typedef struct Lgm_ProfileMerged {
+    int         nNodes;
+    Lgm_ProfileNode Nodes[LGM_PROF_MAXNODES];
+    int         nThreads;
+} Lgm_ProfileMerged;
+
+static void Lgm_ProfileMerge( Lgm_ProfileMerged *m ) {
+
+    Lgm_ProfileThread   *p;
+    int                 i, j, Parent, Map[LGM_PROF_MAXNODES];
+
+    memset( m, 0, sizeof(*m) );
+    for ( p = Lgm_ProfileThreads; p != NULL; p = p->Next ) {
+        ++m->nThreads;
+        // a node is always added after its parent, so the parents are mapped first
+        for ( i=0; i<p->nNodes; i++ ) {
+            Parent = ( p->Nodes[i].Parent >= 0 ) ? Map[p->Nodes[i].Parent] : -1;
+            Map[i] = -1;
+            if ( ( p->Nodes[i].Parent >= 0 ) && ( Parent < 0 ) ) continue;
+            for ( j=0; j<m->nNodes; j++ ) {
+                if ( ( m->Nodes[j].Region == p->Nodes[i].Region ) && ( m->Nodes[j].Parent == Parent ) ) break;
+            }
+            if ( j == m->nNodes ) {
+                if ( m->nNodes >= LGM_PROF_MAXNODES ) continue;
+                m->Nodes[j].Region = p->Nodes[i].Region;
+                m->Nodes[j].Parent = Parent;
+                ++m->nNodes;
+            }
+            m->Nodes[j].n += p->Nodes[i].n;
+            m->Nodes[j].t += p->Nodes[i].t;
+            Map[i] = j;
+        }
+    }
+
+}
+
+static long long Lgm_ProfileSelf( Lgm_ProfileMerged *m, int k ) {
+
+    int         j;
+    long long   t = m->Nodes[k].t;
+
+    for ( j=k+1; j<m->nNodes; j++ ) if ( m->Nodes[j].Parent == k ) t -= m->Nodes[j].t;
+
+    return( t );
+
+}
+
+static void Lgm_ProfilePrintText( FILE *fp, Lgm_ProfileMerged *m, int Parent, int Depth ) {
+
+    int     k;
+    double  t;
+
+    for ( k=0; k<m->nNodes; k++ ) {
+        if ( m->Nodes[k].Parent != Parent ) continue;
+        t = 1e-9*(double)m->Nodes[k].t;
+        fprintf( fp, "    %*s%-*s %12ld %14.6f %14.6f %12.3f\n", 2*Depth, "", 28-2*Depth, Lgm_ProfileNames[m->Nodes[k].Region],
+                 m->Nodes[k].n, t, 1e-9*(double)Lgm_ProfileSelf( m, k ), ( m->Nodes[k].n > 0 ) ? 1e6*t/(double)m->Nodes[k].n : 0.0 );
+        if ( Depth < LGM_PROF_MAXDEPTH ) Lgm_ProfilePrintText( fp, m, k, Depth+1 );
+    }
+
+}
+
+static void Lgm_ProfilePrintJson( FILE *fp, Lgm_ProfileMerged *m, int Parent, int Depth ) {
+
+    int     k, First = TRUE;
+
+    fprintf( fp, "[" );
+    for ( k=0; k<m->nNodes; k++ ) {
+        if ( m->Nodes[k].Parent != Parent ) continue;
+        fprintf( fp, "%s\n%*s{ \"Region\": \"%s\", \"Calls\": %ld, \"Total_s\": %.9f, \"Self_s\": %.9f, \"Children\": ",
+                 First ? "" : ",", 2*Depth+2, "", Lgm_ProfileNames[m->Nodes[k].Region], m->Nodes[k].n,
+                 1e-9*(double)m->Nodes[k].t, 1e-9*(double)Lgm_ProfileSelf( m, k ) );
+        if ( Depth < LGM_PROF_MAXDEPTH ) Lgm_ProfilePrintJson( fp, m, k, Depth+1 ); else fprintf( fp, "[]" );
+        fprintf( fp, " }" );
+        First = FALSE;
+    }
+    if ( First ) fprintf( fp, "]" ); else fprintf( fp, "\n%*s]", 2*Depth, "" );
+
+}
+
+
+/**
+ *  Print the merged totals of all threads as a tree (Mode LGM_PROFILE_TEXT)
+ *  or as JSON (LGM_PROFILE_JSON), e.g. at the end of a run. Call it when no
+ *  other thread is inside a region.
+ */
+void Lgm_ProfileReport( FILE *fp, int Mode ) {
+
+    Lgm_ProfileMerged   *m;
+
+    if ( (m = (Lgm_ProfileMerged *)malloc( sizeof(Lgm_ProfileMerged) )) == NULL ) return;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        Lgm_ProfileMerge( m );
+    }
+
+    if ( Mode == LGM_PROFILE_JSON ) {
+        fprintf( fp, "{ \"Threads\": %d, \"Regions\": ", m->nThreads );
+        Lgm_ProfilePrintJson( fp, m, -1, 0 );
+        fprintf( fp, " }\n" );
+    } else {
+        fprintf( fp, "Lgm profile (times summed over %d thread%s):\n", m->nThreads, ( m->nThreads == 1 ) ? "" : "s" );
+        fprintf( fp, "    %-28s %12s %14s %14s %12s\n", "Region", "Calls", "Total (s)", "Self (s)", "Avg (us)" );
+        Lgm_ProfilePrintText( fp, m, -1, 0 );
+    }
+    fflush( fp );
+
+    free( m );
+
+}
+
+
+/**
+ *  Zero all of the totals (the regions stay registered). Call it when no
+ *  thread is inside a region.
+ */
+void Lgm_ProfileReset( void ) {
+
+    Lgm_ProfileThread   *p;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        for ( p = Lgm_ProfileThreads; p != NULL; p = p->Next ) {
+            p->nNodes = 0;
+            p->Depth  = 0;
+        }
+    }
+
+}
+
+
+
+/**
+ *  Total number of times Region was entered, over all threads and all the
+ *  paths it was reached by, and (if Seconds isnt NULL) the total time spent
+ *  in it. Time inside a region nested in itself is only counted once. Like
+ *  Lgm_ProfileReport(), call it when no other thread is inside a region.
+ */
+long int Lgm_ProfileCalls( int Region, double *Seconds ) {
+
+    Lgm_ProfileMerged   *m;
+    int                 k, j;
+    long int            n = 0;
+    long long           t = 0;
+
+    if ( (m = (Lgm_ProfileMerged *)malloc( sizeof(Lgm_ProfileMerged) )) == NULL ) return( 0 );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_Profile)
+#endif
+    {
+        Lgm_ProfileMerge( m );
+    }
+
+    for ( k=0; k<m->nNodes; k++ ) {
+        if ( m->Nodes[k].Region != Region ) continue;
+        n += m->Nodes[k].n;
+        for ( j=m->Nodes[k].Parent; ( j >= 0 ) && ( m->Nodes[j].Region != Region ); j=m->Nodes[j].Parent );
+        if ( j < 0 ) t += m->Nodes[k].t;
+    }
+    if ( Seconds != NULL ) *Seconds = 1e-9*(double)t;
+
+    free( m );
+
+    return( n );
+
+}
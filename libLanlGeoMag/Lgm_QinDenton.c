@@ -16,22 +16,18 @@
 #endif
 
 #include <stdio.h>
-#include <sys/stat.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_DynamicMemory.h"
 #include "Lgm/Lgm_QinDenton.h"
 
 
-#define NMAX    (3*1440)
+#define NMAX    LGM_QINDENTON_NMAX
 
 
-#ifndef LGM_INDEX_DATA_DIR
-#warning "hard-coding LGM_INDEX_DATA_DIR because it was not in config.h"
-#define LGM_INDEX_DATA_DIR    /usr/local/share/LanlGeoMag/Data
-#endif
 
 Lgm_QinDenton *Lgm_init_QinDenton( int Verbose ) {
   // call this from C, never from Python
@@ -43,124 +39,81 @@ Lgm_QinDenton *Lgm_init_QinDenton( int Verbose ) {
 
 void Lgm_init_QinDentonDefaults( Lgm_QinDenton *q, int Verbose ) {
   // call this from C or Python
+
+    /*
+     *  The arrays all come from one arena (about 370 bytes per record, plus
+     *  a little for alignment), so setting one of these up (or tearing it
+     *  down) is a couple of mallocs rather than ~50.
+     */
+    q->Arena = Lgm_CreateArena( (size_t)NMAX*384 + 64*LGM_ARENA_ALIGN );
+    if ( q->Arena == NULL ) {
+        fprintf( stderr, "Lgm_init_QinDentonDefaults: Could not allocate space for the arrays\n" );
+        exit(1);
+    }
     q->Verbosity = Verbose;
-    LGM_ARRAY_1D( q->Date,          NMAX, long int );
-    LGM_ARRAY_1D( q->MJD,           NMAX, double );
-
-    LGM_ARRAY_2D( q->IsoTimeStr,    NMAX, 80, char );
-
-    LGM_ARRAY_1D( q->Year,          NMAX, int );
-    LGM_ARRAY_1D( q->Month,         NMAX, int );
-    LGM_ARRAY_1D( q->Day,           NMAX, int );
-    LGM_ARRAY_1D( q->Hour,          NMAX, int );
-    LGM_ARRAY_1D( q->Minute,        NMAX, int );
-    LGM_ARRAY_1D( q->Second,        NMAX, int );
-
-    LGM_ARRAY_1D( q->ByIMF,         NMAX, double );
-    LGM_ARRAY_1D( q->BzIMF,         NMAX, double );
-    LGM_ARRAY_1D( q->V_SW,          NMAX, double );
-    LGM_ARRAY_1D( q->Den_P,         NMAX, double );
-    LGM_ARRAY_1D( q->Pdyn,          NMAX, double );
-
-    LGM_ARRAY_1D( q->G1,            NMAX, double );
-    LGM_ARRAY_1D( q->G2,            NMAX, double );
-    LGM_ARRAY_1D( q->G3,            NMAX, double );
-
-    LGM_ARRAY_1D( q->ByIMF_status,  NMAX, int );
-    LGM_ARRAY_1D( q->BzIMF_status,  NMAX, int );
-    LGM_ARRAY_1D( q->V_SW_status,   NMAX, int );
-    LGM_ARRAY_1D( q->Den_P_status,  NMAX, int );
-    LGM_ARRAY_1D( q->Pdyn_status,   NMAX, int );
-
-    LGM_ARRAY_1D( q->G1_status,     NMAX, int );
-    LGM_ARRAY_1D( q->G2_status,     NMAX, int );
-    LGM_ARRAY_1D( q->G3_status,     NMAX, int );
-
-    LGM_ARRAY_1D( q->fKp,           NMAX, double );
-    LGM_ARRAY_1D( q->akp3,          NMAX, double );
-    LGM_ARRAY_1D( q->Dst,           NMAX, double );
-
-    LGM_ARRAY_1D( q->Bz1,           NMAX, double );
-    LGM_ARRAY_1D( q->Bz2,           NMAX, double );
-    LGM_ARRAY_1D( q->Bz3,           NMAX, double );
-    LGM_ARRAY_1D( q->Bz4,           NMAX, double );
-    LGM_ARRAY_1D( q->Bz5,           NMAX, double );
-    LGM_ARRAY_1D( q->Bz6,           NMAX, double );
-
-    LGM_ARRAY_1D( q->W1,            NMAX, double );
-    LGM_ARRAY_1D( q->W2,            NMAX, double );
-    LGM_ARRAY_1D( q->W3,            NMAX, double );
-    LGM_ARRAY_1D( q->W4,            NMAX, double );
-    LGM_ARRAY_1D( q->W5,            NMAX, double );
-    LGM_ARRAY_1D( q->W6,            NMAX, double );
-
-    LGM_ARRAY_1D( q->W1_status,     NMAX, int );
-    LGM_ARRAY_1D( q->W2_status,     NMAX, int );
-    LGM_ARRAY_1D( q->W3_status,     NMAX, int );
-    LGM_ARRAY_1D( q->W4_status,     NMAX, int );
-    LGM_ARRAY_1D( q->W5_status,     NMAX, int );
-    LGM_ARRAY_1D( q->W6_status,     NMAX, int );
+    LGM_ARRAY_1D_ARENA( q->Date,          NMAX, long int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->MJD,           NMAX, double, q->Arena );
+
+    LGM_ARRAY_2D_ARENA( q->IsoTimeStr,    NMAX, 80, char, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->Year,          NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Month,         NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Day,           NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Hour,          NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Minute,        NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Second,        NMAX, int, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->ByIMF,         NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->BzIMF,         NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->V_SW,          NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Den_P,         NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Pdyn,          NMAX, double, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->G1,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->G2,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->G3,            NMAX, double, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->ByIMF_status,  NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->BzIMF_status,  NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->V_SW_status,   NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Den_P_status,  NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Pdyn_status,   NMAX, int, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->G1_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->G2_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->G3_status,     NMAX, int, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->fKp,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->akp3,          NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Dst,           NMAX, double, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->Bz1,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Bz2,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Bz3,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Bz4,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Bz5,           NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->Bz6,           NMAX, double, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->W1,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W2,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W3,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W4,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W5,            NMAX, double, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W6,            NMAX, double, q->Arena );
+
+    LGM_ARRAY_1D_ARENA( q->W1_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W2_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W3_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W4_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W5_status,     NMAX, int, q->Arena );
+    LGM_ARRAY_1D_ARENA( q->W6_status,     NMAX, int, q->Arena );
 }
 
 void  Lgm_destroy_QinDenton_children( Lgm_QinDenton *q ) {
   // call this from Python, probably not C
-    // first free arrays inside structure
-    LGM_ARRAY_1D_FREE( q->Date );
-    LGM_ARRAY_1D_FREE( q->MJD );
-
-    LGM_ARRAY_2D_FREE( q->IsoTimeStr );
-
-    LGM_ARRAY_1D_FREE( q->Year );
-    LGM_ARRAY_1D_FREE( q->Month );
-    LGM_ARRAY_1D_FREE( q->Day );
-    LGM_ARRAY_1D_FREE( q->Hour );
-    LGM_ARRAY_1D_FREE( q->Minute );
-    LGM_ARRAY_1D_FREE( q->Second );
-
-    LGM_ARRAY_1D_FREE( q->ByIMF );
-    LGM_ARRAY_1D_FREE( q->BzIMF );
-    LGM_ARRAY_1D_FREE( q->V_SW );
-    LGM_ARRAY_1D_FREE( q->Den_P );
-    LGM_ARRAY_1D_FREE( q->Pdyn );
-
-    LGM_ARRAY_1D_FREE( q->G1 );
-    LGM_ARRAY_1D_FREE( q->G2 );
-    LGM_ARRAY_1D_FREE( q->G3 );
-
-    LGM_ARRAY_1D_FREE( q->ByIMF_status );
-    LGM_ARRAY_1D_FREE( q->BzIMF_status );
-    LGM_ARRAY_1D_FREE( q->V_SW_status );
-    LGM_ARRAY_1D_FREE( q->Den_P_status );
-    LGM_ARRAY_1D_FREE( q->Pdyn_status );
-
-    LGM_ARRAY_1D_FREE( q->G1_status );
-    LGM_ARRAY_1D_FREE( q->G2_status );
-    LGM_ARRAY_1D_FREE( q->G3_status );
-
-    LGM_ARRAY_1D_FREE( q->fKp );
-    LGM_ARRAY_1D_FREE( q->akp3 );
-    LGM_ARRAY_1D_FREE( q->Dst );
-
-    LGM_ARRAY_1D_FREE( q->Bz1 );
-    LGM_ARRAY_1D_FREE( q->Bz2 );
-    LGM_ARRAY_1D_FREE( q->Bz3 );
-    LGM_ARRAY_1D_FREE( q->Bz4 );
-    LGM_ARRAY_1D_FREE( q->Bz5 );
-    LGM_ARRAY_1D_FREE( q->Bz6 );
-
-    LGM_ARRAY_1D_FREE( q->W1 );
-    LGM_ARRAY_1D_FREE( q->W2 );
-    LGM_ARRAY_1D_FREE( q->W3 );
-    LGM_ARRAY_1D_FREE( q->W4 );
-    LGM_ARRAY_1D_FREE( q->W5 );
-    LGM_ARRAY_1D_FREE( q->W6 );
-
-    LGM_ARRAY_1D_FREE( q->W1_status );
-    LGM_ARRAY_1D_FREE( q->W2_status );
-    LGM_ARRAY_1D_FREE( q->W3_status );
-    LGM_ARRAY_1D_FREE( q->W4_status );
-    LGM_ARRAY_1D_FREE( q->W5_status );
-    LGM_ARRAY_1D_FREE( q->W6_status );
+    // first free arrays inside structure (they all live in q->Arena)
+    Lgm_FreeArena( q->Arena );
+    q->Arena = NULL;
 
     return;
 
@@ -175,965 +128,364 @@ void  Lgm_destroy_QinDenton( Lgm_QinDenton *q ) {
 }
 
 
-void Lgm_read_QinDenton( long int Date, Lgm_QinDenton *q ) {
-
-    FILE        *fp;
-    double      Time, MJD, Prev_MJD, Next_MJD, Prev_UT, Next_UT;
-    long int    n, Prev_Date, Next_Date;
-    int         Year, Month, Day, Doy, j, done;
-    int         Prev_Year, Prev_Month, Prev_Day, Next_Year, Next_Month, Next_Day;
-    int         success1, success2, success3;
-    char        *Line, *Filename;
-    static char *ftype[] = {"1min", "1hr" };
-    char        *Path, QinDentonPath[2048];
-    Lgm_CTrans  *c = Lgm_init_ctrans(0);
-    char        IsoTimeStr[80];
-    int         nMatches, tYear, tMonth, tDay, tHour, tMinute, tSecond, ByIMF_status, BzIMF_status, V_SW_status, Den_P_status, Pdyn_status, G1_status;
-    int         G2_status, G3_status, W1_status, W2_status, W3_status, W4_status, W5_status, W6_status;
-    double      ByIMF, BzIMF, V_SW, Den_P, Pdyn, G1, G2, G3, fKp, akp3, Dst, Bz1, Bz2, Bz3, Bz4, Bz5, Bz6, W1, W2, W3, W4, W5, W6, tTime, tMJD;
-
-
-    Path = getenv( "QIN_DENTON_PATH" );
-    if ( Path == NULL ) {
-        strcpy( QinDentonPath, LGM_INDEX_DATA_DIR );
-        strcat( QinDentonPath, "/QinDenton" );
-    } else {
-
-        /*
-         * Test for existence
-         */
-        struct stat sts;
-        if ( ( stat( Path, &sts ) ) == -1 ) {
-            strcpy( QinDentonPath, LGM_INDEX_DATA_DIR );
-            strcat( QinDentonPath, "/QinDenton" );
-            printf("Environment variable QIN_DENTON_PATH points to a non-existent directory: %s. Setting QinDentonPath to: %s \n", Path, QinDentonPath );
-        } else {
-            strcpy( QinDentonPath, Path );
-        }
-    }
-
-
-    
-
-    Lgm_Doy( Date, &Year, &Month, &Day, &Doy);
-    MJD = Lgm_MJD( Year, Month, Day, 12.0, LGM_TIME_SYS_UTC, c );
-
-
-    Prev_MJD = MJD-1.0;
-    Lgm_mjd_to_ymdh( Prev_MJD, &Prev_Date, &Prev_Year, &Prev_Month, &Prev_Day, &Prev_UT );
-
-    Next_MJD = MJD+1.0;
-    Lgm_mjd_to_ymdh( Next_MJD, &Next_Date, &Next_Year, &Next_Month, &Next_Day, &Next_UT );
-
-
-
-
-    Filename = (char *)calloc( 512, sizeof(char) );
-    Line = (char *)calloc( 2050, sizeof(char) );
-    n = 0;
-
-
-
-    // Read in Previous Date -- Try 1min first, 1hr next...
-    tTime = -1e30;
-    j = 0; done = FALSE; success1 = FALSE;
-    while ( !done ){
-
-        sprintf( Filename, "%s/%4d/QinDenton_%8ld_%s.txt", QinDentonPath, Prev_Year, Prev_Date, ftype[j] );
-        if ( (fp = fopen( Filename, "r" )) != NULL ) {
-            while( fgets( Line, 2048, fp ) != NULL ) {
-                if ( Line[0] != '#' ) {
-                    nMatches = sscanf( Line, "%s %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d",
-                                IsoTimeStr, &tYear, &tMonth, &tDay, &tHour, &tMinute, &tSecond, &ByIMF, &BzIMF, &V_SW, &Den_P, &Pdyn, &G1, &G2, &G3,
-                                &ByIMF_status, &BzIMF_status, &V_SW_status, &Den_P_status, &Pdyn_status, &G1_status, &G2_status, &G3_status,
-                                &fKp, &akp3, &Dst, &Bz1, &Bz2, &Bz3, &Bz4, &Bz5, &Bz6, &W1, &W2, &W3, &W4, &W5, &W6, &W1_status, &W2_status, &W3_status, &W4_status, &W5_status, &W6_status );
-
-
-                    if ( nMatches == 44 ) {
-
-                        tTime = tHour + tMinute/60.0 + tSecond/3600.0;
-                        tMJD = Lgm_MJD( tYear, tMonth, tDay, tTime, LGM_TIME_SYS_UTC, c );
-
-                        if ( (MJD > 33282.0) && ((n==0) || (MJD > q->MJD[n])) ) {  // make sure MJD > Jan 1, 1950 and time is increasing
-
-                            strcpy( q->IsoTimeStr[n], IsoTimeStr );
-                            q->Year[n]   = tYear;
-                            q->Month[n]  = tMonth;
-                            q->Day[n]    = tDay;
-                            q->Hour[n]   = tHour;
-                            q->Minute[n] = tMinute;
-                            q->Second[n] = tSecond;
-                            q->ByIMF[n]  = ByIMF;
-                            q->BzIMF[n]  = BzIMF;
-                            q->V_SW[n]   = V_SW;
-                            q->Den_P[n]  = Den_P;
-                            q->Pdyn[n]   = Pdyn;
-                            q->G1[n]     = G1;
-                            q->G2[n]     = G2;
-                            q->G3[n]     = G3;
-                            q->ByIMF_status[n] = ByIMF_status;
-                            q->BzIMF_status[n] = BzIMF_status;
-                            q->V_SW_status[n]  = V_SW_status;
-                            q->Den_P_status[n] = Den_P_status;
-                            q->Pdyn_status[n]  = Pdyn_status;
-                            q->G1_status[n]    = G1_status;
-                            q->G2_status[n]    = G2_status;
-                            q->G3_status[n]    = G3_status;
-                            q->fKp[n]  = fKp;
-                            q->akp3[n] = akp3;
-                            q->Dst[n]  = Dst;
-                            q->Bz1[n]  = Bz1;
-                            q->Bz2[n]  = Bz2;
-                            q->Bz3[n]  = Bz3;
-                            q->Bz4[n]  = Bz4;
-                            q->Bz5[n]  = Bz5;
-                            q->Bz6[n]  = Bz6;
-                            q->W1[n]   = W1;
-                            q->W2[n]   = W2;
-                            q->W3[n]   = W3;
-                            q->W4[n]   = W4;
-                            q->W5[n]   = W5;
-                            q->W6[n]   = W6;
-                            q->W1_status[n] = W1_status;
-                            q->W2_status[n] = W2_status;
-                            q->W3_status[n] = W3_status;
-                            q->W4_status[n] = W4_status;
-                            q->W5_status[n] = W5_status;
-                            q->W6_status[n] = W6_status;
-
-                            q->MJD[n] = tMJD;
-                            ++n;
-
-                        } else {
-                            printf( "Warning. Times may be corrupted in QinDenton File: %s   Time = %g  MJD = %g\n", Filename, tTime, tMJD );
-                        }
-                    }
-                }
-            }
-            fclose( fp );
-            done = TRUE;
-            success1 = TRUE;
-        } else {
-            // only complain if this is our last try.
-            if (j==1) {
-                if ( Path == NULL ) { //i.e. QIN_DENTON_PATH environment variable not set.
-                    printf( "Cannot open %s file. Try setting QIN_DENTON_PATH environment variable to path containing QinDenton files.\n", Filename );
-                } else {
-                    printf( "Cannot open %s file.\n", Filename );
-                }
-            }
-        }
-
-        if (j == 1) {
-            done = TRUE;
-        } else {
-            ++j;
-        }
-
-    }
-
-
-    // Read in Current Date
-    j = 0; done = FALSE; success2 = FALSE;
-    while ( !done ){
-
-        sprintf( Filename, "%s/%4d/QinDenton_%8ld_%s.txt", QinDentonPath, Year, Date, ftype[j] );
-        if ( (fp = fopen( Filename, "r" )) != NULL ) {
-            while( fgets( Line, 2048, fp ) != NULL ) {
-                if ( Line[0] != '#' ) {
-
-
-                    nMatches = sscanf( Line, "%s %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d",
-                                IsoTimeStr, &tYear, &tMonth, &tDay, &tHour, &tMinute, &tSecond, &ByIMF, &BzIMF, &V_SW, &Den_P, &Pdyn, &G1, &G2, &G3,
-                                &ByIMF_status, &BzIMF_status, &V_SW_status, &Den_P_status, &Pdyn_status, &G1_status, &G2_status, &G3_status,
-                                &fKp, &akp3, &Dst, &Bz1, &Bz2, &Bz3, &Bz4, &Bz5, &Bz6, &W1, &W2, &W3, &W4, &W5, &W6, &W1_status, &W2_status, &W3_status, &W4_status, &W5_status, &W6_status );
-
-                    if ( nMatches == 44 ) {
-
-                        tTime = tHour + tMinute/60.0 + tSecond/3600.0;
-                        tMJD = Lgm_MJD( tYear, tMonth, tDay, tTime, LGM_TIME_SYS_UTC, c );
-
-                        if ( (MJD > 33282.0) && ((n==0) || (MJD > q->MJD[n])) ) {  // make sure MJD > Jan 1, 1950 and time is increasing
-                            strcpy( q->IsoTimeStr[n], IsoTimeStr );
-                            q->Year[n]   = tYear;
-                            q->Month[n]  = tMonth;
-                            q->Day[n]    = tDay;
-                            q->Hour[n]   = tHour;
-                            q->Minute[n] = tMinute;
-                            q->Second[n] = tSecond;
-                            q->ByIMF[n]  = ByIMF;
-                            q->BzIMF[n]  = BzIMF;
-                            q->V_SW[n]   = V_SW;
-                            q->Den_P[n]  = Den_P;
-                            q->Pdyn[n]   = Pdyn;
-                            q->G1[n]     = G1;
-                            q->G2[n]     = G2;
-                            q->G3[n]     = G3;
-                            q->ByIMF_status[n] = ByIMF_status;
-                            q->BzIMF_status[n] = BzIMF_status;
-                            q->V_SW_status[n]  = V_SW_status;
-                            q->Den_P_status[n] = Den_P_status;
-                            q->Pdyn_status[n]  = Pdyn_status;
-                            q->G1_status[n]    = G1_status;
-                            q->G2_status[n]    = G2_status;
-                            q->G3_status[n]    = G3_status;
-                            q->fKp[n]  = fKp;
-                            q->akp3[n] = akp3;
-                            q->Dst[n]  = Dst;
-                            q->Bz1[n]  = Bz1;
-                            q->Bz2[n]  = Bz2;
-                            q->Bz3[n]  = Bz3;
-                            q->Bz4[n]  = Bz4;
-                            q->Bz5[n]  = Bz5;
-                            q->Bz6[n]  = Bz6;
-                            q->W1[n]   = W1;
-                            q->W2[n]   = W2;
-                            q->W3[n]   = W3;
-                            q->W4[n]   = W4;
-                            q->W5[n]   = W5;
-                            q->W6[n]   = W6;
-                            q->W1_status[n] = W1_status;
-                            q->W2_status[n] = W2_status;
-                            q->W3_status[n] = W3_status;
-                            q->W4_status[n] = W4_status;
-                            q->W5_status[n] = W5_status;
-                            q->W6_status[n] = W6_status;
-
-                            q->MJD[n] = tMJD;
-                            ++n;
-
-                        } else {
-                            printf( "Warning. Times may be corrupted in QinDenton File: %s   Time = %g  MJD = %g\n", Filename, tTime, tMJD );
-                        }
-
-                    }
-
-                }
-            }
-            fclose( fp );
-            done = TRUE;
-            success2 = TRUE;
-        } else {
-            // only complain if this is our last try.
-            if ( Path == NULL ) { //i.e. QIN_DENTON_PATH environment variable not set.
-                printf( "Cannot open %s file. Try setting QIN_DENTON_PATH environment variable to path containing QinDenton files.\n", Filename );
-            } else {
-                printf( "Cannot open %s file.\n", Filename );
-            }
-        }
-
-        if (j == 1) {
-            done = TRUE;
-        } else {
-            ++j;
-        }
-
-    }
-
-
-
-    // Read in Next Date
-    j = 0; done = FALSE; success3 = FALSE;
-    while ( !done ){
-
-        sprintf( Filename, "%s/%4d/QinDenton_%8ld_%s.txt", QinDentonPath, Next_Year, Next_Date, ftype[j] );
-        if ( (fp = fopen( Filename, "r" )) != NULL ) {
-            while( fgets( Line, 2048, fp ) != NULL ) {
-                if ( Line[0] != '#' ) {
-                    nMatches = sscanf( Line, "%s %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d",
-                                IsoTimeStr, &tYear, &tMonth, &tDay, &tHour, &tMinute, &tSecond, &ByIMF, &BzIMF, &V_SW, &Den_P, &Pdyn, &G1, &G2, &G3,
-                                &ByIMF_status, &BzIMF_status, &V_SW_status, &Den_P_status, &Pdyn_status, &G1_status, &G2_status, &G3_status,
-                                &fKp, &akp3, &Dst, &Bz1, &Bz2, &Bz3, &Bz4, &Bz5, &Bz6, &W1, &W2, &W3, &W4, &W5, &W6, &W1_status, &W2_status, &W3_status, &W4_status, &W5_status, &W6_status );
-
-                    if ( nMatches == 44 ) {
-
-                        tTime = tHour + tMinute/60.0 + tSecond/3600.0;
-                        tMJD = Lgm_MJD( tYear, tMonth, tDay, tTime, LGM_TIME_SYS_UTC, c );
-
-                        if ( (MJD > 33282.0) && ((n==0) || (MJD > q->MJD[n])) ) {  // make sure MJD > Jan 1, 1950 and time is increasing
-                            strcpy( q->IsoTimeStr[n], IsoTimeStr );
-                            q->Year[n]   = tYear;
-                            q->Month[n]  = tMonth;
-                            q->Day[n]    = tDay;
-                            q->Hour[n]   = tHour;
-                            q->Minute[n] = tMinute;
-                            q->Second[n] = tSecond;
-                            q->ByIMF[n]  = ByIMF;
-                            q->BzIMF[n]  = BzIMF;
-                            q->V_SW[n]   = V_SW;
-                            q->Den_P[n]  = Den_P;
-                            q->Pdyn[n]   = Pdyn;
-                            q->G1[n]     = G1;
-                            q->G2[n]     = G2;
-                            q->G3[n]     = G3;
-                            q->ByIMF_status[n] = ByIMF_status;
-                            q->BzIMF_status[n] = BzIMF_status;
-                            q->V_SW_status[n]  = V_SW_status;
-                            q->Den_P_status[n] = Den_P_status;
-                            q->Pdyn_status[n]  = Pdyn_status;
-                            q->G1_status[n]    = G1_status;
-                            q->G2_status[n]    = G2_status;
-                            q->G3_status[n]    = G3_status;
-                            q->fKp[n]  = fKp;
-                            q->akp3[n] = akp3;
-                            q->Dst[n]  = Dst;
-                            q->Bz1[n]  = Bz1;
-                            q->Bz2[n]  = Bz2;
-                            q->Bz3[n]  = Bz3;
-                            q->Bz4[n]  = Bz4;
-                            q->Bz5[n]  = Bz5;
-                            q->Bz6[n]  = Bz6;
-                            q->W1[n]   = W1;
-                            q->W2[n]   = W2;
-                            q->W3[n]   = W3;
-                            q->W4[n]   = W4;
-                            q->W5[n]   = W5;
-                            q->W6[n]   = W6;
-                            q->W1_status[n] = W1_status;
-                            q->W2_status[n] = W2_status;
-                            q->W3_status[n] = W3_status;
-                            q->W4_status[n] = W4_status;
-                            q->W5_status[n] = W5_status;
-                            q->W6_status[n] = W6_status;
-
-                            q->MJD[n] = tMJD;
-                            ++n;
-
-                        } else {
-                            printf( "Warning. Times may be corrupted in QinDenton File: %s   Time = %g  MJD = %g\n", Filename, tTime, tMJD );
-                        }
-                    }
-                }
-            }
-            fclose( fp );
-            done = TRUE;
-            success3 = TRUE;
-        } else {
-            // only complain if this is our last try.
-            if ( Path == NULL ) { //i.e. QIN_DENTON_PATH environment variable not set.
-                printf( "Cannot open %s file. Try setting QIN_DENTON_PATH environment variable to path containing QinDenton files.\n", Filename );
-            } else {
-                printf( "Cannot open %s file.\n", Filename );
-            }
-        }
-
-        if (j == 1) {
-            done = TRUE;
-        } else {
-            ++j;
-        }
 
+/*
+ *  How each of the QinDenton parameters is interpolated. Only the points that
+ *  pass the Filter test are used; if there arent at least MinGood of them the
+ *  parameter is set to Default. Linear forces linear interpolation, otherwise
+ *  it is akima (linear if there are less than 5 good points).
+ */
+#define QD_ANY          0       // every point is good
+#define QD_OPEN         1       // Lo <  y <  Hi
+#define QD_CLOSED       2       // Lo <= y <= Hi
+#define QD_CLOSED_OPEN  3       // Lo <= y <  Hi
+#define QD_PDYN         4       // Den_P > 0.1 and Pdyn > 0
+
+typedef struct QD_Field {
+    const char  *Name;
+    size_t      Col;            // offset of the (double *) column in Lgm_QinDenton
+    size_t      Out;            // offset of the double in Lgm_QinDentonOne
+    int         Filter;
+    double      Lo, Hi;
+    int         MinGood;
+    int         Linear;
+    double      Default;
+} QD_Field;
+
+#define QD_FIELD( x, Filter, Lo, Hi, MinGood, Linear, Default ) \
+    { #x, offsetof( Lgm_QinDenton, x ), offsetof( Lgm_QinDentonOne, x ), Filter, Lo, Hi, MinGood, Linear, Default }
+
+static const QD_Field QD_Fields[] = {
+    QD_FIELD( ByIMF, QD_OPEN,       -100.0,   100.0, 3, 0, 0.0 ),
+    QD_FIELD( BzIMF, QD_OPEN,       -100.0,   100.0, 3, 0, 0.0 ),
+    QD_FIELD( V_SW,  QD_OPEN,        100.0,  2000.0, 3, 0, 400.0 ),
+    // We really should expect (or trust) densities less than about 0.2 cm^-3. And values less than 1 cm^-3 should be suspect....
+    QD_FIELD( Den_P, QD_OPEN,          0.1, HUGE_VAL, 2, 1, 1.0 ),
+    // Since Pdyn is based on Den_P, use Den_P as a filter on what's good.
+    QD_FIELD( Pdyn,  QD_PDYN,          0.0,     0.0, 2, 1, 2.3 ),
+    // dont yet have a good idea of what values are reasonable for the G's...
+    QD_FIELD( G1,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( G2,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( G3,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( fKp,   QD_CLOSED,        0.0,     9.0, 3, 0, 2.0 ),
+    QD_FIELD( akp3,  QD_CLOSED,        0.0,     9.0, 3, 0, 2.0 ),
+    QD_FIELD( Dst,   QD_CLOSED_OPEN, -2500.0,   500.0, 3, 0, 0.0 ),
+    // are the Bz's even used?
+    QD_FIELD( Bz1,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( Bz2,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( Bz3,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( Bz4,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( Bz5,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( Bz6,   QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W1,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W2,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W3,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W4,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W5,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 ),
+    QD_FIELD( W6,    QD_ANY,           0.0,     0.0, 3, 0, 0.0 )
+};
+#define QD_NFIELDS  ( (int)(sizeof(QD_Fields)/sizeof(QD_Field)) )
+
+#define QD_COLUMN( q, f )   ( *(double **)( (char *)(q) + (f)->Col ) )
+#define QD_OUT( p, f )      ( *(double *)( (char *)(p) + (f)->Out ) )
+
+static int QD_IsGood( const QD_Field *f, Lgm_QinDenton *q, int i ) {
+
+    double  y = QD_COLUMN( q, f )[i];
+
+    switch ( f->Filter ) {
+        case QD_OPEN:           return( (y > f->Lo) && (y < f->Hi) );
+        case QD_CLOSED:         return( (y >= f->Lo) && (y <= f->Hi) );
+        case QD_CLOSED_OPEN:    return( (y >= f->Lo) && (y < f->Hi) );
+        case QD_PDYN:           return( (q->Den_P[i] > 0.1) && (y > 0.0) );
+        default:                return( TRUE );
     }
 
+}
 
-    q->nPnts = n;
 
+/*
+ *  Values used when there is no data to interpolate (Wide is the set used
+ *  when the day has less than 2 points, the other is used when the time is
+ *  outside of the data).
+ */
+static void QD_SetDefaults( Lgm_QinDentonOne *p, int Wide ) {
+
+    double  Wdefaults[6] = {0.44, 0.42, 0.66, 0.48, 0.49, 0.91}; //Avg values at status flag 2 (Table 3, Qin et al.)
+    double  Gdefaults[3] = {6.0, 10.0, 60.0};
+
+    p->Dst   = -5.0;  // nT
+    p->fKp   =  2.0;  // dimensionless
+    p->V_SW  =  400.0;  // km/s
+    p->Den_P =    5.0;  // #/cm^-3
+    p->Pdyn  =    p->Den_P * 1e6 * LGM_PROTON_MASS * p->V_SW*p->V_SW*1e6 * 1e9;   // nPa
+    p->ByIMF =    Wide ? 5.0 : 2.0; // nT
+    p->BzIMF =    Wide ? -5.0 : -2.0; // nT
+    p->G1    =    Gdefaults[0]; // units?
+    p->G2    =    Gdefaults[1]; // units?
+    p->G3    =    Gdefaults[2]; // units?
+    p->akp3  =    2.0; // unitless
+    p->W1    =    Wdefaults[0]; // units?
+    p->W2    =    Wdefaults[1]; // units?
+    p->W3    =    Wdefaults[2]; // units?
+    p->W4    =    Wdefaults[3]; // units?
+    p->W5    =    Wdefaults[4]; // units?
+    p->W6    =    Wdefaults[5]; // units?
+    p->Bz1   =    0.0; // nT
+    p->Bz2   =    0.0; // nT
+    p->Bz3   =    0.0; // nT
+    p->Bz4   =    0.0; // nT
+    p->Bz5   =    0.0; // nT
+    p->Bz6   =    0.0; // nT
 
+}
 
 
+/*
+ *  Last values in q (for persistence).
+ */
+static void QD_SetLast( Lgm_QinDentonOne *p, Lgm_QinDenton *q ) {
 
+    int     i, k = q->nPnts-1;
 
-    free(Filename);
-    free(Line);
-    Lgm_free_ctrans( c );
+    for ( i=0; i<QD_NFIELDS; i++ ) QD_OUT( p, &QD_Fields[i] ) = QD_COLUMN( q, &QD_Fields[i] )[k];
 
 }
 
 
-void Lgm_get_QinDenton_at_JD( double JD, Lgm_QinDentonOne *p, int Verbose, int Persistence ) {
+/*
+ *  Interpolate all of the parameters to the times of the n points p[0..n-1]
+ *  (all inside q's time range, in increasing order). Each spline is built
+ *  once and evaluated at all n times.
+ */
+static void QD_Interpolate( Lgm_QinDenton *q, long int n, Lgm_QinDentonOne **p ) {
 
-    int                 t, nq, i, ny, nm, nd, nGood;
-    double              *x, *y, MJD, UTC;
+    int                 nq, i, j, nGood;
+    long int            k;
+    double              *x, *y, *col;
+    const QD_Field      *f;
     gsl_interp_accel    *acc;
     gsl_spline          *spline;
-    Lgm_QinDenton       *q = Lgm_init_QinDenton( Verbose );
-    int                 UsePersistence;
-    double              Wdefaults[10] = {0.44, 0.42, 0.66, 0.48, 0.49, 0.91}; //Avg values at status flag 2 (Table 3, Qin et al.)
-    double              Gdefaults[10] = {6.0, 10.0, 60.0};
-
-    UsePersistence = FALSE;
-    MJD = JD - 2400000.5;
-    p->JD    = JD;
-    p->MJD   = MJD;
-    p->Date  = Lgm_JD_to_Date( JD, &p->Year, &p->Month, &p->Day, &UTC );
-    p->UTC   = UTC;
-    Lgm_UT_to_HMS( UTC, &p->Hour, &p->Minute, &p->Second );
-    p->Persistence = Persistence;
-
-    Lgm_read_QinDenton( p->Date, q );
-    p->nPnts = q->nPnts;
-
-
-    if (q->nPnts < 2) {
-
-        printf("Not enough QinDenton values to interpolate\n");
-        p->Dst   =   -5.0;  // nT
-        p->fKp   =    2.0;  // dimensionless
-        p->V_SW  =  400.0;  // km/s
-        p->Den_P =    5.0;  // #/cm^-3
-        p->Pdyn  =    p->Den_P * 1e6 * LGM_PROTON_MASS * p->V_SW*p->V_SW*1e6 * 1e9;   // nPa
-        p->ByIMF =    5.0; // nT 
-        p->BzIMF =   -5.0; // nT 
-        p->G1    =    Gdefaults[0]; // units?
-        p->G2    =    Gdefaults[1]; // units?
-        p->G3    =    Gdefaults[2]; // units?
-        p->akp3  =    2.0; // unitless
-        p->W1    =    Wdefaults[0]; // units?
-        p->W2    =    Wdefaults[1]; // units?
-        p->W3    =    Wdefaults[2]; // units?
-        p->W4    =    Wdefaults[3]; // units?
-        p->W5    =    Wdefaults[4]; // units?
-        p->W6    =    Wdefaults[5]; // units?
-        p->Bz1   =    0.0; // nT
-        p->Bz2   =    0.0; // nT
-        p->Bz3   =    0.0; // nT
-        p->Bz4   =    0.0; // nT
-        p->Bz5   =    0.0; // nT
-        p->Bz6   =    0.0; // nT
-
-    } else if ( (MJD < q->MJD[0]) || (MJD > q->MJD[q->nPnts-1]) ){
-
-        if (p->Persistence == 1) {
-            UsePersistence = TRUE;
-            printf("No Qin Denton data in range -- using persistence. Data MJD range: [%lf, %lf], requested MJD: %lf\n", q->MJD[0], q->MJD[q->nPnts-1], MJD);
-            p->Dst   =    q->Dst[q->nPnts-1];  // km/s
-            p->fKp   =    q->fKp[q->nPnts-1];  // km/s
-            p->V_SW  =    q->V_SW[q->nPnts-1];  // km/s
-            p->Den_P =    q->Den_P[q->nPnts-1];  // #/cm^-3
-            p->Pdyn  =    q->Pdyn[q->nPnts-1];   // nPa
-            p->ByIMF =    q->ByIMF[q->nPnts-1]; // nT 
-            p->BzIMF =    q->BzIMF[q->nPnts-1]; // nT 
-            p->G1    =    q->G1[q->nPnts-1]; // units? what's a good nominal value here?
-            p->G2    =    q->G2[q->nPnts-1]; // units? what's a good nominal value here?
-            p->G3    =    q->G2[q->nPnts-1]; // units? what's a good nominal value here?
-            p->akp3  =    q->akp3[q->nPnts-1]; // unitless
-            p->W1    =    q->W1[q->nPnts-1]; // units? what's a good nominal value here?
-            p->W2    =    q->W2[q->nPnts-1]; // units? what's a good nominal value here?
-            p->W3    =    q->W3[q->nPnts-1]; // units? what's a good nominal value here?
-            p->W4    =    q->W4[q->nPnts-1]; // units? what's a good nominal value here?
-            p->W5    =    q->W5[q->nPnts-1]; // units? what's a good nominal value here?
-            p->W6    =    q->W6[q->nPnts-1]; // units? what's a good nominal value here?
-            p->Bz1   =    q->Bz1[q->nPnts-1]; // nT
-            p->Bz2   =    q->Bz2[q->nPnts-1]; // nT
-            p->Bz3   =    q->Bz3[q->nPnts-1]; // nT
-            p->Bz4   =    q->Bz4[q->nPnts-1]; // nT
-            p->Bz5   =    q->Bz5[q->nPnts-1]; // nT
-            p->Bz6   =    q->Bz6[q->nPnts-1]; // nT
-
-        } else {
-            printf("No Qin Denton data in range -- would require extrapolation. Setting defaults. Data MJD range: [%lf, %lf], requested MJD: %lf\n", q->MJD[0], q->MJD[q->nPnts-1], MJD);
-            p->Dst = -5.0;
-            p->fKp = 2.0;
-            p->V_SW  =  400.0;  // km/s
-            p->Den_P =    5.0;  // #/cm^-3
-            p->Pdyn  =    p->Den_P * 1e6 * LGM_PROTON_MASS * p->V_SW*p->V_SW*1e6 * 1e9;   // nPa
-            p->ByIMF =    2.0; // nT 
-            p->BzIMF =   -2.0; // nT 
-            p->G1    =    Gdefaults[0]; // units?
-            p->G2    =    Gdefaults[1]; // units?
-            p->G3    =    Gdefaults[2]; // units?
-            p->akp3  =    2.0; // unitless
-            p->W1    =    Wdefaults[0]; // units?
-            p->W2    =    Wdefaults[1]; // units?
-            p->W3    =    Wdefaults[2]; // units?
-            p->W4    =    Wdefaults[3]; // units?
-            p->W5    =    Wdefaults[4]; // units?
-            p->W6    =    Wdefaults[5]; // units?
-            p->Bz1   =    0.0; // nT
-            p->Bz2   =    0.0; // nT
-            p->Bz3   =    0.0; // nT
-            p->Bz4   =    0.0; // nT
-            p->Bz5   =    0.0; // nT
-            p->Bz6   =    0.0; // nT
-        }
-
-    } else {
-
-        nq = q->nPnts;
-        x  = (double *)calloc( nq, sizeof(double) );
-        y  = (double *)calloc( nq, sizeof(double) );
-
-        acc    = gsl_interp_accel_alloc( );
 
+    nq  = q->nPnts;
+    x   = (double *)calloc( nq, sizeof(double) );
+    y   = (double *)calloc( nq, sizeof(double) );
+    acc = gsl_interp_accel_alloc( );
 
+    for ( j=0; j<QD_NFIELDS; j++ ) {
 
-
-
-
-
-        // interpolate ByIMF
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->ByIMF[i] > -100.0) && (q->ByIMF[i] < 100.0) ) {
-                x[nGood] = q->MJD[i];
-                y[nGood] = q->ByIMF[i];
-                ++nGood;
-            }
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->ByIMF = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->ByIMF = 0.0;
-            printf("No Good Qin Denton data in range for ByIMF. Setting ByIMF to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->ByIMF, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate BzIMF
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->BzIMF[i] > -100.0) && (q->BzIMF[i] < 100.0) ) {
-                x[nGood] = q->MJD[i];
-                y[nGood] = q->BzIMF[i];
-                ++nGood;
-            }
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->BzIMF = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->BzIMF = 0.0;
-            printf("No Good Qin Denton data in range for BzIMF. Setting BzIMF to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->BzIMF, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate V_SW
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->V_SW[i] > 100.0) && (q->V_SW[i] < 2000.0) ) {
-                x[nGood] = q->MJD[i];
-                y[nGood] = q->V_SW[i];
-                ++nGood;
-            }
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->V_SW = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->V_SW = 400.0;
-            printf("No Good Qin Denton data in range for V_SW. Setting V_SW to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->V_SW, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-
-
-
-
-        /*
-         * Interpolate Den_P. We really should expect (or trust) densities less than about 0.2 cm^-3.
-         * And values less than 1 cm^-3 should be suspect....
-         */
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( q->Den_P[i] > 0.1 ) {
-                x[nGood] = q->MJD[i];
-                y[nGood] = q->Den_P[i];
-                ++nGood;
-            }
-        }
-        if ( nGood >= 2 ) {
-            spline = gsl_spline_alloc( gsl_interp_linear, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->Den_P = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free( spline );
-        } else {
-            p->Den_P = 1.0;
-            printf("No Good Qin Denton data in range for Den_P. Setting Den_P to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Den_P, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-
-
-
-        /*
-         * Interpolate Pdyn. Since Pdyn is basned one Den_P, use Den_P as a filter on what's good.
-         */
+        f   = &QD_Fields[j];
+        col = QD_COLUMN( q, f );
         for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->Den_P[i] > 0.1) && (q->Pdyn[i] > 0.0) ) {
+            if ( QD_IsGood( f, q, i ) ) {
                 x[nGood] = q->MJD[i];
-                y[nGood] = q->Pdyn[i];
+                y[nGood] = col[i];
                 ++nGood;
             }
         }
-        if ( nGood >= 2 ) {
-            spline = gsl_spline_alloc( gsl_interp_linear, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->Pdyn = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free( spline );
-        } else {
-            p->Pdyn = 2.3;
-            printf("No Good Qin Denton data in range for Pdyn. Setting Pdyn to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Pdyn, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
 
-
-
-
-
-        // interpolate G1 -- dont yet have a good idea of what values are reasonable here...
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->G1[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->G1 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->G1 = 0.0;
-            printf("No Good Qin Denton data in range for G1. Setting G1 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->G1, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate G2 -- dont yet have a good idea of what values are reasonable here...
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->G2[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->G2 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->G2 = 0.0;
-            printf("No Good Qin Denton data in range for G2. Setting G2 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->G2, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate G3 -- dont yet have a good idea of what values are reasonable here...
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->G3[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->G3 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->G3 = 0.0;
-            printf("No Good Qin Denton data in range for G3. Setting G3 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->G3, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-
-
-
-
-
-        // interpolate Kp
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->fKp[i] >= 0.0) && (q->fKp[i] <= 9.0)){
-                x[nGood] = q->MJD[i]; 
-                y[nGood] = q->fKp[i]; 
-                ++nGood;
-            }
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood ); 
-            p->fKp = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->fKp = 2.0;
-            printf("No Good Qin Denton data in range for fKp. Setting fKp to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->fKp, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate akp3
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->akp3[i] >= 0.0) && (q->akp3[i] <= 9.0)){
-                x[nGood] = q->MJD[i]; 
-                y[nGood] = q->akp3[i]; 
-                ++nGood;
-            }
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
+        if ( nGood >= f->MinGood ) {
+            spline = ( f->Linear || (nGood < 5) ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
             gsl_spline_init( spline, x, y, nGood );
-            p->akp3 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
+            gsl_interp_accel_reset( acc );
+            for ( k=0; k<n; k++ ) QD_OUT( p[k], f ) = gsl_spline_eval( spline, p[k]->MJD, acc );
+            gsl_spline_free( spline );
         } else {
-            p->akp3 = 2.0;
-            printf("No Good Qin Denton data in range for akp3. Setting akp3 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->akp3, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate Dst
-        for ( nGood=0, i=0; i<nq; i++ ){
-            if ( (q->Dst[i] >= -2500.0) && (q->Dst[i] < 500.0)){
-                x[nGood] = q->MJD[i]; 
-                y[nGood] = q->Dst[i]; 
-                ++nGood;
+            for ( k=0; k<n; k++ ) {
+                QD_OUT( p[k], f ) = f->Default;
+                printf("No Good Qin Denton data in range for %s. Setting %s to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n",
+                        f->Name, f->Name, f->Default, q->MJD[0], q->MJD[q->nPnts-1], p[k]->MJD);
             }
         }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Dst = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Dst = 0.0;
-            printf("No Good Qin Denton data in range for Dst. Setting Dst to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Dst, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
 
+    }
 
+    free( x );
+    free( y );
+    gsl_interp_accel_free( acc );
 
+}
 
 
+static void QD_Print( Lgm_QinDentonOne *p, int UsePersistence ) {
 
-        // interpolate Bz1 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz1[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz1 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz1 = 0.0;
-            printf("No Good Qin Denton data in range for Bz1. Setting Bz1 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz1, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+    printf("\n");
+    if (!UsePersistence) {
+        printf("\t\t         QinDenton Parameters\n");
+        printf("\t\t    --------------------------------\n");
+    } else {
+        printf("\t\t         QinDenton Parameters (Persistence)\n");
+        printf("\t\t    --------------------------------------------\n");
+    }
+    printf("\t\t        Date = %8ld\n", p->Date );
+    printf("\t\t          JD = %11.7lf\n", p->JD );
+    printf("\t\t         MJD = %11.7lf\n", p->MJD );
+    printf("\t\t         UTC = %11.7lf  ( ", p->UTC );     Lgm_Print_HMSd( p->UTC ); printf(" )\n");
+    printf("\t\t       ByIMF = %11.7g nT\n", p->ByIMF );
+    printf("\t\t       BzIMF = %11.7g nT\n", p->BzIMF );
+    printf("\t\t        V_SW = %11.7g km/s\n", p->V_SW );
+    printf("\t\t       Den_P = %11.7g #/cm^3\n", p->Den_P );
+    printf("\t\t        Pdyn = %11.7g nPa\n", p->Pdyn );
+    printf("\t\t          G1 = %11.7g\n", p->G1 );
+    printf("\t\t          G2 = %11.7g\n", p->G2 );
+    printf("\t\t          G3 = %11.7g\n", p->G3 );
+    printf("\t\t          Kp = %11.7g\n", p->fKp );
+    printf("\t\t        akp3 = %11.7g\n", p->akp3 );
+    printf("\t\t         Dst = %11.7g nT\n", p->Dst );
+    printf("\t\t         Bz1 = %11.7g nT\n", p->Bz1 );
+    printf("\t\t         Bz2 = %11.7g nT\n", p->Bz2 );
+    printf("\t\t         Bz3 = %11.7g nT\n", p->Bz3 );
+    printf("\t\t         Bz4 = %11.7g nT\n", p->Bz4 );
+    printf("\t\t         Bz5 = %11.7g nT\n", p->Bz5 );
+    printf("\t\t         Bz6 = %11.7g nT\n", p->Bz6 );
+    printf("\t\t          W1 = %11.7g\n", p->W1 );
+    printf("\t\t          W2 = %11.7g\n", p->W2 );
+    printf("\t\t          W3 = %11.7g\n", p->W3 );
+    printf("\t\t          W4 = %11.7g\n", p->W4 );
+    printf("\t\t          W5 = %11.7g\n", p->W5 );
+    printf("\t\t          W6 = %11.7g\n", p->W6 );
+    printf("\n");
 
-        // interpolate Bz2 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz2[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz2 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz2 = 0.0;
-            printf("No Good Qin Denton data in range for Bz2. Setting Bz2 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz2, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+}
 
-        // interpolate Bz3 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz3[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz3 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz3 = 0.0;
-            printf("No Good Qin Denton data in range for Bz3. Setting Bz3 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz3, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
 
-        // interpolate Bz4 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz4[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz4 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz4 = 0.0;
-            printf("No Good Qin Denton data in range for Bz4. Setting Bz4 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz4, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+static int QD_CompareByTime( const void *a, const void *b ) {
 
-        // interpolate Bz5 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz5[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz5 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz5 = 0.0;
-            printf("No Good Qin Denton data in range for Bz5. Setting Bz5 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz5, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+    const Lgm_QinDentonOne *pa = *(Lgm_QinDentonOne * const *)a;
+    const Lgm_QinDentonOne *pb = *(Lgm_QinDentonOne * const *)b;
 
-        // interpolate Bz6 -- are these even used?
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->Bz6[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->Bz6 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->Bz6 = 0.0;
-            printf("No Good Qin Denton data in range for Bz6. Setting Bz6 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->Bz6, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+    if ( pa->Date != pb->Date ) return( (pa->Date < pb->Date) ? -1 : 1 );
+    if ( pa->MJD  != pb->MJD  ) return( (pa->MJD  < pb->MJD ) ? -1 : 1 );
+    return( 0 );
 
+}
 
 
+void Lgm_get_QinDenton_at_JD( double JD, Lgm_QinDentonOne *p, int Verbose, int Persistence ) {
+    Lgm_get_QinDenton_at_JD_Array( 1, &JD, p, Verbose, Persistence );
+}
 
 
-        // interpolate W1
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W1[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W1 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W1 = 0.0;
-            printf("No Good Qin Denton data in range for W1. Setting W1 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W1, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+/**
+ *  \brief
+ *      QinDenton parameters at an array of times.
+ *
+ *  \details
+ *      Same as calling Lgm_get_QinDenton_at_JD() for each JD[i], but the
+ *      times are done a day at a time (in time order), so each day is read
+ *      (from the day cache) once and each parameter's spline is built once
+ *      per day rather than once per time. With 1-minute times this is what
+ *      makes a long run (or a python array lookup, see lgmpy.Lgm_QinDenton)
+ *      affordable. The JD's dont have to be sorted.
+ *
+ *      \param[in]      n               Number of times.
+ *      \param[in]      JD              Julian Dates.
+ *      \param[out]     p               n structures to fill.
+ *      \param[in]      Verbose         Verbosity (>0 prints the parameters for every time).
+ *      \param[in]      Persistence     If 1, times after the end of the data get the last values.
+ */
+void Lgm_get_QinDenton_at_JD_Array( long int n, double *JD, Lgm_QinDentonOne *p, int Verbose, int Persistence ) {
+
+    long int            k, k0, k1, nIn;
+    double              UTC;
+    Lgm_QinDentonOne    **s, **In;
+    Lgm_QinDenton       *q;
+    int                 *UsePersistence;
+
+    if ( n < 1 ) return;
+
+    s  = (Lgm_QinDentonOne **)calloc( 2*n, sizeof(Lgm_QinDentonOne *) );
+    In = s + n;
+    UsePersistence = (int *)calloc( n, sizeof(int) );
+    for ( k=0; k<n; k++ ) {
+        p[k].JD    = JD[k];
+        p[k].MJD   = JD[k] - 2400000.5;
+        p[k].Date  = Lgm_JD_to_Date( JD[k], &p[k].Year, &p[k].Month, &p[k].Day, &UTC );
+        p[k].UTC   = UTC;
+        Lgm_UT_to_HMS( UTC, &p[k].Hour, &p[k].Minute, &p[k].Second );
+        p[k].Persistence = Persistence;
+        s[k] = &p[k];
+    }
+    if ( n > 1 ) qsort( s, n, sizeof(Lgm_QinDentonOne *), QD_CompareByTime );
 
-        // interpolate W2
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W2[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W2 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W2 = 0.0;
-            printf("No Good Qin Denton data in range for W2. Setting W2 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W2, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+    q = Lgm_init_QinDenton( Verbose );
+    for ( k0=0; k0<n; k0=k1 ) {
 
-        // interpolate W3
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W3[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W3 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W3 = 0.0;
-            printf("No Good Qin Denton data in range for W3. Setting W3 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W3, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+        for ( k1=k0+1; (k1<n) && (s[k1]->Date == s[k0]->Date); k1++ );
 
-        // interpolate W4
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W4[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W4 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W4 = 0.0;
-            printf("No Good Qin Denton data in range for W4. Setting W4 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W4, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
+        Lgm_read_QinDenton( s[k0]->Date, q );
 
-        // interpolate W5
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W5[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W5 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W5 = 0.0;
-            printf("No Good Qin Denton data in range for W5. Setting W5 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W5, q->MJD[0], q->MJD[q->nPnts-1], MJD);
-        }
-
-        // interpolate W6
-        for ( nGood=0, i=0; i<nq; i++ ){
-            x[nGood] = q->MJD[i]; 
-            y[nGood] = q->W6[i]; 
-            ++nGood;
-        }
-        if ( nGood > 2 ) {
-            spline = ( nGood < 5 ) ? gsl_spline_alloc( gsl_interp_linear, nGood ) : gsl_spline_alloc( gsl_interp_akima, nGood );
-            gsl_spline_init( spline, x, y, nGood );
-            p->W6 = gsl_spline_eval( spline, MJD, acc );
-            gsl_spline_free (spline);
-        } else {
-            p->W6 = 0.0;
-            printf("No Good Qin Denton data in range for W6. Setting W6 to %g. Data MJD range: [%lf, %lf], requested MJD: %lf\n", p->W6, q->MJD[0], q->MJD[q->nPnts-1], MJD);
+        for ( nIn=0, k=k0; k<k1; k++ ) {
+            s[k]->nPnts = q->nPnts;
+            if ( q->nPnts < 2 ) {
+                printf("Not enough QinDenton values to interpolate\n");
+                QD_SetDefaults( s[k], TRUE );
+            } else if ( (s[k]->MJD < q->MJD[0]) || (s[k]->MJD > q->MJD[q->nPnts-1]) ) {
+                if ( Persistence == 1 ) {
+                    UsePersistence[ s[k] - p ] = TRUE;
+                    printf("No Qin Denton data in range -- using persistence. Data MJD range: [%lf, %lf], requested MJD: %lf\n", q->MJD[0], q->MJD[q->nPnts-1], s[k]->MJD);
+                    QD_SetLast( s[k], q );
+                } else {
+                    printf("No Qin Denton data in range -- would require extrapolation. Setting defaults. Data MJD range: [%lf, %lf], requested MJD: %lf\n", q->MJD[0], q->MJD[q->nPnts-1], s[k]->MJD);
+                    QD_SetDefaults( s[k], FALSE );
+                }
+            } else {
+                In[nIn++] = s[k];
+            }
         }
-
-
-
-        free(x);
-        free(y);
-        gsl_interp_accel_free (acc);
+        if ( nIn > 0 ) QD_Interpolate( q, nIn, In );
 
     }
 
     if ( q->Verbosity > 0 ) {
-        printf("\n");
-        if (!UsePersistence) {
-            printf("\t\t         QinDenton Parameters\n");
-            printf("\t\t    --------------------------------\n");
-        } else {
-            printf("\t\t         QinDenton Parameters (Persistence)\n");
-            printf("\t\t    --------------------------------------------\n");
-        }
-        printf("\t\t        Date = %8ld\n", p->Date );
-        printf("\t\t          JD = %11.7lf\n", p->JD );
-        printf("\t\t         MJD = %11.7lf\n", p->MJD );
-        printf("\t\t         UTC = %11.7lf  ( ", p->UTC );     Lgm_Print_HMSd( UTC ); printf(" )\n");
-        printf("\t\t       ByIMF = %11.7g nT\n", p->ByIMF );
-        printf("\t\t       BzIMF = %11.7g nT\n", p->BzIMF );
-        printf("\t\t        V_SW = %11.7g km/s\n", p->V_SW );
-        printf("\t\t       Den_P = %11.7g #/cm^3\n", p->Den_P );
-        printf("\t\t        Pdyn = %11.7g nPa\n", p->Pdyn );
-        printf("\t\t          G1 = %11.7g\n", p->G1 );
-        printf("\t\t          G2 = %11.7g\n", p->G2 );
-        printf("\t\t          G3 = %11.7g\n", p->G3 );
-        printf("\t\t          Kp = %11.7g\n", p->fKp );
-        printf("\t\t        akp3 = %11.7g\n", p->akp3 );
-        printf("\t\t         Dst = %11.7g nT\n", p->Dst );
-        printf("\t\t         Bz1 = %11.7g nT\n", p->Bz1 );
-        printf("\t\t         Bz2 = %11.7g nT\n", p->Bz2 );
-        printf("\t\t         Bz3 = %11.7g nT\n", p->Bz3 );
-        printf("\t\t         Bz4 = %11.7g nT\n", p->Bz4 );
-        printf("\t\t         Bz5 = %11.7g nT\n", p->Bz5 );
-        printf("\t\t         Bz6 = %11.7g nT\n", p->Bz6 );
-        printf("\t\t          W1 = %11.7g\n", p->W1 );
-        printf("\t\t          W2 = %11.7g\n", p->W2 );
-        printf("\t\t          W3 = %11.7g\n", p->W3 );
-        printf("\t\t          W4 = %11.7g\n", p->W4 );
-        printf("\t\t          W5 = %11.7g\n", p->W5 );
-        printf("\t\t          W6 = %11.7g\n", p->W6 );
-
-        printf("\n");
+        for ( k=0; k<n; k++ ) QD_Print( &p[k], UsePersistence[k] );
     }
 
+    Lgm_destroy_QinDenton( q );
+    free( UsePersistence );
+    free( s );
+
+}
 
+/*
+ *  Hash of the inputs in m that Bfield actually uses (e.g. just Kp for T89,
+ *  P, Dst, By and Bz for T96). The time is not included. Lgm_set_QinDenton()
+ *  keeps m->ParamsHash up to date with this, so caches built for one set of
+ *  inputs (e.g. a Lgm_GriddedField) can tell cheaply whether they are still
+ *  good. A grid gets the hash of the model it was made from. See
+ *  Lgm_ModelState.c.
+ */
+unsigned long Lgm_ModelParamsHash( int (*Bfield)(), Lgm_MagModelInfo *m ) {
 
+    if ( ( Bfield == Lgm_B_Gridded ) && ( m->Gridded != NULL ) ) Bfield = m->Gridded->Bsrc;
 
-    Lgm_destroy_QinDenton( q );
+    return( Lgm_ModelKey_Fold( Lgm_ModelState_Key( Bfield, LGM_MODELSTATE_INPUTS, m ) ) );
 
+}
 
+/*
+ *  Like Lgm_ModelParamsHash(), but the same in every process (and every
+ *  build of the library), so it can be used to key caches that are shared
+ *  between processes (see Lgm_ShmCache.c). Returns 0 for models that arent
+ *  known (e.g. user supplied ones), which means "dont share".
+ */
+unsigned long Lgm_ModelFingerprint( int (*Bfield)(), Lgm_MagModelInfo *m ) {
 
+    if ( ( Bfield == Lgm_B_Gridded ) && ( m->Gridded != NULL ) ) Bfield = m->Gridded->Bsrc;
+
+    return( Lgm_ModelKey_Fold( Lgm_ModelState_Key( Bfield, LGM_MODELSTATE_INPUTS | LGM_MODELSTATE_PORTABLE, m ) ) );
 
 }
 
+/*
+ *  Copy the inputs in p into m. m->ParamsGeneration is only bumped if the
+ *  inputs the current model uses actually changed (the 1-hour and 5-minute
+ *  values are often the same from one minute to the next).
+ */
 void Lgm_set_QinDenton( Lgm_QinDentonOne *p, Lgm_MagModelInfo *m ) {
+
+    unsigned long   h;
+
     m->Bx   = 0.0;
     m->By   = p->ByIMF;
     m->Bz   = p->BzIMF;
@@ -1153,5 +505,12 @@ void Lgm_set_QinDenton( Lgm_QinDentonOne *p, Lgm_MagModelInfo *m ) {
     m->W[3] = p->W4;
     m->W[4] = p->W5;
     m->W[5] = p->W6;
+
+    h = Lgm_ModelParamsHash( m->Bfield, m );
+    if ( h != m->ParamsHash ) {
+        m->ParamsHash = h;
+        ++m->ParamsGeneration;
+    }
+
 }
 
@@ -0,0 +1,918 @@
+/*! \file Lgm_QinDenton_Cache.c
+ *
+ *  \brief Process-wide day cache and packed binary archive of Qin-Denton values.
+ *
+ *  Lgm_read_QinDenton() needs the day before, the day of and the day after
+ *  the requested date. It used to open and sscanf() all three daily
+ *  QinDenton_YYYYMMDD_{1min,1hr}.txt files on every call, so anything that
+ *  evaluates the model inputs at many times (e.g. a MagEphem run at 1-minute
+ *  cadence, which calls Lgm_get_QinDenton_at_JD() for every time step) spent
+ *  most of its time re-parsing the same few files.
+ *
+ *  Here each day is read once and kept (as a Lgm_QinDenton holding just that
+ *  day) in an in-memory cache of the most recently used days, so
+ *  Lgm_read_QinDenton() reduces to copying three cached days into the
+ *  caller's structure. Days with no file are remembered as well, so the
+ *  "Cannot open" messages appear once per day rather than once per call. The
+ *  cache holds LGM_QD_CACHE_DAYS days by default (see
+ *  Lgm_QinDenton_SetCacheSize() and Lgm_QinDenton_LoadRange()), is shared by
+ *  all threads, and is emptied if QIN_DENTON_PATH changes. Call
+ *  Lgm_QinDenton_ClearCache() if the files themselves change during a run.
+ *  Days can also be loaded ahead of time, without holding up the threads
+ *  that are using the cache, with Lgm_QinDenton_PrefetchDay().
+ *
+ *  Days can also come from a packed binary archive, which removes the text
+ *  parsing altogether. Archive layout (native byte order, checked with a known
+ *  double in the header):
+ *
+ *      Lgm_QinDentonArchiveHeader
+ *      Records     nRecords Lgm_QinDentonArchiveRecord's, sorted by FileDate.
+ *
+ *  A day is found with a binary search on FileDate. Days between StartDate
+ *  and EndDate with no records had no file when the archive was built; days
+ *  outside that range are read from the text files as before. The archive is
+ *  memory-mapped once per process if one is found (see
+ *  Lgm_QinDenton_ArchiveFilename()), and is written by
+ *  Lgm_QinDenton_BuildArchive() (see also the PackQinDenton tool).
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+#include "Lgm/Lgm_QinDenton.h"
+
+
+#ifndef LGM_INDEX_DATA_DIR
+#warning "hard-coding LGM_INDEX_DATA_DIR because it was not in config.h"
+#define LGM_INDEX_DATA_DIR    /usr/local/share/LanlGeoMag/Data
+#endif
+
+
+
+/*
+ *  Columns of a Lgm_QinDenton and the matching fields of an archive record.
+ *  (IsoTimeStr is handled separately.)
+ */
+#define QD_COL( x )     { offsetof( Lgm_QinDenton, x ), offsetof( Lgm_QinDentonArchiveRecord, x ) }
+typedef struct QD_Column { size_t Col, Rec; } QD_Column;
+
+static const QD_Column QD_Doubles[] = {
+    QD_COL( MJD ),
+    QD_COL( ByIMF ), QD_COL( BzIMF ), QD_COL( V_SW ), QD_COL( Den_P ), QD_COL( Pdyn ),
+    QD_COL( G1 ), QD_COL( G2 ), QD_COL( G3 ),
+    QD_COL( fKp ), QD_COL( akp3 ), QD_COL( Dst ),
+    QD_COL( Bz1 ), QD_COL( Bz2 ), QD_COL( Bz3 ), QD_COL( Bz4 ), QD_COL( Bz5 ), QD_COL( Bz6 ),
+    QD_COL( W1 ), QD_COL( W2 ), QD_COL( W3 ), QD_COL( W4 ), QD_COL( W5 ), QD_COL( W6 )
+};
+
+static const QD_Column QD_Ints[] = {
+    QD_COL( Year ), QD_COL( Month ), QD_COL( Day ), QD_COL( Hour ), QD_COL( Minute ), QD_COL( Second ),
+    QD_COL( ByIMF_status ), QD_COL( BzIMF_status ), QD_COL( V_SW_status ), QD_COL( Den_P_status ), QD_COL( Pdyn_status ),
+    QD_COL( G1_status ), QD_COL( G2_status ), QD_COL( G3_status ),
+    QD_COL( W1_status ), QD_COL( W2_status ), QD_COL( W3_status ), QD_COL( W4_status ), QD_COL( W5_status ), QD_COL( W6_status )
+};
+
+#define QD_NDOUBLE          ( (int)(sizeof(QD_Doubles)/sizeof(QD_Column)) )
+#define QD_NINT             ( (int)(sizeof(QD_Ints)/sizeof(QD_Column)) )
+#define QD_DBL( q, j )      ( *(double **)((char *)(q) + QD_Doubles[j].Col) )
+#define QD_INT( q, j )      ( *(int **)((char *)(q) + QD_Ints[j].Col) )
+#define QD_RDBL( r, j )     ( *(const double *)((const char *)(r) + QD_Doubles[j].Rec) )
+#define QD_RINT( r, j )     ( *(const int32_t *)((const char *)(r) + QD_Ints[j].Rec) )
+
+
+
+/*
+ *  Day cache
+ */
+typedef struct QD_CacheDay {
+    long int        Date;           // YYYYMMDD (-1 for an unused slot)
+    unsigned long   LastUsed;
+    Lgm_QinDenton   *q;             // values for this day (NULL if there were none)
+    char            Source[2600];   // file (or archive) the values came from
+} QD_CacheDay;
+
+static QD_CacheDay  *QD_Cache       = NULL;
+static int           QD_nCache      = 0;
+static int           QD_CacheSize   = LGM_QD_CACHE_DAYS;
+static unsigned long QD_Clock       = 0;
+static char          QD_CachePath[2048] = "";
+
+static Lgm_QinDentonArchive *Lgm_QinDenton_SharedArchive = NULL;
+static int                   Lgm_QinDenton_SharedArchive_Tried = FALSE;
+
+
+
+/*
+ *  Allocate a Lgm_QinDenton with room for n values (it is freed with
+ *  Lgm_destroy_QinDenton()).
+ */
+static Lgm_QinDenton *QD_AllocDay( int n ) {
+
+    int             j;
+    Lgm_QinDenton   *d = (Lgm_QinDenton *)calloc( 1, sizeof(Lgm_QinDenton) );
+
+    if ( n < 1 ) n = 1;
+    LGM_ARRAY_1D( d->Date, n, long int );
+    LGM_ARRAY_2D( d->IsoTimeStr, n, 80, char );
+    for ( j=0; j<QD_NDOUBLE; j++ ) LGM_ARRAY_1D( QD_DBL( d, j ), n, double );
+    for ( j=0; j<QD_NINT; j++ )    LGM_ARRAY_1D( QD_INT( d, j ), n, int );
+
+    return( d );
+
+}
+
+
+
+/*
+ *  Copy value k of s into slot n of t.
+ */
+static void QD_CopyPnt( Lgm_QinDenton *t, int n, const Lgm_QinDenton *s, int k ) {
+
+    int j;
+
+    strcpy( t->IsoTimeStr[n], s->IsoTimeStr[k] );
+    for ( j=0; j<QD_NDOUBLE; j++ ) QD_DBL( t, j )[n] = QD_DBL( s, j )[k];
+    for ( j=0; j<QD_NINT; j++ )    QD_INT( t, j )[n] = QD_INT( s, j )[k];
+
+}
+
+
+
+/*
+ *  Read all of the values in one QinDenton text file. Returns NULL if the file
+ *  could not be opened.
+ */
+static Lgm_QinDenton *QD_ReadFile( const char *Filename, Lgm_CTrans *c ) {
+
+    FILE            *fp;
+    char            Line[2050];
+    int             n, nLines, nMatches;
+    Lgm_QinDenton   *d;
+
+    if ( (fp = fopen( Filename, "r" )) == NULL ) return( NULL );
+
+    for ( nLines=0; fgets( Line, 2048, fp ) != NULL; ) if ( Line[0] != '#' ) ++nLines;
+    rewind( fp );
+
+    d = QD_AllocDay( nLines );
+    n = 0;
+    while( (n < nLines) && (fgets( Line, 2048, fp ) != NULL) ) {
+        if ( Line[0] != '#' ) {
+            nMatches = sscanf( Line, "%79s %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d %d %d %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %d %d %d %d %d %d",
+                        d->IsoTimeStr[n], &d->Year[n], &d->Month[n], &d->Day[n], &d->Hour[n], &d->Minute[n], &d->Second[n],
+                        &d->ByIMF[n], &d->BzIMF[n], &d->V_SW[n], &d->Den_P[n], &d->Pdyn[n], &d->G1[n], &d->G2[n], &d->G3[n],
+                        &d->ByIMF_status[n], &d->BzIMF_status[n], &d->V_SW_status[n], &d->Den_P_status[n], &d->Pdyn_status[n],
+                        &d->G1_status[n], &d->G2_status[n], &d->G3_status[n],
+                        &d->fKp[n], &d->akp3[n], &d->Dst[n], &d->Bz1[n], &d->Bz2[n], &d->Bz3[n], &d->Bz4[n], &d->Bz5[n], &d->Bz6[n],
+                        &d->W1[n], &d->W2[n], &d->W3[n], &d->W4[n], &d->W5[n], &d->W6[n],
+                        &d->W1_status[n], &d->W2_status[n], &d->W3_status[n], &d->W4_status[n], &d->W5_status[n], &d->W6_status[n] );
+            if ( nMatches == 44 ) {
+                d->MJD[n] = Lgm_MJD( d->Year[n], d->Month[n], d->Day[n], d->Hour[n] + d->Minute[n]/60.0 + d->Second[n]/3600.0, LGM_TIME_SYS_UTC, c );
+                ++n;
+            }
+        }
+    }
+    fclose( fp );
+    d->nPnts = n;
+
+    return( d );
+
+}
+
+
+
+/*
+ *  Read one day from the text files -- 1min first, 1hr next. Complain is 2
+ *  to report every file that is missing, 1 to only report it on the last try
+ *  and 0 to say nothing. Returns NULL if neither file could be opened.
+ */
+static Lgm_QinDenton *QD_ReadDay( const char *QinDentonPath, int PathSet, long int Date, int Complain, Lgm_CTrans *c, char *Source ) {
+
+    static char     *ftype[] = {"1min", "1hr" };
+    int             Year, Month, Day, Doy, j;
+    char            Filename[2600];
+    Lgm_QinDenton   *d;
+
+    Lgm_Doy( Date, &Year, &Month, &Day, &Doy );
+
+    for ( j=0; j<2; j++ ) {
+
+        snprintf( Filename, 2600, "%s/%4d/QinDenton_%8ld_%s.txt", QinDentonPath, Year, Date, ftype[j] );
+        if ( (d = QD_ReadFile( Filename, c )) != NULL ) {
+            snprintf( Source, 2600, "%s", Filename );
+            return( d );
+        }
+
+        if ( (Complain == 2) || ((Complain == 1) && (j==1)) ) {
+            if ( !PathSet ) { //i.e. QIN_DENTON_PATH environment variable not set.
+                printf( "Cannot open %s file. Try setting QIN_DENTON_PATH environment variable to path containing QinDenton files.\n", Filename );
+            } else {
+                printf( "Cannot open %s file.\n", Filename );
+            }
+        }
+
+    }
+
+    return( NULL );
+
+}
+
+
+
+/*
+ *  Copy one day out of the archive. Returns -1 if the archive does not cover
+ *  Date, otherwise the number of values (*pd is NULL if there were none).
+ */
+static long int QD_ArchiveDay( Lgm_QinDentonArchive *a, long int Date, Lgm_QinDenton **pd ) {
+
+    long int                            i0, n, k;
+    int                                 j;
+    const Lgm_QinDentonArchiveRecord    *r;
+    Lgm_QinDenton                       *d;
+
+    *pd = NULL;
+    if ( (n = Lgm_QinDenton_ArchiveDay( a, Date, &i0 )) <= 0 ) return( n );
+
+    d = QD_AllocDay( (int)n );
+    for ( k=0; k<n; k++ ) {
+        r = a->Records + i0 + k;
+        strncpy( d->IsoTimeStr[k], r->IsoTimeStr, LGM_QD_ISOLEN );
+        d->IsoTimeStr[k][LGM_QD_ISOLEN-1] = '\0';
+        for ( j=0; j<QD_NDOUBLE; j++ ) QD_DBL( d, j )[k] = QD_RDBL( r, j );
+        for ( j=0; j<QD_NINT; j++ )    QD_INT( d, j )[k] = QD_RINT( r, j );
+    }
+    d->nPnts = (int)n;
+    *pd = d;
+
+    return( n );
+
+}
+
+
+
+/*
+ *  Empty the cache and (re)allocate it with QD_CacheSize slots. Must be
+ *  called inside the Lgm_QinDentonCache critical section.
+ */
+static void QD_ResetCache( ) {
+
+    int i;
+
+    for ( i=0; i<QD_nCache; i++ ) {
+        if ( QD_Cache[i].q != NULL ) Lgm_destroy_QinDenton( QD_Cache[i].q );
+    }
+    free( QD_Cache );
+
+    QD_nCache = QD_CacheSize;
+    QD_Cache  = (QD_CacheDay *)calloc( QD_nCache, sizeof(QD_CacheDay) );
+    for ( i=0; i<QD_nCache; i++ ) QD_Cache[i].Date = -1;
+    QD_Clock = 0;
+
+}
+
+
+
+/*
+ *  Make sure the cache is allocated and holds days from QinDentonPath. Must
+ *  be called inside the Lgm_QinDentonCache critical section.
+ */
+static void QD_CheckCache( const char *QinDentonPath ) {
+
+    if ( (QD_Cache == NULL) || (QD_nCache != QD_CacheSize) || (strcmp( QD_CachePath, QinDentonPath ) != 0) ) {
+        QD_ResetCache( );
+        snprintf( QD_CachePath, 2048, "%s", QinDentonPath );
+    }
+
+}
+
+
+
+/*
+ *  Return the cache slot for Date, or NULL if it isnt there. Must be called
+ *  inside the Lgm_QinDentonCache critical section.
+ */
+static QD_CacheDay *QD_FindDay( long int Date ) {
+
+    int i;
+
+    for ( i=0; i<QD_nCache; i++ ) {
+        if ( QD_Cache[i].Date == Date ) {
+            QD_Cache[i].LastUsed = ++QD_Clock;
+            return( &QD_Cache[i] );
+        }
+    }
+
+    return( NULL );
+
+}
+
+
+
+/*
+ *  Empty the least recently used slot and give it to Date. Must be called
+ *  inside the Lgm_QinDentonCache critical section.
+ */
+static QD_CacheDay *QD_NewDay( long int Date ) {
+
+    int         i, iLRU;
+    QD_CacheDay *s;
+
+    for ( iLRU=0, i=1; i<QD_nCache; i++ ) {
+        if ( QD_Cache[i].LastUsed < QD_Cache[iLRU].LastUsed ) iLRU = i;
+    }
+
+    s = &QD_Cache[iLRU];
+    if ( s->q != NULL ) Lgm_destroy_QinDenton( s->q );
+    s->q         = NULL;
+    s->Source[0] = '\0';
+    s->Date      = Date;
+    s->LastUsed  = ++QD_Clock;
+
+    return( s );
+
+}
+
+
+
+/*
+ *  Return the cache slot for Date, loading the day (into the least recently
+ *  used slot) if it is not already there. Must be called inside the
+ *  Lgm_QinDentonCache critical section.
+ */
+static QD_CacheDay *QD_GetDay( long int Date, int PathSet, int Complain ) {
+
+    Lgm_CTrans              *c;
+    Lgm_QinDentonArchive    *a;
+    QD_CacheDay             *s;
+
+    if ( (s = QD_FindDay( Date )) != NULL ) return( s );
+
+    s = QD_NewDay( Date );
+
+    a = Lgm_QinDenton_GetArchive( );
+    if ( QD_ArchiveDay( a, Date, &s->q ) >= 0 ) {
+        Lgm_QinDenton_ArchiveFilename( s->Source, 2600 );
+    } else {
+        c = Lgm_init_ctrans( 0 );
+        s->q = QD_ReadDay( QD_CachePath, PathSet, Date, Complain, c, s->Source );
+        Lgm_free_ctrans( c );
+    }
+
+    return( s );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Directory holding the QinDenton files.
+ *
+ *  \details
+ *      This is $QIN_DENTON_PATH if that is set (and exists), otherwise
+ *      LGM_INDEX_DATA_DIR/QinDenton.
+ *
+ *      \param[out]     QinDentonPath   Directory name.
+ *      \param[in]      n               Size of QinDentonPath.
+ *
+ *      \return         TRUE if the QIN_DENTON_PATH environment variable is set.
+ */
+int Lgm_QinDentonPath( char *QinDentonPath, int n ) {
+
+    char        *Path;
+    struct stat sts;
+
+    Path = getenv( "QIN_DENTON_PATH" );
+    if ( Path == NULL ) {
+        snprintf( QinDentonPath, n, "%s/QinDenton", LGM_INDEX_DATA_DIR );
+    } else if ( stat( Path, &sts ) == -1 ) {
+        snprintf( QinDentonPath, n, "%s/QinDenton", LGM_INDEX_DATA_DIR );
+        printf("Environment variable QIN_DENTON_PATH points to a non-existent directory: %s. Setting QinDentonPath to: %s \n", Path, QinDentonPath );
+    } else {
+        snprintf( QinDentonPath, n, "%s", Path );
+    }
+
+    return( Path != NULL );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Read the QinDenton values for the day before, the day of and the day after a given date.
+ *
+ *  \details
+ *      The days come from the process-wide day cache (which reads each day
+ *      from the archive or the text files the first time it is needed).
+ *
+ *      \param[in]      Date    Date in YYYYMMDD format.
+ *      \param[out]     q       Structure to fill (allocated with Lgm_init_QinDenton() or Lgm_init_QinDentonDefaults()).
+ */
+void Lgm_read_QinDenton( long int Date, Lgm_QinDenton *q ) {
+
+    long int        Dates[3], JDN, n;
+    int             Year, Month, Day, Doy, PathSet, j, k;
+    double          MJD, UT;
+    char            QinDentonPath[2048];
+    QD_CacheDay     *s;
+    Lgm_QinDenton   *d;
+
+    PathSet = Lgm_QinDentonPath( QinDentonPath, 2048 );
+
+    Lgm_Doy( Date, &Year, &Month, &Day, &Doy );
+    JDN = Lgm_JDN( Year, Month, Day );
+    MJD = (double)JDN - 2400000.0;  // noon on Date
+    Lgm_jd_to_ymdh( (double)(JDN-1), &Dates[0], &Year, &Month, &Day, &UT );
+    Dates[1] = Date;
+    Lgm_jd_to_ymdh( (double)(JDN+1), &Dates[2], &Year, &Month, &Day, &UT );
+
+    n = 0;
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        QD_CheckCache( QinDentonPath );
+        for ( j=0; j<3; j++ ) {
+
+            // only complain about a missing 1min file for the current and next dates
+            s = QD_GetDay( Dates[j], PathSet, (j > 0) ? 2 : 1 );
+            if ( (d = s->q) == NULL ) continue;
+
+            for ( k=0; (k<d->nPnts) && (n<LGM_QINDENTON_NMAX); k++ ) {
+                if ( (MJD > 33282.0) && ((n==0) || (MJD > q->MJD[n])) ) {  // make sure MJD > Jan 1, 1950 and time is increasing
+                    QD_CopyPnt( q, n, d, k );
+                    ++n;
+                } else {
+                    printf( "Warning. Times may be corrupted in QinDenton File: %s   Time = %g  MJD = %g\n", s->Source,
+                            d->Hour[k] + d->Minute[k]/60.0 + d->Second[k]/3600.0, d->MJD[k] );
+                }
+            }
+
+        }
+    }
+
+    q->nPnts = n;
+
+}
+
+
+
+/**
+ *  \brief
+ *      Set the number of days kept in the QinDenton day cache.
+ *
+ *  \details
+ *      The default is LGM_QD_CACHE_DAYS. Values less than 3 are raised to 3
+ *      (Lgm_read_QinDenton() needs three days at a time). Changing the size
+ *      empties the cache.
+ */
+void Lgm_QinDenton_SetCacheSize( int nDays ) {
+
+    if ( nDays < 3 ) nDays = 3;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        if ( nDays != QD_CacheSize ) {
+            QD_CacheSize = nDays;
+            QD_ResetCache( );
+        }
+    }
+
+}
+
+
+
+/**
+ *  \brief
+ *      Empty the QinDenton day cache (e.g. after the files have been updated).
+ */
+void Lgm_QinDenton_ClearCache( ) {
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        QD_ResetCache( );
+        QD_CachePath[0] = '\0';
+    }
+
+}
+
+
+
+/**
+ *  \brief
+ *      Load a range of days into the QinDenton day cache.
+ *
+ *  \details
+ *      Loads StartDate through EndDate (plus the day on either side, which
+ *      Lgm_read_QinDenton() also needs), growing the cache if it is too small
+ *      to hold them all. Use this before a run over a known interval so that
+ *      nothing is evicted part way through.
+ *
+ *      \param[in]      StartDate   First date in YYYYMMDD format.
+ *      \param[in]      EndDate     Last date in YYYYMMDD format.
+ *
+ *      \return         Number of days (of those loaded) that had data.
+ */
+int Lgm_QinDenton_LoadRange( long int StartDate, long int EndDate ) {
+
+    long int        JDN, JDN0, JDN1, Date;
+    int             Year, Month, Day, Doy, PathSet, nFound;
+    double          UT;
+    char            QinDentonPath[2048];
+
+    PathSet = Lgm_QinDentonPath( QinDentonPath, 2048 );
+
+    Lgm_Doy( StartDate, &Year, &Month, &Day, &Doy );
+    JDN0 = Lgm_JDN( Year, Month, Day ) - 1;
+    Lgm_Doy( EndDate, &Year, &Month, &Day, &Doy );
+    JDN1 = Lgm_JDN( Year, Month, Day ) + 1;
+
+    nFound = 0;
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        if ( JDN1 - JDN0 + 1 > QD_CacheSize ) QD_CacheSize = (int)(JDN1 - JDN0 + 1);
+        QD_CheckCache( QinDentonPath );
+        for ( JDN=JDN0; JDN<=JDN1; JDN++ ) {
+            Lgm_jd_to_ymdh( (double)JDN, &Date, &Year, &Month, &Day, &UT );
+            if ( QD_GetDay( Date, PathSet, (JDN > JDN0) ? 2 : 1 )->q != NULL ) ++nFound;
+        }
+    }
+
+    return( nFound );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Read a day into the QinDenton day cache without holding up other threads.
+ *
+ *  \details
+ *      Lgm_read_QinDenton() reads a missing day inside the cache's critical
+ *      section, so every other thread that wants the cache waits while the
+ *      day is parsed. This reads the day (if it isnt already cached) with
+ *      the cache unlocked and only locks it to put the day in, so it can be
+ *      run on a background thread (see Lgm_Prefetch.c) while the cache is
+ *      being used. Days with no file are left out of the cache, so that the
+ *      usual "Cannot open" message still comes from Lgm_read_QinDenton().
+ *
+ *      \param[in]      Date    Date in YYYYMMDD format.
+ *
+ *      \return         TRUE if the day is in the cache afterwards.
+ */
+int Lgm_QinDenton_PrefetchDay( long int Date ) {
+
+    int             PathSet, Found;
+    char            QinDentonPath[2048], Source[2600];
+    Lgm_CTrans      *c;
+    Lgm_QinDenton   *d;
+    QD_CacheDay     *s;
+
+    PathSet = Lgm_QinDentonPath( QinDentonPath, 2048 );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        QD_CheckCache( QinDentonPath );
+        Found = ( QD_FindDay( Date ) != NULL );
+    }
+    if ( Found ) return( TRUE );
+
+    if ( QD_ArchiveDay( Lgm_QinDenton_GetArchive( ), Date, &d ) >= 0 ) {
+        Lgm_QinDenton_ArchiveFilename( Source, 2600 );
+        Found = TRUE;
+    } else {
+        c = Lgm_init_ctrans( 0 );
+        d = QD_ReadDay( QinDentonPath, PathSet, Date, 0, c, Source );
+        Lgm_free_ctrans( c );
+        Found = ( d != NULL );
+    }
+    if ( !Found ) return( FALSE );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDentonCache)
+#endif
+    {
+        // someone else may have loaded it (or changed QIN_DENTON_PATH) in the meantime
+        if ( strcmp( QD_CachePath, QinDentonPath ) == 0 ) {
+            QD_CheckCache( QinDentonPath );
+            if ( QD_FindDay( Date ) == NULL ) {
+                s = QD_NewDay( Date );
+                s->q = d;
+                snprintf( s->Source, 2600, "%s", Source );
+                d = NULL;
+            }
+        }
+    }
+    if ( d != NULL ) Lgm_destroy_QinDenton( d );
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Name of the QinDenton archive file to use.
+ *
+ *  \details
+ *      This is $LGM_QIN_DENTON_ARCHIVE if that is set, otherwise
+ *      QinDenton.bin in the QinDenton directory (see Lgm_QinDentonPath()).
+ *
+ *      \param[out]     Filename    Archive filename.
+ *      \param[in]      n           Size of Filename.
+ */
+void Lgm_QinDenton_ArchiveFilename( char *Filename, int n ) {
+
+    char        QinDentonPath[2048];
+    const char  *Path = getenv( "LGM_QIN_DENTON_ARCHIVE" );
+
+    if ( Path != NULL ) {
+        snprintf( Filename, n, "%s", Path );
+    } else {
+        Lgm_QinDentonPath( QinDentonPath, 2048 );
+        snprintf( Filename, n, "%s/%s", QinDentonPath, LGM_QD_ARCHIVE_NAME );
+    }
+
+}
+
+
+
+/**
+ *  \brief
+ *      Open (and memory-map) a QinDenton archive.
+ *
+ *      \param[in]      Filename    Archive file.
+ *
+ *      \return         Pointer to archive, or NULL if it could not be opened or is not a valid archive.
+ */
+Lgm_QinDentonArchive *Lgm_QinDenton_OpenArchive( const char *Filename ) {
+
+    int                             fd;
+    struct stat                     sb;
+    size_t                          Size;
+    unsigned char                   *Base;
+    Lgm_QinDentonArchiveHeader      *h;
+    Lgm_QinDentonArchive            *a;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_QinDentonArchiveHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     *  Validate the header
+     */
+    h = (Lgm_QinDentonArchiveHeader *)Base;
+    if ( (memcmp( h->Magic, LGM_QD_ARCHIVE_MAGIC, 8 ) != 0) || (h->Version != LGM_QD_ARCHIVE_VERSION)
+            || (h->ByteOrder != 1.0) || (h->RecordSize != (int32_t)sizeof(Lgm_QinDentonArchiveRecord))
+            || (h->nRecords < 0) || (h->DataOffset + h->nRecords*sizeof(Lgm_QinDentonArchiveRecord) > Size) ) {
+        fprintf( stderr, "Lgm_QinDenton_OpenArchive(): %s is not a valid QinDenton archive.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+
+    a = (Lgm_QinDentonArchive *)calloc( 1, sizeof(Lgm_QinDentonArchive) );
+    a->Base     = Base;
+    a->Size     = Size;
+    a->Header   = h;
+    a->Records  = (const Lgm_QinDentonArchiveRecord *)(Base + h->DataOffset);
+
+    return( a );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Close an archive opened with Lgm_QinDenton_OpenArchive().
+ */
+void Lgm_QinDenton_CloseArchive( Lgm_QinDentonArchive *a ) {
+
+    if ( a == NULL ) return;
+#ifdef HAVE_SYS_MMAN_H
+    munmap( a->Base, a->Size );
+#else
+    free( a->Base );
+#endif
+    free( a );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Return the process-wide QinDenton archive (opening it on first use).
+ *
+ *  \details
+ *      Returns NULL if there is no archive (see Lgm_QinDenton_ArchiveFilename()).
+ *      The archive stays mapped for the life of the process.
+ */
+Lgm_QinDentonArchive *Lgm_QinDenton_GetArchive( ) {
+
+    char    Filename[2600];
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_QinDenton_Archive)
+#endif
+    {
+        if ( !Lgm_QinDenton_SharedArchive_Tried ) {
+            Lgm_QinDenton_ArchiveFilename( Filename, 2600 );
+            Lgm_QinDenton_SharedArchive       = Lgm_QinDenton_OpenArchive( Filename );
+            Lgm_QinDenton_SharedArchive_Tried = TRUE;
+        }
+    }
+
+    return( Lgm_QinDenton_SharedArchive );
+
+}
+
+
+
+/*
+ *  Index of the first record with FileDate >= Date.
+ */
+static long int QD_LowerBound( Lgm_QinDentonArchive *a, long int Date ) {
+
+    long int    lo = 0, hi = (long int)a->Header->nRecords, mid;
+
+    while ( lo < hi ) {
+        mid = lo + (hi-lo)/2;
+        if ( a->Records[mid].FileDate < Date ) lo = mid+1;
+        else hi = mid;
+    }
+
+    return( lo );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Find the records for a given day in an archive.
+ *
+ *      \param[in]      a           Archive.
+ *      \param[in]      Date        Date in YYYYMMDD format.
+ *      \param[out]     i0          Index of the first record for Date.
+ *
+ *      \return         Number of records for Date (0 if there was no file for it), or -1 if the archive does not cover Date.
+ */
+long int Lgm_QinDenton_ArchiveDay( Lgm_QinDentonArchive *a, long int Date, long int *i0 ) {
+
+    *i0 = 0;
+    if ( (a == NULL) || (Date < a->Header->StartDate) || (Date > a->Header->EndDate) ) return( -1 );
+
+    *i0 = QD_LowerBound( a, Date );
+
+    return( QD_LowerBound( a, Date+1 ) - *i0 ); // Date+1 need not be a valid date; it only has to sort after Date
+
+}
+
+
+
+/**
+ *  \brief
+ *      Build a QinDenton archive from the text files.
+ *
+ *  \details
+ *      Reads the QinDenton_YYYYMMDD_{1min,1hr}.txt file (1min if there is one)
+ *      for every day between StartDate and EndDate (inclusive) and writes
+ *      all of the values into ArchiveFile. Days with no file are simply left
+ *      out (and are treated as missing when the archive is used).
+ *
+ *      \param[in]      Path        QinDenton directory (NULL means the usual default, see Lgm_QinDentonPath()).
+ *      \param[in]      StartDate   First date in YYYYMMDD format.
+ *      \param[in]      EndDate     Last date in YYYYMMDD format.
+ *      \param[in]      ArchiveFile Output filename.
+ *
+ *      \return         Number of records written, or -1 on error.
+ */
+long int Lgm_QinDenton_BuildArchive( const char *Path, long int StartDate, long int EndDate, const char *ArchiveFile ) {
+
+    int                         Year, Month, Day, Doy, PathSet, j, k;
+    long int                    Date, JDN, JDN0, JDN1, nRecords;
+    double                      UT;
+    char                        QinDentonPath[2048], Source[2600];
+    FILE                        *fp_out;
+    Lgm_QinDenton               *d;
+    Lgm_QinDentonArchiveHeader  h;
+    Lgm_QinDentonArchiveRecord  r;
+    Lgm_CTrans                  *c;
+
+    if ( Path == NULL ) {
+        PathSet = Lgm_QinDentonPath( QinDentonPath, 2048 );
+    } else {
+        snprintf( QinDentonPath, 2048, "%s", Path );
+        PathSet = TRUE;
+    }
+
+    Lgm_Doy( StartDate, &Year, &Month, &Day, &Doy );
+    JDN0 = Lgm_JDN( Year, Month, Day );
+    Lgm_Doy( EndDate, &Year, &Month, &Day, &Doy );
+    JDN1 = Lgm_JDN( Year, Month, Day );
+    if ( JDN1 < JDN0 ) {
+        fprintf( stderr, "Lgm_QinDenton_BuildArchive(): EndDate (%ld) is before StartDate (%ld).\n", EndDate, StartDate );
+        return( -1 );
+    }
+
+    if ( (fp_out = fopen( ArchiveFile, "wb" )) == NULL ) {
+        fprintf( stderr, "Lgm_QinDenton_BuildArchive(): Could not open %s for writing.\n", ArchiveFile );
+        return( -1 );
+    }
+
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.Magic, LGM_QD_ARCHIVE_MAGIC, 8 );
+    h.Version     = LGM_QD_ARCHIVE_VERSION;
+    h.RecordSize  = (int32_t)sizeof(Lgm_QinDentonArchiveRecord);
+    h.ByteOrder   = 1.0;
+    h.StartDate   = StartDate;
+    h.EndDate     = EndDate;
+    h.DataOffset  = sizeof(h);
+
+    /*
+     *  Write the records (leaving room for the header, which is written at the end).
+     */
+    c = Lgm_init_ctrans( 0 );
+    fseek( fp_out, h.DataOffset, SEEK_SET );
+    nRecords = 0;
+    for ( JDN=JDN0; JDN<=JDN1; JDN++ ) {
+
+        Lgm_jd_to_ymdh( (double)JDN, &Date, &Year, &Month, &Day, &UT );
+        if ( (d = QD_ReadDay( QinDentonPath, PathSet, Date, 0, c, Source )) == NULL ) continue;
+
+        for ( k=0; k<d->nPnts; k++ ) {
+            memset( &r, 0, sizeof(r) );
+            r.FileDate = (int32_t)Date;
+            strncpy( r.IsoTimeStr, d->IsoTimeStr[k], LGM_QD_ISOLEN-1 );
+            for ( j=0; j<QD_NDOUBLE; j++ ) *(double *)((char *)&r + QD_Doubles[j].Rec) = QD_DBL( d, j )[k];
+            for ( j=0; j<QD_NINT; j++ )    *(int32_t *)((char *)&r + QD_Ints[j].Rec) = (int32_t)QD_INT( d, j )[k];
+            fwrite( &r, sizeof(r), 1, fp_out );
+            ++nRecords;
+        }
+        Lgm_destroy_QinDenton( d );
+
+    }
+    Lgm_free_ctrans( c );
+    h.nRecords = nRecords;
+
+    fseek( fp_out, 0, SEEK_SET );
+    fwrite( &h, sizeof(h), 1, fp_out );
+
+    if ( fclose( fp_out ) != 0 ) {
+        fprintf( stderr, "Lgm_QinDenton_BuildArchive(): Error writing %s.\n", ArchiveFile );
+        return( -1 );
+    }
+
+    return( nRecords );
+
+}
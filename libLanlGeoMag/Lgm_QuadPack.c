@@ -1,10 +1,24 @@
 #include "Lgm/Lgm_QuadPack.h"
 
+/*
+ *  dqags() and dqagse() are thin wrappers around these. fv, when not NULL,
+ *  is used instead of f and gets all 21 nodes of an interval at once
+ *  (dqagsv(), dqagsev()).
+ */
+static int dqags_vs( double (*f)( double, _qpInfo *), void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, double *result, double *abserr, int *neval,
+        int *ier, int limit, int lenw, int *last, int *iwork, double *work, int verbosity );
+static int dqagse_vs( double (*f)( double, _qpInfo *), void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, int limit, double *result, double *abserr,
+        int *neval, int *ier, double *alist, double *blist, double *rlist,
+        double *elist, int *iord, int *last );
+
 /*
  *      QUADPACK DQAGS Routine converted to C
  */
-int dqags(f, qpInfo, a, b, epsabs, epsrel, result, abserr, neval, ier, limit, lenw, last, iwork, work, verbosity )
+static int dqags_vs(f, fv, qpInfo, a, b, epsabs, epsrel, result, abserr, neval, ier, limit, lenw, last, iwork, work, verbosity )
 double  (*f)( double, _qpInfo *); /*  The integrand function -- I.e. the function to integrate    	 */
+void    (*fv)( int, const double *, double *, _qpInfo *); /*  Batch integrand (all 21 nodes of an interval at once), or NULL */
 _qpInfo *qpInfo;        	  /*  Auxilliary information to pass to function (to avoid making globals) */
 double   a;             	  /*  Lower Limit of integration.                                 	 */
 double   b;             	  /*  Upper limit of integration.                                 	 */
@@ -223,7 +237,7 @@ int TMPiwork[600];
         l3 = limit+l2;
 
 
-        dqagse(f, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier,
+        dqagse_vs(f, fv, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier,
 				work, work+l1, work+l2, work+l3, iwork, last);
 
     }
@@ -254,8 +268,9 @@ int TMPiwork[600];
 /*
  *      QUADPACK DQAGSE Routine converted to C
  */
-int dqagse(f, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, iord, last)
+static int dqagse_vs(f, fv, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, iord, last)
 double  (*f)( double, _qpInfo *); /*  The integrand function -- I.e. the function to integrate           */
+void    (*fv)( int, const double *, double *, _qpInfo *); /*  Batch integrand (all 21 nodes of an interval at once), or NULL */
 _qpInfo *qpInfo;                  /*  Auxilliary information to pass to function (to avoid making globals) */
 double   a;             	  /*  Lower Limit of integration.                                 */
 double   b;             	  /*  Upper limit of integration.                                 */
@@ -532,7 +547,7 @@ int	*last;
     uflow = d1mach(1);
     oflow = d1mach(2);
     ierro = 0;
-    dqk21(f, qpInfo, a, b, result, abserr, &defabs, &resabs);
+    LGM_QK21(f, fv, qpInfo, a, b, result, abserr, &defabs, &resabs);
 
 
 
@@ -597,8 +612,8 @@ int	*last;
         a2 = b1;
         b2 = blist[maxerr];
         erlast = errmax;
-        dqk21(f, qpInfo, a1, b1, &area1, &error1, &resabs, &defab1);
-        dqk21(f, qpInfo, a2, b2, &area2, &error2, &resabs, &defab2);
+        LGM_QK21(f, fv, qpInfo, a1, b1, &area1, &error1, &resabs, &defab1);
+        LGM_QK21(f, fv, qpInfo, a2, b2, &area2, &error2, &resabs, &defab2);
 
 
 
@@ -867,6 +882,45 @@ L130:
 
 
 
+/*
+ *  The usual one-point-at-a-time entry points.
+ */
+int dqags( double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, double *result, double *abserr, int *neval,
+        int *ier, int limit, int lenw, int *last, int *iwork, double *work, int verbosity ) {
+    return( dqags_vs( f, NULL, qpInfo, a, b, epsabs, epsrel, result, abserr, neval, ier, limit, lenw, last, iwork, work, verbosity ) );
+}
+
+int dqagse( double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, int limit, double *result, double *abserr,
+        int *neval, int *ier, double *alist, double *blist, double *rlist,
+        double *elist, int *iord, int *last ) {
+    return( dqagse_vs( f, NULL, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, iord, last ) );
+}
+
+
+/*
+ *  Same as dqags() and dqagse(), but the integrand fv( n, x, y, qpInfo ) fills
+ *  in y[i] = f(x[i]) for all n = 21 Kronrod nodes of an interval in one call
+ *  (see dqk21v()). The results are identical to those of dqags()/dqagse() with
+ *  the equivalent f.
+ */
+int dqagsv( void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, double *result, double *abserr, int *neval,
+        int *ier, int limit, int lenw, int *last, int *iwork, double *work, int verbosity ) {
+    return( dqags_vs( NULL, fv, qpInfo, a, b, epsabs, epsrel, result, abserr, neval, ier, limit, lenw, last, iwork, work, verbosity ) );
+}
+
+int dqagsev( void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double epsabs, double epsrel, int limit, double *result, double *abserr,
+        int *neval, int *ier, double *alist, double *blist, double *rlist,
+        double *elist, int *iord, int *last ) {
+    return( dqagse_vs( NULL, fv, qpInfo, a, b, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, iord, last ) );
+}
+
+
+
+
 /*
  *      QUADPACK DQELG Routine converted to C
  */
@@ -1129,6 +1183,152 @@ int dqelg(int n, double epstab[], double *result, double *abserr, double res3la[
 
 
 
+/*
+ *           the abscissae and weights are given for the interval (-1,1).
+ *           because of symmetry only the positive abscissae and their
+ *           corresponding weights are given.
+ *
+ *           xgk    - abscissae of the 21-point kronrod rule
+ *                    xgk(2), xgk(4), ...  abscissae of the 10-point
+ *                    gauss rule
+ *                    xgk(1), xgk(3), ...  abscissae which are optimally
+ *                    added to the 10-point gauss rule
+ *
+ *           wgk    - weights of the 21-point kronrod rule
+ *
+ *           wg     - weights of the 10-point gauss rule
+ *
+ *
+ * gauss quadrature weights and kronron quadrature abscissae and weights
+ * as evaluated with 80 decimal digit arithmetic by l. w. fullerton,
+ * bell labs, nov. 1981.
+ */
+
+
+
+static double qk21_wg[] = { 	0.0,
+		0.066671344308688137593568809893332,
+		0.149451349150580593145776339657697,
+		0.219086362515982043995534934228163,
+		0.269266719309996355091226921569469,
+		0.295524224714752870173892994651338 };
+
+static double qk21_xgk[] = {	0.0,
+		0.995657163025808080735527280689003,
+		0.973906528517171720077964012084452,
+		0.930157491355708226001207180059508,
+		0.865063366688984510732096688423493,
+		0.780817726586416897063717578345042,
+		0.679409568299024406234327365114874,
+		0.562757134668604683339000099272694,
+		0.433395394129247190799265943165784,
+		0.294392862701460198131126603103866,
+		0.148874338981631210884826001129720,
+		0.000000000000000000000000000000000 };
+
+static double qk21_wgk[] = {	0.0,
+		0.011694638867371874278064396062192,
+		0.032558162307964727478818972459390,
+		0.054755896574351996031381300244580,
+		0.075039674810919952767043140916190,
+		0.093125454583697605535065465083366,
+		0.109387158802297641899210590325805,
+		0.123491976262065851077958109831074,
+		0.134709217311473325928054001771707,
+		0.142775938577060080797094273138717,
+		0.147739104901338491374841515972068,
+		0.149445554002916905664936468389821 };
+
+
+
+
+/*
+ *  The sums of dqk21(), given the integrand at the 21 nodes (fc at the
+ *  center, fv1[j] and fv2[j] at centr -/+ hlgth*xgk[j]).
+ */
+static void dqk21_sums( double hlgth, double fc, double *fv1, double *fv2, double *result, double *abserr, double *resabs, double *resasc ) {
+
+    double 	dhlgth, epmach, fsum, resg, resk, reskh, uflow;
+    int 	j, jtw, jtwm1;
+
+
+    /*
+     *
+     *           list of major variables
+     *           -----------------------
+     *
+     *           centr  - mid point of the interval
+     *           hlgth  - half-length of the interval
+     *           absc   - abscissa
+     *           fval*  - function value
+     *           resg   - result of the 10-point gauss formula
+     *           resk   - result of the 21-point kronrod formula
+     *           reskh  - approximation to the mean value of f over (a,b),
+     *                    i.e. to i/(b-a)
+     *
+     *
+     *           machine dependent constants
+     *           ---------------------------
+     *
+     *           epmach is the largest relative spacing.
+     *           uflow is the smallest positive magnitude.
+     */
+
+
+    epmach = d1mach(4);
+    uflow = d1mach(1);
+    dhlgth = fabs(hlgth);
+
+
+    /*
+     *           compute the 21-point kronrod approximation to
+     *           the integral, and estimate the absolute error.
+     */
+    resg = 0.0;
+    resk = qk21_wgk[11]*fc;
+    *resabs = fabs(resk);
+
+    for (j=1; j<=5; ++j) {
+        jtw = 2*j;
+        fsum = fv1[jtw]+fv2[jtw];
+        resg += qk21_wg[j]*fsum;
+        resk += qk21_wgk[jtw]*fsum;
+        *resabs += qk21_wgk[jtw]*(fabs(fv1[jtw])+fabs(fv2[jtw]));
+    }
+
+
+
+    for (j = 1; j<=5; ++j) {
+        jtwm1 = 2*j-1;
+        fsum = fv1[jtwm1]+fv2[jtwm1];
+        resk += qk21_wgk[jtwm1]*fsum;
+        *resabs += qk21_wgk[jtwm1]*(fabs(fv1[jtwm1])+fabs(fv2[jtwm1]));
+    }
+
+
+
+    reskh = resk*0.5;
+    *resasc = qk21_wgk[11]*fabs(fc-reskh);
+
+    for (j=1; j<=10; ++j) *resasc += qk21_wgk[j]*(fabs(fv1[j]-reskh)+fabs(fv2[j]-reskh));
+
+    *result = resk*hlgth;
+    *resabs *= dhlgth;
+    *resasc *= dhlgth;
+    *abserr = fabs((resk-resg)*hlgth);
+
+    if( (*resasc != 0.0) && (*abserr != 0.0)) *abserr = *resasc*dmin1( 1.0, pow(200.0*(*abserr)/(*resasc), 1.5) );
+
+    if ( *resabs > uflow/(50.0*epmach) ) *abserr = dmax1( (epmach*50.0)*(*resabs), *abserr );
+
+    return;
+
+}
+
+
+
+
+
 /*
  *      QUADPACK DQK21 Routine converted to C
  */
@@ -1203,168 +1403,83 @@ double  *resasc;        	  /*  */
 
 
 
-    double 	absc, centr, dhlgth, d1mach();
-    double	epmach, fc, fsum, fval1, fval2, fv1[11], fv2[11], hlgth;
-    double 	resg, resk, reskh, uflow;
+    double 	absc, centr, hlgth;
+    double	fc, fv1[11], fv2[11];
     int 	j, jtw, jtwm1;
 
 
 
 
-
-    /*
-     *           the abscissae and weights are given for the interval (-1,1).
-     *           because of symmetry only the positive abscissae and their
-     *           corresponding weights are given.
-     *
-     *           xgk    - abscissae of the 21-point kronrod rule
-     *                    xgk(2), xgk(4), ...  abscissae of the 10-point
-     *                    gauss rule
-     *                    xgk(1), xgk(3), ...  abscissae which are optimally
-     *                    added to the 10-point gauss rule
-     *
-     *           wgk    - weights of the 21-point kronrod rule
-     *
-     *           wg     - weights of the 10-point gauss rule
-     *
-     *
-     * gauss quadrature weights and kronron quadrature abscissae and weights
-     * as evaluated with 80 decimal digit arithmetic by l. w. fullerton,
-     * bell labs, nov. 1981.
-     */
-
-
-
-    double wg[] = { 	0.0,
-		0.066671344308688137593568809893332,
-		0.149451349150580593145776339657697,
-		0.219086362515982043995534934228163,
-		0.269266719309996355091226921569469,
-		0.295524224714752870173892994651338 };
-
-    double xgk[] = {	0.0,
-		0.995657163025808080735527280689003,
-		0.973906528517171720077964012084452,
-		0.930157491355708226001207180059508,
-		0.865063366688984510732096688423493,
-		0.780817726586416897063717578345042,
-		0.679409568299024406234327365114874,
-		0.562757134668604683339000099272694,
-		0.433395394129247190799265943165784,
-		0.294392862701460198131126603103866,
-		0.148874338981631210884826001129720,
-		0.000000000000000000000000000000000 };
-
-    double wgk[] = {	0.0,
-		0.011694638867371874278064396062192,
-		0.032558162307964727478818972459390,
-		0.054755896574351996031381300244580,
-		0.075039674810919952767043140916190,
-		0.093125454583697605535065465083366,
-		0.109387158802297641899210590325805,
-		0.123491976262065851077958109831074,
-		0.134709217311473325928054001771707,
-		0.142775938577060080797094273138717,
-		0.147739104901338491374841515972068,
-		0.149445554002916905664936468389821 };
-
-
-
-    /*
-     *
-     *           list of major variables
-     *           -----------------------
-     *
-     *           centr  - mid point of the interval
-     *           hlgth  - half-length of the interval
-     *           absc   - abscissa
-     *           fval*  - function value
-     *           resg   - result of the 10-point gauss formula
-     *           resk   - result of the 21-point kronrod formula
-     *           reskh  - approximation to the mean value of f over (a,b),
-     *                    i.e. to i/(b-a)
-     *
-     *
-     *           machine dependent constants
-     *           ---------------------------
-     *
-     *           epmach is the largest relative spacing.
-     *           uflow is the smallest positive magnitude.
-     */
-
-
-
-
     /*
      *   first executable statement  dqk21
      */
-    epmach = d1mach(4);
-    uflow = d1mach(1);
-
     centr = 0.5*(a+b);
     hlgth = 0.5*(b-a);
-    dhlgth = fabs(hlgth);
 
-
-    /*
-     *           compute the 21-point kronrod approximation to
-     *           the integral, and estimate the absolute error.
-     */
-    resg = 0.0;
     fc = (*f)(centr, qpInfo);
-    resk = wgk[11]*fc;
-    *resabs = fabs(resk);
 
     for (j=1; j<=5; ++j) {
         jtw = 2*j;
-        absc = hlgth*xgk[jtw];
-        fval1 = (*f)(centr-absc, qpInfo);
-        fval2 = (*f)(centr+absc, qpInfo);
-        fv1[jtw] = fval1;
-        fv2[jtw] = fval2;
-        fsum = fval1+fval2;
-        resg += wg[j]*fsum;
-        resk += wgk[jtw]*fsum;
-        *resabs += wgk[jtw]*(fabs(fval1)+fabs(fval2));
+        absc = hlgth*qk21_xgk[jtw];
+        fv1[jtw] = (*f)(centr-absc, qpInfo);
+        fv2[jtw] = (*f)(centr+absc, qpInfo);
     }
 
-
-
     for (j = 1; j<=5; ++j) {
         jtwm1 = 2*j-1;
-        absc = hlgth*xgk[jtwm1];
-        fval1 = (*f)(centr-absc, qpInfo);
-        fval2 = (*f)(centr+absc, qpInfo);
-        fv1[jtwm1] = fval1;
-        fv2[jtwm1] = fval2;
-        fsum = fval1+fval2;
-        resk += wgk[jtwm1]*fsum;
-        *resabs += wgk[jtwm1]*(fabs(fval1)+fabs(fval2));
+        absc = hlgth*qk21_xgk[jtwm1];
+        fv1[jtwm1] = (*f)(centr-absc, qpInfo);
+        fv2[jtwm1] = (*f)(centr+absc, qpInfo);
     }
 
+    dqk21_sums( hlgth, fc, fv1, fv2, result, abserr, resabs, resasc );
 
 
-    reskh = resk*0.5;
-    *resasc = wgk[11]*fabs(fc-reskh);
+    return(1);
+
+}
 
-    for (j=1; j<=10; ++j) *resasc += wgk[j]*(fabs(fv1[j]-reskh)+fabs(fv2[j]-reskh));
 
-    *result = resk*hlgth;
-    *resabs *= dhlgth;
-    *resasc *= dhlgth;
-    *abserr = fabs((resk-resg)*hlgth);
 
-    if( (*resasc != 0.0) && (*abserr != 0.0)) *abserr = *resasc*dmin1( 1.0, pow(200.0*(*abserr)/(*resasc), 1.5) );
 
-    if ( *resabs > uflow/(50.0*epmach) ) *abserr = dmax1( (epmach*50.0)*(*resabs), *abserr );
 
+/*
+ *  dqk21() with a batch integrand. fv( 21, x, y, qpInfo ) must set y[i] =
+ *  f(x[i]) for the nodes
+ *
+ *      x[0]    = centr
+ *      x[j]    = centr - hlgth*xgk[j],     j = 1..10
+ *      x[10+j] = centr + hlgth*xgk[j],     j = 1..10
+ *
+ *  so that the integrand can be evaluated with vectorized code (and one call)
+ *  per interval. Gives the same result, abserr, resabs and resasc as dqk21().
+ */
+int dqk21v( void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        double *result, double *abserr, double *resabs, double *resasc ) {
+
+    double  absc, centr, hlgth, x[21], y[21], fv1[11], fv2[11];
+    int     j;
 
+    centr = 0.5*(a+b);
+    hlgth = 0.5*(b-a);
 
+    x[0] = centr;
+    for (j=1; j<=10; ++j) {
+        absc = hlgth*qk21_xgk[j];
+        x[j]    = centr-absc;
+        x[10+j] = centr+absc;
+    }
 
-    return(1);
+    (*fv)( 21, x, y, qpInfo );
 
+    for (j=1; j<=10; ++j) {
+        fv1[j] = y[j];
+        fv2[j] = y[10+j];
+    }
 
+    dqk21_sums( hlgth, y[0], fv1, fv2, result, abserr, resabs, resasc );
 
+    return(1);
 
 }
 
@@ -1373,7 +1488,6 @@ double  *resasc;        	  /*  */
 
 
 
-
 /*
  *      QUADPACK DQPSRT Routine converted to C
  */
@@ -1670,3 +1784,47 @@ void PrintQuadpackError( int ier ) {
     } 
 
 }
+
+
+
+
+/*
+ *  Make sure the work space w can be used with limit (or leniw) = Limit. The
+ *  arrays are only reallocated if they are too small. Returns TRUE on
+ *  success, FALSE if the allocation fails (w is left as it was).
+ */
+int Lgm_QuadPackWork_Reserve( int Limit, Lgm_QuadPackWork *w ) {
+
+    int     *iwork;
+    double  *work;
+
+    if ( ( Limit <= w->Limit ) && ( w->iwork != NULL ) && ( w->work != NULL ) ) return( TRUE );
+
+    iwork = (int *)calloc( Limit+2, sizeof(int) );
+    work  = (double *)calloc( 4*Limit+2, sizeof(double) );
+    if ( ( iwork == NULL ) || ( work == NULL ) ) {
+        printf("Lgm_QuadPackWork_Reserve: Error, could not allocate QuadPack work space for Limit = %d\n", Limit );
+        free( iwork ); free( work );
+        return( FALSE );
+    }
+
+    free( w->iwork ); free( w->work );
+    w->iwork = iwork;
+    w->work  = work;
+    w->Limit = Limit;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Release the work space.
+ */
+void Lgm_QuadPackWork_Free( Lgm_QuadPackWork *w ) {
+
+    free( w->iwork );   w->iwork = NULL;
+    free( w->work );    w->work  = NULL;
+    w->Limit = 0;
+
+}
@@ -1,10 +1,26 @@
 #include "Lgm/Lgm_QuadPack.h"
 
+/*
+ *  dqagp() and dqagpe() are thin wrappers around these. fv, when not NULL,
+ *  is used instead of f and gets all 21 nodes of an interval at once
+ *  (dqagpv(), dqagpev()).
+ */
+static int dqagp_vs( double (*f)( double, _qpInfo *), void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, double *result,
+        double *abserr, int *neval, int *ier, int leniw, int lenw, int *last,
+        int *iwork, double *work, int verbosity );
+static int dqagpe_vs( double (*f)( double, _qpInfo *), void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, int limit,
+        double *result, double *abserr, int *neval, int *ier, double *alist,
+        double *blist, double *rlist, double *elist, double *pts, int *iord,
+        int *level, int *ndin, int *last );
+
 /*
  *      QUADPACK DQAGP Routine converted to C 
  */
-int dqagp(f, qpInfo, a, b, npts2, points, epsabs, epsrel, result, abserr, neval, ier, leniw, lenw, last, iwork, work, verbosity )
+static int dqagp_vs(f, fv, qpInfo, a, b, npts2, points, epsabs, epsrel, result, abserr, neval, ier, leniw, lenw, last, iwork, work, verbosity )
 double  (*f)( double, _qpInfo *); /*  The integrand function -- I.e. the function to integrate    	 */
+void    (*fv)( int, const double *, double *, _qpInfo *); /*  Batch integrand (all 21 nodes of an interval at once), or NULL */
 _qpInfo *qpInfo;        	  /*  Auxilliary information to pass to function (to avoid making globals) */
 double   a;             	  /*  Lower Limit of integration.                                 	 */
 double   b;             	  /*  Upper limit of integration.                                 	 */
@@ -262,7 +278,7 @@ int	    verbosity;
         l4    = limit+l3;
 
 
-        dqagpe(f, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, 
+        dqagpe_vs(f, fv, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, 
 				work, work+l1, work+l2, work+l3, work+l4, iwork, iwork+l1, iwork+l2, last);
 
     }
@@ -292,8 +308,9 @@ int	    verbosity;
 /*
  *      QUADPACK DQAGPE Routine converted to C
  */
-int dqagpe(f, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, pts, iord, level, ndin, last)
+static int dqagpe_vs(f, fv, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, pts, iord, level, ndin, last)
 double  (*f)( double, _qpInfo *); /*  The integrand function -- I.e. the function to integrate           */
+void    (*fv)( int, const double *, double *, _qpInfo *); /*  Batch integrand (all 21 nodes of an interval at once), or NULL */
 _qpInfo *qpInfo;                  /*  Auxilliary information to pass to function (to avoid making globals) */
 double   a;             	  /*  Lower Limit of integration.                                 */
 double   b;             	  /*  Upper limit of integration.                                 */
@@ -668,7 +685,7 @@ int	*last;
     resabs = 0.0;
     for (i=1; i<=nint; i++){
         b1 = pts[i+1];
-        dqk21(f, qpInfo, a1, b1, &area1, &error1, &defabs, &resa);
+        LGM_QK21(f, fv, qpInfo, a1, b1, &area1, &error1, &defabs, &resa);
         *abserr += error1;
         *result += area1;
         ndin[i] = 0;
@@ -776,8 +793,8 @@ int	*last;
         a2 = b1;
         b2 = blist[maxerr];
         erlast = errmax;
-        dqk21(f, qpInfo, a1, b1, &area1, &error1, &resa, &defab1);
-        dqk21(f, qpInfo, a2, b2, &area2, &error2, &resa, &defab2);
+        LGM_QK21(f, fv, qpInfo, a1, b1, &area1, &error1, &resa, &defab1);
+        LGM_QK21(f, fv, qpInfo, a2, b2, &area2, &error2, &resa, &defab2);
 
 
 
@@ -1029,3 +1046,43 @@ L210:
 
 }
 
+
+
+
+
+/*
+ *  The usual one-point-at-a-time entry points.
+ */
+int dqagp( double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, double *result,
+        double *abserr, int *neval, int *ier, int leniw, int lenw, int *last,
+        int *iwork, double *work, int verbosity ) {
+    return( dqagp_vs( f, NULL, qpInfo, a, b, npts2, points, epsabs, epsrel, result, abserr, neval, ier, leniw, lenw, last, iwork, work, verbosity ) );
+}
+
+int dqagpe( double (*f)( double, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, int limit,
+        double *result, double *abserr, int *neval, int *ier, double *alist,
+        double *blist, double *rlist, double *elist, double *pts, int *iord,
+        int *level, int *ndin, int *last ) {
+    return( dqagpe_vs( f, NULL, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, pts, iord, level, ndin, last ) );
+}
+
+
+/*
+ *  Same as dqagp() and dqagpe(), but with a batch integrand (see dqagsv()).
+ */
+int dqagpv( void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, double *result,
+        double *abserr, int *neval, int *ier, int leniw, int lenw, int *last,
+        int *iwork, double *work, int verbosity ) {
+    return( dqagp_vs( NULL, fv, qpInfo, a, b, npts2, points, epsabs, epsrel, result, abserr, neval, ier, leniw, lenw, last, iwork, work, verbosity ) );
+}
+
+int dqagpev( void (*fv)( int, const double *, double *, _qpInfo *), _qpInfo *qpInfo, double a, double b,
+        int npts2, double *points, double epsabs, double epsrel, int limit,
+        double *result, double *abserr, int *neval, int *ier, double *alist,
+        double *blist, double *rlist, double *elist, double *pts, int *iord,
+        int *level, int *ndin, int *last ) {
+    return( dqagpe_vs( NULL, fv, qpInfo, a, b, npts2, points, epsabs, epsrel, limit, result, abserr, neval, ier, alist, blist, rlist, elist, pts, iord, level, ndin, last ) );
+}
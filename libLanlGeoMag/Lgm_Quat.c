@@ -21,9 +21,20 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include "Lgm/Lgm_Quat.h"
+#include "Lgm/Lgm_SimdMath.h"
+
+#if USE_OPENMP
+#define LGM_QUAT_SIMD   _Pragma( "omp simd" )
+#else
+#define LGM_QUAT_SIMD
+#endif
 
 /*
  * Print a quaternian
@@ -205,10 +216,12 @@ void Lgm_QuatToAxisAngle( double *Q, double *Angle, Lgm_Vector *u ) {
      */
     Lgm_NormalizeQuat( Q );
 
-    if ( (1.0-fabs(Q[3])) < 1e-8 ) {
+    SinAover2 = sqrt( Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2] );
+
+    if ( SinAover2 == 0.0 ) {
 
         /*
-         *  Rotation angle is close to zero
+         *  Rotation angle is zero
          *  (Its either A/2 = 0 (i.e. A = 0) or
          *  A/2 = 180 (i.e. A = 360))
          *  Rotation axis is arbitrary
@@ -221,24 +234,20 @@ void Lgm_QuatToAxisAngle( double *Q, double *Angle, Lgm_Vector *u ) {
     } else {
 
         /*
-         *  Determine Angle/2
+         *  Determine Angle/2. Use atan2() rather than acos( Q[3] ) -- the
+         *  latter loses about half the digits for small angles (and
+         *  interpolating between nearby orientations relies on those).
          */
-        Aover2 = acos( Q[3] );
+        Aover2 = atan2( SinAover2, Q[3] );
         *Angle = 2.0*Aover2*DegPerRad;
 
-        /* 
-         * Compute 1.0/sin(Angle/2)
-         */
-        SinAover2 = sqrt( 1.0 - Q[3]*Q[3] );
-        SinAover2_inv = 1.0/SinAover2;
-
         /*
          *  Compute components of rotation axis
          */
-        u->x = Q[0]*SinAover2;
-        u->y = Q[1]*SinAover2;
-        u->z = Q[2]*SinAover2;
-        Lgm_NormalizeVector( u );
+        SinAover2_inv = 1.0/SinAover2;
+        u->x = Q[0]*SinAover2_inv;
+        u->y = Q[1]*SinAover2_inv;
+        u->z = Q[2]*SinAover2_inv;
 
 
     }
@@ -463,6 +472,7 @@ void Lgm_QuatExp( double Q[4], double expQ[4] ) {
     u.y = Q[1];
     u.z = Q[2];
     Theta = Lgm_NormalizeVector( &u );
+    if ( Theta < 0.0 ) Theta = 0.0; // Q = 0 (Lgm_NormalizeVector() returns -1 for a zero vector)
     SinTheta = sin( Theta );
     CosTheta = cos( Theta );
 
@@ -652,7 +662,282 @@ printf("h not in range [0-1], h = %g   j=%ld i=%ld t[j] = %g T[i] = %g T[i+1] =
 
 
 
+/*
+ *  Array versions. Vectors are given as separate x, y, z arrays and
+ *  quaternion arrays are n x 4 (qx, qy, qz, qw for each). The quaternions
+ *  do not have to be normalized: instead of normalizing them, the 1/|Q|^2
+ *  (or 1/|Q|) is folded into the coefficients, so there is no extra pass
+ *  over the data. The inner loops are plain arithmetic so they vectorize.
+ */
+
+
+/*
+ *  Coefficients of the rotation by Q (the same expansion as
+ *  Lgm_QuatRotateVector(), divided by |Q|^2) as a 3x3 matrix, vp = R v.
+ */
+static inline void Quat_RotationCoeffs( const double *Q, double R[9] ) {
+
+    double  xx = Q[0]*Q[0], yy = Q[1]*Q[1], zz = Q[2]*Q[2], ww = Q[3]*Q[3];
+    double  xw = Q[0]*Q[3], yw = Q[1]*Q[3], zw = Q[2]*Q[3];
+    double  xy = Q[0]*Q[1], xz = Q[0]*Q[2], yz = Q[1]*Q[2];
+    double  f  = xx + yy + zz + ww, g;
+
+    f = ( f > 0.0 ) ? 1.0/f : 1.0;
+    g = 2.0*f;
+
+    R[0] = (ww + xx - yy - zz)*f; R[1] = (xy - zw)*g;             R[2] = (xz + yw)*g;
+    R[3] = (xy + zw)*g;           R[4] = (ww + yy - xx - zz)*f;   R[5] = (yz - xw)*g;
+    R[6] = (xz - yw)*g;           R[7] = (yz + xw)*g;             R[8] = (ww + zz - xx - yy)*f;
+
+}
+
+/**
+ *  \brief
+ *      Rotates n vectors by one quaternion.
+ *
+ *      \param[in]  Q:          The quaternion (need not be normalized).
+ *      \param[in]  n:          Number of vectors.
+ *      \param[in]  x, y, z:    Components of the vectors.
+ *      \param[out] xo, yo, zo: Components of the rotated vectors (may be the same arrays as x, y, z).
+ */
+void Lgm_QuatRotateVectors( double Q[4], long int n, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo ) {
+
+    long int    i;
+    double      R[9];
+
+    Quat_RotationCoeffs( Q, R );
+
+    LGM_QUAT_SIMD
+    for ( i=0; i<n; i++ ) {
+        double  vx = x[i], vy = y[i], vz = z[i];
+        xo[i] = R[0]*vx + R[1]*vy + R[2]*vz;
+        yo[i] = R[3]*vx + R[4]*vy + R[5]*vz;
+        zo[i] = R[6]*vx + R[7]*vy + R[8]*vz;
+    }
+
+}
+
+/**
+ *  \brief
+ *      Rotates each of n vectors by its own quaternion.
+ *
+ *      \param[in]  n:          Number of vectors.
+ *      \param[in]  Q:          n x 4 array of quaternions (need not be normalized).
+ *      \param[in]  x, y, z:    Components of the vectors.
+ *      \param[out] xo, yo, zo: Components of the rotated vectors (may be the same arrays as x, y, z).
+ */
+void Lgm_QuatRotateVectors_n( long int n, double *Q, const double *x, const double *y, const double *z, double *xo, double *yo, double *zo ) {
+
+    long int    i;
+
+    LGM_QUAT_SIMD
+    for ( i=0; i<n; i++ ) {
+        double  qx = Q[4*i], qy = Q[4*i+1], qz = Q[4*i+2], qw = Q[4*i+3];
+        double  vx = x[i], vy = y[i], vz = z[i], f, tx, ty, tz;
+
+        // v' = v + 2 q_v x ( q_v x v + qw v ) / |Q|^2
+        f  = qx*qx + qy*qy + qz*qz + qw*qw;
+        f  = ( f > 0.0 ) ? 2.0/f : 0.0;
+        tx = qy*vz - qz*vy + qw*vx;
+        ty = qz*vx - qx*vz + qw*vy;
+        tz = qx*vy - qy*vx + qw*vz;
+        xo[i] = vx + f*( qy*tz - qz*ty );
+        yo[i] = vy + f*( qz*tx - qx*tz );
+        zo[i] = vz + f*( qx*ty - qy*tx );
+    }
+
+}
+
+/*
+ *  Range checks the sample times and finds the interval [T[i], T[i+1]] (i
+ *  in 0..N-2) and fraction h of each one.
+ */
+static int Quat_SeriesIntervals( double *T, long int N, double *t, long int n, long int *Idx, double *h, char *Caller ) {
+
+    long int    j, i;
+
+    for ( j=0; j<n; j++ ) {
+        if ( ( t[j] < T[0] ) || ( t[j] > T[N-1] ) ) {
+            printf( "%s: Warning. Extrapolation required. t[%ld] = %g (T range is %g to %g)\n", Caller, j, t[j], T[0], T[N-1] );
+            return( -1 );
+        }
+        i = Lgm_QuatFindTimeIndex( T, N, t[j] );
+        if ( i < 0 )   i = 0;
+        if ( i > N-2 ) i = N-2;
+        Idx[j] = i;
+        h[j]   = ( T[i+1] > T[i] ) ? (t[j] - T[i])/(T[i+1] - T[i]) : 0.0;
+    }
+
+    return( 1 );
+
+}
+
+/*
+ *  Slerp weights of the two (unnormalized) end points P and Q: Qout =
+ *  a*P + b*Q. Theta comes from atan2() like Lgm_QuatToAxisAngle() does, and
+ *  the 1/|P| and 1/|Q| are folded into the weights.
+ */
+static void Quat_SlerpSetup( const double *P, const double *Q, double *Theta, double *InvSin, double *InvP, double *InvQ ) {
+
+    double  np, nq, c, s, cx, cy, cz;
+
+    np = sqrt( P[0]*P[0] + P[1]*P[1] + P[2]*P[2] + P[3]*P[3] );
+    nq = sqrt( Q[0]*Q[0] + Q[1]*Q[1] + Q[2]*Q[2] + Q[3]*Q[3] );
+    *InvP = ( np > 0.0 ) ? 1.0/np : 0.0;
+    *InvQ = ( nq > 0.0 ) ? 1.0/nq : 0.0;
+
+    // real and vector parts of conj(P) Q
+    c  = P[3]*Q[3] + P[0]*Q[0] + P[1]*Q[1] + P[2]*Q[2];
+    cx = P[3]*Q[0] - P[0]*Q[3] - P[1]*Q[2] + P[2]*Q[1];
+    cy = P[3]*Q[1] + P[0]*Q[2] - P[1]*Q[3] - P[2]*Q[0];
+    cz = P[3]*Q[2] - P[0]*Q[1] + P[1]*Q[0] - P[2]*Q[3];
+    s  = sqrt( cx*cx + cy*cy + cz*cz );
+
+    *Theta  = atan2( s, c );
+    s      *= (*InvP)*(*InvQ);
+    *InvSin = ( s > 1e-8 ) ? 1.0/s : 0.0;   // 0 flags "use linear weights"
+
+}
+
+/**
+ *  \brief
+ *      SLERP interpolation of a quaternion series.
+ *  \details
+ *      Same result as Lgm_QuatSlerp() between the bracketing control
+ *      points (for normalized quaternions), but the angle of each interval
+ *      is found once and the samples are done in one vectorized loop.
+ *
+ *          \param[in]  T: array of N control point times (increasing).
+ *          \param[in]  Q: N x 4 array of control quaternions (need not be normalized).
+ *          \param[in]  N: number of control points (at least 2).
+ *          \param[in]  t: array of n times to interpolate to (within [T[0], T[N-1]]).
+ *          \param[out] q: n x 4 array of resulting (unit) quaternions.
+ *          \param[in]  n: number of samples.
+ *
+ *          \returns    1 on success, -1 if N < 2 or a t is outside the series.
+ */
+int Lgm_QuatSlerpSeries( double *T, double *Q, long int N, double *t, double *q, long int n ) {
+
+    long int    i, j, *Idx;
+    double      *h, *Theta, *InvSin, *InvMag, Dummy;
+
+    if ( N < 2 ) {
+        printf( "Lgm_QuatSlerpSeries: Not enough points to interpolate: N = %ld\n", N );
+        return( -1 );
+    }
+
+    Idx    = (long int *) malloc( (n+1)*sizeof(long int) );
+    h      = (double *) malloc( (n+1)*sizeof(double) );
+    Theta  = (double *) malloc( N*sizeof(double) );
+    InvSin = (double *) malloc( N*sizeof(double) );
+    InvMag = (double *) malloc( N*sizeof(double) );
+
+    if ( Quat_SeriesIntervals( T, N, t, n, Idx, h, "Lgm_QuatSlerpSeries" ) < 0 ) {
+        free( Idx ); free( h ); free( Theta ); free( InvSin ); free( InvMag );
+        return( -1 );
+    }
+    for ( i=0; i<N-1; i++ ) Quat_SlerpSetup( &Q[4*i], &Q[4*(i+1)], &Theta[i], &InvSin[i], &InvMag[i], ( i == N-2 ) ? &InvMag[N-1] : &Dummy );
+
+    LGM_QUAT_SIMD
+    for ( j=0; j<n; j++ ) {
+        long int    k = Idx[j];
+        double      hh = h[j], th = Theta[k], is = InvSin[k], a, b;
+        a = ( is > 0.0 ) ? Lgm_SimdSin( (1.0-hh)*th )*is : 1.0-hh;
+        b = ( is > 0.0 ) ? Lgm_SimdSin( hh*th )*is       : hh;
+        a *= InvMag[k]; b *= InvMag[k+1];
+        q[4*j]   = a*Q[4*k]   + b*Q[4*k+4];
+        q[4*j+1] = a*Q[4*k+1] + b*Q[4*k+5];
+        q[4*j+2] = a*Q[4*k+2] + b*Q[4*k+6];
+        q[4*j+3] = a*Q[4*k+3] + b*Q[4*k+7];
+    }
+
+    free( Idx ); free( h ); free( Theta ); free( InvSin ); free( InvMag );
+
+    return( 1 );
+
+}
+
+/*
+ *  Closed form slerp of two unit quaternions (see Quat_SlerpSetup()).
+ */
+static void Quat_Slerp( const double *P, const double *Q, double h, double *Out ) {
+
+    double  Theta, InvSin, InvP, InvQ, a, b;
+    int     k;
+
+    Quat_SlerpSetup( P, Q, &Theta, &InvSin, &InvP, &InvQ );
+    a = ( InvSin > 0.0 ) ? sin( (1.0-h)*Theta )*InvSin : 1.0-h;
+    b = ( InvSin > 0.0 ) ? sin( h*Theta )*InvSin       : h;
+    a *= InvP; b *= InvQ;
+    for ( k=0; k<4; k++ ) Out[k] = a*P[k] + b*Q[k];
+
+}
+
+/**
+ *  \brief
+ *      SQUAD interpolation of a quaternion series.
+ *  \details
+ *      Like Lgm_QuatSquadInterp(), but the control quaternions are
+ *      normalized and the auxiliary points s_i (Eqn 6.15 of Dam et al.)
+ *      computed once for the whole series rather than twice per sample,
+ *      and the slerps are done in closed form. The end intervals use s_0 =
+ *      Q_0 and s_N-1 = Q_N-1, so (unlike Lgm_QuatSquadInterp()) they are
+ *      interpolated with SQUAD as well. Samples are done in parallel.
+ *
+ *          \param[in]  T: array of N control point times (increasing).
+ *          \param[in]  Q: N x 4 array of control quaternions (need not be normalized).
+ *          \param[in]  N: number of control points (at least 2).
+ *          \param[in]  t: array of n times to interpolate to (within [T[0], T[N-1]]).
+ *          \param[out] q: n x 4 array of resulting (unit) quaternions.
+ *          \param[in]  n: number of samples.
+ *
+ *          \returns    1 on success, -1 if N < 2 or a t is outside the series.
+ */
+int Lgm_QuatSquadSeries( double *T, double *Q, long int N, double *t, double *q, long int n ) {
 
+    long int    i, j, *Idx;
+    double      *h, *U, *S;
 
+    if ( N < 2 ) {
+        printf( "Lgm_QuatSquadSeries: Not enough points to interpolate: N = %ld\n", N );
+        return( -1 );
+    }
 
+    Idx = (long int *) malloc( (n+1)*sizeof(long int) );
+    h   = (double *) malloc( (n+1)*sizeof(double) );
+    U   = (double *) malloc( 4*N*sizeof(double) );
+    S   = (double *) malloc( 4*N*sizeof(double) );
 
+    if ( Quat_SeriesIntervals( T, N, t, n, Idx, h, "Lgm_QuatSquadSeries" ) < 0 ) {
+        free( Idx ); free( h ); free( U ); free( S );
+        return( -1 );
+    }
+
+    for ( i=0; i<N; i++ ) {
+        U[4*i] = Q[4*i]; U[4*i+1] = Q[4*i+1]; U[4*i+2] = Q[4*i+2]; U[4*i+3] = Q[4*i+3];
+        Lgm_NormalizeQuat( &U[4*i] );
+    }
+    for ( i=0; i<N; i++ ) {
+        if ( ( i == 0 ) || ( i == N-1 ) ) {
+            S[4*i] = U[4*i]; S[4*i+1] = U[4*i+1]; S[4*i+2] = U[4*i+2]; S[4*i+3] = U[4*i+3];
+        } else {
+            Lgm_QuatSquadComputeAuxPoint( &U[4*(i-1)], &U[4*i], &U[4*(i+1)], &S[4*i] );
+        }
+    }
+
+#if USE_OPENMP
+    #pragma omp parallel for schedule(static) if(n > 1000)
+#endif
+    for ( j=0; j<n; j++ ) {
+        long int    k = Idx[j];
+        double      A[4], B[4];
+        Quat_Slerp( &U[4*k], &U[4*k+4], h[j], A );
+        Quat_Slerp( &S[4*k], &S[4*k+4], h[j], B );
+        Quat_Slerp( A, B, 2.0*h[j]*(1.0-h[j]), &q[4*j] );
+    }
+
+    free( Idx ); free( h ); free( U ); free( S );
+
+    return( 1 );
+
+}
@@ -0,0 +1,268 @@
+/*! \file Lgm_RBF_Cache.c
+ *
+ *  \brief Cache of fitted RBF interpolants that can be shared between threads.
+ *
+ *  Lgm_B_FromScatteredData4() and Lgm_B_FromScatteredData5() fit an RBF to
+ *  the K nearest neighbors of each point they are asked about, and keep the
+ *  fits in a hash table (keyed on the sorted neighbor Id's) in the
+ *  Lgm_MagModelInfo. Every thread works on its own copy of the
+ *  Lgm_MagModelInfo though, so threads tracing through the same region each
+ *  do the same fits. If an Lgm_RBF_Cache is given to them (with
+ *  Lgm_B_FromScatteredData_SetCache()), they use it instead and share fits.
+ *
+ *  The table is split into LGM_RBF_CACHE_NSHARDS shards (picked by a hash of
+ *  the key), each with its own lock, so threads only contend when they hit
+ *  the same shard. Each shard holds at most MaxSize/LGM_RBF_CACHE_NSHARDS MB
+ *  of fits. When a shard is full, entries are evicted in approximate LRU
+ *  order with the "clock" (second chance) scheme: entries are visited in
+ *  insertion order and ones that have been used since the last visit are
+ *  moved to the back instead of being evicted.
+ *
+ *  Entries handed out by Lgm_RBF_Cache_Get() or Lgm_RBF_Cache_Add() stay
+ *  valid until Lgm_RBF_Cache_Release() is called, even if they are evicted
+ *  in the meantime.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Lgm/Lgm_RBF.h"
+#if USE_OPENMP
+#include <omp.h>
+#endif
+
+#if USE_OPENMP
+#define RBF_CACHE_LOCK( s )     omp_set_lock( (omp_lock_t *)(s)->Lock )
+#define RBF_CACHE_UNLOCK( s )   omp_unset_lock( (omp_lock_t *)(s)->Lock )
+#else
+#define RBF_CACHE_LOCK( s )
+#define RBF_CACHE_UNLOCK( s )
+#endif
+
+
+/*
+ *  FNV-1a hash of the key. Picks the shard.
+ */
+static Lgm_RBF_CacheShard *RBF_Cache_Shard( Lgm_RBF_Cache *c, unsigned long int *Key, int KeyLength ) {
+
+    const unsigned char *b = (const unsigned char *)Key;
+    unsigned long       h = 14695981039346656037UL;
+    int                 i;
+
+    for ( i=0; i<KeyLength; ++i ) {
+        h ^= b[i];
+        h *= 1099511628211UL;
+    }
+
+    return( &c->Shard[ (h ^ (h >> 32)) % LGM_RBF_CACHE_NSHARDS ] );
+
+}
+
+static void RBF_Cache_FreeEntry( Lgm_RBF_CacheEntry *e ) {
+    Lgm_Vec_RBF_Free( e->rbf );
+    if ( e->rbf_e ) Lgm_Vec_RBF_Free( e->rbf_e );
+    free( e );
+}
+
+
+/*
+ *  Allocate an empty cache that holds up to MaxSize MB of fits (<= 0 gives
+ *  2000 MB, the same limit Lgm_B_FromScatteredData5_SetUp() uses).
+ */
+Lgm_RBF_Cache *Lgm_InitRBFCache( double MaxSize ) {
+
+    Lgm_RBF_Cache   *c;
+    int             i;
+
+    c = (Lgm_RBF_Cache *) calloc( 1, sizeof( Lgm_RBF_Cache ) );
+    c->MaxSize = ( MaxSize > 0.0 ) ? MaxSize : 2000.0;
+    for ( i=0; i<LGM_RBF_CACHE_NSHARDS; i++ ) {
+        c->Shard[i].ht = NULL;
+#if USE_OPENMP
+        c->Shard[i].Lock = malloc( sizeof( omp_lock_t ) );
+        omp_init_lock( (omp_lock_t *)c->Shard[i].Lock );
+#endif
+    }
+
+    return( c );
+
+}
+
+
+/*
+ *  Free the cache and everything in it. No entries may still be in use.
+ */
+void Lgm_FreeRBFCache( Lgm_RBF_Cache *c ) {
+
+    Lgm_RBF_CacheEntry  *e, *tmp;
+    int                 i;
+
+    if ( c == NULL ) return;
+
+    for ( i=0; i<LGM_RBF_CACHE_NSHARDS; i++ ) {
+        HASH_ITER( hh, c->Shard[i].ht, e, tmp ) {
+            HASH_DELETE( hh, c->Shard[i].ht, e );
+            RBF_Cache_FreeEntry( e );
+        }
+#if USE_OPENMP
+        omp_destroy_lock( (omp_lock_t *)c->Shard[i].Lock );
+        free( c->Shard[i].Lock );
+#endif
+    }
+    free( c );
+
+}
+
+
+/*
+ *  Look up the fit for the (sorted) neighbor Id's in Key[0..nKey-1].
+ *  Returns NULL on a miss. A hit must be handed back with
+ *  Lgm_RBF_Cache_Release() when the caller is done with it.
+ */
+Lgm_RBF_CacheEntry *Lgm_RBF_Cache_Get( Lgm_RBF_Cache *c, unsigned long int *Key, int nKey ) {
+
+    Lgm_RBF_CacheEntry  *e = NULL;
+    Lgm_RBF_CacheShard  *s;
+    int                 KeyLength = nKey*sizeof( unsigned long int );
+
+    s = RBF_Cache_Shard( c, Key, KeyLength );
+
+    RBF_CACHE_LOCK( s );
+    HASH_FIND( hh, s->ht, Key, KeyLength, e );
+    if ( e ) {
+        ++(e->nUsers);
+        e->Referenced = 1;
+        ++(s->nHits);
+    } else {
+        ++(s->nMisses);
+    }
+    RBF_CACHE_UNLOCK( s );
+
+    return( e );
+
+}
+
+
+/*
+ *  Add a fit to the cache. rbf->LookUpKey (its sorted neighbor Id's) is the
+ *  key, and rbf_e (which may be NULL) is another fit done with the same
+ *  neighbors. The cache takes ownership of both. If another thread added the
+ *  same key first, rbf and rbf_e are freed and the existing entry is
+ *  returned instead. Either way the returned entry must be handed back with
+ *  Lgm_RBF_Cache_Release().
+ */
+Lgm_RBF_CacheEntry *Lgm_RBF_Cache_Add( Lgm_RBF_Cache *c, Lgm_Vec_RBF_Info *rbf, Lgm_Vec_RBF_Info *rbf_e ) {
+
+    Lgm_RBF_CacheEntry  *e = NULL, *Old;
+    Lgm_RBF_CacheShard  *s;
+    int                 KeyLength = rbf->n*sizeof( unsigned long int );
+    double              MaxSize = c->MaxSize/(double)LGM_RBF_CACHE_NSHARDS;
+
+    s = RBF_Cache_Shard( c, rbf->LookUpKey, KeyLength );
+
+    RBF_CACHE_LOCK( s );
+
+    HASH_FIND( hh, s->ht, rbf->LookUpKey, KeyLength, e );
+    if ( e ) {
+
+        ++(e->nUsers);
+        e->Referenced = 1;
+
+    } else {
+
+        e = (Lgm_RBF_CacheEntry *) calloc( 1, sizeof( Lgm_RBF_CacheEntry ) );
+        e->rbf       = rbf;
+        e->rbf_e     = rbf_e;
+        e->KeyLength = KeyLength;
+        e->size      = rbf->size + ( ( rbf_e ) ? rbf_e->size : 0.0 );
+        e->nUsers    = 1;
+
+        /*
+         * Make room. The head of the table is where the clock hand is.
+         */
+        while ( ( s->size + e->size > MaxSize ) && ( s->ht != NULL ) ) {
+            Old = s->ht;
+            HASH_DELETE( hh, s->ht, Old );
+            if ( Old->Referenced ) {
+                // second chance -- move it to the back.
+                Old->Referenced = 0;
+                HASH_ADD_KEYPTR( hh, s->ht, Old->rbf->LookUpKey, Old->KeyLength, Old );
+            } else {
+                s->size -= Old->size;
+                --(s->nEntries);
+                ++(s->nEvictions);
+                if ( Old->nUsers > 0 ) Old->Evicted = 1;    // whoever releases it last frees it
+                else                   RBF_Cache_FreeEntry( Old );
+            }
+        }
+
+        HASH_ADD_KEYPTR( hh, s->ht, e->rbf->LookUpKey, e->KeyLength, e );
+        s->size += e->size;
+        ++(s->nEntries);
+        ++(s->nAdds);
+
+    }
+
+    RBF_CACHE_UNLOCK( s );
+
+    if ( e->rbf != rbf ) {
+        Lgm_Vec_RBF_Free( rbf );
+        if ( rbf_e ) Lgm_Vec_RBF_Free( rbf_e );
+    }
+
+    return( e );
+
+}
+
+
+/*
+ *  Hand back an entry obtained from Lgm_RBF_Cache_Get() or Lgm_RBF_Cache_Add().
+ */
+void Lgm_RBF_Cache_Release( Lgm_RBF_Cache *c, Lgm_RBF_CacheEntry *e ) {
+
+    Lgm_RBF_CacheShard  *s;
+    int                 Free;
+
+    if ( e == NULL ) return;
+    s = RBF_Cache_Shard( c, e->rbf->LookUpKey, e->KeyLength );
+
+    RBF_CACHE_LOCK( s );
+    --(e->nUsers);
+    Free = ( e->Evicted && ( e->nUsers == 0 ) );
+    RBF_CACHE_UNLOCK( s );
+
+    if ( Free ) RBF_Cache_FreeEntry( e );
+
+}
+
+
+/*
+ *  Totals over all of the shards. Any of the pointers may be NULL.
+ */
+void Lgm_RBF_Cache_Stats( Lgm_RBF_Cache *c, long int *nHits, long int *nMisses, long int *nAdds, long int *nEvictions, long int *nEntries, double *size ) {
+
+    long int    h = 0, m = 0, a = 0, ev = 0, n = 0;
+    double      sz = 0.0;
+    int         i;
+
+    for ( i=0; i<LGM_RBF_CACHE_NSHARDS; i++ ) {
+        RBF_CACHE_LOCK( &c->Shard[i] );
+        h  += c->Shard[i].nHits;
+        m  += c->Shard[i].nMisses;
+        a  += c->Shard[i].nAdds;
+        ev += c->Shard[i].nEvictions;
+        n  += c->Shard[i].nEntries;
+        sz += c->Shard[i].size;
+        RBF_CACHE_UNLOCK( &c->Shard[i] );
+    }
+
+    if ( nHits )      *nHits      = h;
+    if ( nMisses )    *nMisses    = m;
+    if ( nAdds )      *nAdds      = a;
+    if ( nEvictions ) *nEvictions = ev;
+    if ( nEntries )   *nEntries   = n;
+    if ( size )       *size       = sz;
+
+}
@@ -0,0 +1,976 @@
+/*! \file Lgm_RBF_Snapshot.c
+ *
+ *  \brief Precomputed partition of unity RBF fits to scattered data (LGM_EXTMODEL_RBF_SNAPSHOT).
+ *
+ *  Lgm_B_FromScatteredData5() finds the K nearest data points and fits an
+ *  RBF to them (or finds the fit in a cache) every time B is needed, and the
+ *  KdTree and the cache have to be rebuilt every run. When the same MHD
+ *  timestep is analysed over and over, all of that can be done once.
+ *
+ *  Lgm_RBF_Snapshot_Write() cuts a box into cubic cells of side h, fits a
+ *  Lgm_Vec_RBF (with Lgm_Vec_RBF_Fit(), using the K data points nearest the
+ *  cell center and the same per-point eps rule as
+ *  Lgm_B_FromScatteredData5()) to B (and E) in each cell, and writes the
+ *  centers and weights to a file (the layout is described in
+ *  Lgm/Lgm_RBF_Snapshot.h). Lgm_RBF_Snapshot_Open() maps the file, and
+ *  Lgm_RBF_Snapshot_Eval() evaluates the fits in place, so there is no
+ *  fitting, no kNN search and nothing to allocate at run time.
+ *
+ *  The fits are blended with a partition of unity. Cell c gets the weight
+ *
+ *      w_c = (1-r)^4 (4r+1),    r = |x - x_c|/R   (0 for r > 1)
+ *
+ *  (the Wendland C2 function), where x_c is the cell center, and
+ *
+ *      B(x) = Sum_c w_c B_c(x) / Sum_c w_c.
+ *
+ *  With R greater than the half diagonal of a cell (sqrt(3)/2 h) every point
+ *  in the box is covered by at least its own cell, and B is smooth across
+ *  cell boundaries. Each cell's fit has to be good out to R from its center,
+ *  so the K points should reach well past R: a sphere of radius 2R should
+ *  hold no more than about 2K/3 data points. (Too small a K shows up on
+ *  regular grids, where cell centers are often equidistant from many points
+ *  and the K nearest are then a lopsided piece of a shell.)
+ *
+ *  Once open, a Lgm_RBF_Snapshot is read-only and can be shared by any
+ *  number of Lgm_MagModelInfo structures (and threads). Lgm_CopyMagInfo()
+ *  copies the pointer.
+ *
+ *  Usage:
+ *
+ *      KdTree = Lgm_KdTree_Init( Positions, Objects, n, 3 ); // Objects point at {Bx, By, Bz, Ex, Ey, Ez}
+ *      Lgm_RBF_Snapshot_Write( "snap.rbf", KdTree, TRUE, -30.0, 10.0, -20.0, 20.0, -20.0, 20.0, 0.25, 0.3, 1.5, 40, 4.0, LGM_RBF_GAUSSIAN );
+ *      ...
+ *      s = Lgm_RBF_Snapshot_Open( "snap.rbf" );
+ *      Lgm_MagModelInfo_Set_RBF_Snapshot( s, mInfo ); // also sets mInfo->Bfield = Lgm_B_FromRBF_Snapshot
+ *      ...
+ *      Lgm_RBF_Snapshot_Close( s );
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_RBF_Snapshot.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+
+
+#define LGM_RBFS_MIN_POINTS     4           // Dont fit cells with fewer points than this
+
+
+static uint64_t RBFS_Align( uint64_t n ) {
+    return( ( n + LGM_RBFS_ALIGN - 1 )/LGM_RBFS_ALIGN*LGM_RBFS_ALIGN );
+}
+
+/*
+ *  pwrite() all of it (pwrite() may write less than asked for).
+ */
+static int RBFS_PWrite( int fd, const void *buf, size_t n, uint64_t Offset ) {
+    const char  *p = (const char *)buf;
+    ssize_t     k;
+    while ( n > 0 ) {
+        if ( (k = pwrite( fd, p, n, (off_t)Offset )) <= 0 ) return( FALSE );
+        p += k; n -= (size_t)k; Offset += (uint64_t)k;
+    }
+    return( TRUE );
+}
+
+static int RBFS_KernelOk( int RadialBasisFunction ) {
+    return( ( RadialBasisFunction == LGM_RBF_GAUSSIAN ) || ( RadialBasisFunction == LGM_RBF_MULTIQUADRIC )
+                || ( RadialBasisFunction == LGM_RBF_INV_MULTIQUADRIC ) );
+}
+
+
+/*
+ *  Fit one cell. On success the centers, eps's and weights go into
+ *  Buf[a][0..n-1] and n is returned, otherwise 0 is returned.
+ */
+static int RBFS_FitCell( Lgm_KdTreeData *kNN, int n, int HaveE, int RadialBasisFunction, double **Buf,
+                         unsigned long int *I_data, Lgm_Vector *v_data, Lgm_Vector *B_data, Lgm_Vector *E_data,
+                         double *eps, Lgm_Vec_RBF_Info *rbf, Lgm_Vec_RBF_Work *w ) {
+
+    int     i, j;
+    double  *bbb, dx, dy, dz, d2, d2min;
+
+    for ( i=0; i<n; i++ ) {
+        v_data[i].x = kNN[i].Position[0];
+        v_data[i].y = kNN[i].Position[1];
+        v_data[i].z = kNN[i].Position[2];
+        bbb = (double *)kNN[i].Object;
+        B_data[i].x = bbb[0]; B_data[i].y = bbb[1]; B_data[i].z = bbb[2];
+        if ( HaveE ) { E_data[i].x = bbb[3]; E_data[i].y = bbb[4]; E_data[i].z = bbb[5]; }
+        I_data[i] = kNN[i].Id;
+    }
+
+    /*
+     *  eps for each point from the distance to its nearest neighbor (as in
+     *  Lgm_B_FromScatteredData5()).
+     */
+    for ( i=0; i<n; i++ ) {
+        for ( d2min = 9e99, j=0; j<n; j++ ) {
+            if ( j != i ) {
+                dx = v_data[i].x - v_data[j].x; dy = v_data[i].y - v_data[j].y; dz = v_data[i].z - v_data[j].z;
+                d2 = dx*dx + dy*dy + dz*dz;
+                if ( d2 < d2min ) d2min = d2;
+            }
+        }
+        if ( d2min <= 0.0 ) return( 0 ); // duplicate points
+        eps[i] = 1.0/(d2min*8.0*8.0);
+    }
+
+    if ( !Lgm_Vec_RBF_Fit( I_data, v_data, B_data, eps, eps, eps, n, RadialBasisFunction, rbf, w ) ) return( 0 );
+    for ( i=0; i<n; i++ ) {
+        Buf[LGM_RBFS_X][i]     = v_data[i].x;
+        Buf[LGM_RBFS_Y][i]     = v_data[i].y;
+        Buf[LGM_RBFS_Z][i]     = v_data[i].z;
+        Buf[LGM_RBFS_EPS_X][i] = eps[i];
+        Buf[LGM_RBFS_EPS_Y][i] = eps[i];
+        Buf[LGM_RBFS_EPS_Z][i] = eps[i];
+        Buf[LGM_RBFS_CBX][i]   = rbf->cx_new[i];
+        Buf[LGM_RBFS_CBY][i]   = rbf->cy_new[i];
+        Buf[LGM_RBFS_CBZ][i]   = rbf->cz_new[i];
+    }
+
+    if ( HaveE ) {
+        if ( !Lgm_Vec_RBF_Fit( I_data, v_data, E_data, eps, eps, eps, n, RadialBasisFunction, rbf, w ) ) return( 0 );
+        for ( i=0; i<n; i++ ) {
+            Buf[LGM_RBFS_CEX][i] = rbf->cx_new[i];
+            Buf[LGM_RBFS_CEY][i] = rbf->cy_new[i];
+            Buf[LGM_RBFS_CEZ][i] = rbf->cz_new[i];
+        }
+    }
+
+    return( n );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Fit RBFs to scattered data cell by cell and write them to a snapshot file.
+ *
+ *  \details
+ *      The box is divided into cells of side h (the last cell in each
+ *      direction may stick out past xmax, etc.). For each cell whose center
+ *      is outside Rmin, the K points (within sqrt(MaxDist2)) nearest the
+ *      center are fit. Cells with fewer than 4 points, or where the fit
+ *      fails, are left without a fit. The work is done a layer of cells at
+ *      a time, and with OpenMP the fits in a layer are done in parallel.
+ *
+ *      \param[in]      Filename            File to write (overwritten if it exists).
+ *      \param[in]      KdTree              3D KdTree of the data. Each Object must point to 3 doubles (Bx, By, Bz), or to 6 (Bx, By, Bz, Ex, Ey, Ez) if HaveE is set (the layout Lgm_B_FromScatteredData5() uses).
+ *      \param[in]      HaveE               Also fit E.
+ *      \param[in]      xmin, xmax          Extent of the box.
+ *      \param[in]      ymin, ymax
+ *      \param[in]      zmin, zmax
+ *      \param[in]      h                   Cell size.
+ *      \param[in]      R                   Radius of the blending weights. Must be more than sqrt(3)/2 h. (<= 0 gives 1.2*sqrt(3)/2 h.)
+ *      \param[in]      Rmin                Cells with centers inside this radius get no fit.
+ *      \param[in]      K                   Max number of points in each fit.
+ *      \param[in]      MaxDist2            Max (squared) distance of points from the cell center.
+ *      \param[in]      RadialBasisFunction LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC or LGM_RBF_INV_MULTIQUADRIC.
+ *
+ *      \return         TRUE on success, or FALSE if the arguments are bad or the file could not be written.
+ *
+ */
+int Lgm_RBF_Snapshot_Write( char *Filename, Lgm_KdTree *KdTree, int HaveE, double xmin, double xmax, double ymin, double ymax, double zmin, double zmax,
+                            double h, double R, double Rmin, int K, double MaxDist2, int RadialBasisFunction ) {
+
+    int                     fd, i, j, k, a, nx, ny, nz, nq, c, nArrays, Status, *Kgot, *nCell;
+    uint64_t                Offset, nS, First;
+    double                  *Q[3], *Buf[LGM_RBFS_NARRAYS], x, y, z;
+    Lgm_KdTreeData          *kNN;
+    Lgm_RBF_SnapshotHeader  Header;
+    Lgm_RBF_SnapshotSlab    *Slabs;
+    Lgm_RBF_SnapshotCell    *Cells;
+
+    if ( R <= 0.0 ) R = 1.2*0.5*sqrt(3.0)*h;
+    if ( (h <= 0.0) || (R <= 0.5*sqrt(3.0)*h) || (K < LGM_RBFS_MIN_POINTS) || !RBFS_KernelOk( RadialBasisFunction )
+            || (KdTree == NULL) || (KdTree->kNN_Lookups < 0) || (xmax <= xmin) || (ymax <= ymin) || (zmax <= zmin) ) {
+        fprintf( stderr, "Lgm_RBF_Snapshot_Write(): Bad arguments (need h > 0, R > sqrt(3)/2 h, K >= %d, a non-empty box and a Gaussian or (inverse) multiquadric RBF).\n", LGM_RBFS_MIN_POINTS );
+        return( FALSE );
+    }
+
+    nx = (int)ceil( (xmax-xmin)/h );
+    ny = (int)ceil( (ymax-ymin)/h );
+    nz = (int)ceil( (zmax-zmin)/h );
+    nq = nx*ny;
+    nArrays = HaveE ? LGM_RBFS_NARRAYS : LGM_RBFS_CBZ+1;
+
+    if ( (fd = open( Filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) < 0 ) {
+        fprintf( stderr, "Lgm_RBF_Snapshot_Write(): Could not open %s for writing.\n", Filename );
+        return( FALSE );
+    }
+
+    memset( &Header, 0, sizeof(Header) );
+    memcpy( Header.Magic, LGM_RBFS_MAGIC, 8 );
+    Header.Version             = LGM_RBFS_VERSION;
+    Header.RadialBasisFunction = RadialBasisFunction;
+    Header.HaveE               = HaveE ? 1 : 0;
+    Header.nArrays             = nArrays;
+    Header.K                   = K;
+    Header.nx = nx; Header.ny = ny; Header.nz = nz;
+    Header.Min[0] = xmin; Header.Min[1] = ymin; Header.Min[2] = zmin;
+    Header.h      = h;
+    Header.R      = R;
+    Header.Rmin   = Rmin;
+    Header.nCells = (uint64_t)nq*nz;
+    Header.SlabOffset = RBFS_Align( sizeof(Lgm_RBF_SnapshotHeader) );
+    Header.CellOffset = Header.SlabOffset + nz*sizeof(Lgm_RBF_SnapshotSlab);
+    Offset = RBFS_Align( Header.CellOffset + Header.nCells*sizeof(Lgm_RBF_SnapshotCell) );
+
+    Slabs = (Lgm_RBF_SnapshotSlab *)calloc( nz, sizeof(Lgm_RBF_SnapshotSlab) );
+    Cells = (Lgm_RBF_SnapshotCell *)calloc( Header.nCells, sizeof(Lgm_RBF_SnapshotCell) );
+    for ( j=0; j<3; j++ ) LGM_ARRAY_1D( Q[j], nq, double );
+    for ( a=0; a<nArrays; a++ ) LGM_ARRAY_1D( Buf[a], (long int)nq*K, double );
+    LGM_ARRAY_1D( Kgot,  nq, int );
+    LGM_ARRAY_1D( nCell, nq, int );
+    LGM_ARRAY_1D( kNN,   (long int)nq*K, Lgm_KdTreeData );
+
+    Status = TRUE;
+    for ( k=0; Status && (k<nz); k++ ) {
+
+        /*
+         *  Find the neighbors of all the cell centers in this layer.
+         */
+        z = zmin + (k+0.5)*h;
+        for ( j=0; j<ny; j++ ) {
+            y = ymin + (j+0.5)*h;
+            for ( i=0; i<nx; i++ ) {
+                x = xmin + (i+0.5)*h;
+                Q[0][j*nx+i] = x; Q[1][j*nx+i] = y; Q[2][j*nx+i] = z;
+            }
+        }
+        Lgm_KdTree_kNN_Batch( KdTree, nq, Q, K, MaxDist2, Kgot, kNN );
+
+
+        /*
+         *  Fit them. Each cell's results go to its own K-long stretch of Buf.
+         */
+#if USE_OPENMP
+        #pragma omp parallel private(c,a)
+#endif
+        {
+            unsigned long int   *I_data;
+            Lgm_Vector          *v_data, *B_data, *E_data;
+            double              *eps, *CellBuf[LGM_RBFS_NARRAYS], r2;
+            Lgm_Vec_RBF_Info    *rbf = Lgm_Vec_RBF_AllocInfo( K );
+            Lgm_Vec_RBF_Work    *w   = Lgm_Vec_RBF_AllocWork( K );
+
+            LGM_ARRAY_1D( I_data, K, unsigned long int );
+            LGM_ARRAY_1D( v_data, K, Lgm_Vector );
+            LGM_ARRAY_1D( B_data, K, Lgm_Vector );
+            LGM_ARRAY_1D( E_data, K, Lgm_Vector );
+            LGM_ARRAY_1D( eps,    K, double );
+
+#if USE_OPENMP
+            #pragma omp for schedule(dynamic,16)
+#endif
+            for ( c=0; c<nq; c++ ) {
+                r2 = Q[0][c]*Q[0][c] + Q[1][c]*Q[1][c] + Q[2][c]*Q[2][c];
+                nCell[c] = 0;
+                if ( (r2 >= Rmin*Rmin) && (Kgot[c] >= LGM_RBFS_MIN_POINTS) ) {
+                    for ( a=0; a<nArrays; a++ ) CellBuf[a] = Buf[a] + (long int)c*K;
+                    nCell[c] = RBFS_FitCell( kNN + (long int)c*K, Kgot[c], HaveE, RadialBasisFunction, CellBuf,
+                                             I_data, v_data, B_data, E_data, eps, rbf, w );
+                }
+            }
+
+            LGM_ARRAY_1D_FREE( I_data );
+            LGM_ARRAY_1D_FREE( v_data );
+            LGM_ARRAY_1D_FREE( B_data );
+            LGM_ARRAY_1D_FREE( E_data );
+            LGM_ARRAY_1D_FREE( eps );
+            Lgm_Vec_RBF_FreeWork( w );
+            Lgm_Vec_RBF_Free( rbf );
+        }
+
+
+        /*
+         *  Pack the layer's centers (in place -- they only move down) and write them out.
+         */
+        for ( First=0, c=0; c<nq; c++ ) {
+            Cells[(long int)k*nq + c].First = (uint32_t)First;
+            Cells[(long int)k*nq + c].n     = (uint32_t)nCell[c];
+            if ( First != (uint64_t)c*K ) {
+                for ( a=0; a<nArrays; a++ ) memmove( Buf[a] + First, Buf[a] + (long int)c*K, nCell[c]*sizeof(double) );
+            }
+            First += nCell[c];
+        }
+        nS = First;
+        Slabs[k].Offset   = Offset;
+        Slabs[k].nCentres = nS;
+        for ( a=0; Status && (a<nArrays); a++ ) {
+            Status = RBFS_PWrite( fd, Buf[a], nS*sizeof(double), Offset + a*nS*sizeof(double) );
+        }
+        Offset = RBFS_Align( Offset + nArrays*nS*sizeof(double) );
+        Header.nCentres += nS;
+
+    }
+
+    /*
+     *  The tables and header go in last.
+     */
+    Status = Status && RBFS_PWrite( fd, Slabs, nz*sizeof(Lgm_RBF_SnapshotSlab), Header.SlabOffset );
+    Status = Status && RBFS_PWrite( fd, Cells, Header.nCells*sizeof(Lgm_RBF_SnapshotCell), Header.CellOffset );
+    Status = Status && RBFS_PWrite( fd, &Header, sizeof(Lgm_RBF_SnapshotHeader), 0 );
+    Status = ( close( fd ) == 0 ) && Status;
+    if ( !Status ) fprintf( stderr, "Lgm_RBF_Snapshot_Write(): Error writing %s.\n", Filename );
+
+    for ( j=0; j<3; j++ ) LGM_ARRAY_1D_FREE( Q[j] );
+    for ( a=0; a<nArrays; a++ ) LGM_ARRAY_1D_FREE( Buf[a] );
+    LGM_ARRAY_1D_FREE( Kgot );
+    LGM_ARRAY_1D_FREE( nCell );
+    LGM_ARRAY_1D_FREE( kNN );
+    free( Slabs );
+    free( Cells );
+
+    return( Status );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Open a snapshot written by Lgm_RBF_Snapshot_Write().
+ *
+ *  \details
+ *      The file is memory-mapped and its tables are checked. The fits are
+ *      only read from disk as they get used.
+ *
+ *      \param[in]      Filename    Snapshot file.
+ *
+ *      \return         A handle (close with Lgm_RBF_Snapshot_Close()), or NULL if the
+ *                      file could not be opened or is not a valid snapshot.
+ *
+ */
+Lgm_RBF_Snapshot *Lgm_RBF_Snapshot_Open( char *Filename ) {
+
+    int                     fd, Ok;
+    uint64_t                k, c, nq;
+    struct stat             sb;
+    size_t                  Size;
+    unsigned char           *Base;
+    Lgm_RBF_SnapshotHeader  *h;
+    Lgm_RBF_SnapshotSlab    *Slabs;
+    Lgm_RBF_SnapshotCell    *Cells;
+    Lgm_RBF_Snapshot        *s;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_RBF_SnapshotHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     *  Validate the header and tables
+     */
+    h  = (Lgm_RBF_SnapshotHeader *)Base;
+    Ok = (memcmp( h->Magic, LGM_RBFS_MAGIC, 8 ) == 0) && (h->Version == LGM_RBFS_VERSION) && RBFS_KernelOk( h->RadialBasisFunction )
+            && (h->nArrays == ( h->HaveE ? LGM_RBFS_NARRAYS : LGM_RBFS_CBZ+1 )) && (h->nx > 0) && (h->ny > 0) && (h->nz > 0)
+            && (h->nCells == (uint64_t)h->nx*h->ny*h->nz) && (h->h > 0.0) && (h->R > 0.0)
+            && (h->SlabOffset + h->nz*sizeof(Lgm_RBF_SnapshotSlab) <= Size)
+            && (h->CellOffset + h->nCells*sizeof(Lgm_RBF_SnapshotCell) <= Size);
+    if ( Ok ) {
+        Slabs = (Lgm_RBF_SnapshotSlab *)(Base + h->SlabOffset);
+        Cells = (Lgm_RBF_SnapshotCell *)(Base + h->CellOffset);
+        nq    = (uint64_t)h->nx*h->ny;
+        for ( k=0; Ok && (k<(uint64_t)h->nz); k++ ) {
+            Ok = (Slabs[k].Offset % 8 == 0) && (Slabs[k].Offset + h->nArrays*Slabs[k].nCentres*sizeof(double) <= Size);
+            for ( c=k*nq; Ok && (c<(k+1)*nq); c++ ) {
+                Ok = (Cells[c].n <= (uint32_t)h->K) && ((uint64_t)Cells[c].First + Cells[c].n <= Slabs[k].nCentres);
+            }
+        }
+    }
+    if ( !Ok ) {
+        fprintf( stderr, "Lgm_RBF_Snapshot_Open(): %s is not a valid RBF snapshot file.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+
+    s = (Lgm_RBF_Snapshot *)calloc( 1, sizeof(Lgm_RBF_Snapshot) );
+    s->Base   = Base;
+    s->Size   = Size;
+    s->Header = h;
+    s->Slabs  = (Lgm_RBF_SnapshotSlab *)(Base + h->SlabOffset);
+    s->Cells  = (Lgm_RBF_SnapshotCell *)(Base + h->CellOffset);
+    s->ih     = 1.0/h->h;
+    s->R2     = h->R*h->R;
+    s->iR2    = 1.0/s->R2;
+
+    return( s );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Close a snapshot opened with Lgm_RBF_Snapshot_Open().
+ */
+void Lgm_RBF_Snapshot_Close( Lgm_RBF_Snapshot *s ) {
+
+    if ( s == NULL ) return;
+#ifdef HAVE_SYS_MMAN_H
+    munmap( s->Base, s->Size );
+#else
+    free( s->Base );
+#endif
+    free( s );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Ask the OS to start reading a snapshot in.
+ *
+ *  \details
+ *      A mapped snapshot is only read from disk as it gets used, so the first
+ *      field evaluations after Lgm_RBF_Snapshot_Open() are slow. This starts
+ *      the read in the background (madvise(MADV_WILLNEED)) and returns right
+ *      away. Does nothing if the file was read in rather than mapped.
+ */
+void Lgm_RBF_Snapshot_Prefetch( Lgm_RBF_Snapshot *s ) {
+
+    if ( s == NULL ) return;
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_WILLNEED)
+    madvise( s->Base, s->Size, MADV_WILLNEED );
+#endif
+
+}
+
+
+
+/**
+ *  \brief
+ *      Evaluate a snapshot (B, E and their derivatives) at a point.
+ *
+ *  \details
+ *      The fits of the cells within R of v are evaluated in place (no
+ *      copying) and blended. Any of the outputs other than B may be NULL. E
+ *      and its derivatives are zero if the snapshot has no E.
+ *
+ *      \param[in]      v                   Position.
+ *      \param[out]     B                   Interpolated B.
+ *      \param[out]     dBdx, dBdy, dBdz    Its derivatives.
+ *      \param[out]     E                   Interpolated E.
+ *      \param[out]     dEdx, dEdy, dEdz    Its derivatives.
+ *      \param[in]      s                   Snapshot from Lgm_RBF_Snapshot_Open().
+ *
+ *      \return         TRUE, or FALSE if no fit covers v (the outputs are then zero).
+ *
+ */
+int Lgm_RBF_Snapshot_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz,
+                           Lgm_Vector *E, Lgm_Vector *dEdx, Lgm_Vector *dEdy, Lgm_Vector *dEdz, Lgm_RBF_Snapshot *s ) {
+
+    Lgm_RBF_SnapshotHeader  *h = s->Header;
+    Lgm_RBF_SnapshotCell    *Cell;
+    Lgm_Vec_RBF_Info        rbf;
+    Lgm_Vector              Bc, Bcx, Bcy, Bcz, Ec, Ecx, Ecy, Ecz, d;
+    Lgm_Vector              SB, SBx, SBy, SBz, SE, SEx, SEy, SEz;
+    double                  x, y, z, R, r, omr, omr3, wc, g, gx, gy, gz, Sw, Swx, Swy, Swz, iSw, *Base;
+    int                     i, j, k, ilo, ihi, jlo, jhi, klo, khi, HaveE;
+    uint64_t                nS;
+
+    HaveE = h->HaveE && ( E != NULL );
+    R = h->R;
+    x = v->x - h->Min[0]; y = v->y - h->Min[1]; z = v->z - h->Min[2];
+    ilo = (int)ceil( (x-R)*s->ih - 0.5 ); if ( ilo < 0 ) ilo = 0; ihi = (int)floor( (x+R)*s->ih - 0.5 ); if ( ihi > h->nx-1 ) ihi = h->nx-1;
+    jlo = (int)ceil( (y-R)*s->ih - 0.5 ); if ( jlo < 0 ) jlo = 0; jhi = (int)floor( (y+R)*s->ih - 0.5 ); if ( jhi > h->ny-1 ) jhi = h->ny-1;
+    klo = (int)ceil( (z-R)*s->ih - 0.5 ); if ( klo < 0 ) klo = 0; khi = (int)floor( (z+R)*s->ih - 0.5 ); if ( khi > h->nz-1 ) khi = h->nz-1;
+
+    memset( &rbf, 0, sizeof(rbf) );
+    rbf.RadialBasisFunction = h->RadialBasisFunction;
+    rbf.DoPoly              = FALSE;
+
+    Sw = Swx = Swy = Swz = 0.0;
+    SB.x = SB.y = SB.z = 0.0; SBx = SBy = SBz = SB;
+    SE = SEx = SEy = SEz = SB;
+    for ( k=klo; k<=khi; k++ ) {
+        nS   = s->Slabs[k].nCentres;
+        Base = (double *)(s->Base + s->Slabs[k].Offset);
+        for ( j=jlo; j<=jhi; j++ ) {
+            for ( i=ilo; i<=ihi; i++ ) {
+
+                Cell = &s->Cells[ ((long int)k*h->ny + j)*h->nx + i ];
+                if ( Cell->n == 0 ) continue;
+
+                d.x = x - (i+0.5)*h->h; d.y = y - (j+0.5)*h->h; d.z = z - (k+0.5)*h->h;
+                r = d.x*d.x + d.y*d.y + d.z*d.z;
+                if ( r >= s->R2 ) continue;
+
+                /*
+                 *  Wendland weight and its gradient
+                 */
+                r    = sqrt( r*s->iR2 );
+                omr  = 1.0 - r; omr3 = omr*omr*omr;
+                wc   = omr3*omr*(4.0*r + 1.0);
+                g    = -20.0*omr3*s->iR2;
+                gx   = g*d.x; gy = g*d.y; gz = g*d.z;
+
+                /*
+                 *  The cell's fit, evaluated straight out of the mapping.
+                 */
+                rbf.n      = (int)Cell->n;
+                rbf.vx     = Base + LGM_RBFS_X*nS     + Cell->First;
+                rbf.vy     = Base + LGM_RBFS_Y*nS     + Cell->First;
+                rbf.vz     = Base + LGM_RBFS_Z*nS     + Cell->First;
+                rbf.eps_x  = Base + LGM_RBFS_EPS_X*nS + Cell->First;
+                rbf.eps_y  = Base + LGM_RBFS_EPS_Y*nS + Cell->First;
+                rbf.eps_z  = Base + LGM_RBFS_EPS_Z*nS + Cell->First;
+                rbf.cx_new = Base + LGM_RBFS_CBX*nS   + Cell->First;
+                rbf.cy_new = Base + LGM_RBFS_CBY*nS   + Cell->First;
+                rbf.cz_new = Base + LGM_RBFS_CBZ*nS   + Cell->First;
+                Lgm_Vec_RBF_EvalAll( v, &Bc, &Bcx, &Bcy, &Bcz, &rbf );
+
+                Sw += wc; Swx += gx; Swy += gy; Swz += gz;
+                SB.x  += wc*Bc.x;           SB.y  += wc*Bc.y;           SB.z  += wc*Bc.z;
+                SBx.x += wc*Bcx.x + gx*Bc.x; SBx.y += wc*Bcx.y + gx*Bc.y; SBx.z += wc*Bcx.z + gx*Bc.z;
+                SBy.x += wc*Bcy.x + gy*Bc.x; SBy.y += wc*Bcy.y + gy*Bc.y; SBy.z += wc*Bcy.z + gy*Bc.z;
+                SBz.x += wc*Bcz.x + gz*Bc.x; SBz.y += wc*Bcz.y + gz*Bc.y; SBz.z += wc*Bcz.z + gz*Bc.z;
+
+                if ( HaveE ) {
+                    rbf.cx_new = Base + LGM_RBFS_CEX*nS + Cell->First;
+                    rbf.cy_new = Base + LGM_RBFS_CEY*nS + Cell->First;
+                    rbf.cz_new = Base + LGM_RBFS_CEZ*nS + Cell->First;
+                    Lgm_Vec_RBF_EvalAll( v, &Ec, &Ecx, &Ecy, &Ecz, &rbf );
+                    SE.x  += wc*Ec.x;            SE.y  += wc*Ec.y;            SE.z  += wc*Ec.z;
+                    SEx.x += wc*Ecx.x + gx*Ec.x; SEx.y += wc*Ecx.y + gx*Ec.y; SEx.z += wc*Ecx.z + gx*Ec.z;
+                    SEy.x += wc*Ecy.x + gy*Ec.x; SEy.y += wc*Ecy.y + gy*Ec.y; SEy.z += wc*Ecy.z + gy*Ec.z;
+                    SEz.x += wc*Ecz.x + gz*Ec.x; SEz.y += wc*Ecz.y + gz*Ec.y; SEz.z += wc*Ecz.z + gz*Ec.z;
+                }
+
+            }
+        }
+    }
+
+    if ( Sw <= 0.0 ) {
+        B->x = B->y = B->z = 0.0;
+        if ( dBdx ) *dBdx = *B;
+        if ( dBdy ) *dBdy = *B;
+        if ( dBdz ) *dBdz = *B;
+        if ( E )    *E    = *B;
+        if ( dEdx ) *dEdx = *B;
+        if ( dEdy ) *dEdy = *B;
+        if ( dEdz ) *dEdz = *B;
+        return( FALSE );
+    }
+
+    /*
+     *  B = SB/Sw, and dB/dx = ( d(SB)/dx - B dSw/dx )/Sw, etc.
+     */
+    iSw = 1.0/Sw;
+    B->x = SB.x*iSw; B->y = SB.y*iSw; B->z = SB.z*iSw;
+    if ( dBdx ) { dBdx->x = (SBx.x - B->x*Swx)*iSw; dBdx->y = (SBx.y - B->y*Swx)*iSw; dBdx->z = (SBx.z - B->z*Swx)*iSw; }
+    if ( dBdy ) { dBdy->x = (SBy.x - B->x*Swy)*iSw; dBdy->y = (SBy.y - B->y*Swy)*iSw; dBdy->z = (SBy.z - B->z*Swy)*iSw; }
+    if ( dBdz ) { dBdz->x = (SBz.x - B->x*Swz)*iSw; dBdz->y = (SBz.y - B->y*Swz)*iSw; dBdz->z = (SBz.z - B->z*Swz)*iSw; }
+
+    if ( E ) {
+        E->x = SE.x*iSw; E->y = SE.y*iSw; E->z = SE.z*iSw;
+        if ( dEdx ) { dEdx->x = (SEx.x - E->x*Swx)*iSw; dEdx->y = (SEx.y - E->y*Swx)*iSw; dEdx->z = (SEx.z - E->z*Swx)*iSw; }
+        if ( dEdy ) { dEdy->x = (SEy.x - E->x*Swy)*iSw; dEdy->y = (SEy.y - E->y*Swy)*iSw; dEdy->z = (SEy.z - E->z*Swy)*iSw; }
+        if ( dEdz ) { dEdz->x = (SEz.x - E->x*Swz)*iSw; dEdz->y = (SEz.y - E->y*Swz)*iSw; dEdz->z = (SEz.z - E->z*Swz)*iSw; }
+    }
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Attach a snapshot to a Lgm_MagModelInfo structure and select it as the B-field model.
+ *
+ *  \details
+ *      The snapshot is not copied; it must not be closed while mInfo is still using it.
+ */
+void Lgm_MagModelInfo_Set_RBF_Snapshot( Lgm_RBF_Snapshot *s, Lgm_MagModelInfo *m ) {
+    m->RBF_Snapshot  = s;
+    m->ExternalModel = LGM_EXTMODEL_RBF_SNAPSHOT;
+    m->Bfield        = Lgm_B_FromRBF_Snapshot;
+    m->BfieldBatch   = NULL;
+    m->BfieldWithJacobian = NULL;
+    m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+}
+
+
+
+/**
+ *  \brief
+ *      B-field from a RBF snapshot.
+ *
+ *  \details
+ *      Like Lgm_B_FromScatteredData5(), the fits are to the total field, and
+ *      E and the derivatives of B and E are left in Info->RBF_E,
+ *      Info->RBF_dBdx, etc. Points not covered by the snapshot are answered
+ *      by the internal model (with E and the derivatives set to zero).
+ *
+ *      \param[in]      v           Position.
+ *      \param[out]     B           Field.
+ *      \param[in,out]  Info        Lgm_MagModelInfo structure.
+ *
+ */
+int Lgm_B_FromRBF_Snapshot( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+
+    Lgm_RBF_Snapshot    *s = Info->RBF_Snapshot;
+    int                 Covered;
+    LGM_STATS_START( tRBF );
+
+    if ( s == NULL ) {
+        fprintf(stderr, "Lgm_B_FromRBF_Snapshot: No snapshot has been set (see Lgm_RBF_Snapshot_Open() and Lgm_MagModelInfo_Set_RBF_Snapshot()).\n");
+        B->x = B->y = B->z = 0.0;
+        return(0);
+    }
+
+    Covered = Lgm_RBF_Snapshot_Eval( v, B, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz,
+                                     &Info->RBF_E, &Info->RBF_dEdx, &Info->RBF_dEdy, &Info->RBF_dEdz, s );
+    LGM_STATS_STOP( Info, RBF, tRBF );
+
+    if ( !Covered ) {
+        switch ( Info->InternalModel ){
+            case LGM_CDIP:
+                            Lgm_B_cdip( v, B, Info );
+                            break;
+            case LGM_EDIP:
+                            Lgm_B_edip( v, B, Info );
+                            break;
+            case LGM_IGRF:
+                            Lgm_B_igrf( v, B, Info );
+                            break;
+            default:
+                            fprintf(stderr, "Lgm_B_FromRBF_Snapshot(): Unknown internal model (%d)\n", Info->InternalModel );
+                            break;
+        }
+    }
+
+    ++Info->nFunc;
+
+    return(1);
+
+}
+
+
+
+/*
+ *  Time dependent runs.
+ *
+ *  A Lgm_RBF_SnapshotPair holds the snapshots at JD0 and JD1 and blends
+ *  B, E and their derivatives linearly in time between them (times outside
+ *  [JD0, JD1] get the nearer snapshot, there is no extrapolation). To walk
+ *  through a run, queue the next snapshot as soon as the pair is in use;
+ *  Lgm_RBF_SnapshotPair_Queue() only maps the file and starts it reading in
+ *  the background, so it doesnt get in the way of evaluations that are
+ *  going on. Once the times of interest are past JD1, Advance() drops s0
+ *  and shifts the queued one in, which is just a pointer swap. So there is
+ *  never a stop to rebuild (compare tearing down and setting up
+ *  Lgm_B_FromScatteredData5() for every MHD output time).
+ *
+ *      p = Lgm_RBF_SnapshotPair_Open( "t0000.rbf", JD[0], "t0001.rbf", JD[1] );
+ *      Lgm_MagModelInfo_Set_RBF_SnapshotPair( p, mInfo );
+ *      Lgm_RBF_SnapshotPair_Queue( p, "t0002.rbf", JD[2] );
+ *      for ( ... ) {
+ *          if ( ( JD > p->JD1 ) && Lgm_RBF_SnapshotPair_Advance( p ) ) Lgm_RBF_SnapshotPair_Queue( p, NextFile, NextJD );
+ *          Lgm_Set_Coord_Transforms( Date, UTC, mInfo->c );
+ *          ...
+ *      }
+ *      Lgm_RBF_SnapshotPair_Close( p );
+ *
+ *  Advance() must not be called while other threads are evaluating the
+ *  pair.
+ */
+
+
+
+/**
+ *  \brief
+ *      Open two snapshots of a time dependent run.
+ *
+ *      \param[in]      Filename0, JD0  Snapshot file at the earlier time (Julian Date).
+ *      \param[in]      Filename1, JD1  Snapshot file at the later time (JD1 > JD0).
+ *
+ *      \return         A handle (close with Lgm_RBF_SnapshotPair_Close()), or NULL if
+ *                      either file could not be opened.
+ *
+ */
+Lgm_RBF_SnapshotPair *Lgm_RBF_SnapshotPair_Open( char *Filename0, double JD0, char *Filename1, double JD1 ) {
+
+    Lgm_RBF_SnapshotPair    *p;
+
+    if ( JD1 <= JD0 ) {
+        fprintf( stderr, "Lgm_RBF_SnapshotPair_Open(): JD1 (%.8lf) must be later than JD0 (%.8lf).\n", JD1, JD0 );
+        return( NULL );
+    }
+
+    p = (Lgm_RBF_SnapshotPair *)calloc( 1, sizeof(Lgm_RBF_SnapshotPair) );
+    p->s0 = Lgm_RBF_Snapshot_Open( Filename0 );
+    p->s1 = Lgm_RBF_Snapshot_Open( Filename1 );
+    if ( ( p->s0 == NULL ) || ( p->s1 == NULL ) ) {
+        Lgm_RBF_SnapshotPair_Close( p );
+        return( NULL );
+    }
+    p->JD0 = JD0;
+    p->JD1 = JD1;
+    Lgm_RBF_Snapshot_Prefetch( p->s1 );
+
+    return( p );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Queue the snapshot that comes after the pair.
+ *
+ *  \details
+ *      The file is mapped and starts being read in the background (see
+ *      Lgm_RBF_Snapshot_Prefetch()). It is not used until
+ *      Lgm_RBF_SnapshotPair_Advance(), so this can be called while the pair
+ *      is being evaluated. A snapshot that was already queued is dropped.
+ *
+ *      \param[in,out]  p           The pair.
+ *      \param[in]      Filename    Snapshot file.
+ *      \param[in]      JD          Its time (must be later than p->JD1).
+ *
+ *      \return         TRUE, or FALSE if the file could not be opened.
+ *
+ */
+int Lgm_RBF_SnapshotPair_Queue( Lgm_RBF_SnapshotPair *p, char *Filename, double JD ) {
+
+    Lgm_RBF_Snapshot    *s;
+
+    if ( JD <= p->JD1 ) {
+        fprintf( stderr, "Lgm_RBF_SnapshotPair_Queue(): JD (%.8lf) must be later than JD1 (%.8lf).\n", JD, p->JD1 );
+        return( FALSE );
+    }
+    if ( (s = Lgm_RBF_Snapshot_Open( Filename )) == NULL ) return( FALSE );
+    Lgm_RBF_Snapshot_Prefetch( s );
+
+    Lgm_RBF_Snapshot_Close( p->Next );
+    p->Next   = s;
+    p->JDNext = JD;
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Move the pair on to (JD1, JDNext).
+ *
+ *  \details
+ *      s0 is closed, s1 becomes s0 and the queued snapshot becomes s1.
+ *
+ *      \param[in,out]  p           The pair.
+ *
+ *      \return         TRUE, or FALSE (and the pair is left alone) if nothing was queued.
+ *
+ */
+int Lgm_RBF_SnapshotPair_Advance( Lgm_RBF_SnapshotPair *p ) {
+
+    if ( p->Next == NULL ) return( FALSE );
+
+    Lgm_RBF_Snapshot_Close( p->s0 );
+    p->s0   = p->s1;  p->JD0 = p->JD1;
+    p->s1   = p->Next; p->JD1 = p->JDNext;
+    p->Next = NULL;
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Close a pair (and the snapshots in it) opened with Lgm_RBF_SnapshotPair_Open().
+ */
+void Lgm_RBF_SnapshotPair_Close( Lgm_RBF_SnapshotPair *p ) {
+
+    if ( p == NULL ) return;
+    Lgm_RBF_Snapshot_Close( p->s0 );
+    Lgm_RBF_Snapshot_Close( p->s1 );
+    Lgm_RBF_Snapshot_Close( p->Next );
+    free( p );
+
+}
+
+
+static void RBFS_Blend( Lgm_Vector *u, double a, Lgm_Vector *u1 ) {
+    if ( u == NULL ) return;
+    u->x += a*( u1->x - u->x );
+    u->y += a*( u1->y - u->y );
+    u->z += a*( u1->z - u->z );
+}
+
+/**
+ *  \brief
+ *      Evaluate a pair of snapshots (B, E and their derivatives) at a point and time.
+ *
+ *  \details
+ *      Each output is (1-a) times its value in s0 plus a times its value in
+ *      s1, with a = (JD-JD0)/(JD1-JD0) clamped to [0, 1]. Only one snapshot
+ *      is evaluated when a is 0 or 1. Any of the outputs other than B may be
+ *      NULL.
+ *
+ *      \param[in]      JD                  Time (Julian Date).
+ *      \param[in]      v                   Position.
+ *      \param[out]     B                   Interpolated B.
+ *      \param[out]     dBdx, dBdy, dBdz    Its derivatives.
+ *      \param[out]     E                   Interpolated E.
+ *      \param[out]     dEdx, dEdy, dEdz    Its derivatives.
+ *      \param[in]      p                   Pair from Lgm_RBF_SnapshotPair_Open().
+ *
+ *      \return         TRUE, or FALSE if a snapshot that is needed doesnt cover v (the outputs are then zero).
+ *
+ */
+int Lgm_RBF_SnapshotPair_Eval( double JD, Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz,
+                               Lgm_Vector *E, Lgm_Vector *dEdx, Lgm_Vector *dEdy, Lgm_Vector *dEdz, Lgm_RBF_SnapshotPair *p ) {
+
+    Lgm_Vector  B1, dB1dx, dB1dy, dB1dz, E1, dE1dx, dE1dy, dE1dz;
+    double      a;
+
+    a = ( JD - p->JD0 )/( p->JD1 - p->JD0 );
+    if ( a <= 0.0 ) return( Lgm_RBF_Snapshot_Eval( v, B, dBdx, dBdy, dBdz, E, dEdx, dEdy, dEdz, p->s0 ) );
+    if ( a >= 1.0 ) return( Lgm_RBF_Snapshot_Eval( v, B, dBdx, dBdy, dBdz, E, dEdx, dEdy, dEdz, p->s1 ) );
+
+    if ( !Lgm_RBF_Snapshot_Eval( v, B, dBdx, dBdy, dBdz, E, dEdx, dEdy, dEdz, p->s0 )
+            || !Lgm_RBF_Snapshot_Eval( v, &B1, dBdx ? &dB1dx : NULL, dBdy ? &dB1dy : NULL, dBdz ? &dB1dz : NULL,
+                                       E ? &E1 : NULL, dEdx ? &dE1dx : NULL, dEdy ? &dE1dy : NULL, dEdz ? &dE1dz : NULL, p->s1 ) ) {
+        B->x = B->y = B->z = 0.0;
+        if ( dBdx ) *dBdx = *B;
+        if ( dBdy ) *dBdy = *B;
+        if ( dBdz ) *dBdz = *B;
+        if ( E )    *E    = *B;
+        if ( dEdx ) *dEdx = *B;
+        if ( dEdy ) *dEdy = *B;
+        if ( dEdz ) *dEdz = *B;
+        return( FALSE );
+    }
+
+    RBFS_Blend( B, a, &B1 );
+    RBFS_Blend( dBdx, a, &dB1dx ); RBFS_Blend( dBdy, a, &dB1dy ); RBFS_Blend( dBdz, a, &dB1dz );
+    if ( E ) {
+        RBFS_Blend( E, a, &E1 );
+        RBFS_Blend( dEdx, a, &dE1dx ); RBFS_Blend( dEdy, a, &dE1dy ); RBFS_Blend( dEdz, a, &dE1dz );
+    }
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Attach a pair of snapshots to a Lgm_MagModelInfo structure and select it as the B-field model.
+ *
+ *  \details
+ *      The pair is not copied; it must not be closed while mInfo is still using it.
+ */
+void Lgm_MagModelInfo_Set_RBF_SnapshotPair( Lgm_RBF_SnapshotPair *p, Lgm_MagModelInfo *m ) {
+    m->RBF_SnapshotPair = p;
+    m->ExternalModel    = LGM_EXTMODEL_RBF_SNAPSHOT_PAIR;
+    m->Bfield           = Lgm_B_FromRBF_SnapshotPair;
+    m->BfieldBatch      = NULL;
+    m->BfieldWithJacobian = NULL;
+    m->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_BS;
+}
+
+
+
+/**
+ *  \brief
+ *      B-field from a pair of RBF snapshots, at the time in Info->c.
+ *
+ *  \details
+ *      Same as Lgm_B_FromRBF_Snapshot(), but blended in time between the two
+ *      snapshots (see Lgm_RBF_SnapshotPair_Eval()). E and the derivatives
+ *      are left in Info->RBF_E, Info->RBF_dBdx, etc.
+ *
+ *      \param[in]      v           Position.
+ *      \param[out]     B           Field.
+ *      \param[in,out]  Info        Lgm_MagModelInfo structure.
+ *
+ */
+int Lgm_B_FromRBF_SnapshotPair( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+
+    Lgm_RBF_SnapshotPair    *p = Info->RBF_SnapshotPair;
+    int                     Covered;
+    LGM_STATS_START( tRBF );
+
+    if ( p == NULL ) {
+        fprintf(stderr, "Lgm_B_FromRBF_SnapshotPair: No snapshots have been set (see Lgm_RBF_SnapshotPair_Open() and Lgm_MagModelInfo_Set_RBF_SnapshotPair()).\n");
+        B->x = B->y = B->z = 0.0;
+        return(0);
+    }
+
+    Covered = Lgm_RBF_SnapshotPair_Eval( Info->c->UTC.JD, v, B, &Info->RBF_dBdx, &Info->RBF_dBdy, &Info->RBF_dBdz,
+                                         &Info->RBF_E, &Info->RBF_dEdx, &Info->RBF_dEdy, &Info->RBF_dEdz, p );
+    LGM_STATS_STOP( Info, RBF, tRBF );
+
+    if ( !Covered ) {
+        switch ( Info->InternalModel ){
+            case LGM_CDIP:
+                            Lgm_B_cdip( v, B, Info );
+                            break;
+            case LGM_EDIP:
+                            Lgm_B_edip( v, B, Info );
+                            break;
+            case LGM_IGRF:
+                            Lgm_B_igrf( v, B, Info );
+                            break;
+            default:
+                            fprintf(stderr, "Lgm_B_FromRBF_SnapshotPair(): Unknown internal model (%d)\n", Info->InternalModel );
+                            break;
+        }
+    }
+
+    ++Info->nFunc;
+
+    return(1);
+
+}
@@ -0,0 +1,214 @@
+/*! \file Lgm_RBF_Sparse.c
+ *
+ *  \brief Sparse (envelope) Cholesky solves for compactly supported RBFs.
+ *
+ *  With a Wendland kernel (LGM_RBF_WENDLAND3x) the RBF only reaches out to
+ *  r = 1/sqrt(eps), so the interpolation matrix only has entries for pairs
+ *  of points closer than that. Lgm_DFI_RBF_Init() and Lgm_Vec_RBF_Init() use
+ *  these routines for them instead of the dense LU:
+ *
+ *      - Lgm_RBF_SupportOrder() finds the pairs that are within reach of
+ *        each other and orders the points by reverse Cuthill-McKee (RCM), so
+ *        that the neighbours of a point are never far from it in the new
+ *        order. First[k] is the first (in the new order) of point k's
+ *        neighbours, which gives the envelope (profile) of the matrix.
+ *
+ *      - The lower triangle inside the envelope is stored row by row in a
+ *        Lgm_RBF_Skyline (LGM_SKYLINE( m, i, j ) is element (i, j)). The
+ *        Cholesky factor has no fill-in outside the envelope, so it is done
+ *        in place (Lgm_RBF_Skyline_Cholesky()) and the solves are two sweeps
+ *        over it (Lgm_RBF_Skyline_Solve()).
+ *
+ *  The work goes as the sum of the squared row widths rather than n^3, and
+ *  the storage as the envelope size rather than n^2, so neighbourhoods that
+ *  are several times bigger than the kernel's reach cost little more than
+ *  ones that arent.
+ *
+ *  Finding the pairs is a straight O(n^2) search. That is cheap next to the
+ *  factorization for the neighbourhood sizes used here.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include "Lgm/Lgm_RBF.h"
+
+
+/**
+ *  Order n points for an envelope solve with a kernel whose support is
+ *  ex*x^2 + ey*y^2 + ez*z^2 < 1.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      v           The points.
+ *      \param[in]      ex, ey, ez  Support is ex*x^2 + ey*y^2 + ez*z^2 < 1.
+ *      \param[out]     Perm        Perm[k] is the point that goes k'th (n of them).
+ *      \param[out]     First       First[k] is the lowest new index of any point within reach of the k'th (n of them).
+ *
+ *      \return         Number of pairs of (distinct) points within reach of each other.
+ */
+long int Lgm_RBF_SupportOrder( int n, Lgm_Vector *v, double ex, double ey, double ez, int *Perm, int *First ) {
+
+    int         i, j, k, t, Head, Tail, Start, *Deg, *Adj, *Iperm;
+    long int    *Ptr, nPairs;
+    double      dx, dy, dz;
+
+    LGM_ARRAY_1D( Deg,   n,   int );
+    LGM_ARRAY_1D( Iperm, n,   int );
+    LGM_ARRAY_1D( Ptr,   n+1, long int );
+
+    /*
+     * Neighbour graph (CSR). Counted first, then filled in.
+     */
+    for ( nPairs=0, i=0; i<n; i++ ) {
+        for ( j=i+1; j<n; j++ ) {
+            dx = v[i].x - v[j].x; dy = v[i].y - v[j].y; dz = v[i].z - v[j].z;
+            if ( ex*dx*dx + ey*dy*dy + ez*dz*dz < 1.0 ) { ++Deg[i]; ++Deg[j]; ++nPairs; }
+        }
+    }
+    for ( Ptr[0]=0, i=0; i<n; i++ ) Ptr[i+1] = Ptr[i] + Deg[i];
+    LGM_ARRAY_1D( Adj, Ptr[n]+1, int );
+    for ( i=0; i<n; i++ ) Deg[i] = 0;
+    for ( i=0; i<n; i++ ) {
+        for ( j=i+1; j<n; j++ ) {
+            dx = v[i].x - v[j].x; dy = v[i].y - v[j].y; dz = v[i].z - v[j].z;
+            if ( ex*dx*dx + ey*dy*dy + ez*dz*dz < 1.0 ) {
+                Adj[ Ptr[i] + Deg[i]++ ] = j;
+                Adj[ Ptr[j] + Deg[j]++ ] = i;
+            }
+        }
+    }
+
+    /*
+     * Cuthill-McKee. Each connected piece is started from its lowest degree
+     * point, and the neighbours of each point are queued in order of
+     * increasing degree. Iperm[i] is -1 until point i is queued.
+     */
+    for ( i=0; i<n; i++ ) Iperm[i] = -1;
+    for ( Tail=0; Tail<n; ) {
+        for ( Start=-1, i=0; i<n; i++ ) {
+            if ( ( Iperm[i] < 0 ) && ( ( Start < 0 ) || ( Deg[i] < Deg[Start] ) ) ) Start = i;
+        }
+        Head = Tail;
+        Iperm[Start] = Tail; Perm[Tail++] = Start;
+        while ( Head < Tail ) {
+            i = Perm[Head++];
+            k = Tail;
+            for ( t=Ptr[i]; t<Ptr[i+1]; t++ ) {
+                j = Adj[t];
+                if ( Iperm[j] < 0 ) { Iperm[j] = Tail; Perm[Tail++] = j; }
+            }
+            // insertion sort the new ones by degree (there are only a few)
+            for ( t=k+1; t<Tail; t++ ) {
+                for ( j=Perm[t], Start=t; ( Start > k ) && ( Deg[ Perm[Start-1] ] > Deg[j] ); Start-- ) Perm[Start] = Perm[Start-1];
+                Perm[Start] = j;
+            }
+        }
+    }
+
+    // Reverse it
+    for ( i=0; i<n/2; i++ ) { t = Perm[i]; Perm[i] = Perm[n-1-i]; Perm[n-1-i] = t; }
+    for ( k=0; k<n; k++ ) Iperm[ Perm[k] ] = k;
+
+    for ( k=0; k<n; k++ ) {
+        i = Perm[k];
+        for ( First[k]=k, t=Ptr[i]; t<Ptr[i+1]; t++ ) if ( Iperm[ Adj[t] ] < First[k] ) First[k] = Iperm[ Adj[t] ];
+    }
+
+    LGM_ARRAY_1D_FREE( Adj );
+    LGM_ARRAY_1D_FREE( Ptr );
+    LGM_ARRAY_1D_FREE( Iperm );
+    LGM_ARRAY_1D_FREE( Deg );
+
+    return( nPairs );
+
+}
+
+
+/**
+ *  Allocate an n x n symmetric envelope matrix (zeroed). Row i holds
+ *  columns First[i] ... i. First is copied.
+ */
+Lgm_RBF_Skyline *Lgm_RBF_Skyline_Alloc( int n, int *First ) {
+
+    int             i;
+    Lgm_RBF_Skyline *m;
+
+    m = (Lgm_RBF_Skyline *)calloc( 1, sizeof(*m) );
+    m->n = n;
+    LGM_ARRAY_1D( m->First, n,   int );
+    LGM_ARRAY_1D( m->Start, n+1, long int );
+    for ( m->Start[0]=0, i=0; i<n; i++ ) {
+        m->First[i]   = First[i];
+        m->Start[i+1] = m->Start[i] + i - First[i] + 1;
+    }
+    m->nVal = m->Start[n];
+    LGM_ARRAY_1D( m->Val, m->nVal, double );
+
+    return( m );
+
+}
+
+void Lgm_RBF_Skyline_Free( Lgm_RBF_Skyline *m ) {
+
+    if ( m == NULL ) return;
+    LGM_ARRAY_1D_FREE( m->Val );
+    LGM_ARRAY_1D_FREE( m->Start );
+    LGM_ARRAY_1D_FREE( m->First );
+    free( m );
+
+}
+
+
+/**
+ *  In place Cholesky factorization (A = L L^T) of an envelope matrix.
+ *
+ *      \return         FALSE if the matrix isnt (numerically) positive definite.
+ */
+int Lgm_RBF_Skyline_Cholesky( Lgm_RBF_Skyline *m ) {
+
+    int     i, j, k, k0;
+    double  sum, *Li, *Lj;
+
+    for ( i=0; i<m->n; i++ ) {
+        Li = &m->Val[ m->Start[i] ] - m->First[i];      // so that Li[j] is L(i,j)
+        for ( j=m->First[i]; j<=i; j++ ) {
+            Lj = &m->Val[ m->Start[j] ] - m->First[j];
+            k0 = ( m->First[i] > m->First[j] ) ? m->First[i] : m->First[j];
+            for ( sum=Li[j], k=k0; k<j; k++ ) sum -= Li[k]*Lj[k];
+            if ( j < i ) {
+                Li[j] = sum/Lj[j];
+            } else {
+                if ( sum <= 0.0 ) return( FALSE );
+                Li[i] = sqrt( sum );
+            }
+        }
+    }
+
+    return( TRUE );
+
+}
+
+
+/**
+ *  Solve L L^T x = b with the factor from Lgm_RBF_Skyline_Cholesky(). b is
+ *  overwritten with x.
+ */
+void Lgm_RBF_Skyline_Solve( Lgm_RBF_Skyline *m, double *b ) {
+
+    int     i, k;
+    double  sum, *Li;
+
+    for ( i=0; i<m->n; i++ ) {
+        Li = &m->Val[ m->Start[i] ] - m->First[i];
+        for ( sum=b[i], k=m->First[i]; k<i; k++ ) sum -= Li[k]*b[k];
+        b[i] = sum/Li[i];
+    }
+
+    for ( i=m->n-1; i>=0; i-- ) {
+        Li = &m->Val[ m->Start[i] ] - m->First[i];
+        b[i] /= Li[i];
+        for ( k=m->First[i]; k<i; k++ ) b[k] -= Li[k]*b[i];
+    }
+
+}
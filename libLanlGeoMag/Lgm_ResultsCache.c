@@ -0,0 +1,459 @@
+/*! \file Lgm_ResultsCache.c
+ *
+ *  \brief Persistent cache of the results of Lgm_ComputeLstarVersusPA().
+ *
+ *  \details
+ *      MagEphem products are often rerun for the same spacecraft and days
+ *      with only a change in output format or an extra pitch angle, and all
+ *      of the L*'s get computed over again. With a Lgm_ResultsCache attached
+ *      to the Lgm_MagEphemInfo, Lgm_ComputeLstarVersusPA() first looks up
+ *      the results for the time, and only computes what isnt there, e.g.
+ *
+ *          Lgm_ResultsCache *rc = Lgm_OpenResultsCache( "rbspa.lgmrc", FALSE );
+ *          Lgm_MagEphemInfo_SetResultsCache( rc, MagEphemInfo );
+ *          ...
+ *          Lgm_CloseResultsCache( rc );
+ *
+ *      There are two kinds of record. The LGM_RESULTS_CACHE_EPOCH record of
+ *      a time holds what the trace through the S/C gives (FL type,
+ *      footpoints, Pmin, Bmin, ...) and is keyed by a hash of the date and
+ *      time, the position, the field model and its parameters (Kp, Dst, the
+ *      Qin-Denton inputs, ...), the footpoint height, the L*
+ *      quality and the number of FLs in the drift shell. Each pitch angle's
+ *      LGM_RESULTS_CACHE_PA record (L*, I, K, Sb, Tb, drift orbit type) is
+ *      keyed by that hash and the pitch angle. So a rerun with one more
+ *      pitch angle only computes that one, and any change in the inputs
+ *      misses. The drift shell lines themselves are not stored -- a pitch
+ *      angle found in the cache has nShellPoints = 0. Approximate L*'s (see
+ *      Lgm_SetLstarBudget()) and cancelled calculations are not stored
+ *      either, since they depend on how long things took.
+ *
+ *      The file is a header and the records one after the other. It is read
+ *      into a hash table when opened, and new records are appended as they
+ *      are made (one write() each, so several processes can add to the same
+ *      file, though each only sees what was there when it opened it).
+ *      Lookups and appends are done inside the Lgm_ResultsCache critical
+ *      section, so one cache can be shared by all of the threads.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "Lgm/Lgm_ResultsCache.h"
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+
+typedef struct Lgm_ResultsCacheHeader {
+    unsigned long   Magic;
+    int             Version;
+    int             RecordSize;
+} Lgm_ResultsCacheHeader;
+
+
+/*
+ *  Add r to the table (a record that is already there is left alone).
+ */
+static void Lgm_ResultsCache_Insert( Lgm_ResultsCacheRecord *r, Lgm_ResultsCache *rc ) {
+
+    Lgm_ResultsCacheEntry   *e;
+
+    HASH_FIND( hh, rc->ht, &r->Key, sizeof( unsigned long ), e );
+    if ( e != NULL ) return;
+
+    e = (Lgm_ResultsCacheEntry *)calloc( 1, sizeof( Lgm_ResultsCacheEntry ) );
+    e->r = *r;
+    HASH_ADD( hh, rc->ht, r.Key, sizeof( unsigned long ), e );
+    ++rc->nEntries;
+
+}
+
+
+/*
+ *  Open (or create) the cache file at Path and read in what is in it. With
+ *  ReadOnly, nothing new is added to the file. Returns NULL if the file
+ *  cant be opened or was written by an incompatible version.
+ */
+Lgm_ResultsCache *Lgm_OpenResultsCache( char *Path, int ReadOnly ) {
+
+    Lgm_ResultsCache        *rc;
+    Lgm_ResultsCacheHeader  h;
+    Lgm_ResultsCacheRecord  r;
+    off_t                   Size, nGood;
+    int                     fd;
+
+    fd = open( Path, ReadOnly ? O_RDONLY : O_RDWR|O_CREAT, 0664 );
+    if ( fd < 0 ) {
+        printf("Lgm_OpenResultsCache: Could not open %s\n", Path );
+        return( NULL );
+    }
+
+    Size = lseek( fd, 0, SEEK_END );
+    lseek( fd, 0, SEEK_SET );
+    if ( Size == 0 ) {
+        if ( ReadOnly ) {
+            close( fd );
+            return( NULL );
+        }
+        h.Magic      = LGM_RESULTS_CACHE_MAGIC;
+        h.Version    = LGM_RESULTS_CACHE_VERSION;
+        h.RecordSize = sizeof( Lgm_ResultsCacheRecord );
+        if ( write( fd, &h, sizeof( h ) ) != sizeof( h ) ) {
+            printf("Lgm_OpenResultsCache: Could not write header to %s\n", Path );
+            close( fd );
+            return( NULL );
+        }
+        Size = sizeof( h );
+    } else if ( ( read( fd, &h, sizeof( h ) ) != sizeof( h ) ) || ( h.Magic != LGM_RESULTS_CACHE_MAGIC )
+                    || ( h.Version != LGM_RESULTS_CACHE_VERSION ) || ( h.RecordSize != sizeof( Lgm_ResultsCacheRecord ) ) ) {
+        printf("Lgm_OpenResultsCache: %s is not a results cache (or is from an incompatible version)\n", Path );
+        close( fd );
+        return( NULL );
+    }
+
+    rc = (Lgm_ResultsCache *)calloc( 1, sizeof( Lgm_ResultsCache ) );
+    strncpy( rc->Path, Path, 1023 );
+    rc->ht = NULL;
+
+    nGood = sizeof( h );
+    while ( read( fd, &r, sizeof( r ) ) == sizeof( r ) ) {
+        Lgm_ResultsCache_Insert( &r, rc );
+        nGood += sizeof( r );
+    }
+
+    /*
+     *  A record cut short (e.g. the writer was killed) is dropped, so that
+     *  the ones appended after it line up.
+     */
+    if ( ReadOnly ) {
+        close( fd );
+        rc->fd = -1;
+    } else {
+        if ( nGood != Size ) {
+            if ( ftruncate( fd, nGood ) != 0 ) printf("Lgm_OpenResultsCache: Could not drop the partial record at the end of %s\n", Path );
+        }
+        close( fd );
+        rc->fd = open( Path, O_WRONLY|O_APPEND );
+    }
+
+    return( rc );
+
+}
+
+
+void Lgm_CloseResultsCache( Lgm_ResultsCache *rc ) {
+
+    Lgm_ResultsCacheEntry   *e, *tmp;
+
+    if ( rc == NULL ) return;
+
+    HASH_ITER( hh, rc->ht, e, tmp ) {
+        HASH_DEL( rc->ht, e );
+        free( e );
+    }
+    if ( rc->fd >= 0 ) close( rc->fd );
+    free( rc );
+
+}
+
+
+/*
+ *  Attach a cache (or NULL to detach it). Everything copied from
+ *  MagEphemInfo after this shares it.
+ */
+void Lgm_MagEphemInfo_SetResultsCache( Lgm_ResultsCache *rc, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    MagEphemInfo->ResultsCache = rc;
+
+}
+
+
+
+
+/*
+ *  The key of the EPOCH record for position u at MagEphemInfo->Date, UTC.
+ *  The coordinate transforms have to be set for that time already. Never 0.
+ */
+unsigned long Lgm_ResultsCache_Key( Lgm_Vector *u, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_LstarInfo       *LstarInfo = MagEphemInfo->LstarInfo;
+    Lgm_MagModelInfo    *m = LstarInfo->mInfo;
+    Lgm_ModelKey        k;
+    int                 i, Version = LGM_RESULTS_CACHE_VERSION;
+    long int            BfieldOffset;
+
+    /*
+     *  The model state, keyed the same way in every run (see
+     *  Lgm_ModelState.c). For models the library doesnt know, use the offset
+     *  of the Bfield routine from a routine in the library (its address
+     *  isnt the same from one run to the next, but that is) and all of the
+     *  Qin-Denton inputs.
+     */
+    k = Lgm_ModelState_Key( m->Bfield, LGM_MODELSTATE_ALL | LGM_MODELSTATE_PORTABLE, m );
+    if ( Lgm_ModelKey_IsNull( k ) ) {
+        k = Lgm_ModelState_Key( m->Bfield, LGM_MODELSTATE_TIME | LGM_MODELSTATE_TOLS, m );
+        BfieldOffset = (long int)( (char *)m->Bfield - (char *)Lgm_B_T89c );
+        Lgm_ModelKey_Add( &k, &BfieldOffset, sizeof( BfieldOffset ) );
+        Lgm_ModelKey_Add( &k, &m->InternalModel, sizeof( m->InternalModel ) );
+        Lgm_ModelKey_Add( &k, &m->ExternalModel, sizeof( m->ExternalModel ) );
+        Lgm_ModelKey_Add( &k, &m->Kp, sizeof( m->Kp ) );
+        Lgm_ModelKey_Add( &k, &m->aKp3, sizeof( m->aKp3 ) );
+        Lgm_ModelKey_AddDouble( &k, m->fKp );
+        Lgm_ModelKey_AddDouble( &k, m->Dst );
+        Lgm_ModelKey_AddDouble( &k, m->P );
+        Lgm_ModelKey_AddDouble( &k, m->Bx );
+        Lgm_ModelKey_AddDouble( &k, m->By );
+        Lgm_ModelKey_AddDouble( &k, m->Bz );
+        Lgm_ModelKey_AddDouble( &k, m->V );
+        Lgm_ModelKey_AddDouble( &k, m->Den );
+        Lgm_ModelKey_AddDouble( &k, m->G1 );
+        Lgm_ModelKey_AddDouble( &k, m->G2 );
+        Lgm_ModelKey_AddDouble( &k, m->G3 );
+        for ( i=0; i<6; i++ ) Lgm_ModelKey_AddDouble( &k, m->W[i] );
+    }
+
+    Lgm_ModelKey_Add( &k, &Version, sizeof( Version ) );
+    Lgm_ModelKey_Add( &k, &MagEphemInfo->Date, sizeof( MagEphemInfo->Date ) );
+    Lgm_ModelKey_Add( &k, &MagEphemInfo->UTC, sizeof( MagEphemInfo->UTC ) );
+    Lgm_ModelKey_Add( &k, u, sizeof( *u ) );
+
+    // how hard L* is tried for
+    Lgm_ModelKey_Add( &k, &MagEphemInfo->LstarQuality, sizeof( MagEphemInfo->LstarQuality ) );
+    Lgm_ModelKey_Add( &k, &MagEphemInfo->nFLsInDriftShell, sizeof( MagEphemInfo->nFLsInDriftShell ) );
+    Lgm_ModelKey_Add( &k, &LstarInfo->LSimpleMax, sizeof( LstarInfo->LSimpleMax ) );
+    Lgm_ModelKey_Add( &k, &LstarInfo->ISearchMethod, sizeof( LstarInfo->ISearchMethod ) );
+    Lgm_ModelKey_Add( &k, &MagEphemInfo->Outputs, sizeof( MagEphemInfo->Outputs ) );
+    k.Lo = Lgm_LstarTolProfile_Hash( k.Lo, LstarInfo->TolProfile );
+
+    return( Lgm_ModelKey_Fold( k ) );
+
+}
+
+static unsigned long Lgm_ResultsCache_PAKey( unsigned long EpochKey, double Alpha ) {
+
+    Lgm_ModelKey    k = { EpochKey, 0 };
+
+    Lgm_ModelKey_Add( &k, &Alpha, sizeof( Alpha ) );
+    return( k.Lo );
+
+}
+
+
+/*
+ *  Look up a record of the given Kind. Returns TRUE (and the record in r) if
+ *  it is there.
+ */
+static int Lgm_ResultsCache_Find( unsigned long Key, int Kind, Lgm_ResultsCacheRecord *r, Lgm_ResultsCache *rc ) {
+
+    Lgm_ResultsCacheEntry   *e;
+    int                     Found = FALSE;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_ResultsCache)
+#endif
+    {
+        HASH_FIND( hh, rc->ht, &Key, sizeof( unsigned long ), e );
+        if ( ( e != NULL ) && ( e->r.Kind == Kind ) ) {
+            *r = e->r;
+            Found = TRUE;
+        }
+    }
+
+    return( Found );
+
+}
+
+static void Lgm_ResultsCache_Add( Lgm_ResultsCacheRecord *r, Lgm_ResultsCache *rc ) {
+
+    Lgm_ResultsCacheEntry   *e;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_ResultsCache)
+#endif
+    {
+        HASH_FIND( hh, rc->ht, &r->Key, sizeof( unsigned long ), e );
+        if ( e == NULL ) {
+            Lgm_ResultsCache_Insert( r, rc );
+            if ( ( rc->fd >= 0 ) && ( write( rc->fd, r, sizeof( *r ) ) != sizeof( *r ) ) ) {
+                printf("Lgm_ResultsCache_Add: Could not write to %s, no more records will be added\n", rc->Path );
+                close( rc->fd );
+                rc->fd = -1;
+            }
+        }
+    }
+
+}
+
+
+/*
+ *  Copy pitch angle i's results out of a PA record.
+ */
+static void Lgm_ResultsCache_SetPA( int i, Lgm_ResultsCacheRecord *r, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    MagEphemInfo->Lstar[i]          = r->v[1];
+    MagEphemInfo->LstarApprox[i]    = FALSE;
+    MagEphemInfo->I[i]              = r->v[2];
+    MagEphemInfo->K[i]              = r->v[3];
+    MagEphemInfo->Sb[i]             = r->v[4];
+    MagEphemInfo->Tb[i]             = r->v[5];
+    MagEphemInfo->DriftOrbitType[i] = r->Flag;
+    MagEphemInfo->nShellPoints[i]   = 0;
+
+}
+
+
+/*
+ *  Called by Lgm_ComputeLstarVersusPA() once Alpha[] and Bm[] are set. If
+ *  the EPOCH record is there and so is every pitch angle that needs an L*,
+ *  all of the results are filled in and TRUE is returned (there is nothing
+ *  left to compute). Otherwise MagEphemInfo is left alone.
+ */
+int Lgm_ResultsCache_GetAll( unsigned long Key, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_ResultsCache        *rc = MagEphemInfo->ResultsCache;
+    Lgm_ResultsCacheRecord  Epoch, *PA;
+    int                     i, DoLstar, Found = TRUE;
+
+    if ( !Lgm_ResultsCache_Find( Key, LGM_RESULTS_CACHE_EPOCH, &Epoch, rc ) ) return( FALSE );
+
+    DoLstar = ( Epoch.Flag == 1 ) && ( Epoch.v[19] < MagEphemInfo->LstarInfo->LSimpleMax );
+    PA = (Lgm_ResultsCacheRecord *)calloc( MagEphemInfo->nAlpha > 0 ? MagEphemInfo->nAlpha : 1, sizeof( Lgm_ResultsCacheRecord ) );
+    for ( i=0; DoLstar && Found && (i<MagEphemInfo->nAlpha); i++ ) {
+        Found = Lgm_ResultsCache_Find( Lgm_ResultsCache_PAKey( Key, MagEphemInfo->Alpha[i] ), LGM_RESULTS_CACHE_PA, &PA[i], rc )
+                    && ( PA[i].v[0] == MagEphemInfo->Alpha[i] );
+    }
+
+    if ( Found ) {
+
+        MagEphemInfo->FieldLineType = Epoch.Flag;
+        if ( Epoch.Flag > 0 ) {
+            MagEphemInfo->Ellipsoid_Footprint_Ps.x = Epoch.v[0]; MagEphemInfo->Ellipsoid_Footprint_Ps.y = Epoch.v[1]; MagEphemInfo->Ellipsoid_Footprint_Ps.z = Epoch.v[2];
+            MagEphemInfo->Ellipsoid_Footprint_Pn.x = Epoch.v[3]; MagEphemInfo->Ellipsoid_Footprint_Pn.y = Epoch.v[4]; MagEphemInfo->Ellipsoid_Footprint_Pn.z = Epoch.v[5];
+            MagEphemInfo->Pmin.x = Epoch.v[6]; MagEphemInfo->Pmin.y = Epoch.v[7]; MagEphemInfo->Pmin.z = Epoch.v[8];
+            MagEphemInfo->Snorth = Epoch.v[9];
+            MagEphemInfo->Ssouth = Epoch.v[10];
+            MagEphemInfo->Smin   = Epoch.v[11];
+            MagEphemInfo->Bmin   = Epoch.v[12];
+            MagEphemInfo->Mref   = Epoch.v[13];
+            MagEphemInfo->Mcurr  = Epoch.v[14];
+            MagEphemInfo->Mused  = Epoch.v[15];
+        }
+        MagEphemInfo->Sb0     = Epoch.v[16];
+        MagEphemInfo->d2B_ds2 = Epoch.v[17];
+        MagEphemInfo->RofC    = Epoch.v[18];
+
+        for ( i=0; i<MagEphemInfo->nAlpha; i++ ) {
+            if ( DoLstar ) {
+                Lgm_ResultsCache_SetPA( i, &PA[i], MagEphemInfo );
+            } else {
+                // as Lgm_ComputeLstarVersusPA() does for open FLs and LSimple >= LSimpleMax
+                MagEphemInfo->Lstar[i]        = LGM_FILL_VALUE;
+                MagEphemInfo->LstarApprox[i]  = FALSE;
+                MagEphemInfo->I[i]            = LGM_FILL_VALUE;
+                MagEphemInfo->K[i]            = LGM_FILL_VALUE;
+                MagEphemInfo->Tb[i]           = LGM_FILL_VALUE;
+                MagEphemInfo->nShellPoints[i] = 0;
+                if ( Epoch.Flag != 1 ) MagEphemInfo->Sb[i] = LGM_FILL_VALUE;
+            }
+        }
+
+#if USE_OPENMP
+        #pragma omp critical (Lgm_ResultsCache)
+#endif
+        {
+            ++rc->nEpochHits;
+            if ( DoLstar ) rc->nHits += MagEphemInfo->nAlpha;
+        }
+
+    }
+    free( PA );
+
+    return( Found );
+
+}
+
+
+/*
+ *  Look up pitch angle i. On a hit its results are filled in and TRUE is
+ *  returned.
+ */
+int Lgm_ResultsCache_GetPA( unsigned long Key, int i, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_ResultsCache        *rc = MagEphemInfo->ResultsCache;
+    Lgm_ResultsCacheRecord  r;
+    int                     Found;
+
+    Found = Lgm_ResultsCache_Find( Lgm_ResultsCache_PAKey( Key, MagEphemInfo->Alpha[i] ), LGM_RESULTS_CACHE_PA, &r, rc )
+                && ( r.v[0] == MagEphemInfo->Alpha[i] );
+    if ( Found ) Lgm_ResultsCache_SetPA( i, &r, MagEphemInfo );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_ResultsCache)
+#endif
+    {
+        if ( Found ) ++rc->nHits; else ++rc->nMisses;
+    }
+
+    return( Found );
+
+}
+
+
+/*
+ *  Store the results of the trace (LSimple is LGM_FILL_VALUE for FLs that
+ *  arent closed).
+ */
+void Lgm_ResultsCache_PutEpoch( unsigned long Key, double LSimple, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_ResultsCacheRecord  r;
+
+    memset( &r, 0, sizeof( r ) );
+    r.Key   = Key;
+    r.Kind  = LGM_RESULTS_CACHE_EPOCH;
+    r.Flag  = MagEphemInfo->FieldLineType;
+    r.v[0]  = MagEphemInfo->Ellipsoid_Footprint_Ps.x; r.v[1] = MagEphemInfo->Ellipsoid_Footprint_Ps.y; r.v[2] = MagEphemInfo->Ellipsoid_Footprint_Ps.z;
+    r.v[3]  = MagEphemInfo->Ellipsoid_Footprint_Pn.x; r.v[4] = MagEphemInfo->Ellipsoid_Footprint_Pn.y; r.v[5] = MagEphemInfo->Ellipsoid_Footprint_Pn.z;
+    r.v[6]  = MagEphemInfo->Pmin.x; r.v[7] = MagEphemInfo->Pmin.y; r.v[8] = MagEphemInfo->Pmin.z;
+    r.v[9]  = MagEphemInfo->Snorth;
+    r.v[10] = MagEphemInfo->Ssouth;
+    r.v[11] = MagEphemInfo->Smin;
+    r.v[12] = MagEphemInfo->Bmin;
+    r.v[13] = MagEphemInfo->Mref;
+    r.v[14] = MagEphemInfo->Mcurr;
+    r.v[15] = MagEphemInfo->Mused;
+    r.v[16] = MagEphemInfo->Sb0;
+    r.v[17] = MagEphemInfo->d2B_ds2;
+    r.v[18] = MagEphemInfo->RofC;
+    r.v[19] = LSimple;
+
+    Lgm_ResultsCache_Add( &r, MagEphemInfo->ResultsCache );
+
+}
+
+
+/*
+ *  Store the results of pitch angle i.
+ */
+void Lgm_ResultsCache_PutPA( unsigned long Key, int i, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_ResultsCacheRecord  r;
+
+    memset( &r, 0, sizeof( r ) );
+    r.Key   = Lgm_ResultsCache_PAKey( Key, MagEphemInfo->Alpha[i] );
+    r.Kind  = LGM_RESULTS_CACHE_PA;
+    r.Flag  = MagEphemInfo->DriftOrbitType[i];
+    r.v[0]  = MagEphemInfo->Alpha[i];
+    r.v[1]  = MagEphemInfo->Lstar[i];
+    r.v[2]  = MagEphemInfo->I[i];
+    r.v[3]  = MagEphemInfo->K[i];
+    r.v[4]  = MagEphemInfo->Sb[i];
+    r.v[5]  = MagEphemInfo->Tb[i];
+
+    Lgm_ResultsCache_Add( &r, MagEphemInfo->ResultsCache );
+
+}
@@ -1,3 +1,6 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_Sgp.h"
 #include "Lgm/qsort.h"
@@ -43,6 +46,7 @@ int LgmSgp_TleChecksum( char *Line ) {
  * Routine to sort the TLEs structure.
  */
 #define TLE_LESS_THAN(a,b) ((a)->JD < (b)->JD)
+#define INT_LESS_THAN(a,b) (*(a) < *(b))
 void LgmSgp_SortListOfTLEs( int nTLEs, _SgpTLE *TLEs ) {
     QSORT( _SgpTLE, TLEs, nTLEs, TLE_LESS_THAN );
 }
@@ -340,14 +344,13 @@ int LgmSgp_ReadTlesFromStrings( char *Line0, char *Line1, char *Line2, int *nTLE
 /*
  * Given Lines 0-2, decode the vals and populate vars in the _SgpTLE structure
  */
-void Lgm_SgpDecodeTle( char *Line0, char *Line1, char *Line2, _SgpTLE *TLE, int Verbosity ) {
+static void LgmSgp_DecodeTle( char *Line0, char *Line1, char *Line2, _SgpTLE *TLE, int Verbosity, Lgm_CTrans *c ) {
 
     char    str[40], *p;
     int     d2, yy, yyyy;
     int     hh, mm, ss, i, ll;
     long    d1;
     double  mu, gg;
-    Lgm_CTrans *c = Lgm_init_ctrans(0); // need this for JD calcs
 
     /*
      *  DECODE LINE 0
@@ -506,8 +509,261 @@ void Lgm_SgpDecodeTle( char *Line0, char *Line1, char *Line2, _SgpTLE *TLE, int
     TLE->Line2CheckSum = (int)(Line2[68] - '0');
     if (Verbosity > 3) printf("\t\tLine2CheckSum   = %d (passed)\n", TLE->Line2CheckSum);
 
+}
+
+void Lgm_SgpDecodeTle( char *Line0, char *Line1, char *Line2, _SgpTLE *TLE, int Verbosity ) {
+
+    Lgm_CTrans *c = Lgm_init_ctrans(0); // need this for JD calcs
+    LgmSgp_DecodeTle( Line0, Line1, Line2, TLE, Verbosity, c );
+    Lgm_free_ctrans( c );
+
+}
+
+
+
+
+/*
+ *  A store of TLEs that grows as TLEs are read into it, and an index (built
+ *  by LgmSgp_TleStore_Index(), or on the first lookup) that has the TLEs of
+ *  each object sorted by epoch, for quick lookups of the TLE to use for a
+ *  given object and time.
+ *
+ *  If nIds > 0, only TLEs with an IdNumber that is in Ids[] are kept.
+ */
+_SgpTleStore *LgmSgp_TleStore_Create( int nIds, int *Ids ) {
+
+    _SgpTleStore *st;
+
+    st = (_SgpTleStore *)calloc( 1, sizeof(_SgpTleStore) );
+
+    if ( nIds > 0 ) {
+        st->nIds = nIds;
+        st->Ids  = (int *)calloc( nIds, sizeof(int) );
+        memcpy( st->Ids, Ids, nIds*sizeof(int) );
+        QSORT( int, st->Ids, nIds, INT_LESS_THAN );
+    }
+
+    return( st );
+
+}
+
+void LgmSgp_TleStore_Free( _SgpTleStore *st ) {
+
+    if ( st == NULL ) return;
+    free( st->TLEs );
+    free( st->Ids );
+    free( st->Order );
+    free( st->JD );
+    free( st->SatId );
+    free( st->First );
+    free( st->Count );
+    free( st->Cursor );
+    free( st );
+
+}
+
+
+/*
+ *  Binary search a sorted int array. Returns the index of Id, or -1.
+ */
+static int LgmSgp_FindId( int n, int *a, int Id ) {
+
+    int il, ih, im;
+
+    il = 0; ih = n-1;
+    while ( il <= ih ) {
+        im = (il+ih)/2;
+        if      ( a[im] < Id ) il = im+1;
+        else if ( a[im] > Id ) ih = im-1;
+        else return( im );
+    }
+    return( -1 );
+
+}
+
+
+/*
+ *  Add a TLE to the store (unless it is filtered out). Line0 may be an
+ *  empty string. The lines must already have their line terminators
+ *  stripped. Returns TRUE if the TLE was added.
+ */
+static int LgmSgp_TleStore_Add( _SgpTleStore *st, char *Line0, char *Line1, char *Line2, int Verbosity, Lgm_CTrans *c ) {
+
+    char    str[6];
+
+    if ( st->nIds > 0 ) {
+        strncpy( str, Line1+2, 5 ); str[5] = '\0';
+        if ( LgmSgp_FindId( st->nIds, st->Ids, atoi(str) ) < 0 ) return( FALSE );
+    }
+
+    if ( Verbosity > 1 ) {
+        if ( (int)(Line1[68]-'0') != LgmSgp_TleChecksum( Line1 ) ) printf("LgmSgp_TleStore_Add: Checksum Error in Two Line Element Line#1.\n    Line1=\"%s\"\n\n", Line1);
+        if ( (int)(Line2[68]-'0') != LgmSgp_TleChecksum( Line2 ) ) printf("LgmSgp_TleStore_Add: Checksum Error in Two Line Element Line#2.\n    Line2=\"%s\"\n\n", Line2);
+    }
+
+    if ( st->nTLEs >= st->nAlloc ) {
+        st->nAlloc = ( st->nAlloc > 0 ) ? 2*st->nAlloc : 1024;
+        st->TLEs   = (_SgpTLE *)realloc( st->TLEs, st->nAlloc*sizeof(_SgpTLE) );
+    }
+
+    LgmSgp_DecodeTle( Line0, Line1, Line2, &st->TLEs[st->nTLEs], Verbosity, c );
+    ++st->nTLEs;
+    st->Indexed = FALSE;
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Read all of the TLEs in a file into the store. The file is read a line at
+ *  a time, and both the 3-line (name line first) and 2-line forms are
+ *  accepted (they can even be mixed). Lines that are not part of a TLE are
+ *  skipped. Returns the number of TLEs added, or -1 if the file couldnt be
+ *  opened.
+ */
+int LgmSgp_TleStore_ReadFile( _SgpTleStore *st, char *Filename, int Verbosity ) {
+
+    char        Line0[256], Line1[256], Line[256], *ptr;
+    int         nAdded, HaveLine1;
+    FILE        *fp;
+    Lgm_CTrans  *c;
+
+    if ( (fp = fopen( Filename, "rb" )) == NULL ) {
+        if (Verbosity > 0) printf("LgmSgp_TleStore_ReadFile: Couldn't open Two Line Element file: %s\n", Filename);
+        return( -1 );
+    }
+
+    c = Lgm_init_ctrans( 0 );
+
+    nAdded    = 0;
+    HaveLine1 = FALSE;
+    Line0[0]  = '\0';
+    while ( fgets( Line, 256, fp ) != NULL ) {
+
+        // strip dos or unix line terminators
+        if ( (ptr = strpbrk( Line, "\r\n" )) != NULL ) *ptr = '\0';
+
+        if ( ( Line[0] == '1' ) && ( Line[1] == ' ' ) && ( strlen( Line ) >= 69 ) ) {
+            strcpy( Line1, Line );
+            HaveLine1 = TRUE;
+        } else if ( HaveLine1 && ( Line[0] == '2' ) && ( Line[1] == ' ' ) && ( strlen( Line ) >= 69 ) ) {
+            nAdded += LgmSgp_TleStore_Add( st, Line0, Line1, Line, Verbosity, c );
+            HaveLine1 = FALSE;
+            Line0[0]  = '\0';
+        } else {
+            // could be the name line of the next TLE
+            strcpy( Line0, Line );
+            HaveLine1 = FALSE;
+        }
+
+    }
+
+    fclose( fp );
     Lgm_free_ctrans( c );
 
+    if (Verbosity > 1) printf("LgmSgp_TleStore_ReadFile: Read %d TLEs from %s (%d in store)\n", nAdded, Filename, st->nTLEs);
+
+    return( nAdded );
+
+}
+
+
+/*
+ *  Build the index. Order[] lists the TLEs sorted by IdNumber and then by
+ *  epoch, with JD[] the matching epochs, so that the TLEs of object SatId[k]
+ *  are Order[ First[k] ] ... Order[ First[k]+Count[k]-1 ]. The TLEs
+ *  themselves are not moved.
+ */
+void LgmSgp_TleStore_Index( _SgpTleStore *st ) {
+
+    int     i, n, k;
+    _SgpTLE *T;
+
+    n = st->nTLEs;
+    T = st->TLEs;
+
+    free( st->Order ); free( st->JD ); free( st->SatId ); free( st->First ); free( st->Count ); free( st->Cursor );
+    st->Order = (int *)calloc( n > 0 ? n : 1, sizeof(int) );
+    st->JD    = (double *)calloc( n > 0 ? n : 1, sizeof(double) );
+
+    for ( i=0; i<n; i++ ) st->Order[i] = i;
+    #define TLE_IDX_LESS_THAN(a,b) ( ( T[*(a)].IdNumber < T[*(b)].IdNumber ) || ( ( T[*(a)].IdNumber == T[*(b)].IdNumber ) && ( T[*(a)].JD < T[*(b)].JD ) ) )
+    QSORT( int, st->Order, n, TLE_IDX_LESS_THAN );
+
+    for ( st->nSats=0, i=0; i<n; i++ ) {
+        st->JD[i] = T[ st->Order[i] ].JD;
+        if ( ( i == 0 ) || ( T[ st->Order[i] ].IdNumber != T[ st->Order[i-1] ].IdNumber ) ) ++st->nSats;
+    }
+
+    st->SatId  = (int *)calloc( st->nSats > 0 ? st->nSats : 1, sizeof(int) );
+    st->First  = (int *)calloc( st->nSats > 0 ? st->nSats : 1, sizeof(int) );
+    st->Count  = (int *)calloc( st->nSats > 0 ? st->nSats : 1, sizeof(int) );
+    st->Cursor = (int *)calloc( st->nSats > 0 ? st->nSats : 1, sizeof(int) );
+    for ( k=-1, i=0; i<n; i++ ) {
+        if ( ( i == 0 ) || ( T[ st->Order[i] ].IdNumber != T[ st->Order[i-1] ].IdNumber ) ) {
+            ++k;
+            st->SatId[k]  = T[ st->Order[i] ].IdNumber;
+            st->First[k]  = i;
+            st->Cursor[k] = i;
+        }
+        ++st->Count[k];
+    }
+
+    st->Indexed = TRUE;
+
+}
+
+
+/*
+ *  Find the TLE to use for object IdNumber at time JD -- the one with the
+ *  latest epoch at or before JD (the last one if JD is past all of them).
+ *  Returns an index into st->TLEs, or -1 if there are no TLEs for the
+ *  object or JD is before the first of them.
+ *
+ *  Each object remembers where its last lookup ended up, and the search
+ *  starts from there, so a run of lookups with increasing (or constant) JD
+ *  costs O(1) each on average. Otherwise it is a binary search over the
+ *  object's TLEs. Because of this, lookups on one store shouldnt be done
+ *  from more than one thread at a time.
+ */
+int LgmSgp_TleStore_Find( _SgpTleStore *st, int IdNumber, double JD ) {
+
+    int     k, j, i0, i1, il, ih, im, nStep;
+    double  *t;
+
+    if ( !st->Indexed ) LgmSgp_TleStore_Index( st );
+
+    if ( (k = LgmSgp_FindId( st->nSats, st->SatId, IdNumber )) < 0 ) return( -1 );
+
+    t  = st->JD;
+    i0 = st->First[k];
+    i1 = i0 + st->Count[k] - 1;
+    if ( JD < t[i0] ) return( -1 );
+
+    j = st->Cursor[k];
+    if ( t[j] <= JD ) {
+        // walk forward a few TLEs
+        for ( nStep = 0; ( nStep < 4 ) && ( j < i1 ) && ( t[j+1] <= JD ); nStep++ ) ++j;
+        il = j;
+        ih = i1;
+    } else {
+        il = i0;
+        ih = j-1;
+    }
+
+    if ( ( il < ih ) && ( t[il+1] <= JD ) ) {
+        // binary search for the last t[] <= JD in [il, ih]; t[il] <= JD always holds
+        while ( il < ih ) {
+            im = (il+ih+1)/2;
+            if ( t[im] <= JD ) il = im;
+            else               ih = im-1;
+        }
+    }
+
+    st->Cursor[k] = il;
+    return( st->Order[il] );
+
 }
 
 
@@ -2283,3 +2539,259 @@ int LgmSgp_SGP4( double tsince, _SgpInfo *s ) {
 } // end sgp4
 
 
+
+
+
+
+/*
+ *  Near-Earth (method 'n') SGP4 over an array of times for one object. This
+ *  is the same arithmetic as LgmSgp_SGP4() (so the results are identical),
+ *  but the gravity constants and everything that depends only on the
+ *  elements are set up once, and none of the deep space branches are tested
+ *  inside the time loop.
+ */
+static int LgmSgp_SGP4_Near( _SgpInfo *s, int n, double *tsince, double *X, double *Y, double *Z,
+                             double *VX, double *VY, double *VZ, int *Error ) {
+
+    double  am, argpdf, argpm, axnl, aynl, betal, cnod, cos2u, coseo1=0.0, cosi, cosip;
+    double  cossu, cosu, delm, delomg, ecose, el2, em, eo1, esine, j2, j3, j3oj2, j4, mm;
+    double  mrt, mvt, nm, nodedf, nodem, pl, radiusearthkm, rdotl, rl, rvdot, rvdotl, sin2u;
+    double  sineo1=0.0, sini, sinip, sinsu, sinu, snod, su, t, t2, t3, t4, tem5, temp, temp1;
+    double  temp2, tempa, tempe, templ, tumin, u, ux, uy, uz, vkmpersec, vx, vy, vz, x2o3;
+    double  xinc, xke, xl, xlm, xmdf, xmx, xmy, xnode, tmp, pow_xke_no;
+    int     i, ktr, err, nGood;
+
+    x2o3 = 2.0 / 3.0;
+    LgmSgp_GetGravConst( s->GravConst, &tumin, &radiusearthkm, &xke, &j2, &j3, &j4, &j3oj2 );
+    vkmpersec  = radiusearthkm * xke/60.0;
+    pow_xke_no = pow( (xke/s->no), x2o3 );  // nm is always s->no for near-Earth objects
+    sinip      = sin( s->inclo );
+    cosip      = cos( s->inclo );
+
+    for ( nGood=0, i=0; i<n; i++ ) {
+
+        t = tsince[i];
+        err = 0;
+
+        /* ------- update for secular gravity and atmospheric drag ----- */
+        xmdf   = s->mo + s->mdot*t;
+        argpdf = s->argpo + s->argpdot*t;
+        nodedf = s->nodeo + s->nodedot*t;
+        argpm  = argpdf;
+        mm     = xmdf;
+        t2     = t*t;
+        nodem  = nodedf + s->nodecf*t2;
+        tempa  = 1.0 - s->cc1*t;
+        tempe  = s->bstar*s->cc4*t;
+        templ  = s->t2cof*t2;
+
+        if ( s->isimp != 1 ) {
+            delomg = s->omgcof*t;
+            tmp    = 1.0 + s->eta*cos(xmdf);
+            delm   = s->xmcof*(tmp*tmp*tmp - s->delmo);
+            temp   = delomg + delm;
+            mm     = xmdf + temp;
+            argpm  = argpdf - temp;
+            t3     = t2*t;
+            t4     = t3*t;
+            tempa  = tempa - s->d2*t2 - s->d3*t3 - s->d4*t4;
+            tempe  = tempe + s->bstar*s->cc5*(sin(mm) - s->sinmao);
+            templ  = templ + s->t3cof*t3 + t4*(s->t4cof + t*s->t5cof);
+        }
+
+        if ( s->no <= 0.0 ) {
+            err = 2;
+        } else {
+
+            am = pow_xke_no*tempa*tempa;
+            nm = xke/sqrt(am*am*am);
+            em = s->ecco - tempe;
+
+            if ( (em >= 1.0) || (em < -0.001) ) {
+                err = 1;
+            } else {
+
+                if (em < 1.0e-6) em = 1.0e-6;
+
+                mm   += s->no * templ;
+                xlm   = mm + argpm + nodem;
+
+                nodem = fmod( nodem, M_2PI );
+                argpm = fmod( argpm, M_2PI );
+                xlm   = fmod( xlm, M_2PI );
+                mm    = fmod( xlm - argpm - nodem, M_2PI );
+
+                /* -------------------- long period periodics ------------------ */
+                axnl = em*cos(argpm);
+                temp = 1.0/(am*(1.0 - em*em));
+                aynl = em*sin(argpm) + temp*s->aycof;
+                xl   = mm + argpm + nodem + temp*s->xlcof*axnl;
+
+                /* --------------------- solve kepler's equation --------------- */
+                u    = fmod(xl - nodem, M_2PI);
+                eo1  = u;
+                tem5 = 9999.9;
+                ktr  = 1;
+                while ( (fabs(tem5) >= 1.0e-12) && (ktr <= 10) ) {
+                    sineo1 = sin(eo1);
+                    coseo1 = cos(eo1);
+                    tem5   = 1.0 - coseo1*axnl - sineo1*aynl;
+                    tem5   = (u - aynl*coseo1 + axnl*sineo1 - eo1)/tem5;
+                    if(fabs(tem5) >= 0.95) tem5 = (tem5 > 0.0) ? 0.95 : -0.95;
+                    eo1 += tem5;
+                    ++ktr;
+                }
+
+                /* ------------- short period preliminary quantities ----------- */
+                ecose = axnl*coseo1 + aynl*sineo1;
+                esine = axnl*sineo1 - aynl*coseo1;
+                el2   = axnl*axnl + aynl*aynl;
+                pl    = am*(1.0-el2);
+
+                if ( pl < 0.0 ) {
+                    err = 4;
+                } else {
+
+                    rl     = am*(1.0 - ecose);
+                    rdotl  = sqrt(am)*esine/rl;
+                    rvdotl = sqrt(pl)/rl;
+                    betal  = sqrt(1.0 - el2);
+                    temp   = esine/(1.0 + betal);
+                    sinu   = am/rl*(sineo1 - aynl - axnl*temp);
+                    cosu   = am/rl*(coseo1 - axnl + aynl*temp);
+                    su     = atan2(sinu, cosu);
+                    sin2u  = (cosu + cosu)*sinu;
+                    cos2u  = 1.0 - 2.0*sinu*sinu;
+                    temp   = 1.0/pl;
+                    temp1  = 0.5*j2*temp;
+                    temp2  = temp1*temp;
+
+                    /* -------------- update for short period periodics ------------ */
+                    mrt   = rl*(1.0 - 1.5*temp2*betal* s->con41) + 0.5*temp1*s->x1mth2*cos2u;
+                    su    = su - 0.25*temp2*s->x7thm1*sin2u;
+                    xnode = nodem + 1.5*temp2*cosip*sin2u;
+                    xinc  = s->inclo + 1.5*temp2*cosip*sinip*cos2u;
+                    mvt   = rdotl - nm*temp1*s->x1mth2*sin2u/xke;
+                    rvdot = rvdotl + nm*temp1*(s->x1mth2*cos2u + 1.5*s->con41)/xke;
+
+                    if ( mrt < 1.0 ) {
+                        err = 6;
+                    } else {
+
+                        /* --------------------- orientation vectors ------------------- */
+                        sinsu = sin(su);
+                        cossu = cos(su);
+                        snod  = sin(xnode);
+                        cnod  = cos(xnode);
+                        sini  = sin(xinc);
+                        cosi  = cos(xinc);
+
+                        xmx = -snod * cosi;
+                        xmy = cnod * cosi;
+
+                        ux = xmx * sinsu + cnod * cossu;
+                        uy = xmy * sinsu + snod * cossu;
+                        uz = sini * sinsu;
+
+                        vx = xmx * cossu - cnod * sinsu;
+                        vy = xmy * cossu - snod * sinsu;
+                        vz = sini * cossu;
+
+                        /* --------- position and velocity (in km and km/sec) ---------- */
+                        X[i]  = (mrt * ux)* radiusearthkm;
+                        Y[i]  = (mrt * uy)* radiusearthkm;
+                        Z[i]  = (mrt * uz)* radiusearthkm;
+
+                        VX[i] = (mvt * ux + rvdot * vx) * vkmpersec;
+                        VY[i] = (mvt * uy + rvdot * vy) * vkmpersec;
+                        VZ[i] = (mvt * uz + rvdot * vz) * vkmpersec;
+
+                        ++nGood;
+                    }
+                }
+            }
+        }
+
+        if ( err ) X[i] = Y[i] = Z[i] = VX[i] = VY[i] = VZ[i] = LGM_FILL_VALUE;
+        if ( Error != NULL ) Error[i] = err;
+
+        s->t     = t;
+        s->error = err;
+
+    }
+
+    if ( n > 0 ) {
+        s->X  = X[n-1];  s->Y  = Y[n-1];  s->Z  = Z[n-1];
+        s->VX = VX[n-1]; s->VY = VY[n-1]; s->VZ = VZ[n-1];
+    }
+
+    return( nGood );
+
+}
+
+
+/*
+ *  Propagate one object (already set up with LgmSgp_SGP4_Init()) to the n
+ *  times tsince[] (minutes from epoch). Positions [km] and velocities [km/s]
+ *  (TEME) go into X[], Y[], Z[], VX[], VY[], VZ[], and the SGP4 error codes
+ *  into Error[] (if it isnt NULL). Samples that fail are set to
+ *  LGM_FILL_VALUE. Returns the number of good samples.
+ *
+ *  For deep space objects the resonance integrator state (atime, xli, xni)
+ *  is kept in s from one time to the next, so if the times are in order of
+ *  increasing |tsince| each call only integrates forward from the previous
+ *  time rather than from epoch. On return s holds the state of the last
+ *  sample, as it would after calling LgmSgp_SGP4() for each time in turn.
+ */
+int LgmSgp_SGP4_Times( _SgpInfo *s, int n, double *tsince, double *X, double *Y, double *Z,
+                       double *VX, double *VY, double *VZ, int *Error ) {
+
+    int i, nGood;
+
+    if ( s->method != 'd' ) return( LgmSgp_SGP4_Near( s, n, tsince, X, Y, Z, VX, VY, VZ, Error ) );
+
+    for ( nGood=0, i=0; i<n; i++ ) {
+        nGood += LgmSgp_SGP4( tsince[i], s );
+        X[i]  = s->X;  Y[i]  = s->Y;  Z[i]  = s->Z;
+        VX[i] = s->VX; VY[i] = s->VY; VZ[i] = s->VZ;
+        if ( Error != NULL ) Error[i] = s->error;
+    }
+
+    return( nGood );
+
+}
+
+
+/*
+ *  Propagate nSat objects to the same nTimes Julian Dates JD[]. s[k] must
+ *  have been set up with LgmSgp_SGP4_Init( &s[k], &t[k] ); tsince is worked
+ *  out from the epoch t[k].JD. The outputs are [nSat][nTimes] (e.g. made
+ *  with LGM_ARRAY_2D), with Error allowed to be NULL. Objects are split over
+ *  threads (each s[k] is only touched by one thread). Returns the total
+ *  number of good samples.
+ */
+int LgmSgp_SGP4_Batch( int nSat, _SgpInfo *s, _SgpTLE *t, int nTimes, double *JD,
+                       double **X, double **Y, double **Z, double **VX, double **VY, double **VZ, int **Error ) {
+
+    int     k, i, nGood;
+    double  *tsince;
+
+    nGood = 0;
+    #if USE_OPENMP
+    #pragma omp parallel private(k,i,tsince) reduction(+:nGood) if(nSat>1)
+    #endif
+    {
+        tsince = (double *)calloc( nTimes > 0 ? nTimes : 1, sizeof(double) );
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic,1)
+        #endif
+        for ( k=0; k<nSat; k++ ) {
+            for ( i=0; i<nTimes; i++ ) tsince[i] = (JD[i] - t[k].JD)*1440.0;
+            nGood += LgmSgp_SGP4_Times( &s[k], nTimes, tsince, X[k], Y[k], Z[k], VX[k], VY[k], VZ[k], (Error != NULL) ? Error[k] : NULL );
+        }
+        free( tsince );
+    }
+
+    return( nGood );
+
+}
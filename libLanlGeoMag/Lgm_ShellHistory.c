@@ -0,0 +1,211 @@
+/*! \file Lgm_ShellHistory.c
+ *
+ *  \brief Remember the drift shell found for each pitch angle so the next epoch can start from it.
+ *
+ *  In a time series (e.g. MagEphem at 1-minute cadence) the drift shell for a
+ *  given pitch angle hardly changes from one epoch to the next. Lstar()
+ *  normally predicts where each shell line is from the lines it has already
+ *  found at the same epoch, which is a poor guess for the first few lines
+ *  and means wide brackets (+/- 3 degrees) for FindShellLine(). If an
+ *  Lgm_ShellHistory is attached to the Lgm_LstarInfo structure, Lstar()
+ *  instead takes the shell it found last time for this pitch angle, shifts
+ *  it to agree with the line just found, and uses that as the prediction
+ *  with a bracket that is only a little wider than the last prediction
+ *  error (see Lstar()).
+ *
+ *  The bracket is only a guess. If it doesnt hold the line, Lstar_ShellLine()
+ *  widens it exactly as it would have anyway, so the answers agree with the
+ *  ones found without a history to within the search tolerances. A saved
+ *  shell is not used at all if, at the MLT of the starting point, it is more
+ *  than MaxShift degrees from the new one.
+ *
+ *  Entries are matched on LstarInfo->PitchAngle and ISearchMethod.
+ *  Lgm_CopyLstarInfo() shares the history with its copies, and entries are
+ *  only read or written inside the Lgm_ShellHistory critical section (hits
+ *  are copied out), so the threads of Lgm_ComputeLstarVersusPA() can all use
+ *  one history. Use one history per trajectory, e.g.
+ *
+ *      MagEphemInfo->LstarInfo->ShellHistory = Lgm_InitShellHistory( -1.0 );
+ *      for ( each time step ) {
+ *          ...  Lgm_ComputeLstarVersusPA( ..., MagEphemInfo );
+ *      }
+ *      Lgm_FreeShellHistory( MagEphemInfo->LstarInfo->ShellHistory );
+ *      MagEphemInfo->LstarInfo->ShellHistory = NULL;
+ *
+ *  Call Lgm_ResetShellHistory() if the time series has a big gap.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+
+#define LGM_SHELLHIST_PA_TOL    1e-6    // Pitch angles (degrees) closer than this are the same
+
+
+/*
+ *  Allocate an empty history. MaxShift (<= 0 gives 5 degrees) is how far, in
+ *  mlat, a saved shell can be from the new one and still be used.
+ */
+Lgm_ShellHistory *Lgm_InitShellHistory( double MaxShift ) {
+
+    Lgm_ShellHistory *h;
+
+    h = (Lgm_ShellHistory *) calloc( 1, sizeof( *h ) );
+    h->MaxShift = ( MaxShift > 0.0 ) ? MaxShift : 5.0;
+
+    return( h );
+
+}
+
+
+void Lgm_FreeShellHistory( Lgm_ShellHistory *h ) {
+
+    if ( h == NULL ) return;
+    free( h->Entries );
+    free( h );
+
+}
+
+
+/*
+ *  Forget all of the shells (the counters are kept).
+ */
+void Lgm_ResetShellHistory( Lgm_ShellHistory *h ) {
+
+    if ( h == NULL ) return;
+    h->nEntries = 0;
+
+}
+
+
+static int Lgm_ShellHistory_Find( Lgm_ShellHistory *h, double PitchAngle, int ISearchMethod ) {
+
+    int i;
+
+    for ( i=0; i<h->nEntries; i++ ) {
+        if ( ( h->Entries[i].ISearchMethod == ISearchMethod ) && ( fabs( h->Entries[i].PitchAngle - PitchAngle ) < LGM_SHELLHIST_PA_TOL ) ) return( i );
+    }
+
+    return( -1 );
+
+}
+
+
+/*
+ *  Copy out the last shell saved for PitchAngle (and ISearchMethod). Returns
+ *  FALSE if there isnt one.
+ */
+int Lgm_ShellHistory_Get( Lgm_ShellHistory *h, double PitchAngle, int ISearchMethod, Lgm_ShellHistoryEntry *e ) {
+
+    int i, Found = FALSE;
+
+    if ( h == NULL ) return( FALSE );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_ShellHistory)
+#endif
+    {
+        if ( ( i = Lgm_ShellHistory_Find( h, PitchAngle, ISearchMethod ) ) >= 0 ) {
+            *e = h->Entries[i];
+            Found = TRUE;
+            ++h->nHits;
+        } else {
+            ++h->nMisses;
+        }
+    }
+
+    return( Found );
+
+}
+
+
+/*
+ *  Fill in e with the nPnts shell lines MLT[], mlat[] (in any order). Used
+ *  for history entries and for the neighbouring pitch angle shells that
+ *  Lgm_ComputeLstarVersusPA() hands from one pitch angle to the next (see
+ *  LstarInfo->NestedShell).
+ */
+void Lgm_ShellHistory_SetEntry( Lgm_ShellHistoryEntry *e, double PitchAngle, int ISearchMethod, int nPnts, double *MLT, double *mlat ) {
+
+    int j, k;
+
+    e->PitchAngle    = PitchAngle;
+    e->ISearchMethod = ISearchMethod;
+    if ( ( nPnts < 2 ) || ( nPnts > LGM_LSTARINFO_MAX_FL ) ) {
+        e->nPnts = 0;
+        return;
+    }
+    e->nPnts = nPnts;
+
+    /*
+     *  Wrap into 0-24h and insertion sort (the lines come in MLT order
+     *  from the starting MLT, so this is nearly sorted already).
+     */
+    for ( k=0; k<nPnts; k++ ) {
+        double  t = fmod( MLT[k], 24.0 ), m = mlat[k];
+        if ( t < 0.0 ) t += 24.0;
+        for ( j=k; ( j > 0 ) && ( e->MLT[j-1] > t ); j-- ) {
+            e->MLT[j]  = e->MLT[j-1];
+            e->mlat[j] = e->mlat[j-1];
+        }
+        e->MLT[j]  = t;
+        e->mlat[j] = m;
+    }
+
+}
+
+
+/*
+ *  Save (or replace) the shell for PitchAngle. MLT[] and mlat[] are the nPnts
+ *  shell lines, in any order.
+ */
+void Lgm_ShellHistory_Save( Lgm_ShellHistory *h, double PitchAngle, int ISearchMethod, int nPnts, double *MLT, double *mlat ) {
+
+    int i;
+
+    if ( ( h == NULL ) || ( nPnts < 2 ) || ( nPnts > LGM_LSTARINFO_MAX_FL ) ) return;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_ShellHistory)
+#endif
+    {
+        if ( ( i = Lgm_ShellHistory_Find( h, PitchAngle, ISearchMethod ) ) < 0 ) {
+            if ( h->nEntries >= h->nAlloced ) {
+                h->nAlloced = 2*h->nAlloced + 8;
+                h->Entries  = (Lgm_ShellHistoryEntry *) realloc( h->Entries, h->nAlloced*sizeof( Lgm_ShellHistoryEntry ) );
+            }
+            i = h->nEntries++;
+        }
+        Lgm_ShellHistory_SetEntry( &h->Entries[i], PitchAngle, ISearchMethod, nPnts, MLT, mlat );
+    }
+
+}
+
+
+/*
+ *  mlat of a saved shell at MLT (linear, periodic in MLT).
+ */
+double Lgm_ShellHistory_Mlat( Lgm_ShellHistoryEntry *e, double MLT ) {
+
+    int     k, n = e->nPnts;
+    double  t, t0, t1;
+
+    t = fmod( MLT, 24.0 ); if ( t < 0.0 ) t += 24.0;
+
+    for ( k=0; ( k < n ) && ( e->MLT[k] <= t ); k++ );
+    if ( ( k == 0 ) || ( k == n ) ) {
+        // between the last line and the first one (across 24h)
+        t0 = e->MLT[n-1] - 24.0; t1 = e->MLT[0];
+        if ( t > t1 ) t -= 24.0;
+        return( ( t1 > t0 ) ? e->mlat[n-1] + ( t - t0 )*( e->mlat[0] - e->mlat[n-1] )/( t1 - t0 ) : e->mlat[0] );
+    }
+
+    t0 = e->MLT[k-1]; t1 = e->MLT[k];
+    return( ( t1 > t0 ) ? e->mlat[k-1] + ( t - t0 )*( e->mlat[k] - e->mlat[k-1] )/( t1 - t0 ) : e->mlat[k] );
+
+}
@@ -0,0 +1,247 @@
+/*! \file Lgm_ShmCache.c
+ *
+ *  \brief Share built tables between processes through POSIX shared memory.
+ *
+ *  \details
+ *      Batch campaigns often run many independent processes (one per day, per
+ *      spacecraft, ...) on the same node, and each of them builds the same
+ *      gridded fields and L* tables for the same model states. With
+ *      Lgm_SetShmCache( TRUE ) (or LGM_SHM_CACHE=1 in the environment) the
+ *      first process to build one publishes it in a shared memory segment
+ *      (/dev/shm/lgm-v1-<uid>-<kind>-<key>), and the others find it there
+ *      and map it read-only instead of building it again:
+ *
+ *          - Lgm_B_Gridded_Build() (and so Lgm_B_GriddedSeries_Set()) grids.
+ *            These are used straight from the mapping, so the node only
+ *            holds one copy of each grid however many processes use it.
+ *          - Lgm_ComputeLstarTable() tables. These get refined in place, so
+ *            they are copied out of the mapping (which still saves building
+ *            them).
+ *
+ *      The key is built by the caller from Lgm_ModelFingerprint() (which,
+ *      unlike Lgm_ModelParamsHash(), is the same in every process) and
+ *      whatever else the table depends on. A segment is created with O_EXCL,
+ *      filled in, and only then marked ready, so a process never sees a
+ *      half written one; a segment that isnt ready (being written, or left
+ *      behind by a process that died while writing it) or that doesnt check
+ *      out is treated as missing and the table is just built locally. Nobody
+ *      ever waits on anybody else. Segments are only readable by the user
+ *      that made them and they stay until they are removed
+ *      (Lgm_ShmCache_Remove(), or rm /dev/shm/lgm-*) or the node reboots.
+ *
+ *      Other tables dont need this: the TS07D coefficient and Qin-Denton
+ *      archives are already mmap()'ed files (so they are shared through the
+ *      page cache), the EOP series has its binary cache (LgmEop.bin), and
+ *      the decoded AE8/AP8 maps take a few ms to make.
+ *
+ *      Without shm_open() (or mmap()) everything here does nothing, and
+ *      the tables are always built locally.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "Lgm/Lgm_ShmCache.h"
+
+#define LGM_SHM_MAGIC       0x4c474d53      // "LGMS"
+#define LGM_SHM_VERSION     1
+
+typedef struct Lgm_ShmHeader {
+    unsigned int    Magic;
+    unsigned int    Version;
+    int             Kind;
+    unsigned long   Key;
+    size_t          Size;                   // Bytes of data (after the header)
+    volatile int    Ready;                  // Set last, once the data is all there
+} Lgm_ShmHeader;
+
+static int Lgm_ShmCacheFlag = -1;           // -1 until set (or read from LGM_SHM_CACHE)
+
+
+/**
+ *  Turn the shared memory cache on or off (see the notes at the top of the
+ *  file). Off by default, unless LGM_SHM_CACHE is set to a non-zero value in
+ *  the environment. Like Lgm_SetExecutor() this is a global setting.
+ */
+void Lgm_SetShmCache( int Flag ) {
+    Lgm_ShmCacheFlag = ( Flag != 0 );
+}
+
+int Lgm_GetShmCache( void ) {
+    char *p;
+    if ( Lgm_ShmCacheFlag < 0 ) Lgm_ShmCacheFlag = ( ( (p = getenv( "LGM_SHM_CACHE" )) != NULL ) && ( atoi( p ) != 0 ) );
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+    return( Lgm_ShmCacheFlag );
+#else
+    return( 0 );
+#endif
+}
+
+
+/**
+ *  Fold n bytes at p into the key h (FNV-1a). Keys start from
+ *  Lgm_ModelFingerprint() and then take in whatever else the table depends
+ *  on (time, grid, tolerances, ...).
+ */
+unsigned long Lgm_ShmCache_Key( unsigned long h, const void *p, size_t n ) {
+
+    const unsigned char *b = (const unsigned char *)p;
+    size_t              i;
+
+    for ( i=0; i<n; ++i ) {
+        h ^= b[i];
+        h *= 1099511628211UL;
+    }
+
+    return( h );
+
+}
+
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN)
+
+static void Lgm_ShmCache_Name( int Kind, unsigned long Key, char *Name ) {
+    snprintf( Name, 128, "/lgm-v%d-%d-%d-%016lx", LGM_SHM_VERSION, (int)getuid(), Kind, Key );
+}
+
+
+/**
+ *  Map the segment for (Kind, Key) read-only, if there is a ready one.
+ *
+ *      \param[in]      Kind    LGM_SHM_* kind of table.
+ *      \param[in]      Key     Key of the table.
+ *      \param[out]     Size    Bytes of data.
+ *
+ *      \return         The data (give it back with Lgm_ShmCache_Release()), or NULL.
+ */
+void *Lgm_ShmCache_Find( int Kind, unsigned long Key, size_t *Size ) {
+
+    char            Name[128];
+    int             fd;
+    struct stat     st;
+    void            *p;
+    Lgm_ShmHeader   *h;
+
+    if ( !Lgm_GetShmCache() ) return( NULL );
+
+    Lgm_ShmCache_Name( Kind, Key, Name );
+    if ( (fd = shm_open( Name, O_RDONLY, 0 )) < 0 ) return( NULL );
+    if ( ( fstat( fd, &st ) != 0 ) || ( st.st_uid != getuid() ) || ( st.st_size < LGM_SHM_HEADER_SIZE ) ) {
+        close( fd );
+        return( NULL );
+    }
+    p = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( p == MAP_FAILED ) return( NULL );
+
+    h = (Lgm_ShmHeader *)p;
+    if ( !h->Ready ) {
+        munmap( p, st.st_size );
+        return( NULL );
+    }
+    __sync_synchronize();
+    if ( ( h->Magic != LGM_SHM_MAGIC ) || ( h->Version != LGM_SHM_VERSION ) || ( h->Kind != Kind ) || ( h->Key != Key )
+            || ( h->Size + LGM_SHM_HEADER_SIZE != (size_t)st.st_size ) ) {
+        munmap( p, st.st_size );
+        return( NULL );
+    }
+
+    *Size = h->Size;
+    return( (char *)p + LGM_SHM_HEADER_SIZE );
+
+}
+
+
+/**
+ *  Put a copy of Data in a new segment for (Kind, Key), and map that
+ *  read-only.
+ *
+ *      \return         The shared copy (give it back with Lgm_ShmCache_Release()),
+ *                      or NULL if it couldnt be made (e.g. another process
+ *                      is making it right now); the caller then just keeps
+ *                      its own copy.
+ */
+void *Lgm_ShmCache_Publish( int Kind, unsigned long Key, const void *Data, size_t Size ) {
+
+    char            Name[128];
+    int             fd;
+    size_t          Total = Size + LGM_SHM_HEADER_SIZE;
+    void            *p;
+    Lgm_ShmHeader   *h;
+
+    if ( !Lgm_GetShmCache() ) return( NULL );
+
+    Lgm_ShmCache_Name( Kind, Key, Name );
+    if ( (fd = shm_open( Name, O_RDWR | O_CREAT | O_EXCL, 0600 )) < 0 ) return( NULL );
+    if ( ( ftruncate( fd, (off_t)Total ) != 0 )
+            || ( (p = mmap( NULL, Total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 )) == MAP_FAILED ) ) {
+        // e.g. /dev/shm is full
+        close( fd );
+        shm_unlink( Name );
+        return( NULL );
+    }
+    close( fd );
+
+    h = (Lgm_ShmHeader *)p;
+    h->Magic   = LGM_SHM_MAGIC;
+    h->Version = LGM_SHM_VERSION;
+    h->Kind    = Kind;
+    h->Key     = Key;
+    h->Size    = Size;
+    memcpy( (char *)p + LGM_SHM_HEADER_SIZE, Data, Size );
+    __sync_synchronize();
+    h->Ready   = 1;
+
+    mprotect( p, Total, PROT_READ );    // from here on it is read-only for us too
+
+    return( (char *)p + LGM_SHM_HEADER_SIZE );
+
+}
+
+
+/**
+ *  Unmap data got from Lgm_ShmCache_Find() or Lgm_ShmCache_Publish(). The
+ *  segment itself stays for other processes.
+ */
+void Lgm_ShmCache_Release( void *Data ) {
+
+    Lgm_ShmHeader   *h;
+
+    if ( Data == NULL ) return;
+    h = (Lgm_ShmHeader *)( (char *)Data - LGM_SHM_HEADER_SIZE );
+    munmap( (void *)h, h->Size + LGM_SHM_HEADER_SIZE );
+
+}
+
+
+/**
+ *  Remove the segment for (Kind, Key). Processes that have it mapped keep
+ *  their mapping.
+ *
+ *      \return         TRUE if there was one.
+ */
+int Lgm_ShmCache_Remove( int Kind, unsigned long Key ) {
+
+    char    Name[128];
+
+    Lgm_ShmCache_Name( Kind, Key, Name );
+    return( shm_unlink( Name ) == 0 );
+
+}
+
+#else
+
+void *Lgm_ShmCache_Find( int Kind, unsigned long Key, size_t *Size ) { return( NULL ); }
+void *Lgm_ShmCache_Publish( int Kind, unsigned long Key, const void *Data, size_t Size ) { return( NULL ); }
+void  Lgm_ShmCache_Release( void *Data ) { }
+int   Lgm_ShmCache_Remove( int Kind, unsigned long Key ) { return( 0 ); }
+
+#endif
@@ -0,0 +1,513 @@
+/*! \file Lgm_Sink.c
+ *
+ *  \brief Text output files that are gzip'ed as they are written.
+ *
+ *  The text MagEphem and LCDS files used to be written plain and gzip'ed
+ *  afterwards by scripts, so every byte went to disk twice (and on shared
+ *  filesystems the writing is what takes the time). A Lgm_Sink is an output
+ *  file whose name says whether it gets compressed:
+ *
+ *      Lgm_Sink *s = Lgm_Sink_Open( "20130201_rbspa_MagEphem.txt.gz", "w", 0 );
+ *      Lgm_WriteMagEphemHeader( s->fp, ... );
+ *      for ( each row ) {
+ *          Lgm_WriteMagEphemData( s->fp, ... );
+ *          if ( time for a checkpoint ) Checkpoint_Write( nRows, Lgm_Sink_Flush( s ), ... );
+ *      }
+ *      Lgm_Sink_Close( s );
+ *
+ *  s->fp is an ordinary FILE *, so the writers dont change. If the name ends
+ *  in ".gz", the text is cut into LGM_SINK_BLOCK_SIZE blocks and each block
+ *  is compressed into a gzip member by a pool of compressor threads while
+ *  the program carries on. A writer thread puts the members into the file
+ *  in order. A file made of several gzip members is still a valid gzip
+ *  file (gzip -d, zcat, zlib's gzread() and Python's gzip module all read
+ *  it as the concatenated text).
+ *
+ *  Lgm_Sink_Flush() ends the current block and waits until everything so
+ *  far is in the file, so its return value (the file size then) is always
+ *  at the end of a member. That is what the tools' checkpoints record, so
+ *  truncating a compressed file back to a checkpoint (and appending to it
+ *  with mode "a") gives a valid file, same as for plain ones.
+ *
+ *  Lgm_OpenSource() is the matching reader: it opens plain and gzip'ed files
+ *  alike, and gives back a FILE * that reads the uncompressed text.
+ *
+ *  Compression needs zlib, pthreads and fopencookie() (or BSD funopen()).
+ *  Without them, ".gz" sinks cant be opened and Lgm_OpenSource() only reads
+ *  plain files.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // fopencookie()
+#endif
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "Lgm/Lgm_Sink.h"
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_PTHREAD_H) && ( defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN) )
+#define LGM_SINK_GZIP 1
+#include <zlib.h>
+#include <pthread.h>
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+
+/**
+ *  TRUE if Filename ends in ".gz".
+ */
+int Lgm_Sink_IsGzipName( const char *Filename ) {
+
+    size_t  n = strlen( Filename );
+
+    return( ( n > 3 ) && !strcmp( Filename + n - 3, ".gz" ) );
+
+}
+
+
+#ifdef LGM_SINK_GZIP
+
+#define LGM_SINK_QUEUED     0
+#define LGM_SINK_BUSY       1
+#define LGM_SINK_DONE       2
+
+typedef struct Lgm_SinkBlock {
+    char                    *In;        // the text
+    size_t                  nIn;
+    unsigned char           *Out;       // the gzip member
+    size_t                  nOut;
+    int                     State;      // LGM_SINK_QUEUED, BUSY or DONE
+    struct Lgm_SinkBlock    *Next;
+} Lgm_SinkBlock;
+
+typedef struct Lgm_GzSink {
+    int             fd;
+    Lgm_SinkBlock   *Cur;               // block being filled by the writes
+    Lgm_SinkBlock   *Head, *Tail;       // blocks handed over, in file order
+    int             nQueued;            // ... how many (not yet in the file)
+    int             MaxQueued;          // writes wait when there are this many
+    long int        nBlocks;            // blocks handed over so far
+    long int        nBytes;             // bytes in the file
+    int             Stop;               // TRUE once closing
+    int             Error;              // TRUE if a write failed
+    int             nThreads;
+    pthread_t       *Threads;           // the compressors
+    pthread_t       Writer;
+    pthread_mutex_t Lock;
+    pthread_cond_t  Cond;               // broadcast whenever anything changes
+} Lgm_GzSink;
+
+
+static Lgm_SinkBlock *Lgm_SinkBlock_Alloc( void ) {
+
+    Lgm_SinkBlock   *b = (Lgm_SinkBlock *)calloc( 1, sizeof(Lgm_SinkBlock) );
+
+    b->In = (char *)malloc( LGM_SINK_BLOCK_SIZE );
+
+    return( b );
+
+}
+
+static void Lgm_SinkBlock_Free( Lgm_SinkBlock *b ) {
+
+    free( b->In );
+    free( b->Out );
+    free( b );
+
+}
+
+/*
+ *  Compress a block into a complete gzip member.
+ */
+static void Lgm_SinkBlock_Compress( Lgm_SinkBlock *b ) {
+
+    z_stream    z;
+
+    memset( &z, 0, sizeof(z) );
+    deflateInit2( &z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY );
+    b->Out = (unsigned char *)malloc( deflateBound( &z, b->nIn ) );
+    z.next_in   = (unsigned char *)b->In;
+    z.avail_in  = b->nIn;
+    z.next_out  = b->Out;
+    z.avail_out = deflateBound( &z, b->nIn );
+    deflate( &z, Z_FINISH );
+    b->nOut = z.total_out;
+    deflateEnd( &z );
+
+}
+
+
+/*
+ *  Compressor thread: take the first queued block, compress it, repeat.
+ */
+static void *Lgm_GzSink_Compressor( void *Data ) {
+
+    Lgm_GzSink      *g = (Lgm_GzSink *)Data;
+    Lgm_SinkBlock   *b;
+
+    pthread_mutex_lock( &g->Lock );
+    while ( 1 ) {
+        for ( b = g->Head; ( b != NULL ) && ( b->State != LGM_SINK_QUEUED ); b = b->Next );
+        if ( b != NULL ) {
+            b->State = LGM_SINK_BUSY;
+            pthread_mutex_unlock( &g->Lock );
+            Lgm_SinkBlock_Compress( b );
+            pthread_mutex_lock( &g->Lock );
+            b->State = LGM_SINK_DONE;
+            pthread_cond_broadcast( &g->Cond );
+        } else if ( g->Stop ) {
+            break;
+        } else {
+            pthread_cond_wait( &g->Cond, &g->Lock );
+        }
+    }
+    pthread_mutex_unlock( &g->Lock );
+
+    return( NULL );
+
+}
+
+
+/*
+ *  Writer thread: put the compressed blocks into the file, in order.
+ */
+static void *Lgm_GzSink_Writer( void *Data ) {
+
+    Lgm_GzSink      *g = (Lgm_GzSink *)Data;
+    Lgm_SinkBlock   *b;
+    size_t          n;
+    ssize_t         w;
+    int             Error;
+
+    pthread_mutex_lock( &g->Lock );
+    while ( 1 ) {
+        b = g->Head;
+        if ( ( b != NULL ) && ( b->State == LGM_SINK_DONE ) ) {
+            g->Head = b->Next;
+            if ( g->Head == NULL ) g->Tail = NULL;
+            Error = g->Error;
+            pthread_mutex_unlock( &g->Lock );
+            for ( n = 0; !Error && ( n < b->nOut ); n += w ) {
+                if ( (w = write( g->fd, b->Out + n, b->nOut - n )) <= 0 ) Error = TRUE;
+            }
+            pthread_mutex_lock( &g->Lock );
+            g->nBytes += n;
+            g->Error  |= Error;
+            --g->nQueued;
+            Lgm_SinkBlock_Free( b );
+            pthread_cond_broadcast( &g->Cond );
+        } else if ( g->Stop && ( b == NULL ) ) {
+            break;
+        } else {
+            pthread_cond_wait( &g->Cond, &g->Lock );
+        }
+    }
+    pthread_mutex_unlock( &g->Lock );
+
+    return( NULL );
+
+}
+
+
+/*
+ *  Hand the current block over to be compressed (waiting if too many are
+ *  in the pipe already). Empty blocks are only handed over if Empty is
+ *  TRUE (so that an empty file still gets one member).
+ */
+static void Lgm_GzSink_Queue( Lgm_GzSink *g, int Empty ) {
+
+    Lgm_SinkBlock   *b = g->Cur;
+
+    if ( ( b->nIn == 0 ) && !Empty ) return;
+
+    pthread_mutex_lock( &g->Lock );
+    while ( g->nQueued >= g->MaxQueued ) pthread_cond_wait( &g->Cond, &g->Lock );
+    b->State = LGM_SINK_QUEUED;
+    if ( g->Tail ) g->Tail->Next = b; else g->Head = b;
+    g->Tail = b;
+    ++g->nQueued;
+    ++g->nBlocks;
+    pthread_cond_broadcast( &g->Cond );
+    pthread_mutex_unlock( &g->Lock );
+
+    g->Cur = Lgm_SinkBlock_Alloc( );
+
+}
+
+
+/*
+ *  The stdio side (the cookie functions).
+ */
+static ssize_t Lgm_GzSink_Write( void *Cookie, const char *Buf, size_t Size ) {
+
+    Lgm_GzSink  *g = (Lgm_GzSink *)Cookie;
+    size_t      n, Done = 0;
+
+    while ( Done < Size ) {
+        n = LGM_SINK_BLOCK_SIZE - g->Cur->nIn;
+        if ( n > Size - Done ) n = Size - Done;
+        memcpy( g->Cur->In + g->Cur->nIn, Buf + Done, n );
+        g->Cur->nIn += n;
+        Done        += n;
+        if ( g->Cur->nIn == LGM_SINK_BLOCK_SIZE ) Lgm_GzSink_Queue( g, FALSE );
+    }
+
+    return( Size );
+
+}
+
+static int Lgm_GzSink_Close( void *Cookie ) {
+
+    Lgm_GzSink  *g = (Lgm_GzSink *)Cookie;
+    int         i, Error;
+
+    Lgm_GzSink_Queue( g, g->nBlocks == 0 );
+    Lgm_SinkBlock_Free( g->Cur );
+
+    pthread_mutex_lock( &g->Lock );
+    g->Stop = TRUE;
+    pthread_cond_broadcast( &g->Cond );
+    pthread_mutex_unlock( &g->Lock );
+    for ( i=0; i<g->nThreads; i++ ) pthread_join( g->Threads[i], NULL );
+    pthread_join( g->Writer, NULL );
+
+    pthread_mutex_destroy( &g->Lock );
+    pthread_cond_destroy( &g->Cond );
+    Error = g->Error;
+    if ( close( g->fd ) ) Error = TRUE;
+    free( g->Threads );
+    free( g );
+
+    return( Error ? EOF : 0 );
+
+}
+
+#ifdef HAVE_FUNOPEN
+static int Lgm_GzSink_Write_BSD( void *Cookie, const char *Buf, int Size ) {
+    return( (int)Lgm_GzSink_Write( Cookie, Buf, (size_t)Size ) );
+}
+#endif
+
+
+/*
+ *  Start the threads and make the FILE * for a compressed sink.
+ */
+static FILE *Lgm_GzSink_Open( const char *Filename, const char *Mode, int nThreads, long int *nBytes, void **Gz ) {
+
+    Lgm_GzSink  *g;
+    int         i, fd, Flags;
+    FILE        *fp;
+#ifdef HAVE_FOPENCOOKIE
+    cookie_io_functions_t   Io = { NULL, Lgm_GzSink_Write, NULL, Lgm_GzSink_Close };
+#endif
+
+    Flags = ( Mode[0] == 'a' ) ? O_WRONLY | O_CREAT | O_APPEND : O_WRONLY | O_CREAT | O_TRUNC;
+    if ( (fd = open( Filename, Flags, 0666 )) < 0 ) return( NULL );
+
+    g = (Lgm_GzSink *)calloc( 1, sizeof(Lgm_GzSink) );
+    g->fd        = fd;
+    g->nBytes    = lseek( fd, 0, SEEK_END );
+    g->nThreads  = ( nThreads > 0 ) ? nThreads : LGM_SINK_THREADS;
+    g->MaxQueued = 2*g->nThreads + 2;
+    g->Cur       = Lgm_SinkBlock_Alloc( );
+    g->Threads   = (pthread_t *)calloc( g->nThreads, sizeof(pthread_t) );
+    pthread_mutex_init( &g->Lock, NULL );
+    pthread_cond_init( &g->Cond, NULL );
+    for ( i=0; i<g->nThreads; i++ ) pthread_create( &g->Threads[i], NULL, Lgm_GzSink_Compressor, (void *)g );
+    pthread_create( &g->Writer, NULL, Lgm_GzSink_Writer, (void *)g );
+
+#ifdef HAVE_FOPENCOOKIE
+    fp = fopencookie( (void *)g, "w", Io );
+#else
+    fp = funopen( (void *)g, NULL, Lgm_GzSink_Write_BSD, NULL, Lgm_GzSink_Close );
+#endif
+    if ( fp == NULL ) {
+        Lgm_GzSink_Close( (void *)g );
+        return( NULL );
+    }
+    setvbuf( fp, NULL, _IOFBF, 65536 );
+
+    *nBytes = g->nBytes;
+    *Gz     = (void *)g;
+
+    return( fp );
+
+}
+
+/*
+ *  Put everything written so far into the file. Returns the file's size.
+ */
+static long int Lgm_GzSink_Flush( Lgm_GzSink *g ) {
+
+    long int    n;
+
+    Lgm_GzSink_Queue( g, FALSE );
+    pthread_mutex_lock( &g->Lock );
+    while ( g->nQueued > 0 ) pthread_cond_wait( &g->Cond, &g->Lock );
+    n = g->Error ? -1 : g->nBytes;
+    pthread_mutex_unlock( &g->Lock );
+
+    return( n );
+
+}
+
+#endif
+
+
+/**
+ *  \brief
+ *      Open a text output file, gzip'ing it on the fly if its name ends in ".gz".
+ *
+ *  \details
+ *      See the notes at the top of the file. Write to s->fp, and close with
+ *      Lgm_Sink_Close() (not fclose()).
+ *
+ *      \param[in]      Filename    The file.
+ *      \param[in]      Mode        "w" or "a".
+ *      \param[in]      nThreads    Compressor threads (0 for LGM_SINK_THREADS).
+ *
+ *      \return         The sink, or NULL if the file couldnt be opened (or
+ *                      it needs compressing and this build cant).
+ */
+Lgm_Sink *Lgm_Sink_Open( const char *Filename, const char *Mode, int nThreads ) {
+
+    Lgm_Sink    *s = (Lgm_Sink *)calloc( 1, sizeof(Lgm_Sink) );
+
+    s->Filename   = strdup( Filename );
+    s->Compressed = Lgm_Sink_IsGzipName( Filename );
+
+    if ( s->Compressed ) {
+#ifdef LGM_SINK_GZIP
+        s->fp = Lgm_GzSink_Open( Filename, Mode, nThreads, &s->nBytes, &s->Gz );
+#else
+        printf("Lgm_Sink_Open: cant write %s, this build has no gzip support.\n", Filename );
+#endif
+    } else if ( (s->fp = fopen( Filename, ( Mode[0] == 'a' ) ? "a" : "w" )) != NULL ) {
+        fseek( s->fp, 0, SEEK_END );
+        s->nBytes = ftell( s->fp );
+    }
+
+    if ( s->fp == NULL ) {
+        free( s->Filename );
+        free( s );
+        return( NULL );
+    }
+
+    return( s );
+
+}
+
+
+/**
+ *  \brief
+ *      Make sure everything written so far is in the file.
+ *
+ *  \details
+ *      For a compressed sink this ends the current gzip member and waits
+ *      for the compressors and the writer to catch up. The file then ends
+ *      on a member boundary, so its size is a safe point to truncate back
+ *      to (e.g. for a checkpoint).
+ *
+ *      \return         Size of the file (bytes), or -1 if a write failed.
+ */
+long int Lgm_Sink_Flush( Lgm_Sink *s ) {
+
+    if ( fflush( s->fp ) ) return( -1 );
+#ifdef LGM_SINK_GZIP
+    if ( s->Compressed ) {
+        s->nBytes = Lgm_GzSink_Flush( (Lgm_GzSink *)s->Gz );
+        return( s->nBytes );
+    }
+#endif
+    s->nBytes = ftell( s->fp );
+
+    return( s->nBytes );
+
+}
+
+
+/**
+ *  \brief
+ *      Finish writing and close a sink (waiting for the compressors).
+ *
+ *      \return         0, or EOF if anything couldnt be written.
+ */
+int Lgm_Sink_Close( Lgm_Sink *s ) {
+
+    int     r;
+
+    if ( s == NULL ) return( 0 );
+    r = fclose( s->fp );
+    free( s->Filename );
+    free( s );
+
+    return( r );
+
+}
+
+
+#if defined(HAVE_ZLIB_H) && ( defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN) )
+static ssize_t Lgm_Source_Read( void *Cookie, char *Buf, size_t Size ) {
+    int n = gzread( (gzFile)Cookie, Buf, (unsigned)Size );
+    return( ( n < 0 ) ? -1 : n );
+}
+static int Lgm_Source_Close( void *Cookie ) {
+    return( ( gzclose( (gzFile)Cookie ) == Z_OK ) ? 0 : EOF );
+}
+#ifdef HAVE_FUNOPEN
+static int Lgm_Source_Read_BSD( void *Cookie, char *Buf, int Size ) {
+    return( (int)Lgm_Source_Read( Cookie, Buf, (size_t)Size ) );
+}
+#endif
+#endif
+
+/**
+ *  \brief
+ *      Open a text file for reading, decompressing it if it is gzip'ed.
+ *
+ *  \details
+ *      Plain files are read as they are (zlib's gzread() passes them
+ *      straight through), so readers can use this for every file. Close the
+ *      FILE * with fclose().
+ *
+ *      \return         The file, or NULL if it couldnt be opened.
+ */
+FILE *Lgm_OpenSource( const char *Filename ) {
+
+#if defined(HAVE_ZLIB_H) && ( defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN) )
+    gzFile  z;
+    FILE    *fp;
+#ifdef HAVE_FOPENCOOKIE
+    cookie_io_functions_t   Io = { Lgm_Source_Read, NULL, NULL, Lgm_Source_Close };
+#endif
+
+    if ( (z = gzopen( Filename, "rb" )) == NULL ) return( NULL );
+    gzbuffer( z, 131072 );
+#ifdef HAVE_FOPENCOOKIE
+    fp = fopencookie( (void *)z, "r", Io );
+#else
+    fp = funopen( (void *)z, Lgm_Source_Read_BSD, NULL, NULL, Lgm_Source_Close );
+#endif
+    if ( fp == NULL ) gzclose( z );
+
+    return( fp );
+#else
+    if ( Lgm_Sink_IsGzipName( Filename ) ) {
+        printf("Lgm_OpenSource: cant read %s, this build has no gzip support.\n", Filename );
+        return( NULL );
+    }
+    return( fopen( Filename, "r" ) );
+#endif
+
+}
@@ -0,0 +1,261 @@
+/*! \file Lgm_SolarWindState.c
+ *
+ *  \brief TS04 W1..W6 and T01 G1..G3 from a live solar wind feed.
+ *
+ *  Lgm_QinDenton only has the W and G parameters that are precomputed in the
+ *  daily files, so a real-time run (e.g. a nowcast driven by upstream solar
+ *  wind data) had nothing to drive TS04/T01S with. Lgm_ComputeW() (W.c) does
+ *  the sums, but over the whole history at every time, which gets slower
+ *  the longer the run goes.
+ *
+ *  The W's are exponentially weighted sums of the driving (Tsyganenko and
+ *  Sitnov, 2005),
+ *
+ *      W_q(t) = r_q/60 * Sum_k S_q(t_k) dt_k exp( -r_q (t-t_k)/60 )   (t in minutes)
+ *
+ *  so the new one is just the old one decayed over the time since the last
+ *  sample plus the new sample's term. The G's (Tsyganenko, 2002) are plain
+ *  averages over the last hour, so they are running sums over a ring of the
+ *  last LGM_SW_GWINDOW minutes of samples: the new terms go in and the ones
+ *  that have aged out come off. Either way each sample costs O(1):
+ *
+ *      Lgm_SolarWindState *s = Lgm_InitSolarWindState( );
+ *      for ( each new sample ) {
+ *          Lgm_SolarWindState_Update( s, JD, N, V, By, Bz );
+ *          Lgm_SolarWindState_Get( s, &qd );
+ *          Lgm_set_QinDenton( &qd, mInfo );
+ *          ...
+ *      }
+ *      Lgm_FreeSolarWindState( s );
+ *
+ *  With 5-minute samples the W's are the same as Lgm_ComputeW()'s (to
+ *  ~1e-7, from the resolution of the JD's). Samples can come at any cadence though: each one stands for
+ *  the time since the previous one (at most LGM_SW_MAX_DT minutes, so a
+ *  sample after a data gap doesnt get credited with the whole gap). Bad
+ *  samples (N or V <= 0, or NaNs) hold the last good values. The sums start
+ *  at zero, so the W's are low until the run has gone for a few e-folding
+ *  times (1/r); the status flags say which ones have.
+ *
+ *  A Lgm_SolarWindState isnt thread safe (it is meant to be fed by one
+ *  thread); copy the Lgm_QinDentonOne out for the others.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Lgm/Lgm_CTrans.h"
+#include "Lgm/Lgm_Constants.h"
+#include "Lgm/Lgm_QinDenton.h"
+
+#define SW_RING0        64          // initial size of the G ring (grows as needed)
+#define SW_RESUM        4096        // redo the G sums from scratch this often (roundoff)
+
+/*
+ *  TS04 constants (the same as in Lgm_ComputeW()).
+ */
+static const double SW_Lambda[6] = { 0.39, 0.46, 0.39, 0.42, 0.41, 1.29 };  // N exponents
+static const double SW_Beta[6]   = { 0.80, 0.18, 2.32, 1.25, 1.6,  2.4  };  // V exponents
+static const double SW_Gamma[6]  = { 0.87, 0.67, 1.32, 1.29, 0.69, 0.53 };  // Bs exponents
+static const double SW_Rate[6]   = { 0.39, 0.7,  0.031, 0.58, 1.15, 0.88 }; // decay rates, 1/hr
+
+
+Lgm_SolarWindState *Lgm_InitSolarWindState( ) {
+
+    Lgm_SolarWindState  *s = (Lgm_SolarWindState *)calloc( 1, sizeof( Lgm_SolarWindState ) );
+
+    s->MaxRing = SW_RING0;
+    s->tRing   = (double *)calloc( 4*s->MaxRing, sizeof( double ) );
+    s->g1Ring  = s->tRing  + s->MaxRing;
+    s->g2Ring  = s->g1Ring + s->MaxRing;
+    s->g3Ring  = s->g2Ring + s->MaxRing;
+
+    return( s );
+
+}
+
+void Lgm_FreeSolarWindState( Lgm_SolarWindState *s ) {
+
+    if ( s == NULL ) return;
+    free( s->tRing );
+    free( s );
+
+}
+
+
+/*
+ *  Double the size of the ring (only happens if the samples come faster
+ *  than they ever have before, so it is O(1) amortized).
+ */
+static void SW_GrowRing( Lgm_SolarWindState *s ) {
+
+    int     i, j, n = 2*s->MaxRing;
+    double  *t = (double *)calloc( 4*n, sizeof( double ) );
+
+    for ( i=0; i<s->nRing; i++ ) {
+        j = (s->iRing + i)%s->MaxRing;
+        t[i]     = s->tRing[j];
+        t[n+i]   = s->g1Ring[j];
+        t[2*n+i] = s->g2Ring[j];
+        t[3*n+i] = s->g3Ring[j];
+    }
+    free( s->tRing );
+    s->tRing   = t;
+    s->g1Ring  = t + n;
+    s->g2Ring  = t + 2*n;
+    s->g3Ring  = t + 3*n;
+    s->MaxRing = n;
+    s->iRing   = 0;
+
+}
+
+static void SW_Resum( Lgm_SolarWindState *s ) {
+
+    int     i, j;
+
+    s->Sum[0] = s->Sum[1] = s->Sum[2] = 0.0;
+    for ( i=0; i<s->nRing; i++ ) {
+        j = (s->iRing + i)%s->MaxRing;
+        s->Sum[0] += s->g1Ring[j];
+        s->Sum[1] += s->g2Ring[j];
+        s->Sum[2] += s->g3Ring[j];
+    }
+    s->nSinceResum = 0;
+
+}
+
+
+/*
+ *  Take the next solar wind sample: time JD, density N (cm^-3), speed V
+ *  (km/s) and IMF By, Bz (nT, GSM). Samples have to come in time order;
+ *  returns FALSE (and ignores it) if this one doesnt, or if it is bad and
+ *  there is nothing yet to hold.
+ */
+int Lgm_SolarWindState_Update( Lgm_SolarWindState *s, double JD, double N, double V, double By, double Bz ) {
+
+    int     q, j;
+    double  dt, w, Bs, Bt, h, Theta, sn, Sq, Tmin;
+
+    if ( ( s->nSamples > 0 ) && !( JD > s->JD ) ) return( FALSE );
+
+    if ( ( N > 0.0 ) && ( V > 0.0 ) && !isnan( By ) && !isnan( Bz ) ) {
+        s->N = N; s->V = V; s->By = By; s->Bz = Bz;
+        s->Held = FALSE;
+    } else if ( s->nSamples > 0 ) {
+        s->Held = TRUE;
+    } else {
+        return( FALSE );
+    }
+
+    /*
+     *  W's: decay over the time since the last sample, then add this
+     *  sample's driving for the time it stands for.
+     */
+    if ( s->nSamples > 0 ) {
+        dt = (JD - s->JD)*1440.0;
+    } else {
+        dt = LGM_SW_NOMINAL_DT;
+        s->JD0 = JD;
+    }
+    w  = ( dt < LGM_SW_MAX_DT ) ? dt : LGM_SW_MAX_DT;
+    Bs = ( s->Bz < 0.0 ) ? -s->Bz : 0.0;
+    for ( q=0; q<6; q++ ) {
+        Sq = pow( s->N/5.0, SW_Lambda[q] ) * pow( s->V/400.0, SW_Beta[q] ) * pow( Bs/5.0, SW_Gamma[q] );
+        s->W[q] = s->W[q]*exp( -SW_Rate[q]*dt/60.0 ) + SW_Rate[q]*w/60.0*Sq;
+    }
+    s->JD = JD;
+    ++s->nSamples;
+
+    /*
+     *  G's: drop the terms that are older than the window, then add this
+     *  sample's.
+     *      G1 = < V h(Bt) sin^3(Theta/2) >,  h(Bt) = (Bt/40)^2/(1+Bt/40)
+     *      G2 = < a V Bs >,                  a = 0.005
+     *      G3 = < N V Bs >/2000
+     */
+    Tmin = JD - LGM_SW_GWINDOW/1440.0;
+    while ( ( s->nRing > 0 ) && ( s->tRing[s->iRing] <= Tmin ) ) {
+        s->Sum[0] -= s->g1Ring[s->iRing];
+        s->Sum[1] -= s->g2Ring[s->iRing];
+        s->Sum[2] -= s->g3Ring[s->iRing];
+        s->iRing = (s->iRing+1)%s->MaxRing;
+        --s->nRing;
+    }
+    if ( s->nRing == s->MaxRing ) SW_GrowRing( s );
+
+    Bt    = sqrt( s->By*s->By + s->Bz*s->Bz );
+    h     = (Bt/40.0)*(Bt/40.0)/(1.0 + Bt/40.0);
+    Theta = atan2( s->By, s->Bz );
+    sn    = fabs( sin( 0.5*Theta ) );
+
+    j = (s->iRing + s->nRing)%s->MaxRing;
+    s->tRing[j]  = JD;
+    s->g1Ring[j] = s->V*h*sn*sn*sn;
+    s->g2Ring[j] = 0.005*s->V*Bs;
+    s->g3Ring[j] = s->N*s->V*Bs/2000.0;
+    s->Sum[0] += s->g1Ring[j];
+    s->Sum[1] += s->g2Ring[j];
+    s->Sum[2] += s->g3Ring[j];
+    ++s->nRing;
+
+    if ( ++s->nSinceResum >= SW_RESUM ) SW_Resum( s );
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Put the current state into p (so that it can go to Lgm_set_QinDenton()).
+ *  fKp, akp3, Dst and Bz1..Bz6 arent solar wind quantities, so they are
+ *  left as they are (set them from wherever they come from). Statuses are
+ *  2 for good values and 1 for held ones; the W's are 1 until the run is
+ *  three e-folding times long, and the G's until it has a full window.
+ */
+void Lgm_SolarWindState_Get( Lgm_SolarWindState *s, Lgm_QinDentonOne *p ) {
+
+    int     q, Status, Year, Month, Day;
+    long int Secs;
+    double  UTC, Tmins, G[3];
+    int     *W_status[6];
+
+    if ( s->nSamples < 1 ) return;
+
+    p->JD    = s->JD;
+    p->MJD   = s->JD - 2400000.5;
+    p->Date  = Lgm_JD_to_Date( s->JD, &Year, &Month, &Day, &UTC );
+    p->UTC   = UTC;
+    p->Year  = Year; p->Month = Month; p->Day = Day;
+    Secs = (long int)( UTC*3600.0 + 0.5 ); if ( Secs > 86399 ) Secs = 86399;
+    p->Hour   = (int)( Secs/3600 );
+    p->Minute = (int)( (Secs/60)%60 );
+    p->Second = (int)( Secs%60 );
+    sprintf( p->IsoTimeStr, "%04d-%02d-%02dT%02d:%02d:%02d", p->Year, p->Month, p->Day, p->Hour, p->Minute, p->Second );
+    p->nPnts       = (int)( ( s->nSamples < 2147483647L ) ? s->nSamples : 2147483647L );
+    p->Persistence = s->Held;
+
+    Status = s->Held ? 1 : 2;
+    p->ByIMF = s->By;   p->ByIMF_status = Status;
+    p->BzIMF = s->Bz;   p->BzIMF_status = Status;
+    p->V_SW  = s->V;    p->V_SW_status  = Status;
+    p->Den_P = s->N;    p->Den_P_status = Status;
+    p->Pdyn  = s->N * 1e6 * LGM_PROTON_MASS * s->V*s->V*1e6 * 1e9;   // nPa
+    p->Pdyn_status = Status;
+
+    for ( q=0; q<3; q++ ) G[q] = ( s->nRing > 0 ) ? s->Sum[q]/(double)s->nRing : 0.0;
+    Tmins  = (s->JD - s->JD0)*1440.0 + LGM_SW_NOMINAL_DT;
+    Status = ( Tmins >= LGM_SW_GWINDOW ) ? 2 : 1;
+    p->G1 = G[0]; p->G1_status = Status;
+    p->G2 = G[1]; p->G2_status = Status;
+    p->G3 = G[2]; p->G3_status = Status;
+
+    p->W1 = s->W[0]; p->W2 = s->W[1]; p->W3 = s->W[2];
+    p->W4 = s->W[3]; p->W5 = s->W[4]; p->W6 = s->W[5];
+    W_status[0] = &p->W1_status; W_status[1] = &p->W2_status; W_status[2] = &p->W3_status;
+    W_status[3] = &p->W4_status; W_status[4] = &p->W5_status; W_status[5] = &p->W6_status;
+    for ( q=0; q<6; q++ ) *W_status[q] = ( SW_Rate[q]*Tmins/60.0 >= 3.0 ) ? 2 : 1;
+
+}
@@ -0,0 +1,156 @@
+/*! \file Lgm_StageHooks.c
+ *
+ *  \brief Callbacks at the stage boundaries of the L* and MagEphem calculations.
+ *
+ *  \details
+ *      A scheduler running many L* calculations may want to know how far
+ *      along each one is, how long the stages are taking, and to give up on
+ *      one that is running away (e.g. a storm time drift shell that wont
+ *      close). A Lgm_StageHooks table holds a callback for each of the
+ *      LGM_STAGE_* stages (see Lgm_StageHooks.h), e.g.
+ *
+ *          static int Watchdog( Lgm_StageEvent *e, void *Data ) {
+ *              return( e->Elapsed > *(double *)Data );     // TRUE cancels
+ *          }
+ *
+ *          double          MaxTime = 60.0;
+ *          Lgm_StageHooks  *h = Lgm_InitStageHooks( &MaxTime );
+ *          Lgm_StageHooks_Set( LGM_STAGE_FINDSHELLLINE, Watchdog, h );
+ *          Lgm_MagEphemInfo_SetStageHooks( h, MagEphemInfo );
+ *          Lgm_ComputeLstarVersusPA( ... );
+ *          if ( h->Cancelled ) ...
+ *
+ *      The table is kept in the Lgm_MagModelInfo (the trace routines only
+ *      see that), and copies of it share the table, so every thread of e.g.
+ *      Lgm_ComputeLstarVersusPA() reports to the same one. The callbacks are
+ *      called one at a time, so they dont need to be thread safe
+ *      themselves. Once a callback has cancelled, everything using the table
+ *      stops at its next stage boundary, until Lgm_StageHooks_Reset().
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Lgm/Lgm_StageHooks.h"
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_LstarInfo.h"
+#include "Lgm/Lgm_MagEphemInfo.h"
+
+
+double Lgm_StageHooks_Now( void ) {
+
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( ts.tv_sec + 1e-9*ts.tv_nsec );
+
+}
+
+
+/*
+ *  A table with no callbacks set. Data is handed to every callback.
+ */
+Lgm_StageHooks *Lgm_InitStageHooks( void *Data ) {
+
+    Lgm_StageHooks  *Hooks;
+
+    Hooks = (Lgm_StageHooks *)calloc( 1, sizeof( Lgm_StageHooks ) );
+    if ( Hooks == NULL ) {
+        printf("Lgm_InitStageHooks(): Could not allocate table\n");
+        return( NULL );
+    }
+    Hooks->Data = Data;
+    Lgm_StageHooks_Reset( Hooks );
+
+    return( Hooks );
+
+}
+
+void Lgm_FreeStageHooks( Lgm_StageHooks *Hooks ) {
+    free( Hooks );
+}
+
+void Lgm_StageHooks_Set( int Stage, Lgm_StageHookFunc Func, Lgm_StageHooks *Hooks ) {
+
+    if ( ( Stage < 0 ) || ( Stage >= LGM_STAGE_N ) ) {
+        printf("Lgm_StageHooks_Set(): Unknown stage %d\n", Stage );
+        return;
+    }
+    Hooks->Hook[Stage] = Func;
+
+}
+
+/*
+ *  Zero the counts, restart the clock and clear a cancellation.
+ */
+void Lgm_StageHooks_Reset( Lgm_StageHooks *Hooks ) {
+
+    Hooks->t0             = Lgm_StageHooks_Now();
+    Hooks->nTraces        = 0;
+    Hooks->nFindShellLine = 0;
+    Hooks->nMagFlux       = 0;
+    Hooks->nPitchAngles   = 0;
+    Hooks->Cancelled      = FALSE;
+
+}
+
+
+/*
+ *  Called by the library at a stage boundary (through LGM_STAGE_FIRE()). t0
+ *  is when the stage started (0 for the _BEGIN stages). Returns TRUE if the
+ *  calculation has been cancelled, by this callback or an earlier one.
+ */
+int Lgm_StageHooks_Fire( Lgm_StageHooks *Hooks, int Stage, int Index, double t0, double Value, long int nMagEvals ) {
+
+    Lgm_StageEvent  e;
+    double          t;
+
+    t = Lgm_StageHooks_Now();
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_StageHooks)
+#endif
+    {
+        if      ( Stage == LGM_STAGE_TRACE_END )        ++Hooks->nTraces;
+        else if ( Stage == LGM_STAGE_FINDSHELLLINE )    ++Hooks->nFindShellLine;
+        else if ( Stage == LGM_STAGE_MAGFLUX_END )      ++Hooks->nMagFlux;
+        else if ( Stage == LGM_STAGE_PITCHANGLE_DONE )  ++Hooks->nPitchAngles;
+
+        if ( Hooks->Hook[Stage] != NULL ) {
+            e.Stage          = Stage;
+            e.Index          = Index;
+            e.Elapsed        = t - Hooks->t0;
+            e.StageTime      = ( t0 > 0.0 ) ? t - t0 : 0.0;
+            e.Value          = Value;
+            e.nMagEvals      = nMagEvals;
+            e.nTraces        = Hooks->nTraces;
+            e.nFindShellLine = Hooks->nFindShellLine;
+            e.nMagFlux       = Hooks->nMagFlux;
+            e.nPitchAngles   = Hooks->nPitchAngles;
+            if ( Hooks->Hook[Stage]( &e, Hooks->Data ) ) Hooks->Cancelled = TRUE;
+        }
+    }
+
+    return( Hooks->Cancelled );
+
+}
+
+
+/*
+ *  Attach a table (or NULL to detach it). Everything copied from LstarInfo
+ *  (or MagEphemInfo) after this shares it.
+ */
+void Lgm_LstarInfo_SetStageHooks( Lgm_StageHooks *Hooks, Lgm_LstarInfo *LstarInfo ) {
+
+    LstarInfo->mInfo->Hooks = Hooks;
+    if ( Hooks != NULL ) Lgm_StageHooks_Reset( Hooks );
+
+}
+
+void Lgm_MagEphemInfo_SetStageHooks( Lgm_StageHooks *Hooks, Lgm_MagEphemInfo *MagEphemInfo ) {
+
+    Lgm_LstarInfo_SetStageHooks( Hooks, MagEphemInfo->LstarInfo );
+
+}
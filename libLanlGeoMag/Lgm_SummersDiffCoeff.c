@@ -162,9 +162,9 @@ double  Lgm_GyroFreq( double q, double B, double m ) {
  *      \param[in]      WaveMode    Mode of the wave. Can be LGM_R_MODE_WAVE or LGM_L_MODE_WAVE
  *      \param[in]      Species     Particle species. Can be LGM_ELECTRONS, LGM_PROTONS, or ....?
  *      \param[in]      MaxWaveLat  Latitude (+/-) that waves exist up to. [Degrees].
- *      \param[out]     Daa_ba      Bounce-averaged value of Daa.
- *      \param[out]     Dap_ba      Bounce-averaged value of Dap.
- *      \param[out]     Dpp_ba      Bounce-averaged value of Dpp.
+ *      \param[out]     Daa_ba      Bounce-averaged value of Daa (or NULL if it isnt wanted, its integral is then skipped).
+ *      \param[out]     Dap_ba      Bounce-averaged value of Dap (or NULL).
+ *      \param[out]     Dpp_ba      Bounce-averaged value of Dpp (or NULL).
  *
  *      \return         0 if successful. <0 otherwise.
  *
@@ -179,6 +179,8 @@ int Lgm_SummersDxxBounceAvg( int Version, double Alpha0,  double Ek,  double L,
     double           ySing, a_new, b_new, B;
     int              npts2=4, limit=500, lenw=4*limit, iwork[502], last, ier, neval;
     int              VerbosityLevel = 0;
+    double           Skip;
+    int              WantDaa = ( Daa_ba != NULL ), WantDap = ( Dap_ba != NULL ), WantDpp = ( Dpp_ba != NULL );
     Lgm_SummersInfo  si;
     si.Version = Version;
     si.n1 = n1;
@@ -194,6 +196,11 @@ int Lgm_SummersDxxBounceAvg( int Version, double Alpha0,  double Ek,  double L,
 
 
 
+    // coefficients that arent wanted (NULL) go to Skip, and their integrals are skipped
+    if ( !WantDaa ) Daa_ba = &Skip;
+    if ( !WantDap ) Dap_ba = &Skip;
+    if ( !WantDpp ) Dpp_ba = &Skip;
+
     if ( (fabs(Alpha0-90.0) < 1e-8)||(fabs(Alpha0) < 1e-8) ) {
 
         *Daa_ba = 0.0;
@@ -316,7 +323,8 @@ int Lgm_SummersDxxBounceAvg( int Version, double Alpha0,  double Ek,  double L,
         dqags( CdipIntegrand_Sb, (_qpInfo *)&si, a, B, epsabs, epsrel, &T, &abserr, &neval, &ier, limit, lenw, &last, iwork, work, VerbosityLevel );
 
 
-        Lgm_SummersFindCutoffs2( SummersIntegrand_Gaa, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
+        a_new = b_new = 0.0;
+        if ( WantDaa ) Lgm_SummersFindCutoffs2( SummersIntegrand_Gaa, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
         npts2 = 2 + Lgm_SummersFindSingularities( SummersIntegrand_Gaa, (_qpInfo *)&si, FALSE, a_new, b_new, &points[1], &ySing );
         if ( b_new > a_new ) {
             if ( npts2 > 2 ) {
@@ -360,7 +368,8 @@ int Lgm_SummersDxxBounceAvg( int Version, double Alpha0,  double Ek,  double L,
             *Daa_ba = 0.0;
         }
 
-        Lgm_SummersFindCutoffs2( SummersIntegrand_Gap, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
+        a_new = b_new = 0.0;
+        if ( WantDap ) Lgm_SummersFindCutoffs2( SummersIntegrand_Gap, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
         npts2 = 2 + Lgm_SummersFindSingularities( SummersIntegrand_Gap, (_qpInfo *)&si, FALSE, a_new, b_new, &points[1], &ySing );
         if ( b_new > a_new ) {
             if ( npts2 > 2 ) {
@@ -385,7 +394,8 @@ int Lgm_SummersDxxBounceAvg( int Version, double Alpha0,  double Ek,  double L,
             *Dap_ba = 0.0;
         }
 
-        Lgm_SummersFindCutoffs2( SummersIntegrand_Gpp, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
+        a_new = b_new = 0.0;
+        if ( WantDpp ) Lgm_SummersFindCutoffs2( SummersIntegrand_Gpp, (_qpInfo *)&si, FALSE, a, b, &a_new, &b_new );
         npts2 = 2 + Lgm_SummersFindSingularities( SummersIntegrand_Gpp, (_qpInfo *)&si, FALSE, a_new, b_new, &points[1], &ySing );
         if ( b_new > a_new ) {
             if ( npts2 > 2 ) {
@@ -444,7 +454,6 @@ int Lgm_GlauertAndHorneDxxBounceAvg( int Version, double Alpha0,  double Ek,  do
     int              VerbosityLevel = 1;
 
     Lgm_SummersInfo  si;
-printf("I'm really in Lgm_GlauertAndHorneDxxBounceAvg\n");
 
 /*  Added by Greg Cunningham to enable precomputation of the normalizing function N(w) that integrates over tan(theta) interval [xmin,xmax] and depends only on aStar */
     si.aStarMin = aStarMin;
@@ -655,8 +664,16 @@ printf("done finding integral\n");
  *      in a pure centered dipole field.
  *
  *  \details
- *
- *
+ *      dDaa/dAlpha0 and dDap/dAlpha0 are found with a centered difference
+ *      stencil of 2, 4 or 6 bounce averages at Alpha0 +/- ha, +/- 2ha, ...
+ *      Only the Daa and Dap integrals are done at each of them (the center
+ *      point and Dpp arent needed). To get the derivatives everywhere on an
+ *      (L, Ek, Alpha0) grid, Lgm_DxxGrid_Derivs() is much cheaper: it uses
+ *      the grid's own pitch angles as the stencil, so it needs no more
+ *      bounce averages at all.
+ *
+ *      \param[in]      DerivScheme LGM_DERIV_TWO_POINT, LGM_DERIV_FOUR_POINT or LGM_DERIV_SIX_POINT.
+ *      \param[in]      ha          Spacing of the stencil, in Degrees.
  *      \param[in]      Version     Version of Summers Model to use. Can be LGM_SUMMERS_2005 or LGM_SUMMERS_2007.
  *      \param[in]      Alpha0      Equatoria PA in Degrees.
  *      \param[in]      Ek          Kinetic energy in MeV.
@@ -674,11 +691,10 @@ printf("done finding integral\n");
  *      \param[in]      WaveMode    Mode of the wave. Can be LGM_R_MODE_WAVE or LGM_L_MODE_WAVE
  *      \param[in]      Species     Particle species. Can be LGM_ELECTRONS, LGM_PROTONS, or ....?
  *      \param[in]      MaxWaveLat  Latitude (+/-) that waves exist up to. [Degrees].
- *      \param[out]     Daa_ba      Bounce-averaged value of Daa.
- *      \param[out]     Dap_ba      Bounce-averaged value of Dap.
- *      \param[out]     Dpp_ba      Bounce-averaged value of Dpp.
+ *      \param[out]     dDaa        dDaa/dAlpha0 (per Degree).
+ *      \param[out]     dDap        dDap/dAlpha0 (per Degree).
  *
- *      \return         0 if successful. <0 otherwise.
+ *      \return         1 if successful. <0 otherwise.
  *
  *      \author         M. Henderson
  *      \date           2011
@@ -686,7 +702,7 @@ printf("done finding integral\n");
  */
 int Lgm_SummersDxxDerivsBounceAvg( int DerivScheme, double ha, int Version, double Alpha0,  double Ek,  double L,  void *BwFuncData, double (*BwFunc)(), double n1, double n2, double n3, double aStarEq,  int Directions, double w1, double w2, double wm, double dw, int WaveMode, int Species, double MaxWaveLat, double *dDaa,  double *dDap) {
 
-    double  a, h, H, faa[7], fap[7], Daa_ba, Dap_ba, Dpp_ba;
+    double  a, h, H, faa[7], fap[7], Daa_ba, Dap_ba;
     int     i, N;
 
     /*
@@ -704,15 +720,21 @@ int Lgm_SummersDxxDerivsBounceAvg( int DerivScheme, double ha, int Version, doub
         case LGM_DERIV_TWO_POINT:
             N = 1;
             break;
+        default:
+            printf("Lgm_SummersDxxDerivsBounceAvg: Unknown DerivScheme = %d\n", DerivScheme );
+            return(-1);
     }
 
     /*
-     * Compute points in alpha grid use ha as spacing
+     * Compute points in alpha grid use ha as spacing. None of the schemes
+     * use the center point, and Dpp isnt needed.
      */
     h = ha;
+    faa[N] = fap[N] = 0.0;
     for (i=-N; i<=N; ++i){
+        if ( i == 0 ) continue;
         a = Alpha0; H = (double)i*h; a += H;
-        Lgm_SummersDxxBounceAvg( Version, a, Ek, L, BwFuncData, BwFunc, n1, n2, n3, aStarEq, Directions, w1, w2, wm, dw, WaveMode, Species, MaxWaveLat, &Daa_ba, &Dap_ba, &Dpp_ba );
+        Lgm_SummersDxxBounceAvg( Version, a, Ek, L, BwFuncData, BwFunc, n1, n2, n3, aStarEq, Directions, w1, w2, wm, dw, WaveMode, Species, MaxWaveLat, &Daa_ba, &Dap_ba, NULL );
         faa[i+N] = Daa_ba;
         fap[i+N] = Dap_ba;
     }
@@ -1190,6 +1212,62 @@ double  SummersIntegrand_Gpp( double Lat, _qpInfo *qpInfo ) {
 
 
 
+/**
+ *  \brief
+ *      Finds the resonant roots of the Summers [2005] resonance condition at many points at once.
+ *
+ *  \details
+ *      The resonance condition (with the cold plasma dispersion relation)
+ *      gives a quartic in x = w/|Omega_e| (Summers [2005], eqn (19)) whose
+ *      coefficients depend on the local pitch angle and aStar. This builds the
+ *      quartics for n points (e.g. latitudes along a field line) and solves
+ *      them all with Lgm_QuarticRealRoots_N().
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      E           Dimensionless energy Ek/E0 (kinetic energy over rest mass).
+ *      \param[in]      Lambda      -1 for electrons, LGM_EPS for protons.
+ *      \param[in]      s           +1 for R-mode, -1 for L-mode.
+ *      \param[in]      SinAlpha2   \f$\sin^2(\alpha)\f$ at each point (n values).
+ *      \param[in]      aStar       Local aStar at each point (n values).
+ *      \param[out]     x           The real roots. x[4*i], ..., x[4*i+3] are for point i, with NAN in place of complex roots.
+ *
+ */
+void Lgm_SummersResonantRoots_N( int n, double E, double Lambda, int s, double *SinAlpha2, double *aStar, double *x ) {
+
+    int     i, i0, m;
+    double  Gamma, Beta2, a, aa, apa, sEpsMinusOne;
+    double  a1[64], a2[64], a3[64], a4[64];
+
+    Gamma = E+1.0;
+    Beta2 = E*(E+2.0) / (Gamma*Gamma);
+    a     = s*Lambda/Gamma; aa = a*a; apa = a+a;
+    sEpsMinusOne = s*(LGM_EPS - 1.0);
+
+    /*
+     *  Do blocks of 64 points so the coefficients can live on the stack.
+     */
+    for ( i0=0; i0<n; i0 += 64 ) {
+
+        m = ( n-i0 < 64 ) ? n-i0 : 64;
+
+        for ( i=0; i<m; i++ ) {
+            double  Mu2, b, BetaMu2, OneMinusBetaMu2;
+            Mu2 = 1.0-SinAlpha2[i0+i]; Mu2 = ( Mu2 < 0.0 ) ? 0.0 : Mu2; // Mu2 is cos^2(Alpha)
+            b   = (1.0 + LGM_EPS)/aStar[i0+i];
+            BetaMu2 = Beta2*Mu2;
+            OneMinusBetaMu2 = 1.0 - BetaMu2;
+            a1[i] = ( apa + sEpsMinusOne*OneMinusBetaMu2 ) / OneMinusBetaMu2;
+            a2[i] = ( aa + apa*sEpsMinusOne - LGM_EPS + BetaMu2*(b+LGM_EPS) ) / OneMinusBetaMu2;
+            a3[i] = ( aa*sEpsMinusOne - apa*LGM_EPS ) / OneMinusBetaMu2;
+            a4[i] = -aa*LGM_EPS / OneMinusBetaMu2;
+        }
+
+        Lgm_QuarticRealRoots_N( m, a1, a2, a3, a4, &x[4*i0] );
+
+    }
+
+}
+
 /**
  *  \brief
  *      Computes the local Summer's [2005] Daa diffusion coefficient.
@@ -1221,10 +1299,10 @@ double  SummersIntegrand_Gpp( double Lat, _qpInfo *qpInfo ) {
  */
 double Lgm_SummersDaaLocal( double SinAlpha2, double E, double dBoverB2, double BoverBeq, double Omega_e, double Omega_Sig, double Rho, double Sig, double xl, double xh, double xm, double dx, double Lambda, int s, double aStar, int Directions ) {
 
-    int             nReal, nRoots, n;
-    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2, OneMinusBetaMu2;
-    double          sEpsMinusOne, a1, a2, a3, a4, a, aa, apa, b;
-    double complex  z1, z2, z3, z4, z[4];
+    int             nRoots, n;
+    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2;
+    double          sEpsMinusOne, a, b;
+    double          z[4], xr[4];
     double          Daa, R, x0, y0, Ep1, Ep12, xms, xpse, u, arg, c1, c2, c3, c4;
     double          x, x2, x3, x4, y, g, F, DD, fac;
     double 	    regularizerForSingularity=0.0;
@@ -1235,20 +1313,14 @@ double Lgm_SummersDaaLocal( double SinAlpha2, double E, double dBoverB2, double
     Gamma = E+1.0; Gamma2 = Gamma*Gamma;
     Beta2 = E*(E+2.0) / Gamma2;
     Mu2   = 1.0-SinAlpha2; if (Mu2<0.0) Mu2 = 0.0; // Mu2 is cos^2(Alpha)
-    a     = s*Lambda/Gamma; aa = a*a; apa = a+a;
+    a     = s*Lambda/Gamma;
     b     = (1.0 + LGM_EPS)/aStar;
 
     BetaMu2 = Beta2*Mu2;
-    OneMinusBetaMu2 = 1.0 - BetaMu2;
 
     sEpsMinusOne = s*(LGM_EPS - 1.0);
 
-    a1 = ( apa + sEpsMinusOne*OneMinusBetaMu2 ) / OneMinusBetaMu2;
-    a2 = ( aa + apa*sEpsMinusOne - LGM_EPS + BetaMu2*(b+LGM_EPS) ) / OneMinusBetaMu2;
-    a3 = ( aa*sEpsMinusOne - apa*LGM_EPS ) / OneMinusBetaMu2;
-    a4 = -aa*LGM_EPS / OneMinusBetaMu2;
-
-    nReal = Lgm_QuarticRoots( a1, a2, a3, a4, &z1, &z2, &z3, &z4 );
+    Lgm_SummersResonantRoots_N( 1, E, Lambda, s, &SinAlpha2, &aStar, xr );
 
     R  = dBoverB2;   // The ratio (dB/B)^2
 
@@ -1261,10 +1333,7 @@ double Lgm_SummersDaaLocal( double SinAlpha2, double E, double dBoverB2, double
      * Gather applicable roots together into the z[] array
      */
     nRoots = 0;
-    if ( ( fabs(cimag(z1)) < 1e-10 ) && ( creal(z1) > 0.0 ) ) z[nRoots++] = z1;
-    if ( ( fabs(cimag(z2)) < 1e-10 ) && ( creal(z2) > 0.0 ) ) z[nRoots++] = z2;
-    if ( ( fabs(cimag(z3)) < 1e-10 ) && ( creal(z3) > 0.0 ) ) z[nRoots++] = z3;
-    if ( ( fabs(cimag(z4)) < 1e-10 ) && ( creal(z4) > 0.0 ) ) z[nRoots++] = z4;
+    for ( n=0; n<4; n++ ) if ( xr[n] > 0.0 ) z[nRoots++] = xr[n];    // (complex roots are NAN)
 
 
     if ( ( nRoots == 0 ) && ( Mu2 > 1e-16 ) ){
@@ -1322,7 +1391,7 @@ double Lgm_SummersDaaLocal( double SinAlpha2, double E, double dBoverB2, double
         for ( Daa=0.0, n=0; n<nRoots; n++ ){
 
 
-            x = creal( z[n] ); x2 = x*x; x3 = x2*x; x4 = x2*x2;
+            x = z[n]; x2 = x*x; x3 = x2*x; x4 = x2*x2;
             y = ( x+a )/BetaMu;
             if ((x>xl)&&(x<xh)) {
                 if (  (Directions == LGM_FRWD_BKWD) || ((Directions == LGM_FRWD)&&(y>=0.0)) || ((Directions == LGM_BKWD)&&(y<=0.0)) ) {
@@ -1379,10 +1448,10 @@ double Lgm_SummersDaaLocal( double SinAlpha2, double E, double dBoverB2, double
  */
 double Lgm_SummersDapLocal( double SinAlpha2, double E, double dBoverB2, double BoverBeq, double Omega_e, double Omega_Sig, double Rho, double Sig, double xl, double xh, double xm, double dx, double Lambda, int s, double aStar, int Directions ) {
 
-    int             nReal, nRoots, n;
-    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2, OneMinusBetaMu2;
-    double          sEpsMinusOne, a1, a2, a3, a4, a, aa, apa, b, SinAlpha;
-    double complex  z1, z2, z3, z4, z[4];
+    int             nRoots, n;
+    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2;
+    double          sEpsMinusOne, a, b, SinAlpha;
+    double          z[4], xr[4];
     double          Dap, R, x0, y0, Ep1, Ep12, xms, xpse, u, arg, c1, c2, c3, c4;
     double          x, x2, x3, x4, y, g, F, DD, fac;
     double 	    regularizerForSingularity=0.0;
@@ -1393,20 +1462,14 @@ double Lgm_SummersDapLocal( double SinAlpha2, double E, double dBoverB2, double
     Gamma = E+1.0; Gamma2 = Gamma*Gamma;
     Beta2 = E*(E+2.0) / Gamma2;
     Mu2   = 1.0-SinAlpha2; if (Mu2<0.0) Mu2 = 0.0; // Mu2 is cos^2(Alpha)
-    a     = s*Lambda/Gamma; aa = a*a; apa = a+a;
+    a     = s*Lambda/Gamma;
     b     = (1.0 + LGM_EPS)/aStar;
 
     BetaMu2 = Beta2*Mu2;
-    OneMinusBetaMu2 = 1.0 - BetaMu2;
 
     sEpsMinusOne = s*(LGM_EPS - 1.0);
 
-    a1 = ( apa + sEpsMinusOne*OneMinusBetaMu2 ) / OneMinusBetaMu2;
-    a2 = ( aa + apa*sEpsMinusOne - LGM_EPS + BetaMu2*(b+LGM_EPS) ) / OneMinusBetaMu2;
-    a3 = ( aa*sEpsMinusOne - apa*LGM_EPS ) / OneMinusBetaMu2;
-    a4 = -aa*LGM_EPS / OneMinusBetaMu2;
-
-    nReal = Lgm_QuarticRoots( a1, a2, a3, a4, &z1, &z2, &z3, &z4 );
+    Lgm_SummersResonantRoots_N( 1, E, Lambda, s, &SinAlpha2, &aStar, xr );
 
     R  = dBoverB2;   // The ratio (dB/B)^2
 
@@ -1418,10 +1481,7 @@ double Lgm_SummersDapLocal( double SinAlpha2, double E, double dBoverB2, double
      * Gather applicable roots together into the z[] array
      */
     nRoots = 0;
-    if ( ( fabs(cimag(z1)) < 1e-10 ) && ( fabs(creal(z1)) > 0.0 ) ) z[nRoots++] = z1;
-    if ( ( fabs(cimag(z2)) < 1e-10 ) && ( fabs(creal(z2)) > 0.0 ) ) z[nRoots++] = z2;
-    if ( ( fabs(cimag(z3)) < 1e-10 ) && ( fabs(creal(z3)) > 0.0 ) ) z[nRoots++] = z3;
-    if ( ( fabs(cimag(z4)) < 1e-10 ) && ( fabs(creal(z4)) > 0.0 ) ) z[nRoots++] = z4;
+    for ( n=0; n<4; n++ ) if ( fabs(xr[n]) > 0.0 ) z[nRoots++] = xr[n];    // (complex roots are NAN)
 
 
     if ( ( nRoots == 0 ) && ( Mu2 > 1e-16 ) ){
@@ -1482,7 +1542,7 @@ double Lgm_SummersDapLocal( double SinAlpha2, double E, double dBoverB2, double
         for ( Dap=0.0, n=0; n<nRoots; n++ ){
 
 
-            x = creal( z[n] ); x2 = x*x; x3 = x2*x; x4 = x2*x2;
+            x = z[n]; x2 = x*x; x3 = x2*x; x4 = x2*x2;
             y = ( x+a )/BetaMu;
             if ((x>xl)&&(x<xh)) {
                 if (  (Directions == LGM_FRWD_BKWD) || ((Directions == LGM_FRWD)&&(y>=0.0)) || ((Directions == LGM_BKWD)&&(y<=0.0)) ) {
@@ -1541,10 +1601,10 @@ double Lgm_SummersDapLocal( double SinAlpha2, double E, double dBoverB2, double
  */
 double Lgm_SummersDppLocal( double SinAlpha2, double E, double dBoverB2, double BoverBeq, double Omega_e, double Omega_Sig, double Rho, double Sig, double xl, double xh, double xm, double dx, double Lambda, int s, double aStar, int Directions ) {
 
-    int             nReal, nRoots, n;
-    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2, OneMinusBetaMu2;
-    double          sEpsMinusOne, a1, a2, a3, a4, a, aa, apa, b;
-    double complex  z1, z2, z3, z4, z[4];
+    int             nRoots, n;
+    double          Gamma, Gamma2, Beta, Beta2, Mu, Mu2, BetaMu, BetaMu2;
+    double          sEpsMinusOne, a, b;
+    double          z[4], xr[4];
     double          Dpp, R, x0, y0, Ep1, Ep12, xms, xpse, arg, c1, c2, c3, c4;
     double          x, x2, x3, x4, y, g, F, DD, fac;
     double 	    regularizerForSingularity=0.0;
@@ -1555,21 +1615,14 @@ double Lgm_SummersDppLocal( double SinAlpha2, double E, double dBoverB2, double
     Gamma = E+1.0; Gamma2 = Gamma*Gamma;
     Beta2 = E*(E+2.0) / Gamma2;
     Mu2   = 1.0-SinAlpha2; if (Mu2<0.0) Mu2 = 0.0; // Mu2 is cos^2(Alpha)
-    a     = s*Lambda/Gamma; aa = a*a; apa = a+a;
+    a     = s*Lambda/Gamma;
     b     = (1.0 + LGM_EPS)/aStar;
 
     BetaMu2 = Beta2*Mu2;
-    OneMinusBetaMu2 = 1.0 - BetaMu2;
 
     sEpsMinusOne = s*(LGM_EPS - 1.0);
 
-    a1 = ( apa + sEpsMinusOne*OneMinusBetaMu2 ) / OneMinusBetaMu2;
-    a2 = ( aa + apa*sEpsMinusOne - LGM_EPS + BetaMu2*(b+LGM_EPS) ) / OneMinusBetaMu2;
-    a3 = ( aa*sEpsMinusOne - apa*LGM_EPS ) / OneMinusBetaMu2;
-    a4 = -aa*LGM_EPS / OneMinusBetaMu2;
-    //printf("a1, a2, a3, a4 = %g %g %g %g\n", a1, a2, a3, a4 );
-
-    nReal = Lgm_QuarticRoots( a1, a2, a3, a4, &z1, &z2, &z3, &z4 );
+    Lgm_SummersResonantRoots_N( 1, E, Lambda, s, &SinAlpha2, &aStar, xr );
 
     R  = dBoverB2;   // The ratio (dB/B)^2
 
@@ -1580,10 +1633,7 @@ double Lgm_SummersDppLocal( double SinAlpha2, double E, double dBoverB2, double
      * Gather applicable roots together into the z[] array
      */
     nRoots = 0;
-    if ( ( fabs(cimag(z1)) < 1e-10 ) && ( fabs(creal(z1)) > 0.0 ) ) z[nRoots++] = z1;
-    if ( ( fabs(cimag(z2)) < 1e-10 ) && ( fabs(creal(z2)) > 0.0 ) ) z[nRoots++] = z2;
-    if ( ( fabs(cimag(z3)) < 1e-10 ) && ( fabs(creal(z3)) > 0.0 ) ) z[nRoots++] = z3;
-    if ( ( fabs(cimag(z4)) < 1e-10 ) && ( fabs(creal(z4)) > 0.0 ) ) z[nRoots++] = z4;
+    for ( n=0; n<4; n++ ) if ( fabs(xr[n]) > 0.0 ) z[nRoots++] = xr[n];    // (complex roots are NAN)
 
 
     if ( ( nRoots == 0 ) && ( Mu2 > 1e-16 ) ){
@@ -1642,7 +1692,7 @@ double Lgm_SummersDppLocal( double SinAlpha2, double E, double dBoverB2, double
         for ( Dpp=0.0, n=0; n<nRoots; n++ ){
 
 
-            x = creal( z[n] ); x2 = x*x; x3 = x2*x; x4 = x2*x2;
+            x = z[n]; x2 = x*x; x3 = x2*x; x4 = x2*x2;
             y = ( x+a )/BetaMu;
             if ((x>xl)&&(x<xh)) {
                 if (  (Directions == LGM_FRWD_BKWD) || ((Directions == LGM_FRWD)&&(y>=0.0)) || ((Directions == LGM_BKWD)&&(y<=0.0)) ) {
@@ -3992,7 +4042,8 @@ int Lgm_SimpleRiemannSum( double (*f)(double, _qpInfo *), _qpInfo *args, double
 	*result=0.0;
 	gsl_integration_qag(&F, xleft, xright, epsabs, epsrel, (size_t) nSubIntervals, GSL_INTEG_GAUSS21, w, result, &abserr);
 //	printf("Number of evaluations needed by adaptive Gauss-Kronrod 21-point quadrature to achieve %g relative accuracy is %d, abserr is %g and integral is %g\n", epsrel, w->size, abserr, *result);
+	neval = w->size;
 	gsl_integration_workspace_free(w);
 
-	return(w->size);
+	return((int)neval);
 }
@@ -0,0 +1,566 @@
+/*! \file Lgm_TS07_Archive.c
+ *
+ *  \brief Packed binary archive of TS07D coefficients.
+ *
+ *  The TS07D model needs the static tail coefficients (TAIL_PAR/tail*.par, 45 text
+ *  files) and a separate text file of 101 coefficients for every 5-minute
+ *  epoch (Coeffs/YYYY_DDD/YYYY_DDD_HH_MM.par). For long runs, opening and
+ *  parsing those files is a large fraction of the total run time. The
+ *  routines here pack all of it into a single indexed binary file, which is
+ *  then memory-mapped (once per process) and shared read-only by all
+ *  LgmTsyg2007_Info structures.
+ *
+ *  Archive layout (native byte order, checked with a known double in the
+ *  header):
+ *
+ *      Lgm_TS07_ArchiveHeader
+ *      Tail coeffs     LGM_TS07_NTAIL doubles: TSS[k][i], then TSO[k][i][j], then TSE[k][i][j] (k=1..80, i=1..5, j=1..4)
+ *      Index           nSlots int32's. Record number for each 5-minute slot (-1 if there is no data for it).
+ *      Records         nRecords blocks of LGM_TS07_NA doubles (A[1..101]).
+ *
+ *  Slot n corresponds to day JDN0 + n/288 and time (n%288)*5 minutes, so any
+ *  epoch resolves with a single array lookup.
+ *
+ *  Lgm_Init_TS07() and Lgm_SetCoeffs_TS07() use the archive if one is found
+ *  (see Lgm_TS07_ArchiveFilename()) and otherwise fall back to reading the
+ *  text files in TS07_DATA_PATH as before. Epochs that are not in the archive
+ *  also fall back to the text files.
+ *
+ *  The archive is written by Lgm_TS07_BuildArchive() (see also the
+ *  PackTS07Coeffs tool).
+ *
+ *  For days that arent in an archive there is also a small day cache.
+ *  Lgm_TS07_PrefetchDay() reads all 288 coefficient files of a day into it
+ *  (normally on a background thread, see Lgm_Prefetch.c), and
+ *  Lgm_SetCoeffs_TS07() looks there before going to the text files.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include "Lgm/Lgm_Tsyg2007.h"
+#include "Lgm/Lgm_DynamicMemory.h"
+#include "Lgm/Lgm_CTrans.h"
+
+
+
+static Lgm_TS07_Archive *Lgm_TS07_SharedArchive = NULL;
+static int               Lgm_TS07_SharedArchive_Tried = FALSE;
+
+
+/*
+ *  Day cache of coefficients read from the text files. Only touched inside
+ *  the Lgm_TS07_Cache critical section.
+ */
+#define LGM_TS07_CACHE_DAYS     3
+
+typedef struct Lgm_TS07_CacheDay {
+    long int        JDN;
+    unsigned long   LastUsed;
+    char            Path[1024];                     // TS07 data directory the day was read from
+    char            Have[LGM_TS07_SLOTS_PER_DAY];   // TRUE if there was a file for the slot
+    double          *A;                             // LGM_TS07_NA coeffs per slot (NULL for an unused day)
+} Lgm_TS07_CacheDay;
+
+static Lgm_TS07_CacheDay    Lgm_TS07_Cache[LGM_TS07_CACHE_DAYS];
+static unsigned long        Lgm_TS07_CacheClock = 0;
+
+
+
+/*
+ *  Slot number (relative to JDN = 0) for a given Date and UTC. Rounds to the
+ *  nearest 5 minutes in the same way as Lgm_SetCoeffs_TS07(), so minutes 58
+ *  and 59 go to the next hour's slot (and 23:58 to the next day's).
+ */
+static int64_t Lgm_TS07_Slot( long int Date, double UTC ) {
+
+    int     year, month, day, doy, hour, minute;
+
+    Lgm_Doy( Date, &year, &month, &day, &doy );
+    hour   = (int)UTC;
+    minute = (int)( (UTC - (int)UTC)*60.0 );
+
+    return( (int64_t)Lgm_JDN( year, month, day )*LGM_TS07_SLOTS_PER_DAY + hour*12 + (minute + 5/2)/5 );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Name of the archive file to use.
+ *
+ *  \details
+ *      This is $LGM_TS07_ARCHIVE if that is set, otherwise
+ *      $TS07_DATA_PATH/TS07D_Coeffs.bin (with the usual default for
+ *      TS07_DATA_PATH).
+ *
+ *      \param[out]     Filename    Archive filename.
+ *      \param[in]      n           Size of Filename.
+ */
+void Lgm_TS07_ArchiveFilename( char *Filename, int n ) {
+
+    const char *Path = getenv( "LGM_TS07_ARCHIVE" );
+
+    if ( Path != NULL ) {
+        snprintf( Filename, n, "%s", Path );
+    } else {
+        Path = getenv( "TS07_DATA_PATH" );
+        if ( Path == NULL ) Path = LGM_TS07_DATA_DIR;
+        snprintf( Filename, n, "%s/%s", Path, LGM_TS07_ARCHIVE_NAME );
+    }
+
+}
+
+
+
+/**
+ *  \brief
+ *      Open (and memory-map) a TS07D coefficient archive.
+ *
+ *      \param[in]      Filename    Archive file.
+ *
+ *      \return         Pointer to archive, or NULL if it could not be opened or is not a valid archive.
+ */
+Lgm_TS07_Archive *Lgm_TS07_OpenArchive( const char *Filename ) {
+
+    int                     fd;
+    struct stat             sb;
+    size_t                  Size;
+    unsigned char           *Base;
+    Lgm_TS07_ArchiveHeader  *h;
+    Lgm_TS07_Archive        *a;
+
+    if ( (fd = open( Filename, O_RDONLY )) < 0 ) return( NULL );
+    if ( (fstat( fd, &sb ) < 0) || (sb.st_size < (off_t)sizeof(Lgm_TS07_ArchiveHeader)) ) {
+        close( fd );
+        return( NULL );
+    }
+    Size = (size_t)sb.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+    Base = (unsigned char *)mmap( NULL, Size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( Base == (unsigned char *)MAP_FAILED ) return( NULL );
+#else
+    if ( (Base = (unsigned char *)malloc( Size )) == NULL ) {
+        close( fd );
+        return( NULL );
+    }
+    if ( read( fd, Base, Size ) != (ssize_t)Size ) {
+        free( Base );
+        close( fd );
+        return( NULL );
+    }
+    close( fd );
+#endif
+
+    /*
+     *  Validate the header
+     */
+    h = (Lgm_TS07_ArchiveHeader *)Base;
+    if ( (memcmp( h->Magic, LGM_TS07_ARCHIVE_MAGIC, 8 ) != 0) || (h->Version != LGM_TS07_ARCHIVE_VERSION)
+            || (h->ByteOrder != 1.0) || (h->nA != LGM_TS07_NA) || (h->nTail != LGM_TS07_NTAIL)
+            || (h->nSlots < 0) || (h->nRecords < 0)
+            || (h->TailOffset + LGM_TS07_NTAIL*sizeof(double) > Size)
+            || (h->IndexOffset + h->nSlots*sizeof(int32_t) > Size)
+            || (h->DataOffset + h->nRecords*LGM_TS07_NA*sizeof(double) > Size) ) {
+        fprintf( stderr, "Lgm_TS07_OpenArchive(): %s is not a valid TS07D coefficient archive.\n", Filename );
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+
+    if ( (a = (Lgm_TS07_Archive *)calloc( 1, sizeof(Lgm_TS07_Archive) )) == NULL ) {
+#ifdef HAVE_SYS_MMAN_H
+        munmap( Base, Size );
+#else
+        free( Base );
+#endif
+        return( NULL );
+    }
+    a->Base     = Base;
+    a->Size     = Size;
+    a->Header   = h;
+    a->Tail     = (const double *)(Base + h->TailOffset);
+    a->Index    = (const int32_t *)(Base + h->IndexOffset);
+    a->Data     = (const double *)(Base + h->DataOffset);
+    a->Slot0    = h->JDN0*LGM_TS07_SLOTS_PER_DAY;
+
+    return( a );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Close an archive opened with Lgm_TS07_OpenArchive().
+ */
+void Lgm_TS07_CloseArchive( Lgm_TS07_Archive *a ) {
+
+    if ( a == NULL ) return;
+#ifdef HAVE_SYS_MMAN_H
+    munmap( a->Base, a->Size );
+#else
+    free( a->Base );
+#endif
+    free( a );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Return the process-wide archive (opening it on first use).
+ *
+ *  \details
+ *      Returns NULL if there is no archive (see Lgm_TS07_ArchiveFilename()).
+ *      The archive stays mapped for the life of the process.
+ */
+Lgm_TS07_Archive *Lgm_TS07_GetArchive( ) {
+
+    char    Filename[1024];
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TS07_Archive)
+#endif
+    {
+        if ( !Lgm_TS07_SharedArchive_Tried ) {
+            Lgm_TS07_ArchiveFilename( Filename, 1024 );
+            Lgm_TS07_SharedArchive       = Lgm_TS07_OpenArchive( Filename );
+            Lgm_TS07_SharedArchive_Tried = TRUE;
+        }
+    }
+
+    return( Lgm_TS07_SharedArchive );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Look up the coefficients for a given epoch.
+ *
+ *      \param[in]      a           Archive.
+ *      \param[in]      Date        Date in YYYYMMDD format.
+ *      \param[in]      UTC         Time in decimal hours.
+ *
+ *      \return         Pointer to LGM_TS07_NA coefficients (i.e. A[1..101] stored starting at index 0), or NULL if the epoch is not in the archive.
+ */
+const double *Lgm_TS07_ArchiveCoeffs( Lgm_TS07_Archive *a, long int Date, double UTC ) {
+
+    int64_t n;
+    int32_t r;
+
+    if ( a == NULL ) return( NULL );
+
+    n = Lgm_TS07_Slot( Date, UTC ) - a->Slot0;
+    if ( (n < 0) || (n >= a->Header->nSlots) ) return( NULL );
+    if ( ((r = a->Index[n]) < 0) || (r >= a->Header->nRecords) ) return( NULL );
+
+    return( a->Data + (int64_t)r*LGM_TS07_NA );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Copy the tail coefficients from an archive into a LgmTsyg2007_Info structure.
+ */
+void Lgm_TS07_ArchiveTailPar( Lgm_TS07_Archive *a, LgmTsyg2007_Info *t ) {
+
+    int             i, j, k;
+    const double    *p = a->Tail;
+
+    for ( i=1; i<=5; i++ ) for ( k=1; k<=80; k++ ) t->TSS[k][i] = *p++;
+    for ( i=1; i<=5; i++ ) for ( j=1; j<=4; j++ ) for ( k=1; k<=80; k++ ) t->TSO[k][i][j] = *p++;
+    for ( i=1; i<=5; i++ ) for ( j=1; j<=4; j++ ) for ( k=1; k<=80; k++ ) t->TSE[k][i][j] = *p++;
+
+}
+
+
+
+/*
+ *  TS07 data directory ($TS07_DATA_PATH or LGM_TS07_DATA_DIR).
+ */
+static const char *Lgm_TS07_DataPath( ) {
+
+    const char *Path = getenv( "TS07_DATA_PATH" );
+
+    return( ( Path == NULL ) ? LGM_TS07_DATA_DIR : Path );
+
+}
+
+
+
+/*
+ *  The cached day for JDN, or NULL. Must be called inside the Lgm_TS07_Cache
+ *  critical section.
+ */
+static Lgm_TS07_CacheDay *Lgm_TS07_FindDay( long int JDN, const char *Path ) {
+
+    int k;
+
+    for ( k=0; k<LGM_TS07_CACHE_DAYS; k++ ) {
+        if ( ( Lgm_TS07_Cache[k].A != NULL ) && ( Lgm_TS07_Cache[k].JDN == JDN ) && ( strcmp( Lgm_TS07_Cache[k].Path, Path ) == 0 ) ) {
+            Lgm_TS07_Cache[k].LastUsed = ++Lgm_TS07_CacheClock;
+            return( &Lgm_TS07_Cache[k] );
+        }
+    }
+
+    return( NULL );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Read a day of TS07D coefficient files into the day cache.
+ *
+ *  \details
+ *      The files are read without holding the cache, so this can run on a
+ *      background thread while Lgm_SetCoeffs_TS07() is being called on
+ *      others. Nothing is read if the archive (see Lgm_TS07_GetArchive())
+ *      already has the day. The cache holds the last few days prefetched.
+ *
+ *      \param[in]      Date    Date in YYYYMMDD format.
+ *
+ *      \return         TRUE if the coefficients for the day are in the archive or the cache afterwards.
+ */
+int Lgm_TS07_PrefetchDay( long int Date ) {
+
+    int                 year, month, day, doy, s, k, n, Found;
+    long int            JDN;
+    double              A[LGM_TS07_NA+1], *Coeffs;
+    char                Filename[1024], Have[LGM_TS07_SLOTS_PER_DAY];
+    const char          *Path = Lgm_TS07_DataPath( );
+    Lgm_TS07_Archive    *a = Lgm_TS07_GetArchive( );
+    Lgm_TS07_CacheDay   *c;
+
+    Lgm_Doy( Date, &year, &month, &day, &doy );
+    JDN = Lgm_JDN( year, month, day );
+
+    if ( ( a != NULL ) && ( (int64_t)JDN*LGM_TS07_SLOTS_PER_DAY >= a->Slot0 )
+            && ( (int64_t)(JDN+1)*LGM_TS07_SLOTS_PER_DAY <= a->Slot0 + a->Header->nSlots ) ) return( TRUE );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TS07_Cache)
+#endif
+    {
+        Found = ( Lgm_TS07_FindDay( JDN, Path ) != NULL );
+    }
+    if ( Found ) return( TRUE );
+
+    Coeffs = (double *)malloc( LGM_TS07_SLOTS_PER_DAY*LGM_TS07_NA*sizeof(double) );
+    for ( n=0, s=0; s<LGM_TS07_SLOTS_PER_DAY; s++ ) {
+        sprintf( Filename, "%s/Coeffs/%d_%03d/%d_%03d_%02d_%02d.par", Path, year, doy, year, doy, s/12, (s%12)*5 );
+        if ( (Have[s] = Lgm_Read_TS07_CoeffFile( Filename, A )) ) {
+            memcpy( Coeffs + s*LGM_TS07_NA, &A[1], LGM_TS07_NA*sizeof(double) );
+            ++n;
+        }
+    }
+    if ( n == 0 ) {
+        free( Coeffs );
+        return( FALSE );
+    }
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TS07_Cache)
+#endif
+    {
+        if ( Lgm_TS07_FindDay( JDN, Path ) == NULL ) {
+            for ( c=&Lgm_TS07_Cache[0], k=1; k<LGM_TS07_CACHE_DAYS; k++ ) {
+                if ( Lgm_TS07_Cache[k].LastUsed < c->LastUsed ) c = &Lgm_TS07_Cache[k];
+            }
+            free( c->A );
+            c->A        = Coeffs;
+            c->JDN      = JDN;
+            c->LastUsed = ++Lgm_TS07_CacheClock;
+            snprintf( c->Path, 1024, "%s", Path );
+            memcpy( c->Have, Have, LGM_TS07_SLOTS_PER_DAY );
+            Coeffs = NULL;
+        }
+    }
+    free( Coeffs );
+
+    return( TRUE );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Look up the coefficients for a given epoch in the day cache.
+ *
+ *      \param[in]      Date        Date in YYYYMMDD format.
+ *      \param[in]      UTC         Time in decimal hours.
+ *      \param[out]     A           The coefficients, A[1..101].
+ *
+ *      \return         TRUE if the epoch was in the cache.
+ */
+int Lgm_TS07_CachedCoeffs( long int Date, double UTC, double *A ) {
+
+    int                 Found = FALSE;
+    int64_t             n = Lgm_TS07_Slot( Date, UTC );
+    const char          *Path = Lgm_TS07_DataPath( );
+    Lgm_TS07_CacheDay   *c;
+
+    if ( n < 0 ) return( FALSE );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TS07_Cache)
+#endif
+    {
+        c = Lgm_TS07_FindDay( (long int)(n/LGM_TS07_SLOTS_PER_DAY), Path );
+        if ( ( c != NULL ) && c->Have[n%LGM_TS07_SLOTS_PER_DAY] ) {
+            memcpy( &A[1], c->A + (n%LGM_TS07_SLOTS_PER_DAY)*LGM_TS07_NA, LGM_TS07_NA*sizeof(double) );
+            Found = TRUE;
+        }
+    }
+
+    return( Found );
+
+}
+
+
+
+/**
+ *  \brief
+ *      Build a TS07D coefficient archive from the text files.
+ *
+ *  \details
+ *      Reads Path/TAIL_PAR/tail*.par and every Path/Coeffs/YYYY_DDD/YYYY_DDD_HH_MM.par
+ *      file between StartDate and EndDate (inclusive) and writes them into
+ *      ArchiveFile. Epochs with no file are marked missing in the index.
+ *
+ *      \param[in]      Path        TS07 data directory (NULL means the usual default, i.e. $TS07_DATA_PATH or LGM_TS07_DATA_DIR).
+ *      \param[in]      StartDate   First date in YYYYMMDD format.
+ *      \param[in]      EndDate     Last date in YYYYMMDD format.
+ *      \param[in]      ArchiveFile Output filename.
+ *
+ *      \return         Number of epochs written, or -1 on error.
+ */
+long int Lgm_TS07_BuildArchive( const char *Path, long int StartDate, long int EndDate, const char *ArchiveFile ) {
+
+    int                     y0, m0, d0, y1, m1, d1, year, month, day, doy, s, j, k;
+    long int                Date, JDN, JDN0, JDN1, nRecords;
+    int64_t                 i, nSlots;
+    double                  A[LGM_TS07_NA+1], UT;
+    int32_t                 *Index;
+    char                    Filename[1024];
+    FILE                    *fp_out;
+    Lgm_TS07_ArchiveHeader  h;
+    LgmTsyg2007_Info        t;
+
+    if ( Path == NULL ) Path = getenv( "TS07_DATA_PATH" );
+    if ( Path == NULL ) Path = LGM_TS07_DATA_DIR;
+
+    Lgm_Doy( StartDate, &y0, &m0, &d0, &doy );
+    Lgm_Doy( EndDate,   &y1, &m1, &d1, &doy );
+    JDN0 = Lgm_JDN( y0, m0, d0 );
+    JDN1 = Lgm_JDN( y1, m1, d1 );
+    if ( JDN1 < JDN0 ) {
+        fprintf( stderr, "Lgm_TS07_BuildArchive(): EndDate (%ld) is before StartDate (%ld).\n", EndDate, StartDate );
+        return( -1 );
+    }
+    nSlots = (int64_t)(JDN1 - JDN0 + 1)*LGM_TS07_SLOTS_PER_DAY;
+
+    /*
+     *  Tail coeffs
+     */
+    t.ArraysAlloced = FALSE;
+    LGM_ARRAY_2D( t.TSS, 81, 6, double );
+    LGM_ARRAY_3D( t.TSO, 81, 6, 5, double );
+    LGM_ARRAY_3D( t.TSE, 81, 6, 5, double );
+    if ( !Lgm_Read_TS07_TailPar( Path, &t ) ) {
+        LGM_ARRAY_2D_FREE( t.TSS ); LGM_ARRAY_3D_FREE( t.TSO ); LGM_ARRAY_3D_FREE( t.TSE );
+        return( -1 );
+    }
+
+    if ( (fp_out = fopen( ArchiveFile, "wb" )) == NULL ) {
+        fprintf( stderr, "Lgm_TS07_BuildArchive(): Could not open %s for writing.\n", ArchiveFile );
+        LGM_ARRAY_2D_FREE( t.TSS ); LGM_ARRAY_3D_FREE( t.TSO ); LGM_ARRAY_3D_FREE( t.TSE );
+        return( -1 );
+    }
+
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.Magic, LGM_TS07_ARCHIVE_MAGIC, 8 );
+    h.Version     = LGM_TS07_ARCHIVE_VERSION;
+    h.nA          = LGM_TS07_NA;
+    h.nTail       = LGM_TS07_NTAIL;
+    h.ByteOrder   = 1.0;
+    h.JDN0        = JDN0;
+    h.nSlots      = nSlots;
+    h.TailOffset  = sizeof(h);
+    h.IndexOffset = h.TailOffset + LGM_TS07_NTAIL*sizeof(double);
+    h.DataOffset  = h.IndexOffset + ((nSlots*sizeof(int32_t) + 7)/8)*8; // keep records 8-byte aligned
+
+    /*
+     *  Write the tail coeffs in the order Lgm_TS07_ArchiveTailPar() expects
+     *  them, and then the records (leaving room for the header and index,
+     *  which are written at the end).
+     */
+    fseek( fp_out, h.TailOffset, SEEK_SET );
+    for ( s=1; s<=5; s++ ) for ( k=1; k<=80; k++ ) fwrite( &t.TSS[k][s], sizeof(double), 1, fp_out );
+    for ( s=1; s<=5; s++ ) for ( j=1; j<=4; j++ ) for ( k=1; k<=80; k++ ) fwrite( &t.TSO[k][s][j], sizeof(double), 1, fp_out );
+    for ( s=1; s<=5; s++ ) for ( j=1; j<=4; j++ ) for ( k=1; k<=80; k++ ) fwrite( &t.TSE[k][s][j], sizeof(double), 1, fp_out );
+    LGM_ARRAY_2D_FREE( t.TSS ); LGM_ARRAY_3D_FREE( t.TSO ); LGM_ARRAY_3D_FREE( t.TSE );
+
+    Index = (int32_t *)calloc( nSlots, sizeof(int32_t) );
+    fseek( fp_out, h.DataOffset, SEEK_SET );
+    nRecords = 0;
+    for ( JDN=JDN0; JDN<=JDN1; JDN++ ) {
+
+        Lgm_jd_to_ymdh( (double)JDN, &Date, &year, &month, &day, &UT );
+        Lgm_Doy( Date, &year, &month, &day, &doy );
+
+        for ( s=0; s<LGM_TS07_SLOTS_PER_DAY; s++ ) {
+
+            i = (int64_t)(JDN-JDN0)*LGM_TS07_SLOTS_PER_DAY + s;
+            sprintf( Filename, "%s/Coeffs/%d_%03d/%d_%03d_%02d_%02d.par", Path, year, doy, year, doy, s/12, (s%12)*5 );
+            if ( Lgm_Read_TS07_CoeffFile( Filename, A ) ) {
+                fwrite( &A[1], sizeof(double), LGM_TS07_NA, fp_out );
+                Index[i] = (int32_t)nRecords++;
+            } else {
+                Index[i] = -1;
+            }
+
+        }
+
+    }
+    h.nRecords = nRecords;
+
+    fseek( fp_out, 0, SEEK_SET );
+    fwrite( &h, sizeof(h), 1, fp_out );
+    fseek( fp_out, h.IndexOffset, SEEK_SET );
+    fwrite( Index, sizeof(int32_t), nSlots, fp_out );
+    free( Index );
+
+    if ( fclose( fp_out ) != 0 ) {
+        fprintf( stderr, "Lgm_TS07_BuildArchive(): Error writing %s.\n", ArchiveFile );
+        return( -1 );
+    }
+
+    return( nRecords );
+
+}
@@ -0,0 +1,175 @@
+/*! \file Lgm_Tasks.c
+ *
+ *  \brief A single pool of workers shared by the library's parallel loops.
+ *
+ *  \details
+ *      Lgm_ParallelFor() runs Task( i, Data ) for i = 0..n-1 through the
+ *      current executor and waits for all of them.
+ *
+ *      The default executor (Lgm_DefaultExecutor()) uses OpenMP tasks, and
+ *      the OpenMP runtime does the load balancing (idle threads take queued
+ *      tasks from busy ones). If it is called outside of any parallel region
+ *      it starts one team, has one thread create the tasks and lets the whole
+ *      team run them. If it is called from inside a parallel region -- e.g.
+ *      from a Task of an outer Lgm_ParallelFor() -- it just creates the tasks
+ *      in the team that is already there and waits for them with taskwait.
+ *      So a loop over times that calls Lgm_ComputeLstarVersusPA(), which
+ *      loops over pitch angles, ends up with (time x pitch angle) tasks in a
+ *      single pool rather than with nested teams that either oversubscribe
+ *      the cores or get serialized.
+ *
+ *      With Lgm_SetThreadPinning( TRUE ) the threads of the team pin
+ *      themselves to CPUs first (see Lgm_Numa.c).
+ *
+ *      Codes that have their own thread pool can plug it in with
+ *      Lgm_SetExecutor(). Lgm_SerialExecutor() runs everything in order on
+ *      the calling thread (handy for debugging).
+ *
+ *      Tasks are independent, but some of them warm-start from state left
+ *      behind by whatever ran before them on the same context, or share
+ *      things between them (e.g. the field line cache and shell history of
+ *      Lgm_ComputeLstarVersusPA()). That is faster, but the last few bits
+ *      of the answers then depend on the thread count and on the order the
+ *      tasks happened to run in. Lgm_SetDeterministic( TRUE ) turns that
+ *      off (see Lgm_GetDeterministic()'s callers), e.g. for checking the
+ *      results of a build against saved ones bit for bit:
+ *          - each task's scratch copies start from a reset integrator
+ *            state (Lgm_MagStep_ResetState()),
+ *          - the FieldLineCache and ShellHistory are not used by
+ *            Lgm_ComputeLstarVersusPA(),
+ *          - Lgm_Trace() ignores mInfo->ConcurrentTrace (whether it is used
+ *            depends on whether the trace is inside a parallel region).
+ *      The results of the tasks are all stored by index and combined in
+ *      index order, so nothing else depends on the scheduling.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include "Lgm/Lgm_Tasks.h"
+
+static Lgm_ExecutorFunc Lgm_Executor     = Lgm_DefaultExecutor;
+static void             *Lgm_ExecutorData = NULL;
+static int              Lgm_DeterministicFlag = 0;
+static int              Lgm_MaxThreads = 0;
+
+
+/**
+ *  Run Task( i, Data ) for i = 0..n-1 with the current executor. Returns
+ *  when all n are done.
+ */
+void Lgm_ParallelFor( long int n, Lgm_TaskFunc Task, void *Data ) {
+
+    if ( n <= 0 ) return;
+    if ( n == 1 ) { Task( 0, Data ); return; }
+    Lgm_Executor( n, Task, Data, Lgm_ExecutorData );
+
+}
+
+
+/**
+ *  Replace the executor used by Lgm_ParallelFor(). A NULL Executor puts
+ *  back Lgm_DefaultExecutor(). This is a global setting, so change it only
+ *  when no Lgm_ParallelFor() is running.
+ */
+void Lgm_SetExecutor( Lgm_ExecutorFunc Executor, void *ExecData ) {
+
+    Lgm_Executor     = ( Executor != NULL ) ? Executor : Lgm_DefaultExecutor;
+    Lgm_ExecutorData = ( Executor != NULL ) ? ExecData : NULL;
+
+}
+
+
+/**
+ *  Turn deterministic mode (see the notes at the top of the file) on or
+ *  off. Like Lgm_SetExecutor() this is a global setting.
+ */
+void Lgm_SetDeterministic( int Flag ) {
+    Lgm_DeterministicFlag = ( Flag != 0 );
+}
+
+int Lgm_GetDeterministic( void ) {
+    return( Lgm_DeterministicFlag );
+}
+
+
+/**
+ *  Cap the number of threads the library's parallel loops use (the team
+ *  started by Lgm_DefaultExecutor() and the loops in Lgm_AtTimes.c). n <= 0
+ *  removes the cap, i.e. goes back to whatever OpenMP would use
+ *  (OMP_NUM_THREADS, omp_set_num_threads(), ...). This lets a caller (e.g.
+ *  lgmpy's get_Lstar_batch( ..., workers=N )) pick the thread count per
+ *  call without touching the OpenMP settings of the rest of the process.
+ *  Like Lgm_SetExecutor() this is a global setting.
+ */
+void Lgm_SetMaxThreads( int n ) {
+    Lgm_MaxThreads = ( n > 0 ) ? n : 0;
+}
+
+/**
+ *  Number of threads a parallel loop started now would get (always 1 in
+ *  builds without OpenMP).
+ */
+int Lgm_GetMaxThreads( void ) {
+#if USE_OPENMP
+    return( ( Lgm_MaxThreads > 0 ) ? Lgm_MaxThreads : omp_get_max_threads() );
+#else
+    return( 1 );
+#endif
+}
+
+
+void Lgm_SerialExecutor( long int n, Lgm_TaskFunc Task, void *Data, void *ExecData ) {
+
+    long int    i;
+
+    for ( i=0; i<n; i++ ) Task( i, Data );
+
+}
+
+
+/**
+ *  OpenMP task executor (see the notes at the top of the file). Falls back
+ *  to Lgm_SerialExecutor() in builds without OpenMP.
+ */
+void Lgm_DefaultExecutor( long int n, Lgm_TaskFunc Task, void *Data, void *ExecData ) {
+
+#if USE_OPENMP
+    long int    i;
+
+    if ( omp_in_parallel() ) {
+
+        /*
+         *  Already inside a team. Queue the tasks there; this thread helps
+         *  run them (and anything else that is queued) while it waits.
+         */
+        for ( i=0; i<n; i++ ) {
+            #pragma omp task firstprivate(i) shared(Task,Data)
+            Task( i, Data );
+        }
+        #pragma omp taskwait
+
+    } else {
+
+        #pragma omp parallel shared(Task,Data,n) private(i) num_threads(Lgm_GetMaxThreads())
+        {
+            if ( Lgm_GetThreadPinning() ) Lgm_PinThread( omp_get_thread_num() );
+            #pragma omp single nowait
+            {
+                for ( i=0; i<n; i++ ) {
+                    #pragma omp task firstprivate(i) shared(Task,Data)
+                    Task( i, Data );
+                }
+            }
+        } // the implicit barrier waits for all of the tasks
+
+    }
+#else
+    Lgm_SerialExecutor( n, Task, Data, ExecData );
+#endif
+
+}
@@ -27,10 +27,75 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_WGS84.h"
+#include "Lgm/Lgm_Tasks.h"
+#include "Lgm/Lgm_Profile.h"
+
+
+#if USE_OPENMP
+/*
+ *  Used by Lgm_Trace() when Info->ConcurrentTrace is set. Once the start
+ *  point is known, the traces to the northern footpoint, the southern
+ *  footpoint and the min-B point do not depend on each other, so do them as
+ *  three parallel sections. The north trace uses Info itself, the other two
+ *  use scratch clones that are folded back into Info afterwards.
+ *
+ *  The min-B trace is started from u (as Lgm_Trace() does for closed field
+ *  lines) before we know whether the line is closed. Its result is returned
+ *  in v3 and Trace_s3, and *flag3 is what Lgm_TraceToMinBSurf() returned.
+ */
+static int Lgm_Trace_Concurrent( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, double TOL1, double TOL2,
+                                 int *flag1, int *flag2, int *flag3, double *Trace_s3, Lgm_MagModelInfo *Info ) {
+
+    Lgm_MagModelInfo    *mS, *mB;
+
+    mS = Lgm_NewMagContext( Info );
+    mB = Lgm_NewMagContext( Info );
+    if ( ( mS == NULL ) || ( mB == NULL ) ) {
+        if ( mS ) Lgm_FreeMagInfo( mS );
+        if ( mB ) Lgm_FreeMagInfo( mB );
+        return( FALSE );
+    }
+
+    // the three traces use different records, so they can all share Info's trace history.
+    mS->TraceHistory = mB->TraceHistory = Info->TraceHistory;
+
+    #pragma omp parallel sections num_threads(3)
+    {
+        #pragma omp section
+        *flag2 = Lgm_TraceToEarth( u, v2, Height,  1.0, TOL1, Info );
+
+        #pragma omp section
+        *flag1 = Lgm_TraceToEarth( u, v1, Height, -1.0, TOL1, mS );
+
+        #pragma omp section
+        *flag3 = Lgm_TraceToMinBSurf( u, v3, 0.1, TOL2, mB );
+    }
+
+    Info->Snorth = Info->Trace_s;
+    Info->Ssouth = mS->Trace_s;
+    *Trace_s3    = mB->Trace_s;
+
+    Info->Lgm_nMagEvals += mS->Lgm_nMagEvals + mB->Lgm_nMagEvals;
+    Lgm_MagModelInfo_AddStats( Info, mS );
+    Lgm_MagModelInfo_AddStats( Info, mB );
+
+    Lgm_FreeMagInfo( mS );
+    Lgm_FreeMagInfo( mB );
+
+    return( TRUE );
+
+}
+#endif
 
 
 /**
@@ -48,6 +113,29 @@
  *      the geodetic height above the WGS84 ellipsoid. If you want to trace to a
  *      spherical representation of the Earth, use Lgm_TraceToSphericalEarth()
  *      instead.
+ *
+ *      For the Dungey field (Lgm_B_Dungey()) the results come from
+ *      Lgm_Dungey_Trace() instead, unless Info->UseDipoleFastPath is FALSE.
+ *
+ *      If Info->ConcurrentTrace is TRUE (and the library was built with
+ *      OpenMP), the two footpoint traces and the min-B trace are done in
+ *      parallel on scratch copies of Info. The results are the same; this
+ *      only helps latency when a single point is being traced. It is ignored
+ *      when called from within a parallel region, when SavePoints is set or
+ *      in deterministic mode (see Lgm_SetDeterministic()).
+ *
+ *      Info->TraceOutputs (an OR of LGM_TRACE_SOUTH, LGM_TRACE_NORTH,
+ *      LGM_TRACE_BMIN and LGM_TRACE_TYPE; LGM_TRACE_ALL by default) says
+ *      which of the outputs are wanted, and the traces that arent needed for
+ *      them are skipped. E.g. with just LGM_TRACE_SOUTH only the trace to the
+ *      southern footpoint is done, which is a third of the work. Outputs
+ *      that werent asked for are left as fill values (v's are set to -1e31).
+ *      An end that isnt traced is taken to be attached to the Earth, so the
+ *      return value only reflects the ends that were traced (e.g. with
+ *      LGM_TRACE_BMIN alone, LGM_CLOSED is returned unless the start point
+ *      is inside the Earth). Add LGM_TRACE_TYPE to have both ends traced and
+ *      the field line type be exact (LGM_TRACE_TYPE alone gives just the
+ *      type, without the min-B trace).
  *  
  *      \param[in]       u     Input position vector in GSM coordinates.
  *      \param[out]     v1     Southern footpoint (where field line crosses the given geodetic height in the south) in GSM coordinates.
@@ -65,7 +153,8 @@
  *          - LGM_OPEN_S_LOBE  ( = 3 ) if field line is southern lobe FL (v1 valid).
  *          - LGM_INSIDE_EARTH ( = -1 ) initial point is inside Earth (no points valid).
  *          - LGM_TARGET_HEIGHT_UNREACHABLE ( = -2 ) field line never got above the target height (no points valid).
- *          - LGM_BAD_TRACE    ( = -3 ) Lgm_MagStep() was unable to make a non-zero step (B-field zero?).
+ *          - LGM_BAD_TRACE    ( = -3 ) Lgm_MagStep() was unable to make a non-zero step (B-field zero?), or a stage callback (see
+ *                                      Lgm_StageHooks.c) cancelled the calculation.
  *
  *
  *  Upon return, the following elements of the Info structure will be set or changed;
@@ -101,17 +190,46 @@
  *  Original version quite old (early 90's?)
  *  
  */
+static int Lgm_Trace_Body( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, double TOL1, double TOL2, Lgm_MagModelInfo *Info );
 int Lgm_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, double TOL1, double TOL2, Lgm_MagModelInfo *Info ) {
 
-    int		    i, reset, flag1, flag2, InitiallyBelowTargetHeight, done;
-    double	    sgn=1.0, R, Rtarget, Rinitial, Rplus, H, Hinitial;
-    Lgm_Vector	w, Bvec;
+    int     r;
+    double  t0;
+
+    if ( LGM_STAGE_FIRE( Info, LGM_STAGE_TRACE_BEGIN, -1, 0.0, 0.0 ) ) return( LGM_BAD_TRACE );
+    t0 = LGM_STAGE_NOW( Info );
+
+    LGM_PROFILE_BEGIN( LGM_PROF_TRACE );
+    r = Lgm_Trace_Body( u, v1, v2, v3, Height, TOL1, TOL2, Info );
+    LGM_PROFILE_END( LGM_PROF_TRACE );
+
+    if ( LGM_STAGE_FIRE( Info, LGM_STAGE_TRACE_END, -1, t0, (double)r ) ) return( LGM_BAD_TRACE );
+
+    return( r );
+
+}
+
+static int Lgm_Trace_Body( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, double Height, double TOL1, double TOL2, Lgm_MagModelInfo *Info ) {
+
+    int		    i, reset, flag1, flag2, flag3, InitiallyBelowTargetHeight, done, Concurrent, OpenNorth, OpenSouth;
+    int         Out, DoSouth, DoNorth, DoBmin;
+    double	    sgn=1.0, R, Rtarget, Rinitial, Rplus, H, Hinitial, Trace_s3;
+    Lgm_Vector	w, Bvec, v3c, vOpenN, vOpenS;
     double      h, h_inv, h2_inv, F[7], Px[7], Py[7], Pz[7], s, Hdid, Hnext, Htry;
     double      d2Px_ds2, d2Py_ds2, d2Pz_ds2;
     double      GeodLat, GeodLong, GeodHeight;
     Lgm_Vector  u_scale, P, gpp;
 
 
+    /*
+     *  The Dungey field's lines can be found without tracing (see
+     *  Lgm_Dungey.c). Not when SavePoints is set, since then the user wants
+     *  the traced points.
+     */
+    if ( Lgm_Dungey_IsPure( Info ) && !Info->SavePoints ) {
+        return( Lgm_Dungey_Trace( u, v1, v2, v3, Height, Info ) );
+    }
+
 
     /*
      * Determine our initial geocentric radius in km. (u is assumed to be in
@@ -212,6 +330,14 @@ int Lgm_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, do
     Info->Ssouth = LGM_FILL_VALUE;
     Info->Bmin   = LGM_FILL_VALUE;
 
+    /*
+     *  Which segments do we need to trace?
+     */
+    Out     = ( Info->TraceOutputs != 0 ) ? Info->TraceOutputs : LGM_TRACE_ALL;
+    DoSouth = ( Out & ( LGM_TRACE_SOUTH | LGM_TRACE_TYPE ) ) != 0;
+    DoNorth = ( Out & ( LGM_TRACE_NORTH | LGM_TRACE_TYPE ) ) != 0;
+    DoBmin  = ( Out & LGM_TRACE_BMIN ) != 0;
+
 
 
 
@@ -224,15 +350,62 @@ int Lgm_Trace( Lgm_Vector *u, Lgm_Vector *v1, Lgm_Vector *v2, Lgm_Vector *v3, do
 Info->Hmax = 0.50;
 Info->Hmax = 0.10;
 
+
+    /*
+     *  If asked to, find out cheaply whether either end is open. There is no
+     *  need to trace an open end all the way out to the OpenLimit_* box.
+     */
+    OpenNorth = OpenSouth = FALSE;
+    if ( Info->PreClassifyFieldLines && !InitiallyBelowTargetHeight && DoSouth && DoNorth ) {
+        Lgm_ClassifyFieldLine( u, Height, &OpenNorth, &OpenSouth, &vOpenN, &vOpenS, Info );
+    }
+
+    /*
+     *  If asked to (and we are not already inside a parallel region), do the
+     *  two footpoint traces and the min-B trace at the same time. Not done
+     *  when SavePoints is set since all three would write to the same file,
+     *  or in deterministic mode (the south and min-B traces start with a
+     *  different integrator state than they do when done one after the
+     *  other, and which way we go depends on where we are called from).
+     */
+    Concurrent = FALSE;
+#if USE_OPENMP
+    if ( Info->ConcurrentTrace && DoSouth && DoNorth && DoBmin && !Info->SavePoints && !Lgm_GetDeterministic() && !omp_in_parallel() && !OpenNorth && !OpenSouth ) {
+        Concurrent = Lgm_Trace_Concurrent( u, v1, v2, &v3c, Height, TOL1, TOL2, &flag1, &flag2, &flag3, &Trace_s3, Info );
+    }
+#endif
+
+    if ( Concurrent ) {
+
+        Info->v2_final = *v2;
+        Info->v1_final = *v1;
+
+    } else {
     
-    flag2 = Lgm_TraceToEarth(  u, v2, Height, -sgn, TOL1, Info );
-    Info->Snorth = Info->Trace_s;     // save distance from u to northern footpoint location.
-    Info->v2_final = *v2;
+        if ( !DoNorth ) {
+            flag2 = TRUE; v2->x = v2->y = v2->z = -1e31;     // not traced (taken to be attached)
+        } else if ( OpenNorth ) {
+            flag2 = 0; *v2 = vOpenN;
+            Info->Snorth = LGM_FILL_VALUE;
+        } else {
+            flag2 = Lgm_TraceToEarth(  u, v2, Height, -sgn, TOL1, Info );
+            Info->Snorth = Info->Trace_s;     // save distance from u to northern footpoint location.
+        }
+        Info->v2_final = *v2;
+
 
+        if ( !DoSouth ) {
+            flag1 = TRUE; v1->x = v1->y = v1->z = -1e31;     // not traced (taken to be attached)
+        } else if ( OpenSouth ) {
+            flag1 = 0; *v1 = vOpenS;
+            Info->Ssouth = LGM_FILL_VALUE;
+        } else {
+            flag1 = Lgm_TraceToEarth(  u, v1, Height,  sgn, TOL1, Info );
+            Info->Ssouth = Info->Trace_s;     // save distance from u to southern footpoint location.
+        }
+        Info->v1_final = *v1;
 
-    flag1 = Lgm_TraceToEarth(  u, v1, Height,  sgn, TOL1, Info );
-    Info->Ssouth = Info->Trace_s;     // save distance from u to southern footpoint location.
-    Info->v1_final = *v1;
+    }
 
     Info->Stotal = LGM_FILL_VALUE;
     Info->Smin   = LGM_FILL_VALUE;
@@ -248,14 +421,23 @@ Info->Hmax = 0.10;
 	     */
         //Lgm_TraceToMinBSurf( v1, v3, TOL1, TOL2, Info );
         //Lgm_TraceToMinBSurf( v1, v3, 0.1, TOL2, Info );
-        Lgm_TraceToMinBSurf( u, v3, 0.1, TOL2, Info );
-        Info->v3_final = *v3;
-        Info->Pmin = *v3;
-        //Info->Smin = Info->Trace_s;     // save location of Bmin. NOTE:  Smin is measured from the southern footpoint.
-        Info->Bfield( v3, &Bvec, Info );
-        Info->Bvecmin = Bvec;
-        Info->Bmin = Lgm_Magnitude( &Bvec );
-        //printf("Bmin = %.15lf\n",  Info->Bmin );
+        if ( !DoBmin ) {
+            v3->x = v3->y = v3->z = -1e31;  // not wanted
+        } else if ( Concurrent ) {
+            *v3 = v3c;                  // already done (along with the footpoint traces)
+            Info->Trace_s = Trace_s3;
+        } else {
+            Lgm_TraceToMinBSurf( u, v3, 0.1, TOL2, Info );
+        }
+        if ( DoBmin ) {
+            Info->v3_final = *v3;
+            Info->Pmin = *v3;
+            //Info->Smin = Info->Trace_s;     // save location of Bmin. NOTE:  Smin is measured from the southern footpoint.
+            Info->Bfield( v3, &Bvec, Info );
+            Info->Bvecmin = Bvec;
+            Info->Bmin = Lgm_Magnitude( &Bvec );
+            //printf("Bmin = %.15lf\n",  Info->Bmin );
+        }
 
         /*
          * Various FL arc lengths...
@@ -265,21 +447,59 @@ Info->Hmax = 0.10;
          *  Smin   - distance from southern footpoint to S/C (Ssouth - what we
          *           got from Lgm_TraceToMinBSurf() because we started at S/C)
          */
-        Info->Stotal = Info->Snorth + Info->Ssouth; // Total FL length
-        Info->Smin   = Info->Ssouth - Info->Trace_s;  // length from south foot to S/C
-        Info->Trace_s = Info->Stotal;
+        if ( DoSouth && DoNorth ) {
+            Info->Stotal = Info->Snorth + Info->Ssouth; // Total FL length
+            if ( DoBmin ) Info->Smin = Info->Ssouth - Info->Trace_s;  // length from south foot to S/C
+            Info->Trace_s = Info->Stotal;
+        } else if ( DoSouth && DoBmin ) {
+            Info->Smin = Info->Ssouth - Info->Trace_s;
+        }
 //printf("Info->Ssouth, Info->Trace_s = %g %g\n", Info->Ssouth, Info->Trace_s);
         
 
-        Info->Ellipsoid_Footprint_Pn = *v2;
-        Info->Bfield( v2, &Bvec, Info );
-        Info->Ellipsoid_Footprint_Bvecn = Bvec;
-        Info->Ellipsoid_Footprint_Bn    = Lgm_Magnitude( &Bvec );
+        if ( DoNorth ) {
+            Info->Ellipsoid_Footprint_Pn = *v2;
+            Info->Bfield( v2, &Bvec, Info );
+            Info->Ellipsoid_Footprint_Bvecn = Bvec;
+            Info->Ellipsoid_Footprint_Bn    = Lgm_Magnitude( &Bvec );
+        }
 
-        Info->Ellipsoid_Footprint_Ps = *v1;
-        Info->Bfield( v1, &Bvec, Info );
-        Info->Ellipsoid_Footprint_Bvecs = Bvec;
-        Info->Ellipsoid_Footprint_Bs    = Lgm_Magnitude( &Bvec );
+        if ( DoSouth ) {
+            Info->Ellipsoid_Footprint_Ps = *v1;
+            Info->Bfield( v1, &Bvec, Info );
+            Info->Ellipsoid_Footprint_Bvecs = Bvec;
+            Info->Ellipsoid_Footprint_Bs    = Lgm_Magnitude( &Bvec );
+        }
+
+        if ( !DoBmin ) return( LGM_CLOSED );
+
+    } else if ( flag1 && !DoSouth ) {
+
+        // only the north end was traced, and it is open
+        if ( DoBmin && Lgm_TraceToMinBSurf( u, v3, 0.1, TOL2, Info ) ) {
+            Info->v3_final = *v3;
+            Info->Pmin = *v3;
+            Info->Bfield( v3, &Bvec, Info );
+            Info->Bvecmin = Bvec;
+            Info->Bmin = Lgm_Magnitude( &Bvec );
+        } else {
+            v3->x = v3->y = v3->z = -1e31;
+        }
+        return( LGM_OPEN_S_LOBE );
+
+    } else if ( flag2 && !DoNorth ) {
+
+        // only the south end was traced, and it is open
+        if ( DoBmin && Lgm_TraceToMinBSurf( u, v3, 0.1, TOL2, Info ) ) {
+            Info->v3_final = *v3;
+            Info->Pmin = *v3;
+            Info->Bfield( v3, &Bvec, Info );
+            Info->Bvecmin = Bvec;
+            Info->Bmin = Lgm_Magnitude( &Bvec );
+        } else {
+            v3->x = v3->y = v3->z = -1e31;
+        }
+        return( LGM_OPEN_N_LOBE );
 
     } else if ( flag1 ) {
 
@@ -294,7 +514,9 @@ Info->Hmax = 0.10;
          * It is not a closed FL, but it may still have a min-B
          * Try to find it.
          */
-        if ( Lgm_TraceToMinBSurf( v1, v3, 0.1, TOL2, Info ) ) {
+        if ( !DoBmin ) {
+            v3->x = v3->y = v3->z = -1e31;
+        } else if ( Lgm_TraceToMinBSurf( v1, v3, 0.1, TOL2, Info ) ) {
             Info->v3_final = *v3;
             Info->Pmin = *v3;
             Info->Bfield( v3, &Bvec, Info );
@@ -321,7 +543,9 @@ Info->Hmax = 0.10;
          * It is not a closed FL, but it may stilkl have a min-B
          * Try to find it.
          */
-        if ( Lgm_TraceToMinBSurf( v2, v3, 0.1, TOL2, Info ) ) {
+        if ( !DoBmin ) {
+            v3->x = v3->y = v3->z = -1e31;
+        } else if ( Lgm_TraceToMinBSurf( v2, v3, 0.1, TOL2, Info ) ) {
             Info->v3_final = *v3;
             Info->Pmin = *v3;
             Info->Bfield( v3, &Bvec, Info );
@@ -0,0 +1,265 @@
+/*! \file Lgm_TraceHistory.c
+ *
+ *  \brief Remember how traces turned out at one epoch so the next epoch can start from there.
+ *
+ *  In a time series (e.g. MagEphem) the same traces are done at every time
+ *  step from a start point that has barely moved. Each of Lgm_TraceToEarth(),
+ *  Lgm_TraceToMinBSurf() and Lgm_TraceToMirrorPoint() normally starts with a
+ *  conservative step size that the integrator then has to grow, and brackets
+ *  its answer with whatever step the integrator happened to take last (which
+ *  can be a good fraction of an Re wide). If an Lgm_TraceHistory is attached
+ *  to the Lgm_MagModelInfo structure, those routines look up the record left
+ *  by the same trace at the previous epoch and:
+ *
+ *      - start the bracketing loop with the step size the integrator asked
+ *        for last time,
+ *      - predict the arc length to the answer (linearly, from the last two
+ *        epochs) and make the bracketing loop land on points at S-W, S and
+ *        S+W so that, if the prediction is good, the bracket handed to the
+ *        bisection/golden section/Brent stage is only 2W wide.
+ *
+ *  The seed only changes where steps are placed. If the prediction is wrong
+ *  the loop simply carries on as it would have anyway, so the answers agree
+ *  with the unseeded ones to within the tracing tolerances.
+ *
+ *  Records are matched on the kind of trace, its direction, the start point
+ *  (within MaxShift) and, for mirror points, Bm (within 25%). The nearest
+ *  match wins, so several different traces (north and south footpoints, the
+ *  mirror points for each pitch angle, ...) can live in one history.
+ *
+ *  A history belongs to one serial sequence of traces. Lgm_CopyMagInfo()
+ *  does not pass it on to copies. Use one history per trajectory, e.g.
+ *
+ *      h = Lgm_InitTraceHistory( -1.0, -1 );
+ *      Lgm_MagModelInfo_Set_TraceHistory( h, mInfo );
+ *      for ( each time step ) {
+ *          ...  Lgm_Trace( ..., mInfo ) etc.
+ *      }
+ *      Lgm_MagModelInfo_Set_TraceHistory( NULL, mInfo );
+ *      Lgm_FreeTraceHistory( h );
+ *
+ *  Call Lgm_ResetTraceHistory() if the time series has a big gap.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_TRACEHIST_MAX_DLOGBM    0.25    // Max |ln(Bm/Bm_record)| for a mirror point record to match
+
+
+/*
+ *  Allocate an empty history. MaxShift (<= 0 gives 0.5 Re) is how far apart
+ *  two start points can be and still be considered the same trace, and
+ *  MaxRecords (<= 0 gives 64) caps the number of records kept.
+ */
+Lgm_TraceHistory *Lgm_InitTraceHistory( double MaxShift, int MaxRecords ) {
+
+    Lgm_TraceHistory *h;
+
+    h = (Lgm_TraceHistory *) calloc( 1, sizeof( *h ) );
+    h->MaxShift   = ( MaxShift > 0.0 ) ? MaxShift : 0.5;
+    h->MaxRecords = ( MaxRecords > 0 ) ? MaxRecords : 64;
+    h->Width      = 1e-4;
+    h->Records    = (Lgm_TraceHistoryRecord *) calloc( h->MaxRecords, sizeof( Lgm_TraceHistoryRecord ) );
+
+    return( h );
+
+}
+
+
+void Lgm_FreeTraceHistory( Lgm_TraceHistory *h ) {
+
+    if ( h == NULL ) return;
+    free( h->Records );
+    free( h );
+
+}
+
+
+/*
+ *  Forget all of the records (the counters are kept).
+ */
+void Lgm_ResetTraceHistory( Lgm_TraceHistory *h ) {
+
+    if ( h == NULL ) return;
+    h->nRecords = 0;
+
+}
+
+
+void Lgm_MagModelInfo_Set_TraceHistory( Lgm_TraceHistory *h, Lgm_MagModelInfo *m ) {
+    m->TraceHistory = h;
+}
+
+
+/*
+ *  Index of the record that best matches the given trace (or -1).
+ */
+static int Lgm_TraceHistory_Find( Lgm_TraceHistory *h, int Kind, double sgn, double Bm, Lgm_Vector *u ) {
+
+    int                     i, iBest = -1;
+    double                  d, dlogB, Score, BestScore = 1e99;
+    Lgm_TraceHistoryRecord  *r;
+
+    for ( i=0; i<h->nRecords; i++ ) {
+
+        r = &h->Records[i];
+        if ( ( r->Kind != Kind ) || ( r->sgn*sgn <= 0.0 ) ) continue;
+
+        d = Lgm_VecDiffMag( &r->u, u );
+        if ( d > h->MaxShift ) continue;
+        Score = d/h->MaxShift;
+
+        if ( Kind == LGM_TRACEHIST_TO_MIRROR ) {
+            if ( ( Bm <= 0.0 ) || ( r->Bm <= 0.0 ) ) continue;
+            dlogB = fabs( log( Bm/r->Bm ) );
+            if ( dlogB > LGM_TRACEHIST_MAX_DLOGBM ) continue;
+            Score += dlogB/LGM_TRACEHIST_MAX_DLOGBM;
+        }
+
+        if ( Score < BestScore ) {
+            BestScore = Score;
+            iBest     = i;
+        }
+
+    }
+
+    return( iBest );
+
+}
+
+
+/*
+ *  Look for a record left by an earlier trace of the same kind that started
+ *  near u. If there is one, fill in Seed and return TRUE. Otherwise set
+ *  Seed->Valid to FALSE and return FALSE. Bm is only used for
+ *  LGM_TRACEHIST_TO_MIRROR.
+ */
+int Lgm_TraceHistory_Get( int Kind, double sgn, double Bm, Lgm_Vector *u, Lgm_TraceSeed *Seed, Lgm_MagModelInfo *Info ) {
+
+    int                     i;
+    Lgm_TraceHistory        *h = Info->TraceHistory;
+    Lgm_TraceHistoryRecord  *r;
+
+    Seed->Valid = FALSE;
+    if ( h == NULL ) return( FALSE );
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TraceHistory)
+#endif
+    {
+        if ( ( i = Lgm_TraceHistory_Find( h, Kind, sgn, Bm, u ) ) >= 0 ) {
+
+            r = &h->Records[i];
+            r->Stamp = ++h->Stamp;
+
+            Seed->Valid = TRUE;
+            Seed->H0    = r->H0;
+            if ( r->nS > 2 ) {
+                // allow for twice the error the last prediction had
+                Seed->S     = r->S + r->dS;
+                Seed->Width = 2.0*r->Err;
+            } else if ( r->nS > 1 ) {
+                Seed->S     = r->S + r->dS;
+                Seed->Width = fabs( r->dS );
+            } else {
+                // only one epoch so far -- the answer can move by about as much as u did.
+                Seed->S     = r->S;
+                Seed->Width = Lgm_VecDiffMag( &r->u, u );
+            }
+            if ( Seed->Width < h->Width ) Seed->Width = h->Width;
+            if ( Seed->S - Seed->Width <= 0.0 ) Seed->Valid = FALSE;    // too close to the start to be of any use
+
+            if ( Seed->Valid ) ++h->nSeeded;
+
+        }
+    }
+
+    return( Seed->Valid );
+
+}
+
+
+/*
+ *  Record how a trace turned out. H0 is the step size the integrator asked
+ *  for after the first bracketing step and S is the arc length from u to the
+ *  answer. Seed is what Lgm_TraceHistory_Get() returned for this trace (it
+ *  can be NULL); it is only used to count hits.
+ */
+void Lgm_TraceHistory_Put( int Kind, double sgn, double Bm, Lgm_Vector *u, double H0, double S, Lgm_TraceSeed *Seed, Lgm_MagModelInfo *Info ) {
+
+    int                     i;
+    Lgm_TraceHistory        *h = Info->TraceHistory;
+    Lgm_TraceHistoryRecord  *r;
+
+    if ( ( h == NULL ) || ( H0 <= 0.0 ) || ( S <= 0.0 ) ) return;
+
+#if USE_OPENMP
+    #pragma omp critical (Lgm_TraceHistory)
+#endif
+    {
+        if ( ( Seed != NULL ) && Seed->Valid && ( fabs( S - Seed->S ) <= Seed->Width ) ) ++h->nHits;
+
+        if ( ( i = Lgm_TraceHistory_Find( h, Kind, sgn, Bm, u ) ) >= 0 ) {
+
+            r = &h->Records[i];
+            if ( r->nS > 1 ) r->Err = fabs( S - ( r->S + r->dS ) );
+            r->dS = S - r->S;
+            ++r->nS;
+
+        } else {
+
+            if ( h->nRecords < h->MaxRecords ) {
+                i = h->nRecords++;
+            } else {
+                // replace the one that has gone unused the longest
+                for ( i=0, r=h->Records+1; r<h->Records+h->nRecords; r++ ) {
+                    if ( r->Stamp < h->Records[i].Stamp ) i = r - h->Records;
+                }
+            }
+            r = &h->Records[i];
+            r->Kind = Kind;
+            r->sgn  = sgn;
+            r->dS   = 0.0;
+            r->Err  = 0.0;
+            r->nS   = 1;
+
+        }
+
+        r->Bm    = Bm;
+        r->u     = *u;
+        r->H0    = H0;
+        r->S     = S;
+        r->Stamp = ++h->Stamp;
+    }
+
+}
+
+
+/*
+ *  Limit a bracketing step. S is the arc length traced so far and Htry the
+ *  step about to be taken (both positive). If the step would carry us past
+ *  one of Seed->S - Seed->Width, Seed->S, Seed->S + Seed->Width, shorten it
+ *  so that we land on that point instead. With no (valid) seed, Htry is
+ *  returned as is.
+ */
+double Lgm_TraceSeed_Step( Lgm_TraceSeed *Seed, double S, double Htry ) {
+
+    int     i;
+    double  d;
+
+    if ( ( Seed == NULL ) || !Seed->Valid ) return( Htry );
+
+    for ( i=-1; i<=1; i++ ) {
+        d = Seed->S + i*Seed->Width - S;
+        if ( ( d > 1e-3*Seed->Width ) && ( d < Htry ) ) return( d );
+    }
+
+    return( Htry );
+
+}
@@ -29,6 +29,9 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include "Lgm/Lgm_MagModelInfo.h"
@@ -91,6 +94,9 @@ int Lgm_TraceToEarth( Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double
     double	    Height_a, Height_b, Height_c, HeightPlus, HeightMinus, direction;
     Lgm_Vector	Pa, Pc, P, w;
     int		    done, reset, AboveTargetHeight;
+    double      H0 = -1.0;
+    Lgm_TraceSeed   Seed;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_EARTH );
 
     reset = TRUE;
 
@@ -276,6 +282,14 @@ int Lgm_TraceToEarth( Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double
     Htry = 0.9*Height_a;	    // This computes Htry as 90% of the distance to the Earth's surface (could be small if we are already close!)
     if (Htry > 0.1) Htry = 0.1; // If its bigger than 0.1 reset it to 0.1 -- to be safe.
 
+    /*
+     *  If we have a trace history, we know what step size worked last time
+     *  and roughly where the footpoint should be (see Lgm_TraceHistory.c).
+     */
+    if ( Lgm_TraceHistory_Get( LGM_TRACEHIST_TO_EARTH, sgn, 0.0, u, &Seed, Info ) ) {
+        Htry = ( Seed.H0 < Hmax ) ? Seed.H0 : Hmax;
+    }
+
 
 
     /*
@@ -293,10 +307,12 @@ int Lgm_TraceToEarth( Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double
 
 //Lgm_Vector BBB;
 
+        Htry = Lgm_TraceSeed_Step( &Seed, Sa, Htry );   // land on the seeded bracket (if any)
         if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) {
             *v = P;
             return(-1);
         }
+        if ( H0 < 0.0 ) H0 = Hnext;
 //Info->Bfield( &P, &BBB,  Info );
 //printf("P=%.15lf %.15lf %.15lf  B=%.15lf %.15lf %.15lf   F = %g   Htry = %g   Hnext = %g\n", P.x, P.y, P.z, BBB.x, BBB.y, BBB.z, F, Htry, Hnext );
 //printf("P=%.15lf %.15lf %.15lf  \n", P.x, P.y, P.z );
@@ -445,8 +461,185 @@ Fc = eeFunc( &Pc, TargetHeight, Info);
 
     if (Info->SavePoints) fprintf(Info->fp, "%f \t%f\t %f\t 2\n", v->x, v->y, v->z);
 
+    Lgm_TraceHistory_Put( LGM_TRACEHIST_TO_EARTH, sgn, 0.0, u, H0, Info->Trace_s, &Seed, Info );
+
     if ( Info->VerbosityLevel > 2 ) printf("Lgm_TraceToEarth(): Number of Bfield evaluations = %ld\n", Info->Lgm_nMagEvals );
 
     return( 1 );
 
 }
+
+
+
+double seFunc( Lgm_Vector *P, double TargetHeight, Lgm_MagModelInfo *Info );
+
+/**
+ *  \brief
+ *      Trace to the Earth once and get both the WGS84 (ellipsoid) and the spherical footpoints.
+ *
+ *  \details
+ *      Going down a field line, the spherical height WGS84_A*(|P|-1) is a
+ *      little less than the geodetic height, so the line crosses TargetHeight
+ *      on the sphere shortly before it crosses it on the ellipsoid. Instead of
+ *      doing Lgm_TraceToSphericalEarth() and Lgm_TraceToEarth() (two traces
+ *      down the same line), this steps down once, keeps the bracket of each
+ *      crossing, and refines both. With the dense output on (it is turned on
+ *      here for the duration), the refinement is done from the Hermite
+ *      interpolants of the steps already taken, so it costs next to nothing.
+ *
+ *      If u is not above TargetHeight on the sphere, it just calls the two
+ *      routines.
+ *
+ *      \param[in]       u           Input position vector in GSM coordinates.
+ *      \param[out]      vE          Footpoint relative to the WGS84 ellipsoid (as from Lgm_TraceToEarth()).
+ *      \param[out]      vS          Footpoint relative to the sphere of radius WGS84_A (as from Lgm_TraceToSphericalEarth()).
+ *      \param[in]       TargetHeight Footpoint altitude (km).
+ *      \param[in]       sgn         Direction for trace. +1.0 is with the field, -1.0 is against the field.
+ *      \param[in]       tol         Tolerance for converging on footpoint locations.
+ *      \param[out]      sS          Distance along the line from u to vS (Re). Info->Trace_s is the distance to vE.
+ *      \param[in,out]   Info        Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *  \return
+ *          What Lgm_TraceToEarth() would return. vS and sS are only valid if it is 1.
+ *
+ */
+int Lgm_TraceToEarthAndSphere( Lgm_Vector *u, Lgm_Vector *vE, Lgm_Vector *vS, double TargetHeight, double sgn, double tol, double *sS, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector      u_scale, P, w, PaE, PcE, PaS, PcS, Pz;
+    double          Htry, Htry_max, Hdid, Hnext, Hmin, Hmax, s, H0 = -1.0;
+    double          Height, HeightS, FE, FS, FaE, FcE, FaS, FcS, SaE, ScE, SaS, ScS, Sz, Fz, sE;
+    int             done, reset, HaveS, Flag, DenseOutput;
+    Lgm_TraceSeed   Seed;
+    BrentFuncInfoP  f;
+
+    /*
+     *  The awkward starts (inside the Earth, or already below the target
+     *  height) are handled by the single-surface routines.
+     */
+    Height = -1.0;
+    HeightS = WGS84_A*( Lgm_Magnitude( u ) - 1.0 );
+    if ( HeightS > TargetHeight ) {
+        Lgm_Convert_Coords( u, &w, GSM_TO_WGS84, Info->c );
+        Lgm_WGS84_to_GeodHeight( &w, &Height );
+    }
+    if ( ( HeightS <= TargetHeight ) || ( Height <= TargetHeight ) ) {
+        Flag = Lgm_TraceToSphericalEarth( u, vS, TargetHeight, sgn, tol, Info );
+        *sS  = Info->Trace_s;
+        if ( Flag != 1 ) *sS = LGM_FILL_VALUE;
+        Flag = Lgm_TraceToEarth( u, vE, TargetHeight, sgn, tol, Info );
+        return( Flag );
+    }
+
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_EARTH );
+
+    DenseOutput = Info->Lgm_MagStep_DenseOutput;
+    Info->Lgm_MagStep_DenseOutput = TRUE;
+    Lgm_MagStep_ClearDense( Info );
+
+    reset = TRUE;
+    Info->Trace_s = 0.0;
+    u_scale.x = u_scale.y = u_scale.z = 1.0;
+    Hmax = Info->Hmax;
+    Hmin = 0.001;
+
+    P   = *u;
+    PaE = PaS = PcE = PcS = P;
+    SaE = SaS = ScE = ScS = 0.0;
+    FaE = Height - TargetHeight; FaS = HeightS - TargetHeight;
+    FcE = FcS = 0.0;
+    HaveS = FALSE;
+
+    Htry = 0.9*Height;
+    if (Htry > 0.1) Htry = 0.1;
+    if ( Lgm_TraceHistory_Get( LGM_TRACEHIST_TO_EARTH, sgn, 0.0, u, &Seed, Info ) ) {
+        Htry = ( Seed.H0 < Hmax ) ? Seed.H0 : Hmax;
+    }
+
+    /*
+     *  Step down until we are below the target height on the ellipsoid,
+     *  keeping the bracket of the (earlier) crossing of the sphere on the way.
+     */
+    done = FALSE;
+    while ( !done ) {
+
+        Htry = Lgm_TraceSeed_Step( &Seed, SaE, Htry );
+        if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) {
+            *vE = P;
+            Info->Lgm_MagStep_DenseOutput = DenseOutput;
+            if ( !DenseOutput ) Lgm_MagStep_ClearDense( Info );
+            return(-1);
+        }
+        if ( H0 < 0.0 ) H0 = Hnext;
+
+        if (   (P.x > Info->OpenLimit_xMax) || (P.x < Info->OpenLimit_xMin) || (P.y > Info->OpenLimit_yMax) || (P.y < Info->OpenLimit_yMin)
+                || (P.z > Info->OpenLimit_zMax) || (P.z < Info->OpenLimit_zMin) || ( s > 1000.0 ) ) {
+            // Open FL
+            *vE = P;
+            Info->Lgm_MagStep_DenseOutput = DenseOutput;
+            if ( !DenseOutput ) Lgm_MagStep_ClearDense( Info );
+            return(0);
+        }
+
+        Lgm_Convert_Coords( &P, &w, GSM_TO_WGS84, Info->c );
+        Lgm_WGS84_to_GeodHeight( &w, &Height );
+        FE = Height - TargetHeight;
+        FS = seFunc( &P, TargetHeight, Info );
+
+        if ( !HaveS ) {
+            if ( FS < 0.0 ) {
+                PcS = P; FcS = FS; ScS = SaS + Hdid;
+                HaveS = TRUE;
+            } else {
+                PaS = P; FaS = FS; SaS += Hdid;
+            }
+        }
+
+        if ( FE < 0.0 ) {
+            PcE = P; FcE = FE; ScE = SaE + Hdid;
+            done = TRUE;
+        } else {
+            PaE = P; FaE = FE; SaE += Hdid;
+        }
+
+        Htry = Hnext;
+        Htry_max = 0.9*Height;
+        if (Htry > Htry_max)  Htry = Htry_max;
+        if      (Htry < Hmin) Htry = Hmin;
+        else if (Htry > Hmax) Htry = Hmax;
+
+    }
+
+    f.u_scale = u_scale;
+    f.Htry    = Htry;
+    f.sgn     = sgn;
+    f.reset   = reset;
+    f.Info    = Info;
+
+    /*
+     *  Refine both crossings. The brackets start at points we stepped from,
+     *  so Lgm_zBrentP() can use the dense output from there.
+     */
+    f.func = &eeFunc; f.Val = TargetHeight;
+    Lgm_zBrentP( SaE, ScE, FaE, FcE, PaE, PcE, &f, tol, &Sz, &Fz, &Pz );
+    *vE = Pz; sE = Sz;
+
+    if ( HaveS ) {
+        f.func = &seFunc;
+        Lgm_zBrentP( SaS, ScS, FaS, FcS, PaS, PcS, &f, tol, &Sz, &Fz, &Pz );
+        *vS = Pz; *sS = Sz;
+    }
+
+    Info->Lgm_MagStep_DenseOutput = DenseOutput;
+    if ( !DenseOutput ) Lgm_MagStep_ClearDense( Info );
+
+    if ( !HaveS ) {
+        // (only if the geodetic height were below the spherical one somewhere)
+        *sS = ( Lgm_TraceToSphericalEarth( u, vS, TargetHeight, sgn, tol, Info ) == 1 ) ? Info->Trace_s : LGM_FILL_VALUE;
+    }
+
+    Info->Trace_s = sE;
+    Lgm_TraceHistory_Put( LGM_TRACEHIST_TO_EARTH, sgn, 0.0, u, H0, Info->Trace_s, &Seed, Info );
+
+    return( 1 );
+
+}
@@ -0,0 +1,483 @@
+/*! \file Lgm_TraceToEarth_Multi.c
+ *
+ *  \brief Trace many field lines down to the Earth at once.
+ *
+ *  Drift shell construction (and similar scans) needs the footpoints of a
+ *  whole set of independent field lines that all take about the same number
+ *  of steps to reach the Earth. Tracing them one at a time with
+ *  Lgm_TraceToEarth() or Lgm_TraceToSphericalEarth() means one B-field
+ *  evaluation per call to Info->Bfield(), with all of the per-call setup that
+ *  goes with it.
+ *
+ *  The routines here advance all of the lines together ("lanes"), taking one
+ *  Cash-Karp RK5 step attempt per lane per pass (the same tableau used by
+ *  Lgm_RKCK()). Each of the six stages is evaluated for all of the active
+ *  lanes with a single call to Lgm_B_Batch(). Every lane keeps its own step
+ *  size and its own state (bracketing the target height, then bisecting on
+ *  it), and lanes drop out of the batch as soon as they terminate.
+ *
+ *  The return codes and the bracketing logic follow Lgm_TraceToEarth() and
+ *  Lgm_TraceToSphericalEarth(). The differences are:
+ *
+ *      - The integrator is always RK5 (using the Lgm_MagStep_RK5_* settings
+ *        in Info), regardless of Info->Lgm_MagStep_Integrator.
+ *
+ *      - The final convergence is done by bisection in both cases (the
+ *        scalar ellipsoid version uses Brent's method). Both converge to
+ *        within tol along the field line.
+ *
+ *      - Lines that start at or below the target height (which need the
+ *        "climb up first" logic) and the case Info->SavePoints == TRUE are
+ *        handed to the scalar routines.
+ *
+ *  With Info->OffloadDevice set, the lines are traced on that device instead
+ *  when the model allows it (see Lgm_TraceToEarth_Offload() in
+ *  Lgm_B_Offload.c).
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_WGS84.h"
+
+#define FMAX(a,b)  (((a)>(b))?(a):(b))
+#define FMIN(a,b)  (((a)<(b))?(a):(b))
+
+/*
+ *  Lane states
+ */
+#define LGM_TTEM_BRACKET    0   // stepping toward the Earth looking for a bracket
+#define LGM_TTEM_REFINE     1   // have a bracket, bisecting on it
+#define LGM_TTEM_DONE       2   // finished (Flag[] is set)
+
+/*
+ *  Cash-Karp coefficients (see Lgm_RKCK()). The field is autonomous, so the
+ *  a_i (stage "times") are not needed.
+ */
+static const double LgmTtem_b[6][5] = { {  0.0,                     0.0,         0.0,                     0.0,                     0.0            },
+                                        {  0.2,                     0.0,         0.0,                     0.0,                     0.0            },
+                                        {  0.075,                   0.225,       0.0,                     0.0,                     0.0            },
+                                        {  0.3,                    -0.9,         1.2,                     0.0,                     0.0            },
+                                        { -0.20370370370370370370,  2.5,        -2.59259259259259259259,  1.29629629629629629629,  0.0            },
+                                        {  0.02949580439814814814,  0.341796875, 0.04159432870370370370,  0.40034541377314814814,  0.061767578125 } };
+static const double LgmTtem_c[6]    = { 0.09788359788359788359, 0.0, 0.40257648953301127214, 0.21043771043771043771, 0.0, 0.28910220214568040654 };
+static const double LgmTtem_dc[6]   = { -0.00429377480158730159, 0.0, 0.01866858609385783299, -0.03415502683080808080, -0.01932198660714285714, 0.03910220214568040654 };
+
+
+/*
+ *  Height (in km) of P above the spherical Earth (radius WGS84_A) or above
+ *  the WGS84 ellipsoid.
+ */
+static double Lgm_TTEM_Height( Lgm_Vector *P, int Spherical, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector  w;
+    double      Height;
+
+    if ( Spherical ) return( WGS84_A*(Lgm_Magnitude( P )-1.0) );
+
+    Lgm_Convert_Coords( P, &w, GSM_TO_WGS84, Info->c );
+    Lgm_WGS84_to_GeodHeight( &w, &Height );
+
+    return( Height );
+
+}
+
+
+/*
+ *  Evaluate unit B vectors for nAct packed positions. Lanes where |B| is too
+ *  small get Bad[j] = TRUE.
+ */
+static void Lgm_TTEM_Bhat( int nAct, double *x, double *y, double *z, double *bx, double *by, double *bz, int *Bad, Lgm_MagModelInfo *Info ) {
+
+    int     j;
+    double  Bmag;
+
+    Lgm_B_Batch( nAct, x, y, z, bx, by, bz, Info );
+    Info->Lgm_nMagEvals += nAct;
+
+    for ( j=0; j<nAct; ++j ) {
+        Bmag = sqrt( bx[j]*bx[j] + by[j]*by[j] + bz[j]*bz[j] );
+        if ( Bmag < 1e-16 ) {
+            Bad[j] = TRUE;
+            bx[j] = by[j] = bz[j] = 0.0;
+        } else {
+            bx[j] /= Bmag; by[j] /= Bmag; bz[j] /= Bmag;
+        }
+    }
+
+}
+
+
+static int Lgm_TraceToEarth_Lockstep( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int Spherical, int *Flag, double *S, Lgm_MagModelInfo *Info ) {
+
+    int         i, j, l, m, nAct, nNeed, nGood;
+    int         *Act, *Phase, *Count, *nRej, *HaveB0, *Bad;
+    double      *Sa, *Sc, *h, *x, *y, *z, *bx, *by, *bz, *kx[6], *ky[6], *kz[6];
+    double      Hmin, Hmax, Htry, Hdid, Hnext, H, ErrMax, e, F, Height, R;
+    double      yerr[3];
+    Lgm_Vector  *Pa, *Pc, *b0, Q;
+
+
+    /*
+     *  Same step limits as the scalar routines.
+     */
+    Hmax = ( Spherical ) ? 1.0  : Info->Hmax;
+    Hmin = ( Spherical ) ? 1e-8 : 0.001;
+
+
+    LGM_ARRAY_1D( Act,    n, int );
+    LGM_ARRAY_1D( Phase,  n, int );
+    LGM_ARRAY_1D( Count,  n, int );
+    LGM_ARRAY_1D( nRej,   n, int );
+    LGM_ARRAY_1D( HaveB0, n, int );
+    LGM_ARRAY_1D( Bad,    n, int );
+    LGM_ARRAY_1D( Sa, n, double );
+    LGM_ARRAY_1D( Sc, n, double );
+    LGM_ARRAY_1D( h,  n, double );
+    LGM_ARRAY_1D( x,  n, double );
+    LGM_ARRAY_1D( y,  n, double );
+    LGM_ARRAY_1D( z,  n, double );
+    LGM_ARRAY_1D( bx, n, double );
+    LGM_ARRAY_1D( by, n, double );
+    LGM_ARRAY_1D( bz, n, double );
+    for ( l=0; l<6; ++l ) {
+        LGM_ARRAY_1D( kx[l], n, double );
+        LGM_ARRAY_1D( ky[l], n, double );
+        LGM_ARRAY_1D( kz[l], n, double );
+    }
+    LGM_ARRAY_1D( Pa, n, Lgm_Vector );
+    LGM_ARRAY_1D( Pc, n, Lgm_Vector );
+    LGM_ARRAY_1D( b0, n, Lgm_Vector );
+
+
+
+    /*
+     *  Check the starting points.
+     */
+    for ( i=0; i<n; ++i ) {
+
+        Phase[i] = LGM_TTEM_DONE;
+        if ( S ) S[i] = 0.0;
+
+        R = WGS84_A*Lgm_Magnitude( &u[i] ); // km
+        if ( R < WGS84_B ) {
+            v[i] = u[i]; Flag[i] = LGM_INSIDE_EARTH;
+            continue;
+        }
+        Height = Lgm_TTEM_Height( &u[i], FALSE, Info );
+        if ( Height < 0.0 ) {
+            v[i] = u[i]; Flag[i] = LGM_INSIDE_EARTH;
+            continue;
+        }
+        if ( Spherical ) Height = R - WGS84_A;
+
+        if ( Height <= TargetHeight ) {
+
+            /*
+             *  Already at or below the target height. This needs the scalar
+             *  routines' "find the way up first" logic.
+             */
+            Flag[i] = ( Spherical ) ? Lgm_TraceToSphericalEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info )
+                                    : Lgm_TraceToEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info );
+            if ( S ) S[i] = Info->Trace_s;
+            continue;
+
+        }
+
+        Phase[i]  = LGM_TTEM_BRACKET;
+        Pa[i]     = u[i];
+        Sa[i]     = Sc[i] = 0.0;
+        HaveB0[i] = FALSE;
+        Count[i]  = nRej[i] = 0;
+        h[i]      = FMIN( 0.9*Height, ( Spherical ) ? Hmax : 0.1 );
+
+    }
+
+
+
+    while ( 1 ) {
+
+        /*
+         *  Get the tangent at the start of the step for lanes whose start
+         *  point has moved.
+         */
+        for ( nNeed=0, i=0; i<n; ++i ) {
+            if ( (Phase[i] != LGM_TTEM_DONE) && !HaveB0[i] ) {
+                Act[nNeed] = i; Bad[nNeed] = FALSE;
+                x[nNeed] = Pa[i].x; y[nNeed] = Pa[i].y; z[nNeed] = Pa[i].z;
+                ++nNeed;
+            }
+        }
+        if ( nNeed > 0 ) {
+            Lgm_TTEM_Bhat( nNeed, x, y, z, bx, by, bz, Bad, Info );
+            for ( j=0; j<nNeed; ++j ) {
+                i = Act[j];
+                if ( Bad[j] ) {
+                    printf("Lgm_TraceToEarth_Multi(): Bmag too small (u = %g %g %g) (line %d returning with -1).\n", Pa[i].x, Pa[i].y, Pa[i].z, i );
+                    v[i] = Pa[i]; Flag[i] = -1; Phase[i] = LGM_TTEM_DONE;
+                } else {
+                    b0[i].x = bx[j]; b0[i].y = by[j]; b0[i].z = bz[j];
+                    HaveB0[i] = TRUE;
+                }
+            }
+        }
+
+
+        /*
+         *  Pack the active lanes.
+         */
+        for ( nAct=0, i=0; i<n; ++i ) {
+            if ( Phase[i] != LGM_TTEM_DONE ) {
+                Act[nAct] = i; Bad[nAct] = FALSE;
+                kx[0][nAct] = b0[i].x; ky[0][nAct] = b0[i].y; kz[0][nAct] = b0[i].z;
+                ++nAct;
+            }
+        }
+        if ( nAct == 0 ) break;
+
+
+        /*
+         *  Cash-Karp stages 2-6, all lanes at once.
+         */
+        for ( l=1; l<6; ++l ) {
+            for ( j=0; j<nAct; ++j ) {
+                i = Act[j];
+                H = sgn*h[i];
+                x[j] = Pa[i].x; y[j] = Pa[i].y; z[j] = Pa[i].z;
+                for ( m=0; m<l; ++m ) {
+                    x[j] += H*LgmTtem_b[l][m]*kx[m][j];
+                    y[j] += H*LgmTtem_b[l][m]*ky[m][j];
+                    z[j] += H*LgmTtem_b[l][m]*kz[m][j];
+                }
+            }
+            Lgm_TTEM_Bhat( nAct, x, y, z, kx[l], ky[l], kz[l], Bad, Info );
+        }
+
+
+        /*
+         *  Per-lane error control and state update.
+         */
+        for ( j=0; j<nAct; ++j ) {
+
+            i = Act[j];
+
+            if ( Bad[j] ) {
+                printf("Lgm_TraceToEarth_Multi(): Bmag too small during cash-karp phase (line %d returning with -1).\n", i );
+                v[i] = Pa[i]; Flag[i] = -1; Phase[i] = LGM_TTEM_DONE;
+                continue;
+            }
+
+            H   = sgn*h[i];
+            Q   = Pa[i];
+            yerr[0] = yerr[1] = yerr[2] = 0.0;
+            for ( l=0; l<6; ++l ) {
+                Q.x += H*LgmTtem_c[l]*kx[l][j]; yerr[0] += H*LgmTtem_dc[l]*kx[l][j];
+                Q.y += H*LgmTtem_c[l]*ky[l][j]; yerr[1] += H*LgmTtem_dc[l]*ky[l][j];
+                Q.z += H*LgmTtem_c[l]*kz[l][j]; yerr[2] += H*LgmTtem_dc[l]*kz[l][j];
+            }
+            ErrMax = sqrt( yerr[0]*yerr[0] + yerr[1]*yerr[1] + yerr[2]*yerr[2] )/Info->Lgm_MagStep_RK5_Eps;
+
+            if ( ErrMax > 1.0 ) {
+
+                /*
+                 *  Reject. Shrink this lane's step and retry on the next pass.
+                 */
+                e    = Info->Lgm_MagStep_RK5_Safety*h[i]*pow( ErrMax, Info->Lgm_MagStep_RK5_pShrnk );
+                h[i] = FMAX( e, 0.1*h[i] );
+                LGM_STATS_COUNT( Info, RK5_Rejected );
+                if ( ( Sa[i] + h[i] == Sa[i] ) || ( ++nRej[i] > Info->Lgm_MagStep_RK5_MaxCount ) ) {
+                    printf("Lgm_TraceToEarth_Multi(): Stepsize underflow (line %d returning with -1). h = %g\n", i, h[i] );
+                    v[i] = Pa[i]; Flag[i] = -1; Phase[i] = LGM_TTEM_DONE;
+                }
+                continue;
+
+            }
+
+            /*
+             *  Accept.
+             */
+            LGM_STATS_COUNT( Info, RK5_Accepted );
+            nRej[i] = 0;
+            Hdid    = h[i];
+            Hnext   = ( ErrMax > Info->Lgm_MagStep_RK5_ErrCon ) ? Info->Lgm_MagStep_RK5_Safety*Hdid*pow( ErrMax, Info->Lgm_MagStep_RK5_pGrow ) : 5.0*Hdid;
+            Height  = Lgm_TTEM_Height( &Q, Spherical, Info );
+            F       = Height - TargetHeight;
+
+            if ( Phase[i] == LGM_TTEM_BRACKET ) {
+
+                if (   (Q.x > Info->OpenLimit_xMax) || (Q.x < Info->OpenLimit_xMin) || (Q.y > Info->OpenLimit_yMax) || (Q.y < Info->OpenLimit_yMin)
+                    || (Q.z > Info->OpenLimit_zMax) || (Q.z < Info->OpenLimit_zMin) || ( Sa[i]+Hdid > 1000.0 ) ) {
+                    /*
+                     *  Open FL!
+                     */
+                    if ( Spherical ) { v[i].x = v[i].y = v[i].z = 0.0; } else { v[i] = Q; }
+                    Flag[i] = 0; Phase[i] = LGM_TTEM_DONE;
+                    continue;
+                } else if ( F < 0.0 ) {
+                    Pc[i] = Q; Sc[i] = Sa[i] + Hdid;
+                    Phase[i] = LGM_TTEM_REFINE; // Pa (and its tangent) stay put
+                } else {
+                    Pa[i] = Q; Sa[i] += Hdid; HaveB0[i] = FALSE;
+                    Htry = FMIN( Hnext, 0.9*Height );
+                    if      ( Htry < Hmin ) Htry = Hmin;
+                    else if ( Htry > Hmax ) Htry = Hmax;
+                    h[i] = Htry;
+                }
+
+                if ( Spherical && ( ++Count[i] > 1000 ) ) {
+                    printf("File: %s Lgm_TraceToEarth_Multi(), Line: %d; Too many iterations trying to reach target height for line %d (are we in a weird field region?) Returning with -1.\n", __FILE__, __LINE__, i );
+                    v[i] = Pa[i]; Flag[i] = -1; Phase[i] = LGM_TTEM_DONE;
+                    continue;
+                }
+
+            } else {
+
+                if ( F >= 0.0 ) {
+                    Pa[i] = Q; Sa[i] += Hdid; HaveB0[i] = FALSE;
+                } else {
+                    Pc[i] = Q; Sc[i] = Sa[i] + Hdid;
+                }
+
+            }
+
+            if ( Phase[i] == LGM_TTEM_REFINE ) {
+                if ( fabs( Sc[i] - Sa[i] ) < tol ) {
+                    /*
+                     *  Converged. Take average as the final answer.
+                     */
+                    v[i].x = 0.5*(Pa[i].x + Pc[i].x); v[i].y = 0.5*(Pa[i].y + Pc[i].y); v[i].z = 0.5*(Pa[i].z + Pc[i].z);
+                    if ( S ) S[i] = 0.5*(Sa[i] + Sc[i]);
+                    Flag[i]  = 1;
+                    Phase[i] = LGM_TTEM_DONE;
+                } else {
+                    h[i] = 0.5*fabs( Sc[i] - Sa[i] );
+                }
+            }
+
+        }
+
+    }
+
+    for ( nGood=0, i=0; i<n; ++i ) if ( Flag[i] == 1 ) ++nGood;
+
+
+
+    LGM_ARRAY_1D_FREE( Act );
+    LGM_ARRAY_1D_FREE( Phase );
+    LGM_ARRAY_1D_FREE( Count );
+    LGM_ARRAY_1D_FREE( nRej );
+    LGM_ARRAY_1D_FREE( HaveB0 );
+    LGM_ARRAY_1D_FREE( Bad );
+    LGM_ARRAY_1D_FREE( Sa );
+    LGM_ARRAY_1D_FREE( Sc );
+    LGM_ARRAY_1D_FREE( h );
+    LGM_ARRAY_1D_FREE( x );
+    LGM_ARRAY_1D_FREE( y );
+    LGM_ARRAY_1D_FREE( z );
+    LGM_ARRAY_1D_FREE( bx );
+    LGM_ARRAY_1D_FREE( by );
+    LGM_ARRAY_1D_FREE( bz );
+    for ( l=0; l<6; ++l ) {
+        LGM_ARRAY_1D_FREE( kx[l] );
+        LGM_ARRAY_1D_FREE( ky[l] );
+        LGM_ARRAY_1D_FREE( kz[l] );
+    }
+    LGM_ARRAY_1D_FREE( Pa );
+    LGM_ARRAY_1D_FREE( Pc );
+    LGM_ARRAY_1D_FREE( b0 );
+
+    return( nGood );
+
+}
+
+
+
+
+/**
+ *  \brief
+ *      Trace a set of field lines to the Earth (WGS84 ellipsoid) all at once.
+ *
+ *  \detail
+ *      This is the multi-line version of Lgm_TraceToEarth(). All n lines are
+ *      advanced together, and the B-field is evaluated for all of them with
+ *      one call to Lgm_B_Batch() per RK stage. Each line gets the same
+ *      return code Lgm_TraceToEarth() would have given it.
+ *
+ *      Lines that reach the target height do not need to take the same
+ *      number of steps; finished lines simply drop out of the batch.
+ *
+ *      \param[in]       n           Number of field lines.
+ *      \param[in]       u           Array of n starting positions in GSM coordinates.
+ *      \param[out]      v           Array of n final points. These will be the footpoints for the lines that are closed in the direction of tracing. Otherwise they are where we detected the FL was open.
+ *      \param[in]      TargetHeight The altitude (in km) above the WGS84 ellispoid (i.e. geodetic height) used to define what we mean by the footpoint altitude.
+ *      \param[in]      sgn          Direction for trace. +1.0 is with the field, -1.0 is against the field.
+ *      \param[in]      tol          Tolerance for converging on footpoint location.
+ *      \param[out]     Flag         Array of n return codes (as returned by Lgm_TraceToEarth()).
+ *      \param[out]     S            Array of n distances (in Re) along the FL from u[i] to v[i] (i.e. what Lgm_TraceToEarth() leaves in Info->Trace_s). May be NULL.
+ *      \param[in,out]  Info         Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *  \return         The number of lines for which Flag[i] is 1.
+ *
+ */
+int Lgm_TraceToEarth_Multi( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int *Flag, double *S, Lgm_MagModelInfo *Info ) {
+
+    int i, nGood;
+
+    if ( n < 1 ) return( 0 );
+
+    if ( Info->SavePoints ) {
+        for ( nGood=0, i=0; i<n; ++i ) {
+            if ( (Flag[i] = Lgm_TraceToEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info )) == 1 ) ++nGood;
+            if ( S ) S[i] = Info->Trace_s;
+        }
+        return( nGood );
+    }
+
+    if ( ( Info->OffloadDevice != LGM_OFFLOAD_NONE ) && ( ( nGood = Lgm_TraceToEarth_Offload( n, u, v, TargetHeight, sgn, tol, FALSE, Flag, S, Info ) ) >= 0 ) ) return( nGood );
+
+    return( Lgm_TraceToEarth_Lockstep( n, u, v, TargetHeight, sgn, tol, FALSE, Flag, S, Info ) );
+
+}
+
+
+/**
+ *  \brief
+ *      Trace a set of field lines to the spherical Earth (radius WGS84_A) all at once.
+ *
+ *  \detail
+ *      This is the multi-line version of Lgm_TraceToSphericalEarth(). See
+ *      Lgm_TraceToEarth_Multi() for details.
+ *
+ *      \param[in]       n           Number of field lines.
+ *      \param[in]       u           Array of n starting positions in GSM coordinates.
+ *      \param[out]      v           Array of n final points (zero for lines found to be open).
+ *      \param[in]      TargetHeight The altitude (in km) above the spherical Earth used to define what we mean by the footpoint altitude.
+ *      \param[in]      sgn          Direction for trace. +1.0 is with the field, -1.0 is against the field.
+ *      \param[in]      tol          Tolerance for converging on footpoint location.
+ *      \param[out]     Flag         Array of n return codes (as returned by Lgm_TraceToSphericalEarth()).
+ *      \param[out]     S            Array of n distances (in Re) along the FL from u[i] to v[i]. May be NULL.
+ *      \param[in,out]  Info         Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *  \return         The number of lines for which Flag[i] is 1.
+ *
+ */
+int Lgm_TraceToSphericalEarth_Multi( int n, Lgm_Vector *u, Lgm_Vector *v, double TargetHeight, double sgn, double tol, int *Flag, double *S, Lgm_MagModelInfo *Info ) {
+
+    int i, nGood;
+
+    if ( n < 1 ) return( 0 );
+
+    if ( Info->SavePoints ) {
+        for ( nGood=0, i=0; i<n; ++i ) {
+            if ( (Flag[i] = Lgm_TraceToSphericalEarth( &u[i], &v[i], TargetHeight, sgn, tol, Info )) == 1 ) ++nGood;
+            if ( S ) S[i] = Info->Trace_s;
+        }
+        return( nGood );
+    }
+
+    if ( ( Info->OffloadDevice != LGM_OFFLOAD_NONE ) && ( ( nGood = Lgm_TraceToEarth_Offload( n, u, v, TargetHeight, sgn, tol, TRUE, Flag, S, Info ) ) >= 0 ) ) return( nGood );
+
+    return( Lgm_TraceToEarth_Lockstep( n, u, v, TargetHeight, sgn, tol, TRUE, Flag, S, Info ) );
+
+}
@@ -26,6 +26,9 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include "Lgm/Lgm_MagModelInfo.h"
@@ -34,12 +37,15 @@ int Lgm_TraceToMinBSurf( Lgm_Vector *u, Lgm_Vector *v, double Htry, double tol,
 
     Lgm_Vector	u_scale;
     double	    Htry_max, Hdid, Hnext, Hmin, Hmax, s=0.0, sgn, r2;
-    double	    Sa, Sb, Sc, d1, d2;
+    double	    Sa, Sb, Sc, d1, d2, S0;
     double	    Ba, Bb, Bc, B, B2, R;
     Lgm_Vector	Btmp;
-    Lgm_Vector	Pa, Pb, Pc, P, P2;
+    Lgm_Vector	Pa, Pb, Pc, P, P2, P0;
     int		    done, reset=TRUE;
     double s2 = 0.0;
+    double      H0 = -1.0;
+    Lgm_TraceSeed   Seed;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_MINB );
 
 
 
@@ -142,6 +148,15 @@ int Lgm_TraceToMinBSurf( Lgm_Vector *u, Lgm_Vector *v, double Htry, double tol,
 
 //printf("B = %g %g %g   done = %d\n", Ba, Bb, Bc, done);
 
+    /*
+     *  Now that we know which way to go, see if the trace history (if any)
+     *  can give us a better step size and a narrow bracket to try.
+     */
+    Seed.Valid = FALSE;
+    if ( !done && Lgm_TraceHistory_Get( LGM_TRACEHIST_TO_MINB, sgn, 0.0, u, &Seed, Info ) ) {
+        Htry = ( Seed.H0 < Hmax ) ? Seed.H0 : Hmax;
+    }
+
 
 
 
@@ -155,7 +170,9 @@ int Lgm_TraceToMinBSurf( Lgm_Vector *u, Lgm_Vector *v, double Htry, double tol,
     while (!done) {
 
 	    P = Pb;
+        Htry = Lgm_TraceSeed_Step( &Seed, Sb, Htry );   // land on the seeded bracket (if any)
         if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+        if ( H0 < 0.0 ) H0 = Hnext;
         Info->Bfield( &P, &Btmp, Info );
         B = Lgm_Magnitude( &Btmp );
 
@@ -209,6 +226,7 @@ int Lgm_TraceToMinBSurf( Lgm_Vector *u, Lgm_Vector *v, double Htry, double tol,
 if (1==1){
     done = FALSE;
 //reset=TRUE;
+    P0 = Pa; S0 = Sa;   // start of the bracket (for dense output)
     while (!done) {
 
 	    d1 = Sb - Sa;
@@ -222,7 +240,9 @@ if (1==1){
 	        //P = Pa; Htry = 0.381966011*d1;
 	        P = Pa; Htry = 0.5*d1;
 //printf("A. Sa, Sb, Sc = %g %g %g   d1, d2 = %g %g Htry = %g tol = %g Sc-Sa = %g\n", Sa, Sb, Sc, d1, d2, Htry, tol, Sc-Sa);
-            if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+            if ( Lgm_MagStep_DenseEval( &P0, Sa+Htry-S0, sgn, &P, Info ) ) {
+                Hdid = Htry;   // got P from the bracketing steps without stepping
+            } else if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
             Info->Bfield( &P, &Btmp, Info );
             B = Lgm_Magnitude( &Btmp );
 //printf("A. B = %g\n", B);
@@ -239,7 +259,9 @@ if (1==1){
 	        //P = Pb; Htry = 0.381966011*d2;
 	        P = Pb; Htry = 0.5*d2;
 //printf("B. Sa, Sb, Sc = %g %g %g   d1, d2 = %g %g Htry = %g tol = %g Sc-Sa = %g\n", Sa, Sb, Sc, d1, d2, Htry, tol, Sc-Sa);
-            if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+            if ( Lgm_MagStep_DenseEval( &P0, Sb+Htry-S0, sgn, &P, Info ) ) {
+                Hdid = Htry;
+            } else if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
             Info->Bfield( &P, &Btmp, Info );
             B = Lgm_Magnitude( &Btmp );
 //printf("B. P = %g %g %g B = %g\n", P.x, P.y, P.z, B);
@@ -292,6 +314,8 @@ if (0==1){
     //Info->Trace_s = Sb*sgn;
     Info->Trace_s = -Sb*sgn;
 
+    Lgm_TraceHistory_Put( LGM_TRACEHIST_TO_MINB, sgn, 0.0, u, H0, Sb, &Seed, Info );
+
     if ( Info->VerbosityLevel > 2 ) printf("TraceToMinBSurf(): Number of Bfield evaluations = %ld\n", Info->Lgm_nMagEvals );
 
     return( 1 );
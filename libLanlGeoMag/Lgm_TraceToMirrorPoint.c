@@ -62,12 +62,15 @@ int Lgm_TraceToMirrorPoint( Lgm_Vector *u, Lgm_Vector *v, double *Sm, double Bm,
 
     Lgm_Vector	u_scale;
     double	    Htry, Hdid, Hnext, Hmin, Hmax, s;
-    double	    Sa=0.0, Sb=0.0, Smin, d;
+    double	    Sa=0.0, Sb=0.0, Smin, d, S0;
     double	    Rlc, R, Fa, Fb, F, Fmin, B, Fs, Fn;
     double	    Ra, Rb, Height;
-    Lgm_Vector	w, Pa, Pb, P, Bvec, Pmin;
+    Lgm_Vector	w, Pa, Pb, P, Bvec, Pmin, P0;
     int		    done, FoundBracket, reset, nIts, nSteps;
     double      MinValidHeight;
+    double      H0 = -1.0;
+    Lgm_TraceSeed   Seed;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_MIRROR );
 
     reset = TRUE;
     Fmin = 9e99;
@@ -229,6 +232,12 @@ int Lgm_TraceToMirrorPoint( Lgm_Vector *u, Lgm_Vector *v, double *Sm, double Bm,
     Htry = 0.25;
     P    = Pa;
 
+    /*
+     *  If we have a trace history, start with the step size that worked last
+     *  time and try a narrow bracket around where the mirror point was.
+     */
+    if ( Lgm_TraceHistory_Get( LGM_TRACEHIST_TO_MIRROR, sgn, Bm, u, &Seed, Info ) ) Htry = Seed.H0;
+
     /*
      *  To begin with, B - Bm will be negative (we wouldnt be here otherwise). So all we need to do is
      *  trace along the F.L. until B - Bm changes sign. That will give us the far side of the bracket.
@@ -248,8 +257,10 @@ int Lgm_TraceToMirrorPoint( Lgm_Vector *u, Lgm_Vector *v, double *Sm, double Bm,
          *  If user doesnt want large steps, limit Htry ...
          */
         if (Htry > Hmax) Htry = Hmax;
+        Htry = Lgm_TraceSeed_Step( &Seed, Sa, Htry );   // land on the seeded bracket (if any)
 
         if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+        if ( H0 < 0.0 ) H0 = Hnext;
 
 
         /*
@@ -393,6 +404,7 @@ if (Htry < 0.01) Htry = 0.01;
     if (1==1){
         done  = FALSE;
         //reset = TRUE;
+        P0 = Pa; S0 = Sa;   // start of the bracket (for dense output)
         if ( Info->VerbosityLevel > 4 ) nIts = 0;
         while (!done) {
 
@@ -408,7 +420,9 @@ if (Htry < 0.01) Htry = 0.01;
 
                 //P = Pa; Htry = 0.5*d;
                 P = Pa; Htry = LGM_1_OVER_GOLD*d;
-                if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+                if ( Lgm_MagStep_DenseEval( &P0, Sa+Htry-S0, sgn, &P, Info ) ) {
+                    Hdid = Htry;   // got P from the bracketing step(s) without stepping
+                } else if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
                 Info->Bfield( &P, &Bvec, Info );
                 F = Lgm_Magnitude( &Bvec ) - Bm;
                 if ( F >= 0.0 ) {
@@ -499,9 +513,212 @@ tol = 1e-10;
         printf( "**************** End Detailed Output From TraceToMirrorPoint (VerbosityLevel = %d) ******************\n\n\n", Info->VerbosityLevel );
     }
 
+    Lgm_TraceHistory_Put( LGM_TRACEHIST_TO_MIRROR, sgn, Bm, u, H0, *Sm, &Seed, Info );
+
     if ( Info->VerbosityLevel > 2 ) printf("Lgm_TraceToMirrorPoint(): Number of Bfield evaluations = %ld\n", Info->Lgm_nMagEvals );
 
     return( 1 );
 
 }
 
+
+
+
+
+
+/*
+ *  One direction of Lgm_TraceToMirrorPoints(). The Bm values are visited in
+ *  ascending order (Bm[idx[0]] <= Bm[idx[1]] <= ...). Returns the number
+ *  found.
+ */
+static int Lgm_TraceToMirrorPoints_Dir( Lgm_Vector *u, int n, double *Bm, int *idx, double sgn, double *Sm, Lgm_Vector *Pm, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector	u_scale, Pw, Pw_prev, P, Pa, Pb, Bvec, w;
+    double      Htry, Hdid, Hnext, Hnext_w, Hmax, s, d, tol, Sw, Sw_prev, Sa, Sb, Bw, F, Height, R, Rvalidmin, MinValidHeight;
+    int         j, k, nFound, reset, nSteps;
+
+    tol = Info->Lgm_TraceToMirrorPoint_Tol;
+    MinValidHeight = ( Info->Lgm_LossConeHeight < 0.0 ) ? Info->Lgm_LossConeHeight : 0.0;
+    Rvalidmin = 1.0 + MinValidHeight/Re;
+    u_scale.x = u_scale.y = u_scale.z = 1.0;
+    reset  = TRUE;
+    nFound = 0;
+
+    for ( k=0; k<n; k++ ) Sm[k] = LGM_FILL_VALUE;
+
+
+    /*
+     *  Bm's at or below B(u) mirror right at the start point.
+     */
+    Info->Bfield( u, &Bvec, Info );
+    Bw = Lgm_Magnitude( &Bvec );
+    for ( j=0; (j<n) && (Bm[idx[j]] <= Bw); j++ ) {
+        Pm[idx[j]] = *u;
+        Sm[idx[j]] = 0.0;
+        ++nFound;
+    }
+
+
+    /*
+     *  Walk along the FL the same way Lgm_TraceToMirrorPoint() does when it
+     *  is looking for a bracket. Each time |B| goes past one or more of the
+     *  remaining Bm's, refine each of them inside the step just taken and
+     *  then carry on walking.
+     */
+    Hmax   = 0.5;
+    Htry   = 0.25;
+    Pw     = *u;
+    Sw     = 0.0;
+    nSteps = 0;
+    while ( j < n ) {
+
+        Pw_prev = Pw; Sw_prev = Sw;
+        if ( Htry > Hmax ) Htry = Hmax;
+        if ( Lgm_MagStep( &Pw, &u_scale, Htry, &Hdid, &Hnext_w, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) break;
+        Sw += Hdid;
+
+        Info->Bfield( &Pw, &Bvec, Info );
+        Bw = Lgm_Magnitude( &Bvec );
+        R  = Lgm_Magnitude( &Pw );
+        Lgm_Convert_Coords( &Pw, &w, GSM_TO_WGS84, Info->c );
+        Lgm_WGS84_to_GeodHeight( &w, &Height );
+
+        if (   (Pw.x > Info->OpenLimit_xMax) || (Pw.x < Info->OpenLimit_xMin) || (Pw.y > Info->OpenLimit_yMax) || (Pw.y < Info->OpenLimit_yMin)
+                || (Pw.z > Info->OpenLimit_zMax) || (Pw.z < Info->OpenLimit_zMin) || ( Sw > 300.0 ) ) {
+            break;  // open FL
+        }
+
+        for ( ; (j<n) && (Bm[idx[j]] < Bw); j++ ) {
+
+            /*
+             *  Bm[idx[j]] is crossed between Pw_prev and Pw. Close in on it
+             *  the same way Lgm_TraceToMirrorPoint() does.
+             */
+            Pa = Pw_prev; Sa = Sw_prev;
+            Pb = Pw;      Sb = Sw;
+            while ( fabs( Sb - Sa ) >= tol ) {
+                d = Sb - Sa;
+                P = Pa; Htry = LGM_1_OVER_GOLD*d;
+                if ( Lgm_MagStep_DenseEval( &Pw_prev, Sa+Htry-Sw_prev, sgn, &P, Info ) ) {
+                    Hdid = Htry;   // got P from the walk's step without stepping
+                } else if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) {
+                    break;
+                }
+                Info->Bfield( &P, &Bvec, Info );
+                F = Lgm_Magnitude( &Bvec ) - Bm[idx[j]];
+                if ( F >= 0.0 ) {
+                    Pb = P; Sb = Sa + Hdid;
+                } else {
+                    Pa = P; Sa += Hdid;
+                }
+            }
+
+            /*
+             *  Same loss cone test as Lgm_TraceToMirrorPoint().
+             */
+            Lgm_Convert_Coords( &Pb, &w, GSM_TO_WGS84, Info->c );
+            Lgm_WGS84_to_GeodHeight( &w, &Height );
+            if ( Height >= LC_TOL*Info->Lgm_LossConeHeight ) {
+                Pm[idx[j]] = Pb;
+                Sm[idx[j]] = Sb;
+                ++nFound;
+            }
+
+        }
+
+        /*
+         *  Below the surface of the Earth, the rest are all in the loss cone.
+         *  Otherwise set Htry adaptively (as in Lgm_TraceToMirrorPoint()).
+         */
+        Lgm_Convert_Coords( &Pw, &w, GSM_TO_WGS84, Info->c );
+        Lgm_WGS84_to_GeodHeight( &w, &Height );
+        if ( Height < MinValidHeight ) break;
+
+        Htry = Hnext_w;
+        if ( Htry > 0.1 ) Htry = 0.1;
+        if ( Htry > (R-Rvalidmin) ) Htry = 0.95*(R-Rvalidmin);
+        if ( Htry < 0.01 ) Htry = 0.01;
+
+        if ( ++nSteps > 1000 ) break;
+
+    }
+
+    return( nFound );
+
+}
+
+
+/**
+ *  \brief
+ *      Find the mirror points for several values of Bm at once.
+ *
+ *  \details
+ *      Lgm_TraceToMirrorPoint() finds a single mirror point per call, so
+ *      getting both mirror points for n pitch angles traces the same field
+ *      line 2n times. This routine walks the field line once in each
+ *      direction from u and, as |B| passes each of the requested Bm values,
+ *      refines that mirror point inside the step just taken. It is meant to
+ *      be started at (or near) the min-B point; a Bm that is at or below
+ *      |B(u)| gets u itself as its mirror point.
+ *
+ *      The tolerance used is Info->Lgm_TraceToMirrorPoint_Tol. Mirror points
+ *      that are in the loss cone (or are not found because the line is open,
+ *      etc.) get Sm_s[i] (or Sm_n[i]) set to LGM_FILL_VALUE.
+ *
+ *      \param[in]      u       Start point (GSM). Normally the min-B point.
+ *      \param[in]      n       Number of Bm values.
+ *      \param[in]      Bm      Mirror field strengths (nT). Any order.
+ *      \param[out]     Sm_s    Distance along the FL from u to the southern mirror point of each Bm (Re).
+ *      \param[out]     Sm_n    Distance along the FL from u to the northern mirror point of each Bm (Re).
+ *      \param[out]     Pm_s    Southern mirror points (GSM).
+ *      \param[out]     Pm_n    Northern mirror points (GSM).
+ *      \param[in,out]  Info    Properly initialized/configured Lgm_MagModelInfo structure.
+ *
+ *      \return The number of Bm values for which both mirror points were found.
+ *
+ */
+int Lgm_TraceToMirrorPoints( Lgm_Vector *u, int n, double *Bm, double *Sm_s, double *Sm_n, Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, Lgm_MagModelInfo *Info ) {
+
+    int     i, j, t, *idx, nBoth, DenseOutput;
+    double  DenseTol;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_MIRROR );
+
+    if ( n <= 0 ) return( 0 );
+
+    /*
+     *  Sort (indices of) the Bm's into ascending order.
+     */
+    idx = (int *)calloc( n, sizeof(int) );
+    for ( i=0; i<n; i++ ) idx[i] = i;
+    for ( i=1; i<n; i++ ) {
+        t = idx[i];
+        for ( j=i-1; (j>=0) && (Bm[idx[j]] > Bm[t]); j-- ) idx[j+1] = idx[j];
+        idx[j+1] = t;
+    }
+
+    /*
+     *  The walk's steps are what the refinement interpolates in, so keep
+     *  dense output on while we are in here. Interpolated points are only
+     *  used if they are good to 100*Lgm_TraceToMirrorPoint_Tol (the default
+     *  DenseTol is too loose for mirror points); the rest are re-stepped.
+     */
+    DenseOutput = Info->Lgm_MagStep_DenseOutput;
+    DenseTol    = Info->Lgm_MagStep_DenseTol;
+    Info->Lgm_MagStep_DenseOutput = TRUE;
+    if ( 100.0*Info->Lgm_TraceToMirrorPoint_Tol < DenseTol ) Info->Lgm_MagStep_DenseTol = 100.0*Info->Lgm_TraceToMirrorPoint_Tol;
+
+    Lgm_TraceToMirrorPoints_Dir( u, n, Bm, idx, -1.0, Sm_s, Pm_s, Info );
+    Lgm_TraceToMirrorPoints_Dir( u, n, Bm, idx,  1.0, Sm_n, Pm_n, Info );
+
+    Info->Lgm_MagStep_DenseOutput = DenseOutput;
+    Info->Lgm_MagStep_DenseTol    = DenseTol;
+
+    for ( nBoth=0, i=0; i<n; i++ ) {
+        if ( ( Sm_s[i] != LGM_FILL_VALUE ) && ( Sm_n[i] != LGM_FILL_VALUE ) ) ++nBoth;
+    }
+
+    free( idx );
+
+    return( nBoth );
+
+}
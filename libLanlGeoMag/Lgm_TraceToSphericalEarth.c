@@ -34,6 +34,9 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include "Lgm/Lgm_MagModelInfo.h"
@@ -64,6 +67,7 @@ int Lgm_TraceToSphericalEarth( Lgm_Vector *u, Lgm_Vector *v, double TargetHeight
     double	    Height_a, Height_b, Height_c, HeightPlus, HeightMinus, direction;
     Lgm_Vector	Pa, Pc, P;
     int		    done, reset, AboveTargetHeight, Count;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_TO_SPHERICAL );
 
     reset = TRUE;
     Info->Trace_s = 0.0;
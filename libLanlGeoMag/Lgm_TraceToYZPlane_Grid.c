@@ -0,0 +1,156 @@
+/*! \file Lgm_TraceToYZPlane_Grid.c
+ *
+ *  \brief Map a whole grid of start points to a YZ plane (e.g. into the tail).
+ *
+ *  Mapping an auroral image or a ground station grid into the tail current
+ *  sheet means one Lgm_TraceToYZPlane() per pixel, i.e. 10^5 to 10^6 traces
+ *  a frame. Lgm_TraceToYZPlane_Grid() does the rows in parallel (one
+ *  Lgm_NewMagContext() per thread) and goes along each row in order, so that
+ *  every trace can be warm started from the one before it. The arc length
+ *  to the plane changes smoothly from one pixel to the next, so it is
+ *  predicted from the previous one or two pixels in the row and handed to
+ *  Lgm_TraceToYZPlane_Seeded(). The bracketing steps then land either side
+ *  of the prediction and the bisection starts out from a bracket of width
+ *  ~2*Width instead of the full (~L Re) step. A bad prediction only costs
+ *  the steps it saved.
+ *
+ *  With Interp set, cells that didnt map but whose left and right, or upper
+ *  and lower, neighbours both did are filled in with the average of those
+ *  neighbours and get Flag = LGM_YZPLANE_INTERPOLATED. These are usually
+ *  isolated failures (step size trouble, over-long lines) inside a mapped
+ *  region; a run of two or more failed cells is left alone.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#if USE_OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Lgm/Lgm_MagModelInfo.h"
+
+#define LGM_YZGRID_MIN_WIDTH    0.05    // Smallest half width (Re) of the seeded bracket
+
+
+/*
+ *  Predicted arc length for cell (i, j) from the cells already done in row
+ *  i. (Other rows may be in progress on other threads, so they arent used.)
+ */
+static void Lgm_YZGrid_Seed( int i, int j, int nCols, int *Flag, double *S, Lgm_TraceSeed *Seed ) {
+
+    long int    k = (long int)i*nCols + j;
+    double      d;
+
+    Seed->Valid = FALSE;
+    Seed->H0    = 0.0;
+
+    if ( ( j > 0 ) && ( Flag[k-1] == 1 ) ) {
+        Seed->Valid = TRUE;
+        Seed->S     = S[k-1];
+        Seed->Width = LGM_YZGRID_MIN_WIDTH;
+        if ( ( j > 1 ) && ( Flag[k-2] == 1 ) ) {
+            d = S[k-1] - S[k-2];
+            Seed->S    += d;                // linear extrapolation along the row
+            if ( fabs( d ) > Seed->Width ) Seed->Width = fabs( d );
+        }
+    }
+
+}
+
+
+/**
+ *  \brief
+ *      Map a grid of start points to the plane x = Xtarget.
+ *
+ *  \detail
+ *      Each point is traced as by Lgm_TraceToYZPlane(), warm started from its
+ *      row neighbours (see above). Rows are done in parallel.
+ *
+ *      \param[in]      nRows, nCols Size of the grid.
+ *      \param[in]      u            Start points (GSM), u[i*nCols+j] for row i, column j. Neighbouring cells should be neighbouring points.
+ *      \param[out]     v            Mapped points (GSM), laid out like u. Only meaningful where Flag is 1 or LGM_YZPLANE_INTERPOLATED.
+ *      \param[in]      Xtarget      X (GSM, Re) of the target plane.
+ *      \param[in]      sgn          Direction for trace. +1.0 is with the field, -1.0 is against the field.
+ *      \param[in]      tol          Tolerance in x.
+ *      \param[in]      Interp       If TRUE, fill in isolated unmapped cells from their neighbours.
+ *      \param[out]     Flag         What Lgm_TraceToYZPlane() returned for each cell (1 mapped, 0 open or too long, -1 failed or hit the Earth), or LGM_YZPLANE_INTERPOLATED.
+ *      \param[in,out]  Info         Properly initialized/configured Lgm_MagModelInfo structure (used as a template for the per-thread copies).
+ *
+ *  \return         The number of cells with Flag = 1.
+ *
+ */
+int Lgm_TraceToYZPlane_Grid( int nRows, int nCols, Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn, double tol, int Interp, int *Flag, Lgm_MagModelInfo *Info ) {
+
+    int                 i, j, nGood, n;
+    long int            k, N;
+    double              *S;
+    Lgm_TraceSeed       Seed;
+    Lgm_MagModelInfo    *m2;
+    Lgm_Vector          w;
+
+    if ( ( nRows < 1 ) || ( nCols < 1 ) ) return( 0 );
+
+    N = (long int)nRows*nCols;
+    LGM_ARRAY_1D( S, N, double );
+
+    #if USE_OPENMP
+    #pragma omp parallel private(m2,i,j,k,Seed)
+    #endif
+    {
+        m2 = Lgm_NewMagContext( Info );
+        #if USE_OPENMP
+        #pragma omp for schedule(dynamic, 1)
+        #endif
+        for ( i=0; i<nRows; i++ ) {
+            for ( j=0; j<nCols; j++ ) {
+                k = (long int)i*nCols + j;
+                Lgm_YZGrid_Seed( i, j, nCols, Flag, S, &Seed );
+                Flag[k] = Lgm_TraceToYZPlane_Seeded( &u[k], &v[k], Xtarget, sgn, tol, &Seed, &S[k], m2 );
+            }
+        }
+        #if USE_OPENMP
+        #pragma omp critical (Lgm_TraceToYZPlane_Grid)
+        #endif
+        {
+            Info->Lgm_nMagEvals += m2->Lgm_nMagEvals;
+            Lgm_MagModelInfo_AddStats( Info, m2 );
+        }
+        Lgm_FreeMagInfo( m2 );
+    }
+
+    for ( nGood=0, k=0; k<N; k++ ) if ( Flag[k] == 1 ) ++nGood;
+
+
+    /*
+     *  Fill in isolated holes. Only cells that were actually traced are used,
+     *  so the result doesnt depend on the order.
+     */
+    if ( Interp ) {
+        for ( i=0; i<nRows; i++ ) {
+            for ( j=0; j<nCols; j++ ) {
+                k = (long int)i*nCols + j;
+                if ( Flag[k] == 1 ) continue;
+                w.x = w.y = w.z = 0.0; n = 0;
+                if ( ( j > 0 ) && ( j < nCols-1 ) && ( Flag[k-1] == 1 ) && ( Flag[k+1] == 1 ) ) {
+                    w.x += v[k-1].x + v[k+1].x; w.y += v[k-1].y + v[k+1].y; w.z += v[k-1].z + v[k+1].z;
+                    n += 2;
+                }
+                if ( ( i > 0 ) && ( i < nRows-1 ) && ( Flag[k-nCols] == 1 ) && ( Flag[k+nCols] == 1 ) ) {
+                    w.x += v[k-nCols].x + v[k+nCols].x; w.y += v[k-nCols].y + v[k+nCols].y; w.z += v[k-nCols].z + v[k+nCols].z;
+                    n += 2;
+                }
+                if ( n > 0 ) {
+                    v[k].x = w.x/n; v[k].y = w.y/n; v[k].z = w.z/n;
+                    Flag[k] = LGM_YZPLANE_INTERPOLATED;
+                }
+            }
+        }
+    }
+
+    LGM_ARRAY_1D_FREE( S );
+
+    return( nGood );
+
+}
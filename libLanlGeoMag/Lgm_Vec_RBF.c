@@ -5,6 +5,10 @@
  *
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "Lgm/Lgm_RBF.h"
 
 //#define LGM_RBF_SOLVER  LGM_CHOLESKY_DECOMP
@@ -72,7 +76,7 @@ void    Lgm_Vec_RBF_Psi( Lgm_Vector *v, Lgm_Vector *v0, double e, double *Psi, i
         r = sqrt(e*r2);
         omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
         omr2 = omr*omr;
-        *Psi = omr2*omr2*omr2*(35.0*r2 + 18.0*r + 3.0);
+        *Psi = omr2*omr2*omr2*(35.0*r*r + 18.0*r + 3.0);
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND33 ) {
         
@@ -80,7 +84,7 @@ void    Lgm_Vec_RBF_Psi( Lgm_Vector *v, Lgm_Vector *v0, double e, double *Psi, i
         omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
         omr2 = omr*omr;
         omr4 = omr2*omr2;
-        *Psi = omr4*omr4*(32.0*r2*r + 25.0*r2 + 8.0*r + 1.0);
+        *Psi = omr4*omr4*((32.0*r + 25.0)*r*r + 8.0*r + 1.0);
 
 
     } else {
@@ -160,7 +164,7 @@ void    Lgm_Vec_RBF_Psi2( Lgm_Vector *v, Lgm_Vector *v0, double ex, double ey, d
 
 void    Lgm_Vec_RBF_Derivs( Lgm_Vector *v, Lgm_Vector *v0, double e, double *dPdx, double *dPdy, double *dPdz, int RadialBasisFunction  ) {
 
-    double  psi, x, y, z, x2, y2, z2, r2, f, g;
+    double  psi, x, y, z, x2, y2, z2, r2, f, g, omr, r;
 
     x = v->x - v0->x;
     y = v->y - v0->y;
@@ -197,27 +201,43 @@ void    Lgm_Vec_RBF_Derivs( Lgm_Vector *v, Lgm_Vector *v0, double e, double *dPd
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND30 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        // (not differentiable at r = 0)
+        r = sqrt(e*r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        g = ( r > 0.0 ) ? -2.0*e*omr/r : 0.0;
+        *dPdx = g*x;
+        *dPdy = g*y;
+        *dPdz = g*z;
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND31 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        // dpsi/dx = psi'(r)/r * e*x
+        r = sqrt(e*r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        g = -20.0*e*omr*omr*omr;
+        *dPdx = g*x;
+        *dPdy = g*y;
+        *dPdz = g*z;
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND32 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        r = sqrt(e*r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        f = omr*omr; f = f*f*omr;
+        g = -56.0*e*f*(5.0*r + 1.0);
+        *dPdx = g*x;
+        *dPdy = g*y;
+        *dPdz = g*z;
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND33 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        r = sqrt(e*r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        f = omr*omr*omr; f = f*f*omr;
+        g = -22.0*e*f*((16.0*r + 7.0)*r + 1.0);
+        *dPdx = g*x;
+        *dPdy = g*y;
+        *dPdz = g*z;
 
     } else {
         printf("Lgm_Vec_RBF_Derivs: Unknown value for RadialBasisFunction. (Got %d)\n", RadialBasisFunction );
@@ -278,21 +298,33 @@ void    Lgm_Vec_RBF_Derivs2( Lgm_Vector *v, Lgm_Vector *v0, double ex, double ey
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND31 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        // dpsi/dx = psi'(r)/r * ex*x
+        r = sqrt(r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        g = -20.0*omr*omr*omr;
+        *dPdx = ex*x*g;
+        *dPdy = ey*y*g;
+        *dPdz = ez*z*g;
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND32 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        r = sqrt(r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        f = omr*omr; f = f*f*omr;
+        g = -56.0*f*(5.0*r + 1.0);
+        *dPdx = ex*x*g;
+        *dPdy = ey*y*g;
+        *dPdz = ez*z*g;
 
     } else if ( RadialBasisFunction == LGM_RBF_WENDLAND33 ) {
 
-        *dPdx = 0.0;
-        *dPdy = 0.0;
-        *dPdz = 0.0;
+        r = sqrt(r2);
+        omr = 1.0 - r; if ( omr < 0.0 ) omr = 0.0;
+        f = omr*omr*omr; f = f*f*omr;
+        g = -22.0*f*((16.0*r + 7.0)*r + 1.0);
+        *dPdx = ex*x*g;
+        *dPdy = ey*y*g;
+        *dPdz = ez*z*g;
 
     } else {
         printf("Lgm_Vec_RBF_Derivs2: Unknown value for RadialBasisFunction. (Got %d)\n", RadialBasisFunction );
@@ -333,81 +365,16 @@ void PolyTerms( int D, int *M, double x, double y, double z, double *q ) {
 
 
 
-/** From a vector-field dataset, compute the vector-valued weighting factors,
- *  \f$\vec{c}_j\f$. Info is returned in the rbf structure.
- *
- *
- *  \param[in]                       v   -   pointer to an array of position vectors.
- *  \param[in]                       B   -   pointer to array of corresponding field vectors.
- *  \param[in]                     eps   -   smoothing factors in scalar RBF.
- *  \param[in]                       n   -   number of (v, B) pairs defined.
- *  \param[in]                   DoPoly  -   Flag to use simultaneous linear polynomial fit as well.
- *  \param[in]      RadialBasisFunction  -   RBF to use. Can be LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC
- *
- *  \return  pointer to structure containing info for RBF interpolation. User
- *           is responsible for freeing with Lgm_Vec_RBF_Free().
- *
- *  \author  M. G. Henderson
- *  date    July 15, 2015
- *
- *
+/*
+ *  Make an Lgm_Vec_RBF_Info for the n points v (the weights are filled in
+ *  later).
  */
-Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction ) {
+static Lgm_Vec_RBF_Info *Vec_RBF_New( unsigned long int *I_data, Lgm_Vector *v, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int M, int RadialBasisFunction ) {
 
     unsigned long int Bytes;
-    int              i, j, k, ii, jj, p, q, s, M;
-    double           *d, **a, Psi, val, Qk[27];
-    gsl_matrix       *A, *V, *AA, *A_new, *AA_new, *P_new;
-    gsl_vector       *Dx, *Dy, *Dz, *cx, *cy, *cz, *S, *Work, *resid;
-    gsl_vector       *Dx_new, *Dy_new, *Dz_new, *cx_new, *cy_new, *cz_new, *resid_new;
-    gsl_permutation  *P;
+    int              i;
     Lgm_Vec_RBF_Info *rbf;
 
-
-
-    /*
-     * Do all three components separately, but at the same time.
-     */
-    A  = gsl_matrix_calloc( n, n );
-    AA = gsl_matrix_calloc( n, n );
-    resid = gsl_vector_alloc( n );
-
-    cx = gsl_vector_alloc( n );
-    cy = gsl_vector_alloc( n );
-    cz = gsl_vector_alloc( n );
-
-    Dx = gsl_vector_calloc( n );
-    Dy = gsl_vector_calloc( n );
-    Dz = gsl_vector_calloc( n );
-
-    if ( DoPoly ) {
-
-        M = 27;
-        M = 8;
-        P_new  = gsl_matrix_calloc( M, n );
-
-    } else {
-
-        M = 0;
-
-    }
-
-    A_new  = gsl_matrix_calloc( n+M, n+M );
-    AA_new = gsl_matrix_calloc( n+M, n+M );
-    resid_new = gsl_vector_alloc( n+M );
-
-    cx_new = gsl_vector_alloc( n+M );
-    cy_new = gsl_vector_alloc( n+M );
-    cz_new = gsl_vector_alloc( n+M );
-
-    Dx_new = gsl_vector_calloc( n+M );
-    Dy_new = gsl_vector_calloc( n+M );
-    Dz_new = gsl_vector_calloc( n+M );
-
-
-    /*
-     * Save info needed to do an evaluation.
-     */
     Bytes = sizeof(*rbf);
     rbf = ( Lgm_Vec_RBF_Info *)calloc( 1, Bytes );
 
@@ -418,6 +385,9 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
 
     LGM_ARRAY_1D( rbf->LookUpKey, n, unsigned long int);    Bytes += n*sizeof( unsigned long int );
     LGM_ARRAY_1D( rbf->v,     n, Lgm_Vector);               Bytes += n*sizeof( Lgm_Vector );
+    LGM_ARRAY_1D( rbf->vx,    n, double);                   Bytes += n*sizeof( double );
+    LGM_ARRAY_1D( rbf->vy,    n, double);                   Bytes += n*sizeof( double );
+    LGM_ARRAY_1D( rbf->vz,    n, double);                   Bytes += n*sizeof( double );
     LGM_ARRAY_1D( rbf->eps_x, n, double);                   Bytes += n*sizeof( double );
     LGM_ARRAY_1D( rbf->eps_y, n, double);                   Bytes += n*sizeof( double ); 
     LGM_ARRAY_1D( rbf->eps_z, n, double);                   Bytes += n*sizeof( double );
@@ -437,6 +407,9 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
     for ( i=0; i<n; i++ ) {
         rbf->LookUpKey[i] = I_data[i];
         rbf->v[i]         = v[i];
+        rbf->vx[i]        = v[i].x;
+        rbf->vy[i]        = v[i].y;
+        rbf->vz[i]        = v[i].z;
         rbf->eps_x[i]       = eps_x[i];
         rbf->eps_y[i]       = eps_y[i];
         rbf->eps_z[i]       = eps_z[i];
@@ -445,59 +418,128 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
 
     rbf->size  = (double)Bytes/1.0e6;
 
-
-    // This subtraction doesntm seem to work out very well...?
-//    rbf->Bx0 = B[n-1].x;
-//    rbf->By0 = B[n-1].y;
-//    rbf->Bz0 = B[n-1].z;
-//    rbf->Bx0 = 0.0;
-//    rbf->By0 = 0.0;
-//    rbf->Bz0 = 0.0;
-
-//double Bbkg;
-//for ( Bbkg = 0.0, i=0; i<n; i++ ) Bbkg += B[i].x; rbf->Bx0 = Bbkg/(double)n;
-//for ( Bbkg = 0.0, i=0; i<n; i++ ) Bbkg += B[i].y; rbf->By0 = Bbkg/(double)n;
-//for ( Bbkg = 0.0, i=0; i<n; i++ ) Bbkg += B[i].z; rbf->Bz0 = Bbkg/(double)n;
-//printf("Bavg = %g %g %g\n", rbf->Bx0, rbf->By0, rbf->Bz0 );
+    // This subtraction doesntm seem to work out very well...? (Tried B[n-1], the mean and the min.)
     rbf->Bx0 = 0.0;
     rbf->By0 = 0.0;
     rbf->Bz0 = 0.0;
 
-//double min;
-//for ( min=9e99, i=0; i<n; i++ ) { if ( B[i].x < min )  min = B[i].x; } rbf->Bx0 = min;
-//for ( min=9e99, i=0; i<n; i++ ) { if ( B[i].y < min )  min = B[i].y; } rbf->By0 = min;
-//for ( min=9e99, i=0; i<n; i++ ) { if ( B[i].z < min )  min = B[i].z; } rbf->Bz0 = min;
+    return( rbf );
 
+}
 
-    
-    /*
-     * Fill D arrays. (Subtract off the field at the nearest point v[0] -- See
-     * McNally [2011].) We add this field back on later.
-     */
-    for (i=0; i<n; i++){
-        gsl_vector_set( Dx, i, B[i].x - rbf->Bx0 );
-        gsl_vector_set( Dy, i, B[i].y - rbf->By0 );
-        gsl_vector_set( Dz, i, B[i].z - rbf->Bz0 );
+
+/*
+ *  Sparse solve for the Wendland kernels (see Lgm_RBF_Sparse.c). Only done
+ *  when the matrix is symmetric (the same eps's for every point) and there
+ *  is no polynomial part (which would make the system indefinite). Returns
+ *  FALSE if it wasnt done (or the factorization failed), in which case the
+ *  dense solve is done instead.
+ */
+static int Vec_RBF_SparseInit( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector **F, int nF, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction, Lgm_Vec_RBF_Info **rbf ) {
+
+    int              i, k, l, f, *Perm, *First;
+    double           Psi, *b[3], *c[3];
+    Lgm_RBF_Skyline  *m;
+    Lgm_Vec_RBF_Info *r;
+
+    if ( DoPoly || ( RadialBasisFunction < LGM_RBF_WENDLAND30 ) || ( RadialBasisFunction > LGM_RBF_WENDLAND33 ) ) return( FALSE );
+    for ( i=1; i<n; i++ ) {
+        if ( ( eps_x[i] != eps_x[0] ) || ( eps_y[i] != eps_y[0] ) || ( eps_z[i] != eps_z[0] ) ) return( FALSE );
     }
 
+    LGM_ARRAY_1D( Perm,  n, int );
+    LGM_ARRAY_1D( First, n, int );
+    Lgm_RBF_SupportOrder( n, v, eps_x[0], eps_y[0], eps_z[0], Perm, First );
 
+    m = Lgm_RBF_Skyline_Alloc( n, First );
+    for ( k=0; k<n; k++ ) {
+        for ( l=First[k]; l<=k; l++ ) {
+            Lgm_Vec_RBF_Psi2( &v[Perm[k]], &v[Perm[l]], eps_x[0], eps_y[0], eps_z[0], &Psi, RadialBasisFunction );
+            LGM_SKYLINE( m, k, l ) = Psi;
+        }
+    }
 
-    ii = 0;
+    if ( !Lgm_RBF_Skyline_Cholesky( m ) ) {
+        Lgm_RBF_Skyline_Free( m );
+        LGM_ARRAY_1D_FREE( First );
+        LGM_ARRAY_1D_FREE( Perm );
+        return( FALSE );
+    }
 
-    if ( DoPoly ) {
-        for (i=0; i<M; i++){
-            gsl_vector_set( Dx_new, ii, 0.0 );
-            gsl_vector_set( Dy_new, ii, 0.0 );
-            gsl_vector_set( Dz_new, ii, 0.0 );
-            ++ii;
+    for ( k=0; k<3; k++ ) LGM_ARRAY_1D( b[k], n, double );
+    for ( f=0; f<nF; f++ ) {
+
+        r = rbf[f] = Vec_RBF_New( I_data, v, eps_x, eps_y, eps_z, n, DoPoly, 0, RadialBasisFunction );
+
+        for ( k=0; k<n; k++ ) {
+            i = Perm[k];
+            b[0][k] = F[f][i].x - r->Bx0;
+            b[1][k] = F[f][i].y - r->By0;
+            b[2][k] = F[f][i].z - r->Bz0;
+        }
+
+        c[0] = r->cx_new; c[1] = r->cy_new; c[2] = r->cz_new;
+        for ( l=0; l<3; l++ ) {
+            Lgm_RBF_Skyline_Solve( m, b[l] );
+            for ( k=0; k<n; k++ ) c[l][ Perm[k] ] = b[l][k];
         }
+
     }
 
-    for (i=0; i<n; i++){
-        gsl_vector_set( Dx_new, ii, B[i].x - rbf->Bx0 );
-        gsl_vector_set( Dy_new, ii, B[i].y - rbf->By0 );
-        gsl_vector_set( Dz_new, ii, B[i].z - rbf->Bz0 );
-        ++ii;
+    for ( k=0; k<3; k++ ) LGM_ARRAY_1D_FREE( b[k] );
+    Lgm_RBF_Skyline_Free( m );
+    LGM_ARRAY_1D_FREE( First );
+    LGM_ARRAY_1D_FREE( Perm );
+
+    return( TRUE );
+
+}
+
+
+/*
+ *  Does the work for Lgm_Vec_RBF_Init() and Lgm_Vec_RBF_Init2(). The matrix
+ *  only depends on the points (and the eps's), so it is filled in and
+ *  factored once, and then used to solve for each of the nF fields F[0],
+ *  F[1], ... The fits go in rbf[0], rbf[1], ...
+ */
+static void Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector **F, int nF, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction, Lgm_Vec_RBF_Info **rbf ) {
+
+    int              i, j, k, f, ii, s, M;
+    double           Psi, Qk[27], *c0[3], *c_new0[3], *g_new0[3];
+    gsl_matrix       *A, *V, *A_new, *AA_new, *P_new;
+    gsl_vector       *D[3], *c[3], *D_new[3], *c_new[3], *S, *Work, *resid_new;
+    gsl_permutation  *P;
+    Lgm_Vector       *B;
+    Lgm_Vec_RBF_Info *r;
+
+
+    if ( Vec_RBF_SparseInit( I_data, v, F, nF, eps_x, eps_y, eps_z, n, DoPoly, RadialBasisFunction, rbf ) ) return;
+
+    /*
+     * Do all three components separately, but at the same time.
+     */
+    A  = gsl_matrix_calloc( n, n );
+
+    if ( DoPoly ) {
+
+        M = 27;
+        M = 8;
+        P_new  = gsl_matrix_calloc( M, n );
+
+    } else {
+
+        M = 0;
+
+    }
+
+    A_new  = gsl_matrix_calloc( n+M, n+M );
+    resid_new = gsl_vector_alloc( n+M );
+
+    for ( k=0; k<3; k++ ) {
+        D[k]     = gsl_vector_calloc( n );
+        c[k]     = gsl_vector_calloc( n );
+        D_new[k] = gsl_vector_calloc( n+M );
+        c_new[k] = gsl_vector_alloc( n+M );
     }
 
 
@@ -513,7 +555,7 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
     for ( i=0; i<n; i++ ) { // locate start row for subarray
         for ( j=0; j<n; j++ ) { // locate start column for subarray
             // Get PSi( v_i - v_j )
-            Lgm_Vec_RBF_Psi2( &v[i], &v[j], eps_x[j], eps_y[j], eps_z[j], &Psi, rbf->RadialBasisFunction );
+            Lgm_Vec_RBF_Psi2( &v[i], &v[j], eps_x[j], eps_y[j], eps_z[j], &Psi, RadialBasisFunction );
             gsl_matrix_set( A, i, j, Psi );
         }
     }
@@ -528,16 +570,10 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
             PolyTerms( 1, &M, v[j].x, v[j].y, v[j].z, Qk );
             for ( i=0; i<M; i++ ) { 
                 gsl_matrix_set( P_new, i, j, Qk[i] );
-                //gsl_matrix_set( P_new, j, i, Qk[i] );
             }
         }
 
-        // Zero Block
-        for ( i=0; i<M; i++ ) { 
-            for ( j=0; j<M; j++ ) {
-                gsl_matrix_set( A_new, i, j, 0.0 );
-            }
-        }
+        // Zero Block (A_new is calloc'd)
 
         // P Block
         for ( i=0; i<M; i++ ) { 
@@ -571,146 +607,165 @@ Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lg
      *
      *      d = ac
      *
-     *  for c. (One for each comp.)
-     *
-     *  First create gsl_vector and gsl_matrix views of the d and A arrays.
-     *  Then compute Cholesky decomposition of the a array. Then solve the
-     *  system to get c.
+     *  for c. (One for each comp of each field.)
      *
+     *  Factor the matrix here, then do the solves for each field below.
      */
     if ( LGM_RBF_SOLVER == LGM_CHOLESKY_DECOMP ){
         gsl_linalg_cholesky_decomp( A );
-        gsl_linalg_cholesky_solve( A, Dx, cx ); // x-comp
-        gsl_linalg_cholesky_solve( A, Dy, cy ); // y-comp
-        gsl_linalg_cholesky_solve( A, Dz, cz ); // z-comp
     } else if ( LGM_RBF_SOLVER == LGM_PLU_DECOMP ){
+        AA_new = gsl_matrix_alloc( n+M, n+M );
+        gsl_matrix_memcpy( AA_new, A_new );
+        P = gsl_permutation_alloc( n+M );
+        gsl_linalg_LU_decomp( A_new, P, &s );
+    } else if ( LGM_RBF_SOLVER == LGM_SVD ){
+        V    = gsl_matrix_calloc( n, n );
+        S    = gsl_vector_alloc( n );
+        Work = gsl_vector_alloc( n );
+        gsl_linalg_SV_decomp( A, V, S, Work );
+    }
 
 
 
+    for ( f=0; f<nF; f++ ) {
 
-//        printf("\nBefore LU solver\n");
-//        for (i=0; i<n; i++ ) { printf("v%02d = %8g %8g %8g   B%02d = %8g %8g %8g\n", i, v[i].x, v[i].y, v[i].z, i, B[i].x, B[i].y, B[i].z ); }
-//        printf("A=\n"); for (i=0; i<n; i++){ for (j=0; j<n; j++){ printf("%8g ", gsl_matrix_get(A, i, j ) ); } printf("\n"); } printf("\n");
-//        printf("Dx= "); for (i=0; i<n; i++){ printf("%8g ", gsl_vector_get(Dx, i ) ); } printf("\n");
-
-////        gsl_matrix_memcpy( AA, A );
-////        P = gsl_permutation_alloc( n );
-////        gsl_linalg_LU_decomp( A, P, &s );
-////        gsl_linalg_LU_solve( A, P, Dx, cx ); // x-comp
-//////        printf("cx= "); for (i=0; i<n; i++){ printf("%8g ", gsl_vector_get(cx, i ) ); } printf("\n");
-
-////        for (ii=0; ii<5; ii++){
-////            gsl_linalg_LU_refine(  AA, A, P, Dx, cx, resid );
-//////            printf("\ncx= "); for (i=0; i<n; i++){ printf("%8g ", gsl_vector_get(cx, i ) ); } printf("\n");
-//////            printf("rx= "); for (i=0; i<n; i++){ printf("%8g ", gsl_vector_get(rx, i ) ); } printf("\n");
-////        }
-////
-////        gsl_linalg_LU_solve( A, P, Dy, cy ); // y-comp
-////        for (ii=0; ii<5; ii++) gsl_linalg_LU_refine(  AA, A, P, Dy, cy, resid );
-////
-////        gsl_linalg_LU_solve( A, P, Dz, cz ); // z-comp
-////        for (ii=0; ii<5; ii++) gsl_linalg_LU_refine(  AA, A, P, Dy, cy, resid );
+        B = F[f];
+        r = rbf[f] = Vec_RBF_New( I_data, v, eps_x, eps_y, eps_z, n, DoPoly, M, RadialBasisFunction );
 
+        /*
+         * Fill D arrays. (Subtract off the background -- See McNally [2011].)
+         * We add this field back on later.
+         */
+        for (i=0; i<n; i++){
+            gsl_vector_set( D[0], i, B[i].x - r->Bx0 );
+            gsl_vector_set( D[1], i, B[i].y - r->By0 );
+            gsl_vector_set( D[2], i, B[i].z - r->Bz0 );
+        }
 
-//        printf("\nA*cx = ");
-//double sum;
-//        for (i=0; i<n; i++){ 
-//            sum = 0.0;
-//            for (j=0; j<n; j++){ 
-//                sum += gsl_matrix_get(AA, i, j )*gsl_vector_get(cx, j );
-//            }
-//            printf("%8g ", sum ); 
-//        } 
-//        printf("\n");
-//        printf("After LU solver\n\n");
+        // the first M are zero
+        for (i=0; i<n; i++){
+            gsl_vector_set( D_new[0], i+M, B[i].x - r->Bx0 );
+            gsl_vector_set( D_new[1], i+M, B[i].y - r->By0 );
+            gsl_vector_set( D_new[2], i+M, B[i].z - r->Bz0 );
+        }
 
-////        gsl_permutation_free( P );
+        for ( k=0; k<3; k++ ) {
+            if ( LGM_RBF_SOLVER == LGM_CHOLESKY_DECOMP ){
+                gsl_linalg_cholesky_solve( A, D[k], c[k] );
+            } else if ( LGM_RBF_SOLVER == LGM_PLU_DECOMP ){
+                gsl_linalg_LU_solve( A_new, P, D_new[k], c_new[k] );
+                for (ii=0; ii<1; ii++) gsl_linalg_LU_refine(  AA_new, A_new, P, D_new[k], c_new[k], resid_new );
+            } else if ( LGM_RBF_SOLVER == LGM_SVD ){
+                gsl_linalg_SV_solve( A, V, S, D[k], c[k] );
+            }
+        }
 
+        c0[0] = r->cx; c_new0[0] = r->cx_new; g_new0[0] = r->gx_new;
+        c0[1] = r->cy; c_new0[1] = r->cy_new; g_new0[1] = r->gy_new;
+        c0[2] = r->cz; c_new0[2] = r->cz_new; g_new0[2] = r->gz_new;
+        for ( k=0; k<3; k++ ) {
+            for (i=0; i<n; i++) c0[k][i]     = gsl_vector_get( c[k], i );
+            for (i=0; i<n; i++) c_new0[k][i] = gsl_vector_get( c_new[k], i+M );
+            for (i=0; i<M; i++) g_new0[k][i] = gsl_vector_get( c_new[k], i );
+        }
 
+    }
 
 
-if (1==1){
-        gsl_matrix_memcpy( AA_new, A_new );
-//printf("A_new=\n"); for (i=0; i<n+M; i++){ for (j=0; j<n+M; j++){ printf("%8g ", gsl_matrix_get(A_new, i, j ) ); } printf("\n"); } printf("\n");
-        P = gsl_permutation_alloc( n+M );
-        gsl_linalg_LU_decomp( A_new, P, &s );
-        gsl_linalg_LU_solve( A_new, P, Dx_new, cx_new ); // x-comp
-        for (ii=0; ii<1; ii++) gsl_linalg_LU_refine(  AA_new, A_new, P, Dx_new, cx_new, resid_new );
-//printf("cx_new = ");
-//for(ii=0; ii<n+M; ii++){
-//    printf(" %g", gsl_vector_get(cx_new, ii ) );
-//}
-//printf("\n");
-
-        gsl_linalg_LU_solve( A_new, P, Dy_new, cy_new ); // y-comp
-        for (ii=0; ii<1; ii++) gsl_linalg_LU_refine(  AA_new, A_new, P, Dy_new, cy_new, resid_new );
-
-        gsl_linalg_LU_solve( A_new, P, Dz_new, cz_new ); // z-comp
-        for (ii=0; ii<1; ii++) gsl_linalg_LU_refine(  AA_new, A_new, P, Dz_new, cz_new, resid_new );
+    if ( LGM_RBF_SOLVER == LGM_PLU_DECOMP ){
         gsl_permutation_free( P );
-
-        gsl_matrix_free( AA );
         gsl_matrix_free( AA_new );
-}
-
-
-
-
     } else if ( LGM_RBF_SOLVER == LGM_SVD ){
-        V    = gsl_matrix_calloc( n, n );
-        S    = gsl_vector_alloc( n );
-        Work = gsl_vector_alloc( n );
-        gsl_linalg_SV_decomp( A, V, S, Work );
-        gsl_linalg_SV_solve( A, V, S, Dx, cx ); //x-comp
-        gsl_linalg_SV_solve( A, V, S, Dy, cy ); //y-comp
-        gsl_linalg_SV_solve( A, V, S, Dz, cz ); //z-comp
         gsl_vector_free( Work );
         gsl_vector_free( S );
         gsl_matrix_free( V );
     }
 
-    for (i=0; i<n; i++){
-        rbf->cx[i] = gsl_vector_get( cx, i );
-        rbf->cy[i] = gsl_vector_get( cy, i );
-        rbf->cz[i] = gsl_vector_get( cz, i );
+    for ( k=0; k<3; k++ ) {
+        gsl_vector_free( D[k] );
+        gsl_vector_free( c[k] );
+        gsl_vector_free( D_new[k] );
+        gsl_vector_free( c_new[k] );
     }
+    gsl_vector_free( resid_new );
+    gsl_matrix_free( A );
+    gsl_matrix_free( A_new );
 
+}
 
-    for (i=0; i<n; i++){
-        rbf->cx_new[i] = gsl_vector_get( cx_new, i+M );
-        rbf->cy_new[i] = gsl_vector_get( cy_new, i+M );
-        rbf->cz_new[i] = gsl_vector_get( cz_new, i+M );
-    }
-    for (i=0; i<M; i++){
-        rbf->gx_new[i] = gsl_vector_get( cx_new, i );
-        rbf->gy_new[i] = gsl_vector_get( cy_new, i );
-        rbf->gz_new[i] = gsl_vector_get( cz_new, i );
-    }
-//exit(0);
 
-    
-    gsl_vector_free( Dx );
-    gsl_vector_free( Dy );
-    gsl_vector_free( Dz );
-    gsl_vector_free( resid );
-    gsl_vector_free( cx );
-    gsl_vector_free( cy );
-    gsl_vector_free( cz );
-    gsl_matrix_free( A );
 
-    gsl_vector_free( Dx_new );
-    gsl_vector_free( Dy_new );
-    gsl_vector_free( Dz_new );
-    gsl_vector_free( resid_new );
-    gsl_vector_free( cx_new );
-    gsl_vector_free( cy_new );
-    gsl_vector_free( cz_new );
-    gsl_matrix_free( A_new );
+/** From a vector-field dataset, compute the vector-valued weighting factors,
+ *  \f$\vec{c}_j\f$. Info is returned in the rbf structure.
+ *
+ *
+ *  \param[in]                       v   -   pointer to an array of position vectors.
+ *  \param[in]                       B   -   pointer to array of corresponding field vectors.
+ *  \param[in]                     eps   -   smoothing factors in scalar RBF.
+ *  \param[in]                       n   -   number of (v, B) pairs defined.
+ *  \param[in]                   DoPoly  -   Flag to use simultaneous linear polynomial fit as well.
+ *  \param[in]      RadialBasisFunction  -   RBF to use. Can be LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC,
+ *                                           LGM_RBF_INV_MULTIQUADRIC or LGM_RBF_WENDLAND30 ... LGM_RBF_WENDLAND33.
+ *
+ *  With the (compactly supported) Wendland RBFs the support is
+ *  eps_x*x^2 + eps_y*y^2 + eps_z*z^2 < 1. If the eps's are the same for
+ *  every point and DoPoly is FALSE, the matrix is then sparse and symmetric
+ *  positive definite and it is solved with a sparse Cholesky factorization
+ *  (see Lgm_RBF_Sparse.c) instead of the dense LU.
+ *
+ *  \return  pointer to structure containing info for RBF interpolation. User
+ *           is responsible for freeing with Lgm_Vec_RBF_Free().
+ *
+ *  \author  M. G. Henderson
+ *  date    July 15, 2015
+ *
+ *
+ */
+Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction ) {
+
+    Lgm_Vec_RBF_Info *rbf;
+
+    Vec_RBF_Init( I_data, v, &B, 1, eps_x, eps_y, eps_z, n, DoPoly, RadialBasisFunction, &rbf );
 
     return( rbf );
 
 }
 
+
+
+/** Same as Lgm_Vec_RBF_Init(), but fits two fields (e.g. B and E) given at
+ *  the same points. The RBF matrix is the same for both, so it is only
+ *  filled in and factored once. The two results are independent of each
+ *  other (free each with Lgm_Vec_RBF_Free()) and are the same as two calls
+ *  to Lgm_Vec_RBF_Init() would give.
+ *
+ *
+ *  \param[in]                       v   -   pointer to an array of position vectors.
+ *  \param[in]                       B   -   pointer to array of corresponding values of the first field.
+ *  \param[in]                       E   -   pointer to array of corresponding values of the second field.
+ *  \param[in]                     eps   -   smoothing factors in scalar RBF.
+ *  \param[in]                       n   -   number of (v, B, E) triples defined.
+ *  \param[in]                   DoPoly  -   Flag to use simultaneous linear polynomial fit as well.
+ *  \param[in]      RadialBasisFunction  -   RBF to use. Can be LGM_RBF_GAUSSIAN, LGM_RBF_MULTIQUADRIC
+ *  \param[out]                  rbf_e   -   fit to E.
+ *
+ *  \return  fit to B.
+ *
+ */
+Lgm_Vec_RBF_Info *Lgm_Vec_RBF_Init2( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *E, double *eps_x, double *eps_y, double *eps_z, int n, int DoPoly, int RadialBasisFunction, Lgm_Vec_RBF_Info **rbf_e ) {
+
+    Lgm_Vector       *F[2];
+    Lgm_Vec_RBF_Info *rbf[2];
+
+    F[0] = B; F[1] = E;
+    Vec_RBF_Init( I_data, v, F, 2, eps_x, eps_y, eps_z, n, DoPoly, RadialBasisFunction, rbf );
+    *rbf_e = rbf[1];
+
+    return( rbf[0] );
+
+}
+
+
 /** Free a previously allocated Lgm_DFI_RBF_Info structure.
  *
  *
@@ -726,6 +781,9 @@ if (1==1){
 void    Lgm_Vec_RBF_Free( Lgm_Vec_RBF_Info *rbf ) {
     LGM_ARRAY_1D_FREE( rbf->LookUpKey );
     LGM_ARRAY_1D_FREE( rbf->v   );
+    LGM_ARRAY_1D_FREE( rbf->vx  );
+    LGM_ARRAY_1D_FREE( rbf->vy  );
+    LGM_ARRAY_1D_FREE( rbf->vz  );
     LGM_ARRAY_1D_FREE( rbf->eps_x );
     LGM_ARRAY_1D_FREE( rbf->eps_y );
     LGM_ARRAY_1D_FREE( rbf->eps_z );
@@ -753,6 +811,222 @@ void    Lgm_Vec_RBF_Free( Lgm_Vec_RBF_Info *rbf ) {
 
 
 
+/*
+ *  Evaluation kernels.
+ *
+ *  These sum the RBF terms (and, if DoDerivs is set, their x, y and z
+ *  derivatives) over all of the centres in one pass, working from the SoA
+ *  copies of the centres (rbf->vx, vy, vz) and the weights (cx_new, cy_new,
+ *  cz_new). The exp() or sqrt() is done once per centre and shared by the
+ *  value and the derivatives. The loops have no branches or calls other than
+ *  the exp()/sqrt(), so that they can be vectorized by the compiler.
+ *
+ *  S[0..2] gets the value and S[3..11] gets dB/dx, dB/dy, dB/dz (x, y and z
+ *  comps of each). The Gaussian, (inverse) multiquadric and Wendland (other
+ *  than W30, which isnt differentiable at r = 0) kernels are handled here.
+ *  The polynomial terms and background are not included.
+ */
+#if USE_OPENMP
+#define LGM_VEC_RBF_SIMD    _Pragma( "omp simd reduction(+:Bx,By,Bz,Bxx,Byx,Bzx,Bxy,Byy,Bzy,Bxz,Byz,Bzz)" )
+#else
+#define LGM_VEC_RBF_SIMD
+#endif
+
+/*
+ *  Wendland psi and g = psi'(r)/r (so that dpsi/dx = g*ex*x) for r2 = ex*x^2
+ *  + ey*y^2 + ez*z^2. Same as Lgm_Vec_RBF_Psi2() and Lgm_Vec_RBF_Derivs2(),
+ *  but without branches.
+ */
+static inline __attribute__((always_inline)) void Vec_Wendland31( double r2, double *psi, double *g ) {
+    double r = sqrt( r2 ), omr = 1.0 - r, o3;
+    omr  = ( omr > 0.0 ) ? omr : 0.0;
+    o3   = omr*omr*omr;
+    *psi = o3*omr*( 4.0*r + 1.0 );
+    *g   = -20.0*o3;
+}
+
+static inline __attribute__((always_inline)) void Vec_Wendland32( double r2, double *psi, double *g ) {
+    double r = sqrt( r2 ), omr = 1.0 - r, o5;
+    omr  = ( omr > 0.0 ) ? omr : 0.0;
+    o5   = omr*omr; o5 = o5*o5*omr;
+    *psi = o5*omr*( 35.0*r2 + 18.0*r + 3.0 );
+    *g   = -56.0*o5*( 5.0*r + 1.0 );
+}
+
+static inline __attribute__((always_inline)) void Vec_Wendland33( double r2, double *psi, double *g ) {
+    double r = sqrt( r2 ), omr = 1.0 - r, o7;
+    omr  = ( omr > 0.0 ) ? omr : 0.0;
+    o7   = omr*omr*omr; o7 = o7*o7*omr;
+    *psi = o7*omr*( ( 32.0*r + 25.0 )*r2 + 8.0*r + 1.0 );
+    *g   = -22.0*o7*( ( 16.0*r + 7.0 )*r + 1.0 );
+}
+
+#define VEC_WENDLAND_LOOPS( W ) {                                                           \
+        if ( !DoDerivs ) {                                                                  \
+            LGM_VEC_RBF_SIMD                                                                \
+            for ( j=0; j<n; j++ ){                                                          \
+                double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j], psi, g;              \
+                W( ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz, &psi, &g );                     \
+                Bx += psi*cx[j]; By += psi*cy[j]; Bz += psi*cz[j];                          \
+            }                                                                               \
+        } else {                                                                            \
+            LGM_VEC_RBF_SIMD                                                                \
+            for ( j=0; j<n; j++ ){                                                          \
+                double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j], psi, g;              \
+                W( ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz, &psi, &g );                     \
+                double px = ex[j]*dx*g, py = ey[j]*dy*g, pz = ez[j]*dz*g;                   \
+                Bx  += psi*cx[j]; By  += psi*cy[j]; Bz  += psi*cz[j];                       \
+                Bxx += px*cx[j];  Byx += px*cy[j];  Bzx += px*cz[j];                        \
+                Bxy += py*cx[j];  Byy += py*cy[j];  Bzy += py*cz[j];                        \
+                Bxz += pz*cx[j];  Byz += pz*cy[j];  Bzz += pz*cz[j];                        \
+            }                                                                               \
+        } }
+
+static inline void Vec_RBF_Kernel( double x, double y, double z, Lgm_Vec_RBF_Info *rbf, int DoDerivs, double *S ) {
+
+    int             j, n, Type;
+    const double    *vx, *vy, *vz, *ex, *ey, *ez, *cx, *cy, *cz;
+    double          Bx, By, Bz, Bxx, Byx, Bzx, Bxy, Byy, Bzy, Bxz, Byz, Bzz;
+
+    n  = rbf->n; Type = rbf->RadialBasisFunction;
+    vx = rbf->vx;    vy = rbf->vy;    vz = rbf->vz;
+    ex = rbf->eps_x; ey = rbf->eps_y; ez = rbf->eps_z;
+    cx = rbf->cx_new; cy = rbf->cy_new; cz = rbf->cz_new;
+
+    Bx = By = Bz = 0.0;
+    Bxx = Byx = Bzx = Bxy = Byy = Bzy = Bxz = Byz = Bzz = 0.0;
+
+    if ( Type == LGM_RBF_WENDLAND31 ) {
+
+        VEC_WENDLAND_LOOPS( Vec_Wendland31 );
+
+    } else if ( Type == LGM_RBF_WENDLAND32 ) {
+
+        VEC_WENDLAND_LOOPS( Vec_Wendland32 );
+
+    } else if ( Type == LGM_RBF_WENDLAND33 ) {
+
+        VEC_WENDLAND_LOOPS( Vec_Wendland33 );
+
+    } else if ( !DoDerivs ) {
+
+        if ( Type == LGM_RBF_GAUSSIAN ) {
+            LGM_VEC_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j];
+                double psi = exp( -( ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz ) );
+                Bx += psi*cx[j]; By += psi*cy[j]; Bz += psi*cz[j];
+            }
+        } else {
+            LGM_VEC_RBF_SIMD
+            for ( j=0; j<n; j++ ){
+                double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j];
+                double psi = sqrt( 1.0 + ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz );
+                Bx += psi*cx[j]; By += psi*cy[j]; Bz += psi*cz[j];
+            }
+        }
+
+    } else if ( Type == LGM_RBF_GAUSSIAN ) {
+
+        LGM_VEC_RBF_SIMD
+        for ( j=0; j<n; j++ ){
+            double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j];
+            double psi = exp( -( ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz ) );
+            double g = -2.0*psi;
+            double px = ex[j]*dx*g, py = ey[j]*dy*g, pz = ez[j]*dz*g;
+            Bx  += psi*cx[j]; By  += psi*cy[j]; Bz  += psi*cz[j];
+            Bxx += px*cx[j];  Byx += px*cy[j];  Bzx += px*cz[j];
+            Bxy += py*cx[j];  Byy += py*cy[j];  Bzy += py*cz[j];
+            Bxz += pz*cx[j];  Byz += pz*cy[j];  Bzz += pz*cz[j];
+        }
+
+    } else {
+
+        /*
+         * Multiquadric, psi = sqrt(1+r2), and dpsi/dx = ex*x/psi. Note that
+         * the inverse multiquadric has always been evaluated (by
+         * Lgm_Vec_RBF_Psi2() and Lgm_Vec_RBF_Derivs2()) with the same psi but
+         * derivatives of the opposite sign. That is kept here.
+         */
+        double sgn = ( Type == LGM_RBF_INV_MULTIQUADRIC ) ? -1.0 : 1.0;
+
+        LGM_VEC_RBF_SIMD
+        for ( j=0; j<n; j++ ){
+            double dx = x - vx[j], dy = y - vy[j], dz = z - vz[j];
+            double psi = sqrt( 1.0 + ex[j]*dx*dx + ey[j]*dy*dy + ez[j]*dz*dz );
+            double g = sgn/psi;
+            double px = ex[j]*dx*g, py = ey[j]*dy*g, pz = ez[j]*dz*g;
+            Bx  += psi*cx[j]; By  += psi*cy[j]; Bz  += psi*cz[j];
+            Bxx += px*cx[j];  Byx += px*cy[j];  Bzx += px*cz[j];
+            Bxy += py*cx[j];  Byy += py*cy[j];  Bzy += py*cz[j];
+            Bxz += pz*cx[j];  Byz += pz*cy[j];  Bzz += pz*cz[j];
+        }
+
+    }
+
+    S[0] = Bx;  S[1]  = By;  S[2]  = Bz;
+    S[3] = Bxx; S[4]  = Byx; S[5]  = Bzx;
+    S[6] = Bxy; S[7]  = Byy; S[8]  = Bzy;
+    S[9] = Bxz; S[10] = Byz; S[11] = Bzz;
+
+    return;
+
+}
+
+/*
+ *  Returns TRUE if rbf can be evaluated with Vec_RBF_Kernel().
+ */
+static inline int Vec_RBF_HaveKernel( Lgm_Vec_RBF_Info *rbf ) {
+    return( ( rbf->vx != NULL ) && (    ( rbf->RadialBasisFunction == LGM_RBF_GAUSSIAN )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_MULTIQUADRIC )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_INV_MULTIQUADRIC )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_WENDLAND31 )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_WENDLAND32 )
+                                     || ( rbf->RadialBasisFunction == LGM_RBF_WENDLAND33 ) ) );
+}
+
+/*
+ *  Polynomial parts of B and its derivatives (see Lgm_Vec_RBF_Init()).
+ */
+static void Vec_RBF_AddPoly( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_Vec_RBF_Info *rbf ) {
+
+    int         j, M;
+    double      x, y, z, Qk[27];
+
+    if ( B ) {
+        PolyTerms( 1, &M, v->x, v->y, v->z, Qk );
+        for ( j=0; j<M; j++ ){
+            B->x += rbf->gx_new[j]*Qk[j];
+            B->y += rbf->gy_new[j]*Qk[j];
+            B->z += rbf->gz_new[j]*Qk[j];
+        }
+    }
+
+    if ( dBdx ) {
+        x = v->x; y = v->y; z = v->z;
+        //Poly term dB/dx
+        dBdx->x += rbf->gx_new[4] + rbf->gx_new[5]*z + rbf->gx_new[6]*y + rbf->gx_new[7]*y*z;
+        dBdx->y += rbf->gy_new[4] + rbf->gy_new[5]*z + rbf->gy_new[6]*y + rbf->gy_new[7]*y*z;
+        dBdx->z += rbf->gz_new[4] + rbf->gz_new[5]*z + rbf->gz_new[6]*y + rbf->gz_new[7]*y*z;
+        
+        //Poly term dB/dy
+        dBdy->x += rbf->gx_new[2] + rbf->gx_new[3]*z + rbf->gx_new[6]*x + rbf->gx_new[7]*x*z;
+        dBdy->y += rbf->gy_new[2] + rbf->gy_new[3]*z + rbf->gy_new[6]*x + rbf->gy_new[7]*x*z;
+        dBdy->z += rbf->gz_new[2] + rbf->gz_new[3]*z + rbf->gz_new[6]*x + rbf->gz_new[7]*x*z;
+        
+        //Poly term dB/dz
+        dBdz->x += rbf->gx_new[1] + rbf->gx_new[3]*y + rbf->gx_new[5]*x + rbf->gx_new[7]*x*y;
+        dBdz->y += rbf->gy_new[1] + rbf->gy_new[3]*y + rbf->gy_new[5]*x + rbf->gy_new[7]*x*y;
+        dBdz->z += rbf->gz_new[1] + rbf->gz_new[3]*y + rbf->gz_new[5]*x + rbf->gz_new[7]*x*y;
+    }
+
+    return;
+
+}
+
+
+
+
 /**  Compute Divergence Free interpolant at the specified position vector. The
  *   weights given in \f$\vec{c}\f$ must have been pre-computed with
  *   Lgm_DFI_RBF_Init().
@@ -771,9 +1045,19 @@ void    Lgm_Vec_RBF_Free( Lgm_Vec_RBF_Info *rbf ) {
  */
 void    Lgm_Vec_RBF_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vec_RBF_Info *rbf ) {
 
-    int         j, M;
-    double      psi, Qk[27];
+    int         j;
+    double      psi, S[12];
+
 
+    if ( Vec_RBF_HaveKernel( rbf ) ) {
+        Vec_RBF_Kernel( v->x, v->y, v->z, rbf, FALSE, S );
+        B->x = S[0]; B->y = S[1]; B->z = S[2];
+        if ( rbf->DoPoly ) Vec_RBF_AddPoly( v, B, NULL, NULL, NULL, rbf );
+        B->x += rbf->Bx0;
+        B->y += rbf->By0;
+        B->z += rbf->Bz0;
+        return;
+    }
 
     B->x = B->y = B->z = 0.0;
 /*
@@ -792,14 +1076,7 @@ void    Lgm_Vec_RBF_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vec_RBF_Info *rbf )
         B->z += psi * rbf->cz_new[j];
     }
 
-    if ( rbf->DoPoly ) {
-        PolyTerms( 1, &M, v->x, v->y, v->z, Qk );
-        for ( j=0; j<M; j++ ){
-            B->x += rbf->gx_new[j]*Qk[j];
-            B->y += rbf->gy_new[j]*Qk[j];
-            B->z += rbf->gz_new[j]*Qk[j];
-        }
-    }
+    if ( rbf->DoPoly ) Vec_RBF_AddPoly( v, B, NULL, NULL, NULL, rbf );
 
     // Add the subtracted "background" back in (that we subtracted prior to the interp).
     B->x += rbf->Bx0;
@@ -835,9 +1112,18 @@ void    Lgm_Vec_RBF_Eval( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vec_RBF_Info *rbf )
 void    Lgm_Vec_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_Vec_RBF_Info *rbf ) {
 
     int         j;
-    double      dPdx, dPdy, dPdz;
+    double      dPdx, dPdy, dPdz, S[12];
 
 
+    if ( Vec_RBF_HaveKernel( rbf ) ) {
+        Vec_RBF_Kernel( v->x, v->y, v->z, rbf, TRUE, S );
+        dBdx->x = S[3]; dBdx->y = S[4];  dBdx->z = S[5];
+        dBdy->x = S[6]; dBdy->y = S[7];  dBdy->z = S[8];
+        dBdz->x = S[9]; dBdz->y = S[10]; dBdz->z = S[11];
+        if ( rbf->DoPoly ) Vec_RBF_AddPoly( v, NULL, dBdx, dBdy, dBdz, rbf );
+        return;
+    }
+
     dBdx->x = dBdx->y = dBdx->z = 0.0;
     dBdy->x = dBdy->y = dBdy->z = 0.0;
     dBdz->x = dBdz->y = dBdz->z = 0.0;
@@ -879,24 +1165,7 @@ void    Lgm_Vec_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dB
 
     }
 
-    if ( rbf->DoPoly ) {
-        double x, y, z;
-        x = v->x; y = v->y; z = v->z;
-        //Poly term dB/dx
-        dBdx->x += rbf->gx_new[4] + rbf->gx_new[5]*z + rbf->gx_new[6]*y + rbf->gx_new[7]*y*z;
-        dBdx->y += rbf->gy_new[4] + rbf->gy_new[5]*z + rbf->gy_new[6]*y + rbf->gy_new[7]*y*z;
-        dBdx->z += rbf->gz_new[4] + rbf->gz_new[5]*z + rbf->gz_new[6]*y + rbf->gz_new[7]*y*z;
-        
-        //Poly term dB/dy
-        dBdy->x += rbf->gx_new[2] + rbf->gx_new[3]*z + rbf->gx_new[6]*x + rbf->gx_new[7]*x*z;
-        dBdy->y += rbf->gy_new[2] + rbf->gy_new[3]*z + rbf->gy_new[6]*x + rbf->gy_new[7]*x*z;
-        dBdy->z += rbf->gz_new[2] + rbf->gz_new[3]*z + rbf->gz_new[6]*x + rbf->gz_new[7]*x*z;
-        
-        //Poly term dB/dz
-        dBdz->x += rbf->gx_new[1] + rbf->gx_new[3]*y + rbf->gx_new[5]*x + rbf->gx_new[7]*x*y;
-        dBdz->y += rbf->gy_new[1] + rbf->gy_new[3]*y + rbf->gy_new[5]*x + rbf->gy_new[7]*x*y;
-        dBdz->z += rbf->gz_new[1] + rbf->gz_new[3]*y + rbf->gz_new[5]*x + rbf->gz_new[7]*x*y;
-    }
+    if ( rbf->DoPoly ) Vec_RBF_AddPoly( v, NULL, dBdx, dBdy, dBdz, rbf );
 
 
     return;
@@ -904,3 +1173,436 @@ void    Lgm_Vec_RBF_Derivs_Eval( Lgm_Vector *v, Lgm_Vector *dBdx, Lgm_Vector *dB
 }
 
 
+
+
+
+/**  Compute the vector interpolant and its derivatives at the specified
+ *   position vector. Gives the same results as Lgm_Vec_RBF_Eval() followed by
+ *   Lgm_Vec_RBF_Derivs_Eval(), but (for the Gaussian and multiquadric RBFs)
+ *   does it in a single pass over the centres.
+ *
+ *
+ *  \param[in]         v   -   position vector to compute B at.
+ *  \param[out]        B   -   interpolated value of B at v.
+ *  \param[out]     dBdx   -   interpolated value of dB/dx at v.
+ *  \param[out]     dBdy   -   interpolated value of dB/dy at v.
+ *  \param[out]     dBdz   -   interpolated value of dB/dz at v.
+ *  \param[in]       rbf   -   pointer to initialized Lgm_Vec_RBF_Info structure.
+ *
+ *  \return  void
+ *
+ */
+void    Lgm_Vec_RBF_EvalAll( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *dBdx, Lgm_Vector *dBdy, Lgm_Vector *dBdz, Lgm_Vec_RBF_Info *rbf ) {
+
+    double      S[12];
+
+    if ( !Vec_RBF_HaveKernel( rbf ) ) {
+        Lgm_Vec_RBF_Eval( v, B, rbf );
+        Lgm_Vec_RBF_Derivs_Eval( v, dBdx, dBdy, dBdz, rbf );
+        return;
+    }
+
+    Vec_RBF_Kernel( v->x, v->y, v->z, rbf, TRUE, S );
+    B->x    = S[0]; B->y    = S[1];  B->z    = S[2];
+    dBdx->x = S[3]; dBdx->y = S[4];  dBdx->z = S[5];
+    dBdy->x = S[6]; dBdy->y = S[7];  dBdy->z = S[8];
+    dBdz->x = S[9]; dBdz->y = S[10]; dBdz->z = S[11];
+    if ( rbf->DoPoly ) Vec_RBF_AddPoly( v, B, dBdx, dBdy, dBdz, rbf );
+
+    B->x += rbf->Bx0;
+    B->y += rbf->By0;
+    B->z += rbf->Bz0;
+
+    return;
+
+}
+
+
+
+
+
+
+/*
+ *  Workspace based fitting (Lgm_Vec_RBF_Fit()).
+ *
+ *  A factorization of the RBF matrix is kept in the Lgm_Vec_RBF_Work along
+ *  with the points it was made for. When the system is symmetric positive
+ *  definite (a positive definite kernel and the same eps for every point),
+ *  a Cholesky factorization is used, and successive fits that share all but
+ *  one point (as happens between neighboring steps along a trace) update it
+ *  rather than refactoring. Otherwise an LU factorization with partial
+ *  pivoting is used. Either way, all three components are solved against
+ *  the one factorization, and nothing is allocated.
+ */
+#define RBF_W( w, i, j )    ( (w)->L[ (long int)(i)*(w)->nMax + (j) ] )
+
+/*
+ *  Kernels that give a positive definite matrix in 3D. (The multiquadrics
+ *  do not, and note that LGM_RBF_INV_MULTIQUADRIC is currently evaluated
+ *  with the same formula as LGM_RBF_MULTIQUADRIC.)
+ */
+static int RBF_IsPositiveDefinite( int RadialBasisFunction ) {
+    return( ( RadialBasisFunction == LGM_RBF_GAUSSIAN )   || ( RadialBasisFunction == LGM_RBF_WENDLAND30 )
+         || ( RadialBasisFunction == LGM_RBF_WENDLAND31 ) || ( RadialBasisFunction == LGM_RBF_WENDLAND32 )
+         || ( RadialBasisFunction == LGM_RBF_WENDLAND33 ) );
+}
+
+static int RBF_SamePoint( Lgm_Vector *a, Lgm_Vector *b ) {
+    return( ( a->x == b->x ) && ( a->y == b->y ) && ( a->z == b->z ) );
+}
+
+
+/** Allocate a workspace for Lgm_Vec_RBF_Fit().
+ *
+ *  \param[in]      nMax  -   largest number of points that will be fit with it.
+ *
+ *  \return  pointer to the workspace. Free with Lgm_Vec_RBF_FreeWork().
+ *
+ */
+Lgm_Vec_RBF_Work *Lgm_Vec_RBF_AllocWork( int nMax ) {
+
+    Lgm_Vec_RBF_Work *w;
+
+    w = (Lgm_Vec_RBF_Work *)calloc( 1, sizeof(Lgm_Vec_RBF_Work) );
+    w->nMax = nMax;
+    w->n    = 0;
+    LGM_ARRAY_1D( w->v,     nMax, Lgm_Vector );
+    LGM_ARRAY_1D( w->Map,   nMax, int );
+    LGM_ARRAY_1D( w->Perm,  nMax, int );
+    LGM_ARRAY_1D( w->L,     (long int)nMax*nMax, double );
+    LGM_ARRAY_1D( w->b,     3*nMax, double );
+    LGM_ARRAY_1D( w->Col,   nMax, double );
+
+    return( w );
+
+}
+
+void Lgm_Vec_RBF_FreeWork( Lgm_Vec_RBF_Work *w ) {
+    if ( w == NULL ) return;
+    LGM_ARRAY_1D_FREE( w->v );
+    LGM_ARRAY_1D_FREE( w->Map );
+    LGM_ARRAY_1D_FREE( w->Perm );
+    LGM_ARRAY_1D_FREE( w->L );
+    LGM_ARRAY_1D_FREE( w->b );
+    LGM_ARRAY_1D_FREE( w->Col );
+    free( w );
+}
+
+
+/** Allocate an Lgm_Vec_RBF_Info with room for fits of up to nMax points by
+ *  Lgm_Vec_RBF_Fit(). It can be refit any number of times, and is freed
+ *  with Lgm_Vec_RBF_Free().
+ *
+ */
+Lgm_Vec_RBF_Info *Lgm_Vec_RBF_AllocInfo( int nMax ) {
+
+    unsigned long int Bytes;
+    Lgm_Vec_RBF_Info *rbf;
+
+    Bytes = sizeof(*rbf);
+    rbf = ( Lgm_Vec_RBF_Info *)calloc( 1, Bytes );
+    rbf->DoPoly = FALSE;
+
+    LGM_ARRAY_1D( rbf->LookUpKey, nMax, unsigned long int); Bytes += nMax*sizeof( unsigned long int );
+    LGM_ARRAY_1D( rbf->v,      nMax, Lgm_Vector);           Bytes += nMax*sizeof( Lgm_Vector );
+    LGM_ARRAY_1D( rbf->vx,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->vy,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->vz,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->eps_x,  nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->eps_y,  nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->eps_z,  nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cx,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cy,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cz,     nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cx_new, nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cy_new, nMax, double);               Bytes += nMax*sizeof( double );
+    LGM_ARRAY_1D( rbf->cz_new, nMax, double);               Bytes += nMax*sizeof( double );
+
+    rbf->size = (double)Bytes/1.0e6;
+
+    return( rbf );
+
+}
+
+
+/*
+ *  In place Cholesky factorization of the n x n matrix in w->L (lower
+ *  triangle), starting at row k0 (rows before that are already factored).
+ */
+static int RBF_Cholesky( Lgm_Vec_RBF_Work *w, int k0, int n ) {
+
+    int     i, j, k;
+    double  sum;
+
+    for ( i=k0; i<n; i++ ) {
+        for ( j=0; j<=i; j++ ) {
+            for ( sum=RBF_W(w,i,j), k=0; k<j; k++ ) sum -= RBF_W(w,i,k)*RBF_W(w,j,k);
+            if ( i == j ) {
+                if ( sum <= 0.0 ) return( FALSE );
+                RBF_W(w,i,i) = sqrt( sum );
+            } else {
+                RBF_W(w,i,j) = sum/RBF_W(w,j,j);
+            }
+        }
+    }
+
+    return( TRUE );
+
+}
+
+/*
+ *  Remove row/column k from the Cholesky factor in w->L. The trailing
+ *  block gets a rank-one update with what was column k below the diagonal.
+ */
+static void RBF_CholeskyDelete( Lgm_Vec_RBF_Work *w, int k ) {
+
+    int     i, j, n = w->n;
+    double  *x = w->Col, r, c, s, Lii, Lji;
+
+    for ( i=k+1; i<n; i++ ) x[i] = RBF_W(w,i,k);
+
+    for ( i=k+1; i<n; i++ ) {
+        Lii = RBF_W(w,i,i);
+        r   = sqrt( Lii*Lii + x[i]*x[i] );
+        c   = r/Lii;
+        s   = x[i]/Lii;
+        RBF_W(w,i,i) = r;
+        for ( j=i+1; j<n; j++ ) {
+            Lji = ( RBF_W(w,j,i) + s*x[j] )/c;
+            x[j] = c*x[j] - s*Lji;
+            RBF_W(w,j,i) = Lji;
+        }
+    }
+
+    // close up the gap
+    for ( i=k; i<n-1; i++ ) {
+        for ( j=0; j<k; j++ )  RBF_W(w,i,j) = RBF_W(w,i+1,j);
+        for ( j=k; j<=i; j++ ) RBF_W(w,i,j) = RBF_W(w,i+1,j+1);
+        w->v[i]   = w->v[i+1];
+    }
+    --(w->n);
+
+}
+
+/*
+ *  In place LU factorization (with partial pivoting) of the n x n matrix in
+ *  w->L.
+ */
+static int RBF_LU( Lgm_Vec_RBF_Work *w, int n ) {
+
+    int     i, j, k, p;
+    double  Max, t, f;
+
+    for ( k=0; k<n; k++ ) {
+        for ( Max=0.0, p=k, i=k; i<n; i++ ) if ( fabs( RBF_W(w,i,k) ) > Max ) { Max = fabs( RBF_W(w,i,k) ); p = i; }
+        if ( Max == 0.0 ) return( FALSE );
+        w->Perm[k] = p;
+        if ( p != k ) for ( j=0; j<n; j++ ) { t = RBF_W(w,k,j); RBF_W(w,k,j) = RBF_W(w,p,j); RBF_W(w,p,j) = t; }
+        for ( i=k+1; i<n; i++ ) {
+            f = RBF_W(w,i,k) /= RBF_W(w,k,k);
+            for ( j=k+1; j<n; j++ ) RBF_W(w,i,j) -= f*RBF_W(w,k,j);
+        }
+    }
+
+    return( TRUE );
+
+}
+
+
+/** Fit an Lgm_Vec_RBF_Info to a vector-field dataset without allocating
+ *  anything. This is the same fit as Lgm_Vec_RBF_Init() does with DoPoly
+ *  FALSE.
+ *
+ *  If the kernel is positive definite and eps_x, eps_y and eps_z are each
+ *  the same for all points, the RBF matrix is symmetric positive definite
+ *  and a Cholesky factorization is used. If the previous fit done with w was
+ *  of the same kind and the points differ from its points by one point at
+ *  most, the factorization is updated (O(n^2)) instead of being redone
+ *  (O(n^3)). Otherwise an LU factorization is done. (Points are matched by
+ *  position, so the order they are given in does not matter.)
+ *
+ *
+ *  \param[in]                  I_data   -   Id's of the points (stored as rbf->LookUpKey).
+ *  \param[in]                       v   -   pointer to an array of position vectors.
+ *  \param[in]                       B   -   pointer to array of corresponding field vectors.
+ *  \param[in]     eps_x, eps_y, eps_z   -   smoothing factors in scalar RBF.
+ *  \param[in]                       n   -   number of (v, B) pairs defined.
+ *  \param[in]      RadialBasisFunction  -   RBF to use.
+ *  \param[out]                    rbf   -   Result (from Lgm_Vec_RBF_AllocInfo() with nMax >= n).
+ *  \param[in,out]                   w   -   Workspace (from Lgm_Vec_RBF_AllocWork() with nMax >= n).
+ *
+ *  \return  TRUE if the fit succeeded, FALSE if n is too big for w or the
+ *           system is singular.
+ *
+ */
+int Lgm_Vec_RBF_Fit( unsigned long int *I_data, Lgm_Vector *v, Lgm_Vector *B, double *eps_x, double *eps_y, double *eps_z, int n, int RadialBasisFunction, Lgm_Vec_RBF_Info *rbf, Lgm_Vec_RBF_Work *w ) {
+
+    int     i, j, k, c, m, k_out, j_in, nOut, nIn, Uniform, Done;
+    double  Psi, sum, *b;
+
+    if ( ( n < 1 ) || ( n > w->nMax ) ) return( FALSE );
+
+    for ( Uniform = TRUE, i=1; i<n; i++ ) {
+        if ( ( eps_x[i] != eps_x[0] ) || ( eps_y[i] != eps_y[0] ) || ( eps_z[i] != eps_z[0] ) ) { Uniform = FALSE; break; }
+    }
+
+    Done = FALSE;
+    if ( Uniform && RBF_IsPositiveDefinite( RadialBasisFunction ) ) {
+
+        /*
+         *  See how the points compare to the ones already factored. Map[i]
+         *  is where (in factorization order) point i is, or -1.
+         */
+        nOut = nIn = 0; k_out = j_in = -1;
+        if ( w->Cholesky && ( w->n == n ) && ( w->RadialBasisFunction == RadialBasisFunction )
+                && ( w->eps_x == eps_x[0] ) && ( w->eps_y == eps_y[0] ) && ( w->eps_z == eps_z[0] ) ) {
+            for ( k=0; k<w->n; k++ ) w->Perm[k] = FALSE;   // (used here as "factored point k is still wanted")
+            for ( i=0; i<n; i++ ) {
+                for ( w->Map[i] = -1, k=0; k<w->n; k++ ) {
+                    if ( !w->Perm[k] && RBF_SamePoint( &v[i], &w->v[k] ) ) { w->Map[i] = k; w->Perm[k] = TRUE; break; }
+                }
+                if ( w->Map[i] < 0 ) { ++nIn; j_in = i; }
+            }
+            for ( k=0; k<w->n; k++ ) if ( !w->Perm[k] ) { ++nOut; k_out = k; }
+        } else {
+            nIn = nOut = n;
+        }
+
+        if ( nIn == 0 ) {
+
+            ++(w->nReuses);
+            Done = TRUE;
+
+        } else if ( nIn == 1 ) {
+
+            /*
+             *  Drop the point that left and append the new one as the last row.
+             */
+            RBF_CholeskyDelete( w, k_out );
+            m = w->n;
+            w->v[m] = v[j_in];
+            for ( k=0; k<=m; k++ ) {
+                Lgm_Vec_RBF_Psi2( &w->v[m], &w->v[k], eps_x[0], eps_y[0], eps_z[0], &Psi, RadialBasisFunction );
+                RBF_W(w,m,k) = Psi;
+            }
+            w->n = m+1;
+            if ( RBF_Cholesky( w, m, m+1 ) ) {
+                for ( i=0; i<n; i++ ) {
+                    for ( w->Map[i] = -1, k=0; k<w->n; k++ ) if ( RBF_SamePoint( &v[i], &w->v[k] ) ) { w->Map[i] = k; break; }
+                }
+                ++(w->nUpdates);
+                Done = TRUE;
+            }
+
+        }
+
+        if ( !Done ) {
+
+            // full factorization
+            for ( i=0; i<n; i++ ) {
+                w->v[i] = v[i]; w->Map[i] = i;
+                for ( j=0; j<=i; j++ ) {
+                    Lgm_Vec_RBF_Psi2( &v[i], &v[j], eps_x[j], eps_y[j], eps_z[j], &Psi, RadialBasisFunction );
+                    RBF_W(w,i,j) = Psi;
+                }
+            }
+            w->n = n;
+            w->Cholesky = TRUE;
+            w->RadialBasisFunction = RadialBasisFunction;
+            w->eps_x = eps_x[0]; w->eps_y = eps_y[0]; w->eps_z = eps_z[0];
+            if ( RBF_Cholesky( w, 0, n ) ) {
+                ++(w->nFull);
+                Done = TRUE;
+            } else {
+                w->n = 0; // not positive definite (to round-off) after all. Go on to LU.
+            }
+
+        }
+
+        if ( Done ) {
+            /*
+             *  Solve L L^T c = b for all three components, in factorization order.
+             */
+            b = w->b;
+            for ( i=0; i<n; i++ ) {
+                k = w->Map[i];
+                b[3*k] = B[i].x; b[3*k+1] = B[i].y; b[3*k+2] = B[i].z;
+            }
+            for ( c=0; c<3; c++ ) {
+                for ( i=0; i<n; i++ ) {
+                    for ( sum=b[3*i+c], k=0; k<i; k++ ) sum -= RBF_W(w,i,k)*b[3*k+c];
+                    b[3*i+c] = sum/RBF_W(w,i,i);
+                }
+                for ( i=n-1; i>=0; i-- ) {
+                    for ( sum=b[3*i+c], k=i+1; k<n; k++ ) sum -= RBF_W(w,k,i)*b[3*k+c];
+                    b[3*i+c] = sum/RBF_W(w,i,i);
+                }
+            }
+        }
+
+    }
+
+    if ( !Done ) {
+
+        /*
+         *  General (non-symmetric) system: A[i][j] = Psi( v_i - v_j; eps_j ).
+         */
+        w->Cholesky = FALSE;
+        w->n        = 0;
+        for ( i=0; i<n; i++ ) {
+            for ( j=0; j<n; j++ ) {
+                Lgm_Vec_RBF_Psi2( &v[i], &v[j], eps_x[j], eps_y[j], eps_z[j], &Psi, RadialBasisFunction );
+                RBF_W(w,i,j) = Psi;
+            }
+        }
+        if ( !RBF_LU( w, n ) ) return( FALSE );
+        ++(w->nFull);
+
+        b = w->b;
+        for ( i=0; i<n; i++ ) {
+            w->Map[i] = i;
+            b[3*i] = B[i].x; b[3*i+1] = B[i].y; b[3*i+2] = B[i].z;
+        }
+        for ( c=0; c<3; c++ ) {
+            for ( i=0; i<n; i++ ) {
+                k = w->Perm[i];
+                if ( k != i ) { sum = b[3*i+c]; b[3*i+c] = b[3*k+c]; b[3*k+c] = sum; }
+            }
+            for ( i=0; i<n; i++ ) {
+                for ( sum=b[3*i+c], k=0; k<i; k++ ) sum -= RBF_W(w,i,k)*b[3*k+c];
+                b[3*i+c] = sum;
+            }
+            for ( i=n-1; i>=0; i-- ) {
+                for ( sum=b[3*i+c], k=i+1; k<n; k++ ) sum -= RBF_W(w,i,k)*b[3*k+c];
+                b[3*i+c] = sum/RBF_W(w,i,i);
+            }
+        }
+
+    }
+
+
+    /*
+     *  Store the result (in the caller's point order).
+     */
+    rbf->RadialBasisFunction = RadialBasisFunction;
+    rbf->n      = n;
+    rbf->DoPoly = FALSE;
+    rbf->Bx0 = rbf->By0 = rbf->Bz0 = 0.0;
+    for ( i=0; i<n; i++ ) {
+        k = w->Map[i];
+        rbf->LookUpKey[i] = I_data[i];
+        rbf->v[i]         = v[i];
+        rbf->vx[i]        = v[i].x;
+        rbf->vy[i]        = v[i].y;
+        rbf->vz[i]        = v[i].z;
+        rbf->eps_x[i]     = eps_x[i];
+        rbf->eps_y[i]     = eps_y[i];
+        rbf->eps_z[i]     = eps_z[i];
+        rbf->cx[i] = rbf->cx_new[i] = w->b[3*k];
+        rbf->cy[i] = rbf->cy_new[i] = w->b[3*k+1];
+        rbf->cz[i] = rbf->cz_new[i] = w->b[3*k+2];
+    }
+
+    return( TRUE );
+
+}
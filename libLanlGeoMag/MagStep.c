@@ -14,11 +14,17 @@
  *
  */
 #include <math.h>
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_VecInline.h"
+#include "Lgm/Lgm_MagStepKernels.h"
 
 #define FMAX(a,b)  (((a)>(b))?(a):(b))
 #define FMIN(a,b)  (((a)<(b))?(a):(b))
 
+static void Lgm_MagStep_DenseAdd( Lgm_Vector *, Lgm_Vector *, double, double, int,
+                int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo * );
+
 int Lgm_MagStep( Lgm_Vector *u, Lgm_Vector *u_scale,
           double Htry, double *Hdid, double *Hnext,
           double sgn, double *s, int *reset,
@@ -26,6 +32,13 @@ int Lgm_MagStep( Lgm_Vector *u, Lgm_Vector *u_scale,
 
     Lgm_Vector u0;
     double  eps;
+    int     Flag;
+
+    /*
+     *  A reset starts a new trace (possibly with a different field), so any
+     *  dense output history we have is no good anymore.
+     */
+    if ( *reset ) Lgm_MagStep_ClearDense( Info );
 
     u0 = *u;
     if (        Info->Lgm_MagStep_Integrator == LGM_MAGSTEP_ODE_BS ) {
@@ -34,20 +47,26 @@ int Lgm_MagStep( Lgm_Vector *u, Lgm_Vector *u_scale,
 //exit(0);
 //Info->Lgm_MagStep_BS_Eps = 1e-7;
         eps = Info->Lgm_MagStep_BS_Eps;
-        Lgm_MagStep_BS( u, u_scale, Htry, Hdid, Hnext, eps, sgn, s, reset, Mag, Info );
+        Flag = Lgm_MagStep_BS( u, u_scale, Htry, Hdid, Hnext, eps, sgn, s, reset, Mag, Info );
 
     } else if ( Info->Lgm_MagStep_Integrator == LGM_MAGSTEP_ODE_RK5 ) {
 
         eps = Info->Lgm_MagStep_RK5_Eps;
-        Lgm_MagStep_RK5( u, u_scale, Htry, Hdid, Hnext, eps, sgn, s, reset, Mag, Info );
+        Flag = Lgm_MagStep_RK5( u, u_scale, Htry, Hdid, Hnext, eps, sgn, s, reset, Mag, Info );
+
+    } else if ( Info->Lgm_MagStep_Integrator == LGM_MAGSTEP_ODE_DP8 ) {
+
+        Flag = Lgm_MagStep_DP8( u, u_scale, Htry, Hdid, Hnext, 0.0, sgn, s, reset, Mag, Info );
 
     } else {
 
-        printf("Lgm_MagStep: Error. Unknown ODE solver. Info->Lgm_MagStep_Integrator must be either LGM_MAGSTEP_ODE_BS or LGM_MAGSTEP_ODE_RK5\n");
+        printf("Lgm_MagStep: Error. Unknown ODE solver. Info->Lgm_MagStep_Integrator must be one of LGM_MAGSTEP_ODE_BS, LGM_MAGSTEP_ODE_RK5 or LGM_MAGSTEP_ODE_DP8\n");
         return(-1);
 
     }
 
+    if ( Info->Lgm_MagStep_DenseOutput ) Lgm_MagStep_DenseAdd( &u0, u, *Hdid, sgn, Flag, Mag, Info );
+
 
     return(1);
 
@@ -56,98 +75,352 @@ int Lgm_MagStep( Lgm_Vector *u, Lgm_Vector *u_scale,
 
 
 
+/*
+ *  Dense output for Lgm_MagStep().
+ *
+ *  When Info->Lgm_MagStep_DenseOutput is TRUE, every accepted step from u0 to
+ *  u1 is kept as a cubic Hermite segment built from u0, u1 and the unit
+ *  tangents f0 = sgn*Bhat(u0), f1 = sgn*Bhat(u1). The integrator already
+ *  evaluates Bhat(u0), and Bhat(u1) is what the next step evaluates at its
+ *  starting point, so keeping the history costs nothing when the steps chain
+ *  on from one another. (If a segment is needed before the next step is
+ *  taken, the end tangent costs one evaluation, which the next step then
+ *  reuses.) Points between the ends of a step then come for free, which is
+ *  what the bracketing searches (min-B, mirror points, zero crossings)
+ *  need.
+ *
+ *  The interpolation error is estimated from the angle the tangent turns
+ *  through over the step. For a circular arc of length h turning through
+ *  theta, the cubic Hermite error is h*theta^3/384 to leading order.
+ */
+void Lgm_MagStep_SetDenseOutput( int Flag, Lgm_MagModelInfo *Info ) {
+    Info->Lgm_MagStep_DenseOutput = Flag;
+    Lgm_MagStep_ClearDense( Info );
+}
 
+void Lgm_MagStep_ClearDense( Lgm_MagModelInfo *Info ) {
+    Info->Lgm_MagStep_nDense       = 0;
+    Info->Lgm_MagStep_iDense       = 0;
+    Info->Lgm_MagStep_Dense_bValid = FALSE;
+    Info->Lgm_MagStep_Dense_Mag    = NULL;
+}
 
-int Lgm_ModMid( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn,
-         int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+/*
+ *  Forget everything the integrators (and the I and Sb integrands) carried
+ *  over from earlier calls -- step size and order guesses, the DP8 error
+ *  history and FSAL tangent, and the dense output -- so that the next trace
+ *  starts the same way it would on a freshly set up Info. The settings
+ *  (tolerances etc.) are left alone.
+ */
+void Lgm_MagStep_ResetState( Lgm_MagModelInfo *Info ) {
 
-    int            m;
-    double        h2, h, Bmag;
-    Lgm_Vector    z0, z1, z2, B;
+    Info->Lgm_MagStep_BS_FirstTimeThrough  = TRUE;
+    Info->Lgm_MagStep_BS_eps_old           = -1.0;
+    Info->Lgm_MagStep_BS_first_step        = TRUE;
+    Info->Lgm_MagStep_BS_last_step         = FALSE;
+    Info->Lgm_MagStep_BS_reject            = FALSE;
+    Info->Lgm_MagStep_BS_prev_reject       = FALSE;
 
+    Info->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
+    Info->Lgm_MagStep_RK5_snew             = 0.0;
 
-    /*
-     *  Set stepsize, h and 2*h.
-     */
-    h  = sgn * H/(double)n;
-    h2 = 2.0 * h;
-//printf("h=%g\n", h);
+    Info->Lgm_MagStep_DP8_ErrOld           = 1e-4;
+    Info->Lgm_MagStep_DP8_bValid           = FALSE;
 
+    Info->Lgm_VelStep_FirstTimeThrough     = TRUE;
+    Info->Lgm_I_integrand_FirstCall        = TRUE;
+    Info->Lgm_Sb_integrand_FirstCall       = TRUE;
 
-    /*
-     *  Set initial point, z0.
-     */
-    z0 = *u;
+    Lgm_MagStep_ClearDense( Info );
 
+}
 
-    /*
-     *  Do initial Euler step to get z1. We get b0 from the arg list (its computed once).
-     */
-    z1.x = z0.x + h*b0->x;
-    z1.y = z0.y + h*b0->y;
-    z1.z = z0.z + h*b0->z;
+/*
+ *  Returns TRUE (and the unit tangent in b) if we already have Bhat at u from
+ *  the end of the previous step.
+ */
+int Lgm_MagStep_TangentAt( Lgm_Vector *u, Lgm_Vector *b, int reset, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+    if ( !Info->Lgm_MagStep_DenseOutput || reset || !Info->Lgm_MagStep_Dense_bValid ) return( FALSE );
+    if ( Info->Lgm_MagStep_Dense_Mag != (int (*)())Mag ) return( FALSE );
+    if ( ( u->x != Info->Lgm_MagStep_Dense_P.x ) || ( u->y != Info->Lgm_MagStep_Dense_P.y ) || ( u->z != Info->Lgm_MagStep_Dense_P.z ) ) return( FALSE );
+
+    *b = Info->Lgm_MagStep_Dense_b;
+    return( TRUE );
 
+}
+
+/*
+ *  Fill in the end tangent of a segment (and with it the error estimate).
+ */
+static void Lgm_MagStep_DenseSetEnd( Lgm_MagStep_DenseSeg *Seg, Lgm_Vector *b1 ) {
+
+    Lgm_Vector  d;
+    double      theta;
+
+    Seg->f1.x = Seg->sgn*b1->x; Seg->f1.y = Seg->sgn*b1->y; Seg->f1.z = Seg->sgn*b1->z;
+    Lgm_VecSub( &d, &Seg->f1, &Seg->f0 );
+    theta = 0.5*Lgm_Magnitude( &d );
+    theta = 2.0*asin( (theta > 1.0) ? 1.0 : theta );
+    Seg->Err    = fabs(Seg->h)*theta*theta*theta/384.0;
+    Seg->Have_f1 = TRUE;
+
+}
+
+static void Lgm_MagStep_KeepTangent( Lgm_Vector *u, Lgm_Vector *b, int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+    Lgm_MagStep_DenseSeg    *Seg;
+
+    if ( !Info->Lgm_MagStep_DenseOutput ) return;
+
+    // history from some other field routine is no good to us.
+    if ( ( Info->Lgm_MagStep_nDense > 0 ) && ( Info->Lgm_MagStep_Dense_Mag != (int (*)())Mag ) ) Lgm_MagStep_ClearDense( Info );
+
+    Info->Lgm_MagStep_Dense_P      = *u;
+    Info->Lgm_MagStep_Dense_b      = *b;
+    Info->Lgm_MagStep_Dense_Mag    = (int (*)())Mag;
+    Info->Lgm_MagStep_Dense_bValid = TRUE;
 
     /*
-     *  Do general step to get z2 -> zn. This is midpoint formula.
+     *  If this is the start of a step that continues on from the last one,
+     *  we just got the end tangent of the last one for free.
      */
-    for ( m = 1; m < n; ++m ) {
+    if ( Info->Lgm_MagStep_nDense > 0 ) {
+        Seg = &Info->Lgm_MagStep_DenseSegs[ Info->Lgm_MagStep_iDense ];
+        if ( !Seg->Have_f1 && ( u->x == Seg->u1.x ) && ( u->y == Seg->u1.y ) && ( u->z == Seg->u1.z ) ) Lgm_MagStep_DenseSetEnd( Seg, b );
+    }
 
-        if ( (*Mag)(&z1, &B, Info) == 0 ) {
-            // bail if B-field eval had issues.
-            printf("Lgm_ModMid(): B-field evaluation during midpoint phase (m = %d and z1 = %g %g %g) returned with errors (returning with 0)\n", m, z1.x, z1.y, z1.z );
-            return(0);
-        }
-        ++(Info->Lgm_nMagEvals);
-        Bmag = Lgm_NormalizeVector(&B);
-        if ( Bmag < 1e-16 ) {
-            // bail if B-field magnitude is too small
-            printf("Lgm_ModMid(): Bmag too small during midpoint phase (m = %d and z1 = %g %g %g Bmag = %g) is too small (returning with 0).\n", m, z1.x, z1.y, z1.z, Bmag );
-            return(0);
-        }
-        z2.x = z0.x + h2*B.x;
-        z2.y = z0.y + h2*B.y;
-        z2.z = z0.z + h2*B.z;
-        z0 = z1;
-        z1 = z2;
+}
+
+/*
+ *  Make sure a segment has its end tangent. This costs a field evaluation
+ *  only if no step has been started from the end of the segment yet.
+ */
+static int Lgm_MagStep_DenseFinish( Lgm_MagStep_DenseSeg *Seg, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector  b1;
+    int         (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *);
+
+    if ( Seg->Have_f1 ) return( TRUE );
 
+    Mag = (int (*)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *))Info->Lgm_MagStep_Dense_Mag;
+    if ( !Lgm_MagStep_TangentAt( &Seg->u1, &b1, FALSE, Mag, Info ) ) {
+        if ( (Mag == NULL) || ( (*Mag)( &Seg->u1, &b1, Info ) == 0 ) ) return( FALSE );
+        ++(Info->Lgm_nMagEvals);
+        if ( Lgm_NormalizeVector( &b1 ) < 1e-16 ) return( FALSE );
+        Lgm_MagStep_KeepTangent( &Seg->u1, &b1, Mag, Info );
     }
+    Lgm_MagStep_DenseSetEnd( Seg, &b1 );
+
+    return( TRUE );
+
+}
 
+static void Lgm_MagStep_DenseAdd( Lgm_Vector *u0, Lgm_Vector *u1, double h, double sgn, int Flag,
+                int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+    Lgm_MagStep_DenseSeg    *Seg;
+    Lgm_Vector              b0;
+    int                     i;
 
     /*
-     *  Do final Euler step to get z(n+1).
+     *  The integrator left Bhat(u0) in the tangent cache. If it isnt
+     *  there (or we didnt go anywhere), the step failed somewhere and we
+     *  drop the history.
      */
-    if ( (*Mag)(&z1, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_ModMid(): B-field evaluation during final Euler step (z1 = %g %g %g) returned with errors (returning with 0)\n", z1.x, z1.y, z1.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_ModMid(): Bmag too small during final Euler step (z1 = %g %g %g B = %g %g %g Bmag = %g) is too small (returning with 0).\n", z1.x, z1.y, z1.z, B.x, B.y, B.z, Bmag );
-//printf("z0, z1 = %g %g %g    %g %g %g   z2 = %g %g %g\n", z0.x, z0.y, z0.z, z1.x, z1.y, z1.z, z2.x, z2.y, z2.z );
-
-        return(0);
+    if ( ( Flag <= 0 ) || ( ( u1->x == u0->x ) && ( u1->y == u0->y ) && ( u1->z == u0->z ) )
+            || !Lgm_MagStep_TangentAt( u0, &b0, FALSE, Mag, Info ) ) {
+        Lgm_MagStep_ClearDense( Info );
+        return;
     }
-    z2.x = z1.x + h*B.x;
-    z2.y = z1.y + h*B.y;
-    z2.z = z1.z + h*B.z;
 
+    i = ( Info->Lgm_MagStep_nDense > 0 ) ? (Info->Lgm_MagStep_iDense + 1)%LGM_MAGSTEP_NDENSE : 0;
+    Seg = &Info->Lgm_MagStep_DenseSegs[i];
+    Seg->u0  = *u0;
+    Seg->u1  = *u1;
+    Seg->f0.x = sgn*b0.x; Seg->f0.y = sgn*b0.y; Seg->f0.z = sgn*b0.z;
+    Seg->h   = h;
+    Seg->sgn = sgn;
+    Seg->Have_f1 = FALSE;   // filled in by the next step (or by Lgm_MagStep_DenseFinish() if it is needed first)
+    Seg->Err = 0.0;
+
+    Info->Lgm_MagStep_iDense = i;
+    if ( Info->Lgm_MagStep_nDense < LGM_MAGSTEP_NDENSE ) ++(Info->Lgm_MagStep_nDense);
+
+}
+
+/*
+ *  Copy out the most recent accepted step. Returns FALSE if there isnt one.
+ */
+int Lgm_MagStep_DenseLast( Lgm_MagStep_DenseSeg *Seg, Lgm_MagModelInfo *Info ) {
+
+    if ( !Info->Lgm_MagStep_DenseOutput || ( Info->Lgm_MagStep_nDense < 1 ) ) return( FALSE );
+    if ( !Lgm_MagStep_DenseFinish( &Info->Lgm_MagStep_DenseSegs[ Info->Lgm_MagStep_iDense ], Info ) ) return( FALSE );
+    *Seg = Info->Lgm_MagStep_DenseSegs[ Info->Lgm_MagStep_iDense ];
+    return( TRUE );
+
+}
+
+/*
+ *  Evaluate a segment a distance ds (signed like Seg->h) from its start.
+ *  Returns FALSE if ds isnt inside the segment.
+ */
+int Lgm_MagStep_DenseSegEval( Lgm_MagStep_DenseSeg *Seg, double ds, Lgm_Vector *u ) {
+
+    double  t, t2, t3, h00, h10, h01, h11, h;
+
+    h = Seg->h;
+    if ( fabs(h) < 1e-16 ) return( FALSE );
+    t = ds/h;
+    if ( ( t < -1e-9 ) || ( t > 1.0+1e-9 ) ) return( FALSE );
+
+    t2 = t*t; t3 = t2*t;
+    h00 =  2.0*t3 - 3.0*t2 + 1.0;
+    h10 =      t3 - 2.0*t2 + t;
+    h01 = -2.0*t3 + 3.0*t2;
+    h11 =      t3 -     t2;
+    h10 *= h; h11 *= h;
+
+    u->x = h00*Seg->u0.x + h10*Seg->f0.x + h01*Seg->u1.x + h11*Seg->f1.x;
+    u->y = h00*Seg->u0.y + h10*Seg->f0.y + h01*Seg->u1.y + h11*Seg->f1.y;
+    u->z = h00*Seg->u0.z + h10*Seg->f0.z + h01*Seg->u1.z + h11*Seg->f1.z;
+
+    return( TRUE );
+
+}
+
+/*
+ *  Find the point a distance ds along the field line from P0 (stepping with
+ *  the given sgn) using only the dense output history. P0 must be the start
+ *  of a step that is still in the history (e.g. one end of a bracket that
+ *  was found by stepping) and the steps from there on must cover ds.
+ *
+ *  Returns TRUE and the point in u if this works and the estimated
+ *  interpolation error is no more than Info->Lgm_MagStep_DenseTol. Otherwise
+ *  returns FALSE and the caller should step there with Lgm_MagStep() as
+ *  usual.
+ */
+int Lgm_MagStep_DenseEval( Lgm_Vector *P0, double ds, double sgn, Lgm_Vector *u, Lgm_MagModelInfo *Info ) {
+
+    Lgm_MagStep_DenseSeg    *Seg, *Next;
+    int                     n, nDense, i, j, k, ii;
+    double                  r;
 
+    if ( !Info->Lgm_MagStep_DenseOutput ) return( FALSE );
+    nDense = Info->Lgm_MagStep_nDense;
+    if ( nDense < 1 ) return( FALSE );
+
+    if ( ds == 0.0 ) {
+        *u = *P0;
+        return( TRUE );
+    }
 
     /*
-     *   The final answer for zn is the average of z(n-1) and z(n+1).
+     *  Try candidate starting segments from newest to oldest. k counts steps
+     *  back from the newest one.
      */
-    v->x = 0.5 * (z0.x + z2.x);
-    v->y = 0.5 * (z0.y + z2.y);
-    v->z = 0.5 * (z0.z + z2.z);
-//printf("z0, z1 = %g %g %g    %g %g %g   v = %g %g %g\n", z0.x, z0.y, z0.z, z2.x, z2.y, z2.z, v->x, v->y, v->z );
+    for ( k=0; k<nDense; k++ ) {
 
+        i   = (Info->Lgm_MagStep_iDense - k + LGM_MAGSTEP_NDENSE)%LGM_MAGSTEP_NDENSE;
+        Seg = &Info->Lgm_MagStep_DenseSegs[i];
+        if ( ( Seg->u0.x != P0->x ) || ( Seg->u0.y != P0->y ) || ( Seg->u0.z != P0->z ) ) continue;
+        if ( ( Seg->sgn != sgn ) || ( Seg->h*ds < 0.0 ) ) continue;
 
-    return(1);
+        /*
+         *  Walk forward through contiguous steps until we reach ds.
+         */
+        r = ds; j = i;
+        for ( n=0; n<=k; n++ ) {
+            if ( fabs(r) <= fabs(Seg->h)*(1.0+1e-9) ) {
+                if ( !Lgm_MagStep_DenseFinish( Seg, Info ) || ( Seg->Err > Info->Lgm_MagStep_DenseTol ) ) return( FALSE );
+                return( Lgm_MagStep_DenseSegEval( Seg, r, u ) );
+            }
+            if ( j == Info->Lgm_MagStep_iDense ) break;
+            r  -= Seg->h;
+            ii  = (j+1)%LGM_MAGSTEP_NDENSE;
+            Next = &Info->Lgm_MagStep_DenseSegs[ii];
+            if ( ( Next->u0.x != Seg->u1.x ) || ( Next->u0.y != Seg->u1.y ) || ( Next->u0.z != Seg->u1.z ) ) break;
+            if ( ( Next->sgn != sgn ) || ( Next->h*ds < 0.0 ) ) break;
+            Seg = Next; j = ii;
+        }
+
+    }
+
+    return( FALSE );
+
+}
 
+
+
+
+/*
+ *  The generic integrator kernels (see Lgm_MagStepKernels.h). These call the
+ *  field through the Mag pointer.
+ */
+int Lgm_ModMid( Lgm_Vector *u, Lgm_Vector *b0, Lgm_Vector *v, double H, int n, double sgn,
+         int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+    return( Lgm_ModMid_Inline( u, b0, v, H, n, sgn, Mag, Info ) );
+}
+
+
+/*
+ *  The per-model instances of the kernels (LGM_MAGSTEP_KERNELS() in the
+ *  model's own file). Internal < 0 means any internal model.
+ */
+static const struct {
+    int             (*Bfield)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *);
+    int             Internal;
+    Lgm_ModMidFunc  ModMid;
+    Lgm_RKCKFunc    RKCK;
+} Lgm_MagStep_KernelTable[] = {
+    { Lgm_B_T89,  LGM_IGRF, Lgm_ModMid_T89_IGRF,  Lgm_RKCK_T89_IGRF  },
+    { Lgm_B_TS04, LGM_IGRF, Lgm_ModMid_TS04_IGRF, Lgm_RKCK_TS04_IGRF },
+    { Lgm_B_T96,  LGM_IGRF, Lgm_ModMid_T96_IGRF,  Lgm_RKCK_T96_IGRF  },
+    { Lgm_B_cdip, -1,       Lgm_ModMid_CDIP,      Lgm_RKCK_CDIP      },
+};
+
+/**
+ *  \brief
+ *      Pick the integrator kernels for a field routine.
+ *
+ *  \details
+ *      Sets Info->Lgm_MagStep_ModMid and Info->Lgm_MagStep_RKCK to the
+ *      instances compiled for Mag (and Info->InternalModel) if there are
+ *      any, and to Lgm_ModMid() and Lgm_RKCK() otherwise. Lgm_InitMagInfo()
+ *      and Lgm_MagModelInfo_Set_MagModel() call this, and Lgm_MagStep_BS()
+ *      and Lgm_MagStep_RK5() call it again whenever they are handed a
+ *      different field routine (or the internal model has changed), so
+ *      setting Info->Bfield directly is fine too.
+ *
+ *      \param[in]      Mag         The field routine.
+ *      \param[in,out]  Info        Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_MagStep_SelectKernels( int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+
+    int     i;
+
+    Info->Lgm_MagStep_Kernel_Mag      = (int (*)())Mag;
+    Info->Lgm_MagStep_Kernel_Internal = Info->InternalModel;
+    Info->Lgm_MagStep_ModMid          = Lgm_ModMid;
+    Info->Lgm_MagStep_RKCK            = Lgm_RKCK;
+
+    for ( i=0; i<(int)(sizeof(Lgm_MagStep_KernelTable)/sizeof(Lgm_MagStep_KernelTable[0])); i++ ) {
+        if ( ( Mag == Lgm_MagStep_KernelTable[i].Bfield ) && ( ( Lgm_MagStep_KernelTable[i].Internal < 0 ) || ( Lgm_MagStep_KernelTable[i].Internal == Info->InternalModel ) ) ) {
+            Info->Lgm_MagStep_ModMid = Lgm_MagStep_KernelTable[i].ModMid;
+            Info->Lgm_MagStep_RKCK   = Lgm_MagStep_KernelTable[i].RKCK;
+            break;
+        }
+    }
+
+}
+
+/*
+ *  Make sure Info's kernels are the ones for Mag.
+ */
+static inline void Lgm_MagStep_CheckKernels( int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+    if ( ( Info->Lgm_MagStep_Kernel_Mag != (int (*)())Mag ) || ( Info->Lgm_MagStep_Kernel_Internal != Info->InternalModel )
+            || ( Info->Lgm_MagStep_ModMid == NULL ) || ( Info->Lgm_MagStep_RKCK == NULL ) ) Lgm_MagStep_SelectKernels( Mag, Info );
 }
 
 
@@ -353,6 +626,7 @@ int Lgm_MagStep_BS( Lgm_Vector *u, Lgm_Vector *u_scale,
 
     if ( ( eps != Info->Lgm_MagStep_BS_eps_old ) || ( *reset ) ){
 
+        Info->Lgm_nMagEvalsTotal += Info->Lgm_nMagEvals;
         Info->Lgm_nMagEvals = 0;
         Info->Lgm_MagStep_BS_eps_old = eps;
         *s = 0.0;
@@ -375,23 +649,29 @@ int Lgm_MagStep_BS( Lgm_Vector *u, Lgm_Vector *u_scale,
 
 
 
+    LGM_STATS_STEP_BEGIN( Info, nEvals0 );
+    Lgm_MagStep_CheckKernels( Mag, Info );
+
     /*
      *  Evaluate at u0
      */
     u0 = *u;
-    if ( (*Mag)(&u0, &b0, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_MagStep(): B-field evaluation at u0 = %g %g %g returned with errors (returning with -1)\n", u0.x, u0.y, u0.z );
-        return(-1);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&b0);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_MagStep(): Bmag too small at u0 = %g %g %g (Bmag = %g; Bx,y,z = %g, %g, %g) (returning with -1).\n", u0.x, u0.y, u0.z, Bmag, b0.x, b0.y, b0.z );
+    if ( !Lgm_MagStep_TangentAt( &u0, &b0, *reset, Mag, Info ) ) {
+        if ( (*Mag)(&u0, &b0, Info) == 0 ) {
+            // bail if B-field eval had issues.
+            printf("Lgm_MagStep(): B-field evaluation at u0 = %g %g %g returned with errors (returning with -1)\n", u0.x, u0.y, u0.z );
+            return(-1);
+        }
+        ++(Info->Lgm_nMagEvals);
+        Bmag = Lgm_NormalizeVector(&b0);
+        if ( Bmag < 1e-16 ) {
+            // bail if B-field magnitude is too small
+            printf("Lgm_MagStep(): Bmag too small at u0 = %g %g %g (Bmag = %g; Bx,y,z = %g, %g, %g) (returning with -1).\n", u0.x, u0.y, u0.z, Bmag, b0.x, b0.y, b0.z );
 printf("Line %d\n", __LINE__ );
 exit(-1);
-        return(-1);
+            return(-1);
+        }
+        Lgm_MagStep_KeepTangent( &u0, &b0, Mag, Info );
     }
 
 
@@ -432,7 +712,7 @@ Info->Lgm_MagStep_BS_last_step = FALSE;
              * Do a modified midpoint call
              */
             //dy( ysav, h, k, yseq, ipt, derivs );
-            ModMidSuccessfull = Lgm_ModMid( &u0, &b0, &v, h, Seq[k], sgn, Mag, Info );
+            ModMidSuccessfull = Info->Lgm_MagStep_ModMid( &u0, &b0, &v, h, Seq[k], sgn, Mag, Info );
             if ( !ModMidSuccessfull ) return(-1); // bail if Lgm_ModMid() had issues.
             yseq[0] = v.x; yseq[1] = v.y; yseq[2] = v.z;
 
@@ -513,9 +793,15 @@ Info->Lgm_MagStep_BS_last_step = FALSE;
         } // Go back and try next k.
 
         // Arrive here from any break in for loop.
-        if ( Info->Lgm_MagStep_BS_reject ) Info->Lgm_MagStep_BS_prev_reject = TRUE;
+        if ( Info->Lgm_MagStep_BS_reject ) {
+            Info->Lgm_MagStep_BS_prev_reject = TRUE;
+            LGM_STATS_COUNT( Info, BS_Rejected );
+            LGM_STATS_STEP_REJECT( Info, LGM_MAGSTEP_ODE_BS );
+        }
 
     }   // Go back if step was rejected.
+    LGM_STATS_COUNT( Info, BS_Accepted );
+    LGM_STATS_STEP_ACCEPT( Info, LGM_MAGSTEP_ODE_BS, h, k, nEvals0 );
 
 
     u->x = y[0]; u->y = y[1]; u->z = y[2];
@@ -596,12 +882,15 @@ int Lgm_MagStep_RK5( Lgm_Vector *u, Lgm_Vector *u_scale,
 
 
     if (  *reset  ) {
+        Info->Lgm_nMagEvalsTotal += Info->Lgm_nMagEvals;
         Info->Lgm_nMagEvals = 0;
         Info->Lgm_MagStep_RK5_snew = 0.0;
         *s   = 0.0;
         Info->Lgm_MagStep_RK5_FirstTimeThrough = TRUE;
 
     }
+    LGM_STATS_STEP_BEGIN( Info, nEvals0 );
+    Lgm_MagStep_CheckKernels( Mag, Info );
 
     Count = 0;
     Done  = FALSE;
@@ -621,18 +910,21 @@ int Lgm_MagStep_RK5( Lgm_Vector *u, Lgm_Vector *u_scale,
 //yscal[1] = 100.0;
 //yscal[2] = 100.0;
 
-    // get b0
-    if ( (*Mag)(&u0, &b0, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RK5(): B-field evaluation (u = %g %g %g) returned with errors (returning with 0)\n", u0.x, u0.y, u0.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&b0);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RK5(): Bmag too small (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u0.x, u0.y, u0.z, Bmag );
-        return(0);
+    // get b0 (unless we already have it from the end of the last step)
+    if ( !Lgm_MagStep_TangentAt( &u0, &b0, *reset, Mag, Info ) ) {
+        if ( (*Mag)(&u0, &b0, Info) == 0 ) {
+            // bail if B-field eval had issues.
+            printf("Lgm_RK5(): B-field evaluation (u = %g %g %g) returned with errors (returning with 0)\n", u0.x, u0.y, u0.z );
+            return(0);
+        }
+        ++(Info->Lgm_nMagEvals);
+        Bmag = Lgm_NormalizeVector(&b0);
+        if ( Bmag < 1e-16 ) {
+            // bail if B-field magnitude is too small
+            printf("Lgm_RK5(): Bmag too small (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u0.x, u0.y, u0.z, Bmag );
+            return(0);
+        }
+        Lgm_MagStep_KeepTangent( &u0, &b0, Mag, Info );
     }
 
 
@@ -643,7 +935,7 @@ int Lgm_MagStep_RK5( Lgm_Vector *u, Lgm_Vector *u_scale,
          * Take a Cash-Karp Runge-Kutta step (take point from u0->v )
          */
 //printf("RK5 C-K: h = %g\n", h);
-        Lgm_RKCK( &u0, &b0, &v, h, sgn, yerr, Mag, Info );
+        Info->Lgm_MagStep_RKCK( &u0, &b0, &v, h, sgn, yerr, Mag, Info );
 
 
         /*
@@ -671,6 +963,8 @@ ErrMax = sqrt(ErrMax); //gets to RMS of scaled error
                 printf( "Lgm_MagStep2: Stepsize underflow in rkqs. h = %g\n", h );
                 return( -1 );
             }
+            LGM_STATS_COUNT( Info, RK5_Rejected );
+            LGM_STATS_STEP_REJECT( Info, LGM_MAGSTEP_ODE_RK5 );
 
         } else {
 
@@ -684,6 +978,9 @@ ErrMax = sqrt(ErrMax); //gets to RMS of scaled error
             *u     = v;
 //printf("Hdid = %g Hnext = %g START, FINAL, |DIFF| = %g %g %g   %g %g %g    %g\n", *Hdid, *Hnext, u0.x, u0.y, u0.z, u->x, u->y, u->z, Lgm_VecDiffMag( u, &u0 ) );
             Done   = TRUE;
+            LGM_STATS_COUNT( Info, RK5_Accepted );
+            LGM_STATS_STEP_ACCEPT( Info, LGM_MAGSTEP_ODE_RK5, h, -1, nEvals0 );
+            *reset = FALSE;
 
         }
 
@@ -697,205 +994,222 @@ ErrMax = sqrt(ErrMax); //gets to RMS of scaled error
 
 int Lgm_RKCK( Lgm_Vector *u0, Lgm_Vector *b0, Lgm_Vector *v, double h, double sgn, double *yerr,
             int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ) {
+    return( Lgm_RKCK_Inline( u0, b0, v, h, sgn, yerr, Mag, Info ) );
+}
 
 
-    int i;
-    double  a2=0.2, a3=0.3, a4=0.6, a5=1.0, a6=0.875;
-
-    double  b21 = 0.2;
-
-    // b31=3.0/40.0, b32=9.0/40.0;
-    double  b31 = 0.075;
-    double  b32 = 0.225;
-
-    // b41=3.0/10.0, b42=-9.0/10.0, b43=6.0/5.0;
-    double  b41 =  0.3;
-    double  b42 = -0.9;
-    double  b43 =  1.2;
-
-    //double  b51=-11.0/54.0, b52=2.5, b53=-70.0/27.0, b54=35.0/27.0;
-    double  b51 = -0.20370370370370370370;
-    double  b52 =  2.5;
-    double  b53 = -2.59259259259259259259;
-    double  b54 =  1.29629629629629629629;
-
-    //double  b61=1631.0/55296.0, b62=175.0/512.0, b63=575.0/13824.0, b64=44275.0/110592.0, b65=253.0/4096.0;
-    double  b61 = .02949580439814814814;
-    double  b62 = .341796875;
-    double  b63 = .04159432870370370370;
-    double  b64 = .40034541377314814814;
-    double  b65 = .061767578125;
-
-    //double  c1=37.0/378.0, c3=250.0/621.0, c4=125.0/594.0, c6=512.0/1771.0;
-    double  c1  = 0.09788359788359788359;
-    double  c3  = 0.40257648953301127214;
-    double  c4  = 0.21043771043771043771;
-    double  c6  = 0.28910220214568040654;
-
-    //double  dc1 = c1-2825.0/27648.0, dc3 = c3-18575.0/48384.0, dc4 = c4-13525.0/55296.0, dc5 = -277.00/14336.0, dc6 = c6-0.25;
-    double  dc1 = -0.00429377480158730159;
-    double  dc3 =  0.01866858609385783299; 
-    double  dc4 = -0.03415502683080808080;
-    double  dc5 = -0.01932198660714285714;
-    double  dc6 =  0.03910220214568040654;
-
-    double  ak1[3], ak2[3], ak3[3], ak4[3], ak5[3], ak6[3], y[3], yout[3], ytemp[3];
-
-    Lgm_Vector  u, B;
-    double      Bmag, H;
-
-
-    y[0]    = u0->x;
-    y[1]    = u0->y;
-    y[2]    = u0->z;
-
-
-    H = sgn*h;
-
-//printf("    In cash-karp step: H = %g\n", H);
-
-    // 1st step
-    ak1[0] = b0->x; ak1[1] = b0->y; ak1[2] = b0->z;
-    for ( i=0; i<3; i++ ) {
-        ytemp[i] = y[i] + b21*H*ak1[i]; //WHY DOESN'T ytemp GET USED IN NEXT CALL TO Mag?????
-    }
 
 
+/*
+ *  Coefficients for the Dormand-Prince 8(5,3) method. These are the ones used
+ *  in DOP853 (E. Hairer, S.P. Norsett and G. Wanner, "Solving Ordinary
+ *  Differential Equations I. Nonstiff Problems", 2nd ed., Springer, 1993).
+ *  The field is autonomous so the c_i are not needed.
+ */
+static const double DP8_a[12][11] = {
+    { 0.0 },
+    {  5.26001519587677318785587544488e-2 },
+    {  1.97250569845378994544595329183e-2,  5.91751709536136983633785987549e-2 },
+    {  2.95875854768068491816892993775e-2,  0.0,  8.87627564304205475450678981324e-2 },
+    {  2.41365134159266685502369798665e-1,  0.0, -8.84549479328286085344864962717e-1,  9.24834003261792003115737966543e-1 },
+    {  3.7037037037037037037037037037e-2,   0.0,  0.0,  1.70828608729473871279604482173e-1,  1.25467687566822425016691814123e-1 },
+    {  3.7109375e-2,                        0.0,  0.0,  1.70252211019544039314978060272e-1,  6.02165389804559606850219397283e-2, -1.7578125e-2 },
+    {  3.70920001185047927108779319836e-2,  0.0,  0.0,  1.70383925712239993810214054705e-1,  1.07262030446373284651809199168e-1, -1.53194377486244017527936158236e-2,
+       8.27378916381402288758473766002e-3 },
+    {  6.24110958716075717114429577812e-1,  0.0,  0.0, -3.36089262944694129406857109825,   -8.68219346841726006818189891453e-1,  2.75920996994467083049415600797e1,
+       2.01540675504778934086186788979e1,  -4.34898841810699588477366255144e1 },
+    {  4.77662536438264365890433908527e-1,  0.0,  0.0, -2.48811461997166764192642586468,   -5.90290826836842996371446475743e-1,  2.12300514481811942347288949897e1,
+       1.52792336328824235832596922938e1,  -3.32882109689848629194453265587e1, -2.03312017085086261358222928593e-2 },
+    { -9.3714243008598732571704021658e-1,   0.0,  0.0,  5.18637242884406370830023853209,    1.09143734899672957818500254654,   -8.14978701074692612513997267357,
+      -1.85200656599969598641566180701e1,   2.27394870993505042818970056734e1,  2.49360555267965238987089396762,   -3.0467644718982195003823669022 },
+    {  2.27331014751653820792359768449,     0.0,  0.0, -1.05344954667372501984066689879e1, -2.00087205822486249909675718444,   -1.79589318631187989172765950534e1,
+       2.79488845294199600508499808837e1,  -2.85899827713502369474065508674,   -8.87285693353062954433549289258,    1.23605671757943030647266201528e1,
+       6.43392746015763530355970484046e-1 } };
+
+// 8th order weights
+static const double DP8_b[12] = {  5.42937341165687622380535766363e-2, 0.0, 0.0, 0.0, 0.0, 4.45031289275240888144113950566, 1.89151789931450038304281599044,
+                                  -5.8012039600105847814672114227,    3.1116436695781989440891606237e-1, -1.52160949662516078556178806805e-1,
+                                   2.01365400804030348374776537501e-1, 4.47106157277725905176885569043e-2 };
+
+// b minus the 5th order weights
+static const double DP8_e5[12] = {  0.1312004499419488073250102996e-1, 0.0, 0.0, 0.0, 0.0, -0.1225156446376204440720569753e+1, -0.4957589496572501915214079952,
+                                    0.1664377182454986536961530415e+1, -0.3503288487499736816886487290, 0.3341791187130174790297318841,
+                                    0.8192320648511571246570742613e-1, -0.2235530786388629525884427845e-1 };
+
+// b minus the 3rd order weights (the 3rd order ones only use k1, k9 and k12)
+static const double DP8_e3[12] = {  5.42937341165687622380535766363e-2 - 0.244094488188976377952755905512, 0.0, 0.0, 0.0, 0.0,
+                                    4.45031289275240888144113950566, 1.89151789931450038304281599044, -5.8012039600105847814672114227,
+                                    3.1116436695781989440891606237e-1 - 0.733846688281611857341361741547, -1.52160949662516078556178806805e-1,
+                                    2.01365400804030348374776537501e-1, 4.47106157277725905176885569043e-2 - 0.220588235294117647058823529412e-1 };
 
-    // 2nd step
-    u.x = u0->x + a2*H;
-    u.y = u0->y + a2*H;
-    u.z = u0->z + a2*H;
-    if ( (*Mag)(&u, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
-        return(0);
-    }
-    ak2[0] = B.x; ak2[1] = B.y; ak2[2] = B.z;
-    for ( i=0; i<3; i++ ) {
-        ytemp[i] = y[i] + H*(b31*ak1[i] + b32*ak2[i]);
-    }
 
+/*
+ *  Take a single adaptive Dormand-Prince 8(5,3) step.
+ *
+ *  This is 12 field evaluations per step. The first stage is the unit tangent
+ *  at the end of the previous step (first same as last); rather than
+ *  evaluating it at the end of every accepted step (as DOP853 does) it is
+ *  evaluated at the start of the next one and kept, so it is never wasted
+ *  when the caller restarts from some other point, and it is reused when the
+ *  caller restarts from the same point (e.g. bisection searches). Rejected
+ *  steps reuse it too.
+ *
+ *  The error estimate is the combined 5th/3rd order estimate of DOP853, with
+ *  tolerances Lgm_MagStep_DP8_atol and Lgm_MagStep_DP8_rtol, and the step size
+ *  is chosen with a PI controller (Lgm_MagStep_DP8_Beta = 0.0 gives the usual
+ *  I controller). The eps argument is not used (it is accepted so that this
+ *  routine has the same signature as the others). Dense output is handled by
+ *  Lgm_MagStep() as for the other integrators.
+ */
+int Lgm_MagStep_DP8( Lgm_Vector *u, Lgm_Vector *u_scale,
+          double Htry, double *Hdid, double *Hnext,
+          double eps, double sgn, double *s, int *reset,
+          int (*Mag)(Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo *), Lgm_MagModelInfo *Info ){
 
+    int         Done, Count, Rejected, i, j, l;
+    double      h, H, Err, Err3, Err5, Deno, e3, e5, sk, Fac, Fac11, Expo1, Beta, Safety, Bmag, hnew;
+    double      y0[3], y1[3], yt[3], k[12][3];
+    Lgm_Vector  u0, v, b0, B;
 
 
-    // 3rd step
-    u.x = u0->x + a3*H;
-    u.y = u0->y + a3*H;
-    u.z = u0->z + a3*H;
-    if ( (*Mag)(&u, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
-        return(0);
-    }
-    ak3[0] = B.x; ak3[1] = B.y; ak3[2] = B.z;
-    for ( i=0; i<3; i++ ) {
-        ytemp[i] = y[i] + H*(b41*ak1[i] + b42*ak2[i] + b43*ak3[i]);
+    if ( *reset ) {
+        Info->Lgm_nMagEvalsTotal += Info->Lgm_nMagEvals;
+        Info->Lgm_nMagEvals = 0;
+        *s = 0.0;
+        Info->Lgm_MagStep_DP8_ErrOld = 1e-4;
+        Info->Lgm_MagStep_DP8_bValid = FALSE;
     }
+    LGM_STATS_STEP_BEGIN( Info, nEvals0 );
 
+    Beta   = Info->Lgm_MagStep_DP8_Beta;
+    Safety = Info->Lgm_MagStep_DP8_Safety;
+    Expo1  = 0.125 - 0.2*Beta;
 
 
+    /*
+     * Htry can be positive or negative. The sign is independant of the sgn
+     * variable which can also be +/-.
+     */
+    h  = Htry;
+    u0 = *u;
+    y0[0] = u0.x; y0[1] = u0.y; y0[2] = u0.z;
 
-    // 4th step
-    u.x = u0->x + a4*H;
-    u.y = u0->y + a4*H;
-    u.z = u0->z + a4*H;
-    if ( (*Mag)(&u, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
-        return(0);
-    }
-    ak4[0] = B.x; ak4[1] = B.y; ak4[2] = B.z;
-    for ( i=0; i<3; i++ ) {
-        ytemp[i] = y[i] + H*(b51*ak1[i] + b52*ak2[i] + b53*ak3[i] + b54*ak4[i]);
+    /*
+     *  Get b0. Use the one we kept if we can (or the one from dense output).
+     */
+    if (   Info->Lgm_MagStep_DP8_bValid && ( Info->Lgm_MagStep_DP8_Mag == (int (*)())Mag )
+        && ( u0.x == Info->Lgm_MagStep_DP8_P.x ) && ( u0.y == Info->Lgm_MagStep_DP8_P.y ) && ( u0.z == Info->Lgm_MagStep_DP8_P.z ) ) {
+        b0 = Info->Lgm_MagStep_DP8_b;
+    } else if ( !Lgm_MagStep_TangentAt( &u0, &b0, *reset, Mag, Info ) ) {
+        if ( (*Mag)(&u0, &b0, Info) == 0 ) {
+            printf("Lgm_MagStep_DP8(): B-field evaluation (u = %g %g %g) returned with errors (returning with 0)\n", u0.x, u0.y, u0.z );
+            return(0);
+        }
+        ++(Info->Lgm_nMagEvals);
+        Bmag = Lgm_NormalizeVector(&b0);
+        if ( Bmag < 1e-16 ) {
+            printf("Lgm_MagStep_DP8(): Bmag too small (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u0.x, u0.y, u0.z, Bmag );
+            return(0);
+        }
     }
+    Info->Lgm_MagStep_DP8_P      = u0;
+    Info->Lgm_MagStep_DP8_b      = b0;
+    Info->Lgm_MagStep_DP8_Mag    = (int (*)())Mag;
+    Info->Lgm_MagStep_DP8_bValid = TRUE;
+    Lgm_MagStep_KeepTangent( &u0, &b0, Mag, Info );
+    k[0][0] = b0.x; k[0][1] = b0.y; k[0][2] = b0.z;
 
 
+    Count    = 0;
+    Done     = FALSE;
+    Rejected = FALSE;
+    while ( !Done && ( Count < Info->Lgm_MagStep_DP8_MaxCount ) ) {
 
+        H = sgn*h;
 
+        /*
+         *  Stages 2-12
+         */
+        for ( l=1; l<12; ++l ) {
+            for ( i=0; i<3; ++i ) {
+                yt[i] = 0.0;
+                for ( j=0; j<l; ++j ) yt[i] += DP8_a[l][j]*k[j][i];
+                yt[i] = y0[i] + H*yt[i];
+            }
+            v.x = yt[0]; v.y = yt[1]; v.z = yt[2];
+            if ( (*Mag)(&v, &B, Info) == 0 ) {
+                printf("Lgm_MagStep_DP8(): B-field evaluation during step (u = %g %g %g) returned with errors (returning with 0)\n", v.x, v.y, v.z );
+                return(0);
+            }
+            ++(Info->Lgm_nMagEvals);
+            Bmag = Lgm_NormalizeVector(&B);
+            if ( Bmag < 1e-16 ) {
+                printf("Lgm_MagStep_DP8(): Bmag too small during step (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", v.x, v.y, v.z, Bmag );
+                return(0);
+            }
+            k[l][0] = B.x; k[l][1] = B.y; k[l][2] = B.z;
+        }
 
-    // 5th step
-    u.x = u0->x + a5*H;
-    u.y = u0->y + a5*H;
-    u.z = u0->z + a5*H;
-    if ( (*Mag)(&u, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
-        return(0);
-    }
-    ak5[0] = B.x; ak5[1] = B.y; ak5[2] = B.z;
-    for ( i=0; i<3; i++ ) {
-        ytemp[i] = y[i] + H*(b61*ak1[i] + b62*ak2[i] + b63*ak3[i] + b64*ak4[i] + b65*ak5[i]);
-    }
-
+        /*
+         *  New point and error estimate
+         */
+        Err3 = Err5 = 0.0;
+        for ( i=0; i<3; ++i ) {
+            yt[i] = e3 = e5 = 0.0;
+            for ( j=0; j<12; ++j ) {
+                yt[i] += DP8_b[j]*k[j][i];
+                e3    += DP8_e3[j]*k[j][i];
+                e5    += DP8_e5[j]*k[j][i];
+            }
+            y1[i] = y0[i] + H*yt[i];
+            sk    = Info->Lgm_MagStep_DP8_atol + Info->Lgm_MagStep_DP8_rtol*FMAX( fabs(y0[i]), fabs(y1[i]) );
+            Err3 += (e3/sk)*(e3/sk);
+            Err5 += (e5/sk)*(e5/sk);
+        }
+        Deno = Err5 + 0.01*Err3;
+        if ( Deno <= 0.0 ) Deno = 1.0;
+        Err = fabs(h)*Err5*sqrt( 1.0/(3.0*Deno) );
 
 
+        /*
+         *  PI step size control
+         */
+        Fac11 = pow( Err, Expo1 );
+        Fac   = Fac11/pow( Info->Lgm_MagStep_DP8_ErrOld, Beta );
+        Fac   = FMAX( 1.0/Info->Lgm_MagStep_DP8_FacMax, FMIN( 1.0/Info->Lgm_MagStep_DP8_FacMin, Fac/Safety ) );
 
+        if ( Err > 1.0 ) {
 
-    // 6th step
-    u.x = u0->x + a6*H;
-    u.y = u0->y + a6*H;
-    u.z = u0->z + a6*H;
-    if ( (*Mag)(&u, &B, Info) == 0 ) {
-        // bail if B-field eval had issues.
-        printf("Lgm_RKCK(): B-field evaluation during cash-karp step (u = %g %g %g) returned with errors (returning with 0)\n", u.x, u.y, u.z );
-        return(0);
-    }
-    ++(Info->Lgm_nMagEvals);
-    Bmag = Lgm_NormalizeVector(&B);
-    if ( Bmag < 1e-16 ) {
-        // bail if B-field magnitude is too small
-        printf("Lgm_RKCK(): Bmag too small during cash-karp phase (u = %g %g %g Bmag = %g) is too small (returning with 0).\n", u.x, u.y, u.z, Bmag );
-        return(0);
-    }
-    ak6[0] = B.x; ak6[1] = B.y; ak6[2] = B.z;
-    for ( i=0; i<3; i++ ) {
-        yout[i] = y[i] + H*(c1*ak1[i] + c3*ak3[i] + c4*ak4[i] + c6*ak6[i]);
-    }
-    v->x = yout[0];
-    v->y = yout[1];
-    v->z = yout[2];
+            hnew = h/FMIN( 1.0/Info->Lgm_MagStep_DP8_FacMin, Fac11/Safety );
+            if ( *s + hnew == *s ) {
+                printf( "Lgm_MagStep_DP8: Stepsize underflow. h = %g\n", hnew );
+                return( -1 );
+            }
+            h = hnew;
+            Rejected = TRUE;
+            LGM_STATS_COUNT( Info, DP8_Rejected );
+            LGM_STATS_STEP_REJECT( Info, LGM_MAGSTEP_ODE_DP8 );
 
+        } else {
 
+            Info->Lgm_MagStep_DP8_ErrOld = FMAX( Err, 1e-4 );
+            hnew = h/Fac;
+            if ( Rejected ) hnew = ( h >= 0.0 ) ? FMIN( hnew, h ) : FMAX( hnew, h );  // dont grow right after a rejection
+            *Hnext = hnew;
+            *Hdid  = h;
+            *s    += h;
+            u->x   = y1[0]; u->y = y1[1]; u->z = y1[2];
+            Done   = TRUE;
+            LGM_STATS_COUNT( Info, DP8_Accepted );
+            LGM_STATS_STEP_ACCEPT( Info, LGM_MAGSTEP_ODE_DP8, h, -1, nEvals0 );
+            *reset = FALSE;
 
+        }
 
+        ++Count;
 
-    // compute yerr
-    for ( i=0; i<3; i++ ) {
-        yerr[i] = H*(dc1*ak1[i] + dc3*ak3[i] + dc4*ak4[i] + dc5*ak5[i] + dc6*ak6[i]);
     }
 
-
-
     return(1);
 
 }
-
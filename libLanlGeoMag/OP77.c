@@ -1,8 +1,10 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 int Lgm_B_OP77( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *m ) {
 
     Lgm_Vector  B1, B2, B3, u;
     double	    ps, XX[4], BF[4];
+    LGM_STATS_START( t0 );
 
     ps = m->c->psi;  // dipole tilt angle
 
@@ -22,6 +24,7 @@ int Lgm_B_OP77( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *m ) {
     Lgm_Convert_Coords( &B1, &B2, SM_TO_GSM, m->c );
 
     // printf("Bop77 =  (%g, %g, %g)\n", B2.x, B2.y, B2.z);
+    LGM_STATS_STOP_MODEL( m, External, LGM_EXTMODEL_OP77, t0 );
     switch ( m->InternalModel ){
 
         case LGM_CDIP:
@@ -1,16 +1,20 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 int Lgm_B_OP88( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
-    Lgm_Vector       B2;
-    double	         DEN, VEL, DST, Bmag, X, Y, Z, Bx, By, Bz;
+    Lgm_Vector       B1, B2;
+    double	         Bmag, Bx, By, Bz;
+    LGM_STATS_START( t0 );
 
 
-    X = v->x; Y = v->y; Z = v->z;
-    DEN = Info->Den;
-    VEL = Info->V;
-    DST = Info->Dst;
-    Lgm_OP88_BDYN( DEN, VEL, DST, X, Y, Z, &Bx, &By, &Bz );
+    /*
+     *  Same as Lgm_OP88_BDYN( Info->Den, Info->V, Info->Dst, ... ), but the
+     *  dynamic scalings are only recomputed when those change.
+     */
+    Lgm_OP88_External( v, &B1, Info );
+    Bx = B1.x; By = B1.y; Bz = B1.z;
 
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_OP88, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
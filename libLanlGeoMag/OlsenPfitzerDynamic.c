@@ -1,10 +1,27 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_SimdMath.h"
+
+#if USE_OPENMP
+#define LGM_OP88_SIMD   _Pragma( "omp simd private(BX,BY,BZ)" )
+#else
+#define LGM_OP88_SIMD
+#endif
 
 /*
  *   Olson-Pfitzer 1988 Dynamic Model.
  *   Converted to thread-safe C by M. Henderson 2013.
  *
+ *   The expansions are evaluated in Horner form (see the OP88_P4() etc.
+ *   helpers below), and the dynamic scalings, which only depend on the solar
+ *   wind and Dst, are worked out once per epoch (see OP88_SetScalings()). The
+ *   per point work is all in OP88_Points(), which the scalar routines call
+ *   with a single point and Lgm_OP88_External_Batch() calls with many.
+ *
  */
+static void OP88_Points( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+                         double SCL, double STRMAG, double STRRIN, double STRTAI );
+
 void Lgm_OP88_BDYN( double DEN, double VEL, double DST, double X, double Y, double Z, double *BX, double *BY, double *BZ )  {
 
     double  XX[4], B[4], SOFFD, SRING, STAIL, STDOFF, RINGST;
@@ -71,8 +88,7 @@ void Lgm_OP88_BDYN( double DEN, double VEL, double DST, double X, double Y, doub
  */
 void Lgm_OP88_BDYNAM( double *XX, double *BB, double SOFFD, double SRING, double STAIL ) {
 
-    double  SCL, STRMAG, STRRIN, STRTAI, XXX[4], XXXX[4], BM[4], BR[4], BT[4];
-    int     I;
+    double  SCL, STRMAG, STRRIN, STRTAI;
 
     // CALCULATE MAGNETOPAUSE SCALE FACTOR.
     SCL = 10.5/SOFFD;
@@ -84,28 +100,91 @@ void Lgm_OP88_BDYNAM( double *XX, double *BB, double SOFFD, double SRING, double
     STRRIN = SRING;
     STRTAI = STAIL*STRMAG;
 
-    // CALCULATE SCALED DISTANCES
-    for ( I=1; I<=3; I++ ) {
-        XXX[I]  = XX[I]*SCL;
-        XXXX[I] = XX[I];
-    }
-
-    // CALL THE QUIET TIME SUBROUTINE.
-    Lgm_OP88_BFMAGP( XXX,  BM );
-    Lgm_OP88_BFRING( XXXX, BR );
-    Lgm_OP88_BFTAIL( XXX,  BT );
-
     /*
-     *   COMBINE THE COMPONENTS OF THE MAGNETIC FIELD ACCORDING TO THEIR
-     *   RELATIVE STRENGTHS.
+     *   CALL THE QUIET TIME EXPANSIONS (AT SCALED DISTANCES FOR THE
+     *   MAGNETOPAUSE AND TAIL) AND COMBINE THE COMPONENTS OF THE MAGNETIC
+     *   FIELD ACCORDING TO THEIR RELATIVE STRENGTHS.
      */
-    for ( I=1; I<=3; I++ ) BB[I] = STRMAG*BM[I] + STRRIN*BR[I] + STRTAI*BT[I];
+    BB[1] = BB[2] = BB[3] = 0.0;
+    OP88_Points( 1, &XX[1], &XX[2], &XX[3], &BB[1], &BB[2], &BB[3], SCL, STRMAG, STRRIN, STRTAI );
 
     return;
 
 }
 
 
+/*
+ *  HORNER FORMS OF THE POLYNOMIAL PARTS OF THE EXPANSIONS. ALL OF THEM ARE
+ *  EVEN IN Y AND Z (THE ODD PARTS ARE PULLED OUT IN FRONT BY THE CALLER) SO
+ *  THEY ARE POLYNOMIALS IN X, Y2 = Y**2 AND Z2 = Z**2.
+ */
+
+/*
+ *  C(0) + C(1)*X + ... + C(4)*X**4
+ */
+static inline double OP88_P4( const double *C, double X ) {
+    return( C[0] + X*( C[1] + X*( C[2] + X*( C[3] + X*C[4] ) ) ) );
+}
+
+/*
+ *  SUM OVER J, K = 0..2 OF Y2**J * Z2**K * P4(C+5*(3*J+K)), I.E. THE
+ *  (1 + X + ... + X**4)*(1 + Y**2 + Y**4)*(1 + Z**2 + Z**4) FORM USED BY THE
+ *  MAGNETOPAUSE EXPANSION (45 COEFFICIENTS, X VARYING FASTEST).
+ */
+static inline double OP88_Q45( const double *C, double X, double Y2, double Z2 ) {
+    return(       OP88_P4( C,    X ) + Z2*( OP88_P4( C+5,  X ) + Z2*OP88_P4( C+10, X ) )
+            + Y2*( OP88_P4( C+15, X ) + Z2*( OP88_P4( C+20, X ) + Z2*OP88_P4( C+25, X ) )
+            + Y2*( OP88_P4( C+30, X ) + Z2*( OP88_P4( C+35, X ) + Z2*OP88_P4( C+40, X ) ) ) ) );
+}
+
+/*
+ *  SUM OVER J, K = 0..2 OF Y2**J * Z2**K * C(3*J+K)
+ */
+static inline double OP88_Q9( const double *C, double Y2, double Z2 ) {
+    return(       C[0] + Z2*( C[1] + Z2*C[2] )
+            + Y2*( C[3] + Z2*( C[4] + Z2*C[5] )
+            + Y2*( C[6] + Z2*( C[7] + Z2*C[8] ) ) ) );
+}
+
+/*
+ *  THE 19 TERM FORM USED FOR BZ (AND THE TANH PART OF BX) OF THE TAIL AND
+ *  RING. THE TERMS ARE (IN THE ORDER THE COEFFICIENTS C(K(0..18)) COME IN)
+ *  1, X, Z2, Y2, Y2Z2, XZ2, XY2, XY2Z2, X2, X2Z2, X2Y2, X3, X3Z2, X3Y2, Z4, Y4,
+ *  XZ4, XY4, X4.
+ */
+static const int OP88_E19_TAILA[] = { 33, 35, 37, 38, 40, 41, 42, 44, 45, 47, 48, 54, 56, 57, 58, 59, 61, 62, 63 };
+static const int OP88_E19_C1[]    = {  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+static const int OP88_E19_C20[]   = { 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38 };
+static inline double OP88_E19( const double *C, const int *K, double X, double Y2, double Z2 ) {
+    double  G0, G1, G2, G3;
+    G0 = C[K[0]]  + Z2*( C[K[2]] + Z2*C[K[14]] ) + Y2*( C[K[3]] + Z2*C[K[4]] + Y2*C[K[15]] );
+    G1 = C[K[1]]  + Z2*( C[K[5]] + Z2*C[K[16]] ) + Y2*( C[K[6]] + Z2*C[K[7]] + Y2*C[K[17]] );
+    G2 = C[K[8]]  + Z2*C[K[9]]  + Y2*C[K[10]];
+    G3 = C[K[11]] + Z2*C[K[12]] + Y2*C[K[13]];
+    return( G0 + X*( G1 + X*( G2 + X*( G3 + X*C[K[18]] ) ) ) );
+}
+
+/*
+ *  THE 8 TERM FORM USED FOR BY (TIMES Y*Z) OF THE TAIL AND RING. THE TERMS
+ *  ARE 1, X, Z2, Y2, XZ2, XY2, X2, X3.
+ */
+static inline double OP88_O8( const double *C, double X, double Y2, double Z2 ) {
+    return( ( C[0] + Z2*C[2] + Y2*C[3] ) + X*( ( C[1] + Z2*C[4] + Y2*C[5] ) + X*( C[6] + X*C[7] ) ) );
+}
+
+/*
+ *  THE 14 TERM FORM USED FOR BX (TIMES Z) OF THE RING. THE TERMS ARE 1, X,
+ *  Z2, Y2, Y2Z2, XZ2, XY2, X2, X2Z2, X2Y2, X3, Z4, Y4, X4.
+ */
+static inline double OP88_R14( const double *C, double X, double Y2, double Z2 ) {
+    double  G0, G1, G2;
+    G0 = C[0] + Z2*( C[2] + Z2*C[11] ) + Y2*( C[3] + Z2*C[4] + Y2*C[12] );
+    G1 = C[1] + Z2*C[5] + Y2*C[6];
+    G2 = C[7] + Z2*C[8] + Y2*C[9];
+    return( G0 + X*( G1 + X*( G2 + X*( C[10] + X*C[13] ) ) ) );
+}
+
+
 
 /*
  *  VERSION 5/13/88
@@ -146,13 +225,11 @@ void Lgm_OP88_BDYNAM( double *XX, double *BB, double SOFFD, double SRING, double
  * ***VALID TO APPROXIMATELY -60 RE
  * ***MAGNETIC FIELD FROM MAGNETOPAUSE CURRENTS ONLY
  */
-void Lgm_OP88_BFMAGP( double *XX, double *BB ) {
-
-    double  XN, YN, ZN, X[6], Y[6], Z[6], g, g2, FX1, XF1, XF2;
-    int     I;
+static inline void OP88_MagP( double X, double Y, double Z, double *BX, double *BY, double *BZ ) {
 
+    double  Y2, Z2, g, FX1, XF1, XF2;
 
-    static double A[] = {   -9e99,  0.113275039e+01,  0.354408138e-01, -0.152252289e-02,
+    static const double A[] = {   -9e99,  0.113275039e+01,  0.354408138e-01, -0.152252289e-02,
                                    -0.683306571e-04, -0.642841428e-06, -0.121504674e-01,
                                    -0.839622808e-03, -0.167520029e-04, -0.385962942e-07,
                                     0.107674747e-08,  0.558984066e-04,  0.551508083e-05,
@@ -171,7 +248,7 @@ void Lgm_OP88_BFMAGP( double *XX, double *BB ) {
                                     0.682263300e-01, -0.576195028e-02,  0.237557251e-04,
                                    -0.529665092e-03,  0.255710365e-04, -0.120115033e-06 };
 
-    static double B[] = {  -9e99,  -0.519952811e-01, -0.230140495e-02,  0.146173188e-03,
+    static const double B[] = {  -9e99,  -0.519952811e-01, -0.230140495e-02,  0.146173188e-03,
                                     0.809832090e-05,  0.888401672e-07, -0.370911323e-03,
                                    -0.101231737e-03, -0.742647399e-05, -0.196170248e-06,
                                    -0.165503899e-08,  0.150949325e-05,  0.308240260e-06,
@@ -214,7 +291,7 @@ EQUIVALENCE (C(1),C1(1)), (C(31),C2(1))
 C is both put together via thej equiv statement.
 */
 
-    static double C[] = {  -9e99,   0.406363373e+02,  0.291153884e+01,  0.991215929e-01,
+    static const double C[] = {  -9e99,   0.406363373e+02,  0.291153884e+01,  0.991215929e-01,
                                     0.161603605e-02,  0.994476977e-05, -0.566497850e+01,
                                    -0.346289247e+00, -0.102486340e-01, -0.153071058e-03,
                                    -0.892381365e-06,  0.182735808e-01,  0.106282183e-02,
@@ -237,62 +314,26 @@ C is both put together via thej equiv statement.
                                     0.240404391e+01, -0.269608498e+00,  0.332747493e-02 };
 
 
-    XN = XX[1]; YN = XX[2]; ZN = XX[3];
-    for ( I=1; I<=5; I++ ) {
-        X[I] = XN;
-        Y[I] = YN;
-        Z[I] = ZN;
-        XN *= XX[1];
-        YN *= XX[2];
-        ZN *= XX[3];
-    }
-    g = X[1]-2.0; g2 = g*g;
-    FX1 = 1.0/( 10.0 + g2 );
-    XF1 = 1.0/( 15.0 - X[1] );
-    g = 30.0-X[1]; g2 = g*g;
-    XF2 = 1.0/g2;
-
-    BB[1] =  Z[1]*(A[1] + A[2]*X[1] + A[3]*X[2] + A[4]*X[3] + A[5]*X[4])
-               + Z[3]*(A[6] + A[7]*X[1] + A[8]*X[2] + A[9]*X[3] + A[10]*X[4])
-               + Z[5]*(A[11] + A[12]*X[1] + A[13]*X[2] + A[14]*X[3] + A[15]*X[4])
-               + Y[2]*Z[1]*(A[16] + A[17]*X[1] + A[18]*X[2] + A[19]*X[3] + A[20]*X[4])
-               + Y[2]*Z[3]*(A[21] + A[22]*X[1] + A[23]*X[2] + A[24]*X[3] + A[25]*X[4])
-               + Y[2]*Z[5]*(A[26] + A[27]*X[1] + A[28]*X[2] + A[29]*X[3] + A[30]*X[4])
-               + Y[4]*Z[1]*(A[31] + A[32]*X[1] + A[33]*X[2] + A[34]*X[3] + A[35]*X[4])
-               + Y[4]*Z[3]*(A[36] + A[37]*X[1] + A[38]*X[2] + A[39]*X[3] + A[40]*X[4])
-               + Y[4]*Z[5]*(A[41] + A[42]*X[1] + A[43]*X[2] + A[44]*X[3] + A[45]*X[4])
-               + FX1*(A[46]*Z[1] + A[47]*Z[3] + A[48]*Z[5])
-               + FX1*Y[2]*(A[49]*Z[1] +  A[50]*Z[3] + A[51]*Z[5])
-               + FX1*Y[4]*(A[52]*Z[1] + A[53]*Z[3] + A[54]* Z[5]);
-
-    BB[2] = Z[1]*Y[1]*(B[1] + B[2]*X[1] + B[3]*X[2] + B[4]*X[3] + B[5]*X[4])
-              + Z[3]*Y[1]*( B[6] +  B[7]*X[1] +  B[8]*X[2] +  B[9]*X[3] + B[10]*X[4])
-              + Z[5]*Y[1]*(B[11] + B[12]*X[1] + B[13]*X[2] + B[14]*X[3] + B[15]*X[4])
-              + Y[3]*Z[1]*(B[16] + B[17]*X[1] + B[18]*X[2] + B[19]*X[3] + B[20]*X[4])
-              + Y[3]*Z[3]*(B[21] + B[22]*X[1] + B[23]*X[2] + B[24]*X[3] + B[25]*X[4])
-              + Y[3]*Z[5]*(B[26] + B[27]*X[1] + B[28]*X[2] + B[29]*X[3] + B[30]*X[4])
-              + Y[5]*Z[1]*(B[31] + B[32]*X[1] + B[33]*X[2] + B[34]*X[3] + B[35]*X[4])
-              + Y[5]*Z[3]*(B[36] + B[37]*X[1] + B[38]*X[2] + B[39]*X[3] + B[40]*X[4])
-              + Y[5]*Z[5]*(B[41] + B[42]*X[1] + B[43]*X[2] + B[44]*X[3] + B[45]*X[4]);
-
-    BB[3] =  C[1] + C[2]*X[1] + C[3]*X[2] + C[4]*X[3] + C[5]*X[4]
-                + Z[2]*( C[6] +  C[7]*X[1] +  C[8]*X[2] +  C[9]*X[3] + C[10]*X[4])
-                + Z[4]*(C[11] + C[12]*X[1] + C[13]*X[2] + C[14]*X[3] + C[15]*X[4])
-                + Y[2]*(C[16] + C[17]*X[1] + C[18]*X[2] + C[19]*X[3] + C[20]*X[4])
-                + Y[2]*Z[2]*(C[21] + C[22]*X[1] + C[23]*X[2] + C[24]*X[3] + C[25]*X[4])
-                + Y[2]*Z[4]*(C[26] + C[27]*X[1] + C[28]*X[2] + C[29]*X[3] + C[30]*X[4])
-                + Y[4]*(C[31] + C[32]*X[1] + C[33]*X[2] + C[34]*X[3] + C[35]*X[4]);
-
-    BB[3] +=  Y[4]*Z[2]*(C[36] + C[37]*X[1] + C[38]*X[2] + C[39]*X[3] + C[40]*X[4])
-                + Y[4]*Z[4]*(C[41] + C[42]*X[1] + C[43]*X[2] + C[44]*X[3] + C[45]*X[4])
-                + XF1*(C[46] + C[47]*Z[2] + C[48]*Z[4] + C[49]*Y[2] + C[50]*Y[2]*Z[2] + C[51]*Y[2]*Z[4] + C[52]*Y[4] + C[53]*Y[4]*Z[2] + C[54]*Y[4]*Z[4])
-                + XF2*(C[55] + C[56]*Z[2] + C[57]*Z[4] + C[58]*Y[2] + C[59]*Y[2]*Z[2] + C[60]*Y[2]*Z[4] + C[61]*Y[4] + C[62]*Y[4]*Z[2] + C[63]*Y[4]*Z[4]);
-
-
-    return ;
+    Y2 = Y*Y; Z2 = Z*Z;
+
+    g   = X-2.0;
+    FX1 = 1.0/( 10.0 + g*g );
+    XF1 = 1.0/( 15.0 - X );
+    g   = 30.0-X;
+    XF2 = 1.0/( g*g );
+
+    *BX = Z*( OP88_Q45( &A[1], X, Y2, Z2 ) + FX1*OP88_Q9( &A[46], Y2, Z2 ) );
+    *BY = Y*Z*OP88_Q45( &B[1], X, Y2, Z2 );
+    *BZ = OP88_Q45( &C[1], X, Y2, Z2 ) + XF1*OP88_Q9( &C[46], Y2, Z2 ) + XF2*OP88_Q9( &C[55], Y2, Z2 );
 
 }
 
+void Lgm_OP88_BFMAGP( double *XX, double *BB ) {
+    // go through OP88_Points() so the kernels only have the one call site (and get inlined there)
+    BB[1] = BB[2] = BB[3] = 0.0;
+    OP88_Points( 1, &XX[1], &XX[2], &XX[3], &BB[1], &BB[2], &BB[3], 1.0, 1.0, 0.0, 0.0 );
+}
+
 
 
 
@@ -322,12 +363,11 @@ C is both put together via thej equiv statement.
  *  VALID FROM THE SUBSOLAR POIN TO -60 RE. THE EXPANSION IS BASED ON A
  *  FIT TO VALUES CALCULATED USING THE WIRE LOOP TAIL SYSTEM.
  */
-void Lgm_OP88_BFTAIL( double *XX,  double *BB ) {
+static inline void OP88_Tail( double X, double Y, double Z, double *BX, double *BY, double *BZ ) {
 
-    double  XN, YN, ZN, R2, R, X[6], Y[6], Z[6], g, g2, R22, EXPC, TANZR, EXPR;
-    int     I;
+    double  Y2, Z2, R, g, R22, EXPC, TANZR, EXPR;
 
-    static double A[] = { -9e99,  -.118386794e-12,  .260137167e+01,  .408016277e-12, -.306063863e+00,
+    static const double A[] = { -9e99,  -.118386794e-12,  .260137167e+01,  .408016277e-12, -.306063863e+00,
                                    .852659791e-13,  .848404600e-14, -.568097241e-02, -.601368497e-14,
                                   -.336276159e-13, -.676779936e-15, -.110762251e-02, -.150912058e-15,
                                   -.477506548e-14, -.805245718e-02, -.130105300e-14,  .442299435e-16,
@@ -345,13 +385,13 @@ void Lgm_OP88_BFTAIL( double *XX,  double *BB ) {
                                    .293942950e-05, -.417367450e-06,  .134032750e-04, -.139506296e-18,
                                    0.0 };
 
-    static double B[] = { -9e99,  -.323149328e-01,  .430535014e-02,  .115661689e-03, -.486002660e-04,
+    static const double B[] = { -9e99,  -.323149328e-01,  .430535014e-02,  .115661689e-03, -.486002660e-04,
                                   -.102777234e-04, -.489864422e-05, -.356884232e-04, -.334316125e-07,
                                    .122456608e+00,  .202317315e-01, -.487990709e-03,  .338684854e-04,
                                   -.511755985e-04,  .119096933e-04,  .609353153e-03, -.243627124e-05,
                                    0.0 };
 
-    static double C[] = {  -9e99,  .318422091e+00,  .154017442e+00,  .337581827e-01,  .436882397e-01,
+    static const double C[] = {  -9e99,  .318422091e+00,  .154017442e+00,  .337581827e-01,  .436882397e-01,
                                   -.153732787e-03,  .362817457e-02,  .179382198e-03, -.394772816e-05,
                                   -.193942567e-01, -.263603775e-04, -.314364082e-04, -.103110548e-02,
                                    .386165884e-06, -.301272556e-06, -.102838611e-03, -.725608973e-04,
@@ -362,48 +402,28 @@ void Lgm_OP88_BFTAIL( double *XX,  double *BB ) {
                                    .141706101e-03, -.334067698e-03,  .122648694e-03, -.259383966e-07,
                                    .252027517e-04, -.212223753e-02,  0.0 };
 
-    XN = XX[1]; YN = XX[2]; ZN = XX[3];
-    R2 = XN*XN + YN*YN + ZN*ZN;
-    R = sqrt( R2 );
-    for (I=1; I<=5; I++ ) {
-        X[I] = XN;
-        Y[I] = YN;
-        Z[I] = ZN;
-        XN *= XX[I];
-        YN *= XX[I];
-        ZN *= XX[I];
-    }
-    g = 22.0-X[1]; g2 = g*g;
-    R22   = sqrt( g2 + Y[2] + Z[2] );
-    EXPC  = exp( X[1]/15.0 );
-    TANZR = tanh( Z[1]) * (1.0-tanh((8.0-R)/5.0) );
-    g = R22-29.0; g2 = g*g;
-    EXPR  = exp( -g2/60.0 );
-
-
-    BB[1]=   (    A[2]*Z[1] + A[4]*X[1]*Z[1] + A[7]*Y[2]*Z[1] + A[11]*X[1]*Y[2]*Z[1]
-                + A[17]*X[2]*Y[2]*Z[1] + A[18]*Z[3] + A[19]*Y[2]*Z[3] + A[20]*X[1] *Z[3]
-                + A[21]*X[2]*Z[3] + A[23]*X[3]*Z[1] + A[28]*Y[4]*Z[1] + A[32]*X[4]*Z[1])*EXPC
-           + (    A[33] + A[35]*X[1] + A[37]*Z[2] + A[38]*Y[2] + A[40]*Y[2]*Z[2]
-                + A[41]*X[1]*Z[2] + A[42]*X[1]*Y[2] + A[44]*X[1]*Y[2]*Z[2]
-                + A[45]*X[2] + A[47]*X[2]*Z[2] + A[48]*X[2]*Y[2] + A[54]*X[3]
-                + A[56]*X[3] *Z[2] + A[57]*X[3]*Y[2] + A[58]*Z[4] + A[59]*Y[4]
-                + A[61]*X[1]*Z[4] + A[62]*X[1]*Y[4] + A[63]*X[4])*TANZR;
-
-    BB[2] =  (    B[1]*Y[1]*Z[1] + B[2]*X[1]*Y[1]*Z[1] + B[3]*Y[1]*Z[3] + B[4]*Y[3]*Z[1]
-                + B[5]*X[1]*Y[1]*Z[3] + B[6]*X[1]*Y[3]*Z[1] + B[7]*X[2]*Y[1]*Z[1] + B[8]*X[3]*Y[1]*Z[1])*EXPC
-           + (    B[9]*Y[1]*Z[1] + B[10]*X[1]*Y[1]*Z[1] + B[11]*Y[1]*Z[3] + B[12]*Y[3]*Z[1]
-                + B[13]*X[1]*Y[1]*Z[3] + B[14]*X[1]*Y[3]*Z[1] + B[15]*X[2]*Y[1]*Z[1] + B[16]*X[3]*Y[1]*Z[1])*EXPR;
-
-    BB[3] =  (    C[1] + C[2]*X[1] + C[3]*Z[2] + C[4]*Y[2] + C[5]*Y[2]*Z[2] + C[6]*X[1]*Z[2]
-                + C[7]*X[1]*Y[2] + C[8]*X[1]*Y[2]*Z[2] + C[9] *X[2] + C[10]*X[2]*Z[2]
-                + C[11]*X[2]*Y[2] + C[12]*X[3] + C[13]*X[3] *Z[2] + C[14]*X[3]*Y[2]
-                + C[15]*Z[4] + C[16]*Y[4] + C[17]*X[1]*Z[4] + C[18]*X[1]*Y[4] + C[19]*X[4])*EXPC
-           + (    C[20] + C[21]*X[1] + C[22]*Z[2] + C[23]*Y[2] + C[24]*Y[2]*Z[2] + C[25]*X[1]*Z[2] + C[26]*X[1]*Y[2]
-                + C[27]*X[1]*Y[2]*Z[2] + C[28]*X[2] + C[29]*X[2]*Z[2] + C[30]*X[2]*Y[2] + C[31]*X[3] + C[32]*X[3]*Z[2]
-                + C[33]*X[3]*Y[2] + C[34]*Z[4] + C[35]*Y[4] + C[36]*X[1]*Z[4] + C[37]*X[1]*Y[4] + C[38]*X[4])*EXPR;
-    return;
+    Y2 = Y*Y; Z2 = Z*Z;
+    R  = Lgm_SimdSqrt( X*X + Y2 + Z2 );
+
+    g     = 22.0-X;
+    R22   = Lgm_SimdSqrt( g*g + Y2 + Z2 );
+    EXPC  = Lgm_SimdExp( X/15.0 );
+    TANZR = Lgm_SimdTanh( Z )*( 1.0 - Lgm_SimdTanh( (8.0-R)/5.0 ) );
+    g     = R22-29.0;
+    EXPR  = Lgm_SimdExp( -g*g/60.0 );
+
+    // the EXPC part of BX only has 12 terms
+    *BX = Z*(   A[2] + Z2*A[18] + Y2*( A[7] + Z2*A[19] + Y2*A[28] )
+              + X*( A[4] + Z2*A[20] + Y2*A[11] + X*( Z2*A[21] + Y2*A[17] + X*( A[23] + X*A[32] ) ) ) )*EXPC
+          + OP88_E19( A, OP88_E19_TAILA, X, Y2, Z2 )*TANZR;
+    *BY = Y*Z*( OP88_O8( &B[1], X, Y2, Z2 )*EXPC + OP88_O8( &B[9], X, Y2, Z2 )*EXPR );
+    *BZ = OP88_E19( C, OP88_E19_C1, X, Y2, Z2 )*EXPC + OP88_E19( C, OP88_E19_C20, X, Y2, Z2 )*EXPR;
+
+}
 
+void Lgm_OP88_BFTAIL( double *XX,  double *BB ) {
+    BB[1] = BB[2] = BB[3] = 0.0;
+    OP88_Points( 1, &XX[1], &XX[2], &XX[3], &BB[1], &BB[2], &BB[3], 1.0, 0.0, 0.0, 1.0 );
 }
 
 
@@ -434,12 +454,11 @@ void Lgm_OP88_BFTAIL( double *XX,  double *BB ) {
  *  CURRENT MODEL. THE EXPANSION IS VALID FROM THE SUBSOLAR POINT.
  *  TO -60 RE.
  */
-void Lgm_OP88_BFRING( double *XX,  double *BB ) {
+static inline void OP88_Ring( double X, double Y, double Z, double *BX, double *BY, double *BZ ) {
 
-    double  XN, YN, ZN, R2, R, X[6], Y[6], Z[6], EXPC, EXPR;
-    int     I;
+    double  Y2, Z2, R2, R, EXPC, EXPR;
 
-    static double A[] = { -9e99,   .937029737e+00, -.734269078e+00, -.125896726e-01, -.843388063e-02,
+    static const double A[] = { -9e99,   .937029737e+00, -.734269078e+00, -.125896726e-01, -.843388063e-02,
                                    .756104711e-04,  .294507011e-02, -.719118601e-03, -.177154663e-01,
                                    .104113319e-03, -.339745485e-04,  .324439655e-03,  .492786378e-04,
                                   -.100821105e-04,  .109966887e-04,  .119616338e+00,  .403556177e+01,
@@ -448,13 +467,13 @@ void Lgm_OP88_BFRING( double *XX,  double *BB ) {
                                   -.249204900e+00,  .825058070e-03,  .464195892e-02,  .223651513e-01,
                                    0.0e0 };
 
-    static double B[] = { -9e99,  -.908641389e+00, -.249680217e-01,  .443512048e-02, -.124215709e-03,
+    static const double B[] = { -9e99,  -.908641389e+00, -.249680217e-01,  .443512048e-02, -.124215709e-03,
                                    .211679921e-03, -.368134800e-04,  .547288643e-03,  .164845371e-04,
                                    .407818714e+01, -.129156231e+00, -.940633654e-01, -.220684438e+00,
                                    .878070158e-04,  .174193445e-01, -.223040987e+00,  .151981648e-01,
                                    0.0e0 };
 
-    static double C[] = { -9e99,  -.381390073e+02, -.362173083e+01, -.410551306e+00,  .532760526e+00,
+    static const double C[] = { -9e99,  -.381390073e+02, -.362173083e+01, -.410551306e+00,  .532760526e+00,
                                   -.151227645e-02,  .182345800e-01,  .358417761e-01, -.103889316e-03,
                                    .395514004e+00,  .100299786e-02,  .138275245e-03,  .288046807e-01,
                                   -.127951613e-05, -.177797800e-04,  .239511803e-02, -.284121147e-03,
@@ -466,49 +485,25 @@ void Lgm_OP88_BFRING( double *XX,  double *BB ) {
                                   -.179837707e-01,  .871619151e-01,
                                    0.0e0 };
 
-    XN = XX[1]; YN = XX[2]; ZN = XX[3];
-    R2 = XN*XN + YN*YN + ZN*ZN;
-    R = sqrt(R2);
-    for ( I=1; I<=5; I++ ){
-        X[I] = XN; Y[I] = YN; Z[I] = ZN;
-        XN *= XX[1];
-        YN *= XX[2];
-        ZN *= XX[3];
-    }
-    EXPC = exp( -R/5.20 );
-    if (R2 >  900.0) R2 = 900.0;
-    EXPR = exp( -0.060*R2 );
-
-    BB[1] =   (   A[ 1]*Z[ 1] + A[ 2]*X[ 1]*Z[ 1] + A[ 3]*Z[ 3] + A[ 4]*Y[ 2]*Z[ 1]
-                + A[ 5]*Y[ 2]*Z[ 3] + A[ 6]*X[ 1]*Z[ 3] + A[ 7]*X[ 1]*Y[ 2]*Z[ 1]
-                + A[ 8]*X[ 2]*Z[ 1] + A[ 9]*X[ 2]*Z[ 3] + A[10]*X[ 2]*Y[ 2]*Z[ 1]
-                + A[11]*X[ 3]*Z[ 1] + A[12]*Z[ 5] + A[13]*Y[ 4]*Z[ 1] + A[14]*X[ 4]*Z[ 1])*EXPC
-            + (   A[15]*Z[ 1] + A[16]*X[ 1]*Z[ 1] + A[17]*Z[ 3] + A[18]*Y[ 2]*Z[ 1]
-                + A[19]*Y[ 2]*Z[ 3] + A[20]*X[ 1]*Z[ 3] + A[21]*X[ 1]*Y[ 2]*Z[ 1]
-                + A[22]*X[ 2]*Z[ 1] + A[23]*X[ 2]*Z[ 3] + A[24]*X[ 2]*Y[ 2]*Z[ 1]
-                + A[25]*X[ 3]*Z[ 1] + A[26]*Z[ 5] + A[27]*Y[ 4]*Z[ 1] + A[28]*X[ 4]*Z[ 1])*EXPR;
-
-    BB[2] =   (   B[ 1]*Y[ 1]*Z[ 1] + B[ 2]*X[ 1]*Y[ 1]*Z[ 1] + B[ 3]*Y[ 1]*Z[ 3]
-                + B[ 4]*Y[ 3]*Z[ 1] + B[ 5]*X[ 1]*Y[ 1]*Z[ 3] + B[ 6]*X[ 1]*Y[ 3]*Z[ 1]
-                + B[ 7]*X[ 2]*Y[ 1]*Z[ 1] + B[ 8]*X[ 3]*Y[ 1]*Z[ 1])*EXPC
-            + (   B[ 9]*Y[ 1]*Z[ 1] + B[10]*X[ 1]*Y[ 1]*Z[ 1] + B[11]*Y[ 1]*Z[ 3]
-                + B[12]*Y[ 3]*Z[ 1] + B[13]*X[ 1]*Y[ 1]*Z[ 3] + B[14]*X[ 1]*Y[ 3]*Z[ 1]
-                + B[15]*X[ 2]*Y[ 1]*Z[ 1] + B[16]*X[ 3]*Y[ 1]*Z[ 1])*EXPR;
-
-    BB[3]=    (   C[ 1] + C[ 2]*X[ 1] + C[ 3]*Z[ 2] + C[ 4]*Y[ 2] + C[ 5]*Y[ 2]*Z[ 2]
-                + C[ 6]*X[ 1]*Z[ 2] + C[ 7]*X[ 1]*Y[ 2] + C[ 8]*X[ 1]*Y[ 2]*Z[ 2]
-                + C[ 9]*X[ 2] + C[10]*X[ 2]*Z[ 2] + C[11]*X[ 2]*Y[ 2] + C[12]*X[ 3]
-                + C[13]*X[ 3]*Z[ 2] + C[14]*X[ 3]*Y[ 2] + C[15]*Z[ 4] + C[16]*Y[ 4] + C[17]*X[ 1]*Z[ 4]
-                + C[18]*X[ 1]*Y[ 4] + C[19]*X[ 4])*EXPC
-           + (    C[20] + C[21]*X[ 1] + C[22]*Z[ 2] + C[23]*Y[ 2] + C[24]*Y[ 2]*Z[ 2]
-                + C[25]*X[ 1]*Z[ 2] + C[26]*X[ 1]*Y[ 2] + C[27]*X[ 1]*Y[ 2]*Z[ 2] + C[28]*X[ 2]
-                + C[29]*X[ 2]*Z[ 2] + C[30]*X[ 2]*Y[ 2] + C[31]*X[ 3] + C[32]*X[ 3]*Z[ 2]
-                + C[33]*X[ 3]*Y[ 2] + C[34]*Z[ 4] + C[35]*Y[ 4] + C[36]*X[ 1]*Z[ 4] + C[37]*X[ 1]*Y[ 4] + C[38]*X[ 4])*EXPR;
+    Y2 = Y*Y; Z2 = Z*Z;
+    R2 = X*X + Y2 + Z2;
+    R  = Lgm_SimdSqrt( R2 );
 
-    return;
+    EXPC = Lgm_SimdExp( -R/5.20 );
+    R2   = ( R2 > 900.0 ) ? 900.0 : R2;
+    EXPR = Lgm_SimdExp( -0.060*R2 );
+
+    *BX = Z*( OP88_R14( &A[1], X, Y2, Z2 )*EXPC + OP88_R14( &A[15], X, Y2, Z2 )*EXPR );
+    *BY = Y*Z*( OP88_O8( &B[1], X, Y2, Z2 )*EXPC + OP88_O8( &B[9], X, Y2, Z2 )*EXPR );
+    *BZ = OP88_E19( C, OP88_E19_C1, X, Y2, Z2 )*EXPC + OP88_E19( C, OP88_E19_C20, X, Y2, Z2 )*EXPR;
 
 }
 
+void Lgm_OP88_BFRING( double *XX,  double *BB ) {
+    BB[1] = BB[2] = BB[3] = 0.0;
+    OP88_Points( 1, &XX[1], &XX[2], &XX[3], &BB[1], &BB[2], &BB[3], 1.0, 0.0, 1.0, 0.0 );
+}
+
 
 
 
@@ -570,8 +565,111 @@ double  Lgm_OP88_RINGST( double SOFFD,  double DST ) {
  *
  */
 double Lgm_OP88_STDOFF( double VEL,  double DEN ) {
-    double  g, g2, g3, g6, STDOFF;
-    g = DEN*VEL*VEL; g2 = g*g; g3 = g*g2; g6 = g3*g3;
-    STDOFF = 98.0*g6;
+    double  STDOFF;
+    STDOFF = 98.0*pow( DEN*VEL*VEL, -1.0/6.0 );
     return( STDOFF );
 }
+
+
+/*
+ *  ADD THE DYNAMIC FIELD AT N POINTS INTO (BX, BY, BZ). THE MAGNETOPAUSE AND
+ *  TAIL EXPANSIONS ARE EVALUATED AT DISTANCES SCALED BY SCL, THE RING AT THE
+ *  ACTUAL DISTANCES (SEE Lgm_OP88_BDYNAM()).
+ */
+static void OP88_Points( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+                         double SCL, double STRMAG, double STRRIN, double STRTAI ) {
+
+    long int    i;
+    double      BX, BY, BZ, BMX, BMY, BMZ, BRX, BRY, BRZ, BTX, BTY, BTZ;
+
+    LGM_OP88_SIMD
+    for ( i=0; i<n; ++i ) {
+        OP88_MagP( x[i]*SCL, y[i]*SCL, z[i]*SCL, &BMX, &BMY, &BMZ );
+        OP88_Ring( x[i],     y[i],     z[i],     &BRX, &BRY, &BRZ );
+        OP88_Tail( x[i]*SCL, y[i]*SCL, z[i]*SCL, &BTX, &BTY, &BTZ );
+        BX = STRMAG*BMX + STRRIN*BRX + STRTAI*BTX;
+        BY = STRMAG*BMY + STRRIN*BRY + STRTAI*BTY;
+        BZ = STRMAG*BMZ + STRRIN*BRZ + STRTAI*BTZ;
+        bx[i] += BX; by[i] += BY; bz[i] += BZ;
+    }
+
+}
+
+
+/*
+ *  The dynamic scalings only depend on Info->Den, Info->V and Info->Dst, so
+ *  they are only redone when one of those changes.
+ */
+static void OP88_SetScalings( Lgm_MagModelInfo *Info ) {
+
+    double  SOFFD;
+
+    if ( ( Info->Den == Info->OP88_DEN ) && ( Info->V == Info->OP88_VEL ) && ( Info->Dst == Info->OP88_DST ) ) return;
+
+    SOFFD = Lgm_OP88_STDOFF( Info->V, Info->Den );
+
+    Info->OP88_SCL    = 10.5/SOFFD;
+    Info->OP88_STRMAG = Info->OP88_SCL*Info->OP88_SCL*Info->OP88_SCL;
+    Info->OP88_STRRIN = Lgm_OP88_RINGST( SOFFD, Info->Dst );
+    Info->OP88_STRTAI = Info->OP88_STRMAG;  // STAIL = 1
+
+    Info->OP88_DEN = Info->Den;
+    Info->OP88_VEL = Info->V;
+    Info->OP88_DST = Info->Dst;
+
+}
+
+
+/**
+ *  \brief
+ *      The OP88 external field at a point.
+ *
+ *  \details
+ *      Same as Lgm_OP88_BDYN() with the solar wind and Dst taken from Info
+ *      (Info->Den, Info->V, Info->Dst), but the dynamic scalings are only
+ *      worked out when those change.
+ *
+ *      \param[in]      v           Position (in Re).
+ *      \param[out]     B           External field (in nT).
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ *      \return         1
+ *
+ */
+int Lgm_OP88_External( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+
+    OP88_SetScalings( Info );
+
+    B->x = B->y = B->z = 0.0;
+    OP88_Points( 1, &v->x, &v->y, &v->z, &B->x, &B->y, &B->z, Info->OP88_SCL, Info->OP88_STRMAG, Info->OP88_STRRIN, Info->OP88_STRTAI );
+
+    return( 1 );
+
+}
+
+
+/**
+ *  \brief
+ *      Add the OP88 external field to n points.
+ *
+ *  \details
+ *      Batched version of Lgm_OP88_External(). The scalings are set up
+ *      once and the points go through the Horner form expansions under omp
+ *      simd. As in Lgm_B_OP88() the positions are used as given.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n x-coordinates (in Re).
+ *      \param[in]      y           Array of n y-coordinates (in Re).
+ *      \param[in]      z           Array of n z-coordinates (in Re).
+ *      \param[in,out]  bx          Array of n Bx values (in nT). The external field is added in.
+ *      \param[in,out]  by          Array of n By values (in nT). The external field is added in.
+ *      \param[in,out]  bz          Array of n Bz values (in nT). The external field is added in.
+ *      \param[in,out]  Info        A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_OP88_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    OP88_SetScalings( Info );
+    OP88_Points( n, x, y, z, bx, by, bz, Info->OP88_SCL, Info->OP88_STRMAG, Info->OP88_STRRIN, Info->OP88_STRTAI );
+
+}
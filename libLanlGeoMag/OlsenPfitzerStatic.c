@@ -1,6 +1,14 @@
+#include <config.h>
 #include <stdio.h>
 #include <math.h>
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_SimdMath.h"
+
+#if USE_OPENMP
+#define LGM_OP77_SIMD   _Pragma( "omp simd private(X,Y,Z,BX,BY,BZ)" )
+#else
+#define LGM_OP77_SIMD
+#endif
 /**
  *  Ported to C by Michael G. Henderson Spetember 17, 2010.
  *
@@ -139,11 +147,14 @@
  *
  */
 
-void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo *m ) {
 
-    int     I, J, K, Jp1, II, JJ, KK, IJK;
-    double  X, Y, Z, X2, Y2, Z2, R2, MYFAC;
-    double  BX, BY, BZ, CON, EXPR, XB, YEXB, ZEYEXB;
+/*
+ *  SET UP THE TILT INDEPENDENT COEFFICIENTS A-F FOR A GIVEN TILT (IN DEGREES).
+ *  ONLY DONE WHEN THE TILT CHANGES (SEE m->OP77_TILTL).
+ */
+static void OP77_SetTilt( double TILT, Lgm_MagModelInfo *m ) {
+
+    int     I, J, K, Jp1;
 
     static int ITA[]  =  { -99,  2, 1, 2, 1, 2, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 2, 1, 2, 2, 2, 1, 2, 1, 2, 1, 2, 1, 2, 2, 2, 1};
     static int ITB[]  =  { -99,  2, 1, 2, 1, 2, 2, 1, 2, 2, 2, 1, 2, 1, 2, 1, 2, 1, 2, 2, 2, 1, 2};
@@ -232,61 +243,6 @@ void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo
       -6.10021E-08};
 
 
-    /*
-     * SET UP SOME OF THE INITIAL POSITION VARIABLES
-     */
-    X  = XX[1]; X2 = X*X;
-    Y  = XX[2]; Y2 = Y*Y;
-    Z  = XX[3]; Z2 = Z*Z;
-    R2 = X2 + Y2 + Z2;
-
-
-    /*
-     * SET MAGNETIC FIELD VARIABLES TO ZERO
-     */
-    BX = BY = BZ = 0.0;
-
-
-    /*
-     * CHECK TO SEE IF POSITION IS WITHIN REGION OF VALIDITY
-     */
-    CON = 1.0;
-
-
-    /*
-     * IF DISTANCE TOO LARGE TAKE ERROR EXIT
-     */
-    if ( R2 > 225.0 ) {
-        MYFAC = R2*R2*R2/11390625.0; // Kludge to avoid power series from blowing up at large R2
-//        printf("OlsenPfitzerStatic: ( X, Y, Z ) = ( %10.3g, %10.3g, %10.3g ) BX, BY, BZ = %g %g %g IS OUTSIDE THE VALID REGION--POWER SERIES DIVERGES BFIELD IS SET TO ZERO\n", X, Y, Z, BX, BY, BZ );
-//        BF[1] = 0.0;
-//        BF[2] = 0.0;
-//        BF[3] = 0.0;
-//        return;
-    }
-/*
-*/
-
-
-    /*
-     * IF DISTANCE TOO SMALL SET FIELD TO ZERO AND EXIT
-     */
-    if ( R2 < 4.0 ){
-        BF[1] = 0.0;
-        BF[2] = 0.0;
-        BF[3] = 0.0;
-        return;
-    }
-
-    if ( R2 < 6.25 ) CON *= (R2-4.0)/2.25;
-
-
-
-
-
-    /*
-     * IF TILT HAS NOT CHANGED,  GO DRECTLY TO FIELD CALCULATION
-     */
     if ( m->OP77_TILTL != TILT ) {
 
         /*
@@ -324,82 +280,151 @@ void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo
 
     }
 
-    EXPR = exp( -0.06*R2 );
+    return;
 
+}
 
 
+/*
+ *  HORNER SUMS IN Z OF THE N TERMS P(K)+Q(K)*EXPR, K = K0..K0+N-1 (THE
+ *  COEFFICIENTS OF Z**0..Z**(N-1)). MACROS RATHER THAN A LOOP OR A FUNCTION
+ *  SO THAT EVERYTHING IS STRAIGHT LINE CODE IN THE BATCHED LOOP (OTHERWISE IT
+ *  DOESNT VECTORIZE).
+ */
+#define OP77_T( P, Q, K )   ( P[K] + Q[K]*EXPR )
+#define OP77_H1( P, Q, K )  OP77_T( P, Q, K )
+#define OP77_H2( P, Q, K )  ( OP77_T( P, Q, K ) + Z*OP77_H1( P, Q, (K)+1 ) )
+#define OP77_H3( P, Q, K )  ( OP77_T( P, Q, K ) + Z*OP77_H2( P, Q, (K)+1 ) )
+#define OP77_H4( P, Q, K )  ( OP77_T( P, Q, K ) + Z*OP77_H3( P, Q, (K)+1 ) )
+#define OP77_H5( P, Q, K )  ( OP77_T( P, Q, K ) + Z*OP77_H4( P, Q, (K)+1 ) )
 
+/*
+ *  THE POWER SERIES ITSELF, DONE IN HORNER FORM (IN Z, THEN Y**2, THEN X).
+ *  THE COEFFICIENTS ARE STORED WITH THE Z POWER VARYING FASTEST, THEN THE Y
+ *  POWER, THEN THE X POWER, SO E.G. FOR BX THE X**0*Y**0 RUN IS A(1..5),
+ *  X**0*Y**2 IS A(6..9), X**0*Y**4 IS A(10..11), X**1*Y**0 IS A(12..16)
+ *  ETC. THE RUNS GET SHORTER AS THE X AND Y POWERS GO UP SINCE THE TOTAL
+ *  POWER IS LIMITED (SEE THE DESCRIPTION AT THE TOP). BZ USES THE SAME
+ *  LAYOUT, BY HAS ONE LESS Z TERM IN EACH RUN.
+ */
+static inline void OP77_Series( double X, double Y, double Z, double EXPR, const Lgm_MagModelInfo *m, double *BX, double *BY, double *BZ ) {
+
+    double  Y2, X1, X2, X3, X4, X5;
+    const double *A = m->OP77_A, *B = m->OP77_B, *C = m->OP77_C, *D = m->OP77_D, *E = m->OP77_E, *F = m->OP77_F;
+
+    Y2 = Y*Y;
+
+    X1 = OP77_H5( A, B,  1 ) + Y2*( OP77_H4( A, B,  6 ) + Y2*OP77_H2( A, B, 10 ) );
+    X2 = OP77_H5( A, B, 12 ) + Y2*( OP77_H3( A, B, 17 ) + Y2*OP77_H1( A, B, 20 ) );
+    X3 = OP77_H4( A, B, 21 ) + Y2*OP77_H2( A, B, 25 );
+    X4 = OP77_H3( A, B, 27 ) + Y2*OP77_H1( A, B, 30 );
+    X5 = OP77_H2( A, B, 31 );
+    *BX = X1 + X*( X2 + X*( X3 + X*( X4 + X*X5 ) ) );
+
+    X1 = OP77_H5( E, F,  1 ) + Y2*( OP77_H4( E, F,  6 ) + Y2*OP77_H2( E, F, 10 ) );
+    X2 = OP77_H5( E, F, 12 ) + Y2*( OP77_H3( E, F, 17 ) + Y2*OP77_H1( E, F, 20 ) );
+    X3 = OP77_H4( E, F, 21 ) + Y2*OP77_H2( E, F, 25 );
+    X4 = OP77_H3( E, F, 27 ) + Y2*OP77_H1( E, F, 30 );
+    X5 = OP77_H2( E, F, 31 );
+    *BZ = X1 + X*( X2 + X*( X3 + X*( X4 + X*X5 ) ) );
+
+    X1 = OP77_H5( C, D,  1 ) + Y2*( OP77_H3( C, D,  6 ) + Y2*OP77_H1( C, D,  9 ) );
+    X2 = OP77_H4( C, D, 10 ) + Y2*OP77_H2( C, D, 14 );
+    X3 = OP77_H3( C, D, 16 ) + Y2*OP77_H1( C, D, 19 );
+    X4 = OP77_H2( C, D, 20 );
+    X5 = OP77_H1( C, D, 22 );
+    *BY = Y*( X1 + X*( X2 + X*( X3 + X*( X4 + X*X5 ) ) ) );
 
+}
 
-    /*
-     *  INITIALIZE THE POINTERS
-     */
-    II = 1; JJ = 1; KK = 1; XB = 1.0;
 
+/*
+ *  ADD THE FIELD AT N POINTS INTO (BX, BY, BZ). THE POSITIONS ARE ROTATED TO
+ *  SM (BY THE TILT WHOSE COS AND SIN ARE CP, SP) AND THE FIELD IS ROTATED
+ *  BACK. THE SCALAR ROUTINE COMES THROUGH HERE TOO (WITH N = 1 AND NO
+ *  ROTATION), SO THAT THERE IS ONLY ONE COPY OF THE SERIES TO INLINE.
+ */
+static void OP77_Points( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, double cp, double sp, Lgm_MagModelInfo *m ) {
 
-    /* 
-     * BEGIN SUM OVER X
-     */
-    for ( I=1; I<=5; I++ ) {
+    long int    i;
+    double      X, Y, Z, R2, CON, FAR, EXPR, BX, BY, BZ;
 
-        YEXB = XB;
+    LGM_OP77_SIMD
+    for ( i=0; i<n; ++i ) {
 
-        /* 
-         * BEGIN SUM OVER X
+        X = x[i]*cp - z[i]*sp;
+        Y = y[i];
+        Z = x[i]*sp + z[i]*cp;
+        R2 = X*X + Y*Y + Z*Z;
+
+        /*
+         * CON IS NORMALY ONE BUT INSIDE OF R = 2.5 IT GOES TO ZERO. INSIDE
+         * R = 2 IT IS ZERO. BEYOND 15 RE THE ORIGINAL CODE SET THE FIELD TO
+         * ZERO; HERE IT IS DIVIDED BY R**6/15**6 INSTEAD (KLUDGE TO AVOID THE
+         * POWER SERIES BLOWING UP AT LARGE R2). NO BRANCHES, SO THAT THIS
+         * VECTORIZES.
          */
-        for ( J=1; J<=3; J++ ) {
-    
-            if (I+2*J >  8) break;
-            ZEYEXB = YEXB;
-            IJK = I + 2*J + 1;
-            K = 1;
-
-            /* 
-             * Z LOOP STARTS HERE
-             */
-            do {
-                BZ += (m->OP77_E[KK]+m->OP77_F[KK]*EXPR)*ZEYEXB;
-                ++KK;
-                BX += (m->OP77_A[II]+m->OP77_B[II]*EXPR )*ZEYEXB;
-                ++II;
-                if ( IJK > 8 ) break;
-                BY += (m->OP77_C[JJ]+m->OP77_D[JJ]*EXPR )*ZEYEXB*Y;
-                ++JJ;
-                ZEYEXB *= Z;
-                ++IJK;
-                ++K;
-            } while ( (IJK <= 9) && (K <= 5) ) ;
-
-
-            YEXB *= Y2;
+        CON = (R2-4.0)/2.25;
+        CON = ( R2 < 4.0 ) ? 0.0 : CON;
+        CON = ( R2 < 6.25 ) ? CON : 1.0;
+        FAR = 11390625.0/(R2*R2*R2);
+        CON = ( R2 > 225.0 ) ? FAR : CON;
 
-        }
+        EXPR = Lgm_SimdExp( -0.06*R2 );
+        OP77_Series( X, Y, Z, EXPR, m, &BX, &BY, &BZ );
+        BX *= CON; BY *= CON; BZ *= CON;
 
-        XB *= X;
+        bx[i] +=  BX*cp + BZ*sp;
+        by[i] +=  BY;
+        bz[i] += -BX*sp + BZ*cp;
 
     }
 
+}
+
+
+void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo *m ) {
 
     /*
-     * SET UP THE OUTPUT ARRAY,  MULTIPLY BY CON. CON IS NORMALY ONE
-     * BUT INSIDE OF R = 2.5 IT GOES TO ZERO. INSIDE R = 2 IT IS ZERO.
+     * IF TILT HAS NOT CHANGED,  GO DRECTLY TO FIELD CALCULATION
      */
-    BF[1] = BX*CON;
-    BF[2] = BY*CON;
-    BF[3] = BZ*CON;
-
-    if ( R2 > 225.0 ) {
-        // Kludge to avoid diverging power series. MYFAC has an R^6 in the demon.
-        BF[1] = BX/MYFAC;
-        BF[2] = BY/MYFAC;
-        BF[3] = BZ/MYFAC;
-        //printf("OlsenPfitzerStatic: ( X, Y, Z ) = ( %10.3g, %10.3g, %10.3g ) BX, BY, BZ = %g %g %g IS OUTSIDE THE VALID REGION--POWER SERIES DIVERGES BFIELD IS SET TO ZERO\n", X, Y, Z, BX, BY, BZ );
-    }
+    if ( m->OP77_TILTL != TILT ) OP77_SetTilt( TILT, m );
 
+    BF[1] = BF[2] = BF[3] = 0.0;
+    OP77_Points( 1, &XX[1], &XX[2], &XX[3], &BF[1], &BF[2], &BF[3], 1.0, 0.0, m );
 
     return;
 
+}
+
+
+/**
+ *  \brief
+ *      Add the OP77 external field to n points.
+ *
+ *  \details
+ *      Batched version of the external part of Lgm_B_OP77(). The tilt
+ *      coefficients are set up once, the GSM<->SM rotations are done inline
+ *      and the points go through the Horner form series under omp simd.
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[in,out]  bx          Array of n GSM Bx values (in nT). The external field is added in.
+ *      \param[in,out]  by          Array of n GSM By values (in nT). The external field is added in.
+ *      \param[in,out]  bz          Array of n GSM Bz values (in nT). The external field is added in.
+ *      \param[in,out]  m           A properly initialized and configured Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_OP77_External_Batch( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *m ) {
+
+    double      TILT;
 
+    TILT = m->c->psi*DegPerRad;
+    if ( m->OP77_TILTL != TILT ) OP77_SetTilt( TILT, m );
+
+    OP77_Points( n, x, y, z, bx, by, bz, m->c->cos_psi, m->c->sin_psi, m );
 
 }
 
@@ -408,4 +433,3 @@ void OlsenPfitzerStatic( double XX[], double BF[], double TILT, Lgm_MagModelInfo
 /*
  *   $Id$
  */
-
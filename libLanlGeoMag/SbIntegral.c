@@ -38,8 +38,9 @@ double SbIntegral( Lgm_MagModelInfo *fInfo ) {
 
     double	a, b;
     double	epsabs, epsrel, result, abserr;
-    int		npts, key, neval, ier, leniw, lenw, last, iwork[501];
-    double	work[2002], points[20];
+    int		npts, key, neval, ier, leniw, lenw, last;
+    double	points[20];
+    Lgm_QuadPackWork *qw;
     _qpInfo	*qpInfo;
 
 
@@ -77,7 +78,8 @@ double SbIntegral( Lgm_MagModelInfo *fInfo ) {
 
 
 
-    leniw = 500;
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, fInfo )) == NULL ) return( LGM_FILL_VALUE );
+    leniw = qw->Limit;
     lenw  = 4*leniw;
     key   = 6;
     //iwork  = (int *) calloc( limit+1, sizeof(int) );
@@ -86,7 +88,7 @@ double SbIntegral( Lgm_MagModelInfo *fInfo ) {
     points[1] = a;
     points[2] = b;
     npts = 4;
-    dqagp(Sb_integrand, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, iwork, work, fInfo->VerbosityLevel );
+    dqagp(Sb_integrand, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, qw->iwork, qw->work, fInfo->VerbosityLevel );
     //free( iwork );
     //free( work );
 
@@ -106,8 +108,9 @@ double SbIntegral_interped( Lgm_MagModelInfo *fInfo ) {
 
     double	a, b;
     double	epsabs, epsrel, result, abserr;
-    int		npts, key, neval, ier, leniw, lenw, last, iwork[501];
-    double	work[2002], points[20];
+    int		npts, key, neval, ier, leniw, lenw, last;
+    double	points[20];
+    Lgm_QuadPackWork *qw;
     _qpInfo	*qpInfo;
 
 
@@ -138,7 +141,8 @@ double SbIntegral_interped( Lgm_MagModelInfo *fInfo ) {
     epsrel = fInfo->Lgm_Sb_Integrator_epsrel;
 
 
-    leniw = 500;
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, fInfo )) == NULL ) return( LGM_FILL_VALUE );
+    leniw = qw->Limit;
     lenw  = 4*leniw;
     key   = 6;
 
@@ -156,7 +160,7 @@ double SbIntegral_interped( Lgm_MagModelInfo *fInfo ) {
 //    points[1] = a;
 //    points[2] = b;
     npts = 2;
-    dqagp(Sb_integrand_interped, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, iwork, work, fInfo->VerbosityLevel );
+    dqagpv(Sb_integrand_interped_v, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, qw->iwork, qw->work, fInfo->VerbosityLevel );
 /*
 printf("here i am\n");
 double s;
@@ -189,8 +193,9 @@ double SbIntegral_interped2( Lgm_MagModelInfo *fInfo, double a, double b ) {
 
 //    double	a, b;
     double	epsabs, epsrel, result, abserr;
-    int		npts, key, neval, ier, leniw, lenw, last, iwork[501];
-    double	work[2002], points[20];
+    int		npts, key, neval, ier, leniw, lenw, last;
+    double	points[20];
+    Lgm_QuadPackWork *qw;
     _qpInfo	*qpInfo;
 
 
@@ -221,7 +226,8 @@ double SbIntegral_interped2( Lgm_MagModelInfo *fInfo, double a, double b ) {
     epsrel = fInfo->Lgm_Sb_Integrator_epsrel;
 
 
-    leniw = 500;
+    if ( (qw = Lgm_MagModelInfo_QuadPackWork( LGM_QUADPACK_WORK_OUTER, fInfo )) == NULL ) return( LGM_FILL_VALUE );
+    leniw = qw->Limit;
     lenw  = 4*leniw;
     key   = 6;
 
@@ -239,7 +245,7 @@ double SbIntegral_interped2( Lgm_MagModelInfo *fInfo, double a, double b ) {
 //    points[1] = a;
 //    points[2] = b;
     npts = 2;
-    dqagp(Sb_integrand_interped, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, iwork, work, fInfo->VerbosityLevel );
+    dqagpv(Sb_integrand_interped_v, qpInfo, a, b, npts, points, epsabs, epsrel, &result, &abserr, &neval, &ier, leniw, lenw, &last, qw->iwork, qw->work, fInfo->VerbosityLevel );
 /*
 printf("here i am\n");
 double s;
@@ -276,6 +282,29 @@ double Sb_integrand_interped( double s, _qpInfo *qpInfo ) {
 
 }
 
+/*
+ *  Sb_integrand_interped() at the n points s[] in one call (the batch
+ *  integrand for dqagpv()). B comes from BofS_N().
+ */
+void Sb_integrand_interped_v( int n, const double *s, double *f, _qpInfo *qpInfo ) {
+
+    int                 i;
+    double              g, h;
+    Lgm_MagModelInfo	*fInfo;
+
+    fInfo = (Lgm_MagModelInfo *)qpInfo;
+
+    BofS_N( n, s, f, fInfo );
+    for ( i=0; i<n; i++ ) {
+        g = 1.0 - f[i]/fInfo->Bm;
+        h = (g > 0.0) ? sqrt( g ) : 0.0;
+        f[i] = (h==0.0) ? 0.0 : 1.0/h;
+    }
+
+    fInfo->Lgm_n_Sb_integrand_Calls += n;
+
+}
+
 
 
 double Sb_integrand( double s, _qpInfo *qpInfo ) {
@@ -1,9 +1,11 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 int Lgm_B_T01S( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector  B2;
     int		    iopt;
     double	    parmod[11], ps, X, Y, Z, Bx, By, Bz;
+    LGM_STATS_START( t0 );
 
 
     parmod[1]  = Info->P; 	// Pressure in nPa
@@ -19,6 +21,7 @@ int Lgm_B_T01S( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     X = v->x; Y = v->y; Z = v->z;
 
     Tsyg_T01S( iopt, parmod, ps, Info->c->sin_psi, Info->c->cos_psi, X, Y, Z, &Bx, &By, &Bz, &Info->T01_Info );
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_T01S, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
@@ -50,3 +53,39 @@ int Lgm_B_T01S( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 /*
  *   $id$
  */
+
+
+/**
+ *  \brief
+ *      Compute the point-independent part of the T01S model for the current epoch.
+ *
+ *  \details
+ *      Packs the solar wind inputs held in Info the same way Lgm_B_T01S()
+ *      does and fills Info->T01_Info with everything that depends only on them
+ *      and on the dipole tilt (amplitudes, scalings, magnetopause
+ *      parameters), so that subsequent calls to Lgm_B_T01S() only do the
+ *      spatial part of the calculation.
+ *
+ *      This is optional: Tsyg_T01S() compares its inputs against the prepared
+ *      ones on every call and re-prepares automatically when they differ
+ *      (e.g. after Lgm_set_QinDenton() or Lgm_Set_Coord_Transforms()).
+ *      Calling it up front just moves the setup cost out of the first field
+ *      evaluation.
+ *
+ *      \param[in,out]   Info    Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_T01S_Prepare( Lgm_MagModelInfo *Info ) {
+
+    double      parmod[11];
+
+    parmod[1] = Info->P;       // Pressure in nPa
+    parmod[2] = Info->Dst;     // Dst in nT
+    parmod[3] = Info->By;      // IMF By in nT
+    parmod[4] = Info->Bz;      // IMF Bz in nT
+    parmod[5] = Info->G2;      // G2
+    parmod[6] = Info->G3;      // G3
+
+    Lgm_Prepare_T01S( parmod, Info->c->psi, Info->c->sin_psi, Info->c->cos_psi, &Info->T01_Info );
+
+}
@@ -20,6 +20,7 @@
  *
  *
  */
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 
 /*
@@ -325,6 +326,7 @@ int Lgm_B3_T87( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 int Lgm_B_T87( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector 	B1, B2, B3, B4;
+    LGM_STATS_START( t0 );
 
     if ( Info->Kp > 5 ) Info->Kp = 5;
 
@@ -332,6 +334,7 @@ int Lgm_B_T87( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     Lgm_B2_T87( v, &B2,  Info );
     Lgm_B3_T87( v, &B3,  Info );
 
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_T87, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
@@ -25,7 +25,15 @@
  *
  */
 
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
+#include "Lgm/Lgm_MagStepKernels.h"
+
+#if USE_OPENMP
+#define LGM_T89_SIMD    _Pragma( "omp simd private(Bx,By,Bz)" )
+#else
+#define LGM_T89_SIMD
+#endif
 
 /*
  *  The 39 constant parameters for the 6 T89 Kp models -- there
@@ -50,7 +58,7 @@
  *
  *
  */
-static double Lgm_T89_a[6][39] = {
+static const double Lgm_T89_a[6][39] = {
     { -98.72,   -10014.0, 15.03,    76.62,    -10237.0, 1.813, 
       31.10,    -0.07464, -0.07764, 0.003303, -1.129,   0.001663,
       0.000988, 18.21,    -0.03018, -0.03829, -0.1283,  -0.001973,     /* Kp =     0, 0+ */
@@ -98,7 +106,7 @@ static double Lgm_T89_a[6][39] = {
 
 
 
-int Lgm_BT_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+static inline void T89_BT( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info, const double *p ) {
 
 
     double	   sin_psi, cos_psi, tan_psi;
@@ -110,12 +118,6 @@ int Lgm_BT_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     double	   p28_2, p28_4, x_sm_2, y_sm_2, y_sm_3, y_sm_4, gg, gg2, aa, aa2, hh, bb, bb2, S_T_2;
     double	   p26_2, p29_2, p31_2, cc, cc2, pp;
     double	   zz, ss, ss12, ss32, tt, tt12, tt32, uu, uu12, uu32, nn, oonn, ooS_T, ooP, ooS_T_2, qtzr;
-    double    *p;
-
-    int indx = Info->Kp;
-    if (indx < 0) indx = 0;
-    if (indx > 5) indx = 5;
-    p = Lgm_T89_a[indx];
 
 
     sin_psi = Info->c->sin_psi;
@@ -218,13 +220,13 @@ int Lgm_BT_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     B->y =  BT_ysm;
     B->z = -BT_xsm*sin_psi + BT_zsm*cos_psi;
 
-    return(1);
+    return;
 
 }
 
 
 
-int Lgm_BRC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ){
+static inline void T89_BRC( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info, const double *p ) {
 
 
     double 	   sin_psi, cos_psi, tan_psi;
@@ -235,12 +237,6 @@ int Lgm_BRC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ){
     double 	   z_sx, z_sy, D_RCx;
     double 	   p28_2, p28_4, y_sm_2, y_sm_3, y_sm_4, gg, gg2, ff, ff2, S_RC2, S_RC3, S_RC_5, hh;
     double	   x_sm_2, ee, ss, ss12, ss32, tt, tt12, tt32, p30_2, qrczr;
-    double    *p;
-
-    int indx = Info->Kp;
-    if (indx < 0) indx = 0;
-    if (indx > 5) indx = 5;
-    p = Lgm_T89_a[indx];
 
 
 
@@ -326,22 +322,16 @@ int Lgm_BRC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ){
     B->y = BRC_ysm;
     B->z = -BRC_xsm*sin_psi + BRC_zsm*cos_psi;
 
-    return(1);
+    return;
 
 }
 
 
 
-int Lgm_BM_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+static inline void T89_BM( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info, const double *p ) {
 
     double 	   sin_psi, cos_psi;
     double	   x, y, y2, z, z2, exod_x;
-    double    *p;
-
-    int indx = Info->Kp;
-    if (indx < 0) indx = 0;
-    if (indx > 5) indx = 5;
-    p = Lgm_T89_a[indx];
 
 
     sin_psi = Info->c->sin_psi;
@@ -357,11 +347,11 @@ int Lgm_BM_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     B->y = exod_x * (p[9] * y * z * cos_psi + (p[10] * y + p[11] * y*y2 + p[12] * y * z2) *sin_psi);
     B->z = exod_x * ((p[13] + p[14] * y2 + p[15] * z2) * cos_psi + (p[16] * z + p[17] * z * y2 + p[18] * z*z2) * sin_psi);
 
-    return(1);
+    return;
 }
 
 
-int Lgm_BC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+static inline void T89_BC( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info, const double *p ) {
 
     double	   sin_psi, cos_psi, x, y, z;
     double 	   W_c, W_cx, W_cy, S_p, S_m;
@@ -369,12 +359,6 @@ int Lgm_BC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     double	   p38_2, aa, aa2;
     double	   x2, y2, x2py2, zpp35, zmp35, wcx, wcy, cc, dd, ff, gg, ffcc, ggdd, zz;
     double	   psp, ss, ss12, ss32, ee, oop38_2;
-    double    *p;
-
-    int indx = Info->Kp;
-    if (indx < 0) indx = 0;
-    if (indx > 5) indx = 5;
-    p = Lgm_T89_a[indx];
 
 
     x = v->x;
@@ -437,23 +421,343 @@ int Lgm_BC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     B->y = p[2]*(F_py + F_my) + psp*(F_py - F_my);
     B->z = p[2]*(F_pz + F_mz) + psp*(F_pz - F_mz);
 
+    return;
+}
+
+
+/*
+ *  Returns the row of Lgm_T89_a[] to use for Info->Kp.
+ */
+static inline int Lgm_T89_KpIndex( Lgm_MagModelInfo *Info ) {
+    int indx = Info->Kp;
+    if (indx < 0) indx = 0;
+    if (indx > 5) indx = 5;
+    return( indx );
+}
+
+
+/*
+ *  The individual current systems with the coefficients selected from
+ *  Info->Kp at run time.
+ */
+int Lgm_BT_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    T89_BT( v, B, Info, Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ] );
+    return(1);
+}
+
+int Lgm_BRC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    T89_BRC( v, B, Info, Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ] );
+    return(1);
+}
+
+int Lgm_BM_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    T89_BM( v, B, Info, Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ] );
     return(1);
 }
 
+int Lgm_BC_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    T89_BC( v, B, Info, Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ] );
+    return(1);
+}
+
+
 
+/*
+ *  Kp-specialized versions of the whole external field. Each instance has
+ *  its row of Lgm_T89_a[] fixed at compile time, so once the component
+ *  routines are inlined the compiler can fold all of the coefficients (and
+ *  the products of them, like p[28]^4) into constants.
+ */
+#define LGM_T89_KERNEL( k ) \
+static void T89_External_Kp##k( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) { \
+    Lgm_Vector  B1, B2, B3, B4; \
+    T89_BT(  v, &B1, Info, Lgm_T89_a[k] ); \
+    T89_BRC( v, &B2, Info, Lgm_T89_a[k] ); \
+    T89_BM(  v, &B3, Info, Lgm_T89_a[k] ); \
+    T89_BC(  v, &B4, Info, Lgm_T89_a[k] ); \
+    B->x = B1.x + B2.x + B3.x + B4.x; \
+    B->y = B1.y + B2.y + B3.y + B4.y; \
+    B->z = B1.z + B2.z + B3.z + B4.z; \
+}
 
+LGM_T89_KERNEL( 0 )
+LGM_T89_KERNEL( 1 )
+LGM_T89_KERNEL( 2 )
+LGM_T89_KERNEL( 3 )
+LGM_T89_KERNEL( 4 )
+LGM_T89_KERNEL( 5 )
 
+static void (* const T89_External_Kp[6])( Lgm_Vector *, Lgm_Vector *, Lgm_MagModelInfo * ) = {
+    T89_External_Kp0, T89_External_Kp1, T89_External_Kp2,
+    T89_External_Kp3, T89_External_Kp4, T89_External_Kp5
+};
 
-int Lgm_B_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
-    Lgm_Vector      B1, B2, B3, B4, B5;
+/**
+ *  \brief
+ *      External (magnetospheric) part of the T89 field.
+ *
+ *  \details
+ *      Returns the sum of the tail, ring current, magnetopause and
+ *      closure current contributions (i.e. Lgm_B_T89() without the internal
+ *      field). The work is done by the kernel specialized for Info->Kp.
+ *      Info->Kp is looked up on every call, so it is fine to change it
+ *      between calls.
+ *
+ *      \param[in]       v       Position (GSM, in Re).
+ *      \param[out]      B       External field (GSM, in nT).
+ *      \param[in,out]   Info    Lgm_MagModelInfo structure.
+ *
+ *      \return          1
+ *
+ */
+int Lgm_T89_External( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    T89_External_Kp[ Lgm_T89_KpIndex( Info ) ]( v, B, Info );
+    return(1);
+}
+
+
+
+
+
+/*
+ *  Single precision (float) version of the whole external field, for
+ *  Lgm_T89_External_Batch_f32(). Same expressions as T89_BT(), T89_BRC(),
+ *  T89_BM() and T89_BC(), with the per-epoch and per-Kp constants worked out
+ *  once (in double) by the caller and passed in q[]:
+ *
+ *      q[0..38]    p[] (the Kp row of Lgm_T89_a)
+ *      q[39..41]   sin_psi, cos_psi, tan_psi
+ *      q[42..48]   p28^4, p26^2, p29^2, p31^2, p30^2, p38^2, 1/p19
+ */
+#define T89F_NQ     LGM_T89_NPARAMS
+
+static inline void T89_External_f32( float x, float y, float z, const float *q, float *Bx, float *By, float *Bz ) {
+
+    const float *p = q;
+    float       sin_psi = q[39], cos_psi = q[40], tan_psi = q[41];
+    float       p28_4 = q[42], p26_2 = q[43], p29_2 = q[44], p31_2 = q[45], p30_2 = q[46], p38_2 = q[47], oop19 = q[48];
+    float       x_sm, y_sm, z_sm, x_sm_2, y_sm_2, y_sm_3, y_sm_4, rho2, gg, ee, hh, z_s, z_sx, z_sy, z_r, aa, tt12, tt32;
+    float       h_1, uu12, uu32, h_T, D_T, D_Tx, D_Ty, oonn, cc, ss12, ss32, W, W_x, W_y, xi_T, bb, S_T, ooS_T, ooS_T_2, ooP, Q_T;
+    float       D_RC, D_RCx, xi_RC, ff, ff2, S_RC, S_RC2, S_RC_5, Q_RC;
+    float       Bxsm, Bysm, Bzsm, t, exod_x, y2, z2;
+    float       W_c, W_cx, W_cy, S_p, S_m, zpp35, zmp35, x2py2, ffcc, ggdd, F_px, F_mx, F_py, F_my, F_pz, F_mz, psp;
+
+    x_sm = x*cos_psi - z*sin_psi;
+    y_sm = y;
+    z_sm = x*sin_psi + z*cos_psi;
+
+    x_sm_2 = x_sm*x_sm;
+    y_sm_2 = y_sm*y_sm;
+    y_sm_3 = y_sm_2*y_sm;
+    y_sm_4 = y_sm_2*y_sm_2;
+    rho2   = x_sm_2 + y_sm_2;
+
+    /*
+     *  Warping of the current sheet (common to BT and BRC)
+     */
+    gg   = y_sm_4 + p28_4;
+    ee   = x_sm + p[23];
+    hh   = sqrtf( ee*ee + 16.0f );
+    z_s  = 0.5f*tan_psi*(ee-hh) - p[24]*sin_psi*y_sm_4/gg;
+    z_sx = 0.5f*(1.0f - ee/hh)*tan_psi;
+    z_sy = -4.0f*p[24]*y_sm_3*p28_4*sin_psi/(gg*gg);
+    z_r  = z_sm - z_s;
+    aa   = x_sm + 16.0f;
+    tt12 = sqrtf( aa*aa + 36.0f );
+    tt32 = tt12*(aa*aa + 36.0f);
+    h_1  = 0.5f*(1.0f - aa/tt12);
+
+    /*
+     *  Tail (BT)
+     */
+    uu12  = sqrtf( x_sm_2 + p31_2 );
+    uu32  = uu12*(x_sm_2 + p31_2);
+    h_T   = 0.5f*(1.0f + x_sm/uu12);
+    D_T   = p[21] + p[33]*y_sm_2 + p[32]*h_T + p[34]*h_1;
+    D_Tx  = p[32]*p31_2/(2.0f*uu32) - 18.0f*p[34]/tt32;
+    D_Ty  = 2.0f*p[33]*y_sm;
+    oonn  = 1.0f/(1.0f + y_sm_2/p26_2);
+    cc    = x_sm - p[27];
+    ss12  = sqrtf( cc*cc + p29_2 );
+    ss32  = ss12*(cc*cc + p29_2);
+    W     = 0.5f*(1.0f - cc/ss12)*oonn;
+    W_x   = -0.5f*p29_2*oonn/ss32;
+    W_y   = -2.0f*y_sm*W/(y_sm_2 + p26_2);
+    xi_T  = sqrtf( z_r*z_r + D_T*D_T );
+    bb    = p[25] + xi_T;
+    S_T   = sqrtf( rho2 + bb*bb );
+    ooS_T = 1.0f/S_T;
+    ooS_T_2 = ooS_T*ooS_T;
+    ooP   = 1.0f/(S_T + bb);
+    Q_T   = W/(xi_T*S_T)*(p[0]*ooP + p[1]*ooS_T_2);
+    t     = Q_T*z_r;
+    Bxsm  = t*x_sm;
+    Bysm  = t*y_sm;
+    Bzsm  = W*ooS_T*(p[0] + p[1]*bb*ooS_T_2) + (x_sm*W_x + y_sm*W_y)*ooP*(p[0] + p[1]*ooS_T)
+            + Bxsm*z_sx + Bysm*z_sy - Q_T*D_T*(x_sm*D_Tx + y_sm*D_Ty);
+
+    /*
+     *  Ring current (BRC)
+     */
+    uu12   = sqrtf( x_sm_2 + p30_2 );
+    uu32   = uu12*(x_sm_2 + p30_2);
+    D_RC   = p[21] + p[22]*0.5f*(1.0f + x_sm/uu12) + p[34]*h_1;
+    D_RCx  = 0.5f*p[22]*p30_2/uu32 - 18.0f*p[34]/tt32;
+    xi_RC  = sqrtf( z_r*z_r + D_RC*D_RC );
+    ff     = p[20] + xi_RC; ff2 = ff*ff;
+    S_RC   = sqrtf( rho2 + ff2 );
+    S_RC2  = S_RC*S_RC; S_RC_5 = S_RC2*S_RC2*S_RC;
+    Q_RC   = 3.0f*p[4]/(xi_RC*S_RC_5)*ff;
+    t      = Q_RC*z_r;
+    Bxsm  += t*x_sm;
+    Bysm  += t*y_sm;
+    Bzsm  += p[4]*(2.0f*ff2 - rho2)/S_RC_5 + t*x_sm*z_sx + t*y_sm*z_sy - Q_RC*D_RC*x_sm*D_RCx;
+
+    *Bx =  Bxsm*cos_psi + Bzsm*sin_psi;
+    *By =  Bysm;
+    *Bz = -Bxsm*sin_psi + Bzsm*cos_psi;
+
+    /*
+     *  Magnetopause (BM)
+     */
+    y2 = y*y; z2 = z*z;
+    exod_x = expf( x*oop19 );
+    *Bx += exod_x*(p[5]*z*cos_psi + (p[6] + p[7]*y2 + p[8]*z2)*sin_psi);
+    *By += exod_x*(p[9]*y*z*cos_psi + (p[10]*y + p[11]*y*y2 + p[12]*y*z2)*sin_psi);
+    *Bz += exod_x*((p[13] + p[14]*y2 + p[15]*z2)*cos_psi + (p[16]*z + p[17]*z*y2 + p[18]*z*z2)*sin_psi);
+
+    /*
+     *  Closure currents (BC)
+     */
+    x2py2 = x*x + y2;
+    aa    = x - p[36];
+    ss12  = sqrtf( aa*aa + p[37] );
+    ss32  = ss12*(aa*aa + p[37]);
+    ee    = 1.0f/(1.0f + y2/p38_2);
+    W_c   = 0.5f*(1.0f - aa/ss12)*ee;
+    W_cx  = -0.5f*p[37]*ee/ss32;
+    W_cy  = -2.0f*y*W_c/(y2 + p38_2);
+    zpp35 = z + p[35];
+    zmp35 = z - p[35];
+    S_p   = sqrtf( zpp35*zpp35 + x2py2 );
+    S_m   = sqrtf( zmp35*zmp35 + x2py2 );
+    ffcc  = 1.0f/((S_p + zpp35)*S_p);
+    ggdd  = 1.0f/((S_m - zmp35)*S_m);
+    t     = x*W_cx + y*W_cy;
+    F_px  =  W_c*x*ffcc;
+    F_mx  = -W_c*x*ggdd;
+    F_py  =  W_c*y*ffcc;
+    F_my  = -W_c*y*ggdd;
+    F_pz  =  W_c/S_p + t/(S_p + zpp35);
+    F_mz  =  W_c/S_m + t/(S_m - zmp35);
+    psp   = p[3]*sin_psi;
+    *Bx  += p[2]*(F_px + F_mx) + psp*(F_px - F_mx);
+    *By  += p[2]*(F_py + F_my) + psp*(F_py - F_my);
+    *Bz  += p[2]*(F_pz + F_mz) + psp*(F_pz - F_mz);
+
+}
+
+
+/**
+ *  \brief
+ *      The per-epoch constants of the T89 external field.
+ *
+ *  \details
+ *      Fills q[0..LGM_T89_NPARAMS-1] with the Kp row of the T89 coefficients
+ *      and the tilt and other constants that the flattened kernels use (see
+ *      T89_External_f32() for the layout). Used by
+ *      Lgm_T89_External_Batch_f32() and by the offloaded kernels in
+ *      Lgm_B_Offload.c, which cant see the coefficient table.
+ *
+ *      \param[out]     q           Array of LGM_T89_NPARAMS values.
+ *      \param[in]      Info        Lgm_MagModelInfo structure (Kp and the transforms are used).
+ *
+ */
+void Lgm_T89_Params( double *q, Lgm_MagModelInfo *Info ) {
+
+    int             k;
+    const double    *p = Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ];
+
+    for ( k=0; k<39; k++ ) q[k] = p[k];
+    q[39] = Info->c->sin_psi;
+    q[40] = Info->c->cos_psi;
+    q[41] = Info->c->tan_psi;
+    q[42] = p[28]*p[28]*p[28]*p[28];
+    q[43] = p[26]*p[26];
+    q[44] = p[29]*p[29];
+    q[45] = p[31]*p[31];
+    q[46] = p[30]*p[30];
+    q[47] = p[38]*p[38];
+    q[48] = 1.0/p[19];
+
+}
+
+
+/**
+ *  \brief
+ *      Add the T89 external field to n points, computed in single precision.
+ *
+ *  \details
+ *      Used by the batched T89 kernels when Info->ExternalPrecision is
+ *      LGM_PRECISION_SINGLE. The external field is computed in float (so
+ *      twice as many points fit in a SIMD register) and added into the
+ *      double precision (bx, by, bz), which hold the internal field. The
+ *      positions and the internal field stay in double.
+ *
+ *      The error is that of float arithmetic on the terms of the model.
+ *      Against the double precision kernel (every Kp, 1.5 to 30 Re) the
+ *      external field differs by less than 2e-4 nT inside of 15 Re and
+ *      0.02 nT out to 30 Re, and by less than 1e-4 of its size -- far
+ *      below what the model itself is good to. Dont use it where
+ *      differences of the field between nearby points matter (e.g. finite
+ *      difference gradients with small steps).
+ *
+ *      \param[in]      n           Number of points.
+ *      \param[in]      x           Array of n GSM x-coordinates (in Re).
+ *      \param[in]      y           Array of n GSM y-coordinates (in Re).
+ *      \param[in]      z           Array of n GSM z-coordinates (in Re).
+ *      \param[in,out]  bx          Array of n GSM Bx values (in nT) to add to.
+ *      \param[in,out]  by          Array of n GSM By values (in nT) to add to.
+ *      \param[in,out]  bz          Array of n GSM Bz values (in nT) to add to.
+ *      \param[in]      Info        Lgm_MagModelInfo structure (Kp and the transforms are used).
+ *
+ */
+void Lgm_T89_External_Batch_f32( long int n, const double *x, const double *y, const double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *Info ) {
+
+    long int        i;
+    int             k;
+    float           q[T89F_NQ], Bx, By, Bz;
+    double          qd[LGM_T89_NPARAMS];
+
+    Lgm_T89_Params( qd, Info );
+    for ( k=0; k<T89F_NQ; k++ ) q[k] = (float)qd[k];
+
+    LGM_T89_SIMD
+    for ( i=0; i<n; i++ ) {
+        T89_External_f32( (float)x[i], (float)y[i], (float)z[i], q, &Bx, &By, &Bz );
+        bx[i] += Bx;
+        by[i] += By;
+        bz[i] += Bz;
+    }
+
+}
+
+
+
+/*
+ *  Lgm_B_T89() with the internal model passed in. With a constant there (as
+ *  in the instance below) the switch goes away.
+ */
+static inline int Lgm_B_T89_Body( Lgm_Vector *v, Lgm_Vector *B, int InternalModel, Lgm_MagModelInfo *Info ) {
+
+    Lgm_Vector      B1, B5;
+    LGM_STATS_START( t0 );
 
 
-    Lgm_BT_T89(  v, &B1, Info );
-    Lgm_BRC_T89( v, &B2, Info );
-    Lgm_BM_T89(  v, &B3, Info );
-    Lgm_BC_T89(  v, &B4, Info );
-    switch ( Info->InternalModel ){
+    T89_External_Kp[ Lgm_T89_KpIndex( Info ) ]( v, &B1, Info );
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_T89, t0 );
+    switch ( InternalModel ){
 
         case LGM_CDIP:
                         Lgm_B_cdip( v, &B5, Info );
@@ -465,7 +769,7 @@ int Lgm_B_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
                         Lgm_B_igrf( v, &B5, Info );
                         break;
         default:
-                        fprintf(stderr, "Lgm_B_T89: Unknown internal model (%d)\n", Info->InternalModel );
+                        fprintf(stderr, "Lgm_B_T89: Unknown internal model (%d)\n", InternalModel );
                         break;
 
     }
@@ -474,9 +778,9 @@ int Lgm_B_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
 
 
-    B->x = B1.x + B2.x + B3.x + B4.x + B5.x;
-    B->y = B1.y + B2.y + B3.y + B4.y + B5.y;
-    B->z = B1.z + B2.z + B3.z + B4.z + B5.z;
+    B->x = B1.x + B5.x;
+    B->y = B1.y + B5.y;
+    B->z = B1.z + B5.z;
 /*
     B->x = B5.x;
     B->y = B5.y;
@@ -490,3 +794,333 @@ int Lgm_B_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
 }
 
+int Lgm_B_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    return( Lgm_B_T89_Body( v, B, Info->InternalModel, Info ) );
+}
+
+/*
+ *  T89 with IGRF, and the integrator kernels compiled against it (see
+ *  Lgm_MagStepKernels.h).
+ */
+static int Lgm_B_T89_IGRF( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    return( Lgm_B_T89_Body( v, B, LGM_IGRF, Info ) );
+}
+LGM_MAGSTEP_KERNELS( T89_IGRF, Lgm_B_T89_IGRF )
+
+
+
+
+
+/*
+ *  Forward-mode dual numbers used by Lgm_B_T89_Jacobian(). A T89_Dual holds a
+ *  value and its gradient with respect to the GSM position, so pushing the
+ *  seeded coordinates through the same expressions as above gives the field
+ *  and the exact Jacobian in one pass.
+ */
+typedef struct T89_Dual {
+    double  f;      // value
+    double  d[3];   // d/dx, d/dy, d/dz (GSM)
+} T89_Dual;
+
+static inline T89_Dual D_var( double f, double dx, double dy, double dz ) {
+    T89_Dual r; r.f = f; r.d[0] = dx; r.d[1] = dy; r.d[2] = dz; return( r );
+}
+static inline T89_Dual D_add( T89_Dual a, T89_Dual b ) {
+    T89_Dual r; int i; r.f = a.f + b.f; for (i=0; i<3; i++) r.d[i] = a.d[i] + b.d[i]; return( r );
+}
+static inline T89_Dual D_sub( T89_Dual a, T89_Dual b ) {
+    T89_Dual r; int i; r.f = a.f - b.f; for (i=0; i<3; i++) r.d[i] = a.d[i] - b.d[i]; return( r );
+}
+static inline T89_Dual D_addc( T89_Dual a, double c ) {
+    a.f += c; return( a );
+}
+static inline T89_Dual D_scl( T89_Dual a, double c ) {
+    int i; a.f *= c; for (i=0; i<3; i++) a.d[i] *= c; return( a );
+}
+static inline T89_Dual D_mul( T89_Dual a, T89_Dual b ) {
+    T89_Dual r; int i; r.f = a.f*b.f; for (i=0; i<3; i++) r.d[i] = a.d[i]*b.f + a.f*b.d[i]; return( r );
+}
+static inline T89_Dual D_inv( T89_Dual a ) {
+    T89_Dual r; int i; double g = 1.0/a.f; r.f = g; for (i=0; i<3; i++) r.d[i] = -g*g*a.d[i]; return( r );
+}
+static inline T89_Dual D_div( T89_Dual a, T89_Dual b ) {
+    return( D_mul( a, D_inv( b ) ) );
+}
+static inline T89_Dual D_sqrt( T89_Dual a ) {
+    T89_Dual r; int i; double s = sqrt( a.f ); r.f = s; for (i=0; i<3; i++) r.d[i] = 0.5*a.d[i]/s; return( r );
+}
+static inline T89_Dual D_exp( T89_Dual a ) {
+    T89_Dual r; int i; double e = exp( a.f ); r.f = e; for (i=0; i<3; i++) r.d[i] = e*a.d[i]; return( r );
+}
+
+/*
+ *  Add the SM field components (Bxsm, By, Bzsm) to the GSM field B and its
+ *  Jacobian J.
+ */
+static inline void T89_Dual_AddSM( T89_Dual Bxsm, T89_Dual By, T89_Dual Bzsm, Lgm_Vector *B, double J[3][3], double cos_psi, double sin_psi ) {
+    int j;
+    B->x +=  Bxsm.f*cos_psi + Bzsm.f*sin_psi;
+    B->y +=  By.f;
+    B->z += -Bxsm.f*sin_psi + Bzsm.f*cos_psi;
+    for ( j=0; j<3; j++ ) {
+        J[0][j] +=  Bxsm.d[j]*cos_psi + Bzsm.d[j]*sin_psi;
+        J[1][j] +=  By.d[j];
+        J[2][j] += -Bxsm.d[j]*sin_psi + Bzsm.d[j]*cos_psi;
+    }
+}
+
+static inline void T89_Dual_AddGSM( T89_Dual Bx, T89_Dual By, T89_Dual Bz, Lgm_Vector *B, double J[3][3] ) {
+    int j;
+    B->x += Bx.f; B->y += By.f; B->z += Bz.f;
+    for ( j=0; j<3; j++ ) {
+        J[0][j] += Bx.d[j]; J[1][j] += By.d[j]; J[2][j] += Bz.d[j];
+    }
+}
+
+
+/*
+ *  Dual-number versions of T89_BT(), T89_BRC(), T89_BM() and T89_BC(). The
+ *  expressions are the same (see above); these add their contribution to B
+ *  and J.
+ */
+static void T89_BT_Dual( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info, const double *p ) {
+
+    double      sin_psi, cos_psi, tan_psi, p28_4, p26_2, p29_2, p31_2;
+    T89_Dual    X, Y, Z, y2, y3, y4, gg, aa, zz, hh, cc, ss12, ss32, tt12, tt32, uu12, uu32, rho2;
+    T89_Dual    h_1, h_T, D_T, D_Tx, D_Ty, oonn, W, W_x, W_y, z_s, z_sx, z_sy, z_r, xi_T, S_T, ooS_T, ooS_T_2, ooP;
+    T89_Dual    Q_T, BT_xsm, BT_ysm, BT_zsm, t1, t2, t3;
+
+    sin_psi = Info->c->sin_psi;
+    cos_psi = Info->c->cos_psi;
+    tan_psi = Info->c->tan_psi;
+
+    X = D_var( v->x*cos_psi - v->z*sin_psi, cos_psi, 0.0, -sin_psi );
+    Y = D_var( v->y,                         0.0,     1.0,  0.0     );
+    Z = D_var( v->x*sin_psi + v->z*cos_psi, sin_psi, 0.0,  cos_psi );
+
+    p28_4 = p[28]*p[28]*p[28]*p[28];
+    p26_2 = p[26]*p[26];
+    p29_2 = p[29]*p[29];
+    p31_2 = p[31]*p[31];
+
+    y2   = D_mul( Y, Y );
+    y3   = D_mul( y2, Y );
+    y4   = D_mul( y2, y2 );
+    gg   = D_addc( y4, p28_4 );
+    aa   = D_addc( X, 16.0 );
+    zz   = D_addc( X, p[23] );
+    hh   = D_sqrt( D_addc( D_mul( zz, zz ), 16.0 ) );
+    cc   = D_addc( X, -p[27] );
+    ss12 = D_sqrt( D_addc( D_mul( cc, cc ), p29_2 ) );
+    ss32 = D_mul( ss12, D_mul( ss12, ss12 ) );
+    tt12 = D_sqrt( D_addc( D_mul( aa, aa ), 36.0 ) );
+    tt32 = D_mul( tt12, D_mul( tt12, tt12 ) );
+    uu12 = D_sqrt( D_addc( D_mul( X, X ), p31_2 ) );
+    uu32 = D_mul( uu12, D_mul( uu12, uu12 ) );
+    rho2 = D_add( D_mul( X, X ), y2 );
+
+    h_1  = D_scl( D_addc( D_scl( D_div( aa, tt12 ), -1.0 ), 1.0 ), 0.5 );
+    h_T  = D_scl( D_addc( D_div( X, uu12 ), 1.0 ), 0.5 );
+    D_T  = D_addc( D_add( D_add( D_scl( y2, p[33] ), D_scl( h_T, p[32] ) ), D_scl( h_1, p[34] ) ), p[21] );
+    D_Tx = D_sub( D_scl( D_inv( uu32 ), 0.5*p[32]*p31_2 ), D_scl( D_inv( tt32 ), 18.0*p[34] ) );
+    D_Ty = D_scl( Y, 2.0*p[33] );
+
+    oonn = D_inv( D_addc( D_scl( y2, 1.0/p26_2 ), 1.0 ) );
+    W    = D_mul( D_scl( D_addc( D_scl( D_div( cc, ss12 ), -1.0 ), 1.0 ), 0.5 ), oonn );
+    W_x  = D_scl( D_div( oonn, ss32 ), -0.5*p29_2 );
+    W_y  = D_scl( D_div( D_mul( Y, W ), D_addc( y2, p26_2 ) ), -2.0 );
+
+    z_s  = D_sub( D_scl( D_sub( zz, hh ), 0.5*tan_psi ), D_scl( D_div( y4, gg ), p[24]*sin_psi ) );
+    z_sx = D_scl( D_addc( D_scl( D_div( zz, hh ), -1.0 ), 1.0 ), 0.5*tan_psi );
+    z_sy = D_scl( D_div( y3, D_mul( gg, gg ) ), -4.0*p[24]*p28_4*sin_psi );
+    z_r  = D_sub( Z, z_s );
+
+    xi_T    = D_sqrt( D_add( D_mul( z_r, z_r ), D_mul( D_T, D_T ) ) );
+    t1      = D_addc( xi_T, p[25] );
+    S_T     = D_sqrt( D_add( rho2, D_mul( t1, t1 ) ) );
+    ooS_T   = D_inv( S_T );
+    ooS_T_2 = D_mul( ooS_T, ooS_T );
+    ooP     = D_inv( D_add( S_T, t1 ) );
+    Q_T     = D_mul( D_div( W, D_mul( xi_T, S_T ) ), D_add( D_scl( ooP, p[0] ), D_scl( ooS_T_2, p[1] ) ) );
+
+    BT_xsm = D_mul( D_mul( Q_T, z_r ), X );
+    BT_ysm = D_mul( D_mul( Q_T, z_r ), Y );
+
+    t1 = D_mul( D_mul( W, ooS_T ), D_addc( D_scl( D_mul( t1, ooS_T_2 ), p[1] ), p[0] ) );
+    t2 = D_mul( D_mul( D_add( D_mul( X, W_x ), D_mul( Y, W_y ) ), ooP ), D_addc( D_scl( ooS_T, p[1] ), p[0] ) );
+    t3 = D_mul( D_mul( Q_T, D_T ), D_add( D_mul( X, D_Tx ), D_mul( Y, D_Ty ) ) );
+    BT_zsm = D_sub( D_add( D_add( t1, t2 ), D_add( D_mul( BT_xsm, z_sx ), D_mul( BT_ysm, z_sy ) ) ), t3 );
+
+    T89_Dual_AddSM( BT_xsm, BT_ysm, BT_zsm, B, J, cos_psi, sin_psi );
+
+}
+
+
+static void T89_BRC_Dual( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info, const double *p ) {
+
+    double      sin_psi, cos_psi, tan_psi, p28_4, p30_2;
+    T89_Dual    X, Y, Z, y2, y3, y4, gg, ee, hh, ff, ss12, ss32, tt12, tt32, rho2;
+    T89_Dual    h_1, h_RC, D_RC, D_RCx, z_s, z_sx, z_sy, z_r, xi_RC, S_RC, S_RC2, S_RC_5, Q_RC, qrczr;
+    T89_Dual    BRC_xsm, BRC_ysm, BRC_zsm, t1;
+
+    sin_psi = Info->c->sin_psi;
+    cos_psi = Info->c->cos_psi;
+    tan_psi = Info->c->tan_psi;
+
+    X = D_var( v->x*cos_psi - v->z*sin_psi, cos_psi, 0.0, -sin_psi );
+    Y = D_var( v->y,                         0.0,     1.0,  0.0     );
+    Z = D_var( v->x*sin_psi + v->z*cos_psi, sin_psi, 0.0,  cos_psi );
+
+    p28_4 = p[28]*p[28]*p[28]*p[28];
+    p30_2 = p[30]*p[30];
+
+    y2   = D_mul( Y, Y );
+    y3   = D_mul( y2, Y );
+    y4   = D_mul( y2, y2 );
+    gg   = D_addc( y4, p28_4 );
+    ee   = D_addc( X, p[23] );
+    hh   = D_sqrt( D_addc( D_mul( ee, ee ), 16.0 ) );
+    ff   = D_addc( X, 16.0 );
+    ss12 = D_sqrt( D_addc( D_mul( ff, ff ), 36.0 ) );
+    ss32 = D_mul( ss12, D_mul( ss12, ss12 ) );
+    tt12 = D_sqrt( D_addc( D_mul( X, X ), p30_2 ) );
+    tt32 = D_mul( tt12, D_mul( tt12, tt12 ) );
+    rho2 = D_add( D_mul( X, X ), y2 );
+
+    h_1   = D_scl( D_addc( D_scl( D_div( ff, ss12 ), -1.0 ), 1.0 ), 0.5 );
+    h_RC  = D_scl( D_addc( D_div( X, tt12 ), 1.0 ), 0.5 );
+    D_RC  = D_addc( D_add( D_scl( h_RC, p[22] ), D_scl( h_1, p[34] ) ), p[21] );
+    D_RCx = D_sub( D_scl( D_inv( tt32 ), 0.5*p[22]*p30_2 ), D_scl( D_inv( ss32 ), 18.0*p[34] ) );
+
+    z_s  = D_sub( D_scl( D_sub( ee, hh ), 0.5*tan_psi ), D_scl( D_div( y4, gg ), p[24]*sin_psi ) );
+    z_sx = D_scl( D_addc( D_scl( D_div( ee, hh ), -1.0 ), 1.0 ), 0.5*tan_psi );
+    z_sy = D_scl( D_div( y3, D_mul( gg, gg ) ), -4.0*p[24]*p28_4*sin_psi );
+    z_r  = D_sub( Z, z_s );
+
+    xi_RC  = D_sqrt( D_add( D_mul( z_r, z_r ), D_mul( D_RC, D_RC ) ) );
+    ff     = D_addc( xi_RC, p[20] );
+    S_RC   = D_sqrt( D_add( rho2, D_mul( ff, ff ) ) );
+    S_RC2  = D_mul( S_RC, S_RC );
+    S_RC_5 = D_mul( S_RC, D_mul( S_RC2, S_RC2 ) );
+    Q_RC   = D_scl( D_div( ff, D_mul( xi_RC, S_RC_5 ) ), 3.0*p[4] );
+    qrczr  = D_mul( Q_RC, z_r );
+
+    BRC_xsm = D_mul( qrczr, X );
+    BRC_ysm = D_mul( qrczr, Y );
+
+    t1 = D_scl( D_div( D_sub( D_scl( D_mul( ff, ff ), 2.0 ), rho2 ), S_RC_5 ), p[4] );
+    BRC_zsm = D_sub( D_add( t1, D_add( D_mul( BRC_xsm, z_sx ), D_mul( BRC_ysm, z_sy ) ) ), D_mul( D_mul( Q_RC, D_RC ), D_mul( X, D_RCx ) ) );
+
+    T89_Dual_AddSM( BRC_xsm, BRC_ysm, BRC_zsm, B, J, cos_psi, sin_psi );
+
+}
+
+
+static void T89_BM_Dual( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info, const double *p ) {
+
+    double      sin_psi, cos_psi;
+    T89_Dual    x, y, y2, z, z2, exod_x, Bx, By, Bz;
+
+    sin_psi = Info->c->sin_psi;
+    cos_psi = Info->c->cos_psi;
+
+    x = D_var( v->x, 1.0, 0.0, 0.0 );
+    y = D_var( v->y, 0.0, 1.0, 0.0 ); y2 = D_mul( y, y );
+    z = D_var( v->z, 0.0, 0.0, 1.0 ); z2 = D_mul( z, z );
+
+    exod_x = D_exp( D_scl( x, 1.0/p[19] ) );
+
+    Bx = D_add( D_scl( z, p[5]*cos_psi ), D_scl( D_addc( D_add( D_scl( y2, p[7] ), D_scl( z2, p[8] ) ), p[6] ), sin_psi ) );
+    By = D_add( D_scl( D_mul( y, z ), p[9]*cos_psi ), D_scl( D_mul( y, D_addc( D_add( D_scl( y2, p[11] ), D_scl( z2, p[12] ) ), p[10] ) ), sin_psi ) );
+    Bz = D_add( D_scl( D_addc( D_add( D_scl( y2, p[14] ), D_scl( z2, p[15] ) ), p[13] ), cos_psi ), D_scl( D_mul( z, D_addc( D_add( D_scl( y2, p[17] ), D_scl( z2, p[18] ) ), p[16] ) ), sin_psi ) );
+
+    T89_Dual_AddGSM( D_mul( exod_x, Bx ), D_mul( exod_x, By ), D_mul( exod_x, Bz ), B, J );
+
+}
+
+
+static void T89_BC_Dual( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info, const double *p ) {
+
+    double      sin_psi, psp, p38_2;
+    T89_Dual    x, y, z, y2, x2py2, ee, aa, ss12, ss32, zpp35, zmp35, W_c, W_cx, W_cy, S_p, S_m;
+    T89_Dual    ffcc, ggdd, ff, gg, zz, F_px, F_mx, F_py, F_my, F_pz, F_mz;
+
+    sin_psi = Info->c->sin_psi;
+
+    x = D_var( v->x, 1.0, 0.0, 0.0 );
+    y = D_var( v->y, 0.0, 1.0, 0.0 );
+    z = D_var( v->z, 0.0, 0.0, 1.0 );
+
+    y2    = D_mul( y, y );
+    x2py2 = D_add( D_mul( x, x ), y2 );
+
+    p38_2 = p[38]*p[38];
+    ee    = D_inv( D_addc( D_scl( y2, 1.0/p38_2 ), 1.0 ) );
+    aa    = D_addc( x, -p[36] );
+    zpp35 = D_addc( z,  p[35] );
+    zmp35 = D_addc( z, -p[35] );
+    ss12  = D_sqrt( D_addc( D_mul( aa, aa ), p[37] ) );
+    ss32  = D_mul( ss12, D_mul( ss12, ss12 ) );
+
+    W_c  = D_mul( D_scl( D_addc( D_scl( D_div( aa, ss12 ), -1.0 ), 1.0 ), 0.5 ), ee );
+    W_cx = D_scl( D_div( ee, ss32 ), -0.5*p[37] );
+    W_cy = D_scl( D_div( D_mul( y, W_c ), D_addc( y2, p38_2 ) ), -2.0 );
+    S_p  = D_sqrt( D_add( D_mul( zpp35, zpp35 ), x2py2 ) );
+    S_m  = D_sqrt( D_add( D_mul( zmp35, zmp35 ), x2py2 ) );
+
+    ff   = D_inv( D_add( S_p, zpp35 ) );
+    gg   = D_inv( D_sub( S_m, zmp35 ) );
+    ffcc = D_div( ff, S_p );
+    ggdd = D_div( gg, S_m );
+    zz   = D_add( D_mul( x, W_cx ), D_mul( y, W_cy ) );
+
+    F_px = D_mul( D_mul( W_c, x ), ffcc );
+    F_mx = D_scl( D_mul( D_mul( W_c, x ), ggdd ), -1.0 );
+    F_py = D_mul( D_mul( W_c, y ), ffcc );
+    F_my = D_scl( D_mul( D_mul( W_c, y ), ggdd ), -1.0 );
+    F_pz = D_add( D_div( W_c, S_p ), D_mul( zz, ff ) );
+    F_mz = D_add( D_div( W_c, S_m ), D_mul( zz, gg ) );
+
+    psp = p[3]*sin_psi;
+
+    T89_Dual_AddGSM( D_add( D_scl( D_add( F_px, F_mx ), p[2] ), D_scl( D_sub( F_px, F_mx ), psp ) ),
+                     D_add( D_scl( D_add( F_py, F_my ), p[2] ), D_scl( D_sub( F_py, F_my ), psp ) ),
+                     D_add( D_scl( D_add( F_pz, F_mz ), p[2] ), D_scl( D_sub( F_pz, F_mz ), psp ) ), B, J );
+
+}
+
+
+/**
+ *  \brief
+ *      T89 field and its Jacobian.
+ *
+ *  \details
+ *      The external part is evaluated with forward-mode dual numbers (so the
+ *      derivatives are exact rather than differenced) and the internal part
+ *      with Lgm_B_Internal_Jacobian().
+ *
+ *      \param[in]       v       Position (GSM, in Re).
+ *      \param[out]      B       Field (GSM, in nT).
+ *      \param[out]      J       Jacobian, J[i][j] = dB_i/dx_j (GSM, in nT/Re).
+ *      \param[in,out]   Info    Lgm_MagModelInfo structure.
+ *
+ *      \return          1 on success, 0 if the internal Jacobian could not be computed.
+ *
+ */
+int Lgm_B_T89_Jacobian( Lgm_Vector *v, Lgm_Vector *B, double J[3][3], Lgm_MagModelInfo *Info ) {
+
+    const double    *p;
+
+    if ( !Lgm_B_Internal_Jacobian( v, B, J, Info ) ) return(0);
+
+    p = Lgm_T89_a[ Lgm_T89_KpIndex( Info ) ];
+    T89_BT_Dual(  v, B, J, Info, p );
+    T89_BRC_Dual( v, B, J, Info, p );
+    T89_BM_Dual(  v, B, J, Info, p );
+    T89_BC_Dual(  v, B, J, Info, p );
+
+    ++Info->nFunc;
+
+    return(1);
+
+}
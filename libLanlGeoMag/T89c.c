@@ -15,6 +15,7 @@
  *
  */
 
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 
 /*
@@ -607,9 +608,11 @@ int Lgm_B_T89c( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector      B1, B5;
     double          PARMOD[11];
+    LGM_STATS_START( t0 );
 
 
     T89c( Info->Kp, PARMOD, Info->c->psi, v->x, v->y, v->z, &B1.x, &B1.y, &B1.z, Info );
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_T89c, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
@@ -1,9 +1,17 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
-int Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+#include "Lgm/Lgm_MagStepKernels.h"
+
+/*
+ *  Lgm_B_TS04() with the internal model passed in. With a constant there (as
+ *  in the instance below) the switch goes away.
+ */
+static inline int Lgm_B_TS04_Body( Lgm_Vector *v, Lgm_Vector *B, int InternalModel, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector       B2;
     int		         iopt;
     double	         parmod[11], ps, Bmag, R, X, Y, Z, Bx, By, Bz;
+    LGM_STATS_START( t0 );
 
 
     parmod[1]  = Info->P; 	// Pressure in nPa
@@ -29,7 +37,8 @@ int Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     B_cdip(  v, &B2, Info );
     printf("Bcdip =  (%f, %f, %f)\n", B2.x, B2.y, B2.z);
     */
-    switch ( Info->InternalModel ){
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_TS04, t0 );
+    switch ( InternalModel ){
 
         case LGM_CDIP:
                         Lgm_B_cdip( v, &B2, Info );
@@ -41,7 +50,7 @@ int Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
                         Lgm_B_igrf( v, &B2, Info );
                         break;
         default:
-                        fprintf(stderr, "Lgm_B_TS04: Unknown internal model (%d)\n", Info->InternalModel);
+                        fprintf(stderr, "Lgm_B_TS04: Unknown internal model (%d)\n", InternalModel);
                         break;
 
     }
@@ -67,3 +76,55 @@ int Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
 }
 
+int Lgm_B_TS04( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    return( Lgm_B_TS04_Body( v, B, Info->InternalModel, Info ) );
+}
+
+/*
+ *  TS04 with IGRF, and the integrator kernels compiled against it (see
+ *  Lgm_MagStepKernels.h).
+ */
+static int Lgm_B_TS04_IGRF( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    return( Lgm_B_TS04_Body( v, B, LGM_IGRF, Info ) );
+}
+LGM_MAGSTEP_KERNELS( TS04_IGRF, Lgm_B_TS04_IGRF )
+
+
+/**
+ *  \brief
+ *      Compute the point-independent part of the TS04 model for the current epoch.
+ *
+ *  \details
+ *      Packs the solar wind inputs held in Info the same way Lgm_B_TS04()
+ *      does and fills Info->TS04_Info with everything that depends only on them
+ *      and on the dipole tilt (amplitudes, scalings, magnetopause
+ *      parameters), so that subsequent calls to Lgm_B_TS04() only do the
+ *      spatial part of the calculation.
+ *
+ *      This is optional: Tsyg_TS04() compares its inputs against the prepared
+ *      ones on every call and re-prepares automatically when they differ
+ *      (e.g. after Lgm_set_QinDenton() or Lgm_Set_Coord_Transforms()).
+ *      Calling it up front just moves the setup cost out of the first field
+ *      evaluation.
+ *
+ *      \param[in,out]   Info    Lgm_MagModelInfo structure.
+ *
+ */
+void Lgm_TS04_Prepare( Lgm_MagModelInfo *Info ) {
+
+    double      parmod[11];
+
+    parmod[1]  = Info->P;       // Pressure in nPa
+    parmod[2]  = Info->Dst;     // Dst in nT
+    parmod[3]  = Info->By;      // IMF By in nT
+    parmod[4]  = Info->Bz;      // IMF Bz in nT
+    parmod[5]  = Info->W[0];    // W1
+    parmod[6]  = Info->W[1];    // W2
+    parmod[7]  = Info->W[2];    // W3
+    parmod[8]  = Info->W[3];    // W4
+    parmod[9]  = Info->W[4];    // W5
+    parmod[10] = Info->W[5];    // W6
+
+    Lgm_Prepare_TS04( parmod, Info->c->psi, Info->c->sin_psi, Info->c->cos_psi, &Info->TS04_Info );
+
+}
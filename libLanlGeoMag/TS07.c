@@ -1,9 +1,11 @@
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 int Lgm_B_TS07( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector       B2;
     int		         iopt;
     double	         parmod[11], ps, X, Y, Z, Bx, By, Bz;
+    LGM_STATS_START( t0 );
 
 
     parmod[1]  = Info->P; 	// Pressure in nPa
@@ -19,6 +21,7 @@ int Lgm_B_TS07( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
     B_cdip(  v, &B2, Info );
     printf("Bcdip =  (%f, %f, %f)\n", B2.x, B2.y, B2.z);
     */
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_TS07, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
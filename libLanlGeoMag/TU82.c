@@ -21,6 +21,7 @@
  *
  *
  */
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 
 /*
@@ -254,11 +255,13 @@ int Lgm_Bmp_TU82( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 int Lgm_B_TU82( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector 	B1, B2, B3, B4;
+    LGM_STATS_START( t0 );
 
     Lgm_Brc_TU82( v, &B1,  Info );
     Lgm_Bt_TU82( v, &B2,  Info );
     Lgm_Bmp_TU82( v, &B3,  Info );
 
+    LGM_STATS_STOP_MODEL( Info, External, LGM_EXTMODEL_TU82, t0 );
     switch ( Info->InternalModel ){
 
         case LGM_CDIP:
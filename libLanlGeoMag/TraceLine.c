@@ -38,17 +38,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <config.h>
 #include "Lgm/Lgm_MagModelInfo.h"
 
 
 /*
- *  Set the interpolation type to use. (Note, the searches in gsl are not as
- *  optimal as they could be. Probably losing some efficiency there. A
- *  taylor-made interpolator may do better?)
+ *  Set the interpolation type to use along the FL (see Lgm_FLSpline.c).
  */
-#define GSL_INTERP  gsl_interp_linear
-//#define GSL_INTERP  gsl_interp_akima
-//#define GSL_INTERP  gsl_interp_cspline
+#define LGM_FLSPLINE_TYPE   LGM_FLSPLINE_LINEAR
+//#define LGM_FLSPLINE_TYPE   LGM_FLSPLINE_AKIMA
 
 
 double tlFunc( Lgm_Vector *P, double R0, Lgm_MagModelInfo *Info ){
@@ -72,6 +70,7 @@ int Lgm_TraceLine( Lgm_Vector *u, Lgm_Vector *v, double H0, double sgn, double t
     double	    Ra, Rb, Rc;
     Lgm_Vector	Pa, Pc, P, Bvec, Bcdip;
     int		    done, reset, n, SavePnt, Count;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_LINE );
 
 
     reset = TRUE;
@@ -103,6 +102,7 @@ int Lgm_TraceLine( Lgm_Vector *u, Lgm_Vector *v, double H0, double sgn, double t
     n = 0; Info->nPnts = n;
     ss = 0.0;
     Info->Bfield( u, &Bvec, Info );
+    if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
     Info->s[n]    = ss;                         // save arc length
     Info->Px[n]   = u->x;                       // save 3D position vector.
     Info->Py[n]   = u->y;                       //
@@ -171,6 +171,7 @@ int Lgm_TraceLine( Lgm_Vector *u, Lgm_Vector *v, double H0, double sgn, double t
          */
         if ( ss > Info->s[n-1] ) {
             Info->Bfield( &P, &Bvec, Info );
+            if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
             Info->s[n]    = ss;                         // save arc length
             Info->Px[n]   = P.x;                        // save 3D position vector.
             Info->Py[n]   = P.y;                        //
@@ -265,6 +266,7 @@ int Lgm_TraceLine( Lgm_Vector *u, Lgm_Vector *v, double H0, double sgn, double t
 //printf("P = %g %g %g\n", P.x, P.y, P.z);
                 Info->Bfield( &P, &Bvec, Info );
 //printf("EEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEEE\n");
+                if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
                 Info->s[n]    = ss;                         // save arc length
                 Info->Px[n]   = P.x;                        // save 3D position vector.
                 Info->Py[n]   = P.y;                        //
@@ -388,6 +390,7 @@ if (1==1){
      */
     if ( ss > Info->s[n-1] ) {
         Info->Bfield( v, &Bvec, Info );
+        if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
         Info->s[n]    = ss;                         // save arc length
         Info->Px[n]   = v->x;                       // save 3D position vector.
         Info->Py[n]   = v->y;                       //
@@ -442,6 +445,7 @@ int Lgm_TraceLine2( Lgm_Vector *u, Lgm_Vector *v, double H0, double MinDist, dou
     double	    Ra, Rb, Rc;
     Lgm_Vector	Pa, Pc, P, Bvec, Bcdip;
     int		    done, reset, n, m, SavePnt, Count;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_LINE );
 
 //printf("u = %g %g %g\n", u->x, u->y, u->z);
 
@@ -489,6 +493,7 @@ int Lgm_TraceLine2( Lgm_Vector *u, Lgm_Vector *v, double H0, double MinDist, dou
     n = 0; Info->nPnts = n;
     ss = 0.0;
     Info->Bfield( &Pa, &Bvec, Info );
+    if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
     Info->s[n]    = ss;                         // save arc length
     Info->Px[n]   = Pa.x;                       // save 3D position vector.
     Info->Py[n]   = Pa.y;                       //
@@ -607,6 +612,7 @@ int Lgm_TraceLine2( Lgm_Vector *u, Lgm_Vector *v, double H0, double MinDist, dou
              */
             if ( SavePnt && (ss > Info->s[n-1]) ) {
                 Info->Bfield( &P, &Bvec, Info );
+                if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
                 Info->s[n]    = ss;                         // save arc length
                 Info->Px[n]   = P.x;                        // save 3D position vector.
                 Info->Py[n]   = P.y;                        //
@@ -739,6 +745,7 @@ if (0==1){
      */
     if ( (n>0) && ((ss - Info->s[n-1]) > 1e-3) ) {
         Info->Bfield( v, &Bvec, Info );
+        if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
         Info->s[n]    = ss;                         // save arc length
         Info->Px[n]   = v->x;                       // save 3D position vector.
         Info->Py[n]   = v->y;                       //
@@ -881,16 +888,26 @@ void AddNewPoint( double s, double B, Lgm_Vector *P, Lgm_MagModelInfo *Info ) {
 
     }
 
+    /*
+     *  Make sure the arrays have room for one more point.
+     */
+    if ( !LGM_RESERVE_FL_PNTS( Info, Info->nPnts+1 ) ) {
+        printf("AddNewPoint: Error, unable to grow FL arrays. Point not added.\n");
+        return;
+    }
+
     if ( Shift ) {
         /*
          *  Make room for new point
          */
         for (i=Info->nPnts-1; i>=i2; i--){
-            Info->s[i+1]    = Info->s[i];
-            Info->Bmag[i+1] = Info->Bmag[i];
-            Info->Px[i+1]   = Info->Px[i];
-            Info->Py[i+1]   = Info->Py[i];
-            Info->Pz[i+1]   = Info->Pz[i];
+            Info->s[i+1]           = Info->s[i];
+            Info->Bmag[i+1]        = Info->Bmag[i];
+            Info->Px[i+1]          = Info->Px[i];
+            Info->Py[i+1]          = Info->Py[i];
+            Info->Pz[i+1]          = Info->Pz[i];
+            Info->Bvec[i+1]        = Info->Bvec[i];
+            Info->BminusBcdip[i+1] = Info->BminusBcdip[i];
         }
     }
 
@@ -915,47 +932,32 @@ void AddNewPoint( double s, double B, Lgm_Vector *P, Lgm_MagModelInfo *Info ) {
 int InitSpline( Lgm_MagModelInfo *Info ) {
 
 
-
-    int i;
+    int             i;
+    const double    *y[LGM_FLSPLINE_NY];
 
     if ( ( Info->nPnts < 2 )||( Info->AllocedSplines ) ) return( 0 );
 
-//    gsl_set_error_handler_off(); // Turn off gsl default error handler
-
     for (i=0; i<Info->nPnts-1; ++i){
         if (Info->s[i] >= Info->s[i+1]) {
             printf("InitSpline: Error? Info->s[%d] = %g    Info->s[%d] = %g\n", i, Info->s[i], i+1, Info->s[i+1]);
         }
     }
     /*
-     *  Now that we have the array of points, lets initialize the gsl spline stuff
-     *
-     *  To evaluate the spline, use the following:
-     *
-     *      y = gsl_spline_eval( Info->spline, x, Info->acc );
+     *  Now that we have the array of points, lets initialize the interpolants.
+     *  To evaluate them, use the following:
      *
+     *      y = Lgm_FLSpline_Eval( &Info->FLSpline, k, s );
      *
+     *  where k = 0, 1, 2, 3 gives BminusBcdip, Px, Py, Pz. The arrays are
+     *  kept by FreeSpline() for the next line.
      */
-    Info->acc    = gsl_interp_accel_alloc( );
-    Info->accPx  = gsl_interp_accel_alloc( );
-    Info->accPy  = gsl_interp_accel_alloc( );
-    Info->accPz  = gsl_interp_accel_alloc( );
-    if ( Info->nPnts > 2 ){
-        Info->spline   = gsl_spline_alloc( GSL_INTERP, Info->nPnts );
-        Info->splinePx = gsl_spline_alloc( GSL_INTERP, Info->nPnts );
-        Info->splinePy = gsl_spline_alloc( GSL_INTERP, Info->nPnts );
-        Info->splinePz = gsl_spline_alloc( GSL_INTERP, Info->nPnts );
-    } else {
-        Info->spline   = gsl_spline_alloc( gsl_interp_linear, Info->nPnts );
-        Info->splinePx = gsl_spline_alloc( gsl_interp_linear, Info->nPnts );
-        Info->splinePy = gsl_spline_alloc( gsl_interp_linear, Info->nPnts );
-        Info->splinePz = gsl_spline_alloc( gsl_interp_linear, Info->nPnts );
-    }
-//    gsl_spline_init( Info->spline, Info->s, Info->Bmag, Info->nPnts );
-    gsl_spline_init( Info->spline,   Info->s, Info->BminusBcdip, Info->nPnts );
-    gsl_spline_init( Info->splinePx, Info->s, Info->Px, Info->nPnts );
-    gsl_spline_init( Info->splinePy, Info->s, Info->Py, Info->nPnts );
-    gsl_spline_init( Info->splinePz, Info->s, Info->Pz, Info->nPnts );
+    y[0] = Info->BminusBcdip;
+    y[1] = Info->Px;
+    y[2] = Info->Py;
+    y[3] = Info->Pz;
+    // size the arrays for the capacity of the FL arrays, so later lines fit too
+    if ( Info->FLSpline.nAlloc < Info->nAllocedPnts ) Info->FLSpline.nAlloc = Info->nAllocedPnts;
+    if ( !Lgm_FLSpline_Set( &Info->FLSpline, ( Info->nPnts > 2 ) ? LGM_FLSPLINE_TYPE : LGM_FLSPLINE_LINEAR, Info->nPnts, Info->s, y ) ) return( 0 );
 
     Info->AllocedSplines = TRUE;
 
@@ -963,20 +965,15 @@ int InitSpline( Lgm_MagModelInfo *Info ) {
 
 }
 
+/*
+ *  The arrays are not actually freed (Lgm_FreeMagInfo() does that); they are
+ *  kept for the next InitSpline().
+ */
 int FreeSpline( Lgm_MagModelInfo *Info ) {
 
     if ( !Info->AllocedSplines ) return(0);
 
-//    gsl_set_error_handler_off(); // Turn off gsl default error handler
-    if ( Info->spline != NULL ) gsl_spline_free( Info->spline );
-    if ( Info->splinePx != NULL ) gsl_spline_free( Info->splinePx );
-    if ( Info->splinePy != NULL ) gsl_spline_free( Info->splinePy );
-    if ( Info->splinePz != NULL ) gsl_spline_free( Info->splinePz );
-    if ( Info->acc != NULL ) gsl_interp_accel_free( Info->acc );
-    if ( Info->accPx != NULL ) gsl_interp_accel_free( Info->accPx );
-    if ( Info->accPy != NULL ) gsl_interp_accel_free( Info->accPy );
-    if ( Info->accPz != NULL ) gsl_interp_accel_free( Info->accPz );
-
+    Info->FLSpline.n     = 0;
     Info->AllocedSplines = FALSE;
 
     return(1);
@@ -993,8 +990,9 @@ int FreeSpline( Lgm_MagModelInfo *Info ) {
 double  BofS( double s, Lgm_MagModelInfo *Info ) {
 
     double      m, ds, B, BminusBcdip, Bcdip;
-    int         i1, i2;
+    int         i1, i2, j;
     Lgm_Vector  P, Bvec;
+    LGM_STATS_START( t0 );
 
 //printf("n = %d\n", Info->nPnts);
 
@@ -1011,23 +1009,21 @@ raise(6);
 
 
     /*
-     * Use GSL to compute BminusBcdip(s)
+     * Interpolate to get BminusBcdip(s), P(s) and Bcdip(P(s)). All four
+     * curves are on the same s grid, so one interval lookup does.
      */
-    BminusBcdip = gsl_spline_eval( Info->spline, s, Info->acc );
-
-    /*
-     * Interpolate to get P(s) and Bcdip(P(s))
-     */
-    P.x = gsl_spline_eval( Info->splinePx, s, Info->accPx );
-    P.y = gsl_spline_eval( Info->splinePy, s, Info->accPy );
-    P.z = gsl_spline_eval( Info->splinePz, s, Info->accPz );
+    j = Lgm_FLSpline_Find( &Info->FLSpline, s );
+    BminusBcdip = Lgm_FLSpline_EvalAt( &Info->FLSpline, 0, j, s );
+    P.x = Lgm_FLSpline_EvalAt( &Info->FLSpline, 1, j, s );
+    P.y = Lgm_FLSpline_EvalAt( &Info->FLSpline, 2, j, s );
+    P.z = Lgm_FLSpline_EvalAt( &Info->FLSpline, 3, j, s );
     Lgm_B_cdip( &P, &Bvec, Info );
     Bcdip = Lgm_Magnitude( &Bvec );
     B = BminusBcdip + Bcdip;
+    LGM_STATS_STOP( Info, Interp, t0 );
 
 
 
-//    B = gsl_spline_eval( Info->spline, s, Info->acc );
     return( B );
 
 
@@ -1100,6 +1096,66 @@ raise(6);
 
 
 
+/*
+ * BofS() at n points at once, B[i] = BofS( s[i], Info ). This is what the
+ * batch integrands (e.g. I_integrand_interped_v()) use to get B at all of
+ * the nodes of a quadrature interval in one call.
+ *
+ * The four interpolants share one interval lookup per point (they all have
+ * Info->s as abscissae) and are evaluated in one loop, and Bcdip comes from
+ * Lgm_B_cdip_Batch(). Results are the same as BofS().
+ */
+#define LGM_BOFS_CHUNK  32
+void  BofS_N( int n, const double *s, double *B, Lgm_MagModelInfo *Info ) {
+
+    double          Px[LGM_BOFS_CHUNK], Py[LGM_BOFS_CHUNK], Pz[LGM_BOFS_CHUNK], Bd[LGM_BOFS_CHUNK];
+    double          Bx[LGM_BOFS_CHUNK], By[LGM_BOFS_CHUNK], Bz[LGM_BOFS_CHUNK];
+    int             i, i0, m, k[LGM_BOFS_CHUNK];
+    long int        N;
+    Lgm_FLSpline    *f = &Info->FLSpline;
+
+    LGM_STATS_START( t0 );
+
+    N  = Info->nPnts;
+
+    for ( i0=0; i0<n; i0 += LGM_BOFS_CHUNK ) {
+
+        m = ( n-i0 < LGM_BOFS_CHUNK ) ? n-i0 : LGM_BOFS_CHUNK;
+
+        for ( i=0; i<m; i++ ) {
+            if ( (s[i0+i] < Info->s[0]) || (s[i0+i] > Info->s[N-1]) ) {
+                printf("BofS_N: ( Line %d in file %s ). Trying to evaluate BofS( s, Info ) for an s that is outside of the bounds of the interpolating arrays.\n\tInfo->nPnts = %d, Info->s[0] = %.8g, Info->s[%d] = %.8g, s = %.8g\n", __LINE__, __FILE__, Info->nPnts, Info->s[0], Info->nPnts-1, Info->s[Info->nPnts-1], s[i0+i]);
+                raise(6);
+            }
+            k[i] = Lgm_FLSpline_Find( f, s[i0+i] );
+        }
+
+        for ( i=0; i<m; i++ ) {
+            Bd[i] = Lgm_FLSpline_EvalAt( f, 0, k[i], s[i0+i] );
+            Px[i] = Lgm_FLSpline_EvalAt( f, 1, k[i], s[i0+i] );
+            Py[i] = Lgm_FLSpline_EvalAt( f, 2, k[i], s[i0+i] );
+            Pz[i] = Lgm_FLSpline_EvalAt( f, 3, k[i], s[i0+i] );
+        }
+
+        Lgm_B_cdip_Batch( m, Px, Py, Pz, Bx, By, Bz, Info );
+
+        for ( i=0; i<m; i++ ) {
+            B[i0+i] = Bd[i] + sqrt( Bx[i]*Bx[i] + By[i]*By[i] + Bz[i]*Bz[i] );
+        }
+
+    }
+
+#if defined(LGM_INSTRUMENT) && LGM_INSTRUMENT
+    Info->Stats.nInterp += n-1;
+#endif
+    LGM_STATS_STOP( Info, Interp, t0 );
+
+    return;
+
+}
+
+
+
 /*
  *   Compute the +/-s vals of the mirror points. Start at s(Bmin) point.
  */
@@ -1238,18 +1294,71 @@ int  SofBm( double Bm, double *ss, double *sn, Lgm_MagModelInfo *Info ) {
 
 
 
+/*
+ * Next step for the adaptive mode of Lgm_TraceLine3(). The splines (see
+ * BofS()) interpolate B - Bcdip and the position, so the error in B(s) over
+ * a step h is roughly h^2/8 times
+ *
+ *      |d2(B-Bcdip)/ds2| + |grad Bcdip| |d2P/ds2|
+ *
+ * where |d2P/ds2| is the curvature of the line and |grad Bcdip| ~ 3B/R. Both
+ * are estimated from the last three points (no extra field evaluations). h
+ * is picked to keep this under Tol, and isnt allowed to more than double
+ * from one step to the next.
+ */
+static double AdaptiveDiv( int n, double h, double hmin, double hmax, double Tol, double Bmax, Lgm_MagModelInfo *Info ) {
+
+    double      h1, h2, d2, Kappa, R, e, hnew;
+    Lgm_Vector  b1, b2, db;
+
+    if ( n < 3 ) return( h );
+
+    h1 = Info->s[n-2] - Info->s[n-3];
+    h2 = Info->s[n-1] - Info->s[n-2];
+    if ( ( h1 <= 0.0 ) || ( h2 <= 0.0 ) ) return( h );
+
+    d2 = 2.0*( (Info->BminusBcdip[n-1] - Info->BminusBcdip[n-2])/h2 - (Info->BminusBcdip[n-2] - Info->BminusBcdip[n-3])/h1 )/( h1 + h2 );
+
+    b1 = Info->Bvec[n-2]; Lgm_NormalizeVector( &b1 );
+    b2 = Info->Bvec[n-1]; Lgm_NormalizeVector( &b2 );
+    Lgm_VecSub( &db, &b2, &b1 );
+    Kappa = Lgm_Magnitude( &db )/h2;
+    R     = sqrt( Info->Px[n-1]*Info->Px[n-1] + Info->Py[n-1]*Info->Py[n-1] + Info->Pz[n-1]*Info->Pz[n-1] );
+
+    e = fabs( d2 ) + 3.0*Info->Bmag[n-1]/R*Kappa;
+    hnew = ( e > 0.0 ) ? sqrt( 8.0*Tol*Bmax/e ) : hmax;
+
+    if ( hnew > 2.0*h2 ) hnew = 2.0*h2;
+    if ( hnew > hmax ) hnew = hmax;
+    if ( hnew < hmin ) hnew = hmin;
+
+    return( hnew );
+
+}
+
+
+
+
 /*
  * Start at point u. Then trace the distance S in N steps.
+ *
+ * If Info->AdaptiveDivs is set, the steps are instead picked (by
+ * AdaptiveDiv() above) to keep the interpolation error of B(s) below
+ * Info->AdaptiveDivTol times the largest B on the line. The first steps are
+ * S/N, and the steps stay between S/(8N) and S/8 (so short lines still get
+ * a handful of points). The spline is set up from the points as usual (see
+ * InitSpline()); it just isnt evenly spaced.
  */
 int Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int AddBminPoint, Lgm_MagModelInfo *Info ) {
 
     Lgm_Vector	u_scale;
-    double	    Htry0, Htry, Hsum, Hdid, Hnext, Hmin, Hmax, s, ss;
+    double	    Htry0, Htry, Hsum, Hdid, Hnext, Hmin, Hmax, s, ss, Bmax;
     double	    Sa=0.0, Sc=0.0, d;
     double	    R0, R, Fa, Fb, Fc, F;
     double	    Ra, Rb, Rc;
     Lgm_Vector	Pa, Pc, P, Bvec, Bcdip;
     int		    done, reset, n, SavePnt, DoneStep, nSubSteps;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_LINE );
 
     reset = TRUE;
 
@@ -1279,6 +1388,7 @@ int Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int
     n = 0; Info->nPnts = n;
     ss = 0.0;
     Info->Bfield( u, &Bvec, Info );
+    if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
     Info->s[n]    = ss;                         // save arc length
     Info->Px[n]   = u->x;                       // save 3D position vector.
     Info->Py[n]   = u->y;                       //
@@ -1294,11 +1404,22 @@ int Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int
 
 
     Htry0 = S/(double)N;
+    Bmax  = Info->Bmag[0];
     done  = FALSE;
     P = *u;
     if ( Info->VerbosityLevel > 2 ) printf("Lgm_TraceLine3(): P = %g %g %g (first point)\n", P.x, P.y, P.z );
     while ( !done ) {
 
+        if ( Info->AdaptiveDivs ) {
+            /*
+             * Pick the step from the last few points, and dont leave a
+             * sliver at the end.
+             */
+            Htry0 = AdaptiveDiv( n, Htry0, S/(8.0*N), S/8.0, Info->AdaptiveDivTol, Bmax, Info );
+            if ( Htry0 >= S-ss ) Htry0 = S-ss;
+            else if ( Htry0 > 0.5*(S-ss) ) Htry0 = 0.5*(S-ss);
+        }
+
 
         /*
          * Attempt to make a step of Htry0. Note that Lgm_MagStep() is adaptive,
@@ -1349,6 +1470,7 @@ int Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int
          */
         if ( ss > Info->s[n-1] ) {
             Info->Bfield( &P, &Bvec, Info );
+            if ( !LGM_RESERVE_FL_PNTS( Info, n+1 ) ) return( -1 );
             Info->s[n]    = ss;                         // save arc length
             Info->Px[n]   = P.x;                        // save 3D position vector.
             Info->Py[n]   = P.y;                        //
@@ -1357,6 +1479,7 @@ int Lgm_TraceLine3( Lgm_Vector *u, double S, int N, double sgn, double tol, int
             Info->Bmag[n] = Lgm_Magnitude( &Bvec );     // save field strength (and increment counter)
             Lgm_B_cdip( &P, &Bcdip, Info );
             Info->BminusBcdip[n] = Info->Bmag[n] - Lgm_Magnitude( &Bcdip );     // save field strength (and increment counter)
+            if ( Info->Bmag[n] > Bmax ) Bmax = Info->Bmag[n];
             ++n;
         }
 
@@ -1470,11 +1593,12 @@ int Lgm_TraceLine4( Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, double dSa, double dSb,
     int		    done, reset, n, SavePnt;
 
     double      sgn, Bmag, Bmag_old, S;
-    int         n1, n2, nn;
+    int         n1, n2, nn, Ok;
     double      *s1, *Px1, *Py1, *Pz1, *Bmag1, *BminusBcdip1;
     Lgm_Vector  *Bvec1;
     double      *s2, *Px2, *Py2, *Pz2, *Bmag2, *BminusBcdip2;
     Lgm_Vector  *Bvec2;
+    LGM_STATS_TRACE( Info, LGM_STATS_TRACE_LINE );
 
     LGM_ARRAY_1D( s1, N, double );
     LGM_ARRAY_1D( Px1, N, double );
@@ -1667,6 +1791,7 @@ int Lgm_TraceLine4( Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, double dSa, double dSb,
     /*
      * Now combine the two parts together.
      */
+    if ( !(Ok = LGM_RESERVE_FL_PNTS( Info, n1+n2 )) ) n1 = n2 = 0;
     nn = 0;
     for ( n=0; n<n1; n++ ) {
         Info->s[nn]           = s1[n];
@@ -1708,6 +1833,11 @@ int Lgm_TraceLine4( Lgm_Vector *Pm_s, Lgm_Vector *Pm_n, double dSa, double dSb,
     LGM_ARRAY_1D_FREE( BminusBcdip2 );
     LGM_ARRAY_1D_FREE( Bvec2 );
 
+    if ( !Ok ) {
+        Info->nPnts = 0;
+        return( -1 );
+    }
+
 
 
 
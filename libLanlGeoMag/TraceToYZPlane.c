@@ -10,8 +10,22 @@
 
 int Lgm_TraceToYZPlane( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn0, double tol, Lgm_MagModelInfo *Info ) {
 
+    return( Lgm_TraceToYZPlane_Seeded( u, v, Xtarget, sgn0, tol, NULL, NULL, Info ) );
+
+}
+
+
+/*
+ *  Same as Lgm_TraceToYZPlane(), but if Seed is valid the bracketing steps
+ *  are shortened to land on Seed->S and Seed->S +/- Seed->Width (e.g. the
+ *  arc length a neighbouring start point needed), so that the bisection
+ *  starts from a narrow bracket. Seed->H0 isnt used. If S isnt NULL it gets
+ *  the arc length (Re) from u to v when the return value is 1.
+ */
+int Lgm_TraceToYZPlane_Seeded( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn0, double tol, Lgm_TraceSeed *Seed, double *S, Lgm_MagModelInfo *Info ) {
+
     Lgm_Vector	u_scale;
-    double	    Htry, Hdid, Hnext, Hmin, Hmax, s, sgn, fsgn0;
+    double	    Htry, Hdid, Hnext, Hmin, Hmax, s, sgn, fsgn0, h, Sp, Spb = 0.0;
     double	    Sa, Sb, B, f, r2, z2, r3, L, R, hhh;
     double      Stotal;
     Lgm_Vector	Btmp;
@@ -35,6 +49,7 @@ int Lgm_TraceToYZPlane( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn
     f = Xtarget - Pa.x;
     fsgn0 = ( f<0.0) ? -1.0 : 1.0;
     Sa   = 0.0;
+    Sp   = 0.0;
     Stotal = 0.0;
     Ntotal = 0;
 
@@ -84,8 +99,10 @@ int Lgm_TraceToYZPlane( Lgm_Vector *u, Lgm_Vector *v, double Xtarget, double sgn
     while ( !done ) {
 
         //if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, 1.0e-7, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
-        if ( Lgm_MagStep( &P, &u_scale, Htry, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
+        h = ( bracketed ) ? Htry : Lgm_TraceSeed_Step( Seed, Sa, Htry );
+        if ( Lgm_MagStep( &P, &u_scale, h, &Hdid, &Hnext, sgn, &s, &reset, Info->Bfield, Info ) < 0 ) return(-1);
         Stotal += Hdid;
+        Sp     += sgn*sgn0*Hdid;    // arc length of P from u
         ++Ntotal;
         R  = Lgm_Magnitude( &P );
         r2 = R*R;
@@ -142,6 +159,7 @@ printf("A: Sa, Sb, P = %g %g    (%g, %g, %g)   Htry = %f\n", Sa, Sb, P.x, P.y, P
 	    } else {
 
             Pb  = P;
+            Spb = Sp;
             if ( bracketed ) Sb += sgn*sgn0*Hdid;
             else	     Sb  = Sa + Hdid;
             
@@ -163,6 +181,7 @@ printf("B: Sa, Sb, P = %g %g    (%g, %g, %g)   Htry = %f\n", Sa, Sb, P.x, P.y, P
      *  
      */
     *v = Pb;
+    if ( S ) *S = Spb;
 //printf("B: Sa, Sb, P = %g %g    (%g, %g, %g)   Htry = %f\n", Sa, Sb, P.x, P.y, P.z, Htry);
 
 
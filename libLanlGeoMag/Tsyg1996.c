@@ -141,6 +141,9 @@ void Lgm_Init_T96( LgmTsyg1996_Info *t ){
 
     t->INTERCON_M_FLAG = 0;
 
+    // per-epoch state filled in by Lgm_Prepare_T96()
+    t->Prepared = FALSE;
+
 
 
     // cached vars in BIRK1SHLD_T96()
@@ -169,6 +172,101 @@ void Lgm_Init_T96( LgmTsyg1996_Info *t ){
 }
 
 
+/**
+ *  \brief
+ *      Compute the point-independent part of the T96 model.
+ *
+ *  \details
+ *      Fills t->Prep with the amplitudes of the various current systems, the
+ *      IMF penetration parameters and the (pressure-scaled) magnetopause
+ *      parameters. These depend only on PARMOD[1-4] and the dipole tilt, so
+ *      they need only be computed once per epoch. Tsyg_T96() calls this
+ *      itself whenever its inputs differ from the ones saved in t->Prep, so
+ *      calling it explicitly is never required.
+ *
+ *      \param[in]       PARMOD  PARMOD[1-4] are Pdyn (nPa), Dst (nT), IMF By and Bz (nT).
+ *      \param[in]       PS      Dipole tilt angle (radians).
+ *      \param[in]       SINPS   sin(PS).
+ *      \param[in]       COSPS   cos(PS).
+ *      \param[in,out]   t       T96 info structure.
+ *
+ */
+void Lgm_Prepare_T96( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg1996_Info *t ) {
+
+    double  A[]    = { -9e99, 1.162, 22.344, 18.50, 2.602, 6.903, 5.287, 0.5790, 0.4462, 0.7850 };
+    double PDYN0   = 2.0;
+    double EPS10   = 3630.7;
+    double AM0     = 70.0;
+    double X00     = 5.48;
+
+    double  PDYN, DST, BYIMF, BZIMF, SqrtPDYN, DEPR, Bt, THETA, EPS, FACTEPS, FACTPD;
+    int     i;
+
+    for ( i=1; i<=4; i++ ) t->Prep.PARMOD[i] = PARMOD[i];
+    t->Prep.PS = PS;
+
+    PDYN  = PARMOD[1];
+    DST   = PARMOD[2];
+    BYIMF = PARMOD[3];
+    BZIMF = PARMOD[4];
+    t->Prep.BYIMF = BYIMF;
+    t->Prep.BZIMF = BZIMF;
+
+    t->cos_psi = COSPS;
+    t->sin_psi = SINPS;
+
+    SqrtPDYN = sqrt( PDYN );
+    DEPR = 0.8*DST - 13.0*SqrtPDYN;  // DEPR is an estimate of total near-Earth depression, based on DST and Pdyn (usually, DEPR < 0 )
+
+
+    /*
+     * CALCULATE THE IMF-RELATED QUANTITIES:
+     */
+    Bt = sqrt( BYIMF*BYIMF + BZIMF*BZIMF );
+
+    if ( (BYIMF == 0.0) && (BZIMF == 0.0) ) {
+        THETA = 0.0;
+    } else {
+        THETA = atan2( BYIMF, BZIMF );
+        if ( THETA <= 0.0) THETA += 6.2831853; // MGH - precision for 2pi is pretty low....
+    }
+
+    t->Prep.ST = sin( THETA );
+    t->Prep.CT = cos( THETA );
+    EPS = 718.5*SqrtPDYN*Bt*sin( 0.5*THETA );
+
+    FACTEPS = EPS/EPS10 - 1.0;
+    FACTPD  = sqrt( PDYN/PDYN0 ) - 1.0;
+
+    t->Prep.RCAMPL = -A[1]*DEPR; //   RCAMPL is the amplitude of the ring current (positive and equal to abs.value of RC depression at origin)
+
+    t->Prep.TAMPL2 = A[2] + A[3]*FACTPD + A[4]*FACTEPS;
+    t->Prep.TAMPL3 = A[5] + A[6]*FACTPD;
+    t->Prep.B1AMPL = A[7] + A[8]*FACTEPS;
+    t->Prep.B2AMPL = 20.0*t->Prep.B1AMPL;  // IT IS EQUIVALENT TO ASSUMING THAT THE TOTAL CURRENT IN THE REGION 2 SYSTEM IS 40% OF THAT IN REGION 1
+    t->Prep.RECONN = A[9];
+
+    t->Prep.XAPPA  = pow( PDYN/PDYN0, 0.14 );
+    t->Prep.XAPPA3 = t->Prep.XAPPA*t->Prep.XAPPA*t->Prep.XAPPA;
+
+    t->Prep.RIMFAMPL = t->Prep.RECONN*Bt;
+
+
+    /*
+     *  SCALE THE MAGNETOPAUSE PARAMETERS FOR THE INTERPOLATION ACROSS
+     *   THE BOUNDARY LAYER
+     */
+    t->Prep.X0  = X00/t->Prep.XAPPA;
+    t->Prep.AM  = AM0/t->Prep.XAPPA;
+    t->Prep.ASQ = t->Prep.AM*t->Prep.AM;
+
+    t->Prepared = TRUE;
+
+    return;
+
+}
+
+
 void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg1996_Info *t) {
 
     /*
@@ -221,65 +319,44 @@ void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     double  CFX, CFY, CFZ, BXRC, BYRC, BZRC, BXT2, BYT2, BZT2, BXT3, BYT3, BZT3;
     double  R1X, R1Y, R1Z, R2X, R2Y, R2Z, RIMFX, RIMFYS, RIMFZS, QX, QY, QZ;
 
-    double  A[]    = { -9e99, 1.162, 22.344, 18.50, 2.602, 6.903, 5.287, 0.5790, 0.4462, 0.7850 };
-    double PDYN0   = 2.0;
-    double EPS10   = 3630.7;
-    double AM0     = 70.0;
     double S0      = 1.08;
-    double X00     = 5.48;
     double DSIG    = 0.005;
     double DELIMFX = 20.0;
     double DELIMFY = 10.0;
 
-    double  PDYN, DST, BYIMF, BZIMF, PPS, SqrtPDYN, DEPR, Bt, THETA, ST, CT, EPS, FACTEPS;
-    double  FACTPD, RCAMPL, TAMPL2, TAMPL3, B1AMPL, B2AMPL, RECONN, XAPPA, XAPPA3, YS, ZS;
+    double  PPS, CT, ST, RCAMPL, TAMPL2, TAMPL3, B1AMPL, B2AMPL, XAPPA, XAPPA3, YS, ZS;
     double  g, g2, FACTIMF, OIMFX, OIMFY, OIMFZ, RIMFAMPL, XX, YY, ZZ, X0, AM, RHO2, ASQ;
     double  XMXM, AXX0, ARO, SIGMA, SPS, RIMFY, RIMFZ, FX, FY, FZ, FINT, FEXT;
 
- 
- 
-    PDYN  = PARMOD[1];
-    DST   = PARMOD[2];
-    BYIMF = PARMOD[3];
-    BZIMF = PARMOD[4];
- 
-    PPS = PS;
-    t->cos_psi = COSPS;
-    SPS = t->sin_psi = SINPS;
- 
-    SqrtPDYN = sqrt( PDYN );
-    DEPR = 0.8*DST - 13.0*SqrtPDYN;  // DEPR is an estimate of total near-Earth depression, based on DST and Pdyn (usually, DEPR < 0 )
- 
+
 
     /*
-     * CALCULATE THE IMF-RELATED QUANTITIES:
+     * Everything that depends only on PARMOD and the tilt is held in t->Prep.
+     * Only redo it if the inputs have changed since the last call.
      */
-    Bt = sqrt( BYIMF*BYIMF + BZIMF*BZIMF );
-
-    if ( (BYIMF == 0.0) && (BZIMF == 0.0) ) {
-        THETA = 0.0;
-    } else {
-        THETA = atan2( BYIMF, BZIMF );
-        if ( THETA <= 0.0) THETA += 6.2831853; // MGH - precision for 2pi is pretty low....
+    if ( !t->Prepared || ( PS != t->Prep.PS )
+            || ( PARMOD[1] != t->Prep.PARMOD[1] ) || ( PARMOD[2] != t->Prep.PARMOD[2] )
+            || ( PARMOD[3] != t->Prep.PARMOD[3] ) || ( PARMOD[4] != t->Prep.PARMOD[4] ) ) {
+        Lgm_Prepare_T96( PARMOD, PS, SINPS, COSPS, t );
     }
 
-    ST  = sin( THETA );
-    CT  = cos( THETA );
-    EPS = 718.5*SqrtPDYN*Bt*sin( 0.5*THETA );
- 
-    FACTEPS = EPS/EPS10 - 1.0;
-    FACTPD  = sqrt( PDYN/PDYN0 ) - 1.0;
- 
-    RCAMPL = -A[1]*DEPR; //   RCAMPL is the amplitude of the ring current (positive and equal to abs.value of RC depression at origin)
- 
-    TAMPL2 = A[2] + A[3]*FACTPD + A[4]*FACTEPS;
-    TAMPL3 = A[5] + A[6]*FACTPD;
-    B1AMPL = A[7] + A[8]*FACTEPS;
-    B2AMPL = 20.0*B1AMPL;  // IT IS EQUIVALENT TO ASSUMING THAT THE TOTAL CURRENT IN THE REGION 2 SYSTEM IS 40% OF THAT IN REGION 1
-    RECONN = A[9];
- 
-    XAPPA  = pow( PDYN/PDYN0, 0.14 );
-    XAPPA3 = XAPPA*XAPPA*XAPPA;
+    PPS = PS;
+    SPS = t->sin_psi;
+
+    CT       = t->Prep.CT;
+    ST       = t->Prep.ST;
+    RCAMPL   = t->Prep.RCAMPL;
+    TAMPL2   = t->Prep.TAMPL2;
+    TAMPL3   = t->Prep.TAMPL3;
+    B1AMPL   = t->Prep.B1AMPL;
+    B2AMPL   = t->Prep.B2AMPL;
+    RIMFAMPL = t->Prep.RIMFAMPL;
+    XAPPA    = t->Prep.XAPPA;
+    XAPPA3   = t->Prep.XAPPA3;
+    X0       = t->Prep.X0;
+    AM       = t->Prep.AM;
+    ASQ      = t->Prep.ASQ;
+
     YS = Y*CT - Z*ST;
     ZS = Z*CT + Y*ST;
      
@@ -291,14 +368,11 @@ void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     /*
      * CALCULATE THE "IMF" COMPONENTS OUTSIDE THE LAYER  (HENCE BEGIN WITH "O")
      */
-    g = RECONN*FACTIMF;
+    g = t->Prep.RECONN*FACTIMF;
     OIMFX = 0.0;
-    OIMFY = g*BYIMF;
-    OIMFZ = g*BZIMF;
- 
-    RIMFAMPL = RECONN*Bt;
+    OIMFY = g*t->Prep.BYIMF;
+    OIMFZ = g*t->Prep.BZIMF;
  
-    PPS = PS;
     XX  = X*XAPPA;
     YY  = Y*XAPPA;
     ZZ  = Z*XAPPA;
@@ -307,13 +381,11 @@ void Tsyg_T96( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
 
     /*
      *
-     *  SCALE AND CALCULATE THE MAGNETOPAUSE PARAMETERS FOR THE INTERPOLATION ACROSS
-     *   THE BOUNDARY LAYER (THE COORDINATES XX,YY,ZZ  ARE ALREADY SCALED)
+     *  CALCULATE THE MAGNETOPAUSE PARAMETERS FOR THE INTERPOLATION ACROSS
+     *   THE BOUNDARY LAYER (THE COORDINATES XX,YY,ZZ  ARE ALREADY SCALED; X0,
+     *   AM AND ASQ WERE SCALED IN Lgm_Prepare_T96())
      */
-    X0   = X00/XAPPA;
-    AM   = AM0/XAPPA;
     RHO2 = Y*Y + Z*Z;
-    ASQ  = AM*AM;
     XMXM = AM + X - X0;
 
     if (XMXM < 0.0) XMXM = 0.0; // THE BOUNDARY IS A CYLINDER TAILWARD OF X=X0-AM
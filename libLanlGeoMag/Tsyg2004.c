@@ -97,6 +97,36 @@ void mysincos(double val, double *sin_val, double *cos_val)
 
 }
 
+/*
+ * TS04 model coefficients (used by Tsyg_TS04() and Lgm_Prepare_TS04())
+ */
+/*
+OLD version of A coeffs.
+static double  A[] = { -9e99, 1.00000, 5.19884, 0.923524, 8.68111, 0.00000, -6.44922, 11.3109,
+                    -3.84555, 0.00000, 0.558081, 0.937044, 0.00000, 0.772433, 0.687241,
+                    0.00000, 0.320369, 1.22531, -0.432246E-01, -0.382436, 0.457468,
+                    0.741917, 0.227194, 0.154269, 5.75196, 22.3113, 10.3526, 64.3312,
+                    1.01977, -0.200859E-01, 0.971643, 0.295525E-01, 1.01032, 0.215561,
+                    1.50059, 0.730898E-01, 1.93625, 1.74545, 1.29533, 0.714744, 0.391687,
+                    3.31283, 75.0127, 6.36283, 4.43561, 0.387801, 0.699661, 0.305352E-01,
+                    0.581002, 1.14671, 0.876060, 0.386060, 0.801831, 0.874315, 0.463634,
+                    0.175077, 0.673053, 0.388341, 2.32074, 1.32373, 0.419800, 1.24968,
+                    1.28903, .409286, 1.57622, .690036, 1.28836, 2.4054, .528557, .564247 };
+*/
+
+// new version
+static double  TS04_A[] = { -9e99, 1.00000, 5.44118, 0.891995, 9.09684, 0.00000, -7.18972, 12.2700,
+                    -4.89408, 0.00000, 0.870536, 1.36081, 0.00000, 0.688650, 0.602330,
+                    0.00000, 0.316346, 1.22728, -0.363620E-01, -0.405821, 0.452536,
+                    0.755831, 0.215662, 0.152759, 5.96235, 23.2036, 11.2994, 69.9596,
+                    0.989596, -0.132131E-01, 0.985681, 0.344212E-01, 1.02389, 0.207867,
+                    1.51220, 0.682715E-01, 1.84714, 1.76977, 1.37690, 0.696350, 0.343280,
+                    3.28846, 111.293, 5.82287, 4.39664, 0.383403, 0.648176, 0.318752E-01,
+                    0.581168, 1.15070, 0.843004, 0.394732, 0.846509, 0.916555, 0.550920,
+                    0.180725, 0.898772, 0.387365, 2.26596, 1.29123, 0.436819, 1.28211,
+                    1.33199, .405553, 1.6229, .699074, 1.26131, 2.42297, .537116, .619441 };
+
+
 void Lgm_Init_TS04( LgmTsyg2004_Info *t ){
 
     int                 i, j;
@@ -113,6 +143,46 @@ void Lgm_Init_TS04( LgmTsyg2004_Info *t ){
         }
     }
 
+    // per-epoch state filled in by TS04_PREPARE()
+    t->Prepared = FALSE;
+
+    return;
+
+}
+
+
+/**
+ *  \brief
+ *      Compute the point-independent part of the TS04 model.
+ *
+ *  \details
+ *      Unpacks PARMOD the same way Tsyg_TS04() does and calls TS04_PREPARE()
+ *      to fill t->Prep (the overall scaling, the magnetopause parameters and
+ *      the amplitudes of the current systems) and the parameter common
+ *      blocks. These depend only on PARMOD, so they need only be computed
+ *      once per epoch. TS04_EXTERN() re-prepares by itself whenever its
+ *      inputs differ from the ones saved in t->Prep, so calling this
+ *      explicitly is never required.
+ *
+ *      \param[in]       PARMOD  PARMOD[1-10] are Pdyn (nPa), Dst (nT), IMF By and Bz (nT) and W1-W6.
+ *      \param[in]       PS      Dipole tilt angle (radians).
+ *      \param[in]       SINPS   sin(PS).
+ *      \param[in]       COSPS   cos(PS).
+ *      \param[in,out]   t       TS04 info structure.
+ *
+ */
+void Lgm_Prepare_TS04( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2004_Info *t ) {
+
+    double  PDYN, DST_AST;
+
+    PDYN    = PARMOD[1];
+    DST_AST = PARMOD[2]*0.8 - 13.0*sqrt( PDYN );
+
+    t->sin_psi_op = SINPS;
+    t->cos_psi_op = COSPS;
+
+    TS04_PREPARE( TS04_A, PDYN, DST_AST, PARMOD[3], PARMOD[4], PARMOD[5], PARMOD[6], PARMOD[7], PARMOD[8], PARMOD[9], PARMOD[10], t );
+
     return;
 
 }
@@ -128,33 +198,6 @@ void Tsyg_TS04( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     double       BXR12, BYR12, BZR12, BXR21, BYR21, BZR21, BXR22, BYR22, BZR22, HXIMF;
     double       HYIMF, HZIMF, BBX, BBY, BBZ;
     int           IOPGEN=1, IOPTT=0, IOPB=0, IOPR=0;
-/*
-    OLD version of A coeffs.
-    static double  A[] = { -9e99, 1.00000, 5.19884, 0.923524, 8.68111, 0.00000, -6.44922, 11.3109,
-                        -3.84555, 0.00000, 0.558081, 0.937044, 0.00000, 0.772433, 0.687241,
-                        0.00000, 0.320369, 1.22531, -0.432246E-01, -0.382436, 0.457468,
-                        0.741917, 0.227194, 0.154269, 5.75196, 22.3113, 10.3526, 64.3312,
-                        1.01977, -0.200859E-01, 0.971643, 0.295525E-01, 1.01032, 0.215561,
-                        1.50059, 0.730898E-01, 1.93625, 1.74545, 1.29533, 0.714744, 0.391687,
-                        3.31283, 75.0127, 6.36283, 4.43561, 0.387801, 0.699661, 0.305352E-01,
-                        0.581002, 1.14671, 0.876060, 0.386060, 0.801831, 0.874315, 0.463634,
-                        0.175077, 0.673053, 0.388341, 2.32074, 1.32373, 0.419800, 1.24968,
-                        1.28903, .409286, 1.57622, .690036, 1.28836, 2.4054, .528557, .564247 };
-*/
-
-    // new version
-    static double  A[] = { -9e99, 1.00000, 5.44118, 0.891995, 9.09684, 0.00000, -7.18972, 12.2700,
-                        -4.89408, 0.00000, 0.870536, 1.36081, 0.00000, 0.688650, 0.602330,
-                        0.00000, 0.316346, 1.22728, -0.363620E-01, -0.405821, 0.452536,
-                        0.755831, 0.215662, 0.152759, 5.96235, 23.2036, 11.2994, 69.9596,
-                        0.989596, -0.132131E-01, 0.985681, 0.344212E-01, 1.02389, 0.207867,
-                        1.51220, 0.682715E-01, 1.84714, 1.76977, 1.37690, 0.696350, 0.343280,
-                        3.28846, 111.293, 5.82287, 4.39664, 0.383403, 0.648176, 0.318752E-01,
-                        0.581168, 1.15070, 0.843004, 0.394732, 0.846509, 0.916555, 0.550920,
-                        0.180725, 0.898772, 0.387365, 2.26596, 1.29123, 0.436819, 1.28211,
-                        1.33199, .405553, 1.6229, .699074, 1.26131, 2.42297, .537116, .619441 };
-
-
     IOPGEN = 0;
     IOPTT  = 0;
     IOPB   = 0;
@@ -182,7 +225,7 @@ void Tsyg_TS04( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     ZZ  = Z;
 
 
-    TS04_EXTERN( IOPGEN, IOPTT, IOPB, IOPR, A, 69, PDYN, DST_AST, BXIMF, BYIMF,
+    TS04_EXTERN( IOPGEN, IOPTT, IOPB, IOPR, TS04_A, 69, PDYN, DST_AST, BXIMF, BYIMF,
         BZIMF, W1, W2, W3, W4, W5, W6, PSS, XX, YY, ZZ, &BXCF, &BYCF, &BZCF, &BXT1, &BYT1,
         &BZT1, &BXT2, &BYT2, &BZT2, &BXSRC, &BYSRC, &BZSRC, &BXPRC, &BYPRC, &BZPRC,  &BXR11,
         &BYR11, &BZR11, &BXR12, &BYR12, &BZR12, &BXR21, &BYR21, &BZR21, &BXR22, &BYR22,
@@ -217,6 +260,95 @@ printf("BBX, BBY, BBZ   = %.10g %.10g %.10g\n", BBX, BBY, BBZ);
 
 
 
+/*
+ *  Computes everything in TS04_EXTERN() that does not depend on the position
+ *  and saves it (along with the inputs it was computed from) in tInfo->Prep
+ *  and in the tail, Birkeland and ring current parameter common blocks.
+ */
+void TS04_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double W1, double W2, double W3,
+                double W4, double W5, double W6, LgmTsyg2004_Info *tInfo ) {
+
+    double    XAPPA, DSTT, ZNAM, ZNAM05, ooZNAM20, DLP1, DLP2, FACTIMF;
+    double    A0_A=34.586, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
+
+    tInfo->Prep.A     = A;
+    tInfo->Prep.PDYN  = PDYN;
+    tInfo->Prep.DST   = DST;
+    tInfo->Prep.BYIMF = BYIMF;
+    tInfo->Prep.BZIMF = BZIMF;
+    tInfo->Prep.W1 = W1; tInfo->Prep.W2 = W2; tInfo->Prep.W3 = W3;
+    tInfo->Prep.W4 = W4; tInfo->Prep.W5 = W5; tInfo->Prep.W6 = W6;
+
+    tInfo->CB_G.G     = 35.0;    // TAIL WARPING PARAMETER
+    tInfo->CB_RH0.RH0 = 7.5;    // TAIL HINGING DISTANCE
+
+    XAPPA = mypow( 0.5*PDYN, A[23] );   //  OVERALL SCALING PARAMETER
+    tInfo->XAPPA       = XAPPA;
+    tInfo->Prep.XAPPA  = XAPPA;
+    tInfo->Prep.XAPPA3 = XAPPA*XAPPA*XAPPA;
+
+    tInfo->Prep.X0  = A0_X0/XAPPA;
+    tInfo->Prep.AM  = A0_A/XAPPA;
+    tInfo->Prep.ASQ = tInfo->Prep.AM*tInfo->Prep.AM;
+
+    /*
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER
+     */
+    FACTIMF = A[20];
+    tInfo->Prep.OIMFY = BYIMF*FACTIMF;
+    tInfo->Prep.OIMFZ = BZIMF*FACTIMF;
+
+    /*
+     *  TAIL FIELD PARAMETERS
+     */
+    DSTT = -20.;
+    if (DST < DSTT) DSTT = DST;
+    ZNAM = mypow( fabs( DSTT ), 0.37 );
+    tInfo->CB_TAIL.DXSHIFT1 = A[24]-A[25]/ZNAM;
+    tInfo->CB_TAIL.DXSHIFT2 = A[26]-A[27]/ZNAM;
+    tInfo->CB_TAIL.D = A[36]*exp(-W1/A[37])  +A[69];
+    tInfo->CB_TAIL.DELTADY = 4.7;
+
+    /*
+     *  BIRKELAND CURRENT PARAMETERS
+     */
+    ZNAM = fabs( DST );
+    if ( DST >= -20.0 ) ZNAM = 20.0;
+    ZNAM05 = 0.05*ZNAM;
+    tInfo->CB_BIRKPAR.XKAPPA1 = A[32]*mypow( ZNAM05, A[33] );
+    tInfo->CB_BIRKPAR.XKAPPA2 = A[34]*mypow( ZNAM05, A[35] );
+
+    /*
+     *  RING CURRENT PARAMETERS
+     */
+    tInfo->CB_RCPAR.PHI  = A[38];
+    ooZNAM20 = 20.0/ZNAM;
+    tInfo->CB_RCPAR.SC_SY = A[28]* mypow( ooZNAM20, A[29]) * XAPPA;    //
+    tInfo->CB_RCPAR.SC_AS = A[30]* mypow( ooZNAM20, A[31]) * XAPPA;    //  MULTIPLICATION  BY XAPPA IS MADE IN ORDER TO MAKE THE SRC AND PRC
+                            //  SCALING COMPLETELY INDEPENDENT OF THE GENERAL SCALING DUE TO THE
+                            //  MAGNETOPAUSE COMPRESSION/EXPANSION
+
+    /*
+     *  AMPLITUDES OF THE VARIOUS CURRENT SYSTEMS
+     */
+    DLP1 = mypow( 0.5*PDYN, A[21] );
+    DLP2 = mypow( 0.5*PDYN, A[22] );
+
+    tInfo->Prep.TAMP1 = A[2]  + A[3]*DLP1 +  A[4]*A[39]*W1/sqrt(W1*W1+A[39]*A[39]) + A[5]*DST;
+    tInfo->Prep.TAMP2 = A[6]  + A[7]*DLP2 +  A[8]*A[40]*W2/sqrt(W2*W2+A[40]*A[40]) + A[9]*DST;
+    tInfo->Prep.A_SRC = A[10] + A[11]*A[41]*W3/sqrt(W3*W3+A[41]*A[41]) + A[12]*DST;
+    tInfo->Prep.A_PRC = A[13] + A[14]*A[42]*W4/sqrt(W4*W4+A[42]*A[42]) + A[15]*DST;
+    tInfo->Prep.A_R11 = A[16] + A[17]*A[43]*W5/sqrt(W5*W5+A[43]*A[43]);
+    tInfo->Prep.A_R21 = A[18] + A[19]*A[44]*W6/sqrt(W6*W6+A[44]*A[44]);
+
+    tInfo->Prepared = TRUE;
+
+    return;
+
+}
+
+
+
 /*
  *     IOPGEN - GENERAL OPTION FLAG:  IOPGEN=0 - CALCULATE TOTAL FIELD
  *                                    IOPGEN=1 - DIPOLE SHIELDING ONLY
@@ -246,32 +378,30 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         double *BZR22, double *HXIMF, double *HYIMF, double *HZIMF, double *BX, double *BY, double *BZ, LgmTsyg2004_Info *tInfo ) {
 
     int       done;
-    double    XAPPA, XAPPA2, XAPPA3, SPS, X0, AM, S0, FACTIMF, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
+    double    XAPPA, XAPPA3, SPS, X0, AM, S0, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
     double    XSOLD, ZSOLD, ZSSoR, ZSSoR2, RH, RoRH, RoRH2, RoRH3, SINPSAS, SINPSAS2, COSPSAS, DD, RHO2, ASQ;
-    double    XMXM, AXX0, ARO, AROpAXX0, AROpAXX02, SIGMA, CFX, CFY, CFZ, DSTT, ZNAM;
-    double    DLP1, DLP2, TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
-    double    A_R21, QX, QY, QZ, FINT, FEXT, ZNAM05, ooZNAM20, BBX, BBY, BBZ;
+    double    XMXM, AXX0, ARO, AROpAXX0, AROpAXX02, SIGMA, CFX, CFY, CFZ;
+    double    TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
+    double    A_R21, QX, QY, QZ, FINT, FEXT, BBX, BBY, BBZ;
 
 
-    double    A0_A=34.586, A0_S0=1.1960, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
+    double    A0_S0=1.1960;     // SHUE ET AL. PARAMETERS
     double    DSIG=0.005, RH2=-5.2;
 
 
-    tInfo->CB_G.G     = 35.0;    // TAIL WARPING PARAMETER
-    tInfo->CB_RH0.RH0 = 7.5;    // TAIL HINGING DISTANCE
-
-
-
-    if ( PDYN != tInfo->OLD_PDYN ) {
-        XAPPA = mypow( 0.5*PDYN, A[23] );   //  OVERALL SCALING PARAMETER
-        tInfo->XAPPA = XAPPA;
-    } else {
-        XAPPA = tInfo->XAPPA;   //  OVERALL SCALING PARAMETER
+    /*
+     *  Everything that does not depend on (X,Y,Z) is held in tInfo->Prep. Only
+     *  redo it if the inputs have changed since the last call.
+     */
+    if ( !tInfo->Prepared || ( A != tInfo->Prep.A ) || ( PDYN != tInfo->Prep.PDYN ) || ( DST != tInfo->Prep.DST )
+            || ( BYIMF != tInfo->Prep.BYIMF ) || ( BZIMF != tInfo->Prep.BZIMF )
+            || ( W1 != tInfo->Prep.W1 ) || ( W2 != tInfo->Prep.W2 ) || ( W3 != tInfo->Prep.W3 )
+            || ( W4 != tInfo->Prep.W4 ) || ( W5 != tInfo->Prep.W5 ) || ( W6 != tInfo->Prep.W6 ) ) {
+        TS04_PREPARE( A, PDYN, DST, BYIMF, BZIMF, W1, W2, W3, W4, W5, W6, tInfo );
     }
 
-
-    XAPPA2 = XAPPA*XAPPA;
-    XAPPA3 = XAPPA*XAPPA2;
+    XAPPA  = tInfo->Prep.XAPPA;   //  OVERALL SCALING PARAMETER
+    XAPPA3 = tInfo->Prep.XAPPA3;
 
     XX = X*XAPPA;
     YY = Y*XAPPA;
@@ -280,21 +410,20 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 //    SPS = sin( PS );
     SPS = tInfo->sin_psi_op;
 
-    X0 = A0_X0/XAPPA;
-    AM = A0_A/XAPPA;
-    S0 = A0_S0;
+    X0  = tInfo->Prep.X0;
+    AM  = tInfo->Prep.AM;
+    ASQ = tInfo->Prep.ASQ;
+    S0  = A0_S0;
 
 
     /*
-     *  CALCULATE "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
      *  THEY ARE NEEDED ONLY IF THE POINT (X,Y,Z) IS WITHIN THE TRANSITION MAGNETOPAUSE LAYER
      *  OR OUTSIDE THE MAGNETOSPHERE:
      */
-    FACTIMF = A[20];
-
     OIMFX = 0.0;
-    OIMFY = BYIMF*FACTIMF;
-    OIMFZ = BZIMF*FACTIMF;
+    OIMFY = tInfo->Prep.OIMFY;
+    OIMFZ = tInfo->Prep.OIMFZ;
 
 
     R   = sqrt( X*X + Y*Y + Z*Z );
@@ -331,7 +460,6 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 
 
     RHO2 = Y*Y + ZSS*ZSS;
-    ASQ  = AM*AM;
     XMXM = AM + XSS - X0;
     if (XMXM < 0.0) XMXM = 0.0; // THE BOUNDARY IS A CYLINDER TAILWARD OF X=X0-AM
     AXX0 = XMXM*XMXM;
@@ -365,14 +493,6 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 2) ) {
-            DSTT = -20.;
-            if (DST < DSTT) DSTT = DST;
-    // Cache this.
-            ZNAM = mypow( fabs( DSTT ), 0.37 );
-            tInfo->CB_TAIL.DXSHIFT1 = A[24]-A[25]/ZNAM;
-            tInfo->CB_TAIL.DXSHIFT2 = A[26]-A[27]/ZNAM;
-            tInfo->CB_TAIL.D = A[36]*exp(-W1/A[37])  +A[69];
-            tInfo->CB_TAIL.DELTADY = 4.7;
             DEFORMED( IOPT, PS, XX, YY, ZZ, BXT1, BYT1, BZT1, BXT2, BYT2, BZT2, tInfo );     // TAIL FIELD (THREE MODES)
         } else {
             *BXT1=0.0;
@@ -384,13 +504,6 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if  ( (IOPGEN == 0) || (IOPGEN == 3) ) {
-            ZNAM = fabs( DST );
-            if ( DST >= -20.0 ) ZNAM = 20.0;
-            ZNAM05 = 0.05*ZNAM;
-    // Cache this.
-            tInfo->CB_BIRKPAR.XKAPPA1 = A[32]*mypow( ZNAM05, A[33] );
-    // Cache this.
-            tInfo->CB_BIRKPAR.XKAPPA2 = A[34]*mypow( ZNAM05, A[35] );
             BIRK_TOT( IOPB, PS, XX, YY, ZZ, BXR11, BYR11, BZR11, BXR12, BYR12,
                     BZR12, BXR21, BYR21, BZR21, BXR22, BYR22, BZR22, tInfo );    //   BIRKELAND FIELD (TWO MODES FOR R1 AND TWO MODES FOR R2)
         } else {
@@ -404,16 +517,6 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 
 
         if  ( (IOPGEN == 0) || (IOPGEN == 4) ) {
-            tInfo->CB_RCPAR.PHI  = A[38];
-            ZNAM = fabs( DST );
-            if ( DST >= -20.0 ) ZNAM = 20.0;
-            ooZNAM20 = 20.0/ZNAM;
-    //could create a LUT for this pow.
-            tInfo->CB_RCPAR.SC_SY = A[28]* mypow( ooZNAM20, A[29]) * XAPPA;    //
-    //could create a LUT for this pow.
-            tInfo->CB_RCPAR.SC_AS = A[30]* mypow( ooZNAM20, A[31]) * XAPPA;    //  MULTIPLICATION  BY XAPPA IS MADE IN ORDER TO MAKE THE SRC AND PRC
-                                    //  SCALING COMPLETELY INDEPENDENT OF THE GENERAL SCALING DUE TO THE
-                                    //  MAGNETOPAUSE COMPRESSION/EXPANSION
             FULL_RC( IOPR, PS, XX, YY, ZZ, BXSRC, BYSRC, BZSRC, BXPRC, BYPRC, BZPRC, tInfo );    // SHIELDED RING CURRENT (SRC AND PRC)
         } else {
             *BXSRC = 0.0;
@@ -442,19 +545,14 @@ void TS04_EXTERN( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 
 
         /*
-         *    NOW, ADD UP ALL THE COMPONENTS:
+         *    NOW, ADD UP ALL THE COMPONENTS (THE AMPLITUDES WERE COMPUTED IN TS04_PREPARE()):
          */
-    //could create a LUT for this pow.
-        DLP1 = mypow( 0.5*PDYN, A[21] );
-    //could create a LUT for this pow.
-        DLP2 = mypow( 0.5*PDYN, A[22] );
-
-        TAMP1 = A[2]  + A[3]*DLP1 +  A[4]*A[39]*W1/sqrt(W1*W1+A[39]*A[39]) + A[5]*DST;
-        TAMP2 = A[6]  + A[7]*DLP2 +  A[8]*A[40]*W2/sqrt(W2*W2+A[40]*A[40]) + A[9]*DST;
-        A_SRC = A[10] + A[11]*A[41]*W3/sqrt(W3*W3+A[41]*A[41]) + A[12]*DST;
-        A_PRC = A[13] + A[14]*A[42]*W4/sqrt(W4*W4+A[42]*A[42]) + A[15]*DST;
-        A_R11 = A[16] + A[17]*A[43]*W5/sqrt(W5*W5+A[43]*A[43]);
-        A_R21 = A[18] + A[19]*A[44]*W6/sqrt(W6*W6+A[44]*A[44]);
+        TAMP1 = tInfo->Prep.TAMP1;
+        TAMP2 = tInfo->Prep.TAMP2;
+        A_SRC = tInfo->Prep.A_SRC;
+        A_PRC = tInfo->Prep.A_PRC;
+        A_R11 = tInfo->Prep.A_R11;
+        A_R21 = tInfo->Prep.A_R21;
 
         BBX = A[1]* *BXCF + TAMP1* *BXT1 + TAMP2* *BXT2 + A_SRC* *BXSRC + A_PRC* *BXPRC + A_R11* *BXR11 + A_R21* *BXR21 + A[20]* *HXIMF;
         BBY = A[1]* *BYCF + TAMP1* *BYT1 + TAMP2* *BYT2 + A_SRC* *BYSRC + A_PRC* *BYPRC + A_R11* *BYR11 + A_R21* *BYR21 + A[20]* *HYIMF;
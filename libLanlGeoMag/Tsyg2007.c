@@ -16,38 +16,78 @@ void mysincos(double val, double *sin_val, double *cos_val);
  *  Converted to C by Michael G. Henderson (mghenderson@lanl.gov) Aug 10, 2012.
  */
 
-void Lgm_SetCoeffs_TS07( long int Date, double UTC, LgmTsyg2007_Info *t ){
+/*
+ *  Read one of the per-epoch coefficient files into A[1..101]. Returns FALSE
+ *  if the file couldnt be opened.
+ */
+int Lgm_Read_TS07_CoeffFile( const char *Filename, double *A ){
 
-    int     k, year, month, day, doy, hour, minute, min5;
-    double  fpart;
-    char    Filename[1024], tmpstr[512];
+    int     k;
+    char    tmpstr[512];
     FILE    *fp;
+
+    if ( (fp = fopen( Filename, "r" )) == NULL ) return( FALSE );
+
+    for ( k=1; k<=101; k++ ) {
+        fgets( tmpstr, 512, fp);
+        sscanf( tmpstr, "%lf", &A[k] );
+        //fscanf( fp, "%lf%*[\n]\n", &A[k] );
+    }
+    fclose(fp);
+
+    return( TRUE );
+
+}
+
+
+void Lgm_SetCoeffs_TS07( long int Date, double UTC, LgmTsyg2007_Info *t ){
+
+    int             k, year, month, day, doy, hour, minute, min5;
+    double          fpart, UT;
+    char            Filename[1024];
+    const double    *A;
     const char* TS07_DATA_PATH = getenv("TS07_DATA_PATH");
     if (TS07_DATA_PATH==NULL) {
         TS07_DATA_PATH = LGM_TS07_DATA_DIR;
     }
 
+    /*
+     *  Use the binary archive if we have one and it has this epoch.
+     */
+    if ( (A = Lgm_TS07_ArchiveCoeffs( Lgm_TS07_GetArchive(), Date, UTC )) != NULL ) {
+        for ( k=1; k<=101; k++ ) t->A[k] = A[k-1];
+        return;
+    }
+
+    /*
+     *  Or the day cache, if the day was prefetched (see Lgm_TS07_PrefetchDay()).
+     */
+    if ( Lgm_TS07_CachedCoeffs( Date, UTC, t->A ) ) return;
+
     Lgm_Doy(Date, &year, &month, &day, &doy);
     //get time and round to nearest 5 minutes... TODO:should read two files and interpolate coeffs
     hour = (int)UTC;
     fpart = UTC - (int)UTC;
     minute = (int)(fpart*60.0);
     min5 = ((minute + 5/2) / 5) * 5;
+    if ( min5 == 60 ) {
+        // minutes 58 and 59 round up to the next hour (or day), as in Lgm_TS07_ArchiveCoeffs()
+        min5 = 0;
+        if ( ++hour == 24 ) {
+            hour = 0;
+            Lgm_jd_to_ymdh( (double)(Lgm_JDN( year, month, day ) + 1), &Date, &year, &month, &day, &UT );
+            Lgm_Doy( Date, &year, &month, &day, &doy );
+        }
+    }
 
     /*
      *  Read in coeffs
      */
     sprintf( Filename, "%s/Coeffs/%d_%03d/%d_%03d_%02d_%02d.par", TS07_DATA_PATH, year, doy, year, doy, hour, min5 );
 
-    if ( (fp = fopen( Filename, "r" )) != NULL ) {
+    if ( Lgm_Read_TS07_CoeffFile( Filename, t->A ) ) {
 
-        for ( k=1; k<=101; k++ ) {
-            fgets( &tmpstr, 512, fp);
-            sscanf( &tmpstr, "%lf", &t->A[k] );
-            //fscanf( fp, "%lf%*[\n]\n", &t->A[k] );
-            printf("t->A[%d] = %g\n", k, t->A[k]);
-        }
-	    fclose(fp);
+        for ( k=1; k<=101; k++ ) printf("t->A[%d] = %g\n", k, t->A[k]);
 
     } else {
 
@@ -63,58 +103,19 @@ void Lgm_SetCoeffs_TS07( long int Date, double UTC, LgmTsyg2007_Info *t ){
 
 
 
-
-
-void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
+/*
+ *  Read in the TSS, TSO, and TSE .par files from Path/TAIL_PAR. Returns FALSE
+ *  if any of them couldnt be opened.
+ */
+int Lgm_Read_TS07_TailPar( const char *Path, LgmTsyg2007_Info *t ){
 
     int     i, j, k;
     char    Filename[1024];
     FILE    *fp;
-    const char* TS07_DATA_PATH = getenv("TS07_DATA_PATH");
-//printf("[TS07] Got path: %s\n", TS07_DATA_PATH);
-    if (TS07_DATA_PATH==NULL) {
-        TS07_DATA_PATH = LGM_TS07_DATA_DIR;
-    }
 
-    // Init some params
-    t->OLD_PS = -9e99;
-    t->OLD_X  = -9e99;
-    t->OLD_Y  = -9e99;
-    t->OLD_Z  = -9e99;
-    for (i=0; i<4; i++ ){
-        t->DoneJ[i] = 0;
-        t->S_DoneJ[i] = 0;
-        for (j=0; j<4; j++ ){
-            t->P[i][j] = -9e99;
-            t->Q[i][j] = -9e99;
-            t->R[i][j] = -9e99;
-            t->S[i][j] = -9e99;
-            t->S_P[i][j] = -9e99;
-            t->S_Q[i][j] = -9e99;
-            t->S_R[i][j] = -9e99;
-            t->S_S[i][j] = -9e99;
-        }
-    }
-
-
-    /*
-     * Allocate memory for parameter arrays.
-     */
-    LGM_ARRAY_1D( t->A,   102, double );
-    LGM_ARRAY_2D( t->TSS, 81, 6, double );
-    LGM_ARRAY_3D( t->TSO, 81, 6, 5, double );
-    LGM_ARRAY_3D( t->TSE, 81, 6, 5, double );
-    t->ArraysAlloced = TRUE;
-
-
-
-
-    /*
-     *  Read in the TSS, TSO, and TSE .par files
-     */
     for ( i=1; i<=5; i++ ) {
 
-        sprintf( Filename, "%s/TAIL_PAR/tailamebhr%1d.par", TS07_DATA_PATH, i );
+        sprintf( Filename, "%s/TAIL_PAR/tailamebhr%1d.par", Path, i );
         if ( (fp = fopen( Filename, "r" )) != NULL ) {
 
             for ( k=1; k<=80; k++ ) fscanf( fp, "%lf", &t->TSS[k][i] );
@@ -122,9 +123,9 @@ void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
 
         } else {
 
-            printf("Lgm_Init_TS07(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
+            printf("Lgm_Read_TS07_TailPar(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
 	    perror("Error");
-            exit(-1);
+            return( FALSE );
 
         }
 
@@ -133,16 +134,16 @@ void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
     for ( i=1; i<=5; i++ ) {
         for ( j=1; j<=4; j++ ) {
 
-            sprintf( Filename, "%s/TAIL_PAR/tailamhr_o_%1d%1d.par", TS07_DATA_PATH, i, j );
+            sprintf( Filename, "%s/TAIL_PAR/tailamhr_o_%1d%1d.par", Path, i, j );
             if ( (fp = fopen( Filename, "r" )) != NULL ) {
                 for ( k=1; k<=80; k++ ) fscanf( fp, "%lf", &t->TSO[k][i][j] );
 		fclose(fp);
 
             } else {
 
-                printf("Lgm_Init_TS07(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
+                printf("Lgm_Read_TS07_TailPar(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
 		perror("Error");
-                exit(-1);
+                return( FALSE );
 
             }
 
@@ -152,7 +153,7 @@ void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
     for ( i=1; i<=5; i++ ) {
         for ( j=1; j<=4; j++ ) {
 
-            sprintf( Filename, "%s/TAIL_PAR/tailamhr_e_%1d%1d.par", TS07_DATA_PATH, i, j );
+            sprintf( Filename, "%s/TAIL_PAR/tailamhr_e_%1d%1d.par", Path, i, j );
             if ( (fp = fopen( Filename, "r" )) != NULL ) {
 
                 for ( k=1; k<=80; k++ ) fscanf( fp, "%lf", &t->TSE[k][i][j] );
@@ -160,15 +161,74 @@ void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
 
             } else {
 
-                printf("Lgm_Init_TS07(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
+                printf("Lgm_Read_TS07_TailPar(): Line %d in file %s. Could not open file %s\n", __LINE__, __FILE__, Filename );
 		perror("Error");
-                exit(-1);
+                return( FALSE );
 
             }
 
         }
     }
 
+    return( TRUE );
+
+}
+
+
+void Lgm_Init_TS07( LgmTsyg2007_Info *t ){
+
+    int                 i, j;
+    Lgm_TS07_Archive    *Archive;
+    const char* TS07_DATA_PATH = getenv("TS07_DATA_PATH");
+//printf("[TS07] Got path: %s\n", TS07_DATA_PATH);
+    if (TS07_DATA_PATH==NULL) {
+        TS07_DATA_PATH = LGM_TS07_DATA_DIR;
+    }
+
+    // Init some params
+    t->OLD_PS = -9e99;
+    t->OLD_X  = -9e99;
+    t->OLD_Y  = -9e99;
+    t->OLD_Z  = -9e99;
+    for (i=0; i<4; i++ ){
+        t->DoneJ[i] = 0;
+        t->S_DoneJ[i] = 0;
+        for (j=0; j<4; j++ ){
+            t->P[i][j] = -9e99;
+            t->Q[i][j] = -9e99;
+            t->R[i][j] = -9e99;
+            t->S[i][j] = -9e99;
+            t->S_P[i][j] = -9e99;
+            t->S_Q[i][j] = -9e99;
+            t->S_R[i][j] = -9e99;
+            t->S_S[i][j] = -9e99;
+        }
+    }
+
+
+    /*
+     * Allocate memory for parameter arrays.
+     */
+    LGM_ARRAY_1D( t->A,   102, double );
+    LGM_ARRAY_2D( t->TSS, 81, 6, double );
+    LGM_ARRAY_3D( t->TSO, 81, 6, 5, double );
+    LGM_ARRAY_3D( t->TSE, 81, 6, 5, double );
+    t->ArraysAlloced = TRUE;
+    t->TailAlloced   = TRUE;
+
+
+
+
+    /*
+     *  Get the TSS, TSO, and TSE coeffs. From the binary archive if there is
+     *  one, otherwise from the .par files.
+     */
+    if ( (Archive = Lgm_TS07_GetArchive()) != NULL ) {
+        Lgm_TS07_ArchiveTailPar( Archive, t );
+    } else if ( !Lgm_Read_TS07_TailPar( TS07_DATA_PATH, t ) ) {
+        exit(-1);
+    }
+
 
 
     return;
@@ -179,10 +239,13 @@ void Lgm_DeAllocate_TS07( LgmTsyg2007_Info *t ){
 
     if ( t->ArraysAlloced == TRUE ) {
         LGM_ARRAY_1D_FREE( t->A );
+        t->ArraysAlloced = FALSE;
+    }
+    if ( t->TailAlloced == TRUE ) {
         LGM_ARRAY_2D_FREE( t->TSS );
         LGM_ARRAY_3D_FREE( t->TSO );
         LGM_ARRAY_3D_FREE( t->TSE );
-        t->ArraysAlloced = FALSE;
+        t->TailAlloced = FALSE;
     }
 
 }
@@ -965,7 +1028,8 @@ void    TS07D_UNWARPED( double X, double Y, double Z, double BXS[6], double BYS[
 
     int     K, L;
     double  **TSS, ***TSO, ***TSE;
-    double  D0, BXSK, BYSK, BZSK, BXOKL, BYOKL, BZOKL, BXEKL, BYEKL, BZEKL;
+    double  D0, RNOT, DLTK, RHO, CSPHI, SNPHI, phi, CSMPHI[5], SNMPHI[5], ZD;
+    double  RKM, RKMZ, RKMR, REX, AJ[5], AJM, AJMD, BRO, BPHI;
     //double  HXSK, HYSK, HZSK, HXOKL, HYOKL, HZOKL, HXEKL, HYEKL, HZEKL;
 
     /*
@@ -977,7 +1041,9 @@ void    TS07D_UNWARPED( double X, double Y, double Z, double BXS[6], double BYS[
     TSS = tInfo->TSS;
     TSO = tInfo->TSO;
     TSE = tInfo->TSE;
-    D0  = tInfo->CB_TAIL.D;
+    D0   = tInfo->CB_TAIL.D;
+    RNOT = 20.0;                // Rho_0 - scale parameter along the tail axis
+    DLTK = 1.0;                 // step in Km
 
 
     /*
@@ -986,35 +1052,54 @@ void    TS07D_UNWARPED( double X, double Y, double Z, double BXS[6], double BYS[
      *
      *
      */
-    for ( K=1; K<=5; K++ ){
-
-        TS07D_TAILSHT_S( K, X, Y, Z, &BXSK, &BYSK, &BZSK, tInfo );
-        //SHTBNORM_S( K, X, Y, Z, &HXSK, &HYSK, &HZSK );
-
-        BXS[K] = BXSK;  // +HXSK
-        BYS[K] = BYSK;  // +HYSK
-        BZS[K] = BZSK;  // +HZSK
-
+    /*
+     *  This is TS07D_TAILSHT_S( K, ... ) and TS07D_TAILSHT_OE( IEVO, K, L, ... )
+     *  for all K and L, written out so that the things that only depend on
+     *  the point (phi, cos(L phi), ZD) are done once, and the things that
+     *  only depend on K (the exponential and J_0..J_4 of K*RHO/RNOT) are done
+     *  once per K rather than once per mode. The Bessel functions all come
+     *  from one bessj_array() call per K.
+     */
+    RHO   = sqrt( X*X + Y*Y );
+    CSPHI = X/RHO;
+    SNPHI = Y/RHO;
+    phi   = atan2( Y, X );
+    for ( L=1; L<=4; L++ ) {
+        CSMPHI[L] = cos( L*phi );
+        SNMPHI[L] = sin( L*phi );
     }
-
+    ZD = sqrt( Z*Z + D0*D0 );
 
     for ( K=1; K<=5; K++ ){
-        for ( L=1; L<=4; L++ ){
 
-            TS07D_TAILSHT_OE( 1, K, L, X, Y, Z, &BXOKL, &BYOKL, &BZOKL, tInfo );
-            //SHTBNORM_O( K, L, X, Y, Z, &HXOKL, &HYOKL, &HZOKL );
+        RKM  = (1.0 + (double)(K-1)*DLTK)/RNOT;
+        RKMZ = RKM*Z;
+        RKMR = RKM*RHO;
+        REX  = exp( RKM*ZD );
+        bessj_array( 4, RKMR, AJ );
 
+        BXS[K] = RKMZ*AJ[1]*CSPHI/ZD/REX;
+        BYS[K] = RKMZ*AJ[1]*SNPHI/ZD/REX;
+        BZS[K] = RKM*AJ[0]/REX;
+
+        for ( L=1; L<=4; L++ ){
 
-          BXO[K][L] = BXOKL; // +HXOKL
-          BYO[K][L] = BYOKL; // +HYOKL
-          BZO[K][L] = BZOKL; // +HZOKL
+            AJM  = AJ[L];
+            AJMD = AJ[L-1] - L*AJM/RKMR;
 
-          TS07D_TAILSHT_OE( 0, K, L, X, Y, Z, &BXEKL, &BYEKL, &BZEKL, tInfo );
-          //SHTBNORM_E( K, L, X, Y, Z, &HXEKL, &HYEKL, &HZEKL );
+            // odd (asymmetric) modes
+            BRO  = L*CSMPHI[L]*Z*AJMD/ZD/REX;
+            BPHI = -L*L*SNMPHI[L]*Z*AJM/RKMR/ZD/REX;
+            BXO[K][L] = BRO*CSPHI - BPHI*SNPHI;
+            BYO[K][L] = BRO*SNPHI + BPHI*CSPHI;
+            BZO[K][L] = -L*CSMPHI[L]*AJM/REX;
 
-          BXE[K][L] = BXEKL;  // +HXEKL
-          BYE[K][L] = BYEKL;  // +HYEKL
-          BZE[K][L] = BZEKL;  // +HZEKL
+            // even (symmetric) modes
+            BRO  = -L*SNMPHI[L]*Z*AJMD/ZD/REX;
+            BPHI = -L*L*CSMPHI[L]*Z*AJM/RKMR/ZD/REX;
+            BXE[K][L] = BRO*CSPHI - BPHI*SNPHI;
+            BYE[K][L] = BRO*SNPHI + BPHI*CSPHI;
+            BZE[K][L] = L*SNMPHI[L]*AJM/REX;
 
         }
     }
@@ -1027,9 +1112,6 @@ void    TS07D_UNWARPED( double X, double Y, double Z, double BXS[6], double BYS[
 
 
 
-
-
-
 void TS07D_TAILSHT_S( int M, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2007_Info *tInfo ) {
 
     double  D, RNOT, DLTK, RHO, CSPHI, SNPHI, DKM, RKM;
@@ -1081,8 +1163,8 @@ void TS07D_TAILSHT_S( int M, double X, double Y, double Z, double *BX, double *B
 void TS07D_SHTBNORM_S( int K, double X, double Y, double Z, double *FX, double *FY, double *FZ, LgmTsyg2007_Info *tInfo ) {
 
     int     L, m1, m, n;
-    double  AK[6], phi, CMP, SMP, RHO, AKN, AKNR, CHZ, SHZ;
-    double  AKNRI, RHOI, AJM, AJM1, AJMD, DPDX, DPDY;
+    double  AK[6], phi, CMP, SMP, RHO, RHOI, AKN[6], AKNR[6], AKNRI[6], CHZ[6], SHZ[6];
+    double  AJ[6][15], AJM, AJMD, DPDX, DPDY;
     double  HX1, HX2, HX, HY1, HY2, HY, HZ;
     double  **TSS;
 
@@ -1097,10 +1179,25 @@ void TS07D_SHTBNORM_S( int K, double X, double Y, double Z, double *FX, double *
 
     phi = atan2( Y, X );
 
+    /*
+     *  Everything that doesnt depend on m is done up front, and J_0..J_14 of
+     *  each of the five arguments comes from a single bessj_array() call.
+     */
+    RHO  = sqrt( X*X + Y*Y );
+    RHOI = (  RHO < 1e-8 ) ? 1e8 : 1.0/RHO;
+    DPDX = -Y*RHOI*RHOI;
+    DPDY =  X*RHOI*RHOI;
+    for ( n=1; n<=5; n++ ) {
+        AKN[n]   = fabs( AK[n] );
+        AKNR[n]  = AKN[n]*RHO;
+        AKNRI[n] = ( AKNR[n] < 1e-8 ) ? 1e8 : 1.0/AKNR[n];
+        CHZ[n]   = cosh( Z*AKN[n] );
+        SHZ[n]   = sinh( Z*AKN[n] );
+        bessj_array( 14, AKNR[n], AJ[n] );
+    }
 
     L = 0;
     *FX = *FY = *FZ = 0.0;
-
     for ( m1=1; m1<=15; m1++ ) {
         m = m1-1;
 
@@ -1109,74 +1206,18 @@ void TS07D_SHTBNORM_S( int K, double X, double Y, double Z, double *FX, double *
 
         for ( n=1; n<=5; n++ ) {
 
-            RHO  = sqrt( X*X + Y*Y );
-            AKN  = fabs( AK[n] );
-            AKNR = AKN*RHO;
-
-            CHZ = cosh( Z*AKN );
-            SHZ = sinh( Z*AKN );
-
-            if ( AKNR < 1e-8 ) {
-                AKNRI = 1.0e8;
-            } else {
-                AKNRI = 1.0/AKNR;
-            }
-
-            if ( RHO < 1e-8 ) {
-                RHOI = 1.0e8;
-            } else {
-                RHOI = 1.0/RHO;
-            }
-
-
-            if ( m > 2 ) {
-
-                AJM  = bessj( m, AKNR );
-                AJM1 = bessj( m-1, AKNR );
-                AJMD = AJM1 - m*AJM*AKNRI;
-
-            } else {
-
-                if ( m == 2 ) {
-
-                    AJM  = bessj( 2, AKNR );
-                    AJM1 = bessj1( AKNR );
-                    AJMD = AJM1 - m*AJM*AKNRI;
-
-                } else {
-
-                   if ( m == 1 ) {
-
-                        AJM  = bessj1( AKNR );
-                        AJM1 = bessj0( AKNR );
-                        AJMD = AJM1 - AJM*AKNRI;
-
-                    } else {
-
-                        AJM  =  bessj0(AKNR);
-                        AJMD = -bessj1(AKNR);
-
-                    }
-
-                }
-
-            }
-
-
-            DPDX = -Y*RHOI*RHOI;
-            DPDY =  X*RHOI*RHOI;
-
-            HX1 =  m*DPDX*SMP*SHZ*AJM;
-            HX2 = -AKN*X*RHOI*CMP*SHZ*AJMD;
+            AJM  = AJ[n][m];
+            AJMD = ( m == 0 ) ? -AJ[n][1] : AJ[n][m-1] - m*AJM*AKNRI[n];
 
-            HX = HX1 + HX2;
-
-            HY1 =  m*DPDY*SMP*SHZ*AJM;
-            HY2 = -AKN*Y*RHOI*CMP*SHZ*AJMD;
+            HX1 =  m*DPDX*SMP*SHZ[n]*AJM;
+            HX2 = -AKN[n]*X*RHOI*CMP*SHZ[n]*AJMD;
+            HX  = HX1 + HX2;
 
-            HY = HY1 + HY2;
+            HY1 =  m*DPDY*SMP*SHZ[n]*AJM;
+            HY2 = -AKN[n]*Y*RHOI*CMP*SHZ[n]*AJMD;
+            HY  = HY1 + HY2;
 
-            HZ = -AKN*CMP*CHZ*AJM;
+            HZ = -AKN[n]*CMP*CHZ[n]*AJM;
 
             ++L;
 
@@ -1280,10 +1321,9 @@ void TS07D_TAILSHT_OE( int IEVO, int MK, int M, double X, double Y, double Z, do
 void TS07D_SHTBNORM_O( int K, int L, double X, double Y, double Z, double *FX, double *FY, double *FZ, LgmTsyg2007_Info *tInfo ) {
 
     int     m, m1, n, L1;
-    double  AK[6], phi, CMP, SMP, RHO, AKN;
-    double  AKNR, CHZ, SHZ, AKNRI, RHOI, AJM, AJM1, AJMD;
-    double  DPDX, DPDY, HX1, HX2,HY1, HY2;
-    double  HX, HY, HZ;
+    double  AK[6], phi, CMP, SMP, RHO, RHOI, AKN[6], AKNR[6], AKNRI[6], CHZ[6], SHZ[6];
+    double  AJ[6][15], AJM, AJMD, DPDX, DPDY;
+    double  HX1, HX2, HX, HY1, HY2, HY, HZ;
     double  ***TSO;
 
     TSO = tInfo->TSO;
@@ -1297,70 +1337,45 @@ void TS07D_SHTBNORM_O( int K, int L, double X, double Y, double Z, double *FX, d
 
     phi = atan2( Y, X );
 
+    /*
+     *  Everything that doesnt depend on m is done up front, and J_0..J_14 of
+     *  each of the five arguments comes from a single bessj_array() call.
+     */
+    RHO  = sqrt( X*X + Y*Y );
+    RHOI = (  RHO < 1e-8 ) ? 1e8 : 1.0/RHO;
+    DPDX = -Y*RHOI*RHOI;
+    DPDY =  X*RHOI*RHOI;
+    for ( n=1; n<=5; n++ ) {
+        AKN[n]   = fabs( AK[n] );
+        AKNR[n]  = AKN[n]*RHO;
+        AKNRI[n] = ( AKNR[n] < 1e-8 ) ? 1e8 : 1.0/AKNR[n];
+        CHZ[n]   = cosh( Z*AKN[n] );
+        SHZ[n]   = sinh( Z*AKN[n] );
+        bessj_array( 14, AKNR[n], AJ[n] );
+    }
+
     L1 = 0;
     *FX = *FY = *FZ = 0.0;
-    for ( m1=1; m1<=15; m1++ ){
+    for ( m1=1; m1<=15; m1++ ) {
         m = m1-1;
 
         CMP = cos( m*phi );
         SMP = sin( m*phi );
-        for ( n=1; n<=5; n++ ){
-
-            RHO  = sqrt( X*X + Y*Y );
-            AKN  = fabs( AK[n] );
-            AKNR = AKN*RHO;
-
-            CHZ = cosh( Z*AKN );
-            SHZ = sinh( Z*AKN );
-
-            AKNRI = ( AKNR < 1e-8 ) ? 1e8 : 1.0/AKNR;
-            RHOI  = (  RHO < 1e-8 ) ? 1e8 : 1.0/RHO;
-
-            if ( m > 2 ) {
-
-                AJM  = bessj( m, AKNR );
-                AJM1 = bessj( m-1, AKNR );
-                AJMD = AJM1 - m*AJM*AKNRI;
-
-            } else {
-
-                if ( m == 2 ) {
 
-                   AJM  = bessj( 2, AKNR );
-                   AJM1 = bessj1( AKNR );
-                   AJMD = AJM1 - m*AJM*AKNRI;
-
-                } else {
-
-                    if ( m == 1 ) {
-
-                        AJM  = bessj1( AKNR );
-                        AJM1 = bessj0( AKNR );
-                        AJMD = AJM1 - AJM*AKNRI;
-
-                    } else {
-
-                        AJM  =  bessj0( AKNR );
-                        AJMD = -bessj1( AKNR );
-
-                    }
-
-                }
-
-            }
+        for ( n=1; n<=5; n++ ) {
 
-            DPDX = -Y*RHOI*RHOI;
-            DPDY = X*RHOI*RHOI;
+            AJM  = AJ[n][m];
+            AJMD = ( m == 0 ) ? -AJ[n][1] : AJ[n][m-1] - m*AJM*AKNRI[n];
 
-            HX1 =  m*DPDX*SMP*SHZ*AJM;
-            HX2 =  -AKN*X*RHOI*CMP*SHZ*AJMD;
-            HX  = HX1+HX2;
+            HX1 =  m*DPDX*SMP*SHZ[n]*AJM;
+            HX2 = -AKN[n]*X*RHOI*CMP*SHZ[n]*AJMD;
+            HX  = HX1 + HX2;
 
-            HY1 =  m*DPDY*SMP*SHZ*AJM;
-            HY2 = -AKN*Y*RHOI*CMP*SHZ*AJMD;
+            HY1 =  m*DPDY*SMP*SHZ[n]*AJM;
+            HY2 = -AKN[n]*Y*RHOI*CMP*SHZ[n]*AJMD;
             HY  = HY1 + HY2;
 
-            HZ = -AKN*CMP*CHZ*AJM;
+            HZ = -AKN[n]*CMP*CHZ[n]*AJM;
 
             ++L1;
 
@@ -1372,6 +1387,7 @@ void TS07D_SHTBNORM_O( int K, int L, double X, double Y, double Z, double *FX, d
     }
 
     return;
+
 }
 
 
@@ -1381,9 +1397,9 @@ void TS07D_SHTBNORM_O( int K, int L, double X, double Y, double Z, double *FX, d
 void TS07D_SHTBNORM_E( int K, int L, double X, double Y, double Z, double *FX, double *FY, double *FZ, LgmTsyg2007_Info *tInfo ) {
 
     int     m, m1, n, L1;
-    double  AK[6], phi, CMP, SMP, RHO, AKN;
-    double  AKNR, CHZ, SHZ, AKNRI, RHOI, AJM, AJM1, JMD;
-    double  DPDX, DPDY, HX1, HX2, HY1, HY2, AJMD, HX, HY, HZ;
+    double  AK[6], phi, CMP, SMP, RHO, RHOI, AKN[6], AKNR[6], AKNRI[6], CHZ[6], SHZ[6];
+    double  AJ[6][15], AJM, AJMD, DPDX, DPDY;
+    double  HX1, HX2, HX, HY1, HY2, HY, HZ;
     double  ***TSE;
 
     TSE = tInfo->TSE;
@@ -1397,6 +1413,23 @@ void TS07D_SHTBNORM_E( int K, int L, double X, double Y, double Z, double *FX, d
 
     phi = atan2( Y, X );
 
+    /*
+     *  Everything that doesnt depend on m is done up front, and J_0..J_14 of
+     *  each of the five arguments comes from a single bessj_array() call.
+     */
+    RHO  = sqrt( X*X + Y*Y );
+    RHOI = (  RHO < 1e-8 ) ? 1e8 : 1.0/RHO;
+    DPDX = -Y*RHOI*RHOI;
+    DPDY =  X*RHOI*RHOI;
+    for ( n=1; n<=5; n++ ) {
+        AKN[n]   = fabs( AK[n] );
+        AKNR[n]  = AKN[n]*RHO;
+        AKNRI[n] = ( AKNR[n] < 1e-8 ) ? 1e8 : 1.0/AKNR[n];
+        CHZ[n]   = cosh( Z*AKN[n] );
+        SHZ[n]   = sinh( Z*AKN[n] );
+        bessj_array( 14, AKNR[n], AJ[n] );
+    }
+
     L1 = 0;
     *FX = *FY = *FZ = 0.0;
     for ( m1=1; m1<=15; m1++ ) {
@@ -1404,64 +1437,21 @@ void TS07D_SHTBNORM_E( int K, int L, double X, double Y, double Z, double *FX, d
 
         CMP = cos( m*phi );
         SMP = sin( m*phi );
-        for ( n=1; n<=5; n++ ) {
-
-            RHO  = sqrt( X*X + Y*Y );
-            AKN  = fabs( AK[n] );
-            AKNR = AKN*RHO;
-
-            CHZ = cosh( Z*AKN );
-            SHZ = sinh( Z*AKN );
-
-            AKNRI = ( AKNR < 1e-8 ) ? 1e8 : 1.0/AKNR;
-            RHOI  = (  RHO < 1e-8 ) ? 1e8 : 1.0/RHO;
-
-            if ( m > 2 ) {
-
-                   AJM  = bessj( m, AKNR );
-                   AJM1 = bessj( m-1, AKNR );
-                   AJMD = AJM1 - m*AJM*AKNRI;
-
-            } else {
-
-                if( m == 2 ) {
-
-                   AJM  = bessj( 2, AKNR );
-                   AJM1 = bessj1( AKNR );
-                   AJMD = AJM1 - m*AJM*AKNRI;
-
-                } else {
-
-                    if ( m == 1 ) {
-
-                        AJM  = bessj1( AKNR );
-                        AJM1 = bessj0( AKNR );
-                        AJMD = AJM1 - AJM*AKNRI;
-
-                    } else {
-
-                        AJM  =  bessj0( AKNR );
-                        AJMD = -bessj1( AKNR );
-
-                    }
-
-                }
-            }
-
 
+        for ( n=1; n<=5; n++ ) {
 
-            DPDX = -Y*RHOI*RHOI;
-            DPDY = X*RHOI*RHOI;
+            AJM  = AJ[n][m];
+            AJMD = ( m == 0 ) ? -AJ[n][1] : AJ[n][m-1] - m*AJM*AKNRI[n];
 
-            HX1 = -m*DPDX*CMP*SHZ*AJM;
-            HX2 = -AKN*X*RHOI*SMP*SHZ*AJMD;
+            HX1 = -m*DPDX*CMP*SHZ[n]*AJM;
+            HX2 = -AKN[n]*X*RHOI*SMP*SHZ[n]*AJMD;
             HX  = HX1 + HX2;
 
-            HY1 = -m*DPDY*CMP*SHZ*AJM;
-            HY2 = -AKN*Y*RHOI*SMP*SHZ*AJMD;
+            HY1 = -m*DPDY*CMP*SHZ[n]*AJM;
+            HY2 = -AKN[n]*Y*RHOI*SMP*SHZ[n]*AJMD;
             HY  = HY1 + HY2;
 
-            HZ = -AKN*SMP*CHZ*AJM;
+            HZ = -AKN[n]*SMP*CHZ[n]*AJM;
 
             ++L1;
 
@@ -1662,6 +1652,92 @@ double  bessj( int n, double x ) {
 }
 
 
+/*
+ *  J[0..M] = J_0(x) .. J_M(x) all at once, instead of M+1 calls to bessj0(),
+ *  bessj1() and bessj() (each of which starts its own recurrence from
+ *  scratch). J[0] and J[1] come from bessj0() and bessj1(), and the orders
+ *  below |x| from the same upward recurrence that bessj() uses (so they are
+ *  bit for bit the same). The orders at or above |x| (where the upward
+ *  recurrence is unstable) all come out of one downward (Miller) sweep
+ *  started above M, normalized the same way as in bessj(). They agree with
+ *  bessj() to a few 1e-7 near n ~ |x| and are closer to the true values
+ *  there (bessj() starts a shorter sweep for each order).
+ */
+void bessj_array( int M, double x, double *J ) {
+
+    int     IACC=40, j, n, nLo, jsum;
+    double  BIGNO=1e10;
+    double  BIGNI=1e-10;
+    double  ax, tox, bjm, bjp, bj, sum;
+
+    J[0] = bessj0( x );
+    if ( M < 1 ) return;
+    J[1] = bessj1( x );
+    if ( M < 2 ) return;
+
+    ax = fabs(x);
+    if ( ax == 0.0 ) {
+        for ( n=2; n<=M; n++ ) J[n] = 0.0;
+        return;
+    }
+    tox = 2.0/ax;
+
+    /*
+     *  Upward for 2 <= n < ax (starting from |x| as in bessj()).
+     */
+    bjm = bessj0( ax );
+    bj  = bessj1( ax );
+    for ( n=2; (n<=M) && ((double)n < ax); n++ ) {
+        bjp = (n-1)*tox*bj - bjm;
+        bjm = bj;
+        bj  = bjp;
+        J[n] = bj;
+    }
+    nLo = n;
+
+    /*
+     *  Downward for nLo <= n <= M.
+     */
+    if ( nLo <= M ) {
+
+        jsum = 0;
+        sum = 0.0;
+        bjp = 0.0;
+        bj  = 1.0;
+
+        for ( j=2*( ( M + (int)(sqrt(IACC*M)) )/2 ); j>=1; j-- ) {
+
+            bjm = j*tox*bj - bjp;
+            bjp = bj;
+            bj  = bjm;
+
+            if ( fabs(bj) > BIGNO ) {
+                bj  *= BIGNI;
+                bjp *= BIGNI;
+                sum *= BIGNI;
+                for ( n=( j > nLo ) ? j : nLo; n<=M; n++ ) J[n] *= BIGNI;
+            }
+
+            if ( jsum != 0 ) sum += bj;
+            jsum = 1 - jsum;
+            if ( (j-1 >= nLo) && (j-1 <= M) ) J[j-1] = bj;
+
+        }
+
+        sum = 2.0*sum - bj;
+        for ( n=nLo; n<=M; n++ ) J[n] /= sum;
+
+    }
+
+    if ( x < 0.0 ) {
+        for ( n=3; n<=M; n+=2 ) J[n] = -J[n];
+    }
+
+    return;
+
+}
+
+
 void     TS07D_BIRK_TOT( double PS, double X, double Y, double Z,
         double *BX11, double *BY11, double *BZ11, double *BX12, double *BY12, double *BZ12,
         double *BX21, double *BY21, double *BZ21, double *BX22, double *BY22, double *BZ22, LgmTsyg2007_Info *tInfo ){
@@ -67,6 +67,18 @@
  *
  */
 
+/*
+ * T01S model coefficients (used by Tsyg_T01S() and Lgm_Prepare_T01S())
+ */
+static double T01S_A[] = { -9e99, 1.00000, -1.19284, 1.32478, 0.41388, -0.07590, -1.97502, 5.68628,
+                          0.00000, 0.00000, 0.79889, -0.02588, -0.43873, 0.85784, 0.06948, 0.00000,
+                          0.45972, 0.17565, 0.07657, 0.01401, -0.13690, -0.11077, .10648, -0.02855,
+                          0.42485, 0.08011, 0.92924, 0.04264, 1.56467, 3.00000, 1.27061, 0.11224,
+                          0.93388, -0.00612, 1.22288, 0.95616, 0.31496, 1.37517, 0.12376, 0.15954,
+                          7.70000, 40.00000, 0.70733, 0.30588, 12.18290, 40.00, 82.76604, 27.22990,
+                          98.37391, 14.39243, 4.80011, 7.99216 };
+
+
 void Lgm_Init_T01S( LgmTsyg2001_Info *t ){
 
     int                 i, j;
@@ -83,12 +95,52 @@ void Lgm_Init_T01S( LgmTsyg2001_Info *t ){
         }
     }
 
+    // per-epoch state filled in by T01S_PREPARE() or T02_PREPARE()
+    t->Prepared = FALSE;
+
     return;
 
 }
 
 
 
+/**
+ *  \brief
+ *      Compute the point-independent part of the T01S model.
+ *
+ *  \details
+ *      Unpacks PARMOD the same way Tsyg_T01S() does and calls T01S_PREPARE()
+ *      to fill t->Prep (the overall scaling, the magnetopause parameters, the
+ *      IMF clock angle terms and the amplitudes of the current systems) and
+ *      the parameter common blocks. These depend only on PARMOD and the tilt,
+ *      so they need only be computed once per epoch. T01S_EXTALL()
+ *      re-prepares by itself whenever its inputs differ from the ones saved
+ *      in t->Prep, so calling this explicitly is never required.
+ *
+ *      \param[in]       PARMOD  PARMOD[1-6] are Pdyn (nPa), Dst (nT), IMF By and Bz (nT), G2 and G3.
+ *      \param[in]       PS      Dipole tilt angle (radians).
+ *      \param[in]       SINPS   sin(PS).
+ *      \param[in]       COSPS   cos(PS).
+ *      \param[in,out]   t       T01S/T02 info structure.
+ *
+ */
+void Lgm_Prepare_T01S( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2001_Info *t ) {
+
+    double  PDYN, DST_AST;
+
+    t->sin_psi = SINPS;
+    t->cos_psi = COSPS;
+
+    PDYN    = PARMOD[1];
+    DST_AST = PARMOD[2]*0.8 - 13.0*sqrt( PDYN );
+
+    T01S_PREPARE( T01S_A, PDYN, DST_AST, PARMOD[3], PARMOD[4], 0.0, PARMOD[5], PARMOD[6], PS, t );
+
+    return;
+
+}
+
+
 void Tsyg_T01S( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2001_Info *t ) {
 
     double       PDYN, DST_AST, BYIMF=0.0, BZIMF=0.0, G1, G2, G3;   // added G3
@@ -99,13 +151,6 @@ void Tsyg_T01S( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     double       HYIMF, HZIMF, BBX, BBY, BBZ;
 //    int           IOPGEN=0, IOPTT=0, IOPB=0, IOPR=0;
 
-    static double A[] = { -9e99, 1.00000, -1.19284, 1.32478, 0.41388, -0.07590, -1.97502, 5.68628,
-                           0.00000, 0.00000, 0.79889, -0.02588, -0.43873, 0.85784, 0.06948, 0.00000,
-                           0.45972, 0.17565, 0.07657, 0.01401, -0.13690, -0.11077, .10648, -0.02855,
-                           0.42485, 0.08011, 0.92924, 0.04264, 1.56467, 3.00000, 1.27061, 0.11224,
-                           0.93388, -0.00612, 1.22288, 0.95616, 0.31496, 1.37517, 0.12376, 0.15954,
-                           7.70000, 40.00000, 0.70733, 0.30588, 12.18290, 40.00, 82.76604, 27.22990,
-                           98.37391, 14.39243, 4.80011, 7.99216 };
 
 
 
@@ -127,7 +172,7 @@ void Tsyg_T01S( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     YY   = Y;
     ZZ   = Z;
 
-    T01S_EXTALL( 0, 0, 0, 0, A, 51, PDYN, DST_AST, BYIMF, BZIMF, G1, G2, G3,
+    T01S_EXTALL( 0, 0, 0, 0, T01S_A, 51, PDYN, DST_AST, BYIMF, BZIMF, G1, G2, G3,
          PSS, XX, YY, ZZ, &BXCF, &BYCF, &BZCF, &BXT1, &BYT1, &BZT1, &BXT2, &BYT2, &BZT2, 
          &BXSRC, &BYSRC, &BZSRC, &BXPRC, &BYPRC, &BZPRC,  &BXR11, &BYR11, &BZR11, 
          &BXR12, &BYR12, &BZR12, &BXR21, &BYR21, &BZR21, &BXR22, &BYR22, &BZR22, &HXIMF, 
@@ -156,6 +201,118 @@ void Tsyg_T01S( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
 
 
 
+/*
+ *  Computes everything in T01S_EXTALL() that does not depend on the position
+ *  and saves it (along with the inputs it was computed from) in t->Prep and
+ *  in the tail, Birkeland and ring current parameter common blocks.
+ */
+void T01S_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double G1, double G2, double G3,
+                    double PS, LgmTsyg2001_Info *t ) {
+
+    double    THETA, st, a, ZNAM, DLP1, DLP2, XAPPA, FACTIMF;
+    double    G2T1, G2T2, G3PRC, G2R11, G2R12, G2R21, G2R22;
+    double    A0_A=34.586, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
+
+    t->Prep.A     = A;
+    t->Prep.PDYN  = PDYN;
+    t->Prep.DST   = DST;
+    t->Prep.BYIMF = BYIMF;
+    t->Prep.BZIMF = BZIMF;
+    t->Prep.G1    = G1;
+    t->Prep.G2    = G2;
+    t->Prep.G3    = G3;
+    t->Prep.PS    = PS;
+
+    XAPPA  = pow( 0.5*PDYN, A[39] );   //  NOW THIS IS A VARIABLE PARAMETER
+    t->CB_RH0.RH0  = A[40]; // TAIL HINGING DISTANCE
+    t->CB_G.G      = A[41]; // TAIL WARPING PARAMETER
+
+    t->Prep.XAPPA  = XAPPA;
+    t->Prep.XAPPA3 = XAPPA*XAPPA*XAPPA;
+    t->Prep.SPS    = sin( PS );
+
+    t->Prep.X0  = A0_X0/XAPPA;
+    t->Prep.AM  = A0_A/XAPPA;
+    t->Prep.ASQ = t->Prep.AM*t->Prep.AM;
+
+
+    /*
+     * CALCULATE THE IMF CLOCK ANGLE:
+     */
+    if ( (BYIMF==0.0)&&(BZIMF==0.0)) {
+        THETA = 0.0;
+    } else {
+        THETA = atan2( BYIMF, BZIMF );
+        if ( THETA <= 0.0 ) THETA += 2.0*M_PI;
+    }
+    st = sin( 0.5*THETA );
+    t->Prep.STHETAH = st*st;
+
+    /*
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER
+     */
+    FACTIMF = A[24] + A[25]*t->Prep.STHETAH;
+    t->Prep.OIMFY = BYIMF*FACTIMF;
+    t->Prep.OIMFZ = BZIMF*FACTIMF;
+
+    /*
+     *  TAIL FIELD PARAMETERS
+     */
+    t->CB_TAIL.DXSHIFT1 = A[26] + A[27]*G2*40.0/sqrt(1600.0 + G2*G2);
+    t->CB_TAIL.DXSHIFT2 = 0.0;
+    t->CB_TAIL.D        = A[28];
+    t->CB_TAIL.DELTADY  = A[29];
+
+    /*
+     *  BIRKELAND CURRENT PARAMETERS
+     */
+    ZNAM = fabs( DST );
+    if ( ZNAM < 20.0 ) ZNAM = 20.0;
+    t->CB_BIRKPAR.XKAPPA1 = A[35]*pow( ZNAM/20.0, A[36] );
+    t->CB_BIRKPAR.XKAPPA2 = A[37]*pow( ZNAM/20.0, A[38] );
+
+    /*
+     *  RING CURRENT PARAMETERS
+     */
+    t->CB_RCPAR.PHI  = A[34];
+    a     = 20.0/ZNAM;
+    t->CB_RCPAR.SC_SY = A[30]*pow(a, A[31])*XAPPA;
+    t->CB_RCPAR.SC_AS = A[32]*pow(a, A[33])*XAPPA;
+
+    /*
+     *  AMPLITUDES OF THE VARIOUS CURRENT SYSTEMS
+     */
+    a    = 0.5*PDYN;
+    DLP1 = pow( a, A[42] );
+    DLP2 = pow( a, A[43] );
+
+    G2T1  = A[44];
+    G2T2  = A[45];
+    G3PRC = A[46];
+    G2R11 = A[47];
+    G2R12 = A[48];
+    G2R21 = A[49];
+    G2R22 = A[50];
+
+    t->Prep.TAMP1 = A[2] + A[3]*DLP1 + A[4]*G2*G2T1/sqrt(G2T1*G2T1 + G2*G2) + A[5]*DST;            //   modified in this "j"-version
+    t->Prep.TAMP2 = A[6] + A[7]*DLP2 + A[8]*G2*G2T2/sqrt(G2T2*G2T2 + G2*G2) + A[9]*DST;
+
+    a = sqrt( PDYN );
+    t->Prep.A_SRC = A[10] + A[11]*DST + A[12]*a;
+    t->Prep.A_PRC = A[13] + A[14]*G3*G3PRC/sqrt(G3PRC*G3PRC + G3*G3) + A[15]*a;
+    t->Prep.A_R11 = A[16] + A[17]*G2*G2R11/sqrt(G2R11*G2R11 + G2*G2);
+    t->Prep.A_R12 = A[18] + A[19]*G2*G2R12/sqrt(G2R12*G2R12 + G2*G2);
+    t->Prep.A_R21 = A[20] + A[21]*G2*G2R21/sqrt(G2R21*G2R21 + G2*G2);
+    t->Prep.A_R22 = A[22] + A[23]*G2*G2R22/sqrt(G2R22*G2R22 + G2*G2);
+
+    t->Prepared = TRUE;
+
+    return;
+
+}
+
+
+
 /*
  * 
  *    IOPGEN - GENERAL OPTION FLAG:  IOPGEN=0 - CALCULATE TOTAL FIELD
@@ -188,70 +345,54 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
                     double *BX, double *BY, double *BZ, LgmTsyg2001_Info *t ){
 
     int       done;
-    double    BPERP, THETA, CT, ST, YS, ZS, st, STHETAH, a, aa, b, A_R12, A_R22;
-    double    XAPPA, XAPPA3, SPS, X0, AM, S0, FACTIMF, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
+    double    STHETAH, a, aa, b, A_R12, A_R22;
+    double    XAPPA, XAPPA3, SPS, X0, AM, S0, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
     double    XSOLD, ZSOLD, RH, SINPSAS, COSPSAS, DD, RHO2, ASQ;
-    double    XMXM, AXX0, ARO, SIGMA, CFX, CFY, CFZ, ZNAM;
-    double    DLP1, DLP2, TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
+    double    XMXM, AXX0, ARO, SIGMA, CFX, CFY, CFZ;
+    double    TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
     double    A_R21, QX, QY, QZ, FINT, FEXT, BBX, BBY, BBZ;
-    double    G2T1, G2T2, G3PRC, G2R11, G2R12, G2R21, G2R22;
 
 
 
-    double    A0_A=34.586, A0_S0=1.1960, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
-    double    DSIG=0.005, RH0=8.0, RH2=-5.2;
+    double    A0_S0=1.1960;     // SHUE ET AL. PARAMETERS
+    double    DSIG=0.005, RH2=-5.2;
 
 
-    XAPPA  = pow( 0.5*PDYN, A[39] );   //  NOW THIS IS A VARIABLE PARAMETER
-    t->CB_RH0.RH0  = A[40]; // TAIL HINGING DISTANCE
-    t->CB_G.G      = A[41]; // TAIL WARPING PARAMETER
+    /*
+     *  Everything that does not depend on (X,Y,Z) is held in t->Prep. Only
+     *  redo it if the inputs have changed since the last call.
+     */
+    if ( !t->Prepared || ( A != t->Prep.A ) || ( PS != t->Prep.PS ) || ( PDYN != t->Prep.PDYN ) || ( DST != t->Prep.DST )
+            || ( BYIMF != t->Prep.BYIMF ) || ( BZIMF != t->Prep.BZIMF )
+            || ( G1 != t->Prep.G1 ) || ( G2 != t->Prep.G2 ) || ( G3 != t->Prep.G3 ) ) {
+        T01S_PREPARE( A, PDYN, DST, BYIMF, BZIMF, G1, G2, G3, PS, t );
+    }
 
-    XAPPA3 = XAPPA*XAPPA*XAPPA;
+    XAPPA  = t->Prep.XAPPA;
+    XAPPA3 = t->Prep.XAPPA3;
 
     XX = X*XAPPA;
     YY = Y*XAPPA;
     ZZ = Z*XAPPA;
 
-    SPS = sin( PS );
-
-    X0 = A0_X0/XAPPA;
-    AM = A0_A/XAPPA;
-    S0 = A0_S0;
+    SPS = t->Prep.SPS;
 
-    BPERP = sqrt( BYIMF*BYIMF + BZIMF*BZIMF );
+    X0  = t->Prep.X0;
+    AM  = t->Prep.AM;
+    ASQ = t->Prep.ASQ;
+    S0  = A0_S0;
 
+    STHETAH = t->Prep.STHETAH;
 
     /*
-     * CALCULATE THE IMF CLOCK ANGLE:
-     */
-    if ( (BYIMF==0.0)&&(BZIMF==0.0)) {
-        THETA = 0.0;
-    } else {
-        THETA = atan2( BYIMF, BZIMF );
-        if ( THETA <= 0.0 ) THETA += 2.0*M_PI;
-    }
-
-
-    CT = cos(THETA);
-    ST = sin(THETA);
-    YS = Y*CT - Z*ST;
-    ZS = Z*CT + Y*ST;
-
-    st = sin( 0.5*THETA );
-    STHETAH = st*st;
-
-    /*
-     *  CALCULATE "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
      *  THEY ARE NEEDED ONLY IF THE POINT (X,Y,Z) IS WITHIN THE TRANSITION MAGNETOPAUSE LAYER
      *  OR OUTSIDE THE MAGNETOSPHERE:
      *
      */
-
-    FACTIMF = A[24] + A[25]*STHETAH;
-
     OIMFX = 0.0;
-    OIMFY = BYIMF*FACTIMF;
-    OIMFZ = BZIMF*FACTIMF;
+    OIMFY = t->Prep.OIMFY;
+    OIMFZ = t->Prep.OIMFZ;
 
     R   = sqrt( X*X + Y*Y + Z*Z );
     XSS = X;
@@ -278,7 +419,6 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 
 
     RHO2 = Y*Y + ZSS*ZSS;
-    ASQ  = AM*AM;
     XMXM = AM + XSS - X0;
     if ( XMXM < 0.0 ) XMXM = 0.0; // THE BOUNDARY IS A CYLINDER TAILWARD OF X=X0-AM
     AXX0  = XMXM*XMXM;
@@ -313,10 +453,6 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 2) ) {
-            t->CB_TAIL.DXSHIFT1 = A[26] + A[27]*G2*40.0/sqrt(1600.0 + G2*G2);
-            t->CB_TAIL.DXSHIFT2 = 0.0;
-            t->CB_TAIL.D        = A[28];
-            t->CB_TAIL.DELTADY  = A[29];
             T01S_DEFORMED( IOPT, PS, XX, YY, ZZ, BXT1, BYT1, BZT1, BXT2, BYT2, BZT2, t ); //  TAIL FIELD (THREE MODES)
         } else {
             *BXT1 = 0.0;
@@ -328,12 +464,6 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 3) ) {
-
-            ZNAM = fabs( DST );
-            if ( ZNAM < 20.0 ) ZNAM = 20.0;
-            t->CB_BIRKPAR.XKAPPA1 = A[35]*pow( ZNAM/20.0, A[36] );
-            t->CB_BIRKPAR.XKAPPA2 = A[37]*pow( ZNAM/20.0, A[38] );
-
             T01S_BIRK_TOT( IOPB, PS, XX, YY, ZZ, BXR11, BYR11, BZR11, BXR12, BYR12, 
                                   BZR12, BXR21, BYR21, BZR21, BXR22, BYR22, BZR22, t  );    //   BIRKELAND FIELD (TWO MODES FOR R1 AND TWO MODES FOR R2)
         } else {
@@ -352,12 +482,6 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 4) ) {
-            t->CB_RCPAR.PHI  = A[34];
-            ZNAM = fabs(DST);
-            if ( ZNAM < 20.0 ) ZNAM = 20.0;
-            a     = 20.0/ZNAM;
-            t->CB_RCPAR.SC_SY = A[30]*pow(a, A[31])*XAPPA;
-            t->CB_RCPAR.SC_AS = A[32]*pow(a, A[33])*XAPPA;
 //            printf("C: SC_SY, SC_AS = %g %g\n", t->CB_RCPAR.SC_SY, t->CB_RCPAR.SC_AS );
             T01S_FULL_RC(IOPR, PS, XX, YY, ZZ, BXSRC, BYSRC, BZSRC, BXPRC, BYPRC, BZPRC, t );  //  SHIELDED RING CURRENT (SRC AND PRC)
         } else {
@@ -393,29 +517,14 @@ void T01S_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
          *
          */
 
-        a    = 0.5*PDYN;
-        DLP1 = pow( a, A[42] );
-        DLP2 = pow( a, A[43] );
-
-        G2T1  = A[44];
-        G2T2  = A[45];
-        G3PRC = A[46];
-        G2R11 = A[47];
-        G2R12 = A[48];
-        G2R21 = A[49];
-        G2R22 = A[50];
-
-
-        TAMP1 = A[2] + A[3]*DLP1 + A[4]*G2*G2T1/sqrt(G2T1*G2T1 + G2*G2) + A[5]*DST;            //   modified in this "j"-version
-        TAMP2 = A[6] + A[7]*DLP2 + A[8]*G2*G2T2/sqrt(G2T2*G2T2 + G2*G2) + A[9]*DST;
-
-        a = sqrt( PDYN );
-        A_SRC = A[10] + A[11]*DST + A[12]*a;
-        A_PRC = A[13] + A[14]*G3*G3PRC/sqrt(G3PRC*G3PRC + G3*G3) + A[15]*a;
-        A_R11 = A[16] + A[17]*G2*G2R11/sqrt(G2R11*G2R11 + G2*G2);
-        A_R12 = A[18] + A[19]*G2*G2R12/sqrt(G2R12*G2R12 + G2*G2);
-        A_R21 = A[20] + A[21]*G2*G2R21/sqrt(G2R21*G2R21 + G2*G2);
-        A_R22 = A[22] + A[23]*G2*G2R22/sqrt(G2R22*G2R22 + G2*G2);
+        TAMP1 = t->Prep.TAMP1;      // (THE AMPLITUDES WERE COMPUTED IN T01S_PREPARE())
+        TAMP2 = t->Prep.TAMP2;
+        A_SRC = t->Prep.A_SRC;
+        A_PRC = t->Prep.A_PRC;
+        A_R11 = t->Prep.A_R11;
+        A_R12 = t->Prep.A_R12;
+        A_R21 = t->Prep.A_R21;
+        A_R22 = t->Prep.A_R22;
 
 //        printf("TAMP1, TAMP2, A_SRC, A_PRC, A_R11, A_R12, A_R21, A_R22 = %g %g %g %g %g %g %g %g\n", TAMP1, TAMP2, A_SRC, A_PRC, A_R11, A_R12, A_R21, A_R22 );
 
@@ -62,6 +62,17 @@
  *
  */
 
+/*
+ * T02 model coefficients (used by Tsyg_T02() and Lgm_Prepare_T02())
+ */
+static double T02_A[] = { -9e99, 1.00000,2.47341,0.40791,0.30429,-0.10637,-0.89108,3.29350,
+                        -0.05413,-0.00696,1.07869,-0.02314,-0.66173,-0.68018,-0.03246,
+                         0.02681,0.28062,0.16535,-0.02939,0.02639,-0.24891,-0.08063,
+                         0.08900,-0.02475,0.05887,0.57691,0.65256,-0.03230,2.24733,
+                         4.10546,1.13665,0.05506,0.97669,0.21164,0.64594,1.12556,0.01389,
+                         1.02978,0.02968,0.15821,9.00519,28.17582,1.35285,0.42279};
+
+
 void Lgm_Init_T02( LgmTsyg2001_Info *t ){
 
     int                 i, j;
@@ -78,12 +89,52 @@ void Lgm_Init_T02( LgmTsyg2001_Info *t ){
         }
     }
 
+    // per-epoch state filled in by T01S_PREPARE() or T02_PREPARE()
+    t->Prepared = FALSE;
+
     return;
 
 }
 
 
 
+/**
+ *  \brief
+ *      Compute the point-independent part of the T02 model.
+ *
+ *  \details
+ *      Unpacks PARMOD the same way Tsyg_T02() does and calls T02_PREPARE()
+ *      to fill t->Prep (the overall scaling, the magnetopause parameters, the
+ *      IMF clock angle terms and the amplitudes of the current systems) and
+ *      the parameter common blocks. These depend only on PARMOD and the tilt,
+ *      so they need only be computed once per epoch. T02_EXTALL() re-prepares
+ *      by itself whenever its inputs differ from the ones saved in t->Prep, so
+ *      calling this explicitly is never required.
+ *
+ *      \param[in]       PARMOD  PARMOD[1-6] are Pdyn (nPa), Dst (nT), IMF By and Bz (nT), G1 and G2.
+ *      \param[in]       PS      Dipole tilt angle (radians).
+ *      \param[in]       SINPS   sin(PS).
+ *      \param[in]       COSPS   cos(PS).
+ *      \param[in,out]   t       T01S/T02 info structure.
+ *
+ */
+void Lgm_Prepare_T02( double *PARMOD, double PS, double SINPS, double COSPS, LgmTsyg2001_Info *t ) {
+
+    double  PDYN, DST_AST;
+
+    t->sin_psi = SINPS;
+    t->cos_psi = COSPS;
+
+    PDYN    = PARMOD[1];
+    DST_AST = PARMOD[2]*0.8 - 13.0*sqrt( PDYN );
+
+    T02_PREPARE( T02_A, PDYN, DST_AST, PARMOD[3], PARMOD[4], PARMOD[5], PARMOD[6], PS, t );
+
+    return;
+
+}
+
+
 void Tsyg_T02( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS, double X, double Y, double Z, double *BX, double *BY, double *BZ, LgmTsyg2001_Info *t ) {
 
     double       PDYN, DST_AST, BYIMF=0.0, BZIMF=0.0, G1, G2;
@@ -93,12 +144,6 @@ void Tsyg_T02( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     double       BXR12, BYR12, BZR12, BXR21, BYR21, BZR21, BXR22, BYR22, BZR22, HXIMF;
     double       HYIMF, HZIMF, BBX, BBY, BBZ;
 //    int           IOPGEN=0, IOPTT=0, IOPB=0, IOPR=0;
-    static double A[] = { -9e99, 1.00000,2.47341,0.40791,0.30429,-0.10637,-0.89108,3.29350,
-                          -0.05413,-0.00696,1.07869,-0.02314,-0.66173,-0.68018,-0.03246,
-                           0.02681,0.28062,0.16535,-0.02939,0.02639,-0.24891,-0.08063,
-                           0.08900,-0.02475,0.05887,0.57691,0.65256,-0.03230,2.24733,
-                           4.10546,1.13665,0.05506,0.97669,0.21164,0.64594,1.12556,0.01389,
-                           1.02978,0.02968,0.15821,9.00519,28.17582,1.35285,0.42279};
 
     t->sin_psi = SINPS;
     t->cos_psi = COSPS;
@@ -115,7 +160,7 @@ void Tsyg_T02( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
     YY   = Y;
     ZZ   = Z;
 
-    T02_EXTALL( 0, 0, 0, 0, A, 43, PDYN, DST_AST, BYIMF, BZIMF, G1, G2,
+    T02_EXTALL( 0, 0, 0, 0, T02_A, 43, PDYN, DST_AST, BYIMF, BZIMF, G1, G2,
          PSS, XX, YY, ZZ, &BXCF, &BYCF, &BZCF, &BXT1, &BYT1, &BZT1, &BXT2, &BYT2, &BZT2, 
          &BXSRC, &BYSRC, &BZSRC, &BXPRC, &BYPRC, &BZPRC,  &BXR11, &BYR11, &BZR11, 
          &BXR12, &BYR12, &BZR12, &BXR21, &BYR21, &BZR21, &BXR22, &BYR22, &BZR22, &HXIMF, 
@@ -141,6 +186,108 @@ void Tsyg_T02( int IOPT, double *PARMOD, double PS, double SINPS, double COSPS,
 
 
 
+/*
+ *  Computes everything in T02_EXTALL() that does not depend on the position
+ *  and saves it (along with the inputs it was computed from) in t->Prep and
+ *  in the tail, Birkeland and ring current parameter common blocks.
+ */
+void T02_PREPARE( double *A, double PDYN, double DST, double BYIMF, double BZIMF, double VBIMF1, double VBIMF2,
+                    double PS, LgmTsyg2001_Info *t ) {
+
+    double    THETA, st, a, ZNAM, DLP1, DLP2, XAPPA, FACTIMF;
+    double    A0_A=34.586, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
+
+    t->Prep.A     = A;
+    t->Prep.PDYN  = PDYN;
+    t->Prep.DST   = DST;
+    t->Prep.BYIMF = BYIMF;
+    t->Prep.BZIMF = BZIMF;
+    t->Prep.G1    = VBIMF1;
+    t->Prep.G2    = VBIMF2;
+    t->Prep.G3    = 0.0;
+    t->Prep.PS    = PS;
+
+    XAPPA  = pow( 0.5*PDYN, A[39] );   //  NOW THIS IS A VARIABLE PARAMETER
+    t->CB_RH0.RH0  = A[40]; // TAIL HINGING DISTANCE
+    t->CB_G.G      = A[41]; // TAIL WARPING PARAMETER
+
+    t->Prep.XAPPA  = XAPPA;
+    t->Prep.XAPPA3 = XAPPA*XAPPA*XAPPA;
+    t->Prep.SPS    = sin( PS );
+
+    t->Prep.X0  = A0_X0/XAPPA;
+    t->Prep.AM  = A0_A/XAPPA;
+    t->Prep.ASQ = t->Prep.AM*t->Prep.AM;
+
+
+    /*
+     * CALCULATE THE IMF CLOCK ANGLE:
+     */
+    if ( (BYIMF==0.0)&&(BZIMF==0.0)) {
+        THETA = 0.0;
+    } else {
+        THETA = atan2( BYIMF, BZIMF );
+        if ( THETA <= 0.0 ) THETA += 2.0*M_PI;
+    }
+    st = sin( 0.5*THETA );
+    t->Prep.STHETAH = st*st;
+
+    /*
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER
+     */
+    FACTIMF = A[24] + A[25]*t->Prep.STHETAH;
+    t->Prep.OIMFY = BYIMF*FACTIMF;
+    t->Prep.OIMFZ = BZIMF*FACTIMF;
+
+    /*
+     *  TAIL FIELD PARAMETERS
+     */
+    t->CB_TAIL.DXSHIFT1 = A[26] + A[27]*VBIMF2;
+    t->CB_TAIL.DXSHIFT2 = 0.0;
+    t->CB_TAIL.D        = A[28];
+    t->CB_TAIL.DELTADY  = A[29];
+
+    /*
+     *  BIRKELAND CURRENT PARAMETERS
+     */
+    t->CB_BIRKPAR.XKAPPA1 = A[35] + A[36]*VBIMF2;
+    t->CB_BIRKPAR.XKAPPA2 = A[37] + A[38]*VBIMF2;
+
+    /*
+     *  RING CURRENT PARAMETERS
+     */
+    ZNAM = fabs(DST);
+    t->CB_RCPAR.PHI  = 1.5707963*tanh( ZNAM/A[34] );
+    if ( ZNAM < 20.0 ) ZNAM = 20.0;
+    a     = 20.0/ZNAM;
+    t->CB_RCPAR.SC_SY = A[30]*pow(a, A[31])*XAPPA;
+    t->CB_RCPAR.SC_AS = A[32]*pow(a, A[33])*XAPPA;
+
+    /*
+     *  AMPLITUDES OF THE VARIOUS CURRENT SYSTEMS
+     */
+    a    = 0.5*PDYN;
+    DLP1 = pow( a, A[42] );
+    DLP2 = pow( a, A[43] );
+
+    a     = sqrt(PDYN);
+    t->Prep.TAMP1 = A[2]  + A[3]*DLP1 + A[4]*VBIMF1 + A[5]*DST;
+    t->Prep.TAMP2 = A[6]  + A[7]*DLP2 + A[8]*VBIMF1 + A[9]*DST;
+    t->Prep.A_SRC = A[10] + A[11]*DST + A[12]*a;
+    t->Prep.A_PRC = A[13] + A[14]*DST + A[15]*a;
+    t->Prep.A_R11 = A[16] + A[17]*VBIMF2;
+    t->Prep.A_R12 = A[18] + A[19]*VBIMF2;
+    t->Prep.A_R21 = A[20] + A[21]*VBIMF2;
+    t->Prep.A_R22 = A[22] + A[23]*VBIMF2;
+
+    t->Prepared = TRUE;
+
+    return;
+
+}
+
+
+
 /*
  * 
  *    IOPGEN - GENERAL OPTION FLAG:  IOPGEN=0 - CALCULATE TOTAL FIELD
@@ -173,70 +320,54 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
                     double *BX, double *BY, double *BZ, LgmTsyg2001_Info *t ){
 
     int       done;
-    double    BPERP, THETA, CT, ST, YS, ZS, st, STHETAH, a, aa, b, A_R12, A_R22;
-    double    XAPPA, XAPPA3, SPS, X0, AM, S0, FACTIMF, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
+    double    STHETAH, a, aa, b, A_R12, A_R22;
+    double    XAPPA, XAPPA3, SPS, X0, AM, S0, OIMFX, OIMFY, OIMFZ, R, XSS, ZSS;
     double    XSOLD, ZSOLD, RH, SINPSAS, COSPSAS, DD, RHO2, ASQ;
-    double    XMXM, AXX0, ARO, SIGMA, CFX, CFY, CFZ, ZNAM;
-    double    DLP1, DLP2, TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
+    double    XMXM, AXX0, ARO, SIGMA, CFX, CFY, CFZ;
+    double    TAMP1, TAMP2, A_SRC, A_PRC, A_R11, XX, YY, ZZ;
     double    A_R21, QX, QY, QZ, FINT, FEXT, BBX, BBY, BBZ;
 
 
 
-    double    A0_A=34.586, A0_S0=1.1960, A0_X0=3.4397;     // SHUE ET AL. PARAMETERS
+    double    A0_S0=1.1960;     // SHUE ET AL. PARAMETERS
     double    DSIG=0.003, RH2=-5.2;
 
 
-    XAPPA  = pow( 0.5*PDYN, A[39] );   //  NOW THIS IS A VARIABLE PARAMETER
-    //t->CB_RH0.RH0  = 8.0; // always overwritten...?
-    t->CB_RH0.RH0  = A[40]; // TAIL HINGING DISTANCE
-    t->CB_G.G      = A[41]; // TAIL WARPING PARAMETER
+    /*
+     *  Everything that does not depend on (X,Y,Z) is held in t->Prep. Only
+     *  redo it if the inputs have changed since the last call.
+     */
+    if ( !t->Prepared || ( A != t->Prep.A ) || ( PS != t->Prep.PS ) || ( PDYN != t->Prep.PDYN ) || ( DST != t->Prep.DST )
+            || ( BYIMF != t->Prep.BYIMF ) || ( BZIMF != t->Prep.BZIMF )
+            || ( VBIMF1 != t->Prep.G1 ) || ( VBIMF2 != t->Prep.G2 ) ) {
+        T02_PREPARE( A, PDYN, DST, BYIMF, BZIMF, VBIMF1, VBIMF2, PS, t );
+    }
 
-    XAPPA3 = XAPPA*XAPPA*XAPPA;
+    XAPPA  = t->Prep.XAPPA;
+    XAPPA3 = t->Prep.XAPPA3;
 
     XX = X*XAPPA;
     YY = Y*XAPPA;
     ZZ = Z*XAPPA;
 
-    SPS = sin( PS );
-
-    X0 = A0_X0/XAPPA;
-    AM = A0_A/XAPPA;
-    S0 = A0_S0;
-
-    BPERP = sqrt( BYIMF*BYIMF + BZIMF*BZIMF );
-
-
-    /*
-     * CALCULATE THE IMF CLOCK ANGLE:
-     */
-    if ( (BYIMF==0.0)&&(BZIMF==0.0)) {
-        THETA = 0.0;
-    } else {
-        THETA = atan2( BYIMF, BZIMF );
-        if ( THETA <= 0.0 ) THETA += 2.0*M_PI;
-    }
-
+    SPS = t->Prep.SPS;
 
-    CT = cos(THETA);
-    ST = sin(THETA);
-    YS = Y*CT - Z*ST;
-    ZS = Z*CT + Y*ST;
+    X0  = t->Prep.X0;
+    AM  = t->Prep.AM;
+    ASQ = t->Prep.ASQ;
+    S0  = A0_S0;
 
-    st = sin( 0.5*THETA );
-    STHETAH = st*st;
+    STHETAH = t->Prep.STHETAH;
 
     /*
-     *  CALCULATE "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
+     *  "IMF" COMPONENTS OUTSIDE THE MAGNETOPAUSE LAYER (HENCE BEGIN WITH "O")
      *  THEY ARE NEEDED ONLY IF THE POINT (X,Y,Z) IS WITHIN THE TRANSITION MAGNETOPAUSE LAYER
      *  OR OUTSIDE THE MAGNETOSPHERE:
      *
      */
-
-    FACTIMF = A[24] + A[25]*STHETAH;
-
     OIMFX = 0.0;
-    OIMFY = BYIMF*FACTIMF;
-    OIMFZ = BZIMF*FACTIMF;
+    OIMFY = t->Prep.OIMFY;
+    OIMFZ = t->Prep.OIMFZ;
 
     R   = sqrt( X*X + Y*Y + Z*Z );
     XSS = X;
@@ -263,7 +394,6 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
 
 
     RHO2 = Y*Y + ZSS*ZSS;
-    ASQ  = AM*AM;
     XMXM = AM + XSS - X0;
     if ( XMXM < 0.0 ) XMXM = 0.0; // THE BOUNDARY IS A CYLINDER TAILWARD OF X=X0-AM
     AXX0  = XMXM*XMXM;
@@ -298,10 +428,6 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 2) ) {
-            t->CB_TAIL.DXSHIFT1 = A[26] + A[27]*VBIMF2;
-            t->CB_TAIL.DXSHIFT2 = 0.0;
-            t->CB_TAIL.D        = A[28];
-            t->CB_TAIL.DELTADY  = A[29];
             T02_DEFORMED( IOPT, PS, XX, YY, ZZ, BXT1, BYT1, BZT1, BXT2, BYT2, BZT2, t ); //  TAIL FIELD (THREE MODES)
         } else {
             *BXT1 = 0.0;
@@ -313,8 +439,6 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 3) ) {
-            t->CB_BIRKPAR.XKAPPA1 = A[35] + A[36]*VBIMF2;
-            t->CB_BIRKPAR.XKAPPA2 = A[37] + A[38]*VBIMF2;
             T02_BIRK_TOT( IOPB, PS, XX, YY, ZZ, BXR11, BYR11, BZR11, BXR12, BYR12, 
                                   BZR12, BXR21, BYR21, BZR21, BXR22, BYR22, BZR22, t  );    //   BIRKELAND FIELD (TWO MODES FOR R1 AND TWO MODES FOR R2)
         } else {
@@ -333,12 +457,6 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
         }
 
         if ( (IOPGEN == 0) || (IOPGEN == 4) ) {
-            ZNAM = fabs(DST);
-            t->CB_RCPAR.PHI  = 1.5707963*tanh( ZNAM/A[34] );
-            if ( ZNAM < 20.0 ) ZNAM = 20.0;
-            a     = 20.0/ZNAM;
-            t->CB_RCPAR.SC_SY = A[30]*pow(a, A[31])*XAPPA;
-            t->CB_RCPAR.SC_AS = A[32]*pow(a, A[33])*XAPPA;
             T02_FULL_RC(IOPR, PS, XX, YY, ZZ, BXSRC, BYSRC, BZSRC, BXPRC, BYPRC, BZPRC, t );  //  SHIELDED RING CURRENT (SRC AND PRC)
         } else {
             *BXSRC = 0.0;
@@ -373,19 +491,14 @@ void T02_EXTALL( int IOPGEN, int IOPT, int IOPB, int IOPR, double *A, int NTOT,
          *
          */
 
-        a    = 0.5*PDYN;
-        DLP1 = pow( a, A[42] );
-        DLP2 = pow( a, A[43] );
-
-        a     = sqrt(PDYN);
-        TAMP1 = A[2]  + A[3]*DLP1 + A[4]*VBIMF1 + A[5]*DST;
-        TAMP2 = A[6]  + A[7]*DLP2 + A[8]*VBIMF1 + A[9]*DST;
-        A_SRC = A[10] + A[11]*DST + A[12]*a;
-        A_PRC = A[13] + A[14]*DST + A[15]*a;
-        A_R11 = A[16] + A[17]*VBIMF2;
-        A_R12 = A[18] + A[19]*VBIMF2;
-        A_R21 = A[20] + A[21]*VBIMF2;
-        A_R22 = A[22] + A[23]*VBIMF2;
+        TAMP1 = t->Prep.TAMP1;      // (THE AMPLITUDES WERE COMPUTED IN T02_PREPARE())
+        TAMP2 = t->Prep.TAMP2;
+        A_SRC = t->Prep.A_SRC;
+        A_PRC = t->Prep.A_PRC;
+        A_R11 = t->Prep.A_R11;
+        A_R12 = t->Prep.A_R12;
+        A_R21 = t->Prep.A_R21;
+        A_R22 = t->Prep.A_R22;
 
         BBX = A[1]* *BXCF + TAMP1* *BXT1 + TAMP2* *BXT2 + A_SRC* *BXSRC + A_PRC* *BXPRC
                  + A_R11* *BXR11 + A_R12* *BXR12 + A_R21* *BXR21 + A_R22* *BXR22
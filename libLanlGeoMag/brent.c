@@ -71,10 +71,12 @@ int Lgm_BrentP(double Sa, double Sb, double Sc, double Bb, Lgm_Vector Pa, Lgm_Ve
          */
         du = ( fabs(d) >= tol1 ) ? d : SIGN( tol1, d );
         u  = x + du;
-        // x to u. (From point Px to Pu.)
+        // x to u. (From point Px to Pu.) Use the dense output from Pa if we can.
         P    = Px;
         Htry = du;
-        if ( Htry > 1e-16 ) {
+        if ( Lgm_MagStep_DenseEval( &Pa, u-Sa, f->sgn, &P, f->Info ) ) {
+            // got it without stepping
+        } else if ( Htry > 1e-16 ) {
             Lgm_MagStep( &P, &f->u_scale, Htry, &Hdid, &Hnext, f->sgn, &s, &f->reset, f->Info->Bfield, f->Info );
         }
         f->Info->Bfield( &P, &Btmp, f->Info );
@@ -226,22 +228,35 @@ int Lgm_zBrentP(double S1, double S2, double F1, double F2, Lgm_Vector P1, Lgm_V
 
 
         /*
-         * We want to make sure that we actually do a step of Htry, so keep trying until we get there.
+         * If the steps that found the bracket are still in the dense output
+         * history, we can get Pb from there (measured from P1) without
+         * stepping.
          */
+        if ( Lgm_MagStep_DenseEval( &P1, b-S1, sgn, &P, f->Info ) ) {
+
+            Pb = P;
+
+        } else {
+
+            /*
+             * We want to make sure that we actually do a step of Htry, so keep trying until we get there.
+             */
 //printf("\n\n\n########################\nIn brent: Htry = %g\n", Htry);
-        htry = Htry, Hdid = 0.0; Count = 0;
-        while ( (fabs(htry) >= 0.5*tol1 ) && (fabs(xm) >= tol1) && (Count<100) ) {
-            if ( Lgm_MagStep( &Pb, &f->u_scale, htry, &hdid, &Hnext, sgn, &s, &f->reset, f->Info->Bfield, f->Info ) < 0 ) { printf("BAILING 4\n");return(-1); }
+            htry = Htry, Hdid = 0.0; Count = 0;
+            while ( (fabs(htry) >= 0.5*tol1 ) && (fabs(xm) >= tol1) && (Count<100) ) {
+                if ( Lgm_MagStep( &Pb, &f->u_scale, htry, &hdid, &Hnext, sgn, &s, &f->reset, f->Info->Bfield, f->Info ) < 0 ) { printf("BAILING 4\n");return(-1); }
 //printf("In brent: Count=%d htry, hdid = %g %g  Htry, Hdid = %g %g    fabs(Hdid-Htry) = %g\n", Count, htry, hdid, Htry, Hdid, fabs(Hdid-Htry) );
-            Hdid += hdid;
-            htry = Htry - Hdid;
+                Hdid += hdid;
+                htry = Htry - Hdid;
 //printf("In brent: Count=%d htry, hdid = %g %g  Htry, Hdid = %g %g    fabs(Hdid-Htry) = %g\n\n", Count, htry, hdid, Htry, Hdid, fabs(Hdid-Htry) );
-            ++Count;
-        }
+                ++Count;
+            }
 
 
 if (Htry != Hdid) printf("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA  Htry = %g  Hdid = %g  AAAAAAAa\n", Htry, Hdid );
 //printf("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA  Htry = %g  Hdid = %g  AAAAAAAa\n", Htry, Hdid );
+
+        }
         fb = f->func( &Pb, f->Val, f->Info );
         //printf("fa, fb, fc = %g %g %g\n", fa, fb, fc);
 
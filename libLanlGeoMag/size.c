@@ -21,6 +21,7 @@
 #include "Lgm/Lgm_MagModelInfo.h"
 #include "Lgm/Lgm_CTrans.h"
 #include "Lgm/Lgm_Octree.h"
+#include "Lgm/Lgm_PriorityQueue.h"
 
 
 #include <gsl/gsl_spline.h>
@@ -73,7 +74,7 @@ int size_Lgm_OctreeCell(void) {
 }
 
 int size_pQueue(void) {
-    return sizeof(pQueue);
+    return sizeof(Lgm_pQueue_Node);     // the kNN search queue entry
 }
 
 int size_Lgm_LeapSeconds(void) {
@@ -0,0 +1,522 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libLanlGeoMag/Lgm/Lgm_CTrans.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Eop.h"
+#include "../libLanlGeoMag/Lgm/Lgm_DynamicMemory.h"
+
+/*
+ *  Microbenchmarks of the coordinate transformations.
+ *
+ *  Lgm_Set_Coord_Transforms() is timed for each of a list of option sets
+ *  (ephemeris model, nutation model, nutation terms, Sun/Moon cache, slow
+ *  tier cadence, EOP, and the Lgm_Set_CTrans_Tier() presets) stepping
+ *  forward through a fixed time series, the way an ephemeris pipeline calls
+ *  it. Each option set is also compared against LGM_CTRANS_TIER_FULL over a
+ *  two day span: every conversion flag is applied to the three axes at GEO
+ *  distance, and the worst angular difference (arcsec) and position
+ *  difference at GEO (km) are reported. For the DE421 set this is the
+ *  difference between the two ephemerides, and for the EOP set the size of
+ *  the EOP correction, rather than an error.
+ *
+ *  Lgm_Convert_Coords() is timed for every conversion flag (every pair of the
+ *  systems it knows about), one vector at a time and through
+ *  Lgm_Convert_Coords_Array(), over a fixed-seed set of points.
+ *
+ *  Timing is done the same way as in bench_MagModels: a warm-up pass, then
+ *  passes repeated until at least MinTime seconds have gone by, nTrials
+ *  times, keeping the fastest trial. Results go to stdout (or the -o file)
+ *  as JSON, and tables go to stderr.
+ *
+ *      bench_CTrans [-n nPoints] [-s nTimes] [-d Step] [-t MinTime] [-r nTrials] [-c OptionSet] [-f Flag] [-o File]
+ *
+ *  The DE option set is skipped if the DE421 file cannot be found (see
+ *  BenchHaveDE()), and the EOP set if there is no EOP data.
+ */
+
+#define BENCH_DATE      20150317
+#define BENCH_UTC       9.0
+#define BENCH_SEED      20150317UL
+
+#define BENCH_ACC_SPAN  2.0         // days covered by the accuracy comparison
+#define BENCH_ACC_STEP  127.0       // seconds between the accuracy comparison times
+#define BENCH_GEO       6.6107      // GEO distance in Re
+
+#define BENCH_CONVERT   0
+#define BENCH_ARRAY     1
+
+typedef struct BenchOptions {
+    const char  *Name;
+    int         Tier;               // >= 0 means use Lgm_Set_CTrans_Tier() (after the ephemeris model is set)
+    int         ephModel;
+    int         pnModel;
+    int         nNutationTerms;
+    int         EphemCache;
+    double      Cadence;
+    int         Eop;
+} BenchOptions;
+
+static const BenchOptions OptionSets[] = {
+    { "Default",        -1,                      LGM_EPH_LOW_ACCURACY,  LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+    { "HighAccuracy",   -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+    { "DE421",          -1,                      LGM_EPH_DE,            LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+    { "PN_Cached",      -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76_CACHED, 106, FALSE,     0.0, FALSE },
+    { "Nutation_30",    -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,         30, FALSE,     0.0, FALSE },
+    { "EphemCache",     -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, TRUE,      0.0, FALSE },
+    { "Cadence_600",    -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,   600.0, FALSE },
+    { "Cadence_3600",   -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,  3600.0, FALSE },
+    { "Cadence_21600",  -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE, 21600.0, FALSE },
+    { "Eop",            -1,                      LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,     0.0, TRUE  },
+    { "Tier_FULL",      LGM_CTRANS_TIER_FULL,    LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+    { "Tier_FAST",      LGM_CTRANS_TIER_FAST,    LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+    { "Tier_FASTEST",   LGM_CTRANS_TIER_FASTEST, LGM_EPH_HIGH_ACCURACY, LGM_PN_IAU76,        106, FALSE,     0.0, FALSE },
+};
+#define N_OPTION_SETS   ( (int)(sizeof(OptionSets)/sizeof(OptionSets[0])) )
+
+/*
+ *  The systems Lgm_Convert_Coords() knows about, by their *_COORDS number.
+ *  Every pair of different systems is a conversion flag (In*100 + Out).
+ */
+static const char *SystemNames[] = { NULL, "GEI2000", "MOD", "TOD", "TEME", "PEF", "GEO", "GSE", "GSM", "SM", "EDMAG", "CDMAG", "GSE2000" };
+#define N_SYSTEMS   12
+
+
+/*
+ *  A small 64-bit LCG (Knuth's MMIX constants); we only need it to be
+ *  the same everywhere.
+ */
+static unsigned long long BenchState;
+
+static void BenchSeed( unsigned long int Seed ) {
+    BenchState = (unsigned long long)Seed;
+}
+
+static double BenchUniform( void ) {
+    BenchState = BenchState*6364136223846793005ULL + 1442695040888963407ULL;
+    return( (double)(BenchState >> 11)*(1.0/9007199254740992.0) );
+}
+
+/*
+ *  Points spread uniformly in volume over 1 Re < r < 10 Re.
+ */
+static void BenchPoints( unsigned long int Seed, long int n, Lgm_Vector *u ) {
+
+    long int    i;
+    double      r, Phi, SinLat, CosLat, r0 = 1.0, r1 = 10.0;
+
+    BenchSeed( Seed );
+    for ( i=0; i<n; i++ ) {
+        r      = cbrt( r0*r0*r0 + (r1*r1*r1 - r0*r0*r0)*BenchUniform() );
+        Phi    = 2.0*M_PI*BenchUniform();
+        SinLat = 2.0*BenchUniform() - 1.0;
+        CosLat = sqrt( 1.0 - SinLat*SinLat );
+        u[i].x = r*CosLat*cos( Phi );
+        u[i].y = r*CosLat*sin( Phi );
+        u[i].z = r*SinLat;
+    }
+
+}
+
+static double BenchNow( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec );
+}
+
+static void BenchFlagName( int Flag, char *Name ) {
+    sprintf( Name, "%s_TO_%s", SystemNames[Flag/100], SystemNames[Flag%100] );
+}
+
+
+/*
+ *  Times spaced Step seconds apart, starting at JD0 (UTC).
+ */
+typedef struct BenchTimes {
+    long int    n;
+    long int    *Date;
+    double      *UTC;
+    double      *JD;
+} BenchTimes;
+
+static void BenchTimes_Init( BenchTimes *t, double JD0, long int n, double Step ) {
+
+    long int    i;
+    int         Year, Month, Day;
+
+    t->n = n;
+    LGM_ARRAY_1D( t->Date, n, long int );
+    LGM_ARRAY_1D( t->UTC,  n, double );
+    LGM_ARRAY_1D( t->JD,   n, double );
+    for ( i=0; i<n; i++ ) {
+        t->JD[i] = JD0 + (double)i*Step/86400.0;
+        Lgm_jd_to_ymdh( t->JD[i], &t->Date[i], &Year, &Month, &Day, &t->UTC[i] );
+    }
+
+}
+
+static void BenchTimes_Free( BenchTimes *t ) {
+    LGM_ARRAY_1D_FREE( t->Date );
+    LGM_ARRAY_1D_FREE( t->UTC );
+    LGM_ARRAY_1D_FREE( t->JD );
+}
+
+
+/*
+ *  The DE421 ephemeris is looked for where Lgm_ReadJPLephem() looks for it,
+ *  which exits if it isn't there.
+ */
+static int BenchHaveDE( void ) {
+
+    char        Filename[2048];
+    const char  *Path = getenv( "JPL_EPHEM_PATH" );
+
+    if ( ( Path == NULL ) || ( access( Path, F_OK ) != 0 ) ) {
+        snprintf( Filename, 2048, "%s/DE_FILES/jpl_de421.h5", LGM_INDEX_DATA_DIR );
+    } else {
+        snprintf( Filename, 2048, "%s/jpl_de421.h5", Path );
+    }
+
+    return( access( Filename, R_OK ) == 0 );
+
+}
+
+static Lgm_CTrans *BenchInitCTrans( const BenchOptions *o ) {
+
+    Lgm_CTrans  *c = Lgm_init_ctrans( 0 );
+
+    Lgm_Set_CTrans_Options( o->ephModel, o->pnModel, c );
+    if ( o->Tier >= 0 ) {
+        Lgm_Set_CTrans_Tier( o->Tier, c );
+    } else {
+        c->nNutationTerms = o->nNutationTerms;
+        Lgm_Set_CTrans_EphemCache( o->EphemCache, c );
+        Lgm_Set_CTrans_SlowTierCadence( o->Cadence, c );
+    }
+
+    return( c );
+
+}
+
+/*
+ *  One Lgm_Set_Coord_Transforms() call, with the EOP looked up and set first
+ *  if the option set wants it.
+ */
+static void BenchSet( const BenchOptions *o, long int Date, double UTC, double JD, Lgm_Eop *e, Lgm_CTrans *c ) {
+
+    Lgm_EopOne  eop;
+
+    if ( o->Eop ) {
+        Lgm_get_eop_at_JD( JD, &eop, e );
+        Lgm_set_eop( &eop, c );
+    }
+    Lgm_Set_Coord_Transforms( Date, UTC, c );
+
+}
+
+
+typedef struct BenchResult {
+    long int    nCalls;
+    double      Seconds;
+    double      nsPerCall;
+    double      Checksum;
+} BenchResult;
+
+static double BenchSetPass( const BenchOptions *o, BenchTimes *t, Lgm_Eop *e, Lgm_CTrans *c ) {
+
+    long int    i;
+    double      Sum = 0.0;
+
+    for ( i=0; i<t->n; i++ ) {
+        BenchSet( o, t->Date[i], t->UTC[i], t->JD[i], e, c );
+        Sum += c->psi + c->Agei_to_wgs84[0][0];
+    }
+
+    return( Sum );
+
+}
+
+static void BenchSetCase( const BenchOptions *o, BenchTimes *t, Lgm_Eop *e, double MinTime, int nTrials, Lgm_CTrans *c, BenchResult *r ) {
+
+    int         k;
+    long int    nPasses;
+    double      t0, dt, ns;
+
+    r->Checksum  = BenchSetPass( o, t, e, c );     // warm-up
+    r->nsPerCall = 9e99;
+    for ( k=0; k<nTrials; k++ ) {
+        nPasses = 0;
+        t0 = BenchNow();
+        do {
+            BenchSetPass( o, t, e, c );
+            ++nPasses;
+            dt = BenchNow() - t0;
+        } while ( dt < MinTime );
+        ns = 1e9*dt/(double)(nPasses*t->n);
+        if ( ns < r->nsPerCall ) {
+            r->nsPerCall = ns;
+            r->nCalls    = nPasses*t->n;
+            r->Seconds   = dt;
+        }
+    }
+
+}
+
+
+/*
+ *  Worst difference between c and the reference over every conversion flag,
+ *  applied to the three axes at GEO distance: the angle between the rotated
+ *  directions (arcsec) and the distance between the converted points (km).
+ */
+typedef struct BenchAccuracy {
+    double      MaxArcsec;
+    double      MaxKm;
+    int         WorstFlag;
+} BenchAccuracy;
+
+static void BenchCompare( Lgm_CTrans *c, Lgm_CTrans *cRef, BenchAccuracy *a ) {
+
+    int         i, j, k, Flag;
+    double      Angle, d;
+    Lgm_Vector  u, v, vRef, w, wRef, o, oRef, zero = { 0.0, 0.0, 0.0 }, x;
+
+    for ( i=1; i<=N_SYSTEMS; i++ ) {
+        for ( j=1; j<=N_SYSTEMS; j++ ) {
+            if ( i == j ) continue;
+            Flag = 100*i + j;
+            Lgm_Convert_Coords( &zero, &o,    Flag, c );
+            Lgm_Convert_Coords( &zero, &oRef, Flag, cRef );
+            for ( k=0; k<3; k++ ) {
+                u.x = ( k == 0 ) ? BENCH_GEO : 0.0;
+                u.y = ( k == 1 ) ? BENCH_GEO : 0.0;
+                u.z = ( k == 2 ) ? BENCH_GEO : 0.0;
+                Lgm_Convert_Coords( &u, &v,    Flag, c );
+                Lgm_Convert_Coords( &u, &vRef, Flag, cRef );
+                Lgm_VecSub( &w, &v, &o );
+                Lgm_VecSub( &wRef, &vRef, &oRef );
+                Lgm_CrossProduct( &w, &wRef, &x );
+                Angle = atan2( Lgm_Magnitude( &x ), Lgm_DotProduct( &w, &wRef ) )*DegPerRad*3600.0;
+                d     = Lgm_VecDiffMag( &v, &vRef )*Re;
+                if ( Angle > a->MaxArcsec ) { a->MaxArcsec = Angle; a->WorstFlag = Flag; }
+                if ( d > a->MaxKm ) a->MaxKm = d;
+            }
+        }
+    }
+
+}
+
+static void BenchAccuracyCase( const BenchOptions *o, BenchTimes *t, Lgm_Eop *e, BenchAccuracy *a ) {
+
+    long int        i;
+    Lgm_CTrans      *c, *cRef;
+    BenchOptions    Ref = OptionSets[0];
+
+    Ref.Tier     = LGM_CTRANS_TIER_FULL;
+    Ref.ephModel = LGM_EPH_HIGH_ACCURACY;
+    c    = BenchInitCTrans( o );
+    cRef = BenchInitCTrans( &Ref );
+
+    a->MaxArcsec = a->MaxKm = 0.0;
+    a->WorstFlag = 0;
+    for ( i=0; i<t->n; i++ ) {
+        BenchSet( o, t->Date[i], t->UTC[i], t->JD[i], e, c );
+        BenchSet( &Ref, t->Date[i], t->UTC[i], t->JD[i], e, cRef );
+        BenchCompare( c, cRef, a );
+    }
+
+    Lgm_free_ctrans( c );
+    Lgm_free_ctrans( cRef );
+
+}
+
+
+static double BenchConvertPass( int Path, int Flag, long int n, Lgm_Vector *u, Lgm_Vector *v, Lgm_CTrans *c ) {
+
+    long int    i;
+    double      Sum = 0.0;
+
+    if ( Path == BENCH_ARRAY ) {
+        Lgm_Convert_Coords_Array( n, u, v, Flag, c );
+    } else {
+        for ( i=0; i<n; i++ ) Lgm_Convert_Coords( &u[i], &v[i], Flag, c );
+    }
+    for ( i=0; i<n; i++ ) Sum += v[i].x + v[i].y + v[i].z;
+
+    return( Sum );
+
+}
+
+static void BenchConvertCase( int Path, int Flag, long int n, Lgm_Vector *u, Lgm_Vector *v, double MinTime, int nTrials, Lgm_CTrans *c, BenchResult *r ) {
+
+    int         k;
+    long int    nPasses;
+    double      t0, dt, ns;
+
+    r->Checksum  = BenchConvertPass( Path, Flag, n, u, v, c );     // warm-up
+    r->nsPerCall = 9e99;
+    for ( k=0; k<nTrials; k++ ) {
+        nPasses = 0;
+        t0 = BenchNow();
+        do {
+            BenchConvertPass( Path, Flag, n, u, v, c );
+            ++nPasses;
+            dt = BenchNow() - t0;
+        } while ( dt < MinTime );
+        ns = 1e9*dt/(double)(nPasses*n);
+        if ( ns < r->nsPerCall ) {
+            r->nsPerCall = ns;
+            r->nCalls    = nPasses*n;
+            r->Seconds   = dt;
+        }
+    }
+
+}
+
+
+int main( int argc, char *argv[] ) {
+
+    int                 ch, i, j, s, Path, Flag, First, HaveDE, HaveEop;
+    long int            n = 2000, nTimes = 1000;
+    double              MinTime = 0.1, Step = 10.0, JD0;
+    int                 nTrials = 3;
+    char                *OnlySet = NULL, *OnlyFlag = NULL, *OutFile = NULL, FlagName[32];
+    const char          *PathNames[] = { "Convert", "Array" };
+    FILE                *fp = stdout;
+    BenchResult         r;
+    BenchAccuracy       a;
+    BenchTimes          Times, AccTimes;
+    Lgm_Vector          *u, *v;
+    Lgm_CTrans          *c;
+    Lgm_Eop             *e;
+
+    while ( (ch = getopt( argc, argv, "n:s:d:t:r:c:f:o:h" )) != -1 ) {
+        switch ( ch ) {
+            case 'n': n        = atol( optarg ); break;
+            case 's': nTimes   = atol( optarg ); break;
+            case 'd': Step     = atof( optarg ); break;
+            case 't': MinTime  = atof( optarg ); break;
+            case 'r': nTrials  = atoi( optarg ); break;
+            case 'c': OnlySet  = optarg; break;
+            case 'f': OnlyFlag = optarg; break;
+            case 'o': OutFile  = optarg; break;
+            default:
+                fprintf( stderr, "Usage: %s [-n nPoints] [-s nTimes] [-d Step] [-t MinTime] [-r nTrials] [-c OptionSet] [-f Flag] [-o File]\n", argv[0] );
+                return( ( ch == 'h' ) ? 0 : 1 );
+        }
+    }
+    if ( n < 1 ) n = 1;
+    if ( nTimes < 1 ) nTimes = 1;
+    if ( nTrials < 1 ) nTrials = 1;
+
+    if ( OutFile && ((fp = fopen( OutFile, "w" )) == NULL) ) {
+        fprintf( stderr, "bench_CTrans: Could not open %s for writing.\n", OutFile );
+        return( 1 );
+    }
+
+    c   = Lgm_init_ctrans( 0 );
+    JD0 = Lgm_Date_to_JD( BENCH_DATE, BENCH_UTC, c );
+    BenchTimes_Init( &Times, JD0, nTimes, Step );
+    BenchTimes_Init( &AccTimes, JD0, (long int)(BENCH_ACC_SPAN*86400.0/BENCH_ACC_STEP), BENCH_ACC_STEP );
+    Lgm_free_ctrans( c );
+
+    e = Lgm_init_eop( 0 );
+    Lgm_read_eop( e );
+    HaveEop = ( e->nEopVals > 0 );
+    HaveDE  = BenchHaveDE();
+
+    fprintf( fp, "{\n" );
+    fprintf( fp, "  \"Benchmark\": \"bench_CTrans\",\n" );
+#ifdef PACKAGE_VERSION
+    fprintf( fp, "  \"Version\": \"%s\",\n", PACKAGE_VERSION );
+#endif
+    fprintf( fp, "  \"Date\": %d, \"UTC\": %g, \"Seed\": %lu,\n", BENCH_DATE, BENCH_UTC, BENCH_SEED );
+    fprintf( fp, "  \"nPoints\": %ld, \"nTimes\": %ld, \"Step\": %g, \"MinTime\": %g, \"nTrials\": %d,\n", n, nTimes, Step, MinTime, nTrials );
+    fprintf( fp, "  \"AccuracySpan\": %g, \"AccuracyStep\": %g, \"AccuracyRadius\": %g,\n", BENCH_ACC_SPAN, BENCH_ACC_STEP, BENCH_GEO );
+
+
+    /*
+     *  Lgm_Set_Coord_Transforms() for each option set.
+     */
+    fprintf( fp, "  \"SetCoordTransforms\": [" );
+    fprintf( stderr, "%-14s %12s %14s %12s %12s  %-16s\n", "Options", "ns/call", "calls/s", "arcsec", "km at GEO", "worst flag" );
+    First = TRUE;
+    for ( s=0; s<N_OPTION_SETS; s++ ) {
+
+        const BenchOptions *o = &OptionSets[s];
+
+        if ( OnlySet && strcmp( OnlySet, o->Name ) ) continue;
+
+        fprintf( fp, "%s\n    { \"Options\": \"%s\", ", First ? "" : ",", o->Name );
+        First = FALSE;
+
+        if ( ( ( o->ephModel == LGM_EPH_DE ) && !HaveDE ) || ( o->Eop && !HaveEop ) ) {
+            fprintf( fp, "\"Skipped\": \"no %s data\" }", o->Eop ? "EOP" : "DE421" );
+            fprintf( stderr, "%-14s %12s\n", o->Name, "skipped" );
+            continue;
+        }
+
+        c = BenchInitCTrans( o );
+        BenchSetCase( o, &Times, e, MinTime, nTrials, c, &r );
+        Lgm_free_ctrans( c );
+        BenchAccuracyCase( o, &AccTimes, e, &a );
+
+        BenchFlagName( a.WorstFlag ? a.WorstFlag : 106, FlagName );
+        fprintf( fp, "\"nCalls\": %ld, \"Seconds\": %.6f, \"nsPerCall\": %.3f, \"CallsPerSec\": %.6e, \"Checksum\": %.15e, ",
+                    r.nCalls, r.Seconds, r.nsPerCall, 1e9/r.nsPerCall, r.Checksum );
+        fprintf( fp, "\"MaxArcsec\": %.6e, \"MaxKmAtGEO\": %.6e, \"WorstFlag\": \"%s\" }", a.MaxArcsec, a.MaxKm, a.WorstFlag ? FlagName : "" );
+        fprintf( stderr, "%-14s %12.1f %14.4e %12.3e %12.3e  %-16s\n", o->Name, r.nsPerCall, 1e9/r.nsPerCall, a.MaxArcsec, a.MaxKm, a.WorstFlag ? FlagName : "" );
+        fflush( fp );
+
+    }
+    fprintf( fp, "\n  ],\n" );
+
+
+    /*
+     *  Lgm_Convert_Coords() for every flag.
+     */
+    LGM_ARRAY_1D( u, n, Lgm_Vector );
+    LGM_ARRAY_1D( v, n, Lgm_Vector );
+    BenchPoints( BENCH_SEED, n, u );
+    c = BenchInitCTrans( &OptionSets[1] );
+    Lgm_Set_Coord_Transforms( BENCH_DATE, BENCH_UTC, c );
+
+    fprintf( fp, "  \"ConvertCoords\": [" );
+    fprintf( stderr, "\n%-18s %-7s %12s %14s %14s\n", "Flag", "Path", "ns/vector", "vectors/s", "Checksum" );
+    First = TRUE;
+    for ( i=1; i<=N_SYSTEMS; i++ ) {
+        for ( j=1; j<=N_SYSTEMS; j++ ) {
+
+            if ( i == j ) continue;
+            Flag = 100*i + j;
+            BenchFlagName( Flag, FlagName );
+            if ( OnlyFlag && strcmp( OnlyFlag, FlagName ) ) continue;
+
+            for ( Path=BENCH_CONVERT; Path<=BENCH_ARRAY; Path++ ) {
+                BenchConvertCase( Path, Flag, n, u, v, MinTime, nTrials, c, &r );
+                fprintf( fp, "%s\n    { \"Flag\": \"%s\", \"Path\": \"%s\", \"nVectors\": %ld, \"Seconds\": %.6f, \"nsPerVector\": %.3f, \"VectorsPerSec\": %.6e, \"Checksum\": %.15e }",
+                            First ? "" : ",", FlagName, PathNames[Path], r.nCalls, r.Seconds, r.nsPerCall, 1e9/r.nsPerCall, r.Checksum );
+                First = FALSE;
+                fprintf( stderr, "%-18s %-7s %12.1f %14.4e %14.8e\n", FlagName, PathNames[Path], r.nsPerCall, 1e9/r.nsPerCall, r.Checksum );
+                fflush( fp );
+            }
+
+        }
+    }
+    fprintf( fp, "\n  ]\n}\n" );
+    if ( fp != stdout ) fclose( fp );
+
+    Lgm_free_ctrans( c );
+    Lgm_destroy_eop( e );
+    BenchTimes_Free( &Times );
+    BenchTimes_Free( &AccTimes );
+    LGM_ARRAY_1D_FREE( u );
+    LGM_ARRAY_1D_FREE( v );
+
+    return( 0 );
+
+}
@@ -0,0 +1,328 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+#include "../libLanlGeoMag/Lgm/Lgm_LstarInfo.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Profile.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *  L* accuracy versus cost for the Lgm_SetLstarTolerances() settings.
+ *
+ *  L* is computed with Lstar() for a fixed set of cases (quiet and storm
+ *  conditions in several models, a few positions, a few pitch angles) at
+ *  every (Quality, nFLsInDriftShell) setting asked for. For each setting
+ *  we record the wall time, the number of field evaluations, how many traces,
+ *  shell line searches and I integrals were done (from the profiler, see
+ *  Lgm_Profile.c),
+ *  and how far the L* values are from the reference, which is Quality 8 with
+ *  the largest nFLsInDriftShell. The summary table marks the settings that
+ *  are Pareto optimal, i.e. for which no other setting is both faster and
+ *  has a smaller maximum error.
+ *
+ *  The JSON (to stdout or the -o file) has the summary and every case (with
+ *  its L* for each setting, in the order of the summary); the table goes to
+ *  stderr.
+ *
+ *      bench_LstarQuality [-q Q1,Q2,..] [-s n1,n2,..] [-m Model] [-o File]
+ *
+ *  The defaults are Quality 0-8 and nFLsInDriftShell 12, 24 and 48. Every
+ *  case starts from a fresh Lgm_LstarInfo with its integrator state reset, so
+ *  the cost of one case does not depend on the ones run before it. Wall
+ *  times depend on the number of threads (OMP_NUM_THREADS) that the shell
+ *  lines are shared over; the counts dont.
+ *
+ *  The field evaluations come from the Stats counters, so they are only
+ *  there (and are otherwise -1) if the library was configured with
+ *  --enable-instrumentation. (Lgm_nMagEvals cant be used for this; the
+ *  integrators start it again from 0 for every trace.)
+ */
+
+#define BENCH_DATE      20050831
+#define BENCH_UTC       9.0
+
+typedef struct BenchCondition {
+    const char  *Name;
+    int         External;
+    double      Kp, P, Dst, By, Bz, W[6];
+} BenchCondition;
+
+static const BenchCondition Conditions[] = {
+    { "T89-quiet",  LGM_EXTMODEL_T89,  1.0, 0.0,    0.0, 0.0,   0.0, { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { "T89-storm",  LGM_EXTMODEL_T89,  5.0, 0.0,    0.0, 0.0,   0.0, { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { "T96-quiet",  LGM_EXTMODEL_T96,  0.0, 1.5,   -5.0, 0.5,   1.0, { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { "T96-storm",  LGM_EXTMODEL_T96,  0.0, 6.0, -120.0, 3.0, -12.0, { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 } },
+    { "TS04-storm", LGM_EXTMODEL_TS04, 0.0, 6.0, -120.0, 3.0, -12.0, { 2.5, 3.0, 4.0, 1.5, 5.0, 8.0 } },
+};
+#define N_CONDITIONS    ( (int)(sizeof(Conditions)/sizeof(Conditions[0])) )
+
+static const Lgm_Vector Positions[] = {         // GSM, Re
+    { -4.0,  1.0,  0.5 },
+    { -6.6,  0.0,  0.3 },
+    {  3.0,  2.5,  0.8 },
+    { -2.0, -4.5, -1.5 },
+};
+#define N_POSITIONS     ( (int)(sizeof(Positions)/sizeof(Positions[0])) )
+
+static const double PitchAngles[] = { 30.0, 60.0, 90.0 };
+#define N_PA            ( (int)(sizeof(PitchAngles)/sizeof(PitchAngles[0])) )
+
+#define N_CASES         ( N_CONDITIONS*N_POSITIONS*N_PA )
+
+typedef struct BenchConfig {
+    int         Quality, nFLs;
+    double      Seconds;
+    long int    nBfield, nTrace, nFindShellLine, nIIntegral;
+    double      LS[N_CASES];
+    int         Done[N_CASES];          // this case was run
+    int         nErr, nFail;            // cases compared with the reference / not found here but found there
+    double      MaxErr, RmsErr;
+    int         Pareto;
+} BenchConfig;
+
+
+static double BenchNow( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec );
+}
+
+static int BenchParseList( char *s, int *v, int nMax ) {
+    int     n = 0;
+    char    *t;
+    for ( t = strtok( s, "," ); t && ( n < nMax ); t = strtok( NULL, "," ) ) v[n++] = atoi( t );
+    return( n );
+}
+
+static void BenchSetCondition( const BenchCondition *c, Lgm_MagModelInfo *m ) {
+    int k;
+    Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, c->External, m );
+    m->Kp  = c->Kp;
+    m->P   = c->P;
+    m->Dst = c->Dst;
+    m->By  = c->By;
+    m->Bz  = c->Bz;
+    for ( k=0; k<6; k++ ) m->W[k] = c->W[k];
+}
+
+
+/*
+ *  All of the cases for one condition and position, at one setting. The
+ *  field line through the position is traced once, then L* is done for
+ *  each pitch angle.
+ */
+static void BenchPosition( const char *Only, int ic, int ip, BenchConfig *g ) {
+
+    int             ia, j;
+    double          t0, Blocal, sa;
+    Lgm_Vector      u, Bvec, v1, v2, v3;
+    Lgm_LstarInfo   *LstarInfo;
+
+    if ( Only && strncmp( Only, Conditions[ic].Name, strlen( Only ) ) ) return;       // e.g. "T96" or "T96-storm"
+
+    LstarInfo = InitLstarInfo( 0 );
+    LstarInfo->VerbosityLevel        = 0;
+    LstarInfo->mInfo->VerbosityLevel = 0;
+    BenchSetCondition( &Conditions[ic], LstarInfo->mInfo );
+    Lgm_SetLstarTolerances( g->Quality, g->nFLs, LstarInfo );
+    Lgm_MagStep_ResetState( LstarInfo->mInfo );
+    Lgm_MagModelInfo_ResetStats( LstarInfo->mInfo );
+
+    t0 = BenchNow();
+    Lgm_Set_Coord_Transforms( BENCH_DATE, BENCH_UTC, LstarInfo->mInfo->c );
+    u = Positions[ip];
+    LstarInfo->mInfo->Bfield( &u, &Bvec, LstarInfo->mInfo );
+    Blocal = Lgm_Magnitude( &Bvec );
+    if ( Lgm_Trace( &u, &v1, &v2, &v3, 120.0, 0.01, 1e-7, LstarInfo->mInfo ) == LGM_CLOSED ) {
+        for ( ia=0; ia<N_PA; ia++ ) {
+            j = (ic*N_POSITIONS + ip)*N_PA + ia;
+            sa = sin( PitchAngles[ia]*RadPerDeg );
+            LstarInfo->mInfo->Bm = Blocal/(sa*sa);
+            NewTimeLstarInfo( BENCH_DATE, BENCH_UTC, PitchAngles[ia], LstarInfo->mInfo->Bfield, LstarInfo );
+            g->LS[j]   = ( Lstar( &v3, LstarInfo ) > 0 ) ? LstarInfo->LS : LGM_FILL_VALUE;
+            g->Done[j] = TRUE;
+        }
+    } else {
+        for ( ia=0; ia<N_PA; ia++ ) {
+            j = (ic*N_POSITIONS + ip)*N_PA + ia;
+            g->LS[j]   = LGM_FILL_VALUE;
+            g->Done[j] = TRUE;
+        }
+    }
+    g->Seconds   += BenchNow() - t0;
+#if LGM_INSTRUMENT
+    g->nBfield   += LstarInfo->mInfo->Stats.nInternal[LGM_IGRF];      // every model adds the internal field
+#else
+    g->nBfield    = -1;
+#endif
+
+    FreeLstarInfo( LstarInfo );
+
+}
+
+static void BenchRunConfig( const char *Only, BenchConfig *g ) {
+
+    int     ic, ip;
+
+    Lgm_ProfileReset();
+    for ( ic=0; ic<N_CONDITIONS; ic++ ) {
+        for ( ip=0; ip<N_POSITIONS; ip++ ) BenchPosition( Only, ic, ip, g );
+    }
+    g->nTrace         = Lgm_ProfileCalls( LGM_PROF_TRACE, NULL );
+    g->nFindShellLine = Lgm_ProfileCalls( LGM_PROF_FINDSHELLLINE, NULL );
+    g->nIIntegral     = Lgm_ProfileCalls( LGM_PROF_IINTEGRAL, NULL );
+
+}
+
+
+/*
+ *  Errors against the reference, and which settings are Pareto optimal (in
+ *  wall time and maximum error; a setting that loses L* values the reference
+ *  found isnt).
+ */
+static void BenchCompare( int nCfg, BenchConfig *g, BenchConfig *Ref ) {
+
+    int     i, k, j;
+    double  d, s;
+
+    for ( i=0; i<nCfg; i++ ) {
+        g[i].nErr = g[i].nFail = 0;
+        g[i].MaxErr = 0.0;
+        s = 0.0;
+        for ( j=0; j<N_CASES; j++ ) {
+            if ( !g[i].Done[j] || ( Ref->LS[j] <= 0.0 ) ) continue;
+            if ( g[i].LS[j] <= 0.0 ) { ++g[i].nFail; continue; }
+            d = fabs( g[i].LS[j] - Ref->LS[j] );
+            if ( d > g[i].MaxErr ) g[i].MaxErr = d;
+            s += d*d;
+            ++g[i].nErr;
+        }
+        g[i].RmsErr = ( g[i].nErr > 0 ) ? sqrt( s/(double)g[i].nErr ) : 0.0;
+    }
+
+    for ( i=0; i<nCfg; i++ ) {
+        g[i].Pareto = ( g[i].nFail == 0 );
+        for ( k=0; g[i].Pareto && (k<nCfg); k++ ) {
+            if ( ( k == i ) || ( g[k].nFail > 0 ) ) continue;
+            if ( ( g[k].Seconds <= g[i].Seconds ) && ( g[k].MaxErr <= g[i].MaxErr )
+                    && ( ( g[k].Seconds < g[i].Seconds ) || ( g[k].MaxErr < g[i].MaxErr ) ) ) g[i].Pareto = FALSE;
+        }
+    }
+
+}
+
+
+int main( int argc, char *argv[] ) {
+
+    int             c, i, j, n, nQ = 9, nS = 3, nCfg, nThreads = 1, First;
+    int             Q[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 }, S[16] = { 12, 24, 48 };
+    char            *Only = NULL, *OutFile = NULL;
+    FILE            *fp = stdout;
+    BenchConfig     *g, *Ref;
+
+    while ( (c = getopt( argc, argv, "q:s:m:o:h" )) != -1 ) {
+        switch ( c ) {
+            case 'q': nQ = BenchParseList( optarg, Q, 16 ); break;
+            case 's': nS = BenchParseList( optarg, S, 16 ); break;
+            case 'm': Only    = optarg; break;
+            case 'o': OutFile = optarg; break;
+            default:
+                fprintf( stderr, "Usage: %s [-q Q1,Q2,..] [-s nFLs1,nFLs2,..] [-m Condition] [-o File]\n", argv[0] );
+                return( ( c == 'h' ) ? 0 : 1 );
+        }
+    }
+    if ( ( nQ < 1 ) || ( nS < 1 ) ) {
+        fprintf( stderr, "bench_LstarQuality: Need at least one Quality and one nFLsInDriftShell.\n" );
+        return( 1 );
+    }
+    if ( OutFile && ((fp = fopen( OutFile, "w" )) == NULL) ) {
+        fprintf( stderr, "bench_LstarQuality: Could not open %s for writing.\n", OutFile );
+        return( 1 );
+    }
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+
+    /*
+     *  The settings asked for, then the reference (Quality 8 and the most
+     *  field lines asked for) unless it is one of them.
+     */
+    g = (BenchConfig *)calloc( nQ*nS+1, sizeof(BenchConfig) );
+    nCfg = 0;
+    for ( i=0; i<nQ; i++ ) {
+        for ( j=0; j<nS; j++ ) {
+            g[nCfg].Quality = Q[i];
+            g[nCfg].nFLs    = S[j];
+            ++nCfg;
+        }
+    }
+    for ( n=S[0], j=1; j<nS; j++ ) if ( S[j] > n ) n = S[j];
+    for ( Ref=NULL, i=0; i<nCfg; i++ ) if ( ( g[i].Quality == 8 ) && ( g[i].nFLs == n ) ) Ref = &g[i];
+    if ( Ref == NULL ) {
+        Ref = &g[nCfg];
+        Ref->Quality = 8;
+        Ref->nFLs    = n;
+    }
+
+    Lgm_ProfileEnable( LGM_PROFILE_QUIET );
+
+    fprintf( stderr, "Reference: Quality %d, nFLsInDriftShell %d\n", Ref->Quality, Ref->nFLs );
+    if ( Ref == &g[nCfg] ) BenchRunConfig( Only, Ref );
+    for ( i=0; i<nCfg; i++ ) {
+        BenchRunConfig( Only, &g[i] );
+        fprintf( stderr, "    Quality %d  nFLs %3d  %10.3f s\n", g[i].Quality, g[i].nFLs, g[i].Seconds );
+    }
+
+    BenchCompare( nCfg, g, Ref );
+
+    fprintf( stderr, "\n%7s %5s %11s %12s %9s %9s %9s %11s %11s %5s %6s\n", "Quality", "nFLs", "Wall (s)", "nBfield",
+                "Traces", "Shells", "IInts", "Max dL*", "RMS dL*", "Fail", "Pareto" );
+    for ( i=0; i<nCfg; i++ ) {
+        fprintf( stderr, "%7d %5d %11.3f %12ld %9ld %9ld %9ld %11.3e %11.3e %5d %6s\n", g[i].Quality, g[i].nFLs, g[i].Seconds,
+                g[i].nBfield, g[i].nTrace, g[i].nFindShellLine, g[i].nIIntegral, g[i].MaxErr, g[i].RmsErr, g[i].nFail,
+                g[i].Pareto ? "*" : "" );
+    }
+
+    fprintf( fp, "{\n" );
+    fprintf( fp, "  \"Benchmark\": \"bench_LstarQuality\",\n" );
+#ifdef PACKAGE_VERSION
+    fprintf( fp, "  \"Version\": \"%s\",\n", PACKAGE_VERSION );
+#endif
+    fprintf( fp, "  \"Date\": %d, \"UTC\": %g, \"nThreads\": %d,\n", BENCH_DATE, BENCH_UTC, nThreads );
+    fprintf( fp, "  \"Reference\": { \"Quality\": %d, \"nFLsInDriftShell\": %d },\n", Ref->Quality, Ref->nFLs );
+    fprintf( fp, "  \"Summary\": [" );
+    for ( i=0; i<nCfg; i++ ) {
+        fprintf( fp, "%s\n    { \"Quality\": %d, \"nFLsInDriftShell\": %d, \"Seconds\": %.6f, \"nBfield\": %ld, \"nTrace\": %ld, "
+                     "\"nFindShellLine\": %ld, \"nIIntegral\": %ld, \"nCompared\": %d, \"nFailed\": %d, \"MaxErr\": %.6e, "
+                     "\"RmsErr\": %.6e, \"Pareto\": %s }", i ? "," : "", g[i].Quality, g[i].nFLs, g[i].Seconds, g[i].nBfield,
+                     g[i].nTrace, g[i].nFindShellLine, g[i].nIIntegral, g[i].nErr, g[i].nFail, g[i].MaxErr, g[i].RmsErr,
+                     g[i].Pareto ? "true" : "false" );
+    }
+    fprintf( fp, "\n  ],\n  \"Cases\": [" );
+    First = TRUE;
+    for ( j=0; j<N_CASES; j++ ) {
+        if ( !Ref->Done[j] ) continue;
+        n = j/N_PA;
+        fprintf( fp, "%s\n    { \"Condition\": \"%s\", \"Position\": [ %g, %g, %g ], \"PitchAngle\": %g, \"Reference\": %.10g, \"Lstar\": [",
+                    First ? "" : ",", Conditions[n/N_POSITIONS].Name, Positions[n%N_POSITIONS].x, Positions[n%N_POSITIONS].y,
+                    Positions[n%N_POSITIONS].z, PitchAngles[j%N_PA], Ref->LS[j] );
+        for ( i=0; i<nCfg; i++ ) fprintf( fp, "%s%.10g", i ? ", " : " ", g[i].LS[j] );
+        fprintf( fp, " ] }" );
+        First = FALSE;
+    }
+    fprintf( fp, "\n  ]\n}\n" );
+    if ( fp != stdout ) fclose( fp );
+
+    free( g );
+
+    return( 0 );
+
+}
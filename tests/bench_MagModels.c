@@ -0,0 +1,386 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+#include "../libLanlGeoMag/Lgm/Lgm_KdTree.h"
+
+/*
+ *  Microbenchmarks of the field models.
+ *
+ *  Every model (and every internal field option the external models can be
+ *  combined with) is timed over the same fixed set of points, once through
+ *  mInfo->Bfield() one point at a time and once through Lgm_B_Batch() (and,
+ *  for the models that have it, once more through Lgm_B_Batch() with the
+ *  external field in single precision -- the "Batch32" path). The
+ *  points come from a fixed-seed generator (not rand(), so that they are the
+ *  same on every platform), and the model parameters and epoch are fixed, so
+ *  runs on different library versions can be compared directly.
+ *
+ *  Each case gets a warm-up pass (which also fills whatever caches a model
+ *  keeps, e.g. the RBF weights of the scattered-data models), then passes are
+ *  repeated until at least MinTime seconds have gone by; this is done nTrials
+ *  times and the fastest trial is reported. The sum of |B| over the points is
+ *  reported too, so a change in cost can be told apart from a change in
+ *  the answers.
+ *
+ *  Results go to stdout (or the -o file) as JSON, and a table goes to stderr.
+ *
+ *      bench_MagModels [-n nPoints] [-t MinTime] [-r nTrials] [-m Model] [-o File]
+ *
+ *  TS07 is skipped (and marked so in the output) if its coefficients for the
+ *  benchmark epoch cannot be found (see BenchHaveTS07()).
+ */
+
+#define BENCH_DATE      20050831
+#define BENCH_UTC       9.0
+#define BENCH_SEED      20050831UL
+
+#define BENCH_BFIELD    0
+#define BENCH_BATCH     1
+#define BENCH_BATCH32   2
+
+typedef struct BenchModel {
+    const char  *Name;
+    int         External;
+} BenchModel;
+
+static const BenchModel Models[] = {
+    { "T87",        LGM_EXTMODEL_T87 },
+    { "T89",        LGM_EXTMODEL_T89 },
+    { "T89c",       LGM_EXTMODEL_T89c },
+    { "T96",        LGM_EXTMODEL_T96 },
+    { "T01S",       LGM_EXTMODEL_T01S },
+    { "T02",        LGM_EXTMODEL_T02 },
+    { "TS04",       LGM_EXTMODEL_TS04 },
+    { "TS07",       LGM_EXTMODEL_TS07 },
+    { "OP77",       LGM_EXTMODEL_OP77 },
+    { "OP88",       LGM_EXTMODEL_OP88 },
+    { "TU82",       LGM_EXTMODEL_TU82 },
+    { "SCATTERED_DATA3", LGM_EXTMODEL_SCATTERED_DATA3 },
+    { "SCATTERED_DATA4", LGM_EXTMODEL_SCATTERED_DATA4 },
+    { "SCATTERED_DATA5", LGM_EXTMODEL_SCATTERED_DATA5 },
+};
+#define N_MODELS    ( (int)(sizeof(Models)/sizeof(Models[0])) )
+
+static const char  *InternalNames[] = { "CDIP", "EDIP", "IGRF", "DUNGEY" };
+static const int    Internals[]     = { LGM_CDIP, LGM_EDIP, LGM_IGRF };
+#define N_INTERNALS ( (int)(sizeof(Internals)/sizeof(Internals[0])) )
+
+
+/*
+ *  A small 64-bit LCG (Knuth's MMIX constants); we only need it to be
+ *  the same everywhere.
+ */
+static unsigned long long BenchState;
+
+static void BenchSeed( unsigned long int Seed ) {
+    BenchState = (unsigned long long)Seed;
+}
+
+static double BenchUniform( void ) {
+    BenchState = BenchState*6364136223846793005ULL + 1442695040888963407ULL;
+    return( (double)(BenchState >> 11)*(1.0/9007199254740992.0) );
+}
+
+/*
+ *  Points spread uniformly in volume over 1.5 Re < r < 10 Re, |MLAT| < 60 deg.
+ */
+static void BenchPoints( unsigned long int Seed, long int n, double *x, double *y, double *z ) {
+
+    long int    i;
+    double      r, Phi, SinLat, CosLat, r0 = 1.5, r1 = 10.0, s = sin( 60.0*RadPerDeg );
+
+    BenchSeed( Seed );
+    for ( i=0; i<n; i++ ) {
+        r      = cbrt( r0*r0*r0 + (r1*r1*r1 - r0*r0*r0)*BenchUniform() );
+        Phi    = 2.0*M_PI*BenchUniform();
+        SinLat = s*(2.0*BenchUniform() - 1.0);
+        CosLat = sqrt( 1.0 - SinLat*SinLat );
+        x[i] = r*CosLat*cos( Phi );
+        y[i] = r*CosLat*sin( Phi );
+        z[i] = r*SinLat;
+    }
+
+}
+
+static double BenchNow( void ) {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return( (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec );
+}
+
+
+/*
+ *  Fixed, moderately disturbed conditions (the same as Examples/Bfield/B.c,
+ *  plus what OP88 and TS04 need).
+ */
+static void BenchSetParams( Lgm_MagModelInfo *m ) {
+
+    m->Kp   = 3;
+    m->P    = 2.1;
+    m->Dst  = -30.0;
+    m->By   = -1.1;
+    m->Bz   = -2.5;
+    m->V    = 450.0;
+    m->Den  = 5.0;
+    m->G1   = 6.0;
+    m->G2   = 10.0;
+    m->W[0] = 0.42; m->W[1] = 0.53; m->W[2] = 0.77;
+    m->W[3] = 0.40; m->W[4] = 0.72; m->W[5] = 1.04;
+
+}
+
+
+/*
+ *  A synthetic data set for the scattered-data models: T89 + IGRF evaluated
+ *  on its own fixed-seed cloud of points, put into a KdTree.
+ */
+typedef struct BenchCloud {
+    long int    n;
+    double      **u;
+    double      *B;
+    void        **Obj;
+    Lgm_KdTree  *KdTree;
+} BenchCloud;
+
+static void BenchCloud_Init( BenchCloud *c, long int n ) {
+
+    long int            i;
+    Lgm_Vector          v, B;
+    double              *x, *y, *z;
+    Lgm_MagModelInfo    *m;
+
+    m = Lgm_InitMagInfo();
+    Lgm_Set_Coord_Transforms( BENCH_DATE, BENCH_UTC, m->c );
+    BenchSetParams( m );
+    Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, LGM_EXTMODEL_T89, m );
+
+    c->n = n;
+    LGM_ARRAY_2D( c->u, 3, n, double );
+    LGM_ARRAY_1D( c->B, 3*n, double );
+    LGM_ARRAY_1D( c->Obj, n, void * );
+    x = c->u[0]; y = c->u[1]; z = c->u[2];
+    BenchPoints( BENCH_SEED+1, n, x, y, z );
+    for ( i=0; i<n; i++ ) {
+        v.x = x[i]; v.y = y[i]; v.z = z[i];
+        m->Bfield( &v, &B, m );
+        c->B[3*i] = B.x; c->B[3*i+1] = B.y; c->B[3*i+2] = B.z;
+        c->Obj[i] = (void *)&c->B[3*i];
+    }
+    c->KdTree = Lgm_KdTree_Init( c->u, c->Obj, n, 3 );
+
+    Lgm_FreeMagInfo( m );
+
+}
+
+static void BenchCloud_Free( BenchCloud *c ) {
+    Lgm_FreeKdTree( c->KdTree );
+    LGM_ARRAY_2D_FREE( c->u );
+    LGM_ARRAY_1D_FREE( c->B );
+    LGM_ARRAY_1D_FREE( c->Obj );
+}
+
+
+/*
+ *  One pass over the points. Returns the sum of |B|.
+ */
+static double BenchPass( int Path, long int n, double *x, double *y, double *z, double *bx, double *by, double *bz, Lgm_MagModelInfo *m ) {
+
+    long int    i;
+    double      Sum = 0.0;
+    Lgm_Vector  v, B;
+
+    if ( Path != BENCH_BFIELD ) {
+        Lgm_B_Batch( n, x, y, z, bx, by, bz, m );
+        for ( i=0; i<n; i++ ) Sum += sqrt( bx[i]*bx[i] + by[i]*by[i] + bz[i]*bz[i] );
+    } else {
+        for ( i=0; i<n; i++ ) {
+            v.x = x[i]; v.y = y[i]; v.z = z[i];
+            m->Bfield( &v, &B, m );
+            Sum += Lgm_Magnitude( &B );
+        }
+    }
+
+    return( Sum );
+
+}
+
+typedef struct BenchResult {
+    long int    nEvals;
+    double      Seconds;
+    double      nsPerEval;
+    double      Checksum;
+} BenchResult;
+
+static void BenchCase( int Path, long int n, double *x, double *y, double *z, double *bx, double *by, double *bz,
+                        double MinTime, int nTrials, Lgm_MagModelInfo *m, BenchResult *r ) {
+
+    int         k;
+    long int    nPasses;
+    double      t0, t, ns;
+
+    r->Checksum  = BenchPass( Path, n, x, y, z, bx, by, bz, m );     // warm-up
+    r->nsPerEval = 9e99;
+    for ( k=0; k<nTrials; k++ ) {
+        nPasses = 0;
+        t0 = BenchNow();
+        do {
+            BenchPass( Path, n, x, y, z, bx, by, bz, m );
+            ++nPasses;
+            t = BenchNow() - t0;
+        } while ( t < MinTime );
+        ns = 1e9*t/(double)(nPasses*n);
+        if ( ns < r->nsPerEval ) {
+            r->nsPerEval = ns;
+            r->nEvals    = nPasses*n;
+            r->Seconds   = t;
+        }
+    }
+
+}
+
+
+/*
+ *  TS07 needs its coefficients for the epoch, either from the archive or from
+ *  a .par file under $TS07_DATA_PATH. Lgm_SetCoeffs_TS07() exits if it can't
+ *  find them, so look first.
+ */
+static int BenchHaveTS07( Lgm_MagModelInfo *m ) {
+
+    char        Filename[1024];
+    const char  *Path = getenv( "TS07_DATA_PATH" );
+
+    if ( Lgm_TS07_ArchiveCoeffs( Lgm_TS07_GetArchive(), BENCH_DATE, BENCH_UTC ) == NULL ) {
+        if ( Path == NULL ) return( FALSE );
+        snprintf( Filename, 1024, "%s/Coeffs/2005_243/2005_243_09_00.par", Path );    // BENCH_DATE, BENCH_UTC
+        if ( access( Filename, R_OK ) != 0 ) return( FALSE );
+    }
+    Lgm_SetCoeffs_TS07( BENCH_DATE, BENCH_UTC, &m->TS07_Info );
+
+    return( TRUE );
+
+}
+
+
+int main( int argc, char *argv[] ) {
+
+    int                 c, i, j, Path, First = TRUE, HaveTS07 = -1, Skip;
+    long int            n = 2000, nCloud = 4000;
+    double              MinTime = 0.1, *x, *y, *z, *bx, *by, *bz;
+    int                 nTrials = 3;
+    char                *Only = NULL, *OutFile = NULL;
+    const char          *PathNames[] = { "Bfield", "Batch", "Batch32" };
+    FILE                *fp = stdout;
+    BenchResult         r;
+    BenchCloud          Cloud;
+    Lgm_MagModelInfo    *m;
+
+    while ( (c = getopt( argc, argv, "n:t:r:m:o:h" )) != -1 ) {
+        switch ( c ) {
+            case 'n': n       = atol( optarg ); break;
+            case 't': MinTime = atof( optarg ); break;
+            case 'r': nTrials = atoi( optarg ); break;
+            case 'm': Only    = optarg; break;
+            case 'o': OutFile = optarg; break;
+            default:
+                fprintf( stderr, "Usage: %s [-n nPoints] [-t MinTime] [-r nTrials] [-m Model] [-o File]\n", argv[0] );
+                return( ( c == 'h' ) ? 0 : 1 );
+        }
+    }
+    if ( n < 1 ) n = 1;
+    if ( nTrials < 1 ) nTrials = 1;
+
+    if ( OutFile && ((fp = fopen( OutFile, "w" )) == NULL) ) {
+        fprintf( stderr, "bench_MagModels: Could not open %s for writing.\n", OutFile );
+        return( 1 );
+    }
+
+    LGM_ARRAY_1D( x,  n, double ); LGM_ARRAY_1D( y,  n, double ); LGM_ARRAY_1D( z,  n, double );
+    LGM_ARRAY_1D( bx, n, double ); LGM_ARRAY_1D( by, n, double ); LGM_ARRAY_1D( bz, n, double );
+    BenchPoints( BENCH_SEED, n, x, y, z );
+
+    BenchCloud_Init( &Cloud, nCloud );
+
+    m = Lgm_InitMagInfo();
+    Lgm_Set_Coord_Transforms( BENCH_DATE, BENCH_UTC, m->c );
+    BenchSetParams( m );
+    Lgm_Set_KdTree( Cloud.KdTree, 12, 4.0, m );
+
+    fprintf( fp, "{\n" );
+    fprintf( fp, "  \"Benchmark\": \"bench_MagModels\",\n" );
+#ifdef PACKAGE_VERSION
+    fprintf( fp, "  \"Version\": \"%s\",\n", PACKAGE_VERSION );
+#endif
+    fprintf( fp, "  \"Date\": %d, \"UTC\": %g, \"Seed\": %lu,\n", BENCH_DATE, BENCH_UTC, BENCH_SEED );
+    fprintf( fp, "  \"nPoints\": %ld, \"MinTime\": %g, \"nTrials\": %d,\n", n, MinTime, nTrials );
+    fprintf( fp, "  \"Results\": [" );
+
+    fprintf( stderr, "%-16s %-6s %-7s %12s %14s %14s\n", "Model", "Int", "Path", "ns/eval", "evals/s", "Checksum" );
+
+    /*
+     *  j == -1 is the internal field on its own; 0..N_MODELS-1 are the
+     *  external models, each with every internal option.
+     */
+    for ( j=-1; j<N_MODELS; j++ ) {
+
+        const char *Name = ( j < 0 ) ? NULL : Models[j].Name;
+
+        for ( i=0; i<N_INTERNALS; i++ ) {
+
+            if ( Only && strcmp( Only, Name ? Name : InternalNames[Internals[i]] ) ) continue;
+
+            Lgm_MagModelInfo_Set_MagModel( Internals[i], (j < 0) ? LGM_EXTMODEL_NULL : Models[j].External, m );
+
+            Skip = FALSE;
+            if ( (j >= 0) && (Models[j].External == LGM_EXTMODEL_TS07) ) {
+                if ( HaveTS07 < 0 ) HaveTS07 = BenchHaveTS07( m );
+                Skip = !HaveTS07;
+            }
+
+            for ( Path=BENCH_BFIELD; Path<=BENCH_BATCH32; Path++ ) {
+
+                // only T89 has a single precision external field so far
+                if ( (Path == BENCH_BATCH32) && ((j < 0) || (Models[j].External != LGM_EXTMODEL_T89)) ) continue;
+                m->ExternalPrecision = ( Path == BENCH_BATCH32 ) ? LGM_PRECISION_SINGLE : LGM_PRECISION_DOUBLE;
+
+                fprintf( fp, "%s\n    { \"Model\": \"%s\", \"Internal\": \"%s\", \"Path\": \"%s\", ", First ? "" : ",",
+                            Name ? Name : InternalNames[Internals[i]], InternalNames[Internals[i]], PathNames[Path] );
+                First = FALSE;
+
+                if ( Skip ) {
+                    fprintf( fp, "\"Skipped\": \"no coefficients for the benchmark epoch\" }" );
+                    fprintf( stderr, "%-16s %-6s %-7s %12s\n", Name, InternalNames[Internals[i]], PathNames[Path], "skipped" );
+                    continue;
+                }
+
+                BenchCase( Path, n, x, y, z, bx, by, bz, MinTime, nTrials, m, &r );
+                fprintf( fp, "\"nEvals\": %ld, \"Seconds\": %.6f, \"nsPerEval\": %.3f, \"EvalsPerSec\": %.6e, \"Checksum\": %.15e }",
+                            r.nEvals, r.Seconds, r.nsPerEval, 1e9/r.nsPerEval, r.Checksum );
+                fprintf( stderr, "%-16s %-6s %-7s %12.1f %14.4e %14.8e\n", Name ? Name : InternalNames[Internals[i]],
+                            InternalNames[Internals[i]], PathNames[Path], r.nsPerEval, 1e9/r.nsPerEval, r.Checksum );
+                fflush( fp );
+
+            }
+            m->ExternalPrecision = LGM_PRECISION_DOUBLE;
+
+        }
+
+    }
+
+    fprintf( fp, "\n  ]\n}\n" );
+    if ( fp != stdout ) fclose( fp );
+
+    Lgm_FreeMagInfo( m );
+    BenchCloud_Free( &Cloud );
+    LGM_ARRAY_1D_FREE( x );  LGM_ARRAY_1D_FREE( y );  LGM_ARRAY_1D_FREE( z );
+    LGM_ARRAY_1D_FREE( bx ); LGM_ARRAY_1D_FREE( by ); LGM_ARRAY_1D_FREE( bz );
+
+    return( 0 );
+
+}
@@ -653,7 +653,7 @@ START_TEST(test_ISO_15) {
     fail_unless( (d.Year   == 1986),     "For string %s Year should be 1986, got %d", TimeString, d.Year );
     fail_unless( (d.Month  == 1),        "For string %s Month should be 1, got %d", TimeString, d.Month );
     fail_unless( (d.Day    == 23),       "For string %s Day should be 23, got %d", TimeString, d.Day );
-    fail_unless( (d.Doy    == 349),      "For string %s Doy should be 349, got %d", TimeString, d.Doy );
+    fail_unless( (d.Doy    == 23),       "For string %s Doy should be 23, got %d", TimeString, d.Doy );
     t = 0.0 + 0.0/60.0 + 0.0/3600.0;
     fail_unless( (fabs(d.Time-t)<1e-12), "For string %s Time should be %.10lf, got %.10lf", TimeString, t, d.Time );
     fail_unless( (d.Hour   == 0),        "For string %s Hour should be 0, got %d", TimeString, d.Hour );
@@ -680,6 +680,202 @@ START_TEST(test_ISO_15) {
 END_TEST
 
 
+/*
+ *  The strings in the two fixed forms that nearly all data files use
+ *  (YYYY-MM-DDThh:mm:ss[.s]TZD and YYYY-DDDThh:mm:ss[.s]TZD) are parsed by a
+ *  fast path in C, and everything else by the general Perl parser. The
+ *  tests below check the fast path against the general parser (by giving
+ *  each time in an extended form, which goes through the fast path, and in
+ *  the equivalent basic form, which doesnt), and the batch parsers against
+ *  the single string one.
+ */
+static char *DiffDateTime( Lgm_DateTime *a, Lgm_DateTime *b ) {
+
+    if ( a->Date   != b->Date )         return( "Date" );
+    if ( a->Year   != b->Year )         return( "Year" );
+    if ( a->Month  != b->Month )        return( "Month" );
+    if ( a->Day    != b->Day )          return( "Day" );
+    if ( a->Doy    != b->Doy )          return( "Doy" );
+    if ( a->Time   != b->Time )         return( "Time" );
+    if ( a->Hour   != b->Hour )         return( "Hour" );
+    if ( a->Minute != b->Minute )       return( "Minute" );
+    if ( a->Second != b->Second )       return( "Second" );
+    if ( a->Week   != b->Week )         return( "Week" );
+    if ( a->wYear  != b->wYear )        return( "wYear" );
+    if ( a->Dow    != b->Dow )          return( "Dow" );
+    if ( strcmp( a->DowStr, b->DowStr ) ) return( "DowStr" );
+    if ( a->fYear  != b->fYear )        return( "fYear" );
+    if ( a->JD     != b->JD )           return( "JD" );
+    if ( a->T      != b->T )            return( "T" );
+    if ( a->DaySeconds != b->DaySeconds ) return( "DaySeconds" );
+    if ( a->TZD_sgn != b->TZD_sgn )     return( "TZD_sgn" );
+    if ( a->TZD_hh != b->TZD_hh )       return( "TZD_hh" );
+    if ( a->TZD_mm != b->TZD_mm )       return( "TZD_mm" );
+    if ( a->TimeSystem != b->TimeSystem ) return( "TimeSystem" );
+
+    return( NULL );
+
+}
+
+
+START_TEST(test_ISO_16) {
+
+    int          i, Result1, Result2;
+    char         *Field;
+    Lgm_DateTime d1, d2;
+    char         *Pairs[][2] = {
+        { "2009-06-21T05:12:34.123456789Z",     "20090621T051234.123456789Z" },
+        { "2009-06-21T05:12:34Z",               "20090621T051234Z" },
+        { "2009-06-21T05:12:34",                "20090621T051234" },
+        { "2009-06-21T05:12:34.5-03:30",        "20090621T051234.5-0330" },
+        { "2009-06-21T05:12:34.5+0330",         "20090621T051234.5+0330" },
+        { "2009-06-21T05:12:34+07",             "20090621T051234+07" },
+        { "2009-01-01T01:52:23+07",             "20090101T015223+07" },     // back into the previous year
+        { "2009-12-31T22:30:00-03:00",          "20091231T223000-0300" },   // on into the next year
+        { "2009-172T05:12:34.5Z",               "2009172T051234.5Z" },      // day of year
+        { "2008-366T23:59:59.999Z",             "2008366T235959.999Z" },
+        { "2008-12-31T23:59:60.5Z",             "20081231T235960.5Z" },     // a leap second
+        { "2012-06-30T23:59:60Z",               "20120630T235960Z" },
+        { "2000-02-29T12:00:00Z",               "20000229T120000Z" },
+        { "1999-12-31T23:59:59.9999999Z",       "19991231T235959.9999999Z" },
+        { "2009-06-21 05:12:34Z",               "20090621 051234Z" },
+    };
+
+    printf("Checking the fast path against the general parser\n");
+    for ( i=0; i<(int)(sizeof(Pairs)/sizeof(Pairs[0])); i++ ) {
+        memset( &d1, 0, sizeof(d1) ); memset( &d2, 0, sizeof(d2) );
+        Result1 = IsoTimeStringToDateTime( Pairs[i][0], &d1, c );
+        Result2 = IsoTimeStringToDateTime( Pairs[i][1], &d2, c );
+        fail_unless( (Result1 == 1), "Error returned by IsoTimeStringToDateTime() for %s", Pairs[i][0] );
+        fail_unless( (Result2 == 1), "Error returned by IsoTimeStringToDateTime() for %s", Pairs[i][1] );
+        Field = DiffDateTime( &d1, &d2 );
+        fail_unless( (Field == NULL), "%s differs between %s (fast path) and %s (general parser)", Field, Pairs[i][0], Pairs[i][1] );
+    }
+
+    return;
+}
+END_TEST
+
+
+START_TEST(test_ISO_17) {
+
+    int          i, Result;
+    char         TimeString[128];
+    Lgm_DateTime d;
+    char         *Bad[] = {
+        "2009-02-29T00:00:00Z",     // not a leap year
+        "2009-13-01T00:00:00Z",
+        "2009-06-31T00:00:00Z",
+        "2009-366T00:00:00Z",
+        "2009-06-30T23:59:60Z",     // not a leap second day
+        "2009-06-21T05:12:34+05:",  // broken time zone
+    };
+
+    // leading and trailing white space, and a space instead of the T
+    sprintf(TimeString, "  2009-06-21 05:12:34.25Z \n");
+    printf("Converting ISO string: %s\n", TimeString);
+    Result = IsoTimeStringToDateTime( TimeString, &d, c );
+    fail_unless( (Result   == 1),        "Error returned by IsoTimeStringToDateTime()");
+    fail_unless( (d.Date   == 20090621), "For string %s Date should be 20090621, got %ld", TimeString, d.Date );
+    fail_unless( (d.Hour   == 5),        "For string %s Hour should be 5, got %d", TimeString, d.Hour );
+    fail_unless( (d.Minute == 12),       "For string %s Minute should be 12, got %d", TimeString, d.Minute );
+    fail_unless( (d.Second == 34.25),    "For string %s Second should be 34.25, got %.10lf", TimeString, d.Second );
+
+    // a leap second
+    sprintf(TimeString, "2008-12-31T23:59:60.5Z");
+    printf("Converting ISO string: %s\n", TimeString);
+    Result = IsoTimeStringToDateTime( TimeString, &d, c );
+    fail_unless( (Result   == 1),        "Error returned by IsoTimeStringToDateTime()");
+    fail_unless( (d.Date   == 20081231), "For string %s Date should be 20081231, got %ld", TimeString, d.Date );
+    fail_unless( (d.Second == 60.5),     "For string %s Second should be 60.5, got %.10lf", TimeString, d.Second );
+    fail_unless( (d.DaySeconds == 86401.0), "For string %s DaySeconds should be 86401, got %g", TimeString, d.DaySeconds );
+
+    // day of year, with a time zone that takes it into the next day
+    sprintf(TimeString, "2009-365T22:00:00-02:30");
+    printf("Converting ISO string: %s\n", TimeString);
+    Result = IsoTimeStringToDateTime( TimeString, &d, c );
+    fail_unless( (Result   == 1),        "Error returned by IsoTimeStringToDateTime()");
+    fail_unless( (d.Date   == 20100101), "For string %s Date should be 20100101, got %ld", TimeString, d.Date );
+    fail_unless( (d.Doy    == 1),        "For string %s Doy should be 1, got %d", TimeString, d.Doy );
+    fail_unless( (d.Hour   == 0),        "For string %s Hour should be 0, got %d", TimeString, d.Hour );
+    fail_unless( (d.Minute == 30),       "For string %s Minute should be 30, got %d", TimeString, d.Minute );
+    fail_unless( (d.TZD_sgn == -1),      "For string %s TZD_sgn should be -1, got %d", TimeString, d.TZD_sgn );
+    fail_unless( (d.TZD_hh  == 2),       "For string %s TZD_hh should be 2, got %d", TimeString, d.TZD_hh );
+    fail_unless( (d.TZD_mm  == 30),      "For string %s TZD_mm should be 30, got %d", TimeString, d.TZD_mm );
+
+    // lots of digits of seconds
+    sprintf(TimeString, "2009-06-21T05:12:34.123456789012345678901234567890123456789012345678901234567890123456789Z");
+    printf("Converting ISO string: %s\n", TimeString);
+    Result = IsoTimeStringToDateTime( TimeString, &d, c );
+    fail_unless( (Result   == 1),        "Error returned by IsoTimeStringToDateTime()");
+    fail_unless( (fabs(d.Second-34.1234567890123456789)<1e-12), "For string %s Second should be 34.1234567890123, got %.13lf", TimeString, d.Second );
+
+    for ( i=0; i<(int)(sizeof(Bad)/sizeof(Bad[0])); i++ ) {
+        printf("Converting ISO string: %s (should fail)\n", Bad[i]);
+        Result = IsoTimeStringToDateTime( Bad[i], &d, c );
+        fail_unless( (Result == -1), "IsoTimeStringToDateTime() should have rejected %s", Bad[i] );
+    }
+
+    return;
+}
+END_TEST
+
+
+START_TEST(test_ISO_18) {
+
+    int          i, n, Result;
+    long int     nGood, nGoodSingle = 0;
+    char         *Field;
+    double       Tai;
+    Lgm_DateTime d, d_batch[16];
+    double       Tai_batch[16];
+    char         *Strings[] = {
+        "2008-12-31T23:59:58.5Z",
+        "2008-12-31T23:59:59.9995Z",
+        "2008-12-31T23:59:60.25Z",      // leap second
+        "2009-01-01T00:00:00Z",
+        "2009-01-01T00:00:00.001Z",
+        "2009-01-01T12:34:56.789Z",
+        "2009-01-01T12:34:57Z",
+        "2009-001T12:34:58Z",
+        "2009-01-01T13:00:00+01:00",
+        "2009-02-29T00:00:00Z",         // invalid
+        "2009-01-01T23:59:59.9999Z",
+        "20090102T000000Z",             // general parser
+        "2009-01-02T06:00:00Z",
+    };
+
+    n = (int)(sizeof(Strings)/sizeof(Strings[0]));
+    printf("Checking Lgm_IsoTimeStringsToDateTimes() and Lgm_IsoTimeStringsToTaiSeconds() against IsoTimeStringToDateTime()\n");
+    nGood = Lgm_IsoTimeStringsToDateTimes( n, Strings, d_batch, c );
+    for ( i=0; i<n; i++ ) {
+        Result = IsoTimeStringToDateTime( Strings[i], &d, c );
+        if ( Result == 1 ) {
+            ++nGoodSingle;
+            Field = DiffDateTime( &d, &d_batch[i] );
+            fail_unless( (Field == NULL), "%s differs between the batch and single string parsers for %s", Field, Strings[i] );
+        } else {
+            fail_unless( (d_batch[i].Date == -1), "Batch parser accepted %s", Strings[i] );
+        }
+    }
+    fail_unless( (nGood == nGoodSingle), "Batch parser got %ld good strings, should have been %ld", nGood, nGoodSingle );
+
+    nGood = Lgm_IsoTimeStringsToTaiSeconds( n, Strings, Tai_batch, c );
+    fail_unless( (nGood == nGoodSingle), "Batch parser got %ld good strings, should have been %ld", nGood, nGoodSingle );
+    for ( i=0; i<n; i++ ) {
+        if ( IsoTimeStringToDateTime( Strings[i], &d, c ) == 1 ) {
+            Tai = Lgm_UTC_to_TaiSeconds( &d, c );
+            fail_unless( (fabs(Tai_batch[i]-Tai) < 1e-6), "TaiSeconds for %s should be %.6lf, got %.6lf", Strings[i], Tai, Tai_batch[i] );
+        } else {
+            fail_unless( (Tai_batch[i] == LGM_FILL_VALUE), "TaiSeconds for %s should be LGM_FILL_VALUE, got %.6lf", Strings[i], Tai_batch[i] );
+        }
+    }
+
+    return;
+}
+END_TEST
+
+
 Suite *ParseTimeStr_suite(void) {
 
   Suite *s = suite_create("ISO_TIME_STRING_PARSE_TESTS");
@@ -700,6 +896,10 @@ Suite *ParseTimeStr_suite(void) {
   tcase_add_test(tc_ParseTimeStr, test_ISO_12);
   tcase_add_test(tc_ParseTimeStr, test_ISO_13);
   tcase_add_test(tc_ParseTimeStr, test_ISO_14);
+  tcase_add_test(tc_ParseTimeStr, test_ISO_15);
+  tcase_add_test(tc_ParseTimeStr, test_ISO_16);
+  tcase_add_test(tc_ParseTimeStr, test_ISO_17);
+  tcase_add_test(tc_ParseTimeStr, test_ISO_18);
   suite_add_tcase(s, tc_ParseTimeStr);
 
   return s;
@@ -0,0 +1,273 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../libLanlGeoMag/Lgm/Lgm_KdTree.h"
+#include "check_rand.h"
+
+/*
+ *  KdTree tests. The built tree is walked to check that every point is in
+ *  exactly one leaf and that every split and node bound is right, and the
+ *  kNN searches are checked against a brute force search. Some of the
+ *  points share coordinates, so the median selection has to cope with ties,
+ *  and there are enough points for the tree to be built in parallel (with
+ *  OpenMP).
+ */
+
+#define NPOINTS     70000
+#define NQUERIES    300
+#define D           3
+#define K           10
+
+static int CompareDoubles( const void *a, const void *b ) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return( ( x < y ) ? -1 : ( x > y ) );
+}
+
+double      *Positions[D], *Brute;
+long int    *Objects;
+void        **ObjectPtrs;
+Lgm_KdTree  *KdTree;
+
+/*
+ *  Random points in a 10 x 4 x 1 box (so the largest range is not always
+ *  the same dimension further down), a quarter of them on a coarse grid in
+ *  x and z.
+ */
+void KdTree_Setup(void) {
+
+    long int    j;
+    int         d;
+
+    for ( d=0; d<D; d++ ) Positions[d] = (double *)calloc( NPOINTS, sizeof(double) );
+    Objects    = (long int *)calloc( NPOINTS, sizeof(long int) );
+    ObjectPtrs = (void **)calloc( NPOINTS, sizeof(void *) );
+    Brute      = (double *)calloc( NPOINTS, sizeof(double) );
+    State = 0x9E3779B97F4A7C15ULL;
+    for ( j=0; j<NPOINTS; j++ ) {
+        Positions[0][j] = RandUniform( -5.0, 5.0 );
+        Positions[1][j] = RandUniform( -2.0, 2.0 );
+        Positions[2][j] = RandUniform( -0.5, 0.5 );
+        if ( j%4 == 0 ) {
+            Positions[0][j] = floor( 2.0*Positions[0][j] )/2.0;
+            Positions[2][j] = floor( 8.0*Positions[2][j] )/8.0;
+        }
+        Objects[j]    = 1000*j;
+        ObjectPtrs[j] = (void *)&Objects[j];
+    }
+
+    KdTree = Lgm_KdTree_Init( Positions, ObjectPtrs, NPOINTS, D );
+    return;
+}
+
+void KdTree_TearDown(void) {
+    int d;
+    Lgm_FreeKdTree( KdTree );
+    for ( d=0; d<D; d++ ) free( Positions[d] );
+    free( Objects );
+    free( ObjectPtrs );
+    free( Brute );
+    return;
+}
+
+static double Dist2( double *q, unsigned long int j ) {
+    double  diff, dist = 0.0;
+    int     d;
+    for ( d=0; d<D; d++ ) { diff = Positions[d][j] - q[d]; dist += diff*diff; }
+    return( dist );
+}
+
+/*
+ *  Sorted distances^2 from q to every point.
+ */
+static void BruteForce_kNN( double *q ) {
+    long int    j;
+    for ( j=0; j<NPOINTS; j++ ) Brute[j] = Dist2( q, j );
+    qsort( Brute, NPOINTS, sizeof(double), CompareDoubles );
+}
+
+static void RandQuery( int i, double *q ) {
+    if ( i%4 == 1 ) {
+        // right on a data point
+        long int j = Rand64()%NPOINTS;
+        q[0] = Positions[0][j]; q[1] = Positions[1][j]; q[2] = Positions[2][j];
+    } else {
+        q[0] = RandUniform( -6.0, 6.0 ); q[1] = RandUniform( -3.0, 3.0 ); q[2] = RandUniform( -1.0, 1.0 );
+    }
+}
+
+/*
+ *  Checks a node and everything below it. Returns the number of problems.
+ */
+static long int CheckNode( Lgm_KdTreeNode *Node, int *Seen ) {
+
+    long int            nBad = 0;
+    unsigned long int   j, Id;
+    int                 d;
+
+    if ( ( Node->Left == NULL ) && ( Node->Right == NULL ) ) {
+
+        if ( ( Node->nData != Node->nDataBelow ) || ( Node->nData > KDTREE_MAX_DATA_PER_NODE ) ) ++nBad;
+        for ( j=0; j<Node->nData; j++ ) {
+            Id = Node->Data[j].Id;
+            if ( ( Id >= NPOINTS ) || Seen[Id]++ ) { ++nBad; continue; }
+            if ( Node->Data[j].Object != ObjectPtrs[Id] ) ++nBad;
+            for ( d=0; d<D; d++ ) {
+                if ( Node->Data[j].Position[d] != Positions[d][Id] ) ++nBad;
+                if ( ( Positions[d][Id] < Node->Min[d] ) || ( Positions[d][Id] > Node->Max[d] ) ) ++nBad;
+            }
+        }
+
+    } else {
+
+        if ( ( Node->Left == NULL ) || ( Node->Right == NULL ) ) return( nBad+1 );
+        if ( Node->nDataBelow != Node->Left->nDataBelow + Node->Right->nDataBelow ) ++nBad;
+        if ( Node->Left->nDataBelow - Node->Right->nDataBelow > 1 ) ++nBad;
+        if ( ( Node->Left->Max[Node->d] > Node->CutVal ) || ( Node->Right->Min[Node->d] < Node->CutVal ) ) ++nBad;
+        for ( d=0; d<D; d++ ) {
+            if ( ( Node->Left->Min[d] < Node->Min[d] ) || ( Node->Right->Min[d] < Node->Min[d] )
+                    || ( Node->Left->Max[d] > Node->Max[d] ) || ( Node->Right->Max[d] > Node->Max[d] ) ) ++nBad;
+        }
+        nBad += CheckNode( Node->Left, Seen ) + CheckNode( Node->Right, Seen );
+
+    }
+
+    return( nBad );
+
+}
+
+
+START_TEST(test_KdTree_01) {
+
+    long int    j, nBad, nMissing = 0;
+    int         *Seen;
+
+    printf("Checking the structure of a %d point Lgm_KdTree\n", NPOINTS);
+    Seen = (int *)calloc( NPOINTS, sizeof(int) );
+    fail_unless( (KdTree->Root->nDataBelow == NPOINTS), "Root should have %d points below it, has %lu", NPOINTS, KdTree->Root->nDataBelow );
+    nBad = CheckNode( KdTree->Root, Seen );
+    for ( j=0; j<NPOINTS; j++ ) if ( Seen[j] != 1 ) ++nMissing;
+    free( Seen );
+    fail_unless( (nBad == 0), "%ld problems with the nodes of the tree", nBad );
+    fail_unless( (nMissing == 0), "%ld points are not in exactly one leaf", nMissing );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Lgm_KdTree_kNN() (which gives the neighbors farthest first) against brute force.
+ */
+START_TEST(test_KdTree_02) {
+
+    int             i, k, Kgot, Flag, nBad = 0;
+    double          q[D];
+    Lgm_KdTreeData  kNN[K];
+
+    printf("Checking Lgm_KdTree_kNN() against a brute force search (%d queries)\n", NQUERIES);
+    State = 0xD1B54A32D192ED03ULL;
+    for ( i=0; i<NQUERIES; i++ ) {
+        RandQuery( i, q );
+        Flag = Lgm_KdTree_kNN( q, D, KdTree, K, &Kgot, 100.0, kNN );
+        fail_unless( (Flag == KDTREE_KNN_SUCCESS) && (Kgot == K), "query %d: Lgm_KdTree_kNN() returned %d with Kgot = %d", i, Flag, Kgot );
+        BruteForce_kNN( q );
+        for ( k=0; k<K; k++ ) {
+            if ( ( kNN[K-1-k].Dist2 != Brute[k] ) || ( Dist2( q, kNN[K-1-k].Id ) != kNN[K-1-k].Dist2 ) || ( *(long int *)kNN[K-1-k].Object != 1000*(long int)kNN[K-1-k].Id ) ) {
+                if ( nBad++ < 10 ) printf("    query %d, NN %d: got Id %lu (Dist2 %.17g), brute force gives Dist2 %.17g\n", i, k, kNN[K-1-k].Id, kNN[K-1-k].Dist2, Brute[k] );
+            }
+        }
+    }
+    fail_unless( (nBad == 0), "%d kNN results differ from the brute force search", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Lgm_KdTree_kNN_Query() and Lgm_KdTree_kNN_Batch() (closest first) against
+ *  brute force, with a distance limit that leaves some queries short.
+ */
+START_TEST(test_KdTree_03) {
+
+    int             i, k, Kgot, Flag, nIn, *KgotB, nTooFew = 0, nBad = 0;
+    long int        nGood, nExpected = 0;
+    double          q[D], *Queries[D], MaxDist2 = 0.04;
+    Lgm_KdTreeData  kNN[K], *kNNB;
+    Lgm_KdTreeQuery *Q;
+
+    printf("Checking Lgm_KdTree_kNN_Query() and Lgm_KdTree_kNN_Batch() with MaxDist2 = %g against a brute force search (%d queries)\n", MaxDist2, NQUERIES);
+    for ( k=0; k<D; k++ ) Queries[k] = (double *)calloc( NQUERIES, sizeof(double) );
+    KgotB = (int *)calloc( NQUERIES, sizeof(int) );
+    kNNB  = (Lgm_KdTreeData *)calloc( NQUERIES*K, sizeof(Lgm_KdTreeData) );
+    Q = Lgm_KdTree_CreateQuery( KdTree, K );
+    State = 0x2545F4914F6CDD1DULL;
+    for ( i=0; i<NQUERIES; i++ ) {
+        RandQuery( i, q );
+        for ( k=0; k<D; k++ ) Queries[k][i] = q[k];
+    }
+    nGood = Lgm_KdTree_kNN_Batch( KdTree, NQUERIES, Queries, K, MaxDist2, KgotB, kNNB );
+
+    for ( i=0; i<NQUERIES; i++ ) {
+        for ( k=0; k<D; k++ ) q[k] = Queries[k][i];
+        Flag = Lgm_KdTree_kNN_Query( q, KdTree, K, &Kgot, MaxDist2, kNN, Q );
+        BruteForce_kNN( q );
+        for ( nIn=0; ( nIn < NPOINTS ) && ( Brute[nIn] <= MaxDist2 ); nIn++ );
+        if ( nIn < K ) ++nTooFew; else ++nExpected;
+
+        if ( ( Kgot != ( ( nIn < K ) ? nIn : K ) ) || ( KgotB[i] != Kgot ) || ( Flag != ( ( nIn < K ) ? KDTREE_KNN_TOO_FEW_NNS : KDTREE_KNN_SUCCESS ) ) ) {
+            if ( nBad++ < 10 ) printf("    query %d: %d points within MaxDist2, got Kgot = %d (batch %d) and return %d\n", i, nIn, Kgot, KgotB[i], Flag );
+            continue;
+        }
+        for ( k=0; k<Kgot; k++ ) {
+            if ( ( kNN[k].Dist2 != Brute[k] ) || ( kNNB[i*K+k].Dist2 != Brute[k] ) || ( Dist2( q, kNN[k].Id ) != Brute[k] ) ) {
+                if ( nBad++ < 10 ) printf("    query %d, NN %d: got Dist2 %.17g (batch %.17g), brute force gives %.17g\n", i, k, kNN[k].Dist2, kNNB[i*K+k].Dist2, Brute[k] );
+            }
+        }
+    }
+    printf("    %d of %d queries had fewer than %d points within MaxDist2\n", nTooFew, NQUERIES, K );
+    Lgm_KdTree_FreeQuery( Q );
+    for ( k=0; k<D; k++ ) free( Queries[k] );
+    free( KgotB );
+    free( kNNB );
+    fail_unless( (nTooFew > 0) && (nTooFew < NQUERIES), "MaxDist2 should leave some queries short of K neighbors (and not all)" );
+    fail_unless( (nGood == nExpected), "Lgm_KdTree_kNN_Batch() found K neighbors for %ld queries, expected %ld", nGood, nExpected );
+    fail_unless( (nBad == 0), "%d kNN results differ from the brute force search", nBad );
+
+    return;
+}
+END_TEST
+
+
+Suite *KdTree_suite(void) {
+
+    Suite *s  = suite_create("KDTREE_TESTS");
+    TCase *tc = tcase_create("KdTree");
+    tcase_set_timeout( tc, 60 );
+    tcase_add_checked_fixture( tc, KdTree_Setup, KdTree_TearDown );
+    tcase_add_test(tc, test_KdTree_01);
+    tcase_add_test(tc, test_KdTree_02);
+    tcase_add_test(tc, test_KdTree_03);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = KdTree_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running KdTree Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
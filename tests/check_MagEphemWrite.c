@@ -0,0 +1,210 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagEphemInfo.h"
+#include "check_rand.h"
+
+/*
+ *  Lgm_WriteMagEphemData() formats its doubles with its own routines instead
+ *  of fprintf() (see Lgm_MagEphemWrite.c), and they are supposed to give
+ *  exactly what fprintf() gives. These check that for the formats the writer
+ *  uses, over random values of every magnitude, values right at (and right
+ *  next to) rounding ties, and the special ones.
+ */
+
+#define NRANDOM     1000000
+
+static const int F_Formats[][2] = { {13,4}, {13,6}, {13,8}, {15,3}, {16,8}, {7,1}, {8,3} };
+static const int G_Widths[]     = { 12, 16 };
+
+/*
+ *  A value to format. Mostly random bit patterns (every magnitude, denormals,
+ *  NaNs and Infs included) and random values of the sizes that actually
+ *  show up, plus values on and around decimal rounding ties.
+ */
+static double RandValue( int Prec ) {
+
+    uint64_t    u;
+    double      x, Scale;
+
+    switch ( Rand64()%6 ) {
+        case 0:
+            u = Rand64();
+            memcpy( &x, &u, sizeof(x) );
+            return( x );
+        case 1:
+            return( ( RandUniform( 0.0, 1.0 ) - 0.5 )*pow( 10.0, (int)(Rand64()%40) - 20 ) );
+        case 2:
+            return( ( RandUniform( 0.0, 1.0 ) - 0.5 )*2e4 );
+        case 3:
+            // ties for %.<Prec>f
+            Scale = pow( 10.0, Prec );
+            x = ( (double)(Rand64()%20000000) + 0.5 )/Scale;
+            return( ( Rand64()&1 ) ? x : -x );
+        case 4:
+            // ties for %g (6 significant digits)
+            x = ( (double)(100000 + Rand64()%900000) + 0.5 )*pow( 10.0, (int)(Rand64()%30) - 20 );
+            return( ( Rand64()&1 ) ? x : -x );
+        default:
+            // one ulp either side of a tie
+            x = ( (double)(Rand64()%2000000) + 0.5 )/pow( 10.0, Prec );
+            return( ( Rand64()&1 ) ? nextafter( x, 0.0 ) : nextafter( x, 1e300 ) );
+    }
+
+}
+
+
+START_TEST(test_MagEphemFormat_f_01) {
+
+    int     i, k, len, nBad = 0;
+    char    Str[512], Ref[512];
+    double  x;
+
+    printf("Checking Lgm_MagEphemFormat_f() against snprintf() for %d values\n", NRANDOM);
+    State = 0x9E3779B97F4A7C15ULL;
+    for ( i=0; i<NRANDOM; i++ ) {
+        k   = i%(int)(sizeof(F_Formats)/sizeof(F_Formats[0]));
+        x   = RandValue( F_Formats[k][1] );
+        snprintf( Ref, sizeof(Ref), " %*.*f", F_Formats[k][0], F_Formats[k][1], x );
+        len = Lgm_MagEphemFormat_f( Str, sizeof(Str), F_Formats[k][0], F_Formats[k][1], x );
+        if ( ( len != (int)strlen( Ref ) ) || strcmp( Str, Ref ) ) {
+            if ( nBad++ < 10 ) printf("    %%%d.%df of %.17g: got \"%s\", printf gives \"%s\"\n", F_Formats[k][0], F_Formats[k][1], x, Str, Ref );
+        }
+    }
+    fail_unless( (nBad == 0), "%d of %d values formatted differently from printf's %%f", nBad, NRANDOM );
+
+    return;
+}
+END_TEST
+
+START_TEST(test_MagEphemFormat_g_01) {
+
+    int     i, k, len, nBad = 0;
+    char    Str[512], Ref[512];
+    double  x;
+
+    printf("Checking Lgm_MagEphemFormat_g() against snprintf() for %d values\n", NRANDOM);
+    State = 0xD1B54A32D192ED03ULL;
+    for ( i=0; i<NRANDOM; i++ ) {
+        k   = i%(int)(sizeof(G_Widths)/sizeof(G_Widths[0]));
+        x   = RandValue( 6 );
+        snprintf( Ref, sizeof(Ref), " %*g", G_Widths[k], x );
+        len = Lgm_MagEphemFormat_g( Str, sizeof(Str), G_Widths[k], x );
+        if ( ( len != (int)strlen( Ref ) ) || strcmp( Str, Ref ) ) {
+            if ( nBad++ < 10 ) printf("    %%%dg of %.17g: got \"%s\", printf gives \"%s\"\n", G_Widths[k], x, Str, Ref );
+        }
+    }
+    fail_unless( (nBad == 0), "%d of %d values formatted differently from printf's %%g", nBad, NRANDOM );
+
+    return;
+}
+END_TEST
+
+START_TEST(test_MagEphemFormat_02) {
+
+    int     i, j, k;
+    char    Str[512], Ref[512];
+    double  x[] = { 0.0, -0.0, 1.0, -1.0, 0.5, -0.5, 1.5, 2.5, 0.05, 0.15, 0.25, 9.9999995, 99999.95, 999999.5,
+                    1e-5, 1e-4, 9.99999e-5, 0.000099999950, 123456.5, 1234565.0, 1e15, 1e16, 1e22, 1e23,
+                    1e300, 1e-300, 4.9e-324, 2.2250738585072014e-308, 1.7976931348623157e308, -1e31,
+                    1.0/0.0, -1.0/0.0, 0.0/0.0 };
+
+    printf("Checking Lgm_MagEphemFormat_f() and Lgm_MagEphemFormat_g() for special values\n");
+    for ( i=0; i<(int)(sizeof(x)/sizeof(x[0])); i++ ) {
+        for ( k=0; k<(int)(sizeof(F_Formats)/sizeof(F_Formats[0])); k++ ) {
+            snprintf( Ref, sizeof(Ref), " %*.*f", F_Formats[k][0], F_Formats[k][1], x[i] );
+            Lgm_MagEphemFormat_f( Str, sizeof(Str), F_Formats[k][0], F_Formats[k][1], x[i] );
+            fail_unless( !strcmp( Str, Ref ), "%%%d.%df of %.17g: got \"%s\", printf gives \"%s\"", F_Formats[k][0], F_Formats[k][1], x[i], Str, Ref );
+        }
+        for ( j=0; j<(int)(sizeof(G_Widths)/sizeof(G_Widths[0])); j++ ) {
+            snprintf( Ref, sizeof(Ref), " %*g", G_Widths[j], x[i] );
+            Lgm_MagEphemFormat_g( Str, sizeof(Str), G_Widths[j], x[i] );
+            fail_unless( !strcmp( Str, Ref ), "%%%dg of %.17g: got \"%s\", printf gives \"%s\"", G_Widths[j], x[i], Str, Ref );
+        }
+    }
+
+    return;
+}
+END_TEST
+
+/*
+ *  A row for an open field line has no Bmin, so the columns computed from
+ *  it (Lsimple, Lm_eq, BoverBeq, ...) have to be fill values, even right
+ *  after a row for a closed one.
+ */
+START_TEST(test_MagEphemWrite_OpenRow) {
+
+    int                 n, Anchor;
+    char                Line[16384], *Tok[1024], *t;
+    Lgm_MagEphemInfo    *m;
+    FILE                *fp;
+
+    printf("Checking that Lgm_WriteMagEphemData() writes fill values for Bmin quantities on open field lines\n");
+    m = Lgm_InitMagEphemInfo( 0, 2 );
+    m->Date = 20100101; m->UTC = 12.0;
+    m->P.x  = -20.0; m->P.y = 0.0; m->P.z = 5.0;
+    m->Pmin.x = 3.0; m->Pmin.y = 0.0; m->Pmin.z = 0.0;
+    m->nAlpha = 2; m->Alpha[0] = 30.0; m->Alpha[1] = 60.0;
+    m->Snorth = m->Ssouth = m->Smin = -1.0;
+    Lgm_Set_Coord_Transforms( m->Date, m->UTC, m->LstarInfo->mInfo->c );
+
+    fp = tmpfile( );
+    m->FieldLineType = LGM_CLOSED;
+    Lgm_WriteMagEphemData( fp, "IGRF", "T89", 2.0, -10.0, m );
+    m->FieldLineType = LGM_OPEN_IMF;
+    Lgm_WriteMagEphemData( fp, "IGRF", "T89", 2.0, -10.0, m );
+    rewind( fp );
+    fail_unless( ( fgets( Line, sizeof(Line), fp ) != NULL ) && ( fgets( Line, sizeof(Line), fp ) != NULL ), "Lgm_WriteMagEphemData() did not write two rows" );
+    fclose( fp );
+
+    // After the field line type come 8 distance/curvature columns, 24 for
+    // each footpoint and 7 for Pmin and Bmin, then Lsimple, InvLat, Lm_eq,
+    // InvLat_eq and BoverBeq.
+    for ( n=0, Anchor=-1, t=strtok( Line, " \n" ); ( t != NULL ) && ( n < 1024 ); t=strtok( NULL, " \n" ) ) {
+        if ( !strcmp( t, "LGM_OPEN_IMF" ) ) Anchor = n;
+        Tok[n++] = t;
+    }
+    fail_unless( ( Anchor >= 0 ) && ( Anchor+68 < n ), "Could not find the columns in the open field line row" );
+    fail_unless( ( atof( Tok[Anchor+64] ) == LGM_FILL_VALUE ), "Lsimple = %s, should be the fill value", Tok[Anchor+64] );
+    fail_unless( ( atof( Tok[Anchor+66] ) == LGM_FILL_VALUE ), "Lm_eq = %s, should be the fill value", Tok[Anchor+66] );
+    fail_unless( ( atof( Tok[Anchor+68] ) == LGM_FILL_VALUE ), "BoverBeq = %s, should be the fill value", Tok[Anchor+68] );
+    Lgm_FreeMagEphemInfo( m );
+
+    return;
+}
+END_TEST
+
+
+Suite *MagEphemWrite_suite(void) {
+
+    Suite *s  = suite_create("MAGEPHEM_WRITE_TESTS");
+    TCase *tc = tcase_create("MagEphem Text Formatting");
+    tcase_set_timeout( tc, 120 );
+    tcase_add_test(tc, test_MagEphemFormat_f_01);
+    tcase_add_test(tc, test_MagEphemFormat_g_01);
+    tcase_add_test(tc, test_MagEphemFormat_02);
+    tcase_add_test(tc, test_MagEphemWrite_OpenRow);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = MagEphemWrite_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running MagEphem Text Formatting Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,137 @@
+#include <check.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+
+/*
+ *  Field line integrator tests, in a field whose field lines are known
+ *  exactly. B = ( -y, x, 1 ) has helices around the z axis for field lines;
+ *  starting at radius r, distance s along the line turns the point through
+ *  an angle s/sqrt(r^2+1) about z and raises it by the same amount.
+ */
+
+static int HelixB( Lgm_Vector *u, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    B->x = -u->y;
+    B->y =  u->x;
+    B->z =  1.0;
+    return( 1 );
+}
+
+static void HelixExact( Lgm_Vector *u0, double s, Lgm_Vector *u ) {
+    double  r = sqrt( u0->x*u0->x + u0->y*u0->y );
+    double  t = s/sqrt( r*r + 1.0 );
+    u->x = u0->x*cos( t ) - u0->y*sin( t );
+    u->y = u0->x*sin( t ) + u0->y*cos( t );
+    u->z = u0->z + t;
+}
+
+/*
+ *  Error of one Lgm_RKCK() step of length h from u0.
+ */
+static double RKCK_StepError( Lgm_Vector *u0, double h, Lgm_MagModelInfo *mInfo ) {
+
+    Lgm_Vector  b0, v, e;
+    double      yerr[3];
+
+    HelixB( u0, &b0, mInfo );
+    Lgm_NormalizeVector( &b0 );
+    Lgm_RKCK( u0, &b0, &v, h, 1.0, yerr, HelixB, mInfo );
+    HelixExact( u0, h, &e );
+
+    return( Lgm_VecDiffMag( &v, &e ) );
+
+}
+
+Lgm_MagModelInfo    *mInfo;
+
+void MagStep_Setup(void) {
+    mInfo = Lgm_InitMagInfo();
+    return;
+}
+
+void MagStep_TearDown(void) {
+    Lgm_FreeMagInfo( mInfo );
+    return;
+}
+
+
+/*
+ *  A Cash-Karp step is 5th order, so halving the step should cut the error
+ *  of a single step by about 2^6.
+ */
+START_TEST(test_RKCK_01) {
+
+    Lgm_Vector  u0 = { 1.5, 0.0, 0.0 };
+    double      e1, e2;
+
+    printf("Checking the order of Lgm_RKCK()\n");
+    e1 = RKCK_StepError( &u0, 0.2, mInfo );
+    e2 = RKCK_StepError( &u0, 0.1, mInfo );
+    printf("    step error: %g (h=0.2) %g (h=0.1), ratio %g\n", e1, e2, e1/e2 );
+    fail_unless( (e2 < 1e-8), "Error of a Lgm_RKCK() step of 0.1 should be < 1e-8, got %g", e2 );
+    fail_unless( (e1/e2 > 40.0), "Halving the Lgm_RKCK() step should cut the error by ~64, got %g", e1/e2 );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Lgm_MagStep() with the RK5 integrator, followed for a few turns, should
+ *  stay on the exact field line to about the tolerance.
+ */
+START_TEST(test_RK5_01) {
+
+    Lgm_Vector  u, u0 = { 1.5, 0.0, 0.0 }, u_scale = { 1.0, 1.0, 1.0 }, e;
+    double      Htry = 0.1, Hdid, Hnext, s, Stot = 0.0, Err;
+    int         reset = TRUE, n = 0;
+
+    printf("Checking Lgm_MagStep() with LGM_MAGSTEP_ODE_RK5\n");
+    mInfo->Lgm_MagStep_Integrator = LGM_MAGSTEP_ODE_RK5;
+    mInfo->Lgm_MagStep_RK5_Eps    = 1e-10;
+    mInfo->Hmax                   = 1.0;
+    u = u0;
+    while ( Stot < 20.0 ) {
+        if ( Htry > 20.0 - Stot ) Htry = 20.0 - Stot;
+        fail_unless( (Lgm_MagStep( &u, &u_scale, Htry, &Hdid, &Hnext, 1.0, &s, &reset, HelixB, mInfo ) >= 0), "Lgm_MagStep() failed" );
+        Stot += Hdid;
+        Htry  = ( Hnext < mInfo->Hmax ) ? Hnext : mInfo->Hmax;
+        ++n;
+    }
+    HelixExact( &u0, Stot, &e );
+    Err = Lgm_VecDiffMag( &u, &e );
+    printf("    %d steps, error after s = %g: %g\n", n, Stot, Err );
+    fail_unless( (Err < 1e-7), "RK5 trace should be within 1e-7 of the exact field line after s = 20, got %g", Err );
+
+    return;
+}
+END_TEST
+
+
+Suite *MagStep_suite(void) {
+
+    Suite *s  = suite_create("MAGSTEP_TESTS");
+    TCase *tc = tcase_create("MagStep");
+    tcase_add_checked_fixture( tc, MagStep_Setup, MagStep_TearDown );
+    tcase_add_test(tc, test_RKCK_01);
+    tcase_add_test(tc, test_RK5_01);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = MagStep_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Field Line Integrator Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,151 @@
+#include <check.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+
+/*
+ *  Olson-Pfitzer 1988 dynamic model. The reference values come from a
+ *  straightforward evaluation of the expansions in the original monomial form
+ *  (the tail with XX**N = X**N, Y**N, Z**N, and the standoff distance going
+ *  as (n v**2)**(-1/6)), not from the Horner forms in OlsenPfitzerDynamic.c.
+ */
+
+#define OP88_TOL    1e-11
+
+static double Pos[][3] = { { 6.6, 0.0, 0.0 }, { -6.6, 2.0, 1.5 }, { -10.0, -3.0, 2.0 },
+                           { 3.0, 5.0, -4.0 }, { -25.0, 4.0, 3.0 }, { 0.5, -7.0, 6.0 } };
+
+//                       DEN,   VEL,    DST
+static double SW[][3]  = { { 5.0, 400.0, 0.0 }, { 10.0, 600.0, -50.0 }, { 20.0, 800.0, -150.0 }, { 2.0, 350.0, 10.0 } };
+
+static double STDOFF_Ref[] = { 10.171329992450893, 7.9160584495258517, 6.4075363814579704, 12.388870927310835 };
+
+static double BFTAIL_Ref[][3] = {
+        { 0.000000000000000e+00, 0.000000000000000e+00, -3.566113666283870e+00 },
+        { 1.083274241054581e+00, -7.275460082326821e-02, -1.891956739370859e+01 },
+        { 1.948862873784782e+00, 3.271496660951191e-01, -1.413685032711035e+01 },
+        { -3.952774704976784e+00, -4.603085445549577e-01, -5.102726038056469e+00 },
+        { 1.653198640826044e+01, -3.545100029386615e-01, -1.308141940984153e+00 },
+        { 8.787493041974669e+00, -1.643882266478150e+00, -5.821464190525542e+00 }
+};
+
+static double BDYN_Ref[][3] = {
+        { 0.000000000000000e+00, 0.000000000000000e+00, -3.129155250437082e+01 },
+        { 5.014172781832139e+01, -1.216011101154421e+01, -6.168841891354363e+01 },
+        { 1.845419118330224e+01, 4.485412045654734e+00, 1.739404110399978e+00 },
+        { 6.145902316087963e+00, 4.650149741036587e+01, -6.315054684625967e+01 },
+        { 2.006988315537728e+01, -4.561892998599369e-01, 2.252587132793352e+00 },
+        { 2.109012816313511e+01, 4.453220758886008e+01, -2.001918991316466e+01 },
+        { 0.000000000000000e+00, 0.000000000000000e+00, -2.050242312532662e+03 },
+        { 1.828172709599642e+03, -4.591892757195996e+02, -1.942911817150632e+03 },
+        { 5.728567175850592e+02, 1.533667781267438e+02, 3.842524228794503e+02 },
+        { 6.583200058937957e+02, 1.742866850756119e+03, -3.032287275141041e+03 },
+        { 8.027929305648675e+01, -4.886973229895284e+00, 7.198314198361626e+01 },
+        { 6.464306912443536e+01, 1.670717346955505e+03, -1.110560346097580e+03 },
+        { 0.000000000000000e+00, 0.000000000000000e+00, -5.913240088664110e+03 },
+        { 5.234879379561489e+03, -1.314527915268640e+03, -5.524837991399238e+03 },
+        { 1.643532883079159e+03, 4.377248118266049e+02, 1.113831640314409e+03 },
+        { 1.911489538403725e+03, 4.989125328284451e+03, -8.718033747614805e+03 },
+        { 1.766408622116503e+02, -1.383940984913481e+01, 2.038830127101626e+02 },
+        { 8.731628285634164e+01, 4.770929002966716e+03, -3.205570069811888e+03 },
+        { 0.000000000000000e+00, 0.000000000000000e+00, 4.771463162364363e+02 },
+        { -4.007317369794578e+02, 1.011595480205860e+02, 4.184262504367233e+02 },
+        { -1.212819085986038e+02, -3.333393487233491e+01, -9.284687874078938e+01 },
+        { -1.577394798468443e+02, -3.835347275435259e+02, 6.873632982671163e+02 },
+        { 7.663281478865560e-01, 6.467564350161752e-01, -1.616784780012604e+01 },
+        { 6.282640329887643e+00, -3.683477697946798e+02, 2.549347456115549e+02 }
+};
+
+static int Close( double a, double b ) {
+    return( fabs( a - b ) <= OP88_TOL*( 1.0 + fabs( b ) ) );
+}
+
+
+/*
+ *  The standoff distance for a nominal solar wind should be ~10 Re, and
+ *  should go down as the pressure goes up.
+ */
+START_TEST(test_OP88_01) {
+
+    int     k;
+    double  S;
+
+    printf("Checking Lgm_OP88_STDOFF()\n");
+    for ( k=0; k<4; k++ ) {
+        S = Lgm_OP88_STDOFF( SW[k][1], SW[k][0] );
+        fail_unless( Close( S, STDOFF_Ref[k] ), "Lgm_OP88_STDOFF( %g, %g ) = %.17g, should be %.17g", SW[k][1], SW[k][0], S, STDOFF_Ref[k] );
+    }
+    fail_unless( ( STDOFF_Ref[0] > 9.0 ) && ( STDOFF_Ref[0] < 11.0 ), "Standoff distance for n=5, v=400 should be ~10 Re" );
+
+    return;
+}
+END_TEST
+
+
+START_TEST(test_OP88_02) {
+
+    int     i;
+    double  XX[4], BB[4];
+
+    printf("Checking Lgm_OP88_BFTAIL() against reference values\n");
+    for ( i=0; i<6; i++ ) {
+        XX[1] = Pos[i][0]; XX[2] = Pos[i][1]; XX[3] = Pos[i][2];
+        Lgm_OP88_BFTAIL( XX, BB );
+        fail_unless( Close( BB[1], BFTAIL_Ref[i][0] ) && Close( BB[2], BFTAIL_Ref[i][1] ) && Close( BB[3], BFTAIL_Ref[i][2] ),
+                     "Lgm_OP88_BFTAIL() at ( %g, %g, %g ): got ( %.15e, %.15e, %.15e ), should be ( %.15e, %.15e, %.15e )",
+                     XX[1], XX[2], XX[3], BB[1], BB[2], BB[3], BFTAIL_Ref[i][0], BFTAIL_Ref[i][1], BFTAIL_Ref[i][2] );
+    }
+
+    return;
+}
+END_TEST
+
+
+START_TEST(test_OP88_03) {
+
+    int     i, k, j;
+    double  Bx, By, Bz;
+
+    printf("Checking Lgm_OP88_BDYN() against reference values\n");
+    for ( k=0; k<4; k++ ) {
+        for ( i=0; i<6; i++ ) {
+            j = 6*k + i;
+            Lgm_OP88_BDYN( SW[k][0], SW[k][1], SW[k][2], Pos[i][0], Pos[i][1], Pos[i][2], &Bx, &By, &Bz );
+            fail_unless( Close( Bx, BDYN_Ref[j][0] ) && Close( By, BDYN_Ref[j][1] ) && Close( Bz, BDYN_Ref[j][2] ),
+                         "Lgm_OP88_BDYN( %g, %g, %g ) at ( %g, %g, %g ): got ( %.15e, %.15e, %.15e ), should be ( %.15e, %.15e, %.15e )",
+                         SW[k][0], SW[k][1], SW[k][2], Pos[i][0], Pos[i][1], Pos[i][2], Bx, By, Bz, BDYN_Ref[j][0], BDYN_Ref[j][1], BDYN_Ref[j][2] );
+        }
+    }
+
+    return;
+}
+END_TEST
+
+
+Suite *OP88_suite(void) {
+
+    Suite *s  = suite_create("OP88_TESTS");
+    TCase *tc = tcase_create("OP88");
+    tcase_add_test(tc, test_OP88_01);
+    tcase_add_test(tc, test_OP88_02);
+    tcase_add_test(tc, test_OP88_03);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = OP88_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Olson-Pfitzer Dynamic Model Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
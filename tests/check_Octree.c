@@ -0,0 +1,268 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "../libLanlGeoMag/Lgm/Lgm_Octree.h"
+#include "check_rand.h"
+
+/*
+ *  Octree tests. The kNN search is checked against a brute force search
+ *  over the same (scaled) points, and every point is checked to lie inside
+ *  the leaf cell it was put in -- including points with a coordinate at
+ *  the top of the scaled range (exactly 1.0), which have to be put in the
+ *  last cell rather than wrap around to the first.
+ */
+
+#define NPOINTS     20000
+#define NQUERIES    300
+
+typedef struct BruteNN {
+    double              Dist2;
+    unsigned long int   Id;
+} BruteNN;
+
+static int CompareBruteNN( const void *a, const void *b ) {
+    const BruteNN *x = (const BruteNN *)a, *y = (const BruteNN *)b;
+    if ( x->Dist2 < y->Dist2 ) return( -1 );
+    if ( x->Dist2 > y->Dist2 ) return(  1 );
+    return( ( x->Id < y->Id ) ? -1 : ( x->Id > y->Id ) );
+}
+
+Lgm_Vector  *Points, *Data;
+Lgm_Octree  *Octree;
+BruteNN     *Brute;
+
+/*
+ *  Random points in [-5,5]^3 plus points on the corners and faces of the
+ *  [-6,6]^3 bounding box, so the scaled coordinates span exactly [0,1].
+ */
+void Octree_Setup(void) {
+
+    long int    j;
+
+    Points = (Lgm_Vector *)calloc( NPOINTS, sizeof(Lgm_Vector) );
+    Data   = (Lgm_Vector *)calloc( NPOINTS, sizeof(Lgm_Vector) );
+    Brute  = (BruteNN *)calloc( NPOINTS, sizeof(BruteNN) );
+    State  = 0x9E3779B97F4A7C15ULL;
+    for ( j=0; j<NPOINTS; j++ ) {
+        Points[j].x = RandUniform( -5.0, 5.0 );
+        Points[j].y = RandUniform( -5.0, 5.0 );
+        Points[j].z = RandUniform( -5.0, 5.0 );
+        Data[j].x = (double)j; Data[j].y = -(double)j; Data[j].z = 2.0*j;
+    }
+    Points[0].x =  6.0; Points[0].y =  6.0; Points[0].z =  6.0;
+    Points[1].x = -6.0; Points[1].y = -6.0; Points[1].z = -6.0;
+    Points[2].x =  6.0; Points[2].y =  0.3; Points[2].z = -1.7;
+    Points[3].x =  2.2; Points[3].y =  6.0; Points[3].z =  6.0;
+    Points[4].x = -6.0; Points[4].y =  6.0; Points[4].z =  1.1;
+
+    Octree = Lgm_InitOctree( Points, Data, NPOINTS );
+    return;
+}
+
+void Octree_TearDown(void) {
+    Lgm_FreeOctree( Octree );
+    free( Points );
+    free( Data );
+    free( Brute );
+    return;
+}
+
+/*
+ *  The nearest neighbors of q (distances in scaled units), sorted.
+ */
+static void BruteForce_kNN( Lgm_Vector *q_in, Lgm_Octree *Octree ) {
+
+    long int    j;
+    double      dx, dy, dz;
+    Lgm_Vector  q, u;
+
+    Lgm_OctreeScalePosition( q_in, &q, Octree );
+    for ( j=0; j<NPOINTS; j++ ) {
+        Lgm_OctreeScalePosition( &Points[j], &u, Octree );
+        dx = q.x - u.x; dy = q.y - u.y; dz = q.z - u.z;
+        Brute[j].Dist2 = dx*dx + dy*dy + dz*dz;
+        Brute[j].Id    = j;
+    }
+    qsort( Brute, NPOINTS, sizeof(BruteNN), CompareBruteNN );
+
+}
+
+/*
+ *  A query point. Mostly inside the cloud, some outside it, and some right
+ *  on data points (including the ones on the edges of the box).
+ */
+static void RandQuery( int i, Lgm_Vector *q ) {
+    if ( i < 5 ) {
+        *q = Points[i];
+    } else if ( i%5 == 0 ) {
+        q->x = RandUniform( -8.0, 8.0 ); q->y = RandUniform( -8.0, 8.0 ); q->z = RandUniform( -8.0, 8.0 );
+    } else if ( i%5 == 1 ) {
+        *q = Points[ Rand64()%NPOINTS ];
+    } else {
+        q->x = RandUniform( -5.0, 5.0 ); q->y = RandUniform( -5.0, 5.0 ); q->z = RandUniform( -5.0, 5.0 );
+    }
+}
+
+
+/*
+ *  Every point should be in the range of its leaf's points, and inside the
+ *  leaf's cube, and Lgm_OctreeLocateLeaf() should find that leaf.
+ */
+START_TEST(test_Octree_01) {
+
+    long int            j, c, nBad = 0;
+    unsigned long int   k, *Where;
+    Lgm_OctreeCell      *Cell;
+    Lgm_Vector          u;
+
+    printf("Checking that each point is in its Lgm_Octree leaf\n");
+    fail_unless( (Octree->Min == -6.0) && (Octree->Max == 6.0), "Octree scaling should be [-6,6], got [%g,%g]", Octree->Min, Octree->Max );
+
+    Where = (unsigned long int *)calloc( NPOINTS, sizeof(unsigned long int) );
+    for ( k=0; k<Octree->n; k++ ) Where[ Octree->Id[k] ] = k;
+
+    for ( j=0; j<NPOINTS; j++ ) {
+        Lgm_OctreeScalePosition( &Points[j], &u, Octree );
+        c    = Lgm_OctreeLocateLeaf( &u, Octree );
+        Cell = &Octree->Cells[c];
+        if ( ( Where[j] < Cell->iData ) || ( Where[j] >= Cell->iData + Cell->nData )
+                || ( fabs( u.x - Cell->Center.x ) > Cell->h ) || ( fabs( u.y - Cell->Center.y ) > Cell->h ) || ( fabs( u.z - Cell->Center.z ) > Cell->h ) ) {
+            if ( nBad++ < 10 ) printf("    point %ld (%g %g %g) is not in leaf %ld (center %g %g %g, h = %g)\n", j, u.x, u.y, u.z, c, Cell->Center.x, Cell->Center.y, Cell->Center.z, Cell->h );
+        }
+    }
+    free( Where );
+    fail_unless( (nBad == 0), "%ld of %d points are not in the leaf they were put in", nBad, NPOINTS );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  With no distance limit, Lgm_Octree_kNN() should give the same neighbors
+ *  as a brute force search, closest first.
+ */
+START_TEST(test_Octree_02) {
+
+    int             i, k, K = 12, Kgot, Flag, nBad = 0;
+    Lgm_Vector      q;
+    Lgm_OctreeData  kNN[12];
+
+    printf("Checking Lgm_Octree_kNN() against a brute force search (%d queries)\n", NQUERIES);
+    State = 0xD1B54A32D192ED03ULL;
+    for ( i=0; i<NQUERIES; i++ ) {
+        RandQuery( i, &q );
+        Flag = Lgm_Octree_kNN( &q, Octree, K, &Kgot, 100.0, kNN );
+        fail_unless( (Flag == OCTREE_KNN_SUCCESS) && (Kgot == K), "query %d: Lgm_Octree_kNN() returned %d with Kgot = %d", i, Flag, Kgot );
+        BruteForce_kNN( &q, Octree );
+        for ( k=0; k<K; k++ ) {
+            if ( ( fabs( kNN[k].Dist2 - Brute[k].Dist2 ) > 1e-15 )
+                    || ( ( kNN[k].Id != Brute[k].Id ) && ( fabs( Brute[k+1].Dist2 - Brute[k].Dist2 ) > 1e-15 ) && ( ( k == 0 ) || ( fabs( Brute[k].Dist2 - Brute[k-1].Dist2 ) > 1e-15 ) ) ) ) {
+                if ( nBad++ < 10 ) printf("    query %d, NN %d: got Id %lu (Dist2 %.17g), brute force gives Id %lu (Dist2 %.17g)\n", i, k, kNN[k].Id, kNN[k].Dist2, Brute[k].Id, Brute[k].Dist2 );
+            }
+            if ( ( kNN[k].B.x != Data[ kNN[k].Id ].x ) || ( kNN[k].B.z != Data[ kNN[k].Id ].z ) ) {
+                if ( nBad++ < 10 ) printf("    query %d, NN %d: B does not go with Id %lu\n", i, k, kNN[k].Id );
+            }
+        }
+    }
+    fail_unless( (nBad == 0), "%d kNN results differ from the brute force search", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  With a distance limit, Lgm_Octree_kNN() should give the nearest
+ *  min( K, number within MaxDist2 ) points, and say OCTREE_KNN_TOO_FEW_NNS
+ *  whenever there are fewer than K within MaxDist2.
+ */
+START_TEST(test_Octree_03) {
+
+    int             i, k, K = 12, Kgot, Flag, nIn, nTooFew = 0, nBad = 0;
+    double          MaxDist2 = 0.0025;
+    Lgm_Vector      q;
+    Lgm_OctreeData  kNN[12];
+
+    printf("Checking Lgm_Octree_kNN() with MaxDist2 = %g against a brute force search (%d queries)\n", MaxDist2, NQUERIES);
+    State = 0x2545F4914F6CDD1DULL;
+    for ( i=0; i<NQUERIES; i++ ) {
+        RandQuery( i, &q );
+        Flag = Lgm_Octree_kNN( &q, Octree, K, &Kgot, MaxDist2, kNN );
+        BruteForce_kNN( &q, Octree );
+        for ( nIn=0; ( nIn < NPOINTS ) && ( Brute[nIn].Dist2 <= MaxDist2 ); nIn++ );
+        if ( nIn < K ) ++nTooFew;
+
+        if ( ( Kgot != ( ( nIn < K ) ? nIn : K ) ) || ( Flag != ( ( nIn < K ) ? OCTREE_KNN_TOO_FEW_NNS : OCTREE_KNN_SUCCESS ) ) ) {
+            if ( nBad++ < 10 ) printf("    query %d: %d points within MaxDist2, got Kgot = %d and return %d\n", i, nIn, Kgot, Flag );
+            continue;
+        }
+        for ( k=0; k<Kgot; k++ ) {
+            if ( fabs( kNN[k].Dist2 - Brute[k].Dist2 ) > 1e-15 ) {
+                if ( nBad++ < 10 ) printf("    query %d, NN %d: got Dist2 %.17g, brute force gives %.17g\n", i, k, kNN[k].Dist2, Brute[k].Dist2 );
+            }
+        }
+    }
+    printf("    %d of %d queries had fewer than %d points within MaxDist2\n", nTooFew, NQUERIES, K );
+    fail_unless( (nTooFew > 0) && (nTooFew < NQUERIES), "MaxDist2 should leave some queries short of K neighbors (and not all)" );
+    fail_unless( (nBad == 0), "%d kNN results differ from the brute force search", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Asking for more neighbors than there are points.
+ */
+START_TEST(test_Octree_04) {
+
+    int             Kgot;
+    Lgm_Vector      q = { 0.0, 0.0, 0.0 };
+    Lgm_OctreeData  kNN[NPOINTS+1];
+    Lgm_Octree      *Small;
+
+    printf("Checking Lgm_Octree_kNN() for K > number of points\n");
+    Small = Lgm_InitOctree( Points, Data, 5 );
+    fail_unless( (Lgm_Octree_kNN( &q, Small, 6, &Kgot, 100.0, kNN ) == OCTREE_KNN_NOT_ENOUGH_DATA), "K = 6 of 5 points should give OCTREE_KNN_NOT_ENOUGH_DATA" );
+    fail_unless( (Lgm_Octree_kNN( &q, Small, 5, &Kgot, 100.0, kNN ) == OCTREE_KNN_SUCCESS) && (Kgot == 5), "K = 5 of 5 points should find them all" );
+    Lgm_FreeOctree( Small );
+
+    return;
+}
+END_TEST
+
+
+Suite *Octree_suite(void) {
+
+    Suite *s  = suite_create("OCTREE_TESTS");
+    TCase *tc = tcase_create("Octree");
+    tcase_set_timeout( tc, 60 );
+    tcase_add_checked_fixture( tc, Octree_Setup, Octree_TearDown );
+    tcase_add_test(tc, test_Octree_01);
+    tcase_add_test(tc, test_Octree_02);
+    tcase_add_test(tc, test_Octree_03);
+    tcase_add_test(tc, test_Octree_04);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = Octree_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Octree Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
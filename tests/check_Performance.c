@@ -0,0 +1,199 @@
+#include <check.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+#include "../libLanlGeoMag/Lgm/Lgm_LstarInfo.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Tasks.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Profile.h"
+
+/*
+ *  Performance regression tests. Timings are too noisy to test against, so
+ *  these count the work done instead -- field evaluations, field line traces,
+ *  drift shell field line searches and I integrals -- for a few fixed cases
+ *  and fail if any count grows past a budget. The budgets are about 1.3x
+ *  what the cases took when the tests were written; if a change makes a case
+ *  legitimately cheaper, the budget can be lowered to lock the gain in.
+ *
+ *  Field evaluations are counted by a wrapper around Lgm_B_T89() instead of
+ *  with mInfo->Lgm_nMagEvals, because the integrators reset that at the
+ *  start of each trace. Everything runs on the serial executor in
+ *  deterministic mode, so the counts do not depend on the number of threads.
+ */
+
+
+static long int     nBevals;
+
+static int CountingB_T89( Lgm_Vector *v, Lgm_Vector *B, Lgm_MagModelInfo *Info ) {
+    ++nBevals;
+    return( Lgm_B_T89( v, B, Info ) );
+}
+
+static void ResetCounters( void ) {
+    nBevals = 0;
+    Lgm_ProfileReset();
+}
+
+Lgm_MagModelInfo    *mInfo;
+Lgm_LstarInfo       *LstarInfo;
+
+void Performance_Setup(void) {
+    Lgm_SetExecutor( Lgm_SerialExecutor, NULL );
+    Lgm_SetDeterministic( TRUE );
+    Lgm_ProfileEnable( LGM_PROFILE_QUIET );
+
+    mInfo = Lgm_InitMagInfo();
+    mInfo->Kp = 2;
+    Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, LGM_EXTMODEL_T89, mInfo );
+    mInfo->Bfield = CountingB_T89;
+
+    LstarInfo = InitLstarInfo( 0 );
+    LstarInfo->VerbosityLevel = 0;
+    LstarInfo->mInfo->VerbosityLevel = 0;
+    LstarInfo->mInfo->Kp = 2;
+    Lgm_MagModelInfo_Set_MagModel( LGM_IGRF, LGM_EXTMODEL_T89, LstarInfo->mInfo );
+    LstarInfo->mInfo->Bfield = CountingB_T89;
+    return;
+}
+
+void Performance_TearDown(void) {
+    FreeLstarInfo( LstarInfo );
+    Lgm_FreeMagInfo( mInfo );
+    Lgm_SetDeterministic( FALSE );
+    return;
+}
+
+
+/*
+ *  McIlwain L for a 90 deg. particle. This is a single I integral, so here
+ *  the integrand count kept in mInfo is meaningful too.
+ */
+START_TEST(test_PERFORMANCE_01) {
+
+    long int            Date, nTrace, nI;
+    double              L, I, Bm, M, UTC;
+    Lgm_Vector          u;
+
+    long int            Budget_nBevals = 4100, Budget_nTrace = 2, Budget_nIntegrand = 520;      // took 3139, 1, 399
+
+    Date = 20090101; UTC  = 0.0; Lgm_Set_Coord_Transforms( Date, UTC, mInfo->c );
+    u.x = -4.0; u.y = 0.0; u.z = 1.0;
+    ResetCounters();
+    L = Lgm_McIlwain_L( Date, UTC, &u, 90.0, 1, &I, &Bm, &M, mInfo );
+    nTrace = Lgm_ProfileCalls( LGM_PROF_TRACE, NULL );
+    nI     = mInfo->Lgm_n_I_integrand_Calls;
+
+    printf("Test 01, Lgm_McIlwain_L(): L = %g  nBevals = %ld  nTrace = %ld  nIntegrand = %ld\n", L, nBevals, nTrace, nI );
+    fail_unless( L > 0.0, "Lgm_McIlwain_L(): Performance test failed. No L computed.\n" );
+    fail_unless( nBevals <= Budget_nBevals, "Lgm_McIlwain_L(): Performance test failed. %ld field evaluations (budget %ld).\n", nBevals, Budget_nBevals );
+    fail_unless( nTrace <= Budget_nTrace, "Lgm_McIlwain_L(): Performance test failed. %ld traces (budget %ld).\n", nTrace, Budget_nTrace );
+    fail_unless( nI <= Budget_nIntegrand, "Lgm_McIlwain_L(): Performance test failed. %ld I integrand calls (budget %ld).\n", nI, Budget_nIntegrand );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  L* at 30, 60 and 90 deg. from the same field line, Quality 3 and 24 field
+ *  lines. The budgets are per L*.
+ */
+START_TEST(test_PERFORMANCE_02) {
+
+    static const double PitchAngles[] = { 30.0, 60.0, 90.0 };
+    int                 ia;
+    long int            Date, nPerLstar, nFindShellLine, nIIntegral;
+    double              UTC, Blocal, sa;
+    Lgm_Vector          u, Bvec, v1, v2, v3;
+
+    long int            Budget_nBevals = 720000, Budget_nFindShellLine = 34, Budget_nIIntegral = 160;  // took at most 547895, 26, 124
+
+    Date = 20090101; UTC  = 0.0; Lgm_Set_Coord_Transforms( Date, UTC, LstarInfo->mInfo->c );
+    Lgm_SetLstarTolerances( 3, 24, LstarInfo );
+    u.x = -4.0; u.y = 1.0; u.z = 0.5;
+    LstarInfo->mInfo->Bfield( &u, &Bvec, LstarInfo->mInfo );
+    Blocal = Lgm_Magnitude( &Bvec );
+    fail_unless( Lgm_Trace( &u, &v1, &v2, &v3, 120.0, 0.01, 1e-7, LstarInfo->mInfo ) == LGM_CLOSED, "Lstar(): Performance test failed. Field line is not closed.\n" );
+
+    for ( ia=0; ia<3; ia++ ) {
+        sa = sin( PitchAngles[ia]*RadPerDeg );
+        LstarInfo->mInfo->Bm = Blocal/(sa*sa);
+        NewTimeLstarInfo( Date, UTC, PitchAngles[ia], CountingB_T89, LstarInfo );
+        ResetCounters();
+        fail_unless( Lstar( &v3, LstarInfo ) > 0, "Lstar(): Performance test failed. No L* computed for PA = %g.\n", PitchAngles[ia] );
+        nPerLstar      = nBevals;
+        nFindShellLine = Lgm_ProfileCalls( LGM_PROF_FINDSHELLLINE, NULL );
+        nIIntegral     = Lgm_ProfileCalls( LGM_PROF_IINTEGRAL, NULL );
+
+        printf("Test 02, Lstar(): PA = %g  L* = %g  nBevals = %ld  nFindShellLine = %ld  nIIntegral = %ld\n", PitchAngles[ia], LstarInfo->LS, nPerLstar, nFindShellLine, nIIntegral );
+        fail_unless( nPerLstar <= Budget_nBevals, "Lstar(): Performance test failed. %ld field evaluations for PA = %g (budget %ld).\n", nPerLstar, PitchAngles[ia], Budget_nBevals );
+        fail_unless( nFindShellLine <= Budget_nFindShellLine, "Lstar(): Performance test failed. %ld field line searches for PA = %g (budget %ld).\n", nFindShellLine, PitchAngles[ia], Budget_nFindShellLine );
+        fail_unless( nIIntegral <= Budget_nIIntegral, "Lstar(): Performance test failed. %ld I integrals for PA = %g (budget %ld).\n", nIIntegral, PitchAngles[ia], Budget_nIIntegral );
+    }
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Last closed drift shell at midnight for K = 0.1 (a bisection, so many L*
+ *  calculations), at a loose tolerance and low Quality so it's quick.
+ */
+START_TEST(test_PERFORMANCE_03) {
+
+    int                 Flag;
+    long int            Date, nFindShellLine;
+    double              UTC, K;
+
+    long int            Budget_nBevals = 3000000, Budget_nFindShellLine = 150;   // took 2289663, 112
+
+    Date = 20090101; UTC  = 0.0;
+    NewTimeLstarInfo( Date, UTC, 90.0, CountingB_T89, LstarInfo );
+    ResetCounters();
+    Flag           = Lgm_LCDS( Date, UTC, -4.0, -13.0, 0.1, 0.0, 0.05, 2, 12, &K, LstarInfo );
+    nFindShellLine = Lgm_ProfileCalls( LGM_PROF_FINDSHELLLINE, NULL );
+
+    printf("Test 03, Lgm_LCDS(): LCDS = %g  K = %g  nBevals = %ld  nFindShellLine = %ld\n", LstarInfo->LS, K, nBevals, nFindShellLine );
+    fail_unless( Flag == 0, "Lgm_LCDS(): Performance test failed. No LCDS found (returned %d).\n", Flag );
+    fail_unless( nBevals <= Budget_nBevals, "Lgm_LCDS(): Performance test failed. %ld field evaluations (budget %ld).\n", nBevals, Budget_nBevals );
+    fail_unless( nFindShellLine <= Budget_nFindShellLine, "Lgm_LCDS(): Performance test failed. %ld field line searches (budget %ld).\n", nFindShellLine, Budget_nFindShellLine );
+
+    return;
+}
+END_TEST
+
+
+
+Suite *Performance_suite(void) {
+
+    Suite *s = suite_create("PERFORMANCE_TESTS");
+    TCase *tc_Performance = tcase_create("Performance Budgets");
+
+    tcase_add_checked_fixture( tc_Performance, Performance_Setup, Performance_TearDown );
+    tcase_set_timeout( tc_Performance, 120.0 );
+
+    tcase_add_test( tc_Performance, test_PERFORMANCE_01 );
+    tcase_add_test( tc_Performance, test_PERFORMANCE_02 );
+    tcase_add_test( tc_Performance, test_PERFORMANCE_03 );
+
+    suite_add_tcase(s, tc_Performance);
+
+    return s;
+}
+
+
+int main(void) {
+
+    int number_failed;
+    Suite *s = Performance_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n");
+    printf("*****************************************\n");
+    printf("*  Running Performance Regression Tests *\n");
+    printf("*****************************************\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,233 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../libLanlGeoMag/Lgm/Lgm_QinDenton.h"
+
+/*
+ *  Qin-Denton interpolation, on made up QinDenton files (see
+ *  QD_WriteTestFiles()). The reference values are what the per-parameter
+ *  interpolation code (from before the QD_Fields table) gave for the same
+ *  files and times.
+ */
+
+#define QD_TOL      1e-8
+
+/*
+ *  Value of each column at time t (hours since the start of the first day)
+ *  and sample i. Everything is linear in t, so any interpolation (linear or
+ *  akima) gives the same values, but some samples are bad so that the
+ *  filters matter.
+ */
+static void QD_TestValues( int Set, int i, double t, double *v ) {
+
+    int     k;
+
+    v[0] = ( i%7 == 3 )  ?  9999.99 :  2.0 + 0.05*t;          // ByIMF
+    v[1] = ( i%11 == 5 ) ? -9999.99 : -3.0 + 0.03*t;          // BzIMF
+    v[2] = ( i%13 == 4 ) ?  9999.0  : 350.0 + 2.0*t;          // V_SW
+    v[3] = ( i%9 == 2 )  ?  0.05    :  4.0 + 0.1*t;           // Den_P
+    v[4] = ( i%10 == 7 ) ? -1.0     :  1.5 + 0.01*t;          // Pdyn
+    v[5] =  5.0 + 0.1*t;                                      // G1
+    v[6] =  8.0 + 0.05*t;                                     // G2
+    v[7] = 40.0 + 0.5*t;                                      // G3
+    v[8] = ( ( Set == 1 ) || ( i%8 == 6 ) ) ? 99.0 : 1.0 + 0.05*t;  // fKp
+    v[9] = ( i%12 == 1 ) ? -1.0 : 1.5 + 0.04*t;               // akp3
+    v[10] = -10.0 - 0.5*t;                                    // Dst
+    for ( k=1; k<=6; k++ ) {
+        v[10+k] = k + 0.01*k*t;                               // Bz1..Bz6
+        v[16+k] = 0.1*k + 0.002*t;                            // W1..W6
+    }
+
+}
+
+/*
+ *  Hourly files (values at half past each hour) for three days.
+ */
+static void QD_WriteTestFiles( const char *Dir, int Set, int Year, int Month, int Day0 ) {
+
+    FILE    *fp;
+    char    Filename[1024];
+    int     d, h, i, k;
+    double  v[23];
+
+    snprintf( Filename, 1024, "%s/%4d", Dir, Year );
+    mkdir( Filename, 0700 );
+    for ( i=0, d=0; d<3; d++ ) {
+        snprintf( Filename, 1024, "%s/%4d/QinDenton_%4d%02d%02d_1hr.txt", Dir, Year, Year, Month, Day0+d );
+        fp = fopen( Filename, "w" );
+        fprintf( fp, "# Test values\n" );
+        for ( h=0; h<24; h++, i++ ) {
+            QD_TestValues( Set, i, 24.0*d + h + 0.5, v );
+            fprintf( fp, "%4d-%02d-%02dT%02d:30:00 %4d %2d %2d %2d 30 0", Year, Month, Day0+d, h, Year, Month, Day0+d, h );
+            for ( k=0; k<8; k++ ) fprintf( fp, " %.4f", v[k] );
+            fprintf( fp, " 2 2 2 2 2 2 2 2" );
+            for ( k=8; k<23; k++ ) fprintf( fp, " %.4f", v[k] );
+            fprintf( fp, " 2 2 2 2 2 2\n" );
+        }
+        fclose( fp );
+    }
+
+}
+
+static const char *QD_TestNames[] = { "ByIMF", "BzIMF", "V_SW", "Den_P", "Pdyn", "G1", "G2", "G3", "fKp", "akp3", "Dst",
+                                      "Bz1", "Bz2", "Bz3", "Bz4", "Bz5", "Bz6", "W1", "W2", "W3", "W4", "W5", "W6" };
+
+static void QD_TestGet( Lgm_QinDentonOne *p, double *v ) {
+    v[0]  = p->ByIMF; v[1]  = p->BzIMF; v[2]  = p->V_SW; v[3]  = p->Den_P; v[4] = p->Pdyn;
+    v[5]  = p->G1;    v[6]  = p->G2;    v[7]  = p->G3;   v[8]  = p->fKp;   v[9] = p->akp3; v[10] = p->Dst;
+    v[11] = p->Bz1;   v[12] = p->Bz2;   v[13] = p->Bz3;  v[14] = p->Bz4;   v[15] = p->Bz5; v[16] = p->Bz6;
+    v[17] = p->W1;    v[18] = p->W2;    v[19] = p->W3;   v[20] = p->W4;    v[21] = p->W5;  v[22] = p->W6;
+}
+
+//                           Year Month Day  Hour    Persistence
+static double QD_TestTimes[][5] = {
+    { 2010, 1, 2,  0.0,       0 },
+    { 2010, 1, 2,  6.2916667, 0 },
+    { 2010, 1, 2, 12.0,       0 },
+    { 2010, 1, 2, 23.99,      0 },
+    { 2010, 1, 1, 12.0,       0 },
+    { 2010, 1, 3, 12.0,       0 },
+    { 2010, 1, 3, 23.75,      0 },      // after the last value
+    { 2010, 1, 3, 23.75,      1 },      //   ... with persistence
+    { 2010, 1, 1,  0.25,      0 },      // before the first value
+    { 2010, 3, 2, 12.0,       0 },      // no good Kp
+};
+#define QD_NTIMES   ( (int)(sizeof(QD_TestTimes)/sizeof(QD_TestTimes[0])) )
+
+static double QD_Ref[][23] = {
+    { 3.20000000020955, -2.28, 398, 6.4, 1.74, 7.4, 9.2, 52, 2.19999999996508, 2.46000000002794, -22, 1.24, 2.48, 3.72, 4.96, 6.2, 7.44, 0.148, 0.248, 0.348, 0.448, 0.548, 0.648 },    // 2010-01-02 00:00
+    { 3.51458333513213, -2.09124999894645, 410.583333417348, 7.02916667018241, 1.80291666701824, 8.0291666701913, 9.51458333509565, 55.1458333509565, 2.51458333543371, 2.71166666807652, -25.1458333509565, 1.30291666701913, 2.60583333403826, 3.90875000105739, 5.21166666807652, 6.51458333509565, 7.81750000211478, 0.160583333403826, 0.260583333403826, 0.360583333403826, 0.460583333403826, 0.560583333403826, 0.660583333403826 },    // 2010-01-02 06:17:30
+    { 3.80000000002328, -1.91999999998603, 422, 7.6, 1.86, 8.6, 9.8, 58, 2.80000000002328, 2.94000000002794, -28, 1.36, 2.72, 4.08, 5.44, 6.8, 8.16, 0.172, 0.272, 0.372, 0.472, 0.572, 0.672 },    // 2010-01-02 12:00
+    { 4.39949999990082, -1.56030000002474, 445.979999996982, 8.79899999955855, 1.97989999995586, 9.79899999984912, 10.3994999999246, 63.9949999992456, 3.39949999988895, 3.41959999996702, -33.9949999992456, 1.47989999998491, 2.95979999996983, 4.43969999995474, 5.91959999993965, 7.39949999992456, 8.87939999990947, 0.195979999996982, 0.295979999996982, 0.395979999996982, 0.495979999996982, 0.595979999996982, 0.695979999996982 },    // 2010-01-02 23:59:24
+    { 2.59999999996508, -2.64, 374, 5.1999999997206, 1.61999999997206, 6.2, 8.6, 46, 1.60000000002328, 1.98000000002794, -16, 1.12, 2.24, 3.36, 4.48, 5.6, 6.72, 0.124, 0.224, 0.324, 0.424, 0.524, 0.624 },    // 2010-01-01 12:00
+    { 4.99999999979045, -1.19999999987427, 470, 10, 2.1, 11, 11, 70, 4.00000000002328, 3.90000000002794, -40, 1.6, 3.2, 4.8, 6.4, 8, 9.6, 0.22, 0.32, 0.42, 0.52, 0.62, 0.72 },    // 2010-01-03 12:00
+    { 2, -2, 400, 5, 1.3380974216, 6, 10, 60, 2, 2, -5, 0, 0, 0, 0, 0, 0, 0.44, 0.42, 0.66, 0.48, 0.49, 0.91 },    // 2010-01-03 23:45 (defaults)
+    { 5.575, -9999.99, 493, 11.15, 2.215, 12.15, 11.575, 75.75, 4.575, 4.36, -45.75, 1.715, 3.43, 5.145, 6.86, 8.575, 10.29, 0.243, 0.343, 0.443, 0.543, 0.643, 0.743 },    // 2010-01-03 23:45 (persistence)
+    { 2, -2, 400, 5, 1.3380974216, 6, 10, 60, 2, 2, -5, 0, 0, 0, 0, 0, 0, 0.44, 0.42, 0.66, 0.48, 0.49, 0.91 },    // 2010-01-01 00:15 (defaults)
+    { 3.80000000002328, -1.91999999998603, 422, 7.6, 1.86, 8.6, 9.8, 58, 2, 2.94000000002794, -28, 1.36, 2.72, 4.08, 5.44, 6.8, 8.16, 0.172, 0.272, 0.372, 0.472, 0.572, 0.672 }    // 2010-03-02 12:00 (fKp default)
+};
+
+static char         QD_Dir[32];
+static Lgm_CTrans   *c;
+
+static double QD_TestJD( int i ) {
+    return( Lgm_JD( (int)QD_TestTimes[i][0], (int)QD_TestTimes[i][1], (int)QD_TestTimes[i][2], QD_TestTimes[i][3], LGM_TIME_SYS_UTC, c ) );
+}
+
+static void QD_RemoveTestFiles( const char *Dir, int Year, int Month, int Day0 ) {
+
+    char    Filename[1024];
+    int     d;
+
+    for ( d=0; d<3; d++ ) {
+        snprintf( Filename, 1024, "%s/%4d/QinDenton_%4d%02d%02d_1hr.txt", Dir, Year, Year, Month, Day0+d );
+        unlink( Filename );
+    }
+
+}
+
+void QinDenton_Setup(void) {
+    c = Lgm_init_ctrans( 0 );
+    snprintf( QD_Dir, 32, "QinDentonTestXXXXXX" );
+    fail_unless( ( mkdtemp( QD_Dir ) != NULL ), "Could not make a directory for the test files" );
+    QD_WriteTestFiles( QD_Dir, 0, 2010, 1, 1 );
+    QD_WriteTestFiles( QD_Dir, 1, 2010, 3, 1 );
+    setenv( "QIN_DENTON_PATH", QD_Dir, 1 );
+    unsetenv( "LGM_QIN_DENTON_ARCHIVE" );
+    return;
+}
+
+void QinDenton_TearDown(void) {
+    char    Dir[1024];
+    QD_RemoveTestFiles( QD_Dir, 2010, 1, 1 );
+    QD_RemoveTestFiles( QD_Dir, 2010, 3, 1 );
+    snprintf( Dir, 1024, "%s/2010", QD_Dir );
+    rmdir( Dir );
+    rmdir( QD_Dir );
+    Lgm_free_ctrans( c );
+    return;
+}
+
+
+START_TEST(test_QinDenton_01) {
+
+    int                 i, k;
+    double              v[23];
+    Lgm_QinDentonOne    p;
+
+    printf("Checking Lgm_get_QinDenton_at_JD() against reference values\n");
+    for ( i=0; i<QD_NTIMES; i++ ) {
+        Lgm_get_QinDenton_at_JD( QD_TestJD( i ), &p, 0, (int)QD_TestTimes[i][4] );
+        QD_TestGet( &p, v );
+        for ( k=0; k<23; k++ ) {
+            fail_unless( ( fabs( v[k] - QD_Ref[i][k] ) <= QD_TOL*( 1.0 + fabs( QD_Ref[i][k] ) ) ),
+                         "Time %d: %s = %.15g, should be %.15g", i, QD_TestNames[k], v[k], QD_Ref[i][k] );
+        }
+    }
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  The array version (in any order) should give exactly what the single time
+ *  version gives.
+ */
+START_TEST(test_QinDenton_02) {
+
+    int                 i, k, j;
+    double              JD[QD_NTIMES], v[23], u[23];
+    Lgm_QinDentonOne    p[QD_NTIMES], p1;
+
+    printf("Checking Lgm_get_QinDenton_at_JD_Array() against Lgm_get_QinDenton_at_JD()\n");
+    for ( i=0; i<QD_NTIMES; i++ ) JD[i] = QD_TestJD( (7*i+3)%QD_NTIMES );
+    for ( j=0; j<2; j++ ) {
+        Lgm_get_QinDenton_at_JD_Array( QD_NTIMES, JD, p, 0, j );
+        for ( i=0; i<QD_NTIMES; i++ ) {
+            Lgm_get_QinDenton_at_JD( JD[i], &p1, 0, j );
+            QD_TestGet( &p[i], v );
+            QD_TestGet( &p1, u );
+            for ( k=0; k<23; k++ ) {
+                fail_unless( ( v[k] == u[k] ), "JD = %.8f, Persistence = %d: %s = %.15g, should be %.15g", JD[i], j, QD_TestNames[k], v[k], u[k] );
+            }
+            fail_unless( ( p[i].Date == p1.Date ) && ( p[i].nPnts == p1.nPnts ), "JD = %.8f: wrong Date or nPnts", JD[i] );
+        }
+    }
+
+    return;
+}
+END_TEST
+
+
+Suite *QinDenton_suite(void) {
+
+    Suite *s  = suite_create("QINDENTON_TESTS");
+    TCase *tc = tcase_create("QinDenton");
+    tcase_add_checked_fixture( tc, QinDenton_Setup, QinDenton_TearDown );
+    tcase_add_test(tc, test_QinDenton_01);
+    tcase_add_test(tc, test_QinDenton_02);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = QinDenton_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running QinDenton Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,258 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../libLanlGeoMag/Lgm/Lgm_Tsyg2007.h"
+
+/*
+ *  TS07D coefficient lookup, on made up coefficient files (see
+ *  TS07_WriteTestFiles()). The text files, the day cache and the binary
+ *  archive all have to pick the same 5-minute file for a given time,
+ *  including minutes 58 and 59, which round up into the next hour (and at
+ *  23:58 into the next day).
+ */
+
+/*
+ *  The files that exist: day of year, hour, minute. A[1] of each file is
+ *  doy*10000 + hour*100 + minute, so it is easy to tell which was used.
+ */
+static int TS07_Files[][3] = { { 1, 23, 50 }, { 1, 23, 55 }, { 2, 0, 0 }, { 2, 0, 5 }, { 2, 0, 55 }, { 2, 1, 0 } };
+#define TS07_NFILES ( (int)(sizeof(TS07_Files)/sizeof(TS07_Files[0])) )
+
+//                              Date    Hour            Expected A[1]
+static double TS07_Times[][3] = {
+    { 20100101, 23.0 + 50.0/60.0, 12350 },
+    { 20100101, 23.0 + 57.0/60.0, 12355 },
+    { 20100101, 23.0 + 58.5/60.0, 20000 },     // into the next day
+    { 20100101, 23.0 + 59.9/60.0, 20000 },
+    { 20100102,  0.0 +  2.0/60.0, 20000 },
+    { 20100102,  0.0 + 56.9/60.0, 20055 },
+    { 20100102,  0.0 + 58.0/60.0, 20100 },     // into the next hour
+    { 20100102,  0.0 + 59.5/60.0, 20100 },
+};
+#define TS07_NTIMES ( (int)(sizeof(TS07_Times)/sizeof(TS07_Times[0])) )
+
+static char     TS07_Dir[32];
+
+static void TS07_Path( char *Filename, const char *Sub ) {
+    snprintf( Filename, 1024, "%s/%s", TS07_Dir, Sub );
+}
+
+static void TS07_WriteTailFile( const char *Sub ) {
+
+    FILE    *fp;
+    char    Filename[1024];
+    int     k;
+
+    TS07_Path( Filename, Sub );
+    fp = fopen( Filename, "w" );
+    for ( k=1; k<=80; k++ ) fprintf( fp, "%g\n", 0.001*k );
+    fclose( fp );
+
+}
+
+static void TS07_WriteTestFiles( void ) {
+
+    FILE    *fp;
+    char    Filename[1024], Sub[128];
+    int     i, j, k;
+
+    TS07_Path( Filename, "Coeffs" );            mkdir( Filename, 0700 );
+    TS07_Path( Filename, "Coeffs/2010_001" );   mkdir( Filename, 0700 );
+    TS07_Path( Filename, "Coeffs/2010_002" );   mkdir( Filename, 0700 );
+    TS07_Path( Filename, "TAIL_PAR" );          mkdir( Filename, 0700 );
+
+    for ( i=0; i<TS07_NFILES; i++ ) {
+        snprintf( Sub, 128, "Coeffs/2010_%03d/2010_%03d_%02d_%02d.par", TS07_Files[i][0], TS07_Files[i][0], TS07_Files[i][1], TS07_Files[i][2] );
+        TS07_Path( Filename, Sub );
+        fp = fopen( Filename, "w" );
+        fprintf( fp, "%d\n", TS07_Files[i][0]*10000 + TS07_Files[i][1]*100 + TS07_Files[i][2] );
+        for ( k=2; k<=101; k++ ) fprintf( fp, "%g\n", 0.01*k );
+        fclose( fp );
+    }
+
+    for ( i=1; i<=5; i++ ) {
+        snprintf( Sub, 128, "TAIL_PAR/tailamebhr%1d.par", i ); TS07_WriteTailFile( Sub );
+        for ( j=1; j<=4; j++ ) {
+            for ( k=0; k<2; k++ ) {
+                snprintf( Sub, 128, "TAIL_PAR/tailamhr_%c_%1d%1d.par", k ? 'e' : 'o', i, j ); TS07_WriteTailFile( Sub );
+            }
+        }
+    }
+
+}
+
+static void TS07_RemoveTestFiles( void ) {
+
+    char    Filename[1024], Sub[128];
+    int     i, j, k;
+
+    for ( i=0; i<TS07_NFILES; i++ ) {
+        snprintf( Sub, 128, "Coeffs/2010_%03d/2010_%03d_%02d_%02d.par", TS07_Files[i][0], TS07_Files[i][0], TS07_Files[i][1], TS07_Files[i][2] );
+        TS07_Path( Filename, Sub ); unlink( Filename );
+    }
+    for ( i=1; i<=5; i++ ) {
+        snprintf( Sub, 128, "TAIL_PAR/tailamebhr%1d.par", i ); TS07_Path( Filename, Sub ); unlink( Filename );
+        for ( j=1; j<=4; j++ ) {
+            for ( k=0; k<2; k++ ) {
+                snprintf( Sub, 128, "TAIL_PAR/tailamhr_%c_%1d%1d.par", k ? 'e' : 'o', i, j ); TS07_Path( Filename, Sub ); unlink( Filename );
+            }
+        }
+    }
+    TS07_Path( Filename, "TS07D_Coeffs.bin" );  unlink( Filename );
+    TS07_Path( Filename, "Bad.bin" );           unlink( Filename );
+    TS07_Path( Filename, "Coeffs/2010_001" );   rmdir( Filename );
+    TS07_Path( Filename, "Coeffs/2010_002" );   rmdir( Filename );
+    TS07_Path( Filename, "Coeffs" );            rmdir( Filename );
+    TS07_Path( Filename, "TAIL_PAR" );          rmdir( Filename );
+    rmdir( TS07_Dir );
+
+}
+
+void TS07_Setup(void) {
+    char    Filename[1024];
+    snprintf( TS07_Dir, 32, "TS07TestXXXXXX" );
+    fail_unless( ( mkdtemp( TS07_Dir ) != NULL ), "Could not make a directory for the test files" );
+    TS07_WriteTestFiles( );
+    setenv( "TS07_DATA_PATH", TS07_Dir, 1 );
+    TS07_Path( Filename, "NoArchive.bin" );     // so that Lgm_TS07_GetArchive() finds none
+    setenv( "LGM_TS07_ARCHIVE", Filename, 1 );
+    return;
+}
+
+void TS07_TearDown(void) {
+    TS07_RemoveTestFiles( );
+    return;
+}
+
+
+/*
+ *  Straight from the text files.
+ */
+START_TEST(test_TS07_01) {
+
+    int                 i;
+    double              A[LGM_TS07_NA+1];
+    LgmTsyg2007_Info    *t = (LgmTsyg2007_Info *)calloc( 1, sizeof(LgmTsyg2007_Info) );
+
+    printf("Checking which coefficient file Lgm_SetCoeffs_TS07() reads\n");
+    t->A = A;
+    for ( i=0; i<TS07_NTIMES; i++ ) {
+        Lgm_SetCoeffs_TS07( (long int)TS07_Times[i][0], TS07_Times[i][1], t );
+        fail_unless( ( t->A[1] == TS07_Times[i][2] ), "Date = %ld, UTC = %.6f: read file %g, should be %g",
+                     (long int)TS07_Times[i][0], TS07_Times[i][1], t->A[1], TS07_Times[i][2] );
+    }
+    free( t );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  From the day cache.
+ */
+START_TEST(test_TS07_02) {
+
+    int     i;
+    double  A[LGM_TS07_NA+1];
+
+    printf("Checking Lgm_TS07_PrefetchDay() and Lgm_TS07_CachedCoeffs()\n");
+    fail_unless( Lgm_TS07_PrefetchDay( 20100101 ) && Lgm_TS07_PrefetchDay( 20100102 ), "Lgm_TS07_PrefetchDay() found no files" );
+    for ( i=0; i<TS07_NTIMES; i++ ) {
+        A[1] = -1.0;
+        fail_unless( Lgm_TS07_CachedCoeffs( (long int)TS07_Times[i][0], TS07_Times[i][1], A ), "Date = %ld, UTC = %.6f: not in the day cache",
+                     (long int)TS07_Times[i][0], TS07_Times[i][1] );
+        fail_unless( ( A[1] == TS07_Times[i][2] ), "Date = %ld, UTC = %.6f: day cache gave file %g, should be %g",
+                     (long int)TS07_Times[i][0], TS07_Times[i][1], A[1], TS07_Times[i][2] );
+    }
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  From an archive. Then an archive whose index points past the last record
+ *  has to give NULL for that slot rather than reading past the end.
+ */
+START_TEST(test_TS07_03) {
+
+    int                     i;
+    long int                nRecords;
+    char                    Filename[1024], BadFilename[1024];
+    const double            *A;
+    unsigned char           *Buf;
+    Lgm_TS07_ArchiveHeader  h;
+    Lgm_TS07_Archive        *a;
+    FILE                    *fp;
+    int32_t                 Bad;
+
+    printf("Checking Lgm_TS07_BuildArchive() and Lgm_TS07_ArchiveCoeffs()\n");
+    TS07_Path( Filename, "TS07D_Coeffs.bin" );
+    nRecords = Lgm_TS07_BuildArchive( TS07_Dir, 20100101, 20100102, Filename );
+    fail_unless( ( nRecords == TS07_NFILES ), "Lgm_TS07_BuildArchive() wrote %ld records, should be %d", nRecords, TS07_NFILES );
+    fail_unless( ( (a = Lgm_TS07_OpenArchive( Filename )) != NULL ), "Could not open %s", Filename );
+    for ( i=0; i<TS07_NTIMES; i++ ) {
+        A = Lgm_TS07_ArchiveCoeffs( a, (long int)TS07_Times[i][0], TS07_Times[i][1] );
+        fail_unless( ( A != NULL ), "Date = %ld, UTC = %.6f: not in the archive", (long int)TS07_Times[i][0], TS07_Times[i][1] );
+        fail_unless( ( A[0] == TS07_Times[i][2] ), "Date = %ld, UTC = %.6f: archive gave file %g, should be %g",
+                     (long int)TS07_Times[i][0], TS07_Times[i][1], A[0], TS07_Times[i][2] );
+    }
+    fail_unless( ( Lgm_TS07_ArchiveCoeffs( a, 20100101, 12.0 ) == NULL ), "A slot with no file should give NULL" );
+    h = *a->Header;
+    Buf = (unsigned char *)malloc( a->Size );
+    memcpy( Buf, a->Base, a->Size );
+    Lgm_TS07_CloseArchive( a );
+
+    // point the 2010-01-02 00:00 slot past the last record
+    Bad = (int32_t)h.nRecords;
+    memcpy( Buf + h.IndexOffset + LGM_TS07_SLOTS_PER_DAY*sizeof(int32_t), &Bad, sizeof(int32_t) );
+    TS07_Path( BadFilename, "Bad.bin" );
+    fp = fopen( BadFilename, "wb" );
+    fwrite( Buf, 1, h.DataOffset + h.nRecords*LGM_TS07_NA*sizeof(double), fp );
+    fclose( fp );
+    free( Buf );
+    fail_unless( ( (a = Lgm_TS07_OpenArchive( BadFilename )) != NULL ), "Could not open %s", BadFilename );
+    fail_unless( ( Lgm_TS07_ArchiveCoeffs( a, 20100102, 0.0 ) == NULL ), "An index entry past the last record should give NULL" );
+    fail_unless( ( Lgm_TS07_ArchiveCoeffs( a, 20100102, 1.0 ) != NULL ), "The other slots should still be there" );
+    Lgm_TS07_CloseArchive( a );
+
+    return;
+}
+END_TEST
+
+
+Suite *TS07_suite(void) {
+
+    Suite *s  = suite_create("TS07_TESTS");
+    TCase *tc = tcase_create("TS07 Coefficients");
+    tcase_add_checked_fixture(tc, TS07_Setup, TS07_TearDown);
+    tcase_add_test(tc, test_TS07_01);
+    tcase_add_test(tc, test_TS07_02);
+    tcase_add_test(tc, test_TS07_03);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = TS07_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running TS07 Coefficient Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,378 @@
+#include <check.h>
+#include "../libLanlGeoMag/Lgm/Lgm_MagModelInfo.h"
+
+/*
+ *  Tsyganenko model regression tests. The fields of T89 (at each Kp), T96,
+ *  T01S, T02 and TS04 at a fixed set of points, parameters and epochs are
+ *  compared against values from the original (unsplit, per-call) versions
+ *  of the models. The models keep per-epoch/per-parameter state between
+ *  calls, so the same calls are also made in an interleaved order (every
+ *  call a different epoch, model or parameter set than the last) and
+ *  through the batched routines, and must give the same answers.
+ *
+ *  The internal field is the centered dipole, so only the external models
+ *  are being compared.
+ */
+
+#define NPOINTS     7
+#define NEPOCHS     2
+#define NCASES      19
+
+enum { TSYG_T89, TSYG_T96, TSYG_T01S, TSYG_T02, TSYG_TS04 };
+
+typedef struct TsygCase {
+    int     Model;
+    int     Kp;
+    double  P, Dst, By, Bz, G1, G2, G3, W[6];
+} TsygCase;
+
+static const Lgm_Vector Points[NPOINTS] = {
+    { -6.6,  0.0,  0.0 }, { -10.0,  3.0,  1.5 }, { 5.0, -2.0, 1.0 },
+    { -3.0, -4.0, -2.0 }, {   0.5,  1.0,  3.5 }, { -8.0, -5.0, 3.0 },
+    { 13.0,  4.0, -2.0 }    // (outside the magnetopause)
+};
+
+static const long int   Dates[NEPOCHS] = { 20050115, 20050715 };
+static const double     UTCs[NEPOCHS]  = { 6.0, 18.5 };
+
+#define TSYG_QUIET  2.0,  -10.0,  2.0,   1.5,  3.0, 1.2,  2.5, { 0.1, 0.2, 0.15, 0.3, 0.25, 0.5 }
+#define TSYG_STORM  6.5, -120.0, -5.0, -12.0, 12.0, 9.0, 30.0, { 2.5, 3.1, 1.9,  4.2, 2.7,  6.3 }
+#define TSYG_STORM2 6.5, -120.0,  5.0, -12.0, 12.0, 9.0, 30.0, { 2.5, 3.1, 1.9,  4.2, 2.7,  6.3 }     // (only By differs)
+
+static const TsygCase Cases[NCASES] = {
+    { TSYG_T89,  0, TSYG_QUIET }, { TSYG_T89, 1, TSYG_QUIET }, { TSYG_T89, 2, TSYG_QUIET }, { TSYG_T89, 3, TSYG_QUIET },
+    { TSYG_T89,  4, TSYG_QUIET }, { TSYG_T89, 5, TSYG_QUIET }, { TSYG_T89, 7, TSYG_QUIET },
+    { TSYG_T96,  0, TSYG_QUIET }, { TSYG_T96,  0, TSYG_STORM }, { TSYG_T96,  0, TSYG_STORM2 },
+    { TSYG_T01S, 0, TSYG_QUIET }, { TSYG_T01S, 0, TSYG_STORM }, { TSYG_T01S, 0, TSYG_STORM2 },
+    { TSYG_T02,  0, TSYG_QUIET }, { TSYG_T02,  0, TSYG_STORM }, { TSYG_T02,  0, TSYG_STORM2 },
+    { TSYG_TS04, 0, TSYG_QUIET }, { TSYG_TS04, 0, TSYG_STORM }, { TSYG_TS04, 0, TSYG_STORM2 }
+};
+
+static void SetCase( const TsygCase *t, Lgm_MagModelInfo *m ) {
+
+    int i;
+
+    m->InternalModel = LGM_CDIP;
+    switch ( t->Model ) {
+        case TSYG_T89:  m->Bfield = Lgm_B_T89;  break;
+        case TSYG_T96:  m->Bfield = Lgm_B_T96;  break;
+        case TSYG_T01S: m->Bfield = Lgm_B_T01S; break;
+        case TSYG_T02:  m->Bfield = Lgm_B_T02;  break;
+        case TSYG_TS04: m->Bfield = Lgm_B_TS04; break;
+    }
+    m->Kp  = t->Kp;
+    m->P   = t->P;
+    m->Dst = t->Dst;
+    m->By  = t->By;
+    m->Bz  = t->Bz;
+    m->G1  = t->G1;
+    m->G2  = t->G2;
+    m->G3  = t->G3;
+    for ( i=0; i<6; i++ ) m->W[i] = t->W[i];
+
+}
+
+/*
+ *  B (nT, GSM) from the original model code, Ref[Epoch][Case][Point].
+ */
+static const double Ref[NEPOCHS][NCASES][NPOINTS][3] = {
+    {
+        { { 123.64028427395944, -1.6919274851330359e-14, 75.460930685111663 }, { 44.752524914693183, -15.889956516717824, 8.2281395499733243 },
+          { 61.871064658716115, -66.821091959830028, 192.61935661132523 }, { -108.3238371439711, -18.653420910921344, 138.35699719346161 },
+          { -493.70981968533863, -370.87943422057651, -786.29691077515508 }, { 45.749520003577814, 35.587627062348744, 1.4238347711098358 },
+          { -12.195225209329811, 11.241303465933644, 30.597931449762008 } },
+        { { 129.10044038657782, -1.6919274851330359e-14, 73.022716513329158 }, { 48.239721149550576, -16.620971447898292, 7.5912111976891969 },
+          { 60.066404163553415, -66.93085726229522, 193.23945840493121 }, { -107.1721526973722, -20.103654601211574, 132.38227623348033 },
+          { -491.98246497384031, -370.82181445962112, -787.96487818856542 }, { 48.634704458038215, 36.679137579301425, 0.65103649248142581 },
+          { -18.623621859474099, 12.915339817579234, 36.203729735910713 } },
+        { { 135.77745719656187, -1.6919274851330359e-14, 71.458913878531405 }, { 51.325575342114476, -17.766556941427122, 8.2511092946874562 },
+          { 55.948556810945547, -66.189105348180192, 191.60394418447362 }, { -105.94452454466189, -21.296405769634621, 125.21103727483228 },
+          { -491.01629495344457, -370.65451445522706, -788.88682009296235 }, { 52.340136994329981, 38.930550624344122, -0.33974457529312119 },
+          { -26.225939853580961, 13.20654330786523, 36.542319175677221 } },
+        { { 144.08513309409585, -1.6919274851330359e-14, 69.006013784542105 }, { 55.764972102343194, -18.77567884002449, 6.8500302512190725 },
+          { 55.054088292535987, -66.662692556041492, 191.15633614918448 }, { -105.65893687052993, -24.740147993657718, 116.72591995574157 },
+          { -489.6703248746141, -370.81066758862335, -791.35707783852683 }, { 55.981817298251514, 40.494156188704338, -1.3841476972424402 },
+          { -34.730953551760187, 14.080522295459183, 38.986151270678647 } },
+        { { 153.91981611244748, -1.6919274851330359e-14, 69.815078274739278 }, { 58.890124112668786, -19.868906409322332, 9.5981634592293421 },
+          { 58.628017568542838, -67.4575613726565, 186.66100359947146 }, { -103.27447570898067, -27.744816479348998, 106.3234417882523 },
+          { -485.69132488355626, -371.80667834588894, -799.94237688955366 }, { 60.121095929791494, 42.786466368457006, -1.0949871258861119 },
+          { -39.069806158795558, 14.116527157970168, 37.042446928271829 } },
+        { { 173.6679208191139, -1.6919274851330359e-14, 66.025913384804028 }, { 66.50998211547784, -21.403338748467569, 8.6592053775753755 },
+          { 63.05226136369739, -68.782008758605599, 181.79247209919924 }, { -99.609085839859418, -36.255240150175922, 86.120850297391868 },
+          { -480.45554932129363, -371.99315472617741, -810.06341718468991 }, { 68.030873919861847, 46.038837452197555, -4.8094606319160391 },
+          { -36.485791672090507, 17.81979185997324, 36.312671411605379 } },
+        { { 173.6679208191139, -1.6919274851330359e-14, 66.025913384804028 }, { 66.50998211547784, -21.403338748467569, 8.6592053775753755 },
+          { 63.05226136369739, -68.782008758605599, 181.79247209919924 }, { -99.609085839859418, -36.255240150175922, 86.120850297391868 },
+          { -480.45554932129363, -371.99315472617741, -810.06341718468991 }, { 68.030873919861847, 46.038837452197555, -4.8094606319160391 },
+          { -36.485791672090507, 17.81979185997324, 36.312671411605379 } },
+        { { 140.15342861620192, 0.61940364809878967, 73.773973352157896 }, { 54.04689004146374, -17.74996093028842, 6.4280816473456515 },
+          { 73.063956644214812, -68.464065158482697, 186.22513852249102 }, { -98.378079906716394, -17.517212877522141, 120.53868053804115 },
+          { -480.78218799586551, -367.76716976437467, -793.68378570694051 }, { 54.599570466565467, 40.135366361597811, -1.1153156402201052 },
+          { -0.25353895722183495, 2.4518288446928538, 1.7990289108155828 } },
+        { { 233.30661913210233, -1.459615138064434, 50.597204301321767 }, { 97.612671812177467, -30.209308991307594, -1.7543963653574846 },
+          { 135.22289565063522, -96.081769305473316, 154.19137704221058 }, { -79.231401680684399, -38.007680027451698, 22.787158142443786 },
+          { -423.12923773211514, -357.53434242344315, -910.29720557101541 }, { 97.44958732262711, 59.336178322661326, -16.555528931596164 },
+          { -0.25353895722183495, -6.2723635204599102, -14.910517597756641 } },
+        { { 233.30661911414131, 1.4596151632151129, 50.597204310423756 }, { 98.017120018487731, -27.922753406623517, -1.659825379053002 },
+          { 134.41242480405427, -90.24555910799485, 154.01126037429313 }, { -80.085513982275359, -34.763543462944924, 23.101815052434347 },
+          { -422.80921483428426, -352.71829215977328, -910.08806854814179 }, { 96.68721325752216, 61.683621147323628, -16.916701455029965 },
+          { -0.25353895722183495, 6.7918608879005244, -16.689667858672156 } },
+        { { 142.19048363125583, 2.1858046660817791, 74.829174253824306 }, { 56.30839550580319, -15.991569072181825, 5.4658030648789406 },
+          { 64.884742976578565, -66.870107291980489, 190.16508406317803 }, { -102.28040860551792, -15.862528535603438, 128.18350282798667 },
+          { -486.13146788066729, -360.71578234727912, -796.662891316019 }, { 55.197011280375946, 36.3633247396995, 0.33802201946948696 },
+          { -0.038260418629606718, 0.86500743201342623, 0.64274308872298036 } },
+        { { 221.86378928798334, 1.1390665721506856, 51.449529530107505 }, { 103.02217720745114, -24.166236152294637, -4.4498200046816745 },
+          { 80.344098556223543, -80.163286187064813, 181.22046424803497 }, { -90.590044135043826, -42.542266611428872, 57.998141546185352 },
+          { -459.21537614365667, -353.51911537664245, -872.91461587263291 }, { 98.38889330483363, 43.145729948373933, -16.961555286140577 },
+          { -0.038260418629606718, -2.5261307987558048, -6.0411110651231734 } },
+        { { 221.86378928798334, 6.1578550336891471, 51.449529530107505 }, { 103.02217720745114, -19.147447690756174, -4.4498200046816745 },
+          { 80.344098556223543, -75.14449772552635, 181.22046424803497 }, { -90.590044135043826, -37.523478149890408, 57.998141546185352 },
+          { -459.21537614365667, -348.50032691510398, -872.91461587263291 }, { 98.38889330483363, 48.16451840991239, -16.961555286140577 },
+          { -0.038260418629606718, 2.4926576627826567, -6.0411110651231734 } },
+        { { 140.90725079506245, 0.62791729568053667, 73.463898227926407 }, { 57.543558257399035, -16.517911357381305, 7.5997190619981518 },
+          { 59.512720440134586, -65.704122116709669, 189.46562547528046 }, { -100.24698235640832, -16.117199238054063, 127.60066045552705 },
+          { -487.44813093951404, -366.6580379664465, -786.26183388231118 }, { 57.666860015123923, 36.22045082593543, 0.69304095096813523 },
+          { -0.038260418629606718, 0.33176743201342607, 0.24281308872298002 } },
+        { { 214.55380646402949, -2.1115296451862595, 42.460557906709909 }, { 105.46163714501355, -25.899689718212592, -6.0797758935892841 },
+          { 69.051883464679605, -77.237564643862697, 178.9653375707542 }, { -85.474783246628093, -29.856529204205863, 55.317342817240075 },
+          { -460.60959953748318, -357.82140224244887, -854.6635220888362 }, { 101.95064164187471, 43.750487358486275, -18.08692790919298 },
+          { -0.038260418629606718, -3.0846923372173443, -7.3816587574308663 } },
+        { { 214.55380646402949, 4.0243818932752786, 42.460557906709909 }, { 105.46163714501355, -19.763778179751053, -6.0797758935892841 },
+          { 69.051883464679605, -71.101653105401169, 178.9653375707542 }, { -85.474783246628093, -23.720617665744324, 55.317342817240075 },
+          { -460.60959953748318, -351.68549070398734, -854.6635220888362 }, { 101.95064164187471, 49.88639889694781, -18.08692790919298 },
+          { -0.038260418629606718, 3.0512192012441952, -7.3816587574308663 } },
+        { { 139.32382295019505, 2.228368231705379, 73.366536422100069 }, { 56.43685438544891, -16.143737300139787, 4.0904099850076072 },
+          { 61.46453894473693, -65.581947231887327, 192.23659228439297 }, { -103.00074458369447, -16.358511853893205, 131.3557924380203 },
+          { -488.63362129317915, -361.63181779008994, -795.41127646720258 }, { 56.30394181055398, 36.273056847071558, -1.1767355729314755 },
+          { -0.038260418629606718, 0.88833543201342557, 0.66023908872297987 } },
+        { { 214.44653090669374, 1.8812338646045474, 61.42551235229547 }, { 103.61076787029819, -20.505671623327128, -2.4966912441843565 },
+          { 76.137276286520503, -74.165703052101847, 166.34089025140213 }, { -92.876271063311236, -48.571165022932448, 59.322520736679891 },
+          { -450.72587188214061, -344.54556802264193, -870.67853311427814 }, { 99.584546731007578, 39.220738555640274, -13.865046398540478 },
+          { -0.038260418629606718, -2.2794165679865745, -5.4489969112770194 } },
+        { { 214.44653090669374, 6.4065938646045479, 61.42551235229547 }, { 103.61076787029819, -15.980311623327129, -2.4966912441843565 },
+          { 76.137276286520503, -69.640343052101855, 166.34089025140213 }, { -92.876271063311236, -44.045805022932441, 59.322520736679891 },
+          { -450.72587188214061, -340.02020802264195, -870.67853311427814 }, { 99.584546731007578, 43.746098555640273, -13.865046398540478 },
+          { -0.038260418629606718, 2.2459434320134259, -5.4489969112770194 } }
+    },
+    {
+        { { -122.82472709265544, 1.6835020957557498e-14, 75.562116828444204 }, { -26.952522749527866, 10.446519965246271, 16.295377811340778 },
+          { -213.15393006583957, 128.89950751307674, 97.875680626310128 }, { -104.77485310663241, -263.85052613516751, 23.269983817512063 },
+          { 94.256310164172561, -441.83617581948999, -1033.5856405842458 }, { 2.15055331093181, -6.6858469323860863, 19.65877884902304 },
+          { 10.284044372449266, -8.6528730458031333, 37.855758813503911 } },
+        { { -128.29480817725582, 1.6835020957557498e-14, 73.099350092179094 }, { -31.57499722570634, 11.515790083463074, 15.399596435567567 },
+          { -211.67175345723504, 129.6502779188678, 98.670229642197427 }, { -107.73267687248052, -265.35163039597938, 20.10959702768772 },
+          { 94.986033664134226, -442.53533608878348, -1037.7535154069412 }, { 0.08311179618114739, -7.3953993385365298, 17.772746676660262 },
+          { 13.143679227361702, -10.276634681005749, 43.859852043819458 } },
+        { { -134.96796588860551, 1.6835020957557498e-14, 71.514127173419496 }, { -34.202452189806394, 12.613309878578363, 16.466972740745113 },
+          { -208.55605786770082, 129.44678923492953, 96.108522384957595 }, { -111.80236964732431, -267.94501942420681, 14.632191690008508 },
+          { 93.84824218173766, -443.39665775628066, -1047.3563245140099 }, { 0.41753711260404236, -7.7747381175740404, 17.455810748927725 },
+          { 18.809949289540651, -10.353612138103895, 46.251504664687232 } },
+        { { -143.29593091295405, 1.6835020957557498e-14, 69.040019006527018 }, { -40.362972367937601, 14.103747116949243, 14.903697925803389 },
+          { -206.52029791201247, 130.03442895663608, 95.095064025253208 }, { -116.24948475875324, -270.84830255782617, 10.109795839277993 },
+          { 94.626662821963578, -444.33363379139917, -1054.124753929814 }, { 1.6719117911641681, -6.8776060974370576, 15.517084238323278 },
+          { 22.390762989233195, -11.458784468593461, 51.002453136769383 } },
+        { { -153.16310279441137, 1.6835020957557498e-14, 69.826945621705448 }, { -43.794992614457854, 15.684402604257834, 19.502932338212041 },
+          { -209.82241395392353, 131.2364866199477, 89.908097377553261 }, { -123.91273697761766, -276.80952307095407, 3.3980302209922186 },
+          { 91.247075509657009, -446.08560561051581, -1067.8400171370868 }, { -5.8362425790335823, -12.102659650427466, 18.958177544830274 },
+          { 23.730643900449973, -11.98355456440045, 51.01405976879041 } },
+        { { -172.94724650737072, 1.6835020957557498e-14, 66.020230606389305 }, { -52.06486815791277, 17.707536086386011, 21.630053818452637 },
+          { -214.10281153912874, 132.97958790424244, 86.094228643719973 }, { -136.62305673847354, -283.70175864309016, -11.568342936168179 },
+          { 83.835573353182156, -448.97185947676303, -1087.9166842419081 }, { -12.451153688070383, -15.757345644994334, 21.52927480362057 },
+          { 19.221652020476039, -15.148857397332275, 46.378678128049366 } },
+        { { -172.94724650737072, 1.6835020957557498e-14, 66.020230606389305 }, { -52.06486815791277, 17.707536086386011, 21.630053818452637 },
+          { -214.10281153912874, 132.97958790424244, 86.094228643719973 }, { -136.62305673847354, -283.70175864309016, -11.568342936168179 },
+          { 83.835573353182156, -448.97185947676303, -1087.9166842419081 }, { -12.451153688070383, -15.757345644994334, 21.52927480362057 },
+          { 19.221652020476039, -15.148857397332275, 46.378678128049366 } },
+        { { -139.39824777721265, 0.61940364809882176, 73.817319234962739 }, { -37.096405949305279, 14.515864557826566, 15.873834892822854 },
+          { -218.83989401011544, 131.52005928891765, 91.705802990391732 }, { -115.03436994692386, -269.21299473801736, 16.528039823895522 },
+          { 97.437645746118704, -442.47846789935892, -1042.7106351477639 }, { -1.2767449214180679, -10.966975330262949, 18.564427949290184 },
+          { 0.10634571134596271, 2.6286203867768156, 1.7073955528517537 } },
+        { { -232.73221391062822, -1.459615138064509, 50.461543294573303 }, { -77.155923908204485, 27.291554030395805, 13.121429192152496 },
+          { -255.14964081780289, 139.48527744731999, 41.922064201154029 }, { -160.35947730196705, -327.68681165284096, -51.601810339329113 },
+          { 115.48739072279547, -464.99369272053076, -1151.5525480297845 }, { 15.448031898686507, -17.236046486581643, 17.136425373446471 },
+          { 0.10634571134596271, -6.0955719783759479, -15.00215095572047 } },
+        { { -232.73221389263429, 1.4596151632150378, 50.461543303744513 }, { -76.751475681579294, 29.578109610691872, 13.216000180417776 },
+          { -255.96011165227804, 145.32148765261275, 41.741947536882471 }, { -161.2135896001945, -324.44267507890521, -51.287153433147189 },
+          { 115.80741362215358, -460.1776424328072, -1151.3434110154237 }, { 14.685657843105497, -14.888603657765858, 16.775252852176965 },
+          { 0.10634571134596271, 6.9686524299844868, -16.781301216635981 } },
+        { { -141.45580330168093, -0.42144250647342119, 74.938792474181454 }, { -41.776793560328031, 13.035310796519749, 10.931106739845424 },
+          { -212.80330470003503, 130.99710043218755, 91.472904532609689 }, { -105.13305173766889, -272.20368918552964, 21.242019809148019 },
+          { 113.03790703270364, -439.57913806901354, -1044.6039138212525 }, { 2.9556922411832578, -3.5469276913689223, 14.587913822176759 },
+          { 0.017426316828209387, 0.89254005443874629, 0.62613331085062285 } },
+        { { -221.30862758660984, -6.1620033779468075, 51.578657933762628 }, { -85.143961757240263, 15.07171653452354, 9.618729654365179 },
+          { -213.11209593234909, 140.8445905574072, 62.563450851661052 }, { -164.89035840636933, -299.41619204042894, -11.42305596594187 },
+          { 139.16969710461478, -444.26037087657392, -1127.4326536433123 }, { 43.082144599805275, 2.1003806337539768, 3.6715599355110022 },
+          { 0.017426316828209387, -2.4985981763304848, -6.0577208429955292 } },
+        { { -221.30862758660984, -1.143214916408346, 51.578657933762628 }, { -85.143961757240263, 20.090504996062002, 9.618729654365179 },
+          { -213.11209593234909, 145.86337901894566, 62.563450851661052 }, { -164.89035840636933, -294.39740357889048, -11.42305596594187 },
+          { 139.16969710461478, -439.24158241503545, -1127.4326536433123 }, { 43.082144599805275, 7.11916909529244, 3.6715599355110022 },
+          { 0.017426316828209387, 2.5201902852079767, -6.0577208429955292 } },
+        { { -140.13191029546681, 0.06985273764560461, 73.531692752657506 }, { -41.64403109424525, 12.819400042555721, 15.324528089598765 },
+          { -209.15912511963234, 128.47134080491779, 91.711465307778965 }, { -107.92840191656589, -268.66582888609639, 19.758629504694287 },
+          { 109.23821937507421, -440.67776368129154, -1041.7671457407225 }, { -1.1503087654505233, -6.1894576826616055, 16.359593444419978 },
+          { 0.017426316828209387, 0.35930005443874613, 0.2262033108506234 } },
+        { { -213.84557347870299, -4.0232946980694919, 42.439973750495597 }, { -85.084702701102231, 16.809070472186406, 8.2142369782303462 },
+          { -207.05516239500173, 132.0189322738326, 60.576727274548745 }, { -143.57175914524399, -297.85684293538372, -24.746598931587634 },
+          { 144.02215948364864, -446.72149335714658, -1122.4605064175059 }, { 15.921855321477357, -1.4668393223792773, 1.8227338370196939 },
+          { 0.017426316828209387, -3.0571597147920238, -7.3982685353032238 } },
+        { { -213.84557347870299, 2.1126168403920467, 42.439973750495597 }, { -85.084702701102231, 22.944982010647944, 8.2142369782303462 },
+          { -207.05516239500173, 138.15484381229416, 60.576727274548745 }, { -143.57175914524399, -291.7209313969222, -24.746598931587627 },
+          { 144.02215948364864, -440.58558181868506, -1122.4605064175059 }, { 15.921855321477357, 4.6690722160822613, 1.8227338370196975 },
+          { 0.017426316828209387, 3.0787518236695153, -7.3982685353032238 } },
+        { { -138.54479319613725, -0.42933103755745744, 73.483891175429321 }, { -36.674525636125999, 13.149487797905806, 12.191389790434551 },
+          { -210.56877547389865, 131.01432588105087, 92.776412483535921 }, { -105.2200234073313, -270.57953790746524, 21.024947339870273 },
+          { 117.43596163113943, -436.86359725674163, -1045.0319749467931 }, { 5.3871164229690596, -3.0026876311980688, 15.871414877192867 },
+          { 0.017426316828209387, 0.91586805443874564, 0.64362931085062236 } },
+        { { -213.90510983389441, -6.3968724238750108, 61.534460556185465 }, { -93.862572137654766, 15.710468651277921, 6.5085075023330923 },
+          { -210.05006550173704, 136.13132253924937, 54.467159154222614 }, { -151.76203488004941, -299.59168657657386, -11.398427785338761 },
+          { 163.9237929854136, -438.04036565973365, -1123.58988458059 }, { 45.404936267698758, 11.290572468420082, -1.6774880517133397 },
+          { 0.017426316828209387, -2.251883945561254, -5.4656066891493751 } },
+        { { -213.90510983389441, -1.8715124238750112, 61.534460556185465 }, { -93.862572137654766, 20.23582865127792, 6.5085075023330923 },
+          { -210.05006550173704, 140.65668253924937, 54.467159154222614 }, { -151.76203488004941, -295.06632657657383, -11.398427785338761 },
+          { 163.9237929854136, -433.51500565973367, -1123.58988458059 }, { 45.404936267698758, 15.815932468420081, -1.6774880517133397 },
+          { 0.017426316828209387, 2.2734760544387465, -5.4656066891493751 } }
+    }
+};
+
+static int Close( Lgm_Vector *B, const double *R ) {
+    double  Bmag = sqrt( R[0]*R[0] + R[1]*R[1] + R[2]*R[2] );
+    return( ( fabs( B->x - R[0] ) <= 1e-10*Bmag ) && ( fabs( B->y - R[1] ) <= 1e-10*Bmag ) && ( fabs( B->z - R[2] ) <= 1e-10*Bmag ) );
+}
+
+Lgm_MagModelInfo    *mInfo;
+
+void Tsyganenko_Setup(void) {
+    mInfo = Lgm_InitMagInfo();
+    return;
+}
+
+void Tsyganenko_TearDown(void) {
+    Lgm_FreeMagInfo( mInfo );
+    return;
+}
+
+
+/*
+ *  One model and parameter set at a time.
+ */
+START_TEST(test_Tsyganenko_01) {
+
+    int         e, k, i, nBad = 0;
+    Lgm_Vector  v, B;
+
+    printf("Checking T89, T96, T01S, T02 and TS04 against the original model code\n");
+    for ( e=0; e<NEPOCHS; e++ ) {
+        Lgm_Set_Coord_Transforms( Dates[e], UTCs[e], mInfo->c );
+        for ( k=0; k<NCASES; k++ ) {
+            SetCase( &Cases[k], mInfo );
+            for ( i=0; i<NPOINTS; i++ ) {
+                v = Points[i];
+                mInfo->Bfield( &v, &B, mInfo );
+                if ( !Close( &B, Ref[e][k][i] ) ) {
+                    if ( nBad++ < 10 ) printf("    epoch %d, case %d, point %d: got (%.15g, %.15g, %.15g), expected (%.15g, %.15g, %.15g)\n",
+                                              e, k, i, B.x, B.y, B.z, Ref[e][k][i][0], Ref[e][k][i][1], Ref[e][k][i][2] );
+                }
+            }
+        }
+    }
+    fail_unless( (nBad == 0), "%d field values differ from the original model code", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  The same calls, but changing the epoch (i.e. only the tilt) on every
+ *  call, and the model or parameters every NEPOCHS calls.
+ */
+START_TEST(test_Tsyganenko_02) {
+
+    int         e, k, i, nBad = 0;
+    Lgm_Vector  v, B;
+
+    printf("Checking T89, T96, T01S, T02 and TS04 with the epoch, model and parameters changing between calls\n");
+    for ( i=0; i<NPOINTS; i++ ) {
+        for ( k=NCASES-1; k>=0; k-- ) {
+            SetCase( &Cases[k], mInfo );
+            for ( e=0; e<NEPOCHS; e++ ) {
+                Lgm_Set_Coord_Transforms( Dates[e], UTCs[e], mInfo->c );
+                v = Points[i];
+                mInfo->Bfield( &v, &B, mInfo );
+                if ( !Close( &B, Ref[e][k][i] ) ) {
+                    if ( nBad++ < 10 ) printf("    epoch %d, case %d, point %d: got (%.15g, %.15g, %.15g), expected (%.15g, %.15g, %.15g)\n",
+                                              e, k, i, B.x, B.y, B.z, Ref[e][k][i][0], Ref[e][k][i][1], Ref[e][k][i][2] );
+                }
+            }
+        }
+    }
+    fail_unless( (nBad == 0), "%d field values differ from the original model code", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  The batched versions of the models that have them.
+ */
+START_TEST(test_Tsyganenko_03) {
+
+    int         e, k, i, nBad = 0;
+    double      x[NPOINTS], y[NPOINTS], z[NPOINTS], bx[NPOINTS], by[NPOINTS], bz[NPOINTS];
+    Lgm_Vector  B;
+
+    printf("Checking Lgm_B_Batch() for T89, T96 and TS04 against the original model code\n");
+    for ( i=0; i<NPOINTS; i++ ) { x[i] = Points[i].x; y[i] = Points[i].y; z[i] = Points[i].z; }
+    for ( e=0; e<NEPOCHS; e++ ) {
+        Lgm_Set_Coord_Transforms( Dates[e], UTCs[e], mInfo->c );
+        for ( k=0; k<NCASES; k++ ) {
+            if ( ( Cases[k].Model == TSYG_T01S ) || ( Cases[k].Model == TSYG_T02 ) ) continue;
+            SetCase( &Cases[k], mInfo );
+            fail_unless( Lgm_B_Batch( NPOINTS, x, y, z, bx, by, bz, mInfo ), "Lgm_B_Batch() failed for case %d", k );
+            for ( i=0; i<NPOINTS; i++ ) {
+                B.x = bx[i]; B.y = by[i]; B.z = bz[i];
+                if ( !Close( &B, Ref[e][k][i] ) ) {
+                    if ( nBad++ < 10 ) printf("    epoch %d, case %d, point %d: got (%.15g, %.15g, %.15g), expected (%.15g, %.15g, %.15g)\n",
+                                              e, k, i, B.x, B.y, B.z, Ref[e][k][i][0], Ref[e][k][i][1], Ref[e][k][i][2] );
+                }
+            }
+        }
+    }
+    fail_unless( (nBad == 0), "%d batched field values differ from the original model code", nBad );
+
+    return;
+}
+END_TEST
+
+
+Suite *Tsyganenko_suite(void) {
+
+    Suite *s  = suite_create("TSYGANENKO_TESTS");
+    TCase *tc = tcase_create("Tsyganenko");
+    tcase_add_checked_fixture( tc, Tsyganenko_Setup, Tsyganenko_TearDown );
+    tcase_add_test(tc, test_Tsyganenko_01);
+    tcase_add_test(tc, test_Tsyganenko_02);
+    tcase_add_test(tc, test_Tsyganenko_03);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = Tsyganenko_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Tsyganenko Model Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
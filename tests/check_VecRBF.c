@@ -0,0 +1,210 @@
+#include <check.h>
+#include "../libLanlGeoMag/Lgm/Lgm_RBF.h"
+
+/*
+ *  Lgm_Vec_RBF_Init2() fits B and E with one factorization of the RBF
+ *  matrix. It should give the same weights as fitting each of them with
+ *  Lgm_Vec_RBF_Init(), and the same weights as the two separate fits gave
+ *  before the factorization was shared (RBF_Ref).
+ */
+
+#define RBF_TOL     1e-9
+
+#define RBF_N   16
+
+/*
+ *  RBF_N points (spaced about 1 apart) with made up B and E fields at them.
+ */
+static void RBF_TestData( Lgm_Vector *v, Lgm_Vector *B, Lgm_Vector *E, unsigned long int *I, double *ex, double *ey, double *ez, double eps ) {
+
+    int     i;
+    double  x, y, z;
+
+    for ( i=0; i<RBF_N; i++ ) {
+        x = v[i].x = 3.0 + (i%4) + 0.1*sin( 1.0*i );
+        y = v[i].y = -1.5 + (i/4) + 0.1*cos( 2.0*i );
+        z = v[i].z = 0.4*sin( 3.0*i );
+        B[i].x = y*z + 1.0;  B[i].y = x - z*z;    B[i].z = 0.5*x*y - 3.0;
+        E[i].x = sin( x );   E[i].y = cos( y )*z;    E[i].z = x + y + z;
+        I[i]   = 1000 + i;
+        ex[i]  = eps*( 1.0 + 0.01*i );
+        ey[i]  = eps*( 1.0 + 0.02*i );
+        ez[i]  = eps*( 1.0 + 0.03*i );
+    }
+
+}
+
+//                           RBF                   DoPoly  eps
+static double RBF_Tests[][3] = { { LGM_RBF_GAUSSIAN,     0, 0.5 },
+                                 { LGM_RBF_GAUSSIAN,     1, 0.5 },
+                                 { LGM_RBF_MULTIQUADRIC, 1, 1.0 } };
+#define RBF_NTESTS  ( (int)(sizeof(RBF_Tests)/sizeof(RBF_Tests[0])) )
+
+/*
+ *  Weights (cx_new, cy_new, cz_new, then gx_new, gy_new, gz_new with the
+ *  polynomial) from two calls to Lgm_Vec_RBF_Init() from before the B and E
+ *  fits shared the factorization.
+ */
+static double RBF_Ref[RBF_NTESTS][2][3][RBF_N+8] = {
+    {   // Gaussian
+        {   // B
+            { 6.771880307960239e-01, -1.829003473470413e-01, 1.136157374359788e+00, -1.739203682945221e-01, 6.760372357648817e-01, -4.332616018573683e-01, 3.091558584439412e-01, 2.661491999165115e-01, 2.050515467926862e-01, 8.031930173743825e-02, 4.745126129623460e-01, 1.218407595419034e-01, -3.150287888624998e-01, 1.748355100561361e+00, -1.195177072334860e+00, 1.633403042300998e+00 },
+            { 1.183456791347243e+00, 1.916696588551166e+00, 5.035144702792849e-01, 3.927754322104841e+00, 6.962512390314729e-01, 1.671166799276006e-01, 3.764690986331943e-01, 1.883761701842456e+00, 5.808048130909623e-01, 5.408199688334749e-01, 1.035607798118373e+00, 8.318360534654521e-01, 1.577093397891247e+00, 1.716607945049690e+00, 1.185439167512631e+00, 4.405671496084540e+00 },
+            { -3.289498642087048e+00, -3.252923804955880e+00, -1.240516871804490e+00, -6.795371739804429e+00, -2.806274681614124e-01, 1.261200652947401e+00, 3.192043063875478e-01, 1.740608559214708e+00, -1.120795209551620e+00, -1.367021382692795e+00, -1.065822130052746e+00, -2.441045377203104e+00, -2.437671361200692e-01, 1.035856511665530e+00, 8.517661036462305e-01, 2.449913359212164e+00 },
+        },
+        {   // E
+            { 4.116381964742921e-01, -4.771580490690345e-01, -6.356457443297465e-01, 2.262685308687531e-01, 4.216131600280462e-01, -4.041921433305105e-01, -2.839614106085290e-01, 1.698843150180509e-01, -9.314295183610798e-02, -8.466850554835205e-02, -1.477609540192567e-01, -1.710068597890942e-01, 4.846280956085713e-01, -6.135340918045721e-01, -6.113725026362561e-01, 2.071838806722318e-01 },
+            { 1.275658050237629e-01, -3.978598730553304e-01, 4.267650378963103e-01, -3.162579769129815e-01, -1.174050288441886e-01, 4.985740042100472e-01, -4.852446959458250e-01, 3.317362418349987e-01, -7.345152370481020e-01, 9.617264757256059e-01, -8.834420633687694e-01, 5.653066167276133e-01, 3.094364118727959e-01, -4.616958679609539e-01, 4.428742740660208e-01, -2.697517298482773e-01 },
+            { -2.854651759303274e-01, 1.062990922082174e+00, -1.355576550264236e-01, 2.623588468812178e+00, 9.059262268837073e-01, 1.570056167474232e+00, -9.852693140170561e-02, 3.041755884687488e+00, -1.408213640261550e-01, 4.704946158709506e-01, 7.716032416560447e-01, 6.220378279007933e-01, 2.612081429859137e+00, 3.472182027913735e+00, 1.156624145977476e+00, 6.282013648587841e+00 },
+        }
+    },
+    {   // Gaussian, with the polynomial
+        {   // B
+            { -6.692448749288862e-17, 7.513476650277695e-17, -3.266767438332520e-16, 3.656936434313018e-16, 2.299971455018421e-16, -2.388232646344049e-16, 5.264948145086739e-16, -5.842411802721852e-16, -1.891378163979479e-16, 3.713010581527784e-16, -5.902416671492162e-16, 4.337305508293050e-16, 6.430187201884591e-17, -2.428524141024083e-16, 2.725200571877718e-16, -1.002763342509926e-16, 1.000000000000000e+00, 3.546864913386745e-17, 1.106699774511821e-17, 9.999999999999998e-01, -4.511644590559978e-18, 7.423517527565833e-18, -4.296559978897302e-18, 1.632163906994565e-17 },
+            { -3.038252005277005e-02, 5.426604139914241e-02, -5.550913434025978e-02, 7.232685826666377e-02, 7.337725716236493e-02, -3.167707874582353e-02, 5.176175496289875e-02, -4.674313856906374e-02, -7.575129225437151e-02, 9.129112935429697e-03, -8.894965925312814e-02, -4.327903249529089e-02, 2.947601700876559e-02, -1.886138285653826e-03, 4.370881129392432e-02, 4.013214096717201e-02, -7.981054589585231e-02, -3.896073627769332e-03, -6.071907320268650e-02, 2.227453015871925e-02, 9.989897257184454e-01, -2.615174904863596e-03, 5.144604477773540e-03, -2.821292174222220e-03 },
+            { -2.340445137154689e-17, -4.736539745960040e-16, 1.554984100150595e-15, -1.119876895151239e-15, 1.853469745568373e-16, -1.631513972306444e-16, -1.178898987018556e-15, 8.709753492610019e-16, -2.028989358714330e-16, 4.506034738067346e-16, 3.759654256505847e-16, -9.135341281750091e-17, 7.312700424917759e-17, -2.394622261964843e-16, 1.576478450745567e-16, -1.759498924960766e-16, -3.000000000000000e+00, 1.118374682615139e-15, 1.634671157840892e-18, -2.002143945493735e-15, 2.601347197614045e-17, -3.078583459062648e-16, 5.000000000000000e-01, 5.257821801900571e-16 },
+        },
+        {   // E
+            { 7.492244916320354e-01, -9.567807415153379e-01, -8.817135036013028e-02, 5.449409083478335e-01, -1.002351908394240e-01, 1.030579690786414e-01, 1.175905308059298e-01, -1.019561470938668e-01, -1.528311981725132e-01, -1.019659492685883e-01, -2.231141140546570e-02, -2.830463250613973e-01, 9.932854331912666e-02, 4.454891625558712e-02, -4.969628615916211e-02, 1.983032404367316e-01, 3.310868774771370e-01, -4.311432541584352e+00, -3.163754267673288e-01, -1.171970777454363e-01, -1.907542386215429e-01, 9.924668728736356e-01, 5.846404842662054e-02, -3.640995515289744e-03 },
+            { -7.641637821039560e-02, -3.385243892884369e-01, 6.705470613578376e-01, -5.132116491339017e-01, 4.900391368866731e-01, -3.282609126996252e-01, 1.164166934547439e-01, 1.631559778877412e-01, -5.404837624164053e-01, 6.878171403669664e-01, -7.065458105481779e-01, 3.549049733827915e-01, 2.085376565518738e-01, -4.367031934163970e-01, 5.149791464126655e-01, -2.662516905879533e-01, 1.987753969698918e-01, 1.230893397931303e+00, -1.870271987161702e-02, -8.305399086980791e-01, -4.654550982776660e-02, -1.062842716076598e-01, 4.995934822042436e-03, 1.057854659232109e-01 },
+            { -9.934167765772478e-16, 9.801523542113828e-16, -5.530412091928365e-16, 2.322671842163178e-16, 1.953986156147399e-15, -1.408440656111809e-15, 2.299737942597612e-15, -2.229496665939709e-15, -2.109724316107186e-15, 1.629760545389344e-15, -3.060813358267184e-15, 3.133470340529159e-15, 7.727190770518205e-16, -1.072769068503125e-15, 1.708836622849459e-15, -1.283228172293398e-15, 6.913113970246661e-16, 9.999999999999982e-01, 1.000000000000001e+00, -9.142960563168398e-17, 9.999999999999999e-01, 3.582659484355197e-16, -1.635461875711968e-16, 5.469435759248636e-17 },
+        }
+    },
+    {   // multiquadric, with the polynomial
+        {   // B
+            { 6.547510394755217e-17, 1.154379421536400e-16, 3.000355838009612e-16, -5.383563904101958e-16, -3.803959623672462e-16, 1.771994910645631e-16, -5.865232728850239e-16, 9.525109671339985e-16, 2.828348204599956e-16, -4.129896232095551e-16, 7.614412790749568e-16, -7.856722605405166e-16, -7.648554210294096e-17, 3.242317146308091e-16, -3.974540006070605e-16, 1.987101498560626e-16, 1.000000000000000e+00, 2.414159660533736e-16, 4.690292947443148e-17, 9.999999999999994e-01, -6.109337484178958e-18, -4.398978907176586e-17, -1.513555114430035e-17, 8.908618670822009e-17 },
+            { 6.223618328632608e-02, -5.325270012338447e-02, 7.498699924565341e-02, -8.768800537908478e-02, -1.237212403397602e-01, 3.633882869515738e-03, -8.762744640356680e-02, 4.471322492471728e-02, 1.098342990818320e-01, -2.641147464934692e-03, 1.323776946394087e-01, 7.803281179641651e-02, -3.773129316869767e-02, 8.117869979446586e-03, -5.960200341379295e-02, -6.166912953009483e-02, -3.152379470131381e-02, 4.723194677692284e-02, -5.448089081408763e-02, 2.270147549007083e-02, 1.004124261052445e+00, -1.371093350595900e-02, 4.311617168174936e-03, -3.188161672733755e-03 },
+            { 6.818182390270678e-17, 6.739258290959216e-16, -2.644922704105851e-15, 1.784138060964934e-15, -3.004002483046446e-16, 4.667469612633352e-16, 1.997511926379827e-15, -1.215531741905658e-15, 2.882728519406842e-16, -9.451040098434880e-16, -4.409326662192665e-16, -3.493554013231933e-17, -1.075312858032551e-16, 4.879562567085903e-16, -4.164675250663228e-16, 3.390920111248037e-16, -3.000000000000000e+00, 6.976177538480132e-16, -4.951960440232538e-17, -1.681844409418002e-15, -1.480477647920643e-17, -2.251209474705428e-16, 5.000000000000000e-01, 4.591016907721925e-16 },
+        },
+        {   // E
+            { -1.140516479954005e+00, 1.592749689866625e+00, 2.556600865864997e-01, -8.789424686532501e-01, 3.871437417709905e-02, -1.989801186047060e-01, -3.051895222535185e-01, 1.031009044668992e-01, 3.341231486711635e-01, 1.623078514032334e-02, -4.534269806348123e-02, 5.304513032497041e-01, -1.735615513498546e-01, 4.367267322991697e-02, 1.766805381906651e-01, -3.488506647000801e-01, 9.144436553306448e-01, -3.747101424660481e+00, -3.121787933197311e-01, -5.081504603905622e-02, -1.885756900766478e-01, 8.652396464630839e-01, 5.307774642708332e-02, -1.547062285585678e-02 },
+            { 8.994745949789375e-02, 6.615910613369538e-01, -1.286511241928090e+00, 8.939777487521565e-01, -7.624566445899197e-01, 4.887917405787849e-01, -4.396005493709053e-02, -2.756957743966908e-01, 8.189302069933541e-01, -1.082113710133035e+00, 1.179015410873101e+00, -6.074436649620618e-01, -3.158190064520070e-01, 6.964337378287437e-01, -9.056569384621231e-01, 4.509696700000307e-01, 3.436362388938854e-01, 1.173859502714521e+00, 5.189868100951584e-03, -7.928631908510863e-01, -9.532926703637400e-02, -1.030447026500225e-01, 2.000613196608578e-03, 1.033079580720648e-01 },
+            { 1.296638939614758e-16, -2.928381108181587e-15, 4.537760789874093e-15, -1.756560750509201e-15, -9.678049531079293e-17, 2.076047537141877e-15, -3.887580796523241e-15, 1.149282314926432e-15, 1.113849037851700e-15, -1.008709935753568e-15, 7.714803178825912e-16, -3.110152991456709e-16, -6.184775278224583e-16, 1.753488002077070e-16, 6.621375786259997e-16, -8.064357225352141e-18, -1.058167948129599e-16, 9.999999999999971e-01, 1.000000000000000e+00, -1.025465070333716e-15, 9.999999999999999e-01, 6.436104952948224e-16, -4.608993450309353e-17, 2.681061904813959e-16 },
+        }
+    }
+};
+
+/*
+ *  Number of differences between the weights of two fits (exact if Tol is 0).
+ */
+static int RBF_Diff( Lgm_Vec_RBF_Info *a, Lgm_Vec_RBF_Info *b, double Tol ) {
+
+    int     i, k, nBad = 0;
+    double  *ca[3] = { a->cx_new, a->cy_new, a->cz_new }, *cb[3] = { b->cx_new, b->cy_new, b->cz_new };
+    double  *ga[3] = { a->gx_new, a->gy_new, a->gz_new }, *gb[3] = { b->gx_new, b->gy_new, b->gz_new };
+
+    for ( k=0; k<3; k++ ) {
+        for ( i=0; i<a->n; i++ ) if ( fabs( ca[k][i] - cb[k][i] ) > Tol*( 1.0 + fabs( cb[k][i] ) ) ) ++nBad;
+        if ( a->DoPoly ) {
+            for ( i=0; i<8; i++ ) if ( fabs( ga[k][i] - gb[k][i] ) > Tol*( 1.0 + fabs( gb[k][i] ) ) ) ++nBad;
+        }
+    }
+
+    return( nBad );
+
+}
+
+static int RBF_DiffRef( Lgm_Vec_RBF_Info *a, double r[3][RBF_N+8] ) {
+
+    int     i, k, nBad = 0;
+    double  *ca[3] = { a->cx_new, a->cy_new, a->cz_new }, *ga[3] = { a->gx_new, a->gy_new, a->gz_new };
+
+    for ( k=0; k<3; k++ ) {
+        for ( i=0; i<RBF_N; i++ ) if ( fabs( ca[k][i] - r[k][i] ) > RBF_TOL*( 1.0 + fabs( r[k][i] ) ) ) ++nBad;
+        if ( a->DoPoly ) {
+            for ( i=0; i<8; i++ ) if ( fabs( ga[k][i] - r[k][RBF_N+i] ) > RBF_TOL*( 1.0 + fabs( r[k][RBF_N+i] ) ) ) ++nBad;
+        }
+    }
+
+    return( nBad );
+
+}
+
+
+/*
+ *  The fused fit against two separate ones. These are the same operations,
+ *  so they should agree exactly. The last case (Wendland, same eps's for
+ *  every point) goes through the sparse solve.
+ */
+START_TEST(test_VecRBF_01) {
+
+    int                 t, RBF, DoPoly, i;
+    unsigned long int   I[RBF_N];
+    double              ex[RBF_N], ey[RBF_N], ez[RBF_N];
+    Lgm_Vector          v[RBF_N], B[RBF_N], E[RBF_N];
+    Lgm_Vec_RBF_Info    *rb, *re, *rb1, *re1;
+
+    printf("Checking Lgm_Vec_RBF_Init2() against two calls to Lgm_Vec_RBF_Init()\n");
+    for ( t=0; t<=RBF_NTESTS; t++ ) {
+        if ( t < RBF_NTESTS ) {
+            RBF_TestData( v, B, E, I, ex, ey, ez, RBF_Tests[t][2] );
+            RBF = (int)RBF_Tests[t][0]; DoPoly = (int)RBF_Tests[t][1];
+        } else {
+            RBF_TestData( v, B, E, I, ex, ey, ez, 0.25 );
+            for ( i=0; i<RBF_N; i++ ) ex[i] = ey[i] = ez[i] = 0.25;
+            RBF = LGM_RBF_WENDLAND31; DoPoly = 0;
+        }
+        rb  = Lgm_Vec_RBF_Init2( I, v, B, E, ex, ey, ez, RBF_N, DoPoly, RBF, &re );
+        rb1 = Lgm_Vec_RBF_Init( I, v, B, ex, ey, ez, RBF_N, DoPoly, RBF );
+        re1 = Lgm_Vec_RBF_Init( I, v, E, ex, ey, ez, RBF_N, DoPoly, RBF );
+        fail_unless( ( RBF_Diff( rb, rb1, 0.0 ) == 0 ), "Case %d: B weights from Lgm_Vec_RBF_Init2() differ from Lgm_Vec_RBF_Init()'s", t );
+        fail_unless( ( RBF_Diff( re, re1, 0.0 ) == 0 ), "Case %d: E weights from Lgm_Vec_RBF_Init2() differ from Lgm_Vec_RBF_Init()'s", t );
+        Lgm_Vec_RBF_Free( rb ); Lgm_Vec_RBF_Free( re );
+        Lgm_Vec_RBF_Free( rb1 ); Lgm_Vec_RBF_Free( re1 );
+    }
+
+    return;
+}
+END_TEST
+
+
+START_TEST(test_VecRBF_02) {
+
+    int                 t;
+    unsigned long int   I[RBF_N];
+    double              ex[RBF_N], ey[RBF_N], ez[RBF_N];
+    Lgm_Vector          v[RBF_N], B[RBF_N], E[RBF_N];
+    Lgm_Vec_RBF_Info    *rb, *re;
+
+    printf("Checking Lgm_Vec_RBF_Init2() against the weights from separate B and E fits\n");
+    for ( t=0; t<RBF_NTESTS; t++ ) {
+        RBF_TestData( v, B, E, I, ex, ey, ez, RBF_Tests[t][2] );
+        rb = Lgm_Vec_RBF_Init2( I, v, B, E, ex, ey, ez, RBF_N, (int)RBF_Tests[t][1], (int)RBF_Tests[t][0], &re );
+        fail_unless( ( RBF_DiffRef( rb, RBF_Ref[t][0] ) == 0 ), "Case %d: %d B weights differ from the reference values", t, RBF_DiffRef( rb, RBF_Ref[t][0] ) );
+        fail_unless( ( RBF_DiffRef( re, RBF_Ref[t][1] ) == 0 ), "Case %d: %d E weights differ from the reference values", t, RBF_DiffRef( re, RBF_Ref[t][1] ) );
+        Lgm_Vec_RBF_Free( rb ); Lgm_Vec_RBF_Free( re );
+    }
+
+    return;
+}
+END_TEST
+
+
+Suite *VecRBF_suite(void) {
+
+    Suite *s  = suite_create("VEC_RBF_TESTS");
+    TCase *tc = tcase_create("Vec RBF");
+    tcase_add_test(tc, test_VecRBF_01);
+    tcase_add_test(tc, test_VecRBF_02);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = VecRBF_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Vector RBF Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -1,5 +1,7 @@
 #include <check.h>
 #include "../libLanlGeoMag/Lgm/Lgm_CTrans.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Quat.h"
+#include "../libLanlGeoMag/Lgm/Lgm_Eop.h"
 
 /*BEGIN Leap seconds test case*/
 Lgm_CTrans *c;
@@ -53,6 +55,170 @@ START_TEST(test_GetLeapSeconds) {
 END_TEST // END Leap seconds test case
 
 
+/*BEGIN Coordinate transforms test case*/
+void ctrans_setup(void) {
+    c = Lgm_init_ctrans( 0 );
+    return;
+}
+
+void ctrans_teardown(void) {
+    Lgm_free_ctrans( c ) ;
+    return;
+}
+
+START_TEST(test_Agsm_to_wgs84) {
+
+    int      i, j, n;
+    double   A[3][3];
+    long int Dates[] = { 20050115, 20130704 };
+    double   UTCs[]  = { 6.0, 18.5 };
+
+    printf("Check that Agsm_to_wgs84 = Amod_to_wgs84 * Agsm_to_mod, on the first and a later call of Lgm_Set_Coord_Transforms()\n");
+    for ( n=0; n<2; n++ ) {
+        Lgm_Set_Coord_Transforms( Dates[n], UTCs[n], c );
+        Lgm_MatTimesMat( c->Amod_to_wgs84, c->Agsm_to_mod, A );
+        for ( i=0; i<3; i++ ) {
+            for ( j=0; j<3; j++ ) {
+                fail_unless( fabs( c->Agsm_to_wgs84[i][j] - A[i][j] ) < 1e-14, "Date %ld: Agsm_to_wgs84[%d][%d] = %g, should be %g", Dates[n], i, j, c->Agsm_to_wgs84[i][j], A[i][j] );
+                fail_unless( c->Awgs84_to_gsm[j][i] == c->Agsm_to_wgs84[i][j], "Date %ld: Awgs84_to_gsm should be the transpose of Agsm_to_wgs84", Dates[n] );
+            }
+        }
+    }
+
+  return;
+}
+END_TEST // END Coordinate transforms test case
+
+
+/*BEGIN Quaternion test case*/
+START_TEST(test_QuatToAxisAngle) {
+
+    int         i;
+    double      Q[4], Angle, Angles[] = { 120.0, 1.0, 0.01, 1e-6 };
+    Lgm_Vector  u, v;
+
+    printf("Check that Lgm_QuatToAxisAngle() gives back the angle and axis given to Lgm_AxisAngleToQuat(), down to small angles\n");
+    u.x = 1.0; u.y = -2.0; u.z = 0.5;
+    Lgm_NormalizeVector( &u );
+    for ( i=0; i<4; i++ ) {
+        Lgm_AxisAngleToQuat( &u, Angles[i], Q );
+        Lgm_QuatToAxisAngle( Q, &Angle, &v );
+        fail_unless( fabs( Angle - Angles[i] ) < 1e-12*Angles[i], "Angle = %.15g, should be %.15g", Angle, Angles[i] );
+        fail_unless( Lgm_VecDiffMag( &u, &v ) < 1e-12, "Axis for %g degrees is off by %g", Angles[i], Lgm_VecDiffMag( &u, &v ) );
+    }
+
+  return;
+}
+END_TEST
+
+START_TEST(test_QuatExp) {
+
+    double  Q[4] = { 0.0, 0.0, 0.0, 0.0 }, expQ[4];
+
+    printf("Check that Lgm_QuatExp() of a zero quaternion is the identity\n");
+    Lgm_QuatExp( Q, expQ );
+    fail_unless( (expQ[0] == 0.0) && (expQ[1] == 0.0) && (expQ[2] == 0.0) && (expQ[3] == 1.0),
+                 "exp(0) = ( %g, %g, %g, %g ), should be ( 0, 0, 0, 1 )", expQ[0], expQ[1], expQ[2], expQ[3] );
+
+  return;
+}
+END_TEST // END Quaternion test case
+
+
+/*BEGIN EOP test case*/
+START_TEST(test_read_eop) {
+
+    long int    i, nBad = 0;
+    Lgm_Eop     *e, *f;
+
+    printf("Check that Lgm_read_eop() gives the same values when it has to grow the arrays\n");
+    e = Lgm_init_eop( 0 );
+    Lgm_read_eop( e );
+    fail_unless( (e->nEopVals > 365), "Only %ld EOP values were read", e->nEopVals );
+
+    // start f with room for one value, so Lgm_read_eop() has to grow it
+    f = (Lgm_Eop *)calloc( 1, sizeof(Lgm_Eop) );
+    f->Size = 1;
+    f->Date = (long int *)calloc( 1, sizeof(long int) );
+    f->MJD  = (double *)calloc( 1, sizeof(double) );
+    f->xp   = (double *)calloc( 1, sizeof(double) );
+    f->yp   = (double *)calloc( 1, sizeof(double) );
+    f->DUT1 = (double *)calloc( 1, sizeof(double) );
+    f->LOD  = (double *)calloc( 1, sizeof(double) );
+    f->dPsi = (double *)calloc( 1, sizeof(double) );
+    f->dEps = (double *)calloc( 1, sizeof(double) );
+    f->dX   = (double *)calloc( 1, sizeof(double) );
+    f->dY   = (double *)calloc( 1, sizeof(double) );
+    f->DAT  = (double *)calloc( 1, sizeof(double) );
+    Lgm_read_eop( f );
+
+    fail_unless( (f->nEopVals == e->nEopVals), "Read %ld EOP values, should be %ld", f->nEopVals, e->nEopVals );
+    fail_unless( (f->Size >= f->nEopVals), "Size = %ld, but %ld values were read", f->Size, f->nEopVals );
+    for ( i=0; i<e->nEopVals; i++ ) {
+        if ( ( f->Date[i] != e->Date[i] ) || ( f->MJD[i] != e->MJD[i] ) || ( f->DUT1[i] != e->DUT1[i] ) || ( f->DAT[i] != e->DAT[i] ) ) ++nBad;
+    }
+    fail_unless( (nBad == 0), "%ld EOP values differ", nBad );
+    Lgm_destroy_eop( f );
+    Lgm_destroy_eop( e );
+
+  return;
+}
+END_TEST // END EOP test case
+
+
+/*BEGIN JPL ephemeris test case*/
+START_TEST(test_JPL_CopyCTrans) {
+
+    Lgm_CTrans  *c, *t;
+
+    printf("Check that Lgm_CopyCTrans() gives the copy its own DE ephemeris\n");
+    c = Lgm_init_ctrans( 0 );
+    Lgm_Set_CTrans_Options( LGM_EPH_DE, LGM_PN_IAU76, c );
+    Lgm_Set_Coord_Transforms( 20100101, 12.0, c );
+    fail_unless( c->jpl_initialized && (c->jpl != NULL), "The DE ephemeris was not opened" );
+
+    t = Lgm_CopyCTrans( c );
+    fail_unless( (t->jpl != c->jpl), "The copy shares the source's DE ephemeris" );
+    Lgm_Set_Coord_Transforms( 20100101, 12.0, t );
+    fail_unless( Lgm_VecDiffMag( &t->Sun, &c->Sun ) == 0.0, "The copy gives a different Sun vector" );
+    Lgm_free_ctrans( t );
+
+    // the source still has its ephemeris
+    Lgm_Set_Coord_Transforms( 20100102, 12.0, c );
+    Lgm_free_ctrans( c );
+
+  return;
+}
+END_TEST
+
+START_TEST(test_JPL_Nutation) {
+
+    int                 Pass;
+    Lgm_Vector          u;
+    Lgm_JPLephemInfo    *jpl;
+
+    printf("Check that the nutations (two axes) are evaluated within their own coefficients\n");
+    for ( Pass=0; Pass<2; Pass++ ) {
+        jpl = Lgm_InitJPLephemInfo( 421, LGM_DE_LIBR_NUT, 0 );
+        if ( Pass == 0 ) {
+            fail_unless( Lgm_OpenJPLephem( jpl ), "Could not open the DE421 file" );
+        } else {
+            Lgm_ReadJPLephem( jpl );
+        }
+        fail_unless( (Lgm_JPL_getNSets( LGM_DE_NUTATION, jpl ) > 0) && (jpl->nutation_naxes == 2), "No nutations in the DE421 file" );
+        Lgm_JPLephem_position( 2455197.5, LGM_DE_NUTATION, jpl, &u );
+        fail_unless( (u.z == 0.0), "Nutations have two axes, but the third came out as %g", u.z );
+        Lgm_JPLephem_velocity( 2455197.5, LGM_DE_NUTATION, jpl, &u );
+        fail_unless( (u.z == 0.0), "Nutations have two axes, but the third rate came out as %g", u.z );
+        fail_unless( (Lgm_JPL_getNSets( -1, jpl ) == -1), "Lgm_JPL_getNSets() of an unknown object should be -1" );
+        Lgm_FreeJPLephemInfo( jpl );
+    }
+
+  return;
+}
+END_TEST // END JPL ephemeris test case
+
+
 Suite *lgm_suite(void) {
 
   Suite *s = suite_create("LEAP_SECOND_TESTS");
@@ -64,6 +230,25 @@ Suite *lgm_suite(void) {
   tcase_add_test(tc_leapseconds, test_GetLeapSeconds);
   suite_add_tcase(s, tc_leapseconds);
 
+  TCase *tc_ctrans = tcase_create("Coordinate transforms");
+  tcase_add_checked_fixture(tc_ctrans, ctrans_setup, ctrans_teardown);
+  tcase_add_test(tc_ctrans, test_Agsm_to_wgs84);
+  suite_add_tcase(s, tc_ctrans);
+
+  TCase *tc_quat = tcase_create("Quaternions");
+  tcase_add_test(tc_quat, test_QuatToAxisAngle);
+  tcase_add_test(tc_quat, test_QuatExp);
+  suite_add_tcase(s, tc_quat);
+
+  TCase *tc_eop = tcase_create("EOP");
+  tcase_add_test(tc_eop, test_read_eop);
+  suite_add_tcase(s, tc_eop);
+
+  TCase *tc_jpl = tcase_create("JPL ephemerides");
+  tcase_add_test(tc_jpl, test_JPL_CopyCTrans);
+  tcase_add_test(tc_jpl, test_JPL_Nutation);
+  suite_add_tcase(s, tc_jpl);
+
   return s;
 
 }
@@ -0,0 +1,240 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libLanlGeoMag/Lgm/Lgm_PriorityQueue.h"
+#include "check_rand.h"
+
+/*
+ *  Priority queue tests. Whatever mix of inserts, bulk inserts and pops is
+ *  done, the pops have to come out in the same order as from a brute force
+ *  queue (an unsorted array searched for its smallest key).
+ */
+
+#define NKEYS   20000
+
+/*
+ *  Keys with lots of ties (small integers) or without (random doubles).
+ */
+static double RandKey( int Ties ) {
+    return( Ties ? (double)(Rand64()%50) : RandUniform( 0.0, 1.0 ) );
+}
+
+static int CompareKeys( const void *a, const void *b ) {
+    const Lgm_pQueue_Node *x = (const Lgm_pQueue_Node *)a, *y = (const Lgm_pQueue_Node *)b;
+    return( ( x->key < y->key ) ? -1 : ( x->key > y->key ) );
+}
+
+/*
+ *  Brute force queue.
+ */
+typedef struct BruteQueue {
+    long int        n;
+    Lgm_pQueue_Node *X;
+} BruteQueue;
+
+static double BruteQueue_Pop( BruteQueue *b ) {
+    long int    i, iMin = 0;
+    double      key;
+    for ( i=1; i<b->n; i++ ) if ( b->X[i].key < b->X[iMin].key ) iMin = i;
+    key = b->X[iMin].key;
+    b->X[iMin] = b->X[ --(b->n) ];
+    return( key );
+}
+
+
+/*
+ *  One at a time in, all out: the keys come out sorted, and each node comes
+ *  out once. Lgm_pQueue_Peek() always gives what the next pop gives.
+ */
+START_TEST(test_pQueue_01) {
+
+    long int        i, nBad = 0;
+    int             Ties, *Seen;
+    Lgm_pQueue      *PQ;
+    Lgm_pQueue_Node New, p, q, *Ref;
+
+    printf("Checking Lgm_pQueue_Insert() and Lgm_pQueue_Pop() against a sort of %d keys\n", NKEYS);
+    Ref  = (Lgm_pQueue_Node *)calloc( NKEYS, sizeof(Lgm_pQueue_Node) );
+    Seen = (int *)calloc( NKEYS, sizeof(int) );
+    State = 0x9E3779B97F4A7C15ULL;
+    for ( Ties=0; Ties<2; Ties++ ) {
+
+        PQ = Lgm_pQueue_Create( 2 );
+        New.Data = NULL;
+        for ( i=0; i<NKEYS; i++ ) {
+            New.key   = RandKey( Ties );
+            New.index = (int)i;
+            Ref[i]    = New;
+            Lgm_pQueue_Insert( &New, PQ );
+        }
+        fail_unless( (PQ->HeapSize == NKEYS), "HeapSize should be %d after %d inserts, got %ld", NKEYS, NKEYS, PQ->HeapSize );
+        qsort( Ref, NKEYS, sizeof(Lgm_pQueue_Node), CompareKeys );
+
+        memset( Seen, 0, NKEYS*sizeof(int) );
+        for ( i=0; i<NKEYS; i++ ) {
+            fail_unless( Lgm_pQueue_Peek( &q, PQ ) && Lgm_pQueue_Pop( &p, PQ ), "Queue ran out after %ld pops", i );
+            if ( ( p.key != Ref[i].key ) || ( q.key != p.key ) || ( q.index != p.index ) || ( p.index < 0 ) || ( p.index >= NKEYS ) || Seen[p.index]++ ) {
+                if ( nBad++ < 10 ) printf("    pop %ld: got key %g (index %d, peek gave %g), expected key %g\n", i, p.key, p.index, q.key, Ref[i].key );
+            }
+        }
+        fail_unless( !Lgm_pQueue_Pop( &p, PQ ) && !Lgm_pQueue_Peek( &p, PQ ), "Pop/Peek of an empty queue should return 0" );
+        Lgm_pQueue_Destroy( PQ );
+
+    }
+    free( Ref );
+    free( Seen );
+    fail_unless( (nBad == 0), "%ld pops came out of order", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Random mixes of single inserts, bulk inserts (both small batches, which
+ *  are inserted one by one, and large ones, which rebuild the heap) and
+ *  pops, against the brute force queue.
+ */
+START_TEST(test_pQueue_02) {
+
+    long int        i, j, n, nOps = 0, nBad = 0;
+    int             Ties;
+    double          key;
+    Lgm_pQueue      *PQ;
+    Lgm_pQueue_Node New, p, *Batch;
+    BruteQueue      b;
+
+    printf("Checking Lgm_pQueue_InsertArray() and Lgm_pQueue_Pop() against a brute force queue\n");
+    Batch = (Lgm_pQueue_Node *)calloc( NKEYS, sizeof(Lgm_pQueue_Node) );
+    b.X   = (Lgm_pQueue_Node *)calloc( NKEYS, sizeof(Lgm_pQueue_Node) );
+    State = 0xD1B54A32D192ED03ULL;
+    for ( Ties=0; Ties<2; Ties++ ) {
+
+        PQ  = Lgm_pQueue_Create( 10 );
+        b.n = 0;
+        New.Data = NULL;
+        for ( i=0; i<2000; i++ ) {
+            switch ( Rand64()%4 ) {
+                case 0:
+                    // single insert
+                    New.key = RandKey( Ties ); New.index = (int)nOps++;
+                    Lgm_pQueue_Insert( &New, PQ );
+                    b.X[ b.n++ ] = New;
+                    break;
+                case 1:
+                    // bulk insert (up to twice the size of the heap)
+                    n = Rand64()%( ( Rand64()&1 ) ? 9 : 2*PQ->HeapSize + 9 );
+                    if ( b.n + n > NKEYS ) n = 0;
+                    for ( j=0; j<n; j++ ) {
+                        Batch[j].key = RandKey( Ties ); Batch[j].index = (int)nOps++; Batch[j].Data = NULL;
+                        b.X[ b.n++ ] = Batch[j];
+                    }
+                    Lgm_pQueue_InsertArray( Batch, n, PQ );
+                    break;
+                default:
+                    // a few pops
+                    n = Rand64()%8;
+                    for ( j=0; ( j<n ) && ( b.n > 0 ); j++ ) {
+                        key = BruteQueue_Pop( &b );
+                        if ( !Lgm_pQueue_Pop( &p, PQ ) || ( p.key != key ) ) {
+                            if ( nBad++ < 10 ) printf("    op %ld: popped key %g, brute force queue gives %g\n", i, p.key, key );
+                        }
+                    }
+                    break;
+            }
+            if ( PQ->HeapSize != b.n ) {
+                if ( nBad++ < 10 ) printf("    op %ld: HeapSize is %ld, brute force queue has %ld\n", i, PQ->HeapSize, b.n );
+            }
+        }
+
+        // drain
+        while ( b.n > 0 ) {
+            key = BruteQueue_Pop( &b );
+            if ( !Lgm_pQueue_Pop( &p, PQ ) || ( p.key != key ) ) {
+                if ( nBad++ < 10 ) printf("    drain: popped key %g, brute force queue gives %g\n", p.key, key );
+            }
+        }
+        fail_unless( (PQ->HeapSize == 0), "Queue should be empty after the drain, HeapSize = %ld", PQ->HeapSize );
+        Lgm_pQueue_Destroy( PQ );
+
+    }
+    free( Batch );
+    free( b.X );
+    fail_unless( (nBad == 0), "%ld pops differ from the brute force queue", nBad );
+
+    return;
+}
+END_TEST
+
+
+/*
+ *  Lgm_pQueue_Reserve() on a zeroed (embedded) queue, so inserts up to the
+ *  reserved size do not reallocate, and Lgm_pQueue_Reset() keeps the memory.
+ */
+START_TEST(test_pQueue_03) {
+
+    long int        i, K = 100;
+    Lgm_pQueue      PQ;
+    Lgm_pQueue_Node New, p, *h;
+
+    printf("Checking Lgm_pQueue_Reserve() and Lgm_pQueue_Reset()\n");
+    memset( &PQ, 0, sizeof(Lgm_pQueue) );
+    fail_unless( !Lgm_pQueue_Pop( &p, &PQ ), "Pop of a zeroed queue should return 0" );
+    Lgm_pQueue_Reserve( K, &PQ );
+    fail_unless( (PQ.nHeapArray > K) && (PQ.HeapArray != NULL), "Lgm_pQueue_Reserve( %ld ) gave nHeapArray = %ld", K, PQ.nHeapArray );
+
+    h = PQ.HeapArray;
+    New.Data = NULL;
+    for ( i=0; i<K; i++ ) {
+        New.key = (double)( (i*37)%K ); New.index = (int)i;
+        Lgm_pQueue_Insert( &New, &PQ );
+    }
+    fail_unless( (PQ.HeapArray == h), "Inserting the reserved number of nodes should not reallocate" );
+
+    Lgm_pQueue_Reset( &PQ );
+    fail_unless( (PQ.HeapSize == 0) && !Lgm_pQueue_Peek( &p, &PQ ), "Lgm_pQueue_Reset() should empty the queue" );
+    fail_unless( (PQ.HeapArray == h), "Lgm_pQueue_Reset() should keep the memory" );
+
+    New.key = 3.0; Lgm_pQueue_Insert( &New, &PQ );
+    New.key = 1.0; Lgm_pQueue_Insert( &New, &PQ );
+    New.key = 2.0; Lgm_pQueue_Insert( &New, &PQ );
+    for ( i=1; i<=3; i++ ) {
+        fail_unless( Lgm_pQueue_Pop( &p, &PQ ) && (p.key == (double)i), "After a reset, pop %ld gave %g", i, p.key );
+    }
+    free( PQ.HeapArray );
+
+    return;
+}
+END_TEST
+
+
+Suite *pQueue_suite(void) {
+
+    Suite *s  = suite_create("PQUEUE_TESTS");
+    TCase *tc = tcase_create("Priority Queue");
+    tcase_add_test(tc, test_pQueue_01);
+    tcase_add_test(tc, test_pQueue_02);
+    tcase_add_test(tc, test_pQueue_03);
+    suite_add_tcase(s, tc);
+
+    return s;
+
+}
+
+int main(void) {
+
+    int     number_failed;
+    Suite   *s  = pQueue_suite();
+    SRunner *sr = srunner_create(s);
+
+    printf("\n\n======================================================\n");
+    printf("    Running Priority Queue Tests\n");
+    printf("======================================================\n\n");
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
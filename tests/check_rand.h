@@ -0,0 +1,24 @@
+#ifndef CHECK_RAND_H
+#define CHECK_RAND_H
+
+#include <stdint.h>
+
+/*
+ *  Small xorshift generator for the tests, so the random cases are the same
+ *  on every platform. Seed it by setting State (to anything but 0).
+ */
+static uint64_t State;
+
+static inline uint64_t Rand64( void ) {
+    State ^= State << 13; State ^= State >> 7; State ^= State << 17;
+    return( State );
+}
+
+/*
+ *  Uniform in [a,b), from the top 53 bits of Rand64().
+ */
+static inline double RandUniform( double a, double b ) {
+    return( a + (b-a)*( (Rand64() >> 11)*(1.0/9007199254740992.0) ) );
+}
+
+#endif